@@ -0,0 +1,1860 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file sdk_microbench.c
+ * @brief Microbenchmarks of the hot paths of the demos, run without a
+ * network or a broker.
+ *
+ * The benchmark measures, in a single thread:
+ * - dispatch: SubscriptionManager_DispatchHandler with a number of topic
+ *   filters registered, of which one matches the topic.
+ * - report: GenerateJsonReport of the Device Defender demo, with a number of
+ *   open TCP and UDP ports and of established connections.
+ * - shadow: the extraction of the keys of an /update/delta message into the
+ *   shadow cache, followed by the lookup of a key.
+ * - ports: GetOpenTcpPorts and GetEstablishedConnections reading a number of
+ *   sockets from a synthetic /proc/net/tcp, written to
+ *   METRICS_COLLECTOR_PROC_NET_TCP_PATH.
+ * - ota: otaPal_WriteBlock of the blocks of an image, and the verification
+ *   of its signature by otaPal_CloseFile, with a signer key and certificate
+ *   generated by the benchmark.
+ * - replay: the captures given with -c, as written by the capture transport
+ *   of platform/posix/transport, replayed as fast as they are read. The
+ *   packets received by an MQTT capture are deserialized by coreMQTT, and
+ *   its PUBLISH messages dispatched to a "#" topic filter. The responses
+ *   received by an HTTP capture are parsed by HTTPClient_Send, as responses
+ *   to GET requests. The size of a replay is its number of packets or
+ *   responses, and its throughput that of the bytes received.
+ *
+ * Each operation runs until it ran a number of times or for a length of
+ * time, and the benchmark prints the mean time of an operation with its
+ * percentiles, and the number of allocations it made. The allocations are
+ * counted by wrapping malloc, calloc and realloc at link time, so only those
+ * of the code compiled into the benchmark are counted, not those made inside
+ * OpenSSL or the C library. The SDK code is compiled with its logs disabled.
+ *
+ * The ota benchmark leaves PlatformImageState.txt, the state of the image
+ * verified, in the current directory, as the OTA PAL does on a device.
+ *
+ * Run the benchmark with --help for its options. For example:
+ * $ sdk_microbench -t dispatch,report -s 10,1000,10000
+ * $ sdk_microbench -t ota -i 1,100
+ * $ sdk_microbench -t replay -c telemetry.cap -c download.cap
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <getopt.h>
+#include <unistd.h>
+
+/* Logging stack includes. */
+#include "logging_levels.h"
+
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "SDK_MICROBENCH"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/* OpenSSL includes, to sign the OTA images. */
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+/* Clock for the timestamps. */
+#include "clock.h"
+
+/* Histogram of the latencies. */
+#include "latency_histogram.h"
+
+/* Code measured. */
+#include "mqtt_subscription_manager.h"
+#include "metrics_collector.h"
+#include "report_builder.h"
+#include "shadow_cache.h"
+#include "ota_pal_posix.h"
+#include "core_http_client.h"
+
+/* Transport replaying the captures. */
+#include "capture_transport_posix.h"
+
+#ifndef METRICS_COLLECTOR_PROC_NET_TCP_PATH
+    #error "METRICS_COLLECTOR_PROC_NET_TCP_PATH must be set to the synthetic /proc/net/tcp of the benchmark."
+#endif
+
+/**
+ * @brief Path of the images received by the ota benchmark.
+ */
+#ifndef SDK_MICROBENCH_OTA_IMAGE_PATH
+    #define SDK_MICROBENCH_OTA_IMAGE_PATH    "/tmp/sdk_microbench_image.bin"
+#endif
+
+/**
+ * @brief Path of the certificate of the signer of the images.
+ */
+#ifndef SDK_MICROBENCH_OTA_CERT_PATH
+    #define SDK_MICROBENCH_OTA_CERT_PATH    "/tmp/sdk_microbench_signer.pem"
+#endif
+
+/**
+ * @brief Largest number of values of a list option.
+ */
+#define MAX_LIST_LENGTH               ( 8U )
+
+/**
+ * @brief Largest number of topic filters, ports or connections.
+ */
+#define MAX_ENTRY_COUNT               ( 999999U )
+
+/**
+ * @brief Largest size of an OTA image, in MB.
+ */
+#define MAX_IMAGE_SIZE_MB             ( 1024U )
+
+/**
+ * @brief Default largest number of runs of each operation.
+ */
+#define DEFAULT_ITERATIONS            ( 100000U )
+
+/**
+ * @brief Default longest time spent running each operation, in seconds.
+ */
+#define DEFAULT_DURATION_SEC          ( 2U )
+
+/**
+ * @brief Default numbers of topic filters, ports and connections.
+ */
+#define DEFAULT_ENTRY_COUNTS          "10,100,1000,10000"
+
+/**
+ * @brief Default sizes of the OTA images, in MB.
+ */
+#define DEFAULT_IMAGE_SIZES_MB        "1,10,100"
+
+/**
+ * @brief Default benchmarks run.
+ */
+#define DEFAULT_TESTS                 "dispatch,report,shadow,ports,ota"
+
+/**
+ * @brief Length of the name of a benchmark in the report.
+ */
+#define NAME_MAX_LENGTH               ( 28U )
+
+/**
+ * @brief Format of the topic filters registered by the dispatch benchmark,
+ * and of the topic of its message, matching one of them.
+ */
+#define DISPATCH_FILTER_FORMAT        "bench/dev%06u/+/state"
+#define DISPATCH_TOPIC_FORMAT         "bench/dev%06u/temp/state"
+
+/**
+ * @brief Length of a topic filter of #DISPATCH_FILTER_FORMAT.
+ */
+#define DISPATCH_FILTER_LENGTH        ( sizeof( "bench/dev000000/+/state" ) - 1U )
+
+/**
+ * @brief Payload of the message dispatched.
+ */
+#define DISPATCH_PAYLOAD              "{\"temperature\":21}"
+
+/**
+ * @brief Numbers of keys of the deltas of the shadow benchmark.
+ */
+#define SHADOW_KEY_COUNTS             { 1U, 16U, SHADOW_CACHE_MAX_ENTRIES }
+
+/**
+ * @brief Number of bytes of a delta for each of its keys, more than the
+ * longest key takes with its value and metadata.
+ */
+#define SHADOW_BYTES_PER_KEY          ( 96U )
+
+/**
+ * @brief Number of bytes in an MB, the unit of the size of the OTA images.
+ */
+#define BYTES_PER_MB                  ( 1048576U )
+
+/**
+ * @brief Number of nanoseconds in a second.
+ */
+#define NANOSECONDS_PER_SECOND        ( ( uint64_t ) 1000000000U )
+
+/**
+ * @brief Bits of #BenchConfig_t.tests, one per benchmark.
+ */
+#define TEST_DISPATCH                 ( 1U << 0 )
+#define TEST_REPORT                   ( 1U << 1 )
+#define TEST_SHADOW                   ( 1U << 2 )
+#define TEST_PORTS                    ( 1U << 3 )
+#define TEST_OTA                      ( 1U << 4 )
+#define TEST_REPLAY                   ( 1U << 5 )
+
+/**
+ * @brief Topic filter the messages of the MQTT captures are dispatched to.
+ */
+#define REPLAY_TOPIC_FILTER           "#"
+
+/**
+ * @brief Size of the buffer of the headers of the requests of the HTTP
+ * replays.
+ */
+#define REPLAY_REQUEST_BUFFER_SIZE    ( 256U )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    ReplayTransportParams_t * pParams;
+};
+
+/**
+ * @brief The options of a run.
+ */
+typedef struct BenchConfig
+{
+    uint32_t tests;                                /**< @brief Benchmarks to run, of the TEST_ bits. */
+    uint32_t iterations;                           /**< @brief Largest number of runs of each operation. */
+    uint32_t durationSec;                          /**< @brief Longest time spent running each operation. */
+    uint32_t entryCounts[ MAX_LIST_LENGTH ];       /**< @brief Numbers of topic filters, ports and connections. */
+    uint32_t entryCountsLength;                    /**< @brief Number of #BenchConfig_t.entryCounts. */
+    uint32_t imageSizesMb[ MAX_LIST_LENGTH ];      /**< @brief Sizes of the OTA images, in MB. */
+    uint32_t imageSizesMbLength;                   /**< @brief Number of #BenchConfig_t.imageSizesMb. */
+    const char * pCapturePaths[ MAX_LIST_LENGTH ]; /**< @brief Paths of the captures to replay. */
+    uint32_t capturePathsLength;                   /**< @brief Number of #BenchConfig_t.pCapturePaths. */
+} BenchConfig_t;
+
+/**
+ * @brief The input of the runs of the dispatch benchmark.
+ */
+typedef struct DispatchOperand
+{
+    MQTTContext_t * pContext;         /**< @brief MQTT context passed to the callbacks. */
+    MQTTPublishInfo_t publishInfo;    /**< @brief Message dispatched. */
+} DispatchOperand_t;
+
+/**
+ * @brief The input of the runs of the report benchmark.
+ */
+typedef struct ReportOperand
+{
+    ReportMetrics_t metrics;     /**< @brief Metrics of the report. */
+    char * pBuffer;              /**< @brief Buffer the report is written into. */
+    uint32_t bufferLength;       /**< @brief Length of #ReportOperand_t.pBuffer. */
+} ReportOperand_t;
+
+/**
+ * @brief The input of the runs of the shadow benchmark.
+ */
+typedef struct ShadowOperand
+{
+    const char * pPayload;      /**< @brief The /update/delta message. */
+    size_t payloadLength;       /**< @brief Length of #ShadowOperand_t.pPayload. */
+    char key[ 16 ];             /**< @brief Key looked up after the delta is applied. */
+    size_t keyLength;           /**< @brief Length of #ShadowOperand_t.key. */
+} ShadowOperand_t;
+
+/**
+ * @brief The input of the runs of the ports benchmark.
+ */
+typedef struct PortsOperand
+{
+    uint16_t * pPorts;             /**< @brief Open ports found. */
+    Connection_t * pConnections;   /**< @brief Established connections found. */
+    uint32_t entryCount;           /**< @brief Length of the arrays, the number of sockets of the file. */
+} PortsOperand_t;
+
+/**
+ * @brief The input of the runs of the replay benchmark.
+ */
+typedef struct ReplayOperand
+{
+    NetworkContext_t * pNetworkContext;  /**< @brief Network context of the replay transport. */
+    MQTTContext_t * pContext;            /**< @brief MQTT context passed to the callbacks. */
+    HTTPRequestHeaders_t requestHeaders; /**< @brief Request sent for each HTTP response. */
+    uint8_t * pBuffer;                   /**< @brief Buffer of the packets and responses, as large as the bytes received. */
+    size_t bufferLength;                 /**< @brief Length of #ReplayOperand_t.pBuffer. */
+    uint32_t messageCount;               /**< @brief Number of packets or responses of the last run. */
+} ReplayOperand_t;
+
+/**
+ * @brief A run of an operation.
+ *
+ * @param[in] pOperand The input of the operation.
+ *
+ * @return true if the operation succeeded; false otherwise.
+ */
+typedef bool ( * BenchOperation_t )( void * pOperand );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The options of the run.
+ */
+static BenchConfig_t benchConfig;
+
+/**
+ * @brief Latencies of the benchmark being run, in nanoseconds.
+ */
+static LatencyHistogram_t latencyNs;
+
+/**
+ * @brief Number of allocations made since the start of the program.
+ */
+static uint64_t allocationCount = 0U;
+
+/**
+ * @brief Number of callbacks the dispatch benchmark invoked.
+ */
+static uint32_t dispatchCallbackCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/* The allocators of the C library, and the wrappers the linker calls in their
+ * place with --wrap, whose names are set by the linker. */
+void * __real_malloc( size_t size );
+void * __real_calloc( size_t count,
+                      size_t size );
+void * __real_realloc( void * pPointer,
+                       size_t size );
+void * __wrap_malloc( size_t size );
+void * __wrap_calloc( size_t count,
+                      size_t size );
+void * __wrap_realloc( void * pPointer,
+                       size_t size );
+
+/**
+ * @brief Describe program usage on stderr.
+ *
+ * @param[in] programName the value of argv[0]
+ */
+static void usage( const char * programName );
+
+/**
+ * @brief Parse a number of an option.
+ *
+ * @param[in] pArgument The text of the number.
+ * @param[in] minValue The smallest value allowed.
+ * @param[in] maxValue The largest value allowed.
+ * @param[out] pValue The number.
+ *
+ * @return true if the number is valid; false otherwise.
+ */
+static bool parseNumber( const char * pArgument,
+                         uint32_t minValue,
+                         uint32_t maxValue,
+                         uint32_t * pValue );
+
+/**
+ * @brief Parse the comma separated names of the benchmarks to run.
+ *
+ * @param[in] pArgument The names.
+ * @param[out] pTests The TEST_ bits of the benchmarks.
+ *
+ * @return true if the names are valid; false otherwise.
+ */
+static bool parseTests( const char * pArgument,
+                        uint32_t * pTests );
+
+/**
+ * @brief Parse a comma separated list of numbers.
+ *
+ * @param[in] pArgument The list.
+ * @param[in] maxValue The largest value allowed.
+ * @param[out] pValues The numbers, at most #MAX_LIST_LENGTH of them.
+ * @param[out] pLength The number of numbers.
+ *
+ * @return true if the list is valid; false otherwise.
+ */
+static bool parseList( const char * pArgument,
+                       uint32_t maxValue,
+                       uint32_t * pValues,
+                       uint32_t * pLength );
+
+/**
+ * @brief Parse the options of the program.
+ *
+ * @param[out] pConfig The options.
+ * @param[in] argc The number of arguments.
+ * @param[in] argv The arguments.
+ *
+ * @return true if the options are valid; false otherwise.
+ */
+static bool parseArgs( BenchConfig_t * pConfig,
+                       int argc,
+                       char * argv[] );
+
+/**
+ * @brief Print the results of a benchmark.
+ *
+ * @param[in] pName Name of the benchmark.
+ * @param[in] parameter The number of entries or MB it ran with.
+ * @param[in] runCount The number of runs of the operation.
+ * @param[in] elapsedNs The time the runs took.
+ * @param[in] allocations The number of allocations the runs made.
+ * @param[in] bytesPerRun Bytes processed by each run, to print the throughput;
+ * 0 for none.
+ */
+static void printResult( const char * pName,
+                         uint32_t parameter,
+                         uint32_t runCount,
+                         uint64_t elapsedNs,
+                         uint64_t allocations,
+                         uint64_t bytesPerRun );
+
+/**
+ * @brief Run an operation, and print its results.
+ *
+ * @param[in] pName Name of the benchmark.
+ * @param[in] parameter The number of entries it runs with.
+ * @param[in] operation The operation.
+ * @param[in] pOperand The input of the operation.
+ * @param[in] bytesPerRun The number of bytes an operation processes, to
+ * print its throughput; 0 if it has none.
+ *
+ * @return true if the operation succeeded every time; false otherwise.
+ */
+static bool runBenchmark( const char * pName,
+                          uint32_t parameter,
+                          BenchOperation_t operation,
+                          void * pOperand,
+                          uint64_t bytesPerRun );
+
+/**
+ * @brief Callback of the topic filters of the dispatch benchmark.
+ *
+ * @param[in] pContext The MQTT context.
+ * @param[in] pPublishInfo The message.
+ */
+static void dispatchCallback( MQTTContext_t * pContext,
+                              MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief #BenchOperation_t dispatching a message.
+ */
+static bool dispatch( void * pOperand );
+
+/**
+ * @brief #BenchOperation_t generating a JSON report.
+ */
+static bool generateReport( void * pOperand );
+
+/**
+ * @brief #BenchOperation_t applying a delta to an empty shadow cache and
+ * looking up a key.
+ */
+static bool applyDelta( void * pOperand );
+
+/**
+ * @brief #BenchOperation_t getting the open TCP ports.
+ */
+static bool getOpenPorts( void * pOperand );
+
+/**
+ * @brief #BenchOperation_t getting the established connections.
+ */
+static bool getConnections( void * pOperand );
+
+/**
+ * @brief Measure the dispatch of a message with a number of topic filters.
+ *
+ * @param[in] filterCount The number of topic filters.
+ *
+ * @return true if the benchmark succeeded; false otherwise.
+ */
+static bool benchDispatch( uint32_t filterCount );
+
+/**
+ * @brief Measure the generation of a report with a number of ports and
+ * connections.
+ *
+ * @param[in] entryCount The number of ports of each protocol, and of
+ * connections.
+ *
+ * @return true if the benchmark succeeded; false otherwise.
+ */
+static bool benchReport( uint32_t entryCount );
+
+/**
+ * @brief Measure the extraction of the keys of a delta.
+ *
+ * @param[in] keyCount The number of keys of the delta.
+ *
+ * @return true if the benchmark succeeded; false otherwise.
+ */
+static bool benchShadow( uint32_t keyCount );
+
+/**
+ * @brief Write the synthetic /proc/net/tcp, with half of the sockets
+ * listening and the others established.
+ *
+ * @param[in] socketCount The number of sockets.
+ *
+ * @return true if the file was written; false otherwise.
+ */
+static bool writeProcNetTcp( uint32_t socketCount );
+
+/**
+ * @brief Measure the collection of the sockets of a synthetic /proc/net/tcp.
+ *
+ * @param[in] socketCount The number of sockets of the file.
+ *
+ * @return true if the benchmark succeeded; false otherwise.
+ */
+static bool benchPorts( uint32_t socketCount );
+
+/**
+ * @brief Generate the P-256 key signing the OTA images, and write its
+ * self-signed certificate to #SDK_MICROBENCH_OTA_CERT_PATH.
+ *
+ * @return The key; NULL if it could not be generated.
+ */
+static EVP_PKEY * createSigner( void );
+
+/**
+ * @brief Fill a block of an OTA image.
+ *
+ * @param[out] pBlock The block of otaconfigFILE_BLOCK_SIZE bytes.
+ * @param[in] blockIndex The index of the block in the image.
+ */
+static void fillBlock( uint8_t * pBlock,
+                       uint32_t blockIndex );
+
+/**
+ * @brief Sign an OTA image, as the OTA service does.
+ *
+ * @param[in] pKey The signer key.
+ * @param[in] blockCount The number of blocks of the image.
+ * @param[out] pSignature The signature.
+ *
+ * @return true if the image was signed; false otherwise.
+ */
+static bool signImage( EVP_PKEY * pKey,
+                       uint32_t blockCount,
+                       Sig256_t * pSignature );
+
+/**
+ * @brief Measure the reception and the verification of an OTA image.
+ *
+ * @param[in] pKey The signer key.
+ * @param[in] sizeMb The size of the image, in MB.
+ *
+ * @return true if the benchmark succeeded; false otherwise.
+ */
+static bool benchOta( EVP_PKEY * pKey,
+                      uint32_t sizeMb );
+
+/**
+ * @brief Replay an MQTT capture, deserializing the packets received and
+ * dispatching its messages.
+ *
+ * @param[in] pOperand The #ReplayOperand_t of the capture.
+ *
+ * @return true if all the packets were deserialized; false otherwise.
+ */
+static bool replayMqtt( void * pOperand );
+
+/**
+ * @brief Replay an HTTP capture, parsing each response received.
+ *
+ * @param[in] pOperand The #ReplayOperand_t of the capture.
+ *
+ * @return true if all the responses were parsed; false otherwise.
+ */
+static bool replayHttp( void * pOperand );
+
+/**
+ * @brief Read a capture into memory.
+ *
+ * @param[in] pPath The path of the capture.
+ * @param[out] ppCapture The capture, to free.
+ * @param[out] pCaptureLength The length of the capture.
+ *
+ * @return true if the capture was read; false otherwise.
+ */
+static bool readCapture( const char * pPath,
+                         uint8_t ** ppCapture,
+                         size_t * pCaptureLength );
+
+/**
+ * @brief Measure the replay of a capture.
+ *
+ * @param[in] pPath The path of the capture.
+ *
+ * @return true if the benchmark succeeded; false otherwise.
+ */
+static bool benchReplay( const char * pPath );
+
+/*-----------------------------------------------------------*/
+
+void * __wrap_malloc( size_t size )
+{
+    allocationCount++;
+
+    return __real_malloc( size );
+}
+
+/*-----------------------------------------------------------*/
+
+void * __wrap_calloc( size_t count,
+                      size_t size )
+{
+    allocationCount++;
+
+    return __real_calloc( count, size );
+}
+
+/*-----------------------------------------------------------*/
+
+void * __wrap_realloc( void * pPointer,
+                       size_t size )
+{
+    allocationCount++;
+
+    return __real_realloc( pPointer, size );
+}
+
+/*-----------------------------------------------------------*/
+
+static void usage( const char * programName )
+{
+    fprintf( stderr,
+             "\nThis benchmark measures the time and the allocations of the hot paths of the demos.\n"
+             "\nusage: %s [-t tests] [-s counts] [-i sizes] [-c capture]... [-n iterations] [-d seconds]\n"
+             "\n"
+             "-t, --tests      : comma separated benchmarks among dispatch, report, shadow, ports, ota\n"
+             "                   and replay. Defaults to %s.\n"
+             "-s, --sizes      : comma separated numbers of topic filters, ports and connections.\n"
+             "                   Defaults to %s.\n",
+             programName,
+             DEFAULT_TESTS,
+             DEFAULT_ENTRY_COUNTS );
+    fprintf( stderr,
+             "-i, --image-sizes: comma separated sizes of the OTA images, in MB. Defaults to %s.\n"
+             "-c, --capture    : capture of an MQTT or HTTP connection replayed by the replay benchmark.\n"
+             "                   May be given up to %u times.\n"
+             "-n, --iterations : largest number of runs of each operation. Defaults to %u.\n"
+             "-d, --duration   : longest time spent on each operation, in seconds. Defaults to %u.\n\n",
+             DEFAULT_IMAGE_SIZES_MB,
+             ( unsigned int ) MAX_LIST_LENGTH,
+             ( unsigned int ) DEFAULT_ITERATIONS,
+             ( unsigned int ) DEFAULT_DURATION_SEC );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseNumber( const char * pArgument,
+                         uint32_t minValue,
+                         uint32_t maxValue,
+                         uint32_t * pValue )
+{
+    bool returnStatus = false;
+    char * pEnd = NULL;
+    unsigned long value = strtoul( pArgument, &pEnd, 0 );
+
+    if( ( pEnd != pArgument ) && ( *pEnd == '\0' ) && ( pArgument[ 0 ] != '-' ) &&
+        ( value >= minValue ) && ( value <= maxValue ) )
+    {
+        *pValue = ( uint32_t ) value;
+        returnStatus = true;
+    }
+    else
+    {
+        LogError( ( "Bad value: %s.", pArgument ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseTests( const char * pArgument,
+                        uint32_t * pTests )
+{
+    static const struct
+    {
+        const char * pName;
+        uint32_t bit;
+    } tests[] =
+    {
+        { "dispatch", TEST_DISPATCH },
+        { "report",   TEST_REPORT   },
+        { "shadow",   TEST_SHADOW   },
+        { "ports",    TEST_PORTS    },
+        { "ota",      TEST_OTA      },
+        { "replay",   TEST_REPLAY   }
+    };
+    bool returnStatus = true;
+    const char * pName = pArgument;
+    size_t nameLength = 0U;
+    size_t index = 0U;
+    bool found = false;
+
+    *pTests = 0U;
+
+    while( ( returnStatus == true ) && ( *pName != '\0' ) )
+    {
+        nameLength = strcspn( pName, "," );
+        found = false;
+
+        for( index = 0U; index < ( sizeof( tests ) / sizeof( tests[ 0 ] ) ); index++ )
+        {
+            if( ( strlen( tests[ index ].pName ) == nameLength ) &&
+                ( strncmp( tests[ index ].pName, pName, nameLength ) == 0 ) )
+            {
+                *pTests |= tests[ index ].bit;
+                found = true;
+            }
+        }
+
+        if( found == false )
+        {
+            LogError( ( "Unknown benchmark: %.*s.", ( int ) nameLength, pName ) );
+            returnStatus = false;
+        }
+
+        pName += nameLength;
+
+        if( *pName == ',' )
+        {
+            pName++;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseList( const char * pArgument,
+                       uint32_t maxValue,
+                       uint32_t * pValues,
+                       uint32_t * pLength )
+{
+    bool returnStatus = true;
+    char buffer[ 128 ];
+    char * pSaveptr = NULL;
+    char * pToken = NULL;
+
+    *pLength = 0U;
+
+    if( strlen( pArgument ) >= sizeof( buffer ) )
+    {
+        LogError( ( "Bad value: %s.", pArgument ) );
+        returnStatus = false;
+    }
+    else
+    {
+        ( void ) strcpy( buffer, pArgument );
+        pToken = strtok_r( buffer, ",", &pSaveptr );
+    }
+
+    while( ( returnStatus == true ) && ( pToken != NULL ) )
+    {
+        if( *pLength == MAX_LIST_LENGTH )
+        {
+            LogError( ( "At most %u values.", ( unsigned int ) MAX_LIST_LENGTH ) );
+            returnStatus = false;
+        }
+        else
+        {
+            returnStatus = parseNumber( pToken, 1U, maxValue, &( pValues[ *pLength ] ) );
+            ( *pLength )++;
+            pToken = strtok_r( NULL, ",", &pSaveptr );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseArgs( BenchConfig_t * pConfig,
+                       int argc,
+                       char * argv[] )
+{
+    bool returnStatus = true;
+    int option = 0;
+    static const struct option longOptions[] =
+    {
+        { "tests",       required_argument, NULL, 't' },
+        { "sizes",       required_argument, NULL, 's' },
+        { "image-sizes", required_argument, NULL, 'i' },
+        { "capture",     required_argument, NULL, 'c' },
+        { "iterations",  required_argument, NULL, 'n' },
+        { "duration",    required_argument, NULL, 'd' },
+        { "help",        no_argument,       NULL, '?' },
+        { NULL,          0,                 NULL, 0   }
+    };
+
+    ( void ) memset( pConfig, 0x00, sizeof( BenchConfig_t ) );
+    pConfig->iterations = DEFAULT_ITERATIONS;
+    pConfig->durationSec = DEFAULT_DURATION_SEC;
+    ( void ) parseTests( DEFAULT_TESTS, &( pConfig->tests ) );
+    ( void ) parseList( DEFAULT_ENTRY_COUNTS, MAX_ENTRY_COUNT,
+                        pConfig->entryCounts, &( pConfig->entryCountsLength ) );
+    ( void ) parseList( DEFAULT_IMAGE_SIZES_MB, MAX_IMAGE_SIZE_MB,
+                        pConfig->imageSizesMb, &( pConfig->imageSizesMbLength ) );
+
+    while( returnStatus == true )
+    {
+        option = getopt_long( argc, argv, "t:s:i:c:n:d:?", longOptions, NULL );
+
+        if( option == -1 )
+        {
+            break;
+        }
+
+        switch( option )
+        {
+            case 't':
+                returnStatus = parseTests( optarg, &( pConfig->tests ) );
+                break;
+
+            case 's':
+                returnStatus = parseList( optarg, MAX_ENTRY_COUNT,
+                                          pConfig->entryCounts, &( pConfig->entryCountsLength ) );
+                break;
+
+            case 'i':
+                returnStatus = parseList( optarg, MAX_IMAGE_SIZE_MB,
+                                          pConfig->imageSizesMb, &( pConfig->imageSizesMbLength ) );
+                break;
+
+            case 'c':
+
+                if( pConfig->capturePathsLength == MAX_LIST_LENGTH )
+                {
+                    LogError( ( "At most %u captures.", ( unsigned int ) MAX_LIST_LENGTH ) );
+                    returnStatus = false;
+                }
+                else
+                {
+                    pConfig->pCapturePaths[ pConfig->capturePathsLength ] = optarg;
+                    pConfig->capturePathsLength++;
+                }
+
+                break;
+
+            case 'n':
+                returnStatus = parseNumber( optarg, 1U, 100000000U, &( pConfig->iterations ) );
+                break;
+
+            case 'd':
+                returnStatus = parseNumber( optarg, 1U, 86400U, &( pConfig->durationSec ) );
+                break;
+
+            case '?':
+            default:
+                returnStatus = false;
+                break;
+        }
+    }
+
+    if( ( returnStatus == true ) && ( optind < argc ) )
+    {
+        returnStatus = false;
+    }
+
+    if( ( returnStatus == true ) && ( ( pConfig->tests & TEST_REPLAY ) != 0U ) &&
+        ( pConfig->capturePathsLength == 0U ) )
+    {
+        LogError( ( "The replay benchmark needs a capture, given with -c." ) );
+        returnStatus = false;
+    }
+
+    if( returnStatus == false )
+    {
+        usage( argv[ 0 ] );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void printResult( const char * pName,
+                         uint32_t parameter,
+                         uint32_t runCount,
+                         uint64_t elapsedNs,
+                         uint64_t allocations,
+                         uint64_t bytesPerRun )
+{
+    printf( "  %-*s %7u %9u ops %13.1f ns/op %9.2f allocs/op   ns: p50 %u, p99 %u, max %u",
+            ( int ) NAME_MAX_LENGTH,
+            pName,
+            ( unsigned int ) parameter,
+            ( unsigned int ) runCount,
+            ( double ) elapsedNs / ( double ) runCount,
+            ( double ) allocations / ( double ) runCount,
+            ( unsigned int ) LatencyHistogram_Percentile( &latencyNs, 50.0 ),
+            ( unsigned int ) LatencyHistogram_Percentile( &latencyNs, 99.0 ),
+            ( unsigned int ) latencyNs.max );
+
+    if( ( bytesPerRun > 0U ) && ( elapsedNs > 0U ) )
+    {
+        printf( ", %.1f MB/s",
+                ( double ) bytesPerRun * ( double ) runCount * ( double ) NANOSECONDS_PER_SECOND /
+                ( ( double ) elapsedNs * ( double ) BYTES_PER_MB ) );
+    }
+
+    printf( "\n" );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool runBenchmark( const char * pName,
+                          uint32_t parameter,
+                          BenchOperation_t operation,
+                          void * pOperand,
+                          uint64_t bytesPerRun )
+{
+    bool success = true;
+    uint64_t startNs = 0U;
+    uint64_t endNs = 0U;
+    uint64_t runStartNs = 0U;
+    uint64_t runNs = 0U;
+    uint64_t elapsedNs = 0U;
+    uint64_t startAllocations = 0U;
+    uint32_t runCount = 0U;
+
+    LatencyHistogram_Init( &latencyNs );
+
+    /* The first run is left out, as it may fill the caches or allocate
+     * memory kept for the later runs. */
+    success = operation( pOperand );
+    startAllocations = allocationCount;
+    startNs = Clock_GetTimeNs();
+    endNs = startNs + ( ( uint64_t ) benchConfig.durationSec * NANOSECONDS_PER_SECOND );
+    runStartNs = startNs;
+
+    while( ( success == true ) && ( runCount < benchConfig.iterations ) && ( runStartNs < endNs ) )
+    {
+        success = operation( pOperand );
+        elapsedNs = Clock_GetTimeNs();
+        runNs = elapsedNs - runStartNs;
+        LatencyHistogram_Record( &latencyNs, ( runNs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) runNs );
+        runStartNs = elapsedNs;
+        runCount++;
+    }
+
+    if( success == false )
+    {
+        printf( "  %-*s %7u failed.\n", ( int ) NAME_MAX_LENGTH, pName, ( unsigned int ) parameter );
+    }
+    else
+    {
+        printResult( pName, parameter, runCount, runStartNs - startNs,
+                     allocationCount - startAllocations, bytesPerRun );
+    }
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static void dispatchCallback( MQTTContext_t * pContext,
+                              MQTTPublishInfo_t * pPublishInfo )
+{
+    ( void ) pContext;
+    ( void ) pPublishInfo;
+
+    dispatchCallbackCount++;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool dispatch( void * pOperand )
+{
+    DispatchOperand_t * pDispatch = ( DispatchOperand_t * ) pOperand;
+    uint32_t callbackCount = dispatchCallbackCount;
+
+    SubscriptionManager_DispatchHandler( pDispatch->pContext, &( pDispatch->publishInfo ) );
+
+    return( dispatchCallbackCount == ( callbackCount + 1U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool generateReport( void * pOperand )
+{
+    ReportOperand_t * pReport = ( ReportOperand_t * ) pOperand;
+    uint32_t reportLength = 0U;
+
+    return( GenerateJsonReport( pReport->pBuffer,
+                                pReport->bufferLength,
+                                &( pReport->metrics ),
+                                1U,
+                                0U,
+                                1U,
+                                &( reportLength ) ) == ReportBuilderSuccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool applyDelta( void * pOperand )
+{
+    ShadowOperand_t * pShadow = ( ShadowOperand_t * ) pOperand;
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    const char * pValue = NULL;
+    size_t valueLength = 0U;
+
+    /* The delta is applied to an empty cache, so that its version is never
+     * stale. It is merged, and reported as a version gap as the cache has
+     * no whole state. */
+    ShadowCache_Init();
+    status = ShadowCache_ApplyDelta( pShadow->pPayload, pShadow->payloadLength );
+
+    return( ( ( status == ShadowCacheSuccess ) || ( status == ShadowCacheVersionGap ) ) &&
+            ( ShadowCache_Get( ShadowCacheDesired,
+                               pShadow->key,
+                               pShadow->keyLength,
+                               &( pValue ),
+                               &( valueLength ) ) == ShadowCacheSuccess ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool getOpenPorts( void * pOperand )
+{
+    PortsOperand_t * pPorts = ( PortsOperand_t * ) pOperand;
+    uint32_t portCount = 0U;
+
+    return( ( GetOpenTcpPorts( pPorts->pPorts, pPorts->entryCount, &( portCount ) ) == MetricsCollectorSuccess ) &&
+            ( portCount == ( ( pPorts->entryCount + 1U ) / 2U ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool getConnections( void * pOperand )
+{
+    PortsOperand_t * pPorts = ( PortsOperand_t * ) pOperand;
+    uint32_t connectionCount = 0U;
+
+    return( ( GetEstablishedConnections( pPorts->pConnections,
+                                         pPorts->entryCount,
+                                         &( connectionCount ) ) == MetricsCollectorSuccess ) &&
+            ( connectionCount == ( pPorts->entryCount / 2U ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool benchDispatch( uint32_t filterCount )
+{
+    bool success = true;
+    static MQTTContext_t context;
+    DispatchOperand_t operand;
+    char topic[ 32 ];
+    char * pFilters = NULL;
+    uint32_t index = 0U;
+    uint32_t registeredCount = 0U;
+
+    /* The registry keeps the topic filters, which stay allocated until they
+     * are removed. */
+    pFilters = malloc( ( ( size_t ) filterCount * DISPATCH_FILTER_LENGTH ) + 1U );
+    success = ( pFilters != NULL );
+
+    for( index = 0U; ( success == true ) && ( index < filterCount ); index++ )
+    {
+        ( void ) snprintf( &( pFilters[ index * DISPATCH_FILTER_LENGTH ] ),
+                           DISPATCH_FILTER_LENGTH + 1U,
+                           DISPATCH_FILTER_FORMAT,
+                           ( unsigned int ) ( index % ( MAX_ENTRY_COUNT + 1U ) ) );
+
+        if( SubscriptionManager_RegisterCallback( &( pFilters[ index * DISPATCH_FILTER_LENGTH ] ),
+                                                  ( uint16_t ) DISPATCH_FILTER_LENGTH,
+                                                  dispatchCallback ) == SUBSCRIPTION_MANAGER_SUCCESS )
+        {
+            registeredCount++;
+        }
+        else
+        {
+            LogError( ( "Failed to register topic filter %u.", ( unsigned int ) index ) );
+            success = false;
+        }
+    }
+
+    if( success == true )
+    {
+        ( void ) memset( &operand, 0x00, sizeof( operand ) );
+        ( void ) snprintf( topic, sizeof( topic ), DISPATCH_TOPIC_FORMAT, ( unsigned int ) ( filterCount / 2U ) );
+        operand.pContext = &context;
+        operand.publishInfo.qos = MQTTQoS0;
+        operand.publishInfo.pTopicName = topic;
+        operand.publishInfo.topicNameLength = ( uint16_t ) strlen( topic );
+        operand.publishInfo.pPayload = DISPATCH_PAYLOAD;
+        operand.publishInfo.payloadLength = sizeof( DISPATCH_PAYLOAD ) - 1U;
+
+        success = runBenchmark( "dispatch", filterCount, dispatch, &operand, 0U );
+    }
+
+    for( index = 0U; index < registeredCount; index++ )
+    {
+        SubscriptionManager_RemoveCallback( &( pFilters[ index * DISPATCH_FILTER_LENGTH ] ),
+                                            ( uint16_t ) DISPATCH_FILTER_LENGTH );
+    }
+
+    free( pFilters );
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool benchReport( uint32_t entryCount )
+{
+    bool success = true;
+    ReportOperand_t operand;
+    NetworkStats_t networkStats;
+    uint16_t * pTcpPorts = NULL;
+    uint16_t * pUdpPorts = NULL;
+    Connection_t * pConnections = NULL;
+    uint32_t reportLength = 0U;
+    uint32_t index = 0U;
+
+    ( void ) memset( &operand, 0x00, sizeof( operand ) );
+    pTcpPorts = malloc( ( size_t ) entryCount * sizeof( uint16_t ) );
+    pUdpPorts = malloc( ( size_t ) entryCount * sizeof( uint16_t ) );
+    pConnections = malloc( ( size_t ) entryCount * sizeof( Connection_t ) );
+    success = ( pTcpPorts != NULL ) && ( pUdpPorts != NULL ) && ( pConnections != NULL );
+
+    if( success == true )
+    {
+        /* The values are as long as those of a device, of 5 digit ports
+         * and addresses of 10.x.x.x. */
+        for( index = 0U; index < entryCount; index++ )
+        {
+            pTcpPorts[ index ] = ( uint16_t ) ( 10000U + ( index % 50000U ) );
+            pUdpPorts[ index ] = ( uint16_t ) ( 60000U - ( index % 50000U ) );
+            pConnections[ index ].localIp = 0x0A000001U;
+            pConnections[ index ].localPort = pTcpPorts[ index ];
+            pConnections[ index ].remoteIp = 0x0A000000U + index + 2U;
+            pConnections[ index ].remotePort = 44300U;
+        }
+
+        networkStats.bytesReceived = 123456789U;
+        networkStats.bytesSent = 987654321U;
+        networkStats.packetsReceived = 123456U;
+        networkStats.packetsSent = 654321U;
+
+        operand.metrics.pNetworkStats = &networkStats;
+        operand.metrics.pOpenTcpPortsArray = pTcpPorts;
+        operand.metrics.openTcpPortsArrayLength = entryCount;
+        operand.metrics.pOpenUdpPortsArray = pUdpPorts;
+        operand.metrics.openUdpPortsArrayLength = entryCount;
+        operand.metrics.pEstablishedConnectionsArray = pConnections;
+        operand.metrics.establishedConnectionsArrayLength = entryCount;
+
+        success = ( GetJsonReportLength( &( operand.metrics ), 1U, 0U, 1U, &( reportLength ) ) == ReportBuilderSuccess );
+    }
+
+    if( success == true )
+    {
+        /* GenerateJsonReport writes a terminating NULL after the report. */
+        operand.bufferLength = reportLength + 1U;
+        operand.pBuffer = malloc( operand.bufferLength );
+        success = ( operand.pBuffer != NULL );
+    }
+
+    if( success == true )
+    {
+        success = runBenchmark( "report", entryCount, generateReport, &operand, 0U );
+    }
+
+    free( operand.pBuffer );
+    free( pConnections );
+    free( pUdpPorts );
+    free( pTcpPorts );
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool benchShadow( uint32_t keyCount )
+{
+    bool success = true;
+    ShadowOperand_t operand;
+    char * pPayload = NULL;
+    size_t payloadSize = 0U;
+    size_t length = 0U;
+    uint32_t index = 0U;
+
+    ( void ) memset( &operand, 0x00, sizeof( operand ) );
+    payloadSize = ( ( size_t ) keyCount * SHADOW_BYTES_PER_KEY ) + 128U;
+    pPayload = malloc( payloadSize );
+    success = ( pPayload != NULL );
+
+    if( success == true )
+    {
+        /* A delta of the service has the metadata of each key after the
+         * state, which the extraction skips. */
+        length = ( size_t ) snprintf( pPayload, payloadSize, "{\"version\":12,\"timestamp\":1595437367,\"state\":{" );
+
+        for( index = 0U; index < keyCount; index++ )
+        {
+            length += ( size_t ) snprintf( &( pPayload[ length ] ), payloadSize - length,
+                                           "%s\"sensor%02u\":%u",
+                                           ( index == 0U ) ? "" : ",",
+                                           ( unsigned int ) index,
+                                           ( unsigned int ) ( index * 10U ) );
+        }
+
+        length += ( size_t ) snprintf( &( pPayload[ length ] ), payloadSize - length, "},\"metadata\":{" );
+
+        for( index = 0U; index < keyCount; index++ )
+        {
+            length += ( size_t ) snprintf( &( pPayload[ length ] ), payloadSize - length,
+                                           "%s\"sensor%02u\":{\"timestamp\":1595437367}",
+                                           ( index == 0U ) ? "" : ",",
+                                           ( unsigned int ) index );
+        }
+
+        length += ( size_t ) snprintf( &( pPayload[ length ] ), payloadSize - length,
+                                       "},\"clientToken\":\"388062\"}" );
+
+        operand.pPayload = pPayload;
+        operand.payloadLength = length;
+        operand.keyLength = ( size_t ) snprintf( operand.key, sizeof( operand.key ), "sensor%02u",
+                                                 ( unsigned int ) ( keyCount - 1U ) );
+
+        success = runBenchmark( "shadow delta", keyCount, applyDelta, &operand, 0U );
+    }
+
+    free( pPayload );
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool writeProcNetTcp( uint32_t socketCount )
+{
+    bool success = true;
+    FILE * pFile = NULL;
+    uint32_t index = 0U;
+    uint32_t port = 0U;
+
+    pFile = fopen( METRICS_COLLECTOR_PROC_NET_TCP_PATH, "w" );
+
+    if( pFile == NULL )
+    {
+        LogError( ( "Failed to open %s.", METRICS_COLLECTOR_PROC_NET_TCP_PATH ) );
+        success = false;
+    }
+    else
+    {
+        ( void ) fprintf( pFile,
+                          "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n" );
+
+        /* The even sockets listen on 0.0.0.0, and the odd ones are connected
+         * from 10.0.0.1 to 10.0.0.2:443. */
+        for( index = 0U; index < socketCount; index++ )
+        {
+            port = 1024U + ( index % 60000U );
+            ( void ) fprintf( pFile,
+                              "%4u: %08X:%04X %08X:%04X %02X 00000000:00000000 00:00000000 00000000  1000        0 %u 1 0000000000000000 100 0 0 10 0\n",
+                              ( unsigned int ) index,
+                              ( ( index % 2U ) == 0U ) ? 0U : 0x0100000AU,
+                              ( unsigned int ) port,
+                              ( ( index % 2U ) == 0U ) ? 0U : 0x0200000AU,
+                              ( ( index % 2U ) == 0U ) ? 0U : 443U,
+                              ( ( index % 2U ) == 0U ) ? 0x0AU : 0x01U,
+                              ( unsigned int ) ( 10000U + index ) );
+        }
+
+        if( fclose( pFile ) != 0 )
+        {
+            LogError( ( "Failed to write %s.", METRICS_COLLECTOR_PROC_NET_TCP_PATH ) );
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool benchPorts( uint32_t socketCount )
+{
+    bool success = true;
+    PortsOperand_t operand;
+
+    /* The arrays take every socket, so that the whole file is read. */
+    operand.entryCount = socketCount;
+    operand.pPorts = malloc( ( size_t ) socketCount * sizeof( uint16_t ) );
+    operand.pConnections = malloc( ( size_t ) socketCount * sizeof( Connection_t ) );
+    success = ( operand.pPorts != NULL ) && ( operand.pConnections != NULL ) &&
+              writeProcNetTcp( socketCount );
+
+    if( success == true )
+    {
+        success = runBenchmark( "open ports", socketCount, getOpenPorts, &operand, 0U );
+    }
+
+    if( success == true )
+    {
+        success = runBenchmark( "established connections", socketCount, getConnections, &operand, 0U );
+    }
+
+    free( operand.pConnections );
+    free( operand.pPorts );
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static EVP_PKEY * createSigner( void )
+{
+    EVP_PKEY * pKey = NULL;
+    EVP_PKEY_CTX * pKeyContext = NULL;
+    X509 * pCertificate = NULL;
+    X509_NAME * pName = NULL;
+    FILE * pFile = NULL;
+    bool success = false;
+
+    pKeyContext = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, NULL );
+    pCertificate = X509_new();
+
+    if( ( pKeyContext != NULL ) && ( pCertificate != NULL ) &&
+        ( EVP_PKEY_keygen_init( pKeyContext ) == 1 ) &&
+        ( EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pKeyContext, NID_X9_62_prime256v1 ) == 1 ) &&
+        ( EVP_PKEY_keygen( pKeyContext, &pKey ) == 1 ) )
+    {
+        pName = X509_get_subject_name( pCertificate );
+        success = ( X509_set_version( pCertificate, 2 ) == 1 ) &&
+                  ( ASN1_INTEGER_set( X509_get_serialNumber( pCertificate ), 1 ) == 1 ) &&
+                  ( X509_gmtime_adj( X509_getm_notBefore( pCertificate ), 0 ) != NULL ) &&
+                  ( X509_gmtime_adj( X509_getm_notAfter( pCertificate ), 86400L ) != NULL ) &&
+                  ( X509_NAME_add_entry_by_txt( pName, "CN", MBSTRING_ASC,
+                                                ( const unsigned char * ) "sdk_microbench", -1, -1, 0 ) == 1 ) &&
+                  ( X509_set_issuer_name( pCertificate, pName ) == 1 ) &&
+                  ( X509_set_pubkey( pCertificate, pKey ) == 1 ) &&
+                  ( X509_sign( pCertificate, pKey, EVP_sha256() ) > 0 );
+    }
+
+    if( success == true )
+    {
+        pFile = fopen( SDK_MICROBENCH_OTA_CERT_PATH, "w" );
+        success = ( pFile != NULL ) && ( PEM_write_X509( pFile, pCertificate ) == 1 );
+
+        if( ( pFile != NULL ) && ( fclose( pFile ) != 0 ) )
+        {
+            success = false;
+        }
+    }
+
+    if( success == false )
+    {
+        LogError( ( "Failed to create the signer certificate %s.", SDK_MICROBENCH_OTA_CERT_PATH ) );
+        EVP_PKEY_free( pKey );
+        pKey = NULL;
+    }
+
+    X509_free( pCertificate );
+    EVP_PKEY_CTX_free( pKeyContext );
+
+    return pKey;
+}
+
+/*-----------------------------------------------------------*/
+
+static void fillBlock( uint8_t * pBlock,
+                       uint32_t blockIndex )
+{
+    /* Only the first bytes differ from a block to the next, which is enough
+     * for the writes and the digest to take the time of any content. */
+    ( void ) memset( pBlock, 0xA5, otaconfigFILE_BLOCK_SIZE );
+    ( void ) memcpy( pBlock, &blockIndex, sizeof( blockIndex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool signImage( EVP_PKEY * pKey,
+                       uint32_t blockCount,
+                       Sig256_t * pSignature )
+{
+    bool success = false;
+    EVP_MD_CTX * pDigestContext = NULL;
+    static uint8_t block[ otaconfigFILE_BLOCK_SIZE ];
+    size_t signatureLength = sizeof( pSignature->data );
+    uint32_t index = 0U;
+
+    pDigestContext = EVP_MD_CTX_new();
+
+    if( ( pDigestContext != NULL ) &&
+        ( EVP_DigestSignInit( pDigestContext, NULL, EVP_sha256(), NULL, pKey ) == 1 ) )
+    {
+        success = true;
+
+        for( index = 0U; ( success == true ) && ( index < blockCount ); index++ )
+        {
+            fillBlock( block, index );
+            success = ( EVP_DigestSignUpdate( pDigestContext, block, sizeof( block ) ) == 1 );
+        }
+
+        success = success &&
+                  ( EVP_DigestSignFinal( pDigestContext, pSignature->data, &signatureLength ) == 1 );
+        pSignature->size = ( uint16_t ) signatureLength;
+    }
+
+    if( success == false )
+    {
+        LogError( ( "Failed to sign the image." ) );
+    }
+
+    EVP_MD_CTX_free( pDigestContext );
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool benchOta( EVP_PKEY * pKey,
+                      uint32_t sizeMb )
+{
+    bool success = true;
+    OtaFileContext_t fileContext;
+    static Sig256_t signature;
+    static uint8_t block[ otaconfigFILE_BLOCK_SIZE ];
+    uint32_t blockCount = ( uint32_t ) ( ( ( uint64_t ) sizeMb * BYTES_PER_MB ) / otaconfigFILE_BLOCK_SIZE );
+    uint32_t index = 0U;
+    uint64_t startAllocations = 0U;
+    uint64_t startNs = 0U;
+    uint64_t runNs = 0U;
+    uint64_t elapsedNs = 0U;
+    int16_t written = 0;
+
+    ( void ) memset( &fileContext, 0x00, sizeof( fileContext ) );
+    fileContext.pFilePath = ( uint8_t * ) SDK_MICROBENCH_OTA_IMAGE_PATH;
+    fileContext.filePathMaxSize = ( uint16_t ) sizeof( SDK_MICROBENCH_OTA_IMAGE_PATH );
+    fileContext.pCertFilepath = ( uint8_t * ) SDK_MICROBENCH_OTA_CERT_PATH;
+    fileContext.certFilePathMaxSize = ( uint16_t ) sizeof( SDK_MICROBENCH_OTA_CERT_PATH );
+    fileContext.fileSize = blockCount * otaconfigFILE_BLOCK_SIZE;
+    fileContext.pSignature = &signature;
+
+    success = signImage( pKey, blockCount, &signature ) &&
+              ( OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &fileContext ) ) == OtaPalSuccess );
+
+    if( success == true )
+    {
+        /* The blocks are written in order, each one once, as they are when
+         * no block is lost. */
+        LatencyHistogram_Init( &latencyNs );
+        startAllocations = allocationCount;
+
+        for( index = 0U; ( success == true ) && ( index < blockCount ); index++ )
+        {
+            fillBlock( block, index );
+            startNs = Clock_GetTimeNs();
+            written = otaPal_WriteBlock( &fileContext,
+                                         ( uint32_t ) ( index * otaconfigFILE_BLOCK_SIZE ),
+                                         block,
+                                         ( uint32_t ) otaconfigFILE_BLOCK_SIZE );
+            runNs = Clock_GetTimeNs() - startNs;
+            LatencyHistogram_Record( &latencyNs, ( runNs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) runNs );
+            elapsedNs += runNs;
+            success = ( written == ( int16_t ) otaconfigFILE_BLOCK_SIZE );
+        }
+
+        if( success == true )
+        {
+            printResult( "ota write block", sizeMb, blockCount, elapsedNs,
+                         allocationCount - startAllocations, otaconfigFILE_BLOCK_SIZE );
+        }
+        else
+        {
+            LogError( ( "Failed to write block %u.", ( unsigned int ) ( index - 1U ) ) );
+        }
+
+        /* The file is closed even if a write failed, which fails its
+         * verification. */
+        LatencyHistogram_Init( &latencyNs );
+        startAllocations = allocationCount;
+        startNs = Clock_GetTimeNs();
+        success = ( OTA_PAL_MAIN_ERR( otaPal_CloseFile( &fileContext ) ) == OtaPalSuccess ) && success;
+        runNs = Clock_GetTimeNs() - startNs;
+        LatencyHistogram_Record( &latencyNs, ( runNs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) runNs );
+
+        if( success == true )
+        {
+            printResult( "ota verify signature", sizeMb, 1U, runNs,
+                         allocationCount - startAllocations, fileContext.fileSize );
+        }
+        else
+        {
+            printf( "  %-*s %7u failed.\n", ( int ) NAME_MAX_LENGTH, "ota", ( unsigned int ) sizeMb );
+        }
+
+        ( void ) unlink( SDK_MICROBENCH_OTA_IMAGE_PATH );
+    }
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool replayMqtt( void * pOperand )
+{
+    ReplayOperand_t * pReplay = ( ReplayOperand_t * ) pOperand;
+    MQTTStatus_t status = MQTTSuccess;
+    MQTTPacketInfo_t packetInfo;
+    MQTTPublishInfo_t publishInfo;
+    uint16_t packetId = 0U;
+    bool sessionPresent = false;
+    size_t receivedLength = 0U;
+    int32_t bytesReceived = 0;
+
+    ( void ) ReplayTransport_Rewind( pReplay->pNetworkContext );
+    pReplay->messageCount = 0U;
+
+    while( ( status == MQTTSuccess ) && ( ReplayTransport_IsFinished( pReplay->pNetworkContext ) == false ) )
+    {
+        ( void ) memset( &packetInfo, 0x00, sizeof( packetInfo ) );
+        status = MQTT_GetIncomingPacketTypeAndLength( ReplayTransport_Recv, pReplay->pNetworkContext, &packetInfo );
+
+        if( ( status == MQTTSuccess ) && ( packetInfo.remainingLength > pReplay->bufferLength ) )
+        {
+            status = MQTTNoMemory;
+        }
+
+        /* The replay returns the bytes of a packet in the pieces they were
+         * received in. */
+        for( receivedLength = 0U;
+             ( status == MQTTSuccess ) && ( receivedLength < packetInfo.remainingLength );
+             receivedLength += ( size_t ) bytesReceived )
+        {
+            bytesReceived = ReplayTransport_Recv( pReplay->pNetworkContext,
+                                                  &( pReplay->pBuffer[ receivedLength ] ),
+                                                  packetInfo.remainingLength - receivedLength );
+
+            if( bytesReceived <= 0 )
+            {
+                status = MQTTRecvFailed;
+                bytesReceived = 0;
+            }
+        }
+
+        if( status == MQTTSuccess )
+        {
+            packetInfo.pRemainingData = pReplay->pBuffer;
+
+            if( ( packetInfo.type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+            {
+                status = MQTT_DeserializePublish( &packetInfo, &packetId, &publishInfo );
+
+                if( status == MQTTSuccess )
+                {
+                    SubscriptionManager_DispatchHandler( pReplay->pContext, &publishInfo );
+                }
+            }
+            else
+            {
+                status = MQTT_DeserializeAck( &packetInfo, &packetId, &sessionPresent );
+            }
+
+            pReplay->messageCount++;
+        }
+    }
+
+    return( status == MQTTSuccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool replayHttp( void * pOperand )
+{
+    ReplayOperand_t * pReplay = ( ReplayOperand_t * ) pOperand;
+    HTTPStatus_t status = HTTPSuccess;
+    TransportInterface_t transport;
+    HTTPResponse_t response;
+
+    ( void ) ReplayTransport_Rewind( pReplay->pNetworkContext );
+    pReplay->messageCount = 0U;
+    transport.recv = ReplayTransport_Recv;
+    transport.send = ReplayTransport_Send;
+    transport.pNetworkContext = pReplay->pNetworkContext;
+
+    while( ( status == HTTPSuccess ) && ( ReplayTransport_IsFinished( pReplay->pNetworkContext ) == false ) )
+    {
+        ( void ) memset( &response, 0x00, sizeof( response ) );
+        response.pBuffer = pReplay->pBuffer;
+        response.bufferLen = pReplay->bufferLength;
+
+        /* The request sent is the same for all the responses, so that its
+         * headers are not appended to. */
+        status = HTTPClient_Send( &transport,
+                                  &( pReplay->requestHeaders ),
+                                  NULL,
+                                  0U,
+                                  &response,
+                                  HTTP_SEND_DISABLE_CONTENT_LENGTH_FLAG );
+        pReplay->messageCount++;
+    }
+
+    return( status == HTTPSuccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool readCapture( const char * pPath,
+                         uint8_t ** ppCapture,
+                         size_t * pCaptureLength )
+{
+    bool success = false;
+    FILE * pFile = fopen( pPath, "rb" );
+    long fileLength = -1;
+
+    *ppCapture = NULL;
+
+    if( pFile == NULL )
+    {
+        LogError( ( "Failed to open the capture %s.", pPath ) );
+    }
+    else
+    {
+        if( fseek( pFile, 0L, SEEK_END ) == 0 )
+        {
+            fileLength = ftell( pFile );
+            rewind( pFile );
+        }
+
+        if( fileLength > 0L )
+        {
+            *ppCapture = malloc( ( size_t ) fileLength );
+        }
+
+        if( ( *ppCapture != NULL ) &&
+            ( fread( *ppCapture, 1U, ( size_t ) fileLength, pFile ) == ( size_t ) fileLength ) )
+        {
+            *pCaptureLength = ( size_t ) fileLength;
+            success = true;
+        }
+        else
+        {
+            LogError( ( "Failed to read the capture %s.", pPath ) );
+            free( *ppCapture );
+            *ppCapture = NULL;
+        }
+
+        ( void ) fclose( pFile );
+    }
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool benchReplay( const char * pPath )
+{
+    bool success = true;
+    static MQTTContext_t context;
+    static uint8_t requestBuffer[ REPLAY_REQUEST_BUFFER_SIZE ];
+    ReplayTransportParams_t replayParams;
+    NetworkContext_t networkContext;
+    ReplayOperand_t operand;
+    HTTPRequestInfo_t requestInfo;
+    BenchOperation_t operation = replayMqtt;
+    const char * pName = "replay mqtt";
+    uint8_t * pCapture = NULL;
+    size_t captureLength = 0U;
+    uint8_t firstByte = 0U;
+    bool registered = false;
+
+    ( void ) memset( &operand, 0x00, sizeof( operand ) );
+    networkContext.pParams = &replayParams;
+    success = readCapture( pPath, &pCapture, &captureLength ) &&
+              ( ReplayTransport_Init( &networkContext, pCapture, captureLength,
+                                      REPLAY_TRANSPORT_MAX_SPEED ) == CAPTURE_TRANSPORT_SUCCESS );
+
+    if( success == true )
+    {
+        /* A response of HTTP/1.1 starts with its version, and the first
+         * packet received by MQTT is a CONNACK. */
+        if( ( ReplayTransport_Recv( &networkContext, &firstByte, 1U ) == 1 ) && ( firstByte == ( uint8_t ) 'H' ) )
+        {
+            operation = replayHttp;
+            pName = "replay http";
+        }
+
+        operand.pNetworkContext = &networkContext;
+        operand.pContext = &context;
+        operand.bufferLength = replayParams.recvLength;
+        operand.pBuffer = malloc( ( operand.bufferLength > 0U ) ? operand.bufferLength : 1U );
+        success = ( operand.pBuffer != NULL );
+    }
+
+    if( ( success == true ) && ( operation == replayHttp ) )
+    {
+        ( void ) memset( &requestInfo, 0x00, sizeof( requestInfo ) );
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1U;
+        requestInfo.pPath = "/";
+        requestInfo.pathLen = 1U;
+        requestInfo.pHost = "replay";
+        requestInfo.hostLen = sizeof( "replay" ) - 1U;
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+        operand.requestHeaders.pBuffer = requestBuffer;
+        operand.requestHeaders.bufferLen = sizeof( requestBuffer );
+        success = ( HTTPClient_InitializeRequestHeaders( &( operand.requestHeaders ), &requestInfo ) == HTTPSuccess );
+    }
+    else if( success == true )
+    {
+        registered = ( SubscriptionManager_RegisterCallback( REPLAY_TOPIC_FILTER,
+                                                             ( uint16_t ) ( sizeof( REPLAY_TOPIC_FILTER ) - 1U ),
+                                                             dispatchCallback ) == SUBSCRIPTION_MANAGER_SUCCESS );
+        success = registered;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( success == true )
+    {
+        /* A first run counts the messages of the capture, printed as the size
+         * of the benchmark. */
+        printf( "  %s:\n", pPath );
+        success = operation( &operand );
+
+        if( success == false )
+        {
+            LogError( ( "The replay of %s failed after %u messages.",
+                        pPath, ( unsigned int ) operand.messageCount ) );
+        }
+    }
+
+    if( success == true )
+    {
+        success = runBenchmark( pName, operand.messageCount, operation, &operand, replayParams.recvLength );
+    }
+
+    if( registered == true )
+    {
+        SubscriptionManager_RemoveCallback( REPLAY_TOPIC_FILTER, ( uint16_t ) ( sizeof( REPLAY_TOPIC_FILTER ) - 1U ) );
+    }
+
+    free( operand.pBuffer );
+    free( pCapture );
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char * argv[] )
+{
+    int returnStatus = EXIT_SUCCESS;
+    static const uint32_t shadowKeyCounts[] = SHADOW_KEY_COUNTS;
+    EVP_PKEY * pKey = NULL;
+    uint32_t index = 0U;
+    bool success = true;
+
+    if( parseArgs( &benchConfig, argc, argv ) == false )
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        printf( "\nEach operation runs %u times or for %u s, whichever comes first.\n"
+                "The times include reading the clock around each run.\n\n",
+                ( unsigned int ) benchConfig.iterations,
+                ( unsigned int ) benchConfig.durationSec );
+        printf( "  %-*s %7s\n", ( int ) NAME_MAX_LENGTH, "benchmark", "size" );
+
+        if( ( benchConfig.tests & TEST_DISPATCH ) != 0U )
+        {
+            for( index = 0U; index < benchConfig.entryCountsLength; index++ )
+            {
+                success = benchDispatch( benchConfig.entryCounts[ index ] ) && success;
+            }
+        }
+
+        if( ( benchConfig.tests & TEST_REPORT ) != 0U )
+        {
+            for( index = 0U; index < benchConfig.entryCountsLength; index++ )
+            {
+                success = benchReport( benchConfig.entryCounts[ index ] ) && success;
+            }
+        }
+
+        if( ( benchConfig.tests & TEST_SHADOW ) != 0U )
+        {
+            for( index = 0U; index < ( sizeof( shadowKeyCounts ) / sizeof( shadowKeyCounts[ 0 ] ) ); index++ )
+            {
+                success = benchShadow( shadowKeyCounts[ index ] ) && success;
+            }
+        }
+
+        if( ( benchConfig.tests & TEST_PORTS ) != 0U )
+        {
+            for( index = 0U; index < benchConfig.entryCountsLength; index++ )
+            {
+                success = benchPorts( benchConfig.entryCounts[ index ] ) && success;
+            }
+
+            ( void ) unlink( METRICS_COLLECTOR_PROC_NET_TCP_PATH );
+        }
+
+        if( ( benchConfig.tests & TEST_OTA ) != 0U )
+        {
+            pKey = createSigner();
+            success = ( pKey != NULL ) && success;
+
+            for( index = 0U; ( pKey != NULL ) && ( index < benchConfig.imageSizesMbLength ); index++ )
+            {
+                success = benchOta( pKey, benchConfig.imageSizesMb[ index ] ) && success;
+            }
+
+            EVP_PKEY_free( pKey );
+            ( void ) unlink( SDK_MICROBENCH_OTA_CERT_PATH );
+        }
+
+        if( ( benchConfig.tests & TEST_REPLAY ) != 0U )
+        {
+            for( index = 0U; index < benchConfig.capturePathsLength; index++ )
+            {
+                success = benchReplay( benchConfig.pCapturePaths[ index ] ) && success;
+            }
+        }
+
+        if( success == false )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    return returnStatus;
+}
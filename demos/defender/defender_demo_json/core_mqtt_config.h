@@ -75,4 +75,11 @@
  */
 #define MQTT_PINGRESP_TIMEOUT_MS      ( 5000U )
 
+/**
+ * @brief Bind the TLS transport of the MQTT connection at compile time, so
+ * that the reads of the packet headers from its read-ahead buffer are
+ * inlined. See mqtt_connection.h.
+ */
+#define MQTT_TRANSPORT_STATIC_BINDING    ( 1 )
+
 #endif /* ifndef CORE_MQTT_CONFIG_H_ */
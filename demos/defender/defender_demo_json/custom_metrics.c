@@ -0,0 +1,501 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Demo config. */
+#include "demo_config.h"
+
+/* Interface include. */
+#include "custom_metrics.h"
+
+/**
+ * @brief Percentiles of #CUSTOM_METRIC_STAT_P50, #CUSTOM_METRIC_STAT_P90 and
+ * #CUSTOM_METRIC_STAT_P99.
+ */
+#define PERCENTILE_P50           ( 50U )
+#define PERCENTILE_P90           ( 90U )
+#define PERCENTILE_P99           ( 99U )
+
+/**
+ * @brief Index of a statistic in #CustomMetricStats_t.values.
+ */
+#define STAT_INDEX_MIN           ( 0U )
+#define STAT_INDEX_MAX           ( 1U )
+#define STAT_INDEX_AVG           ( 2U )
+#define STAT_INDEX_P50           ( 3U )
+#define STAT_INDEX_P90           ( 4U )
+#define STAT_INDEX_P99           ( 5U )
+#define STAT_INDEX_SAMPLES       ( 6U )
+
+/**
+ * @brief All the statistics of a custom metric.
+ */
+#define CUSTOM_METRIC_STAT_ALL    ( ( 1U << CUSTOM_METRIC_STATISTICS ) - 1U )
+
+/**
+ * @brief The metrics registered.
+ */
+static CustomMetric_t * registeredMetrics[ CUSTOM_METRICS_MAX_COUNT ];
+
+/**
+ * @brief Number of entries of #registeredMetrics.
+ */
+static uint32_t registeredMetricCount = 0U;
+
+/**
+ * @brief Samples of a metric, sorted for the percentiles.
+ */
+static uint32_t sortedSamples[ CUSTOM_METRICS_RING_SIZE ];
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Check that the name of a custom metric is valid.
+ *
+ * @param[in] pName The name.
+ * @param[in] nameLength Length of @p pName.
+ *
+ * @return true if the name is valid; false otherwise.
+ */
+static bool isValidName( const char * pName,
+                         size_t nameLength );
+
+/**
+ * @brief Copy the samples of a metric recorded since the previous aggregation.
+ *
+ * @param[in] pMetric The metric.
+ * @param[out] pOutSamples Array of #CUSTOM_METRICS_RING_SIZE entries to copy the
+ * samples into.
+ * @param[out] pOutNewestSequence Sequence number of the newest sample copied.
+ * @param[out] pOutRecordedCount Number of samples recorded since the previous
+ * aggregation, including those overwritten.
+ *
+ * @return Number of samples copied.
+ */
+static uint32_t collectSamples( const CustomMetric_t * pMetric,
+                                uint32_t * pOutSamples,
+                                uint32_t * pOutNewestSequence,
+                                uint32_t * pOutRecordedCount );
+
+/**
+ * @brief Compare two samples, for qsort.
+ */
+static int compareSamples( const void * pFirst,
+                           const void * pSecond );
+
+/**
+ * @brief Compute the statistics of sorted samples.
+ *
+ * @param[in] pSamples The samples, sorted.
+ * @param[in] sampleCount Number of samples, at least 1.
+ * @param[out] pOutStats The statistics, with all the values set.
+ */
+static void computeStatistics( const uint32_t * pSamples,
+                               uint32_t sampleCount,
+                               CustomMetricStats_t * pOutStats );
+
+/**
+ * @brief Saturate a value of the metrics registry to 32 bits.
+ *
+ * @param[in] value The value.
+ *
+ * @return @p value, or UINT32_MAX if it is larger.
+ */
+static uint32_t saturate( uint64_t value );
+
+/**
+ * @brief Get a percentile of a histogram of the metrics registry, as the
+ * largest value of the bucket it falls in.
+ *
+ * @param[in] pSample The histogram, with at least 1 value.
+ * @param[in] percentile The percentile, from 1 to 100.
+ *
+ * @return The largest value of the bucket of the percentile.
+ */
+static uint32_t getHistogramPercentile( const MetricsSample_t * pSample,
+                                        uint32_t percentile );
+
+/**
+ * @brief Get a percentile of sorted samples, by the nearest rank.
+ *
+ * @param[in] pSamples The samples, sorted.
+ * @param[in] sampleCount Number of samples, at least 1.
+ * @param[in] percentile The percentile, from 1 to 100.
+ *
+ * @return The smallest sample no smaller than @p percentile percent of them.
+ */
+static uint32_t getPercentile( const uint32_t * pSamples,
+                               uint32_t sampleCount,
+                               uint32_t percentile );
+/*-----------------------------------------------------------*/
+
+static bool isValidName( const char * pName,
+                         size_t nameLength )
+{
+    bool status = ( nameLength > 0U ) && ( nameLength <= CUSTOM_METRIC_NAME_MAX_LENGTH );
+    size_t i;
+    char c;
+
+    for( i = 0U; ( status == true ) && ( i < nameLength ); i++ )
+    {
+        c = pName[ i ];
+
+        /* The names are written in the report without escaping. */
+        status = ( ( c >= 'a' ) && ( c <= 'z' ) ) ||
+                 ( ( c >= 'A' ) && ( c <= 'Z' ) ) ||
+                 ( ( c >= '0' ) && ( c <= '9' ) ) ||
+                 ( c == '_' ) || ( c == '-' ) || ( c == ':' );
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t collectSamples( const CustomMetric_t * pMetric,
+                                uint32_t * pOutSamples,
+                                uint32_t * pOutNewestSequence,
+                                uint32_t * pOutRecordedCount )
+{
+    uint32_t i, count = 0U, sequence, age, newestAge = 0U;
+    uint64_t sample;
+
+    /* A sample is new if its sequence number is after the last one
+     * aggregated. The difference wraps around, so a sample from before is
+     * more than half the range away. */
+    for( i = 0U; i < CUSTOM_METRICS_RING_SIZE; i++ )
+    {
+        sample = __atomic_load_n( &( pMetric->samples[ i ] ), __ATOMIC_ACQUIRE );
+        sequence = ( uint32_t ) ( sample >> 32 );
+        age = sequence - pMetric->readSequence;
+
+        if( ( sequence != 0U ) && ( age != 0U ) && ( age <= ( UINT32_MAX / 2U ) ) )
+        {
+            pOutSamples[ count ] = ( uint32_t ) sample;
+            count++;
+
+            if( age > newestAge )
+            {
+                newestAge = age;
+                *pOutNewestSequence = sequence;
+            }
+        }
+    }
+
+    /* The sequence numbers skip 0, so the count may be one too many after a
+     * wrap around. */
+    *pOutRecordedCount = ( newestAge > count ) ? newestAge : count;
+
+    return count;
+}
+/*-----------------------------------------------------------*/
+
+static int compareSamples( const void * pFirst,
+                           const void * pSecond )
+{
+    uint32_t first = *( ( const uint32_t * ) pFirst );
+    uint32_t second = *( ( const uint32_t * ) pSecond );
+
+    return ( first > second ) - ( first < second );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t getPercentile( const uint32_t * pSamples,
+                               uint32_t sampleCount,
+                               uint32_t percentile )
+{
+    /* The rank is the percentile of the count, rounded up. */
+    uint32_t rank = ( uint32_t ) ( ( ( ( uint64_t ) percentile * sampleCount ) + 99U ) / 100U );
+
+    return pSamples[ rank - 1U ];
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t saturate( uint64_t value )
+{
+    return ( value > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) value;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t getHistogramPercentile( const MetricsSample_t * pSample,
+                                        uint32_t percentile )
+{
+    /* The rank is the percentile of the count, rounded up, as for the
+     * samples of a custom metric. */
+    uint64_t rank = ( ( ( uint64_t ) percentile * pSample->count ) + 99U ) / 100U;
+    uint64_t cumulative = 0U;
+    uint32_t bucket = 0U;
+
+    cumulative = pSample->buckets[ 0 ];
+
+    while( ( cumulative < rank ) && ( bucket < ( METRICS_HISTOGRAM_BUCKETS - 1U ) ) )
+    {
+        bucket++;
+        cumulative += pSample->buckets[ bucket ];
+    }
+
+    /* The last bucket has no bound. */
+    return ( bucket == ( METRICS_HISTOGRAM_BUCKETS - 1U ) ) ? UINT32_MAX :
+           ( ( ( uint32_t ) 2U << bucket ) - 1U );
+}
+/*-----------------------------------------------------------*/
+
+static void computeStatistics( const uint32_t * pSamples,
+                               uint32_t sampleCount,
+                               CustomMetricStats_t * pOutStats )
+{
+    uint64_t sum = 0U;
+    uint32_t i;
+
+    for( i = 0U; i < sampleCount; i++ )
+    {
+        sum += pSamples[ i ];
+    }
+
+    pOutStats->values[ STAT_INDEX_MIN ] = pSamples[ 0 ];
+    pOutStats->values[ STAT_INDEX_MAX ] = pSamples[ sampleCount - 1U ];
+    pOutStats->values[ STAT_INDEX_AVG ] = ( uint32_t ) ( ( sum + ( sampleCount / 2U ) ) / sampleCount );
+    pOutStats->values[ STAT_INDEX_P50 ] = getPercentile( pSamples, sampleCount, PERCENTILE_P50 );
+    pOutStats->values[ STAT_INDEX_P90 ] = getPercentile( pSamples, sampleCount, PERCENTILE_P90 );
+    pOutStats->values[ STAT_INDEX_P99 ] = getPercentile( pSamples, sampleCount, PERCENTILE_P99 );
+    pOutStats->values[ STAT_INDEX_SAMPLES ] = sampleCount;
+}
+/*-----------------------------------------------------------*/
+
+CustomMetricsStatus_t RegisterCustomMetric( CustomMetric_t * pMetric,
+                                            const char * pName,
+                                            size_t nameLength,
+                                            uint32_t statistics )
+{
+    CustomMetricsStatus_t status = CustomMetricsSuccess;
+    uint32_t i;
+
+    if( ( pMetric == NULL ) ||
+        ( pName == NULL ) ||
+        ( isValidName( pName, nameLength ) == false ) ||
+        ( statistics == 0U ) ||
+        ( ( statistics & ~CUSTOM_METRIC_STAT_ALL ) != 0U ) )
+    {
+        LogError( ( "Invalid parameters. pMetric: %p, pName: %p, nameLength: %u, statistics: 0x%x.",
+                    ( void * ) pMetric,
+                    ( const void * ) pName,
+                    ( unsigned int ) nameLength,
+                    ( unsigned int ) statistics ) );
+        status = CustomMetricsBadParameter;
+    }
+    else if( registeredMetricCount == CUSTOM_METRICS_MAX_COUNT )
+    {
+        LogError( ( "Cannot register more than %u custom metrics.",
+                    ( unsigned int ) CUSTOM_METRICS_MAX_COUNT ) );
+        status = CustomMetricsNoSpace;
+    }
+    else
+    {
+        pMetric->pName = pName;
+        pMetric->nameLength = nameLength;
+        pMetric->statistics = statistics;
+        pMetric->readSequence = 0U;
+        pMetric->writeSequence = 0U;
+
+        for( i = 0U; i < CUSTOM_METRICS_RING_SIZE; i++ )
+        {
+            pMetric->samples[ i ] = 0U;
+        }
+
+        registeredMetrics[ registeredMetricCount ] = pMetric;
+        registeredMetricCount++;
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+void RecordCustomMetricSample( CustomMetric_t * pMetric,
+                               uint32_t value )
+{
+    /* Sequence number 0 marks an empty entry, so it is skipped. */
+    uint32_t sequence = pMetric->writeSequence + 1U;
+
+    if( sequence == 0U )
+    {
+        sequence = 1U;
+    }
+
+    pMetric->writeSequence = sequence;
+
+    /* The value and its sequence number are stored at once, so the
+     * aggregation never reads one without the other. */
+    __atomic_store_n( &( pMetric->samples[ sequence & ( CUSTOM_METRICS_RING_SIZE - 1U ) ] ),
+                      ( ( ( uint64_t ) sequence ) << 32 ) | value,
+                      __ATOMIC_RELEASE );
+}
+/*-----------------------------------------------------------*/
+
+CustomMetricsStatus_t AggregateCustomMetrics( CustomMetricStats_t * pOutStatsArray,
+                                              uint32_t statsArrayLength,
+                                              uint32_t * pOutNumStats )
+{
+    CustomMetricsStatus_t status = CustomMetricsSuccess;
+    uint32_t i, count, newestSequence = 0U, recordedCount = 0U, numStats = 0U;
+    CustomMetric_t * pMetric;
+    CustomMetricStats_t * pStats;
+
+    if( ( pOutStatsArray == NULL ) || ( pOutNumStats == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pOutStatsArray: %p, pOutNumStats: %p.",
+                    ( void * ) pOutStatsArray,
+                    ( void * ) pOutNumStats ) );
+        status = CustomMetricsBadParameter;
+    }
+
+    for( i = 0U; ( status != CustomMetricsBadParameter ) && ( i < registeredMetricCount ); i++ )
+    {
+        pMetric = registeredMetrics[ i ];
+        count = collectSamples( pMetric, &( sortedSamples[ 0 ] ), &( newestSequence ), &( recordedCount ) );
+
+        if( count == 0U )
+        {
+            /* Nothing to report for this metric. */
+        }
+        else if( numStats == statsArrayLength )
+        {
+            /* The samples are kept for the next aggregation. */
+            status = CustomMetricsNoSpace;
+        }
+        else
+        {
+            pStats = &( pOutStatsArray[ numStats ] );
+            numStats++;
+
+            qsort( &( sortedSamples[ 0 ] ), count, sizeof( uint32_t ), compareSamples );
+
+            pStats->pName = pMetric->pName;
+            pStats->nameLength = pMetric->nameLength;
+            pStats->statistics = pMetric->statistics;
+            pStats->sampleCount = count;
+            pStats->droppedCount = recordedCount - count;
+            computeStatistics( &( sortedSamples[ 0 ] ), count, pStats );
+
+            pMetric->readSequence = newestSequence;
+        }
+    }
+
+    if( status == CustomMetricsNoSpace )
+    {
+        LogError( ( "The statistics of %u custom metrics do not fit in %u entries.",
+                    ( unsigned int ) registeredMetricCount,
+                    ( unsigned int ) statsArrayLength ) );
+    }
+
+    if( status != CustomMetricsBadParameter )
+    {
+        *pOutNumStats = numStats;
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+CustomMetricsStatus_t AddRegistryMetrics( const MetricsSample_t * pSamples,
+                                          size_t sampleCount,
+                                          CustomMetricStats_t * pOutStatsArray,
+                                          uint32_t statsArrayLength,
+                                          uint32_t * pNumStats )
+{
+    CustomMetricsStatus_t status = CustomMetricsSuccess;
+    const MetricsSample_t * pSample;
+    CustomMetricStats_t * pStats;
+    uint32_t numStats = 0U;
+    size_t i;
+
+    if( ( pSamples == NULL ) || ( pOutStatsArray == NULL ) || ( pNumStats == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pSamples: %p, pOutStatsArray: %p, pNumStats: %p.",
+                    ( const void * ) pSamples,
+                    ( void * ) pOutStatsArray,
+                    ( void * ) pNumStats ) );
+        status = CustomMetricsBadParameter;
+    }
+    else
+    {
+        numStats = *pNumStats;
+    }
+
+    for( i = 0U; ( status == CustomMetricsSuccess ) && ( i < sampleCount ); i++ )
+    {
+        pSample = &( pSamples[ i ] );
+
+        if( ( pSample->type == METRICS_TYPE_HISTOGRAM ) && ( pSample->count == 0U ) )
+        {
+            /* Nothing to report for this histogram. */
+        }
+        else if( numStats >= statsArrayLength )
+        {
+            LogError( ( "The %u metrics of the SDK do not fit in %u entries.",
+                        ( unsigned int ) sampleCount,
+                        ( unsigned int ) statsArrayLength ) );
+            status = CustomMetricsNoSpace;
+        }
+        else
+        {
+            pStats = &( pOutStatsArray[ numStats ] );
+            numStats++;
+
+            ( void ) memset( pStats, 0, sizeof( CustomMetricStats_t ) );
+            pStats->pName = pSample->pName;
+            pStats->nameLength = strlen( pSample->pName );
+
+            if( pSample->type == METRICS_TYPE_COUNTER )
+            {
+                pStats->statistics = CUSTOM_METRIC_STAT_SAMPLES;
+                pStats->values[ STAT_INDEX_SAMPLES ] = saturate( pSample->counter );
+            }
+            else if( pSample->type == METRICS_TYPE_GAUGE )
+            {
+                pStats->statistics = CUSTOM_METRIC_STAT_MAX;
+                pStats->values[ STAT_INDEX_MAX ] = ( pSample->gauge > 0 ) ? saturate( ( uint64_t ) pSample->gauge ) : 0U;
+            }
+            else
+            {
+                pStats->statistics = CUSTOM_METRIC_STAT_AVG | CUSTOM_METRIC_STAT_P50 |
+                                     CUSTOM_METRIC_STAT_P90 | CUSTOM_METRIC_STAT_P99 |
+                                     CUSTOM_METRIC_STAT_SAMPLES;
+                pStats->values[ STAT_INDEX_AVG ] = saturate( ( pSample->sum + ( pSample->count / 2U ) ) / pSample->count );
+                pStats->values[ STAT_INDEX_P50 ] = getHistogramPercentile( pSample, PERCENTILE_P50 );
+                pStats->values[ STAT_INDEX_P90 ] = getHistogramPercentile( pSample, PERCENTILE_P90 );
+                pStats->values[ STAT_INDEX_P99 ] = getHistogramPercentile( pSample, PERCENTILE_P99 );
+                pStats->values[ STAT_INDEX_SAMPLES ] = saturate( pSample->count );
+                pStats->sampleCount = pStats->values[ STAT_INDEX_SAMPLES ];
+            }
+        }
+    }
+
+    if( status != CustomMetricsBadParameter )
+    {
+        *pNumStats = numStats;
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,204 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CUSTOM_METRICS_H_
+#define CUSTOM_METRICS_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* SDK metrics registry, whose metrics may be added to the report. */
+#include "metrics.h"
+
+/**
+ * @brief Number of samples each custom metric keeps between two aggregations.
+ *
+ * Older samples are overwritten, and counted as dropped by
+ * #AggregateCustomMetrics. This must be a power of 2.
+ */
+#ifndef CUSTOM_METRICS_RING_SIZE
+    #define CUSTOM_METRICS_RING_SIZE    ( 64U )
+#endif
+
+#if ( ( CUSTOM_METRICS_RING_SIZE & ( CUSTOM_METRICS_RING_SIZE - 1U ) ) != 0U )
+    #error "CUSTOM_METRICS_RING_SIZE must be a power of 2."
+#endif
+
+/**
+ * @brief Maximum number of custom metrics registered.
+ */
+#ifndef CUSTOM_METRICS_MAX_COUNT
+    #define CUSTOM_METRICS_MAX_COUNT    ( 8U )
+#endif
+
+/**
+ * @brief Maximum length of the name of a custom metric.
+ *
+ * The service allows names of 128 characters, and the report adds the suffix
+ * of the statistic, such as "_p99", to the name.
+ */
+#define CUSTOM_METRIC_NAME_MAX_LENGTH    ( 120U )
+
+/**
+ * @brief Statistics reported for a custom metric, for the statistics of
+ * #RegisterCustomMetric. The bit position of each is its index in
+ * #CustomMetricStats_t.values.
+ */
+#define CUSTOM_METRIC_STAT_MIN        ( 1U << 0 ) /**< Smallest sample, reported as "<name>_min". */
+#define CUSTOM_METRIC_STAT_MAX        ( 1U << 1 ) /**< Largest sample, reported as "<name>_max". */
+#define CUSTOM_METRIC_STAT_AVG        ( 1U << 2 ) /**< Rounded mean of the samples, reported as "<name>_avg". */
+#define CUSTOM_METRIC_STAT_P50        ( 1U << 3 ) /**< Median, reported as "<name>_p50". */
+#define CUSTOM_METRIC_STAT_P90        ( 1U << 4 ) /**< 90th percentile, reported as "<name>_p90". */
+#define CUSTOM_METRIC_STAT_P99        ( 1U << 5 ) /**< 99th percentile, reported as "<name>_p99". */
+#define CUSTOM_METRIC_STAT_SAMPLES    ( 1U << 6 ) /**< Number of samples, reported as "<name>_samples". */
+
+/**
+ * @brief Number of statistics of a custom metric.
+ */
+#define CUSTOM_METRIC_STATISTICS      ( 7U )
+
+/**
+ * @brief Return codes from custom metrics APIs.
+ */
+typedef enum
+{
+    CustomMetricsSuccess = 0,
+    CustomMetricsBadParameter,
+    CustomMetricsNoSpace
+} CustomMetricsStatus_t;
+
+/**
+ * @brief A custom metric, sampled by the application.
+ *
+ * The application provides the memory of the metric, which must remain valid
+ * once registered. Each metric is sampled by a single thread at a time, which
+ * needs no lock: a sample is a single atomic store of the value with its
+ * sequence number into a ring of #CUSTOM_METRICS_RING_SIZE entries.
+ * #AggregateCustomMetrics tells the new samples from the sequence numbers.
+ * The members are managed by the custom metrics functions.
+ */
+typedef struct CustomMetric
+{
+    const char * pName;                           /**< Name of the metric. */
+    size_t nameLength;                            /**< Length of pName. */
+    uint32_t statistics;                          /**< CUSTOM_METRIC_STAT_* reported. */
+    uint32_t readSequence;                        /**< Sequence number of the last sample aggregated. */
+    uint64_t samples[ CUSTOM_METRICS_RING_SIZE ]; /**< Samples, with their sequence number in the upper 32 bits. */
+    uint32_t writeSequence;                       /**< Sequence number of the last sample, owned by the sampling thread. */
+} CustomMetric_t;
+
+/**
+ * @brief Statistics of the samples of a custom metric since the previous
+ * aggregation.
+ */
+typedef struct CustomMetricStats
+{
+    const char * pName;                           /**< Name of the metric. */
+    size_t nameLength;                            /**< Length of pName. */
+    uint32_t statistics;                          /**< CUSTOM_METRIC_STAT_* reported. */
+    uint32_t sampleCount;                         /**< Number of samples aggregated. */
+    uint32_t droppedCount;                        /**< Number of samples overwritten before they were aggregated. */
+    uint32_t values[ CUSTOM_METRIC_STATISTICS ];  /**< Value of each statistic, by bit position. */
+} CustomMetricStats_t;
+
+/**
+ * @brief Register a custom metric.
+ *
+ * Metrics are registered before they are sampled or aggregated, as the
+ * registration takes no lock.
+ *
+ * @param[in] pMetric The metric to register.
+ * @param[in] pName Name of the metric in the report. It must remain valid, and
+ * is made of letters, digits, '_', '-' and ':'.
+ * @param[in] nameLength Length of @p pName.
+ * @param[in] statistics The CUSTOM_METRIC_STAT_* to report.
+ *
+ * @return #CustomMetricsSuccess if the metric is registered;
+ * #CustomMetricsBadParameter if invalid parameters are passed;
+ * #CustomMetricsNoSpace if #CUSTOM_METRICS_MAX_COUNT metrics are registered.
+ */
+CustomMetricsStatus_t RegisterCustomMetric( CustomMetric_t * pMetric,
+                                            const char * pName,
+                                            size_t nameLength,
+                                            uint32_t statistics );
+
+/**
+ * @brief Record a sample of a custom metric.
+ *
+ * This is a single atomic store, safe to call while the metrics are aggregated
+ * by another thread, but not from two threads for the same metric.
+ *
+ * @param[in] pMetric The registered metric.
+ * @param[in] value The sample.
+ */
+void RecordCustomMetricSample( CustomMetric_t * pMetric,
+                               uint32_t value );
+
+/**
+ * @brief Compute the statistics of the samples recorded since the previous
+ * aggregation.
+ *
+ * Only the metrics with samples are written to @p pOutStatsArray, in the order
+ * they were registered.
+ *
+ * @param[out] pOutStatsArray The array to write the statistics into.
+ * @param[in] statsArrayLength Length of @p pOutStatsArray.
+ * @param[out] pOutNumStats Number of entries written to @p pOutStatsArray.
+ *
+ * @return #CustomMetricsSuccess if the statistics are computed;
+ * #CustomMetricsBadParameter if invalid parameters are passed;
+ * #CustomMetricsNoSpace if @p pOutStatsArray cannot hold all the metrics with
+ * samples, whose samples are then kept for the next aggregation.
+ */
+CustomMetricsStatus_t AggregateCustomMetrics( CustomMetricStats_t * pOutStatsArray,
+                                              uint32_t statsArrayLength,
+                                              uint32_t * pOutNumStats );
+
+/**
+ * @brief Add the metrics of the SDK registry of metrics.h after the
+ * statistics already in an array.
+ *
+ * A counter is reported as "<name>_samples", its total; a gauge as
+ * "<name>_max", its value; and a histogram as its "<name>_avg", "_p50",
+ * "_p90", "_p99" and "_samples". The percentiles are the largest value of
+ * the bucket they fall in. Values that do not fit in 32 bits are saturated.
+ *
+ * @param[in] pSamples The metrics, from #Metrics_Snapshot.
+ * @param[in] sampleCount Number of entries of @p pSamples.
+ * @param[in,out] pOutStatsArray The array to write the statistics into.
+ * @param[in] statsArrayLength Length of @p pOutStatsArray.
+ * @param[in,out] pNumStats Number of entries of @p pOutStatsArray in use,
+ * updated with the metrics added.
+ *
+ * @return #CustomMetricsSuccess if all the metrics are added;
+ * #CustomMetricsBadParameter if invalid parameters are passed;
+ * #CustomMetricsNoSpace if @p pOutStatsArray cannot hold all of them, which
+ * then holds the first ones.
+ */
+CustomMetricsStatus_t AddRegistryMetrics( const MetricsSample_t * pSamples,
+                                          size_t sampleCount,
+                                          CustomMetricStats_t * pOutStatsArray,
+                                          uint32_t statsArrayLength,
+                                          uint32_t * pNumStats );
+
+#endif /* ifndef CUSTOM_METRICS_H_ */
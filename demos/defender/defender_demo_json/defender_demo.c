@@ -41,8 +41,11 @@
 
 /* Standard includes. */
 #include <stdlib.h>
+#include <string.h>
 
 /* POSIX includes. */
+#include <fcntl.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <time.h>
 
@@ -52,6 +55,9 @@
 /* Metrics collector. */
 #include "metrics_collector.h"
 
+/* Custom metrics. */
+#include "custom_metrics.h"
+
 /* Report builder. */
 #include "report_builder.h"
 
@@ -61,9 +67,15 @@
 /* JSON Library. */
 #include "core_json.h"
 
+/* Single pass extraction of JSON keys. */
+#include "json_extract.h"
+
 /* Device Defender Client Library. */
 #include "defender.h"
 
+/* Placement of the threads. */
+#include "thread_groups.h"
+
 /**
  * THING_NAME is required. Throw compilation error if it is not defined.
  */
@@ -88,6 +100,276 @@
  */
 #define DEFENDER_RESPONSE_REPORT_ID_FIELD_LENGTH    ( sizeof( DEFENDER_RESPONSE_REPORT_ID_FIELD ) - 1 )
 
+/**
+ * @brief Set to 1 to publish the report in CBOR rather than JSON.
+ *
+ * The CBOR report uses binary numbers and the short names of the fields, and
+ * is about half the size of the JSON report.
+ */
+#ifndef DEFENDER_DEMO_REPORT_FORMAT_CBOR
+    #define DEFENDER_DEMO_REPORT_FORMAT_CBOR    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to leave out of the report the sections of the metrics
+ * unchanged since the last report accepted by the service.
+ *
+ * The sections are compared by their hashes from #GetMetricsDigest. A report
+ * with no section changed is not published.
+ */
+#ifndef DEFENDER_DEMO_DIFFERENTIAL_REPORTS
+    #define DEFENDER_DEMO_DIFFERENTIAL_REPORTS    ( 0 )
+#endif
+
+/**
+ * @brief Number of metrics collections after which a full report is sent,
+ * changed or not, when #DEFENDER_DEMO_DIFFERENTIAL_REPORTS is 1.
+ *
+ * This keeps every metric reported at least this often, so the service does
+ * not take an unchanged metric as a device that stopped reporting.
+ */
+#ifndef DEFENDER_DEMO_FULL_REPORT_INTERVAL
+    #define DEFENDER_DEMO_FULL_REPORT_INTERVAL    ( 12U )
+#endif
+
+/**
+ * @brief Set to 1 to report the CPU usage and the memory used as custom
+ * metrics.
+ *
+ * A thread samples them every #DEFENDER_DEMO_SAMPLE_PERIOD_MS, and the report
+ * carries their statistics since the previous report. The custom metrics
+ * "cpu_usage_*" and "memory_used_kb_*" must be defined in AWS IoT Device
+ * Defender for the report to be accepted.
+ */
+#ifndef DEFENDER_DEMO_CUSTOM_METRICS
+    #define DEFENDER_DEMO_CUSTOM_METRICS    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to add the metrics of the SDK registry of metrics.h, such
+ * as the totals of the MQTT connections, to the custom metrics of the
+ * report.
+ *
+ * They are named as described for #AddRegistryMetrics, and must be defined
+ * in AWS IoT Device Defender for the report to be accepted. The custom
+ * metrics that do not fit in #DEVICE_METRICS_REPORT_BUFFER_SIZE are left out
+ * of the report.
+ */
+#ifndef DEFENDER_DEMO_SDK_METRICS
+    #define DEFENDER_DEMO_SDK_METRICS    ( 0 )
+#endif
+
+/**
+ * @brief Number of entries of the statistics of the custom metrics.
+ */
+#if ( DEFENDER_DEMO_SDK_METRICS == 1 )
+    #define CUSTOM_METRIC_STATS_LENGTH    ( CUSTOM_METRICS_MAX_COUNT + METRICS_MAX_COUNT )
+#else
+    #define CUSTOM_METRIC_STATS_LENGTH    ( CUSTOM_METRICS_MAX_COUNT )
+#endif
+
+/**
+ * @brief Period of the samples of the custom metrics, in milliseconds.
+ */
+#ifndef DEFENDER_DEMO_SAMPLE_PERIOD_MS
+    #define DEFENDER_DEMO_SAMPLE_PERIOD_MS    ( 100U )
+#endif
+
+/**
+ * @brief Set to 1 to collect the snapshots of the metrics on a thread of
+ * their own.
+ *
+ * The thread collects into the snapshot not being reported every
+ * #DEFENDER_DEMO_COLLECTION_PERIOD_MS, and then makes it the latest one. A
+ * report is built from the latest complete snapshot, so the time taken to
+ * read /proc delays neither the MQTT processing nor the reports.
+ */
+#ifndef DEFENDER_DEMO_BACKGROUND_COLLECTION
+    #define DEFENDER_DEMO_BACKGROUND_COLLECTION    ( 0 )
+#endif
+
+/**
+ * @brief Period of the collections of the snapshots, in milliseconds, when
+ * #DEFENDER_DEMO_BACKGROUND_COLLECTION is 1.
+ */
+#ifndef DEFENDER_DEMO_COLLECTION_PERIOD_MS
+    #define DEFENDER_DEMO_COLLECTION_PERIOD_MS    ( 1000U )
+#endif
+
+/**
+ * @brief Set to 1 to generate the report in place in its PUBLISH packet.
+ *
+ * The report is written after room for the header of the packet, which is
+ * written once the length of the report is known, so the packet is sent
+ * from the same buffer, without copying the report.
+ */
+#ifndef DEFENDER_DEMO_PUBLISH_IN_PLACE
+    #define DEFENDER_DEMO_PUBLISH_IN_PLACE    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to keep reporting after the first report is accepted,
+ * #DEFENDER_DEMO_ADAPTIVE_REPORT_COUNT times in all.
+ *
+ * Between the reports, the metrics are collected every
+ * #DEFENDER_DEMO_COLLECTION_PERIOD_MS. A report is sent as soon as the open
+ * ports change or the established connections grow by
+ * #DEFENDER_DEMO_CONNECTION_SPIKE, and otherwise once
+ * #DEFENDER_DEMO_MAX_REPORT_INTERVAL_S has passed, so a quiet device sends
+ * few reports while a changed one is reported early.
+ */
+#ifndef DEFENDER_DEMO_ADAPTIVE_REPORTS
+    #define DEFENDER_DEMO_ADAPTIVE_REPORTS    ( 0 )
+#endif
+
+/**
+ * @brief Number of reports sent when #DEFENDER_DEMO_ADAPTIVE_REPORTS is 1,
+ * after which the demo ends.
+ */
+#ifndef DEFENDER_DEMO_ADAPTIVE_REPORT_COUNT
+    #define DEFENDER_DEMO_ADAPTIVE_REPORT_COUNT    ( 3U )
+#endif
+
+/**
+ * @brief Shortest time between two reports, in seconds, even when the
+ * metrics change. AWS IoT Device Defender throttles the reports of a thing
+ * sent more often than every 5 minutes.
+ */
+#ifndef DEFENDER_DEMO_MIN_REPORT_INTERVAL_S
+    #define DEFENDER_DEMO_MIN_REPORT_INTERVAL_S    ( 300U )
+#endif
+
+/**
+ * @brief Longest time between two reports, in seconds, when nothing changes.
+ * It must stay within the duration the security profiles of the thing allow
+ * between two reports.
+ */
+#ifndef DEFENDER_DEMO_MAX_REPORT_INTERVAL_S
+    #define DEFENDER_DEMO_MAX_REPORT_INTERVAL_S    ( 3600U )
+#endif
+
+/**
+ * @brief Growth of the number of established connections since the last
+ * report accepted that sends a report early.
+ */
+#ifndef DEFENDER_DEMO_CONNECTION_SPIKE
+    #define DEFENDER_DEMO_CONNECTION_SPIKE    ( 8U )
+#endif
+
+/**
+ * @brief Set to 1 to dedicate #DEFENDER_DEMO_MQTT_IO_CPU to the thread
+ * running the MQTT connection, and to keep the other threads of the demo on
+ * #DEFENDER_DEMO_WORKER_CPUS.
+ *
+ * The MQTT thread then keeps its caches and the other threads never delay
+ * the PUBACKs and PINGRESPs it processes. With 0, the threads run on any CPU,
+ * as the scheduler places them.
+ */
+#ifndef DEFENDER_DEMO_THREAD_PLACEMENT
+    #define DEFENDER_DEMO_THREAD_PLACEMENT    ( 0 )
+#endif
+
+/**
+ * @brief CPU of the thread running the MQTT connection, when
+ * #DEFENDER_DEMO_THREAD_PLACEMENT is 1.
+ */
+#ifndef DEFENDER_DEMO_MQTT_IO_CPU
+    #define DEFENDER_DEMO_MQTT_IO_CPU    ( 0U )
+#endif
+
+/**
+ * @brief CPUs of the collection and sampling threads, as a cpulist, when
+ * #DEFENDER_DEMO_THREAD_PLACEMENT is 1. They are best on the NUMA node of
+ * #DEFENDER_DEMO_MQTT_IO_CPU, as the MQTT thread reads the snapshots they
+ * write.
+ */
+#ifndef DEFENDER_DEMO_WORKER_CPUS
+    #define DEFENDER_DEMO_WORKER_CPUS    "1-3"
+#endif
+
+/**
+ * @brief Thread group of the thread running the MQTT connection.
+ */
+#define MQTT_IO_THREAD_GROUP    "mqtt-io"
+
+/**
+ * @brief Thread group of the collection and sampling threads.
+ */
+#define WORKER_THREAD_GROUP     "collector"
+
+#if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+
+/**
+ * @brief Time a report waits for the first snapshot, in milliseconds.
+ */
+    #define FIRST_SNAPSHOT_TIMEOUT_MS       ( 5000U )
+
+/**
+ * @brief Period of the checks for the first snapshot, in milliseconds.
+ */
+    #define FIRST_SNAPSHOT_POLL_PERIOD_MS    ( 10U )
+
+/**
+ * @brief Index of no snapshot in #metricsSnapshots.
+ */
+    #define NO_SNAPSHOT_INDEX                ( 2U )
+#endif
+
+#if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 )
+
+    /* Names of the custom metrics. */
+    #define CPU_USAGE_METRIC_NAME                       "cpu_usage"
+    #define MEMORY_USED_METRIC_NAME                     "memory_used_kb"
+
+    /* Size of the buffer the files of /proc sampled are read into. */
+    #define SAMPLE_READ_BUFFER_SIZE                     ( 2048U )
+
+    /* Number of the CPU times of the first line of /proc/stat, up to steal. */
+    #define CPU_TIME_COUNT                              ( 8U )
+
+    /* Index of the idle and iowait times among the CPU times. */
+    #define CPU_TIME_IDLE                               ( 3U )
+    #define CPU_TIME_IOWAIT                             ( 4U )
+#endif
+
+/**
+ * @brief The Device Defender topics and APIs of the report format.
+ */
+#if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 )
+    #define DEMO_REPORT_PUBLISH_TOPIC( thingName )                    DEFENDER_API_CBOR_PUBLISH( thingName )
+    #define DEMO_REPORT_PUBLISH_TOPIC_LENGTH( thingNameLength )       DEFENDER_API_LENGTH_CBOR_PUBLISH( thingNameLength )
+    #define DEMO_REPORT_ACCEPTED_TOPIC( thingName )                   DEFENDER_API_CBOR_ACCEPTED( thingName )
+    #define DEMO_REPORT_ACCEPTED_TOPIC_LENGTH( thingNameLength )      DEFENDER_API_LENGTH_CBOR_ACCEPTED( thingNameLength )
+    #define DEMO_REPORT_REJECTED_TOPIC( thingName )                   DEFENDER_API_CBOR_REJECTED( thingName )
+    #define DEMO_REPORT_REJECTED_TOPIC_LENGTH( thingNameLength )      DEFENDER_API_LENGTH_CBOR_REJECTED( thingNameLength )
+    #define DEMO_REPORT_ACCEPTED_API                                  DefenderCborReportAccepted
+    #define DEMO_REPORT_REJECTED_API                                  DefenderCborReportRejected
+
+    /* CBOR payloads are binary, so they are not logged. */
+    #define DEMO_RESPONSE_LOG_LENGTH( responseLength )                ( 0 )
+#else
+    #define DEMO_REPORT_PUBLISH_TOPIC( thingName )                    DEFENDER_API_JSON_PUBLISH( thingName )
+    #define DEMO_REPORT_PUBLISH_TOPIC_LENGTH( thingNameLength )       DEFENDER_API_LENGTH_JSON_PUBLISH( thingNameLength )
+    #define DEMO_REPORT_ACCEPTED_TOPIC( thingName )                   DEFENDER_API_JSON_ACCEPTED( thingName )
+    #define DEMO_REPORT_ACCEPTED_TOPIC_LENGTH( thingNameLength )      DEFENDER_API_LENGTH_JSON_ACCEPTED( thingNameLength )
+    #define DEMO_REPORT_REJECTED_TOPIC( thingName )                   DEFENDER_API_JSON_REJECTED( thingName )
+    #define DEMO_REPORT_REJECTED_TOPIC_LENGTH( thingNameLength )      DEFENDER_API_LENGTH_JSON_REJECTED( thingNameLength )
+    #define DEMO_REPORT_ACCEPTED_API                                  DefenderJsonReportAccepted
+    #define DEMO_REPORT_REJECTED_API                                  DefenderJsonReportRejected
+    #define DEMO_RESPONSE_LOG_LENGTH( responseLength )                ( ( int ) ( responseLength ) )
+#endif
+
+#if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 )
+
+    /* CBOR major types read in the responses. */
+    #define CBOR_MAJOR_TYPE_UNSIGNED    ( 0U )
+    #define CBOR_MAJOR_TYPE_BYTES       ( 2U )
+    #define CBOR_MAJOR_TYPE_TEXT        ( 3U )
+    #define CBOR_MAJOR_TYPE_ARRAY       ( 4U )
+    #define CBOR_MAJOR_TYPE_MAP         ( 5U )
+    #define CBOR_MAJOR_TYPE_TAG         ( 6U )
+#endif
+
 /**
  * @brief The maximum number of times to run the loop in this demo.
  *
@@ -116,44 +398,223 @@ typedef enum
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Network Stats.
+ * @brief Memory of the two metrics arenas, declared as uint64_t for the
+ * alignment of the arrays.
+ */
+static uint64_t metricsArenaBuffers[ 2 ][ METRICS_ARENA_SIZE / sizeof( uint64_t ) ];
+
+/**
+ * @brief The arenas of the two snapshots.
+ */
+static MetricsArena_t metricsArenas[ 2 ] =
+{
+    { ( uint8_t * ) metricsArenaBuffers[ 0 ], sizeof( metricsArenaBuffers[ 0 ] ), 0U },
+    { ( uint8_t * ) metricsArenaBuffers[ 1 ], sizeof( metricsArenaBuffers[ 1 ] ), 0U }
+};
+
+/**
+ * @brief The last two snapshots of the metrics, used in turn.
  */
-static NetworkStats_t networkStats;
+static MetricsSnapshot_t metricsSnapshots[ 2 ];
 
 /**
- * @brief Open TCP ports array.
+ * @brief Index in #metricsSnapshots of the last snapshot collected.
  */
-static uint16_t openTcpPorts[ OPEN_TCP_PORTS_ARRAY_SIZE ];
+static uint32_t currentSnapshotIndex = 0U;
 
 /**
- * @brief Open UDP ports array.
+ * @brief Number of snapshots collected.
  */
-static uint16_t openUdpPorts[ OPEN_UDP_PORTS_ARRAY_SIZE ];
+static uint32_t snapshotCount = 0U;
 
 /**
- * @brief Established connections array.
+ * @brief The snapshot the report is built from.
  */
-static Connection_t establishedConnections[ ESTABLISHED_CONNECTIONS_ARRAY_SIZE ];
+static const MetricsSnapshot_t * pReportSnapshot = NULL;
 
 /**
  * @brief All the metrics sent in the device defender report.
  */
 static ReportMetrics_t deviceMetrics;
 
+#if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+
+/**
+ * @brief The thread collecting the snapshots of the metrics.
+ */
+    static pthread_t collectorThread;
+
+/**
+ * @brief Whether #collectorThread is running; cleared to stop it.
+ */
+    static bool collectorRunning = false;
+
+/**
+ * @brief Index in #metricsSnapshots of the snapshot a report is built from,
+ * which #collectorThread does not collect into; #NO_SNAPSHOT_INDEX if none.
+ */
+    static uint32_t pinnedSnapshotIndex = NO_SNAPSHOT_INDEX;
+#endif /* if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 ) */
+
+#if ( DEFENDER_DEMO_DIFFERENTIAL_REPORTS == 1 )
+
+/**
+ * @brief Hashes of the metrics of the last report accepted by the service.
+ */
+    static MetricsDigest_t reportedDigest;
+
+/**
+ * @brief Hashes of the metrics of the report being published.
+ */
+    static MetricsDigest_t pendingDigest;
+
+/**
+ * @brief Whether #reportedDigest holds the hashes of an accepted report.
+ */
+    static bool hasReportedDigest = false;
+
+/**
+ * @brief Number of metrics collections since the last full report was
+ * accepted.
+ */
+    static uint32_t collectionsSinceFullReport = 0U;
+
+/**
+ * @brief Whether the report being published is a full report.
+ */
+    static bool pendingFullReport = false;
+#endif /* if ( DEFENDER_DEMO_DIFFERENTIAL_REPORTS == 1 ) */
+
+#if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 )
+
+/**
+ * @brief The metrics a snapshot is compared on to send a report early.
+ */
+    typedef struct ReportBaseline
+    {
+        uint32_t openTcpPortsHash; /**< Hash of the open TCP ports. */
+        uint32_t openUdpPortsHash; /**< Hash of the open UDP ports. */
+        uint32_t connectionCount;  /**< Number of established connections. */
+    } ReportBaseline_t;
+
+/**
+ * @brief Baseline of the last report accepted by the service.
+ */
+    static ReportBaseline_t reportedBaseline;
+
+/**
+ * @brief Baseline of the report being published.
+ */
+    static ReportBaseline_t pendingBaseline;
+
+/**
+ * @brief Time the last report was sent, or skipped as unchanged.
+ */
+    static time_t lastReportTime = 0;
+#endif /* if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 ) */
+
+#if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 )
+
+/**
+ * @brief CPU usage of all the CPUs, in percent, sampled by #samplerTask.
+ */
+    static CustomMetric_t cpuUsageMetric;
+
+/**
+ * @brief Memory used, in kibibytes, sampled by #samplerTask.
+ */
+    static CustomMetric_t memoryUsedMetric;
+
+/**
+ * @brief The thread sampling the custom metrics.
+ */
+    static pthread_t samplerThread;
+
+/**
+ * @brief Whether #samplerThread is running; cleared to stop it.
+ */
+    static bool samplerRunning = false;
+#endif /* if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 ) */
+
+#if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 ) || ( DEFENDER_DEMO_SDK_METRICS == 1 )
+
+/**
+ * @brief Statistics of the custom metrics sent in the report.
+ */
+    static CustomMetricStats_t customMetricStats[ CUSTOM_METRIC_STATS_LENGTH ];
+#endif
+
+#if ( DEFENDER_DEMO_SDK_METRICS == 1 )
+
+/**
+ * @brief Metrics of the SDK registry, read for each report.
+ */
+    static MetricsSample_t sdkMetricSamples[ METRICS_MAX_COUNT ];
+#endif
+
 /**
  * @brief Report status.
  */
 static ReportStatus_t reportStatus;
 
+/**
+ * @brief Offset of the report in #deviceMetricsPacket.
+ */
+#if ( DEFENDER_DEMO_PUBLISH_IN_PLACE == 1 )
+    #define REPORT_PAYLOAD_OFFSET    PUBLISH_PAYLOAD_OFFSET( DEMO_REPORT_PUBLISH_TOPIC_LENGTH( THING_NAME_LENGTH ) )
+#else
+    #define REPORT_PAYLOAD_OFFSET    ( 0U )
+#endif
+
+/**
+ * @brief Buffer of the device defender report, after the room for the header
+ * of its PUBLISH packet if #DEFENDER_DEMO_PUBLISH_IN_PLACE is 1.
+ */
+static uint8_t deviceMetricsPacket[ REPORT_PAYLOAD_OFFSET + DEVICE_METRICS_REPORT_BUFFER_SIZE ];
+
 /**
  * @brief Buffer for generating the device defender report.
  */
-static char deviceMetricsJsonReport[ DEVICE_METRICS_REPORT_BUFFER_SIZE ];
+static char * const deviceMetricsReport = ( char * ) &( deviceMetricsPacket[ REPORT_PAYLOAD_OFFSET ] );
 
 /**
  * @brief Report Id sent in the defender report.
  */
 static uint32_t reportId = 0;
+
+/**
+ * @brief Rules of the publishes queued while the connection to the broker is
+ * down. A newer report holds newer metrics, so the oldest report is dropped
+ * when the queue is full.
+ */
+static const PublishQueueRule_t offlinePublishRules[] =
+{
+    {
+        DEMO_REPORT_PUBLISH_TOPIC( THING_NAME ),
+        DEMO_REPORT_PUBLISH_TOPIC_LENGTH( THING_NAME_LENGTH ),
+        0U,
+        PublishQueueDropOldest
+    }
+};
+
+/**
+ * @brief The defender topics of the responses for accepted and rejected
+ * reports, subscribed to together.
+ */
+static const char * const defenderTopics[] =
+{
+    DEMO_REPORT_ACCEPTED_TOPIC( THING_NAME ),
+    DEMO_REPORT_REJECTED_TOPIC( THING_NAME )
+};
+
+/**
+ * @brief Lengths of #defenderTopics.
+ */
+static const uint16_t defenderTopicLengths[] =
+{
+    DEMO_REPORT_ACCEPTED_TOPIC_LENGTH( THING_NAME_LENGTH ),
+    DEMO_REPORT_REJECTED_TOPIC_LENGTH( THING_NAME_LENGTH )
+};
 /*-----------------------------------------------------------*/
 
 /**
@@ -166,7 +627,27 @@ static void publishCallback( MQTTPublishInfo_t * pPublishInfo,
                              uint16_t packetIdentifier );
 
 /**
- * @brief Collect all the metrics to be sent in the device defender report.
+ * @brief Collect a snapshot of the metrics, into the snapshot not holding the
+ * last one, and make it the last one.
+ *
+ * @return true if the snapshot is collected; false otherwise.
+ */
+static bool collectSnapshot( void );
+
+/**
+ * @brief Collect a snapshot of the metrics.
+ *
+ * If #DEFENDER_DEMO_BACKGROUND_COLLECTION is 1, the last snapshot collected
+ * by #collectorThread is taken instead, and kept until
+ * #releaseDeviceMetrics.
+ *
+ * @return The snapshot; NULL if none could be collected.
+ */
+static MetricsSnapshot_t * acquireSnapshot( void );
+
+/**
+ * @brief Collect all the metrics to be sent in the device defender report,
+ * from the snapshot of #acquireSnapshot.
  *
  * @return true if all the metrics are successfully collected;
  * false otherwise.
@@ -174,284 +655,1249 @@ static void publishCallback( MQTTPublishInfo_t * pPublishInfo,
 static bool collectDeviceMetrics( void );
 
 /**
- * @brief Generate the device defender report.
+ * @brief Let the snapshot taken by #collectDeviceMetrics be collected into
+ * again, once the report is built.
+ */
+static void releaseDeviceMetrics( void );
+
+#if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+
+/**
+ * @brief Collect a snapshot every #DEFENDER_DEMO_COLLECTION_PERIOD_MS until
+ * #collectorRunning is cleared.
  *
- * @param[out] pOutReportLength Length of the device defender report.
+ * A collection is skipped while the snapshot it would collect into is being
+ * reported.
  *
- * @return true if the report is generated successfully;
- * false otherwise.
+ * @param[in] pArgument Unused.
+ *
+ * @return NULL.
  */
-static bool generateDeviceMetricsReport( uint32_t * pOutReportLength );
+    static void * collectorTask( void * pArgument );
+
+#endif /* if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 ) */
 
 /**
- * @brief Subscribe to the device defender topics.
+ * @brief Place the threads of the demo, if #DEFENDER_DEMO_THREAD_PLACEMENT is
+ * 1, moving the calling thread, which runs the MQTT connection, onto its
+ * dedicated CPU.
  *
- * @return true if the subscribe is successful;
+ * @return true if the threads are placed, or the placement is disabled;
  * false otherwise.
  */
-static bool subscribeToDefenderTopics( void );
+static bool placeThreads( void );
 
 /**
- * @brief Unsubscribe from the device defender topics.
+ * @brief Start collecting the snapshots on #collectorThread.
  *
- * @return true if the unsubscribe is successful;
+ * @return true if the collection is started, or is done by the reports;
  * false otherwise.
  */
-static bool unsubscribeFromDefenderTopics( void );
+static bool startMetricsCollection( void );
 
 /**
- * @brief Publish the generated device defender report.
+ * @brief Stop collecting the snapshots.
+ */
+static void stopMetricsCollection( void );
+
+#if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 )
+
+/**
+ * @brief Read a file of /proc into a buffer, as a string.
  *
- * @param[in] reportLength Length of the device defender report.
+ * @param[in] pPath Path of the file.
+ * @param[out] pBuffer The buffer, of #SAMPLE_READ_BUFFER_SIZE bytes.
  *
- * @return true if the report is published successfully;
- * false otherwise.
+ * @return true if the start of the file is read; false otherwise.
  */
-static bool publishDeviceMetricsReport( uint32_t reportLength );
+    static bool readSampleFile( const char * pPath,
+                                char * pBuffer );
 
 /**
- * @brief Validate the response received from the AWS IoT Device Defender Service.
+ * @brief Sample the CPU usage since the previous sample.
  *
- * This functions checks that a valid JSON is received and the value of reportId
- * is same as was sent in the published report.
+ * @param[in,out] pCpuTimes The CPU times of the previous sample, updated.
+ */
+    static void sampleCpuUsage( uint64_t * pCpuTimes );
+
+/**
+ * @brief Sample the memory used.
+ */
+    static void sampleMemoryUsed( void );
+
+/**
+ * @brief Sample the custom metrics every #DEFENDER_DEMO_SAMPLE_PERIOD_MS until
+ * #samplerRunning is cleared.
  *
- * @param[in] defenderResponse The defender response to validate.
- * @param[in] defenderResponseLength Length of the defender response.
+ * @param[in] pArgument Unused.
  *
- * @return true if the response is valid;
- * false otherwise.
+ * @return NULL.
  */
-static bool validateDefenderResponse( const char * defenderResponse,
-                                      uint32_t defenderResponseLength );
-/*-----------------------------------------------------------*/
+    static void * samplerTask( void * pArgument );
 
-static bool validateDefenderResponse( const char * defenderResponse,
-                                      uint32_t defenderResponseLength )
+#endif /* if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 ) */
+
+/**
+ * @brief Register the custom metrics and start sampling them.
+ *
+ * @return true if the sampling is started, or the custom metrics are
+ * disabled; false otherwise.
+ */
+static bool startCustomMetrics( void );
+
+/**
+ * @brief Stop sampling the custom metrics.
+ */
+static void stopCustomMetrics( void );
+
+/**
+ * @brief Choose the sections of the metrics sent in the report.
+ *
+ * If #DEFENDER_DEMO_DIFFERENTIAL_REPORTS is 1, the sections unchanged since
+ * the last report accepted are left out, unless a full report is due.
+ *
+ * @return true if the report has sections to send;
+ * false if nothing changed and the report can be skipped.
+ */
+static bool selectReportSections( void );
+
+/**
+ * @brief Record that the service accepted the report published.
+ */
+static void recordReportAccepted( void );
+
+#if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 )
+
+/**
+ * @brief Get the metrics of a snapshot compared to send a report early.
+ *
+ * @param[in] pSnapshot The snapshot.
+ * @param[out] pBaseline The metrics compared.
+ */
+    static void getReportBaseline( const MetricsSnapshot_t * pSnapshot,
+                                   ReportBaseline_t * pBaseline );
+
+/**
+ * @brief Process the MQTT connection and collect the metrics until a report
+ * is due: early if the open ports changed or the established connections
+ * spiked since the last report accepted, and otherwise once
+ * #DEFENDER_DEMO_MAX_REPORT_INTERVAL_S has passed.
+ */
+    static void waitForReportTrigger( void );
+
+#endif /* if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 ) */
+
+/**
+ * @brief Generate the device defender report.
+ *
+ * @param[out] pOutReportLength Length of the device defender report.
+ *
+ * @return true if the report is generated successfully;
+ * false otherwise.
+ */
+static bool generateDeviceMetricsReport( uint32_t * pOutReportLength );
+
+/**
+ * @brief Subscribe to the device defender topics.
+ *
+ * @return true if the subscribe is successful;
+ * false otherwise.
+ */
+static bool subscribeToDefenderTopics( void );
+
+/**
+ * @brief Unsubscribe from the device defender topics.
+ *
+ * @return true if the unsubscribe is successful;
+ * false otherwise.
+ */
+static bool unsubscribeFromDefenderTopics( void );
+
+/**
+ * @brief Publish the generated device defender report.
+ *
+ * @param[in] reportLength Length of the device defender report.
+ *
+ * @return true if the report is published successfully;
+ * false otherwise.
+ */
+static bool publishDeviceMetricsReport( uint32_t reportLength );
+
+/**
+ * @brief Validate the response received from the AWS IoT Device Defender Service.
+ *
+ * This functions checks that a valid response is received and the value of
+ * reportId is same as was sent in the published report.
+ *
+ * @param[in] defenderResponse The defender response to validate.
+ * @param[in] defenderResponseLength Length of the defender response.
+ *
+ * @return true if the response is valid;
+ * false otherwise.
+ */
+static bool validateDefenderResponse( const char * defenderResponse,
+                                      uint32_t defenderResponseLength );
+
+#if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 )
+
+/**
+ * @brief Read the head of a CBOR data item.
+ *
+ * Items of indefinite length are not supported.
+ *
+ * @param[in] pData The CBOR data.
+ * @param[in] dataLength Length of @p pData.
+ * @param[in,out] pOffset Offset of the item, moved past its head.
+ * @param[out] pMajorType Major type of the item.
+ * @param[out] pValue Value, length or number of entries of the item.
+ *
+ * @return true if the head is read; false otherwise.
+ */
+    static bool readCborHead( const uint8_t * pData,
+                              size_t dataLength,
+                              size_t * pOffset,
+                              uint8_t * pMajorType,
+                              uint64_t * pValue );
+
+/**
+ * @brief Skip a CBOR data item, with the items it contains.
+ *
+ * @param[in] pData The CBOR data.
+ * @param[in] dataLength Length of @p pData.
+ * @param[in,out] pOffset Offset of the item, moved past it.
+ *
+ * @return true if the item is skipped; false otherwise.
+ */
+    static bool skipCborItem( const uint8_t * pData,
+                              size_t dataLength,
+                              size_t * pOffset );
+
+/**
+ * @brief Get the reportId of a CBOR response.
+ *
+ * @param[in] pResponse The response, a CBOR map.
+ * @param[in] responseLength Length of the response.
+ * @param[out] pOutReportId The reportId.
+ *
+ * @return true if the reportId is found; false otherwise.
+ */
+    static bool getCborReportId( const uint8_t * pResponse,
+                                 size_t responseLength,
+                                 uint32_t * pOutReportId );
+
+#else /* if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 ) */
+
+/**
+ * @brief Get the reportId of a JSON response.
+ *
+ * @param[in] defenderResponse The response.
+ * @param[in] defenderResponseLength Length of the response.
+ * @param[out] pOutReportId The reportId.
+ *
+ * @return true if the response is a valid JSON with a reportId;
+ * false otherwise.
+ */
+    static bool getJsonReportId( const char * defenderResponse,
+                                 uint32_t defenderResponseLength,
+                                 uint32_t * pOutReportId );
+
+#endif /* if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 ) */
+
+/**
+ * @brief Get the number of bytes the report takes in #deviceMetricsReport.
+ *
+ * @param[out] pOutBufferLength The number of bytes, with the terminating NULL
+ * of a JSON report.
+ *
+ * @return The status of the report builder.
+ */
+static ReportBuilderStatus_t getReportBufferLength( uint32_t * pOutBufferLength );
+/*-----------------------------------------------------------*/
+
+#if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 )
+
+    static bool readCborHead( const uint8_t * pData,
+                              size_t dataLength,
+                              size_t * pOffset,
+                              uint8_t * pMajorType,
+                              uint64_t * pValue )
+    {
+        bool status = false;
+        size_t offset = *pOffset, valueLength = 0U, i;
+        uint8_t additionalInfo = 0U;
+
+        if( offset < dataLength )
+        {
+            *pMajorType = ( uint8_t ) ( pData[ offset ] >> 5 );
+            additionalInfo = ( uint8_t ) ( pData[ offset ] & 0x1FU );
+            offset++;
+
+            if( additionalInfo < 24U )
+            {
+                *pValue = additionalInfo;
+                status = true;
+            }
+            else if( additionalInfo <= 27U )
+            {
+                /* 1, 2, 4 or 8 bytes follow, big endian. */
+                valueLength = ( size_t ) 1U << ( additionalInfo - 24U );
+
+                if( valueLength <= ( dataLength - offset ) )
+                {
+                    *pValue = 0U;
+
+                    for( i = 0U; i < valueLength; i++ )
+                    {
+                        *pValue = ( *pValue << 8 ) | pData[ offset + i ];
+                    }
+
+                    offset += valueLength;
+                    status = true;
+                }
+            }
+            else
+            {
+                /* Indefinite lengths and reserved values. */
+            }
+        }
+
+        if( status == true )
+        {
+            *pOffset = offset;
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static bool skipCborItem( const uint8_t * pData,
+                              size_t dataLength,
+                              size_t * pOffset )
+    {
+        bool status = true;
+        uint64_t remainingItems = 1U, value = 0U;
+        uint8_t majorType = 0U;
+
+        /* Count the items left to skip rather than recursing into the
+         * arrays and maps. */
+        while( ( status == true ) && ( remainingItems > 0U ) )
+        {
+            status = readCborHead( pData, dataLength, pOffset, &( majorType ), &( value ) );
+            remainingItems--;
+
+            if( status == true )
+            {
+                if( ( majorType == CBOR_MAJOR_TYPE_BYTES ) || ( majorType == CBOR_MAJOR_TYPE_TEXT ) )
+                {
+                    if( value <= ( dataLength - *pOffset ) )
+                    {
+                        *pOffset += ( size_t ) value;
+                    }
+                    else
+                    {
+                        status = false;
+                    }
+                }
+                else if( ( majorType == CBOR_MAJOR_TYPE_ARRAY ) || ( majorType == CBOR_MAJOR_TYPE_MAP ) )
+                {
+                    /* Each entry takes at least a byte, which bounds the
+                     * count. */
+                    if( value <= ( dataLength - *pOffset ) )
+                    {
+                        remainingItems += ( majorType == CBOR_MAJOR_TYPE_MAP ) ? ( 2U * value ) : value;
+                    }
+                    else
+                    {
+                        status = false;
+                    }
+                }
+                else if( majorType == CBOR_MAJOR_TYPE_TAG )
+                {
+                    remainingItems++;
+                }
+                else
+                {
+                    /* Integers, simple values and floats are all in their
+                     * head. */
+                }
+            }
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static bool getCborReportId( const uint8_t * pResponse,
+                                 size_t responseLength,
+                                 uint32_t * pOutReportId )
+    {
+        bool status = false, found = false;
+        size_t offset = 0U;
+        uint64_t entryCount = 0U, i = 0U, value = 0U;
+        uint8_t majorType = 0U;
+
+        status = readCborHead( pResponse, responseLength, &( offset ), &( majorType ), &( entryCount ) );
+
+        if( ( status == true ) && ( majorType != CBOR_MAJOR_TYPE_MAP ) )
+        {
+            status = false;
+        }
+
+        /* Look through the keys, which are text, for the reportId. */
+        while( ( status == true ) && ( found == false ) && ( i < entryCount ) )
+        {
+            status = readCborHead( pResponse, responseLength, &( offset ), &( majorType ), &( value ) );
+
+            if( ( status == true ) &&
+                ( ( majorType != CBOR_MAJOR_TYPE_TEXT ) || ( value > ( responseLength - offset ) ) ) )
+            {
+                status = false;
+            }
+
+            if( status == true )
+            {
+                if( ( value == DEFENDER_RESPONSE_REPORT_ID_FIELD_LENGTH ) &&
+                    ( memcmp( &( pResponse[ offset ] ),
+                              DEFENDER_RESPONSE_REPORT_ID_FIELD,
+                              DEFENDER_RESPONSE_REPORT_ID_FIELD_LENGTH ) == 0 ) )
+                {
+                    offset += ( size_t ) value;
+                    status = readCborHead( pResponse, responseLength, &( offset ), &( majorType ), &( value ) );
+
+                    if( ( status == true ) && ( majorType == CBOR_MAJOR_TYPE_UNSIGNED ) && ( value <= UINT32_MAX ) )
+                    {
+                        *pOutReportId = ( uint32_t ) value;
+                        found = true;
+                    }
+                    else
+                    {
+                        status = false;
+                    }
+                }
+                else
+                {
+                    offset += ( size_t ) value;
+                    status = skipCborItem( pResponse, responseLength, &( offset ) );
+                }
+            }
+
+            i++;
+        }
+
+        if( found == false )
+        {
+            LogError( ( "reportId not found in the CBOR response of %u bytes from the "
+                        "AWS IoT Device Defender Service.",
+                        ( unsigned int ) responseLength ) );
+        }
+
+        return found;
+    }
+/*-----------------------------------------------------------*/
+
+#else /* if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 ) */
+
+    static bool getJsonReportId( const char * defenderResponse,
+                                 uint32_t defenderResponseLength,
+                                 uint32_t * pOutReportId )
+    {
+        JSONStatus_t jsonResult = JSONSuccess;
+        JSONExtractQuery_t reportIdKey =
+        {
+            DEFENDER_RESPONSE_REPORT_ID_FIELD,
+            DEFENDER_RESPONSE_REPORT_ID_FIELD_LENGTH,
+            NULL,
+            0U,
+            JSONInvalid
+        };
+
+        /* Is the response a valid JSON? */
+        jsonResult = JSON_Validate( defenderResponse, defenderResponseLength );
+
+        if( jsonResult != JSONSuccess )
+        {
+            LogError( ( "Invalid response from AWS IoT Device Defender Service: %.*s.",
+                        ( int ) defenderResponseLength,
+                        defenderResponse ) );
+        }
+
+        if( jsonResult == JSONSuccess )
+        {
+            /* Search the reportId key in the response. */
+            jsonResult = JSONExtract_Search( defenderResponse,
+                                             defenderResponseLength,
+                                             &( reportIdKey ),
+                                             1U );
+
+            if( jsonResult != JSONSuccess )
+            {
+                LogError( ( "reportId key not found in the response from the"
+                            "AWS IoT Device Defender Service: %.*s.",
+                            ( int ) defenderResponseLength,
+                            defenderResponse ) );
+            }
+        }
+
+        if( jsonResult == JSONSuccess )
+        {
+            *pOutReportId = ( uint32_t ) strtoul( reportIdKey.pValue, NULL, 10 );
+        }
+
+        return ( jsonResult == JSONSuccess ) ? true : false;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 ) */
+
+static bool validateDefenderResponse( const char * defenderResponse,
+                                      uint32_t defenderResponseLength )
 {
     bool status = false;
-    JSONStatus_t jsonResult = JSONSuccess;
-    char * reportIdString;
-    size_t reportIdStringLength;
-    uint32_t reportIdInResponse;
+    uint32_t reportIdInResponse = 0U;
+
+    #if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 )
+        status = getCborReportId( ( const uint8_t * ) defenderResponse,
+                                  defenderResponseLength,
+                                  &( reportIdInResponse ) );
+    #else
+        status = getJsonReportId( defenderResponse,
+                                  defenderResponseLength,
+                                  &( reportIdInResponse ) );
+    #endif
+
+    if( status == true )
+    {
+        /* Is the reportId present in the response same as was sent in the
+         * published report? */
+        if( reportIdInResponse == reportId )
+        {
+            LogInfo( ( "A valid reponse with reportId %u received from the "
+                       "AWS IoT Device Defender Service.", reportId ) );
+        }
+        else
+        {
+            LogError( ( "Unexpected reportId found in the response from the AWS"
+                        "IoT Device Defender Service. Expected: %u, Found: %u, "
+                        "Complete Response: %.*s.",
+                        reportIdInResponse,
+                        reportId,
+                        DEMO_RESPONSE_LOG_LENGTH( defenderResponseLength ),
+                        defenderResponse ) );
+            status = false;
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static ReportBuilderStatus_t getReportBufferLength( uint32_t * pOutBufferLength )
+{
+    ReportBuilderStatus_t reportBuilderStatus;
+
+    #if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 )
+        reportBuilderStatus = GetCborReportLength( &( deviceMetrics ),
+                                                   DEVICE_METRICS_REPORT_MAJOR_VERSION,
+                                                   DEVICE_METRICS_REPORT_MINOR_VERSION,
+                                                   reportId,
+                                                   pOutBufferLength );
+    #else
+        reportBuilderStatus = GetJsonReportLength( &( deviceMetrics ),
+                                                   DEVICE_METRICS_REPORT_MAJOR_VERSION,
+                                                   DEVICE_METRICS_REPORT_MINOR_VERSION,
+                                                   reportId,
+                                                   pOutBufferLength );
+
+        /* Room for the terminating NULL. */
+        *pOutBufferLength += 1U;
+    #endif
+
+    return reportBuilderStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void publishCallback( MQTTPublishInfo_t * pPublishInfo,
+                             uint16_t packetIdentifier )
+{
+    DefenderStatus_t status;
+    DefenderTopic_t api;
+    bool validationResult;
+
+    /* Silence compiler warnings about unused variables. */
+    ( void ) packetIdentifier;
+
+    status = Defender_MatchTopic( pPublishInfo->pTopicName,
+                                  pPublishInfo->topicNameLength,
+                                  &( api ),
+                                  NULL,
+                                  NULL );
+
+    if( status == DefenderSuccess )
+    {
+        if( api == DEMO_REPORT_ACCEPTED_API )
+        {
+            /* Check if the response is valid and is for the report we published. */
+            validationResult = validateDefenderResponse( pPublishInfo->pPayload,
+                                                         pPublishInfo->payloadLength );
+
+            if( validationResult == true )
+            {
+                LogInfo( ( "The defender report was accepted by the service. Response: %.*s.",
+                           DEMO_RESPONSE_LOG_LENGTH( pPublishInfo->payloadLength ),
+                           ( const char * ) pPublishInfo->pPayload ) );
+                reportStatus = ReportStatusAccepted;
+                recordReportAccepted();
+            }
+        }
+        else if( api == DEMO_REPORT_REJECTED_API )
+        {
+            /* Check if the response is valid and is for the report we published. */
+            validationResult = validateDefenderResponse( pPublishInfo->pPayload,
+                                                         pPublishInfo->payloadLength );
+
+            if( validationResult == true )
+            {
+                LogError( ( "The defender report was rejected by the service. Response: %.*s.",
+                            DEMO_RESPONSE_LOG_LENGTH( pPublishInfo->payloadLength ),
+                            ( const char * ) pPublishInfo->pPayload ) );
+                reportStatus = ReportStatusRejected;
+            }
+        }
+        else
+        {
+            LogError( ( "Unexpected defender API : %d.", api ) );
+        }
+    }
+    else
+    {
+        LogError( ( "Unexpected publish message received. Topic: %.*s, Payload: %.*s.",
+                    ( int ) pPublishInfo->topicNameLength,
+                    ( const char * ) pPublishInfo->pTopicName,
+                    DEMO_RESPONSE_LOG_LENGTH( pPublishInfo->payloadLength ),
+                    ( const char * ) ( pPublishInfo->pPayload ) ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static bool collectSnapshot( void )
+{
+    bool status = false;
+    MetricsCollectorStatus_t metricsCollectorStatus;
+    MetricsSnapshot_t * pPreviousSnapshot = NULL;
+    MetricsSnapshot_t * pSnapshot = NULL;
+    MetricsDelta_t delta;
+    uint32_t snapshotIndex = 0U;
+
+    /* Collect into the snapshot not holding the last one, which its arrays
+     * are sized from. Only this function changes the last one, so it is read
+     * as is. */
+    if( snapshotCount > 0U )
+    {
+        pPreviousSnapshot = &( metricsSnapshots[ currentSnapshotIndex ] );
+        snapshotIndex = currentSnapshotIndex ^ 1U;
+    }
+
+    pSnapshot = &( metricsSnapshots[ snapshotIndex ] );
+
+    /* Collect the network stats, the open ports and the established
+     * connections at once. */
+    metricsCollectorStatus = GetMetricsSnapshot( &( metricsArenas[ snapshotIndex ] ),
+                                                 pPreviousSnapshot,
+                                                 pSnapshot );
+
+    if( metricsCollectorStatus != MetricsCollectorSuccess )
+    {
+        LogError( ( "GetMetricsSnapshot failed. Status: %d.",
+                    metricsCollectorStatus ) );
+    }
+    else
+    {
+        /* The snapshot is complete before it becomes the last one. */
+        __atomic_store_n( &currentSnapshotIndex, snapshotIndex, __ATOMIC_SEQ_CST );
+        __atomic_store_n( &snapshotCount, snapshotCount + 1U, __ATOMIC_SEQ_CST );
+        status = true;
+    }
+
+    /* Log the changes since the previous snapshot. */
+    if( ( status == true ) && ( pPreviousSnapshot != NULL ) )
+    {
+        if( GetMetricsDelta( pPreviousSnapshot, pSnapshot, &( delta ) ) == MetricsCollectorSuccess )
+        {
+            LogInfo( ( "Since the previous snapshot: %llu bytes in, %llu bytes out, "
+                       "TCP ports +%u -%u, UDP ports +%u -%u, connections +%u -%u.",
+                       ( unsigned long long ) delta.networkStats.bytesReceived,
+                       ( unsigned long long ) delta.networkStats.bytesSent,
+                       delta.openedTcpPorts,
+                       delta.closedTcpPorts,
+                       delta.openedUdpPorts,
+                       delta.closedUdpPorts,
+                       delta.openedConnections,
+                       delta.closedConnections ) );
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static MetricsSnapshot_t * acquireSnapshot( void )
+{
+    MetricsSnapshot_t * pSnapshot = NULL;
+
+    #if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+        uint32_t snapshotIndex = 0U, waitedMs = 0U;
+
+        while( ( __atomic_load_n( &snapshotCount, __ATOMIC_SEQ_CST ) == 0U ) &&
+               ( waitedMs < FIRST_SNAPSHOT_TIMEOUT_MS ) )
+        {
+            ( void ) usleep( FIRST_SNAPSHOT_POLL_PERIOD_MS * 1000U );
+            waitedMs += FIRST_SNAPSHOT_POLL_PERIOD_MS;
+        }
+
+        if( __atomic_load_n( &snapshotCount, __ATOMIC_SEQ_CST ) == 0U )
+        {
+            LogError( ( "No snapshot of the metrics was collected." ) );
+        }
+        else
+        {
+            /* Pin the last snapshot. If the collector made another snapshot
+             * the last one meanwhile, it may have missed the pin and be
+             * collecting into this one, so the new last one is pinned. */
+            do
+            {
+                snapshotIndex = __atomic_load_n( &currentSnapshotIndex, __ATOMIC_SEQ_CST );
+                __atomic_store_n( &pinnedSnapshotIndex, snapshotIndex, __ATOMIC_SEQ_CST );
+            } while( __atomic_load_n( &currentSnapshotIndex, __ATOMIC_SEQ_CST ) != snapshotIndex );
+
+            pSnapshot = &( metricsSnapshots[ snapshotIndex ] );
+        }
+    #else /* if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 ) */
+        if( collectSnapshot() == true )
+        {
+            pSnapshot = &( metricsSnapshots[ currentSnapshotIndex ] );
+        }
+    #endif /* if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 ) */
+
+    return pSnapshot;
+}
+/*-----------------------------------------------------------*/
+
+static bool collectDeviceMetrics( void )
+{
+    bool status = false;
+    MetricsSnapshot_t * pSnapshot = acquireSnapshot();
+
+    pReportSnapshot = pSnapshot;
+    status = ( pSnapshot != NULL );
+
+    /* Populate device metrics. At most the number of entries the report has
+     * room for are sent. */
+    if( status == true )
+    {
+        deviceMetrics.pNetworkStats = &( pSnapshot->networkStats );
+        deviceMetrics.pOpenTcpPortsArray = pSnapshot->pOpenTcpPortsArray;
+        deviceMetrics.openTcpPortsArrayLength = ( pSnapshot->openTcpPortsArrayLength < OPEN_TCP_PORTS_ARRAY_SIZE ) ?
+                                                pSnapshot->openTcpPortsArrayLength : OPEN_TCP_PORTS_ARRAY_SIZE;
+        deviceMetrics.pOpenUdpPortsArray = pSnapshot->pOpenUdpPortsArray;
+        deviceMetrics.openUdpPortsArrayLength = ( pSnapshot->openUdpPortsArrayLength < OPEN_UDP_PORTS_ARRAY_SIZE ) ?
+                                                pSnapshot->openUdpPortsArrayLength : OPEN_UDP_PORTS_ARRAY_SIZE;
+        deviceMetrics.pEstablishedConnectionsArray = pSnapshot->pEstablishedConnectionsArray;
+        deviceMetrics.establishedConnectionsArrayLength = ( pSnapshot->establishedConnectionsArrayLength < ESTABLISHED_CONNECTIONS_ARRAY_SIZE ) ?
+                                                          pSnapshot->establishedConnectionsArrayLength : ESTABLISHED_CONNECTIONS_ARRAY_SIZE;
+    }
+
+    /* Add the statistics of the custom metrics sampled since the previous
+     * report. */
+    #if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 )
+        if( status == true )
+        {
+            ( void ) AggregateCustomMetrics( &( customMetricStats[ 0 ] ),
+                                             CUSTOM_METRICS_MAX_COUNT,
+                                             &( deviceMetrics.customMetricsArrayLength ) );
+            deviceMetrics.pCustomMetricsArray = &( customMetricStats[ 0 ] );
+        }
+    #endif
+
+    /* Add the metrics of the SDK, totalled over all its threads. */
+    #if ( DEFENDER_DEMO_SDK_METRICS == 1 )
+        if( status == true )
+        {
+            size_t sdkMetricCount = 0U;
+            uint32_t numStats = ( DEFENDER_DEMO_CUSTOM_METRICS == 1 ) ? deviceMetrics.customMetricsArrayLength : 0U;
+
+            ( void ) Metrics_Snapshot( &( sdkMetricSamples[ 0 ] ), METRICS_MAX_COUNT, &( sdkMetricCount ) );
+            ( void ) AddRegistryMetrics( &( sdkMetricSamples[ 0 ] ),
+                                         sdkMetricCount,
+                                         &( customMetricStats[ 0 ] ),
+                                         CUSTOM_METRIC_STATS_LENGTH,
+                                         &( numStats ) );
+            deviceMetrics.pCustomMetricsArray = &( customMetricStats[ 0 ] );
+            deviceMetrics.customMetricsArrayLength = numStats;
+        }
+    #endif
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static void releaseDeviceMetrics( void )
+{
+    #if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+        __atomic_store_n( &pinnedSnapshotIndex, NO_SNAPSHOT_INDEX, __ATOMIC_SEQ_CST );
+    #endif
+
+    pReportSnapshot = NULL;
+}
+/*-----------------------------------------------------------*/
+
+#if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+
+    static void * collectorTask( void * pArgument )
+    {
+        uint32_t snapshotIndex;
+
+        ( void ) pArgument;
+
+        while( __atomic_load_n( &collectorRunning, __ATOMIC_ACQUIRE ) == true )
+        {
+            /* The first snapshot goes to index 0, and the next ones to the
+             * snapshot not holding the last one. */
+            snapshotIndex = ( snapshotCount > 0U ) ? ( currentSnapshotIndex ^ 1U ) : 0U;
+
+            if( __atomic_load_n( &pinnedSnapshotIndex, __ATOMIC_SEQ_CST ) != snapshotIndex )
+            {
+                ( void ) collectSnapshot();
+            }
+            else
+            {
+                LogDebug( ( "Skipping a collection while snapshot %u is reported.",
+                            ( unsigned int ) snapshotIndex ) );
+            }
 
-    /* Is the response a valid JSON? */
-    jsonResult = JSON_Validate( defenderResponse, defenderResponseLength );
+            ( void ) usleep( DEFENDER_DEMO_COLLECTION_PERIOD_MS * 1000U );
+        }
 
-    if( jsonResult != JSONSuccess )
-    {
-        LogError( ( "Invalid response from AWS IoT Device Defender Service: %.*s.",
-                    ( int ) defenderResponseLength,
-                    defenderResponse ) );
+        return NULL;
     }
+/*-----------------------------------------------------------*/
 
-    if( jsonResult == JSONSuccess )
-    {
-        /* Search the reportId key in the response. */
-        jsonResult = JSON_Search( ( char * ) defenderResponse,
-                                  defenderResponseLength,
-                                  DEFENDER_RESPONSE_REPORT_ID_FIELD,
-                                  DEFENDER_RESPONSE_REPORT_ID_FIELD_LENGTH,
-                                  &( reportIdString ),
-                                  &( reportIdStringLength ) );
+#endif /* if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 ) */
 
-        if( jsonResult != JSONSuccess )
-        {
-            LogError( ( "reportId key not found in the response from the"
-                        "AWS IoT Device Defender Service: %.*s.",
-                        ( int ) defenderResponseLength,
-                        defenderResponse ) );
-        }
-    }
+static bool placeThreads( void )
+{
+    bool status = true;
 
-    if( jsonResult == JSONSuccess )
-    {
-        reportIdInResponse = ( uint32_t ) strtoul( reportIdString, NULL, 10 );
+    #if ( DEFENDER_DEMO_THREAD_PLACEMENT == 1 )
+        status = ( ThreadGroup_Define( WORKER_THREAD_GROUP, DEFENDER_DEMO_WORKER_CPUS ) == ThreadGroupSuccess ) &&
+                 ( ThreadGroup_Isolate( MQTT_IO_THREAD_GROUP, DEFENDER_DEMO_MQTT_IO_CPU ) == ThreadGroupSuccess ) &&
+                 ( ThreadGroup_JoinCurrent( MQTT_IO_THREAD_GROUP ) == ThreadGroupSuccess );
 
-        /* Is the reportId present in the response same as was sent in the
-         * published report? */
-        if( reportIdInResponse == reportId )
+        if( status == true )
         {
-            LogInfo( ( "A valid reponse with reportId %u received from the "
-                       "AWS IoT Device Defender Service.", reportId ) );
-            status = true;
+            LogInfo( ( "MQTT thread on CPU %u, other threads on CPUs %s.",
+                       ( unsigned int ) DEFENDER_DEMO_MQTT_IO_CPU,
+                       DEFENDER_DEMO_WORKER_CPUS ) );
         }
-        else
+    #endif
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static bool startMetricsCollection( void )
+{
+    bool status = true;
+
+    #if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+        collectorRunning = true;
+
+        if( ThreadGroup_CreateThread( WORKER_THREAD_GROUP, &( collectorThread ), collectorTask, NULL ) != ThreadGroupSuccess )
         {
-            LogError( ( "Unexpected reportId found in the response from the AWS"
-                        "IoT Device Defender Service. Expected: %u, Found: %u, "
-                        "Complete Response: %.*s.",
-                        reportIdInResponse,
-                        reportId,
-                        ( int ) defenderResponseLength,
-                        defenderResponse ) );
+            LogError( ( "Failed to start the thread collecting the metrics." ) );
+            collectorRunning = false;
+            status = false;
         }
-    }
+    #endif
 
     return status;
 }
 /*-----------------------------------------------------------*/
 
-static void publishCallback( MQTTPublishInfo_t * pPublishInfo,
-                             uint16_t packetIdentifier )
+static void stopMetricsCollection( void )
 {
-    DefenderStatus_t status;
-    DefenderTopic_t api;
-    bool validationResult;
-
-    /* Silence compiler warnings about unused variables. */
-    ( void ) packetIdentifier;
+    #if ( DEFENDER_DEMO_BACKGROUND_COLLECTION == 1 )
+        if( collectorRunning == true )
+        {
+            __atomic_store_n( &collectorRunning, false, __ATOMIC_RELEASE );
+            ( void ) pthread_join( collectorThread, NULL );
+        }
+    #endif
+}
+/*-----------------------------------------------------------*/
 
-    status = Defender_MatchTopic( pPublishInfo->pTopicName,
-                                  pPublishInfo->topicNameLength,
-                                  &( api ),
-                                  NULL,
-                                  NULL );
+#if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 )
 
-    if( status == DefenderSuccess )
+    static bool readSampleFile( const char * pPath,
+                                char * pBuffer )
     {
-        if( api == DefenderJsonReportAccepted )
+        bool status = false;
+        int fileDescriptor;
+        ssize_t readLength;
+
+        fileDescriptor = open( pPath, O_RDONLY );
+
+        if( fileDescriptor >= 0 )
         {
-            /* Check if the response is valid and is for the report we published. */
-            validationResult = validateDefenderResponse( pPublishInfo->pPayload,
-                                                         pPublishInfo->payloadLength );
+            readLength = read( fileDescriptor, pBuffer, SAMPLE_READ_BUFFER_SIZE - 1U );
 
-            if( validationResult == true )
+            if( readLength > 0 )
             {
-                LogInfo( ( "The defender report was accepted by the service. Response: %.*s.",
-                           ( int ) pPublishInfo->payloadLength,
-                           ( const char * ) pPublishInfo->pPayload ) );
-                reportStatus = ReportStatusAccepted;
+                pBuffer[ readLength ] = '\0';
+                status = true;
             }
+
+            ( void ) close( fileDescriptor );
         }
-        else if( api == DefenderJsonReportRejected )
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static void sampleCpuUsage( uint64_t * pCpuTimes )
+    {
+        char buffer[ SAMPLE_READ_BUFFER_SIZE ];
+        char * pCursor = NULL;
+        uint64_t cpuTimes[ CPU_TIME_COUNT ], total = 0U, idle = 0U;
+        uint32_t i;
+
+        /* The first line is "cpu  user nice system idle iowait irq softirq
+         * steal ...", in clock ticks since boot. */
+        if( ( readSampleFile( "/proc/stat", buffer ) == true ) &&
+            ( strncmp( buffer, "cpu ", 4U ) == 0 ) )
         {
-            /* Check if the response is valid and is for the report we published. */
-            validationResult = validateDefenderResponse( pPublishInfo->pPayload,
-                                                         pPublishInfo->payloadLength );
+            pCursor = &( buffer[ 4 ] );
 
-            if( validationResult == true )
+            for( i = 0U; i < CPU_TIME_COUNT; i++ )
             {
-                LogError( ( "The defender report was rejected by the service. Response: %.*s.",
-                            ( int ) pPublishInfo->payloadLength,
-                            ( const char * ) pPublishInfo->pPayload ) );
-                reportStatus = ReportStatusRejected;
+                cpuTimes[ i ] = strtoull( pCursor, &( pCursor ), 10 );
+                total += cpuTimes[ i ] - pCpuTimes[ i ];
+            }
+
+            idle = ( cpuTimes[ CPU_TIME_IDLE ] - pCpuTimes[ CPU_TIME_IDLE ] ) +
+                   ( cpuTimes[ CPU_TIME_IOWAIT ] - pCpuTimes[ CPU_TIME_IOWAIT ] );
+
+            /* The first sample has no previous one to count from. */
+            if( ( pCpuTimes[ CPU_TIME_IDLE ] != 0U ) && ( total > 0U ) )
+            {
+                RecordCustomMetricSample( &( cpuUsageMetric ),
+                                          ( uint32_t ) ( ( 100U * ( total - idle ) ) / total ) );
             }
+
+            ( void ) memcpy( pCpuTimes, cpuTimes, sizeof( cpuTimes ) );
         }
-        else
+    }
+/*-----------------------------------------------------------*/
+
+    static void sampleMemoryUsed( void )
+    {
+        char buffer[ SAMPLE_READ_BUFFER_SIZE ];
+        const char * pTotal = NULL;
+        const char * pAvailable = NULL;
+        uint64_t total, available;
+
+        if( readSampleFile( "/proc/meminfo", buffer ) == true )
         {
-            LogError( ( "Unexpected defender API : %d.", api ) );
+            pTotal = strstr( buffer, "MemTotal:" );
+            pAvailable = strstr( buffer, "MemAvailable:" );
+        }
+
+        if( ( pTotal != NULL ) && ( pAvailable != NULL ) )
+        {
+            total = strtoull( pTotal + sizeof( "MemTotal:" ) - 1U, NULL, 10 );
+            available = strtoull( pAvailable + sizeof( "MemAvailable:" ) - 1U, NULL, 10 );
+
+            if( total >= available )
+            {
+                RecordCustomMetricSample( &( memoryUsedMetric ), ( uint32_t ) ( total - available ) );
+            }
         }
     }
-    else
+/*-----------------------------------------------------------*/
+
+    static void * samplerTask( void * pArgument )
     {
-        LogError( ( "Unexpected publish message received. Topic: %.*s, Payload: %.*s.",
-                    ( int ) pPublishInfo->topicNameLength,
-                    ( const char * ) pPublishInfo->pTopicName,
-                    ( int ) pPublishInfo->payloadLength,
-                    ( const char * ) ( pPublishInfo->pPayload ) ) );
+        uint64_t cpuTimes[ CPU_TIME_COUNT ] = { 0U };
+
+        ( void ) pArgument;
+
+        while( __atomic_load_n( &samplerRunning, __ATOMIC_ACQUIRE ) == true )
+        {
+            sampleCpuUsage( cpuTimes );
+            sampleMemoryUsed();
+            ( void ) usleep( DEFENDER_DEMO_SAMPLE_PERIOD_MS * 1000U );
+        }
+
+        return NULL;
     }
-}
 /*-----------------------------------------------------------*/
 
-static bool collectDeviceMetrics( void )
+#endif /* if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 ) */
+
+static bool startCustomMetrics( void )
 {
-    bool status = false;
-    MetricsCollectorStatus_t metricsCollectorStatus;
-    uint32_t numOpenTcpPorts, numOpenUdpPorts, numEstablishedConnections;
+    bool status = true;
+
+    #if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 )
+        status = ( RegisterCustomMetric( &( cpuUsageMetric ),
+                                         CPU_USAGE_METRIC_NAME,
+                                         sizeof( CPU_USAGE_METRIC_NAME ) - 1U,
+                                         CUSTOM_METRIC_STAT_AVG | CUSTOM_METRIC_STAT_MAX |
+                                         CUSTOM_METRIC_STAT_P90 ) == CustomMetricsSuccess ) &&
+                 ( RegisterCustomMetric( &( memoryUsedMetric ),
+                                         MEMORY_USED_METRIC_NAME,
+                                         sizeof( MEMORY_USED_METRIC_NAME ) - 1U,
+                                         CUSTOM_METRIC_STAT_AVG | CUSTOM_METRIC_STAT_MAX ) == CustomMetricsSuccess );
 
-    /* Collect bytes and packets sent and received. */
-    metricsCollectorStatus = GetNetworkStats( &( networkStats ) );
+        if( status == true )
+        {
+            samplerRunning = true;
 
-    if( metricsCollectorStatus != MetricsCollectorSuccess )
-    {
-        LogError( ( "GetNetworkStats failed. Status: %d.",
-                    metricsCollectorStatus ) );
-    }
+            if( ThreadGroup_CreateThread( WORKER_THREAD_GROUP, &( samplerThread ), samplerTask, NULL ) != ThreadGroupSuccess )
+            {
+                LogError( ( "Failed to start the thread sampling the custom metrics." ) );
+                samplerRunning = false;
+                status = false;
+            }
+        }
+    #endif /* if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 ) */
 
-    /* Collect a list of open TCP ports. */
-    if( metricsCollectorStatus == MetricsCollectorSuccess )
-    {
-        metricsCollectorStatus = GetOpenTcpPorts( &( openTcpPorts[ 0 ] ),
-                                                  OPEN_TCP_PORTS_ARRAY_SIZE,
-                                                  &( numOpenTcpPorts ) );
+    return status;
+}
+/*-----------------------------------------------------------*/
 
-        if( metricsCollectorStatus != MetricsCollectorSuccess )
+static void stopCustomMetrics( void )
+{
+    #if ( DEFENDER_DEMO_CUSTOM_METRICS == 1 )
+        if( samplerRunning == true )
         {
-            LogError( ( "GetOpenTcpPorts failed. Status: %d.",
-                        metricsCollectorStatus ) );
+            __atomic_store_n( &samplerRunning, false, __ATOMIC_RELEASE );
+            ( void ) pthread_join( samplerThread, NULL );
         }
-    }
+    #endif
+}
+/*-----------------------------------------------------------*/
 
-    /* Collect a list of open UDP ports. */
-    if( metricsCollectorStatus == MetricsCollectorSuccess )
-    {
-        metricsCollectorStatus = GetOpenUdpPorts( &( openUdpPorts[ 0 ] ),
-                                                  OPEN_UDP_PORTS_ARRAY_SIZE,
-                                                  &( numOpenUdpPorts ) );
+static bool selectReportSections( void )
+{
+    bool status = true;
+
+    deviceMetrics.omittedSections = 0U;
+
+    #if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 )
+        getReportBaseline( pReportSnapshot, &( pendingBaseline ) );
+    #endif
+
+    #if ( DEFENDER_DEMO_DIFFERENTIAL_REPORTS == 1 )
+        ( void ) GetMetricsDigest( pReportSnapshot, &( pendingDigest ) );
+
+        collectionsSinceFullReport++;
+        pendingFullReport = ( hasReportedDigest == false ) ||
+                            ( collectionsSinceFullReport >= DEFENDER_DEMO_FULL_REPORT_INTERVAL );
 
-        if( metricsCollectorStatus != MetricsCollectorSuccess )
+        if( pendingFullReport == false )
         {
-            LogError( ( "GetOpenUdpPorts failed. Status: %d.",
-                        metricsCollectorStatus ) );
+            if( pendingDigest.networkStatsHash == reportedDigest.networkStatsHash )
+            {
+                deviceMetrics.omittedSections |= REPORT_SECTION_NETWORK_STATS;
+            }
+
+            if( pendingDigest.openTcpPortsHash == reportedDigest.openTcpPortsHash )
+            {
+                deviceMetrics.omittedSections |= REPORT_SECTION_TCP_PORTS;
+            }
+
+            if( pendingDigest.openUdpPortsHash == reportedDigest.openUdpPortsHash )
+            {
+                deviceMetrics.omittedSections |= REPORT_SECTION_UDP_PORTS;
+            }
+
+            if( pendingDigest.establishedConnectionsHash == reportedDigest.establishedConnectionsHash )
+            {
+                deviceMetrics.omittedSections |= REPORT_SECTION_CONNECTIONS;
+            }
+
+            if( ( deviceMetrics.omittedSections == REPORT_SECTION_ALL ) &&
+                ( deviceMetrics.customMetricsArrayLength == 0U ) )
+            {
+                LogInfo( ( "No metric changed since the last report. Skipping the report." ) );
+                status = false;
+            }
+            else
+            {
+                LogInfo( ( "Leaving the unchanged sections 0x%x out of the report.",
+                           ( unsigned int ) deviceMetrics.omittedSections ) );
+            }
         }
-    }
+    #endif /* if ( DEFENDER_DEMO_DIFFERENTIAL_REPORTS == 1 ) */
 
-    /* Collect a list of established connections. */
-    if( metricsCollectorStatus == MetricsCollectorSuccess )
-    {
-        metricsCollectorStatus = GetEstablishedConnections( &( establishedConnections[ 0 ] ),
-                                                            ESTABLISHED_CONNECTIONS_ARRAY_SIZE,
-                                                            &( numEstablishedConnections ) );
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static void recordReportAccepted( void )
+{
+    #if ( DEFENDER_DEMO_DIFFERENTIAL_REPORTS == 1 )
+        /* The sections left out had the same hashes, so the report accepted
+         * now stands for all of the pending hashes. */
+        reportedDigest = pendingDigest;
+        hasReportedDigest = true;
 
-        if( metricsCollectorStatus != MetricsCollectorSuccess )
+        if( pendingFullReport == true )
         {
-            LogError( ( "GetEstablishedConnections failed. Status: %d.",
-                        metricsCollectorStatus ) );
+            collectionsSinceFullReport = 0U;
         }
-    }
+    #endif
 
-    /* Populate device metrics. */
-    if( metricsCollectorStatus == MetricsCollectorSuccess )
+    #if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 )
+        reportedBaseline = pendingBaseline;
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+#if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 )
+
+    static void getReportBaseline( const MetricsSnapshot_t * pSnapshot,
+                                   ReportBaseline_t * pBaseline )
     {
-        status = true;
-        deviceMetrics.pNetworkStats = &( networkStats );
-        deviceMetrics.pOpenTcpPortsArray = &( openTcpPorts[ 0 ] );
-        deviceMetrics.openTcpPortsArrayLength = numOpenTcpPorts;
-        deviceMetrics.pOpenUdpPortsArray = &( openUdpPorts[ 0 ] );
-        deviceMetrics.openUdpPortsArrayLength = numOpenUdpPorts;
-        deviceMetrics.pEstablishedConnectionsArray = &( establishedConnections[ 0 ] );
-        deviceMetrics.establishedConnectionsArrayLength = numEstablishedConnections;
+        MetricsDigest_t digest;
+
+        ( void ) memset( &( digest ), 0, sizeof( MetricsDigest_t ) );
+        ( void ) GetMetricsDigest( pSnapshot, &( digest ) );
+
+        pBaseline->openTcpPortsHash = digest.openTcpPortsHash;
+        pBaseline->openUdpPortsHash = digest.openUdpPortsHash;
+        pBaseline->connectionCount = pSnapshot->establishedConnectionsArrayLength;
     }
+/*-----------------------------------------------------------*/
 
-    return status;
-}
+    static void waitForReportTrigger( void )
+    {
+        const MetricsSnapshot_t * pSnapshot = NULL;
+        ReportBaseline_t baseline;
+        time_t elapsed = 0;
+        bool triggered = false;
+
+        while( triggered == false )
+        {
+            /* The connection is kept alive, and the responses to the
+             * reports still received, between the collections. */
+            ( void ) ProcessLoop( DEFENDER_DEMO_COLLECTION_PERIOD_MS );
+
+            elapsed = time( NULL ) - lastReportTime;
+
+            if( elapsed >= ( time_t ) DEFENDER_DEMO_MAX_REPORT_INTERVAL_S )
+            {
+                LogInfo( ( "No significant change in %ld seconds. Sending the periodic report.",
+                           ( long ) elapsed ) );
+                triggered = true;
+            }
+            else if( elapsed >= ( time_t ) DEFENDER_DEMO_MIN_REPORT_INTERVAL_S )
+            {
+                /* Nothing is collected until a report may be sent. */
+                pSnapshot = acquireSnapshot();
+
+                if( pSnapshot != NULL )
+                {
+                    getReportBaseline( pSnapshot, &( baseline ) );
+                    releaseDeviceMetrics();
+
+                    if( ( baseline.openTcpPortsHash != reportedBaseline.openTcpPortsHash ) ||
+                        ( baseline.openUdpPortsHash != reportedBaseline.openUdpPortsHash ) )
+                    {
+                        LogInfo( ( "The open ports changed. Sending a report early." ) );
+                        triggered = true;
+                    }
+                    else if( baseline.connectionCount >=
+                             ( reportedBaseline.connectionCount + DEFENDER_DEMO_CONNECTION_SPIKE ) )
+                    {
+                        LogInfo( ( "Established connections went from %u to %u. Sending a report early.",
+                                   ( unsigned int ) reportedBaseline.connectionCount,
+                                   ( unsigned int ) baseline.connectionCount ) );
+                        triggered = true;
+                    }
+                    else
+                    {
+                        /* Empty else MISRA 15.7 */
+                    }
+                }
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+    }
 /*-----------------------------------------------------------*/
 
+#endif /* if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 ) */
+
 static bool generateDeviceMetricsReport( uint32_t * pOutReportLength )
 {
     bool status = false;
     ReportBuilderStatus_t reportBuilderStatus;
+    uint32_t reportLength = 0U;
+
+    /* Leave out established connections until the report fits in the buffer,
+     * with the terminating NULL of a JSON report. */
+    reportBuilderStatus = getReportBufferLength( &( reportLength ) );
+
+    while( ( reportBuilderStatus == ReportBuilderSuccess ) &&
+           ( reportLength > DEVICE_METRICS_REPORT_BUFFER_SIZE ) &&
+           ( deviceMetrics.establishedConnectionsArrayLength > 0U ) )
+    {
+        deviceMetrics.establishedConnectionsArrayLength--;
+        reportBuilderStatus = getReportBufferLength( &( reportLength ) );
+    }
+
+    /* Then leave out the last custom metrics. */
+    while( ( reportBuilderStatus == ReportBuilderSuccess ) &&
+           ( reportLength > DEVICE_METRICS_REPORT_BUFFER_SIZE ) &&
+           ( deviceMetrics.customMetricsArrayLength > 0U ) )
+    {
+        deviceMetrics.customMetricsArrayLength--;
+        reportBuilderStatus = getReportBufferLength( &( reportLength ) );
+    }
 
     /* Generate the metrics report in the format expected by the AWS IoT Device
      * Defender Service. */
-    reportBuilderStatus = GenerateJsonReport( &( deviceMetricsJsonReport[ 0 ] ),
-                                              DEVICE_METRICS_REPORT_BUFFER_SIZE,
-                                              &( deviceMetrics ),
-                                              DEVICE_METRICS_REPORT_MAJOR_VERSION,
-                                              DEVICE_METRICS_REPORT_MINOR_VERSION,
-                                              reportId,
-                                              pOutReportLength );
+    #if ( DEFENDER_DEMO_REPORT_FORMAT_CBOR == 1 )
+        reportBuilderStatus = GenerateCborReport( ( uint8_t * ) &( deviceMetricsReport[ 0 ] ),
+                                                  DEVICE_METRICS_REPORT_BUFFER_SIZE,
+                                                  &( deviceMetrics ),
+                                                  DEVICE_METRICS_REPORT_MAJOR_VERSION,
+                                                  DEVICE_METRICS_REPORT_MINOR_VERSION,
+                                                  reportId,
+                                                  pOutReportLength );
+    #else
+        reportBuilderStatus = GenerateJsonReport( &( deviceMetricsReport[ 0 ] ),
+                                                  DEVICE_METRICS_REPORT_BUFFER_SIZE,
+                                                  &( deviceMetrics ),
+                                                  DEVICE_METRICS_REPORT_MAJOR_VERSION,
+                                                  DEVICE_METRICS_REPORT_MINOR_VERSION,
+                                                  reportId,
+                                                  pOutReportLength );
+    #endif
 
     if( reportBuilderStatus != ReportBuilderSuccess )
     {
-        LogError( ( "GenerateJsonReport failed. Status: %d.",
+        LogError( ( "Failed to generate the report. Status: %d.",
                     reportBuilderStatus ) );
     }
     else
     {
         LogDebug( ( "Generated Report: %.*s.",
-                    *pOutReportLength,
-                    &( deviceMetricsJsonReport[ 0 ] ) ) );
+                    DEMO_RESPONSE_LOG_LENGTH( *pOutReportLength ),
+                    &( deviceMetricsReport[ 0 ] ) ) );
         status = true;
     }
 
@@ -463,29 +1909,19 @@ static bool subscribeToDefenderTopics( void )
 {
     bool status = false;
 
-    /* Subscribe to defender topic for responses for accepted reports. */
-    status = SubscribeToTopic( DEFENDER_API_JSON_ACCEPTED( THING_NAME ),
-                               DEFENDER_API_LENGTH_JSON_ACCEPTED( THING_NAME_LENGTH ) );
+    /* Subscribe to the defender topics for the responses for accepted and
+     * rejected reports, with a single SUBSCRIBE. */
+    status = SubscribeToTopics( defenderTopics,
+                                defenderTopicLengths,
+                                sizeof( defenderTopics ) / sizeof( defenderTopics[ 0 ] ) );
 
     if( status == false )
     {
-        LogError( ( "Failed to subscribe to defender topic: %.*s.",
-                    DEFENDER_API_LENGTH_JSON_ACCEPTED( THING_NAME_LENGTH ),
-                    DEFENDER_API_JSON_ACCEPTED( THING_NAME ) ) );
-    }
-
-    if( status == true )
-    {
-        /* Subscribe to defender topic for responses for rejected reports. */
-        status = SubscribeToTopic( DEFENDER_API_JSON_REJECTED( THING_NAME ),
-                                   DEFENDER_API_LENGTH_JSON_REJECTED( THING_NAME_LENGTH ) );
-
-        if( status == false )
-        {
-            LogError( ( "Failed to subscribe to defender topic: %.*s.",
-                        DEFENDER_API_LENGTH_JSON_REJECTED( THING_NAME_LENGTH ),
-                        DEFENDER_API_JSON_REJECTED( THING_NAME ) ) );
-        }
+        LogError( ( "Failed to subscribe to defender topics: %.*s and %.*s.",
+                    DEMO_REPORT_ACCEPTED_TOPIC_LENGTH( THING_NAME_LENGTH ),
+                    DEMO_REPORT_ACCEPTED_TOPIC( THING_NAME ),
+                    DEMO_REPORT_REJECTED_TOPIC_LENGTH( THING_NAME_LENGTH ),
+                    DEMO_REPORT_REJECTED_TOPIC( THING_NAME ) ) );
     }
 
     return status;
@@ -494,29 +1930,28 @@ static bool subscribeToDefenderTopics( void )
 
 static bool unsubscribeFromDefenderTopics( void )
 {
-    bool status = false;
-
-    /* Unsubscribe from defender accepted topic. */
-    status = UnsubscribeFromTopic( DEFENDER_API_JSON_ACCEPTED( THING_NAME ),
-                                   DEFENDER_API_LENGTH_JSON_ACCEPTED( THING_NAME_LENGTH ) );
-
-    if( status == true )
-    {
-        /* Unsubscribe from defender rejected topic. */
-        status = UnsubscribeFromTopic( DEFENDER_API_JSON_REJECTED( THING_NAME ),
-                                       DEFENDER_API_LENGTH_JSON_REJECTED( THING_NAME_LENGTH ) );
-    }
-
-    return status;
+    /* Unsubscribe from the defender accepted and rejected topics, with a
+     * single UNSUBSCRIBE. */
+    return UnsubscribeFromTopics( defenderTopics,
+                                  defenderTopicLengths,
+                                  sizeof( defenderTopics ) / sizeof( defenderTopics[ 0 ] ) );
 }
 /*-----------------------------------------------------------*/
 
 static bool publishDeviceMetricsReport( uint32_t reportLength )
 {
-    return PublishToTopic( DEFENDER_API_JSON_PUBLISH( THING_NAME ),
-                           DEFENDER_API_LENGTH_JSON_PUBLISH( THING_NAME_LENGTH ),
-                           &( deviceMetricsJsonReport[ 0 ] ),
-                           reportLength );
+    #if ( DEFENDER_DEMO_PUBLISH_IN_PLACE == 1 )
+        /* The header is written into the room before the report. */
+        return PublishToTopicInPlace( DEMO_REPORT_PUBLISH_TOPIC( THING_NAME ),
+                                      DEMO_REPORT_PUBLISH_TOPIC_LENGTH( THING_NAME_LENGTH ),
+                                      &( deviceMetricsPacket[ 0 ] ),
+                                      reportLength );
+    #else
+        return PublishToTopic( DEMO_REPORT_PUBLISH_TOPIC( THING_NAME ),
+                               DEMO_REPORT_PUBLISH_TOPIC_LENGTH( THING_NAME_LENGTH ),
+                               &( deviceMetricsReport[ 0 ] ),
+                               reportLength );
+    #endif
 }
 /*-----------------------------------------------------------*/
 
@@ -527,19 +1962,50 @@ static bool publishDeviceMetricsReport( uint32_t reportLength )
 int main( int argc,
           char ** argv )
 {
-    bool status = false;
+    bool status = false, reportNeeded = true, moreReports = false;
     int exitStatus = EXIT_FAILURE;
     uint32_t reportLength = 0, i, mqttSessionEstablished = 0;
     int demoRunCount = 0;
 
+    #if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 )
+        uint32_t reportCount = 0U;
+    #endif
+
     /* Silence compiler warnings about unused variables. */
     ( void ) argc;
     ( void ) argv;
 
+    /* Place the threads before starting any, so that they start on their
+     * CPUs. */
+    if( placeThreads() != true )
+    {
+        LogWarn( ( "Failed to place the threads, which run on any CPU." ) );
+    }
+
+    /* Start sampling the custom metrics, if enabled, so the first report has
+     * samples to aggregate. */
+    if( startCustomMetrics() != true )
+    {
+        LogError( ( "Failed to start the custom metrics." ) );
+    }
+
+    /* Start collecting the snapshots of the metrics in the background, if
+     * enabled, so the reports only wait for the first one. */
+    if( startMetricsCollection() != true )
+    {
+        LogError( ( "Failed to start the collection of the metrics." ) );
+    }
+
+    /* The reports published while the connection is down are queued by
+     * mqtt_operations.c, and sent after the next reconnect. */
+    ( void ) InitOfflinePublishQueue( offlinePublishRules,
+                                      sizeof( offlinePublishRules ) / sizeof( offlinePublishRules[ 0 ] ) );
+
     do
     {
         /* Start with report not received. */
         reportStatus = ReportStatusNotReceived;
+        reportNeeded = true;
 
         /* Set a report Id to be used.
          *
@@ -569,9 +2035,9 @@ int main( int argc,
         /******************** Subscribe to Defender topics. *******************/
 
         /* Attempt to subscribe to the AWS IoT Device Defender topics.
-         * Since this demo is using JSON, in subscribeToDefenderTopics() we
-         * subscribe to the topics to which accepted and rejected responses are
-         * received from after publishing a JSON report.
+         * In subscribeToDefenderTopics() we subscribe to the topics to which
+         * accepted and rejected responses are received from after publishing a
+         * report in the format chosen by #DEFENDER_DEMO_REPORT_FORMAT_CBOR.
          *
          * This demo uses a constant #democonfigTHING_NAME known at compile time
          * therefore we use macros to assemble defender topic strings.
@@ -609,78 +2075,121 @@ int main( int argc,
             }
         }
 
-        /*********************** Collect device metrics. **********************/
-
-        /* We then need to collect the metrics that will be sent to the AWS IoT
-         * Device Defender service. This demo uses the functions declared in
-         * metrics_collector.h to collect network metrics. For this demo, the
-         * implementation of these functions are in metrics_collector.c and
-         * collects metrics using tcp_netstat utility for FreeRTOS+TCP. */
-        if( status == true )
+        /* A single report is sent, unless DEFENDER_DEMO_ADAPTIVE_REPORTS is 1,
+         * in which case the next ones are sent over the same session when
+         * the metrics change or the longest interval has passed. */
+        do
         {
-            LogInfo( ( "Collecting device metrics..." ) );
-            status = collectDeviceMetrics();
-
-            if( status != true )
+            /*********************** Collect device metrics. **********************/
+
+            /* We then need to collect the metrics that will be sent to the AWS IoT
+             * Device Defender service. This demo uses the functions declared in
+             * metrics_collector.h to collect network metrics. For this demo, the
+             * implementation of these functions are in metrics_collector.c and
+             * collects metrics using tcp_netstat utility for FreeRTOS+TCP. If
+             * DEFENDER_DEMO_BACKGROUND_COLLECTION is 1, the last snapshot
+             * collected by the collector thread is taken instead. */
+            if( status == true )
             {
-                LogError( ( "Failed to collect device metrics." ) );
+                LogInfo( ( "Collecting device metrics..." ) );
+                status = collectDeviceMetrics();
+
+                if( status != true )
+                {
+                    LogError( ( "Failed to collect device metrics." ) );
+                }
             }
-        }
 
-        /********************** Generate defender report. *********************/
+            /* Only the sections of the metrics that changed are sent if
+             * DEFENDER_DEMO_DIFFERENTIAL_REPORTS is 1, and no report at all if
+             * none changed. */
+            if( status == true )
+            {
+                reportNeeded = selectReportSections();
+            }
 
-        /* The data needs to be incorporated into a JSON formatted report,
-         * which follows the format expected by the Device Defender service.
-         * This format is documented here:
-         * https://docs.aws.amazon.com/iot/latest/developerguide/detect-device-side-metrics.html
-         */
-        if( status == true )
-        {
-            LogInfo( ( "Generating device defender report..." ) );
-            status = generateDeviceMetricsReport( &( reportLength ) );
+            /********************** Generate defender report. *********************/
 
-            if( status != true )
+            /* The data needs to be incorporated into a JSON formatted report,
+             * which follows the format expected by the Device Defender service.
+             * This format is documented here:
+             * https://docs.aws.amazon.com/iot/latest/developerguide/detect-device-side-metrics.html
+             */
+            if( ( status == true ) && ( reportNeeded == true ) )
             {
-                LogError( ( "Failed to generate device defender report." ) );
+                LogInfo( ( "Generating device defender report..." ) );
+                status = generateDeviceMetricsReport( &( reportLength ) );
+
+                if( status != true )
+                {
+                    LogError( ( "Failed to generate device defender report." ) );
+                }
             }
-        }
 
-        /********************** Publish defender report. **********************/
+            /* The report holds the metrics now, so their snapshot can be
+             * collected into again. */
+            releaseDeviceMetrics();
 
-        /* The report is then published to the Device Defender service. This report
-         * is published to the MQTT topic for publishing JSON reports. As before,
-         * we use the defender library macros to create the topic string, though
-         * #Defender_GetTopic could be used if the Thing name is acquired at
-         * run time */
-        if( status == true )
-        {
-            LogInfo( ( "Publishing device defender report..." ) );
-            status = publishDeviceMetricsReport( reportLength );
+            /********************** Publish defender report. **********************/
 
-            if( status != true )
+            /* The report is then published to the Device Defender service. This report
+             * is published to the MQTT topic for publishing JSON reports. As before,
+             * we use the defender library macros to create the topic string, though
+             * #Defender_GetTopic could be used if the Thing name is acquired at
+             * run time */
+            if( ( status == true ) && ( reportNeeded == true ) )
             {
-                LogError( ( "Failed to publish device defender report." ) );
+                LogInfo( ( "Publishing device defender report..." ) );
+                status = publishDeviceMetricsReport( reportLength );
+
+                if( status != true )
+                {
+                    LogError( ( "Failed to publish device defender report." ) );
+                }
             }
-        }
 
-        /* Wait for the response to our report. Response will be handled by the
-         * callback passed to establishMqttSession() earlier.
-         * The callback will verify that the MQTT messages received are from the
-         * defender service's topic. Based on whether the response comes from
-         * the accepted or rejected topics, it updates reportStatus. */
-        if( status == true )
-        {
-            for( i = 0; i < DEFENDER_RESPONSE_WAIT_SECONDS; i++ )
+            /* Wait for the response to our report. Response will be handled by the
+             * callback passed to establishMqttSession() earlier.
+             * The callback will verify that the MQTT messages received are from the
+             * defender service's topic. Based on whether the response comes from
+             * the accepted or rejected topics, it updates reportStatus. */
+            if( ( status == true ) && ( reportNeeded == true ) )
             {
-                ( void ) ProcessLoop( 1000 );
-
-                /* reportStatus is updated in the publishCallback. */
-                if( reportStatus != ReportStatusNotReceived )
+                for( i = 0; i < DEFENDER_RESPONSE_WAIT_SECONDS; i++ )
                 {
-                    break;
+                    ( void ) ProcessLoop( 1000 );
+
+                    /* reportStatus is updated in the publishCallback. */
+                    if( reportStatus != ReportStatusNotReceived )
+                    {
+                        break;
+                    }
                 }
             }
-        }
+
+            #if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 )
+                moreReports = false;
+
+                if( ( status == true ) &&
+                    ( ( reportStatus == ReportStatusAccepted ) || ( reportNeeded == false ) ) )
+                {
+                    reportCount++;
+                    lastReportTime = time( NULL );
+
+                    if( reportCount < DEFENDER_DEMO_ADAPTIVE_REPORT_COUNT )
+                    {
+                        waitForReportTrigger();
+
+                        /* The report ids must increase even if the reports
+                         * are less than a second apart. */
+                        reportId = ( ( uint32_t ) time( NULL ) > reportId ) ? ( uint32_t ) time( NULL ) : ( reportId + 1U );
+                        reportStatus = ReportStatusNotReceived;
+                        reportNeeded = true;
+                        moreReports = true;
+                    }
+                }
+            #endif /* if ( DEFENDER_DEMO_ADAPTIVE_REPORTS == 1 ) */
+        } while( moreReports == true );
 
         /**************************** Disconnect. *****************************/
 
@@ -688,7 +2197,7 @@ int main( int argc,
          * protocol spec, it is okay to send UNSUBSCRIBE even if no corresponding
          * subscription exists on the broker. Therefore, it is okay to attempt
          * unsubscribe even if one more subscribe failed earlier. */
-        if( reportStatus == ReportStatusNotReceived )
+        if( ( reportNeeded == true ) && ( reportStatus == ReportStatusNotReceived ) )
         {
             LogError( ( "Failed to receive response from AWS IoT Device Defender Service." ) );
             status = false;
@@ -714,7 +2223,8 @@ int main( int argc,
 
         /****************************** Finish. ******************************/
 
-        if( ( status == true ) && ( reportStatus == ReportStatusAccepted ) )
+        if( ( status == true ) &&
+            ( ( reportStatus == ReportStatusAccepted ) || ( reportNeeded == false ) ) )
         {
             exitStatus = EXIT_SUCCESS;
         }
@@ -742,6 +2252,9 @@ int main( int argc,
         }
     } while( exitStatus != EXIT_SUCCESS );
 
+    stopMetricsCollection();
+    stopCustomMetrics();
+
     /* Log demo success. */
     if( exitStatus == EXIT_SUCCESS )
     {
@@ -192,6 +192,16 @@
  */
 #define ESTABLISHED_CONNECTIONS_ARRAY_SIZE     10
 
+/**
+ * @brief Size in bytes of each of the two arenas the metrics are collected
+ * into.
+ *
+ * An arena holds all the open ports and established connections found, of
+ * which at most #OPEN_TCP_PORTS_ARRAY_SIZE, #OPEN_UDP_PORTS_ARRAY_SIZE and
+ * #ESTABLISHED_CONNECTIONS_ARRAY_SIZE are sent in the report.
+ */
+#define METRICS_ARENA_SIZE                     4096
+
 /**
  * @brief Size of the buffer which contains the generated device defender report.
  *
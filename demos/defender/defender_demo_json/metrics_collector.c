@@ -21,13 +21,17 @@
  */
 
 /* Standard includes. */
-#include <stdio.h>
-#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
 /* POSIX includes. */
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <unistd.h>
 
 /* Demo config. */
 #include "demo_config.h"
@@ -36,10 +40,82 @@
 #include "metrics_collector.h"
 
 /**
- * @brief The maximum length of line read from any of /proc/net/dev, /proc/net/tcp
- * and /proc/net/udp.
+ * @brief Set to 1 to collect the metrics through netlink rather than by
+ * reading the files of /proc.
+ *
+ * The sockets are then dumped through NETLINK_SOCK_DIAG, which filters them
+ * on their state in the kernel, so only the sockets reported are transferred.
+ * The interface counters come from RTM_GETLINK.
+ */
+#ifndef METRICS_COLLECTOR_USE_NETLINK
+    #define METRICS_COLLECTOR_USE_NETLINK    ( 0 )
+#endif
+
+#if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+    /* Linux includes. */
+    #include <sys/socket.h>
+    #include <linux/inet_diag.h>
+    #include <linux/netlink.h>
+    #include <linux/rtnetlink.h>
+    #include <linux/sock_diag.h>
+#endif
+
+#if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+
+/**
+ * @brief Size of the buffer the netlink replies are received into.
+ *
+ * The kernel fits as many messages of a dump as the buffer takes in each
+ * reply, so a larger buffer takes fewer receives. It must be at least 8192
+ * bytes, the size of a netlink reply the kernel sends first.
+ */
+    #ifndef METRICS_COLLECTOR_NETLINK_BUFFER_SIZE
+        #define METRICS_COLLECTOR_NETLINK_BUFFER_SIZE    ( 32768U )
+    #endif
+
+    #if ( METRICS_COLLECTOR_NETLINK_BUFFER_SIZE < 8192U )
+        #error "METRICS_COLLECTOR_NETLINK_BUFFER_SIZE must be at least 8192."
+    #endif
+
+#else /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
+/**
+ * @brief Size of the buffer the files of /proc are read into.
+ *
+ * A file larger than the buffer is parsed one buffer at a time, so this only
+ * needs to hold the longest line. A larger buffer takes fewer reads.
+ */
+    #ifndef METRICS_COLLECTOR_READ_BUFFER_SIZE
+        #define METRICS_COLLECTOR_READ_BUFFER_SIZE    ( 65536U )
+    #endif
+
+/**
+ * @brief Paths of the files of /proc read by the metrics collector.
+ *
+ * They may be set to files of synthetic data, such as by the sdk_microbench
+ * benchmark, which has no control over the sockets of the host.
+ */
+    #ifndef METRICS_COLLECTOR_PROC_NET_TCP_PATH
+        #define METRICS_COLLECTOR_PROC_NET_TCP_PATH    "/proc/net/tcp"
+    #endif
+
+    #ifndef METRICS_COLLECTOR_PROC_NET_UDP_PATH
+        #define METRICS_COLLECTOR_PROC_NET_UDP_PATH    "/proc/net/udp"
+    #endif
+
+    #ifndef METRICS_COLLECTOR_PROC_NET_DEV_PATH
+        #define METRICS_COLLECTOR_PROC_NET_DEV_PATH    "/proc/net/dev"
+    #endif
+
+#endif /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
+/**
+ * @brief Number of entries a snapshot allocates in each array, more than the
+ * previous snapshot found.
  */
-#define MAX_LINE_LENGTH                  ( 256 )
+#ifndef METRICS_SNAPSHOT_SPARE_ENTRIES
+    #define METRICS_SNAPSHOT_SPARE_ENTRIES    ( 8U )
+#endif
 
 /**
  * @brief Various connection status.
@@ -47,12 +123,395 @@
 #define CONNECTION_STATUS_LISTEN         ( 10 )
 #define CONNECTION_STATUS_ESTABLISHED    ( 1 )
 
+/**
+ * @brief Parameters of the 32-bit FNV-1a hash of #GetMetricsDigest.
+ */
+#define FNV_OFFSET_BASIS_32              ( 2166136261U )
+#define FNV_PRIME_32                     ( 16777619U )
+
+/**
+ * @brief The fields of a socket used by the metrics collector.
+ */
+typedef struct SocketEntry
+{
+    uint32_t localIp;          /**< Local address, in network byte order. */
+    uint32_t localPort;        /**< Local port. */
+    uint32_t remoteIp;         /**< Remote address, in network byte order. */
+    uint32_t remotePort;       /**< Remote port. */
+    uint32_t connectionStatus; /**< TCP state of the socket. */
+} SocketEntry_t;
+
+/**
+ * @brief Context collecting the open ports.
+ */
+typedef struct OpenPortsContext
+{
+    uint16_t * pOutPortsArray;  /**< Array to write the open ports into; NULL to count them. */
+    uint32_t portsArrayLength;  /**< Length of pOutPortsArray. */
+    uint32_t numOpenPorts;      /**< Number of open ports written, or counted. */
+    uint32_t numOpenPortsFound; /**< Number of open ports found. */
+} OpenPortsContext_t;
+
+/**
+ * @brief Context collecting the established connections.
+ */
+typedef struct ConnectionsContext
+{
+    Connection_t * pOutConnectionsArray;     /**< Array to write the connections into; NULL to count them. */
+    uint32_t connectionsArrayLength;         /**< Length of pOutConnectionsArray. */
+    uint32_t numEstablishedConnections;      /**< Number of connections written, or counted. */
+    uint32_t numEstablishedConnectionsFound; /**< Number of connections found. */
+} ConnectionsContext_t;
+
+/**
+ * @brief Context collecting the sockets of a snapshot.
+ */
+typedef struct SnapshotContext
+{
+    OpenPortsContext_t * pOpenPorts;     /**< The open ports collected. */
+    ConnectionsContext_t * pConnections; /**< The connections collected; NULL if not needed. */
+} SnapshotContext_t;
+
+#if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+
+/**
+ * @brief A netlink socket used by the metrics collector.
+ *
+ * The socket stays open between collections.
+ */
+    typedef struct NetlinkSocket
+    {
+        int protocol;       /**< Netlink protocol of the socket. */
+        int fileDescriptor; /**< Descriptor of the socket; -1 if it is not open. */
+    } NetlinkSocket_t;
+
+/**
+ * @brief Function parsing a message of a netlink dump.
+ *
+ * @param[in] pMessage The message.
+ * @param[in] pContext Context of the parser.
+ *
+ * @return #MetricsCollectorSuccess if the message was parsed;
+ * #MetricsCollectorParsingFailed otherwise.
+ */
+    typedef MetricsCollectorStatus_t ( * MessageParser_t )( const struct nlmsghdr * pMessage,
+                                                            void * pContext );
+
+/**
+ * @brief A NETLINK_SOCK_DIAG request dumping the sockets.
+ */
+    typedef struct SocketDumpRequest
+    {
+        struct nlmsghdr header;
+        struct inet_diag_req_v2 request;
+    } SocketDumpRequest_t;
+
+/**
+ * @brief An RTM_GETLINK request dumping the interfaces.
+ */
+    typedef struct LinkDumpRequest
+    {
+        struct nlmsghdr header;
+        struct ifinfomsg request;
+    } LinkDumpRequest_t;
+
+/**
+ * @brief The netlink sockets used by the metrics collector.
+ */
+    static NetlinkSocket_t sockDiagSocket = { NETLINK_SOCK_DIAG, -1 };
+    static NetlinkSocket_t routeSocket = { NETLINK_ROUTE, -1 };
+
+/**
+ * @brief Sequence number of the last netlink request.
+ */
+    static uint32_t sequenceNumber = 0U;
+
+/**
+ * @brief Buffer the netlink replies are received into, reused by every
+ * collection. It is declared as uint32_t for the alignment of the messages.
+ */
+    static uint32_t netlinkBuffer[ METRICS_COLLECTOR_NETLINK_BUFFER_SIZE / sizeof( uint32_t ) ];
+
+#else /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
+/**
+ * @brief A file of /proc read by the metrics collector.
+ *
+ * The file stays open between collections, and is read again from the start
+ * each time, which the kernel regenerates.
+ */
+    typedef struct ProcFile
+    {
+        const char * pPath;   /**< Path of the file. */
+        int fileDescriptor;   /**< Descriptor of the file; -1 if it is not open. */
+        uint32_t headerLines; /**< Number of header lines to skip. */
+    } ProcFile_t;
+
+/**
+ * @brief Function parsing a line of a file of /proc.
+ *
+ * @param[in] pLine Start of the line.
+ * @param[in] pLineEnd End of the line, excluding the newline.
+ * @param[in] pContext Context of the parser.
+ * @param[out] pDone Set to true if no more lines are needed.
+ *
+ * @return #MetricsCollectorSuccess if the line was parsed;
+ * #MetricsCollectorParsingFailed otherwise.
+ */
+    typedef MetricsCollectorStatus_t ( * LineParser_t )( const char * pLine,
+                                                         const char * pLineEnd,
+                                                         void * pContext,
+                                                         bool * pDone );
+
+/**
+ * @brief The files of /proc read by the metrics collector.
+ */
+    static ProcFile_t procNetTcp = { METRICS_COLLECTOR_PROC_NET_TCP_PATH, -1, 1U };
+    static ProcFile_t procNetUdp = { METRICS_COLLECTOR_PROC_NET_UDP_PATH, -1, 1U };
+    static ProcFile_t procNetDev = { METRICS_COLLECTOR_PROC_NET_DEV_PATH, -1, 2U };
+
+/**
+ * @brief Buffer the files of /proc are read into, reused by every collection.
+ */
+    static char readBuffer[ METRICS_COLLECTOR_READ_BUFFER_SIZE ];
+
+#endif /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
+/**
+ * @brief Add a port to the open ports if it is listening.
+ *
+ * @param[in] pOpenPorts The open ports collected.
+ * @param[in] pEntry The socket.
+ *
+ * @return true if the output array is full; false otherwise.
+ */
+static bool addOpenPort( OpenPortsContext_t * pOpenPorts,
+                         const SocketEntry_t * pEntry );
+
+/**
+ * @brief Add a connection to the established connections if it is
+ * established.
+ *
+ * @param[in] pConnections The established connections collected.
+ * @param[in] pEntry The socket.
+ *
+ * @return true if the output array is full; false otherwise.
+ */
+static bool addConnection( ConnectionsContext_t * pConnections,
+                           const SocketEntry_t * pEntry );
+
+#if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+
+/**
+ * @brief Get the fields of a socket from a NETLINK_SOCK_DIAG message.
+ *
+ * @param[in] pMessage The message.
+ * @param[out] pEntry The fields of the socket.
+ *
+ * @return true if the message describes a socket; false otherwise.
+ */
+    static bool parseSocketMessage( const struct nlmsghdr * pMessage,
+                                    SocketEntry_t * pEntry );
+
+/**
+ * @brief #MessageParser_t collecting the open ports, with an
+ * #OpenPortsContext_t.
+ */
+    static MetricsCollectorStatus_t parseOpenPortMessage( const struct nlmsghdr * pMessage,
+                                                          void * pContext );
+
+/**
+ * @brief #MessageParser_t collecting the established connections, with a
+ * #ConnectionsContext_t.
+ */
+    static MetricsCollectorStatus_t parseConnectionMessage( const struct nlmsghdr * pMessage,
+                                                            void * pContext );
+
+/**
+ * @brief #MessageParser_t collecting the sockets of a snapshot, with a
+ * #SnapshotContext_t.
+ */
+    static MetricsCollectorStatus_t parseSnapshotMessage( const struct nlmsghdr * pMessage,
+                                                          void * pContext );
+
+/**
+ * @brief #MessageParser_t adding the IFLA_STATS64 counters of an interface to
+ * a #NetworkStats_t.
+ */
+    static MetricsCollectorStatus_t parseLinkMessage( const struct nlmsghdr * pMessage,
+                                                      void * pContext );
+
+/**
+ * @brief Send a dump request on a netlink socket, and call a parser for each
+ * message of the reply.
+ *
+ * The socket is opened the first time, and closed again on a failure so that
+ * the next dump does not receive what is left of a failed one.
+ *
+ * @param[in] pSocket The socket.
+ * @param[in] pRequest The request. Its sequence number is set by this
+ * function.
+ * @param[in] parser The parser of the messages.
+ * @param[in] pContext Context passed to @p parser.
+ *
+ * @return #MetricsCollectorSuccess if the dump was received and parsed;
+ * #MetricsCollectorFileOpenFailed if the socket cannot be opened, or the
+ * request sent or the reply received;
+ * #MetricsCollectorParsingFailed if the kernel reports an error or a message
+ * cannot be parsed.
+ */
+    static MetricsCollectorStatus_t dumpNetlink( NetlinkSocket_t * pSocket,
+                                                 struct nlmsghdr * pRequest,
+                                                 MessageParser_t parser,
+                                                 void * pContext );
+
+/**
+ * @brief Dump the IPv4 sockets of a protocol in some states.
+ *
+ * @param[in] protocol IPPROTO_TCP or IPPROTO_UDP.
+ * @param[in] states Bit map of the TCP states of the sockets to dump.
+ * @param[in] parser The parser of the sockets.
+ * @param[in] pContext Context passed to @p parser.
+ *
+ * @return The status of #dumpNetlink.
+ */
+    static MetricsCollectorStatus_t dumpSockets( uint8_t protocol,
+                                                 uint32_t states,
+                                                 MessageParser_t parser,
+                                                 void * pContext );
+
+#else /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
+/**
+ * @brief Skip the spaces at a position of a line.
+ *
+ * @param[in] pCursor Position in the line; NULL if parsing already failed.
+ * @param[in] pLineEnd End of the line.
+ *
+ * @return The first position that is not a space; NULL if @p pCursor is NULL.
+ */
+    static const char * skipSpaces( const char * pCursor,
+                                    const char * pLineEnd );
+
+/**
+ * @brief Skip the separator expected at a position of a line.
+ *
+ * @param[in] pCursor Position in the line; NULL if parsing already failed.
+ * @param[in] pLineEnd End of the line.
+ * @param[in] separator The character expected.
+ *
+ * @return The position after the separator; NULL if it is not there.
+ */
+    static const char * skipSeparator( const char * pCursor,
+                                       const char * pLineEnd,
+                                       char separator );
+
+/**
+ * @brief Parse a hexadecimal number of up to 8 digits.
+ *
+ * @param[in] pCursor Position in the line; NULL if parsing already failed.
+ * @param[in] pLineEnd End of the line.
+ * @param[out] pValue The number.
+ *
+ * @return The position after the number; NULL if there is no digit.
+ */
+    static const char * parseHex( const char * pCursor,
+                                  const char * pLineEnd,
+                                  uint32_t * pValue );
+
+/**
+ * @brief Parse a decimal number after optional spaces.
+ *
+ * @param[in] pCursor Position in the line; NULL if parsing already failed.
+ * @param[in] pLineEnd End of the line.
+ * @param[out] pValue The number.
+ *
+ * @return The position after the number; NULL if there is no digit.
+ */
+    static const char * parseDecimal( const char * pCursor,
+                                      const char * pLineEnd,
+                                      uint64_t * pValue );
+
+/**
+ * @brief Parse the addresses and the status of a line of /proc/net/tcp or
+ * /proc/net/udp.
+ *
+ * @param[in] pLine Start of the line.
+ * @param[in] pLineEnd End of the line.
+ * @param[out] pEntry The fields parsed.
+ *
+ * @return true if the line was parsed; false otherwise.
+ */
+    static bool parseSocketEntry( const char * pLine,
+                                  const char * pLineEnd,
+                                  SocketEntry_t * pEntry );
+
+/**
+ * @brief #LineParser_t collecting the open ports, with an
+ * #OpenPortsContext_t.
+ */
+    static MetricsCollectorStatus_t parseOpenPortLine( const char * pLine,
+                                                       const char * pLineEnd,
+                                                       void * pContext,
+                                                       bool * pDone );
+
+/**
+ * @brief #LineParser_t collecting the established connections, with a
+ * #ConnectionsContext_t.
+ */
+    static MetricsCollectorStatus_t parseConnectionLine( const char * pLine,
+                                                         const char * pLineEnd,
+                                                         void * pContext,
+                                                         bool * pDone );
+
+/**
+ * @brief #LineParser_t collecting the sockets of a snapshot, with a
+ * #SnapshotContext_t.
+ */
+    static MetricsCollectorStatus_t parseSnapshotLine( const char * pLine,
+                                                       const char * pLineEnd,
+                                                       void * pContext,
+                                                       bool * pDone );
+
+/**
+ * @brief #LineParser_t adding the statistics of an interface of
+ * /proc/net/dev to a #NetworkStats_t.
+ */
+    static MetricsCollectorStatus_t parseNetworkStatsLine( const char * pLine,
+                                                           const char * pLineEnd,
+                                                           void * pContext,
+                                                           bool * pDone );
+
+/**
+ * @brief Read a file of /proc, and call a parser for each line after the
+ * header.
+ *
+ * The file is read with pread into #readBuffer, a buffer at a time, with no
+ * copy of the lines other than moving an incomplete line to the start of the
+ * buffer.
+ *
+ * @param[in] pProcFile The file.
+ * @param[in] parser The parser of the lines.
+ * @param[in] pContext Context passed to @p parser.
+ *
+ * @return #MetricsCollectorSuccess if the file was read and parsed;
+ * #MetricsCollectorFileOpenFailed if the file cannot be opened or read;
+ * #MetricsCollectorParsingFailed if a line cannot be parsed.
+ */
+    static MetricsCollectorStatus_t readProcFile( ProcFile_t * pProcFile,
+                                                  LineParser_t parser,
+                                                  void * pContext );
+
+#endif /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
 /**
  * @brief Get a list of the open ports.
  *
- * This function finds the open ports by reading pProcFile. It can be called
- * with pOutPortsArray NULL to get the number of the open ports.
+ * This function finds the open ports by reading /proc/net/tcp or
+ * /proc/net/udp, or through NETLINK_SOCK_DIAG. It can be called with
+ * pOutPortsArray NULL to get the number of the open ports.
  *
+ * @param[in] protocol IPPROTO_TCP or IPPROTO_UDP.
  * @param[in] pOutPortsArray The array to write the open ports into. Can be
  * NULL, if only number of open ports is needed.
  * @param[in] portsArrayLength Length of the pOutPortsArray, if it is not NULL.
@@ -60,190 +519,1025 @@
  *
  * @return #MetricsCollectorSuccess if open ports are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
- * #MetricsCollectorFileOpenFailed if the function fails to open pProcFile;
- * MetricsCollectorParsingFailed if the function fails to parses the data read
- * from pProcFile.
+ * #MetricsCollectorFileOpenFailed if the function fails to open the file or
+ * the socket;
+ * MetricsCollectorParsingFailed if the function fails to parses the data read.
  */
-static MetricsCollectorStatus_t getOpenPorts( const char * pProcFile,
+static MetricsCollectorStatus_t getOpenPorts( uint8_t protocol,
                                               uint16_t * pOutPortsArray,
                                               uint32_t portsArrayLength,
                                               uint32_t * pOutNumOpenPorts );
+
+/**
+ * @brief Collect the sockets of a protocol for a snapshot, reading them once.
+ *
+ * @param[in] protocol IPPROTO_TCP or IPPROTO_UDP.
+ * @param[in] pSnapshotContext The ports, and the connections if not NULL, to
+ * collect.
+ *
+ * @return The status of reading the sockets.
+ */
+static MetricsCollectorStatus_t collectSnapshotSockets( uint8_t protocol,
+                                                        SnapshotContext_t * pSnapshotContext );
+
+/**
+ * @brief Allocate an array from an arena.
+ *
+ * @param[in] pArena The arena.
+ * @param[in] entrySize Size of an entry of the array.
+ * @param[in] numEntries Number of entries wanted.
+ * @param[out] pOutNumEntries Number of entries allocated, fewer than @p
+ * numEntries if the arena is too small.
+ *
+ * @return The array; NULL if no entry is allocated.
+ */
+static void * allocateArray( MetricsArena_t * pArena,
+                             size_t entrySize,
+                             uint32_t numEntries,
+                             uint32_t * pOutNumEntries );
+
+/**
+ * @brief Compare two ports, for qsort.
+ */
+static int comparePorts( const void * pFirst,
+                         const void * pSecond );
+
+/**
+ * @brief Compare two connections, for qsort.
+ */
+static int compareConnections( const void * pFirst,
+                               const void * pSecond );
+
+/**
+ * @brief Count the entries added and removed between two sorted arrays.
+ *
+ * @param[in] pPrevious The previous array.
+ * @param[in] previousLength Number of entries of @p pPrevious.
+ * @param[in] pCurrent The current array.
+ * @param[in] currentLength Number of entries of @p pCurrent.
+ * @param[in] entrySize Size of an entry.
+ * @param[in] compare The comparison the arrays are sorted with.
+ * @param[out] pOutAdded Number of entries of @p pCurrent not in @p pPrevious.
+ * @param[out] pOutRemoved Number of entries of @p pPrevious not in @p pCurrent.
+ */
+static void countChanges( const void * pPrevious,
+                          uint32_t previousLength,
+                          const void * pCurrent,
+                          uint32_t currentLength,
+                          size_t entrySize,
+                          int ( * compare )( const void *, const void * ),
+                          uint32_t * pOutAdded,
+                          uint32_t * pOutRemoved );
+
+/**
+ * @brief Get the increase of a counter, taking a decrease as a restart from 0.
+ */
+static uint64_t counterDelta( uint64_t previous,
+                              uint64_t current );
+
+/**
+ * @brief Add the bytes of a value to a FNV-1a hash, least significant first.
+ *
+ * @param[in] hash The hash so far.
+ * @param[in] value The value.
+ * @param[in] length Number of bytes of @p value to add.
+ *
+ * @return The hash with the bytes added.
+ */
+static uint32_t hashValue( uint32_t hash,
+                           uint64_t value,
+                           size_t length );
 /*-----------------------------------------------------------*/
 
-static MetricsCollectorStatus_t getOpenPorts( const char * pProcFile,
-                                              uint16_t * pOutPortsArray,
-                                              uint32_t portsArrayLength,
-                                              uint32_t * pOutNumOpenPorts )
+static bool addOpenPort( OpenPortsContext_t * pOpenPorts,
+                         const SocketEntry_t * pEntry )
 {
-    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    uint32_t lineNumber = 0, filledVariables;
-    uint32_t connectionStatus, localPort, numOpenPorts = 0;
-    char lineBuffer[ MAX_LINE_LENGTH ];
+    if( pEntry->connectionStatus == CONNECTION_STATUS_LISTEN )
+    {
+        pOpenPorts->numOpenPortsFound++;
+
+        if( pOpenPorts->pOutPortsArray == NULL )
+        {
+            pOpenPorts->numOpenPorts++;
+        }
+        else if( pOpenPorts->numOpenPorts < pOpenPorts->portsArrayLength )
+        {
+            pOpenPorts->pOutPortsArray[ pOpenPorts->numOpenPorts ] = ( uint16_t ) pEntry->localPort;
+            pOpenPorts->numOpenPorts++;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return ( ( pOpenPorts->pOutPortsArray != NULL ) &&
+             ( pOpenPorts->numOpenPorts == pOpenPorts->portsArrayLength ) ) ? true : false;
+}
+/*-----------------------------------------------------------*/
+
+static bool addConnection( ConnectionsContext_t * pConnections,
+                           const SocketEntry_t * pEntry )
+{
+    Connection_t * pEstablishedConnection;
+
+    if( pEntry->connectionStatus == CONNECTION_STATUS_ESTABLISHED )
+    {
+        pConnections->numEstablishedConnectionsFound++;
+
+        if( pConnections->pOutConnectionsArray == NULL )
+        {
+            pConnections->numEstablishedConnections++;
+        }
+        else if( pConnections->numEstablishedConnections < pConnections->connectionsArrayLength )
+        {
+            /* The output array member to fill. */
+            pEstablishedConnection = &( pConnections->pOutConnectionsArray[ pConnections->numEstablishedConnections ] );
+
+            pEstablishedConnection->localIp = htonl( pEntry->localIp );
+            pEstablishedConnection->remoteIp = htonl( pEntry->remoteIp );
+            pEstablishedConnection->localPort = ( uint16_t ) pEntry->localPort;
+            pEstablishedConnection->remotePort = ( uint16_t ) pEntry->remotePort;
+
+            pConnections->numEstablishedConnections++;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return ( ( pConnections->pOutConnectionsArray != NULL ) &&
+             ( pConnections->numEstablishedConnections == pConnections->connectionsArrayLength ) ) ? true : false;
+}
+/*-----------------------------------------------------------*/
+
+#if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+
+    static bool parseSocketMessage( const struct nlmsghdr * pMessage,
+                                    SocketEntry_t * pEntry )
+    {
+        bool parsed = false;
+        const struct inet_diag_msg * pSocket = NULL;
+
+        if( ( pMessage->nlmsg_type == SOCK_DIAG_BY_FAMILY ) &&
+            ( pMessage->nlmsg_len >= NLMSG_LENGTH( sizeof( struct inet_diag_msg ) ) ) )
+        {
+            pSocket = ( const struct inet_diag_msg * ) NLMSG_DATA( pMessage );
+
+            /* The addresses are kept in network byte order, as /proc/net/tcp
+             * prints them. */
+            pEntry->localIp = pSocket->id.idiag_src[ 0 ];
+            pEntry->localPort = ntohs( pSocket->id.idiag_sport );
+            pEntry->remoteIp = pSocket->id.idiag_dst[ 0 ];
+            pEntry->remotePort = ntohs( pSocket->id.idiag_dport );
+            pEntry->connectionStatus = pSocket->idiag_state;
+            parsed = true;
+        }
+        else
+        {
+            LogError( ( "Unexpected NETLINK_SOCK_DIAG message of type %u and length %u.",
+                        ( unsigned int ) pMessage->nlmsg_type,
+                        ( unsigned int ) pMessage->nlmsg_len ) );
+        }
+
+        return parsed;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t parseOpenPortMessage( const struct nlmsghdr * pMessage,
+                                                          void * pContext )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        SocketEntry_t entry;
+
+        if( parseSocketMessage( pMessage, &( entry ) ) == false )
+        {
+            status = MetricsCollectorParsingFailed;
+        }
+        else
+        {
+            /* The rest of the dump is still received, and ignored once the
+             * output array is full. */
+            ( void ) addOpenPort( ( OpenPortsContext_t * ) pContext, &( entry ) );
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t parseConnectionMessage( const struct nlmsghdr * pMessage,
+                                                            void * pContext )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        SocketEntry_t entry;
+
+        if( parseSocketMessage( pMessage, &( entry ) ) == false )
+        {
+            status = MetricsCollectorParsingFailed;
+        }
+        else
+        {
+            ( void ) addConnection( ( ConnectionsContext_t * ) pContext, &( entry ) );
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t parseSnapshotMessage( const struct nlmsghdr * pMessage,
+                                                          void * pContext )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        SnapshotContext_t * pSnapshotContext = ( SnapshotContext_t * ) pContext;
+        SocketEntry_t entry;
+
+        if( parseSocketMessage( pMessage, &( entry ) ) == false )
+        {
+            status = MetricsCollectorParsingFailed;
+        }
+        else
+        {
+            ( void ) addOpenPort( pSnapshotContext->pOpenPorts, &( entry ) );
+
+            if( pSnapshotContext->pConnections != NULL )
+            {
+                ( void ) addConnection( pSnapshotContext->pConnections, &( entry ) );
+            }
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t parseLinkMessage( const struct nlmsghdr * pMessage,
+                                                      void * pContext )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        NetworkStats_t * pNetworkStats = ( NetworkStats_t * ) pContext;
+        const struct rtattr * pAttribute = NULL;
+        struct rtnl_link_stats64 linkStats;
+        int attributesLength = 0;
+
+        if( ( pMessage->nlmsg_type != RTM_NEWLINK ) ||
+            ( pMessage->nlmsg_len < NLMSG_LENGTH( sizeof( struct ifinfomsg ) ) ) )
+        {
+            LogError( ( "Unexpected RTM_GETLINK message of type %u and length %u.",
+                        ( unsigned int ) pMessage->nlmsg_type,
+                        ( unsigned int ) pMessage->nlmsg_len ) );
+            status = MetricsCollectorParsingFailed;
+        }
+        else
+        {
+            pAttribute = IFLA_RTA( NLMSG_DATA( pMessage ) );
+            attributesLength = ( int ) IFLA_PAYLOAD( pMessage );
+
+            while( RTA_OK( pAttribute, attributesLength ) )
+            {
+                if( ( pAttribute->rta_type == IFLA_STATS64 ) &&
+                    ( RTA_PAYLOAD( pAttribute ) >= sizeof( linkStats ) ) )
+                {
+                    /* The attribute is only 4-byte aligned. */
+                    ( void ) memcpy( &( linkStats ), RTA_DATA( pAttribute ), sizeof( linkStats ) );
+
+                    pNetworkStats->bytesReceived += linkStats.rx_bytes;
+                    pNetworkStats->bytesSent += linkStats.tx_bytes;
+                    pNetworkStats->packetsReceived += linkStats.rx_packets;
+                    pNetworkStats->packetsSent += linkStats.tx_packets;
+                }
+
+                pAttribute = RTA_NEXT( pAttribute, attributesLength );
+            }
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t dumpNetlink( NetlinkSocket_t * pSocket,
+                                                 struct nlmsghdr * pRequest,
+                                                 MessageParser_t parser,
+                                                 void * pContext )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        const struct nlmsghdr * pMessage = NULL;
+        const struct nlmsgerr * pError = NULL;
+        ssize_t bytesSent = -1, bytesReceived = 0;
+        int remainingLength = 0;
+        bool done = false;
+
+        if( pSocket->fileDescriptor < 0 )
+        {
+            pSocket->fileDescriptor = socket( AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, pSocket->protocol );
+
+            if( pSocket->fileDescriptor < 0 )
+            {
+                LogError( ( "Failed to open a netlink socket of protocol %d: %s.",
+                            pSocket->protocol,
+                            strerror( errno ) ) );
+                status = MetricsCollectorFileOpenFailed;
+            }
+        }
+
+        if( status == MetricsCollectorSuccess )
+        {
+            sequenceNumber++;
+            pRequest->nlmsg_seq = sequenceNumber;
+
+            do
+            {
+                /* The kernel is the default destination of a netlink socket. */
+                bytesSent = send( pSocket->fileDescriptor, pRequest, pRequest->nlmsg_len, 0 );
+            } while( ( bytesSent < 0 ) && ( errno == EINTR ) );
+
+            if( bytesSent != ( ssize_t ) pRequest->nlmsg_len )
+            {
+                LogError( ( "Failed to send a netlink request: %s.", strerror( errno ) ) );
+                status = MetricsCollectorFileOpenFailed;
+            }
+        }
+
+        while( ( status == MetricsCollectorSuccess ) && ( done == false ) )
+        {
+            /* MSG_TRUNC returns the length of the reply even if it does not
+             * fit in the buffer. */
+            bytesReceived = recv( pSocket->fileDescriptor, netlinkBuffer, sizeof( netlinkBuffer ), MSG_TRUNC );
+
+            if( ( bytesReceived < 0 ) && ( errno == EINTR ) )
+            {
+                /* Receive again. */
+            }
+            else if( bytesReceived <= 0 )
+            {
+                LogError( ( "Failed to receive a netlink reply: %s.", strerror( errno ) ) );
+                status = MetricsCollectorFileOpenFailed;
+            }
+            else if( ( size_t ) bytesReceived > sizeof( netlinkBuffer ) )
+            {
+                LogError( ( "A netlink reply of %ld bytes is larger than the buffer.",
+                            ( long ) bytesReceived ) );
+                status = MetricsCollectorParsingFailed;
+            }
+            else
+            {
+                pMessage = ( const struct nlmsghdr * ) netlinkBuffer;
+                remainingLength = ( int ) bytesReceived;
+
+                while( ( status == MetricsCollectorSuccess ) && ( done == false ) &&
+                       NLMSG_OK( pMessage, remainingLength ) )
+                {
+                    if( pMessage->nlmsg_seq != sequenceNumber )
+                    {
+                        /* Not a reply to this request. */
+                    }
+                    else if( pMessage->nlmsg_type == NLMSG_DONE )
+                    {
+                        done = true;
+                    }
+                    else if( pMessage->nlmsg_type == NLMSG_ERROR )
+                    {
+                        pError = ( const struct nlmsgerr * ) NLMSG_DATA( pMessage );
+                        LogError( ( "Netlink request failed: %s.",
+                                    ( pMessage->nlmsg_len >= NLMSG_LENGTH( sizeof( struct nlmsgerr ) ) ) ?
+                                    strerror( -pError->error ) : "truncated error" ) );
+                        status = MetricsCollectorParsingFailed;
+                    }
+                    else
+                    {
+                        status = parser( pMessage, pContext );
+                    }
+
+                    pMessage = NLMSG_NEXT( pMessage, remainingLength );
+                }
+            }
+        }
+
+        if( ( status != MetricsCollectorSuccess ) && ( pSocket->fileDescriptor >= 0 ) )
+        {
+            ( void ) close( pSocket->fileDescriptor );
+            pSocket->fileDescriptor = -1;
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t dumpSockets( uint8_t protocol,
+                                                 uint32_t states,
+                                                 MessageParser_t parser,
+                                                 void * pContext )
+    {
+        SocketDumpRequest_t request;
+
+        ( void ) memset( &( request ), 0, sizeof( request ) );
+        request.header.nlmsg_len = sizeof( request );
+        request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+        request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        request.request.sdiag_family = AF_INET;
+        request.request.sdiag_protocol = protocol;
+        request.request.idiag_states = states;
+
+        return dumpNetlink( &( sockDiagSocket ), &( request.header ), parser, pContext );
+    }
+/*-----------------------------------------------------------*/
+
+#else /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
+    static const char * skipSpaces( const char * pCursor,
+                                    const char * pLineEnd )
+    {
+        const char * pPosition = pCursor;
+
+        if( pPosition != NULL )
+        {
+            while( ( pPosition < pLineEnd ) && ( *pPosition == ' ' ) )
+            {
+                pPosition++;
+            }
+        }
+
+        return pPosition;
+    }
+/*-----------------------------------------------------------*/
+
+    static const char * skipSeparator( const char * pCursor,
+                                       const char * pLineEnd,
+                                       char separator )
+    {
+        const char * pPosition = NULL;
+
+        if( ( pCursor != NULL ) && ( pCursor < pLineEnd ) && ( *pCursor == separator ) )
+        {
+            pPosition = pCursor + 1;
+        }
+
+        return pPosition;
+    }
+/*-----------------------------------------------------------*/
+
+    static const char * parseHex( const char * pCursor,
+                                  const char * pLineEnd,
+                                  uint32_t * pValue )
+    {
+        const char * pPosition = pCursor;
+        uint32_t value = 0U, digitCount = 0U, digit = 0U;
+        bool isDigit = true;
+
+        if( pPosition != NULL )
+        {
+            while( ( pPosition < pLineEnd ) && ( digitCount < 8U ) && ( isDigit == true ) )
+            {
+                /* Map '0'-'9', 'A'-'F' and 'a'-'f' to 0-15. The kernel prints
+                 * upper case, and any other character ends the number. */
+                digit = ( uint32_t ) ( unsigned char ) *pPosition;
+
+                if( ( digit >= ( uint32_t ) '0' ) && ( digit <= ( uint32_t ) '9' ) )
+                {
+                    digit -= ( uint32_t ) '0';
+                }
+                else if( ( ( digit | 0x20U ) >= ( uint32_t ) 'a' ) && ( ( digit | 0x20U ) <= ( uint32_t ) 'f' ) )
+                {
+                    digit = ( digit | 0x20U ) - ( uint32_t ) 'a' + 10U;
+                }
+                else
+                {
+                    isDigit = false;
+                }
+
+                if( isDigit == true )
+                {
+                    value = ( value << 4 ) | digit;
+                    digitCount++;
+                    pPosition++;
+                }
+            }
+
+            if( digitCount == 0U )
+            {
+                pPosition = NULL;
+            }
+            else
+            {
+                *pValue = value;
+            }
+        }
+
+        return pPosition;
+    }
+/*-----------------------------------------------------------*/
+
+    static const char * parseDecimal( const char * pCursor,
+                                      const char * pLineEnd,
+                                      uint64_t * pValue )
+    {
+        const char * pPosition = skipSpaces( pCursor, pLineEnd );
+        const char * pDigits = pPosition;
+        uint64_t value = 0U;
+
+        if( pPosition != NULL )
+        {
+            while( ( pPosition < pLineEnd ) && ( *pPosition >= '0' ) && ( *pPosition <= '9' ) )
+            {
+                value = ( value * 10U ) + ( uint64_t ) ( *pPosition - '0' );
+                pPosition++;
+            }
+
+            if( pPosition == pDigits )
+            {
+                pPosition = NULL;
+            }
+            else
+            {
+                *pValue = value;
+            }
+        }
+
+        return pPosition;
+    }
+/*-----------------------------------------------------------*/
+
+    static bool parseSocketEntry( const char * pLine,
+                                  const char * pLineEnd,
+                                  SocketEntry_t * pEntry )
+    {
+        const char * pCursor = NULL;
+
+        /* A line is "sl: local_ip:port remote_ip:port st ...", the addresses and
+         * the status in hexadecimal. */
+        pCursor = memchr( pLine, ':', ( size_t ) ( pLineEnd - pLine ) );
+        pCursor = skipSpaces( skipSeparator( pCursor, pLineEnd, ':' ), pLineEnd );
+        pCursor = parseHex( pCursor, pLineEnd, &( pEntry->localIp ) );
+        pCursor = parseHex( skipSeparator( pCursor, pLineEnd, ':' ), pLineEnd, &( pEntry->localPort ) );
+        pCursor = parseHex( skipSpaces( pCursor, pLineEnd ), pLineEnd, &( pEntry->remoteIp ) );
+        pCursor = parseHex( skipSeparator( pCursor, pLineEnd, ':' ), pLineEnd, &( pEntry->remotePort ) );
+        pCursor = parseHex( skipSpaces( pCursor, pLineEnd ), pLineEnd, &( pEntry->connectionStatus ) );
+
+        return ( pCursor != NULL ) ? true : false;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t parseOpenPortLine( const char * pLine,
+                                                       const char * pLineEnd,
+                                                       void * pContext,
+                                                       bool * pDone )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        OpenPortsContext_t * pOpenPorts = ( OpenPortsContext_t * ) pContext;
+        SocketEntry_t entry;
+
+        if( parseSocketEntry( pLine, pLineEnd, &( entry ) ) == false )
+        {
+            LogError( ( "Failed to parse %.*s.", ( int ) ( pLineEnd - pLine ), pLine ) );
+            status = MetricsCollectorParsingFailed;
+        }
+        else
+        {
+            *pDone = addOpenPort( pOpenPorts, &( entry ) );
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+    static MetricsCollectorStatus_t parseConnectionLine( const char * pLine,
+                                                         const char * pLineEnd,
+                                                         void * pContext,
+                                                         bool * pDone )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        ConnectionsContext_t * pConnections = ( ConnectionsContext_t * ) pContext;
+        SocketEntry_t entry;
+
+        if( parseSocketEntry( pLine, pLineEnd, &( entry ) ) == false )
+        {
+            LogError( ( "Failed to parse %.*s.", ( int ) ( pLineEnd - pLine ), pLine ) );
+            status = MetricsCollectorParsingFailed;
+        }
+        else
+        {
+            *pDone = addConnection( pConnections, &( entry ) );
+        }
 
-    if( ( pProcFile == NULL ) ||
-        ( ( pOutPortsArray != NULL ) && ( portsArrayLength == 0 ) ) ||
-        ( pOutNumOpenPorts == NULL ) )
-    {
-        LogError( ( "Invalid parameters. pProcFile: %p, pOutPortsArray: %p,"
-                    " portsArrayLength: %u, pOutNumOpenPorts: %p.",
-                    ( void * ) pProcFile,
-                    ( void * ) pOutPortsArray,
-                    portsArrayLength,
-                    ( void * ) pOutNumOpenPorts ) );
-        status = MetricsCollectorBadParameter;
+        return status;
     }
+/*-----------------------------------------------------------*/
 
-    if( status == MetricsCollectorSuccess )
+    static MetricsCollectorStatus_t parseSnapshotLine( const char * pLine,
+                                                       const char * pLineEnd,
+                                                       void * pContext,
+                                                       bool * pDone )
     {
-        fileHandle = fopen( pProcFile, "r" );
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        SnapshotContext_t * pSnapshotContext = ( SnapshotContext_t * ) pContext;
+        SocketEntry_t entry;
 
-        if( fileHandle == NULL )
+        /* Every line is read, for the counts of the entries found. */
+        ( void ) pDone;
+
+        if( parseSocketEntry( pLine, pLineEnd, &( entry ) ) == false )
+        {
+            LogError( ( "Failed to parse %.*s.", ( int ) ( pLineEnd - pLine ), pLine ) );
+            status = MetricsCollectorParsingFailed;
+        }
+        else
         {
-            LogError( ( "Failed to open %s.", pProcFile ) );
-            status = MetricsCollectorFileOpenFailed;
+            ( void ) addOpenPort( pSnapshotContext->pOpenPorts, &( entry ) );
+
+            if( pSnapshotContext->pConnections != NULL )
+            {
+                ( void ) addConnection( pSnapshotContext->pConnections, &( entry ) );
+            }
         }
+
+        return status;
     }
+/*-----------------------------------------------------------*/
 
-    if( status == MetricsCollectorSuccess )
+    static MetricsCollectorStatus_t parseNetworkStatsLine( const char * pLine,
+                                                           const char * pLineEnd,
+                                                           void * pContext,
+                                                           bool * pDone )
     {
-        while( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        NetworkStats_t * pNetworkStats = ( NetworkStats_t * ) pContext;
+        const char * pCursor = NULL;
+        uint64_t bytesReceived = 0U, bytesSent = 0U, packetsReceived = 0U, packetsSent = 0U;
+        uint64_t ignored = 0U;
+        uint32_t i = 0U;
+
+        ( void ) pDone;
+
+        /* A line is "interface: " followed by 8 receive and 8 transmit counters.
+         * The bytes and the packets are the first two of each group. */
+        pCursor = skipSeparator( memchr( pLine, ':', ( size_t ) ( pLineEnd - pLine ) ), pLineEnd, ':' );
+        pCursor = parseDecimal( pCursor, pLineEnd, &( bytesReceived ) );
+        pCursor = parseDecimal( pCursor, pLineEnd, &( packetsReceived ) );
+
+        for( i = 0U; i < 6U; i++ )
+        {
+            pCursor = parseDecimal( pCursor, pLineEnd, &( ignored ) );
+        }
+
+        pCursor = parseDecimal( pCursor, pLineEnd, &( bytesSent ) );
+        pCursor = parseDecimal( pCursor, pLineEnd, &( packetsSent ) );
+
+        if( pCursor == NULL )
+        {
+            LogError( ( "Failed to parse %.*s.", ( int ) ( pLineEnd - pLine ), pLine ) );
+            status = MetricsCollectorParsingFailed;
+        }
+        else
         {
-            lineNumber++;
+            pNetworkStats->bytesReceived += bytesReceived;
+            pNetworkStats->bytesSent += bytesSent;
+            pNetworkStats->packetsReceived += packetsReceived;
+            pNetworkStats->packetsSent += packetsSent;
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
 
-            LogDebug( ( "File: %s, Line: %u, Content: %s.",
-                        pProcFile,
-                        lineNumber,
-                        &( lineBuffer[ 0 ] ) ) );
+    static MetricsCollectorStatus_t readProcFile( ProcFile_t * pProcFile,
+                                                  LineParser_t parser,
+                                                  void * pContext )
+    {
+        MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+        const char * pLine = NULL, * pLineEnd = NULL, * pBufferEnd = NULL;
+        size_t bufferedLength = 0U, remainingLength = 0U;
+        ssize_t bytesRead = 0;
+        off_t fileOffset = 0;
+        uint32_t lineNumber = 0U;
+        bool done = false, endOfFile = false;
+
+        if( pProcFile->fileDescriptor < 0 )
+        {
+            pProcFile->fileDescriptor = open( pProcFile->pPath, O_RDONLY | O_CLOEXEC );
 
-            /* Skip the first line as it is a header. */
-            if( lineNumber <= 1 )
+            if( pProcFile->fileDescriptor < 0 )
             {
-                continue;
+                LogError( ( "Failed to open %s.", pProcFile->pPath ) );
+                status = MetricsCollectorFileOpenFailed;
             }
+        }
 
-            /* Parse the output. */
-            filledVariables = sscanf( &( lineBuffer[ 0 ] ),
-                                      "%*[^:]: %*8x:%4x %*8x:%*4x %2x",
-                                      &( localPort ),
-                                      &( connectionStatus ) );
+        while( ( status == MetricsCollectorSuccess ) && ( done == false ) && ( endOfFile == false ) )
+        {
+            bytesRead = pread( pProcFile->fileDescriptor,
+                               &( readBuffer[ bufferedLength ] ),
+                               sizeof( readBuffer ) - bufferedLength,
+                               fileOffset );
 
-            /* sscanf should fill all the 2 variables successfully. */
-            if( filledVariables != 2 )
+            if( bytesRead < 0 )
             {
-                LogError( ( "Failed to parse %s.", &( lineBuffer[ 0 ] ) ) );
-                status = MetricsCollectorParsingFailed;
-                break;
+                if( errno != EINTR )
+                {
+                    LogError( ( "Failed to read %s: %s.", pProcFile->pPath, strerror( errno ) ) );
+                    status = MetricsCollectorFileOpenFailed;
+                }
             }
-
-            if( connectionStatus == CONNECTION_STATUS_LISTEN )
+            else
             {
-                if( pOutPortsArray != NULL )
+                fileOffset += ( off_t ) bytesRead;
+                bufferedLength += ( size_t ) bytesRead;
+                endOfFile = ( bytesRead == 0 ) ? true : false;
+                pLine = &( readBuffer[ 0 ] );
+                pBufferEnd = &( readBuffer[ bufferedLength ] );
+
+                /* Parse the complete lines, and the last line at the end of the
+                 * file even without a newline. */
+                while( ( status == MetricsCollectorSuccess ) && ( done == false ) && ( pLine < pBufferEnd ) )
                 {
-                    pOutPortsArray[ numOpenPorts ] = ( uint16_t ) localPort;
-                    numOpenPorts++;
+                    pLineEnd = memchr( pLine, '\n', ( size_t ) ( pBufferEnd - pLine ) );
+
+                    if( ( pLineEnd == NULL ) && ( endOfFile == true ) )
+                    {
+                        pLineEnd = pBufferEnd;
+                    }
 
-                    /* Break if the output array is full. */
-                    if( portsArrayLength == numOpenPorts )
+                    if( pLineEnd == NULL )
                     {
+                        /* Wait for the rest of the line. */
                         break;
                     }
+
+                    if( lineNumber >= pProcFile->headerLines )
+                    {
+                        status = parser( pLine, pLineEnd, pContext, &( done ) );
+                    }
+
+                    lineNumber++;
+                    pLine = ( pLineEnd < pBufferEnd ) ? ( pLineEnd + 1 ) : pBufferEnd;
+                }
+
+                /* Move the incomplete line to the start of the buffer. */
+                remainingLength = ( size_t ) ( pBufferEnd - pLine );
+
+                if( remainingLength == sizeof( readBuffer ) )
+                {
+                    LogError( ( "A line of %s is longer than %u bytes.",
+                                pProcFile->pPath,
+                                ( unsigned int ) sizeof( readBuffer ) ) );
+                    status = MetricsCollectorParsingFailed;
+                }
+                else if( remainingLength > 0U )
+                {
+                    ( void ) memmove( &( readBuffer[ 0 ] ), pLine, remainingLength );
                 }
                 else
                 {
-                    numOpenPorts++;
+                    /* Empty else MISRA 15.7 */
                 }
+
+                bufferedLength = remainingLength;
             }
         }
+
+        /* Open the file again next time, in case its descriptor went bad. */
+        if( ( status == MetricsCollectorFileOpenFailed ) && ( pProcFile->fileDescriptor >= 0 ) )
+        {
+            ( void ) close( pProcFile->fileDescriptor );
+            pProcFile->fileDescriptor = -1;
+        }
+
+        return status;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( METRICS_COLLECTOR_USE_NETLINK == 1 ) */
+
+static MetricsCollectorStatus_t getOpenPorts( uint8_t protocol,
+                                              uint16_t * pOutPortsArray,
+                                              uint32_t portsArrayLength,
+                                              uint32_t * pOutNumOpenPorts )
+{
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+    OpenPortsContext_t openPorts;
+
+    if( ( ( pOutPortsArray != NULL ) && ( portsArrayLength == 0 ) ) ||
+        ( pOutNumOpenPorts == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pOutPortsArray: %p,"
+                    " portsArrayLength: %u, pOutNumOpenPorts: %p.",
+                    ( void * ) pOutPortsArray,
+                    portsArrayLength,
+                    ( void * ) pOutNumOpenPorts ) );
+        status = MetricsCollectorBadParameter;
     }
 
     if( status == MetricsCollectorSuccess )
     {
-        *pOutNumOpenPorts = numOpenPorts;
+        openPorts.pOutPortsArray = pOutPortsArray;
+        openPorts.portsArrayLength = portsArrayLength;
+        openPorts.numOpenPorts = 0U;
+        openPorts.numOpenPortsFound = 0U;
+
+        #if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+            status = dumpSockets( protocol,
+                                  ( uint32_t ) 1U << CONNECTION_STATUS_LISTEN,
+                                  parseOpenPortMessage,
+                                  &( openPorts ) );
+        #else
+            status = readProcFile( ( protocol == IPPROTO_TCP ) ? &( procNetTcp ) : &( procNetUdp ),
+                                   parseOpenPortLine,
+                                   &( openPorts ) );
+        #endif
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        *pOutNumOpenPorts = openPorts.numOpenPorts;
     }
 
     return status;
 }
 /*-----------------------------------------------------------*/
 
-MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats )
+static MetricsCollectorStatus_t collectSnapshotSockets( uint8_t protocol,
+                                                        SnapshotContext_t * pSnapshotContext )
 {
-    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    uint32_t lineNumber = 0, filledVariables;
-    uint32_t bytesReceived, bytesSent, packetsReceived, packetsSent;
-    char lineBuffer[ MAX_LINE_LENGTH ];
+    MetricsCollectorStatus_t status;
 
-    if( pOutNetworkStats == NULL )
+    #if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+        uint32_t states = ( uint32_t ) 1U << CONNECTION_STATUS_LISTEN;
+
+        if( pSnapshotContext->pConnections != NULL )
+        {
+            states |= ( uint32_t ) 1U << CONNECTION_STATUS_ESTABLISHED;
+        }
+
+        status = dumpSockets( protocol, states, parseSnapshotMessage, pSnapshotContext );
+    #else
+        status = readProcFile( ( protocol == IPPROTO_TCP ) ? &( procNetTcp ) : &( procNetUdp ),
+                               parseSnapshotLine,
+                               pSnapshotContext );
+    #endif
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static void * allocateArray( MetricsArena_t * pArena,
+                             size_t entrySize,
+                             uint32_t numEntries,
+                             uint32_t * pOutNumEntries )
+{
+    void * pArray = NULL;
+    size_t offset = 0U, availableEntries = 0U;
+    uintptr_t address = 0U;
+
+    /* Align the array for any of the types of the snapshot. */
+    address = ( uintptr_t ) &( pArena->pBuffer[ pArena->usedSize ] );
+    offset = pArena->usedSize + ( size_t ) ( ( sizeof( uint64_t ) - ( address % sizeof( uint64_t ) ) ) % sizeof( uint64_t ) );
+    *pOutNumEntries = 0U;
+
+    if( offset < pArena->bufferSize )
     {
-        LogError( ( "Invalid parameter. pOutNetworkStats: %p.", ( void * ) pOutNetworkStats ) );
-        status = MetricsCollectorBadParameter;
+        availableEntries = ( pArena->bufferSize - offset ) / entrySize;
+        *pOutNumEntries = ( availableEntries < numEntries ) ? ( uint32_t ) availableEntries : numEntries;
     }
 
-    if( status == MetricsCollectorSuccess )
+    if( *pOutNumEntries > 0U )
+    {
+        pArray = &( pArena->pBuffer[ offset ] );
+        pArena->usedSize = offset + ( ( size_t ) *pOutNumEntries * entrySize );
+    }
+
+    return pArray;
+}
+/*-----------------------------------------------------------*/
+
+static int comparePorts( const void * pFirst,
+                         const void * pSecond )
+{
+    return ( int ) *( ( const uint16_t * ) pFirst ) - ( int ) *( ( const uint16_t * ) pSecond );
+}
+/*-----------------------------------------------------------*/
+
+static int compareConnections( const void * pFirst,
+                               const void * pSecond )
+{
+    const Connection_t * pFirstConnection = ( const Connection_t * ) pFirst;
+    const Connection_t * pSecondConnection = ( const Connection_t * ) pSecond;
+    int result = 0;
+
+    if( pFirstConnection->remoteIp != pSecondConnection->remoteIp )
+    {
+        result = ( pFirstConnection->remoteIp < pSecondConnection->remoteIp ) ? -1 : 1;
+    }
+    else if( pFirstConnection->remotePort != pSecondConnection->remotePort )
     {
-        fileHandle = fopen( "/proc/net/dev", "r" );
+        result = ( int ) pFirstConnection->remotePort - ( int ) pSecondConnection->remotePort;
+    }
+    else if( pFirstConnection->localIp != pSecondConnection->localIp )
+    {
+        result = ( pFirstConnection->localIp < pSecondConnection->localIp ) ? -1 : 1;
+    }
+    else
+    {
+        result = ( int ) pFirstConnection->localPort - ( int ) pSecondConnection->localPort;
+    }
+
+    return result;
+}
+/*-----------------------------------------------------------*/
 
-        if( fileHandle == NULL )
+static void countChanges( const void * pPrevious,
+                          uint32_t previousLength,
+                          const void * pCurrent,
+                          uint32_t currentLength,
+                          size_t entrySize,
+                          int ( * compare )( const void *, const void * ),
+                          uint32_t * pOutAdded,
+                          uint32_t * pOutRemoved )
+{
+    const uint8_t * pPreviousEntries = ( const uint8_t * ) pPrevious;
+    const uint8_t * pCurrentEntries = ( const uint8_t * ) pCurrent;
+    uint32_t previousIndex = 0U, currentIndex = 0U, added = 0U, removed = 0U;
+    int comparison = 0;
+
+    /* Walk the two sorted arrays together. */
+    while( ( previousIndex < previousLength ) && ( currentIndex < currentLength ) )
+    {
+        comparison = compare( &( pPreviousEntries[ previousIndex * entrySize ] ),
+                              &( pCurrentEntries[ currentIndex * entrySize ] ) );
+
+        if( comparison < 0 )
+        {
+            removed++;
+            previousIndex++;
+        }
+        else if( comparison > 0 )
+        {
+            added++;
+            currentIndex++;
+        }
+        else
         {
-            LogError( ( "Failed to open /proc/net/dev." ) );
-            status = MetricsCollectorFileOpenFailed;
+            previousIndex++;
+            currentIndex++;
         }
     }
 
-    if( status == MetricsCollectorSuccess )
+    *pOutAdded = added + ( currentLength - currentIndex );
+    *pOutRemoved = removed + ( previousLength - previousIndex );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t counterDelta( uint64_t previous,
+                              uint64_t current )
+{
+    return ( current >= previous ) ? ( current - previous ) : current;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t hashValue( uint32_t hash,
+                           uint64_t value,
+                           size_t length )
+{
+    uint32_t newHash = hash;
+    size_t i;
+
+    for( i = 0U; i < length; i++ )
     {
-        /* Start with everything as zero. */
-        memset( pOutNetworkStats, 0, sizeof( NetworkStats_t ) );
+        newHash ^= ( uint32_t ) ( ( value >> ( 8U * i ) ) & 0xFFU );
+        newHash *= FNV_PRIME_32;
+    }
 
-        while( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
-        {
-            lineNumber++;
+    return newHash;
+}
+/*-----------------------------------------------------------*/
 
-            LogDebug( ( "File: /proc/net/dev, Line: %u, Content: %s.",
-                        lineNumber,
-                        &( lineBuffer[ 0 ] ) ) );
+MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats )
+{
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
 
-            /* Skip first two lines as those are headers. */
-            if( lineNumber <= 2 )
-            {
-                continue;
-            }
+    #if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+        LinkDumpRequest_t request;
+    #endif
 
-            /* Parse the output. */
-            filledVariables = sscanf( &( lineBuffer[ 0 ] ),
-                                      "%*[^:]: %u %u %*u %*u %*u %*u %*u %*u "
-                                      "%u %u %*u %*u %*u %*u %*u %*u",
-                                      &( bytesReceived ),
-                                      &( packetsReceived ),
-                                      &( bytesSent ),
-                                      &( packetsSent ) );
-
-            /* sscanf should fill all the 4 variables successfully. */
-            if( filledVariables != 4 )
-            {
-                LogError( ( "Failed to parse %s.", &( lineBuffer[ 0 ] ) ) );
-                status = MetricsCollectorParsingFailed;
-                break;
-            }
-            else
-            {
-                pOutNetworkStats->bytesReceived += bytesReceived;
-                pOutNetworkStats->bytesSent += bytesSent;
-                pOutNetworkStats->packetsReceived += packetsReceived;
-                pOutNetworkStats->packetsSent += packetsSent;
-            }
-        }
+    if( pOutNetworkStats == NULL )
+    {
+        LogError( ( "Invalid parameter. pOutNetworkStats: %p.", ( void * ) pOutNetworkStats ) );
+        status = MetricsCollectorBadParameter;
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        /* Start with everything as zero. */
+        memset( pOutNetworkStats, 0, sizeof( NetworkStats_t ) );
+
+        #if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+            ( void ) memset( &( request ), 0, sizeof( request ) );
+            request.header.nlmsg_len = sizeof( request );
+            request.header.nlmsg_type = RTM_GETLINK;
+            request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+            request.request.ifi_family = AF_UNSPEC;
+
+            status = dumpNetlink( &( routeSocket ), &( request.header ), parseLinkMessage, pOutNetworkStats );
+        #else
+            status = readProcFile( &( procNetDev ), parseNetworkStatsLine, pOutNetworkStats );
+        #endif
     }
 
     return status;
@@ -254,7 +1548,7 @@ MetricsCollectorStatus_t GetOpenTcpPorts( uint16_t * pOutTcpPortsArray,
                                           uint32_t tcpPortsArrayLength,
                                           uint32_t * pOutNumTcpOpenPorts )
 {
-    return getOpenPorts( "/proc/net/tcp",
+    return getOpenPorts( IPPROTO_TCP,
                          pOutTcpPortsArray,
                          tcpPortsArrayLength,
                          pOutNumTcpOpenPorts );
@@ -265,7 +1559,7 @@ MetricsCollectorStatus_t GetOpenUdpPorts( uint16_t * pOutUdpPortsArray,
                                           uint32_t udpPortsArrayLength,
                                           uint32_t * pOutNumUdpOpenPorts )
 {
-    return getOpenPorts( "/proc/net/udp",
+    return getOpenPorts( IPPROTO_UDP,
                          pOutUdpPortsArray,
                          udpPortsArrayLength,
                          pOutNumUdpOpenPorts );
@@ -277,11 +1571,7 @@ MetricsCollectorStatus_t GetEstablishedConnections( Connection_t * pOutConnectio
                                                     uint32_t * pOutNumEstablishedConnections )
 {
     MetricsCollectorStatus_t status = MetricsCollectorSuccess;
-    FILE * fileHandle = NULL;
-    uint32_t lineNumber = 0, filledVariables, connectionStatus;
-    uint32_t localIp, localPort, remoteIp, remotePort, numEstablishedConnections = 0;
-    Connection_t * pEstablishedConnection;
-    char lineBuffer[ MAX_LINE_LENGTH ];
+    ConnectionsContext_t connections;
 
     if( ( ( pOutConnectionsArray != NULL ) && ( connectionsArrayLength == 0 ) ) ||
         ( pOutNumEstablishedConnections == NULL ) )
@@ -296,84 +1586,254 @@ MetricsCollectorStatus_t GetEstablishedConnections( Connection_t * pOutConnectio
 
     if( status == MetricsCollectorSuccess )
     {
-        fileHandle = fopen( "/proc/net/tcp", "r" );
+        connections.pOutConnectionsArray = pOutConnectionsArray;
+        connections.connectionsArrayLength = connectionsArrayLength;
+        connections.numEstablishedConnections = 0U;
+        connections.numEstablishedConnectionsFound = 0U;
 
-        if( fileHandle == NULL )
-        {
-            LogError( ( "Failed to open /proc/net/tcp." ) );
-            status = MetricsCollectorFileOpenFailed;
-        }
+        #if ( METRICS_COLLECTOR_USE_NETLINK == 1 )
+            status = dumpSockets( IPPROTO_TCP,
+                                  ( uint32_t ) 1U << CONNECTION_STATUS_ESTABLISHED,
+                                  parseConnectionMessage,
+                                  &( connections ) );
+        #else
+            status = readProcFile( &( procNetTcp ), parseConnectionLine, &( connections ) );
+        #endif
+    }
+
+    if( status == MetricsCollectorSuccess )
+    {
+        *pOutNumEstablishedConnections = connections.numEstablishedConnections;
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+MetricsCollectorStatus_t GetMetricsSnapshot( MetricsArena_t * pArena,
+                                             const MetricsSnapshot_t * pPreviousSnapshot,
+                                             MetricsSnapshot_t * pOutSnapshot )
+{
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+    OpenPortsContext_t tcpPorts, udpPorts;
+    ConnectionsContext_t connections;
+    SnapshotContext_t snapshotContext;
+    uint32_t tcpPortsWanted = 0U, udpPortsWanted = 0U, connectionsWanted = 0U;
+
+    if( ( pArena == NULL ) || ( pArena->pBuffer == NULL ) || ( pOutSnapshot == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pArena: %p, pOutSnapshot: %p.",
+                    ( void * ) pArena,
+                    ( void * ) pOutSnapshot ) );
+        status = MetricsCollectorBadParameter;
     }
 
     if( status == MetricsCollectorSuccess )
     {
-        while( fgets( &( lineBuffer[ 0 ] ), MAX_LINE_LENGTH, fileHandle ) != NULL )
+        if( pPreviousSnapshot != NULL )
+        {
+            tcpPortsWanted = pPreviousSnapshot->numOpenTcpPorts + METRICS_SNAPSHOT_SPARE_ENTRIES;
+            udpPortsWanted = pPreviousSnapshot->numOpenUdpPorts + METRICS_SNAPSHOT_SPARE_ENTRIES;
+            connectionsWanted = pPreviousSnapshot->numEstablishedConnections + METRICS_SNAPSHOT_SPARE_ENTRIES;
+        }
+        else
         {
-            lineNumber++;
+            tcpPortsWanted = ( uint32_t ) ( ( pArena->bufferSize / 3U ) / sizeof( uint16_t ) );
+            udpPortsWanted = tcpPortsWanted;
+            connectionsWanted = ( uint32_t ) ( ( pArena->bufferSize / 3U ) / sizeof( Connection_t ) );
+        }
 
-            LogDebug( ( "File: /proc/net/tcp, Line: %u, Content: %s.",
-                        lineNumber,
-                        &( lineBuffer[ 0 ] ) ) );
+        ( void ) memset( &( tcpPorts ), 0, sizeof( tcpPorts ) );
+        ( void ) memset( &( udpPorts ), 0, sizeof( udpPorts ) );
+        ( void ) memset( &( connections ), 0, sizeof( connections ) );
 
-            /* Skip the first line as it is a header. */
-            if( lineNumber <= 1 )
-            {
-                continue;
-            }
+        /* Allocate the arena again from the start. An array of no entry is
+         * NULL, which makes the collection only count. */
+        pArena->usedSize = 0U;
+        tcpPorts.pOutPortsArray = allocateArray( pArena,
+                                                 sizeof( uint16_t ),
+                                                 tcpPortsWanted,
+                                                 &( tcpPorts.portsArrayLength ) );
+        udpPorts.pOutPortsArray = allocateArray( pArena,
+                                                 sizeof( uint16_t ),
+                                                 udpPortsWanted,
+                                                 &( udpPorts.portsArrayLength ) );
+        connections.pOutConnectionsArray = allocateArray( pArena,
+                                                          sizeof( Connection_t ),
+                                                          connectionsWanted,
+                                                          &( connections.connectionsArrayLength ) );
 
-            /* Parse the output. */
-            filledVariables = sscanf( &( lineBuffer[ 0 ] ),
-                                      "%*[^:]: %8x:%4x %8x:%4x %2x",
-                                      &( localIp ),
-                                      &( localPort ),
-                                      &( remoteIp ),
-                                      &( remotePort ),
-                                      &( connectionStatus ) );
-
-            /* sscanf should fill all the 5 variables successfully. */
-            if( filledVariables != 5 )
-            {
-                LogError( ( "Failed to parse %s.", &( lineBuffer[ 0 ] ) ) );
-                status = MetricsCollectorParsingFailed;
-                break;
-            }
+        status = GetNetworkStats( &( pOutSnapshot->networkStats ) );
+    }
 
-            if( connectionStatus == CONNECTION_STATUS_ESTABLISHED )
-            {
-                if( pOutConnectionsArray != NULL )
-                {
-                    /* The output array member to fill. */
-                    pEstablishedConnection = &( pOutConnectionsArray[ numEstablishedConnections ] );
+    /* /proc/net/tcp, or the TCP dump, gives both the ports and the
+     * connections. */
+    if( status == MetricsCollectorSuccess )
+    {
+        snapshotContext.pOpenPorts = &( tcpPorts );
+        snapshotContext.pConnections = &( connections );
+        status = collectSnapshotSockets( IPPROTO_TCP, &( snapshotContext ) );
+    }
 
-                    pEstablishedConnection->localIp = htonl( localIp );
-                    pEstablishedConnection->remoteIp = htonl( remoteIp );
-                    pEstablishedConnection->localPort = ( uint16_t ) localPort;
-                    pEstablishedConnection->remotePort = ( uint16_t ) remotePort;
+    if( status == MetricsCollectorSuccess )
+    {
+        snapshotContext.pOpenPorts = &( udpPorts );
+        snapshotContext.pConnections = NULL;
+        status = collectSnapshotSockets( IPPROTO_UDP, &( snapshotContext ) );
+    }
 
-                    numEstablishedConnections++;
+    if( status == MetricsCollectorSuccess )
+    {
+        pOutSnapshot->pOpenTcpPortsArray = tcpPorts.pOutPortsArray;
+        pOutSnapshot->openTcpPortsArrayLength = ( tcpPorts.pOutPortsArray != NULL ) ? tcpPorts.numOpenPorts : 0U;
+        pOutSnapshot->numOpenTcpPorts = tcpPorts.numOpenPortsFound;
+        pOutSnapshot->pOpenUdpPortsArray = udpPorts.pOutPortsArray;
+        pOutSnapshot->openUdpPortsArrayLength = ( udpPorts.pOutPortsArray != NULL ) ? udpPorts.numOpenPorts : 0U;
+        pOutSnapshot->numOpenUdpPorts = udpPorts.numOpenPortsFound;
+        pOutSnapshot->pEstablishedConnectionsArray = connections.pOutConnectionsArray;
+        pOutSnapshot->establishedConnectionsArrayLength = ( connections.pOutConnectionsArray != NULL ) ?
+                                                          connections.numEstablishedConnections : 0U;
+        pOutSnapshot->numEstablishedConnections = connections.numEstablishedConnectionsFound;
 
-                    /* Break if the output array is full. */
-                    if( connectionsArrayLength == numEstablishedConnections )
-                    {
-                        break;
-                    }
-                }
-                else
-                {
-                    numEstablishedConnections++;
-                }
-            }
+        /* Sorted arrays are compared by #GetMetricsDelta in one walk. */
+        if( pOutSnapshot->openTcpPortsArrayLength > 1U )
+        {
+            qsort( pOutSnapshot->pOpenTcpPortsArray,
+                   pOutSnapshot->openTcpPortsArrayLength,
+                   sizeof( uint16_t ),
+                   comparePorts );
+        }
+
+        if( pOutSnapshot->openUdpPortsArrayLength > 1U )
+        {
+            qsort( pOutSnapshot->pOpenUdpPortsArray,
+                   pOutSnapshot->openUdpPortsArrayLength,
+                   sizeof( uint16_t ),
+                   comparePorts );
+        }
+
+        if( pOutSnapshot->establishedConnectionsArrayLength > 1U )
+        {
+            qsort( pOutSnapshot->pEstablishedConnectionsArray,
+                   pOutSnapshot->establishedConnectionsArrayLength,
+                   sizeof( Connection_t ),
+                   compareConnections );
         }
     }
 
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+MetricsCollectorStatus_t GetMetricsDelta( const MetricsSnapshot_t * pPreviousSnapshot,
+                                          const MetricsSnapshot_t * pSnapshot,
+                                          MetricsDelta_t * pOutDelta )
+{
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+
+    if( ( pPreviousSnapshot == NULL ) || ( pSnapshot == NULL ) || ( pOutDelta == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pPreviousSnapshot: %p, pSnapshot: %p, pOutDelta: %p.",
+                    ( void * ) pPreviousSnapshot,
+                    ( void * ) pSnapshot,
+                    ( void * ) pOutDelta ) );
+        status = MetricsCollectorBadParameter;
+    }
+
     if( status == MetricsCollectorSuccess )
     {
-        *pOutNumEstablishedConnections = numEstablishedConnections;
+        pOutDelta->networkStats.bytesReceived = counterDelta( pPreviousSnapshot->networkStats.bytesReceived,
+                                                              pSnapshot->networkStats.bytesReceived );
+        pOutDelta->networkStats.bytesSent = counterDelta( pPreviousSnapshot->networkStats.bytesSent,
+                                                          pSnapshot->networkStats.bytesSent );
+        pOutDelta->networkStats.packetsReceived = counterDelta( pPreviousSnapshot->networkStats.packetsReceived,
+                                                                pSnapshot->networkStats.packetsReceived );
+        pOutDelta->networkStats.packetsSent = counterDelta( pPreviousSnapshot->networkStats.packetsSent,
+                                                            pSnapshot->networkStats.packetsSent );
+
+        countChanges( pPreviousSnapshot->pOpenTcpPortsArray,
+                      pPreviousSnapshot->openTcpPortsArrayLength,
+                      pSnapshot->pOpenTcpPortsArray,
+                      pSnapshot->openTcpPortsArrayLength,
+                      sizeof( uint16_t ),
+                      comparePorts,
+                      &( pOutDelta->openedTcpPorts ),
+                      &( pOutDelta->closedTcpPorts ) );
+        countChanges( pPreviousSnapshot->pOpenUdpPortsArray,
+                      pPreviousSnapshot->openUdpPortsArrayLength,
+                      pSnapshot->pOpenUdpPortsArray,
+                      pSnapshot->openUdpPortsArrayLength,
+                      sizeof( uint16_t ),
+                      comparePorts,
+                      &( pOutDelta->openedUdpPorts ),
+                      &( pOutDelta->closedUdpPorts ) );
+        countChanges( pPreviousSnapshot->pEstablishedConnectionsArray,
+                      pPreviousSnapshot->establishedConnectionsArrayLength,
+                      pSnapshot->pEstablishedConnectionsArray,
+                      pSnapshot->establishedConnectionsArrayLength,
+                      sizeof( Connection_t ),
+                      compareConnections,
+                      &( pOutDelta->openedConnections ),
+                      &( pOutDelta->closedConnections ) );
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+MetricsCollectorStatus_t GetMetricsDigest( const MetricsSnapshot_t * pSnapshot,
+                                           MetricsDigest_t * pOutDigest )
+{
+    MetricsCollectorStatus_t status = MetricsCollectorSuccess;
+    uint32_t hash, i;
+    const Connection_t * pConn;
+
+    if( ( pSnapshot == NULL ) || ( pOutDigest == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pSnapshot: %p, pOutDigest: %p.",
+                    ( void * ) pSnapshot,
+                    ( void * ) pOutDigest ) );
+        status = MetricsCollectorBadParameter;
     }
 
-    if( fileHandle != NULL )
+    if( status == MetricsCollectorSuccess )
     {
-        fclose( fileHandle );
+        hash = hashValue( FNV_OFFSET_BASIS_32, pSnapshot->networkStats.bytesReceived, sizeof( uint64_t ) );
+        hash = hashValue( hash, pSnapshot->networkStats.bytesSent, sizeof( uint64_t ) );
+        hash = hashValue( hash, pSnapshot->networkStats.packetsReceived, sizeof( uint64_t ) );
+        pOutDigest->networkStatsHash = hashValue( hash, pSnapshot->networkStats.packetsSent, sizeof( uint64_t ) );
+
+        hash = hashValue( FNV_OFFSET_BASIS_32, pSnapshot->numOpenTcpPorts, sizeof( uint32_t ) );
+
+        for( i = 0U; i < pSnapshot->openTcpPortsArrayLength; i++ )
+        {
+            hash = hashValue( hash, pSnapshot->pOpenTcpPortsArray[ i ], sizeof( uint16_t ) );
+        }
+
+        pOutDigest->openTcpPortsHash = hash;
+
+        hash = hashValue( FNV_OFFSET_BASIS_32, pSnapshot->numOpenUdpPorts, sizeof( uint32_t ) );
+
+        for( i = 0U; i < pSnapshot->openUdpPortsArrayLength; i++ )
+        {
+            hash = hashValue( hash, pSnapshot->pOpenUdpPortsArray[ i ], sizeof( uint16_t ) );
+        }
+
+        pOutDigest->openUdpPortsHash = hash;
+
+        /* Hash the connections member by member, leaving out any padding. */
+        hash = hashValue( FNV_OFFSET_BASIS_32, pSnapshot->numEstablishedConnections, sizeof( uint32_t ) );
+
+        for( i = 0U; i < pSnapshot->establishedConnectionsArrayLength; i++ )
+        {
+            pConn = &( pSnapshot->pEstablishedConnectionsArray[ i ] );
+            hash = hashValue( hash, pConn->localIp, sizeof( uint32_t ) );
+            hash = hashValue( hash, pConn->remoteIp, sizeof( uint32_t ) );
+            hash = hashValue( hash, pConn->localPort, sizeof( uint16_t ) );
+            hash = hashValue( hash, pConn->remotePort, sizeof( uint16_t ) );
+        }
+
+        pOutDigest->establishedConnectionsHash = hash;
     }
 
     return status;
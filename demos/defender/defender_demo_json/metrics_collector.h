@@ -24,6 +24,7 @@
 #define METRICS_COLLECTOR_H_
 
 /* Standard includes. */
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -42,10 +43,10 @@ typedef enum
  */
 typedef struct NetworkStats
 {
-    uint32_t bytesReceived;   /**< Number of bytes received. */
-    uint32_t bytesSent;       /**< Number of bytes sent. */
-    uint32_t packetsReceived; /**< Number of packets (ethernet frames) received. */
-    uint32_t packetsSent;     /**< Number of packets (ethernet frames) sent. */
+    uint64_t bytesReceived;   /**< Number of bytes received. */
+    uint64_t bytesSent;       /**< Number of bytes sent. */
+    uint64_t packetsReceived; /**< Number of packets (ethernet frames) received. */
+    uint64_t packetsSent;     /**< Number of packets (ethernet frames) sent. */
 } NetworkStats_t;
 
 /**
@@ -59,16 +60,80 @@ typedef struct Connection
     uint16_t remotePort;
 } Connection_t;
 
+/**
+ * @brief Memory the arrays of a #MetricsSnapshot_t are allocated from.
+ *
+ * The application provides the buffer, aligned for a #Connection_t. Each
+ * #GetMetricsSnapshot allocates the arena again from the start.
+ */
+typedef struct MetricsArena
+{
+    uint8_t * pBuffer; /**< Memory of the arena. */
+    size_t bufferSize; /**< Size of pBuffer. */
+    size_t usedSize;   /**< Number of bytes of pBuffer allocated. */
+} MetricsArena_t;
+
+/**
+ * @brief All the metrics, collected at once by #GetMetricsSnapshot.
+ *
+ * The arrays are sorted. They hold fewer entries than were found if the arena
+ * is too small, which the counts of entries found show.
+ */
+typedef struct MetricsSnapshot
+{
+    NetworkStats_t networkStats;                 /**< Network stats. */
+    uint16_t * pOpenTcpPortsArray;               /**< Open TCP ports. */
+    uint32_t openTcpPortsArrayLength;            /**< Number of entries of pOpenTcpPortsArray. */
+    uint32_t numOpenTcpPorts;                    /**< Number of open TCP ports found. */
+    uint16_t * pOpenUdpPortsArray;               /**< Open UDP ports. */
+    uint32_t openUdpPortsArrayLength;            /**< Number of entries of pOpenUdpPortsArray. */
+    uint32_t numOpenUdpPorts;                    /**< Number of open UDP ports found. */
+    Connection_t * pEstablishedConnectionsArray; /**< Established connections. */
+    uint32_t establishedConnectionsArrayLength;  /**< Number of entries of pEstablishedConnectionsArray. */
+    uint32_t numEstablishedConnections;          /**< Number of established connections found. */
+} MetricsSnapshot_t;
+
+/**
+ * @brief Changes between two #MetricsSnapshot_t.
+ */
+typedef struct MetricsDelta
+{
+    NetworkStats_t networkStats; /**< Bytes and packets since the previous snapshot. */
+    uint32_t openedTcpPorts;     /**< Number of TCP ports opened. */
+    uint32_t closedTcpPorts;     /**< Number of TCP ports closed. */
+    uint32_t openedUdpPorts;     /**< Number of UDP ports opened. */
+    uint32_t closedUdpPorts;     /**< Number of UDP ports closed. */
+    uint32_t openedConnections;  /**< Number of connections established. */
+    uint32_t closedConnections;  /**< Number of connections closed. */
+} MetricsDelta_t;
+
+/**
+ * @brief Hashes of the sections of a #MetricsSnapshot_t.
+ *
+ * Two snapshots with the same hash for a section very likely hold the same
+ * values for it, so the section can be left out of a report that would only
+ * repeat it.
+ */
+typedef struct MetricsDigest
+{
+    uint32_t networkStatsHash;           /**< Hash of the network stats. */
+    uint32_t openTcpPortsHash;           /**< Hash of the open TCP ports. */
+    uint32_t openUdpPortsHash;           /**< Hash of the open UDP ports. */
+    uint32_t establishedConnectionsHash; /**< Hash of the established connections. */
+} MetricsDigest_t;
+
 /**
  * @brief Get network stats.
  *
- * This function finds the network stats by reading "/proc/net/dev".
+ * This function finds the network stats by reading "/proc/net/dev", or through
+ * RTM_GETLINK if METRICS_COLLECTOR_USE_NETLINK is 1.
  *
  * @param[out] pOutNetworkStats The network stats.
  *
  * @return #MetricsCollectorSuccess if the network stats are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
- * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/dev";
+ * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/dev"
+ * or the netlink socket;
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/dev".
  */
@@ -77,8 +142,9 @@ MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats );
 /**
  * @brief Get a list of the open TCP ports.
  *
- * This function finds the open TCP ports by reading "/proc/net/tcp". It can be
- * called with @p pOutTcpPortsArray NULL to get the number of the open TCP ports.
+ * This function finds the open TCP ports by reading "/proc/net/tcp", or through
+ * NETLINK_SOCK_DIAG if METRICS_COLLECTOR_USE_NETLINK is 1. It can be called
+ * with @p pOutTcpPortsArray NULL to get the number of the open TCP ports.
  *
  * @param[in] pOutTcpPortsArray The array to write the open TCP ports into. This
  * can be NULL, if only the number of open ports is needed.
@@ -89,7 +155,8 @@ MetricsCollectorStatus_t GetNetworkStats( NetworkStats_t * pOutNetworkStats );
  *
  * @return #MetricsCollectorSuccess if open TCP ports are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
- * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/tcp";
+ * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/tcp"
+ * or the netlink socket;
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/tcp".
  */
@@ -100,8 +167,9 @@ MetricsCollectorStatus_t GetOpenTcpPorts( uint16_t * pOutTcpPortsArray,
 /**
  * @brief Get a list of the open UDP ports.
  *
- * This function finds the open UDP ports by reading "/proc/net/udp". It can be
- * called with pOutUdpPortsArray NULL to get the number of the open UDP ports.
+ * This function finds the open UDP ports by reading "/proc/net/udp", or through
+ * NETLINK_SOCK_DIAG if METRICS_COLLECTOR_USE_NETLINK is 1. It can be called
+ * with pOutUdpPortsArray NULL to get the number of the open UDP ports.
  *
  * @param[in] pOutUdpPortsArray The array to write the open UDP ports into. Can
  * be NULL, if only number of open ports is needed.
@@ -112,7 +180,8 @@ MetricsCollectorStatus_t GetOpenTcpPorts( uint16_t * pOutTcpPortsArray,
  *
  * @return #MetricsCollectorSuccess if open UDP ports are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
- * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/udp";
+ * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/udp"
+ * or the netlink socket;
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/udp".
  */
@@ -123,8 +192,9 @@ MetricsCollectorStatus_t GetOpenUdpPorts( uint16_t * pOutUdpPortsArray,
 /**
  * @brief Get a list of established connections.
  *
- * This function finds the established connections by reading "/proc/net/tcp".
- * It can be called with @p pOutConnectionsArray NULL to get the number of
+ * This function finds the established connections by reading "/proc/net/tcp",
+ * or through NETLINK_SOCK_DIAG if METRICS_COLLECTOR_USE_NETLINK is 1. It can
+ * be called with @p pOutConnectionsArray NULL to get the number of
  * established connections.
  *
  * @param[in] pOutConnectionsArray The array to write the established connections
@@ -137,7 +207,8 @@ MetricsCollectorStatus_t GetOpenUdpPorts( uint16_t * pOutUdpPortsArray,
  *
  * @return #MetricsCollectorSuccess if established connections are successfully obtained;
  * #MetricsCollectorBadParameter if invalid parameters are passed;
- * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/tcp";
+ * #MetricsCollectorFileOpenFailed if the function fails to open "/proc/net/tcp"
+ * or the netlink socket;
  * MetricsCollectorParsingFailed if the function fails to parses the data read
  * from "/proc/net/tcp".
  */
@@ -145,4 +216,66 @@ MetricsCollectorStatus_t GetEstablishedConnections( Connection_t * pOutConnectio
                                                     uint32_t connectionsArrayLength,
                                                     uint32_t * pOutNumEstablishedConnections );
 
+/**
+ * @brief Collect all the metrics, reading each source once.
+ *
+ * The network stats, the open TCP ports and the established connections,
+ * and the open UDP ports take one read of "/proc/net/dev", "/proc/net/tcp"
+ * and "/proc/net/udp" each, or one netlink dump each if
+ * METRICS_COLLECTOR_USE_NETLINK is 1.
+ *
+ * The arrays are allocated from @p pArena, with room for the entries found by
+ * @p pPreviousSnapshot and a few more. Without a previous snapshot, each array
+ * gets a third of the arena. The arrays that do not fit are shortened, and
+ * the next snapshot is sized from the counts found.
+ *
+ * @param[in] pArena The arena to allocate the arrays from. It must not hold
+ * the arrays of @p pPreviousSnapshot.
+ * @param[in] pPreviousSnapshot The previous snapshot. This can be NULL.
+ * @param[out] pOutSnapshot The snapshot.
+ *
+ * @return #MetricsCollectorSuccess if the metrics are successfully obtained;
+ * #MetricsCollectorBadParameter if invalid parameters are passed;
+ * #MetricsCollectorFileOpenFailed if the function fails to open a file or
+ * the netlink socket;
+ * MetricsCollectorParsingFailed if the function fails to parses the data read.
+ */
+MetricsCollectorStatus_t GetMetricsSnapshot( MetricsArena_t * pArena,
+                                             const MetricsSnapshot_t * pPreviousSnapshot,
+                                             MetricsSnapshot_t * pOutSnapshot );
+
+/**
+ * @brief Compute the changes between two snapshots.
+ *
+ * A counter lower than in the previous snapshot, as after an interface is
+ * removed, is taken as restarted from 0. The ports and connections compared
+ * are those held by the arrays of the snapshots.
+ *
+ * @param[in] pPreviousSnapshot The previous snapshot.
+ * @param[in] pSnapshot The snapshot.
+ * @param[out] pOutDelta The changes since @p pPreviousSnapshot.
+ *
+ * @return #MetricsCollectorSuccess if the changes are computed;
+ * #MetricsCollectorBadParameter if invalid parameters are passed.
+ */
+MetricsCollectorStatus_t GetMetricsDelta( const MetricsSnapshot_t * pPreviousSnapshot,
+                                          const MetricsSnapshot_t * pSnapshot,
+                                          MetricsDelta_t * pOutDelta );
+
+/**
+ * @brief Compute the hashes of the sections of a snapshot.
+ *
+ * The hashes are 32-bit FNV-1a of the entries held by the arrays and of the
+ * numbers of entries found. Since the arrays are sorted, the same set of
+ * ports or connections always gives the same hash.
+ *
+ * @param[in] pSnapshot The snapshot.
+ * @param[out] pOutDigest The hashes of the sections of @p pSnapshot.
+ *
+ * @return #MetricsCollectorSuccess if the hashes are computed;
+ * #MetricsCollectorBadParameter if invalid parameters are passed.
+ */
+MetricsCollectorStatus_t GetMetricsDigest( const MetricsSnapshot_t * pSnapshot,
+                                           MetricsDigest_t * pOutDigest );
+
 #endif /* ifndef METRICS_COLLECTOR_H_ */
@@ -36,10 +36,6 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-
-/* POSIX includes. */
-#include <unistd.h>
 
 /* Config include. */
 #include "demo_config.h"
@@ -47,14 +43,11 @@
 /* Interface include. */
 #include "mqtt_operations.h"
 
-/* OpenSSL sockets transport implementation. */
-#include "openssl_posix.h"
-
-/*Include backoff algorithm header for retry logic.*/
-#include "backoff_algorithm.h"
+/* MQTT connection shared by the demos. */
+#include "mqtt_connection.h"
 
-/* Clock for timer. */
-#include "clock.h"
+/* Subscription manager, which counts the interests in the topic filters. */
+#include "mqtt_subscription_manager.h"
 
 /**
  * These configurations are required. Throw compilation error if the below
@@ -88,29 +81,66 @@
 #endif
 
 /**
- * @brief Length of the AWS IoT endpoint.
+ * @brief Maximum number of publishes queued while the connection to the
+ * broker is down.
  */
-#define AWS_IOT_ENDPOINT_LENGTH                  ( ( uint16_t ) ( sizeof( AWS_IOT_ENDPOINT ) - 1 ) )
+#ifndef OFFLINE_PUBLISH_QUEUE_LENGTH
+    #define OFFLINE_PUBLISH_QUEUE_LENGTH    ( 8U )
+#endif
 
 /**
- * @brief Length of the client identifier.
+ * @brief Maximum length of the topic and payload of a queued publish, enough
+ * for a report of the demo and its topic.
  */
-#define CLIENT_IDENTIFIER_LENGTH                 ( ( uint16_t ) ( sizeof( CLIENT_IDENTIFIER ) - 1 ) )
+#ifndef OFFLINE_PUBLISH_SLOT_SIZE
+    #define OFFLINE_PUBLISH_SLOT_SIZE    ( 2048U )
+#endif
+
+/**
+ * @brief Maximum number of queued publishes sent after a reconnect before
+ * the PUBACKs received are processed.
+ */
+#ifndef OFFLINE_PUBLISH_DRAIN_BATCH_SIZE
+    #define OFFLINE_PUBLISH_DRAIN_BATCH_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Time spent receiving PUBACKs after each batch of queued publishes,
+ * in milliseconds.
+ */
+#ifndef OFFLINE_PUBLISH_DRAIN_INTERVAL_MS
+    #define OFFLINE_PUBLISH_DRAIN_INTERVAL_MS    ( 100U )
+#endif
 
 /**
- * @brief ALPN protocol name for AWS IoT MQTT.
+ * @brief Set to 1 to send the CONNECT as TLS 1.3 early data when a TLS
+ * session is resumed.
  *
- * This will be used if the AWS_MQTT_PORT is configured as 443 for AWS IoT MQTT
- * broker. Please see more details about the ALPN protocol for AWS IoT MQTT
- * endpoint in the link below.
- * https://aws.amazon.com/blogs/iot/mqtt-with-tls-client-authentication-on-port-443-why-it-is-useful-and-how-it-works/
+ * Has no effect unless #MQTT_EARLY_DATA_REPLAY_SAFE is also set.
  */
-#define ALPN_PROTOCOL_NAME                       "\x0ex-amzn-mqtt-ca"
+#ifndef MQTT_EARLY_CONNECT
+    #define MQTT_EARLY_CONNECT    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to declare that a replay of the early CONNECT is harmless.
+ *
+ * A replayed CONNECT makes the broker take over the session of the client
+ * identifier again. Only set it where the application tolerates that.
+ */
+#ifndef MQTT_EARLY_DATA_REPLAY_SAFE
+    #define MQTT_EARLY_DATA_REPLAY_SAFE    ( 0 )
+#endif
+
+/**
+ * @brief Length of the AWS IoT endpoint.
+ */
+#define AWS_IOT_ENDPOINT_LENGTH                  ( ( uint16_t ) ( sizeof( AWS_IOT_ENDPOINT ) - 1 ) )
 
 /**
- * @brief Length of ALPN protocol name.
+ * @brief Length of the client identifier.
  */
-#define ALPN_PROTOCOL_NAME_LENGTH                ( ( uint16_t ) ( sizeof( ALPN_PROTOCOL_NAME ) - 1 ) )
+#define CLIENT_IDENTIFIER_LENGTH                 ( ( uint16_t ) ( sizeof( CLIENT_IDENTIFIER ) - 1 ) )
 
 /**
  * @brief The maximum number of retries for connecting to server.
@@ -135,14 +165,11 @@
 /**
  * @brief Maximum number of outgoing publishes maintained in the application
  * until an ack is received from the broker.
+ *
+ * The MQTT library keeps the state of as many outgoing publishes, so a larger
+ * window only takes effect with a larger #MQTT_STATE_ARRAY_MAX_COUNT.
  */
-#define MAX_OUTGOING_PUBLISHES                   ( 5U )
-
-/**
- * @brief Invalid packet identifier for the MQTT packets. Zero is always an
- * invalid packet identifier as per MQTT 3.1.1 spec.
- */
-#define MQTT_PACKET_ID_INVALID                   ( ( uint16_t ) 0U )
+#define MAX_OUTGOING_PUBLISHES                   ( MQTT_STATE_ARRAY_MAX_COUNT )
 
 /**
  * @brief Timeout for MQTT_ProcessLoop function in milliseconds.
@@ -177,77 +204,37 @@
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Structure to keep the MQTT publish packets until an ack is received
- * for QoS1 publishes.
- */
-typedef struct PublishPackets
-{
-    /**
-     * @brief Packet identifier of the publish packet.
-     */
-    uint16_t packetId;
-
-    /**
-     * @brief Publish info of the publish packet.
-     */
-    MQTTPublishInfo_t pubInfo;
-} PublishPackets_t;
-
-/* Each compilation unit must define the NetworkContext struct. */
-struct NetworkContext
-{
-    OpensslParams_t * pParams;
-};
-/*-----------------------------------------------------------*/
-
-/**
- * @brief Packet Identifier generated when Subscribe request was sent to the broker.
- *
- * It is used to match received Subscribe ACK to the transmitted subscribe
- * request.
- */
-static uint16_t globalSubscribePacketIdentifier = 0U;
-
-/**
- * @brief Packet Identifier generated when Unsubscribe request was sent to the broker.
- *
- * It is used to match received Unsubscribe ACK to the transmitted unsubscribe
- * request.
- */
-static uint16_t globalUnsubscribePacketIdentifier = 0U;
-
-/**
- * @brief Array to keep the outgoing publish messages.
- *
- * These stored outgoing publish messages are kept until a successful ack
- * is received.
+ * @brief The network buffer must remain valid for the lifetime of the MQTT context.
  */
-static PublishPackets_t outgoingPublishPackets[ MAX_OUTGOING_PUBLISHES ] = { 0 };
+static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
 /**
- * @brief The network buffer must remain valid for the lifetime of the MQTT context.
+ * @brief Entries of the window of the outgoing publishes, kept by the
+ * connection until their PUBACK.
  */
-static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
+static PublishWindowEntry_t outgoingPublishEntries[ MAX_OUTGOING_PUBLISHES ];
 
 /**
- * @brief The MQTT context used for MQTT operation.
+ * @brief Hash buckets of the window of the outgoing publishes.
  */
-static MQTTContext_t mqttContext = { 0 };
+static uint16_t outgoingPublishBuckets[ PUBLISH_WINDOW_BUCKET_COUNT( MAX_OUTGOING_PUBLISHES ) ];
 
 /**
- * @brief The network context used for Openssl operation.
+ * @brief Entries of the queue of the publishes issued while the connection
+ * to the broker is down.
  */
-static NetworkContext_t networkContext = { 0 };
+static PublishQueueEntry_t offlinePublishEntries[ OFFLINE_PUBLISH_QUEUE_LENGTH ];
 
 /**
- * @brief The parameters for Openssl operation.
+ * @brief Copies of the topics and payloads of the queued publishes.
  */
-static OpensslParams_t opensslParams = { 0 };
+static uint8_t offlinePublishSlots[ OFFLINE_PUBLISH_QUEUE_LENGTH * OFFLINE_PUBLISH_SLOT_SIZE ];
 
 /**
- * @brief The flag to indicate that the mqtt session is established.
+ * @brief The connection to the broker, created by the first call to
+ * #InitOfflinePublishQueue or #EstablishMqttSession.
  */
-static bool mqttSessionEstablished = false;
+static MqttConnection_t * pMqttConnection = NULL;
 
 /**
  * @brief Callback registered when calling EstablishMqttSession to get incoming
@@ -257,60 +244,8 @@ static MQTTPublishCallback_t appPublishCallback = NULL;
 /*-----------------------------------------------------------*/
 
 /**
- * @brief The random number generator to use for exponential backoff with
- * jitter retry logic.
- *
- * @return The generated random number.
- */
-static uint32_t generateRandomNumber();
-
-/**
- * @brief Connect to the MQTT broker with reconnection retries.
- *
- * If connection fails, retry is attempted after a timeout. Timeout value
- * exponentially increases until maximum timeout value is reached or the number
- * of attempts are exhausted.
- *
- * @param[out] pNetworkContext The created network context.
- *
- * @return false on failure; true on successful connection.
- */
-static bool connectToBrokerWithBackoffRetries( NetworkContext_t * pNetworkContext );
-
-/**
- * @brief Get the free index in the #outgoingPublishPackets array at which an
- * outgoing publish can be stored.
- *
- * @param[out] pIndex The index at which an outgoing publish can be stored.
- *
- * @return false if no more publishes can be stored;
- * true if an index to store the next outgoing publish is obtained.
- */
-static bool getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex );
-
-/**
- * @brief Clean up the outgoing publish at given index from the
- * #outgoingPublishPackets array.
- *
- * @param[in] index The index at which a publish message has to be cleaned up.
- */
-static void cleanupOutgoingPublishAt( uint8_t index );
-
-/**
- * @brief Clean up all the outgoing publishes in the #outgoingPublishPackets array.
- */
-static void cleanupOutgoingPublishes( void );
-
-/**
- * @brief Clean up the publish packet with the given packet id. in the
- * #outgoingPublishPackets array.
- *
- * @param[in] packetId Packet id of the packet to be clean.
- */
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId );
-
-/**
- * @brief Callback registered with the MQTT library.
+ * @brief The callback function to be invoked by the MQTT connection for
+ * incoming packets, after it handled the acks.
  *
  * @param[in] pMqttContext MQTT context pointer.
  * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
@@ -321,195 +256,27 @@ static void mqttCallback( MQTTContext_t * pMqttContext,
                           MQTTDeserializedInfo_t * pDeserializedInfo );
 
 /**
- * @brief Resend the publishes if a session is re-established with the broker.
+ * @brief Create #pMqttConnection, unless it already is.
  *
- * This function handles the resending of the QoS1 publish packets, which are
- * maintained locally.
+ * @return true if the connection is created; false otherwise.
+ */
+static bool createConnection( void );
+
+/**
+ * @brief Send the SUBSCRIBE or the UNSUBSCRIBE of the topic filters whose
+ * interests changed, for SubscriptionManager_FlushInterests.
  *
- * @param[in] pMqttContext The MQTT context pointer.
+ * @param[in] pSendContext The connection.
+ * @param[in] subscribe true to subscribe; false to unsubscribe.
+ * @param[in] pSubscriptions The topic filters.
+ * @param[in] subscriptionCount Number of entries of @p pSubscriptions.
  *
- * @return true if all the unacknowledged QoS1 publishes are re-sent successfully;
- * false otherwise.
+ * @return true if the broker acknowledged the packet; false otherwise.
  */
-static bool handlePublishResend( MQTTContext_t * pMqttContext );
-/*-----------------------------------------------------------*/
-
-static uint32_t generateRandomNumber()
-{
-    return( rand() );
-}
-
-/*-----------------------------------------------------------*/
-
-static bool connectToBrokerWithBackoffRetries( NetworkContext_t * pNetworkContext )
-{
-    bool returnStatus = false;
-    BackoffAlgorithmStatus_t backoffAlgStatus = BackoffAlgorithmSuccess;
-    OpensslStatus_t opensslStatus = OPENSSL_SUCCESS;
-    BackoffAlgorithmContext_t reconnectParams;
-    ServerInfo_t serverInfo;
-    OpensslCredentials_t opensslCredentials;
-    uint16_t nextRetryBackOff = 0U;
-    struct timespec tp;
-
-    /* Set the pParams member of the network context with desired transport. */
-    pNetworkContext->pParams = &opensslParams;
-
-    /* Initialize information to connect to the MQTT broker. */
-    serverInfo.pHostName = AWS_IOT_ENDPOINT;
-    serverInfo.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
-    serverInfo.port = AWS_MQTT_PORT;
-
-    /* Initialize credentials for establishing TLS session. */
-    ( void ) memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
-    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
-    opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
-    opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
-    opensslCredentials.sniHostName = AWS_IOT_ENDPOINT;
-
-    if( AWS_MQTT_PORT == 443 )
-    {
-        /* Pass the ALPN protocol name depending on the port being used.
-         * Please see more details about the ALPN protocol for AWS IoT MQTT endpoint
-         * in the link below.
-         * https://aws.amazon.com/blogs/iot/mqtt-with-tls-client-authentication-on-port-443-why-it-is-useful-and-how-it-works/
-         */
-        opensslCredentials.pAlpnProtos = ALPN_PROTOCOL_NAME;
-        opensslCredentials.alpnProtosLen = ALPN_PROTOCOL_NAME_LENGTH;
-    }
-
-    /* Seed pseudo random number generator used in the demo for
-     * backoff period calculation when retrying failed network operations
-     * with broker. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
-
-    /* Initialize reconnect attempts and interval */
-    BackoffAlgorithm_InitializeParams( &reconnectParams,
-                                       CONNECTION_RETRY_BACKOFF_BASE_MS,
-                                       CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS,
-                                       CONNECTION_RETRY_MAX_ATTEMPTS );
-
-    /* Attempt to connect to MQTT broker. If connection fails, retry after
-     * a timeout. Timeout value will exponentially increase until maximum
-     * attempts are reached. */
-    do
-    {
-        /* Establish a TLS session with the MQTT broker. This example connects
-         * to the MQTT broker as specified in AWS_IOT_ENDPOINT and AWS_MQTT_PORT
-         * at the demo config header. */
-        LogDebug( ( "Establishing a TLS session to %.*s:%d.",
-                    AWS_IOT_ENDPOINT_LENGTH,
-                    AWS_IOT_ENDPOINT,
-                    AWS_MQTT_PORT ) );
-        opensslStatus = Openssl_Connect( pNetworkContext,
-                                         &serverInfo,
-                                         &opensslCredentials,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS );
-
-        if( opensslStatus == OPENSSL_SUCCESS )
-        {
-            /* Connection successful. */
-            returnStatus = true;
-        }
-        else
-        {
-            /* Generate a random number and get back-off value (in milliseconds) for the next connection retry. */
-            backoffAlgStatus = BackoffAlgorithm_GetNextBackoff( &reconnectParams, generateRandomNumber(), &nextRetryBackOff );
-
-            if( backoffAlgStatus == BackoffAlgorithmRetriesExhausted )
-            {
-                LogError( ( "Connection to the broker failed, all attempts exhausted." ) );
-            }
-            else if( backoffAlgStatus == BackoffAlgorithmSuccess )
-            {
-                LogWarn( ( "Connection to the broker failed. Retrying connection "
-                           "after %hu ms backoff.",
-                           ( unsigned short ) nextRetryBackOff ) );
-                Clock_SleepMs( nextRetryBackOff );
-            }
-        }
-    } while( ( opensslStatus != OPENSSL_SUCCESS ) && ( backoffAlgStatus == BackoffAlgorithmSuccess ) );
-
-    return returnStatus;
-}
-/*-----------------------------------------------------------*/
-
-static bool getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex )
-{
-    bool returnStatus = false;
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( pIndex != NULL );
-
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        /* A free index is marked by invalid packet id. Check if the the index
-         * has a free slot. */
-        if( outgoingPublishPackets[ index ].packetId == MQTT_PACKET_ID_INVALID )
-        {
-            returnStatus = true;
-            break;
-        }
-    }
-
-    /* Copy the available index into the output param. */
-    if( returnStatus == true )
-    {
-        *pIndex = index;
-    }
-
-    return returnStatus;
-}
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishAt( uint8_t index )
-{
-    assert( outgoingPublishPackets != NULL );
-    assert( index < MAX_OUTGOING_PUBLISHES );
-
-    /* Clear the outgoing publish packet. */
-    ( void ) memset( &( outgoingPublishPackets[ index ] ),
-                     0x00,
-                     sizeof( outgoingPublishPackets[ index ] ) );
-}
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishes( void )
-{
-    assert( outgoingPublishPackets != NULL );
-
-    /* Clean up all the outgoing publish packets. */
-    ( void ) memset( outgoingPublishPackets, 0x00, sizeof( outgoingPublishPackets ) );
-}
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId )
-{
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( packetId != MQTT_PACKET_ID_INVALID );
-
-    /* Clean up the saved outgoing publish with packet Id equal to packetId. */
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
-    {
-        if( outgoingPublishPackets[ index ].packetId == packetId )
-        {
-            cleanupOutgoingPublishAt( index );
-
-            LogDebug( ( "Cleaned up outgoing publish packet with packet id %u.",
-                        packetId ) );
-
-            break;
-        }
-    }
-}
+static bool sendSubscriptions( void * pSendContext,
+                               bool subscribe,
+                               const MQTTSubscribeInfo_t * pSubscriptions,
+                               size_t subscriptionCount );
 /*-----------------------------------------------------------*/
 
 static void mqttCallback( MQTTContext_t * pMqttContext,
@@ -543,23 +310,16 @@ static void mqttCallback( MQTTContext_t * pMqttContext,
     }
     else
     {
-        /* Handle other packets. */
+        /* The connection already matched the acks with their requests, and
+         * removed the acknowledged publishes from its window. */
         switch( pPacketInfo->type )
         {
             case MQTT_PACKET_TYPE_SUBACK:
                 LogDebug( ( "MQTT Packet type SUBACK received." ) );
-
-                /* Make sure the ACK packet identifier matches with the request
-                 * packet identifier. */
-                assert( globalSubscribePacketIdentifier == packetIdentifier );
                 break;
 
             case MQTT_PACKET_TYPE_UNSUBACK:
                 LogDebug( ( "MQTT Packet type UNSUBACK received." ) );
-
-                /* Make sure the ACK packet identifier matches with the request
-                 * packet identifier. */
-                assert( globalUnsubscribePacketIdentifier == packetIdentifier );
                 break;
 
             case MQTT_PACKET_TYPE_PINGRESP:
@@ -573,10 +333,6 @@ static void mqttCallback( MQTTContext_t * pMqttContext,
             case MQTT_PACKET_TYPE_PUBACK:
                 LogDebug( ( "PUBACK received for packet id %u.",
                             packetIdentifier ) );
-
-                /* Cleanup the publish packet from the #outgoingPublishPackets
-                 * array when a PUBACK is received. */
-                cleanupOutgoingPublishWithPacketID( packetIdentifier );
                 break;
 
             /* Any other packet type is invalid. */
@@ -588,291 +344,192 @@ static void mqttCallback( MQTTContext_t * pMqttContext,
 }
 /*-----------------------------------------------------------*/
 
-static bool handlePublishResend( MQTTContext_t * pMqttContext )
+static bool createConnection( void )
 {
-    bool returnStatus = false;
-    MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t index = 0U;
+    bool returnStatus = true;
+    MqttConnectionConfig_t config;
+    MqttConnectionBuffers_t buffers;
 
-    assert( outgoingPublishPackets != NULL );
-
-    /* Resend all the QoS1 publishes still in the #outgoingPublishPackets array.
-     * These are the publishes that haven't received a PUBACK yet. When a PUBACK
-     * is received, the corresponding publish is removed from the array. */
-    for( index = 0U; index < MAX_OUTGOING_PUBLISHES; index++ )
+    if( pMqttConnection == NULL )
     {
-        if( outgoingPublishPackets[ index ].packetId != MQTT_PACKET_ID_INVALID )
+        /* The broker, and the session of the demo. */
+        config.pHostName = AWS_IOT_ENDPOINT;
+        config.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
+        config.port = AWS_MQTT_PORT;
+        config.pRootCaPath = ROOT_CA_CERT_PATH;
+        config.pClientCertPath = CLIENT_CERT_PATH;
+        config.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+        config.pClientIdentifier = CLIENT_IDENTIFIER;
+        config.clientIdentifierLength = CLIENT_IDENTIFIER_LENGTH;
+        config.pUserName = METRICS_STRING;
+        config.userNameLength = METRICS_STRING_LENGTH;
+        config.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+        config.transportTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+        config.connackTimeoutMs = CONNACK_RECV_TIMEOUT_MS;
+        config.earlyConnect = ( MQTT_EARLY_CONNECT != 0 );
+        config.earlyDataReplaySafe = ( MQTT_EARLY_DATA_REPLAY_SAFE != 0 );
+        config.releaseIdleBuffers = false;
+        config.maxFragmentLength = 0U;
+        config.ocspMode = OPENSSL_OCSP_DISABLED;
+        config.cacheVerifiedChains = false;
+        config.ackTimeoutMs = MQTT_PROCESS_LOOP_TIMEOUT_MS;
+        config.adaptiveTimeouts = false;
+        config.retryBaseMs = CONNECTION_RETRY_BACKOFF_BASE_MS;
+        config.retryMaxDelayMs = CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS;
+        config.retryMaxAttempts = CONNECTION_RETRY_MAX_ATTEMPTS;
+        config.drainBatchSize = OFFLINE_PUBLISH_DRAIN_BATCH_SIZE;
+        config.drainIntervalMs = OFFLINE_PUBLISH_DRAIN_INTERVAL_MS;
+        config.pStorePath = NULL;
+        config.storeSize = 0U;
+        config.eventCallback = mqttCallback;
+        config.payloadBufferCallback = NULL;
+        config.payloadChunkCallback = NULL;
+        config.pUserContext = NULL;
+
+        /* The memory of the connection. The demo sends no batches. */
+        buffers.pNetworkBuffer = buffer;
+        buffers.networkBufferSize = NETWORK_BUFFER_SIZE;
+        buffers.pWindowEntries = outgoingPublishEntries;
+        buffers.windowLength = MAX_OUTGOING_PUBLISHES;
+        buffers.pWindowBuckets = outgoingPublishBuckets;
+        buffers.pQueueEntries = offlinePublishEntries;
+        buffers.queueLength = OFFLINE_PUBLISH_QUEUE_LENGTH;
+        buffers.pQueueSlots = offlinePublishSlots;
+        buffers.queueSlotSize = OFFLINE_PUBLISH_SLOT_SIZE;
+        buffers.pBatchBuffer = NULL;
+        buffers.batchBufferSize = 0U;
+
+        if( MqttConnection_Create( &pMqttConnection, &config, &buffers ) != MqttConnectionSuccess )
         {
-            outgoingPublishPackets[ index ].pubInfo.dup = true;
-
-            LogDebug( ( "Sending duplicate PUBLISH with packet id %u.",
-                        outgoingPublishPackets[ index ].packetId ) );
-            mqttStatus = MQTT_Publish( pMqttContext,
-                                       &outgoingPublishPackets[ index ].pubInfo,
-                                       outgoingPublishPackets[ index ].packetId );
-
-            if( mqttStatus != MQTTSuccess )
-            {
-                LogError( ( "Sending duplicate PUBLISH for packet id %u "
-                            " failed with status %s.",
-                            outgoingPublishPackets[ index ].packetId,
-                            MQTT_Status_strerror( mqttStatus ) ) );
-                break;
-            }
-            else
-            {
-                LogDebug( ( "Sent duplicate PUBLISH successfully for packet id %u.",
-                            outgoingPublishPackets[ index ].packetId ) );
-            }
+            LogError( ( "Failed to create the connection to the MQTT broker." ) );
+            returnStatus = false;
         }
     }
 
-    /* Were all the unacknowledged QoS1 publishes successfully re-sent? */
-    if( index == MAX_OUTGOING_PUBLISHES )
-    {
-        returnStatus = true;
-    }
-
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-bool EstablishMqttSession( MQTTPublishCallback_t publishCallback )
+bool InitOfflinePublishQueue( const PublishQueueRule_t * pRules,
+                              size_t ruleCount )
 {
-    bool returnStatus = false;
-    MQTTStatus_t mqttStatus;
-    MQTTConnectInfo_t connectInfo;
-    MQTTFixedBuffer_t networkBuffer;
-    TransportInterface_t transport;
-    bool createCleanSession = false;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    NetworkContext_t * pNetworkContext = &networkContext;
-    bool sessionPresent = false;
+    bool returnStatus = createConnection();
 
-    assert( pMqttContext != NULL );
-    assert( pNetworkContext != NULL );
+    if( returnStatus == true )
+    {
+        returnStatus = ( MqttConnection_SetQueueRules( pMqttConnection, pRules, ruleCount ) == MqttConnectionSuccess );
+    }
 
-    /* Initialize the mqtt context and network context. */
-    ( void ) memset( pMqttContext, 0U, sizeof( MQTTContext_t ) );
-    ( void ) memset( pNetworkContext, 0U, sizeof( NetworkContext_t ) );
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
 
-    returnStatus = connectToBrokerWithBackoffRetries( pNetworkContext );
+static bool sendSubscriptions( void * pSendContext,
+                               bool subscribe,
+                               const MQTTSubscribeInfo_t * pSubscriptions,
+                               size_t subscriptionCount )
+{
+    MqttConnection_t * pConnection = ( MqttConnection_t * ) pSendContext;
+    MqttConnectionStatus_t connectionStatus = MqttConnectionSuccess;
 
-    if( returnStatus != true )
+    /* The SUBACK or UNSUBACK is received by the connection before it
+     * returns. */
+    if( subscribe == true )
     {
-        /* Log an error to indicate connection failure after all
-         * reconnect attempts are over. */
-        LogError( ( "Failed to connect to MQTT broker %.*s.",
-                    AWS_IOT_ENDPOINT_LENGTH,
-                    AWS_IOT_ENDPOINT ) );
+        connectionStatus = MqttConnection_SubscribeList( pConnection, pSubscriptions, subscriptionCount );
     }
     else
     {
-        /* Fill in TransportInterface send and receive function pointers.
-         * For this demo, TCP sockets are used to send and receive data
-         * from the network. pNetworkContext is an SSL context for OpenSSL.*/
-        transport.pNetworkContext = pNetworkContext;
-        transport.send = Openssl_Send;
-        transport.recv = Openssl_Recv;
-
-        /* Fill the values for network buffer. */
-        networkBuffer.pBuffer = buffer;
-        networkBuffer.size = NETWORK_BUFFER_SIZE;
-
-        /* Remember the publish callback supplied. */
-        appPublishCallback = publishCallback;
-
-        /* Initialize the MQTT library. */
-        mqttStatus = MQTT_Init( pMqttContext,
-                                &transport,
-                                Clock_GetTimeMs,
-                                mqttCallback,
-                                &networkBuffer );
-
-        if( mqttStatus != MQTTSuccess )
-        {
-            returnStatus = false;
-            LogError( ( "MQTT init failed with status %s.",
-                        MQTT_Status_strerror( mqttStatus ) ) );
-        }
-        else
-        {
-            /* Establish an MQTT session by sending a CONNECT packet. */
-
-            /* If #createCleanSession is true, start with a clean session
-             * i.e. direct the MQTT broker to discard any previous session data.
-             * If #createCleanSession is false, direct the broker to attempt to
-             * reestablish a session which was already present. */
-            connectInfo.cleanSession = createCleanSession;
-
-            /* The client identifier is used to uniquely identify this MQTT client to
-             * the MQTT broker. In a production device the identifier can be something
-             * unique, such as a device serial number. */
-            connectInfo.pClientIdentifier = CLIENT_IDENTIFIER;
-            connectInfo.clientIdentifierLength = CLIENT_IDENTIFIER_LENGTH;
-
-            /* The maximum time interval in seconds which is allowed to elapse
-             * between two Control Packets.
-             * It is the responsibility of the client to ensure that the interval between
-             * control packets being sent does not exceed the this keep-alive value. In the
-             * absence of sending any other control packets, the client MUST send a
-             * PINGREQ packet. */
-            connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
-
-            /* Username and password for authentication. Not used in this demo. */
-            connectInfo.pUserName = METRICS_STRING;
-            connectInfo.userNameLength = METRICS_STRING_LENGTH;
-            connectInfo.pPassword = NULL;
-            connectInfo.passwordLength = 0U;
-
-            /* Send an MQTT CONNECT packet to the broker. */
-            mqttStatus = MQTT_Connect( pMqttContext,
-                                       &connectInfo,
-                                       NULL,
-                                       CONNACK_RECV_TIMEOUT_MS,
-                                       &sessionPresent );
-
-            if( mqttStatus != MQTTSuccess )
-            {
-                returnStatus = false;
-                LogError( ( "Connection with MQTT broker failed with status %s.",
-                            MQTT_Status_strerror( mqttStatus ) ) );
-            }
-            else
-            {
-                LogDebug( ( "MQTT connection successfully established with broker." ) );
-            }
-        }
-
-        if( returnStatus == true )
-        {
-            /* Keep a flag for indicating if MQTT session is established. This
-             * flag will mark that an MQTT DISCONNECT has to be sent at the end
-             * of the demo even if there are intermediate failures. */
-            mqttSessionEstablished = true;
-        }
-
-        if( returnStatus == true )
-        {
-            /* Check if a session is present and if there are any outgoing
-             * publishes that need to be resent. Resending unacknowledged
-             * publishes is needed only if the broker is re-establishing a
-             * session that was already present. */
-            if( sessionPresent == true )
-            {
-                LogDebug( ( "An MQTT session with broker is re-established. "
-                            "Resending unacked publishes." ) );
-
-                /* Handle all the resend of publish messages. */
-                returnStatus = handlePublishResend( &mqttContext );
-            }
-            else
-            {
-                LogDebug( ( "A clean MQTT connection is established."
-                            " Cleaning up all the stored outgoing publishes." ) );
-
-                /* Clean up the outgoing publishes waiting for ack as this new
-                 * connection doesn't re-establish an existing session. */
-                cleanupOutgoingPublishes();
-            }
-        }
+        connectionStatus = MqttConnection_UnsubscribeList( pConnection, pSubscriptions, subscriptionCount );
     }
 
-    return returnStatus;
+    return( connectionStatus == MqttConnectionSuccess );
 }
 /*-----------------------------------------------------------*/
 
-bool DisconnectMqttSession( void )
+bool EstablishMqttSession( MQTTPublishCallback_t publishCallback )
 {
-    MQTTStatus_t mqttStatus = MQTTSuccess;
-    bool returnStatus = false;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    NetworkContext_t * pNetworkContext = &networkContext;
+    bool returnStatus = createConnection();
+    MqttConnectionMetrics_t before;
+    MqttConnectionMetrics_t after;
 
-    assert( pMqttContext != NULL );
-    assert( pNetworkContext != NULL );
+    /* Remember the publish callback supplied. */
+    appPublishCallback = publishCallback;
 
-    if( mqttSessionEstablished == true )
+    if( returnStatus == true )
     {
-        /* Send DISCONNECT. */
-        mqttStatus = MQTT_Disconnect( pMqttContext );
+        ( void ) MqttConnection_GetMetrics( pMqttConnection, &before );
+        returnStatus = ( MqttConnection_Connect( pMqttConnection ) == MqttConnectionSuccess );
+    }
 
-        if( mqttStatus != MQTTSuccess )
-        {
-            LogError( ( "Sending MQTT DISCONNECT failed with status=%u.",
-                        mqttStatus ) );
-        }
-        else
+    if( returnStatus == true )
+    {
+        ( void ) MqttConnection_GetMetrics( pMqttConnection, &after );
+
+        /* A clean session has none of the topic filters still of interest,
+         * so they are subscribed to again. */
+        if( after.sessionsStarted != before.sessionsStarted )
         {
-            /* MQTT DISCONNECT sent successfully. */
-            returnStatus = true;
+            SubscriptionManager_ResetInterests();
+            returnStatus = SubscriptionManager_FlushInterests( sendSubscriptions, pMqttConnection );
         }
     }
 
-    /* End TLS session, then close TCP connection. */
-    ( void ) Openssl_Disconnect( pNetworkContext );
-
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
+bool DisconnectMqttSession( void )
+{
+    return( MqttConnection_Disconnect( pMqttConnection ) == MqttConnectionSuccess );
+}
+/*-----------------------------------------------------------*/
+
 bool SubscribeToTopic( const char * pTopicFilter,
                        uint16_t topicFilterLength )
 {
-    bool returnStatus = false;
-    MQTTStatus_t mqttStatus;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
-
-    assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
-    /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
+    return SubscribeToTopics( &pTopicFilter, &topicFilterLength, 1U );
+}
+/*-----------------------------------------------------------*/
+
+bool SubscribeToTopics( const char * const * ppTopicFilters,
+                        const uint16_t * pTopicFilterLengths,
+                        size_t topicFilterCount )
+{
+    bool returnStatus = true;
+    size_t added = 0U;
+    size_t index = 0U;
 
-    /* This example subscribes to only one topic and uses QOS1. */
-    pSubscriptionList[ 0 ].qos = MQTTQoS1;
-    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+    assert( ppTopicFilters != NULL );
+    assert( pTopicFilterLengths != NULL );
 
-    /* Generate packet identifier for the SUBSCRIBE packet. */
-    globalSubscribePacketIdentifier = MQTT_GetPacketId( pMqttContext );
+    while( ( added < topicFilterCount ) && ( returnStatus == true ) )
+    {
+        returnStatus = ( SubscriptionManager_AddInterest( ppTopicFilters[ added ],
+                                                          pTopicFilterLengths[ added ] ) == SUBSCRIPTION_MANAGER_SUCCESS );
 
-    /* Send SUBSCRIBE packet. */
-    mqttStatus = MQTT_Subscribe( pMqttContext,
-                                 pSubscriptionList,
-                                 sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                 globalSubscribePacketIdentifier );
+        if( returnStatus == true )
+        {
+            added++;
+        }
+    }
 
-    if( mqttStatus != MQTTSuccess )
+    /* The topic filters not subscribed to yet are sent in a single
+     * SUBSCRIBE, whose SUBACK is received by the connection before it
+     * returns. */
+    if( returnStatus == true )
     {
-        LogError( ( "Failed to send SUBSCRIBE packet to broker with error = %s.",
-                    MQTT_Status_strerror( mqttStatus ) ) );
+        returnStatus = SubscriptionManager_FlushInterests( sendSubscriptions, pMqttConnection );
     }
-    else
+
+    if( returnStatus == false )
     {
-        LogDebug( ( "SUBSCRIBE topic %.*s to broker.",
-                    topicFilterLength,
-                    pTopicFilter ) );
-
-        /* Process incoming packet from the broker. Acknowledgment for subscription
-         * ( SUBACK ) will be received here. However after sending the subscribe, the
-         * client may receive a publish before it receives a subscribe ack. Since this
-         * demo is subscribing to the topic to which no one is publishing, probability
-         * of receiving publish message before subscribe ack is zero; but application
-         * must be ready to receive any packet. This demo uses MQTT_ProcessLoop to
-         * receive packet from network. */
-        mqttStatus = MQTT_ProcessLoop( pMqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
-
-        if( mqttStatus != MQTTSuccess )
-        {
-            LogError( ( "MQTT_ProcessLoop returned with status = %s.",
-                        MQTT_Status_strerror( mqttStatus ) ) );
-        }
-        else
+        for( index = 0U; index < added; index++ )
         {
-            returnStatus = true;
+            SubscriptionManager_RemoveInterest( ppTopicFilters[ index ], pTopicFilterLengths[ index ] );
         }
     }
 
@@ -883,60 +540,30 @@ bool SubscribeToTopic( const char * pTopicFilter,
 bool UnsubscribeFromTopic( const char * pTopicFilter,
                            uint16_t topicFilterLength )
 {
-    bool returnStatus = false;
-    MQTTStatus_t mqttStatus;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
-
-    assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
-    /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
-
-    /* This example subscribes to only one topic and uses QOS1. */
-    pSubscriptionList[ 0 ].qos = MQTTQoS1;
-    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+    return UnsubscribeFromTopics( &pTopicFilter, &topicFilterLength, 1U );
+}
+/*-----------------------------------------------------------*/
 
-    /* Generate packet identifier for the UNSUBSCRIBE packet. */
-    globalUnsubscribePacketIdentifier = MQTT_GetPacketId( pMqttContext );
+bool UnsubscribeFromTopics( const char * const * ppTopicFilters,
+                            const uint16_t * pTopicFilterLengths,
+                            size_t topicFilterCount )
+{
+    size_t index = 0U;
 
-    /* Send UNSUBSCRIBE packet. */
-    mqttStatus = MQTT_Unsubscribe( pMqttContext,
-                                   pSubscriptionList,
-                                   sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                   globalUnsubscribePacketIdentifier );
+    assert( ppTopicFilters != NULL );
+    assert( pTopicFilterLengths != NULL );
 
-    if( mqttStatus != MQTTSuccess )
+    for( index = 0U; index < topicFilterCount; index++ )
     {
-        LogError( ( "Failed to send UNSUBSCRIBE packet to broker with error = %s.",
-                    MQTT_Status_strerror( mqttStatus ) ) );
+        SubscriptionManager_RemoveInterest( ppTopicFilters[ index ], pTopicFilterLengths[ index ] );
     }
-    else
-    {
-        LogDebug( ( "UNSUBSCRIBE sent topic %.*s to broker.",
-                    topicFilterLength,
-                    pTopicFilter ) );
 
-        /* Process incoming packet from the broker. Acknowledgment for unsubscribe
-         * operation ( UNSUBACK ) will be received here. This demo uses
-         * MQTT_ProcessLoop to receive packet from network. */
-        mqttStatus = MQTT_ProcessLoop( pMqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
-
-        if( mqttStatus != MQTTSuccess )
-        {
-            LogError( ( "MQTT_ProcessLoop returned with status = %s.",
-                        MQTT_Status_strerror( mqttStatus ) ) );
-        }
-        else
-        {
-            returnStatus = true;
-        }
-    }
-
-    return returnStatus;
+    /* The topic filters without interests left are sent in a single
+     * UNSUBSCRIBE. */
+    return SubscriptionManager_FlushInterests( sendSubscriptions, pMqttConnection );
 }
 /*-----------------------------------------------------------*/
 
@@ -945,79 +572,53 @@ bool PublishToTopic( const char * pTopicFilter,
                      const char * pPayload,
                      size_t payloadLength )
 {
-    bool returnStatus = false;
-    MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t publishIndex = MAX_OUTGOING_PUBLISHES;
-    MQTTContext_t * pMqttContext = &mqttContext;
+    MQTTPublishInfo_t publishInfo = { 0 };
 
-    assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
-    /* Get the next free index for the outgoing publish. All QoS1 outgoing
-     * publishes are stored until a PUBACK is received. These messages are
-     * stored for supporting a resend if a network connection is broken before
-     * receiving a PUBACK. */
-    returnStatus = getNextFreeIndexForOutgoingPublishes( &publishIndex );
+    /* This example publishes to only one topic and uses QOS1. */
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = pTopicFilter;
+    publishInfo.topicNameLength = topicFilterLength;
+    publishInfo.pPayload = pPayload;
+    publishInfo.payloadLength = payloadLength;
 
-    if( returnStatus == false )
-    {
-        LogError( ( "Unable to find a free spot for outgoing PUBLISH message." ) );
-    }
-    else
-    {
-        LogDebug( ( "Published payload: %.*s",
-                    ( int ) payloadLength,
-                    ( const char * ) pPayload ) );
-
-        /* This example publishes to only one topic and uses QOS1. */
-        outgoingPublishPackets[ publishIndex ].pubInfo.qos = MQTTQoS1;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pTopicName = pTopicFilter;
-        outgoingPublishPackets[ publishIndex ].pubInfo.topicNameLength = topicFilterLength;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pPayload = pPayload;
-        outgoingPublishPackets[ publishIndex ].pubInfo.payloadLength = payloadLength;
-
-        /* Get a new packet id. */
-        outgoingPublishPackets[ publishIndex ].packetId = MQTT_GetPacketId( pMqttContext );
-
-        /* Send PUBLISH packet. */
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &outgoingPublishPackets[ publishIndex ].pubInfo,
-                                   outgoingPublishPackets[ publishIndex ].packetId );
-
-        if( mqttStatus != MQTTSuccess )
-        {
-            LogError( ( "Failed to send PUBLISH packet to broker with error = %s.",
-                        MQTT_Status_strerror( mqttStatus ) ) );
-            cleanupOutgoingPublishAt( publishIndex );
-            returnStatus = false;
-        }
-        else
-        {
-            LogDebug( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.",
-                        topicFilterLength,
-                        pTopicFilter,
-                        outgoingPublishPackets[ publishIndex ].packetId ) );
-        }
-    }
+    LogDebug( ( "Published payload: %.*s",
+                ( int ) payloadLength,
+                ( const char * ) pPayload ) );
 
-    return returnStatus;
+    /* While the connection to the broker is down, the publish is queued. */
+    return( MqttConnection_Publish( pMqttConnection, &publishInfo ) == MqttConnectionSuccess );
+}
+/*-----------------------------------------------------------*/
+
+bool PublishToTopicInPlace( const char * pTopic,
+                            uint16_t topicLength,
+                            uint8_t * pPacketBuffer,
+                            size_t messageLength )
+{
+    MQTTPublishInfo_t publishInfo = { 0 };
+
+    assert( pTopic != NULL );
+    assert( topicLength > 0 );
+    assert( PUBLISH_PAYLOAD_OFFSET( topicLength ) == MQTT_CONNECTION_PUBLISH_HEADROOM( topicLength ) );
+
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = pTopic;
+    publishInfo.topicNameLength = topicLength;
+    publishInfo.pPayload = &( pPacketBuffer[ PUBLISH_PAYLOAD_OFFSET( topicLength ) ] );
+    publishInfo.payloadLength = messageLength;
+
+    return( MqttConnection_PublishInPlace( pMqttConnection, &publishInfo, pPacketBuffer ) == MqttConnectionSuccess );
 }
 /*-----------------------------------------------------------*/
 
 bool ProcessLoop( uint32_t timeoutMs )
 {
     bool returnStatus = false;
-    MQTTStatus_t mqttStatus = MQTTSuccess;
-
-    mqttStatus = MQTT_ProcessLoop( &mqttContext, timeoutMs );
 
-    if( mqttStatus != MQTTSuccess )
-    {
-        LogError( ( "MQTT_ProcessLoop returned with status = %s.",
-                    MQTT_Status_strerror( mqttStatus ) ) );
-    }
-    else
+    if( MqttConnection_ProcessLoop( pMqttConnection, timeoutMs ) == MqttConnectionSuccess )
     {
         LogDebug( ( "MQTT_ProcessLoop successful." ) );
         returnStatus = true;
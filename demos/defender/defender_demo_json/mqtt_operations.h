@@ -26,6 +26,16 @@
 /* MQTT API header. */
 #include "core_mqtt.h"
 
+/* Queue of the publishes issued while the connection is down. */
+#include "publish_queue.h"
+
+/**
+ * @brief Offset of the payload of a publish sent with
+ * #PublishToTopicInPlace, in its packet buffer, for a topic of
+ * @p topicLength bytes. The bytes before it are for the header.
+ */
+#define PUBLISH_PAYLOAD_OFFSET( topicLength )    ( 5U + 2U + ( size_t ) ( topicLength ) + 2U )
+
 /**
  * @brief Application callback type to handle the incoming publishes.
  *
@@ -35,6 +45,22 @@
 typedef void (* MQTTPublishCallback_t )( MQTTPublishInfo_t * pPublishInfo,
                                          uint16_t packetIdentifier );
 
+/**
+ * @brief Set the rules of the queue of the publishes issued while the
+ * connection to the broker is down, emptying it.
+ *
+ * Without a call to this function, the queue has no rules, so all the
+ * publishes have the lowest priority and drop the oldest when it is full.
+ *
+ * @param[in] pRules The rules, which must remain valid while the demo runs;
+ * NULL for none.
+ * @param[in] ruleCount Number of rules of @p pRules.
+ *
+ * @return true if the rules are valid; false otherwise.
+ */
+bool InitOfflinePublishQueue( const PublishQueueRule_t * pRules,
+                              size_t ruleCount );
+
 /**
  * @brief Establish a MQTT connection.
  *
@@ -66,6 +92,23 @@ bool DisconnectMqttSession( void );
 bool SubscribeToTopic( const char * pTopicFilter,
                        uint16_t topicFilterLength );
 
+/**
+ * @brief Subscribe to several MQTT topic filters with a single SUBSCRIBE.
+ *
+ * The interests in the topic filters are counted, so a topic filter already
+ * subscribed to is not sent again.
+ *
+ * @param[in] ppTopicFilters The topic filters to subscribe to.
+ * @param[in] pTopicFilterLengths Lengths of the topic filters.
+ * @param[in] topicFilterCount Number of topic filters.
+ *
+ * @return true if subscribe operation was successful;
+ * false otherwise.
+ */
+bool SubscribeToTopics( const char * const * ppTopicFilters,
+                        const uint16_t * pTopicFilterLengths,
+                        size_t topicFilterCount );
+
 /**
  * @brief Unsubscribe from a MQTT topic filter.
  *
@@ -78,6 +121,23 @@ bool SubscribeToTopic( const char * pTopicFilter,
 bool UnsubscribeFromTopic( const char * pTopicFilter,
                            uint16_t topicFilterLength );
 
+/**
+ * @brief Unsubscribe from several MQTT topic filters with a single
+ * UNSUBSCRIBE.
+ *
+ * Only the topic filters without interests left are unsubscribed from.
+ *
+ * @param[in] ppTopicFilters The topic filters to unsubscribe from.
+ * @param[in] pTopicFilterLengths Lengths of the topic filters.
+ * @param[in] topicFilterCount Number of topic filters.
+ *
+ * @return true if unsubscribe operation was successful;
+ * false otherwise.
+ */
+bool UnsubscribeFromTopics( const char * const * ppTopicFilters,
+                            const uint16_t * pTopicFilterLengths,
+                            size_t topicFilterCount );
+
 /**
  * @brief Publish a message to a MQTT topic.
  *
@@ -86,7 +146,10 @@ bool UnsubscribeFromTopic( const char * pTopicFilter,
  * @param[in] pMessage The message to publish.
  * @param[in] messageLength Length of the message.
  *
- * @return true if PUBLISH was successfully sent;
+ * While the connection to the broker is down, the message is queued instead,
+ * to be sent once #EstablishMqttSession reconnects.
+ *
+ * @return true if PUBLISH was successfully sent or queued;
  * false otherwise.
  */
 bool PublishToTopic( const char * pTopic,
@@ -94,6 +157,30 @@ bool PublishToTopic( const char * pTopic,
                      const char * pMessage,
                      size_t messageLength );
 
+/**
+ * @brief Publish a message written in place in a packet buffer, after
+ * #PUBLISH_PAYLOAD_OFFSET bytes.
+ *
+ * The header of the PUBLISH packet is written before the message once its
+ * length is known, so the packet is sent as is, without copying the message.
+ * As with #PublishToTopic, the message is queued while the connection to the
+ * broker is down.
+ *
+ * @param[in] pTopic The topic to publish the message on.
+ * @param[in] topicLength Length of the topic.
+ * @param[in] pPacketBuffer The packet buffer, holding the message at
+ * #PUBLISH_PAYLOAD_OFFSET of @p topicLength. It must remain valid until the
+ * publish is acknowledged.
+ * @param[in] messageLength Length of the message.
+ *
+ * @return true if PUBLISH was successfully sent or queued;
+ * false otherwise.
+ */
+bool PublishToTopicInPlace( const char * pTopic,
+                            uint16_t topicLength,
+                            uint8_t * pPacketBuffer,
+                            size_t messageLength );
+
 /**
  * @brief Invoke the core MQTT library's process loop function.
  *
@@ -21,7 +21,6 @@
  */
 
 /* Standard includes. */
-#include <stdio.h>
 #include <string.h>
 
 /* Demo config. */
@@ -30,94 +29,368 @@
 /* Interface include. */
 #include "report_builder.h"
 
+/* Trace probes of the report generation. */
+#include "trace_probes.h"
+
 /* Various JSON characters. */
 #define JSON_ARRAY_OPEN_MARKER         '['
 #define JSON_ARRAY_CLOSE_MARKER        ']'
 #define JSON_ARRAY_OBJECT_SEPARATOR    ','
 
-/* Helper macro to check if snprintf was successful. */
-#define SNPRINTF_SUCCESS( retVal, bufLen )    ( ( retVal > 0 ) && ( ( uint32_t ) retVal < bufLen ) )
-
-/* Formats used to generate the JSON report. */
-#define JSON_PORT_OBJECT_FORMAT \
+/* Fragments of the JSON report, written between the numbers. */
+#define JSON_PORT_OBJECT_PREFIX \
     "{"                         \
-    "\"port\": %u"              \
+    "\"port\": "
+
+#define JSON_PORT_OBJECT_SUFFIX \
     "},"
 
-#define JSON_CONNECTION_OBJECT_FORMAT     \
-    "{"                                   \
-    "\"local_port\": %u,"                 \
-    "\"remote_addr\": \"%u.%u.%u.%u:%u\"" \
+#define JSON_CONNECTION_OBJECT_PREFIX \
+    "{"                               \
+    "\"local_port\": "
+
+#define JSON_CONNECTION_OBJECT_REMOTE_ADDR \
+    ","                                    \
+    "\"remote_addr\": \""
+
+#define JSON_CONNECTION_OBJECT_SUFFIX \
+    "\""                              \
     "},"
 
-#define JSON_REPORT_FORMAT_PART1 \
-    "{"                          \
-    "\"header\": {"              \
-    "\"report_id\": %u,"         \
-    "\"version\": \"%u.%u\""     \
-    "},"                         \
-    "\"metrics\": {"             \
-    "\"listening_tcp_ports\": {" \
+#define JSON_REPORT_HEADER_PREFIX \
+    "{"                           \
+    "\"header\": {"               \
+    "\"report_id\": "
+
+#define JSON_REPORT_VERSION_PREFIX \
+    ","                            \
+    "\"version\": \""
+
+#define JSON_REPORT_METRICS_PREFIX \
+    "\""                           \
+    "},"                           \
+    "\"metrics\": {"
+
+#define JSON_REPORT_TCP_PORTS_PREFIX \
+    "\"listening_tcp_ports\": {"     \
     "\"ports\": "
 
-#define JSON_REPORT_FORMAT_PART2 \
+#define JSON_REPORT_TOTAL_PREFIX \
     ","                          \
-    "\"total\": %u"              \
-    "},"                         \
-    "\"listening_udp_ports\": {" \
+    "\"total\": "
+
+#define JSON_REPORT_UDP_PORTS_PREFIX \
+    "\"listening_udp_ports\": {"     \
     "\"ports\": "
 
-#define JSON_REPORT_FORMAT_PART3     \
+#define JSON_REPORT_BYTES_IN_PREFIX \
+    "\"network_stats\": {"          \
+    "\"bytes_in\": "
+
+#define JSON_REPORT_BYTES_OUT_PREFIX \
     ","                              \
-    "\"total\": %u"                  \
-    "},"                             \
-    "\"network_stats\": {"           \
-    "\"bytes_in\": %u,"              \
-    "\"bytes_out\": %u,"             \
-    "\"packets_in\": %u,"            \
-    "\"packets_out\": %u"            \
-    "},"                             \
-    "\"tcp_connections\": {"         \
-    "\"established_connections\": {" \
+    "\"bytes_out\": "
+
+#define JSON_REPORT_PACKETS_IN_PREFIX \
+    ","                               \
+    "\"packets_in\": "
+
+#define JSON_REPORT_PACKETS_OUT_PREFIX \
+    ","                                \
+    "\"packets_out\": "
+
+#define JSON_REPORT_CONNECTIONS_PREFIX \
+    "\"tcp_connections\": {"           \
+    "\"established_connections\": {"   \
     "\"connections\": "
 
-#define JSON_REPORT_FORMAT_PART4 \
-    ","                          \
-    "\"total\": %u"              \
-    "}"                          \
-    "}"                          \
-    "}"                          \
+/* Each section ends with a comma, and the last one is discarded. */
+#define JSON_REPORT_SECTION_SUFFIX \
+    "},"
+
+#define JSON_REPORT_CONNECTIONS_SUFFIX \
+    "}"                                \
+    "},"
+
+#define JSON_REPORT_METRICS_SUFFIX \
+    "}"
+
+#define JSON_REPORT_CUSTOM_METRICS_PREFIX \
+    ","                                   \
+    "\"custom_metrics\": {"
+
+#define JSON_REPORT_CUSTOM_METRICS_SUFFIX \
+    "}"
+
+#define JSON_REPORT_SUFFIX \
     "}"
+
+/* A custom metric is named "<name><statistic suffix>", and its value is
+ * written between the number prefix and the suffix. */
+#define JSON_CUSTOM_METRIC_PREFIX \
+    "\""
+
+#define JSON_CUSTOM_METRIC_NUMBER_PREFIX \
+    "\": [{"                             \
+    "\"number\": "
+
+#define JSON_CUSTOM_METRIC_SUFFIX \
+    "}],"
+
+/* Length of a fragment, without the terminating NULL. */
+#define FRAGMENT_LENGTH( fragment )    ( sizeof( fragment ) - 1U )
+
+/* Write a fragment and move past it. */
+#define WRITE_FRAGMENT( pCursor, fragment )                                               \
+    do {                                                                                  \
+        ( void ) memcpy( ( pCursor ), ( fragment ), FRAGMENT_LENGTH( fragment ) );        \
+        ( pCursor ) += FRAGMENT_LENGTH( fragment );                                       \
+    } while( 0 )
+
+/* Length of a port object without its number. */
+#define PORT_OBJECT_FIXED_LENGTH                  \
+    ( FRAGMENT_LENGTH( JSON_PORT_OBJECT_PREFIX ) + \
+      FRAGMENT_LENGTH( JSON_PORT_OBJECT_SUFFIX ) )
+
+/* Length of a connection object without its numbers: 3 dots and a colon in
+ * the remote address. */
+#define CONNECTION_OBJECT_FIXED_LENGTH                       \
+    ( FRAGMENT_LENGTH( JSON_CONNECTION_OBJECT_PREFIX ) +      \
+      FRAGMENT_LENGTH( JSON_CONNECTION_OBJECT_REMOTE_ADDR ) + \
+      4U +                                                    \
+      FRAGMENT_LENGTH( JSON_CONNECTION_OBJECT_SUFFIX ) )
+
+/* Length of the report without its sections and numbers: a dot in the
+ * version. */
+#define REPORT_FIXED_LENGTH                          \
+    ( FRAGMENT_LENGTH( JSON_REPORT_HEADER_PREFIX ) +  \
+      FRAGMENT_LENGTH( JSON_REPORT_VERSION_PREFIX ) + \
+      1U +                                            \
+      FRAGMENT_LENGTH( JSON_REPORT_METRICS_PREFIX ) + \
+      FRAGMENT_LENGTH( JSON_REPORT_METRICS_SUFFIX ) + \
+      FRAGMENT_LENGTH( JSON_REPORT_SUFFIX ) )
+
+/* Length of a ports section without its array and numbers, the same for TCP
+ * and UDP. */
+#define PORTS_SECTION_FIXED_LENGTH                     \
+    ( FRAGMENT_LENGTH( JSON_REPORT_TCP_PORTS_PREFIX ) + \
+      FRAGMENT_LENGTH( JSON_REPORT_TOTAL_PREFIX ) +     \
+      FRAGMENT_LENGTH( JSON_REPORT_SECTION_SUFFIX ) )
+
+/* Length of the network stats section without its numbers. */
+#define NETWORK_STATS_SECTION_FIXED_LENGTH                \
+    ( FRAGMENT_LENGTH( JSON_REPORT_BYTES_IN_PREFIX ) +     \
+      FRAGMENT_LENGTH( JSON_REPORT_BYTES_OUT_PREFIX ) +    \
+      FRAGMENT_LENGTH( JSON_REPORT_PACKETS_IN_PREFIX ) +   \
+      FRAGMENT_LENGTH( JSON_REPORT_PACKETS_OUT_PREFIX ) +  \
+      FRAGMENT_LENGTH( JSON_REPORT_SECTION_SUFFIX ) )
+
+/* Length of the connections section without its array and numbers. */
+#define CONNECTIONS_SECTION_FIXED_LENGTH                 \
+    ( FRAGMENT_LENGTH( JSON_REPORT_CONNECTIONS_PREFIX ) + \
+      FRAGMENT_LENGTH( JSON_REPORT_TOTAL_PREFIX ) +       \
+      FRAGMENT_LENGTH( JSON_REPORT_CONNECTIONS_SUFFIX ) )
+
+/* Length of the custom metrics section without its entries, the comma of
+ * the last one being discarded. */
+#define CUSTOM_METRICS_SECTION_FIXED_LENGTH                  \
+    ( FRAGMENT_LENGTH( JSON_REPORT_CUSTOM_METRICS_PREFIX ) +  \
+      FRAGMENT_LENGTH( JSON_REPORT_CUSTOM_METRICS_SUFFIX ) - \
+      1U )
+
+/* Length of a custom metric entry without its name and value. */
+#define CUSTOM_METRIC_ENTRY_FIXED_LENGTH                      \
+    ( FRAGMENT_LENGTH( JSON_CUSTOM_METRIC_PREFIX ) +          \
+      FRAGMENT_LENGTH( JSON_CUSTOM_METRIC_NUMBER_PREFIX ) +   \
+      FRAGMENT_LENGTH( JSON_CUSTOM_METRIC_SUFFIX ) )
+
+/* Whether a section is written in the report. */
+#define HAS_SECTION( pMetrics, section )    ( ( ( pMetrics )->omittedSections & ( section ) ) == 0U )
+
+/* CBOR major types. */
+#define CBOR_MAJOR_TYPE_UNSIGNED    ( 0U )
+#define CBOR_MAJOR_TYPE_TEXT        ( 3U )
+#define CBOR_MAJOR_TYPE_ARRAY       ( 4U )
+#define CBOR_MAJOR_TYPE_MAP         ( 5U )
+
+/* Short names of the fields of the CBOR report. */
+#define CBOR_KEY_HEADER                     "hed"
+#define CBOR_KEY_REPORT_ID                  "rid"
+#define CBOR_KEY_VERSION                    "v"
+#define CBOR_KEY_METRICS                    "met"
+#define CBOR_KEY_LISTENING_TCP_PORTS        "tp"
+#define CBOR_KEY_LISTENING_UDP_PORTS        "up"
+#define CBOR_KEY_PORTS                      "pts"
+#define CBOR_KEY_PORT                       "pt"
+#define CBOR_KEY_TOTAL                      "t"
+#define CBOR_KEY_NETWORK_STATS              "ns"
+#define CBOR_KEY_BYTES_IN                   "bi"
+#define CBOR_KEY_BYTES_OUT                  "bo"
+#define CBOR_KEY_PACKETS_IN                 "pi"
+#define CBOR_KEY_PACKETS_OUT                "po"
+#define CBOR_KEY_TCP_CONNECTIONS            "tc"
+#define CBOR_KEY_ESTABLISHED_CONNECTIONS    "ec"
+#define CBOR_KEY_CONNECTIONS                "cs"
+#define CBOR_KEY_LOCAL_PORT                 "lp"
+#define CBOR_KEY_REMOTE_ADDR                "rad"
+#define CBOR_KEY_CUSTOM_METRICS             "cmet"
+#define CBOR_KEY_NUMBER                     "number"
+
+/* Write a CBOR text string of a string literal. */
+#define CBOR_WRITE_KEY( pWriter, key )    cborWriteText( ( pWriter ), ( key ), FRAGMENT_LENGTH( key ) )
+
+/* Longest text of a remote address: "255.255.255.255:65535". */
+#define REMOTE_ADDR_MAX_LENGTH    ( 21U )
+
+/* Longest text of a version: two 32-bit numbers and a dot. */
+#define VERSION_MAX_LENGTH        ( 21U )
+
+/**
+ * @brief A streaming CBOR writer.
+ *
+ * The bytes past the end of the buffer are counted but not written, so a
+ * writer with no buffer measures the encoding.
+ */
+typedef struct CborWriter
+{
+    uint8_t * pBuffer;   /**< Buffer to write into; NULL to only measure. */
+    size_t bufferLength; /**< Length of pBuffer. */
+    size_t length;       /**< Number of bytes of the encoding so far. */
+} CborWriter_t;
+
+/**
+ * @brief Suffix added to the name of a custom metric for a statistic.
+ */
+typedef struct StatSuffix
+{
+    const char * pSuffix; /**< The suffix. */
+    size_t length;        /**< Length of pSuffix. */
+} StatSuffix_t;
+
+#define STAT_SUFFIX( suffix )    { ( suffix ), FRAGMENT_LENGTH( suffix ) }
+
+/* The suffixes of the statistics, by bit position. */
+static const StatSuffix_t statSuffixes[ CUSTOM_METRIC_STATISTICS ] =
+{
+    STAT_SUFFIX( "_min" ),
+    STAT_SUFFIX( "_max" ),
+    STAT_SUFFIX( "_avg" ),
+    STAT_SUFFIX( "_p50" ),
+    STAT_SUFFIX( "_p90" ),
+    STAT_SUFFIX( "_p99" ),
+    STAT_SUFFIX( "_samples" )
+};
+
+/* The decimal digits of 0 to 99, two by two. */
+static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Get the number of decimal digits of a number.
+ *
+ * @param[in] value The number.
+ *
+ * @return The number of digits, from 1 to 20.
+ */
+static size_t getDecimalLength( uint64_t value );
+
+/**
+ * @brief Write the decimal digits of a number.
+ *
+ * The buffer must have room for #getDecimalLength digits.
+ *
+ * @param[in] pBuffer The buffer to write the number into.
+ * @param[in] value The number.
+ *
+ * @return The position after the number.
+ */
+static char * writeDecimal( char * pBuffer,
+                            uint64_t value );
+
+/**
+ * @brief Get the length of a ports array in the report.
+ *
+ * @param[in] pOpenPortsArray The array containing the open ports.
+ * @param[in] openPortsArrayLength Length of the pOpenPortsArray array.
+ *
+ * @return The number of characters #writePortsArray writes.
+ */
+static size_t getPortsArrayLength( const uint16_t * pOpenPortsArray,
+                                   uint32_t openPortsArrayLength );
+
+/**
+ * @brief Get the length of an established connections array in the report.
+ *
+ * @param[in] pConnectionsArray The array containing the established connections.
+ * @param[in] connectionsArrayLength Length of the pConnectionsArray array.
+ *
+ * @return The number of characters #writeConnectionsArray writes.
+ */
+static size_t getConnectionsArrayLength( const Connection_t * pConnectionsArray,
+                                         uint32_t connectionsArrayLength );
+
+/**
+ * @brief Get the length of the custom metrics entries in the report.
+ *
+ * @param[in] pCustomMetricsArray The statistics of the custom metrics.
+ * @param[in] customMetricsArrayLength Length of @p pCustomMetricsArray.
+ *
+ * @return The number of characters #writeCustomMetrics writes; 0 if there is
+ * no statistic to report.
+ */
+static size_t getCustomMetricsLength( const CustomMetricStats_t * pCustomMetricsArray,
+                                      uint32_t customMetricsArrayLength );
+
+/**
+ * @brief Get the length of a report.
+ *
+ * @param[in] pMetrics Metrics to write in the report.
+ * @param[in] majorReportVersion Major version of the report.
+ * @param[in] minorReportVersion Minor version of the report.
+ * @param[in] reportId Value to be used as the reportId in the report.
+ *
+ * @return The number of characters of the report.
+ */
+static size_t getReportLength( const ReportMetrics_t * pMetrics,
+                               uint32_t majorReportVersion,
+                               uint32_t minorReportVersion,
+                               uint32_t reportId );
+
 /**
  * @brief Write ports array to the given buffer in the format expected by the
  * AWS IoT Device Defender Service.
  *
- * This function writes an array of the following format:
+ * This function write array of the following format:
  * [
- *    {
- *        "port":44207
- *    },
- *    {
- *        "port":53
- *    }
+ *     {
+ *         "port":44207
+ *     },
+ *     {
+ *         "port":53
+ *     }
  * ]
  *
+ * The buffer must have room for #getPortsArrayLength characters.
+ *
  * @param[in] pBuffer The buffer to write the ports array.
- * @param[in] bufferLength The length of the buffer.
  * @param[in] pOpenPortsArray The array containing the open ports.
  * @param[in] openPortsArrayLength Length of the pOpenPortsArray array.
- * @param[out] pOutCharsWritten Number of characters written to the buffer.
  *
- * @return #ReportBuilderSuccess if the array is successfully written;
- * #ReportBuilderBufferTooSmall if the buffer cannot hold the full array.
+ * @return The position after the array.
  */
-static ReportBuilderStatus_t writePortsArray( char * pBuffer,
-                                              uint32_t bufferLength,
-                                              const uint16_t * pOpenPortsArray,
-                                              uint32_t openPortsArrayLength,
-                                              uint32_t * pOutCharsWritten );
+static char * writePortsArray( char * pBuffer,
+                               const uint16_t * pOpenPortsArray,
+                               uint32_t openPortsArrayLength );
 
 /**
  * @brief Write established connections array to the given buffer in the format
@@ -135,171 +408,731 @@ static ReportBuilderStatus_t writePortsArray( char * pBuffer,
  *     }
  * ]
  *
+ * The buffer must have room for #getConnectionsArrayLength characters.
+ *
  * @param[in] pBuffer The buffer to write the connections array.
- * @param[in] bufferLength The length of the buffer.
  * @param[in] pConnectionsArray The array containing the established connections.
  * @param[in] connectionsArrayLength Length of the pConnectionsArray array.
- * @param[out] pOutCharsWritten Number of characters written to the buffer.
  *
- * @return #ReportBuilderSuccess if the array is successfully written;
- * #ReportBuilderBufferTooSmall if the buffer cannot hold the full array.
+ * @return The position after the array.
+ */
+static char * writeConnectionsArray( char * pBuffer,
+                                     const Connection_t * pConnectionsArray,
+                                     uint32_t connectionsArrayLength );
+
+/**
+ * @brief Write the custom metrics entries to the given buffer, each followed by
+ * a comma:
+ *
+ * "cpu_usage_max": [ { "number": 87 } ],
+ *
+ * The buffer must have room for #getCustomMetricsLength characters.
+ *
+ * @param[in] pBuffer The buffer to write the entries.
+ * @param[in] pCustomMetricsArray The statistics of the custom metrics.
+ * @param[in] customMetricsArrayLength Length of @p pCustomMetricsArray.
+ *
+ * @return The position after the entries.
+ */
+static char * writeCustomMetrics( char * pBuffer,
+                                  const CustomMetricStats_t * pCustomMetricsArray,
+                                  uint32_t customMetricsArrayLength );
+
+/**
+ * @brief Append bytes to a CBOR encoding.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pBytes The bytes.
+ * @param[in] length Number of bytes.
  */
-static ReportBuilderStatus_t writeConnectionsArray( char * pBuffer,
-                                                    uint32_t bufferLength,
-                                                    const Connection_t * pConnectionsArray,
-                                                    uint32_t connectionsArrayLength,
-                                                    uint32_t * pOutCharsWritten );
+static void cborWriteBytes( CborWriter_t * pWriter,
+                            const void * pBytes,
+                            size_t length );
+
+/**
+ * @brief Write the head of a CBOR data item, in its shortest form.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] majorType The major type of the item.
+ * @param[in] value The value, length or number of entries of the item.
+ */
+static void cborWriteHead( CborWriter_t * pWriter,
+                           uint8_t majorType,
+                           uint64_t value );
+
+/**
+ * @brief Write a CBOR text string.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pText The text.
+ * @param[in] length Length of the text.
+ */
+static void cborWriteText( CborWriter_t * pWriter,
+                           const char * pText,
+                           size_t length );
+
+/**
+ * @brief Write the CBOR map of a ports array, with its total.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pOpenPortsArray The array containing the open ports.
+ * @param[in] openPortsArrayLength Length of the pOpenPortsArray array.
+ */
+static void cborWritePorts( CborWriter_t * pWriter,
+                            const uint16_t * pOpenPortsArray,
+                            uint32_t openPortsArrayLength );
+
+/**
+ * @brief Write the CBOR map of an established connections array, with its
+ * total.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pConnectionsArray The array containing the established connections.
+ * @param[in] connectionsArrayLength Length of the pConnectionsArray array.
+ */
+static void cborWriteConnections( CborWriter_t * pWriter,
+                                  const Connection_t * pConnectionsArray,
+                                  uint32_t connectionsArrayLength );
+
+/**
+ * @brief Write the CBOR map of the custom metrics.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pCustomMetricsArray The statistics of the custom metrics.
+ * @param[in] customMetricsArrayLength Length of @p pCustomMetricsArray.
+ * @param[in] entryCount Number of statistics to report, at least 1.
+ */
+static void cborWriteCustomMetrics( CborWriter_t * pWriter,
+                                    const CustomMetricStats_t * pCustomMetricsArray,
+                                    uint32_t customMetricsArrayLength,
+                                    uint32_t entryCount );
+
+/**
+ * @brief Get the number of statistics to report for the custom metrics.
+ *
+ * @param[in] pCustomMetricsArray The statistics of the custom metrics.
+ * @param[in] customMetricsArrayLength Length of @p pCustomMetricsArray.
+ *
+ * @return The number of entries of the custom metrics map.
+ */
+static uint32_t getCustomMetricsEntryCount( const CustomMetricStats_t * pCustomMetricsArray,
+                                            uint32_t customMetricsArrayLength );
+
+/**
+ * @brief Write a CBOR report.
+ *
+ * @param[in] pWriter The writer.
+ * @param[in] pMetrics Metrics to write in the report.
+ * @param[in] majorReportVersion Major version of the report.
+ * @param[in] minorReportVersion Minor version of the report.
+ * @param[in] reportId Value to be used as the reportId in the report.
+ */
+static void cborWriteReport( CborWriter_t * pWriter,
+                             const ReportMetrics_t * pMetrics,
+                             uint32_t majorReportVersion,
+                             uint32_t minorReportVersion,
+                             uint32_t reportId );
+/*-----------------------------------------------------------*/
+
+static size_t getDecimalLength( uint64_t value )
+{
+    size_t length = 1U;
+    uint64_t limit = 10U;
+
+    /* 10^19 is the largest power of 10 in 64 bits, so the limit is not
+     * multiplied past it. */
+    while( ( length < 20U ) && ( value >= limit ) )
+    {
+        length++;
+        limit *= 10U;
+    }
+
+    return length;
+}
+/*-----------------------------------------------------------*/
+
+static char * writeDecimal( char * pBuffer,
+                            uint64_t value )
+{
+    char * pEnd = pBuffer + getDecimalLength( value );
+    char * pCursor = pEnd;
+    uint64_t remaining = value;
+    size_t pairIndex = 0U;
+
+    /* Write from the last digit, two digits at a time. */
+    while( remaining >= 100U )
+    {
+        pairIndex = ( size_t ) ( remaining % 100U ) * 2U;
+        remaining /= 100U;
+        pCursor -= 2;
+        pCursor[ 0 ] = digitPairs[ pairIndex ];
+        pCursor[ 1 ] = digitPairs[ pairIndex + 1U ];
+    }
+
+    if( remaining >= 10U )
+    {
+        pairIndex = ( size_t ) remaining * 2U;
+        pCursor -= 2;
+        pCursor[ 0 ] = digitPairs[ pairIndex ];
+        pCursor[ 1 ] = digitPairs[ pairIndex + 1U ];
+    }
+    else
+    {
+        pCursor -= 1;
+        pCursor[ 0 ] = ( char ) ( '0' + ( char ) remaining );
+    }
+
+    return pEnd;
+}
+/*-----------------------------------------------------------*/
+
+static size_t getPortsArrayLength( const uint16_t * pOpenPortsArray,
+                                   uint32_t openPortsArrayLength )
+{
+    size_t length = 2U;
+    uint32_t i;
+
+    for( i = 0; i < openPortsArrayLength; i++ )
+    {
+        length += PORT_OBJECT_FIXED_LENGTH + getDecimalLength( pOpenPortsArray[ i ] );
+    }
+
+    /* The last comma is discarded. */
+    if( openPortsArrayLength > 0 )
+    {
+        length -= 1U;
+    }
+
+    return length;
+}
+/*-----------------------------------------------------------*/
+
+static size_t getConnectionsArrayLength( const Connection_t * pConnectionsArray,
+                                         uint32_t connectionsArrayLength )
+{
+    size_t length = 2U;
+    uint32_t i;
+    const Connection_t * pConn;
+
+    for( i = 0; i < connectionsArrayLength; i++ )
+    {
+        pConn = &( pConnectionsArray[ i ] );
+        length += CONNECTION_OBJECT_FIXED_LENGTH +
+                  getDecimalLength( pConn->localPort ) +
+                  getDecimalLength( ( pConn->remoteIp >> 24 ) & 0xFF ) +
+                  getDecimalLength( ( pConn->remoteIp >> 16 ) & 0xFF ) +
+                  getDecimalLength( ( pConn->remoteIp >> 8 ) & 0xFF ) +
+                  getDecimalLength( ( pConn->remoteIp ) & 0xFF ) +
+                  getDecimalLength( pConn->remotePort );
+    }
+
+    /* The last comma is discarded. */
+    if( connectionsArrayLength > 0 )
+    {
+        length -= 1U;
+    }
+
+    return length;
+}
+/*-----------------------------------------------------------*/
+
+static size_t getReportLength( const ReportMetrics_t * pMetrics,
+                               uint32_t majorReportVersion,
+                               uint32_t minorReportVersion,
+                               uint32_t reportId )
+{
+    size_t customMetricsLength;
+    size_t length = REPORT_FIXED_LENGTH +
+                    getDecimalLength( reportId ) +
+                    getDecimalLength( majorReportVersion ) +
+                    getDecimalLength( minorReportVersion );
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_TCP_PORTS ) )
+    {
+        length += PORTS_SECTION_FIXED_LENGTH +
+                  getPortsArrayLength( pMetrics->pOpenTcpPortsArray, pMetrics->openTcpPortsArrayLength ) +
+                  getDecimalLength( pMetrics->openTcpPortsArrayLength );
+    }
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_UDP_PORTS ) )
+    {
+        length += PORTS_SECTION_FIXED_LENGTH +
+                  getPortsArrayLength( pMetrics->pOpenUdpPortsArray, pMetrics->openUdpPortsArrayLength ) +
+                  getDecimalLength( pMetrics->openUdpPortsArrayLength );
+    }
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_NETWORK_STATS ) )
+    {
+        length += NETWORK_STATS_SECTION_FIXED_LENGTH +
+                  getDecimalLength( pMetrics->pNetworkStats->bytesReceived ) +
+                  getDecimalLength( pMetrics->pNetworkStats->bytesSent ) +
+                  getDecimalLength( pMetrics->pNetworkStats->packetsReceived ) +
+                  getDecimalLength( pMetrics->pNetworkStats->packetsSent );
+    }
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_CONNECTIONS ) )
+    {
+        length += CONNECTIONS_SECTION_FIXED_LENGTH +
+                  getConnectionsArrayLength( pMetrics->pEstablishedConnectionsArray,
+                                             pMetrics->establishedConnectionsArrayLength ) +
+                  getDecimalLength( pMetrics->establishedConnectionsArrayLength );
+    }
+
+    /* The comma of the last section is discarded. */
+    if( ( pMetrics->omittedSections & REPORT_SECTION_ALL ) != REPORT_SECTION_ALL )
+    {
+        length -= 1U;
+    }
+
+    customMetricsLength = getCustomMetricsLength( pMetrics->pCustomMetricsArray,
+                                                  pMetrics->customMetricsArrayLength );
+
+    if( customMetricsLength > 0U )
+    {
+        length += CUSTOM_METRICS_SECTION_FIXED_LENGTH + customMetricsLength;
+    }
+
+    return length;
+}
 /*-----------------------------------------------------------*/
 
-static ReportBuilderStatus_t writePortsArray( char * pBuffer,
-                                              uint32_t bufferLength,
-                                              const uint16_t * pOpenPortsArray,
-                                              uint32_t openPortsArrayLength,
-                                              uint32_t * pOutCharsWritten )
+static char * writePortsArray( char * pBuffer,
+                               const uint16_t * pOpenPortsArray,
+                               uint32_t openPortsArrayLength )
 {
     char * pCurrentWritePos = pBuffer;
-    uint32_t i, remainingBufferLength = bufferLength;
-    int charactersWritten;
-    ReportBuilderStatus_t status = ReportBuilderSuccess;
+    uint32_t i;
 
     /* Write the JSON array open marker. */
-    if( remainingBufferLength > 1 )
+    *pCurrentWritePos = JSON_ARRAY_OPEN_MARKER;
+    pCurrentWritePos += 1;
+
+    /* Write the array elements. */
+    for( i = 0; i < openPortsArrayLength; i++ )
     {
-        *pCurrentWritePos = JSON_ARRAY_OPEN_MARKER;
-        remainingBufferLength -= 1;
-        pCurrentWritePos += 1;
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_PORT_OBJECT_PREFIX );
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, pOpenPortsArray[ i ] );
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_PORT_OBJECT_SUFFIX );
     }
-    else
+
+    /* Discard the last comma. */
+    if( openPortsArrayLength > 0 )
     {
-        status = ReportBuilderBufferTooSmall;
+        pCurrentWritePos -= 1;
     }
 
+    /* Write the JSON array close marker. */
+    *pCurrentWritePos = JSON_ARRAY_CLOSE_MARKER;
+    pCurrentWritePos += 1;
+
+    return pCurrentWritePos;
+}
+/*-----------------------------------------------------------*/
+
+static char * writeConnectionsArray( char * pBuffer,
+                                     const Connection_t * pConnectionsArray,
+                                     uint32_t connectionsArrayLength )
+{
+    char * pCurrentWritePos = pBuffer;
+    uint32_t i;
+    const Connection_t * pConn;
+
+    /* Write the JSON array open marker. */
+    *pCurrentWritePos = JSON_ARRAY_OPEN_MARKER;
+    pCurrentWritePos += 1;
+
     /* Write the array elements. */
-    for( i = 0; ( ( i < openPortsArrayLength ) && ( status == ReportBuilderSuccess ) ); i++ )
+    for( i = 0; i < connectionsArrayLength; i++ )
     {
-        charactersWritten = snprintf( pCurrentWritePos,
-                                      remainingBufferLength,
-                                      JSON_PORT_OBJECT_FORMAT,
-                                      pOpenPortsArray[ i ] );
+        pConn = &( pConnectionsArray[ i ] );
 
-        if( !SNPRINTF_SUCCESS( charactersWritten, remainingBufferLength ) )
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_CONNECTION_OBJECT_PREFIX );
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, pConn->localPort );
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_CONNECTION_OBJECT_REMOTE_ADDR );
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, ( pConn->remoteIp >> 24 ) & 0xFF );
+        *pCurrentWritePos = '.';
+        pCurrentWritePos += 1;
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, ( pConn->remoteIp >> 16 ) & 0xFF );
+        *pCurrentWritePos = '.';
+        pCurrentWritePos += 1;
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, ( pConn->remoteIp >> 8 ) & 0xFF );
+        *pCurrentWritePos = '.';
+        pCurrentWritePos += 1;
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, ( pConn->remoteIp ) & 0xFF );
+        *pCurrentWritePos = ':';
+        pCurrentWritePos += 1;
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, pConn->remotePort );
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_CONNECTION_OBJECT_SUFFIX );
+    }
+
+    /* Discard the last comma. */
+    if( connectionsArrayLength > 0 )
+    {
+        pCurrentWritePos -= 1;
+    }
+
+    /* Write the JSON array close marker. */
+    *pCurrentWritePos = JSON_ARRAY_CLOSE_MARKER;
+    pCurrentWritePos += 1;
+
+    return pCurrentWritePos;
+}
+/*-----------------------------------------------------------*/
+
+static size_t getCustomMetricsLength( const CustomMetricStats_t * pCustomMetricsArray,
+                                      uint32_t customMetricsArrayLength )
+{
+    size_t length = 0U;
+    uint32_t i, stat;
+    const CustomMetricStats_t * pStats;
+
+    for( i = 0U; i < customMetricsArrayLength; i++ )
+    {
+        pStats = &( pCustomMetricsArray[ i ] );
+
+        for( stat = 0U; stat < CUSTOM_METRIC_STATISTICS; stat++ )
         {
-            status = ReportBuilderBufferTooSmall;
-            break;
+            if( ( pStats->statistics & ( 1UL << stat ) ) != 0U )
+            {
+                length += CUSTOM_METRIC_ENTRY_FIXED_LENGTH +
+                          pStats->nameLength +
+                          statSuffixes[ stat ].length +
+                          getDecimalLength( pStats->values[ stat ] );
+            }
         }
-        else
+    }
+
+    return length;
+}
+/*-----------------------------------------------------------*/
+
+static char * writeCustomMetrics( char * pBuffer,
+                                  const CustomMetricStats_t * pCustomMetricsArray,
+                                  uint32_t customMetricsArrayLength )
+{
+    char * pCurrentWritePos = pBuffer;
+    uint32_t i, stat;
+    const CustomMetricStats_t * pStats;
+
+    for( i = 0U; i < customMetricsArrayLength; i++ )
+    {
+        pStats = &( pCustomMetricsArray[ i ] );
+
+        for( stat = 0U; stat < CUSTOM_METRIC_STATISTICS; stat++ )
         {
-            remainingBufferLength -= ( uint32_t ) charactersWritten;
-            pCurrentWritePos += charactersWritten;
+            if( ( pStats->statistics & ( 1UL << stat ) ) != 0U )
+            {
+                WRITE_FRAGMENT( pCurrentWritePos, JSON_CUSTOM_METRIC_PREFIX );
+                ( void ) memcpy( pCurrentWritePos, pStats->pName, pStats->nameLength );
+                pCurrentWritePos += pStats->nameLength;
+                ( void ) memcpy( pCurrentWritePos, statSuffixes[ stat ].pSuffix, statSuffixes[ stat ].length );
+                pCurrentWritePos += statSuffixes[ stat ].length;
+                WRITE_FRAGMENT( pCurrentWritePos, JSON_CUSTOM_METRIC_NUMBER_PREFIX );
+                pCurrentWritePos = writeDecimal( pCurrentWritePos, pStats->values[ stat ] );
+                WRITE_FRAGMENT( pCurrentWritePos, JSON_CUSTOM_METRIC_SUFFIX );
+            }
         }
     }
 
-    if( status == ReportBuilderSuccess )
+    return pCurrentWritePos;
+}
+/*-----------------------------------------------------------*/
+
+static void cborWriteBytes( CborWriter_t * pWriter,
+                            const void * pBytes,
+                            size_t length )
+{
+    if( ( pWriter->pBuffer != NULL ) &&
+        ( pWriter->length <= pWriter->bufferLength ) &&
+        ( length <= ( pWriter->bufferLength - pWriter->length ) ) )
+    {
+        ( void ) memcpy( &( pWriter->pBuffer[ pWriter->length ] ), pBytes, length );
+    }
+
+    pWriter->length += length;
+}
+/*-----------------------------------------------------------*/
+
+static void cborWriteHead( CborWriter_t * pWriter,
+                           uint8_t majorType,
+                           uint64_t value )
+{
+    uint8_t head[ 9 ];
+    size_t headLength = 0U, valueLength = 0U, i;
+
+    /* Values below 24 are in the first byte, else in the 1, 2, 4 or 8 bytes
+     * after it, big endian. */
+    if( value < 24U )
     {
-        /* Discard the last comma. */
-        if( openPortsArrayLength > 0 )
+        head[ 0 ] = ( uint8_t ) ( ( majorType << 5 ) | ( uint8_t ) value );
+    }
+    else
+    {
+        if( value <= UINT8_MAX )
         {
-            pCurrentWritePos -= 1;
-            remainingBufferLength += 1;
+            valueLength = 1U;
+            head[ 0 ] = ( uint8_t ) ( ( majorType << 5 ) | 24U );
         }
-
-        /* Write the JSON array close marker. */
-        if( remainingBufferLength > 1 )
+        else if( value <= UINT16_MAX )
         {
-            *pCurrentWritePos = JSON_ARRAY_CLOSE_MARKER;
-            remainingBufferLength -= 1;
-            pCurrentWritePos += 1;
+            valueLength = 2U;
+            head[ 0 ] = ( uint8_t ) ( ( majorType << 5 ) | 25U );
+        }
+        else if( value <= UINT32_MAX )
+        {
+            valueLength = 4U;
+            head[ 0 ] = ( uint8_t ) ( ( majorType << 5 ) | 26U );
         }
         else
         {
-            status = ReportBuilderBufferTooSmall;
+            valueLength = 8U;
+            head[ 0 ] = ( uint8_t ) ( ( majorType << 5 ) | 27U );
+        }
+
+        for( i = 0U; i < valueLength; i++ )
+        {
+            head[ valueLength - i ] = ( uint8_t ) ( value >> ( 8U * i ) );
         }
     }
 
-    if( status == ReportBuilderSuccess )
+    headLength = 1U + valueLength;
+    cborWriteBytes( pWriter, head, headLength );
+}
+/*-----------------------------------------------------------*/
+
+static void cborWriteText( CborWriter_t * pWriter,
+                           const char * pText,
+                           size_t length )
+{
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_TEXT, length );
+    cborWriteBytes( pWriter, pText, length );
+}
+/*-----------------------------------------------------------*/
+
+static void cborWritePorts( CborWriter_t * pWriter,
+                            const uint16_t * pOpenPortsArray,
+                            uint32_t openPortsArrayLength )
+{
+    uint32_t i;
+
+    /* { "pts": [ { "pt": port }, ... ], "t": total } */
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 2U );
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_PORTS );
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_ARRAY, openPortsArrayLength );
+
+    for( i = 0; i < openPortsArrayLength; i++ )
     {
-        *pOutCharsWritten = bufferLength - remainingBufferLength;
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 1U );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_PORT );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, pOpenPortsArray[ i ] );
     }
 
-    return status;
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_TOTAL );
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, openPortsArrayLength );
 }
 /*-----------------------------------------------------------*/
 
-static ReportBuilderStatus_t writeConnectionsArray( char * pBuffer,
-                                                    uint32_t bufferLength,
-                                                    const Connection_t * pConnectionsArray,
-                                                    uint32_t connectionsArrayLength,
-                                                    uint32_t * pOutCharsWritten )
+static void cborWriteConnections( CborWriter_t * pWriter,
+                                  const Connection_t * pConnectionsArray,
+                                  uint32_t connectionsArrayLength )
 {
-    char * pCurrentWritePos = pBuffer;
-    uint32_t i, remainingBufferLength = bufferLength;
-    int charactersWritten;
-    ReportBuilderStatus_t status = ReportBuilderSuccess;
+    char remoteAddr[ REMOTE_ADDR_MAX_LENGTH ];
+    char * pEnd = NULL;
+    uint32_t i;
     const Connection_t * pConn;
 
-    /* Write the JSON array open marker. */
-    if( remainingBufferLength > 1 )
-    {
-        *pCurrentWritePos = JSON_ARRAY_OPEN_MARKER;
-        remainingBufferLength -= 1;
-        pCurrentWritePos += 1;
-    }
-    else
+    /* { "cs": [ { "lp": port, "rad": "a.b.c.d:port" }, ... ], "t": total } */
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 2U );
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_CONNECTIONS );
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_ARRAY, connectionsArrayLength );
+
+    for( i = 0; i < connectionsArrayLength; i++ )
     {
-        status = ReportBuilderBufferTooSmall;
+        pConn = &( pConnectionsArray[ i ] );
+
+        pEnd = writeDecimal( &( remoteAddr[ 0 ] ), ( pConn->remoteIp >> 24 ) & 0xFF );
+        *pEnd = '.';
+        pEnd = writeDecimal( pEnd + 1, ( pConn->remoteIp >> 16 ) & 0xFF );
+        *pEnd = '.';
+        pEnd = writeDecimal( pEnd + 1, ( pConn->remoteIp >> 8 ) & 0xFF );
+        *pEnd = '.';
+        pEnd = writeDecimal( pEnd + 1, ( pConn->remoteIp ) & 0xFF );
+        *pEnd = ':';
+        pEnd = writeDecimal( pEnd + 1, pConn->remotePort );
+
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 2U );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_LOCAL_PORT );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, pConn->localPort );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_REMOTE_ADDR );
+        cborWriteText( pWriter, &( remoteAddr[ 0 ] ), ( size_t ) ( pEnd - &( remoteAddr[ 0 ] ) ) );
     }
 
-    /* Write the array elements. */
-    for( i = 0; ( ( i < connectionsArrayLength ) && ( status == ReportBuilderSuccess ) ); i++ )
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_TOTAL );
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, connectionsArrayLength );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t getCustomMetricsEntryCount( const CustomMetricStats_t * pCustomMetricsArray,
+                                            uint32_t customMetricsArrayLength )
+{
+    uint32_t count = 0U, i, stat;
+
+    for( i = 0U; i < customMetricsArrayLength; i++ )
     {
-        pConn = &( pConnectionsArray[ i ] );
-        charactersWritten = snprintf( pCurrentWritePos,
-                                      remainingBufferLength,
-                                      JSON_CONNECTION_OBJECT_FORMAT,
-                                      pConn->localPort,
-                                      ( pConn->remoteIp >> 24 ) & 0xFF,
-                                      ( pConn->remoteIp >> 16 ) & 0xFF,
-                                      ( pConn->remoteIp >> 8 ) & 0xFF,
-                                      ( pConn->remoteIp ) & 0xFF,
-                                      pConn->remotePort );
-
-        if( !SNPRINTF_SUCCESS( charactersWritten, remainingBufferLength ) )
+        for( stat = 0U; stat < CUSTOM_METRIC_STATISTICS; stat++ )
         {
-            status = ReportBuilderBufferTooSmall;
-            break;
-        }
-        else
-        {
-            remainingBufferLength -= charactersWritten;
-            pCurrentWritePos += charactersWritten;
+            if( ( pCustomMetricsArray[ i ].statistics & ( 1UL << stat ) ) != 0U )
+            {
+                count++;
+            }
         }
     }
 
-    if( status == ReportBuilderSuccess )
+    return count;
+}
+/*-----------------------------------------------------------*/
+
+static void cborWriteCustomMetrics( CborWriter_t * pWriter,
+                                    const CustomMetricStats_t * pCustomMetricsArray,
+                                    uint32_t customMetricsArrayLength,
+                                    uint32_t entryCount )
+{
+    uint32_t i, stat;
+    const CustomMetricStats_t * pStats;
+
+    /* { "<name><suffix>": [ { "number": value } ], ... } */
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, entryCount );
+
+    for( i = 0U; i < customMetricsArrayLength; i++ )
     {
-        /* Discard the last comma. */
-        if( connectionsArrayLength > 0 )
-        {
-            pCurrentWritePos -= 1;
-            remainingBufferLength += 1;
-        }
+        pStats = &( pCustomMetricsArray[ i ] );
 
-        /* Write the JSON array close marker. */
-        if( remainingBufferLength > 1 )
+        for( stat = 0U; stat < CUSTOM_METRIC_STATISTICS; stat++ )
         {
-            *pCurrentWritePos = JSON_ARRAY_CLOSE_MARKER;
-            remainingBufferLength -= 1;
-            pCurrentWritePos += 1;
+            if( ( pStats->statistics & ( 1UL << stat ) ) != 0U )
+            {
+                cborWriteHead( pWriter, CBOR_MAJOR_TYPE_TEXT, pStats->nameLength + statSuffixes[ stat ].length );
+                cborWriteBytes( pWriter, pStats->pName, pStats->nameLength );
+                cborWriteBytes( pWriter, statSuffixes[ stat ].pSuffix, statSuffixes[ stat ].length );
+                cborWriteHead( pWriter, CBOR_MAJOR_TYPE_ARRAY, 1U );
+                cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 1U );
+                CBOR_WRITE_KEY( pWriter, CBOR_KEY_NUMBER );
+                cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, pStats->values[ stat ] );
+            }
         }
-        else
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void cborWriteReport( CborWriter_t * pWriter,
+                             const ReportMetrics_t * pMetrics,
+                             uint32_t majorReportVersion,
+                             uint32_t minorReportVersion,
+                             uint32_t reportId )
+{
+    char version[ VERSION_MAX_LENGTH ];
+    char * pEnd = NULL;
+    uint32_t sectionCount = 0U, section, customEntryCount;
+
+    for( section = REPORT_SECTION_TCP_PORTS; section <= REPORT_SECTION_CONNECTIONS; section <<= 1 )
+    {
+        if( HAS_SECTION( pMetrics, section ) )
         {
-            status = ReportBuilderBufferTooSmall;
+            sectionCount++;
         }
     }
 
-    if( status == ReportBuilderSuccess )
+    pEnd = writeDecimal( &( version[ 0 ] ), majorReportVersion );
+    *pEnd = '.';
+    pEnd = writeDecimal( pEnd + 1, minorReportVersion );
+
+    customEntryCount = getCustomMetricsEntryCount( pMetrics->pCustomMetricsArray,
+                                                   pMetrics->customMetricsArrayLength );
+
+    /* { "hed": { "rid": reportId, "v": "major.minor" }, "met": { ... },
+     *   "cmet": { ... } } */
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, ( customEntryCount > 0U ) ? 3U : 2U );
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_HEADER );
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 2U );
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_REPORT_ID );
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, reportId );
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_VERSION );
+    cborWriteText( pWriter, &( version[ 0 ] ), ( size_t ) ( pEnd - &( version[ 0 ] ) ) );
+
+    CBOR_WRITE_KEY( pWriter, CBOR_KEY_METRICS );
+    cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, sectionCount );
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_TCP_PORTS ) )
+    {
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_LISTENING_TCP_PORTS );
+        cborWritePorts( pWriter, pMetrics->pOpenTcpPortsArray, pMetrics->openTcpPortsArrayLength );
+    }
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_UDP_PORTS ) )
+    {
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_LISTENING_UDP_PORTS );
+        cborWritePorts( pWriter, pMetrics->pOpenUdpPortsArray, pMetrics->openUdpPortsArrayLength );
+    }
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_NETWORK_STATS ) )
+    {
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_NETWORK_STATS );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 4U );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_BYTES_IN );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, pMetrics->pNetworkStats->bytesReceived );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_BYTES_OUT );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, pMetrics->pNetworkStats->bytesSent );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_PACKETS_IN );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, pMetrics->pNetworkStats->packetsReceived );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_PACKETS_OUT );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_UNSIGNED, pMetrics->pNetworkStats->packetsSent );
+    }
+
+    if( HAS_SECTION( pMetrics, REPORT_SECTION_CONNECTIONS ) )
+    {
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_TCP_CONNECTIONS );
+        cborWriteHead( pWriter, CBOR_MAJOR_TYPE_MAP, 1U );
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_ESTABLISHED_CONNECTIONS );
+        cborWriteConnections( pWriter,
+                              pMetrics->pEstablishedConnectionsArray,
+                              pMetrics->establishedConnectionsArrayLength );
+    }
+
+    if( customEntryCount > 0U )
+    {
+        CBOR_WRITE_KEY( pWriter, CBOR_KEY_CUSTOM_METRICS );
+        cborWriteCustomMetrics( pWriter,
+                                pMetrics->pCustomMetricsArray,
+                                pMetrics->customMetricsArrayLength,
+                                customEntryCount );
+    }
+}
+/*-----------------------------------------------------------*/
+
+ReportBuilderStatus_t GetJsonReportLength( const ReportMetrics_t * pMetrics,
+                                           uint32_t majorReportVersion,
+                                           uint32_t minorReportVersion,
+                                           uint32_t reportId,
+                                           uint32_t * pOutReportLength )
+{
+    ReportBuilderStatus_t status = ReportBuilderSuccess;
+
+    if( ( pMetrics == NULL ) ||
+        ( ( pMetrics->pNetworkStats == NULL ) && HAS_SECTION( pMetrics, REPORT_SECTION_NETWORK_STATS ) ) ||
+        ( ( pMetrics->pCustomMetricsArray == NULL ) && ( pMetrics->customMetricsArrayLength > 0U ) ) ||
+        ( pOutReportLength == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pMetrics: %p, pOutReportLength: %p.",
+                    ( void * ) pMetrics,
+                    ( void * ) pOutReportLength ) );
+        status = ReportBuilderBadParameter;
+    }
+    else
     {
-        *pOutCharsWritten = bufferLength - remainingBufferLength;
+        *pOutReportLength = ( uint32_t ) getReportLength( pMetrics,
+                                                          majorReportVersion,
+                                                          minorReportVersion,
+                                                          reportId );
     }
 
     return status;
@@ -315,13 +1148,16 @@ ReportBuilderStatus_t GenerateJsonReport( char * pBuffer,
                                           uint32_t * pOutReportLength )
 {
     char * pCurrentWritePos = pBuffer;
-    uint32_t remainingBufferLength = bufferLength, bufferWritten;
+    size_t reportLength = 0U;
     ReportBuilderStatus_t status = ReportBuilderSuccess;
-    int charactersWritten;
+
+    TRACE_PROBE2( report_generate_start, reportId, bufferLength );
 
     if( ( pBuffer == NULL ) ||
         ( bufferLength == 0 ) ||
         ( pMetrics == NULL ) ||
+        ( ( pMetrics->pNetworkStats == NULL ) && HAS_SECTION( pMetrics, REPORT_SECTION_NETWORK_STATS ) ) ||
+        ( ( pMetrics->pCustomMetricsArray == NULL ) && ( pMetrics->customMetricsArrayLength > 0U ) ) ||
         ( pOutReportLength == NULL ) )
     {
         LogError( ( "Invalid parameters. pBuffer: %p, bufferLength: %u"
@@ -333,157 +1169,195 @@ ReportBuilderStatus_t GenerateJsonReport( char * pBuffer,
         status = ReportBuilderBadParameter;
     }
 
-    /* Write part1. */
+    /* Check the room for the whole report, and its terminating NULL, once.
+     * Everything is then written without a check. */
     if( status == ReportBuilderSuccess )
     {
-        charactersWritten = snprintf( pCurrentWritePos,
-                                      remainingBufferLength,
-                                      JSON_REPORT_FORMAT_PART1,
-                                      reportId,
-                                      majorReportVersion,
-                                      minorReportVersion );
+        reportLength = getReportLength( pMetrics,
+                                        majorReportVersion,
+                                        minorReportVersion,
+                                        reportId );
 
-        if( !SNPRINTF_SUCCESS( charactersWritten, remainingBufferLength ) )
+        if( reportLength >= bufferLength )
         {
-            LogError( ( "Failed to write part 1." ) );
+            LogError( ( "The report needs a buffer of %u bytes, larger than %u bytes.",
+                        ( unsigned int ) ( reportLength + 1U ),
+                        bufferLength ) );
             status = ReportBuilderBufferTooSmall;
         }
-        else
-        {
-            remainingBufferLength -= charactersWritten;
-            pCurrentWritePos += charactersWritten;
-        }
     }
 
-    /* Write TCP ports array. */
     if( status == ReportBuilderSuccess )
     {
-        status = writePortsArray( pCurrentWritePos,
-                                  remainingBufferLength,
-                                  pMetrics->pOpenTcpPortsArray,
-                                  pMetrics->openTcpPortsArrayLength,
-                                  &( bufferWritten ) );
+        /* Write the header. */
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_HEADER_PREFIX );
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, reportId );
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_VERSION_PREFIX );
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, majorReportVersion );
+        *pCurrentWritePos = '.';
+        pCurrentWritePos += 1;
+        pCurrentWritePos = writeDecimal( pCurrentWritePos, minorReportVersion );
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_METRICS_PREFIX );
 
-        if( status == ReportBuilderSuccess )
-        {
-            pCurrentWritePos += bufferWritten;
-            remainingBufferLength -= bufferWritten;
-        }
-        else
+        /* Write the TCP ports. */
+        if( HAS_SECTION( pMetrics, REPORT_SECTION_TCP_PORTS ) )
         {
-            LogError( ( "Failed to write TCP ports array." ) );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_TCP_PORTS_PREFIX );
+            pCurrentWritePos = writePortsArray( pCurrentWritePos,
+                                                pMetrics->pOpenTcpPortsArray,
+                                                pMetrics->openTcpPortsArrayLength );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_TOTAL_PREFIX );
+            pCurrentWritePos = writeDecimal( pCurrentWritePos, pMetrics->openTcpPortsArrayLength );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_SECTION_SUFFIX );
         }
-    }
 
-    /* Write part2. */
-    if( status == ReportBuilderSuccess )
-    {
-        charactersWritten = snprintf( pCurrentWritePos,
-                                      remainingBufferLength,
-                                      JSON_REPORT_FORMAT_PART2,
-                                      pMetrics->openTcpPortsArrayLength );
-
-        if( !SNPRINTF_SUCCESS( charactersWritten, remainingBufferLength ) )
+        /* Write the UDP ports. */
+        if( HAS_SECTION( pMetrics, REPORT_SECTION_UDP_PORTS ) )
         {
-            LogError( ( "Failed to write part 2." ) );
-            status = ReportBuilderBufferTooSmall;
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_UDP_PORTS_PREFIX );
+            pCurrentWritePos = writePortsArray( pCurrentWritePos,
+                                                pMetrics->pOpenUdpPortsArray,
+                                                pMetrics->openUdpPortsArrayLength );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_TOTAL_PREFIX );
+            pCurrentWritePos = writeDecimal( pCurrentWritePos, pMetrics->openUdpPortsArrayLength );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_SECTION_SUFFIX );
         }
-        else
+
+        /* Write the network stats. */
+        if( HAS_SECTION( pMetrics, REPORT_SECTION_NETWORK_STATS ) )
         {
-            remainingBufferLength -= charactersWritten;
-            pCurrentWritePos += charactersWritten;
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_BYTES_IN_PREFIX );
+            pCurrentWritePos = writeDecimal( pCurrentWritePos, pMetrics->pNetworkStats->bytesReceived );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_BYTES_OUT_PREFIX );
+            pCurrentWritePos = writeDecimal( pCurrentWritePos, pMetrics->pNetworkStats->bytesSent );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_PACKETS_IN_PREFIX );
+            pCurrentWritePos = writeDecimal( pCurrentWritePos, pMetrics->pNetworkStats->packetsReceived );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_PACKETS_OUT_PREFIX );
+            pCurrentWritePos = writeDecimal( pCurrentWritePos, pMetrics->pNetworkStats->packetsSent );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_SECTION_SUFFIX );
         }
-    }
 
-    /* Write UDP ports array. */
-    if( status == ReportBuilderSuccess )
-    {
-        status = writePortsArray( pCurrentWritePos,
-                                  remainingBufferLength,
-                                  pMetrics->pOpenUdpPortsArray,
-                                  pMetrics->openUdpPortsArrayLength,
-                                  &( bufferWritten ) );
-
-        if( status == ReportBuilderSuccess )
+        /* Write the established connections. */
+        if( HAS_SECTION( pMetrics, REPORT_SECTION_CONNECTIONS ) )
         {
-            pCurrentWritePos += bufferWritten;
-            remainingBufferLength -= bufferWritten;
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_CONNECTIONS_PREFIX );
+            pCurrentWritePos = writeConnectionsArray( pCurrentWritePos,
+                                                      pMetrics->pEstablishedConnectionsArray,
+                                                      pMetrics->establishedConnectionsArrayLength );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_TOTAL_PREFIX );
+            pCurrentWritePos = writeDecimal( pCurrentWritePos, pMetrics->establishedConnectionsArrayLength );
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_CONNECTIONS_SUFFIX );
         }
-        else
+
+        /* Discard the comma of the last section. */
+        if( ( pMetrics->omittedSections & REPORT_SECTION_ALL ) != REPORT_SECTION_ALL )
         {
-            LogError( ( "Failed to write UDP ports array." ) );
+            pCurrentWritePos -= 1;
         }
-    }
 
-    /* Write part3. */
-    if( status == ReportBuilderSuccess )
-    {
-        charactersWritten = snprintf( pCurrentWritePos,
-                                      remainingBufferLength,
-                                      JSON_REPORT_FORMAT_PART3,
-                                      pMetrics->openUdpPortsArrayLength,
-                                      pMetrics->pNetworkStats->bytesReceived,
-                                      pMetrics->pNetworkStats->bytesSent,
-                                      pMetrics->pNetworkStats->packetsReceived,
-                                      pMetrics->pNetworkStats->packetsSent );
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_METRICS_SUFFIX );
 
-        if( !SNPRINTF_SUCCESS( charactersWritten, remainingBufferLength ) )
-        {
-            LogError( ( "Failed to write part 3." ) );
-            status = ReportBuilderBufferTooSmall;
-        }
-        else
+        /* Write the custom metrics, discarding the comma of the last one. */
+        if( getCustomMetricsLength( pMetrics->pCustomMetricsArray,
+                                    pMetrics->customMetricsArrayLength ) > 0U )
         {
-            remainingBufferLength -= charactersWritten;
-            pCurrentWritePos += charactersWritten;
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_CUSTOM_METRICS_PREFIX );
+            pCurrentWritePos = writeCustomMetrics( pCurrentWritePos,
+                                                   pMetrics->pCustomMetricsArray,
+                                                   pMetrics->customMetricsArrayLength );
+            pCurrentWritePos -= 1;
+            WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_CUSTOM_METRICS_SUFFIX );
         }
+
+        WRITE_FRAGMENT( pCurrentWritePos, JSON_REPORT_SUFFIX );
+
+        *pCurrentWritePos = '\0';
+        *pOutReportLength = ( uint32_t ) reportLength;
     }
 
-    /* Write connections array. */
-    if( status == ReportBuilderSuccess )
+    TRACE_PROBE3( report_generate_done, reportId, status, reportLength );
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+ReportBuilderStatus_t GetCborReportLength( const ReportMetrics_t * pMetrics,
+                                           uint32_t majorReportVersion,
+                                           uint32_t minorReportVersion,
+                                           uint32_t reportId,
+                                           uint32_t * pOutReportLength )
+{
+    ReportBuilderStatus_t status = ReportBuilderSuccess;
+    CborWriter_t writer = { NULL, 0U, 0U };
+
+    if( ( pMetrics == NULL ) ||
+        ( ( pMetrics->pNetworkStats == NULL ) && HAS_SECTION( pMetrics, REPORT_SECTION_NETWORK_STATS ) ) ||
+        ( ( pMetrics->pCustomMetricsArray == NULL ) && ( pMetrics->customMetricsArrayLength > 0U ) ) ||
+        ( pOutReportLength == NULL ) )
     {
-        status = writeConnectionsArray( pCurrentWritePos,
-                                        remainingBufferLength,
-                                        pMetrics->pEstablishedConnectionsArray,
-                                        pMetrics->establishedConnectionsArrayLength,
-                                        &( bufferWritten ) );
+        LogError( ( "Invalid parameters. pMetrics: %p, pOutReportLength: %p.",
+                    ( void * ) pMetrics,
+                    ( void * ) pOutReportLength ) );
+        status = ReportBuilderBadParameter;
+    }
+    else
+    {
+        cborWriteReport( &( writer ), pMetrics, majorReportVersion, minorReportVersion, reportId );
+        *pOutReportLength = ( uint32_t ) writer.length;
+    }
 
-        if( status == ReportBuilderSuccess )
-        {
-            pCurrentWritePos += bufferWritten;
-            remainingBufferLength -= bufferWritten;
-        }
-        else
-        {
-            LogError( ( "Failed to write established connections array." ) );
-        }
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+ReportBuilderStatus_t GenerateCborReport( uint8_t * pBuffer,
+                                          uint32_t bufferLength,
+                                          const ReportMetrics_t * pMetrics,
+                                          uint32_t majorReportVersion,
+                                          uint32_t minorReportVersion,
+                                          uint32_t reportId,
+                                          uint32_t * pOutReportLength )
+{
+    ReportBuilderStatus_t status = ReportBuilderSuccess;
+    CborWriter_t writer;
+
+    if( ( pBuffer == NULL ) ||
+        ( bufferLength == 0 ) ||
+        ( pMetrics == NULL ) ||
+        ( ( pMetrics->pNetworkStats == NULL ) && HAS_SECTION( pMetrics, REPORT_SECTION_NETWORK_STATS ) ) ||
+        ( ( pMetrics->pCustomMetricsArray == NULL ) && ( pMetrics->customMetricsArrayLength > 0U ) ) ||
+        ( pOutReportLength == NULL ) )
+    {
+        LogError( ( "Invalid parameters. pBuffer: %p, bufferLength: %u"
+                    " pMetrics: %p, pOutReportLength: %p.",
+                    ( void * ) pBuffer,
+                    bufferLength,
+                    ( void * ) pMetrics,
+                    ( void * ) pOutReportLength ) );
+        status = ReportBuilderBadParameter;
     }
 
-    /* Write part4. */
     if( status == ReportBuilderSuccess )
     {
-        charactersWritten = snprintf( pCurrentWritePos,
-                                      remainingBufferLength,
-                                      JSON_REPORT_FORMAT_PART4,
-                                      pMetrics->establishedConnectionsArrayLength );
+        writer.pBuffer = pBuffer;
+        writer.bufferLength = bufferLength;
+        writer.length = 0U;
 
-        if( !SNPRINTF_SUCCESS( charactersWritten, remainingBufferLength ) )
+        cborWriteReport( &( writer ), pMetrics, majorReportVersion, minorReportVersion, reportId );
+
+        if( writer.length > bufferLength )
         {
-            LogError( ( "Failed to write part 4." ) );
+            LogError( ( "The report needs a buffer of %u bytes, larger than %u bytes.",
+                        ( unsigned int ) writer.length,
+                        bufferLength ) );
             status = ReportBuilderBufferTooSmall;
         }
         else
         {
-            remainingBufferLength -= charactersWritten;
-            pCurrentWritePos += charactersWritten;
+            *pOutReportLength = ( uint32_t ) writer.length;
         }
     }
 
-    if( status == ReportBuilderSuccess )
-    {
-        *pOutReportLength = bufferLength - remainingBufferLength;
-    }
-
     return status;
 }
 /*-----------------------------------------------------------*/
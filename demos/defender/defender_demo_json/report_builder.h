@@ -26,6 +26,9 @@
 /* Metrics collector. */
 #include "metrics_collector.h"
 
+/* Custom metrics. */
+#include "custom_metrics.h"
+
 /**
  * @brief Return codes from report builder APIs.
  */
@@ -36,11 +39,30 @@ typedef enum
     ReportBuilderBufferTooSmall
 } ReportBuilderStatus_t;
 
+/**
+ * @brief Sections of the metrics of a report, for
+ * #ReportMetrics_t.omittedSections.
+ */
+#define REPORT_SECTION_TCP_PORTS        ( 1U << 0 )
+#define REPORT_SECTION_UDP_PORTS        ( 1U << 1 )
+#define REPORT_SECTION_NETWORK_STATS    ( 1U << 2 )
+#define REPORT_SECTION_CONNECTIONS      ( 1U << 3 )
+#define REPORT_SECTION_ALL                                          \
+    ( REPORT_SECTION_TCP_PORTS | REPORT_SECTION_UDP_PORTS |         \
+      REPORT_SECTION_NETWORK_STATS | REPORT_SECTION_CONNECTIONS )
+
 /**
  * @brief Represents metrics to be included in the report.
+ *
+ * The sections set in omittedSections are left out of the report, so a report
+ * can carry only the sections that changed. pNetworkStats may be NULL if the
+ * network stats are left out. The statistics of pCustomMetricsArray are
+ * reported as custom metrics, with the suffix of each statistic added to the
+ * name of the metric.
  */
 typedef struct ReportMetrics
 {
+    uint32_t omittedSections;
     NetworkStats_t * pNetworkStats;
     uint16_t * pOpenTcpPortsArray;
     uint32_t openTcpPortsArrayLength;
@@ -48,6 +70,8 @@ typedef struct ReportMetrics
     uint32_t openUdpPortsArrayLength;
     Connection_t * pEstablishedConnectionsArray;
     uint32_t establishedConnectionsArrayLength;
+    const CustomMetricStats_t * pCustomMetricsArray;
+    uint32_t customMetricsArrayLength;
 } ReportMetrics_t;
 
 /**
@@ -74,4 +98,69 @@ ReportBuilderStatus_t GenerateJsonReport( char * pBuffer,
                                           uint32_t reportId,
                                           uint32_t * pOutReportLength );
 
+/**
+ * @brief Get the length of the report #GenerateJsonReport generates.
+ *
+ * The buffer passed to #GenerateJsonReport must be at least 1 byte longer,
+ * for the terminating NULL.
+ *
+ * @param[in] pMetrics Metrics to write in the report.
+ * @param[in] majorReportVersion Major version of the report.
+ * @param[in] minorReportVersion Minor version of the report.
+ * @param[in] reportId Value to be used as the reportId in the report.
+ * @param[out] pOutReportLength The length of the report.
+ *
+ * @return #ReportBuilderSuccess if the length is computed;
+ * #ReportBuilderBadParameter if invalid parameters are passed.
+ */
+ReportBuilderStatus_t GetJsonReportLength( const ReportMetrics_t * pMetrics,
+                                           uint32_t majorReportVersion,
+                                           uint32_t minorReportVersion,
+                                           uint32_t reportId,
+                                           uint32_t * pOutReportLength );
+
+/**
+ * @brief Generate a CBOR report in the format expected by the AWS IoT Device
+ * Defender Service.
+ *
+ * The report uses the short names of the fields, such as "hed" for "header".
+ *
+ * @param[in] pBuffer The buffer to write the report into.
+ * @param[in] bufferLength The length of the buffer.
+ * @param[in] pMetrics Metrics to write in the generated report.
+ * @param[in] majorReportVersion Major version of the report.
+ * @param[in] minorReportVersion Minor version of the report.
+ * @param[in] reportId Value to be used as the reportId in the generated report.
+ * @param[out] pOutReportLength The length of the generated report.
+ *
+ * @return #ReportBuilderSuccess if the report is successfully generated;
+ * #ReportBuilderBadParameter if invalid parameters are passed;
+ * #ReportBuilderBufferTooSmall if the buffer cannot hold the full report.
+ */
+ReportBuilderStatus_t GenerateCborReport( uint8_t * pBuffer,
+                                          uint32_t bufferLength,
+                                          const ReportMetrics_t * pMetrics,
+                                          uint32_t majorReportVersion,
+                                          uint32_t minorReportVersion,
+                                          uint32_t reportId,
+                                          uint32_t * pOutReportLength );
+
+/**
+ * @brief Get the length of the report #GenerateCborReport generates.
+ *
+ * @param[in] pMetrics Metrics to write in the report.
+ * @param[in] majorReportVersion Major version of the report.
+ * @param[in] minorReportVersion Minor version of the report.
+ * @param[in] reportId Value to be used as the reportId in the report.
+ * @param[out] pOutReportLength The length of the report.
+ *
+ * @return #ReportBuilderSuccess if the length is computed;
+ * #ReportBuilderBadParameter if invalid parameters are passed.
+ */
+ReportBuilderStatus_t GetCborReportLength( const ReportMetrics_t * pMetrics,
+                                           uint32_t majorReportVersion,
+                                           uint32_t minorReportVersion,
+                                           uint32_t reportId,
+                                           uint32_t * pOutReportLength );
+
 #endif /* ifndef REPORT_BUILDER_H_ */
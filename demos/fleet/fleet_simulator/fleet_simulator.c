@@ -0,0 +1,2142 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Simulator of a fleet of devices, each running the shadow, Jobs and Device
+ * Defender workloads of the demos over an MQTT connection of its own.
+ *
+ * The demos are single devices, each driven by its own main loop. The
+ * simulator instead drives the devices of the fleet from a few reactors, each
+ * owning the devices of a shard: a device goes to the shard of the
+ * consistent hash of its client identifier, and the event loop of its MQTT
+ * connection is registered with the event loop of the reactor of the shard,
+ * whose timers issue the workloads of the device at the rates given. The
+ * devices of a shard are only touched from the thread of its reactor, so
+ * the reactors share nothing but the counters of the responses, which are
+ * parsed on a pool of workers stealing the work of one another with
+ * --workers. Each device:
+ * - updates the reported state of its classic shadow,
+ * - publishes a Device Defender metrics report in JSON,
+ * - asks for its next pending job with StartNextPendingJobExecution,
+ * and counts the accepted and rejected responses of AWS IoT to each.
+ * The reserved topics of the things are assembled once, before the devices
+ * connect, into a single buffer, from which the devices publish, subscribe to
+ * the responses of all their workloads with a single SUBSCRIBE, and tell the
+ * responses apart.
+ *
+ * Every second, the simulator prints the throughput of the whole fleet,
+ * summed from the totals each reactor takes of its shard. The
+ * devices can also be made to reconnect one after the other, with --churn,
+ * and the time taken to disconnect, to reconnect and to subscribe again when
+ * the broker does not resume the session is recorded, along with the time of
+ * the first connections. With --metrics-port, the totals of the MQTT
+ * connections of the fleet can be scraped by Prometheus during the run.
+ *
+ * Run the simulator with --help for its options. The devices are named from
+ * a prefix followed by their index, such as fleet-device-0, and share the
+ * client certificate given, whose policy must allow these client identifiers
+ * and the topics of these things. For example:
+ * $ fleet_simulator -h abcdefg123.iot.us-east-1.amazonaws.com --cafile AmazonRootCA1.pem \
+ *   --certfile certificate.pem.crt --keyfile private.pem.key -n 200 --shadow 5000 \
+ *   --defender 60000 --jobs 10000 --churn 500 -d 120 --reactors 4 --workers 2
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* MQTT connection shared by the demos. */
+#include "mqtt_connection.h"
+
+/* Reactors driving the connections of the shards of the fleet. */
+#include "reactor_pool_posix.h"
+
+/* Workers parsing the responses to the workloads. */
+#include "work_pool.h"
+
+/* JSON parser validating the responses. */
+#include "core_json.h"
+
+/* Reserved topics of the things. */
+#include "thing_topics.h"
+
+/* Clock for timing the connections. */
+#include "clock.h"
+
+/* Histogram of the connection times. */
+#include "latency_histogram.h"
+
+/* Prometheus endpoint of the metrics of the SDK. */
+#include "metrics.h"
+
+/* Memory of the fleet, counted by subsystem. */
+#include "allocator.h"
+
+/* OpenSSL transport, whose allocations are counted. */
+#include "openssl_posix.h"
+
+/**
+ * @brief Port of AWS IoT with TLS.
+ */
+#define DEFAULT_PORT                         ( 8883U )
+
+/**
+ * @brief Default number of devices.
+ */
+#define DEFAULT_DEVICE_COUNT                 ( 10U )
+
+/**
+ * @brief Default interval between the shadow updates of a device, in
+ * milliseconds.
+ */
+#define DEFAULT_SHADOW_INTERVAL_MS           ( 5000U )
+
+/**
+ * @brief Default interval between the Device Defender reports of a device,
+ * in milliseconds. AWS IoT accepts a report every 5 minutes at most.
+ */
+#define DEFAULT_DEFENDER_INTERVAL_MS         ( 300000U )
+
+/**
+ * @brief Default interval between the job requests of a device, in
+ * milliseconds.
+ */
+#define DEFAULT_JOBS_INTERVAL_MS             ( 10000U )
+
+/**
+ * @brief Default number of reactors, each driving the devices of its shard
+ * from a thread of its own.
+ */
+#define DEFAULT_REACTOR_COUNT                ( 1U )
+
+/**
+ * @brief Default number of workers parsing the responses; 0 parses them on
+ * the reactors.
+ */
+#define DEFAULT_WORKER_COUNT                 ( 0U )
+
+/**
+ * @brief Thread group of the reactors, as in thread_groups.h.
+ */
+#define REACTOR_THREAD_GROUP                 "reactor"
+
+/**
+ * @brief Thread group of the workers parsing the responses.
+ */
+#define WORKER_THREAD_GROUP                  "parser"
+
+/**
+ * @brief Default length of the simulation, in seconds.
+ */
+#define DEFAULT_DURATION_SEC                 ( 60U )
+
+/**
+ * @brief Default prefix of the thing names, followed by the index of the
+ * device. The thing name is also the client identifier.
+ */
+#define DEFAULT_THING_NAME_PREFIX            "fleet-device-"
+
+/**
+ * @brief Largest length of the thing names.
+ */
+#define THING_NAME_MAX_LENGTH                ( 64U )
+
+/**
+ * @brief Largest length of the topics and topic filters of a device.
+ */
+#define TOPIC_MAX_LENGTH                     ( 256U )
+
+/**
+ * @brief Largest length of the payload of a workload.
+ */
+#define PAYLOAD_MAX_LENGTH                   ( 192U )
+
+/**
+ * @brief Size of the network buffer of a device, for the responses of AWS
+ * IoT. The larger ones, such as a job document, are dropped by the MQTT
+ * library.
+ */
+#define NETWORK_BUFFER_SIZE                  ( 2048U )
+
+/**
+ * @brief Largest TLS record of the devices, which the network buffer holds.
+ */
+#define TLS_MAX_FRAGMENT_LENGTH              ( 2048U )
+
+/**
+ * @brief Maximum number of outgoing publishes of a device waiting for their
+ * PUBACK.
+ */
+#define MAX_OUTGOING_PUBLISHES               ( MQTT_STATE_ARRAY_MAX_COUNT )
+
+/**
+ * @brief Maximum number of publishes of a device queued while it is
+ * disconnected.
+ */
+#define OFFLINE_PUBLISH_QUEUE_LENGTH         ( 4U )
+
+/**
+ * @brief Maximum length of the topic and payload of a queued publish.
+ */
+#define OFFLINE_PUBLISH_SLOT_SIZE            ( TOPIC_MAX_LENGTH + PAYLOAD_MAX_LENGTH )
+
+/**
+ * @brief Keep-alive interval of the sessions.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS     ( 60U )
+
+/**
+ * @brief Interval at which the connection of an idle device is processed, for
+ * its keep-alive, in milliseconds.
+ */
+#define KEEP_ALIVE_SWEEP_INTERVAL_MS         ( 1000U )
+
+/**
+ * @brief Send and receive timeout of the TLS connections, in milliseconds.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS       ( 1000U )
+
+/**
+ * @brief Time to wait for the CONNACK, in milliseconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS              ( 5000U )
+
+/**
+ * @brief Time to wait for the SUBACKs, in milliseconds.
+ */
+#define ACK_TIMEOUT_MS                       ( 5000U )
+
+/**
+ * @brief First delay before a device reconnects after losing its connection,
+ * doubled after every failed attempt, in milliseconds.
+ *
+ * The connection attempts block the thread of the whole fleet, so each call
+ * to #MqttConnection_Connect makes a single attempt, and the delays between
+ * the attempts are timers of the event loop instead.
+ */
+#define RECONNECT_BASE_DELAY_MS              ( 1000U )
+
+/**
+ * @brief Longest delay before a device reconnects, in milliseconds.
+ */
+#define RECONNECT_MAX_DELAY_MS               ( 60000U )
+
+/**
+ * @brief Interval of the report of the throughput of the fleet, in
+ * milliseconds.
+ */
+#define REPORT_INTERVAL_MS                   ( 1000U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The workloads of a device.
+ */
+typedef enum FleetWorkload
+{
+    FleetWorkloadShadow = 0, /**< @brief Updates of the reported state of the classic shadow. */
+    FleetWorkloadDefender,   /**< @brief Device Defender metrics reports in JSON. */
+    FleetWorkloadJobs,       /**< @brief Requests for the next pending job. */
+    FleetWorkloadCount       /**< @brief Number of workloads. */
+} FleetWorkload_t;
+
+/**
+ * @brief The reserved topics of a workload.
+ */
+typedef struct FleetWorkloadTopics
+{
+    ThingTopic_t request;   /**< @brief Topic of the publishes. */
+    ThingTopic_t responses; /**< @brief Topic filter of the responses. */
+    ThingTopic_t accepted;  /**< @brief Topic of the accepted responses. */
+    ThingTopic_t rejected;  /**< @brief Topic of the rejected responses. */
+} FleetWorkloadTopics_t;
+
+/**
+ * @brief The options of a run.
+ */
+typedef struct FleetConfig
+{
+    const char * pHostName;                      /**< @brief Host name of the broker. */
+    uint16_t port;                               /**< @brief Port of the broker. */
+    const char * pRootCaPath;                    /**< @brief Root CA certificate of the broker. */
+    const char * pClientCertPath;                /**< @brief Client certificate shared by the devices. */
+    const char * pPrivateKeyPath;                /**< @brief Private key of the client certificate. */
+    const char * pThingNamePrefix;               /**< @brief Prefix of the thing names. */
+    uint32_t deviceCount;                        /**< @brief Number of devices. */
+    uint32_t intervalMs[ FleetWorkloadCount ];   /**< @brief Interval between the publishes of each workload of a device; 0 disables the workload. */
+    uint32_t churnIntervalMs;                    /**< @brief Interval between the reconnections of the devices, one at a time; 0 for none. */
+    uint32_t durationSec;                        /**< @brief Length of the simulation. */
+    uint16_t metricsPort;                        /**< @brief Port of the Prometheus endpoint of the SDK metrics; 0 for none. */
+    uint32_t reactorCount;                       /**< @brief Number of reactors, each driving the devices of a shard. */
+    uint32_t workerCount;                        /**< @brief Number of workers parsing the responses; 0 to parse them on the reactors. */
+} FleetConfig_t;
+
+struct FleetDevice;
+struct FleetShard;
+
+/**
+ * @brief Timer of a workload of a device.
+ */
+typedef struct FleetTimer
+{
+    TimerWheelTimer_t timer;     /**< @brief Timer of the event loop of the shard of the device, pointing to this. */
+    struct FleetDevice * pDevice; /**< @brief The device. */
+    FleetWorkload_t workload;    /**< @brief The workload issued when the timer is due. */
+} FleetTimer_t;
+
+/**
+ * @brief A device of the fleet and the memory of its connection.
+ */
+typedef struct FleetDevice
+{
+    char thingName[ THING_NAME_MAX_LENGTH ];                                  /**< @brief Thing name, also the client identifier. */
+    uint16_t thingNameLength;                                                 /**< @brief Length of #FleetDevice_t.thingName. */
+    ThingTopics_t topics;                                                     /**< @brief Reserved topics of the thing, in #pTopicBuffer. */
+    char payloads[ FleetWorkloadCount ][ PAYLOAD_MAX_LENGTH ];                /**< @brief Payload of the last publish of each workload, kept until its PUBACK. */
+    uint32_t sequence;                                                        /**< @brief Sequence number of the next publish, such as the identifier of a Defender report. */
+    struct FleetShard * pShard;                                               /**< @brief The shard of the device, from its client identifier. */
+    MqttConnection_t * pConnection;                                           /**< @brief The connection of the device. */
+    EventLoopConnection_t loopConnection;                                     /**< @brief The event loop of the connection, in the event loop of the shard. */
+    FleetTimer_t timers[ FleetWorkloadCount ];                                /**< @brief Timers of the workloads. */
+    uint32_t reconnectDelayMs;                                                /**< @brief Delay before the next connection attempt, while disconnected. */
+    bool connected;                                                           /**< @brief Whether the session is established. */
+    uint8_t networkBuffer[ NETWORK_BUFFER_SIZE ];                             /**< @brief Network buffer of the connection. */
+    PublishWindowEntry_t windowEntries[ MAX_OUTGOING_PUBLISHES ];             /**< @brief Entries of the window of the outgoing publishes. */
+    uint16_t windowBuckets[ PUBLISH_WINDOW_BUCKET_COUNT( MAX_OUTGOING_PUBLISHES ) ]; /**< @brief Hash buckets of the window. */
+    PublishQueueEntry_t queueEntries[ OFFLINE_PUBLISH_QUEUE_LENGTH ];          /**< @brief Entries of the offline queue. */
+    uint8_t queueSlots[ OFFLINE_PUBLISH_QUEUE_LENGTH * OFFLINE_PUBLISH_SLOT_SIZE ]; /**< @brief Copies of the queued publishes. */
+} FleetDevice_t;
+
+/**
+ * @brief Counters of a shard or of the fleet, besides those of the
+ * connections.
+ *
+ * The counters of the responses are updated atomically, as the workers
+ * parsing the responses count them; the other members are only written by
+ * the reactor of the shard.
+ */
+typedef struct FleetStats
+{
+    uint64_t accepted[ FleetWorkloadCount ]; /**< @brief Accepted responses to each workload. */
+    uint64_t rejected[ FleetWorkloadCount ]; /**< @brief Rejected responses to each workload. */
+    uint64_t otherReceived;                  /**< @brief Other publishes received, such as the shadow documents. */
+    uint64_t malformed;                      /**< @brief Publishes received whose payload is not valid JSON. */
+    uint64_t publishFailures;                /**< @brief Publishes neither sent nor queued. */
+    uint64_t connectionLosses;               /**< @brief Connections lost by the devices. */
+    uint64_t connectFailures;                /**< @brief Failed connection attempts. */
+    uint64_t churns;                         /**< @brief Reconnections made with --churn. */
+    LatencyHistogram_t connectMs;            /**< @brief Times of the first connections, in milliseconds. */
+    LatencyHistogram_t subscribeMs;          /**< @brief Times of subscribing to the responses of the workloads, in milliseconds. */
+    LatencyHistogram_t disconnectMs;         /**< @brief Times of the disconnections of --churn, in milliseconds. */
+    LatencyHistogram_t reconnectMs;          /**< @brief Times of the reconnections, subscriptions included, in milliseconds. */
+} FleetStats_t;
+
+/**
+ * @brief Sums of the counters of the connections, at a report.
+ */
+typedef struct FleetTotals
+{
+    uint64_t publishesSent;                  /**< @brief Sum of #MqttConnectionMetrics_t.publishesSent. */
+    uint64_t pubacksReceived;                /**< @brief Sum of #MqttConnectionMetrics_t.pubacksReceived. */
+    uint64_t publishesQueued;                /**< @brief Sum of #MqttConnectionMetrics_t.publishesQueued. */
+    uint64_t sessionsResumed;                /**< @brief Sum of #MqttConnectionMetrics_t.sessionsResumed. */
+    uint64_t accepted;                       /**< @brief Sum of #FleetStats_t.accepted. */
+    uint64_t rejected;                       /**< @brief Sum of #FleetStats_t.rejected. */
+    uint64_t tlsBufferBytes;                 /**< @brief Memory of the TLS buffers of the connected devices. */
+    uint32_t connectedCount;                 /**< @brief Number of devices connected. */
+} FleetTotals_t;
+
+/**
+ * @brief The devices driven by a reactor, and their counters.
+ */
+typedef struct FleetShard
+{
+    EventLoop_t * pEventLoop;      /**< @brief Event loop of the reactor of the shard. */
+    FleetDevice_t ** ppDevices;    /**< @brief The devices of the shard. */
+    uint32_t deviceCount;          /**< @brief Number of #FleetShard_t.ppDevices. */
+    uint32_t churnCursor;          /**< @brief Index of the device to reconnect next with --churn. */
+    TimerWheelTimer_t totalsTimer; /**< @brief Timer of the totals of the shard, taken for the report. */
+    TimerWheelTimer_t churnTimer;  /**< @brief Timer of the reconnections of --churn. */
+    FleetStats_t stats;            /**< @brief Counters of the devices of the shard. */
+    pthread_mutex_t totalsMutex;   /**< @brief Guards #FleetShard_t.totals, read by the main thread. */
+    FleetTotals_t totals;          /**< @brief Totals of the shard when it last took them. */
+} FleetShard_t;
+
+/**
+ * @brief A response received by a device, copied out of its network buffer
+ * to be parsed by a worker. The topic and the payload follow the structure.
+ */
+typedef struct FleetResponse
+{
+    WorkPoolTask_t task;          /**< @brief Task of the work pool, pointing to this. */
+    const FleetDevice_t * pDevice; /**< @brief The device, whose topics do not change during the run. */
+    const char * pTopic;          /**< @brief Topic of the response. */
+    uint16_t topicLength;         /**< @brief Length of #FleetResponse_t.pTopic. */
+    const char * pPayload;        /**< @brief Payload of the response. */
+    size_t payloadLength;         /**< @brief Length of #FleetResponse_t.pPayload. */
+} FleetResponse_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The options of the run.
+ */
+static FleetConfig_t fleetConfig;
+
+/**
+ * @brief The devices.
+ */
+static FleetDevice_t * pDevices = NULL;
+
+/**
+ * @brief Buffer holding the reserved topics of all the devices, one after
+ * the other.
+ */
+static char * pTopicBuffer = NULL;
+
+/**
+ * @brief The devices, grouped by shard.
+ */
+static FleetDevice_t ** ppShardDevices = NULL;
+
+/**
+ * @brief The reactors, one per shard.
+ */
+static ReactorPool_t reactorPool;
+
+/**
+ * @brief The shards.
+ */
+static FleetShard_t * pShards = NULL;
+
+/**
+ * @brief The workers parsing the responses, with --workers.
+ */
+static WorkPool_t workPool;
+
+/**
+ * @brief Whether #workPool runs, from before the reactors start until after
+ * they stop.
+ */
+static bool workersRunning = false;
+
+/**
+ * @brief Counters of the fleet, summed from those of the shards at the
+ * end.
+ */
+static FleetStats_t fleetStats;
+
+/**
+ * @brief Totals at the last report.
+ */
+static FleetTotals_t lastTotals;
+
+/**
+ * @brief Time of the start of the simulation and of the last report.
+ */
+static uint32_t startTimeMs = 0U, lastReportTimeMs = 0U;
+
+/**
+ * @brief Names of the workloads, for the options and the report.
+ */
+static const char * const workloadNames[ FleetWorkloadCount ] = { "shadow", "defender", "jobs" };
+
+/**
+ * @brief Reserved topics of the workloads.
+ */
+static const FleetWorkloadTopics_t workloadTopics[ FleetWorkloadCount ] =
+{
+    { ThingTopicShadowUpdate,  ThingTopicShadowUpdateResponses,  ThingTopicShadowUpdateAccepted,  ThingTopicShadowUpdateRejected  },
+    { ThingTopicDefenderJson,  ThingTopicDefenderJsonResponses,  ThingTopicDefenderJsonAccepted,  ThingTopicDefenderJsonRejected  },
+    { ThingTopicJobsStartNext, ThingTopicJobsStartNextResponses, ThingTopicJobsStartNextAccepted, ThingTopicJobsStartNextRejected }
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Print the usage of the simulator.
+ *
+ * @param[in] programName Name of the executable.
+ */
+static void usage( const char * programName );
+
+/**
+ * @brief Parse a number given to an option.
+ *
+ * @param[in] pArgument The argument of the option.
+ * @param[in] minValue Smallest value allowed.
+ * @param[in] maxValue Largest value allowed.
+ * @param[out] pValue The value.
+ *
+ * @return true if the argument is a number within bounds; false otherwise.
+ */
+static bool parseNumber( const char * pArgument,
+                         uint32_t minValue,
+                         uint32_t maxValue,
+                         uint32_t * pValue );
+
+/**
+ * @brief Parse the command line.
+ *
+ * @param[out] pConfig The options.
+ * @param[in] argc Number of arguments.
+ * @param[in] argv The arguments.
+ *
+ * @return true if the options are valid; false otherwise.
+ */
+static bool parseArgs( FleetConfig_t * pConfig,
+                       int argc,
+                       char * argv[] );
+
+/**
+ * @brief Raise the limit on open files to its hard limit, for the two
+ * descriptors of every device.
+ */
+static void raiseDescriptorLimit( void );
+
+/**
+ * @brief Name a device.
+ *
+ * @param[in] pDevice The device.
+ * @param[in] index Index of the device in the fleet.
+ *
+ * @return true if the name fits; false otherwise.
+ */
+static bool nameDevice( FleetDevice_t * pDevice,
+                        uint32_t index );
+
+/**
+ * @brief Assemble the reserved topics of all the named devices into
+ * #pTopicBuffer.
+ *
+ * @return true if successful; false otherwise.
+ */
+static bool assembleTopics( void );
+
+/**
+ * @brief Group the devices by the shard of their client identifiers.
+ *
+ * @return true if successful; false otherwise.
+ */
+static bool shardDevices( void );
+
+/**
+ * @brief Create the connection of a device and register its event loop with
+ * that of its shard.
+ *
+ * @param[in] pDevice The device.
+ *
+ * @return true if successful; false otherwise.
+ */
+static bool createDevice( FleetDevice_t * pDevice );
+
+/**
+ * @brief Connect a device and subscribe to the responses of its workloads,
+ * unless the broker resumed its session.
+ *
+ * @param[in] pDevice The device.
+ * @param[out] pConnectMs Time taken to connect, in milliseconds.
+ *
+ * @return true if the device is connected; false otherwise.
+ */
+static bool connectDevice( FleetDevice_t * pDevice,
+                           uint32_t * pConnectMs );
+
+/**
+ * @brief Disconnect a device, closing its connection.
+ *
+ * @param[in] pDevice The device.
+ */
+static void disconnectDevice( FleetDevice_t * pDevice );
+
+/**
+ * @brief Subscribe to the accepted and rejected responses of the workloads
+ * of a device.
+ *
+ * @param[in] pDevice The device.
+ *
+ * @return true if every subscription is acknowledged; false otherwise.
+ */
+static bool subscribeDevice( FleetDevice_t * pDevice );
+
+/**
+ * @brief Publish the next message of a workload of a device.
+ *
+ * @param[in] pDevice The device.
+ * @param[in] workload The workload.
+ */
+static void publishWorkload( FleetDevice_t * pDevice,
+                             FleetWorkload_t workload );
+
+/**
+ * @brief Callback of the timers of the workloads, which publishes and starts
+ * the timer again.
+ *
+ * @param[in] pTimer The timer of the workload of a device.
+ */
+static void handleWorkloadTimer( TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Callback of the event loop of the connection of a device, which
+ * processes the connection, and reconnects the device once its delay is
+ * over after a lost connection.
+ *
+ * @param[in] pLoopConnection The event loop of the connection.
+ * @param[in] events The events of the connection.
+ */
+static void handleDeviceEvents( EventLoopConnection_t * pLoopConnection,
+                                uint32_t events );
+
+/**
+ * @brief The event callback of the connections, which parses the responses
+ * to the workloads, or copies them for the workers to parse.
+ *
+ * @param[in] pMqttContext MQTT context pointer.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Count a response to a workload of a device, as accepted or
+ * rejected from its topic, and validate its JSON payload.
+ *
+ * @param[in] pDevice The device.
+ * @param[in] pTopic Topic of the response.
+ * @param[in] topicLength Length of @p pTopic.
+ * @param[in] pPayload Payload of the response.
+ * @param[in] payloadLength Length of @p pPayload.
+ */
+static void parseResponse( const FleetDevice_t * pDevice,
+                           const char * pTopic,
+                           uint16_t topicLength,
+                           const char * pPayload,
+                           size_t payloadLength );
+
+/**
+ * @brief Function of the tasks of the work pool, which parses a copied
+ * response and frees it.
+ *
+ * @param[in] pTask #FleetResponse_t.task of the response.
+ */
+static void handleResponseTask( WorkPoolTask_t * pTask );
+
+/**
+ * @brief Add up the counters of a shard and of its connections. Only from
+ * the reactor of the shard, or once the reactors are stopped.
+ *
+ * @param[in] pShard The shard.
+ * @param[out] pTotals The sums.
+ */
+static void sumTotals( const FleetShard_t * pShard,
+                       FleetTotals_t * pTotals );
+
+/**
+ * @brief Add totals to others.
+ *
+ * @param[in,out] pSum The totals added to.
+ * @param[in] pTotals The totals added.
+ */
+static void addTotals( FleetTotals_t * pSum,
+                       const FleetTotals_t * pTotals );
+
+/**
+ * @brief Callback of #FleetShard_t.totalsTimer, which takes the totals of
+ * the shard for the report.
+ *
+ * @param[in] pTimer #FleetShard_t.totalsTimer.
+ */
+static void handleTotalsTimer( TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Print the throughput of the fleet since the last report, from the
+ * totals last taken by the shards.
+ */
+static void printReport( void );
+
+/**
+ * @brief Callback of #FleetShard_t.churnTimer, which reconnects the next
+ * device connected of the shard.
+ *
+ * @param[in] pTimer #FleetShard_t.churnTimer.
+ */
+static void handleChurnTimer( TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Add up the counters of the shards into #fleetStats, once the
+ * reactors are stopped.
+ */
+static void sumStats( void );
+
+/**
+ * @brief Print the percentiles of a histogram of times.
+ *
+ * @param[in] pName What is timed.
+ * @param[in] pHistogram The times, in milliseconds.
+ */
+static void printTimes( const char * pName,
+                        const LatencyHistogram_t * pHistogram );
+
+/**
+ * @brief Print the memory of the fleet, in total, per device and by
+ * subsystem.
+ *
+ * @param[in] pPhase The point of the simulation, such as "after connecting".
+ */
+static void printMemory( const char * pPhase );
+
+/**
+ * @brief Read the bytes allocated by the fleet, as a gauge of the metrics.
+ *
+ * @param[in] pContext Unused.
+ *
+ * @return The bytes in use.
+ */
+static int64_t readMemoryBytes( void * pContext );
+
+/**
+ * @brief Read the peak of the bytes allocated by the fleet, as a gauge of
+ * the metrics.
+ *
+ * @param[in] pContext Unused.
+ *
+ * @return The peak of the bytes in use.
+ */
+static int64_t readMemoryPeakBytes( void * pContext );
+
+/**
+ * @brief Print the counters of the whole simulation.
+ *
+ * @param[in] elapsedMs Length of the simulation.
+ */
+static void printSummary( uint32_t elapsedMs );
+
+/*-----------------------------------------------------------*/
+
+static void usage( const char * programName )
+{
+    fprintf( stderr,
+             "\nThis simulator drives a fleet of devices from a few reactors, each with an MQTT\n"
+             "connection of its own, running the shadow, Jobs and Device Defender workloads.\n"
+             "\nusage: %s -h host [-p port] --cafile file --certfile file --keyfile file\n"
+             "       [-n devices] [--shadow ms] [--defender ms] [--jobs ms] [--churn ms]\n"
+             "       [-d seconds] [--prefix name] [--metrics-port port] [--reactors count]\n"
+             "       [--workers count]\n"
+             "\n"
+             "-h, --host      : broker to connect to, such as the endpoint of AWS IoT.\n"
+             "-p, --port      : port of the broker. Defaults to %u.\n"
+             "--cafile        : root CA certificate of the broker.\n"
+             "--certfile      : client certificate, shared by the devices.\n"
+             "--keyfile       : private key of the client certificate.\n",
+             programName,
+             ( unsigned int ) DEFAULT_PORT );
+    fprintf( stderr,
+             "-n, --devices   : number of devices, at most %u. Defaults to %u.\n"
+             "--shadow        : interval between the shadow updates of a device, in ms.\n"
+             "                  Defaults to %u.\n"
+             "--defender      : interval between the Defender reports of a device, in ms.\n"
+             "                  Defaults to %u.\n"
+             "--jobs          : interval between the job requests of a device, in ms.\n"
+             "                  Defaults to %u.\n",
+             ( unsigned int ) FLEET_MAX_DEVICES,
+             ( unsigned int ) DEFAULT_DEVICE_COUNT,
+             ( unsigned int ) DEFAULT_SHADOW_INTERVAL_MS,
+             ( unsigned int ) DEFAULT_DEFENDER_INTERVAL_MS,
+             ( unsigned int ) DEFAULT_JOBS_INTERVAL_MS );
+    fprintf( stderr,
+             "--churn         : interval between the reconnections of the devices, one at a\n"
+             "                  time, in ms. Defaults to 0, for none.\n"
+             "-d, --duration  : length of the simulation in seconds. Defaults to %u.\n"
+             "--prefix        : prefix of the thing names, followed by the index of the\n"
+             "                  device. Defaults to %s.\n"
+             "--metrics-port  : serve the metrics of the SDK for Prometheus on this port of\n"
+             "                  127.0.0.1. Defaults to 0, for none.\n",
+             ( unsigned int ) DEFAULT_DURATION_SEC,
+             DEFAULT_THING_NAME_PREFIX );
+    fprintf( stderr,
+             "--reactors      : number of threads driving the devices, each those of the\n"
+             "                  shard of their thing names, at most %u. Defaults to %u.\n"
+             "--workers       : number of threads parsing the responses, at most %u.\n"
+             "                  Defaults to %u, for the reactors to parse them.\n"
+             "\nAn interval of 0 disables the workload.\n\n",
+             ( unsigned int ) REACTOR_POOL_MAX_REACTORS,
+             ( unsigned int ) DEFAULT_REACTOR_COUNT,
+             ( unsigned int ) WORK_POOL_MAX_WORKERS,
+             ( unsigned int ) DEFAULT_WORKER_COUNT );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseNumber( const char * pArgument,
+                         uint32_t minValue,
+                         uint32_t maxValue,
+                         uint32_t * pValue )
+{
+    bool returnStatus = false;
+    char * pEnd = NULL;
+    unsigned long value = strtoul( pArgument, &pEnd, 0 );
+
+    if( ( pEnd != pArgument ) && ( *pEnd == '\0' ) && ( pArgument[ 0 ] != '-' ) &&
+        ( value >= minValue ) && ( value <= maxValue ) )
+    {
+        *pValue = ( uint32_t ) value;
+        returnStatus = true;
+    }
+    else
+    {
+        LogError( ( "Bad value: %s.", pArgument ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseArgs( FleetConfig_t * pConfig,
+                       int argc,
+                       char * argv[] )
+{
+    bool returnStatus = true;
+    int option = 0;
+    uint32_t value = 0U;
+    static const struct option longOptions[] =
+    {
+        { "host",         required_argument, NULL, 'h' },
+        { "port",         required_argument, NULL, 'p' },
+        { "cafile",       required_argument, NULL, 'f' },
+        { "certfile",     required_argument, NULL, 'c' },
+        { "keyfile",      required_argument, NULL, 'k' },
+        { "devices",      required_argument, NULL, 'n' },
+        { "shadow",       required_argument, NULL, 's' },
+        { "defender",     required_argument, NULL, 'r' },
+        { "jobs",         required_argument, NULL, 'j' },
+        { "churn",        required_argument, NULL, 'x' },
+        { "duration",     required_argument, NULL, 'd' },
+        { "prefix",       required_argument, NULL, 't' },
+        { "metrics-port", required_argument, NULL, 'm' },
+        { "reactors",     required_argument, NULL, 'e' },
+        { "workers",      required_argument, NULL, 'w' },
+        { "help",         no_argument,       NULL, '?' },
+        { NULL,           0,                 NULL, 0   }
+    };
+
+    ( void ) memset( pConfig, 0x00, sizeof( FleetConfig_t ) );
+    pConfig->port = DEFAULT_PORT;
+    pConfig->pThingNamePrefix = DEFAULT_THING_NAME_PREFIX;
+    pConfig->deviceCount = DEFAULT_DEVICE_COUNT;
+    pConfig->intervalMs[ FleetWorkloadShadow ] = DEFAULT_SHADOW_INTERVAL_MS;
+    pConfig->intervalMs[ FleetWorkloadDefender ] = DEFAULT_DEFENDER_INTERVAL_MS;
+    pConfig->intervalMs[ FleetWorkloadJobs ] = DEFAULT_JOBS_INTERVAL_MS;
+    pConfig->durationSec = DEFAULT_DURATION_SEC;
+    pConfig->reactorCount = DEFAULT_REACTOR_COUNT;
+    pConfig->workerCount = DEFAULT_WORKER_COUNT;
+
+    while( returnStatus == true )
+    {
+        option = getopt_long( argc, argv, "h:p:n:d:?", longOptions, NULL );
+
+        if( option == -1 )
+        {
+            break;
+        }
+
+        switch( option )
+        {
+            case 'h':
+                pConfig->pHostName = optarg;
+                break;
+
+            case 'p':
+                returnStatus = parseNumber( optarg, 1U, UINT16_MAX, &value );
+                pConfig->port = ( uint16_t ) value;
+                break;
+
+            case 'f':
+                pConfig->pRootCaPath = optarg;
+                break;
+
+            case 'c':
+                pConfig->pClientCertPath = optarg;
+                break;
+
+            case 'k':
+                pConfig->pPrivateKeyPath = optarg;
+                break;
+
+            case 'n':
+                returnStatus = parseNumber( optarg, 1U, FLEET_MAX_DEVICES, &pConfig->deviceCount );
+                break;
+
+            case 's':
+                returnStatus = parseNumber( optarg, 0U, 86400000U, &pConfig->intervalMs[ FleetWorkloadShadow ] );
+                break;
+
+            case 'r':
+                returnStatus = parseNumber( optarg, 0U, 86400000U, &pConfig->intervalMs[ FleetWorkloadDefender ] );
+                break;
+
+            case 'j':
+                returnStatus = parseNumber( optarg, 0U, 86400000U, &pConfig->intervalMs[ FleetWorkloadJobs ] );
+                break;
+
+            case 'x':
+                returnStatus = parseNumber( optarg, 0U, 86400000U, &pConfig->churnIntervalMs );
+                break;
+
+            case 'd':
+                returnStatus = parseNumber( optarg, 1U, 86400U, &pConfig->durationSec );
+                break;
+
+            case 't':
+                pConfig->pThingNamePrefix = optarg;
+                break;
+
+            case 'm':
+                returnStatus = parseNumber( optarg, 0U, UINT16_MAX, &value );
+                pConfig->metricsPort = ( uint16_t ) value;
+                break;
+
+            case 'e':
+                returnStatus = parseNumber( optarg, 1U, REACTOR_POOL_MAX_REACTORS, &pConfig->reactorCount );
+                break;
+
+            case 'w':
+                returnStatus = parseNumber( optarg, 0U, WORK_POOL_MAX_WORKERS, &pConfig->workerCount );
+                break;
+
+            case '?':
+            default:
+                returnStatus = false;
+                break;
+        }
+    }
+
+    if( ( returnStatus == true ) &&
+        ( ( optind < argc ) || ( pConfig->pHostName == NULL ) || ( pConfig->pRootCaPath == NULL ) ||
+          ( pConfig->pClientCertPath == NULL ) || ( pConfig->pPrivateKeyPath == NULL ) ) )
+    {
+        returnStatus = false;
+    }
+
+    if( returnStatus == false )
+    {
+        usage( argv[ 0 ] );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void raiseDescriptorLimit( void )
+{
+    struct rlimit limit;
+
+    if( getrlimit( RLIMIT_NOFILE, &limit ) == 0 )
+    {
+        if( limit.rlim_cur < limit.rlim_max )
+        {
+            limit.rlim_cur = limit.rlim_max;
+            ( void ) setrlimit( RLIMIT_NOFILE, &limit );
+        }
+
+        /* Each device has a socket and an epoll instance, besides those of
+         * the reactors and of the files opened for TLS. */
+        if( ( limit.rlim_cur != RLIM_INFINITY ) &&
+            ( limit.rlim_cur < ( ( ( rlim_t ) fleetConfig.deviceCount * 2U ) + 64U ) ) )
+        {
+            LogWarn( ( "The limit of %lu open files may be too low for %u devices.",
+                       ( unsigned long ) limit.rlim_cur,
+                       ( unsigned int ) fleetConfig.deviceCount ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool nameDevice( FleetDevice_t * pDevice,
+                        uint32_t index )
+{
+    bool returnStatus = true;
+    int length = 0;
+
+    length = snprintf( pDevice->thingName, sizeof( pDevice->thingName ), "%s%u",
+                       fleetConfig.pThingNamePrefix, ( unsigned int ) index );
+
+    if( ( length <= 0 ) || ( ( size_t ) length >= sizeof( pDevice->thingName ) ) )
+    {
+        LogError( ( "The thing names are longer than %u characters.",
+                    ( unsigned int ) ( THING_NAME_MAX_LENGTH - 1U ) ) );
+        returnStatus = false;
+    }
+    else
+    {
+        pDevice->thingNameLength = ( uint16_t ) length;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool assembleTopics( void )
+{
+    bool returnStatus = true;
+    size_t bufferSize = 0U;
+    size_t offset = 0U;
+    size_t deviceSize = 0U;
+    uint32_t index = 0U;
+
+    /* The names of the things are only known at run time, so the topics of
+     * each thing are assembled once, one thing after the other in a single
+     * buffer, and then only ever read. */
+    for( index = 0U; index < fleetConfig.deviceCount; index++ )
+    {
+        bufferSize += THING_TOPICS_BUFFER_SIZE( ( size_t ) pDevices[ index ].thingNameLength );
+    }
+
+    pTopicBuffer = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_DEMO, bufferSize );
+
+    if( pTopicBuffer == NULL )
+    {
+        LogError( ( "Failed to allocate the topics of %u devices.", ( unsigned int ) fleetConfig.deviceCount ) );
+        returnStatus = false;
+    }
+
+    for( index = 0U; ( returnStatus == true ) && ( index < fleetConfig.deviceCount ); index++ )
+    {
+        deviceSize = THING_TOPICS_BUFFER_SIZE( ( size_t ) pDevices[ index ].thingNameLength );
+
+        if( ThingTopics_Init( &( pDevices[ index ].topics ),
+                              pDevices[ index ].thingName,
+                              pDevices[ index ].thingNameLength,
+                              &( pTopicBuffer[ offset ] ),
+                              deviceSize ) != ThingTopicsSuccess )
+        {
+            LogError( ( "Failed to assemble the topics of device %u.", ( unsigned int ) index ) );
+            returnStatus = false;
+        }
+
+        offset += deviceSize;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool shardDevices( void )
+{
+    bool returnStatus = true;
+    FleetDevice_t * pDevice = NULL;
+    uint32_t index = 0U;
+    uint32_t shard = 0U;
+    uint32_t offset = 0U;
+
+    pShards = Allocator_Calloc( ALLOCATOR_SUBSYSTEM_DEMO, fleetConfig.reactorCount, sizeof( FleetShard_t ) );
+    ppShardDevices = Allocator_Calloc( ALLOCATOR_SUBSYSTEM_DEMO, fleetConfig.deviceCount, sizeof( FleetDevice_t * ) );
+
+    if( ( pShards == NULL ) || ( ppShardDevices == NULL ) )
+    {
+        LogError( ( "Failed to allocate the shards of %u devices.", ( unsigned int ) fleetConfig.deviceCount ) );
+        returnStatus = false;
+    }
+    else
+    {
+        /* A device stays in the same shard from one run to the next, so
+         * that its reactor, and the CPU of the reactor, can be found from
+         * its thing name. */
+        for( index = 0U; index < fleetConfig.deviceCount; index++ )
+        {
+            pDevice = &pDevices[ index ];
+            shard = ReactorPool_GetShard( &reactorPool, pDevice->thingName, pDevice->thingNameLength );
+            pDevice->pShard = &pShards[ shard ];
+            pShards[ shard ].deviceCount++;
+        }
+
+        for( shard = 0U; shard < fleetConfig.reactorCount; shard++ )
+        {
+            pShards[ shard ].pEventLoop = ReactorPool_GetEventLoop( &reactorPool, shard );
+            ( void ) pthread_mutex_init( &( pShards[ shard ].totalsMutex ), NULL );
+            LatencyHistogram_Init( &( pShards[ shard ].stats.connectMs ) );
+            LatencyHistogram_Init( &( pShards[ shard ].stats.subscribeMs ) );
+            LatencyHistogram_Init( &( pShards[ shard ].stats.disconnectMs ) );
+            LatencyHistogram_Init( &( pShards[ shard ].stats.reconnectMs ) );
+            pShards[ shard ].ppDevices = &ppShardDevices[ offset ];
+            offset += pShards[ shard ].deviceCount;
+            pShards[ shard ].deviceCount = 0U;
+        }
+
+        for( index = 0U; index < fleetConfig.deviceCount; index++ )
+        {
+            pDevice = &pDevices[ index ];
+            pDevice->pShard->ppDevices[ pDevice->pShard->deviceCount ] = pDevice;
+            pDevice->pShard->deviceCount++;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool createDevice( FleetDevice_t * pDevice )
+{
+    bool returnStatus = true;
+    MqttConnectionConfig_t config;
+    MqttConnectionBuffers_t buffers;
+    int32_t descriptor = -1;
+    uint32_t workload = 0U;
+
+    /* The broker, and the session of the device. Each call to
+     * MqttConnection_Connect makes a single attempt, the fleet scheduling
+     * the retries. */
+    config.pHostName = fleetConfig.pHostName;
+    config.hostNameLength = ( uint16_t ) strlen( fleetConfig.pHostName );
+    config.port = fleetConfig.port;
+    config.pRootCaPath = fleetConfig.pRootCaPath;
+    config.pClientCertPath = fleetConfig.pClientCertPath;
+    config.pPrivateKeyPath = fleetConfig.pPrivateKeyPath;
+    config.pClientIdentifier = pDevice->thingName;
+    config.clientIdentifierLength = pDevice->thingNameLength;
+    config.pUserName = NULL;
+    config.userNameLength = 0U;
+    config.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+    config.transportTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    config.connackTimeoutMs = CONNACK_RECV_TIMEOUT_MS;
+    config.earlyConnect = false;
+    config.earlyDataReplaySafe = false;
+
+    /* Devices are idle between their workloads, so the TLS buffers they do
+     * not use are freed and the records are kept small. */
+    config.releaseIdleBuffers = true;
+    config.maxFragmentLength = TLS_MAX_FRAGMENT_LENGTH;
+
+    /* All the devices connect to the same broker, whose certificate chain
+     * is only verified again once its cache entry expires. */
+    config.ocspMode = OPENSSL_OCSP_REQUEST;
+    config.cacheVerifiedChains = true;
+    config.ackTimeoutMs = ACK_TIMEOUT_MS;
+
+    /* The devices share the link with one another, so their waits follow
+     * the round trip time the load of the fleet gives it. */
+    config.adaptiveTimeouts = true;
+
+    config.retryBaseMs = ( uint16_t ) RECONNECT_BASE_DELAY_MS;
+    config.retryMaxDelayMs = ( uint16_t ) RECONNECT_BASE_DELAY_MS;
+    config.retryMaxAttempts = 1U;
+    config.drainBatchSize = OFFLINE_PUBLISH_QUEUE_LENGTH;
+    config.drainIntervalMs = 0U;
+    config.pStorePath = NULL;
+    config.storeSize = 0U;
+    config.eventCallback = eventCallback;
+    config.payloadBufferCallback = NULL;
+    config.payloadChunkCallback = NULL;
+    config.pUserContext = pDevice;
+
+    /* The memory of the connection, part of the device. */
+    buffers.pNetworkBuffer = pDevice->networkBuffer;
+    buffers.networkBufferSize = NETWORK_BUFFER_SIZE;
+    buffers.pWindowEntries = pDevice->windowEntries;
+    buffers.windowLength = MAX_OUTGOING_PUBLISHES;
+    buffers.pWindowBuckets = pDevice->windowBuckets;
+    buffers.pQueueEntries = pDevice->queueEntries;
+    buffers.queueLength = OFFLINE_PUBLISH_QUEUE_LENGTH;
+    buffers.pQueueSlots = pDevice->queueSlots;
+    buffers.queueSlotSize = OFFLINE_PUBLISH_SLOT_SIZE;
+    buffers.pBatchBuffer = NULL;
+    buffers.batchBufferSize = 0U;
+
+    if( ( MqttConnection_Create( &( pDevice->pConnection ), &config, &buffers ) != MqttConnectionSuccess ) ||
+        ( MqttConnection_GetEventDescriptor( pDevice->pConnection, &descriptor ) != MqttConnectionSuccess ) )
+    {
+        LogError( ( "Failed to create the connection of %s.", pDevice->thingName ) );
+        returnStatus = false;
+    }
+    else
+    {
+        /* The event loop of the connection is readable when its socket is,
+         * and the deadline processes the keep-alive of an idle device. The
+         * reactors are not started yet, so their event loops are set up from
+         * this thread. */
+        pDevice->loopConnection.fileDescriptor = descriptor;
+        pDevice->loopConnection.callback = handleDeviceEvents;
+        pDevice->loopConnection.pUserContext = pDevice;
+
+        if( EventLoop_Add( pDevice->pShard->pEventLoop, &( pDevice->loopConnection ) ) != EVENT_LOOP_SUCCESS )
+        {
+            LogError( ( "Failed to add the connection of %s to the event loop of its shard.", pDevice->thingName ) );
+            returnStatus = false;
+        }
+    }
+
+    for( workload = 0U; workload < ( uint32_t ) FleetWorkloadCount; workload++ )
+    {
+        pDevice->timers[ workload ].timer.callback = handleWorkloadTimer;
+        pDevice->timers[ workload ].timer.pUserContext = &( pDevice->timers[ workload ] );
+        pDevice->timers[ workload ].pDevice = pDevice;
+        pDevice->timers[ workload ].workload = ( FleetWorkload_t ) workload;
+    }
+
+    /* The Defender reports need increasing identifiers across runs. */
+    pDevice->sequence = ( uint32_t ) time( NULL );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool subscribeDevice( FleetDevice_t * pDevice )
+{
+    MQTTSubscribeInfo_t subscriptions[ FleetWorkloadCount ];
+    size_t subscriptionCount = 0U;
+    ThingTopic_t topicFilter = ThingTopicCount;
+    uint32_t workload = 0U;
+
+    /* The responses are published to the topic of the request followed by
+     * accepted or rejected, and also documents and delta for the shadow, so
+     * the topic filters of all the workloads go in a single SUBSCRIBE. */
+    ( void ) memset( subscriptions, 0x00, sizeof( subscriptions ) );
+
+    for( workload = 0U; workload < ( uint32_t ) FleetWorkloadCount; workload++ )
+    {
+        if( fleetConfig.intervalMs[ workload ] > 0U )
+        {
+            topicFilter = workloadTopics[ workload ].responses;
+            subscriptions[ subscriptionCount ].qos = MQTTQoS1;
+            subscriptions[ subscriptionCount ].pTopicFilter = THING_TOPICS_STRING( &( pDevice->topics ), topicFilter );
+            subscriptions[ subscriptionCount ].topicFilterLength = THING_TOPICS_LENGTH( &( pDevice->topics ), topicFilter );
+            subscriptionCount++;
+        }
+    }
+
+    return ( subscriptionCount == 0U ) ||
+           ( MqttConnection_SubscribeList( pDevice->pConnection,
+                                           subscriptions,
+                                           subscriptionCount ) == MqttConnectionSuccess );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool connectDevice( FleetDevice_t * pDevice,
+                           uint32_t * pConnectMs )
+{
+    bool returnStatus = false;
+    MqttConnectionMetrics_t before, after;
+    uint32_t startMs = 0U;
+
+    ( void ) MqttConnection_GetMetrics( pDevice->pConnection, &before );
+    startMs = Clock_GetTimeMs();
+
+    returnStatus = ( MqttConnection_Connect( pDevice->pConnection ) == MqttConnectionSuccess );
+    *pConnectMs = Clock_GetTimeMs() - startMs;
+
+    ( void ) MqttConnection_GetMetrics( pDevice->pConnection, &after );
+
+    /* The broker keeps the subscriptions of a session it resumes. */
+    if( ( returnStatus == true ) && ( after.sessionsStarted != before.sessionsStarted ) )
+    {
+        startMs = Clock_GetTimeMs();
+        returnStatus = subscribeDevice( pDevice );
+        LatencyHistogram_Record( &( pDevice->pShard->stats.subscribeMs ), Clock_GetTimeMs() - startMs );
+    }
+
+    if( returnStatus == true )
+    {
+        pDevice->connected = true;
+        pDevice->reconnectDelayMs = RECONNECT_BASE_DELAY_MS;
+    }
+    else
+    {
+        LogWarn( ( "Failed to connect %s.", pDevice->thingName ) );
+        pDevice->pShard->stats.connectFailures++;
+        disconnectDevice( pDevice );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void disconnectDevice( FleetDevice_t * pDevice )
+{
+    ( void ) MqttConnection_Disconnect( pDevice->pConnection );
+    pDevice->connected = false;
+}
+
+/*-----------------------------------------------------------*/
+
+static void publishWorkload( FleetDevice_t * pDevice,
+                             FleetWorkload_t workload )
+{
+    MQTTPublishInfo_t publishInfo;
+    char * pPayload = pDevice->payloads[ workload ];
+    uint32_t sequence = pDevice->sequence;
+    int length = 0;
+
+    pDevice->sequence++;
+
+    /* The numbers are of a fixed width, so that a publish resent after a
+     * reconnection, whose payload may have been replaced by a later one,
+     * still has a valid length. JSON allows the spaces of the numbers. */
+    switch( workload )
+    {
+        case FleetWorkloadShadow:
+            length = snprintf( pPayload, PAYLOAD_MAX_LENGTH,
+                               "{\"state\":{\"reported\":{\"sequence\":%10u}},\"clientToken\":\"%010u\"}",
+                               ( unsigned int ) sequence, ( unsigned int ) sequence );
+            break;
+
+        case FleetWorkloadDefender:
+            length = snprintf( pPayload, PAYLOAD_MAX_LENGTH,
+                               "{\"header\":{\"report_id\":%10u,\"version\":\"1.0\"},"
+                               "\"metrics\":{\"tcp_connections\":{\"established_connections\":{\"total\":1}}}}",
+                               ( unsigned int ) sequence );
+            break;
+
+        default:
+            length = snprintf( pPayload, PAYLOAD_MAX_LENGTH, "{\"clientToken\":\"%010u\"}",
+                               ( unsigned int ) sequence );
+            break;
+    }
+
+    assert( ( length > 0 ) && ( length < ( int ) PAYLOAD_MAX_LENGTH ) );
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( MQTTPublishInfo_t ) );
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = THING_TOPICS_STRING( &( pDevice->topics ), workloadTopics[ workload ].request );
+    publishInfo.topicNameLength = THING_TOPICS_LENGTH( &( pDevice->topics ), workloadTopics[ workload ].request );
+    publishInfo.pPayload = pPayload;
+    publishInfo.payloadLength = ( size_t ) length;
+
+    /* While the device is disconnected, the publish is queued. */
+    if( MqttConnection_Publish( pDevice->pConnection, &publishInfo ) != MqttConnectionSuccess )
+    {
+        pDevice->pShard->stats.publishFailures++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void handleWorkloadTimer( TimerWheelTimer_t * pTimer )
+{
+    FleetTimer_t * pFleetTimer = ( FleetTimer_t * ) pTimer->pUserContext;
+
+    publishWorkload( pFleetTimer->pDevice, pFleetTimer->workload );
+
+    ( void ) EventLoop_StartTimer( pFleetTimer->pDevice->pShard->pEventLoop,
+                                   pTimer,
+                                   fleetConfig.intervalMs[ pFleetTimer->workload ] );
+}
+
+/*-----------------------------------------------------------*/
+
+static void handleDeviceEvents( EventLoopConnection_t * pLoopConnection,
+                                uint32_t events )
+{
+    FleetDevice_t * pDevice = ( FleetDevice_t * ) pLoopConnection->pUserContext;
+    uint32_t connectMs = 0U;
+    uint32_t delayMs = KEEP_ALIVE_SWEEP_INTERVAL_MS;
+
+    if( pDevice->connected == true )
+    {
+        /* A send that failed, such as that of a publish, marks the
+         * connection as lost too. */
+        if( ( MqttConnection_ProcessLoop( pDevice->pConnection, 0U ) != MqttConnectionSuccess ) ||
+            ( MqttConnection_IsConnected( pDevice->pConnection ) == false ) )
+        {
+            LogWarn( ( "%s lost its connection.", pDevice->thingName ) );
+            pDevice->pShard->stats.connectionLosses++;
+            disconnectDevice( pDevice );
+            pDevice->reconnectDelayMs = RECONNECT_BASE_DELAY_MS;
+            delayMs = pDevice->reconnectDelayMs;
+        }
+    }
+    else if( ( events & EVENT_LOOP_EVENT_DEADLINE ) != 0U )
+    {
+        if( connectDevice( pDevice, &connectMs ) == true )
+        {
+            LatencyHistogram_Record( &( pDevice->pShard->stats.reconnectMs ), connectMs );
+        }
+        else
+        {
+            pDevice->reconnectDelayMs = ( pDevice->reconnectDelayMs >= ( RECONNECT_MAX_DELAY_MS / 2U ) ) ?
+                                        RECONNECT_MAX_DELAY_MS : ( pDevice->reconnectDelayMs * 2U );
+            delayMs = pDevice->reconnectDelayMs;
+        }
+    }
+    else
+    {
+        delayMs = pDevice->reconnectDelayMs;
+    }
+
+    ( void ) EventLoop_SetDeadline( pDevice->pShard->pEventLoop, pLoopConnection, delayMs );
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    const FleetDevice_t * pDevice = ( const FleetDevice_t * ) MqttConnection_GetUserContext( pMqttContext );
+    const MQTTPublishInfo_t * pPublishInfo = pDeserializedInfo->pPublishInfo;
+    FleetResponse_t * pResponse = NULL;
+    char * pCopy = NULL;
+
+    assert( pDevice != NULL );
+
+    /* The PUBACKs are counted by the connection. */
+    if( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+    {
+        /* The publish is in the network buffer of the connection, which the
+         * next packet overwrites, so the workers parse a copy of it. */
+        if( workersRunning == true )
+        {
+            pResponse = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_DEMO,
+                                          sizeof( FleetResponse_t ) + pPublishInfo->topicNameLength +
+                                          pPublishInfo->payloadLength );
+        }
+
+        if( pResponse != NULL )
+        {
+            pCopy = ( char * ) &( pResponse[ 1 ] );
+            ( void ) memcpy( pCopy, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+
+            if( pPublishInfo->payloadLength > 0U )
+            {
+                ( void ) memcpy( &( pCopy[ pPublishInfo->topicNameLength ] ),
+                                 pPublishInfo->pPayload,
+                                 pPublishInfo->payloadLength );
+            }
+
+            pResponse->task.function = handleResponseTask;
+            pResponse->task.pUserContext = pResponse;
+            pResponse->pDevice = pDevice;
+            pResponse->pTopic = pCopy;
+            pResponse->topicLength = pPublishInfo->topicNameLength;
+            pResponse->pPayload = &( pCopy[ pPublishInfo->topicNameLength ] );
+            pResponse->payloadLength = pPublishInfo->payloadLength;
+
+            if( WorkPool_Submit( &workPool, &( pResponse->task ) ) != WorkPoolSuccess )
+            {
+                Allocator_Free( pResponse );
+                pResponse = NULL;
+            }
+        }
+
+        /* Without workers, the response is parsed in place, as it is when
+         * there is no memory for the copy. */
+        if( pResponse == NULL )
+        {
+            parseResponse( pDevice,
+                           pPublishInfo->pTopicName,
+                           pPublishInfo->topicNameLength,
+                           ( const char * ) pPublishInfo->pPayload,
+                           pPublishInfo->payloadLength );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void parseResponse( const FleetDevice_t * pDevice,
+                           const char * pTopic,
+                           uint16_t topicLength,
+                           const char * pPayload,
+                           size_t payloadLength )
+{
+    FleetStats_t * pStats = &( pDevice->pShard->stats );
+    ThingTopic_t topic = ThingTopicCount;
+    uint32_t workload = 0U;
+    bool counted = false;
+
+    if( ThingTopics_Find( &( pDevice->topics ), pTopic, topicLength, &topic ) == ThingTopicsSuccess )
+    {
+        for( workload = 0U; ( workload < ( uint32_t ) FleetWorkloadCount ) && ( counted == false ); workload++ )
+        {
+            if( topic == workloadTopics[ workload ].accepted )
+            {
+                ( void ) __atomic_add_fetch( &( pStats->accepted[ workload ] ), 1U, __ATOMIC_RELAXED );
+                counted = true;
+            }
+            else if( topic == workloadTopics[ workload ].rejected )
+            {
+                ( void ) __atomic_add_fetch( &( pStats->rejected[ workload ] ), 1U, __ATOMIC_RELAXED );
+                counted = true;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+    }
+
+    if( counted == false )
+    {
+        ( void ) __atomic_add_fetch( &( pStats->otherReceived ), 1U, __ATOMIC_RELAXED );
+    }
+
+    /* The responses of AWS IoT, like the shadow documents, are JSON. */
+    if( JSON_Validate( pPayload, payloadLength ) != JSONSuccess )
+    {
+        ( void ) __atomic_add_fetch( &( pStats->malformed ), 1U, __ATOMIC_RELAXED );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void handleResponseTask( WorkPoolTask_t * pTask )
+{
+    FleetResponse_t * pResponse = ( FleetResponse_t * ) pTask->pUserContext;
+
+    parseResponse( pResponse->pDevice,
+                   pResponse->pTopic,
+                   pResponse->topicLength,
+                   pResponse->pPayload,
+                   pResponse->payloadLength );
+    Allocator_Free( pResponse );
+}
+
+/*-----------------------------------------------------------*/
+
+static void sumTotals( const FleetShard_t * pShard,
+                       FleetTotals_t * pTotals )
+{
+    MqttConnectionMetrics_t metrics;
+    OpensslBufferUsage_t usage;
+    const FleetDevice_t * pDevice = NULL;
+    uint32_t index = 0U;
+    uint32_t workload = 0U;
+
+    ( void ) memset( pTotals, 0x00, sizeof( FleetTotals_t ) );
+
+    for( index = 0U; index < pShard->deviceCount; index++ )
+    {
+        pDevice = pShard->ppDevices[ index ];
+
+        if( MqttConnection_GetMetrics( pDevice->pConnection, &metrics ) == MqttConnectionSuccess )
+        {
+            pTotals->publishesSent += metrics.publishesSent;
+            pTotals->pubacksReceived += metrics.pubacksReceived;
+            pTotals->publishesQueued += metrics.publishesQueued;
+            pTotals->sessionsResumed += metrics.sessionsResumed;
+        }
+
+        if( pDevice->connected == true )
+        {
+            pTotals->connectedCount++;
+        }
+
+        if( MqttConnection_GetBufferUsage( pDevice->pConnection, &usage ) == MqttConnectionSuccess )
+        {
+            pTotals->tlsBufferBytes += usage.readBufferBytes + usage.writeBufferBytes +
+                                       usage.transportBufferBytes;
+        }
+    }
+
+    for( workload = 0U; workload < ( uint32_t ) FleetWorkloadCount; workload++ )
+    {
+        pTotals->accepted += __atomic_load_n( &( pShard->stats.accepted[ workload ] ), __ATOMIC_RELAXED );
+        pTotals->rejected += __atomic_load_n( &( pShard->stats.rejected[ workload ] ), __ATOMIC_RELAXED );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void addTotals( FleetTotals_t * pSum,
+                       const FleetTotals_t * pTotals )
+{
+    pSum->publishesSent += pTotals->publishesSent;
+    pSum->pubacksReceived += pTotals->pubacksReceived;
+    pSum->publishesQueued += pTotals->publishesQueued;
+    pSum->sessionsResumed += pTotals->sessionsResumed;
+    pSum->accepted += pTotals->accepted;
+    pSum->rejected += pTotals->rejected;
+    pSum->tlsBufferBytes += pTotals->tlsBufferBytes;
+    pSum->connectedCount += pTotals->connectedCount;
+}
+
+/*-----------------------------------------------------------*/
+
+static void handleTotalsTimer( TimerWheelTimer_t * pTimer )
+{
+    FleetShard_t * pShard = ( FleetShard_t * ) pTimer->pUserContext;
+    FleetTotals_t totals;
+
+    /* The connections are only read from the reactor of the shard, and the
+     * main thread only reads the copy. */
+    sumTotals( pShard, &totals );
+
+    ( void ) pthread_mutex_lock( &( pShard->totalsMutex ) );
+    pShard->totals = totals;
+    ( void ) pthread_mutex_unlock( &( pShard->totalsMutex ) );
+
+    ( void ) EventLoop_StartTimer( pShard->pEventLoop, pTimer, REPORT_INTERVAL_MS );
+}
+
+/*-----------------------------------------------------------*/
+
+static void printReport( void )
+{
+    FleetTotals_t totals;
+    uint32_t nowMs = Clock_GetTimeMs();
+    double elapsedSec = ( double ) ( nowMs - lastReportTimeMs ) / 1000.0;
+    uint32_t shard = 0U;
+
+    ( void ) memset( &totals, 0x00, sizeof( FleetTotals_t ) );
+
+    for( shard = 0U; shard < fleetConfig.reactorCount; shard++ )
+    {
+        ( void ) pthread_mutex_lock( &( pShards[ shard ].totalsMutex ) );
+        addTotals( &totals, &( pShards[ shard ].totals ) );
+        ( void ) pthread_mutex_unlock( &( pShards[ shard ].totalsMutex ) );
+    }
+
+    if( elapsedSec > 0.0 )
+    {
+        printf( "%6.1f s %5u/%u connected %9.1f pub/s %9.1f puback/s %9.1f accepted/s %7.1f rejected/s %7.1f queued/s %9.1f KB tls\n",
+                ( double ) ( nowMs - startTimeMs ) / 1000.0,
+                ( unsigned int ) totals.connectedCount,
+                ( unsigned int ) fleetConfig.deviceCount,
+                ( double ) ( totals.publishesSent - lastTotals.publishesSent ) / elapsedSec,
+                ( double ) ( totals.pubacksReceived - lastTotals.pubacksReceived ) / elapsedSec,
+                ( double ) ( totals.accepted - lastTotals.accepted ) / elapsedSec,
+                ( double ) ( totals.rejected - lastTotals.rejected ) / elapsedSec,
+                ( double ) ( totals.publishesQueued - lastTotals.publishesQueued ) / elapsedSec,
+                ( double ) totals.tlsBufferBytes / 1024.0 );
+        ( void ) fflush( stdout );
+    }
+
+    lastTotals = totals;
+    lastReportTimeMs = nowMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void handleChurnTimer( TimerWheelTimer_t * pTimer )
+{
+    FleetShard_t * pShard = ( FleetShard_t * ) pTimer->pUserContext;
+    FleetDevice_t * pDevice = NULL;
+    uint32_t visited = 0U;
+    uint32_t startMs = 0U;
+    uint32_t connectMs = 0U;
+
+    /* The devices reconnecting after a lost connection are skipped. */
+    while( ( pDevice == NULL ) && ( visited < pShard->deviceCount ) )
+    {
+        if( pShard->ppDevices[ pShard->churnCursor ]->connected == true )
+        {
+            pDevice = pShard->ppDevices[ pShard->churnCursor ];
+        }
+
+        pShard->churnCursor = ( pShard->churnCursor + 1U ) % pShard->deviceCount;
+        visited++;
+    }
+
+    if( pDevice != NULL )
+    {
+        startMs = Clock_GetTimeMs();
+        disconnectDevice( pDevice );
+        LatencyHistogram_Record( &( pShard->stats.disconnectMs ), Clock_GetTimeMs() - startMs );
+        pShard->stats.churns++;
+
+        if( connectDevice( pDevice, &connectMs ) == true )
+        {
+            LatencyHistogram_Record( &( pShard->stats.reconnectMs ), connectMs );
+            ( void ) EventLoop_SetDeadline( pShard->pEventLoop, &( pDevice->loopConnection ), KEEP_ALIVE_SWEEP_INTERVAL_MS );
+        }
+        else
+        {
+            ( void ) EventLoop_SetDeadline( pShard->pEventLoop, &( pDevice->loopConnection ), pDevice->reconnectDelayMs );
+        }
+    }
+
+    /* Each shard reconnects a device in turn, so that the fleet still
+     * reconnects one every --churn milliseconds. */
+    ( void ) EventLoop_StartTimer( pShard->pEventLoop, pTimer, fleetConfig.churnIntervalMs * fleetConfig.reactorCount );
+}
+
+/*-----------------------------------------------------------*/
+
+static void sumStats( void )
+{
+    const FleetStats_t * pStats = NULL;
+    uint32_t shard = 0U;
+    uint32_t workload = 0U;
+
+    /* The first connections are recorded in the counters of the fleet
+     * directly, before the reactors start. */
+    for( shard = 0U; shard < fleetConfig.reactorCount; shard++ )
+    {
+        pStats = &( pShards[ shard ].stats );
+
+        for( workload = 0U; workload < ( uint32_t ) FleetWorkloadCount; workload++ )
+        {
+            fleetStats.accepted[ workload ] += pStats->accepted[ workload ];
+            fleetStats.rejected[ workload ] += pStats->rejected[ workload ];
+        }
+
+        fleetStats.otherReceived += pStats->otherReceived;
+        fleetStats.malformed += pStats->malformed;
+        fleetStats.publishFailures += pStats->publishFailures;
+        fleetStats.connectionLosses += pStats->connectionLosses;
+        fleetStats.connectFailures += pStats->connectFailures;
+        fleetStats.churns += pStats->churns;
+        LatencyHistogram_Add( &( fleetStats.subscribeMs ), &( pStats->subscribeMs ) );
+        LatencyHistogram_Add( &( fleetStats.disconnectMs ), &( pStats->disconnectMs ) );
+        LatencyHistogram_Add( &( fleetStats.reconnectMs ), &( pStats->reconnectMs ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void printTimes( const char * pName,
+                        const LatencyHistogram_t * pHistogram )
+{
+    if( pHistogram->count > 0U )
+    {
+        printf( "%-12s (ms): %" PRIu64 " times, min %u, p50 %u, p90 %u, p99 %u, max %u, mean %.1f.\n",
+                pName,
+                pHistogram->count,
+                ( unsigned int ) pHistogram->min,
+                ( unsigned int ) LatencyHistogram_Percentile( pHistogram, 50.0 ),
+                ( unsigned int ) LatencyHistogram_Percentile( pHistogram, 90.0 ),
+                ( unsigned int ) LatencyHistogram_Percentile( pHistogram, 99.0 ),
+                ( unsigned int ) pHistogram->max,
+                ( double ) pHistogram->sum / ( double ) pHistogram->count );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void printMemory( const char * pPhase )
+{
+    AllocatorStats_t stats;
+    uint32_t subsystem = 0U;
+
+    Allocator_GetTotalStats( &stats );
+
+    printf( "Memory %s: %" PRIu64 " bytes in use, %" PRIu64 " at the peak, %" PRIu64 " per device.\n",
+            pPhase,
+            stats.currentBytes,
+            stats.peakBytes,
+            stats.peakBytes / fleetConfig.deviceCount );
+
+    for( subsystem = 0U; subsystem < ( uint32_t ) ALLOCATOR_SUBSYSTEM_COUNT; subsystem++ )
+    {
+        Allocator_GetStats( ( AllocatorSubsystem_t ) subsystem, &stats );
+
+        if( stats.allocations > 0U )
+        {
+            printf( "  %-9s %" PRIu64 " bytes in %" PRIu64 " blocks, %" PRIu64 " at the peak, %" PRIu64 " failed allocations.\n",
+                    Allocator_SubsystemName( ( AllocatorSubsystem_t ) subsystem ),
+                    stats.currentBytes,
+                    stats.blocks,
+                    stats.peakBytes,
+                    stats.failures );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int64_t readMemoryBytes( void * pContext )
+{
+    AllocatorStats_t stats;
+
+    ( void ) pContext;
+    Allocator_GetTotalStats( &stats );
+
+    return ( int64_t ) stats.currentBytes;
+}
+
+/*-----------------------------------------------------------*/
+
+static int64_t readMemoryPeakBytes( void * pContext )
+{
+    AllocatorStats_t stats;
+
+    ( void ) pContext;
+    Allocator_GetTotalStats( &stats );
+
+    return ( int64_t ) stats.peakBytes;
+}
+
+/*-----------------------------------------------------------*/
+
+static void printSummary( uint32_t elapsedMs )
+{
+    FleetTotals_t totals;
+    FleetTotals_t shardTotals;
+    WorkPoolStats_t workStats;
+    double elapsedSec = ( double ) elapsedMs / 1000.0;
+    uint32_t workload = 0U;
+    uint32_t shard = 0U;
+
+    ( void ) memset( &totals, 0x00, sizeof( FleetTotals_t ) );
+
+    for( shard = 0U; shard < fleetConfig.reactorCount; shard++ )
+    {
+        sumTotals( &( pShards[ shard ] ), &shardTotals );
+        addTotals( &totals, &shardTotals );
+    }
+
+    printf( "\nBroker %s:%u, %u devices on %u reactors for %.1f s.\n",
+            fleetConfig.pHostName,
+            ( unsigned int ) fleetConfig.port,
+            ( unsigned int ) fleetConfig.deviceCount,
+            ( unsigned int ) fleetConfig.reactorCount,
+            elapsedSec );
+    printf( "Publishes: %" PRIu64 " sent, %.1f/s, %" PRIu64 " PUBACKs, %" PRIu64 " queued while disconnected, %" PRIu64 " failed.\n",
+            totals.publishesSent,
+            ( double ) totals.publishesSent / elapsedSec,
+            totals.pubacksReceived,
+            totals.publishesQueued,
+            fleetStats.publishFailures );
+
+    for( workload = 0U; workload < ( uint32_t ) FleetWorkloadCount; workload++ )
+    {
+        if( fleetConfig.intervalMs[ workload ] > 0U )
+        {
+            printf( "%-9s every %u ms: %" PRIu64 " accepted, %" PRIu64 " rejected.\n",
+                    workloadNames[ workload ],
+                    ( unsigned int ) fleetConfig.intervalMs[ workload ],
+                    fleetStats.accepted[ workload ],
+                    fleetStats.rejected[ workload ] );
+        }
+    }
+
+    printf( "Other publishes received: %" PRIu64 ". Payloads not valid JSON: %" PRIu64 ".\n",
+            fleetStats.otherReceived,
+            fleetStats.malformed );
+
+    if( ( fleetConfig.workerCount > 0U ) && ( WorkPool_GetStats( &workPool, &workStats ) == WorkPoolSuccess ) )
+    {
+        printf( "Responses parsed by %u workers: %" PRIu64 ", %" PRIu64 " of them stolen.\n",
+                ( unsigned int ) fleetConfig.workerCount,
+                workStats.executedCount,
+                workStats.stolenCount );
+    }
+
+    printf( "Connections: %" PRIu64 " lost, %" PRIu64 " churned, %" PRIu64 " failed attempts, %" PRIu64 " sessions resumed.\n",
+            fleetStats.connectionLosses,
+            fleetStats.churns,
+            fleetStats.connectFailures,
+            totals.sessionsResumed );
+    printTimes( "Connect", &( fleetStats.connectMs ) );
+    printTimes( "Subscribe", &( fleetStats.subscribeMs ) );
+    printTimes( "Disconnect", &( fleetStats.disconnectMs ) );
+    printTimes( "Reconnect", &( fleetStats.reconnectMs ) );
+    printMemory( "at the end" );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char * argv[] )
+{
+    int returnStatus = EXIT_SUCCESS;
+    FleetDevice_t * pDevice = NULL;
+    FleetShard_t * pShard = NULL;
+    uint32_t index = 0U;
+    uint32_t shard = 0U;
+    uint32_t workload = 0U;
+    uint32_t connectMs = 0U;
+    uint32_t endTimeMs = 0U;
+    uint32_t nowMs = 0U;
+    uint32_t createdCount = 0U;
+    bool poolCreated = false;
+    bool shardsCreated = false;
+    bool reactorsStarted = false;
+    MetricsId_t memoryGaugeId = METRICS_INVALID_ID;
+    MetricsId_t memoryPeakGaugeId = METRICS_INVALID_ID;
+
+    if( parseArgs( &fleetConfig, argc, argv ) == false )
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        /* A connection closed by the broker fails the send instead of
+         * ending the fleet. */
+        ( void ) signal( SIGPIPE, SIG_IGN );
+        raiseDescriptorLimit();
+
+        /* OpenSSL only takes the allocator before its first allocation. */
+        if( Openssl_UseAllocator() != OPENSSL_SUCCESS )
+        {
+            LogWarn( ( "The memory of OpenSSL is not counted." ) );
+        }
+
+        LatencyHistogram_Init( &( fleetStats.connectMs ) );
+        LatencyHistogram_Init( &( fleetStats.subscribeMs ) );
+        LatencyHistogram_Init( &( fleetStats.disconnectMs ) );
+        LatencyHistogram_Init( &( fleetStats.reconnectMs ) );
+
+        /* The counters of the connections are totalled in the metrics
+         * registry, from where they can be scraped during the run. */
+        if( fleetConfig.metricsPort > 0U )
+        {
+            ( void ) Metrics_RegisterGaugeCallback( "fleet_memory_bytes", "Bytes allocated by the fleet, headers included.",
+                                                    readMemoryBytes, NULL, &memoryGaugeId );
+            ( void ) Metrics_RegisterGaugeCallback( "fleet_memory_peak_bytes", "Peak of the bytes allocated by the fleet.",
+                                                    readMemoryPeakBytes, NULL, &memoryPeakGaugeId );
+        }
+
+        if( ( fleetConfig.metricsPort > 0U ) &&
+            ( Metrics_StartPrometheusServer( fleetConfig.metricsPort ) != MetricsSuccess ) )
+        {
+            LogWarn( ( "Failed to serve the metrics on port %u.", ( unsigned int ) fleetConfig.metricsPort ) );
+        }
+
+        pDevices = Allocator_Calloc( ALLOCATOR_SUBSYSTEM_DEMO, fleetConfig.deviceCount, sizeof( FleetDevice_t ) );
+
+        if( pDevices == NULL )
+        {
+            LogError( ( "Failed to allocate %u devices.", ( unsigned int ) fleetConfig.deviceCount ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else if( ReactorPool_Init( &reactorPool, fleetConfig.reactorCount ) != REACTOR_POOL_SUCCESS )
+        {
+            LogError( ( "Failed to create the reactors of the fleet." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            poolCreated = true;
+        }
+    }
+
+    /* The devices are named before they are sharded, by their names. */
+    for( index = 0U; ( returnStatus == EXIT_SUCCESS ) && ( index < fleetConfig.deviceCount ); index++ )
+    {
+        if( nameDevice( &pDevices[ index ], index ) == false )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    if( ( returnStatus == EXIT_SUCCESS ) && ( assembleTopics() == false ) )
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        if( shardDevices() == true )
+        {
+            shardsCreated = true;
+        }
+        else
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    if( ( returnStatus == EXIT_SUCCESS ) && ( fleetConfig.workerCount > 0U ) )
+    {
+        if( WorkPool_Start( &workPool, fleetConfig.workerCount, WORKER_THREAD_GROUP ) == WorkPoolSuccess )
+        {
+            workersRunning = true;
+        }
+        else
+        {
+            LogError( ( "Failed to start %u workers.", ( unsigned int ) fleetConfig.workerCount ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    for( index = 0U; ( returnStatus == EXIT_SUCCESS ) && ( index < fleetConfig.deviceCount ); index++ )
+    {
+        pDevice = &pDevices[ index ];
+
+        if( createDevice( pDevice ) == false )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+
+        if( pDevice->pConnection != NULL )
+        {
+            createdCount++;
+        }
+    }
+
+    /* The devices connect one after the other before the simulation, so that
+     * the times of the first connections are measured alone. */
+    for( index = 0U; ( returnStatus == EXIT_SUCCESS ) && ( index < fleetConfig.deviceCount ); index++ )
+    {
+        pDevice = &pDevices[ index ];
+
+        if( connectDevice( pDevice, &connectMs ) == false )
+        {
+            LogError( ( "Failed to connect device %u of the fleet.", ( unsigned int ) index ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            LatencyHistogram_Record( &( fleetStats.connectMs ), connectMs );
+            ( void ) EventLoop_SetDeadline( pDevice->pShard->pEventLoop, &( pDevice->loopConnection ), KEEP_ALIVE_SWEEP_INTERVAL_MS );
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        printf( "%u devices connected, simulating for %u s on %u reactors.\n",
+                ( unsigned int ) fleetConfig.deviceCount,
+                ( unsigned int ) fleetConfig.durationSec,
+                ( unsigned int ) fleetConfig.reactorCount );
+        printTimes( "Connect", &( fleetStats.connectMs ) );
+        printMemory( "after connecting" );
+
+        /* The first publishes of the devices are spread over the interval of
+         * the workload, so that the fleet publishes at an even rate. */
+        for( index = 0U; index < fleetConfig.deviceCount; index++ )
+        {
+            for( workload = 0U; workload < ( uint32_t ) FleetWorkloadCount; workload++ )
+            {
+                if( fleetConfig.intervalMs[ workload ] > 0U )
+                {
+                    ( void ) EventLoop_StartTimer( pDevices[ index ].pShard->pEventLoop,
+                                                   &( pDevices[ index ].timers[ workload ].timer ),
+                                                   1U + ( uint32_t ) ( ( ( uint64_t ) fleetConfig.intervalMs[ workload ] * index ) /
+                                                                       fleetConfig.deviceCount ) );
+                }
+            }
+        }
+
+        /* The shards take their first totals here, and then every report
+         * interval on their reactors. Their churns are staggered, so that
+         * the fleet reconnects a device every --churn milliseconds. */
+        for( shard = 0U; shard < fleetConfig.reactorCount; shard++ )
+        {
+            pShard = &pShards[ shard ];
+            sumTotals( pShard, &( pShard->totals ) );
+            addTotals( &lastTotals, &( pShard->totals ) );
+
+            pShard->totalsTimer.callback = handleTotalsTimer;
+            pShard->totalsTimer.pUserContext = pShard;
+            ( void ) EventLoop_StartTimer( pShard->pEventLoop, &( pShard->totalsTimer ), REPORT_INTERVAL_MS );
+
+            if( fleetConfig.churnIntervalMs > 0U )
+            {
+                pShard->churnTimer.callback = handleChurnTimer;
+                pShard->churnTimer.pUserContext = pShard;
+                ( void ) EventLoop_StartTimer( pShard->pEventLoop,
+                                               &( pShard->churnTimer ),
+                                               fleetConfig.churnIntervalMs * ( shard + 1U ) );
+            }
+        }
+
+        startTimeMs = Clock_GetTimeMs();
+        lastReportTimeMs = startTimeMs;
+        endTimeMs = startTimeMs + ( fleetConfig.durationSec * 1000U );
+        nowMs = startTimeMs;
+
+        if( ReactorPool_Start( &reactorPool, REACTOR_THREAD_GROUP ) == REACTOR_POOL_SUCCESS )
+        {
+            reactorsStarted = true;
+        }
+        else
+        {
+            LogError( ( "Failed to start the reactors of the fleet." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+
+        /* The main thread only reports, from the totals of the shards. */
+        while( ( returnStatus == EXIT_SUCCESS ) && ( ( int32_t ) ( endTimeMs - nowMs ) > 0 ) )
+        {
+            Clock_SleepMs( ( ( endTimeMs - nowMs ) < REPORT_INTERVAL_MS ) ? ( endTimeMs - nowMs ) : REPORT_INTERVAL_MS );
+            printReport();
+            nowMs = Clock_GetTimeMs();
+        }
+    }
+
+    /* The devices are used from this thread again once the reactors are
+     * stopped, and their responses are parsed in place once the workers
+     * are. */
+    if( reactorsStarted == true )
+    {
+        ReactorPool_Stop( &reactorPool );
+    }
+
+    if( workersRunning == true )
+    {
+        WorkPool_Stop( &workPool );
+        workersRunning = false;
+    }
+
+    if( reactorsStarted == true )
+    {
+        sumStats();
+        printSummary( nowMs - startTimeMs );
+    }
+
+    for( index = 0U; index < createdCount; index++ )
+    {
+        pDevice = &pDevices[ index ];
+
+        if( pDevice->connected == true )
+        {
+            disconnectDevice( pDevice );
+        }
+
+        ( void ) EventLoop_Remove( pDevice->pShard->pEventLoop, &( pDevice->loopConnection ) );
+        MqttConnection_Destroy( pDevice->pConnection );
+    }
+
+    if( poolCreated == true )
+    {
+        ReactorPool_Deinit( &reactorPool );
+    }
+
+    if( shardsCreated == true )
+    {
+        for( shard = 0U; shard < fleetConfig.reactorCount; shard++ )
+        {
+            ( void ) pthread_mutex_destroy( &( pShards[ shard ].totalsMutex ) );
+        }
+    }
+
+    Allocator_Free( pShards );
+    Allocator_Free( ppShardDevices );
+    Allocator_Free( pTopicBuffer );
+    Allocator_Free( pDevices );
+    Metrics_StopPrometheusServer();
+
+    return returnStatus;
+}
@@ -0,0 +1,234 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_batch_download.h
+ * @brief The API to download a batch of objects from their URLs, over
+ * keep-alive connections shared by the objects of the same server.
+ */
+
+#ifndef HTTP_BATCH_DOWNLOAD_H_
+#define HTTP_BATCH_DOWNLOAD_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Batch Download module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Batch Download"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/**
+ * @brief Largest number of objects in a batch.
+ */
+#ifndef HTTP_BATCH_DOWNLOAD_MAX_OBJECTS
+    #define HTTP_BATCH_DOWNLOAD_MAX_OBJECTS    ( 64U )
+#endif
+
+/**
+ * @brief Number of threads downloading, each over its own connection.
+ *
+ * @note It should not exceed CONNECTION_POOL_SIZE, as each thread checks out
+ * a connection of the pool.
+ */
+#ifndef HTTP_BATCH_DOWNLOAD_THREAD_COUNT
+    #define HTTP_BATCH_DOWNLOAD_THREAD_COUNT    ( 4U )
+#endif
+
+/**
+ * @brief Largest number of connections downloading the objects of the same
+ * server at once.
+ *
+ * The objects of a server are split into this many runs of consecutive
+ * objects at most, each downloaded over one connection. A run holds at least
+ * #HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH objects, so that a few small objects do
+ * not each pay for a connection.
+ */
+#ifndef HTTP_BATCH_DOWNLOAD_CONNECTIONS_PER_HOST
+    #define HTTP_BATCH_DOWNLOAD_CONNECTIONS_PER_HOST    ( 2U )
+#endif
+
+/**
+ * @brief Most requests sent over a connection before their responses are
+ * received.
+ *
+ * The first request of a connection is sent alone, and the next ones are
+ * pipelined only once its response shows that the server keeps the
+ * connection alive. 1 sends each request after the previous response.
+ */
+#ifndef HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH
+    #define HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH    ( 4U )
+#endif
+
+/**
+ * @brief Length of the buffers of each thread: one holds a request, and the
+ * other the headers of a response.
+ *
+ * @note The request buffer must hold the path and query of the longest URL,
+ * which for a pre-signed URL is over 1000 bytes.
+ */
+#ifndef HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH
+    #define HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Send and receive timeout of the connections.
+ */
+#ifndef HTTP_BATCH_DOWNLOAD_TIMEOUT_MS
+    #define HTTP_BATCH_DOWNLOAD_TIMEOUT_MS    ( 5000U )
+#endif
+
+/**
+ * @brief Number of connections over which a run of objects is attempted
+ * without any object being received, before its remaining objects fail.
+ */
+#ifndef HTTP_BATCH_DOWNLOAD_MAX_ATTEMPTS
+    #define HTTP_BATCH_DOWNLOAD_MAX_ATTEMPTS    ( 3U )
+#endif
+
+/* Enumeration type for return status value from Batch Download API. */
+typedef enum HttpBatchDownloadStatus
+{
+    /**
+     * @brief Success return value from Batch Download API, when every object
+     * was downloaded.
+     */
+    HTTP_BATCH_DOWNLOAD_SUCCESS = 0,
+
+    /**
+     * @brief Failure return value due to a NULL parameter, or more than
+     * #HTTP_BATCH_DOWNLOAD_MAX_OBJECTS objects.
+     */
+    HTTP_BATCH_DOWNLOAD_INVALID_PARAMETER,
+
+    /**
+     * @brief Failure return value due to a thread creation failing.
+     */
+    HTTP_BATCH_DOWNLOAD_NO_MEMORY,
+
+    /**
+     * @brief Failure return value due to some objects not being downloaded,
+     * whose #HttpBatchObject_t.status tells why.
+     */
+    HTTP_BATCH_DOWNLOAD_PARTIAL
+} HttpBatchDownloadStatus_t;
+
+/**
+ * @brief An object of a batch: where to download it from and to, then the
+ * result of its download.
+ */
+typedef struct HttpBatchObject
+{
+    const char * pUrl;      /**< @brief HTTPS URL of the object. */
+    size_t urlLength;       /**< @brief Length of #HttpBatchObject_t.pUrl. */
+    const char * pFilePath; /**< @brief Path of the file written with the object. */
+
+    bool downloaded;        /**< @brief Whether the object was received with a 2xx status code and written entirely. */
+    HTTPStatus_t status;    /**< @brief #HTTPSuccess if the response was received, otherwise why it was not. */
+    uint16_t statusCode;    /**< @brief Status code of the response, or 0 if none was received. */
+    uint64_t bodyLength;    /**< @brief Bytes of the object written. */
+    uint32_t latencyMs;     /**< @brief Time from sending the request to receiving the end of the response. */
+} HttpBatchObject_t;
+
+/**
+ * @brief Aggregate results of a batch.
+ */
+typedef struct HttpBatchDownloadStats
+{
+    size_t downloadedCount;  /**< @brief Objects downloaded. */
+    size_t failedCount;      /**< @brief Objects not downloaded. */
+    size_t connectionCount;  /**< @brief Connections checked out from the pool, reused or established. */
+    size_t pipelinedCount;   /**< @brief Requests sent before the response to the previous one was received. */
+    uint64_t totalBytes;     /**< @brief Bytes of all objects written. */
+    uint32_t elapsedMs;      /**< @brief Time taken by the batch. */
+    uint64_t bytesPerSecond; /**< @brief Throughput of the batch, #HttpBatchDownloadStats_t.totalBytes over #HttpBatchDownloadStats_t.elapsedMs. */
+    uint32_t minLatencyMs;   /**< @brief Shortest latency of a downloaded object. */
+    uint32_t meanLatencyMs;  /**< @brief Mean latency of the downloaded objects. */
+    uint32_t maxLatencyMs;   /**< @brief Longest latency of a downloaded object. */
+} HttpBatchDownloadStats_t;
+
+/**
+ * @brief Download a batch of objects, with #HTTP_BATCH_DOWNLOAD_THREAD_COUNT
+ * threads, and wait until all of them are done.
+ *
+ * The objects are grouped by server, and the objects of each server are
+ * downloaded over keep-alive connections of the HTTP demos' connection pool,
+ * so that the connection and the TLS handshake are shared by the objects
+ * instead of paid for each one. Over each connection, up to
+ * #HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH requests are outstanding, so that the
+ * server does not wait a round trip between two small objects. The body of
+ * each response is written to the file of its object as it is received.
+ *
+ * When the server closes a connection, the objects whose pipelined requests
+ * were not answered are requested again over a new connection. The file of
+ * an object that is not downloaded is removed.
+ *
+ * @note Responses must have a Content-Length header, as with
+ * #HttpBodyStream_Get.
+ *
+ * @note This function is not reentrant: one batch runs at a time.
+ *
+ * @param[in,out] pObjects The objects, whose results are written back.
+ * @param[in] objectCount The number of @p pObjects, up to
+ * #HTTP_BATCH_DOWNLOAD_MAX_OBJECTS.
+ * @param[in] pRootCaPath Trusted root CA certificates of the servers. The
+ * string must remain valid until #ConnectionPool_CloseAll.
+ * @param[out] pStats The aggregate results of the batch.
+ *
+ * @return Returns one of the following:
+ * - #HTTP_BATCH_DOWNLOAD_SUCCESS if every object was downloaded.
+ * - #HTTP_BATCH_DOWNLOAD_INVALID_PARAMETER if a parameter is NULL or there
+ * are too many objects.
+ * - #HTTP_BATCH_DOWNLOAD_NO_MEMORY if no thread could be created.
+ * - #HTTP_BATCH_DOWNLOAD_PARTIAL if some objects were not downloaded.
+ */
+HttpBatchDownloadStatus_t HttpBatchDownload_Run( HttpBatchObject_t * pObjects,
+                                                 size_t objectCount,
+                                                 const char * pRootCaPath,
+                                                 HttpBatchDownloadStats_t * pStats );
+
+#endif /* ifndef HTTP_BATCH_DOWNLOAD_H_ */
@@ -0,0 +1,136 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_body_inflate.h
+ * @brief A stage between #HttpBodyStream_Get and a body callback that
+ * decompresses a gzip or zlib body as it is received.
+ */
+
+#ifndef HTTP_BODY_INFLATE_H_
+#define HTTP_BODY_INFLATE_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Body Inflate module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Body Inflate"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* zlib include. */
+#include <zlib.h>
+
+/* Include header for the body stream callback. */
+#include "http_body_stream.h"
+
+/**
+ * @brief Size of the buffer receiving the decompressed body, passed to the
+ * body callback each time it is full.
+ */
+#ifndef HTTP_BODY_INFLATE_BUFFER_LENGTH
+    #define HTTP_BODY_INFLATE_BUFFER_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief The state of the decompression of a body.
+ *
+ * @note Besides this context, zlib allocates up to about 44 KB for its
+ * decompression window, whatever the size of the body.
+ */
+typedef struct HttpBodyInflateContext
+{
+    z_stream stream;                                  /**< @brief The zlib decompression stream. */
+    HttpBodyStreamCallback_t callback;                /**< @brief Callback receiving the decompressed body. */
+    void * pCallbackContext;                          /**< @brief Context passed to callback. */
+    uint64_t outputLength;                            /**< @brief Bytes of the decompressed body passed to callback. */
+    bool streamEnded;                                 /**< @brief Whether the end of the compressed stream was reached. */
+    bool failed;                                      /**< @brief Whether the body could not be decompressed, or callback stopped it. */
+    uint8_t output[ HTTP_BODY_INFLATE_BUFFER_LENGTH ]; /**< @brief Buffer receiving the decompressed body. */
+} HttpBodyInflateContext_t;
+
+/**
+ * @brief Initialize the decompression of a body, whose format, gzip or zlib,
+ * is detected from its header.
+ *
+ * @param[out] pInflateContext The context to initialize.
+ * @param[in] callback Callback receiving the decompressed body, with offsets
+ * within the decompressed body.
+ * @param[in] pCallbackContext Context passed to @p callback.
+ *
+ * @return true on success; false if zlib could not be initialized.
+ */
+bool HttpBodyInflate_Init( HttpBodyInflateContext_t * pInflateContext,
+                           HttpBodyStreamCallback_t callback,
+                           void * pCallbackContext );
+
+/**
+ * @brief Decompress a part of a compressed body. This is a
+ * #HttpBodyStreamCallback_t, to pass to #HttpBodyStream_Get with the
+ * #HttpBodyInflateContext_t as its context.
+ *
+ * @param[in] pContext The #HttpBodyInflateContext_t.
+ * @param[in] offset Position of @p pData within the compressed body.
+ * @param[in] pData The next bytes of the compressed body.
+ * @param[in] dataLength The length of @p pData.
+ *
+ * @return true to keep receiving the body; false if the body could not be
+ * decompressed or the callback stopped it.
+ */
+bool HttpBodyInflate_Callback( void * pContext,
+                               uint64_t offset,
+                               const uint8_t * pData,
+                               size_t dataLength );
+
+/**
+ * @brief Release the resources of zlib, and report whether the body was
+ * decompressed entirely.
+ *
+ * @param[in] pInflateContext The context of the decompression.
+ *
+ * @return true if the compressed stream ended and was passed entirely to the
+ * callback; false otherwise.
+ */
+bool HttpBodyInflate_End( HttpBodyInflateContext_t * pInflateContext );
+
+#endif /* ifndef HTTP_BODY_INFLATE_H_ */
@@ -0,0 +1,290 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_body_stream.h
+ * @brief The API to receive the body of an HTTP response in pieces, as it
+ * arrives from the transport, instead of holding it whole in a buffer.
+ */
+
+#ifndef HTTP_BODY_STREAM_H_
+#define HTTP_BODY_STREAM_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Body Stream module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Body Stream"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/* Include header for the request template of #HttpBodyStream_GetRanges. */
+#include "http_request_template.h"
+
+/**
+ * @brief Value of the end of a range to request the object from the start
+ * of the range to its end.
+ */
+#define HTTP_BODY_STREAM_END_OF_OBJECT     ( UINT64_MAX )
+
+/**
+ * @brief Time in milliseconds to keep receiving after the transport returns
+ * zero bytes, before the response is considered incomplete.
+ *
+ * The transports already wait for their receive timeout before returning
+ * zero bytes.
+ */
+#ifndef HTTP_BODY_STREAM_RECV_RETRY_TIMEOUT_MS
+    #define HTTP_BODY_STREAM_RECV_RETRY_TIMEOUT_MS    ( 10U )
+#endif
+
+/**
+ * @brief Time in milliseconds to keep sending after the transport sends zero
+ * bytes, before the request is considered failed.
+ */
+#ifndef HTTP_BODY_STREAM_SEND_RETRY_TIMEOUT_MS
+    #define HTTP_BODY_STREAM_SEND_RETRY_TIMEOUT_MS    ( 10U )
+#endif
+
+/**
+ * @brief Callback receiving the body of a successful response.
+ *
+ * @param[in] pContext The context passed to #HttpBodyStream_Get.
+ * @param[in] offset Position of @p pData within the body, or within the
+ * object for #HttpBodyStream_GetRanges.
+ * @param[in] pData The next bytes of the body, only valid during the call.
+ * @param[in] dataLength The length of @p pData.
+ *
+ * @return true to keep receiving the body; false to stop.
+ */
+typedef bool ( * HttpBodyStreamCallback_t )( void * pContext,
+                                             uint64_t offset,
+                                             const uint8_t * pData,
+                                             size_t dataLength );
+
+/**
+ * @brief The response to a request sent with #HttpBodyStream_Get.
+ */
+typedef struct HttpBodyStreamResponse
+{
+    uint16_t statusCode;    /**< @brief Status code of the response. */
+    uint64_t contentLength; /**< @brief Value of the Content-Length header of the response. */
+    uint64_t bodyLength;    /**< @brief Bytes of the body passed to the callback. */
+    uint64_t rangeStart;    /**< @brief First position of the Content-Range header of the response, or 0. */
+    uint64_t objectLength;  /**< @brief Complete length of the Content-Range header of the response, or 0 if unknown. */
+
+    /**
+     * @brief Whether the connection cannot be reused for another request,
+     * because the server sent "Connection: close" or the body was not
+     * received entirely.
+     */
+    bool connectionClose;
+} HttpBodyStreamResponse_t;
+
+/**
+ * @brief Send a GET request for a range of an object, and pass the body of
+ * the response to a callback as it is received.
+ *
+ * The request headers are written by the HTTP Client library into
+ * @p pBuffer, which then receives the response. Only the status line and
+ * headers of the response must fit in @p pBuffer; the body may be of any
+ * length, so a small buffer can download an object of any size with a single
+ * request.
+ *
+ * The body is passed to @p bodyCallback only for 2xx status codes. The body
+ * of other responses is received and discarded, so that the connection can be
+ * reused.
+ *
+ * @note Responses must have a Content-Length header. Chunked transfer
+ * encoding is not supported.
+ *
+ * @param[in] pTransportInterface The transport interface to send the request
+ * and receive the response over.
+ * @param[in] pRequestInfo The request line and host of the request. The
+ * method must be GET.
+ * @param[in] rangeStart Position of the first byte requested.
+ * @param[in] rangeEnd Position of the last byte requested, inclusive, or
+ * #HTTP_BODY_STREAM_END_OF_OBJECT for the rest of the object. The request has
+ * no Range header when @p rangeStart is 0 and @p rangeEnd is
+ * #HTTP_BODY_STREAM_END_OF_OBJECT.
+ * @param[in] pBuffer Buffer for the request and the response headers.
+ * @param[in] bufferLen Length of @p pBuffer.
+ * @param[in] bodyCallback Callback receiving the body of the response.
+ * @param[in] pContext Context passed to @p bodyCallback.
+ * @param[out] pResponse The response received.
+ *
+ * @return Returns one of the following:
+ * - #HTTPSuccess if the response was received entirely.
+ * - #HTTPInvalidParameter if a parameter is NULL.
+ * - #HTTPInsufficientMemory if the request or response headers do not fit in
+ * @p pBuffer.
+ * - #HTTPNetworkError if the transport failed.
+ * - #HTTPNoResponse if the server sent nothing before the timeout.
+ * - #HTTPPartialResponse if the response was incomplete before the timeout,
+ * or @p bodyCallback stopped the body.
+ * - #HTTPInvalidResponse if the response could not be parsed or has no
+ * Content-Length.
+ */
+HTTPStatus_t HttpBodyStream_Get( const TransportInterface_t * pTransportInterface,
+                                 const HTTPRequestInfo_t * pRequestInfo,
+                                 uint64_t rangeStart,
+                                 uint64_t rangeEnd,
+                                 uint8_t * pBuffer,
+                                 size_t bufferLen,
+                                 HttpBodyStreamCallback_t bodyCallback,
+                                 void * pContext,
+                                 HttpBodyStreamResponse_t * pResponse );
+
+/**
+ * @brief Send request headers serialized by the caller, such as the headers
+ * of one of several requests pipelined over a connection.
+ *
+ * @param[in] pTransportInterface The transport interface to send over.
+ * @param[in] pRequestHeaders The request headers, as written by
+ * #HTTPClient_InitializeRequestHeaders.
+ *
+ * @return #HTTPSuccess if all bytes were sent; #HTTPInvalidParameter if a
+ * parameter is NULL; #HTTPNetworkError otherwise.
+ */
+HTTPStatus_t HttpBodyStream_Send( const TransportInterface_t * pTransportInterface,
+                                  const HTTPRequestHeaders_t * pRequestHeaders );
+
+/**
+ * @brief Receive the next response on a connection, and pass its body to a
+ * callback as it is received.
+ *
+ * The requests are sent with #HttpBodyStream_Send, possibly several before
+ * their responses are received, and the responses arrive in the order of the
+ * requests. Bytes of the next response received with the end of a body are
+ * kept at the start of @p pBuffer, and their length in @p pBufferedLength,
+ * for the next call.
+ *
+ * The body is passed to @p bodyCallback only for 2xx status codes. The body
+ * of other responses is received and discarded.
+ *
+ * @param[in] pTransportInterface The transport interface to receive over.
+ * @param[in] pBuffer Buffer receiving the response. Only the status line and
+ * headers must fit in it.
+ * @param[in] bufferLen Length of @p pBuffer.
+ * @param[in,out] pBufferedLength Bytes at the start of @p pBuffer received
+ * with the previous response, 0 for the first response of a connection; then
+ * the bytes received after this response.
+ * @param[in] bodyCallback Callback receiving the body of the response.
+ * @param[in] pContext Context passed to @p bodyCallback.
+ * @param[out] pResponse The response received.
+ *
+ * @return The same values as #HttpBodyStream_Get.
+ */
+HTTPStatus_t HttpBodyStream_Receive( const TransportInterface_t * pTransportInterface,
+                                     uint8_t * pBuffer,
+                                     size_t bufferLen,
+                                     size_t * pBufferedLength,
+                                     HttpBodyStreamCallback_t bodyCallback,
+                                     void * pContext,
+                                     HttpBodyStreamResponse_t * pResponse );
+
+/**
+ * @brief Download consecutive ranges of an object over one connection, with
+ * several requests in flight at a time.
+ *
+ * Every request is written from @p pRequestTemplate, whose Range positions
+ * are patched in place for each range. The first request is sent alone, and
+ * the Content-Range of its response gives the length of the object. The
+ * requests for the next ranges are then pipelined: up to @p pipelineDepth are
+ * sent before their responses are received, so the server does not wait a
+ * round trip between two ranges. The responses arrive in the order of the
+ * requests.
+ *
+ * The body of every range is passed to @p bodyCallback with its position
+ * within the object. Bytes of the next response received with the end of a
+ * body are kept at the start of @p pBuffer for the next response.
+ *
+ * On success, the object is downloaded from @p startOffset to its end, unless
+ * a response had "Connection: close". The requests sent after that response
+ * are not answered, so the caller resumes from @p startOffset plus the
+ * bodyLength of @p pResponse on a new connection.
+ *
+ * @param[in] pTransportInterface The transport interface to send the requests
+ * and receive the responses over.
+ * @param[in] pRequestTemplate The GET request of the object, with its Range
+ * positions reserved.
+ * @param[in] startOffset Position of the first byte to download.
+ * @param[in] rangeLength The length of each range requested.
+ * @param[in] pipelineDepth The most requests without a response at a time.
+ * @param[in] pBuffer Buffer receiving the responses. Only the status line and
+ * headers of a response must fit in it.
+ * @param[in] bufferLen Length of @p pBuffer.
+ * @param[in] bodyCallback Callback receiving the bodies of the responses.
+ * @param[in] pContext Context passed to @p bodyCallback.
+ * @param[out] pResponse The statusCode and contentLength of the last
+ * response, the objectLength of the object, the bodyLength passed to
+ * @p bodyCallback by this call, and whether the connection can be reused.
+ *
+ * @return Returns one of the following:
+ * - #HTTPSuccess if the responses were received entirely.
+ * - #HTTPInvalidParameter if a parameter is NULL or zero, or the Range
+ * positions of @p pRequestTemplate are not reserved.
+ * - #HTTPInsufficientMemory if the response headers do not fit in
+ * @p pBuffer.
+ * - #HTTPNetworkError if the transport failed.
+ * - #HTTPNoResponse if the server sent nothing before the timeout.
+ * - #HTTPPartialResponse if a response was incomplete before the timeout,
+ * or @p bodyCallback stopped the body.
+ * - #HTTPInvalidResponse if a response could not be parsed or is not the
+ * partial content of the range requested.
+ */
+HTTPStatus_t HttpBodyStream_GetRanges( const TransportInterface_t * pTransportInterface,
+                                       HttpRequestTemplate_t * pRequestTemplate,
+                                       uint64_t startOffset,
+                                       uint64_t rangeLength,
+                                       size_t pipelineDepth,
+                                       uint8_t * pBuffer,
+                                       size_t bufferLen,
+                                       HttpBodyStreamCallback_t bodyCallback,
+                                       void * pContext,
+                                       HttpBodyStreamResponse_t * pResponse );
+
+#endif /* ifndef HTTP_BODY_STREAM_H_ */
@@ -0,0 +1,231 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_connection_pool.h
+ * @brief The API of a pool of keep-alive TLS connections shared by the HTTP
+ * requests of a demo.
+ */
+
+#ifndef HTTP_CONNECTION_POOL_H_
+#define HTTP_CONNECTION_POOL_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Connection Pool module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Connection Pool"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/* OpenSSL transport header. */
+#include "openssl_posix.h"
+
+/**
+ * @brief Maximum number of connections kept by the pool, whether checked out
+ * or idle.
+ */
+#ifndef CONNECTION_POOL_SIZE
+    #define CONNECTION_POOL_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Maximum length of the host names of the pooled connections.
+ */
+#ifndef CONNECTION_POOL_MAX_HOST_NAME_LENGTH
+    #define CONNECTION_POOL_MAX_HOST_NAME_LENGTH    ( 253U )
+#endif
+
+/**
+ * @brief Time in milliseconds after which an idle connection is closed
+ * instead of being reused.
+ *
+ * Servers close idle keep-alive connections after a while, S3 after about 20
+ * seconds. Reusing a connection the server is closing would fail the request
+ * sent over it.
+ */
+#ifndef CONNECTION_POOL_IDLE_TIMEOUT_MS
+    #define CONNECTION_POOL_IDLE_TIMEOUT_MS    ( 15000U )
+#endif
+
+/**
+ * @brief Time in milliseconds a connection established by
+ * #ConnectionPool_Prewarm is kept for a check out before it is closed.
+ *
+ * A longer time than #CONNECTION_POOL_IDLE_TIMEOUT_MS has no effect, as the
+ * connection is not reused once it has been idle for that long.
+ */
+#ifndef CONNECTION_POOL_PREWARM_TIMEOUT_MS
+    #define CONNECTION_POOL_PREWARM_TIMEOUT_MS    ( 10000U )
+#endif
+
+/* Enumeration type for return status value from Connection Pool API. */
+typedef enum ConnectionPoolStatus
+{
+    /**
+     * @brief Success return value from Connection Pool API.
+     */
+    CONNECTION_POOL_SUCCESS = 0,
+
+    /**
+     * @brief Failure return value due to a NULL or too long parameter.
+     */
+    CONNECTION_POOL_INVALID_PARAMETER,
+
+    /**
+     * @brief Failure return value due to all connections of the pool being
+     * checked out.
+     */
+    CONNECTION_POOL_FULL,
+
+    /**
+     * @brief Failure return value due to the connection to the server
+     * failing, after all attempts with backoff, or to the thread of
+     * #ConnectionPool_Prewarm not starting.
+     */
+    CONNECTION_POOL_CONNECT_FAILURE
+} ConnectionPoolStatus_t;
+
+/**
+ * @brief Check out a connection to a server, to send HTTP requests over it
+ * with #HTTPClient_Send.
+ *
+ * An idle connection to the same host and port, established with the same
+ * credentials, is reused when the server has not closed it and it has not
+ * been idle for more than #CONNECTION_POOL_IDLE_TIMEOUT_MS. Otherwise, a new
+ * connection is established, with retries and backoff, in place of a free
+ * slot or of the least recently used idle connection.
+ *
+ * A connection to the same server still being established by
+ * #ConnectionPool_Prewarm is waited for.
+ *
+ * @param[in] pServerInfo Host and port of the server.
+ * @param[in] pCredentials Credentials of the TLS connection.
+ * @param[in] sendRecvTimeoutMs Send and receive timeout of a new connection.
+ * @param[out] pTransportInterface Transport interface set to send and receive
+ * over the connection.
+ *
+ * @note The strings pointed to by @p pCredentials, and the socket options of
+ * @p pServerInfo, must remain valid until #ConnectionPool_CloseAll, as the
+ * pool keeps pointers to them to compare the credentials of later check outs.
+ * The exception is an SNI host name equal to the host name, which the pool
+ * copies.
+ *
+ * @note Each connection must be checked in with #ConnectionPool_Checkin once
+ * its response has been processed.
+ *
+ * @return Returns one of the following:
+ * - #CONNECTION_POOL_SUCCESS if a connection was checked out.
+ * - #CONNECTION_POOL_INVALID_PARAMETER if a parameter is NULL or the host name
+ * is longer than #CONNECTION_POOL_MAX_HOST_NAME_LENGTH.
+ * - #CONNECTION_POOL_FULL if all connections of the pool are checked out.
+ * - #CONNECTION_POOL_CONNECT_FAILURE if a new connection could not be
+ * established.
+ */
+ConnectionPoolStatus_t ConnectionPool_Checkout( const ServerInfo_t * pServerInfo,
+                                                const OpensslCredentials_t * pCredentials,
+                                                uint32_t sendRecvTimeoutMs,
+                                                TransportInterface_t * pTransportInterface );
+
+/**
+ * @brief Start establishing a connection to a server in the background, so
+ * that a later #ConnectionPool_Checkout finds it ready.
+ *
+ * Name resolution and the TCP and TLS handshakes run on a thread of their
+ * own, while the caller goes on with the work that precedes its first
+ * request, such as processing the document naming the server. A check out
+ * to the same server and credentials while the connection is being
+ * established waits for it instead of establishing a second one. The
+ * connection is closed if it is not checked out within
+ * #CONNECTION_POOL_PREWARM_TIMEOUT_MS.
+ *
+ * Nothing is done if a connection to the server is idle or already being
+ * established.
+ *
+ * @param[in] pServerInfo Host and port of the server.
+ * @param[in] pCredentials Credentials of the TLS connection, which must be
+ * those of the later check out.
+ * @param[in] sendRecvTimeoutMs Send and receive timeout of the connection.
+ *
+ * @note The strings pointed to by @p pCredentials must remain valid as for
+ * #ConnectionPool_Checkout. The host name is copied, so @p pServerInfo may
+ * be released on return.
+ *
+ * @return Returns one of the following:
+ * - #CONNECTION_POOL_SUCCESS if the connection is being established, or a
+ * connection to the server is already available.
+ * - #CONNECTION_POOL_INVALID_PARAMETER if a parameter is NULL or the host name
+ * is longer than #CONNECTION_POOL_MAX_HOST_NAME_LENGTH.
+ * - #CONNECTION_POOL_FULL if all connections of the pool are checked out.
+ * - #CONNECTION_POOL_CONNECT_FAILURE if the thread establishing the
+ * connection could not be created. A failure of the connection itself is
+ * only logged.
+ */
+ConnectionPoolStatus_t ConnectionPool_Prewarm( const ServerInfo_t * pServerInfo,
+                                               const OpensslCredentials_t * pCredentials,
+                                               uint32_t sendRecvTimeoutMs );
+
+/**
+ * @brief Return a connection checked out with #ConnectionPool_Checkout to the
+ * pool.
+ *
+ * The connection is kept for later requests, unless the request failed or the
+ * server responded with a "Connection: close" header, in which case it is
+ * closed.
+ *
+ * @param[in] pTransportInterface Transport interface set by
+ * #ConnectionPool_Checkout.
+ * @param[in] httpStatus Status returned by #HTTPClient_Send for the last
+ * request sent over the connection.
+ * @param[in] pResponse Response to the last request. May be NULL if no
+ * request was sent.
+ */
+void ConnectionPool_Checkin( const TransportInterface_t * pTransportInterface,
+                             HTTPStatus_t httpStatus,
+                             const HTTPResponse_t * pResponse );
+
+/**
+ * @brief Close all connections of the pool that are not checked out.
+ */
+void ConnectionPool_CloseAll( void );
+
+#endif /* ifndef HTTP_CONNECTION_POOL_H_ */
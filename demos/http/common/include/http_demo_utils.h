@@ -113,3 +113,86 @@ HTTPStatus_t getUrlAddress( const char * pUrl,
                             size_t urlLen,
                             const char ** pAddress,
                             size_t * pAddressLen );
+
+/**
+ * @brief The longest host name that #copyUrlHost stores, excluding the
+ * NULL terminator. This is the longest name allowed by DNS.
+ */
+#define URL_MAX_HOST_LENGTH    ( 253U )
+
+/**
+ * @brief The location of a component of a URL, as an offset into the URL
+ * string.
+ */
+typedef struct UrlComponent
+{
+    size_t offset; /**< @brief Offset of the first character from the start of the URL. */
+    size_t length; /**< @brief Length of the component; 0 if the URL does not have it. */
+} UrlComponent_t;
+
+/**
+ * @brief A URL parsed by #parseUrl.
+ *
+ * The components point into the URL string, which is not copied. The string
+ * must remain valid for as long as the structure is used.
+ */
+typedef struct ParsedUrl
+{
+    const char * pUrl;            /**< @brief The URL string that was parsed. */
+    size_t urlLen;                /**< @brief The length of the URL string. */
+    UrlComponent_t scheme;        /**< @brief The scheme, e.g. "https". */
+    UrlComponent_t host;          /**< @brief The host name, without the port. */
+    UrlComponent_t path;          /**< @brief The path, without the query. */
+    UrlComponent_t query;         /**< @brief The query, without the leading '?'. */
+    UrlComponent_t requestTarget; /**< @brief The path and query, to be sent in the request line. */
+    uint16_t port;                /**< @brief The port in the URL; 0 if the URL does not have one. */
+} ParsedUrl_t;
+
+/**
+ * @brief Parse a URL once, so that the components can be used for every
+ * request sent to it without parsing the URL again.
+ *
+ * No memory is allocated and the URL is not copied.
+ *
+ * For example, if pUrl is:
+ * "https://www.somewebsite.com:8443/path/to/item.txt?optionalquery=stuff"
+ *
+ * Then pParsedUrl will describe:
+ * scheme = "https"
+ * host = "www.somewebsite.com"
+ * port = 8443
+ * path = "/path/to/item.txt"
+ * query = "optionalquery=stuff"
+ * requestTarget = "/path/to/item.txt?optionalquery=stuff"
+ *
+ * @param[in] pUrl URL string to parse. It must start with "http://" or
+ * "https://", and must outlive @p pParsedUrl.
+ * @param[in] urlLen The length of the URL string input.
+ * @param[out] pParsedUrl The components of the URL.
+ *
+ * @return The status of the parsing attempt:
+ * HTTPSuccess if the URL was successfully parsed,
+ * HTTPInvalidParameter if a parameter is NULL,
+ * HTTPParserInternalError if there was an error parsing the URL,
+ * or HTTPNoResponse if the URL has no host or no path.
+ */
+HTTPStatus_t parseUrl( const char * pUrl,
+                       size_t urlLen,
+                       ParsedUrl_t * pParsedUrl );
+
+/**
+ * @brief Copy the host of a parsed URL into a NULL-terminated string.
+ *
+ * The transport interfaces need the host name as a NULL-terminated string
+ * for name resolution and Server Name Indication.
+ *
+ * @param[in] pParsedUrl A URL parsed by #parseUrl.
+ * @param[out] pBuffer The buffer to write the host name to.
+ * @param[in] bufferLen The size of @p pBuffer, including space for the NULL
+ * terminator.
+ *
+ * @return true if the host name was copied; false if it does not fit.
+ */
+bool copyUrlHost( const ParsedUrl_t * pParsedUrl,
+                  char * pBuffer,
+                  size_t bufferLen );
@@ -0,0 +1,221 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_download_checkpoint.h
+ * @brief The API of a checkpoint file recording the ranges of a download
+ * written to disk, so that an interrupted download resumes where it stopped.
+ */
+
+#ifndef HTTP_DOWNLOAD_CHECKPOINT_H_
+#define HTTP_DOWNLOAD_CHECKPOINT_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Download Checkpoint module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Download Checkpoint"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/**
+ * @brief Maximum length of the ETag of the downloaded object.
+ */
+#ifndef DOWNLOAD_CHECKPOINT_MAX_ETAG_LENGTH
+    #define DOWNLOAD_CHECKPOINT_MAX_ETAG_LENGTH    ( 128U )
+#endif
+
+/**
+ * @brief Length of the bitmap needed for the given number of ranges.
+ */
+#define DOWNLOAD_CHECKPOINT_BITMAP_LENGTH( rangeCount )    ( ( ( rangeCount ) + 7U ) / 8U )
+
+/* Enumeration type for return status value from Download Checkpoint API. */
+typedef enum DownloadCheckpointStatus
+{
+    /**
+     * @brief Success return value from Download Checkpoint API.
+     */
+    DOWNLOAD_CHECKPOINT_SUCCESS = 0,
+
+    /**
+     * @brief Failure return value due to a NULL or too long parameter.
+     */
+    DOWNLOAD_CHECKPOINT_INVALID_PARAMETER,
+
+    /**
+     * @brief Failure return value due to the bitmap being too small for the
+     * ranges of the download.
+     */
+    DOWNLOAD_CHECKPOINT_INSUFFICIENT_MEMORY,
+
+    /**
+     * @brief Failure return value due to an error reading, writing or
+     * syncing the checkpoint file or the downloaded file.
+     */
+    DOWNLOAD_CHECKPOINT_FILE_ERROR
+} DownloadCheckpointStatus_t;
+
+/**
+ * @brief The checkpoint of a download, set by #DownloadCheckpoint_Open.
+ *
+ * @note The members are private to the Download Checkpoint module.
+ */
+typedef struct DownloadCheckpoint
+{
+    int fileDescriptor;        /**< @brief The checkpoint file. */
+    int dataFileDescriptor;    /**< @brief The downloaded file, synced before the checkpoint file. */
+    uint8_t * pBitmap;         /**< @brief One bit for each range, set once the range is written. */
+    uint64_t rangeCount;       /**< @brief The number of ranges of the download. */
+    uint64_t completedCount;   /**< @brief The number of bits set in #DownloadCheckpoint_t.pBitmap. */
+    uint32_t syncInterval;     /**< @brief Ranges completed between two syncs of the checkpoint file. */
+    uint32_t unsyncedCount;    /**< @brief Ranges completed since the last sync. */
+    pthread_mutex_t mutex;     /**< @brief Guards the bitmap and the counts, shared by the download threads. */
+} DownloadCheckpoint_t;
+
+/**
+ * @brief Open the checkpoint file of a download, resuming the download it
+ * records if it is for the same object.
+ *
+ * The ranges recorded in the file are kept only if the size of the object,
+ * the length of the ranges and the ETag of the object all match. Otherwise,
+ * the file is reset to record no range, and the downloaded file must be
+ * written again from the start.
+ *
+ * @param[out] pCheckpoint The checkpoint to set.
+ * @param[in] pPath The path of the checkpoint file, created if it does not
+ * exist.
+ * @param[in] dataFileDescriptor The file the ranges are written to. It is
+ * synced before each sync of the checkpoint file, so that the checkpoint never
+ * records a range that is not on disk.
+ * @param[in] fileSize The size of the object.
+ * @param[in] rangeLength The length of each range, except the last one.
+ * @param[in] pEtag The ETag of the object.
+ * @param[in] etagLength The length of @p pEtag, at most
+ * #DOWNLOAD_CHECKPOINT_MAX_ETAG_LENGTH.
+ * @param[in] pBitmap Buffer for the bitmap of the ranges, of at least
+ * #DOWNLOAD_CHECKPOINT_BITMAP_LENGTH bytes for the number of ranges.
+ * @param[in] bitmapLength The length of @p pBitmap.
+ * @param[in] syncInterval The number of ranges completed between two syncs of
+ * the checkpoint file. At most this many ranges are downloaded again after a
+ * crash.
+ * @param[out] pResumedCount The number of ranges already downloaded.
+ *
+ * @return Returns one of the following:
+ * - #DOWNLOAD_CHECKPOINT_SUCCESS if the checkpoint was opened.
+ * - #DOWNLOAD_CHECKPOINT_INVALID_PARAMETER if a parameter is NULL or zero, or
+ * the ETag is too long.
+ * - #DOWNLOAD_CHECKPOINT_INSUFFICIENT_MEMORY if @p pBitmap is too small.
+ * - #DOWNLOAD_CHECKPOINT_FILE_ERROR if the checkpoint file could not be
+ * opened or reset.
+ */
+DownloadCheckpointStatus_t DownloadCheckpoint_Open( DownloadCheckpoint_t * pCheckpoint,
+                                                    const char * pPath,
+                                                    int dataFileDescriptor,
+                                                    uint64_t fileSize,
+                                                    uint64_t rangeLength,
+                                                    const char * pEtag,
+                                                    size_t etagLength,
+                                                    uint8_t * pBitmap,
+                                                    size_t bitmapLength,
+                                                    uint32_t syncInterval,
+                                                    uint64_t * pResumedCount );
+
+/**
+ * @brief Check whether a range was already written to the downloaded file.
+ *
+ * @param[in] pCheckpoint The checkpoint set by #DownloadCheckpoint_Open.
+ * @param[in] rangeIndex The index of the range.
+ *
+ * @return true if the range is recorded as written; false otherwise.
+ */
+bool DownloadCheckpoint_IsRangeComplete( DownloadCheckpoint_t * pCheckpoint,
+                                         uint64_t rangeIndex );
+
+/**
+ * @brief Record that a range was written to the downloaded file.
+ *
+ * The checkpoint file is synced once every @p syncInterval ranges given to
+ * #DownloadCheckpoint_Open. This function may be called by several threads.
+ *
+ * @param[in] pCheckpoint The checkpoint set by #DownloadCheckpoint_Open.
+ * @param[in] rangeIndex The index of the range.
+ *
+ * @return #DOWNLOAD_CHECKPOINT_SUCCESS, #DOWNLOAD_CHECKPOINT_INVALID_PARAMETER
+ * or #DOWNLOAD_CHECKPOINT_FILE_ERROR.
+ */
+DownloadCheckpointStatus_t DownloadCheckpoint_MarkRangeComplete( DownloadCheckpoint_t * pCheckpoint,
+                                                                 uint64_t rangeIndex );
+
+/**
+ * @brief Sync the downloaded file, then the ranges recorded to the checkpoint
+ * file.
+ *
+ * @param[in] pCheckpoint The checkpoint set by #DownloadCheckpoint_Open.
+ *
+ * @return #DOWNLOAD_CHECKPOINT_SUCCESS, #DOWNLOAD_CHECKPOINT_INVALID_PARAMETER
+ * or #DOWNLOAD_CHECKPOINT_FILE_ERROR.
+ */
+DownloadCheckpointStatus_t DownloadCheckpoint_Sync( DownloadCheckpoint_t * pCheckpoint );
+
+/**
+ * @brief Close the checkpoint file.
+ *
+ * @param[in] pCheckpoint The checkpoint set by #DownloadCheckpoint_Open.
+ * @param[in] pPath The path of the checkpoint file.
+ * @param[in] removeFile Whether to remove the checkpoint file, once the
+ * download is complete or cannot be resumed. Otherwise, the file is synced to
+ * resume the download later.
+ *
+ * @return #DOWNLOAD_CHECKPOINT_SUCCESS, #DOWNLOAD_CHECKPOINT_INVALID_PARAMETER
+ * or #DOWNLOAD_CHECKPOINT_FILE_ERROR.
+ */
+DownloadCheckpointStatus_t DownloadCheckpoint_Close( DownloadCheckpoint_t * pCheckpoint,
+                                                     const char * pPath,
+                                                     bool removeFile );
+
+#endif /* ifndef HTTP_DOWNLOAD_CHECKPOINT_H_ */
@@ -0,0 +1,101 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_range_tuner.h
+ * @brief The API adapting the length of the ranges of a download to the
+ * throughput and round trip time measured for each request.
+ */
+
+#ifndef HTTP_RANGE_TUNER_H_
+#define HTTP_RANGE_TUNER_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The length of the ranges of a download, increased additively while
+ * requests complete quickly and halved when they fail or take too long.
+ *
+ * A fast link then downloads with the longest ranges the buffers can hold,
+ * while a slow one keeps requesting ranges short enough to complete before
+ * the transport times out.
+ */
+typedef struct HttpRangeTuner
+{
+    size_t stepLength;        /**< @brief Additive increase, and the shortest length. */
+    size_t maxLength;         /**< @brief Longest length the buffers can hold, a multiple of stepLength. */
+    size_t length;            /**< @brief Length of the next request. */
+    uint32_t targetTimeMs;    /**< @brief Longest time of a request before the length is halved. */
+    uint32_t requestStartMs;  /**< @brief Time the current request started. */
+    uint32_t roundTripTimeMs; /**< @brief Smoothed time of the successful requests, 0 until the first. */
+    uint64_t throughput;      /**< @brief Smoothed throughput of the successful requests, in bytes per second. */
+} HttpRangeTuner_t;
+
+/**
+ * @brief Initialize the length of the ranges.
+ *
+ * @param[out] pTuner The range length tuner.
+ * @param[in] initialLength The length of the first request, rounded down to a
+ * multiple of @p stepLength.
+ * @param[in] stepLength The additive increase of the length, and its
+ * smallest value.
+ * @param[in] maxLength The largest length, rounded down to a multiple of
+ * @p stepLength.
+ * @param[in] targetTimeMs The longest time of a request before the length is
+ * halved, shorter than the timeout of the transport.
+ */
+void HttpRangeTuner_Init( HttpRangeTuner_t * pTuner,
+                          size_t initialLength,
+                          size_t stepLength,
+                          size_t maxLength,
+                          uint32_t targetTimeMs );
+
+/**
+ * @brief Start timing a request.
+ *
+ * @param[in] pTuner The range length tuner.
+ *
+ * @return The length of the range to request.
+ */
+size_t HttpRangeTuner_Start( HttpRangeTuner_t * pTuner );
+
+/**
+ * @brief Measure the request started by #HttpRangeTuner_Start, and adapt the
+ * length of the next one.
+ *
+ * The length grows by the step length after a request that succeeded within
+ * the target time, unless its throughput fell below three quarters of the
+ * smoothed throughput. It is halved after a request that
+ * failed or exceeded the target time.
+ *
+ * @param[in] pTuner The range length tuner.
+ * @param[in] bytesReceived The bytes received by the request.
+ * @param[in] succeeded Whether the request succeeded.
+ */
+void HttpRangeTuner_Finish( HttpRangeTuner_t * pTuner,
+                            size_t bytesReceived,
+                            bool succeeded );
+
+#endif /* ifndef HTTP_RANGE_TUNER_H_ */
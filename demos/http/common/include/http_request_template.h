@@ -0,0 +1,129 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_request_template.h
+ * @brief The API of HTTP request templates, whose constant request line and
+ * headers are serialized once, and whose Range header is patched in place for
+ * each request of a range download.
+ */
+
+#ifndef HTTP_REQUEST_TEMPLATE_H_
+#define HTTP_REQUEST_TEMPLATE_H_
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stddef.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/**
+ * @brief Space reserved at the end of a template for the positions of the
+ * Range header, "18446744073709551615-18446744073709551615", and the line
+ * separators ending the headers.
+ */
+#define HTTP_REQUEST_TEMPLATE_RANGE_LENGTH    ( 41U + 4U )
+
+/**
+ * @brief A request serialized once, then sent for each range with the
+ * positions of its Range header patched in place.
+ *
+ * The Range header is the last header of the request, so patching it only
+ * moves the end of the headers.
+ *
+ * @note The buffer of the template must not be the buffer of the response,
+ * which would overwrite it.
+ */
+typedef struct HttpRequestTemplate
+{
+    HTTPRequestHeaders_t headers; /**< @brief The serialized request, to send with #HTTPClient_Send. */
+    size_t rangeOffset;           /**< @brief Offset of the Range positions in the buffer, 0 until they are reserved. */
+} HttpRequestTemplate_t;
+
+/**
+ * @brief Serialize the request line and the headers of @p pRequestInfo in a
+ * buffer.
+ *
+ * @param[out] pTemplate The template.
+ * @param[in] pBuffer The buffer holding the request, for as long as the
+ * template is used.
+ * @param[in] bufferLen The length of @p pBuffer.
+ * @param[in] pRequestInfo The request, as passed to
+ * #HTTPClient_InitializeRequestHeaders.
+ *
+ * @return The status returned by #HTTPClient_InitializeRequestHeaders.
+ */
+HTTPStatus_t HttpRequestTemplate_Init( HttpRequestTemplate_t * pTemplate,
+                                       uint8_t * pBuffer,
+                                       size_t bufferLen,
+                                       const HTTPRequestInfo_t * pRequestInfo );
+
+/**
+ * @brief Add a header with the same value in all requests of the template.
+ *
+ * @param[in] pTemplate The template.
+ * @param[in] pField The header field name.
+ * @param[in] fieldLen The length of @p pField.
+ * @param[in] pValue The header value.
+ * @param[in] valueLen The length of @p pValue.
+ *
+ * @return #HTTPInvalidParameter once the Range positions are reserved,
+ * otherwise the status returned by #HTTPClient_AddHeader.
+ */
+HTTPStatus_t HttpRequestTemplate_AddHeader( HttpRequestTemplate_t * pTemplate,
+                                            const char * pField,
+                                            size_t fieldLen,
+                                            const char * pValue,
+                                            size_t valueLen );
+
+/**
+ * @brief Add the Range header, reserving
+ * #HTTP_REQUEST_TEMPLATE_RANGE_LENGTH bytes for its positions, after which no
+ * other header can be added.
+ *
+ * @param[in] pTemplate The template.
+ *
+ * @return #HTTPSuccess, #HTTPInvalidParameter if the positions were already
+ * reserved, or #HTTPInsufficientMemory if the buffer is too short for them.
+ */
+HTTPStatus_t HttpRequestTemplate_ReserveRange( HttpRequestTemplate_t * pTemplate );
+
+/**
+ * @brief Write the positions of the Range header, for the next request sent
+ * with #HttpRequestTemplate_t.headers.
+ *
+ * Positions are 64-bit, where #HTTPClient_AddRangeHeader is limited to
+ * 32-bit positions.
+ *
+ * @param[in] pTemplate The template.
+ * @param[in] start The position of the first byte in the range.
+ * @param[in] end The position of the last byte in the range, inclusive.
+ *
+ * @return #HTTPSuccess, or #HTTPInvalidParameter if the positions were not
+ * reserved or @p end is before @p start.
+ */
+HTTPStatus_t HttpRequestTemplate_SetRange( HttpRequestTemplate_t * pTemplate,
+                                           uint64_t start,
+                                           uint64_t end );
+
+#endif /* ifndef HTTP_REQUEST_TEMPLATE_H_ */
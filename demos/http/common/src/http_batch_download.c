@@ -0,0 +1,861 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_batch_download.c
+ * @brief Implementation of the API to download a batch of objects over
+ * keep-alive connections shared by the objects of the same server.
+ *
+ * The objects are sorted by server, and the objects of a server are split
+ * into runs of consecutive objects. Each thread takes the next run, checks
+ * out a connection to its server and pipelines the requests of the run over
+ * it.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the batch download. */
+#include "http_batch_download.h"
+
+/* Common HTTP demo utilities. */
+#include "http_demo_utils.h"
+
+/* Connections shared by the objects of the same server. */
+#include "http_connection_pool.h"
+
+/* Pipelined requests, and the streaming of the bodies to the files. */
+#include "http_body_stream.h"
+
+/* Include clock header for the latencies. */
+#include "clock.h"
+
+#if ( HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH == 0U ) || ( HTTP_BATCH_DOWNLOAD_CONNECTIONS_PER_HOST == 0U )
+    #error "HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH and HTTP_BATCH_DOWNLOAD_CONNECTIONS_PER_HOST must be at least 1."
+#endif
+
+#if ( HTTP_BATCH_DOWNLOAD_THREAD_COUNT > CONNECTION_POOL_SIZE )
+    #error "HTTP_BATCH_DOWNLOAD_THREAD_COUNT must not exceed CONNECTION_POOL_SIZE."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Port of the servers when the URL has none.
+ */
+#define DEFAULT_HTTPS_PORT             ( 443U )
+
+/**
+ * @brief Characters of the scheme of the URLs supported.
+ */
+#define HTTPS_SCHEME                   "https"
+
+/**
+ * @brief Length of #HTTPS_SCHEME.
+ */
+#define HTTPS_SCHEME_LENGTH            ( sizeof( HTTPS_SCHEME ) - 1U )
+
+/**
+ * @brief Length of the HTTP GET method.
+ */
+#define HTTP_METHOD_GET_LENGTH         ( sizeof( HTTP_METHOD_GET ) - 1U )
+
+/**
+ * @brief Bytes of a request besides the host and the path and query of its
+ * URL: the request line and the headers written by the HTTP Client library.
+ */
+#define HTTP_REQUEST_OVERHEAD_LENGTH   ( 128U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Consecutive objects of the same server, downloaded over one
+ * connection at a time.
+ */
+typedef struct BatchRun
+{
+    size_t first; /**< @brief Position of the first object of the run in #objectOrder. */
+    size_t end;   /**< @brief Position following the last object of the run in #objectOrder. */
+} BatchRun_t;
+
+/**
+ * @brief The context of the body callback of an object.
+ */
+typedef struct ObjectContext
+{
+    FILE * pFile;                      /**< @brief The file written, or NULL if it could not be created. */
+    const HttpBatchObject_t * pObject; /**< @brief The object. */
+    uint64_t writtenLength;            /**< @brief Bytes of the body written. */
+    bool writeFailed;                  /**< @brief Whether creating or writing the file failed. */
+} ObjectContext_t;
+
+/**
+ * @brief A thread of the batch, with its buffers.
+ */
+typedef struct BatchThread
+{
+    pthread_t thread;                                            /**< @brief The thread. */
+    uint8_t requestBuffer[ HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH ];  /**< @brief Buffer of the requests. */
+    uint8_t responseBuffer[ HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH ]; /**< @brief Buffer of the responses. */
+} BatchThread_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The objects of the running batch.
+ */
+static HttpBatchObject_t * pBatchObjects = NULL;
+
+/**
+ * @brief The URLs of the objects, parsed once.
+ */
+static ParsedUrl_t parsedUrls[ HTTP_BATCH_DOWNLOAD_MAX_OBJECTS ];
+
+/**
+ * @brief Time each request was sent, for the latency of its object.
+ */
+static uint32_t requestTimesMs[ HTTP_BATCH_DOWNLOAD_MAX_OBJECTS ];
+
+/**
+ * @brief Indexes of the objects with a valid URL, sorted by server.
+ */
+static size_t objectOrder[ HTTP_BATCH_DOWNLOAD_MAX_OBJECTS ];
+
+/**
+ * @brief The runs of the batch.
+ */
+static BatchRun_t batchRuns[ HTTP_BATCH_DOWNLOAD_MAX_OBJECTS ];
+
+/**
+ * @brief Number of #batchRuns.
+ */
+static size_t runCount = 0U;
+
+/**
+ * @brief The next run to be taken by a thread, guarded by #batchMutex.
+ */
+static size_t nextRun = 0U;
+
+/**
+ * @brief Number of connections checked out, accessed atomically.
+ */
+static size_t connectionCount = 0U;
+
+/**
+ * @brief Number of requests sent ahead of a response, accessed atomically.
+ */
+static size_t pipelinedCount = 0U;
+
+/**
+ * @brief Trusted root CA certificates of the servers.
+ */
+static const char * pServerRootCaPath = NULL;
+
+/**
+ * @brief The threads of the batch. The requests are not written in the
+ * buffer of the responses, which keeps the beginning of a pipelined response
+ * while the next request is written.
+ */
+static BatchThread_t batchThreads[ HTTP_BATCH_DOWNLOAD_THREAD_COUNT ];
+
+/**
+ * @brief Mutex guarding #nextRun.
+ */
+static pthread_mutex_t batchMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The port of the server of a URL.
+ *
+ * @param[in] pParsedUrl The URL.
+ *
+ * @return The port of the URL, or #DEFAULT_HTTPS_PORT if it has none.
+ */
+static uint16_t serverPort( const ParsedUrl_t * pParsedUrl );
+
+/**
+ * @brief Order two URLs by their server: host name, ignoring case, then
+ * port.
+ *
+ * @param[in] pFirst The first URL.
+ * @param[in] pSecond The second URL.
+ *
+ * @return Less than, equal to or greater than 0 if the server of @p pFirst
+ * is ordered before, is the same as or is ordered after the server of
+ * @p pSecond.
+ */
+static int32_t compareServers( const ParsedUrl_t * pFirst,
+                               const ParsedUrl_t * pSecond );
+
+/**
+ * @brief Split the objects of a server into runs, one per connection.
+ *
+ * @param[in] groupStart Position of the first object of the server in
+ * #objectOrder.
+ * @param[in] groupLength Number of objects of the server.
+ */
+static void addRuns( size_t groupStart,
+                     size_t groupLength );
+
+/**
+ * @brief Parse the URLs of the objects, sort the objects by server and split
+ * them into runs.
+ *
+ * @param[in,out] pObjects The objects, whose results are reset. The objects
+ * with an invalid URL fail with #HTTPInvalidParameter.
+ * @param[in] objectCount The number of @p pObjects.
+ */
+static void groupObjects( HttpBatchObject_t * pObjects,
+                          size_t objectCount );
+
+/**
+ * @brief Write the body of a response to the file of its object.
+ *
+ * @param[in] pContext The #ObjectContext_t of the object.
+ * @param[in] offset Position of @p pData within the body.
+ * @param[in] pData The next bytes of the body.
+ * @param[in] dataLength The length of @p pData.
+ *
+ * @return true to keep receiving; false if the file could not be written.
+ */
+static bool writeBody( void * pContext,
+                       uint64_t offset,
+                       const uint8_t * pData,
+                       size_t dataLength );
+
+/**
+ * @brief Send the request of an object.
+ *
+ * @param[in] pTransportInterface The connection to the server of the object.
+ * @param[in] objectIndex Index of the object.
+ * @param[in] pHost The host name of the server.
+ * @param[in] pBuffer Buffer for the request, of
+ * #HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH bytes.
+ *
+ * @return #HTTPSuccess, #HTTPInsufficientMemory or #HTTPNetworkError.
+ */
+static HTTPStatus_t sendRequest( const TransportInterface_t * pTransportInterface,
+                                 size_t objectIndex,
+                                 const char * pHost,
+                                 uint8_t * pBuffer );
+
+/**
+ * @brief Receive the response to the request of an object into its file.
+ *
+ * @param[in] pTransportInterface The connection to the server of the object.
+ * @param[in] objectIndex Index of the object.
+ * @param[in] pBuffer Buffer for the responses, of
+ * #HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH bytes.
+ * @param[in,out] pBufferedLength Bytes of the response at the start of
+ * @p pBuffer, then of the next one.
+ * @param[out] pConnectionClose Whether the connection cannot be reused.
+ * @param[out] pWriteFailed Whether the file could not be written, so that
+ * the object is not requested again.
+ *
+ * @return The status returned by #HttpBodyStream_Receive.
+ */
+static HTTPStatus_t receiveObject( const TransportInterface_t * pTransportInterface,
+                                   size_t objectIndex,
+                                   uint8_t * pBuffer,
+                                   size_t * pBufferedLength,
+                                   bool * pConnectionClose,
+                                   bool * pWriteFailed );
+
+/**
+ * @brief Download the objects of a run, over as many connections as the
+ * server needs, until all are received or
+ * #HTTP_BATCH_DOWNLOAD_MAX_ATTEMPTS connections receive none.
+ *
+ * @param[in] pRun The run.
+ * @param[in] pRequestBuffer Buffer for the requests.
+ * @param[in] pResponseBuffer Buffer for the responses.
+ */
+static void downloadRun( const BatchRun_t * pRun,
+                         uint8_t * pRequestBuffer,
+                         uint8_t * pResponseBuffer );
+
+/**
+ * @brief Download the runs not taken by another thread, one at a time.
+ *
+ * @param[in] pArgument The #BatchThread_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * downloadThread( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static uint16_t serverPort( const ParsedUrl_t * pParsedUrl )
+{
+    return ( pParsedUrl->port != 0U ) ? pParsedUrl->port : ( uint16_t ) DEFAULT_HTTPS_PORT;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t compareServers( const ParsedUrl_t * pFirst,
+                               const ParsedUrl_t * pSecond )
+{
+    int32_t comparison = 0;
+    size_t length = ( pFirst->host.length < pSecond->host.length ) ?
+                    pFirst->host.length : pSecond->host.length;
+
+    /* Host names are case insensitive. */
+    comparison = ( int32_t ) strncasecmp( &pFirst->pUrl[ pFirst->host.offset ],
+                                          &pSecond->pUrl[ pSecond->host.offset ],
+                                          length );
+
+    if( comparison == 0 )
+    {
+        comparison = ( int32_t ) pFirst->host.length - ( int32_t ) pSecond->host.length;
+    }
+
+    if( comparison == 0 )
+    {
+        comparison = ( int32_t ) serverPort( pFirst ) - ( int32_t ) serverPort( pSecond );
+    }
+
+    return comparison;
+}
+
+/*-----------------------------------------------------------*/
+
+static void addRuns( size_t groupStart,
+                     size_t groupLength )
+{
+    size_t runsInGroup = 0U, i = 0U;
+
+    /* A run of at least a pipeline of objects, so that a few small objects
+     * share one connection, and the objects of a large group spread over
+     * several connections. */
+    runsInGroup = ( groupLength + HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH - 1U ) / HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH;
+
+    if( runsInGroup > HTTP_BATCH_DOWNLOAD_CONNECTIONS_PER_HOST )
+    {
+        runsInGroup = HTTP_BATCH_DOWNLOAD_CONNECTIONS_PER_HOST;
+    }
+
+    for( i = 0U; i < runsInGroup; i++ )
+    {
+        batchRuns[ runCount ].first = groupStart + ( ( groupLength * i ) / runsInGroup );
+        batchRuns[ runCount ].end = groupStart + ( ( groupLength * ( i + 1U ) ) / runsInGroup );
+        runCount++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void groupObjects( HttpBatchObject_t * pObjects,
+                          size_t objectCount )
+{
+    size_t orderedCount = 0U, groupStart = 0U, groupLength = 0U, i = 0U, j = 0U;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+    ParsedUrl_t * pParsedUrl = NULL;
+
+    runCount = 0U;
+
+    for( i = 0U; i < objectCount; i++ )
+    {
+        pObjects[ i ].downloaded = false;
+        pObjects[ i ].status = HTTPSuccess;
+        pObjects[ i ].statusCode = 0U;
+        pObjects[ i ].bodyLength = 0U;
+        pObjects[ i ].latencyMs = 0U;
+        pParsedUrl = &parsedUrls[ i ];
+
+        httpStatus = ( ( pObjects[ i ].pUrl == NULL ) || ( pObjects[ i ].pFilePath == NULL ) ) ?
+                     HTTPInvalidParameter :
+                     parseUrl( pObjects[ i ].pUrl, pObjects[ i ].urlLength, pParsedUrl );
+
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to parse the URL of object %lu.", ( unsigned long ) i ) );
+            pObjects[ i ].status = HTTPInvalidParameter;
+        }
+        else if( ( pParsedUrl->scheme.length != HTTPS_SCHEME_LENGTH ) ||
+                 ( strncasecmp( &pObjects[ i ].pUrl[ pParsedUrl->scheme.offset ], HTTPS_SCHEME, HTTPS_SCHEME_LENGTH ) != 0 ) ||
+                 ( pParsedUrl->host.length > URL_MAX_HOST_LENGTH ) )
+        {
+            LogError( ( "Only HTTPS URLs with a valid host are supported: %.*s.",
+                        ( int ) pObjects[ i ].urlLength,
+                        pObjects[ i ].pUrl ) );
+            pObjects[ i ].status = HTTPInvalidParameter;
+        }
+        else if( ( pObjects[ i ].urlLength + HTTP_REQUEST_OVERHEAD_LENGTH ) > HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH )
+        {
+            /* The request could not be written, over any connection. */
+            LogError( ( "The URL of %s is too long for HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH.",
+                        pObjects[ i ].pFilePath ) );
+            pObjects[ i ].status = HTTPInsufficientMemory;
+        }
+        else
+        {
+            /* Insertion sort, which keeps the order of the objects of a
+             * server, as the batches are short. */
+            j = orderedCount;
+
+            while( ( j > 0U ) && ( compareServers( &parsedUrls[ objectOrder[ j - 1U ] ], pParsedUrl ) > 0 ) )
+            {
+                objectOrder[ j ] = objectOrder[ j - 1U ];
+                j--;
+            }
+
+            objectOrder[ j ] = i;
+            orderedCount++;
+        }
+    }
+
+    for( groupStart = 0U; groupStart < orderedCount; groupStart += groupLength )
+    {
+        groupLength = 1U;
+
+        while( ( ( groupStart + groupLength ) < orderedCount ) &&
+               ( compareServers( &parsedUrls[ objectOrder[ groupStart ] ],
+                                 &parsedUrls[ objectOrder[ groupStart + groupLength ] ] ) == 0 ) )
+        {
+            groupLength++;
+        }
+
+        addRuns( groupStart, groupLength );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool writeBody( void * pContext,
+                       uint64_t offset,
+                       const uint8_t * pData,
+                       size_t dataLength )
+{
+    ObjectContext_t * pObjectContext = ( ObjectContext_t * ) pContext;
+    bool keepReceiving = true;
+
+    /* The body is written in order, as it arrives. */
+    ( void ) offset;
+
+    if( pObjectContext->pFile == NULL )
+    {
+        keepReceiving = false;
+    }
+    else if( fwrite( pData, 1U, dataLength, pObjectContext->pFile ) != dataLength )
+    {
+        LogError( ( "Failed to write %s.", pObjectContext->pObject->pFilePath ) );
+        pObjectContext->writeFailed = true;
+        keepReceiving = false;
+    }
+    else
+    {
+        pObjectContext->writtenLength += dataLength;
+    }
+
+    return keepReceiving;
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t sendRequest( const TransportInterface_t * pTransportInterface,
+                                 size_t objectIndex,
+                                 const char * pHost,
+                                 uint8_t * pBuffer )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    const ParsedUrl_t * pParsedUrl = &parsedUrls[ objectIndex ];
+    HTTPRequestInfo_t requestInfo;
+    HTTPRequestHeaders_t requestHeaders;
+
+    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+    requestInfo.pHost = pHost;
+    requestInfo.hostLen = pParsedUrl->host.length;
+    requestInfo.pMethod = HTTP_METHOD_GET;
+    requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
+    requestInfo.pPath = &pParsedUrl->pUrl[ pParsedUrl->requestTarget.offset ];
+    requestInfo.pathLen = pParsedUrl->requestTarget.length;
+    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+    requestHeaders.pBuffer = pBuffer;
+    requestHeaders.bufferLen = HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH;
+
+    returnStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders, &requestInfo );
+
+    if( returnStatus != HTTPSuccess )
+    {
+        LogError( ( "Failed to write the request of %s: Error=%s.",
+                    pBatchObjects[ objectIndex ].pFilePath,
+                    HTTPClient_strerror( returnStatus ) ) );
+    }
+    else
+    {
+        requestTimesMs[ objectIndex ] = Clock_GetTimeMs();
+        returnStatus = HttpBodyStream_Send( pTransportInterface, &requestHeaders );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t receiveObject( const TransportInterface_t * pTransportInterface,
+                                   size_t objectIndex,
+                                   uint8_t * pBuffer,
+                                   size_t * pBufferedLength,
+                                   bool * pConnectionClose,
+                                   bool * pWriteFailed )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    HttpBatchObject_t * pObject = &pBatchObjects[ objectIndex ];
+    HttpBodyStreamResponse_t response;
+    ObjectContext_t context;
+
+    ( void ) memset( &context, 0, sizeof( context ) );
+    context.pObject = pObject;
+    context.pFile = fopen( pObject->pFilePath, "wb" );
+
+    if( context.pFile == NULL )
+    {
+        LogError( ( "Failed to create %s.", pObject->pFilePath ) );
+        context.writeFailed = true;
+    }
+
+    returnStatus = HttpBodyStream_Receive( pTransportInterface,
+                                           pBuffer,
+                                           HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH,
+                                           pBufferedLength,
+                                           writeBody,
+                                           &context,
+                                           &response );
+
+    if( ( context.pFile != NULL ) && ( fclose( context.pFile ) != 0 ) )
+    {
+        LogError( ( "Failed to write %s.", pObject->pFilePath ) );
+        context.writeFailed = true;
+    }
+
+    pObject->status = returnStatus;
+    pObject->statusCode = response.statusCode;
+    pObject->bodyLength = context.writtenLength;
+    pObject->latencyMs = Clock_GetTimeMs() - requestTimesMs[ objectIndex ];
+    pObject->downloaded = ( returnStatus == HTTPSuccess ) &&
+                          ( context.writeFailed == false ) &&
+                          ( response.statusCode >= 200U ) && ( response.statusCode < 300U );
+
+    if( ( pObject->downloaded == false ) && ( context.pFile != NULL ) )
+    {
+        ( void ) remove( pObject->pFilePath );
+    }
+
+    *pConnectionClose = response.connectionClose;
+    *pWriteFailed = context.writeFailed;
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void downloadRun( const BatchRun_t * pRun,
+                         uint8_t * pRequestBuffer,
+                         uint8_t * pResponseBuffer )
+{
+    HTTPStatus_t httpStatus = HTTPSuccess;
+    const ParsedUrl_t * pParsedUrl = &parsedUrls[ objectOrder[ pRun->first ] ];
+    char host[ URL_MAX_HOST_LENGTH + 1U ];
+    ServerInfo_t serverInfo;
+    OpensslCredentials_t credentials;
+    TransportInterface_t transportInterface;
+    HTTPResponse_t response;
+    size_t next = pRun->first, sent = 0U, received = 0U, bufferedLength = 0U, depth = 1U;
+    uint32_t attempts = 0U;
+    bool pipelineAllowed = true, pipelining = false, connectionClose = false, writeFailed = false;
+
+    /* The host fits, as its length was checked when grouping. */
+    ( void ) copyUrlHost( pParsedUrl, host, sizeof( host ) );
+
+    ( void ) memset( &credentials, 0, sizeof( credentials ) );
+    credentials.pRootCaPath = pServerRootCaPath;
+    credentials.sniHostName = host;
+
+    ( void ) memset( &serverInfo, 0, sizeof( serverInfo ) );
+    serverInfo.pHostName = host;
+    serverInfo.hostNameLength = pParsedUrl->host.length;
+    serverInfo.port = serverPort( pParsedUrl );
+
+    while( ( next < pRun->end ) && ( attempts < HTTP_BATCH_DOWNLOAD_MAX_ATTEMPTS ) )
+    {
+        attempts++;
+
+        if( ConnectionPool_Checkout( &serverInfo,
+                                     &credentials,
+                                     HTTP_BATCH_DOWNLOAD_TIMEOUT_MS,
+                                     &transportInterface ) != CONNECTION_POOL_SUCCESS )
+        {
+            /* The pool already retried the connection with backoff. */
+            LogError( ( "Failed to connect to %s.", host ) );
+            httpStatus = HTTPNetworkError;
+            attempts = HTTP_BATCH_DOWNLOAD_MAX_ATTEMPTS;
+        }
+        else
+        {
+            ( void ) __atomic_add_fetch( &connectionCount, 1U, __ATOMIC_RELAXED );
+            sent = next;
+            received = next;
+            bufferedLength = 0U;
+            pipelining = false;
+            connectionClose = false;
+
+            /* The first request is sent alone: whether the server keeps the
+             * connection alive is only known from its response. */
+            httpStatus = sendRequest( &transportInterface, objectOrder[ sent ], host, pRequestBuffer );
+
+            if( httpStatus == HTTPSuccess )
+            {
+                sent++;
+            }
+
+            /* The requests sent after a "Connection: close" are not
+             * answered. */
+            while( ( httpStatus == HTTPSuccess ) && ( connectionClose == false ) && ( received < sent ) )
+            {
+                httpStatus = receiveObject( &transportInterface,
+                                            objectOrder[ received ],
+                                            pResponseBuffer,
+                                            &bufferedLength,
+                                            &connectionClose,
+                                            &writeFailed );
+
+                if( httpStatus == HTTPSuccess )
+                {
+                    received++;
+                    attempts = 0U;
+
+                    pipelining = ( pipelineAllowed == true ) && ( connectionClose == false );
+                    depth = ( pipelining == true ) ? HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH : 1U;
+
+                    while( ( httpStatus == HTTPSuccess ) && ( connectionClose == false ) &&
+                           ( sent < pRun->end ) && ( ( sent - received ) < depth ) )
+                    {
+                        httpStatus = sendRequest( &transportInterface, objectOrder[ sent ], host, pRequestBuffer );
+
+                        if( httpStatus == HTTPSuccess )
+                        {
+                            if( sent > received )
+                            {
+                                ( void ) __atomic_add_fetch( &pipelinedCount, 1U, __ATOMIC_RELAXED );
+                            }
+
+                            sent++;
+                        }
+                    }
+                }
+                else if( writeFailed == true )
+                {
+                    /* Requesting the object again would not help, and the
+                     * connection is not at fault. */
+                    received++;
+                    attempts = 0U;
+                }
+                else if( ( sent - received ) > 1U )
+                {
+                    /* The server may not handle pipelined requests, so the
+                     * next connections of the run wait for each response. */
+                    LogWarn( ( "Pipelined response from %s failed: Error=%s. Pipelining is disabled for the run.",
+                               host,
+                               HTTPClient_strerror( httpStatus ) ) );
+                    pipelineAllowed = false;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+
+            if( ( connectionClose == true ) && ( received < pRun->end ) )
+            {
+                LogInfo( ( "%s closed the connection, %lu objects of the run are left for a new one.",
+                           host,
+                           ( unsigned long ) ( pRun->end - received ) ) );
+            }
+
+            /* The connection pool only reads the flags of the response. */
+            ( void ) memset( &response, 0, sizeof( response ) );
+
+            if( connectionClose == true )
+            {
+                response.respFlags = HTTP_RESPONSE_CONNECTION_CLOSE_FLAG;
+            }
+
+            ConnectionPool_Checkin( &transportInterface, httpStatus, &response );
+            next = received;
+        }
+    }
+
+    /* The objects of the run that were never received fail with the status
+     * of the last attempt. */
+    for( ; next < pRun->end; next++ )
+    {
+        if( pBatchObjects[ objectOrder[ next ] ].status == HTTPSuccess )
+        {
+            pBatchObjects[ objectOrder[ next ] ].status = httpStatus;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * downloadThread( void * pArgument )
+{
+    BatchThread_t * pThread = ( BatchThread_t * ) pArgument;
+    const BatchRun_t * pRun = NULL;
+
+    do
+    {
+        pRun = NULL;
+
+        ( void ) pthread_mutex_lock( &batchMutex );
+
+        if( nextRun < runCount )
+        {
+            pRun = &batchRuns[ nextRun ];
+            nextRun++;
+        }
+
+        ( void ) pthread_mutex_unlock( &batchMutex );
+
+        if( pRun != NULL )
+        {
+            downloadRun( pRun, pThread->requestBuffer, pThread->responseBuffer );
+        }
+    } while( pRun != NULL );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+HttpBatchDownloadStatus_t HttpBatchDownload_Run( HttpBatchObject_t * pObjects,
+                                                 size_t objectCount,
+                                                 const char * pRootCaPath,
+                                                 HttpBatchDownloadStats_t * pStats )
+{
+    HttpBatchDownloadStatus_t returnStatus = HTTP_BATCH_DOWNLOAD_SUCCESS;
+    size_t threadCount = 0U, i = 0U;
+    uint32_t startTimeMs = 0U;
+    uint64_t latencySumMs = 0U;
+
+    if( ( pObjects == NULL ) || ( pRootCaPath == NULL ) || ( pStats == NULL ) ||
+        ( objectCount > HTTP_BATCH_DOWNLOAD_MAX_OBJECTS ) )
+    {
+        LogError( ( "Invalid parameter passed to HttpBatchDownload_Run()." ) );
+        returnStatus = HTTP_BATCH_DOWNLOAD_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pStats, 0, sizeof( HttpBatchDownloadStats_t ) );
+        pBatchObjects = pObjects;
+        pServerRootCaPath = pRootCaPath;
+        nextRun = 0U;
+        connectionCount = 0U;
+        pipelinedCount = 0U;
+        startTimeMs = Clock_GetTimeMs();
+
+        groupObjects( pObjects, objectCount );
+
+        LogInfo( ( "Downloading %lu objects in %lu runs.",
+                   ( unsigned long ) objectCount,
+                   ( unsigned long ) runCount ) );
+
+        /* No more threads than runs, each checking out one connection. */
+        while( ( threadCount < HTTP_BATCH_DOWNLOAD_THREAD_COUNT ) && ( threadCount < runCount ) &&
+               ( pthread_create( &batchThreads[ threadCount ].thread, NULL, downloadThread, &batchThreads[ threadCount ] ) == 0 ) )
+        {
+            threadCount++;
+        }
+
+        if( ( threadCount == 0U ) && ( runCount > 0U ) )
+        {
+            LogError( ( "Failed to create a download thread." ) );
+            returnStatus = HTTP_BATCH_DOWNLOAD_NO_MEMORY;
+        }
+
+        for( i = 0U; i < threadCount; i++ )
+        {
+            ( void ) pthread_join( batchThreads[ i ].thread, NULL );
+        }
+    }
+
+    if( returnStatus == HTTP_BATCH_DOWNLOAD_SUCCESS )
+    {
+        pStats->elapsedMs = Clock_GetTimeMs() - startTimeMs;
+        pStats->connectionCount = connectionCount;
+        pStats->pipelinedCount = pipelinedCount;
+
+        for( i = 0U; i < objectCount; i++ )
+        {
+            if( pObjects[ i ].downloaded == true )
+            {
+                if( ( pStats->downloadedCount == 0U ) || ( pObjects[ i ].latencyMs < pStats->minLatencyMs ) )
+                {
+                    pStats->minLatencyMs = pObjects[ i ].latencyMs;
+                }
+
+                if( pObjects[ i ].latencyMs > pStats->maxLatencyMs )
+                {
+                    pStats->maxLatencyMs = pObjects[ i ].latencyMs;
+                }
+
+                pStats->downloadedCount++;
+                pStats->totalBytes += pObjects[ i ].bodyLength;
+                latencySumMs += pObjects[ i ].latencyMs;
+            }
+            else
+            {
+                pStats->failedCount++;
+            }
+        }
+
+        if( pStats->downloadedCount > 0U )
+        {
+            pStats->meanLatencyMs = ( uint32_t ) ( latencySumMs / pStats->downloadedCount );
+        }
+
+        if( pStats->elapsedMs > 0U )
+        {
+            pStats->bytesPerSecond = ( pStats->totalBytes * 1000U ) / pStats->elapsedMs;
+        }
+
+        if( pStats->failedCount > 0U )
+        {
+            returnStatus = HTTP_BATCH_DOWNLOAD_PARTIAL;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
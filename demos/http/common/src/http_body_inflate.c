@@ -0,0 +1,161 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_body_inflate.c
+ * @brief Implementation of the stage decompressing a body as it is received.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the body decompression. */
+#include "http_body_inflate.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Value of the windowBits parameter of inflateInit2 for the largest
+ * window, with the gzip or zlib header detected automatically.
+ */
+#define HTTP_BODY_INFLATE_WINDOW_BITS    ( MAX_WBITS + 32 )
+
+/*-----------------------------------------------------------*/
+
+bool HttpBodyInflate_Init( HttpBodyInflateContext_t * pInflateContext,
+                           HttpBodyStreamCallback_t callback,
+                           void * pCallbackContext )
+{
+    bool returnStatus = false;
+
+    assert( pInflateContext != NULL );
+    assert( callback != NULL );
+
+    ( void ) memset( pInflateContext, 0, sizeof( HttpBodyInflateContext_t ) );
+    pInflateContext->callback = callback;
+    pInflateContext->pCallbackContext = pCallbackContext;
+
+    if( inflateInit2( &pInflateContext->stream, HTTP_BODY_INFLATE_WINDOW_BITS ) == Z_OK )
+    {
+        returnStatus = true;
+    }
+    else
+    {
+        LogError( ( "Failed to initialize zlib." ) );
+        pInflateContext->failed = true;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool HttpBodyInflate_Callback( void * pContext,
+                               uint64_t offset,
+                               const uint8_t * pData,
+                               size_t dataLength )
+{
+    HttpBodyInflateContext_t * pInflateContext = ( HttpBodyInflateContext_t * ) pContext;
+    z_stream * pStream = NULL;
+    size_t outputLength = 0U;
+    int zlibStatus = Z_OK;
+
+    assert( pInflateContext != NULL );
+
+    /* The offset is within the compressed body; the callback is passed
+     * offsets within the decompressed body. */
+    ( void ) offset;
+
+    pStream = &pInflateContext->stream;
+
+    if( ( pInflateContext->failed == false ) && ( pInflateContext->streamEnded == true ) && ( dataLength > 0U ) )
+    {
+        LogError( ( "Received data after the end of the compressed body." ) );
+        pInflateContext->failed = true;
+    }
+
+    /* zlib does not modify the input, but its API is not const. */
+    pStream->next_in = ( Bytef * ) pData;
+    pStream->avail_in = ( uInt ) dataLength;
+
+    /* Decompress the input, one output buffer at a time, until all of it is
+     * consumed and zlib has no output left. */
+    while( ( pInflateContext->failed == false ) && ( pInflateContext->streamEnded == false ) &&
+           ( ( pStream->avail_in > 0U ) || ( pStream->avail_out == 0U ) ) )
+    {
+        pStream->next_out = pInflateContext->output;
+        pStream->avail_out = ( uInt ) sizeof( pInflateContext->output );
+
+        zlibStatus = inflate( pStream, Z_NO_FLUSH );
+        outputLength = sizeof( pInflateContext->output ) - ( size_t ) pStream->avail_out;
+
+        /* Z_BUF_ERROR only means that more input is needed. */
+        if( ( zlibStatus != Z_OK ) && ( zlibStatus != Z_STREAM_END ) && ( zlibStatus != Z_BUF_ERROR ) )
+        {
+            LogError( ( "Failed to decompress the body: %s",
+                        ( pStream->msg != NULL ) ? pStream->msg : "zlib error" ) );
+            pInflateContext->failed = true;
+        }
+        else if( ( outputLength > 0U ) &&
+                 ( pInflateContext->callback( pInflateContext->pCallbackContext,
+                                              pInflateContext->outputLength,
+                                              pInflateContext->output,
+                                              outputLength ) == false ) )
+        {
+            pInflateContext->failed = true;
+        }
+        else
+        {
+            pInflateContext->outputLength += outputLength;
+            pInflateContext->streamEnded = ( zlibStatus == Z_STREAM_END );
+        }
+    }
+
+    /* Nothing may follow the compressed stream. */
+    if( ( pInflateContext->streamEnded == true ) && ( pStream->avail_in > 0U ) )
+    {
+        LogError( ( "Received data after the end of the compressed body." ) );
+        pInflateContext->failed = true;
+    }
+
+    return( pInflateContext->failed == false );
+}
+
+/*-----------------------------------------------------------*/
+
+bool HttpBodyInflate_End( HttpBodyInflateContext_t * pInflateContext )
+{
+    assert( pInflateContext != NULL );
+
+    ( void ) inflateEnd( &pInflateContext->stream );
+
+    if( ( pInflateContext->failed == false ) && ( pInflateContext->streamEnded == false ) )
+    {
+        LogError( ( "The compressed body is truncated." ) );
+    }
+
+    return( ( pInflateContext->failed == false ) && ( pInflateContext->streamEnded == true ) );
+}
@@ -0,0 +1,1209 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_body_stream.c
+ * @brief Implementation of the API to receive the body of an HTTP response
+ * in pieces as it arrives from the transport.
+ *
+ * The request headers are written with the HTTP Client library, but the
+ * response is parsed here: #HTTPClient_Send needs the whole response in its
+ * buffer, while only the status line and headers are kept here.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the body stream. */
+#include "http_body_stream.h"
+
+/* Include clock header for the receive and send retry timeouts. */
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Field name of the HTTP Range header to send in requests.
+ */
+#define HTTP_RANGE_FIELD                    "Range"
+
+/**
+ * @brief Size of a buffer holding the largest value of the HTTP Range header,
+ * including the NULL terminator.
+ */
+#define HTTP_RANGE_VALUE_MAX_LENGTH         ( sizeof( "bytes=18446744073709551615-18446744073709551615" ) )
+
+/**
+ * @brief Line ending of the status line and headers.
+ */
+#define HTTP_LINE_ENDING                    "\r\n"
+
+/**
+ * @brief Separator between the headers and the body of a response.
+ */
+#define HTTP_HEADERS_END                    "\r\n\r\n"
+
+/**
+ * @brief Length of #HTTP_HEADERS_END.
+ */
+#define HTTP_HEADERS_END_LENGTH             ( sizeof( HTTP_HEADERS_END ) - 1U )
+
+/**
+ * @brief Beginning of the status line of HTTP/1.x responses.
+ */
+#define HTTP_STATUS_LINE_PREFIX             "HTTP/1."
+
+/**
+ * @brief Length of #HTTP_STATUS_LINE_PREFIX.
+ */
+#define HTTP_STATUS_LINE_PREFIX_LENGTH      ( sizeof( HTTP_STATUS_LINE_PREFIX ) - 1U )
+
+/**
+ * @brief Field names of the response headers read to receive the body.
+ */
+#define HTTP_CONTENT_LENGTH_FIELD           "Content-Length"
+#define HTTP_CONNECTION_FIELD               "Connection"
+#define HTTP_TRANSFER_ENCODING_FIELD        "Transfer-Encoding"
+#define HTTP_CONTENT_RANGE_FIELD            "Content-Range"
+
+/**
+ * @brief Unit of the Content-Range header, as in "bytes 0-1023/4096".
+ */
+#define HTTP_CONTENT_RANGE_UNIT             "bytes "
+
+/**
+ * @brief Status code of the response to a request for a range.
+ */
+#define HTTP_STATUS_PARTIAL_CONTENT         ( 206U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Context of #receiveRangeBody, passing the body of a range to the
+ * callback of #HttpBodyStream_GetRanges with its position in the object.
+ */
+typedef struct RangeBodyContext
+{
+    HttpBodyStreamCallback_t bodyCallback; /**< @brief Callback of #HttpBodyStream_GetRanges. */
+    void * pContext;                       /**< @brief Context of @p bodyCallback. */
+    uint64_t rangeStart;                   /**< @brief Position of the range in the object. */
+} RangeBodyContext_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the whole request headers over the transport.
+ *
+ * @param[in] pTransportInterface The transport interface.
+ * @param[in] pData The request headers.
+ * @param[in] dataLength The length of @p pData.
+ *
+ * @return #HTTPSuccess if all bytes were sent; #HTTPNetworkError otherwise.
+ */
+static HTTPStatus_t sendAll( const TransportInterface_t * pTransportInterface,
+                             const uint8_t * pData,
+                             size_t dataLength );
+
+/**
+ * @brief Receive from the transport until the end of the response headers.
+ *
+ * @param[in] pTransportInterface The transport interface.
+ * @param[in] pBuffer The buffer receiving the response.
+ * @param[in] bufferLen The length of @p pBuffer.
+ * @param[in] bufferedLength Bytes of the response already at the start of
+ * @p pBuffer, received with the end of the previous response.
+ * @param[out] pReceivedLength Bytes received into @p pBuffer, which may
+ * include the beginning of the body.
+ * @param[out] pHeadersLength Length of the status line and headers,
+ * including the empty line ending them.
+ *
+ * @return #HTTPSuccess, #HTTPInsufficientMemory, #HTTPNetworkError,
+ * #HTTPNoResponse or #HTTPPartialResponse.
+ */
+static HTTPStatus_t receiveHeaders( const TransportInterface_t * pTransportInterface,
+                                    uint8_t * pBuffer,
+                                    size_t bufferLen,
+                                    size_t bufferedLength,
+                                    size_t * pReceivedLength,
+                                    size_t * pHeadersLength );
+
+/**
+ * @brief Check whether a header has the given field name.
+ *
+ * @param[in] pLine The header line.
+ * @param[in] lineLength The length of @p pLine, without the line ending.
+ * @param[in] pField The field name.
+ * @param[out] pValue The value of the header, without leading spaces.
+ * @param[out] pValueLength The length of @p pValue.
+ *
+ * @return true if the header has the field name; false otherwise.
+ */
+static bool matchHeader( const char * pLine,
+                         size_t lineLength,
+                         const char * pField,
+                         const char ** pValue,
+                         size_t * pValueLength );
+
+/**
+ * @brief Check whether a header value contains a token, ignoring case.
+ *
+ * @param[in] pValue The header value.
+ * @param[in] valueLength The length of @p pValue.
+ * @param[in] pToken The token, such as "close".
+ *
+ * @return true if @p pValue contains @p pToken; false otherwise.
+ */
+static bool valueContains( const char * pValue,
+                           size_t valueLength,
+                           const char * pToken );
+
+/**
+ * @brief Read a decimal number from a header value.
+ *
+ * @param[in] pValue The header value.
+ * @param[in] valueLength The length of @p pValue.
+ * @param[in,out] pIndex Position of the number in @p pValue, then of the
+ * character following it.
+ * @param[out] pNumber The number.
+ *
+ * @return true if at least one digit was read without overflow; false
+ * otherwise.
+ */
+static bool readDecimal( const char * pValue,
+                         size_t valueLength,
+                         size_t * pIndex,
+                         uint64_t * pNumber );
+
+/**
+ * @brief Parse a Content-Range header, "bytes first-last/complete".
+ *
+ * A range with an unknown complete length ("*") or an unsatisfied range
+ * leaves the positions of @p pResponse at 0.
+ *
+ * @param[in] pValue The header value.
+ * @param[in] valueLength The length of @p pValue.
+ * @param[out] pResponse The first position of the range and the length of
+ * the object.
+ */
+static void parseContentRange( const char * pValue,
+                               size_t valueLength,
+                               HttpBodyStreamResponse_t * pResponse );
+
+/**
+ * @brief Parse the status line and the headers needed to receive the body.
+ *
+ * @param[in] pHeaders The status line and headers.
+ * @param[in] headersLength The length of @p pHeaders.
+ * @param[out] pResponse The status code, content length and connection close
+ * flag of the response.
+ *
+ * @return #HTTPSuccess or #HTTPInvalidResponse.
+ */
+static HTTPStatus_t parseHeaders( const char * pHeaders,
+                                  size_t headersLength,
+                                  HttpBodyStreamResponse_t * pResponse );
+
+/**
+ * @brief Receive the body of the response and pass it to the callback.
+ *
+ * @param[in] pTransportInterface The transport interface.
+ * @param[in] pBuffer The buffer receiving the body, which starts with the
+ * bytes of the body received with the headers.
+ * @param[in] bufferLen The length of @p pBuffer.
+ * @param[in] bufferedLength The bytes received with the headers.
+ * @param[in] bodyCallback Callback receiving the body, or NULL to discard it.
+ * @param[in] pContext Context passed to @p bodyCallback.
+ * @param[in,out] pResponse The response, with the length of the body
+ * received.
+ * @param[out] pExtraLength Bytes received after the end of the body, moved to
+ * the start of @p pBuffer, or NULL to ignore them.
+ *
+ * @return #HTTPSuccess, #HTTPNetworkError or #HTTPPartialResponse.
+ */
+static HTTPStatus_t receiveBody( const TransportInterface_t * pTransportInterface,
+                                 uint8_t * pBuffer,
+                                 size_t bufferLen,
+                                 size_t bufferedLength,
+                                 HttpBodyStreamCallback_t bodyCallback,
+                                 void * pContext,
+                                 HttpBodyStreamResponse_t * pResponse,
+                                 size_t * pExtraLength );
+
+/**
+ * @brief Callback of #receiveBody for the body of a range, passing it to the
+ * callback of #HttpBodyStream_GetRanges with its position in the object.
+ *
+ * @param[in] pContext The #RangeBodyContext_t of the range.
+ * @param[in] offset Position of @p pData within the body of the range.
+ * @param[in] pData The next bytes of the body.
+ * @param[in] dataLength The length of @p pData.
+ *
+ * @return The value returned by the callback of #HttpBodyStream_GetRanges.
+ */
+static bool receiveRangeBody( void * pContext,
+                              uint64_t offset,
+                              const uint8_t * pData,
+                              size_t dataLength );
+
+/**
+ * @brief Send the request for the next range of #HttpBodyStream_GetRanges.
+ *
+ * @param[in] pTransportInterface The transport interface.
+ * @param[in] pRequestTemplate The request template.
+ * @param[in,out] pRangeStart Position of the range, then of the next one.
+ * @param[in] rangeLength The length of the range.
+ * @param[in] objectLength The length of the object, which ends the last
+ * range, or #HTTP_BODY_STREAM_END_OF_OBJECT until it is known.
+ *
+ * @return #HTTPSuccess, #HTTPInvalidParameter or #HTTPNetworkError.
+ */
+static HTTPStatus_t sendRange( const TransportInterface_t * pTransportInterface,
+                               HttpRequestTemplate_t * pRequestTemplate,
+                               uint64_t * pRangeStart,
+                               uint64_t rangeLength,
+                               uint64_t objectLength );
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t sendAll( const TransportInterface_t * pTransportInterface,
+                             const uint8_t * pData,
+                             size_t dataLength )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    size_t bytesSent = 0U;
+    int32_t sendResult = 0;
+    uint32_t lastSendTimeMs = Clock_GetTimeMs();
+
+    while( ( returnStatus == HTTPSuccess ) && ( bytesSent < dataLength ) )
+    {
+        sendResult = pTransportInterface->send( pTransportInterface->pNetworkContext,
+                                                &pData[ bytesSent ],
+                                                dataLength - bytesSent );
+
+        if( sendResult > 0 )
+        {
+            bytesSent += ( size_t ) sendResult;
+            lastSendTimeMs = Clock_GetTimeMs();
+        }
+        else if( ( sendResult < 0 ) ||
+                 ( ( Clock_GetTimeMs() - lastSendTimeMs ) > HTTP_BODY_STREAM_SEND_RETRY_TIMEOUT_MS ) )
+        {
+            LogError( ( "Failed to send the request headers: SendResult=%ld.",
+                        ( long int ) sendResult ) );
+            returnStatus = HTTPNetworkError;
+        }
+        else
+        {
+            /* Retry sending. */
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t receiveHeaders( const TransportInterface_t * pTransportInterface,
+                                    uint8_t * pBuffer,
+                                    size_t bufferLen,
+                                    size_t bufferedLength,
+                                    size_t * pReceivedLength,
+                                    size_t * pHeadersLength )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    size_t receivedLength = bufferedLength, searchStart = 0U, i = 0U;
+    int32_t recvResult = 0;
+    uint32_t lastRecvTimeMs = Clock_GetTimeMs();
+    bool headersComplete = false;
+
+    while( ( returnStatus == HTTPSuccess ) && ( headersComplete == false ) )
+    {
+        /* Search the new bytes, with the end of the previous ones in case the
+         * separator was split between two receives. The bytes buffered from
+         * the previous response may already hold the whole headers. */
+        for( i = searchStart;
+             ( headersComplete == false ) && ( ( i + HTTP_HEADERS_END_LENGTH ) <= receivedLength );
+             i++ )
+        {
+            if( memcmp( &pBuffer[ i ], HTTP_HEADERS_END, HTTP_HEADERS_END_LENGTH ) == 0 )
+            {
+                *pHeadersLength = i + HTTP_HEADERS_END_LENGTH;
+                headersComplete = true;
+            }
+        }
+
+        searchStart = i;
+
+        if( headersComplete == true )
+        {
+            /* Empty else MISRA 15.7 */
+        }
+        else if( receivedLength == bufferLen )
+        {
+            LogError( ( "Response headers do not fit in the buffer: BufferLen=%lu.",
+                        ( unsigned long ) bufferLen ) );
+            returnStatus = HTTPInsufficientMemory;
+        }
+        else
+        {
+            recvResult = pTransportInterface->recv( pTransportInterface->pNetworkContext,
+                                                    &pBuffer[ receivedLength ],
+                                                    bufferLen - receivedLength );
+
+            if( recvResult > 0 )
+            {
+                receivedLength += ( size_t ) recvResult;
+                lastRecvTimeMs = Clock_GetTimeMs();
+            }
+            else if( recvResult < 0 )
+            {
+                LogError( ( "Failed to receive the response: RecvResult=%ld.",
+                            ( long int ) recvResult ) );
+                returnStatus = HTTPNetworkError;
+            }
+            else if( ( Clock_GetTimeMs() - lastRecvTimeMs ) > HTTP_BODY_STREAM_RECV_RETRY_TIMEOUT_MS )
+            {
+                LogError( ( "Timed out receiving the response headers." ) );
+                returnStatus = ( receivedLength == 0U ) ? HTTPNoResponse : HTTPPartialResponse;
+            }
+            else
+            {
+                /* Retry receiving. */
+            }
+        }
+    }
+
+    *pReceivedLength = receivedLength;
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool matchHeader( const char * pLine,
+                         size_t lineLength,
+                         const char * pField,
+                         const char ** pValue,
+                         size_t * pValueLength )
+{
+    bool matches = false;
+    size_t fieldLength = strlen( pField );
+    size_t valueStart = fieldLength + 1U;
+
+    /* Field names are case insensitive. */
+    if( ( lineLength > fieldLength ) &&
+        ( pLine[ fieldLength ] == ':' ) &&
+        ( strncasecmp( pLine, pField, fieldLength ) == 0 ) )
+    {
+        while( ( valueStart < lineLength ) &&
+               ( ( pLine[ valueStart ] == ' ' ) || ( pLine[ valueStart ] == '\t' ) ) )
+        {
+            valueStart++;
+        }
+
+        *pValue = &pLine[ valueStart ];
+        *pValueLength = lineLength - valueStart;
+        matches = true;
+    }
+
+    return matches;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool valueContains( const char * pValue,
+                           size_t valueLength,
+                           const char * pToken )
+{
+    bool contains = false;
+    size_t tokenLength = strlen( pToken );
+    size_t i = 0U;
+
+    for( i = 0U; ( contains == false ) && ( ( i + tokenLength ) <= valueLength ); i++ )
+    {
+        contains = ( strncasecmp( &pValue[ i ], pToken, tokenLength ) == 0 );
+    }
+
+    return contains;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool readDecimal( const char * pValue,
+                         size_t valueLength,
+                         size_t * pIndex,
+                         uint64_t * pNumber )
+{
+    size_t i = *pIndex;
+    bool valid = true;
+
+    *pNumber = 0U;
+
+    while( ( valid == true ) && ( i < valueLength ) &&
+           ( pValue[ i ] >= '0' ) && ( pValue[ i ] <= '9' ) )
+    {
+        if( *pNumber <= ( ( UINT64_MAX - 9U ) / 10U ) )
+        {
+            *pNumber = ( *pNumber * 10U ) + ( uint64_t ) ( pValue[ i ] - '0' );
+            i++;
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    valid = ( valid == true ) && ( i > *pIndex );
+    *pIndex = i;
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static void parseContentRange( const char * pValue,
+                               size_t valueLength,
+                               HttpBodyStreamResponse_t * pResponse )
+{
+    size_t i = sizeof( HTTP_CONTENT_RANGE_UNIT ) - 1U;
+    uint64_t first = 0U, last = 0U, complete = 0U;
+    bool valid = false;
+
+    if( ( valueLength > i ) &&
+        ( strncmp( pValue, HTTP_CONTENT_RANGE_UNIT, i ) == 0 ) &&
+        ( readDecimal( pValue, valueLength, &i, &first ) == true ) &&
+        ( i < valueLength ) && ( pValue[ i ] == '-' ) )
+    {
+        i++;
+
+        if( ( readDecimal( pValue, valueLength, &i, &last ) == true ) &&
+            ( i < valueLength ) && ( pValue[ i ] == '/' ) )
+        {
+            i++;
+            valid = ( readDecimal( pValue, valueLength, &i, &complete ) == true ) &&
+                    ( first <= last ) && ( last < complete );
+        }
+    }
+
+    if( valid == true )
+    {
+        pResponse->rangeStart = first;
+        pResponse->objectLength = complete;
+    }
+    else
+    {
+        LogDebug( ( "Content-Range without the complete length: %.*s.",
+                    ( int ) valueLength,
+                    pValue ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t parseHeaders( const char * pHeaders,
+                                  size_t headersLength,
+                                  HttpBodyStreamResponse_t * pResponse )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    const char * pLine = pHeaders;
+    const char * pLineEnd = NULL;
+    const char * pValue = NULL;
+    size_t lineLength = 0U, valueLength = 0U, i = 0U;
+    bool hasContentLength = false;
+
+    /* The status line is "HTTP/1.x SSS Reason". */
+    if( ( headersLength < ( HTTP_STATUS_LINE_PREFIX_LENGTH + 5U ) ) ||
+        ( strncmp( pHeaders, HTTP_STATUS_LINE_PREFIX, HTTP_STATUS_LINE_PREFIX_LENGTH ) != 0 ) ||
+        ( pHeaders[ HTTP_STATUS_LINE_PREFIX_LENGTH + 1U ] != ' ' ) )
+    {
+        LogError( ( "Response does not start with an HTTP/1.x status line." ) );
+        returnStatus = HTTPInvalidResponse;
+    }
+    else
+    {
+        /* HTTP/1.0 servers close the connection after each response. */
+        pResponse->connectionClose = ( pHeaders[ HTTP_STATUS_LINE_PREFIX_LENGTH ] == '0' );
+
+        for( i = HTTP_STATUS_LINE_PREFIX_LENGTH + 2U;
+             ( returnStatus == HTTPSuccess ) && ( i < ( HTTP_STATUS_LINE_PREFIX_LENGTH + 5U ) );
+             i++ )
+        {
+            if( ( pHeaders[ i ] < '0' ) || ( pHeaders[ i ] > '9' ) )
+            {
+                LogError( ( "Response has an invalid status code." ) );
+                returnStatus = HTTPInvalidResponse;
+            }
+            else
+            {
+                pResponse->statusCode = ( uint16_t ) ( ( pResponse->statusCode * 10U ) +
+                                                       ( uint16_t ) ( pHeaders[ i ] - '0' ) );
+            }
+        }
+    }
+
+    /* Parse each header line, up to the empty line ending the headers. */
+    while( ( returnStatus == HTTPSuccess ) && ( pLine < &pHeaders[ headersLength ] ) )
+    {
+        /* Every line ends before the end of the headers, which are not NULL
+         * terminated. */
+        pLineEnd = pLine;
+
+        while( strncmp( pLineEnd, HTTP_LINE_ENDING, sizeof( HTTP_LINE_ENDING ) - 1U ) != 0 )
+        {
+            pLineEnd++;
+        }
+
+        lineLength = ( size_t ) ( pLineEnd - pLine );
+
+        if( matchHeader( pLine, lineLength, HTTP_CONTENT_LENGTH_FIELD, &pValue, &valueLength ) == true )
+        {
+            pResponse->contentLength = 0U;
+            hasContentLength = ( valueLength > 0U );
+
+            for( i = 0U; ( hasContentLength == true ) && ( i < valueLength ); i++ )
+            {
+                if( ( pValue[ i ] >= '0' ) && ( pValue[ i ] <= '9' ) &&
+                    ( pResponse->contentLength <= ( ( UINT64_MAX - 9U ) / 10U ) ) )
+                {
+                    pResponse->contentLength = ( pResponse->contentLength * 10U ) +
+                                               ( uint64_t ) ( pValue[ i ] - '0' );
+                }
+                else if( ( pValue[ i ] == ' ' ) || ( pValue[ i ] == '\t' ) )
+                {
+                    /* Trailing whitespace. */
+                }
+                else
+                {
+                    hasContentLength = false;
+                }
+            }
+
+            if( hasContentLength == false )
+            {
+                LogError( ( "Response has an invalid Content-Length: %.*s.",
+                            ( int ) valueLength,
+                            pValue ) );
+                returnStatus = HTTPInvalidResponse;
+            }
+        }
+        else if( matchHeader( pLine, lineLength, HTTP_CONNECTION_FIELD, &pValue, &valueLength ) == true )
+        {
+            if( valueContains( pValue, valueLength, "close" ) == true )
+            {
+                pResponse->connectionClose = true;
+            }
+            else if( valueContains( pValue, valueLength, "keep-alive" ) == true )
+            {
+                pResponse->connectionClose = false;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+        else if( matchHeader( pLine, lineLength, HTTP_TRANSFER_ENCODING_FIELD, &pValue, &valueLength ) == true )
+        {
+            LogError( ( "Responses with Transfer-Encoding are not supported: %.*s.",
+                        ( int ) valueLength,
+                        pValue ) );
+            returnStatus = HTTPInvalidResponse;
+        }
+        else if( matchHeader( pLine, lineLength, HTTP_CONTENT_RANGE_FIELD, &pValue, &valueLength ) == true )
+        {
+            parseContentRange( pValue, valueLength, pResponse );
+        }
+        else
+        {
+            /* Other headers are not needed to receive the body. */
+        }
+
+        pLine = &pLineEnd[ sizeof( HTTP_LINE_ENDING ) - 1U ];
+
+        /* The empty line ending the headers. */
+        if( strncmp( pLine, HTTP_LINE_ENDING, sizeof( HTTP_LINE_ENDING ) - 1U ) == 0 )
+        {
+            pLine = &pHeaders[ headersLength ];
+        }
+    }
+
+    if( ( returnStatus == HTTPSuccess ) && ( hasContentLength == false ) )
+    {
+        /* Informational, "No Content" and "Not Modified" responses have no
+         * body. Any other would be delimited by closing the connection. */
+        if( ( pResponse->statusCode < 200U ) ||
+            ( pResponse->statusCode == 204U ) ||
+            ( pResponse->statusCode == 304U ) )
+        {
+            pResponse->contentLength = 0U;
+        }
+        else
+        {
+            LogError( ( "Response has no Content-Length header." ) );
+            returnStatus = HTTPInvalidResponse;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t receiveBody( const TransportInterface_t * pTransportInterface,
+                                 uint8_t * pBuffer,
+                                 size_t bufferLen,
+                                 size_t bufferedLength,
+                                 HttpBodyStreamCallback_t bodyCallback,
+                                 void * pContext,
+                                 HttpBodyStreamResponse_t * pResponse,
+                                 size_t * pExtraLength )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    size_t dataLength = bufferedLength, extraLength = 0U;
+    uint64_t remainingLength = 0U;
+    int32_t recvResult = 0;
+    uint32_t lastRecvTimeMs = Clock_GetTimeMs();
+
+    if( pResponse->contentLength == 0U )
+    {
+        /* All bytes received with the headers are of the next response. */
+        extraLength = bufferedLength;
+    }
+
+    while( ( returnStatus == HTTPSuccess ) && ( pResponse->bodyLength < pResponse->contentLength ) )
+    {
+        remainingLength = pResponse->contentLength - pResponse->bodyLength;
+
+        if( dataLength == 0U )
+        {
+            /* Reuse the whole buffer for the next bytes of the body, without
+             * receiving the beginning of a pipelined response. */
+            recvResult = pTransportInterface->recv( pTransportInterface->pNetworkContext,
+                                                    pBuffer,
+                                                    ( remainingLength < bufferLen ) ?
+                                                    ( size_t ) remainingLength : bufferLen );
+
+            if( recvResult > 0 )
+            {
+                dataLength = ( size_t ) recvResult;
+                lastRecvTimeMs = Clock_GetTimeMs();
+            }
+            else if( recvResult < 0 )
+            {
+                LogError( ( "Failed to receive the response body: RecvResult=%ld.",
+                            ( long int ) recvResult ) );
+                returnStatus = HTTPNetworkError;
+            }
+            else if( ( Clock_GetTimeMs() - lastRecvTimeMs ) > HTTP_BODY_STREAM_RECV_RETRY_TIMEOUT_MS )
+            {
+                LogError( ( "Timed out receiving the response body: Received=%llu, ContentLength=%llu.",
+                            ( unsigned long long ) pResponse->bodyLength,
+                            ( unsigned long long ) pResponse->contentLength ) );
+                returnStatus = HTTPPartialResponse;
+            }
+            else
+            {
+                /* Retry receiving. */
+            }
+        }
+
+        if( dataLength > 0U )
+        {
+            if( dataLength > remainingLength )
+            {
+                /* Bytes of a response the server sent ahead, which only the
+                 * first receive with the headers can hold. */
+                extraLength = dataLength - ( size_t ) remainingLength;
+                dataLength = ( size_t ) remainingLength;
+            }
+
+            if( ( bodyCallback != NULL ) &&
+                ( bodyCallback( pContext, pResponse->bodyLength, pBuffer, dataLength ) == false ) )
+            {
+                LogWarn( ( "Body callback stopped the response after %llu bytes.",
+                           ( unsigned long long ) pResponse->bodyLength ) );
+                returnStatus = HTTPPartialResponse;
+            }
+            else
+            {
+                pResponse->bodyLength += dataLength;
+
+                if( ( pExtraLength != NULL ) && ( extraLength > 0U ) )
+                {
+                    ( void ) memmove( pBuffer, &pBuffer[ dataLength ], extraLength );
+                }
+
+                dataLength = 0U;
+            }
+        }
+    }
+
+    if( pExtraLength != NULL )
+    {
+        *pExtraLength = ( returnStatus == HTTPSuccess ) ? extraLength : 0U;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveRangeBody( void * pContext,
+                              uint64_t offset,
+                              const uint8_t * pData,
+                              size_t dataLength )
+{
+    const RangeBodyContext_t * pRangeContext = ( const RangeBodyContext_t * ) pContext;
+
+    return pRangeContext->bodyCallback( pRangeContext->pContext,
+                                        pRangeContext->rangeStart + offset,
+                                        pData,
+                                        dataLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t sendRange( const TransportInterface_t * pTransportInterface,
+                               HttpRequestTemplate_t * pRequestTemplate,
+                               uint64_t * pRangeStart,
+                               uint64_t rangeLength,
+                               uint64_t objectLength )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    uint64_t length = rangeLength;
+
+    /* The last range ends with the object, which also keeps the end of a
+     * range from overflowing. */
+    if( ( objectLength - *pRangeStart ) < length )
+    {
+        length = objectLength - *pRangeStart;
+    }
+
+    returnStatus = HttpRequestTemplate_SetRange( pRequestTemplate,
+                                                 *pRangeStart,
+                                                 *pRangeStart + length - 1U );
+
+    if( returnStatus == HTTPSuccess )
+    {
+        LogDebug( ( "Request Headers:\n%.*s",
+                    ( int32_t ) pRequestTemplate->headers.headersLen,
+                    ( char * ) pRequestTemplate->headers.pBuffer ) );
+
+        returnStatus = sendAll( pTransportInterface,
+                                pRequestTemplate->headers.pBuffer,
+                                pRequestTemplate->headers.headersLen );
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        *pRangeStart += length;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpBodyStream_Get( const TransportInterface_t * pTransportInterface,
+                                 const HTTPRequestInfo_t * pRequestInfo,
+                                 uint64_t rangeStart,
+                                 uint64_t rangeEnd,
+                                 uint8_t * pBuffer,
+                                 size_t bufferLen,
+                                 HttpBodyStreamCallback_t bodyCallback,
+                                 void * pContext,
+                                 HttpBodyStreamResponse_t * pResponse )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    HTTPRequestHeaders_t requestHeaders;
+    char rangeValue[ HTTP_RANGE_VALUE_MAX_LENGTH ];
+    int rangeValueLength = 0;
+    size_t receivedLength = 0U, headersLength = 0U;
+    HttpBodyStreamCallback_t responseCallback = NULL;
+
+    if( ( pTransportInterface == NULL ) || ( pTransportInterface->send == NULL ) ||
+        ( pTransportInterface->recv == NULL ) || ( pRequestInfo == NULL ) ||
+        ( pBuffer == NULL ) || ( bodyCallback == NULL ) || ( pResponse == NULL ) )
+    {
+        LogError( ( "NULL parameter passed to HttpBodyStream_Get()." ) );
+        returnStatus = HTTPInvalidParameter;
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        ( void ) memset( pResponse, 0, sizeof( HttpBodyStreamResponse_t ) );
+        ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+        requestHeaders.pBuffer = pBuffer;
+        requestHeaders.bufferLen = bufferLen;
+
+        returnStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders, pRequestInfo );
+    }
+
+    if( ( returnStatus == HTTPSuccess ) &&
+        ( ( rangeStart != 0U ) || ( rangeEnd != HTTP_BODY_STREAM_END_OF_OBJECT ) ) )
+    {
+        /* HTTPClient_AddRangeHeader takes 32-bit positions, which cannot
+         * address objects larger than 2 GiB, so the header is written here. */
+        if( rangeEnd == HTTP_BODY_STREAM_END_OF_OBJECT )
+        {
+            rangeValueLength = snprintf( rangeValue, sizeof( rangeValue ), "bytes=%llu-",
+                                         ( unsigned long long ) rangeStart );
+        }
+        else
+        {
+            rangeValueLength = snprintf( rangeValue, sizeof( rangeValue ), "bytes=%llu-%llu",
+                                         ( unsigned long long ) rangeStart,
+                                         ( unsigned long long ) rangeEnd );
+        }
+
+        assert( ( rangeValueLength > 0 ) && ( ( size_t ) rangeValueLength < sizeof( rangeValue ) ) );
+
+        returnStatus = HTTPClient_AddHeader( &requestHeaders,
+                                             HTTP_RANGE_FIELD,
+                                             sizeof( HTTP_RANGE_FIELD ) - 1U,
+                                             rangeValue,
+                                             ( size_t ) rangeValueLength );
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        LogDebug( ( "Request Headers:\n%.*s",
+                    ( int32_t ) requestHeaders.headersLen,
+                    ( char * ) requestHeaders.pBuffer ) );
+
+        returnStatus = sendAll( pTransportInterface, pBuffer, requestHeaders.headersLen );
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        returnStatus = receiveHeaders( pTransportInterface,
+                                       pBuffer,
+                                       bufferLen,
+                                       0U,
+                                       &receivedLength,
+                                       &headersLength );
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        LogDebug( ( "Response Headers:\n%.*s",
+                    ( int32_t ) headersLength,
+                    ( char * ) pBuffer ) );
+
+        returnStatus = parseHeaders( ( const char * ) pBuffer, headersLength, pResponse );
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        /* Only the body of successful responses is the requested object. */
+        if( ( pResponse->statusCode >= 200U ) && ( pResponse->statusCode < 300U ) )
+        {
+            responseCallback = bodyCallback;
+        }
+
+        /* Move the beginning of the body received with the headers to the
+         * start of the buffer. */
+        ( void ) memmove( pBuffer, &pBuffer[ headersLength ], receivedLength - headersLength );
+
+        returnStatus = receiveBody( pTransportInterface,
+                                    pBuffer,
+                                    bufferLen,
+                                    receivedLength - headersLength,
+                                    responseCallback,
+                                    pContext,
+                                    pResponse,
+                                    NULL );
+    }
+
+    if( ( returnStatus != HTTPSuccess ) && ( pResponse != NULL ) )
+    {
+        /* Part of the response may be left unread on the connection. */
+        pResponse->connectionClose = true;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpBodyStream_Send( const TransportInterface_t * pTransportInterface,
+                                  const HTTPRequestHeaders_t * pRequestHeaders )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+
+    if( ( pTransportInterface == NULL ) || ( pTransportInterface->send == NULL ) ||
+        ( pRequestHeaders == NULL ) || ( pRequestHeaders->pBuffer == NULL ) )
+    {
+        LogError( ( "NULL parameter passed to HttpBodyStream_Send()." ) );
+        returnStatus = HTTPInvalidParameter;
+    }
+    else
+    {
+        LogDebug( ( "Request Headers:\n%.*s",
+                    ( int32_t ) pRequestHeaders->headersLen,
+                    ( char * ) pRequestHeaders->pBuffer ) );
+
+        returnStatus = sendAll( pTransportInterface,
+                                pRequestHeaders->pBuffer,
+                                pRequestHeaders->headersLen );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpBodyStream_Receive( const TransportInterface_t * pTransportInterface,
+                                     uint8_t * pBuffer,
+                                     size_t bufferLen,
+                                     size_t * pBufferedLength,
+                                     HttpBodyStreamCallback_t bodyCallback,
+                                     void * pContext,
+                                     HttpBodyStreamResponse_t * pResponse )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    size_t receivedLength = 0U, headersLength = 0U;
+    HttpBodyStreamCallback_t responseCallback = NULL;
+
+    if( ( pTransportInterface == NULL ) || ( pTransportInterface->recv == NULL ) ||
+        ( pBuffer == NULL ) || ( pBufferedLength == NULL ) || ( *pBufferedLength > bufferLen ) ||
+        ( bodyCallback == NULL ) || ( pResponse == NULL ) )
+    {
+        LogError( ( "Invalid parameter passed to HttpBodyStream_Receive()." ) );
+        returnStatus = HTTPInvalidParameter;
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        ( void ) memset( pResponse, 0, sizeof( HttpBodyStreamResponse_t ) );
+
+        returnStatus = receiveHeaders( pTransportInterface,
+                                       pBuffer,
+                                       bufferLen,
+                                       *pBufferedLength,
+                                       &receivedLength,
+                                       &headersLength );
+        *pBufferedLength = 0U;
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        LogDebug( ( "Response Headers:\n%.*s",
+                    ( int32_t ) headersLength,
+                    ( char * ) pBuffer ) );
+
+        returnStatus = parseHeaders( ( const char * ) pBuffer, headersLength, pResponse );
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        if( ( pResponse->statusCode >= 200U ) && ( pResponse->statusCode < 300U ) )
+        {
+            responseCallback = bodyCallback;
+        }
+
+        ( void ) memmove( pBuffer, &pBuffer[ headersLength ], receivedLength - headersLength );
+
+        returnStatus = receiveBody( pTransportInterface,
+                                    pBuffer,
+                                    bufferLen,
+                                    receivedLength - headersLength,
+                                    responseCallback,
+                                    pContext,
+                                    pResponse,
+                                    pBufferedLength );
+    }
+
+    if( ( returnStatus != HTTPSuccess ) && ( pResponse != NULL ) )
+    {
+        /* Part of the response, and the responses pipelined after it, may be
+         * left unread on the connection. */
+        pResponse->connectionClose = true;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpBodyStream_GetRanges( const TransportInterface_t * pTransportInterface,
+                                       HttpRequestTemplate_t * pRequestTemplate,
+                                       uint64_t startOffset,
+                                       uint64_t rangeLength,
+                                       size_t pipelineDepth,
+                                       uint8_t * pBuffer,
+                                       size_t bufferLen,
+                                       HttpBodyStreamCallback_t bodyCallback,
+                                       void * pContext,
+                                       HttpBodyStreamResponse_t * pResponse )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    HttpBodyStreamResponse_t rangeResponse;
+    RangeBodyContext_t rangeContext;
+    uint64_t requestStart = startOffset, responseStart = startOffset;
+    uint64_t objectLength = HTTP_BODY_STREAM_END_OF_OBJECT;
+    size_t inFlight = 0U, bufferedLength = 0U, receivedLength = 0U, headersLength = 0U;
+
+    if( ( pTransportInterface == NULL ) || ( pTransportInterface->send == NULL ) ||
+        ( pTransportInterface->recv == NULL ) || ( pRequestTemplate == NULL ) ||
+        ( pRequestTemplate->rangeOffset == 0U ) || ( rangeLength == 0U ) ||
+        ( pipelineDepth == 0U ) || ( pBuffer == NULL ) || ( bodyCallback == NULL ) ||
+        ( pResponse == NULL ) )
+    {
+        LogError( ( "Invalid parameter passed to HttpBodyStream_GetRanges()." ) );
+        returnStatus = HTTPInvalidParameter;
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        ( void ) memset( pResponse, 0, sizeof( HttpBodyStreamResponse_t ) );
+        rangeContext.bodyCallback = bodyCallback;
+        rangeContext.pContext = pContext;
+
+        /* Only the first range is requested until its response gives the
+         * length of the object, so that no request is past its end. */
+        returnStatus = sendRange( pTransportInterface,
+                                  pRequestTemplate,
+                                  &requestStart,
+                                  rangeLength,
+                                  objectLength );
+        inFlight = 1U;
+    }
+
+    while( ( returnStatus == HTTPSuccess ) && ( inFlight > 0U ) )
+    {
+        ( void ) memset( &rangeResponse, 0, sizeof( rangeResponse ) );
+
+        returnStatus = receiveHeaders( pTransportInterface,
+                                       pBuffer,
+                                       bufferLen,
+                                       bufferedLength,
+                                       &receivedLength,
+                                       &headersLength );
+
+        if( returnStatus == HTTPSuccess )
+        {
+            LogDebug( ( "Response Headers:\n%.*s",
+                        ( int32_t ) headersLength,
+                        ( char * ) pBuffer ) );
+
+            returnStatus = parseHeaders( ( const char * ) pBuffer, headersLength, &rangeResponse );
+        }
+
+        if( returnStatus == HTTPSuccess )
+        {
+            pResponse->statusCode = rangeResponse.statusCode;
+            pResponse->contentLength = rangeResponse.contentLength;
+
+            if( ( rangeResponse.statusCode != HTTP_STATUS_PARTIAL_CONTENT ) ||
+                ( rangeResponse.rangeStart != responseStart ) ||
+                ( rangeResponse.objectLength == 0U ) )
+            {
+                LogError( ( "Response is not the range at %llu: StatusCode=%u, RangeStart=%llu.",
+                            ( unsigned long long ) responseStart,
+                            ( unsigned int ) rangeResponse.statusCode,
+                            ( unsigned long long ) rangeResponse.rangeStart ) );
+                returnStatus = HTTPInvalidResponse;
+            }
+            else
+            {
+                objectLength = rangeResponse.objectLength;
+                pResponse->objectLength = objectLength;
+            }
+        }
+
+        /* Keep the pipeline full before receiving the body, so the server
+         * has the next requests while it sends this response. Requests sent
+         * after a "Connection: close" would not be answered. */
+        while( ( returnStatus == HTTPSuccess ) && ( inFlight < pipelineDepth ) &&
+               ( requestStart < objectLength ) && ( rangeResponse.connectionClose == false ) )
+        {
+            returnStatus = sendRange( pTransportInterface,
+                                      pRequestTemplate,
+                                      &requestStart,
+                                      rangeLength,
+                                      objectLength );
+            inFlight++;
+        }
+
+        if( returnStatus == HTTPSuccess )
+        {
+            rangeContext.rangeStart = responseStart;
+
+            /* Move the beginning of the body received with the headers to
+             * the start of the buffer. */
+            ( void ) memmove( pBuffer, &pBuffer[ headersLength ], receivedLength - headersLength );
+
+            returnStatus = receiveBody( pTransportInterface,
+                                        pBuffer,
+                                        bufferLen,
+                                        receivedLength - headersLength,
+                                        receiveRangeBody,
+                                        &rangeContext,
+                                        &rangeResponse,
+                                        &bufferedLength );
+
+            /* The bytes of a partial body were passed to the callback too. */
+            pResponse->bodyLength += rangeResponse.bodyLength;
+        }
+
+        if( returnStatus == HTTPSuccess )
+        {
+            responseStart += rangeResponse.contentLength;
+            inFlight--;
+
+            if( rangeResponse.connectionClose == true )
+            {
+                LogInfo( ( "Server closes the connection after the range ending at %llu.",
+                           ( unsigned long long ) responseStart ) );
+                pResponse->connectionClose = true;
+                inFlight = 0U;
+            }
+        }
+    }
+
+    if( ( returnStatus != HTTPSuccess ) && ( pResponse != NULL ) )
+    {
+        /* Responses to the pipelined requests may be left unread on the
+         * connection. */
+        pResponse->connectionClose = true;
+    }
+    else if( bufferedLength > 0U )
+    {
+        LogWarn( ( "Server sent %lu bytes after the last response.",
+                   ( unsigned long ) bufferedLength ) );
+        pResponse->connectionClose = true;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
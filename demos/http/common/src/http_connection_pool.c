@@ -0,0 +1,804 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_connection_pool.c
+ * @brief Implementation of a pool of keep-alive TLS connections shared by the
+ * HTTP requests of a demo.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <poll.h>
+#include <pthread.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the connection pool. */
+#include "http_connection_pool.h"
+
+/* Common HTTP demo utilities. */
+#include "http_demo_utils.h"
+
+/* Include clock header for the idle time of the connections. */
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    OpensslParams_t * pParams;
+};
+
+/**
+ * @brief A connection of the pool.
+ */
+typedef struct PooledConnection
+{
+    char hostName[ CONNECTION_POOL_MAX_HOST_NAME_LENGTH + 1U ]; /**< @brief Host name of the server, NULL-terminated. */
+    ServerInfo_t serverInfo;                                    /**< @brief Server of the connection, pointing to #PooledConnection_t.hostName. */
+    OpensslCredentials_t credentials;                           /**< @brief Credentials the connection was established with. */
+    uint32_t sendRecvTimeoutMs;                                 /**< @brief Timeout of the connection. */
+    OpensslParams_t opensslParams;                              /**< @brief TLS session of the connection. */
+    NetworkContext_t networkContext;                            /**< @brief Network context pointing to #PooledConnection_t.opensslParams. */
+    uint32_t lastUsedTimeMs;                                    /**< @brief Time the connection was last checked in. */
+    bool connected;                                             /**< @brief Whether the connection is established. */
+    bool checkedOut;                                            /**< @brief Whether the connection is in use. */
+    bool prewarming;                                            /**< @brief Whether #prewarmThread is establishing the connection. */
+    bool prewarmed;                                             /**< @brief Whether the connection was established by #prewarmThread and not checked out since. */
+} PooledConnection_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The connections of the pool.
+ */
+static PooledConnection_t pool[ CONNECTION_POOL_SIZE ];
+
+/**
+ * @brief Mutex protecting #pool, so that threads can share the pool.
+ * Connections are established without holding it.
+ */
+static pthread_mutex_t poolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Condition signaled when a connection stops being pre-warmed:
+ * #PooledConnection_t.prewarming or #PooledConnection_t.prewarmed is
+ * cleared.
+ */
+static pthread_cond_t prewarmCondition = PTHREAD_COND_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Compare two optional strings.
+ *
+ * @param[in] pFirst First string. May be NULL.
+ * @param[in] pSecond Second string. May be NULL.
+ *
+ * @return true if both strings are NULL or equal; false otherwise.
+ */
+static bool optionalStringsEqual( const char * pFirst,
+                                  const char * pSecond );
+
+/**
+ * @brief Check whether a connection was established to a server with the
+ * given credentials.
+ *
+ * @param[in] pConnection The connection of the pool.
+ * @param[in] pServerInfo Host and port of the server.
+ * @param[in] pCredentials Credentials of the TLS connection.
+ *
+ * @return true if the connection can serve requests to the server; false
+ * otherwise.
+ */
+static bool connectionMatches( const PooledConnection_t * pConnection,
+                               const ServerInfo_t * pServerInfo,
+                               const OpensslCredentials_t * pCredentials );
+
+/**
+ * @brief Check whether an idle connection can still be used.
+ *
+ * An idle keep-alive connection receives nothing until the next request is
+ * sent, so a readable socket means the server has closed the connection.
+ *
+ * @param[in] pConnection The idle connection.
+ * @param[in] currentTimeMs The current time.
+ *
+ * @return true if the connection can be reused; false otherwise.
+ */
+static bool isConnectionReusable( const PooledConnection_t * pConnection,
+                                  uint32_t currentTimeMs );
+
+/**
+ * @brief Close a connection of the pool.
+ *
+ * @param[in] pConnection The connection to close.
+ */
+static void closeConnection( PooledConnection_t * pConnection );
+
+/**
+ * @brief Check whether a connection to a server is being established by
+ * #prewarmThread. Must be called with #poolMutex held.
+ *
+ * @param[in] pServerInfo Host and port of the server.
+ * @param[in] pCredentials Credentials of the TLS connection.
+ *
+ * @return true if a check out to the server is to wait for the connection.
+ */
+static bool isPrewarming( const ServerInfo_t * pServerInfo,
+                          const OpensslCredentials_t * pCredentials );
+
+/**
+ * @brief Pick the connection of the pool to check out, closing idle
+ * connections that can no longer be used. Must be called with #poolMutex
+ * held.
+ *
+ * @param[in] pServerInfo Host and port of the server.
+ * @param[in] pCredentials Credentials of the TLS connection.
+ *
+ * @return A live connection to the server, or else a closed connection to
+ * establish; NULL if all connections are checked out.
+ */
+static PooledConnection_t * pickConnection( const ServerInfo_t * pServerInfo,
+                                            const OpensslCredentials_t * pCredentials );
+
+/**
+ * @brief Set up a checked out connection to be established to a server.
+ *
+ * @param[in] pConnection The connection, which is not established.
+ * @param[in] pServerInfo Host and port of the server.
+ * @param[in] pCredentials Credentials of the TLS connection.
+ * @param[in] sendRecvTimeoutMs Send and receive timeout of the connection.
+ */
+static void setUpConnection( PooledConnection_t * pConnection,
+                             const ServerInfo_t * pServerInfo,
+                             const OpensslCredentials_t * pCredentials,
+                             uint32_t sendRecvTimeoutMs );
+
+/**
+ * @brief Establish the TLS connection of a pooled connection.
+ *
+ * This has the signature of #TransportConnect_t to be retried by
+ * #connectToServerWithBackoffRetries.
+ *
+ * @param[in] pNetworkContext The network context of the pooled connection.
+ *
+ * @return EXIT_SUCCESS if the connection was established; EXIT_FAILURE
+ * otherwise.
+ */
+static int32_t connectPooledConnection( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Find the pooled connection of a transport interface set by
+ * #ConnectionPool_Checkout.
+ *
+ * @param[in] pTransportInterface The transport interface.
+ *
+ * @return The connection; NULL if the transport interface is not from the
+ * pool.
+ */
+static PooledConnection_t * findConnection( const TransportInterface_t * pTransportInterface );
+
+/**
+ * @brief Thread establishing a connection for #ConnectionPool_Prewarm, then
+ * closing it if it is not checked out within
+ * #CONNECTION_POOL_PREWARM_TIMEOUT_MS.
+ *
+ * @param[in] pArgument The connection, set up and checked out.
+ *
+ * @return NULL.
+ */
+static void * prewarmThread( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static bool optionalStringsEqual( const char * pFirst,
+                                  const char * pSecond )
+{
+    bool equal = false;
+
+    if( ( pFirst == NULL ) || ( pSecond == NULL ) )
+    {
+        equal = ( pFirst == pSecond );
+    }
+    else
+    {
+        equal = ( strcmp( pFirst, pSecond ) == 0 );
+    }
+
+    return equal;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool connectionMatches( const PooledConnection_t * pConnection,
+                               const ServerInfo_t * pServerInfo,
+                               const OpensslCredentials_t * pCredentials )
+{
+    const OpensslCredentials_t * pPooledCredentials = &pConnection->credentials;
+    bool matches = false;
+
+    /* Host names are case insensitive. */
+    if( ( pConnection->serverInfo.port == pServerInfo->port ) &&
+        ( pConnection->serverInfo.hostNameLength == pServerInfo->hostNameLength ) &&
+        ( strncasecmp( pConnection->hostName,
+                       pServerInfo->pHostName,
+                       pServerInfo->hostNameLength ) == 0 ) )
+    {
+        matches = optionalStringsEqual( pPooledCredentials->pRootCaPath, pCredentials->pRootCaPath ) &&
+                  optionalStringsEqual( pPooledCredentials->pClientCertPath, pCredentials->pClientCertPath ) &&
+                  optionalStringsEqual( pPooledCredentials->pPrivateKeyPath, pCredentials->pPrivateKeyPath ) &&
+                  optionalStringsEqual( pPooledCredentials->sniHostName, pCredentials->sniHostName ) &&
+                  ( pPooledCredentials->maxFragmentLength == pCredentials->maxFragmentLength ) &&
+                  ( pPooledCredentials->enableKtls == pCredentials->enableKtls ) &&
+                  ( pPooledCredentials->cipherPolicy == pCredentials->cipherPolicy ) &&
+                  ( pPooledCredentials->ocspMode == pCredentials->ocspMode ) &&
+                  ( pPooledCredentials->alpnProtosLen == pCredentials->alpnProtosLen );
+    }
+
+    if( ( matches == true ) && ( pCredentials->alpnProtosLen > 0U ) )
+    {
+        matches = ( pPooledCredentials->pAlpnProtos != NULL ) &&
+                  ( pCredentials->pAlpnProtos != NULL ) &&
+                  ( memcmp( pPooledCredentials->pAlpnProtos,
+                            pCredentials->pAlpnProtos,
+                            pCredentials->alpnProtosLen ) == 0 );
+    }
+
+    return matches;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isConnectionReusable( const PooledConnection_t * pConnection,
+                                  uint32_t currentTimeMs )
+{
+    bool reusable = false;
+    struct pollfd fileDescriptor;
+
+    /* The subtraction handles the time wrapping around. */
+    if( ( currentTimeMs - pConnection->lastUsedTimeMs ) > CONNECTION_POOL_IDLE_TIMEOUT_MS )
+    {
+        LogDebug( ( "Connection to %s has been idle for too long.",
+                    pConnection->hostName ) );
+    }
+    else
+    {
+        fileDescriptor.fd = pConnection->opensslParams.socketDescriptor;
+        fileDescriptor.events = POLLIN;
+        fileDescriptor.revents = 0;
+
+        if( poll( &fileDescriptor, 1, 0 ) == 0 )
+        {
+            reusable = true;
+        }
+        else
+        {
+            LogInfo( ( "Connection to %s was closed by the server.",
+                       pConnection->hostName ) );
+        }
+    }
+
+    return reusable;
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeConnection( PooledConnection_t * pConnection )
+{
+    if( pConnection->connected == true )
+    {
+        /* End the TLS session, then close the TCP connection. */
+        ( void ) Openssl_Disconnect( &pConnection->networkContext );
+        pConnection->connected = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isPrewarming( const ServerInfo_t * pServerInfo,
+                          const OpensslCredentials_t * pCredentials )
+{
+    bool prewarming = false;
+    size_t i = 0U;
+
+    for( i = 0U; ( i < CONNECTION_POOL_SIZE ) && ( prewarming == false ); i++ )
+    {
+        /* The server of a pre-warmed connection is set up under the mutex. */
+        prewarming = ( pool[ i ].prewarming == true ) &&
+                     ( connectionMatches( &pool[ i ], pServerInfo, pCredentials ) == true );
+    }
+
+    return prewarming;
+}
+
+/*-----------------------------------------------------------*/
+
+static PooledConnection_t * pickConnection( const ServerInfo_t * pServerInfo,
+                                            const OpensslCredentials_t * pCredentials )
+{
+    PooledConnection_t * pConnection = NULL, * pFree = NULL, * pLeastRecentlyUsed = NULL;
+    uint32_t currentTimeMs = Clock_GetTimeMs();
+    size_t i = 0U;
+
+    for( i = 0U; ( i < CONNECTION_POOL_SIZE ) && ( pConnection == NULL ); i++ )
+    {
+        if( pool[ i ].checkedOut == false )
+        {
+            if( ( pool[ i ].connected == true ) &&
+                ( connectionMatches( &pool[ i ], pServerInfo, pCredentials ) == true ) )
+            {
+                if( isConnectionReusable( &pool[ i ], currentTimeMs ) == true )
+                {
+                    pConnection = &pool[ i ];
+                }
+                else
+                {
+                    closeConnection( &pool[ i ] );
+                }
+            }
+
+            if( pool[ i ].connected == false )
+            {
+                if( pFree == NULL )
+                {
+                    pFree = &pool[ i ];
+                }
+            }
+            else if( ( pLeastRecentlyUsed == NULL ) ||
+                     ( ( currentTimeMs - pool[ i ].lastUsedTimeMs ) >
+                       ( currentTimeMs - pLeastRecentlyUsed->lastUsedTimeMs ) ) )
+            {
+                pLeastRecentlyUsed = &pool[ i ];
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+    }
+
+    if( pConnection == NULL )
+    {
+        /* Prefer a free slot to closing a connection that may be reused by a
+         * request to another server. */
+        pConnection = ( pFree != NULL ) ? pFree : pLeastRecentlyUsed;
+
+        if( pConnection != NULL )
+        {
+            closeConnection( pConnection );
+        }
+    }
+
+    if( pConnection != NULL )
+    {
+        /* A pre-warmed connection checked out, or closed for another server,
+         * is no longer closed by its thread. */
+        if( pConnection->prewarmed == true )
+        {
+            pConnection->prewarmed = false;
+            ( void ) pthread_cond_broadcast( &prewarmCondition );
+        }
+
+        pConnection->checkedOut = true;
+    }
+
+    return pConnection;
+}
+
+/*-----------------------------------------------------------*/
+
+static void setUpConnection( PooledConnection_t * pConnection,
+                             const ServerInfo_t * pServerInfo,
+                             const OpensslCredentials_t * pCredentials,
+                             uint32_t sendRecvTimeoutMs )
+{
+    ( void ) memcpy( pConnection->hostName, pServerInfo->pHostName, pServerInfo->hostNameLength );
+    pConnection->hostName[ pServerInfo->hostNameLength ] = '\0';
+    pConnection->serverInfo = *pServerInfo;
+    pConnection->serverInfo.pHostName = pConnection->hostName;
+
+    /* Downloads and uploads may be placed on another interface than MQTT
+     * by the binding policy of the sockets. */
+    pConnection->serverInfo.trafficClass = TRANSPORT_TRAFFIC_BACKGROUND;
+    pConnection->credentials = *pCredentials;
+
+    /* The SNI host name is usually the host name, which the connection
+     * keeps a copy of, so callers may pass a host name that does not
+     * outlive the request. */
+    if( ( pCredentials->sniHostName != NULL ) &&
+        ( strcmp( pCredentials->sniHostName, pConnection->hostName ) == 0 ) )
+    {
+        pConnection->credentials.sniHostName = pConnection->hostName;
+    }
+
+    pConnection->sendRecvTimeoutMs = sendRecvTimeoutMs;
+    ( void ) memset( &pConnection->opensslParams, 0, sizeof( OpensslParams_t ) );
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        /* Downloads and uploads yield the link to MQTT. */
+        pConnection->opensslParams.trafficClass = TRANSPORT_TRAFFIC_BACKGROUND;
+    #endif
+
+    pConnection->networkContext.pParams = &pConnection->opensslParams;
+}
+
+/*-----------------------------------------------------------*/
+
+static PooledConnection_t * findConnection( const TransportInterface_t * pTransportInterface )
+{
+    PooledConnection_t * pConnection = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; ( i < CONNECTION_POOL_SIZE ) && ( pConnection == NULL ); i++ )
+    {
+        if( pTransportInterface->pNetworkContext == &pool[ i ].networkContext )
+        {
+            pConnection = &pool[ i ];
+        }
+    }
+
+    return pConnection;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t connectPooledConnection( NetworkContext_t * pNetworkContext )
+{
+    int32_t returnStatus = EXIT_FAILURE;
+    OpensslStatus_t opensslStatus = OPENSSL_SUCCESS;
+    PooledConnection_t * pConnection = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; ( i < CONNECTION_POOL_SIZE ) && ( pConnection == NULL ); i++ )
+    {
+        if( pNetworkContext == &pool[ i ].networkContext )
+        {
+            pConnection = &pool[ i ];
+        }
+    }
+
+    assert( pConnection != NULL );
+
+    LogInfo( ( "Establishing a TLS session with %s:%u.",
+               pConnection->hostName,
+               ( unsigned int ) pConnection->serverInfo.port ) );
+
+    opensslStatus = Openssl_Connect( pNetworkContext,
+                                     &pConnection->serverInfo,
+                                     &pConnection->credentials,
+                                     pConnection->sendRecvTimeoutMs,
+                                     pConnection->sendRecvTimeoutMs );
+
+    if( opensslStatus == OPENSSL_SUCCESS )
+    {
+        returnStatus = EXIT_SUCCESS;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prewarmThread( void * pArgument )
+{
+    PooledConnection_t * pConnection = ( PooledConnection_t * ) pArgument;
+    bool connected = false;
+    struct timespec deadline;
+    int waitStatus = 0;
+
+    connected = ( connectToServerWithBackoffRetries( connectPooledConnection,
+                                                     &pConnection->networkContext ) == EXIT_SUCCESS );
+
+    if( connected == false )
+    {
+        LogError( ( "Failed to pre-warm a connection to HTTP server %s.",
+                    pConnection->hostName ) );
+    }
+
+    ( void ) clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += ( time_t ) ( CONNECTION_POOL_PREWARM_TIMEOUT_MS / 1000U );
+    deadline.tv_nsec += ( long ) ( CONNECTION_POOL_PREWARM_TIMEOUT_MS % 1000U ) * 1000000L;
+
+    if( deadline.tv_nsec >= 1000000000L )
+    {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    ( void ) pthread_mutex_lock( &poolMutex );
+
+    /* The connection waits idle for its check out, which the waiting check
+     * outs are woken up for. */
+    pConnection->connected = connected;
+    pConnection->lastUsedTimeMs = Clock_GetTimeMs();
+    pConnection->checkedOut = false;
+    pConnection->prewarming = false;
+    pConnection->prewarmed = connected;
+    ( void ) pthread_cond_broadcast( &prewarmCondition );
+
+    while( ( pConnection->prewarmed == true ) && ( waitStatus == 0 ) )
+    {
+        waitStatus = pthread_cond_timedwait( &prewarmCondition, &poolMutex, &deadline );
+    }
+
+    /* The connection is still as this thread left it. */
+    if( pConnection->prewarmed == true )
+    {
+        LogInfo( ( "Closing the pre-warmed connection to %s, which was not used.",
+                   pConnection->hostName ) );
+        closeConnection( pConnection );
+        pConnection->prewarmed = false;
+    }
+
+    ( void ) pthread_mutex_unlock( &poolMutex );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+ConnectionPoolStatus_t ConnectionPool_Checkout( const ServerInfo_t * pServerInfo,
+                                                const OpensslCredentials_t * pCredentials,
+                                                uint32_t sendRecvTimeoutMs,
+                                                TransportInterface_t * pTransportInterface )
+{
+    ConnectionPoolStatus_t returnStatus = CONNECTION_POOL_SUCCESS;
+    PooledConnection_t * pConnection = NULL;
+
+    if( ( pServerInfo == NULL ) || ( pServerInfo->pHostName == NULL ) ||
+        ( pCredentials == NULL ) || ( pTransportInterface == NULL ) )
+    {
+        LogError( ( "NULL parameter passed to ConnectionPool_Checkout()." ) );
+        returnStatus = CONNECTION_POOL_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->hostNameLength > CONNECTION_POOL_MAX_HOST_NAME_LENGTH )
+    {
+        LogError( ( "Host name is longer than CONNECTION_POOL_MAX_HOST_NAME_LENGTH: "
+                    "Length=%lu.",
+                    ( unsigned long ) pServerInfo->hostNameLength ) );
+        returnStatus = CONNECTION_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &poolMutex );
+
+        /* The handshakes of a pre-warmed connection are under way, which
+         * takes less time than starting them again. */
+        while( isPrewarming( pServerInfo, pCredentials ) == true )
+        {
+            ( void ) pthread_cond_wait( &prewarmCondition, &poolMutex );
+        }
+
+        pConnection = pickConnection( pServerInfo, pCredentials );
+        ( void ) pthread_mutex_unlock( &poolMutex );
+
+        if( pConnection == NULL )
+        {
+            LogError( ( "All %u connections of the pool are checked out.",
+                        ( unsigned int ) CONNECTION_POOL_SIZE ) );
+            returnStatus = CONNECTION_POOL_FULL;
+        }
+    }
+
+    if( ( pConnection != NULL ) && ( pConnection->connected == false ) )
+    {
+        /* The connection is checked out, so it can be set up without holding
+         * the mutex. */
+        setUpConnection( pConnection, pServerInfo, pCredentials, sendRecvTimeoutMs );
+
+        if( connectToServerWithBackoffRetries( connectPooledConnection,
+                                               &pConnection->networkContext ) == EXIT_SUCCESS )
+        {
+            pConnection->connected = true;
+        }
+        else
+        {
+            LogError( ( "Failed to connect to HTTP server %s.",
+                        pConnection->hostName ) );
+
+            ( void ) pthread_mutex_lock( &poolMutex );
+            pConnection->checkedOut = false;
+            ( void ) pthread_mutex_unlock( &poolMutex );
+
+            pConnection = NULL;
+            returnStatus = CONNECTION_POOL_CONNECT_FAILURE;
+        }
+    }
+    else if( pConnection != NULL )
+    {
+        LogDebug( ( "Reusing the connection to %s.",
+                    pConnection->hostName ) );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( pConnection != NULL )
+    {
+        ( void ) memset( pTransportInterface, 0, sizeof( TransportInterface_t ) );
+        pTransportInterface->recv = Openssl_Recv;
+        pTransportInterface->send = Openssl_Send;
+        pTransportInterface->pNetworkContext = &pConnection->networkContext;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ConnectionPoolStatus_t ConnectionPool_Prewarm( const ServerInfo_t * pServerInfo,
+                                               const OpensslCredentials_t * pCredentials,
+                                               uint32_t sendRecvTimeoutMs )
+{
+    ConnectionPoolStatus_t returnStatus = CONNECTION_POOL_SUCCESS;
+    PooledConnection_t * pConnection = NULL;
+    pthread_t thread;
+    pthread_attr_t attributes;
+    bool started = false;
+
+    if( ( pServerInfo == NULL ) || ( pServerInfo->pHostName == NULL ) ||
+        ( pCredentials == NULL ) )
+    {
+        LogError( ( "NULL parameter passed to ConnectionPool_Prewarm()." ) );
+        returnStatus = CONNECTION_POOL_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->hostNameLength > CONNECTION_POOL_MAX_HOST_NAME_LENGTH )
+    {
+        LogError( ( "Host name is longer than CONNECTION_POOL_MAX_HOST_NAME_LENGTH: "
+                    "Length=%lu.",
+                    ( unsigned long ) pServerInfo->hostNameLength ) );
+        returnStatus = CONNECTION_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &poolMutex );
+
+        if( isPrewarming( pServerInfo, pCredentials ) == false )
+        {
+            pConnection = pickConnection( pServerInfo, pCredentials );
+
+            if( pConnection == NULL )
+            {
+                returnStatus = CONNECTION_POOL_FULL;
+            }
+            else if( pConnection->connected == true )
+            {
+                /* An idle connection to the server is as good. */
+                pConnection->checkedOut = false;
+                pConnection = NULL;
+            }
+            else
+            {
+                /* Unlike a check out, the connection is set up under the
+                 * mutex, as check outs compare their server to it while it is
+                 * being established. */
+                setUpConnection( pConnection, pServerInfo, pCredentials, sendRecvTimeoutMs );
+                pConnection->prewarming = true;
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &poolMutex );
+    }
+
+    if( pConnection != NULL )
+    {
+        LogDebug( ( "Pre-warming a connection to %s.",
+                    pConnection->hostName ) );
+
+        if( pthread_attr_init( &attributes ) == 0 )
+        {
+            ( void ) pthread_attr_setdetachstate( &attributes, PTHREAD_CREATE_DETACHED );
+            started = ( pthread_create( &thread, &attributes, prewarmThread, pConnection ) == 0 );
+            ( void ) pthread_attr_destroy( &attributes );
+        }
+
+        if( started == false )
+        {
+            LogError( ( "Failed to start the thread pre-warming a connection to %s.",
+                        pConnection->hostName ) );
+
+            ( void ) pthread_mutex_lock( &poolMutex );
+            pConnection->prewarming = false;
+            pConnection->checkedOut = false;
+            ( void ) pthread_cond_broadcast( &prewarmCondition );
+            ( void ) pthread_mutex_unlock( &poolMutex );
+
+            returnStatus = CONNECTION_POOL_CONNECT_FAILURE;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void ConnectionPool_Checkin( const TransportInterface_t * pTransportInterface,
+                             HTTPStatus_t httpStatus,
+                             const HTTPResponse_t * pResponse )
+{
+    PooledConnection_t * pConnection = NULL;
+
+    if( pTransportInterface != NULL )
+    {
+        pConnection = findConnection( pTransportInterface );
+    }
+
+    if( ( pConnection == NULL ) || ( pConnection->checkedOut == false ) )
+    {
+        LogError( ( "Connection checked in was not checked out from the pool." ) );
+    }
+    else
+    {
+        /* A failed request may have left part of its response unread, and
+         * the server does not accept further requests after sending
+         * "Connection: close". */
+        if( ( httpStatus != HTTPSuccess ) ||
+            ( ( pResponse != NULL ) &&
+              ( ( pResponse->respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U ) ) )
+        {
+            LogDebug( ( "Closing the connection to %s.",
+                        pConnection->hostName ) );
+            closeConnection( pConnection );
+        }
+
+        ( void ) pthread_mutex_lock( &poolMutex );
+        pConnection->lastUsedTimeMs = Clock_GetTimeMs();
+        pConnection->checkedOut = false;
+        ( void ) pthread_mutex_unlock( &poolMutex );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void ConnectionPool_CloseAll( void )
+{
+    size_t i = 0U;
+
+    ( void ) pthread_mutex_lock( &poolMutex );
+
+    for( i = 0U; i < CONNECTION_POOL_SIZE; i++ )
+    {
+        if( pool[ i ].checkedOut == false )
+        {
+            closeConnection( &pool[ i ] );
+            pool[ i ].prewarmed = false;
+        }
+    }
+
+    /* The threads of the pre-warmed connections closed stop waiting. */
+    ( void ) pthread_cond_broadcast( &prewarmCondition );
+    ( void ) pthread_mutex_unlock( &poolMutex );
+}
+
+/*-----------------------------------------------------------*/
@@ -24,6 +24,7 @@
 #include <assert.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* POSIX includes. */
 #include <unistd.h>
@@ -40,6 +41,9 @@
 /*Include clock header for millisecond sleep function. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /* Third party parser utilities. */
 #include "http_parser.h"
 
@@ -80,11 +84,106 @@ struct NetworkContext
  */
 static uint32_t generateRandomNumber();
 
+/**
+ * @brief Set a component of a parsed URL from the result of
+ * http_parser_parse_url.
+ *
+ * @param[out] pComponent The component to set.
+ * @param[in] pUrlParser The result of http_parser_parse_url.
+ * @param[in] field The field of @p pUrlParser to set @p pComponent from.
+ */
+static void setUrlComponent( UrlComponent_t * pComponent,
+                             const struct http_parser_url * pUrlParser,
+                             enum http_parser_url_fields field );
+
+/**
+ * @brief Parse a URL into its components, without checking which components
+ * are present.
+ *
+ * @param[in] pUrl URL string to parse.
+ * @param[in] urlLen The length of the URL string input.
+ * @param[out] pParsedUrl The components of the URL.
+ *
+ * @return HTTPSuccess if the URL was parsed; HTTPParserInternalError
+ * otherwise.
+ */
+static HTTPStatus_t parseUrlComponents( const char * pUrl,
+                                        size_t urlLen,
+                                        ParsedUrl_t * pParsedUrl );
+
 /*-----------------------------------------------------------*/
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
+}
+
+/*-----------------------------------------------------------*/
+
+static void setUrlComponent( UrlComponent_t * pComponent,
+                             const struct http_parser_url * pUrlParser,
+                             enum http_parser_url_fields field )
+{
+    if( ( pUrlParser->field_set & ( 1U << ( uint32_t ) field ) ) != 0U )
+    {
+        pComponent->offset = ( size_t ) pUrlParser->field_data[ field ].off;
+        pComponent->length = ( size_t ) pUrlParser->field_data[ field ].len;
+    }
+    else
+    {
+        pComponent->offset = 0U;
+        pComponent->length = 0U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t parseUrlComponents( const char * pUrl,
+                                        size_t urlLen,
+                                        ParsedUrl_t * pParsedUrl )
+{
+    /* http-parser status. Initialized to 1 to signify failure. */
+    int parserStatus = 1;
+    struct http_parser_url urlParser;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+
+    /* Sets all members in urlParser to 0. */
+    http_parser_url_init( &urlParser );
+
+    parserStatus = http_parser_parse_url( pUrl, urlLen, 0, &urlParser );
+
+    if( parserStatus != 0 )
+    {
+        LogError( ( "Error parsing the input URL %.*s. Error code: %d.",
+                    ( int32_t ) urlLen,
+                    pUrl,
+                    parserStatus ) );
+        httpStatus = HTTPParserInternalError;
+    }
+    else
+    {
+        pParsedUrl->pUrl = pUrl;
+        pParsedUrl->urlLen = urlLen;
+        setUrlComponent( &pParsedUrl->scheme, &urlParser, UF_SCHEMA );
+        setUrlComponent( &pParsedUrl->host, &urlParser, UF_HOST );
+        setUrlComponent( &pParsedUrl->path, &urlParser, UF_PATH );
+        setUrlComponent( &pParsedUrl->query, &urlParser, UF_QUERY );
+        pParsedUrl->port = ( ( urlParser.field_set & ( 1U << ( uint32_t ) UF_PORT ) ) != 0U ) ?
+                           urlParser.port : 0U;
+
+        /* The request target runs from the start of the path to the end of
+         * the query. The fragment is never sent to the server. */
+        pParsedUrl->requestTarget = pParsedUrl->path;
+
+        if( ( pParsedUrl->path.length > 0U ) && ( pParsedUrl->query.length > 0U ) )
+        {
+            pParsedUrl->requestTarget.length = ( pParsedUrl->query.offset +
+                                                 pParsedUrl->query.length ) -
+                                               pParsedUrl->path.offset;
+        }
+    }
+
+    return httpStatus;
 }
 
 /*-----------------------------------------------------------*/
@@ -98,19 +197,9 @@ int32_t connectToServerWithBackoffRetries( TransportConnect_t connectFunction,
     /* Struct containing the next backoff time. */
     BackoffAlgorithmContext_t reconnectParams;
     uint16_t nextRetryBackOff = 0U;
-    struct timespec tp;
 
     assert( connectFunction != NULL );
 
-    /* Seed pseudo random number generator used in the demo for
-     * backoff period calculation when retrying failed network operations
-     * with broker. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
-
     /* Initialize reconnect attempts and interval */
     BackoffAlgorithm_InitializeParams( &reconnectParams,
                                        CONNECTION_RETRY_BACKOFF_BASE_MS,
@@ -158,14 +247,9 @@ HTTPStatus_t getUrlPath( const char * pUrl,
                          const char ** pPath,
                          size_t * pPathLen )
 {
-    /* http-parser status. Initialized to 1 to signify failure. */
-    int parserStatus = 1;
-    struct http_parser_url urlParser;
+    ParsedUrl_t parsedUrl;
     HTTPStatus_t httpStatus = HTTPSuccess;
 
-    /* Sets all members in urlParser to 0. */
-    http_parser_url_init( &urlParser );
-
     if( ( pUrl == NULL ) || ( pPath == NULL ) || ( pPathLen == NULL ) )
     {
         LogError( ( "NULL parameter passed to getUrlPath()." ) );
@@ -174,21 +258,12 @@ HTTPStatus_t getUrlPath( const char * pUrl,
 
     if( httpStatus == HTTPSuccess )
     {
-        parserStatus = http_parser_parse_url( pUrl, urlLen, 0, &urlParser );
-
-        if( parserStatus != 0 )
-        {
-            LogError( ( "Error parsing the input URL %.*s. Error code: %d.",
-                        ( int32_t ) urlLen,
-                        pUrl,
-                        parserStatus ) );
-            httpStatus = HTTPParserInternalError;
-        }
+        httpStatus = parseUrlComponents( pUrl, urlLen, &parsedUrl );
     }
 
     if( httpStatus == HTTPSuccess )
     {
-        *pPathLen = ( size_t ) ( urlParser.field_data[ UF_PATH ].len );
+        *pPathLen = parsedUrl.path.length;
 
         if( *pPathLen == 0 )
         {
@@ -197,7 +272,7 @@ HTTPStatus_t getUrlPath( const char * pUrl,
         }
         else
         {
-            *pPath = &pUrl[ urlParser.field_data[ UF_PATH ].off ];
+            *pPath = &pUrl[ parsedUrl.path.offset ];
         }
     }
 
@@ -218,14 +293,9 @@ HTTPStatus_t getUrlAddress( const char * pUrl,
                             const char ** pAddress,
                             size_t * pAddressLen )
 {
-    /* http-parser status. Initialized to 1 to signify failure. */
-    int parserStatus = 1;
-    struct http_parser_url urlParser;
+    ParsedUrl_t parsedUrl;
     HTTPStatus_t httpStatus = HTTPSuccess;
 
-    /* Sets all members in urlParser to 0. */
-    http_parser_url_init( &urlParser );
-
     if( ( pUrl == NULL ) || ( pAddress == NULL ) || ( pAddressLen == NULL ) )
     {
         LogError( ( "NULL parameter passed to getUrlAddress()." ) );
@@ -234,21 +304,12 @@ HTTPStatus_t getUrlAddress( const char * pUrl,
 
     if( httpStatus == HTTPSuccess )
     {
-        parserStatus = http_parser_parse_url( pUrl, urlLen, 0, &urlParser );
-
-        if( parserStatus != 0 )
-        {
-            LogError( ( "Error parsing the input URL %.*s. Error code: %d.",
-                        ( int32_t ) urlLen,
-                        pUrl,
-                        parserStatus ) );
-            httpStatus = HTTPParserInternalError;
-        }
+        httpStatus = parseUrlComponents( pUrl, urlLen, &parsedUrl );
     }
 
     if( httpStatus == HTTPSuccess )
     {
-        *pAddressLen = ( size_t ) ( urlParser.field_data[ UF_HOST ].len );
+        *pAddressLen = parsedUrl.host.length;
 
         if( *pAddressLen == 0 )
         {
@@ -257,7 +318,7 @@ HTTPStatus_t getUrlAddress( const char * pUrl,
         }
         else
         {
-            *pAddress = &pUrl[ urlParser.field_data[ UF_HOST ].off ];
+            *pAddress = &pUrl[ parsedUrl.host.offset ];
         }
     }
 
@@ -270,3 +331,64 @@ HTTPStatus_t getUrlAddress( const char * pUrl,
 
     return httpStatus;
 }
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t parseUrl( const char * pUrl,
+                       size_t urlLen,
+                       ParsedUrl_t * pParsedUrl )
+{
+    HTTPStatus_t httpStatus = HTTPSuccess;
+
+    if( ( pUrl == NULL ) || ( pParsedUrl == NULL ) )
+    {
+        LogError( ( "NULL parameter passed to parseUrl()." ) );
+        httpStatus = HTTPInvalidParameter;
+    }
+
+    if( httpStatus == HTTPSuccess )
+    {
+        httpStatus = parseUrlComponents( pUrl, urlLen, pParsedUrl );
+    }
+
+    if( ( httpStatus == HTTPSuccess ) &&
+        ( ( pParsedUrl->host.length == 0U ) || ( pParsedUrl->path.length == 0U ) ) )
+    {
+        LogError( ( "URL %.*s does not have a host and a path.",
+                    ( int32_t ) urlLen,
+                    pUrl ) );
+        httpStatus = HTTPNoResponse;
+    }
+
+    return httpStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool copyUrlHost( const ParsedUrl_t * pParsedUrl,
+                  char * pBuffer,
+                  size_t bufferLen )
+{
+    bool status = false;
+
+    assert( pParsedUrl != NULL );
+    assert( pBuffer != NULL );
+
+    if( pParsedUrl->host.length < bufferLen )
+    {
+        ( void ) memcpy( pBuffer,
+                         &pParsedUrl->pUrl[ pParsedUrl->host.offset ],
+                         pParsedUrl->host.length );
+        pBuffer[ pParsedUrl->host.length ] = '\0';
+        status = true;
+    }
+    else
+    {
+        LogError( ( "Host name %.*s is longer than the %lu byte buffer.",
+                    ( int32_t ) pParsedUrl->host.length,
+                    &pParsedUrl->pUrl[ pParsedUrl->host.offset ],
+                    ( unsigned long ) bufferLen ) );
+    }
+
+    return status;
+}
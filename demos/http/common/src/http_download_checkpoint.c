@@ -0,0 +1,493 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_download_checkpoint.c
+ * @brief Implementation of the checkpoint file of a download.
+ *
+ * The file starts with a header identifying the downloaded object, followed
+ * by a bitmap with one bit for each range of the object. Bits are only ever
+ * set, so a write of the bitmap interrupted by a crash records at worst fewer
+ * ranges than were written.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the download checkpoint. */
+#include "http_download_checkpoint.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Value identifying a checkpoint file, "DLCP".
+ */
+#define CHECKPOINT_MAGIC      ( 0x50434C44U )
+
+/**
+ * @brief Version of the layout of the checkpoint file.
+ */
+#define CHECKPOINT_VERSION    ( 1U )
+
+/**
+ * @brief The header of the checkpoint file, identifying the downloaded object.
+ *
+ * @note The file is only read on the device that wrote it, so the header is
+ * stored in the native byte order.
+ */
+typedef struct CheckpointHeader
+{
+    uint32_t magic;                                      /**< @brief #CHECKPOINT_MAGIC. */
+    uint32_t version;                                    /**< @brief #CHECKPOINT_VERSION. */
+    uint64_t fileSize;                                   /**< @brief The size of the object. */
+    uint64_t rangeLength;                                /**< @brief The length of each range. */
+    uint32_t etagLength;                                 /**< @brief The length of #CheckpointHeader_t.etag. */
+    char etag[ DOWNLOAD_CHECKPOINT_MAX_ETAG_LENGTH ];    /**< @brief The ETag of the object. */
+} CheckpointHeader_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read from a file at an offset until the buffer is full.
+ *
+ * @param[in] fileDescriptor The file.
+ * @param[out] pBuffer The buffer.
+ * @param[in] length The length of @p pBuffer.
+ * @param[in] offset The position to read from.
+ *
+ * @return true if @p length bytes were read; false otherwise.
+ */
+static bool readAll( int fileDescriptor,
+                     void * pBuffer,
+                     size_t length,
+                     off_t offset );
+
+/**
+ * @brief Write a buffer to a file at an offset.
+ *
+ * @param[in] fileDescriptor The file.
+ * @param[in] pBuffer The buffer.
+ * @param[in] length The length of @p pBuffer.
+ * @param[in] offset The position to write to.
+ *
+ * @return true if @p length bytes were written; false otherwise.
+ */
+static bool writeAll( int fileDescriptor,
+                      const void * pBuffer,
+                      size_t length,
+                      off_t offset );
+
+/**
+ * @brief Sync the downloaded file, then write and sync the bitmap.
+ *
+ * @note The mutex of the checkpoint must be held.
+ *
+ * @param[in] pCheckpoint The checkpoint.
+ *
+ * @return #DOWNLOAD_CHECKPOINT_SUCCESS or #DOWNLOAD_CHECKPOINT_FILE_ERROR.
+ */
+static DownloadCheckpointStatus_t syncLocked( DownloadCheckpoint_t * pCheckpoint );
+
+/*-----------------------------------------------------------*/
+
+static bool readAll( int fileDescriptor,
+                     void * pBuffer,
+                     size_t length,
+                     off_t offset )
+{
+    bool returnStatus = true;
+    size_t bytesRead = 0U;
+    ssize_t readResult = 0;
+
+    while( ( returnStatus == true ) && ( bytesRead < length ) )
+    {
+        readResult = pread( fileDescriptor,
+                            &( ( uint8_t * ) pBuffer )[ bytesRead ],
+                            length - bytesRead,
+                            offset + ( off_t ) bytesRead );
+
+        if( readResult > 0 )
+        {
+            bytesRead += ( size_t ) readResult;
+        }
+        else if( ( readResult < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before reading anything, retry. */
+        }
+        else
+        {
+            /* End of file or error. */
+            returnStatus = false;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool writeAll( int fileDescriptor,
+                      const void * pBuffer,
+                      size_t length,
+                      off_t offset )
+{
+    bool returnStatus = true;
+    size_t bytesWritten = 0U;
+    ssize_t writeResult = 0;
+
+    while( ( returnStatus == true ) && ( bytesWritten < length ) )
+    {
+        writeResult = pwrite( fileDescriptor,
+                              &( ( const uint8_t * ) pBuffer )[ bytesWritten ],
+                              length - bytesWritten,
+                              offset + ( off_t ) bytesWritten );
+
+        if( writeResult > 0 )
+        {
+            bytesWritten += ( size_t ) writeResult;
+        }
+        else if( ( writeResult < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before writing anything, retry. */
+        }
+        else
+        {
+            LogError( ( "Failed to write the checkpoint file: %s.",
+                        strerror( errno ) ) );
+            returnStatus = false;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static DownloadCheckpointStatus_t syncLocked( DownloadCheckpoint_t * pCheckpoint )
+{
+    DownloadCheckpointStatus_t returnStatus = DOWNLOAD_CHECKPOINT_SUCCESS;
+
+    /* The ranges must be on disk before the checkpoint records them. */
+    if( fdatasync( pCheckpoint->dataFileDescriptor ) != 0 )
+    {
+        LogError( ( "Failed to sync the downloaded file: %s.",
+                    strerror( errno ) ) );
+        returnStatus = DOWNLOAD_CHECKPOINT_FILE_ERROR;
+    }
+    else if( writeAll( pCheckpoint->fileDescriptor,
+                       pCheckpoint->pBitmap,
+                       DOWNLOAD_CHECKPOINT_BITMAP_LENGTH( pCheckpoint->rangeCount ),
+                       ( off_t ) sizeof( CheckpointHeader_t ) ) == false )
+    {
+        returnStatus = DOWNLOAD_CHECKPOINT_FILE_ERROR;
+    }
+    else if( fdatasync( pCheckpoint->fileDescriptor ) != 0 )
+    {
+        LogError( ( "Failed to sync the checkpoint file: %s.",
+                    strerror( errno ) ) );
+        returnStatus = DOWNLOAD_CHECKPOINT_FILE_ERROR;
+    }
+    else
+    {
+        LogDebug( ( "Recorded %llu of %llu ranges in the checkpoint file.",
+                    ( unsigned long long ) pCheckpoint->completedCount,
+                    ( unsigned long long ) pCheckpoint->rangeCount ) );
+        pCheckpoint->unsyncedCount = 0U;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+DownloadCheckpointStatus_t DownloadCheckpoint_Open( DownloadCheckpoint_t * pCheckpoint,
+                                                    const char * pPath,
+                                                    int dataFileDescriptor,
+                                                    uint64_t fileSize,
+                                                    uint64_t rangeLength,
+                                                    const char * pEtag,
+                                                    size_t etagLength,
+                                                    uint8_t * pBitmap,
+                                                    size_t bitmapLength,
+                                                    uint32_t syncInterval,
+                                                    uint64_t * pResumedCount )
+{
+    DownloadCheckpointStatus_t returnStatus = DOWNLOAD_CHECKPOINT_SUCCESS;
+    CheckpointHeader_t header;
+    CheckpointHeader_t storedHeader;
+    uint64_t rangeCount = 0U, i = 0U;
+    bool resumed = false;
+
+    if( ( pCheckpoint == NULL ) || ( pPath == NULL ) || ( pEtag == NULL ) ||
+        ( pBitmap == NULL ) || ( pResumedCount == NULL ) ||
+        ( fileSize == 0U ) || ( rangeLength == 0U ) || ( syncInterval == 0U ) ||
+        ( etagLength > DOWNLOAD_CHECKPOINT_MAX_ETAG_LENGTH ) )
+    {
+        LogError( ( "Invalid parameter passed to DownloadCheckpoint_Open()." ) );
+        returnStatus = DOWNLOAD_CHECKPOINT_INVALID_PARAMETER;
+    }
+    else
+    {
+        rangeCount = ( fileSize + rangeLength - 1U ) / rangeLength;
+
+        if( DOWNLOAD_CHECKPOINT_BITMAP_LENGTH( rangeCount ) > bitmapLength )
+        {
+            LogError( ( "The bitmap of %lu bytes is too small for %llu ranges.",
+                        ( unsigned long ) bitmapLength,
+                        ( unsigned long long ) rangeCount ) );
+            returnStatus = DOWNLOAD_CHECKPOINT_INSUFFICIENT_MEMORY;
+        }
+    }
+
+    if( returnStatus == DOWNLOAD_CHECKPOINT_SUCCESS )
+    {
+        ( void ) memset( pCheckpoint, 0, sizeof( DownloadCheckpoint_t ) );
+        pCheckpoint->dataFileDescriptor = dataFileDescriptor;
+        pCheckpoint->pBitmap = pBitmap;
+        pCheckpoint->rangeCount = rangeCount;
+        pCheckpoint->syncInterval = syncInterval;
+        ( void ) pthread_mutex_init( &pCheckpoint->mutex, NULL );
+
+        /* Zero the whole header, so that the padding and the unused part of
+         * the ETag compare equal. */
+        ( void ) memset( &header, 0, sizeof( header ) );
+        header.magic = CHECKPOINT_MAGIC;
+        header.version = CHECKPOINT_VERSION;
+        header.fileSize = fileSize;
+        header.rangeLength = rangeLength;
+        header.etagLength = ( uint32_t ) etagLength;
+        ( void ) memcpy( header.etag, pEtag, etagLength );
+
+        pCheckpoint->fileDescriptor = open( pPath, O_RDWR | O_CREAT, 0644 );
+
+        if( pCheckpoint->fileDescriptor == -1 )
+        {
+            LogError( ( "Failed to open %s: %s.",
+                        pPath,
+                        strerror( errno ) ) );
+            returnStatus = DOWNLOAD_CHECKPOINT_FILE_ERROR;
+        }
+    }
+
+    if( returnStatus == DOWNLOAD_CHECKPOINT_SUCCESS )
+    {
+        /* A checkpoint of another object, or of another version of it, is
+         * discarded. */
+        resumed = ( readAll( pCheckpoint->fileDescriptor, &storedHeader, sizeof( storedHeader ), 0 ) == true ) &&
+                  ( memcmp( &storedHeader, &header, sizeof( header ) ) == 0 ) &&
+                  ( readAll( pCheckpoint->fileDescriptor,
+                             pBitmap,
+                             DOWNLOAD_CHECKPOINT_BITMAP_LENGTH( rangeCount ),
+                             ( off_t ) sizeof( header ) ) == true );
+
+        if( resumed == true )
+        {
+            for( i = 0U; i < rangeCount; i++ )
+            {
+                if( ( pBitmap[ i / 8U ] & ( uint8_t ) ( 1U << ( i % 8U ) ) ) != 0U )
+                {
+                    pCheckpoint->completedCount++;
+                }
+            }
+
+            LogInfo( ( "Resuming the download from %s: %llu of %llu ranges are complete.",
+                       pPath,
+                       ( unsigned long long ) pCheckpoint->completedCount,
+                       ( unsigned long long ) rangeCount ) );
+        }
+        else
+        {
+            ( void ) memset( pBitmap, 0, DOWNLOAD_CHECKPOINT_BITMAP_LENGTH( rangeCount ) );
+
+            if( ( ftruncate( pCheckpoint->fileDescriptor, 0 ) != 0 ) ||
+                ( writeAll( pCheckpoint->fileDescriptor, &header, sizeof( header ), 0 ) == false ) ||
+                ( writeAll( pCheckpoint->fileDescriptor,
+                            pBitmap,
+                            DOWNLOAD_CHECKPOINT_BITMAP_LENGTH( rangeCount ),
+                            ( off_t ) sizeof( header ) ) == false ) ||
+                ( fsync( pCheckpoint->fileDescriptor ) != 0 ) )
+            {
+                LogError( ( "Failed to reset %s: %s.",
+                            pPath,
+                            strerror( errno ) ) );
+                returnStatus = DOWNLOAD_CHECKPOINT_FILE_ERROR;
+            }
+        }
+    }
+
+    if( returnStatus == DOWNLOAD_CHECKPOINT_SUCCESS )
+    {
+        *pResumedCount = pCheckpoint->completedCount;
+    }
+    else if( returnStatus == DOWNLOAD_CHECKPOINT_FILE_ERROR )
+    {
+        if( pCheckpoint->fileDescriptor != -1 )
+        {
+            ( void ) close( pCheckpoint->fileDescriptor );
+            pCheckpoint->fileDescriptor = -1;
+        }
+
+        ( void ) pthread_mutex_destroy( &pCheckpoint->mutex );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool DownloadCheckpoint_IsRangeComplete( DownloadCheckpoint_t * pCheckpoint,
+                                         uint64_t rangeIndex )
+{
+    bool isComplete = false;
+
+    assert( pCheckpoint != NULL );
+
+    if( rangeIndex < pCheckpoint->rangeCount )
+    {
+        ( void ) pthread_mutex_lock( &pCheckpoint->mutex );
+        isComplete = ( ( pCheckpoint->pBitmap[ rangeIndex / 8U ] &
+                         ( uint8_t ) ( 1U << ( rangeIndex % 8U ) ) ) != 0U );
+        ( void ) pthread_mutex_unlock( &pCheckpoint->mutex );
+    }
+
+    return isComplete;
+}
+
+/*-----------------------------------------------------------*/
+
+DownloadCheckpointStatus_t DownloadCheckpoint_MarkRangeComplete( DownloadCheckpoint_t * pCheckpoint,
+                                                                 uint64_t rangeIndex )
+{
+    DownloadCheckpointStatus_t returnStatus = DOWNLOAD_CHECKPOINT_SUCCESS;
+    uint8_t mask = 0U;
+
+    if( ( pCheckpoint == NULL ) || ( rangeIndex >= pCheckpoint->rangeCount ) )
+    {
+        LogError( ( "Invalid parameter passed to DownloadCheckpoint_MarkRangeComplete()." ) );
+        returnStatus = DOWNLOAD_CHECKPOINT_INVALID_PARAMETER;
+    }
+    else
+    {
+        mask = ( uint8_t ) ( 1U << ( rangeIndex % 8U ) );
+
+        ( void ) pthread_mutex_lock( &pCheckpoint->mutex );
+
+        if( ( pCheckpoint->pBitmap[ rangeIndex / 8U ] & mask ) == 0U )
+        {
+            pCheckpoint->pBitmap[ rangeIndex / 8U ] |= mask;
+            pCheckpoint->completedCount++;
+            pCheckpoint->unsyncedCount++;
+        }
+
+        if( pCheckpoint->unsyncedCount >= pCheckpoint->syncInterval )
+        {
+            returnStatus = syncLocked( pCheckpoint );
+        }
+
+        ( void ) pthread_mutex_unlock( &pCheckpoint->mutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+DownloadCheckpointStatus_t DownloadCheckpoint_Sync( DownloadCheckpoint_t * pCheckpoint )
+{
+    DownloadCheckpointStatus_t returnStatus = DOWNLOAD_CHECKPOINT_SUCCESS;
+
+    if( pCheckpoint == NULL )
+    {
+        LogError( ( "NULL parameter passed to DownloadCheckpoint_Sync()." ) );
+        returnStatus = DOWNLOAD_CHECKPOINT_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &pCheckpoint->mutex );
+        returnStatus = syncLocked( pCheckpoint );
+        ( void ) pthread_mutex_unlock( &pCheckpoint->mutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+DownloadCheckpointStatus_t DownloadCheckpoint_Close( DownloadCheckpoint_t * pCheckpoint,
+                                                     const char * pPath,
+                                                     bool removeFile )
+{
+    DownloadCheckpointStatus_t returnStatus = DOWNLOAD_CHECKPOINT_SUCCESS;
+
+    if( ( pCheckpoint == NULL ) || ( pPath == NULL ) )
+    {
+        LogError( ( "NULL parameter passed to DownloadCheckpoint_Close()." ) );
+        returnStatus = DOWNLOAD_CHECKPOINT_INVALID_PARAMETER;
+    }
+    else
+    {
+        if( removeFile == true )
+        {
+            if( ( unlink( pPath ) != 0 ) && ( errno != ENOENT ) )
+            {
+                LogError( ( "Failed to remove %s: %s.",
+                            pPath,
+                            strerror( errno ) ) );
+                returnStatus = DOWNLOAD_CHECKPOINT_FILE_ERROR;
+            }
+        }
+        else if( pCheckpoint->unsyncedCount > 0U )
+        {
+            returnStatus = DownloadCheckpoint_Sync( pCheckpoint );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        if( close( pCheckpoint->fileDescriptor ) != 0 )
+        {
+            returnStatus = DOWNLOAD_CHECKPOINT_FILE_ERROR;
+        }
+
+        pCheckpoint->fileDescriptor = -1;
+        ( void ) pthread_mutex_destroy( &pCheckpoint->mutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,149 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_range_tuner.c
+ * @brief Implementation of the additive increase, multiplicative decrease of
+ * the length of the ranges of a download.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+
+/* Include header for the range length tuner. */
+#include "http_range_tuner.h"
+
+/* Include clock header for timing the requests. */
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Gain of the smoothed round trip time and throughput, 1/8 as for the
+ * smoothed round trip time of TCP.
+ */
+#define SMOOTHING_SHIFT    ( 3U )
+
+/*-----------------------------------------------------------*/
+
+void HttpRangeTuner_Init( HttpRangeTuner_t * pTuner,
+                          size_t initialLength,
+                          size_t stepLength,
+                          size_t maxLength,
+                          uint32_t targetTimeMs )
+{
+    assert( pTuner != NULL );
+    assert( ( stepLength > 0U ) && ( maxLength >= stepLength ) );
+
+    pTuner->stepLength = stepLength;
+    pTuner->maxLength = maxLength - ( maxLength % stepLength );
+    pTuner->length = initialLength - ( initialLength % stepLength );
+    pTuner->targetTimeMs = targetTimeMs;
+    pTuner->requestStartMs = 0U;
+    pTuner->roundTripTimeMs = 0U;
+    pTuner->throughput = 0U;
+
+    if( pTuner->length < stepLength )
+    {
+        pTuner->length = stepLength;
+    }
+    else if( pTuner->length > pTuner->maxLength )
+    {
+        pTuner->length = pTuner->maxLength;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+size_t HttpRangeTuner_Start( HttpRangeTuner_t * pTuner )
+{
+    assert( pTuner != NULL );
+
+    pTuner->requestStartMs = Clock_GetTimeMs();
+
+    return pTuner->length;
+}
+
+/*-----------------------------------------------------------*/
+
+void HttpRangeTuner_Finish( HttpRangeTuner_t * pTuner,
+                            size_t bytesReceived,
+                            bool succeeded )
+{
+    uint32_t elapsedMs = 0U;
+    uint64_t throughput = 0U;
+    bool keepsUp = true;
+
+    assert( pTuner != NULL );
+
+    elapsedMs = Clock_GetTimeMs() - pTuner->requestStartMs;
+
+    if( succeeded == true )
+    {
+        /* Requests faster than the clock count as one millisecond. */
+        throughput = ( ( uint64_t ) bytesReceived * 1000U ) / ( ( elapsedMs > 0U ) ? elapsedMs : 1U );
+
+        if( pTuner->roundTripTimeMs == 0U )
+        {
+            pTuner->roundTripTimeMs = ( elapsedMs > 0U ) ? elapsedMs : 1U;
+            pTuner->throughput = throughput;
+        }
+        else
+        {
+            /* A longer range that is slower per byte than the recent ones
+             * queues behind other traffic instead of filling the link. */
+            keepsUp = ( throughput >= ( pTuner->throughput - ( pTuner->throughput >> 2U ) ) );
+
+            pTuner->roundTripTimeMs = pTuner->roundTripTimeMs -
+                                      ( pTuner->roundTripTimeMs >> SMOOTHING_SHIFT ) +
+                                      ( elapsedMs >> SMOOTHING_SHIFT );
+            pTuner->throughput = pTuner->throughput -
+                                 ( pTuner->throughput >> SMOOTHING_SHIFT ) +
+                                 ( throughput >> SMOOTHING_SHIFT );
+        }
+    }
+
+    if( ( succeeded == false ) || ( elapsedMs > pTuner->targetTimeMs ) )
+    {
+        pTuner->length = ( pTuner->length / 2U ) - ( ( pTuner->length / 2U ) % pTuner->stepLength );
+
+        if( pTuner->length < pTuner->stepLength )
+        {
+            pTuner->length = pTuner->stepLength;
+        }
+    }
+    else if( ( keepsUp == true ) &&
+             ( ( pTuner->maxLength - pTuner->length ) >= pTuner->stepLength ) )
+    {
+        pTuner->length += pTuner->stepLength;
+    }
+    else
+    {
+        /* Keep the length at the maximum, or while the throughput falls. */
+    }
+}
+
+/*-----------------------------------------------------------*/
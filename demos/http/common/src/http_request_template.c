@@ -0,0 +1,232 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_request_template.c
+ * @brief Implementation of HTTP request templates with a Range header patched
+ * in place.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Include header for the request templates. */
+#include "http_request_template.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Field name of the Range header, added last to the templates.
+ */
+#define RANGE_HEADER_FIELD           "Range"
+
+/**
+ * @brief Length of #RANGE_HEADER_FIELD.
+ */
+#define RANGE_HEADER_FIELD_LENGTH    ( sizeof( RANGE_HEADER_FIELD ) - 1U )
+
+/**
+ * @brief Unit of the Range header, followed by the positions.
+ */
+#define RANGE_HEADER_UNIT            "bytes="
+
+/**
+ * @brief Length of #RANGE_HEADER_UNIT.
+ */
+#define RANGE_HEADER_UNIT_LENGTH     ( sizeof( RANGE_HEADER_UNIT ) - 1U )
+
+/**
+ * @brief The line separators ending the Range header and the headers.
+ */
+#define HEADERS_END                  "\r\n\r\n"
+
+/**
+ * @brief Length of #HEADERS_END.
+ */
+#define HEADERS_END_LENGTH           ( sizeof( HEADERS_END ) - 1U )
+
+/**
+ * @brief The number of digits of the largest 64-bit position.
+ */
+#define POSITION_MAX_DIGITS          ( 20U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write a position in decimal.
+ *
+ * @param[out] pBuffer The buffer, of at least #POSITION_MAX_DIGITS bytes.
+ * @param[in] position The position.
+ *
+ * @return The number of digits written.
+ */
+static size_t writePosition( uint8_t * pBuffer,
+                             uint64_t position );
+
+/*-----------------------------------------------------------*/
+
+static size_t writePosition( uint8_t * pBuffer,
+                             uint64_t position )
+{
+    uint8_t digits[ POSITION_MAX_DIGITS ];
+    size_t digitCount = 0U;
+    size_t i = 0U;
+    uint64_t remaining = position;
+
+    /* The digits are produced from the least significant one. */
+    do
+    {
+        digits[ digitCount ] = ( uint8_t ) ( '0' + ( remaining % 10U ) );
+        remaining /= 10U;
+        digitCount++;
+    } while( remaining > 0U );
+
+    for( i = 0U; i < digitCount; i++ )
+    {
+        pBuffer[ i ] = digits[ digitCount - 1U - i ];
+    }
+
+    return digitCount;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpRequestTemplate_Init( HttpRequestTemplate_t * pTemplate,
+                                       uint8_t * pBuffer,
+                                       size_t bufferLen,
+                                       const HTTPRequestInfo_t * pRequestInfo )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+
+    if( pTemplate == NULL )
+    {
+        returnStatus = HTTPInvalidParameter;
+    }
+    else
+    {
+        ( void ) memset( pTemplate, 0, sizeof( HttpRequestTemplate_t ) );
+        pTemplate->headers.pBuffer = pBuffer;
+        pTemplate->headers.bufferLen = bufferLen;
+
+        returnStatus = HTTPClient_InitializeRequestHeaders( &pTemplate->headers,
+                                                            pRequestInfo );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpRequestTemplate_AddHeader( HttpRequestTemplate_t * pTemplate,
+                                            const char * pField,
+                                            size_t fieldLen,
+                                            const char * pValue,
+                                            size_t valueLen )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+
+    /* The Range header must stay the last one, for its positions to be
+     * patched at the end of the headers. */
+    if( ( pTemplate == NULL ) || ( pTemplate->rangeOffset != 0U ) )
+    {
+        returnStatus = HTTPInvalidParameter;
+    }
+    else
+    {
+        returnStatus = HTTPClient_AddHeader( &pTemplate->headers,
+                                             pField,
+                                             fieldLen,
+                                             pValue,
+                                             valueLen );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpRequestTemplate_ReserveRange( HttpRequestTemplate_t * pTemplate )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    size_t rangeOffset = 0U;
+
+    if( ( pTemplate == NULL ) || ( pTemplate->rangeOffset != 0U ) )
+    {
+        returnStatus = HTTPInvalidParameter;
+    }
+    else
+    {
+        /* The headers then end with "Range: bytes=\r\n\r\n". */
+        returnStatus = HTTPClient_AddHeader( &pTemplate->headers,
+                                             RANGE_HEADER_FIELD,
+                                             RANGE_HEADER_FIELD_LENGTH,
+                                             RANGE_HEADER_UNIT,
+                                             RANGE_HEADER_UNIT_LENGTH );
+    }
+
+    if( returnStatus == HTTPSuccess )
+    {
+        rangeOffset = pTemplate->headers.headersLen - HEADERS_END_LENGTH;
+
+        if( ( pTemplate->headers.bufferLen - rangeOffset ) < HTTP_REQUEST_TEMPLATE_RANGE_LENGTH )
+        {
+            returnStatus = HTTPInsufficientMemory;
+        }
+        else
+        {
+            pTemplate->rangeOffset = rangeOffset;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HttpRequestTemplate_SetRange( HttpRequestTemplate_t * pTemplate,
+                                           uint64_t start,
+                                           uint64_t end )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    uint8_t * pCursor = NULL;
+
+    if( ( pTemplate == NULL ) || ( pTemplate->rangeOffset == 0U ) || ( end < start ) )
+    {
+        returnStatus = HTTPInvalidParameter;
+    }
+    else
+    {
+        /* The reserved space holds the longest positions, so they are written
+         * without checking the length of the buffer. */
+        pCursor = &pTemplate->headers.pBuffer[ pTemplate->rangeOffset ];
+        pCursor += writePosition( pCursor, start );
+        *pCursor = ( uint8_t ) '-';
+        pCursor++;
+        pCursor += writePosition( pCursor, end );
+        ( void ) memcpy( pCursor, HEADERS_END, HEADERS_END_LENGTH );
+        pCursor += HEADERS_END_LENGTH;
+
+        pTemplate->headers.headersLen = ( size_t ) ( pCursor - pTemplate->headers.pBuffer );
+    }
+
+    return returnStatus;
+}
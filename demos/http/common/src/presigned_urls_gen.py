@@ -33,6 +33,69 @@ def get_presigned_urls(bucket_name, key_name, region_name) -> None:
         print("#define S3_PRESIGNED_" + method + "_URL" + "    " + '"' + url + '"\n')
 
 
+def get_presigned_multipart_urls(bucket_name, key_name, region_name, part_count) -> None:
+    """
+    Initiates a multipart upload of the given object key in the given S3 bucket,
+    then prints the presigned URLs to upload each part and to complete the
+    upload, assigned to the demo specific C macros.
+    Args:
+        bucket_name (str): S3 bucket
+        key_name (str):  S3 object key
+        region_name (str): S3 bucket's region
+        part_count (int): Number of parts of the upload
+    """
+
+    s3 = boto3.client("s3", config=Config(signature_version="s3v4", region_name=region_name))
+
+    # The upload ID is part of the signed query of every URL, so the upload is
+    # initiated here rather than by the demo.
+    upload_id = s3.create_multipart_upload(Bucket=bucket_name, Key=key_name)["UploadId"]
+
+    part_urls = []
+
+    for part_number in range(1, part_count + 1):
+        part_urls.append(
+            s3.generate_presigned_url(
+                ClientMethod="upload_part",
+                Params={"Bucket": bucket_name, "Key": key_name, "UploadId": upload_id, "PartNumber": part_number},
+            )
+        )
+
+    complete_url = s3.generate_presigned_url(
+        ClientMethod="complete_multipart_upload",
+        Params={"Bucket": bucket_name, "Key": key_name, "UploadId": upload_id},
+        HttpMethod="POST",
+    )
+
+    print("#define S3_PRESIGNED_UPLOAD_PART_URLS    { " + ", ".join('"' + url + '"' for url in part_urls) + " }\n")
+    print("#define S3_PRESIGNED_COMPLETE_MULTIPART_URL    " + '"' + complete_url + '"\n')
+
+
+def get_presigned_batch_urls(bucket_name, key_names, region_name) -> None:
+    """
+    Prints the presigned GET URLs of several object keys in the given S3
+    bucket, assigned to the batch download demo C macro.
+    Args:
+        bucket_name (str): S3 bucket
+        key_names (list): S3 object keys
+        region_name (str): S3 bucket's region
+    """
+
+    s3 = boto3.client("s3", config=Config(signature_version="s3v4", region_name=region_name))
+
+    urls = []
+
+    for key_name in key_names:
+        urls.append(
+            s3.generate_presigned_url(
+                ClientMethod="get_object",
+                Params={"Bucket": bucket_name, "Key": key_name},
+            )
+        )
+
+    print("#define S3_PRESIGNED_GET_URLS    { " + ", ".join('"' + url + '"' for url in urls) + " }\n")
+
+
 def main():
     """
     Generate demo C macro strings, on the console, for the input S3 bucket and object key.
@@ -59,10 +122,32 @@ def main():
         dest="region_name",
         help="The region in which the S3 bucket of interest is created.",
     )
+    parser.add_argument(
+        "--parts",
+        action="store",
+        required=False,
+        type=int,
+        dest="part_count",
+        help="Also initiate a multipart upload, and generate the URLs of this many parts.",
+    )
+    parser.add_argument(
+        "--batch-keys",
+        action="store",
+        required=False,
+        nargs="+",
+        dest="batch_key_names",
+        help="Also generate the GET URLs of these objects, for the batch download demo.",
+    )
     args = parser.parse_args()
 
     get_presigned_urls(args.bucket_name, args.key_name, args.region_name)
 
+    if args.part_count is not None:
+        get_presigned_multipart_urls(args.bucket_name, args.key_name, args.region_name, args.part_count)
+
+    if args.batch_key_names is not None:
+        get_presigned_batch_urls(args.bucket_name, args.batch_key_names, args.region_name)
+
 
 if __name__ == "__main__":  # pragma: no cover
     main()
@@ -239,6 +239,7 @@ static int32_t connectToServer( NetworkContext_t * pNetworkContext )
     serverInfo.pHostName = SERVER_HOST;
     serverInfo.hostNameLength = SERVER_HOST_LENGTH;
     serverInfo.port = HTTPS_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Establish a TLS session with the HTTP server. This example connects
      * to the HTTP server as specified in SERVER_HOST and HTTPS_PORT
@@ -398,7 +399,7 @@ int main( int argc,
     TransportInterface_t transportInterface;
     /* The network context for the transport layer interface. */
     NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
+    OpensslParams_t opensslParams = { 0 };
     /* An array of HTTP paths to request. */
     const httpPathStrings_t httpMethodPaths[] =
     {
@@ -189,6 +189,7 @@ static int32_t connectToServer( NetworkContext_t * pNetworkContext )
     serverInfo.pHostName = AWS_IOT_ENDPOINT;
     serverInfo.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
     serverInfo.port = AWS_HTTPS_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Establish a TLS session with the HTTP server. This example connects
      * to the HTTP server as specified in AWS_IOT_ENDPOINT and AWS_HTTPS_PORT
@@ -348,7 +349,7 @@ int main( int argc,
     TransportInterface_t transportInterface;
     /* The network context for the transport layer interface. */
     NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
+    OpensslParams_t opensslParams = { 0 };
 
     ( void ) argc;
     ( void ) argv;
@@ -219,6 +219,7 @@ static int32_t connectToServer( NetworkContext_t * pNetworkContext )
     serverInfo.pHostName = SERVER_HOST;
     serverInfo.hostNameLength = SERVER_HOST_LENGTH;
     serverInfo.port = HTTP_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Establish a TCP connection with the HTTP server. This example connects
      * to the HTTP server as specified in SERVER_HOST and HTTP_PORT
@@ -376,7 +377,7 @@ int main( int argc,
     TransportInterface_t transportInterface;
     /* The network context for the transport layer interface. */
     NetworkContext_t networkContext;
-    PlaintextParams_t plaintextParams;
+    PlaintextParams_t plaintextParams = { 0 };
     /* An array of HTTP paths to request. */
     const httpPathStrings_t httpMethodPaths[] =
     {
@@ -0,0 +1,124 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DEMO_CONFIG_H_
+#define DEMO_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging config definition and header files inclusion are required in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for DEMO.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for DEMO.
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Demo. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "DEMO"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+
+/**
+ * @brief Path of the file containing the server's root CA certificate for TLS
+ * authentication.
+ *
+ * The Baltimore Cybertrust Root CA Certificate is automatically downloaded to
+ * the certificates directory using the CMake build system, from @ref
+ * https://cacerts.digicert.com/BaltimoreCyberTrustRoot.crt.pem.
+ *
+ * @note This certificate should be PEM-encoded.
+ */
+#ifndef ROOT_CA_CERT_PATH
+    #define ROOT_CA_CERT_PATH    "certificates/BaltimoreCyberTrustRoot.crt"
+#endif
+
+/**
+ * @brief The pre-signed GET URLs of the objects to download, generated by the
+ * python script located in common/src/presigned_urls_gen.py with the
+ * --batch-keys option.
+ *
+ * @note This script requires AWS CLI to be configured. For instructions, see
+ * https://docs.aws.amazon.com/cli/latest/userguide/cli-chap-configure.html
+ *
+ * Run this script and paste the output S3_PRESIGNED_GET_URLS below.
+ *
+ * #define S3_PRESIGNED_GET_URLS    { "...insert here...", "...insert here..." }
+ */
+
+/**
+ * @brief Prefix of the paths of the files written, followed by the index of
+ * the object in S3_PRESIGNED_GET_URLS.
+ */
+#define BATCH_FILE_PATH_PREFIX    "batch_object_"
+
+/**
+ * @brief Number of threads downloading, each over its own connection from
+ * the pool.
+ */
+#define HTTP_BATCH_DOWNLOAD_THREAD_COUNT            ( 4U )
+
+/**
+ * @brief Most connections downloading the objects of the same bucket at once.
+ *
+ * @note The objects of a bucket are split into runs of consecutive objects,
+ * each downloaded over one connection.
+ */
+#define HTTP_BATCH_DOWNLOAD_CONNECTIONS_PER_HOST    ( 2U )
+
+/**
+ * @brief Most requests sent over a connection before their responses are
+ * received.
+ *
+ * @note S3 answers pipelined requests in order, so the round trip between
+ * two small objects is not spent idle.
+ */
+#define HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH          ( 4U )
+
+/**
+ * @brief The length in bytes of the buffers of each thread, one for the
+ * requests and one for the response headers.
+ *
+ * @note This should account for the path and query of a pre-signed URL,
+ * which is part of the request line, and which is over 1000 bytes.
+ */
+#define HTTP_BATCH_DOWNLOAD_BUFFER_LENGTH           ( 4096U )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ */
+#define HTTP_BATCH_DOWNLOAD_TIMEOUT_MS              ( 5000U )
+
+#endif /* ifndef DEMO_CONFIG_H_ */
@@ -0,0 +1,267 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+/* Downloading the batch over pooled connections. */
+#include "http_batch_download.h"
+
+/* Pool of the connections to the HTTP servers. */
+#include "http_connection_pool.h"
+
+/* Check that a path for Root CA Certificate is defined. */
+#ifndef ROOT_CA_CERT_PATH
+    #error "Please define a ROOT_CA_CERT_PATH."
+#endif
+
+/* Check that the pre-signed GET URLs are defined. */
+#ifndef S3_PRESIGNED_GET_URLS
+    #error "Please define S3_PRESIGNED_GET_URLS."
+#endif
+
+/* Check that the prefix of the files written is defined. */
+#ifndef BATCH_FILE_PATH_PREFIX
+    #define BATCH_FILE_PATH_PREFIX    "batch_object_"
+#endif
+
+/**
+ * @brief Number of objects of the batch.
+ */
+#define BATCH_OBJECT_COUNT    ( sizeof( batchUrls ) / sizeof( batchUrls[ 0 ] ) )
+
+/**
+ * @brief Size of the buffer of the path of each file written, including the
+ * index of its object and the NULL terminator.
+ */
+#define BATCH_FILE_PATH_LENGTH    ( sizeof( BATCH_FILE_PATH_PREFIX ) + 10U )
+
+/**
+ * @brief The maximum number of times to run the loop in this demo.
+ *
+ * @note The demo loop is attempted to re-run only if it fails in an iteration.
+ * Once the demo loop succeeds in an iteration, the demo exits successfully.
+ */
+#ifndef HTTP_MAX_DEMO_LOOP_COUNT
+    #define HTTP_MAX_DEMO_LOOP_COUNT    ( 3 )
+#endif
+
+/**
+ * @brief Time in seconds to wait between retries of the demo loop if
+ * demo loop fails.
+ */
+#define DELAY_BETWEEN_DEMO_RETRY_ITERATIONS_S    ( 5 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The pre-signed GET URLs of the objects.
+ */
+static const char * const batchUrls[] = S3_PRESIGNED_GET_URLS;
+
+/**
+ * @brief The objects of the batch.
+ */
+static HttpBatchObject_t batchObjects[ BATCH_OBJECT_COUNT ];
+
+/**
+ * @brief The paths of the files written.
+ */
+static char filePaths[ BATCH_OBJECT_COUNT ][ BATCH_FILE_PATH_LENGTH ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Set the URL and file of each object of the batch.
+ */
+static void initializeBatch( void );
+
+/**
+ * @brief Log the result of each object, then the throughput and latencies of
+ * the batch.
+ *
+ * @param[in] pStats The aggregate results of the batch.
+ */
+static void logBatchResults( const HttpBatchDownloadStats_t * pStats );
+
+/*-----------------------------------------------------------*/
+
+static void initializeBatch( void )
+{
+    size_t i = 0U;
+
+    for( i = 0U; i < BATCH_OBJECT_COUNT; i++ )
+    {
+        ( void ) snprintf( filePaths[ i ], sizeof( filePaths[ i ] ), "%s%lu",
+                           BATCH_FILE_PATH_PREFIX, ( unsigned long ) i );
+
+        ( void ) memset( &batchObjects[ i ], 0, sizeof( HttpBatchObject_t ) );
+        batchObjects[ i ].pUrl = batchUrls[ i ];
+        batchObjects[ i ].urlLength = strlen( batchUrls[ i ] );
+        batchObjects[ i ].pFilePath = filePaths[ i ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void logBatchResults( const HttpBatchDownloadStats_t * pStats )
+{
+    size_t i = 0U;
+
+    for( i = 0U; i < BATCH_OBJECT_COUNT; i++ )
+    {
+        if( batchObjects[ i ].downloaded == true )
+        {
+            LogInfo( ( "Downloaded %s: Bytes=%llu, Latency=%ums.",
+                       batchObjects[ i ].pFilePath,
+                       ( unsigned long long ) batchObjects[ i ].bodyLength,
+                       ( unsigned int ) batchObjects[ i ].latencyMs ) );
+        }
+        else
+        {
+            LogError( ( "Failed to download %s: Status Code=%u, Error=%s.",
+                        batchObjects[ i ].pFilePath,
+                        ( unsigned int ) batchObjects[ i ].statusCode,
+                        HTTPClient_strerror( batchObjects[ i ].status ) ) );
+        }
+    }
+
+    LogInfo( ( "Batch of %lu objects: Downloaded=%lu, Failed=%lu, Bytes=%llu, "
+               "Elapsed=%ums, Throughput=%llu B/s.",
+               ( unsigned long ) BATCH_OBJECT_COUNT,
+               ( unsigned long ) pStats->downloadedCount,
+               ( unsigned long ) pStats->failedCount,
+               ( unsigned long long ) pStats->totalBytes,
+               ( unsigned int ) pStats->elapsedMs,
+               ( unsigned long long ) pStats->bytesPerSecond ) );
+    LogInfo( ( "Latency: Min=%ums, Mean=%ums, Max=%ums. Connections=%lu, "
+               "Pipelined requests=%lu.",
+               ( unsigned int ) pStats->minLatencyMs,
+               ( unsigned int ) pStats->meanLatencyMs,
+               ( unsigned int ) pStats->maxLatencyMs,
+               ( unsigned long ) pStats->connectionCount,
+               ( unsigned long ) pStats->pipelinedCount ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry point of demo.
+ *
+ * This example downloads a batch of S3 objects, from the pre-signed GET URLs
+ * of S3_PRESIGNED_GET_URLS, into the files BATCH_FILE_PATH_PREFIX followed by
+ * the index of each object. The objects are grouped by bucket, and the objects
+ * of a bucket share keep-alive connections of the connection pool, so that the
+ * TCP connection and the TLS handshake are not paid for each object. Several
+ * threads download at once, each pipelining up to
+ * HTTP_BATCH_DOWNLOAD_PIPELINE_DEPTH requests over its connection, and each
+ * body is written to its file as it is received.
+ *
+ * The demo logs the size and latency of each object, then the throughput of
+ * the batch. If any object fails, the batch is run again.
+ *
+ * @note This demo requires user-generated pre-signed URLs to be pasted into
+ * demo_config.h. Please use the provided script "presigned_urls_gen.py"
+ * (located in demos/http/common/src) with its --batch-keys option to generate
+ * these URLs.
+ */
+int main( int argc,
+          char ** argv )
+{
+    /* Return value of main. */
+    int32_t returnStatus = EXIT_SUCCESS;
+    /* Return value of the batch download. */
+    HttpBatchDownloadStatus_t batchStatus = HTTP_BATCH_DOWNLOAD_SUCCESS;
+    HttpBatchDownloadStats_t stats;
+    int demoRunCount = 0;
+
+    ( void ) argc;
+    ( void ) argv;
+
+    LogInfo( ( "HTTP Client S3 batch download demo of %lu objects.",
+               ( unsigned long ) BATCH_OBJECT_COUNT ) );
+
+    do
+    {
+        /******************** Download the batch. **************************/
+
+        /* The TLS connections are established by the connection pool, with
+         * retries and backoff, when the first object of a bucket is requested
+         * and whenever the server closes a connection. */
+        initializeBatch();
+        batchStatus = HttpBatchDownload_Run( batchObjects,
+                                             BATCH_OBJECT_COUNT,
+                                             ROOT_CA_CERT_PATH,
+                                             &stats );
+
+        if( ( batchStatus == HTTP_BATCH_DOWNLOAD_SUCCESS ) || ( batchStatus == HTTP_BATCH_DOWNLOAD_PARTIAL ) )
+        {
+            logBatchResults( &stats );
+        }
+
+        returnStatus = ( batchStatus == HTTP_BATCH_DOWNLOAD_SUCCESS ) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+        /************************** Disconnect. *****************************/
+
+        /* End the TLS sessions, then close the TCP connections. */
+        ConnectionPool_CloseAll();
+
+        /******************* Retry in case of failure. **********************/
+
+        /* Increment the demo run count. */
+        demoRunCount++;
+
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            LogInfo( ( "Demo iteration %d is successful.", demoRunCount ) );
+        }
+        /* Attempt to retry a failed iteration of demo for up to #HTTP_MAX_DEMO_LOOP_COUNT times. */
+        else if( demoRunCount < HTTP_MAX_DEMO_LOOP_COUNT )
+        {
+            LogWarn( ( "Demo iteration %d failed. Retrying...", demoRunCount ) );
+            sleep( DELAY_BETWEEN_DEMO_RETRY_ITERATIONS_S );
+        }
+        /* Failed all #HTTP_MAX_DEMO_LOOP_COUNT demo iterations. */
+        else
+        {
+            LogError( ( "All %d demo iterations failed.", HTTP_MAX_DEMO_LOOP_COUNT ) );
+            break;
+        }
+    } while( returnStatus != EXIT_SUCCESS );
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        /* Log a message indicating an iteration completed successfully. */
+        LogInfo( ( "Demo completed successfully." ) );
+    }
+
+    return returnStatus;
+}
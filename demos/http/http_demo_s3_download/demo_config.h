@@ -101,6 +101,15 @@
  */
 #define USER_BUFFER_LENGTH                ( 4096 )
 
+/**
+ * @brief The length in bytes of the buffer holding the range request,
+ * serialized once for all the ranges of the file.
+ *
+ * @note This should account for the path of the pre-signed URL, which is
+ * part of the request line.
+ */
+#define REQUEST_TEMPLATE_BUFFER_LENGTH    ( 2048 )
+
 /**
  * @brief The size of the range of the file to download, with each request.
  *
@@ -110,4 +119,75 @@
  */
 #define RANGE_REQUEST_LENGTH              ( 2048 )
 
+/**
+ * @brief Set to 1 to read the size of the file from the Content-Range header
+ * of the first range, instead of from a bytes=0-0 request sent before it.
+ *
+ * @note This saves a round trip per download, and a file shorter than
+ * RANGE_REQUEST_LENGTH is downloaded with a single request.
+ */
+#define RANGE_SIZE_DISCOVERY_ENABLED      ( 1 )
+
+/**
+ * @brief Set to 1 to adapt the length of the ranges to the link, starting
+ * from RANGE_REQUEST_LENGTH.
+ *
+ * @note The length grows by RANGE_REQUEST_STEP_LENGTH after each range
+ * received in less than half of TRANSPORT_SEND_RECV_TIMEOUT_MS, up to
+ * RANGE_REQUEST_MAX_LENGTH, and is halved after a slower range or a failed
+ * request. Raise USER_BUFFER_LENGTH and RANGE_REQUEST_MAX_LENGTH together to
+ * let fast links use longer ranges.
+ */
+#define ADAPTIVE_RANGE_LENGTH_ENABLED     ( 1 )
+
+/**
+ * @brief The longest range when ADAPTIVE_RANGE_LENGTH_ENABLED is 1, leaving
+ * room in the user buffer for the response headers.
+ */
+#define RANGE_REQUEST_MAX_LENGTH          ( USER_BUFFER_LENGTH - 1024 )
+
+/**
+ * @brief The additive increase of the length of the ranges when
+ * ADAPTIVE_RANGE_LENGTH_ENABLED is 1, and their shortest length.
+ */
+#define RANGE_REQUEST_STEP_LENGTH         ( 512 )
+
+/**
+ * @brief Set to 1 to download the whole file with a single GET request, with
+ * the body passed to a callback as it is received.
+ *
+ * @note The user buffer then only needs to hold the request and the response
+ * headers, so files of any size are downloaded without the headers of a range
+ * request and response for each RANGE_REQUEST_LENGTH bytes.
+ */
+#define STREAMING_DOWNLOAD_ENABLED        ( 0 )
+
+/**
+ * @brief Set to 1 to decompress the file as it is streamed, for S3 objects
+ * stored compressed with gzip or zlib. Requires STREAMING_DOWNLOAD_ENABLED.
+ *
+ * @note The decompressed file is passed to the body callback in pieces of
+ * HTTP_BODY_INFLATE_BUFFER_LENGTH bytes, so memory use does not depend on the
+ * size of the file.
+ */
+#define GZIP_DOWNLOAD_ENABLED             ( 0 )
+
+/**
+ * @brief Set to 1 to download the file in ranges of RANGE_REQUEST_LENGTH
+ * bytes with DOWNLOAD_PIPELINE_DEPTH requests in flight over the connection,
+ * instead of waiting for each response before the next request. Cannot be
+ * combined with STREAMING_DOWNLOAD_ENABLED.
+ *
+ * @note The server then has the next request while it sends a range, so the
+ * round trip between two ranges is not spent idle. The ranges are not held
+ * whole in the user buffer, which only needs to hold the response headers.
+ */
+#define PIPELINED_DOWNLOAD_ENABLED        ( 0 )
+
+/**
+ * @brief The most range requests without a response at a time, when
+ * PIPELINED_DOWNLOAD_ENABLED is 1.
+ */
+#define DOWNLOAD_PIPELINE_DEPTH           ( 4U )
+
 #endif /* ifndef DEMO_CONFIG_H_ */
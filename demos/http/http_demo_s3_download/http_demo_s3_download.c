@@ -35,6 +35,21 @@
 /* Common HTTP demo utilities. */
 #include "http_demo_utils.h"
 
+/* Pool of the connections to the HTTP server. */
+#include "http_connection_pool.h"
+
+/* Receiving response bodies as they arrive. */
+#include "http_body_stream.h"
+
+/* Include header for the body decompression stage. */
+#include "http_body_inflate.h"
+
+/* Requests serialized once, with the Range header patched in place. */
+#include "http_request_template.h"
+
+/* Adapting the length of the ranges to the link. */
+#include "http_range_tuner.h"
+
 /* HTTP API header. */
 #include "core_http_client.h"
 
@@ -44,6 +59,9 @@
 /*Include backoff algorithm header for retry logic.*/
 #include "backoff_algorithm.h"
 
+/* Trace probes of the range requests. */
+#include "trace_probes.h"
+
 /* Check that TLS port of the server is defined. */
 #ifndef HTTPS_PORT
     #error "Please define a HTTPS_PORT."
@@ -69,11 +87,66 @@
     #define USER_BUFFER_LENGTH    ( 4096 )
 #endif
 
+/* Check that size of the request template buffer is defined. */
+#ifndef REQUEST_TEMPLATE_BUFFER_LENGTH
+    #define REQUEST_TEMPLATE_BUFFER_LENGTH    ( 2048 )
+#endif
+
 /* Check that size of the file download buffer is defined. */
 #ifndef FILE_BUFFER_LENGTH
     #define FILE_BUFFER_LENGTH    ( 2048 )
 #endif
 
+/* Check whether the file is downloaded with a single streamed request. */
+#ifndef STREAMING_DOWNLOAD_ENABLED
+    #define STREAMING_DOWNLOAD_ENABLED    ( 0 )
+#endif
+
+/* Check whether the streamed file is decompressed as it is received. */
+#ifndef GZIP_DOWNLOAD_ENABLED
+    #define GZIP_DOWNLOAD_ENABLED    ( 0 )
+#endif
+
+/* Check whether the size of the file is read from the first range. */
+#ifndef RANGE_SIZE_DISCOVERY_ENABLED
+    #define RANGE_SIZE_DISCOVERY_ENABLED    ( 1 )
+#endif
+
+/* Check whether the ranges are requested with several requests in flight. */
+#ifndef PIPELINED_DOWNLOAD_ENABLED
+    #define PIPELINED_DOWNLOAD_ENABLED    ( 0 )
+#endif
+
+/* The most pipelined range requests without a response at a time. */
+#ifndef DOWNLOAD_PIPELINE_DEPTH
+    #define DOWNLOAD_PIPELINE_DEPTH    ( 4U )
+#endif
+
+/* Check whether the length of the ranges adapts to the link. */
+#ifndef ADAPTIVE_RANGE_LENGTH_ENABLED
+    #define ADAPTIVE_RANGE_LENGTH_ENABLED    ( 0 )
+#endif
+
+/* The longest range, leaving room for the response headers in the user
+ * buffer. */
+#ifndef RANGE_REQUEST_MAX_LENGTH
+    #define RANGE_REQUEST_MAX_LENGTH    ( USER_BUFFER_LENGTH - 1024 )
+#endif
+
+/* The additive increase of the length of the ranges, and their shortest
+ * length. */
+#ifndef RANGE_REQUEST_STEP_LENGTH
+    #define RANGE_REQUEST_STEP_LENGTH    ( 512 )
+#endif
+
+#if ( GZIP_DOWNLOAD_ENABLED == 1 ) && ( STREAMING_DOWNLOAD_ENABLED != 1 )
+    #error "GZIP_DOWNLOAD_ENABLED requires STREAMING_DOWNLOAD_ENABLED to be 1."
+#endif
+
+#if ( PIPELINED_DOWNLOAD_ENABLED == 1 ) && ( STREAMING_DOWNLOAD_ENABLED == 1 )
+    #error "PIPELINED_DOWNLOAD_ENABLED and STREAMING_DOWNLOAD_ENABLED cannot both be 1."
+#endif
+
 /**
  * @brief Length of the pre-signed GET URL defined in demo_config.h.
  */
@@ -99,6 +172,11 @@
  */
 #define HTTP_STATUS_CODE_PARTIAL_CONTENT          206
 
+/**
+ * @brief HTTP status code returned for the whole content.
+ */
+#define HTTP_STATUS_CODE_OK                       200
+
 /**
  * @brief The maximum number of times to run the loop in this demo.
  *
@@ -121,14 +199,23 @@
  *
  * @note This demo shows how the same buffer can be re-used for storing the HTTP
  * response after the HTTP request is sent out. However, the user can decide how
- * to use buffers to store HTTP requests and responses.
+ * to use buffers to store HTTP requests and responses. The range requests are
+ * stored in #requestTemplateBuffer instead.
  */
 static uint8_t userBuffer[ USER_BUFFER_LENGTH ];
 
 /**
- * @brief Represents header data that will be sent in an HTTP request.
+ * @brief The buffer of #requestTemplate.
+ *
+ * @note The request is kept apart from #userBuffer, where the responses would
+ * overwrite it.
+ */
+static uint8_t requestTemplateBuffer[ REQUEST_TEMPLATE_BUFFER_LENGTH ];
+
+/**
+ * @brief The range request, serialized once for all the ranges of the file.
  */
-static HTTPRequestHeaders_t requestHeaders;
+static HttpRequestTemplate_t requestTemplate;
 
 /**
  * @brief Configurations of the initial request headers that are passed to
@@ -142,64 +229,107 @@ static HTTPRequestInfo_t requestInfo;
 static HTTPResponse_t response;
 
 /**
- * @brief The host address string extracted from the pre-signed URL.
- *
- * @note S3_PRESIGNED_GET_URL_LENGTH is set as the array length here as the
- * length of the host name string cannot exceed this value.
+ * @brief The pre-signed URL, parsed by the first call to
+ * #initializeServerInfo.
  */
-static char serverHost[ S3_PRESIGNED_GET_URL_LENGTH ];
+static ParsedUrl_t presignedUrl;
 
 /**
- * @brief The length of the host address found in the pre-signed URL.
+ * @brief The host address string extracted from the pre-signed URL.
  */
-static size_t serverHostLength;
+static char serverHost[ URL_MAX_HOST_LENGTH + 1U ];
 
 /**
  * @brief The location of the path within the pre-signed URL.
  */
 static const char * pPath;
 
-/*-----------------------------------------------------------*/
+/**
+ * @brief Information about the server to send the HTTP requests.
+ */
+static ServerInfo_t serverInfo;
 
-/* Each compilation unit must define the NetworkContext struct. */
-struct NetworkContext
-{
-    OpensslParams_t * pParams;
-};
+/**
+ * @brief Credentials to establish the TLS connections to the server.
+ */
+static OpensslCredentials_t opensslCredentials;
+
+#if ( GZIP_DOWNLOAD_ENABLED == 1 )
+
+/**
+ * @brief The state of the decompression of the streamed file.
+ */
+    static HttpBodyInflateContext_t inflateContext;
+#endif
+
+#if ( ADAPTIVE_RANGE_LENGTH_ENABLED == 1 )
+
+/**
+ * @brief The length of the ranges, kept across the iterations of the demo so
+ * that a retry after a timeout starts with shorter ranges.
+ */
+    static HttpRangeTuner_t rangeTuner;
+#endif
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Connect to HTTP server with reconnection retries.
+ * @brief Initialize the server information and credentials of the
+ * connections to the host of the pre-signed URL.
  *
- * @param[out] pNetworkContext The output parameter to return the created
- * network context.
+ * The pre-signed URL is parsed on the first call only.
  *
- * @return EXIT_FAILURE on failure; EXIT_SUCCESS on successful connection.
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on success.
  */
-static int32_t connectToServer( NetworkContext_t * pNetworkContext );
+static int32_t initializeServerInfo( void );
+
+/**
+ * @brief Send an HTTP request over a connection checked out from the
+ * connection pool, and receive its response.
+ *
+ * The connection is kept open for the next request unless the request fails
+ * or the server closes the connection, in which case the next request
+ * establishes a new connection.
+ *
+ * @param[in] pRequestHeaders The headers of the request.
+ * @param[out] pResponse The response to the request.
+ *
+ * @return The status returned by #HTTPClient_Send, or #HTTPNetworkError if no
+ * connection could be established.
+ */
+static HTTPStatus_t sendHttpRequest( HTTPRequestHeaders_t * pRequestHeaders,
+                                     HTTPResponse_t * pResponse );
 
 /**
  * @brief Send multiple HTTP GET requests, based on a specified path, to
  * download a file in chunks from the host S3 server.
  *
- * @param[in] pTransportInterface The transport interface for making network
- * calls.
  * @param[in] pPath The Request-URI to the objects of interest. This string
  * should be null-terminated.
  *
  * @return The status of the file download using multiple GET requests to the
  * server: true on success, false on failure.
  */
-static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterface,
-                                  const char * pPath );
+static bool downloadS3ObjectFile( const char * pPath );
+
+/**
+ * @brief Read the size of the S3 object from the Content-Range header of a
+ * range response, which looks like: "Content-Range: bytes 0-0/FILESIZE".
+ *
+ * @param[in] pResponse The 206 response to a range request.
+ * @param[out] pFileSize The size of the S3 object.
+ *
+ * @return true if the header holds a valid size, false otherwise.
+ */
+static bool readS3ObjectFileSize( HTTPResponse_t * pResponse,
+                                  size_t * pFileSize );
+
+#if ( RANGE_SIZE_DISCOVERY_ENABLED == 0 )
 
 /**
  * @brief Retrieve the size of the S3 object that is specified in pPath.
  *
  * @param[out] pFileSize The size of the S3 object.
- * @param[in] pTransportInterface The transport interface for making network
- * calls.
  * @param[in] pHost The server host address. This string must be
  * null-terminated.
  * @param[in] hostLen The length of the server host address.
@@ -209,75 +339,158 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
  * @return The status of the file size acquisition using a GET request to the
  * server: true on success, false on failure.
  */
-static bool getS3ObjectFileSize( size_t * pFileSize,
-                                 const TransportInterface_t * pTransportInterface,
-                                 const char * pHost,
-                                 size_t hostLen,
-                                 const char * pPath );
+    static bool getS3ObjectFileSize( size_t * pFileSize,
+                                     const char * pHost,
+                                     size_t hostLen,
+                                     const char * pPath );
+#endif /* if ( RANGE_SIZE_DISCOVERY_ENABLED == 0 ) */
 
-/*-----------------------------------------------------------*/
+#if ( STREAMING_DOWNLOAD_ENABLED == 1 ) || ( PIPELINED_DOWNLOAD_ENABLED == 1 )
 
-static int32_t connectToServer( NetworkContext_t * pNetworkContext )
-{
-    int32_t returnStatus = EXIT_FAILURE;
-    HTTPStatus_t httpStatus = HTTPSuccess;
+/**
+ * @brief Receive a part of the body of the S3 object.
+ *
+ * @param[in] pContext The number of bytes of the body received so far.
+ * @param[in] offset The position of @p pData in the body.
+ * @param[in] pData The part of the body.
+ * @param[in] dataLength The length of @p pData.
+ *
+ * @return true to receive the rest of the body.
+ */
+    static bool receiveS3ObjectData( void * pContext,
+                                     uint64_t offset,
+                                     const uint8_t * pData,
+                                     size_t dataLength );
+#endif /* if ( STREAMING_DOWNLOAD_ENABLED == 1 ) || ( PIPELINED_DOWNLOAD_ENABLED == 1 ) */
 
-    /* The location of the host address within the pre-signed URL. */
-    const char * pAddress = NULL;
+#if ( STREAMING_DOWNLOAD_ENABLED == 1 )
 
-    /* Status returned by OpenSSL transport implementation. */
-    OpensslStatus_t opensslStatus;
-    /* Credentials to establish the TLS connection. */
-    OpensslCredentials_t opensslCredentials = { 0 };
-    /* Information about the server to send the HTTP requests. */
-    ServerInfo_t serverInfo = { 0 };
+/**
+ * @brief Download the S3 object specified in pPath with a single GET request,
+ * receiving the body in the user buffer as many times as needed.
+ *
+ * When GZIP_DOWNLOAD_ENABLED is 1, the object is compressed with gzip or zlib,
+ * and is decompressed as it is received, before #receiveS3ObjectData.
+ *
+ * @param[in] pPath The Request-URI to the objects of interest. This string
+ * should be null-terminated.
+ *
+ * @return The status of the file download: true on success, false on failure.
+ */
+    static bool streamS3ObjectFile( const char * pPath );
+#endif /* if ( STREAMING_DOWNLOAD_ENABLED == 1 ) */
 
-    /* Retrieve the address location and length from S3_PRESIGNED_GET_URL. */
-    httpStatus = getUrlAddress( S3_PRESIGNED_GET_URL,
-                                S3_PRESIGNED_GET_URL_LENGTH,
-                                &pAddress,
-                                &serverHostLength );
-    returnStatus = ( httpStatus == HTTPSuccess ) ? EXIT_SUCCESS : EXIT_FAILURE;
+#if ( PIPELINED_DOWNLOAD_ENABLED == 1 )
 
-    if( returnStatus == EXIT_SUCCESS )
+/**
+ * @brief Download the S3 object specified in pPath in ranges of
+ * RANGE_REQUEST_LENGTH bytes, with up to DOWNLOAD_PIPELINE_DEPTH requests in
+ * flight over the connection.
+ *
+ * When the server closes the connection, the download resumes from the bytes
+ * received so far on a new connection from the pool.
+ *
+ * @param[in] pPath The Request-URI to the objects of interest. This string
+ * should be null-terminated.
+ *
+ * @return The status of the file download: true on success, false on failure.
+ */
+    static bool pipelineS3ObjectFile( const char * pPath );
+#endif /* if ( PIPELINED_DOWNLOAD_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static int32_t initializeServerInfo( void )
+{
+    int32_t returnStatus = EXIT_SUCCESS;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+
+    /* The components of the parsed URL are offsets into S3_PRESIGNED_GET_URL,
+     * so the URL is only parsed by the first demo iteration. */
+    if( presignedUrl.pUrl == NULL )
     {
+        httpStatus = parseUrl( S3_PRESIGNED_GET_URL,
+                               S3_PRESIGNED_GET_URL_LENGTH,
+                               &presignedUrl );
+
         /* serverHost should consist only of the host address located in
          * S3_PRESIGNED_GET_URL. */
-        memcpy( serverHost, pAddress, serverHostLength );
-        serverHost[ serverHostLength ] = '\0';
+        if( ( httpStatus != HTTPSuccess ) ||
+            ( copyUrlHost( &presignedUrl, serverHost, sizeof( serverHost ) ) == false ) )
+        {
+            presignedUrl.pUrl = NULL;
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            /* The path used for the requests in this demo needs all the query
+             * information following the location of the object, to the end
+             * of the S3 presigned URL. */
+            pPath = &S3_PRESIGNED_GET_URL[ presignedUrl.requestTarget.offset ];
+        }
+    }
 
+    if( returnStatus == EXIT_SUCCESS )
+    {
         /* Initialize TLS credentials. */
+        ( void ) memset( &opensslCredentials, 0, sizeof( opensslCredentials ) );
         opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
         opensslCredentials.sniHostName = serverHost;
+        /* Download with the AEAD that is fastest on this CPU. */
+        opensslCredentials.cipherPolicy = OPENSSL_CIPHERS_AUTO;
 
-        /* Initialize server information. */
+        /* Initialize server information. This example connects to the HTTP
+         * server as specified in S3_PRESIGNED_GET_URL and HTTPS_PORT in
+         * demo_config.h. */
+        ( void ) memset( &serverInfo, 0, sizeof( serverInfo ) );
         serverInfo.pHostName = serverHost;
-        serverInfo.hostNameLength = serverHostLength;
+        serverInfo.hostNameLength = presignedUrl.host.length;
         serverInfo.port = HTTPS_PORT;
+    }
 
-        /* Establish a TLS session with the HTTP server. This example connects
-         * to the HTTP server as specified in S3_PRESIGNED_GET_URL and HTTPS_PORT in
-         * demo_config.h. */
-        LogInfo( ( "Establishing a TLS session with %s:%d.",
-                   serverHost,
-                   HTTPS_PORT ) );
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t sendHttpRequest( HTTPRequestHeaders_t * pRequestHeaders,
+                                     HTTPResponse_t * pResponse )
+{
+    HTTPStatus_t httpStatus = HTTPNetworkError;
+    ConnectionPoolStatus_t poolStatus = CONNECTION_POOL_SUCCESS;
+    /* The transport layer interface used by the HTTP Client library. */
+    TransportInterface_t transportInterface;
 
-        opensslStatus = Openssl_Connect( pNetworkContext,
-                                         &serverInfo,
-                                         &opensslCredentials,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS );
+    /* Reuse the connection of the previous request if the server kept it
+     * open, or else establish a new connection with retries and backoff. */
+    poolStatus = ConnectionPool_Checkout( &serverInfo,
+                                          &opensslCredentials,
+                                          TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                          &transportInterface );
 
-        returnStatus = ( opensslStatus == OPENSSL_SUCCESS ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if( poolStatus == CONNECTION_POOL_SUCCESS )
+    {
+        httpStatus = HTTPClient_Send( &transportInterface,
+                                      pRequestHeaders,
+                                      NULL,
+                                      0,
+                                      pResponse,
+                                      0 );
+
+        ConnectionPool_Checkin( &transportInterface, httpStatus, pResponse );
+    }
+    else
+    {
+        LogError( ( "Failed to connect to HTTP server %s.",
+                    serverHost ) );
     }
 
-    return returnStatus;
+    return httpStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterface,
-                                  const char * pPath )
+static bool downloadS3ObjectFile( const char * pPath )
 {
     bool returnStatus = false;
     HTTPStatus_t httpStatus = HTTPSuccess;
@@ -291,16 +504,18 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
     /* curByte indicates which starting byte we want to download next. */
     size_t curByte = 0;
 
+    /* Whether fileSize holds the size of the file. */
+    bool sizeKnown = true;
+
     assert( pPath != NULL );
 
     /* Initialize all HTTP Client library API structs to 0. */
-    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
     ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
     ( void ) memset( &response, 0, sizeof( response ) );
 
     /* Initialize the request object. */
     requestInfo.pHost = serverHost;
-    requestInfo.hostLen = serverHostLength;
+    requestInfo.hostLen = presignedUrl.host.length;
     requestInfo.pMethod = HTTP_METHOD_GET;
     requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
     requestInfo.pPath = pPath;
@@ -311,67 +526,97 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
      * order to download the file in parts. */
     requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
 
-    /* Set the buffer used for storing request headers. */
-    requestHeaders.pBuffer = userBuffer;
-    requestHeaders.bufferLen = USER_BUFFER_LENGTH;
-
-    /* Initialize the response object. The same buffer used for storing request
-     * headers is reused here. */
+    /* Initialize the response object. The request headers are held by the
+     * request template instead. */
     response.pBuffer = userBuffer;
     response.bufferLen = USER_BUFFER_LENGTH;
 
-    /* Verify the file exists by retrieving the file size. */
-    returnStatus = getS3ObjectFileSize( &fileSize,
-                                        pTransportInterface,
-                                        serverHost,
-                                        serverHostLength,
-                                        pPath );
+    /* Serialize the request line and the headers once. Only the positions of
+     * the Range header change from one request to the next. */
+    httpStatus = HttpRequestTemplate_Init( &requestTemplate,
+                                           requestTemplateBuffer,
+                                           REQUEST_TEMPLATE_BUFFER_LENGTH,
+                                           &requestInfo );
 
-    if( fileSize < RANGE_REQUEST_LENGTH )
+    if( httpStatus == HTTPSuccess )
     {
-        numReqBytes = fileSize;
-    }
-    else
-    {
-        numReqBytes = RANGE_REQUEST_LENGTH;
+        httpStatus = HttpRequestTemplate_ReserveRange( &requestTemplate );
     }
 
-    /* Here we iterate sending byte range requests until the full file has been
-     * downloaded. We keep track of the next byte to download with curByte. When
-     * this reaches the fileSize we stop downloading. */
-    while( ( returnStatus == true ) && ( httpStatus == HTTPSuccess ) && ( curByte < fileSize ) )
+    if( httpStatus != HTTPSuccess )
     {
-        httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
-                                                          &requestInfo );
+        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+                    HTTPClient_strerror( httpStatus ) ) );
+    }
 
-        if( httpStatus == HTTPSuccess )
+    #if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 )
+        /* The size of the file is read from the response to the first range,
+         * so the first request asks for a whole range. A file shorter than a
+         * range is then downloaded with a single request. */
+        returnStatus = true;
+        sizeKnown = false;
+        numReqBytes = RANGE_REQUEST_LENGTH;
+    #else
+        /* Verify the file exists by retrieving the file size. */
+        returnStatus = getS3ObjectFileSize( &fileSize,
+                                            serverHost,
+                                            presignedUrl.host.length,
+                                            pPath );
+
+        if( fileSize < RANGE_REQUEST_LENGTH )
         {
-            httpStatus = HTTPClient_AddRangeHeader( &requestHeaders,
-                                                    curByte,
-                                                    curByte + numReqBytes - 1 );
+            numReqBytes = fileSize;
         }
         else
         {
-            LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
+            numReqBytes = RANGE_REQUEST_LENGTH;
         }
+    #endif /* if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 ) */
+
+    /* Here we iterate sending byte range requests until the full file has been
+     * downloaded. We keep track of the next byte to download with curByte. When
+     * this reaches the fileSize we stop downloading. */
+    while( ( returnStatus == true ) && ( httpStatus == HTTPSuccess ) &&
+           ( ( curByte < fileSize ) || ( sizeKnown == false ) ) )
+    {
+        #if ( ADAPTIVE_RANGE_LENGTH_ENABLED == 1 )
+            numReqBytes = HttpRangeTuner_Start( &rangeTuner );
+
+            if( ( sizeKnown == true ) && ( ( fileSize - curByte ) < numReqBytes ) )
+            {
+                numReqBytes = fileSize - curByte;
+            }
+        #endif
+
+        httpStatus = HttpRequestTemplate_SetRange( &requestTemplate,
+                                                   curByte,
+                                                   curByte + numReqBytes - 1U );
 
         if( httpStatus == HTTPSuccess )
         {
-            LogInfo( ( "Downloading bytes %d-%d, out of %d total bytes, from %s...:  ",
-                       ( int32_t ) ( curByte ),
-                       ( int32_t ) ( curByte + numReqBytes - 1 ),
-                       ( int32_t ) fileSize,
-                       serverHost ) );
+            if( sizeKnown == true )
+            {
+                LogInfo( ( "Downloading bytes %d-%d, out of %d total bytes, from %s...:  ",
+                           ( int32_t ) ( curByte ),
+                           ( int32_t ) ( curByte + numReqBytes - 1 ),
+                           ( int32_t ) fileSize,
+                           serverHost ) );
+            }
+            else
+            {
+                LogInfo( ( "Downloading bytes %d-%d, and the size of the file, from %s...:  ",
+                           ( int32_t ) ( curByte ),
+                           ( int32_t ) ( curByte + numReqBytes - 1 ),
+                           serverHost ) );
+            }
+
             LogDebug( ( "Request Headers:\n%.*s",
-                        ( int32_t ) requestHeaders.headersLen,
-                        ( char * ) requestHeaders.pBuffer ) );
-            httpStatus = HTTPClient_Send( pTransportInterface,
-                                          &requestHeaders,
-                                          NULL,
-                                          0,
-                                          &response,
-                                          0 );
+                        ( int32_t ) requestTemplate.headers.headersLen,
+                        ( char * ) requestTemplate.headers.pBuffer ) );
+            TRACE_PROBE2( http_range_start, curByte, curByte + numReqBytes - 1 );
+            httpStatus = sendHttpRequest( &requestTemplate.headers,
+                                          &response );
+            TRACE_PROBE3( http_range_done, httpStatus, response.statusCode, response.contentLength );
         }
         else
         {
@@ -390,16 +635,27 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
                        ( int32_t ) response.bodyLen,
                        response.pBody ) );
 
-            /* We increment by the content length because the server may not
-             * have sent us the range we request. */
-            curByte += response.contentLength;
+            returnStatus = ( response.statusCode == HTTP_STATUS_CODE_PARTIAL_CONTENT ) ? true : false;
 
-            if( ( fileSize - curByte ) < numReqBytes )
+            if( ( returnStatus == true ) && ( sizeKnown == false ) )
             {
-                numReqBytes = fileSize - curByte;
+                /* The Content-Range of the first range holds the size of the
+                 * file the remaining ranges are requested from. */
+                returnStatus = readS3ObjectFileSize( &response, &fileSize );
+                sizeKnown = true;
             }
 
-            returnStatus = ( response.statusCode == HTTP_STATUS_CODE_PARTIAL_CONTENT ) ? true : false;
+            if( returnStatus == true )
+            {
+                /* We increment by the content length because the server may
+                 * not have sent us the range we request. */
+                curByte += response.contentLength;
+
+                if( ( fileSize - curByte ) < numReqBytes )
+                {
+                    numReqBytes = fileSize - curByte;
+                }
+            }
         }
         else
         {
@@ -414,6 +670,22 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
                         "(Status Code: %u).",
                         response.statusCode ) );
         }
+
+        #if ( ADAPTIVE_RANGE_LENGTH_ENABLED == 1 )
+            if( ( returnStatus == true ) && ( httpStatus == HTTPSuccess ) )
+            {
+                HttpRangeTuner_Finish( &rangeTuner, ( size_t ) response.contentLength, true );
+            }
+            else
+            {
+                HttpRangeTuner_Finish( &rangeTuner, 0U, false );
+            }
+
+            LogDebug( ( "Next range is %lu bytes: RoundTripTimeMs=%lu, Throughput=%llu B/s.",
+                        ( unsigned long ) rangeTuner.length,
+                        ( unsigned long ) rangeTuner.roundTripTimeMs,
+                        ( unsigned long long ) rangeTuner.throughput ) );
+        #endif
     }
 
     return( ( returnStatus == true ) && ( httpStatus == HTTPSuccess ) );
@@ -421,18 +693,133 @@ static bool downloadS3ObjectFile( const TransportInterface_t * pTransportInterfa
 
 /*-----------------------------------------------------------*/
 
-static bool getS3ObjectFileSize( size_t * pFileSize,
-                                 const TransportInterface_t * pTransportInterface,
-                                 const char * pHost,
-                                 size_t hostLen,
-                                 const char * pPath )
+#if ( RANGE_SIZE_DISCOVERY_ENABLED == 0 )
+
+    static bool getS3ObjectFileSize( size_t * pFileSize,
+                                     const char * pHost,
+                                     size_t hostLen,
+                                     const char * pPath )
+    {
+        bool returnStatus = true;
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        HTTPRequestHeaders_t requestHeaders;
+        HTTPRequestInfo_t requestInfo;
+        HTTPResponse_t response;
+        uint8_t userBuffer[ USER_BUFFER_LENGTH ];
+
+        assert( pHost != NULL );
+        assert( pPath != NULL );
+
+        /* Initialize all HTTP Client library API structs to 0. */
+        ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+        ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+        ( void ) memset( &response, 0, sizeof( response ) );
+
+        /* Initialize the request object. */
+        requestInfo.pHost = pHost;
+        requestInfo.hostLen = hostLen;
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
+        requestInfo.pPath = pPath;
+        requestInfo.pathLen = strlen( pPath );
+
+        /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
+         * can be sent over the same established TCP connection. This is done in
+         * order to download the file in parts. */
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        /* Set the buffer used for storing request headers. */
+        requestHeaders.pBuffer = userBuffer;
+        requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+
+        /* Initialize the response object. The same buffer used for storing request
+         * headers is reused here. */
+        response.pBuffer = userBuffer;
+        response.bufferLen = USER_BUFFER_LENGTH;
+
+        LogInfo( ( "Getting file object size from host..." ) );
+
+        httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                                          &requestInfo );
+
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
+        }
+
+        if( returnStatus == true )
+        {
+            /* Add the header to get bytes=0-0. S3 will respond with a Content-Range
+             * header that contains the size of the file in it. This header will
+             * look like: "Content-Range: bytes 0-0/FILESIZE". The body will have a
+             * single byte that we are ignoring. */
+            httpStatus = HTTPClient_AddRangeHeader( &requestHeaders, 0, 0 );
+
+            if( httpStatus != HTTPSuccess )
+            {
+                LogError( ( "Failed to add Range header to request headers: Error=%s.",
+                            HTTPClient_strerror( httpStatus ) ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            /* Send the request and receive the response. */
+            httpStatus = sendHttpRequest( &requestHeaders,
+                                          &response );
+
+            if( httpStatus != HTTPSuccess )
+            {
+                LogError( ( "Failed to send HTTP GET request to %s%s: Error=%s.",
+                            pHost, pPath, HTTPClient_strerror( httpStatus ) ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            LogDebug( ( "Received HTTP response from %s%s...",
+                        pHost, pPath ) );
+            LogDebug( ( "Response Headers:\n%.*s",
+                        ( int32_t ) response.headersLen,
+                        response.pHeaders ) );
+            LogDebug( ( "Response Body:\n%.*s\n",
+                        ( int32_t ) response.bodyLen,
+                        response.pBody ) );
+
+            if( response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
+            {
+                LogError( ( "Received an invalid response from the server "
+                            "(Status Code: %u).",
+                            response.statusCode ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            LogInfo( ( "Received successful response from server "
+                       "(Status Code: %u).",
+                       response.statusCode ) );
+
+            returnStatus = readS3ObjectFileSize( &response, pFileSize );
+        }
+
+        return returnStatus;
+    }
+
+#endif /* if ( RANGE_SIZE_DISCOVERY_ENABLED == 0 ) */
+
+/*-----------------------------------------------------------*/
+
+static bool readS3ObjectFileSize( HTTPResponse_t * pResponse,
+                                  size_t * pFileSize )
 {
     bool returnStatus = true;
     HTTPStatus_t httpStatus = HTTPSuccess;
-    HTTPRequestHeaders_t requestHeaders;
-    HTTPRequestInfo_t requestInfo;
-    HTTPResponse_t response;
-    uint8_t userBuffer[ USER_BUFFER_LENGTH ];
 
     /* The location of the file size in contentRangeValStr. */
     char * pFileSizeStr = NULL;
@@ -441,155 +828,305 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
     char * contentRangeValStr = NULL;
     size_t contentRangeValStrLength = 0;
 
-    assert( pHost != NULL );
-    assert( pPath != NULL );
-
-    /* Initialize all HTTP Client library API structs to 0. */
-    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
-    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
-    ( void ) memset( &response, 0, sizeof( response ) );
+    assert( pResponse != NULL );
+    assert( pFileSize != NULL );
 
-    /* Initialize the request object. */
-    requestInfo.pHost = pHost;
-    requestInfo.hostLen = hostLen;
-    requestInfo.pMethod = HTTP_METHOD_GET;
-    requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
-    requestInfo.pPath = pPath;
-    requestInfo.pathLen = strlen( pPath );
-
-    /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
-     * can be sent over the same established TCP connection. This is done in
-     * order to download the file in parts. */
-    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
-
-    /* Set the buffer used for storing request headers. */
-    requestHeaders.pBuffer = userBuffer;
-    requestHeaders.bufferLen = USER_BUFFER_LENGTH;
-
-    /* Initialize the response object. The same buffer used for storing request
-     * headers is reused here. */
-    response.pBuffer = userBuffer;
-    response.bufferLen = USER_BUFFER_LENGTH;
-
-    LogInfo( ( "Getting file object size from host..." ) );
-
-    httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
-                                                      &requestInfo );
+    httpStatus = HTTPClient_ReadHeader( pResponse,
+                                        ( char * ) HTTP_CONTENT_RANGE_HEADER_FIELD,
+                                        ( size_t ) HTTP_CONTENT_RANGE_HEADER_FIELD_LENGTH,
+                                        ( const char ** ) &contentRangeValStr,
+                                        &contentRangeValStrLength );
 
     if( httpStatus != HTTPSuccess )
     {
-        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+        LogError( ( "Failed to read Content-Range header from HTTP response: Error=%s.",
                     HTTPClient_strerror( httpStatus ) ) );
         returnStatus = false;
     }
 
+    /* Parse the Content-Range header value to get the file size. */
     if( returnStatus == true )
     {
-        /* Add the header to get bytes=0-0. S3 will respond with a Content-Range
-         * header that contains the size of the file in it. This header will
-         * look like: "Content-Range: bytes 0-0/FILESIZE". The body will have a
-         * single byte that we are ignoring. */
-        httpStatus = HTTPClient_AddRangeHeader( &requestHeaders, 0, 0 );
+        pFileSizeStr = strstr( contentRangeValStr, "/" );
 
-        if( httpStatus != HTTPSuccess )
+        if( pFileSizeStr == NULL )
         {
-            LogError( ( "Failed to add Range header to request headers: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
+            LogError( ( "'/' not present in Content-Range header value: %s.",
+                        contentRangeValStr ) );
             returnStatus = false;
         }
     }
 
     if( returnStatus == true )
     {
-        /* Send the request and receive the response. */
-        httpStatus = HTTPClient_Send( pTransportInterface,
-                                      &requestHeaders,
-                                      NULL,
-                                      0,
-                                      &response,
-                                      0 );
+        pFileSizeStr += sizeof( char );
+        *pFileSize = ( size_t ) strtoul( pFileSizeStr, NULL, 10 );
 
-        if( httpStatus != HTTPSuccess )
+        if( ( *pFileSize == 0 ) || ( *pFileSize == UINT32_MAX ) )
         {
-            LogError( ( "Failed to send HTTP GET request to %s%s: Error=%s.",
-                        pHost, pPath, HTTPClient_strerror( httpStatus ) ) );
+            LogError( ( "Error using strtoul to get the file size from %s: fileSize=%d.",
+                        pFileSizeStr, ( int32_t ) *pFileSize ) );
             returnStatus = false;
         }
     }
 
     if( returnStatus == true )
     {
-        LogDebug( ( "Received HTTP response from %s%s...",
-                    pHost, pPath ) );
-        LogDebug( ( "Response Headers:\n%.*s",
-                    ( int32_t ) response.headersLen,
-                    response.pHeaders ) );
-        LogDebug( ( "Response Body:\n%.*s\n",
-                    ( int32_t ) response.bodyLen,
-                    response.pBody ) );
-
-        if( response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
+        LogInfo( ( "The file is %d bytes long.", ( int32_t ) *pFileSize ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( STREAMING_DOWNLOAD_ENABLED == 1 ) || ( PIPELINED_DOWNLOAD_ENABLED == 1 )
+
+    static bool receiveS3ObjectData( void * pContext,
+                                     uint64_t offset,
+                                     const uint8_t * pData,
+                                     size_t dataLength )
+    {
+        uint64_t * pBytesReceived = ( uint64_t * ) pContext;
+
+        /* Unused when debug logs are disabled. */
+        ( void ) offset;
+        ( void ) pData;
+
+        LogDebug( ( "Response Body (bytes %llu-%llu):\n%.*s\n",
+                    ( unsigned long long ) offset,
+                    ( unsigned long long ) ( offset + dataLength - 1U ),
+                    ( int32_t ) dataLength,
+                    pData ) );
+
+        *pBytesReceived += dataLength;
+
+        return true;
+    }
+#endif /* if ( STREAMING_DOWNLOAD_ENABLED == 1 ) || ( PIPELINED_DOWNLOAD_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( STREAMING_DOWNLOAD_ENABLED == 1 )
+
+    static bool streamS3ObjectFile( const char * pPath )
+    {
+        bool returnStatus = false;
+        HTTPStatus_t httpStatus = HTTPNetworkError;
+        ConnectionPoolStatus_t poolStatus = CONNECTION_POOL_SUCCESS;
+        TransportInterface_t transportInterface;
+        HttpBodyStreamResponse_t streamResponse;
+        uint64_t bytesReceived = 0U;
+        HttpBodyStreamCallback_t bodyCallback = receiveS3ObjectData;
+        void * pBodyContext = &bytesReceived;
+        bool bodyComplete = true;
+
+        assert( pPath != NULL );
+
+        /* Initialize the request object. */
+        ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+        requestInfo.pHost = serverHost;
+        requestInfo.hostLen = presignedUrl.host.length;
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
+        requestInfo.pPath = pPath;
+        requestInfo.pathLen = strlen( pPath );
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        /* The connection pool only reads the flags of the response. */
+        ( void ) memset( &response, 0, sizeof( response ) );
+
+        #if ( GZIP_DOWNLOAD_ENABLED == 1 )
+            /* The body is decompressed before it is passed to
+             * receiveS3ObjectData. If zlib fails to initialize, the
+             * decompression stage stops the body. */
+            ( void ) HttpBodyInflate_Init( &inflateContext, receiveS3ObjectData, &bytesReceived );
+            bodyCallback = HttpBodyInflate_Callback;
+            pBodyContext = &inflateContext;
+        #endif
+
+        poolStatus = ConnectionPool_Checkout( &serverInfo,
+                                              &opensslCredentials,
+                                              TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                              &transportInterface );
+
+        if( poolStatus == CONNECTION_POOL_SUCCESS )
+        {
+            LogInfo( ( "Downloading the file from %s in a single request...",
+                       serverHost ) );
+
+            /* The whole object is requested without a Range header, and the
+             * user buffer is reused for each part of the body received. */
+            httpStatus = HttpBodyStream_Get( &transportInterface,
+                                             &requestInfo,
+                                             0U,
+                                             HTTP_BODY_STREAM_END_OF_OBJECT,
+                                             userBuffer,
+                                             USER_BUFFER_LENGTH,
+                                             bodyCallback,
+                                             pBodyContext,
+                                             &streamResponse );
+
+            if( streamResponse.connectionClose == true )
+            {
+                response.respFlags = HTTP_RESPONSE_CONNECTION_CLOSE_FLAG;
+            }
+
+            ConnectionPool_Checkin( &transportInterface, httpStatus, &response );
+        }
+        else
+        {
+            LogError( ( "Failed to connect to HTTP server %s.",
+                        serverHost ) );
+        }
+
+        #if ( GZIP_DOWNLOAD_ENABLED == 1 )
+            bodyComplete = HttpBodyInflate_End( &inflateContext );
+        #endif
+
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to download the file from %s%s: Error=%s.",
+                        serverHost, pPath, HTTPClient_strerror( httpStatus ) ) );
+        }
+        else if( streamResponse.statusCode != HTTP_STATUS_CODE_OK )
         {
             LogError( ( "Received an invalid response from the server "
                         "(Status Code: %u).",
-                        response.statusCode ) );
-            returnStatus = false;
+                        streamResponse.statusCode ) );
         }
+        else
+        {
+            LogInfo( ( "The file is %llu bytes long, and %llu bytes were received.",
+                       ( unsigned long long ) streamResponse.contentLength,
+                       ( unsigned long long ) streamResponse.bodyLength ) );
+
+            #if ( GZIP_DOWNLOAD_ENABLED == 1 )
+                LogInfo( ( "The file was decompressed to %llu bytes.",
+                           ( unsigned long long ) bytesReceived ) );
+            #endif
+
+            returnStatus = ( streamResponse.bodyLength == streamResponse.contentLength ) &&
+                           ( bodyComplete == true );
+        }
+
+        return returnStatus;
     }
+#endif /* if ( STREAMING_DOWNLOAD_ENABLED == 1 ) */
 
-    if( returnStatus == true )
+/*-----------------------------------------------------------*/
+
+#if ( PIPELINED_DOWNLOAD_ENABLED == 1 )
+
+    static bool pipelineS3ObjectFile( const char * pPath )
     {
-        LogInfo( ( "Received successful response from server "
-                   "(Status Code: %u).",
-                   response.statusCode ) );
+        bool returnStatus = false;
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        ConnectionPoolStatus_t poolStatus = CONNECTION_POOL_SUCCESS;
+        TransportInterface_t transportInterface;
+        HttpBodyStreamResponse_t streamResponse;
+        uint64_t bytesReceived = 0U;
+        uint64_t fileSize = HTTP_BODY_STREAM_END_OF_OBJECT;
+        bool progress = true;
+
+        assert( pPath != NULL );
+
+        /* Initialize the request object. */
+        ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+        requestInfo.pHost = serverHost;
+        requestInfo.hostLen = presignedUrl.host.length;
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
+        requestInfo.pPath = pPath;
+        requestInfo.pathLen = strlen( pPath );
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        /* The connection pool only reads the flags of the response. */
+        ( void ) memset( &response, 0, sizeof( response ) );
+
+        /* Every range request is sent from the template, where only the
+         * positions of the Range header change. */
+        httpStatus = HttpRequestTemplate_Init( &requestTemplate,
+                                               requestTemplateBuffer,
+                                               REQUEST_TEMPLATE_BUFFER_LENGTH,
+                                               &requestInfo );
 
-        httpStatus = HTTPClient_ReadHeader( &response,
-                                            ( char * ) HTTP_CONTENT_RANGE_HEADER_FIELD,
-                                            ( size_t ) HTTP_CONTENT_RANGE_HEADER_FIELD_LENGTH,
-                                            ( const char ** ) &contentRangeValStr,
-                                            &contentRangeValStrLength );
+        if( httpStatus == HTTPSuccess )
+        {
+            httpStatus = HttpRequestTemplate_ReserveRange( &requestTemplate );
+        }
 
         if( httpStatus != HTTPSuccess )
         {
-            LogError( ( "Failed to read Content-Range header from HTTP response: Error=%s.",
+            LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
                         HTTPClient_strerror( httpStatus ) ) );
-            returnStatus = false;
         }
-    }
-
-    /* Parse the Content-Range header value to get the file size. */
-    if( returnStatus == true )
-    {
-        pFileSizeStr = strstr( contentRangeValStr, "/" );
 
-        if( pFileSizeStr == NULL )
+        /* Each connection downloads the rest of the file, until the server
+         * closes it after one of the ranges. */
+        while( ( httpStatus == HTTPSuccess ) && ( progress == true ) &&
+               ( bytesReceived < fileSize ) )
         {
-            LogError( ( "'/' not present in Content-Range header value: %s.",
-                        contentRangeValStr ) );
-            returnStatus = false;
-        }
-    }
+            poolStatus = ConnectionPool_Checkout( &serverInfo,
+                                                  &opensslCredentials,
+                                                  TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                  &transportInterface );
 
-    if( returnStatus == true )
-    {
-        pFileSizeStr += sizeof( char );
-        *pFileSize = ( size_t ) strtoul( pFileSizeStr, NULL, 10 );
+            if( poolStatus == CONNECTION_POOL_SUCCESS )
+            {
+                LogInfo( ( "Downloading the file from %s at byte %llu with up to %u requests in flight...",
+                           serverHost,
+                           ( unsigned long long ) bytesReceived,
+                           ( unsigned int ) DOWNLOAD_PIPELINE_DEPTH ) );
+
+                httpStatus = HttpBodyStream_GetRanges( &transportInterface,
+                                                       &requestTemplate,
+                                                       bytesReceived,
+                                                       RANGE_REQUEST_LENGTH,
+                                                       DOWNLOAD_PIPELINE_DEPTH,
+                                                       userBuffer,
+                                                       USER_BUFFER_LENGTH,
+                                                       receiveS3ObjectData,
+                                                       &bytesReceived,
+                                                       &streamResponse );
+
+                response.respFlags = ( streamResponse.connectionClose == true ) ?
+                                     HTTP_RESPONSE_CONNECTION_CLOSE_FLAG : 0U;
+
+                ConnectionPool_Checkin( &transportInterface, httpStatus, &response );
+
+                fileSize = streamResponse.objectLength;
+                progress = ( streamResponse.bodyLength > 0U );
+            }
+            else
+            {
+                LogError( ( "Failed to connect to HTTP server %s.",
+                            serverHost ) );
+                httpStatus = HTTPNetworkError;
+            }
+        }
 
-        if( ( *pFileSize == 0 ) || ( *pFileSize == UINT32_MAX ) )
+        if( httpStatus != HTTPSuccess )
         {
-            LogError( ( "Error using strtoul to get the file size from %s: fileSize=%d.",
-                        pFileSizeStr, ( int32_t ) *pFileSize ) );
-            returnStatus = false;
+            LogError( ( "Failed to download the file from %s%s: Error=%s.",
+                        serverHost, pPath, HTTPClient_strerror( httpStatus ) ) );
         }
-    }
+        else if( progress == false )
+        {
+            LogError( ( "The server closed the connection before sending a range." ) );
+        }
+        else
+        {
+            LogInfo( ( "The file is %llu bytes long, and %llu bytes were received.",
+                       ( unsigned long long ) fileSize,
+                       ( unsigned long long ) bytesReceived ) );
 
-    if( returnStatus == true )
-    {
-        LogInfo( ( "The file is %d bytes long.", ( int32_t ) *pFileSize ) );
-    }
+            returnStatus = ( bytesReceived == fileSize );
+        }
 
-    return returnStatus;
-}
+        return returnStatus;
+    }
+#endif /* if ( PIPELINED_DOWNLOAD_ENABLED == 1 ) */
 
 /*-----------------------------------------------------------*/
 
@@ -602,7 +1139,9 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
  * handshake with the HTTP server so that all communication is encrypted. After
  * which, the HTTP Client library API is used to download the S3 file (by
  * sending multiple GET requests, filling up the response buffer each time until
- * all parts are downloaded). If any request fails, an error code is returned.
+ * all parts are downloaded). The requests are sent over a keep-alive connection
+ * from the connection pool, which is only re-established when the server closes
+ * it. If any request fails, an error code is returned.
  *
  * @note This example is single-threaded and uses statically allocated memory.
  *
@@ -611,12 +1150,18 @@ static bool getS3ObjectFileSize( size_t * pFileSize,
  * (located in located in demos/http/common/src) to generate these URLs. For
  * detailed instructions, see the accompanied README.md.
  *
- * @note If your file requires more than 99 range requests to S3 (depending on
- * the size of the file and the length specified in RANGE_REQUEST_LENGTH), your
- * connection may be dropped by S3. In this case, either increase the buffer
- * size and range request length (if feasible), to reduce the number of requests
- * required, or re-establish the connection with S3 after receiving a
- * "Connection: close" response header.
+ * @note S3 sends a "Connection: close" response header after about 100
+ * requests over a connection. The connection pool then closes the connection,
+ * and the next range request establishes a new one.
+ *
+ * @note When STREAMING_DOWNLOAD_ENABLED is 1, the file is instead downloaded
+ * with a single GET request, whose body is passed to a callback as it is
+ * received into the user buffer. When GZIP_DOWNLOAD_ENABLED is also 1, the
+ * body is decompressed on its way to the callback.
+ *
+ * @note When PIPELINED_DOWNLOAD_ENABLED is 1, the ranges are requested with
+ * up to DOWNLOAD_PIPELINE_DEPTH requests in flight over the connection, and
+ * their bodies are passed to the same callback.
  */
 int main( int argc,
           char ** argv )
@@ -625,90 +1170,52 @@ int main( int argc,
     int32_t returnStatus = EXIT_SUCCESS;
     /* Return value of private functions. */
     bool ret = false;
-    /* HTTPS Client library return status. */
-    HTTPStatus_t httpStatus = HTTPSuccess;
     int demoRunCount = 0;
 
-    /* The length of the path within the pre-signed URL. This variable is
-     * defined in order to store the length returned from parsing the URL, but
-     * it is unused. The path used for the requests in this demo needs all the
-     * query information following the location of the object, to the end of the
-     * S3 presigned URL. */
-    size_t pathLen = 0;
-
-    /* The transport layer interface used by the HTTP Client library. */
-    TransportInterface_t transportInterface;
-    /* The network context for the transport layer interface. */
-    NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
-
     ( void ) argc;
     ( void ) argv;
 
-    /* Set the pParams member of the network context with desired transport. */
-    networkContext.pParams = &opensslParams;
-
     LogInfo( ( "HTTP Client Synchronous S3 download demo using pre-signed URL:\n%s",
                S3_PRESIGNED_GET_URL ) );
 
+    #if ( ADAPTIVE_RANGE_LENGTH_ENABLED == 1 )
+        /* Ranges taking over half the transport timeout are shortened before
+         * a slow link times out. */
+        HttpRangeTuner_Init( &rangeTuner,
+                             RANGE_REQUEST_LENGTH,
+                             RANGE_REQUEST_STEP_LENGTH,
+                             RANGE_REQUEST_MAX_LENGTH,
+                             TRANSPORT_SEND_RECV_TIMEOUT_MS / 2U );
+    #endif
+
     do
     {
-        /**************************** Connect. ******************************/
+        /********************** Initialize server info. ********************/
 
-        /* Establish TLS connection on top of TCP connection using OpenSSL. */
-
-        /* Attempt to connect to the HTTP server. If connection fails, retry
-         * after a timeout. The timeout value will be exponentially
-         * increased until either the maximum number of attempts or the
-         * maximum timeout value is reached. The function returns
-         * EXIT_FAILURE if the TCP connection cannot be established to the
-         * broker after the configured number of attempts. */
-        returnStatus = connectToServerWithBackoffRetries( connectToServer,
-                                                          &networkContext );
-
-        if( returnStatus == EXIT_FAILURE )
-        {
-            /* Log an error to indicate connection failure after all
-             * reconnect attempts are over. */
-            LogError( ( "Failed to connect to HTTP server %s.",
-                        serverHost ) );
-        }
-
-        /* Define the transport interface. */
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            ( void ) memset( &transportInterface, 0, sizeof( transportInterface ) );
-            transportInterface.recv = Openssl_Recv;
-            transportInterface.send = Openssl_Send;
-            transportInterface.pNetworkContext = &networkContext;
-        }
+        /* The TLS connections are established on top of TCP connections using
+         * OpenSSL by the connection pool, with retries and backoff, when
+         * the first request is sent and whenever the server closes the
+         * connection. */
+        returnStatus = initializeServerInfo();
 
         /******************** Download S3 Object File. **********************/
 
         if( returnStatus == EXIT_SUCCESS )
         {
-            /* Retrieve the path location from S3_PRESIGNED_GET_URL. This
-             * function returns the length of the path without the query into
-             * pathLen, which is left unused in this demo. */
-            httpStatus = getUrlPath( S3_PRESIGNED_GET_URL,
-                                     S3_PRESIGNED_GET_URL_LENGTH,
-                                     &pPath,
-                                     &pathLen );
-
-            returnStatus = ( httpStatus == HTTPSuccess ) ? EXIT_SUCCESS : EXIT_FAILURE;
-        }
-
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            ret = downloadS3ObjectFile( &transportInterface,
-                                        pPath );
+            #if ( STREAMING_DOWNLOAD_ENABLED == 1 )
+                ret = streamS3ObjectFile( pPath );
+            #elif ( PIPELINED_DOWNLOAD_ENABLED == 1 )
+                ret = pipelineS3ObjectFile( pPath );
+            #else
+                ret = downloadS3ObjectFile( pPath );
+            #endif
             returnStatus = ( ret == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
         }
 
         /************************** Disconnect. *****************************/
 
-        /* End the TLS session, then close the TCP connection. */
-        ( void ) Openssl_Disconnect( &networkContext );
+        /* End the TLS sessions, then close the TCP connections. */
+        ConnectionPool_CloseAll();
 
         /******************* Retry in case of failure. **********************/
 
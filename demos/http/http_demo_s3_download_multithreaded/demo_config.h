@@ -87,22 +87,74 @@
 #define TRANSPORT_SEND_RECV_TIMEOUT_MS    ( 5000 )
 
 /**
- * @brief The length in bytes of the user buffer.
+ * @brief The size of the range of the file to download with each request.
+ *
+ * @note Larger ranges amortize the request and response headers over more
+ * of the file. Each worker holds one range in its user buffer.
  */
-#define USER_BUFFER_LENGTH                ( 4096 )
+#define RANGE_REQUEST_LENGTH              ( 1024 * 1024 )
 
 /**
- * @brief The size of the range of the file to download with each request.
+ * @brief The length in bytes of the user buffer of each worker.
  *
  * @note This should account for the response headers that will also be stored
  * in the user buffer. We don't expect S3 to send more than 1024 bytes of
  * headers.
  */
-#define RANGE_REQUEST_LENGTH              ( 2048 )
+#define USER_BUFFER_LENGTH                ( RANGE_REQUEST_LENGTH + 4096 )
+
+/**
+ * @brief The length in bytes of the buffer of each worker holding its range
+ * request, serialized once for all the ranges it downloads.
+ *
+ * @note This should account for the path of the pre-signed URL, which is
+ * part of the request line.
+ */
+#define REQUEST_TEMPLATE_BUFFER_LENGTH    ( 2048 )
+
+/**
+ * @brief Set to 1 to read the size of the file from the Content-Range header
+ * of the first range, instead of from a bytes=0-0 request sent before it.
+ *
+ * @note The first range is then written from the response that gave the size,
+ * and the workers download the remaining ranges.
+ */
+#define RANGE_SIZE_DISCOVERY_ENABLED      ( 1 )
+
+/**
+ * @brief The number of workers downloading ranges of the file in parallel,
+ * each over its own TLS connection.
+ */
+#define DOWNLOAD_WORKER_COUNT             ( 4 )
+
+/**
+ * @brief Path of the file the S3 object is downloaded to.
+ */
+#define DOWNLOAD_FILE_PATH                "s3_object.bin"
 
 /**
- * @brief The number of items that can be held in each queue.
+ * @brief Path of the checkpoint file recording the ranges of
+ * DOWNLOAD_FILE_PATH already downloaded, to resume an interrupted download.
+ *
+ * @note The file is removed once the download is complete.
+ */
+#define DOWNLOAD_CHECKPOINT_PATH          DOWNLOAD_FILE_PATH ".checkpoint"
+
+/**
+ * @brief The number of ranges downloaded between two syncs of the
+ * checkpoint file to disk.
+ *
+ * @note Each sync flushes the downloaded file, then the checkpoint file, with
+ * fdatasync. At most this many ranges are downloaded again after a crash.
+ */
+#define DOWNLOAD_CHECKPOINT_SYNC_INTERVAL    ( 16 )
+
+/**
+ * @brief The maximum number of ranges of a download recorded by the
+ * checkpoint file, which sets the size of its bitmap.
+ *
+ * @note 65536 ranges of 1 MiB allow files up to 64 GiB with an 8 KiB bitmap.
  */
-#define QUEUE_SIZE                        10
+#define DOWNLOAD_CHECKPOINT_MAX_RANGE_COUNT    ( 65536 )
 
 #endif /* ifndef DEMO_CONFIG_H_ */
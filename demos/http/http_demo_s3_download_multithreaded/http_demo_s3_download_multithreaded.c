@@ -22,6 +22,7 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
@@ -29,10 +30,9 @@
 /* POSIX includes. */
 #include <unistd.h>
 #include <fcntl.h>
-#include <mqueue.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/types.h>
-#include <signal.h>
 
 /* Include Demo Config as the first non-system header. */
 #include "demo_config.h"
@@ -49,6 +49,18 @@
 /*Include backoff algorithm header for retry logic.*/
 #include "backoff_algorithm.h"
 
+/* Include clock header for the download time. */
+#include "clock.h"
+
+/* Checkpoint of the ranges downloaded, to resume the download. */
+#include "http_download_checkpoint.h"
+
+/* Requests serialized once, with the Range header patched in place. */
+#include "http_request_template.h"
+
+/* Trace probes of the range requests. */
+#include "trace_probes.h"
+
 /* Check that TLS port of the server is defined. */
 #ifndef HTTPS_PORT
     #error "Please define a HTTPS_PORT."
@@ -79,26 +91,40 @@
     #error "Please define a RANGE_REQUEST_LENGTH."
 #endif
 
-/* Check the the queue size is defined. */
-#ifndef QUEUE_SIZE
-    #error "Please define a QUEUE_SIZE."
+/* Check that size of the request template buffer is defined. */
+#ifndef REQUEST_TEMPLATE_BUFFER_LENGTH
+    #define REQUEST_TEMPLATE_BUFFER_LENGTH    ( 2048 )
 #endif
 
-/**
- * @brief The name of the HTTP thread's input queue. Must begin with a slash and
- * be a valid pathname.
- */
-#define REQUEST_QUEUE                             "/demo_request_queue"
+/* Check that the number of workers is defined. */
+#ifndef DOWNLOAD_WORKER_COUNT
+    #error "Please define a DOWNLOAD_WORKER_COUNT."
+#endif
 
-/**
- * @brief The name of the HTTP thread's output queue. Must begin with a slash
- * and be a valid pathname.
- */
-#define RESPONSE_QUEUE                            "/demo_response_queue"
+/* Check that the path of the downloaded file is defined. */
+#ifndef DOWNLOAD_FILE_PATH
+    #error "Please define a DOWNLOAD_FILE_PATH."
+#endif
 
-/* Posix file permissions for the queues. Allows read and write access to the
- * user this demo is running as. */
-#define QUEUE_PERMISSIONS                         0600
+/* Check that the path of the checkpoint file is defined. */
+#ifndef DOWNLOAD_CHECKPOINT_PATH
+    #error "Please define a DOWNLOAD_CHECKPOINT_PATH."
+#endif
+
+/* Check that the interval between syncs of the checkpoint file is defined. */
+#ifndef DOWNLOAD_CHECKPOINT_SYNC_INTERVAL
+    #error "Please define a DOWNLOAD_CHECKPOINT_SYNC_INTERVAL."
+#endif
+
+/* Check that the maximum number of ranges of the checkpoint is defined. */
+#ifndef DOWNLOAD_CHECKPOINT_MAX_RANGE_COUNT
+    #error "Please define a DOWNLOAD_CHECKPOINT_MAX_RANGE_COUNT."
+#endif
+
+/* Check whether the size of the file is read from the first range. */
+#ifndef RANGE_SIZE_DISCOVERY_ENABLED
+    #define RANGE_SIZE_DISCOVERY_ENABLED    ( 1 )
+#endif
 
 /**
  * @brief Length of the S3 presigned URL.
@@ -120,11 +146,54 @@
  */
 #define HTTP_CONTENT_RANGE_HEADER_FIELD_LENGTH    ( sizeof( HTTP_CONTENT_RANGE_HEADER_FIELD ) - 1 )
 
+/**
+ * @brief Field name of the HTTP ETag header to read from server response.
+ */
+#define HTTP_ETAG_HEADER_FIELD                    "ETag"
+
+/**
+ * @brief Length of the HTTP ETag header field.
+ */
+#define HTTP_ETAG_HEADER_FIELD_LENGTH             ( sizeof( HTTP_ETAG_HEADER_FIELD ) - 1 )
+
+/**
+ * @brief Field name of the HTTP If-Match header to send in requests.
+ */
+#define HTTP_IF_MATCH_HEADER_FIELD                "If-Match"
+
+/**
+ * @brief Length of the HTTP If-Match header field.
+ */
+#define HTTP_IF_MATCH_HEADER_FIELD_LENGTH         ( sizeof( HTTP_IF_MATCH_HEADER_FIELD ) - 1 )
+
 /**
  * @brief HTTP status code returned for partial content.
  */
 #define HTTP_STATUS_CODE_PARTIAL_CONTENT          206
 
+/**
+ * @brief HTTP status code returned when the ETag of the object no longer
+ * matches the If-Match header.
+ */
+#define HTTP_STATUS_CODE_PRECONDITION_FAILED      412
+
+/**
+ * @brief The number of times a worker sends the request for a range, over a
+ * new connection each time, before the download fails.
+ */
+#define DOWNLOAD_MAX_RANGE_ATTEMPTS               ( 3 )
+
+/**
+ * @brief Position of the last byte requested to get the size of the file:
+ * the whole first range, or a single byte when the size is probed with a
+ * request of its own.
+ */
+#if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 )
+    #define SIZE_REQUEST_LAST_BYTE    ( ( uint64_t ) RANGE_REQUEST_LENGTH - 1U )
+#else
+    #define SIZE_REQUEST_LAST_BYTE    ( 0U )
+#endif
+
 /**
  * @brief The maximum number of times to run the loop in this demo.
  *
@@ -142,88 +211,95 @@
 #define DELAY_BETWEEN_DEMO_RETRY_ITERATIONS_S    ( 5 )
 
 /**
- * @brief The location of the host address within string S3_PRESIGNED_GET_URL.
+ * @brief The components of S3_PRESIGNED_GET_URL, parsed once at startup.
  */
-static const char * pHost = NULL;
+static ParsedUrl_t presignedUrl;
 
 /**
- * @brief The length of the host address within string S3_PRESIGNED_GET_URL.
- * */
-static size_t hostLen = 0;
+ * @brief The host address string extracted from S3_PRESIGNED_GET_URL, shared
+ * by the connections of all workers.
+ */
+static char serverHost[ URL_MAX_HOST_LENGTH + 1U ];
 
 /**
- * @brief Data type for request queue.
- *
- * In addition to sending #HTTPRequestHeaders_t, we need to send the buffer it uses.
- * The pointer to the buffer in #HTTPRequestHeaders_t will be incorrect after
- * it is received, so it will need to be fixed.
+ * @brief Configurations of the initial request headers of all range
+ * requests, set once the pre-signed URL is parsed.
  */
-typedef struct RequestItem
+static HTTPRequestInfo_t requestInfo = { 0 };
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
 {
-    HTTPRequestHeaders_t requestHeaders;
-    uint8_t headersBuffer[ USER_BUFFER_LENGTH ];
-} RequestItem_t;
+    OpensslParams_t * pParams;
+};
 
 /**
- * @brief Data type for response queue.
- *
- * In addition to sending the #HTTPResponse_t, we need to send the buffer it uses.
- * The pointer to the buffer in #HTTPResponse_t will be incorrect after
- * it is received, so it will need to be fixed.
+ * @brief A worker downloading ranges of the file over its own connection.
  */
-typedef struct ResponseItem
+typedef struct DownloadWorker
 {
-    HTTPResponse_t response;
-    uint8_t responseBuffer[ USER_BUFFER_LENGTH ];
-} ResponseItem_t;
+    pthread_t thread;                        /**< @brief The thread of the worker. */
+    bool threadStarted;                      /**< @brief Whether #DownloadWorker_t.thread was created. */
+    NetworkContext_t networkContext;         /**< @brief The network context of the connection. */
+    OpensslParams_t opensslParams;           /**< @brief The TLS session of the connection. */
+    TransportInterface_t transportInterface; /**< @brief The transport interface over the connection. */
+    bool connected;                          /**< @brief Whether the connection is established. */
+    uint8_t * pBuffer;                       /**< @brief Buffer of #USER_BUFFER_LENGTH bytes for the responses. */
+    uint8_t * pTemplateBuffer;               /**< @brief Buffer of #REQUEST_TEMPLATE_BUFFER_LENGTH bytes for the requests. */
+    HttpRequestTemplate_t requestTemplate;   /**< @brief The range request, serialized in #DownloadWorker_t.pTemplateBuffer. */
+    uint64_t bytesDownloaded;                /**< @brief Bytes of the file written by the worker. */
+    uint32_t rangeCount;                     /**< @brief Ranges of the file written by the worker. */
+    uint32_t connectionCount;                /**< @brief Connections established by the worker. */
+} DownloadWorker_t;
 
-/* @brief Struct used for sending requests to the HTTP thread.
+/**
+ * @brief The download shared by all workers.
  *
- * This is used by both the main and HTTP threads, though since we create the
- * HTTP thread without a shared memory space, each will have its own copy. We
- * have this as a global so that it will be located at the same address in the
- * main and HTTP threads so that way pointers remain valid when copied over.
+ * The ranges of the file form a lock-free work queue: each worker claims the
+ * next range by atomically incrementing #DownloadJob_t.nextRange, so that
+ * faster connections download more ranges.
  */
-static RequestItem_t requestItem = { 0 };
+typedef struct DownloadJob
+{
+    int fileDescriptor;                               /**< @brief The preallocated file the ranges are written to. */
+    uint64_t fileSize;                                /**< @brief The size of the S3 object. */
+    uint64_t rangeCount;                              /**< @brief The number of ranges of #RANGE_REQUEST_LENGTH bytes in the object. */
+    uint64_t nextRange;                               /**< @brief Index of the next range to download. Updated atomically. */
+    bool failed;                                      /**< @brief Set atomically when a worker fails, to stop the others. */
+    bool objectChanged;                               /**< @brief Set atomically when the ETag of the object changed during the download. */
+    char etag[ DOWNLOAD_CHECKPOINT_MAX_ETAG_LENGTH ]; /**< @brief The ETag of the object, sent in the If-Match header of each range request. */
+    size_t etagLength;                                /**< @brief The length of #DownloadJob_t.etag. */
+    DownloadCheckpoint_t checkpoint;                  /**< @brief The ranges written to the file. */
+} DownloadJob_t;
 
-/* @brief Struct used for receiving responses from the HTTP thread.
- *
- * This is used by both the main and HTTP threads, though since we create the
- * HTTP thread without a shared memory space, each will have its own copy. We
- * have this as a global so that it will be located at the same address in the
- * main and HTTP threads so that way pointers remain valid when copied over.
+/**
+ * @brief The download of the current demo iteration.
  */
-static ResponseItem_t responseItem = { 0 };
+static DownloadJob_t downloadJob;
 
 /**
- * @brief The return status for requestS3ObjectRange() and retrieveHTTPResponse().
+ * @brief The workers downloading the file.
  */
-typedef enum QueueOpStatus
-{
-    /**
-     * @brief The function completed successfully.
-     */
-    QUEUE_OP_SUCCESS,
-
-    /**
-     * @brief The function was given a non-blocking queue and would have blocked
-     * were it a blocking queue.
-     */
-    QUEUE_OP_WOULD_BLOCK,
-
-    /**
-     * @brief The function encountered an error.
-     */
-    QUEUE_OP_FAILURE,
-} QueueOpStatus_t;
+static DownloadWorker_t workers[ DOWNLOAD_WORKER_COUNT ];
 
-/*-----------------------------------------------------------*/
+/**
+ * @brief The user buffers of the workers, used for storing HTTP response
+ * headers and body.
+ */
+static uint8_t workerBuffers[ DOWNLOAD_WORKER_COUNT ][ USER_BUFFER_LENGTH ];
 
-/* Each compilation unit must define the NetworkContext struct. */
-struct NetworkContext
-{
-    OpensslParams_t * pParams;
-};
+/**
+ * @brief The buffers of the request templates of the workers, kept apart
+ * from #workerBuffers, where the responses would overwrite them.
+ */
+static uint8_t templateBuffers[ DOWNLOAD_WORKER_COUNT ][ REQUEST_TEMPLATE_BUFFER_LENGTH ];
+
+/**
+ * @brief The bitmap of the ranges recorded by the checkpoint.
+ */
+static uint8_t checkpointBitmap[ DOWNLOAD_CHECKPOINT_BITMAP_LENGTH( DOWNLOAD_CHECKPOINT_MAX_RANGE_COUNT ) ];
 
 /*-----------------------------------------------------------*/
 
@@ -237,91 +313,130 @@ struct NetworkContext
 static int connectToServer( NetworkContext_t * pNetworkContext );
 
 /**
- * @brief Send an HTTP request based on a specified method and path, and
- * print the response received from the server.
+ * @brief Establish the connection of a worker, closing its previous
+ * connection if any.
  *
- * @param[in] pHost The host name of the server.
- * @param[in] hostLen The length of pHost.
- * @param[in] pRequest The HTTP Request-URI.
- * @param[in] requestUriLen The length of pRequest.
- * @param[in] fileSize The length of the file at S3_PRESIGNED_GET_URL.
- * @param[in] requestQueue The queue to which HTTP requests should be written.
- * @param[in] responseQueue The queue from which HTTP responses should be read.
+ * @param[in] pWorker The worker.
  *
  * @return false on failure; true on success.
  */
-static bool downloadS3ObjectFile( const char * pHost,
-                                  const size_t hostLen,
-                                  const char * pRequest,
-                                  const size_t requestUriLen,
-                                  mqd_t requestQueue,
-                                  mqd_t responseQueue );
+static bool connectWorker( DownloadWorker_t * pWorker );
 
 /**
- * @brief Enqueue an HTTP request for a range of the S3 file.
+ * @brief Close the connection of a worker, if established.
  *
- * @param[in] requestInfo The #HTTPRequestInfo_t for configuring the request.
- * @param[in] requestQueue The queue to which HTTP requests should be written.
+ * @param[in] pWorker The worker.
+ */
+static void disconnectWorker( DownloadWorker_t * pWorker );
+
+/**
+ * @brief Serialize the range request of a worker once, with an If-Match
+ * header once the ETag of the object is known.
+ *
+ * @param[in] pWorker The worker.
+ *
+ * @return false on failure; true on success.
+ */
+static bool initRequestTemplate( DownloadWorker_t * pWorker );
+
+/**
+ * @brief Send a request for a range of the S3 object over the connection of a
+ * worker, and receive the response in the buffer of the worker.
+ *
+ * The connection is closed when the request fails or the server responds with
+ * a "Connection: close" header, for the next request to establish a new one.
+ *
+ * @param[in] pWorker The worker.
  * @param[in] start The position of the first byte in the range.
  * @param[in] end The position of the last byte in the range, inclusive.
+ * @param[out] pResponse The response received.
+ *
+ * @return The status returned by the HTTP Client library.
+ */
+static HTTPStatus_t requestS3ObjectRange( DownloadWorker_t * pWorker,
+                                          uint64_t start,
+                                          uint64_t end,
+                                          HTTPResponse_t * pResponse );
+
+/**
+ * @brief Retrieve the size and the ETag of the S3 object that is specified in
+ * S3_PRESIGNED_GET_URL, with a request for bytes 0 to #SIZE_REQUEST_LAST_BYTE.
  *
- * @return QUEUE_OP_FAILURE on failure; QUEUE_OP_WOULD_BLOCK if would block,
- * QUEUE_OP_SUCCESS on success.
+ * The ETag is stored in #DownloadJob_t.etag.
+ *
+ * @param[in] pWorker The worker to send the request with.
+ * @param[out] pFileSize The size of the S3 object.
+ * @param[out] pResponse The response, in the buffer of the worker.
+ *
+ * @return false on failure; true on success.
  */
-static QueueOpStatus_t requestS3ObjectRange( const HTTPRequestInfo_t * requestInfo,
-                                             mqd_t requestQueue,
-                                             const size_t start,
-                                             const size_t end );
+static bool getS3ObjectFileSize( DownloadWorker_t * pWorker,
+                                 uint64_t * pFileSize,
+                                 HTTPResponse_t * pResponse );
 
+/**
+ * @brief Write a range of the S3 object to the downloaded file.
+ *
+ * @param[in] pData The data of the range.
+ * @param[in] dataLength The length of the range.
+ * @param[in] offset The position of the range in the file.
+ *
+ * @return false on failure; true on success.
+ */
+static bool writeRange( const uint8_t * pData,
+                        size_t dataLength,
+                        uint64_t offset );
 
 /**
- * @brief Processes an HTTP response from the response queue.
+ * @brief Download a range of the S3 object and write it to the file,
+ * retrying over new connections up to #DOWNLOAD_MAX_RANGE_ATTEMPTS times,
+ * then record it in the checkpoint.
  *
- * @param[in] responseQueue The queue from which HTTP responses should be read.
- * @param[out] responseItem The HTTP response received.
+ * @param[in] pWorker The worker.
+ * @param[in] rangeIndex The index of the range of #RANGE_REQUEST_LENGTH bytes.
  *
- * @return QUEUE_OP_FAILURE on failure; QUEUE_OP_WOULD_BLOCK if would block,
- * QUEUE_OP_SUCCESS on success.
+ * @return false on failure; true on success.
  */
-static QueueOpStatus_t retrieveHTTPResponse( mqd_t responseQueue,
-                                             ResponseItem_t * responseItem );
+static bool downloadRange( DownloadWorker_t * pWorker,
+                           uint64_t rangeIndex );
+
+#if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 )
 
 /**
- * @brief Retrieve the size of the S3 object that is specified in pPath using
- * HTTP thread.
+ * @brief Write the first range of the S3 object from the response that gave
+ * its size, then record it in the checkpoint.
+ *
+ * The range is not written again if the checkpoint already holds it.
  *
- * @param[in] requestInfo The #HTTPRequestInfo_t for configuring the request.
- * @param[in] requestQueue The queue to which HTTP requests should be written.
- * @param[in] responseQueue The queue from which HTTP responses should be read.
- * @param[out] pFileSize - The size of the S3 object.
+ * @param[in] pWorker The worker that received the response.
+ * @param[in] pResponse The response to the request for the first range.
  *
  * @return false on failure; true on success.
  */
-static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
-                                 mqd_t requestQueue,
-                                 mqd_t responseQueue,
-                                 size_t * pFileSize );
+    static bool storeFirstRange( DownloadWorker_t * pWorker,
+                                 const HTTPResponse_t * pResponse );
+#endif
 
 /**
- * @brief Services HTTP requests from the request queue and writes the
- * responses to the response queue.
+ * @brief The thread of a worker, downloading ranges that are not recorded in
+ * the checkpoint until all ranges are claimed or a worker fails.
  *
- * @param[in] pTransportInterface The transport interface for making network calls.
+ * @param[in] pArgument The #DownloadWorker_t of the thread.
  *
- * @return -1 on failure; PID of HTTP thread on success.
+ * @return NULL.
  */
-static pid_t startHTTPThread( const TransportInterface_t * pTransportInterface );
+static void * workerTask( void * pArgument );
 
 /**
- * @brief Clean up resources created by demo.
+ * @brief Download the S3 object to #DOWNLOAD_FILE_PATH with
+ * #DOWNLOAD_WORKER_COUNT workers, and report the throughput.
  *
- * @param[in] httpThread The HTTP thread.
- * @param[in] requestQueue The request queue.
- * @param[in] responseQueue The response queue.
+ * The ranges already recorded in #DOWNLOAD_CHECKPOINT_PATH by an interrupted
+ * download of the same version of the object are not downloaded again.
+ *
+ * @return false on failure; true on success.
  */
-static void tearDown( pid_t httpThread,
-                      mqd_t requestQueue,
-                      mqd_t responseQueue );
+static bool downloadS3ObjectFile( void );
 
 /*-----------------------------------------------------------*/
 
@@ -334,19 +449,13 @@ static int connectToServer( NetworkContext_t * pNetworkContext )
     /* Information about the server to send the HTTP requests. */
     ServerInfo_t serverInfo = { 0 };
 
-    /* The host address string extracted from S3_PRESIGNED_GET_URL. */
-    char serverHost[ sizeof( S3_PRESIGNED_GET_URL ) ] = { 0 };
-
     /* Initialize TLS credentials. */
     opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
     opensslCredentials.sniHostName = serverHost;
 
-    /* serverHost should consist only of the host address located in S3_PRESIGNED_GET_URL. */
-    memcpy( serverHost, pHost, hostLen );
-
     /* Initialize server information. */
     serverInfo.pHostName = serverHost;
-    serverInfo.hostNameLength = hostLen;
+    serverInfo.hostNameLength = presignedUrl.host.length;
     serverInfo.port = HTTPS_PORT;
 
     /* Establish a TLS session with the HTTP server. This example connects
@@ -367,122 +476,37 @@ static int connectToServer( NetworkContext_t * pNetworkContext )
 
 /*-----------------------------------------------------------*/
 
-static bool downloadS3ObjectFile( const char * pHost,
-                                  const size_t hostLen,
-                                  const char * pRequest,
-                                  const size_t requestUriLen,
-                                  mqd_t requestQueue,
-                                  mqd_t responseQueue )
+static bool connectWorker( DownloadWorker_t * pWorker )
 {
-    bool returnStatus = true;
-    QueueOpStatus_t queueOpStatus = QUEUE_OP_SUCCESS;
-
-    size_t requestCount = 0;
-
-    /* Configurations of the initial request headers. */
-    HTTPRequestInfo_t requestInfo = { 0 };
-
-    /* The length of the file at S3_PRESIGNED_GET_URL. */
-    size_t fileSize = 0;
-
-    /* The number of bytes we want to request within each range of the file. */
-    size_t numReqBytes = 0;
-    /* curByte indicates which starting byte we want to download next. */
-    size_t curByte = 0;
-
-    /* Initialize the request object. */
-    requestInfo.pHost = pHost;
-    requestInfo.hostLen = hostLen;
-    requestInfo.pMethod = HTTP_METHOD_GET;
-    requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
-    requestInfo.pPath = pRequest;
-    requestInfo.pathLen = requestUriLen;
+    bool returnStatus = false;
 
-    /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
-     * can be sent over the same established TCP connection. This is done in
-     * order to download the file in parts. */
-    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+    disconnectWorker( pWorker );
 
-    /* Get the length of the S3 file. */
-    returnStatus = getS3ObjectFileSize( &requestInfo,
-                                        requestQueue,
-                                        responseQueue,
-                                        &fileSize );
-
-    if( returnStatus == true )
+    /* Set the pParams member of the network context with desired transport. */
+    ( void ) memset( &pWorker->opensslParams, 0, sizeof( pWorker->opensslParams ) );
+    pWorker->networkContext.pParams = &pWorker->opensslParams;
+
+    /* Attempt to connect to the HTTP server. If connection fails, retry
+     * after a timeout. The timeout value will be exponentially increased
+     * till the maximum attempts are reached or maximum timeout value is
+     * reached. */
+    if( connectToServerWithBackoffRetries( connectToServer,
+                                           &pWorker->networkContext ) == EXIT_SUCCESS )
     {
-        if( fileSize < RANGE_REQUEST_LENGTH )
-        {
-            numReqBytes = fileSize;
-        }
-        else
-        {
-            numReqBytes = RANGE_REQUEST_LENGTH;
-        }
-
-        /* Here we iterate sending byte range requests and retrieving responses
-         * until the full file has been downloaded. We keep track of the next byte
-         * to download with curByte. When this reaches the fileSize we stop
-         * downloading. We keep track of the number of responses we are waiting for
-         * with requestCount.
-         */
-        while( ( returnStatus != false ) && ( curByte < fileSize || requestCount > 0 ) )
-        {
-            /* Send range request if remaining. */
-            if( curByte < fileSize )
-            {
-                queueOpStatus = requestS3ObjectRange( &requestInfo,
-                                                      requestQueue,
-                                                      curByte,
-                                                      curByte + numReqBytes - 1 );
-
-                if( queueOpStatus == QUEUE_OP_FAILURE )
-                {
-                    returnStatus = false;
-                }
-                else if( queueOpStatus == QUEUE_OP_SUCCESS )
-                {
-                    requestCount += 1;
-                    curByte += numReqBytes;
-
-                    if( ( fileSize - curByte ) < numReqBytes )
-                    {
-                        numReqBytes = fileSize - curByte;
-                    }
-                }
-            }
-
-            /* Retrieve response. */
-            if( ( requestCount > 0 ) && ( queueOpStatus != QUEUE_OP_FAILURE ) )
-            {
-                queueOpStatus = retrieveHTTPResponse( responseQueue, &responseItem );
-
-                if( queueOpStatus == QUEUE_OP_FAILURE )
-                {
-                    returnStatus = false;
-                }
-                else if( queueOpStatus == QUEUE_OP_SUCCESS )
-                {
-                    LogInfo( ( "Main thread received HTTP response" ) );
-                    LogInfo( ( "Response Headers:\n%.*s",
-                               ( int32_t ) responseItem.response.headersLen,
-                               responseItem.response.pHeaders ) );
-                    LogInfo( ( "Response Status:\n%u", responseItem.response.statusCode ) );
-                    LogInfo( ( "Response Body:\n%.*s\n", ( int32_t ) responseItem.response.bodyLen,
-                               responseItem.response.pBody ) );
-
-                    if( responseItem.response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
-                    {
-                        LogError( ( "Recieved repsonse with unexpected status code: %d", responseItem.response.statusCode ) );
-                        returnStatus = false;
-                    }
-                    else
-                    {
-                        requestCount -= 1;
-                    }
-                }
-            }
-        }
+        /* Define the transport interface. */
+        ( void ) memset( &pWorker->transportInterface, 0, sizeof( pWorker->transportInterface ) );
+        pWorker->transportInterface.recv = Openssl_Recv;
+        pWorker->transportInterface.send = Openssl_Send;
+        pWorker->transportInterface.pNetworkContext = &pWorker->networkContext;
+
+        pWorker->connected = true;
+        pWorker->connectionCount++;
+        returnStatus = true;
+    }
+    else
+    {
+        LogError( ( "Failed to connect to HTTP server %s.",
+                    serverHost ) );
     }
 
     return returnStatus;
@@ -490,130 +514,126 @@ static bool downloadS3ObjectFile( const char * pHost,
 
 /*-----------------------------------------------------------*/
 
-static QueueOpStatus_t requestS3ObjectRange( const HTTPRequestInfo_t * requestInfo,
-                                             mqd_t requestQueue,
-                                             const size_t start,
-                                             const size_t end )
+static void disconnectWorker( DownloadWorker_t * pWorker )
 {
-    QueueOpStatus_t returnStatus = QUEUE_OP_SUCCESS;
-    HTTPStatus_t httpStatus = HTTPSuccess;
+    if( pWorker->connected == true )
+    {
+        /* End TLS session, then close TCP connection. */
+        ( void ) Openssl_Disconnect( &pWorker->networkContext );
+        pWorker->connected = false;
+    }
+}
 
-    /* Return value of mq_send. */
-    int mqerror = 0;
+/*-----------------------------------------------------------*/
 
-    /* Set the buffer used for storing request headers. */
-    requestItem.requestHeaders.pBuffer = requestItem.headersBuffer;
-    requestItem.requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+static bool initRequestTemplate( DownloadWorker_t * pWorker )
+{
+    HTTPStatus_t httpStatus = HTTPSuccess;
 
-    httpStatus = HTTPClient_InitializeRequestHeaders( &( requestItem.requestHeaders ),
-                                                      requestInfo );
+    httpStatus = HttpRequestTemplate_Init( &pWorker->requestTemplate,
+                                           pWorker->pTemplateBuffer,
+                                           REQUEST_TEMPLATE_BUFFER_LENGTH,
+                                           &requestInfo );
 
-    if( httpStatus != HTTPSuccess )
+    /* Once the ETag of the object is known, only download ranges of the same
+     * version of the object, since the file may mix ranges of different
+     * downloads. */
+    if( ( httpStatus == HTTPSuccess ) && ( downloadJob.etagLength > 0U ) )
     {
-        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
-                    HTTPClient_strerror( httpStatus ) ) );
-        returnStatus = QUEUE_OP_FAILURE;
+        httpStatus = HttpRequestTemplate_AddHeader( &pWorker->requestTemplate,
+                                                    HTTP_IF_MATCH_HEADER_FIELD,
+                                                    HTTP_IF_MATCH_HEADER_FIELD_LENGTH,
+                                                    downloadJob.etag,
+                                                    downloadJob.etagLength );
     }
 
-    if( returnStatus == QUEUE_OP_SUCCESS )
+    /* The Range header is added last, for its positions to be patched for
+     * each request. */
+    if( httpStatus == HTTPSuccess )
     {
-        httpStatus = HTTPClient_AddRangeHeader( &( requestItem.requestHeaders ),
-                                                start,
-                                                end );
-
-        if( httpStatus != HTTPSuccess )
-        {
-            LogError( ( "Failed to add Range header to request headers: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
-            returnStatus = QUEUE_OP_FAILURE;
-        }
+        httpStatus = HttpRequestTemplate_ReserveRange( &pWorker->requestTemplate );
     }
 
-    if( returnStatus == EXIT_SUCCESS )
+    if( httpStatus != HTTPSuccess )
     {
-        /* Enqueue the request. */
-        LogInfo( ( "Enqueuing bytes %d to %d of S3 Object:  ",
-                   ( int32_t ) start,
-                   ( int32_t ) end ) );
-        LogInfo( ( "Request Headers:\n%.*s",
-                   ( int32_t ) requestItem.requestHeaders.headersLen,
-                   ( char * ) requestItem.requestHeaders.pBuffer ) );
-
-        mqerror = mq_send( requestQueue,
-                           ( char * ) &requestItem,
-                           sizeof( RequestItem_t ),
-                           0 );
-
-        if( mqerror == -1 )
-        {
-            if( errno != EAGAIN )
-            {
-                /* Error other than due to not blocking. */
-                LogError( ( "Failed to write to request queue with error %s.",
-                            strerror( errno ) ) );
-                returnStatus = QUEUE_OP_FAILURE;
-            }
-            else
-            {
-                returnStatus = QUEUE_OP_WOULD_BLOCK;
-            }
-        }
+        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+                    HTTPClient_strerror( httpStatus ) ) );
     }
 
-    return returnStatus;
+    return( httpStatus == HTTPSuccess );
 }
 
 /*-----------------------------------------------------------*/
 
-static QueueOpStatus_t retrieveHTTPResponse( mqd_t responseQueue,
-                                             ResponseItem_t * responseItem )
+static HTTPStatus_t requestS3ObjectRange( DownloadWorker_t * pWorker,
+                                          uint64_t start,
+                                          uint64_t end,
+                                          HTTPResponse_t * pResponse )
 {
-    QueueOpStatus_t returnStatus = QUEUE_OP_SUCCESS;
+    HTTPStatus_t httpStatus = HTTPSuccess;
 
-    /* Return value of mq_receive. */
-    int mqread = 0;
+    /* Initialize the response object. The request is held by the request
+     * template of the worker. */
+    ( void ) memset( pResponse, 0, sizeof( HTTPResponse_t ) );
+    pResponse->pBuffer = pWorker->pBuffer;
+    pResponse->bufferLen = USER_BUFFER_LENGTH;
 
-    /* Read response from queue. */
-    mqread = mq_receive( responseQueue, ( char * ) responseItem,
-                         sizeof( ResponseItem_t ), NULL );
+    /* Only the positions of the Range header change from one request to the
+     * next. Unlike HTTPClient_AddRangeHeader, they are not limited to 32 bits,
+     * so objects larger than 2 GiB can be addressed. */
+    httpStatus = HttpRequestTemplate_SetRange( &pWorker->requestTemplate, start, end );
 
-    if( mqread == -1 )
+    if( httpStatus != HTTPSuccess )
+    {
+        LogError( ( "Failed to add Range header to request headers: Error=%s.",
+                    HTTPClient_strerror( httpStatus ) ) );
+    }
+    else
     {
-        if( errno != EAGAIN )
+        LogDebug( ( "Request Headers:\n%.*s",
+                    ( int32_t ) pWorker->requestTemplate.headers.headersLen,
+                    ( char * ) pWorker->requestTemplate.headers.pBuffer ) );
+
+        httpStatus = HTTPClient_Send( &pWorker->transportInterface,
+                                      &pWorker->requestTemplate.headers,
+                                      NULL,
+                                      0,
+                                      pResponse,
+                                      0 );
+
+        if( httpStatus != HTTPSuccess )
         {
-            /* Error other than due to not blocking. */
-            LogError( ( "Failed to read from response queue with error %s.",
-                        strerror( errno ) ) );
-            returnStatus = QUEUE_OP_FAILURE;
+            LogError( ( "Failed to send HTTP request for bytes %llu-%llu: Error=%s.",
+                        ( unsigned long long ) start,
+                        ( unsigned long long ) end,
+                        HTTPClient_strerror( httpStatus ) ) );
+
+            /* Part of the response may be left unread on the connection. */
+            disconnectWorker( pWorker );
         }
-        else
+        else if( ( pResponse->respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U )
         {
-            returnStatus = QUEUE_OP_WOULD_BLOCK;
+            /* S3 closes connections after about 100 requests. */
+            LogInfo( ( "Server closed the connection, reconnecting for the next range." ) );
+            disconnectWorker( pWorker );
         }
-    }
-
-    if( returnStatus == QUEUE_OP_SUCCESS )
-    {
-        if( mqread != sizeof( ResponseItem_t ) )
+        else
         {
-            LogError( ( "Response from response queue has incorrect size." ) );
-            returnStatus = QUEUE_OP_FAILURE;
+            /* Empty else MISRA 15.7 */
         }
     }
 
-    return returnStatus;
+    return httpStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
-                                 mqd_t requestQueue,
-                                 mqd_t responseQueue,
-                                 size_t * pFileSize )
+static bool getS3ObjectFileSize( DownloadWorker_t * pWorker,
+                                 uint64_t * pFileSize,
+                                 HTTPResponse_t * pResponse )
 {
     bool returnStatus = true;
     HTTPStatus_t httpStatus = HTTPSuccess;
-    QueueOpStatus_t queueOpStatus = QUEUE_OP_SUCCESS;
 
     /* The location of the file size in contentRangeValStr. */
     char * pFileSizeStr = NULL;
@@ -622,43 +642,35 @@ static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
     char * contentRangeValStr = NULL;
     size_t contentRangeValStrLength = 0;
 
+    /* The ETag header value. */
+    const char * pEtag = NULL;
+    size_t etagLength = 0;
+
     LogInfo( ( "Getting file object size from host..." ) );
 
-    /* Request bytes 0 to 0. S3 will respond with a Content-Range
-     * header that contains the size of the file in it. This header will look
-     * like: "Content-Range: bytes 0-0/FILESIZE". The body will have a single
-     * byte that we are ignoring. */
-    queueOpStatus = requestS3ObjectRange( requestInfo,
-                                          requestQueue,
-                                          0,
-                                          0 );
+    /* S3 responds with a Content-Range header that contains the size of the
+     * file in it. This header will look like: "Content-Range: bytes
+     * 0-0/FILESIZE" for a request of bytes 0 to 0, whose single byte is
+     * ignored. */
+    httpStatus = requestS3ObjectRange( pWorker, 0U, SIZE_REQUEST_LAST_BYTE, pResponse );
 
-    if( queueOpStatus != QUEUE_OP_SUCCESS )
+    if( httpStatus != HTTPSuccess )
     {
         returnStatus = false;
     }
-
-    if( returnStatus == true )
+    else if( pResponse->statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
     {
-        do
-        {
-            queueOpStatus = retrieveHTTPResponse( responseQueue, &responseItem );
-        } while( queueOpStatus == QUEUE_OP_WOULD_BLOCK );
-
-        if( queueOpStatus == QUEUE_OP_FAILURE )
-        {
-            returnStatus = false;
-        }
-        else if( responseItem.response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
-        {
-            LogError( ( "Received response with unexpected status code: %d.", responseItem.response.statusCode ) );
-            returnStatus = false;
-        }
+        LogError( ( "Received response with unexpected status code: %d.", pResponse->statusCode ) );
+        returnStatus = false;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
     }
 
     if( returnStatus == true )
     {
-        httpStatus = HTTPClient_ReadHeader( &responseItem.response,
+        httpStatus = HTTPClient_ReadHeader( pResponse,
                                             ( char * ) HTTP_CONTENT_RANGE_HEADER_FIELD,
                                             ( size_t ) HTTP_CONTENT_RANGE_HEADER_FIELD_LENGTH,
                                             ( const char ** ) &contentRangeValStr,
@@ -688,19 +700,44 @@ static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
     if( returnStatus == true )
     {
         pFileSizeStr += sizeof( char );
-        *pFileSize = ( size_t ) strtoul( pFileSizeStr, NULL, 10 );
+        *pFileSize = ( uint64_t ) strtoull( pFileSizeStr, NULL, 10 );
+
+        if( ( *pFileSize == 0U ) || ( *pFileSize == ( uint64_t ) ULLONG_MAX ) )
+        {
+            LogError( ( "Error using strtoull to get the file size from %s: fileSize=%llu.",
+                        pFileSizeStr, ( unsigned long long ) *pFileSize ) );
+            returnStatus = false;
+        }
+    }
 
-        if( ( *pFileSize == 0 ) || ( *pFileSize == UINT32_MAX ) )
+    if( returnStatus == true )
+    {
+        httpStatus = HTTPClient_ReadHeader( pResponse,
+                                            HTTP_ETAG_HEADER_FIELD,
+                                            HTTP_ETAG_HEADER_FIELD_LENGTH,
+                                            &pEtag,
+                                            &etagLength );
+
+        if( ( httpStatus != HTTPSuccess ) || ( etagLength > sizeof( downloadJob.etag ) ) )
         {
-            LogError( ( "Error using strtoul to get the file size from %s: fileSize=%d.",
-                        pFileSizeStr, ( int32_t ) *pFileSize ) );
+            LogError( ( "Failed to read the ETag header from HTTP response: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
             returnStatus = false;
         }
+        else
+        {
+            /* The response is overwritten by the next request. */
+            ( void ) memcpy( downloadJob.etag, pEtag, etagLength );
+            downloadJob.etagLength = etagLength;
+        }
     }
 
     if( returnStatus == true )
     {
-        LogInfo( ( "The file is %d bytes long.", ( int32_t ) *pFileSize ) );
+        LogInfo( ( "The file is %llu bytes long, with ETag %.*s.",
+                   ( unsigned long long ) *pFileSize,
+                   ( int ) downloadJob.etagLength,
+                   downloadJob.etag ) );
     }
 
     return returnStatus;
@@ -708,140 +745,442 @@ static bool getS3ObjectFileSize( const HTTPRequestInfo_t * requestInfo,
 
 /*-----------------------------------------------------------*/
 
-static pid_t startHTTPThread( const TransportInterface_t * pTransportInterface )
+static bool writeRange( const uint8_t * pData,
+                        size_t dataLength,
+                        uint64_t offset )
 {
-    /* Return value of fork. */
-    pid_t forkPID = -1;
-
-    /* Fork to create the HTTP thread. */
-    forkPID = fork();
+    bool returnStatus = true;
+    size_t bytesWritten = 0U;
+    ssize_t writeResult = 0;
 
-    if( forkPID == -1 )
+    /* Ranges are written at their own offsets, so workers need no lock to
+     * share the file. */
+    while( ( returnStatus == true ) && ( bytesWritten < dataLength ) )
     {
-        LogError( ( "Error forking." ) );
+        writeResult = pwrite( downloadJob.fileDescriptor,
+                              &pData[ bytesWritten ],
+                              dataLength - bytesWritten,
+                              ( off_t ) ( offset + bytesWritten ) );
+
+        if( writeResult > 0 )
+        {
+            bytesWritten += ( size_t ) writeResult;
+        }
+        else if( ( writeResult < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before writing anything, retry. */
+        }
+        else
+        {
+            LogError( ( "Failed to write to %s: %s.",
+                        DOWNLOAD_FILE_PATH,
+                        strerror( errno ) ) );
+            returnStatus = false;
+        }
     }
-    else if( forkPID == 0 )
-    {
-        /* HTTP thread. */
 
-        /* Queues for HTTP requests and responses. */
-        mqd_t requestQueue = -1;
-        mqd_t responseQueue = -1;
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool downloadRange( DownloadWorker_t * pWorker,
+                           uint64_t rangeIndex )
+{
+    bool returnStatus = false;
+    bool retry = true;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+    /* Represents a response returned from an HTTP server. */
+    HTTPResponse_t response;
+    uint64_t start = rangeIndex * ( uint64_t ) RANGE_REQUEST_LENGTH;
+    uint64_t length = downloadJob.fileSize - start;
+    uint32_t attempt = 0U;
 
-        /* Open queues for read/write. */
-        requestQueue = mq_open( REQUEST_QUEUE, O_RDONLY );
-        responseQueue = mq_open( RESPONSE_QUEUE, O_WRONLY );
+    if( length > ( uint64_t ) RANGE_REQUEST_LENGTH )
+    {
+        length = ( uint64_t ) RANGE_REQUEST_LENGTH;
+    }
 
-        /* Initialize response struct. */
-        responseItem.response.pBuffer = responseItem.responseBuffer;
-        responseItem.response.bufferLen = sizeof( responseItem.responseBuffer );
+    for( attempt = 0U; ( attempt < DOWNLOAD_MAX_RANGE_ATTEMPTS ) && ( retry == true ); attempt++ )
+    {
+        retry = false;
 
-        for( ; ; )
+        if( ( pWorker->connected == false ) && ( connectWorker( pWorker ) == false ) )
         {
-            HTTPStatus_t httpStatus = HTTPSuccess;
+            /* The connection was already retried with backoff. */
+        }
+        else
+        {
+            LogDebug( ( "Downloading bytes %llu-%llu, out of %llu total bytes.",
+                        ( unsigned long long ) start,
+                        ( unsigned long long ) ( start + length - 1U ),
+                        ( unsigned long long ) downloadJob.fileSize ) );
 
-            /* Return value of mq_receive. */
-            int mqread = 0;
-            /* Return value of mq_send. */
-            int mqerror = 0;
+            TRACE_PROBE2( http_range_start, start, start + length - 1U );
 
-            /* Read request from queue. */
-            mqread = mq_receive( requestQueue,
-                                 ( char * ) &requestItem,
-                                 sizeof( RequestItem_t ),
-                                 NULL );
+            httpStatus = requestS3ObjectRange( pWorker,
+                                               start,
+                                               start + length - 1U,
+                                               &response );
 
-            if( mqread == -1 )
+            TRACE_PROBE3( http_range_done, httpStatus, response.statusCode, response.bodyLen );
+
+            if( httpStatus != HTTPSuccess )
             {
-                LogError( ( "Failed to read from request queue with error %s.",
-                            strerror( errno ) ) );
+                /* Retry the range over a new connection. */
+                retry = true;
             }
-
-            if( mqread != sizeof( RequestItem_t ) )
+            else if( response.statusCode == HTTP_STATUS_CODE_PRECONDITION_FAILED )
+            {
+                LogError( ( "The object changed during the download, it must be downloaded again." ) );
+                __atomic_store_n( &downloadJob.objectChanged, true, __ATOMIC_RELAXED );
+            }
+            else if( response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
+            {
+                LogError( ( "Received response with unexpected status code: %d.",
+                            response.statusCode ) );
+            }
+            else if( response.bodyLen != length )
+            {
+                LogError( ( "Received %lu bytes for a range of %llu bytes.",
+                            ( unsigned long ) response.bodyLen,
+                            ( unsigned long long ) length ) );
+            }
+            else
             {
-                LogError( ( "Response from request queue has incorrect size." ) );
+                returnStatus = writeRange( response.pBody, response.bodyLen, start );
             }
+        }
+    }
 
-            LogInfo( ( "HTTP thread retrieved request." ) );
-            LogInfo( ( "Request Headers:\n%.*s",
-                       ( int32_t ) requestItem.requestHeaders.headersLen,
-                       ( char * ) requestItem.requestHeaders.pBuffer ) );
+    if( ( returnStatus == true ) &&
+        ( DownloadCheckpoint_MarkRangeComplete( &downloadJob.checkpoint, rangeIndex ) != DOWNLOAD_CHECKPOINT_SUCCESS ) )
+    {
+        returnStatus = false;
+    }
 
-            httpStatus = HTTPClient_Send( pTransportInterface,
-                                          &requestItem.requestHeaders,
-                                          NULL,
-                                          0,
-                                          &responseItem.response,
-                                          0 );
+    if( returnStatus == true )
+    {
+        pWorker->bytesDownloaded += length;
+        pWorker->rangeCount++;
+    }
 
-            if( httpStatus != HTTPSuccess )
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 )
+
+    static bool storeFirstRange( DownloadWorker_t * pWorker,
+                                 const HTTPResponse_t * pResponse )
+    {
+        bool returnStatus = true;
+        uint64_t length = downloadJob.fileSize;
+
+        if( length > ( uint64_t ) RANGE_REQUEST_LENGTH )
+        {
+            length = ( uint64_t ) RANGE_REQUEST_LENGTH;
+        }
+
+        if( DownloadCheckpoint_IsRangeComplete( &downloadJob.checkpoint, 0U ) == true )
+        {
+            /* Written by an earlier download of the same object. */
+        }
+        else if( pResponse->bodyLen != length )
+        {
+            LogError( ( "Received %lu bytes for a range of %llu bytes.",
+                        ( unsigned long ) pResponse->bodyLen,
+                        ( unsigned long long ) length ) );
+            returnStatus = false;
+        }
+        else
+        {
+            returnStatus = writeRange( pResponse->pBody, pResponse->bodyLen, 0U );
+
+            if( ( returnStatus == true ) &&
+                ( DownloadCheckpoint_MarkRangeComplete( &downloadJob.checkpoint, 0U ) != DOWNLOAD_CHECKPOINT_SUCCESS ) )
             {
-                LogError( ( "Failed to send HTTP request: Error=%s.",
-                            HTTPClient_strerror( httpStatus ) ) );
+                returnStatus = false;
             }
-            else
+
+            if( returnStatus == true )
             {
-                LogInfo( ( "HTTP thread received HTTP response" ) );
-                /* Write response to queue. */
-                mqerror = mq_send( responseQueue,
-                                   ( char * ) &responseItem,
-                                   sizeof( ResponseItem_t ),
-                                   0 );
-
-                if( mqerror != 0 )
-                {
-                    LogError( ( "Failed to write to response queue with error %s.",
-                                strerror( errno ) ) );
-                }
+                pWorker->bytesDownloaded += length;
+                pWorker->rangeCount++;
             }
         }
+
+        /* The workers start with the second range. */
+        downloadJob.nextRange = 1U;
+
+        return returnStatus;
     }
 
-    return forkPID;
+#endif /* if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static void * workerTask( void * pArgument )
+{
+    DownloadWorker_t * pWorker = ( DownloadWorker_t * ) pArgument;
+    uint64_t rangeIndex = 0U;
+    bool done = false;
+
+    while( done == false )
+    {
+        /* Claim the next range. Relaxed ordering suffices as the ranges share
+         * no data other than the file, written with pwrite. */
+        rangeIndex = __atomic_fetch_add( &downloadJob.nextRange, 1U, __ATOMIC_RELAXED );
+
+        if( ( rangeIndex >= downloadJob.rangeCount ) ||
+            ( __atomic_load_n( &downloadJob.failed, __ATOMIC_RELAXED ) == true ) )
+        {
+            done = true;
+        }
+        else if( DownloadCheckpoint_IsRangeComplete( &downloadJob.checkpoint, rangeIndex ) == true )
+        {
+            /* Written by an earlier download of the same object. */
+        }
+        else if( downloadRange( pWorker, rangeIndex ) == false )
+        {
+            /* Stop all workers, the file cannot be completed. */
+            __atomic_store_n( &downloadJob.failed, true, __ATOMIC_RELAXED );
+            done = true;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    disconnectWorker( pWorker );
+
+    return NULL;
 }
 
 /*-----------------------------------------------------------*/
 
-void tearDown( pid_t httpThread,
-               mqd_t requestQueue,
-               mqd_t responseQueue )
+static bool downloadS3ObjectFile( void )
 {
-    /* End http task. */
-    if( httpThread != -1 )
+    bool returnStatus = true;
+    int allocateStatus = 0;
+    int threadStatus = 0;
+    size_t i = 0U;
+    uint32_t startTimeMs = 0U, elapsedTimeMs = 0U;
+    uint64_t throughputKiBs = 0U;
+    uint32_t connectionCount = 0U;
+    uint64_t bytesDownloaded = 0U;
+    uint64_t resumedRangeCount = 0U;
+    bool checkpointOpened = false;
+    bool removeCheckpoint = false;
+    /* The response to the request for the size of the file. */
+    HTTPResponse_t sizeResponse;
+
+    ( void ) memset( &downloadJob, 0, sizeof( downloadJob ) );
+    downloadJob.fileDescriptor = -1;
+    ( void ) memset( workers, 0, sizeof( workers ) );
+
+    for( i = 0U; i < DOWNLOAD_WORKER_COUNT; i++ )
+    {
+        workers[ i ].pBuffer = workerBuffers[ i ];
+        workers[ i ].pTemplateBuffer = templateBuffers[ i ];
+    }
+
+    #if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 )
+        /* The first range is part of the download. */
+        startTimeMs = Clock_GetTimeMs();
+    #endif
+
+    /* The first worker gets the size of the file, then keeps its connection
+     * for its ranges. */
+    if( ( initRequestTemplate( &workers[ 0 ] ) == false ) ||
+        ( connectWorker( &workers[ 0 ] ) == false ) )
+    {
+        returnStatus = false;
+    }
+    else
     {
-        kill( httpThread, SIGTERM );
+        returnStatus = getS3ObjectFileSize( &workers[ 0 ], &downloadJob.fileSize, &sizeResponse );
     }
 
-    /* Close and then delete the queues. */
-    if( requestQueue != -1 )
+    /* The requests for the ranges carry the ETag of the object. */
+    for( i = 0U; ( i < DOWNLOAD_WORKER_COUNT ) && ( returnStatus == true ); i++ )
     {
-        if( mq_close( requestQueue ) == -1 )
+        returnStatus = initRequestTemplate( &workers[ i ] );
+    }
+
+    if( returnStatus == true )
+    {
+        downloadJob.rangeCount = ( downloadJob.fileSize + RANGE_REQUEST_LENGTH - 1U ) / RANGE_REQUEST_LENGTH;
+
+        /* The file is only truncated once the checkpoint shows that none of
+         * its ranges can be kept. */
+        downloadJob.fileDescriptor = open( DOWNLOAD_FILE_PATH,
+                                           O_WRONLY | O_CREAT,
+                                           0644 );
+
+        if( downloadJob.fileDescriptor == -1 )
         {
-            LogError( ( "Failed to close request queue with error %s.",
+            LogError( ( "Failed to open %s: %s.",
+                        DOWNLOAD_FILE_PATH,
                         strerror( errno ) ) );
+            returnStatus = false;
         }
+    }
+
+    if( returnStatus == true )
+    {
+        checkpointOpened = ( DownloadCheckpoint_Open( &downloadJob.checkpoint,
+                                                      DOWNLOAD_CHECKPOINT_PATH,
+                                                      downloadJob.fileDescriptor,
+                                                      downloadJob.fileSize,
+                                                      RANGE_REQUEST_LENGTH,
+                                                      downloadJob.etag,
+                                                      downloadJob.etagLength,
+                                                      checkpointBitmap,
+                                                      sizeof( checkpointBitmap ),
+                                                      DOWNLOAD_CHECKPOINT_SYNC_INTERVAL,
+                                                      &resumedRangeCount ) == DOWNLOAD_CHECKPOINT_SUCCESS );
+        returnStatus = checkpointOpened;
+    }
 
-        if( mq_unlink( REQUEST_QUEUE ) == -1 )
+    if( ( returnStatus == true ) && ( resumedRangeCount == 0U ) &&
+        ( ftruncate( downloadJob.fileDescriptor, 0 ) != 0 ) )
+    {
+        LogError( ( "Failed to truncate %s: %s.",
+                    DOWNLOAD_FILE_PATH,
+                    strerror( errno ) ) );
+        returnStatus = false;
+    }
+
+    if( returnStatus == true )
+    {
+        /* Allocate the whole file up front, so that the ranges written out of
+         * order do not fragment it, and a full disk fails the download
+         * before it starts. */
+        allocateStatus = posix_fallocate( downloadJob.fileDescriptor,
+                                          0,
+                                          ( off_t ) downloadJob.fileSize );
+
+        if( allocateStatus != 0 )
         {
-            LogError( ( "Failed to delete request queue with error %s.",
-                        strerror( errno ) ) );
+            LogError( ( "Failed to allocate %llu bytes for %s: %s.",
+                        ( unsigned long long ) downloadJob.fileSize,
+                        DOWNLOAD_FILE_PATH,
+                        strerror( allocateStatus ) ) );
+            returnStatus = false;
         }
     }
 
-    if( responseQueue != -1 )
+    #if ( RANGE_SIZE_DISCOVERY_ENABLED == 1 )
+        if( returnStatus == true )
+        {
+            /* The first range came with the size of the file, and is still
+             * in the buffer of the first worker. */
+            returnStatus = storeFirstRange( &workers[ 0 ], &sizeResponse );
+        }
+    #endif
+
+    if( returnStatus == true )
     {
-        if( mq_close( responseQueue ) == -1 )
+        /* The first worker holds the first range when it came with the size
+         * of the file. */
+        LogInfo( ( "Downloading %llu ranges of %d bytes with %d workers to %s.",
+                   ( unsigned long long ) ( downloadJob.rangeCount - resumedRangeCount - workers[ 0 ].rangeCount ),
+                   RANGE_REQUEST_LENGTH,
+                   DOWNLOAD_WORKER_COUNT,
+                   DOWNLOAD_FILE_PATH ) );
+
+        #if ( RANGE_SIZE_DISCOVERY_ENABLED == 0 )
+            startTimeMs = Clock_GetTimeMs();
+        #endif
+
+        for( i = 0U; ( i < DOWNLOAD_WORKER_COUNT ) && ( returnStatus == true ); i++ )
         {
-            LogError( ( "Failed to close response queue with error %s.",
-                        strerror( errno ) ) );
+            threadStatus = pthread_create( &workers[ i ].thread,
+                                           NULL,
+                                           workerTask,
+                                           &workers[ i ] );
+
+            if( threadStatus == 0 )
+            {
+                workers[ i ].threadStarted = true;
+            }
+            else
+            {
+                LogError( ( "Failed to create worker thread: %s.",
+                            strerror( threadStatus ) ) );
+                __atomic_store_n( &downloadJob.failed, true, __ATOMIC_RELAXED );
+                returnStatus = false;
+            }
+        }
+    }
+
+    for( i = 0U; i < DOWNLOAD_WORKER_COUNT; i++ )
+    {
+        if( workers[ i ].threadStarted == true )
+        {
+            ( void ) pthread_join( workers[ i ].thread, NULL );
+
+            LogDebug( ( "Worker %lu downloaded %llu bytes in %lu ranges over %lu connections.",
+                        ( unsigned long ) i,
+                        ( unsigned long long ) workers[ i ].bytesDownloaded,
+                        ( unsigned long ) workers[ i ].rangeCount,
+                        ( unsigned long ) workers[ i ].connectionCount ) );
+            connectionCount += workers[ i ].connectionCount;
+            bytesDownloaded += workers[ i ].bytesDownloaded;
         }
 
-        if( mq_unlink( RESPONSE_QUEUE ) == -1 )
+        /* The connection of the first worker is established even if its
+         * thread was not started. */
+        disconnectWorker( &workers[ i ] );
+    }
+
+    if( ( returnStatus == true ) && ( downloadJob.failed == true ) )
+    {
+        returnStatus = false;
+    }
+
+    if( checkpointOpened == true )
+    {
+        /* Keep the checkpoint of an interrupted download, to resume it with
+         * the next attempt. It is useless once the object changed. */
+        removeCheckpoint = ( returnStatus == true ) || ( downloadJob.objectChanged == true );
+
+        if( DownloadCheckpoint_Close( &downloadJob.checkpoint,
+                                      DOWNLOAD_CHECKPOINT_PATH,
+                                      removeCheckpoint ) != DOWNLOAD_CHECKPOINT_SUCCESS )
         {
-            LogError( ( "Failed to delete response queue with error %s.",
+            returnStatus = false;
+        }
+    }
+
+    if( downloadJob.fileDescriptor != -1 )
+    {
+        if( close( downloadJob.fileDescriptor ) != 0 )
+        {
+            LogError( ( "Failed to close %s: %s.",
+                        DOWNLOAD_FILE_PATH,
                         strerror( errno ) ) );
+            returnStatus = false;
         }
     }
+
+    if( returnStatus == true )
+    {
+        elapsedTimeMs = Clock_GetTimeMs() - startTimeMs;
+        throughputKiBs = ( bytesDownloaded * 1000U ) /
+                         ( ( uint64_t ) ( ( elapsedTimeMs > 0U ) ? elapsedTimeMs : 1U ) * 1024U );
+
+        LogInfo( ( "Downloaded %llu bytes in %lu ms over %lu connections: %llu KiB/s.",
+                   ( unsigned long long ) bytesDownloaded,
+                   ( unsigned long ) elapsedTimeMs,
+                   ( unsigned long ) connectionCount,
+                   ( unsigned long long ) throughputKiBs ) );
+    }
+
+    return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
@@ -852,14 +1191,20 @@ void tearDown( pid_t httpThread,
  * This example resolves a domain, establishes a TCP connection, validates the
  * server's certificate using the root CA certificate defined in the config
  * header, then finally performs a TLS handshake with the HTTP server so that
- * all communication is encrypted. After which, an HTTP thread is started which
- * uses HTTP Client library API to send requests it reads from the request
- * queue, and writes the responses to the response queue. The main thread sends
- * requests on the request queue, which are used to download
- * the S3 file by sending multiple range requests. While it is doing this, the
- * main thread also reads responses from the response queue and prints them
- * until the entire file is received. If any request fails, an error
- * code is returned.
+ * all communication is encrypted. After which, the size of the S3 file is
+ * retrieved, and #DOWNLOAD_WORKER_COUNT worker threads, each with its own TLS
+ * connection, download the file in ranges of #RANGE_REQUEST_LENGTH bytes in
+ * parallel. Each worker claims the next range that has not been downloaded
+ * and writes it at its offset in a preallocated file, until the entire file
+ * is received. The aggregate throughput is then reported. If any request
+ * fails, an error code is returned.
+ *
+ * The ranges written to the file are recorded in a checkpoint file, synced
+ * every #DOWNLOAD_CHECKPOINT_SYNC_INTERVAL ranges. A download interrupted by a
+ * failure or a crash then only requests the missing ranges, as long as the
+ * ETag of the object is unchanged. Each range request carries an If-Match
+ * header with the ETag, so that the file never mixes two versions of the
+ * object.
  *
  * @note This example is multi-threaded and uses statically allocated memory.
  *
@@ -868,12 +1213,9 @@ void tearDown( pid_t httpThread,
  * (located in located in demos/http/common/src) to generate these URLs. For
  * detailed instructions, see the accompanied README.md.
  *
- * @note If your file requires more than 99 range requests to S3 (depending on
- * the size of the file and the length specified in RANGE_REQUEST_LENGTH), your
- * connection may be dropped by S3. In this case, either increase the buffer
- * size and range request length (if feasible), to reduce the number of requests
- * required, or re-establish the connection with S3 after receiving a
- * "Connection: close" response header.
+ * @note S3 sends a "Connection: close" response header after about 100
+ * requests over a connection. The worker then establishes a new connection
+ * for its next range.
  */
 int main( int argc,
           char ** argv )
@@ -884,196 +1226,72 @@ int main( int argc,
     /* HTTPS Client library return status. */
     HTTPStatus_t httpStatus = HTTPSuccess;
 
-    /* The location of the path within the pre-signed URL. */
-    const char * pPath = NULL;
-
-    /* The length of the path within the pre-signed URL. This variable is
-     * defined in order to store the length returned from parsing the URL,
-     * but it is unused. The path used for the requests in this demo needs
-     * all the query information following the location of the object, to
-     * the end of the S3 presigned URL. */
-    size_t pathLen = 0;
-    /* The length of the Request-URI within string S3_PRESIGNED_GET_URL */
-    size_t requestUriLen = 0;
-
-    /* The transport layer interface used by the HTTP Client library. */
-    TransportInterface_t transportInterface = { 0 };
-    /* The network context for the transport layer interface. */
-    NetworkContext_t networkContext = { 0 };
-    OpensslParams_t opensslParams = { 0 };
-
-    /* Queue for HTTP requests. Requests are written by the main thread,
-     * and serviced by the HTTP thread. */
-    mqd_t requestQueue = -1;
-
-    /* Queue for HTTP responses. Responses are written by the HTTP thread,
-     * and read by the main thread. */
-    mqd_t responseQueue = -1;
-
-    /* PID of HTTP thread. */
-    pid_t httpThread = -1;
     int demoRunCount = 0;
 
     ( void ) argc;
     ( void ) argv;
 
-    /* Set the pParams member of the network context with desired transport. */
-    networkContext.pParams = &opensslParams;
-
     LogInfo( ( "HTTP Client multi-threaded S3 download demo using pre-signed URL:\n%s", S3_PRESIGNED_GET_URL ) );
 
     /**************************** Parse Signed URL. ******************************/
 
-    /* Retrieve the path location from S3_PRESIGNED_GET_URL. This
-     * function returns the length of the path without the query into
-     * pathLen. */
-    httpStatus = getUrlPath( S3_PRESIGNED_GET_URL,
-                             S3_PRESIGNED_GET_URL_LENGTH,
-                             &pPath,
-                             &pathLen );
-
-    /* The path used for the requests in this demo needs
-     * all the query information following the location of the object, to
-     * the end of the S3 presigned URL. */
-    requestUriLen = strlen( pPath );
+    /* The URL is parsed once. The host, path and query of every request and
+     * connection of every demo iteration are offsets into
+     * S3_PRESIGNED_GET_URL. */
+    httpStatus = parseUrl( S3_PRESIGNED_GET_URL,
+                           S3_PRESIGNED_GET_URL_LENGTH,
+                           &presignedUrl );
 
     if( httpStatus != HTTPSuccess )
     {
         returnStatus = EXIT_FAILURE;
-        LogError( ( "Getting the URL path from pre-signed URL failed. httpStatus=%d.",
+        LogError( ( "Parsing the pre-signed URL failed. httpStatus=%d.",
                     httpStatus ) );
     }
-
-    if( returnStatus == EXIT_SUCCESS )
+    else if( copyUrlHost( &presignedUrl, serverHost, sizeof( serverHost ) ) == false )
     {
-        /* Retrieve the address location and length from the S3_PRESIGNED_GET_URL. */
-        httpStatus = getUrlAddress( S3_PRESIGNED_GET_URL,
-                                    S3_PRESIGNED_GET_URL_LENGTH,
-                                    &pHost,
-                                    &hostLen );
-
-        if( httpStatus != HTTPSuccess )
-        {
-            returnStatus = EXIT_FAILURE;
-            LogError( ( "Getting the URL address from pre-signed URL failed. httpStatus=%d.",
-                        httpStatus ) );
-        }
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
     }
 
     if( returnStatus == EXIT_SUCCESS )
     {
+        /* Initialize the request object. The path used for the requests in
+         * this demo needs all the query information following the location
+         * of the object, to the end of the S3 presigned URL. */
+        requestInfo.pHost = serverHost;
+        requestInfo.hostLen = presignedUrl.host.length;
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
+        requestInfo.pPath = &S3_PRESIGNED_GET_URL[ presignedUrl.requestTarget.offset ];
+        requestInfo.pathLen = presignedUrl.requestTarget.length;
+
+        /* Set "Connection" HTTP header to "keep-alive" so that multiple
+         * requests can be sent over the same established TCP connection.
+         * This is done in order to download the file in parts. */
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
         do
         {
-            /**************************** Connect. ******************************/
-
-            /* Establish a TLS connection on top of TCP connection using OpenSSL. */
-
-            /* Attempt to connect to the HTTP server. If connection fails, retry
-             * after a timeout. The timeout value will be exponentially
-             * increased till the maximum attempts are reached or maximum
-             * timeout value is reached. The function returns EXIT_FAILURE if
-             * the TCP connection cannot be established to broker after
-             * the configured number of attempts. */
-            returnStatus = connectToServerWithBackoffRetries( connectToServer,
-                                                              &networkContext );
-
-            /* Define the transport interface. */
-            if( returnStatus == EXIT_SUCCESS )
-            {
-                transportInterface.recv = Openssl_Recv;
-                transportInterface.send = Openssl_Send;
-                transportInterface.pNetworkContext = &networkContext;
-            }
-
-            /******************** Start queues and HTTP task. *******************/
-
-            /* Start request and response queues. */
-            if( returnStatus == EXIT_SUCCESS )
-            {
-                /* Settings for constructing queues. */
-                struct mq_attr queueSettings;
-
-                queueSettings.mq_maxmsg = QUEUE_SIZE;
-                queueSettings.mq_msgsize = sizeof( RequestItem_t );
-
-                requestQueue = mq_open( REQUEST_QUEUE,
-
-                                        /* These options create a queue if it does
-                                         * not already exist, and then opens it in
-                                         * non-blocking mode. It is opened as
-                                         * write-only as the main thread only writes
-                                         * HTTP requests to it. */
-                                        O_CREAT | O_NONBLOCK | O_WRONLY,
-                                        QUEUE_PERMISSIONS,
-                                        &queueSettings );
-
-                if( requestQueue == -1 )
-                {
-                    LogError( ( "Failed to open request queue with error %s.",
-                                strerror( errno ) ) );
-                    returnStatus = EXIT_FAILURE;
-                }
-
-                queueSettings.mq_msgsize = sizeof( ResponseItem_t );
-
-                responseQueue = mq_open( RESPONSE_QUEUE,
-
-                                         /* These options create a queue if it does
-                                          * not already exist, and then opens it in
-                                          * non-blocking mode. It is opened as
-                                          * read-only as the main thread only reads
-                                          * HTTP responses from it. */
-                                         O_CREAT | O_NONBLOCK | O_RDONLY,
-                                         QUEUE_PERMISSIONS,
-                                         &queueSettings );
-
-                if( responseQueue == -1 )
-                {
-                    LogError( ( "Failed to open response queue with error %s.",
-                                strerror( errno ) ) );
-                    returnStatus = EXIT_FAILURE;
-                }
-            }
-
-            /* Start the HTTP task which services requests in requestQueue. */
+            /******************** Download S3 Object File. **********************/
 
-            if( returnStatus == EXIT_SUCCESS )
+            /* The workers establish TLS connections on top of TCP connections
+             * using OpenSSL. If a connection fails, it is retried after a
+             * timeout. The timeout value will be exponentially increased
+             * till the maximum attempts are reached or maximum timeout value
+             * is reached. All connections are closed before returning. */
+            if( downloadS3ObjectFile() == false )
             {
-                httpThread = startHTTPThread( &transportInterface );
-
-                if( httpThread == -1 )
-                {
-                    returnStatus = EXIT_SUCCESS;
-                }
+                returnStatus = EXIT_FAILURE;
             }
-
-            /******************** Download S3 Object File. **********************/
-
-            if( returnStatus == EXIT_SUCCESS )
+            else
             {
-                bool result = false;
-                result = downloadS3ObjectFile( pHost,
-                                               hostLen,
-                                               pPath,
-                                               requestUriLen,
-                                               requestQueue,
-                                               responseQueue );
-
-                if( result == false )
-                {
-                    returnStatus = EXIT_FAILURE;
-                }
+                returnStatus = EXIT_SUCCESS;
             }
 
-            /************************** Disconnect. *****************************/
-
-            /* End TLS session, then close TCP connection. */
-            ( void ) Openssl_Disconnect( &networkContext );
-
-            /******************** Clean up queues and HTTP task. ****************/
-
-            tearDown( httpThread, requestQueue, responseQueue );
-
             /******************* Retry in case of failure. **********************/
 
             /* Increment the demo run count. */
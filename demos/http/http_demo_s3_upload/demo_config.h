@@ -108,4 +108,87 @@
  */
 #define USER_BUFFER_LENGTH                ( 2048 )
 
+/**
+ * @brief Set to 1 to upload the file at UPLOAD_FILE_PATH in parts, using the
+ * S3 multipart upload API, instead of uploading DEMO_HTTP_UPLOAD_DATA with a
+ * single PUT request.
+ *
+ * @note The parts are read from the file as they are sent, so the size of the
+ * file is not limited by memory.
+ */
+#define MULTIPART_UPLOAD_ENABLED          ( 0 )
+
+/**
+ * @brief The pre-signed URLs of the parts of a multipart upload, and the
+ * pre-signed URL completing it, generated by the python script located in
+ * common/src/presigned_urls_gen.py with the --parts option.
+ *
+ * @note The script initiates the multipart upload, and prints a URL for each
+ * of the number of parts given. Run this script and paste the output
+ * S3_PRESIGNED_UPLOAD_PART_URLS and S3_PRESIGNED_COMPLETE_MULTIPART_URL below.
+ *
+ * #define S3_PRESIGNED_UPLOAD_PART_URLS           { "...insert here...", "...insert here..." }
+ * #define S3_PRESIGNED_COMPLETE_MULTIPART_URL     "...insert here..."
+ */
+
+/**
+ * @brief Set to 1 to upload the file at UPLOAD_FILE_PATH with a single PUT
+ * request, instead of DEMO_HTTP_UPLOAD_DATA. Must not be 1 together with
+ * MULTIPART_UPLOAD_ENABLED.
+ *
+ * @note The body is sent from the file by the transport, with sendfile when
+ * the kernel encrypts the connection, so the size of the file is not limited
+ * by memory.
+ */
+#define FILE_UPLOAD_ENABLED               ( 0 )
+
+/**
+ * @brief Set to 1 to send the MD5 digest of each upload in a Content-MD5
+ * header, and check it against the ETag of the response, instead of sending a
+ * GET request for the size of the object once uploaded.
+ *
+ * @note S3 rejects a body that does not match its Content-MD5 header. The
+ * ETag of objects encrypted with SSE-KMS is not their MD5 digest, so set this
+ * to 0 for buckets using SSE-KMS.
+ */
+#define UPLOAD_INTEGRITY_CHECK_ENABLED    ( 1 )
+
+/**
+ * @brief Set to 1 to send each upload with an "Expect: 100-continue" header,
+ * and only send its body once S3 accepted its headers with a "100 Continue"
+ * interim response.
+ *
+ * @note A request that S3 rejects, for instance because its pre-signed URL
+ * expired, then fails without sending its body over the network. The upload
+ * also fails if S3 does not answer within UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS.
+ */
+#define UPLOAD_EXPECT_CONTINUE_ENABLED    ( 0 )
+
+/**
+ * @brief Time in milliseconds to wait for the interim response to the
+ * headers of an upload, when UPLOAD_EXPECT_CONTINUE_ENABLED is 1.
+ */
+#define UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS    ( 3000U )
+
+/**
+ * @brief Path of the file to upload in parts, or with a single PUT request.
+ */
+#define UPLOAD_FILE_PATH                  "s3_object.bin"
+
+/**
+ * @brief The size of each part of a multipart upload, except the last one.
+ *
+ * @note S3 requires parts of at least 5 MiB, except the last one.
+ */
+#define MULTIPART_UPLOAD_PART_SIZE        ( 8 * 1024 * 1024 )
+
+/**
+ * @brief The number of workers uploading parts in parallel, each over its own
+ * TLS connection.
+ *
+ * @note This must not exceed the number of connections of the connection pool,
+ * CONNECTION_POOL_SIZE.
+ */
+#define UPLOAD_WORKER_COUNT               ( 4 )
+
 #endif /* ifndef DEMO_CONFIG_H_ */
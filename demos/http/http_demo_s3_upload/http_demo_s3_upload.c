@@ -28,6 +28,11 @@
 
 /* POSIX includes. */
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* Include Demo Config as the first non-system header. */
 #include "demo_config.h"
@@ -35,15 +40,27 @@
 /* Common HTTP demo utilities. */
 #include "http_demo_utils.h"
 
+/* Pool of the connections to the HTTP server. */
+#include "http_connection_pool.h"
+
 /* HTTP API header. */
 #include "core_http_client.h"
 
 /* OpenSSL transport header. */
 #include "openssl_posix.h"
 
+/* OpenSSL digest and base64 functions. */
+#include <openssl/evp.h>
+
 /*Include backoff algorithm header for retry logic.*/
 #include "backoff_algorithm.h"
 
+/* Include clock header for the upload time and the retry delays. */
+#include "clock.h"
+
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /* Check that TLS port of the server is defined. */
 #ifndef HTTPS_PORT
     #error "Please define a HTTPS_PORT."
@@ -79,6 +96,79 @@
     #define DEMO_HTTP_UPLOAD_DATA    "Hello World!"
 #endif
 
+/* Check whether the file is uploaded in parts. */
+#ifndef MULTIPART_UPLOAD_ENABLED
+    #define MULTIPART_UPLOAD_ENABLED    ( 0 )
+#endif
+
+/* Check whether the single PUT request uploads a file. */
+#ifndef FILE_UPLOAD_ENABLED
+    #define FILE_UPLOAD_ENABLED    ( 0 )
+#endif
+
+/* Check whether uploads are verified by their Content-MD5 and ETag, instead of
+ * a GET request for the size of the object. */
+#ifndef UPLOAD_INTEGRITY_CHECK_ENABLED
+    #define UPLOAD_INTEGRITY_CHECK_ENABLED    ( 0 )
+#endif
+
+/* Check whether uploads send their body only once the server accepted their
+ * headers with a "100 Continue" interim response. */
+#ifndef UPLOAD_EXPECT_CONTINUE_ENABLED
+    #define UPLOAD_EXPECT_CONTINUE_ENABLED    ( 0 )
+#endif
+
+#if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+    /* Check that the time to wait for the interim response is defined. */
+    #ifndef UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS
+        #define UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS    ( 3000U )
+    #endif
+#endif
+
+#if ( FILE_UPLOAD_ENABLED == 1 )
+    /* Check that the path of the uploaded file is defined. */
+    #ifndef UPLOAD_FILE_PATH
+        #error "Please define a UPLOAD_FILE_PATH."
+    #endif
+
+    /* The file is uploaded either in parts or with a single request. */
+    #if ( MULTIPART_UPLOAD_ENABLED == 1 )
+        #error "FILE_UPLOAD_ENABLED and MULTIPART_UPLOAD_ENABLED cannot both be 1."
+    #endif
+#endif
+
+#if ( MULTIPART_UPLOAD_ENABLED == 1 )
+    /* Check that the pre-signed URLs of the parts are defined. */
+    #ifndef S3_PRESIGNED_UPLOAD_PART_URLS
+        #error "Please define S3_PRESIGNED_UPLOAD_PART_URLS."
+    #endif
+
+    /* Check that the pre-signed URL completing the upload is defined. */
+    #ifndef S3_PRESIGNED_COMPLETE_MULTIPART_URL
+        #error "Please define a S3_PRESIGNED_COMPLETE_MULTIPART_URL."
+    #endif
+
+    /* Check that the path of the uploaded file is defined. */
+    #ifndef UPLOAD_FILE_PATH
+        #error "Please define a UPLOAD_FILE_PATH."
+    #endif
+
+    /* Check that the size of the parts is defined. */
+    #ifndef MULTIPART_UPLOAD_PART_SIZE
+        #error "Please define a MULTIPART_UPLOAD_PART_SIZE."
+    #endif
+
+    /* Check that the number of workers is defined. */
+    #ifndef UPLOAD_WORKER_COUNT
+        #error "Please define a UPLOAD_WORKER_COUNT."
+    #endif
+
+    /* Each worker checks out its own connection from the pool. */
+    #if ( UPLOAD_WORKER_COUNT > CONNECTION_POOL_SIZE )
+        #error "UPLOAD_WORKER_COUNT must not exceed CONNECTION_POOL_SIZE."
+    #endif
+#endif /* if ( MULTIPART_UPLOAD_ENABLED == 1 ) */
+
 /**
  * @brief Length of the pre-signed PUT URL defined in demo_config.h.
  */
@@ -119,6 +209,110 @@
  */
 #define HTTP_STATUS_CODE_PARTIAL_CONTENT          206
 
+/**
+ * @brief The length of the HTTP POST method.
+ */
+#define HTTP_METHOD_POST_LENGTH                   ( sizeof( HTTP_METHOD_POST ) - 1 )
+
+/**
+ * @brief HTTP status code returned for a successful request.
+ */
+#define HTTP_STATUS_CODE_OK                       200
+
+/**
+ * @brief Field name of the HTTP ETag header to read from the response to the
+ * upload of a part.
+ */
+#define HTTP_ETAG_HEADER_FIELD                    "ETag"
+
+/**
+ * @brief Length of the HTTP ETag header field.
+ */
+#define HTTP_ETAG_HEADER_FIELD_LENGTH             ( sizeof( HTTP_ETAG_HEADER_FIELD ) - 1 )
+
+/**
+ * @brief Field name of the HTTP Content-MD5 header, with the base64 encoded
+ * MD5 digest of the body of an upload.
+ */
+#define HTTP_CONTENT_MD5_HEADER_FIELD             "Content-MD5"
+
+/**
+ * @brief Length of the HTTP Content-MD5 header field.
+ */
+#define HTTP_CONTENT_MD5_HEADER_FIELD_LENGTH      ( sizeof( HTTP_CONTENT_MD5_HEADER_FIELD ) - 1 )
+
+/**
+ * @brief Field name and value of the HTTP Expect header, asking the server
+ * to accept the headers of an upload before its body is sent.
+ */
+#define HTTP_EXPECT_HEADER_FIELD                  "Expect"
+#define HTTP_EXPECT_HEADER_FIELD_LENGTH           ( sizeof( HTTP_EXPECT_HEADER_FIELD ) - 1 )
+#define HTTP_EXPECT_CONTINUE_VALUE                "100-continue"
+#define HTTP_EXPECT_CONTINUE_VALUE_LENGTH         ( sizeof( HTTP_EXPECT_CONTINUE_VALUE ) - 1 )
+
+/**
+ * @brief HTTP status code of the interim response accepting the headers of a
+ * request sent with an "Expect: 100-continue" header.
+ */
+#define HTTP_STATUS_CODE_CONTINUE                 100
+
+/**
+ * @brief The start of a status line, up to the minor version, and the offset
+ * of the status code that follows the minor version and a space.
+ */
+#define HTTP_STATUS_LINE_PREFIX                   "HTTP/1."
+#define HTTP_STATUS_LINE_PREFIX_LENGTH            ( sizeof( HTTP_STATUS_LINE_PREFIX ) - 1 )
+#define HTTP_STATUS_LINE_CODE_OFFSET              ( HTTP_STATUS_LINE_PREFIX_LENGTH + 2U )
+
+/**
+ * @brief The size of the buffer receiving the response to the headers of an
+ * upload sent with an "Expect: 100-continue" header.
+ *
+ * It holds a "100 Continue" interim response, or the start of a final
+ * response, which is then handed to the HTTP Client library.
+ */
+#define EXPECT_CONTINUE_BUFFER_LENGTH             ( 256U )
+
+/**
+ * @brief The length of an MD5 digest.
+ */
+#define UPLOAD_MD5_DIGEST_LENGTH                  ( 16U )
+
+/**
+ * @brief The length of the base64 encoding of an MD5 digest.
+ */
+#define CONTENT_MD5_VALUE_LENGTH                  ( 24U )
+
+/**
+ * @brief The maximum length of the ETag of a part, which S3 sets to the
+ * quoted MD5 digest of the part.
+ */
+#define MULTIPART_UPLOAD_ETAG_MAX_LENGTH          ( 64 )
+
+/**
+ * @brief Parameters of the backoff between the attempts to upload a part.
+ */
+#define UPLOAD_PART_RETRY_MAX_ATTEMPTS            ( 3U )
+#define UPLOAD_PART_RETRY_MAX_BACKOFF_DELAY_MS    ( 5000U )
+#define UPLOAD_PART_RETRY_BACKOFF_BASE_MS         ( 500U )
+
+/**
+ * @brief The body of the request completing a multipart upload, which lists
+ * the part number and ETag of each part.
+ */
+#define COMPLETE_MULTIPART_BODY_START             "<CompleteMultipartUpload>"
+#define COMPLETE_MULTIPART_BODY_PART              "<Part><PartNumber>%u</PartNumber><ETag>%.*s</ETag></Part>"
+#define COMPLETE_MULTIPART_BODY_END               "</CompleteMultipartUpload>"
+
+/**
+ * @brief Element of the body of a successful response to the request
+ * completing a multipart upload.
+ *
+ * @note S3 may respond with a "200 OK" status code and an error in the body
+ * when the upload fails after it sent the response headers.
+ */
+#define COMPLETE_MULTIPART_RESULT_ELEMENT         "<CompleteMultipartUploadResult"
+
 /**
  * @brief The maximum number of times to run the loop in this demo.
  *
@@ -162,64 +356,339 @@ static HTTPRequestInfo_t requestInfo;
 static HTTPResponse_t response;
 
 /**
- * @brief The host address string extracted from the pre-signed URL.
- *
- * @note S3_PRESIGNED_PUT_URL_LENGTH is set as the array length here as the
- * length of the host name string cannot exceed this value.
+ * @brief The pre-signed PUT URL, parsed by the first call to
+ * #initializeServerInfo.
  */
-static char serverHost[ S3_PRESIGNED_PUT_URL_LENGTH ];
+static ParsedUrl_t presignedPutUrl;
 
 /**
- * @brief The length of the host address found in the pre-signed URL.
+ * @brief The pre-signed GET URL, parsed by the first call to
+ * #initializeServerInfo.
  */
-static size_t serverHostLength;
+static ParsedUrl_t presignedGetUrl;
 
 /**
- * @brief The location of the path within the pre-signed URL.
+ * @brief The host address string extracted from the pre-signed PUT URL.
  */
-static const char * pPath;
+static char serverHost[ URL_MAX_HOST_LENGTH + 1U ];
 
-/*-----------------------------------------------------------*/
+/**
+ * @brief Information about the server to send the HTTP requests.
+ */
+static ServerInfo_t serverInfo;
 
-/* Each compilation unit must define the NetworkContext struct. */
-struct NetworkContext
+/**
+ * @brief Credentials to establish the TLS connections to the server.
+ */
+static OpensslCredentials_t opensslCredentials;
+
+/**
+ * @brief A file uploaded from its read-only mapping.
+ */
+typedef struct UploadFile
 {
-    OpensslParams_t * pParams;
-};
+    int fileDescriptor;    /**< @brief The file, or -1 if it is not open. */
+    const uint8_t * pData; /**< @brief The mapping of the file, or NULL. */
+    size_t size;           /**< @brief The size of the file. */
+} UploadFile_t;
+
+/**
+ * @brief The file uploaded by the current demo iteration.
+ *
+ * Request bodies within its mapping are sent from the file descriptor by
+ * #sendRequestData, so the mapping only gives them an address.
+ */
+static UploadFile_t uploadFile = { -1, NULL, 0U };
+
+#if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+
+/**
+ * @brief Definition of the network context of the connections of the pool,
+ * for the socket waited on for the interim response.
+ */
+    struct NetworkContext
+    {
+        OpensslParams_t * pParams;
+    };
+
+/**
+ * @brief The progress of an upload sent with an "Expect: 100-continue"
+ * header.
+ */
+    typedef enum ExpectContinueState
+    {
+        EXPECT_CONTINUE_IDLE = 0, /**< @brief The request does not wait for an interim response. */
+        EXPECT_CONTINUE_WAITING,  /**< @brief The body is held back until the server answers the headers. */
+        EXPECT_CONTINUE_ACCEPTED, /**< @brief The server accepted the headers, so the body is sent. */
+        EXPECT_CONTINUE_REJECTED, /**< @brief The server sent its final response, so the body is not sent. */
+        EXPECT_CONTINUE_FAILED    /**< @brief The server did not answer in time, or with an invalid response. */
+    } ExpectContinueState_t;
+
+/**
+ * @brief An upload sent with an "Expect: 100-continue" header.
+ */
+    typedef struct ExpectContinue
+    {
+        ExpectContinueState_t state;                       /**< @brief The progress of the upload. */
+        const uint8_t * pBody;                             /**< @brief The body of the upload. */
+        size_t bodyLength;                                 /**< @brief The length of #ExpectContinue_t.pBody. */
+        uint8_t response[ EXPECT_CONTINUE_BUFFER_LENGTH ]; /**< @brief Bytes received while waiting for the interim response. */
+        size_t responseLength;                             /**< @brief Bytes of #ExpectContinue_t.response that belong to the final response. */
+        size_t responseOffset;                             /**< @brief Bytes of #ExpectContinue_t.response already received by the HTTP Client library. */
+    } ExpectContinue_t;
+
+/**
+ * @brief The upload of the calling thread, as each worker of a multipart
+ * upload sends its own requests.
+ */
+    static __thread ExpectContinue_t expectContinue;
+#endif /* if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 ) */
+
+#if ( MULTIPART_UPLOAD_ENABLED == 1 )
+
+/**
+ * @brief The pre-signed URLs of the parts of the multipart upload.
+ */
+    static const char * const partUrls[] = S3_PRESIGNED_UPLOAD_PART_URLS;
+
+/**
+ * @brief The maximum number of parts of the file, one for each pre-signed URL.
+ */
+    #define MULTIPART_UPLOAD_MAX_PART_COUNT    ( sizeof( partUrls ) / sizeof( partUrls[ 0 ] ) )
+
+/**
+ * @brief A part of the file uploaded by the multipart upload.
+ */
+    typedef struct UploadPart
+    {
+        const char * pPath;                                  /**< @brief The Request-URI within the pre-signed URL of the part. */
+        char etag[ MULTIPART_UPLOAD_ETAG_MAX_LENGTH ];       /**< @brief The ETag returned for the part. */
+        size_t etagLength;                                   /**< @brief The length of #UploadPart_t.etag. */
+    } UploadPart_t;
+
+/**
+ * @brief A worker uploading parts of the file over its own connection.
+ */
+    typedef struct UploadWorker
+    {
+        pthread_t thread;                        /**< @brief The thread of the worker. */
+        bool threadStarted;                      /**< @brief Whether #UploadWorker_t.thread was created. */
+        uint8_t buffer[ USER_BUFFER_LENGTH ];    /**< @brief Buffer for the request and response headers. */
+        uint32_t partCount;                      /**< @brief Parts of the file uploaded by the worker. */
+    } UploadWorker_t;
+
+/**
+ * @brief The multipart upload shared by all workers.
+ *
+ * The parts of the file form a lock-free work queue: each worker claims the
+ * next part by atomically incrementing #UploadJob_t.nextPart.
+ */
+    typedef struct UploadJob
+    {
+        const uint8_t * pFile; /**< @brief The file, mapped read-only. */
+        uint64_t fileSize;     /**< @brief The size of the file. */
+        uint32_t partCount;    /**< @brief The number of parts of #MULTIPART_UPLOAD_PART_SIZE bytes in the file. */
+        uint32_t nextPart;     /**< @brief Index of the next part to upload. Updated atomically. */
+        bool failed;           /**< @brief Set atomically when a worker fails, to stop the others. */
+    } UploadJob_t;
+
+/**
+ * @brief The parts of the file.
+ */
+    static UploadPart_t uploadParts[ MULTIPART_UPLOAD_MAX_PART_COUNT ];
+
+/**
+ * @brief The multipart upload of the current demo iteration.
+ */
+    static UploadJob_t uploadJob;
+
+/**
+ * @brief The workers uploading the parts.
+ */
+    static UploadWorker_t uploadWorkers[ UPLOAD_WORKER_COUNT ];
+
+/**
+ * @brief The body of the request completing the multipart upload.
+ */
+    static char completeBody[ sizeof( COMPLETE_MULTIPART_BODY_START ) +
+                              ( MULTIPART_UPLOAD_MAX_PART_COUNT *
+                                ( sizeof( COMPLETE_MULTIPART_BODY_PART ) + sizeof( "10000" ) + MULTIPART_UPLOAD_ETAG_MAX_LENGTH ) ) +
+                              sizeof( COMPLETE_MULTIPART_BODY_END ) ];
+#endif /* if ( MULTIPART_UPLOAD_ENABLED == 1 ) */
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Connect to HTTP server with reconnection retries.
+ * @brief Initialize the server information and credentials of the
+ * connections to the host of the pre-signed URL.
+ *
+ * The pre-signed URLs are parsed on the first call only.
+ *
+ * @return EXIT_FAILURE on failure; EXIT_SUCCESS on success.
+ */
+static int32_t initializeServerInfo( void );
+
+/**
+ * @brief Send an HTTP request over a connection checked out from the
+ * connection pool, and receive its response.
+ *
+ * The connection is kept open for the next request unless the request fails
+ * or the server closes the connection, in which case the next request
+ * establishes a new connection.
+ *
+ * @param[in] pRequestHeaders The headers of the request.
+ * @param[in] pRequestBody The body of the request. May be NULL.
+ * @param[in] requestBodyLen The length of the body of the request.
+ * @param[out] pResponse The response to the request.
+ *
+ * @return The status returned by #HTTPClient_Send, or #HTTPNetworkError if no
+ * connection could be established.
+ */
+static HTTPStatus_t sendHttpRequest( HTTPRequestHeaders_t * pRequestHeaders,
+                                     const uint8_t * pRequestBody,
+                                     size_t requestBodyLen,
+                                     HTTPResponse_t * pResponse );
+
+/**
+ * @brief The transport send function of the requests, sending the data within
+ * the mapping of #uploadFile with #Openssl_SendFile, and other data with
+ * #Openssl_Send.
+ *
+ * With kernel TLS, the file is encrypted and sent by the kernel without being
+ * copied to user space. Otherwise, it is read in chunks and sent with
+ * SSL_write. Either way, the memory used does not depend on the size of the
+ * file.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] pBuffer The data to send.
+ * @param[in] bytesToSend The length of @p pBuffer.
+ *
+ * @return The number of bytes sent, or -1 on an error.
+ */
+static int32_t sendRequestData( NetworkContext_t * pNetworkContext,
+                                const void * pBuffer,
+                                size_t bytesToSend );
+
+#if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+
+/**
+ * @brief Add an "Expect: 100-continue" header to an upload request, so that
+ * its body is only sent once the server accepted its headers.
+ *
+ * The upload is held back by the transport of the next request that the
+ * calling thread sends with #sendHttpRequest.
+ *
+ * @param[in,out] pRequestHeaders The headers of the request.
+ * @param[in] pBody The body of the request.
+ * @param[in] bodyLength The length of @p pBody.
+ *
+ * @return The status returned by #HTTPClient_AddHeader.
+ */
+    static HTTPStatus_t addExpectContinueHeader( HTTPRequestHeaders_t * pRequestHeaders,
+                                                 const uint8_t * pBody,
+                                                 size_t bodyLength );
+
+/**
+ * @brief Classify the response to the headers of an upload from the bytes
+ * received into #ExpectContinue_t.response so far.
+ *
+ * @param[in] length The number of bytes received, holding at least the status
+ * code.
+ *
+ * @return #EXPECT_CONTINUE_WAITING if the rest of a "100 Continue" interim
+ * response is still to be received, #EXPECT_CONTINUE_ACCEPTED once it is,
+ * #EXPECT_CONTINUE_REJECTED on a final response, or #EXPECT_CONTINUE_FAILED on
+ * an invalid response.
+ */
+    static ExpectContinueState_t classifyResponse( size_t length );
+
+/**
+ * @brief Receive the response of the server to the headers of an upload, for
+ * up to #UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS milliseconds.
+ *
+ * A "100 Continue" interim response is consumed. A final response is kept in
+ * #ExpectContinue_t.response from its status line on, for #recvResponseData
+ * to hand it to the HTTP Client library.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return #EXPECT_CONTINUE_ACCEPTED, #EXPECT_CONTINUE_REJECTED, or
+ * #EXPECT_CONTINUE_FAILED if the server did not answer in time or answered
+ * with an invalid response.
+ */
+    static ExpectContinueState_t waitForContinue( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief The transport send function of the requests, holding back the body
+ * of an upload sent with an "Expect: 100-continue" header until the server
+ * answers its headers, and sending all other data with #sendRequestData.
+ *
+ * A body rejected by the final response of the server is reported as sent
+ * without being sent, for the HTTP Client library to go on and receive that
+ * response.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] pBuffer The data to send.
+ * @param[in] bytesToSend The length of @p pBuffer.
+ *
+ * @return The number of bytes sent, or -1 on an error or if the server did
+ * not answer the headers in time.
+ */
+    static int32_t sendExpectingContinue( NetworkContext_t * pNetworkContext,
+                                          const void * pBuffer,
+                                          size_t bytesToSend );
+
+/**
+ * @brief The transport receive function of the requests, returning first the
+ * bytes of the final response received by #waitForContinue.
  *
- * @param[out] pNetworkContext The output parameter to return the created
- * network context.
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[out] pBuffer The buffer to receive the data into.
+ * @param[in] bytesToRecv The length of @p pBuffer.
+ *
+ * @return The number of bytes received, 0 if the receive can be retried, or
+ * a negative value on an error.
+ */
+    static int32_t recvResponseData( NetworkContext_t * pNetworkContext,
+                                     void * pBuffer,
+                                     size_t bytesToRecv );
+#endif /* if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 ) */
+
+#if ( FILE_UPLOAD_ENABLED == 1 ) || ( MULTIPART_UPLOAD_ENABLED == 1 )
+
+/**
+ * @brief Open and map the file at #UPLOAD_FILE_PATH into #uploadFile.
  *
- * @return EXIT_FAILURE on failure; EXIT_SUCCESS on successful connection.
+ * @return false if the file could not be mapped or is empty; true on success.
+ */
+    static bool openUploadFile( void );
+
+/**
+ * @brief Unmap and close #uploadFile.
  */
-static int32_t connectToServer( NetworkContext_t * pNetworkContext );
+    static void closeUploadFile( void );
+#endif
+
+#if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 0 )
 
 /**
  * @brief Retrieve and verify the size of the S3 object that is specified in
  * pPath.
  *
- * @param[in] pTransportInterface The transport interface for making network
- * calls.
  * @param[in] pPath The Request-URI to the objects of interest. This string must
  * be null-terminated.
+ * @param[in] expectedSize The size of the data uploaded.
  *
  * @return The status of the file size acquisition and verification using a GET
  * request to the server: true on success, false on failure.
  */
-static bool verifyS3ObjectFileSize( const TransportInterface_t * pTransportInterface,
-                                    const char * pPath );
+    static bool verifyS3ObjectFileSize( const char * pPath,
+                                        size_t expectedSize );
 
 /**
  * @brief Retrieve the size of the S3 object that is specified in pPath.
  *
  * @param[out] pFileSize The size of the S3 object.
- * @param[in] pTransportInterface The transport interface for making network
- * calls.
  * @param[in] pHost The server host address. This string must be
  * null-terminated.
  * @param[in] hostLen The length of the server host address.
@@ -229,82 +698,194 @@ static bool verifyS3ObjectFileSize( const TransportInterface_t * pTransportInter
  * @return The status of the file size acquisition using a GET request to the
  * server: true on success, false on failure.
  */
-static bool getS3ObjectFileSize( size_t * pFileSize,
-                                 const TransportInterface_t * pTransportInterface,
-                                 const char * pHost,
-                                 size_t hostLen,
-                                 const char * pPath );
+    static bool getS3ObjectFileSize( size_t * pFileSize,
+                                     const char * pHost,
+                                     size_t hostLen,
+                                     const char * pPath );
+#endif
 
 /**
  * @brief Send an HTTP PUT request based on a specified path to upload a file,
  * then print the response received from the server.
  *
- * @param[in] pTransportInterface The transport interface for making network
- * calls.
  * @param[in] pPath The Request-URI to the objects of interest. This string must
  * be null-terminated.
+ * @param[in] pBody The data to upload.
+ * @param[in] bodyLength The length of @p pBody.
  *
  * @return The status of the file upload using a PUT request to the server: true
  * on success, false on failure.
  */
-static bool uploadS3ObjectFile( const TransportInterface_t * pTransportInterface,
-                                const char * pPath );
+static bool uploadS3ObjectFile( const char * pPath,
+                                const uint8_t * pBody,
+                                size_t bodyLength );
 
-/*-----------------------------------------------------------*/
+#if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
 
-static int32_t connectToServer( NetworkContext_t * pNetworkContext )
-{
-    int32_t returnStatus = EXIT_FAILURE;
-    HTTPStatus_t httpStatus = HTTPSuccess;
+/**
+ * @brief Add a Content-MD5 header with the MD5 digest of the body to a
+ * request.
+ *
+ * S3 rejects the upload with a "400 Bad Request" status code if the body it
+ * receives does not match the digest.
+ *
+ * @param[in,out] pRequestHeaders The headers of the request.
+ * @param[in] pBody The body of the request.
+ * @param[in] bodyLength The length of @p pBody.
+ * @param[out] pDigest The MD5 digest of the body, of
+ * #UPLOAD_MD5_DIGEST_LENGTH bytes.
+ *
+ * @return The status returned by #HTTPClient_AddHeader, or
+ * #HTTPInvalidParameter if the digest could not be computed.
+ */
+    static HTTPStatus_t addContentMd5Header( HTTPRequestHeaders_t * pRequestHeaders,
+                                             const uint8_t * pBody,
+                                             size_t bodyLength,
+                                             uint8_t * pDigest );
+
+/**
+ * @brief Check that the ETag returned for an upload is the MD5 digest of the
+ * body sent, as S3 sets it for objects and parts not encrypted with SSE-KMS.
+ *
+ * @param[in] pEtag The value of the ETag header.
+ * @param[in] etagLength The length of @p pEtag.
+ * @param[in] pDigest The MD5 digest of the body sent.
+ *
+ * @return true if the ETag is the quoted hexadecimal digest; false otherwise.
+ */
+    static bool etagMatchesDigest( const char * pEtag,
+                                   size_t etagLength,
+                                   const uint8_t * pDigest );
+#endif /* if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 ) */
 
-    /* The location of the host address within the pre-signed URL. */
-    const char * pAddress = NULL;
+#if ( FILE_UPLOAD_ENABLED == 1 )
 
-    /* Status returned by OpenSSL transport implementation. */
-    OpensslStatus_t opensslStatus;
-    /* Credentials to establish the TLS connection. */
-    OpensslCredentials_t opensslCredentials = { 0 };
-    /* Information about the server to send the HTTP requests. */
-    ServerInfo_t serverInfo = { 0 };
+/**
+ * @brief Upload the file at #UPLOAD_FILE_PATH with a single PUT request.
+ *
+ * The headers of the request are sent from the user buffer, and the body is
+ * sent from the file as it is read, so files of any size up to the 5 GB limit
+ * of S3 are uploaded with the same memory.
+ *
+ * @param[in] pPath The Request-URI to the objects of interest. This string must
+ * be null-terminated.
+ * @param[out] pFileSize The size of the file uploaded.
+ *
+ * @return false on failure; true on success.
+ */
+    static bool uploadS3ObjectFileFromFile( const char * pPath,
+                                            size_t * pFileSize );
+#endif
 
-    /* Retrieve the address location and length from S3_PRESIGNED_PUT_URL. */
-    httpStatus = getUrlAddress( S3_PRESIGNED_PUT_URL,
-                                S3_PRESIGNED_PUT_URL_LENGTH,
-                                &pAddress,
-                                &serverHostLength );
+#if ( MULTIPART_UPLOAD_ENABLED == 1 )
 
-    returnStatus = ( httpStatus == HTTPSuccess ) ? EXIT_SUCCESS : EXIT_FAILURE;
+/**
+ * @brief Upload a part of the file with a PUT request over a connection of the
+ * pool, and store the ETag returned for it.
+ *
+ * @param[in] pWorker The worker.
+ * @param[in] partIndex The index of the part of #MULTIPART_UPLOAD_PART_SIZE
+ * bytes.
+ *
+ * @return false on failure; true on success.
+ */
+    static bool uploadPart( UploadWorker_t * pWorker,
+                            uint32_t partIndex );
 
-    if( returnStatus == EXIT_SUCCESS )
+/**
+ * @brief Upload a part of the file, retrying with exponential backoff up to
+ * #UPLOAD_PART_RETRY_MAX_ATTEMPTS times.
+ *
+ * @param[in] pWorker The worker.
+ * @param[in] partIndex The index of the part.
+ *
+ * @return false on failure; true on success.
+ */
+    static bool uploadPartWithRetries( UploadWorker_t * pWorker,
+                                       uint32_t partIndex );
+
+/**
+ * @brief The thread of a worker, uploading parts until all parts are claimed
+ * or a worker fails.
+ *
+ * @param[in] pArgument The #UploadWorker_t of the thread.
+ *
+ * @return NULL.
+ */
+    static void * uploadWorkerTask( void * pArgument );
+
+/**
+ * @brief Complete the multipart upload with a POST request listing the ETags
+ * of all parts.
+ *
+ * @return false on failure; true on success.
+ */
+    static bool completeMultipartUpload( void );
+
+/**
+ * @brief Upload the file at #UPLOAD_FILE_PATH with the S3 multipart upload API,
+ * with #UPLOAD_WORKER_COUNT workers.
+ *
+ * The file is mapped into memory, so that each part is sent from the file by
+ * the transport rather than copied into a buffer.
+ *
+ * @param[out] pFileSize The size of the file uploaded.
+ *
+ * @return false on failure; true on success.
+ */
+    static bool uploadS3ObjectFileMultipart( size_t * pFileSize );
+#endif /* if ( MULTIPART_UPLOAD_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static int32_t initializeServerInfo( void )
+{
+    int32_t returnStatus = EXIT_SUCCESS;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+
+    /* The components of the parsed URLs are offsets into the URL strings, so
+     * the URLs are only parsed by the first demo iteration. */
+    if( presignedPutUrl.pUrl == NULL )
     {
+        httpStatus = parseUrl( S3_PRESIGNED_PUT_URL,
+                               S3_PRESIGNED_PUT_URL_LENGTH,
+                               &presignedPutUrl );
+
+        if( httpStatus == HTTPSuccess )
+        {
+            httpStatus = parseUrl( S3_PRESIGNED_GET_URL,
+                                   S3_PRESIGNED_GET_URL_LENGTH,
+                                   &presignedGetUrl );
+        }
+
         /* serverHost should consist only of the host address located in
          * S3_PRESIGNED_PUT_URL. */
-        memcpy( serverHost, pAddress, serverHostLength );
-        serverHost[ serverHostLength ] = '\0';
+        if( ( httpStatus != HTTPSuccess ) ||
+            ( copyUrlHost( &presignedPutUrl, serverHost, sizeof( serverHost ) ) == false ) )
+        {
+            presignedPutUrl.pUrl = NULL;
+            returnStatus = EXIT_FAILURE;
+        }
+    }
 
+    if( returnStatus == EXIT_SUCCESS )
+    {
         /* Initialize TLS credentials. */
+        ( void ) memset( &opensslCredentials, 0, sizeof( opensslCredentials ) );
         opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
         opensslCredentials.sniHostName = serverHost;
+        /* Let the kernel encrypt the upload when it supports TLS offload. */
+        opensslCredentials.enableKtls = true;
+        /* Upload with the AEAD that is fastest on this CPU. */
+        opensslCredentials.cipherPolicy = OPENSSL_CIPHERS_AUTO;
 
-        /* Initialize server information. */
+        /* Initialize server information. This example connects to the HTTP
+         * server as specified in SERVER_HOST and HTTPS_PORT in
+         * demo_config.h. */
+        ( void ) memset( &serverInfo, 0, sizeof( serverInfo ) );
         serverInfo.pHostName = serverHost;
-        serverInfo.hostNameLength = serverHostLength;
+        serverInfo.hostNameLength = presignedPutUrl.host.length;
         serverInfo.port = HTTPS_PORT;
-
-        /* Establish a TLS session with the HTTP server. This example connects
-         * to the HTTP server as specified in SERVER_HOST and HTTPS_PORT in
-         * demo_config.h. */
-        LogInfo( ( "Establishing a TLS session with %s:%d.",
-                   serverHost,
-                   HTTPS_PORT ) );
-
-        opensslStatus = Openssl_Connect( pNetworkContext,
-                                         &serverInfo,
-                                         &opensslCredentials,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS );
-
-        returnStatus = ( opensslStatus == OPENSSL_SUCCESS ) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
     return returnStatus;
@@ -312,220 +893,629 @@ static int32_t connectToServer( NetworkContext_t * pNetworkContext )
 
 /*-----------------------------------------------------------*/
 
-static bool verifyS3ObjectFileSize( const TransportInterface_t * pTransportInterface,
-                                    const char * pPath )
+static HTTPStatus_t sendHttpRequest( HTTPRequestHeaders_t * pRequestHeaders,
+                                     const uint8_t * pRequestBody,
+                                     size_t requestBodyLen,
+                                     HTTPResponse_t * pResponse )
 {
-    bool returnStatus = false;
-    /* The size of the file uploaded to S3. */
-    size_t fileSize = 0;
+    HTTPStatus_t httpStatus = HTTPNetworkError;
+    HTTPStatus_t checkinStatus = HTTPNetworkError;
+    ConnectionPoolStatus_t poolStatus = CONNECTION_POOL_SUCCESS;
+    /* The transport layer interface used by the HTTP Client library. */
+    TransportInterface_t transportInterface;
 
-    /* Retrieve the file size. */
-    returnStatus = getS3ObjectFileSize( &fileSize,
-                                        pTransportInterface,
-                                        serverHost,
-                                        serverHostLength,
-                                        pPath );
+    /* Reuse the connection of the previous request if the server kept it
+     * open, or else establish a new connection with retries and backoff. */
+    poolStatus = ConnectionPool_Checkout( &serverInfo,
+                                          &opensslCredentials,
+                                          TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                          &transportInterface );
 
-    if( returnStatus == true )
+    if( poolStatus == CONNECTION_POOL_SUCCESS )
     {
-        if( fileSize != DEMO_HTTP_UPLOAD_DATA_LENGTH )
-        {
-            LogError( ( "Failed to upload the data to S3. The file size found is %d, but it should be %d.",
-                        ( int32_t ) fileSize,
-                        ( int32_t ) DEMO_HTTP_UPLOAD_DATA_LENGTH ) );
-        }
-        else
-        {
-            LogInfo( ( "Successfuly verified that the size of the file found on S3 matches the file size uploaded "
-                       "(Uploaded: %d bytes, Found: %d bytes).",
-                       ( int32_t ) DEMO_HTTP_UPLOAD_DATA_LENGTH,
-                       ( int32_t ) fileSize ) );
-        }
+        /* The pool compares the network context only, so the connection is
+         * checked in with the send function replaced. */
+        transportInterface.send = sendRequestData;
+
+        #if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+            transportInterface.send = sendExpectingContinue;
+            transportInterface.recv = recvResponseData;
+        #endif
+
+        httpStatus = HTTPClient_Send( &transportInterface,
+                                      pRequestHeaders,
+                                      pRequestBody,
+                                      requestBodyLen,
+                                      pResponse,
+                                      0 );
+        checkinStatus = httpStatus;
+
+        #if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+            /* The server still reads the body that was not sent as the next
+             * request, so the connection is closed. */
+            if( expectContinue.state == EXPECT_CONTINUE_REJECTED )
+            {
+                checkinStatus = HTTPNetworkError;
+            }
+        #endif
+
+        ConnectionPool_Checkin( &transportInterface, checkinStatus, pResponse );
+    }
+    else
+    {
+        LogError( ( "Failed to connect to HTTP server %s.",
+                    serverHost ) );
     }
 
-    return returnStatus;
+    #if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+        /* Bytes of a final response left unread are not the response to the
+         * next request. */
+        expectContinue.state = EXPECT_CONTINUE_IDLE;
+        expectContinue.responseLength = 0U;
+        expectContinue.responseOffset = 0U;
+    #endif
+
+    return httpStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-static bool getS3ObjectFileSize( size_t * pFileSize,
-                                 const TransportInterface_t * pTransportInterface,
-                                 const char * pHost,
-                                 size_t hostLen,
-                                 const char * pPath )
+static int32_t sendRequestData( NetworkContext_t * pNetworkContext,
+                                const void * pBuffer,
+                                size_t bytesToSend )
 {
-    bool returnStatus = true;
-    HTTPStatus_t httpStatus = HTTPSuccess;
-    HTTPRequestHeaders_t requestHeaders;
-    HTTPRequestInfo_t requestInfo;
-    HTTPResponse_t response;
-    uint8_t userBuffer[ USER_BUFFER_LENGTH ];
+    int32_t bytesSent = 0;
+    uintptr_t address = ( uintptr_t ) pBuffer;
+    uintptr_t fileStart = ( uintptr_t ) uploadFile.pData;
+    size_t sendLength = bytesToSend;
 
-    /* The location of the file size in contentRangeValStr. */
-    char * pFileSizeStr = NULL;
+    if( ( uploadFile.pData != NULL ) && ( address >= fileStart ) &&
+        ( ( address - fileStart ) < uploadFile.size ) )
+    {
+        /* The HTTP Client library sends the rest of the body in the next
+         * calls. */
+        if( sendLength > ( size_t ) INT32_MAX )
+        {
+            sendLength = ( size_t ) INT32_MAX;
+        }
 
-    /* String to store the Content-Range header value. */
-    char * contentRangeValStr = NULL;
-    size_t contentRangeValStrLength = 0;
+        bytesSent = Openssl_SendFile( pNetworkContext,
+                                      uploadFile.fileDescriptor,
+                                      ( off_t ) ( address - fileStart ),
+                                      sendLength );
+    }
+    else
+    {
+        bytesSent = Openssl_Send( pNetworkContext, pBuffer, bytesToSend );
+    }
 
-    assert( pHost != NULL );
-    assert( pPath != NULL );
+    return bytesSent;
+}
 
-    /* Initialize all HTTP Client library API structs to 0. */
-    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
-    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
-    ( void ) memset( &response, 0, sizeof( response ) );
+/*-----------------------------------------------------------*/
 
-    /* Initialize the request object. */
-    requestInfo.pHost = pHost;
-    requestInfo.hostLen = hostLen;
-    requestInfo.pMethod = HTTP_METHOD_GET;
-    requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
-    requestInfo.pPath = pPath;
-    requestInfo.pathLen = strlen( pPath );
+#if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
 
-    /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
-     * can be sent over the same established TCP connection. This is done in
-     * order to download the file in parts. */
-    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+    static HTTPStatus_t addExpectContinueHeader( HTTPRequestHeaders_t * pRequestHeaders,
+                                                 const uint8_t * pBody,
+                                                 size_t bodyLength )
+    {
+        HTTPStatus_t httpStatus = HTTPSuccess;
 
-    /* Set the buffer used for storing request headers. */
-    requestHeaders.pBuffer = userBuffer;
-    requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+        httpStatus = HTTPClient_AddHeader( pRequestHeaders,
+                                           HTTP_EXPECT_HEADER_FIELD,
+                                           HTTP_EXPECT_HEADER_FIELD_LENGTH,
+                                           HTTP_EXPECT_CONTINUE_VALUE,
+                                           HTTP_EXPECT_CONTINUE_VALUE_LENGTH );
 
-    /* Initialize the response object. The same buffer used for storing request
-     * headers is reused here. */
-    response.pBuffer = userBuffer;
-    response.bufferLen = USER_BUFFER_LENGTH;
+        if( httpStatus == HTTPSuccess )
+        {
+            expectContinue.state = EXPECT_CONTINUE_WAITING;
+            expectContinue.pBody = pBody;
+            expectContinue.bodyLength = bodyLength;
+            expectContinue.responseLength = 0U;
+            expectContinue.responseOffset = 0U;
+        }
 
-    LogInfo( ( "Getting file object size from host..." ) );
+        return httpStatus;
+    }
 
-    httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
-                                                      &requestInfo );
+/*-----------------------------------------------------------*/
 
-    if( httpStatus != HTTPSuccess )
+    static ExpectContinueState_t classifyResponse( size_t length )
     {
-        LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
-                    HTTPClient_strerror( httpStatus ) ) );
-        returnStatus = false;
+        ExpectContinueState_t state = EXPECT_CONTINUE_WAITING;
+        const uint8_t * pResponse = expectContinue.response;
+        unsigned int statusCode = 0U;
+        size_t interimLength = 0U;
+        size_t i = 0U;
+
+        for( i = HTTP_STATUS_LINE_CODE_OFFSET; ( i < ( HTTP_STATUS_LINE_CODE_OFFSET + 3U ) ) && ( state == EXPECT_CONTINUE_WAITING ); i++ )
+        {
+            if( ( pResponse[ i ] >= ( uint8_t ) '0' ) && ( pResponse[ i ] <= ( uint8_t ) '9' ) )
+            {
+                statusCode = ( statusCode * 10U ) + ( unsigned int ) ( pResponse[ i ] - ( uint8_t ) '0' );
+            }
+            else
+            {
+                state = EXPECT_CONTINUE_FAILED;
+            }
+        }
+
+        if( ( state == EXPECT_CONTINUE_FAILED ) ||
+            ( memcmp( pResponse, HTTP_STATUS_LINE_PREFIX, HTTP_STATUS_LINE_PREFIX_LENGTH ) != 0 ) )
+        {
+            LogError( ( "Received an invalid response to the headers of the upload." ) );
+            state = EXPECT_CONTINUE_FAILED;
+        }
+        else if( statusCode >= HTTP_STATUS_CODE_OK )
+        {
+            LogWarn( ( "The server answered the headers of the upload with a final response, "
+                       "so its body is not sent (Status Code: %u).",
+                       statusCode ) );
+            expectContinue.responseLength = length;
+            state = EXPECT_CONTINUE_REJECTED;
+        }
+        else if( statusCode != HTTP_STATUS_CODE_CONTINUE )
+        {
+            LogError( ( "Received an unexpected interim response to the headers of the upload "
+                        "(Status Code: %u).",
+                        statusCode ) );
+            state = EXPECT_CONTINUE_FAILED;
+        }
+        else
+        {
+            /* The interim response ends with an empty line. */
+            for( i = HTTP_STATUS_LINE_CODE_OFFSET; ( ( i + 4U ) <= length ) && ( interimLength == 0U ); i++ )
+            {
+                if( memcmp( &pResponse[ i ], "\r\n\r\n", 4U ) == 0 )
+                {
+                    interimLength = i + 4U;
+                }
+            }
+
+            if( interimLength > 0U )
+            {
+                /* Any byte after it is the start of the final response. */
+                expectContinue.responseLength = length - interimLength;
+                ( void ) memmove( expectContinue.response, &pResponse[ interimLength ], expectContinue.responseLength );
+                state = EXPECT_CONTINUE_ACCEPTED;
+            }
+            else if( length == sizeof( expectContinue.response ) )
+            {
+                LogError( ( "The interim response to the headers of the upload is longer than %u bytes.",
+                            ( unsigned int ) sizeof( expectContinue.response ) ) );
+                state = EXPECT_CONTINUE_FAILED;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+
+        return state;
     }
 
-    if( returnStatus == true )
-    {
-        /* Add the header to get bytes=0-0. S3 will respond with a Content-Range
-         * header that contains the size of the file in it. This header will
-         * look like: "Content-Range: bytes 0-0/FILESIZE". The body will have a
-         * single byte that we are ignoring. */
-        httpStatus = HTTPClient_AddRangeHeader( &requestHeaders, 0, 0 );
+/*-----------------------------------------------------------*/
 
-        if( httpStatus != HTTPSuccess )
+    static ExpectContinueState_t waitForContinue( NetworkContext_t * pNetworkContext )
+    {
+        ExpectContinueState_t state = EXPECT_CONTINUE_WAITING;
+        OpensslBufferUsage_t bufferUsage;
+        struct pollfd fileDescriptor;
+        uint32_t startTimeMs = Clock_GetTimeMs();
+        uint32_t elapsedMs = 0U;
+        int32_t bytesReceived = 0;
+        size_t length = 0U;
+
+        fileDescriptor.fd = pNetworkContext->pParams->socketDescriptor;
+        fileDescriptor.events = POLLIN;
+
+        while( state == EXPECT_CONTINUE_WAITING )
         {
-            LogError( ( "Failed to add Range header to request headers: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
-            returnStatus = false;
+            elapsedMs = Clock_GetTimeMs() - startTimeMs;
+            fileDescriptor.revents = 0;
+
+            /* A receive blocks for up to the timeout of the transport, so it
+             * is only made once data is buffered by OpenSSL or readable on
+             * the socket. */
+            if( Openssl_GetBufferUsage( pNetworkContext, &bufferUsage ) != OPENSSL_SUCCESS )
+            {
+                state = EXPECT_CONTINUE_FAILED;
+            }
+            else if( ( bufferUsage.pendingBytes == 0U ) &&
+                     ( ( elapsedMs >= UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS ) ||
+                       ( poll( &fileDescriptor, 1, ( int ) ( UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS - elapsedMs ) ) <= 0 ) ) )
+            {
+                LogError( ( "The server did not answer the headers of the upload within %u ms.",
+                            ( unsigned int ) UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS ) );
+                state = EXPECT_CONTINUE_FAILED;
+            }
+            else
+            {
+                bytesReceived = Openssl_Recv( pNetworkContext,
+                                              &expectContinue.response[ length ],
+                                              sizeof( expectContinue.response ) - length );
+
+                if( bytesReceived < 0 )
+                {
+                    LogError( ( "Failed to receive the response to the headers of the upload." ) );
+                    state = EXPECT_CONTINUE_FAILED;
+                }
+                else
+                {
+                    length += ( size_t ) bytesReceived;
+                }
+            }
+
+            /* The status code is read once the status line holds it. */
+            if( ( state == EXPECT_CONTINUE_WAITING ) && ( length >= ( HTTP_STATUS_LINE_CODE_OFFSET + 3U ) ) )
+            {
+                state = classifyResponse( length );
+            }
         }
+
+        return state;
     }
 
-    if( returnStatus == true )
+/*-----------------------------------------------------------*/
+
+    static int32_t sendExpectingContinue( NetworkContext_t * pNetworkContext,
+                                          const void * pBuffer,
+                                          size_t bytesToSend )
     {
-        /* Send the request and receive the response. */
-        httpStatus = HTTPClient_Send( pTransportInterface,
-                                      &requestHeaders,
-                                      NULL,
-                                      0,
-                                      &response,
-                                      0 );
+        int32_t bytesSent = 0;
+        uintptr_t address = ( uintptr_t ) pBuffer;
+        uintptr_t bodyStart = ( uintptr_t ) expectContinue.pBody;
 
-        if( httpStatus != HTTPSuccess )
+        /* The HTTP Client library sends the headers, then the body from its
+         * start. */
+        if( ( expectContinue.state == EXPECT_CONTINUE_WAITING ) && ( address == bodyStart ) )
         {
-            LogError( ( "Failed to send HTTP GET request to %s%s: Error=%s.",
-                        pHost, pPath, HTTPClient_strerror( httpStatus ) ) );
-            returnStatus = false;
+            expectContinue.state = waitForContinue( pNetworkContext );
         }
+
+        if( expectContinue.state == EXPECT_CONTINUE_FAILED )
+        {
+            bytesSent = -1;
+        }
+        else if( ( expectContinue.state == EXPECT_CONTINUE_REJECTED ) && ( address >= bodyStart ) &&
+                 ( ( address - bodyStart ) < expectContinue.bodyLength ) )
+        {
+            bytesSent = ( bytesToSend > ( size_t ) INT32_MAX ) ? INT32_MAX : ( int32_t ) bytesToSend;
+        }
+        else
+        {
+            bytesSent = sendRequestData( pNetworkContext, pBuffer, bytesToSend );
+        }
+
+        return bytesSent;
     }
 
-    if( returnStatus == true )
+/*-----------------------------------------------------------*/
+
+    static int32_t recvResponseData( NetworkContext_t * pNetworkContext,
+                                     void * pBuffer,
+                                     size_t bytesToRecv )
     {
-        LogDebug( ( "Received HTTP response from %s%s...",
-                    pHost, pPath ) );
-        LogDebug( ( "Response Headers:\n%.*s",
-                    ( int32_t ) response.headersLen,
-                    response.pHeaders ) );
-        LogDebug( ( "Response Body:\n%.*s\n",
-                    ( int32_t ) response.bodyLen,
-                    response.pBody ) );
+        int32_t bytesReceived = 0;
+        size_t length = expectContinue.responseLength - expectContinue.responseOffset;
 
-        if( response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
+        if( length > 0U )
         {
-            LogError( ( "Received an invalid response from the server "
-                        "(Status Code: %u).",
-                        response.statusCode ) );
-            returnStatus = false;
+            if( length > bytesToRecv )
+            {
+                length = bytesToRecv;
+            }
+
+            ( void ) memcpy( pBuffer, &expectContinue.response[ expectContinue.responseOffset ], length );
+            expectContinue.responseOffset += length;
+            bytesReceived = ( int32_t ) length;
         }
+        else
+        {
+            bytesReceived = Openssl_Recv( pNetworkContext, pBuffer, bytesToRecv );
+        }
+
+        return bytesReceived;
     }
 
-    if( returnStatus == true )
+/*-----------------------------------------------------------*/
+
+#endif /* if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 ) */
+
+#if ( FILE_UPLOAD_ENABLED == 1 ) || ( MULTIPART_UPLOAD_ENABLED == 1 )
+
+    static bool openUploadFile( void )
     {
-        LogInfo( ( "Received successful response from server "
-                   "(Status Code: %u).",
-                   response.statusCode ) );
+        bool returnStatus = true;
+        struct stat fileStat;
+        void * pMapping = MAP_FAILED;
 
-        httpStatus = HTTPClient_ReadHeader( &response,
-                                            ( char * ) HTTP_CONTENT_RANGE_HEADER_FIELD,
-                                            ( size_t ) HTTP_CONTENT_RANGE_HEADER_FIELD_LENGTH,
-                                            ( const char ** ) &contentRangeValStr,
-                                            &contentRangeValStrLength );
+        uploadFile.fileDescriptor = open( UPLOAD_FILE_PATH, O_RDONLY );
 
-        if( httpStatus != HTTPSuccess )
+        if( ( uploadFile.fileDescriptor < 0 ) || ( fstat( uploadFile.fileDescriptor, &fileStat ) != 0 ) ||
+            ( fileStat.st_size <= 0 ) )
         {
-            LogError( ( "Failed to read Content-Range header from HTTP response: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
+            LogError( ( "Failed to open the file to upload, or it is empty: Path=%s.",
+                        UPLOAD_FILE_PATH ) );
             returnStatus = false;
         }
+
+        if( returnStatus == true )
+        {
+            /* The mapping gives the body an address to pass to the HTTP
+             * Client library. Its pages are only read by the MD5 digest of the
+             * integrity check, as #sendRequestData sends the body from the
+             * file descriptor. */
+            pMapping = mmap( NULL, ( size_t ) fileStat.st_size, PROT_READ, MAP_PRIVATE, uploadFile.fileDescriptor, 0 );
+
+            if( pMapping == MAP_FAILED )
+            {
+                LogError( ( "Failed to map the file to upload: Path=%s.",
+                            UPLOAD_FILE_PATH ) );
+                returnStatus = false;
+            }
+            else
+            {
+                uploadFile.pData = ( const uint8_t * ) pMapping;
+                uploadFile.size = ( size_t ) fileStat.st_size;
+            }
+        }
+
+        if( returnStatus == false )
+        {
+            closeUploadFile();
+        }
+
+        return returnStatus;
     }
 
-    /* Parse the Content-Range header value to get the file size. */
-    if( returnStatus == true )
+/*-----------------------------------------------------------*/
+
+    static void closeUploadFile( void )
     {
-        pFileSizeStr = strstr( contentRangeValStr, "/" );
+        if( uploadFile.pData != NULL )
+        {
+            ( void ) munmap( ( void * ) uploadFile.pData, uploadFile.size );
+        }
 
-        if( pFileSizeStr == NULL )
+        if( uploadFile.fileDescriptor >= 0 )
         {
-            LogError( ( "'/' not present in Content-Range header value: %s.",
-                        contentRangeValStr ) );
-            returnStatus = false;
+            ( void ) close( uploadFile.fileDescriptor );
         }
+
+        uploadFile.fileDescriptor = -1;
+        uploadFile.pData = NULL;
+        uploadFile.size = 0U;
     }
 
-    if( returnStatus == true )
+#endif /* if ( FILE_UPLOAD_ENABLED == 1 ) || ( MULTIPART_UPLOAD_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 0 )
+
+    static bool verifyS3ObjectFileSize( const char * pPath,
+                                        size_t expectedSize )
     {
-        pFileSizeStr += sizeof( char );
-        *pFileSize = ( size_t ) strtoul( pFileSizeStr, NULL, 10 );
+        bool returnStatus = false;
+        /* The size of the file uploaded to S3. */
+        size_t fileSize = 0;
+
+        /* Retrieve the file size. */
+        returnStatus = getS3ObjectFileSize( &fileSize,
+                                            serverHost,
+                                            presignedPutUrl.host.length,
+                                            pPath );
 
-        if( ( *pFileSize == 0 ) || ( *pFileSize == UINT32_MAX ) )
+        if( returnStatus == true )
         {
-            LogError( ( "Error using strtoul to get the file size from %s: fileSize=%d.",
-                        pFileSizeStr, ( int32_t ) *pFileSize ) );
-            returnStatus = false;
+            if( fileSize != expectedSize )
+            {
+                LogError( ( "Failed to upload the data to S3. The file size found is %lu, but it should be %lu.",
+                            ( unsigned long ) fileSize,
+                            ( unsigned long ) expectedSize ) );
+                returnStatus = false;
+            }
+            else
+            {
+                LogInfo( ( "Successfuly verified that the size of the file found on S3 matches the file size uploaded "
+                           "(Uploaded: %lu bytes, Found: %lu bytes).",
+                           ( unsigned long ) expectedSize,
+                           ( unsigned long ) fileSize ) );
+            }
         }
+
+        return returnStatus;
     }
 
-    if( returnStatus == true )
+/*-----------------------------------------------------------*/
+
+    static bool getS3ObjectFileSize( size_t * pFileSize,
+                                     const char * pHost,
+                                     size_t hostLen,
+                                     const char * pPath )
     {
-        LogInfo( ( "The file is %d bytes long.", ( int32_t ) *pFileSize ) );
-    }
+        bool returnStatus = true;
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        HTTPRequestHeaders_t requestHeaders;
+        HTTPRequestInfo_t requestInfo;
+        HTTPResponse_t response;
+        uint8_t userBuffer[ USER_BUFFER_LENGTH ];
+
+        /* The location of the file size in contentRangeValStr. */
+        char * pFileSizeStr = NULL;
+
+        /* String to store the Content-Range header value. */
+        char * contentRangeValStr = NULL;
+        size_t contentRangeValStrLength = 0;
+
+        assert( pHost != NULL );
+        assert( pPath != NULL );
+
+        /* Initialize all HTTP Client library API structs to 0. */
+        ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+        ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+        ( void ) memset( &response, 0, sizeof( response ) );
+
+        /* Initialize the request object. */
+        requestInfo.pHost = pHost;
+        requestInfo.hostLen = hostLen;
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
+        requestInfo.pPath = pPath;
+        requestInfo.pathLen = strlen( pPath );
+
+        /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
+         * can be sent over the same established TCP connection. This is done in
+         * order to download the file in parts. */
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        /* Set the buffer used for storing request headers. */
+        requestHeaders.pBuffer = userBuffer;
+        requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+
+        /* Initialize the response object. The same buffer used for storing request
+         * headers is reused here. */
+        response.pBuffer = userBuffer;
+        response.bufferLen = USER_BUFFER_LENGTH;
+
+        LogInfo( ( "Getting file object size from host..." ) );
 
-    return returnStatus;
-}
+        httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                                          &requestInfo );
+
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
+        }
+
+        if( returnStatus == true )
+        {
+            /* Add the header to get bytes=0-0. S3 will respond with a Content-Range
+             * header that contains the size of the file in it. This header will
+             * look like: "Content-Range: bytes 0-0/FILESIZE". The body will have a
+             * single byte that we are ignoring. */
+            httpStatus = HTTPClient_AddRangeHeader( &requestHeaders, 0, 0 );
+
+            if( httpStatus != HTTPSuccess )
+            {
+                LogError( ( "Failed to add Range header to request headers: Error=%s.",
+                            HTTPClient_strerror( httpStatus ) ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            /* Send the request and receive the response. */
+            httpStatus = sendHttpRequest( &requestHeaders,
+                                          NULL,
+                                          0,
+                                          &response );
+
+            if( httpStatus != HTTPSuccess )
+            {
+                LogError( ( "Failed to send HTTP GET request to %s%s: Error=%s.",
+                            pHost, pPath, HTTPClient_strerror( httpStatus ) ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            LogDebug( ( "Received HTTP response from %s%s...",
+                        pHost, pPath ) );
+            LogDebug( ( "Response Headers:\n%.*s",
+                        ( int32_t ) response.headersLen,
+                        response.pHeaders ) );
+            LogDebug( ( "Response Body:\n%.*s\n",
+                        ( int32_t ) response.bodyLen,
+                        response.pBody ) );
+
+            if( response.statusCode != HTTP_STATUS_CODE_PARTIAL_CONTENT )
+            {
+                LogError( ( "Received an invalid response from the server "
+                            "(Status Code: %u).",
+                            response.statusCode ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            LogInfo( ( "Received successful response from server "
+                       "(Status Code: %u).",
+                       response.statusCode ) );
+
+            httpStatus = HTTPClient_ReadHeader( &response,
+                                                ( char * ) HTTP_CONTENT_RANGE_HEADER_FIELD,
+                                                ( size_t ) HTTP_CONTENT_RANGE_HEADER_FIELD_LENGTH,
+                                                ( const char ** ) &contentRangeValStr,
+                                                &contentRangeValStrLength );
+
+            if( httpStatus != HTTPSuccess )
+            {
+                LogError( ( "Failed to read Content-Range header from HTTP response: Error=%s.",
+                            HTTPClient_strerror( httpStatus ) ) );
+                returnStatus = false;
+            }
+        }
+
+        /* Parse the Content-Range header value to get the file size. */
+        if( returnStatus == true )
+        {
+            pFileSizeStr = strstr( contentRangeValStr, "/" );
+
+            if( pFileSizeStr == NULL )
+            {
+                LogError( ( "'/' not present in Content-Range header value: %s.",
+                            contentRangeValStr ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            pFileSizeStr += sizeof( char );
+            *pFileSize = ( size_t ) strtoul( pFileSizeStr, NULL, 10 );
+
+            if( ( *pFileSize == 0 ) || ( *pFileSize == UINT32_MAX ) )
+            {
+                LogError( ( "Error using strtoul to get the file size from %s: fileSize=%d.",
+                            pFileSizeStr, ( int32_t ) *pFileSize ) );
+                returnStatus = false;
+            }
+        }
+
+        if( returnStatus == true )
+        {
+            LogInfo( ( "The file is %d bytes long.", ( int32_t ) *pFileSize ) );
+        }
+
+        return returnStatus;
+    }
 
 /*-----------------------------------------------------------*/
 
-static bool uploadS3ObjectFile( const TransportInterface_t * pTransportInterface,
-                                const char * pPath )
+#endif /* if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 0 ) */
+
+static bool uploadS3ObjectFile( const char * pPath,
+                                const uint8_t * pBody,
+                                size_t bodyLength )
 {
     bool returnStatus = false;
     HTTPStatus_t httpStatus = HTTPSuccess;
 
+    #if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
+        uint8_t bodyDigest[ UPLOAD_MD5_DIGEST_LENGTH ];
+        const char * pEtag = NULL;
+        size_t etagLength = 0;
+    #endif
+
     assert( pPath != NULL );
 
     /* Initialize all HTTP Client library API structs to 0. */
@@ -535,7 +1525,7 @@ static bool uploadS3ObjectFile( const TransportInterface_t * pTransportInterface
 
     /* Initialize the request object. */
     requestInfo.pHost = serverHost;
-    requestInfo.hostLen = serverHostLength;
+    requestInfo.hostLen = presignedPutUrl.host.length;
     requestInfo.pMethod = HTTP_METHOD_PUT;
     requestInfo.methodLen = HTTP_METHOD_PUT_LENGTH;
     requestInfo.pPath = pPath;
@@ -560,18 +1550,30 @@ static bool uploadS3ObjectFile( const TransportInterface_t * pTransportInterface
                                                           &requestInfo );
     }
 
+    #if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
+        if( httpStatus == HTTPSuccess )
+        {
+            httpStatus = addContentMd5Header( &requestHeaders, pBody, bodyLength, bodyDigest );
+        }
+    #endif
+
+    #if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+        if( httpStatus == HTTPSuccess )
+        {
+            httpStatus = addExpectContinueHeader( &requestHeaders, pBody, bodyLength );
+        }
+    #endif
+
     if( httpStatus == HTTPSuccess )
     {
         LogInfo( ( "Uploading file..." ) );
         LogDebug( ( "Request Headers:\n%.*s",
                     ( int32_t ) requestHeaders.headersLen,
                     ( char * ) requestHeaders.pBuffer ) );
-        httpStatus = HTTPClient_Send( pTransportInterface,
-                                      &requestHeaders,
-                                      ( const uint8_t * ) DEMO_HTTP_UPLOAD_DATA,
-                                      DEMO_HTTP_UPLOAD_DATA_LENGTH,
-                                      &response,
-                                      0 );
+        httpStatus = sendHttpRequest( &requestHeaders,
+                                      pBody,
+                                      bodyLength,
+                                      &response );
     }
     else
     {
@@ -591,6 +1593,22 @@ static bool uploadS3ObjectFile( const TransportInterface_t * pTransportInterface
                     response.pBody ) );
 
         returnStatus = ( response.statusCode == 200 ) ? true : false;
+
+        #if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
+            /* S3 accepted the body it received as matching the Content-MD5
+             * header; the ETag confirms the object stored is that body. */
+            if( ( returnStatus == true ) &&
+                ( ( HTTPClient_ReadHeader( &response,
+                                           HTTP_ETAG_HEADER_FIELD,
+                                           HTTP_ETAG_HEADER_FIELD_LENGTH,
+                                           &pEtag,
+                                           &etagLength ) != HTTPSuccess ) ||
+                  ( etagMatchesDigest( pEtag, etagLength, bodyDigest ) == false ) ) )
+            {
+                LogError( ( "The ETag of the uploaded object is not the MD5 digest of the data sent." ) );
+                returnStatus = false;
+            }
+        #endif
     }
     else
     {
@@ -617,6 +1635,522 @@ static bool uploadS3ObjectFile( const TransportInterface_t * pTransportInterface
 
 /*-----------------------------------------------------------*/
 
+#if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
+
+    static HTTPStatus_t addContentMd5Header( HTTPRequestHeaders_t * pRequestHeaders,
+                                             const uint8_t * pBody,
+                                             size_t bodyLength,
+                                             uint8_t * pDigest )
+    {
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        unsigned int digestLength = 0U;
+        /* EVP_EncodeBlock terminates the encoding with a NUL character. */
+        char contentMd5[ CONTENT_MD5_VALUE_LENGTH + 1U ];
+
+        /* MD5 is not available when OpenSSL runs in FIPS mode. */
+        if( ( EVP_Digest( pBody, bodyLength, pDigest, &digestLength, EVP_md5(), NULL ) != 1 ) ||
+            ( digestLength != UPLOAD_MD5_DIGEST_LENGTH ) )
+        {
+            LogError( ( "Failed to compute the MD5 digest of the data to upload." ) );
+            httpStatus = HTTPInvalidParameter;
+        }
+        else
+        {
+            ( void ) EVP_EncodeBlock( ( unsigned char * ) contentMd5, pDigest, ( int ) UPLOAD_MD5_DIGEST_LENGTH );
+
+            httpStatus = HTTPClient_AddHeader( pRequestHeaders,
+                                               HTTP_CONTENT_MD5_HEADER_FIELD,
+                                               HTTP_CONTENT_MD5_HEADER_FIELD_LENGTH,
+                                               contentMd5,
+                                               CONTENT_MD5_VALUE_LENGTH );
+        }
+
+        return httpStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool etagMatchesDigest( const char * pEtag,
+                                   size_t etagLength,
+                                   const uint8_t * pDigest )
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+        bool matches = false;
+        size_t i = 0;
+
+        if( ( pEtag != NULL ) && ( etagLength == ( ( UPLOAD_MD5_DIGEST_LENGTH * 2U ) + 2U ) ) )
+        {
+            matches = ( pEtag[ 0 ] == '"' ) && ( pEtag[ etagLength - 1U ] == '"' );
+
+            for( i = 0; ( matches == true ) && ( i < UPLOAD_MD5_DIGEST_LENGTH ); i++ )
+            {
+                matches = ( pEtag[ 1U + ( i * 2U ) ] == hexDigits[ pDigest[ i ] >> 4 ] ) &&
+                          ( pEtag[ 2U + ( i * 2U ) ] == hexDigits[ pDigest[ i ] & 0x0FU ] );
+            }
+        }
+
+        return matches;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 ) */
+
+#if ( FILE_UPLOAD_ENABLED == 1 )
+
+    static bool uploadS3ObjectFileFromFile( const char * pPath,
+                                            size_t * pFileSize )
+    {
+        bool returnStatus = false;
+
+        if( openUploadFile() == true )
+        {
+            LogInfo( ( "Uploading %lu bytes from %s...",
+                       ( unsigned long ) uploadFile.size,
+                       UPLOAD_FILE_PATH ) );
+
+            returnStatus = uploadS3ObjectFile( pPath, uploadFile.pData, uploadFile.size );
+
+            if( returnStatus == true )
+            {
+                *pFileSize = uploadFile.size;
+            }
+
+            closeUploadFile();
+        }
+
+        return returnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if ( FILE_UPLOAD_ENABLED == 1 ) */
+
+#if ( MULTIPART_UPLOAD_ENABLED == 1 )
+
+    static bool uploadPart( UploadWorker_t * pWorker,
+                            uint32_t partIndex )
+    {
+        bool returnStatus = false;
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        HTTPRequestHeaders_t partRequestHeaders;
+        HTTPRequestInfo_t partRequestInfo;
+        HTTPResponse_t partResponse;
+        UploadPart_t * pPart = &uploadParts[ partIndex ];
+        uint64_t partStart = ( uint64_t ) partIndex * MULTIPART_UPLOAD_PART_SIZE;
+        size_t partLength = MULTIPART_UPLOAD_PART_SIZE;
+        const char * pEtag = NULL;
+        size_t etagLength = 0;
+
+        #if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
+            uint8_t partDigest[ UPLOAD_MD5_DIGEST_LENGTH ];
+        #endif
+
+        /* The last part holds the rest of the file. */
+        if( ( uploadJob.fileSize - partStart ) < partLength )
+        {
+            partLength = ( size_t ) ( uploadJob.fileSize - partStart );
+        }
+
+        ( void ) memset( &partRequestHeaders, 0, sizeof( partRequestHeaders ) );
+        ( void ) memset( &partRequestInfo, 0, sizeof( partRequestInfo ) );
+        ( void ) memset( &partResponse, 0, sizeof( partResponse ) );
+
+        partRequestInfo.pHost = serverHost;
+        partRequestInfo.hostLen = presignedPutUrl.host.length;
+        partRequestInfo.pMethod = HTTP_METHOD_PUT;
+        partRequestInfo.methodLen = HTTP_METHOD_PUT_LENGTH;
+        partRequestInfo.pPath = pPart->pPath;
+        partRequestInfo.pathLen = strlen( pPart->pPath );
+        partRequestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        /* Only the headers are stored in the buffer of the worker: the body is
+         * sent from the mapped file. */
+        partRequestHeaders.pBuffer = pWorker->buffer;
+        partRequestHeaders.bufferLen = USER_BUFFER_LENGTH;
+        partResponse.pBuffer = pWorker->buffer;
+        partResponse.bufferLen = USER_BUFFER_LENGTH;
+
+        httpStatus = HTTPClient_InitializeRequestHeaders( &partRequestHeaders,
+                                                          &partRequestInfo );
+
+        #if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
+            if( httpStatus == HTTPSuccess )
+            {
+                httpStatus = addContentMd5Header( &partRequestHeaders,
+                                                  &uploadJob.pFile[ partStart ],
+                                                  partLength,
+                                                  partDigest );
+            }
+        #endif
+
+        #if ( UPLOAD_EXPECT_CONTINUE_ENABLED == 1 )
+            if( httpStatus == HTTPSuccess )
+            {
+                httpStatus = addExpectContinueHeader( &partRequestHeaders,
+                                                      &uploadJob.pFile[ partStart ],
+                                                      partLength );
+            }
+        #endif
+
+        if( httpStatus == HTTPSuccess )
+        {
+            LogDebug( ( "Uploading part %u, bytes %llu-%llu...",
+                        ( unsigned int ) ( partIndex + 1U ),
+                        ( unsigned long long ) partStart,
+                        ( unsigned long long ) ( partStart + partLength - 1U ) ) );
+
+            httpStatus = sendHttpRequest( &partRequestHeaders,
+                                          &uploadJob.pFile[ partStart ],
+                                          partLength,
+                                          &partResponse );
+        }
+
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to send the request uploading part %u: Error=%s.",
+                        ( unsigned int ) ( partIndex + 1U ),
+                        HTTPClient_strerror( httpStatus ) ) );
+        }
+        else if( partResponse.statusCode != HTTP_STATUS_CODE_OK )
+        {
+            LogError( ( "Received an invalid response to the upload of part %u "
+                        "(Status Code: %u).",
+                        ( unsigned int ) ( partIndex + 1U ),
+                        partResponse.statusCode ) );
+        }
+        else
+        {
+            httpStatus = HTTPClient_ReadHeader( &partResponse,
+                                                HTTP_ETAG_HEADER_FIELD,
+                                                HTTP_ETAG_HEADER_FIELD_LENGTH,
+                                                &pEtag,
+                                                &etagLength );
+
+            if( ( httpStatus != HTTPSuccess ) || ( etagLength > MULTIPART_UPLOAD_ETAG_MAX_LENGTH ) )
+            {
+                LogError( ( "Failed to read the ETag of part %u from the response: Error=%s.",
+                            ( unsigned int ) ( partIndex + 1U ),
+                            HTTPClient_strerror( httpStatus ) ) );
+            }
+
+            #if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 1 )
+                else if( etagMatchesDigest( pEtag, etagLength, partDigest ) == false )
+                {
+                    LogError( ( "The ETag of part %u is not the MD5 digest of the data sent.",
+                                ( unsigned int ) ( partIndex + 1U ) ) );
+                }
+            #endif
+            else
+            {
+                /* The response is overwritten by the next request, so the ETag
+                 * is copied for the request completing the upload. */
+                ( void ) memcpy( pPart->etag, pEtag, etagLength );
+                pPart->etagLength = etagLength;
+                returnStatus = true;
+            }
+        }
+
+        return returnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool uploadPartWithRetries( UploadWorker_t * pWorker,
+                                       uint32_t partIndex )
+    {
+        bool returnStatus = false;
+        BackoffAlgorithmStatus_t backoffAlgStatus = BackoffAlgorithmSuccess;
+        BackoffAlgorithmContext_t retryParams;
+        uint16_t nextRetryBackOff = 0U;
+
+        BackoffAlgorithm_InitializeParams( &retryParams,
+                                           UPLOAD_PART_RETRY_BACKOFF_BASE_MS,
+                                           UPLOAD_PART_RETRY_MAX_BACKOFF_DELAY_MS,
+                                           UPLOAD_PART_RETRY_MAX_ATTEMPTS );
+
+        /* A failed request closes its connection in the pool, so each retry is
+         * sent over a new connection. */
+        do
+        {
+            returnStatus = uploadPart( pWorker, partIndex );
+
+            if( returnStatus == false )
+            {
+                backoffAlgStatus = BackoffAlgorithm_GetNextBackoff( &retryParams,
+                                                                    Random_GetUint32(),
+                                                                    &nextRetryBackOff );
+
+                if( backoffAlgStatus == BackoffAlgorithmSuccess )
+                {
+                    LogWarn( ( "Upload of part %u failed. Retrying after %hu ms backoff.",
+                               ( unsigned int ) ( partIndex + 1U ),
+                               ( unsigned short ) nextRetryBackOff ) );
+                    Clock_SleepMs( nextRetryBackOff );
+                }
+                else
+                {
+                    LogError( ( "Upload of part %u failed, all attempts exhausted.",
+                                ( unsigned int ) ( partIndex + 1U ) ) );
+                }
+            }
+        } while( ( returnStatus == false ) && ( backoffAlgStatus == BackoffAlgorithmSuccess ) &&
+                 ( __atomic_load_n( &uploadJob.failed, __ATOMIC_RELAXED ) == false ) );
+
+        return returnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * uploadWorkerTask( void * pArgument )
+    {
+        UploadWorker_t * pWorker = ( UploadWorker_t * ) pArgument;
+        uint32_t partIndex = 0U;
+        bool done = false;
+
+        while( done == false )
+        {
+            if( __atomic_load_n( &uploadJob.failed, __ATOMIC_RELAXED ) == true )
+            {
+                done = true;
+            }
+            else
+            {
+                partIndex = __atomic_fetch_add( &uploadJob.nextPart, 1U, __ATOMIC_RELAXED );
+
+                if( partIndex >= uploadJob.partCount )
+                {
+                    done = true;
+                }
+                else if( uploadPartWithRetries( pWorker, partIndex ) == false )
+                {
+                    __atomic_store_n( &uploadJob.failed, true, __ATOMIC_RELAXED );
+                    done = true;
+                }
+                else
+                {
+                    pWorker->partCount++;
+                }
+            }
+        }
+
+        return NULL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool completeMultipartUpload( void )
+    {
+        bool returnStatus = true;
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        const char * pCompletePath = NULL;
+        size_t completePathLen = 0;
+        size_t bodyLength = 0;
+        size_t resultLength = sizeof( COMPLETE_MULTIPART_RESULT_ELEMENT ) - 1U;
+        size_t i = 0;
+        uint32_t partIndex = 0U;
+
+        /* List the parts in ascending order of part number. */
+        bodyLength = ( size_t ) snprintf( completeBody, sizeof( completeBody ), COMPLETE_MULTIPART_BODY_START );
+
+        for( partIndex = 0U; partIndex < uploadJob.partCount; partIndex++ )
+        {
+            bodyLength += ( size_t ) snprintf( &completeBody[ bodyLength ],
+                                               sizeof( completeBody ) - bodyLength,
+                                               COMPLETE_MULTIPART_BODY_PART,
+                                               ( unsigned int ) ( partIndex + 1U ),
+                                               ( int ) uploadParts[ partIndex ].etagLength,
+                                               uploadParts[ partIndex ].etag );
+        }
+
+        bodyLength += ( size_t ) snprintf( &completeBody[ bodyLength ],
+                                           sizeof( completeBody ) - bodyLength,
+                                           COMPLETE_MULTIPART_BODY_END );
+        assert( bodyLength < sizeof( completeBody ) );
+
+        httpStatus = getUrlPath( S3_PRESIGNED_COMPLETE_MULTIPART_URL,
+                                 sizeof( S3_PRESIGNED_COMPLETE_MULTIPART_URL ) - 1U,
+                                 &pCompletePath,
+                                 &completePathLen );
+
+        if( httpStatus == HTTPSuccess )
+        {
+            ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+            ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+            ( void ) memset( &response, 0, sizeof( response ) );
+
+            requestInfo.pHost = serverHost;
+            requestInfo.hostLen = presignedPutUrl.host.length;
+            requestInfo.pMethod = HTTP_METHOD_POST;
+            requestInfo.methodLen = HTTP_METHOD_POST_LENGTH;
+            requestInfo.pPath = pCompletePath;
+            requestInfo.pathLen = strlen( pCompletePath );
+            requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+            requestHeaders.pBuffer = userBuffer;
+            requestHeaders.bufferLen = USER_BUFFER_LENGTH;
+            response.pBuffer = userBuffer;
+            response.bufferLen = USER_BUFFER_LENGTH;
+
+            httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                                              &requestInfo );
+        }
+
+        if( httpStatus == HTTPSuccess )
+        {
+            LogInfo( ( "Completing the multipart upload of %u parts...",
+                       ( unsigned int ) uploadJob.partCount ) );
+            LogDebug( ( "Request Body:\n%.*s",
+                        ( int32_t ) bodyLength,
+                        completeBody ) );
+
+            httpStatus = sendHttpRequest( &requestHeaders,
+                                          ( const uint8_t * ) completeBody,
+                                          bodyLength,
+                                          &response );
+        }
+
+        if( httpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to send the request completing the multipart upload: Error=%s.",
+                        HTTPClient_strerror( httpStatus ) ) );
+            returnStatus = false;
+        }
+        else if( response.statusCode != HTTP_STATUS_CODE_OK )
+        {
+            LogError( ( "Received an invalid response to the request completing the multipart upload "
+                        "(Status Code: %u).",
+                        response.statusCode ) );
+            returnStatus = false;
+        }
+        else
+        {
+            /* Search the body for the result, since S3 reports some errors with
+             * a "200 OK" status code. */
+            returnStatus = false;
+
+            for( i = 0; ( returnStatus == false ) && ( ( i + resultLength ) <= response.bodyLen ); i++ )
+            {
+                returnStatus = ( memcmp( &response.pBody[ i ],
+                                         COMPLETE_MULTIPART_RESULT_ELEMENT,
+                                         resultLength ) == 0 );
+            }
+
+            if( returnStatus == false )
+            {
+                LogError( ( "The multipart upload failed to complete:\n%.*s",
+                            ( int32_t ) response.bodyLen,
+                            response.pBody ) );
+            }
+        }
+
+        return returnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool uploadS3ObjectFileMultipart( size_t * pFileSize )
+    {
+        bool returnStatus = true;
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        size_t partPathLen = 0;
+        uint32_t i = 0U;
+        uint32_t startTimeMs = 0U, elapsedMs = 0U;
+
+        ( void ) memset( &uploadJob, 0, sizeof( uploadJob ) );
+        ( void ) memset( uploadParts, 0, sizeof( uploadParts ) );
+        ( void ) memset( uploadWorkers, 0, sizeof( uploadWorkers ) );
+
+        /* Each part is sent from the file by the transport, at its offset. */
+        returnStatus = openUploadFile();
+
+        if( returnStatus == true )
+        {
+            uploadJob.pFile = uploadFile.pData;
+            uploadJob.fileSize = ( uint64_t ) uploadFile.size;
+            uploadJob.partCount = ( uint32_t ) ( ( uploadJob.fileSize + MULTIPART_UPLOAD_PART_SIZE - 1U ) /
+                                                 MULTIPART_UPLOAD_PART_SIZE );
+
+            if( uploadJob.partCount > MULTIPART_UPLOAD_MAX_PART_COUNT )
+            {
+                LogError( ( "The file needs %u parts, but only %u pre-signed part URLs are defined: "
+                            "FileSize=%llu.",
+                            ( unsigned int ) uploadJob.partCount,
+                            ( unsigned int ) MULTIPART_UPLOAD_MAX_PART_COUNT,
+                            ( unsigned long long ) uploadJob.fileSize ) );
+                returnStatus = false;
+            }
+        }
+
+        for( i = 0U; ( returnStatus == true ) && ( i < uploadJob.partCount ); i++ )
+        {
+            httpStatus = getUrlPath( partUrls[ i ],
+                                     strlen( partUrls[ i ] ),
+                                     &uploadParts[ i ].pPath,
+                                     &partPathLen );
+            returnStatus = ( httpStatus == HTTPSuccess );
+        }
+
+        if( returnStatus == true )
+        {
+            LogInfo( ( "Uploading %llu bytes in %u parts with %u workers...",
+                       ( unsigned long long ) uploadJob.fileSize,
+                       ( unsigned int ) uploadJob.partCount,
+                       ( unsigned int ) UPLOAD_WORKER_COUNT ) );
+
+            startTimeMs = Clock_GetTimeMs();
+
+            for( i = 0U; i < UPLOAD_WORKER_COUNT; i++ )
+            {
+                if( pthread_create( &uploadWorkers[ i ].thread, NULL, uploadWorkerTask, &uploadWorkers[ i ] ) == 0 )
+                {
+                    uploadWorkers[ i ].threadStarted = true;
+                }
+                else
+                {
+                    LogError( ( "Failed to create the thread of worker %u.", ( unsigned int ) i ) );
+                    __atomic_store_n( &uploadJob.failed, true, __ATOMIC_RELAXED );
+                }
+            }
+
+            for( i = 0U; i < UPLOAD_WORKER_COUNT; i++ )
+            {
+                if( uploadWorkers[ i ].threadStarted == true )
+                {
+                    ( void ) pthread_join( uploadWorkers[ i ].thread, NULL );
+                    LogInfo( ( "Worker %u uploaded %u parts.",
+                               ( unsigned int ) i,
+                               ( unsigned int ) uploadWorkers[ i ].partCount ) );
+                }
+            }
+
+            returnStatus = ( uploadJob.failed == false );
+        }
+
+        if( returnStatus == true )
+        {
+            returnStatus = completeMultipartUpload();
+        }
+
+        if( returnStatus == true )
+        {
+            elapsedMs = Clock_GetTimeMs() - startTimeMs;
+            LogInfo( ( "Uploaded %llu bytes in %u ms (%llu KiB/s).",
+                       ( unsigned long long ) uploadJob.fileSize,
+                       ( unsigned int ) elapsedMs,
+                       ( unsigned long long ) ( ( uploadJob.fileSize * 1000U ) /
+                                                ( ( uint64_t ) ( ( elapsedMs > 0U ) ? elapsedMs : 1U ) * 1024U ) ) ) );
+            *pFileSize = ( size_t ) uploadJob.fileSize;
+        }
+
+        closeUploadFile();
+
+        return returnStatus;
+    }
+#endif /* if ( MULTIPART_UPLOAD_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Entry point of demo.
  *
@@ -625,11 +2159,35 @@ static bool uploadS3ObjectFile( const TransportInterface_t * pTransportInterface
  * defined in the config header, and then finally performs a TLS handshake with
  * the HTTP server so that all communication is encrypted. After which, the HTTP
  * Client library API is used to upload a file to a S3 bucket by sending a PUT
- * request, and verify the file was uploaded using a GET request. If any request
- * fails, an error code is returned.
+ * request, and verify the file was uploaded using a GET request. Both requests
+ * are sent over the same keep-alive connection from the connection pool, unless
+ * the server closes it in between. If any request fails, an error code is
+ * returned.
  *
  * @note This example is single-threaded and uses statically allocated memory.
  *
+ * @note When MULTIPART_UPLOAD_ENABLED is 1, the file at UPLOAD_FILE_PATH is
+ * instead uploaded in parts of MULTIPART_UPLOAD_PART_SIZE bytes by
+ * UPLOAD_WORKER_COUNT threads, each over its own connection from the pool. A
+ * failed part is retried with exponential backoff, and the upload is completed
+ * once all parts are uploaded. A failed iteration of the demo uploads all parts
+ * again with the same pre-signed URLs.
+ *
+ * @note When FILE_UPLOAD_ENABLED is 1, the file at UPLOAD_FILE_PATH is instead
+ * uploaded with a single PUT request, its body sent from the file by the
+ * transport rather than from a buffer.
+ *
+ * @note When UPLOAD_INTEGRITY_CHECK_ENABLED is 1, each upload request carries
+ * the MD5 digest of its body in a Content-MD5 header, and the ETag of its
+ * response is checked against it, instead of sending a GET request for the
+ * size of the object once uploaded.
+ *
+ * @note When UPLOAD_EXPECT_CONTINUE_ENABLED is 1, each upload request carries
+ * an "Expect: 100-continue" header, and its body is only sent once the server
+ * accepted its headers with a "100 Continue" interim response. A request
+ * rejected, for instance because its pre-signed URL expired, fails without
+ * sending its body, as does a request not answered within
+ * UPLOAD_EXPECT_CONTINUE_TIMEOUT_MS milliseconds.
  */
 int main( int argc,
           char ** argv )
@@ -638,113 +2196,66 @@ int main( int argc,
     int32_t returnStatus = EXIT_SUCCESS;
     /* Return value of private functions. */
     bool ret = false;
-    /* HTTPS Client library return status. */
-    HTTPStatus_t httpStatus = HTTPSuccess;
     int demoRunCount = 0;
-
-    /* The length of the path within the pre-signed URL. This variable is
-     * defined in order to store the length returned from parsing the URL, but
-     * it is unused. The path used for the requests in this demo needs all the
-     * query information following the location of the object, to the end of the
-     * S3 presigned URL. */
-    size_t pathLen = 0;
-
-    /* The transport layer interface used by the HTTP Client library. */
-    TransportInterface_t transportInterface;
-    /* The network context for the transport layer interface. */
-    NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
+    /* The size of the data uploaded, verified once uploaded. */
+    size_t uploadedSize = DEMO_HTTP_UPLOAD_DATA_LENGTH;
 
     ( void ) argc;
     ( void ) argv;
 
-    /* Set the pParams member of the network context with desired transport. */
-    networkContext.pParams = &opensslParams;
-
     LogInfo( ( "HTTP Client Synchronous S3 upload demo using pre-signed PUT URL:\n%s",
                S3_PRESIGNED_PUT_URL ) );
 
     do
     {
-        /**************************** Connect. ******************************/
-
-        /* Establish TLS connection on top of TCP connection using OpenSSL. */
+        /********************** Initialize server info. ********************/
 
-        /* Attempt to connect to the HTTP server. If connection fails, retry
-         * after a timeout. The timeout value will be exponentially
-         * increased until either the maximum number of attempts or the
-         * maximum timeout value is reached. The function returns
-         * EXIT_FAILURE if the TCP connection cannot be established to the
-         * broker after the configured number of attempts. */
-        returnStatus = connectToServerWithBackoffRetries( connectToServer,
-                                                          &networkContext );
-
-        if( returnStatus == EXIT_FAILURE )
-        {
-            /* Log error to indicate connection failure after all reconnect
-             * attempts are over. */
-            LogError( ( "Failed to connect to HTTP server %s.",
-                        serverHost ) );
-        }
-
-        /* Define the transport interface. */
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            ( void ) memset( &transportInterface, 0, sizeof( transportInterface ) );
-            transportInterface.recv = Openssl_Recv;
-            transportInterface.send = Openssl_Send;
-            transportInterface.pNetworkContext = &networkContext;
-        }
+        /* The TLS connections are established on top of TCP connections using
+         * OpenSSL by the connection pool, with retries and backoff, when
+         * the first request is sent and whenever the server closes the
+         * connection. */
+        returnStatus = initializeServerInfo();
 
         /********************** Upload S3 Object File. **********************/
 
         if( returnStatus == EXIT_SUCCESS )
         {
-            /* Retrieve the path location from S3_PRESIGNED_PUT_URL. This
-             * function returns the length of the path without the query into
-             * pathLen, which is left unused in this demo. */
-            httpStatus = getUrlPath( S3_PRESIGNED_PUT_URL,
-                                     S3_PRESIGNED_PUT_URL_LENGTH,
-                                     &pPath,
-                                     &pathLen );
-
-            returnStatus = ( httpStatus == HTTPSuccess ) ? EXIT_SUCCESS : EXIT_FAILURE;
-        }
-
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            ret = uploadS3ObjectFile( &transportInterface,
-                                      pPath );
+            /* The path used for the requests in this demo needs all the query
+             * information following the location of the object, to the end
+             * of the S3 presigned URL. */
+            #if ( MULTIPART_UPLOAD_ENABLED == 1 )
+                ret = uploadS3ObjectFileMultipart( &uploadedSize );
+            #elif ( FILE_UPLOAD_ENABLED == 1 )
+                ret = uploadS3ObjectFileFromFile( &S3_PRESIGNED_PUT_URL[ presignedPutUrl.requestTarget.offset ],
+                                                  &uploadedSize );
+            #else
+                ret = uploadS3ObjectFile( &S3_PRESIGNED_PUT_URL[ presignedPutUrl.requestTarget.offset ],
+                                          ( const uint8_t * ) DEMO_HTTP_UPLOAD_DATA,
+                                          DEMO_HTTP_UPLOAD_DATA_LENGTH );
+            #endif
             returnStatus = ( ret == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
         }
 
         /******************* Verify S3 Object File Upload. ********************/
 
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            /* Retrieve the path location from S3_PRESIGNED_GET_URL. This
-             * function returns the length of the path without the query into
-             * pathLen. */
-            httpStatus = getUrlPath( S3_PRESIGNED_GET_URL,
-                                     S3_PRESIGNED_GET_URL_LENGTH,
-                                     &pPath,
-                                     &pathLen );
-
-            returnStatus = ( httpStatus == HTTPSuccess ) ? EXIT_SUCCESS : EXIT_FAILURE;
-        }
-
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            /* Verify the file exists by retrieving the file size. */
-            ret = verifyS3ObjectFileSize( &transportInterface,
-                                          pPath );
-            returnStatus = ( ret == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
-        }
+        /* With the integrity check, the upload was already verified by the
+         * response to its own request. */
+        #if ( UPLOAD_INTEGRITY_CHECK_ENABLED == 0 )
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                /* Verify the file exists by retrieving the file size. */
+                ret = verifyS3ObjectFileSize( &S3_PRESIGNED_GET_URL[ presignedGetUrl.requestTarget.offset ],
+                                              uploadedSize );
+                returnStatus = ( ret == true ) ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+        #else
+            ( void ) uploadedSize;
+        #endif
 
         /************************** Disconnect. *****************************/
 
-        /* End the TLS session, then close the TCP connection. */
-        ( void ) Openssl_Disconnect( &networkContext );
+        /* End the TLS sessions, then close the TCP connections. */
+        ConnectionPool_CloseAll();
 
         /******************* Retry in case of failure. **********************/
 
@@ -23,54 +23,110 @@
 #ifndef DEMO_CONFIG_H
 #define DEMO_CONFIG_H
 
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging config definition and header files inclusion are required in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define the LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL macros depending on
+ * the logging configuration for DEMO.
+ * 3. Include the header file "logging_stack.h", if logging is enabled for DEMO.
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the downloads of the Demo. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "DEMO"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
 /**
  * @brief The client must send a control packet at least
  * this often in seconds, or the broker will close the connection.
  */
-#define MQTT_KEEP_ALIVE         ( 120U )
+#define MQTT_KEEP_ALIVE              ( 120U )
 
 /**
  * @brief Require acknowledgements of MQTT publish operations.
  */
-#define MQTT_QOS                ( 1 )
+#define MQTT_QOS                     ( 1 )
 
 /**
  * @brief Give up after this many calls to mqtt_loop without progress,
  * used only for connect and subscribe.
  */
-#define MAX_LOOPS               ( 50U )
+#define MAX_LOOPS                    ( 50U )
 
 /**
  * @brief Maximum duration in milliseconds of one mqtt_loop,
  * used only for connect and subscribe.
  */
-#define MQTT_SHORT_WAIT_TIME    ( 500U )
+#define MQTT_SHORT_WAIT_TIME         ( 500U )
 
 /**
  * @brief Maximum duration in milliseconds of one mqtt_loop,
  * used after subscribe.
  */
-#define MQTT_WAIT_TIME          ( 10U * 1000U )
+#define MQTT_WAIT_TIME               ( 10U * 1000U )
 
 /**
  * @brief Maximum interval in seconds for pollinv and updateinv command line arguments.
  * (arbitrarily chosen to be a week; must be less than LONG_MAX)
  */
-#define INTERVAL_MAX            ( 60U * 60U * 24U * 7U )
+#define INTERVAL_MAX                 ( 60U * 60U * 24U * 7U )
 
 /**
  * @brief Parent directory to contain download directories and files.
  */
-#define DESTINATION_PREFIX      "/tmp"
+#define DESTINATION_PREFIX           "/tmp"
+
+/**
+ * @brief Trusted CA certificates of the servers of the downloads, unless
+ * given with the --dlcafile command line argument.
+ *
+ * Debian and Ubuntu keep the system's trusted CA certificates in this file.
+ */
+#define DOWNLOAD_CA_FILE             "/etc/ssl/certs/ca-certificates.crt"
+
+/**
+ * @brief Storage of the fields of the job document of each job; a job whose
+ * fields do not fit fails.
+ */
+#define JOB_ARENA_LENGTH             ( 1024U )
+
+/**
+ * @brief Number of jobs whose files are downloaded at once.
+ */
+#define JOB_DOWNLOAD_THREAD_COUNT    ( 4U )
+
+/**
+ * @brief Most IDs of pending jobs kept to start as the running jobs finish,
+ * without listing the pending jobs again.
+ */
+#define JOB_QUEUE_LENGTH             ( 16U )
+
+/**
+ * @brief One connection to the servers of the downloads per thread.
+ */
+#define CONNECTION_POOL_SIZE         JOB_DOWNLOAD_THREAD_COUNT
 
 /**
- * @brief How to invoke the download program, i.e., curl.
+ * @brief Limit of the download rate of each job, in bytes per second.
  *
- * As written, this curl command limits the download rate
- * to 10 KB per second.  The slow rate provides an opportunity
- * to observe updates, and test job cancellation.
+ * As written, the downloads are limited to 10 KB per second.  The slow
+ * rate provides an opportunity to observe updates, and test job
+ * cancellation.
  */
-#define CURL( url ) \
-    execl( "/usr/bin/curl", "curl", "-OLsSN", "--limit-rate", "10k", url, NULL )
+#define JOB_DOWNLOAD_RATE_LIMIT      ( 10U * 1024U )
 
 #endif /* ifndef DEMO_CONFIG_H */
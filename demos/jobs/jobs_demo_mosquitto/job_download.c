@@ -0,0 +1,860 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file job_download.c
+ * @brief Implementation of an engine downloading the files of several jobs
+ * at once, over HTTPS, on a pool of threads.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* OpenSSL include, for the digests. */
+#include <openssl/evp.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the download engine. */
+#include "job_download.h"
+
+/* Common HTTP demo utilities. */
+#include "http_demo_utils.h"
+
+/* Connections shared by the downloads to the same server. */
+#include "http_connection_pool.h"
+
+/* Streaming of the response bodies to the files. */
+#include "http_body_stream.h"
+
+/* Include clock header for the rate limit. */
+#include "clock.h"
+
+/* Allocator include. */
+#include "allocator.h"
+
+/* Include header for the placement of the threads. */
+#include "thread_groups.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Port of the servers when the URL has none.
+ */
+#define HTTPS_PORT                     ( 443U )
+
+/**
+ * @brief Longest sleep of the rate limit, after which a download checks
+ * whether it was released.
+ */
+#define RATE_LIMIT_MAX_SLEEP_MS        ( 100U )
+
+/**
+ * @brief Characters of the scheme of the URLs supported.
+ */
+#define HTTPS_SCHEME                   "https"
+
+/**
+ * @brief Length of #HTTPS_SCHEME.
+ */
+#define HTTPS_SCHEME_LENGTH            ( sizeof( HTTPS_SCHEME ) - 1U )
+
+/**
+ * @brief Length of the HTTP GET method.
+ */
+#define HTTP_METHOD_GET_LENGTH         ( sizeof( HTTP_METHOD_GET ) - 1U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A download, started by #JobDownload_Start.
+ *
+ * The members are guarded by #downloadMutex, except the counters and the
+ * cancel flag, which the thread of the download updates while the mutex is
+ * not held.
+ */
+typedef struct JobDownload
+{
+    char * pUrl;                                  /**< @brief URL of the file, allocated. */
+    size_t urlLength;                             /**< @brief Length of #JobDownload_t.pUrl. */
+    char * pFilePath;                             /**< @brief Path of the file written, allocated. */
+    bool verify;                                  /**< @brief Whether the digest of the file is verified. */
+    uint8_t sha256[ JOB_DOWNLOAD_SHA256_LENGTH ]; /**< @brief Expected digest of the file. */
+    JobDownloadVerification_t verification;       /**< @brief Result of the verification. */
+    uint32_t sequence;                            /**< @brief Order of the download among the queued ones. */
+    JobDownloadState_t state;                     /**< @brief State of the download. */
+    bool inUse;                                   /**< @brief Whether the download is started and not released. */
+    bool released;                                /**< @brief Whether the download was released while running, so its thread frees it. */
+    bool cancel;                                  /**< @brief Whether the thread must stop receiving, accessed atomically. */
+    uint64_t bytesReceived;                       /**< @brief Bytes of the file written, accessed atomically. */
+    uint64_t contentLength;                       /**< @brief Length of the file, accessed atomically. */
+} JobDownload_t;
+
+/**
+ * @brief The context of the body callback of a download.
+ */
+typedef struct DownloadContext
+{
+    JobDownload_t * pDownload;                  /**< @brief The download. */
+    FILE * pFile;                               /**< @brief The file written. */
+    const HttpBodyStreamResponse_t * pResponse; /**< @brief The response, whose content length is known once the body arrives. */
+    uint32_t startTimeMs;                       /**< @brief Time the request was sent, for the rate limit. */
+    bool writeFailed;                           /**< @brief Whether writing the file failed. */
+    EVP_MD_CTX * pDigestContext;                /**< @brief SHA-256 context of the bytes written; NULL if not verified. */
+    bool digestFailed;                          /**< @brief Whether updating the digest failed. */
+} DownloadContext_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The downloads, indexed by their identifiers.
+ */
+static JobDownload_t downloads[ JOB_DOWNLOAD_MAX_DOWNLOADS ];
+
+/**
+ * @brief The threads of the engine.
+ */
+static pthread_t threads[ JOB_DOWNLOAD_THREAD_COUNT ];
+
+/**
+ * @brief The buffer of each thread, for the request and the response
+ * headers, on the NUMA node of the threads.
+ */
+static uint8_t * pThreadBuffers[ JOB_DOWNLOAD_THREAD_COUNT ];
+
+/**
+ * @brief Number of threads started by #JobDownload_Init.
+ */
+static size_t threadCount = 0U;
+
+/**
+ * @brief Sequence number of the next download queued.
+ */
+static uint32_t nextSequence = 0U;
+
+/**
+ * @brief Whether #JobDownload_Deinit is stopping the threads.
+ */
+static bool shutdownRequested = false;
+
+/**
+ * @brief Trusted root CA certificates of the servers.
+ */
+static const char * pServerRootCaPath = NULL;
+
+/**
+ * @brief Mutex guarding the downloads.
+ */
+static pthread_mutex_t downloadMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Condition signaled when a download is queued or the threads must
+ * stop.
+ */
+static pthread_cond_t downloadQueued = PTHREAD_COND_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Free the strings of a download and mark it unused.
+ *
+ * @param[in] pDownload The download, with #downloadMutex held.
+ */
+static void freeDownload( JobDownload_t * pDownload );
+
+/**
+ * @brief Find the download queued first.
+ *
+ * @return The download, or NULL if none is queued. #downloadMutex must be
+ * held.
+ */
+static JobDownload_t * findQueuedDownload( void );
+
+/**
+ * @brief Write the body of a response to the file of its download.
+ *
+ * @param[in] pContext The #DownloadContext_t of the download.
+ * @param[in] offset Position of @p pData within the body.
+ * @param[in] pData The next bytes of the body.
+ * @param[in] dataLength The length of @p pData.
+ *
+ * @return true to keep receiving; false if the download was released, or
+ * writing the file or updating its digest failed.
+ */
+static bool receiveBody( void * pContext,
+                         uint64_t offset,
+                         const uint8_t * pData,
+                         size_t dataLength );
+
+/**
+ * @brief Compare the digest of the bytes written with the expected one.
+ *
+ * @param[in] pDownload The download, running.
+ * @param[in] pDigestContext SHA-256 context of the bytes written.
+ *
+ * @return #JobDownloadVerified or #JobDownloadDigestMismatch.
+ */
+static JobDownloadVerification_t verifyDigest( const JobDownload_t * pDownload,
+                                               EVP_MD_CTX * pDigestContext );
+
+/**
+ * @brief Find the server of a URL, and the credentials of the connections to
+ * it.
+ *
+ * @param[in] pUrl HTTPS URL of the file.
+ * @param[in] urlLength Length of @p pUrl.
+ * @param[out] pParsedUrl The components of @p pUrl.
+ * @param[out] pHost Buffer of #URL_MAX_HOST_LENGTH + 1 bytes receiving the
+ * host of @p pUrl, which @p pServerInfo and @p pCredentials point to.
+ * @param[out] pServerInfo Host and port of the server.
+ * @param[out] pCredentials Credentials of the TLS connections.
+ *
+ * @return true if @p pUrl is a valid HTTPS URL; false otherwise.
+ */
+static bool initializeServer( const char * pUrl,
+                              size_t urlLength,
+                              ParsedUrl_t * pParsedUrl,
+                              char * pHost,
+                              ServerInfo_t * pServerInfo,
+                              OpensslCredentials_t * pCredentials );
+
+/**
+ * @brief Download a file.
+ *
+ * @param[in] pDownload The download, running.
+ * @param[in] pBuffer Buffer for the request and the response headers, of
+ * #JOB_DOWNLOAD_BUFFER_LENGTH bytes.
+ * @param[out] pVerification Result of the verification of the file.
+ *
+ * @return true if the file was received and written entirely, and its
+ * digest matches if it is verified; false otherwise.
+ */
+static bool runDownload( JobDownload_t * pDownload,
+                         uint8_t * pBuffer,
+                         JobDownloadVerification_t * pVerification );
+
+/**
+ * @brief Run the queued downloads, one at a time, until
+ * #JobDownload_Deinit.
+ *
+ * @param[in] pArgument The buffer of the thread.
+ *
+ * @return NULL.
+ */
+static void * downloadThread( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static void freeDownload( JobDownload_t * pDownload )
+{
+    Allocator_Free( pDownload->pUrl );
+    Allocator_Free( pDownload->pFilePath );
+    ( void ) memset( pDownload, 0, sizeof( JobDownload_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static JobDownload_t * findQueuedDownload( void )
+{
+    JobDownload_t * pFirst = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; i < JOB_DOWNLOAD_MAX_DOWNLOADS; i++ )
+    {
+        /* The subtraction orders the sequence numbers across wrap around. */
+        if( ( downloads[ i ].inUse == true ) &&
+            ( downloads[ i ].state == JobDownloadQueued ) &&
+            ( ( pFirst == NULL ) ||
+              ( ( int32_t ) ( downloads[ i ].sequence - pFirst->sequence ) < 0 ) ) )
+        {
+            pFirst = &downloads[ i ];
+        }
+    }
+
+    return pFirst;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveBody( void * pContext,
+                         uint64_t offset,
+                         const uint8_t * pData,
+                         size_t dataLength )
+{
+    DownloadContext_t * pDownloadContext = ( DownloadContext_t * ) pContext;
+    JobDownload_t * pDownload = pDownloadContext->pDownload;
+    bool keepReceiving = true;
+    uint64_t bytesReceived = 0U;
+
+    #if ( JOB_DOWNLOAD_RATE_LIMIT > 0U )
+        uint32_t dueTimeMs = 0U;
+        uint32_t elapsedTimeMs = 0U;
+    #endif
+
+    /* The body is written in order, as it arrives. */
+    ( void ) offset;
+
+    if( __atomic_load_n( &pDownload->cancel, __ATOMIC_RELAXED ) == true )
+    {
+        keepReceiving = false;
+    }
+    else if( fwrite( pData, 1U, dataLength, pDownloadContext->pFile ) != dataLength )
+    {
+        LogError( ( "Failed to write %s.", pDownload->pFilePath ) );
+        pDownloadContext->writeFailed = true;
+        keepReceiving = false;
+    }
+    else if( ( pDownloadContext->pDigestContext != NULL ) &&
+             ( EVP_DigestUpdate( pDownloadContext->pDigestContext, pData, dataLength ) != 1 ) )
+    {
+        LogError( ( "Failed to update the digest of %s.", pDownload->pFilePath ) );
+        pDownloadContext->digestFailed = true;
+        keepReceiving = false;
+    }
+    else
+    {
+        __atomic_store_n( &pDownload->contentLength, pDownloadContext->pResponse->contentLength, __ATOMIC_RELAXED );
+        bytesReceived = __atomic_add_fetch( &pDownload->bytesReceived, dataLength, __ATOMIC_RELAXED );
+    }
+
+    #if ( JOB_DOWNLOAD_RATE_LIMIT > 0U )
+        /* Wait until the bytes received are within the rate limit, in short
+         * sleeps so that a release stops the download promptly. */
+        dueTimeMs = ( uint32_t ) ( ( bytesReceived * 1000U ) / JOB_DOWNLOAD_RATE_LIMIT );
+        elapsedTimeMs = Clock_GetTimeMs() - pDownloadContext->startTimeMs;
+
+        while( ( keepReceiving == true ) && ( elapsedTimeMs < dueTimeMs ) )
+        {
+            Clock_SleepMs( ( ( dueTimeMs - elapsedTimeMs ) < RATE_LIMIT_MAX_SLEEP_MS ) ?
+                           ( dueTimeMs - elapsedTimeMs ) : RATE_LIMIT_MAX_SLEEP_MS );
+            keepReceiving = ( __atomic_load_n( &pDownload->cancel, __ATOMIC_RELAXED ) == false );
+            elapsedTimeMs = Clock_GetTimeMs() - pDownloadContext->startTimeMs;
+        }
+    #else
+        ( void ) bytesReceived;
+    #endif
+
+    return keepReceiving;
+}
+
+/*-----------------------------------------------------------*/
+
+static JobDownloadVerification_t verifyDigest( const JobDownload_t * pDownload,
+                                               EVP_MD_CTX * pDigestContext )
+{
+    JobDownloadVerification_t verification = JobDownloadDigestMismatch;
+    uint8_t digest[ EVP_MAX_MD_SIZE ];
+    unsigned int digestLength = 0U;
+
+    if( ( EVP_DigestFinal_ex( pDigestContext, digest, &digestLength ) == 1 ) &&
+        ( digestLength == JOB_DOWNLOAD_SHA256_LENGTH ) &&
+        ( memcmp( digest, pDownload->sha256, JOB_DOWNLOAD_SHA256_LENGTH ) == 0 ) )
+    {
+        verification = JobDownloadVerified;
+    }
+    else
+    {
+        LogError( ( "The SHA-256 digest of %s differs from the expected one.", pDownload->pFilePath ) );
+    }
+
+    return verification;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool initializeServer( const char * pUrl,
+                              size_t urlLength,
+                              ParsedUrl_t * pParsedUrl,
+                              char * pHost,
+                              ServerInfo_t * pServerInfo,
+                              OpensslCredentials_t * pCredentials )
+{
+    bool returnStatus = false;
+
+    if( parseUrl( pUrl, urlLength, pParsedUrl ) != HTTPSuccess )
+    {
+        LogError( ( "Failed to parse the URL %.*s.", ( int ) urlLength, pUrl ) );
+    }
+    else if( ( pParsedUrl->scheme.length != HTTPS_SCHEME_LENGTH ) ||
+             ( strncasecmp( &pUrl[ pParsedUrl->scheme.offset ], HTTPS_SCHEME, HTTPS_SCHEME_LENGTH ) != 0 ) )
+    {
+        LogError( ( "Only HTTPS URLs are supported: %.*s.", ( int ) urlLength, pUrl ) );
+    }
+    else if( copyUrlHost( pParsedUrl, pHost, URL_MAX_HOST_LENGTH + 1U ) == false )
+    {
+        LogError( ( "The host of the URL is too long: %.*s.", ( int ) urlLength, pUrl ) );
+    }
+    else
+    {
+        ( void ) memset( pCredentials, 0, sizeof( OpensslCredentials_t ) );
+        pCredentials->pRootCaPath = pServerRootCaPath;
+        pCredentials->sniHostName = pHost;
+
+        ( void ) memset( pServerInfo, 0, sizeof( ServerInfo_t ) );
+        pServerInfo->pHostName = pHost;
+        pServerInfo->hostNameLength = pParsedUrl->host.length;
+        pServerInfo->port = ( pParsedUrl->port != 0U ) ? pParsedUrl->port : HTTPS_PORT;
+
+        returnStatus = true;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool runDownload( JobDownload_t * pDownload,
+                         uint8_t * pBuffer,
+                         JobDownloadVerification_t * pVerification )
+{
+    bool returnStatus = false;
+    HTTPStatus_t httpStatus = HTTPSuccess;
+    ParsedUrl_t parsedUrl;
+    char host[ URL_MAX_HOST_LENGTH + 1U ];
+    ServerInfo_t serverInfo;
+    OpensslCredentials_t credentials;
+    TransportInterface_t transportInterface;
+    HTTPRequestInfo_t requestInfo;
+    HTTPResponse_t response;
+    HttpBodyStreamResponse_t streamResponse;
+    DownloadContext_t context;
+    bool openFile = false;
+
+    ( void ) memset( &context, 0, sizeof( context ) );
+    ( void ) memset( &streamResponse, 0, sizeof( streamResponse ) );
+    context.pDownload = pDownload;
+    context.pResponse = &streamResponse;
+    *pVerification = JobDownloadNotVerified;
+
+    if( initializeServer( pDownload->pUrl,
+                          pDownload->urlLength,
+                          &parsedUrl,
+                          host,
+                          &serverInfo,
+                          &credentials ) == false )
+    {
+        /* The URL is logged. */
+    }
+    else if( pDownload->verify == true )
+    {
+        /* OpenSSL picks the SHA instructions of the CPU where it has them. */
+        context.pDigestContext = EVP_MD_CTX_new();
+
+        if( ( context.pDigestContext == NULL ) ||
+            ( EVP_DigestInit_ex( context.pDigestContext, EVP_sha256(), NULL ) != 1 ) )
+        {
+            LogError( ( "Failed to initialize the digest of %s.", pDownload->pFilePath ) );
+        }
+        else
+        {
+            openFile = true;
+        }
+    }
+    else
+    {
+        openFile = true;
+    }
+
+    if( openFile == true )
+    {
+        context.pFile = fopen( pDownload->pFilePath, "wb" );
+
+        if( context.pFile == NULL )
+        {
+            LogError( ( "Failed to create %s.", pDownload->pFilePath ) );
+        }
+    }
+
+    if( context.pFile != NULL )
+    {
+        ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+        requestInfo.pHost = host;
+        requestInfo.hostLen = parsedUrl.host.length;
+        requestInfo.pMethod = HTTP_METHOD_GET;
+        requestInfo.methodLen = HTTP_METHOD_GET_LENGTH;
+        requestInfo.pPath = &pDownload->pUrl[ parsedUrl.requestTarget.offset ];
+        requestInfo.pathLen = parsedUrl.requestTarget.length;
+        requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+        if( ConnectionPool_Checkout( &serverInfo,
+                                     &credentials,
+                                     JOB_DOWNLOAD_TIMEOUT_MS,
+                                     &transportInterface ) == CONNECTION_POOL_SUCCESS )
+        {
+            LogInfo( ( "Downloading %s to %s.", pDownload->pUrl, pDownload->pFilePath ) );
+
+            /* The whole file is requested without a Range header, and the
+             * buffer is reused for each part of the body received. */
+            context.startTimeMs = Clock_GetTimeMs();
+            httpStatus = HttpBodyStream_Get( &transportInterface,
+                                             &requestInfo,
+                                             0U,
+                                             HTTP_BODY_STREAM_END_OF_OBJECT,
+                                             pBuffer,
+                                             JOB_DOWNLOAD_BUFFER_LENGTH,
+                                             receiveBody,
+                                             &context,
+                                             &streamResponse );
+
+            /* The connection pool only reads the flags of the response. */
+            ( void ) memset( &response, 0, sizeof( response ) );
+
+            if( streamResponse.connectionClose == true )
+            {
+                response.respFlags = HTTP_RESPONSE_CONNECTION_CLOSE_FLAG;
+            }
+
+            ConnectionPool_Checkin( &transportInterface, httpStatus, &response );
+
+            if( __atomic_load_n( &pDownload->cancel, __ATOMIC_RELAXED ) == true )
+            {
+                LogInfo( ( "Stopped downloading %s.", pDownload->pUrl ) );
+            }
+            else if( httpStatus != HTTPSuccess )
+            {
+                LogError( ( "Failed to download %s: Error=%s.",
+                            pDownload->pUrl,
+                            HTTPClient_strerror( httpStatus ) ) );
+            }
+            else if( ( streamResponse.statusCode < 200U ) || ( streamResponse.statusCode >= 300U ) )
+            {
+                LogError( ( "Failed to download %s: Status Code=%u.",
+                            pDownload->pUrl,
+                            ( unsigned int ) streamResponse.statusCode ) );
+            }
+            else
+            {
+                __atomic_store_n( &pDownload->contentLength, streamResponse.contentLength, __ATOMIC_RELAXED );
+                returnStatus = ( context.writeFailed == false ) &&
+                               ( context.digestFailed == false ) &&
+                               ( streamResponse.bodyLength == streamResponse.contentLength );
+            }
+
+            if( ( returnStatus == true ) && ( context.pDigestContext != NULL ) )
+            {
+                *pVerification = verifyDigest( pDownload, context.pDigestContext );
+                returnStatus = ( *pVerification == JobDownloadVerified );
+            }
+        }
+
+        if( fclose( context.pFile ) != 0 )
+        {
+            LogError( ( "Failed to write %s.", pDownload->pFilePath ) );
+            returnStatus = false;
+        }
+    }
+
+    EVP_MD_CTX_free( context.pDigestContext );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * downloadThread( void * pArgument )
+{
+    uint8_t * pBuffer = ( uint8_t * ) pArgument;
+    JobDownload_t * pDownload = NULL;
+    bool success = false;
+    JobDownloadVerification_t verification = JobDownloadNotVerified;
+
+    ( void ) pthread_mutex_lock( &downloadMutex );
+
+    while( shutdownRequested == false )
+    {
+        pDownload = findQueuedDownload();
+
+        if( pDownload == NULL )
+        {
+            ( void ) pthread_cond_wait( &downloadQueued, &downloadMutex );
+        }
+        else
+        {
+            pDownload->state = JobDownloadRunning;
+            ( void ) pthread_mutex_unlock( &downloadMutex );
+
+            success = runDownload( pDownload, pBuffer, &verification );
+
+            ( void ) pthread_mutex_lock( &downloadMutex );
+
+            if( pDownload->released == true )
+            {
+                freeDownload( pDownload );
+            }
+            else
+            {
+                pDownload->state = ( success == true ) ? JobDownloadSucceeded : JobDownloadFailed;
+                pDownload->verification = verification;
+            }
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &downloadMutex );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+JobDownloadStatus_t JobDownload_Init( const char * pRootCaPath )
+{
+    JobDownloadStatus_t returnStatus = JOB_DOWNLOAD_SUCCESS;
+
+    if( pRootCaPath == NULL )
+    {
+        LogError( ( "NULL parameter passed to JobDownload_Init()." ) );
+        returnStatus = JOB_DOWNLOAD_INVALID_PARAMETER;
+    }
+    else
+    {
+        pServerRootCaPath = pRootCaPath;
+
+        while( ( returnStatus == JOB_DOWNLOAD_SUCCESS ) && ( threadCount < JOB_DOWNLOAD_THREAD_COUNT ) )
+        {
+            pThreadBuffers[ threadCount ] = ThreadGroup_Allocate( JOB_DOWNLOAD_THREAD_GROUP, JOB_DOWNLOAD_BUFFER_LENGTH );
+
+            if( pThreadBuffers[ threadCount ] == NULL )
+            {
+                LogError( ( "Failed to allocate the buffer of a download thread." ) );
+                returnStatus = JOB_DOWNLOAD_NO_MEMORY;
+            }
+            else if( ThreadGroup_CreateThread( JOB_DOWNLOAD_THREAD_GROUP,
+                                               &threads[ threadCount ],
+                                               downloadThread,
+                                               pThreadBuffers[ threadCount ] ) != ThreadGroupSuccess )
+            {
+                LogError( ( "Failed to create a download thread." ) );
+                ThreadGroup_Free( pThreadBuffers[ threadCount ], JOB_DOWNLOAD_BUFFER_LENGTH );
+                pThreadBuffers[ threadCount ] = NULL;
+                returnStatus = JOB_DOWNLOAD_NO_MEMORY;
+            }
+            else
+            {
+                threadCount++;
+            }
+        }
+
+        if( returnStatus != JOB_DOWNLOAD_SUCCESS )
+        {
+            JobDownload_Deinit();
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+JobDownloadStatus_t JobDownload_Start( const char * pUrl,
+                                       size_t urlLength,
+                                       const char * pFilePath,
+                                       const uint8_t * pSha256,
+                                       size_t * pDownloadId )
+{
+    JobDownloadStatus_t returnStatus = JOB_DOWNLOAD_FULL;
+    JobDownload_t * pDownload = NULL;
+    size_t i = 0U;
+
+    if( ( pUrl == NULL ) || ( pFilePath == NULL ) || ( pDownloadId == NULL ) || ( threadCount == 0U ) )
+    {
+        LogError( ( "NULL parameter passed to JobDownload_Start(), or the engine is not started." ) );
+        returnStatus = JOB_DOWNLOAD_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &downloadMutex );
+
+        for( i = 0U; ( i < JOB_DOWNLOAD_MAX_DOWNLOADS ) && ( pDownload == NULL ); i++ )
+        {
+            if( downloads[ i ].inUse == false )
+            {
+                pDownload = &downloads[ i ];
+                *pDownloadId = i;
+            }
+        }
+
+        if( pDownload != NULL )
+        {
+            pDownload->pUrl = Allocator_Strndup( ALLOCATOR_SUBSYSTEM_DEMO, pUrl, urlLength );
+            pDownload->urlLength = urlLength;
+            pDownload->pFilePath = Allocator_Strndup( ALLOCATOR_SUBSYSTEM_DEMO, pFilePath, strlen( pFilePath ) );
+
+            if( pSha256 != NULL )
+            {
+                pDownload->verify = true;
+                ( void ) memcpy( pDownload->sha256, pSha256, JOB_DOWNLOAD_SHA256_LENGTH );
+            }
+
+            if( ( pDownload->pUrl == NULL ) || ( pDownload->pFilePath == NULL ) )
+            {
+                freeDownload( pDownload );
+                returnStatus = JOB_DOWNLOAD_NO_MEMORY;
+            }
+            else
+            {
+                pDownload->sequence = nextSequence;
+                nextSequence++;
+                pDownload->state = JobDownloadQueued;
+                pDownload->inUse = true;
+                ( void ) pthread_cond_signal( &downloadQueued );
+                returnStatus = JOB_DOWNLOAD_SUCCESS;
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &downloadMutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void JobDownload_Prewarm( const char * pUrl,
+                          size_t urlLength )
+{
+    ParsedUrl_t parsedUrl;
+    char host[ URL_MAX_HOST_LENGTH + 1U ];
+    ServerInfo_t serverInfo;
+    OpensslCredentials_t credentials;
+
+    if( ( pUrl == NULL ) || ( threadCount == 0U ) )
+    {
+        LogError( ( "NULL parameter passed to JobDownload_Prewarm(), or the engine is not started." ) );
+    }
+    else if( initializeServer( pUrl, urlLength, &parsedUrl, host, &serverInfo, &credentials ) == true )
+    {
+        /* The pool copies the host, which is also the SNI host name, and the
+         * connection is checked out by #runDownload with the same
+         * credentials. */
+        ( void ) ConnectionPool_Prewarm( &serverInfo, &credentials, JOB_DOWNLOAD_TIMEOUT_MS );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+JobDownloadStatus_t JobDownload_GetProgress( size_t downloadId,
+                                             JobDownloadProgress_t * pProgress )
+{
+    JobDownloadStatus_t returnStatus = JOB_DOWNLOAD_INVALID_PARAMETER;
+    JobDownload_t * pDownload = NULL;
+
+    if( ( pProgress != NULL ) && ( downloadId < JOB_DOWNLOAD_MAX_DOWNLOADS ) )
+    {
+        pDownload = &downloads[ downloadId ];
+
+        ( void ) pthread_mutex_lock( &downloadMutex );
+
+        if( ( pDownload->inUse == true ) && ( pDownload->released == false ) )
+        {
+            pProgress->state = pDownload->state;
+            pProgress->bytesReceived = __atomic_load_n( &pDownload->bytesReceived, __ATOMIC_RELAXED );
+            pProgress->contentLength = __atomic_load_n( &pDownload->contentLength, __ATOMIC_RELAXED );
+            pProgress->verification = pDownload->verification;
+            returnStatus = JOB_DOWNLOAD_SUCCESS;
+        }
+
+        ( void ) pthread_mutex_unlock( &downloadMutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void JobDownload_Release( size_t downloadId )
+{
+    JobDownload_t * pDownload = NULL;
+
+    if( downloadId < JOB_DOWNLOAD_MAX_DOWNLOADS )
+    {
+        pDownload = &downloads[ downloadId ];
+
+        ( void ) pthread_mutex_lock( &downloadMutex );
+
+        if( ( pDownload->inUse == true ) && ( pDownload->released == false ) )
+        {
+            if( pDownload->state == JobDownloadRunning )
+            {
+                /* The thread of the download frees it once it stops. */
+                pDownload->released = true;
+                __atomic_store_n( &pDownload->cancel, true, __ATOMIC_RELAXED );
+            }
+            else
+            {
+                freeDownload( pDownload );
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &downloadMutex );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void JobDownload_Deinit( void )
+{
+    size_t i = 0U;
+
+    ( void ) pthread_mutex_lock( &downloadMutex );
+
+    shutdownRequested = true;
+
+    for( i = 0U; i < JOB_DOWNLOAD_MAX_DOWNLOADS; i++ )
+    {
+        __atomic_store_n( &downloads[ i ].cancel, true, __ATOMIC_RELAXED );
+    }
+
+    ( void ) pthread_cond_broadcast( &downloadQueued );
+    ( void ) pthread_mutex_unlock( &downloadMutex );
+
+    for( i = 0U; i < threadCount; i++ )
+    {
+        ( void ) pthread_join( threads[ i ], NULL );
+        ThreadGroup_Free( pThreadBuffers[ i ], JOB_DOWNLOAD_BUFFER_LENGTH );
+        pThreadBuffers[ i ] = NULL;
+    }
+
+    ( void ) pthread_mutex_lock( &downloadMutex );
+
+    for( i = 0U; i < JOB_DOWNLOAD_MAX_DOWNLOADS; i++ )
+    {
+        freeDownload( &downloads[ i ] );
+    }
+
+    threadCount = 0U;
+    shutdownRequested = false;
+    ( void ) pthread_mutex_unlock( &downloadMutex );
+
+    ConnectionPool_CloseAll();
+}
@@ -0,0 +1,261 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file job_download.h
+ * @brief The API of an engine downloading the files of several jobs at once,
+ * over HTTPS, on a pool of threads.
+ */
+
+#ifndef JOB_DOWNLOAD_H_
+#define JOB_DOWNLOAD_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Job Download module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Job Download"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of threads downloading, which is the number of downloads
+ * that progress at once.
+ */
+#ifndef JOB_DOWNLOAD_THREAD_COUNT
+    #define JOB_DOWNLOAD_THREAD_COUNT    ( 4U )
+#endif
+
+/**
+ * @brief Thread group of the download threads and of their buffers; see
+ * #ThreadGroup_Define.
+ */
+#ifndef JOB_DOWNLOAD_THREAD_GROUP
+    #define JOB_DOWNLOAD_THREAD_GROUP    "download"
+#endif
+
+/**
+ * @brief Number of downloads started and not yet released, whether queued
+ * for a thread, running or finished.
+ */
+#ifndef JOB_DOWNLOAD_MAX_DOWNLOADS
+    #define JOB_DOWNLOAD_MAX_DOWNLOADS    JOB_DOWNLOAD_THREAD_COUNT
+#endif
+
+/**
+ * @brief Length of the buffer of each thread, which must hold the request
+ * and the headers of the response.
+ */
+#ifndef JOB_DOWNLOAD_BUFFER_LENGTH
+    #define JOB_DOWNLOAD_BUFFER_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Send and receive timeout of the connections.
+ */
+#ifndef JOB_DOWNLOAD_TIMEOUT_MS
+    #define JOB_DOWNLOAD_TIMEOUT_MS    ( 5000U )
+#endif
+
+/**
+ * @brief Largest number of bytes per second received by a download; 0 for
+ * no limit.
+ */
+#ifndef JOB_DOWNLOAD_RATE_LIMIT
+    #define JOB_DOWNLOAD_RATE_LIMIT    ( 0U )
+#endif
+
+/**
+ * @brief Length of a SHA-256 digest.
+ */
+#define JOB_DOWNLOAD_SHA256_LENGTH    ( 32U )
+
+/* Enumeration type for return status value from Job Download API. */
+typedef enum JobDownloadStatus
+{
+    /**
+     * @brief Success return value from Job Download API.
+     */
+    JOB_DOWNLOAD_SUCCESS = 0,
+
+    /**
+     * @brief Failure return value due to a NULL parameter or an unknown
+     * download identifier.
+     */
+    JOB_DOWNLOAD_INVALID_PARAMETER,
+
+    /**
+     * @brief Failure return value due to #JOB_DOWNLOAD_MAX_DOWNLOADS
+     * downloads not being released.
+     */
+    JOB_DOWNLOAD_FULL,
+
+    /**
+     * @brief Failure return value due to a memory allocation or a thread
+     * creation failing.
+     */
+    JOB_DOWNLOAD_NO_MEMORY
+} JobDownloadStatus_t;
+
+/**
+ * @brief The states of a download.
+ */
+typedef enum JobDownloadState
+{
+    JobDownloadQueued = 0, /**< @brief Waiting for a thread. */
+    JobDownloadRunning,    /**< @brief Receiving the file. */
+    JobDownloadSucceeded,  /**< @brief The file was received entirely. */
+    JobDownloadFailed      /**< @brief The file could not be received or written, or its digest differs. */
+} JobDownloadState_t;
+
+/**
+ * @brief The results of the verification of a file.
+ */
+typedef enum JobDownloadVerification
+{
+    JobDownloadNotVerified = 0, /**< @brief No digest was given, or the file is not received entirely. */
+    JobDownloadVerified,        /**< @brief The digest of the file matches. */
+    JobDownloadDigestMismatch   /**< @brief The digest of the file differs. */
+} JobDownloadVerification_t;
+
+/**
+ * @brief The progress of a download.
+ */
+typedef struct JobDownloadProgress
+{
+    JobDownloadState_t state;               /**< @brief State of the download. */
+    uint64_t bytesReceived;                 /**< @brief Bytes of the file written. */
+    uint64_t contentLength;                 /**< @brief Length of the file; 0 until its response has been received. */
+    JobDownloadVerification_t verification; /**< @brief Result of the verification, once finished. */
+} JobDownloadProgress_t;
+
+/**
+ * @brief Start the threads of the engine.
+ *
+ * @param[in] pRootCaPath Trusted root CA certificates of the servers. The
+ * string must remain valid until #JobDownload_Deinit.
+ *
+ * @return Returns one of the following:
+ * - #JOB_DOWNLOAD_SUCCESS if the threads are started.
+ * - #JOB_DOWNLOAD_INVALID_PARAMETER if @p pRootCaPath is NULL.
+ * - #JOB_DOWNLOAD_NO_MEMORY if a thread could not be created.
+ */
+JobDownloadStatus_t JobDownload_Init( const char * pRootCaPath );
+
+/**
+ * @brief Queue the download of a file, which starts once a thread is free.
+ *
+ * The file is requested with a single GET request over a connection of the
+ * HTTP connection pool, and written as its body arrives. Its SHA-256 digest
+ * is computed from the same bytes, so verifying it takes no second pass
+ * over the file.
+ *
+ * @param[in] pUrl HTTPS URL of the file. It is copied.
+ * @param[in] urlLength Length of @p pUrl.
+ * @param[in] pFilePath Path of the file to write, which is created or
+ * truncated. It is copied.
+ * @param[in] pSha256 Expected SHA-256 digest of the file, of
+ * #JOB_DOWNLOAD_SHA256_LENGTH bytes, or NULL to not verify it. It is
+ * copied.
+ * @param[out] pDownloadId Identifier of the download.
+ *
+ * @return Returns one of the following:
+ * - #JOB_DOWNLOAD_SUCCESS if the download is queued.
+ * - #JOB_DOWNLOAD_INVALID_PARAMETER if a parameter is NULL or the engine is
+ * not started.
+ * - #JOB_DOWNLOAD_FULL if #JOB_DOWNLOAD_MAX_DOWNLOADS downloads are not
+ * released.
+ * - #JOB_DOWNLOAD_NO_MEMORY if the strings could not be copied.
+ */
+JobDownloadStatus_t JobDownload_Start( const char * pUrl,
+                                       size_t urlLength,
+                                       const char * pFilePath,
+                                       const uint8_t * pSha256,
+                                       size_t * pDownloadId );
+
+/**
+ * @brief Start connecting to the server of a file about to be downloaded.
+ *
+ * The connection is established by the HTTP connection pool in the
+ * background, while the job naming the file is processed, and is used by
+ * the download of the file started within
+ * #CONNECTION_POOL_PREWARM_TIMEOUT_MS. Failures are only logged, the
+ * download connecting again.
+ *
+ * @param[in] pUrl HTTPS URL of the file.
+ * @param[in] urlLength Length of @p pUrl.
+ */
+void JobDownload_Prewarm( const char * pUrl,
+                          size_t urlLength );
+
+/**
+ * @brief Read the progress of a download, without waiting for its thread.
+ *
+ * @param[in] downloadId Identifier of the download.
+ * @param[out] pProgress The progress.
+ *
+ * @return #JOB_DOWNLOAD_SUCCESS, or #JOB_DOWNLOAD_INVALID_PARAMETER if
+ * @p downloadId is not a download started and not released.
+ */
+JobDownloadStatus_t JobDownload_GetProgress( size_t downloadId,
+                                             JobDownloadProgress_t * pProgress );
+
+/**
+ * @brief Release a download, stopping it if it is still queued or running.
+ *
+ * A running download stops at the next bytes it receives, and its
+ * identifier may be reused by #JobDownload_Start once it has stopped. The
+ * file already written is left in place.
+ *
+ * @param[in] downloadId Identifier of the download.
+ */
+void JobDownload_Release( size_t downloadId );
+
+/**
+ * @brief Stop all the downloads and the threads of the engine, and close the
+ * connections of the pool.
+ */
+void JobDownload_Deinit( void );
+
+#endif /* ifndef JOB_DOWNLOAD_H_ */
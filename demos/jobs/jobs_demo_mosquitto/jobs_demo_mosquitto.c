@@ -27,10 +27,17 @@
  * AWS IoT Jobs service.  More details are available in the usage function
  * in this file.  Note: This demo focuses on use of the jobs library;
  * a thorough explanation of libmosquitto is beyond the scope of the demo.
+ *
+ * Several jobs run at once. The files are downloaded within the process by
+ * the threads of job_download.c, over HTTPS connections that the downloads
+ * to the same server share, and the status updates of the jobs report the
+ * progress of their downloads.  The pending jobs listed while all jobs are
+ * running are queued, and start as the running jobs finish.
  */
 
 /* C standard includes. */
 #include <assert.h>
+#include <ctype.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -43,7 +50,6 @@
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <unistd.h>
 
 #include <err.h>
@@ -57,6 +63,9 @@
 #include "demo_config.h"
 #include "jobs.h"
 #include "core_json.h"
+#include "json_extract.h"
+#include "http_demo_utils.h"
+#include "job_download.h"
 
 /*-----------------------------------------------------------*/
 
@@ -79,6 +88,10 @@
  */
 #define ALPN_NAME               "x-amzn-mqtt-ca"
 
+/**
+ * @brief Name of a downloaded file when its URL has none.
+ */
+#define DEFAULT_FILE_NAME       "download"
 
 /*-----------------------------------------------------------*/
 
@@ -98,6 +111,8 @@ static void usage( const char * programName )
              "\nTo execute the job, on the target device run the demo program with the device's credentials, e.g.,\n"
              "$ %s -n device1 -h abcdefg123.iot.us-east-1.amazonaws.com \\\n"
              "  --certfile bbaf123456-certificate.pem.crt --keyfile bbaf123456-private.pem.key\n"
+             "\nSeveral jobs run at once, and their updates report the progress of their downloads.\n"
+             "The pending jobs beyond those are queued, and start as the running jobs finish.\n"
              "\nTo exit the program, type Control-C, or send a SIGTERM signal.\n",
              programName );
     fprintf( stderr,
@@ -125,25 +140,29 @@ static void usage( const char * programName )
              );
     fprintf( stderr,
              "\nusage: %s "
-             "[-o] -n name -h host [-p port] {--cafile file | --capath dir} --certfile file --keyfile file [--pollinv seconds] [--updateinv seconds]\n"
+             "[-o] [-j count] -n name -h host [-p port] {--cafile file | --capath dir} --certfile file --keyfile file [--dlcafile file] [--pollinv seconds] [--updateinv seconds]\n"
              "\n"
-             "-o : run once, exit after the first job is finished.\n"
+             "-o : run once, start no job after the first job is finished, and exit when none is running.\n"
+             "-j : run at most this many jobs at once. Defaults to %u.\n"
              "-n : thing name\n"
              "-h : mqtt host to connect to.\n"
              "-p : network port to connect to. Defaults to %d.\n",
-             programName, DEFAULT_MQTT_PORT );
+             programName, ( unsigned int ) JOB_DOWNLOAD_MAX_DOWNLOADS, DEFAULT_MQTT_PORT );
     fprintf( stderr,
              "--cafile    : path to a file containing trusted CA certificates to enable encrypted\n"
              "              certificate based communication.\n"
              "--capath    : path to a directory containing trusted CA certificates to enable encrypted\n"
              "              communication.  Defaults to %s.\n"
              "--certfile  : client certificate for authentication in PEM format.\n"
-             "--keyfile   : client private key for authentication in PEM format.\n",
-             DEFAULT_CA_DIRECTORY );
+             "--keyfile   : client private key for authentication in PEM format.\n"
+             "--dlcafile  : path to a file containing trusted CA certificates of the servers of the\n"
+             "              downloads.  Defaults to %s.\n",
+             DEFAULT_CA_DIRECTORY, DOWNLOAD_CA_FILE );
     fprintf( stderr,
              "--pollinv   : after this many idle seconds, request a job.\n"
              "              Without this option and a positive value, no polling is done.\n"
-             "--updateinv : after this many seconds running a job, resend the current status to the jobs service.\n"
+             "--updateinv : every this many seconds, resend the current status of the running jobs to the\n"
+             "              jobs service, all of them together.\n"
              "              Without this option and a positive value, status is not resent.\n\n"
              );
 }
@@ -155,12 +174,55 @@ static void usage( const char * programName )
  */
 typedef enum
 {
-    None = 0, /* no current job */
-    Ready,    /* job document received and parsed */
-    Running,  /* download in progress */
-    Cancel,   /* cancel due to failed update */
+    None = 0,  /* no current job */
+    Requested, /* job document requested */
+    Ready,     /* job document received and parsed */
+    Running,   /* download in progress */
+    Cancel,    /* cancel due to failed update */
 } runStatus_t;
 
+/**
+ * @brief The longest status update of a job.
+ */
+#define REPORT_MAX_LENGTH    ( 128U )
+
+/**
+ * @brief The fields of a job document copied to a job.
+ *
+ * To handle more fields, add them here and to #jobFields.
+ */
+typedef enum
+{
+    JobFieldId = 0,    /* job ID, required */
+    JobFieldUrl,       /* URL of the file to download, required */
+    JobFieldChecksum,  /* SHA-256 checksum of the file, optional */
+    JobFieldSize,      /* size of the file, optional */
+    JobFieldOperation, /* operation of the job, optional */
+    JobFieldCount
+} jobField_t;
+
+/**
+ * @brief The parameters and state of a job.
+ */
+typedef struct
+{
+    /* job parameters received via MQTT, copied to the arena */
+    char * fields[ JobFieldCount ]; /* NULL if absent */
+    size_t fieldLengths[ JobFieldCount ];
+    char * jobid;                   /* same as fields[ JobFieldId ] */
+    size_t jobidLength;
+    char * url;                     /* same as fields[ JobFieldUrl ] */
+    size_t urlLength;
+    /* storage of the parameters, emptied when the job ends */
+    char arena[ JOB_ARENA_LENGTH ];
+    size_t arenaLength;
+    /* internal state tracking */
+    runStatus_t runStatus;
+    size_t downloadId;
+    char report[ REPORT_MAX_LENGTH ];
+    bool forceUpdate;
+} job_t;
+
 /**
  * @brief All runtime parameters and state.
  */
@@ -176,8 +238,10 @@ typedef struct
     char * capath;
     char * certfile;
     char * keyfile;
+    char * dlcafile;
     uint32_t pollinv;   /* 0 (default) disables polling for new jobs */
     uint32_t updateinv; /* 0 (default) disables periodic resending of status */
+    uint32_t maxJobs;   /* jobs running at once, at most JOB_DOWNLOAD_MAX_DOWNLOADS */
     /* flags */
     bool runOnce;
     /* callback-populated values */
@@ -185,19 +249,16 @@ typedef struct
     int subscribeQOS;
     /* mosquitto library handle */
     struct mosquitto * m;
-    /* job parameters received via MQTT */
-    char * jobid;
-    size_t jobidLength;
-    char * url;
-    size_t urlLength;
+    /* jobs received via MQTT, at most one per download of the engine */
+    job_t jobs[ JOB_DOWNLOAD_MAX_DOWNLOADS ];
+    /* IDs of pending jobs listed while all jobs were in use, oldest first */
+    char queue[ JOB_QUEUE_LENGTH ][ JOBS_JOBID_MAX_LENGTH + 1U ];
+    size_t queueLength;
     /* internal state tracking */
-    runStatus_t runStatus;
-    char * report;
     time_t lastPrompt;
     time_t lastUpdate;
     bool forcePrompt;
-    bool forceUpdate;
-    pid_t child;
+    bool jobFinished;
 } handle_t;
 
 /*-----------------------------------------------------------*/
@@ -307,16 +368,115 @@ static bool sendUpdate( handle_t * h,
                         char * report );
 
 /**
- * @brief Read job ID and URL from a JSON job document.
+ * @brief Find the job with a job ID.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] jobid the job ID
+ * @param[in] jobidLength size of the job ID string
+ *
+ * @return the job, or NULL if no job has the job ID
+ */
+static job_t * findJob( handle_t * h,
+                        const char * jobid,
+                        size_t jobidLength );
+
+/**
+ * @brief Find a job not in use.
+ *
+ * @param[in] h runtime state handle
+ *
+ * @return the job, or NULL if all jobs are in use, or if no job may start
+ * because a job has finished while running once
+ */
+static job_t * findFreeJob( handle_t * h );
+
+/**
+ * @brief Empty the arena of a job and mark it not in use.
+ *
+ * @param[in] j the job
+ */
+static void releaseJob( job_t * j );
+
+/**
+ * @brief Copy a string to the arena of a job.
+ *
+ * @param[in] j the job
+ * @param[in] value the string, not necessarily terminated
+ * @param[in] valueLength size of the string
+ *
+ * @return the terminated copy, or NULL if the arena is full
+ */
+static char * arenaCopy( job_t * j,
+                         const char * value,
+                         size_t valueLength );
+
+/**
+ * @brief Find the fields of a JSON job document in one pass.
  *
  * @param[in] h runtime state handle
  * @param[in] message an MQTT publish message
+ * @param[out] fields the values found in the message, indexed by
+ * #jobField_t
  *
- * @return true if values were found and copied to the handle;
+ * @return true if the required fields were found;
  * false otherwise
  */
 static bool parseJob( handle_t * h,
-                      const struct mosquitto_message * message );
+                      const struct mosquitto_message * message,
+                      JSONExtractQuery_t * fields );
+
+/**
+ * @brief Copy the fields of a job document to a job and make it ready to
+ * start, unless it is already in use or all jobs are in use.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] fields the values found by parseJob()
+ */
+static void acceptJob( handle_t * h,
+                       const JSONExtractQuery_t * fields );
+
+/**
+ * @brief Request the job documents of the pending jobs of a list, while
+ * jobs are not in use, and queue the IDs of the others.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] message response to a request for the pending jobs
+ *
+ * @note This does not call mosquitto_loop(); it expects main() to do so.
+ */
+static void parsePending( handle_t * h,
+                          const struct mosquitto_message * message );
+
+/**
+ * @brief Queue the ID of a pending job, to start when a job is not in use.
+ *
+ * @param[in] h runtime state handle
+ * @param[in] jobid the job ID
+ * @param[in] jobidLength size of the job ID string
+ *
+ * @note The ID is dropped if the queue is full; the next list of pending
+ * jobs lists it again.
+ */
+static void queueJob( handle_t * h,
+                      const char * jobid,
+                      size_t jobidLength );
+
+/**
+ * @brief Empty the queue of pending job IDs.
+ *
+ * @param[in] h runtime state handle
+ */
+static void clearQueue( handle_t * h );
+
+/**
+ * @brief Request the job documents of queued jobs, while jobs are not in
+ * use.
+ *
+ * @param[in] h runtime state handle
+ *
+ * @note This does not call mosquitto_loop(); it expects main() to do so.
+ */
+static void startQueuedJobs( handle_t * h );
 
 /**
  * @brief The libmosquitto callback for a received publish message.
@@ -333,7 +493,7 @@ void on_message( struct mosquitto * m,
                  const struct mosquitto_message * message );
 
 /**
- * @brief Publish a request to the Jobs service to describe the next job.
+ * @brief Publish a request to the Jobs service to list the pending jobs.
  *
  * @param[in] h runtime state handle
  *
@@ -342,31 +502,62 @@ void on_message( struct mosquitto * m,
  *
  * @note This does not call mosquitto_loop(); it expects main() to do so.
  */
-static bool sendDescribeNext( handle_t * h );
+static bool sendGetPending( handle_t * h );
 
 /**
- * @brief Checks status of the download process.
+ * @brief Publish a request to the Jobs service to describe a job.
  *
  * @param[in] h runtime state handle
+ * @param[in] j the job, with its job ID
+ *
+ * @return true if libmosquitto accepted the publish message;
+ * false otherwise
+ *
+ * @note This does not call mosquitto_loop(); it expects main() to do so.
  */
-static void checkChild( handle_t * h );
+static bool sendDescribe( handle_t * h,
+                          job_t * j );
 
 /**
- * @brief Launch a download process.
+ * @brief Checks progress of a download, and sets the status update of its
+ * job.
  *
- * @param[in] h runtime state handle
+ * @param[in] j the job
+ */
+static void checkDownload( job_t * j );
+
+/**
+ * @brief Decode a SHA-256 checksum of a job document.
  *
- * @return true if fork() succeeded;
+ * @param[in] checksum the checksum, 64 hexadecimal digits
+ * @param[in] checksumLength size of the checksum string
+ * @param[out] digest the decoded digest, of JOB_DOWNLOAD_SHA256_LENGTH bytes
+ *
+ * @return true if the checksum is valid;
  * false otherwise
  */
-static bool download( handle_t * h );
+static bool parseChecksum( const char * checksum,
+                           size_t checksumLength,
+                           uint8_t * digest );
 
 /**
- * @brief Kill a download process.
+ * @brief Start a download.
  *
- * @param[in] h runtime state handle
+ * @param[in] j the job
+ *
+ * @return true if the download was queued, or should be retried later
+ * because the downloads of released jobs are still stopping, or the job
+ * failed because its checksum is invalid;
+ * false otherwise
  */
-static void cancelDownload( handle_t * h );
+static bool download( job_t * j );
+
+/**
+ * @brief Stop a download.
+ *
+ * @param[in] j the job
+ */
+static void cancelDownload( job_t * j );
 
 /**
  * @brief The libmosquitto callback for log messages.
@@ -419,6 +610,50 @@ static void teardown( int x,
  */
 #define makeReport_( x )    "{\"status\":\"" x "\"}"
 
+/**
+ * @brief Format a JSON status message with a detail.
+ *
+ * @param[in] x one of "IN_PROGRESS", "SUCCEEDED", or "FAILED"
+ * @param[in] key the key of the detail
+ * @param[in] value the value of the detail
+ */
+#define makeDetailedReport_( x, key, value ) \
+    "{\"status\":\"" x "\",\"statusDetails\":{\"" key "\":\"" value "\"}}"
+
+/**
+ * @brief Format a JSON status message of a download in progress, with
+ * its percentage and bytes received.
+ */
+#define progressReportFormat                \
+    "{\"status\":\"IN_PROGRESS\","         \
+    "\"statusDetails\":{\"progress\":\"%u%%\"," \
+    "\"bytesReceived\":\"%llu\"}}"
+
+/**
+ * @brief Describe a field of a job document.
+ *
+ * @param[in] key the key of the field, as for JSON_Search()
+ * @param[in] required whether a job document must have the field
+ */
+#define jobField_( key, required )    { key, sizeof( key ) - 1, required }
+
+/**
+ * @brief The fields of a job document, indexed by #jobField_t.
+ */
+static const struct
+{
+    const char * key;
+    size_t keyLength;
+    bool required;
+} jobFields[ JobFieldCount ] =
+{
+    jobField_( "execution.jobId",                 true  ),
+    jobField_( "execution.jobDocument.url",       true  ),
+    jobField_( "execution.jobDocument.checksum",  false ),
+    jobField_( "execution.jobDocument.size",      false ),
+    jobField_( "execution.jobDocument.operation", false )
+};
+
 /*-----------------------------------------------------------*/
 
 void initHandle( handle_t * p )
@@ -445,10 +680,14 @@ void initHandle( handle_t * p )
         h.capath = DEFAULT_CA_DIRECTORY;
     #endif
 
+    h.dlcafile = DOWNLOAD_CA_FILE;
+
     h.port = DEFAULT_MQTT_PORT;
 
     h.runOnce = false;
 
+    h.maxJobs = JOB_DOWNLOAD_MAX_DOWNLOADS;
+
     /* initialize to -1, set by on_connect() to 0 or greater */
     h.connectError = -1;
     /* initialize to -1, set by on_subscribe() to 0 or greater */
@@ -477,6 +716,7 @@ static bool requiredArgs( handle_t * h )
     checkString( host );
     checkString( certfile );
     checkString( keyfile );
+    checkString( dlcafile );
 
     if( h->nameLength > JOBS_THINGNAME_MAX_LENGTH )
     {
@@ -495,6 +735,7 @@ static bool requiredArgs( handle_t * h )
     checkPath( certfile );
     checkPath( keyfile );
     checkPath( cafile );
+    checkPath( dlcafile );
 
     checkPath( capath );
 
@@ -531,6 +772,7 @@ static bool parseArgs( handle_t * h,
         static struct option long_options[] =
         {
             { "once",      no_argument,       NULL, 'o' },
+            { "jobs",      required_argument, NULL, 'j' },
             { "name",      required_argument, NULL, 'n' },
             { "host",      required_argument, NULL, 'h' },
             { "port",      required_argument, NULL, 'p' },
@@ -538,13 +780,14 @@ static bool parseArgs( handle_t * h,
             { "capath",    required_argument, NULL, 'd' },
             { "certfile",  required_argument, NULL, 'c' },
             { "keyfile",   required_argument, NULL, 'k' },
+            { "dlcafile",  required_argument, NULL, 'F' },
             { "pollinv",   required_argument, NULL, 'P' },
             { "updateinv", required_argument, NULL, 'u' },
             { "help",      no_argument,       NULL, '?' },
             { NULL,        0,                 NULL, 0   }
         };
 
-        c = getopt_long( argc, argv, "on:h:p:P:u:f:d:c:k:?",
+        c = getopt_long( argc, argv, "oj:n:h:p:P:u:f:d:c:k:?",
                          long_options, &option_index );
 
         if( c == -1 )
@@ -584,6 +827,10 @@ static bool parseArgs( handle_t * h,
                 optargToInt( port, 0, 0xFFFF );
                 break;
 
+            case 'j':
+                optargToInt( maxJobs, 0, JOB_DOWNLOAD_MAX_DOWNLOADS );
+                break;
+
             case 'P':
                 optargToInt( pollinv, 0, INTERVAL_MAX );
                 break;
@@ -609,6 +856,10 @@ static bool parseArgs( handle_t * h,
                 h->keyfile = optarg;
                 break;
 
+            case 'F':
+                h->dlcafile = optarg;
+                break;
+
             case '?':
             default:
                 ret = false;
@@ -825,16 +1076,100 @@ static bool sendUpdate( handle_t * h,
 
 /*-----------------------------------------------------------*/
 
+static job_t * findJob( handle_t * h,
+                        const char * jobid,
+                        size_t jobidLength )
+{
+    job_t * ret = NULL;
+    size_t i;
+
+    assert( h != NULL );
+    assert( jobid != NULL );
+
+    for( i = 0; ( i < JOB_DOWNLOAD_MAX_DOWNLOADS ) && ( ret == NULL ); i++ )
+    {
+        if( ( h->jobs[ i ].jobid != NULL ) &&
+            ( h->jobs[ i ].jobidLength == jobidLength ) &&
+            ( strncmp( h->jobs[ i ].jobid, jobid, jobidLength ) == 0 ) )
+        {
+            ret = &h->jobs[ i ];
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static job_t * findFreeJob( handle_t * h )
+{
+    job_t * ret = NULL;
+    size_t i;
+
+    assert( h != NULL );
+
+    for( i = 0; ( i < h->maxJobs ) && ( ret == NULL ); i++ )
+    {
+        if( h->jobs[ i ].runStatus == None )
+        {
+            ret = &h->jobs[ i ];
+        }
+    }
+
+    if( ( h->runOnce == true ) && ( h->jobFinished == true ) )
+    {
+        ret = NULL;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void releaseJob( job_t * j )
+{
+    assert( j != NULL );
+
+    /* The parameters all live in the arena, so nothing is freed. */
+    memset( j, 0, sizeof( job_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static char * arenaCopy( job_t * j,
+                         const char * value,
+                         size_t valueLength )
+{
+    char * ret = NULL;
+
+    assert( j != NULL );
+    assert( value != NULL );
+
+    if( valueLength < ( sizeof( j->arena ) - j->arenaLength ) )
+    {
+        ret = &j->arena[ j->arenaLength ];
+        memcpy( ret, value, valueLength );
+        ret[ valueLength ] = '\0';
+        j->arenaLength += valueLength + 1U;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
 static bool parseJob( handle_t * h,
-                      const struct mosquitto_message * message )
+                      const struct mosquitto_message * message,
+                      JSONExtractQuery_t * fields )
 {
     bool ret = false;
     JSONStatus_t json_ret;
-    char * jobid = NULL, * url = NULL;
-    size_t jobidLength = 0, urlLength = 0;
+    char * jobid;
+    size_t i;
 
     assert( h != NULL );
     assert( message != NULL );
+    assert( fields != NULL );
     assert( ( message->payload != NULL ) && ( message->payloadlen > 0 ) );
 
     json_ret = JSON_Validate( message->payload, message->payloadlen );
@@ -845,47 +1180,239 @@ static bool parseJob( handle_t * h,
     }
     else
     {
-        json_ret = JSON_Search( message->payload,
-                                message->payloadlen,
-                                "execution.jobId",
-                                ( sizeof( "execution.jobId" ) - 1 ),
-                                &jobid,
-                                &jobidLength );
+        for( i = 0; i < JobFieldCount; i++ )
+        {
+            fields[ i ].pKey = jobFields[ i ].key;
+            fields[ i ].keyLength = jobFields[ i ].keyLength;
+        }
+
+        /* Find all fields in one pass over the document; the optional
+         * fields may be missing. */
+        ( void ) JSONExtract_Search( message->payload,
+                                     message->payloadlen,
+                                     fields,
+                                     JobFieldCount );
+
+        ret = true;
+
+        for( i = 0; i < JobFieldCount; i++ )
+        {
+            if( ( jobFields[ i ].required == true ) && ( fields[ i ].pValue == NULL ) )
+            {
+                ret = false;
+            }
+        }
+
+        if( ( ret == false ) && ( fields[ JobFieldId ].pValue != NULL ) )
+        {
+            /* The payload is writable. */
+            jobid = ( char * ) fields[ JobFieldId ].pValue;
+            jobid[ fields[ JobFieldId ].valueLength ] = '\0';
+            warnx( "missing a required field; failing job id: %s", jobid );
+            ( void ) sendUpdate( h, jobid, fields[ JobFieldId ].valueLength, makeReport_( "FAILED" ) );
+        }
     }
 
-    if( json_ret == JSONSuccess )
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void acceptJob( handle_t * h,
+                       const JSONExtractQuery_t * fields )
+{
+    job_t * j;
+    size_t i;
+    bool ret = true;
+
+    assert( h != NULL );
+    assert( ( fields != NULL ) && ( fields[ JobFieldId ].pValue != NULL ) );
+
+    j = findJob( h, fields[ JobFieldId ].pValue, fields[ JobFieldId ].valueLength );
+
+    if( j == NULL )
     {
-        json_ret = JSON_Search( message->payload,
-                                message->payloadlen,
-                                "execution.jobDocument.url",
-                                ( sizeof( "execution.jobDocument.url" ) - 1 ),
-                                &url,
-                                &urlLength );
+        j = findFreeJob( h );
     }
 
-    if( json_ret == JSONSuccess )
+    /* a job requested, or a new job while a job is not in use */
+    if( ( j != NULL ) && ( ( j->runStatus == None ) || ( j->runStatus == Requested ) ) )
     {
-        jobid = strndup( jobid, jobidLength );
-        url = strndup( url, urlLength );
-        assert( ( jobid != NULL ) && ( url != NULL ) );
-
-        h->jobid = jobid;
-        h->jobidLength = jobidLength;
-        h->url = url;
-        h->urlLength = urlLength;
-        ret = true;
+        releaseJob( j );
+
+        for( i = 0; ( i < JobFieldCount ) && ( ret == true ); i++ )
+        {
+            if( fields[ i ].pValue != NULL )
+            {
+                j->fields[ i ] = arenaCopy( j, fields[ i ].pValue, fields[ i ].valueLength );
+                j->fieldLengths[ i ] = fields[ i ].valueLength;
+                ret = ( j->fields[ i ] != NULL );
+            }
+        }
+
+        if( ret == true )
+        {
+            j->jobid = j->fields[ JobFieldId ];
+            j->jobidLength = j->fieldLengths[ JobFieldId ];
+            j->url = j->fields[ JobFieldUrl ];
+            j->urlLength = j->fieldLengths[ JobFieldUrl ];
+            j->runStatus = Ready;
+
+            /* The download connection is established while the job is
+             * reported and its directory created. */
+            JobDownload_Prewarm( j->url, j->urlLength );
+        }
+        else
+        {
+            warnx( "job document exceeds %u bytes", ( unsigned int ) JOB_ARENA_LENGTH );
+            ( void ) sendUpdate( h, ( char * ) fields[ JobFieldId ].pValue,
+                                 fields[ JobFieldId ].valueLength, makeReport_( "FAILED" ) );
+            releaseJob( j );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void parsePending( handle_t * h,
+                          const struct mosquitto_message * message )
+{
+    JSONStatus_t json_ret;
+    char query[ sizeof( "inProgressJobs[4294967295].jobId" ) ];
+    char * jobid;
+    size_t jobidLength, i, k;
+    job_t * j;
+    const char * lists[] = { "inProgressJobs", "queuedJobs" };
+
+    assert( h != NULL );
+    assert( message != NULL );
+
+    json_ret = JSON_Validate( message->payload, message->payloadlen );
+
+    if( json_ret != JSONSuccess )
+    {
+        warnx( "invalid list of pending jobs" );
     }
     else
     {
-        if( jobid != NULL )
+        /* The list replaces the queue, dropping the IDs of jobs since
+         * canceled. */
+        clearQueue( h );
+    }
+
+    /* The jobs in progress come first, such as the jobs of a previous run
+     * of the demo, then the queued jobs in the order they were queued. */
+    for( k = 0; ( k < ( sizeof( lists ) / sizeof( lists[ 0 ] ) ) ) && ( json_ret == JSONSuccess ); k++ )
+    {
+        for( i = 0; json_ret == JSONSuccess; i++ )
+        {
+            snprintf( query, sizeof( query ), "%s[%u].jobId", lists[ k ], ( unsigned int ) i );
+            json_ret = JSON_Search( message->payload,
+                                    message->payloadlen,
+                                    query,
+                                    strlen( query ),
+                                    &jobid,
+                                    &jobidLength );
+
+            if( json_ret == JSONSuccess )
+            {
+                j = findJob( h, jobid, jobidLength );
+
+                if( j == NULL )
+                {
+                    j = findFreeJob( h );
+
+                    if( j != NULL )
+                    {
+                        j->jobid = arenaCopy( j, jobid, jobidLength );
+                        assert( j->jobid != NULL );
+                        j->jobidLength = jobidLength;
+                        j->runStatus = Requested;
+                    }
+                    else
+                    {
+                        queueJob( h, jobid, jobidLength );
+                    }
+                }
+
+                /* A job requested before is requested again, in case
+                 * its response was lost. */
+                if( ( j != NULL ) && ( j->runStatus == Requested ) )
+                {
+                    info( "requesting job id: %s", j->jobid );
+                    ( void ) sendDescribe( h, j );
+                }
+            }
+        }
+
+        /* the end of the list */
+        if( json_ret == JSONNotFound )
         {
-            jobid[ jobidLength ] = '\0';
-            warnx( "missing url; failing job id: %s", jobid );
-            ( void ) sendUpdate( h, jobid, jobidLength, makeReport_( "FAILED" ) );
+            json_ret = JSONSuccess;
         }
     }
+}
 
-    return ret;
+/*-----------------------------------------------------------*/
+
+static void queueJob( handle_t * h,
+                      const char * jobid,
+                      size_t jobidLength )
+{
+    assert( h != NULL );
+    assert( jobid != NULL );
+
+    if( ( h->queueLength < JOB_QUEUE_LENGTH ) && ( jobidLength <= JOBS_JOBID_MAX_LENGTH ) )
+    {
+        memcpy( h->queue[ h->queueLength ], jobid, jobidLength );
+        h->queue[ h->queueLength ][ jobidLength ] = '\0';
+        h->queueLength++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void clearQueue( handle_t * h )
+{
+    assert( h != NULL );
+
+    h->queueLength = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void startQueuedJobs( handle_t * h )
+{
+    const char * jobid;
+    size_t jobidLength;
+    job_t * j;
+
+    assert( h != NULL );
+
+    j = findFreeJob( h );
+
+    while( ( h->queueLength > 0 ) && ( j != NULL ) )
+    {
+        /* take the oldest ID */
+        jobid = h->queue[ 0 ];
+        jobidLength = strlen( jobid );
+
+        /* The job may have started since, as the next job. */
+        if( findJob( h, jobid, jobidLength ) == NULL )
+        {
+            j->jobid = arenaCopy( j, jobid, jobidLength );
+            assert( j->jobid != NULL );
+            j->jobidLength = jobidLength;
+            j->runStatus = Requested;
+            info( "requesting queued job id: %s", j->jobid );
+            ( void ) sendDescribe( h, j );
+        }
+
+        h->queueLength--;
+        memmove( &h->queue[ 0 ], &h->queue[ 1 ], h->queueLength * sizeof( h->queue[ 0 ] ) );
+
+        j = findFreeJob( h );
+    }
 }
 
 /*-----------------------------------------------------------*/
@@ -899,6 +1426,9 @@ void on_message( struct mosquitto * m,
     JobsTopic_t api;
     char * jobid;
     uint16_t jobidLength;
+    JSONExtractQuery_t fields[ JobFieldCount ] = { 0 };
+    job_t * j = NULL;
+    size_t i;
 
     assert( h != NULL );
     assert( message->topic != NULL );
@@ -914,28 +1444,64 @@ void on_message( struct mosquitto * m,
     assert( ret != JobsBadParameter );
     ( void ) ret;
 
+    if( ( api == JobsDescribeSuccess ) || ( api == JobsDescribeFailed ) || ( api == JobsUpdateFailed ) )
+    {
+        j = findJob( h, jobid, jobidLength );
+    }
+
     switch( api )
     {
-        /* a job has been added or the current job was canceled */
+        /* a job has been added or a job was canceled */
         case JobsNextJobChanged:
-        /* response to a request to describe the next job */
+
+            /* An update of a canceled job is rejected, which cancels it. */
+            for( i = 0; i < JOB_DOWNLOAD_MAX_DOWNLOADS; i++ )
+            {
+                if( h->jobs[ i ].runStatus == Running )
+                {
+                    h->jobs[ i ].forceUpdate = true;
+                }
+            }
+
+            if( ( message->payloadlen > 0 ) && ( parseJob( h, message, fields ) == true ) )
+            {
+                acceptJob( h, fields );
+            }
+
+            /* The next job may already be running, while other jobs are
+             * pending. */
+            h->forcePrompt = true;
+            break;
+
+        /* response to a request for the pending jobs */
+        case JobsGetPendingSuccess:
+            parsePending( h, message );
+            break;
+
+        /* response to a request to describe a job */
         case JobsDescribeSuccess:
 
-            if( h->runStatus == Running )
+            if( ( j == NULL ) || ( j->runStatus != Requested ) )
             {
-                h->forceUpdate = true;
-                h->forcePrompt = true;
+                warnx( "unexpected message, topic: %s", message->topic );
             }
-            else if( h->runStatus == None )
+            else if( parseJob( h, message, fields ) == true )
             {
-                if( parseJob( h, message ) == true )
-                {
-                    h->runStatus = Ready;
-                }
+                acceptJob( h, fields );
             }
             else
             {
-                warnx( "unexpected message, topic: %s", message->topic );
+                releaseJob( j );
+            }
+
+            break;
+
+        /* The job was removed since it was listed. */
+        case JobsDescribeFailed:
+
+            if( ( j != NULL ) && ( j->runStatus == Requested ) )
+            {
+                releaseJob( j );
             }
 
             break;
@@ -943,12 +1509,9 @@ void on_message( struct mosquitto * m,
         /* The last update was rejected. */
         case JobsUpdateFailed:
 
-            if( ( h->runStatus == Running ) &&
-                ( h->jobid != NULL ) &&
-                ( h->jobidLength == jobidLength ) &&
-                ( strncmp( h->jobid, jobid, jobidLength ) == 0 ) )
+            if( ( j != NULL ) && ( j->runStatus == Running ) )
             {
-                h->runStatus = Cancel;
+                j->runStatus = Cancel;
             }
             else
             {
@@ -972,7 +1535,7 @@ void on_message( struct mosquitto * m,
 
 /*-----------------------------------------------------------*/
 
-static bool sendDescribeNext( handle_t * h )
+static bool sendGetPending( handle_t * h )
 {
     bool ret = true;
     JobsStatus_t jobs_ret;
@@ -981,14 +1544,12 @@ static bool sendDescribeNext( handle_t * h )
 
     assert( h != NULL );
 
-    /* populate the topic buffer for a DescribeJobExecution request */
-    jobs_ret = Jobs_Describe( topic,
-                              sizeof( topic ),
-                              h->name,
-                              h->nameLength,
-                              JOBS_API_JOBID_NEXT,
-                              JOBS_API_JOBID_NEXT_LENGTH,
-                              NULL );
+    /* populate the topic buffer for a GetPendingJobExecutions request */
+    jobs_ret = Jobs_GetPending( topic,
+                                sizeof( topic ),
+                                h->name,
+                                h->nameLength,
+                                NULL );
     assert( jobs_ret == JobsSuccess );
     ( void ) jobs_ret;
 
@@ -996,7 +1557,7 @@ static bool sendDescribeNext( handle_t * h )
 
     if( m_ret != MOSQ_ERR_SUCCESS )
     {
-        warnx( "sendDescribeNext: %s", mosquitto_strerror( ret ) );
+        warnx( "sendGetPending: %s", mosquitto_strerror( m_ret ) );
         ret = false;
     }
 
@@ -1005,120 +1566,247 @@ static bool sendDescribeNext( handle_t * h )
 
 /*-----------------------------------------------------------*/
 
-static void checkChild( handle_t * h )
+static bool sendDescribe( handle_t * h,
+                          job_t * j )
 {
-    pid_t pid;
-    int status;
+    bool ret = true;
+    JobsStatus_t jobs_ret;
+    int m_ret;
+    char topic[ JOBS_API_MAX_LENGTH( JOBS_THINGNAME_MAX_LENGTH ) ];
 
     assert( h != NULL );
-    assert( h->child > 0 );
+    assert( ( j != NULL ) && ( j->jobid != NULL ) );
 
-    /* Has the download process exited? */
-    pid = waitpid( h->child, &status, WNOHANG );
-    assert( pid != -1 );
+    /* populate the topic buffer for a DescribeJobExecution request */
+    jobs_ret = Jobs_Describe( topic,
+                              sizeof( topic ),
+                              h->name,
+                              h->nameLength,
+                              j->jobid,
+                              j->jobidLength,
+                              NULL );
 
-    switch( pid )
+    if( jobs_ret != JobsSuccess )
+    {
+        warnx( "invalid job id: %s", j->jobid );
+        ret = false;
+    }
+    else
+    {
+        m_ret = mosquitto_publish( h->m, NULL, topic, 0, NULL, MQTT_QOS, false );
+
+        if( m_ret != MOSQ_ERR_SUCCESS )
+        {
+            warnx( "sendDescribe: %s", mosquitto_strerror( m_ret ) );
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void checkDownload( job_t * j )
+{
+    JobDownloadStatus_t ret;
+    JobDownloadProgress_t progress;
+    unsigned int percent = 0;
+
+    assert( j != NULL );
+
+    ret = JobDownload_GetProgress( j->downloadId, &progress );
+    assert( ret == JOB_DOWNLOAD_SUCCESS );
+    ( void ) ret;
+
+    switch( progress.state )
     {
         /* still running */
-        case 0:
-            h->report = makeReport_( "IN_PROGRESS" );
+        case JobDownloadQueued:
+        case JobDownloadRunning:
+
+            if( progress.contentLength > 0 )
+            {
+                percent = ( unsigned int ) ( ( progress.bytesReceived * 100U ) / progress.contentLength );
+            }
+
+            snprintf( j->report, sizeof( j->report ), progressReportFormat,
+                      percent, ( unsigned long long ) progress.bytesReceived );
             break;
 
-        /* exited */
+        /* finished */
         default:
 
-            /* process exit status 0 means success */
-            if( ( pid == h->child ) &&
-                ( WIFEXITED( status ) ) &&
-                ( WEXITSTATUS( status ) == 0 ) )
+            if( ( progress.state == JobDownloadSucceeded ) &&
+                ( progress.verification == JobDownloadVerified ) )
+            {
+                info( "completed and verified job id: %s", j->jobid );
+                snprintf( j->report, sizeof( j->report ), "%s", makeDetailedReport_( "SUCCEEDED", "sha256", "verified" ) );
+            }
+            else if( progress.state == JobDownloadSucceeded )
+            {
+                info( "completed job id: %s", j->jobid );
+                snprintf( j->report, sizeof( j->report ), "%s", makeReport_( "SUCCEEDED" ) );
+            }
+            else if( progress.verification == JobDownloadDigestMismatch )
             {
-                info( "completed job id: %s", h->jobid );
-                h->report = makeReport_( "SUCCEEDED" );
+                info( "checksum mismatch, failed job id: %s", j->jobid );
+                snprintf( j->report, sizeof( j->report ), "%s", makeDetailedReport_( "FAILED", "sha256", "mismatch" ) );
             }
             else
             {
-                info( "failed job id: %s", h->jobid );
-                h->report = makeReport_( "FAILED" );
+                info( "failed job id: %s", j->jobid );
+                snprintf( j->report, sizeof( j->report ), "%s", makeReport_( "FAILED" ) );
             }
 
-            h->child = 0;
-            h->runStatus = None;
+            JobDownload_Release( j->downloadId );
+            j->runStatus = None;
     }
 }
 
 /*-----------------------------------------------------------*/
 
-static bool download( handle_t * h )
+static bool parseChecksum( const char * checksum,
+                           size_t checksumLength,
+                           uint8_t * digest )
 {
-    bool ret = true;
-    pid_t pid;
-
-    assert( h != NULL );
-    assert( h->jobid != NULL );
-    assert( h->url != NULL );
-
-    /* run download as a separate process */
-    pid = fork();
+    bool ret = ( checksumLength == ( JOB_DOWNLOAD_SHA256_LENGTH * 2U ) );
+    size_t i;
+    int c, nibble = 0;
 
-#define dir_format    "%s/job-%s.XXXXXX"
+    assert( checksum != NULL );
+    assert( digest != NULL );
 
-    if( pid == 0 )
+    for( i = 0; ( i < checksumLength ) && ( ret == true ); i++ )
     {
-        /* create a unique download directory */
-        char dir_name[ sizeof( DESTINATION_PREFIX ) + h->jobidLength + sizeof( dir_format ) ];
+        c = tolower( ( unsigned char ) checksum[ i ] );
 
-        snprintf( dir_name, sizeof( dir_name ), dir_format, DESTINATION_PREFIX, h->jobid );
-
-        if( mkdtemp( dir_name ) == NULL )
+        if( ( c >= '0' ) && ( c <= '9' ) )
+        {
+            nibble = c - '0';
+        }
+        else if( ( c >= 'a' ) && ( c <= 'f' ) )
         {
-            err( 1, "mkdtemp %s", dir_name );
+            nibble = c - 'a' + 10;
+        }
+        else
+        {
+            ret = false;
         }
 
-        if( chdir( dir_name ) == -1 )
+        if( ( i % 2U ) == 0U )
+        {
+            digest[ i / 2U ] = ( uint8_t ) ( nibble << 4 );
+        }
+        else
         {
-            err( 1, "chdir %s", dir_name );
+            digest[ i / 2U ] |= ( uint8_t ) nibble;
         }
+    }
 
-        info( "download directory: %s", dir_name );
+    return ret;
+}
 
-        /* exec the download program */
-        CURL( h->url );
-        /* arrive here only if exec failed */
-        err( 1, "execl:" );
-    }
+/*-----------------------------------------------------------*/
+
+static bool download( job_t * j )
+{
+    bool ret = true;
+    JobDownloadStatus_t dl_ret;
+    uint8_t digest[ JOB_DOWNLOAD_SHA256_LENGTH ];
+    const uint8_t * sha256 = NULL;
+    ParsedUrl_t parsedUrl;
+    const char * name = DEFAULT_FILE_NAME;
+    size_t nameLength = sizeof( DEFAULT_FILE_NAME ) - 1, i;
 
-    free( h->url );
-    h->url = NULL;
-    h->child = pid;
+    assert( j != NULL );
+    assert( j->jobid != NULL );
+    assert( j->url != NULL );
+
+#define dir_format    "%s/job-%s.XXXXXX"
 
-    if( pid == -1 )
+    /* create a unique download directory */
+    char dir_name[ sizeof( DESTINATION_PREFIX ) + j->jobidLength + sizeof( dir_format ) ];
+    char file_name[ sizeof( dir_name ) + 1 + j->urlLength + sizeof( DEFAULT_FILE_NAME ) ];
+
+    snprintf( dir_name, sizeof( dir_name ), dir_format, DESTINATION_PREFIX, j->jobid );
+
+    if( mkdtemp( dir_name ) == NULL )
     {
-        warn( "fork" );
+        warn( "mkdtemp %s", dir_name );
         ret = false;
     }
 
-    return ret;
-}
+    /* name the file after the last segment of the URL path, as curl -O
+     * does; an invalid URL fails the download */
+    if( ( ret == true ) && ( parseUrl( j->url, j->urlLength, &parsedUrl ) == HTTPSuccess ) )
+    {
+        for( i = parsedUrl.path.offset + parsedUrl.path.length; i > parsedUrl.path.offset; i-- )
+        {
+            if( j->url[ i - 1 ] == '/' )
+            {
+                break;
+            }
+        }
 
-/*-----------------------------------------------------------*/
+        if( i < ( parsedUrl.path.offset + parsedUrl.path.length ) )
+        {
+            name = &j->url[ i ];
+            nameLength = parsedUrl.path.offset + parsedUrl.path.length - i;
+        }
+    }
 
-static void cancelDownload( handle_t * h )
-{
-    assert( h != NULL );
+    /* The checksum, when the job document has one, is verified as the
+     * file is downloaded. */
+    if( ( ret == true ) && ( j->fields[ JobFieldChecksum ] != NULL ) )
+    {
+        if( parseChecksum( j->fields[ JobFieldChecksum ], j->fieldLengths[ JobFieldChecksum ], digest ) == true )
+        {
+            sha256 = digest;
+        }
+        else
+        {
+            warnx( "invalid sha256 checksum; failing job id: %s", j->jobid );
+            snprintf( j->report, sizeof( j->report ), "%s", makeDetailedReport_( "FAILED", "sha256", "invalid" ) );
+            ( void ) rmdir( dir_name );
+            j->runStatus = None;
+        }
+    }
 
-    if( h->child > 0 )
+    if( ( ret == true ) && ( j->runStatus == Ready ) )
     {
-        int ret = kill( h->child, SIGKILL );
-        assert( ( ret == 0 ) || ( errno == ESRCH ) );
+        snprintf( file_name, sizeof( file_name ), "%s/%.*s", dir_name, ( int ) nameLength, name );
+        info( "download directory: %s", dir_name );
 
-        if( ret == 0 )
+        dl_ret = JobDownload_Start( j->url, j->urlLength, file_name, sha256, &j->downloadId );
+
+        if( dl_ret == JOB_DOWNLOAD_FULL )
+        {
+            /* The downloads of canceled jobs are stopping; retry later. */
+            info( "waiting for a download to stop for job id: %s", j->jobid );
+            ( void ) rmdir( dir_name );
+        }
+        else if( dl_ret != JOB_DOWNLOAD_SUCCESS )
         {
-            /* discard the download process exit status */
-            ( void ) wait( NULL );
+            ret = false;
+        }
+        else
+        {
+            j->runStatus = Running;
         }
     }
 
-    h->child = 0;
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void cancelDownload( job_t * j )
+{
+    assert( j != NULL );
+
+    /* The download stops in its thread; the file is left in place. */
+    JobDownload_Release( j->downloadId );
 }
 
 /*-----------------------------------------------------------*/
@@ -1165,7 +1853,7 @@ static bool setup( handle_t * h )
         mosquitto_connect_callback_set( h->m, on_connect );
         mosquitto_subscribe_callback_set( h->m, on_subscribe );
         mosquitto_message_callback_set( h->m, on_message );
-        ret = true;
+        ret = ( JobDownload_Init( h->dlcafile ) == JOB_DOWNLOAD_SUCCESS ) ? true : false;
     }
 
     return ret;
@@ -1178,19 +1866,19 @@ static void teardown( int x,
 {
     handle_t * h = p;
 
+    size_t i;
+
     assert( h != NULL );
 
-    if( h->url != NULL )
+    for( i = 0; i < JOB_DOWNLOAD_MAX_DOWNLOADS; i++ )
     {
-        free( h->url );
+        releaseJob( &h->jobs[ i ] );
     }
 
-    if( h->jobid != NULL )
-    {
-        free( h->jobid );
-    }
+    clearQueue( h );
 
-    cancelDownload( h );
+    /* stop the downloads */
+    JobDownload_Deinit();
     closeConnection( h );
     mosquitto_destroy( h->m );
     mosquitto_lib_cleanup();
@@ -1223,21 +1911,30 @@ int main( int argc,
         errx( 1, "fatal error" );
     }
 
-    info( "requesting first job" );
+    info( "requesting first jobs" );
 
-    if( sendDescribeNext( h ) == false )
+    if( sendGetPending( h ) == false )
     {
         errx( 1, "fatal error" );
     }
 
     h->lastPrompt = time( NULL );
+    h->lastUpdate = h->lastPrompt;
 
     while( 1 )
     {
-        bool ret = true;
+        bool ret = true, inUse = false, running = false, updateDue;
         int m_ret;
+        size_t i, k;
+        job_t * j;
 
-        m_ret = mosquitto_loop( h->m, MQTT_WAIT_TIME, 1 );
+        for( i = 0; i < JOB_DOWNLOAD_MAX_DOWNLOADS; i++ )
+        {
+            running = running || ( h->jobs[ i ].runStatus == Running );
+        }
+
+        /* wake up often enough to notice the downloads finishing */
+        m_ret = mosquitto_loop( h->m, ( running == true ) ? MQTT_SHORT_WAIT_TIME : MQTT_WAIT_TIME, 1 );
 
         if( m_ret != MOSQ_ERR_SUCCESS )
         {
@@ -1246,57 +1943,102 @@ int main( int argc,
 
         now = time( NULL );
 
-        switch( h->runStatus )
-        {
-            case None:
+        /* the queued jobs start before more jobs are requested */
+        startQueuedJobs( h );
 
-                if( ( h->forcePrompt == true ) ||
-                    ( ( h->pollinv != 0 ) && ( now > ( h->lastPrompt + h->pollinv ) ) ) )
-                {
-                    h->lastPrompt = now;
-                    info( "requesting job" );
-                    ret = sendDescribeNext( h );
-                    h->forcePrompt = false;
-                }
-
-                break;
+        /* request more jobs while a job is not in use */
+        if( ( findFreeJob( h ) != NULL ) &&
+            ( ( h->forcePrompt == true ) ||
+              ( ( h->pollinv != 0 ) && ( now > ( h->lastPrompt + h->pollinv ) ) ) ) )
+        {
+            h->lastPrompt = now;
+            info( "requesting jobs" );
+            ret = sendGetPending( h );
+            h->forcePrompt = false;
+        }
 
-            case Ready:
-                info( "starting job id: %s", h->jobid );
-                ret = download( h );
+        /* The periodic updates of all running jobs are sent together. */
+        updateDue = ( h->updateinv != 0 ) && ( now > ( h->lastUpdate + h->updateinv ) );
 
-                if( ret == true )
-                {
-                    h->runStatus = Running;
-                    info( "sending first update" );
-                    checkChild( h );
-                    ret = sendUpdate( h, h->jobid, h->jobidLength, h->report );
-                    h->lastUpdate = now;
-                }
+        if( updateDue == true )
+        {
+            h->lastUpdate = now;
+        }
 
-                break;
+        for( i = 0; ( i < JOB_DOWNLOAD_MAX_DOWNLOADS ) && ( ret == true ); i++ )
+        {
+            j = &h->jobs[ i ];
 
-            case Running:
+            /* start no job after the first job is finished */
+            if( ( h->runOnce == true ) && ( h->jobFinished == true ) &&
+                ( ( j->runStatus == Requested ) || ( j->runStatus == Ready ) ) )
+            {
+                releaseJob( j );
+            }
 
-                checkChild( h );
+            switch( j->runStatus )
+            {
+                case None:
+                case Requested:
+                    break;
+
+                case Ready:
+                    info( "starting job id: %s", j->jobid );
+
+                    for( k = JobFieldChecksum; k < JobFieldCount; k++ )
+                    {
+                        if( j->fields[ k ] != NULL )
+                        {
+                            info( "job %s: %s", jobFields[ k ].key, j->fields[ k ] );
+                        }
+                    }
+                    ret = download( j );
+
+                    if( ( ret == true ) && ( j->runStatus == Running ) )
+                    {
+                        info( "sending first update" );
+                        checkDownload( j );
+                        ret = sendUpdate( h, j->jobid, j->jobidLength, j->report );
+                    }
+                    else if( ( ret == true ) && ( j->runStatus == None ) )
+                    {
+                        ret = sendUpdate( h, j->jobid, j->jobidLength, j->report );
+                    }
+
+                    break;
+
+                case Running:
+
+                    checkDownload( j );
+
+                    /* send an update if the job finished, was "force" canceled, or a periodic update is due */
+                    if( ( j->runStatus == None ) ||
+                        ( j->forceUpdate == true ) ||
+                        ( updateDue == true ) )
+                    {
+                        info( "updating job id: %s", j->jobid );
+                        ret = sendUpdate( h, j->jobid, j->jobidLength, j->report );
+                        j->forceUpdate = false;
+                    }
+
+                    break;
+
+                case Cancel:
+                    info( "canceled job id: %s", j->jobid );
+                    cancelDownload( j );
+                    j->runStatus = None;
+            }
 
-                /* send an update if the job exited, was "force" canceled, or a periodic update is due */
-                if( ( h->runStatus == None ) ||
-                    ( h->forceUpdate == true ) ||
-                    ( ( h->updateinv != 0 ) && ( now > ( h->lastUpdate + h->updateinv ) ) ) )
-                {
-                    info( "updating job id: %s", h->jobid );
-                    ret = sendUpdate( h, h->jobid, h->jobidLength, h->report );
-                    h->lastUpdate = now;
-                    h->forceUpdate = false;
-                }
+            if( ( j->runStatus == None ) && ( j->jobid != NULL ) )
+            {
+                releaseJob( j );
+                h->jobFinished = true;
 
-                break;
+                /* other jobs may be pending */
+                h->forcePrompt = true;
+            }
 
-            case Cancel:
-                info( "canceled job id: %s", h->jobid );
-                cancelDownload( h );
-                h->runStatus = None;
+            inUse = inUse || ( j->runStatus != None );
         }
 
         if( ret == false )
@@ -1304,16 +2046,9 @@ int main( int argc,
             errx( 1, "fatal error" );
         }
 
-        if( ( h->runStatus == None ) && ( h->jobid != NULL ) )
+        if( ( h->runOnce == true ) && ( h->jobFinished == true ) && ( inUse == false ) )
         {
-            free( h->jobid );
-            h->jobid = NULL;
-            h->jobidLength = 0;
-
-            if( h->runOnce == true )
-            {
-                break;
-            }
+            break;
         }
     }
 
@@ -0,0 +1,11 @@
+# This file is to add source files and include directories
+# into variables so that it can be reused from different demos
+# in their Cmake based build system by including this file.
+
+# Single pass JSON key extraction source files.
+set( JSON_EXTRACT_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/json_extract.c )
+
+# Single pass JSON key extraction include directories.
+set( JSON_EXTRACT_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
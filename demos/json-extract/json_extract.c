@@ -0,0 +1,219 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file json_extract.c
+ * @brief Extraction of several keys from a JSON document in a single pass.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "json_extract.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief An object being iterated, on the path of the keys still searched.
+ */
+typedef struct ObjectFrame
+{
+    const char * pObject; /**< @brief The object, from its opening brace. */
+    size_t objectLength;  /**< @brief Length of the object. */
+    size_t start;         /**< @brief Start index for #JSON_Iterate. */
+    size_t next;          /**< @brief Next index for #JSON_Iterate. */
+    const char * pPath;   /**< @brief Key of a query starting with the path of the object. */
+    size_t pathLength;    /**< @brief Length of the path of the object, with its trailing '.'; 0 for the document. */
+} ObjectFrame_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Match a key-value pair of an object against the queries not found
+ * yet.
+ *
+ * @param[in] pFrame The object holding the pair.
+ * @param[in] pPair The pair.
+ * @param[in,out] pQueries The queries, whose values are set when their key
+ * is the pair.
+ * @param[in] queryCount Number of entries of @p pQueries.
+ * @param[out] pOutChildPath Key of a query within the value of the pair, if
+ * any; NULL otherwise.
+ *
+ * @return Number of queries found.
+ */
+static size_t matchPair( const ObjectFrame_t * pFrame,
+                         const JSONPair_t * pPair,
+                         JSONExtractQuery_t * pQueries,
+                         size_t queryCount,
+                         const char ** pOutChildPath );
+
+/*-----------------------------------------------------------*/
+
+static size_t matchPair( const ObjectFrame_t * pFrame,
+                         const JSONPair_t * pPair,
+                         JSONExtractQuery_t * pQueries,
+                         size_t queryCount,
+                         const char ** pOutChildPath )
+{
+    size_t i, foundCount = 0U, restLength;
+    const char * pRest = NULL;
+
+    *pOutChildPath = NULL;
+
+    for( i = 0U; i < queryCount; i++ )
+    {
+        /* Only the queries below the path of the object, and not found yet,
+         * can match. */
+        if( ( pQueries[ i ].pValue == NULL ) &&
+            ( pQueries[ i ].keyLength > pFrame->pathLength ) &&
+            ( memcmp( pQueries[ i ].pKey, pFrame->pPath, pFrame->pathLength ) == 0 ) )
+        {
+            pRest = &( pQueries[ i ].pKey[ pFrame->pathLength ] );
+            restLength = pQueries[ i ].keyLength - pFrame->pathLength;
+
+            if( ( restLength >= pPair->keyLength ) &&
+                ( memcmp( pRest, pPair->key, pPair->keyLength ) == 0 ) )
+            {
+                if( restLength == pPair->keyLength )
+                {
+                    pQueries[ i ].pValue = pPair->value;
+                    pQueries[ i ].valueLength = pPair->valueLength;
+                    pQueries[ i ].valueType = pPair->jsonType;
+                    foundCount++;
+                }
+                else if( ( pRest[ pPair->keyLength ] == '.' ) &&
+                         ( pPair->jsonType == JSONObject ) )
+                {
+                    *pOutChildPath = pQueries[ i ].pKey;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+        }
+    }
+
+    return foundCount;
+}
+
+/*-----------------------------------------------------------*/
+
+JSONStatus_t JSONExtract_Search( const char * pBuffer,
+                                 size_t bufferLength,
+                                 JSONExtractQuery_t * pQueries,
+                                 size_t queryCount )
+{
+    JSONStatus_t status = JSONSuccess, iterateStatus = JSONSuccess;
+    ObjectFrame_t frames[ JSON_EXTRACT_MAX_DEPTH ];
+    JSONPair_t pair = { 0 };
+    const char * pChildPath = NULL;
+    size_t i, depth = 0U, remainingCount = queryCount;
+
+    if( ( pBuffer == NULL ) || ( ( pQueries == NULL ) && ( queryCount > 0U ) ) )
+    {
+        status = JSONNullParameter;
+    }
+    else if( bufferLength == 0U )
+    {
+        status = JSONBadParameter;
+    }
+    else
+    {
+        for( i = 0U; ( i < queryCount ) && ( status == JSONSuccess ); i++ )
+        {
+            if( ( pQueries[ i ].pKey == NULL ) || ( pQueries[ i ].keyLength == 0U ) )
+            {
+                status = JSONBadParameter;
+            }
+            else
+            {
+                pQueries[ i ].pValue = NULL;
+                pQueries[ i ].valueLength = 0U;
+                pQueries[ i ].valueType = JSONInvalid;
+            }
+        }
+    }
+
+    if( status == JSONSuccess )
+    {
+        frames[ 0 ].pObject = pBuffer;
+        frames[ 0 ].objectLength = bufferLength;
+        frames[ 0 ].start = 0U;
+        frames[ 0 ].next = 0U;
+        frames[ 0 ].pPath = "";
+        frames[ 0 ].pathLength = 0U;
+        depth = 1U;
+    }
+
+    /* Walk the document depth first, without recursing, entering only the
+     * objects on the path of a query, until every query is found. */
+    while( ( status == JSONSuccess ) && ( depth > 0U ) && ( remainingCount > 0U ) )
+    {
+        iterateStatus = JSON_Iterate( frames[ depth - 1U ].pObject,
+                                      frames[ depth - 1U ].objectLength,
+                                      &( frames[ depth - 1U ].start ),
+                                      &( frames[ depth - 1U ].next ),
+                                      &( pair ) );
+
+        if( iterateStatus == JSONSuccess )
+        {
+            /* Arrays hold no keys to match. */
+            if( pair.key != NULL )
+            {
+                remainingCount -= matchPair( &( frames[ depth - 1U ] ), &( pair ),
+                                             pQueries, queryCount, &( pChildPath ) );
+
+                if( ( pChildPath != NULL ) && ( depth < JSON_EXTRACT_MAX_DEPTH ) )
+                {
+                    frames[ depth ].pObject = pair.value;
+                    frames[ depth ].objectLength = pair.valueLength;
+                    frames[ depth ].start = 0U;
+                    frames[ depth ].next = 0U;
+                    frames[ depth ].pPath = pChildPath;
+                    frames[ depth ].pathLength = frames[ depth - 1U ].pathLength + pair.keyLength + 1U;
+                    depth++;
+                }
+            }
+        }
+        else if( ( iterateStatus == JSONNotFound ) || ( depth > 1U ) )
+        {
+            /* The object is done; resume its parent. */
+            depth--;
+        }
+        else
+        {
+            /* The document itself is not an object. */
+            status = iterateStatus;
+        }
+    }
+
+    if( ( status == JSONSuccess ) && ( remainingCount > 0U ) )
+    {
+        status = JSONNotFound;
+    }
+
+    return status;
+}
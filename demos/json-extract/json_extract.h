@@ -0,0 +1,90 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file json_extract.h
+ * @brief Extraction of several keys from a JSON document in a single pass.
+ *
+ * #JSON_Search scans the document from its start for every key, so fetching
+ * K keys costs K scans. #JSONExtract_Search walks the document once with
+ * #JSON_Iterate, entering only the objects on the path of a requested key,
+ * and stops as soon as every key is found.
+ */
+
+#ifndef JSON_EXTRACT_H_
+#define JSON_EXTRACT_H_
+
+/* Standard includes. */
+#include <stddef.h>
+
+/* JSON library include. */
+#include "core_json.h"
+
+/**
+ * @brief Maximum number of nested objects on the path of a key.
+ *
+ * "state.reported.powerOn" is on a path of 3 objects: the document, "state"
+ * and "reported". Keys nested deeper are not found.
+ */
+#ifndef JSON_EXTRACT_MAX_DEPTH
+    #define JSON_EXTRACT_MAX_DEPTH    ( 8U )
+#endif
+
+/**
+ * @brief A key to extract, and its value once found.
+ *
+ * The application sets #JSONExtractQuery_t.pKey and
+ * #JSONExtractQuery_t.keyLength; the other members are set by
+ * #JSONExtract_Search.
+ */
+typedef struct JSONExtractQuery
+{
+    const char * pKey;      /**< @brief Key of the value, with '.' separating the keys of nested objects, as for #JSON_Search. */
+    size_t keyLength;       /**< @brief Length of #JSONExtractQuery_t.pKey. */
+    const char * pValue;    /**< @brief Value in the document, without the quotes of a string; NULL if the key is not found. */
+    size_t valueLength;     /**< @brief Length of #JSONExtractQuery_t.pValue. */
+    JSONTypes_t valueType;  /**< @brief Type of the value found. */
+} JSONExtractQuery_t;
+
+/**
+ * @brief Find the values of several keys of a JSON document in one pass.
+ *
+ * Unlike #JSON_Search, the keys cannot index arrays. When an object has the
+ * same key more than once, the first value is kept, as #JSON_Search does.
+ *
+ * @param[in] pBuffer The JSON document. It must have been checked with
+ * #JSON_Validate.
+ * @param[in] bufferLength Length of @p pBuffer.
+ * @param[in,out] pQueries The keys to find.
+ * @param[in] queryCount Number of entries of @p pQueries.
+ *
+ * @return #JSONSuccess if every key is found; #JSONNotFound if any is not,
+ * in which case the values of the keys found are still set;
+ * #JSONNullParameter or #JSONBadParameter if the parameters are invalid;
+ * #JSONIllegalDocument if the document is not an object.
+ */
+JSONStatus_t JSONExtract_Search( const char * pBuffer,
+                                 size_t bufferLength,
+                                 JSONExtractQuery_t * pQueries,
+                                 size_t queryCount );
+
+#endif /* ifndef JSON_EXTRACT_H_ */
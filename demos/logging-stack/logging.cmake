@@ -1,3 +1,15 @@
 # Configuration for logging.
 set( LOGGING_INCLUDE_DIRS
-     ${CMAKE_CURRENT_LIST_DIR} )
\ No newline at end of file
+     ${CMAKE_CURRENT_LIST_DIR} )
+
+# Sources of the deferred logging backend, used when LOGGING_STACK_DEFERRED is 1.
+set( LOGGING_DEFERRED_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/logging_stack_deferred.c )
+
+# Sources of the single write logging backends, used when LOGGING_STACK_SINGLE_WRITE or LOGGING_STACK_JSON is 1.
+set( LOGGING_SINGLE_WRITE_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/logging_stack_print.c )
+
+# Sources of the runtime log levels, used when LOGGING_STACK_RUNTIME_LEVEL is 1.
+set( LOGGING_RUNTIME_LEVEL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/logging_stack_level.c )
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 /* The macro definition for LIBRARY_LOG_NAME is for Doxygen
  * documentation only. This macro is typically defined in only the
@@ -63,7 +64,11 @@
  * @brief Macro to extract only the file name from file path to use for metadata in
  * log messages.
  */
-#define FILENAME               ( strrchr( __FILE__, '/' ) ? strrchr( __FILE__, '/' ) + 1 : __FILE__ )
+#ifdef __FILE_NAME__
+    #define FILENAME           __FILE_NAME__
+#else
+    #define FILENAME           ( strrchr( __FILE__, '/' ) ? strrchr( __FILE__, '/' ) + 1 : __FILE__ )
+#endif
 
 /* Metadata information to prepend to every log message. */
 #define LOG_METADATA_FORMAT    "[%s] [%s:%d] "                      /**< @brief Format of metadata prefix in log messages as `[<Logging-Level>] [<Library-Name>] [<File-Name>:<Line-Number>]` */
@@ -84,6 +89,145 @@
     #define SdkLog( string )
 #endif
 
+/**
+ * @brief Set this to 1 to record log messages for a formatter thread instead
+ * of printing them from the logging thread.
+ *
+ * The deferred backend is implemented in logging_stack_deferred.c, which must
+ * then be linked. Refer to logging_stack_deferred.h.
+ */
+#ifndef LOGGING_STACK_DEFERRED
+    #define LOGGING_STACK_DEFERRED    ( 0 )
+#endif
+
+/**
+ * @brief Set this to 1 to print each log message, with its metadata prefix and
+ * line ending, in a single write.
+ *
+ * The backend is implemented in logging_stack_print.c, which must then be
+ * linked. Refer to logging_stack_print.h. #LOGGING_STACK_DEFERRED takes
+ * precedence.
+ */
+#ifndef LOGGING_STACK_SINGLE_WRITE
+    #define LOGGING_STACK_SINGLE_WRITE    ( 0 )
+#endif
+
+/**
+ * @brief Set this to 1 to print each log message as a JSON object on a line
+ * of its own, with a timestamp, a thread number and an ID of the log
+ * statement.
+ *
+ * The backend is implemented in logging_stack_print.c, which must then be
+ * linked. Refer to logging_stack_print.h. #LOGGING_STACK_DEFERRED takes
+ * precedence, and this takes precedence over #LOGGING_STACK_SINGLE_WRITE.
+ */
+#ifndef LOGGING_STACK_JSON
+    #define LOGGING_STACK_JSON    ( 0 )
+#endif
+
+/**
+ * @brief Removes the parentheses around the arguments of a logging macro.
+ */
+#define LOGGING_STACK_ARGUMENTS( ... )    __VA_ARGS__
+
+#if ( LOGGING_STACK_DEFERRED == 1 ) && !defined( DISABLE_LOGGING )
+    #include "logging_stack_deferred.h"
+
+/**
+ * @brief Records a log message with the deferred backend.
+ *
+ * @param[in] level The level prefix, such as "[INFO]".
+ * @param[in] message The parenthesized format and arguments.
+ */
+    #define SdkLogMessage( level, message )                                                      \
+    do {                                                                                         \
+        static LoggingStackSite_t loggingStackSite = LOGGING_STACK_SITE( level, LIBRARY_LOG_NAME ); \
+        LoggingStack_Record( &loggingStackSite, LOGGING_STACK_ARGUMENTS message );               \
+    } while( 0 )
+#elif ( LOGGING_STACK_JSON == 1 ) && !defined( DISABLE_LOGGING )
+    #include "logging_stack_print.h"
+
+/**
+ * @brief Prints a log message as a JSON object.
+ *
+ * @param[in] level The level prefix, such as "[INFO]".
+ * @param[in] message The parenthesized format and arguments.
+ */
+    #define SdkLogMessage( level, message )                                                                  \
+    do {                                                                                                     \
+        static LoggingStackJsonSite_t loggingStackJsonSite = LOGGING_STACK_JSON_SITE( level, LIBRARY_LOG_NAME ); \
+        LoggingStack_PrintJson( &loggingStackJsonSite, LOGGING_STACK_ARGUMENTS message );                    \
+    } while( 0 )
+#elif ( LOGGING_STACK_SINGLE_WRITE == 1 ) && !defined( DISABLE_LOGGING )
+    #include "logging_stack_print.h"
+
+/**
+ * @brief Prints a log message in a single write.
+ *
+ * @param[in] level The level prefix, such as "[INFO]".
+ * @param[in] message The parenthesized format and arguments.
+ */
+    #define SdkLogMessage( level, message )    LoggingStack_Print( level, LIBRARY_LOG_NAME, FILENAME, __LINE__, LOGGING_STACK_ARGUMENTS message )
+#else
+
+/**
+ * @brief Prints a log message with its metadata prefix and line ending.
+ *
+ * @param[in] level The level prefix, such as "[INFO]".
+ * @param[in] message The parenthesized format and arguments.
+ */
+    #define SdkLogMessage( level, message )    SdkLog( ( level " " LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+#endif
+
+/**
+ * @brief Set this to 1 to also check a level per #LIBRARY_LOG_NAME that can be
+ * changed at runtime.
+ *
+ * The runtime levels are implemented in logging_stack_level.c, which must then
+ * be linked. Refer to logging_stack_level.h.
+ */
+#ifndef LOGGING_STACK_RUNTIME_LEVEL
+    #define LOGGING_STACK_RUNTIME_LEVEL    ( 0 )
+#endif
+
+#if ( LOGGING_STACK_RUNTIME_LEVEL == 1 ) && !defined( DISABLE_LOGGING )
+    #include "logging_stack_level.h"
+
+/**
+ * @brief Logs a message if the runtime level of the library allows it.
+ *
+ * Each log statement looks up the level of its library once.
+ *
+ * @param[in] level The level of the message, such as #LOG_INFO.
+ * @param[in] prefix The level prefix, such as "[INFO]".
+ * @param[in] message The parenthesized format and arguments.
+ */
+    #define SdkLogAtLevel( level, prefix, message )                                                      \
+    do {                                                                                                 \
+        static const int32_t * pLoggingStackLevel = NULL;                                                \
+        const int32_t * pLoggingStackSlot = __atomic_load_n( &pLoggingStackLevel, __ATOMIC_ACQUIRE );    \
+        if( pLoggingStackSlot == NULL )                                                                  \
+        {                                                                                                \
+            pLoggingStackSlot = LoggingStack_GetLevelSlot( LIBRARY_LOG_NAME );                           \
+            __atomic_store_n( &pLoggingStackLevel, pLoggingStackSlot, __ATOMIC_RELEASE );                \
+        }                                                                                                \
+        if( __atomic_load_n( pLoggingStackSlot, __ATOMIC_RELAXED ) >= ( level ) )                        \
+        {                                                                                                \
+            SdkLogMessage( prefix, message );                                                            \
+        }                                                                                                \
+    } while( 0 )
+#else
+
+/**
+ * @brief Logs a message of a level enabled at compile time.
+ *
+ * @param[in] level The level of the message, such as #LOG_INFO.
+ * @param[in] prefix The level prefix, such as "[INFO]".
+ * @param[in] message The parenthesized format and arguments.
+ */
+    #define SdkLogAtLevel( level, prefix, message )    SdkLogMessage( prefix, message )
+#endif
+
 /**
  * Disable definition of logging interface macros when generating doxygen output,
  * to avoid conflict with documentation of macros at the end of the file.
@@ -101,28 +245,28 @@
 #else
     #if LIBRARY_LOG_LEVEL == LOG_DEBUG
         /* All log level messages will logged. */
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )     SdkLog( ( "[WARN] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogInfo( message )     SdkLog( ( "[INFO] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogDebug( message )    SdkLog( ( "[DEBUG] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogAtLevel( LOG_ERROR, "[ERROR]", message )
+        #define LogWarn( message )     SdkLogAtLevel( LOG_WARN, "[WARN]", message )
+        #define LogInfo( message )     SdkLogAtLevel( LOG_INFO, "[INFO]", message )
+        #define LogDebug( message )    SdkLogAtLevel( LOG_DEBUG, "[DEBUG]", message )
 
     #elif LIBRARY_LOG_LEVEL == LOG_INFO
         /* Only INFO, WARNING and ERROR messages will be logged. */
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )     SdkLog( ( "[WARN] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogInfo( message )     SdkLog( ( "[INFO] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogAtLevel( LOG_ERROR, "[ERROR]", message )
+        #define LogWarn( message )     SdkLogAtLevel( LOG_WARN, "[WARN]", message )
+        #define LogInfo( message )     SdkLogAtLevel( LOG_INFO, "[INFO]", message )
         #define LogDebug( message )
 
     #elif LIBRARY_LOG_LEVEL == LOG_WARN
         /* Only WARNING and ERROR messages will be logged.*/
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
-        #define LogWarn( message )     SdkLog( ( "[WARN] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogAtLevel( LOG_ERROR, "[ERROR]", message )
+        #define LogWarn( message )     SdkLogAtLevel( LOG_WARN, "[WARN]", message )
         #define LogInfo( message )
         #define LogDebug( message )
 
     #elif LIBRARY_LOG_LEVEL == LOG_ERROR
         /* Only ERROR messages will be logged. */
-        #define LogError( message )    SdkLog( ( "[ERROR] "LOG_METADATA_FORMAT, LOG_METADATA_ARGS ) ); SdkLog( message ); SdkLog( ( "\r\n" ) )
+        #define LogError( message )    SdkLogAtLevel( LOG_ERROR, "[ERROR]", message )
         #define LogWarn( message )
         #define LogInfo( message )
         #define LogDebug( message )
@@ -135,6 +279,50 @@
         #define LogDebug( message )
 
     #endif /* if LIBRARY_LOG_LEVEL == LOG_ERROR */
+
+    /* Rate limiting and sampling of the log statements of a call site. */
+    #if defined( DISABLE_LOGGING ) || ( LIBRARY_LOG_LEVEL == LOG_NONE )
+        #define LogRateLimited( intervalMs, logStatement )
+        #define LogSampled( period, logStatement )
+    #else
+
+/**
+ * @brief Runs @p logStatement at most once every @p intervalMs milliseconds
+ * from this call site, such as
+ * `LogRateLimited( 1000U, LogInfo( ( "Received %u bytes.", length ) ) );`.
+ */
+        #define LogRateLimited( intervalMs, logStatement )                                                  \
+    do {                                                                                                    \
+        static uint32_t loggingStackNextMs = 0U;                                                            \
+        struct timespec loggingStackNow;                                                                    \
+        uint32_t loggingStackNowMs = 0U;                                                                    \
+        uint32_t loggingStackNext = 0U;                                                                     \
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &loggingStackNow );                                        \
+        loggingStackNowMs = ( uint32_t ) ( ( ( uint64_t ) loggingStackNow.tv_sec * 1000U ) +             \
+                                           ( ( uint64_t ) loggingStackNow.tv_nsec / 1000000U ) );           \
+        loggingStackNext = __atomic_load_n( &loggingStackNextMs, __ATOMIC_RELAXED );                        \
+        if( ( ( loggingStackNext == 0U ) || ( ( int32_t ) ( loggingStackNowMs - loggingStackNext ) >= 0 ) ) && \
+            ( __atomic_compare_exchange_n( &loggingStackNextMs, &loggingStackNext,                          \
+                                           loggingStackNowMs + ( uint32_t ) ( intervalMs ), 0,              \
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) )                         \
+        {                                                                                                   \
+            logStatement;                                                                                   \
+        }                                                                                                   \
+    } while( 0 )
+
+/**
+ * @brief Runs @p logStatement on the first and then every @p period -th run of
+ * this call site, such as `LogSampled( 100U, LogDebug( ( "Read %s.", pLine ) ) );`.
+ */
+        #define LogSampled( period, logStatement )                                                      \
+    do {                                                                                                \
+        static uint32_t loggingStackCount = 0U;                                                         \
+        if( ( __atomic_fetch_add( &loggingStackCount, 1U, __ATOMIC_RELAXED ) % ( uint32_t ) ( period ) ) == 0U ) \
+        {                                                                                               \
+            logStatement;                                                                               \
+        }                                                                                               \
+    } while( 0 )
+    #endif /* if defined( DISABLE_LOGGING ) || ( LIBRARY_LOG_LEVEL == LOG_NONE ) */
 #endif /* if !defined( LIBRARY_LOG_LEVEL ) || ( ( LIBRARY_LOG_LEVEL != LOG_NONE ) && ( LIBRARY_LOG_LEVEL != LOG_ERROR ) && ( LIBRARY_LOG_LEVEL != LOG_WARN ) && ( LIBRARY_LOG_LEVEL != LOG_INFO ) && ( LIBRARY_LOG_LEVEL != LOG_DEBUG ) ) */
 /** @endcond */
 
@@ -0,0 +1,1222 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file logging_stack_deferred.c
+ * @brief Deferred logging backend for logging_stack.h.
+ *
+ * Every logging thread records its events into a ring of its own, with a
+ * single producer (the thread) and a single consumer (whoever holds
+ * #flushMutex). The rings are never freed; the ring of a thread that exits
+ * is reused by the next thread that logs.
+ */
+
+/* Standard includes. */
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+#include "logging_stack_deferred.h"
+
+/*-----------------------------------------------------------*/
+
+#if ( ( LOGGING_STACK_RING_EVENTS & ( LOGGING_STACK_RING_EVENTS - 1U ) ) != 0U )
+    #error "LOGGING_STACK_RING_EVENTS must be a power of two."
+#endif
+
+/**
+ * @brief Size of the buffer holding one conversion specification of a format,
+ * such as "%-08lx".
+ */
+#define SPECIFICATION_SIZE    ( 16U )
+
+/**
+ * @brief Values of #LoggingStackSite_t.state.
+ */
+#define SITE_UNPARSED         ( 0U ) /**< @brief The format has not been parsed. */
+#define SITE_PARSING          ( 1U ) /**< @brief A thread is parsing the format. */
+#define SITE_DEFERRED         ( 2U ) /**< @brief Messages are recorded. */
+#define SITE_IMMEDIATE        ( 3U ) /**< @brief Messages are printed right away. */
+
+/**
+ * @brief Types of recorded arguments, as promoted by the variadic call.
+ */
+typedef enum ArgumentClass
+{
+    ARGUMENT_NONE = 0,        /**< @brief "%%", which takes no argument. */
+    ARGUMENT_INT,             /**< @brief int, including `*` widths and precisions. */
+    ARGUMENT_LONG,            /**< @brief long. */
+    ARGUMENT_LONG_LONG,       /**< @brief long long. */
+    ARGUMENT_INTMAX,          /**< @brief intmax_t. */
+    ARGUMENT_SIZE,            /**< @brief size_t. */
+    ARGUMENT_PTRDIFF,         /**< @brief ptrdiff_t. */
+    ARGUMENT_DOUBLE,          /**< @brief double. */
+    ARGUMENT_LONG_DOUBLE,     /**< @brief long double. */
+    ARGUMENT_POINTER,         /**< @brief void pointer. */
+    ARGUMENT_STRING,          /**< @brief String copied up to its terminator. */
+    ARGUMENT_STRING_PRECISION /**< @brief String copied up to the preceding `*` precision. */
+} ArgumentClass_t;
+
+/**
+ * @brief Length modifiers of a conversion specification.
+ */
+typedef enum LengthModifier
+{
+    LENGTH_NONE = 0, /**< @brief No modifier. */
+    LENGTH_SHORT,    /**< @brief "h" or "hh". */
+    LENGTH_LONG,     /**< @brief "l". */
+    LENGTH_LONG_LONG,/**< @brief "ll". */
+    LENGTH_INTMAX,   /**< @brief "j". */
+    LENGTH_SIZE,     /**< @brief "z". */
+    LENGTH_PTRDIFF,  /**< @brief "t". */
+    LENGTH_DOUBLE    /**< @brief "L". */
+} LengthModifier_t;
+
+/**
+ * @brief A recorded log message.
+ */
+typedef struct LoggingStackEvent
+{
+    const LoggingStackSite_t * pSite;                /**< @brief The log statement. */
+    uint8_t arguments[ LOGGING_STACK_EVENT_SIZE ]; /**< @brief The arguments, in the order of the format. */
+} LoggingStackEvent_t;
+
+/**
+ * @brief The events recorded by one thread.
+ */
+typedef struct LoggingStackRing
+{
+    struct LoggingStackRing * pNext;                      /**< @brief Next ring of #pRingList. */
+    uint32_t owned;                                       /**< @brief 1 while a thread records into the ring. */
+    uint32_t head;                                        /**< @brief Count of recorded events, written by the owner. */
+    uint32_t tail;                                        /**< @brief Count of printed events, written under #flushMutex. */
+    LoggingStackEvent_t events[ LOGGING_STACK_RING_EVENTS ]; /**< @brief The events. */
+} LoggingStackRing_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Initializes the backend on the first record.
+ */
+static void initializeBackend( void );
+
+/**
+ * @brief Thread that prints the recorded messages.
+ *
+ * @param[in] pArgument Unused.
+ *
+ * @return Does not return.
+ */
+static void * formatterThread( void * pArgument );
+
+/**
+ * @brief Releases the ring of an exiting thread.
+ *
+ * @param[in] pRing The ring of the thread.
+ */
+static void releaseRing( void * pRing );
+
+/**
+ * @brief Gets the ring of the calling thread, claiming one on its first
+ * record.
+ *
+ * @return The ring, or NULL if none could be allocated.
+ */
+static LoggingStackRing_t * getThreadRing( void );
+
+/**
+ * @brief Parses one conversion specification of a format.
+ *
+ * @param[in] pSpecification The specification, starting at its '%'.
+ * @param[out] pStarCount The number of `*` widths and precisions.
+ * @param[out] pArgumentClass The type of the converted argument.
+ *
+ * @return The length of the specification, or 0 if it cannot be recorded.
+ */
+static size_t parseSpecification( const char * pSpecification,
+                                  uint8_t * pStarCount,
+                                  uint8_t * pArgumentClass );
+
+/**
+ * @brief Parses the format of a log statement and publishes its state.
+ *
+ * @param[in] pSite The log statement.
+ * @param[in] pFormat The format of the message.
+ *
+ * @return #SITE_DEFERRED or #SITE_IMMEDIATE.
+ */
+static uint32_t parseSite( LoggingStackSite_t * pSite,
+                           const char * pFormat );
+
+/**
+ * @brief Gets the bytes an argument takes in an event, not counting string
+ * contents.
+ *
+ * @param[in] argumentClass The type of the argument.
+ *
+ * @return The size.
+ */
+static size_t getFixedSize( uint8_t argumentClass );
+
+/**
+ * @brief Copies the arguments of a message into an event.
+ *
+ * @param[in] pSite The log statement.
+ * @param[out] pData The arguments of the event.
+ * @param[in] arguments The arguments of the message.
+ */
+static void recordArguments( const LoggingStackSite_t * pSite,
+                             uint8_t * pData,
+                             va_list arguments );
+
+/**
+ * @brief Prints one argument of an event.
+ *
+ * @param[out] pBuffer Where to print.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in] pSpecification The conversion specification, terminated.
+ * @param[in] pStars The `*` widths and precisions of the specification.
+ * @param[in] starCount The number of @p pStars.
+ * @param[in] argumentClass The type of the argument.
+ * @param[in] pData The arguments of the event.
+ * @param[in,out] pOffset Offset of the argument in @p pData, advanced past it.
+ *
+ * @return The return value of `snprintf`.
+ */
+static int formatArgument( char * pBuffer,
+                           size_t bufferSize,
+                           const char * pSpecification,
+                           const int * pStars,
+                           uint8_t starCount,
+                           uint8_t argumentClass,
+                           const uint8_t * pData,
+                           size_t * pOffset );
+
+/**
+ * @brief Prints a recorded message with its metadata prefix and line ending.
+ *
+ * @param[in] pEvent The event.
+ * @param[out] pLine Where to print.
+ * @param[in] lineSize Size of @p pLine.
+ *
+ * @return The length of the printed line.
+ */
+static size_t formatEvent( const LoggingStackEvent_t * pEvent,
+                           char * pLine,
+                           size_t lineSize );
+
+/**
+ * @brief Prints a message from the thread that logs it.
+ *
+ * @param[in] pSite The log statement.
+ * @param[in] pFormat The format of the message.
+ * @param[in] arguments The arguments of the message.
+ */
+static void printImmediately( const LoggingStackSite_t * pSite,
+                              const char * pFormat,
+                              va_list arguments );
+
+/**
+ * @brief Prints the recorded messages of every ring.
+ *
+ * @return The number of printed messages.
+ */
+static uint32_t flushRings( void );
+
+/**
+ * @brief Gets the file name of a path.
+ *
+ * @param[in] pPath The path.
+ *
+ * @return The part of @p pPath after its last '/'.
+ */
+static const char * getFileName( const char * pPath );
+
+/**
+ * @brief Gets the number of bytes `snprintf` wrote.
+ *
+ * @param[in] written The return value of `snprintf`.
+ * @param[in] bufferSize The size given to `snprintf`.
+ *
+ * @return The number of characters in the buffer.
+ */
+static size_t getWrittenLength( int written,
+                                size_t bufferSize );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Initializes the backend once.
+ */
+static pthread_once_t backendOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Key of the ring of each thread.
+ */
+static pthread_key_t ringKey;
+
+/**
+ * @brief Whether the formatter thread runs. Messages are printed right away
+ * when it could not be started.
+ */
+static bool formatterRunning = false;
+
+/**
+ * @brief The rings of all the threads that ever logged.
+ */
+static LoggingStackRing_t * pRingList = NULL;
+
+/**
+ * @brief Serializes the consumers of the rings.
+ */
+static pthread_mutex_t flushMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Buffer in which messages are printed, used under #flushMutex.
+ */
+static char lineBuffer[ LOGGING_STACK_LINE_SIZE ];
+
+/**
+ * @brief Number of messages dropped because a ring was full.
+ */
+static uint32_t droppedCount = 0U;
+
+/**
+ * @brief Number of dropped messages already reported, used under
+ * #flushMutex.
+ */
+static uint32_t reportedDropCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copies an argument of type @p type into the event.
+ */
+#define RECORD_ARGUMENT( type )                                           \
+    do {                                                                  \
+        type value = va_arg( arguments, type );                           \
+        ( void ) memcpy( &pData[ offset ], &value, sizeof( value ) );     \
+        offset += sizeof( value );                                        \
+    } while( 0 )
+
+/**
+ * @brief Reads an argument of the type of @p value from the event.
+ */
+#define READ_ARGUMENT( value )                                               \
+    do {                                                                     \
+        ( void ) memcpy( &( value ), &pData[ *pOffset ], sizeof( value ) );  \
+        *pOffset += sizeof( value );                                         \
+    } while( 0 )
+
+/**
+ * @brief Prints @p value with the `*` widths and precisions of the
+ * specification.
+ */
+#define FORMAT_ARGUMENT( value )                                                                   \
+    ( ( starCount == 0U ) ? snprintf( pBuffer, bufferSize, pSpecification, value ) :             \
+      ( ( starCount == 1U ) ? snprintf( pBuffer, bufferSize, pSpecification, pStars[ 0 ], value ) : \
+        snprintf( pBuffer, bufferSize, pSpecification, pStars[ 0 ], pStars[ 1 ], value ) ) )
+
+/*-----------------------------------------------------------*/
+
+static void initializeBackend( void )
+{
+    pthread_t formatter;
+    pthread_attr_t attributes;
+
+    if( pthread_key_create( &ringKey, releaseRing ) == 0 )
+    {
+        if( pthread_attr_init( &attributes ) == 0 )
+        {
+            ( void ) pthread_attr_setdetachstate( &attributes, PTHREAD_CREATE_DETACHED );
+
+            if( pthread_create( &formatter, &attributes, formatterThread, NULL ) == 0 )
+            {
+                __atomic_store_n( &formatterRunning, true, __ATOMIC_RELEASE );
+                ( void ) atexit( LoggingStack_Flush );
+            }
+
+            ( void ) pthread_attr_destroy( &attributes );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * formatterThread( void * pArgument )
+{
+    struct timespec interval;
+
+    ( void ) pArgument;
+
+    interval.tv_sec = 0;
+    interval.tv_nsec = ( long ) LOGGING_STACK_FLUSH_INTERVAL_MS * 1000000L;
+
+    for( ; ; )
+    {
+        if( flushRings() == 0U )
+        {
+            ( void ) nanosleep( &interval, NULL );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void releaseRing( void * pRing )
+{
+    /* The next owner continues after the last recorded event. */
+    __atomic_store_n( &( ( LoggingStackRing_t * ) pRing )->owned, 0U, __ATOMIC_RELEASE );
+}
+
+/*-----------------------------------------------------------*/
+
+static LoggingStackRing_t * getThreadRing( void )
+{
+    LoggingStackRing_t * pRing = ( LoggingStackRing_t * ) pthread_getspecific( ringKey );
+    LoggingStackRing_t * pHead = NULL;
+    uint32_t unowned = 0U;
+    bool claimed = false;
+
+    if( pRing == NULL )
+    {
+        /* Reuse the ring of a thread that exited. */
+        pRing = __atomic_load_n( &pRingList, __ATOMIC_ACQUIRE );
+
+        while( ( pRing != NULL ) && ( claimed == false ) )
+        {
+            unowned = 0U;
+            claimed = __atomic_compare_exchange_n( &pRing->owned, &unowned, 1U, false,
+                                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED );
+
+            if( claimed == false )
+            {
+                pRing = pRing->pNext;
+            }
+        }
+
+        if( pRing == NULL )
+        {
+            pRing = ( LoggingStackRing_t * ) calloc( 1U, sizeof( LoggingStackRing_t ) );
+
+            if( pRing != NULL )
+            {
+                pRing->owned = 1U;
+                pHead = __atomic_load_n( &pRingList, __ATOMIC_RELAXED );
+
+                do
+                {
+                    pRing->pNext = pHead;
+                } while( __atomic_compare_exchange_n( &pRingList, &pHead, pRing, false,
+                                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED ) == false );
+            }
+        }
+
+        if( ( pRing != NULL ) && ( pthread_setspecific( ringKey, pRing ) != 0 ) )
+        {
+            releaseRing( pRing );
+            pRing = NULL;
+        }
+    }
+
+    return pRing;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t parseSpecification( const char * pSpecification,
+                                  uint8_t * pStarCount,
+                                  uint8_t * pArgumentClass )
+{
+    size_t index = 1U;
+    size_t length = 0U;
+    uint8_t starCount = 0U;
+    uint8_t argumentClass = ( uint8_t ) ARGUMENT_NONE;
+    bool precisionStar = false;
+    bool precisionDigits = false;
+    LengthModifier_t modifier = LENGTH_NONE;
+    bool supported = true;
+
+    /* Flags. */
+    while( ( pSpecification[ index ] != '\0' ) &&
+           ( strchr( "-+ #0", pSpecification[ index ] ) != NULL ) )
+    {
+        index++;
+    }
+
+    /* Width. */
+    if( pSpecification[ index ] == '*' )
+    {
+        starCount++;
+        index++;
+    }
+    else
+    {
+        while( ( pSpecification[ index ] >= '0' ) && ( pSpecification[ index ] <= '9' ) )
+        {
+            index++;
+        }
+    }
+
+    /* Precision. */
+    if( pSpecification[ index ] == '.' )
+    {
+        index++;
+
+        if( pSpecification[ index ] == '*' )
+        {
+            starCount++;
+            precisionStar = true;
+            index++;
+        }
+        else
+        {
+            precisionDigits = true;
+
+            while( ( pSpecification[ index ] >= '0' ) && ( pSpecification[ index ] <= '9' ) )
+            {
+                index++;
+            }
+        }
+    }
+
+    /* Length modifier. */
+    switch( pSpecification[ index ] )
+    {
+        case 'h':
+            modifier = LENGTH_SHORT;
+            index += ( pSpecification[ index + 1U ] == 'h' ) ? 2U : 1U;
+            break;
+
+        case 'l':
+
+            if( pSpecification[ index + 1U ] == 'l' )
+            {
+                modifier = LENGTH_LONG_LONG;
+                index += 2U;
+            }
+            else
+            {
+                modifier = LENGTH_LONG;
+                index++;
+            }
+
+            break;
+
+        case 'j':
+            modifier = LENGTH_INTMAX;
+            index++;
+            break;
+
+        case 'z':
+            modifier = LENGTH_SIZE;
+            index++;
+            break;
+
+        case 't':
+            modifier = LENGTH_PTRDIFF;
+            index++;
+            break;
+
+        case 'L':
+            modifier = LENGTH_DOUBLE;
+            index++;
+            break;
+
+        default:
+            /* No length modifier. */
+            break;
+    }
+
+    /* Conversion. */
+    switch( pSpecification[ index ] )
+    {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+        case 'c':
+
+            if( ( modifier == LENGTH_NONE ) || ( modifier == LENGTH_SHORT ) )
+            {
+                /* Wide characters are not recorded. */
+                supported = ( pSpecification[ index ] != 'c' ) || ( modifier == LENGTH_NONE );
+                argumentClass = ( uint8_t ) ARGUMENT_INT;
+            }
+            else if( modifier == LENGTH_LONG )
+            {
+                supported = ( pSpecification[ index ] != 'c' );
+                argumentClass = ( uint8_t ) ARGUMENT_LONG;
+            }
+            else if( modifier == LENGTH_LONG_LONG )
+            {
+                supported = ( pSpecification[ index ] != 'c' );
+                argumentClass = ( uint8_t ) ARGUMENT_LONG_LONG;
+            }
+            else if( modifier == LENGTH_INTMAX )
+            {
+                supported = ( pSpecification[ index ] != 'c' );
+                argumentClass = ( uint8_t ) ARGUMENT_INTMAX;
+            }
+            else if( modifier == LENGTH_SIZE )
+            {
+                supported = ( pSpecification[ index ] != 'c' );
+                argumentClass = ( uint8_t ) ARGUMENT_SIZE;
+            }
+            else if( modifier == LENGTH_PTRDIFF )
+            {
+                supported = ( pSpecification[ index ] != 'c' );
+                argumentClass = ( uint8_t ) ARGUMENT_PTRDIFF;
+            }
+            else
+            {
+                supported = false;
+            }
+
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+
+            if( ( modifier == LENGTH_NONE ) || ( modifier == LENGTH_LONG ) )
+            {
+                argumentClass = ( uint8_t ) ARGUMENT_DOUBLE;
+            }
+            else if( modifier == LENGTH_DOUBLE )
+            {
+                argumentClass = ( uint8_t ) ARGUMENT_LONG_DOUBLE;
+            }
+            else
+            {
+                supported = false;
+            }
+
+            break;
+
+        case 's':
+
+            /* A fixed precision may leave the string unterminated, and wide
+             * strings are not recorded. */
+            if( ( modifier != LENGTH_NONE ) || ( precisionDigits == true ) )
+            {
+                supported = false;
+            }
+            else if( precisionStar == true )
+            {
+                argumentClass = ( uint8_t ) ARGUMENT_STRING_PRECISION;
+            }
+            else
+            {
+                argumentClass = ( uint8_t ) ARGUMENT_STRING;
+            }
+
+            break;
+
+        case 'p':
+            supported = ( modifier == LENGTH_NONE );
+            argumentClass = ( uint8_t ) ARGUMENT_POINTER;
+            break;
+
+        case '%':
+            supported = ( index == 1U );
+            break;
+
+        default:
+            /* "%n" and unknown conversions are not recorded. */
+            supported = false;
+            break;
+    }
+
+    if( supported == true )
+    {
+        length = index + 1U;
+        *pStarCount = starCount;
+        *pArgumentClass = argumentClass;
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t getFixedSize( uint8_t argumentClass )
+{
+    size_t size = 0U;
+
+    switch( argumentClass )
+    {
+        case ARGUMENT_INT:
+            size = sizeof( int );
+            break;
+
+        case ARGUMENT_LONG:
+            size = sizeof( long );
+            break;
+
+        case ARGUMENT_LONG_LONG:
+            size = sizeof( long long );
+            break;
+
+        case ARGUMENT_INTMAX:
+            size = sizeof( intmax_t );
+            break;
+
+        case ARGUMENT_SIZE:
+            size = sizeof( size_t );
+            break;
+
+        case ARGUMENT_PTRDIFF:
+            size = sizeof( ptrdiff_t );
+            break;
+
+        case ARGUMENT_DOUBLE:
+            size = sizeof( double );
+            break;
+
+        case ARGUMENT_LONG_DOUBLE:
+            size = sizeof( long double );
+            break;
+
+        case ARGUMENT_POINTER:
+            size = sizeof( void * );
+            break;
+
+        case ARGUMENT_STRING:
+        case ARGUMENT_STRING_PRECISION:
+            /* The length of the string. */
+            size = sizeof( uint16_t );
+            break;
+
+        default:
+            /* Empty else MISRA 15.7 */
+            break;
+    }
+
+    return size;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t parseSite( LoggingStackSite_t * pSite,
+                           const char * pFormat )
+{
+    const char * pCurrent = pFormat;
+    size_t specificationLength = 0U;
+    size_t fixedSize = 0U;
+    uint8_t argumentCount = 0U;
+    uint8_t starCount = 0U;
+    uint8_t argumentClass = ( uint8_t ) ARGUMENT_NONE;
+    uint8_t star = 0U;
+    bool supported = true;
+    uint32_t state = SITE_IMMEDIATE;
+
+    while( ( supported == true ) && ( *pCurrent != '\0' ) )
+    {
+        if( *pCurrent != '%' )
+        {
+            pCurrent++;
+        }
+        else
+        {
+            specificationLength = parseSpecification( pCurrent, &starCount, &argumentClass );
+
+            if( ( specificationLength == 0U ) ||
+                ( specificationLength >= SPECIFICATION_SIZE ) ||
+                ( ( ( size_t ) argumentCount + starCount + 1U ) > LOGGING_STACK_MAX_ARGUMENTS ) )
+            {
+                supported = false;
+            }
+            else
+            {
+                for( star = 0U; star < starCount; star++ )
+                {
+                    pSite->argumentClasses[ argumentCount ] = ( uint8_t ) ARGUMENT_INT;
+                    argumentCount++;
+                    fixedSize += sizeof( int );
+                }
+
+                if( argumentClass != ( uint8_t ) ARGUMENT_NONE )
+                {
+                    pSite->argumentClasses[ argumentCount ] = argumentClass;
+                    argumentCount++;
+                    fixedSize += getFixedSize( argumentClass );
+                }
+
+                pCurrent = &pCurrent[ specificationLength ];
+            }
+        }
+    }
+
+    if( ( supported == true ) && ( fixedSize <= LOGGING_STACK_EVENT_SIZE ) )
+    {
+        state = SITE_DEFERRED;
+    }
+
+    pSite->pFormat = pFormat;
+    pSite->argumentCount = argumentCount;
+    pSite->fixedSize = ( uint16_t ) fixedSize;
+
+    /* Publish the parsed format to the formatter and the other threads. */
+    __atomic_store_n( &pSite->state, state, __ATOMIC_RELEASE );
+
+    return state;
+}
+
+/*-----------------------------------------------------------*/
+
+static void recordArguments( const LoggingStackSite_t * pSite,
+                             uint8_t * pData,
+                             va_list arguments )
+{
+    size_t offset = 0U;
+    size_t fixedLeft = pSite->fixedSize;
+    size_t limit = 0U;
+    size_t length = 0U;
+    uint16_t storedLength = 0U;
+    int precision = -1;
+    int integer = 0;
+    const char * pString = NULL;
+    uint8_t index = 0U;
+
+    for( index = 0U; index < pSite->argumentCount; index++ )
+    {
+        fixedLeft -= getFixedSize( pSite->argumentClasses[ index ] );
+
+        switch( pSite->argumentClasses[ index ] )
+        {
+            case ARGUMENT_INT:
+                integer = va_arg( arguments, int );
+                ( void ) memcpy( &pData[ offset ], &integer, sizeof( integer ) );
+                offset += sizeof( integer );
+
+                /* A string with a `*` precision follows its precision. */
+                precision = integer;
+                break;
+
+            case ARGUMENT_LONG:
+                RECORD_ARGUMENT( long );
+                break;
+
+            case ARGUMENT_LONG_LONG:
+                RECORD_ARGUMENT( long long );
+                break;
+
+            case ARGUMENT_INTMAX:
+                RECORD_ARGUMENT( intmax_t );
+                break;
+
+            case ARGUMENT_SIZE:
+                RECORD_ARGUMENT( size_t );
+                break;
+
+            case ARGUMENT_PTRDIFF:
+                RECORD_ARGUMENT( ptrdiff_t );
+                break;
+
+            case ARGUMENT_DOUBLE:
+                RECORD_ARGUMENT( double );
+                break;
+
+            case ARGUMENT_LONG_DOUBLE:
+                RECORD_ARGUMENT( long double );
+                break;
+
+            case ARGUMENT_POINTER:
+                RECORD_ARGUMENT( void * );
+                break;
+
+            default:
+                pString = va_arg( arguments, const char * );
+
+                if( pString == NULL )
+                {
+                    pString = "(null)";
+                }
+
+                /* Leave room for the arguments that follow. */
+                limit = LOGGING_STACK_EVENT_SIZE - offset - sizeof( uint16_t ) - fixedLeft;
+
+                if( ( pSite->argumentClasses[ index ] == ( uint8_t ) ARGUMENT_STRING_PRECISION ) &&
+                    ( precision >= 0 ) && ( ( size_t ) precision < limit ) )
+                {
+                    limit = ( size_t ) precision;
+                }
+
+                length = 0U;
+
+                while( ( length < limit ) && ( pString[ length ] != '\0' ) )
+                {
+                    length++;
+                }
+
+                storedLength = ( uint16_t ) length;
+                ( void ) memcpy( &pData[ offset ], &storedLength, sizeof( storedLength ) );
+                offset += sizeof( storedLength );
+                ( void ) memcpy( &pData[ offset ], pString, length );
+                offset += length;
+                break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int formatArgument( char * pBuffer,
+                           size_t bufferSize,
+                           const char * pSpecification,
+                           const int * pStars,
+                           uint8_t starCount,
+                           uint8_t argumentClass,
+                           const uint8_t * pData,
+                           size_t * pOffset )
+{
+    int written = 0;
+    int integer = 0;
+    long longInteger = 0L;
+    long long longLongInteger = 0LL;
+    intmax_t maximumInteger = 0;
+    size_t size = 0U;
+    ptrdiff_t difference = 0;
+    double real = 0.0;
+    long double longReal = 0.0L;
+    void * pPointer = NULL;
+    uint16_t stringLength = 0U;
+    char string[ LOGGING_STACK_EVENT_SIZE + 1U ];
+
+    switch( argumentClass )
+    {
+        case ARGUMENT_INT:
+            READ_ARGUMENT( integer );
+            written = FORMAT_ARGUMENT( integer );
+            break;
+
+        case ARGUMENT_LONG:
+            READ_ARGUMENT( longInteger );
+            written = FORMAT_ARGUMENT( longInteger );
+            break;
+
+        case ARGUMENT_LONG_LONG:
+            READ_ARGUMENT( longLongInteger );
+            written = FORMAT_ARGUMENT( longLongInteger );
+            break;
+
+        case ARGUMENT_INTMAX:
+            READ_ARGUMENT( maximumInteger );
+            written = FORMAT_ARGUMENT( maximumInteger );
+            break;
+
+        case ARGUMENT_SIZE:
+            READ_ARGUMENT( size );
+            written = FORMAT_ARGUMENT( size );
+            break;
+
+        case ARGUMENT_PTRDIFF:
+            READ_ARGUMENT( difference );
+            written = FORMAT_ARGUMENT( difference );
+            break;
+
+        case ARGUMENT_DOUBLE:
+            READ_ARGUMENT( real );
+            written = FORMAT_ARGUMENT( real );
+            break;
+
+        case ARGUMENT_LONG_DOUBLE:
+            READ_ARGUMENT( longReal );
+            written = FORMAT_ARGUMENT( longReal );
+            break;
+
+        case ARGUMENT_POINTER:
+            READ_ARGUMENT( pPointer );
+            written = FORMAT_ARGUMENT( pPointer );
+            break;
+
+        default:
+            READ_ARGUMENT( stringLength );
+            ( void ) memcpy( string, &pData[ *pOffset ], stringLength );
+            string[ stringLength ] = '\0';
+            *pOffset += stringLength;
+            written = FORMAT_ARGUMENT( string );
+            break;
+    }
+
+    return written;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t formatEvent( const LoggingStackEvent_t * pEvent,
+                           char * pLine,
+                           size_t lineSize )
+{
+    const LoggingStackSite_t * pSite = pEvent->pSite;
+    const char * pFormat = pSite->pFormat;
+    /* Keep room for the line ending. */
+    size_t limit = lineSize - 2U;
+    size_t length = 0U;
+    size_t offset = 0U;
+    size_t specificationLength = 0U;
+    uint8_t starCount = 0U;
+    uint8_t argumentClass = ( uint8_t ) ARGUMENT_NONE;
+    uint8_t star = 0U;
+    int stars[ 2 ] = { 0, 0 };
+    char specification[ SPECIFICATION_SIZE ];
+
+    length = getWrittenLength( snprintf( pLine, limit, "%s [%s] [%s:%d] ",
+                                         pSite->pLevel, pSite->pLibrary,
+                                         getFileName( pSite->pFile ), pSite->line ),
+                               limit );
+
+    while( ( *pFormat != '\0' ) && ( ( length + 1U ) < limit ) )
+    {
+        if( *pFormat != '%' )
+        {
+            pLine[ length ] = *pFormat;
+            length++;
+            pFormat++;
+        }
+        else
+        {
+            /* The format was parsed when it was recorded, so this succeeds. */
+            specificationLength = parseSpecification( pFormat, &starCount, &argumentClass );
+
+            if( argumentClass == ( uint8_t ) ARGUMENT_NONE )
+            {
+                pLine[ length ] = '%';
+                length++;
+            }
+            else
+            {
+                for( star = 0U; star < starCount; star++ )
+                {
+                    ( void ) memcpy( &stars[ star ], &pEvent->arguments[ offset ], sizeof( int ) );
+                    offset += sizeof( int );
+                }
+
+                ( void ) memcpy( specification, pFormat, specificationLength );
+                specification[ specificationLength ] = '\0';
+
+                length += getWrittenLength( formatArgument( &pLine[ length ], limit - length,
+                                                            specification, stars, starCount,
+                                                            argumentClass, pEvent->arguments,
+                                                            &offset ),
+                                            limit - length );
+            }
+
+            pFormat = &pFormat[ specificationLength ];
+        }
+    }
+
+    pLine[ length ] = '\r';
+    pLine[ length + 1U ] = '\n';
+
+    return length + 2U;
+}
+
+/*-----------------------------------------------------------*/
+
+static void printImmediately( const LoggingStackSite_t * pSite,
+                              const char * pFormat,
+                              va_list arguments )
+{
+    /* The same output as the immediate logging backend, but without the
+     * messages of other threads in between. */
+    flockfile( stdout );
+    ( void ) printf( "%s [%s] [%s:%d] ", pSite->pLevel, pSite->pLibrary,
+                     getFileName( pSite->pFile ), pSite->line );
+    ( void ) vprintf( pFormat, arguments );
+    ( void ) printf( "\r\n" );
+    funlockfile( stdout );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t flushRings( void )
+{
+    LoggingStackRing_t * pRing = NULL;
+    uint32_t tail = 0U;
+    uint32_t printed = 0U;
+    uint32_t dropped = 0U;
+    size_t length = 0U;
+
+    ( void ) pthread_mutex_lock( &flushMutex );
+
+    for( pRing = __atomic_load_n( &pRingList, __ATOMIC_ACQUIRE ); pRing != NULL; pRing = pRing->pNext )
+    {
+        tail = pRing->tail;
+
+        while( tail != __atomic_load_n( &pRing->head, __ATOMIC_ACQUIRE ) )
+        {
+            length = formatEvent( &pRing->events[ tail & ( LOGGING_STACK_RING_EVENTS - 1U ) ],
+                                  lineBuffer, sizeof( lineBuffer ) );
+            ( void ) fwrite( lineBuffer, 1U, length, stdout );
+            tail++;
+
+            /* Hand the event back to the owner of the ring. */
+            __atomic_store_n( &pRing->tail, tail, __ATOMIC_RELEASE );
+            printed++;
+        }
+    }
+
+    dropped = __atomic_load_n( &droppedCount, __ATOMIC_RELAXED );
+
+    if( dropped != reportedDropCount )
+    {
+        ( void ) printf( "[WARN] [LoggingStack] %u log messages were dropped because a log ring was full.\r\n",
+                         ( unsigned int ) ( dropped - reportedDropCount ) );
+        reportedDropCount = dropped;
+    }
+
+    if( printed > 0U )
+    {
+        ( void ) fflush( stdout );
+    }
+
+    ( void ) pthread_mutex_unlock( &flushMutex );
+
+    return printed;
+}
+
+/*-----------------------------------------------------------*/
+
+static const char * getFileName( const char * pPath )
+{
+    const char * pSeparator = strrchr( pPath, '/' );
+
+    return ( pSeparator != NULL ) ? &pSeparator[ 1 ] : pPath;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t getWrittenLength( int written,
+                                size_t bufferSize )
+{
+    size_t length = 0U;
+
+    if( written > 0 )
+    {
+        length = ( size_t ) written;
+
+        /* snprintf returns the length it would have written. */
+        if( length >= bufferSize )
+        {
+            length = ( bufferSize > 0U ) ? ( bufferSize - 1U ) : 0U;
+        }
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+void LoggingStack_Record( LoggingStackSite_t * pSite,
+                          const char * pFormat,
+                          ... )
+{
+    va_list arguments;
+    uint32_t state = SITE_UNPARSED;
+    uint32_t head = 0U;
+    LoggingStackRing_t * pRing = NULL;
+    LoggingStackEvent_t * pEvent = NULL;
+
+    ( void ) pthread_once( &backendOnce, initializeBackend );
+
+    state = __atomic_load_n( &pSite->state, __ATOMIC_ACQUIRE );
+
+    if( ( state == SITE_UNPARSED ) &&
+        ( __atomic_compare_exchange_n( &pSite->state, &state, SITE_PARSING, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ) == true ) )
+    {
+        state = parseSite( pSite, pFormat );
+    }
+
+    /* A statement always logs the same format, unless the format is not a
+     * literal. Messages are also printed right away while another thread
+     * parses the format. */
+    if( ( state == SITE_DEFERRED ) && ( pSite->pFormat == pFormat ) &&
+        ( __atomic_load_n( &formatterRunning, __ATOMIC_ACQUIRE ) == true ) )
+    {
+        pRing = getThreadRing();
+    }
+
+    if( pRing != NULL )
+    {
+        head = pRing->head;
+
+        if( ( head - __atomic_load_n( &pRing->tail, __ATOMIC_ACQUIRE ) ) < LOGGING_STACK_RING_EVENTS )
+        {
+            pEvent = &pRing->events[ head & ( LOGGING_STACK_RING_EVENTS - 1U ) ];
+            pEvent->pSite = pSite;
+
+            va_start( arguments, pFormat );
+            recordArguments( pSite, pEvent->arguments, arguments );
+            va_end( arguments );
+
+            /* Publish the event to the formatter. */
+            __atomic_store_n( &pRing->head, head + 1U, __ATOMIC_RELEASE );
+        }
+        else
+        {
+            ( void ) __atomic_fetch_add( &droppedCount, 1U, __ATOMIC_RELAXED );
+        }
+    }
+    else
+    {
+        va_start( arguments, pFormat );
+        printImmediately( pSite, pFormat, arguments );
+        va_end( arguments );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void LoggingStack_Flush( void )
+{
+    ( void ) flushRings();
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t LoggingStack_GetDroppedCount( void )
+{
+    return __atomic_load_n( &droppedCount, __ATOMIC_RELAXED );
+}
+
+/*-----------------------------------------------------------*/
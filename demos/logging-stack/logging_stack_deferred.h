@@ -0,0 +1,157 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file logging_stack_deferred.h
+ * @brief Deferred logging backend, in which log statements record their
+ * arguments and a formatter thread prints them.
+ *
+ * When #LOGGING_STACK_DEFERRED is 1, the logging macros of logging_stack.h
+ * expand to #LoggingStack_Record. Each log statement owns a static
+ * #LoggingStackSite_t holding its level, library name, file and line, which
+ * is all a recorded event needs to refer to. The calling thread copies the
+ * raw arguments into its own ring of events without formatting anything and
+ * without taking a lock. A formatter thread drains the rings and prints the
+ * messages in the same format as the immediate backend.
+ *
+ * Messages are printed in order per thread only. A message whose format
+ * cannot be recorded (for example `%s` with a fixed precision) is printed
+ * right away instead.
+ */
+
+#ifndef LOGGING_STACK_DEFERRED_H_
+#define LOGGING_STACK_DEFERRED_H_
+
+/* Standard Include. */
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of arguments, including `*` widths and precisions,
+ * that a deferred log message can have.
+ */
+#ifndef LOGGING_STACK_MAX_ARGUMENTS
+    #define LOGGING_STACK_MAX_ARGUMENTS    ( 12U )
+#endif
+
+/**
+ * @brief Number of bytes available for the arguments of one event.
+ *
+ * Strings are truncated to the space left after the other arguments.
+ */
+#ifndef LOGGING_STACK_EVENT_SIZE
+    #define LOGGING_STACK_EVENT_SIZE    ( 256U )
+#endif
+
+/**
+ * @brief Number of events in the ring of each logging thread.
+ *
+ * Must be a power of two. Events recorded while the ring is full are dropped
+ * and counted.
+ */
+#ifndef LOGGING_STACK_RING_EVENTS
+    #define LOGGING_STACK_RING_EVENTS    ( 256U )
+#endif
+
+/**
+ * @brief Size of the buffer in which the formatter thread prints one message,
+ * including its metadata prefix.
+ */
+#ifndef LOGGING_STACK_LINE_SIZE
+    #define LOGGING_STACK_LINE_SIZE    ( 512U )
+#endif
+
+/**
+ * @brief Time in milliseconds the formatter thread sleeps when all the rings
+ * are empty.
+ */
+#ifndef LOGGING_STACK_FLUSH_INTERVAL_MS
+    #define LOGGING_STACK_FLUSH_INTERVAL_MS    ( 2U )
+#endif
+
+/**
+ * @brief A log statement.
+ *
+ * One static instance exists per log statement. The first record parses the
+ * format of the statement and caches the types of its arguments here.
+ */
+typedef struct LoggingStackSite
+{
+    const char * pLevel;                                   /**< @brief Level prefix, such as "[INFO]". */
+    const char * pLibrary;                                 /**< @brief #LIBRARY_LOG_NAME of the statement. */
+    const char * pFile;                                    /**< @brief File of the statement. */
+    int line;                                              /**< @brief Line of the statement. */
+    const char * pFormat;                                  /**< @brief Format of the message, set by the first record. */
+    uint32_t state;                                        /**< @brief Whether the format has been parsed, and whether it can be recorded. */
+    uint16_t fixedSize;                                    /**< @brief Bytes of an event taken by everything but string contents. */
+    uint8_t argumentCount;                                 /**< @brief Number of arguments of the message. */
+    uint8_t argumentClasses[ LOGGING_STACK_MAX_ARGUMENTS ]; /**< @brief Type of each argument. */
+} LoggingStackSite_t;
+
+/**
+ * @brief Initializer of the #LoggingStackSite_t of a log statement.
+ *
+ * @param[in] level The level prefix, such as "[INFO]".
+ * @param[in] library The library name.
+ */
+#define LOGGING_STACK_SITE( level, library )    { level, library, __FILE__, __LINE__, NULL, 0U, 0U, 0U, { 0U } }
+
+/**
+ * @brief Lets GCC and Clang check the arguments of deferred log messages
+ * against their formats, as they do for `printf`.
+ */
+#if defined( __GNUC__ )
+    #define LOGGING_STACK_FORMAT_CHECK    __attribute__( ( format( printf, 2, 3 ) ) )
+#else
+    #define LOGGING_STACK_FORMAT_CHECK
+#endif
+
+/**
+ * @brief Record a log message for the formatter thread.
+ *
+ * Does not format the message and does not block. The arguments are copied,
+ * so strings may be freed once the call returns.
+ *
+ * @param[in] pSite The log statement.
+ * @param[in] pFormat The `printf` format of the message.
+ */
+void LoggingStack_Record( LoggingStackSite_t * pSite,
+                          const char * pFormat,
+                          ... ) LOGGING_STACK_FORMAT_CHECK;
+
+/**
+ * @brief Print every recorded message that has not been printed yet.
+ *
+ * Called at exit, and may be called before a crash is expected, such as
+ * before `abort`.
+ */
+void LoggingStack_Flush( void );
+
+/**
+ * @brief Get the number of messages dropped because the ring of the logging
+ * thread was full.
+ *
+ * @return The number of dropped messages.
+ */
+uint32_t LoggingStack_GetDroppedCount( void );
+
+#endif /* ifndef LOGGING_STACK_DEFERRED_H_ */
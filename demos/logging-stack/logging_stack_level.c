@@ -0,0 +1,338 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file logging_stack_level.c
+ * @brief Log levels that can be changed at runtime, per library.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+#include "logging_stack_level.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Size of the buffer holding the name of a library, including its
+ * terminator. Longer names share the level set for `*`.
+ */
+#define LIBRARY_NAME_SIZE    ( 32U )
+
+/**
+ * @brief The runtime level of a library.
+ */
+typedef struct LibraryLevel
+{
+    char name[ LIBRARY_NAME_SIZE ]; /**< @brief #LIBRARY_LOG_NAME of the library. */
+    int32_t level;                  /**< @brief Runtime level of the library. */
+} LibraryLevel_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reads the initial levels from the environment.
+ */
+static void initializeLevels( void );
+
+/**
+ * @brief Parses the name of a level, or its number.
+ *
+ * @param[in] pLevel The level.
+ * @param[in] levelLength The length of @p pLevel.
+ *
+ * @return The level, or -1 if @p pLevel is not a level.
+ */
+static int32_t parseLevel( const char * pLevel,
+                           size_t levelLength );
+
+/**
+ * @brief Finds the level of a library, adding it when @p add is true.
+ *
+ * Must be called with #levelMutex held.
+ *
+ * @param[in] pLibraryName The name of the library.
+ * @param[in] nameLength The length of @p pLibraryName.
+ * @param[in] add Whether to add a missing library.
+ *
+ * @return The level of the library, or NULL if it was not found or could not
+ * be added.
+ */
+static LibraryLevel_t * findLibrary( const char * pLibraryName,
+                                     size_t nameLength,
+                                     bool add );
+
+/**
+ * @brief Sets the level of a library, or of every library.
+ *
+ * Must be called with #levelMutex held.
+ *
+ * @param[in] pLibraryName The name of the library, or NULL for every library.
+ * @param[in] nameLength The length of @p pLibraryName.
+ * @param[in] level The level.
+ *
+ * @return Whether the level was set.
+ */
+static bool setLevel( const char * pLibraryName,
+                      size_t nameLength,
+                      int32_t level );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reads the environment once.
+ */
+static pthread_once_t levelsOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Serializes the changes to #libraries.
+ */
+static pthread_mutex_t levelMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The libraries with a level of their own.
+ */
+static LibraryLevel_t libraries[ LOGGING_STACK_MAX_LIBRARIES ];
+
+/**
+ * @brief The number of used entries of #libraries.
+ */
+static size_t libraryCount = 0U;
+
+/**
+ * @brief The level of libraries not named, which is also the level of the
+ * libraries that #libraries has no room for.
+ */
+static int32_t defaultLevel = LOGGING_STACK_DEFAULT_LEVEL;
+
+/*-----------------------------------------------------------*/
+
+static void initializeLevels( void )
+{
+    const char * pEntry = getenv( LOGGING_STACK_LEVELS_ENVIRONMENT );
+    const char * pEnd = NULL;
+    const char * pSeparator = NULL;
+    size_t entryLength = 0U;
+    size_t nameLength = 0U;
+    int32_t level = -1;
+
+    /* Entries have the format NAME=LEVEL and are separated by commas. */
+    while( ( pEntry != NULL ) && ( *pEntry != '\0' ) )
+    {
+        pEnd = strchr( pEntry, ',' );
+        entryLength = ( pEnd != NULL ) ? ( size_t ) ( pEnd - pEntry ) : strlen( pEntry );
+        pSeparator = memchr( pEntry, '=', entryLength );
+
+        if( pSeparator != NULL )
+        {
+            nameLength = ( size_t ) ( pSeparator - pEntry );
+            level = parseLevel( &pSeparator[ 1 ], entryLength - nameLength - 1U );
+
+            if( level >= 0 )
+            {
+                ( void ) pthread_mutex_lock( &levelMutex );
+
+                /* Only the libraries named keep a level of their own. */
+                if( ( nameLength == 1U ) && ( pEntry[ 0 ] == '*' ) )
+                {
+                    __atomic_store_n( &defaultLevel, level, __ATOMIC_RELAXED );
+                }
+                else
+                {
+                    ( void ) setLevel( pEntry, nameLength, level );
+                }
+
+                ( void ) pthread_mutex_unlock( &levelMutex );
+            }
+        }
+
+        pEntry = ( pEnd != NULL ) ? &pEnd[ 1 ] : NULL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t parseLevel( const char * pLevel,
+                           size_t levelLength )
+{
+    static const char * const pLevelNames[] = { "none", "error", "warn", "info", "debug" };
+    int32_t level = -1;
+    int32_t index = 0;
+
+    if( ( levelLength == 1U ) && ( pLevel[ 0 ] >= '0' ) && ( pLevel[ 0 ] <= ( char ) ( '0' + LOG_DEBUG ) ) )
+    {
+        level = ( int32_t ) ( pLevel[ 0 ] - '0' );
+    }
+    else
+    {
+        for( index = 0; ( index <= LOG_DEBUG ) && ( level < 0 ); index++ )
+        {
+            if( ( strlen( pLevelNames[ index ] ) == levelLength ) &&
+                ( strncmp( pLevelNames[ index ], pLevel, levelLength ) == 0 ) )
+            {
+                level = index;
+            }
+        }
+    }
+
+    return level;
+}
+
+/*-----------------------------------------------------------*/
+
+static LibraryLevel_t * findLibrary( const char * pLibraryName,
+                                     size_t nameLength,
+                                     bool add )
+{
+    LibraryLevel_t * pLibrary = NULL;
+    size_t index = 0U;
+
+    for( index = 0U; ( index < libraryCount ) && ( pLibrary == NULL ); index++ )
+    {
+        if( ( nameLength < LIBRARY_NAME_SIZE ) &&
+            ( strncmp( libraries[ index ].name, pLibraryName, nameLength ) == 0 ) &&
+            ( libraries[ index ].name[ nameLength ] == '\0' ) )
+        {
+            pLibrary = &libraries[ index ];
+        }
+    }
+
+    if( ( pLibrary == NULL ) && ( add == true ) &&
+        ( libraryCount < LOGGING_STACK_MAX_LIBRARIES ) && ( nameLength < LIBRARY_NAME_SIZE ) )
+    {
+        pLibrary = &libraries[ libraryCount ];
+        ( void ) memcpy( pLibrary->name, pLibraryName, nameLength );
+        pLibrary->name[ nameLength ] = '\0';
+        __atomic_store_n( &pLibrary->level, __atomic_load_n( &defaultLevel, __ATOMIC_RELAXED ), __ATOMIC_RELAXED );
+        libraryCount++;
+    }
+
+    return pLibrary;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool setLevel( const char * pLibraryName,
+                      size_t nameLength,
+                      int32_t level )
+{
+    LibraryLevel_t * pLibrary = NULL;
+    size_t index = 0U;
+    bool set = true;
+
+    if( pLibraryName == NULL )
+    {
+        __atomic_store_n( &defaultLevel, level, __ATOMIC_RELAXED );
+
+        for( index = 0U; index < libraryCount; index++ )
+        {
+            __atomic_store_n( &libraries[ index ].level, level, __ATOMIC_RELAXED );
+        }
+    }
+    else
+    {
+        pLibrary = findLibrary( pLibraryName, nameLength, true );
+
+        if( pLibrary != NULL )
+        {
+            __atomic_store_n( &pLibrary->level, level, __ATOMIC_RELAXED );
+        }
+        else
+        {
+            set = false;
+        }
+    }
+
+    return set;
+}
+
+/*-----------------------------------------------------------*/
+
+const int32_t * LoggingStack_GetLevelSlot( const char * pLibraryName )
+{
+    const int32_t * pSlot = &defaultLevel;
+    LibraryLevel_t * pLibrary = NULL;
+
+    ( void ) pthread_once( &levelsOnce, initializeLevels );
+    ( void ) pthread_mutex_lock( &levelMutex );
+
+    pLibrary = findLibrary( pLibraryName, strlen( pLibraryName ), true );
+
+    if( pLibrary != NULL )
+    {
+        pSlot = &pLibrary->level;
+    }
+
+    ( void ) pthread_mutex_unlock( &levelMutex );
+
+    return pSlot;
+}
+
+/*-----------------------------------------------------------*/
+
+bool LoggingStack_SetLevel( const char * pLibraryName,
+                            int32_t level )
+{
+    bool set = false;
+
+    if( ( level >= LOG_NONE ) && ( level <= LOG_DEBUG ) )
+    {
+        ( void ) pthread_once( &levelsOnce, initializeLevels );
+        ( void ) pthread_mutex_lock( &levelMutex );
+
+        set = setLevel( pLibraryName,
+                        ( pLibraryName != NULL ) ? strlen( pLibraryName ) : 0U,
+                        level );
+
+        ( void ) pthread_mutex_unlock( &levelMutex );
+    }
+
+    return set;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t LoggingStack_GetLevel( const char * pLibraryName )
+{
+    int32_t level = 0;
+    LibraryLevel_t * pLibrary = NULL;
+
+    ( void ) pthread_once( &levelsOnce, initializeLevels );
+    ( void ) pthread_mutex_lock( &levelMutex );
+
+    pLibrary = findLibrary( pLibraryName, strlen( pLibraryName ), false );
+    level = __atomic_load_n( ( pLibrary != NULL ) ? &pLibrary->level : &defaultLevel, __ATOMIC_RELAXED );
+
+    ( void ) pthread_mutex_unlock( &levelMutex );
+
+    return level;
+}
+
+/*-----------------------------------------------------------*/
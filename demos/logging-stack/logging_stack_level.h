@@ -0,0 +1,106 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file logging_stack_level.h
+ * @brief Log levels that can be changed at runtime, per library.
+ *
+ * When #LOGGING_STACK_RUNTIME_LEVEL is 1, every log statement also checks the
+ * runtime level of its #LIBRARY_LOG_NAME with an atomic load. The
+ * compile-time #LIBRARY_LOG_LEVEL remains the most verbose level, as
+ * statements above it are not compiled.
+ *
+ * The initial levels are read from the environment variable named by
+ * #LOGGING_STACK_LEVELS_ENVIRONMENT, such as `LOG_LEVELS="MQTT=debug,*=warn"`,
+ * where `*` sets the level of every library not named.
+ */
+
+#ifndef LOGGING_STACK_LEVEL_H_
+#define LOGGING_STACK_LEVEL_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Include header for logging level macros. */
+#include "logging_levels.h"
+
+/**
+ * @brief Maximum number of libraries with a runtime level of their own.
+ *
+ * Further libraries share the level set for `*`.
+ */
+#ifndef LOGGING_STACK_MAX_LIBRARIES
+    #define LOGGING_STACK_MAX_LIBRARIES    ( 32U )
+#endif
+
+/**
+ * @brief Runtime level of libraries not configured otherwise.
+ *
+ * The default does not restrict the compile-time level.
+ */
+#ifndef LOGGING_STACK_DEFAULT_LEVEL
+    #define LOGGING_STACK_DEFAULT_LEVEL    LOG_DEBUG
+#endif
+
+/**
+ * @brief Environment variable from which the initial runtime levels are read.
+ */
+#ifndef LOGGING_STACK_LEVELS_ENVIRONMENT
+    #define LOGGING_STACK_LEVELS_ENVIRONMENT    "LOG_LEVELS"
+#endif
+
+/**
+ * @brief Get the runtime level of a library, to be read with an atomic load.
+ *
+ * The returned pointer stays valid, so each log statement looks it up once.
+ *
+ * @param[in] pLibraryName The #LIBRARY_LOG_NAME of the library.
+ *
+ * @return The level of the library.
+ */
+const int32_t * LoggingStack_GetLevelSlot( const char * pLibraryName );
+
+/**
+ * @brief Set the runtime level of a library.
+ *
+ * @param[in] pLibraryName The #LIBRARY_LOG_NAME of the library, or NULL to set
+ * the level of every library.
+ * @param[in] level #LOG_NONE, #LOG_ERROR, #LOG_WARN, #LOG_INFO or #LOG_DEBUG.
+ *
+ * @return true if the level was set; false if @p level is not valid, or if
+ * #LOGGING_STACK_MAX_LIBRARIES other libraries already have a level.
+ */
+bool LoggingStack_SetLevel( const char * pLibraryName,
+                            int32_t level );
+
+/**
+ * @brief Get the runtime level of a library.
+ *
+ * @param[in] pLibraryName The #LIBRARY_LOG_NAME of the library.
+ *
+ * @return The level of the library.
+ */
+int32_t LoggingStack_GetLevel( const char * pLibraryName );
+
+#endif /* ifndef LOGGING_STACK_LEVEL_H_ */
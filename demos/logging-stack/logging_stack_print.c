@@ -0,0 +1,377 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file logging_stack_print.c
+ * @brief Logging backends that print each log message with a single write.
+ */
+
+/* Standard includes. */
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "logging_stack_print.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Length of the line ending of log messages.
+ */
+#define LINE_ENDING_LENGTH    ( 2U )
+
+/**
+ * @brief Values of #LoggingStackJsonSite_t.state.
+ */
+#define PREFIX_UNFORMATTED    ( 0U ) /**< @brief The prefix has not been formatted. */
+#define PREFIX_FORMATTING     ( 1U ) /**< @brief A thread is formatting the prefix. */
+#define PREFIX_READY          ( 2U ) /**< @brief The prefix is copied from the site. */
+#define PREFIX_TOO_LONG       ( 3U ) /**< @brief The prefix is formatted at every run. */
+
+/**
+ * @brief End of the JSON object of a log message.
+ */
+#define JSON_ENDING           "\"}\r\n"
+
+/**
+ * @brief Length of #JSON_ENDING.
+ */
+#define JSON_ENDING_LENGTH    ( sizeof( JSON_ENDING ) - 1U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Appends characters to a buffer.
+ *
+ * @param[in,out] pBuffer The buffer.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in,out] pLength Length of the contents of @p pBuffer.
+ * @param[in] pString The characters to append.
+ * @param[in] stringLength The number of @p pString.
+ *
+ * @return false if the characters did not fit, in which case none were
+ * appended.
+ */
+static bool appendRaw( char * pBuffer,
+                       size_t bufferSize,
+                       size_t * pLength,
+                       const char * pString,
+                       size_t stringLength );
+
+/**
+ * @brief Appends characters to a buffer, escaped for a JSON string.
+ *
+ * @param[in,out] pBuffer The buffer.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in,out] pLength Length of the contents of @p pBuffer.
+ * @param[in] pString The characters to append.
+ * @param[in] stringLength The number of @p pString.
+ *
+ * @return false if not all the characters fit, in which case those that fit
+ * were appended.
+ */
+static bool appendEscaped( char * pBuffer,
+                           size_t bufferSize,
+                           size_t * pLength,
+                           const char * pString,
+                           size_t stringLength );
+
+/**
+ * @brief Formats the constant start of the JSON object of a log statement,
+ * up to the value of `ts`.
+ *
+ * @param[in] pSite The log statement.
+ * @param[out] pBuffer Where to format.
+ * @param[in] bufferSize Size of @p pBuffer.
+ *
+ * @return The length of the prefix, or 0 if it does not fit.
+ */
+static size_t formatJsonPrefix( const LoggingStackJsonSite_t * pSite,
+                                char * pBuffer,
+                                size_t bufferSize );
+
+/**
+ * @brief Gets the number of the calling thread, numbering threads from 1 in
+ * the order they first log.
+ *
+ * @return The number of the thread.
+ */
+static uint32_t getThreadNumber( void );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of threads that logged as JSON.
+ */
+static uint32_t threadCount = 0U;
+
+/**
+ * @brief Number of the calling thread, 0 until it first logs as JSON.
+ */
+static __thread uint32_t threadNumber = 0U;
+
+/*-----------------------------------------------------------*/
+
+static bool appendRaw( char * pBuffer,
+                       size_t bufferSize,
+                       size_t * pLength,
+                       const char * pString,
+                       size_t stringLength )
+{
+    bool fits = ( ( *pLength + stringLength ) <= bufferSize );
+
+    if( fits == true )
+    {
+        ( void ) memcpy( &pBuffer[ *pLength ], pString, stringLength );
+        *pLength += stringLength;
+    }
+
+    return fits;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool appendEscaped( char * pBuffer,
+                           size_t bufferSize,
+                           size_t * pLength,
+                           const char * pString,
+                           size_t stringLength )
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    char escape[ 6 ] = { '\\', 'u', '0', '0', '0', '0' };
+    unsigned char character = 0U;
+    size_t index = 0U;
+    bool fits = true;
+
+    for( index = 0U; ( index < stringLength ) && ( fits == true ); index++ )
+    {
+        character = ( unsigned char ) pString[ index ];
+
+        if( ( character == ( unsigned char ) '"' ) || ( character == ( unsigned char ) '\\' ) )
+        {
+            escape[ 1 ] = ( char ) character;
+            fits = appendRaw( pBuffer, bufferSize, pLength, escape, 2U );
+        }
+        else if( character < 0x20U )
+        {
+            escape[ 1 ] = 'u';
+            escape[ 4 ] = hexDigits[ character >> 4 ];
+            escape[ 5 ] = hexDigits[ character & 0x0FU ];
+            fits = appendRaw( pBuffer, bufferSize, pLength, escape, sizeof( escape ) );
+        }
+        else
+        {
+            fits = appendRaw( pBuffer, bufferSize, pLength, &pString[ index ], 1U );
+        }
+    }
+
+    return fits;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t formatJsonPrefix( const LoggingStackJsonSite_t * pSite,
+                                char * pBuffer,
+                                size_t bufferSize )
+{
+    const char * pFileName = strrchr( pSite->pFile, '/' );
+    const char * pCharacter = NULL;
+    /* The level is logged without its brackets. */
+    size_t levelLength = strlen( pSite->pLevel );
+    char numbers[ 32 ];
+    size_t length = 0U;
+    int written = 0;
+    uint32_t siteHash = 2166136261U;
+    uint32_t line = ( uint32_t ) pSite->line;
+    size_t index = 0U;
+    bool fits = ( levelLength >= 2U );
+
+    /* The ID of the site is the FNV-1a hash of the path, line and level. */
+    for( pCharacter = pSite->pFile; *pCharacter != '\0'; pCharacter++ )
+    {
+        siteHash = ( siteHash ^ ( uint8_t ) *pCharacter ) * 16777619U;
+    }
+
+    for( index = 0U; index < sizeof( line ); index++ )
+    {
+        siteHash = ( siteHash ^ ( uint8_t ) ( line >> ( index * 8U ) ) ) * 16777619U;
+    }
+
+    for( pCharacter = pSite->pLevel; *pCharacter != '\0'; pCharacter++ )
+    {
+        siteHash = ( siteHash ^ ( uint8_t ) *pCharacter ) * 16777619U;
+    }
+
+    pFileName = ( pFileName != NULL ) ? &pFileName[ 1 ] : pSite->pFile;
+
+    fits = fits && appendRaw( pBuffer, bufferSize, &length, "{\"lvl\":\"", 8U );
+    fits = fits && appendEscaped( pBuffer, bufferSize, &length, &pSite->pLevel[ 1 ], levelLength - 2U );
+    fits = fits && appendRaw( pBuffer, bufferSize, &length, "\",\"lib\":\"", 9U );
+    fits = fits && appendEscaped( pBuffer, bufferSize, &length, pSite->pLibrary, strlen( pSite->pLibrary ) );
+    written = snprintf( numbers, sizeof( numbers ), "\",\"site\":\"%08x\",\"file\":\"", ( unsigned int ) siteHash );
+    fits = fits && ( written > 0 ) && appendRaw( pBuffer, bufferSize, &length, numbers, ( size_t ) written );
+    fits = fits && appendEscaped( pBuffer, bufferSize, &length, pFileName, strlen( pFileName ) );
+    written = snprintf( numbers, sizeof( numbers ), "\",\"line\":%d,\"ts\":", pSite->line );
+    fits = fits && ( written > 0 ) && appendRaw( pBuffer, bufferSize, &length, numbers, ( size_t ) written );
+
+    return ( fits == true ) ? length : 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getThreadNumber( void )
+{
+    if( threadNumber == 0U )
+    {
+        threadNumber = __atomic_add_fetch( &threadCount, 1U, __ATOMIC_RELAXED );
+    }
+
+    return threadNumber;
+}
+
+/*-----------------------------------------------------------*/
+
+void LoggingStack_Print( const char * pLevel,
+                         const char * pLibrary,
+                         const char * pFileName,
+                         int line,
+                         const char * pFormat,
+                         ... )
+{
+    va_list arguments;
+    char buffer[ LOGGING_STACK_PRINT_BUFFER_SIZE ];
+    /* Keep room for the line ending. */
+    const size_t limit = sizeof( buffer ) - LINE_ENDING_LENGTH;
+    size_t length = 0U;
+    int written = 0;
+    bool fits = false;
+
+    written = snprintf( buffer, limit, "%s [%s] [%s:%d] ", pLevel, pLibrary, pFileName, line );
+
+    if( ( written >= 0 ) && ( ( size_t ) written < limit ) )
+    {
+        length = ( size_t ) written;
+
+        va_start( arguments, pFormat );
+        written = vsnprintf( &buffer[ length ], limit - length, pFormat, arguments );
+        va_end( arguments );
+
+        if( ( written >= 0 ) && ( ( size_t ) written < ( limit - length ) ) )
+        {
+            length += ( size_t ) written;
+            fits = true;
+        }
+    }
+
+    if( fits == true )
+    {
+        buffer[ length ] = '\r';
+        buffer[ length + 1U ] = '\n';
+        ( void ) fwrite( buffer, 1U, length + LINE_ENDING_LENGTH, stdout );
+    }
+    else
+    {
+        /* The message does not fit in the buffer. Hold the stdout lock so
+         * that it is not interleaved with the messages of other threads. */
+        flockfile( stdout );
+        ( void ) printf( "%s [%s] [%s:%d] ", pLevel, pLibrary, pFileName, line );
+        va_start( arguments, pFormat );
+        ( void ) vprintf( pFormat, arguments );
+        va_end( arguments );
+        ( void ) printf( "\r\n" );
+        funlockfile( stdout );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void LoggingStack_PrintJson( LoggingStackJsonSite_t * pSite,
+                             const char * pFormat,
+                             ... )
+{
+    va_list arguments;
+    char buffer[ LOGGING_STACK_PRINT_BUFFER_SIZE ];
+    char message[ LOGGING_STACK_PRINT_BUFFER_SIZE ];
+    /* Keep room for the end of the object. */
+    const size_t limit = sizeof( buffer ) - JSON_ENDING_LENGTH;
+    struct timespec now;
+    uint32_t timeMs = 0U;
+    uint32_t state = PREFIX_UNFORMATTED;
+    size_t length = 0U;
+    size_t messageLength = 0U;
+    int written = 0;
+
+    state = __atomic_load_n( &pSite->state, __ATOMIC_ACQUIRE );
+
+    if( ( state == PREFIX_UNFORMATTED ) &&
+        ( __atomic_compare_exchange_n( &pSite->state, &state, PREFIX_FORMATTING, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ) == true ) )
+    {
+        pSite->prefixLength = ( uint32_t ) formatJsonPrefix( pSite, pSite->prefix, sizeof( pSite->prefix ) );
+        state = ( pSite->prefixLength > 0U ) ? PREFIX_READY : PREFIX_TOO_LONG;
+        __atomic_store_n( &pSite->state, state, __ATOMIC_RELEASE );
+    }
+
+    if( state == PREFIX_READY )
+    {
+        ( void ) memcpy( buffer, pSite->prefix, pSite->prefixLength );
+        length = pSite->prefixLength;
+    }
+    else
+    {
+        /* Another thread is formatting the prefix, or it is too long to keep. */
+        length = formatJsonPrefix( pSite, buffer, limit );
+    }
+
+    /* The same time base as Clock_GetTimeMs. */
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+    timeMs = ( uint32_t ) ( ( ( uint64_t ) now.tv_sec * 1000U ) + ( ( uint64_t ) now.tv_nsec / 1000000U ) );
+
+    written = snprintf( message, sizeof( message ), "%lu,\"tid\":%lu,\"msg\":\"",
+                        ( unsigned long ) timeMs, ( unsigned long ) getThreadNumber() );
+
+    if( ( length > 0U ) && ( written > 0 ) &&
+        ( appendRaw( buffer, limit, &length, message, ( size_t ) written ) == true ) )
+    {
+        va_start( arguments, pFormat );
+        written = vsnprintf( message, sizeof( message ), pFormat, arguments );
+        va_end( arguments );
+
+        if( written > 0 )
+        {
+            messageLength = ( ( size_t ) written < sizeof( message ) ) ? ( size_t ) written : ( sizeof( message ) - 1U );
+
+            /* A message that does not fit is truncated. */
+            ( void ) appendEscaped( buffer, limit, &length, message, messageLength );
+        }
+
+        ( void ) memcpy( &buffer[ length ], JSON_ENDING, JSON_ENDING_LENGTH );
+        ( void ) fwrite( buffer, 1U, length + JSON_ENDING_LENGTH, stdout );
+    }
+}
+
+/*-----------------------------------------------------------*/
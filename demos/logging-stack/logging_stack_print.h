@@ -0,0 +1,136 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file logging_stack_print.h
+ * @brief Logging backends that print each log message with a single write.
+ *
+ * When #LOGGING_STACK_SINGLE_WRITE is 1, the logging macros of
+ * logging_stack.h expand to #LoggingStack_Print. The metadata prefix, the
+ * message and the line ending are formatted into a buffer on the stack of the
+ * logging thread and written to stdout at once, so that messages of different
+ * threads do not interleave.
+ *
+ * When #LOGGING_STACK_JSON is 1, they expand to #LoggingStack_PrintJson
+ * instead, which prints each message as a JSON object on a line of its own:
+ *
+ *     {"lvl":"INFO","lib":"MQTT","site":"5f3a09c1","file":"core_mqtt.c","line":42,"ts":123456,"tid":1,"msg":"..."}
+ *
+ * - `site` is a hash of the file path, line and level of the log statement,
+ *   which stays the same across runs of the same build.
+ * - `ts` is the time in milliseconds in the time base of `Clock_GetTimeMs`.
+ * - `tid` numbers the logging threads from 1, in the order they first log.
+ *
+ * Everything before `ts` is constant for a log statement. It is formatted on
+ * the first run of the statement and copied afterwards.
+ */
+
+#ifndef LOGGING_STACK_PRINT_H_
+#define LOGGING_STACK_PRINT_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/**
+ * @brief Size of the buffer in which a log message is formatted, including
+ * its metadata prefix and line ending.
+ *
+ * Longer messages are printed in several calls while holding the stdout lock.
+ */
+#ifndef LOGGING_STACK_PRINT_BUFFER_SIZE
+    #define LOGGING_STACK_PRINT_BUFFER_SIZE    ( 512U )
+#endif
+
+/**
+ * @brief Size of the buffer in which the constant start of the JSON object of
+ * a log statement is kept. Statements with a longer start format it at every
+ * run.
+ */
+#ifndef LOGGING_STACK_JSON_PREFIX_SIZE
+    #define LOGGING_STACK_JSON_PREFIX_SIZE    ( 128U )
+#endif
+
+/**
+ * @brief Lets GCC and Clang check the arguments of log messages against
+ * their formats, as they do for `printf`.
+ */
+#if defined( __GNUC__ )
+    #define LOGGING_STACK_PRINT_FORMAT_CHECK( formatIndex, firstArgument )    __attribute__( ( format( printf, formatIndex, firstArgument ) ) )
+#else
+    #define LOGGING_STACK_PRINT_FORMAT_CHECK( formatIndex, firstArgument )
+#endif
+
+/**
+ * @brief A log statement printed as JSON.
+ *
+ * One static instance exists per log statement.
+ */
+typedef struct LoggingStackJsonSite
+{
+    const char * pLevel;                            /**< @brief Level prefix, such as "[INFO]". */
+    const char * pLibrary;                          /**< @brief #LIBRARY_LOG_NAME of the statement. */
+    const char * pFile;                             /**< @brief File of the statement. */
+    int line;                                       /**< @brief Line of the statement. */
+    uint32_t state;                                 /**< @brief Whether #LoggingStackJsonSite_t.prefix has been formatted. */
+    uint32_t prefixLength;                          /**< @brief Length of #LoggingStackJsonSite_t.prefix. */
+    char prefix[ LOGGING_STACK_JSON_PREFIX_SIZE ]; /**< @brief Constant start of the JSON object. */
+} LoggingStackJsonSite_t;
+
+/**
+ * @brief Initializer of the #LoggingStackJsonSite_t of a log statement.
+ *
+ * @param[in] level The level prefix, such as "[INFO]".
+ * @param[in] library The library name.
+ */
+#define LOGGING_STACK_JSON_SITE( level, library )    { level, library, __FILE__, __LINE__, 0U, 0U, { 0 } }
+
+/**
+ * @brief Print a log message with its metadata prefix and line ending.
+ *
+ * @param[in] pLevel The level prefix, such as "[INFO]".
+ * @param[in] pLibrary The library name.
+ * @param[in] pFileName The file name of the log statement.
+ * @param[in] line The line of the log statement.
+ * @param[in] pFormat The `printf` format of the message.
+ */
+void LoggingStack_Print( const char * pLevel,
+                         const char * pLibrary,
+                         const char * pFileName,
+                         int line,
+                         const char * pFormat,
+                         ... ) LOGGING_STACK_PRINT_FORMAT_CHECK( 5, 6 );
+
+/**
+ * @brief Print a log message as a JSON object on a line of its own.
+ *
+ * Messages that do not fit in #LOGGING_STACK_PRINT_BUFFER_SIZE are truncated,
+ * so that the line stays valid JSON.
+ *
+ * @param[in] pSite The log statement.
+ * @param[in] pFormat The `printf` format of the message.
+ */
+void LoggingStack_PrintJson( LoggingStackJsonSite_t * pSite,
+                             const char * pFormat,
+                             ... ) LOGGING_STACK_PRINT_FORMAT_CHECK( 2, 3 );
+
+#endif /* ifndef LOGGING_STACK_PRINT_H_ */
@@ -0,0 +1,17 @@
+# This file is to add source files and include directories
+# into variables so that it can be reused from different demos
+# in their Cmake based build system by including this file.
+#
+# The MQTT connection builds on the outgoing QoS1 publish window, so demos
+# must also include publishWindowFilePaths.cmake and build its sources. It
+# waits for its socket with the event loop, so demos link event_loop_posix.
+# With MQTT_CONNECTION_COMPRESSION_ENABLED, demos also include
+# payloadCompressionFilePaths.cmake, build its sources and link z.
+
+# MQTT connection source files.
+set( MQTT_CONNECTION_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/mqtt_connection.c )
+
+# MQTT connection include directories.
+set( MQTT_CONNECTION_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
@@ -0,0 +1,3537 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_connection.c
+ * @brief Implementation of an MQTT connection to a broker over mutually
+ * authenticated TLS, shared by the demos.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the MQTT connection. */
+#include "mqtt_connection.h"
+
+/* MQTT state API header, to track the publishes sent in a batch. */
+#include "core_mqtt_state.h"
+
+/* OpenSSL sockets transport implementation. */
+#include "openssl_posix.h"
+
+/* Include backoff algorithm header for retry logic. */
+#include "backoff_algorithm.h"
+
+/* Clock for timer. */
+#include "clock.h"
+
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
+/* File keeping the outgoing publishes. */
+#include "publish_store.h"
+
+/* Event loop waiting for the socket and the keep-alive deadline. */
+#include "event_loop_posix.h"
+
+/* Registry of the metrics of the SDK, totalling the counters of all the
+ * connections. */
+#include "metrics.h"
+
+/**
+ * @brief ALPN protocol name for AWS IoT MQTT.
+ *
+ * This is used if the port of the broker is 443. Please see more details
+ * about the ALPN protocol for AWS IoT MQTT endpoint in the link below.
+ * https://aws.amazon.com/blogs/iot/mqtt-with-tls-client-authentication-on-port-443-why-it-is-useful-and-how-it-works/
+ */
+#define ALPN_PROTOCOL_NAME           "\x0ex-amzn-mqtt-ca"
+
+/**
+ * @brief Length of ALPN protocol name.
+ */
+#define ALPN_PROTOCOL_NAME_LENGTH    ( ( uint16_t ) ( sizeof( ALPN_PROTOCOL_NAME ) - 1 ) )
+
+/**
+ * @brief Invalid packet identifier for the MQTT packets. Zero is always an
+ * invalid packet identifier as per MQTT 3.1.1 spec.
+ */
+#define MQTT_PACKET_ID_INVALID       ( ( uint16_t ) 0U )
+
+/**
+ * @brief Maximum length of the bytes read ahead of an incoming packet: the
+ * type, a remaining length of up to 4 bytes and the length of the topic of a
+ * PUBLISH.
+ */
+#define INCOMING_PREFIX_MAX_LENGTH   ( 7U )
+
+/**
+ * @brief Add to a counter of a connection, and to the total of the counter
+ * over all the connections in the metrics registry.
+ */
+#define RECORD_METRIC( pConnection, field, count )                \
+    do                                                            \
+    {                                                             \
+        ( pConnection )->metrics.field += ( uint32_t ) ( count ); \
+        Metrics_Add( metricIds.field, ( uint64_t ) ( count ) );   \
+    } while( 0 )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    OpensslParams_t * pParams;
+    MqttConnection_t * pConnection;
+};
+
+#if ( MQTT_TRANSPORT_STATIC_BINDING == 1 )
+
+/* The TLS transport is called directly, so that the reads its read-ahead
+ * buffer holds are inlined. */
+    #define TRANSPORT_BINDING    TRANSPORT_BINDING_OPENSSL
+    #include "transport_binding_posix.h"
+
+    #define CONNECTION_RECV      TransportBinding_Recv /**< @brief Receive function of the transport of the connections. */
+    #define CONNECTION_SEND      TransportBinding_Send /**< @brief Send function of the transport of the connections. */
+#else
+    #define CONNECTION_RECV      Openssl_Recv
+    #define CONNECTION_SEND      Openssl_Send
+#endif
+
+/**
+ * @brief The incoming packet being read by the MQTT library, when the
+ * payloads larger than the network buffer are streamed.
+ *
+ * Its beginning is read ahead of the library. The remaining length of a
+ * streamed PUBLISH is then rewritten to cover its topic and packet identifier
+ * only, its payload being left in the transport for #receivePayload.
+ */
+typedef struct IncomingPacket
+{
+    uint8_t prefix[ INCOMING_PREFIX_MAX_LENGTH ]; /**< @brief Beginning of the packet, served to the library first. */
+    size_t prefixLength;                          /**< @brief Length of #IncomingPacket_t.prefix. */
+    size_t prefixOffset;                          /**< @brief Bytes of #IncomingPacket_t.prefix served. */
+    size_t bodyRemaining;                         /**< @brief Bytes after the prefix the library has yet to read. */
+    size_t payloadLength;                         /**< @brief Length of the payload of a streamed PUBLISH. */
+    size_t payloadRemaining;                      /**< @brief Bytes of the payload of a streamed PUBLISH left in the transport. */
+    bool failed;                                  /**< @brief Whether a read failed part way, failing the transport until the next connection. */
+} IncomingPacket_t;
+
+/**
+ * @brief What a wait for the events of the connection waits for, besides
+ * its timeout.
+ */
+typedef enum WaitCondition
+{
+    WaitForTimeout,  /**< @brief Nothing else; the wait lasts the whole timeout. */
+    WaitForSuback,   /**< @brief The SUBACK of #MqttConnection_t.subscribePacketId. */
+    WaitForUnsuback, /**< @brief The UNSUBACK of #MqttConnection_t.unsubscribePacketId. */
+    WaitForPubacks   /**< @brief The PUBACKs of all the publishes of the window. */
+} WaitCondition_t;
+
+/**
+ * @brief A publish serialized in the batch buffer.
+ */
+typedef struct StagedPublish
+{
+    const MQTTPublishInfo_t * pPublishInfo; /**< @brief The publish, as given to #MqttConnection_PublishBatch. */
+    uint16_t packetId;                      /**< @brief Packet identifier of the publish. */
+    size_t packetEnd;                       /**< @brief Offset of the end of the packet in the batch buffer. */
+} StagedPublish_t;
+
+#if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 )
+
+/**
+ * @brief Number of bits of the packet identifiers of
+ * #DuplicateFilter_t.packetIdBits, a power of two.
+ */
+    #define DUPLICATE_FILTER_BITS               ( 1024U )
+
+/**
+ * @brief Offset basis of the 32-bit FNV-1a hash.
+ */
+    #define FNV_OFFSET_BASIS                    ( 2166136261U )
+
+/**
+ * @brief Prime of the 32-bit FNV-1a hash.
+ */
+    #define FNV_PRIME                           ( 16777619U )
+
+/**
+ * @brief Index of the bit of a packet identifier in
+ * #DuplicateFilter_t.packetIdBits.
+ */
+    #define DUPLICATE_FILTER_BIT( packetId )    ( ( size_t ) ( packetId ) & ( DUPLICATE_FILTER_BITS - 1U ) )
+
+/**
+ * @brief An incoming QoS1 publish given to the event callback.
+ */
+    typedef struct DeliveredPublish
+    {
+        uint32_t hash;     /**< @brief FNV-1a hash of the topic and the payload. */
+        uint32_t timeMs;   /**< @brief Time of the delivery, or of the last copy suppressed. */
+        uint16_t packetId; /**< @brief Packet identifier given by the broker. */
+    } DeliveredPublish_t;
+
+/**
+ * @brief The last incoming QoS1 publishes delivered, against which those
+ * the broker sends again are matched.
+ *
+ * A bit is set for the packet identifiers of the ring, folded to
+ * #DUPLICATE_FILTER_BITS, so that a resent publish whose identifier is not
+ * in the ring is delivered without searching the ring.
+ */
+    typedef struct DuplicateFilter
+    {
+        uint32_t packetIdBits[ DUPLICATE_FILTER_BITS / 32U ];                  /**< @brief Bits of the packet identifiers of #DuplicateFilter_t.delivered. */
+        DeliveredPublish_t delivered[ MQTT_CONNECTION_DUPLICATE_RING_LENGTH ]; /**< @brief Ring of the publishes delivered. */
+        size_t next;                                                           /**< @brief Entry of #DuplicateFilter_t.delivered the next publish takes. */
+        size_t count;                                                          /**< @brief Entries of #DuplicateFilter_t.delivered in use. */
+    } DuplicateFilter_t;
+
+#endif /* if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 ) */
+
+/**
+ * @brief A connection created by #MqttConnection_Create.
+ */
+/**
+ * @brief Identifiers in the metrics registry of the counters of
+ * #MqttConnectionMetrics_t, totalled over all the connections.
+ */
+typedef struct MqttConnectionMetricIds
+{
+    MetricsId_t connectAttempts;       /**< @brief Total of #MqttConnectionMetrics_t.connectAttempts. */
+    MetricsId_t sessionsStarted;       /**< @brief Total of #MqttConnectionMetrics_t.sessionsStarted. */
+    MetricsId_t sessionsResumed;       /**< @brief Total of #MqttConnectionMetrics_t.sessionsResumed. */
+    MetricsId_t publishesSent;         /**< @brief Total of #MqttConnectionMetrics_t.publishesSent. */
+    MetricsId_t publishesResent;       /**< @brief Total of #MqttConnectionMetrics_t.publishesResent. */
+    MetricsId_t publishesQueued;       /**< @brief Total of #MqttConnectionMetrics_t.publishesQueued. */
+    MetricsId_t pubacksReceived;       /**< @brief Total of #MqttConnectionMetrics_t.pubacksReceived. */
+    MetricsId_t batchesSent;           /**< @brief Total of #MqttConnectionMetrics_t.batchesSent. */
+    MetricsId_t sendFailures;          /**< @brief Total of #MqttConnectionMetrics_t.sendFailures. */
+    MetricsId_t payloadsStreamed;      /**< @brief Total of #MqttConnectionMetrics_t.payloadsStreamed. */
+    MetricsId_t payloadsCompressed;    /**< @brief Total of #MqttConnectionMetrics_t.payloadsCompressed. */
+    MetricsId_t compressedInputBytes;  /**< @brief Total of #MqttConnectionMetrics_t.compressedInputBytes. */
+    MetricsId_t compressedOutputBytes; /**< @brief Total of #MqttConnectionMetrics_t.compressedOutputBytes. */
+    MetricsId_t payloadsDecompressed;  /**< @brief Total of #MqttConnectionMetrics_t.payloadsDecompressed. */
+    MetricsId_t compressionCpuUs;      /**< @brief Total of #MqttConnectionMetrics_t.compressionCpuUs. */
+    MetricsId_t duplicatesSuppressed;  /**< @brief Total of #MqttConnectionMetrics_t.duplicatesSuppressed. */
+    MetricsId_t connectLatencyMs;      /**< @brief Histogram of the durations of #MqttConnection_Connect. */
+} MqttConnectionMetricIds_t;
+
+struct MqttConnection
+{
+    MqttConnectionConfig_t config;                                          /**< @brief The broker and the session. */
+    MQTTContext_t context;                                                  /**< @brief The MQTT context of the session. */
+    NetworkContext_t networkContext;                                        /**< @brief Network context pointing to #MqttConnection_t.opensslParams. */
+    OpensslParams_t opensslParams;                                          /**< @brief TLS session of the connection. */
+    #if ( MQTT_TRANSPORT_STATIC_BINDING == 1 )
+        uint8_t recvBuffer[ MQTT_CONNECTION_RECV_BUFFER_SIZE ];             /**< @brief Read-ahead buffer of #MqttConnection_t.opensslParams. */
+    #endif
+    MQTTFixedBuffer_t networkBuffer;                                        /**< @brief Network buffer of the MQTT context. */
+    PublishWindow_t window;                                                 /**< @brief The publishes awaiting their PUBACK. */
+    PublishStore_t store;                                                   /**< @brief File keeping #MqttConnection_t.window, if #MqttConnection_t.hasStore. */
+    PublishQueue_t queue;                                                   /**< @brief The publishes issued while the broker is disconnected. */
+    uint8_t * pBatchBuffer;                                                 /**< @brief The PUBLISH packets of a batch, serialized back to back. */
+    size_t batchBufferSize;                                                 /**< @brief Size of #MqttConnection_t.pBatchBuffer. */
+    StagedPublish_t stagedPublishes[ MQTT_CONNECTION_BATCH_MAX_PUBLISHES ]; /**< @brief The publishes serialized in the batch buffer, in order. */
+    size_t stagedPublishCount;                                              /**< @brief Number of entries of #MqttConnection_t.stagedPublishes in use. */
+    uint16_t subscribePacketId;                                             /**< @brief Packet identifier of the last SUBSCRIBE, matched with its SUBACK. */
+    uint16_t unsubscribePacketId;                                           /**< @brief Packet identifier of the last UNSUBSCRIBE, matched with its UNSUBACK. */
+    size_t earlyConnectLength;                                              /**< @brief Bytes of the CONNECT sent by the TLS connection, which the transport skips when the library sends the CONNECT. */
+    MqttConnectionMetrics_t metrics;                                        /**< @brief Counters of the activity of the connection. */
+    uint32_t adaptiveTimeoutMs;                                             /**< @brief Timeout derived from the round trip time, if #MqttConnectionConfig_t.adaptiveTimeouts; 0 until sampled. */
+    uint32_t lastRttSampleMs;                                               /**< @brief Time at which the round trip time was last sampled. */
+    uint32_t retransmits;                                                   /**< @brief Segments the socket retransmitted as of the last sample. */
+    IncomingPacket_t incoming;                                              /**< @brief The packet being received, if payloads are streamed. */
+    #if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 )
+        DuplicateFilter_t duplicates;                                       /**< @brief The publishes delivered, to suppress those sent again. */
+    #endif
+    #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+        MqttConnectionCompression_t compressionConfig;                      /**< @brief The topics to compress and the memory of the compression. */
+        PayloadCompression_t compression;                                   /**< @brief Streams of the compression, if #MqttConnection_t.compressionReady. */
+        bool compressionReady;                                              /**< @brief Whether #MqttConnection_SetCompression was called. */
+    #endif
+    EventLoop_t eventLoop;                                                  /**< @brief Event loop of the socket and of the keep-alive deadline. */
+    EventLoopConnection_t loopConnection;                                   /**< @brief The socket of the TLS session in #MqttConnection_t.eventLoop. */
+    MQTTStatus_t loopStatus;                                                /**< @brief Status of the packets processed by the callback of the event loop. */
+    bool socketRegistered;                                                  /**< @brief Whether #MqttConnection_t.loopConnection is registered. */
+    bool transportConnected;                                                /**< @brief Whether the TLS session is open. */
+    bool hasStore;                                                          /**< @brief Whether #MqttConnection_t.store is open. */
+    bool sessionEstablished;                                                /**< @brief Whether a DISCONNECT is due. */
+    bool brokerConnected;                                                   /**< @brief Whether publishes are sent rather than queued. */
+    bool inUse;                                                             /**< @brief Whether the connection is created. */
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The connections, found by their MQTT context from the event
+ * callback.
+ */
+static MqttConnection_t connections[ MQTT_CONNECTION_MAX_INSTANCES ];
+
+/**
+ * @brief The metrics of all the connections, registered with the first
+ * connection.
+ */
+static MqttConnectionMetricIds_t metricIds;
+
+/**
+ * @brief Registers #metricIds once.
+ */
+static pthread_once_t metricsOnce = PTHREAD_ONCE_INIT;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Register the metrics of all the connections in the metrics
+ * registry.
+ *
+ * A metric that cannot be registered is not recorded.
+ */
+static void registerMetrics( void );
+
+/**
+ * @brief The random number generator to use for exponential backoff with
+ * jitter retry logic.
+ *
+ * @return The generated random number.
+ */
+static uint32_t generateRandomNumber();
+
+/**
+ * @brief Connect to the broker with reconnection retries.
+ *
+ * If connection fails, retry is attempted after a timeout. Timeout value
+ * exponentially increases until maximum timeout value is reached or the number
+ * of attempts are exhausted.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if the TLS connection is established; false otherwise.
+ */
+static bool connectWithBackoffRetries( MqttConnection_t * pConnection );
+
+/**
+ * @brief Serialize the CONNECT into the network buffer, for the TLS
+ * connection to send as early data.
+ *
+ * The MQTT library serializes the same CONNECT again, and
+ * #MqttConnection_t.earlyConnectLength of its bytes are skipped.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pConnectInfo The CONNECT.
+ */
+static void prepareEarlyConnect( MqttConnection_t * pConnection,
+                                 const MQTTConnectInfo_t * pConnectInfo );
+
+/**
+ * @brief Receive exactly @p length bytes from the TLS connection.
+ *
+ * @param[in] pConnection The connection.
+ * @param[out] pBuffer The bytes received.
+ * @param[in] length Number of bytes to receive.
+ *
+ * @return true if the bytes are received; false if the transport failed or
+ * received nothing for #MqttConnectionConfig_t.transportTimeoutMs.
+ */
+static bool receiveExact( MqttConnection_t * pConnection,
+                          uint8_t * pBuffer,
+                          size_t length );
+
+/**
+ * @brief Read the beginning of the next incoming packet into
+ * #MqttConnection_t.incoming, choosing whether its payload is streamed.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return The length of the prefix; 0 if no packet is pending; a negative
+ * value if the transport failed.
+ */
+static int32_t receivePacketStart( MqttConnection_t * pConnection );
+
+/**
+ * @brief The receive function of the transport interface when payloads are
+ * streamed, serving the library the incoming packets as rewritten by
+ * #receivePacketStart.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[out] pBuffer The bytes received.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return The number of bytes received; a negative value on failure.
+ */
+static int32_t receiveTransport( NetworkContext_t * pNetworkContext,
+                                 void * pBuffer,
+                                 size_t bytesToRecv );
+
+/**
+ * @brief The send function of the transport interface when payloads are
+ * streamed. It fails after a failed read, so that a PUBLISH whose payload
+ * was not received whole is not acknowledged.
+ *
+ * @param[in] pNetworkContext The network context.
+ * @param[in] pBuffer The bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return The number of bytes sent; a negative value on failure.
+ */
+static int32_t sendTransport( NetworkContext_t * pNetworkContext,
+                              const void * pBuffer,
+                              size_t bytesToSend );
+
+/**
+ * @brief Receive the payload of a streamed PUBLISH, into the memory of
+ * #MqttConnectionConfig_t.payloadBufferCallback or in chunks for
+ * #MqttConnectionConfig_t.payloadChunkCallback, and point the publish at it.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPacketInfo The PUBLISH, whose topic and packet identifier are
+ * at the beginning of the network buffer.
+ * @param[in,out] pPublishInfo The deserialized PUBLISH.
+ *
+ * @return true if the payload is received; false otherwise.
+ */
+static bool receivePayload( MqttConnection_t * pConnection,
+                            const MQTTPacketInfo_t * pPacketInfo,
+                            MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Find the connection of an MQTT context.
+ *
+ * @param[in] pMqttContext The MQTT context.
+ *
+ * @return The connection; NULL if none has the context.
+ */
+static MqttConnection_t * findConnection( const MQTTContext_t * pMqttContext );
+
+/**
+ * @brief The event callback of the MQTT contexts. The PUBACKs remove their
+ * publish from the window, then every packet is given to the callback of the
+ * connection.
+ *
+ * @param[in] pMqttContext MQTT context pointer.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Check whether the TLS connection holds received data which the
+ * socket no longer reports as readable.
+ *
+ * @param[in] pOpensslParams The TLS session.
+ *
+ * @return true if data is buffered; false otherwise.
+ */
+static bool hasBufferedData( const OpensslParams_t * pOpensslParams );
+
+/**
+ * @brief Get the timeout to use in place of a configured one.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] configuredMs The configured timeout.
+ *
+ * @return The timeout derived from the round trip time, if sampled;
+ * @p configuredMs otherwise.
+ */
+static uint32_t effectiveTimeout( const MqttConnection_t * pConnection,
+                                  uint32_t configuredMs );
+
+/**
+ * @brief Sample the round trip time of the socket, and derive the timeouts
+ * of the connection and of its socket from it.
+ *
+ * The timeouts are not shortened while segments are being retransmitted.
+ *
+ * @param[in] pConnection The connection, with
+ * #MqttConnectionConfig_t.adaptiveTimeouts.
+ */
+static void adaptTimeouts( MqttConnection_t * pConnection );
+
+/**
+ * @brief Send a PINGREQ once the connection has been idle for the keep-alive
+ * interval, and check that the PINGRESP of the last one was received in time.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return MQTTSuccess if the connection is alive; MQTTKeepAliveTimeout if
+ * no PINGRESP was received in time; the status of MQTT_Ping otherwise.
+ */
+static MQTTStatus_t manageKeepAlive( MqttConnection_t * pConnection );
+
+/**
+ * @brief Set the deadline of the socket to the time at which the next
+ * PINGREQ is due, or at which the PINGRESP of the last one is late.
+ *
+ * @param[in] pConnection The connection.
+ */
+static void scheduleKeepAlive( MqttConnection_t * pConnection );
+
+/**
+ * @brief Process the packets received, as many as the TLS connection holds,
+ * through the event callback.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return The status of the last call to MQTT_ProcessLoop.
+ */
+static MQTTStatus_t processReceivedPackets( MqttConnection_t * pConnection );
+
+/**
+ * @brief The callback of the socket in the event loop, processing the
+ * packets received as soon as the socket is readable, and the keep-alive when
+ * its deadline is due. Its status is kept in #MqttConnection_t.loopStatus.
+ *
+ * @param[in] pLoopConnection The socket, whose user context is the
+ * connection.
+ * @param[in] events The EVENT_LOOP_EVENT_* values that occurred.
+ */
+static void handleSocketEvents( EventLoopConnection_t * pLoopConnection,
+                                uint32_t events );
+
+/**
+ * @brief Register the socket of a new TLS session with the event loop,
+ * replacing the socket of the previous one.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if the socket is registered; false otherwise.
+ */
+static bool registerSocket( MqttConnection_t * pConnection );
+
+/**
+ * @brief Unregister the socket of the TLS session from the event loop, if
+ * registered.
+ *
+ * @param[in] pConnection The connection.
+ */
+static void unregisterSocket( MqttConnection_t * pConnection );
+
+/**
+ * @brief Close the TLS session, if open, once its socket has left the event
+ * loop.
+ *
+ * @param[in] pConnection The connection.
+ */
+static void closeTransport( MqttConnection_t * pConnection );
+
+/**
+ * @brief Check whether what a wait for events waits for has happened.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] condition What the wait waits for.
+ *
+ * @return true if the wait can end before its timeout; false otherwise.
+ */
+static bool isWaitOver( MqttConnection_t * pConnection,
+                        WaitCondition_t condition );
+
+/**
+ * @brief Process the packets received and the keep-alive until @p condition
+ * holds or @p timeoutMs elapsed. The packets are processed as soon as they
+ * arrive, so the wait ends as soon as the awaited acknowledgement does.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] timeoutMs Longest time to wait; 0 processes what is already
+ * received only.
+ * @param[in] condition What to wait for.
+ *
+ * @return MQTTSuccess if no processing failed, even if @p condition does not
+ * hold; the status of the processing that failed otherwise.
+ */
+static MQTTStatus_t waitForEvents( MqttConnection_t * pConnection,
+                                   uint32_t timeoutMs,
+                                   WaitCondition_t condition );
+
+/**
+ * @brief Drop all the outgoing publishes of the window.
+ *
+ * @param[in] pConnection The connection.
+ */
+static void cleanupOutgoingPublishes( MqttConnection_t * pConnection );
+
+/**
+ * @brief Add a publish to the window, and to the store if any.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] packetId Packet identifier of the publish.
+ * @param[in] pPublishInfo The publish.
+ *
+ * @return true if the publish is added; false otherwise.
+ */
+static bool addOutgoingPublish( MqttConnection_t * pConnection,
+                                uint16_t packetId,
+                                const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Remove a publish from the window, and release its queued copy.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] packetId Packet identifier of the publish.
+ *
+ * @return true if the publish is removed; false if it is not in the window.
+ */
+static bool removeOutgoingPublish( MqttConnection_t * pConnection,
+                                   uint16_t packetId );
+
+/**
+ * @brief Get a packet identifier for a new publish.
+ *
+ * The MQTT library restarts its packet ids with each session, so the ids of
+ * the publishes resent from an earlier session are skipped.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return The packet identifier.
+ */
+static uint16_t getNextPacketId( MqttConnection_t * pConnection );
+
+/**
+ * @brief Resend the publishes of the window, in the order they were first
+ * sent, after the broker resumed the session.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if the publishes are resent; false otherwise.
+ */
+static bool handlePublishResend( MqttConnection_t * pConnection );
+
+/**
+ * @brief Queue a publish until the broker is connected again.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The publish.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionNoMemory or
+ * #MqttConnectionBadParameter.
+ */
+static MqttConnectionStatus_t queueOfflinePublish( MqttConnection_t * pConnection,
+                                                   const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Send the queued publishes, in batches of
+ * #MqttConnectionConfig_t.drainBatchSize separated by the processing of
+ * their PUBACKs.
+ *
+ * The draining stops when the window is full, the publishes left being sent
+ * after the next publishes.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if the publishes could be sent; false otherwise.
+ */
+static bool drainOfflinePublishes( MqttConnection_t * pConnection );
+
+/**
+ * @brief Send the queued publishes the window had no room for, and flush the
+ * store, after publishes were sent.
+ *
+ * @param[in] pConnection The connection.
+ */
+static void completePublishes( MqttConnection_t * pConnection );
+
+/**
+ * @brief Serialize a QoS1 publish at the end of the batch buffer. The
+ * publish is given a packet identifier, and added to the window and to the
+ * state of the MQTT library.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The publish; its topic and payload must remain
+ * valid until its PUBACK.
+ *
+ * @return MQTTSuccess if the publish is serialized; MQTTNoMemory if the
+ * batch or the window is full; another status if the publish is invalid.
+ */
+static MQTTStatus_t stagePublish( MqttConnection_t * pConnection,
+                                  const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Send the staged publishes with as few transport writes as the
+ * transport allows. The publishes written whole are marked as sent in the
+ * state of the MQTT library.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPackets The packets of the staged publishes, back to back: the
+ * batch buffer, or the packet of a publish sent in place.
+ *
+ * @return The number of publishes written whole, from the first one. It is
+ * less than #MqttConnection_t.stagedPublishCount if the connection failed.
+ */
+static size_t sendStagedPublishes( MqttConnection_t * pConnection,
+                                   const uint8_t * pPackets );
+
+#if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+
+/**
+ * @brief CPU time of the calling thread, in microseconds.
+ */
+    static uint64_t getCpuTimeUs( void );
+
+/**
+ * @brief Find the compression rule of a topic.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pTopicName The topic.
+ * @param[in] topicNameLength Length of @p pTopicName.
+ *
+ * @return The first rule matching the topic, or NULL if it is not
+ * compressed.
+ */
+    static const MqttConnectionCompressionRule_t * findCompressionRule( const MqttConnection_t * pConnection,
+                                                                        const char * pTopicName,
+                                                                        uint16_t topicNameLength );
+
+/**
+ * @brief Compress the payload of a publish about to be added to the window,
+ * into the slot of the window entry it is about to take, so that the
+ * compressed payload remains valid until the PUBACK.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The publish.
+ * @param[out] pCompressedInfo The publish with the compressed payload.
+ *
+ * @return @p pCompressedInfo if the payload was compressed, or
+ * @p pPublishInfo if it is to be sent as it is.
+ */
+    static const MQTTPublishInfo_t * compressPublish( MqttConnection_t * pConnection,
+                                                      const MQTTPublishInfo_t * pPublishInfo,
+                                                      MQTTPublishInfo_t * pCompressedInfo );
+
+/**
+ * @brief Decompress the payload of an incoming publish of a compressed
+ * topic into the inflate buffer.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in,out] pPublishInfo The publish, whose payload is replaced by the
+ * decompressed one.
+ *
+ * @return false if the payload is compressed but could not be
+ * decompressed, so that it is not given to the application.
+ */
+    static bool decompressPublish( MqttConnection_t * pConnection,
+                                   MQTTPublishInfo_t * pPublishInfo );
+
+#endif /* if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 ) */
+
+#if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 )
+
+/**
+ * @brief Compute the FNV-1a hash of the topic and the payload of a publish.
+ *
+ * @param[in] pPublishInfo The publish.
+ *
+ * @return The hash.
+ */
+    static uint32_t hashPublish( const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Tell whether an incoming QoS1 publish is one the broker sends again
+ * after it was delivered, and record it as delivered if it is not.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The publish.
+ * @param[in] packetId Packet identifier of the publish.
+ *
+ * @return true if the publish is not to be given to the event callback.
+ */
+    static bool isDuplicatePublish( MqttConnection_t * pConnection,
+                                    const MQTTPublishInfo_t * pPublishInfo,
+                                    uint16_t packetId );
+
+#endif /* if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static uint32_t generateRandomNumber()
+{
+    return Random_GetUint32();
+}
+
+/*-----------------------------------------------------------*/
+
+static void registerMetrics( void )
+{
+    ( void ) Metrics_Register( "mqtt_connect_attempts_total", "TLS connections attempted, retries included.",
+                               METRICS_TYPE_COUNTER, &( metricIds.connectAttempts ) );
+    ( void ) Metrics_Register( "mqtt_sessions_started_total", "Clean sessions established.",
+                               METRICS_TYPE_COUNTER, &( metricIds.sessionsStarted ) );
+    ( void ) Metrics_Register( "mqtt_sessions_resumed_total", "Sessions resumed by the broker.",
+                               METRICS_TYPE_COUNTER, &( metricIds.sessionsResumed ) );
+    ( void ) Metrics_Register( "mqtt_publishes_sent_total", "QoS1 publishes sent for the first time.",
+                               METRICS_TYPE_COUNTER, &( metricIds.publishesSent ) );
+    ( void ) Metrics_Register( "mqtt_publishes_resent_total", "Publishes resent when a session was resumed.",
+                               METRICS_TYPE_COUNTER, &( metricIds.publishesResent ) );
+    ( void ) Metrics_Register( "mqtt_publishes_queued_total", "Publishes queued while the broker was disconnected.",
+                               METRICS_TYPE_COUNTER, &( metricIds.publishesQueued ) );
+    ( void ) Metrics_Register( "mqtt_pubacks_received_total", "PUBACKs of the publishes of the window.",
+                               METRICS_TYPE_COUNTER, &( metricIds.pubacksReceived ) );
+    ( void ) Metrics_Register( "mqtt_batches_sent_total", "Batches of publishes written.",
+                               METRICS_TYPE_COUNTER, &( metricIds.batchesSent ) );
+    ( void ) Metrics_Register( "mqtt_send_failures_total", "Sends that failed, each marking the broker as disconnected.",
+                               METRICS_TYPE_COUNTER, &( metricIds.sendFailures ) );
+    ( void ) Metrics_Register( "mqtt_payloads_streamed_total", "Incoming payloads streamed past the network buffer.",
+                               METRICS_TYPE_COUNTER, &( metricIds.payloadsStreamed ) );
+    ( void ) Metrics_Register( "mqtt_payloads_compressed_total", "Outgoing payloads compressed before they were sent.",
+                               METRICS_TYPE_COUNTER, &( metricIds.payloadsCompressed ) );
+    ( void ) Metrics_Register( "mqtt_compressed_input_bytes_total", "Bytes of the compressed outgoing payloads, before compression.",
+                               METRICS_TYPE_COUNTER, &( metricIds.compressedInputBytes ) );
+    ( void ) Metrics_Register( "mqtt_compressed_output_bytes_total", "Bytes of the compressed outgoing payloads, headers included.",
+                               METRICS_TYPE_COUNTER, &( metricIds.compressedOutputBytes ) );
+    ( void ) Metrics_Register( "mqtt_payloads_decompressed_total", "Incoming payloads decompressed.",
+                               METRICS_TYPE_COUNTER, &( metricIds.payloadsDecompressed ) );
+    ( void ) Metrics_Register( "mqtt_compression_cpu_us_total", "CPU time of the payload compression and decompression, in microseconds.",
+                               METRICS_TYPE_COUNTER, &( metricIds.compressionCpuUs ) );
+    ( void ) Metrics_Register( "mqtt_duplicates_suppressed_total", "Incoming publishes sent again by the broker and not dispatched.",
+                               METRICS_TYPE_COUNTER, &( metricIds.duplicatesSuppressed ) );
+    ( void ) Metrics_Register( "mqtt_connect_duration_ms", "Durations of the connections to the broker, retries included.",
+                               METRICS_TYPE_HISTOGRAM, &( metricIds.connectLatencyMs ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool connectWithBackoffRetries( MqttConnection_t * pConnection )
+{
+    bool returnStatus = false;
+    BackoffAlgorithmStatus_t backoffAlgStatus = BackoffAlgorithmSuccess;
+    OpensslStatus_t opensslStatus = OPENSSL_SUCCESS;
+    BackoffAlgorithmContext_t reconnectParams;
+    ServerInfo_t serverInfo;
+    OpensslCredentials_t opensslCredentials;
+    uint16_t nextRetryBackOff = 0U;
+    const MqttConnectionConfig_t * pConfig = &( pConnection->config );
+
+    /* Set the pParams member of the network context with desired transport. */
+    pConnection->networkContext.pParams = &( pConnection->opensslParams );
+    pConnection->networkContext.pConnection = pConnection;
+
+    #if ( MQTT_TRANSPORT_STATIC_BINDING == 1 )
+        pConnection->opensslParams.pRecvBuffer = pConnection->recvBuffer;
+        pConnection->opensslParams.recvBufferSize = sizeof( pConnection->recvBuffer );
+    #endif
+
+    /* Initialize information to connect to the MQTT broker. */
+    serverInfo.pHostName = pConfig->pHostName;
+    serverInfo.hostNameLength = pConfig->hostNameLength;
+    serverInfo.port = pConfig->port;
+    serverInfo.pSocketOptions = NULL;
+
+    /* Initialize credentials for establishing TLS session. */
+    ( void ) memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    opensslCredentials.pRootCaPath = pConfig->pRootCaPath;
+    opensslCredentials.pClientCertPath = pConfig->pClientCertPath;
+    opensslCredentials.pPrivateKeyPath = pConfig->pPrivateKeyPath;
+    opensslCredentials.sniHostName = pConfig->pHostName;
+
+    /* Reconnects reuse the parsed credentials and skip SSL_CTX_new. The
+     * cached context is released by MqttConnection_Destroy. */
+    opensslCredentials.cacheSslContext = true;
+
+    /* Early data can only be sent on a resumed TLS session. */
+    opensslCredentials.cacheSession = ( pConfig->earlyConnect == true ) &&
+                                      ( pConfig->earlyDataReplaySafe == true );
+
+    opensslCredentials.releaseIdleBuffers = pConfig->releaseIdleBuffers;
+    opensslCredentials.maxFragmentLength = pConfig->maxFragmentLength;
+    opensslCredentials.ocspMode = pConfig->ocspMode;
+    opensslCredentials.cacheVerifiedChains = pConfig->cacheVerifiedChains;
+
+    if( pConnection->earlyConnectLength > 0U )
+    {
+        opensslCredentials.pEarlyData = pConnection->networkBuffer.pBuffer;
+        opensslCredentials.earlyDataLength = pConnection->earlyConnectLength;
+        opensslCredentials.earlyDataReplaySafe = pConfig->earlyDataReplaySafe;
+    }
+
+    if( pConfig->port == 443U )
+    {
+        /* Pass the ALPN protocol name depending on the port being used. */
+        opensslCredentials.pAlpnProtos = ALPN_PROTOCOL_NAME;
+        opensslCredentials.alpnProtosLen = ALPN_PROTOCOL_NAME_LENGTH;
+    }
+
+    /* Initialize reconnect attempts and interval */
+    BackoffAlgorithm_InitializeParams( &reconnectParams,
+                                       pConfig->retryBaseMs,
+                                       pConfig->retryMaxDelayMs,
+                                       pConfig->retryMaxAttempts );
+
+    /* Attempt to connect to MQTT broker. If connection fails, retry after
+     * a timeout. Timeout value will exponentially increase until maximum
+     * attempts are reached.
+     */
+    do
+    {
+        LogInfo( ( "Establishing a TLS session to %.*s:%d.",
+                   pConfig->hostNameLength,
+                   pConfig->pHostName,
+                   pConfig->port ) );
+        RECORD_METRIC( pConnection, connectAttempts, 1U );
+        opensslStatus = Openssl_Connect( &( pConnection->networkContext ),
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         pConfig->transportTimeoutMs,
+                                         pConfig->transportTimeoutMs );
+
+        if( opensslStatus == OPENSSL_SUCCESS )
+        {
+            returnStatus = true;
+        }
+        else
+        {
+            /* Generate a random number and get back-off value (in milliseconds) for the next connection retry. */
+            backoffAlgStatus = BackoffAlgorithm_GetNextBackoff( &reconnectParams, generateRandomNumber(), &nextRetryBackOff );
+
+            if( backoffAlgStatus == BackoffAlgorithmRetriesExhausted )
+            {
+                LogError( ( "Connection to the broker failed, all attempts exhausted." ) );
+            }
+            else if( backoffAlgStatus == BackoffAlgorithmSuccess )
+            {
+                LogWarn( ( "Connection to the broker failed. Retrying connection "
+                           "after %hu ms backoff.",
+                           ( unsigned short ) nextRetryBackOff ) );
+                Clock_SleepMs( nextRetryBackOff );
+            }
+        }
+    } while( ( opensslStatus != OPENSSL_SUCCESS ) && ( backoffAlgStatus == BackoffAlgorithmSuccess ) );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prepareEarlyConnect( MqttConnection_t * pConnection,
+                                 const MQTTConnectInfo_t * pConnectInfo )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    size_t remainingLength = 0U, packetSize = 0U;
+
+    pConnection->earlyConnectLength = 0U;
+
+    mqttStatus = MQTT_GetConnectPacketSize( pConnectInfo,
+                                            NULL,
+                                            &remainingLength,
+                                            &packetSize );
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        mqttStatus = MQTT_SerializeConnect( pConnectInfo,
+                                            NULL,
+                                            remainingLength,
+                                            &( pConnection->networkBuffer ) );
+    }
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        pConnection->earlyConnectLength = packetSize;
+    }
+    else
+    {
+        /* The library reports the error when it sends the CONNECT. */
+        LogWarn( ( "Failed to serialize the CONNECT as early data: %s.",
+                   MQTT_Status_strerror( mqttStatus ) ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receiveExact( MqttConnection_t * pConnection,
+                          uint8_t * pBuffer,
+                          size_t length )
+{
+    bool returnStatus = true;
+    size_t bytesReceived = 0U;
+    int32_t recvStatus = 0;
+    uint32_t lastProgressMs = Clock_GetTimeMs();
+
+    while( ( returnStatus == true ) && ( bytesReceived < length ) )
+    {
+        recvStatus = CONNECTION_RECV( &( pConnection->networkContext ),
+                                      &( pBuffer[ bytesReceived ] ),
+                                      length - bytesReceived );
+
+        if( recvStatus < 0 )
+        {
+            returnStatus = false;
+        }
+        else if( recvStatus > 0 )
+        {
+            bytesReceived += ( size_t ) recvStatus;
+            lastProgressMs = Clock_GetTimeMs();
+        }
+        else if( ( Clock_GetTimeMs() - lastProgressMs ) >= effectiveTimeout( pConnection, pConnection->config.transportTimeoutMs ) )
+        {
+            returnStatus = false;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t receivePacketStart( MqttConnection_t * pConnection )
+{
+    IncomingPacket_t * pIncoming = &( pConnection->incoming );
+    int32_t returnStatus = 0;
+    size_t remainingLength = 0U;
+    size_t multiplier = 1U;
+    size_t varHeaderLength = 0U;
+    size_t encodedLength = 0U;
+    uint16_t topicLength = 0U;
+    uint8_t encodedByte = 0x80U;
+    bool success = true;
+
+    pIncoming->prefixLength = 0U;
+    pIncoming->prefixOffset = 0U;
+    pIncoming->bodyRemaining = 0U;
+
+    /* The packet type, which may not have arrived yet. */
+    returnStatus = CONNECTION_RECV( &( pConnection->networkContext ), pIncoming->prefix, 1U );
+
+    if( returnStatus > 0 )
+    {
+        pIncoming->prefixLength = 1U;
+
+        /* The rest of the fixed header is read whole, as the library does. */
+        while( ( success == true ) && ( ( encodedByte & 0x80U ) != 0U ) )
+        {
+            if( pIncoming->prefixLength == 5U )
+            {
+                LogError( ( "Invalid remaining length of an incoming packet." ) );
+                success = false;
+            }
+            else
+            {
+                success = receiveExact( pConnection, &( pIncoming->prefix[ pIncoming->prefixLength ] ), 1U );
+            }
+
+            if( success == true )
+            {
+                encodedByte = pIncoming->prefix[ pIncoming->prefixLength ];
+                remainingLength += ( size_t ) ( encodedByte & 0x7FU ) * multiplier;
+                multiplier *= 128U;
+                pIncoming->prefixLength++;
+            }
+        }
+    }
+
+    if( ( success == true ) && ( returnStatus > 0 ) )
+    {
+        pIncoming->bodyRemaining = remainingLength;
+
+        /* A PUBLISH the library would have to drop. */
+        if( ( ( pIncoming->prefix[ 0 ] & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH ) &&
+            ( remainingLength > pConnection->networkBuffer.size ) )
+        {
+            success = receiveExact( pConnection, &( pIncoming->prefix[ pIncoming->prefixLength ] ), 2U );
+
+            if( success == true )
+            {
+                topicLength = ( uint16_t ) ( ( ( uint16_t ) pIncoming->prefix[ pIncoming->prefixLength ] << 8 ) |
+                                             pIncoming->prefix[ pIncoming->prefixLength + 1U ] );
+                varHeaderLength = 2U + ( size_t ) topicLength;
+
+                /* A nonzero QoS adds the packet identifier. */
+                if( ( pIncoming->prefix[ 0 ] & 0x06U ) != 0U )
+                {
+                    varHeaderLength += 2U;
+                }
+
+                if( ( varHeaderLength < pConnection->networkBuffer.size ) &&
+                    ( varHeaderLength <= remainingLength ) )
+                {
+                    /* The remaining length is rewritten to end the packet
+                     * with its variable header. */
+                    pIncoming->payloadLength = remainingLength - varHeaderLength;
+                    pIncoming->payloadRemaining = pIncoming->payloadLength;
+                    encodedLength = varHeaderLength;
+                    pIncoming->prefixLength = 1U;
+
+                    do
+                    {
+                        encodedByte = ( uint8_t ) ( encodedLength & 0x7FU );
+                        encodedLength >>= 7;
+
+                        if( encodedLength > 0U )
+                        {
+                            encodedByte |= 0x80U;
+                        }
+
+                        pIncoming->prefix[ pIncoming->prefixLength ] = encodedByte;
+                        pIncoming->prefixLength++;
+                    } while( encodedLength > 0U );
+
+                    pIncoming->prefix[ pIncoming->prefixLength ] = ( uint8_t ) ( topicLength >> 8 );
+                    pIncoming->prefix[ pIncoming->prefixLength + 1U ] = ( uint8_t ) ( topicLength & 0xFFU );
+                    pIncoming->prefixLength += 2U;
+                    pIncoming->bodyRemaining = varHeaderLength - 2U;
+                }
+                else
+                {
+                    /* The topic alone does not fit, so the library drops
+                     * the packet unchanged. */
+                    pIncoming->prefixLength += 2U;
+                    pIncoming->bodyRemaining = remainingLength - 2U;
+                }
+            }
+        }
+    }
+
+    if( ( success == false ) || ( returnStatus < 0 ) )
+    {
+        pIncoming->failed = true;
+        returnStatus = -1;
+    }
+    else if( returnStatus > 0 )
+    {
+        returnStatus = ( int32_t ) pIncoming->prefixLength;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t receiveTransport( NetworkContext_t * pNetworkContext,
+                                 void * pBuffer,
+                                 size_t bytesToRecv )
+{
+    MqttConnection_t * pConnection = pNetworkContext->pConnection;
+    IncomingPacket_t * pIncoming = &( pConnection->incoming );
+    int32_t returnStatus = 0;
+    size_t bytesToCopy = 0U;
+    uint8_t discardBuffer[ 64 ];
+
+    /* The payload of a streamed PUBLISH the library failed to deliver is
+     * dropped before the next packet. */
+    while( ( pIncoming->failed == false ) &&
+           ( pIncoming->payloadRemaining > 0U ) &&
+           ( pIncoming->prefixOffset == pIncoming->prefixLength ) &&
+           ( pIncoming->bodyRemaining == 0U ) )
+    {
+        bytesToCopy = ( pIncoming->payloadRemaining < sizeof( discardBuffer ) ) ?
+                      pIncoming->payloadRemaining : sizeof( discardBuffer );
+
+        if( receiveExact( pConnection, discardBuffer, bytesToCopy ) == true )
+        {
+            pIncoming->payloadRemaining -= bytesToCopy;
+        }
+        else
+        {
+            pIncoming->failed = true;
+        }
+    }
+
+    if( pIncoming->failed == true )
+    {
+        returnStatus = -1;
+    }
+    else if( ( pIncoming->prefixOffset == pIncoming->prefixLength ) &&
+             ( pIncoming->bodyRemaining == 0U ) )
+    {
+        returnStatus = receivePacketStart( pConnection );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( pIncoming->failed == true )
+    {
+        returnStatus = -1;
+    }
+    else if( pIncoming->prefixOffset < pIncoming->prefixLength )
+    {
+        bytesToCopy = pIncoming->prefixLength - pIncoming->prefixOffset;
+
+        if( bytesToCopy > bytesToRecv )
+        {
+            bytesToCopy = bytesToRecv;
+        }
+
+        ( void ) memcpy( pBuffer, &( pIncoming->prefix[ pIncoming->prefixOffset ] ), bytesToCopy );
+        pIncoming->prefixOffset += bytesToCopy;
+        returnStatus = ( int32_t ) bytesToCopy;
+    }
+    else if( pIncoming->bodyRemaining > 0U )
+    {
+        bytesToCopy = ( pIncoming->bodyRemaining < bytesToRecv ) ? pIncoming->bodyRemaining : bytesToRecv;
+        returnStatus = CONNECTION_RECV( pNetworkContext, pBuffer, bytesToCopy );
+
+        if( returnStatus > 0 )
+        {
+            pIncoming->bodyRemaining -= ( size_t ) returnStatus;
+        }
+    }
+    else
+    {
+        /* No packet is pending. */
+        returnStatus = 0;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t sendTransport( NetworkContext_t * pNetworkContext,
+                              const void * pBuffer,
+                              size_t bytesToSend )
+{
+    int32_t returnStatus = -1;
+    MqttConnection_t * pConnection = pNetworkContext->pConnection;
+
+    if( pConnection->earlyConnectLength > 0U )
+    {
+        /* The TLS connection already sent the CONNECT the library sends. */
+        returnStatus = ( int32_t ) ( ( bytesToSend < pConnection->earlyConnectLength ) ?
+                                     bytesToSend : pConnection->earlyConnectLength );
+        pConnection->earlyConnectLength -= ( size_t ) returnStatus;
+    }
+    else if( pConnection->incoming.failed == false )
+    {
+        returnStatus = CONNECTION_SEND( pNetworkContext, pBuffer, bytesToSend );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receivePayload( MqttConnection_t * pConnection,
+                            const MQTTPacketInfo_t * pPacketInfo,
+                            MQTTPublishInfo_t * pPublishInfo )
+{
+    IncomingPacket_t * pIncoming = &( pConnection->incoming );
+    bool returnStatus = true;
+    uint8_t * pPayload = NULL;
+    uint8_t * pChunk = NULL;
+    size_t chunkSize = 0U;
+    size_t chunkLength = 0U;
+    size_t offset = 0U;
+
+    pPublishInfo->pPayload = NULL;
+    pPublishInfo->payloadLength = pIncoming->payloadLength;
+
+    if( pConnection->config.payloadBufferCallback != NULL )
+    {
+        pPayload = pConnection->config.payloadBufferCallback( pConnection, pPublishInfo );
+    }
+
+    if( pPayload != NULL )
+    {
+        returnStatus = receiveExact( pConnection, pPayload, pIncoming->payloadLength );
+        pPublishInfo->pPayload = pPayload;
+    }
+    else
+    {
+        /* The chunks go through the network buffer after the topic, which
+         * the library kept at its beginning. */
+        pChunk = &( pConnection->networkBuffer.pBuffer[ pPacketInfo->remainingLength ] );
+        chunkSize = pConnection->networkBuffer.size - pPacketInfo->remainingLength;
+
+        while( ( returnStatus == true ) && ( offset < pIncoming->payloadLength ) )
+        {
+            chunkLength = pIncoming->payloadLength - offset;
+
+            if( chunkLength > chunkSize )
+            {
+                chunkLength = chunkSize;
+            }
+
+            returnStatus = receiveExact( pConnection, pChunk, chunkLength );
+
+            if( ( returnStatus == true ) && ( pConnection->config.payloadChunkCallback != NULL ) )
+            {
+                pConnection->config.payloadChunkCallback( pConnection, pPublishInfo, offset, pChunk, chunkLength );
+            }
+
+            offset += chunkLength;
+        }
+    }
+
+    if( returnStatus == true )
+    {
+        pIncoming->payloadRemaining = 0U;
+        RECORD_METRIC( pConnection, payloadsStreamed, 1U );
+    }
+    else
+    {
+        LogError( ( "Failed to receive the payload of %lu bytes of an incoming publish.",
+                    ( unsigned long ) pIncoming->payloadLength ) );
+        pIncoming->failed = true;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static MqttConnection_t * findConnection( const MQTTContext_t * pMqttContext )
+{
+    MqttConnection_t * pConnection = NULL;
+    uintptr_t offset = 0U;
+    size_t i = 0U;
+
+    /* The MQTT contexts are members of the connections, so the connection is
+     * found from the offset of the context rather than by comparing it with
+     * every connection, which a fleet of connections would do on each
+     * packet. */
+    if( ( uintptr_t ) pMqttContext >= ( uintptr_t ) &( connections[ 0 ].context ) )
+    {
+        offset = ( uintptr_t ) pMqttContext - ( uintptr_t ) &( connections[ 0 ].context );
+        i = ( size_t ) ( offset / sizeof( MqttConnection_t ) );
+
+        if( ( i < MQTT_CONNECTION_MAX_INSTANCES ) &&
+            ( connections[ i ].inUse == true ) &&
+            ( &( connections[ i ].context ) == pMqttContext ) )
+        {
+            pConnection = &connections[ i ];
+        }
+    }
+
+    return pConnection;
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    MqttConnection_t * pConnection = findConnection( pMqttContext );
+    uint16_t packetIdentifier = pDeserializedInfo->packetIdentifier;
+    bool forward = true;
+
+    assert( pConnection != NULL );
+
+    /* The payload of a streamed PUBLISH is still in the transport. A PUBLISH
+     * received in part is not given to the application, and the failed
+     * transport keeps the library from acknowledging it. */
+    if( ( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH ) &&
+        ( pConnection->incoming.payloadRemaining > 0U ) )
+    {
+        forward = receivePayload( pConnection, pPacketInfo, pDeserializedInfo->pPublishInfo );
+    }
+
+    /* The copies of a publish are dropped before they are decompressed. */
+    #if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 )
+        if( ( forward == true ) &&
+            ( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH ) &&
+            ( pDeserializedInfo->pPublishInfo != NULL ) &&
+            ( isDuplicatePublish( pConnection, pDeserializedInfo->pPublishInfo, packetIdentifier ) == true ) )
+        {
+            LogDebug( ( "Suppressed PUBLISH sent again with packet id %u.", packetIdentifier ) );
+            RECORD_METRIC( pConnection, duplicatesSuppressed, 1U );
+            forward = false;
+        }
+    #endif
+
+    #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+        if( ( forward == true ) &&
+            ( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH ) &&
+            ( pDeserializedInfo->pPublishInfo != NULL ) )
+        {
+            forward = decompressPublish( pConnection, pDeserializedInfo->pPublishInfo );
+        }
+    #endif
+
+    switch( pPacketInfo->type )
+    {
+        case MQTT_PACKET_TYPE_PUBACK:
+
+            /* The publish is found by its packet id in the window. */
+            if( removeOutgoingPublish( pConnection, packetIdentifier ) == true )
+            {
+                LogDebug( ( "Cleaned up outgoing publish packet with packet id %u.",
+                            packetIdentifier ) );
+                RECORD_METRIC( pConnection, pubacksReceived, 1U );
+            }
+
+            break;
+
+        case MQTT_PACKET_TYPE_SUBACK:
+            /* Make sure ACK packet identifier matches with Request packet identifier. */
+            assert( pConnection->subscribePacketId == packetIdentifier );
+            pConnection->subscribePacketId = MQTT_PACKET_ID_INVALID;
+            break;
+
+        case MQTT_PACKET_TYPE_UNSUBACK:
+            /* Make sure ACK packet identifier matches with Request packet identifier. */
+            assert( pConnection->unsubscribePacketId == packetIdentifier );
+            pConnection->unsubscribePacketId = MQTT_PACKET_ID_INVALID;
+            break;
+
+        default:
+            /* The other packets are for the application only. */
+            break;
+    }
+
+    if( ( forward == true ) && ( pConnection->config.eventCallback != NULL ) )
+    {
+        pConnection->config.eventCallback( pMqttContext, pPacketInfo, pDeserializedInfo );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool hasBufferedData( const OpensslParams_t * pOpensslParams )
+{
+    bool buffered = false;
+
+    if( pOpensslParams->recvBufferLength > 0U )
+    {
+        buffered = true;
+    }
+    else if( ( pOpensslParams->pSsl != NULL ) && ( SSL_pending( pOpensslParams->pSsl ) > 0 ) )
+    {
+        buffered = true;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return buffered;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t effectiveTimeout( const MqttConnection_t * pConnection,
+                                  uint32_t configuredMs )
+{
+    return ( pConnection->adaptiveTimeoutMs != 0U ) ? pConnection->adaptiveTimeoutMs : configuredMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void adaptTimeouts( MqttConnection_t * pConnection )
+{
+    SocketRttInfo_t rttInfo = { 0 };
+    uint32_t timeoutMs = 0U;
+
+    pConnection->lastRttSampleMs = Clock_GetTimeMs();
+
+    if( Sockets_GetRttInfo( pConnection->opensslParams.socketDescriptor, &rttInfo ) == SOCKETS_SUCCESS )
+    {
+        timeoutMs = ( rttInfo.rtoUs / 1000U ) * MQTT_CONNECTION_ADAPTIVE_TIMEOUT_FACTOR;
+
+        if( timeoutMs < MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MIN_MS )
+        {
+            timeoutMs = MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MIN_MS;
+        }
+        else if( timeoutMs > MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MAX_MS )
+        {
+            timeoutMs = MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MAX_MS;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        /* The retransmission timeout falls back as soon as a segment gets
+         * through, while the link may still be losing the next ones. */
+        if( ( rttInfo.totalRetransmits != pConnection->retransmits ) &&
+            ( timeoutMs < pConnection->adaptiveTimeoutMs ) )
+        {
+            timeoutMs = pConnection->adaptiveTimeoutMs;
+        }
+
+        pConnection->retransmits = rttInfo.totalRetransmits;
+
+        if( ( timeoutMs != pConnection->adaptiveTimeoutMs ) &&
+            ( Sockets_SetTimeouts( pConnection->opensslParams.socketDescriptor, timeoutMs, timeoutMs ) == SOCKETS_SUCCESS ) )
+        {
+            LogDebug( ( "Timeouts set to %u ms: round trip time %u us, variation %u us, %u retransmits.",
+                        ( unsigned int ) timeoutMs,
+                        ( unsigned int ) rttInfo.srttUs,
+                        ( unsigned int ) rttInfo.rttVarUs,
+                        ( unsigned int ) rttInfo.totalRetransmits ) );
+            pConnection->adaptiveTimeoutMs = timeoutMs;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t manageKeepAlive( MqttConnection_t * pConnection )
+{
+    MQTTContext_t * pMqttContext = &( pConnection->context );
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    uint32_t now = pMqttContext->getTime();
+    uint32_t keepAliveMs = 1000U * ( uint32_t ) pMqttContext->keepAliveIntervalSec;
+    uint32_t pingRespTimeoutMs = effectiveTimeout( pConnection, MQTT_PINGRESP_TIMEOUT_MS );
+
+    if( pMqttContext->waitingForPingResp == true )
+    {
+        if( ( now - pMqttContext->pingReqSendTimeMs ) > pingRespTimeoutMs )
+        {
+            LogError( ( "No PINGRESP received within %u ms.", ( unsigned int ) pingRespTimeoutMs ) );
+            mqttStatus = MQTTKeepAliveTimeout;
+        }
+    }
+    else if( ( keepAliveMs != 0U ) && ( ( now - pMqttContext->lastPacketTime ) > keepAliveMs ) )
+    {
+        mqttStatus = MQTT_Ping( pMqttContext );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void scheduleKeepAlive( MqttConnection_t * pConnection )
+{
+    const MQTTContext_t * pMqttContext = &( pConnection->context );
+    uint32_t elapsedMs = 0U;
+    uint32_t intervalMs = 0U;
+    uint32_t timeoutMs = 0U;
+
+    if( pMqttContext->waitingForPingResp == true )
+    {
+        elapsedMs = Clock_GetTimeMs() - pMqttContext->pingReqSendTimeMs;
+        intervalMs = effectiveTimeout( pConnection, MQTT_PINGRESP_TIMEOUT_MS );
+    }
+    else
+    {
+        elapsedMs = Clock_GetTimeMs() - pMqttContext->lastPacketTime;
+        intervalMs = 1000U * ( uint32_t ) pMqttContext->keepAliveIntervalSec;
+    }
+
+    if( intervalMs == 0U )
+    {
+        ( void ) EventLoop_CancelDeadline( &( pConnection->eventLoop ), &( pConnection->loopConnection ) );
+    }
+    else
+    {
+        /* The keep-alive is due once the interval is exceeded. The packets
+         * sent before the deadline only make it early, in which case the
+         * deadline is set again. */
+        if( elapsedMs <= intervalMs )
+        {
+            timeoutMs = intervalMs - elapsedMs + 1U;
+        }
+
+        ( void ) EventLoop_SetDeadline( &( pConnection->eventLoop ), &( pConnection->loopConnection ), timeoutMs );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t processReceivedPackets( MqttConnection_t * pConnection )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        bool pingPending = pConnection->context.waitingForPingResp;
+    #endif
+
+    /* A timeout of 0 receives at most one packet. The socket only reports the
+     * data the TLS library has not read yet, so the records it already
+     * decrypted are processed before returning to the event loop. */
+    do
+    {
+        mqttStatus = MQTT_ProcessLoop( &( pConnection->context ), 0U );
+    } while( ( mqttStatus == MQTTSuccess ) && ( hasBufferedData( &( pConnection->opensslParams ) ) == true ) );
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+
+        /* The keep-alive round trip shares the link with the background
+         * transfers, so it tells the throttle how much they delay MQTT. */
+        if( ( pingPending == true ) && ( pConnection->context.waitingForPingResp == false ) )
+        {
+            TransportThrottle_ReportRtt( Clock_GetTimeMs() - pConnection->context.pingReqSendTimeMs );
+        }
+    #endif
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void handleSocketEvents( EventLoopConnection_t * pLoopConnection,
+                                uint32_t events )
+{
+    MqttConnection_t * pConnection = ( MqttConnection_t * ) pLoopConnection->pUserContext;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    if( ( events & ( EVENT_LOOP_EVENT_READABLE | EVENT_LOOP_EVENT_HANGUP ) ) != 0U )
+    {
+        mqttStatus = processReceivedPackets( pConnection );
+
+        /* The broker closed the connection once the packets it sent before
+         * are processed. The socket is unregistered, so that it is not
+         * reported again. */
+        if( ( mqttStatus == MQTTSuccess ) && ( ( events & EVENT_LOOP_EVENT_HANGUP ) != 0U ) )
+        {
+            LogError( ( "The broker closed the connection." ) );
+            mqttStatus = MQTTRecvFailed;
+        }
+    }
+
+    if( ( mqttStatus == MQTTSuccess ) && ( ( events & EVENT_LOOP_EVENT_DEADLINE ) != 0U ) )
+    {
+        mqttStatus = manageKeepAlive( pConnection );
+    }
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        if( ( pConnection->config.adaptiveTimeouts == true ) &&
+            ( ( Clock_GetTimeMs() - pConnection->lastRttSampleMs ) >= MQTT_CONNECTION_RTT_SAMPLE_INTERVAL_MS ) )
+        {
+            adaptTimeouts( pConnection );
+        }
+
+        scheduleKeepAlive( pConnection );
+    }
+    else
+    {
+        unregisterSocket( pConnection );
+        pConnection->loopStatus = mqttStatus;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool registerSocket( MqttConnection_t * pConnection )
+{
+    bool returnStatus = true;
+
+    unregisterSocket( pConnection );
+
+    pConnection->loopConnection.fileDescriptor = pConnection->opensslParams.socketDescriptor;
+    pConnection->loopConnection.callback = handleSocketEvents;
+    pConnection->loopConnection.pUserContext = pConnection;
+
+    if( EventLoop_Add( &( pConnection->eventLoop ), &( pConnection->loopConnection ) ) != EVENT_LOOP_SUCCESS )
+    {
+        LogError( ( "Failed to add the socket of the TLS session to the event loop." ) );
+        returnStatus = false;
+    }
+    else
+    {
+        pConnection->socketRegistered = true;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void unregisterSocket( MqttConnection_t * pConnection )
+{
+    if( pConnection->socketRegistered == true )
+    {
+        ( void ) EventLoop_Remove( &( pConnection->eventLoop ), &( pConnection->loopConnection ) );
+        pConnection->socketRegistered = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeTransport( MqttConnection_t * pConnection )
+{
+    /* The socket leaves the event loop before it is closed. Closing it only
+     * once keeps a descriptor number reused since from being closed. */
+    unregisterSocket( pConnection );
+
+    if( pConnection->transportConnected == true )
+    {
+        ( void ) Openssl_Disconnect( &( pConnection->networkContext ) );
+        pConnection->transportConnected = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isWaitOver( MqttConnection_t * pConnection,
+                        WaitCondition_t condition )
+{
+    bool waitOver = false;
+    PublishWindowCursor_t cursor = PUBLISH_WINDOW_CURSOR_INITIALIZER;
+
+    switch( condition )
+    {
+        case WaitForSuback:
+            waitOver = ( pConnection->subscribePacketId == MQTT_PACKET_ID_INVALID );
+            break;
+
+        case WaitForUnsuback:
+            waitOver = ( pConnection->unsubscribePacketId == MQTT_PACKET_ID_INVALID );
+            break;
+
+        case WaitForPubacks:
+            waitOver = ( PublishWindow_Next( &( pConnection->window ), &cursor ) == NULL );
+            break;
+
+        default:
+            /* The wait lasts the whole timeout. */
+            break;
+    }
+
+    return waitOver;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t waitForEvents( MqttConnection_t * pConnection,
+                                   uint32_t timeoutMs,
+                                   WaitCondition_t condition )
+{
+    uint32_t startTimeMs = Clock_GetTimeMs();
+    uint32_t elapsedMs = 0U;
+    bool keepWaiting = true;
+
+    pConnection->loopStatus = MQTTSuccess;
+
+    if( pConnection->socketRegistered == false )
+    {
+        pConnection->loopStatus = MQTTRecvFailed;
+    }
+    else if( hasBufferedData( &( pConnection->opensslParams ) ) == true )
+    {
+        /* The packets received along with the last acknowledgement waited
+         * for are not reported by the socket. */
+        handleSocketEvents( &( pConnection->loopConnection ), EVENT_LOOP_EVENT_READABLE );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    /* A timeout of 0 dispatches once, to process what is already
+     * received. */
+    while( ( pConnection->loopStatus == MQTTSuccess ) &&
+           ( isWaitOver( pConnection, condition ) == false ) &&
+           ( keepWaiting == true ) )
+    {
+        if( EventLoop_Dispatch( &( pConnection->eventLoop ), timeoutMs - elapsedMs, NULL ) != EVENT_LOOP_SUCCESS )
+        {
+            pConnection->loopStatus = MQTTRecvFailed;
+        }
+
+        elapsedMs = Clock_GetTimeMs() - startTimeMs;
+        keepWaiting = ( elapsedMs < timeoutMs );
+    }
+
+    return pConnection->loopStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void cleanupOutgoingPublishes( MqttConnection_t * pConnection )
+{
+    /* Clean up all the outgoing publish packets. */
+    if( pConnection->hasStore == true )
+    {
+        ( void ) PublishStore_Clear( &( pConnection->store ) );
+    }
+    else
+    {
+        PublishWindow_Clear( &( pConnection->window ) );
+    }
+
+    /* The queued publishes sent are not resent either. */
+    PublishQueue_ReleaseAll( &( pConnection->queue ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool addOutgoingPublish( MqttConnection_t * pConnection,
+                                uint16_t packetId,
+                                const MQTTPublishInfo_t * pPublishInfo )
+{
+    bool added = false;
+
+    if( pConnection->hasStore == true )
+    {
+        added = ( PublishStore_Add( &( pConnection->store ), packetId, pPublishInfo ) == PublishStoreSuccess );
+    }
+    else
+    {
+        added = ( PublishWindow_Add( &( pConnection->window ), packetId, pPublishInfo ) == PublishWindowSuccess );
+    }
+
+    return added;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool removeOutgoingPublish( MqttConnection_t * pConnection,
+                                   uint16_t packetId )
+{
+    bool removed = false;
+
+    if( pConnection->hasStore == true )
+    {
+        removed = ( PublishStore_Remove( &( pConnection->store ), packetId ) == PublishStoreSuccess );
+    }
+    else
+    {
+        removed = ( PublishWindow_Remove( &( pConnection->window ), packetId ) == PublishWindowSuccess );
+    }
+
+    /* A queued publish keeps its copy until its PUBACK. */
+    ( void ) PublishQueue_Release( &( pConnection->queue ), packetId );
+
+    return removed;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t getNextPacketId( MqttConnection_t * pConnection )
+{
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+
+    do
+    {
+        packetId = MQTT_GetPacketId( &( pConnection->context ) );
+    } while( PublishWindow_Find( &( pConnection->window ), packetId ) != NULL );
+
+    return packetId;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool handlePublishResend( MqttConnection_t * pConnection )
+{
+    bool returnStatus = true;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    PublishWindowCursor_t cursor = PUBLISH_WINDOW_CURSOR_INITIALIZER;
+    PublishWindowEntry_t * pEntry = NULL;
+
+    /* Resend all the QoS1 publishes still in the window, in the order they
+     * were first sent. These are the publishes that hasn't received a
+     * PUBACK. When a PUBACK is received, the publish is removed from the
+     * window. */
+    pEntry = PublishWindow_Next( &( pConnection->window ), &cursor );
+
+    while( ( pEntry != NULL ) && ( returnStatus == true ) )
+    {
+        pEntry->publishInfo.dup = true;
+
+        LogDebug( ( "Sending duplicate PUBLISH with packet id %u.",
+                    pEntry->packetId ) );
+        mqttStatus = MQTT_Publish( &( pConnection->context ),
+                                   &pEntry->publishInfo,
+                                   pEntry->packetId );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Sending duplicate PUBLISH for packet id %u "
+                        " failed with status %s.",
+                        pEntry->packetId,
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            RECORD_METRIC( pConnection, sendFailures, 1U );
+            returnStatus = false;
+        }
+        else
+        {
+            RECORD_METRIC( pConnection, publishesResent, 1U );
+            pEntry = PublishWindow_Next( &( pConnection->window ), &cursor );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static MqttConnectionStatus_t queueOfflinePublish( MqttConnection_t * pConnection,
+                                                   const MQTTPublishInfo_t * pPublishInfo )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    PublishQueueStatus_t queueStatus = PublishQueueSuccess;
+
+    /* The queue keeps a copy of the publish. */
+    queueStatus = PublishQueue_Enqueue( &( pConnection->queue ), pPublishInfo );
+
+    if( queueStatus == PublishQueueSuccess )
+    {
+        LogWarn( ( "Queued PUBLISH for topic %.*s until the broker is reconnected.",
+                   pPublishInfo->topicNameLength,
+                   pPublishInfo->pTopicName ) );
+        RECORD_METRIC( pConnection, publishesQueued, 1U );
+    }
+    else
+    {
+        LogError( ( "Failed to queue PUBLISH for topic %.*s while the broker is disconnected.",
+                    pPublishInfo->topicNameLength,
+                    pPublishInfo->pTopicName ) );
+        returnStatus = ( queueStatus == PublishQueueFull ) ? MqttConnectionNoMemory : MqttConnectionBadParameter;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool drainOfflinePublishes( MqttConnection_t * pConnection )
+{
+    bool returnStatus = true;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    const MQTTPublishInfo_t * pPublishInfo = PublishQueue_Peek( &( pConnection->queue ) );
+    const PublishWindowEntry_t * pEntry = NULL;
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+    size_t batchSize = pConnection->config.drainBatchSize;
+    size_t sentCount = batchSize;
+    const MQTTPublishInfo_t * pSendInfo = NULL;
+
+    #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+        MQTTPublishInfo_t compressedInfo;
+    #endif
+
+    while( ( pPublishInfo != NULL ) && ( sentCount == batchSize ) && ( returnStatus == true ) )
+    {
+        sentCount = 0U;
+
+        /* A batch ends early when the window, which holds as many publishes
+         * as the MQTT library keeps in flight, is full. */
+        while( ( pPublishInfo != NULL ) && ( sentCount < batchSize ) && ( returnStatus == true ) )
+        {
+            packetId = getNextPacketId( pConnection );
+            pSendInfo = pPublishInfo;
+
+            #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+                pSendInfo = compressPublish( pConnection, pPublishInfo, &compressedInfo );
+            #endif
+
+            if( addOutgoingPublish( pConnection, packetId, pSendInfo ) == false )
+            {
+                pPublishInfo = NULL;
+            }
+            else
+            {
+                /* The copy of the window is sent, as it remains valid until
+                 * the PUBACK. */
+                pEntry = PublishWindow_Find( &( pConnection->window ), packetId );
+                mqttStatus = MQTT_Publish( &( pConnection->context ),
+                                           &( pEntry->publishInfo ),
+                                           packetId );
+
+                if( mqttStatus != MQTTSuccess )
+                {
+                    LogError( ( "Failed to send queued PUBLISH packet to broker with error = %s.",
+                                MQTT_Status_strerror( mqttStatus ) ) );
+                    ( void ) removeOutgoingPublish( pConnection, packetId );
+                    RECORD_METRIC( pConnection, sendFailures, 1U );
+                    pConnection->brokerConnected = false;
+                    returnStatus = false;
+                }
+                else
+                {
+                    LogDebug( ( "Queued PUBLISH sent for topic %.*s to broker with packet ID %u.",
+                                pEntry->publishInfo.topicNameLength,
+                                pEntry->publishInfo.pTopicName,
+                                packetId ) );
+                    RECORD_METRIC( pConnection, publishesSent, 1U );
+
+                    /* Without a store, the window points to the copy of the
+                     * queue until the PUBACK, unless it points to the
+                     * compressed copy. */
+                    if( ( pConnection->hasStore == true ) || ( pSendInfo != pPublishInfo ) )
+                    {
+                        ( void ) PublishQueue_Dequeue( &( pConnection->queue ), MQTT_PACKET_ID_INVALID );
+                    }
+                    else
+                    {
+                        ( void ) PublishQueue_Dequeue( &( pConnection->queue ), packetId );
+                    }
+
+                    sentCount++;
+                    pPublishInfo = PublishQueue_Peek( &( pConnection->queue ) );
+                }
+            }
+        }
+
+        if( sentCount > 0U )
+        {
+            mqttStatus = waitForEvents( pConnection, pConnection->config.drainIntervalMs, WaitForPubacks );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogWarn( ( "MQTT_ProcessLoop returned with status = %s.",
+                           MQTT_Status_strerror( mqttStatus ) ) );
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void completePublishes( MqttConnection_t * pConnection )
+{
+    if( pConnection->brokerConnected == true )
+    {
+        /* Send the queued publishes the window had no room for after the
+         * reconnect. */
+        if( PublishQueue_Peek( &( pConnection->queue ) ) != NULL )
+        {
+            ( void ) drainOfflinePublishes( pConnection );
+        }
+
+        if( pConnection->hasStore == true )
+        {
+            /* Flush the records of the publishes and of the PUBACKs
+             * received, once enough of them are pending. */
+            ( void ) PublishStore_Commit( &( pConnection->store ), false );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t stagePublish( MqttConnection_t * pConnection,
+                                  const MQTTPublishInfo_t * pPublishInfo )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTFixedBuffer_t fixedBuffer;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+    size_t batchLength = 0U;
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+    StagedPublish_t * pStaged = NULL;
+    const MQTTPublishInfo_t * pSendInfo = pPublishInfo;
+
+    #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+        MQTTPublishInfo_t compressedInfo;
+    #endif
+
+    if( pConnection->stagedPublishCount > 0U )
+    {
+        batchLength = pConnection->stagedPublishes[ pConnection->stagedPublishCount - 1U ].packetEnd;
+    }
+
+    /* The payload is compressed into the slot of the window entry the
+     * publish takes below, before its packet is sized. */
+    #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+        if( pPublishInfo->qos == MQTTQoS1 )
+        {
+            pSendInfo = compressPublish( pConnection, pPublishInfo, &compressedInfo );
+        }
+    #endif
+
+    mqttStatus = MQTT_GetPublishPacketSize( pSendInfo, &remainingLength, &packetSize );
+
+    if( ( mqttStatus != MQTTSuccess ) || ( pPublishInfo->qos != MQTTQoS1 ) )
+    {
+        LogError( ( "Invalid PUBLISH for topic %.*s in a batch.",
+                    pPublishInfo->topicNameLength,
+                    pPublishInfo->pTopicName ) );
+        mqttStatus = MQTTBadParameter;
+    }
+    else if( ( pConnection->stagedPublishCount == MQTT_CONNECTION_BATCH_MAX_PUBLISHES ) ||
+             ( packetSize > ( pConnection->batchBufferSize - batchLength ) ) )
+    {
+        mqttStatus = MQTTNoMemory;
+    }
+    else
+    {
+        /* As with MQTT_Publish, the packet identifier is reserved in the
+         * state of the library before the packet is sent, so that its PUBACK
+         * is expected. */
+        packetId = getNextPacketId( pConnection );
+
+        if( addOutgoingPublish( pConnection, packetId, pSendInfo ) == false )
+        {
+            mqttStatus = MQTTNoMemory;
+        }
+        else
+        {
+            mqttStatus = MQTT_ReserveState( &( pConnection->context ), packetId, pPublishInfo->qos );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                ( void ) removeOutgoingPublish( pConnection, packetId );
+            }
+        }
+    }
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        fixedBuffer.pBuffer = &( pConnection->pBatchBuffer[ batchLength ] );
+        fixedBuffer.size = pConnection->batchBufferSize - batchLength;
+
+        mqttStatus = MQTT_SerializePublish( pSendInfo,
+                                            packetId,
+                                            remainingLength,
+                                            &fixedBuffer );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Failed to serialize PUBLISH for topic %.*s with error = %s.",
+                        pPublishInfo->topicNameLength,
+                        pPublishInfo->pTopicName,
+                        MQTT_Status_strerror( mqttStatus ) ) );
+
+            ( void ) removeOutgoingPublish( pConnection, packetId );
+        }
+        else
+        {
+            pStaged = &( pConnection->stagedPublishes[ pConnection->stagedPublishCount ] );
+            pStaged->pPublishInfo = pPublishInfo;
+            pStaged->packetId = packetId;
+            pStaged->packetEnd = batchLength + packetSize;
+            pConnection->stagedPublishCount++;
+        }
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t sendStagedPublishes( MqttConnection_t * pConnection,
+                                   const uint8_t * pPackets )
+{
+    MQTTContext_t * pMqttContext = &( pConnection->context );
+    size_t sentCount = 0U;
+    size_t bytesSent = 0U;
+    size_t batchLength = 0U;
+    int32_t sendResult = 0;
+    uint32_t lastProgressTimeMs = Clock_GetTimeMs();
+    bool sendFailed = false;
+    MQTTPublishState_t publishState = MQTTStateNull;
+    const StagedPublish_t * pStaged = NULL;
+
+    if( pConnection->stagedPublishCount > 0U )
+    {
+        batchLength = pConnection->stagedPublishes[ pConnection->stagedPublishCount - 1U ].packetEnd;
+    }
+
+    while( ( bytesSent < batchLength ) && ( sendFailed == false ) )
+    {
+        sendResult = pMqttContext->transportInterface.send( pMqttContext->transportInterface.pNetworkContext,
+                                                            &( pPackets[ bytesSent ] ),
+                                                            batchLength - bytesSent );
+
+        if( sendResult < 0 )
+        {
+            sendFailed = true;
+        }
+        else if( sendResult > 0 )
+        {
+            bytesSent += ( size_t ) sendResult;
+            lastProgressTimeMs = Clock_GetTimeMs();
+        }
+        else if( ( Clock_GetTimeMs() - lastProgressTimeMs ) >= MQTT_CONNECTION_BATCH_SEND_TIMEOUT_MS )
+        {
+            sendFailed = true;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        /* A partial write may end in the middle of a packet; the publishes
+         * before it are sent. */
+        while( ( sentCount < pConnection->stagedPublishCount ) &&
+               ( pConnection->stagedPublishes[ sentCount ].packetEnd <= bytesSent ) )
+        {
+            pStaged = &( pConnection->stagedPublishes[ sentCount ] );
+            ( void ) MQTT_UpdateStatePublish( pMqttContext,
+                                              pStaged->packetId,
+                                              MQTT_SEND,
+                                              pStaged->pPublishInfo->qos,
+                                              &publishState );
+            sentCount++;
+        }
+    }
+
+    /* The batch counts as activity for the keep-alive, as a packet sent by
+     * the library does. */
+    if( bytesSent > 0U )
+    {
+        pMqttContext->lastPacketTime = pMqttContext->getTime();
+        RECORD_METRIC( pConnection, batchesSent, 1U );
+    }
+
+    RECORD_METRIC( pConnection, publishesSent, sentCount );
+
+    if( sendFailed == true )
+    {
+        LogError( ( "Failed to send a batch of PUBLISH packets: %lu of %lu bytes "
+                    "and %lu of %lu publishes sent.",
+                    ( unsigned long ) bytesSent,
+                    ( unsigned long ) batchLength,
+                    ( unsigned long ) sentCount,
+                    ( unsigned long ) pConnection->stagedPublishCount ) );
+        RECORD_METRIC( pConnection, sendFailures, 1U );
+    }
+
+    return sentCount;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+
+    static uint64_t getCpuTimeUs( void )
+    {
+        struct timespec now;
+
+        ( void ) clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+
+        return ( ( uint64_t ) now.tv_sec * 1000000U ) + ( ( uint64_t ) now.tv_nsec / 1000U );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static const MqttConnectionCompressionRule_t * findCompressionRule( const MqttConnection_t * pConnection,
+                                                                        const char * pTopicName,
+                                                                        uint16_t topicNameLength )
+    {
+        const MqttConnectionCompressionRule_t * pRule = NULL;
+        bool isMatch = false;
+        size_t i = 0U;
+
+        for( i = 0U; ( i < pConnection->compressionConfig.ruleCount ) && ( isMatch == false ); i++ )
+        {
+            ( void ) MQTT_MatchTopic( pTopicName,
+                                      topicNameLength,
+                                      pConnection->compressionConfig.pRules[ i ].pTopicFilter,
+                                      pConnection->compressionConfig.pRules[ i ].topicFilterLength,
+                                      &isMatch );
+
+            if( isMatch == true )
+            {
+                pRule = &( pConnection->compressionConfig.pRules[ i ] );
+            }
+        }
+
+        return pRule;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static const MQTTPublishInfo_t * compressPublish( MqttConnection_t * pConnection,
+                                                      const MQTTPublishInfo_t * pPublishInfo,
+                                                      MQTTPublishInfo_t * pCompressedInfo )
+    {
+        const MQTTPublishInfo_t * pSendInfo = pPublishInfo;
+        const MqttConnectionCompressionRule_t * pRule = NULL;
+        uint16_t slot = pConnection->window.freeHead;
+        uint8_t * pSlot = NULL;
+        size_t compressedLength = 0U;
+        uint64_t startUs = 0U;
+
+        /* A full window takes no publish, so there is nothing to compress. */
+        if( ( pConnection->compressionReady == true ) &&
+            ( ( size_t ) slot < pConnection->window.entryCount ) )
+        {
+            pRule = findCompressionRule( pConnection,
+                                         pPublishInfo->pTopicName,
+                                         pPublishInfo->topicNameLength );
+        }
+
+        if( ( pRule != NULL ) && ( pPublishInfo->payloadLength >= pRule->minPayloadLength ) )
+        {
+            pSlot = &( pConnection->compressionConfig.pSlots[ ( size_t ) slot * pConnection->compressionConfig.slotSize ] );
+            startUs = getCpuTimeUs();
+
+            if( PayloadCompression_Compress( &( pConnection->compression ),
+                                             pRule->dictionaryId,
+                                             ( const uint8_t * ) pPublishInfo->pPayload,
+                                             pPublishInfo->payloadLength,
+                                             pSlot,
+                                             pConnection->compressionConfig.slotSize,
+                                             &compressedLength ) == PayloadCompressionSuccess )
+            {
+                *pCompressedInfo = *pPublishInfo;
+                pCompressedInfo->pPayload = pSlot;
+                pCompressedInfo->payloadLength = compressedLength;
+                pSendInfo = pCompressedInfo;
+
+                RECORD_METRIC( pConnection, payloadsCompressed, 1U );
+                RECORD_METRIC( pConnection, compressedInputBytes, pPublishInfo->payloadLength );
+                RECORD_METRIC( pConnection, compressedOutputBytes, compressedLength );
+            }
+
+            RECORD_METRIC( pConnection, compressionCpuUs, getCpuTimeUs() - startUs );
+        }
+
+        return pSendInfo;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool decompressPublish( MqttConnection_t * pConnection,
+                                   MQTTPublishInfo_t * pPublishInfo )
+    {
+        bool returnStatus = true;
+        PayloadCompressionStatus_t compressionStatus = PayloadCompressionSuccess;
+        size_t payloadLength = 0U;
+        uint64_t startUs = 0U;
+
+        /* Only the payloads of the compressed topics may start with the
+         * marker, those of the other topics being binary for all we know. */
+        if( ( pConnection->compressionReady == true ) &&
+            ( PayloadCompression_IsCompressed( ( const uint8_t * ) pPublishInfo->pPayload,
+                                               pPublishInfo->payloadLength ) == true ) &&
+            ( findCompressionRule( pConnection,
+                                   pPublishInfo->pTopicName,
+                                   pPublishInfo->topicNameLength ) != NULL ) )
+        {
+            startUs = getCpuTimeUs();
+            compressionStatus = PayloadCompression_Decompress( &( pConnection->compression ),
+                                                               ( const uint8_t * ) pPublishInfo->pPayload,
+                                                               pPublishInfo->payloadLength,
+                                                               pConnection->compressionConfig.pInflateBuffer,
+                                                               pConnection->compressionConfig.inflateBufferSize,
+                                                               &payloadLength );
+            RECORD_METRIC( pConnection, compressionCpuUs, getCpuTimeUs() - startUs );
+
+            if( compressionStatus == PayloadCompressionSuccess )
+            {
+                pPublishInfo->pPayload = pConnection->compressionConfig.pInflateBuffer;
+                pPublishInfo->payloadLength = payloadLength;
+                RECORD_METRIC( pConnection, payloadsDecompressed, 1U );
+            }
+            else
+            {
+                LogError( ( "Dropped compressed PUBLISH for topic %.*s, which could not be "
+                            "decompressed: status %d.",
+                            pPublishInfo->topicNameLength,
+                            pPublishInfo->pTopicName,
+                            ( int ) compressionStatus ) );
+                returnStatus = false;
+            }
+        }
+
+        return returnStatus;
+    }
+
+#endif /* if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 )
+
+    static uint32_t hashPublish( const MQTTPublishInfo_t * pPublishInfo )
+    {
+        const uint8_t * pPayload = ( const uint8_t * ) pPublishInfo->pPayload;
+        uint32_t hash = FNV_OFFSET_BASIS;
+        size_t i = 0U;
+
+        for( i = 0U; i < pPublishInfo->topicNameLength; i++ )
+        {
+            hash ^= ( uint32_t ) ( uint8_t ) pPublishInfo->pTopicName[ i ];
+            hash *= FNV_PRIME;
+        }
+
+        for( i = 0U; i < pPublishInfo->payloadLength; i++ )
+        {
+            hash ^= ( uint32_t ) pPayload[ i ];
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool isDuplicatePublish( MqttConnection_t * pConnection,
+                                    const MQTTPublishInfo_t * pPublishInfo,
+                                    uint16_t packetId )
+    {
+        DuplicateFilter_t * pFilter = &( pConnection->duplicates );
+        DeliveredPublish_t * pEntry = NULL;
+        uint32_t nowMs = Clock_GetTimeMs();
+        uint32_t hash = 0U;
+        size_t bit = DUPLICATE_FILTER_BIT( packetId );
+        size_t evictedBit = 0U;
+        size_t i = 0U;
+        bool isDuplicate = false;
+        bool isShared = false;
+
+        /* A payload streamed in chunks was already given to the
+         * application. */
+        if( ( pPublishInfo->qos == MQTTQoS1 ) &&
+            ( ( pPublishInfo->pPayload != NULL ) || ( pPublishInfo->payloadLength == 0U ) ) )
+        {
+            hash = hashPublish( pPublishInfo );
+
+            /* The identifier alone does not tell a copy from a new publish, as
+             * the broker reuses the identifiers acknowledged, so the hash
+             * must match as well. */
+            if( ( pPublishInfo->dup == true ) &&
+                ( ( pFilter->packetIdBits[ bit / 32U ] & ( 1UL << ( bit % 32U ) ) ) != 0U ) )
+            {
+                for( i = 0U; ( i < pFilter->count ) && ( pEntry == NULL ); i++ )
+                {
+                    if( ( pFilter->delivered[ i ].packetId == packetId ) &&
+                        ( pFilter->delivered[ i ].hash == hash ) &&
+                        ( ( nowMs - pFilter->delivered[ i ].timeMs ) < MQTT_CONNECTION_DUPLICATE_WINDOW_MS ) )
+                    {
+                        pEntry = &( pFilter->delivered[ i ] );
+                    }
+                }
+            }
+
+            if( pEntry != NULL )
+            {
+                /* The broker may send it again after a later reconnect. */
+                pEntry->timeMs = nowMs;
+                isDuplicate = true;
+            }
+            else
+            {
+                pEntry = &( pFilter->delivered[ pFilter->next ] );
+
+                /* The bit of the publish evicted stays set if another
+                 * publish of the ring shares it. */
+                if( pFilter->count == MQTT_CONNECTION_DUPLICATE_RING_LENGTH )
+                {
+                    evictedBit = DUPLICATE_FILTER_BIT( pEntry->packetId );
+
+                    for( i = 0U; ( i < pFilter->count ) && ( isShared == false ); i++ )
+                    {
+                        isShared = ( i != pFilter->next ) &&
+                                   ( DUPLICATE_FILTER_BIT( pFilter->delivered[ i ].packetId ) == evictedBit );
+                    }
+
+                    if( isShared == false )
+                    {
+                        pFilter->packetIdBits[ evictedBit / 32U ] &= ~( ( uint32_t ) ( 1UL << ( evictedBit % 32U ) ) );
+                    }
+                }
+                else
+                {
+                    pFilter->count++;
+                }
+
+                pEntry->packetId = packetId;
+                pEntry->hash = hash;
+                pEntry->timeMs = nowMs;
+                pFilter->packetIdBits[ bit / 32U ] |= ( uint32_t ) ( 1UL << ( bit % 32U ) );
+                pFilter->next = ( pFilter->next + 1U ) % MQTT_CONNECTION_DUPLICATE_RING_LENGTH;
+            }
+        }
+
+        return isDuplicate;
+    }
+
+#endif /* if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_Create( MqttConnection_t ** ppConnection,
+                                              const MqttConnectionConfig_t * pConfig,
+                                              const MqttConnectionBuffers_t * pBuffers )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MqttConnection_t * pConnection = NULL;
+    size_t i = 0U;
+
+    if( ( ppConnection == NULL ) || ( pConfig == NULL ) || ( pBuffers == NULL ) ||
+        ( pConfig->pHostName == NULL ) || ( pConfig->pClientIdentifier == NULL ) ||
+        ( pConfig->drainBatchSize == 0U ) || ( pBuffers->pNetworkBuffer == NULL ) ||
+        ( ( pBuffers->pBatchBuffer == NULL ) && ( pBuffers->batchBufferSize > 0U ) ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        for( i = 0U; ( i < MQTT_CONNECTION_MAX_INSTANCES ) && ( pConnection == NULL ); i++ )
+        {
+            if( connections[ i ].inUse == false )
+            {
+                pConnection = &connections[ i ];
+            }
+        }
+
+        if( pConnection == NULL )
+        {
+            LogError( ( "All %u MQTT connections are in use.",
+                        ( unsigned int ) MQTT_CONNECTION_MAX_INSTANCES ) );
+            returnStatus = MqttConnectionBadParameter;
+        }
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        ( void ) pthread_once( &metricsOnce, registerMetrics );
+
+        ( void ) memset( pConnection, 0x00, sizeof( MqttConnection_t ) );
+        pConnection->config = *pConfig;
+        pConnection->networkBuffer.pBuffer = pBuffers->pNetworkBuffer;
+        pConnection->networkBuffer.size = pBuffers->networkBufferSize;
+        pConnection->pBatchBuffer = pBuffers->pBatchBuffer;
+        pConnection->batchBufferSize = pBuffers->batchBufferSize;
+
+        /* The outgoing publishes are kept across the sessions, to be resent
+         * when the broker resumes one, so the window is set up only once. */
+        if( ( PublishWindow_Init( &( pConnection->window ),
+                                  pBuffers->pWindowEntries,
+                                  pBuffers->windowLength,
+                                  pBuffers->pWindowBuckets,
+                                  PUBLISH_WINDOW_BUCKET_COUNT( pBuffers->windowLength ) ) != PublishWindowSuccess ) ||
+            ( PublishQueue_Init( &( pConnection->queue ),
+                                 pBuffers->pQueueEntries,
+                                 pBuffers->queueLength,
+                                 pBuffers->pQueueSlots,
+                                 pBuffers->queueSlotSize,
+                                 NULL,
+                                 0U ) != PublishQueueSuccess ) )
+        {
+            returnStatus = MqttConnectionBadParameter;
+        }
+    }
+
+    if( ( returnStatus == MqttConnectionSuccess ) && ( pConfig->pStorePath != NULL ) )
+    {
+        /* The publishes left by the previous run are added back to the
+         * window, to be resent if the broker resumes the session. */
+        if( PublishStore_Open( &( pConnection->store ),
+                               pConfig->pStorePath,
+                               pConfig->storeSize,
+                               &( pConnection->window ) ) != PublishStoreSuccess )
+        {
+            LogError( ( "Failed to open the outgoing publish store %s.",
+                        pConfig->pStorePath ) );
+            returnStatus = MqttConnectionFailed;
+        }
+        else
+        {
+            pConnection->hasStore = true;
+        }
+    }
+
+    if( ( returnStatus == MqttConnectionSuccess ) &&
+        ( EventLoop_Init( &( pConnection->eventLoop ) ) != EVENT_LOOP_SUCCESS ) )
+    {
+        LogError( ( "Failed to create the event loop of the MQTT connection." ) );
+
+        if( pConnection->hasStore == true )
+        {
+            PublishStore_Close( &( pConnection->store ) );
+            pConnection->hasStore = false;
+        }
+
+        returnStatus = MqttConnectionFailed;
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        pConnection->inUse = true;
+        *ppConnection = pConnection;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_SetQueueRules( MqttConnection_t * pConnection,
+                                                     const PublishQueueRule_t * pRules,
+                                                     size_t ruleCount )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+
+    if( pConnection == NULL )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else if( PublishQueue_Init( &( pConnection->queue ),
+                                pConnection->queue.pEntries,
+                                pConnection->queue.entryCount,
+                                pConnection->queue.pSlots,
+                                pConnection->queue.slotSize,
+                                pRules,
+                                ruleCount ) != PublishQueueSuccess )
+    {
+        LogError( ( "Invalid rules for the offline publish queue." ) );
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+
+    MqttConnectionStatus_t MqttConnection_SetCompression( MqttConnection_t * pConnection,
+                                                          const MqttConnectionCompression_t * pCompression )
+    {
+        MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+        PayloadCompressionStatus_t compressionStatus = PayloadCompressionSuccess;
+
+        if( ( pConnection == NULL ) || ( pCompression == NULL ) ||
+            ( ( pCompression->pRules == NULL ) && ( pCompression->ruleCount > 0U ) ) ||
+            ( pCompression->pSlots == NULL ) ||
+            ( pCompression->slotSize <= PAYLOAD_COMPRESSION_HEADER_LENGTH ) ||
+            ( pCompression->pInflateBuffer == NULL ) ||
+            ( pCompression->inflateBufferSize == 0U ) )
+        {
+            returnStatus = MqttConnectionBadParameter;
+        }
+        else
+        {
+            if( pConnection->compressionReady == true )
+            {
+                PayloadCompression_Cleanup( &( pConnection->compression ) );
+                pConnection->compressionReady = false;
+            }
+
+            compressionStatus = PayloadCompression_Init( &( pConnection->compression ),
+                                                         pCompression->pDictionaries,
+                                                         pCompression->dictionaryCount );
+
+            if( compressionStatus == PayloadCompressionSuccess )
+            {
+                pConnection->compressionConfig = *pCompression;
+                pConnection->compressionReady = true;
+            }
+            else
+            {
+                LogError( ( "Failed to set up the payload compression." ) );
+                returnStatus = ( compressionStatus == PayloadCompressionNoMemory ) ?
+                               MqttConnectionNoMemory : MqttConnectionBadParameter;
+            }
+        }
+
+        return returnStatus;
+    }
+
+#endif /* if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_Connect( MqttConnection_t * pConnection )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTConnectInfo_t connectInfo;
+    TransportInterface_t transport;
+    bool sessionPresent = false;
+    uint32_t startTimeMs = Clock_GetTimeMs();
+
+    if( pConnection == NULL )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        /* A TLS session left open by a lost connection is closed before the
+         * network context is reset. */
+        closeTransport( pConnection );
+
+        /* Initialize the mqtt context and network context. */
+        ( void ) memset( &( pConnection->context ), 0x00, sizeof( MQTTContext_t ) );
+        ( void ) memset( &( pConnection->networkContext ), 0x00, sizeof( NetworkContext_t ) );
+        ( void ) memset( &( pConnection->incoming ), 0x00, sizeof( IncomingPacket_t ) );
+        pConnection->sessionEstablished = false;
+        pConnection->brokerConnected = false;
+
+        /* Direct the broker to reestablish the session which was already
+         * present, so that the unacknowledged publishes can be resent. */
+        connectInfo.cleanSession = false;
+        connectInfo.pClientIdentifier = pConnection->config.pClientIdentifier;
+        connectInfo.clientIdentifierLength = pConnection->config.clientIdentifierLength;
+        connectInfo.keepAliveSeconds = pConnection->config.keepAliveSeconds;
+        connectInfo.pUserName = pConnection->config.pUserName;
+        connectInfo.userNameLength = pConnection->config.userNameLength;
+        connectInfo.pPassword = NULL;
+        connectInfo.passwordLength = 0U;
+
+        if( ( pConnection->config.earlyConnect == true ) &&
+            ( pConnection->config.earlyDataReplaySafe == true ) )
+        {
+            prepareEarlyConnect( pConnection, &connectInfo );
+        }
+        else
+        {
+            pConnection->earlyConnectLength = 0U;
+        }
+
+        if( connectWithBackoffRetries( pConnection ) == false )
+        {
+            /* Log error to indicate connection failure after all
+             * reconnect attempts are over. */
+            LogError( ( "Failed to connect to MQTT broker %.*s.",
+                        pConnection->config.hostNameLength,
+                        pConnection->config.pHostName ) );
+            returnStatus = MqttConnectionFailed;
+        }
+        else
+        {
+            pConnection->transportConnected = true;
+
+            /* The TLS handshake gave the socket its first round trips, which
+             * the CONNACK is then awaited for. */
+            pConnection->adaptiveTimeoutMs = 0U;
+            pConnection->retransmits = 0U;
+
+            if( pConnection->config.adaptiveTimeouts == true )
+            {
+                adaptTimeouts( pConnection );
+            }
+
+            if( registerSocket( pConnection ) == false )
+            {
+                returnStatus = MqttConnectionFailed;
+            }
+        }
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        /* Fill in TransportInterface send and receive function pointers.
+         * Network context is SSL context for OpenSSL. */
+        transport.pNetworkContext = &( pConnection->networkContext );
+        transport.send = CONNECTION_SEND;
+        transport.recv = CONNECTION_RECV;
+
+        /* The payloads larger than the network buffer are streamed by
+         * interposing on the transport. */
+        if( ( pConnection->config.payloadBufferCallback != NULL ) ||
+            ( pConnection->config.payloadChunkCallback != NULL ) )
+        {
+            transport.send = sendTransport;
+            transport.recv = receiveTransport;
+        }
+
+        /* The CONNECT sent as early data is skipped by the transport. */
+        if( pConnection->earlyConnectLength > 0U )
+        {
+            transport.send = sendTransport;
+        }
+
+        /* Initialize MQTT library. */
+        mqttStatus = MQTT_Init( &( pConnection->context ),
+                                &transport,
+                                Clock_GetTimeMs,
+                                eventCallback,
+                                &( pConnection->networkBuffer ) );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "MQTT init failed with status %s.",
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = MqttConnectionFailed;
+        }
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        /* Send MQTT CONNECT packet to broker. */
+        mqttStatus = MQTT_Connect( &( pConnection->context ),
+                                   &connectInfo,
+                                   NULL,
+                                   effectiveTimeout( pConnection, pConnection->config.connackTimeoutMs ),
+                                   &sessionPresent );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Connection with MQTT broker failed with status %s.",
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = MqttConnectionFailed;
+        }
+        else
+        {
+            LogInfo( ( "MQTT connection successfully established with broker." ) );
+
+            /* A DISCONNECT has to be sent even if there are later
+             * failures. */
+            pConnection->sessionEstablished = true;
+
+            /* The PINGREQs are sent when the deadline of the socket is
+             * due, rather than checked for on each receive. */
+            scheduleKeepAlive( pConnection );
+        }
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        /* The outgoing publishes are only resent if the broker is
+         * re-establishing a session which was already present. */
+        if( sessionPresent == true )
+        {
+            LogInfo( ( "An MQTT session with broker is re-established. "
+                       "Resending unacked publishes." ) );
+            RECORD_METRIC( pConnection, sessionsResumed, 1U );
+
+            if( handlePublishResend( pConnection ) == false )
+            {
+                returnStatus = MqttConnectionFailed;
+            }
+        }
+        else
+        {
+            LogInfo( ( "A clean MQTT connection is established."
+                       " Cleaning up all the stored outgoing publishes." ) );
+            RECORD_METRIC( pConnection, sessionsStarted, 1U );
+            cleanupOutgoingPublishes( pConnection );
+
+            /* The broker of a clean session sends nothing again. */
+            #if ( MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED == 1 )
+                ( void ) memset( &( pConnection->duplicates ), 0x00, sizeof( DuplicateFilter_t ) );
+            #endif
+        }
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        pConnection->brokerConnected = true;
+        Metrics_Observe( metricIds.connectLatencyMs, ( uint64_t ) ( Clock_GetTimeMs() - startTimeMs ) );
+
+        /* Send the publishes issued while the connection was down. */
+        if( drainOfflinePublishes( pConnection ) == false )
+        {
+            returnStatus = MqttConnectionFailed;
+        }
+    }
+
+    /* A TLS session without an MQTT session is closed, so that a failed
+     * attempt leaves nothing for #MqttConnection_Disconnect to do and the
+     * connection can be retried at once. */
+    if( ( returnStatus != MqttConnectionSuccess ) && ( pConnection != NULL ) &&
+        ( pConnection->sessionEstablished == false ) )
+    {
+        closeTransport( pConnection );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_Disconnect( MqttConnection_t * pConnection )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    if( pConnection == NULL )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        if( pConnection->sessionEstablished == true )
+        {
+            /* Send DISCONNECT. */
+            mqttStatus = MQTT_Disconnect( &( pConnection->context ) );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogError( ( "Sending MQTT DISCONNECT failed with status %s.",
+                            MQTT_Status_strerror( mqttStatus ) ) );
+                returnStatus = MqttConnectionFailed;
+            }
+
+            pConnection->sessionEstablished = false;
+        }
+
+        /* End TLS session, then close TCP connection. */
+        closeTransport( pConnection );
+        pConnection->brokerConnected = false;
+
+        if( pConnection->hasStore == true )
+        {
+            /* Flush the publishes still waiting for their PUBACK. */
+            ( void ) PublishStore_Commit( &( pConnection->store ), true );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_Subscribe( MqttConnection_t * pConnection,
+                                                 const char * pTopicFilter,
+                                                 uint16_t topicFilterLength )
+{
+    MQTTSubscribeInfo_t subscription;
+
+    subscription.qos = MQTTQoS1;
+    subscription.pTopicFilter = pTopicFilter;
+    subscription.topicFilterLength = topicFilterLength;
+
+    return MqttConnection_SubscribeList( pConnection, &subscription, 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_SubscribeList( MqttConnection_t * pConnection,
+                                                     const MQTTSubscribeInfo_t * pSubscriptions,
+                                                     size_t subscriptionCount )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    size_t index = 0U;
+
+    if( ( pConnection == NULL ) || ( pSubscriptions == NULL ) || ( subscriptionCount == 0U ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+
+    for( index = 0U; ( index < subscriptionCount ) && ( returnStatus == MqttConnectionSuccess ); index++ )
+    {
+        if( ( pSubscriptions[ index ].pTopicFilter == NULL ) || ( pSubscriptions[ index ].topicFilterLength == 0U ) )
+        {
+            returnStatus = MqttConnectionBadParameter;
+        }
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        /* Generate packet identifier for the SUBSCRIBE packet. */
+        pConnection->subscribePacketId = MQTT_GetPacketId( &( pConnection->context ) );
+
+        mqttStatus = MQTT_Subscribe( &( pConnection->context ),
+                                     pSubscriptions,
+                                     subscriptionCount,
+                                     pConnection->subscribePacketId );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Failed to send SUBSCRIBE packet to broker with error = %s.",
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = MqttConnectionFailed;
+        }
+        else
+        {
+            for( index = 0U; index < subscriptionCount; index++ )
+            {
+                LogInfo( ( "SUBSCRIBE topic %.*s to broker.",
+                           pSubscriptions[ index ].topicFilterLength,
+                           pSubscriptions[ index ].pTopicFilter ) );
+            }
+
+            /* Receive the SUBACK. The broker may send a publish before it,
+             * which is given to the event callback as well. */
+            mqttStatus = waitForEvents( pConnection,
+                                        effectiveTimeout( pConnection, pConnection->config.ackTimeoutMs ),
+                                        WaitForSuback );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogError( ( "MQTT_ProcessLoop returned with status = %s.",
+                            MQTT_Status_strerror( mqttStatus ) ) );
+                returnStatus = MqttConnectionFailed;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_Unsubscribe( MqttConnection_t * pConnection,
+                                                   const char * pTopicFilter,
+                                                   uint16_t topicFilterLength )
+{
+    MQTTSubscribeInfo_t subscription;
+
+    subscription.qos = MQTTQoS1;
+    subscription.pTopicFilter = pTopicFilter;
+    subscription.topicFilterLength = topicFilterLength;
+
+    return MqttConnection_UnsubscribeList( pConnection, &subscription, 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_UnsubscribeList( MqttConnection_t * pConnection,
+                                                       const MQTTSubscribeInfo_t * pSubscriptions,
+                                                       size_t subscriptionCount )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    size_t index = 0U;
+
+    if( ( pConnection == NULL ) || ( pSubscriptions == NULL ) || ( subscriptionCount == 0U ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+
+    for( index = 0U; ( index < subscriptionCount ) && ( returnStatus == MqttConnectionSuccess ); index++ )
+    {
+        if( ( pSubscriptions[ index ].pTopicFilter == NULL ) || ( pSubscriptions[ index ].topicFilterLength == 0U ) )
+        {
+            returnStatus = MqttConnectionBadParameter;
+        }
+    }
+
+    if( returnStatus == MqttConnectionSuccess )
+    {
+        /* Generate packet identifier for the UNSUBSCRIBE packet. */
+        pConnection->unsubscribePacketId = MQTT_GetPacketId( &( pConnection->context ) );
+
+        mqttStatus = MQTT_Unsubscribe( &( pConnection->context ),
+                                       pSubscriptions,
+                                       subscriptionCount,
+                                       pConnection->unsubscribePacketId );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Failed to send UNSUBSCRIBE packet to broker with error = %s.",
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = MqttConnectionFailed;
+        }
+        else
+        {
+            for( index = 0U; index < subscriptionCount; index++ )
+            {
+                LogInfo( ( "UNSUBSCRIBE sent topic %.*s to broker.",
+                           pSubscriptions[ index ].topicFilterLength,
+                           pSubscriptions[ index ].pTopicFilter ) );
+            }
+
+            /* Receive the UNSUBACK. */
+            mqttStatus = waitForEvents( pConnection,
+                                        effectiveTimeout( pConnection, pConnection->config.ackTimeoutMs ),
+                                        WaitForUnsuback );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogError( ( "MQTT_ProcessLoop returned with status = %s.",
+                            MQTT_Status_strerror( mqttStatus ) ) );
+                returnStatus = MqttConnectionFailed;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_Publish( MqttConnection_t * pConnection,
+                                               const MQTTPublishInfo_t * pPublishInfo )
+{
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+
+    return MqttConnection_PublishWithId( pConnection, pPublishInfo, &packetId );
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_PublishWithId( MqttConnection_t * pConnection,
+                                                     const MQTTPublishInfo_t * pPublishInfo,
+                                                     uint16_t * pOutPacketId )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+    const MQTTPublishInfo_t * pSendInfo = pPublishInfo;
+
+    #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+        MQTTPublishInfo_t compressedInfo;
+    #endif
+
+    if( ( pConnection == NULL ) || ( pPublishInfo == NULL ) ||
+        ( pPublishInfo->qos != MQTTQoS1 ) || ( pOutPacketId == NULL ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else if( pConnection->brokerConnected == false )
+    {
+        *pOutPacketId = MQTT_PACKET_ID_INVALID;
+        returnStatus = queueOfflinePublish( pConnection, pPublishInfo );
+    }
+    else
+    {
+        *pOutPacketId = MQTT_PACKET_ID_INVALID;
+
+        /* Process the PUBACKs already received, which make room in the
+         * window. */
+        ( void ) waitForEvents( pConnection, 0U, WaitForTimeout );
+
+        /* Get a new packet id. */
+        packetId = getNextPacketId( pConnection );
+
+        #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+            pSendInfo = compressPublish( pConnection, pPublishInfo, &compressedInfo );
+        #endif
+
+        /* Store the outgoing publish in the window. All QoS1 outgoing publishes
+         * are stored until a PUBACK is received. These messages are stored for
+         * supporting a resend if a network connection is broken before
+         * receiving a PUBACK. */
+        if( addOutgoingPublish( pConnection, packetId, pSendInfo ) == false )
+        {
+            LogError( ( "Unable to find a free spot for outgoing PUBLISH message." ) );
+            returnStatus = MqttConnectionNoMemory;
+        }
+        else
+        {
+            /* Send PUBLISH packet. */
+            mqttStatus = MQTT_Publish( &( pConnection->context ),
+                                       pSendInfo,
+                                       packetId );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogError( ( "Failed to send PUBLISH packet to broker with error = %s.",
+                            MQTT_Status_strerror( mqttStatus ) ) );
+                ( void ) removeOutgoingPublish( pConnection, packetId );
+
+                /* The connection is lost, so the publish waits for the next
+                 * one. */
+                if( mqttStatus == MQTTSendFailed )
+                {
+                    RECORD_METRIC( pConnection, sendFailures, 1U );
+                    pConnection->brokerConnected = false;
+                    returnStatus = queueOfflinePublish( pConnection, pPublishInfo );
+                }
+                else
+                {
+                    returnStatus = MqttConnectionFailed;
+                }
+            }
+            else
+            {
+                LogDebug( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.",
+                            pPublishInfo->topicNameLength,
+                            pPublishInfo->pTopicName,
+                            packetId ) );
+                RECORD_METRIC( pConnection, publishesSent, 1U );
+                completePublishes( pConnection );
+
+                /* The PUBACK may already have been received while the queued
+                 * publishes were sent. */
+                if( PublishWindow_Find( &( pConnection->window ), packetId ) != NULL )
+                {
+                    *pOutPacketId = packetId;
+                }
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_PublishBatch( MqttConnection_t * pConnection,
+                                                    const MQTTPublishInfo_t * pPublishInfos,
+                                                    size_t publishCount )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    size_t nextIndex = 0U;
+    size_t batchStart = 0U;
+    size_t sentCount = 0U;
+    size_t i = 0U;
+
+    if( ( pConnection == NULL ) || ( ( pPublishInfos == NULL ) && ( publishCount > 0U ) ) ||
+        ( pConnection->pBatchBuffer == NULL ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+
+    while( ( returnStatus == MqttConnectionSuccess ) && ( nextIndex < publishCount ) &&
+           ( pConnection->brokerConnected == true ) )
+    {
+        batchStart = nextIndex;
+        mqttStatus = MQTTSuccess;
+
+        /* Serialize the publishes until the batch buffer, the batch or the
+         * window is full. */
+        while( ( nextIndex < publishCount ) && ( mqttStatus == MQTTSuccess ) )
+        {
+            mqttStatus = stagePublish( pConnection, &pPublishInfos[ nextIndex ] );
+
+            if( mqttStatus == MQTTSuccess )
+            {
+                nextIndex++;
+            }
+        }
+
+        if( ( mqttStatus != MQTTSuccess ) && ( mqttStatus != MQTTNoMemory ) )
+        {
+            returnStatus = MqttConnectionBadParameter;
+        }
+        else if( pConnection->stagedPublishCount == 0U )
+        {
+            LogError( ( "Unable to find a free spot for outgoing PUBLISH message, "
+                        "or the PUBLISH is larger than the batch buffer." ) );
+            returnStatus = MqttConnectionNoMemory;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        if( pConnection->stagedPublishCount > 0U )
+        {
+            sentCount = sendStagedPublishes( pConnection, pConnection->pBatchBuffer );
+
+            LogDebug( ( "PUBLISH batch of %lu packets sent to broker.",
+                        ( unsigned long ) sentCount ) );
+
+            /* The connection is lost, so the publishes not written whole wait
+             * for the next one. The broker drops the packet cut short with the
+             * connection. */
+            if( sentCount < pConnection->stagedPublishCount )
+            {
+                for( i = sentCount; i < pConnection->stagedPublishCount; i++ )
+                {
+                    ( void ) removeOutgoingPublish( pConnection, pConnection->stagedPublishes[ i ].packetId );
+                }
+
+                pConnection->brokerConnected = false;
+                nextIndex = batchStart + sentCount;
+            }
+
+            pConnection->stagedPublishCount = 0U;
+        }
+
+        if( pConnection->brokerConnected == true )
+        {
+            /* Receive the PUBACKs, which also make room in the window for the
+             * next batch. */
+            mqttStatus = waitForEvents( pConnection,
+                                        effectiveTimeout( pConnection, pConnection->config.ackTimeoutMs ),
+                                        WaitForPubacks );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogWarn( ( "MQTT_ProcessLoop returned with status = %s.",
+                           MQTT_Status_strerror( mqttStatus ) ) );
+            }
+        }
+    }
+
+    /* Queue the publishes not sent while the connection to the broker is
+     * down. */
+    while( ( returnStatus == MqttConnectionSuccess ) && ( nextIndex < publishCount ) &&
+           ( pConnection->brokerConnected == false ) )
+    {
+        returnStatus = queueOfflinePublish( pConnection, &pPublishInfos[ nextIndex ] );
+        nextIndex++;
+    }
+
+    if( pConnection != NULL )
+    {
+        completePublishes( pConnection );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_PublishInPlace( MqttConnection_t * pConnection,
+                                                      const MQTTPublishInfo_t * pPublishInfo,
+                                                      uint8_t * pPacketBuffer )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTFixedBuffer_t fixedBuffer;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+    size_t headerSize = 0U;
+    size_t headroom = 0U;
+    uint16_t packetId = MQTT_PACKET_ID_INVALID;
+    StagedPublish_t * pStaged = NULL;
+
+    if( ( pConnection != NULL ) && ( pPublishInfo != NULL ) )
+    {
+        headroom = MQTT_CONNECTION_PUBLISH_HEADROOM( pPublishInfo->topicNameLength );
+    }
+
+    if( ( pConnection == NULL ) || ( pPublishInfo == NULL ) || ( pPacketBuffer == NULL ) ||
+        ( pPublishInfo->qos != MQTTQoS1 ) ||
+        ( ( const uint8_t * ) pPublishInfo->pPayload != &( pPacketBuffer[ headroom ] ) ) ||
+        ( MQTT_GetPublishPacketSize( pPublishInfo, &remainingLength, &packetSize ) != MQTTSuccess ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else if( pConnection->brokerConnected == false )
+    {
+        returnStatus = queueOfflinePublish( pConnection, pPublishInfo );
+    }
+    else
+    {
+        /* Process the PUBACKs already received, which make room in the
+         * window. */
+        ( void ) waitForEvents( pConnection, 0U, WaitForTimeout );
+
+        /* As in a batch, the packet identifier is reserved in the state of
+         * the library before the packet is sent, so that its PUBACK is
+         * expected. */
+        packetId = getNextPacketId( pConnection );
+
+        if( addOutgoingPublish( pConnection, packetId, pPublishInfo ) == false )
+        {
+            LogError( ( "Unable to find a free spot for outgoing PUBLISH message." ) );
+            returnStatus = MqttConnectionNoMemory;
+        }
+        else if( MQTT_ReserveState( &( pConnection->context ), packetId, pPublishInfo->qos ) != MQTTSuccess )
+        {
+            ( void ) removeOutgoingPublish( pConnection, packetId );
+            returnStatus = MqttConnectionFailed;
+        }
+        else
+        {
+            /* The header ends where the payload starts; its length, now
+             * known, sets where it starts in the room. */
+            headerSize = packetSize - pPublishInfo->payloadLength;
+            fixedBuffer.pBuffer = &( pPacketBuffer[ headroom - headerSize ] );
+            fixedBuffer.size = headerSize;
+
+            mqttStatus = MQTT_SerializePublishHeader( pPublishInfo,
+                                                      packetId,
+                                                      remainingLength,
+                                                      &fixedBuffer,
+                                                      &headerSize );
+
+            if( mqttStatus != MQTTSuccess )
+            {
+                LogError( ( "Failed to serialize PUBLISH for topic %.*s with error = %s.",
+                            pPublishInfo->topicNameLength,
+                            pPublishInfo->pTopicName,
+                            MQTT_Status_strerror( mqttStatus ) ) );
+                ( void ) removeOutgoingPublish( pConnection, packetId );
+                returnStatus = MqttConnectionFailed;
+            }
+        }
+
+        if( returnStatus == MqttConnectionSuccess )
+        {
+            pStaged = &( pConnection->stagedPublishes[ 0 ] );
+            pStaged->pPublishInfo = pPublishInfo;
+            pStaged->packetId = packetId;
+            pStaged->packetEnd = packetSize;
+            pConnection->stagedPublishCount = 1U;
+
+            if( sendStagedPublishes( pConnection, fixedBuffer.pBuffer ) == 0U )
+            {
+                /* The connection is lost, so the publish waits for the next
+                 * one. */
+                ( void ) removeOutgoingPublish( pConnection, packetId );
+                pConnection->brokerConnected = false;
+                returnStatus = queueOfflinePublish( pConnection, pPublishInfo );
+            }
+            else
+            {
+                LogDebug( ( "PUBLISH sent in place for topic %.*s to broker with packet ID %u.",
+                            pPublishInfo->topicNameLength,
+                            pPublishInfo->pTopicName,
+                            packetId ) );
+            }
+
+            pConnection->stagedPublishCount = 0U;
+        }
+
+        completePublishes( pConnection );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_ProcessLoop( MqttConnection_t * pConnection,
+                                                   uint32_t timeoutMs )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+
+    if( pConnection == NULL )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        mqttStatus = waitForEvents( pConnection, timeoutMs, WaitForTimeout );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogWarn( ( "MQTT_ProcessLoop returned with status = %s.",
+                       MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = MqttConnectionFailed;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_GetEventDescriptor( const MqttConnection_t * pConnection,
+                                                          int32_t * pDescriptor )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+
+    if( ( pConnection == NULL ) || ( pDescriptor == NULL ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        /* An epoll instance is readable when one of its descriptors is
+         * ready, so it can itself be waited on by another event loop. */
+        *pDescriptor = pConnection->eventLoop.epollDescriptor;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void * MqttConnection_GetUserContext( const MQTTContext_t * pMqttContext )
+{
+    const MqttConnection_t * pConnection = NULL;
+    void * pUserContext = NULL;
+
+    if( pMqttContext != NULL )
+    {
+        pConnection = findConnection( pMqttContext );
+    }
+
+    if( pConnection != NULL )
+    {
+        pUserContext = pConnection->config.pUserContext;
+    }
+
+    return pUserContext;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MqttConnection_IsConnected( const MqttConnection_t * pConnection )
+{
+    return( ( pConnection != NULL ) && ( pConnection->brokerConnected == true ) );
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_GetMetrics( const MqttConnection_t * pConnection,
+                                                  MqttConnectionMetrics_t * pMetrics )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+
+    if( ( pConnection == NULL ) || ( pMetrics == NULL ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        *pMetrics = pConnection->metrics;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttConnectionStatus_t MqttConnection_GetBufferUsage( const MqttConnection_t * pConnection,
+                                                      OpensslBufferUsage_t * pUsage )
+{
+    MqttConnectionStatus_t returnStatus = MqttConnectionSuccess;
+
+    if( ( pConnection == NULL ) || ( pUsage == NULL ) ||
+        ( pConnection->transportConnected == false ) )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else if( Openssl_GetBufferUsage( &( pConnection->networkContext ),
+                                     pUsage ) != OPENSSL_SUCCESS )
+    {
+        returnStatus = MqttConnectionBadParameter;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void MqttConnection_Destroy( MqttConnection_t * pConnection )
+{
+    OpensslCredentials_t opensslCredentials;
+
+    if( pConnection != NULL )
+    {
+        /* Release the SSL context cached by the connection attempts. */
+        ( void ) memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+        opensslCredentials.pRootCaPath = pConnection->config.pRootCaPath;
+        opensslCredentials.pClientCertPath = pConnection->config.pClientCertPath;
+        opensslCredentials.pPrivateKeyPath = pConnection->config.pPrivateKeyPath;
+        opensslCredentials.sniHostName = pConnection->config.pHostName;
+        ( void ) Openssl_ReleaseCredentials( &opensslCredentials );
+
+        if( pConnection->hasStore == true )
+        {
+            PublishStore_Close( &( pConnection->store ) );
+            pConnection->hasStore = false;
+        }
+
+        #if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+            if( pConnection->compressionReady == true )
+            {
+                PayloadCompression_Cleanup( &( pConnection->compression ) );
+                pConnection->compressionReady = false;
+            }
+        #endif
+
+        unregisterSocket( pConnection );
+        ( void ) EventLoop_Deinit( &( pConnection->eventLoop ) );
+        pConnection->inUse = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
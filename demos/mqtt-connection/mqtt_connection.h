@@ -0,0 +1,722 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_connection.h
+ * @brief The API of an MQTT connection to a broker over mutually
+ * authenticated TLS, shared by the demos.
+ *
+ * A connection owns its MQTT context, its window of the outgoing QoS1
+ * publishes, optionally kept in a file, and its queue of the publishes issued
+ * while the broker is disconnected. It reconnects with backoff, resends the
+ * unacknowledged publishes when the broker resumes the session, and drains
+ * the queue once connected. The application supplies the memory of each
+ * connection, so several connections can run side by side.
+ *
+ * The API is not thread safe; each connection is meant to be used by a
+ * single thread.
+ */
+
+#ifndef MQTT_CONNECTION_H_
+#define MQTT_CONNECTION_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the MQTT Connection module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "MQTT Connection"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* Window of the outgoing QoS1 publishes. */
+#include "publish_window.h"
+
+/* Queue of the publishes issued while the connection is down. */
+#include "publish_queue.h"
+
+/* OpenSSL transport, for the buffer usage of the TLS session. */
+#include "openssl_posix.h"
+
+/**
+ * @brief Maximum number of connections that can be created at once.
+ */
+#ifndef MQTT_CONNECTION_MAX_INSTANCES
+    #define MQTT_CONNECTION_MAX_INSTANCES    ( 4U )
+#endif
+
+/**
+ * @brief Maximum number of publishes sent with a single transport write by
+ * #MqttConnection_PublishBatch.
+ */
+#ifndef MQTT_CONNECTION_BATCH_MAX_PUBLISHES
+    #define MQTT_CONNECTION_BATCH_MAX_PUBLISHES    ( 16U )
+#endif
+
+/**
+ * @brief Time after which a transport write of a batch that makes no
+ * progress fails, in milliseconds.
+ */
+#ifndef MQTT_CONNECTION_BATCH_SEND_TIMEOUT_MS
+    #define MQTT_CONNECTION_BATCH_SEND_TIMEOUT_MS    ( 1000U )
+#endif
+
+/**
+ * @brief Room to leave before the payload of a publish sent with
+ * #MqttConnection_PublishInPlace, for a topic of @p topicLength bytes: the
+ * largest fixed header, the length of the topic, the topic and the packet
+ * identifier.
+ */
+#define MQTT_CONNECTION_PUBLISH_HEADROOM( topicLength ) \
+    ( 5U + 2U + ( size_t ) ( topicLength ) + 2U )
+
+/**
+ * @brief Set to 1 in core_mqtt_config.h to bind the TLS transport of the
+ * connections at compile time, with transport_binding_posix.h.
+ *
+ * The connections then read ahead into a buffer of
+ * #MQTT_CONNECTION_RECV_BUFFER_SIZE bytes, and the reads it holds, such as
+ * those of the fixed header and remaining length of each packet, are served
+ * by inline code instead of by calls to Openssl_Recv.
+ */
+#ifndef MQTT_TRANSPORT_STATIC_BINDING
+    #define MQTT_TRANSPORT_STATIC_BINDING    ( 0 )
+#endif
+
+/**
+ * @brief Size of the read-ahead buffer of each connection when
+ * #MQTT_TRANSPORT_STATIC_BINDING is 1.
+ */
+#ifndef MQTT_CONNECTION_RECV_BUFFER_SIZE
+    #define MQTT_CONNECTION_RECV_BUFFER_SIZE    ( 2048U )
+#endif
+
+/**
+ * @brief Set to 1 in core_mqtt_config.h to compress the payloads of the topics
+ * chosen with #MqttConnection_SetCompression, which requires
+ * payload_compression.c and zlib.
+ */
+#ifndef MQTT_CONNECTION_COMPRESSION_ENABLED
+    #define MQTT_CONNECTION_COMPRESSION_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Set to 0 in core_mqtt_config.h to give the event callback the QoS1
+ * publishes the broker sends again, with DUP set, after it was delivered
+ * them once.
+ *
+ * A resent publish is recognized by its packet identifier and a hash of its
+ * topic and payload among the last #MQTT_CONNECTION_DUPLICATE_RING_LENGTH
+ * publishes delivered within #MQTT_CONNECTION_DUPLICATE_WINDOW_MS. It is
+ * still acknowledged by the MQTT library.
+ */
+#ifndef MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED
+    #define MQTT_CONNECTION_DUPLICATE_FILTER_ENABLED    ( 1 )
+#endif
+
+/**
+ * @brief Number of the last QoS1 publishes delivered that a resent publish is
+ * compared with. The broker resends at most the publishes it has in flight.
+ */
+#ifndef MQTT_CONNECTION_DUPLICATE_RING_LENGTH
+    #define MQTT_CONNECTION_DUPLICATE_RING_LENGTH    ( 32U )
+#endif
+
+/**
+ * @brief Time after its delivery during which a publish sent again is
+ * suppressed, in milliseconds.
+ */
+#ifndef MQTT_CONNECTION_DUPLICATE_WINDOW_MS
+    #define MQTT_CONNECTION_DUPLICATE_WINDOW_MS    ( 120000U )
+#endif
+
+/**
+ * @brief Multiple of the retransmission timeout of the socket taken as the
+ * timeouts of a connection with #MqttConnectionConfig_t.adaptiveTimeouts.
+ *
+ * The kernel derives the retransmission timeout from the smoothed round trip
+ * time and its variation, and backs it off while segments are lost, so a
+ * multiple of it leaves a few retransmissions to a packet before the wait for
+ * it gives up.
+ */
+#ifndef MQTT_CONNECTION_ADAPTIVE_TIMEOUT_FACTOR
+    #define MQTT_CONNECTION_ADAPTIVE_TIMEOUT_FACTOR    ( 8U )
+#endif
+
+/**
+ * @brief Shortest adaptive timeout, in milliseconds, leaving the broker the
+ * time to process a packet on a link of short round trips.
+ */
+#ifndef MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MIN_MS
+    #define MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MIN_MS    ( 1000U )
+#endif
+
+/**
+ * @brief Longest adaptive timeout, in milliseconds.
+ */
+#ifndef MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MAX_MS
+    #define MQTT_CONNECTION_ADAPTIVE_TIMEOUT_MAX_MS    ( 60000U )
+#endif
+
+/**
+ * @brief Interval at which the round trip time of a connection with
+ * #MqttConnectionConfig_t.adaptiveTimeouts is sampled, in milliseconds.
+ */
+#ifndef MQTT_CONNECTION_RTT_SAMPLE_INTERVAL_MS
+    #define MQTT_CONNECTION_RTT_SAMPLE_INTERVAL_MS    ( 5000U )
+#endif
+
+#if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+    /* Include header for the payload compression. */
+    #include "payload_compression.h"
+#endif
+
+/**
+ * @brief Return codes of the MQTT connection.
+ */
+typedef enum MqttConnectionStatus
+{
+    MqttConnectionSuccess = 0,  /**< @brief The operation completed; publishes were sent or queued. */
+    MqttConnectionBadParameter, /**< @brief A parameter is invalid, or every connection is in use. */
+    MqttConnectionNoMemory,     /**< @brief The window or the queue has no room for a publish. */
+    MqttConnectionFailed        /**< @brief The network, the broker or the store failed. */
+} MqttConnectionStatus_t;
+
+/**
+ * @brief An MQTT connection, created by #MqttConnection_Create.
+ */
+typedef struct MqttConnection MqttConnection_t;
+
+/**
+ * @brief Supplies the memory of the payload of an incoming PUBLISH whose
+ * packet does not fit in the network buffer.
+ *
+ * With this callback or #MqttConnectionPayloadChunkCallback_t configured,
+ * such a PUBLISH is received without holding the whole packet: only its topic
+ * and packet identifier go through the network buffer, which then only has to
+ * fit the largest of the other packets rather than the largest message. With
+ * neither configured, the MQTT library drops these PUBLISHes.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The topic, QoS and flags of the PUBLISH. Its
+ * payloadLength is the length of the whole payload, and its pPayload is NULL.
+ *
+ * @return A buffer of at least payloadLength bytes to receive the payload
+ * into, which the event callback then gets as pPayload; NULL to receive the
+ * payload in chunks with #MqttConnectionPayloadChunkCallback_t instead.
+ */
+typedef uint8_t * ( * MqttConnectionPayloadBufferCallback_t )( MqttConnection_t * pConnection,
+                                                               const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Receives the payload of an incoming PUBLISH whose packet does not
+ * fit in the network buffer, one chunk at a time, before the event callback
+ * gets the PUBLISH with a NULL pPayload.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The PUBLISH, as given to
+ * #MqttConnectionPayloadBufferCallback_t.
+ * @param[in] offset Offset of the chunk in the payload.
+ * @param[in] pChunk The chunk, valid until the callback returns.
+ * @param[in] chunkLength Length of @p pChunk, at most the room the topic
+ * leaves in the network buffer.
+ */
+typedef void ( * MqttConnectionPayloadChunkCallback_t )( MqttConnection_t * pConnection,
+                                                         const MQTTPublishInfo_t * pPublishInfo,
+                                                         size_t offset,
+                                                         const uint8_t * pChunk,
+                                                         size_t chunkLength );
+
+/**
+ * @brief The broker and the session of a connection.
+ *
+ * The strings must remain valid until #MqttConnection_Destroy.
+ */
+typedef struct MqttConnectionConfig
+{
+    const char * pHostName;              /**< @brief Host name of the broker. */
+    uint16_t hostNameLength;             /**< @brief Length of #MqttConnectionConfig_t.pHostName. */
+    uint16_t port;                       /**< @brief Port of the broker; 443 selects the ALPN protocol of AWS IoT. */
+    const char * pRootCaPath;            /**< @brief Root CA certificate of the broker. */
+    const char * pClientCertPath;        /**< @brief Client certificate. */
+    const char * pPrivateKeyPath;        /**< @brief Private key of the client certificate. */
+    const char * pClientIdentifier;      /**< @brief Client identifier of the session. */
+    uint16_t clientIdentifierLength;     /**< @brief Length of #MqttConnectionConfig_t.pClientIdentifier. */
+    const char * pUserName;              /**< @brief User name, such as the metrics string of AWS IoT; NULL for none. */
+    uint16_t userNameLength;             /**< @brief Length of #MqttConnectionConfig_t.pUserName. */
+    uint16_t keepAliveSeconds;           /**< @brief Keep-alive interval of the session. */
+    uint32_t transportTimeoutMs;         /**< @brief Send and receive timeout of the TLS connection. */
+    uint32_t connackTimeoutMs;           /**< @brief Time to wait for the CONNACK. */
+    bool earlyConnect;                   /**< @brief Send the CONNECT as TLS 1.3 early data on resumed TLS sessions; see #MqttConnection_Connect. */
+    bool earlyDataReplaySafe;            /**< @brief Whether a replay of the early CONNECT is harmless to the application; #MqttConnectionConfig_t.earlyConnect has no effect unless set. */
+    bool releaseIdleBuffers;             /**< @brief Free the TLS record buffers while the connection is idle; see #OpensslCredentials_t.releaseIdleBuffers. */
+    uint16_t maxFragmentLength;          /**< @brief Largest TLS record sent, and asked of the broker with #MqttConnectionConfig_t.releaseIdleBuffers; 0 for the TLS maximum. */
+    OpensslOcspMode_t ocspMode;          /**< @brief Whether the broker certificate is checked against a stapled OCSP response; see #OpensslCredentials_t.ocspMode. */
+    bool cacheVerifiedChains;            /**< @brief Skip verifying the chain of a recently verified broker certificate again; see #OpensslCredentials_t.cacheVerifiedChains. */
+    uint32_t ackTimeoutMs;               /**< @brief Longest time to wait for the SUBACK, the UNSUBACK or the PUBACKs of a batch. */
+    bool adaptiveTimeouts;               /**< @brief Derive the transport, CONNACK, ack and PINGRESP timeouts from the round trip time of the socket rather than the configured ones; see #MQTT_CONNECTION_ADAPTIVE_TIMEOUT_FACTOR. */
+    uint16_t retryBaseMs;                /**< @brief Base backoff delay of the connection attempts. */
+    uint16_t retryMaxDelayMs;            /**< @brief Maximum backoff delay of the connection attempts. */
+    uint32_t retryMaxAttempts;           /**< @brief Maximum number of connection attempts. */
+    size_t drainBatchSize;               /**< @brief Number of queued publishes sent before the PUBACKs received are processed. */
+    uint32_t drainIntervalMs;            /**< @brief Longest time spent receiving PUBACKs after each batch of queued publishes. */
+    const char * pStorePath;             /**< @brief File keeping the outgoing publishes across runs; NULL to keep them in memory only. */
+    size_t storeSize;                    /**< @brief Size of the file of #MqttConnectionConfig_t.pStorePath. */
+    MQTTEventCallback_t eventCallback;   /**< @brief Callback of the incoming packets, called after the connection handles the PUBACKs; NULL for none. */
+    MqttConnectionPayloadBufferCallback_t payloadBufferCallback; /**< @brief Memory of the payloads of the incoming PUBLISHes larger than the network buffer; NULL for none. */
+    MqttConnectionPayloadChunkCallback_t payloadChunkCallback;   /**< @brief Receives the payloads #MqttConnectionConfig_t.payloadBufferCallback supplies no memory for; NULL for none. */
+    void * pUserContext;                                         /**< @brief Application data, returned by #MqttConnection_GetUserContext; NULL for none. */
+} MqttConnectionConfig_t;
+
+/**
+ * @brief The memory of a connection, which must remain valid until
+ * #MqttConnection_Destroy.
+ */
+typedef struct MqttConnectionBuffers
+{
+    uint8_t * pNetworkBuffer;              /**< @brief Network buffer of the MQTT context. */
+    size_t networkBufferSize;              /**< @brief Size of #MqttConnectionBuffers_t.pNetworkBuffer. */
+    PublishWindowEntry_t * pWindowEntries; /**< @brief Entries of the window of the outgoing publishes. */
+    size_t windowLength;                   /**< @brief Number of window entries; the MQTT library keeps at most #MQTT_STATE_ARRAY_MAX_COUNT publishes in flight. */
+    uint16_t * pWindowBuckets;             /**< @brief Hash buckets of the window, #PUBLISH_WINDOW_BUCKET_COUNT of its length. */
+    PublishQueueEntry_t * pQueueEntries;   /**< @brief Entries of the offline queue. */
+    size_t queueLength;                    /**< @brief Number of queue entries. */
+    uint8_t * pQueueSlots;                 /**< @brief Copies of the topics and payloads of the queue, @p queueLength slots. */
+    size_t queueSlotSize;                  /**< @brief Maximum length of the topic and payload of a queued publish. */
+    uint8_t * pBatchBuffer;                /**< @brief Buffer of #MqttConnection_PublishBatch; NULL if batches are not used. */
+    size_t batchBufferSize;                /**< @brief Size of #MqttConnectionBuffers_t.pBatchBuffer. */
+} MqttConnectionBuffers_t;
+
+#if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+
+/**
+ * @brief The payloads of some topics to compress when they are sent and to
+ * decompress when they are received.
+ *
+ * The subscribers of these topics must share the dictionaries. The topics
+ * of the AWS IoT services, whose payloads the services parse, must not be
+ * compressed.
+ */
+    typedef struct MqttConnectionCompressionRule
+    {
+        const char * pTopicFilter;  /**< @brief The topics of the rule, with the wildcards of a subscription. */
+        uint16_t topicFilterLength; /**< @brief Length of #MqttConnectionCompressionRule_t.pTopicFilter. */
+        uint8_t dictionaryId;       /**< @brief Dictionary the payloads are compressed with, or #PAYLOAD_DICTIONARY_NONE. */
+        size_t minPayloadLength;    /**< @brief Length below which the payloads are sent as they are. */
+    } MqttConnectionCompressionRule_t;
+
+/**
+ * @brief The compression of a connection, and its memory, which must remain
+ * valid until #MqttConnection_Destroy.
+ */
+    typedef struct MqttConnectionCompression
+    {
+        const MqttConnectionCompressionRule_t * pRules; /**< @brief The topics to compress. */
+        size_t ruleCount;                               /**< @brief Number of rules of #MqttConnectionCompression_t.pRules. */
+        const PayloadDictionary_t * pDictionaries;      /**< @brief The dictionaries shared with the subscribers. */
+        size_t dictionaryCount;                         /**< @brief Number of #MqttConnectionCompression_t.pDictionaries. */
+        uint8_t * pSlots;                               /**< @brief Compressed payloads awaiting their PUBACK, one slot per window entry. */
+        size_t slotSize;                                /**< @brief Size of a slot; larger payloads that do not compress below it are sent as they are. */
+        uint8_t * pInflateBuffer;                       /**< @brief Buffer receiving a decompressed incoming payload, until the event callback returns. */
+        size_t inflateBufferSize;                       /**< @brief Size of #MqttConnectionCompression_t.pInflateBuffer. */
+    } MqttConnectionCompression_t;
+
+#endif /* if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 ) */
+
+/**
+ * @brief Counters of the activity of a connection since its creation.
+ *
+ * Their totals over all the connections are recorded in the registry of
+ * metrics.h as well, named "mqtt_<counter>_total".
+ */
+typedef struct MqttConnectionMetrics
+{
+    uint32_t connectAttempts;       /**< @brief TLS connections attempted, retries included. */
+    uint32_t sessionsStarted;       /**< @brief Clean sessions established. */
+    uint32_t sessionsResumed;       /**< @brief Sessions resumed by the broker. */
+    uint32_t publishesSent;         /**< @brief QoS1 publishes sent for the first time, queued ones included. */
+    uint32_t publishesResent;       /**< @brief Publishes resent when a session was resumed. */
+    uint32_t publishesQueued;       /**< @brief Publishes queued while the broker was disconnected. */
+    uint32_t pubacksReceived;       /**< @brief PUBACKs of the publishes of the window. */
+    uint32_t batchesSent;           /**< @brief Batches of #MqttConnection_PublishBatch written. */
+    uint32_t sendFailures;          /**< @brief Sends that failed, each marking the broker as disconnected. */
+    uint32_t payloadsStreamed;      /**< @brief Incoming payloads larger than the network buffer that were streamed. */
+    uint32_t payloadsCompressed;    /**< @brief Outgoing payloads compressed before they were sent. */
+    uint32_t compressedInputBytes;  /**< @brief Bytes of the compressed outgoing payloads, before compression. */
+    uint32_t compressedOutputBytes; /**< @brief Bytes of the compressed outgoing payloads, headers included. */
+    uint32_t payloadsDecompressed;  /**< @brief Incoming payloads decompressed. */
+    uint32_t compressionCpuUs;      /**< @brief CPU time of the compression and decompression, in microseconds. */
+    uint32_t duplicatesSuppressed;  /**< @brief Incoming QoS1 publishes sent again by the broker and not given to the event callback. */
+} MqttConnectionMetrics_t;
+
+/**
+ * @brief Create a connection, without connecting it.
+ *
+ * The window is restored from #MqttConnectionConfig_t.pStorePath, if set, so
+ * that the publishes left by a previous run are resent if the broker resumes
+ * the session.
+ *
+ * @param[out] ppConnection The connection.
+ * @param[in] pConfig The broker and the session, copied by the connection.
+ * @param[in] pBuffers The memory of the connection.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed if the store or the event loop cannot be opened.
+ */
+MqttConnectionStatus_t MqttConnection_Create( MqttConnection_t ** ppConnection,
+                                              const MqttConnectionConfig_t * pConfig,
+                                              const MqttConnectionBuffers_t * pBuffers );
+
+/**
+ * @brief Set the rules of the offline queue, emptying it.
+ *
+ * Without a call to this function, the queue has no rules, so all the
+ * publishes have the lowest priority and drop the oldest when it is full.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pRules The rules, which must remain valid until
+ * #MqttConnection_Destroy; NULL for none.
+ * @param[in] ruleCount Number of rules of @p pRules.
+ *
+ * @return #MqttConnectionSuccess or #MqttConnectionBadParameter.
+ */
+MqttConnectionStatus_t MqttConnection_SetQueueRules( MqttConnection_t * pConnection,
+                                                     const PublishQueueRule_t * pRules,
+                                                     size_t ruleCount );
+
+#if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 )
+
+/**
+ * @brief Compress the payloads of the topics of some rules, replacing the
+ * previous compression.
+ *
+ * A publish of these topics is compressed when it is sent, so an offline
+ * publish is queued as it is, and a received payload that starts with
+ * #PAYLOAD_COMPRESSION_MARKER is decompressed before the event callback; one
+ * that cannot be is not given to it. The payloads of
+ * #MqttConnection_PublishInPlace are sent as they are.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pCompression The rules and the memory of the compression, with
+ * as many slots as #MqttConnectionBuffers_t.windowLength; copied by the
+ * connection.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionNoMemory if zlib cannot be initialized.
+ */
+    MqttConnectionStatus_t MqttConnection_SetCompression( MqttConnection_t * pConnection,
+                                                          const MqttConnectionCompression_t * pCompression );
+
+#endif /* if ( MQTT_CONNECTION_COMPRESSION_ENABLED == 1 ) */
+
+/**
+ * @brief Connect to the broker, with retries and backoff, and establish the
+ * MQTT session.
+ *
+ * If the broker resumes the session, the publishes of the window are resent;
+ * otherwise they are dropped. The queued publishes are then sent.
+ *
+ * With #MqttConnectionConfig_t.earlyConnect, the TLS sessions the broker
+ * issues are cached, and the CONNECT is sent in the first flight of the
+ * connections resuming them, which saves a round trip on each reconnect.
+ * Early data can be replayed by an attacker who captured it, which would
+ * make the broker take over the session of the client identifier again, so
+ * the CONNECT is only sent as early data when
+ * #MqttConnectionConfig_t.earlyDataReplaySafe is also set.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed.
+ */
+MqttConnectionStatus_t MqttConnection_Connect( MqttConnection_t * pConnection );
+
+/**
+ * @brief Send a DISCONNECT if the session is established, and close the TLS
+ * connection.
+ *
+ * The window is kept, to be resent by the next #MqttConnection_Connect.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed if the DISCONNECT could not be sent.
+ */
+MqttConnectionStatus_t MqttConnection_Disconnect( MqttConnection_t * pConnection );
+
+/**
+ * @brief Subscribe to a topic filter with QoS1, and wait up to
+ * #MqttConnectionConfig_t.ackTimeoutMs for the SUBACK.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed.
+ */
+MqttConnectionStatus_t MqttConnection_Subscribe( MqttConnection_t * pConnection,
+                                                 const char * pTopicFilter,
+                                                 uint16_t topicFilterLength );
+
+/**
+ * @brief Subscribe to several topic filters with a single SUBSCRIBE, and
+ * wait up to #MqttConnectionConfig_t.ackTimeoutMs for its SUBACK.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pSubscriptions The topic filters, with their QoS.
+ * @param[in] subscriptionCount Number of entries of @p pSubscriptions.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed.
+ */
+MqttConnectionStatus_t MqttConnection_SubscribeList( MqttConnection_t * pConnection,
+                                                     const MQTTSubscribeInfo_t * pSubscriptions,
+                                                     size_t subscriptionCount );
+
+/**
+ * @brief Unsubscribe from a topic filter, and wait up to
+ * #MqttConnectionConfig_t.ackTimeoutMs for the UNSUBACK.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed.
+ */
+MqttConnectionStatus_t MqttConnection_Unsubscribe( MqttConnection_t * pConnection,
+                                                   const char * pTopicFilter,
+                                                   uint16_t topicFilterLength );
+
+/**
+ * @brief Unsubscribe from several topic filters with a single UNSUBSCRIBE,
+ * and wait up to #MqttConnectionConfig_t.ackTimeoutMs for its UNSUBACK.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pSubscriptions The topic filters.
+ * @param[in] subscriptionCount Number of entries of @p pSubscriptions.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed.
+ */
+MqttConnectionStatus_t MqttConnection_UnsubscribeList( MqttConnection_t * pConnection,
+                                                       const MQTTSubscribeInfo_t * pSubscriptions,
+                                                       size_t subscriptionCount );
+
+/**
+ * @brief Send a QoS1 publish, keeping it in the window until its PUBACK.
+ *
+ * While the broker is disconnected, or if the send fails, the publish is
+ * queued instead, to be sent once #MqttConnection_Connect reconnects.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The publish, with QoS1. Unless the connection has
+ * a store, its topic and payload must remain valid until its PUBACK.
+ *
+ * @return #MqttConnectionSuccess if the publish is sent or queued;
+ * #MqttConnectionNoMemory if the window or the queue has no room for it;
+ * #MqttConnectionBadParameter or #MqttConnectionFailed otherwise.
+ */
+MqttConnectionStatus_t MqttConnection_Publish( MqttConnection_t * pConnection,
+                                               const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Send a QoS1 publish as #MqttConnection_Publish does, and give the
+ * packet identifier its PUBACK will carry.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The publish, as for #MqttConnection_Publish.
+ * @param[out] pOutPacketId The packet identifier of the publish if it was
+ * sent and awaits its PUBACK; 0 if it was queued, as it gets one only once
+ * the queue is drained, or if its PUBACK was already received.
+ *
+ * @return The same values as #MqttConnection_Publish.
+ */
+MqttConnectionStatus_t MqttConnection_PublishWithId( MqttConnection_t * pConnection,
+                                                     const MQTTPublishInfo_t * pPublishInfo,
+                                                     uint16_t * pOutPacketId );
+
+/**
+ * @brief Send several QoS1 publishes with as few transport writes as
+ * possible.
+ *
+ * The PUBLISH packets are serialized back to back into the batch buffer and
+ * sent with a single write. A larger number of publishes is sent in several
+ * batches, the PUBACKs being received in between, for up to
+ * #MqttConnectionConfig_t.ackTimeoutMs. As with
+ * #MqttConnection_Publish, the publishes not sent because the broker is
+ * disconnected are queued instead.
+ *
+ * @param[in] pConnection The connection, created with a batch buffer.
+ * @param[in] pPublishInfos The publishes, with QoS1. Their topics and
+ * payloads must remain valid until their PUBACK.
+ * @param[in] publishCount Number of entries of @p pPublishInfos.
+ *
+ * @return #MqttConnectionSuccess if every publish is sent or queued;
+ * #MqttConnectionNoMemory if a publish does not fit in the batch buffer or
+ * the queue; #MqttConnectionBadParameter or #MqttConnectionFailed otherwise.
+ */
+MqttConnectionStatus_t MqttConnection_PublishBatch( MqttConnection_t * pConnection,
+                                                    const MQTTPublishInfo_t * pPublishInfos,
+                                                    size_t publishCount );
+
+/**
+ * @brief Send a QoS1 publish whose payload was written in place after the
+ * room for its header, so that the packet is sent from the same buffer.
+ *
+ * Once the length of the payload is known, the header is serialized into
+ * the end of the room before it, and the packet is sent with a single
+ * transport write; the payload is not copied. As with
+ * #MqttConnection_Publish, the publish is queued instead while the broker is
+ * disconnected.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] pPublishInfo The publish, with QoS1. Its pPayload is at
+ * #MQTT_CONNECTION_PUBLISH_HEADROOM bytes of its topic into
+ * @p pPacketBuffer.
+ * @param[in] pPacketBuffer The buffer of the packet. The packet must remain
+ * valid until its PUBACK, as the publish is resent from it.
+ *
+ * @return #MqttConnectionSuccess if the publish is sent or queued;
+ * #MqttConnectionNoMemory if the window or the queue is full;
+ * #MqttConnectionBadParameter or #MqttConnectionFailed otherwise.
+ */
+MqttConnectionStatus_t MqttConnection_PublishInPlace( MqttConnection_t * pConnection,
+                                                      const MQTTPublishInfo_t * pPublishInfo,
+                                                      uint8_t * pPacketBuffer );
+
+/**
+ * @brief Receive the incoming packets, and send a PINGREQ when the
+ * keep-alive interval expires.
+ *
+ * The connection waits on its socket and on the deadline of the keep-alive
+ * with an event loop, so the packets are processed as soon as they arrive,
+ * and the thread sleeps until then. The functions waiting for
+ * acknowledgements return as soon as they arrive.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] timeoutMs Time spent receiving.
+ *
+ * @return #MqttConnectionSuccess, #MqttConnectionBadParameter or
+ * #MqttConnectionFailed.
+ */
+MqttConnectionStatus_t MqttConnection_ProcessLoop( MqttConnection_t * pConnection,
+                                                   uint32_t timeoutMs );
+
+/**
+ * @brief Get the descriptor of the event loop of a connection, with which
+ * connections are driven by the event loop of the application instead.
+ *
+ * The descriptor is readable when the socket of the connection is, so it can
+ * be registered with #EventLoop_Add, and #MqttConnection_ProcessLoop called
+ * with a timeout of 0 when it is reported. The keep-alive deadline is not
+ * reported by the descriptor, so #MqttConnection_ProcessLoop must also be
+ * called at least every second or so while the connection is idle.
+ *
+ * The descriptor stays the same across the sessions of the connection.
+ *
+ * @param[in] pConnection The connection.
+ * @param[out] pDescriptor The descriptor.
+ *
+ * @return #MqttConnectionSuccess or #MqttConnectionBadParameter.
+ */
+MqttConnectionStatus_t MqttConnection_GetEventDescriptor( const MqttConnection_t * pConnection,
+                                                          int32_t * pDescriptor );
+
+/**
+ * @brief Get the #MqttConnectionConfig_t.pUserContext of the connection of an
+ * MQTT context, such as the one given to #MqttConnectionConfig_t.eventCallback.
+ *
+ * @param[in] pMqttContext The MQTT context.
+ *
+ * @return The application data; NULL if no connection has the context.
+ */
+void * MqttConnection_GetUserContext( const MQTTContext_t * pMqttContext );
+
+/**
+ * @brief Check whether publishes are sent rather than queued.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if the session is established and no send has failed since;
+ * false otherwise.
+ */
+bool MqttConnection_IsConnected( const MqttConnection_t * pConnection );
+
+/**
+ * @brief Read the counters of a connection.
+ *
+ * @param[in] pConnection The connection.
+ * @param[out] pMetrics The counters.
+ *
+ * @return #MqttConnectionSuccess or #MqttConnectionBadParameter.
+ */
+MqttConnectionStatus_t MqttConnection_GetMetrics( const MqttConnection_t * pConnection,
+                                                  MqttConnectionMetrics_t * pMetrics );
+
+/**
+ * @brief Report the memory held by the buffers of the TLS session of a
+ * connection.
+ *
+ * @param[in] pConnection The connection.
+ * @param[out] pUsage The buffer usage, see #Openssl_GetBufferUsage.
+ *
+ * @return #MqttConnectionSuccess, or #MqttConnectionBadParameter if the TLS
+ * session is not open.
+ */
+MqttConnectionStatus_t MqttConnection_GetBufferUsage( const MqttConnection_t * pConnection,
+                                                      OpensslBufferUsage_t * pUsage );
+
+/**
+ * @brief Close the store and the event loop of a disconnected connection,
+ * and free the connection for #MqttConnection_Create.
+ *
+ * @param[in] pConnection The connection.
+ */
+void MqttConnection_Destroy( MqttConnection_t * pConnection );
+
+#endif /* ifndef MQTT_CONNECTION_H_ */
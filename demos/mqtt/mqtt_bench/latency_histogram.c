@@ -0,0 +1,198 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file latency_histogram.c
+ * @brief Histogram of latencies with a bounded relative error.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "latency_histogram.h"
+
+/**
+ * @brief Number of counters of each power of two above
+ * #LATENCY_HISTOGRAM_SUB_BUCKETS.
+ */
+#define HALF_SUB_BUCKETS    ( LATENCY_HISTOGRAM_SUB_BUCKETS / 2U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the counter of a value.
+ *
+ * @param[in] value The value.
+ *
+ * @return The index of the counter in #LatencyHistogram_t.counters.
+ */
+static size_t getCounterIndex( uint32_t value );
+
+/**
+ * @brief Get the largest value of a counter.
+ *
+ * @param[in] index The index of the counter in #LatencyHistogram_t.counters.
+ *
+ * @return The largest value the counter counts.
+ */
+static uint32_t getCounterMaxValue( size_t index );
+
+/*-----------------------------------------------------------*/
+
+static size_t getCounterIndex( uint32_t value )
+{
+    size_t index = ( size_t ) value;
+    uint32_t shift = 0U;
+
+    if( value >= LATENCY_HISTOGRAM_SUB_BUCKETS )
+    {
+        /* The top LATENCY_HISTOGRAM_SUB_BUCKET_BITS bits of the value select
+         * the counter within its power of two. */
+        shift = ( 31U - ( uint32_t ) __builtin_clz( value ) ) - ( LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1U );
+        index = LATENCY_HISTOGRAM_SUB_BUCKETS +
+                ( ( size_t ) ( shift - 1U ) * HALF_SUB_BUCKETS ) +
+                ( size_t ) ( ( value >> shift ) - HALF_SUB_BUCKETS );
+    }
+
+    return index;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getCounterMaxValue( size_t index )
+{
+    uint32_t maxValue = ( uint32_t ) index;
+    uint32_t shift = 0U;
+    uint32_t subBucket = 0U;
+
+    if( index >= LATENCY_HISTOGRAM_SUB_BUCKETS )
+    {
+        shift = ( uint32_t ) ( ( index - LATENCY_HISTOGRAM_SUB_BUCKETS ) / HALF_SUB_BUCKETS ) + 1U;
+        subBucket = ( uint32_t ) ( ( index - LATENCY_HISTOGRAM_SUB_BUCKETS ) % HALF_SUB_BUCKETS ) + HALF_SUB_BUCKETS;
+        maxValue = ( subBucket << shift ) + ( ( 1U << shift ) - 1U );
+    }
+
+    return maxValue;
+}
+
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Init( LatencyHistogram_t * pHistogram )
+{
+    ( void ) memset( pHistogram, 0x00, sizeof( LatencyHistogram_t ) );
+    pHistogram->min = UINT32_MAX;
+}
+
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Record( LatencyHistogram_t * pHistogram,
+                              uint32_t value )
+{
+    pHistogram->counters[ getCounterIndex( value ) ]++;
+    pHistogram->count++;
+    pHistogram->sum += value;
+
+    if( value < pHistogram->min )
+    {
+        pHistogram->min = value;
+    }
+
+    if( value > pHistogram->max )
+    {
+        pHistogram->max = value;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Add( LatencyHistogram_t * pDestination,
+                           const LatencyHistogram_t * pSource )
+{
+    size_t i = 0U;
+
+    for( i = 0U; i < LATENCY_HISTOGRAM_COUNTERS; i++ )
+    {
+        pDestination->counters[ i ] += pSource->counters[ i ];
+    }
+
+    pDestination->count += pSource->count;
+    pDestination->sum += pSource->sum;
+
+    if( pSource->min < pDestination->min )
+    {
+        pDestination->min = pSource->min;
+    }
+
+    if( pSource->max > pDestination->max )
+    {
+        pDestination->max = pSource->max;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t LatencyHistogram_Percentile( const LatencyHistogram_t * pHistogram,
+                                      double percentile )
+{
+    uint32_t value = 0U;
+    uint64_t rank = 0U;
+    uint64_t countBelow = 0U;
+    size_t i = 0U;
+
+    if( pHistogram->count > 0U )
+    {
+        /* The rank of the value at the percentile, from 1. */
+        rank = ( uint64_t ) ( ( percentile / 100.0 ) * ( double ) pHistogram->count );
+
+        if( ( ( double ) rank ) < ( ( percentile / 100.0 ) * ( double ) pHistogram->count ) )
+        {
+            rank++;
+        }
+
+        if( rank == 0U )
+        {
+            rank = 1U;
+        }
+        else if( rank > pHistogram->count )
+        {
+            rank = pHistogram->count;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        for( i = 0U; countBelow < rank; i++ )
+        {
+            countBelow += pHistogram->counters[ i ];
+        }
+
+        value = getCounterMaxValue( i - 1U );
+
+        if( value > pHistogram->max )
+        {
+            value = pHistogram->max;
+        }
+    }
+
+    return value;
+}
@@ -0,0 +1,115 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file latency_histogram.h
+ * @brief Histogram of latencies with a bounded relative error, in the manner
+ * of HdrHistogram.
+ *
+ * Values below #LATENCY_HISTOGRAM_SUB_BUCKETS have a counter each. Each
+ * larger power of two is split into #LATENCY_HISTOGRAM_SUB_BUCKETS / 2
+ * counters of equal width, so a value is counted with a relative error below
+ * 2 / #LATENCY_HISTOGRAM_SUB_BUCKETS whatever its magnitude. Recording takes
+ * constant time and no allocation, so it can be done on the path being
+ * measured, and histograms of several threads are merged by adding their
+ * counters.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief log2 of #LATENCY_HISTOGRAM_SUB_BUCKETS, which sets the precision of
+ * the histogram. The default of 7 counts values within 1.6 percent.
+ */
+#ifndef LATENCY_HISTOGRAM_SUB_BUCKET_BITS
+    #define LATENCY_HISTOGRAM_SUB_BUCKET_BITS    ( 7U )
+#endif
+
+/**
+ * @brief Number of counters of the values below it, each counting a single
+ * value.
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKETS    ( 1U << LATENCY_HISTOGRAM_SUB_BUCKET_BITS )
+
+/**
+ * @brief Number of counters of a histogram, which covers the 32-bit values.
+ */
+#define LATENCY_HISTOGRAM_COUNTERS \
+    ( LATENCY_HISTOGRAM_SUB_BUCKETS + ( ( 32U - LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) * ( LATENCY_HISTOGRAM_SUB_BUCKETS / 2U ) ) )
+
+/**
+ * @brief A histogram of values, such as latencies in microseconds.
+ *
+ * The members are managed by the LatencyHistogram functions.
+ */
+typedef struct LatencyHistogram
+{
+    uint64_t counters[ LATENCY_HISTOGRAM_COUNTERS ]; /**< @brief Number of values of each counter. */
+    uint64_t count;                                  /**< @brief Number of values recorded. */
+    uint64_t sum;                                    /**< @brief Sum of the values recorded. */
+    uint32_t min;                                    /**< @brief Smallest value recorded. */
+    uint32_t max;                                    /**< @brief Largest value recorded. */
+} LatencyHistogram_t;
+
+/**
+ * @brief Initialize a histogram with no value.
+ *
+ * @param[out] pHistogram The histogram.
+ */
+void LatencyHistogram_Init( LatencyHistogram_t * pHistogram );
+
+/**
+ * @brief Record a value.
+ *
+ * @param[in] pHistogram The histogram.
+ * @param[in] value The value.
+ */
+void LatencyHistogram_Record( LatencyHistogram_t * pHistogram,
+                              uint32_t value );
+
+/**
+ * @brief Add the values of a histogram to another.
+ *
+ * @param[in,out] pDestination The histogram the values are added to.
+ * @param[in] pSource The histogram whose values are added.
+ */
+void LatencyHistogram_Add( LatencyHistogram_t * pDestination,
+                           const LatencyHistogram_t * pSource );
+
+/**
+ * @brief Get the value below or at which a percentage of the values are.
+ *
+ * @param[in] pHistogram The histogram.
+ * @param[in] percentile The percentage, from 0 to 100, such as 99.9.
+ *
+ * @return The largest value counted with the value at the percentile,
+ * at most #LatencyHistogram_t.max; 0 if the histogram has no value.
+ */
+uint32_t LatencyHistogram_Percentile( const LatencyHistogram_t * pHistogram,
+                                      double percentile );
+
+#endif /* ifndef LATENCY_HISTOGRAM_H_ */
@@ -0,0 +1,1285 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Load generator and latency benchmark of MQTT brokers and of this client.
+ *
+ * The benchmark opens a number of connections to a broker, over plaintext
+ * TCP or TLS, and drives each from its own thread. Each connection has a
+ * number of publishers, which publish to a topic of their own, either at a
+ * fixed rate or as fast as the connection allows. Each connection subscribes
+ * to the topics of its publishers, so every publish comes back to the
+ * connection that sent it, and the time it took is recorded in a histogram.
+ *
+ * The payload of a publish starts with the time it was due to be sent, so
+ * that at a fixed rate a publish delayed by the client counts the delay in
+ * its latency, rather than hiding it.
+ *
+ * Run the benchmark with --help for its options. For example, against a
+ * local Mosquitto broker:
+ * $ mqtt_bench -h localhost -n 8 -m 4 -q 1 -s 256 -r 100 -d 30
+ * And against AWS IoT, whose policy must allow the client identifiers and
+ * topics used:
+ * $ mqtt_bench -h abcdefg123.iot.us-east-1.amazonaws.com --cafile AmazonRootCA1.pem \
+ *   --certfile certificate.pem.crt --keyfile private.pem.key -n 4 -r 50
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/* Plaintext and OpenSSL sockets transport implementations. */
+#include "plaintext_posix.h"
+#include "openssl_posix.h"
+
+/* Histogram of the round-trip latencies. */
+#include "latency_histogram.h"
+
+/**
+ * @brief Port of the broker without TLS.
+ */
+#define DEFAULT_PLAINTEXT_PORT         ( 1883U )
+
+/**
+ * @brief Port of the broker with TLS, such as AWS IoT.
+ */
+#define DEFAULT_TLS_PORT               ( 8883U )
+
+/**
+ * @brief Default number of connections.
+ */
+#define DEFAULT_CONNECTION_COUNT       ( 1U )
+
+/**
+ * @brief Default number of publishers of each connection.
+ */
+#define DEFAULT_PUBLISHER_COUNT        ( 1U )
+
+/**
+ * @brief Default length of the payloads.
+ */
+#define DEFAULT_PAYLOAD_LENGTH         ( 64U )
+
+/**
+ * @brief Default length of the measurement, in seconds.
+ */
+#define DEFAULT_DURATION_SEC           ( 10U )
+
+/**
+ * @brief Default prefix of the client identifiers, followed by the index of
+ * the connection.
+ */
+#define DEFAULT_CLIENT_ID_PREFIX       "mqtt_bench"
+
+/**
+ * @brief Default first level of the topics.
+ */
+#define DEFAULT_TOPIC_PREFIX           "bench"
+
+/**
+ * @brief ALPN protocol name for AWS IoT MQTT, used on port 443.
+ */
+#define AWS_IOT_MQTT_ALPN              "\x0ex-amzn-mqtt-ca"
+
+/**
+ * @brief Length of #AWS_IOT_MQTT_ALPN.
+ */
+#define AWS_IOT_MQTT_ALPN_LENGTH       ( ( uint16_t ) ( sizeof( AWS_IOT_MQTT_ALPN ) - 1U ) )
+
+/**
+ * @brief Length of the header of the payloads: the time the publish was due,
+ * in nanoseconds, the index of the publisher and the sequence number of the
+ * publish.
+ */
+#define PAYLOAD_HEADER_LENGTH          ( 16U )
+
+/**
+ * @brief Largest length of the topics, the topic filters and the client
+ * identifiers.
+ */
+#define NAME_MAX_LENGTH                ( 128U )
+
+/**
+ * @brief Room of the network buffer for the topic and the header of a
+ * PUBLISH, besides its payload.
+ */
+#define NETWORK_BUFFER_OVERHEAD        ( NAME_MAX_LENGTH + 16U )
+
+/**
+ * @brief Size of the read-ahead buffer of the transports.
+ */
+#define READ_AHEAD_BUFFER_SIZE         ( 4096U )
+
+/**
+ * @brief Send and receive timeout of the transports.
+ */
+#define TRANSPORT_TIMEOUT_MS           ( 5000U )
+
+/**
+ * @brief Time to wait for the CONNACK and the SUBACK.
+ */
+#define ACK_TIMEOUT_MS                 ( 10000U )
+
+/**
+ * @brief Longest time spent receiving the publishes and PUBACKs still in
+ * flight once the measurement is over.
+ */
+#define DRAIN_TIMEOUT_MS               ( 5000U )
+
+/**
+ * @brief Keep-alive interval of the sessions.
+ */
+#define KEEP_ALIVE_INTERVAL_SECONDS    ( 60U )
+
+/**
+ * @brief Number of nanoseconds in a second.
+ */
+#define NANOSECONDS_PER_SECOND         ( 1000000000ULL )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. The benchmark
+ * uses both transports, whose parameters the context points to. */
+struct NetworkContext
+{
+    void * pParams;
+};
+
+/**
+ * @brief The options of a run.
+ */
+typedef struct BenchConfig
+{
+    const char * pHostName;         /**< @brief Host name of the broker. */
+    uint16_t port;                  /**< @brief Port of the broker; 0 for the default of the transport. */
+    const char * pRootCaPath;       /**< @brief Root CA certificate of the broker, which selects TLS; NULL for plaintext. */
+    const char * pClientCertPath;   /**< @brief Client certificate; NULL for none. */
+    const char * pPrivateKeyPath;   /**< @brief Private key of the client certificate; NULL for none. */
+    const char * pClientIdPrefix;   /**< @brief Prefix of the client identifiers. */
+    const char * pTopicPrefix;      /**< @brief First level of the topics. */
+    uint32_t connectionCount;       /**< @brief Number of connections. */
+    uint32_t publisherCount;        /**< @brief Number of publishers of each connection. */
+    MQTTQoS_t qos;                  /**< @brief QoS of the publishes and of the subscriptions. */
+    size_t payloadLength;           /**< @brief Length of the payloads, at least #PAYLOAD_HEADER_LENGTH. */
+    uint32_t publishRate;           /**< @brief Publishes per second of each publisher; 0 to publish as fast as possible. */
+    uint32_t durationSec;           /**< @brief Length of the measurement. */
+} BenchConfig_t;
+
+/**
+ * @brief A publisher of a connection.
+ */
+typedef struct BenchPublisher
+{
+    char topic[ NAME_MAX_LENGTH ]; /**< @brief Topic of the publishes. */
+    uint16_t topicLength;          /**< @brief Length of #BenchPublisher_t.topic. */
+    uint64_t nextPublishTimeNs;    /**< @brief Time the next publish is due. */
+    uint32_t sequence;             /**< @brief Sequence number of the next publish. */
+} BenchPublisher_t;
+
+/**
+ * @brief Counters of a connection, added up for the report.
+ */
+typedef struct BenchStats
+{
+    uint64_t publishesSent;        /**< @brief Publishes sent during the measurement. */
+    uint64_t bytesSent;            /**< @brief Payload bytes of #BenchStats_t.publishesSent. */
+    uint64_t publishesReceived;    /**< @brief Publishes received back. */
+    uint64_t bytesReceived;        /**< @brief Payload bytes of #BenchStats_t.publishesReceived. */
+    uint64_t pubacksReceived;      /**< @brief PUBACKs of the publishes sent with QoS1. */
+    uint64_t publishStalls;        /**< @brief Times the publishes waited because the in-flight QoS1 publishes were at the limit of the MQTT library. */
+    LatencyHistogram_t latencyUs;  /**< @brief Round-trip latencies of the publishes received back, in microseconds. */
+} BenchStats_t;
+
+/**
+ * @brief A connection and its publishers.
+ */
+typedef struct BenchConnection
+{
+    MQTTContext_t context;                         /**< @brief MQTT context of the connection. The event callback finds the connection from it, being its first member. */
+    NetworkContext_t networkContext;               /**< @brief Network context pointing to the parameters of the transport. */
+    PlaintextParams_t plaintextParams;             /**< @brief Plaintext transport, if no root CA is given. */
+    OpensslParams_t opensslParams;                 /**< @brief TLS transport, if a root CA is given. */
+    uint8_t readAheadBuffer[ READ_AHEAD_BUFFER_SIZE ]; /**< @brief Read-ahead buffer of the transport. */
+    uint8_t * pNetworkBuffer;                      /**< @brief Network buffer of the MQTT context. */
+    uint8_t * pPayload;                            /**< @brief Payload of the publishes, whose header is rewritten for each. */
+    BenchPublisher_t * pPublishers;                /**< @brief The publishers. */
+    char clientId[ NAME_MAX_LENGTH ];              /**< @brief Client identifier of the session. */
+    uint16_t clientIdLength;                       /**< @brief Length of #BenchConnection_t.clientId. */
+    char topicFilter[ NAME_MAX_LENGTH ];           /**< @brief Topic filter of the topics of the publishers. */
+    uint16_t topicFilterLength;                    /**< @brief Length of #BenchConnection_t.topicFilter. */
+    uint16_t subscribePacketId;                    /**< @brief Packet identifier of the SUBSCRIBE, cleared by its SUBACK. */
+    bool transportConnected;                       /**< @brief Whether the transport is connected. */
+    bool failed;                                   /**< @brief Whether the connection failed. */
+    pthread_t thread;                              /**< @brief Thread driving the connection. */
+    BenchStats_t stats;                            /**< @brief Counters of the connection. */
+} BenchConnection_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The options of the run.
+ */
+static BenchConfig_t benchConfig;
+
+/**
+ * @brief Barrier the threads of the connections wait at, so that the
+ * measurement starts when all of them are ready.
+ */
+static pthread_barrier_t startBarrier;
+
+/**
+ * @brief Time the measurement starts, set before #startBarrier is released.
+ */
+static uint64_t startTimeNs;
+
+/**
+ * @brief Time the measurement ends, set before #startBarrier is released.
+ */
+static uint64_t endTimeNs;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Describe program usage on stderr.
+ *
+ * @param[in] programName the value of argv[0]
+ */
+static void usage( const char * programName );
+
+/**
+ * @brief Populate the options from the command line arguments.
+ *
+ * @param[out] pConfig The options.
+ * @param[in] argc count of arguments
+ * @param[in] argv array of arguments
+ *
+ * @return true if the arguments are valid; false otherwise.
+ */
+static bool parseArgs( BenchConfig_t * pConfig,
+                       int argc,
+                       char * argv[] );
+
+/**
+ * @brief Parse an unsigned integer argument.
+ *
+ * @param[in] pArgument The argument.
+ * @param[in] minValue Smallest value allowed.
+ * @param[in] maxValue Largest value allowed.
+ * @param[out] pValue The value.
+ *
+ * @return true if the argument is a number within the bounds; false
+ * otherwise.
+ */
+static bool parseNumber( const char * pArgument,
+                         uint64_t minValue,
+                         uint64_t maxValue,
+                         uint64_t * pValue );
+
+/**
+ * @brief Get the time of the monotonic clock.
+ *
+ * @return The time in nanoseconds.
+ */
+static uint64_t getTimeNs( void );
+
+/**
+ * @brief Get the time of the monotonic clock for the MQTT library.
+ *
+ * @return The time in milliseconds.
+ */
+static uint32_t getTimeMs( void );
+
+/**
+ * @brief Connect the transport of a connection.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if the transport is connected; false otherwise.
+ */
+static bool connectTransport( BenchConnection_t * pConnection );
+
+/**
+ * @brief Check whether the transport holds received data which the socket
+ * no longer reports as readable.
+ *
+ * @param[in] pConnection The connection.
+ *
+ * @return true if data is buffered; false otherwise.
+ */
+static bool hasBufferedData( const BenchConnection_t * pConnection );
+
+/**
+ * @brief Establish the MQTT session of a connection and subscribe to the
+ * topics of its publishers.
+ *
+ * @param[in] pConnection The connection, whose transport is connected.
+ *
+ * @return true if the subscription is acknowledged; false otherwise.
+ */
+static bool establishSession( BenchConnection_t * pConnection );
+
+/**
+ * @brief Wait for the socket of a connection to be readable, then process
+ * the packets received.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] timeoutMs Longest time to wait.
+ *
+ * @return true if no processing failed; false otherwise.
+ */
+static bool receivePackets( BenchConnection_t * pConnection,
+                            uint32_t timeoutMs );
+
+/**
+ * @brief The event callback of the MQTT contexts.
+ *
+ * @param[in] pMqttContext MQTT context pointer.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Send the publishes that are due, at most one per publisher.
+ *
+ * The publishes stop at the first which the MQTT library has no room to
+ * track, until PUBACKs arrive.
+ *
+ * @param[in] pConnection The connection.
+ * @param[in] nowNs The current time.
+ * @param[out] pNextPublishTimeNs The time the next publish is due.
+ *
+ * @return true if no publish failed; false otherwise.
+ */
+static bool sendDuePublishes( BenchConnection_t * pConnection,
+                              uint64_t nowNs,
+                              uint64_t * pNextPublishTimeNs );
+
+/**
+ * @brief Drive a connection through the measurement, then receive the
+ * publishes and PUBACKs still in flight.
+ *
+ * @param[in] pArgument The connection.
+ *
+ * @return NULL.
+ */
+static void * runConnection( void * pArgument );
+
+/**
+ * @brief Print the counters and the latencies of all the connections.
+ *
+ * @param[in] pTotal The counters added up.
+ * @param[in] elapsedNs Length of the measurement.
+ */
+static void printReport( const BenchStats_t * pTotal,
+                         uint64_t elapsedNs );
+
+/*-----------------------------------------------------------*/
+
+static void usage( const char * programName )
+{
+    fprintf( stderr,
+             "\nThis benchmark measures the throughput and the round-trip latency of MQTT publishes.\n"
+             "Each connection subscribes to the topics of its publishers, and times every publish\n"
+             "from the time it was due until the broker delivers it back.\n"
+             "\nusage: %s -h host [-p port] [--cafile file [--certfile file --keyfile file]]\n"
+             "       [-n connections] [-m publishers] [-q qos] [-s bytes] [-r rate] [-d seconds]\n"
+             "       [--clientid prefix] [--topic prefix]\n"
+             "\n"
+             "-h, --host        : broker to connect to.\n"
+             "-p, --port        : port of the broker. Defaults to %u, or %u with --cafile.\n"
+             "--cafile          : root CA certificate of the broker, which enables TLS.\n"
+             "--certfile        : client certificate, for mutual authentication such as with AWS IoT.\n"
+             "--keyfile         : private key of the client certificate.\n",
+             programName,
+             ( unsigned int ) DEFAULT_PLAINTEXT_PORT,
+             ( unsigned int ) DEFAULT_TLS_PORT );
+    fprintf( stderr,
+             "-n, --connections : number of connections, each driven by a thread. Defaults to %u.\n"
+             "-m, --publishers  : number of publishers of each connection. Defaults to %u.\n"
+             "-q, --qos         : QoS of the publishes, 0 or 1. Defaults to 0.\n"
+             "-s, --size        : length of the payloads, at least %u bytes. Defaults to %u.\n"
+             "-r, --rate        : publishes per second of each publisher; 0 publishes as fast as\n"
+             "                    possible. Defaults to 0.\n"
+             "-d, --duration    : length of the measurement in seconds. Defaults to %u.\n"
+             "--clientid        : prefix of the client identifiers. Defaults to %s.\n"
+             "--topic           : first level of the topics. Defaults to %s.\n\n",
+             ( unsigned int ) DEFAULT_CONNECTION_COUNT,
+             ( unsigned int ) DEFAULT_PUBLISHER_COUNT,
+             ( unsigned int ) PAYLOAD_HEADER_LENGTH,
+             ( unsigned int ) DEFAULT_PAYLOAD_LENGTH,
+             ( unsigned int ) DEFAULT_DURATION_SEC,
+             DEFAULT_CLIENT_ID_PREFIX,
+             DEFAULT_TOPIC_PREFIX );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseNumber( const char * pArgument,
+                         uint64_t minValue,
+                         uint64_t maxValue,
+                         uint64_t * pValue )
+{
+    bool returnStatus = false;
+    char * pEnd = NULL;
+    unsigned long long value = strtoull( pArgument, &pEnd, 0 );
+
+    if( ( pEnd != pArgument ) && ( *pEnd == '\0' ) && ( pArgument[ 0 ] != '-' ) &&
+        ( value >= minValue ) && ( value <= maxValue ) )
+    {
+        *pValue = ( uint64_t ) value;
+        returnStatus = true;
+    }
+    else
+    {
+        LogError( ( "Bad value: %s.", pArgument ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseArgs( BenchConfig_t * pConfig,
+                       int argc,
+                       char * argv[] )
+{
+    bool returnStatus = true;
+    int option = 0;
+    uint64_t value = 0U;
+    static const struct option longOptions[] =
+    {
+        { "host",        required_argument, NULL, 'h' },
+        { "port",        required_argument, NULL, 'p' },
+        { "cafile",      required_argument, NULL, 'f' },
+        { "certfile",    required_argument, NULL, 'c' },
+        { "keyfile",     required_argument, NULL, 'k' },
+        { "connections", required_argument, NULL, 'n' },
+        { "publishers",  required_argument, NULL, 'm' },
+        { "qos",         required_argument, NULL, 'q' },
+        { "size",        required_argument, NULL, 's' },
+        { "rate",        required_argument, NULL, 'r' },
+        { "duration",    required_argument, NULL, 'd' },
+        { "clientid",    required_argument, NULL, 'i' },
+        { "topic",       required_argument, NULL, 't' },
+        { "help",        no_argument,       NULL, '?' },
+        { NULL,          0,                 NULL, 0   }
+    };
+
+    ( void ) memset( pConfig, 0x00, sizeof( BenchConfig_t ) );
+    pConfig->pClientIdPrefix = DEFAULT_CLIENT_ID_PREFIX;
+    pConfig->pTopicPrefix = DEFAULT_TOPIC_PREFIX;
+    pConfig->connectionCount = DEFAULT_CONNECTION_COUNT;
+    pConfig->publisherCount = DEFAULT_PUBLISHER_COUNT;
+    pConfig->qos = MQTTQoS0;
+    pConfig->payloadLength = DEFAULT_PAYLOAD_LENGTH;
+    pConfig->durationSec = DEFAULT_DURATION_SEC;
+
+    while( returnStatus == true )
+    {
+        option = getopt_long( argc, argv, "h:p:n:m:q:s:r:d:?", longOptions, NULL );
+
+        if( option == -1 )
+        {
+            break;
+        }
+
+        switch( option )
+        {
+            case 'h':
+                pConfig->pHostName = optarg;
+                break;
+
+            case 'p':
+                returnStatus = parseNumber( optarg, 1U, UINT16_MAX, &value );
+                pConfig->port = ( uint16_t ) value;
+                break;
+
+            case 'f':
+                pConfig->pRootCaPath = optarg;
+                break;
+
+            case 'c':
+                pConfig->pClientCertPath = optarg;
+                break;
+
+            case 'k':
+                pConfig->pPrivateKeyPath = optarg;
+                break;
+
+            case 'n':
+                returnStatus = parseNumber( optarg, 1U, 10000U, &value );
+                pConfig->connectionCount = ( uint32_t ) value;
+                break;
+
+            case 'm':
+                returnStatus = parseNumber( optarg, 1U, 10000U, &value );
+                pConfig->publisherCount = ( uint32_t ) value;
+                break;
+
+            case 'q':
+                returnStatus = parseNumber( optarg, 0U, 1U, &value );
+                pConfig->qos = ( value == 0U ) ? MQTTQoS0 : MQTTQoS1;
+                break;
+
+            case 's':
+                returnStatus = parseNumber( optarg, PAYLOAD_HEADER_LENGTH, 16777216U, &value );
+                pConfig->payloadLength = ( size_t ) value;
+                break;
+
+            case 'r':
+                returnStatus = parseNumber( optarg, 0U, 1000000U, &value );
+                pConfig->publishRate = ( uint32_t ) value;
+                break;
+
+            case 'd':
+                returnStatus = parseNumber( optarg, 1U, 86400U, &value );
+                pConfig->durationSec = ( uint32_t ) value;
+                break;
+
+            case 'i':
+                pConfig->pClientIdPrefix = optarg;
+                break;
+
+            case 't':
+                pConfig->pTopicPrefix = optarg;
+                break;
+
+            case '?':
+            default:
+                returnStatus = false;
+                break;
+        }
+    }
+
+    if( returnStatus == true )
+    {
+        if( ( optind < argc ) || ( pConfig->pHostName == NULL ) )
+        {
+            returnStatus = false;
+        }
+        else if( ( pConfig->pClientCertPath == NULL ) != ( pConfig->pPrivateKeyPath == NULL ) )
+        {
+            LogError( ( "--certfile and --keyfile go together." ) );
+            returnStatus = false;
+        }
+        else if( ( pConfig->pRootCaPath == NULL ) && ( pConfig->pClientCertPath != NULL ) )
+        {
+            LogError( ( "--certfile requires --cafile." ) );
+            returnStatus = false;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( returnStatus == false )
+    {
+        usage( argv[ 0 ] );
+    }
+    else if( pConfig->port == 0U )
+    {
+        pConfig->port = ( pConfig->pRootCaPath != NULL ) ? DEFAULT_TLS_PORT : DEFAULT_PLAINTEXT_PORT;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t getTimeNs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * NANOSECONDS_PER_SECOND ) + ( uint64_t ) now.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t getTimeMs( void )
+{
+    return ( uint32_t ) ( getTimeNs() / 1000000U );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool connectTransport( BenchConnection_t * pConnection )
+{
+    bool returnStatus = false;
+    ServerInfo_t serverInfo;
+    SocketOptions_t socketOptions;
+    OpensslCredentials_t opensslCredentials;
+
+    serverInfo.pHostName = benchConfig.pHostName;
+    serverInfo.hostNameLength = strlen( benchConfig.pHostName );
+    serverInfo.port = benchConfig.port;
+
+    /* Disable Nagle's algorithm so that the publishes and PUBACKs are not
+     * delayed, which would add to the latencies measured. */
+    ( void ) memset( &socketOptions, 0, sizeof( SocketOptions_t ) );
+    socketOptions.noDelay = true;
+    serverInfo.pSocketOptions = &socketOptions;
+
+    if( benchConfig.pRootCaPath == NULL )
+    {
+        pConnection->plaintextParams.pRecvBuffer = pConnection->readAheadBuffer;
+        pConnection->plaintextParams.recvBufferSize = READ_AHEAD_BUFFER_SIZE;
+        pConnection->networkContext.pParams = &( pConnection->plaintextParams );
+
+        returnStatus = ( Plaintext_Connect( &( pConnection->networkContext ),
+                                            &serverInfo,
+                                            TRANSPORT_TIMEOUT_MS,
+                                            TRANSPORT_TIMEOUT_MS ) == SOCKETS_SUCCESS );
+    }
+    else
+    {
+        ( void ) memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+        opensslCredentials.pRootCaPath = benchConfig.pRootCaPath;
+        opensslCredentials.pClientCertPath = benchConfig.pClientCertPath;
+        opensslCredentials.pPrivateKeyPath = benchConfig.pPrivateKeyPath;
+        opensslCredentials.sniHostName = benchConfig.pHostName;
+
+        /* The credential files are loaded once for all the connections. */
+        opensslCredentials.cacheSslContext = true;
+
+        if( benchConfig.port == 443U )
+        {
+            opensslCredentials.pAlpnProtos = AWS_IOT_MQTT_ALPN;
+            opensslCredentials.alpnProtosLen = AWS_IOT_MQTT_ALPN_LENGTH;
+        }
+
+        pConnection->opensslParams.pRecvBuffer = pConnection->readAheadBuffer;
+        pConnection->opensslParams.recvBufferSize = READ_AHEAD_BUFFER_SIZE;
+        pConnection->networkContext.pParams = &( pConnection->opensslParams );
+
+        returnStatus = ( Openssl_Connect( &( pConnection->networkContext ),
+                                          &serverInfo,
+                                          &opensslCredentials,
+                                          TRANSPORT_TIMEOUT_MS,
+                                          TRANSPORT_TIMEOUT_MS ) == OPENSSL_SUCCESS );
+    }
+
+    if( returnStatus == false )
+    {
+        LogError( ( "Connection %s failed to connect to %s:%u.",
+                    pConnection->clientId,
+                    benchConfig.pHostName,
+                    ( unsigned int ) benchConfig.port ) );
+    }
+
+    pConnection->transportConnected = returnStatus;
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool hasBufferedData( const BenchConnection_t * pConnection )
+{
+    bool buffered = false;
+
+    if( benchConfig.pRootCaPath == NULL )
+    {
+        buffered = ( pConnection->plaintextParams.recvBufferLength > 0U );
+    }
+    else if( pConnection->opensslParams.recvBufferLength > 0U )
+    {
+        buffered = true;
+    }
+    else if( ( pConnection->opensslParams.pSsl != NULL ) &&
+             ( SSL_pending( pConnection->opensslParams.pSsl ) > 0 ) )
+    {
+        buffered = true;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return buffered;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool establishSession( BenchConnection_t * pConnection )
+{
+    bool returnStatus = true;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    TransportInterface_t transport;
+    MQTTFixedBuffer_t networkBuffer;
+    MQTTConnectInfo_t connectInfo;
+    MQTTSubscribeInfo_t subscription;
+    bool sessionPresent = false;
+    uint32_t startTimeMs = 0U;
+
+    transport.pNetworkContext = &( pConnection->networkContext );
+
+    if( benchConfig.pRootCaPath == NULL )
+    {
+        transport.send = Plaintext_Send;
+        transport.recv = Plaintext_Recv;
+    }
+    else
+    {
+        transport.send = Openssl_Send;
+        transport.recv = Openssl_Recv;
+    }
+
+    networkBuffer.pBuffer = pConnection->pNetworkBuffer;
+    networkBuffer.size = benchConfig.payloadLength + NETWORK_BUFFER_OVERHEAD;
+
+    mqttStatus = MQTT_Init( &( pConnection->context ), &transport, getTimeMs, eventCallback, &networkBuffer );
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        /* A clean session, so that no publish of an earlier run comes back. */
+        ( void ) memset( &connectInfo, 0x00, sizeof( MQTTConnectInfo_t ) );
+        connectInfo.cleanSession = true;
+        connectInfo.pClientIdentifier = pConnection->clientId;
+        connectInfo.clientIdentifierLength = pConnection->clientIdLength;
+        connectInfo.keepAliveSeconds = KEEP_ALIVE_INTERVAL_SECONDS;
+
+        mqttStatus = MQTT_Connect( &( pConnection->context ), &connectInfo, NULL, ACK_TIMEOUT_MS, &sessionPresent );
+    }
+
+    if( mqttStatus == MQTTSuccess )
+    {
+        subscription.qos = benchConfig.qos;
+        subscription.pTopicFilter = pConnection->topicFilter;
+        subscription.topicFilterLength = pConnection->topicFilterLength;
+        pConnection->subscribePacketId = MQTT_GetPacketId( &( pConnection->context ) );
+
+        mqttStatus = MQTT_Subscribe( &( pConnection->context ), &subscription, 1U, pConnection->subscribePacketId );
+    }
+
+    if( mqttStatus != MQTTSuccess )
+    {
+        LogError( ( "Connection %s failed to establish its session: %s.",
+                    pConnection->clientId,
+                    MQTT_Status_strerror( mqttStatus ) ) );
+        returnStatus = false;
+    }
+    else
+    {
+        startTimeMs = getTimeMs();
+
+        while( ( returnStatus == true ) && ( pConnection->subscribePacketId != 0U ) &&
+               ( ( getTimeMs() - startTimeMs ) < ACK_TIMEOUT_MS ) )
+        {
+            returnStatus = receivePackets( pConnection, 100U );
+        }
+
+        if( pConnection->subscribePacketId != 0U )
+        {
+            LogError( ( "Connection %s received no SUBACK.", pConnection->clientId ) );
+            returnStatus = false;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool receivePackets( BenchConnection_t * pConnection,
+                            uint32_t timeoutMs )
+{
+    bool returnStatus = true;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    struct pollfd pollDescriptor;
+    int pollStatus = 1;
+
+    pollDescriptor.fd = ( benchConfig.pRootCaPath == NULL ) ?
+                        pConnection->plaintextParams.socketDescriptor :
+                        pConnection->opensslParams.socketDescriptor;
+    pollDescriptor.events = POLLIN;
+    pollDescriptor.revents = 0;
+
+    /* The data already buffered does not make the socket readable. */
+    if( hasBufferedData( pConnection ) == false )
+    {
+        pollStatus = poll( &pollDescriptor, 1, ( int ) timeoutMs );
+    }
+
+    if( pollStatus < 0 )
+    {
+        LogError( ( "Connection %s failed to poll its socket.", pConnection->clientId ) );
+        returnStatus = false;
+    }
+    else if( pollStatus > 0 )
+    {
+        /* A timeout of 0 receives at most one packet, so the packets of the
+         * read-ahead buffer are processed one by one. */
+        do
+        {
+            mqttStatus = MQTT_ProcessLoop( &( pConnection->context ), 0U );
+        } while( ( mqttStatus == MQTTSuccess ) && ( hasBufferedData( pConnection ) == true ) );
+
+        if( mqttStatus != MQTTSuccess )
+        {
+            LogError( ( "Connection %s failed to receive: %s.",
+                        pConnection->clientId,
+                        MQTT_Status_strerror( mqttStatus ) ) );
+            returnStatus = false;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    /* The MQTT context is the first member of its connection. */
+    BenchConnection_t * pConnection = ( BenchConnection_t * ) pMqttContext;
+    const MQTTPublishInfo_t * pPublishInfo = pDeserializedInfo->pPublishInfo;
+    uint64_t dueTimeNs = 0U;
+    uint64_t latencyUs = 0U;
+
+    if( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+    {
+        if( pPublishInfo->payloadLength >= PAYLOAD_HEADER_LENGTH )
+        {
+            ( void ) memcpy( &dueTimeNs, pPublishInfo->pPayload, sizeof( dueTimeNs ) );
+            latencyUs = ( getTimeNs() - dueTimeNs ) / 1000U;
+
+            LatencyHistogram_Record( &( pConnection->stats.latencyUs ),
+                                     ( latencyUs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) latencyUs );
+            pConnection->stats.publishesReceived++;
+            pConnection->stats.bytesReceived += pPublishInfo->payloadLength;
+        }
+    }
+    else if( pPacketInfo->type == MQTT_PACKET_TYPE_PUBACK )
+    {
+        pConnection->stats.pubacksReceived++;
+    }
+    else if( pPacketInfo->type == MQTT_PACKET_TYPE_SUBACK )
+    {
+        if( pDeserializedInfo->packetIdentifier == pConnection->subscribePacketId )
+        {
+            pConnection->subscribePacketId = 0U;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendDuePublishes( BenchConnection_t * pConnection,
+                              uint64_t nowNs,
+                              uint64_t * pNextPublishTimeNs )
+{
+    bool returnStatus = true;
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    MQTTPublishInfo_t publishInfo;
+    BenchPublisher_t * pPublisher = NULL;
+    uint64_t dueTimeNs = 0U;
+    uint32_t publisherIndex = 0U;
+    uint16_t packetId = 0U;
+    bool stalled = false;
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( MQTTPublishInfo_t ) );
+    publishInfo.qos = benchConfig.qos;
+    publishInfo.pPayload = pConnection->pPayload;
+    publishInfo.payloadLength = benchConfig.payloadLength;
+    *pNextPublishTimeNs = UINT64_MAX;
+
+    for( publisherIndex = 0U; ( publisherIndex < benchConfig.publisherCount ) && ( returnStatus == true ); publisherIndex++ )
+    {
+        pPublisher = &( pConnection->pPublishers[ publisherIndex ] );
+
+        if( ( pPublisher->nextPublishTimeNs <= nowNs ) && ( stalled == false ) )
+        {
+            /* At a fixed rate the latency counts from the time the publish
+             * was due, so that the delays of the client are measured too. */
+            dueTimeNs = ( benchConfig.publishRate == 0U ) ? getTimeNs() : pPublisher->nextPublishTimeNs;
+            ( void ) memcpy( &( pConnection->pPayload[ 0 ] ), &dueTimeNs, sizeof( dueTimeNs ) );
+            ( void ) memcpy( &( pConnection->pPayload[ 8 ] ), &publisherIndex, sizeof( publisherIndex ) );
+            ( void ) memcpy( &( pConnection->pPayload[ 12 ] ), &( pPublisher->sequence ), sizeof( pPublisher->sequence ) );
+
+            publishInfo.pTopicName = pPublisher->topic;
+            publishInfo.topicNameLength = pPublisher->topicLength;
+            packetId = ( benchConfig.qos == MQTTQoS0 ) ? 0U : MQTT_GetPacketId( &( pConnection->context ) );
+
+            mqttStatus = MQTT_Publish( &( pConnection->context ), &publishInfo, packetId );
+
+            if( mqttStatus == MQTTSuccess )
+            {
+                pConnection->stats.publishesSent++;
+                pConnection->stats.bytesSent += benchConfig.payloadLength;
+                pPublisher->sequence++;
+
+                if( benchConfig.publishRate != 0U )
+                {
+                    pPublisher->nextPublishTimeNs += NANOSECONDS_PER_SECOND / benchConfig.publishRate;
+                }
+            }
+            else if( mqttStatus == MQTTNoMemory )
+            {
+                /* The MQTT library tracks no more QoS1 publishes in flight,
+                 * so the publishes wait for PUBACKs. */
+                pConnection->stats.publishStalls++;
+                stalled = true;
+            }
+            else
+            {
+                LogError( ( "Connection %s failed to publish: %s.",
+                            pConnection->clientId,
+                            MQTT_Status_strerror( mqttStatus ) ) );
+                returnStatus = false;
+            }
+        }
+
+        if( pPublisher->nextPublishTimeNs < *pNextPublishTimeNs )
+        {
+            *pNextPublishTimeNs = pPublisher->nextPublishTimeNs;
+        }
+    }
+
+    /* No publish is sent until a PUBACK arrives, which ends the wait for
+     * packets. */
+    if( stalled == true )
+    {
+        *pNextPublishTimeNs = UINT64_MAX;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * runConnection( void * pArgument )
+{
+    BenchConnection_t * pConnection = ( BenchConnection_t * ) pArgument;
+    bool success = true;
+    uint64_t nowNs = 0U;
+    uint64_t nextPublishTimeNs = 0U;
+    uint64_t waitNs = 0U;
+    uint64_t drainEndNs = 0U;
+    uint32_t publisherIndex = 0U;
+    bool inFlight = true;
+
+    ( void ) pthread_barrier_wait( &startBarrier );
+
+    /* The publishers of a connection are spread over the interval between
+     * two publishes, rather than all publishing at once. */
+    for( publisherIndex = 0U; publisherIndex < benchConfig.publisherCount; publisherIndex++ )
+    {
+        pConnection->pPublishers[ publisherIndex ].nextPublishTimeNs = startTimeNs;
+
+        if( benchConfig.publishRate != 0U )
+        {
+            pConnection->pPublishers[ publisherIndex ].nextPublishTimeNs +=
+                ( ( NANOSECONDS_PER_SECOND / benchConfig.publishRate ) * publisherIndex ) / benchConfig.publisherCount;
+        }
+    }
+
+    nowNs = getTimeNs();
+
+    while( ( success == true ) && ( nowNs < endTimeNs ) )
+    {
+        success = sendDuePublishes( pConnection, nowNs, &nextPublishTimeNs );
+
+        /* Wait for packets until the next publish is due, rounded up to a
+         * millisecond. */
+        nowNs = getTimeNs();
+        waitNs = 0U;
+
+        if( nextPublishTimeNs > nowNs )
+        {
+            waitNs = ( ( nextPublishTimeNs < endTimeNs ) ? nextPublishTimeNs : endTimeNs ) - nowNs;
+        }
+
+        if( success == true )
+        {
+            success = receivePackets( pConnection, ( uint32_t ) ( ( waitNs + 999999U ) / 1000000U ) );
+        }
+
+        nowNs = getTimeNs();
+    }
+
+    /* Receive the publishes and the PUBACKs still in flight. QoS0 publishes
+     * may be dropped, so the wait is bounded. */
+    drainEndNs = nowNs + ( ( uint64_t ) DRAIN_TIMEOUT_MS * 1000000U );
+
+    while( ( success == true ) && ( inFlight == true ) && ( nowNs < drainEndNs ) )
+    {
+        success = receivePackets( pConnection, 10U );
+        inFlight = ( pConnection->stats.publishesReceived < pConnection->stats.publishesSent ) ||
+                   ( ( benchConfig.qos == MQTTQoS1 ) &&
+                     ( pConnection->stats.pubacksReceived < pConnection->stats.publishesSent ) );
+        nowNs = getTimeNs();
+    }
+
+    pConnection->failed = ( success == false );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void printReport( const BenchStats_t * pTotal,
+                         uint64_t elapsedNs )
+{
+    double elapsedSec = ( double ) elapsedNs / ( double ) NANOSECONDS_PER_SECOND;
+    const LatencyHistogram_t * pLatency = &( pTotal->latencyUs );
+
+    printf( "\nBroker %s:%u over %s, %u connections with %u publishers each, QoS %d, %lu byte payloads, ",
+            benchConfig.pHostName,
+            ( unsigned int ) benchConfig.port,
+            ( benchConfig.pRootCaPath == NULL ) ? "TCP" : "TLS",
+            ( unsigned int ) benchConfig.connectionCount,
+            ( unsigned int ) benchConfig.publisherCount,
+            ( int ) benchConfig.qos,
+            ( unsigned long ) benchConfig.payloadLength );
+
+    if( benchConfig.publishRate == 0U )
+    {
+        printf( "as fast as possible for %.1f s.\n", elapsedSec );
+    }
+    else
+    {
+        printf( "%u publishes/s per publisher for %.1f s.\n", ( unsigned int ) benchConfig.publishRate, elapsedSec );
+    }
+
+    printf( "Sent:     %" PRIu64 " publishes, %.1f msgs/s, %.1f bytes/s.\n",
+            pTotal->publishesSent,
+            ( double ) pTotal->publishesSent / elapsedSec,
+            ( double ) pTotal->bytesSent / elapsedSec );
+    printf( "Received: %" PRIu64 " publishes, %.1f msgs/s, %.1f bytes/s, %" PRIu64 " lost.\n",
+            pTotal->publishesReceived,
+            ( double ) pTotal->publishesReceived / elapsedSec,
+            ( double ) pTotal->bytesReceived / elapsedSec,
+            ( pTotal->publishesSent > pTotal->publishesReceived ) ? ( pTotal->publishesSent - pTotal->publishesReceived ) : 0U );
+
+    if( benchConfig.qos == MQTTQoS1 )
+    {
+        printf( "PUBACKs:  %" PRIu64 " received, %" PRIu64 " stalls on the in-flight limit.\n",
+                pTotal->pubacksReceived,
+                pTotal->publishStalls );
+    }
+
+    if( pLatency->count > 0U )
+    {
+        printf( "Round-trip latency (us): min %u, p50 %u, p90 %u, p99 %u, p99.9 %u, max %u, mean %.1f.\n",
+                ( unsigned int ) pLatency->min,
+                ( unsigned int ) LatencyHistogram_Percentile( pLatency, 50.0 ),
+                ( unsigned int ) LatencyHistogram_Percentile( pLatency, 90.0 ),
+                ( unsigned int ) LatencyHistogram_Percentile( pLatency, 99.0 ),
+                ( unsigned int ) LatencyHistogram_Percentile( pLatency, 99.9 ),
+                ( unsigned int ) pLatency->max,
+                ( double ) pLatency->sum / ( double ) pLatency->count );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char * argv[] )
+{
+    int returnStatus = EXIT_SUCCESS;
+    BenchConnection_t * pConnections = NULL;
+    BenchConnection_t * pConnection = NULL;
+    static BenchStats_t total;
+    uint32_t connectionIndex = 0U;
+    uint32_t publisherIndex = 0U;
+    uint32_t threadCount = 0U;
+    uint64_t finishTimeNs = 0U;
+
+    if( parseArgs( &benchConfig, argc, argv ) == false )
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        pConnections = calloc( benchConfig.connectionCount, sizeof( BenchConnection_t ) );
+
+        if( pConnections == NULL )
+        {
+            LogError( ( "Failed to allocate %u connections.", ( unsigned int ) benchConfig.connectionCount ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    /* The connections are established one after the other before the
+     * measurement, so that it only measures the publishes. */
+    for( connectionIndex = 0U; ( returnStatus == EXIT_SUCCESS ) && ( connectionIndex < benchConfig.connectionCount ); connectionIndex++ )
+    {
+        pConnection = &pConnections[ connectionIndex ];
+        LatencyHistogram_Init( &( pConnection->stats.latencyUs ) );
+        pConnection->clientIdLength = ( uint16_t ) snprintf( pConnection->clientId, NAME_MAX_LENGTH, "%s%u",
+                                                             benchConfig.pClientIdPrefix, ( unsigned int ) connectionIndex );
+        pConnection->topicFilterLength = ( uint16_t ) snprintf( pConnection->topicFilter, NAME_MAX_LENGTH, "%s/%s/+",
+                                                                benchConfig.pTopicPrefix, pConnection->clientId );
+        pConnection->pNetworkBuffer = malloc( benchConfig.payloadLength + NETWORK_BUFFER_OVERHEAD );
+        pConnection->pPayload = malloc( benchConfig.payloadLength );
+        pConnection->pPublishers = calloc( benchConfig.publisherCount, sizeof( BenchPublisher_t ) );
+
+        if( ( pConnection->pNetworkBuffer == NULL ) || ( pConnection->pPayload == NULL ) || ( pConnection->pPublishers == NULL ) ||
+            ( pConnection->topicFilterLength >= ( NAME_MAX_LENGTH - 12U ) ) )
+        {
+            LogError( ( "Failed to set up connection %u.", ( unsigned int ) connectionIndex ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            ( void ) memset( pConnection->pPayload, 'x', benchConfig.payloadLength );
+
+            for( publisherIndex = 0U; publisherIndex < benchConfig.publisherCount; publisherIndex++ )
+            {
+                pConnection->pPublishers[ publisherIndex ].topicLength =
+                    ( uint16_t ) snprintf( pConnection->pPublishers[ publisherIndex ].topic, NAME_MAX_LENGTH, "%s/%s/%u",
+                                           benchConfig.pTopicPrefix, pConnection->clientId, ( unsigned int ) publisherIndex );
+            }
+
+            if( ( connectTransport( pConnection ) == false ) || ( establishSession( pConnection ) == false ) )
+            {
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        LogInfo( ( "%u connections established, measuring for %u s.",
+                   ( unsigned int ) benchConfig.connectionCount,
+                   ( unsigned int ) benchConfig.durationSec ) );
+
+        if( pthread_barrier_init( &startBarrier, NULL, benchConfig.connectionCount + 1U ) != 0 )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        for( threadCount = 0U; ( threadCount < benchConfig.connectionCount ) && ( returnStatus == EXIT_SUCCESS ); threadCount++ )
+        {
+            if( pthread_create( &( pConnections[ threadCount ].thread ), NULL, runConnection, &pConnections[ threadCount ] ) != 0 )
+            {
+                LogError( ( "Failed to create the thread of connection %u.", ( unsigned int ) threadCount ) );
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+
+        /* The threads created wait at the barrier until it is released, so
+         * the run is cancelled by exiting. */
+        if( returnStatus == EXIT_FAILURE )
+        {
+            exit( EXIT_FAILURE );
+        }
+
+        startTimeNs = getTimeNs();
+        endTimeNs = startTimeNs + ( ( uint64_t ) benchConfig.durationSec * NANOSECONDS_PER_SECOND );
+        ( void ) pthread_barrier_wait( &startBarrier );
+
+        for( connectionIndex = 0U; connectionIndex < threadCount; connectionIndex++ )
+        {
+            ( void ) pthread_join( pConnections[ connectionIndex ].thread, NULL );
+        }
+
+        finishTimeNs = getTimeNs();
+        ( void ) pthread_barrier_destroy( &startBarrier );
+
+        LatencyHistogram_Init( &( total.latencyUs ) );
+
+        for( connectionIndex = 0U; connectionIndex < benchConfig.connectionCount; connectionIndex++ )
+        {
+            pConnection = &pConnections[ connectionIndex ];
+            total.publishesSent += pConnection->stats.publishesSent;
+            total.bytesSent += pConnection->stats.bytesSent;
+            total.publishesReceived += pConnection->stats.publishesReceived;
+            total.bytesReceived += pConnection->stats.bytesReceived;
+            total.pubacksReceived += pConnection->stats.pubacksReceived;
+            total.publishStalls += pConnection->stats.publishStalls;
+            LatencyHistogram_Add( &( total.latencyUs ), &( pConnection->stats.latencyUs ) );
+
+            if( pConnection->failed == true )
+            {
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+
+        printReport( &total, ( ( finishTimeNs < endTimeNs ) ? finishTimeNs : endTimeNs ) - startTimeNs );
+    }
+
+    for( connectionIndex = 0U; ( pConnections != NULL ) && ( connectionIndex < benchConfig.connectionCount ); connectionIndex++ )
+    {
+        pConnection = &pConnections[ connectionIndex ];
+
+        if( pConnection->transportConnected == true )
+        {
+            ( void ) MQTT_Disconnect( &( pConnection->context ) );
+
+            if( benchConfig.pRootCaPath == NULL )
+            {
+                ( void ) Plaintext_Disconnect( &( pConnection->networkContext ) );
+            }
+            else
+            {
+                ( void ) Openssl_Disconnect( &( pConnection->networkContext ) );
+            }
+        }
+
+        free( pConnection->pNetworkBuffer );
+        free( pConnection->pPayload );
+        free( pConnection->pPublishers );
+    }
+
+    free( pConnections );
+
+    return returnStatus;
+}
@@ -59,6 +59,9 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /**
  * These configuration settings are required to run the basic TLS demo.
  * Throw compilation error if the below configs are not defined.
@@ -447,7 +450,7 @@ static int handleResubscribe( MQTTContext_t * pMqttContext );
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
 }
 
 /*-----------------------------------------------------------*/
@@ -465,6 +468,7 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     serverInfo.pHostName = BROKER_ENDPOINT;
     serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
     serverInfo.port = BROKER_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Initialize credentials for establishing TLS session. */
     memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
@@ -1379,7 +1383,6 @@ int main( int argc,
     NetworkContext_t networkContext = { 0 };
     OpensslParams_t opensslParams = { 0 };
     bool clientSessionPresent = false;
-    struct timespec tp;
 
     ( void ) argc;
     ( void ) argv;
@@ -1387,14 +1390,6 @@ int main( int argc,
     /* Set the pParams member of the network context with desired transport. */
     networkContext.pParams = &opensslParams;
 
-    /* Seed pseudo random number generator (provided by ISO C standard library) for
-     * use by retry utils library when retrying failed network operations. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
-
     /* Initialize MQTT library. Initialization of the MQTT library needs to be
      * done only once in this demo. */
     returnStatus = initializeMqtt( &mqttContext, &networkContext );
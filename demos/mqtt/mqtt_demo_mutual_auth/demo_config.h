@@ -161,6 +161,13 @@
  */
 #define NETWORK_BUFFER_SIZE       ( 1024U )
 
+/**
+ * @brief Size of the read-ahead buffer of the TLS transport.
+ *
+ * Small reads made by the MQTT library are served from this buffer.
+ */
+#define TRANSPORT_READ_AHEAD_BUFFER_SIZE    ( 512U )
+
 /**
  * @brief The name of the operating system that the application is running on.
  * The current value is given as an example. Please update for your specific
@@ -75,6 +75,9 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /**
  * These configuration settings are required to run the mutual auth demo.
  * Throw compilation error if the below configs are not defined.
@@ -124,6 +127,10 @@
     #define NETWORK_BUFFER_SIZE    ( 1024U )
 #endif
 
+#ifndef TRANSPORT_READ_AHEAD_BUFFER_SIZE
+    #define TRANSPORT_READ_AHEAD_BUFFER_SIZE    ( 512U )
+#endif
+
 #ifndef OS_NAME
     #define OS_NAME    "Ubuntu"
 #endif
@@ -339,6 +346,15 @@ static MQTTSubscribeInfo_t pGlobalSubscriptionList[ 1 ];
  */
 static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
+/**
+ * @brief Read-ahead buffer of the TLS transport.
+ *
+ * The MQTT library reads the header of each incoming packet one byte at a
+ * time. With this buffer, those reads are served from memory instead of
+ * each needing a separate SSL_read.
+ */
+static uint8_t transportReadAheadBuffer[ TRANSPORT_READ_AHEAD_BUFFER_SIZE ];
+
 /**
  * @brief Status of latest Subscribe ACK;
  * it is updated every time the callback function processes a Subscribe ACK
@@ -549,7 +565,7 @@ static int handleResubscribe( MQTTContext_t * pMqttContext );
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
 }
 
 /*-----------------------------------------------------------*/
@@ -560,6 +576,7 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     OpensslStatus_t opensslStatus = OPENSSL_SUCCESS;
     BackoffAlgorithmContext_t reconnectParams;
     ServerInfo_t serverInfo;
+    SocketOptions_t socketOptions;
     OpensslCredentials_t opensslCredentials;
     uint16_t nextRetryBackOff;
 
@@ -568,6 +585,12 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     serverInfo.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
     serverInfo.port = AWS_MQTT_PORT;
 
+    /* Disable Nagle's algorithm so that small MQTT packets such as PINGREQ
+     * and PUBACK are not delayed. */
+    memset( &socketOptions, 0, sizeof( SocketOptions_t ) );
+    socketOptions.noDelay = true;
+    serverInfo.pSocketOptions = &socketOptions;
+
     /* Initialize credentials for establishing TLS session. */
     memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
     opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
@@ -586,6 +609,14 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
      * https://docs.aws.amazon.com/iot/latest/developerguide/transport-security.html */
     opensslCredentials.sniHostName = AWS_IOT_ENDPOINT;
 
+    /* Load and parse the credential files only once. Connection retries and
+     * later reconnects of this demo reuse the cached SSL context. */
+    opensslCredentials.cacheSslContext = true;
+
+    /* Resume the TLS session of the previous connection to the broker, which
+     * avoids a full handshake on reconnects. */
+    opensslCredentials.cacheSession = true;
+
     if( AWS_MQTT_PORT == 443 )
     {
         /* Pass the ALPN protocol name depending on the port being used.
@@ -652,6 +683,12 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
         }
     } while( ( opensslStatus != OPENSSL_SUCCESS ) && ( backoffAlgStatus == BackoffAlgorithmSuccess ) );
 
+    /* Drop the cached SSL context when the broker could not be reached. */
+    if( returnStatus == EXIT_FAILURE )
+    {
+        ( void ) Openssl_ReleaseCredentials( &opensslCredentials );
+    }
+
     return returnStatus;
 }
 
@@ -1519,7 +1556,6 @@ int main( int argc,
     NetworkContext_t networkContext = { 0 };
     OpensslParams_t opensslParams = { 0 };
     bool clientSessionPresent = false;
-    struct timespec tp;
 
     ( void ) argc;
     ( void ) argv;
@@ -1527,13 +1563,9 @@ int main( int argc,
     /* Set the pParams member of the network context with desired transport. */
     networkContext.pParams = &opensslParams;
 
-    /* Seed pseudo random number generator (provided by ISO C standard library) for
-     * use by retry utils library when retrying failed network operations. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
+    /* Coalesce the small reads made by the MQTT library. */
+    opensslParams.pRecvBuffer = transportReadAheadBuffer;
+    opensslParams.recvBufferSize = TRANSPORT_READ_AHEAD_BUFFER_SIZE;
 
     /* Initialize MQTT library. Initialization of the MQTT library needs to be
      * done only once in this demo. */
@@ -56,6 +56,9 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /**
  * These configuration settings are required to run the plaintext demo.
  * Throw compilation error if the below configs are not defined.
@@ -341,7 +344,7 @@ static int handleResubscribe( MQTTContext_t * pMqttContext );
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
 }
 
 /*-----------------------------------------------------------*/
@@ -358,6 +361,7 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     serverInfo.pHostName = BROKER_ENDPOINT;
     serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
     serverInfo.port = BROKER_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Initialize reconnect attempts and interval */
     BackoffAlgorithm_InitializeParams( &reconnectParams,
@@ -1026,7 +1030,6 @@ int main( int argc,
     int returnStatus = EXIT_SUCCESS;
     NetworkContext_t networkContext = { 0 };
     PlaintextParams_t plaintextParams = { 0 };
-    struct timespec tp;
 
     ( void ) argc;
     ( void ) argv;
@@ -1034,15 +1037,6 @@ int main( int argc,
     /* Set the pParams member of the network context with desired transport. */
     networkContext.pParams = &plaintextParams;
 
-    /* Seed pseudo random number generator used in the demo for
-     * backoff period calculation when retrying failed network operations
-     * with broker. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
-
     for( ; ; )
     {
         /* Attempt to connect to the MQTT broker. If connection fails, retry after
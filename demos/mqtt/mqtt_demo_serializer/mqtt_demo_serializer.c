@@ -52,6 +52,9 @@
 /* MQTT Serializer Serializer API header. */
 #include "core_mqtt_serializer.h"
 
+/* Publishes prepared once for a topic. */
+#include "prepared_publish.h"
+
 /* Plaintext transport implementation. */
 #include "plaintext_posix.h"
 
@@ -61,6 +64,9 @@
 /*Include clock header for millisecond sleep function. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /* Check that the broker endpoint is defined. */
 #ifndef BROKER_ENDPOINT
     #error "Please define an MQTT broker endpoint, BROKER_ENDPOINT, in demo_config.h."
@@ -196,12 +202,12 @@ static void mqttSubscribeToTopic( NetworkContext_t * pNetworkContext,
  * @brief  Publishes a message MQTT_EXAMPLE_MESSAGE on MQTT_EXAMPLE_TOPIC topic.
  *
  * @param[in] pNetworkContext Pointer to the network context created using Plaintext_Connect.
- * @param[in] pFixedBuffer Pointer to a structure containing fixed buffer and its length.
- * The buffer is used for serializing PUBLISH packet.
+ * @param[in] pPrepared The publish prepared for MQTT_EXAMPLE_TOPIC, whose
+ * header is patched for the message.
  *
  */
 static void mqttPublishToTopic( NetworkContext_t * pNetworkContext,
-                                MQTTFixedBuffer_t * pFixedBuffer );
+                                const PreparedPublish_t * pPrepared );
 
 /**
  * @brief Unsubscribes from the previously subscribed topic as specified
@@ -318,6 +324,17 @@ static uint16_t subscribePacketIdentifier;
  */
 static uint16_t unsubscribePacketIdentifier;
 
+/**
+ * @brief Buffer of the PUBLISH header prepared for MQTT_EXAMPLE_TOPIC.
+ */
+static uint8_t examplePublishTemplate[ PREPARED_PUBLISH_BUFFER_SIZE( MQTT_EXAMPLE_TOPIC_LENGTH ) ];
+
+/**
+ * @brief The publish prepared for MQTT_EXAMPLE_TOPIC; the fixed header and
+ * topic are serialized once, and not for every message.
+ */
+static PreparedPublish_t examplePublish;
+
 /**
  * @brief Status of latest Subscribe ACK;
  * it is updated every time a Subscribe ACK is processed.
@@ -346,7 +363,7 @@ static uint16_t getNextPacketIdentifier( void )
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
 }
 
 /*-----------------------------------------------------------*/
@@ -358,21 +375,12 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     BackoffAlgorithmContext_t reconnectParams;
     ServerInfo_t serverInfo;
     uint16_t nextRetryBackOff = 0U;
-    struct timespec tp;
 
     /* Initialize information to connect to the MQTT broker. */
     serverInfo.pHostName = BROKER_ENDPOINT;
     serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
     serverInfo.port = BROKER_PORT;
-
-    /* Seed pseudo random number generator used in the demo for
-     * backoff period calculation when retrying failed network operations
-     * with broker. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
+    serverInfo.pSocketOptions = NULL;
 
     /* Initialize reconnect attempts and interval */
     BackoffAlgorithm_InitializeParams( &reconnectParams,
@@ -575,13 +583,12 @@ static void mqttSubscribeToTopic( NetworkContext_t * pNetworkContext,
 /*-----------------------------------------------------------*/
 
 static void mqttPublishToTopic( NetworkContext_t * pNetworkContext,
-                                MQTTFixedBuffer_t * pFixedBuffer )
+                                const PreparedPublish_t * pPrepared )
 {
     MQTTStatus_t result;
-    MQTTPublishInfo_t mqttPublishInfo;
-    size_t remainingLength;
-    size_t packetSize = 0;
+    const uint8_t * pHeader = NULL;
     size_t headerSize = 0;
+    struct iovec ioVec[ 2 ];
     int status;
 
     /* Suppress unused variable warnings when asserts are disabled in build. */
@@ -593,41 +600,25 @@ static void mqttPublishToTopic( NetworkContext_t * pNetworkContext,
      * asserts().
      ***/
 
-    /* Some fields not used by this demo so start with everything as 0. */
-    memset( ( void * ) &mqttPublishInfo, 0x00, sizeof( mqttPublishInfo ) );
-
-    /* This demo uses QOS0 */
-    mqttPublishInfo.qos = MQTTQoS0;
-    mqttPublishInfo.retain = false;
-    mqttPublishInfo.pTopicName = MQTT_EXAMPLE_TOPIC;
-    mqttPublishInfo.topicNameLength = ( uint16_t ) strlen( MQTT_EXAMPLE_TOPIC );
-    mqttPublishInfo.pPayload = MQTT_EXAMPLE_MESSAGE;
-    mqttPublishInfo.payloadLength = strlen( MQTT_EXAMPLE_MESSAGE );
-
-    /* Find out length of Publish packet size. */
-    result = MQTT_GetPublishPacketSize( &mqttPublishInfo, &remainingLength, &packetSize );
-    assert( result == MQTTSuccess );
-
-    /* Make sure the packet size is less than static buffer size. */
-    assert( packetSize < pFixedBuffer->size );
-
-    /* Serialize MQTT Publish packet header. The publish message payload will
-     * be sent directly in order to avoid copying it into the buffer.
+    /* The fixed header and topic were serialized once by PreparedPublish_Init;
+     * only the remaining length is patched for the length of the message.
      * QOS0 does not make use of packet identifier, therefore value of 0 is used */
-    result = MQTT_SerializePublishHeader( &mqttPublishInfo,
-                                          0,
-                                          remainingLength,
-                                          pFixedBuffer,
-                                          &headerSize );
-    LogDebug( ( "Serialized PUBLISH header size is %lu.",
+    result = PreparedPublish_GetHeader( pPrepared,
+                                        0,
+                                        strlen( MQTT_EXAMPLE_MESSAGE ),
+                                        &pHeader,
+                                        &headerSize );
+    LogDebug( ( "Prepared PUBLISH header size is %lu.",
                 ( unsigned long ) headerSize ) );
     assert( result == MQTTSuccess );
-    /* Send Publish header to the broker. */
-    status = Plaintext_Send( pNetworkContext, ( void * ) pFixedBuffer->pBuffer, headerSize );
-    assert( status == ( int ) headerSize );
-    /* Send Publish payload to the broker */
-    status = Plaintext_Send( pNetworkContext, ( void * ) mqttPublishInfo.pPayload, mqttPublishInfo.payloadLength );
-    assert( status == ( int ) mqttPublishInfo.payloadLength );
+    /* Send the Publish header and payload to the broker with a single
+     * system call. The payload is sent directly from the application buffer. */
+    ioVec[ 0 ].iov_base = ( void * ) pHeader;
+    ioVec[ 0 ].iov_len = headerSize;
+    ioVec[ 1 ].iov_base = ( void * ) MQTT_EXAMPLE_MESSAGE;
+    ioVec[ 1 ].iov_len = strlen( MQTT_EXAMPLE_MESSAGE );
+    status = Plaintext_Writev( pNetworkContext, ioVec, 2U );
+    assert( status == ( int ) ( headerSize + strlen( MQTT_EXAMPLE_MESSAGE ) ) );
 }
 /*-----------------------------------------------------------*/
 
@@ -901,6 +892,9 @@ int main( int argc,
 {
     int returnStatus = EXIT_SUCCESS;
     MQTTFixedBuffer_t fixedBuffer;
+    MQTTFixedBuffer_t templateBuffer;
+    MQTTPublishInfo_t publishInfo;
+    MQTTStatus_t prepareStatus;
     uint16_t loopCount = 0;
     const uint16_t maxLoopCount = 5U;
     uint16_t demoIterations = 0;
@@ -930,6 +924,19 @@ int main( int argc,
     fixedBuffer.pBuffer = buffer;
     fixedBuffer.size = NETWORK_BUFFER_SIZE;
 
+    /* Serialize the header of the publishes to MQTT_EXAMPLE_TOPIC once; the
+     * demo publishes with QOS0 and without the retain flag. */
+    ( void ) memset( ( void * ) &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS0;
+    publishInfo.retain = false;
+    publishInfo.pTopicName = MQTT_EXAMPLE_TOPIC;
+    publishInfo.topicNameLength = MQTT_EXAMPLE_TOPIC_LENGTH;
+    templateBuffer.pBuffer = examplePublishTemplate;
+    templateBuffer.size = sizeof( examplePublishTemplate );
+    prepareStatus = PreparedPublish_Init( &examplePublish, &publishInfo, &templateBuffer );
+    assert( prepareStatus == MQTTSuccess );
+    ( void ) prepareStatus;
+
     for( demoIterations = 0; demoIterations < maxDemoIterations; demoIterations++ )
     {
         /* Establish a TCP connection with the MQTT broker. This example connects to
@@ -1033,7 +1040,7 @@ int main( int argc,
                 if( publishPacketSent == false )
                 {
                     LogInfo( ( "Publish to the MQTT topic %s\r\n", MQTT_EXAMPLE_TOPIC ) );
-                    mqttPublishToTopic( &networkContext, &fixedBuffer );
+                    mqttPublishToTopic( &networkContext, &examplePublish );
 
                     /* Set control packet sent flag to true so that the lastControlPacketSent
                      * timestamp will be updated. */
@@ -0,0 +1,220 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file prepared_publish.c
+ * @brief PUBLISH packets prepared once for a topic, and sent many times.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "prepared_publish.h"
+
+/**
+ * @brief Largest remaining length of an MQTT packet.
+ */
+#define MAX_REMAINING_LENGTH    ( 268435455UL )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the number of bytes of an encoded remaining length.
+ *
+ * @param[in] remainingLength The remaining length, at most
+ * #MAX_REMAINING_LENGTH.
+ *
+ * @return 1 to 4.
+ */
+static size_t remainingLengthEncodedSize( size_t remainingLength );
+
+/*-----------------------------------------------------------*/
+
+static size_t remainingLengthEncodedSize( size_t remainingLength )
+{
+    size_t encodedSize;
+
+    if( remainingLength < 128U )
+    {
+        encodedSize = 1U;
+    }
+    else if( remainingLength < 16384U )
+    {
+        encodedSize = 2U;
+    }
+    else if( remainingLength < 2097152U )
+    {
+        encodedSize = 3U;
+    }
+    else
+    {
+        encodedSize = 4U;
+    }
+
+    return encodedSize;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t PreparedPublish_Init( PreparedPublish_t * pPrepared,
+                                   const MQTTPublishInfo_t * pPublishInfo,
+                                   const MQTTFixedBuffer_t * pFixedBuffer )
+{
+    MQTTStatus_t status = MQTTSuccess;
+    MQTTPublishInfo_t topicInfo;
+    MQTTFixedBuffer_t templateBuffer;
+    size_t remainingLength = 0U;
+    size_t packetSize = 0U;
+    size_t headerSize = 0U;
+    size_t fixedHeaderLength;
+    uint16_t templatePacketId = 0U;
+
+    if( ( pPrepared == NULL ) || ( pPublishInfo == NULL ) ||
+        ( pFixedBuffer == NULL ) || ( pFixedBuffer->pBuffer == NULL ) )
+    {
+        status = MQTTBadParameter;
+    }
+    else
+    {
+        /* The template holds the header only: the payload is sent from the
+         * buffer of the application. */
+        topicInfo = *pPublishInfo;
+        topicInfo.dup = false;
+        topicInfo.pPayload = NULL;
+        topicInfo.payloadLength = 0U;
+
+        status = MQTT_GetPublishPacketSize( &topicInfo, &remainingLength, &packetSize );
+    }
+
+    if( status == MQTTSuccess )
+    {
+        if( pFixedBuffer->size < ( PREPARED_PUBLISH_FIXED_HEADER_MAX_LENGTH + remainingLength ) )
+        {
+            status = MQTTNoMemory;
+        }
+        else
+        {
+            templateBuffer = *pFixedBuffer;
+
+            /* The packet identifier is patched by PreparedPublish_GetHeader;
+             * any non-zero value will do here. */
+            if( topicInfo.qos != MQTTQoS0 )
+            {
+                templatePacketId = 1U;
+            }
+
+            status = MQTT_SerializePublishHeader( &topicInfo,
+                                                  templatePacketId,
+                                                  remainingLength,
+                                                  &templateBuffer,
+                                                  &headerSize );
+        }
+    }
+
+    if( status == MQTTSuccess )
+    {
+        /* Move the variable header to a fixed offset, leaving room before it
+         * for the longest fixed header. The fixed header for a given payload
+         * then ends where the variable header starts. */
+        fixedHeaderLength = headerSize - remainingLength;
+        ( void ) memmove( &pFixedBuffer->pBuffer[ PREPARED_PUBLISH_FIXED_HEADER_MAX_LENGTH ],
+                          &pFixedBuffer->pBuffer[ fixedHeaderLength ],
+                          remainingLength );
+
+        pPrepared->pBuffer = pFixedBuffer->pBuffer;
+        pPrepared->variableHeaderLength = remainingLength;
+        pPrepared->headerFlags = pFixedBuffer->pBuffer[ 0 ];
+        pPrepared->qos = topicInfo.qos;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t PreparedPublish_GetHeader( const PreparedPublish_t * pPrepared,
+                                        uint16_t packetId,
+                                        size_t payloadLength,
+                                        const uint8_t ** pHeader,
+                                        size_t * pHeaderSize )
+{
+    MQTTStatus_t status = MQTTSuccess;
+    size_t remainingLength;
+    size_t lengthToEncode;
+    size_t encodedSize;
+    size_t headerStart;
+    size_t index;
+    uint8_t * pPacketId;
+
+    if( ( pPrepared == NULL ) || ( pPrepared->pBuffer == NULL ) ||
+        ( pHeader == NULL ) || ( pHeaderSize == NULL ) )
+    {
+        status = MQTTBadParameter;
+    }
+    else if( ( pPrepared->qos != MQTTQoS0 ) && ( packetId == 0U ) )
+    {
+        status = MQTTBadParameter;
+    }
+    else if( payloadLength > ( MAX_REMAINING_LENGTH - pPrepared->variableHeaderLength ) )
+    {
+        status = MQTTBadParameter;
+    }
+    else
+    {
+        remainingLength = pPrepared->variableHeaderLength + payloadLength;
+        encodedSize = remainingLengthEncodedSize( remainingLength );
+        headerStart = PREPARED_PUBLISH_FIXED_HEADER_MAX_LENGTH - 1U - encodedSize;
+
+        /* Write the fixed header right before the variable header. */
+        pPrepared->pBuffer[ headerStart ] = pPrepared->headerFlags;
+
+        lengthToEncode = remainingLength;
+
+        for( index = 1U; index <= encodedSize; index++ )
+        {
+            pPrepared->pBuffer[ headerStart + index ] = ( uint8_t ) ( lengthToEncode & 0x7FU );
+            lengthToEncode >>= 7U;
+
+            if( lengthToEncode > 0U )
+            {
+                pPrepared->pBuffer[ headerStart + index ] |= 0x80U;
+            }
+        }
+
+        /* The packet identifier ends the variable header. */
+        if( pPrepared->qos != MQTTQoS0 )
+        {
+            pPacketId = &pPrepared->pBuffer[ PREPARED_PUBLISH_FIXED_HEADER_MAX_LENGTH +
+                                             pPrepared->variableHeaderLength - 2U ];
+            pPacketId[ 0 ] = ( uint8_t ) ( packetId >> 8U );
+            pPacketId[ 1 ] = ( uint8_t ) ( packetId & 0xFFU );
+        }
+
+        *pHeader = &pPrepared->pBuffer[ headerStart ];
+        *pHeaderSize = 1U + encodedSize + pPrepared->variableHeaderLength;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
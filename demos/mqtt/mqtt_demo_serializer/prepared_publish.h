@@ -0,0 +1,114 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file prepared_publish.h
+ * @brief PUBLISH packets prepared once for a topic, and sent many times.
+ *
+ * #MQTT_SerializePublishHeader encodes the fixed header and the topic of
+ * every publish. When a topic is published to again and again with the same
+ * QoS and retain flag, only the remaining length and the packet identifier
+ * change, so #PreparedPublish_Init serializes the header once into a
+ * template, and #PreparedPublish_GetHeader patches those two fields in
+ * place. The header is then sent with the payload, which is not copied,
+ * by a gather write.
+ */
+
+#ifndef PREPARED_PUBLISH_H_
+#define PREPARED_PUBLISH_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* MQTT Serializer API header. */
+#include "core_mqtt_serializer.h"
+
+/**
+ * @brief Maximum length of the fixed header of a PUBLISH: the packet type
+ * and flags, and a remaining length of up to 4 bytes.
+ */
+#define PREPARED_PUBLISH_FIXED_HEADER_MAX_LENGTH    ( 5U )
+
+/**
+ * @brief Size of the template buffer needed for a topic of @p topicLength
+ * bytes: the fixed header, the length of the topic, the topic and the
+ * packet identifier.
+ */
+#define PREPARED_PUBLISH_BUFFER_SIZE( topicLength ) \
+    ( PREPARED_PUBLISH_FIXED_HEADER_MAX_LENGTH + 2U + ( size_t ) ( topicLength ) + 2U )
+
+/**
+ * @brief A publish prepared for a topic.
+ *
+ * The members are set by #PreparedPublish_Init and are not meant to be
+ * changed by the application.
+ */
+typedef struct PreparedPublish
+{
+    uint8_t * pBuffer;           /**< @brief The template; the variable header starts at #PREPARED_PUBLISH_FIXED_HEADER_MAX_LENGTH. */
+    size_t variableHeaderLength; /**< @brief Length of the topic, its length and the packet identifier, if any. */
+    uint8_t headerFlags;         /**< @brief First byte of the packet: the packet type, QoS and retain flag. */
+    MQTTQoS_t qos;               /**< @brief QoS of the publishes. */
+} PreparedPublish_t;
+
+/**
+ * @brief Prepare the publishes to a topic.
+ *
+ * @param[out] pPrepared The prepared publish.
+ * @param[in] pPublishInfo The topic, QoS and retain flag of the publishes;
+ * the payload and the duplicate flag are ignored. The topic is copied.
+ * @param[in] pFixedBuffer The buffer of the template, of at least
+ * #PREPARED_PUBLISH_BUFFER_SIZE bytes. It must remain valid while the
+ * prepared publish is used.
+ *
+ * @return #MQTTSuccess, #MQTTBadParameter if a parameter is invalid, or
+ * #MQTTNoMemory if the buffer is too small.
+ */
+MQTTStatus_t PreparedPublish_Init( PreparedPublish_t * pPrepared,
+                                   const MQTTPublishInfo_t * pPublishInfo,
+                                   const MQTTFixedBuffer_t * pFixedBuffer );
+
+/**
+ * @brief Get the header of a publish of a prepared topic.
+ *
+ * The header is patched in the template, so it remains valid until the
+ * next call for the same prepared publish. Retransmissions, which need the
+ * duplicate flag, are serialized with #MQTT_SerializePublishHeader.
+ *
+ * @param[in] pPrepared The prepared publish.
+ * @param[in] packetId Packet identifier of the publish; ignored for QoS0.
+ * @param[in] payloadLength Length of the payload of the publish.
+ * @param[out] pHeader The header, to be sent before the payload.
+ * @param[out] pHeaderSize Length of @p pHeader.
+ *
+ * @return #MQTTSuccess, or #MQTTBadParameter if a parameter is invalid or
+ * the packet would be larger than MQTT allows.
+ */
+MQTTStatus_t PreparedPublish_GetHeader( const PreparedPublish_t * pPrepared,
+                                        uint16_t packetId,
+                                        size_t payloadLength,
+                                        const uint8_t ** pHeader,
+                                        size_t * pHeaderSize );
+
+#endif /* ifndef PREPARED_PUBLISH_H_ */
@@ -92,11 +92,11 @@
  * a list of pairs of topic filter and its subscription callback. The
  * subscription callback is invoked when an incoming PUBLISH message is received
  * on a matching topic in the demo.
- * The memory of the registry is statically allocated whose size is dependent
- * on the value of this macro.
+ * The memory of the registry is allocated on the heap with room for this number
+ * of records, and grows when more callbacks are registered.
  *
- * As this demo uses 3 topic filters, the minimum value of this config should be
- * 3 for a successful execution of the demo.
+ * As this demo uses 3 topic filters, a value of at least 3 avoids growing the
+ * registry during the demo.
  */
 #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
 
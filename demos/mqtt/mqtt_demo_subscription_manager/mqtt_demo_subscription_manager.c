@@ -65,6 +65,9 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /* Include subscription manager. */
 #include "mqtt_subscription_manager.h"
 
@@ -514,7 +517,7 @@ static int publishToTopicAndProcessIncomingMessage( MQTTContext_t * pMqttContext
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
 }
 
 /*-----------------------------------------------------------*/
@@ -527,27 +530,18 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     ServerInfo_t serverInfo;
     OpensslCredentials_t opensslCredentials;
     uint16_t nextRetryBackOff;
-    struct timespec tp;
 
     /* Initialize information to connect to the MQTT broker. */
     serverInfo.pHostName = BROKER_ENDPOINT;
     serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
     serverInfo.port = BROKER_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Initialize credentials for establishing TLS session. */
     memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
     opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
     opensslCredentials.sniHostName = BROKER_ENDPOINT;
 
-    /* Seed pseudo random number generator used in the demo for
-     * backoff period calculation when retrying failed network operations
-     * with broker. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
-
 
     /* Initialize reconnect attempts and interval. */
     BackoffAlgorithm_InitializeParams( &reconnectParams,
@@ -1333,7 +1327,7 @@ int main( int argc,
 {
     int returnStatus = EXIT_SUCCESS;
     NetworkContext_t networkContext;
-    OpensslParams_t opensslParams;
+    OpensslParams_t opensslParams = { 0 };
 
     ( void ) argc;
     ( void ) argv;
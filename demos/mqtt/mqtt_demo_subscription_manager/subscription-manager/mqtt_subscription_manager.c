@@ -27,6 +27,8 @@
  */
 
 /* Standard includes. */
+/* Standard includes. */
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -36,64 +38,2214 @@
 /* Include header for the subscription manager. */
 #include "mqtt_subscription_manager.h"
 
+/* Trace probes of the dispatch. */
+#include "trace_probes.h"
+
+
+/**
+ * @brief The default number of callback records the registry is allocated
+ * with. The registry grows beyond it as callbacks are registered.
+ */
+#ifndef MAX_SUBSCRIPTION_CALLBACK_RECORDS
+    #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
+#endif
+
+/**
+ * @brief Set to 1 to register and remove callbacks from any thread while
+ * #SubscriptionManager_DispatchHandler runs on other threads.
+ *
+ * Dispatch then matches topic names against an immutable snapshot of the
+ * registry, which is rebuilt at each change and swapped atomically, and takes
+ * no lock. A replaced snapshot is freed once no dispatch can still be using it,
+ * which is tracked with two epochs of reader counts.
+ */
+#ifndef SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH
+    #define SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH    ( 0 )
+#endif
+
+/**
+ * @brief Minimum time in milliseconds between two log messages about invoking
+ * a subscription callback, which would otherwise be logged for every
+ * dispatched message. Set to 0 to log every invocation.
+ */
+#ifndef SUBSCRIPTION_MANAGER_DISPATCH_LOG_INTERVAL_MS
+    #define SUBSCRIPTION_MANAGER_DISPATCH_LOG_INTERVAL_MS    ( 1000U )
+#endif
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) && ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 0 )
+    #error "SUBSCRIPTION_MANAGER_ASYNC_DISPATCH requires SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH, as callbacks run on the dispatch workers."
+#endif
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) && ( ( SUBSCRIPTION_MANAGER_DISPATCH_WORKERS == 0 ) || ( SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH == 0 ) )
+    #error "SUBSCRIPTION_MANAGER_DISPATCH_WORKERS and SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH must be at least 1."
+#endif
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+    #include <pthread.h>
+#endif
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+    #include <time.h>
+
+    /* Include header for the placement of the threads. */
+    #include "thread_groups.h"
+#endif
+
+/**
+ * @brief Index of no entry in the arrays of the registry.
+ */
+#define NO_ENTRY    UINT32_MAX
+
+/**
+ * @brief Index of the root node of the topic filter index, which has the first
+ * level of each topic filter as a child.
+ */
+#define ROOT_TOPIC_NODE    0U
 
 /**
- * @brief Represents a registered record of the topic filter and its associated callback
- * in the subscription manager registry.
+ * @brief Represents a registered record of a callback for a topic filter in the
+ * subscription manager registry.
  */
 typedef struct SubscriptionManagerRecord
 {
-    const char * pTopicFilter;
-    uint16_t topicFilterLength;
-    SubscriptionManagerCallback_t callback;
+    uint32_t filter;                                      /**< @brief The topic filter of the record; #NO_ENTRY if the record is free. */
+    uint32_t next;                                        /**< @brief The next record of the topic filter, or the next free record. */
+    uint32_t generation;                                  /**< @brief Incremented each time the record is freed. */
+    const char * pTopicFilter;                            /**< @brief The topic filter passed at registration. */
+    SubscriptionManagerCallback_t callback;               /**< @brief Callback registered with #SubscriptionManager_RegisterCallback; NULL if none. */
+    SubscriptionManagerContextCallback_t contextCallback; /**< @brief Callback registered with #SubscriptionManager_RegisterContextCallback; NULL if none. */
+    void * pUserContext;                                  /**< @brief The context passed to @p contextCallback. */
 } SubscriptionManagerRecord_t;
 
 /**
- * @brief The default value for the maximum size of the callback registry in the
- * subscription manager.
+ * @brief A registered topic filter, with its records in the order they were
+ * registered.
  */
-#ifndef MAX_SUBSCRIPTION_CALLBACK_RECORDS
-    #define MAX_SUBSCRIPTION_CALLBACK_RECORDS    5
-#endif
+typedef struct SubscriptionManagerFilter
+{
+    const char * pTopicFilter;  /**< @brief The topic filter of the first record; NULL if the entry is free. */
+    uint16_t topicFilterLength; /**< @brief The length of the topic filter. */
+    uint32_t hash;              /**< @brief The hash of the topic filter. */
+    uint32_t nextInBucket;      /**< @brief The next topic filter of the hash bucket, or the next free entry. */
+    uint32_t firstRecord;       /**< @brief The first record of the topic filter. */
+    uint32_t lastRecord;        /**< @brief The last record of the topic filter. */
+    uint32_t node;              /**< @brief The node of the last level of the topic filter. */
+} SubscriptionManagerFilter_t;
+
+/**
+ * @brief A node of the topic filter index, for one level of the topic filters
+ * sharing the levels before it.
+ *
+ * The level is stored as an offset in the topic filter of one of them, which
+ * is the same in all of them.
+ */
+typedef struct SubscriptionManagerNode
+{
+    uint32_t owner;       /**< @brief A topic filter with this node, holding the level. */
+    uint16_t levelOffset; /**< @brief Offset of the level in the topic filter of @p owner. */
+    uint16_t levelLength; /**< @brief The length of the level. */
+    uint32_t parent;      /**< @brief The node of the previous level. */
+    uint32_t firstChild;  /**< @brief The first node of the next level; #NO_ENTRY if none. */
+    uint32_t nextSibling; /**< @brief The next node of the same level, or the next free node. */
+    uint32_t filter;      /**< @brief The topic filter ending at this level; #NO_ENTRY if none. */
+    uint32_t references;  /**< @brief The number of topic filters with this node. */
+} SubscriptionManagerNode_t;
+
+/**
+ * @brief A node of the topic filter index whose children are matched against
+ * a level of the topic name.
+ */
+typedef struct SubscriptionManagerMatch
+{
+    uint32_t node;      /**< @brief The node. */
+    uint32_t nextLevel; /**< @brief Offset of the level in the topic name; past the end if the topic name has no more levels. */
+} SubscriptionManagerMatch_t;
+
+/**
+ * @brief A callback to invoke for an incoming PUBLISH message.
+ */
+typedef struct SubscriptionManagerInvocation
+{
+    uint32_t record;     /**< @brief The record of the callback. */
+    uint32_t generation; /**< @brief The generation of the record, to skip it if it is removed by a previous callback. */
+} SubscriptionManagerInvocation_t;
+
+/**
+ * @brief The records of the registry, and their free list.
+ */
+static SubscriptionManagerRecord_t * pRecords = NULL;
+static uint32_t recordCapacity = 0U;
+static uint32_t freeRecord = NO_ENTRY;
+
+/**
+ * @brief The topic filters of the registry, and their free list.
+ */
+static SubscriptionManagerFilter_t * pFilters = NULL;
+static uint32_t filterCapacity = 0U;
+static uint32_t freeFilter = NO_ENTRY;
+static uint32_t filterCount = 0U;
+
+/**
+ * @brief The hash table of the topic filters, with a power of two number of
+ * buckets.
+ */
+static uint32_t * pBuckets = NULL;
+static uint32_t bucketCount = 0U;
+
+/**
+ * @brief The nodes of the topic filter index, and their free list.
+ *
+ * The topic filter index is a tree with a node for each topic filter level,
+ * so that a topic name is only compared with the topic filters that match
+ * each of its levels.
+ */
+static SubscriptionManagerNode_t * pNodes = NULL;
+static uint32_t nodeCapacity = 0U;
+static uint32_t freeNode = NO_ENTRY;
+static uint32_t freeNodeCount = 0U;
+
+/**
+ * @brief The nodes to match in #SubscriptionManager_DispatchHandler, one for
+ * each node at most.
+ */
+static SubscriptionManagerMatch_t * pPendingMatches = NULL;
+static uint32_t pendingMatchCapacity = 0U;
+
+/**
+ * @brief The callbacks to invoke in #SubscriptionManager_DispatchHandler.
+ */
+static SubscriptionManagerInvocation_t * pInvocations = NULL;
+static uint32_t invocationCapacity = 0U;
+
+/**
+ * @brief true while #SubscriptionManager_DispatchHandler invokes callbacks,
+ * which may register or remove callbacks.
+ */
+static bool dispatching = false;
+
+/**
+ * @brief The states of a topic filter declared with
+ * #SubscriptionManager_AddInterest.
+ */
+typedef enum SubscriptionManagerInterestState
+{
+    InterestFree = 0,           /**< @brief The entry is free. */
+    InterestPendingSubscribe,   /**< @brief The SUBSCRIBE is to be sent by the next flush. */
+    InterestSubscribing,        /**< @brief The SUBSCRIBE is being sent. */
+    InterestSubscribed,         /**< @brief The broker has the topic filter in the session. */
+    InterestPendingUnsubscribe, /**< @brief No interest is left; the UNSUBSCRIBE is to be sent by the next flush. */
+    InterestUnsubscribing       /**< @brief The UNSUBSCRIBE is being sent. */
+} SubscriptionManagerInterestState_t;
+
+/**
+ * @brief A topic filter declared with #SubscriptionManager_AddInterest.
+ */
+typedef struct SubscriptionManagerInterest
+{
+    SubscriptionManagerInterestState_t state;                   /**< @brief The state of the topic filter. */
+    uint32_t references;                                        /**< @brief The interests declared in the topic filter. */
+    uint16_t topicFilterLength;                                 /**< @brief Length of @p topicFilter. */
+    char topicFilter[ SUBSCRIPTION_MANAGER_INTEREST_FILTER_SIZE ]; /**< @brief A copy of the topic filter. */
+} SubscriptionManagerInterest_t;
+
+/**
+ * @brief The topic filters declared with #SubscriptionManager_AddInterest.
+ */
+static SubscriptionManagerInterest_t interests[ SUBSCRIPTION_MANAGER_MAX_INTERESTS ];
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+
+/**
+ * @brief A callback of a snapshot of the registry.
+ */
+    typedef struct SubscriptionManagerSnapshotCallback
+    {
+        SubscriptionManagerCallback_t callback;               /**< @brief The callback without a context; NULL if none. */
+        SubscriptionManagerContextCallback_t contextCallback; /**< @brief The callback with a context; NULL if none. */
+        void * pUserContext;                                  /**< @brief The context passed to @p contextCallback. */
+    } SubscriptionManagerSnapshotCallback_t;
+
+/**
+ * @brief A node of a snapshot of the topic filter index, at the same index as
+ * the node it is copied from.
+ */
+    typedef struct SubscriptionManagerSnapshotNode
+    {
+        uint32_t level;             /**< @brief Offset of the level in the strings of the snapshot. */
+        uint16_t levelLength;       /**< @brief The length of the level. */
+        uint16_t topicFilterLength; /**< @brief The length of the topic filter ending at this level. */
+        uint32_t topicFilter;       /**< @brief Offset of the topic filter in the strings of the snapshot. */
+        uint32_t hash;              /**< @brief The hash of the topic filter, which selects its dispatch worker. */
+        uint32_t parent;            /**< @brief The node of the previous level. */
+        uint32_t firstChild;        /**< @brief The first node of the next level; #NO_ENTRY if none. */
+        uint32_t nextSibling;       /**< @brief The next node of the same level; #NO_ENTRY if none. */
+        uint32_t firstCallback;     /**< @brief The first callback of the topic filter ending at this level. */
+        uint32_t callbackCount;     /**< @brief The number of callbacks of the topic filter; 0 if none. */
+    } SubscriptionManagerSnapshotNode_t;
+
+/**
+ * @brief An immutable copy of the registry, allocated as a single block with
+ * its callbacks, nodes and strings.
+ */
+    typedef struct SubscriptionManagerSnapshot
+    {
+        struct SubscriptionManagerSnapshot * pNextRetired; /**< @brief The snapshot retired before this one. */
+        uint32_t retiredEpoch;                             /**< @brief The epoch the snapshot was replaced in. */
+        SubscriptionManagerSnapshotCallback_t * pCallbacks; /**< @brief The callbacks, by topic filter. */
+        SubscriptionManagerSnapshotNode_t * pNodes;         /**< @brief The nodes of the topic filter index. */
+        char * pStrings;                                    /**< @brief The levels and topic filters. */
+    } SubscriptionManagerSnapshot_t;
+
+/**
+ * @brief Serializes the changes of the registry and the swaps of its snapshot.
+ */
+    static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The snapshot used by #SubscriptionManager_DispatchHandler; NULL if
+ * the registry is empty.
+ */
+    static SubscriptionManagerSnapshot_t * pSnapshot = NULL;
+
+/**
+ * @brief The replaced snapshots that may still be in use, the last one first.
+ */
+    static SubscriptionManagerSnapshot_t * pRetiredSnapshots = NULL;
+
+/**
+ * @brief The current epoch, and the number of dispatches that started in an
+ * even or odd epoch.
+ *
+ * A snapshot replaced in an epoch is freed two epochs later. The epoch only
+ * advances when no dispatch counts in the parity of the next epoch, so each
+ * parity has had no dispatch left from before the snapshot was replaced.
+ */
+    static uint32_t snapshotEpoch = 0U;
+    static uint32_t activeReaders[ 2 ] = { 0U, 0U };
+
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 ) */
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+
+/**
+ * @brief Marks an incoming PUBLISH message that could not be copied to a
+ * pooled buffer, so that its callbacks are dropped.
+ */
+    #define DROPPED_MESSAGE    ( NO_ENTRY - 1U )
+
+/**
+ * @brief A copy of an incoming PUBLISH message, shared by its queued callbacks.
+ */
+    typedef struct SubscriptionManagerMessage
+    {
+        uint32_t references;                                        /**< @brief The queued callbacks, and the dispatch handler while queueing them; 0 if the buffer is free. */
+        MQTTContext_t * pContext;                                   /**< @brief The context associated with the MQTT connection. */
+        MQTTPublishInfo_t publishInfo;                              /**< @brief The message, with its topic name and payload in @p buffer. */
+        uint8_t buffer[ SUBSCRIPTION_MANAGER_DISPATCH_BUFFER_SIZE ]; /**< @brief The topic name followed by the payload. */
+    } SubscriptionManagerMessage_t;
+
+/**
+ * @brief A callback queued to a dispatch worker.
+ */
+    typedef struct SubscriptionManagerWork
+    {
+        uint32_t message;                                     /**< @brief The pooled message to invoke the callback with. */
+        SubscriptionManagerCallback_t callback;               /**< @brief The callback without a context; NULL if none. */
+        SubscriptionManagerContextCallback_t contextCallback; /**< @brief The callback with a context; NULL if none. */
+        void * pUserContext;                                  /**< @brief The context passed to @p contextCallback. */
+    } SubscriptionManagerWork_t;
+
+/**
+ * @brief A dispatch worker, with its queue of callbacks.
+ */
+    typedef struct SubscriptionManagerWorker
+    {
+        pthread_t thread;                                                  /**< @brief The worker thread. */
+        pthread_cond_t condition;                                          /**< @brief Signaled when a callback is queued or the workers stop. */
+        SubscriptionManagerWork_t queue[ SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH ]; /**< @brief The queued callbacks. */
+        uint32_t head;                                                     /**< @brief The next callback to invoke. */
+        uint32_t count;                                                    /**< @brief The number of queued callbacks. */
+    } SubscriptionManagerWorker_t;
+
+/**
+ * @brief The pooled message buffers.
+ */
+    static SubscriptionManagerMessage_t dispatchMessages[ SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH ];
+
+/**
+ * @brief The dispatch workers. The callbacks of a topic filter are queued to
+ * the worker selected by its hash, which keeps them in order.
+ */
+    static SubscriptionManagerWorker_t dispatchWorkers[ SUBSCRIPTION_MANAGER_DISPATCH_WORKERS ];
+
+/**
+ * @brief Protects the message buffers, the queues and the metrics.
+ */
+    static pthread_mutex_t dispatchMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Signaled when a message buffer or a queue entry is freed.
+ */
+    static pthread_cond_t dispatchSpaceCondition = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief true while the dispatch workers run.
+ */
+    static bool dispatchWorkersRunning = false;
+
+/**
+ * @brief The number of dispatch workers that were started.
+ */
+    static uint32_t dispatchWorkerCount = 0U;
+
+/**
+ * @brief Counters of the queued callbacks.
+ */
+    static SubscriptionManagerDispatchMetrics_t dispatchMetrics = { 0 };
+
+#endif /* if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the entry of a topic filter declared with
+ * #SubscriptionManager_AddInterest.
+ *
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength The length of the topic filter string.
+ *
+ * @return The index of the entry; #NO_ENTRY if there is none.
+ */
+static uint32_t findInterest( const char * pTopicFilter,
+                              uint16_t topicFilterLength );
+
+/**
+ * @brief Send the SUBSCRIBE or the UNSUBSCRIBE of the topic filters pending
+ * it, and update their states with the outcome.
+ *
+ * @param[in] subscribe true to send the pending SUBSCRIBE; false to send the
+ * pending UNSUBSCRIBE.
+ * @param[in] send The callback sending the packet.
+ * @param[in] pSendContext The context passed to @p send.
+ *
+ * @return true if nothing was pending or the packet was acknowledged; false
+ * otherwise.
+ */
+static bool flushInterests( bool subscribe,
+                            SubscriptionManagerSendCallback_t send,
+                            void * pSendContext );
+
+/**
+ * @brief Grow an array of the registry, doubling its capacity.
+ *
+ * @param[in] pArray The array; NULL if it is not allocated yet.
+ * @param[in,out] pCapacity The number of entries of the array, updated if it
+ * grows.
+ * @param[in] entrySize The size of an entry.
+ * @param[in] initialCapacity The number of entries to allocate the array with.
+ *
+ * @return The reallocated array; NULL if it could not grow, in which case
+ * @p pArray is unchanged.
+ */
+static void * growArray( void * pArray,
+                         uint32_t * pCapacity,
+                         size_t entrySize,
+                         uint32_t initialCapacity );
+
+/**
+ * @brief Allocate a record.
+ *
+ * @return The record; #NO_ENTRY if the registry could not grow.
+ */
+static uint32_t allocateRecord( void );
+
+/**
+ * @brief Allocate a topic filter entry.
+ *
+ * @return The entry; #NO_ENTRY if the registry could not grow.
+ */
+static uint32_t allocateFilter( void );
+
+/**
+ * @brief Make sure that a number of nodes can be taken from the free list of
+ * nodes, allocating the root node first.
+ *
+ * @param[in] count The number of nodes.
+ *
+ * @return true if there are enough free nodes; false if the registry could
+ * not grow.
+ */
+static bool reserveNodes( uint32_t count );
+
+/**
+ * @brief Free the memory of the registry once it is empty.
+ */
+static void freeRegistry( void );
+
+/**
+ * @brief Compute the FNV-1a hash of a topic filter.
+ */
+static uint32_t hashTopicFilter( const char * pTopicFilter,
+                                 uint16_t topicFilterLength );
+
+/**
+ * @brief Find a registered topic filter.
+ *
+ * @return The entry of the topic filter; #NO_ENTRY if it is not registered.
+ */
+static uint32_t findFilter( const char * pTopicFilter,
+                            uint16_t topicFilterLength,
+                            uint32_t hash );
+
+/**
+ * @brief Double the number of buckets of the hash table, or allocate it.
+ *
+ * @return true if the hash table was grown; false otherwise.
+ */
+static bool growBuckets( void );
+
+/**
+ * @brief Register a topic filter in the hash table and the topic filter index.
+ *
+ * @return The entry of the topic filter; #NO_ENTRY if the registry could not
+ * grow.
+ */
+static uint32_t addFilter( const char * pTopicFilter,
+                           uint16_t topicFilterLength,
+                           uint32_t hash );
+
+/**
+ * @brief Remove a topic filter and its records from the registry.
+ *
+ * @param[in] filter The entry of the topic filter.
+ */
+static void removeFilter( uint32_t filter );
+
+/**
+ * @brief Remove a record of a topic filter, and the topic filter with its
+ * last record.
+ */
+static void removeRecord( uint32_t filter,
+                          uint32_t record );
+
+/**
+ * @brief Add a callback record for a topic filter, registering the topic
+ * filter if it has no records yet.
+ */
+static SubscriptionManagerStatus_t addRecord( const char * pTopicFilter,
+                                              uint16_t topicFilterLength,
+                                              SubscriptionManagerCallback_t callback,
+                                              SubscriptionManagerContextCallback_t contextCallback,
+                                              void * pUserContext );
+
+/**
+ * @brief Get the length of the topic level that starts at an offset.
+ *
+ * @param[in] pTopic The topic name or filter.
+ * @param[in] topicLength The length of @p pTopic.
+ * @param[in] offset Offset of the level in @p pTopic.
+ *
+ * @return The length of the level, up to the next '/' or the end of @p pTopic.
+ */
+static uint16_t getLevelLength( const char * pTopic,
+                                uint16_t topicLength,
+                                uint32_t offset );
+
+/**
+ * @brief Get the level of a node of the topic filter index.
+ */
+static const char * getNodeLevel( uint32_t node );
+
+/**
+ * @brief Find the child of a node for a topic filter level.
+ *
+ * @return The child node; #NO_ENTRY if there is none.
+ */
+static uint32_t findChildNode( uint32_t parent,
+                               const char * pLevel,
+                               uint16_t levelLength );
+
+/**
+ * @brief Add the levels of a topic filter to the topic filter index.
+ *
+ * @return true if the topic filter was added; false if the index could not
+ * grow, in which case it is unchanged.
+ */
+static bool addFilterNodes( uint32_t filter );
+
+/**
+ * @brief Remove the levels of a topic filter from the topic filter index.
+ *
+ * The nodes of other topic filters that refer to the removed topic filter are
+ * changed to refer to one of those topic filters, which must stay valid while
+ * registered.
+ */
+static void removeFilterNodes( uint32_t filter );
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 0 )
+
+/**
+ * @brief Add the records of a topic filter to the callbacks to invoke.
+ *
+ * @param[in] filter The entry of the topic filter.
+ * @param[in,out] pCount The number of callbacks to invoke.
+ */
+    static void addInvocations( uint32_t filter,
+                                uint32_t * pCount );
+
+/**
+ * @brief Find the callbacks of the topic filters that match a topic name.
+ *
+ * @return The number of callbacks added to #pInvocations.
+ */
+    static uint32_t matchTopicName( const char * pTopicName,
+                                    uint16_t topicNameLength );
+
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 0 ) */
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+
+/**
+ * @brief Get the node after a node of the topic filter index, in a walk of
+ * the index that needs no stack.
+ *
+ * @return The next node; #NO_ENTRY after the last one.
+ */
+    static uint32_t getNextNode( uint32_t node );
+
+/**
+ * @brief Copy the registry to a new snapshot.
+ *
+ * @return The snapshot; NULL if it could not be allocated.
+ */
+    static SubscriptionManagerSnapshot_t * buildSnapshot( void );
+
+/**
+ * @brief Free the retired snapshots that no dispatch can be using any more,
+ * advancing the epoch when possible.
+ */
+    static void reclaimSnapshots( void );
+
+/**
+ * @brief Replace the snapshot with a copy of the registry, retiring the
+ * previous one.
+ *
+ * @return true if the snapshot was replaced with a copy of the registry; false
+ * if it could not be allocated, in which case no callbacks are dispatched until
+ * the next change of the registry.
+ */
+    static bool publishSnapshot( void );
+
+/**
+ * @brief Publish a new registration, removing it if it cannot be published.
+ *
+ * @param[in] returnStatus The status of the registration.
+ * @param[in] pTopicFilter The topic filter of the registration.
+ * @param[in] topicFilterLength The length of the topic filter.
+ *
+ * @return @p returnStatus; #SUBSCRIPTION_MANAGER_REGISTRY_FULL if the
+ * registration could not be published.
+ */
+    static SubscriptionManagerStatus_t publishRegistration( SubscriptionManagerStatus_t returnStatus,
+                                                            const char * pTopicFilter,
+                                                            uint16_t topicFilterLength );
+
+/**
+ * @brief Get the offset of the topic name level before another one.
+ *
+ * @param[in] pTopicName The topic name.
+ * @param[in] nextLevel Offset of the level after it, which may be past the
+ * end of the topic name.
+ *
+ * @return The offset of the level.
+ */
+    static uint32_t getPreviousLevel( const char * pTopicName,
+                                      uint32_t nextLevel );
+
+/**
+ * @brief Invoke the callbacks of a snapshot whose topic filters match a topic
+ * name.
+ *
+ * The index is walked with the parent of each node, so that dispatching needs
+ * no memory besides the snapshot.
+ */
+    static void dispatchSnapshot( const SubscriptionManagerSnapshot_t * pCurrent,
+                                  MQTTContext_t * pContext,
+                                  MQTTPublishInfo_t * pPublishInfo,
+                                  uint32_t * pMessage );
+
+/**
+ * @brief Invoke the callbacks of the topic filter ending at a node of a
+ * snapshot, or queue them to the dispatch workers.
+ *
+ * @param[in] pMessage The pooled copy of the message; #NO_ENTRY until the
+ * first callback is queued. Unused without SUBSCRIPTION_MANAGER_ASYNC_DISPATCH.
+ */
+    static void invokeSnapshotCallbacks( const SubscriptionManagerSnapshot_t * pCurrent,
+                                         const SubscriptionManagerSnapshotNode_t * pNode,
+                                         MQTTContext_t * pContext,
+                                         MQTTPublishInfo_t * pPublishInfo,
+                                         uint32_t * pMessage );
+
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 ) */
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+
+/**
+ * @brief Get the time until which to wait for a free message buffer or queue
+ * entry.
+ */
+    static void getDispatchDeadline( struct timespec * pDeadline );
+
+/**
+ * @brief Copy an incoming PUBLISH message to a free message buffer, waiting
+ * for one until a deadline. Must be called with #dispatchMutex locked.
+ *
+ * @return The message buffer, with a reference for the dispatch handler;
+ * #DROPPED_MESSAGE if the message is too large or no buffer was freed in time.
+ */
+    static uint32_t reserveMessage( MQTTContext_t * pContext,
+                                    const MQTTPublishInfo_t * pPublishInfo,
+                                    const struct timespec * pDeadline );
+
+/**
+ * @brief Release a reference to a message buffer. Must be called with
+ * #dispatchMutex locked.
+ */
+    static void releaseMessage( uint32_t message );
+
+/**
+ * @brief Queue a callback to the dispatch worker of its topic filter, copying
+ * the message to a message buffer for the first callback of the message.
+ *
+ * @return true if the workers handled the callback, by queueing or dropping
+ * it; false if the workers are not running.
+ */
+    static bool queueCallback( const SubscriptionManagerSnapshotNode_t * pNode,
+                               const SubscriptionManagerSnapshotCallback_t * pCallback,
+                               MQTTContext_t * pContext,
+                               MQTTPublishInfo_t * pPublishInfo,
+                               uint32_t * pMessage );
+
+/**
+ * @brief The dispatch worker thread, which invokes the callbacks of its queue
+ * until the workers stop and its queue is empty.
+ *
+ * @param[in] pArgument The #SubscriptionManagerWorker_t of the thread.
+ */
+    static void * dispatchWorkerThread( void * pArgument );
+
+#endif /* if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static void * growArray( void * pArray,
+                         uint32_t * pCapacity,
+                         size_t entrySize,
+                         uint32_t initialCapacity )
+{
+    void * pGrown = NULL;
+    uint32_t capacity = *pCapacity * 2U;
+
+    if( capacity < initialCapacity )
+    {
+        capacity = initialCapacity;
+    }
+
+    if( ( capacity > *pCapacity ) && ( capacity < NO_ENTRY ) )
+    {
+        pGrown = realloc( pArray, ( size_t ) capacity * entrySize );
+    }
+
+    if( pGrown != NULL )
+    {
+        *pCapacity = capacity;
+    }
+    else
+    {
+        LogError( ( "Unable to grow the subscription registry: Entries=%u",
+                    ( unsigned int ) capacity ) );
+    }
+
+    return pGrown;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t allocateRecord( void )
+{
+    uint32_t record = NO_ENTRY;
+    uint32_t capacity = recordCapacity;
+    uint32_t i;
+    SubscriptionManagerRecord_t * pGrown = NULL;
+
+    if( freeRecord == NO_ENTRY )
+    {
+        pGrown = growArray( pRecords, &capacity, sizeof( SubscriptionManagerRecord_t ), MAX_SUBSCRIPTION_CALLBACK_RECORDS );
+
+        if( pGrown != NULL )
+        {
+            pRecords = pGrown;
+
+            /* Add the new records to the free list. */
+            for( i = capacity; i > recordCapacity; i-- )
+            {
+                pRecords[ i - 1U ].filter = NO_ENTRY;
+                pRecords[ i - 1U ].generation = 0U;
+                pRecords[ i - 1U ].next = freeRecord;
+                freeRecord = i - 1U;
+            }
+
+            recordCapacity = capacity;
+        }
+    }
+
+    if( freeRecord != NO_ENTRY )
+    {
+        record = freeRecord;
+        freeRecord = pRecords[ record ].next;
+    }
+
+    return record;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t allocateFilter( void )
+{
+    uint32_t filter = NO_ENTRY;
+    uint32_t capacity = filterCapacity;
+    uint32_t i;
+    SubscriptionManagerFilter_t * pGrown = NULL;
+
+    if( freeFilter == NO_ENTRY )
+    {
+        pGrown = growArray( pFilters, &capacity, sizeof( SubscriptionManagerFilter_t ), MAX_SUBSCRIPTION_CALLBACK_RECORDS );
+
+        if( pGrown != NULL )
+        {
+            pFilters = pGrown;
+
+            /* Add the new entries to the free list. */
+            for( i = capacity; i > filterCapacity; i-- )
+            {
+                pFilters[ i - 1U ].pTopicFilter = NULL;
+                pFilters[ i - 1U ].nextInBucket = freeFilter;
+                freeFilter = i - 1U;
+            }
+
+            filterCapacity = capacity;
+        }
+    }
+
+    if( freeFilter != NO_ENTRY )
+    {
+        filter = freeFilter;
+        freeFilter = pFilters[ filter ].nextInBucket;
+    }
+
+    return filter;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool reserveNodes( uint32_t count )
+{
+    uint32_t capacity = nodeCapacity;
+    uint32_t first = nodeCapacity;
+    uint32_t i;
+    SubscriptionManagerNode_t * pGrown = NULL;
+    bool reserved = true;
+
+    while( ( reserved == true ) && ( freeNodeCount < count ) )
+    {
+        pGrown = growArray( pNodes, &capacity, sizeof( SubscriptionManagerNode_t ), MAX_SUBSCRIPTION_CALLBACK_RECORDS * 8U );
+
+        if( pGrown != NULL )
+        {
+            pNodes = pGrown;
+
+            if( nodeCapacity == 0U )
+            {
+                /* The root node is never freed. */
+                pNodes[ ROOT_TOPIC_NODE ].owner = NO_ENTRY;
+                pNodes[ ROOT_TOPIC_NODE ].levelOffset = 0U;
+                pNodes[ ROOT_TOPIC_NODE ].levelLength = 0U;
+                pNodes[ ROOT_TOPIC_NODE ].parent = NO_ENTRY;
+                pNodes[ ROOT_TOPIC_NODE ].firstChild = NO_ENTRY;
+                pNodes[ ROOT_TOPIC_NODE ].nextSibling = NO_ENTRY;
+                pNodes[ ROOT_TOPIC_NODE ].filter = NO_ENTRY;
+                pNodes[ ROOT_TOPIC_NODE ].references = 0U;
+                first = ROOT_TOPIC_NODE + 1U;
+            }
+
+            /* Add the new nodes to the free list. */
+            for( i = capacity; i > first; i-- )
+            {
+                pNodes[ i - 1U ].nextSibling = freeNode;
+                freeNode = i - 1U;
+                freeNodeCount++;
+            }
+
+            nodeCapacity = capacity;
+            first = capacity;
+        }
+        else
+        {
+            reserved = false;
+        }
+    }
+
+    return reserved;
+}
+
+/*-----------------------------------------------------------*/
+
+static void freeRegistry( void )
+{
+    free( pRecords );
+    pRecords = NULL;
+    recordCapacity = 0U;
+    freeRecord = NO_ENTRY;
+
+    free( pFilters );
+    pFilters = NULL;
+    filterCapacity = 0U;
+    freeFilter = NO_ENTRY;
+    filterCount = 0U;
+
+    free( pBuckets );
+    pBuckets = NULL;
+    bucketCount = 0U;
+
+    free( pNodes );
+    pNodes = NULL;
+    nodeCapacity = 0U;
+    freeNode = NO_ENTRY;
+    freeNodeCount = 0U;
+
+    free( pPendingMatches );
+    pPendingMatches = NULL;
+    pendingMatchCapacity = 0U;
+
+    free( pInvocations );
+    pInvocations = NULL;
+    invocationCapacity = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t hashTopicFilter( const char * pTopicFilter,
+                                 uint16_t topicFilterLength )
+{
+    uint32_t hash = 2166136261U;
+    uint16_t i;
+
+    for( i = 0U; i < topicFilterLength; i++ )
+    {
+        hash ^= ( uint8_t ) pTopicFilter[ i ];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t findFilter( const char * pTopicFilter,
+                            uint16_t topicFilterLength,
+                            uint32_t hash )
+{
+    uint32_t filter = NO_ENTRY;
+
+    if( bucketCount > 0U )
+    {
+        filter = pBuckets[ hash & ( bucketCount - 1U ) ];
+    }
+
+    while( ( filter != NO_ENTRY ) &&
+           ( ( pFilters[ filter ].hash != hash ) ||
+             ( pFilters[ filter ].topicFilterLength != topicFilterLength ) ||
+             ( strncmp( pFilters[ filter ].pTopicFilter, pTopicFilter, topicFilterLength ) != 0 ) ) )
+    {
+        filter = pFilters[ filter ].nextInBucket;
+    }
+
+    return filter;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool growBuckets( void )
+{
+    uint32_t count = bucketCount * 2U;
+    uint32_t * pGrown = NULL;
+    uint32_t bucket;
+    uint32_t filter;
+    bool grown = false;
+
+    if( count == 0U )
+    {
+        count = 8U;
+
+        while( count < MAX_SUBSCRIPTION_CALLBACK_RECORDS )
+        {
+            count *= 2U;
+        }
+    }
+
+    if( count > bucketCount )
+    {
+        pGrown = malloc( ( size_t ) count * sizeof( uint32_t ) );
+    }
+
+    if( pGrown != NULL )
+    {
+        for( bucket = 0U; bucket < count; bucket++ )
+        {
+            pGrown[ bucket ] = NO_ENTRY;
+        }
+
+        /* Rehash the registered topic filters. */
+        for( filter = 0U; filter < filterCapacity; filter++ )
+        {
+            if( pFilters[ filter ].pTopicFilter != NULL )
+            {
+                bucket = pFilters[ filter ].hash & ( count - 1U );
+                pFilters[ filter ].nextInBucket = pGrown[ bucket ];
+                pGrown[ bucket ] = filter;
+            }
+        }
+
+        free( pBuckets );
+        pBuckets = pGrown;
+        bucketCount = count;
+        grown = true;
+    }
+    else
+    {
+        LogError( ( "Unable to grow the subscription registry hash table: Buckets=%u",
+                    ( unsigned int ) count ) );
+    }
+
+    return grown;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t addFilter( const char * pTopicFilter,
+                           uint16_t topicFilterLength,
+                           uint32_t hash )
+{
+    uint32_t filter = NO_ENTRY;
+    uint32_t bucket;
+
+    /* Keep at most one topic filter per bucket on average. A hash table that
+     * cannot grow is only slower. */
+    if( filterCount >= bucketCount )
+    {
+        ( void ) growBuckets();
+    }
+
+    if( bucketCount > 0U )
+    {
+        filter = allocateFilter();
+    }
+
+    if( filter != NO_ENTRY )
+    {
+        pFilters[ filter ].pTopicFilter = pTopicFilter;
+        pFilters[ filter ].topicFilterLength = topicFilterLength;
+        pFilters[ filter ].hash = hash;
+        pFilters[ filter ].firstRecord = NO_ENTRY;
+        pFilters[ filter ].lastRecord = NO_ENTRY;
+
+        if( addFilterNodes( filter ) == true )
+        {
+            bucket = hash & ( bucketCount - 1U );
+            pFilters[ filter ].nextInBucket = pBuckets[ bucket ];
+            pBuckets[ bucket ] = filter;
+            filterCount++;
+        }
+        else
+        {
+            pFilters[ filter ].pTopicFilter = NULL;
+            pFilters[ filter ].nextInBucket = freeFilter;
+            freeFilter = filter;
+            filter = NO_ENTRY;
+        }
+    }
+
+    return filter;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeFilter( uint32_t filter )
+{
+    uint32_t record = pFilters[ filter ].firstRecord;
+    uint32_t next;
+    uint32_t * pLink = &pBuckets[ pFilters[ filter ].hash & ( bucketCount - 1U ) ];
+
+    while( record != NO_ENTRY )
+    {
+        next = pRecords[ record ].next;
+        pRecords[ record ].filter = NO_ENTRY;
+        pRecords[ record ].generation++;
+        pRecords[ record ].next = freeRecord;
+        freeRecord = record;
+        record = next;
+    }
+
+    removeFilterNodes( filter );
+
+    while( *pLink != filter )
+    {
+        pLink = &pFilters[ *pLink ].nextInBucket;
+    }
+
+    *pLink = pFilters[ filter ].nextInBucket;
+
+    pFilters[ filter ].pTopicFilter = NULL;
+    pFilters[ filter ].nextInBucket = freeFilter;
+    freeFilter = filter;
+    filterCount--;
+
+    /* The callbacks to invoke are still needed while dispatching; the registry
+     * is freed once the dispatch returns. */
+    if( ( filterCount == 0U ) && ( dispatching == false ) )
+    {
+        freeRegistry();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeRecord( uint32_t filter,
+                          uint32_t record )
+{
+    uint32_t previous = NO_ENTRY;
+    uint32_t current = pFilters[ filter ].firstRecord;
+
+    while( current != record )
+    {
+        previous = current;
+        current = pRecords[ current ].next;
+    }
+
+    if( ( previous == NO_ENTRY ) && ( pRecords[ record ].next == NO_ENTRY ) )
+    {
+        /* The topic filter has no other callbacks. */
+        removeFilter( filter );
+    }
+    else
+    {
+        if( previous == NO_ENTRY )
+        {
+            pFilters[ filter ].firstRecord = pRecords[ record ].next;
+        }
+        else
+        {
+            pRecords[ previous ].next = pRecords[ record ].next;
+        }
+
+        if( pFilters[ filter ].lastRecord == record )
+        {
+            pFilters[ filter ].lastRecord = previous;
+        }
+
+        pRecords[ record ].filter = NO_ENTRY;
+        pRecords[ record ].generation++;
+        pRecords[ record ].next = freeRecord;
+        freeRecord = record;
+
+        /* The topic filter of the removed callback may be freed once it is
+         * removed, so use the one of the remaining callbacks instead. */
+        pFilters[ filter ].pTopicFilter = pRecords[ pFilters[ filter ].firstRecord ].pTopicFilter;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static SubscriptionManagerStatus_t addRecord( const char * pTopicFilter,
+                                              uint16_t topicFilterLength,
+                                              SubscriptionManagerCallback_t callback,
+                                              SubscriptionManagerContextCallback_t contextCallback,
+                                              void * pUserContext )
+{
+    SubscriptionManagerStatus_t returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    uint32_t hash = hashTopicFilter( pTopicFilter, topicFilterLength );
+    uint32_t filter = findFilter( pTopicFilter, topicFilterLength, hash );
+    uint32_t record = NO_ENTRY;
+    bool newFilter = false;
+
+    if( filter != NO_ENTRY )
+    {
+        /* A topic filter has one callback without a context, and any number
+         * of different callbacks with a context. */
+        record = pFilters[ filter ].firstRecord;
+
+        while( ( record != NO_ENTRY ) &&
+               ( ( ( callback != NULL ) && ( pRecords[ record ].callback == NULL ) ) ||
+                 ( ( callback == NULL ) &&
+                   ( ( pRecords[ record ].contextCallback != contextCallback ) ||
+                     ( pRecords[ record ].pUserContext != pUserContext ) ) ) ) )
+        {
+            record = pRecords[ record ].next;
+        }
+
+        if( record != NO_ENTRY )
+        {
+            LogError( ( "Failed to register callback: Record for topic filter already exists: TopicFilter=%.*s",
+                        topicFilterLength,
+                        pTopicFilter ) );
+
+            returnStatus = SUBSCRIPTION_MANAGER_RECORD_EXISTS;
+        }
+    }
+    else
+    {
+        filter = addFilter( pTopicFilter, topicFilterLength, hash );
+        newFilter = true;
+    }
+
+    if( returnStatus == SUBSCRIPTION_MANAGER_SUCCESS )
+    {
+        if( filter != NO_ENTRY )
+        {
+            record = allocateRecord();
+        }
+
+        if( record != NO_ENTRY )
+        {
+            pRecords[ record ].filter = filter;
+            pRecords[ record ].next = NO_ENTRY;
+            pRecords[ record ].pTopicFilter = pTopicFilter;
+            pRecords[ record ].callback = callback;
+            pRecords[ record ].contextCallback = contextCallback;
+            pRecords[ record ].pUserContext = pUserContext;
+
+            if( pFilters[ filter ].lastRecord == NO_ENTRY )
+            {
+                pFilters[ filter ].firstRecord = record;
+            }
+            else
+            {
+                pRecords[ pFilters[ filter ].lastRecord ].next = record;
+            }
+
+            pFilters[ filter ].lastRecord = record;
+
+            LogDebug( ( "Added callback to registry: TopicFilter=%.*s",
+                        topicFilterLength,
+                        pTopicFilter ) );
+        }
+        else
+        {
+            LogError( ( "Unable to register callback: Registry could not grow: TopicFilter=%.*s",
+                        topicFilterLength,
+                        pTopicFilter ) );
+
+            if( ( newFilter == true ) && ( filter != NO_ENTRY ) )
+            {
+                removeFilter( filter );
+            }
+
+            returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t getLevelLength( const char * pTopic,
+                                uint16_t topicLength,
+                                uint32_t offset )
+{
+    uint32_t end = offset;
+
+    while( ( end < topicLength ) && ( pTopic[ end ] != '/' ) )
+    {
+        end++;
+    }
+
+    return ( uint16_t ) ( end - offset );
+}
+
+/*-----------------------------------------------------------*/
+
+static const char * getNodeLevel( uint32_t node )
+{
+    return &pFilters[ pNodes[ node ].owner ].pTopicFilter[ pNodes[ node ].levelOffset ];
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t findChildNode( uint32_t parent,
+                               const char * pLevel,
+                               uint16_t levelLength )
+{
+    uint32_t child = pNodes[ parent ].firstChild;
+
+    while( ( child != NO_ENTRY ) &&
+           ( ( pNodes[ child ].levelLength != levelLength ) ||
+             ( memcmp( getNodeLevel( child ), pLevel, levelLength ) != 0 ) ) )
+    {
+        child = pNodes[ child ].nextSibling;
+    }
+
+    return child;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool addFilterNodes( uint32_t filter )
+{
+    const char * pTopicFilter = pFilters[ filter ].pTopicFilter;
+    uint16_t topicFilterLength = pFilters[ filter ].topicFilterLength;
+    uint32_t node = ROOT_TOPIC_NODE;
+    uint32_t child = ROOT_TOPIC_NODE;
+    uint32_t newNodes = 0U;
+    uint16_t levelLength = 0U;
+    uint32_t offset = 0U;
+    bool added = false;
+
+    /* Count the levels that have no node yet. */
+    while( ( offset <= topicFilterLength ) && ( child != NO_ENTRY ) )
+    {
+        levelLength = getLevelLength( pTopicFilter, topicFilterLength, offset );
+        child = ( pNodes != NULL ) ? findChildNode( child, &pTopicFilter[ offset ], levelLength ) : NO_ENTRY;
+        offset += ( uint32_t ) levelLength + 1U;
+    }
+
+    if( child == NO_ENTRY )
+    {
+        newNodes = 1U;
+
+        while( offset <= topicFilterLength )
+        {
+            levelLength = getLevelLength( pTopicFilter, topicFilterLength, offset );
+            offset += ( uint32_t ) levelLength + 1U;
+            newNodes++;
+        }
+    }
+
+    if( reserveNodes( newNodes ) == true )
+    {
+        offset = 0U;
+
+        while( offset <= topicFilterLength )
+        {
+            levelLength = getLevelLength( pTopicFilter, topicFilterLength, offset );
+            child = findChildNode( node, &pTopicFilter[ offset ], levelLength );
+
+            if( child == NO_ENTRY )
+            {
+                child = freeNode;
+                freeNode = pNodes[ child ].nextSibling;
+                freeNodeCount--;
+
+                pNodes[ child ].owner = filter;
+                pNodes[ child ].levelOffset = ( uint16_t ) offset;
+                pNodes[ child ].levelLength = levelLength;
+                pNodes[ child ].parent = node;
+                pNodes[ child ].firstChild = NO_ENTRY;
+                pNodes[ child ].nextSibling = pNodes[ node ].firstChild;
+                pNodes[ child ].filter = NO_ENTRY;
+                pNodes[ child ].references = 0U;
+                pNodes[ node ].firstChild = child;
+            }
+
+            pNodes[ child ].references++;
+            node = child;
+            offset += ( uint32_t ) levelLength + 1U;
+        }
+
+        pNodes[ node ].filter = filter;
+        pFilters[ filter ].node = node;
+        added = true;
+    }
+
+    return added;
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeFilterNodes( uint32_t filter )
+{
+    uint32_t node = pFilters[ filter ].node;
+    uint32_t parent = NO_ENTRY;
+    uint32_t * pLink = NULL;
+
+    pNodes[ node ].filter = NO_ENTRY;
+
+    /* Walk up from the last level, so that the children of a node refer to
+     * another topic filter before the node does. */
+    while( node != ROOT_TOPIC_NODE )
+    {
+        parent = pNodes[ node ].parent;
+        pNodes[ node ].references--;
+
+        if( pNodes[ node ].references == 0U )
+        {
+            pLink = &pNodes[ parent ].firstChild;
+
+            while( *pLink != node )
+            {
+                pLink = &pNodes[ *pLink ].nextSibling;
+            }
+
+            *pLink = pNodes[ node ].nextSibling;
+
+            pNodes[ node ].nextSibling = freeNode;
+            freeNode = node;
+            freeNodeCount++;
+        }
+        else if( pNodes[ node ].owner == filter )
+        {
+            /* Another topic filter ends at the node, or has its next level. */
+            if( pNodes[ node ].filter != NO_ENTRY )
+            {
+                pNodes[ node ].owner = pNodes[ node ].filter;
+            }
+            else
+            {
+                pNodes[ node ].owner = pNodes[ pNodes[ node ].firstChild ].owner;
+            }
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        node = parent;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 0 )
+
+    static void addInvocations( uint32_t filter,
+                                uint32_t * pCount )
+    {
+        uint32_t record = pFilters[ filter ].firstRecord;
+        uint32_t capacity = invocationCapacity;
+        SubscriptionManagerInvocation_t * pGrown = NULL;
+
+        while( record != NO_ENTRY )
+        {
+            if( *pCount == invocationCapacity )
+            {
+                pGrown = growArray( pInvocations, &capacity, sizeof( SubscriptionManagerInvocation_t ), MAX_SUBSCRIPTION_CALLBACK_RECORDS );
+
+                if( pGrown != NULL )
+                {
+                    pInvocations = pGrown;
+                    invocationCapacity = capacity;
+                }
+            }
+
+            if( *pCount < invocationCapacity )
+            {
+                pInvocations[ *pCount ].record = record;
+                pInvocations[ *pCount ].generation = pRecords[ record ].generation;
+                ( *pCount )++;
+                record = pRecords[ record ].next;
+            }
+            else
+            {
+                LogError( ( "Unable to invoke callbacks of topic filter: TopicFilter=%.*s",
+                            pFilters[ filter ].topicFilterLength,
+                            pFilters[ filter ].pTopicFilter ) );
+                record = NO_ENTRY;
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static uint32_t matchTopicName( const char * pTopicName,
+                                    uint16_t topicNameLength )
+    {
+        uint32_t pendingCount = 0U;
+        uint32_t count = 0U;
+        uint32_t capacity = pendingMatchCapacity;
+        SubscriptionManagerMatch_t current;
+        SubscriptionManagerMatch_t * pGrown = NULL;
+        uint32_t child = NO_ENTRY;
+        uint16_t levelLength = 0U;
+        bool hasLevel = false;
+        bool wildcardAllowed = false;
+        const SubscriptionManagerNode_t * pChild = NULL;
+        const char * pLevel = NULL;
+
+        /* Each node is reached by a single path, so it is pushed at most once. */
+        if( pendingMatchCapacity < nodeCapacity )
+        {
+            pGrown = growArray( pPendingMatches, &capacity, sizeof( SubscriptionManagerMatch_t ), nodeCapacity );
+
+            if( pGrown != NULL )
+            {
+                pPendingMatches = pGrown;
+                pendingMatchCapacity = capacity;
+            }
+        }
+
+        if( ( nodeCapacity > 0U ) && ( pendingMatchCapacity >= nodeCapacity ) )
+        {
+            pPendingMatches[ 0 ].node = ROOT_TOPIC_NODE;
+            pPendingMatches[ 0 ].nextLevel = 0U;
+            pendingCount = 1U;
+        }
+
+        while( pendingCount > 0U )
+        {
+            pendingCount--;
+            current = pPendingMatches[ pendingCount ];
+
+            hasLevel = ( current.nextLevel <= topicNameLength );
+
+            if( hasLevel == true )
+            {
+                levelLength = getLevelLength( pTopicName, topicNameLength, current.nextLevel );
+            }
+
+            /* Topic names starting with '$' are not matched by a wildcard at the
+             * first level. */
+            wildcardAllowed = ( current.node != ROOT_TOPIC_NODE ) ||
+                              ( topicNameLength == 0U ) ||
+                              ( pTopicName[ 0 ] != '$' );
+
+            for( child = pNodes[ current.node ].firstChild;
+                 child != NO_ENTRY;
+                 child = pNodes[ child ].nextSibling )
+            {
+                pChild = &pNodes[ child ];
+                pLevel = getNodeLevel( child );
+
+                if( ( pChild->levelLength == 1U ) &&
+                    ( pLevel[ 0 ] == '#' ) &&
+                    ( pChild->firstChild == NO_ENTRY ) )
+                {
+                    /* The multi-level wildcard matches the remaining levels, and
+                     * the parent level itself. */
+                    if( ( wildcardAllowed == true ) &&
+                        ( pChild->filter != NO_ENTRY ) )
+                    {
+                        addInvocations( pChild->filter, &count );
+                    }
+                }
+                else if( ( hasLevel == true ) &&
+                         ( ( ( pChild->levelLength == 1U ) &&
+                             ( pLevel[ 0 ] == '+' ) &&
+                             ( wildcardAllowed == true ) ) ||
+                           ( ( pChild->levelLength == levelLength ) &&
+                             ( memcmp( pLevel, &pTopicName[ current.nextLevel ], levelLength ) == 0 ) ) ) )
+                {
+                    pPendingMatches[ pendingCount ].node = child;
+                    pPendingMatches[ pendingCount ].nextLevel = current.nextLevel + levelLength + 1U;
+
+                    /* A topic filter ending at the last level of the topic name
+                     * matches it. */
+                    if( ( pPendingMatches[ pendingCount ].nextLevel > topicNameLength ) &&
+                        ( pChild->filter != NO_ENTRY ) )
+                    {
+                        addInvocations( pChild->filter, &count );
+                    }
+
+                    pendingCount++;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+        }
+
+        return count;
+    }
+
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 0 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+
+    static uint32_t getNextNode( uint32_t node )
+    {
+        uint32_t next = pNodes[ node ].firstChild;
+
+        while( ( next == NO_ENTRY ) && ( node != ROOT_TOPIC_NODE ) )
+        {
+            next = pNodes[ node ].nextSibling;
+            node = pNodes[ node ].parent;
+        }
+
+        return next;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static SubscriptionManagerSnapshot_t * buildSnapshot( void )
+    {
+        SubscriptionManagerSnapshot_t * pNew = NULL;
+        SubscriptionManagerSnapshotNode_t * pNode = NULL;
+        uint32_t callbackCount = 0U;
+        size_t stringLength = 0U;
+        uint32_t node = ROOT_TOPIC_NODE;
+        uint32_t filter = NO_ENTRY;
+        uint32_t record = NO_ENTRY;
+
+        /* Size the snapshot with a walk of the topic filter index. */
+        for( node = getNextNode( ROOT_TOPIC_NODE ); node != NO_ENTRY; node = getNextNode( node ) )
+        {
+            stringLength += pNodes[ node ].levelLength;
+            filter = pNodes[ node ].filter;
+
+            if( filter != NO_ENTRY )
+            {
+                stringLength += pFilters[ filter ].topicFilterLength;
+
+                for( record = pFilters[ filter ].firstRecord; record != NO_ENTRY; record = pRecords[ record ].next )
+                {
+                    callbackCount++;
+                }
+            }
+        }
+
+        pNew = malloc( sizeof( SubscriptionManagerSnapshot_t ) +
+                       ( ( size_t ) callbackCount * sizeof( SubscriptionManagerSnapshotCallback_t ) ) +
+                       ( ( size_t ) nodeCapacity * sizeof( SubscriptionManagerSnapshotNode_t ) ) +
+                       stringLength );
+
+        if( pNew != NULL )
+        {
+            pNew->pNextRetired = NULL;
+            pNew->retiredEpoch = 0U;
+            pNew->pCallbacks = ( SubscriptionManagerSnapshotCallback_t * ) &pNew[ 1 ];
+            pNew->pNodes = ( SubscriptionManagerSnapshotNode_t * ) &pNew->pCallbacks[ callbackCount ];
+            pNew->pStrings = ( char * ) &pNew->pNodes[ nodeCapacity ];
+
+            callbackCount = 0U;
+            stringLength = 0U;
+            node = ROOT_TOPIC_NODE;
+
+            while( node != NO_ENTRY )
+            {
+                pNode = &pNew->pNodes[ node ];
+                pNode->parent = pNodes[ node ].parent;
+                pNode->firstChild = pNodes[ node ].firstChild;
+                pNode->nextSibling = pNodes[ node ].nextSibling;
+                pNode->level = ( uint32_t ) stringLength;
+                pNode->levelLength = pNodes[ node ].levelLength;
+                pNode->topicFilter = 0U;
+                pNode->topicFilterLength = 0U;
+                pNode->hash = 0U;
+                pNode->firstCallback = callbackCount;
+                pNode->callbackCount = 0U;
+
+                if( node != ROOT_TOPIC_NODE )
+                {
+                    ( void ) memcpy( &pNew->pStrings[ stringLength ], getNodeLevel( node ), pNode->levelLength );
+                    stringLength += pNode->levelLength;
+                }
+
+                filter = pNodes[ node ].filter;
+
+                if( filter != NO_ENTRY )
+                {
+                    pNode->topicFilter = ( uint32_t ) stringLength;
+                    pNode->topicFilterLength = pFilters[ filter ].topicFilterLength;
+                    pNode->hash = pFilters[ filter ].hash;
+                    ( void ) memcpy( &pNew->pStrings[ stringLength ], pFilters[ filter ].pTopicFilter, pNode->topicFilterLength );
+                    stringLength += pNode->topicFilterLength;
+
+                    for( record = pFilters[ filter ].firstRecord; record != NO_ENTRY; record = pRecords[ record ].next )
+                    {
+                        pNew->pCallbacks[ callbackCount ].callback = pRecords[ record ].callback;
+                        pNew->pCallbacks[ callbackCount ].contextCallback = pRecords[ record ].contextCallback;
+                        pNew->pCallbacks[ callbackCount ].pUserContext = pRecords[ record ].pUserContext;
+                        callbackCount++;
+                    }
+
+                    pNode->callbackCount = callbackCount - pNode->firstCallback;
+                }
+
+                node = getNextNode( node );
+            }
+        }
+        else
+        {
+            LogError( ( "Unable to allocate a snapshot of the subscription registry: Callbacks=%u",
+                        ( unsigned int ) callbackCount ) );
+        }
+
+        return pNew;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void reclaimSnapshots( void )
+    {
+        SubscriptionManagerSnapshot_t ** ppLink = &pRetiredSnapshots;
+        SubscriptionManagerSnapshot_t * pRetired = NULL;
+        uint32_t epoch = snapshotEpoch;
+        uint32_t advance = 0U;
+
+        /* Advance the epoch by up to two, which frees the snapshots retired
+         * in it once no dispatch is left from before. */
+        while( ( advance < 2U ) &&
+               ( __atomic_load_n( &activeReaders[ ( epoch + 1U ) & 1U ], __ATOMIC_SEQ_CST ) == 0U ) )
+        {
+            epoch++;
+            __atomic_store_n( &snapshotEpoch, epoch, __ATOMIC_SEQ_CST );
+            advance++;
+        }
+
+        /* The snapshots are retired in order, so the ones after the first
+         * that can be freed can be freed too. */
+        while( ( *ppLink != NULL ) && ( ( epoch - ( *ppLink )->retiredEpoch ) < 2U ) )
+        {
+            ppLink = &( *ppLink )->pNextRetired;
+        }
+
+        while( *ppLink != NULL )
+        {
+            pRetired = *ppLink;
+            *ppLink = pRetired->pNextRetired;
+            free( pRetired );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool publishSnapshot( void )
+    {
+        SubscriptionManagerSnapshot_t * pNew = NULL;
+        SubscriptionManagerSnapshot_t * pPrevious = NULL;
+        bool published = true;
+
+        if( filterCount > 0U )
+        {
+            pNew = buildSnapshot();
+            published = ( pNew != NULL );
+        }
+
+        pPrevious = __atomic_exchange_n( &pSnapshot, pNew, __ATOMIC_SEQ_CST );
+
+        if( pPrevious != NULL )
+        {
+            pPrevious->retiredEpoch = snapshotEpoch;
+            pPrevious->pNextRetired = pRetiredSnapshots;
+            pRetiredSnapshots = pPrevious;
+        }
+
+        reclaimSnapshots();
+
+        return published;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static SubscriptionManagerStatus_t publishRegistration( SubscriptionManagerStatus_t returnStatus,
+                                                            const char * pTopicFilter,
+                                                            uint16_t topicFilterLength )
+    {
+        uint32_t filter = NO_ENTRY;
+
+        if( ( returnStatus == SUBSCRIPTION_MANAGER_SUCCESS ) && ( publishSnapshot() == false ) )
+        {
+            /* The new record is the last one of its topic filter. */
+            filter = findFilter( pTopicFilter,
+                                 topicFilterLength,
+                                 hashTopicFilter( pTopicFilter, topicFilterLength ) );
+            removeRecord( filter, pFilters[ filter ].lastRecord );
+            ( void ) publishSnapshot();
+
+            returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+        }
+
+        return returnStatus;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static uint32_t getPreviousLevel( const char * pTopicName,
+                                      uint32_t nextLevel )
+    {
+        uint32_t level = nextLevel - 1U;
+
+        while( ( level > 0U ) && ( pTopicName[ level - 1U ] != '/' ) )
+        {
+            level--;
+        }
+
+        return level;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void invokeSnapshotCallbacks( const SubscriptionManagerSnapshot_t * pCurrent,
+                                         const SubscriptionManagerSnapshotNode_t * pNode,
+                                         MQTTContext_t * pContext,
+                                         MQTTPublishInfo_t * pPublishInfo,
+                                         uint32_t * pMessage )
+    {
+        const SubscriptionManagerSnapshotCallback_t * pCallback = NULL;
+        uint32_t index = 0U;
+        bool queued = false;
+
+        #if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 0 )
+            ( void ) pMessage;
+        #endif
+
+        for( index = pNode->firstCallback; index < ( pNode->firstCallback + pNode->callbackCount ); index++ )
+        {
+            pCallback = &pCurrent->pCallbacks[ index ];
+
+            #if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+                queued = queueCallback( pNode, pCallback, pContext, pPublishInfo, pMessage );
+            #endif
+
+            if( queued == false )
+            {
+                LogRateLimited( SUBSCRIPTION_MANAGER_DISPATCH_LOG_INTERVAL_MS,
+                                LogInfo( ( "Invoking subscription callback of matching topic filter: "
+                                           "TopicFilter=%.*s, TopicName=%.*s",
+                                           pNode->topicFilterLength,
+                                           &pCurrent->pStrings[ pNode->topicFilter ],
+                                           pPublishInfo->topicNameLength,
+                                           pPublishInfo->pTopicName ) ) );
+
+                /* Invoke the callback associated with the record as the topics match. */
+                if( pCallback->callback != NULL )
+                {
+                    pCallback->callback( pContext, pPublishInfo );
+                }
+                else
+                {
+                    pCallback->contextCallback( pContext, pPublishInfo, pCallback->pUserContext );
+                }
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void dispatchSnapshot( const SubscriptionManagerSnapshot_t * pCurrent,
+                                  MQTTContext_t * pContext,
+                                  MQTTPublishInfo_t * pPublishInfo,
+                                  uint32_t * pMessage )
+    {
+        const char * pTopicName = pPublishInfo->pTopicName;
+        uint16_t topicNameLength = pPublishInfo->topicNameLength;
+        uint32_t node = ROOT_TOPIC_NODE;
+        uint32_t child = pCurrent->pNodes[ ROOT_TOPIC_NODE ].firstChild;
+        uint32_t nextLevel = 0U;
+        uint16_t levelLength = getLevelLength( pTopicName, topicNameLength, 0U );
+        bool hasLevel = true;
+        bool wildcardAllowed = false;
+        const SubscriptionManagerSnapshotNode_t * pChild = NULL;
+        const char * pLevel = NULL;
+
+        /* The children of a node are matched against the topic name level at
+         * nextLevel. */
+        while( node != NO_ENTRY )
+        {
+            if( child == NO_ENTRY )
+            {
+                /* Go back to the next sibling of the node. */
+                if( node != ROOT_TOPIC_NODE )
+                {
+                    child = pCurrent->pNodes[ node ].nextSibling;
+                    nextLevel = getPreviousLevel( pTopicName, nextLevel );
+                    levelLength = getLevelLength( pTopicName, topicNameLength, nextLevel );
+                    hasLevel = true;
+                }
+
+                node = pCurrent->pNodes[ node ].parent;
+            }
+            else
+            {
+                pChild = &pCurrent->pNodes[ child ];
+                pLevel = &pCurrent->pStrings[ pChild->level ];
+
+                /* Topic names starting with '$' are not matched by a wildcard at
+                 * the first level. */
+                wildcardAllowed = ( node != ROOT_TOPIC_NODE ) ||
+                                  ( topicNameLength == 0U ) ||
+                                  ( pTopicName[ 0 ] != '$' );
+
+                if( ( pChild->levelLength == 1U ) &&
+                    ( pLevel[ 0 ] == '#' ) &&
+                    ( pChild->firstChild == NO_ENTRY ) )
+                {
+                    /* The multi-level wildcard matches the remaining levels, and
+                     * the parent level itself. */
+                    if( wildcardAllowed == true )
+                    {
+                        invokeSnapshotCallbacks( pCurrent, pChild, pContext, pPublishInfo, pMessage );
+                    }
+
+                    child = pChild->nextSibling;
+                }
+                else if( ( hasLevel == true ) &&
+                         ( ( ( pChild->levelLength == 1U ) &&
+                             ( pLevel[ 0 ] == '+' ) &&
+                             ( wildcardAllowed == true ) ) ||
+                           ( ( pChild->levelLength == levelLength ) &&
+                             ( memcmp( pLevel, &pTopicName[ nextLevel ], levelLength ) == 0 ) ) ) )
+                {
+                    /* Match the children of the child against the next level. */
+                    node = child;
+                    child = pChild->firstChild;
+                    nextLevel += ( uint32_t ) levelLength + 1U;
+                    hasLevel = ( nextLevel <= topicNameLength );
+
+                    if( hasLevel == true )
+                    {
+                        levelLength = getLevelLength( pTopicName, topicNameLength, nextLevel );
+                    }
+                    else
+                    {
+                        /* A topic filter ending at the last level of the topic
+                         * name matches it. */
+                        invokeSnapshotCallbacks( pCurrent, pChild, pContext, pPublishInfo, pMessage );
+                    }
+                }
+                else
+                {
+                    child = pChild->nextSibling;
+                }
+            }
+        }
+    }
+
+#endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+
+    static void getDispatchDeadline( struct timespec * pDeadline )
+    {
+        ( void ) clock_gettime( CLOCK_REALTIME, pDeadline );
+
+        pDeadline->tv_sec += ( time_t ) ( SUBSCRIPTION_MANAGER_DISPATCH_FULL_WAIT_MS / 1000U );
+        pDeadline->tv_nsec += ( long ) ( ( SUBSCRIPTION_MANAGER_DISPATCH_FULL_WAIT_MS % 1000U ) * 1000000U );
+
+        if( pDeadline->tv_nsec >= 1000000000L )
+        {
+            pDeadline->tv_sec++;
+            pDeadline->tv_nsec -= 1000000000L;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static uint32_t reserveMessage( MQTTContext_t * pContext,
+                                    const MQTTPublishInfo_t * pPublishInfo,
+                                    const struct timespec * pDeadline )
+    {
+        uint32_t message = DROPPED_MESSAGE;
+        uint32_t index = 0U;
+        int waitStatus = 0;
+        SubscriptionManagerMessage_t * pMessage = NULL;
+
+        if( ( ( size_t ) pPublishInfo->topicNameLength + pPublishInfo->payloadLength ) >
+            SUBSCRIPTION_MANAGER_DISPATCH_BUFFER_SIZE )
+        {
+            LogError( ( "Dropping PUBLISH message larger than the dispatch buffers: "
+                        "TopicName=%.*s, PayloadLength=%lu, BufferSize=%u",
+                        pPublishInfo->topicNameLength,
+                        pPublishInfo->pTopicName,
+                        ( unsigned long ) pPublishInfo->payloadLength,
+                        ( unsigned int ) SUBSCRIPTION_MANAGER_DISPATCH_BUFFER_SIZE ) );
+        }
+        else
+        {
+            while( ( message == DROPPED_MESSAGE ) && ( waitStatus == 0 ) )
+            {
+                for( index = 0U; ( index < SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH ) && ( message == DROPPED_MESSAGE ); index++ )
+                {
+                    if( dispatchMessages[ index ].references == 0U )
+                    {
+                        message = index;
+                    }
+                }
+
+                if( message == DROPPED_MESSAGE )
+                {
+                    waitStatus = pthread_cond_timedwait( &dispatchSpaceCondition, &dispatchMutex, pDeadline );
+                }
+            }
+        }
+
+        if( message != DROPPED_MESSAGE )
+        {
+            pMessage = &dispatchMessages[ message ];
+            pMessage->references = 1U;
+            pMessage->pContext = pContext;
+            pMessage->publishInfo = *pPublishInfo;
+
+            ( void ) memcpy( pMessage->buffer, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+            pMessage->publishInfo.pTopicName = ( const char * ) pMessage->buffer;
+
+            if( pPublishInfo->payloadLength > 0U )
+            {
+                ( void ) memcpy( &pMessage->buffer[ pPublishInfo->topicNameLength ],
+                                 pPublishInfo->pPayload,
+                                 pPublishInfo->payloadLength );
+            }
+
+            pMessage->publishInfo.pPayload = &pMessage->buffer[ pPublishInfo->topicNameLength ];
+        }
+
+        return message;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void releaseMessage( uint32_t message )
+    {
+        dispatchMessages[ message ].references--;
+
+        if( dispatchMessages[ message ].references == 0U )
+        {
+            ( void ) pthread_cond_broadcast( &dispatchSpaceCondition );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool queueCallback( const SubscriptionManagerSnapshotNode_t * pNode,
+                               const SubscriptionManagerSnapshotCallback_t * pCallback,
+                               MQTTContext_t * pContext,
+                               MQTTPublishInfo_t * pPublishInfo,
+                               uint32_t * pMessage )
+    {
+        SubscriptionManagerWorker_t * pWorker = &dispatchWorkers[ pNode->hash % SUBSCRIPTION_MANAGER_DISPATCH_WORKERS ];
+        SubscriptionManagerWork_t * pWork = NULL;
+        struct timespec deadline;
+        int waitStatus = 0;
+        bool handled = false;
+
+        ( void ) pthread_mutex_lock( &dispatchMutex );
+
+        if( dispatchWorkersRunning == true )
+        {
+            handled = true;
+            getDispatchDeadline( &deadline );
+
+            if( *pMessage == NO_ENTRY )
+            {
+                *pMessage = reserveMessage( pContext, pPublishInfo, &deadline );
+            }
+
+            /* Wait for the worker of the topic filter to make room, which keeps
+             * the callbacks of the topic filter in order instead of queueing
+             * them to another worker. */
+            while( ( *pMessage != DROPPED_MESSAGE ) &&
+                   ( dispatchWorkersRunning == true ) &&
+                   ( pWorker->count == SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH ) &&
+                   ( waitStatus == 0 ) )
+            {
+                waitStatus = pthread_cond_timedwait( &dispatchSpaceCondition, &dispatchMutex, &deadline );
+            }
+
+            if( ( *pMessage != DROPPED_MESSAGE ) &&
+                ( dispatchWorkersRunning == true ) &&
+                ( pWorker->count < SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH ) )
+            {
+                pWork = &pWorker->queue[ ( pWorker->head + pWorker->count ) % SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH ];
+                pWork->message = *pMessage;
+                pWork->callback = pCallback->callback;
+                pWork->contextCallback = pCallback->contextCallback;
+                pWork->pUserContext = pCallback->pUserContext;
+                pWorker->count++;
+                dispatchMessages[ *pMessage ].references++;
+
+                dispatchMetrics.queuedCount++;
+                dispatchMetrics.queueDepth++;
+
+                if( dispatchMetrics.queueDepth > dispatchMetrics.queueDepthHighWaterMark )
+                {
+                    dispatchMetrics.queueDepthHighWaterMark = dispatchMetrics.queueDepth;
+                }
+
+                ( void ) pthread_cond_signal( &pWorker->condition );
+
+                LogDebug( ( "Queued subscription callback: TopicName=%.*s, QueueDepth=%u",
+                            pPublishInfo->topicNameLength,
+                            pPublishInfo->pTopicName,
+                            ( unsigned int ) dispatchMetrics.queueDepth ) );
+            }
+            else
+            {
+                dispatchMetrics.droppedCount++;
+
+                LogWarn( ( "Dropped subscription callback as the dispatch queue is full: TopicName=%.*s, QueueDepth=%u",
+                           pPublishInfo->topicNameLength,
+                           pPublishInfo->pTopicName,
+                           ( unsigned int ) dispatchMetrics.queueDepth ) );
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &dispatchMutex );
+
+        return handled;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * dispatchWorkerThread( void * pArgument )
+    {
+        SubscriptionManagerWorker_t * pWorker = ( SubscriptionManagerWorker_t * ) pArgument;
+        SubscriptionManagerWork_t work;
+        SubscriptionManagerMessage_t * pMessage = NULL;
+        bool running = true;
+
+        ( void ) pthread_mutex_lock( &dispatchMutex );
+
+        while( running == true )
+        {
+            while( ( pWorker->count == 0U ) && ( dispatchWorkersRunning == true ) )
+            {
+                ( void ) pthread_cond_wait( &pWorker->condition, &dispatchMutex );
+            }
+
+            if( pWorker->count == 0U )
+            {
+                running = false;
+            }
+            else
+            {
+                work = pWorker->queue[ pWorker->head ];
+                pWorker->head = ( pWorker->head + 1U ) % SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH;
+                pWorker->count--;
+                dispatchMetrics.queueDepth--;
+                ( void ) pthread_cond_broadcast( &dispatchSpaceCondition );
+
+                ( void ) pthread_mutex_unlock( &dispatchMutex );
+
+                pMessage = &dispatchMessages[ work.message ];
+
+                if( work.callback != NULL )
+                {
+                    work.callback( pMessage->pContext, &pMessage->publishInfo );
+                }
+                else
+                {
+                    work.contextCallback( pMessage->pContext, &pMessage->publishInfo, work.pUserContext );
+                }
+
+                ( void ) pthread_mutex_lock( &dispatchMutex );
+                releaseMessage( work.message );
+            }
+        }
 
-/**
- * @brief The registry to store records of topic filters and their subscription callbacks.
- */
-static SubscriptionManagerRecord_t callbackRecordList[ MAX_SUBSCRIPTION_CALLBACK_RECORDS ] = { 0 };
+        ( void ) pthread_mutex_unlock( &dispatchMutex );
+
+        return NULL;
+    }
+
+#endif /* if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) */
 
 /*-----------------------------------------------------------*/
 
 void SubscriptionManager_DispatchHandler( MQTTContext_t * pContext,
                                           MQTTPublishInfo_t * pPublishInfo )
 {
-    bool matchStatus = false;
-    size_t listIndex = 0u;
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        uint32_t epoch = 0U;
+        const SubscriptionManagerSnapshot_t * pCurrent = NULL;
+        uint32_t message = NO_ENTRY;
+    #else
+        uint32_t count = 0U;
+        uint32_t index = 0U;
+        uint32_t record = NO_ENTRY;
+    #endif
 
     assert( pPublishInfo != NULL );
     assert( pContext != NULL );
 
-    /* Iterate through record list to find matching topics, and invoke their callbacks. */
-    for( listIndex = 0; listIndex < MAX_SUBSCRIPTION_CALLBACK_RECORDS; listIndex++ )
-    {
-        if( ( callbackRecordList[ listIndex ].pTopicFilter != NULL ) &&
-            ( MQTT_MatchTopic( pPublishInfo->pTopicName,
-                               pPublishInfo->topicNameLength,
-                               callbackRecordList[ listIndex ].pTopicFilter,
-                               callbackRecordList[ listIndex ].topicFilterLength,
-                               &matchStatus ) == MQTTSuccess ) &&
-            ( matchStatus == true ) )
+    TRACE_PROBE2( dispatch_start, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        /* Count the dispatch in its epoch before loading the snapshot, so that
+         * the snapshot is not freed until the dispatch is done. Callbacks may
+         * register or remove callbacks, which replaces the snapshot but not
+         * the one in use. */
+        epoch = __atomic_load_n( &snapshotEpoch, __ATOMIC_SEQ_CST );
+        ( void ) __atomic_fetch_add( &activeReaders[ epoch & 1U ], 1U, __ATOMIC_SEQ_CST );
+
+        pCurrent = __atomic_load_n( &pSnapshot, __ATOMIC_SEQ_CST );
+
+        if( pCurrent != NULL )
+        {
+            dispatchSnapshot( pCurrent, pContext, pPublishInfo, &message );
+        }
+
+        ( void ) __atomic_fetch_sub( &activeReaders[ epoch & 1U ], 1U, __ATOMIC_SEQ_CST );
+
+        #if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+            /* Release the reference of the dispatch handler to the pooled copy
+             * of the message, which the queued callbacks keep. */
+            if( ( message != NO_ENTRY ) && ( message != DROPPED_MESSAGE ) )
+            {
+                ( void ) pthread_mutex_lock( &dispatchMutex );
+                releaseMessage( message );
+                ( void ) pthread_mutex_unlock( &dispatchMutex );
+            }
+        #endif
+    #else /* if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 ) */
+        /* Find the callbacks of the matching topic filters, level by level. */
+        count = matchTopicName( pPublishInfo->pTopicName,
+                                pPublishInfo->topicNameLength );
+
+        /* Invoke the callbacks. A callback may remove the next ones, or register
+         * callbacks that grow the registry. */
+        dispatching = true;
+
+        for( index = 0U; index < count; index++ )
         {
-            LogInfo( ( "Invoking subscription callback of matching topic filter: "
-                       "TopicFilter=%.*s, TopicName=%.*s",
-                       callbackRecordList[ listIndex ].topicFilterLength,
-                       callbackRecordList[ listIndex ].pTopicFilter,
-                       pPublishInfo->topicNameLength,
-                       pPublishInfo->pTopicName ) );
+            record = pInvocations[ index ].record;
+
+            if( ( pRecords[ record ].filter != NO_ENTRY ) &&
+                ( pRecords[ record ].generation == pInvocations[ index ].generation ) )
+            {
+                LogRateLimited( SUBSCRIPTION_MANAGER_DISPATCH_LOG_INTERVAL_MS,
+                                LogInfo( ( "Invoking subscription callback of matching topic filter: "
+                                           "TopicFilter=%.*s, TopicName=%.*s",
+                                           pFilters[ pRecords[ record ].filter ].topicFilterLength,
+                                           pRecords[ record ].pTopicFilter,
+                                           pPublishInfo->topicNameLength,
+                                           pPublishInfo->pTopicName ) ) );
 
-            /* Invoke the callback associated with the record as the topics match. */
-            callbackRecordList[ listIndex ].callback( pContext, pPublishInfo );
+                /* Invoke the callback associated with the record as the topics match. */
+                if( pRecords[ record ].callback != NULL )
+                {
+                    pRecords[ record ].callback( pContext, pPublishInfo );
+                }
+                else
+                {
+                    pRecords[ record ].contextCallback( pContext, pPublishInfo, pRecords[ record ].pUserContext );
+                }
+            }
         }
-    }
+
+        dispatching = false;
+
+        if( ( filterCount == 0U ) && ( pRecords != NULL ) )
+        {
+            freeRegistry();
+        }
+    #endif /* if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 ) */
+
+    TRACE_PROBE1( dispatch_done, pPublishInfo->pTopicName );
 }
 
 /*-----------------------------------------------------------*/
@@ -107,112 +2259,542 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
     assert( callback != NULL );
 
     SubscriptionManagerStatus_t returnStatus;
-    size_t availableIndex = MAX_SUBSCRIPTION_CALLBACK_RECORDS;
-    bool recordExists = false;
-    size_t index = 0u;
 
-    /* Search for the first available spot in the list to store the record, and also check if
-     * a record for the topic filter already exists. */
-    while( ( recordExists == false ) && ( index < MAX_SUBSCRIPTION_CALLBACK_RECORDS ) )
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    returnStatus = addRecord( pTopicFilter, topicFilterLength, callback, NULL, NULL );
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        returnStatus = publishRegistration( returnStatus, pTopicFilter, topicFilterLength );
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+SubscriptionManagerStatus_t SubscriptionManager_RegisterContextCallback( const char * pTopicFilter,
+                                                                         uint16_t topicFilterLength,
+                                                                         SubscriptionManagerContextCallback_t callback,
+                                                                         void * pUserContext )
+{
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength != 0 );
+    assert( callback != NULL );
+
+    SubscriptionManagerStatus_t returnStatus;
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    returnStatus = addRecord( pTopicFilter, topicFilterLength, NULL, callback, pUserContext );
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        returnStatus = publishRegistration( returnStatus, pTopicFilter, topicFilterLength );
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void SubscriptionManager_RemoveCallback( const char * pTopicFilter,
+                                         uint16_t topicFilterLength )
+{
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength != 0 );
+
+    uint32_t filter = NO_ENTRY;
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    filter = findFilter( pTopicFilter,
+                         topicFilterLength,
+                         hashTopicFilter( pTopicFilter, topicFilterLength ) );
+
+    /* Delete the topic filter with all of its callbacks. */
+    if( filter != NO_ENTRY )
+    {
+        removeFilter( filter );
+
+        #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+            ( void ) publishSnapshot();
+        #endif
+
+        LogDebug( ( "Deleted callback record for topic filter: TopicFilter=%.*s",
+                    topicFilterLength,
+                    pTopicFilter ) );
+    }
+    else
+    {
+        LogWarn( ( "Attempted to remove callback for un-registered topic filter: TopicFilter=%.*s",
+                   topicFilterLength,
+                   pTopicFilter ) );
+    }
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+void SubscriptionManager_RemoveContextCallback( const char * pTopicFilter,
+                                                uint16_t topicFilterLength,
+                                                SubscriptionManagerContextCallback_t callback,
+                                                void * pUserContext )
+{
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength != 0 );
+    assert( callback != NULL );
+
+    uint32_t filter = NO_ENTRY;
+    uint32_t record = NO_ENTRY;
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    filter = findFilter( pTopicFilter,
+                         topicFilterLength,
+                         hashTopicFilter( pTopicFilter, topicFilterLength ) );
+
+    if( filter != NO_ENTRY )
+    {
+        record = pFilters[ filter ].firstRecord;
+    }
+
+    while( ( record != NO_ENTRY ) &&
+           ( ( pRecords[ record ].contextCallback != callback ) ||
+             ( pRecords[ record ].pUserContext != pUserContext ) ) )
+    {
+        record = pRecords[ record ].next;
+    }
+
+    if( record != NO_ENTRY )
+    {
+        removeRecord( filter, record );
+
+        #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+            ( void ) publishSnapshot();
+        #endif
+
+        LogDebug( ( "Deleted callback record for topic filter: TopicFilter=%.*s",
+                    topicFilterLength,
+                    pTopicFilter ) );
+    }
+    else
+    {
+        LogWarn( ( "Attempted to remove un-registered callback for topic filter: TopicFilter=%.*s",
+                   topicFilterLength,
+                   pTopicFilter ) );
+    }
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t findInterest( const char * pTopicFilter,
+                              uint16_t topicFilterLength )
+{
+    uint32_t found = NO_ENTRY;
+    uint32_t index = 0U;
+
+    for( index = 0U; ( index < SUBSCRIPTION_MANAGER_MAX_INTERESTS ) && ( found == NO_ENTRY ); index++ )
+    {
+        if( ( interests[ index ].state != InterestFree ) &&
+            ( interests[ index ].topicFilterLength == topicFilterLength ) &&
+            ( memcmp( interests[ index ].topicFilter, pTopicFilter, topicFilterLength ) == 0 ) )
+        {
+            found = index;
+        }
+    }
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool flushInterests( bool subscribe,
+                            SubscriptionManagerSendCallback_t send,
+                            void * pSendContext )
+{
+    MQTTSubscribeInfo_t subscriptions[ SUBSCRIPTION_MANAGER_MAX_INTERESTS ];
+    SubscriptionManagerInterestState_t pending = ( subscribe == true ) ? InterestPendingSubscribe : InterestPendingUnsubscribe;
+    SubscriptionManagerInterestState_t sending = ( subscribe == true ) ? InterestSubscribing : InterestUnsubscribing;
+    SubscriptionManagerInterest_t * pInterest = NULL;
+    size_t count = 0U;
+    uint32_t index = 0U;
+    bool acknowledged = true;
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    /* The entries being sent are neither freed nor reused, so their copies
+     * of the topic filters stay valid while the lock is released. */
+    for( index = 0U; index < SUBSCRIPTION_MANAGER_MAX_INTERESTS; index++ )
     {
-        /* Check if the index represents an empty spot in the registry. If we had already
-         * found an empty spot in the list, we will not update it. */
-        if( ( availableIndex == MAX_SUBSCRIPTION_CALLBACK_RECORDS ) &&
-            ( callbackRecordList[ index ].pTopicFilter == NULL ) )
+        if( interests[ index ].state == pending )
         {
-            availableIndex = index;
+            interests[ index ].state = sending;
+            subscriptions[ count ].qos = MQTTQoS1;
+            subscriptions[ count ].pTopicFilter = interests[ index ].topicFilter;
+            subscriptions[ count ].topicFilterLength = interests[ index ].topicFilterLength;
+            count++;
         }
+    }
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+
+    if( count > 0U )
+    {
+        acknowledged = send( pSendContext, subscribe, subscriptions, count );
+
+        #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+            ( void ) pthread_mutex_lock( &registryMutex );
+        #endif
 
-        /* Check if the current record's topic filter in the registry matches the topic filter
-         * we are trying to register. */
-        else if( ( callbackRecordList[ index ].topicFilterLength == topicFilterLength ) &&
-                 ( strncmp( pTopicFilter, callbackRecordList[ index ].pTopicFilter, topicFilterLength )
-                   == 0 ) )
+        /* Interests may have been added or removed meanwhile, so the new state
+         * of each topic filter depends on its interests left. */
+        for( index = 0U; index < SUBSCRIPTION_MANAGER_MAX_INTERESTS; index++ )
         {
-            recordExists = true;
+            pInterest = &interests[ index ];
+
+            if( pInterest->state == sending )
+            {
+                if( pInterest->references > 0U )
+                {
+                    if( subscribe == true )
+                    {
+                        pInterest->state = ( acknowledged == true ) ? InterestSubscribed : InterestPendingSubscribe;
+                    }
+                    else
+                    {
+                        pInterest->state = ( acknowledged == true ) ? InterestPendingSubscribe : InterestSubscribed;
+                    }
+                }
+                else
+                {
+                    if( subscribe == true )
+                    {
+                        pInterest->state = ( acknowledged == true ) ? InterestPendingUnsubscribe : InterestFree;
+                    }
+                    else
+                    {
+                        pInterest->state = ( acknowledged == true ) ? InterestFree : InterestPendingUnsubscribe;
+                    }
+                }
+            }
         }
 
-        index++;
+        #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+            ( void ) pthread_mutex_unlock( &registryMutex );
+        #endif
+
+        LogDebug( ( "Sent the %s of %u topic filters: Acknowledged=%d",
+                    ( subscribe == true ) ? "SUBSCRIBE" : "UNSUBSCRIBE",
+                    ( unsigned int ) count,
+                    ( int ) acknowledged ) );
     }
 
-    if( recordExists == true )
+    return acknowledged;
+}
+
+/*-----------------------------------------------------------*/
+
+SubscriptionManagerStatus_t SubscriptionManager_AddInterest( const char * pTopicFilter,
+                                                             uint16_t topicFilterLength )
+{
+    SubscriptionManagerStatus_t returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    uint32_t interest = NO_ENTRY;
+    uint32_t index = 0U;
+
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength != 0 );
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    interest = findInterest( pTopicFilter, topicFilterLength );
+
+    if( interest != NO_ENTRY )
     {
-        /* The record for the topic filter already exists. */
-        LogError( ( "Failed to register callback: Record for topic filter already exists: TopicFilter=%.*s",
-                    topicFilterLength,
-                    pTopicFilter ) );
+        interests[ interest ].references++;
 
-        returnStatus = SUBSCRIPTION_MANAGER_RECORD_EXISTS;
+        /* The broker still has the topic filter, so it is kept. */
+        if( interests[ interest ].state == InterestPendingUnsubscribe )
+        {
+            interests[ interest ].state = InterestSubscribed;
+        }
     }
-    else if( availableIndex == MAX_SUBSCRIPTION_CALLBACK_RECORDS )
+    else if( topicFilterLength <= SUBSCRIPTION_MANAGER_INTEREST_FILTER_SIZE )
     {
-        /* The registry is full. */
-        LogError( ( "Unable to register callback: Registry list is full: TopicFilter=%.*s, MaxRegistrySize=%u",
-                    topicFilterLength,
-                    pTopicFilter,
-                    MAX_SUBSCRIPTION_CALLBACK_RECORDS ) );
+        for( index = 0U; ( index < SUBSCRIPTION_MANAGER_MAX_INTERESTS ) && ( interest == NO_ENTRY ); index++ )
+        {
+            if( interests[ index ].state == InterestFree )
+            {
+                interest = index;
+            }
+        }
 
-        returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
+        if( interest != NO_ENTRY )
+        {
+            ( void ) memcpy( interests[ interest ].topicFilter, pTopicFilter, topicFilterLength );
+            interests[ interest ].topicFilterLength = topicFilterLength;
+            interests[ interest ].references = 1U;
+            interests[ interest ].state = InterestPendingSubscribe;
+        }
     }
     else
     {
-        callbackRecordList[ availableIndex ].pTopicFilter = pTopicFilter;
-        callbackRecordList[ availableIndex ].topicFilterLength = topicFilterLength;
-        callbackRecordList[ availableIndex ].callback = callback;
-
-        returnStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+        /* The topic filter is too long to be copied. */
+    }
 
-        LogDebug( ( "Added callback to registry: TopicFilter=%.*s",
+    if( interest == NO_ENTRY )
+    {
+        LogError( ( "No room to declare an interest in topic filter: TopicFilter=%.*s",
                     topicFilterLength,
                     pTopicFilter ) );
+        returnStatus = SUBSCRIPTION_MANAGER_REGISTRY_FULL;
     }
 
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+
     return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-void SubscriptionManager_RemoveCallback( const char * pTopicFilter,
+void SubscriptionManager_RemoveInterest( const char * pTopicFilter,
                                          uint16_t topicFilterLength )
 {
+    uint32_t interest = NO_ENTRY;
+    SubscriptionManagerInterest_t * pInterest = NULL;
+
     assert( pTopicFilter != NULL );
     assert( topicFilterLength != 0 );
 
-    size_t index;
-    SubscriptionManagerRecord_t * pRecord = NULL;
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    interest = findInterest( pTopicFilter, topicFilterLength );
+
+    if( ( interest == NO_ENTRY ) || ( interests[ interest ].references == 0U ) )
+    {
+        LogWarn( ( "Attempted to remove an undeclared interest in topic filter: TopicFilter=%.*s",
+                   topicFilterLength,
+                   pTopicFilter ) );
+    }
+    else
+    {
+        pInterest = &interests[ interest ];
+        pInterest->references--;
+
+        /* A topic filter being sent is settled once its packet is
+         * acknowledged. */
+        if( pInterest->references == 0U )
+        {
+            if( pInterest->state == InterestPendingSubscribe )
+            {
+                pInterest->state = InterestFree;
+            }
+            else if( pInterest->state == InterestSubscribed )
+            {
+                pInterest->state = InterestPendingUnsubscribe;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+    }
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+bool SubscriptionManager_FlushInterests( SubscriptionManagerSendCallback_t send,
+                                         void * pSendContext )
+{
+    bool subscribed = false;
+    bool unsubscribed = false;
+
+    assert( send != NULL );
+
+    subscribed = flushInterests( true, send, pSendContext );
+    unsubscribed = flushInterests( false, send, pSendContext );
+
+    return( ( subscribed == true ) && ( unsubscribed == true ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void SubscriptionManager_ResetInterests( void )
+{
+    uint32_t index = 0U;
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_lock( &registryMutex );
+    #endif
+
+    for( index = 0U; index < SUBSCRIPTION_MANAGER_MAX_INTERESTS; index++ )
+    {
+        if( interests[ index ].state == InterestSubscribed )
+        {
+            interests[ index ].state = InterestPendingSubscribe;
+        }
+        else if( interests[ index ].state == InterestPendingUnsubscribe )
+        {
+            interests[ index ].state = InterestFree;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    #if ( SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH == 1 )
+        ( void ) pthread_mutex_unlock( &registryMutex );
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
 
-    /* Iterate through the records list to find the matching record. */
-    for( index = 0; index < MAX_SUBSCRIPTION_CALLBACK_RECORDS; index++ )
+    bool SubscriptionManager_StartDispatchWorkers( void )
     {
-        pRecord = &callbackRecordList[ index ];
+        uint32_t index = 0U;
+        bool started = true;
+
+        ( void ) pthread_mutex_lock( &dispatchMutex );
 
-        /* Only match the non-empty records. */
-        if( pRecord->pTopicFilter != NULL )
+        if( ( dispatchWorkersRunning == true ) || ( dispatchWorkerCount > 0U ) )
         {
-            if( ( topicFilterLength == pRecord->topicFilterLength ) &&
-                ( strncmp( pTopicFilter, pRecord->pTopicFilter, topicFilterLength ) == 0 ) )
+            LogWarn( ( "Dispatch workers are already started." ) );
+        }
+        else
+        {
+            for( index = 0U; index < SUBSCRIPTION_MANAGER_DISPATCH_WORKERS; index++ )
+            {
+                ( void ) pthread_cond_init( &dispatchWorkers[ index ].condition, NULL );
+                dispatchWorkers[ index ].head = 0U;
+                dispatchWorkers[ index ].count = 0U;
+            }
+
+            dispatchWorkersRunning = true;
+        }
+
+        ( void ) pthread_mutex_unlock( &dispatchMutex );
+
+        /* The workers are created without the lock, as they take it right
+         * away. Only this function and the stop function change the count of
+         * workers, and they are called from the same thread. */
+        while( ( started == true ) && ( dispatchWorkerCount < SUBSCRIPTION_MANAGER_DISPATCH_WORKERS ) )
+        {
+            if( ThreadGroup_CreateThread( SUBSCRIPTION_MANAGER_DISPATCH_THREAD_GROUP,
+                                          &dispatchWorkers[ dispatchWorkerCount ].thread,
+                                          dispatchWorkerThread,
+                                          &dispatchWorkers[ dispatchWorkerCount ] ) == ThreadGroupSuccess )
+            {
+                dispatchWorkerCount++;
+            }
+            else
             {
-                break;
+                LogError( ( "Failed to create a dispatch worker: Worker=%u",
+                            ( unsigned int ) dispatchWorkerCount ) );
+                started = false;
             }
         }
+
+        if( started == false )
+        {
+            SubscriptionManager_StopDispatchWorkers();
+        }
+
+        return started;
     }
 
-    /* Delete the record by clearing the found entry in the records list. */
-    if( index < MAX_SUBSCRIPTION_CALLBACK_RECORDS )
+/*-----------------------------------------------------------*/
+
+    void SubscriptionManager_StopDispatchWorkers( void )
     {
-        pRecord->pTopicFilter = NULL;
-        pRecord->topicFilterLength = 0u;
-        pRecord->callback = NULL;
+        uint32_t index = 0U;
+        SubscriptionManagerWorker_t * pWorker = NULL;
 
-        LogDebug( ( "Deleted callback record for topic filter: TopicFilter=%.*s",
-                    topicFilterLength,
-                    pTopicFilter ) );
+        ( void ) pthread_mutex_lock( &dispatchMutex );
+        dispatchWorkersRunning = false;
+
+        for( index = 0U; index < dispatchWorkerCount; index++ )
+        {
+            ( void ) pthread_cond_signal( &dispatchWorkers[ index ].condition );
+        }
+
+        /* Wake the dispatch handler if it waits for room in a queue. */
+        ( void ) pthread_cond_broadcast( &dispatchSpaceCondition );
+        ( void ) pthread_mutex_unlock( &dispatchMutex );
+
+        for( index = 0U; index < dispatchWorkerCount; index++ )
+        {
+            ( void ) pthread_join( dispatchWorkers[ index ].thread, NULL );
+        }
+
+        ( void ) pthread_mutex_lock( &dispatchMutex );
+
+        /* Drop the callbacks queued to workers that failed to start. */
+        for( index = dispatchWorkerCount; index < SUBSCRIPTION_MANAGER_DISPATCH_WORKERS; index++ )
+        {
+            pWorker = &dispatchWorkers[ index ];
+
+            while( pWorker->count > 0U )
+            {
+                releaseMessage( pWorker->queue[ pWorker->head ].message );
+                pWorker->head = ( pWorker->head + 1U ) % SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH;
+                pWorker->count--;
+                dispatchMetrics.queueDepth--;
+                dispatchMetrics.droppedCount++;
+            }
+        }
+
+        for( index = 0U; index < SUBSCRIPTION_MANAGER_DISPATCH_WORKERS; index++ )
+        {
+            ( void ) pthread_cond_destroy( &dispatchWorkers[ index ].condition );
+        }
+
+        dispatchWorkerCount = 0U;
+        ( void ) pthread_mutex_unlock( &dispatchMutex );
     }
-    else
+
+/*-----------------------------------------------------------*/
+
+    void SubscriptionManager_GetDispatchMetrics( SubscriptionManagerDispatchMetrics_t * pMetrics )
     {
-        LogWarn( ( "Attempted to remove callback for un-registered topic filter: TopicFilter=%.*s",
-                   topicFilterLength,
-                   pTopicFilter ) );
+        assert( pMetrics != NULL );
+
+        ( void ) pthread_mutex_lock( &dispatchMutex );
+        *pMetrics = dispatchMetrics;
+        ( void ) pthread_mutex_unlock( &dispatchMutex );
     }
-}
+
+#endif /* if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) */
 /*-----------------------------------------------------------*/
@@ -57,6 +57,81 @@
 /* Include MQTT library. */
 #include "core_mqtt.h"
 
+/**
+ * @brief Set to 1 to invoke the callbacks on a pool of dispatch workers
+ * instead of the thread calling #SubscriptionManager_DispatchHandler, once
+ * #SubscriptionManager_StartDispatchWorkers has started them.
+ *
+ * Each incoming PUBLISH message is copied once into a pooled buffer shared by
+ * its callbacks. The callbacks of a topic filter always run on the same worker,
+ * in the order of the messages. SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH must
+ * be set to 1 as well.
+ */
+#ifndef SUBSCRIPTION_MANAGER_ASYNC_DISPATCH
+    #define SUBSCRIPTION_MANAGER_ASYNC_DISPATCH    ( 0 )
+#endif
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+
+/**
+ * @brief The number of dispatch worker threads.
+ */
+    #ifndef SUBSCRIPTION_MANAGER_DISPATCH_WORKERS
+        #define SUBSCRIPTION_MANAGER_DISPATCH_WORKERS    ( 2U )
+    #endif
+
+/**
+ * @brief Thread group of the dispatch workers; see #ThreadGroup_Define.
+ */
+    #ifndef SUBSCRIPTION_MANAGER_DISPATCH_THREAD_GROUP
+        #define SUBSCRIPTION_MANAGER_DISPATCH_THREAD_GROUP    "dispatch"
+    #endif
+
+/**
+ * @brief The number of pooled message buffers, which is also the number of
+ * callbacks each worker can have queued.
+ */
+    #ifndef SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH
+        #define SUBSCRIPTION_MANAGER_DISPATCH_QUEUE_LENGTH    ( 16U )
+    #endif
+
+/**
+ * @brief The size of a pooled message buffer, which holds the topic name and
+ * payload of a message. Larger messages are dropped.
+ */
+    #ifndef SUBSCRIPTION_MANAGER_DISPATCH_BUFFER_SIZE
+        #define SUBSCRIPTION_MANAGER_DISPATCH_BUFFER_SIZE    ( 2048U )
+    #endif
+
+/**
+ * @brief The time in milliseconds #SubscriptionManager_DispatchHandler waits
+ * for a free message buffer or queue entry before dropping a callback. A value
+ * of 0 drops it right away, which never blocks the MQTT thread.
+ */
+    #ifndef SUBSCRIPTION_MANAGER_DISPATCH_FULL_WAIT_MS
+        #define SUBSCRIPTION_MANAGER_DISPATCH_FULL_WAIT_MS    ( 100U )
+    #endif
+
+#endif /* if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) */
+
+/**
+ * @brief Maximum number of topic filters declared with
+ * #SubscriptionManager_AddInterest, including those awaiting their
+ * UNSUBSCRIBE.
+ */
+#ifndef SUBSCRIPTION_MANAGER_MAX_INTERESTS
+    #define SUBSCRIPTION_MANAGER_MAX_INTERESTS    ( 16U )
+#endif
+
+/**
+ * @brief Maximum length of a topic filter declared with
+ * #SubscriptionManager_AddInterest, which is copied so that its UNSUBSCRIBE
+ * can be sent after the interest is removed.
+ */
+#ifndef SUBSCRIPTION_MANAGER_INTEREST_FILTER_SIZE
+    #define SUBSCRIPTION_MANAGER_INTEREST_FILTER_SIZE    ( 256U )
+#endif
+
 /* Enumeration type for return status value from Subscription Manager API. */
 typedef enum SubscriptionManagerStatus
 {
@@ -66,7 +141,7 @@ typedef enum SubscriptionManagerStatus
     SUBSCRIPTION_MANAGER_SUCCESS = 1,
 
     /**
-     * @brief Failure return value due to registry being full.
+     * @brief Failure return value due to the registry being unable to grow.
      */
     SUBSCRIPTION_MANAGER_REGISTRY_FULL = 2,
 
@@ -90,10 +165,68 @@ typedef enum SubscriptionManagerStatus
 typedef void (* SubscriptionManagerCallback_t )( MQTTContext_t * pContext,
                                                  MQTTPublishInfo_t * pPublishInfo );
 
+/**
+ * @brief Callback type to be registered with a context for a topic filter with
+ * the subscription manager.
+ *
+ * @param[in] pContext The context associated with the MQTT connection.
+ * @param[in] pPublishInfo The incoming PUBLISH message information.
+ * @param[in] pUserContext The context passed at registration.
+ */
+typedef void (* SubscriptionManagerContextCallback_t )( MQTTContext_t * pContext,
+                                                        MQTTPublishInfo_t * pPublishInfo,
+                                                        void * pUserContext );
+
+/**
+ * @brief Sends the SUBSCRIBE or the UNSUBSCRIBE of several topic filters, for
+ * #SubscriptionManager_FlushInterests.
+ *
+ * The callback is invoked without a lock held, so it may wait for the
+ * acknowledgement while the incoming messages are dispatched.
+ *
+ * @param[in] pSendContext The context given to
+ * #SubscriptionManager_FlushInterests.
+ * @param[in] subscribe true to send a SUBSCRIBE; false to send an
+ * UNSUBSCRIBE.
+ * @param[in] pSubscriptions The topic filters, with QoS1, valid until the
+ * callback returns.
+ * @param[in] subscriptionCount Number of entries of @p pSubscriptions.
+ *
+ * @return true if the broker acknowledged the packet; false otherwise.
+ */
+typedef bool (* SubscriptionManagerSendCallback_t )( void * pSendContext,
+                                                     bool subscribe,
+                                                     const MQTTSubscribeInfo_t * pSubscriptions,
+                                                     size_t subscriptionCount );
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+
+/**
+ * @brief Counters of the callbacks queued to the dispatch workers.
+ */
+    typedef struct SubscriptionManagerDispatchMetrics
+    {
+        uint32_t queuedCount;             /**< @brief The number of callbacks queued. */
+        uint32_t droppedCount;            /**< @brief The number of callbacks dropped as the queue was full or the message too large. */
+        uint32_t queueDepth;              /**< @brief The number of callbacks waiting for a worker. */
+        uint32_t queueDepthHighWaterMark; /**< @brief The highest number of callbacks that waited for a worker at once. */
+    } SubscriptionManagerDispatchMetrics_t;
+
+#endif /* if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) */
+
 /**
  * @brief Dispatches the incoming PUBLISH message to the callbacks that have their
  * registered topic filters matching the incoming PUBLISH topic name. The dispatch
- * handler will invoke all these callbacks with matching topic filters.
+ * handler will invoke all these callbacks with matching topic filters, the ones of
+ * a topic filter in the order they were registered.
+ *
+ * A callback may register or remove callbacks. A callback removed by a previous
+ * one is not invoked, unless SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH is 1.
+ *
+ * @note With SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH set to 1, the dispatch
+ * handler takes no lock and may run on several threads while callbacks are
+ * registered or removed on others. It invokes the callbacks registered when it
+ * started, so a callback may still be invoked once after it is removed.
  *
  * @param[in] pContext The context associated with the MQTT connection.
  * @param[in] pPublishInfo The incoming PUBLISH message information.
@@ -113,15 +246,18 @@ void SubscriptionManager_DispatchHandler( MQTTContext_t * pContext,
  * @param[in] callback The callback to be registered for the topic filter.
  *
  * @note The subscription manager does not allow more than one callback to be registered
- * for the same topic filter.
+ * with this function for the same topic filter. More callbacks can be registered
+ * for it with #SubscriptionManager_RegisterContextCallback.
  * @note The passed topic filter, @a pTopicFilter, is saved in the registry.
  * The application must not free or alter the content of the topic filter memory
  * until the callback for the topic filter is removed from the subscription manager.
+ * @note The registry is allocated on the heap, and grows as callbacks are registered.
+ * It is freed once its last callback is removed.
  *
  * @return Returns one of the following:
  * - #SUBSCRIPTION_MANAGER_SUCCESS if registration of the callback is successful.
- * - #SUBSCRIPTION_MANAGER_REGISTRY_FULL if the registration failed due to registry
- * being already full.
+ * - #SUBSCRIPTION_MANAGER_REGISTRY_FULL if the registration failed due to registry,
+ * or its index of topic filter levels, being unable to grow.
  * - #SUBSCRIPTION_MANAGER_RECORD_EXISTS, if a registered callback already exists for
  * the requested topic filter in the subscription manager.
  */
@@ -130,7 +266,35 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
                                                                   SubscriptionManagerCallback_t pCallback );
 
 /**
- * @brief Utility to remove the callback registered for a topic filter from the
+ * @brief Utility to register a callback with a context for a topic filter in the
+ * subscription manager.
+ *
+ * Any number of callbacks can be registered for the same topic filter, as long
+ * as each has a different @a callback or @a pUserContext.
+ *
+ * @param[in] pTopicFilter The topic filter to register the callback for.
+ * @param[in] topicFilterLength The length of the topic filter string.
+ * @param[in] callback The callback to be registered for the topic filter.
+ * @param[in] pUserContext The context to pass to the callback.
+ *
+ * @note The passed topic filter, @a pTopicFilter, is saved in the registry.
+ * The application must not free or alter the content of the topic filter memory
+ * until the callback is removed from the subscription manager.
+ *
+ * @return Returns one of the following:
+ * - #SUBSCRIPTION_MANAGER_SUCCESS if registration of the callback is successful.
+ * - #SUBSCRIPTION_MANAGER_REGISTRY_FULL if the registration failed due to registry
+ * being unable to grow.
+ * - #SUBSCRIPTION_MANAGER_RECORD_EXISTS, if the callback is already registered with
+ * the same context for the requested topic filter.
+ */
+SubscriptionManagerStatus_t SubscriptionManager_RegisterContextCallback( const char * pTopicFilter,
+                                                                         uint16_t topicFilterLength,
+                                                                         SubscriptionManagerContextCallback_t callback,
+                                                                         void * pUserContext );
+
+/**
+ * @brief Utility to remove the callbacks registered for a topic filter from the
  * subscription manager.
  *
  * @param[in] pTopicFilter The topic filter to remove from the subscription manager.
@@ -139,5 +303,111 @@ SubscriptionManagerStatus_t SubscriptionManager_RegisterCallback( const char * p
 void SubscriptionManager_RemoveCallback( const char * pTopicFilter,
                                          uint16_t topicFilterLength );
 
+/**
+ * @brief Utility to remove a callback registered with
+ * #SubscriptionManager_RegisterContextCallback from the subscription manager.
+ *
+ * The other callbacks of the topic filter stay registered.
+ *
+ * @param[in] pTopicFilter The topic filter the callback is registered for.
+ * @param[in] topicFilterLength The length of the topic filter string.
+ * @param[in] callback The registered callback.
+ * @param[in] pUserContext The context the callback is registered with.
+ */
+void SubscriptionManager_RemoveContextCallback( const char * pTopicFilter,
+                                                uint16_t topicFilterLength,
+                                                SubscriptionManagerContextCallback_t callback,
+                                                void * pUserContext );
+
+/**
+ * @brief Declare an interest in a topic filter, which the broker is to be
+ * subscribed to.
+ *
+ * The interests in a topic filter are counted. The first one marks the topic
+ * filter to be subscribed to by the next #SubscriptionManager_FlushInterests,
+ * unless its UNSUBSCRIBE is still pending, which is then cancelled; the
+ * others send nothing.
+ *
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength The length of the topic filter string.
+ *
+ * @return Returns one of the following:
+ * - #SUBSCRIPTION_MANAGER_SUCCESS if the interest is counted.
+ * - #SUBSCRIPTION_MANAGER_REGISTRY_FULL if #SUBSCRIPTION_MANAGER_MAX_INTERESTS
+ * topic filters are declared, or the topic filter is longer than
+ * #SUBSCRIPTION_MANAGER_INTEREST_FILTER_SIZE.
+ */
+SubscriptionManagerStatus_t SubscriptionManager_AddInterest( const char * pTopicFilter,
+                                                             uint16_t topicFilterLength );
+
+/**
+ * @brief Remove an interest declared with #SubscriptionManager_AddInterest.
+ *
+ * Once a topic filter has no interest left, it is marked to be unsubscribed
+ * from by the next #SubscriptionManager_FlushInterests, or forgotten if its
+ * SUBSCRIBE was not sent yet.
+ *
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength The length of the topic filter string.
+ */
+void SubscriptionManager_RemoveInterest( const char * pTopicFilter,
+                                         uint16_t topicFilterLength );
+
+/**
+ * @brief Send the pending changes of the interests: a single SUBSCRIBE for
+ * all the topic filters to subscribe to, then a single UNSUBSCRIBE for all
+ * those to unsubscribe from.
+ *
+ * Nothing is sent if there are no such topic filters. The topic filters of a
+ * packet that is not acknowledged stay pending, to be sent again by the next
+ * flush.
+ *
+ * @note The flushes must not run on several threads at once. Interests may be
+ * added or removed during a flush, including by the callbacks it dispatches.
+ *
+ * @param[in] send The callback sending the packets.
+ * @param[in] pSendContext The context passed to @p send.
+ *
+ * @return true if every packet sent was acknowledged; false otherwise.
+ */
+bool SubscriptionManager_FlushInterests( SubscriptionManagerSendCallback_t send,
+                                         void * pSendContext );
+
+/**
+ * @brief Mark the topic filters with an interest to be subscribed to again,
+ * and forget those awaiting their UNSUBSCRIBE, once the broker starts a
+ * clean session.
+ */
+void SubscriptionManager_ResetInterests( void );
+
+#if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 )
+
+/**
+ * @brief Start the dispatch workers, after which the callbacks of incoming
+ * PUBLISH messages are queued to them.
+ *
+ * @note The callbacks then run on the workers, and must serialize their own
+ * calls to the MQTT library with the MQTT thread. They get a copy of the
+ * PUBLISH message, which is valid until they return.
+ *
+ * @return true if the workers were started; false otherwise.
+ */
+    bool SubscriptionManager_StartDispatchWorkers( void );
+
+/**
+ * @brief Stop the dispatch workers once they have invoked the queued callbacks.
+ * Callbacks of later messages are invoked by #SubscriptionManager_DispatchHandler.
+ */
+    void SubscriptionManager_StopDispatchWorkers( void );
+
+/**
+ * @brief Get the counters of the callbacks queued to the dispatch workers.
+ *
+ * @param[out] pMetrics The counters.
+ */
+    void SubscriptionManager_GetDispatchMetrics( SubscriptionManagerDispatchMetrics_t * pMetrics );
+
+#endif /* if ( SUBSCRIPTION_MANAGER_ASYNC_DISPATCH == 1 ) */
+
 
 #endif /* ifndef MQTT_SUBSCRIPTION_MANAGER_H_ */
@@ -0,0 +1,229 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_agent.h
+ * @brief The API of an agent that owns an MQTT connection on one thread and
+ * runs the MQTT operations that other threads submit to it.
+ */
+
+#ifndef MQTT_AGENT_H_
+#define MQTT_AGENT_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the MQTT Agent module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "MQTT Agent"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+#include <semaphore.h>
+
+/* Include MQTT library. */
+#include "core_mqtt.h"
+
+/* OpenSSL transport include, for the socket and TLS session to wait on. */
+#include "openssl_posix.h"
+
+/**
+ * @brief Return status of the MQTT Agent API.
+ */
+typedef enum MqttAgentStatus
+{
+    MQTT_AGENT_SUCCESS = 0,       /**< @brief Function successfully completed. */
+    MQTT_AGENT_INVALID_PARAMETER, /**< @brief At least one parameter was invalid. */
+    MQTT_AGENT_API_ERROR          /**< @brief A POSIX call failed. */
+} MqttAgentStatus_t;
+
+/**
+ * @brief The MQTT operations that can be submitted to the agent.
+ */
+typedef enum MqttAgentCommandType
+{
+    MqttAgentCommandPublish = 0, /**< @brief Call MQTT_Publish. */
+    MqttAgentCommandSubscribe,   /**< @brief Call MQTT_Subscribe. */
+    MqttAgentCommandUnsubscribe  /**< @brief Call MQTT_Unsubscribe. */
+} MqttAgentCommandType_t;
+
+/**
+ * @brief An MQTT operation submitted to the agent.
+ *
+ * Commands live on the stack of the submitting thread, which waits for the
+ * agent to run them. The members are managed by the agent functions.
+ */
+typedef struct MqttAgentCommand
+{
+    struct MqttAgentCommand * pNext;               /**< @brief The next command in the queue. */
+    MqttAgentCommandType_t type;                   /**< @brief The operation to run. */
+    const MQTTPublishInfo_t * pPublishInfo;        /**< @brief The message of a publish command. */
+    const MQTTSubscribeInfo_t * pSubscriptionList; /**< @brief The topic filters of a subscribe or unsubscribe command. */
+    size_t subscriptionCount;                      /**< @brief The number of entries in #MqttAgentCommand_t.pSubscriptionList. */
+    MQTTStatus_t status;                           /**< @brief The status returned by the MQTT library. */
+    sem_t done;                                    /**< @brief Posted by the agent once the command has run. */
+} MqttAgentCommand_t;
+
+/**
+ * @brief An agent owning an MQTT context.
+ *
+ * The thread that calls #MqttAgent_Init is the only one that may call the
+ * MQTT library with the context. Other threads submit their operations
+ * through a lock-free queue with #MqttAgent_Publish, #MqttAgent_Subscribe
+ * and #MqttAgent_Unsubscribe, and the owner thread runs them from
+ * #MqttAgent_ProcessLoop as soon as they are queued.
+ *
+ * The members are managed by the agent functions.
+ */
+typedef struct MqttAgent
+{
+    MQTTContext_t * pMqttContext;           /**< @brief The MQTT context owned by the agent. */
+    const OpensslParams_t * pOpensslParams; /**< @brief The TLS session of the MQTT connection. */
+    pthread_t ownerThread;                  /**< @brief The thread that may call the MQTT library. */
+    int32_t eventDescriptor;                /**< @brief The eventfd that wakes the owner thread up when a command is queued. */
+    MqttAgentCommand_t * pHead;             /**< @brief The command queued last, swapped by the submitting threads. */
+    MqttAgentCommand_t * pTail;             /**< @brief The command to run next, only used by the owner thread. */
+    MqttAgentCommand_t stub;                /**< @brief Placeholder linked into the queue when it is empty. */
+} MqttAgent_t;
+
+/**
+ * @brief Initialize an agent for an MQTT context.
+ *
+ * The calling thread becomes the owner thread of the context.
+ *
+ * @param[out] pAgent The agent to initialize.
+ * @param[in] pMqttContext The MQTT context, which may not be connected yet.
+ * @param[in] pOpensslParams The TLS session the MQTT context receives from.
+ *
+ * @return #MQTT_AGENT_SUCCESS if successful; #MQTT_AGENT_INVALID_PARAMETER,
+ * #MQTT_AGENT_API_ERROR on error.
+ */
+MqttAgentStatus_t MqttAgent_Init( MqttAgent_t * pAgent,
+                                  MQTTContext_t * pMqttContext,
+                                  const OpensslParams_t * pOpensslParams );
+
+/**
+ * @brief Release the resources of an agent.
+ *
+ * The commands still queued fail with MQTTIllegalState. No command may be
+ * submitted afterwards.
+ *
+ * @param[in] pAgent The agent to release.
+ *
+ * @return #MQTT_AGENT_SUCCESS if successful; #MQTT_AGENT_INVALID_PARAMETER on error.
+ */
+MqttAgentStatus_t MqttAgent_Deinit( MqttAgent_t * pAgent );
+
+/**
+ * @brief Publish a message on the MQTT connection of the agent.
+ *
+ * Called from another thread, the call blocks until the owner thread has
+ * sent the message, which it does on its next call to #MqttAgent_ProcessLoop.
+ * Called from the owner thread, the message is sent right away.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pPublishInfo The message, which must remain valid until the call returns.
+ *
+ * @return The status returned by MQTT_Publish; MQTTBadParameter if a
+ * parameter is NULL.
+ */
+MQTTStatus_t MqttAgent_Publish( MqttAgent_t * pAgent,
+                                const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Subscribe to topic filters on the MQTT connection of the agent.
+ *
+ * Like #MqttAgent_Publish, the call blocks until the owner thread has sent
+ * the SUBSCRIBE packet. The SUBACK is received later by #MqttAgent_ProcessLoop.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pSubscriptionList The topic filters to subscribe to.
+ * @param[in] subscriptionCount The number of entries in @p pSubscriptionList.
+ *
+ * @return The status returned by MQTT_Subscribe; MQTTBadParameter if a
+ * parameter is NULL.
+ */
+MQTTStatus_t MqttAgent_Subscribe( MqttAgent_t * pAgent,
+                                  const MQTTSubscribeInfo_t * pSubscriptionList,
+                                  size_t subscriptionCount );
+
+/**
+ * @brief Unsubscribe from topic filters on the MQTT connection of the agent.
+ *
+ * Like #MqttAgent_Publish, the call blocks until the owner thread has sent
+ * the UNSUBSCRIBE packet.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pSubscriptionList The topic filters to unsubscribe from.
+ * @param[in] subscriptionCount The number of entries in @p pSubscriptionList.
+ *
+ * @return The status returned by MQTT_Unsubscribe; MQTTBadParameter if a
+ * parameter is NULL.
+ */
+MQTTStatus_t MqttAgent_Unsubscribe( MqttAgent_t * pAgent,
+                                    const MQTTSubscribeInfo_t * pSubscriptionList,
+                                    size_t subscriptionCount );
+
+/**
+ * @brief Run the queued commands and receive the incoming packets, waiting
+ * up to @p timeoutMs for either. Must be called from the owner thread while
+ * the MQTT connection is established.
+ *
+ * Instead of blocking in a receive as MQTT_ProcessLoop does, the owner thread
+ * waits on both the socket and the eventfd of the queue, so that a command is
+ * run as soon as it is submitted. MQTT_ProcessLoop is only called when data
+ * is available, and the keep-alive PINGREQ is sent by the agent.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] timeoutMs Longest time in milliseconds to wait for a command or
+ * an incoming packet.
+ *
+ * @return MQTTSuccess if successful; MQTTBadParameter if @p pAgent is NULL;
+ * MQTTRecvFailed if the wait failed; MQTTKeepAliveTimeout if no PINGRESP was
+ * received in time; the status of MQTT_ProcessLoop or MQTT_Ping otherwise.
+ */
+MQTTStatus_t MqttAgent_ProcessLoop( MqttAgent_t * pAgent,
+                                    uint32_t timeoutMs );
+
+#endif /* ifndef MQTT_AGENT_H_ */
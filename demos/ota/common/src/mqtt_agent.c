@@ -0,0 +1,574 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_agent.c
+ * @brief Implementation of an agent that owns an MQTT connection on one
+ * thread and runs the MQTT operations that other threads submit to it.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/* Include demo config. */
+#include "demo_config.h"
+
+/* Include header for the MQTT agent. */
+#include "mqtt_agent.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append a command to the queue of an agent.
+ *
+ * Called by any number of threads at once. A command is linked in two steps,
+ * so the owner thread may briefly see the queue end before the command.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command to append.
+ */
+static void pushCommand( MqttAgent_t * pAgent,
+                         MqttAgentCommand_t * pCommand );
+
+/**
+ * @brief Remove the oldest command from the queue of an agent. Only called
+ * by the owner thread.
+ *
+ * @param[in] pAgent The agent.
+ *
+ * @return The command, or NULL if the queue is empty or the next command is
+ * still being linked, in which case its thread wakes the owner up again.
+ */
+static MqttAgentCommand_t * popCommand( MqttAgent_t * pAgent );
+
+/**
+ * @brief Call the MQTT library for a command.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command to run.
+ *
+ * @return The status returned by the MQTT library.
+ */
+static MQTTStatus_t runCommand( MqttAgent_t * pAgent,
+                                const MqttAgentCommand_t * pCommand );
+
+/**
+ * @brief Run the queued commands and wake up the threads that submitted them.
+ *
+ * @param[in] pAgent The agent.
+ */
+static void runQueuedCommands( MqttAgent_t * pAgent );
+
+/**
+ * @brief Queue a command for the owner thread and wait for its status, or
+ * run it right away when called from the owner thread.
+ *
+ * @param[in] pAgent The agent.
+ * @param[in] pCommand The command, with its operation and parameters set.
+ *
+ * @return The status returned by the MQTT library.
+ */
+static MQTTStatus_t submitCommand( MqttAgent_t * pAgent,
+                                   MqttAgentCommand_t * pCommand );
+
+/**
+ * @brief Whether the TLS session holds received data that a wait on the
+ * socket would not report.
+ *
+ * @param[in] pOpensslParams The TLS session.
+ *
+ * @return true if data can be received without waiting; false otherwise.
+ */
+static bool hasBufferedData( const OpensslParams_t * pOpensslParams );
+
+/**
+ * @brief Send a PINGREQ once the connection has been idle for the keep-alive
+ * interval, and check that the PINGRESP of the last one was received in time.
+ *
+ * @param[in] pMqttContext The MQTT context.
+ *
+ * @return MQTTSuccess if the connection is alive; MQTTKeepAliveTimeout if
+ * no PINGRESP was received in time; the status of MQTT_Ping otherwise.
+ */
+static MQTTStatus_t manageKeepAlive( MQTTContext_t * pMqttContext );
+
+/*-----------------------------------------------------------*/
+
+static void pushCommand( MqttAgent_t * pAgent,
+                         MqttAgentCommand_t * pCommand )
+{
+    MqttAgentCommand_t * pPrevious = NULL;
+
+    __atomic_store_n( &pCommand->pNext, NULL, __ATOMIC_RELAXED );
+
+    /* Claim the end of the queue, then link the command after the previous
+     * end. The release ordering publishes the command to the owner thread. */
+    pPrevious = __atomic_exchange_n( &pAgent->pHead, pCommand, __ATOMIC_ACQ_REL );
+    __atomic_store_n( &pPrevious->pNext, pCommand, __ATOMIC_RELEASE );
+}
+
+/*-----------------------------------------------------------*/
+
+static MqttAgentCommand_t * popCommand( MqttAgent_t * pAgent )
+{
+    MqttAgentCommand_t * pCommand = NULL;
+    MqttAgentCommand_t * pTail = pAgent->pTail;
+    MqttAgentCommand_t * pNext = __atomic_load_n( &pTail->pNext, __ATOMIC_ACQUIRE );
+
+    /* Skip the stub, which is not a command. */
+    if( ( pTail == &pAgent->stub ) && ( pNext != NULL ) )
+    {
+        pAgent->pTail = pNext;
+        pTail = pNext;
+        pNext = __atomic_load_n( &pTail->pNext, __ATOMIC_ACQUIRE );
+    }
+
+    if( pTail == &pAgent->stub )
+    {
+        /* The queue is empty. */
+    }
+    else if( pNext != NULL )
+    {
+        pAgent->pTail = pNext;
+        pCommand = pTail;
+    }
+    else if( pTail == __atomic_load_n( &pAgent->pHead, __ATOMIC_ACQUIRE ) )
+    {
+        /* The tail is the last command. Queue the stub behind it, so that the
+         * command can be removed without emptying the queue. */
+        pushCommand( pAgent, &pAgent->stub );
+        pNext = __atomic_load_n( &pTail->pNext, __ATOMIC_ACQUIRE );
+
+        if( pNext != NULL )
+        {
+            pAgent->pTail = pNext;
+            pCommand = pTail;
+        }
+    }
+    else
+    {
+        /* Another command is being linked after the tail. */
+    }
+
+    return pCommand;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t runCommand( MqttAgent_t * pAgent,
+                                const MqttAgentCommand_t * pCommand )
+{
+    MQTTStatus_t mqttStatus = MQTTBadParameter;
+    MQTTContext_t * pMqttContext = pAgent->pMqttContext;
+
+    switch( pCommand->type )
+    {
+        case MqttAgentCommandPublish:
+            /* Packet IDs are only used by QoS1 and QoS2 messages. */
+            mqttStatus = MQTT_Publish( pMqttContext,
+                                       pCommand->pPublishInfo,
+                                       ( pCommand->pPublishInfo->qos != MQTTQoS0 ) ? MQTT_GetPacketId( pMqttContext ) : 0U );
+            break;
+
+        case MqttAgentCommandSubscribe:
+            mqttStatus = MQTT_Subscribe( pMqttContext,
+                                         pCommand->pSubscriptionList,
+                                         pCommand->subscriptionCount,
+                                         MQTT_GetPacketId( pMqttContext ) );
+            break;
+
+        case MqttAgentCommandUnsubscribe:
+            mqttStatus = MQTT_Unsubscribe( pMqttContext,
+                                           pCommand->pSubscriptionList,
+                                           pCommand->subscriptionCount,
+                                           MQTT_GetPacketId( pMqttContext ) );
+            break;
+
+        default:
+            LogError( ( "Unknown MQTT agent command type: %d.", ( int ) pCommand->type ) );
+            break;
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void runQueuedCommands( MqttAgent_t * pAgent )
+{
+    MqttAgentCommand_t * pCommand = popCommand( pAgent );
+
+    while( pCommand != NULL )
+    {
+        pCommand->status = runCommand( pAgent, pCommand );
+
+        /* The command is on the stack of the submitting thread, which may
+         * return as soon as it is woken up. */
+        ( void ) sem_post( &pCommand->done );
+
+        pCommand = popCommand( pAgent );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t submitCommand( MqttAgent_t * pAgent,
+                                   MqttAgentCommand_t * pCommand )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    uint64_t signal = 1U;
+    int semStatus = 0;
+
+    if( pthread_equal( pthread_self(), pAgent->ownerThread ) != 0 )
+    {
+        /* Waiting on the owner thread would never return. */
+        mqttStatus = runCommand( pAgent, pCommand );
+    }
+    else if( sem_init( &pCommand->done, 0, 0U ) != 0 )
+    {
+        LogError( ( "Creating the semaphore of an MQTT agent command failed: %s.",
+                    strerror( errno ) ) );
+        mqttStatus = MQTTNoMemory;
+    }
+    else
+    {
+        pushCommand( pAgent, pCommand );
+
+        /* The eventfd counter cannot overflow, as every write is followed by
+         * a wait for the owner thread, which resets it. */
+        if( write( pAgent->eventDescriptor, &signal, sizeof( signal ) ) != ( ssize_t ) sizeof( signal ) )
+        {
+            LogError( ( "Waking up the MQTT agent failed: %s.", strerror( errno ) ) );
+        }
+
+        do
+        {
+            semStatus = sem_wait( &pCommand->done );
+        } while( ( semStatus != 0 ) && ( errno == EINTR ) );
+
+        ( void ) sem_destroy( &pCommand->done );
+        mqttStatus = pCommand->status;
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool hasBufferedData( const OpensslParams_t * pOpensslParams )
+{
+    bool buffered = false;
+
+    if( pOpensslParams->recvBufferLength > 0U )
+    {
+        buffered = true;
+    }
+    else if( ( pOpensslParams->pSsl != NULL ) && ( SSL_pending( pOpensslParams->pSsl ) > 0 ) )
+    {
+        buffered = true;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return buffered;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t manageKeepAlive( MQTTContext_t * pMqttContext )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    uint32_t now = pMqttContext->getTime();
+    uint32_t keepAliveMs = 1000U * ( uint32_t ) pMqttContext->keepAliveIntervalSec;
+
+    if( pMqttContext->waitingForPingResp == true )
+    {
+        if( ( now - pMqttContext->pingReqSendTimeMs ) > MQTT_PINGRESP_TIMEOUT_MS )
+        {
+            LogError( ( "No PINGRESP received within %u ms.", ( unsigned int ) MQTT_PINGRESP_TIMEOUT_MS ) );
+            mqttStatus = MQTTKeepAliveTimeout;
+        }
+    }
+    else if( ( keepAliveMs != 0U ) && ( ( now - pMqttContext->lastPacketTime ) > keepAliveMs ) )
+    {
+        mqttStatus = MQTT_Ping( pMqttContext );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttAgentStatus_t MqttAgent_Init( MqttAgent_t * pAgent,
+                                  MQTTContext_t * pMqttContext,
+                                  const OpensslParams_t * pOpensslParams )
+{
+    MqttAgentStatus_t returnStatus = MQTT_AGENT_SUCCESS;
+
+    if( ( pAgent == NULL ) || ( pMqttContext == NULL ) || ( pOpensslParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pAgent, pMqttContext and pOpensslParams must not be NULL." ) );
+        returnStatus = MQTT_AGENT_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pAgent, 0, sizeof( MqttAgent_t ) );
+        pAgent->pMqttContext = pMqttContext;
+        pAgent->pOpensslParams = pOpensslParams;
+        pAgent->ownerThread = pthread_self();
+
+        /* The queue starts with the stub only. */
+        pAgent->pHead = &pAgent->stub;
+        pAgent->pTail = &pAgent->stub;
+
+        pAgent->eventDescriptor = eventfd( 0U, EFD_NONBLOCK | EFD_CLOEXEC );
+
+        if( pAgent->eventDescriptor < 0 )
+        {
+            LogError( ( "Creating the eventfd of the MQTT agent failed: %s.", strerror( errno ) ) );
+            returnStatus = MQTT_AGENT_API_ERROR;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MqttAgentStatus_t MqttAgent_Deinit( MqttAgent_t * pAgent )
+{
+    MqttAgentStatus_t returnStatus = MQTT_AGENT_SUCCESS;
+    MqttAgentCommand_t * pCommand = NULL;
+
+    if( pAgent == NULL )
+    {
+        LogError( ( "Parameter check failed: pAgent is NULL." ) );
+        returnStatus = MQTT_AGENT_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Fail the commands that were never run, so that their threads do not
+         * wait forever. */
+        pCommand = popCommand( pAgent );
+
+        while( pCommand != NULL )
+        {
+            pCommand->status = MQTTIllegalState;
+            ( void ) sem_post( &pCommand->done );
+            pCommand = popCommand( pAgent );
+        }
+
+        if( pAgent->eventDescriptor >= 0 )
+        {
+            ( void ) close( pAgent->eventDescriptor );
+            pAgent->eventDescriptor = -1;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttAgent_Publish( MqttAgent_t * pAgent,
+                                const MQTTPublishInfo_t * pPublishInfo )
+{
+    MQTTStatus_t mqttStatus = MQTTBadParameter;
+    MqttAgentCommand_t command;
+
+    if( ( pAgent == NULL ) || ( pPublishInfo == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pAgent and pPublishInfo must not be NULL." ) );
+    }
+    else
+    {
+        ( void ) memset( &command, 0, sizeof( command ) );
+        command.type = MqttAgentCommandPublish;
+        command.pPublishInfo = pPublishInfo;
+
+        mqttStatus = submitCommand( pAgent, &command );
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttAgent_Subscribe( MqttAgent_t * pAgent,
+                                  const MQTTSubscribeInfo_t * pSubscriptionList,
+                                  size_t subscriptionCount )
+{
+    MQTTStatus_t mqttStatus = MQTTBadParameter;
+    MqttAgentCommand_t command;
+
+    if( ( pAgent == NULL ) || ( pSubscriptionList == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pAgent and pSubscriptionList must not be NULL." ) );
+    }
+    else
+    {
+        ( void ) memset( &command, 0, sizeof( command ) );
+        command.type = MqttAgentCommandSubscribe;
+        command.pSubscriptionList = pSubscriptionList;
+        command.subscriptionCount = subscriptionCount;
+
+        mqttStatus = submitCommand( pAgent, &command );
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttAgent_Unsubscribe( MqttAgent_t * pAgent,
+                                    const MQTTSubscribeInfo_t * pSubscriptionList,
+                                    size_t subscriptionCount )
+{
+    MQTTStatus_t mqttStatus = MQTTBadParameter;
+    MqttAgentCommand_t command;
+
+    if( ( pAgent == NULL ) || ( pSubscriptionList == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pAgent and pSubscriptionList must not be NULL." ) );
+    }
+    else
+    {
+        ( void ) memset( &command, 0, sizeof( command ) );
+        command.type = MqttAgentCommandUnsubscribe;
+        command.pSubscriptionList = pSubscriptionList;
+        command.subscriptionCount = subscriptionCount;
+
+        mqttStatus = submitCommand( pAgent, &command );
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MQTTStatus_t MqttAgent_ProcessLoop( MqttAgent_t * pAgent,
+                                    uint32_t timeoutMs )
+{
+    MQTTStatus_t mqttStatus = MQTTSuccess;
+    struct pollfd pollDescriptors[ 2 ];
+    int pollStatus = 0;
+    uint64_t signalCount = 0U;
+    bool receive = false;
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        bool pingPending = false;
+    #endif
+
+    if( pAgent == NULL )
+    {
+        LogError( ( "Parameter check failed: pAgent is NULL." ) );
+        mqttStatus = MQTTBadParameter;
+    }
+    else
+    {
+        /* Commands queued while the connection was being established. */
+        runQueuedCommands( pAgent );
+
+        pollDescriptors[ 0 ].fd = pAgent->eventDescriptor;
+        pollDescriptors[ 0 ].events = POLLIN;
+        pollDescriptors[ 0 ].revents = 0;
+        pollDescriptors[ 1 ].fd = pAgent->pOpensslParams->socketDescriptor;
+        pollDescriptors[ 1 ].events = POLLIN;
+        pollDescriptors[ 1 ].revents = 0;
+
+        /* Data already decrypted by the TLS session does not make the socket
+         * readable, so it is received without waiting. */
+        receive = hasBufferedData( pAgent->pOpensslParams );
+
+        pollStatus = poll( pollDescriptors, 2U, ( receive == true ) ? 0 : ( int ) timeoutMs );
+
+        if( ( pollStatus < 0 ) && ( errno != EINTR ) )
+        {
+            LogError( ( "Waiting for the MQTT connection failed: %s.", strerror( errno ) ) );
+            mqttStatus = MQTTRecvFailed;
+        }
+        else if( pollStatus > 0 )
+        {
+            if( ( pollDescriptors[ 0 ].revents & POLLIN ) != 0 )
+            {
+                /* Reset the counter before running the commands, so that a
+                 * command queued meanwhile wakes the next wait up. */
+                ( void ) read( pAgent->eventDescriptor, &signalCount, sizeof( signalCount ) );
+                runQueuedCommands( pAgent );
+            }
+
+            /* A closed or failed socket is reported by the receive. */
+            if( ( pollDescriptors[ 1 ].revents & ( POLLIN | POLLHUP | POLLERR ) ) != 0 )
+            {
+                receive = true;
+            }
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+            pingPending = pAgent->pMqttContext->waitingForPingResp;
+        #endif
+
+        /* Process every packet that can be received without blocking. */
+        while( ( mqttStatus == MQTTSuccess ) && ( receive == true ) )
+        {
+            mqttStatus = MQTT_ProcessLoop( pAgent->pMqttContext, 0U );
+            receive = hasBufferedData( pAgent->pOpensslParams );
+        }
+
+        #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+
+            /* The keep-alive round trip shares the link with the OTA
+             * downloads, so it tells the throttle how much they delay MQTT. */
+            if( ( pingPending == true ) && ( pAgent->pMqttContext->waitingForPingResp == false ) )
+            {
+                TransportThrottle_ReportRtt( pAgent->pMqttContext->getTime() -
+                                             pAgent->pMqttContext->pingReqSendTimeMs );
+            }
+        #endif
+
+        if( mqttStatus == MQTTSuccess )
+        {
+            mqttStatus = manageKeepAlive( pAgent->pMqttContext );
+        }
+    }
+
+    return mqttStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -180,4 +180,10 @@
  */
 #define OTA_LIB                   "otalib@1.0.0"
 
+/**
+ * @brief Dispatch incoming PUBLISH messages without a lock, as the OTA agent
+ * registers subscription callbacks on its own thread.
+ */
+#define SUBSCRIPTION_MANAGER_CONCURRENT_DISPATCH    ( 1 )
+
 #endif /* ifndef DEMO_CONFIG_H */
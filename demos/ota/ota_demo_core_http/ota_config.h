@@ -174,4 +174,61 @@
  */
 #define configOTA_PRIMARY_DATA_PROTOCOL         ( OTA_DATA_OVER_HTTP )
 
+/**
+ * @brief Preallocate the receive file and write each block with a single
+ * pwrite at its offset, instead of fseek and fwrite.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_PWRITE_ENABLED            ( 1 )
+
+/**
+ * @brief Hash the image while its blocks are written, so that only the
+ * signature is verified when the file is closed.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED  ( 1 )
+
+/**
+ * @brief Keep the public key of the signer certificate between signature
+ * checks, instead of parsing the certificate for every file.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED  ( 1 )
+
+/**
+ * @brief Accept delta images, which are applied to the running executable
+ * before their signature is checked.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_DELTA_ENABLED             ( 1 )
+
+/**
+ * @brief Accept images compressed with gzip, which are decompressed before
+ * their signature is checked.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_GZIP_ENABLED              ( 1 )
+
+/**
+ * @brief Keep the image state in a checksummed state store, with the progress
+ * of the file being received, so that an interrupted transfer resumes after
+ * a restart.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_STATE_STORE_ENABLED       ( 1 )
+
+/**
+ * @brief Write the blocks of the file on a writer thread, so that the next
+ * blocks are received while the previous ones are written.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_WRITE_BEHIND_ENABLED      ( 1 )
+
 #endif /* OTA_CONFIG_H_ */
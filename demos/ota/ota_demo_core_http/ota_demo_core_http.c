@@ -29,6 +29,11 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 /* Include Demo Config as the first non-system header. */
 #include "demo_config.h"
@@ -39,13 +44,19 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /* pthread include. */
 #include <pthread.h>
-#include <semaphore.h>
 
 /* MQTT include. */
 #include "core_mqtt.h"
 #include "mqtt_subscription_manager.h"
+#include "mqtt_agent.h"
+
+/* Include header for the reserved topics of a thing. */
+#include "thing_topics.h"
 
 /* HTTP include. */
 #include "core_http_client.h"
@@ -53,6 +64,15 @@
 /* Common HTTP demo utilities. */
 #include "http_demo_utils.h"
 
+/* Pool of the connections to the HTTP server. */
+#include "http_connection_pool.h"
+
+/* Requests serialized once, with the Range header patched in place. */
+#include "http_request_template.h"
+
+/* Adapting the blocks fetched ahead to the link. */
+#include "http_range_tuner.h"
+
 /*Include backoff algorithm header for retry logic.*/
 #include "backoff_algorithm.h"
 
@@ -68,6 +88,10 @@
 /* Include firmware version struct definition. */
 #include "ota_appversion32.h"
 
+/* Include coreJSON, built with the OTA library, for the job documents of the
+ * next update. */
+#include "core_json.h"
+
 /**
  * These configuration settings are required to run the OTA demo which uses mutual authentication.
  * Throw compilation error if the below configs are not defined.
@@ -138,15 +162,11 @@
 #define MQTT_KEEP_ALIVE_INTERVAL_SECONDS         ( 60U )
 
 /**
- * @brief Timeout for MQTT_ProcessLoop function in milliseconds.
+ * @brief Longest time in milliseconds MqttAgent_ProcessLoop waits for a
+ * command or an incoming packet.
  */
 #define MQTT_PROCESS_LOOP_TIMEOUT_MS             ( 100U )
 
-/**
- * @brief Period for demo loop sleep in milliseconds.
- */
-#define OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS         ( 5U )
-
 /**
  * @brief The delay used in the main OTA Demo task loop to periodically output the OTA
  * statistics like number of packets received, dropped, processed and queued per connection.
@@ -223,46 +243,139 @@
 #define HTTP_USER_BUFFER_LENGTH          ( otaconfigFILE_BLOCK_SIZE + HTTP_HEADER_SIZE_MAX )
 
 /**
- * @brief The MQTT metrics string expected by AWS IoT.
+ * @brief The length of the buffers holding the block requests, which include
+ * the path of the pre-signed URL.
  */
-#define METRICS_STRING                   "?SDK=" OS_NAME "&Version=" OS_VERSION "&Platform=" HARDWARE_PLATFORM_NAME "&OTALib=" OTA_LIB
+#define HTTP_REQUEST_TEMPLATE_LENGTH     ( 2048U )
 
 /**
- * @brief The length of the MQTT metrics string expected by AWS IoT.
+ * @brief The number of file block requests in flight at the same time, each
+ * over its own connection of the pool.
+ *
+ * The OTA agent requests the blocks of the file one after the other. When this
+ * is larger than 1, the blocks following the requested one are fetched ahead
+ * by worker threads, so that they are ready when the agent requests them. Set
+ * to 1 to send each request when the agent asks for its block.
  */
-#define METRICS_STRING_LENGTH            ( ( uint16_t ) ( sizeof( METRICS_STRING ) - 1 ) )
+#ifndef OTA_HTTP_PARALLEL_REQUESTS
+    #define OTA_HTTP_PARALLEL_REQUESTS    ( 4U )
+#endif
+
+#if ( OTA_HTTP_PARALLEL_REQUESTS < 1 ) || ( OTA_HTTP_PARALLEL_REQUESTS > CONNECTION_POOL_SIZE )
+    #error "OTA_HTTP_PARALLEL_REQUESTS must be between 1 and CONNECTION_POOL_SIZE."
+#endif
 
+/**
+ * @brief Set to 1 to adapt the number of blocks fetched ahead to the link,
+ * when OTA_HTTP_PARALLEL_REQUESTS is larger than 1.
+ *
+ * The size of the blocks is fixed by the OTA library, so the bytes in flight
+ * are adapted instead: one more block is fetched ahead after each block
+ * delivered within TRANSPORT_SEND_RECV_TIMEOUT_MS, up to
+ * OTA_HTTP_PARALLEL_REQUESTS, and half as many after a slower or failed one.
+ */
+#ifndef OTA_HTTP_ADAPTIVE_FETCH_AHEAD
+    #define OTA_HTTP_ADAPTIVE_FETCH_AHEAD    ( 1 )
+#endif
 
-#ifdef CLIENT_USERNAME
+#if ( TRANSPORT_THROTTLE_ENABLED == 1 )
 
 /**
- * @brief Append the username with the metrics string if #CLIENT_USERNAME is defined.
+ * @brief Bytes per second of the link above which the file download yields
+ * to MQTT, when the transports are built with TRANSPORT_THROTTLE_ENABLED.
+ */
+    #ifndef OTA_HTTP_THROTTLE_RATE_BYTES_PER_SEC
+        #define OTA_HTTP_THROTTLE_RATE_BYTES_PER_SEC    ( 256U * 1024U )
+    #endif
+
+/**
+ * @brief Bytes the file download may receive at once after being idle.
+ */
+    #ifndef OTA_HTTP_THROTTLE_BURST_BYTES
+        #define OTA_HTTP_THROTTLE_BURST_BYTES    ( 16U * 1024U )
+    #endif
+
+/**
+ * @brief Round trip time in milliseconds of the MQTT keep-alive above which
+ * the download slows down; 0 to keep the rate fixed.
+ */
+    #ifndef OTA_HTTP_THROTTLE_RTT_TARGET_MS
+        #define OTA_HTTP_THROTTLE_RTT_TARGET_MS    ( 500U )
+    #endif
+
+/**
+ * @brief Lowest rate in bytes per second the MQTT round trip time can slow
+ * the download down to.
+ */
+    #ifndef OTA_HTTP_THROTTLE_MIN_RATE_BYTES_PER_SEC
+        #define OTA_HTTP_THROTTLE_MIN_RATE_BYTES_PER_SEC    ( 8U * 1024U )
+    #endif
+#endif /* if ( TRANSPORT_THROTTLE_ENABLED == 1 ) */
+
+/**
+ * @brief Set to 1 to download the image of the next queued update in the
+ * background, once the current update is downloaded.
  *
- * This is to support both metrics reporting and username/password based client
- * authentication by AWS IoT.
+ * The image is staged in OTA_HTTP_PREFETCH_STAGING_PATH over the pool
+ * connections, which yield to MQTT when the transports are built with
+ * TRANSPORT_THROTTLE_ENABLED. When the job of the next update runs, its blocks
+ * are read from the staging file instead of the network.
  */
-    #define CLIENT_USERNAME_WITH_METRICS    CLIENT_USERNAME METRICS_STRING
+#ifndef OTA_HTTP_PREFETCH_NEXT_UPDATE
+    #define OTA_HTTP_PREFETCH_NEXT_UPDATE    ( 0 )
 #endif
 
+#if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+
+/**
+ * @brief The file the image of the next update is staged in.
+ */
+    #ifndef OTA_HTTP_PREFETCH_STAGING_PATH
+        #define OTA_HTTP_PREFETCH_STAGING_PATH    "ota_prefetch.bin"
+    #endif
+
+/**
+ * @brief Time in milliseconds to wait for a response of the jobs service.
+ */
+    #ifndef OTA_HTTP_PREFETCH_RESPONSE_TIMEOUT_MS
+        #define OTA_HTTP_PREFETCH_RESPONSE_TIMEOUT_MS    ( 5000U )
+    #endif
+#endif /* if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 ) */
+
 /**
- * @brief The common prefix for all OTA topics.
+ * @brief Set to 1 to start connecting to the host of the file as soon as a
+ * job document is received.
+ *
+ * The TCP and TLS handshakes with the S3 server then run while the OTA agent
+ * parses the job document and prepares the file, and #httpInit checks out
+ * the connection instead of establishing it. A connection not used within
+ * CONNECTION_POOL_PREWARM_TIMEOUT_MS is closed.
  */
-#define OTA_TOPIC_PREFIX                 "$aws/things/"
+#ifndef OTA_HTTP_PREWARM_CONNECTION
+    #define OTA_HTTP_PREWARM_CONNECTION    ( 1 )
+#endif
 
 /**
- * @brief The string used for jobs topics.
+ * @brief The MQTT metrics string expected by AWS IoT.
  */
-#define OTA_TOPIC_JOBS                   "jobs"
+#define METRICS_STRING                   "?SDK=" OS_NAME "&Version=" OS_VERSION "&Platform=" HARDWARE_PLATFORM_NAME "&OTALib=" OTA_LIB
 
 /**
- * @brief The string used for streaming service topics.
+ * @brief The length of the MQTT metrics string expected by AWS IoT.
  */
-#define OTA_TOPIC_STREAM                 "streams"
+#define METRICS_STRING_LENGTH            ( ( uint16_t ) ( sizeof( METRICS_STRING ) - 1 ) )
+
+
+#ifdef CLIENT_USERNAME
 
 /**
- * @brief The length of #OTA_TOPIC_PREFIX
+ * @brief Append the username with the metrics string if #CLIENT_USERNAME is defined.
+ *
+ * This is to support both metrics reporting and username/password based client
+ * authentication by AWS IoT.
  */
-#define OTA_TOPIC_PREFIX_LENGTH          ( ( uint16_t ) ( sizeof( OTA_TOPIC_PREFIX ) - 1U ) )
+    #define CLIENT_USERNAME_WITH_METRICS    CLIENT_USERNAME METRICS_STRING
+#endif
 
 /**
  * @brief HTTP response codes used in this demo.
@@ -298,32 +411,38 @@ struct NetworkContext
  */
 static NetworkContext_t networkContextMqtt;
 
+
 /**
- * @brief Network connection context used for HTTP connection.
+ * @brief A buffer used in the demo for storing HTTP response headers and body.
+ *
+ * @note The requests are stored in #httpRequestTemplateBuffer, serialized
+ * once for all the blocks of the file. When blocks are fetched ahead, each
+ * request has its own buffers instead.
  */
-static NetworkContext_t networkContextHttp;
+#if ( OTA_HTTP_PARALLEL_REQUESTS == 1 )
+    static uint8_t httpUserBuffer[ HTTP_USER_BUFFER_LENGTH ];
 
+/**
+ * @brief The buffer of #httpRequestTemplate.
+ */
+    static uint8_t httpRequestTemplateBuffer[ HTTP_REQUEST_TEMPLATE_LENGTH ];
 
 /**
- * @brief The host address string extracted from the pre-signed URL.
- *
- * @note S3_PRESIGNED_GET_URL_LENGTH is set as the array length here as the
- * length of the host name string cannot exceed this value.
+ * @brief The block request, with the positions of its Range header patched
+ * for each block.
  */
-static char serverHost[ 256 ];
+    static HttpRequestTemplate_t httpRequestTemplate;
+#endif
 
 /**
- * @brief A buffer used in the demo for storing HTTP request headers and
- * HTTP response headers and body.
- *
- * @note This demo shows how the same buffer can be re-used for storing the HTTP
- * response after the HTTP request is sent out. However, the user can also
- * decide to use separate buffers for storing the HTTP request and response.
+ * @brief Information about the S3 server to send the HTTP requests.
  */
-static uint8_t httpUserBuffer[ HTTP_USER_BUFFER_LENGTH ];
+static ServerInfo_t serverInfoHttp;
 
-/* The transport layer interface used by the HTTP Client library. */
-TransportInterface_t transportInterfaceHttp;
+/**
+ * @brief Credentials to establish the TLS connections to the S3 server.
+ */
+static OpensslCredentials_t opensslCredentialsHttp;
 
 /**
  * @brief MQTT connection context used in this demo.
@@ -340,43 +459,217 @@ static bool mqttSessionEstablished = false;
  */
 static OpensslParams_t opensslParamsForMqtt;
 
+
 /**
- * @brief Structure for openssl parameters for TLS session used by HTTP connection.
+ * @brief Agent owning the MQTT context on the demo thread, which runs the
+ * coreMQTT API calls of the OTA agent thread.
  */
-static OpensslParams_t opensslParamsForHttp;
+static MqttAgent_t mqttAgent;
 
 /**
- * @brief Mutex for synchronizing coreMQTT API calls.
+ * @brief The pre-signed URL of the file being downloaded, parsed once by
+ * #httpInit for all of its block requests.
  */
-static pthread_mutex_t mqttMutex;
+static ParsedUrl_t presignedUrl;
 
 /**
  * @brief The host address string extracted from the pre-signed URL.
- *
- * @note S3_PRESIGNED_GET_URL_LENGTH is set as the array length here as the
- * length of the host name string cannot exceed this value.
  */
-static char serverHost[ 256 ];
+static char serverHost[ URL_MAX_HOST_LENGTH + 1U ];
+
+#if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
+
+/**
+ * @brief The states of a file block request.
+ */
+    typedef enum BlockRequestState
+    {
+        BlockRequestFree = 0,   /**< @brief The request is not in use. */
+        BlockRequestPending,    /**< @brief The block is being fetched by the worker. */
+        BlockRequestDone        /**< @brief The response of the block was received. */
+    } BlockRequestState_t;
+
+/**
+ * @brief A file block request, served by its own worker thread.
+ */
+    typedef struct BlockRequest
+    {
+        BlockRequestState_t state;                  /**< @brief The state of the request. */
+        uint32_t rangeStart;                        /**< @brief Starting index of the file data. */
+        uint32_t rangeEnd;                          /**< @brief Last index of the file data. */
+        OtaHttpStatus_t result;                     /**< @brief The result of #fetchBlock. */
+        HTTPStatus_t httpStatus;                    /**< @brief The status of #HTTPClient_Send. */
+        HTTPResponse_t response;                    /**< @brief The response received in #buffer. */
+        uint8_t buffer[ HTTP_USER_BUFFER_LENGTH ];  /**< @brief The response buffer. */
+        HttpRequestTemplate_t requestTemplate;      /**< @brief The request, serialized in #templateBuffer. */
+        uint8_t templateBuffer[ HTTP_REQUEST_TEMPLATE_LENGTH ]; /**< @brief The request buffer. */
+    } BlockRequest_t;
 
 /**
- * @brief The length of the host address found in the pre-signed URL.
+ * @brief The file block requests, one for each worker thread.
  */
-static size_t serverHostLength;
+    static BlockRequest_t blockRequests[ OTA_HTTP_PARALLEL_REQUESTS ];
 
 /**
- * @brief Semaphore for synchronizing buffer operations.
+ * @brief The worker threads fetching the file blocks.
  */
-static sem_t bufferSemaphore;
+    static pthread_t blockRequestThreads[ OTA_HTTP_PARALLEL_REQUESTS ];
 
 /**
- * @brief Enum for type of OTA messages received.
+ * @brief Mutex protecting #blockRequests.
  */
-typedef enum OtaMessageType
-{
-    OtaMessageTypeJob = 0,
-    OtaMessageTypeStream,
-    OtaNumOfMessageType
-} OtaMessageType_t;
+    static pthread_mutex_t blockRequestMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Condition signaled when the state of a block request changes.
+ */
+    static pthread_cond_t blockRequestCondition = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Flag for stopping the worker threads.
+ */
+    static bool blockRequestThreadsStop = false;
+
+    #if ( OTA_HTTP_ADAPTIVE_FETCH_AHEAD == 1 )
+
+/**
+ * @brief The bytes of the blocks fetched ahead, in steps of a block, only
+ * used by the OTA agent thread.
+ */
+        static HttpRangeTuner_t fetchAheadTuner;
+    #endif
+#endif /* if ( OTA_HTTP_PARALLEL_REQUESTS > 1 ) */
+
+#if ( OTA_HTTP_PREWARM_CONNECTION == 1 )
+
+/**
+ * @brief The key of the URL of the file in a job document.
+ */
+    #define PREWARM_URL_KEY    "execution.jobDocument.afr_ota.files[0].update_data_url"
+#endif
+
+#if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+
+/**
+ * @brief The prefix of the topics of the jobs service naming a job of this
+ * thing, which are not among the reserved topics of #thingTopics.
+ */
+    #define PREFETCH_JOBS_TOPIC_PREFIX    THING_TOPICS_PREFIX CLIENT_IDENTIFIER "/jobs/"
+
+/**
+ * @brief The suffix of the topic of an accepted request.
+ */
+    #define PREFETCH_ACCEPTED_SUFFIX      "/accepted"
+
+/**
+ * @brief The longest job ID accepted by the jobs service.
+ */
+    #define PREFETCH_JOB_ID_MAX_LENGTH    ( 64U )
+
+/**
+ * @brief The length of the buffers of the topics describing a job.
+ */
+    #define PREFETCH_TOPIC_LENGTH         ( sizeof( PREFETCH_JOBS_TOPIC_PREFIX "/get" PREFETCH_ACCEPTED_SUFFIX ) + PREFETCH_JOB_ID_MAX_LENGTH )
+
+/**
+ * @brief The keys of the job documents read to find the next image.
+ */
+    #define PREFETCH_JOB_ID_KEY           "queuedJobs[0].jobId"
+    #define PREFETCH_URL_KEY              "execution.jobDocument.afr_ota.files[0].update_data_url"
+    #define PREFETCH_FILE_SIZE_KEY        "execution.jobDocument.afr_ota.files[0].filesize"
+
+/**
+ * @brief The file holding the length and the key of the URL of the staged
+ * image, written once the image is complete.
+ */
+    #define PREFETCH_META_PATH            OTA_HTTP_PREFETCH_STAGING_PATH ".meta"
+
+/**
+ * @brief The file the description of the staged image is written to before
+ * it is renamed to #PREFETCH_META_PATH.
+ */
+    #define PREFETCH_META_TEMP_PATH       PREFETCH_META_PATH ".tmp"
+
+/**
+ * @brief The length of the key identifying an image across its pre-signed
+ * URLs.
+ */
+    #define PREFETCH_KEY_LENGTH           ( OTA_MAX_URL_SIZE )
+
+/**
+ * @brief The image of the next update, downloaded by #prefetchThread.
+ */
+    typedef struct PrefetchedImage
+    {
+        char url[ OTA_MAX_URL_SIZE ];                           /**< @brief The pre-signed URL of the image. */
+        uint32_t fileSize;                                      /**< @brief The length of the image. */
+        ParsedUrl_t parsedUrl;                                  /**< @brief The components of #url. */
+        char host[ URL_MAX_HOST_LENGTH + 1U ];                  /**< @brief The host of #url. */
+        ServerInfo_t serverInfo;                                /**< @brief The server of the image. */
+        OpensslCredentials_t credentials;                       /**< @brief The credentials of the server. */
+        HttpRequestTemplate_t requestTemplate;                  /**< @brief The request, serialized in #templateBuffer. */
+        uint8_t templateBuffer[ HTTP_REQUEST_TEMPLATE_LENGTH ]; /**< @brief The request buffer. */
+        uint8_t buffer[ HTTP_USER_BUFFER_LENGTH ];              /**< @brief The response buffer. */
+        pthread_t thread;                                       /**< @brief The thread downloading the image. */
+        bool running;                                           /**< @brief Whether #thread is to be joined. */
+    } PrefetchedImage_t;
+
+/**
+ * @brief The staged image the blocks of the current file are read from.
+ */
+    typedef struct StagedImage
+    {
+        int fileDescriptor; /**< @brief The staging file, or -1 if the file is downloaded. */
+        uint32_t fileSize;  /**< @brief The length of the staged image. */
+    } StagedImage_t;
+
+/**
+ * @brief The image being prefetched, only used by the OTA agent thread until
+ * the download thread is started.
+ */
+    static PrefetchedImage_t prefetchedImage;
+
+/**
+ * @brief The staged image of the current file, only used by the OTA agent
+ * thread.
+ */
+    static StagedImage_t stagedImage = { -1, 0U };
+
+/**
+ * @brief The response of the last request to the jobs service.
+ */
+    static char prefetchResponse[ OTA_NETWORK_BUFFER_SIZE ];
+
+/**
+ * @brief The length of #prefetchResponse.
+ */
+    static size_t prefetchResponseLength = 0U;
+
+/**
+ * @brief Whether #prefetchResponse holds the response of the pending request.
+ */
+    static bool prefetchResponseReceived = false;
+
+/**
+ * @brief Mutex protecting the response of the jobs service.
+ */
+    static pthread_mutex_t prefetchResponseMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Condition signaled when a response of the jobs service is received.
+ */
+    static pthread_cond_t prefetchResponseCondition = PTHREAD_COND_INITIALIZER;
+#endif /* if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 ) */
+
+/**
+ * @brief The reserved topics of the thing, assembled once at startup.
+ */
+static ThingTopics_t thingTopics;
+
+/**
+ * @brief The buffer holding #thingTopics.
+ */
+static char thingTopicsBuffer[ THING_TOPICS_BUFFER_SIZE( CLIENT_IDENTIFIER_LENGTH ) ];
 
 /**
  * @brief The network buffer must remain valid when OTA library task is running.
@@ -428,6 +721,21 @@ uint8_t authScheme[ OTA_MAX_URL_SIZE ];
  */
 static OtaEventData_t eventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
 
+/**
+ * @brief Number of event buffers in use.
+ */
+static uint32_t eventBuffersInUse = 0U;
+
+/**
+ * @brief Largest number of event buffers in use at the same time.
+ */
+static uint32_t eventBuffersHighWaterMark = 0U;
+
+/**
+ * @brief Number of times an event buffer was requested while all were in use.
+ */
+static uint32_t eventBuffersExhaustedCount = 0U;
+
 /**
  * @brief The buffer passed to the OTA Agent from application while initializing.
  */
@@ -498,12 +806,20 @@ static OtaMqttStatus_t mqttPublish( const char * const pTopic,
                                     uint32_t msgSize,
                                     uint8_t qos );
 
+/**
+ * @brief Assemble the reserved topics of the thing, and register the
+ * callbacks of the topics of the OTA agent with the subscription manager.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int registerOtaCallbacks( void );
+
 /**
  * @brief Subscribe to the Mqtt topics.
  *
  * This function subscribes to the Mqtt topics with the Quality of service
- * received as parameter. This function also registers a callback for the
- * topicfilter.
+ * received as parameter. The callbacks of the topics were registered by
+ * #registerOtaCallbacks.
  *
  * @param[in] pTopicFilter Mqtt topic filter.
  *
@@ -511,8 +827,6 @@ static OtaMqttStatus_t mqttPublish( const char * const pTopic,
  *
  * @param[in] qos Quality of Service
  *
- * @param[in] callback Callback to be registered.
- *
  * @return OtaMqttSuccess if success , other error code on failure.
  */
 static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
@@ -565,6 +879,198 @@ static OtaHttpStatus_t httpInit( char * pUrl );
 static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
                                     uint32_t rangeEnd );
 
+/**
+ * @brief Serialize a block request for the file of the pre-signed URL, to be
+ * sent for all its blocks.
+ *
+ * @param[out] pTemplate The template of the request.
+ * @param[in] pBuffer    Buffer of #HTTP_REQUEST_TEMPLATE_LENGTH bytes for the
+ * request.
+ * @return OtaHttpSuccess if the request was serialized, OtaHttpInitFailed
+ *                        otherwise.
+ */
+static OtaHttpStatus_t initRequestTemplate( HttpRequestTemplate_t * pTemplate,
+                                            uint8_t * pBuffer );
+
+/**
+ * @brief Send a file block request over a connection of the pool and receive
+ * its response.
+ *
+ * @param[in] rangeStart  Starting index of the file data
+ * @param[in] rangeEnd    Last index of the file data
+ * @param[in] pTemplate   The template of the request, built by
+ * #initRequestTemplate.
+ * @param[in] pBuffer     Buffer of #HTTP_USER_BUFFER_LENGTH bytes for the
+ * response.
+ * @param[out] pResponse  The response received, when @p pHttpStatus is
+ * #HTTPSuccess.
+ * @param[out] pHttpStatus The status of #HTTPClient_Send.
+ * @return OtaHttpStatus_t OtaHttpSuccess if a response was received or the
+ *                         connection was lost, other errors on failure.
+ */
+static OtaHttpStatus_t fetchBlock( uint32_t rangeStart,
+                                   uint32_t rangeEnd,
+                                   HttpRequestTemplate_t * pTemplate,
+                                   uint8_t * pBuffer,
+                                   HTTPResponse_t * pResponse,
+                                   HTTPStatus_t * pHttpStatus );
+
+#if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
+
+/**
+ * @brief Find the request of a file block, or assign a request to it.
+ *
+ * A request whose block is outside of the window of blocks being fetched is
+ * reused once its response was received. Must be called with
+ * #blockRequestMutex locked.
+ *
+ * @param[in] rangeStart  Starting index of the file data
+ * @param[in] rangeEnd    Last index of the file data
+ * @param[in] windowStart Starting index of the blocks being fetched.
+ * @param[in] windowEnd   Index following the blocks being fetched.
+ * @return The request of the block, or NULL if all requests are in use.
+ */
+    static BlockRequest_t * scheduleBlockRequest( uint32_t rangeStart,
+                                                  uint32_t rangeEnd,
+                                                  uint32_t windowStart,
+                                                  uint32_t windowEnd );
+
+/**
+ * @brief Wait for the requests in flight and discard all responses.
+ *
+ * Called when the file being downloaded changes.
+ */
+    static void resetBlockRequests( void );
+
+/**
+ * @brief Worker thread fetching the block of a request when it is pending.
+ *
+ * @param[in] pArgs The #BlockRequest_t served by the thread.
+ * @return NULL.
+ */
+    static void * blockRequestThread( void * pArgs );
+
+/**
+ * @brief Start the worker threads of the file block requests.
+ *
+ * @return EXIT_SUCCESS if all threads were started, EXIT_FAILURE otherwise.
+ */
+    static int startBlockRequestThreads( void );
+
+/**
+ * @brief Stop the worker threads of the file block requests.
+ */
+    static void stopBlockRequestThreads( void );
+#endif /* if ( OTA_HTTP_PARALLEL_REQUESTS > 1 ) */
+
+#if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+
+/**
+ * @brief Copy a response of the jobs service, and wake up the OTA agent
+ * thread waiting for it.
+ *
+ * @param[in] pContext MQTT context which stores the connection.
+ * @param[in] pPublishInfo MQTT packet holding the response.
+ */
+    static void prefetchResponseCallback( MQTTContext_t * pContext,
+                                          MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Send a request to the jobs service and wait for it to be accepted.
+ *
+ * @param[in] pRequestTopic The topic of the request.
+ * @param[in] pResponseTopic The topic of the accepted response.
+ * @return true if the response is in #prefetchResponse.
+ */
+    static bool requestJobsService( const char * pRequestTopic,
+                                    const char * pResponseTopic );
+
+/**
+ * @brief Find the next queued job and start downloading its image in the
+ * background.
+ *
+ * Called by the OTA agent thread once the current update is downloaded, while
+ * the MQTT connection is still up.
+ */
+    static void prefetchNextUpdate( void );
+
+/**
+ * @brief Download #prefetchedImage to the staging file.
+ *
+ * @param[in] fileDescriptor The staging file.
+ * @return true if every byte of the image was written.
+ */
+    static bool downloadPrefetchedImage( int fileDescriptor );
+
+/**
+ * @brief Write the length and the key of the URL of the staged image, so
+ * that the image is read when its job runs.
+ *
+ * @return true if the staged image was committed.
+ */
+    static bool commitStagedImage( void );
+
+/**
+ * @brief Thread downloading the image of the next update to the staging file.
+ *
+ * @param[in] pArgs Unused.
+ * @return NULL.
+ */
+    static void * prefetchThread( void * pArgs );
+
+/**
+ * @brief Wait for the background download to finish.
+ */
+    static void waitForPrefetch( void );
+
+/**
+ * @brief Build the key identifying an image across its pre-signed URLs: the
+ * host and the path, without the query signing the URL.
+ *
+ * @param[in] pUrl The pre-signed URL.
+ * @param[out] pKey Buffer receiving the key.
+ * @param[in] keyLength The length of pKey.
+ * @return true if the key was built.
+ */
+    static bool getImageKey( const char * pUrl,
+                             char * pKey,
+                             size_t keyLength );
+
+/**
+ * @brief Open the staging file if it holds the complete image of a URL.
+ *
+ * @param[in] pUrl The pre-signed URL of the file to download.
+ */
+    static void openStagedImage( const char * pUrl );
+
+/**
+ * @brief Close the staging file of the current file, if it is open.
+ */
+    static void closeStagedImage( void );
+
+/**
+ * @brief Send a file block read from the staging file to the OTA agent.
+ *
+ * @param[in] rangeStart Starting index of the file data
+ * @param[in] rangeEnd   Last index of the file data
+ * @return true if the block was sent.
+ */
+    static bool sendStagedBlock( uint32_t rangeStart,
+                                 uint32_t rangeEnd );
+
+/**
+ * @brief Request a file block from the staging file, or over HTTP if the file
+ * is not staged.
+ *
+ * @param[in] rangeStart Starting index of the file data
+ * @param[in] rangeEnd   Last index of the file data
+ * @return The status of #httpRequest, or OtaHttpSuccess if the block was
+ * read from the staging file.
+ */
+    static OtaHttpStatus_t httpRequestStaged( uint32_t rangeStart,
+                                              uint32_t rangeEnd );
+#endif /* if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 ) */
+
 /**
  * @brief Deinitialize and cleanup of the HTTP connection.
  *
@@ -660,11 +1166,24 @@ static void otaAppCallback( OtaJobEvent_t event,
 static void mqttJobCallback( MQTTContext_t * pContext,
                              MQTTPublishInfo_t * pPublishInfo );
 
+#if ( OTA_HTTP_PREWARM_CONNECTION == 1 )
+
 /**
- * @brief Callback that notifies the OTA library when a data block is received.
+ * @brief Start connecting to the host of the file of a job document, with
+ * the credentials of #initializeS3ServerInfo.
  *
- * @param[in] pContext MQTT context which stores the connection.
- * @param[in] pPublishInfo MQTT packet that stores the information of the file block.
+ * @param[in] pJobDocument The job document, which is not modified.
+ * @param[in] jobDocumentLength The length of @p pJobDocument.
+ */
+    static void prewarmS3Connection( char * pJobDocument,
+                                     size_t jobDocumentLength );
+#endif
+
+/**
+ * @brief Callback that notifies the OTA library when a data block is received.
+ *
+ * @param[in] pContext MQTT context which stores the connection.
+ * @param[in] pPublishInfo MQTT packet that stores the information of the file block.
  */
 static void mqttDataCallback( MQTTContext_t * pContext,
                               MQTTPublishInfo_t * pPublishInfo );
@@ -681,24 +1200,15 @@ static void mqttEventCallback( MQTTContext_t * pMqttContext,
                                MQTTPacketInfo_t * pPacketInfo,
                                MQTTDeserializedInfo_t * pDeserializedInfo );
 
-/* Callbacks to register with the Subscription Manager. */
-static SubscriptionManagerCallback_t otaMessageCallback[ OtaNumOfMessageType ] = { mqttJobCallback, mqttDataCallback };
-
 /*-----------------------------------------------------------*/
 
 void otaEventBufferFree( OtaEventData_t * const pxBuffer )
 {
-    if( sem_wait( &bufferSemaphore ) == 0 )
-    {
-        pxBuffer->bufferUsed = false;
-        ( void ) sem_post( &bufferSemaphore );
-    }
-    else
-    {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* The count is decremented first, so that it never exceeds the number
+     * of buffers. The release ordering makes the use of the buffer complete
+     * before another thread can claim it. */
+    ( void ) __atomic_sub_fetch( &eventBuffersInUse, 1U, __ATOMIC_RELAXED );
+    __atomic_store_n( &pxBuffer->bufferUsed, false, __ATOMIC_RELEASE );
 }
 
 /*-----------------------------------------------------------*/
@@ -707,26 +1217,47 @@ OtaEventData_t * otaEventBufferGet( void )
 {
     uint32_t ulIndex = 0;
     OtaEventData_t * pFreeBuffer = NULL;
+    bool bufferUsed = false;
+    uint32_t inUse = 0U;
+    uint32_t highWaterMark = 0U;
 
-    if( sem_wait( &bufferSemaphore ) == 0 )
+    /* The MQTT callbacks and the OTA agent thread claim a buffer without a
+     * lock, by atomically setting its flag. */
+    for( ulIndex = 0; ( ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS ) && ( pFreeBuffer == NULL ); ulIndex++ )
     {
-        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
+        bufferUsed = false;
+
+        if( __atomic_compare_exchange_n( &eventBuffer[ ulIndex ].bufferUsed,
+                                         &bufferUsed,
+                                         true,
+                                         false,
+                                         __ATOMIC_ACQUIRE,
+                                         __ATOMIC_RELAXED ) == true )
         {
-            if( eventBuffer[ ulIndex ].bufferUsed == false )
-            {
-                eventBuffer[ ulIndex ].bufferUsed = true;
-                pFreeBuffer = &eventBuffer[ ulIndex ];
-                break;
-            }
+            pFreeBuffer = &eventBuffer[ ulIndex ];
         }
+    }
 
-        ( void ) sem_post( &bufferSemaphore );
+    if( pFreeBuffer != NULL )
+    {
+        inUse = __atomic_add_fetch( &eventBuffersInUse, 1U, __ATOMIC_RELAXED );
+        highWaterMark = __atomic_load_n( &eventBuffersHighWaterMark, __ATOMIC_RELAXED );
+
+        /* A failed exchange loads the high-water mark set by another thread. */
+        while( ( inUse > highWaterMark ) &&
+               ( __atomic_compare_exchange_n( &eventBuffersHighWaterMark,
+                                              &highWaterMark,
+                                              inUse,
+                                              true,
+                                              __ATOMIC_RELAXED,
+                                              __ATOMIC_RELAXED ) == false ) )
+        {
+            /* Retry with the new high-water mark. */
+        }
     }
     else
     {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        ( void ) __atomic_add_fetch( &eventBuffersExhaustedCount, 1U, __ATOMIC_RELAXED );
     }
 
     return pFreeBuffer;
@@ -744,6 +1275,12 @@ static void otaAppCallback( OtaJobEvent_t event,
         case OtaJobEventActivate:
             LogInfo( ( "Received OtaJobEventActivate callback from OTA Agent." ) );
 
+            #if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+                /* Look up the next queued update while the MQTT connection is
+                 * still up, and download its image in the background. */
+                prefetchNextUpdate();
+            #endif
+
             /* Activate the new firmware image. */
             OTA_ActivateNewImage();
 
@@ -829,6 +1366,11 @@ static void mqttJobCallback( MQTTContext_t * pContext,
         eventMsg.eventId = OtaAgentEventReceivedJobDocument;
         eventMsg.pEventData = pData;
 
+        #if ( OTA_HTTP_PREWARM_CONNECTION == 1 )
+            /* The buffer is read before the OTA agent owns it. */
+            prewarmS3Connection( ( char * ) pData->data, pData->dataLength );
+        #endif
+
         /* Send job document received event. */
         OTA_SignalEvent( &eventMsg );
     }
@@ -927,7 +1469,7 @@ static void mqttEventCallback( MQTTContext_t * pMqttContext,
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
 }
 
 /*-----------------------------------------------------------*/
@@ -985,6 +1527,7 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     serverInfo.pHostName = AWS_IOT_ENDPOINT;
     serverInfo.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
     serverInfo.port = AWS_MQTT_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Initialize credentials for establishing TLS session. */
     memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
@@ -1134,19 +1677,9 @@ static int establishMqttSession( MQTTContext_t * pMqttContext )
         connectInfo.passwordLength = 0U;
     #endif /* ifdef CLIENT_USERNAME */
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send MQTT CONNECT packet to broker. */
-        mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Connect"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send MQTT CONNECT packet to broker. The demo thread owns the MQTT
+     * context, so the call is made directly. */
+    mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1220,22 +1753,11 @@ static void disconnect( void )
 
     if( mqttSessionEstablished == true )
     {
-        if( pthread_mutex_lock( &mqttMutex ) == 0 )
-        {
-            /* Disconnect MQTT session. */
-            MQTT_Disconnect( &mqttContext );
-
-            /* Clear the mqtt session flag. */
-            mqttSessionEstablished = false;
+        /* Disconnect MQTT session. */
+        MQTT_Disconnect( &mqttContext );
 
-            pthread_mutex_unlock( &mqttMutex );
-        }
-        else
-        {
-            LogError( ( "Failed to acquire mutex to execute MQTT_Disconnect"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-        }
+        /* Clear the mqtt session flag. */
+        mqttSessionEstablished = false;
     }
     else
     {
@@ -1246,68 +1768,57 @@ static void disconnect( void )
     ( void ) Openssl_Disconnect( &networkContextMqtt );
 }
 
-static int32_t connectToS3Server( NetworkContext_t * pNetworkContext,
-                                  const char * pUrl )
+static int32_t initializeS3ServerInfo( const char * pUrl )
 {
     int32_t returnStatus = EXIT_SUCCESS;
     HTTPStatus_t httpStatus = HTTPSuccess;
 
-    /* The location of the host address within the pre-signed URL. */
-    const char * pAddress = NULL;
-
-    /* Status returned by OpenSSL transport implementation. */
-    OpensslStatus_t opensslStatus;
-    /* Credentials to establish the TLS connection. */
-    OpensslCredentials_t opensslCredentials;
-    /* Information about the server to send the HTTP requests. */
-    ServerInfo_t serverInfo;
-
-    /* Initialize TLS credentials. */
-    ( void ) memset( &opensslCredentials, 0, sizeof( opensslCredentials ) );
-    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH_HTTP;
+    /* Parse the URL once. The host, path and query of all the block requests
+     * of the file are offsets into pUrl. */
+    httpStatus = parseUrl( pUrl,
+                           strlen( pUrl ),
+                           &presignedUrl );
 
-    /* Retrieve the address location and length from S3_PRESIGNED_GET_URL. */
-    if( pUrl != NULL )
+    if( httpStatus != HTTPSuccess )
     {
-        /* Retrieve the address location and length from S3_PRESIGNED_GET_URL. */
-        httpStatus = getUrlAddress( pUrl,
-                                    strlen( pUrl ),
-                                    &pAddress,
-                                    &serverHostLength );
-
-        if( httpStatus != HTTPSuccess )
-        {
-            LogError( ( "URL %s parsing failed. Error code: %d",
-                        pUrl,
-                        httpStatus ) );
-        }
-
-        /* serverHost should consist only of the host address. */
-        memcpy( serverHost, pAddress, serverHostLength );
-        serverHost[ serverHostLength ] = '\0';
+        LogError( ( "URL %s parsing failed. Error code: %d",
+                    pUrl,
+                    httpStatus ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else if( copyUrlHost( &presignedUrl, serverHost, sizeof( serverHost ) ) == false )
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        /* The path used for the requests in this demo needs all the query
+         * information following the location of the object, to the end of
+         * the S3 presigned URL. */
+        pPath = &pUrl[ presignedUrl.requestTarget.offset ];
     }
 
-    if( returnStatus != EXIT_FAILURE )
+    if( returnStatus == EXIT_SUCCESS )
     {
-        /* Initialize server information. */
-        serverInfo.pHostName = serverHost;
-        serverInfo.hostNameLength = serverHostLength;
-        serverInfo.port = AWS_HTTPS_PORT;
 
-        /* Establish a TLS session with the HTTP server. This example connects
-         * to the HTTP server as specified in SERVER_HOST and HTTPS_PORT in
-         * demo_config.h. */
-        LogInfo( ( "Establishing a TLS session with %s:%d.",
-                   serverHost,
-                   AWS_HTTPS_PORT ) );
+        /* Initialize TLS credentials. */
+        ( void ) memset( &opensslCredentialsHttp, 0, sizeof( opensslCredentialsHttp ) );
+        opensslCredentialsHttp.pRootCaPath = ROOT_CA_CERT_PATH_HTTP;
 
-        opensslStatus = Openssl_Connect( pNetworkContext,
-                                         &serverInfo,
-                                         &opensslCredentials,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS );
+        /* Let the kernel decrypt the downloaded image when it supports TLS
+         * offload. */
+        opensslCredentialsHttp.enableKtls = true;
 
-        returnStatus = ( opensslStatus == OPENSSL_SUCCESS ) ? EXIT_SUCCESS : EXIT_FAILURE;
+        /* Download with the AEAD that is fastest on this CPU. */
+        opensslCredentialsHttp.cipherPolicy = OPENSSL_CIPHERS_AUTO;
+
+        /* Initialize server information. The connection pool connects to the
+         * host of the pre-signed URL and AWS_HTTPS_PORT. */
+        ( void ) memset( &serverInfoHttp, 0, sizeof( serverInfoHttp ) );
+        serverInfoHttp.pHostName = serverHost;
+        serverInfoHttp.hostNameLength = presignedUrl.host.length;
+        serverInfoHttp.port = AWS_HTTPS_PORT;
+        serverInfoHttp.pSocketOptions = NULL;
     }
 
     return returnStatus;
@@ -1315,6 +1826,58 @@ static int32_t connectToS3Server( NetworkContext_t * pNetworkContext,
 
 /*-----------------------------------------------------------*/
 
+#if ( OTA_HTTP_PREWARM_CONNECTION == 1 )
+    static void prewarmS3Connection( char * pJobDocument,
+                                     size_t jobDocumentLength )
+    {
+        char * pUrl = NULL;
+        size_t urlLength = 0U;
+        ParsedUrl_t parsedUrl;
+        char host[ URL_MAX_HOST_LENGTH + 1U ];
+        ServerInfo_t serverInfo;
+        OpensslCredentials_t credentials;
+
+        /* Job documents of other protocols have no URL. */
+        if( ( JSON_Validate( pJobDocument, jobDocumentLength ) == JSONSuccess ) &&
+            ( JSON_Search( pJobDocument,
+                           jobDocumentLength,
+                           PREWARM_URL_KEY,
+                           sizeof( PREWARM_URL_KEY ) - 1U,
+                           &pUrl,
+                           &urlLength ) == JSONSuccess ) &&
+            ( parseUrl( pUrl, urlLength, &parsedUrl ) == HTTPSuccess ) &&
+            ( copyUrlHost( &parsedUrl, host, sizeof( host ) ) == true ) )
+        {
+            /* The same credentials as #initializeS3ServerInfo, for #httpInit
+             * to check the connection out. */
+            ( void ) memset( &credentials, 0, sizeof( credentials ) );
+            credentials.pRootCaPath = ROOT_CA_CERT_PATH_HTTP;
+            credentials.enableKtls = true;
+            credentials.cipherPolicy = OPENSSL_CIPHERS_AUTO;
+
+            ( void ) memset( &serverInfo, 0, sizeof( serverInfo ) );
+            serverInfo.pHostName = host;
+            serverInfo.hostNameLength = parsedUrl.host.length;
+            serverInfo.port = AWS_HTTPS_PORT;
+
+            LogInfo( ( "Connecting to %s while the job document is processed.", host ) );
+
+            if( ConnectionPool_Prewarm( &serverInfo,
+                                        &credentials,
+                                        TRANSPORT_SEND_RECV_TIMEOUT_MS ) != CONNECTION_POOL_SUCCESS )
+            {
+                LogWarn( ( "Failed to start connecting to %s.", host ) );
+            }
+        }
+        else
+        {
+            LogDebug( ( "The job document has no HTTP URL to connect to ahead." ) );
+        }
+    }
+#endif /* if ( OTA_HTTP_PREWARM_CONNECTION == 1 ) */
+
+/*-----------------------------------------------------------*/
+
 static OtaHttpStatus_t handleHttpResponse( const HTTPResponse_t * pResponse )
 {
     /* Return error code. */
@@ -1377,49 +1940,86 @@ static OtaHttpStatus_t httpInit( char * pUrl )
     /* OTA lib return error code. */
     OtaHttpStatus_t ret = OtaHttpSuccess;
 
-    /* HTTPS Client library return status. */
-    HTTPStatus_t httpStatus = HTTPSuccess;
-
     /* Return value from libraries. */
     int32_t returnStatus = EXIT_SUCCESS;
 
-    /* The length of the path within the pre-signed URL. This variable is
-     * defined in order to store the length returned from parsing the URL, but
-     * it is unused. The path used for the requests in this demo needs all the
-     * query information following the location of the object, to the end of the
-     * S3 presigned URL. */
-    size_t pathLen = 0;
+    /* The transport layer interface used by the HTTP Client library. */
+    TransportInterface_t transportInterface;
 
-    /* Set the pParams member of the network context with desired transport. */
-    networkContextHttp.pParams = &opensslParamsForHttp;
+    #if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
+        size_t i = 0U;
 
-    /* Establish HTTPs connection */
-    LogInfo( ( "Performing TLS handshake on top of the TCP connection." ) );
+        /* Blocks fetched ahead from the previous file are not used. */
+        resetBlockRequests();
 
-    /* Attempt to connect to the HTTPs server. If connection fails, retry after
-     * a timeout. Timeout value will be exponentially increased till the maximum
-     * attempts are reached or maximum timeout value is reached. The function
-     * returns EXIT_FAILURE if the TCP connection cannot be established to
-     * broker after configured number of attempts. */
-    returnStatus = connectToS3Server( &networkContextHttp, pUrl );
+        #if ( OTA_HTTP_ADAPTIVE_FETCH_AHEAD == 1 )
+            /* Start with all the requests, as without adapting. */
+            HttpRangeTuner_Init( &fetchAheadTuner,
+                                 OTA_HTTP_PARALLEL_REQUESTS * otaconfigFILE_BLOCK_SIZE,
+                                 otaconfigFILE_BLOCK_SIZE,
+                                 OTA_HTTP_PARALLEL_REQUESTS * otaconfigFILE_BLOCK_SIZE,
+                                 TRANSPORT_SEND_RECV_TIMEOUT_MS );
+        #endif
+    #endif
+
+    returnStatus = initializeS3ServerInfo( pUrl );
+
+    #if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+        /* The blocks of an image prefetched with the previous update are read
+         * from the staging file. */
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            openStagedImage( pUrl );
+        }
+    #endif
+
+    /* The requests for the blocks of the file only differ by their Range
+     * header, so they are serialized once per file. */
+    #if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
+        for( i = 0U; ( i < OTA_HTTP_PARALLEL_REQUESTS ) && ( returnStatus == EXIT_SUCCESS ); i++ )
+        {
+            if( initRequestTemplate( &blockRequests[ i ].requestTemplate,
+                                     blockRequests[ i ].templateBuffer ) != OtaHttpSuccess )
+            {
+                returnStatus = EXIT_FAILURE;
+            }
+        }
+    #else
+        if( ( returnStatus == EXIT_SUCCESS ) &&
+            ( initRequestTemplate( &httpRequestTemplate, httpRequestTemplateBuffer ) != OtaHttpSuccess ) )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    #endif
 
     if( returnStatus == EXIT_SUCCESS )
     {
-        /* Define the transport interface. */
-        ( void ) memset( &transportInterfaceHttp, 0, sizeof( transportInterfaceHttp ) );
-        transportInterfaceHttp.recv = Openssl_Recv;
-        transportInterfaceHttp.send = Openssl_Send;
-        transportInterfaceHttp.pNetworkContext = &networkContextHttp;
-
-        /* Retrieve the path location from url. This
-         * function returns the length of the path without the query into
-         * pathLen, which is left unused in this demo. */
-        httpStatus = getUrlPath( pUrl,
-                                 strlen( pUrl ),
-                                 &pPath,
-                                 &pathLen );
+        /* Establish HTTPs connection */
+        LogInfo( ( "Performing TLS handshake on top of the TCP connection." ) );
+
+        /* Check out a connection to the HTTPs server, so that the connection
+         * is already established when the first block is requested. A
+         * connection left open by a previous download from the same host is
+         * reused. If connection fails, the pool retries after a timeout.
+         * Timeout value will be exponentially increased till the maximum
+         * attempts are reached or maximum timeout value is reached. */
+        if( ConnectionPool_Checkout( &serverInfoHttp,
+                                     &opensslCredentialsHttp,
+                                     TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                     &transportInterface ) == CONNECTION_POOL_SUCCESS )
+        {
+            /* Keep the connection open for the requests. */
+            ConnectionPool_Checkin( &transportInterface, HTTPSuccess, NULL );
+        }
+        else
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
 
-        ret = ( httpStatus == HTTPSuccess ) ? OtaHttpSuccess : OtaHttpInitFailed;
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        ret = OtaHttpSuccess;
     }
     else
     {
@@ -1434,8 +2034,8 @@ static OtaHttpStatus_t httpInit( char * pUrl )
     return ret;
 }
 
-static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
-                                    uint32_t rangeEnd )
+static OtaHttpStatus_t initRequestTemplate( HttpRequestTemplate_t * pTemplate,
+                                            uint8_t * pBuffer )
 {
     /* OTA lib return error code. */
     OtaHttpStatus_t ret = OtaHttpSuccess;
@@ -1443,99 +2043,114 @@ static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
     /* Configurations of the initial request headers that are passed to
      * #HTTPClient_InitializeRequestHeaders. */
     HTTPRequestInfo_t requestInfo;
-    /* Represents a response returned from an HTTP server. */
-    HTTPResponse_t response;
-    /* Represents header data that will be sent in an HTTP request. */
-    HTTPRequestHeaders_t requestHeaders;
 
     /* Return value of all methods from the HTTP Client library API. */
     HTTPStatus_t httpStatus = HTTPSuccess;
 
-    /* Reconnection required flag. */
-    bool reconnectRequired = false;
-
     /* Initialize all HTTP Client library API structs to 0. */
     ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
-    ( void ) memset( &response, 0, sizeof( response ) );
-    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
 
     /* Initialize the request object. */
     requestInfo.pHost = serverHost;
-    requestInfo.hostLen = serverHostLength;
+    requestInfo.hostLen = presignedUrl.host.length;
     requestInfo.pMethod = HTTP_METHOD_GET;
     requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
     requestInfo.pPath = pPath;
-    requestInfo.pathLen = strlen( pPath );
+    requestInfo.pathLen = presignedUrl.requestTarget.length;
 
     /* Set "Connection" HTTP header to "keep-alive" so that multiple requests
      * can be sent over the same established TCP connection. */
     requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
 
-    /* Set the buffer used for storing request headers. */
-    requestHeaders.pBuffer = httpUserBuffer;
-    requestHeaders.bufferLen = HTTP_USER_BUFFER_LENGTH;
-
-    httpStatus = HTTPClient_InitializeRequestHeaders( &requestHeaders,
-                                                      &requestInfo );
-
-    HTTPClient_AddRangeHeader( &requestHeaders, rangeStart, rangeEnd );
+    httpStatus = HttpRequestTemplate_Init( pTemplate,
+                                           pBuffer,
+                                           HTTP_REQUEST_TEMPLATE_LENGTH,
+                                           &requestInfo );
 
+    /* Only the positions of the Range header change from one block to the
+     * next. */
     if( httpStatus == HTTPSuccess )
     {
-        /* Initialize the response object. The same buffer used for storing
-         * request headers is reused here. */
-        response.pBuffer = httpUserBuffer;
-        response.bufferLen = HTTP_USER_BUFFER_LENGTH;
-
-        /* Send the request and receive the response. */
-        httpStatus = HTTPClient_Send( &transportInterfaceHttp,
-                                      &requestHeaders,
-                                      NULL,
-                                      0,
-                                      &response,
-                                      0 );
+        httpStatus = HttpRequestTemplate_ReserveRange( pTemplate );
     }
-    else
+
+    if( httpStatus != HTTPSuccess )
     {
         LogError( ( "Failed to initialize HTTP request headers: Error=%s.",
                     HTTPClient_strerror( httpStatus ) ) );
+
+        ret = OtaHttpInitFailed;
     }
 
-    if( httpStatus != HTTPSuccess )
-    {
-        if( ( httpStatus == HTTPNoResponse ) || ( httpStatus == HTTPNetworkError ) )
-        {
-            reconnectRequired = true;
-        }
-        else
-        {
-            LogError( ( "HTTPClient_Send failed: Error=%s.",
-                        HTTPClient_strerror( httpStatus ) ) );
+    return ret;
+}
 
-            ret = OtaHttpRequestFailed;
-        }
-    }
-    else
-    {
-        /* Check if reconnection required. */
-        if( response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG )
-        {
-            reconnectRequired = true;
-        }
+static OtaHttpStatus_t fetchBlock( uint32_t rangeStart,
+                                   uint32_t rangeEnd,
+                                   HttpRequestTemplate_t * pTemplate,
+                                   uint8_t * pBuffer,
+                                   HTTPResponse_t * pResponse,
+                                   HTTPStatus_t * pHttpStatus )
+{
+    /* OTA lib return error code. */
+    OtaHttpStatus_t ret = OtaHttpSuccess;
 
-        /* Handle the http response received. */
-        ret = handleHttpResponse( &response );
-    }
+    /* Return value of all methods from the HTTP Client library API. */
+    HTTPStatus_t httpStatus = HTTPSuccess;
 
-    if( reconnectRequired == true )
-    {
-        /* End TLS session, then close TCP connection. */
-        ( void ) Openssl_Disconnect( &networkContextHttp );
+    /* The transport layer interface used by the HTTP Client library. */
+    TransportInterface_t transportInterface;
 
-        /* Try establishing connection to S3 server again. */
-        if( connectToS3Server( &networkContextHttp, NULL ) == EXIT_SUCCESS )
+    /* Initialize all HTTP Client library API structs to 0. */
+    ( void ) memset( pResponse, 0, sizeof( HTTPResponse_t ) );
+
+    httpStatus = HttpRequestTemplate_SetRange( pTemplate, rangeStart, rangeEnd );
+
+    if( httpStatus == HTTPSuccess )
+    {
+        /* Initialize the response object. The request is held by the request
+         * template. */
+        pResponse->pBuffer = pBuffer;
+        pResponse->bufferLen = HTTP_USER_BUFFER_LENGTH;
+
+        /* Check out the connection of the previous request, or a new one if
+         * the server closed it. */
+        if( ConnectionPool_Checkout( &serverInfoHttp,
+                                     &opensslCredentialsHttp,
+                                     TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                     &transportInterface ) == CONNECTION_POOL_SUCCESS )
         {
-            ret = HTTPSuccess;
+            /* Send the request and receive the response. */
+            httpStatus = HTTPClient_Send( &transportInterface,
+                                          &pTemplate->headers,
+                                          NULL,
+                                          0,
+                                          pResponse,
+                                          0 );
+
+            /* The connection is closed if the request failed or the response
+             * has a "Connection: close" header, so that the next request
+             * establishes a new connection. */
+            ConnectionPool_Checkin( &transportInterface, httpStatus, pResponse );
+
+            if( ( httpStatus == HTTPNoResponse ) || ( httpStatus == HTTPNetworkError ) )
+            {
+                /* The block is requested again by the OTA agent, over a new
+                 * connection. */
+                LogWarn( ( "Connection to HTTP server %s was lost.",
+                           serverHost ) );
+            }
+            else if( httpStatus != HTTPSuccess )
+            {
+                LogError( ( "HTTPClient_Send failed: Error=%s.",
+                            HTTPClient_strerror( httpStatus ) ) );
+
+                ret = OtaHttpRequestFailed;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
         }
         else
         {
@@ -1547,189 +2162,1029 @@ static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
             ret = OtaHttpRequestFailed;
         }
     }
+    else
+    {
+        LogError( ( "Failed to add Range header to request headers: Error=%s.",
+                    HTTPClient_strerror( httpStatus ) ) );
 
-    return ret;
-}
-
-static OtaHttpStatus_t httpDeinit( void )
-{
-    OtaHttpStatus_t ret = OtaHttpSuccess;
+        ret = OtaHttpRequestFailed;
+    }
 
-    /* Nothing special to do here .*/
+    *pHttpStatus = httpStatus;
 
     return ret;
 }
 
-/*-----------------------------------------------------------*/
-
-static OtaMessageType_t getOtaMessageType( const char * pTopicFilter,
-                                           uint16_t topicFilterLength )
-{
-    int retStatus = EXIT_FAILURE;
-
-    uint16_t stringIndex = 0U, fieldLength = 0U, i = 0U;
-    OtaMessageType_t retMesageType = OtaNumOfMessageType;
+#if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
 
-    /* Lookup table for OTA message string. */
-    static const char * const pOtaMessageStrings[ OtaNumOfMessageType ] =
+    static BlockRequest_t * scheduleBlockRequest( uint32_t rangeStart,
+                                                  uint32_t rangeEnd,
+                                                  uint32_t windowStart,
+                                                  uint32_t windowEnd )
     {
-        OTA_TOPIC_JOBS,
-        OTA_TOPIC_STREAM
-    };
-
-    /* Check topic prefix is valid.*/
-    if( strncmp( pTopicFilter, OTA_TOPIC_PREFIX, ( size_t ) OTA_TOPIC_PREFIX_LENGTH ) == 0 )
-    {
-        stringIndex = OTA_TOPIC_PREFIX_LENGTH;
-
-        retStatus = EXIT_SUCCESS;
-    }
-
-    /* Check if thing name is valid.*/
-    if( retStatus == EXIT_SUCCESS )
-    {
-        retStatus = EXIT_FAILURE;
+        BlockRequest_t * pRequest = NULL;
+        BlockRequest_t * pUnused = NULL;
+        size_t i;
 
-        /* Extract the thing name.*/
-        for( ; stringIndex < topicFilterLength; stringIndex++ )
+        for( i = 0U; ( i < OTA_HTTP_PARALLEL_REQUESTS ) && ( pRequest == NULL ); i++ )
         {
-            if( pTopicFilter[ stringIndex ] == ( char ) '/' )
+            if( blockRequests[ i ].state == BlockRequestFree )
             {
-                break;
+                if( pUnused == NULL )
+                {
+                    pUnused = &blockRequests[ i ];
+                }
+            }
+            else if( ( blockRequests[ i ].rangeStart == rangeStart ) &&
+                     ( blockRequests[ i ].rangeEnd >= rangeEnd ) )
+            {
+                /* The block is already requested. */
+                pRequest = &blockRequests[ i ];
+            }
+            else if( ( blockRequests[ i ].state == BlockRequestDone ) &&
+                     ( ( blockRequests[ i ].rangeStart < windowStart ) ||
+                       ( blockRequests[ i ].rangeStart >= windowEnd ) ) )
+            {
+                /* The block fetched ahead is no longer requested by the agent. */
+                if( pUnused == NULL )
+                {
+                    pUnused = &blockRequests[ i ];
+                }
             }
             else
             {
-                fieldLength++;
+                /* Empty else MISRA 15.7 */
             }
         }
 
-        if( fieldLength > 0 )
+        if( ( pRequest == NULL ) && ( pUnused != NULL ) )
         {
-            /* Check thing name.*/
-            if( strncmp( &pTopicFilter[ stringIndex - fieldLength ],
-                         CLIENT_IDENTIFIER,
-                         ( size_t ) ( fieldLength ) ) == 0 )
-            {
-                stringIndex++;
-
-                retStatus = EXIT_SUCCESS;
-            }
+            pRequest = pUnused;
+            pRequest->rangeStart = rangeStart;
+            pRequest->rangeEnd = rangeEnd;
+            pRequest->state = BlockRequestPending;
         }
+
+        return pRequest;
     }
 
-    /* Check the message type from topic.*/
-    if( retStatus == EXIT_SUCCESS )
+/*-----------------------------------------------------------*/
+
+    static void resetBlockRequests( void )
     {
-        fieldLength = 0;
+        bool pending = true;
+        size_t i;
 
-        /* Extract the topic type.*/
-        for( ; stringIndex < topicFilterLength; stringIndex++ )
+        if( pthread_mutex_lock( &blockRequestMutex ) == 0 )
         {
-            if( pTopicFilter[ stringIndex ] == ( char ) '/' )
+            while( pending == true )
             {
-                break;
+                pending = false;
+
+                for( i = 0U; i < OTA_HTTP_PARALLEL_REQUESTS; i++ )
+                {
+                    if( blockRequests[ i ].state == BlockRequestPending )
+                    {
+                        pending = true;
+                    }
+                }
+
+                if( pending == true )
+                {
+                    ( void ) pthread_cond_wait( &blockRequestCondition, &blockRequestMutex );
+                }
             }
-            else
+
+            for( i = 0U; i < OTA_HTTP_PARALLEL_REQUESTS; i++ )
             {
-                fieldLength++;
+                blockRequests[ i ].state = BlockRequestFree;
             }
+
+            ( void ) pthread_mutex_unlock( &blockRequestMutex );
         }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * blockRequestThread( void * pArgs )
+    {
+        BlockRequest_t * pRequest = ( BlockRequest_t * ) pArgs;
 
-        if( fieldLength > 0 )
+        if( pthread_mutex_lock( &blockRequestMutex ) == 0 )
         {
-            for( i = 0; i < OtaNumOfMessageType; i++ )
+            while( blockRequestThreadsStop == false )
             {
-                /* check thing name.*/
-                if( strncmp( &pTopicFilter[ stringIndex - fieldLength ],
-                             pOtaMessageStrings[ i ],
-                             ( size_t ) ( fieldLength ) ) == 0 )
+                if( pRequest->state == BlockRequestPending )
+                {
+                    /* The request is not modified by other threads while it is
+                     * pending, so the block is fetched without the lock. */
+                    ( void ) pthread_mutex_unlock( &blockRequestMutex );
+
+                    pRequest->result = fetchBlock( pRequest->rangeStart,
+                                                   pRequest->rangeEnd,
+                                                   &pRequest->requestTemplate,
+                                                   pRequest->buffer,
+                                                   &pRequest->response,
+                                                   &pRequest->httpStatus );
+
+                    ( void ) pthread_mutex_lock( &blockRequestMutex );
+                    pRequest->state = BlockRequestDone;
+                    ( void ) pthread_cond_broadcast( &blockRequestCondition );
+                }
+                else
                 {
-                    break;
+                    ( void ) pthread_cond_wait( &blockRequestCondition, &blockRequestMutex );
                 }
             }
 
-            if( i < OtaNumOfMessageType )
-            {
-                retMesageType = i;
-            }
+            ( void ) pthread_mutex_unlock( &blockRequestMutex );
         }
-    }
 
-    return retMesageType;
-}
+        return NULL;
+    }
 
 /*-----------------------------------------------------------*/
 
+    static int startBlockRequestThreads( void )
+    {
+        int returnStatus = EXIT_SUCCESS;
+        size_t i;
 
+        blockRequestThreadsStop = false;
 
-static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
-                                      uint16_t topicFilterLength,
-                                      uint8_t qos )
-{
-    OtaMqttStatus_t otaRet = OtaMqttSuccess;
-    SubscriptionManagerStatus_t subscriptionStatus = SUBSCRIPTION_MANAGER_SUCCESS;
-    OtaMessageType_t otaMessageType;
+        for( i = 0U; ( i < OTA_HTTP_PARALLEL_REQUESTS ) && ( returnStatus == EXIT_SUCCESS ); i++ )
+        {
+            if( pthread_create( &blockRequestThreads[ i ],
+                                NULL,
+                                blockRequestThread,
+                                &blockRequests[ i ] ) != 0 )
+            {
+                LogError( ( "Failed to create block request thread: "
+                            ",errno=%s",
+                            strerror( errno ) ) );
 
-    MQTTStatus_t mqttStatus = MQTTBadParameter;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
+                /* Stop the threads already started. */
+                blockRequestThreads[ i ] = ( pthread_t ) 0;
+                stopBlockRequestThreads();
 
-    assert( pMqttContext != NULL );
-    assert( pTopicFilter != NULL );
-    assert( topicFilterLength > 0 );
+                returnStatus = EXIT_FAILURE;
+            }
+        }
 
-    /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
+        return returnStatus;
+    }
 
-    /* Set the QoS , topic and topic length. */
-    pSubscriptionList[ 0 ].qos = qos;
-    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+/*-----------------------------------------------------------*/
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
+    static void stopBlockRequestThreads( void )
     {
-        /* Send SUBSCRIBE packet. */
-        mqttStatus = MQTT_Subscribe( pMqttContext,
-                                     pSubscriptionList,
-                                     sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                     MQTT_GetPacketId( pMqttContext ) );
+        size_t i;
 
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Subscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        if( pthread_mutex_lock( &blockRequestMutex ) == 0 )
+        {
+            blockRequestThreadsStop = true;
+            ( void ) pthread_cond_broadcast( &blockRequestCondition );
+            ( void ) pthread_mutex_unlock( &blockRequestMutex );
+        }
+
+        for( i = 0U; i < OTA_HTTP_PARALLEL_REQUESTS; i++ )
+        {
+            if( blockRequestThreads[ i ] != ( pthread_t ) 0 )
+            {
+                ( void ) pthread_join( blockRequestThreads[ i ], NULL );
+                blockRequestThreads[ i ] = ( pthread_t ) 0;
+            }
+        }
     }
 
-    if( mqttStatus != MQTTSuccess )
+/*-----------------------------------------------------------*/
+
+    static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
+                                        uint32_t rangeEnd )
     {
-        LogError( ( "Failed to send SUBSCRIBE packet to broker with error = %u.",
-                    mqttStatus ) );
+        /* OTA lib return error code. */
+        OtaHttpStatus_t ret = OtaHttpRequestFailed;
 
-        otaRet = OtaMqttSubscribeFailed;
+        /* The request of the block, fetched ahead or requested now. */
+        BlockRequest_t * pRequest = NULL;
+
+        /* The length of the blocks of the file, the last one may be shorter. */
+        uint32_t blockLength = rangeEnd - rangeStart + 1U;
+
+        /* The blocks from rangeStart to windowEnd are fetched ahead. */
+        uint32_t windowEnd = rangeStart + ( OTA_HTTP_PARALLEL_REQUESTS * blockLength );
+        uint32_t nextStart;
+
+        #if ( OTA_HTTP_ADAPTIVE_FETCH_AHEAD == 1 )
+            windowEnd = rangeStart + ( ( uint32_t ) ( HttpRangeTuner_Start( &fetchAheadTuner ) /
+                                                    otaconfigFILE_BLOCK_SIZE ) * blockLength );
+        #endif
+
+        if( pthread_mutex_lock( &blockRequestMutex ) == 0 )
+        {
+            /* Wait for a request to be available if all of them are in
+             * flight for blocks of a previous window. */
+            pRequest = scheduleBlockRequest( rangeStart, rangeEnd, rangeStart, windowEnd );
+
+            while( pRequest == NULL )
+            {
+                ( void ) pthread_cond_wait( &blockRequestCondition, &blockRequestMutex );
+                pRequest = scheduleBlockRequest( rangeStart, rangeEnd, rangeStart, windowEnd );
+            }
+
+            /* Request the blocks following this one, which are requested next
+             * by the OTA agent. Those past the end of the file are answered
+             * with an error and never used. */
+            for( nextStart = rangeStart + blockLength;
+                 ( nextStart > rangeStart ) && ( nextStart < windowEnd );
+                 nextStart += blockLength )
+            {
+                ( void ) scheduleBlockRequest( nextStart,
+                                               nextStart + blockLength - 1U,
+                                               rangeStart,
+                                               windowEnd );
+            }
+
+            ( void ) pthread_cond_broadcast( &blockRequestCondition );
+
+            while( pRequest->state == BlockRequestPending )
+            {
+                ( void ) pthread_cond_wait( &blockRequestCondition, &blockRequestMutex );
+            }
+
+            ret = pRequest->result;
+
+            if( ( ret == OtaHttpSuccess ) && ( pRequest->httpStatus == HTTPSuccess ) )
+            {
+                /* A block fetched ahead is longer than the requested range
+                 * when the agent requests the last block of the file. */
+                if( pRequest->response.bodyLen > blockLength )
+                {
+                    pRequest->response.bodyLen = blockLength;
+                }
+
+                /* Handle the http response received. */
+                ret = handleHttpResponse( &pRequest->response );
+            }
+
+            #if ( OTA_HTTP_ADAPTIVE_FETCH_AHEAD == 1 )
+                HttpRangeTuner_Finish( &fetchAheadTuner, blockLength, ( ret == OtaHttpSuccess ) );
+            #endif
+
+            pRequest->state = BlockRequestFree;
+
+            ( void ) pthread_mutex_unlock( &blockRequestMutex );
+        }
+
+        return ret;
     }
-    else
+
+#else /* if ( OTA_HTTP_PARALLEL_REQUESTS > 1 ) */
+
+    static OtaHttpStatus_t httpRequest( uint32_t rangeStart,
+                                        uint32_t rangeEnd )
     {
-        LogInfo( ( "SUBSCRIBE topic %.*s to broker.\n\n",
-                   topicFilterLength,
-                   pTopicFilter ) );
+        /* OTA lib return error code. */
+        OtaHttpStatus_t ret = OtaHttpSuccess;
+
+        /* Represents a response returned from an HTTP server. */
+        HTTPResponse_t response;
+
+        /* Return value of all methods from the HTTP Client library API. */
+        HTTPStatus_t httpStatus = HTTPSuccess;
+
+        ret = fetchBlock( rangeStart, rangeEnd, &httpRequestTemplate, httpUserBuffer, &response, &httpStatus );
+
+        if( ( ret == OtaHttpSuccess ) && ( httpStatus == HTTPSuccess ) )
+        {
+            /* Handle the http response received. */
+            ret = handleHttpResponse( &response );
+        }
+
+        return ret;
     }
 
-    otaMessageType = getOtaMessageType( pTopicFilter, topicFilterLength );
+#endif /* if ( OTA_HTTP_PARALLEL_REQUESTS > 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+
+    static void prefetchResponseCallback( MQTTContext_t * pContext,
+                                          MQTTPublishInfo_t * pPublishInfo )
+    {
+        ( void ) pContext;
+
+        assert( pPublishInfo != NULL );
+
+        ( void ) pthread_mutex_lock( &prefetchResponseMutex );
+
+        if( pPublishInfo->payloadLength <= sizeof( prefetchResponse ) )
+        {
+            ( void ) memcpy( prefetchResponse, pPublishInfo->pPayload, pPublishInfo->payloadLength );
+            prefetchResponseLength = pPublishInfo->payloadLength;
+            prefetchResponseReceived = true;
+
+            ( void ) pthread_cond_broadcast( &prefetchResponseCondition );
+        }
+        else
+        {
+            LogWarn( ( "Dropped a response of the jobs service of %lu bytes: "
+                       "Responses are at most %lu bytes long.",
+                       ( unsigned long ) pPublishInfo->payloadLength,
+                       ( unsigned long ) sizeof( prefetchResponse ) ) );
+        }
 
-    assert( ( otaMessageType >= 0 ) && ( otaMessageType < OtaNumOfMessageType ) );
+        ( void ) pthread_mutex_unlock( &prefetchResponseMutex );
+    }
 
-    /* Register callback to subscription manager. */
-    subscriptionStatus = SubscriptionManager_RegisterCallback( pTopicFilter,
-                                                               topicFilterLength,
-                                                               otaMessageCallback[ otaMessageType ] );
+/*-----------------------------------------------------------*/
 
-    if( subscriptionStatus != SUBSCRIPTION_MANAGER_SUCCESS )
+    static bool requestJobsService( const char * pRequestTopic,
+                                    const char * pResponseTopic )
     {
-        LogWarn( ( "Failed to register a callback to subscription manager with error = %d.",
-                   subscriptionStatus ) );
+        bool received = false;
+        int waitStatus = 0;
+        struct timespec deadline;
+        MQTTSubscribeInfo_t subscription;
+        MQTTPublishInfo_t publishInfo;
+        uint16_t responseTopicLength = ( uint16_t ) strlen( pResponseTopic );
+
+        ( void ) memset( &subscription, 0, sizeof( subscription ) );
+        ( void ) memset( &publishInfo, 0, sizeof( publishInfo ) );
+
+        subscription.qos = MQTTQoS1;
+        subscription.pTopicFilter = pResponseTopic;
+        subscription.topicFilterLength = responseTopicLength;
+
+        /* The jobs service answers an empty request with the pending jobs, or
+         * the description of a job. */
+        publishInfo.qos = MQTTQoS1;
+        publishInfo.pTopicName = pRequestTopic;
+        publishInfo.topicNameLength = ( uint16_t ) strlen( pRequestTopic );
+        publishInfo.pPayload = "{}";
+        publishInfo.payloadLength = sizeof( "{}" ) - 1U;
+
+        ( void ) pthread_mutex_lock( &prefetchResponseMutex );
+        prefetchResponseReceived = false;
+        ( void ) pthread_mutex_unlock( &prefetchResponseMutex );
+
+        if( ( SubscriptionManager_RegisterCallback( pResponseTopic,
+                                                    responseTopicLength,
+                                                    prefetchResponseCallback ) == SUBSCRIPTION_MANAGER_SUCCESS ) &&
+            ( MqttAgent_Subscribe( &mqttAgent, &subscription, 1U ) == MQTTSuccess ) &&
+            ( MqttAgent_Publish( &mqttAgent, &publishInfo ) == MQTTSuccess ) )
+        {
+            ( void ) clock_gettime( CLOCK_REALTIME, &deadline );
+            deadline.tv_sec += ( time_t ) ( OTA_HTTP_PREFETCH_RESPONSE_TIMEOUT_MS / NUM_MILLISECONDS_IN_SECOND );
+            deadline.tv_nsec += ( long ) ( OTA_HTTP_PREFETCH_RESPONSE_TIMEOUT_MS % NUM_MILLISECONDS_IN_SECOND ) * 1000000L;
+
+            if( deadline.tv_nsec >= 1000000000L )
+            {
+                deadline.tv_sec += 1;
+                deadline.tv_nsec -= 1000000000L;
+            }
+
+            ( void ) pthread_mutex_lock( &prefetchResponseMutex );
+
+            while( ( prefetchResponseReceived == false ) && ( waitStatus == 0 ) )
+            {
+                waitStatus = pthread_cond_timedwait( &prefetchResponseCondition,
+                                                     &prefetchResponseMutex,
+                                                     &deadline );
+            }
+
+            received = prefetchResponseReceived;
+
+            ( void ) pthread_mutex_unlock( &prefetchResponseMutex );
+
+            if( received == false )
+            {
+                LogWarn( ( "No response of the jobs service on %s.", pResponseTopic ) );
+            }
+        }
+        else
+        {
+            LogWarn( ( "Failed to send a request to the jobs service on %s.", pRequestTopic ) );
+        }
+
+        /* No more responses are copied once the request is done. */
+        ( void ) MqttAgent_Unsubscribe( &mqttAgent, &subscription, 1U );
+        SubscriptionManager_RemoveCallback( pResponseTopic, responseTopicLength );
+
+        return received;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prefetchNextUpdate( void )
+    {
+        bool found = false;
+        char * pValue = NULL;
+        size_t valueLength = 0U;
+        char describeTopic[ PREFETCH_TOPIC_LENGTH ];
+        char acceptedTopic[ PREFETCH_TOPIC_LENGTH ];
+        char fileSize[ 11 ];
+        unsigned long parsedFileSize = 0UL;
+
+        if( prefetchedImage.running == true )
+        {
+            LogInfo( ( "The image of the next update is already being prefetched." ) );
+        }
+        else
+        {
+            found = requestJobsService( THING_TOPICS_STRING( &thingTopics, ThingTopicJobsGet ),
+                                        THING_TOPICS_STRING( &thingTopics, ThingTopicJobsGetAccepted ) );
+        }
+
+        if( found == true )
+        {
+            found = ( JSON_Validate( prefetchResponse, prefetchResponseLength ) == JSONSuccess ) &&
+                    ( JSON_Search( prefetchResponse,
+                                   prefetchResponseLength,
+                                   PREFETCH_JOB_ID_KEY,
+                                   sizeof( PREFETCH_JOB_ID_KEY ) - 1U,
+                                   &pValue,
+                                   &valueLength ) == JSONSuccess ) &&
+                    ( valueLength <= PREFETCH_JOB_ID_MAX_LENGTH );
+
+            if( found == false )
+            {
+                LogInfo( ( "No queued update to prefetch." ) );
+            }
+        }
+
+        if( found == true )
+        {
+            /* The ID is copied to the topics before the next response
+             * overwrites it. */
+            ( void ) snprintf( describeTopic, sizeof( describeTopic ), "%s%.*s/get",
+                               PREFETCH_JOBS_TOPIC_PREFIX, ( int ) valueLength, pValue );
+            ( void ) snprintf( acceptedTopic, sizeof( acceptedTopic ), "%s%.*s/get" PREFETCH_ACCEPTED_SUFFIX,
+                               PREFETCH_JOBS_TOPIC_PREFIX, ( int ) valueLength, pValue );
+
+            LogInfo( ( "Prefetching the image of the queued job %.*s.", ( int ) valueLength, pValue ) );
+
+            found = requestJobsService( describeTopic, acceptedTopic );
+        }
+
+        if( found == true )
+        {
+            found = ( JSON_Validate( prefetchResponse, prefetchResponseLength ) == JSONSuccess ) &&
+                    ( JSON_Search( prefetchResponse,
+                                   prefetchResponseLength,
+                                   PREFETCH_URL_KEY,
+                                   sizeof( PREFETCH_URL_KEY ) - 1U,
+                                   &pValue,
+                                   &valueLength ) == JSONSuccess ) &&
+                    ( valueLength < sizeof( prefetchedImage.url ) );
+
+            if( found == true )
+            {
+                ( void ) memcpy( prefetchedImage.url, pValue, valueLength );
+                prefetchedImage.url[ valueLength ] = '\0';
+
+                found = ( JSON_Search( prefetchResponse,
+                                       prefetchResponseLength,
+                                       PREFETCH_FILE_SIZE_KEY,
+                                       sizeof( PREFETCH_FILE_SIZE_KEY ) - 1U,
+                                       &pValue,
+                                       &valueLength ) == JSONSuccess ) &&
+                        ( valueLength < sizeof( fileSize ) );
+            }
+
+            if( found == true )
+            {
+                ( void ) memcpy( fileSize, pValue, valueLength );
+                fileSize[ valueLength ] = '\0';
+                parsedFileSize = strtoul( fileSize, NULL, 10 );
+
+                found = ( parsedFileSize > 0UL ) && ( parsedFileSize <= UINT32_MAX );
+            }
+
+            if( found == false )
+            {
+                LogWarn( ( "The queued job has no file to download over HTTP." ) );
+            }
+        }
+
+        if( found == true )
+        {
+            prefetchedImage.fileSize = ( uint32_t ) parsedFileSize;
+
+            if( pthread_create( &prefetchedImage.thread, NULL, prefetchThread, NULL ) == 0 )
+            {
+                prefetchedImage.running = true;
+            }
+            else
+            {
+                LogWarn( ( "Failed to start the thread prefetching the next update." ) );
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool downloadPrefetchedImage( int fileDescriptor )
+    {
+        bool success = false;
+        HTTPStatus_t httpStatus = HTTPSuccess;
+        HTTPRequestInfo_t requestInfo;
+        HTTPResponse_t response;
+        TransportInterface_t transportInterface;
+        uint32_t rangeStart = 0U;
+        uint32_t rangeLength = 0U;
+
+        httpStatus = parseUrl( prefetchedImage.url,
+                               strlen( prefetchedImage.url ),
+                               &prefetchedImage.parsedUrl );
+
+        if( httpStatus == HTTPSuccess )
+        {
+            success = copyUrlHost( &prefetchedImage.parsedUrl,
+                                   prefetchedImage.host,
+                                   sizeof( prefetchedImage.host ) );
+        }
+
+        if( success == true )
+        {
+            /* The image is downloaded as the current file, over the pool
+             * connections, which are background traffic. */
+            ( void ) memset( &prefetchedImage.credentials, 0, sizeof( prefetchedImage.credentials ) );
+            prefetchedImage.credentials.pRootCaPath = ROOT_CA_CERT_PATH_HTTP;
+            prefetchedImage.credentials.enableKtls = true;
+            prefetchedImage.credentials.cipherPolicy = OPENSSL_CIPHERS_AUTO;
+
+            ( void ) memset( &prefetchedImage.serverInfo, 0, sizeof( prefetchedImage.serverInfo ) );
+            prefetchedImage.serverInfo.pHostName = prefetchedImage.host;
+            prefetchedImage.serverInfo.hostNameLength = prefetchedImage.parsedUrl.host.length;
+            prefetchedImage.serverInfo.port = AWS_HTTPS_PORT;
+
+            ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+            requestInfo.pHost = prefetchedImage.host;
+            requestInfo.hostLen = prefetchedImage.parsedUrl.host.length;
+            requestInfo.pMethod = HTTP_METHOD_GET;
+            requestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1;
+            requestInfo.pPath = &prefetchedImage.url[ prefetchedImage.parsedUrl.requestTarget.offset ];
+            requestInfo.pathLen = prefetchedImage.parsedUrl.requestTarget.length;
+            requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+            httpStatus = HttpRequestTemplate_Init( &prefetchedImage.requestTemplate,
+                                                   prefetchedImage.templateBuffer,
+                                                   HTTP_REQUEST_TEMPLATE_LENGTH,
+                                                   &requestInfo );
+
+            if( httpStatus == HTTPSuccess )
+            {
+                httpStatus = HttpRequestTemplate_ReserveRange( &prefetchedImage.requestTemplate );
+            }
+
+            success = ( httpStatus == HTTPSuccess );
+        }
+
+        while( ( success == true ) && ( rangeStart < prefetchedImage.fileSize ) )
+        {
+            rangeLength = prefetchedImage.fileSize - rangeStart;
+
+            if( rangeLength > otaconfigFILE_BLOCK_SIZE )
+            {
+                rangeLength = otaconfigFILE_BLOCK_SIZE;
+            }
+
+            ( void ) memset( &response, 0, sizeof( response ) );
+            response.pBuffer = prefetchedImage.buffer;
+            response.bufferLen = HTTP_USER_BUFFER_LENGTH;
+
+            httpStatus = HttpRequestTemplate_SetRange( &prefetchedImage.requestTemplate,
+                                                       rangeStart,
+                                                       rangeStart + rangeLength - 1U );
+
+            if( ( httpStatus == HTTPSuccess ) &&
+                ( ConnectionPool_Checkout( &prefetchedImage.serverInfo,
+                                           &prefetchedImage.credentials,
+                                           TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                           &transportInterface ) == CONNECTION_POOL_SUCCESS ) )
+            {
+                httpStatus = HTTPClient_Send( &transportInterface,
+                                              &prefetchedImage.requestTemplate.headers,
+                                              NULL,
+                                              0,
+                                              &response,
+                                              0 );
+
+                ConnectionPool_Checkin( &transportInterface, httpStatus, &response );
+            }
+            else
+            {
+                httpStatus = HTTPNetworkError;
+            }
+
+            if( ( httpStatus == HTTPSuccess ) &&
+                ( response.statusCode == HTTP_RESPONSE_PARTIAL_CONTENT ) &&
+                ( response.bodyLen == rangeLength ) &&
+                ( pwrite( fileDescriptor, response.pBody, rangeLength, ( off_t ) rangeStart ) == ( ssize_t ) rangeLength ) )
+            {
+                rangeStart += rangeLength;
+            }
+            else
+            {
+                LogWarn( ( "Failed to prefetch bytes %u to %u of the next update: "
+                           "Status=%d, Error=%s.",
+                           ( unsigned int ) rangeStart,
+                           ( unsigned int ) ( rangeStart + rangeLength - 1U ),
+                           ( int ) response.statusCode,
+                           HTTPClient_strerror( httpStatus ) ) );
+
+                success = false;
+            }
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool commitStagedImage( void )
+    {
+        bool success = false;
+        char key[ PREFETCH_KEY_LENGTH ];
+        FILE * pFile = NULL;
+
+        if( getImageKey( prefetchedImage.url, key, sizeof( key ) ) == true )
+        {
+            pFile = fopen( PREFETCH_META_TEMP_PATH, "w" );
+        }
+
+        if( pFile != NULL )
+        {
+            success = ( fprintf( pFile, "%lu %s\n", ( unsigned long ) prefetchedImage.fileSize, key ) > 0 );
+
+            if( ( fflush( pFile ) != 0 ) || ( fsync( fileno( pFile ) ) != 0 ) )
+            {
+                success = false;
+            }
+
+            if( fclose( pFile ) != 0 )
+            {
+                success = false;
+            }
+        }
+
+        /* The description replaces the previous one at once, so that a crash
+         * leaves either no staged image or a complete one. */
+        if( success == true )
+        {
+            success = ( rename( PREFETCH_META_TEMP_PATH, PREFETCH_META_PATH ) == 0 );
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * prefetchThread( void * pArgs )
+    {
+        bool staged = false;
+        int fileDescriptor = -1;
+
+        ( void ) pArgs;
+
+        /* The previously staged image is no longer used once the staging file
+         * is overwritten. */
+        ( void ) unlink( PREFETCH_META_PATH );
+
+        fileDescriptor = open( OTA_HTTP_PREFETCH_STAGING_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0600 );
+
+        if( fileDescriptor < 0 )
+        {
+            LogWarn( ( "Failed to open %s: errno=%d.", OTA_HTTP_PREFETCH_STAGING_PATH, errno ) );
+        }
+        else
+        {
+            staged = downloadPrefetchedImage( fileDescriptor );
+
+            if( fsync( fileDescriptor ) != 0 )
+            {
+                staged = false;
+            }
+
+            if( close( fileDescriptor ) != 0 )
+            {
+                staged = false;
+            }
+        }
+
+        if( staged == true )
+        {
+            staged = commitStagedImage();
+        }
+
+        if( staged == true )
+        {
+            LogInfo( ( "Staged the %u bytes of the next update in %s.",
+                       ( unsigned int ) prefetchedImage.fileSize,
+                       OTA_HTTP_PREFETCH_STAGING_PATH ) );
+        }
+        else
+        {
+            LogWarn( ( "Failed to prefetch the next update: It is downloaded when its job runs." ) );
+        }
+
+        return NULL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void waitForPrefetch( void )
+    {
+        if( prefetchedImage.running == true )
+        {
+            LogInfo( ( "Waiting for the next update to be staged." ) );
+
+            ( void ) pthread_join( prefetchedImage.thread, NULL );
+            prefetchedImage.running = false;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool getImageKey( const char * pUrl,
+                             char * pKey,
+                             size_t keyLength )
+    {
+        bool success = false;
+        ParsedUrl_t parsedUrl;
+        int keyWritten = 0;
+
+        if( parseUrl( pUrl, strlen( pUrl ), &parsedUrl ) == HTTPSuccess )
+        {
+            keyWritten = snprintf( pKey, keyLength, "%.*s%.*s",
+                                   ( int ) parsedUrl.host.length,
+                                   &pUrl[ parsedUrl.host.offset ],
+                                   ( int ) parsedUrl.path.length,
+                                   &pUrl[ parsedUrl.path.offset ] );
+
+            success = ( keyWritten > 0 ) && ( ( size_t ) keyWritten < keyLength );
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void openStagedImage( const char * pUrl )
+    {
+        char key[ PREFETCH_KEY_LENGTH ];
+        char line[ PREFETCH_KEY_LENGTH + 16U ];
+        char * pStagedKey = NULL;
+        unsigned long fileSize = 0UL;
+        struct stat fileStatus;
+        FILE * pFile = NULL;
+
+        closeStagedImage();
+
+        if( getImageKey( pUrl, key, sizeof( key ) ) == true )
+        {
+            pFile = fopen( PREFETCH_META_PATH, "r" );
+        }
+
+        if( pFile != NULL )
+        {
+            if( fgets( line, sizeof( line ), pFile ) != NULL )
+            {
+                line[ strcspn( line, "\n" ) ] = '\0';
+                fileSize = strtoul( line, &pStagedKey, 10 );
+
+                if( ( *pStagedKey == ' ' ) &&
+                    ( strcmp( &pStagedKey[ 1 ], key ) == 0 ) &&
+                    ( fileSize > 0UL ) &&
+                    ( fileSize <= UINT32_MAX ) )
+                {
+                    stagedImage.fileDescriptor = open( OTA_HTTP_PREFETCH_STAGING_PATH, O_RDONLY );
+                    stagedImage.fileSize = ( uint32_t ) fileSize;
+                }
+            }
+
+            ( void ) fclose( pFile );
+        }
+
+        /* A staging file changed since it was committed is not used. */
+        if( ( stagedImage.fileDescriptor >= 0 ) &&
+            ( ( fstat( stagedImage.fileDescriptor, &fileStatus ) != 0 ) ||
+              ( fileStatus.st_size != ( off_t ) stagedImage.fileSize ) ) )
+        {
+            closeStagedImage();
+        }
+
+        if( stagedImage.fileDescriptor >= 0 )
+        {
+            LogInfo( ( "Reading the file from %s, staged in the background.",
+                       OTA_HTTP_PREFETCH_STAGING_PATH ) );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void closeStagedImage( void )
+    {
+        if( stagedImage.fileDescriptor >= 0 )
+        {
+            ( void ) close( stagedImage.fileDescriptor );
+            stagedImage.fileDescriptor = -1;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool sendStagedBlock( uint32_t rangeStart,
+                                 uint32_t rangeEnd )
+    {
+        bool sent = false;
+        OtaEventData_t * pData = NULL;
+        OtaEventMsg_t eventMsg = { 0 };
+        uint32_t blockLength = 0U;
+
+        if( ( stagedImage.fileDescriptor >= 0 ) &&
+            ( rangeStart <= rangeEnd ) &&
+            ( rangeStart < stagedImage.fileSize ) )
+        {
+            /* The last block is shorter than the range requested, as the
+             * body of a partial response. */
+            if( rangeEnd >= stagedImage.fileSize )
+            {
+                blockLength = stagedImage.fileSize - rangeStart;
+            }
+            else
+            {
+                blockLength = rangeEnd - rangeStart + 1U;
+            }
+
+            if( blockLength <= sizeof( eventBuffer[ 0 ].data ) )
+            {
+                pData = otaEventBufferGet();
+            }
+        }
+
+        if( pData != NULL )
+        {
+            if( pread( stagedImage.fileDescriptor, pData->data, blockLength, ( off_t ) rangeStart ) == ( ssize_t ) blockLength )
+            {
+                pData->dataLength = blockLength;
+
+                eventMsg.eventId = OtaAgentEventReceivedFileBlock;
+                eventMsg.pEventData = pData;
+                OTA_SignalEvent( &eventMsg );
+
+                sent = true;
+            }
+            else
+            {
+                LogWarn( ( "Failed to read %s: Downloading the rest of the file.",
+                           OTA_HTTP_PREFETCH_STAGING_PATH ) );
+
+                otaEventBufferFree( pData );
+                closeStagedImage();
+            }
+        }
+
+        return sent;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaHttpStatus_t httpRequestStaged( uint32_t rangeStart,
+                                              uint32_t rangeEnd )
+    {
+        OtaHttpStatus_t ret = OtaHttpSuccess;
+
+        if( sendStagedBlock( rangeStart, rangeEnd ) == false )
+        {
+            ret = httpRequest( rangeStart, rangeEnd );
+        }
+
+        return ret;
+    }
+
+#endif /* if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+
+static OtaHttpStatus_t httpDeinit( void )
+{
+    OtaHttpStatus_t ret = OtaHttpSuccess;
+
+    #if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
+        /* Discard the blocks fetched ahead of the end of the file. */
+        resetBlockRequests();
+    #endif
+
+    #if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+        closeStagedImage();
+    #endif
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static int registerOtaCallbacks( void )
+{
+    int returnStatus = EXIT_SUCCESS;
+    ThingTopicsStatus_t topicsStatus = ThingTopicsSuccess;
+    SubscriptionManagerStatus_t subscriptionStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    uint32_t i = 0U;
+
+    /* The topics the OTA agent subscribes to, with their callbacks. The
+     * filter of the streams matches the data topic of any stream, so the
+     * subscriptions of the agent need no registration of their own. */
+    static const ThingTopic_t otaTopics[] =
+    {
+        ThingTopicJobsNotifyNext,
+        ThingTopicJobsNextGetAccepted,
+        ThingTopicStreamsDataCbor
+    };
+    static const SubscriptionManagerCallback_t otaCallbacks[] =
+    {
+        mqttJobCallback,
+        mqttJobCallback,
+        mqttDataCallback
+    };
+
+    topicsStatus = ThingTopics_Init( &thingTopics,
+                                     CLIENT_IDENTIFIER,
+                                     CLIENT_IDENTIFIER_LENGTH,
+                                     thingTopicsBuffer,
+                                     sizeof( thingTopicsBuffer ) );
+
+    if( topicsStatus != ThingTopicsSuccess )
+    {
+        LogError( ( "Failed to assemble the topics of the thing %s with error = %d.",
+                    CLIENT_IDENTIFIER,
+                    topicsStatus ) );
+
+        returnStatus = EXIT_FAILURE;
+    }
+
+    for( i = 0U; ( i < ( sizeof( otaTopics ) / sizeof( otaTopics[ 0 ] ) ) ) && ( returnStatus == EXIT_SUCCESS ); i++ )
+    {
+        subscriptionStatus = SubscriptionManager_RegisterCallback( THING_TOPICS_STRING( &thingTopics, otaTopics[ i ] ),
+                                                                   THING_TOPICS_LENGTH( &thingTopics, otaTopics[ i ] ),
+                                                                   otaCallbacks[ i ] );
+
+        if( subscriptionStatus != SUBSCRIPTION_MANAGER_SUCCESS )
+        {
+            LogError( ( "Failed to register a callback to subscription manager with error = %d.",
+                        subscriptionStatus ) );
+
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+
+
+static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
+                                      uint16_t topicFilterLength,
+                                      uint8_t qos )
+{
+    OtaMqttStatus_t otaRet = OtaMqttSuccess;
+
+    MQTTStatus_t mqttStatus = MQTTBadParameter;
+    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
+
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength > 0 );
+
+    /* Start with everything at 0. */
+    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
+
+    /* Set the QoS , topic and topic length. */
+    pSubscriptionList[ 0 ].qos = qos;
+    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
+    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+
+    /* Send SUBSCRIBE packet from the thread owning the MQTT context. */
+    mqttStatus = MqttAgent_Subscribe( &mqttAgent,
+                                      pSubscriptionList,
+                                      sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ) );
+
+    if( mqttStatus != MQTTSuccess )
+    {
+        LogError( ( "Failed to send SUBSCRIBE packet to broker with error = %u.",
+                    mqttStatus ) );
+
+        otaRet = OtaMqttSubscribeFailed;
+    }
+    else
+    {
+        LogInfo( ( "SUBSCRIBE topic %.*s to broker.\n\n",
+                   topicFilterLength,
+                   pTopicFilter ) );
     }
 
     return otaRet;
@@ -1745,7 +3200,6 @@ static OtaMqttStatus_t mqttPublish( const char * const pTopic,
 
     MQTTStatus_t mqttStatus = MQTTBadParameter;
     MQTTPublishInfo_t publishInfo = { 0 };
-    MQTTContext_t * pMqttContext = &mqttContext;
 
     /* Set the required publish parameters. */
     publishInfo.pTopicName = pTopic;
@@ -1754,20 +3208,8 @@ static OtaMqttStatus_t mqttPublish( const char * const pTopic,
     publishInfo.pPayload = pMsg;
     publishInfo.payloadLength = msgSize;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &publishInfo,
-                                   ( qos ) ? MQTT_GetPacketId( pMqttContext ) : 0U );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Publish"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send PUBLISH packet from the thread owning the MQTT context. */
+    mqttStatus = MqttAgent_Publish( &mqttAgent, &publishInfo );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1793,7 +3235,6 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     MQTTStatus_t mqttStatus = MQTTBadParameter;
 
     MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
-    MQTTContext_t * pMqttContext = &mqttContext;
 
     /* Start with everything at 0. */
     ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
@@ -1803,22 +3244,10 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
     pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send UNSUBSCRIBE packet. */
-        mqttStatus = MQTT_Unsubscribe( pMqttContext,
-                                       pSubscriptionList,
-                                       sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                       MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Unsubscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send UNSUBSCRIBE packet from the thread owning the MQTT context. */
+    mqttStatus = MqttAgent_Unsubscribe( &mqttAgent,
+                                        pSubscriptionList,
+                                        sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ) );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1859,7 +3288,11 @@ static void setOtaInterfaces( OtaInterfaces_t * pOtaInterfaces )
 
     /* Initialize the OTA library HTTP Interface.*/
     pOtaInterfaces->http.init = httpInit;
-    pOtaInterfaces->http.request = httpRequest;
+    #if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+        pOtaInterfaces->http.request = httpRequestStaged;
+    #else
+        pOtaInterfaces->http.request = httpRequest;
+    #endif
     pOtaInterfaces->http.deinit = httpDeinit;
 
     /* Initialize the OTA library PAL Interface.*/
@@ -1918,6 +3351,11 @@ static int startOTADemo( void )
 
     /****************************** Init OTA Library. ******************************/
 
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        returnStatus = registerOtaCallbacks();
+    }
+
     if( returnStatus == EXIT_SUCCESS )
     {
         if( ( otaRet = OTA_Init( &otaBuffer,
@@ -1980,20 +3418,9 @@ static int startOTADemo( void )
 
             if( mqttSessionEstablished == true )
             {
-                /* Acquire the mqtt mutex lock. */
-                if( pthread_mutex_lock( &mqttMutex ) == 0 )
-                {
-                    /* Loop to receive packet from transport interface. */
-                    mqttStatus = MQTT_ProcessLoop( &mqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
-
-                    pthread_mutex_unlock( &mqttMutex );
-                }
-                else
-                {
-                    LogError( ( "Failed to acquire mutex to execute process loop"
-                                ",errno=%s",
-                                strerror( errno ) ) );
-                }
+                /* Run the MQTT operations of the OTA agent thread and
+                 * receive packets from the transport interface. */
+                mqttStatus = MqttAgent_ProcessLoop( &mqttAgent, MQTT_PROCESS_LOOP_TIMEOUT_MS );
 
                 if( mqttStatus == MQTTSuccess )
                 {
@@ -2005,12 +3432,6 @@ static int startOTADemo( void )
                                otaStatistics.otaPacketsQueued,
                                otaStatistics.otaPacketsProcessed,
                                otaStatistics.otaPacketsDropped ) );
-
-                    /* Delay if mqtt process loop is set to zero.*/
-                    if( MQTT_PROCESS_LOOP_TIMEOUT_MS > 0 )
-                    {
-                        Clock_SleepMs( OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS );
-                    }
                 }
                 else
                 {
@@ -2058,6 +3479,11 @@ static int startOTADemo( void )
                     returnStatus ) );
     }
 
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        /* No more files are verified once the OTA thread has exited. */
+        otaPal_FreeSignerKeyCache();
+    #endif
+
     return returnStatus;
 }
 
@@ -2082,45 +3508,50 @@ int main( int argc,
     /* Return error status. */
     int returnStatus = EXIT_SUCCESS;
 
-    /* Semaphore initialization flag. */
-    bool bufferSemInitialized = false;
-    bool mqttMutexInitialized = false;
+    /* MQTT agent initialization flag. */
+    bool mqttAgentInitialized = false;
 
     /* Maximum time in milliseconds to wait before exiting demo . */
     int16_t waitTimeoutMs = OTA_DEMO_EXIT_TIMEOUT_MS;
 
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        TransportThrottleConfig_t throttleConfig = { 0 };
+    #endif
+
     LogInfo( ( "OTA over HTTP demo, Application version %u.%u.%u",
                appFirmwareVersion.u.x.major,
                appFirmwareVersion.u.x.minor,
                appFirmwareVersion.u.x.build ) );
 
-    /* Initialize semaphore for buffer operations. */
-    if( sem_init( &bufferSemaphore, 0, 1 ) != 0 )
+    /* Initialize the agent owning the MQTT context on this thread. */
+    if( MqttAgent_Init( &mqttAgent, &mqttContext, &opensslParamsForMqtt ) != MQTT_AGENT_SUCCESS )
     {
-        LogError( ( "Failed to initialize buffer semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to initialize the MQTT agent." ) );
 
         returnStatus = EXIT_FAILURE;
     }
     else
     {
-        bufferSemInitialized = true;
+        mqttAgentInitialized = true;
     }
 
-    /* Initialize mutex for coreMQTT APIs. */
-    if( pthread_mutex_init( &mqttMutex, NULL ) != 0 )
-    {
-        LogError( ( "Failed to initialize mutex for mqtt apis"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        /* The pool connections downloading the file are background traffic,
+         * which yields the link to the MQTT connection. */
+        throttleConfig.rateBytesPerSec = OTA_HTTP_THROTTLE_RATE_BYTES_PER_SEC;
+        throttleConfig.burstBytes = OTA_HTTP_THROTTLE_BURST_BYTES;
+        throttleConfig.rttTargetMs = OTA_HTTP_THROTTLE_RTT_TARGET_MS;
+        throttleConfig.minRateBytesPerSec = OTA_HTTP_THROTTLE_MIN_RATE_BYTES_PER_SEC;
+        TransportThrottle_Configure( &throttleConfig );
+    #endif
 
-        returnStatus = EXIT_FAILURE;
-    }
-    else
-    {
-        mqttMutexInitialized = true;
-    }
+    #if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            /* Start the threads fetching the file blocks. */
+            returnStatus = startBlockRequestThreads();
+        }
+    #endif
 
     if( returnStatus == EXIT_SUCCESS )
     {
@@ -2138,33 +3569,30 @@ int main( int argc,
     /* Disconnect from broker and close connection. */
     disconnect();
 
-    /* Disconnect from S3 and close connection. */
-    Openssl_Disconnect( &networkContextHttp );
+    #if ( OTA_HTTP_PARALLEL_REQUESTS > 1 )
+        /* Stop the threads fetching the file blocks before closing their
+         * connections. */
+        stopBlockRequestThreads();
+    #endif
 
-    if( bufferSemInitialized == true )
-    {
-        /* Cleanup semaphore created for buffer operations. */
-        if( sem_destroy( &bufferSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy buffer semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
+    #if ( OTA_HTTP_PREFETCH_NEXT_UPDATE == 1 )
+        /* Let the next update be staged before closing its connections. */
+        waitForPrefetch();
+    #endif
 
-            returnStatus = EXIT_FAILURE;
-        }
-    }
+    /* Disconnect from S3 and close connections. */
+    ConnectionPool_CloseAll();
 
-    if( mqttMutexInitialized == true )
-    {
-        /* Cleanup mutex created for buffer operations. */
-        if( pthread_mutex_destroy( &mqttMutex ) != 0 )
-        {
-            LogError( ( "Failed to destroy mutex for mqtt apis"
-                        ",errno=%s",
-                        strerror( errno ) ) );
+    /* Report whether otaconfigMAX_NUM_OTA_DATA_BUFFERS was large enough. */
+    LogInfo( ( "OTA event buffers: High-water mark=%u of %u, Exhausted=%u times.",
+               ( unsigned int ) __atomic_load_n( &eventBuffersHighWaterMark, __ATOMIC_RELAXED ),
+               ( unsigned int ) otaconfigMAX_NUM_OTA_DATA_BUFFERS,
+               ( unsigned int ) __atomic_load_n( &eventBuffersExhaustedCount, __ATOMIC_RELAXED ) ) );
 
-            returnStatus = EXIT_FAILURE;
-        }
+    if( mqttAgentInitialized == true )
+    {
+        /* Release the MQTT agent once the OTA agent thread has stopped. */
+        ( void ) MqttAgent_Deinit( &mqttAgent );
     }
 
     /* Wait and log message before exiting demo. */
@@ -90,6 +90,12 @@
  */
 #define otaconfigMAX_THINGNAME_LEN              64U
 
+/**
+ * @brief Maximum size of the response to a data block request, from the AWS
+ * IoT streaming service.
+ */
+#define OTA_STREAM_MAX_RESPONSE_SIZE            ( 128UL * 1024UL )
+
 /**
  * @brief The maximum number of data blocks requested from OTA streaming service.
  *
@@ -101,8 +107,13 @@
  *  how many data blocks response is expected for each data requests.
  *  @note This must be set larger than zero.
  *
+ *  This is the window of blocks in flight: the agent requests the next blocks missing from its
+ *  receive bitmap once the blocks of a request are received, so the transfer takes a round trip
+ *  to the broker per window rather than per block. The window is set to the largest response of
+ *  the service, 32 blocks of 4 KB.
+ *
  */
-#define otaconfigMAX_NUM_BLOCKS_REQUEST         8U
+#define otaconfigMAX_NUM_BLOCKS_REQUEST         ( OTA_STREAM_MAX_RESPONSE_SIZE / otaconfigFILE_BLOCK_SIZE )
 
 /**
  * @brief The maximum number of requests allowed to send without a response before we abort.
@@ -118,8 +129,12 @@
  *
  * This configurations parameter sets the maximum number of static data buffers used by
  * the OTA agent for job and file data blocks received.
+ *
+ * A whole window of otaconfigMAX_NUM_BLOCKS_REQUEST blocks can arrive before the agent
+ * processes the first of them, so there is a buffer for each, and for a job document.
+ * Otherwise blocks are dropped, and requested again when the window times out.
  */
-#define otaconfigMAX_NUM_OTA_DATA_BUFFERS       10U
+#define otaconfigMAX_NUM_OTA_DATA_BUFFERS       ( otaconfigMAX_NUM_BLOCKS_REQUEST + 2U )
 
 /**
  * @brief How frequently the device will report its OTA progress to the cloud.
@@ -175,4 +190,61 @@
  */
 #define configOTA_PRIMARY_DATA_PROTOCOL         ( OTA_DATA_OVER_MQTT )
 
+/**
+ * @brief Preallocate the receive file and write each block with a single
+ * pwrite at its offset, instead of fseek and fwrite.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_PWRITE_ENABLED            ( 1 )
+
+/**
+ * @brief Hash the image while its blocks are written, so that only the
+ * signature is verified when the file is closed.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED  ( 1 )
+
+/**
+ * @brief Keep the public key of the signer certificate between signature
+ * checks, instead of parsing the certificate for every file.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED  ( 1 )
+
+/**
+ * @brief Accept delta images, which are applied to the running executable
+ * before their signature is checked.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_DELTA_ENABLED             ( 1 )
+
+/**
+ * @brief Accept images compressed with gzip, which are decompressed before
+ * their signature is checked.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_GZIP_ENABLED              ( 1 )
+
+/**
+ * @brief Keep the image state in a checksummed state store, with the progress
+ * of the file being received, so that an interrupted transfer resumes after
+ * a restart.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_STATE_STORE_ENABLED       ( 1 )
+
+/**
+ * @brief Write the blocks of the file on a writer thread, so that the next
+ * blocks are received while the previous ones are written.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_WRITE_BEHIND_ENABLED      ( 1 )
+
 #endif /* OTA_CONFIG_H_ */
@@ -39,13 +39,19 @@
 /* Clock for timer. */
 #include "clock.h"
 
+/* Secure random numbers for the backoff jitter. */
+#include "random.h"
+
 /* pthread include. */
 #include <pthread.h>
-#include <semaphore.h>
 
 /* MQTT include. */
 #include "core_mqtt.h"
 #include "mqtt_subscription_manager.h"
+#include "mqtt_agent.h"
+
+/* Include header for the reserved topics of a thing. */
+#include "thing_topics.h"
 
 /*Include backoff algorithm header for retry logic.*/
 #include "backoff_algorithm.h"
@@ -129,15 +135,11 @@
 #define MQTT_KEEP_ALIVE_INTERVAL_SECONDS    ( 60U )
 
 /**
- * @brief Timeout for MQTT_ProcessLoop function in milliseconds.
+ * @brief Longest time in milliseconds MqttAgent_ProcessLoop waits for a
+ * command or an incoming packet.
  */
 #define MQTT_PROCESS_LOOP_TIMEOUT_MS        ( 100U )
 
-/**
- * @brief Period for demo loop sleep in milliseconds.
- */
-#define OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS    ( 5U )
-
 /**
  * @brief Size of the network buffer to receive the MQTT message.
  *
@@ -217,26 +219,6 @@
     #define CLIENT_USERNAME_WITH_METRICS    CLIENT_USERNAME METRICS_STRING
 #endif
 
-/**
- * @brief The common prefix for all OTA topics.
- */
-#define OTA_TOPIC_PREFIX           "$aws/things/"
-
-/**
- * @brief The string used for jobs topics.
- */
-#define OTA_TOPIC_JOBS             "jobs"
-
-/**
- * @brief The string used for streaming service topics.
- */
-#define OTA_TOPIC_STREAM           "streams"
-
-/**
- * @brief The length of #OTA_TOPIC_PREFIX
- */
-#define OTA_TOPIC_PREFIX_LENGTH    ( ( uint16_t ) ( sizeof( OTA_TOPIC_PREFIX ) - 1U ) )
-
 /*-----------------------------------------------------------*/
 
 /* Linkage for error reporting. */
@@ -279,24 +261,20 @@ static bool mqttSessionEstablished = false;
 static OpensslParams_t opensslParams;
 
 /**
- * @brief Mutex for synchronizing coreMQTT API calls.
+ * @brief Agent owning the MQTT context on the demo thread, which runs the
+ * coreMQTT API calls of the OTA agent thread.
  */
-static pthread_mutex_t mqttMutex;
+static MqttAgent_t mqttAgent;
 
 /**
- * @brief Semaphore for synchronizing buffer operations.
+ * @brief The reserved topics of the thing, assembled once at startup.
  */
-static sem_t bufferSemaphore;
+static ThingTopics_t thingTopics;
 
 /**
- * @brief Enum for type of OTA messages received.
+ * @brief The buffer holding #thingTopics.
  */
-typedef enum OtaMessageType
-{
-    OtaMessageTypeJob = 0,
-    OtaMessageTypeStream,
-    OtaNumOfMessageType
-} OtaMessageType_t;
+static char thingTopicsBuffer[ THING_TOPICS_BUFFER_SIZE( CLIENT_IDENTIFIER_LENGTH ) ];
 
 /**
  * @brief The network buffer must remain valid when OTA library task is running.
@@ -333,6 +311,21 @@ uint8_t bitmap[ OTA_MAX_BLOCK_BITMAP_SIZE ];
  */
 static OtaEventData_t eventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
 
+/**
+ * @brief Number of event buffers in use.
+ */
+static uint32_t eventBuffersInUse = 0U;
+
+/**
+ * @brief Largest number of event buffers in use at the same time.
+ */
+static uint32_t eventBuffersHighWaterMark = 0U;
+
+/**
+ * @brief Number of times an event buffer was requested while all were in use.
+ */
+static uint32_t eventBuffersExhaustedCount = 0U;
+
 /**
  * @brief The buffer passed to the OTA Agent from application while initializing.
  */
@@ -392,11 +385,19 @@ static OtaMqttStatus_t mqttPublish( const char * const pacTopic,
                                     uint8_t qos );
 
 /**
- * @brief Subscribe to the MQTT topic filter, and registers the handler for the topic filter with the subscription manager.
+ * @brief Assemble the reserved topics of the thing, and register the
+ * callbacks of the topics of the OTA agent with the subscription manager.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int registerOtaCallbacks( void );
+
+/**
+ * @brief Subscribe to the MQTT topic filter.
  *
  * This function subscribes to the Mqtt topics with the Quality of service
- * received as parameter. This function also registers a callback for the
- * topicfilter.
+ * received as parameter. The callbacks of the topics were registered by
+ * #registerOtaCallbacks.
  *
  * @param[in] pTopicFilter Mqtt topic filter.
  *
@@ -551,23 +552,15 @@ static void mqttJobCallback( MQTTContext_t * pContext,
 static void mqttDataCallback( MQTTContext_t * pContext,
                               MQTTPublishInfo_t * pPublishInfo );
 
-static SubscriptionManagerCallback_t otaMessageCallback[ OtaNumOfMessageType ] = { mqttJobCallback, mqttDataCallback };
-
 /*-----------------------------------------------------------*/
 
 void otaEventBufferFree( OtaEventData_t * const pxBuffer )
 {
-    if( sem_wait( &bufferSemaphore ) == 0 )
-    {
-        pxBuffer->bufferUsed = false;
-        ( void ) sem_post( &bufferSemaphore );
-    }
-    else
-    {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* The count is decremented first, so that it never exceeds the number
+     * of buffers. The release ordering makes the use of the buffer complete
+     * before another thread can claim it. */
+    ( void ) __atomic_sub_fetch( &eventBuffersInUse, 1U, __ATOMIC_RELAXED );
+    __atomic_store_n( &pxBuffer->bufferUsed, false, __ATOMIC_RELEASE );
 }
 
 /*-----------------------------------------------------------*/
@@ -576,26 +569,47 @@ OtaEventData_t * otaEventBufferGet( void )
 {
     uint32_t ulIndex = 0;
     OtaEventData_t * pFreeBuffer = NULL;
+    bool bufferUsed = false;
+    uint32_t inUse = 0U;
+    uint32_t highWaterMark = 0U;
 
-    if( sem_wait( &bufferSemaphore ) == 0 )
+    /* The MQTT callbacks and the OTA agent thread claim a buffer without a
+     * lock, by atomically setting its flag. */
+    for( ulIndex = 0; ( ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS ) && ( pFreeBuffer == NULL ); ulIndex++ )
     {
-        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
+        bufferUsed = false;
+
+        if( __atomic_compare_exchange_n( &eventBuffer[ ulIndex ].bufferUsed,
+                                         &bufferUsed,
+                                         true,
+                                         false,
+                                         __ATOMIC_ACQUIRE,
+                                         __ATOMIC_RELAXED ) == true )
         {
-            if( eventBuffer[ ulIndex ].bufferUsed == false )
-            {
-                eventBuffer[ ulIndex ].bufferUsed = true;
-                pFreeBuffer = &eventBuffer[ ulIndex ];
-                break;
-            }
+            pFreeBuffer = &eventBuffer[ ulIndex ];
         }
+    }
 
-        ( void ) sem_post( &bufferSemaphore );
+    if( pFreeBuffer != NULL )
+    {
+        inUse = __atomic_add_fetch( &eventBuffersInUse, 1U, __ATOMIC_RELAXED );
+        highWaterMark = __atomic_load_n( &eventBuffersHighWaterMark, __ATOMIC_RELAXED );
+
+        /* A failed exchange loads the high-water mark set by another thread. */
+        while( ( inUse > highWaterMark ) &&
+               ( __atomic_compare_exchange_n( &eventBuffersHighWaterMark,
+                                              &highWaterMark,
+                                              inUse,
+                                              true,
+                                              __ATOMIC_RELAXED,
+                                              __ATOMIC_RELAXED ) == false ) )
+        {
+            /* Retry with the new high-water mark. */
+        }
     }
     else
     {
-        LogError( ( "Failed to get buffer semaphore: "
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        ( void ) __atomic_add_fetch( &eventBuffersExhaustedCount, 1U, __ATOMIC_RELAXED );
     }
 
     return pFreeBuffer;
@@ -691,7 +705,21 @@ static void mqttJobCallback( MQTTContext_t * pContext,
 
     LogInfo( ( "Received job message callback, size %ld.\n\n", pPublishInfo->payloadLength ) );
 
-    pData = otaEventBufferGet();
+    if( pPublishInfo->payloadLength > sizeof( pData->data ) )
+    {
+        LogError( ( "Dropping job document: Payload of %zu bytes does not fit an OTA data buffer.",
+                    pPublishInfo->payloadLength ) );
+        pData = NULL;
+    }
+    else
+    {
+        pData = otaEventBufferGet();
+
+        if( pData == NULL )
+        {
+            LogError( ( "No OTA data buffers available." ) );
+        }
+    }
 
     if( pData != NULL )
     {
@@ -703,10 +731,6 @@ static void mqttJobCallback( MQTTContext_t * pContext,
         /* Send job document received event. */
         OTA_SignalEvent( &eventMsg );
     }
-    else
-    {
-        LogError( ( "No OTA data buffers available." ) );
-    }
 }
 
 /*-----------------------------------------------------------*/
@@ -724,10 +748,26 @@ static void mqttDataCallback( MQTTContext_t * pContext,
 
     LogInfo( ( "Received data message callback, size %zu.\n\n", pPublishInfo->payloadLength ) );
 
-    pData = otaEventBufferGet();
+    if( pPublishInfo->payloadLength > sizeof( pData->data ) )
+    {
+        LogError( ( "Dropping file block: Payload of %zu bytes does not fit an OTA data buffer.",
+                    pPublishInfo->payloadLength ) );
+        pData = NULL;
+    }
+    else
+    {
+        pData = otaEventBufferGet();
+
+        if( pData == NULL )
+        {
+            LogError( ( "No OTA data buffers available." ) );
+        }
+    }
 
     if( pData != NULL )
     {
+        /* The payload is copied, as the MQTT network buffer is reused for
+         * the next packet once this callback returns. */
         memcpy( pData->data, pPublishInfo->pPayload, pPublishInfo->payloadLength );
         pData->dataLength = pPublishInfo->payloadLength;
         eventMsg.eventId = OtaAgentEventReceivedFileBlock;
@@ -736,10 +776,6 @@ static void mqttDataCallback( MQTTContext_t * pContext,
         /* Send job document received event. */
         OTA_SignalEvent( &eventMsg );
     }
-    else
-    {
-        LogError( ( "No OTA data buffers available." ) );
-    }
 }
 
 /*-----------------------------------------------------------*/
@@ -799,7 +835,7 @@ static void mqttEventCallback( MQTTContext_t * pMqttContext,
 
 static uint32_t generateRandomNumber()
 {
-    return( rand() );
+    return Random_GetUint32();
 }
 
 /*-----------------------------------------------------------*/
@@ -860,6 +896,7 @@ static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext
     serverInfo.pHostName = AWS_IOT_ENDPOINT;
     serverInfo.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
     serverInfo.port = AWS_MQTT_PORT;
+    serverInfo.pSocketOptions = NULL;
 
     /* Initialize credentials for establishing TLS session. */
     memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
@@ -1011,19 +1048,9 @@ static int establishMqttSession( MQTTContext_t * pMqttContext )
         connectInfo.passwordLength = 0U;
     #endif /* ifdef CLIENT_USERNAME */
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send MQTT CONNECT packet to broker. */
-        mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Connect"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send MQTT CONNECT packet to broker. The demo thread owns the MQTT
+     * context, so the call is made directly. */
+    mqttStatus = MQTT_Connect( pMqttContext, &connectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &sessionPresent );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1101,22 +1128,11 @@ static void disconnect( void )
 
     if( mqttSessionEstablished == true )
     {
-        if( pthread_mutex_lock( &mqttMutex ) == 0 )
-        {
-            /* Disconnect MQTT session. */
-            MQTT_Disconnect( &mqttContext );
+        /* Disconnect MQTT session. */
+        MQTT_Disconnect( &mqttContext );
 
-            /* Clear the mqtt session flag. */
-            mqttSessionEstablished = false;
-
-            pthread_mutex_unlock( &mqttMutex );
-        }
-        else
-        {
-            LogError( ( "Failed to acquire mutex to execute MQTT_Disconnect"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-        }
+        /* Clear the mqtt session flag. */
+        mqttSessionEstablished = false;
     }
     else
     {
@@ -1129,100 +1145,60 @@ static void disconnect( void )
 
 /*-----------------------------------------------------------*/
 
-static OtaMessageType_t getOtaMessageType( const char * pTopicFilter,
-                                           uint16_t topicFilterLength )
+static int registerOtaCallbacks( void )
 {
-    int retStatus = EXIT_FAILURE;
-
-    uint16_t stringIndex = 0U, fieldLength = 0U, i = 0U;
-    OtaMessageType_t retMesageType = OtaNumOfMessageType;
+    int returnStatus = EXIT_SUCCESS;
+    ThingTopicsStatus_t topicsStatus = ThingTopicsSuccess;
+    SubscriptionManagerStatus_t subscriptionStatus = SUBSCRIPTION_MANAGER_SUCCESS;
+    uint32_t i = 0U;
 
-    /* Lookup table for OTA message string. */
-    static const char * const pOtaMessageStrings[ OtaNumOfMessageType ] =
+    /* The topics the OTA agent subscribes to, with their callbacks. The
+     * filter of the streams matches the data topic of any stream, so the
+     * subscriptions of the agent need no registration of their own. */
+    static const ThingTopic_t otaTopics[] =
     {
-        OTA_TOPIC_JOBS,
-        OTA_TOPIC_STREAM
+        ThingTopicJobsNotifyNext,
+        ThingTopicJobsNextGetAccepted,
+        ThingTopicStreamsDataCbor
     };
-
-    /* Check topic prefix is valid.*/
-    if( strncmp( pTopicFilter, OTA_TOPIC_PREFIX, ( size_t ) OTA_TOPIC_PREFIX_LENGTH ) == 0 )
+    static const SubscriptionManagerCallback_t otaCallbacks[] =
     {
-        stringIndex = OTA_TOPIC_PREFIX_LENGTH;
+        mqttJobCallback,
+        mqttJobCallback,
+        mqttDataCallback
+    };
 
-        retStatus = EXIT_SUCCESS;
-    }
+    topicsStatus = ThingTopics_Init( &thingTopics,
+                                     CLIENT_IDENTIFIER,
+                                     CLIENT_IDENTIFIER_LENGTH,
+                                     thingTopicsBuffer,
+                                     sizeof( thingTopicsBuffer ) );
 
-    /* Check if thing name is valid.*/
-    if( retStatus == EXIT_SUCCESS )
+    if( topicsStatus != ThingTopicsSuccess )
     {
-        retStatus = EXIT_FAILURE;
-
-        /* Extract the thing name.*/
-        for( ; stringIndex < topicFilterLength; stringIndex++ )
-        {
-            if( pTopicFilter[ stringIndex ] == ( char ) '/' )
-            {
-                break;
-            }
-            else
-            {
-                fieldLength++;
-            }
-        }
-
-        if( fieldLength > 0 )
-        {
-            /* Check thing name.*/
-            if( strncmp( &pTopicFilter[ stringIndex - fieldLength ],
-                         CLIENT_IDENTIFIER,
-                         ( size_t ) ( fieldLength ) ) == 0 )
-            {
-                stringIndex++;
+        LogError( ( "Failed to assemble the topics of the thing %s with error = %d.",
+                    CLIENT_IDENTIFIER,
+                    topicsStatus ) );
 
-                retStatus = EXIT_SUCCESS;
-            }
-        }
+        returnStatus = EXIT_FAILURE;
     }
 
-    /* Check the message type from topic.*/
-    if( retStatus == EXIT_SUCCESS )
+    for( i = 0U; ( i < ( sizeof( otaTopics ) / sizeof( otaTopics[ 0 ] ) ) ) && ( returnStatus == EXIT_SUCCESS ); i++ )
     {
-        fieldLength = 0;
+        subscriptionStatus = SubscriptionManager_RegisterCallback( THING_TOPICS_STRING( &thingTopics, otaTopics[ i ] ),
+                                                                   THING_TOPICS_LENGTH( &thingTopics, otaTopics[ i ] ),
+                                                                   otaCallbacks[ i ] );
 
-        /* Extract the topic type.*/
-        for( ; stringIndex < topicFilterLength; stringIndex++ )
+        if( subscriptionStatus != SUBSCRIPTION_MANAGER_SUCCESS )
         {
-            if( pTopicFilter[ stringIndex ] == ( char ) '/' )
-            {
-                break;
-            }
-            else
-            {
-                fieldLength++;
-            }
-        }
-
-        if( fieldLength > 0 )
-        {
-            for( i = 0; i < OtaNumOfMessageType; i++ )
-            {
-                /* check thing name.*/
-                if( strncmp( &pTopicFilter[ stringIndex - fieldLength ],
-                             pOtaMessageStrings[ i ],
-                             ( size_t ) ( fieldLength ) ) == 0 )
-                {
-                    break;
-                }
-            }
+            LogError( ( "Failed to register a callback to subscription manager with error = %d.",
+                        subscriptionStatus ) );
 
-            if( i < OtaNumOfMessageType )
-            {
-                retMesageType = i;
-            }
+            returnStatus = EXIT_FAILURE;
         }
     }
 
-    return retMesageType;
+    return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
@@ -1232,14 +1208,10 @@ static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
                                       uint8_t qos )
 {
     OtaMqttStatus_t otaRet = OtaMqttSuccess;
-    SubscriptionManagerStatus_t subscriptionStatus = SUBSCRIPTION_MANAGER_SUCCESS;
-    OtaMessageType_t otaMessageType;
 
     MQTTStatus_t mqttStatus;
-    MQTTContext_t * pMqttContext = &mqttContext;
     MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
 
-    assert( pMqttContext != NULL );
     assert( pTopicFilter != NULL );
     assert( topicFilterLength > 0 );
 
@@ -1252,22 +1224,10 @@ static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
     pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
     pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send SUBSCRIBE packet. */
-        mqttStatus = MQTT_Subscribe( pMqttContext,
-                                     pSubscriptionList,
-                                     sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                     MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Subscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send SUBSCRIBE packet from the thread owning the MQTT context. */
+    mqttStatus = MqttAgent_Subscribe( &mqttAgent,
+                                      pSubscriptionList,
+                                      sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ) );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1283,21 +1243,6 @@ static OtaMqttStatus_t mqttSubscribe( const char * pTopicFilter,
                    pTopicFilter ) );
     }
 
-    otaMessageType = getOtaMessageType( pTopicFilter, topicFilterLength );
-
-    assert( ( otaMessageType >= 0 ) && ( otaMessageType < OtaNumOfMessageType ) );
-
-    /* Register callback to subscription manager. */
-    subscriptionStatus = SubscriptionManager_RegisterCallback( pTopicFilter,
-                                                               topicFilterLength,
-                                                               otaMessageCallback[ otaMessageType ] );
-
-    if( subscriptionStatus != SUBSCRIPTION_MANAGER_SUCCESS )
-    {
-        LogWarn( ( "Failed to register a callback to subscription manager with error = %d.",
-                   subscriptionStatus ) );
-    }
-
     return otaRet;
 }
 
@@ -1313,7 +1258,6 @@ static OtaMqttStatus_t mqttPublish( const char * const pacTopic,
 
     MQTTStatus_t mqttStatus = MQTTBadParameter;
     MQTTPublishInfo_t publishInfo = { 0 };
-    MQTTContext_t * pMqttContext = &mqttContext;
 
     /* Set the required publish parameters. */
     publishInfo.pTopicName = pacTopic;
@@ -1322,20 +1266,8 @@ static OtaMqttStatus_t mqttPublish( const char * const pacTopic,
     publishInfo.pPayload = pMsg;
     publishInfo.payloadLength = msgSize;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &publishInfo,
-                                   MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mqtt mutex for executing MQTT_Publish"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send PUBLISH packet from the thread owning the MQTT context. */
+    mqttStatus = MqttAgent_Publish( &mqttAgent, &publishInfo );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1363,7 +1295,6 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     MQTTStatus_t mqttStatus = MQTTBadParameter;
 
     MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
-    MQTTContext_t * pMqttContext = &mqttContext;
 
     ( void ) qos;
 
@@ -1374,22 +1305,10 @@ static OtaMqttStatus_t mqttUnsubscribe( const char * pTopicFilter,
     pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
     pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
 
-    if( pthread_mutex_lock( &mqttMutex ) == 0 )
-    {
-        /* Send UNSUBSCRIBE packet. */
-        mqttStatus = MQTT_Unsubscribe( pMqttContext,
-                                       pSubscriptionList,
-                                       sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                       MQTT_GetPacketId( pMqttContext ) );
-
-        pthread_mutex_unlock( &mqttMutex );
-    }
-    else
-    {
-        LogError( ( "Failed to acquire mutex for executing MQTT_Unsubscribe"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-    }
+    /* Send UNSUBSCRIBE packet from the thread owning the MQTT context. */
+    mqttStatus = MqttAgent_Unsubscribe( &mqttAgent,
+                                        pSubscriptionList,
+                                        sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ) );
 
     if( mqttStatus != MQTTSuccess )
     {
@@ -1488,6 +1407,11 @@ static int startOTADemo( void )
 
     /****************************** Init OTA Library. ******************************/
 
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        returnStatus = registerOtaCallbacks();
+    }
+
     if( returnStatus == EXIT_SUCCESS )
     {
         if( ( otaRet = OTA_Init( &otaBuffer,
@@ -1548,20 +1472,9 @@ static int startOTADemo( void )
 
             if( mqttSessionEstablished == true )
             {
-                /* Acquire the mqtt mutex lock. */
-                if( pthread_mutex_lock( &mqttMutex ) == 0 )
-                {
-                    /* Loop to receive packet from transport interface. */
-                    mqttStatus = MQTT_ProcessLoop( &mqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
-
-                    pthread_mutex_unlock( &mqttMutex );
-                }
-                else
-                {
-                    LogError( ( "Failed to acquire mutex to execute process loop"
-                                ",errno=%s",
-                                strerror( errno ) ) );
-                }
+                /* Run the MQTT operations of the OTA agent thread and
+                 * receive packets from the transport interface. */
+                mqttStatus = MqttAgent_ProcessLoop( &mqttAgent, MQTT_PROCESS_LOOP_TIMEOUT_MS );
 
                 if( mqttStatus == MQTTSuccess )
                 {
@@ -1573,12 +1486,6 @@ static int startOTADemo( void )
                                otaStatistics.otaPacketsQueued,
                                otaStatistics.otaPacketsProcessed,
                                otaStatistics.otaPacketsDropped ) );
-
-                    /* Delay if mqtt process loop is set to zero.*/
-                    if( MQTT_PROCESS_LOOP_TIMEOUT_MS > 0 )
-                    {
-                        Clock_SleepMs( OTA_EXAMPLE_LOOP_SLEEP_PERIOD_MS );
-                    }
                 }
                 else
                 {
@@ -1623,6 +1530,11 @@ static int startOTADemo( void )
                     returnStatus ) );
     }
 
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        /* No more files are verified once the OTA thread has exited. */
+        otaPal_FreeSignerKeyCache();
+    #endif
+
     return returnStatus;
 }
 
@@ -1647,39 +1559,22 @@ int main( int argc,
     /* Return error status. */
     int returnStatus = EXIT_SUCCESS;
 
-    /* Semaphore initialization flag. */
-    bool bufferSemInitialized = false;
-    bool mqttMutexInitialized = false;
+    /* MQTT agent initialization flag. */
+    bool mqttAgentInitialized = false;
 
     /* Maximum time in milliseconds to wait before exiting demo . */
     int16_t waitTimeoutMs = OTA_DEMO_EXIT_TIMEOUT_MS;
 
-    /* Initialize semaphore for buffer operations. */
-    if( sem_init( &bufferSemaphore, 0, 1 ) != 0 )
+    /* Initialize the agent owning the MQTT context on this thread. */
+    if( MqttAgent_Init( &mqttAgent, &mqttContext, &opensslParams ) != MQTT_AGENT_SUCCESS )
     {
-        LogError( ( "Failed to initialize buffer semaphore"
-                    ",errno=%s",
-                    strerror( errno ) ) );
+        LogError( ( "Failed to initialize the MQTT agent." ) );
 
         returnStatus = EXIT_FAILURE;
     }
     else
     {
-        bufferSemInitialized = true;
-    }
-
-    /* Initialize mutex for coreMQTT APIs. */
-    if( pthread_mutex_init( &mqttMutex, NULL ) != 0 )
-    {
-        LogError( ( "Failed to initialize mutex for mqtt apis"
-                    ",errno=%s",
-                    strerror( errno ) ) );
-
-        returnStatus = EXIT_FAILURE;
-    }
-    else
-    {
-        mqttMutexInitialized = true;
+        mqttAgentInitialized = true;
     }
 
     if( returnStatus == EXIT_SUCCESS )
@@ -1698,30 +1593,16 @@ int main( int argc,
     /* Disconnect from broker and close connection. */
     disconnect();
 
-    if( bufferSemInitialized == true )
-    {
-        /* Cleanup semaphore created for buffer operations. */
-        if( sem_destroy( &bufferSemaphore ) != 0 )
-        {
-            LogError( ( "Failed to destroy buffer semaphore"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            returnStatus = EXIT_FAILURE;
-        }
-    }
+    /* Report whether otaconfigMAX_NUM_OTA_DATA_BUFFERS was large enough. */
+    LogInfo( ( "OTA event buffers: High-water mark=%u of %u, Exhausted=%u times.",
+               ( unsigned int ) __atomic_load_n( &eventBuffersHighWaterMark, __ATOMIC_RELAXED ),
+               ( unsigned int ) otaconfigMAX_NUM_OTA_DATA_BUFFERS,
+               ( unsigned int ) __atomic_load_n( &eventBuffersExhaustedCount, __ATOMIC_RELAXED ) ) );
 
-    if( mqttMutexInitialized == true )
+    if( mqttAgentInitialized == true )
     {
-        /* Cleanup mutex created for MQTT operations. */
-        if( pthread_mutex_destroy( &mqttMutex ) != 0 )
-        {
-            LogError( ( "Failed to destroy mutex for mqtt apis"
-                        ",errno=%s",
-                        strerror( errno ) ) );
-
-            returnStatus = EXIT_FAILURE;
-        }
+        /* Release the MQTT agent once the OTA agent thread has stopped. */
+        ( void ) MqttAgent_Deinit( &mqttAgent );
     }
 
     /* Wait and log message before exiting demo. */
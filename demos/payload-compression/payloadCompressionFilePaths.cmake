@@ -0,0 +1,13 @@
+# This file is to add source files and include directories
+# into variables so that it can be reused from different demos
+# in their Cmake based build system by including this file.
+#
+# The payload compression is built on zlib, so demos link z.
+
+# Payload compression source files.
+set( PAYLOAD_COMPRESSION_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/payload_compression.c )
+
+# Payload compression include directories.
+set( PAYLOAD_COMPRESSION_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
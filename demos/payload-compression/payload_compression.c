@@ -0,0 +1,321 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file payload_compression.c
+ * @brief Implementation of the compression of MQTT payloads with preset
+ * dictionaries.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Include header for the payload compression. */
+#include "payload_compression.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find a known dictionary by its identifier.
+ *
+ * @param[in] pCompression The compression.
+ * @param[in] dictionaryId The identifier, other than #PAYLOAD_DICTIONARY_NONE.
+ *
+ * @return The dictionary, or NULL if it is not known.
+ */
+static const PayloadDictionary_t * findDictionary( const PayloadCompression_t * pCompression,
+                                                   uint8_t dictionaryId );
+
+/*-----------------------------------------------------------*/
+
+static const PayloadDictionary_t * findDictionary( const PayloadCompression_t * pCompression,
+                                                   uint8_t dictionaryId )
+{
+    const PayloadDictionary_t * pDictionary = NULL;
+    size_t i = 0U;
+
+    for( i = 0U; ( i < pCompression->dictionaryCount ) && ( pDictionary == NULL ); i++ )
+    {
+        if( pCompression->pDictionaries[ i ].id == dictionaryId )
+        {
+            pDictionary = &( pCompression->pDictionaries[ i ] );
+        }
+    }
+
+    return pDictionary;
+}
+
+/*-----------------------------------------------------------*/
+
+PayloadCompressionStatus_t PayloadCompression_Init( PayloadCompression_t * pCompression,
+                                                    const PayloadDictionary_t * pDictionaries,
+                                                    size_t dictionaryCount )
+{
+    PayloadCompressionStatus_t returnStatus = PayloadCompressionSuccess;
+    size_t i = 0U;
+
+    if( ( pCompression == NULL ) || ( ( pDictionaries == NULL ) && ( dictionaryCount > 0U ) ) )
+    {
+        returnStatus = PayloadCompressionBadParameter;
+    }
+    else
+    {
+        for( i = 0U; ( i < dictionaryCount ) && ( returnStatus == PayloadCompressionSuccess ); i++ )
+        {
+            if( ( pDictionaries[ i ].id == PAYLOAD_DICTIONARY_NONE ) ||
+                ( pDictionaries[ i ].pData == NULL ) ||
+                ( pDictionaries[ i ].length == 0U ) ||
+                ( pDictionaries[ i ].length > ( size_t ) UINT32_MAX ) )
+            {
+                LogError( ( "Invalid payload dictionary at index %u.", ( unsigned int ) i ) );
+                returnStatus = PayloadCompressionBadParameter;
+            }
+        }
+    }
+
+    if( returnStatus == PayloadCompressionSuccess )
+    {
+        ( void ) memset( pCompression, 0, sizeof( PayloadCompression_t ) );
+        pCompression->pDictionaries = pDictionaries;
+        pCompression->dictionaryCount = dictionaryCount;
+
+        /* Raw deflate streams, without the zlib header and checksum, as the
+         * header of the payload already tells how to decompress it and MQTT
+         * runs over TLS. */
+        if( deflateInit2( &( pCompression->deflateStream ),
+                          PAYLOAD_COMPRESSION_LEVEL,
+                          Z_DEFLATED,
+                          -PAYLOAD_COMPRESSION_WINDOW_BITS,
+                          PAYLOAD_COMPRESSION_MEM_LEVEL,
+                          Z_DEFAULT_STRATEGY ) == Z_OK )
+        {
+            pCompression->deflateReady = true;
+        }
+
+        if( inflateInit2( &( pCompression->inflateStream ),
+                          -PAYLOAD_COMPRESSION_WINDOW_BITS ) == Z_OK )
+        {
+            pCompression->inflateReady = true;
+        }
+
+        if( ( pCompression->deflateReady == false ) || ( pCompression->inflateReady == false ) )
+        {
+            LogError( ( "Failed to initialize zlib." ) );
+            PayloadCompression_Cleanup( pCompression );
+            returnStatus = PayloadCompressionNoMemory;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+PayloadCompressionStatus_t PayloadCompression_Compress( PayloadCompression_t * pCompression,
+                                                        uint8_t dictionaryId,
+                                                        const uint8_t * pPayload,
+                                                        size_t payloadLength,
+                                                        uint8_t * pOutput,
+                                                        size_t outputSize,
+                                                        size_t * pOutputLength )
+{
+    PayloadCompressionStatus_t returnStatus = PayloadCompressionSuccess;
+    const PayloadDictionary_t * pDictionary = NULL;
+    z_stream * pStream = NULL;
+    size_t limit = 0U;
+    int zlibStatus = Z_OK;
+
+    if( ( pCompression == NULL ) || ( pCompression->deflateReady == false ) ||
+        ( pPayload == NULL ) || ( pOutput == NULL ) || ( pOutputLength == NULL ) ||
+        ( payloadLength > ( size_t ) UINT32_MAX ) )
+    {
+        returnStatus = PayloadCompressionBadParameter;
+    }
+    else if( dictionaryId != PAYLOAD_DICTIONARY_NONE )
+    {
+        pDictionary = findDictionary( pCompression, dictionaryId );
+
+        if( pDictionary == NULL )
+        {
+            returnStatus = PayloadCompressionUnknownDictionary;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( returnStatus == PayloadCompressionSuccess )
+    {
+        /* The compressed payload, header included, must be shorter than the
+         * payload, so deflate stops as soon as it is not. */
+        limit = ( outputSize < payloadLength ) ? outputSize : ( payloadLength - 1U );
+
+        if( ( payloadLength == 0U ) || ( limit <= PAYLOAD_COMPRESSION_HEADER_LENGTH ) )
+        {
+            returnStatus = PayloadCompressionNotSmaller;
+        }
+    }
+
+    if( returnStatus == PayloadCompressionSuccess )
+    {
+        pStream = &( pCompression->deflateStream );
+        ( void ) deflateReset( pStream );
+
+        /* A raw stream takes its dictionary again after each reset. */
+        if( pDictionary != NULL )
+        {
+            ( void ) deflateSetDictionary( pStream, pDictionary->pData, ( uInt ) pDictionary->length );
+        }
+
+        pOutput[ 0 ] = ( uint8_t ) PAYLOAD_COMPRESSION_MARKER;
+        pOutput[ 1 ] = dictionaryId;
+
+        /* zlib does not write to its input. */
+        pStream->next_in = ( Bytef * ) pPayload;
+        pStream->avail_in = ( uInt ) payloadLength;
+        pStream->next_out = &( pOutput[ PAYLOAD_COMPRESSION_HEADER_LENGTH ] );
+        pStream->avail_out = ( uInt ) ( limit - PAYLOAD_COMPRESSION_HEADER_LENGTH );
+
+        zlibStatus = deflate( pStream, Z_FINISH );
+
+        if( zlibStatus == Z_STREAM_END )
+        {
+            *pOutputLength = PAYLOAD_COMPRESSION_HEADER_LENGTH + ( size_t ) pStream->total_out;
+        }
+        else
+        {
+            returnStatus = PayloadCompressionNotSmaller;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool PayloadCompression_IsCompressed( const uint8_t * pPayload,
+                                      size_t payloadLength )
+{
+    return ( pPayload != NULL ) &&
+           ( payloadLength > PAYLOAD_COMPRESSION_HEADER_LENGTH ) &&
+           ( pPayload[ 0 ] == ( uint8_t ) PAYLOAD_COMPRESSION_MARKER );
+}
+
+/*-----------------------------------------------------------*/
+
+PayloadCompressionStatus_t PayloadCompression_Decompress( PayloadCompression_t * pCompression,
+                                                          const uint8_t * pPayload,
+                                                          size_t payloadLength,
+                                                          uint8_t * pOutput,
+                                                          size_t outputSize,
+                                                          size_t * pOutputLength )
+{
+    PayloadCompressionStatus_t returnStatus = PayloadCompressionSuccess;
+    const PayloadDictionary_t * pDictionary = NULL;
+    z_stream * pStream = NULL;
+    int zlibStatus = Z_OK;
+
+    if( ( pCompression == NULL ) || ( pCompression->inflateReady == false ) ||
+        ( pOutput == NULL ) || ( pOutputLength == NULL ) ||
+        ( payloadLength > ( size_t ) UINT32_MAX ) || ( outputSize > ( size_t ) UINT32_MAX ) )
+    {
+        returnStatus = PayloadCompressionBadParameter;
+    }
+    else if( PayloadCompression_IsCompressed( pPayload, payloadLength ) == false )
+    {
+        returnStatus = PayloadCompressionMalformed;
+    }
+    else if( pPayload[ 1 ] != PAYLOAD_DICTIONARY_NONE )
+    {
+        pDictionary = findDictionary( pCompression, pPayload[ 1 ] );
+
+        if( pDictionary == NULL )
+        {
+            LogWarn( ( "Compressed payload with unknown dictionary %u.",
+                       ( unsigned int ) pPayload[ 1 ] ) );
+            returnStatus = PayloadCompressionUnknownDictionary;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( returnStatus == PayloadCompressionSuccess )
+    {
+        pStream = &( pCompression->inflateStream );
+        ( void ) inflateReset( pStream );
+
+        /* A raw stream takes its dictionary before any input, as it has no
+         * header asking for it. */
+        if( pDictionary != NULL )
+        {
+            ( void ) inflateSetDictionary( pStream, pDictionary->pData, ( uInt ) pDictionary->length );
+        }
+
+        pStream->next_in = ( Bytef * ) &( pPayload[ PAYLOAD_COMPRESSION_HEADER_LENGTH ] );
+        pStream->avail_in = ( uInt ) ( payloadLength - PAYLOAD_COMPRESSION_HEADER_LENGTH );
+        pStream->next_out = pOutput;
+        pStream->avail_out = ( uInt ) outputSize;
+
+        zlibStatus = inflate( pStream, Z_FINISH );
+
+        if( zlibStatus == Z_STREAM_END )
+        {
+            *pOutputLength = ( size_t ) pStream->total_out;
+        }
+        else if( ( pStream->avail_out == 0U ) &&
+                 ( ( zlibStatus == Z_BUF_ERROR ) || ( zlibStatus == Z_OK ) ) )
+        {
+            returnStatus = PayloadCompressionNoMemory;
+        }
+        else
+        {
+            returnStatus = PayloadCompressionMalformed;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void PayloadCompression_Cleanup( PayloadCompression_t * pCompression )
+{
+    if( pCompression != NULL )
+    {
+        if( pCompression->deflateReady == true )
+        {
+            ( void ) deflateEnd( &( pCompression->deflateStream ) );
+            pCompression->deflateReady = false;
+        }
+
+        if( pCompression->inflateReady == true )
+        {
+            ( void ) inflateEnd( &( pCompression->inflateStream ) );
+            pCompression->inflateReady = false;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
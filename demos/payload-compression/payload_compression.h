@@ -0,0 +1,236 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file payload_compression.h
+ * @brief Compression of MQTT payloads with preset dictionaries shared with
+ * the subscribers.
+ *
+ * A compressed payload starts with #PAYLOAD_COMPRESSION_MARKER, which is
+ * never the first byte of a UTF-8 text, followed by the identifier of the
+ * dictionary, and then the raw deflate stream. Telemetry of a few hundred
+ * bytes compresses poorly on its own; a dictionary of the keys and values
+ * that recur across payloads gives deflate the history it lacks.
+ */
+
+#ifndef PAYLOAD_COMPRESSION_H_
+#define PAYLOAD_COMPRESSION_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the Payload Compression module. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Payload Compression"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* zlib include. */
+#include <zlib.h>
+
+/**
+ * @brief First byte of a compressed payload. It is invalid in UTF-8, so that
+ * a text payload is never taken for a compressed one.
+ */
+#define PAYLOAD_COMPRESSION_MARKER           ( 0xF5U )
+
+/**
+ * @brief Length of the header of a compressed payload: the marker and the
+ * identifier of the dictionary.
+ */
+#define PAYLOAD_COMPRESSION_HEADER_LENGTH    ( 2U )
+
+/**
+ * @brief Identifier of a payload compressed without a dictionary.
+ */
+#define PAYLOAD_DICTIONARY_NONE              ( 0U )
+
+/**
+ * @brief Base two logarithm of the window of deflate, from 9 to 15.
+ *
+ * Only the last 2 ^ #PAYLOAD_COMPRESSION_WINDOW_BITS bytes of a dictionary
+ * are used, and the peers must decompress with at least the same window.
+ * Compressing takes 2 ^ ( #PAYLOAD_COMPRESSION_WINDOW_BITS + 2 ) bytes, and
+ * decompressing 2 ^ #PAYLOAD_COMPRESSION_WINDOW_BITS bytes, besides the
+ * hash table of #PAYLOAD_COMPRESSION_MEM_LEVEL.
+ */
+#ifndef PAYLOAD_COMPRESSION_WINDOW_BITS
+    #define PAYLOAD_COMPRESSION_WINDOW_BITS    ( 12 )
+#endif
+
+/**
+ * @brief memLevel of deflate, from 1 to 9, its hash table taking
+ * 2 ^ ( #PAYLOAD_COMPRESSION_MEM_LEVEL + 9 ) bytes.
+ */
+#ifndef PAYLOAD_COMPRESSION_MEM_LEVEL
+    #define PAYLOAD_COMPRESSION_MEM_LEVEL    ( 5 )
+#endif
+
+/**
+ * @brief Compression level of deflate, from 1, the fastest, to 9.
+ */
+#ifndef PAYLOAD_COMPRESSION_LEVEL
+    #define PAYLOAD_COMPRESSION_LEVEL    ( 6 )
+#endif
+
+/**
+ * @brief Return codes of the payload compression.
+ */
+typedef enum PayloadCompressionStatus
+{
+    PayloadCompressionSuccess = 0,       /**< @brief The payload was compressed or decompressed. */
+    PayloadCompressionBadParameter,      /**< @brief A parameter was invalid. */
+    PayloadCompressionNotSmaller,        /**< @brief The compressed payload would not be smaller, so it is to be sent as is. */
+    PayloadCompressionNoMemory,          /**< @brief zlib could not allocate its state, or the decompressed payload does not fit. */
+    PayloadCompressionUnknownDictionary, /**< @brief The dictionary of the payload is not known. */
+    PayloadCompressionMalformed          /**< @brief The payload is not a valid compressed payload. */
+} PayloadCompressionStatus_t;
+
+/**
+ * @brief A preset dictionary, shared with the subscribers under its
+ * identifier.
+ *
+ * A dictionary is the bytes most likely to recur in the payloads, the most
+ * frequent last. A new version of a dictionary takes a new identifier, so
+ * that the payloads compressed with the previous one can still be
+ * decompressed while both are deployed.
+ */
+typedef struct PayloadDictionary
+{
+    uint8_t id;            /**< @brief Identifier sent in the header, other than #PAYLOAD_DICTIONARY_NONE. */
+    const uint8_t * pData; /**< @brief The dictionary. */
+    size_t length;         /**< @brief Length of #PayloadDictionary_t.pData. */
+} PayloadDictionary_t;
+
+/**
+ * @brief The streams of the compression, reused for all the payloads.
+ */
+typedef struct PayloadCompression
+{
+    z_stream deflateStream;                    /**< @brief Stream compressing the payloads. */
+    z_stream inflateStream;                    /**< @brief Stream decompressing the payloads. */
+    const PayloadDictionary_t * pDictionaries; /**< @brief The known dictionaries, which must remain valid. */
+    size_t dictionaryCount;                    /**< @brief Number of #PayloadCompression_t.pDictionaries. */
+    bool deflateReady;                         /**< @brief Whether #PayloadCompression_t.deflateStream is initialized. */
+    bool inflateReady;                         /**< @brief Whether #PayloadCompression_t.inflateStream is initialized. */
+} PayloadCompression_t;
+
+/**
+ * @brief Initialize the streams of the compression.
+ *
+ * @param[out] pCompression The compression to initialize.
+ * @param[in] pDictionaries The known dictionaries, which must remain valid
+ * until #PayloadCompression_Cleanup. NULL if there are none.
+ * @param[in] dictionaryCount Number of @p pDictionaries.
+ *
+ * @return #PayloadCompressionSuccess, #PayloadCompressionBadParameter or
+ * #PayloadCompressionNoMemory.
+ */
+PayloadCompressionStatus_t PayloadCompression_Init( PayloadCompression_t * pCompression,
+                                                    const PayloadDictionary_t * pDictionaries,
+                                                    size_t dictionaryCount );
+
+/**
+ * @brief Compress a payload, with its header, if that makes it smaller.
+ *
+ * @param[in] pCompression The compression.
+ * @param[in] dictionaryId The dictionary to use, or #PAYLOAD_DICTIONARY_NONE.
+ * @param[in] pPayload The payload.
+ * @param[in] payloadLength The length of @p pPayload.
+ * @param[out] pOutput Buffer receiving the compressed payload.
+ * @param[in] outputSize Size of @p pOutput.
+ * @param[out] pOutputLength Length of the compressed payload.
+ *
+ * @return #PayloadCompressionSuccess; #PayloadCompressionNotSmaller if the
+ * compressed payload would not be smaller than @p payloadLength or would not
+ * fit in @p pOutput; #PayloadCompressionUnknownDictionary or
+ * #PayloadCompressionBadParameter.
+ */
+PayloadCompressionStatus_t PayloadCompression_Compress( PayloadCompression_t * pCompression,
+                                                        uint8_t dictionaryId,
+                                                        const uint8_t * pPayload,
+                                                        size_t payloadLength,
+                                                        uint8_t * pOutput,
+                                                        size_t outputSize,
+                                                        size_t * pOutputLength );
+
+/**
+ * @brief Whether a payload starts with the header of a compressed payload.
+ *
+ * @param[in] pPayload The payload.
+ * @param[in] payloadLength The length of @p pPayload.
+ *
+ * @return true if the payload is to be decompressed.
+ */
+bool PayloadCompression_IsCompressed( const uint8_t * pPayload,
+                                      size_t payloadLength );
+
+/**
+ * @brief Decompress a payload compressed by #PayloadCompression_Compress.
+ *
+ * @param[in] pCompression The compression.
+ * @param[in] pPayload The compressed payload, header included.
+ * @param[in] payloadLength The length of @p pPayload.
+ * @param[out] pOutput Buffer receiving the payload.
+ * @param[in] outputSize Size of @p pOutput.
+ * @param[out] pOutputLength Length of the payload.
+ *
+ * @return #PayloadCompressionSuccess; #PayloadCompressionNoMemory if the
+ * payload does not fit in @p pOutput; #PayloadCompressionUnknownDictionary,
+ * #PayloadCompressionMalformed or #PayloadCompressionBadParameter.
+ */
+PayloadCompressionStatus_t PayloadCompression_Decompress( PayloadCompression_t * pCompression,
+                                                          const uint8_t * pPayload,
+                                                          size_t payloadLength,
+                                                          uint8_t * pOutput,
+                                                          size_t outputSize,
+                                                          size_t * pOutputLength );
+
+/**
+ * @brief Free the streams of the compression.
+ *
+ * @param[in] pCompression The compression.
+ */
+void PayloadCompression_Cleanup( PayloadCompression_t * pCompression );
+
+#endif /* ifndef PAYLOAD_COMPRESSION_H_ */
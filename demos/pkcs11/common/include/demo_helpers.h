@@ -51,6 +51,19 @@
  */
 #define pkcs11demoPUBLIC_KEY_LABEL     "Device Pub TLS Key"
 
+/*
+ * @brief Number of sessions of the session pool, one per thread using it.
+ */
+#ifndef pkcs11demoSESSION_POOL_SIZE
+    #define pkcs11demoSESSION_POOL_SIZE    4
+#endif
+
+/*
+ * @brief Number of label to object handle lookups cached by each thread.
+ */
+#ifndef pkcs11demoHANDLE_CACHE_SIZE
+    #define pkcs11demoHANDLE_CACHE_SIZE    4
+#endif
 
 /*
  * @brief This function contains standard setup code for PKCS #11. See the
@@ -78,6 +91,135 @@ void end( CK_SESSION_HANDLE session,
           CK_SLOT_ID * slotId );
 /*-----------------------------------------------------------*/
 
+/*
+ * @brief Initialize the PKCS #11 module, and open and log in to the first
+ * session of the pool on the calling thread.
+ *
+ * Unlike start, this runs once for a whole workload: the other threads get
+ * their sessions from sessionPoolGet without setting up the token again.
+ *
+ * @return CKR_OK if the session pool is ready.
+ */
+CK_RV sessionPoolInit( void );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Get the session of the calling thread, opening it on the first
+ * call from the thread. The session is logged in, as the login of the first
+ * session applies to all of them. The session stays in the pool until
+ * sessionPoolDeinit, even after the thread exits.
+ *
+ * @param[out] session           The session of the calling thread.
+ *
+ * @return CKR_OK, or the error of opening the session.
+ */
+CK_RV sessionPoolGet( CK_SESSION_HANDLE * session );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Close the sessions of the pool and finalize the PKCS #11 module.
+ * No thread may use a session of the pool anymore.
+ */
+void sessionPoolDeinit( void );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Find an object by label and class, as xFindObjectWithLabelAndClass
+ * does, but only search the token the first time the calling thread looks
+ * the object up.
+ *
+ * @param[in] session            An open session.
+ * @param[in] label              Label of the object.
+ * @param[in] labelLength        Length of label, as for
+ *                               xFindObjectWithLabelAndClass.
+ * @param[in] objectClass        Class of the object.
+ * @param[out] handle            The handle of the object; CK_INVALID_HANDLE
+ *                               if it is not found.
+ *
+ * @return CKR_OK, or the error of the search.
+ */
+CK_RV findObjectCached( CK_SESSION_HANDLE session,
+                        char * label,
+                        CK_ULONG labelLength,
+                        CK_OBJECT_CLASS objectClass,
+                        CK_OBJECT_HANDLE_PTR handle );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Destroy an object, and invalidate the cached lookups of all the
+ * threads.
+ *
+ * @param[in] session            An open session.
+ * @param[in] handle             The object to destroy.
+ *
+ * @return The result of C_DestroyObject.
+ */
+CK_RV destroyObjectCached( CK_SESSION_HANDLE session,
+                           CK_OBJECT_HANDLE handle );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Invalidate the cached lookups of all the threads, for instance after
+ * creating an object that replaces another one with the same label.
+ */
+void invalidateObjectCache( void );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Sign the SHA-256 digest of a message with an EC P-256 private key.
+ * See signMessages.
+ *
+ * @param[in] session            An open session.
+ * @param[in] privateKey         The private key.
+ * @param[in] message            Message to sign.
+ * @param[in] messageLength      Length of message.
+ * @param[out] signature         Buffer of
+ *                               pkcs11ECDSA_P256_SIGNATURE_LENGTH bytes for
+ *                               the signature.
+ * @param[out] signatureLength   Length of the signature.
+ *
+ * @return CKR_OK, or the error of the first step that failed.
+ */
+CK_RV signMessage( CK_SESSION_HANDLE session,
+                   CK_OBJECT_HANDLE privateKey,
+                   CK_BYTE_PTR message,
+                   CK_ULONG messageLength,
+                   CK_BYTE_PTR signature,
+                   CK_ULONG_PTR signatureLength );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Sign the SHA-256 digests of messages with an EC P-256 private key.
+ *
+ * The token hashes the messages as part of signing them when it supports
+ * CKM_ECDSA_SHA256. Otherwise they are hashed on the host, which saves the
+ * four C_Digest calls per message, and the digests are signed with CKM_ECDSA.
+ * The mechanism is chosen once for the batch, and the fixed signature length
+ * is used instead of asking C_Sign for it.
+ *
+ * @param[in] session            An open session.
+ * @param[in] privateKey         The private key.
+ * @param[in] messages           Messages to sign.
+ * @param[in] messageLengths     Lengths of messages.
+ * @param[in] messageCount       Number of messages.
+ * @param[out] signatures        Buffer of messageCount times
+ *                               pkcs11ECDSA_P256_SIGNATURE_LENGTH bytes; the
+ *                               signature of message i starts at i times
+ *                               pkcs11ECDSA_P256_SIGNATURE_LENGTH.
+ * @param[out] signatureLengths  Lengths of the signatures.
+ *
+ * @return CKR_OK if all the messages were signed, or the error of the first
+ * one that failed.
+ */
+CK_RV signMessages( CK_SESSION_HANDLE session,
+                    CK_OBJECT_HANDLE privateKey,
+                    CK_BYTE_PTR * messages,
+                    CK_ULONG_PTR messageLengths,
+                    CK_ULONG messageCount,
+                    CK_BYTE_PTR signatures,
+                    CK_ULONG_PTR signatureLengths );
+/*-----------------------------------------------------------*/
+
 /*
  * @brief This function is simply a helper function to print the raw hex values
  * of an EC public key. It's explanation is not within the scope of the demos
@@ -97,6 +239,9 @@ void writeHexBytesToConsole( char * description,
  * @brief This function is simply a helper function to export the raw hex values
  * of an EC public key into a buffer. It's explanation is not within the
  * scope of the demos and is sparsely commented.
+ *
+ * The buffer is allocated with Allocator_Malloc, and must be freed with
+ * Allocator_Free.
  */
 CK_RV exportPublicKey( CK_SESSION_HANDLE session,
                        CK_OBJECT_HANDLE publicKeyHandle,
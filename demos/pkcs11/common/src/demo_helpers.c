@@ -28,7 +28,9 @@
  * @brief Common functions used between the PKCS #11 demos.
  */
 /* Standard includes. */
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* Log includes. */
@@ -50,15 +52,152 @@
 /* mbed TLS includes. */
 #include "mbedtls/pk.h"
 #include "mbedtls/oid.h"
+#include "mbedtls/sha256.h"
 
 /* Helpers include. */
 #include "demo_helpers.h"
 
+/* Allocator include. */
+#include "allocator.h"
+
 
 /*
  * @brief macro to help print public key hex to serial.
  */
 #define BYTES_TO_DISPLAY_PER_ROW    16
+
+/*
+ * @brief A label to object handle lookup cached by a thread.
+ */
+typedef struct CachedObject
+{
+    char label[ pkcs11configMAX_LABEL_LENGTH + 1UL ]; /* Label of the object, as looked up. */
+    CK_ULONG labelLength;                             /* Length of label; 0 if the entry is unused. */
+    CK_OBJECT_CLASS objectClass;                      /* Class of the object. */
+    CK_OBJECT_HANDLE handle;                          /* Handle of the object. */
+} CachedObject_t;
+
+/*
+ * @brief Function list of the module, set by sessionPoolInit.
+ */
+static CK_FUNCTION_LIST_PTR poolFunctionList = NULL;
+
+/*
+ * @brief Slot of the sessions of the pool.
+ */
+static CK_SLOT_ID poolSlotId = 0;
+
+/*
+ * @brief Sessions opened by the threads, closed by sessionPoolDeinit.
+ */
+static CK_SESSION_HANDLE poolSessions[ pkcs11demoSESSION_POOL_SIZE ];
+
+/*
+ * @brief Number of entries of poolSessions claimed, accessed atomically.
+ */
+static uint32_t poolSessionCount = 0;
+
+/*
+ * @brief Incremented by sessionPoolInit and sessionPoolDeinit, so that a
+ * thread notices its session belongs to a previous pool. Accessed
+ * atomically; odd while the pool is ready.
+ */
+static uint32_t poolGeneration = 0;
+
+/*
+ * @brief Incremented to invalidate the caches of all the threads, accessed
+ * atomically.
+ */
+static uint32_t cacheGeneration = 0;
+
+/*
+ * @brief The session of this thread, valid while threadSessionGeneration
+ * equals poolGeneration.
+ */
+static __thread CK_SESSION_HANDLE threadSession = CK_INVALID_HANDLE;
+
+/*
+ * @brief The value of poolGeneration when threadSession was opened.
+ */
+static __thread uint32_t threadSessionGeneration = 0;
+
+/*
+ * @brief The lookups cached by this thread, valid while
+ * threadCacheGeneration equals cacheGeneration.
+ */
+static __thread CachedObject_t threadCache[ pkcs11demoHANDLE_CACHE_SIZE ];
+
+/*
+ * @brief The value of cacheGeneration when threadCache was last emptied.
+ */
+static __thread uint32_t threadCacheGeneration = 0;
+
+/*
+ * @brief Next entry of threadCache to replace once it is full.
+ */
+static __thread uint32_t threadCacheNext = 0;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Open a session of the pool, and keep it to be closed by
+ * sessionPoolDeinit.
+ *
+ * @param[out] session           The session opened.
+ *
+ * @return CKR_OK, CKR_SESSION_COUNT if the pool has no free entry, or the
+ * error of C_OpenSession.
+ */
+static CK_RV openPoolSession( CK_SESSION_HANDLE * session );
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Choose CKM_ECDSA_SHA256 if the token of the session can sign with
+ * it, and CKM_ECDSA otherwise.
+ *
+ * @param[in] functionList       Function list of the module.
+ * @param[in] session            An open session.
+ * @param[out] mechanismType     The mechanism chosen.
+ *
+ * @return CKR_OK, or the error of C_GetSessionInfo.
+ */
+static CK_RV selectSignMechanism( CK_FUNCTION_LIST_PTR functionList,
+                                  CK_SESSION_HANDLE session,
+                                  CK_MECHANISM_TYPE * mechanismType );
+/*-----------------------------------------------------------*/
+
+static CK_RV openPoolSession( CK_SESSION_HANDLE * session )
+{
+    CK_RV result = CKR_OK;
+    uint32_t index = __atomic_fetch_add( &poolSessionCount, 1U, __ATOMIC_RELAXED );
+
+    if( index >= pkcs11demoSESSION_POOL_SIZE )
+    {
+        LogError( ( "The session pool has no free session; increase pkcs11demoSESSION_POOL_SIZE." ) );
+        ( void ) __atomic_fetch_sub( &poolSessionCount, 1U, __ATOMIC_RELAXED );
+        result = CKR_SESSION_COUNT;
+    }
+    else
+    {
+        result = poolFunctionList->C_OpenSession( poolSlotId,
+                                                  CKF_SERIAL_SESSION | CKF_RW_SESSION,
+                                                  NULL, /* Application defined pointer. */
+                                                  NULL, /* Callback function. */
+                                                  &poolSessions[ index ] );
+
+        if( result == CKR_OK )
+        {
+            *session = poolSessions[ index ];
+        }
+        else
+        {
+            /* The entry stays claimed, and is skipped when closing. */
+            poolSessions[ index ] = CK_INVALID_HANDLE;
+        }
+    }
+
+    return result;
+}
 /*-----------------------------------------------------------*/
 
 CK_RV start( CK_SESSION_HANDLE * session,
@@ -86,7 +225,7 @@ CK_RV start( CK_SESSION_HANDLE * session,
                                               &slotCount );
     }
 
-    innerSlotId = malloc( sizeof( CK_SLOT_ID ) * ( slotCount ) );
+    innerSlotId = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_DEMO, sizeof( CK_SLOT_ID ) * ( slotCount ) );
 
     if( innerSlotId == NULL )
     {
@@ -129,7 +268,334 @@ void end( CK_SESSION_HANDLE session,
 {
     C_CloseSession( session );
     C_Finalize( NULL );
-    free( slotId );
+    Allocator_Free( slotId );
+}
+/*-----------------------------------------------------------*/
+
+CK_RV sessionPoolInit( void )
+{
+    CK_RV result = CKR_OK;
+    CK_C_INITIALIZE_ARGS initArgs = { 0 };
+    CK_ULONG slotCount = 0;
+    CK_SLOT_ID * slotIds = NULL;
+    CK_SESSION_HANDLE session = CK_INVALID_HANDLE;
+
+    result = C_GetFunctionList( &poolFunctionList );
+
+    if( result == CKR_OK )
+    {
+        result = poolFunctionList->C_Initialize( &initArgs );
+    }
+
+    if( result == CKR_OK )
+    {
+        result = poolFunctionList->C_GetSlotList( CK_TRUE,
+                                                  NULL,
+                                                  &slotCount );
+    }
+
+    if( ( result == CKR_OK ) && ( slotCount == 0 ) )
+    {
+        result = CKR_SLOT_ID_INVALID;
+    }
+
+    /* The slot list is only needed once, to pick the first slot. */
+    if( result == CKR_OK )
+    {
+        slotIds = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_DEMO, sizeof( CK_SLOT_ID ) * ( slotCount ) );
+
+        if( slotIds == NULL )
+        {
+            result = CKR_HOST_MEMORY;
+        }
+    }
+
+    if( result == CKR_OK )
+    {
+        result = poolFunctionList->C_GetSlotList( CK_TRUE,
+                                                  slotIds,
+                                                  &slotCount );
+    }
+
+    if( result == CKR_OK )
+    {
+        poolSlotId = slotIds[ 0 ];
+        __atomic_store_n( &poolSessionCount, 0U, __ATOMIC_RELAXED );
+        result = openPoolSession( &session );
+    }
+
+    Allocator_Free( slotIds );
+
+    /* The login applies to every session of the application. */
+    if( result == CKR_OK )
+    {
+        result = poolFunctionList->C_Login( session,
+                                            CKU_USER,
+                                            ( CK_UTF8CHAR_PTR ) configPKCS11_DEFAULT_USER_PIN,
+                                            sizeof( configPKCS11_DEFAULT_USER_PIN ) - 1UL );
+    }
+
+    if( result == CKR_OK )
+    {
+        threadSession = session;
+        threadSessionGeneration = __atomic_add_fetch( &poolGeneration, 1U, __ATOMIC_RELEASE );
+        invalidateObjectCache();
+    }
+
+    return result;
+}
+/*-----------------------------------------------------------*/
+
+CK_RV sessionPoolGet( CK_SESSION_HANDLE * session )
+{
+    CK_RV result = CKR_OK;
+    uint32_t generation = __atomic_load_n( &poolGeneration, __ATOMIC_ACQUIRE );
+
+    if( ( generation % 2U ) == 0U )
+    {
+        LogError( ( "The session pool is not initialized." ) );
+        result = CKR_CRYPTOKI_NOT_INITIALIZED;
+    }
+    else if( threadSessionGeneration != generation )
+    {
+        result = openPoolSession( &threadSession );
+
+        if( result == CKR_OK )
+        {
+            threadSessionGeneration = generation;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( result == CKR_OK )
+    {
+        *session = threadSession;
+    }
+
+    return result;
+}
+/*-----------------------------------------------------------*/
+
+void sessionPoolDeinit( void )
+{
+    uint32_t count = __atomic_load_n( &poolSessionCount, __ATOMIC_RELAXED );
+    uint32_t index = 0;
+
+    if( ( __atomic_load_n( &poolGeneration, __ATOMIC_RELAXED ) % 2U ) == 1U )
+    {
+        for( index = 0; ( index < count ) && ( index < pkcs11demoSESSION_POOL_SIZE ); index++ )
+        {
+            if( poolSessions[ index ] != CK_INVALID_HANDLE )
+            {
+                ( void ) poolFunctionList->C_CloseSession( poolSessions[ index ] );
+                poolSessions[ index ] = CK_INVALID_HANDLE;
+            }
+        }
+
+        __atomic_store_n( &poolSessionCount, 0U, __ATOMIC_RELAXED );
+        ( void ) __atomic_add_fetch( &poolGeneration, 1U, __ATOMIC_RELEASE );
+        invalidateObjectCache();
+        ( void ) poolFunctionList->C_Finalize( NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+CK_RV findObjectCached( CK_SESSION_HANDLE session,
+                        char * label,
+                        CK_ULONG labelLength,
+                        CK_OBJECT_CLASS objectClass,
+                        CK_OBJECT_HANDLE_PTR handle )
+{
+    CK_RV result = CKR_OK;
+    uint32_t generation = __atomic_load_n( &cacheGeneration, __ATOMIC_ACQUIRE );
+    uint32_t index = 0;
+    CachedObject_t * entry = NULL;
+
+    /* Drop the lookups cached before an object was destroyed. */
+    if( threadCacheGeneration != generation )
+    {
+        memset( threadCache, 0, sizeof( threadCache ) );
+        threadCacheGeneration = generation;
+        threadCacheNext = 0;
+    }
+
+    for( index = 0; ( index < pkcs11demoHANDLE_CACHE_SIZE ) && ( entry == NULL ); index++ )
+    {
+        if( ( threadCache[ index ].labelLength == labelLength ) &&
+            ( threadCache[ index ].objectClass == objectClass ) &&
+            ( memcmp( threadCache[ index ].label, label, labelLength ) == 0 ) )
+        {
+            entry = &threadCache[ index ];
+        }
+    }
+
+    if( entry != NULL )
+    {
+        *handle = entry->handle;
+    }
+    else
+    {
+        result = xFindObjectWithLabelAndClass( session,
+                                               label,
+                                               labelLength,
+                                               objectClass,
+                                               handle );
+
+        /* Only the objects found are cached, as a missing one may be
+         * created later. */
+        if( ( result == CKR_OK ) && ( *handle != CK_INVALID_HANDLE ) &&
+            ( labelLength > 0 ) && ( labelLength <= sizeof( entry->label ) ) )
+        {
+            entry = &threadCache[ threadCacheNext ];
+            threadCacheNext = ( threadCacheNext + 1U ) % pkcs11demoHANDLE_CACHE_SIZE;
+            memcpy( entry->label, label, labelLength );
+            entry->labelLength = labelLength;
+            entry->objectClass = objectClass;
+            entry->handle = *handle;
+        }
+    }
+
+    return result;
+}
+/*-----------------------------------------------------------*/
+
+CK_RV destroyObjectCached( CK_SESSION_HANDLE session,
+                           CK_OBJECT_HANDLE handle )
+{
+    CK_RV result = CKR_OK;
+    CK_FUNCTION_LIST_PTR functionList = NULL;
+
+    result = C_GetFunctionList( &functionList );
+
+    if( result == CKR_OK )
+    {
+        result = functionList->C_DestroyObject( session, handle );
+    }
+
+    /* Invalidate even on failure, as the object may be gone anyway. */
+    invalidateObjectCache();
+
+    return result;
+}
+/*-----------------------------------------------------------*/
+
+void invalidateObjectCache( void )
+{
+    ( void ) __atomic_add_fetch( &cacheGeneration, 1U, __ATOMIC_RELEASE );
+}
+/*-----------------------------------------------------------*/
+
+static CK_RV selectSignMechanism( CK_FUNCTION_LIST_PTR functionList,
+                                  CK_SESSION_HANDLE session,
+                                  CK_MECHANISM_TYPE * mechanismType )
+{
+    CK_RV result = CKR_OK;
+    CK_SESSION_INFO sessionInfo = { 0 };
+    CK_MECHANISM_INFO mechanismInfo = { 0 };
+
+    *mechanismType = CKM_ECDSA;
+
+    result = functionList->C_GetSessionInfo( session, &sessionInfo );
+
+    /* A token without the mechanism is not an error, only slower. */
+    if( ( result == CKR_OK ) &&
+        ( functionList->C_GetMechanismInfo( sessionInfo.slotID,
+                                            CKM_ECDSA_SHA256,
+                                            &mechanismInfo ) == CKR_OK ) &&
+        ( ( mechanismInfo.flags & CKF_SIGN ) != 0UL ) )
+    {
+        *mechanismType = CKM_ECDSA_SHA256;
+    }
+
+    return result;
+}
+/*-----------------------------------------------------------*/
+
+CK_RV signMessage( CK_SESSION_HANDLE session,
+                   CK_OBJECT_HANDLE privateKey,
+                   CK_BYTE_PTR message,
+                   CK_ULONG messageLength,
+                   CK_BYTE_PTR signature,
+                   CK_ULONG_PTR signatureLength )
+{
+    return signMessages( session,
+                         privateKey,
+                         &message,
+                         &messageLength,
+                         1UL,
+                         signature,
+                         signatureLength );
+}
+/*-----------------------------------------------------------*/
+
+CK_RV signMessages( CK_SESSION_HANDLE session,
+                    CK_OBJECT_HANDLE privateKey,
+                    CK_BYTE_PTR * messages,
+                    CK_ULONG_PTR messageLengths,
+                    CK_ULONG messageCount,
+                    CK_BYTE_PTR signatures,
+                    CK_ULONG_PTR signatureLengths )
+{
+    CK_RV result = CKR_OK;
+    CK_FUNCTION_LIST_PTR functionList = NULL;
+    CK_MECHANISM mechanism = { CKM_ECDSA, NULL, 0 };
+    CK_BYTE digest[ pkcs11SHA256_DIGEST_LENGTH ] = { 0 };
+    CK_BYTE_PTR data = NULL;
+    CK_ULONG dataLength = 0;
+    CK_ULONG index = 0;
+
+    result = C_GetFunctionList( &functionList );
+
+    if( result == CKR_OK )
+    {
+        result = selectSignMechanism( functionList,
+                                      session,
+                                      &mechanism.mechanism );
+    }
+
+    for( index = 0; ( index < messageCount ) && ( result == CKR_OK ); index++ )
+    {
+        data = messages[ index ];
+        dataLength = messageLengths[ index ];
+
+        if( mechanism.mechanism == CKM_ECDSA )
+        {
+            if( mbedtls_sha256_ret( messages[ index ],
+                                    messageLengths[ index ],
+                                    digest,
+                                    0 ) != 0 )
+            {
+                result = CKR_FUNCTION_FAILED;
+            }
+
+            data = digest;
+            dataLength = sizeof( digest );
+        }
+
+        /* Each signature is a separate operation, so C_SignInit is needed for
+         * every message even though the mechanism and key do not change. */
+        if( result == CKR_OK )
+        {
+            result = functionList->C_SignInit( session,
+                                               &mechanism,
+                                               privateKey );
+        }
+
+        if( result == CKR_OK )
+        {
+            signatureLengths[ index ] = pkcs11ECDSA_P256_SIGNATURE_LENGTH;
+            result = functionList->C_Sign( session,
+                                           data,
+                                           dataLength,
+                                           &signatures[ index * pkcs11ECDSA_P256_SIGNATURE_LENGTH ],
+                                           &signatureLengths[ index ] );
+        }
+    }
+
+    return result;
 }
 /*-----------------------------------------------------------*/
 
@@ -245,7 +711,7 @@ CK_RV exportPublicKey( CK_SESSION_HANDLE session,
             *derPublicKeyLength = template.ulValueLen;
 
             /* Get a heap buffer. */
-            *derPublicKey = malloc( template.ulValueLen );
+            *derPublicKey = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_DEMO, template.ulValueLen );
 
             /* Check for resource exhaustion. */
             if( NULL == *derPublicKey )
@@ -275,7 +741,7 @@ CK_RV exportPublicKey( CK_SESSION_HANDLE session,
     /* Free memory if there was an error after allocation. */
     if( ( NULL != *derPublicKey ) && ( CKR_OK != result ) )
     {
-        free( *derPublicKey );
+        Allocator_Free( *derPublicKey );
         *derPublicKey = NULL;
     }
 
@@ -0,0 +1,1401 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file pkcs11_bench.c
+ * @brief Benchmark of the PKCS #11 operations used for TLS and for verifying
+ * OTA images, to compare the corePKCS11 software token with other tokens.
+ *
+ * The benchmark runs each operation, one after the other in a single
+ * session, until it ran a number of times or for a length of time, and
+ * records the time of each run in a histogram. It measures the corePKCS11
+ * module linked into the benchmark, backed by mbed TLS, followed by every
+ * PKCS #11 module given with --module, such as the module of a hardware
+ * token or SoftHSM, which is loaded at run time.
+ *
+ * Operations the token does not report in C_GetMechanismInfo are skipped.
+ * The signatures use the keys with the labels given, such as the key pair
+ * created by the pkcs11_demo_objects demo in corePKCS11, or the keys
+ * generated by the keygen benchmark if it runs.
+ *
+ * Run the benchmark with --help for its options. For example:
+ * $ pkcs11_bench -t random,digest,ecdsa -s 64,1024,65536
+ * $ pkcs11_bench --no-builtin --module /usr/lib/softhsm/libsofthsm2.so --pin 1234 -t keygen,ecdsa,rsa
+ */
+
+/* Standard includes. */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <dlfcn.h>
+#include <getopt.h>
+
+/* Logging stack includes. */
+#include "logging_levels.h"
+
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "PKCS11_BENCH"
+#endif
+
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/* PKCS #11 includes. */
+#include "core_pkcs11.h"
+#include "pkcs11.h"
+
+/* Histogram of the latencies. */
+#include "latency_histogram.h"
+
+/**
+ * @brief Largest number of modules given with --module.
+ */
+#define MAX_MODULE_COUNT                     ( 8U )
+
+/**
+ * @brief Largest number of message lengths of the digests.
+ */
+#define MAX_DIGEST_LENGTH_COUNT              ( 8U )
+
+/**
+ * @brief Largest message length of the digests.
+ */
+#define MAX_DIGEST_LENGTH                    ( 1048576UL )
+
+/**
+ * @brief Default largest number of runs of each operation.
+ */
+#define DEFAULT_ITERATIONS                   ( 1000U )
+
+/**
+ * @brief Default longest time spent running each operation, in seconds.
+ */
+#define DEFAULT_DURATION_SEC                 ( 5U )
+
+/**
+ * @brief Default message lengths of the digests.
+ */
+#define DEFAULT_DIGEST_LENGTHS               "64,1024,16384"
+
+/**
+ * @brief Default benchmarks run.
+ */
+#define DEFAULT_TESTS                        "random,digest,ecdsa,rsa"
+
+/**
+ * @brief Number of random bytes generated by each C_GenerateRandom.
+ */
+#define RANDOM_LENGTH                        ( 32UL )
+
+/**
+ * @brief Length of the modulus of the RSA keys generated.
+ */
+#define RSA_MODULUS_BITS                     ( 2048UL )
+
+/**
+ * @brief Largest length of the signatures, that of RSA 4096 keys.
+ */
+#define MAX_SIGNATURE_LENGTH                 ( 512UL )
+
+/**
+ * @brief Length of the name of a benchmark in the report.
+ */
+#define NAME_MAX_LENGTH                      ( 32U )
+
+/**
+ * @brief Labels of the keys generated as session objects.
+ */
+#define BENCH_EC_PRIVATE_KEY_LABEL           "Bench EC Priv Key"
+#define BENCH_EC_PUBLIC_KEY_LABEL            "Bench EC Pub Key"
+#define BENCH_RSA_PRIVATE_KEY_LABEL          "Bench RSA Priv Key"
+#define BENCH_RSA_PUBLIC_KEY_LABEL           "Bench RSA Pub Key"
+
+/**
+ * @brief DER encoding of the DigestInfo header of a SHA-256 digest, which
+ * CKM_RSA_PKCS signs ahead of the digest.
+ */
+#define SHA256_DIGEST_INFO_HEADER                                 \
+    { 0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, \
+      0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20 }
+
+/**
+ * @brief Length of #SHA256_DIGEST_INFO_HEADER.
+ */
+#define SHA256_DIGEST_INFO_HEADER_LENGTH     ( 19UL )
+
+/**
+ * @brief Number of nanoseconds in a second.
+ */
+#define NANOSECONDS_PER_SECOND               ( 1000000000ULL )
+
+/**
+ * @brief Bits of #BenchConfig_t.tests, one per benchmark.
+ */
+#define TEST_RANDOM                          ( 1U << 0 )
+#define TEST_DIGEST                          ( 1U << 1 )
+#define TEST_KEYGEN                          ( 1U << 2 )
+#define TEST_ECDSA                           ( 1U << 3 )
+#define TEST_RSA                             ( 1U << 4 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The options of a run.
+ */
+typedef struct BenchConfig
+{
+    const char * pModulePaths[ MAX_MODULE_COUNT ];     /**< @brief PKCS #11 modules loaded at run time. */
+    uint32_t moduleCount;                              /**< @brief Number of #BenchConfig_t.pModulePaths. */
+    bool builtin;                                      /**< @brief Whether to measure the corePKCS11 module linked in. */
+    const char * pPin;                                 /**< @brief User PIN of the tokens. */
+    uint32_t slotIndex;                                /**< @brief Index of the slot in the list of slots with a token. */
+    uint32_t tests;                                    /**< @brief Benchmarks to run, of the TEST_ bits. */
+    uint32_t iterations;                               /**< @brief Largest number of runs of each operation. */
+    uint32_t durationSec;                              /**< @brief Longest time spent running each operation. */
+    CK_ULONG digestLengths[ MAX_DIGEST_LENGTH_COUNT ]; /**< @brief Message lengths of the digests. */
+    uint32_t digestLengthCount;                        /**< @brief Number of #BenchConfig_t.digestLengths. */
+    const char * pEcPrivateKeyLabel;                   /**< @brief Label of the EC private key to sign with. */
+    const char * pEcPublicKeyLabel;                    /**< @brief Label of the EC public key to verify with. */
+    const char * pRsaPrivateKeyLabel;                  /**< @brief Label of the RSA private key to sign with; NULL for none. */
+    const char * pRsaPublicKeyLabel;                   /**< @brief Label of the RSA public key to verify with; NULL for none. */
+    bool keygenToken;                                  /**< @brief Whether to generate the EC keys as token objects with the labels of the device TLS key. */
+} BenchConfig_t;
+
+/**
+ * @brief A PKCS #11 module being measured, and its session.
+ */
+typedef struct BenchModule
+{
+    const char * pName;                  /**< @brief Path of the module, or corePKCS11. */
+    void * pLibrary;                     /**< @brief Module loaded at run time; NULL for the one linked in. */
+    CK_FUNCTION_LIST_PTR pFunctionList;  /**< @brief Function list of the module. */
+    bool initialized;                    /**< @brief Whether C_Initialize succeeded. */
+    CK_SLOT_ID slotId;                   /**< @brief Slot of the token. */
+    CK_SESSION_HANDLE session;           /**< @brief Session with the token. */
+    CK_OBJECT_HANDLE ecPrivateKey;       /**< @brief EC private key; CK_INVALID_HANDLE if none. */
+    CK_OBJECT_HANDLE ecPublicKey;        /**< @brief EC public key; CK_INVALID_HANDLE if none. */
+    CK_OBJECT_HANDLE rsaPrivateKey;      /**< @brief RSA private key; CK_INVALID_HANDLE if none. */
+    CK_OBJECT_HANDLE rsaPublicKey;       /**< @brief RSA public key; CK_INVALID_HANDLE if none. */
+    bool ecKeysGenerated;                /**< @brief Whether the EC keys are session objects generated by the benchmark. */
+    bool rsaKeysGenerated;               /**< @brief Whether the RSA keys are session objects generated by the benchmark. */
+} BenchModule_t;
+
+/**
+ * @brief The input of a run of an operation.
+ */
+typedef struct BenchOperand
+{
+    CK_MECHANISM mechanism;                        /**< @brief Mechanism of the operation. */
+    CK_OBJECT_HANDLE key;                          /**< @brief Key of a signature or a verification. */
+    CK_BYTE_PTR pData;                             /**< @brief Data digested, signed or verified. */
+    CK_ULONG dataLength;                           /**< @brief Length of #BenchOperand_t.pData. */
+    CK_BYTE signature[ MAX_SIGNATURE_LENGTH ];     /**< @brief Signature verified, or the output of the other operations. */
+    CK_ULONG signatureLength;                      /**< @brief Length of #BenchOperand_t.signature. */
+} BenchOperand_t;
+
+/**
+ * @brief A run of an operation.
+ *
+ * @param[in] pModule The module.
+ * @param[in] pOperand The input of the operation.
+ *
+ * @return The result of the PKCS #11 function that failed, or CKR_OK.
+ */
+typedef CK_RV ( * BenchOperation_t )( BenchModule_t * pModule,
+                                      BenchOperand_t * pOperand );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The options of the run.
+ */
+static BenchConfig_t benchConfig;
+
+/**
+ * @brief Latencies of the benchmark being run, in nanoseconds.
+ */
+static LatencyHistogram_t latencyNs;
+
+/**
+ * @brief Message digested and signed.
+ */
+static CK_BYTE * pMessage = NULL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Describe program usage on stderr.
+ *
+ * @param[in] programName the value of argv[0]
+ */
+static void usage( const char * programName );
+
+/**
+ * @brief Populate the options from the command line arguments.
+ *
+ * @param[out] pConfig The options.
+ * @param[in] argc count of arguments
+ * @param[in] argv array of arguments
+ *
+ * @return true if the arguments are valid; false otherwise.
+ */
+static bool parseArgs( BenchConfig_t * pConfig,
+                       int argc,
+                       char * argv[] );
+
+/**
+ * @brief Parse an unsigned integer argument.
+ *
+ * @param[in] pArgument The argument.
+ * @param[in] minValue Smallest value allowed.
+ * @param[in] maxValue Largest value allowed.
+ * @param[out] pValue The value.
+ *
+ * @return true if the argument is a number within the bounds; false
+ * otherwise.
+ */
+static bool parseNumber( const char * pArgument,
+                         uint64_t minValue,
+                         uint64_t maxValue,
+                         uint64_t * pValue );
+
+/**
+ * @brief Parse the comma separated names of the benchmarks.
+ *
+ * @param[in] pArgument The argument.
+ * @param[out] pTests The TEST_ bits of the benchmarks.
+ *
+ * @return true if every name is a benchmark; false otherwise.
+ */
+static bool parseTests( const char * pArgument,
+                        uint32_t * pTests );
+
+/**
+ * @brief Parse the comma separated message lengths of the digests.
+ *
+ * @param[in] pArgument The argument.
+ * @param[out] pConfig The options receiving the lengths.
+ *
+ * @return true if the lengths are valid; false otherwise.
+ */
+static bool parseDigestLengths( const char * pArgument,
+                                BenchConfig_t * pConfig );
+
+/**
+ * @brief Get the time of the monotonic clock.
+ *
+ * @return The time in nanoseconds.
+ */
+static uint64_t getTimeNs( void );
+
+/**
+ * @brief Load a module, initialize it, and open and log in to a session
+ * with its token.
+ *
+ * @param[out] pModule The module.
+ * @param[in] pPath Path of the module to load; NULL for the one linked in.
+ *
+ * @return true if the session is ready; false otherwise.
+ */
+static bool openModule( BenchModule_t * pModule,
+                        const char * pPath );
+
+/**
+ * @brief Close the session of a module, finalize it and unload it.
+ *
+ * @param[in] pModule The module.
+ */
+static void closeModule( BenchModule_t * pModule );
+
+/**
+ * @brief Check whether the token supports a mechanism for an operation.
+ *
+ * @param[in] pModule The module.
+ * @param[in] mechanism The mechanism.
+ * @param[in] flag The CKF_ flag of the operation, such as CKF_SIGN.
+ *
+ * @return true if it does; false otherwise.
+ */
+static bool mechanismSupported( BenchModule_t * pModule,
+                                CK_MECHANISM_TYPE mechanism,
+                                CK_FLAGS flag );
+
+/**
+ * @brief Find an object of the token by label and class.
+ *
+ * @param[in] pModule The module.
+ * @param[in] pLabel Label of the object; NULL for none.
+ * @param[in] objectClass Class of the object.
+ *
+ * @return The object; CK_INVALID_HANDLE if it is not found.
+ */
+static CK_OBJECT_HANDLE findObject( BenchModule_t * pModule,
+                                    const char * pLabel,
+                                    CK_OBJECT_CLASS objectClass );
+
+/**
+ * @brief Run an operation until it ran #BenchConfig_t.iterations times or
+ * for #BenchConfig_t.durationSec, after one run left out of the
+ * measurement, and print its throughput and latencies.
+ *
+ * @param[in] pModule The module.
+ * @param[in] pName Name of the benchmark in the report.
+ * @param[in] operation The operation.
+ * @param[in] pOperand The input of the operation.
+ *
+ * @return true if every run succeeded; false otherwise.
+ */
+static bool runBenchmark( BenchModule_t * pModule,
+                          const char * pName,
+                          BenchOperation_t operation,
+                          BenchOperand_t * pOperand );
+
+/**
+ * @brief Generate random bytes.
+ */
+static CK_RV generateRandom( BenchModule_t * pModule,
+                             BenchOperand_t * pOperand );
+
+/**
+ * @brief Digest a message in a single part.
+ */
+static CK_RV digest( BenchModule_t * pModule,
+                     BenchOperand_t * pOperand );
+
+/**
+ * @brief Sign data, keeping the signature in the operand.
+ */
+static CK_RV sign( BenchModule_t * pModule,
+                   BenchOperand_t * pOperand );
+
+/**
+ * @brief Verify the signature of the operand.
+ */
+static CK_RV verify( BenchModule_t * pModule,
+                     BenchOperand_t * pOperand );
+
+/**
+ * @brief Generate an EC P-256 key pair, which replaces the EC keys of the
+ * module.
+ */
+static CK_RV generateEcKeyPair( BenchModule_t * pModule,
+                                BenchOperand_t * pOperand );
+
+/**
+ * @brief Generate an RSA key pair as session objects, which replaces the RSA
+ * keys of the module.
+ */
+static CK_RV generateRsaKeyPair( BenchModule_t * pModule,
+                                 BenchOperand_t * pOperand );
+
+/**
+ * @brief Run the selected benchmarks on a module.
+ *
+ * @param[in] pModule The module.
+ *
+ * @return true if all the benchmarks run succeeded; false otherwise.
+ */
+static bool benchModule( BenchModule_t * pModule );
+
+/*-----------------------------------------------------------*/
+
+static void usage( const char * programName )
+{
+    fprintf( stderr,
+             "\nThis benchmark measures the throughput and the latency of PKCS #11 operations,\n"
+             "of the corePKCS11 module linked in and of the modules given with --module.\n"
+             "\nusage: %s [--module path]... [--no-builtin] [--pin pin] [--slot index]\n"
+             "       [-t tests] [-s lengths] [-n iterations] [-d seconds]\n"
+             "       [--ec-label label] [--ec-pub-label label] [--rsa-label label] [--rsa-pub-label label]\n"
+             "       [--keygen-token]\n"
+             "\n"
+             "--module        : PKCS #11 module to load and measure, up to %u of them.\n"
+             "--no-builtin    : do not measure the corePKCS11 module linked in.\n"
+             "--pin           : user PIN of the tokens. Defaults to %s.\n"
+             "--slot          : index of the slot in the list of slots with a token. Defaults to 0.\n",
+             programName,
+             ( unsigned int ) MAX_MODULE_COUNT,
+             configPKCS11_DEFAULT_USER_PIN );
+    fprintf( stderr,
+             "-t, --tests     : comma separated benchmarks among random, digest, keygen, ecdsa and rsa.\n"
+             "                  Defaults to %s.\n"
+             "-s, --sizes     : comma separated message lengths of the digests. Defaults to %s.\n"
+             "-n, --iterations: largest number of runs of each operation. Defaults to %u.\n"
+             "-d, --duration  : longest time spent on each operation, in seconds. Defaults to %u.\n"
+             "--ec-label      : label of the EC private key to sign with. Defaults to %s.\n"
+             "--ec-pub-label  : label of the EC public key to verify with. Defaults to %s.\n"
+             "--rsa-label     : label of the RSA private key to sign with. Defaults to none.\n"
+             "--rsa-pub-label : label of the RSA public key to verify with. Defaults to none.\n",
+             DEFAULT_TESTS,
+             DEFAULT_DIGEST_LENGTHS,
+             ( unsigned int ) DEFAULT_ITERATIONS,
+             ( unsigned int ) DEFAULT_DURATION_SEC,
+             pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
+             pkcs11configLABEL_DEVICE_PUBLIC_KEY_FOR_TLS );
+    fprintf( stderr,
+             "--keygen-token  : generate the EC keys as token objects with the labels of the device\n"
+             "                  TLS key, which corePKCS11 requires. This REPLACES the device TLS key.\n"
+             "                  By default the keys are session objects, gone with the session.\n\n"
+             "The keys generated by keygen are used by ecdsa and rsa instead of the labels.\n\n" );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseNumber( const char * pArgument,
+                         uint64_t minValue,
+                         uint64_t maxValue,
+                         uint64_t * pValue )
+{
+    bool returnStatus = false;
+    char * pEnd = NULL;
+    unsigned long long value = strtoull( pArgument, &pEnd, 0 );
+
+    if( ( pEnd != pArgument ) && ( *pEnd == '\0' ) && ( pArgument[ 0 ] != '-' ) &&
+        ( value >= minValue ) && ( value <= maxValue ) )
+    {
+        *pValue = ( uint64_t ) value;
+        returnStatus = true;
+    }
+    else
+    {
+        LogError( ( "Bad value: %s.", pArgument ) );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseTests( const char * pArgument,
+                        uint32_t * pTests )
+{
+    static const struct
+    {
+        const char * pName;
+        uint32_t bit;
+    } tests[] =
+    {
+        { "random", TEST_RANDOM },
+        { "digest", TEST_DIGEST },
+        { "keygen", TEST_KEYGEN },
+        { "ecdsa",  TEST_ECDSA  },
+        { "rsa",    TEST_RSA    }
+    };
+    bool returnStatus = true;
+    const char * pName = pArgument;
+    size_t nameLength = 0U;
+    size_t index = 0U;
+    bool found = false;
+
+    *pTests = 0U;
+
+    while( ( returnStatus == true ) && ( *pName != '\0' ) )
+    {
+        nameLength = strcspn( pName, "," );
+        found = false;
+
+        for( index = 0U; index < ( sizeof( tests ) / sizeof( tests[ 0 ] ) ); index++ )
+        {
+            if( ( strlen( tests[ index ].pName ) == nameLength ) &&
+                ( strncmp( tests[ index ].pName, pName, nameLength ) == 0 ) )
+            {
+                *pTests |= tests[ index ].bit;
+                found = true;
+            }
+        }
+
+        if( found == false )
+        {
+            LogError( ( "Unknown benchmark: %.*s.", ( int ) nameLength, pName ) );
+            returnStatus = false;
+        }
+
+        pName += nameLength;
+
+        if( *pName == ',' )
+        {
+            pName++;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseDigestLengths( const char * pArgument,
+                                BenchConfig_t * pConfig )
+{
+    bool returnStatus = true;
+    char buffer[ 128 ];
+    char * pSaveptr = NULL;
+    char * pToken = NULL;
+    uint64_t value = 0U;
+
+    pConfig->digestLengthCount = 0U;
+
+    if( strlen( pArgument ) >= sizeof( buffer ) )
+    {
+        LogError( ( "Bad value: %s.", pArgument ) );
+        returnStatus = false;
+    }
+    else
+    {
+        ( void ) strcpy( buffer, pArgument );
+        pToken = strtok_r( buffer, ",", &pSaveptr );
+    }
+
+    while( ( returnStatus == true ) && ( pToken != NULL ) )
+    {
+        if( pConfig->digestLengthCount == MAX_DIGEST_LENGTH_COUNT )
+        {
+            LogError( ( "At most %u message lengths.", ( unsigned int ) MAX_DIGEST_LENGTH_COUNT ) );
+            returnStatus = false;
+        }
+        else
+        {
+            returnStatus = parseNumber( pToken, 0U, MAX_DIGEST_LENGTH, &value );
+            pConfig->digestLengths[ pConfig->digestLengthCount ] = ( CK_ULONG ) value;
+            pConfig->digestLengthCount++;
+            pToken = strtok_r( NULL, ",", &pSaveptr );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseArgs( BenchConfig_t * pConfig,
+                       int argc,
+                       char * argv[] )
+{
+    bool returnStatus = true;
+    int option = 0;
+    uint64_t value = 0U;
+    static const struct option longOptions[] =
+    {
+        { "module",        required_argument, NULL, 'm' },
+        { "no-builtin",    no_argument,       NULL, 'b' },
+        { "pin",           required_argument, NULL, 'p' },
+        { "slot",          required_argument, NULL, 'l' },
+        { "tests",         required_argument, NULL, 't' },
+        { "sizes",         required_argument, NULL, 's' },
+        { "iterations",    required_argument, NULL, 'n' },
+        { "duration",      required_argument, NULL, 'd' },
+        { "ec-label",      required_argument, NULL, 'e' },
+        { "ec-pub-label",  required_argument, NULL, 'E' },
+        { "rsa-label",     required_argument, NULL, 'r' },
+        { "rsa-pub-label", required_argument, NULL, 'R' },
+        { "keygen-token",  no_argument,       NULL, 'k' },
+        { "help",          no_argument,       NULL, '?' },
+        { NULL,            0,                 NULL, 0   }
+    };
+
+    ( void ) memset( pConfig, 0x00, sizeof( BenchConfig_t ) );
+    pConfig->builtin = true;
+    pConfig->pPin = configPKCS11_DEFAULT_USER_PIN;
+    pConfig->iterations = DEFAULT_ITERATIONS;
+    pConfig->durationSec = DEFAULT_DURATION_SEC;
+    pConfig->pEcPrivateKeyLabel = pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS;
+    pConfig->pEcPublicKeyLabel = pkcs11configLABEL_DEVICE_PUBLIC_KEY_FOR_TLS;
+    ( void ) parseTests( DEFAULT_TESTS, &( pConfig->tests ) );
+    ( void ) parseDigestLengths( DEFAULT_DIGEST_LENGTHS, pConfig );
+
+    while( returnStatus == true )
+    {
+        option = getopt_long( argc, argv, "t:s:n:d:?", longOptions, NULL );
+
+        if( option == -1 )
+        {
+            break;
+        }
+
+        switch( option )
+        {
+            case 'm':
+
+                if( pConfig->moduleCount == MAX_MODULE_COUNT )
+                {
+                    LogError( ( "At most %u modules.", ( unsigned int ) MAX_MODULE_COUNT ) );
+                    returnStatus = false;
+                }
+                else
+                {
+                    pConfig->pModulePaths[ pConfig->moduleCount ] = optarg;
+                    pConfig->moduleCount++;
+                }
+
+                break;
+
+            case 'b':
+                pConfig->builtin = false;
+                break;
+
+            case 'p':
+                pConfig->pPin = optarg;
+                break;
+
+            case 'l':
+                returnStatus = parseNumber( optarg, 0U, 1024U, &value );
+                pConfig->slotIndex = ( uint32_t ) value;
+                break;
+
+            case 't':
+                returnStatus = parseTests( optarg, &( pConfig->tests ) );
+                break;
+
+            case 's':
+                returnStatus = parseDigestLengths( optarg, pConfig );
+                break;
+
+            case 'n':
+                returnStatus = parseNumber( optarg, 1U, 100000000U, &value );
+                pConfig->iterations = ( uint32_t ) value;
+                break;
+
+            case 'd':
+                returnStatus = parseNumber( optarg, 1U, 86400U, &value );
+                pConfig->durationSec = ( uint32_t ) value;
+                break;
+
+            case 'e':
+                pConfig->pEcPrivateKeyLabel = optarg;
+                break;
+
+            case 'E':
+                pConfig->pEcPublicKeyLabel = optarg;
+                break;
+
+            case 'r':
+                pConfig->pRsaPrivateKeyLabel = optarg;
+                break;
+
+            case 'R':
+                pConfig->pRsaPublicKeyLabel = optarg;
+                break;
+
+            case 'k':
+                pConfig->keygenToken = true;
+                break;
+
+            case '?':
+            default:
+                returnStatus = false;
+                break;
+        }
+    }
+
+    if( returnStatus == true )
+    {
+        if( optind < argc )
+        {
+            returnStatus = false;
+        }
+        else if( ( pConfig->builtin == false ) && ( pConfig->moduleCount == 0U ) )
+        {
+            LogError( ( "--no-builtin needs a --module." ) );
+            returnStatus = false;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( returnStatus == false )
+    {
+        usage( argv[ 0 ] );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t getTimeNs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * NANOSECONDS_PER_SECOND ) + ( uint64_t ) now.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool openModule( BenchModule_t * pModule,
+                        const char * pPath )
+{
+    CK_RV result = CKR_OK;
+    CK_C_GetFunctionList getFunctionList = C_GetFunctionList;
+    CK_C_INITIALIZE_ARGS initArgs = { 0 };
+    CK_SLOT_ID * pSlotIds = NULL;
+    CK_ULONG slotCount = 0;
+
+    ( void ) memset( pModule, 0x00, sizeof( BenchModule_t ) );
+    pModule->pName = ( pPath == NULL ) ? "corePKCS11" : pPath;
+    pModule->session = CK_INVALID_HANDLE;
+
+    /* The module is loaded with its own symbols, so that its functions do not
+     * bind to the corePKCS11 functions linked in. */
+    if( pPath != NULL )
+    {
+        pModule->pLibrary = dlopen( pPath, RTLD_NOW | RTLD_LOCAL );
+
+        if( pModule->pLibrary == NULL )
+        {
+            LogError( ( "Failed to load %s: %s.", pPath, dlerror() ) );
+            result = CKR_GENERAL_ERROR;
+        }
+        else
+        {
+            *( void ** ) ( &getFunctionList ) = dlsym( pModule->pLibrary, "C_GetFunctionList" );
+
+            if( getFunctionList == NULL )
+            {
+                LogError( ( "%s has no C_GetFunctionList.", pPath ) );
+                result = CKR_GENERAL_ERROR;
+            }
+        }
+    }
+
+    if( result == CKR_OK )
+    {
+        result = getFunctionList( &( pModule->pFunctionList ) );
+    }
+
+    if( result == CKR_OK )
+    {
+        result = pModule->pFunctionList->C_Initialize( &initArgs );
+        pModule->initialized = ( result == CKR_OK );
+    }
+
+    if( result == CKR_OK )
+    {
+        result = pModule->pFunctionList->C_GetSlotList( CK_TRUE, NULL, &slotCount );
+    }
+
+    if( ( result == CKR_OK ) && ( slotCount <= benchConfig.slotIndex ) )
+    {
+        LogError( ( "%s has %lu slots with a token, none with index %u.",
+                    pModule->pName,
+                    ( unsigned long ) slotCount,
+                    ( unsigned int ) benchConfig.slotIndex ) );
+        result = CKR_SLOT_ID_INVALID;
+    }
+
+    if( result == CKR_OK )
+    {
+        pSlotIds = malloc( sizeof( CK_SLOT_ID ) * slotCount );
+
+        if( pSlotIds == NULL )
+        {
+            result = CKR_HOST_MEMORY;
+        }
+    }
+
+    if( result == CKR_OK )
+    {
+        result = pModule->pFunctionList->C_GetSlotList( CK_TRUE, pSlotIds, &slotCount );
+    }
+
+    if( result == CKR_OK )
+    {
+        pModule->slotId = pSlotIds[ benchConfig.slotIndex ];
+        result = pModule->pFunctionList->C_OpenSession( pModule->slotId,
+                                                        CKF_SERIAL_SESSION | CKF_RW_SESSION,
+                                                        NULL,
+                                                        NULL,
+                                                        &( pModule->session ) );
+    }
+
+    free( pSlotIds );
+
+    if( result == CKR_OK )
+    {
+        result = pModule->pFunctionList->C_Login( pModule->session,
+                                                  CKU_USER,
+                                                  ( CK_UTF8CHAR_PTR ) benchConfig.pPin,
+                                                  ( CK_ULONG ) strlen( benchConfig.pPin ) );
+
+        if( result == CKR_USER_ALREADY_LOGGED_IN )
+        {
+            result = CKR_OK;
+        }
+    }
+
+    if( result != CKR_OK )
+    {
+        LogError( ( "Failed to open a session with %s: 0x%lx.",
+                    pModule->pName,
+                    ( unsigned long ) result ) );
+        closeModule( pModule );
+    }
+
+    return( result == CKR_OK );
+}
+
+/*-----------------------------------------------------------*/
+
+static void closeModule( BenchModule_t * pModule )
+{
+    /* Closing the session destroys the session objects generated. */
+    if( pModule->session != CK_INVALID_HANDLE )
+    {
+        ( void ) pModule->pFunctionList->C_CloseSession( pModule->session );
+        pModule->session = CK_INVALID_HANDLE;
+    }
+
+    if( pModule->initialized == true )
+    {
+        ( void ) pModule->pFunctionList->C_Finalize( NULL );
+        pModule->initialized = false;
+    }
+
+    if( pModule->pLibrary != NULL )
+    {
+        ( void ) dlclose( pModule->pLibrary );
+        pModule->pLibrary = NULL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool mechanismSupported( BenchModule_t * pModule,
+                                CK_MECHANISM_TYPE mechanism,
+                                CK_FLAGS flag )
+{
+    CK_MECHANISM_INFO info = { 0 };
+
+    return( ( pModule->pFunctionList->C_GetMechanismInfo( pModule->slotId, mechanism, &info ) == CKR_OK ) &&
+            ( ( info.flags & flag ) != 0UL ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static CK_OBJECT_HANDLE findObject( BenchModule_t * pModule,
+                                    const char * pLabel,
+                                    CK_OBJECT_CLASS objectClass )
+{
+    CK_OBJECT_HANDLE object = CK_INVALID_HANDLE;
+    CK_ULONG objectCount = 0;
+    CK_ATTRIBUTE template[ 2 ];
+    CK_FUNCTION_LIST_PTR pFunctionList = pModule->pFunctionList;
+
+    /* xFindObjectWithLabelAndClass only searches corePKCS11, so the search
+     * goes through the function list of the module. */
+    if( pLabel != NULL )
+    {
+        template[ 0 ].type = CKA_LABEL;
+        template[ 0 ].pValue = ( CK_VOID_PTR ) pLabel;
+        template[ 0 ].ulValueLen = ( CK_ULONG ) strlen( pLabel );
+        template[ 1 ].type = CKA_CLASS;
+        template[ 1 ].pValue = &objectClass;
+        template[ 1 ].ulValueLen = sizeof( objectClass );
+
+        if( pFunctionList->C_FindObjectsInit( pModule->session, template, 2UL ) == CKR_OK )
+        {
+            if( ( pFunctionList->C_FindObjects( pModule->session, &object, 1UL, &objectCount ) != CKR_OK ) ||
+                ( objectCount == 0UL ) )
+            {
+                object = CK_INVALID_HANDLE;
+            }
+
+            ( void ) pFunctionList->C_FindObjectsFinal( pModule->session );
+        }
+    }
+
+    return object;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool runBenchmark( BenchModule_t * pModule,
+                          const char * pName,
+                          BenchOperation_t operation,
+                          BenchOperand_t * pOperand )
+{
+    CK_RV result = CKR_OK;
+    uint64_t startNs = 0U;
+    uint64_t endNs = 0U;
+    uint64_t runStartNs = 0U;
+    uint64_t runNs = 0U;
+    uint64_t elapsedNs = 0U;
+    uint32_t runCount = 0U;
+
+    LatencyHistogram_Init( &latencyNs );
+
+    /* The first run is left out, as it may set up the mechanism. */
+    result = operation( pModule, pOperand );
+    startNs = getTimeNs();
+    endNs = startNs + ( ( uint64_t ) benchConfig.durationSec * NANOSECONDS_PER_SECOND );
+    runStartNs = startNs;
+
+    while( ( result == CKR_OK ) && ( runCount < benchConfig.iterations ) && ( runStartNs < endNs ) )
+    {
+        result = operation( pModule, pOperand );
+        elapsedNs = getTimeNs();
+        runNs = elapsedNs - runStartNs;
+        LatencyHistogram_Record( &latencyNs, ( runNs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) runNs );
+        runStartNs = elapsedNs;
+        runCount++;
+    }
+
+    elapsedNs = runStartNs - startNs;
+
+    if( result != CKR_OK )
+    {
+        printf( "  %-*s failed: 0x%lx.\n", ( int ) NAME_MAX_LENGTH, pName, ( unsigned long ) result );
+    }
+    else
+    {
+        printf( "  %-*s %8u ops %11.1f ops/s   us: min %.1f, p50 %.1f, p90 %.1f, p99 %.1f, max %.1f, mean %.1f\n",
+                ( int ) NAME_MAX_LENGTH,
+                pName,
+                ( unsigned int ) runCount,
+                ( double ) runCount * ( double ) NANOSECONDS_PER_SECOND / ( double ) elapsedNs,
+                ( double ) latencyNs.min / 1000.0,
+                ( double ) LatencyHistogram_Percentile( &latencyNs, 50.0 ) / 1000.0,
+                ( double ) LatencyHistogram_Percentile( &latencyNs, 90.0 ) / 1000.0,
+                ( double ) LatencyHistogram_Percentile( &latencyNs, 99.0 ) / 1000.0,
+                ( double ) latencyNs.max / 1000.0,
+                ( double ) latencyNs.sum / ( double ) latencyNs.count / 1000.0 );
+    }
+
+    return( result == CKR_OK );
+}
+
+/*-----------------------------------------------------------*/
+
+static CK_RV generateRandom( BenchModule_t * pModule,
+                             BenchOperand_t * pOperand )
+{
+    return pModule->pFunctionList->C_GenerateRandom( pModule->session,
+                                                     pOperand->signature,
+                                                     pOperand->dataLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static CK_RV digest( BenchModule_t * pModule,
+                     BenchOperand_t * pOperand )
+{
+    CK_RV result = CKR_OK;
+    CK_ULONG digestLength = sizeof( pOperand->signature );
+
+    result = pModule->pFunctionList->C_DigestInit( pModule->session,
+                                                   &( pOperand->mechanism ) );
+
+    if( result == CKR_OK )
+    {
+        result = pModule->pFunctionList->C_Digest( pModule->session,
+                                                   pOperand->pData,
+                                                   pOperand->dataLength,
+                                                   pOperand->signature,
+                                                   &digestLength );
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+static CK_RV sign( BenchModule_t * pModule,
+                   BenchOperand_t * pOperand )
+{
+    CK_RV result = CKR_OK;
+
+    pOperand->signatureLength = sizeof( pOperand->signature );
+    result = pModule->pFunctionList->C_SignInit( pModule->session,
+                                                 &( pOperand->mechanism ),
+                                                 pOperand->key );
+
+    if( result == CKR_OK )
+    {
+        result = pModule->pFunctionList->C_Sign( pModule->session,
+                                                 pOperand->pData,
+                                                 pOperand->dataLength,
+                                                 pOperand->signature,
+                                                 &( pOperand->signatureLength ) );
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+static CK_RV verify( BenchModule_t * pModule,
+                     BenchOperand_t * pOperand )
+{
+    CK_RV result = CKR_OK;
+
+    result = pModule->pFunctionList->C_VerifyInit( pModule->session,
+                                                   &( pOperand->mechanism ),
+                                                   pOperand->key );
+
+    if( result == CKR_OK )
+    {
+        result = pModule->pFunctionList->C_Verify( pModule->session,
+                                                   pOperand->pData,
+                                                   pOperand->dataLength,
+                                                   pOperand->signature,
+                                                   pOperand->signatureLength );
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+static CK_RV generateEcKeyPair( BenchModule_t * pModule,
+                                BenchOperand_t * pOperand )
+{
+    CK_RV result = CKR_OK;
+    CK_BBOOL trueValue = CK_TRUE;
+    CK_BBOOL tokenValue = ( benchConfig.keygenToken == true ) ? CK_TRUE : CK_FALSE;
+    CK_KEY_TYPE keyType = CKK_EC;
+    CK_BYTE ecParams[] = pkcs11DER_ENCODED_OID_P256;
+    const char * pPublicLabel = ( benchConfig.keygenToken == true ) ?
+                                pkcs11configLABEL_DEVICE_PUBLIC_KEY_FOR_TLS : BENCH_EC_PUBLIC_KEY_LABEL;
+    const char * pPrivateLabel = ( benchConfig.keygenToken == true ) ?
+                                 pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS : BENCH_EC_PRIVATE_KEY_LABEL;
+    CK_OBJECT_HANDLE publicKey = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE privateKey = CK_INVALID_HANDLE;
+    CK_ATTRIBUTE publicKeyTemplate[] =
+    {
+        { CKA_KEY_TYPE,  &keyType,                     sizeof( keyType )      },
+        { CKA_TOKEN,     &tokenValue,                  sizeof( tokenValue )   },
+        { CKA_VERIFY,    &trueValue,                   sizeof( trueValue )    },
+        { CKA_EC_PARAMS, ecParams,                     sizeof( ecParams )     },
+        { CKA_LABEL,     ( CK_VOID_PTR ) pPublicLabel, strlen( pPublicLabel ) }
+    };
+    CK_ATTRIBUTE privateKeyTemplate[] =
+    {
+        { CKA_KEY_TYPE, &keyType,                      sizeof( keyType )       },
+        { CKA_TOKEN,    &tokenValue,                   sizeof( tokenValue )    },
+        { CKA_PRIVATE,  &trueValue,                    sizeof( trueValue )     },
+        { CKA_SIGN,     &trueValue,                    sizeof( trueValue )     },
+        { CKA_LABEL,    ( CK_VOID_PTR ) pPrivateLabel, strlen( pPrivateLabel ) }
+    };
+
+    result = pModule->pFunctionList->C_GenerateKeyPair( pModule->session,
+                                                        &( pOperand->mechanism ),
+                                                        publicKeyTemplate,
+                                                        sizeof( publicKeyTemplate ) / sizeof( CK_ATTRIBUTE ),
+                                                        privateKeyTemplate,
+                                                        sizeof( privateKeyTemplate ) / sizeof( CK_ATTRIBUTE ),
+                                                        &publicKey,
+                                                        &privateKey );
+
+    if( result == CKR_OK )
+    {
+        /* The session objects of the previous run are destroyed so that they
+         * do not pile up in the token. Token objects keep the same labels,
+         * which corePKCS11 replaces. */
+        if( pModule->ecKeysGenerated == true )
+        {
+            ( void ) pModule->pFunctionList->C_DestroyObject( pModule->session, pModule->ecPublicKey );
+            ( void ) pModule->pFunctionList->C_DestroyObject( pModule->session, pModule->ecPrivateKey );
+        }
+
+        pModule->ecPublicKey = publicKey;
+        pModule->ecPrivateKey = privateKey;
+        pModule->ecKeysGenerated = ( tokenValue == CK_FALSE );
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+static CK_RV generateRsaKeyPair( BenchModule_t * pModule,
+                                 BenchOperand_t * pOperand )
+{
+    CK_RV result = CKR_OK;
+    CK_BBOOL trueValue = CK_TRUE;
+    CK_BBOOL falseValue = CK_FALSE;
+    CK_KEY_TYPE keyType = CKK_RSA;
+    CK_ULONG modulusBits = RSA_MODULUS_BITS;
+    CK_BYTE publicExponent[] = { 0x01, 0x00, 0x01 };
+    CK_BYTE publicLabel[] = BENCH_RSA_PUBLIC_KEY_LABEL;
+    CK_BYTE privateLabel[] = BENCH_RSA_PRIVATE_KEY_LABEL;
+    CK_OBJECT_HANDLE publicKey = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE privateKey = CK_INVALID_HANDLE;
+    CK_ATTRIBUTE publicKeyTemplate[] =
+    {
+        { CKA_KEY_TYPE,        &keyType,       sizeof( keyType )           },
+        { CKA_TOKEN,           &falseValue,    sizeof( falseValue )        },
+        { CKA_VERIFY,          &trueValue,     sizeof( trueValue )         },
+        { CKA_MODULUS_BITS,    &modulusBits,   sizeof( modulusBits )       },
+        { CKA_PUBLIC_EXPONENT, publicExponent, sizeof( publicExponent )    },
+        { CKA_LABEL,           publicLabel,    sizeof( publicLabel ) - 1UL }
+    };
+    CK_ATTRIBUTE privateKeyTemplate[] =
+    {
+        { CKA_KEY_TYPE, &keyType,     sizeof( keyType )            },
+        { CKA_TOKEN,    &falseValue,  sizeof( falseValue )         },
+        { CKA_PRIVATE,  &trueValue,   sizeof( trueValue )          },
+        { CKA_SIGN,     &trueValue,   sizeof( trueValue )          },
+        { CKA_LABEL,    privateLabel, sizeof( privateLabel ) - 1UL }
+    };
+
+    result = pModule->pFunctionList->C_GenerateKeyPair( pModule->session,
+                                                        &( pOperand->mechanism ),
+                                                        publicKeyTemplate,
+                                                        sizeof( publicKeyTemplate ) / sizeof( CK_ATTRIBUTE ),
+                                                        privateKeyTemplate,
+                                                        sizeof( privateKeyTemplate ) / sizeof( CK_ATTRIBUTE ),
+                                                        &publicKey,
+                                                        &privateKey );
+
+    if( result == CKR_OK )
+    {
+        if( pModule->rsaKeysGenerated == true )
+        {
+            ( void ) pModule->pFunctionList->C_DestroyObject( pModule->session, pModule->rsaPublicKey );
+            ( void ) pModule->pFunctionList->C_DestroyObject( pModule->session, pModule->rsaPrivateKey );
+        }
+
+        pModule->rsaPublicKey = publicKey;
+        pModule->rsaPrivateKey = privateKey;
+        pModule->rsaKeysGenerated = true;
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool benchModule( BenchModule_t * pModule )
+{
+    bool success = true;
+    static BenchOperand_t operand;
+    static CK_BYTE digestInfo[ SHA256_DIGEST_INFO_HEADER_LENGTH + pkcs11SHA256_DIGEST_LENGTH ] = SHA256_DIGEST_INFO_HEADER;
+    char name[ NAME_MAX_LENGTH ];
+    uint32_t index = 0U;
+
+    printf( "\n%s, slot %lu:\n", pModule->pName, ( unsigned long ) pModule->slotId );
+    ( void ) memset( &operand, 0x00, sizeof( operand ) );
+
+    if( ( benchConfig.tests & TEST_RANDOM ) != 0U )
+    {
+        operand.dataLength = RANDOM_LENGTH;
+        success = runBenchmark( pModule, "C_GenerateRandom 32 bytes", generateRandom, &operand ) && success;
+    }
+
+    if( ( benchConfig.tests & TEST_DIGEST ) != 0U )
+    {
+        operand.mechanism.mechanism = CKM_SHA256;
+        operand.pData = pMessage;
+
+        if( mechanismSupported( pModule, CKM_SHA256, CKF_DIGEST ) == false )
+        {
+            printf( "  SHA-256 digest not supported.\n" );
+        }
+        else
+        {
+            for( index = 0U; index < benchConfig.digestLengthCount; index++ )
+            {
+                operand.dataLength = benchConfig.digestLengths[ index ];
+                ( void ) snprintf( name, sizeof( name ), "SHA-256 %lu bytes", ( unsigned long ) operand.dataLength );
+                success = runBenchmark( pModule, name, digest, &operand ) && success;
+            }
+        }
+    }
+
+    if( ( benchConfig.tests & TEST_KEYGEN ) != 0U )
+    {
+        operand.mechanism.mechanism = CKM_EC_KEY_PAIR_GEN;
+
+        if( mechanismSupported( pModule, CKM_EC_KEY_PAIR_GEN, CKF_GENERATE_KEY_PAIR ) == true )
+        {
+            success = runBenchmark( pModule, "EC P-256 key pair", generateEcKeyPair, &operand ) && success;
+        }
+        else
+        {
+            printf( "  EC key pair generation not supported.\n" );
+        }
+
+        operand.mechanism.mechanism = CKM_RSA_PKCS_KEY_PAIR_GEN;
+
+        if( mechanismSupported( pModule, CKM_RSA_PKCS_KEY_PAIR_GEN, CKF_GENERATE_KEY_PAIR ) == true )
+        {
+            success = runBenchmark( pModule, "RSA 2048 key pair", generateRsaKeyPair, &operand ) && success;
+        }
+        else
+        {
+            printf( "  RSA key pair generation not supported.\n" );
+        }
+    }
+
+    /* The signatures are those of TLS client authentication and of the OTA
+     * image verification: of a SHA-256 digest. */
+    if( ( benchConfig.tests & TEST_ECDSA ) != 0U )
+    {
+        if( pModule->ecPrivateKey == CK_INVALID_HANDLE )
+        {
+            pModule->ecPrivateKey = findObject( pModule, benchConfig.pEcPrivateKeyLabel, CKO_PRIVATE_KEY );
+            pModule->ecPublicKey = findObject( pModule, benchConfig.pEcPublicKeyLabel, CKO_PUBLIC_KEY );
+        }
+
+        operand.mechanism.mechanism = CKM_ECDSA;
+        operand.pData = &digestInfo[ SHA256_DIGEST_INFO_HEADER_LENGTH ];
+        operand.dataLength = pkcs11SHA256_DIGEST_LENGTH;
+        operand.key = pModule->ecPrivateKey;
+
+        if( mechanismSupported( pModule, CKM_ECDSA, CKF_SIGN ) == false )
+        {
+            printf( "  ECDSA not supported.\n" );
+        }
+        else if( operand.key == CK_INVALID_HANDLE )
+        {
+            printf( "  ECDSA skipped: no EC private key labelled %s.\n", benchConfig.pEcPrivateKeyLabel );
+        }
+        else if( runBenchmark( pModule, "ECDSA P-256 sign", sign, &operand ) == false )
+        {
+            success = false;
+        }
+        else if( pModule->ecPublicKey == CK_INVALID_HANDLE )
+        {
+            printf( "  ECDSA verify skipped: no EC public key labelled %s.\n", benchConfig.pEcPublicKeyLabel );
+        }
+        else
+        {
+            operand.key = pModule->ecPublicKey;
+            success = runBenchmark( pModule, "ECDSA P-256 verify", verify, &operand ) && success;
+        }
+    }
+
+    if( ( benchConfig.tests & TEST_RSA ) != 0U )
+    {
+        if( pModule->rsaPrivateKey == CK_INVALID_HANDLE )
+        {
+            pModule->rsaPrivateKey = findObject( pModule, benchConfig.pRsaPrivateKeyLabel, CKO_PRIVATE_KEY );
+            pModule->rsaPublicKey = findObject( pModule, benchConfig.pRsaPublicKeyLabel, CKO_PUBLIC_KEY );
+        }
+
+        /* CKM_RSA_PKCS signs the DigestInfo of the digest, as TLS does. */
+        operand.mechanism.mechanism = CKM_RSA_PKCS;
+        operand.pData = digestInfo;
+        operand.dataLength = sizeof( digestInfo );
+        operand.key = pModule->rsaPrivateKey;
+
+        if( mechanismSupported( pModule, CKM_RSA_PKCS, CKF_SIGN ) == false )
+        {
+            printf( "  RSA PKCS #1 v1.5 not supported.\n" );
+        }
+        else if( operand.key == CK_INVALID_HANDLE )
+        {
+            printf( "  RSA skipped: no RSA private key; give --rsa-label or run keygen.\n" );
+        }
+        else if( runBenchmark( pModule, "RSA PKCS #1 v1.5 sign", sign, &operand ) == false )
+        {
+            success = false;
+        }
+        else if( pModule->rsaPublicKey == CK_INVALID_HANDLE )
+        {
+            printf( "  RSA verify skipped: no RSA public key; give --rsa-pub-label.\n" );
+        }
+        else
+        {
+            operand.key = pModule->rsaPublicKey;
+            success = runBenchmark( pModule, "RSA PKCS #1 v1.5 verify", verify, &operand ) && success;
+        }
+    }
+
+    return success;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char * argv[] )
+{
+    int returnStatus = EXIT_SUCCESS;
+    static BenchModule_t module;
+    CK_ULONG messageLength = 0UL;
+    uint32_t index = 0U;
+
+    if( parseArgs( &benchConfig, argc, argv ) == false )
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        for( index = 0U; index < benchConfig.digestLengthCount; index++ )
+        {
+            if( benchConfig.digestLengths[ index ] > messageLength )
+            {
+                messageLength = benchConfig.digestLengths[ index ];
+            }
+        }
+
+        /* The content of the message does not change the time it takes. */
+        pMessage = calloc( 1U, messageLength + 1UL );
+
+        if( pMessage == NULL )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        printf( "\nEach operation runs %u times or for %u s, whichever comes first.\n",
+                ( unsigned int ) benchConfig.iterations,
+                ( unsigned int ) benchConfig.durationSec );
+    }
+
+    /* Index 0 is the module linked in, followed by those given. */
+    for( index = ( benchConfig.builtin == true ) ? 0U : 1U;
+         ( returnStatus == EXIT_SUCCESS ) && ( index <= benchConfig.moduleCount );
+         index++ )
+    {
+        if( openModule( &module, ( index == 0U ) ? NULL : benchConfig.pModulePaths[ index - 1U ] ) == false )
+        {
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            if( benchModule( &module ) == false )
+            {
+                returnStatus = EXIT_FAILURE;
+            }
+
+            closeModule( &module );
+        }
+    }
+
+    free( pMessage );
+
+    return returnStatus;
+}
@@ -50,6 +50,9 @@
 /* Demo includes. */
 #include "demo_helpers.h"
 
+/* Allocator include. */
+#include "allocator.h"
+
 /* RSA certificate that has been generated off the device.
  * This key will be used as an example for importing an object onto the device.
  * This is useful when the device itself cannot create credentials or for storing
@@ -418,6 +421,7 @@ static CK_RV objectGeneration( void )
     writeHexBytesToConsole( "Public Key in Hex Format",
                             derPublicKey,
                             derPublicKeyLength );
+    Allocator_Free( derPublicKey );
     LogInfo( ( "---------Finished Generating Objects---------" ) );
     end( session, slotId );
 
@@ -48,6 +48,9 @@
 /* Demo includes. */
 #include "demo_helpers.h"
 
+/* Allocator include. */
+#include "allocator.h"
+
 /**
  * @brief This function details how to use the PKCS #11 "Sign and Verify" functions to
  * create and interact with digital signatures.
@@ -96,7 +99,8 @@ CK_RV PKCS11SignVerifyDemo( void )
     CK_MECHANISM xDigestMechanism = { 0 };
 
     /* Signing variables. */
-    /* The ECDSA mechanism will be used to sign the message digest. */
+    /* The ECDSA mechanism will be used to verify the signature of the message
+     * digest. */
     CK_MECHANISM mechanism = { CKM_ECDSA, NULL, 0 };
 
     /* This signature buffer will be used to store the signature created by the
@@ -152,26 +156,27 @@ CK_RV PKCS11SignVerifyDemo( void )
      * "Object Management Functions" in PKCS #11.
      *
      * This will acquire the object handle for the private key created in the
-     * "objects.c" demo.
+     * "objects.c" demo. The handle is cached, so that signing again from this
+     * thread does not search the token again.
      */
     if( result == CKR_OK )
     {
-        result = xFindObjectWithLabelAndClass( session,
-                                               pkcs11demoPRIVATE_KEY_LABEL,
-                                               sizeof( pkcs11demoPRIVATE_KEY_LABEL ),
-                                               CKO_PRIVATE_KEY,
-                                               &privateKeyHandle );
+        result = findObjectCached( session,
+                                   pkcs11demoPRIVATE_KEY_LABEL,
+                                   sizeof( pkcs11demoPRIVATE_KEY_LABEL ),
+                                   CKO_PRIVATE_KEY,
+                                   &privateKeyHandle );
     }
 
     /* Acquire the object handle for the public key created in the "objects.c"
      * demo. */
     if( result == CKR_OK )
     {
-        result = xFindObjectWithLabelAndClass( session,
-                                               pkcs11demoPUBLIC_KEY_LABEL,
-                                               sizeof( pkcs11demoPUBLIC_KEY_LABEL ),
-                                               CKO_PRIVATE_KEY,
-                                               &publicKeyHandle );
+        result = findObjectCached( session,
+                                   pkcs11demoPUBLIC_KEY_LABEL,
+                                   sizeof( pkcs11demoPUBLIC_KEY_LABEL ),
+                                   CKO_PRIVATE_KEY,
+                                   &publicKeyHandle );
     }
 
     if( ( privateKeyHandle == CK_INVALID_HANDLE ) || ( publicKeyHandle == CK_INVALID_HANDLE ) )
@@ -230,29 +235,28 @@ CK_RV PKCS11SignVerifyDemo( void )
 
     /********************************* Sign **********************************/
 
-    /* Initializes the sign operation and sets what mechanism will be used
-     * for signing the message digest. Specify what object handle to use for this
-     * operation, in this case the private key object handle. */
+    /* The signMessage helper signs the SHA-256 digest of the message with the
+     * private key. C_SignInit sets what mechanism will be used and what object
+     * handle to use for the operation, and C_Sign puts the signature in the
+     * byte buffer signature.
+     *
+     * The helper uses CKM_ECDSA_SHA256 when the token supports it, so that the
+     * token hashes the message itself. Otherwise it hashes the message on the
+     * host and uses CKM_ECDSA, which signs the same digest that was created
+     * above with the C_Digest series of functions. To sign many messages, see
+     * signMessages. */
     if( result == CKR_OK )
     {
         LogInfo( ( "Signing known message: %s",
                    ( char * ) knownMessage ) );
 
-        result = functionList->C_SignInit( session,
-                                           &mechanism,
-                                           privateKeyHandle );
-    }
-
-    /* Sign the message digest that was created with the C_Digest series of
-     * functions. A signature will be created using the private key specified in
-     * C_SignInit and put in the byte buffer signature. */
-    if( result == CKR_OK )
-    {
-        result = functionList->C_Sign( session,
-                                       digestResult,
-                                       pkcs11SHA256_DIGEST_LENGTH,
-                                       signature,
-                                       &signatureLength );
+        result = signMessage( session,
+                              privateKeyHandle,
+                              knownMessage,
+                              /* Strip NULL Terminator. */
+                              sizeof( knownMessage ) - 1,
+                              signature,
+                              &signatureLength );
     }
 
     /********************************* Verify **********************************/
@@ -261,8 +265,9 @@ CK_RV PKCS11SignVerifyDemo( void )
      * same Cryptoki library was able to trust itself.
      *
      * C_VerifyInit will begin the verify operation, by specifying what mechanism
-     * to use (CKM_ECDSA, the same as the sign operation) and then specifying
-     * which public key handle to use.
+     * to use (CKM_ECDSA, as the digest of the message is verified whichever
+     * of the ECDSA mechanisms signed it) and then specifying which public key
+     * handle to use.
      */
     if( result == CKR_OK )
     {
@@ -346,6 +351,7 @@ CK_RV PKCS11SignVerifyDemo( void )
         writeHexBytesToConsole( "Public Key in Hex Format",
                                 derPublicKey,
                                 derPublicKeyLength );
+        Allocator_Free( derPublicKey );
     }
 
     /* This utility function converts the PKCS #11 signature into an ASN.1
@@ -0,0 +1,19 @@
+# This file is to add source files and include directories
+# into variables so that it can be reused from different demos
+# in their Cmake based build system by including this file.
+
+# Outgoing QoS1 publish window source files.
+set( PUBLISH_WINDOW_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/publish_window.c )
+
+# Outgoing QoS1 publish window include directories.
+set( PUBLISH_WINDOW_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
+
+# Outgoing QoS1 publish store source files.
+set( PUBLISH_STORE_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/publish_store.c )
+
+# Offline publish queue source files.
+set( PUBLISH_QUEUE_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/publish_queue.c )
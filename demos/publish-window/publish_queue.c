@@ -0,0 +1,422 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_queue.c
+ * @brief The publishes issued while the connection to the broker is down.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <string.h>
+
+#include "publish_queue.h"
+
+/**
+ * @brief An index of no entry, for the ends of the lists.
+ */
+#define INDEX_NONE    ( ( uint16_t ) UINT16_MAX )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the rule of a topic.
+ *
+ * @param[in] pQueue The queue.
+ * @param[in] pPublishInfo The publish.
+ * @param[out] pPriority The priority of the publish.
+ * @param[out] pDropPolicy The drop policy of the publish.
+ */
+static void findRule( const PublishQueue_t * pQueue,
+                      const MQTTPublishInfo_t * pPublishInfo,
+                      uint8_t * pPriority,
+                      PublishQueueDropPolicy_t * pDropPolicy );
+
+/**
+ * @brief Make room for a publish in a full queue, by dropping a publish
+ * queued with a lower priority, or with the same priority and the
+ * #PublishQueueDropOldest policy.
+ *
+ * @param[in] pQueue The queue.
+ * @param[in] priority The priority of the new publish.
+ * @param[in] dropPolicy The drop policy of the new publish.
+ *
+ * @return true if a publish was dropped; false otherwise.
+ */
+static bool dropForPublish( PublishQueue_t * pQueue,
+                            uint8_t priority,
+                            PublishQueueDropPolicy_t dropPolicy );
+
+/**
+ * @brief Take the oldest publish of a priority out of its list.
+ *
+ * @param[in] pQueue The queue.
+ * @param[in] priority The priority, whose list must not be empty.
+ *
+ * @return The index of the entry of the publish.
+ */
+static uint16_t unlinkOldest( PublishQueue_t * pQueue,
+                              uint8_t priority );
+
+/**
+ * @brief Return an entry to the free list.
+ *
+ * @param[in] pQueue The queue.
+ * @param[in] index The index of the entry.
+ */
+static void freeEntry( PublishQueue_t * pQueue,
+                       uint16_t index );
+
+/*-----------------------------------------------------------*/
+
+static void findRule( const PublishQueue_t * pQueue,
+                      const MQTTPublishInfo_t * pPublishInfo,
+                      uint8_t * pPriority,
+                      PublishQueueDropPolicy_t * pDropPolicy )
+{
+    bool isMatch = false;
+    size_t i = 0U;
+
+    *pPriority = ( uint8_t ) ( PUBLISH_QUEUE_PRIORITY_COUNT - 1U );
+    *pDropPolicy = PublishQueueDropOldest;
+
+    for( i = 0U; ( i < pQueue->ruleCount ) && ( isMatch == false ); i++ )
+    {
+        ( void ) MQTT_MatchTopic( pPublishInfo->pTopicName,
+                                  pPublishInfo->topicNameLength,
+                                  pQueue->pRules[ i ].pTopicFilter,
+                                  pQueue->pRules[ i ].topicFilterLength,
+                                  &isMatch );
+
+        if( isMatch == true )
+        {
+            *pPriority = pQueue->pRules[ i ].priority;
+            *pDropPolicy = pQueue->pRules[ i ].dropPolicy;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool dropForPublish( PublishQueue_t * pQueue,
+                            uint8_t priority,
+                            PublishQueueDropPolicy_t dropPolicy )
+{
+    uint8_t lowest = ( uint8_t ) PUBLISH_QUEUE_PRIORITY_COUNT;
+    bool dropped = false;
+
+    /* The publishes taken out are not dropped, so the queue may hold none of
+     * any priority. */
+    while( ( lowest > 0U ) && ( pQueue->heads[ lowest - 1U ] == INDEX_NONE ) )
+    {
+        lowest--;
+    }
+
+    if( lowest > 0U )
+    {
+        lowest--;
+
+        if( ( lowest > priority ) ||
+            ( ( lowest == priority ) && ( dropPolicy == PublishQueueDropOldest ) ) )
+        {
+            freeEntry( pQueue, unlinkOldest( pQueue, lowest ) );
+            pQueue->droppedCount++;
+            dropped = true;
+        }
+    }
+
+    return dropped;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t unlinkOldest( PublishQueue_t * pQueue,
+                              uint8_t priority )
+{
+    uint16_t index = pQueue->heads[ priority ];
+
+    pQueue->heads[ priority ] = pQueue->pEntries[ index ].next;
+
+    if( pQueue->heads[ priority ] == INDEX_NONE )
+    {
+        pQueue->tails[ priority ] = INDEX_NONE;
+    }
+
+    pQueue->queuedCount--;
+
+    return index;
+}
+
+/*-----------------------------------------------------------*/
+
+static void freeEntry( PublishQueue_t * pQueue,
+                       uint16_t index )
+{
+    PublishQueueEntry_t * pEntry = &( pQueue->pEntries[ index ] );
+
+    ( void ) memset( pEntry, 0x00, sizeof( PublishQueueEntry_t ) );
+    pEntry->next = pQueue->freeHead;
+    pQueue->freeHead = index;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishQueueStatus_t PublishQueue_Init( PublishQueue_t * pQueue,
+                                        PublishQueueEntry_t * pEntries,
+                                        size_t entryCount,
+                                        uint8_t * pSlots,
+                                        size_t slotSize,
+                                        const PublishQueueRule_t * pRules,
+                                        size_t ruleCount )
+{
+    PublishQueueStatus_t status = PublishQueueSuccess;
+    size_t i = 0U;
+
+    if( ( pQueue == NULL ) || ( pEntries == NULL ) || ( pSlots == NULL ) ||
+        ( entryCount == 0U ) || ( entryCount > PUBLISH_QUEUE_MAX_ENTRIES ) ||
+        ( slotSize == 0U ) || ( ( pRules == NULL ) && ( ruleCount > 0U ) ) )
+    {
+        status = PublishQueueBadParameter;
+    }
+    else
+    {
+        for( i = 0U; i < ruleCount; i++ )
+        {
+            if( ( pRules[ i ].pTopicFilter == NULL ) ||
+                ( pRules[ i ].priority >= PUBLISH_QUEUE_PRIORITY_COUNT ) )
+            {
+                status = PublishQueueBadParameter;
+            }
+        }
+    }
+
+    if( status == PublishQueueSuccess )
+    {
+        ( void ) memset( pQueue, 0x00, sizeof( PublishQueue_t ) );
+        pQueue->pEntries = pEntries;
+        pQueue->entryCount = entryCount;
+        pQueue->pSlots = pSlots;
+        pQueue->slotSize = slotSize;
+        pQueue->pRules = pRules;
+        pQueue->ruleCount = ruleCount;
+        pQueue->freeHead = INDEX_NONE;
+
+        for( i = 0U; i < PUBLISH_QUEUE_PRIORITY_COUNT; i++ )
+        {
+            pQueue->heads[ i ] = INDEX_NONE;
+            pQueue->tails[ i ] = INDEX_NONE;
+        }
+
+        /* The free list starts with the first entry. */
+        for( i = entryCount; i > 0U; i-- )
+        {
+            freeEntry( pQueue, ( uint16_t ) ( i - 1U ) );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishQueueStatus_t PublishQueue_Enqueue( PublishQueue_t * pQueue,
+                                           const MQTTPublishInfo_t * pPublishInfo )
+{
+    PublishQueueStatus_t status = PublishQueueSuccess;
+    PublishQueueDropPolicy_t dropPolicy = PublishQueueDropOldest;
+    PublishQueueEntry_t * pEntry = NULL;
+    uint8_t * pSlot = NULL;
+    uint8_t priority = 0U;
+    uint16_t index = INDEX_NONE;
+
+    if( ( pQueue == NULL ) || ( pQueue->pEntries == NULL ) || ( pPublishInfo == NULL ) ||
+        ( pPublishInfo->pTopicName == NULL ) || ( pPublishInfo->topicNameLength == 0U ) ||
+        ( ( pPublishInfo->pPayload == NULL ) && ( pPublishInfo->payloadLength > 0U ) ) ||
+        ( pPublishInfo->payloadLength > pQueue->slotSize ) ||
+        ( pPublishInfo->topicNameLength > ( pQueue->slotSize - pPublishInfo->payloadLength ) ) )
+    {
+        status = PublishQueueBadParameter;
+    }
+    else
+    {
+        findRule( pQueue, pPublishInfo, &priority, &dropPolicy );
+
+        if( pQueue->freeHead == INDEX_NONE )
+        {
+            if( dropForPublish( pQueue, priority, dropPolicy ) == false )
+            {
+                pQueue->droppedCount++;
+                status = PublishQueueFull;
+            }
+        }
+    }
+
+    if( status == PublishQueueSuccess )
+    {
+        index = pQueue->freeHead;
+        pEntry = &( pQueue->pEntries[ index ] );
+        pQueue->freeHead = pEntry->next;
+
+        /* The topic is followed by the payload in the slot. */
+        pSlot = &( pQueue->pSlots[ ( size_t ) index * pQueue->slotSize ] );
+        ( void ) memcpy( pSlot, pPublishInfo->pTopicName, pPublishInfo->topicNameLength );
+
+        if( pPublishInfo->payloadLength > 0U )
+        {
+            ( void ) memcpy( &( pSlot[ pPublishInfo->topicNameLength ] ),
+                             pPublishInfo->pPayload,
+                             pPublishInfo->payloadLength );
+        }
+
+        pEntry->publishInfo = *pPublishInfo;
+        pEntry->publishInfo.pTopicName = ( const char * ) pSlot;
+        pEntry->publishInfo.pPayload = &( pSlot[ pPublishInfo->topicNameLength ] );
+        pEntry->publishInfo.dup = false;
+        pEntry->packetId = 0U;
+        pEntry->next = INDEX_NONE;
+        pEntry->priority = priority;
+        pEntry->inUse = 1U;
+
+        if( pQueue->tails[ priority ] == INDEX_NONE )
+        {
+            pQueue->heads[ priority ] = index;
+        }
+        else
+        {
+            pQueue->pEntries[ pQueue->tails[ priority ] ].next = index;
+        }
+
+        pQueue->tails[ priority ] = index;
+        pQueue->queuedCount++;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+const MQTTPublishInfo_t * PublishQueue_Peek( const PublishQueue_t * pQueue )
+{
+    const MQTTPublishInfo_t * pPublishInfo = NULL;
+    size_t priority = 0U;
+
+    if( ( pQueue != NULL ) && ( pQueue->pEntries != NULL ) )
+    {
+        for( priority = 0U; ( priority < PUBLISH_QUEUE_PRIORITY_COUNT ) && ( pPublishInfo == NULL ); priority++ )
+        {
+            if( pQueue->heads[ priority ] != INDEX_NONE )
+            {
+                pPublishInfo = &( pQueue->pEntries[ pQueue->heads[ priority ] ].publishInfo );
+            }
+        }
+    }
+
+    return pPublishInfo;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishQueueStatus_t PublishQueue_Dequeue( PublishQueue_t * pQueue,
+                                           uint16_t packetId )
+{
+    PublishQueueStatus_t status = PublishQueueNotFound;
+    uint16_t index = INDEX_NONE;
+    uint8_t priority = 0U;
+
+    if( ( pQueue == NULL ) || ( pQueue->pEntries == NULL ) )
+    {
+        status = PublishQueueBadParameter;
+    }
+    else
+    {
+        while( ( priority < PUBLISH_QUEUE_PRIORITY_COUNT ) && ( pQueue->heads[ priority ] == INDEX_NONE ) )
+        {
+            priority++;
+        }
+
+        if( priority < PUBLISH_QUEUE_PRIORITY_COUNT )
+        {
+            index = unlinkOldest( pQueue, priority );
+
+            if( packetId == 0U )
+            {
+                freeEntry( pQueue, index );
+            }
+            else
+            {
+                pQueue->pEntries[ index ].packetId = packetId;
+                pQueue->pEntries[ index ].next = INDEX_NONE;
+            }
+
+            status = PublishQueueSuccess;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishQueueStatus_t PublishQueue_Release( PublishQueue_t * pQueue,
+                                           uint16_t packetId )
+{
+    PublishQueueStatus_t status = PublishQueueNotFound;
+    size_t i = 0U;
+
+    if( ( pQueue == NULL ) || ( pQueue->pEntries == NULL ) || ( packetId == 0U ) )
+    {
+        status = PublishQueueBadParameter;
+    }
+    else
+    {
+        for( i = 0U; ( i < pQueue->entryCount ) && ( status == PublishQueueNotFound ); i++ )
+        {
+            if( ( pQueue->pEntries[ i ].inUse == 1U ) && ( pQueue->pEntries[ i ].packetId == packetId ) )
+            {
+                freeEntry( pQueue, ( uint16_t ) i );
+                status = PublishQueueSuccess;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void PublishQueue_ReleaseAll( PublishQueue_t * pQueue )
+{
+    size_t i = 0U;
+
+    if( ( pQueue != NULL ) && ( pQueue->pEntries != NULL ) )
+    {
+        for( i = 0U; i < pQueue->entryCount; i++ )
+        {
+            if( ( pQueue->pEntries[ i ].inUse == 1U ) && ( pQueue->pEntries[ i ].packetId != 0U ) )
+            {
+                freeEntry( pQueue, ( uint16_t ) i );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,210 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_queue.h
+ * @brief The publishes issued while the connection to the broker is down.
+ *
+ * The queue copies each publish into a slot of a caller supplied buffer, so
+ * the application may reuse its buffers at once. The publishes are taken out
+ * by priority, then in the order they were queued. The priority of a publish
+ * and what happens when the queue is full are set by the first rule whose
+ * topic filter matches its topic.
+ *
+ * A publish taken out to be sent keeps its slot until its PUBACK releases
+ * it, as a #PublishWindow_t points to its topic and payload until then.
+ */
+
+#ifndef PUBLISH_QUEUE_H_
+#define PUBLISH_QUEUE_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/**
+ * @brief Maximum number of publishes held by a queue.
+ */
+#define PUBLISH_QUEUE_MAX_ENTRIES    ( 32767U )
+
+/**
+ * @brief Number of priorities of the publishes, 0 being the highest.
+ *
+ * The publishes whose topic matches no rule have the lowest priority.
+ */
+#ifndef PUBLISH_QUEUE_PRIORITY_COUNT
+    #define PUBLISH_QUEUE_PRIORITY_COUNT    ( 4U )
+#endif
+
+/**
+ * @brief Return codes of the publish queue.
+ */
+typedef enum PublishQueueStatus
+{
+    PublishQueueSuccess = 0,  /**< @brief The operation completed. */
+    PublishQueueBadParameter, /**< @brief A parameter is invalid, or the publish does not fit in a slot. */
+    PublishQueueFull,         /**< @brief The queue is full and the publish is dropped. */
+    PublishQueueNotFound      /**< @brief The queue holds no such publish. */
+} PublishQueueStatus_t;
+
+/**
+ * @brief What happens to a publish queued when the queue is full.
+ *
+ * Any policy first makes room by dropping the oldest publish of the lowest
+ * priority, if that priority is lower than the priority of the new publish.
+ */
+typedef enum PublishQueueDropPolicy
+{
+    PublishQueueDropNewest = 0, /**< @brief Drop the new publish, keeping those of its priority already queued. */
+    PublishQueueDropOldest      /**< @brief Drop the oldest publish of the priority of the new publish, if it is the lowest queued. */
+} PublishQueueDropPolicy_t;
+
+/**
+ * @brief The priority and drop policy of the publishes of some topics.
+ */
+typedef struct PublishQueueRule
+{
+    const char * pTopicFilter;           /**< @brief The topics of the rule, with the wildcards of a subscription. */
+    uint16_t topicFilterLength;          /**< @brief Length of #PublishQueueRule_t.pTopicFilter. */
+    uint8_t priority;                    /**< @brief Priority of the publishes, less than #PUBLISH_QUEUE_PRIORITY_COUNT. */
+    PublishQueueDropPolicy_t dropPolicy; /**< @brief Policy of the publishes when the queue is full. */
+} PublishQueueRule_t;
+
+/**
+ * @brief An entry of a queue.
+ */
+typedef struct PublishQueueEntry
+{
+    MQTTPublishInfo_t publishInfo; /**< @brief The publish, whose topic and payload are in the slot of the entry. */
+    uint16_t packetId;             /**< @brief Packet identifier of a publish sent and awaiting its PUBACK; 0 otherwise. */
+    uint16_t next;                 /**< @brief The next publish of the same priority, or the next free entry. */
+    uint8_t priority;              /**< @brief Priority of the publish. */
+    uint8_t inUse;                 /**< @brief 1 if the entry holds a publish; 0 otherwise. */
+} PublishQueueEntry_t;
+
+/**
+ * @brief A queue of publishes.
+ *
+ * The members are set by #PublishQueue_Init and are not meant to be changed
+ * by the application. A queue initialized to zero has a NULL
+ * #PublishQueue_t.pEntries until then.
+ */
+typedef struct PublishQueue
+{
+    PublishQueueEntry_t * pEntries;                 /**< @brief The entries. */
+    size_t entryCount;                              /**< @brief Number of entries of #PublishQueue_t.pEntries. */
+    uint8_t * pSlots;                               /**< @brief The slots of the entries, one after the other. */
+    size_t slotSize;                                /**< @brief Size of a slot, the most topic and payload of a publish. */
+    const PublishQueueRule_t * pRules;              /**< @brief The rules, checked in order. */
+    size_t ruleCount;                               /**< @brief Number of rules of #PublishQueue_t.pRules. */
+    uint16_t heads[ PUBLISH_QUEUE_PRIORITY_COUNT ]; /**< @brief The oldest publish of each priority. */
+    uint16_t tails[ PUBLISH_QUEUE_PRIORITY_COUNT ]; /**< @brief The newest publish of each priority. */
+    uint16_t freeHead;                              /**< @brief The first free entry. */
+    size_t queuedCount;                             /**< @brief Number of publishes not taken out. */
+    size_t droppedCount;                            /**< @brief Number of publishes dropped because the queue was full. */
+} PublishQueue_t;
+
+/**
+ * @brief Set up an empty queue on the entries and slots given.
+ *
+ * @param[out] pQueue The queue.
+ * @param[in] pEntries The entries of the queue.
+ * @param[in] entryCount Number of entries of @p pEntries, at most
+ * #PUBLISH_QUEUE_MAX_ENTRIES.
+ * @param[in] pSlots A buffer of @p entryCount times @p slotSize bytes.
+ * @param[in] slotSize The most topic and payload of a publish.
+ * @param[in] pRules The rules of the queue, which must remain valid while it
+ * is used; NULL for none.
+ * @param[in] ruleCount Number of rules of @p pRules.
+ *
+ * @return #PublishQueueSuccess or #PublishQueueBadParameter.
+ */
+PublishQueueStatus_t PublishQueue_Init( PublishQueue_t * pQueue,
+                                        PublishQueueEntry_t * pEntries,
+                                        size_t entryCount,
+                                        uint8_t * pSlots,
+                                        size_t slotSize,
+                                        const PublishQueueRule_t * pRules,
+                                        size_t ruleCount );
+
+/**
+ * @brief Queue a copy of a publish.
+ *
+ * @param[in] pQueue The queue.
+ * @param[in] pPublishInfo The publish.
+ *
+ * @return #PublishQueueSuccess, #PublishQueueFull or
+ * #PublishQueueBadParameter.
+ */
+PublishQueueStatus_t PublishQueue_Enqueue( PublishQueue_t * pQueue,
+                                           const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Get the next publish to take out of a queue: the oldest of the
+ * highest priority.
+ *
+ * @param[in] pQueue The queue.
+ *
+ * @return The publish; NULL if none is queued.
+ */
+const MQTTPublishInfo_t * PublishQueue_Peek( const PublishQueue_t * pQueue );
+
+/**
+ * @brief Take out the publish returned by #PublishQueue_Peek.
+ *
+ * @param[in] pQueue The queue.
+ * @param[in] packetId The packet identifier the publish is sent with, to
+ * keep its slot until #PublishQueue_Release; 0 to free its slot now.
+ *
+ * @return #PublishQueueSuccess, #PublishQueueNotFound if no publish is
+ * queued, or #PublishQueueBadParameter.
+ */
+PublishQueueStatus_t PublishQueue_Dequeue( PublishQueue_t * pQueue,
+                                           uint16_t packetId );
+
+/**
+ * @brief Free the slot of a publish taken out of a queue, such as when its
+ * PUBACK is received.
+ *
+ * The publish is found by a scan of the entries of the queue.
+ *
+ * @param[in] pQueue The queue.
+ * @param[in] packetId The packet identifier the publish was sent with.
+ *
+ * @return #PublishQueueSuccess, #PublishQueueNotFound or
+ * #PublishQueueBadParameter.
+ */
+PublishQueueStatus_t PublishQueue_Release( PublishQueue_t * pQueue,
+                                           uint16_t packetId );
+
+/**
+ * @brief Free the slots of every publish taken out of a queue, such as when
+ * the broker starts a new session.
+ *
+ * @param[in] pQueue The queue.
+ */
+void PublishQueue_ReleaseAll( PublishQueue_t * pQueue );
+
+#endif /* ifndef PUBLISH_QUEUE_H_ */
@@ -0,0 +1,814 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_store.c
+ * @brief A file keeping the outgoing QoS1 publishes across restarts.
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "publish_store.h"
+
+/**
+ * @brief Marks the start of a record.
+ */
+#define RECORD_MAGIC             ( 0x31525350UL )
+
+/**
+ * @brief Type of the record of an added publish.
+ */
+#define RECORD_TYPE_ADD          ( 1U )
+
+/**
+ * @brief Type of the record of a removed publish.
+ */
+#define RECORD_TYPE_REMOVE       ( 2U )
+
+/**
+ * @brief Flag of a record whose publish is retained.
+ */
+#define RECORD_FLAG_RETAIN       ( 0x01U )
+
+/**
+ * @brief Records start at offsets multiple of this alignment, which is also
+ * the step of the search for the next record after an invalid one.
+ */
+#define RECORD_ALIGNMENT         ( 8U )
+
+/**
+ * @brief Initial value of the CRC-32 of a record.
+ */
+#define CRC32_INITIAL_VALUE      ( 0xFFFFFFFFUL )
+
+/**
+ * @brief Reversed polynomial of the CRC-32 of a record.
+ */
+#define CRC32_POLYNOMIAL         ( 0xEDB88320UL )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The header of a record, followed by the topic and the payload of
+ * its publish.
+ */
+typedef struct RecordHeader
+{
+    uint32_t magic;         /**< @brief #RECORD_MAGIC. */
+    uint32_t checksum;      /**< @brief CRC-32 of the record, computed with this member set to 0. */
+    uint32_t sequence;      /**< @brief Position of the record in the order they were appended. */
+    uint32_t payloadLength; /**< @brief Length of the payload of the publish. */
+    uint16_t packetId;      /**< @brief Packet identifier of the publish. */
+    uint16_t topicLength;   /**< @brief Length of the topic of the publish; 0 for #RECORD_TYPE_REMOVE. */
+    uint8_t type;           /**< @brief #RECORD_TYPE_ADD or #RECORD_TYPE_REMOVE. */
+    uint8_t qos;            /**< @brief QoS of the publish. */
+    uint8_t flags;          /**< @brief #RECORD_FLAG_RETAIN if the publish is retained. */
+    uint8_t reserved;       /**< @brief Always 0. */
+} RecordHeader_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Compute the CRC-32 of a record.
+ *
+ * @param[in] pHeader The header of the record.
+ * @param[in] pData The topic and payload following the header.
+ *
+ * @return The CRC-32.
+ */
+static uint32_t recordChecksum( const RecordHeader_t * pHeader,
+                                const uint8_t * pData );
+
+/**
+ * @brief Compute the size of a record, with its alignment padding.
+ *
+ * @param[in] pHeader The header of the record.
+ *
+ * @return The size of the record.
+ */
+static size_t recordSize( const RecordHeader_t * pHeader );
+
+/**
+ * @brief Read the header of a record, checking that the record is valid.
+ *
+ * @param[in] pStore The store.
+ * @param[in] offset The offset of the record.
+ * @param[out] pHeader The header of the record.
+ *
+ * @return true if the record is valid; false otherwise.
+ */
+static bool readRecord( const PublishStore_t * pStore,
+                        size_t offset,
+                        RecordHeader_t * pHeader );
+
+/**
+ * @brief Get the offset of the record of a publish of the window.
+ *
+ * @param[in] pStore The store.
+ * @param[in] pEntry The entry of the publish.
+ *
+ * @return The offset of the record.
+ */
+static size_t entryOffset( const PublishStore_t * pStore,
+                           const PublishWindowEntry_t * pEntry );
+
+/**
+ * @brief Make a publish point to the topic and payload of its record.
+ *
+ * @param[in] pStore The store.
+ * @param[in] offset The offset of the record.
+ * @param[in] pHeader The header of the record.
+ * @param[out] pPublishInfo The publish.
+ */
+static void pointToRecord( const PublishStore_t * pStore,
+                           size_t offset,
+                           const RecordHeader_t * pHeader,
+                           MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Apply a record read when opening the store to the window.
+ *
+ * A record applies if it is newer than the record of the same packet
+ * identifier in the window, so that the copies of a record moved by a
+ * compaction cut short by a crash count once.
+ *
+ * @param[in] pStore The store.
+ * @param[in] offset The offset of the record.
+ * @param[in] pHeader The header of the record.
+ */
+static void recoverRecord( PublishStore_t * pStore,
+                           size_t offset,
+                           const RecordHeader_t * pHeader );
+
+/**
+ * @brief Flush a range of the log to the disk.
+ *
+ * @param[in] pStore The store.
+ * @param[in] start The offset of the range.
+ * @param[in] end The offset following the range.
+ *
+ * @return #PublishStoreSuccess or #PublishStoreIoError.
+ */
+static PublishStoreStatus_t syncRange( const PublishStore_t * pStore,
+                                       size_t start,
+                                       size_t end );
+
+/**
+ * @brief Move the records of the publishes in the window to the start of
+ * the log, and erase the others.
+ *
+ * A record is moved only over bytes that hold no publish of the window, or
+ * publishes whose moved copy is already flushed, so a crash during the
+ * compaction leaves a copy of every publish. A record that would overlap
+ * its own copy stays where it is.
+ *
+ * @param[in] pStore The store.
+ *
+ * @return #PublishStoreSuccess or #PublishStoreIoError.
+ */
+static PublishStoreStatus_t compactLog( PublishStore_t * pStore );
+
+/**
+ * @brief Append a record to the log, compacting the log if it is full.
+ *
+ * @param[in] pStore The store.
+ * @param[in,out] pHeader The header of the record, whose sequence number and
+ * checksum are set.
+ * @param[in] pPublishInfo The publish of a #RECORD_TYPE_ADD record; NULL
+ * otherwise.
+ * @param[out] pOffset The offset of the record.
+ *
+ * @return #PublishStoreSuccess, #PublishStoreFull or #PublishStoreIoError.
+ */
+static PublishStoreStatus_t appendRecord( PublishStore_t * pStore,
+                                          RecordHeader_t * pHeader,
+                                          const MQTTPublishInfo_t * pPublishInfo,
+                                          size_t * pOffset );
+
+/**
+ * @brief Count a record appended to the log, and commit the pending records
+ * if they are due.
+ *
+ * @param[in] pStore The store.
+ * @param[in] end The offset following the record.
+ *
+ * @return #PublishStoreSuccess or #PublishStoreIoError.
+ */
+static PublishStoreStatus_t recordAppended( PublishStore_t * pStore,
+                                            size_t end );
+
+/**
+ * @brief Get the time of a monotonic clock.
+ *
+ * @return The time in milliseconds.
+ */
+static uint64_t currentTimeMs( void );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t recordChecksum( const RecordHeader_t * pHeader,
+                                const uint8_t * pData )
+{
+    RecordHeader_t header = *pHeader;
+    const uint8_t * pBytes = ( const uint8_t * ) &header;
+    size_t length = sizeof( RecordHeader_t );
+    size_t dataLength = ( size_t ) pHeader->topicLength + ( size_t ) pHeader->payloadLength;
+    uint32_t crc = CRC32_INITIAL_VALUE;
+    size_t i = 0U;
+    uint8_t bit = 0U;
+
+    header.checksum = 0U;
+
+    /* The header, then the data. */
+    while( pBytes != NULL )
+    {
+        for( i = 0U; i < length; i++ )
+        {
+            crc ^= pBytes[ i ];
+
+            for( bit = 0U; bit < 8U; bit++ )
+            {
+                crc = ( ( crc & 1UL ) != 0UL ) ? ( ( crc >> 1 ) ^ CRC32_POLYNOMIAL ) : ( crc >> 1 );
+            }
+        }
+
+        if( pBytes == ( const uint8_t * ) &header )
+        {
+            pBytes = pData;
+            length = dataLength;
+        }
+        else
+        {
+            pBytes = NULL;
+        }
+    }
+
+    return ~crc;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t recordSize( const RecordHeader_t * pHeader )
+{
+    size_t size = sizeof( RecordHeader_t ) +
+                  ( size_t ) pHeader->topicLength +
+                  ( size_t ) pHeader->payloadLength;
+
+    return ( size + RECORD_ALIGNMENT - 1U ) & ~( ( size_t ) RECORD_ALIGNMENT - 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool readRecord( const PublishStore_t * pStore,
+                        size_t offset,
+                        RecordHeader_t * pHeader )
+{
+    bool valid = false;
+
+    if( ( pStore->logSize - offset ) >= sizeof( RecordHeader_t ) )
+    {
+        ( void ) memcpy( pHeader, &( pStore->pLog[ offset ] ), sizeof( RecordHeader_t ) );
+
+        valid = ( pHeader->magic == RECORD_MAGIC ) &&
+                ( ( ( pHeader->type == RECORD_TYPE_ADD ) && ( pHeader->topicLength > 0U ) ) ||
+                  ( ( pHeader->type == RECORD_TYPE_REMOVE ) && ( pHeader->topicLength == 0U ) &&
+                    ( pHeader->payloadLength == 0U ) ) ) &&
+                ( pHeader->packetId != 0U ) &&
+                ( pHeader->payloadLength <= ( pStore->logSize - offset ) ) &&
+                ( recordSize( pHeader ) <= ( pStore->logSize - offset ) );
+
+        if( valid == true )
+        {
+            valid = ( recordChecksum( pHeader,
+                                      &( pStore->pLog[ offset + sizeof( RecordHeader_t ) ] ) ) == pHeader->checksum );
+        }
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t entryOffset( const PublishStore_t * pStore,
+                           const PublishWindowEntry_t * pEntry )
+{
+    const uint8_t * pTopic = ( const uint8_t * ) pEntry->publishInfo.pTopicName;
+
+    return ( size_t ) ( pTopic - pStore->pLog ) - sizeof( RecordHeader_t );
+}
+
+/*-----------------------------------------------------------*/
+
+static void pointToRecord( const PublishStore_t * pStore,
+                           size_t offset,
+                           const RecordHeader_t * pHeader,
+                           MQTTPublishInfo_t * pPublishInfo )
+{
+    const uint8_t * pData = &( pStore->pLog[ offset + sizeof( RecordHeader_t ) ] );
+
+    pPublishInfo->pTopicName = ( const char * ) pData;
+    pPublishInfo->topicNameLength = pHeader->topicLength;
+    pPublishInfo->pPayload = &( pData[ pHeader->topicLength ] );
+    pPublishInfo->payloadLength = pHeader->payloadLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static void recoverRecord( PublishStore_t * pStore,
+                           size_t offset,
+                           const RecordHeader_t * pHeader )
+{
+    PublishWindowEntry_t * pEntry = PublishWindow_Find( pStore->pWindow, pHeader->packetId );
+    RecordHeader_t entryHeader = { 0 };
+    MQTTPublishInfo_t publishInfo = { 0 };
+    bool newer = true;
+
+    if( pEntry != NULL )
+    {
+        ( void ) memcpy( &entryHeader,
+                         &( pStore->pLog[ entryOffset( pStore, pEntry ) ] ),
+                         sizeof( RecordHeader_t ) );
+        newer = ( pHeader->sequence > entryHeader.sequence );
+    }
+
+    if( newer == true )
+    {
+        /* The packet identifier was used again, or the publish removed. */
+        if( pEntry != NULL )
+        {
+            ( void ) PublishWindow_Remove( pStore->pWindow, pHeader->packetId );
+        }
+
+        if( pHeader->type == RECORD_TYPE_ADD )
+        {
+            pointToRecord( pStore, offset, pHeader, &publishInfo );
+            publishInfo.qos = ( MQTTQoS_t ) pHeader->qos;
+            publishInfo.retain = ( ( pHeader->flags & RECORD_FLAG_RETAIN ) != 0U );
+
+            /* A publish that does not fit in the window is dropped. */
+            ( void ) PublishWindow_Add( pStore->pWindow, pHeader->packetId, &publishInfo );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static PublishStoreStatus_t syncRange( const PublishStore_t * pStore,
+                                       size_t start,
+                                       size_t end )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+    size_t pageSize = ( size_t ) sysconf( _SC_PAGESIZE );
+    size_t pageStart = start - ( start % pageSize );
+
+    if( end > start )
+    {
+        if( msync( &( pStore->pLog[ pageStart ] ), end - pageStart, MS_SYNC ) != 0 )
+        {
+            status = PublishStoreIoError;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static PublishStoreStatus_t compactLog( PublishStore_t * pStore )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+    PublishWindowCursor_t cursor = PUBLISH_WINDOW_CURSOR_INITIALIZER;
+    PublishWindowEntry_t * pEntry = NULL;
+    RecordHeader_t header = { 0 };
+    size_t destination = 0U;
+    size_t source = 0U;
+    size_t size = 0U;
+
+    /* The window holds the publishes in the order of their records. */
+    pEntry = PublishWindow_Next( pStore->pWindow, &cursor );
+
+    while( ( pEntry != NULL ) && ( status == PublishStoreSuccess ) )
+    {
+        source = entryOffset( pStore, pEntry );
+        ( void ) memcpy( &header, &( pStore->pLog[ source ] ), sizeof( RecordHeader_t ) );
+        size = recordSize( &header );
+
+        if( ( source > destination ) && ( ( destination + size ) <= source ) )
+        {
+            /* The copy is flushed before anything can be written over the
+             * record. */
+            ( void ) memcpy( &( pStore->pLog[ destination ] ), &( pStore->pLog[ source ] ), size );
+            pointToRecord( pStore, destination, &header, &( pEntry->publishInfo ) );
+            status = syncRange( pStore, destination, destination + size );
+            destination += size;
+        }
+        else
+        {
+            /* The record stays where it is; the records before it are
+             * erased, so that they are not read again. */
+            if( source > destination )
+            {
+                ( void ) memset( &( pStore->pLog[ destination ] ), 0x00, source - destination );
+            }
+
+            destination = source + size;
+        }
+
+        pEntry = PublishWindow_Next( pStore->pWindow, &cursor );
+    }
+
+    if( status == PublishStoreSuccess )
+    {
+        ( void ) memset( &( pStore->pLog[ destination ] ), 0x00, pStore->appendOffset - destination );
+        status = syncRange( pStore, 0U, pStore->appendOffset );
+    }
+
+    if( status == PublishStoreSuccess )
+    {
+        pStore->appendOffset = destination;
+        pStore->committedOffset = destination;
+        pStore->pendingRecords = 0U;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static PublishStoreStatus_t appendRecord( PublishStore_t * pStore,
+                                          RecordHeader_t * pHeader,
+                                          const MQTTPublishInfo_t * pPublishInfo,
+                                          size_t * pOffset )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+    size_t size = recordSize( pHeader );
+    uint8_t * pData = NULL;
+
+    if( ( pStore->logSize - pStore->appendOffset ) < size )
+    {
+        status = compactLog( pStore );
+
+        if( ( status == PublishStoreSuccess ) && ( ( pStore->logSize - pStore->appendOffset ) < size ) )
+        {
+            status = PublishStoreFull;
+        }
+    }
+
+    if( status == PublishStoreSuccess )
+    {
+        pData = &( pStore->pLog[ pStore->appendOffset + sizeof( RecordHeader_t ) ] );
+
+        if( pPublishInfo != NULL )
+        {
+            ( void ) memcpy( pData, pPublishInfo->pTopicName, pHeader->topicLength );
+
+            if( pHeader->payloadLength > 0U )
+            {
+                ( void ) memcpy( &( pData[ pHeader->topicLength ] ), pPublishInfo->pPayload, pHeader->payloadLength );
+            }
+        }
+
+        pHeader->magic = RECORD_MAGIC;
+        pHeader->sequence = pStore->nextSequence;
+        pHeader->checksum = recordChecksum( pHeader, pData );
+        ( void ) memcpy( &( pStore->pLog[ pStore->appendOffset ] ), pHeader, sizeof( RecordHeader_t ) );
+
+        pStore->nextSequence++;
+        *pOffset = pStore->appendOffset;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static PublishStoreStatus_t recordAppended( PublishStore_t * pStore,
+                                            size_t end )
+{
+    pStore->appendOffset = end;
+
+    if( pStore->pendingRecords == 0U )
+    {
+        pStore->firstPendingTimeMs = currentTimeMs();
+    }
+
+    pStore->pendingRecords++;
+
+    return PublishStore_Commit( pStore, false );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t currentTimeMs( void )
+{
+    struct timespec now = { 0 };
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000U ) + ( ( uint64_t ) now.tv_nsec / 1000000U );
+}
+
+/*-----------------------------------------------------------*/
+
+PublishStoreStatus_t PublishStore_Open( PublishStore_t * pStore,
+                                        const char * pPath,
+                                        size_t logSize,
+                                        PublishWindow_t * pWindow )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+    struct stat fileStatus = { 0 };
+    RecordHeader_t header = { 0 };
+    size_t offset = 0U;
+    void * pMapping = MAP_FAILED;
+
+    if( ( pStore == NULL ) || ( pPath == NULL ) || ( pWindow == NULL ) ||
+        ( pWindow->pEntries == NULL ) || ( logSize < sizeof( RecordHeader_t ) ) )
+    {
+        status = PublishStoreBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pStore, 0x00, sizeof( PublishStore_t ) );
+        pStore->pWindow = pWindow;
+        pStore->fileDescriptor = open( pPath, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR );
+
+        if( ( pStore->fileDescriptor < 0 ) || ( fstat( pStore->fileDescriptor, &fileStatus ) != 0 ) )
+        {
+            status = PublishStoreIoError;
+        }
+    }
+
+    if( status == PublishStoreSuccess )
+    {
+        /* A new file is extended with zeros, which hold no record. */
+        if( ( size_t ) fileStatus.st_size < logSize )
+        {
+            if( ftruncate( pStore->fileDescriptor, ( off_t ) logSize ) != 0 )
+            {
+                status = PublishStoreIoError;
+            }
+        }
+        else
+        {
+            logSize = ( size_t ) fileStatus.st_size;
+        }
+    }
+
+    if( status == PublishStoreSuccess )
+    {
+        pMapping = mmap( NULL, logSize, PROT_READ | PROT_WRITE, MAP_SHARED, pStore->fileDescriptor, 0 );
+
+        if( pMapping == MAP_FAILED )
+        {
+            status = PublishStoreIoError;
+        }
+        else
+        {
+            pStore->pLog = ( uint8_t * ) pMapping;
+            pStore->logSize = logSize;
+        }
+    }
+
+    if( status == PublishStoreSuccess )
+    {
+        /* Every valid record of the file is read, including those after
+         * bytes cut short by a crash. */
+        while( ( logSize - offset ) >= sizeof( RecordHeader_t ) )
+        {
+            if( readRecord( pStore, offset, &header ) == true )
+            {
+                recoverRecord( pStore, offset, &header );
+
+                if( header.sequence >= pStore->nextSequence )
+                {
+                    pStore->nextSequence = header.sequence + 1U;
+                }
+
+                offset += recordSize( &header );
+                pStore->appendOffset = offset;
+            }
+            else
+            {
+                offset += RECORD_ALIGNMENT;
+            }
+        }
+
+        pStore->committedOffset = pStore->appendOffset;
+    }
+    else if( ( status == PublishStoreIoError ) && ( pStore->fileDescriptor >= 0 ) )
+    {
+        ( void ) close( pStore->fileDescriptor );
+        pStore->fileDescriptor = -1;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishStoreStatus_t PublishStore_Add( PublishStore_t * pStore,
+                                       uint16_t packetId,
+                                       const MQTTPublishInfo_t * pPublishInfo )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+    RecordHeader_t header = { 0 };
+    MQTTPublishInfo_t publishInfo = { 0 };
+    size_t offset = 0U;
+
+    if( ( pStore == NULL ) || ( pStore->pLog == NULL ) || ( pPublishInfo == NULL ) ||
+        ( packetId == 0U ) || ( pPublishInfo->pTopicName == NULL ) ||
+        ( pPublishInfo->topicNameLength == 0U ) ||
+        ( ( pPublishInfo->pPayload == NULL ) && ( pPublishInfo->payloadLength > 0U ) ) ||
+        ( pPublishInfo->payloadLength > UINT32_MAX ) )
+    {
+        status = PublishStoreBadParameter;
+    }
+    else if( PublishWindow_Find( pStore->pWindow, packetId ) != NULL )
+    {
+        status = PublishStoreBadParameter;
+    }
+    else
+    {
+        header.packetId = packetId;
+        header.topicLength = pPublishInfo->topicNameLength;
+        header.payloadLength = ( uint32_t ) pPublishInfo->payloadLength;
+        header.type = RECORD_TYPE_ADD;
+        header.qos = ( uint8_t ) pPublishInfo->qos;
+        header.flags = ( pPublishInfo->retain == true ) ? RECORD_FLAG_RETAIN : 0U;
+
+        status = appendRecord( pStore, &header, pPublishInfo, &offset );
+    }
+
+    if( status == PublishStoreSuccess )
+    {
+        publishInfo = *pPublishInfo;
+        pointToRecord( pStore, offset, &header, &publishInfo );
+
+        if( PublishWindow_Add( pStore->pWindow, packetId, &publishInfo ) != PublishWindowSuccess )
+        {
+            /* The record is erased rather than appended. */
+            ( void ) memset( &( pStore->pLog[ offset ] ), 0x00, sizeof( RecordHeader_t ) );
+            status = PublishStoreFull;
+        }
+        else
+        {
+            status = recordAppended( pStore, offset + recordSize( &header ) );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishStoreStatus_t PublishStore_Remove( PublishStore_t * pStore,
+                                          uint16_t packetId )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+    RecordHeader_t header = { 0 };
+    size_t offset = 0U;
+
+    if( ( pStore == NULL ) || ( pStore->pLog == NULL ) || ( packetId == 0U ) )
+    {
+        status = PublishStoreBadParameter;
+    }
+    else if( PublishWindow_Remove( pStore->pWindow, packetId ) != PublishWindowSuccess )
+    {
+        status = PublishStoreNotFound;
+    }
+    else
+    {
+        header.packetId = packetId;
+        header.type = RECORD_TYPE_REMOVE;
+
+        /* Without the record, the publish is sent again after a restart,
+         * unless a compaction erased it. */
+        status = appendRecord( pStore, &header, NULL, &offset );
+
+        if( status == PublishStoreSuccess )
+        {
+            status = recordAppended( pStore, offset + recordSize( &header ) );
+        }
+        else if( status == PublishStoreFull )
+        {
+            status = PublishStoreSuccess;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishStoreStatus_t PublishStore_Clear( PublishStore_t * pStore )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+
+    if( ( pStore == NULL ) || ( pStore->pLog == NULL ) )
+    {
+        status = PublishStoreBadParameter;
+    }
+    else
+    {
+        PublishWindow_Clear( pStore->pWindow );
+
+        ( void ) memset( pStore->pLog, 0x00, pStore->appendOffset );
+        status = syncRange( pStore, 0U, pStore->appendOffset );
+
+        pStore->appendOffset = 0U;
+        pStore->committedOffset = 0U;
+        pStore->pendingRecords = 0U;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishStoreStatus_t PublishStore_Commit( PublishStore_t * pStore,
+                                          bool force )
+{
+    PublishStoreStatus_t status = PublishStoreSuccess;
+    uint64_t now = 0U;
+
+    if( ( pStore == NULL ) || ( pStore->pLog == NULL ) )
+    {
+        status = PublishStoreBadParameter;
+    }
+    else if( pStore->pendingRecords > 0U )
+    {
+        now = currentTimeMs();
+
+        /* The pending records are flushed together. */
+        if( ( force == true ) ||
+            ( pStore->pendingRecords >= PUBLISH_STORE_COMMIT_RECORDS ) ||
+            ( ( now - pStore->firstPendingTimeMs ) >= PUBLISH_STORE_COMMIT_INTERVAL_MS ) )
+        {
+            status = syncRange( pStore, pStore->committedOffset, pStore->appendOffset );
+
+            if( status == PublishStoreSuccess )
+            {
+                pStore->committedOffset = pStore->appendOffset;
+                pStore->pendingRecords = 0U;
+            }
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void PublishStore_Close( PublishStore_t * pStore )
+{
+    if( ( pStore != NULL ) && ( pStore->pLog != NULL ) )
+    {
+        ( void ) PublishStore_Commit( pStore, true );
+        ( void ) munmap( pStore->pLog, pStore->logSize );
+        ( void ) close( pStore->fileDescriptor );
+
+        pStore->pLog = NULL;
+        pStore->fileDescriptor = -1;
+    }
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,184 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_store.h
+ * @brief A file keeping the outgoing QoS1 publishes across restarts.
+ *
+ * The store is a log of records in a file of fixed size, mapped in memory.
+ * Adding a publish appends a record with a copy of its topic and payload,
+ * and removing a publish appends a record of its removal. A publish window
+ * indexes the publishes of the store by packet identifier, with the topic
+ * and payload of each publish pointing into the log, so that
+ * #PublishWindow_Next resends them after the process restarts.
+ *
+ * The records are flushed to the disk together, by #PublishStore_Commit,
+ * once #PUBLISH_STORE_COMMIT_RECORDS records or #PUBLISH_STORE_COMMIT_INTERVAL_MS
+ * milliseconds are pending, rather than once per record. A publish added
+ * since the last commit can thus be lost by a power cut; a publish removed
+ * since then is sent again, so a publish is delivered at least once.
+ *
+ * Each record holds a sequence number and a checksum, and on opening the
+ * store every valid record of the file is read, so the records cut short by
+ * a crash are skipped. When the log is full, the records of the publishes
+ * still in the window are moved to its start, each one only over bytes that
+ * are not the last copy of a publish, so that a crash while moving them does
+ * not lose any.
+ *
+ * The store is not thread safe.
+ */
+
+#ifndef PUBLISH_STORE_H_
+#define PUBLISH_STORE_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Publish window include. */
+#include "publish_window.h"
+
+/**
+ * @brief Number of pending records from which they are committed.
+ */
+#ifndef PUBLISH_STORE_COMMIT_RECORDS
+    #define PUBLISH_STORE_COMMIT_RECORDS        ( 16U )
+#endif
+
+/**
+ * @brief Time after which pending records are committed, in milliseconds.
+ */
+#ifndef PUBLISH_STORE_COMMIT_INTERVAL_MS
+    #define PUBLISH_STORE_COMMIT_INTERVAL_MS    ( 100U )
+#endif
+
+/**
+ * @brief Return codes of the publish store.
+ */
+typedef enum PublishStoreStatus
+{
+    PublishStoreSuccess = 0,  /**< @brief The operation completed. */
+    PublishStoreBadParameter, /**< @brief A parameter is invalid, or the packet identifier is already in the store. */
+    PublishStoreFull,         /**< @brief The publish fits neither in the log nor in the window. */
+    PublishStoreNotFound,     /**< @brief No publish of the store has the packet identifier. */
+    PublishStoreIoError       /**< @brief The file could not be opened, mapped or flushed. */
+} PublishStoreStatus_t;
+
+/**
+ * @brief A store of outgoing publishes.
+ *
+ * The members are set by #PublishStore_Open and are not meant to be
+ * accessed by the application.
+ */
+typedef struct PublishStore
+{
+    int fileDescriptor;                /**< @brief The file of the log. */
+    uint8_t * pLog;                    /**< @brief The log, mapped in memory. */
+    size_t logSize;                    /**< @brief Size of the log. */
+    size_t appendOffset;               /**< @brief Offset at which the next record is appended. */
+    size_t committedOffset;            /**< @brief Offset up to which the log is flushed. */
+    size_t pendingRecords;             /**< @brief Number of records appended since the last commit. */
+    uint64_t firstPendingTimeMs;       /**< @brief Time the first pending record was appended. */
+    uint32_t nextSequence;             /**< @brief Sequence number of the next record. */
+    PublishWindow_t * pWindow;         /**< @brief The window indexing the publishes of the store. */
+} PublishStore_t;
+
+/**
+ * @brief Open a store, creating its file if needed, and add its publishes
+ * to a window, in the order they were first added.
+ *
+ * @param[out] pStore The store.
+ * @param[in] pPath Path of the file of the store.
+ * @param[in] logSize Size of the file; a larger existing file keeps its size.
+ * @param[in] pWindow An empty window. The publishes that do not fit in it
+ * are dropped.
+ *
+ * @return #PublishStoreSuccess, #PublishStoreBadParameter or
+ * #PublishStoreIoError.
+ */
+PublishStoreStatus_t PublishStore_Open( PublishStore_t * pStore,
+                                        const char * pPath,
+                                        size_t logSize,
+                                        PublishWindow_t * pWindow );
+
+/**
+ * @brief Add a copy of a publish to the store and its window.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId Packet identifier of the publish.
+ * @param[in] pPublishInfo The publish. Its topic and payload need not remain
+ * valid, as the window points to their copies in the log.
+ *
+ * @return #PublishStoreSuccess, #PublishStoreFull, #PublishStoreBadParameter
+ * or #PublishStoreIoError.
+ */
+PublishStoreStatus_t PublishStore_Add( PublishStore_t * pStore,
+                                       uint16_t packetId,
+                                       const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Remove a publish from the store and its window, such as when its
+ * PUBACK is received.
+ *
+ * @param[in] pStore The store.
+ * @param[in] packetId Packet identifier of the publish.
+ *
+ * @return #PublishStoreSuccess, #PublishStoreNotFound,
+ * #PublishStoreBadParameter or #PublishStoreIoError.
+ */
+PublishStoreStatus_t PublishStore_Remove( PublishStore_t * pStore,
+                                          uint16_t packetId );
+
+/**
+ * @brief Remove every publish from the store and its window.
+ *
+ * @param[in] pStore The store.
+ *
+ * @return #PublishStoreSuccess, #PublishStoreBadParameter or
+ * #PublishStoreIoError.
+ */
+PublishStoreStatus_t PublishStore_Clear( PublishStore_t * pStore );
+
+/**
+ * @brief Flush the pending records of the store to the disk.
+ *
+ * @param[in] pStore The store.
+ * @param[in] force true to flush them now; false to flush them only once
+ * #PUBLISH_STORE_COMMIT_RECORDS records or #PUBLISH_STORE_COMMIT_INTERVAL_MS
+ * milliseconds are pending.
+ *
+ * @return #PublishStoreSuccess, #PublishStoreBadParameter or
+ * #PublishStoreIoError.
+ */
+PublishStoreStatus_t PublishStore_Commit( PublishStore_t * pStore,
+                                          bool force );
+
+/**
+ * @brief Commit and close a store. Its window is left as it is, with
+ * dangling topics and payloads, and must be cleared before it is used again.
+ *
+ * @param[in] pStore The store.
+ */
+void PublishStore_Close( PublishStore_t * pStore );
+
+#endif /* ifndef PUBLISH_STORE_H_ */
@@ -0,0 +1,362 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_window.c
+ * @brief The outgoing QoS1 publishes awaiting their PUBACK.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <string.h>
+
+#include "publish_window.h"
+
+/**
+ * @brief An index of no entry, for empty buckets and the ends of the lists.
+ */
+#define INDEX_NONE    ( ( uint16_t ) UINT16_MAX )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the bucket from which the entry of a packet identifier is
+ * searched.
+ *
+ * The packet identifiers are given in sequence, so that the publishes in
+ * flight fall in consecutive buckets.
+ *
+ * @param[in] pWindow The window.
+ * @param[in] packetId The packet identifier.
+ *
+ * @return The index of the bucket.
+ */
+static size_t homeBucket( const PublishWindow_t * pWindow,
+                          uint16_t packetId );
+
+/**
+ * @brief Find the bucket of a packet identifier, with linear probing from its
+ * home bucket.
+ *
+ * @param[in] pWindow The window.
+ * @param[in] packetId The packet identifier.
+ * @param[out] pBucket The bucket holding the entry of the packet identifier,
+ * or else the empty bucket ending the probe.
+ *
+ * @return true if the packet identifier is in the window; false otherwise.
+ */
+static bool findBucket( const PublishWindow_t * pWindow,
+                        uint16_t packetId,
+                        size_t * pBucket );
+
+/**
+ * @brief Empty a bucket, moving back the entries of the probe that follows
+ * it so that they are still found.
+ *
+ * @param[in] pWindow The window.
+ * @param[in] bucket The bucket to empty.
+ */
+static void emptyBucket( PublishWindow_t * pWindow,
+                         size_t bucket );
+
+/*-----------------------------------------------------------*/
+
+static size_t homeBucket( const PublishWindow_t * pWindow,
+                          uint16_t packetId )
+{
+    return ( size_t ) packetId % pWindow->bucketCount;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool findBucket( const PublishWindow_t * pWindow,
+                        uint16_t packetId,
+                        size_t * pBucket )
+{
+    size_t bucket = homeBucket( pWindow, packetId );
+    bool found = false;
+
+    /* There are more buckets than entries, so a probe always ends on an
+     * empty bucket. */
+    while( ( found == false ) && ( pWindow->pBuckets[ bucket ] != INDEX_NONE ) )
+    {
+        if( pWindow->pEntries[ pWindow->pBuckets[ bucket ] ].packetId == packetId )
+        {
+            found = true;
+        }
+        else
+        {
+            bucket = ( bucket + 1U ) % pWindow->bucketCount;
+        }
+    }
+
+    *pBucket = bucket;
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+static void emptyBucket( PublishWindow_t * pWindow,
+                         size_t bucket )
+{
+    size_t hole = bucket;
+    size_t next = ( bucket + 1U ) % pWindow->bucketCount;
+    size_t home = 0U;
+    bool reachable = false;
+
+    while( pWindow->pBuckets[ next ] != INDEX_NONE )
+    {
+        home = homeBucket( pWindow, pWindow->pEntries[ pWindow->pBuckets[ next ] ].packetId );
+
+        /* The entry stays where it is if its probe, from its home bucket,
+         * reaches it without crossing the hole. */
+        if( hole < next )
+        {
+            reachable = ( home > hole ) && ( home <= next );
+        }
+        else
+        {
+            reachable = ( home > hole ) || ( home <= next );
+        }
+
+        if( reachable == false )
+        {
+            pWindow->pBuckets[ hole ] = pWindow->pBuckets[ next ];
+            hole = next;
+        }
+
+        next = ( next + 1U ) % pWindow->bucketCount;
+    }
+
+    pWindow->pBuckets[ hole ] = INDEX_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishWindowStatus_t PublishWindow_Init( PublishWindow_t * pWindow,
+                                          PublishWindowEntry_t * pEntries,
+                                          size_t entryCount,
+                                          uint16_t * pBuckets,
+                                          size_t bucketCount )
+{
+    PublishWindowStatus_t status = PublishWindowSuccess;
+
+    if( ( pWindow == NULL ) || ( pEntries == NULL ) || ( pBuckets == NULL ) ||
+        ( entryCount == 0U ) || ( entryCount > PUBLISH_WINDOW_MAX_ENTRIES ) ||
+        ( bucketCount <= entryCount ) )
+    {
+        status = PublishWindowBadParameter;
+    }
+    else
+    {
+        pWindow->pEntries = pEntries;
+        pWindow->entryCount = entryCount;
+        pWindow->pBuckets = pBuckets;
+        pWindow->bucketCount = bucketCount;
+
+        PublishWindow_Clear( pWindow );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void PublishWindow_Clear( PublishWindow_t * pWindow )
+{
+    size_t i = 0U;
+
+    if( pWindow != NULL )
+    {
+        /* Every entry is free, in order. */
+        for( i = 0U; i < pWindow->entryCount; i++ )
+        {
+            ( void ) memset( &( pWindow->pEntries[ i ] ), 0x00, sizeof( PublishWindowEntry_t ) );
+            pWindow->pEntries[ i ].previous = INDEX_NONE;
+            pWindow->pEntries[ i ].next = ( ( i + 1U ) < pWindow->entryCount ) ? ( uint16_t ) ( i + 1U ) : INDEX_NONE;
+        }
+
+        for( i = 0U; i < pWindow->bucketCount; i++ )
+        {
+            pWindow->pBuckets[ i ] = INDEX_NONE;
+        }
+
+        pWindow->freeHead = 0U;
+        pWindow->oldest = INDEX_NONE;
+        pWindow->newest = INDEX_NONE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+PublishWindowStatus_t PublishWindow_Add( PublishWindow_t * pWindow,
+                                         uint16_t packetId,
+                                         const MQTTPublishInfo_t * pPublishInfo )
+{
+    PublishWindowStatus_t status = PublishWindowSuccess;
+    size_t bucket = 0U;
+    uint16_t index = INDEX_NONE;
+
+    if( ( pWindow == NULL ) || ( pWindow->pEntries == NULL ) ||
+        ( pPublishInfo == NULL ) || ( packetId == 0U ) )
+    {
+        status = PublishWindowBadParameter;
+    }
+    else if( findBucket( pWindow, packetId, &bucket ) == true )
+    {
+        status = PublishWindowBadParameter;
+    }
+    else if( pWindow->freeHead == INDEX_NONE )
+    {
+        status = PublishWindowFull;
+    }
+    else
+    {
+        /* Take the first free entry, and append it to the publishes. */
+        index = pWindow->freeHead;
+        pWindow->freeHead = pWindow->pEntries[ index ].next;
+
+        pWindow->pEntries[ index ].publishInfo = *pPublishInfo;
+        pWindow->pEntries[ index ].packetId = packetId;
+        pWindow->pEntries[ index ].previous = pWindow->newest;
+        pWindow->pEntries[ index ].next = INDEX_NONE;
+
+        if( pWindow->newest == INDEX_NONE )
+        {
+            pWindow->oldest = index;
+        }
+        else
+        {
+            pWindow->pEntries[ pWindow->newest ].next = index;
+        }
+
+        pWindow->newest = index;
+        pWindow->pBuckets[ bucket ] = index;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishWindowStatus_t PublishWindow_Remove( PublishWindow_t * pWindow,
+                                            uint16_t packetId )
+{
+    PublishWindowStatus_t status = PublishWindowSuccess;
+    size_t bucket = 0U;
+    uint16_t index = INDEX_NONE;
+    PublishWindowEntry_t * pEntry = NULL;
+
+    if( ( pWindow == NULL ) || ( pWindow->pEntries == NULL ) || ( packetId == 0U ) )
+    {
+        status = PublishWindowBadParameter;
+    }
+    else if( findBucket( pWindow, packetId, &bucket ) == false )
+    {
+        status = PublishWindowNotFound;
+    }
+    else
+    {
+        index = pWindow->pBuckets[ bucket ];
+        pEntry = &( pWindow->pEntries[ index ] );
+        emptyBucket( pWindow, bucket );
+
+        /* Unlink the entry from the publishes. */
+        if( pEntry->previous == INDEX_NONE )
+        {
+            pWindow->oldest = pEntry->next;
+        }
+        else
+        {
+            pWindow->pEntries[ pEntry->previous ].next = pEntry->next;
+        }
+
+        if( pEntry->next == INDEX_NONE )
+        {
+            pWindow->newest = pEntry->previous;
+        }
+        else
+        {
+            pWindow->pEntries[ pEntry->next ].previous = pEntry->previous;
+        }
+
+        /* Push the entry to the free entries. */
+        ( void ) memset( pEntry, 0x00, sizeof( PublishWindowEntry_t ) );
+        pEntry->previous = INDEX_NONE;
+        pEntry->next = pWindow->freeHead;
+        pWindow->freeHead = index;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishWindowEntry_t * PublishWindow_Find( PublishWindow_t * pWindow,
+                                           uint16_t packetId )
+{
+    PublishWindowEntry_t * pEntry = NULL;
+    size_t bucket = 0U;
+
+    if( ( pWindow != NULL ) && ( pWindow->pEntries != NULL ) && ( packetId != 0U ) )
+    {
+        if( findBucket( pWindow, packetId, &bucket ) == true )
+        {
+            pEntry = &( pWindow->pEntries[ pWindow->pBuckets[ bucket ] ] );
+        }
+    }
+
+    return pEntry;
+}
+
+/*-----------------------------------------------------------*/
+
+PublishWindowEntry_t * PublishWindow_Next( PublishWindow_t * pWindow,
+                                           PublishWindowCursor_t * pCursor )
+{
+    PublishWindowEntry_t * pEntry = NULL;
+    uint16_t index = INDEX_NONE;
+
+    if( ( pWindow != NULL ) && ( pWindow->pEntries != NULL ) && ( pCursor != NULL ) )
+    {
+        /* The cursor holds the last entry returned. */
+        if( *pCursor == PUBLISH_WINDOW_CURSOR_INITIALIZER )
+        {
+            index = pWindow->oldest;
+        }
+        else
+        {
+            index = pWindow->pEntries[ *pCursor ].next;
+        }
+
+        if( index != INDEX_NONE )
+        {
+            pEntry = &( pWindow->pEntries[ index ] );
+            *pCursor = index;
+        }
+    }
+
+    return pEntry;
+}
+
+/*-----------------------------------------------------------*/
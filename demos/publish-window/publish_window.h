@@ -0,0 +1,189 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file publish_window.h
+ * @brief The outgoing QoS1 publishes awaiting their PUBACK.
+ *
+ * The window holds the publishes in caller supplied arrays. A publish is
+ * found by its packet identifier through a hash table, so adding and
+ * removing a publish take constant time whatever the size of the window,
+ * and free entries are kept in a list. The publishes are also linked in the
+ * order they were added, so that they are resent in that order when the
+ * broker resumes a session.
+ */
+
+#ifndef PUBLISH_WINDOW_H_
+#define PUBLISH_WINDOW_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* MQTT API header. */
+#include "core_mqtt.h"
+
+/**
+ * @brief Maximum number of publishes held by a window.
+ */
+#define PUBLISH_WINDOW_MAX_ENTRIES           ( 32767U )
+
+/**
+ * @brief Number of hash buckets suggested for a window of @p entryCount
+ * publishes.
+ *
+ * A window needs more buckets than entries; twice as many keep the hash
+ * lookups short.
+ */
+#define PUBLISH_WINDOW_BUCKET_COUNT( entryCount )    ( 2U * ( entryCount ) )
+
+/**
+ * @brief Initial value of a #PublishWindowCursor_t, to iterate from the
+ * oldest publish.
+ */
+#define PUBLISH_WINDOW_CURSOR_INITIALIZER    ( ( PublishWindowCursor_t ) UINT16_MAX )
+
+/**
+ * @brief Return codes of the publish window.
+ */
+typedef enum PublishWindowStatus
+{
+    PublishWindowSuccess = 0,  /**< @brief The operation completed. */
+    PublishWindowBadParameter, /**< @brief A parameter is invalid, or the packet identifier is already in the window. */
+    PublishWindowFull,         /**< @brief Every entry of the window holds a publish. */
+    PublishWindowNotFound      /**< @brief No publish of the window has the packet identifier. */
+} PublishWindowStatus_t;
+
+/**
+ * @brief An entry of a window.
+ */
+typedef struct PublishWindowEntry
+{
+    MQTTPublishInfo_t publishInfo; /**< @brief The publish; its topic and payload must remain valid until its PUBACK. */
+    uint16_t packetId;             /**< @brief Packet identifier of the publish; 0 if the entry is free. */
+    uint16_t previous;             /**< @brief The publish added before this one. */
+    uint16_t next;                 /**< @brief The publish added after this one, or the next free entry. */
+} PublishWindowEntry_t;
+
+/**
+ * @brief A window of outgoing publishes.
+ *
+ * The members are set by #PublishWindow_Init and are not meant to be
+ * changed by the application. A window initialized to zero has a NULL
+ * #PublishWindow_t.pEntries until then.
+ */
+typedef struct PublishWindow
+{
+    PublishWindowEntry_t * pEntries; /**< @brief The entries. */
+    size_t entryCount;               /**< @brief Number of entries of #PublishWindow_t.pEntries. */
+    uint16_t * pBuckets;             /**< @brief Hash table of the entries by packet identifier. */
+    size_t bucketCount;              /**< @brief Number of buckets of #PublishWindow_t.pBuckets. */
+    uint16_t freeHead;               /**< @brief The first free entry. */
+    uint16_t oldest;                 /**< @brief The publish added first. */
+    uint16_t newest;                 /**< @brief The publish added last. */
+} PublishWindow_t;
+
+/**
+ * @brief Position of an iteration over the publishes of a window.
+ */
+typedef uint16_t PublishWindowCursor_t;
+
+/**
+ * @brief Set up an empty window on the entries and buckets given.
+ *
+ * @param[out] pWindow The window.
+ * @param[in] pEntries The entries of the window.
+ * @param[in] entryCount Number of entries of @p pEntries, at most
+ * #PUBLISH_WINDOW_MAX_ENTRIES.
+ * @param[in] pBuckets The buckets of the hash table of the window.
+ * @param[in] bucketCount Number of buckets of @p pBuckets, more than
+ * @p entryCount; see #PUBLISH_WINDOW_BUCKET_COUNT.
+ *
+ * @return #PublishWindowSuccess or #PublishWindowBadParameter.
+ */
+PublishWindowStatus_t PublishWindow_Init( PublishWindow_t * pWindow,
+                                          PublishWindowEntry_t * pEntries,
+                                          size_t entryCount,
+                                          uint16_t * pBuckets,
+                                          size_t bucketCount );
+
+/**
+ * @brief Remove every publish of a window.
+ *
+ * @param[in] pWindow The window.
+ */
+void PublishWindow_Clear( PublishWindow_t * pWindow );
+
+/**
+ * @brief Add a publish to a window, after the publishes already in it.
+ *
+ * @param[in] pWindow The window.
+ * @param[in] packetId Packet identifier of the publish.
+ * @param[in] pPublishInfo The publish, which is copied.
+ *
+ * @return #PublishWindowSuccess, #PublishWindowFull or
+ * #PublishWindowBadParameter.
+ */
+PublishWindowStatus_t PublishWindow_Add( PublishWindow_t * pWindow,
+                                         uint16_t packetId,
+                                         const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Remove the publish of a packet identifier from a window, such as
+ * when its PUBACK is received.
+ *
+ * @param[in] pWindow The window.
+ * @param[in] packetId Packet identifier of the publish.
+ *
+ * @return #PublishWindowSuccess, #PublishWindowNotFound or
+ * #PublishWindowBadParameter.
+ */
+PublishWindowStatus_t PublishWindow_Remove( PublishWindow_t * pWindow,
+                                            uint16_t packetId );
+
+/**
+ * @brief Find the publish of a packet identifier in a window.
+ *
+ * @param[in] pWindow The window.
+ * @param[in] packetId Packet identifier of the publish.
+ *
+ * @return The entry of the publish; NULL if it is not in the window.
+ */
+PublishWindowEntry_t * PublishWindow_Find( PublishWindow_t * pWindow,
+                                           uint16_t packetId );
+
+/**
+ * @brief Get the next publish of a window, in the order they were added.
+ *
+ * Publishes cannot be added or removed while iterating.
+ *
+ * @param[in] pWindow The window.
+ * @param[in,out] pCursor The position of the iteration, set to
+ * #PUBLISH_WINDOW_CURSOR_INITIALIZER to start from the oldest publish.
+ *
+ * @return The entry of the next publish; NULL once every publish was
+ * returned.
+ */
+PublishWindowEntry_t * PublishWindow_Next( PublishWindow_t * pWindow,
+                                           PublishWindowCursor_t * pCursor );
+
+#endif /* ifndef PUBLISH_WINDOW_H_ */
@@ -0,0 +1,16 @@
+# This file is to add source files and include directories
+# into variables so that it can be reused from different demos
+# in their Cmake based build system by including this file.
+#
+# The service host runs its services over an MQTT connection, so demos must
+# also include mqttConnectionFilePaths.cmake and build its sources, and build
+# the subscription manager of mqtt_demo_subscription_manager, which dispatches
+# the messages of the services.
+
+# Service host source files.
+set( SERVICE_HOST_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/service_host.c )
+
+# Service host include directories.
+set( SERVICE_HOST_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
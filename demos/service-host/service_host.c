@@ -0,0 +1,1033 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file service_host.c
+ * @brief A host running several services over a single MQTT connection.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Service host API header. */
+#include "service_host.h"
+
+/* Subscription manager, which matches the incoming messages to the
+ * subscriptions of the services. */
+#include "mqtt_subscription_manager.h"
+
+/**
+ * @brief Index returned when no entry of a table matches.
+ */
+#define NO_ENTRY    ( ( uint32_t ) UINT32_MAX )
+
+/**
+ * @brief An incoming message held for the dispatch thread of a service.
+ */
+typedef struct ServiceHostMessage
+{
+    MQTTPublishInfo_t publishInfo;                      /**< @brief The message, with its topic name and payload in @p buffer. */
+    ServiceHostMessageCallback_t callback;              /**< @brief The callback of the subscription matched. */
+    void * pUserContext;                                /**< @brief The context of the subscription matched. */
+    uint8_t buffer[ SERVICE_HOST_MESSAGE_SIZE ];        /**< @brief The topic name followed by the payload. */
+} ServiceHostMessage_t;
+
+/**
+ * @brief A service, with its dispatch thread and its queue of messages.
+ */
+struct ServiceHostService
+{
+    bool inUse;                                         /**< @brief true if the service is registered. */
+    const char * pName;                                 /**< @brief The name of the service. */
+    uint32_t maxInflight;                               /**< @brief The quota of publishes awaiting their PUBACK. */
+    ServiceHostServiceMetrics_t metrics;                /**< @brief The counters; the ones of the messages are protected by @p mutex, the others by the host. */
+    pthread_t thread;                                   /**< @brief The dispatch thread. */
+    pthread_mutex_t mutex;                              /**< @brief Protects the queue and @p running. */
+    pthread_cond_t condition;                           /**< @brief Signaled when a message is queued or the thread stops. */
+    bool running;                                       /**< @brief true until the dispatch thread is stopped. */
+    ServiceHostMessage_t queue[ SERVICE_HOST_QUEUE_LENGTH ]; /**< @brief The messages held. */
+    uint32_t head;                                      /**< @brief The next message to deliver. */
+    uint32_t count;                                     /**< @brief The number of messages held. */
+};
+
+/**
+ * @brief A subscription of a service, the context of its callback in the
+ * subscription manager.
+ */
+typedef struct ServiceHostSubscription
+{
+    ServiceHostService_t * pService;       /**< @brief The service; NULL if the entry is free. */
+    const char * pTopicFilter;             /**< @brief The topic filter. */
+    uint16_t topicFilterLength;            /**< @brief Length of @p pTopicFilter. */
+    ServiceHostMessageCallback_t callback; /**< @brief The callback of the messages. */
+    void * pUserContext;                   /**< @brief The context passed to @p callback. */
+    bool brokerSubscribed;                 /**< @brief true once the broker has the topic filter in the session. */
+} ServiceHostSubscription_t;
+
+/**
+ * @brief A publish of a service awaiting its PUBACK.
+ */
+typedef struct ServiceHostInflight
+{
+    uint16_t packetId;              /**< @brief The packet identifier of the publish; 0 if the entry is free. */
+    ServiceHostService_t * pService; /**< @brief The service of the publish. */
+} ServiceHostInflight_t;
+
+/**
+ * @brief The connection shared by the services; NULL until #ServiceHost_Init.
+ */
+static MqttConnection_t * pHostConnection = NULL;
+
+/**
+ * @brief The services.
+ */
+static ServiceHostService_t services[ SERVICE_HOST_MAX_SERVICES ];
+
+/**
+ * @brief The subscriptions of the services.
+ */
+static ServiceHostSubscription_t subscriptions[ SERVICE_HOST_MAX_SUBSCRIPTIONS ];
+
+/**
+ * @brief The publishes of the services awaiting their PUBACK.
+ */
+static ServiceHostInflight_t inflightPublishes[ SERVICE_HOST_MAX_INFLIGHT ];
+
+/**
+ * @brief Protects the connection and the tables of the host. It is held
+ * while the connection calls the event callback.
+ */
+static pthread_mutex_t hostMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Convert a status of the connection to a status of the host.
+ *
+ * @param[in] connectionStatus The status of the connection.
+ *
+ * @return The status of the host.
+ */
+static ServiceHostStatus_t convertStatus( MqttConnectionStatus_t connectionStatus );
+
+/**
+ * @brief Check whether a service is registered.
+ *
+ * @param[in] pService The service.
+ *
+ * @return true if @p pService is a registered service; false otherwise.
+ */
+static bool isRegistered( const ServiceHostService_t * pService );
+
+/**
+ * @brief Find a subscription.
+ *
+ * @param[in] pService The service.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ * @param[in] callback The callback of the subscription.
+ * @param[in] pUserContext The context of the callback.
+ *
+ * @return The index of the subscription; NO_ENTRY if there is none.
+ */
+static uint32_t findSubscription( const ServiceHostService_t * pService,
+                                  const char * pTopicFilter,
+                                  uint16_t topicFilterLength,
+                                  ServiceHostMessageCallback_t callback,
+                                  const void * pUserContext );
+
+/**
+ * @brief Check whether the broker has a topic filter in the session for
+ * another subscription.
+ *
+ * @param[in] exclude The index of the subscription not to consider.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ *
+ * @return true if another subscription has the topic filter subscribed to
+ * by the broker; false otherwise.
+ */
+static bool isFilterSubscribed( uint32_t exclude,
+                                const char * pTopicFilter,
+                                uint16_t topicFilterLength );
+
+/**
+ * @brief Subscribe to the topic filters the broker does not have in the
+ * session, once for each topic filter.
+ *
+ * @return #ServiceHostSuccess, or #ServiceHostFailed if a SUBSCRIBE failed.
+ */
+static ServiceHostStatus_t subscribePending( void );
+
+/**
+ * @brief Record a publish of a service awaiting its PUBACK.
+ *
+ * @param[in] pService The service.
+ * @param[in] packetId The packet identifier of the publish.
+ */
+static void addInflight( ServiceHostService_t * pService,
+                         uint16_t packetId );
+
+/**
+ * @brief Release the quota taken by a publish whose PUBACK is received.
+ *
+ * @param[in] packetId The packet identifier of the PUBACK.
+ */
+static void removeInflight( uint16_t packetId );
+
+/**
+ * @brief Forget the publishes awaiting their PUBACK, which the connection
+ * dropped with its clean session.
+ */
+static void clearInflight( void );
+
+/**
+ * @brief The callback of the subscriptions in the subscription manager,
+ * queueing a copy of the message to the service of the subscription.
+ *
+ * @param[in] pContext The MQTT context of the connection.
+ * @param[in] pPublishInfo The incoming message.
+ * @param[in] pUserContext The subscription.
+ */
+static void queueMessage( MQTTContext_t * pContext,
+                          MQTTPublishInfo_t * pPublishInfo,
+                          void * pUserContext );
+
+/**
+ * @brief The event callback of the connection, dispatching the incoming
+ * messages and releasing the quotas of the PUBACKs.
+ *
+ * @param[in] pMqttContext The MQTT context of the connection.
+ * @param[in] pPacketInfo The incoming packet.
+ * @param[in] pDeserializedInfo The deserialized packet.
+ */
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief The dispatch thread of a service, delivering its messages in the
+ * order they were queued.
+ *
+ * @param[in] pArgument The service.
+ *
+ * @return NULL.
+ */
+static void * dispatchThread( void * pArgument );
+
+/*-----------------------------------------------------------*/
+
+static ServiceHostStatus_t convertStatus( MqttConnectionStatus_t connectionStatus )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostFailed;
+
+    switch( connectionStatus )
+    {
+        case MqttConnectionSuccess:
+            returnStatus = ServiceHostSuccess;
+            break;
+
+        case MqttConnectionBadParameter:
+            returnStatus = ServiceHostBadParameter;
+            break;
+
+        case MqttConnectionNoMemory:
+            returnStatus = ServiceHostNoMemory;
+            break;
+
+        default:
+            returnStatus = ServiceHostFailed;
+            break;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isRegistered( const ServiceHostService_t * pService )
+{
+    bool registered = false;
+    uint32_t index = 0U;
+
+    for( index = 0U; index < SERVICE_HOST_MAX_SERVICES; index++ )
+    {
+        if( ( pService == &services[ index ] ) && ( services[ index ].inUse == true ) )
+        {
+            registered = true;
+        }
+    }
+
+    return registered;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t findSubscription( const ServiceHostService_t * pService,
+                                  const char * pTopicFilter,
+                                  uint16_t topicFilterLength,
+                                  ServiceHostMessageCallback_t callback,
+                                  const void * pUserContext )
+{
+    uint32_t found = NO_ENTRY;
+    uint32_t index = 0U;
+    const ServiceHostSubscription_t * pSubscription = NULL;
+
+    for( index = 0U; ( index < SERVICE_HOST_MAX_SUBSCRIPTIONS ) && ( found == NO_ENTRY ); index++ )
+    {
+        pSubscription = &subscriptions[ index ];
+
+        if( ( pSubscription->pService != NULL ) &&
+            ( pSubscription->pService == pService ) &&
+            ( pSubscription->callback == callback ) &&
+            ( pSubscription->pUserContext == pUserContext ) &&
+            ( pSubscription->topicFilterLength == topicFilterLength ) &&
+            ( memcmp( pSubscription->pTopicFilter, pTopicFilter, topicFilterLength ) == 0 ) )
+        {
+            found = index;
+        }
+    }
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isFilterSubscribed( uint32_t exclude,
+                                const char * pTopicFilter,
+                                uint16_t topicFilterLength )
+{
+    bool subscribed = false;
+    uint32_t index = 0U;
+    const ServiceHostSubscription_t * pSubscription = NULL;
+
+    for( index = 0U; ( index < SERVICE_HOST_MAX_SUBSCRIPTIONS ) && ( subscribed == false ); index++ )
+    {
+        pSubscription = &subscriptions[ index ];
+
+        if( ( index != exclude ) &&
+            ( pSubscription->pService != NULL ) &&
+            ( pSubscription->brokerSubscribed == true ) &&
+            ( pSubscription->topicFilterLength == topicFilterLength ) &&
+            ( memcmp( pSubscription->pTopicFilter, pTopicFilter, topicFilterLength ) == 0 ) )
+        {
+            subscribed = true;
+        }
+    }
+
+    return subscribed;
+}
+
+/*-----------------------------------------------------------*/
+
+static ServiceHostStatus_t subscribePending( void )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    uint32_t index = 0U;
+    ServiceHostSubscription_t * pSubscription = NULL;
+
+    for( index = 0U; index < SERVICE_HOST_MAX_SUBSCRIPTIONS; index++ )
+    {
+        pSubscription = &subscriptions[ index ];
+
+        if( ( pSubscription->pService != NULL ) && ( pSubscription->brokerSubscribed == false ) )
+        {
+            if( isFilterSubscribed( index, pSubscription->pTopicFilter, pSubscription->topicFilterLength ) == true )
+            {
+                pSubscription->brokerSubscribed = true;
+            }
+            else if( MqttConnection_Subscribe( pHostConnection,
+                                               pSubscription->pTopicFilter,
+                                               pSubscription->topicFilterLength ) == MqttConnectionSuccess )
+            {
+                pSubscription->brokerSubscribed = true;
+            }
+            else
+            {
+                LogError( ( "Failed to subscribe service %s to %.*s.",
+                            pSubscription->pService->pName,
+                            pSubscription->topicFilterLength,
+                            pSubscription->pTopicFilter ) );
+                returnStatus = ServiceHostFailed;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void addInflight( ServiceHostService_t * pService,
+                         uint16_t packetId )
+{
+    uint32_t index = 0U;
+    bool added = false;
+
+    for( index = 0U; ( index < SERVICE_HOST_MAX_INFLIGHT ) && ( added == false ); index++ )
+    {
+        if( inflightPublishes[ index ].packetId == 0U )
+        {
+            inflightPublishes[ index ].packetId = packetId;
+            inflightPublishes[ index ].pService = pService;
+            pService->metrics.inflight++;
+            added = true;
+        }
+    }
+
+    if( added == false )
+    {
+        /* The publish is sent, but its PUBACK is not waited for; the quota of
+         * the service is not enforced for it. */
+        LogWarn( ( "No room to track the publish of service %s with packet ID %u.",
+                   pService->pName,
+                   ( unsigned int ) packetId ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeInflight( uint16_t packetId )
+{
+    uint32_t index = 0U;
+    bool removed = false;
+    ServiceHostService_t * pService = NULL;
+
+    for( index = 0U; ( index < SERVICE_HOST_MAX_INFLIGHT ) && ( removed == false ); index++ )
+    {
+        if( inflightPublishes[ index ].packetId == packetId )
+        {
+            pService = inflightPublishes[ index ].pService;
+            pService->metrics.inflight--;
+            pService->metrics.pubacksReceived++;
+            inflightPublishes[ index ].packetId = 0U;
+            inflightPublishes[ index ].pService = NULL;
+            removed = true;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void clearInflight( void )
+{
+    uint32_t index = 0U;
+
+    for( index = 0U; index < SERVICE_HOST_MAX_INFLIGHT; index++ )
+    {
+        inflightPublishes[ index ].packetId = 0U;
+        inflightPublishes[ index ].pService = NULL;
+    }
+
+    for( index = 0U; index < SERVICE_HOST_MAX_SERVICES; index++ )
+    {
+        services[ index ].metrics.inflight = 0U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void queueMessage( MQTTContext_t * pContext,
+                          MQTTPublishInfo_t * pPublishInfo,
+                          void * pUserContext )
+{
+    const ServiceHostSubscription_t * pSubscription = ( const ServiceHostSubscription_t * ) pUserContext;
+    ServiceHostService_t * pService = pSubscription->pService;
+    ServiceHostMessage_t * pMessage = NULL;
+    size_t topicLength = pPublishInfo->topicNameLength;
+
+    ( void ) pContext;
+
+    ( void ) pthread_mutex_lock( &( pService->mutex ) );
+
+    /* A payload streamed in chunks is not held by the connection, so there
+     * is nothing to copy. */
+    if( ( pService->count == SERVICE_HOST_QUEUE_LENGTH ) ||
+        ( ( topicLength + pPublishInfo->payloadLength ) > SERVICE_HOST_MESSAGE_SIZE ) ||
+        ( ( pPublishInfo->pPayload == NULL ) && ( pPublishInfo->payloadLength > 0U ) ) )
+    {
+        pService->metrics.messagesDropped++;
+
+        LogWarn( ( "Dropped a message of service %s: TopicName=%.*s, QueueDepth=%u",
+                   pService->pName,
+                   pPublishInfo->topicNameLength,
+                   pPublishInfo->pTopicName,
+                   ( unsigned int ) pService->count ) );
+    }
+    else
+    {
+        pMessage = &( pService->queue[ ( pService->head + pService->count ) % SERVICE_HOST_QUEUE_LENGTH ] );
+
+        ( void ) memcpy( pMessage->buffer, pPublishInfo->pTopicName, topicLength );
+
+        if( pPublishInfo->payloadLength > 0U )
+        {
+            ( void ) memcpy( &( pMessage->buffer[ topicLength ] ),
+                             pPublishInfo->pPayload,
+                             pPublishInfo->payloadLength );
+        }
+
+        pMessage->publishInfo = *pPublishInfo;
+        pMessage->publishInfo.pTopicName = ( const char * ) pMessage->buffer;
+        pMessage->publishInfo.pPayload = &( pMessage->buffer[ topicLength ] );
+        pMessage->callback = pSubscription->callback;
+        pMessage->pUserContext = pSubscription->pUserContext;
+        pService->count++;
+
+        ( void ) pthread_cond_signal( &( pService->condition ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &( pService->mutex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pMqttContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    assert( pMqttContext != NULL );
+    assert( pPacketInfo != NULL );
+    assert( pDeserializedInfo != NULL );
+
+    if( ( pPacketInfo->type & 0xF0U ) == MQTT_PACKET_TYPE_PUBLISH )
+    {
+        assert( pDeserializedInfo->pPublishInfo != NULL );
+        SubscriptionManager_DispatchHandler( pMqttContext, pDeserializedInfo->pPublishInfo );
+    }
+    else if( pPacketInfo->type == MQTT_PACKET_TYPE_PUBACK )
+    {
+        removeInflight( pDeserializedInfo->packetIdentifier );
+    }
+    else
+    {
+        /* The connection handles the other packets. */
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * dispatchThread( void * pArgument )
+{
+    ServiceHostService_t * pService = ( ServiceHostService_t * ) pArgument;
+    ServiceHostMessage_t * pMessage = NULL;
+    bool running = true;
+
+    ( void ) pthread_mutex_lock( &( pService->mutex ) );
+
+    while( running == true )
+    {
+        while( ( pService->count == 0U ) && ( pService->running == true ) )
+        {
+            ( void ) pthread_cond_wait( &( pService->condition ), &( pService->mutex ) );
+        }
+
+        if( pService->count == 0U )
+        {
+            running = false;
+        }
+        else
+        {
+            /* The message stays in the queue until it is delivered, so that
+             * its entry is not reused meanwhile. */
+            pMessage = &( pService->queue[ pService->head ] );
+
+            ( void ) pthread_mutex_unlock( &( pService->mutex ) );
+
+            pMessage->callback( pService, &( pMessage->publishInfo ), pMessage->pUserContext );
+
+            ( void ) pthread_mutex_lock( &( pService->mutex ) );
+
+            pService->head = ( pService->head + 1U ) % SERVICE_HOST_QUEUE_LENGTH;
+            pService->count--;
+            pService->metrics.messagesDelivered++;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &( pService->mutex ) );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_Init( const MqttConnectionConfig_t * pConfig,
+                                      const MqttConnectionBuffers_t * pBuffers )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    MqttConnectionConfig_t config;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( ( pConfig == NULL ) || ( pBuffers == NULL ) || ( pHostConnection != NULL ) )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        ( void ) memset( services, 0x00, sizeof( services ) );
+        ( void ) memset( subscriptions, 0x00, sizeof( subscriptions ) );
+        ( void ) memset( inflightPublishes, 0x00, sizeof( inflightPublishes ) );
+
+        config = *pConfig;
+        config.eventCallback = eventCallback;
+        config.pUserContext = NULL;
+
+        if( MqttConnection_Create( &pHostConnection, &config, pBuffers ) != MqttConnectionSuccess )
+        {
+            LogError( ( "Failed to create the connection of the service host." ) );
+            pHostConnection = NULL;
+            returnStatus = ServiceHostFailed;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_RegisterService( const char * pName,
+                                                 uint32_t maxInflight,
+                                                 ServiceHostService_t ** ppService )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    ServiceHostService_t * pService = NULL;
+    uint32_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( ( pName == NULL ) || ( maxInflight == 0U ) || ( ppService == NULL ) || ( pHostConnection == NULL ) )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        for( index = 0U; ( index < SERVICE_HOST_MAX_SERVICES ) && ( pService == NULL ); index++ )
+        {
+            if( services[ index ].inUse == false )
+            {
+                pService = &services[ index ];
+            }
+        }
+
+        if( pService == NULL )
+        {
+            LogError( ( "No room to register service %s.", pName ) );
+            returnStatus = ServiceHostNoMemory;
+        }
+        else
+        {
+            ( void ) memset( &( pService->metrics ), 0x00, sizeof( pService->metrics ) );
+            pService->pName = pName;
+            pService->maxInflight = maxInflight;
+            pService->head = 0U;
+            pService->count = 0U;
+            pService->running = true;
+            ( void ) pthread_mutex_init( &( pService->mutex ), NULL );
+            ( void ) pthread_cond_init( &( pService->condition ), NULL );
+
+            if( pthread_create( &( pService->thread ), NULL, dispatchThread, pService ) != 0 )
+            {
+                LogError( ( "Failed to start the dispatch thread of service %s.", pName ) );
+                ( void ) pthread_cond_destroy( &( pService->condition ) );
+                ( void ) pthread_mutex_destroy( &( pService->mutex ) );
+                returnStatus = ServiceHostFailed;
+            }
+            else
+            {
+                pService->inUse = true;
+                *ppService = pService;
+
+                LogInfo( ( "Registered service %s with a quota of %u publishes.",
+                           pName,
+                           ( unsigned int ) maxInflight ) );
+            }
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_Connect( void )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    MqttConnectionMetrics_t before;
+    MqttConnectionMetrics_t after;
+    uint32_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( pHostConnection == NULL )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        ( void ) MqttConnection_GetMetrics( pHostConnection, &before );
+        returnStatus = convertStatus( MqttConnection_Connect( pHostConnection ) );
+    }
+
+    if( returnStatus == ServiceHostSuccess )
+    {
+        ( void ) MqttConnection_GetMetrics( pHostConnection, &after );
+
+        /* A clean session drops the publishes of the window and the
+         * subscriptions. */
+        if( after.sessionsStarted != before.sessionsStarted )
+        {
+            clearInflight();
+
+            for( index = 0U; index < SERVICE_HOST_MAX_SUBSCRIPTIONS; index++ )
+            {
+                subscriptions[ index ].brokerSubscribed = false;
+            }
+        }
+
+        returnStatus = subscribePending();
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_Disconnect( void )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( pHostConnection == NULL )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        returnStatus = convertStatus( MqttConnection_Disconnect( pHostConnection ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_Subscribe( ServiceHostService_t * pService,
+                                           const char * pTopicFilter,
+                                           uint16_t topicFilterLength,
+                                           ServiceHostMessageCallback_t callback,
+                                           void * pUserContext )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    ServiceHostSubscription_t * pSubscription = NULL;
+    uint32_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( ( pHostConnection == NULL ) || ( isRegistered( pService ) == false ) ||
+        ( pTopicFilter == NULL ) || ( topicFilterLength == 0U ) || ( callback == NULL ) ||
+        ( findSubscription( pService, pTopicFilter, topicFilterLength, callback, pUserContext ) != NO_ENTRY ) )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        for( index = 0U; ( index < SERVICE_HOST_MAX_SUBSCRIPTIONS ) && ( pSubscription == NULL ); index++ )
+        {
+            if( subscriptions[ index ].pService == NULL )
+            {
+                pSubscription = &subscriptions[ index ];
+            }
+        }
+
+        if( pSubscription == NULL )
+        {
+            returnStatus = ServiceHostNoMemory;
+        }
+        else
+        {
+            index = ( uint32_t ) ( pSubscription - subscriptions );
+
+            /* Register the callback before subscribing, as the broker may
+             * send retained messages before the SUBACK. */
+            if( SubscriptionManager_RegisterContextCallback( pTopicFilter,
+                                                             topicFilterLength,
+                                                             queueMessage,
+                                                             pSubscription ) != SUBSCRIPTION_MANAGER_SUCCESS )
+            {
+                returnStatus = ServiceHostNoMemory;
+            }
+            else
+            {
+                pSubscription->pService = pService;
+                pSubscription->pTopicFilter = pTopicFilter;
+                pSubscription->topicFilterLength = topicFilterLength;
+                pSubscription->callback = callback;
+                pSubscription->pUserContext = pUserContext;
+                pSubscription->brokerSubscribed = isFilterSubscribed( index, pTopicFilter, topicFilterLength );
+            }
+        }
+    }
+
+    /* The topic filters subscribed to while the broker is disconnected are
+     * subscribed to by #ServiceHost_Connect. */
+    if( ( returnStatus == ServiceHostSuccess ) &&
+        ( pSubscription->brokerSubscribed == false ) &&
+        ( MqttConnection_IsConnected( pHostConnection ) == true ) )
+    {
+        if( MqttConnection_Subscribe( pHostConnection, pTopicFilter, topicFilterLength ) == MqttConnectionSuccess )
+        {
+            pSubscription->brokerSubscribed = true;
+        }
+        else
+        {
+            SubscriptionManager_RemoveContextCallback( pTopicFilter, topicFilterLength, queueMessage, pSubscription );
+            ( void ) memset( pSubscription, 0x00, sizeof( ServiceHostSubscription_t ) );
+            returnStatus = ServiceHostFailed;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_Unsubscribe( ServiceHostService_t * pService,
+                                             const char * pTopicFilter,
+                                             uint16_t topicFilterLength,
+                                             ServiceHostMessageCallback_t callback,
+                                             void * pUserContext )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    ServiceHostSubscription_t * pSubscription = NULL;
+    uint32_t index = NO_ENTRY;
+    bool brokerSubscribed = false;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( ( pHostConnection != NULL ) && ( pService != NULL ) && ( pTopicFilter != NULL ) )
+    {
+        index = findSubscription( pService, pTopicFilter, topicFilterLength, callback, pUserContext );
+    }
+
+    if( index == NO_ENTRY )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        pSubscription = &subscriptions[ index ];
+        brokerSubscribed = pSubscription->brokerSubscribed;
+
+        SubscriptionManager_RemoveContextCallback( pTopicFilter, topicFilterLength, queueMessage, pSubscription );
+        ( void ) memset( pSubscription, 0x00, sizeof( ServiceHostSubscription_t ) );
+
+        /* A topic filter left in a session the broker resumes only brings
+         * messages that nothing matches. */
+        if( ( brokerSubscribed == true ) &&
+            ( isFilterSubscribed( NO_ENTRY, pTopicFilter, topicFilterLength ) == false ) &&
+            ( MqttConnection_IsConnected( pHostConnection ) == true ) )
+        {
+            returnStatus = convertStatus( MqttConnection_Unsubscribe( pHostConnection, pTopicFilter, topicFilterLength ) );
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_Publish( ServiceHostService_t * pService,
+                                         const MQTTPublishInfo_t * pPublishInfo )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    uint16_t packetId = 0U;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( ( pHostConnection == NULL ) || ( isRegistered( pService ) == false ) || ( pPublishInfo == NULL ) )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else if( pService->metrics.inflight >= pService->maxInflight )
+    {
+        pService->metrics.publishesRejected++;
+
+        LogDebug( ( "Service %s has its quota of %u publishes awaiting their PUBACK.",
+                    pService->pName,
+                    ( unsigned int ) pService->maxInflight ) );
+        returnStatus = ServiceHostQuotaExceeded;
+    }
+    else
+    {
+        returnStatus = convertStatus( MqttConnection_PublishWithId( pHostConnection, pPublishInfo, &packetId ) );
+
+        if( returnStatus == ServiceHostSuccess )
+        {
+            pService->metrics.publishesSent++;
+
+            if( packetId != 0U )
+            {
+                addInflight( pService, packetId );
+            }
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_ProcessLoop( uint32_t timeoutMs )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( pHostConnection == NULL )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        returnStatus = convertStatus( MqttConnection_ProcessLoop( pHostConnection, timeoutMs ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ServiceHostStatus_t ServiceHost_GetServiceMetrics( const ServiceHostService_t * pService,
+                                                   ServiceHostServiceMetrics_t * pMetrics )
+{
+    ServiceHostStatus_t returnStatus = ServiceHostSuccess;
+    ServiceHostService_t * pRegistered = ( ServiceHostService_t * ) pService;
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    if( ( isRegistered( pService ) == false ) || ( pMetrics == NULL ) )
+    {
+        returnStatus = ServiceHostBadParameter;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &( pRegistered->mutex ) );
+        *pMetrics = pRegistered->metrics;
+        ( void ) pthread_mutex_unlock( &( pRegistered->mutex ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void ServiceHost_Deinit( void )
+{
+    uint32_t index = 0U;
+    ServiceHostSubscription_t * pSubscription = NULL;
+    ServiceHostService_t * pService = NULL;
+
+    /* Stop the messages first, so that the dispatch threads can end. */
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    for( index = 0U; index < SERVICE_HOST_MAX_SUBSCRIPTIONS; index++ )
+    {
+        pSubscription = &subscriptions[ index ];
+
+        if( pSubscription->pService != NULL )
+        {
+            SubscriptionManager_RemoveContextCallback( pSubscription->pTopicFilter,
+                                                       pSubscription->topicFilterLength,
+                                                       queueMessage,
+                                                       pSubscription );
+            ( void ) memset( pSubscription, 0x00, sizeof( ServiceHostSubscription_t ) );
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+
+    /* The callbacks of the services may still call the host while their
+     * messages are delivered, so it is not held while joining them. */
+    for( index = 0U; index < SERVICE_HOST_MAX_SERVICES; index++ )
+    {
+        pService = &services[ index ];
+
+        if( pService->inUse == true )
+        {
+            ( void ) pthread_mutex_lock( &( pService->mutex ) );
+            pService->running = false;
+            ( void ) pthread_cond_signal( &( pService->condition ) );
+            ( void ) pthread_mutex_unlock( &( pService->mutex ) );
+
+            ( void ) pthread_join( pService->thread, NULL );
+        }
+    }
+
+    ( void ) pthread_mutex_lock( &hostMutex );
+
+    for( index = 0U; index < SERVICE_HOST_MAX_SERVICES; index++ )
+    {
+        pService = &services[ index ];
+
+        if( pService->inUse == true )
+        {
+            ( void ) pthread_cond_destroy( &( pService->condition ) );
+            ( void ) pthread_mutex_destroy( &( pService->mutex ) );
+            pService->inUse = false;
+        }
+    }
+
+    if( pHostConnection != NULL )
+    {
+        MqttConnection_Destroy( pHostConnection );
+        pHostConnection = NULL;
+    }
+
+    clearInflight();
+
+    ( void ) pthread_mutex_unlock( &hostMutex );
+}
+
+/*-----------------------------------------------------------*/
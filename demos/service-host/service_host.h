@@ -0,0 +1,311 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file service_host.h
+ * @brief A host running several services, such as shadow, jobs, Defender and
+ * OTA, over a single MQTT connection.
+ *
+ * The host owns one #MqttConnection_t, and so one TLS session, one
+ * keep-alive and one window of outgoing publishes for all its services. Each
+ * service registers with the host, and then subscribes and publishes through
+ * it. The incoming PUBLISHes are matched to the subscriptions of the services
+ * by the subscription manager, and each service gets its messages on its own
+ * dispatch thread, in the order they were received, so a slow service does
+ * not hold up the others or the connection. Each service also has a quota of
+ * publishes awaiting their PUBACK, so that a busy service cannot take the
+ * whole window.
+ *
+ * A topic filter subscribed to by several services is subscribed to once,
+ * and unsubscribed from once none of them is subscribed to it. When the
+ * broker starts a clean session, the host subscribes to the topic filters
+ * again.
+ *
+ * The functions are thread safe, and may be called from the callbacks of the
+ * services. #ServiceHost_ProcessLoop holds the connection for its whole
+ * timeout, so it should be called often with a short timeout.
+ */
+
+#ifndef SERVICE_HOST_H_
+#define SERVICE_HOST_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the service host. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Service Host"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* MQTT connection shared by the services. */
+#include "mqtt_connection.h"
+
+/**
+ * @brief Maximum number of services registered with the host.
+ */
+#ifndef SERVICE_HOST_MAX_SERVICES
+    #define SERVICE_HOST_MAX_SERVICES    ( 4U )
+#endif
+
+/**
+ * @brief Maximum number of subscriptions of all the services. A topic filter
+ * subscribed to by several services counts once for each of them.
+ */
+#ifndef SERVICE_HOST_MAX_SUBSCRIPTIONS
+    #define SERVICE_HOST_MAX_SUBSCRIPTIONS    ( 32U )
+#endif
+
+/**
+ * @brief Maximum number of publishes of all the services awaiting their
+ * PUBACK. It should be no less than the length of the window of the
+ * connection.
+ */
+#ifndef SERVICE_HOST_MAX_INFLIGHT
+    #define SERVICE_HOST_MAX_INFLIGHT    ( 32U )
+#endif
+
+/**
+ * @brief Number of incoming messages each service can hold while its
+ * dispatch thread is busy. The messages received while they are all held are
+ * dropped.
+ */
+#ifndef SERVICE_HOST_QUEUE_LENGTH
+    #define SERVICE_HOST_QUEUE_LENGTH    ( 8U )
+#endif
+
+/**
+ * @brief Maximum length of the topic and payload of an incoming message
+ * held for a service.
+ */
+#ifndef SERVICE_HOST_MESSAGE_SIZE
+    #define SERVICE_HOST_MESSAGE_SIZE    ( 2048U )
+#endif
+
+/**
+ * @brief Return codes of the service host.
+ */
+typedef enum ServiceHostStatus
+{
+    ServiceHostSuccess = 0,     /**< @brief The operation completed; publishes were sent or queued. */
+    ServiceHostBadParameter,    /**< @brief A parameter is invalid, or the host is not initialized. */
+    ServiceHostNoMemory,        /**< @brief A table of the host, the window or the queue is full. */
+    ServiceHostQuotaExceeded,   /**< @brief The service has its quota of publishes awaiting their PUBACK. */
+    ServiceHostFailed           /**< @brief The connection or a thread failed. */
+} ServiceHostStatus_t;
+
+/**
+ * @brief A service, registered by #ServiceHost_RegisterService.
+ */
+typedef struct ServiceHostService ServiceHostService_t;
+
+/**
+ * @brief Receives, on the dispatch thread of a service, an incoming message
+ * on a topic filter the service subscribed to.
+ *
+ * @param[in] pService The service.
+ * @param[in] pPublishInfo A copy of the message, valid until the callback
+ * returns.
+ * @param[in] pUserContext The context given to #ServiceHost_Subscribe.
+ */
+typedef void ( * ServiceHostMessageCallback_t )( ServiceHostService_t * pService,
+                                                 const MQTTPublishInfo_t * pPublishInfo,
+                                                 void * pUserContext );
+
+/**
+ * @brief Counters of the activity of a service since its registration.
+ */
+typedef struct ServiceHostServiceMetrics
+{
+    uint32_t publishesSent;     /**< @brief Publishes sent or queued. */
+    uint32_t publishesRejected; /**< @brief Publishes refused as the service had its quota. */
+    uint32_t pubacksReceived;   /**< @brief PUBACKs of the publishes of the service. */
+    uint32_t messagesDelivered; /**< @brief Incoming messages given to the callbacks of the service. */
+    uint32_t messagesDropped;   /**< @brief Incoming messages dropped as the queue of the service was full or they were too large. */
+    uint32_t inflight;          /**< @brief Publishes of the service awaiting their PUBACK. */
+} ServiceHostServiceMetrics_t;
+
+/**
+ * @brief Create the connection of the host, without connecting it.
+ *
+ * @param[in] pConfig The broker and the session. The host routes the
+ * incoming packets itself, so #MqttConnectionConfig_t.eventCallback and
+ * #MqttConnectionConfig_t.pUserContext are ignored.
+ * @param[in] pBuffers The memory of the connection.
+ *
+ * @return #ServiceHostSuccess, #ServiceHostBadParameter if the host is
+ * already initialized, or #ServiceHostFailed if the connection cannot be
+ * created.
+ */
+ServiceHostStatus_t ServiceHost_Init( const MqttConnectionConfig_t * pConfig,
+                                      const MqttConnectionBuffers_t * pBuffers );
+
+/**
+ * @brief Register a service, and start its dispatch thread.
+ *
+ * @param[in] pName The name of the service, for the logs; it must remain
+ * valid until #ServiceHost_Deinit.
+ * @param[in] maxInflight Maximum number of publishes of the service awaiting
+ * their PUBACK, at least 1.
+ * @param[out] ppService The service.
+ *
+ * @return #ServiceHostSuccess, #ServiceHostBadParameter,
+ * #ServiceHostNoMemory if every service is in use, or #ServiceHostFailed if
+ * the thread cannot be started.
+ */
+ServiceHostStatus_t ServiceHost_RegisterService( const char * pName,
+                                                 uint32_t maxInflight,
+                                                 ServiceHostService_t ** ppService );
+
+/**
+ * @brief Connect the host to the broker, with retries and backoff.
+ *
+ * If the broker starts a clean session, the publishes awaiting their PUBACK
+ * are dropped, which frees the quotas of the services, and the topic filters
+ * of the services are subscribed to again.
+ *
+ * @return #ServiceHostSuccess, #ServiceHostBadParameter or
+ * #ServiceHostFailed.
+ */
+ServiceHostStatus_t ServiceHost_Connect( void );
+
+/**
+ * @brief Disconnect the host from the broker.
+ *
+ * @return #ServiceHostSuccess, #ServiceHostBadParameter or
+ * #ServiceHostFailed.
+ */
+ServiceHostStatus_t ServiceHost_Disconnect( void );
+
+/**
+ * @brief Subscribe a service to a topic filter.
+ *
+ * The SUBSCRIBE is sent only if no other service is subscribed to the topic
+ * filter.
+ *
+ * @param[in] pService The service.
+ * @param[in] pTopicFilter The topic filter, which must remain valid until
+ * #ServiceHost_Unsubscribe.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ * @param[in] callback The callback of the messages on the topic filter.
+ * @param[in] pUserContext The context passed to @p callback.
+ *
+ * @return #ServiceHostSuccess, #ServiceHostBadParameter,
+ * #ServiceHostNoMemory if the subscriptions are full, or #ServiceHostFailed if
+ * the SUBSCRIBE failed.
+ */
+ServiceHostStatus_t ServiceHost_Subscribe( ServiceHostService_t * pService,
+                                           const char * pTopicFilter,
+                                           uint16_t topicFilterLength,
+                                           ServiceHostMessageCallback_t callback,
+                                           void * pUserContext );
+
+/**
+ * @brief Unsubscribe a service from a topic filter.
+ *
+ * The UNSUBSCRIBE is sent only if no other service is subscribed to the
+ * topic filter.
+ *
+ * @param[in] pService The service.
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ * @param[in] callback The callback given to #ServiceHost_Subscribe.
+ * @param[in] pUserContext The context given to #ServiceHost_Subscribe.
+ *
+ * @return #ServiceHostSuccess, #ServiceHostBadParameter if the service is
+ * not subscribed, or #ServiceHostFailed if the UNSUBSCRIBE failed.
+ */
+ServiceHostStatus_t ServiceHost_Unsubscribe( ServiceHostService_t * pService,
+                                             const char * pTopicFilter,
+                                             uint16_t topicFilterLength,
+                                             ServiceHostMessageCallback_t callback,
+                                             void * pUserContext );
+
+/**
+ * @brief Send a QoS1 publish of a service, as #MqttConnection_Publish does.
+ *
+ * A publish that is sent counts towards the quota of the service until its
+ * PUBACK. A publish that is queued while the broker is disconnected does not.
+ *
+ * @param[in] pService The service.
+ * @param[in] pPublishInfo The publish, as for #MqttConnection_Publish.
+ *
+ * @return #ServiceHostSuccess if the publish is sent or queued;
+ * #ServiceHostQuotaExceeded if the service has its quota of publishes
+ * awaiting their PUBACK; #ServiceHostNoMemory, #ServiceHostBadParameter or
+ * #ServiceHostFailed otherwise.
+ */
+ServiceHostStatus_t ServiceHost_Publish( ServiceHostService_t * pService,
+                                         const MQTTPublishInfo_t * pPublishInfo );
+
+/**
+ * @brief Receive the incoming packets, and queue the messages to the
+ * services.
+ *
+ * @param[in] timeoutMs Time spent receiving.
+ *
+ * @return #ServiceHostSuccess, #ServiceHostBadParameter or
+ * #ServiceHostFailed.
+ */
+ServiceHostStatus_t ServiceHost_ProcessLoop( uint32_t timeoutMs );
+
+/**
+ * @brief Read the counters of a service.
+ *
+ * @param[in] pService The service.
+ * @param[out] pMetrics The counters.
+ *
+ * @return #ServiceHostSuccess or #ServiceHostBadParameter.
+ */
+ServiceHostStatus_t ServiceHost_GetServiceMetrics( const ServiceHostService_t * pService,
+                                                   ServiceHostServiceMetrics_t * pMetrics );
+
+/**
+ * @brief Stop the dispatch threads once they have delivered the messages
+ * they hold, remove the subscriptions from the subscription manager, and
+ * destroy the disconnected connection.
+ *
+ * It must not be called from the callback of a service.
+ */
+void ServiceHost_Deinit( void );
+
+#endif /* ifndef SERVICE_HOST_H_ */
@@ -0,0 +1,256 @@
+/*
+ * AWS IoT Device SDK for Embedded C V202009.00
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_config.h
+ * @brief OTA user configurable settings.
+ */
+
+#ifndef OTA_CONFIG_H_
+#define OTA_CONFIG_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Configure name and log level for the OTA library. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "OTA"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/**
+ * @brief Log base 2 of the size of the file data block message (excluding the header).
+ *
+ * 10 bits yields a data block size of 1KB. The service host holds each block
+ * in a message of SERVICE_HOST_MESSAGE_SIZE bytes, with its topic and CBOR
+ * header, so the blocks are 1 KB rather than the 4 KB of the OTA demo.
+ */
+#define otaconfigLOG2_FILE_BLOCK_SIZE    10UL
+
+
+/**
+ * @brief Size of the file data block message (excluding the header).
+ *
+ */
+#define otaconfigFILE_BLOCK_SIZE                ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE )
+
+/**
+ * @brief Milliseconds to wait for the self test phase to succeed before we force reset.
+ */
+#define otaconfigSELF_TEST_RESPONSE_WAIT_MS     16000U
+
+/**
+ * @brief Milliseconds to wait before requesting data blocks from the OTA service if nothing is happening.
+ *
+ * The wait timer is reset whenever a data block is received from the OTA service so we will only send
+ * the request message after being idle for this amount of time.
+ */
+#define otaconfigFILE_REQUEST_WAIT_MS           10000U
+
+/**
+ * @brief The maximum allowed length of the thing name used by the OTA agent.
+ *
+ * AWS IoT requires Thing names to be unique for each device that connects to the broker.
+ * Likewise, the OTA agent requires the developer to construct and pass in the Thing name when
+ * initializing the OTA agent. The agent uses this size to allocate static storage for the
+ * Thing name used in all OTA base topics. Namely $aws/things/<thingName>
+ */
+#define otaconfigMAX_THINGNAME_LEN              64U
+
+/**
+ * @brief Maximum size of the response to a data block request, from the AWS
+ * IoT streaming service.
+ *
+ * The response is limited to the SERVICE_HOST_QUEUE_LENGTH blocks the OTA
+ * service holds while its dispatch thread is busy, as the blocks beyond them
+ * would be dropped.
+ */
+#define OTA_STREAM_MAX_RESPONSE_SIZE            ( 8UL * 1024UL )
+
+/**
+ * @brief The maximum number of data blocks requested from OTA streaming service.
+ *
+ *  This configuration parameter is sent with data requests and represents the maximum number of
+ *  data blocks the service will send in response. The maximum limit for this must be calculated
+ *  from the maximum data response limit (128 KB from service) divided by the block size.
+ *  For example if block size is set as 1 KB then the maximum number of data blocks that we can
+ *  request is 128/1 = 128 blocks. Configure this parameter to this maximum limit or lower based on
+ *  how many data blocks response is expected for each data requests.
+ *  @note This must be set larger than zero.
+ *
+ *  This is the window of blocks in flight: the agent requests the next blocks missing from its
+ *  receive bitmap once the blocks of a request are received, so the transfer takes a round trip
+ *  to the broker per window rather than per block. The window is set to the blocks the OTA
+ *  service of the host can hold, 8 blocks of 1 KB.
+ *
+ */
+#define otaconfigMAX_NUM_BLOCKS_REQUEST         ( OTA_STREAM_MAX_RESPONSE_SIZE / otaconfigFILE_BLOCK_SIZE )
+
+/**
+ * @brief The maximum number of requests allowed to send without a response before we abort.
+ *
+ * This configuration parameter sets the maximum number of times the requests are made over
+ * the selected communication channel before aborting and returning error.
+ *
+ */
+#define otaconfigMAX_NUM_REQUEST_MOMENTUM       32U
+
+/**
+ * @brief The number of data buffers reserved by the OTA agent.
+ *
+ * This configurations parameter sets the maximum number of static data buffers used by
+ * the OTA agent for job and file data blocks received.
+ *
+ * A whole window of otaconfigMAX_NUM_BLOCKS_REQUEST blocks can arrive before the agent
+ * processes the first of them, so there is a buffer for each, and for a job document.
+ * Otherwise blocks are dropped, and requested again when the window times out.
+ */
+#define otaconfigMAX_NUM_OTA_DATA_BUFFERS       ( otaconfigMAX_NUM_BLOCKS_REQUEST + 2U )
+
+/**
+ * @brief How frequently the device will report its OTA progress to the cloud.
+ *
+ * Device will update the job status with the number of blocks it has received every certain
+ * number of blocks it receives. For example, 25 means device will update job status every 25 blocks
+ * it receives.
+ */
+#define otaconfigOTA_UPDATE_STATUS_FREQUENCY    25U
+
+/**
+ * @brief Allow update to same or lower version.
+ *
+ * Set this to 1 to allow downgrade or same version update. This configurations parameter
+ * disables version check and allows update to a same or lower version. This is provided for
+ * testing purpose and it is recommended to always update to higher version and keep this
+ * configuration disabled.
+ */
+#define otaconfigAllowDowngrade                 0U
+
+/**
+ * @brief The protocol selected for OTA control operations.
+ *
+ * This configurations parameter sets the default protocol for all the OTA control
+ * operations like requesting OTA job, updating the job status etc.
+ *
+ * Note - Only MQTT is supported at this time for control operations.
+ */
+#define configENABLED_CONTROL_PROTOCOL          ( OTA_CONTROL_OVER_MQTT )
+
+/**
+ * @brief The protocol selected for OTA data operations.
+ *
+ * This configurations parameter sets the protocols selected for the data operations
+ * like requesting file blocks from the service.
+ *
+ * Note - Both MQTT and HTTP is supported for data transfer. This configuration parameter
+ * can be set to following -
+ * Enable data over MQTT - ( OTA_DATA_OVER_MQTT )
+ * Enable data over HTTP - ( OTA_DATA_OVER_HTTP)
+ * Enable data over both MQTT & HTTP ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP )
+ */
+#define configENABLED_DATA_PROTOCOLS            ( OTA_DATA_OVER_MQTT )
+
+/**
+ * @brief The preferred protocol selected for OTA data operations.
+ *
+ * Primary data protocol will be the protocol used for downloading file if more than
+ * one protocol is selected while creating OTA job. Default primary data protocol is MQTT
+ * and following update here to switch to HTTP as primary.
+ *
+ * Note - use OTA_DATA_OVER_HTTP for HTTP as primary data protocol.
+ */
+#define configOTA_PRIMARY_DATA_PROTOCOL         ( OTA_DATA_OVER_MQTT )
+
+/**
+ * @brief Preallocate the receive file and write each block with a single
+ * pwrite at its offset, instead of fseek and fwrite.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_PWRITE_ENABLED            ( 1 )
+
+/**
+ * @brief Hash the image while its blocks are written, so that only the
+ * signature is verified when the file is closed.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED  ( 1 )
+
+/**
+ * @brief Keep the public key of the signer certificate between signature
+ * checks, instead of parsing the certificate for every file.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED  ( 1 )
+
+/**
+ * @brief Accept delta images, which are applied to the running executable
+ * before their signature is checked.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_DELTA_ENABLED             ( 1 )
+
+/**
+ * @brief Accept images compressed with gzip, which are decompressed before
+ * their signature is checked.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_GZIP_ENABLED              ( 1 )
+
+/**
+ * @brief Keep the image state in a checksummed state store, with the progress
+ * of the file being received, so that an interrupted transfer resumes after
+ * a restart.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_STATE_STORE_ENABLED       ( 1 )
+
+/**
+ * @brief Write the blocks of the file on a writer thread, so that the next
+ * blocks are received while the previous ones are written.
+ *
+ * See ota_pal_posix.h.
+ */
+#define OTA_PAL_POSIX_WRITE_BEHIND_ENABLED      ( 1 )
+
+#endif /* OTA_CONFIG_H_ */
@@ -0,0 +1,1449 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file service_host_demo.c
+ * @brief Runs the Device Shadow, Device Defender and OTA services of a thing
+ * over a single MQTT connection, through the service host.
+ *
+ * Each service registers with the host, then subscribes and publishes
+ * through it. The shadow service reports the uptime of the demo, the
+ * Defender service sends a metrics report, and the OTA agent waits for
+ * update jobs and downloads their files, all over the same TLS session. The
+ * demo thread runs the connection, and reconnects when it drops.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Include Demo Config as the first non-system header. */
+#include "demo_config.h"
+
+/* Clock for the reports and the waits. */
+#include "clock.h"
+
+/* Host of the services, owning the MQTT connection. */
+#include "service_host.h"
+
+/* Reserved topics of the thing. */
+#include "thing_topics.h"
+
+/* OTA Library include. */
+#include "ota.h"
+#include "ota_config.h"
+
+/* OTA Library Interface include. */
+#include "ota_os_posix.h"
+#include "ota_mqtt_interface.h"
+#include "ota_pal_posix.h"
+
+/* Include firmware version struct definition. */
+#include "ota_appversion32.h"
+
+/**
+ * These configuration settings are required to run the demo.
+ * Throw compilation error if the below configs are not defined.
+ */
+#ifndef AWS_IOT_ENDPOINT
+    #error "Please define AWS IoT MQTT broker endpoint(AWS_IOT_ENDPOINT) in demo_config.h."
+#endif
+#ifndef ROOT_CA_CERT_PATH
+    #error "Please define path to Root CA certificate of the MQTT broker(ROOT_CA_CERT_PATH) in demo_config.h."
+#endif
+#ifndef CLIENT_IDENTIFIER
+    #error "Please define a unique client identifier, CLIENT_IDENTIFIER, in demo_config.h."
+#endif
+#ifndef CLIENT_CERT_PATH
+    #error "Please define path to client certificate(CLIENT_CERT_PATH) in demo_config.h."
+#endif
+#ifndef CLIENT_PRIVATE_KEY_PATH
+    #error "Please define path to client private key(CLIENT_PRIVATE_KEY_PATH) in demo_config.h."
+#endif
+
+/**
+ * @brief Length of MQTT server host name.
+ */
+#define AWS_IOT_ENDPOINT_LENGTH                  ( ( uint16_t ) ( sizeof( AWS_IOT_ENDPOINT ) - 1 ) )
+
+/**
+ * @brief Length of client identifier.
+ */
+#define CLIENT_IDENTIFIER_LENGTH                 ( ( uint16_t ) ( sizeof( CLIENT_IDENTIFIER ) - 1 ) )
+
+/**
+ * @brief The maximum time interval in seconds which is allowed to elapse
+ * between two Control Packets.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS         ( 60U )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS           ( 500U )
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milli seconds.
+ */
+#define CONNACK_RECV_TIMEOUT_MS                  ( 2000U )
+
+/**
+ * @brief Longest time to wait for a SUBACK or an UNSUBACK, in milliseconds.
+ */
+#define MQTT_ACK_TIMEOUT_MS                      ( 2000U )
+
+/**
+ * @brief Timeout of each call to #ServiceHost_ProcessLoop, in milliseconds.
+ *
+ * The host is held for the whole timeout, so it is short for the services
+ * to subscribe and publish between the calls.
+ */
+#define MQTT_PROCESS_LOOP_TIMEOUT_MS             ( 50U )
+
+/**
+ * @brief The maximum number of retries for connecting to server.
+ */
+#define CONNECTION_RETRY_MAX_ATTEMPTS            ( 5U )
+
+/**
+ * @brief The maximum back-off delay (in milliseconds) for retrying connection to server.
+ */
+#define CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS    ( 5000U )
+
+/**
+ * @brief The base back-off delay (in milliseconds) to use for connection retry attempts.
+ */
+#define CONNECTION_RETRY_BACKOFF_BASE_MS         ( 500U )
+
+/**
+ * @brief Size of the network buffer, enough for a message held by the host
+ * and the header of its PUBLISH.
+ */
+#define NETWORK_BUFFER_SIZE                      ( SERVICE_HOST_MESSAGE_SIZE + 128U )
+
+/**
+ * @brief Maximum number of outgoing publishes awaiting their PUBACK, as
+ * many as the MQTT library keeps state for.
+ */
+#define MAX_OUTGOING_PUBLISHES                   ( MQTT_STATE_ARRAY_MAX_COUNT )
+
+/**
+ * @brief Maximum number of publishes queued while the connection to the
+ * broker is down.
+ */
+#define OFFLINE_PUBLISH_QUEUE_LENGTH             ( 8U )
+
+/**
+ * @brief Maximum length of the topic and payload of a queued publish.
+ */
+#define OFFLINE_PUBLISH_SLOT_SIZE                ( 1024U )
+
+/**
+ * @brief Maximum number of queued publishes sent after a reconnect before
+ * the PUBACKs received are processed.
+ */
+#define OFFLINE_PUBLISH_DRAIN_BATCH_SIZE         ( 4U )
+
+/**
+ * @brief Time spent receiving PUBACKs after each batch of queued publishes,
+ * in milliseconds.
+ */
+#define OFFLINE_PUBLISH_DRAIN_INTERVAL_MS        ( 100U )
+
+/**
+ * @brief The MQTT metrics string expected by AWS IoT.
+ */
+#define METRICS_STRING                           "?SDK=" OS_NAME "&Version=" OS_VERSION "&Platform=" HARDWARE_PLATFORM_NAME "&MQTTLib=" MQTT_LIB
+
+/**
+ * @brief The length of the MQTT metrics string expected by AWS IoT.
+ */
+#define METRICS_STRING_LENGTH                    ( ( uint16_t ) ( sizeof( METRICS_STRING ) - 1 ) )
+
+/**
+ * @brief Quotas of publishes awaiting their PUBACK of the services. Together
+ * they stay within #MAX_OUTGOING_PUBLISHES.
+ */
+#define SHADOW_MAX_INFLIGHT                      ( 2U )
+#define DEFENDER_MAX_INFLIGHT                    ( 1U )
+#define OTA_MAX_INFLIGHT                         ( 4U )
+
+/**
+ * @brief Interval between the reports of the shadow service, in milliseconds.
+ */
+#define SHADOW_REPORT_INTERVAL_MS                ( 10000U )
+
+/**
+ * @brief Interval between the reports of the Defender service, in
+ * milliseconds. Device Defender accepts one report every 5 minutes.
+ */
+#define DEFENDER_REPORT_INTERVAL_MS              ( 300000U )
+
+/**
+ * @brief Size of the payload of a shadow or Defender report.
+ */
+#define REPORT_SIZE                              ( 128U )
+
+/**
+ * @brief Maximum number of topic filters the OTA agent subscribes to at once:
+ * the job documents, the job notifications and the blocks of a stream.
+ */
+#define OTA_MAX_SUBSCRIPTIONS                    ( 4U )
+
+/**
+ * @brief Size of a topic filter of the OTA agent, with the thing and stream
+ * names.
+ */
+#define OTA_TOPIC_FILTER_SIZE                    ( 256U )
+
+/**
+ * @brief Maximum length of the topic and payload of a publish of the OTA
+ * agent, such as a status update of its job or a request for blocks.
+ */
+#define OTA_PUBLISH_SIZE                         ( 768U )
+
+/**
+ * @brief Longest time the OTA agent waits for the quota of its service to
+ * publish, in milliseconds.
+ */
+#define OTA_PUBLISH_QUOTA_WAIT_MS                ( 5000U )
+
+/**
+ * @brief Interval between the checks of the quota of the OTA service, in
+ * milliseconds.
+ */
+#define OTA_PUBLISH_QUOTA_POLL_MS                ( 10U )
+
+/**
+ * @brief The maximum size of the file paths used in the demo.
+ */
+#define OTA_MAX_FILE_PATH_SIZE                   ( 260U )
+
+/**
+ * @brief The maximum size of the stream name required for downloading update file
+ * from streaming service.
+ */
+#define OTA_MAX_STREAM_NAME_SIZE                 ( 128U )
+
+/**
+ * @brief The timeout for waiting for the agent to get suspended after closing the
+ * connection.
+ */
+#define OTA_SUSPEND_TIMEOUT_MS                   ( 5000U )
+
+/**
+ * @brief Interval between the checks of the state of the OTA agent, in
+ * milliseconds.
+ */
+#define OTA_STATE_POLL_MS                        ( 100U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A topic filter the OTA agent subscribed to, copied as the agent
+ * builds it on its stack.
+ */
+typedef struct OtaSubscription
+{
+    char topicFilter[ OTA_TOPIC_FILTER_SIZE ]; /**< @brief The topic filter. */
+    uint16_t topicFilterLength;                /**< @brief Length of @p topicFilter; 0 if the entry is free. */
+    OtaEvent_t eventId;                        /**< @brief The event of the messages, a job document or a block. */
+} OtaSubscription_t;
+
+/**
+ * @brief A publish of the OTA agent, copied as the agent builds it on its
+ * stack while the connection sends it from the window until its PUBACK.
+ *
+ * The quota of the OTA service bounds the publishes awaiting their PUBACK,
+ * so one copy for each of them is enough.
+ */
+typedef struct OtaPublishCopy
+{
+    uint8_t buffer[ OTA_PUBLISH_SIZE ]; /**< @brief The topic followed by the payload. */
+} OtaPublishCopy_t;
+
+/**
+ * @brief Struct for firmware version.
+ */
+const AppVersion32_t appFirmwareVersion =
+{
+    .u.x.major = APP_VERSION_MAJOR,
+    .u.x.minor = APP_VERSION_MINOR,
+    .u.x.build = APP_VERSION_BUILD,
+};
+
+/**
+ * @brief The network buffer must remain valid for the lifetime of the MQTT context.
+ */
+static uint8_t networkBuffer[ NETWORK_BUFFER_SIZE ];
+
+/**
+ * @brief Entries of the window of the outgoing publishes, kept by the
+ * connection until their PUBACK.
+ */
+static PublishWindowEntry_t outgoingPublishEntries[ MAX_OUTGOING_PUBLISHES ];
+
+/**
+ * @brief Hash buckets of the window of the outgoing publishes.
+ */
+static uint16_t outgoingPublishBuckets[ PUBLISH_WINDOW_BUCKET_COUNT( MAX_OUTGOING_PUBLISHES ) ];
+
+/**
+ * @brief Entries of the queue of the publishes issued while the connection
+ * to the broker is down.
+ */
+static PublishQueueEntry_t offlinePublishEntries[ OFFLINE_PUBLISH_QUEUE_LENGTH ];
+
+/**
+ * @brief Copies of the topics and payloads of the queued publishes.
+ */
+static uint8_t offlinePublishSlots[ OFFLINE_PUBLISH_QUEUE_LENGTH * OFFLINE_PUBLISH_SLOT_SIZE ];
+
+/**
+ * @brief The reserved topics of the thing.
+ */
+static ThingTopics_t thingTopics;
+
+/**
+ * @brief The memory of #thingTopics.
+ */
+static char thingTopicsBuffer[ THING_TOPICS_BUFFER_SIZE( THING_NAME_LENGTH ) ];
+
+/**
+ * @brief The services registered with the host.
+ */
+static ServiceHostService_t * pShadowService = NULL;
+static ServiceHostService_t * pDefenderService = NULL;
+static ServiceHostService_t * pOtaService = NULL;
+
+/**
+ * @brief Payloads of the shadow reports awaiting their PUBACK, one for each
+ * publish of the quota of the shadow service.
+ */
+static char shadowReports[ SHADOW_MAX_INFLIGHT ][ REPORT_SIZE ];
+
+/**
+ * @brief Payloads of the Defender reports awaiting their PUBACK.
+ */
+static char defenderReports[ DEFENDER_MAX_INFLIGHT ][ REPORT_SIZE ];
+
+/**
+ * @brief Number of shadow and Defender reports sent, which also picks the
+ * payload buffer of the next one.
+ */
+static uint32_t shadowReportCount = 0U;
+static uint32_t defenderReportCount = 0U;
+
+/**
+ * @brief The topic filters the OTA agent subscribed to. They are only
+ * changed on the OTA agent thread.
+ */
+static OtaSubscription_t otaSubscriptions[ OTA_MAX_SUBSCRIPTIONS ];
+
+/**
+ * @brief Copies of the publishes of the OTA agent awaiting their PUBACK.
+ */
+static OtaPublishCopy_t otaPublishCopies[ OTA_MAX_INFLIGHT ];
+
+/**
+ * @brief Number of publishes of the OTA agent, which picks the copy of the
+ * next one.
+ */
+static uint32_t otaPublishCount = 0U;
+
+/**
+ * @brief Update File path buffer.
+ */
+static uint8_t updateFilePath[ OTA_MAX_FILE_PATH_SIZE ];
+
+/**
+ * @brief Certificate File path buffer.
+ */
+static uint8_t certFilePath[ OTA_MAX_FILE_PATH_SIZE ];
+
+/**
+ * @brief Stream name buffer.
+ */
+static uint8_t streamName[ OTA_MAX_STREAM_NAME_SIZE ];
+
+/**
+ * @brief Decode memory.
+ */
+static uint8_t decodeMem[ otaconfigFILE_BLOCK_SIZE ];
+
+/**
+ * @brief Bitmap memory.
+ */
+static uint8_t bitmap[ OTA_MAX_BLOCK_BITMAP_SIZE ];
+
+/**
+ * @brief Event buffers of the job documents and blocks given to the OTA
+ * agent.
+ */
+static OtaEventData_t eventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
+
+/**
+ * @brief Protects the flags of #eventBuffer, claimed on the dispatch thread
+ * of the OTA service and released on the OTA agent thread.
+ */
+static pthread_mutex_t eventBufferMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The buffer passed to the OTA Agent from application while initializing.
+ */
+static OtaAppBuffer_t otaBuffer =
+{
+    .pUpdateFilePath    = updateFilePath,
+    .updateFilePathsize = OTA_MAX_FILE_PATH_SIZE,
+    .pCertFilePath      = certFilePath,
+    .certFilePathSize   = OTA_MAX_FILE_PATH_SIZE,
+    .pStreamName        = streamName,
+    .streamNameSize     = OTA_MAX_STREAM_NAME_SIZE,
+    .pDecodeMemory      = decodeMem,
+    .decodeMemorySize   = otaconfigFILE_BLOCK_SIZE,
+    .pFileBitmap        = bitmap,
+    .fileBitmapSize     = OTA_MAX_BLOCK_BITMAP_SIZE
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Create the service host, with the connection to the broker.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int initializeHost( void );
+
+/**
+ * @brief Register the services, and subscribe the shadow and Defender
+ * services to the responses to their reports.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int registerServices( void );
+
+/**
+ * @brief Send a report of the uptime of the demo to the shadow of the thing.
+ *
+ * @param[in] uptimeMs Time since the demo started, in milliseconds.
+ */
+static void reportShadow( uint32_t uptimeMs );
+
+/**
+ * @brief Send a Device Defender report.
+ */
+static void reportDefender( void );
+
+/**
+ * @brief Callback of the responses to the shadow reports, on the dispatch
+ * thread of the shadow service.
+ *
+ * @param[in] pService The shadow service.
+ * @param[in] pPublishInfo The response.
+ * @param[in] pUserContext Unused.
+ */
+static void shadowCallback( ServiceHostService_t * pService,
+                            const MQTTPublishInfo_t * pPublishInfo,
+                            void * pUserContext );
+
+/**
+ * @brief Callback of the responses to the Defender reports, on the dispatch
+ * thread of the Defender service.
+ *
+ * @param[in] pService The Defender service.
+ * @param[in] pPublishInfo The response.
+ * @param[in] pUserContext Unused.
+ */
+static void defenderCallback( ServiceHostService_t * pService,
+                              const MQTTPublishInfo_t * pPublishInfo,
+                              void * pUserContext );
+
+/**
+ * @brief Callback of the job documents and blocks, on the dispatch thread
+ * of the OTA service, which hands them to the OTA agent.
+ *
+ * @param[in] pService The OTA service.
+ * @param[in] pPublishInfo The job document or block.
+ * @param[in] pUserContext The #OtaSubscription_t of the topic filter.
+ */
+static void otaMessageCallback( ServiceHostService_t * pService,
+                                const MQTTPublishInfo_t * pPublishInfo,
+                                void * pUserContext );
+
+/**
+ * @brief Subscribe the OTA service to a topic filter of the OTA agent.
+ *
+ * @param[in] pTopicFilter The topic filter, which is copied.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ * @param[in] qos Unused; the host subscribes with QoS1.
+ *
+ * @return OtaMqttSuccess, or OtaMqttSubscribeFailed.
+ */
+static OtaMqttStatus_t otaSubscribe( const char * pTopicFilter,
+                                     uint16_t topicFilterLength,
+                                     uint8_t qos );
+
+/**
+ * @brief Publish a message of the OTA agent through the OTA service.
+ *
+ * @param[in] pacTopic The topic.
+ * @param[in] topicLen Length of @p pacTopic.
+ * @param[in] pMsg The payload.
+ * @param[in] msgSize Length of @p pMsg.
+ * @param[in] qos Unused; the host publishes with QoS1.
+ *
+ * @return OtaMqttSuccess, or OtaMqttPublishFailed.
+ */
+static OtaMqttStatus_t otaPublish( const char * const pacTopic,
+                                   uint16_t topicLen,
+                                   const char * pMsg,
+                                   uint32_t msgSize,
+                                   uint8_t qos );
+
+/**
+ * @brief Unsubscribe the OTA service from a topic filter of the OTA agent.
+ *
+ * @param[in] pTopicFilter The topic filter.
+ * @param[in] topicFilterLength Length of @p pTopicFilter.
+ * @param[in] qos Unused.
+ *
+ * @return OtaMqttSuccess, or OtaMqttUnsubscribeFailed.
+ */
+static OtaMqttStatus_t otaUnsubscribe( const char * pTopicFilter,
+                                       uint16_t topicFilterLength,
+                                       uint8_t qos );
+
+/**
+ * @brief Claim a free event buffer for the OTA agent.
+ *
+ * @return The buffer, or NULL if they are all in use.
+ */
+static OtaEventData_t * otaEventBufferGet( void );
+
+/**
+ * @brief Release an event buffer the OTA agent has processed.
+ *
+ * @param[in] pxBuffer The buffer.
+ */
+static void otaEventBufferFree( OtaEventData_t * const pxBuffer );
+
+/**
+ * @brief Callback of the events of the OTA jobs, which activates the new
+ * image once it is accepted.
+ *
+ * @param[in] event Event from OTA lib of type OtaJobEvent_t.
+ * @param[in] pData The event buffer processed, for OtaJobEventProcessed.
+ */
+static void otaAppCallback( OtaJobEvent_t event,
+                            const void * pData );
+
+/**
+ * @brief Set OTA interfaces.
+ *
+ * @param[in]  pOtaInterfaces pointer to OTA interface structure.
+ */
+static void setOtaInterfaces( OtaInterfaces_t * pOtaInterfaces );
+
+/**
+ * @brief Thread to call the OTA agent task.
+ *
+ * @param[in] pParam Can be used to pass down functionality to the agent task
+ * @return void* returning null.
+ */
+static void * otaThread( void * pParam );
+
+/**
+ * @brief Suspend the OTA agent after the connection dropped, and wait for it
+ * to be suspended.
+ */
+static void suspendOta( void );
+
+/**
+ * @brief Run the connection and the reports of the services until
+ * #DEMO_RUN_TIME_MS elapsed or the OTA agent stopped.
+ *
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if the broker could not be reached.
+ */
+static int runServices( void );
+
+/**
+ * @brief Log the counters of a service.
+ *
+ * @param[in] pName The name of the service.
+ * @param[in] pService The service.
+ */
+static void logServiceMetrics( const char * pName,
+                               const ServiceHostService_t * pService );
+
+/*-----------------------------------------------------------*/
+
+static int initializeHost( void )
+{
+    int returnStatus = EXIT_SUCCESS;
+    MqttConnectionConfig_t config;
+    MqttConnectionBuffers_t buffers;
+
+    /* The broker, and the session of the demo. The host sets the event
+     * callback of the connection itself. */
+    config.pHostName = AWS_IOT_ENDPOINT;
+    config.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
+    config.port = AWS_MQTT_PORT;
+    config.pRootCaPath = ROOT_CA_CERT_PATH;
+    config.pClientCertPath = CLIENT_CERT_PATH;
+    config.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+    config.pClientIdentifier = CLIENT_IDENTIFIER;
+    config.clientIdentifierLength = CLIENT_IDENTIFIER_LENGTH;
+    config.pUserName = METRICS_STRING;
+    config.userNameLength = METRICS_STRING_LENGTH;
+    config.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+    config.transportTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+    config.connackTimeoutMs = CONNACK_RECV_TIMEOUT_MS;
+    config.earlyConnect = false;
+    config.earlyDataReplaySafe = false;
+    config.releaseIdleBuffers = false;
+    config.maxFragmentLength = 0U;
+    config.ocspMode = OPENSSL_OCSP_DISABLED;
+    config.cacheVerifiedChains = false;
+    config.ackTimeoutMs = MQTT_ACK_TIMEOUT_MS;
+    config.adaptiveTimeouts = false;
+    config.retryBaseMs = CONNECTION_RETRY_BACKOFF_BASE_MS;
+    config.retryMaxDelayMs = CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS;
+    config.retryMaxAttempts = CONNECTION_RETRY_MAX_ATTEMPTS;
+    config.drainBatchSize = OFFLINE_PUBLISH_DRAIN_BATCH_SIZE;
+    config.drainIntervalMs = OFFLINE_PUBLISH_DRAIN_INTERVAL_MS;
+    config.pStorePath = NULL;
+    config.storeSize = 0U;
+    config.eventCallback = NULL;
+    config.payloadBufferCallback = NULL;
+    config.payloadChunkCallback = NULL;
+    config.pUserContext = NULL;
+
+    /* The memory of the connection. The demo sends no batches. */
+    buffers.pNetworkBuffer = networkBuffer;
+    buffers.networkBufferSize = NETWORK_BUFFER_SIZE;
+    buffers.pWindowEntries = outgoingPublishEntries;
+    buffers.windowLength = MAX_OUTGOING_PUBLISHES;
+    buffers.pWindowBuckets = outgoingPublishBuckets;
+    buffers.pQueueEntries = offlinePublishEntries;
+    buffers.queueLength = OFFLINE_PUBLISH_QUEUE_LENGTH;
+    buffers.pQueueSlots = offlinePublishSlots;
+    buffers.queueSlotSize = OFFLINE_PUBLISH_SLOT_SIZE;
+    buffers.pBatchBuffer = NULL;
+    buffers.batchBufferSize = 0U;
+
+    if( ThingTopics_Init( &thingTopics,
+                          THING_NAME,
+                          THING_NAME_LENGTH,
+                          thingTopicsBuffer,
+                          sizeof( thingTopicsBuffer ) ) != ThingTopicsSuccess )
+    {
+        LogError( ( "Failed to assemble the topics of thing %s.", THING_NAME ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else if( ServiceHost_Init( &config, &buffers ) != ServiceHostSuccess )
+    {
+        LogError( ( "Failed to create the service host." ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int registerServices( void )
+{
+    int returnStatus = EXIT_SUCCESS;
+
+    if( ( ServiceHost_RegisterService( "shadow", SHADOW_MAX_INFLIGHT, &pShadowService ) != ServiceHostSuccess ) ||
+        ( ServiceHost_RegisterService( "defender", DEFENDER_MAX_INFLIGHT, &pDefenderService ) != ServiceHostSuccess ) ||
+        ( ServiceHost_RegisterService( "ota", OTA_MAX_INFLIGHT, &pOtaService ) != ServiceHostSuccess ) )
+    {
+        LogError( ( "Failed to register the services." ) );
+        returnStatus = EXIT_FAILURE;
+    }
+
+    /* The services subscribe before the host connects, which subscribes to
+     * their topic filters once the broker is reached. The topic filters of
+     * all the responses are taken from the thing topics, which remain valid
+     * until the host is deinitialized. */
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        if( ( ServiceHost_Subscribe( pShadowService,
+                                     THING_TOPICS_STRING( &thingTopics, ThingTopicShadowUpdateResponses ),
+                                     THING_TOPICS_LENGTH( &thingTopics, ThingTopicShadowUpdateResponses ),
+                                     shadowCallback,
+                                     NULL ) != ServiceHostSuccess ) ||
+            ( ServiceHost_Subscribe( pDefenderService,
+                                     THING_TOPICS_STRING( &thingTopics, ThingTopicDefenderJsonResponses ),
+                                     THING_TOPICS_LENGTH( &thingTopics, ThingTopicDefenderJsonResponses ),
+                                     defenderCallback,
+                                     NULL ) != ServiceHostSuccess ) )
+        {
+            LogError( ( "Failed to subscribe the services to their responses." ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void reportShadow( uint32_t uptimeMs )
+{
+    MQTTPublishInfo_t publishInfo;
+    ServiceHostStatus_t status = ServiceHostSuccess;
+    char * pReport = shadowReports[ shadowReportCount % SHADOW_MAX_INFLIGHT ];
+    int length = 0;
+
+    /* The client token matches the response to the report. */
+    length = snprintf( pReport,
+                       REPORT_SIZE,
+                       "{\"state\":{\"reported\":{\"uptime\":%u}},\"clientToken\":\"%u\"}",
+                       ( unsigned int ) ( uptimeMs / 1000U ),
+                       ( unsigned int ) shadowReportCount );
+    assert( ( length > 0 ) && ( length < ( int ) REPORT_SIZE ) );
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = THING_TOPICS_STRING( &thingTopics, ThingTopicShadowUpdate );
+    publishInfo.topicNameLength = THING_TOPICS_LENGTH( &thingTopics, ThingTopicShadowUpdate );
+    publishInfo.pPayload = pReport;
+    publishInfo.payloadLength = ( size_t ) length;
+
+    status = ServiceHost_Publish( pShadowService, &publishInfo );
+
+    if( status == ServiceHostSuccess )
+    {
+        shadowReportCount++;
+    }
+    else if( status == ServiceHostQuotaExceeded )
+    {
+        /* The previous reports are still awaiting their PUBACK, so this one
+         * is skipped rather than queued behind them. */
+        LogWarn( ( "Skipped a shadow report, as the previous ones are not acknowledged." ) );
+    }
+    else
+    {
+        LogError( ( "Failed to publish a shadow report." ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void reportDefender( void )
+{
+    MQTTPublishInfo_t publishInfo;
+    ServiceHostStatus_t status = ServiceHostSuccess;
+    char * pReport = defenderReports[ defenderReportCount % DEFENDER_MAX_INFLIGHT ];
+    int length = 0;
+
+    /* A report with the header only; the Defender demo shows the collection
+     * of the metrics. */
+    length = snprintf( pReport,
+                       REPORT_SIZE,
+                       "{\"header\":{\"report_id\":%u,\"version\":\"1.0\"},\"metrics\":{}}",
+                       ( unsigned int ) ( defenderReportCount + 1U ) );
+    assert( ( length > 0 ) && ( length < ( int ) REPORT_SIZE ) );
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = THING_TOPICS_STRING( &thingTopics, ThingTopicDefenderJson );
+    publishInfo.topicNameLength = THING_TOPICS_LENGTH( &thingTopics, ThingTopicDefenderJson );
+    publishInfo.pPayload = pReport;
+    publishInfo.payloadLength = ( size_t ) length;
+
+    status = ServiceHost_Publish( pDefenderService, &publishInfo );
+
+    if( status == ServiceHostSuccess )
+    {
+        defenderReportCount++;
+    }
+    else
+    {
+        LogError( ( "Failed to publish a Defender report: Status=%d.", ( int ) status ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void shadowCallback( ServiceHostService_t * pService,
+                            const MQTTPublishInfo_t * pPublishInfo,
+                            void * pUserContext )
+{
+    ThingTopic_t topic = ThingTopicCount;
+
+    ( void ) pService;
+    ( void ) pUserContext;
+
+    if( ThingTopics_Find( &thingTopics,
+                          pPublishInfo->pTopicName,
+                          pPublishInfo->topicNameLength,
+                          &topic ) != ThingTopicsSuccess )
+    {
+        LogWarn( ( "Shadow service received a message on %.*s.",
+                   pPublishInfo->topicNameLength,
+                   pPublishInfo->pTopicName ) );
+    }
+    else if( topic == ThingTopicShadowUpdateAccepted )
+    {
+        LogInfo( ( "Shadow report accepted." ) );
+    }
+    else
+    {
+        LogWarn( ( "Shadow report rejected: %.*s",
+                   ( int ) pPublishInfo->payloadLength,
+                   ( const char * ) pPublishInfo->pPayload ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void defenderCallback( ServiceHostService_t * pService,
+                              const MQTTPublishInfo_t * pPublishInfo,
+                              void * pUserContext )
+{
+    ThingTopic_t topic = ThingTopicCount;
+
+    ( void ) pService;
+    ( void ) pUserContext;
+
+    if( ThingTopics_Find( &thingTopics,
+                          pPublishInfo->pTopicName,
+                          pPublishInfo->topicNameLength,
+                          &topic ) != ThingTopicsSuccess )
+    {
+        LogWarn( ( "Defender service received a message on %.*s.",
+                   pPublishInfo->topicNameLength,
+                   pPublishInfo->pTopicName ) );
+    }
+    else if( topic == ThingTopicDefenderJsonAccepted )
+    {
+        LogInfo( ( "Defender report accepted." ) );
+    }
+    else
+    {
+        LogWarn( ( "Defender report rejected: %.*s",
+                   ( int ) pPublishInfo->payloadLength,
+                   ( const char * ) pPublishInfo->pPayload ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void otaMessageCallback( ServiceHostService_t * pService,
+                                const MQTTPublishInfo_t * pPublishInfo,
+                                void * pUserContext )
+{
+    const OtaSubscription_t * pSubscription = ( const OtaSubscription_t * ) pUserContext;
+    OtaEventData_t * pData = NULL;
+    OtaEventMsg_t eventMsg = { 0 };
+
+    ( void ) pService;
+
+    if( pPublishInfo->payloadLength > sizeof( pData->data ) )
+    {
+        LogError( ( "Dropping an OTA message: Payload of %zu bytes does not fit an OTA data buffer.",
+                    pPublishInfo->payloadLength ) );
+    }
+    else
+    {
+        pData = otaEventBufferGet();
+
+        if( pData == NULL )
+        {
+            LogError( ( "No OTA data buffers available." ) );
+        }
+    }
+
+    if( pData != NULL )
+    {
+        /* The payload is copied, as the host reuses the message once this
+         * callback returns. */
+        ( void ) memcpy( pData->data, pPublishInfo->pPayload, pPublishInfo->payloadLength );
+        pData->dataLength = pPublishInfo->payloadLength;
+        eventMsg.eventId = pSubscription->eventId;
+        eventMsg.pEventData = pData;
+
+        OTA_SignalEvent( &eventMsg );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaMqttStatus_t otaSubscribe( const char * pTopicFilter,
+                                     uint16_t topicFilterLength,
+                                     uint8_t qos )
+{
+    OtaMqttStatus_t otaRet = OtaMqttSubscribeFailed;
+    OtaSubscription_t * pSubscription = NULL;
+    ThingTopic_t topic = ThingTopicCount;
+    uint32_t index = 0U;
+
+    ( void ) qos;
+
+    for( index = 0U; ( index < OTA_MAX_SUBSCRIPTIONS ) && ( pSubscription == NULL ); index++ )
+    {
+        if( otaSubscriptions[ index ].topicFilterLength == 0U )
+        {
+            pSubscription = &otaSubscriptions[ index ];
+        }
+    }
+
+    if( ( pSubscription == NULL ) || ( topicFilterLength >= OTA_TOPIC_FILTER_SIZE ) )
+    {
+        LogError( ( "No room for the OTA topic filter %.*s.",
+                    topicFilterLength,
+                    pTopicFilter ) );
+    }
+    else
+    {
+        ( void ) memcpy( pSubscription->topicFilter, pTopicFilter, topicFilterLength );
+        pSubscription->topicFilter[ topicFilterLength ] = '\0';
+
+        /* The jobs topics of the agent, such as the notifications of the next
+         * job, are reserved topics of the thing and carry the job documents.
+         * The topic of a stream names the stream, so it is not one, and
+         * carries the blocks of the files. */
+        if( ThingTopics_Find( &thingTopics, pTopicFilter, topicFilterLength, &topic ) == ThingTopicsSuccess )
+        {
+            pSubscription->eventId = OtaAgentEventReceivedJobDocument;
+        }
+        else
+        {
+            pSubscription->eventId = OtaAgentEventReceivedFileBlock;
+        }
+
+        if( ServiceHost_Subscribe( pOtaService,
+                                   pSubscription->topicFilter,
+                                   topicFilterLength,
+                                   otaMessageCallback,
+                                   pSubscription ) == ServiceHostSuccess )
+        {
+            pSubscription->topicFilterLength = topicFilterLength;
+            otaRet = OtaMqttSuccess;
+
+            LogInfo( ( "OTA service subscribed to %.*s.",
+                       topicFilterLength,
+                       pTopicFilter ) );
+        }
+        else
+        {
+            LogError( ( "Failed to subscribe the OTA service to %.*s.",
+                        topicFilterLength,
+                        pTopicFilter ) );
+        }
+    }
+
+    return otaRet;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaMqttStatus_t otaPublish( const char * const pacTopic,
+                                   uint16_t topicLen,
+                                   const char * pMsg,
+                                   uint32_t msgSize,
+                                   uint8_t qos )
+{
+    OtaMqttStatus_t otaRet = OtaMqttPublishFailed;
+    ServiceHostStatus_t status = ServiceHostFailed;
+    MQTTPublishInfo_t publishInfo;
+    OtaPublishCopy_t * pCopy = &otaPublishCopies[ otaPublishCount % OTA_MAX_INFLIGHT ];
+    uint32_t waitedMs = 0U;
+
+    ( void ) qos;
+
+    if( ( ( size_t ) topicLen + ( size_t ) msgSize ) > sizeof( pCopy->buffer ) )
+    {
+        LogError( ( "The OTA publish to %.*s is too large: Size=%u.",
+                    topicLen,
+                    pacTopic,
+                    ( unsigned int ) msgSize ) );
+    }
+    else
+    {
+        /* The agent builds its publishes on its stack, while the connection
+         * keeps them in its window until their PUBACK. */
+        ( void ) memcpy( pCopy->buffer, pacTopic, topicLen );
+        ( void ) memcpy( &( pCopy->buffer[ topicLen ] ), pMsg, msgSize );
+
+        /* The host only sends QoS1 publishes. */
+        ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+        publishInfo.qos = MQTTQoS1;
+        publishInfo.pTopicName = ( const char * ) pCopy->buffer;
+        publishInfo.topicNameLength = topicLen;
+        publishInfo.pPayload = &( pCopy->buffer[ topicLen ] );
+        publishInfo.payloadLength = msgSize;
+
+        status = ServiceHost_Publish( pOtaService, &publishInfo );
+
+        /* The agent runs on its own thread, so it waits for its quota, which
+         * the PUBACKs received by the demo thread release. */
+        while( ( status == ServiceHostQuotaExceeded ) && ( waitedMs < OTA_PUBLISH_QUOTA_WAIT_MS ) )
+        {
+            Clock_SleepMs( OTA_PUBLISH_QUOTA_POLL_MS );
+            waitedMs += OTA_PUBLISH_QUOTA_POLL_MS;
+            status = ServiceHost_Publish( pOtaService, &publishInfo );
+        }
+
+        if( status == ServiceHostSuccess )
+        {
+            otaPublishCount++;
+            otaRet = OtaMqttSuccess;
+        }
+        else
+        {
+            LogError( ( "Failed to publish to %.*s: Status=%d.",
+                        topicLen,
+                        pacTopic,
+                        ( int ) status ) );
+        }
+    }
+
+    return otaRet;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaMqttStatus_t otaUnsubscribe( const char * pTopicFilter,
+                                       uint16_t topicFilterLength,
+                                       uint8_t qos )
+{
+    OtaMqttStatus_t otaRet = OtaMqttUnsubscribeFailed;
+    OtaSubscription_t * pSubscription = NULL;
+    uint32_t index = 0U;
+
+    ( void ) qos;
+
+    for( index = 0U; ( index < OTA_MAX_SUBSCRIPTIONS ) && ( pSubscription == NULL ); index++ )
+    {
+        if( ( otaSubscriptions[ index ].topicFilterLength == topicFilterLength ) &&
+            ( memcmp( otaSubscriptions[ index ].topicFilter, pTopicFilter, topicFilterLength ) == 0 ) )
+        {
+            pSubscription = &otaSubscriptions[ index ];
+        }
+    }
+
+    if( pSubscription == NULL )
+    {
+        LogError( ( "The OTA service is not subscribed to %.*s.",
+                    topicFilterLength,
+                    pTopicFilter ) );
+    }
+    else if( ServiceHost_Unsubscribe( pOtaService,
+                                      pSubscription->topicFilter,
+                                      topicFilterLength,
+                                      otaMessageCallback,
+                                      pSubscription ) == ServiceHostSuccess )
+    {
+        pSubscription->topicFilterLength = 0U;
+        otaRet = OtaMqttSuccess;
+    }
+    else
+    {
+        LogError( ( "Failed to unsubscribe the OTA service from %.*s.",
+                    topicFilterLength,
+                    pTopicFilter ) );
+    }
+
+    return otaRet;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaEventData_t * otaEventBufferGet( void )
+{
+    OtaEventData_t * pFreeBuffer = NULL;
+    uint32_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &eventBufferMutex );
+
+    for( index = 0U; ( index < otaconfigMAX_NUM_OTA_DATA_BUFFERS ) && ( pFreeBuffer == NULL ); index++ )
+    {
+        if( eventBuffer[ index ].bufferUsed == false )
+        {
+            eventBuffer[ index ].bufferUsed = true;
+            pFreeBuffer = &eventBuffer[ index ];
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &eventBufferMutex );
+
+    return pFreeBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+static void otaEventBufferFree( OtaEventData_t * const pxBuffer )
+{
+    ( void ) pthread_mutex_lock( &eventBufferMutex );
+    pxBuffer->bufferUsed = false;
+    ( void ) pthread_mutex_unlock( &eventBufferMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+static void otaAppCallback( OtaJobEvent_t event,
+                            const void * pData )
+{
+    OtaErr_t err = OtaErrUninitialized;
+
+    switch( event )
+    {
+        case OtaJobEventActivate:
+            LogInfo( ( "Received OtaJobEventActivate callback from OTA Agent." ) );
+
+            /* Activate the new firmware image. */
+            OTA_ActivateNewImage();
+
+            /* Shutdown OTA Agent. */
+            OTA_Shutdown( 0 );
+
+            /* Requires manual activation of new image.*/
+            LogError( ( "New image activation failed." ) );
+
+            break;
+
+        case OtaJobEventFail:
+            LogInfo( ( "Received OtaJobEventFail callback from OTA Agent." ) );
+
+            /* Nothing special to do. The OTA agent handles it. */
+            break;
+
+        case OtaJobEventStartTest:
+
+            /* The demo accepts the image, as it reached the broker and runs
+             * its services with it. */
+            LogInfo( ( "Received OtaJobEventStartTest callback from OTA Agent." ) );
+            err = OTA_SetImageState( OtaImageStateAccepted );
+
+            if( err != OtaErrNone )
+            {
+                LogError( ( " Failed to set image state as accepted." ) );
+            }
+
+            break;
+
+        case OtaJobEventProcessed:
+            LogDebug( ( "Received OtaJobEventProcessed callback from OTA Agent." ) );
+
+            if( pData != NULL )
+            {
+                otaEventBufferFree( ( OtaEventData_t * ) pData );
+            }
+
+            break;
+
+        case OtaJobEventSelfTestFailed:
+            LogDebug( ( "Received OtaJobEventSelfTestFailed callback from OTA Agent." ) );
+
+            /* Requires manual activation of previous image as self-test for
+             * new image downloaded failed.*/
+            LogError( ( "Self-test failed, shutting down OTA Agent." ) );
+
+            /* Shutdown OTA Agent. */
+            OTA_Shutdown( 0 );
+
+            break;
+
+        default:
+            LogDebug( ( "Received invalid callback event from OTA Agent." ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void setOtaInterfaces( OtaInterfaces_t * pOtaInterfaces )
+{
+    /* Initialize OTA library OS Interface. */
+    pOtaInterfaces->os.event.init = Posix_OtaInitEvent;
+    pOtaInterfaces->os.event.send = Posix_OtaSendEvent;
+    pOtaInterfaces->os.event.recv = Posix_OtaReceiveEvent;
+    pOtaInterfaces->os.event.deinit = Posix_OtaDeinitEvent;
+    pOtaInterfaces->os.timer.start = Posix_OtaStartTimer;
+    pOtaInterfaces->os.timer.stop = Posix_OtaStopTimer;
+    pOtaInterfaces->os.timer.delete = Posix_OtaDeleteTimer;
+    pOtaInterfaces->os.mem.malloc = STDC_Malloc;
+    pOtaInterfaces->os.mem.free = STDC_Free;
+
+    /* The OTA library MQTT Interface goes through the OTA service. */
+    pOtaInterfaces->mqtt.subscribe = otaSubscribe;
+    pOtaInterfaces->mqtt.publish = otaPublish;
+    pOtaInterfaces->mqtt.unsubscribe = otaUnsubscribe;
+
+    /* Initialize the OTA library PAL Interface.*/
+    pOtaInterfaces->pal.getPlatformImageState = otaPal_GetPlatformImageState;
+    pOtaInterfaces->pal.setPlatformImageState = otaPal_SetPlatformImageState;
+    pOtaInterfaces->pal.writeBlock = otaPal_WriteBlock;
+    pOtaInterfaces->pal.activate = otaPal_ActivateNewImage;
+    pOtaInterfaces->pal.closeFile = otaPal_CloseFile;
+    pOtaInterfaces->pal.reset = otaPal_ResetDevice;
+    pOtaInterfaces->pal.abort = otaPal_Abort;
+    pOtaInterfaces->pal.createFile = otaPal_CreateFileForRx;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * otaThread( void * pParam )
+{
+    /* Calling OTA agent task. */
+    OTA_EventProcessingTask( pParam );
+    LogInfo( ( "OTA Agent stopped." ) );
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void suspendOta( void )
+{
+    OtaErr_t otaRet = OtaErrNone;
+    uint32_t waitedMs = 0U;
+
+    otaRet = OTA_Suspend();
+
+    if( otaRet == OtaErrNone )
+    {
+        while( ( OTA_GetState() != OtaAgentStateSuspended ) && ( waitedMs < OTA_SUSPEND_TIMEOUT_MS ) )
+        {
+            Clock_SleepMs( OTA_STATE_POLL_MS );
+            waitedMs += OTA_STATE_POLL_MS;
+        }
+    }
+    else
+    {
+        LogError( ( "OTA failed to suspend. StatusCode=%d.", otaRet ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int runServices( void )
+{
+    int returnStatus = EXIT_SUCCESS;
+    bool connected = false;
+    bool otaStarted = false;
+    OtaEventMsg_t eventMsg = { 0 };
+    uint32_t startMs = Clock_GetTimeMs();
+    uint32_t nowMs = startMs;
+    uint32_t lastShadowReportMs = startMs - SHADOW_REPORT_INTERVAL_MS;
+    uint32_t lastDefenderReportMs = startMs - DEFENDER_REPORT_INTERVAL_MS;
+
+    while( ( returnStatus == EXIT_SUCCESS ) &&
+           ( OTA_GetState() != OtaAgentStateStopped ) &&
+           ( ( nowMs - startMs ) < DEMO_RUN_TIME_MS ) )
+    {
+        if( connected == false )
+        {
+            /* The connection retries with a backoff, and the host subscribes
+             * to the topic filters of the services once connected. */
+            if( ServiceHost_Connect() != ServiceHostSuccess )
+            {
+                LogError( ( "Failed to connect to %.*s.",
+                            AWS_IOT_ENDPOINT_LENGTH,
+                            AWS_IOT_ENDPOINT ) );
+                returnStatus = EXIT_FAILURE;
+            }
+            else
+            {
+                connected = true;
+
+                if( otaStarted == false )
+                {
+                    eventMsg.eventId = OtaAgentEventStart;
+                    OTA_SignalEvent( &eventMsg );
+                    otaStarted = true;
+                }
+                else if( OTA_GetState() == OtaAgentStateSuspended )
+                {
+                    ( void ) OTA_Resume();
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+        }
+        else if( ServiceHost_ProcessLoop( MQTT_PROCESS_LOOP_TIMEOUT_MS ) != ServiceHostSuccess )
+        {
+            LogWarn( ( "The connection to the broker dropped; reconnecting." ) );
+
+            ( void ) ServiceHost_Disconnect();
+            connected = false;
+
+            /* The agent would time out its requests while disconnected. */
+            suspendOta();
+        }
+        else
+        {
+            nowMs = Clock_GetTimeMs();
+
+            if( ( nowMs - lastShadowReportMs ) >= SHADOW_REPORT_INTERVAL_MS )
+            {
+                reportShadow( nowMs - startMs );
+                lastShadowReportMs = nowMs;
+            }
+
+            if( ( nowMs - lastDefenderReportMs ) >= DEFENDER_REPORT_INTERVAL_MS )
+            {
+                reportDefender();
+                lastDefenderReportMs = nowMs;
+            }
+        }
+
+        nowMs = Clock_GetTimeMs();
+    }
+
+    if( connected == true )
+    {
+        ( void ) ServiceHost_Disconnect();
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void logServiceMetrics( const char * pName,
+                               const ServiceHostService_t * pService )
+{
+    ServiceHostServiceMetrics_t metrics;
+
+    if( ( pService != NULL ) && ( ServiceHost_GetServiceMetrics( pService, &metrics ) == ServiceHostSuccess ) )
+    {
+        LogInfo( ( "Service %s: Sent=%u, Rejected=%u, Acknowledged=%u, Delivered=%u, Dropped=%u, Inflight=%u",
+                   pName,
+                   ( unsigned int ) metrics.publishesSent,
+                   ( unsigned int ) metrics.publishesRejected,
+                   ( unsigned int ) metrics.pubacksReceived,
+                   ( unsigned int ) metrics.messagesDelivered,
+                   ( unsigned int ) metrics.messagesDropped,
+                   ( unsigned int ) metrics.inflight ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry point of demo.
+ *
+ * The demo creates the service host and registers the shadow, Defender and
+ * OTA services with it, then starts the OTA agent and runs the connection
+ * shared by the services until #DEMO_RUN_TIME_MS elapsed.
+ */
+int main( int argc,
+          char ** argv )
+{
+    int returnStatus = EXIT_SUCCESS;
+    bool hostInitialized = false;
+    bool otaThreadStarted = false;
+    OtaErr_t otaRet = OtaErrNone;
+    OtaInterfaces_t otaInterfaces;
+    pthread_t otaThreadHandle;
+
+    ( void ) argc;
+    ( void ) argv;
+
+    LogInfo( ( "Service host demo, Application version %u.%u.%u",
+               appFirmwareVersion.u.x.major,
+               appFirmwareVersion.u.x.minor,
+               appFirmwareVersion.u.x.build ) );
+
+    returnStatus = initializeHost();
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        hostInitialized = true;
+        returnStatus = registerServices();
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        setOtaInterfaces( &otaInterfaces );
+
+        otaRet = OTA_Init( &otaBuffer,
+                           &otaInterfaces,
+                           ( const uint8_t * ) ( THING_NAME ),
+                           otaAppCallback );
+
+        if( otaRet != OtaErrNone )
+        {
+            LogError( ( "Failed to initialize OTA Agent, exiting = %u.", otaRet ) );
+            returnStatus = EXIT_FAILURE;
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        if( pthread_create( &otaThreadHandle, NULL, otaThread, NULL ) != 0 )
+        {
+            LogError( ( "Failed to create OTA thread: errno=%s", strerror( errno ) ) );
+            returnStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            otaThreadStarted = true;
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        returnStatus = runServices();
+    }
+
+    if( otaThreadStarted == true )
+    {
+        /* The agent unsubscribes through the host while it stops, so the
+         * host is deinitialized after the agent thread ended. */
+        ( void ) OTA_Shutdown( 0 );
+        ( void ) pthread_join( otaThreadHandle, NULL );
+
+        #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+            /* No more files are verified once the OTA thread has exited. */
+            otaPal_FreeSignerKeyCache();
+        #endif
+    }
+
+    if( hostInitialized == true )
+    {
+        LogInfo( ( "Shadow reports sent: %u, Defender reports sent: %u.",
+                   ( unsigned int ) shadowReportCount,
+                   ( unsigned int ) defenderReportCount ) );
+        logServiceMetrics( "shadow", pShadowService );
+        logServiceMetrics( "defender", pDefenderService );
+        logServiceMetrics( "ota", pOtaService );
+
+        ServiceHost_Deinit();
+    }
+
+    return returnStatus;
+}
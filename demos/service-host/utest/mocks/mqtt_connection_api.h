@@ -0,0 +1,65 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_connection_api.h
+ * @brief This file is used to generate mocks for the functions of the MQTT
+ * connection used by the service host. Mocking mqtt_connection.h itself
+ * would mock the functions the service host does not use as well.
+ */
+
+#ifndef MQTT_CONNECTION_API_H_
+#define MQTT_CONNECTION_API_H_
+
+#include "mqtt_connection.h"
+
+extern MqttConnectionStatus_t MqttConnection_Create( MqttConnection_t ** ppConnection,
+                                                     const MqttConnectionConfig_t * pConfig,
+                                                     const MqttConnectionBuffers_t * pBuffers );
+
+extern MqttConnectionStatus_t MqttConnection_Connect( MqttConnection_t * pConnection );
+
+extern MqttConnectionStatus_t MqttConnection_Disconnect( MqttConnection_t * pConnection );
+
+extern MqttConnectionStatus_t MqttConnection_Subscribe( MqttConnection_t * pConnection,
+                                                        const char * pTopicFilter,
+                                                        uint16_t topicFilterLength );
+
+extern MqttConnectionStatus_t MqttConnection_Unsubscribe( MqttConnection_t * pConnection,
+                                                          const char * pTopicFilter,
+                                                          uint16_t topicFilterLength );
+
+extern MqttConnectionStatus_t MqttConnection_PublishWithId( MqttConnection_t * pConnection,
+                                                            const MQTTPublishInfo_t * pPublishInfo,
+                                                            uint16_t * pOutPacketId );
+
+extern MqttConnectionStatus_t MqttConnection_ProcessLoop( MqttConnection_t * pConnection,
+                                                          uint32_t timeoutMs );
+
+extern bool MqttConnection_IsConnected( const MqttConnection_t * pConnection );
+
+extern MqttConnectionStatus_t MqttConnection_GetMetrics( const MqttConnection_t * pConnection,
+                                                         MqttConnectionMetrics_t * pMetrics );
+
+extern void MqttConnection_Destroy( MqttConnection_t * pConnection );
+
+#endif /* ifndef MQTT_CONNECTION_API_H_ */
@@ -0,0 +1,957 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "service_host.h"
+
+#include "mock_mqtt_connection_api.h"
+
+/* The topic filters of the tests. */
+#define SHADOW_FILTER          "$aws/things/thing/shadow/update/+"
+#define DEFENDER_FILTER        "$aws/things/thing/defender/metrics/json/#"
+#define SHARED_FILTER          "$aws/things/thing/jobs/+/get/accepted"
+
+/* Topics matching them, or none of them. */
+#define SHADOW_TOPIC           "$aws/things/thing/shadow/update/accepted"
+#define DEFENDER_TOPIC         "$aws/things/thing/defender/metrics/json/rejected"
+#define SHARED_TOPIC           "$aws/things/thing/jobs/job1/get/accepted"
+#define UNMATCHED_TOPIC        "$aws/things/other/shadow/update/accepted"
+
+/* The length of a string literal. */
+#define LITERAL_LENGTH( x )    ( ( uint16_t ) ( sizeof( x ) - 1U ) )
+
+/* The quota of the services of the tests. */
+#define MAX_INFLIGHT           ( 2U )
+
+/* The number of payloads recorded by #recordMessage. */
+#define RECORD_LENGTH          ( 16U )
+
+/* The number of yields after which a wait for the dispatch threads gives up. */
+#define MAX_WAIT_YIELDS        ( 10000000U )
+
+/**
+ * @brief The messages a subscription of the tests received, passed as the
+ * context of its callback.
+ */
+typedef struct MessageRecord
+{
+    uint32_t count;                        /* The number of messages received. */
+    ServiceHostService_t * pService;       /* The service of the last message. */
+    char firstBytes[ RECORD_LENGTH + 1U ]; /* The first byte of the payload of each message, in order. */
+} MessageRecord_t;
+
+/* The connection returned by #MqttConnection_Create_capture. */
+static uint8_t connectionMemory;
+#define HOST_CONNECTION    ( ( MqttConnection_t * ) &connectionMemory )
+
+/* The MQTT context passed to the event callback. */
+static MQTTContext_t mqttContext;
+
+/* The configuration and buffers given to #ServiceHost_Init. */
+static MqttConnectionConfig_t config;
+static MqttConnectionBuffers_t buffers;
+
+/* The event callback the host gave to the connection. */
+static MQTTEventCallback_t hostEventCallback = NULL;
+
+/* The context the host gave to the connection. */
+static void * pHostUserContext = NULL;
+
+/* The status returned by #MqttConnection_Create_capture. */
+static MqttConnectionStatus_t createStatus = MqttConnectionSuccess;
+
+/* The status returned by #MqttConnection_Subscribe_count. */
+static MqttConnectionStatus_t subscribeStatus = MqttConnectionSuccess;
+
+/* Whether the broker is connected. */
+static bool connected = false;
+
+/* Whether #MqttConnection_Connect_session starts a clean session. */
+static bool cleanSession = true;
+
+/* The clean sessions started. */
+static uint32_t sessionsStarted = 0U;
+
+/* The SUBSCRIBEs and UNSUBSCRIBEs sent, and the topic filter of the last. */
+static uint32_t subscribeCount = 0U;
+static uint32_t unsubscribeCount = 0U;
+static const char * pLastTopicFilter = NULL;
+static uint16_t lastTopicFilterLength = 0U;
+
+/* The packet identifier of the next publish sent. */
+static uint16_t nextPacketId = 1U;
+
+/* The packet received by the next call to #MqttConnection_ProcessLoop. */
+static MQTTPacketInfo_t * pPendingPacket = NULL;
+static MQTTDeserializedInfo_t * pPendingDeserializedInfo = NULL;
+
+/* Whether #blockingMessage holds its dispatch thread, and whether it does. */
+static bool blockDispatch = false;
+static bool dispatchBlocked = false;
+
+/* The services of the tests. */
+static ServiceHostService_t * pShadowService = NULL;
+static ServiceHostService_t * pDefenderService = NULL;
+
+/* The messages received by the subscriptions of the tests. */
+static MessageRecord_t shadowRecord;
+static MessageRecord_t defenderRecord;
+
+/* A payload too large to be held for a service. */
+static uint8_t largePayload[ SERVICE_HOST_MESSAGE_SIZE ];
+
+/**
+ * @brief Used as the callback of #MqttConnection_Create to capture the
+ * event callback of the host.
+ */
+static MqttConnectionStatus_t MqttConnection_Create_capture( MqttConnection_t ** ppConnection,
+                                                             const MqttConnectionConfig_t * pConfig,
+                                                             const MqttConnectionBuffers_t * pBuffers,
+                                                             int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_NOT_NULL( ppConnection );
+    TEST_ASSERT_NOT_NULL( pConfig );
+    TEST_ASSERT_EQUAL_PTR( &buffers, pBuffers );
+
+    hostEventCallback = pConfig->eventCallback;
+    pHostUserContext = pConfig->pUserContext;
+
+    if( createStatus == MqttConnectionSuccess )
+    {
+        *ppConnection = HOST_CONNECTION;
+    }
+
+    return createStatus;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_Connect to connect the
+ * broker, starting a clean session if #cleanSession is set.
+ */
+static MqttConnectionStatus_t MqttConnection_Connect_session( MqttConnection_t * pConnection,
+                                                              int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+
+    connected = true;
+
+    if( cleanSession == true )
+    {
+        sessionsStarted++;
+    }
+
+    return MqttConnectionSuccess;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_Disconnect to disconnect
+ * the broker.
+ */
+static MqttConnectionStatus_t MqttConnection_Disconnect_session( MqttConnection_t * pConnection,
+                                                                 int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+
+    connected = false;
+
+    return MqttConnectionSuccess;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_Subscribe to count the
+ * SUBSCRIBEs.
+ */
+static MqttConnectionStatus_t MqttConnection_Subscribe_count( MqttConnection_t * pConnection,
+                                                              const char * pTopicFilter,
+                                                              uint16_t topicFilterLength,
+                                                              int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+    TEST_ASSERT_TRUE( connected );
+
+    subscribeCount++;
+    pLastTopicFilter = pTopicFilter;
+    lastTopicFilterLength = topicFilterLength;
+
+    return subscribeStatus;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_Unsubscribe to count the
+ * UNSUBSCRIBEs.
+ */
+static MqttConnectionStatus_t MqttConnection_Unsubscribe_count( MqttConnection_t * pConnection,
+                                                                const char * pTopicFilter,
+                                                                uint16_t topicFilterLength,
+                                                                int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+    TEST_ASSERT_TRUE( connected );
+
+    unsubscribeCount++;
+    pLastTopicFilter = pTopicFilter;
+    lastTopicFilterLength = topicFilterLength;
+
+    return MqttConnectionSuccess;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_PublishWithId to send the
+ * publishes with increasing packet identifiers while the broker is
+ * connected, and to queue them otherwise.
+ */
+static MqttConnectionStatus_t MqttConnection_PublishWithId_send( MqttConnection_t * pConnection,
+                                                                 const MQTTPublishInfo_t * pPublishInfo,
+                                                                 uint16_t * pOutPacketId,
+                                                                 int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+    TEST_ASSERT_NOT_NULL( pPublishInfo );
+    TEST_ASSERT_NOT_NULL( pOutPacketId );
+
+    if( connected == true )
+    {
+        *pOutPacketId = nextPacketId;
+        nextPacketId++;
+    }
+    else
+    {
+        *pOutPacketId = 0U;
+    }
+
+    return MqttConnectionSuccess;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_ProcessLoop to give the
+ * pending packet, if any, to the event callback of the host.
+ */
+static MqttConnectionStatus_t MqttConnection_ProcessLoop_receive( MqttConnection_t * pConnection,
+                                                                  uint32_t timeoutMs,
+                                                                  int numCalls )
+{
+    ( void ) timeoutMs;
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+
+    if( pPendingPacket != NULL )
+    {
+        hostEventCallback( &mqttContext, pPendingPacket, pPendingDeserializedInfo );
+        pPendingPacket = NULL;
+        pPendingDeserializedInfo = NULL;
+    }
+
+    return MqttConnectionSuccess;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_IsConnected.
+ */
+static bool MqttConnection_IsConnected_state( const MqttConnection_t * pConnection,
+                                              int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+
+    return connected;
+}
+
+/**
+ * @brief Used as the callback of #MqttConnection_GetMetrics to report the
+ * clean sessions started.
+ */
+static MqttConnectionStatus_t MqttConnection_GetMetrics_sessions( const MqttConnection_t * pConnection,
+                                                                  MqttConnectionMetrics_t * pMetrics,
+                                                                  int numCalls )
+{
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL_PTR( HOST_CONNECTION, pConnection );
+
+    ( void ) memset( pMetrics, 0x00, sizeof( MqttConnectionMetrics_t ) );
+    pMetrics->sessionsStarted = sessionsStarted;
+
+    return MqttConnectionSuccess;
+}
+
+/**
+ * @brief Used as the callback of the subscriptions to record their
+ * messages. It runs on the dispatch threads, so it does not assert.
+ */
+static void recordMessage( ServiceHostService_t * pService,
+                           const MQTTPublishInfo_t * pPublishInfo,
+                           void * pUserContext )
+{
+    MessageRecord_t * pRecord = ( MessageRecord_t * ) pUserContext;
+
+    if( ( pRecord->count < RECORD_LENGTH ) && ( pPublishInfo->payloadLength > 0U ) )
+    {
+        pRecord->firstBytes[ pRecord->count ] = ( ( const char * ) pPublishInfo->pPayload )[ 0 ];
+    }
+
+    pRecord->pService = pService;
+    pRecord->count++;
+}
+
+/**
+ * @brief Used as the callback of a subscription to hold its dispatch
+ * thread while #blockDispatch is set, then to record the message.
+ */
+static void blockingMessage( ServiceHostService_t * pService,
+                             const MQTTPublishInfo_t * pPublishInfo,
+                             void * pUserContext )
+{
+    uint32_t yields = 0U;
+
+    __atomic_store_n( &dispatchBlocked, true, __ATOMIC_SEQ_CST );
+
+    while( ( __atomic_load_n( &blockDispatch, __ATOMIC_SEQ_CST ) == true ) && ( yields < MAX_WAIT_YIELDS ) )
+    {
+        ( void ) sched_yield();
+        yields++;
+    }
+
+    __atomic_store_n( &dispatchBlocked, false, __ATOMIC_SEQ_CST );
+
+    recordMessage( pService, pPublishInfo, pUserContext );
+}
+
+/**
+ * @brief Receive a PUBLISH from the broker in #ServiceHost_ProcessLoop.
+ */
+static void receivePublish( const char * pTopicName,
+                            const void * pPayload,
+                            size_t payloadLength )
+{
+    MQTTPacketInfo_t packetInfo;
+    MQTTDeserializedInfo_t deserializedInfo;
+    MQTTPublishInfo_t publishInfo;
+
+    ( void ) memset( &packetInfo, 0x00, sizeof( packetInfo ) );
+    ( void ) memset( &deserializedInfo, 0x00, sizeof( deserializedInfo ) );
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+
+    publishInfo.qos = MQTTQoS0;
+    publishInfo.pTopicName = pTopicName;
+    publishInfo.topicNameLength = ( uint16_t ) strlen( pTopicName );
+    publishInfo.pPayload = pPayload;
+    publishInfo.payloadLength = payloadLength;
+
+    packetInfo.type = MQTT_PACKET_TYPE_PUBLISH;
+    deserializedInfo.pPublishInfo = &publishInfo;
+
+    pPendingPacket = &packetInfo;
+    pPendingDeserializedInfo = &deserializedInfo;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_ProcessLoop( 0U ) );
+}
+
+/**
+ * @brief Receive the PUBACK of a publish in #ServiceHost_ProcessLoop.
+ */
+static void receivePuback( uint16_t packetId )
+{
+    MQTTPacketInfo_t packetInfo;
+    MQTTDeserializedInfo_t deserializedInfo;
+
+    ( void ) memset( &packetInfo, 0x00, sizeof( packetInfo ) );
+    ( void ) memset( &deserializedInfo, 0x00, sizeof( deserializedInfo ) );
+
+    packetInfo.type = MQTT_PACKET_TYPE_PUBACK;
+    deserializedInfo.packetIdentifier = packetId;
+
+    pPendingPacket = &packetInfo;
+    pPendingDeserializedInfo = &deserializedInfo;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_ProcessLoop( 0U ) );
+}
+
+/**
+ * @brief Wait for the dispatch thread of a service to deliver a number of
+ * messages, and return the counters of the service.
+ */
+static ServiceHostServiceMetrics_t waitForDeliveries( const ServiceHostService_t * pService,
+                                                      uint32_t messagesDelivered )
+{
+    ServiceHostServiceMetrics_t metrics;
+    uint32_t yields = 0U;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_GetServiceMetrics( pService, &metrics ) );
+
+    while( ( metrics.messagesDelivered < messagesDelivered ) && ( yields < MAX_WAIT_YIELDS ) )
+    {
+        ( void ) sched_yield();
+        yields++;
+        TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_GetServiceMetrics( pService, &metrics ) );
+    }
+
+    TEST_ASSERT_EQUAL( messagesDelivered, metrics.messagesDelivered );
+
+    return metrics;
+}
+
+/**
+ * @brief Wait for #blockingMessage to hold or release its dispatch thread.
+ */
+static void waitForBlocked( bool blocked )
+{
+    uint32_t yields = 0U;
+
+    while( ( __atomic_load_n( &dispatchBlocked, __ATOMIC_SEQ_CST ) != blocked ) && ( yields < MAX_WAIT_YIELDS ) )
+    {
+        ( void ) sched_yield();
+        yields++;
+    }
+
+    TEST_ASSERT_EQUAL( blocked, __atomic_load_n( &dispatchBlocked, __ATOMIC_SEQ_CST ) );
+}
+
+/**
+ * @brief Read the counters of a service.
+ */
+static ServiceHostServiceMetrics_t getMetrics( const ServiceHostService_t * pService )
+{
+    ServiceHostServiceMetrics_t metrics;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_GetServiceMetrics( pService, &metrics ) );
+
+    return metrics;
+}
+
+/**
+ * @brief Send a publish of a service.
+ */
+static ServiceHostStatus_t publish( ServiceHostService_t * pService )
+{
+    MQTTPublishInfo_t publishInfo;
+
+    ( void ) memset( &publishInfo, 0x00, sizeof( publishInfo ) );
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = SHADOW_TOPIC;
+    publishInfo.topicNameLength = LITERAL_LENGTH( SHADOW_TOPIC );
+    publishInfo.pPayload = "{}";
+    publishInfo.payloadLength = 2U;
+
+    return ServiceHost_Publish( pService, &publishInfo );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( &config, 0x00, sizeof( config ) );
+    ( void ) memset( &buffers, 0x00, sizeof( buffers ) );
+    ( void ) memset( &shadowRecord, 0x00, sizeof( shadowRecord ) );
+    ( void ) memset( &defenderRecord, 0x00, sizeof( defenderRecord ) );
+
+    hostEventCallback = NULL;
+    pHostUserContext = NULL;
+    createStatus = MqttConnectionSuccess;
+    subscribeStatus = MqttConnectionSuccess;
+    connected = false;
+    cleanSession = true;
+    sessionsStarted = 0U;
+    subscribeCount = 0U;
+    unsubscribeCount = 0U;
+    pLastTopicFilter = NULL;
+    lastTopicFilterLength = 0U;
+    nextPacketId = 1U;
+    pPendingPacket = NULL;
+    pPendingDeserializedInfo = NULL;
+    blockDispatch = false;
+    dispatchBlocked = false;
+
+    MqttConnection_Create_Stub( MqttConnection_Create_capture );
+    MqttConnection_Connect_Stub( MqttConnection_Connect_session );
+    MqttConnection_Disconnect_Stub( MqttConnection_Disconnect_session );
+    MqttConnection_Subscribe_Stub( MqttConnection_Subscribe_count );
+    MqttConnection_Unsubscribe_Stub( MqttConnection_Unsubscribe_count );
+    MqttConnection_PublishWithId_Stub( MqttConnection_PublishWithId_send );
+    MqttConnection_ProcessLoop_Stub( MqttConnection_ProcessLoop_receive );
+    MqttConnection_IsConnected_Stub( MqttConnection_IsConnected_state );
+    MqttConnection_GetMetrics_Stub( MqttConnection_GetMetrics_sessions );
+    MqttConnection_Destroy_Ignore();
+
+    /* The host routes the packets itself, so these are replaced. */
+    config.eventCallback = NULL;
+    config.pUserContext = &shadowRecord;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Init( &config, &buffers ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_RegisterService( "shadow", MAX_INFLIGHT, &pShadowService ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_RegisterService( "defender", MAX_INFLIGHT, &pDefenderService ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* Release a dispatch thread left blocked by a failed test, so that it
+     * can be joined. */
+    __atomic_store_n( &blockDispatch, false, __ATOMIC_SEQ_CST );
+
+    ServiceHost_Deinit();
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #ServiceHost_Init creates the connection with the event
+ * callback of the host in place of the one configured.
+ */
+void test_ServiceHost_Init_Replaces_Event_Callback( void )
+{
+    TEST_ASSERT_NOT_NULL( hostEventCallback );
+    TEST_ASSERT_NULL( pHostUserContext );
+
+    /* The host is initialized once. */
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_Init( &config, &buffers ) );
+}
+
+/**
+ * @brief Test that #ServiceHost_Init fails when the connection cannot be
+ * created, and that the host is not initialized then.
+ */
+void test_ServiceHost_Init_Connection_Failure( void )
+{
+    ServiceHostService_t * pService = NULL;
+
+    ServiceHost_Deinit();
+
+    createStatus = MqttConnectionFailed;
+    TEST_ASSERT_EQUAL( ServiceHostFailed, ServiceHost_Init( &config, &buffers ) );
+
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_RegisterService( "shadow", MAX_INFLIGHT, &pService ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_Connect() );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_Disconnect() );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_ProcessLoop( 0U ) );
+}
+
+/**
+ * @brief Test that the functions of the host reject the invalid parameters.
+ */
+void test_ServiceHost_Invalid_Parameters( void )
+{
+    ServiceHostService_t * pService = NULL;
+    ServiceHostServiceMetrics_t metrics;
+
+    /* A service the host did not register, which is never dereferenced. */
+    ServiceHostService_t * pUnregistered = ( ServiceHostService_t * ) &defenderRecord;
+
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_Init( NULL, &buffers ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_Init( &config, NULL ) );
+
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_RegisterService( NULL, MAX_INFLIGHT, &pService ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_RegisterService( "jobs", 0U, &pService ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_RegisterService( "jobs", MAX_INFLIGHT, NULL ) );
+
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Subscribe( NULL, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Subscribe( pUnregistered, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Subscribe( pShadowService, NULL, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, 0U, recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), NULL, &shadowRecord ) );
+
+    /* A subscription is made once. */
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+
+    /* Only a subscription that was made is removed. */
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Unsubscribe( pDefenderService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Unsubscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &defenderRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter,
+                       ServiceHost_Unsubscribe( pShadowService, NULL, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_Publish( NULL, NULL ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_Publish( pShadowService, NULL ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, publish( pUnregistered ) );
+
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_GetServiceMetrics( NULL, &metrics ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_GetServiceMetrics( pUnregistered, &metrics ) );
+    TEST_ASSERT_EQUAL( ServiceHostBadParameter, ServiceHost_GetServiceMetrics( pShadowService, NULL ) );
+}
+
+/**
+ * @brief Test that no more than #SERVICE_HOST_MAX_SERVICES services are
+ * registered.
+ */
+void test_ServiceHost_RegisterService_No_Memory( void )
+{
+    ServiceHostService_t * pService = NULL;
+    uint32_t i = 0U;
+
+    /* Two services are registered by setUp. */
+    for( i = 2U; i < SERVICE_HOST_MAX_SERVICES; i++ )
+    {
+        TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_RegisterService( "jobs", MAX_INFLIGHT, &pService ) );
+    }
+
+    TEST_ASSERT_EQUAL( ServiceHostNoMemory, ServiceHost_RegisterService( "ota", MAX_INFLIGHT, &pService ) );
+}
+
+/**
+ * @brief Test that each incoming message is given to the callback of the
+ * service whose topic filter it matches, with the context of the
+ * subscription, and to no other.
+ */
+void test_ServiceHost_Routes_Messages_To_Subscribed_Service( void )
+{
+    ServiceHostServiceMetrics_t metrics;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pDefenderService, DEFENDER_FILTER, LITERAL_LENGTH( DEFENDER_FILTER ), recordMessage, &defenderRecord ) );
+
+    receivePublish( SHADOW_TOPIC, "s", 1U );
+    receivePublish( DEFENDER_TOPIC, "d", 1U );
+    receivePublish( DEFENDER_TOPIC, "e", 1U );
+
+    ( void ) waitForDeliveries( pShadowService, 1U );
+    metrics = waitForDeliveries( pDefenderService, 2U );
+
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDropped );
+    TEST_ASSERT_EQUAL( 1U, shadowRecord.count );
+    TEST_ASSERT_EQUAL_PTR( pShadowService, shadowRecord.pService );
+    TEST_ASSERT_EQUAL_STRING( "s", shadowRecord.firstBytes );
+    TEST_ASSERT_EQUAL( 2U, defenderRecord.count );
+    TEST_ASSERT_EQUAL_PTR( pDefenderService, defenderRecord.pService );
+    TEST_ASSERT_EQUAL_STRING( "de", defenderRecord.firstBytes );
+}
+
+/**
+ * @brief Test that a message matching no subscription is given to no
+ * service, and that a removed subscription is not matched.
+ */
+void test_ServiceHost_Ignores_Unmatched_Messages( void )
+{
+    ServiceHostServiceMetrics_t metrics;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+
+    /* The messages are queued within the process loop, so none is held once
+     * it returns. */
+    receivePublish( UNMATCHED_TOPIC, "u", 1U );
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDelivered );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDropped );
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Unsubscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    receivePublish( SHADOW_TOPIC, "s", 1U );
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDelivered );
+    TEST_ASSERT_EQUAL( 0U, shadowRecord.count );
+}
+
+/**
+ * @brief Test that the messages of a service are delivered in the order they
+ * were received.
+ */
+void test_ServiceHost_Delivers_Messages_In_Order( void )
+{
+    const char * pPayloads = "0123456789";
+    uint32_t i = 0U;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+
+    /* Each message is received once the previous one is delivered, so that
+     * the queue of the service does not fill. */
+    for( i = 0U; i < 10U; i++ )
+    {
+        receivePublish( SHADOW_TOPIC, &pPayloads[ i ], 1U );
+        ( void ) waitForDeliveries( pShadowService, i + 1U );
+    }
+
+    TEST_ASSERT_EQUAL_STRING( pPayloads, shadowRecord.firstBytes );
+}
+
+/**
+ * @brief Test that a topic filter shared by two services is subscribed to
+ * once, that its messages are given to both, and that it is unsubscribed
+ * from once neither is subscribed to it.
+ */
+void test_ServiceHost_Shares_Topic_Filter( void )
+{
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Connect() );
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( 1U, subscribeCount );
+    TEST_ASSERT_EQUAL( LITERAL_LENGTH( SHARED_FILTER ), lastTopicFilterLength );
+    TEST_ASSERT_EQUAL_MEMORY( SHARED_FILTER, pLastTopicFilter, lastTopicFilterLength );
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pDefenderService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), recordMessage, &defenderRecord ) );
+    TEST_ASSERT_EQUAL( 1U, subscribeCount );
+
+    receivePublish( SHARED_TOPIC, "j", 1U );
+    ( void ) waitForDeliveries( pShadowService, 1U );
+    ( void ) waitForDeliveries( pDefenderService, 1U );
+    TEST_ASSERT_EQUAL_PTR( pShadowService, shadowRecord.pService );
+    TEST_ASSERT_EQUAL_PTR( pDefenderService, defenderRecord.pService );
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Unsubscribe( pShadowService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( 0U, unsubscribeCount );
+
+    /* The service left subscribed still gets the messages. */
+    receivePublish( SHARED_TOPIC, "k", 1U );
+    ( void ) waitForDeliveries( pDefenderService, 2U );
+    TEST_ASSERT_EQUAL( 1U, shadowRecord.count );
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Unsubscribe( pDefenderService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), recordMessage, &defenderRecord ) );
+    TEST_ASSERT_EQUAL( 1U, unsubscribeCount );
+    TEST_ASSERT_EQUAL_MEMORY( SHARED_FILTER, pLastTopicFilter, lastTopicFilterLength );
+}
+
+/**
+ * @brief Test that the topic filters subscribed to while the broker is
+ * disconnected are subscribed to once connected, once each, and again only
+ * when the broker starts a clean session.
+ */
+void test_ServiceHost_Connect_Subscribes_Topic_Filters( void )
+{
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pDefenderService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), recordMessage, &defenderRecord ) );
+    TEST_ASSERT_EQUAL( 0U, subscribeCount );
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Connect() );
+    TEST_ASSERT_EQUAL( 2U, subscribeCount );
+
+    /* A resumed session keeps the subscriptions. */
+    cleanSession = false;
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Disconnect() );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Connect() );
+    TEST_ASSERT_EQUAL( 2U, subscribeCount );
+
+    /* A clean session does not. */
+    cleanSession = true;
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Disconnect() );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Connect() );
+    TEST_ASSERT_EQUAL( 4U, subscribeCount );
+}
+
+/**
+ * @brief Test that a failed SUBSCRIBE removes the subscription, so that its
+ * messages are not delivered and it can be made again.
+ */
+void test_ServiceHost_Subscribe_Failure( void )
+{
+    ServiceHostServiceMetrics_t metrics;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Connect() );
+
+    subscribeStatus = MqttConnectionFailed;
+    TEST_ASSERT_EQUAL( ServiceHostFailed,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+
+    receivePublish( SHADOW_TOPIC, "s", 1U );
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDelivered );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDropped );
+
+    subscribeStatus = MqttConnectionSuccess;
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( 2U, subscribeCount );
+}
+
+/**
+ * @brief Test that a service has at most its quota of publishes awaiting
+ * their PUBACK, that a PUBACK releases the quota of its service only, and
+ * that the queued publishes and a clean session do not count.
+ */
+void test_ServiceHost_Publish_Quota( void )
+{
+    ServiceHostServiceMetrics_t metrics;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Connect() );
+
+    /* Packet IDs 1 and 2 are the shadow's, 3 is the Defender's. */
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, publish( pShadowService ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, publish( pShadowService ) );
+    TEST_ASSERT_EQUAL( ServiceHostQuotaExceeded, publish( pShadowService ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, publish( pDefenderService ) );
+
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 2U, metrics.publishesSent );
+    TEST_ASSERT_EQUAL( 1U, metrics.publishesRejected );
+    TEST_ASSERT_EQUAL( MAX_INFLIGHT, metrics.inflight );
+
+    receivePuback( 3U );
+    TEST_ASSERT_EQUAL( ServiceHostQuotaExceeded, publish( pShadowService ) );
+    metrics = getMetrics( pDefenderService );
+    TEST_ASSERT_EQUAL( 0U, metrics.inflight );
+    TEST_ASSERT_EQUAL( 1U, metrics.pubacksReceived );
+
+    receivePuback( 1U );
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 1U, metrics.inflight );
+    TEST_ASSERT_EQUAL( 1U, metrics.pubacksReceived );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, publish( pShadowService ) );
+
+    /* A clean session drops the publishes awaiting their PUBACK. */
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Disconnect() );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Connect() );
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 0U, metrics.inflight );
+
+    /* The publishes queued while disconnected await no PUBACK. */
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Disconnect() );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, publish( pShadowService ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, publish( pShadowService ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, publish( pShadowService ) );
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 0U, metrics.inflight );
+    TEST_ASSERT_EQUAL( 6U, metrics.publishesSent );
+}
+
+/**
+ * @brief Test that the messages received while the queue of a service is
+ * full are dropped for that service only.
+ */
+void test_ServiceHost_Drops_Messages_Of_Full_Queue( void )
+{
+    ServiceHostServiceMetrics_t metrics;
+    uint32_t i = 0U;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), blockingMessage, &shadowRecord ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pDefenderService, SHARED_FILTER, LITERAL_LENGTH( SHARED_FILTER ), recordMessage, &defenderRecord ) );
+
+    /* The message being delivered keeps its entry of the queue. */
+    __atomic_store_n( &blockDispatch, true, __ATOMIC_SEQ_CST );
+    receivePublish( SHARED_TOPIC, "j", 1U );
+    waitForBlocked( true );
+
+    /* The other service delivers each message before the next is received,
+     * so that its own queue does not fill. */
+    ( void ) waitForDeliveries( pDefenderService, 1U );
+
+    for( i = 0U; i < SERVICE_HOST_QUEUE_LENGTH; i++ )
+    {
+        receivePublish( SHARED_TOPIC, "j", 1U );
+        ( void ) waitForDeliveries( pDefenderService, i + 2U );
+    }
+
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 1U, metrics.messagesDropped );
+    metrics = getMetrics( pDefenderService );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDropped );
+
+    __atomic_store_n( &blockDispatch, false, __ATOMIC_SEQ_CST );
+    metrics = waitForDeliveries( pShadowService, SERVICE_HOST_QUEUE_LENGTH );
+    TEST_ASSERT_EQUAL( 1U, metrics.messagesDropped );
+}
+
+/**
+ * @brief Test that a message too large to be held for a service is dropped.
+ */
+void test_ServiceHost_Drops_Oversized_Message( void )
+{
+    ServiceHostServiceMetrics_t metrics;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+
+    ( void ) memset( largePayload, 'l', sizeof( largePayload ) );
+    receivePublish( SHADOW_TOPIC, largePayload, sizeof( largePayload ) );
+    metrics = getMetrics( pShadowService );
+    TEST_ASSERT_EQUAL( 1U, metrics.messagesDropped );
+
+    /* The largest message that fits is delivered whole. */
+    receivePublish( SHADOW_TOPIC, largePayload, sizeof( largePayload ) - LITERAL_LENGTH( SHADOW_TOPIC ) );
+    metrics = waitForDeliveries( pShadowService, 1U );
+    TEST_ASSERT_EQUAL( 1U, metrics.messagesDropped );
+    TEST_ASSERT_EQUAL_STRING( "l", shadowRecord.firstBytes );
+}
+
+/**
+ * @brief Test that #ServiceHost_Deinit removes the subscriptions from the
+ * subscription manager, so that a host initialized again matches none.
+ */
+void test_ServiceHost_Deinit_Removes_Subscriptions( void )
+{
+    ServiceHostService_t * pService = NULL;
+    ServiceHostServiceMetrics_t metrics;
+
+    TEST_ASSERT_EQUAL( ServiceHostSuccess,
+                       ServiceHost_Subscribe( pShadowService, SHADOW_FILTER, LITERAL_LENGTH( SHADOW_FILTER ), recordMessage, &shadowRecord ) );
+
+    ServiceHost_Deinit();
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_Init( &config, &buffers ) );
+    TEST_ASSERT_EQUAL( ServiceHostSuccess, ServiceHost_RegisterService( "shadow", MAX_INFLIGHT, &pService ) );
+
+    receivePublish( SHADOW_TOPIC, "s", 1U );
+    metrics = getMetrics( pService );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDelivered );
+    TEST_ASSERT_EQUAL( 0U, metrics.messagesDropped );
+    TEST_ASSERT_EQUAL( 0U, shadowRecord.count );
+}
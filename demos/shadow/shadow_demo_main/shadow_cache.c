@@ -0,0 +1,965 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_cache.c
+ * @brief A local copy of the desired and reported state of a shadow.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+
+/* JSON API header. */
+#include "core_json.h"
+
+/* Single pass extraction of JSON keys. */
+#include "json_extract.h"
+
+#include "shadow_cache.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Maximum number of nested objects flattened into keys. Deeper
+ * objects are kept whole as their JSON text.
+ */
+#define MAX_OBJECT_DEPTH    ( 8U )
+
+/**
+ * @brief Index of the version among the keys read from a message.
+ */
+#define KEY_VERSION         ( 0U )
+
+/**
+ * @brief Index of the desired state, or of the delta, among the keys read
+ * from a message.
+ */
+#define KEY_DESIRED         ( 1U )
+
+/**
+ * @brief Index of the reported state among the keys read from a message.
+ */
+#define KEY_REPORTED        ( 2U )
+
+/**
+ * @brief Number of keys read from a message carrying the whole state.
+ */
+#define KEY_COUNT           ( 3U )
+
+/**
+ * @brief Number of keys read from a delta: the version and the delta.
+ */
+#define DELTA_KEY_COUNT     ( 2U )
+
+/**
+ * @brief A value of the cached state.
+ */
+typedef struct CacheEntry
+{
+    ShadowCacheSection_t section;                     /**< @brief Section of the value. */
+    JSONTypes_t type;                                 /**< @brief JSON type of the value. */
+    size_t keyLength;                                 /**< @brief Length of #CacheEntry_t.key. */
+    size_t valueLength;                               /**< @brief Length of #CacheEntry_t.value. */
+    char key[ SHADOW_CACHE_KEY_MAX_LENGTH ];          /**< @brief Flattened key of the value. */
+    char value[ SHADOW_CACHE_VALUE_MAX_LENGTH + 1U ]; /**< @brief The value, without the quotes of a string, terminated. */
+} CacheEntry_t;
+
+/**
+ * @brief An object being flattened into the cache.
+ */
+typedef struct ObjectFrame
+{
+    const char * pObject; /**< @brief The object, from its opening brace. */
+    size_t objectLength;  /**< @brief Length of the object. */
+    size_t start;         /**< @brief Start index for #JSON_Iterate. */
+    size_t next;          /**< @brief Next index for #JSON_Iterate. */
+    size_t pathLength;    /**< @brief Length of the key of the object, with its trailing '.'. */
+} ObjectFrame_t;
+
+/**
+ * @brief An object of a new reported state being compared with the cache.
+ */
+typedef struct DiffFrame
+{
+    ObjectFrame_t object; /**< @brief The object being walked. */
+    const char * pKey;    /**< @brief The key of the object in its parent; NULL for the whole state. */
+    size_t keyLength;     /**< @brief Length of #DiffFrame_t.pKey. */
+    bool isOpened;        /**< @brief The object was written to the document. */
+    bool hasMembers;      /**< @brief A member of the object was written to the document. */
+} DiffFrame_t;
+
+/**
+ * @brief A document being written to a buffer.
+ */
+typedef struct DiffWriter
+{
+    char * pBuffer;       /**< @brief The buffer. */
+    size_t bufferLength;  /**< @brief Length of #DiffWriter_t.pBuffer. */
+    size_t length;        /**< @brief Length of the document written. */
+    bool isOverflowed;    /**< @brief The document did not fit in the buffer. */
+} DiffWriter_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The values of the cached state, in no particular order.
+ */
+static CacheEntry_t entries[ SHADOW_CACHE_MAX_ENTRIES ];
+
+/**
+ * @brief Number of entries of #entries in use.
+ */
+static size_t entryCount = 0U;
+
+/**
+ * @brief Version of the shadow held by the cache.
+ */
+static uint32_t cachedVersion = 0U;
+
+/**
+ * @brief Whether #cachedVersion is the version of the shadow. It is not
+ * after a delete, since the shadow has no version until it is updated again.
+ */
+static bool versionKnown = false;
+
+/**
+ * @brief Whether the cache must be refreshed with a `/get` request.
+ */
+static bool resyncNeeded = true;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Validate a message and find its version and state.
+ *
+ * @param[in] pPayload The payload of the message.
+ * @param[in] payloadLength Length of @p pPayload.
+ * @param[in,out] pQueries The keys to find, the version first.
+ * @param[in] queryCount Number of entries of @p pQueries.
+ * @param[out] pOutVersion The version of the message.
+ *
+ * @return #ShadowCacheSuccess if the message is valid and has a version;
+ * #ShadowCacheBadParameter otherwise.
+ */
+static ShadowCacheStatus_t parseMessage( const char * pPayload,
+                                         size_t payloadLength,
+                                         JSONExtractQuery_t * pQueries,
+                                         size_t queryCount,
+                                         uint32_t * pOutVersion );
+
+/**
+ * @brief Check whether the key of an entry is a key, the key of an object
+ * holding it, or the key of a value it holds.
+ *
+ * @param[in] pEntry The entry.
+ * @param[in] section The section of the key.
+ * @param[in] pKey The flattened key.
+ * @param[in] keyLength Length of @p pKey.
+ *
+ * @return true if a value of one key replaces the value of the other.
+ */
+static bool keysOverlap( const CacheEntry_t * pEntry,
+                         ShadowCacheSection_t section,
+                         const char * pKey,
+                         size_t keyLength );
+
+/**
+ * @brief Remove an entry of the cache, and the entries below its key or
+ * above it, whose value it replaces.
+ *
+ * @param[in] section The section of the entry.
+ * @param[in] pKey The flattened key of the entry.
+ * @param[in] keyLength Length of @p pKey.
+ */
+static void removeEntries( ShadowCacheSection_t section,
+                           const char * pKey,
+                           size_t keyLength );
+
+/**
+ * @brief Store a value in the cache, replacing the value of the same key.
+ *
+ * @param[in] section The section of the value.
+ * @param[in] pKey The flattened key of the value.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[in] pPair The value; a null value removes the key.
+ *
+ * @return #ShadowCacheSuccess or #ShadowCacheNoSpace.
+ */
+static ShadowCacheStatus_t storeValue( ShadowCacheSection_t section,
+                                       const char * pKey,
+                                       size_t keyLength,
+                                       const JSONPair_t * pPair );
+
+/**
+ * @brief Flatten an object into a section of the cache.
+ *
+ * @param[in] section The section.
+ * @param[in] pObject The object.
+ * @param[in] objectLength Length of @p pObject.
+ *
+ * @return #ShadowCacheSuccess, or #ShadowCacheNoSpace if any value did not
+ * fit; the values that fit are stored.
+ */
+static ShadowCacheStatus_t mergeObject( ShadowCacheSection_t section,
+                                        const char * pObject,
+                                        size_t objectLength );
+
+/**
+ * @brief Replace the cache with the whole state of a message.
+ *
+ * @param[in] pPayload The payload of the message.
+ * @param[in] payloadLength Length of @p pPayload.
+ * @param[in,out] pQueries The version, desired state and reported state to
+ * find.
+ *
+ * @return #ShadowCacheSuccess, #ShadowCacheStale, #ShadowCacheBadParameter
+ * or #ShadowCacheNoSpace.
+ */
+static ShadowCacheStatus_t replaceState( const char * pPayload,
+                                         size_t payloadLength,
+                                         JSONExtractQuery_t * pQueries );
+
+/**
+ * @brief Append text to a document, unless it no longer fits.
+ *
+ * @param[in,out] pWriter The document.
+ * @param[in] pText The text.
+ * @param[in] textLength Length of @p pText.
+ */
+static void appendText( DiffWriter_t * pWriter,
+                        const char * pText,
+                        size_t textLength );
+
+/**
+ * @brief Write the key of a member of an object, after the comma separating
+ * it from the previous member.
+ *
+ * @param[in,out] pWriter The document.
+ * @param[in,out] pFrame The object.
+ * @param[in] pKey The key of the member.
+ * @param[in] keyLength Length of @p pKey.
+ */
+static void beginMember( DiffWriter_t * pWriter,
+                         DiffFrame_t * pFrame,
+                         const char * pKey,
+                         size_t keyLength );
+
+/**
+ * @brief Write the objects being walked that are not written yet, so that a
+ * member can be written to the innermost one.
+ *
+ * @param[in,out] pWriter The document.
+ * @param[in,out] pFrames The objects being walked, the whole state first.
+ * @param[in] depth Number of entries of @p pFrames.
+ */
+static void openFrames( DiffWriter_t * pWriter,
+                        DiffFrame_t * pFrames,
+                        size_t depth );
+
+/**
+ * @brief Check whether a value of a new reported state differs from the
+ * cache, and mark the entries it replaces.
+ *
+ * @param[in] pKey The flattened key of the value.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[in] pPair The value.
+ * @param[in,out] pTouched The flags of the entries replaced by the new state.
+ *
+ * @return true if the value is not the cached value of its key.
+ */
+static bool isReportedValueChanged( const char * pKey,
+                                    size_t keyLength,
+                                    const JSONPair_t * pPair,
+                                    bool * pTouched );
+
+/**
+ * @brief Write a null value for each cached member of an object that the new
+ * reported state no longer holds.
+ *
+ * @param[in,out] pWriter The document.
+ * @param[in,out] pFrames The objects being walked, the whole state first.
+ * @param[in] depth Number of entries of @p pFrames; the innermost object is
+ * the one done.
+ * @param[in] pPath The flattened key of the object, with its trailing '.'.
+ * @param[in,out] pTouched The flags of the entries replaced by the new state.
+ */
+static void writeRemovals( DiffWriter_t * pWriter,
+                           DiffFrame_t * pFrames,
+                           size_t depth,
+                           const char * pPath,
+                           bool * pTouched );
+
+/*-----------------------------------------------------------*/
+
+static ShadowCacheStatus_t parseMessage( const char * pPayload,
+                                         size_t payloadLength,
+                                         JSONExtractQuery_t * pQueries,
+                                         size_t queryCount,
+                                         uint32_t * pOutVersion )
+{
+    ShadowCacheStatus_t status = ShadowCacheBadParameter;
+
+    if( ( pPayload != NULL ) &&
+        ( JSON_Validate( pPayload, payloadLength ) == JSONSuccess ) )
+    {
+        /* The state is optional, so only the version must be found. */
+        ( void ) JSONExtract_Search( pPayload, payloadLength, pQueries, queryCount );
+
+        if( ( pQueries[ KEY_VERSION ].pValue != NULL ) &&
+            ( pQueries[ KEY_VERSION ].valueType == JSONNumber ) )
+        {
+            *pOutVersion = ( uint32_t ) strtoul( pQueries[ KEY_VERSION ].pValue, NULL, 10 );
+            status = ShadowCacheSuccess;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool keysOverlap( const CacheEntry_t * pEntry,
+                         ShadowCacheSection_t section,
+                         const char * pKey,
+                         size_t keyLength )
+{
+    size_t shorterLength = ( pEntry->keyLength < keyLength ) ? pEntry->keyLength : keyLength;
+
+    /* The same key, or a key of an object holding the other. */
+    return ( pEntry->section == section ) &&
+           ( memcmp( pEntry->key, pKey, shorterLength ) == 0 ) &&
+           ( ( pEntry->keyLength == keyLength ) ||
+             ( ( pEntry->keyLength > keyLength ) && ( pEntry->key[ keyLength ] == '.' ) ) ||
+             ( ( pEntry->keyLength < keyLength ) && ( pKey[ pEntry->keyLength ] == '.' ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void removeEntries( ShadowCacheSection_t section,
+                           const char * pKey,
+                           size_t keyLength )
+{
+    size_t i = 0U;
+
+    while( i < entryCount )
+    {
+        if( keysOverlap( &( entries[ i ] ), section, pKey, keyLength ) == true )
+        {
+            /* The order of the entries does not matter, so the last one
+             * fills the hole. */
+            entryCount--;
+            entries[ i ] = entries[ entryCount ];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static ShadowCacheStatus_t storeValue( ShadowCacheSection_t section,
+                                       const char * pKey,
+                                       size_t keyLength,
+                                       const JSONPair_t * pPair )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    CacheEntry_t * pEntry = NULL;
+
+    /* The previous value is dropped even if the new one does not fit, as it
+     * is no longer the state of the shadow. */
+    removeEntries( section, pKey, keyLength );
+
+    if( pPair->jsonType == JSONNull )
+    {
+        /* A null value deletes the key. */
+    }
+    else if( ( pPair->valueLength > SHADOW_CACHE_VALUE_MAX_LENGTH ) ||
+             ( entryCount == SHADOW_CACHE_MAX_ENTRIES ) )
+    {
+        status = ShadowCacheNoSpace;
+    }
+    else
+    {
+        pEntry = &( entries[ entryCount ] );
+        pEntry->section = section;
+        pEntry->type = pPair->jsonType;
+        pEntry->keyLength = keyLength;
+        pEntry->valueLength = pPair->valueLength;
+        ( void ) memcpy( pEntry->key, pKey, keyLength );
+        ( void ) memcpy( pEntry->value, pPair->value, pPair->valueLength );
+        pEntry->value[ pPair->valueLength ] = '\0';
+        entryCount++;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static ShadowCacheStatus_t mergeObject( ShadowCacheSection_t section,
+                                        const char * pObject,
+                                        size_t objectLength )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    ObjectFrame_t frames[ MAX_OBJECT_DEPTH ];
+    char path[ SHADOW_CACHE_KEY_MAX_LENGTH ];
+    JSONPair_t pair = { 0 };
+    ObjectFrame_t * pFrame = NULL;
+    size_t depth = 1U, keyLength;
+
+    frames[ 0 ].pObject = pObject;
+    frames[ 0 ].objectLength = objectLength;
+    frames[ 0 ].start = 0U;
+    frames[ 0 ].next = 0U;
+    frames[ 0 ].pathLength = 0U;
+
+    /* Walk the object depth first, without recursing, building the
+     * flattened key of each value in path. */
+    while( depth > 0U )
+    {
+        pFrame = &( frames[ depth - 1U ] );
+
+        if( ( JSON_Iterate( pFrame->pObject, pFrame->objectLength,
+                            &( pFrame->start ), &( pFrame->next ),
+                            &( pair ) ) != JSONSuccess ) ||
+            ( pair.key == NULL ) )
+        {
+            /* The object is done, or is not an object; resume its parent. */
+            depth--;
+        }
+        else if( ( pFrame->pathLength + pair.keyLength ) >= SHADOW_CACHE_KEY_MAX_LENGTH )
+        {
+            /* The key is kept below the maximum length so that an object
+             * also has room for its trailing '.'. */
+            status = ShadowCacheNoSpace;
+        }
+        else
+        {
+            ( void ) memcpy( &( path[ pFrame->pathLength ] ), pair.key, pair.keyLength );
+            keyLength = pFrame->pathLength + pair.keyLength;
+
+            if( ( pair.jsonType == JSONObject ) && ( depth < MAX_OBJECT_DEPTH ) )
+            {
+                /* An object is merged key by key, so that a delta only
+                 * changes the keys it holds. */
+                path[ keyLength ] = '.';
+                frames[ depth ].pObject = pair.value;
+                frames[ depth ].objectLength = pair.valueLength;
+                frames[ depth ].start = 0U;
+                frames[ depth ].next = 0U;
+                frames[ depth ].pathLength = keyLength + 1U;
+                depth++;
+            }
+            else if( storeValue( section, path, keyLength, &( pair ) ) != ShadowCacheSuccess )
+            {
+                status = ShadowCacheNoSpace;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static ShadowCacheStatus_t replaceState( const char * pPayload,
+                                         size_t payloadLength,
+                                         JSONExtractQuery_t * pQueries )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess, mergeStatus = ShadowCacheSuccess;
+    uint32_t version = 0U;
+
+    status = parseMessage( pPayload, payloadLength, pQueries, KEY_COUNT, &( version ) );
+
+    /* The whole state of the current version is applied again, as a delta
+     * of that version may have arrived first. */
+    if( ( status == ShadowCacheSuccess ) && ( versionKnown == true ) && ( version < cachedVersion ) )
+    {
+        status = ShadowCacheStale;
+    }
+
+    if( status == ShadowCacheSuccess )
+    {
+        entryCount = 0U;
+
+        if( pQueries[ KEY_DESIRED ].valueType == JSONObject )
+        {
+            mergeStatus = mergeObject( ShadowCacheDesired,
+                                       pQueries[ KEY_DESIRED ].pValue,
+                                       pQueries[ KEY_DESIRED ].valueLength );
+        }
+
+        if( pQueries[ KEY_REPORTED ].valueType == JSONObject )
+        {
+            if( mergeObject( ShadowCacheReported,
+                             pQueries[ KEY_REPORTED ].pValue,
+                             pQueries[ KEY_REPORTED ].valueLength ) != ShadowCacheSuccess )
+            {
+                mergeStatus = ShadowCacheNoSpace;
+            }
+        }
+
+        cachedVersion = version;
+        versionKnown = true;
+        resyncNeeded = ( mergeStatus != ShadowCacheSuccess );
+        status = mergeStatus;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void appendText( DiffWriter_t * pWriter,
+                        const char * pText,
+                        size_t textLength )
+{
+    if( ( pWriter->isOverflowed == false ) &&
+        ( textLength <= ( pWriter->bufferLength - pWriter->length ) ) )
+    {
+        ( void ) memcpy( &( pWriter->pBuffer[ pWriter->length ] ), pText, textLength );
+        pWriter->length += textLength;
+    }
+    else
+    {
+        pWriter->isOverflowed = true;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void beginMember( DiffWriter_t * pWriter,
+                         DiffFrame_t * pFrame,
+                         const char * pKey,
+                         size_t keyLength )
+{
+    if( pFrame->hasMembers == true )
+    {
+        appendText( pWriter, ",", 1U );
+    }
+
+    appendText( pWriter, "\"", 1U );
+    appendText( pWriter, pKey, keyLength );
+    appendText( pWriter, "\":", 2U );
+    pFrame->hasMembers = true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void openFrames( DiffWriter_t * pWriter,
+                        DiffFrame_t * pFrames,
+                        size_t depth )
+{
+    size_t i;
+
+    /* An object is only written once a member of it changes, so that the
+     * objects left as they are do not appear in the document. */
+    for( i = 1U; i < depth; i++ )
+    {
+        if( pFrames[ i ].isOpened == false )
+        {
+            beginMember( pWriter, &( pFrames[ i - 1U ] ), pFrames[ i ].pKey, pFrames[ i ].keyLength );
+            appendText( pWriter, "{", 1U );
+            pFrames[ i ].isOpened = true;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isReportedValueChanged( const char * pKey,
+                                    size_t keyLength,
+                                    const JSONPair_t * pPair,
+                                    bool * pTouched )
+{
+    /* The cache holds no null, which removes a key, so a null is only a
+     * change if the key is in the cache. */
+    bool isChanged = ( pPair->jsonType != JSONNull );
+    size_t i;
+
+    for( i = 0U; i < entryCount; i++ )
+    {
+        if( keysOverlap( &( entries[ i ] ), ShadowCacheReported, pKey, keyLength ) == true )
+        {
+            /* The value replaces this entry, so the entry is not removed,
+             * whether or not it is the same value. An entry of the same key
+             * is the only entry the value overlaps. */
+            pTouched[ i ] = true;
+            isChanged = ( entries[ i ].keyLength != keyLength ) ||
+                        ( entries[ i ].type != pPair->jsonType ) ||
+                        ( entries[ i ].valueLength != pPair->valueLength ) ||
+                        ( memcmp( entries[ i ].value, pPair->value, pPair->valueLength ) != 0 );
+        }
+    }
+
+    return isChanged;
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeRemovals( DiffWriter_t * pWriter,
+                           DiffFrame_t * pFrames,
+                           size_t depth,
+                           const char * pPath,
+                           bool * pTouched )
+{
+    DiffFrame_t * pFrame = &( pFrames[ depth - 1U ] );
+    size_t pathLength = pFrame->object.pathLength;
+    size_t i, j, childLength;
+    const CacheEntry_t * pEntry = NULL;
+
+    /* The entries below the objects that the new state holds are already
+     * touched, as those objects are done first; an entry left here is below
+     * a member of this object that is gone. */
+    for( i = 0U; i < entryCount; i++ )
+    {
+        pEntry = &( entries[ i ] );
+
+        if( ( pTouched[ i ] == false ) &&
+            ( pEntry->section == ShadowCacheReported ) &&
+            ( pEntry->keyLength > pathLength ) &&
+            ( memcmp( pEntry->key, pPath, pathLength ) == 0 ) )
+        {
+            childLength = 0U;
+
+            while( ( ( pathLength + childLength ) < pEntry->keyLength ) &&
+                   ( pEntry->key[ pathLength + childLength ] != '.' ) )
+            {
+                childLength++;
+            }
+
+            openFrames( pWriter, pFrames, depth );
+            beginMember( pWriter, pFrame, &( pEntry->key[ pathLength ] ), childLength );
+            appendText( pWriter, "null", 4U );
+
+            /* A null removes the whole member, so the other entries below
+             * it are not written again. */
+            for( j = i; j < entryCount; j++ )
+            {
+                if( keysOverlap( &( entries[ j ] ), ShadowCacheReported,
+                                 pEntry->key, pathLength + childLength ) == true )
+                {
+                    pTouched[ j ] = true;
+                }
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void ShadowCache_Init( void )
+{
+    entryCount = 0U;
+    cachedVersion = 0U;
+    versionKnown = false;
+    resyncNeeded = true;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_ApplyDocuments( const char * pPayload,
+                                                size_t payloadLength )
+{
+    /* The state after the update is under "current". */
+    JSONExtractQuery_t queries[ KEY_COUNT ] =
+    {
+        { "current.version",        sizeof( "current.version" ) - 1U,        NULL, 0U, JSONInvalid },
+        { "current.state.desired",  sizeof( "current.state.desired" ) - 1U,  NULL, 0U, JSONInvalid },
+        { "current.state.reported", sizeof( "current.state.reported" ) - 1U, NULL, 0U, JSONInvalid }
+    };
+
+    return replaceState( pPayload, payloadLength, queries );
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_ApplyDelta( const char * pPayload,
+                                            size_t payloadLength )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    uint32_t version = 0U;
+    JSONExtractQuery_t queries[ DELTA_KEY_COUNT ] =
+    {
+        { "version", sizeof( "version" ) - 1U, NULL, 0U, JSONInvalid },
+        { "state",   sizeof( "state" ) - 1U,   NULL, 0U, JSONInvalid }
+    };
+
+    status = parseMessage( pPayload, payloadLength, queries, DELTA_KEY_COUNT, &( version ) );
+
+    if( ( status == ShadowCacheSuccess ) && ( versionKnown == true ) && ( version <= cachedVersion ) )
+    {
+        status = ShadowCacheStale;
+    }
+
+    if( status == ShadowCacheSuccess )
+    {
+        if( queries[ KEY_DESIRED ].valueType == JSONObject )
+        {
+            status = mergeObject( ShadowCacheDesired,
+                                  queries[ KEY_DESIRED ].pValue,
+                                  queries[ KEY_DESIRED ].valueLength );
+        }
+
+        /* A delta only holds the desired keys that differ from the reported
+         * state, so it cannot fill in the versions missed. */
+        if( ( status == ShadowCacheSuccess ) &&
+            ( ( resyncNeeded == true ) ||
+              ( ( versionKnown == true ) && ( version != ( cachedVersion + 1U ) ) ) ) )
+        {
+            status = ShadowCacheVersionGap;
+        }
+
+        cachedVersion = version;
+        versionKnown = true;
+        resyncNeeded = ( status != ShadowCacheSuccess );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_ApplyGet( const char * pPayload,
+                                          size_t payloadLength )
+{
+    JSONExtractQuery_t queries[ KEY_COUNT ] =
+    {
+        { "version",        sizeof( "version" ) - 1U,        NULL, 0U, JSONInvalid },
+        { "state.desired",  sizeof( "state.desired" ) - 1U,  NULL, 0U, JSONInvalid },
+        { "state.reported", sizeof( "state.reported" ) - 1U, NULL, 0U, JSONInvalid }
+    };
+
+    return replaceState( pPayload, payloadLength, queries );
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_ApplyDeleted( const char * pPayload,
+                                              size_t payloadLength )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    uint32_t version = 0U;
+    JSONExtractQuery_t versionKey = { "version", sizeof( "version" ) - 1U, NULL, 0U, JSONInvalid };
+
+    status = parseMessage( pPayload, payloadLength, &( versionKey ), 1U, &( version ) );
+
+    if( ( status == ShadowCacheSuccess ) && ( versionKnown == true ) && ( version < cachedVersion ) )
+    {
+        status = ShadowCacheStale;
+    }
+
+    /* The shadow is empty until its next update, whose version is taken as
+     * it comes. */
+    if( status == ShadowCacheSuccess )
+    {
+        entryCount = 0U;
+        cachedVersion = version;
+        versionKnown = false;
+        resyncNeeded = false;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_Get( ShadowCacheSection_t section,
+                                     const char * pKey,
+                                     size_t keyLength,
+                                     const char ** pOutValue,
+                                     size_t * pOutValueLength )
+{
+    ShadowCacheStatus_t status = ShadowCacheNotFound;
+    size_t i;
+
+    if( ( pKey == NULL ) || ( pOutValue == NULL ) || ( pOutValueLength == NULL ) )
+    {
+        status = ShadowCacheBadParameter;
+    }
+    else
+    {
+        for( i = 0U; ( i < entryCount ) && ( status == ShadowCacheNotFound ); i++ )
+        {
+            if( ( entries[ i ].section == section ) &&
+                ( entries[ i ].keyLength == keyLength ) &&
+                ( memcmp( entries[ i ].key, pKey, keyLength ) == 0 ) )
+            {
+                *pOutValue = entries[ i ].value;
+                *pOutValueLength = entries[ i ].valueLength;
+                status = ShadowCacheSuccess;
+            }
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ShadowCache_GetVersion( void )
+{
+    return cachedVersion;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ShadowCache_IsResyncNeeded( void )
+{
+    return resyncNeeded;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowCacheStatus_t ShadowCache_DiffReported( const char * pState,
+                                              size_t stateLength,
+                                              char * pBuffer,
+                                              size_t bufferLength,
+                                              size_t * pOutLength )
+{
+    ShadowCacheStatus_t status = ShadowCacheSuccess;
+    DiffFrame_t frames[ MAX_OBJECT_DEPTH ];
+    char path[ SHADOW_CACHE_KEY_MAX_LENGTH ];
+    bool touched[ SHADOW_CACHE_MAX_ENTRIES ] = { false };
+    DiffWriter_t writer;
+    JSONPair_t pair = { 0 };
+    DiffFrame_t * pFrame = NULL;
+    size_t depth = 1U, keyLength;
+
+    if( ( pState == NULL ) || ( stateLength == 0U ) || ( pState[ 0 ] != '{' ) ||
+        ( pBuffer == NULL ) || ( pOutLength == NULL ) ||
+        ( JSON_Validate( pState, stateLength ) != JSONSuccess ) )
+    {
+        status = ShadowCacheBadParameter;
+    }
+    else
+    {
+        writer.pBuffer = pBuffer;
+        writer.bufferLength = bufferLength;
+        writer.length = 0U;
+        writer.isOverflowed = false;
+
+        frames[ 0 ].object.pObject = pState;
+        frames[ 0 ].object.objectLength = stateLength;
+        frames[ 0 ].object.start = 0U;
+        frames[ 0 ].object.next = 0U;
+        frames[ 0 ].object.pathLength = 0U;
+        frames[ 0 ].pKey = NULL;
+        frames[ 0 ].keyLength = 0U;
+        frames[ 0 ].isOpened = true;
+        frames[ 0 ].hasMembers = false;
+        appendText( &writer, "{", 1U );
+
+        /* Walk the new state as mergeObject does, so that its flattened keys
+         * are the keys of the cache, and write a value only where it
+         * differs. */
+        while( ( depth > 0U ) && ( status == ShadowCacheSuccess ) )
+        {
+            pFrame = &( frames[ depth - 1U ] );
+
+            if( ( JSON_Iterate( pFrame->object.pObject, pFrame->object.objectLength,
+                                &( pFrame->object.start ), &( pFrame->object.next ),
+                                &( pair ) ) != JSONSuccess ) ||
+                ( pair.key == NULL ) )
+            {
+                /* The object is done; the cached members it no longer holds
+                 * are removed before it is closed. */
+                writeRemovals( &writer, frames, depth, path, touched );
+
+                if( pFrame->isOpened == true )
+                {
+                    appendText( &writer, "}", 1U );
+                }
+
+                depth--;
+            }
+            else if( ( pFrame->object.pathLength + pair.keyLength ) >= SHADOW_CACHE_KEY_MAX_LENGTH )
+            {
+                /* The key cannot be in the cache, so whether it changed is
+                 * not known. */
+                status = ShadowCacheNoSpace;
+            }
+            else
+            {
+                ( void ) memcpy( &( path[ pFrame->object.pathLength ] ), pair.key, pair.keyLength );
+                keyLength = pFrame->object.pathLength + pair.keyLength;
+
+                if( ( pair.jsonType == JSONObject ) && ( depth < MAX_OBJECT_DEPTH ) )
+                {
+                    path[ keyLength ] = '.';
+                    frames[ depth ].object.pObject = pair.value;
+                    frames[ depth ].object.objectLength = pair.valueLength;
+                    frames[ depth ].object.start = 0U;
+                    frames[ depth ].object.next = 0U;
+                    frames[ depth ].object.pathLength = keyLength + 1U;
+                    frames[ depth ].pKey = pair.key;
+                    frames[ depth ].keyLength = pair.keyLength;
+                    frames[ depth ].isOpened = false;
+                    frames[ depth ].hasMembers = false;
+                    depth++;
+                }
+                else if( isReportedValueChanged( path, keyLength, &( pair ), touched ) == true )
+                {
+                    openFrames( &writer, frames, depth );
+                    beginMember( &writer, pFrame, pair.key, pair.keyLength );
+
+                    /* The value of a string excludes its quotes. */
+                    if( pair.jsonType == JSONString )
+                    {
+                        appendText( &writer, "\"", 1U );
+                        appendText( &writer, pair.value, pair.valueLength );
+                        appendText( &writer, "\"", 1U );
+                    }
+                    else
+                    {
+                        appendText( &writer, pair.value, pair.valueLength );
+                    }
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+        }
+
+        if( ( status == ShadowCacheSuccess ) && ( writer.isOverflowed == true ) )
+        {
+            status = ShadowCacheNoSpace;
+        }
+
+        if( status == ShadowCacheSuccess )
+        {
+            *pOutLength = writer.length;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,223 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_cache.h
+ * @brief A local copy of the desired and reported state of a shadow.
+ *
+ * The cache follows the shadow from the messages of its topics, so the state
+ * is read from memory rather than with a `/get` request:
+ * - `/update/documents` and `/get/accepted` carry the whole state, which
+ * replaces the cache;
+ * - `/update/delta` carries the desired state that differs from the reported
+ * state, which is merged into the cached desired state;
+ * - `/delete/accepted` empties the cache.
+ *
+ * Each message carries the version of the shadow, so stale messages are
+ * ignored. Versions also count the updates that cause no delta, so the
+ * cache relies on `/update/documents` to follow them. When a delta skips a
+ * version, or the cache has never seen the whole state, the cache still
+ * applies the delta but asks for a `/get` through #ShadowCache_IsResyncNeeded.
+ * The cached reported state also gives the changes of a new reported state,
+ * so that an update only carries those, with #ShadowCache_DiffReported.
+ *
+ * Nested objects are flattened: the value of "color" in the desired object
+ * "light" is read with the key "light.color". An array is kept whole as its
+ * JSON text. The cache is not thread safe; it is meant to be used by the
+ * thread that processes the MQTT messages.
+ */
+
+#ifndef SHADOW_CACHE_H_
+#define SHADOW_CACHE_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of values held by the cache, desired and reported
+ * together.
+ */
+#ifndef SHADOW_CACHE_MAX_ENTRIES
+    #define SHADOW_CACHE_MAX_ENTRIES         ( 64U )
+#endif
+
+/**
+ * @brief Maximum length of the key of a value, with the keys of the objects
+ * holding it.
+ */
+#ifndef SHADOW_CACHE_KEY_MAX_LENGTH
+    #define SHADOW_CACHE_KEY_MAX_LENGTH      ( 64U )
+#endif
+
+/**
+ * @brief Maximum length of a value, without the quotes of a string.
+ */
+#ifndef SHADOW_CACHE_VALUE_MAX_LENGTH
+    #define SHADOW_CACHE_VALUE_MAX_LENGTH    ( 64U )
+#endif
+
+/**
+ * @brief Return codes of the shadow cache.
+ */
+typedef enum ShadowCacheStatus
+{
+    ShadowCacheSuccess = 0,  /**< @brief The message is applied, or the value is found. */
+    ShadowCacheStale,        /**< @brief The message is older than the cache and is ignored. */
+    ShadowCacheVersionGap,   /**< @brief The delta is applied, but versions were missed; a `/get` is needed. */
+    ShadowCacheBadParameter, /**< @brief The message is not a valid shadow document. */
+    ShadowCacheNoSpace,      /**< @brief A key or value does not fit in the cache; a `/get` is needed. */
+    ShadowCacheNotFound      /**< @brief The key is not in the cache. */
+} ShadowCacheStatus_t;
+
+/**
+ * @brief The sections of the state of a shadow.
+ */
+typedef enum ShadowCacheSection
+{
+    ShadowCacheDesired = 0, /**< @brief The desired state. */
+    ShadowCacheReported     /**< @brief The reported state. */
+} ShadowCacheSection_t;
+
+/**
+ * @brief Empty the cache, with the state of the shadow unknown until the
+ * next whole state.
+ */
+void ShadowCache_Init( void );
+
+/**
+ * @brief Replace the cache with the state of an `/update/documents` message.
+ *
+ * @param[in] pPayload The payload of the message.
+ * @param[in] payloadLength Length of @p pPayload.
+ *
+ * @return #ShadowCacheSuccess, #ShadowCacheStale, #ShadowCacheBadParameter
+ * or #ShadowCacheNoSpace.
+ */
+ShadowCacheStatus_t ShadowCache_ApplyDocuments( const char * pPayload,
+                                                size_t payloadLength );
+
+/**
+ * @brief Merge the desired state of an `/update/delta` message into the
+ * cache.
+ *
+ * @param[in] pPayload The payload of the message.
+ * @param[in] payloadLength Length of @p pPayload.
+ *
+ * @return #ShadowCacheSuccess, #ShadowCacheStale, #ShadowCacheVersionGap,
+ * #ShadowCacheBadParameter or #ShadowCacheNoSpace.
+ */
+ShadowCacheStatus_t ShadowCache_ApplyDelta( const char * pPayload,
+                                            size_t payloadLength );
+
+/**
+ * @brief Replace the cache with the state of a `/get/accepted` message.
+ *
+ * @param[in] pPayload The payload of the message.
+ * @param[in] payloadLength Length of @p pPayload.
+ *
+ * @return #ShadowCacheSuccess, #ShadowCacheStale, #ShadowCacheBadParameter
+ * or #ShadowCacheNoSpace.
+ */
+ShadowCacheStatus_t ShadowCache_ApplyGet( const char * pPayload,
+                                          size_t payloadLength );
+
+/**
+ * @brief Empty the cache after a `/delete/accepted` message.
+ *
+ * @param[in] pPayload The payload of the message.
+ * @param[in] payloadLength Length of @p pPayload.
+ *
+ * @return #ShadowCacheSuccess, #ShadowCacheStale or
+ * #ShadowCacheBadParameter.
+ */
+ShadowCacheStatus_t ShadowCache_ApplyDeleted( const char * pPayload,
+                                              size_t payloadLength );
+
+/**
+ * @brief Read a value of the cached state.
+ *
+ * @param[in] section The section of the state.
+ * @param[in] pKey The key of the value, with '.' separating the keys of
+ * nested objects.
+ * @param[in] keyLength Length of @p pKey.
+ * @param[out] pOutValue The value, without the quotes of a string, and
+ * terminated. It remains valid until the cache is next changed.
+ * @param[out] pOutValueLength Length of the value.
+ *
+ * @return #ShadowCacheSuccess, #ShadowCacheNotFound or
+ * #ShadowCacheBadParameter.
+ */
+ShadowCacheStatus_t ShadowCache_Get( ShadowCacheSection_t section,
+                                     const char * pKey,
+                                     size_t keyLength,
+                                     const char ** pOutValue,
+                                     size_t * pOutValueLength );
+
+/**
+ * @brief Get the version of the shadow held by the cache.
+ *
+ * @return The version; 0 if no message was applied.
+ */
+uint32_t ShadowCache_GetVersion( void );
+
+/**
+ * @brief Check whether the cache must be refreshed with a `/get` request.
+ *
+ * @return true if the cache has never seen the whole state, missed a
+ * version, or could not hold a message; false otherwise.
+ */
+bool ShadowCache_IsResyncNeeded( void );
+
+/**
+ * @brief Write the reported document that changes the cached reported state
+ * into a new one.
+ *
+ * The cached reported state follows `/update/documents`, so it is the last
+ * one the service accepted, and the document only holds the values that
+ * differ from it. A cached member missing from the new state is set to null,
+ * which removes it; for a nested object, only its changed members are
+ * written, within the object. Objects deeper than the cache flattens, and
+ * arrays, are compared and written whole.
+ *
+ * When the cache has never seen the whole state, the document holds every
+ * value of the new state but removes nothing.
+ *
+ * @param[in] pState The whole new reported state, a JSON object.
+ * @param[in] stateLength Length of @p pState.
+ * @param[out] pBuffer The buffer for the document, which is not terminated.
+ * @param[in] bufferLength Length of @p pBuffer.
+ * @param[out] pOutLength Length of the document; 2, for `{}`, when the state
+ * is unchanged.
+ *
+ * @return #ShadowCacheSuccess, #ShadowCacheBadParameter, or
+ * #ShadowCacheNoSpace if the document does not fit in @p pBuffer or a key
+ * does not fit in the cache.
+ */
+ShadowCacheStatus_t ShadowCache_DiffReported( const char * pState,
+                                              size_t stateLength,
+                                              char * pBuffer,
+                                              size_t bufferLength,
+                                              size_t * pOutLength );
+
+#endif /* ifndef SHADOW_CACHE_H_ */
@@ -34,25 +34,19 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 /* Shadow includes */
 #include "shadow_demo_helpers.h"
 
-/* POSIX includes. */
-#include <unistd.h>
-
-/* OpenSSL sockets transport implementation. */
-#include "openssl_posix.h"
-
-/*Include backoff algorithm header for retry logic.*/
-#include "backoff_algorithm.h"
-
 /* Clock for timer. */
 #include "clock.h"
 
+/* MQTT connection shared by the demos. */
+#include "mqtt_connection.h"
+
 
 /**
  * These configuration settings are required to run the shadow demo.
@@ -86,30 +80,77 @@
 #endif
 
 /**
- * @brief Length of MQTT server host name.
+ * @brief Set to 1 to keep the outgoing publishes in a file, so that the
+ * publishes not acknowledged when the demo stops are resent by its next run
+ * if the broker resumes the session.
  */
-#define AWS_IOT_ENDPOINT_LENGTH      ( ( uint16_t ) ( sizeof( AWS_IOT_ENDPOINT ) - 1 ) )
+#ifndef PERSIST_OUTGOING_PUBLISHES
+    #define PERSIST_OUTGOING_PUBLISHES    ( 0 )
+#endif
 
 /**
- * @brief Length of client identifier.
+ * @brief Path of the file keeping the outgoing publishes.
  */
-#define CLIENT_IDENTIFIER_LENGTH     ( ( uint16_t ) ( sizeof( CLIENT_IDENTIFIER ) - 1 ) )
+#ifndef OUTGOING_PUBLISH_STORE_PATH
+    #define OUTGOING_PUBLISH_STORE_PATH    "shadow_outgoing_publishes.log"
+#endif
 
 /**
- * @brief ALPN protocol name for AWS IoT MQTT.
- *
- * This will be used if the AWS_MQTT_PORT is configured as 443 for AWS IoT MQTT broker.
- * Please see more details about the ALPN protocol for AWS IoT MQTT endpoint
- * in the link below.
- * https://aws.amazon.com/blogs/iot/mqtt-with-tls-client-authentication-on-port-443-why-it-is-useful-and-how-it-works/
+ * @brief Size of the file keeping the outgoing publishes. Its log is compacted
+ * when full, so it must only hold the largest publishes of a full window.
+ */
+#ifndef OUTGOING_PUBLISH_STORE_SIZE
+    #define OUTGOING_PUBLISH_STORE_SIZE    ( 64U * 1024U )
+#endif
+
+/**
+ * @brief Maximum number of publishes queued while the connection to the
+ * broker is down.
  */
-#define ALPN_PROTOCOL_NAME           "\x0ex-amzn-mqtt-ca"
+#ifndef OFFLINE_PUBLISH_QUEUE_LENGTH
+    #define OFFLINE_PUBLISH_QUEUE_LENGTH    ( 16U )
+#endif
 
 /**
- * @brief Length of ALPN protocol name.
+ * @brief Maximum length of the topic and payload of a queued publish.
  */
-#define ALPN_PROTOCOL_NAME_LENGTH    ( ( uint16_t ) ( sizeof( ALPN_PROTOCOL_NAME ) - 1 ) )
+#ifndef OFFLINE_PUBLISH_SLOT_SIZE
+    #define OFFLINE_PUBLISH_SLOT_SIZE    ( NETWORK_BUFFER_SIZE )
+#endif
 
+/**
+ * @brief Maximum number of queued publishes sent after a reconnect before
+ * the PUBACKs received are processed.
+ */
+#ifndef OFFLINE_PUBLISH_DRAIN_BATCH_SIZE
+    #define OFFLINE_PUBLISH_DRAIN_BATCH_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Time spent receiving PUBACKs after each batch of queued publishes,
+ * in milliseconds.
+ */
+#ifndef OFFLINE_PUBLISH_DRAIN_INTERVAL_MS
+    #define OFFLINE_PUBLISH_DRAIN_INTERVAL_MS    ( 100U )
+#endif
+
+/**
+ * @brief Size of the buffer the publishes of a batch are serialized into,
+ * to be sent with a single transport write.
+ */
+#ifndef PUBLISH_BATCH_BUFFER_SIZE
+    #define PUBLISH_BATCH_BUFFER_SIZE    ( 4U * NETWORK_BUFFER_SIZE )
+#endif
+
+/**
+ * @brief Length of MQTT server host name.
+ */
+#define AWS_IOT_ENDPOINT_LENGTH      ( ( uint16_t ) ( sizeof( AWS_IOT_ENDPOINT ) - 1 ) )
+
+/**
+ * @brief Length of client identifier.
+ */
+#define CLIENT_IDENTIFIER_LENGTH     ( ( uint16_t ) ( sizeof( CLIENT_IDENTIFIER ) - 1 ) )
 
 /**
  * @brief The maximum number of retries for connecting to server.
@@ -135,14 +176,11 @@
 /**
  * @brief Maximum number of outgoing publishes maintained in the application
  * until an ack is received from the broker.
+ *
+ * The MQTT library keeps the state of as many outgoing publishes, so a larger
+ * window only takes effect with a larger #MQTT_STATE_ARRAY_MAX_COUNT.
  */
-#define MAX_OUTGOING_PUBLISHES              ( 5U )
-
-/**
- * @brief Invalid packet identifier for the MQTT packets. Zero is always an
- * invalid packet identifier as per MQTT 3.1.1 spec.
- */
-#define MQTT_PACKET_ID_INVALID              ( ( uint16_t ) 0U )
+#define MAX_OUTGOING_PUBLISHES              ( MQTT_STATE_ARRAY_MAX_COUNT )
 
 /**
  * @brief Timeout for MQTT_ProcessLoop function in milliseconds.
@@ -175,318 +213,332 @@
  */
 #define METRICS_STRING_LENGTH               ( ( uint16_t ) ( sizeof( METRICS_STRING ) - 1 ) )
 
-/*-----------------------------------------------------------*/
+#if ( REPORT_BATCHER_MAX_FIELDS > 32U )
+    #error "REPORT_BATCHER_MAX_FIELDS cannot exceed the 32 bits of a field mask."
+#endif
 
 /**
- * @brief Structure to keep the MQTT publish packets until an ack is received
- * for QoS1 publishes.
+ * @brief The start of a reported document, before its fields.
  */
-typedef struct PublishPackets
-{
-    /**
-     * @brief Packet identifier of the publish packet.
-     */
-    uint16_t packetId;
+#define REPORT_DOCUMENT_HEAD                "{\"state\":{\"reported\":{"
+
+/**
+ * @brief Length of #REPORT_DOCUMENT_HEAD.
+ */
+#define REPORT_DOCUMENT_HEAD_LENGTH         ( sizeof( REPORT_DOCUMENT_HEAD ) - 1U )
+
+/**
+ * @brief The end of a reported document, after its fields.
+ */
+#define REPORT_DOCUMENT_TAIL                "}},\"clientToken\":\"%06lu\"}"
+
+/**
+ * @brief Length of #REPORT_DOCUMENT_TAIL once the 6 digits of the client
+ * token replace the 5 characters of its format specifier.
+ */
+#define REPORT_DOCUMENT_TAIL_LENGTH         ( sizeof( REPORT_DOCUMENT_TAIL ) - 1U + 1U )
+
+/**
+ * @brief Length of a field in a reported document, besides its key and
+ * value: the quotes of the key, the colon and the separating comma.
+ */
+#define REPORT_FIELD_OVERHEAD_LENGTH        ( 4U )
+
+/**
+ * @brief Maximum length of a reported document, without its terminator.
+ */
+#define REPORT_DOCUMENT_MAX_LENGTH                                                          \
+    ( REPORT_DOCUMENT_HEAD_LENGTH + REPORT_DOCUMENT_TAIL_LENGTH +                           \
+      ( REPORT_BATCHER_MAX_FIELDS * ( REPORT_BATCHER_KEY_MAX_LENGTH +                       \
+                                      REPORT_BATCHER_VALUE_MAX_LENGTH + REPORT_FIELD_OVERHEAD_LENGTH ) ) )
 
-    /**
-     * @brief Publish info of the publish packet.
-     */
-    MQTTPublishInfo_t pubInfo;
-} PublishPackets_t;
+/**
+ * @brief Client tokens of the reports are the 6 digits printed by
+ * #REPORT_DOCUMENT_TAIL.
+ */
+#define REPORT_CLIENT_TOKEN_MODULUS         ( 1000000U )
 
 /*-----------------------------------------------------------*/
 
-/* Each compilation unit must define the NetworkContext struct. */
-struct NetworkContext
+/**
+ * @brief A field of the reported state held by the report batcher.
+ */
+typedef struct BatchedField
+{
+    char key[ REPORT_BATCHER_KEY_MAX_LENGTH ];     /**< @brief Key of the field; the entry is free if #BatchedField_t.keyLength is 0. */
+    uint16_t keyLength;                            /**< @brief Length of #BatchedField_t.key. */
+    char value[ REPORT_BATCHER_VALUE_MAX_LENGTH ]; /**< @brief Last JSON value set for the field. */
+    uint16_t valueLength;                          /**< @brief Length of #BatchedField_t.value. */
+    bool isPending;                                /**< @brief The value is not published yet. */
+} BatchedField_t;
+
+/**
+ * @brief A published report awaiting its response.
+ */
+typedef struct InFlightReport
 {
-    OpensslParams_t * pParams;
-};
+    uint32_t clientToken; /**< @brief Client token of the report. */
+    uint32_t fieldMask;   /**< @brief Bit i is set while the report holds the latest published value of #batchedFields[ i ]. */
+} InFlightReport_t;
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Packet Identifier generated when Subscribe request was sent to the broker;
- * it is used to match received Subscribe ACK to the transmitted subscribe.
+ * @brief The network buffer must remain valid for the lifetime of the MQTT context.
  */
-static uint16_t globalSubscribePacketIdentifier = 0U;
+static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
 
 /**
- * @brief Packet Identifier generated when Unsubscribe request was sent to the broker;
- * it is used to match received Unsubscribe ACK to the transmitted unsubscribe
- * request.
+ * @brief Entries of the window of the outgoing publishes, kept by the
+ * connection until their PUBACK.
  */
-static uint16_t globalUnsubscribePacketIdentifier = 0U;
+static PublishWindowEntry_t outgoingPublishEntries[ MAX_OUTGOING_PUBLISHES ];
 
 /**
- * @brief Array to keep the outgoing publish messages.
- * These stored outgoing publish messages are kept until a successful ack
- * is received.
+ * @brief Hash buckets of the window of the outgoing publishes.
  */
-static PublishPackets_t outgoingPublishPackets[ MAX_OUTGOING_PUBLISHES ] = { 0 };
+static uint16_t outgoingPublishBuckets[ PUBLISH_WINDOW_BUCKET_COUNT( MAX_OUTGOING_PUBLISHES ) ];
 
 /**
- * @brief The network buffer must remain valid for the lifetime of the MQTT context.
+ * @brief Entries of the queue of the publishes issued while the connection
+ * to the broker is down.
  */
-static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
+static PublishQueueEntry_t offlinePublishEntries[ OFFLINE_PUBLISH_QUEUE_LENGTH ];
 
 /**
- * @brief The MQTT context used for MQTT operation.
+ * @brief Copies of the topics and payloads of the queued publishes.
  */
-static MQTTContext_t mqttContext = { 0 };
+static uint8_t offlinePublishSlots[ OFFLINE_PUBLISH_QUEUE_LENGTH * OFFLINE_PUBLISH_SLOT_SIZE ];
 
 /**
- * @brief The network context used for Openssl operation.
+ * @brief The PUBLISH packets of a batch, serialized back to back.
  */
-static NetworkContext_t networkContext = { 0 };
+static uint8_t batchBuffer[ PUBLISH_BATCH_BUFFER_SIZE ];
 
 /**
- * @brief The parameters for Openssl operation.
+ * @brief The connection to the broker, created by the first call to
+ * #InitOfflinePublishQueue or #EstablishMqttSession.
  */
-static OpensslParams_t opensslParams = { 0 };
+static MqttConnection_t * pMqttConnection = NULL;
 
 /**
- * @brief The flag to indicate the mqtt session changed.
+ * @brief Callback registered when calling #EstablishMqttSession to get the
+ * incoming packets.
  */
-static bool mqttSessionEstablished = false;
+static MQTTEventCallback_t appEventCallback = NULL;
 
-/*-----------------------------------------------------------*/
+/**
+ * @brief The fields of the reported state held by the report batcher.
+ */
+static BatchedField_t batchedFields[ REPORT_BATCHER_MAX_FIELDS ];
 
 /**
- * @brief The random number generator to use for exponential backoff with
- * jitter retry logic.
- *
- * @return The generated random number.
+ * @brief The reports awaiting their response, oldest first.
  */
-static uint32_t generateRandomNumber();
+static InFlightReport_t inFlightReports[ REPORT_BATCHER_MAX_IN_FLIGHT ];
 
 /**
- * @brief Connect to MQTT broker with reconnection retries.
- *
- * If connection fails, retry is attempted after a timeout.
- * Timeout value will exponentially increase until maximum
- * timeout value is reached or the number of attempts are exhausted.
- *
- * @param[out] pNetworkContext The output parameter to return the created network context.
- *
- * @return EXIT_FAILURE on failure; EXIT_SUCCESS on successful connection.
+ * @brief Number of entries of #inFlightReports in use.
  */
-static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext );
+static size_t inFlightReportCount = 0U;
 
 /**
- * @brief Function to get the free index at which an outgoing publish
- * can be stored.
- *
- * @param[out] pIndex The output parameter to return the index at which an
- * outgoing publish message can be stored.
+ * @brief Time at which the oldest pending field was set.
+ */
+static uint32_t oldestPendingTimeMs = 0U;
+
+/**
+ * @brief A pending field is to be published without waiting for the
+ * thresholds.
+ */
+static bool priorityPending = false;
+
+/**
+ * @brief Client token of the next report.
+ */
+static uint32_t nextReportToken = 0U;
+
+/**
+ * @brief The `/update` topic the reports are published to.
+ */
+static const char * pReportTopic = NULL;
+
+/**
+ * @brief Length of #pReportTopic.
+ */
+static uint16_t reportTopicLength = 0U;
+
+/**
+ * @brief The reported document. It has static duration as it is kept by
+ * the window of the connection until the PUBACK is received.
+ */
+static char reportDocument[ REPORT_DOCUMENT_MAX_LENGTH + 1U ];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Give the incoming packets to the callback of #EstablishMqttSession.
  *
- * @return EXIT_FAILURE if no more publishes can be stored;
- * EXIT_SUCCESS if an index to store the next outgoing publish is obtained.
+ * @param[in] pMqttContext MQTT context pointer.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
  */
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex );
+static void forwardEventCallback( MQTTContext_t * pMqttContext,
+                                  MQTTPacketInfo_t * pPacketInfo,
+                                  MQTTDeserializedInfo_t * pDeserializedInfo );
 
 /**
- * @brief Function to clean up an outgoing publish at given index from the
- * #outgoingPublishPackets array.
+ * @brief Create #pMqttConnection, unless it already is.
  *
- * @param[in] index The index at which a publish message has to be cleaned up.
+ * @return EXIT_SUCCESS if the connection is created; EXIT_FAILURE otherwise.
  */
-static void cleanupOutgoingPublishAt( uint8_t index );
+static int32_t createConnection( void );
 
 /**
- * @brief Function to clean up all the outgoing publishes maintained in the
- * array.
+ * @brief Compute the length of the reported document of the pending fields.
+ *
+ * @return The length of the document; 0 if no field is pending.
  */
-static void cleanupOutgoingPublishes( void );
+static size_t getPendingReportLength( void );
 
 /**
- * @brief Function to clean up the publish packet with the given packet id.
+ * @brief Write the reported document of the pending fields to
+ * #reportDocument.
  *
- * @param[in] packetId Packet identifier of the packet to be cleaned up from
- * the array.
+ * @param[in] clientToken The client token of the document.
+ * @param[out] pFieldMask The fields written to the document.
+ *
+ * @return The length of the document.
  */
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId );
+static size_t serializePendingReport( uint32_t clientToken,
+                                      uint32_t * pFieldMask );
 
 /**
- * @brief Function to resend the publishes if a session is re-established with
- * the broker. This function handles the resending of the QoS1 publish packets,
- * which are maintained locally.
+ * @brief Remove an entry of #inFlightReports, keeping the others in order.
  *
- * @param[in] pMqttContext MQTT context pointer.
+ * @param[in] index The index of the entry.
  */
-static int handlePublishResend( MQTTContext_t * pMqttContext );
+static void removeInFlightReport( size_t index );
 
 /*-----------------------------------------------------------*/
 
-static uint32_t generateRandomNumber()
+static void forwardEventCallback( MQTTContext_t * pMqttContext,
+                                  MQTTPacketInfo_t * pPacketInfo,
+                                  MQTTDeserializedInfo_t * pDeserializedInfo )
 {
-    return( rand() );
+    if( appEventCallback != NULL )
+    {
+        appEventCallback( pMqttContext, pPacketInfo, pDeserializedInfo );
+    }
 }
 
 /*-----------------------------------------------------------*/
 
-static int connectToServerWithBackoffRetries( NetworkContext_t * pNetworkContext )
+static int32_t createConnection( void )
 {
     int returnStatus = EXIT_SUCCESS;
-    BackoffAlgorithmStatus_t backoffAlgStatus = BackoffAlgorithmSuccess;
-    OpensslStatus_t opensslStatus = OPENSSL_SUCCESS;
-    BackoffAlgorithmContext_t reconnectParams;
-    ServerInfo_t serverInfo;
-    OpensslCredentials_t opensslCredentials;
-    uint16_t nextRetryBackOff = 0U;
-    struct timespec tp;
-
-    /* Set the pParams member of the network context with desired transport. */
-    pNetworkContext->pParams = &opensslParams;
-
-    /* Initialize information to connect to the MQTT broker. */
-    serverInfo.pHostName = AWS_IOT_ENDPOINT;
-    serverInfo.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
-    serverInfo.port = AWS_MQTT_PORT;
-
-    /* Initialize credentials for establishing TLS session. */
-    ( void ) memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
-    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
-    opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
-    opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
-    opensslCredentials.sniHostName = AWS_IOT_ENDPOINT;
-
-    if( AWS_MQTT_PORT == 443 )
-    {
-        /* Pass the ALPN protocol name depending on the port being used.
-         * Please see more details about the ALPN protocol for AWS IoT MQTT endpoint
-         * in the link below.
-         * https://aws.amazon.com/blogs/iot/mqtt-with-tls-client-authentication-on-port-443-why-it-is-useful-and-how-it-works/
-         */
-        opensslCredentials.pAlpnProtos = ALPN_PROTOCOL_NAME;
-        opensslCredentials.alpnProtosLen = ALPN_PROTOCOL_NAME_LENGTH;
-    }
+    MqttConnectionConfig_t config;
+    MqttConnectionBuffers_t buffers;
 
-    /* Seed pseudo random number generator used in the demo for
-     * backoff period calculation when retrying failed network operations
-     * with broker. */
-
-    /* Get current time to seed pseudo random number generator. */
-    ( void ) clock_gettime( CLOCK_REALTIME, &tp );
-    /* Seed pseudo random number generator with nanoseconds. */
-    srand( tp.tv_nsec );
-
-    /* Initialize reconnect attempts and interval */
-    BackoffAlgorithm_InitializeParams( &reconnectParams,
-                                       CONNECTION_RETRY_BACKOFF_BASE_MS,
-                                       CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS,
-                                       CONNECTION_RETRY_MAX_ATTEMPTS );
-
-    /* Attempt to connect to MQTT broker. If connection fails, retry after
-     * a timeout. Timeout value will exponentially increase until maximum
-     * attempts are reached.
-     */
-    do
+    if( pMqttConnection == NULL )
     {
-        /* Establish a TLS session with the MQTT broker. This example connects
-         * to the MQTT broker as specified in AWS_IOT_ENDPOINT and AWS_MQTT_PORT
-         * at the demo config header. */
-        LogInfo( ( "Establishing a TLS session to %.*s:%d.",
-                   AWS_IOT_ENDPOINT_LENGTH,
-                   AWS_IOT_ENDPOINT,
-                   AWS_MQTT_PORT ) );
-        opensslStatus = Openssl_Connect( pNetworkContext,
-                                         &serverInfo,
-                                         &opensslCredentials,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
-                                         TRANSPORT_SEND_RECV_TIMEOUT_MS );
-
-        if( opensslStatus != OPENSSL_SUCCESS )
+        /* The broker, and the session of the demo. */
+        config.pHostName = AWS_IOT_ENDPOINT;
+        config.hostNameLength = AWS_IOT_ENDPOINT_LENGTH;
+        config.port = AWS_MQTT_PORT;
+        config.pRootCaPath = ROOT_CA_CERT_PATH;
+        config.pClientCertPath = CLIENT_CERT_PATH;
+        config.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+        config.pClientIdentifier = CLIENT_IDENTIFIER;
+        config.clientIdentifierLength = CLIENT_IDENTIFIER_LENGTH;
+        config.pUserName = METRICS_STRING;
+        config.userNameLength = METRICS_STRING_LENGTH;
+        config.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+        config.transportTimeoutMs = TRANSPORT_SEND_RECV_TIMEOUT_MS;
+        config.connackTimeoutMs = CONNACK_RECV_TIMEOUT_MS;
+        config.earlyConnect = false;
+        config.earlyDataReplaySafe = false;
+        config.releaseIdleBuffers = false;
+        config.maxFragmentLength = 0U;
+        config.ocspMode = OPENSSL_OCSP_DISABLED;
+        config.cacheVerifiedChains = false;
+        config.ackTimeoutMs = MQTT_PROCESS_LOOP_TIMEOUT_MS;
+        config.adaptiveTimeouts = false;
+        config.retryBaseMs = CONNECTION_RETRY_BACKOFF_BASE_MS;
+        config.retryMaxDelayMs = CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS;
+        config.retryMaxAttempts = CONNECTION_RETRY_MAX_ATTEMPTS;
+        config.drainBatchSize = OFFLINE_PUBLISH_DRAIN_BATCH_SIZE;
+        config.drainIntervalMs = OFFLINE_PUBLISH_DRAIN_INTERVAL_MS;
+        #if ( PERSIST_OUTGOING_PUBLISHES == 1 )
+            config.pStorePath = OUTGOING_PUBLISH_STORE_PATH;
+        #else
+            config.pStorePath = NULL;
+        #endif
+        config.storeSize = OUTGOING_PUBLISH_STORE_SIZE;
+        config.eventCallback = forwardEventCallback;
+        config.payloadBufferCallback = NULL;
+        config.payloadChunkCallback = NULL;
+        config.pUserContext = NULL;
+
+        /* The memory of the connection. */
+        buffers.pNetworkBuffer = buffer;
+        buffers.networkBufferSize = NETWORK_BUFFER_SIZE;
+        buffers.pWindowEntries = outgoingPublishEntries;
+        buffers.windowLength = MAX_OUTGOING_PUBLISHES;
+        buffers.pWindowBuckets = outgoingPublishBuckets;
+        buffers.pQueueEntries = offlinePublishEntries;
+        buffers.queueLength = OFFLINE_PUBLISH_QUEUE_LENGTH;
+        buffers.pQueueSlots = offlinePublishSlots;
+        buffers.queueSlotSize = OFFLINE_PUBLISH_SLOT_SIZE;
+        buffers.pBatchBuffer = batchBuffer;
+        buffers.batchBufferSize = PUBLISH_BATCH_BUFFER_SIZE;
+
+        if( MqttConnection_Create( &pMqttConnection, &config, &buffers ) != MqttConnectionSuccess )
         {
-            /* Generate a random number and get back-off value (in milliseconds) for the next connection retry. */
-            backoffAlgStatus = BackoffAlgorithm_GetNextBackoff( &reconnectParams, generateRandomNumber(), &nextRetryBackOff );
-
-            if( backoffAlgStatus == BackoffAlgorithmRetriesExhausted )
-            {
-                LogError( ( "Connection to the broker failed, all attempts exhausted." ) );
-                returnStatus = EXIT_FAILURE;
-            }
-            else if( backoffAlgStatus == BackoffAlgorithmSuccess )
-            {
-                LogWarn( ( "Connection to the broker failed. Retrying connection "
-                           "after %hu ms backoff.",
-                           ( unsigned short ) nextRetryBackOff ) );
-                Clock_SleepMs( nextRetryBackOff );
-            }
+            LogError( ( "Failed to create the connection to the MQTT broker." ) );
+            returnStatus = EXIT_FAILURE;
         }
-    } while( ( opensslStatus != OPENSSL_SUCCESS ) && ( backoffAlgStatus == BackoffAlgorithmSuccess ) );
+    }
 
     return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
 
-static int getNextFreeIndexForOutgoingPublishes( uint8_t * pIndex )
+int32_t InitOfflinePublishQueue( const PublishQueueRule_t * pRules,
+                                 size_t ruleCount )
 {
-    int returnStatus = EXIT_FAILURE;
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( pIndex != NULL );
+    int returnStatus = createConnection();
 
-    for( index = 0; index < MAX_OUTGOING_PUBLISHES; index++ )
+    if( returnStatus == EXIT_SUCCESS )
     {
-        /* A free index is marked by invalid packet id.
-         * Check if the the index has a free slot. */
-        if( outgoingPublishPackets[ index ].packetId == MQTT_PACKET_ID_INVALID )
+        if( MqttConnection_SetQueueRules( pMqttConnection, pRules, ruleCount ) != MqttConnectionSuccess )
         {
-            returnStatus = EXIT_SUCCESS;
-            break;
+            returnStatus = EXIT_FAILURE;
         }
     }
 
-    /* Copy the available index into the output param. */
-    *pIndex = index;
-
     return returnStatus;
 }
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishAt( uint8_t index )
-{
-    assert( outgoingPublishPackets != NULL );
-    assert( index < MAX_OUTGOING_PUBLISHES );
-
-    /* Clear the outgoing publish packet. */
-    ( void ) memset( &( outgoingPublishPackets[ index ] ),
-                     0x00,
-                     sizeof( outgoingPublishPackets[ index ] ) );
-}
 
 /*-----------------------------------------------------------*/
 
-static void cleanupOutgoingPublishes( void )
+int32_t EstablishMqttSession( MQTTEventCallback_t eventCallback )
 {
-    assert( outgoingPublishPackets != NULL );
+    int returnStatus = createConnection();
 
-    /* Clean up all the outgoing publish packets. */
-    ( void ) memset( outgoingPublishPackets, 0x00, sizeof( outgoingPublishPackets ) );
-}
+    /* Remember the callback supplied. */
+    appEventCallback = eventCallback;
 
-/*-----------------------------------------------------------*/
-
-static void cleanupOutgoingPublishWithPacketID( uint16_t packetId )
-{
-    uint8_t index = 0;
-
-    assert( outgoingPublishPackets != NULL );
-    assert( packetId != MQTT_PACKET_ID_INVALID );
-
-    /* Clean up all the saved outgoing publishes. */
-    for( ; index < MAX_OUTGOING_PUBLISHES; index++ )
+    if( returnStatus == EXIT_SUCCESS )
     {
-        if( outgoingPublishPackets[ index ].packetId == packetId )
+        if( MqttConnection_Connect( pMqttConnection ) != MqttConnectionSuccess )
         {
-            cleanupOutgoingPublishAt( index );
-            LogInfo( ( "Cleaned up outgoing publish packet with packet id %u.",
-                       packetId ) );
-            break;
+            returnStatus = EXIT_FAILURE;
         }
     }
+
+    return returnStatus;
 }
 
 /*-----------------------------------------------------------*/
@@ -494,19 +546,16 @@ static void cleanupOutgoingPublishWithPacketID( uint16_t packetId )
 void HandleOtherIncomingPacket( MQTTPacketInfo_t * pPacketInfo,
                                 uint16_t packetIdentifier )
 {
-    /* Handle other packets. */
+    /* The connection already matched the acks with their requests, and
+     * removed the acknowledged publishes from its window. */
     switch( pPacketInfo->type )
     {
         case MQTT_PACKET_TYPE_SUBACK:
             LogInfo( ( "MQTT_PACKET_TYPE_SUBACK." ) );
-            /* Make sure ACK packet identifier matches with Request packet identifier. */
-            assert( globalSubscribePacketIdentifier == packetIdentifier );
             break;
 
         case MQTT_PACKET_TYPE_UNSUBACK:
             LogInfo( ( "MQTT_PACKET_TYPE_UNSUBACK." ) );
-            /* Make sure ACK packet identifier matches with Request packet identifier. */
-            assert( globalUnsubscribePacketIdentifier == packetIdentifier );
             break;
 
         case MQTT_PACKET_TYPE_PINGRESP:
@@ -520,8 +569,6 @@ void HandleOtherIncomingPacket( MQTTPacketInfo_t * pPacketInfo,
         case MQTT_PACKET_TYPE_PUBACK:
             LogInfo( ( "PUBACK received for packet id %u.",
                        packetIdentifier ) );
-            /* Cleanup publish packet when a PUBACK is received. */
-            cleanupOutgoingPublishWithPacketID( packetIdentifier );
             break;
 
         /* Any other packet type is invalid. */
@@ -533,44 +580,51 @@ void HandleOtherIncomingPacket( MQTTPacketInfo_t * pPacketInfo,
 
 /*-----------------------------------------------------------*/
 
-static int handlePublishResend( MQTTContext_t * pMqttContext )
+int32_t DisconnectMqttSession( void )
+{
+    int returnStatus = EXIT_SUCCESS;
+
+    if( MqttConnection_Disconnect( pMqttConnection ) != MqttConnectionSuccess )
+    {
+        returnStatus = EXIT_FAILURE;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SubscribeToTopic( const char * pTopicFilter,
+                          uint16_t topicFilterLength )
 {
     int returnStatus = EXIT_SUCCESS;
-    MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t index = 0U;
 
-    assert( outgoingPublishPackets != NULL );
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength > 0 );
 
-    /* Resend all the QoS1 publishes still in the array. These are the
-     * publishes that hasn't received a PUBACK. When a PUBACK is
-     * received, the publish is removed from the array. */
-    for( index = 0U; index < MAX_OUTGOING_PUBLISHES; index++ )
+    /* This example subscribes to only one topic and uses QOS1. The SUBACK is
+     * received by the connection before it returns. */
+    if( MqttConnection_Subscribe( pMqttConnection, pTopicFilter, topicFilterLength ) != MqttConnectionSuccess )
     {
-        if( outgoingPublishPackets[ index ].packetId != MQTT_PACKET_ID_INVALID )
-        {
-            outgoingPublishPackets[ index ].pubInfo.dup = true;
+        returnStatus = EXIT_FAILURE;
+    }
 
-            LogInfo( ( "Sending duplicate PUBLISH with packet id %u.",
-                       outgoingPublishPackets[ index ].packetId ) );
-            mqttStatus = MQTT_Publish( pMqttContext,
-                                       &outgoingPublishPackets[ index ].pubInfo,
-                                       outgoingPublishPackets[ index ].packetId );
+    return returnStatus;
+}
 
-            if( mqttStatus != MQTTSuccess )
-            {
-                LogError( ( "Sending duplicate PUBLISH for packet id %u "
-                            " failed with status %u.",
-                            outgoingPublishPackets[ index ].packetId,
-                            mqttStatus ) );
-                returnStatus = EXIT_FAILURE;
-                break;
-            }
-            else
-            {
-                LogInfo( ( "Sent duplicate PUBLISH successfully for packet id %u.",
-                           outgoingPublishPackets[ index ].packetId ) );
-            }
-        }
+/*-----------------------------------------------------------*/
+
+int32_t UnsubscribeFromTopic( const char * pTopicFilter,
+                              uint16_t topicFilterLength )
+{
+    int returnStatus = EXIT_SUCCESS;
+
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength > 0 );
+
+    if( MqttConnection_Unsubscribe( pMqttConnection, pTopicFilter, topicFilterLength ) != MqttConnectionSuccess )
+    {
+        returnStatus = EXIT_FAILURE;
     }
 
     return returnStatus;
@@ -578,139 +632,61 @@ static int handlePublishResend( MQTTContext_t * pMqttContext )
 
 /*-----------------------------------------------------------*/
 
-int EstablishMqttSession( MQTTEventCallback_t eventCallback )
+int32_t PublishToTopic( const char * pTopicFilter,
+                        int32_t topicFilterLength,
+                        const char * pPayload,
+                        size_t payloadLength )
 {
     int returnStatus = EXIT_SUCCESS;
-    MQTTStatus_t mqttStatus;
-    MQTTConnectInfo_t connectInfo;
-    MQTTFixedBuffer_t networkBuffer;
-    TransportInterface_t transport;
-    bool createCleanSession = false;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    NetworkContext_t * pNetworkContext = &networkContext;
-    bool sessionPresent = false;
+    MQTTPublishInfo_t publishInfo = { 0 };
 
-    assert( pMqttContext != NULL );
-    assert( pNetworkContext != NULL );
+    assert( pTopicFilter != NULL );
+    assert( topicFilterLength > 0 );
 
-    /* Initialize the mqtt context and network context. */
-    ( void ) memset( pMqttContext, 0U, sizeof( MQTTContext_t ) );
-    ( void ) memset( pMqttContext, 0U, sizeof( NetworkContext_t ) );
+    /* This example publishes to only one topic and uses QOS1. */
+    publishInfo.qos = MQTTQoS1;
+    publishInfo.pTopicName = pTopicFilter;
+    publishInfo.topicNameLength = ( uint16_t ) topicFilterLength;
+    publishInfo.pPayload = pPayload;
+    publishInfo.payloadLength = payloadLength;
 
-    returnStatus = connectToServerWithBackoffRetries( pNetworkContext );
+    LogInfo( ( "Published payload: %s", pPayload ) );
 
-    if( returnStatus != EXIT_SUCCESS )
+    /* While the connection to the broker is down, the publish is queued. */
+    if( MqttConnection_Publish( pMqttConnection, &publishInfo ) != MqttConnectionSuccess )
     {
-        /* Log error to indicate connection failure after all
-         * reconnect attempts are over. */
-        LogError( ( "Failed to connect to MQTT broker %.*s.",
-                    AWS_IOT_ENDPOINT_LENGTH,
-                    AWS_IOT_ENDPOINT ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else if( MqttConnection_IsConnected( pMqttConnection ) == true )
+    {
+        /* Calling MQTT_ProcessLoop to process incoming publish echo, since
+         * application subscribed to the same topic the broker will send
+         * publish message back to the application. This function also
+         * sends ping request to broker if MQTT_KEEP_ALIVE_INTERVAL_SECONDS
+         * has expired since the last MQTT packet sent and receive
+         * ping responses. */
+        ( void ) MqttConnection_ProcessLoop( pMqttConnection, MQTT_PROCESS_LOOP_TIMEOUT_MS );
     }
     else
     {
-        /* Fill in TransportInterface send and receive function pointers.
-         * For this demo, TCP sockets are used to send and receive data
-         * from network. Network context is SSL context for OpenSSL.*/
-        transport.pNetworkContext = pNetworkContext;
-        transport.send = Openssl_Send;
-        transport.recv = Openssl_Recv;
-
-        /* Fill the values for network buffer. */
-        networkBuffer.pBuffer = buffer;
-        networkBuffer.size = NETWORK_BUFFER_SIZE;
-
-        /* Initialize MQTT library. */
-        mqttStatus = MQTT_Init( pMqttContext,
-                                &transport,
-                                Clock_GetTimeMs,
-                                eventCallback,
-                                &networkBuffer );
-
-        if( mqttStatus != MQTTSuccess )
-        {
-            returnStatus = EXIT_FAILURE;
-            LogError( ( "MQTT init failed with status %u.", mqttStatus ) );
-        }
-        else
-        {
-            /* Establish MQTT session by sending a CONNECT packet. */
-
-            /* If #createCleanSession is true, start with a clean session
-             * i.e. direct the MQTT broker to discard any previous session data.
-             * If #createCleanSession is false, directs the broker to attempt to
-             * reestablish a session which was already present. */
-            connectInfo.cleanSession = createCleanSession;
-
-            /* The client identifier is used to uniquely identify this MQTT client to
-             * the MQTT broker. In a production device the identifier can be something
-             * unique, such as a device serial number. */
-            connectInfo.pClientIdentifier = CLIENT_IDENTIFIER;
-            connectInfo.clientIdentifierLength = CLIENT_IDENTIFIER_LENGTH;
-
-            /* The maximum time interval in seconds which is allowed to elapse
-             * between two Control Packets.
-             * It is the responsibility of the Client to ensure that the interval between
-             * Control Packets being sent does not exceed the this Keep Alive value. In the
-             * absence of sending any other Control Packets, the Client MUST send a
-             * PINGREQ Packet. */
-            connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
-
-            /* Username and password for authentication. Not used in this demo. */
-            connectInfo.pUserName = METRICS_STRING;
-            connectInfo.userNameLength = METRICS_STRING_LENGTH;
-            connectInfo.pPassword = NULL;
-            connectInfo.passwordLength = 0U;
-
-            /* Send MQTT CONNECT packet to broker. */
-            mqttStatus = MQTT_Connect( pMqttContext,
-                                       &connectInfo,
-                                       NULL,
-                                       CONNACK_RECV_TIMEOUT_MS,
-                                       &sessionPresent );
-
-            if( mqttStatus != MQTTSuccess )
-            {
-                returnStatus = EXIT_FAILURE;
-                LogError( ( "Connection with MQTT broker failed with status %u.", mqttStatus ) );
-            }
-            else
-            {
-                LogInfo( ( "MQTT connection successfully established with broker." ) );
-            }
-        }
+        /* Empty else MISRA 15.7 */
+    }
 
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            /* Keep a flag for indicating if MQTT session is established. This
-             * flag will mark that an MQTT DISCONNECT has to be sent at the end
-             * of the demo even if there are intermediate failures. */
-            mqttSessionEstablished = true;
-        }
+    return returnStatus;
+}
 
-        if( returnStatus == EXIT_SUCCESS )
-        {
-            /* Check if session is present and if there are any outgoing publishes
-             * that need to resend. This is only valid if the broker is
-             * re-establishing a session which was already present. */
-            if( sessionPresent == true )
-            {
-                LogInfo( ( "An MQTT session with broker is re-established. "
-                           "Resending unacked publishes." ) );
+/*-----------------------------------------------------------*/
 
-                /* Handle all the resend of publish messages. */
-                returnStatus = handlePublishResend( &mqttContext );
-            }
-            else
-            {
-                LogInfo( ( "A clean MQTT connection is established."
-                           " Cleaning up all the stored outgoing publishes." ) );
+int32_t PublishBatchToTopics( const MQTTPublishInfo_t * pPublishInfos,
+                              size_t publishCount )
+{
+    int returnStatus = EXIT_SUCCESS;
 
-                /* Clean up the outgoing publishes waiting for ack as this new
-                 * connection doesn't re-establish an existing session. */
-                cleanupOutgoingPublishes();
-            }
-        }
+    assert( ( pPublishInfos != NULL ) || ( publishCount == 0U ) );
+
+    if( MqttConnection_PublishBatch( pMqttConnection, pPublishInfos, publishCount ) != MqttConnectionSuccess )
+    {
+        returnStatus = EXIT_FAILURE;
     }
 
     return returnStatus;
@@ -718,155 +694,184 @@ int EstablishMqttSession( MQTTEventCallback_t eventCallback )
 
 /*-----------------------------------------------------------*/
 
-int32_t DisconnectMqttSession( void )
+static size_t getPendingReportLength( void )
 {
-    MQTTStatus_t mqttStatus = MQTTSuccess;
-    int returnStatus = EXIT_SUCCESS;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    NetworkContext_t * pNetworkContext = &networkContext;
-
-    assert( pMqttContext != NULL );
-    assert( pNetworkContext != NULL );
+    size_t length = 0U;
+    size_t i = 0U;
 
-    if( mqttSessionEstablished == true )
+    for( i = 0U; i < REPORT_BATCHER_MAX_FIELDS; i++ )
     {
-        /* Send DISCONNECT. */
-        mqttStatus = MQTT_Disconnect( pMqttContext );
-
-        if( mqttStatus != MQTTSuccess )
+        if( batchedFields[ i ].isPending == true )
         {
-            LogError( ( "Sending MQTT DISCONNECT failed with status=%u.",
-                        mqttStatus ) );
-            returnStatus = EXIT_FAILURE;
+            length += ( size_t ) batchedFields[ i ].keyLength +
+                      ( size_t ) batchedFields[ i ].valueLength +
+                      REPORT_FIELD_OVERHEAD_LENGTH;
         }
     }
 
-    /* End TLS session, then close TCP connection. */
-    ( void ) Openssl_Disconnect( pNetworkContext );
+    if( length > 0U )
+    {
+        /* The last field has no separating comma. */
+        length += REPORT_DOCUMENT_HEAD_LENGTH + REPORT_DOCUMENT_TAIL_LENGTH - 1U;
+    }
 
-    return returnStatus;
+    return length;
 }
 
 /*-----------------------------------------------------------*/
 
-int32_t SubscribeToTopic( const char * pTopicFilter,
-                          uint16_t topicFilterLength )
+static size_t serializePendingReport( uint32_t clientToken,
+                                      uint32_t * pFieldMask )
 {
-    int returnStatus = EXIT_SUCCESS;
-    MQTTStatus_t mqttStatus;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
+    size_t length = 0U;
+    size_t i = 0U;
+    uint32_t fieldMask = 0U;
+    char * pCursor = reportDocument;
 
-    assert( pMqttContext != NULL );
-    assert( pTopicFilter != NULL );
-    assert( topicFilterLength > 0 );
-
-    /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
-
-    /* This example subscribes to only one topic and uses QOS1. */
-    pSubscriptionList[ 0 ].qos = MQTTQoS1;
-    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
-
-    /* Generate packet identifier for the SUBSCRIBE packet. */
-    globalSubscribePacketIdentifier = MQTT_GetPacketId( pMqttContext );
+    assert( pFieldMask != NULL );
 
-    /* Send SUBSCRIBE packet. */
-    mqttStatus = MQTT_Subscribe( pMqttContext,
-                                 pSubscriptionList,
-                                 sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                 globalSubscribePacketIdentifier );
+    ( void ) memcpy( pCursor, REPORT_DOCUMENT_HEAD, REPORT_DOCUMENT_HEAD_LENGTH );
+    pCursor += REPORT_DOCUMENT_HEAD_LENGTH;
 
-    if( mqttStatus != MQTTSuccess )
-    {
-        LogError( ( "Failed to send SUBSCRIBE packet to broker with error = %u.",
-                    mqttStatus ) );
-        returnStatus = EXIT_FAILURE;
-    }
-    else
+    for( i = 0U; i < REPORT_BATCHER_MAX_FIELDS; i++ )
     {
-        LogInfo( ( "SUBSCRIBE topic %.*s to broker.",
-                   topicFilterLength,
-                   pTopicFilter ) );
-
-        /* Process incoming packet from the broker. Acknowledgment for subscription
-         * ( SUBACK ) will be received here. However after sending the subscribe, the
-         * client may receive a publish before it receives a subscribe ack. Since this
-         * demo is subscribing to the topic to which no one is publishing, probability
-         * of receiving publish message before subscribe ack is zero; but application
-         * must be ready to receive any packet. This demo uses MQTT_ProcessLoop to
-         * receive packet from network. */
-        mqttStatus = MQTT_ProcessLoop( pMqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
-
-        if( mqttStatus != MQTTSuccess )
+        if( batchedFields[ i ].isPending == true )
         {
-            returnStatus = EXIT_FAILURE;
-            LogError( ( "MQTT_ProcessLoop returned with status = %u.",
-                        mqttStatus ) );
+            if( fieldMask != 0U )
+            {
+                *pCursor = ',';
+                pCursor++;
+            }
+
+            *pCursor = '"';
+            pCursor++;
+            ( void ) memcpy( pCursor, batchedFields[ i ].key, batchedFields[ i ].keyLength );
+            pCursor += batchedFields[ i ].keyLength;
+            *pCursor = '"';
+            pCursor++;
+            *pCursor = ':';
+            pCursor++;
+            ( void ) memcpy( pCursor, batchedFields[ i ].value, batchedFields[ i ].valueLength );
+            pCursor += batchedFields[ i ].valueLength;
+
+            fieldMask |= ( 1UL << i );
         }
     }
 
-    return returnStatus;
+    length = ( size_t ) ( pCursor - reportDocument );
+    length += ( size_t ) snprintf( pCursor,
+                                   sizeof( reportDocument ) - length,
+                                   REPORT_DOCUMENT_TAIL,
+                                   ( long unsigned ) clientToken );
+
+    *pFieldMask = fieldMask;
+
+    return length;
 }
 
 /*-----------------------------------------------------------*/
 
-int32_t UnsubscribeFromTopic( const char * pTopicFilter,
-                              uint16_t topicFilterLength )
+static void removeInFlightReport( size_t index )
 {
-    int returnStatus = EXIT_SUCCESS;
-    MQTTStatus_t mqttStatus;
-    MQTTContext_t * pMqttContext = &mqttContext;
-    MQTTSubscribeInfo_t pSubscriptionList[ 1 ];
+    size_t i = 0U;
 
-    assert( pMqttContext != NULL );
-    assert( pTopicFilter != NULL );
-    assert( topicFilterLength > 0 );
+    assert( index < inFlightReportCount );
+
+    for( i = index; ( i + 1U ) < inFlightReportCount; i++ )
+    {
+        inFlightReports[ i ] = inFlightReports[ i + 1U ];
+    }
 
-    /* Start with everything at 0. */
-    ( void ) memset( ( void * ) pSubscriptionList, 0x00, sizeof( pSubscriptionList ) );
+    inFlightReportCount--;
+}
 
-    /* This example subscribes to only one topic and uses QOS1. */
-    pSubscriptionList[ 0 ].qos = MQTTQoS1;
-    pSubscriptionList[ 0 ].pTopicFilter = pTopicFilter;
-    pSubscriptionList[ 0 ].topicFilterLength = topicFilterLength;
+/*-----------------------------------------------------------*/
 
-    /* Generate packet identifier for the UNSUBSCRIBE packet. */
-    globalUnsubscribePacketIdentifier = MQTT_GetPacketId( pMqttContext );
+void InitReportBatcher( const char * pUpdateTopic,
+                        uint16_t updateTopicLength )
+{
+    assert( pUpdateTopic != NULL );
+    assert( updateTopicLength > 0U );
+
+    ( void ) memset( batchedFields, 0x00, sizeof( batchedFields ) );
+    ( void ) memset( inFlightReports, 0x00, sizeof( inFlightReports ) );
+    inFlightReportCount = 0U;
+    oldestPendingTimeMs = 0U;
+    priorityPending = false;
+    pReportTopic = pUpdateTopic;
+    reportTopicLength = updateTopicLength;
+
+    /* The responses to a previous session are not mistaken for those of
+     * this one. */
+    nextReportToken = Clock_GetTimeMs() % REPORT_CLIENT_TOKEN_MODULUS;
+}
 
-    /* Send UNSUBSCRIBE packet. */
-    mqttStatus = MQTT_Unsubscribe( pMqttContext,
-                                   pSubscriptionList,
-                                   sizeof( pSubscriptionList ) / sizeof( MQTTSubscribeInfo_t ),
-                                   globalUnsubscribePacketIdentifier );
+/*-----------------------------------------------------------*/
 
-    if( mqttStatus != MQTTSuccess )
+int32_t ReportField( const char * pKey,
+                     uint16_t keyLength,
+                     const char * pValue,
+                     uint16_t valueLength,
+                     bool isPriority )
+{
+    int returnStatus = EXIT_SUCCESS;
+    size_t i = 0U;
+    size_t index = REPORT_BATCHER_MAX_FIELDS;
+    bool wasPending = ( getPendingReportLength() > 0U );
+
+    if( ( pKey == NULL ) || ( keyLength == 0U ) ||
+        ( keyLength > REPORT_BATCHER_KEY_MAX_LENGTH ) ||
+        ( pValue == NULL ) || ( valueLength == 0U ) ||
+        ( valueLength > REPORT_BATCHER_VALUE_MAX_LENGTH ) )
     {
-        LogError( ( "Failed to send UNSUBSCRIBE packet to broker with error = %u.",
-                    mqttStatus ) );
+        LogError( ( "The reported field does not fit in the report batcher." ) );
         returnStatus = EXIT_FAILURE;
     }
     else
     {
-        LogInfo( ( "UNSUBSCRIBE sent topic %.*s to broker.",
-                   topicFilterLength,
-                   pTopicFilter ) );
-
-        /* Process incoming packet from the broker. Acknowledgment for subscription
-         * ( SUBACK ) will be received here. However after sending the subscribe, the
-         * client may receive a publish before it receives a subscribe ack. Since this
-         * demo is subscribing to the topic to which no one is publishing, probability
-         * of receiving publish message before subscribe ack is zero; but application
-         * must be ready to receive any packet. This demo uses MQTT_ProcessLoop to
-         * receive packet from network. */
-        mqttStatus = MQTT_ProcessLoop( pMqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
-
-        if( mqttStatus != MQTTSuccess )
+        /* Find the entry of the key, or else a free one. */
+        for( i = 0U; ( i < REPORT_BATCHER_MAX_FIELDS ) && ( index == REPORT_BATCHER_MAX_FIELDS ); i++ )
+        {
+            if( ( batchedFields[ i ].keyLength == keyLength ) &&
+                ( memcmp( batchedFields[ i ].key, pKey, keyLength ) == 0 ) )
+            {
+                index = i;
+            }
+        }
+
+        for( i = 0U; ( i < REPORT_BATCHER_MAX_FIELDS ) && ( index == REPORT_BATCHER_MAX_FIELDS ); i++ )
         {
+            if( batchedFields[ i ].keyLength == 0U )
+            {
+                index = i;
+            }
+        }
+
+        if( index == REPORT_BATCHER_MAX_FIELDS )
+        {
+            LogError( ( "No space for the reported field %.*s.", ( int ) keyLength, pKey ) );
             returnStatus = EXIT_FAILURE;
-            LogError( ( "MQTT_ProcessLoop returned with status = %u.",
-                        mqttStatus ) );
+        }
+    }
+
+    if( returnStatus == EXIT_SUCCESS )
+    {
+        /* A value set again before it is published replaces the previous
+         * one, so only the last value is published. */
+        ( void ) memcpy( batchedFields[ index ].key, pKey, keyLength );
+        batchedFields[ index ].keyLength = keyLength;
+        ( void ) memcpy( batchedFields[ index ].value, pValue, valueLength );
+        batchedFields[ index ].valueLength = valueLength;
+        batchedFields[ index ].isPending = true;
+
+        if( wasPending == false )
+        {
+            oldestPendingTimeMs = Clock_GetTimeMs();
+        }
+
+        if( isPriority == true )
+        {
+            priorityPending = true;
         }
     }
 
@@ -875,78 +880,108 @@ int32_t UnsubscribeFromTopic( const char * pTopicFilter,
 
 /*-----------------------------------------------------------*/
 
-int32_t PublishToTopic( const char * pTopicFilter,
-                        int32_t topicFilterLength,
-                        const char * pPayload,
-                        size_t payloadLength )
+int32_t FlushReportBatcher( bool force )
 {
     int returnStatus = EXIT_SUCCESS;
-    MQTTStatus_t mqttStatus = MQTTSuccess;
-    uint8_t publishIndex = MAX_OUTGOING_PUBLISHES;
-    MQTTContext_t * pMqttContext = &mqttContext;
+    size_t i = 0U;
+    size_t pendingLength = getPendingReportLength();
+    size_t documentLength = 0U;
+    uint32_t clientToken = 0U;
+    uint32_t fieldMask = 0U;
+    bool wasPriority = priorityPending;
+
+    assert( pReportTopic != NULL );
+
+    if( ( pendingLength > 0U ) &&
+        ( ( force == true ) ||
+          ( priorityPending == true ) ||
+          ( pendingLength >= REPORT_BATCHER_FLUSH_LENGTH ) ||
+          ( ( Clock_GetTimeMs() - oldestPendingTimeMs ) >= REPORT_BATCHER_MAX_DELAY_MS ) ) )
+    {
+        clientToken = nextReportToken;
+        nextReportToken = ( nextReportToken + 1U ) % REPORT_CLIENT_TOKEN_MODULUS;
 
-    assert( pMqttContext != NULL );
-    assert( pTopicFilter != NULL );
-    assert( topicFilterLength > 0 );
+        documentLength = serializePendingReport( clientToken, &fieldMask );
 
-    /* Get the next free index for the outgoing publish. All QoS1 outgoing
-     * publishes are stored until a PUBACK is received. These messages are
-     * stored for supporting a resend if a network connection is broken before
-     * receiving a PUBACK. */
-    returnStatus = getNextFreeIndexForOutgoingPublishes( &publishIndex );
+        /* The oldest report stops being awaited if there is no room for this
+         * one; its response will be unknown. */
+        if( inFlightReportCount == REPORT_BATCHER_MAX_IN_FLIGHT )
+        {
+            LogWarn( ( "Stop awaiting the response to the report with clientToken=%06lu.",
+                       ( long unsigned ) inFlightReports[ 0 ].clientToken ) );
+            removeInFlightReport( 0U );
+        }
 
-    if( returnStatus == EXIT_FAILURE )
-    {
-        LogError( ( "Unable to find a free spot for outgoing PUBLISH message." ) );
-    }
-    else
-    {
-        LogInfo( ( "Published payload: %s", pPayload ) );
-        /* This example publishes to only one topic and uses QOS1. */
-        outgoingPublishPackets[ publishIndex ].pubInfo.qos = MQTTQoS1;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pTopicName = pTopicFilter;
-        outgoingPublishPackets[ publishIndex ].pubInfo.topicNameLength = topicFilterLength;
-        outgoingPublishPackets[ publishIndex ].pubInfo.pPayload = pPayload;
-        outgoingPublishPackets[ publishIndex ].pubInfo.payloadLength = payloadLength;
-
-        /* Get a new packet id. */
-        outgoingPublishPackets[ publishIndex ].packetId = MQTT_GetPacketId( pMqttContext );
-
-        /* Send PUBLISH packet. */
-        mqttStatus = MQTT_Publish( pMqttContext,
-                                   &outgoingPublishPackets[ publishIndex ].pubInfo,
-                                   outgoingPublishPackets[ publishIndex ].packetId );
-
-        if( mqttStatus != MQTTSuccess )
+        /* The report is recorded before it is published, as PublishToTopic
+         * processes the incoming messages, which may include its response.
+         * Fields set meanwhile are pending again. */
+        inFlightReports[ inFlightReportCount ].clientToken = clientToken;
+        inFlightReports[ inFlightReportCount ].fieldMask = fieldMask;
+        inFlightReportCount++;
+
+        for( i = 0U; i < REPORT_BATCHER_MAX_FIELDS; i++ )
         {
-            LogError( ( "Failed to send PUBLISH packet to broker with error = %u.",
-                        mqttStatus ) );
-            cleanupOutgoingPublishAt( publishIndex );
-            returnStatus = EXIT_FAILURE;
+            batchedFields[ i ].isPending = false;
+        }
+
+        priorityPending = false;
+
+        returnStatus = PublishToTopic( pReportTopic,
+                                       ( int32_t ) reportTopicLength,
+                                       reportDocument,
+                                       documentLength );
+
+        if( returnStatus == EXIT_SUCCESS )
+        {
+            /* The fields of this report are superseded in the older ones. */
+            for( i = 0U; i < inFlightReportCount; i++ )
+            {
+                if( inFlightReports[ i ].clientToken != clientToken )
+                {
+                    inFlightReports[ i ].fieldMask &= ~fieldMask;
+                }
+            }
         }
         else
         {
-            LogInfo( ( "PUBLISH sent for topic %.*s to broker with packet ID %u.",
-                       topicFilterLength,
-                       pTopicFilter,
-                       outgoingPublishPackets[ publishIndex ].packetId ) );
-
-            /* Calling MQTT_ProcessLoop to process incoming publish echo, since
-             * application subscribed to the same topic the broker will send
-             * publish message back to the application. This function also
-             * sends ping request to broker if MQTT_KEEP_ALIVE_INTERVAL_SECONDS
-             * has expired since the last MQTT packet sent and receive
-             * ping responses. */
-            mqttStatus = MQTT_ProcessLoop( &mqttContext, MQTT_PROCESS_LOOP_TIMEOUT_MS );
-
-            if( mqttStatus != MQTTSuccess )
+            /* Nothing was processed, so the report is the last one, and its
+             * fields are pending again. */
+            LogError( ( "Failed to publish the report with clientToken=%06lu.",
+                        ( long unsigned ) clientToken ) );
+            inFlightReportCount--;
+
+            for( i = 0U; i < REPORT_BATCHER_MAX_FIELDS; i++ )
             {
-                LogWarn( ( "MQTT_ProcessLoop returned with status = %u.",
-                           mqttStatus ) );
+                if( ( fieldMask & ( 1UL << i ) ) != 0U )
+                {
+                    batchedFields[ i ].isPending = true;
+                }
             }
+
+            priorityPending = wasPriority;
         }
     }
 
     return returnStatus;
 }
+
+/*-----------------------------------------------------------*/
+
+ReportResponse_t ReceiveReportResponse( uint32_t clientToken )
+{
+    ReportResponse_t response = ReportResponseUnknown;
+    size_t i = 0U;
+
+    for( i = 0U; ( i < inFlightReportCount ) && ( response == ReportResponseUnknown ); i++ )
+    {
+        if( inFlightReports[ i ].clientToken == clientToken )
+        {
+            response = ( inFlightReports[ i ].fieldMask != 0U ) ? ReportResponseCurrent : ReportResponseSuperseded;
+            removeInFlightReport( i );
+        }
+    }
+
+    return response;
+}
+
 /*-----------------------------------------------------------*/
@@ -23,12 +23,89 @@
 #ifndef SHADOW_DEMO_HELPERS_H_
 #define SHADOW_DEMO_HELPERS_H_
 
+/* Standard includes. */
+#include <stdbool.h>
+
 /* Include Demo Config as the first non-system header. */
 #include "demo_config.h"
 
 /* MQTT API header. */
 #include "core_mqtt.h"
 
+/* Queue of the publishes issued while the connection is down. */
+#include "publish_queue.h"
+
+/**
+ * @brief Maximum number of fields of the reported state held by the report
+ * batcher. It cannot exceed 32.
+ */
+#ifndef REPORT_BATCHER_MAX_FIELDS
+    #define REPORT_BATCHER_MAX_FIELDS          ( 8U )
+#endif
+
+/**
+ * @brief Maximum length of the key of a reported field.
+ */
+#ifndef REPORT_BATCHER_KEY_MAX_LENGTH
+    #define REPORT_BATCHER_KEY_MAX_LENGTH      ( 32U )
+#endif
+
+/**
+ * @brief Maximum length of the JSON value of a reported field.
+ */
+#ifndef REPORT_BATCHER_VALUE_MAX_LENGTH
+    #define REPORT_BATCHER_VALUE_MAX_LENGTH    ( 32U )
+#endif
+
+/**
+ * @brief Time after which a pending field is published, in milliseconds.
+ */
+#ifndef REPORT_BATCHER_MAX_DELAY_MS
+    #define REPORT_BATCHER_MAX_DELAY_MS        ( 1000U )
+#endif
+
+/**
+ * @brief Length of the pending reported document from which it is published
+ * without waiting for #REPORT_BATCHER_MAX_DELAY_MS.
+ */
+#ifndef REPORT_BATCHER_FLUSH_LENGTH
+    #define REPORT_BATCHER_FLUSH_LENGTH        ( 256U )
+#endif
+
+/**
+ * @brief Maximum number of published reports whose response is awaited.
+ */
+#ifndef REPORT_BATCHER_MAX_IN_FLIGHT
+    #define REPORT_BATCHER_MAX_IN_FLIGHT       ( 4U )
+#endif
+
+/**
+ * @brief The kinds of the `/update/accepted` and `/update/rejected` responses
+ * to the reports of the batcher.
+ */
+typedef enum ReportResponse
+{
+    ReportResponseCurrent = 0, /**< @brief The report holds the latest published value of a field. */
+    ReportResponseSuperseded,  /**< @brief Every field of the report was published again since; the response can be dropped. */
+    ReportResponseUnknown      /**< @brief The client token is not one of a report awaiting its response. */
+} ReportResponse_t;
+
+/**
+ * @brief Set the rules of the queue of the publishes issued while the
+ * connection to the broker is down, emptying it.
+ *
+ * Without a call to this function, the queue has no rules, so all the
+ * publishes have the lowest priority and drop the oldest when it is full.
+ *
+ * @param[in] pRules The rules, which must remain valid while the demo runs;
+ * NULL for none.
+ * @param[in] ruleCount Number of rules of @p pRules.
+ *
+ * @return EXIT_SUCCESS if the rules are valid; EXIT_FAILURE otherwise.
+ */
+int32_t InitOfflinePublishQueue( const PublishQueueRule_t * pRules,
+                                 size_t ruleCount );
+
 /**
  * @brief Establish a MQTT connection.
  *
@@ -92,7 +169,10 @@ int32_t UnsubscribeFromTopic( const char * pTopicFilter,
  * @param[in] pPayload Points to the payload.
  * @param[in] payloadLength The length of the payload.
  *
- * @return EXIT_SUCCESS if PUBLISH was successfully sent;
+ * While the connection to the broker is down, the message is queued instead,
+ * to be sent once #EstablishMqttSession reconnects.
+ *
+ * @return EXIT_SUCCESS if PUBLISH was successfully sent or queued;
  * EXIT_FAILURE otherwise.
  */
 int32_t PublishToTopic( const char * pTopicFilter,
@@ -100,4 +180,86 @@ int32_t PublishToTopic( const char * pTopicFilter,
                         const char * pPayload,
                         size_t payloadLength );
 
+/**
+ * @brief Publish several messages with as few transport writes as possible.
+ *
+ * The PUBLISH packets are serialized back to back into a batch buffer and
+ * sent with a single write, rather than with a write or more for each
+ * publish as #PublishToTopic does. A larger number of publishes is sent in
+ * several batches, the PUBACKs being received in between.
+ *
+ * @param[in] pPublishInfos The publishes, with QoS1. Their topics and
+ * payloads must remain valid until their PUBACK.
+ * @param[in] publishCount Number of entries of @p pPublishInfos.
+ *
+ * As with #PublishToTopic, the publishes not sent because the connection to
+ * the broker is down are queued instead, to be sent once
+ * #EstablishMqttSession reconnects.
+ *
+ * @return EXIT_SUCCESS if every PUBLISH was sent or queued; EXIT_FAILURE
+ * otherwise.
+ */
+int32_t PublishBatchToTopics( const MQTTPublishInfo_t * pPublishInfos,
+                              size_t publishCount );
+
+/**
+ * @brief Empty the report batcher, dropping the pending fields and the
+ * reports awaiting a response.
+ *
+ * @param[in] pUpdateTopic The `/update` topic of the shadow. It must remain
+ * valid while the batcher is used.
+ * @param[in] updateTopicLength The length of the topic.
+ */
+void InitReportBatcher( const char * pUpdateTopic,
+                        uint16_t updateTopicLength );
+
+/**
+ * @brief Set a field of the reported state, to be published by
+ * #FlushReportBatcher.
+ *
+ * A field set again before it is published is merged: only its last value
+ * is published. This function does not publish, so it can be called from the
+ * MQTT event callback.
+ *
+ * @param[in] pKey The key of the field.
+ * @param[in] keyLength The length of the key.
+ * @param[in] pValue The JSON value of the field, with the quotes of a string.
+ * @param[in] valueLength The length of the value.
+ * @param[in] isPriority true to publish the field on the next call to
+ * #FlushReportBatcher, without waiting for the thresholds.
+ *
+ * @return EXIT_SUCCESS if the field is pending; EXIT_FAILURE if it does not
+ * fit in the batcher.
+ */
+int32_t ReportField( const char * pKey,
+                     uint16_t keyLength,
+                     const char * pValue,
+                     uint16_t valueLength,
+                     bool isPriority );
+
+/**
+ * @brief Publish the pending fields in one reported document if a priority
+ * field is pending, the oldest pending field waited for
+ * #REPORT_BATCHER_MAX_DELAY_MS, or the document reached
+ * #REPORT_BATCHER_FLUSH_LENGTH.
+ *
+ * @param[in] force true to publish the pending fields regardless of the
+ * thresholds.
+ *
+ * @return EXIT_SUCCESS if nothing was due or PUBLISH was successfully sent;
+ * EXIT_FAILURE otherwise, in which case the fields remain pending.
+ */
+int32_t FlushReportBatcher( bool force );
+
+/**
+ * @brief Match the client token of an `/update/accepted` or `/update/rejected`
+ * response with the reports awaiting one.
+ *
+ * @param[in] clientToken The client token of the response.
+ *
+ * @return #ReportResponseCurrent, #ReportResponseSuperseded or
+ * #ReportResponseUnknown.
+ */
+ReportResponse_t ReceiveReportResponse( uint32_t clientToken );
+
 #endif /* ifndef SHADOW_DEMO_HELPERS_H_ */
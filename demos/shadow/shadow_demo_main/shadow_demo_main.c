@@ -39,11 +39,16 @@
  * 4. Publish a desired state of powerOn by using helper functions in shadow_demo_helpers.c.  That will cause
  * a delta message to be sent to device.
  * 5. Handle incoming MQTT messages in eventCallback, determine whether the message is related to the device
- * shadow by using a function defined by the Device Shadow library (Shadow_MatchTopicString). If the message is a
+ * shadow by looking up its topic among the topics assembled once in shadow_topic_table.c, or else by using a
+ * function defined by the Device Shadow library (Shadow_MatchTopicString). If the message is a
  * device shadow delta message, set a flag for the main function to know, then the main function will publish
  * a second message to update the reported state of powerOn.
- * 6. Handle incoming message again in eventCallback. If the message is from update/accepted, verify that it
- * has the same clientToken as previously published in the update message. That will mark the end of the demo.
+ * 6. Handle incoming message again in eventCallback. If the message is from update/accepted, verify that its
+ * clientToken is the one of a report awaiting a response. That will mark the end of the demo.
+ *
+ * The reported state is published through the report batcher of shadow_demo_helpers.c, which merges the
+ * fields changed within #REPORT_BATCHER_MAX_DELAY_MS into one update, and drops the responses to the updates
+ * superseded by a later one.
  */
 
 /* Standard includes. */
@@ -63,6 +68,15 @@
 /* JSON API header. */
 #include "core_json.h"
 
+/* Single pass extraction of JSON keys. */
+#include "json_extract.h"
+
+/* Local copy of the shadow. */
+#include "shadow_cache.h"
+
+/* Classification of the topics of the registered shadows. */
+#include "shadow_topic_table.h"
+
 /* Clock for timer. */
 #include "clock.h"
 
@@ -113,40 +127,26 @@
 #define SHADOW_DESIRED_JSON_LENGTH    ( sizeof( SHADOW_DESIRED_JSON ) - 3 )
 
 /**
- * @brief Format string representing a Shadow document with a "reported" state.
- *
- * The real json document will look like this:
- * {
- *   "state": {
- *     "reported": {
- *       "powerOn": 1
- *     }
- *   },
- *   "clientToken": "021909"
- * }
+ * @brief Format string of the whole reported state of the device.
  *
- * Note the client token, which is required for all Shadow updates. The client
- * token must be unique at any given time, but may be reused once the update is
- * completed. For this demo, a timestamp is used for a client token.
+ * Only its values that differ from the reported state cached from
+ * `/update/documents` are reported; see #ShadowCache_DiffReported.
  */
-#define SHADOW_REPORTED_JSON    \
-    "{"                         \
-    "\"state\":{"               \
-    "\"reported\":{"            \
-    "\"powerOn\":%01d"          \
-    "}"                         \
-    "},"                        \
-    "\"clientToken\":\"%06lu\"" \
+#define SHADOW_REPORTED_STATE_JSON    \
+    "{"                               \
+    "\"powerOn\":%01d"                \
     "}"
 
 /**
- * @brief The expected size of #SHADOW_REPORTED_JSON.
- *
- * Because all the format specifiers in #SHADOW_REPORTED_JSON include a length,
- * its full size is known at compile-time by pre-calculation. Users could refer to
- * the way how to calculate the actual length in #SHADOW_DESIRED_JSON_LENGTH.
+ * @brief The size of #SHADOW_REPORTED_STATE_JSON, with its termination
+ * character; "%01d" is written as one digit.
+ */
+#define SHADOW_REPORTED_STATE_JSON_LENGTH    ( sizeof( SHADOW_REPORTED_STATE_JSON ) - 3 )
+
+/**
+ * @brief The size of the buffer for the changes of the reported state.
  */
-#define SHADOW_REPORTED_JSON_LENGTH    ( sizeof( SHADOW_REPORTED_JSON ) - 3 )
+#define SHADOW_REPORTED_DIFF_MAX_LENGTH      ( 128U )
 
 /**
  * @brief The maximum number of times to run the loop in this demo.
@@ -187,13 +187,6 @@ static uint32_t currentPowerOnState = 0;
  */
 static bool stateChanged = false;
 
-/**
- * @brief When we send an update to the device shadow, and if we care about
- * the response from cloud (accepted/rejected), remember the clientToken and
- * use it to match with the response.
- */
-static uint32_t clientToken = 0U;
-
 /**
  * @brief Indicator that an error occurred during the MQTT event callback. If an
  * error occurred during the MQTT event callback, then the demo has failed.
@@ -218,6 +211,36 @@ static bool deleteResponseReceived = false;
  */
 static bool shadowDeleted = false;
 
+/**
+ * @brief Rules of the publishes queued while the connection to the broker is
+ * down.
+ *
+ * A newer report of the state makes an older one less useful, so reports
+ * drop the oldest when the queue is full, while a single `/get` or `/delete`
+ * request is enough.
+ */
+static const PublishQueueRule_t offlinePublishRules[] =
+{
+    {
+        SHADOW_TOPIC_STR_DELETE( THING_NAME, SHADOW_NAME ),
+        SHADOW_TOPIC_LEN_DELETE( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ),
+        0U,
+        PublishQueueDropNewest
+    },
+    {
+        SHADOW_TOPIC_STR_UPDATE( THING_NAME, SHADOW_NAME ),
+        SHADOW_TOPIC_LEN_UPDATE( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ),
+        1U,
+        PublishQueueDropOldest
+    },
+    {
+        SHADOW_TOPIC_STR_GET( THING_NAME, SHADOW_NAME ),
+        SHADOW_TOPIC_LEN_GET( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ),
+        2U,
+        PublishQueueDropNewest
+    }
+};
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -248,14 +271,27 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo );
 /**
  * @brief Process payload from /update/accepted topic.
  *
- * This handler examines the accepted message that carries the same clientToken
- * as sent before.
+ * This handler matches the clientToken of the accepted message with the
+ * reports awaiting a response, and drops the response to a report superseded
+ * by a later one.
  *
  * @param[in] pPublishInfo Deserialized publish info pointer for the incoming
  * packet.
  */
 static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo );
 
+/**
+ * @brief Process payload from /update/rejected topic.
+ *
+ * This handler matches the clientToken of the rejected message with the
+ * reports awaiting a response, so the rejection of a report superseded by a
+ * later one is dropped.
+ *
+ * @param[in] pPublishInfo Deserialized publish info pointer for the incoming
+ * packet.
+ */
+static void updateRejectedHandler( MQTTPublishInfo_t * pPublishInfo );
+
 /**
  * @brief Process payload from `/delete/rejected` topic.
  *
@@ -269,6 +305,20 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo );
  */
 static void deleteRejectedHandler( MQTTPublishInfo_t * pPublishInfo );
 
+/**
+ * @brief Report the members of the reported state that have changed since
+ * the last state accepted by the shadow.
+ *
+ * The whole state is compared with the cached reported state, and each
+ * changed member, or null for a removed one, is given to the report batcher.
+ *
+ * @param[in] powerOnState The power state of the device.
+ *
+ * @return EXIT_SUCCESS if the changes, if any, are given to the report
+ * batcher; EXIT_FAILURE otherwise.
+ */
+static int32_t reportChangedState( uint32_t powerOnState );
+
 /*-----------------------------------------------------------*/
 
 static void deleteRejectedHandler( MQTTPublishInfo_t * pPublishInfo )
@@ -338,12 +388,10 @@ static void deleteRejectedHandler( MQTTPublishInfo_t * pPublishInfo )
 
 static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
 {
-    static uint32_t currentVersion = 0; /* Remember the latestVersion # we've ever received */
-    uint32_t version = 0U;
     uint32_t newState = 0U;
-    char * outValue = NULL;
-    uint32_t outValueLength = 0U;
-    JSONStatus_t result = JSONSuccess;
+    const char * pPowerOn = NULL;
+    size_t powerOnLength = 0U;
+    ShadowCacheStatus_t cacheStatus = ShadowCacheSuccess;
 
     assert( pPublishInfo != NULL );
     assert( pPublishInfo->pPayload != NULL );
@@ -366,93 +414,67 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
      *  }
      */
 
-    /* Make sure the payload is a valid json document. */
-    result = JSON_Validate( pPublishInfo->pPayload,
-                            pPublishInfo->payloadLength );
-
-    if( result == JSONSuccess )
-    {
-        /* Then we start to get the version value by JSON keyword "version". */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "version",
-                              sizeof( "version" ) - 1,
-                              &outValue,
-                              ( size_t * ) &outValueLength );
-    }
-    else
-    {
-        LogError( ( "The json document is invalid!!" ) );
-        eventCallbackError = true;
-    }
+    /* Merge the delta into the local copy of the shadow. The cache compares
+     * the version of the delta with the version it holds, so a delta older
+     * than the cached state is not applied. */
+    cacheStatus = ShadowCache_ApplyDelta( pPublishInfo->pPayload,
+                                          pPublishInfo->payloadLength );
 
-    if( result == JSONSuccess )
-    {
-        LogInfo( ( "version: %.*s",
-                   outValueLength,
-                   outValue ) );
+    LogInfo( ( "version:%u, cache status:%d \r\n",
+               ( unsigned int ) ShadowCache_GetVersion(), ( int ) cacheStatus ) );
 
-        /* Convert the extracted value to an unsigned integer value. */
-        version = ( uint32_t ) strtoul( outValue, NULL, 10 );
-    }
-    else
+    if( cacheStatus == ShadowCacheBadParameter )
     {
-        LogError( ( "No version in json document!!" ) );
+        LogError( ( "The json document is invalid!!" ) );
         eventCallbackError = true;
     }
-
-    LogInfo( ( "version:%d, currentVersion:%d \r\n", version, currentVersion ) );
-
-    /* When the version is much newer than the on we retained, that means the powerOn
-     * state is valid for us. */
-    if( version > currentVersion )
-    {
-        /* Set to received version as the current version. */
-        currentVersion = version;
-
-        /* Get powerOn state from json documents. */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "state.powerOn",
-                              sizeof( "state.powerOn" ) - 1,
-                              &outValue,
-                              ( size_t * ) &outValueLength );
-    }
     else
     {
-        /* In this demo, we discard the incoming message
-         * if the version number is not newer than the latest
-         * that we've received before. Your application may use a
-         * different approach.
-         */
-        LogWarn( ( "The received version is smaller than current one!!" ) );
-    }
+        if( cacheStatus == ShadowCacheStale )
+        {
+            /* The delta is not newer than the local copy of the shadow, which
+             * may already hold the same update from /update/documents. The
+             * cached state is used rather than the delta. */
+            LogInfo( ( "The received version is not newer than the cached one." ) );
+        }
 
-    if( result == JSONSuccess )
-    {
-        /* Convert the powerOn state value to an unsigned integer value. */
-        newState = ( uint32_t ) strtoul( outValue, NULL, 10 );
+        /* Get powerOn state from the cached desired state. A delta that
+         * skipped versions is still applied; main() refreshes the cache with
+         * /get. */
+        if( ShadowCache_Get( ShadowCacheDesired,
+                             "powerOn",
+                             sizeof( "powerOn" ) - 1,
+                             &pPowerOn,
+                             &powerOnLength ) == ShadowCacheSuccess )
+        {
+            /* Convert the powerOn state value to an unsigned integer value. */
+            newState = ( uint32_t ) strtoul( pPowerOn, NULL, 10 );
 
-        LogInfo( ( "The new power on state newState:%d, currentPowerOnState:%d \r\n",
-                   newState, currentPowerOnState ) );
+            LogInfo( ( "The new power on state newState:%d, currentPowerOnState:%d \r\n",
+                       newState, currentPowerOnState ) );
 
-        if( newState != currentPowerOnState )
+            if( newState != currentPowerOnState )
+            {
+                /* The received powerOn state is different from the one we retained before, so we switch them
+                 * and set the flag. */
+                currentPowerOnState = newState;
+
+                /* State change will be handled in main(), where we will publish a "reported"
+                 * state to the device shadow. We do not do it here because we are inside of
+                 * a callback from the MQTT library, so that we don't re-enter
+                 * the MQTT library. */
+                stateChanged = true;
+            }
+        }
+        else if( cacheStatus != ShadowCacheStale )
         {
-            /* The received powerOn state is different from the one we retained before, so we switch them
-             * and set the flag. */
-            currentPowerOnState = newState;
-
-            /* State change will be handled in main(), where we will publish a "reported"
-             * state to the device shadow. We do not do it here because we are inside of
-             * a callback from the MQTT library, so that we don't re-enter
-             * the MQTT library. */
-            stateChanged = true;
+            LogError( ( "No powerOn in json document!!" ) );
+            eventCallbackError = true;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
         }
-    }
-    else
-    {
-        LogError( ( "No powerOn in json document!!" ) );
-        eventCallbackError = true;
     }
 }
 
@@ -460,10 +482,10 @@ static void updateDeltaHandler( MQTTPublishInfo_t * pPublishInfo )
 
 static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
 {
-    char * outValue = NULL;
-    uint32_t outValueLength = 0U;
     uint32_t receivedToken = 0U;
+    ReportResponse_t response = ReportResponseUnknown;
     JSONStatus_t result = JSONSuccess;
+    JSONExtractQuery_t clientTokenKey = { "clientToken", sizeof( "clientToken" ) - 1, NULL, 0U, JSONInvalid };
 
     assert( pPublishInfo != NULL );
     assert( pPublishInfo->pPayload != NULL );
@@ -500,12 +522,10 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
     if( result == JSONSuccess )
     {
         /* Get clientToken from json documents. */
-        result = JSON_Search( ( char * ) pPublishInfo->pPayload,
-                              pPublishInfo->payloadLength,
-                              "clientToken",
-                              sizeof( "clientToken" ) - 1,
-                              &outValue,
-                              ( size_t * ) &outValueLength );
+        result = JSONExtract_Search( pPublishInfo->pPayload,
+                                     pPublishInfo->payloadLength,
+                                     &( clientTokenKey ),
+                                     1U );
     }
     else
     {
@@ -515,26 +535,30 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
 
     if( result == JSONSuccess )
     {
-        LogInfo( ( "clientToken: %.*s", outValueLength,
-                   outValue ) );
+        LogInfo( ( "clientToken: %.*s", ( int ) clientTokenKey.valueLength,
+                   clientTokenKey.pValue ) );
 
         /* Convert the code to an unsigned integer value. */
-        receivedToken = ( uint32_t ) strtoul( outValue, NULL, 10 );
+        receivedToken = ( uint32_t ) strtoul( clientTokenKey.pValue, NULL, 10 );
 
-        LogInfo( ( "receivedToken:%d, clientToken:%u \r\n", receivedToken, clientToken ) );
+        /* The batcher tells whether the accepted report still holds the
+         * latest published value of one of its fields. */
+        response = ReceiveReportResponse( receivedToken );
 
-        /* If the clientToken in this update/accepted message matches the one we
-         * published before, it means the device shadow has accepted our latest
-         * reported state. We are done. */
-        if( receivedToken == clientToken )
+        if( response == ReportResponseCurrent )
         {
             LogInfo( ( "Received response from the device shadow. Previously published "
-                       "update with clientToken=%u has been accepted. ", clientToken ) );
+                       "update with clientToken=%u has been accepted. ", receivedToken ) );
+        }
+        else if( response == ReportResponseSuperseded )
+        {
+            LogInfo( ( "Drop the response to the update with clientToken=%u, "
+                       "superseded by a later update.", receivedToken ) );
         }
         else
         {
-            LogWarn( ( "The received clientToken=%u is not identical with the one=%u we sent "
-                       , receivedToken, clientToken ) );
+            LogWarn( ( "The received clientToken=%u is not one of the updates awaiting a response.",
+                       receivedToken ) );
         }
     }
     else
@@ -546,6 +570,65 @@ static void updateAcceptedHandler( MQTTPublishInfo_t * pPublishInfo )
 
 /*-----------------------------------------------------------*/
 
+static void updateRejectedHandler( MQTTPublishInfo_t * pPublishInfo )
+{
+    uint32_t receivedToken = 0U;
+    JSONStatus_t result = JSONSuccess;
+    JSONExtractQuery_t clientTokenKey = { "clientToken", sizeof( "clientToken" ) - 1, NULL, 0U, JSONInvalid };
+
+    assert( pPublishInfo != NULL );
+    assert( pPublishInfo->pPayload != NULL );
+
+    LogInfo( ( "/update/rejected json payload:%s.", ( const char * ) pPublishInfo->pPayload ) );
+
+    /* The payload will look similar to this:
+     * {
+     *    "code": error-code,
+     *    "message": "error-message",
+     *    "timestamp": timestamp,
+     *    "clientToken": "token"
+     * }
+     */
+
+    /* Make sure the payload is a valid json document. */
+    result = JSON_Validate( pPublishInfo->pPayload,
+                            pPublishInfo->payloadLength );
+
+    if( result == JSONSuccess )
+    {
+        result = JSONExtract_Search( pPublishInfo->pPayload,
+                                     pPublishInfo->payloadLength,
+                                     &( clientTokenKey ),
+                                     1U );
+    }
+    else
+    {
+        LogError( ( "The json document is invalid!!" ) );
+    }
+
+    if( result == JSONSuccess )
+    {
+        /* Convert the code to an unsigned integer value. */
+        receivedToken = ( uint32_t ) strtoul( clientTokenKey.pValue, NULL, 10 );
+
+        if( ReceiveReportResponse( receivedToken ) == ReportResponseSuperseded )
+        {
+            LogInfo( ( "Drop the rejection of the update with clientToken=%u, "
+                       "superseded by a later update.", receivedToken ) );
+        }
+        else
+        {
+            LogWarn( ( "The update with clientToken=%u has been rejected.", receivedToken ) );
+        }
+    }
+    else
+    {
+        LogWarn( ( "An update without clientToken has been rejected." ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 /* This is the callback function invoked by the MQTT stack when it receives
  * incoming messages. This function demonstrates how to use the Shadow_MatchTopicString
  * function to determine whether the incoming message is a device shadow message
@@ -560,6 +643,8 @@ static void eventCallback( MQTTContext_t * pMqttContext,
     uint16_t thingNameLength = 0U;
     const char * pShadowName = NULL;
     uint16_t shadowNameLength = 0U;
+    uint16_t shadowId = 0U;
+    bool isShadowMessage = false;
     uint16_t packetIdentifier;
 
     ( void ) pMqttContext;
@@ -578,14 +663,32 @@ static void eventCallback( MQTTContext_t * pMqttContext,
         assert( pDeserializedInfo->pPublishInfo != NULL );
         LogInfo( ( "pPublishInfo->pTopicName:%s.", pDeserializedInfo->pPublishInfo->pTopicName ) );
 
-        /* Let the Device Shadow library tell us whether this is a device shadow message. */
-        if( SHADOW_SUCCESS == Shadow_MatchTopicString( pDeserializedInfo->pPublishInfo->pTopicName,
-                                                       pDeserializedInfo->pPublishInfo->topicNameLength,
-                                                       &messageType,
-                                                       &pThingName,
-                                                       &thingNameLength,
-                                                       &pShadowName,
-                                                       &shadowNameLength ) )
+        /* The topics of the registered shadows are found without parsing
+         * them. Let the Device Shadow library tell us whether any other topic
+         * is a device shadow message. */
+        if( ShadowTopicTable_Lookup( pDeserializedInfo->pPublishInfo->pTopicName,
+                                     pDeserializedInfo->pPublishInfo->topicNameLength,
+                                     &messageType,
+                                     &shadowId ) == ShadowTopicTableSuccess )
+        {
+            isShadowMessage = true;
+        }
+        else if( SHADOW_SUCCESS == Shadow_MatchTopicString( pDeserializedInfo->pPublishInfo->pTopicName,
+                                                            pDeserializedInfo->pPublishInfo->topicNameLength,
+                                                            &messageType,
+                                                            &pThingName,
+                                                            &thingNameLength,
+                                                            &pShadowName,
+                                                            &shadowNameLength ) )
+        {
+            isShadowMessage = true;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        if( isShadowMessage == true )
         {
             /* Upon successful return, the messageType has been filled in. */
             if( messageType == ShadowMessageTypeUpdateDelta )
@@ -601,16 +704,41 @@ static void eventCallback( MQTTContext_t * pMqttContext,
             else if( messageType == ShadowMessageTypeUpdateDocuments )
             {
                 LogInfo( ( "/update/documents json payload:%s.", ( const char * ) pDeserializedInfo->pPublishInfo->pPayload ) );
+
+                /* The document holds the whole state after the update, which
+                 * replaces the local copy of the shadow. */
+                if( ShadowCache_ApplyDocuments( pDeserializedInfo->pPublishInfo->pPayload,
+                                                pDeserializedInfo->pPublishInfo->payloadLength ) == ShadowCacheBadParameter )
+                {
+                    LogError( ( "The /update/documents json document is invalid!!" ) );
+                    eventCallbackError = true;
+                }
+            }
+            else if( messageType == ShadowMessageTypeGetAccepted )
+            {
+                LogInfo( ( "/get/accepted json payload:%s.", ( const char * ) pDeserializedInfo->pPublishInfo->pPayload ) );
+
+                if( ShadowCache_ApplyGet( pDeserializedInfo->pPublishInfo->pPayload,
+                                          pDeserializedInfo->pPublishInfo->payloadLength ) == ShadowCacheBadParameter )
+                {
+                    LogError( ( "The /get/accepted json document is invalid!!" ) );
+                    eventCallbackError = true;
+                }
             }
             else if( messageType == ShadowMessageTypeUpdateRejected )
             {
-                LogInfo( ( "/update/rejected json payload:%s.", ( const char * ) pDeserializedInfo->pPublishInfo->pPayload ) );
+                /* Handler function to process payload. */
+                updateRejectedHandler( pDeserializedInfo->pPublishInfo );
             }
             else if( messageType == ShadowMessageTypeDeleteAccepted )
             {
                 LogInfo( ( "Received an MQTT incoming publish on /delete/accepted topic." ) );
                 shadowDeleted = true;
                 deleteResponseReceived = true;
+
+                /* The local copy of the shadow is empty until the next update. */
+                ( void ) ShadowCache_ApplyDeleted( pDeserializedInfo->pPublishInfo->pPayload,
+                                                   pDeserializedInfo->pPublishInfo->payloadLength );
             }
             else if( messageType == ShadowMessageTypeDeleteRejected )
             {
@@ -637,6 +765,60 @@ static void eventCallback( MQTTContext_t * pMqttContext,
 
 /*-----------------------------------------------------------*/
 
+static int32_t reportChangedState( uint32_t powerOnState )
+{
+    int32_t returnStatus = EXIT_SUCCESS;
+    char state[ SHADOW_REPORTED_STATE_JSON_LENGTH ] = { 0 };
+    char diff[ SHADOW_REPORTED_DIFF_MAX_LENGTH ];
+    size_t diffLength = 0U, start = 0U, next = 0U;
+    JSONPair_t pair = { 0 };
+    const char * pValue = NULL;
+    size_t valueLength = 0U;
+
+    ( void ) snprintf( state,
+                       sizeof( state ),
+                       SHADOW_REPORTED_STATE_JSON,
+                       ( powerOnState != 0U ) ? 1 : 0 );
+
+    if( ShadowCache_DiffReported( state, sizeof( state ) - 1U,
+                                  diff, sizeof( diff ),
+                                  &diffLength ) != ShadowCacheSuccess )
+    {
+        LogError( ( "Failed to compare the reported state with the shadow: %s", state ) );
+        returnStatus = EXIT_FAILURE;
+    }
+    else
+    {
+        LogDebug( ( "Changes of the reported state: %.*s", ( int ) diffLength, diff ) );
+    }
+
+    /* Each top level member of the changes is a field of the report, whose
+     * value is its JSON text. */
+    while( ( returnStatus == EXIT_SUCCESS ) &&
+           ( JSON_Iterate( diff, diffLength, &start, &next, &pair ) == JSONSuccess ) )
+    {
+        pValue = pair.value;
+        valueLength = pair.valueLength;
+
+        /* The value of a string excludes its quotes, which are around it. */
+        if( pair.jsonType == JSONString )
+        {
+            pValue--;
+            valueLength += 2U;
+        }
+
+        returnStatus = ReportField( pair.key,
+                                    ( uint16_t ) pair.keyLength,
+                                    pValue,
+                                    ( uint16_t ) valueLength,
+                                    true );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Entry point of shadow demo.
  *
@@ -649,10 +831,17 @@ static void eventCallback( MQTTContext_t * pMqttContext,
  * - SHADOW_TOPIC_STR_UPDATE_DELTA for "$aws/things/thingName/shadow[/name/shadowname]/update/delta"
  * - SHADOW_TOPIC_STR_UPDATE_ACC for "$aws/things/thingName/shadow[/name/shadowname]/update/accepted"
  * - SHADOW_TOPIC_STR_UPDATE_REJ for "$aws/things/thingName/shadow[/name/shadowname]/update/rejected"
+ * - SHADOW_TOPIC_STR_UPDATE_DOCS for "$aws/things/thingName/shadow[/name/shadowname]/update/documents"
+ * - SHADOW_TOPIC_STR_GET_ACC for "$aws/things/thingName/shadow[/name/shadowname]/get/accepted"
  *
  * It also uses these macros for topics to publish to:
  * - SHADOW_TOPIC_STR_DELETE for "$aws/things/thingName/shadow[/name/shadowname]/delete"
  * - SHADOW_TOPIC_STR_UPDATE for "$aws/things/thingName/shadow[/name/shadowname]/update"
+ * - SHADOW_TOPIC_STR_GET for "$aws/things/thingName/shadow[/name/shadowname]/get"
+ *
+ * The documents and deltas of the shadow are applied to a local copy of the
+ * shadow, in shadow_cache.c, which is refreshed with /get only when it has
+ * missed a version.
  *
  * The helper functions this demo uses for MQTT operations have internal
  * loops to process incoming messages. Those are not the focus of this demo
@@ -663,14 +852,34 @@ int main( int argc,
 {
     int returnStatus = EXIT_SUCCESS;
     int demoRunCount = 0;
+    uint16_t shadowId = 0U;
 
     /* A buffer containing the update document. It has static duration to prevent
      * it from being placed on the call stack. */
-    static char updateDocument[ SHADOW_REPORTED_JSON_LENGTH + 1 ] = { 0 };
+    static char updateDocument[ SHADOW_DESIRED_JSON_LENGTH + 1 ] = { 0 };
 
     ( void ) argc;
     ( void ) argv;
 
+    /* The publishes issued while the connection is down are queued by the
+     * helpers, and sent after the next reconnect. */
+    ( void ) InitOfflinePublishQueue( offlinePublishRules,
+                                      sizeof( offlinePublishRules ) / sizeof( offlinePublishRules[ 0 ] ) );
+
+    /* The topics of the shadow are assembled once, so that the incoming
+     * messages are classified without parsing their topic. A gateway
+     * registers each of the shadows it proxies. */
+    ShadowTopicTable_Init();
+
+    if( ShadowTopicTable_Register( THING_NAME,
+                                   ( uint8_t ) THING_NAME_LENGTH,
+                                   SHADOW_NAME,
+                                   ( uint8_t ) SHADOW_NAME_LENGTH,
+                                   &shadowId ) != ShadowTopicTableSuccess )
+    {
+        LogWarn( ( "Failed to register the topics of the shadow: Its messages are classified by parsing their topic." ) );
+    }
+
     do
     {
         returnStatus = EstablishMqttSession( eventCallback );
@@ -686,6 +895,13 @@ int main( int argc,
             deleteResponseReceived = false;
             shadowDeleted = false;
 
+            /* The state of the shadow is unknown until its next document. */
+            ShadowCache_Init();
+
+            /* The reports of a previous session are not awaited anymore. */
+            InitReportBatcher( SHADOW_TOPIC_STR_UPDATE( THING_NAME, SHADOW_NAME ),
+                               SHADOW_TOPIC_LEN_UPDATE( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ) );
+
             /* First of all, try to delete any Shadow document in the cloud.
              * Try to subscribe to `/delete/accepted` and `/delete/rejected` topics. */
             returnStatus = SubscribeToTopic( SHADOW_TOPIC_STR_DELETE_ACC( THING_NAME, SHADOW_NAME ),
@@ -765,6 +981,20 @@ int main( int argc,
                                                  SHADOW_TOPIC_LEN_UPDATE_REJ( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ) );
             }
 
+            /* The documents and the /get responses keep the local copy of the
+             * shadow up to date. */
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                returnStatus = SubscribeToTopic( SHADOW_TOPIC_STR_UPDATE_DOCS( THING_NAME, SHADOW_NAME ),
+                                                 SHADOW_TOPIC_LEN_UPDATE_DOCS( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ) );
+            }
+
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                returnStatus = SubscribeToTopic( SHADOW_TOPIC_STR_GET_ACC( THING_NAME, SHADOW_NAME ),
+                                                 SHADOW_TOPIC_LEN_GET_ACC( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ) );
+            }
+
             /* This demo uses a constant #THING_NAME and #SHADOW_NAME known at compile time therefore
              * we can use macros to assemble shadow topic strings.
              * If the thing name or shadow name is only known at run time, then we could use the API
@@ -821,6 +1051,19 @@ int main( int argc,
                                                ( SHADOW_DESIRED_JSON_LENGTH + 1 ) );
             }
 
+            /* Refresh the local copy of the shadow if it missed a version.
+             * As for the reported state, this is done here rather than in the
+             * callback, so as not to re-enter the MQTT library. */
+            if( ( returnStatus == EXIT_SUCCESS ) && ( ShadowCache_IsResyncNeeded() == true ) )
+            {
+                LogInfo( ( "Refresh the local copy of the shadow with /get." ) );
+
+                returnStatus = PublishToTopic( SHADOW_TOPIC_STR_GET( THING_NAME, SHADOW_NAME ),
+                                               SHADOW_TOPIC_LEN_GET( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ),
+                                               updateDocument,
+                                               0U );
+            }
+
             if( returnStatus == EXIT_SUCCESS )
             {
                 /* Note that PublishToTopic already called MQTT_ProcessLoop,
@@ -831,26 +1074,21 @@ int main( int argc,
                  */
                 if( stateChanged == true )
                 {
-                    /* Report the latest power state back to device shadow. */
+                    /* Report the latest power state back to device shadow.
+                     * The report batcher merges the fields set since its last
+                     * report into one document with its own clientToken; the
+                     * power state is a priority field, so it is published now
+                     * rather than after REPORT_BATCHER_MAX_DELAY_MS. Only
+                     * the fields that differ from the reported state last
+                     * accepted by the shadow are given to it. */
                     LogInfo( ( "Report to the state change: %d", currentPowerOnState ) );
-                    ( void ) memset( updateDocument,
-                                     0x00,
-                                     sizeof( updateDocument ) );
-
-                    /* Keep the client token in global variable used to compare if
-                     * the same token in /update/accepted. */
-                    clientToken = ( Clock_GetTimeMs() % 1000000 );
-
-                    snprintf( updateDocument,
-                              SHADOW_REPORTED_JSON_LENGTH + 1,
-                              SHADOW_REPORTED_JSON,
-                              ( int ) currentPowerOnState,
-                              ( long unsigned ) clientToken );
-
-                    returnStatus = PublishToTopic( SHADOW_TOPIC_STR_UPDATE( THING_NAME, SHADOW_NAME ),
-                                                   SHADOW_TOPIC_LEN_UPDATE( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ),
-                                                   updateDocument,
-                                                   ( SHADOW_REPORTED_JSON_LENGTH + 1 ) );
+
+                    returnStatus = reportChangedState( currentPowerOnState );
+
+                    if( returnStatus == EXIT_SUCCESS )
+                    {
+                        returnStatus = FlushReportBatcher( false );
+                    }
                 }
                 else
                 {
@@ -877,6 +1115,18 @@ int main( int argc,
                                                      SHADOW_TOPIC_LEN_UPDATE_REJ( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ) );
             }
 
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                returnStatus = UnsubscribeFromTopic( SHADOW_TOPIC_STR_UPDATE_DOCS( THING_NAME, SHADOW_NAME ),
+                                                     SHADOW_TOPIC_LEN_UPDATE_DOCS( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ) );
+            }
+
+            if( returnStatus == EXIT_SUCCESS )
+            {
+                returnStatus = UnsubscribeFromTopic( SHADOW_TOPIC_STR_GET_ACC( THING_NAME, SHADOW_NAME ),
+                                                     SHADOW_TOPIC_LEN_GET_ACC( THING_NAME_LENGTH, SHADOW_NAME_LENGTH ) );
+            }
+
             /* The MQTT session is always disconnected, even there were prior failures. */
             returnStatus = DisconnectMqttSession();
         }
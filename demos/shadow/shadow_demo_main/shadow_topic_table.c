@@ -0,0 +1,358 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_topic_table.c
+ * @brief A table of the response topics of the registered shadows.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <string.h>
+
+#include "shadow_topic_table.h"
+
+#if ( ( SHADOW_TOPIC_TABLE_SLOTS & ( SHADOW_TOPIC_TABLE_SLOTS - 1U ) ) != 0U )
+    #error "SHADOW_TOPIC_TABLE_SLOTS must be a power of two."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of message types of a shadow.
+ */
+#define MESSAGE_TYPE_COUNT    ( ( uint32_t ) ShadowMessageTypeMaxNum )
+
+/**
+ * @brief Maximum number of topics in the table.
+ */
+#define MAX_TOPICS            ( SHADOW_TOPIC_TABLE_MAX_SHADOWS * MESSAGE_TYPE_COUNT )
+
+/**
+ * @brief Offset basis of the 32-bit FNV-1a hash.
+ */
+#define FNV_OFFSET_BASIS      ( 2166136261U )
+
+/**
+ * @brief Prime of the 32-bit FNV-1a hash.
+ */
+#define FNV_PRIME             ( 16777619U )
+
+/**
+ * @brief A message type of a shadow and the type of its topic string.
+ */
+typedef struct MessageTopic
+{
+    ShadowMessageType_t messageType;   /**< @brief The type of the messages. */
+    ShadowTopicStringType_t topicType; /**< @brief The topic of the messages. */
+} MessageTopic_t;
+
+/**
+ * @brief A topic of a registered shadow.
+ */
+typedef struct TopicEntry
+{
+    uint32_t hash;                   /**< @brief Hash of the topic. */
+    uint32_t offset;                 /**< @brief Offset of the topic in #topicPool. */
+    uint16_t length;                 /**< @brief Length of the topic. */
+    uint16_t shadowId;               /**< @brief ID of the shadow of the topic. */
+    ShadowMessageType_t messageType; /**< @brief Type of the messages of the topic. */
+} TopicEntry_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The topics registered for each shadow, one for each message type.
+ */
+static const MessageTopic_t messageTopics[] =
+{
+    { ShadowMessageTypeGetAccepted,     ShadowTopicStringTypeGetAccepted     },
+    { ShadowMessageTypeGetRejected,     ShadowTopicStringTypeGetRejected     },
+    { ShadowMessageTypeDeleteAccepted,  ShadowTopicStringTypeDeleteAccepted  },
+    { ShadowMessageTypeDeleteRejected,  ShadowTopicStringTypeDeleteRejected  },
+    { ShadowMessageTypeUpdateAccepted,  ShadowTopicStringTypeUpdateAccepted  },
+    { ShadowMessageTypeUpdateRejected,  ShadowTopicStringTypeUpdateRejected  },
+    { ShadowMessageTypeUpdateDocuments, ShadowTopicStringTypeUpdateDocuments },
+    { ShadowMessageTypeUpdateDelta,     ShadowTopicStringTypeUpdateDelta     }
+};
+
+/**
+ * @brief The topics of the registered shadows, in the order of registration.
+ */
+static TopicEntry_t topics[ MAX_TOPICS ];
+
+/**
+ * @brief The hash table of the topics: each slot holds 1 plus the index of a
+ * topic of #topics, or 0 if it is empty. Collisions are resolved by linear
+ * probing.
+ */
+static uint32_t slots[ SHADOW_TOPIC_TABLE_SLOTS ];
+
+/**
+ * @brief The strings of the topics, not terminated.
+ */
+static char topicPool[ SHADOW_TOPIC_TABLE_POOL_SIZE ];
+
+/**
+ * @brief Number of entries of #topics in use.
+ */
+static uint32_t topicCount = 0U;
+
+/**
+ * @brief Number of bytes of #topicPool in use.
+ */
+static uint32_t topicPoolUsed = 0U;
+
+/**
+ * @brief Number of registered shadows.
+ */
+static uint16_t shadowCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Hash a topic.
+ *
+ * @param[in] pTopic The topic.
+ * @param[in] topicLength Length of @p pTopic.
+ *
+ * @return The 32-bit FNV-1a hash of the topic.
+ */
+static uint32_t hashTopic( const char * pTopic,
+                           uint16_t topicLength );
+
+/**
+ * @brief Find the slot of a topic.
+ *
+ * @param[in] pTopic The topic.
+ * @param[in] topicLength Length of @p pTopic.
+ * @param[in] hash The hash of the topic.
+ * @param[out] pOutSlot The slot of the topic if it is found, otherwise the
+ * empty slot where it is to be inserted.
+ *
+ * @return true if the topic is in the table; false otherwise.
+ */
+static bool findTopic( const char * pTopic,
+                       uint16_t topicLength,
+                       uint32_t hash,
+                       uint32_t * pOutSlot );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t hashTopic( const char * pTopic,
+                           uint16_t topicLength )
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    uint16_t i = 0U;
+
+    for( i = 0U; i < topicLength; i++ )
+    {
+        hash ^= ( uint32_t ) ( uint8_t ) pTopic[ i ];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool findTopic( const char * pTopic,
+                       uint16_t topicLength,
+                       uint32_t hash,
+                       uint32_t * pOutSlot )
+{
+    bool found = false;
+    uint32_t slot = hash & ( SHADOW_TOPIC_TABLE_SLOTS - 1U );
+    const TopicEntry_t * pEntry = NULL;
+
+    /* At most half of the slots are used, so an empty slot ends the probes. */
+    while( ( found == false ) && ( slots[ slot ] != 0U ) )
+    {
+        pEntry = &topics[ slots[ slot ] - 1U ];
+
+        if( ( pEntry->hash == hash ) &&
+            ( pEntry->length == topicLength ) &&
+            ( memcmp( &topicPool[ pEntry->offset ], pTopic, topicLength ) == 0 ) )
+        {
+            found = true;
+        }
+        else
+        {
+            slot = ( slot + 1U ) & ( SHADOW_TOPIC_TABLE_SLOTS - 1U );
+        }
+    }
+
+    *pOutSlot = slot;
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+void ShadowTopicTable_Init( void )
+{
+    ( void ) memset( slots, 0, sizeof( slots ) );
+    topicCount = 0U;
+    topicPoolUsed = 0U;
+    shadowCount = 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowTopicTableStatus_t ShadowTopicTable_Register( const char * pThingName,
+                                                    uint8_t thingNameLength,
+                                                    const char * pShadowName,
+                                                    uint8_t shadowNameLength,
+                                                    uint16_t * pOutShadowId )
+{
+    ShadowTopicTableStatus_t status = ShadowTopicTableSuccess;
+    ShadowStatus_t shadowStatus = SHADOW_SUCCESS;
+    uint32_t firstTopic = topicCount;
+    uint32_t poolRemaining = 0U;
+    uint32_t slot = 0U;
+    uint32_t hash = 0U;
+    uint16_t topicLength = 0U;
+    bool registered = false;
+    size_t i = 0U;
+
+    if( ( pThingName == NULL ) ||
+        ( thingNameLength == 0U ) ||
+        ( ( pShadowName == NULL ) && ( shadowNameLength != 0U ) ) ||
+        ( pOutShadowId == NULL ) )
+    {
+        status = ShadowTopicTableBadParameter;
+    }
+
+    for( i = 0U; ( status == ShadowTopicTableSuccess ) && ( registered == false ) && ( i < MESSAGE_TYPE_COUNT ); i++ )
+    {
+        poolRemaining = SHADOW_TOPIC_TABLE_POOL_SIZE - topicPoolUsed;
+
+        shadowStatus = Shadow_AssembleTopicString( messageTopics[ i ].topicType,
+                                                   pThingName,
+                                                   thingNameLength,
+                                                   pShadowName,
+                                                   shadowNameLength,
+                                                   &topicPool[ topicPoolUsed ],
+                                                   ( poolRemaining > UINT16_MAX ) ? UINT16_MAX : ( uint16_t ) poolRemaining,
+                                                   &topicLength );
+
+        if( shadowStatus == SHADOW_BUFFER_TOO_SMALL )
+        {
+            status = ShadowTopicTableNoSpace;
+        }
+        else if( shadowStatus != SHADOW_SUCCESS )
+        {
+            status = ShadowTopicTableBadParameter;
+        }
+        else
+        {
+            hash = hashTopic( &topicPool[ topicPoolUsed ], topicLength );
+
+            if( findTopic( &topicPool[ topicPoolUsed ], topicLength, hash, &slot ) == true )
+            {
+                /* The topics of a shadow are registered together, so its
+                 * first topic tells whether it is registered. */
+                *pOutShadowId = topics[ slots[ slot ] - 1U ].shadowId;
+                registered = true;
+            }
+            else if( ( shadowCount >= SHADOW_TOPIC_TABLE_MAX_SHADOWS ) ||
+                     ( ( topicCount + 1U ) > ( SHADOW_TOPIC_TABLE_SLOTS / 2U ) ) )
+            {
+                status = ShadowTopicTableNoSpace;
+            }
+            else
+            {
+                topics[ topicCount ].hash = hash;
+                topics[ topicCount ].offset = topicPoolUsed;
+                topics[ topicCount ].length = topicLength;
+                topics[ topicCount ].shadowId = shadowCount;
+                topics[ topicCount ].messageType = messageTopics[ i ].messageType;
+
+                topicCount++;
+                slots[ slot ] = topicCount;
+                topicPoolUsed += topicLength;
+            }
+        }
+    }
+
+    if( ( status == ShadowTopicTableSuccess ) && ( registered == false ) )
+    {
+        *pOutShadowId = shadowCount;
+        shadowCount++;
+    }
+    else if( status != ShadowTopicTableSuccess )
+    {
+        /* The topics of the shadow were the last ones inserted, so removing
+         * them leaves the probes of the other topics intact. */
+        while( topicCount > firstTopic )
+        {
+            topicCount--;
+            ( void ) findTopic( &topicPool[ topics[ topicCount ].offset ],
+                                topics[ topicCount ].length,
+                                topics[ topicCount ].hash,
+                                &slot );
+            slots[ slot ] = 0U;
+            topicPoolUsed = topics[ topicCount ].offset;
+        }
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+ShadowTopicTableStatus_t ShadowTopicTable_Lookup( const char * pTopic,
+                                                  uint16_t topicLength,
+                                                  ShadowMessageType_t * pOutMessageType,
+                                                  uint16_t * pOutShadowId )
+{
+    ShadowTopicTableStatus_t status = ShadowTopicTableNotFound;
+    uint32_t slot = 0U;
+    const TopicEntry_t * pEntry = NULL;
+
+    if( ( pTopic == NULL ) ||
+        ( topicLength == 0U ) ||
+        ( pOutMessageType == NULL ) ||
+        ( pOutShadowId == NULL ) )
+    {
+        status = ShadowTopicTableBadParameter;
+    }
+    else if( findTopic( pTopic, topicLength, hashTopic( pTopic, topicLength ), &slot ) == true )
+    {
+        pEntry = &topics[ slots[ slot ] - 1U ];
+        *pOutMessageType = pEntry->messageType;
+        *pOutShadowId = pEntry->shadowId;
+        status = ShadowTopicTableSuccess;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,129 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file shadow_topic_table.h
+ * @brief A table of the response topics of the registered shadows, for
+ * classifying incoming messages without parsing their topic.
+ *
+ * Registering a shadow, classic or named, assembles the topics of all its
+ * message types once, with #Shadow_AssembleTopicString. An incoming topic
+ * is then found with one hash of its bytes and one comparison, whatever the
+ * number of things and shadows, which gives the message type and the ID of
+ * the shadow that #Shadow_MatchTopicString would find by parsing the topic.
+ *
+ * The table is not thread safe; it is meant to be filled before subscribing
+ * and then read by the thread that processes the MQTT messages.
+ */
+
+#ifndef SHADOW_TOPIC_TABLE_H_
+#define SHADOW_TOPIC_TABLE_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* SHADOW API header. */
+#include "shadow.h"
+
+/**
+ * @brief Maximum number of shadows registered in the table. Each (thing,
+ * shadow) pair counts once.
+ */
+#ifndef SHADOW_TOPIC_TABLE_MAX_SHADOWS
+    #define SHADOW_TOPIC_TABLE_MAX_SHADOWS    ( 8U )
+#endif
+
+/**
+ * @brief Bytes for the topics of all the registered shadows.
+ *
+ * The topics of a shadow take about eight times the length of its
+ * `/update/documents` topic.
+ */
+#ifndef SHADOW_TOPIC_TABLE_POOL_SIZE
+    #define SHADOW_TOPIC_TABLE_POOL_SIZE    ( SHADOW_TOPIC_TABLE_MAX_SHADOWS * 1024U )
+#endif
+
+/**
+ * @brief Number of slots of the hash table of the topics, a power of two.
+ *
+ * At most half of the slots are used, so at least 16 slots are needed for
+ * each shadow.
+ */
+#ifndef SHADOW_TOPIC_TABLE_SLOTS
+    #define SHADOW_TOPIC_TABLE_SLOTS    ( 128U )
+#endif
+
+/**
+ * @brief Return codes of the shadow topic table.
+ */
+typedef enum ShadowTopicTableStatus
+{
+    ShadowTopicTableSuccess = 0,  /**< @brief The shadow is registered, or the topic is found. */
+    ShadowTopicTableBadParameter, /**< @brief A name or a topic is invalid. */
+    ShadowTopicTableNoSpace,      /**< @brief The shadow does not fit in the table. */
+    ShadowTopicTableNotFound      /**< @brief The topic is not the topic of a registered shadow. */
+} ShadowTopicTableStatus_t;
+
+/**
+ * @brief Empty the table.
+ */
+void ShadowTopicTable_Init( void );
+
+/**
+ * @brief Add the topics of the messages of a shadow to the table.
+ *
+ * Registering a shadow again gives the ID of its first registration.
+ *
+ * @param[in] pThingName The name of the thing.
+ * @param[in] thingNameLength Length of @p pThingName.
+ * @param[in] pShadowName The name of the shadow, or #SHADOW_NAME_CLASSIC.
+ * @param[in] shadowNameLength Length of @p pShadowName.
+ * @param[out] pOutShadowId The ID of the shadow, from 0 in the order of
+ * registration.
+ *
+ * @return #ShadowTopicTableSuccess, #ShadowTopicTableBadParameter or
+ * #ShadowTopicTableNoSpace.
+ */
+ShadowTopicTableStatus_t ShadowTopicTable_Register( const char * pThingName,
+                                                    uint8_t thingNameLength,
+                                                    const char * pShadowName,
+                                                    uint8_t shadowNameLength,
+                                                    uint16_t * pOutShadowId );
+
+/**
+ * @brief Find the message type and the shadow of an incoming topic.
+ *
+ * @param[in] pTopic The topic of the message.
+ * @param[in] topicLength Length of @p pTopic.
+ * @param[out] pOutMessageType The type of the message.
+ * @param[out] pOutShadowId The ID of the shadow given by
+ * #ShadowTopicTable_Register.
+ *
+ * @return #ShadowTopicTableSuccess, #ShadowTopicTableNotFound or
+ * #ShadowTopicTableBadParameter.
+ */
+ShadowTopicTableStatus_t ShadowTopicTable_Lookup( const char * pTopic,
+                                                  uint16_t topicLength,
+                                                  ShadowMessageType_t * pOutMessageType,
+                                                  uint16_t * pOutShadowId );
+
+#endif /* ifndef SHADOW_TOPIC_TABLE_H_ */
@@ -0,0 +1,11 @@
+# This file is to add source files and include directories
+# into variables so that it can be reused from different demos
+# in their Cmake based build system by including this file.
+
+# Thing topics source files.
+set( THING_TOPICS_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/thing_topics.c )
+
+# Thing topics include directories.
+set( THING_TOPICS_INCLUDE_DIRS
+     ${CMAKE_CURRENT_LIST_DIR} )
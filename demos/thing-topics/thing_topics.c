@@ -0,0 +1,212 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file thing_topics.c
+ * @brief Implementation of the reserved topics of a thing.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <string.h>
+
+/* Include header for the thing topics. */
+#include "thing_topics.h"
+
+/**
+ * @brief Entry of #topicSuffixes, with the null-terminated @p suffix.
+ */
+#define THING_TOPIC_SUFFIX( suffix )    { suffix, ( uint16_t ) ( sizeof( suffix ) - 1U ) }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The suffix of a reserved topic, following the thing name.
+ */
+typedef struct ThingTopicSuffix
+{
+    const char * pSuffix; /**< @brief The suffix. */
+    uint16_t length;      /**< @brief Length of #ThingTopicSuffix_t.pSuffix. */
+} ThingTopicSuffix_t;
+
+/**
+ * @brief The suffixes of the reserved topics, in the order of #ThingTopic_t.
+ */
+static const ThingTopicSuffix_t topicSuffixes[ ThingTopicCount ] =
+{
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_UPDATE ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_UPDATE_ACCEPTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_UPDATE_REJECTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_UPDATE_DELTA ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_UPDATE_DOCUMENTS ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_UPDATE_RESPONSES ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_GET ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_GET_ACCEPTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_GET_REJECTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_GET_RESPONSES ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_DELETE ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_DELETE_ACCEPTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_DELETE_REJECTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_SHADOW_DELETE_RESPONSES ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_NOTIFY ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_NOTIFY_NEXT ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_GET ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_GET_ACCEPTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_GET_REJECTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_GET_RESPONSES ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_START_NEXT ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_START_NEXT_ACCEPTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_START_NEXT_REJECTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_START_NEXT_RESPONSES ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_NEXT_GET ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_NEXT_GET_ACCEPTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_NEXT_GET_REJECTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_JOBS_NEXT_GET_RESPONSES ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_DEFENDER_JSON ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_DEFENDER_JSON_ACCEPTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_DEFENDER_JSON_REJECTED ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_DEFENDER_JSON_RESPONSES ),
+    THING_TOPIC_SUFFIX( THING_TOPIC_SUFFIX_STREAMS_DATA_CBOR )
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether a thing name is valid in a topic: neither empty nor too
+ * long, and without the / separating the topic levels or the wildcards of
+ * MQTT.
+ *
+ * @param[in] pThingName The thing name.
+ * @param[in] thingNameLength Length of @p pThingName.
+ *
+ * @return true if the thing name is valid; false otherwise.
+ */
+static bool isValidThingName( const char * pThingName,
+                              uint16_t thingNameLength );
+
+/*-----------------------------------------------------------*/
+
+static bool isValidThingName( const char * pThingName,
+                              uint16_t thingNameLength )
+{
+    bool valid = ( thingNameLength > 0U ) && ( thingNameLength <= THING_TOPICS_THING_NAME_MAX_LENGTH );
+    uint16_t i = 0U;
+
+    for( i = 0U; ( i < thingNameLength ) && ( valid == true ); i++ )
+    {
+        valid = ( pThingName[ i ] != '/' ) && ( pThingName[ i ] != '+' ) &&
+                ( pThingName[ i ] != '#' ) && ( pThingName[ i ] != '\0' );
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+ThingTopicsStatus_t ThingTopics_Init( ThingTopics_t * pTopics,
+                                      const char * pThingName,
+                                      uint16_t thingNameLength,
+                                      char * pBuffer,
+                                      size_t bufferSize )
+{
+    ThingTopicsStatus_t returnStatus = ThingTopicsSuccess;
+    size_t offset = 0U;
+    size_t length = 0U;
+    uint32_t topic = 0U;
+
+    if( ( pTopics == NULL ) || ( pThingName == NULL ) || ( pBuffer == NULL ) ||
+        ( isValidThingName( pThingName, thingNameLength ) == false ) )
+    {
+        returnStatus = ThingTopicsBadParameter;
+    }
+    else if( bufferSize < THING_TOPICS_BUFFER_SIZE( thingNameLength ) )
+    {
+        returnStatus = ThingTopicsBufferTooSmall;
+    }
+    else
+    {
+        pTopics->pBuffer = pBuffer;
+        pTopics->thingNameLength = thingNameLength;
+
+        /* The longest thing name keeps the offsets within 16 bits. */
+        for( topic = 0U; topic < ( uint32_t ) ThingTopicCount; topic++ )
+        {
+            length = THING_TOPICS_PREFIX_LENGTH + thingNameLength + topicSuffixes[ topic ].length;
+            pTopics->offsets[ topic ] = ( uint16_t ) offset;
+            pTopics->lengths[ topic ] = ( uint16_t ) length;
+
+            ( void ) memcpy( &( pBuffer[ offset ] ), THING_TOPICS_PREFIX, THING_TOPICS_PREFIX_LENGTH );
+            ( void ) memcpy( &( pBuffer[ offset + THING_TOPICS_PREFIX_LENGTH ] ), pThingName, thingNameLength );
+            ( void ) memcpy( &( pBuffer[ offset + THING_TOPICS_PREFIX_LENGTH + thingNameLength ] ),
+                             topicSuffixes[ topic ].pSuffix,
+                             topicSuffixes[ topic ].length );
+            pBuffer[ offset + length ] = '\0';
+
+            offset += length + 1U;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ThingTopicsStatus_t ThingTopics_Find( const ThingTopics_t * pTopics,
+                                      const char * pTopic,
+                                      uint16_t topicLength,
+                                      ThingTopic_t * pTopicId )
+{
+    ThingTopicsStatus_t returnStatus = ThingTopicsNotFound;
+    size_t nameEnd = 0U;
+    size_t suffixLength = 0U;
+    uint32_t topic = 0U;
+
+    if( ( pTopics == NULL ) || ( pTopics->pBuffer == NULL ) || ( pTopic == NULL ) || ( pTopicId == NULL ) )
+    {
+        returnStatus = ThingTopicsBadParameter;
+    }
+    else
+    {
+        nameEnd = THING_TOPICS_PREFIX_LENGTH + pTopics->thingNameLength;
+
+        /* Every topic starts with the prefix and the thing name, so they are
+         * compared with those of the first topic. */
+        if( ( topicLength > nameEnd ) && ( memcmp( pTopic, pTopics->pBuffer, nameEnd ) == 0 ) )
+        {
+            suffixLength = topicLength - nameEnd;
+
+            for( topic = 0U; ( topic < ( uint32_t ) ThingTopicCount ) && ( returnStatus == ThingTopicsNotFound ); topic++ )
+            {
+                if( ( topicSuffixes[ topic ].length == suffixLength ) &&
+                    ( memcmp( &( pTopic[ nameEnd ] ), topicSuffixes[ topic ].pSuffix, suffixLength ) == 0 ) )
+                {
+                    *pTopicId = ( ThingTopic_t ) topic;
+                    returnStatus = ThingTopicsSuccess;
+                }
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
@@ -0,0 +1,268 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file thing_topics.h
+ * @brief The reserved topics of the Device Shadow, Jobs, Device Defender and
+ * OTA streaming services for a thing, assembled once into a single buffer.
+ *
+ * The topics of a thing whose name is only known at run time, such as one of
+ * the things served by a gateway, are assembled by #ThingTopics_Init into a
+ * caller supplied buffer of #THING_TOPICS_BUFFER_SIZE bytes, with their
+ * offsets and lengths. The publishes, the subscriptions and the dispatch of
+ * the incoming publishes then take the topics from that buffer, without
+ * formatting them again. The suffixes of the topics and their lengths are
+ * fixed at compile time, so only the thing name is copied at run time.
+ *
+ * Each topic is followed by a NUL character, for the APIs taking C strings.
+ * The topics ending with /+ are the topic filters of all the responses to a
+ * request, and the topic of the streams has a + level matching the name of
+ * any stream, so these are never the topic of an incoming publish. The topics
+ * naming a job or a stream, such as the update of a job, are left to the
+ * libraries formatting them.
+ */
+
+#ifndef THING_TOPICS_H_
+#define THING_TOPICS_H_
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Start of the reserved topics of a thing, followed by its name.
+ */
+#define THING_TOPICS_PREFIX                              "$aws/things/"
+
+/**
+ * @brief Length of #THING_TOPICS_PREFIX.
+ */
+#define THING_TOPICS_PREFIX_LENGTH                       ( sizeof( THING_TOPICS_PREFIX ) - 1U )
+
+/**
+ * @brief Largest length of a thing name accepted by AWS IoT.
+ */
+#define THING_TOPICS_THING_NAME_MAX_LENGTH               ( 128U )
+
+/**
+ * @brief Suffixes of the reserved topics of a thing, following its name, in
+ * the order of #ThingTopic_t.
+ */
+#define THING_TOPIC_SUFFIX_SHADOW_UPDATE                 "/shadow/update"
+#define THING_TOPIC_SUFFIX_SHADOW_UPDATE_ACCEPTED        "/shadow/update/accepted"
+#define THING_TOPIC_SUFFIX_SHADOW_UPDATE_REJECTED        "/shadow/update/rejected"
+#define THING_TOPIC_SUFFIX_SHADOW_UPDATE_DELTA           "/shadow/update/delta"
+#define THING_TOPIC_SUFFIX_SHADOW_UPDATE_DOCUMENTS       "/shadow/update/documents"
+#define THING_TOPIC_SUFFIX_SHADOW_UPDATE_RESPONSES       "/shadow/update/+"
+#define THING_TOPIC_SUFFIX_SHADOW_GET                    "/shadow/get"
+#define THING_TOPIC_SUFFIX_SHADOW_GET_ACCEPTED           "/shadow/get/accepted"
+#define THING_TOPIC_SUFFIX_SHADOW_GET_REJECTED           "/shadow/get/rejected"
+#define THING_TOPIC_SUFFIX_SHADOW_GET_RESPONSES          "/shadow/get/+"
+#define THING_TOPIC_SUFFIX_SHADOW_DELETE                 "/shadow/delete"
+#define THING_TOPIC_SUFFIX_SHADOW_DELETE_ACCEPTED        "/shadow/delete/accepted"
+#define THING_TOPIC_SUFFIX_SHADOW_DELETE_REJECTED        "/shadow/delete/rejected"
+#define THING_TOPIC_SUFFIX_SHADOW_DELETE_RESPONSES       "/shadow/delete/+"
+#define THING_TOPIC_SUFFIX_JOBS_NOTIFY                   "/jobs/notify"
+#define THING_TOPIC_SUFFIX_JOBS_NOTIFY_NEXT              "/jobs/notify-next"
+#define THING_TOPIC_SUFFIX_JOBS_GET                      "/jobs/get"
+#define THING_TOPIC_SUFFIX_JOBS_GET_ACCEPTED             "/jobs/get/accepted"
+#define THING_TOPIC_SUFFIX_JOBS_GET_REJECTED             "/jobs/get/rejected"
+#define THING_TOPIC_SUFFIX_JOBS_GET_RESPONSES            "/jobs/get/+"
+#define THING_TOPIC_SUFFIX_JOBS_START_NEXT               "/jobs/start-next"
+#define THING_TOPIC_SUFFIX_JOBS_START_NEXT_ACCEPTED      "/jobs/start-next/accepted"
+#define THING_TOPIC_SUFFIX_JOBS_START_NEXT_REJECTED      "/jobs/start-next/rejected"
+#define THING_TOPIC_SUFFIX_JOBS_START_NEXT_RESPONSES     "/jobs/start-next/+"
+#define THING_TOPIC_SUFFIX_JOBS_NEXT_GET                 "/jobs/$next/get"
+#define THING_TOPIC_SUFFIX_JOBS_NEXT_GET_ACCEPTED        "/jobs/$next/get/accepted"
+#define THING_TOPIC_SUFFIX_JOBS_NEXT_GET_REJECTED        "/jobs/$next/get/rejected"
+#define THING_TOPIC_SUFFIX_JOBS_NEXT_GET_RESPONSES       "/jobs/$next/get/+"
+#define THING_TOPIC_SUFFIX_STREAMS_DATA_CBOR             "/streams/+/data/cbor"
+#define THING_TOPIC_SUFFIX_DEFENDER_JSON                 "/defender/metrics/json"
+#define THING_TOPIC_SUFFIX_DEFENDER_JSON_ACCEPTED        "/defender/metrics/json/accepted"
+#define THING_TOPIC_SUFFIX_DEFENDER_JSON_REJECTED        "/defender/metrics/json/rejected"
+#define THING_TOPIC_SUFFIX_DEFENDER_JSON_RESPONSES       "/defender/metrics/json/+"
+
+/**
+ * @brief Sum of the lengths of the suffixes, summed by service to keep the
+ * concatenated strings within the length C90 compilers support.
+ */
+#define THING_TOPICS_SUFFIXES_LENGTH                         \
+    ( ( sizeof( THING_TOPIC_SUFFIX_SHADOW_UPDATE               \
+                THING_TOPIC_SUFFIX_SHADOW_UPDATE_ACCEPTED      \
+                THING_TOPIC_SUFFIX_SHADOW_UPDATE_REJECTED      \
+                THING_TOPIC_SUFFIX_SHADOW_UPDATE_DELTA         \
+                THING_TOPIC_SUFFIX_SHADOW_UPDATE_DOCUMENTS     \
+                THING_TOPIC_SUFFIX_SHADOW_UPDATE_RESPONSES     \
+                THING_TOPIC_SUFFIX_SHADOW_GET                  \
+                THING_TOPIC_SUFFIX_SHADOW_GET_ACCEPTED         \
+                THING_TOPIC_SUFFIX_SHADOW_GET_REJECTED         \
+                THING_TOPIC_SUFFIX_SHADOW_GET_RESPONSES        \
+                THING_TOPIC_SUFFIX_SHADOW_DELETE               \
+                THING_TOPIC_SUFFIX_SHADOW_DELETE_ACCEPTED      \
+                THING_TOPIC_SUFFIX_SHADOW_DELETE_REJECTED      \
+                THING_TOPIC_SUFFIX_SHADOW_DELETE_RESPONSES ) - 1U ) + \
+      ( sizeof( THING_TOPIC_SUFFIX_JOBS_NOTIFY                 \
+                THING_TOPIC_SUFFIX_JOBS_NOTIFY_NEXT            \
+                THING_TOPIC_SUFFIX_JOBS_GET                    \
+                THING_TOPIC_SUFFIX_JOBS_GET_ACCEPTED           \
+                THING_TOPIC_SUFFIX_JOBS_GET_REJECTED           \
+                THING_TOPIC_SUFFIX_JOBS_GET_RESPONSES          \
+                THING_TOPIC_SUFFIX_JOBS_START_NEXT             \
+                THING_TOPIC_SUFFIX_JOBS_START_NEXT_ACCEPTED    \
+                THING_TOPIC_SUFFIX_JOBS_START_NEXT_REJECTED    \
+                THING_TOPIC_SUFFIX_JOBS_START_NEXT_RESPONSES   \
+                THING_TOPIC_SUFFIX_JOBS_NEXT_GET               \
+                THING_TOPIC_SUFFIX_JOBS_NEXT_GET_ACCEPTED      \
+                THING_TOPIC_SUFFIX_JOBS_NEXT_GET_REJECTED      \
+                THING_TOPIC_SUFFIX_JOBS_NEXT_GET_RESPONSES ) - 1U ) + \
+      ( sizeof( THING_TOPIC_SUFFIX_DEFENDER_JSON               \
+                THING_TOPIC_SUFFIX_DEFENDER_JSON_ACCEPTED      \
+                THING_TOPIC_SUFFIX_DEFENDER_JSON_REJECTED      \
+                THING_TOPIC_SUFFIX_DEFENDER_JSON_RESPONSES ) - 1U ) + \
+      ( sizeof( THING_TOPIC_SUFFIX_STREAMS_DATA_CBOR ) - 1U ) )
+
+/**
+ * @brief The reserved topics of a thing.
+ */
+typedef enum ThingTopic
+{
+    ThingTopicShadowUpdate = 0,       /**< @brief Publish to update the classic shadow. */
+    ThingTopicShadowUpdateAccepted,   /**< @brief Update of the shadow accepted. */
+    ThingTopicShadowUpdateRejected,   /**< @brief Update of the shadow rejected. */
+    ThingTopicShadowUpdateDelta,      /**< @brief Difference between the desired and reported states. */
+    ThingTopicShadowUpdateDocuments,  /**< @brief Shadow documents before and after an update. */
+    ThingTopicShadowUpdateResponses,  /**< @brief Topic filter of all the responses to the updates. */
+    ThingTopicShadowGet,              /**< @brief Publish to get the shadow. */
+    ThingTopicShadowGetAccepted,      /**< @brief The shadow document. */
+    ThingTopicShadowGetRejected,      /**< @brief Get of the shadow rejected. */
+    ThingTopicShadowGetResponses,     /**< @brief Topic filter of the responses to the gets. */
+    ThingTopicShadowDelete,           /**< @brief Publish to delete the shadow. */
+    ThingTopicShadowDeleteAccepted,   /**< @brief Deletion of the shadow accepted. */
+    ThingTopicShadowDeleteRejected,   /**< @brief Deletion of the shadow rejected. */
+    ThingTopicShadowDeleteResponses,  /**< @brief Topic filter of the responses to the deletions. */
+    ThingTopicJobsNotify,             /**< @brief Changes of the list of pending jobs. */
+    ThingTopicJobsNotifyNext,         /**< @brief Changes of the next pending job. */
+    ThingTopicJobsGet,                /**< @brief Publish to list the pending jobs. */
+    ThingTopicJobsGetAccepted,        /**< @brief The pending jobs. */
+    ThingTopicJobsGetRejected,        /**< @brief Listing of the pending jobs rejected. */
+    ThingTopicJobsGetResponses,       /**< @brief Topic filter of the responses to the listings. */
+    ThingTopicJobsStartNext,          /**< @brief Publish to start the next pending job. */
+    ThingTopicJobsStartNextAccepted,  /**< @brief The job started, if any. */
+    ThingTopicJobsStartNextRejected,  /**< @brief Start of the next job rejected. */
+    ThingTopicJobsStartNextResponses, /**< @brief Topic filter of the responses to the starts. */
+    ThingTopicJobsNextGet,            /**< @brief Publish to describe the next pending job. */
+    ThingTopicJobsNextGetAccepted,    /**< @brief The next pending job, if any. */
+    ThingTopicJobsNextGetRejected,    /**< @brief Description of the next job rejected. */
+    ThingTopicJobsNextGetResponses,   /**< @brief Topic filter of the responses to the descriptions. */
+    ThingTopicDefenderJson,           /**< @brief Publish of a Device Defender report in JSON. */
+    ThingTopicDefenderJsonAccepted,   /**< @brief Report accepted. */
+    ThingTopicDefenderJsonRejected,   /**< @brief Report rejected. */
+    ThingTopicDefenderJsonResponses,  /**< @brief Topic filter of the responses to the reports. */
+    ThingTopicStreamsDataCbor,        /**< @brief Topic filter of the blocks of all the streams in CBOR. */
+    ThingTopicCount                   /**< @brief Number of reserved topics. */
+} ThingTopic_t;
+
+/**
+ * @brief Size of the buffer holding the reserved topics of a thing whose
+ * name is @p thingNameLength long, their NUL characters included.
+ */
+#define THING_TOPICS_BUFFER_SIZE( thingNameLength )                                   \
+    ( THING_TOPICS_SUFFIXES_LENGTH +                                                  \
+      ( ( size_t ) ThingTopicCount * ( THING_TOPICS_PREFIX_LENGTH + ( size_t ) ( thingNameLength ) + 1U ) ) )
+
+/**
+ * @brief A reserved topic of a thing, taken from its #ThingTopics_t.
+ */
+#define THING_TOPICS_STRING( pTopics, topic )    ( &( ( pTopics )->pBuffer[ ( pTopics )->offsets[ ( topic ) ] ] ) )
+
+/**
+ * @brief Length of a reserved topic of a thing, its NUL character excluded.
+ */
+#define THING_TOPICS_LENGTH( pTopics, topic )    ( ( pTopics )->lengths[ ( topic ) ] )
+
+/**
+ * @brief Return codes of the thing topics.
+ */
+typedef enum ThingTopicsStatus
+{
+    ThingTopicsSuccess = 0,    /**< @brief The topics were assembled, or the topic was found. */
+    ThingTopicsBadParameter,   /**< @brief A parameter was invalid, such as a thing name with / or a wildcard. */
+    ThingTopicsBufferTooSmall, /**< @brief The buffer is smaller than #THING_TOPICS_BUFFER_SIZE. */
+    ThingTopicsNotFound        /**< @brief The topic is not a reserved topic of the thing. */
+} ThingTopicsStatus_t;
+
+/**
+ * @brief The reserved topics of a thing.
+ *
+ * The members are only written by #ThingTopics_Init, so the topics can be
+ * read from several threads at once.
+ */
+typedef struct ThingTopics
+{
+    char * pBuffer;                      /**< @brief The topics, each followed by a NUL character. */
+    uint16_t thingNameLength;            /**< @brief Length of the thing name. */
+    uint16_t offsets[ ThingTopicCount ]; /**< @brief Offset of each topic in #ThingTopics_t.pBuffer. */
+    uint16_t lengths[ ThingTopicCount ]; /**< @brief Length of each topic. */
+} ThingTopics_t;
+
+/**
+ * @brief Assemble the reserved topics of a thing into a buffer.
+ *
+ * @param[out] pTopics The topics.
+ * @param[in] pThingName The thing name, which must not contain / or the
+ * wildcards of MQTT.
+ * @param[in] thingNameLength Length of @p pThingName, up to
+ * #THING_TOPICS_THING_NAME_MAX_LENGTH.
+ * @param[in] pBuffer Buffer receiving the topics, which must remain valid as
+ * long as @p pTopics is used.
+ * @param[in] bufferSize Size of @p pBuffer, at least
+ * #THING_TOPICS_BUFFER_SIZE( @p thingNameLength ).
+ *
+ * @return #ThingTopicsSuccess, #ThingTopicsBadParameter or
+ * #ThingTopicsBufferTooSmall.
+ */
+ThingTopicsStatus_t ThingTopics_Init( ThingTopics_t * pTopics,
+                                      const char * pThingName,
+                                      uint16_t thingNameLength,
+                                      char * pBuffer,
+                                      size_t bufferSize );
+
+/**
+ * @brief Find which reserved topic of a thing the topic of a publish is.
+ *
+ * The topic is compared with the name of the thing once, then its suffix
+ * only with the suffixes of the same length.
+ *
+ * @param[in] pTopics The topics of the thing.
+ * @param[in] pTopic The topic of the publish.
+ * @param[in] topicLength Length of @p pTopic.
+ * @param[out] pTopicId The reserved topic.
+ *
+ * @return #ThingTopicsSuccess, #ThingTopicsNotFound or
+ * #ThingTopicsBadParameter.
+ */
+ThingTopicsStatus_t ThingTopics_Find( const ThingTopics_t * pTopics,
+                                      const char * pTopic,
+                                      uint16_t topicLength,
+                                      ThingTopic_t * pTopicId );
+
+#endif /* ifndef THING_TOPICS_H_ */
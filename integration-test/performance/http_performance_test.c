@@ -0,0 +1,616 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_performance_test.c
+ * @brief Performance regression tests for the HTTP library when communicating
+ * with an HTTP server from a POSIX platform.
+ *
+ * The measurements are checked against the baselines of
+ * #PERFORMANCE_BASELINES_PATH and written to #HTTP_PERFORMANCE_RESULTS_PATH.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+/* Unity testing framework includes. */
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "core_http_client.h"
+
+/* Include OpenSSL implementation of transport interface. */
+#include "openssl_posix.h"
+
+/* Include clock for timer. */
+#include "clock.h"
+
+/* Performance test configuration and report. */
+#include "performance_config.h"
+#include "performance_report.h"
+
+/* Ensure that config macros, required for TLS connection, have been defined. */
+#ifndef SERVER_HOST
+    #error "SERVER_HOST should be defined for the HTTP performance tests."
+#endif
+
+/* Check that TLS port of the server is defined. */
+#ifndef HTTPS_PORT
+    #error "HTTPS_PORT should be defined for the HTTP performance tests."
+#endif
+
+#ifndef ROOT_CA_CERT_PATH
+    #error "ROOT_CA_CERT_PATH should be defined for the HTTP performance tests."
+#endif
+
+/**
+ * @brief Length of HTTP server host name.
+ */
+#define SERVER_HOST_LENGTH              ( ( uint16_t ) ( sizeof( SERVER_HOST ) - 1 ) )
+
+/**
+ * @brief Size of a buffer holding a request path or a metric name.
+ */
+#define NAME_BUFFER_SIZE                ( 64U )
+
+/**
+ * @brief Status line and headers of the chunked response parsed from memory.
+ */
+#define CHUNKED_RESPONSE_HEADERS                 \
+    "HTTP/1.1 200 OK\r\n"                        \
+    "Content-Type: application/octet-stream\r\n" \
+    "Transfer-Encoding: chunked\r\n"             \
+    "\r\n"
+
+/**
+ * @brief Last chunk and end of the chunked response.
+ */
+#define CHUNKED_RESPONSE_END            "0\r\n\r\n"
+
+/**
+ * @brief Largest length of the size line of a chunk, and of the line break
+ * after its data.
+ */
+#define CHUNK_FRAMING_MAX_LENGTH        ( 32U )
+
+/**
+ * @brief Number of microseconds in a millisecond.
+ */
+#define MICROSECONDS_PER_MILLISECOND    ( 1000.0 )
+
+/**
+ * @brief Number of bytes in a megabyte, and the throughput in megabytes per
+ * second of one byte per microsecond.
+ */
+#define BYTES_PER_MEGABYTE              ( 1024.0 * 1024.0 )
+#define MEGABYTES_PER_BYTE_PER_US       ( 1000000.0 / BYTES_PER_MEGABYTE )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    OpensslParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Represents the OpenSSL context used for TLS session with the server
+ * for tests.
+ */
+static NetworkContext_t networkContext;
+
+/**
+ * @brief Parameters for the OpenSSL context.
+ */
+static OpensslParams_t opensslParams;
+
+/**
+ * @brief The transport layer interface used by the HTTP Client library.
+ */
+static TransportInterface_t transportInterface;
+
+/**
+ * @brief Represents the hostname and port of the server.
+ */
+static ServerInfo_t serverInfo;
+
+/**
+ * @brief TLS credentials needed to connect to the server.
+ */
+static OpensslCredentials_t opensslCredentials;
+
+/**
+ * @brief Whether the test case is connected to the server.
+ */
+static bool connected = false;
+
+/**
+ * @brief Buffer for the request headers.
+ */
+static uint8_t requestBuffer[ USER_BUFFER_LENGTH ];
+
+/**
+ * @brief Buffer of #PERFORMANCE_HTTP_RESPONSE_BUFFER_LENGTH bytes for the
+ * responses, allocated for each test case.
+ */
+static uint8_t * pResponseBuffer = NULL;
+
+/**
+ * @brief The response to the last request.
+ */
+static HTTPResponse_t response;
+
+/**
+ * @brief Network data that is returned in the transportRecvStub.
+ */
+static const uint8_t * pNetworkData = NULL;
+
+/**
+ * @brief The length of the network data to return in the transportRecvStub.
+ */
+static size_t networkDataLen = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect to the server over TLS.
+ *
+ * @return Duration of the TCP connection and TLS handshake.
+ */
+static uint64_t connectToServer( void );
+
+/**
+ * @brief Send a request and receive its whole response in #pResponseBuffer.
+ *
+ * @param[in] pTransport The transport interface of the request.
+ * @param[in] pMethod Method of the request.
+ * @param[in] pPath Path of the request.
+ * @param[in] pBody Body of the request; NULL if it has none.
+ * @param[in] bodyLength Length of @p pBody.
+ *
+ * @return Duration from the request to the end of the response.
+ */
+static uint64_t sendHttpRequest( const TransportInterface_t * pTransport,
+                                 const char * pMethod,
+                                 const char * pPath,
+                                 const uint8_t * pBody,
+                                 size_t bodyLength );
+
+/**
+ * @brief Convert a number of bytes transferred in a duration to megabytes per
+ * second.
+ *
+ * @param[in] byteCount Number of bytes transferred.
+ * @param[in] elapsedUs Duration of the transfer.
+ *
+ * @return The throughput in megabytes per second.
+ */
+static double toThroughput( uint64_t byteCount,
+                            uint64_t elapsedUs );
+
+/**
+ * @brief Create a chunked response of #PERFORMANCE_CHUNKED_BODY_LENGTH bytes
+ * of body in chunks of #PERFORMANCE_CHUNK_LENGTH bytes.
+ *
+ * @param[out] pLength Length of the response.
+ *
+ * @return The response, to be freed by the caller.
+ */
+static uint8_t * createChunkedResponse( size_t * pLength );
+
+/**
+ * @brief Transport receive function returning #pNetworkData.
+ */
+static int32_t transportRecvStub( NetworkContext_t * pNetworkContext,
+                                  void * pBuffer,
+                                  size_t bytesToRead );
+
+/**
+ * @brief Transport send function discarding the data.
+ */
+static int32_t transportSendStub( NetworkContext_t * pNetworkContext,
+                                  const void * pBuffer,
+                                  size_t bytesToWrite );
+
+/*-----------------------------------------------------------*/
+
+static uint64_t connectToServer( void )
+{
+    uint64_t startTimeUs = Clock_GetTimeUs();
+
+    /* Establish a TLS session, on top of TCP connection, with the HTTP server. */
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_Connect( &networkContext,
+                                                         &serverInfo,
+                                                         &opensslCredentials,
+                                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                         TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+    connected = true;
+
+    return Clock_GetTimeUs() - startTimeUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t sendHttpRequest( const TransportInterface_t * pTransport,
+                                 const char * pMethod,
+                                 const char * pPath,
+                                 const uint8_t * pBody,
+                                 size_t bodyLength )
+{
+    HTTPRequestInfo_t requestInfo;
+    HTTPRequestHeaders_t requestHeaders;
+    uint64_t startTimeUs = 0U;
+
+    assert( pTransport != NULL );
+    assert( pMethod != NULL );
+    assert( pPath != NULL );
+
+    ( void ) memset( &requestInfo, 0, sizeof( requestInfo ) );
+    ( void ) memset( &requestHeaders, 0, sizeof( requestHeaders ) );
+    ( void ) memset( &response, 0, sizeof( response ) );
+
+    requestInfo.pHost = SERVER_HOST;
+    requestInfo.hostLen = SERVER_HOST_LENGTH;
+    requestInfo.pMethod = pMethod;
+    requestInfo.methodLen = strlen( pMethod );
+    requestInfo.pPath = pPath;
+    requestInfo.pathLen = strlen( pPath );
+
+    /* Keep the connection open for the next request. */
+    requestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    requestHeaders.pBuffer = requestBuffer;
+    requestHeaders.bufferLen = sizeof( requestBuffer );
+
+    response.pBuffer = pResponseBuffer;
+    response.bufferLen = PERFORMANCE_HTTP_RESPONSE_BUFFER_LENGTH;
+
+    TEST_ASSERT_EQUAL( HTTPSuccess, HTTPClient_InitializeRequestHeaders( &requestHeaders,
+                                                                        &requestInfo ) );
+
+    startTimeUs = Clock_GetTimeUs();
+    TEST_ASSERT_EQUAL( HTTPSuccess, HTTPClient_Send( pTransport,
+                                                     &requestHeaders,
+                                                     pBody,
+                                                     bodyLength,
+                                                     &response,
+                                                     0 ) );
+
+    return Clock_GetTimeUs() - startTimeUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static double toThroughput( uint64_t byteCount,
+                            uint64_t elapsedUs )
+{
+    /* Count at least a microsecond, so that the throughput is finite. */
+    return ( ( double ) byteCount * MEGABYTES_PER_BYTE_PER_US ) /
+           ( ( elapsedUs > 0U ) ? ( double ) elapsedUs : 1.0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t * createChunkedResponse( size_t * pLength )
+{
+    const size_t chunkCount = ( PERFORMANCE_CHUNKED_BODY_LENGTH + PERFORMANCE_CHUNK_LENGTH - 1U ) /
+                              PERFORMANCE_CHUNK_LENGTH;
+    const size_t capacity = ( sizeof( CHUNKED_RESPONSE_HEADERS ) - 1U ) +
+                            PERFORMANCE_CHUNKED_BODY_LENGTH +
+                            ( chunkCount * CHUNK_FRAMING_MAX_LENGTH ) +
+                            sizeof( CHUNKED_RESPONSE_END );
+    uint8_t * pChunkedResponse = NULL;
+    size_t length = 0U;
+    size_t remaining = PERFORMANCE_CHUNKED_BODY_LENGTH;
+    size_t chunkLength = 0U;
+
+    assert( pLength != NULL );
+
+    pChunkedResponse = malloc( capacity );
+    TEST_ASSERT_NOT_NULL( pChunkedResponse );
+
+    ( void ) memcpy( pChunkedResponse, CHUNKED_RESPONSE_HEADERS, sizeof( CHUNKED_RESPONSE_HEADERS ) - 1U );
+    length = sizeof( CHUNKED_RESPONSE_HEADERS ) - 1U;
+
+    while( remaining > 0U )
+    {
+        chunkLength = ( remaining < PERFORMANCE_CHUNK_LENGTH ) ? remaining : PERFORMANCE_CHUNK_LENGTH;
+        length += ( size_t ) snprintf( ( char * ) &pChunkedResponse[ length ],
+                                       CHUNK_FRAMING_MAX_LENGTH,
+                                       "%lx\r\n",
+                                       ( unsigned long ) chunkLength );
+        ( void ) memset( &pChunkedResponse[ length ], 'c', chunkLength );
+        length += chunkLength;
+        pChunkedResponse[ length ] = ( uint8_t ) '\r';
+        pChunkedResponse[ length + 1U ] = ( uint8_t ) '\n';
+        length += 2U;
+        remaining -= chunkLength;
+    }
+
+    ( void ) memcpy( &pChunkedResponse[ length ], CHUNKED_RESPONSE_END, sizeof( CHUNKED_RESPONSE_END ) - 1U );
+    length += sizeof( CHUNKED_RESPONSE_END ) - 1U;
+    assert( length <= capacity );
+
+    *pLength = length;
+
+    return pChunkedResponse;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t transportRecvStub( NetworkContext_t * pNetworkContext,
+                                  void * pBuffer,
+                                  size_t bytesToRead )
+{
+    size_t bytesToCopy = ( bytesToRead < networkDataLen ) ? bytesToRead : networkDataLen;
+
+    ( void ) pNetworkContext;
+
+    ( void ) memcpy( pBuffer, pNetworkData, bytesToCopy );
+    pNetworkData += bytesToCopy;
+    networkDataLen -= bytesToCopy;
+
+    return ( int32_t ) bytesToCopy;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t transportSendStub( NetworkContext_t * pNetworkContext,
+                                  const void * pBuffer,
+                                  size_t bytesToWrite )
+{
+    ( void ) pNetworkContext;
+    ( void ) pBuffer;
+
+    return ( int32_t ) bytesToWrite;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before any test method. */
+void suiteSetUp()
+{
+    /* Missing baselines are reported, and do not fail the tests. */
+    ( void ) PerformanceReport_Init( "http_performance", PERFORMANCE_BASELINES_PATH );
+}
+
+/* Called after all test methods. */
+int suiteTearDown( int numFailures )
+{
+    if( PerformanceReport_Write( HTTP_PERFORMANCE_RESULTS_PATH ) == false )
+    {
+        numFailures++;
+    }
+
+    return numFailures;
+}
+
+/* Called before each test method. */
+void setUp()
+{
+    connected = false;
+    pNetworkData = NULL;
+    networkDataLen = 0U;
+    ( void ) memset( &response, 0, sizeof( HTTPResponse_t ) );
+
+    pResponseBuffer = malloc( PERFORMANCE_HTTP_RESPONSE_BUFFER_LENGTH );
+    TEST_ASSERT_NOT_NULL( pResponseBuffer );
+
+    ( void ) memset( &opensslCredentials, 0, sizeof( opensslCredentials ) );
+    ( void ) memset( &opensslParams, 0, sizeof( opensslParams ) );
+    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+    opensslCredentials.sniHostName = SERVER_HOST;
+
+    serverInfo.pHostName = SERVER_HOST;
+    serverInfo.hostNameLength = SERVER_HOST_LENGTH;
+    serverInfo.port = HTTPS_PORT;
+
+    networkContext.pParams = &opensslParams;
+
+    /* Define the transport interface. */
+    ( void ) memset( &transportInterface, 0, sizeof( transportInterface ) );
+    transportInterface.recv = Openssl_Recv;
+    transportInterface.send = Openssl_Send;
+    transportInterface.pNetworkContext = &networkContext;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    if( connected == true )
+    {
+        /* End TLS session, then close TCP connection. */
+        ( void ) Openssl_Disconnect( &networkContext );
+        connected = false;
+    }
+
+    free( pResponseBuffer );
+    pResponseBuffer = NULL;
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Measures the mean duration of the TCP connection and TLS handshake
+ * over #PERFORMANCE_CONNECT_ITERATIONS connections.
+ */
+void test_HTTP_Connect_Performance( void )
+{
+    uint64_t totalTimeUs = 0U;
+    uint32_t i = 0U;
+
+    for( i = 0U; i < PERFORMANCE_CONNECT_ITERATIONS; i++ )
+    {
+        totalTimeUs += connectToServer();
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_Disconnect( &networkContext ) );
+        connected = false;
+    }
+
+    TEST_ASSERT_TRUE( PerformanceReport_Record( "http_tls_connect_ms",
+                                                ( ( double ) totalTimeUs / MICROSECONDS_PER_MILLISECOND ) /
+                                                ( double ) PERFORMANCE_CONNECT_ITERATIONS,
+                                                "ms",
+                                                PERFORMANCE_LOWER_IS_BETTER ) );
+}
+
+/**
+ * @brief Measures the throughput of GET responses for each body length, over
+ * one keep-alive connection.
+ */
+void test_HTTP_GET_Throughput( void )
+{
+    char path[ NAME_BUFFER_SIZE ];
+    char name[ NAME_BUFFER_SIZE ];
+    unsigned long length = 0UL;
+    uint64_t totalTimeUs = 0U;
+    uint32_t i = 0U;
+    bool allPassed = true;
+
+    ( void ) connectToServer();
+
+    for( length = PERFORMANCE_HTTP_MIN_BODY_LENGTH;
+         length <= PERFORMANCE_HTTP_MAX_BODY_LENGTH;
+         length *= PERFORMANCE_HTTP_BODY_LENGTH_FACTOR )
+    {
+        ( void ) snprintf( path, sizeof( path ), PERFORMANCE_HTTP_GET_PATH_FORMAT, length );
+        totalTimeUs = 0U;
+
+        for( i = 0U; i < PERFORMANCE_HTTP_REQUESTS_PER_LENGTH; i++ )
+        {
+            totalTimeUs += sendHttpRequest( &transportInterface, HTTP_METHOD_GET, path, NULL, 0U );
+            TEST_ASSERT_EQUAL( 200, response.statusCode );
+            TEST_ASSERT_EQUAL( length, response.bodyLen );
+        }
+
+        ( void ) snprintf( name, sizeof( name ), "http_get_throughput_%lu", length );
+
+        /* Record every length before failing. */
+        allPassed = PerformanceReport_Record( name,
+                                              toThroughput( ( uint64_t ) length * PERFORMANCE_HTTP_REQUESTS_PER_LENGTH,
+                                                            totalTimeUs ),
+                                              "MB/s",
+                                              PERFORMANCE_HIGHER_IS_BETTER ) && allPassed;
+    }
+
+    TEST_ASSERT_TRUE( allPassed );
+}
+
+/**
+ * @brief Measures the throughput of PUT requests for each body length, over
+ * one keep-alive connection.
+ */
+void test_HTTP_PUT_Throughput( void )
+{
+    char name[ NAME_BUFFER_SIZE ];
+    uint8_t * pBody = NULL;
+    unsigned long length = 0UL;
+    uint64_t totalTimeUs = 0U;
+    uint32_t i = 0U;
+    bool allPassed = true;
+
+    pBody = malloc( PERFORMANCE_HTTP_MAX_BODY_LENGTH );
+    TEST_ASSERT_NOT_NULL( pBody );
+    ( void ) memset( pBody, 'p', PERFORMANCE_HTTP_MAX_BODY_LENGTH );
+
+    ( void ) connectToServer();
+
+    for( length = PERFORMANCE_HTTP_MIN_BODY_LENGTH;
+         length <= PERFORMANCE_HTTP_MAX_BODY_LENGTH;
+         length *= PERFORMANCE_HTTP_BODY_LENGTH_FACTOR )
+    {
+        totalTimeUs = 0U;
+
+        for( i = 0U; i < PERFORMANCE_HTTP_REQUESTS_PER_LENGTH; i++ )
+        {
+            totalTimeUs += sendHttpRequest( &transportInterface,
+                                            HTTP_METHOD_PUT,
+                                            PERFORMANCE_HTTP_PUT_PATH,
+                                            pBody,
+                                            length );
+            TEST_ASSERT_EQUAL( 200, response.statusCode );
+        }
+
+        ( void ) snprintf( name, sizeof( name ), "http_put_throughput_%lu", length );
+
+        /* Record every length before failing. */
+        allPassed = PerformanceReport_Record( name,
+                                              toThroughput( ( uint64_t ) length * PERFORMANCE_HTTP_REQUESTS_PER_LENGTH,
+                                                            totalTimeUs ),
+                                              "MB/s",
+                                              PERFORMANCE_HIGHER_IS_BETTER ) && allPassed;
+    }
+
+    free( pBody );
+
+    TEST_ASSERT_TRUE( allPassed );
+}
+
+/**
+ * @brief Measures the rate at which the library parses a chunked response.
+ * The response is received from memory, so that only the parser is measured.
+ */
+void test_HTTP_Chunked_Parse_Rate( void )
+{
+    TransportInterface_t transport;
+    uint8_t * pChunkedResponse = NULL;
+    size_t chunkedResponseLength = 0U;
+    uint64_t totalTimeUs = 0U;
+    uint32_t i = 0U;
+    bool passed = false;
+
+    pChunkedResponse = createChunkedResponse( &chunkedResponseLength );
+
+    ( void ) memset( &transport, 0, sizeof( transport ) );
+    transport.recv = transportRecvStub;
+    transport.send = transportSendStub;
+    transport.pNetworkContext = NULL;
+
+    for( i = 0U; i < PERFORMANCE_CHUNKED_PARSE_ITERATIONS; i++ )
+    {
+        pNetworkData = pChunkedResponse;
+        networkDataLen = chunkedResponseLength;
+
+        totalTimeUs += sendHttpRequest( &transport, HTTP_METHOD_GET, "/chunked", NULL, 0U );
+
+        /* The chunk headers are overwritten, so the body is contiguous. */
+        TEST_ASSERT_EQUAL( PERFORMANCE_CHUNKED_BODY_LENGTH, response.bodyLen );
+    }
+
+    free( pChunkedResponse );
+
+    passed = PerformanceReport_Record( "http_chunked_parse_rate",
+                                       toThroughput( ( uint64_t ) PERFORMANCE_CHUNKED_BODY_LENGTH *
+                                                     PERFORMANCE_CHUNKED_PARSE_ITERATIONS,
+                                                     totalTimeUs ),
+                                       "MB/s",
+                                       PERFORMANCE_HIGHER_IS_BETTER );
+    TEST_ASSERT_TRUE( passed );
+}
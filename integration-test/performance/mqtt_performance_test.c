@@ -0,0 +1,638 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mqtt_performance_test.c
+ * @brief Performance regression tests for the MQTT library when communicating
+ * with an MQTT broker from a POSIX platform.
+ *
+ * The measurements are checked against the baselines of
+ * #PERFORMANCE_BASELINES_PATH and written to #MQTT_PERFORMANCE_RESULTS_PATH.
+ */
+
+/* Standard header includes. */
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+#include "unity.h"
+/* Include paths for public enums, structures, and macros. */
+#include "core_mqtt.h"
+#include "core_mqtt_state.h"
+
+/* Include OpenSSL implementation of transport interface. */
+#include "openssl_posix.h"
+
+/* Include clock for timer. */
+#include "clock.h"
+
+/* Performance test configuration and report. */
+#include "performance_config.h"
+#include "performance_report.h"
+
+/* Ensure that config macros, required for the mutually authenticated MQTT connection,
+ * have been defined. */
+#ifndef BROKER_ENDPOINT
+    #error "BROKER_ENDPOINT should be defined for the MQTT performance tests."
+#endif
+
+#ifndef ROOT_CA_CERT_PATH
+    #error "ROOT_CA_CERT_PATH should be defined for the MQTT performance tests."
+#endif
+
+#ifndef CLIENT_CERT_PATH
+    #error "CLIENT_CERT_PATH should be defined for the MQTT performance tests."
+#endif
+
+#ifndef CLIENT_PRIVATE_KEY_PATH
+    #error "CLIENT_PRIVATE_KEY_PATH should be defined for the MQTT performance tests."
+#endif
+
+#ifndef CLIENT_IDENTIFIER
+    #error "CLIENT_IDENTIFIER should be defined for the MQTT performance tests."
+#endif
+
+/**
+ * @brief Length of MQTT server host name.
+ */
+#define BROKER_ENDPOINT_LENGTH              ( ( uint16_t ) ( sizeof( BROKER_ENDPOINT ) - 1 ) )
+
+/**
+ * @brief Topic of the PUBLISH packets and of the subscriptions.
+ */
+#define PERFORMANCE_MQTT_TOPIC              CLIENT_IDENTIFIER "/iot/integration/performance"
+
+/**
+ * @brief Length of #PERFORMANCE_MQTT_TOPIC.
+ */
+#define PERFORMANCE_MQTT_TOPIC_LENGTH       ( ( uint16_t ) ( sizeof( PERFORMANCE_MQTT_TOPIC ) - 1 ) )
+
+/**
+ * @brief Client identifier of the MQTT connections.
+ */
+#define TEST_CLIENT_IDENTIFIER              CLIENT_IDENTIFIER "-performance"
+
+/**
+ * @brief Length of #TEST_CLIENT_IDENTIFIER.
+ */
+#define TEST_CLIENT_IDENTIFIER_LENGTH       ( ( uint16_t ) ( sizeof( TEST_CLIENT_IDENTIFIER ) - 1 ) )
+
+/**
+ * @brief Size of the network buffer for MQTT packets.
+ */
+#define NETWORK_BUFFER_SIZE                 ( PERFORMANCE_PUBLISH_PAYLOAD_LENGTH + 1024U )
+
+/**
+ * @brief Timeout for receiving and sending on the TLS connection.
+ */
+#define TRANSPORT_SEND_RECV_TIMEOUT_MS      ( 200U )
+
+/**
+ * @brief Timeout for receiving CONNACK packet.
+ */
+#define CONNACK_RECV_TIMEOUT_MS             ( 1000U )
+
+/**
+ * @brief Time interval in seconds at which an MQTT PINGREQ need to be sent to
+ * broker. It is longer than the tests, so that no PINGREQ is measured.
+ */
+#define MQTT_KEEP_ALIVE_INTERVAL_SECONDS    ( 60U )
+
+/**
+ * @brief Time to wait for the acknowledgments of the broker before failing.
+ */
+#define ACK_WAIT_TIMEOUT_MS                 ( 10000U )
+
+/**
+ * @brief Largest number of QoS 1 PUBLISH packets awaiting their PUBACK. The
+ * MQTT context tracks at most #MQTT_STATE_ARRAY_MAX_COUNT of them.
+ */
+#define MAX_OUTSTANDING_PUBLISHES           ( MQTT_STATE_ARRAY_MAX_COUNT )
+
+/**
+ * @brief Number of microseconds in a millisecond and in a second.
+ */
+#define MICROSECONDS_PER_MILLISECOND        ( 1000.0 )
+#define MICROSECONDS_PER_SECOND             ( 1000000.0 )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    OpensslParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Represents the OpenSSL context used for TLS session with the broker
+ * for tests.
+ */
+static NetworkContext_t networkContext;
+
+/**
+ * @brief Parameters for the OpenSSL context.
+ */
+static OpensslParams_t opensslParams;
+
+/**
+ * @brief Represents the hostname and port of the broker.
+ */
+static ServerInfo_t serverInfo;
+
+/**
+ * @brief TLS credentials needed to connect to the broker.
+ */
+static OpensslCredentials_t opensslCredentials;
+
+/**
+ * @brief The context representing the MQTT connection with the broker for
+ * the test case.
+ */
+static MQTTContext_t context;
+
+/**
+ * @brief Whether the test case is connected to the broker.
+ */
+static bool connected = false;
+
+/**
+ * @brief Payload of the PUBLISH packets.
+ */
+static uint8_t publishPayload[ PERFORMANCE_PUBLISH_PAYLOAD_LENGTH ];
+
+/**
+ * @brief Number of PUBACK packets received in the test case.
+ */
+static uint32_t pubAckCount = 0U;
+
+/**
+ * @brief Flags to indicate that the SUBACK and UNSUBACK of the last request
+ * were received.
+ */
+static bool receivedSubAck = false;
+static bool receivedUnsubAck = false;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect to the broker over TLS, then send an MQTT CONNECT request.
+ *
+ * @param[out] pTlsTimeUs Duration of the TCP connection and TLS handshake.
+ * @param[out] pMqttTimeUs Duration from the CONNECT packet to the CONNACK.
+ */
+static void connectToBroker( uint64_t * pTlsTimeUs,
+                             uint64_t * pMqttTimeUs );
+
+/**
+ * @brief Disconnect the MQTT session, then the TLS session.
+ */
+static void disconnectFromBroker( void );
+
+/**
+ * @brief The application callback function that is expected to be invoked by the
+ * MQTT library for incoming publish and incoming acks received over the network.
+ *
+ * @param[in] pContext MQTT context pointer.
+ * @param[in] pPacketInfo Packet Info pointer for the incoming packet.
+ * @param[in] pDeserializedInfo Deserialized information from the incoming packet.
+ */
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo );
+
+/**
+ * @brief Receive and process at most one incoming packet.
+ */
+static void processIncomingPacket( void );
+
+/**
+ * @brief Process incoming packets until a flag is set.
+ *
+ * @param[in] pFlag The flag set by #eventCallback.
+ */
+static void waitForAck( const bool * pFlag );
+
+/**
+ * @brief Publish #PERFORMANCE_PUBLISH_COUNT messages of a QoS and return their
+ * rate. QoS 1 PUBLISH packets are sent within a window of
+ * #MAX_OUTSTANDING_PUBLISHES unacknowledged ones, and the rate counts every
+ * PUBACK.
+ *
+ * @param[in] qos QoS of the PUBLISH packets.
+ *
+ * @return The number of messages sent per second.
+ */
+static double measurePublishRate( MQTTQoS_t qos );
+
+/*-----------------------------------------------------------*/
+
+static void connectToBroker( uint64_t * pTlsTimeUs,
+                             uint64_t * pMqttTimeUs )
+{
+    MQTTConnectInfo_t connectInfo;
+    TransportInterface_t transport;
+    MQTTFixedBuffer_t networkBuffer;
+    bool sessionPresent = false;
+    uint64_t startTimeUs = 0U;
+
+    /* The network buffer must remain valid for the lifetime of the MQTT context. */
+    static uint8_t buffer[ NETWORK_BUFFER_SIZE ];
+
+    assert( pTlsTimeUs != NULL );
+    assert( pMqttTimeUs != NULL );
+
+    /* Establish a TCP connection with the server endpoint, then
+     * establish TLS session on top of TCP connection. */
+    startTimeUs = Clock_GetTimeUs();
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_Connect( &networkContext,
+                                                         &serverInfo,
+                                                         &opensslCredentials,
+                                                         TRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                                         TRANSPORT_SEND_RECV_TIMEOUT_MS ) );
+    *pTlsTimeUs = Clock_GetTimeUs() - startTimeUs;
+    connected = true;
+
+    /* Setup the transport interface object for the library. */
+    transport.pNetworkContext = &networkContext;
+    transport.send = Openssl_Send;
+    transport.recv = Openssl_Recv;
+
+    /* Fill the values for network buffer. */
+    networkBuffer.pBuffer = buffer;
+    networkBuffer.size = NETWORK_BUFFER_SIZE;
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Init( &context,
+                                               &transport,
+                                               Clock_GetTimeMs,
+                                               eventCallback,
+                                               &networkBuffer ) );
+
+    ( void ) memset( &connectInfo, 0, sizeof( connectInfo ) );
+    connectInfo.cleanSession = true;
+    connectInfo.pClientIdentifier = TEST_CLIENT_IDENTIFIER;
+    connectInfo.clientIdentifierLength = TEST_CLIENT_IDENTIFIER_LENGTH;
+    connectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+
+    /* Send MQTT CONNECT packet to broker, and wait for the CONNACK. */
+    startTimeUs = Clock_GetTimeUs();
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Connect( &context,
+                                                  &connectInfo,
+                                                  NULL,
+                                                  CONNACK_RECV_TIMEOUT_MS,
+                                                  &sessionPresent ) );
+    *pMqttTimeUs = Clock_GetTimeUs() - startTimeUs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void disconnectFromBroker( void )
+{
+    MQTTStatus_t mqttStatus;
+    OpensslStatus_t opensslStatus;
+
+    /* Terminate MQTT connection. */
+    mqttStatus = MQTT_Disconnect( &context );
+
+    /* Terminate TLS session and TCP connection. */
+    opensslStatus = Openssl_Disconnect( &networkContext );
+    connected = false;
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, mqttStatus );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, opensslStatus );
+}
+
+/*-----------------------------------------------------------*/
+
+static void eventCallback( MQTTContext_t * pContext,
+                           MQTTPacketInfo_t * pPacketInfo,
+                           MQTTDeserializedInfo_t * pDeserializedInfo )
+{
+    assert( pContext != NULL );
+    assert( pPacketInfo != NULL );
+    assert( pDeserializedInfo != NULL );
+
+    /* Suppress unused parameter warning when asserts are disabled in build. */
+    ( void ) pContext;
+
+    TEST_ASSERT_EQUAL( MQTTSuccess, pDeserializedInfo->deserializationResult );
+
+    switch( pPacketInfo->type )
+    {
+        case MQTT_PACKET_TYPE_PUBACK:
+            pubAckCount++;
+            break;
+
+        case MQTT_PACKET_TYPE_SUBACK:
+            receivedSubAck = true;
+            break;
+
+        case MQTT_PACKET_TYPE_UNSUBACK:
+            receivedUnsubAck = true;
+            break;
+
+        default:
+            /* The tests do not subscribe to their own PUBLISH packets,
+             * so no other packet is expected. */
+            LogWarn( ( "Unexpected packet type received: (%02x).",
+                       pPacketInfo->type ) );
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void processIncomingPacket( void )
+{
+    /* A timeout of zero receives at most one packet, and returns as soon as
+     * the socket has no data. */
+    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_ProcessLoop( &context, 0U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void waitForAck( const bool * pFlag )
+{
+    uint32_t startTimeMs = Clock_GetTimeMs();
+
+    assert( pFlag != NULL );
+
+    while( ( *pFlag == false ) &&
+           ( ( Clock_GetTimeMs() - startTimeMs ) < ACK_WAIT_TIMEOUT_MS ) )
+    {
+        processIncomingPacket();
+    }
+
+    TEST_ASSERT_TRUE( *pFlag );
+}
+
+/*-----------------------------------------------------------*/
+
+static double measurePublishRate( MQTTQoS_t qos )
+{
+    MQTTPublishInfo_t publishInfo;
+    uint32_t sentCount = 0U;
+    uint32_t startTimeMs = 0U;
+    uint64_t startTimeUs = 0U;
+    uint64_t elapsedUs = 0U;
+
+    ( void ) memset( &publishInfo, 0, sizeof( publishInfo ) );
+    publishInfo.qos = qos;
+    publishInfo.pTopicName = PERFORMANCE_MQTT_TOPIC;
+    publishInfo.topicNameLength = PERFORMANCE_MQTT_TOPIC_LENGTH;
+    publishInfo.pPayload = publishPayload;
+    publishInfo.payloadLength = sizeof( publishPayload );
+
+    pubAckCount = 0U;
+    startTimeUs = Clock_GetTimeUs();
+
+    for( sentCount = 0U; sentCount < PERFORMANCE_PUBLISH_COUNT; sentCount++ )
+    {
+        /* Keep the number of unacknowledged PUBLISH packets within the
+         * capacity of the MQTT context. */
+        startTimeMs = Clock_GetTimeMs();
+
+        while( ( qos == MQTTQoS1 ) &&
+               ( ( sentCount - pubAckCount ) >= MAX_OUTSTANDING_PUBLISHES ) &&
+               ( ( Clock_GetTimeMs() - startTimeMs ) < ACK_WAIT_TIMEOUT_MS ) )
+        {
+            processIncomingPacket();
+        }
+
+        TEST_ASSERT_EQUAL( MQTTSuccess,
+                           MQTT_Publish( &context,
+                                         &publishInfo,
+                                         ( qos == MQTTQoS0 ) ? 0U : MQTT_GetPacketId( &context ) ) );
+    }
+
+    /* Wait for the remaining PUBACK packets. */
+    startTimeMs = Clock_GetTimeMs();
+
+    while( ( qos == MQTTQoS1 ) &&
+           ( pubAckCount < PERFORMANCE_PUBLISH_COUNT ) &&
+           ( ( Clock_GetTimeMs() - startTimeMs ) < ACK_WAIT_TIMEOUT_MS ) )
+    {
+        processIncomingPacket();
+    }
+
+    elapsedUs = Clock_GetTimeUs() - startTimeUs;
+
+    if( qos == MQTTQoS1 )
+    {
+        TEST_ASSERT_EQUAL_UINT32( PERFORMANCE_PUBLISH_COUNT, pubAckCount );
+    }
+
+    /* Count at least a microsecond, so that the rate is finite. */
+    return ( ( double ) PERFORMANCE_PUBLISH_COUNT * MICROSECONDS_PER_SECOND ) /
+           ( ( elapsedUs > 0U ) ? ( double ) elapsedUs : 1.0 );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before any test method. */
+void suiteSetUp()
+{
+    /* Missing baselines are reported, and do not fail the tests. */
+    ( void ) PerformanceReport_Init( "mqtt_performance", PERFORMANCE_BASELINES_PATH );
+}
+
+/* Called after all test methods. */
+int suiteTearDown( int numFailures )
+{
+    if( PerformanceReport_Write( MQTT_PERFORMANCE_RESULTS_PATH ) == false )
+    {
+        numFailures++;
+    }
+
+    return numFailures;
+}
+
+/* Called before each test method. */
+void setUp()
+{
+    connected = false;
+    pubAckCount = 0U;
+    receivedSubAck = false;
+    receivedUnsubAck = false;
+    ( void ) memset( publishPayload, 'p', sizeof( publishPayload ) );
+
+    ( void ) memset( &opensslCredentials, 0u, sizeof( OpensslCredentials_t ) );
+    ( void ) memset( &opensslParams, 0u, sizeof( OpensslParams_t ) );
+    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+    opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
+    opensslCredentials.pPrivateKeyPath = CLIENT_PRIVATE_KEY_PATH;
+    opensslCredentials.sniHostName = BROKER_ENDPOINT;
+
+    networkContext.pParams = &opensslParams;
+
+    serverInfo.pHostName = BROKER_ENDPOINT;
+    serverInfo.hostNameLength = BROKER_ENDPOINT_LENGTH;
+    serverInfo.port = BROKER_PORT;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* Disconnect only if a failed test case left the connection open. */
+    if( connected == true )
+    {
+        ( void ) MQTT_Disconnect( &context );
+        ( void ) Openssl_Disconnect( &networkContext );
+        connected = false;
+    }
+}
+
+/* ========================== Test Cases ============================ */
+
+/**
+ * @brief Measures the mean duration of the TCP connection and TLS handshake,
+ * and of the MQTT CONNECT request, over #PERFORMANCE_CONNECT_ITERATIONS
+ * connections.
+ */
+void test_MQTT_Connect_Performance( void )
+{
+    uint64_t tlsTimeUs = 0U;
+    uint64_t mqttTimeUs = 0U;
+    uint64_t totalTlsTimeUs = 0U;
+    uint64_t totalMqttTimeUs = 0U;
+    uint32_t i = 0U;
+    bool tlsPassed = false;
+    bool mqttPassed = false;
+
+    for( i = 0U; i < PERFORMANCE_CONNECT_ITERATIONS; i++ )
+    {
+        connectToBroker( &tlsTimeUs, &mqttTimeUs );
+        disconnectFromBroker();
+        totalTlsTimeUs += tlsTimeUs;
+        totalMqttTimeUs += mqttTimeUs;
+    }
+
+    tlsPassed = PerformanceReport_Record( "mqtt_tls_connect_ms",
+                                          ( ( double ) totalTlsTimeUs / MICROSECONDS_PER_MILLISECOND ) /
+                                          ( double ) PERFORMANCE_CONNECT_ITERATIONS,
+                                          "ms",
+                                          PERFORMANCE_LOWER_IS_BETTER );
+    mqttPassed = PerformanceReport_Record( "mqtt_connect_ms",
+                                           ( ( double ) totalMqttTimeUs / MICROSECONDS_PER_MILLISECOND ) /
+                                           ( double ) PERFORMANCE_CONNECT_ITERATIONS,
+                                           "ms",
+                                           PERFORMANCE_LOWER_IS_BETTER );
+
+    TEST_ASSERT_TRUE( tlsPassed );
+    TEST_ASSERT_TRUE( mqttPassed );
+}
+
+/**
+ * @brief Measures the rate of QoS 0 PUBLISH packets.
+ */
+void test_MQTT_Publish_QoS0_Throughput( void )
+{
+    uint64_t tlsTimeUs = 0U;
+    uint64_t mqttTimeUs = 0U;
+    double rate = 0.0;
+
+    connectToBroker( &tlsTimeUs, &mqttTimeUs );
+    rate = measurePublishRate( MQTTQoS0 );
+    disconnectFromBroker();
+
+    TEST_ASSERT_TRUE( PerformanceReport_Record( "mqtt_qos0_publish_rate",
+                                                rate,
+                                                "msg/s",
+                                                PERFORMANCE_HIGHER_IS_BETTER ) );
+}
+
+/**
+ * @brief Measures the rate of acknowledged QoS 1 PUBLISH packets.
+ */
+void test_MQTT_Publish_QoS1_Throughput( void )
+{
+    uint64_t tlsTimeUs = 0U;
+    uint64_t mqttTimeUs = 0U;
+    double rate = 0.0;
+
+    connectToBroker( &tlsTimeUs, &mqttTimeUs );
+    rate = measurePublishRate( MQTTQoS1 );
+    disconnectFromBroker();
+
+    TEST_ASSERT_TRUE( PerformanceReport_Record( "mqtt_qos1_publish_rate",
+                                                rate,
+                                                "msg/s",
+                                                PERFORMANCE_HIGHER_IS_BETTER ) );
+}
+
+/**
+ * @brief Measures the mean round trip from a SUBSCRIBE packet to its SUBACK,
+ * over #PERFORMANCE_SUBSCRIBE_ITERATIONS subscriptions.
+ */
+void test_MQTT_Subscribe_Round_Trip( void )
+{
+    MQTTSubscribeInfo_t subscription;
+    uint64_t tlsTimeUs = 0U;
+    uint64_t mqttTimeUs = 0U;
+    uint64_t startTimeUs = 0U;
+    uint64_t totalTimeUs = 0U;
+    uint32_t i = 0U;
+
+    ( void ) memset( &subscription, 0, sizeof( subscription ) );
+    subscription.qos = MQTTQoS1;
+    subscription.pTopicFilter = PERFORMANCE_MQTT_TOPIC;
+    subscription.topicFilterLength = PERFORMANCE_MQTT_TOPIC_LENGTH;
+
+    connectToBroker( &tlsTimeUs, &mqttTimeUs );
+
+    for( i = 0U; i < PERFORMANCE_SUBSCRIBE_ITERATIONS; i++ )
+    {
+        receivedSubAck = false;
+        receivedUnsubAck = false;
+
+        startTimeUs = Clock_GetTimeUs();
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Subscribe( &context,
+                                                        &subscription,
+                                                        1U,
+                                                        MQTT_GetPacketId( &context ) ) );
+        waitForAck( &receivedSubAck );
+        totalTimeUs += Clock_GetTimeUs() - startTimeUs;
+
+        /* Unsubscribe, so that the next SUBSCRIBE creates the subscription
+         * again. */
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_Unsubscribe( &context,
+                                                          &subscription,
+                                                          1U,
+                                                          MQTT_GetPacketId( &context ) ) );
+        waitForAck( &receivedUnsubAck );
+    }
+
+    disconnectFromBroker();
+
+    TEST_ASSERT_TRUE( PerformanceReport_Record( "mqtt_subscribe_round_trip_ms",
+                                                ( ( double ) totalTimeUs / MICROSECONDS_PER_MILLISECOND ) /
+                                                ( double ) PERFORMANCE_SUBSCRIBE_ITERATIONS,
+                                                "ms",
+                                                PERFORMANCE_LOWER_IS_BETTER ) );
+}
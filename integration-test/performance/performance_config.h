@@ -0,0 +1,156 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PERFORMANCE_CONFIG_H_
+#define PERFORMANCE_CONFIG_H_
+
+/**
+ * @brief Path of the file holding the baseline and the failure threshold of
+ * each metric.
+ *
+ * The build sets it to performance_baselines.json in this directory.
+ */
+#ifndef PERFORMANCE_BASELINES_PATH
+    #define PERFORMANCE_BASELINES_PATH    "performance_baselines.json"
+#endif
+
+/**
+ * @brief Paths of the machine-readable results written by the MQTT and HTTP
+ * performance tests, relative to the working directory of the test.
+ */
+#ifndef MQTT_PERFORMANCE_RESULTS_PATH
+    #define MQTT_PERFORMANCE_RESULTS_PATH    "mqtt_performance_results.json"
+#endif
+
+#ifndef HTTP_PERFORMANCE_RESULTS_PATH
+    #define HTTP_PERFORMANCE_RESULTS_PATH    "http_performance_results.json"
+#endif
+
+/**
+ * @brief Number of connections whose TLS handshake and MQTT CONNECT or HTTP
+ * connection time is averaged.
+ */
+#ifndef PERFORMANCE_CONNECT_ITERATIONS
+    #define PERFORMANCE_CONNECT_ITERATIONS    ( 10U )
+#endif
+
+/**
+ * @brief Number of PUBLISH packets sent to measure the publish throughput of
+ * each QoS.
+ */
+#ifndef PERFORMANCE_PUBLISH_COUNT
+    #define PERFORMANCE_PUBLISH_COUNT    ( 1000U )
+#endif
+
+/**
+ * @brief Payload length of the PUBLISH packets sent to measure the publish
+ * throughput.
+ */
+#ifndef PERFORMANCE_PUBLISH_PAYLOAD_LENGTH
+    #define PERFORMANCE_PUBLISH_PAYLOAD_LENGTH    ( 256U )
+#endif
+
+/**
+ * @brief Number of SUBSCRIBE requests whose round trip to the SUBACK is
+ * averaged.
+ */
+#ifndef PERFORMANCE_SUBSCRIBE_ITERATIONS
+    #define PERFORMANCE_SUBSCRIBE_ITERATIONS    ( 20U )
+#endif
+
+/**
+ * @brief Smallest and largest HTTP body lengths, in bytes, of the GET and PUT
+ * throughput measurements. The length is multiplied by
+ * #PERFORMANCE_HTTP_BODY_LENGTH_FACTOR between measurements, so the largest
+ * length is measured only if it is the smallest one times a power of the
+ * factor.
+ *
+ * @note The server must serve GET bodies of up to
+ * #PERFORMANCE_HTTP_MAX_BODY_LENGTH bytes, and accept PUT bodies as long.
+ */
+#ifndef PERFORMANCE_HTTP_MIN_BODY_LENGTH
+    #define PERFORMANCE_HTTP_MIN_BODY_LENGTH    ( 1024UL )
+#endif
+
+#ifndef PERFORMANCE_HTTP_MAX_BODY_LENGTH
+    #define PERFORMANCE_HTTP_MAX_BODY_LENGTH    ( 64UL * 1024UL * 1024UL )
+#endif
+
+#ifndef PERFORMANCE_HTTP_BODY_LENGTH_FACTOR
+    #define PERFORMANCE_HTTP_BODY_LENGTH_FACTOR    ( 4UL )
+#endif
+
+/**
+ * @brief Number of requests whose throughput is averaged for each body length.
+ */
+#ifndef PERFORMANCE_HTTP_REQUESTS_PER_LENGTH
+    #define PERFORMANCE_HTTP_REQUESTS_PER_LENGTH    ( 3U )
+#endif
+
+/**
+ * @brief Format of the path of a GET request for a body of the length given
+ * as an unsigned long, such as the /bytes endpoint of httpbin.
+ */
+#ifndef PERFORMANCE_HTTP_GET_PATH_FORMAT
+    #define PERFORMANCE_HTTP_GET_PATH_FORMAT    "/bytes/%lu"
+#endif
+
+/**
+ * @brief Path of the PUT requests.
+ */
+#ifndef PERFORMANCE_HTTP_PUT_PATH
+    #define PERFORMANCE_HTTP_PUT_PATH    "/put"
+#endif
+
+/**
+ * @brief Length of the buffer receiving HTTP responses.
+ *
+ * It holds a whole response, and servers such as httpbin echo the body of a
+ * PUT request in their response.
+ */
+#ifndef PERFORMANCE_HTTP_RESPONSE_BUFFER_LENGTH
+    #define PERFORMANCE_HTTP_RESPONSE_BUFFER_LENGTH    ( ( 2UL * PERFORMANCE_HTTP_MAX_BODY_LENGTH ) + 4096UL )
+#endif
+
+/**
+ * @brief Body length of the chunked response whose parse rate is measured,
+ * and the length of each of its chunks.
+ *
+ * The response is parsed from memory, so that the network does not limit the
+ * rate.
+ */
+#ifndef PERFORMANCE_CHUNKED_BODY_LENGTH
+    #define PERFORMANCE_CHUNKED_BODY_LENGTH    ( 4UL * 1024UL * 1024UL )
+#endif
+
+#ifndef PERFORMANCE_CHUNK_LENGTH
+    #define PERFORMANCE_CHUNK_LENGTH    ( 1024UL )
+#endif
+
+/**
+ * @brief Number of times the chunked response is parsed.
+ */
+#ifndef PERFORMANCE_CHUNKED_PARSE_ITERATIONS
+    #define PERFORMANCE_CHUNKED_PARSE_ITERATIONS    ( 10U )
+#endif
+
+#endif /* ifndef PERFORMANCE_CONFIG_H_ */
@@ -0,0 +1,417 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file performance_report.c
+ * @brief Implementation of the performance report of the performance tests.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Include config file before other non-system includes. */
+#include "test_config.h"
+
+#include "performance_report.h"
+
+/* JSON library include. */
+#include "core_json.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Members of a baseline holding its value and its threshold.
+ */
+#define BASELINE_VALUE_KEY        "baseline"
+#define BASELINE_THRESHOLD_KEY    "threshold_percent"
+
+/**
+ * @brief Size of a buffer holding a JSON query for a member of a baseline.
+ */
+#define QUERY_BUFFER_SIZE         ( PERFORMANCE_REPORT_MAX_NAME_LENGTH + sizeof( BASELINE_THRESHOLD_KEY ) + 1U )
+
+/**
+ * @brief Size of a buffer holding a JSON number, including the NULL
+ * terminator.
+ */
+#define NUMBER_BUFFER_SIZE        ( 32U )
+
+/**
+ * @brief A recorded metric.
+ */
+typedef struct PerformanceMetric
+{
+    char name[ PERFORMANCE_REPORT_MAX_NAME_LENGTH ]; /**< @brief Name of the metric. */
+    const char * pUnit;                              /**< @brief Unit of the value. */
+    double value;                                    /**< @brief Measured value. */
+    PerformanceDirection_t direction;                /**< @brief Whether a higher value is an improvement. */
+    bool hasBaseline;                                /**< @brief Whether the baselines file has the metric. */
+    double baseline;                                 /**< @brief Baseline of the metric. */
+    double thresholdPercent;                         /**< @brief Allowed regression, in percent of the baseline. */
+    bool passed;                                     /**< @brief Whether the value is within the threshold. */
+} PerformanceMetric_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Name of the test suite of the report.
+ */
+static const char * pReportSuiteName = NULL;
+
+/**
+ * @brief Contents of the baselines file; NULL if it could not be read.
+ */
+static char * pBaselines = NULL;
+
+/**
+ * @brief Length of #pBaselines.
+ */
+static size_t baselinesLength = 0U;
+
+/**
+ * @brief Metrics recorded so far.
+ */
+static PerformanceMetric_t metrics[ PERFORMANCE_REPORT_MAX_METRICS ];
+
+/**
+ * @brief Number of entries of #metrics in use.
+ */
+static size_t metricCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read a whole file into a new buffer.
+ *
+ * @param[in] pPath Path of the file.
+ * @param[out] pLength Length of the file.
+ *
+ * @return The buffer, to be freed by the caller; NULL on failure.
+ */
+static char * readFile( const char * pPath,
+                        size_t * pLength );
+
+/**
+ * @brief Find a number of the baseline of a metric.
+ *
+ * @param[in] pName Name of the metric.
+ * @param[in] pKey Member of the baseline holding the number.
+ * @param[out] pNumber The number.
+ *
+ * @return true if the baseline has the member; false otherwise.
+ */
+static bool findBaselineNumber( const char * pName,
+                                const char * pKey,
+                                double * pNumber );
+
+/*-----------------------------------------------------------*/
+
+static char * readFile( const char * pPath,
+                        size_t * pLength )
+{
+    FILE * pFile = NULL;
+    char * pBuffer = NULL;
+    long fileLength = -1;
+
+    assert( pPath != NULL );
+    assert( pLength != NULL );
+
+    pFile = fopen( pPath, "r" );
+
+    if( pFile == NULL )
+    {
+        LogWarn( ( "Could not open the baselines file %s.", pPath ) );
+    }
+    else
+    {
+        if( fseek( pFile, 0L, SEEK_END ) == 0 )
+        {
+            fileLength = ftell( pFile );
+        }
+
+        if( ( fileLength > 0 ) && ( fseek( pFile, 0L, SEEK_SET ) == 0 ) )
+        {
+            pBuffer = malloc( ( size_t ) fileLength );
+        }
+
+        if( ( pBuffer != NULL ) &&
+            ( fread( pBuffer, 1U, ( size_t ) fileLength, pFile ) != ( size_t ) fileLength ) )
+        {
+            free( pBuffer );
+            pBuffer = NULL;
+        }
+
+        if( pBuffer == NULL )
+        {
+            LogWarn( ( "Could not read the baselines file %s.", pPath ) );
+        }
+        else
+        {
+            *pLength = ( size_t ) fileLength;
+        }
+
+        ( void ) fclose( pFile );
+    }
+
+    return pBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool findBaselineNumber( const char * pName,
+                                const char * pKey,
+                                double * pNumber )
+{
+    bool found = false;
+    char query[ QUERY_BUFFER_SIZE ];
+    char number[ NUMBER_BUFFER_SIZE ];
+    char * pValue = NULL;
+    size_t valueLength = 0U;
+    int queryLength = 0;
+    char * pEnd = NULL;
+
+    assert( pName != NULL );
+    assert( pKey != NULL );
+    assert( pNumber != NULL );
+
+    queryLength = snprintf( query, sizeof( query ), "%s.%s", pName, pKey );
+
+    if( ( pBaselines != NULL ) &&
+        ( queryLength > 0 ) &&
+        ( ( size_t ) queryLength < sizeof( query ) ) &&
+        ( JSON_Search( pBaselines,
+                       baselinesLength,
+                       query,
+                       ( size_t ) queryLength,
+                       &pValue,
+                       &valueLength ) == JSONSuccess ) &&
+        ( valueLength < sizeof( number ) ) )
+    {
+        /* The value is not NULL-terminated in the file. */
+        ( void ) memcpy( number, pValue, valueLength );
+        number[ valueLength ] = '\0';
+        *pNumber = strtod( number, &pEnd );
+        found = ( pEnd == &number[ valueLength ] ) && ( valueLength > 0U );
+    }
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+bool PerformanceReport_Init( const char * pSuiteName,
+                             const char * pBaselinesPath )
+{
+    assert( pSuiteName != NULL );
+    assert( pBaselinesPath != NULL );
+
+    pReportSuiteName = pSuiteName;
+    metricCount = 0U;
+
+    free( pBaselines );
+    pBaselines = readFile( pBaselinesPath, &baselinesLength );
+
+    if( ( pBaselines != NULL ) &&
+        ( JSON_Validate( pBaselines, baselinesLength ) != JSONSuccess ) )
+    {
+        LogError( ( "The baselines file %s is not valid JSON.", pBaselinesPath ) );
+        free( pBaselines );
+        pBaselines = NULL;
+    }
+
+    if( pBaselines == NULL )
+    {
+        LogWarn( ( "No baselines: The metrics are reported without being checked." ) );
+    }
+
+    return pBaselines != NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+bool PerformanceReport_Record( const char * pName,
+                               double value,
+                               const char * pUnit,
+                               PerformanceDirection_t direction )
+{
+    bool passed = false;
+    PerformanceMetric_t * pMetric = NULL;
+
+    assert( pName != NULL );
+    assert( pUnit != NULL );
+
+    if( metricCount == PERFORMANCE_REPORT_MAX_METRICS )
+    {
+        LogError( ( "Too many metrics: Consider increasing PERFORMANCE_REPORT_MAX_METRICS." ) );
+    }
+    else if( strlen( pName ) >= PERFORMANCE_REPORT_MAX_NAME_LENGTH )
+    {
+        LogError( ( "The name of the metric %s is too long.", pName ) );
+    }
+    else
+    {
+        pMetric = &metrics[ metricCount ];
+        metricCount++;
+
+        ( void ) memset( pMetric, 0, sizeof( PerformanceMetric_t ) );
+        ( void ) strcpy( pMetric->name, pName );
+        pMetric->pUnit = pUnit;
+        pMetric->value = value;
+        pMetric->direction = direction;
+        pMetric->hasBaseline = findBaselineNumber( pName, BASELINE_VALUE_KEY, &pMetric->baseline );
+
+        if( findBaselineNumber( pName, BASELINE_THRESHOLD_KEY, &pMetric->thresholdPercent ) == false )
+        {
+            pMetric->thresholdPercent = PERFORMANCE_REPORT_DEFAULT_THRESHOLD_PERCENT;
+        }
+
+        if( pMetric->hasBaseline == false )
+        {
+            pMetric->passed = true;
+        }
+        else if( direction == PERFORMANCE_LOWER_IS_BETTER )
+        {
+            pMetric->passed = value <= ( pMetric->baseline * ( 1.0 + ( pMetric->thresholdPercent / 100.0 ) ) );
+        }
+        else
+        {
+            pMetric->passed = value >= ( pMetric->baseline * ( 1.0 - ( pMetric->thresholdPercent / 100.0 ) ) );
+        }
+
+        if( pMetric->passed == true )
+        {
+            LogInfo( ( "%s: %.3f %s.", pName, value, pUnit ) );
+        }
+        else
+        {
+            LogError( ( "%s regressed: %.3f %s, while the baseline is %.3f %s "
+                        "with a threshold of %.1f%%.",
+                        pName,
+                        value,
+                        pUnit,
+                        pMetric->baseline,
+                        pUnit,
+                        pMetric->thresholdPercent ) );
+        }
+
+        passed = pMetric->passed;
+    }
+
+    return passed;
+}
+
+/*-----------------------------------------------------------*/
+
+bool PerformanceReport_Write( const char * pResultsPath )
+{
+    FILE * pFile = NULL;
+    bool allPassed = true;
+    size_t i = 0U;
+    int writeStatus = 0;
+
+    assert( pResultsPath != NULL );
+
+    for( i = 0U; i < metricCount; i++ )
+    {
+        allPassed = allPassed && metrics[ i ].passed;
+    }
+
+    pFile = fopen( pResultsPath, "w" );
+
+    if( pFile == NULL )
+    {
+        LogError( ( "Could not create the results file %s.", pResultsPath ) );
+    }
+    else
+    {
+        writeStatus = fprintf( pFile,
+                               "{\n"
+                               "  \"suite\": \"%s\",\n"
+                               "  \"timestamp\": %lld,\n"
+                               "  \"passed\": %s,\n"
+                               "  \"metrics\": [",
+                               ( pReportSuiteName != NULL ) ? pReportSuiteName : "",
+                               ( long long ) time( NULL ),
+                               allPassed ? "true" : "false" );
+
+        for( i = 0U; ( i < metricCount ) && ( writeStatus >= 0 ); i++ )
+        {
+            writeStatus = fprintf( pFile,
+                                   "%s\n    { \"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\", "
+                                   "\"higher_is_better\": %s, ",
+                                   ( i == 0U ) ? "" : ",",
+                                   metrics[ i ].name,
+                                   metrics[ i ].value,
+                                   metrics[ i ].pUnit,
+                                   ( metrics[ i ].direction == PERFORMANCE_HIGHER_IS_BETTER ) ? "true" : "false" );
+
+            if( ( writeStatus >= 0 ) && ( metrics[ i ].hasBaseline == true ) )
+            {
+                writeStatus = fprintf( pFile,
+                                       "\"baseline\": %.3f, \"threshold_percent\": %.1f, ",
+                                       metrics[ i ].baseline,
+                                       metrics[ i ].thresholdPercent );
+            }
+            else if( writeStatus >= 0 )
+            {
+                writeStatus = fprintf( pFile, "\"baseline\": null, \"threshold_percent\": null, " );
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+
+            if( writeStatus >= 0 )
+            {
+                writeStatus = fprintf( pFile,
+                                       "\"passed\": %s }",
+                                       metrics[ i ].passed ? "true" : "false" );
+            }
+        }
+
+        if( writeStatus >= 0 )
+        {
+            writeStatus = fprintf( pFile, "\n  ]\n}\n" );
+        }
+
+        if( ( fclose( pFile ) != 0 ) || ( writeStatus < 0 ) )
+        {
+            LogError( ( "Could not write the results file %s.", pResultsPath ) );
+            writeStatus = -1;
+        }
+        else
+        {
+            LogInfo( ( "Wrote %u performance metrics to %s.",
+                       ( unsigned int ) metricCount,
+                       pResultsPath ) );
+        }
+    }
+
+    free( pBaselines );
+    pBaselines = NULL;
+
+    return ( pFile != NULL ) && ( writeStatus >= 0 );
+}
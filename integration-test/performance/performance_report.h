@@ -0,0 +1,115 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PERFORMANCE_REPORT_H_
+#define PERFORMANCE_REPORT_H_
+
+/**
+ * @file performance_report.h
+ * @brief Records the metrics measured by the performance tests, compares
+ * them with their baselines, and writes them as JSON.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Maximum number of metrics recorded by a test.
+ */
+#ifndef PERFORMANCE_REPORT_MAX_METRICS
+    #define PERFORMANCE_REPORT_MAX_METRICS    ( 64U )
+#endif
+
+/**
+ * @brief Maximum length of the name of a metric, including the NULL
+ * terminator.
+ */
+#ifndef PERFORMANCE_REPORT_MAX_NAME_LENGTH
+    #define PERFORMANCE_REPORT_MAX_NAME_LENGTH    ( 64U )
+#endif
+
+/**
+ * @brief Threshold, in percent of the baseline, of the metrics whose baseline
+ * has no "threshold_percent" member.
+ */
+#ifndef PERFORMANCE_REPORT_DEFAULT_THRESHOLD_PERCENT
+    #define PERFORMANCE_REPORT_DEFAULT_THRESHOLD_PERCENT    ( 25.0 )
+#endif
+
+/**
+ * @brief Whether a larger or a smaller value of a metric is an improvement.
+ */
+typedef enum PerformanceDirection
+{
+    PERFORMANCE_LOWER_IS_BETTER = 0, /**< Durations, such as a connect time. */
+    PERFORMANCE_HIGHER_IS_BETTER     /**< Rates, such as a throughput. */
+} PerformanceDirection_t;
+
+/**
+ * @brief Start a report and read the baselines of its metrics.
+ *
+ * The baselines file is a JSON object with one member per metric, for
+ * example:
+ * @code{.json}
+ * { "mqtt_tls_connect_ms": { "baseline": 500, "threshold_percent": 50 } }
+ * @endcode
+ * A metric fails when it is worse than its baseline by more than its
+ * threshold. Metrics without a baseline are reported, and never fail.
+ *
+ * @param[in] pSuiteName Name of the test suite, written in the results.
+ * @param[in] pBaselinesPath Path of the baselines file.
+ *
+ * @return true if the baselines were read; false if the file is missing or
+ * is not valid JSON, in which case no metric fails.
+ */
+bool PerformanceReport_Init( const char * pSuiteName,
+                             const char * pBaselinesPath );
+
+/**
+ * @brief Record the value of a metric and compare it with its baseline.
+ *
+ * @param[in] pName Name of the metric, which must be a key of the baselines
+ * file. It must not contain '.'.
+ * @param[in] value Measured value.
+ * @param[in] pUnit Unit of @p value, written in the results.
+ * @param[in] direction Whether a higher value is an improvement.
+ *
+ * @return false if the value is worse than its baseline by more than the
+ * threshold, or if the report is full; true otherwise.
+ */
+bool PerformanceReport_Record( const char * pName,
+                               double value,
+                               const char * pUnit,
+                               PerformanceDirection_t direction );
+
+/**
+ * @brief Write the recorded metrics, with their baselines and whether they
+ * passed, as a JSON object.
+ *
+ * @param[in] pResultsPath Path of the file to write.
+ *
+ * @return true if the file was written; false otherwise.
+ */
+bool PerformanceReport_Write( const char * pResultsPath );
+
+#endif /* ifndef PERFORMANCE_REPORT_H_ */
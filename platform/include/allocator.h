@@ -0,0 +1,311 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file allocator.h
+ * @brief Allocator of the platform layer and the demo helpers, which counts
+ * the bytes in use by each subsystem and can take them from a fixed pool.
+ *
+ * Each block starts with a header holding its size and subsystem, so that
+ * #Allocator_Free accounts for it without being told. The blocks come from
+ * malloc unless #Allocator_SetBackend installs another backend, such as an
+ * #AllocatorPool_t. Setting ALLOCATOR_STATIC_POOL_SIZE makes a pool over a
+ * static buffer the default backend, so that the program never calls
+ * malloc through this interface and its memory is bounded at build time.
+ */
+
+#ifndef ALLOCATOR_H_
+#define ALLOCATOR_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/**
+ * @brief Size of the static buffer of the default pool; 0 for malloc.
+ *
+ * When it is not 0, every block comes from an #AllocatorPool_t over a
+ * static buffer of this size, and an allocation fails once the pool is
+ * exhausted.
+ */
+#ifndef ALLOCATOR_STATIC_POOL_SIZE
+    #define ALLOCATOR_STATIC_POOL_SIZE    ( 0U )
+#endif
+
+/**
+ * @brief Alignment of the blocks, and size of their header.
+ */
+#define ALLOCATOR_ALIGNMENT               ( 16U )
+
+/**
+ * @brief Size of the smallest block of an #AllocatorPool_t, header included.
+ */
+#define ALLOCATOR_POOL_MIN_BLOCK_SIZE     ( 32U )
+
+/**
+ * @brief Number of block sizes of an #AllocatorPool_t.
+ *
+ * Class i holds blocks of #ALLOCATOR_POOL_MIN_BLOCK_SIZE * 2^i bytes, so
+ * that the largest block of the default 16 classes is 1 MiB.
+ */
+#ifndef ALLOCATOR_POOL_CLASS_COUNT
+    #define ALLOCATOR_POOL_CLASS_COUNT    ( 16U )
+#endif
+
+/**
+ * @brief Return codes of the allocator functions.
+ */
+typedef enum AllocatorStatus
+{
+    AllocatorSuccess = 0,    /**< @brief Function successfully completed. */
+    AllocatorBadParameter,   /**< @brief At least one parameter was invalid. */
+    AllocatorBusy,           /**< @brief Blocks of the current backend are still in use. */
+    AllocatorApiError        /**< @brief A library refused the allocator. */
+} AllocatorStatus_t;
+
+/**
+ * @brief Subsystems whose memory is counted apart.
+ */
+typedef enum AllocatorSubsystem
+{
+    ALLOCATOR_SUBSYSTEM_OTHER = 0, /**< @brief Anything else. */
+    ALLOCATOR_SUBSYSTEM_TRANSPORT, /**< @brief Sockets and TLS transports, other than the TLS library. */
+    ALLOCATOR_SUBSYSTEM_OPENSSL,   /**< @brief The OpenSSL library, once #Openssl_UseAllocator is called. */
+    ALLOCATOR_SUBSYSTEM_MQTT,      /**< @brief MQTT connections and their helpers. */
+    ALLOCATOR_SUBSYSTEM_DEMO,      /**< @brief The demos and their helpers. */
+    ALLOCATOR_SUBSYSTEM_COUNT      /**< @brief Number of subsystems. */
+} AllocatorSubsystem_t;
+
+/**
+ * @brief Memory counted for a subsystem, or for all of them.
+ */
+typedef struct AllocatorStats
+{
+    uint64_t currentBytes; /**< @brief Bytes of the blocks in use, headers included. */
+    uint64_t peakBytes;    /**< @brief Highest value of #AllocatorStats_t.currentBytes. */
+    uint64_t blocks;       /**< @brief Number of blocks in use. */
+    uint64_t allocations;  /**< @brief Number of blocks allocated since the start. */
+    uint64_t failures;     /**< @brief Number of allocations that failed. */
+} AllocatorStats_t;
+
+/**
+ * @brief Source of the blocks of the allocator.
+ */
+typedef struct AllocatorBackend
+{
+    /**
+     * @brief Allocate a block aligned to #ALLOCATOR_ALIGNMENT.
+     *
+     * @param[in] pContext #AllocatorBackend_t.pContext.
+     * @param[in] size Size of the block, header included.
+     *
+     * @return The block; NULL if there is no memory.
+     */
+    void * ( * allocate )( void * pContext,
+                           size_t size );
+
+    /**
+     * @brief Release a block of #AllocatorBackend_t.allocate.
+     *
+     * @param[in] pContext #AllocatorBackend_t.pContext.
+     * @param[in] pBlock The block.
+     * @param[in] size Size the block was allocated with.
+     */
+    void ( * release )( void * pContext,
+                        void * pBlock,
+                        size_t size );
+
+    void * pContext; /**< @brief Context of the functions. */
+} AllocatorBackend_t;
+
+/**
+ * @brief A pool of blocks of power of two sizes, carved from a buffer.
+ *
+ * A block is carved from the end of the used part of the buffer the first
+ * time its size is needed, and goes to the free list of its size when it
+ * is released, for the next allocation of that size. The buffer is never
+ * returned to the system, so #AllocatorPool_t.used is the high-water mark
+ * of the pool.
+ */
+typedef struct AllocatorPool
+{
+    uint8_t * pBuffer;                                /**< @brief Start of the buffer, aligned to #ALLOCATOR_ALIGNMENT. */
+    size_t size;                                      /**< @brief Size of the buffer after alignment. */
+    size_t used;                                      /**< @brief Bytes carved from the buffer. */
+    void * pFreeLists[ ALLOCATOR_POOL_CLASS_COUNT ];  /**< @brief Released blocks of each size, linked by their first word. */
+    pthread_mutex_t mutex;                            /**< @brief Serializes the allocations. */
+} AllocatorPool_t;
+
+/**
+ * @brief Allocate a block for a subsystem.
+ *
+ * @param[in] subsystem Subsystem the block is counted for.
+ * @param[in] size Size of the block.
+ *
+ * @return The block, aligned to #ALLOCATOR_ALIGNMENT; NULL if there is no
+ * memory.
+ */
+void * Allocator_Malloc( AllocatorSubsystem_t subsystem,
+                         size_t size );
+
+/**
+ * @brief Allocate a zeroed array for a subsystem.
+ *
+ * @param[in] subsystem Subsystem the array is counted for.
+ * @param[in] count Number of elements.
+ * @param[in] size Size of an element.
+ *
+ * @return The array; NULL if there is no memory or its size overflows.
+ */
+void * Allocator_Calloc( AllocatorSubsystem_t subsystem,
+                         size_t count,
+                         size_t size );
+
+/**
+ * @brief Resize a block, as realloc does.
+ *
+ * @param[in] subsystem Subsystem the new block is counted for.
+ * @param[in] pBlock The block; NULL to allocate a new one.
+ * @param[in] size New size of the block; 0 to free it.
+ *
+ * @return The new block; NULL if there is no memory, in which case
+ * @p pBlock is kept, or if @p size is 0.
+ */
+void * Allocator_Realloc( AllocatorSubsystem_t subsystem,
+                          void * pBlock,
+                          size_t size );
+
+/**
+ * @brief Copy at most @p length characters of a string into a new block.
+ *
+ * @param[in] subsystem Subsystem the copy is counted for.
+ * @param[in] pString The string.
+ * @param[in] length Maximum number of characters copied.
+ *
+ * @return The NUL terminated copy; NULL if there is no memory.
+ */
+char * Allocator_Strndup( AllocatorSubsystem_t subsystem,
+                          const char * pString,
+                          size_t length );
+
+/**
+ * @brief Free a block of the allocator.
+ *
+ * @param[in] pBlock The block; NULL does nothing.
+ */
+void Allocator_Free( void * pBlock );
+
+/**
+ * @brief Replace the source of the blocks.
+ *
+ * @param[in] pBackend The backend, copied; NULL for the default one.
+ *
+ * @return #AllocatorSuccess; #AllocatorBusy if blocks of the current
+ * backend are in use; #AllocatorBadParameter if a function of
+ * @p pBackend is NULL.
+ */
+AllocatorStatus_t Allocator_SetBackend( const AllocatorBackend_t * pBackend );
+
+/**
+ * @brief Read the memory counted for a subsystem.
+ *
+ * @param[in] subsystem The subsystem.
+ * @param[out] pStats The memory of the subsystem.
+ */
+void Allocator_GetStats( AllocatorSubsystem_t subsystem,
+                         AllocatorStats_t * pStats );
+
+/**
+ * @brief Read the memory counted for all the subsystems.
+ *
+ * Its peak is the highest total in use at once, not the sum of the peaks
+ * of the subsystems.
+ *
+ * @param[out] pStats The memory of the program.
+ */
+void Allocator_GetTotalStats( AllocatorStats_t * pStats );
+
+/**
+ * @brief Restart the peaks from the bytes in use, to measure the peak of a
+ * phase of the program.
+ */
+void Allocator_ResetPeaks( void );
+
+/**
+ * @brief Name of a subsystem, such as "openssl".
+ *
+ * @param[in] subsystem The subsystem.
+ *
+ * @return The name; "unknown" if @p subsystem is invalid.
+ */
+const char * Allocator_SubsystemName( AllocatorSubsystem_t subsystem );
+
+/**
+ * @brief Set up a pool over a buffer.
+ *
+ * @param[out] pPool The pool.
+ * @param[in] pBuffer The buffer, which must remain valid while the pool is
+ * used.
+ * @param[in] bufferSize Size of @p pBuffer.
+ *
+ * @return #AllocatorSuccess; #AllocatorBadParameter if a pointer is NULL
+ * or the buffer cannot hold the smallest block.
+ */
+AllocatorStatus_t AllocatorPool_Init( AllocatorPool_t * pPool,
+                                      void * pBuffer,
+                                      size_t bufferSize );
+
+/**
+ * @brief Allocate a block from a pool, as #AllocatorBackend_t.allocate.
+ *
+ * @param[in] pPool The #AllocatorPool_t.
+ * @param[in] size Size of the block.
+ *
+ * @return The block; NULL if the pool is exhausted or @p size is larger
+ * than its largest block.
+ */
+void * AllocatorPool_Allocate( void * pPool,
+                               size_t size );
+
+/**
+ * @brief Release a block to a pool, as #AllocatorBackend_t.release.
+ *
+ * @param[in] pPool The #AllocatorPool_t.
+ * @param[in] pBlock The block.
+ * @param[in] size Size the block was allocated with.
+ */
+void AllocatorPool_Release( void * pPool,
+                            void * pBlock,
+                            size_t size );
+
+/**
+ * @brief Forget the memory counted and restore the default backend.
+ *
+ * For tests only: no block may be in use.
+ */
+void Allocator_Reset( void );
+
+#endif /* ifndef ALLOCATOR_H_ */
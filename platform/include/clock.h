@@ -40,6 +40,36 @@
  */
 uint32_t Clock_GetTimeMs( void );
 
+/**
+ * @brief The high resolution timer query function, for measuring durations.
+ *
+ * The time is read from a clock that is not adjusted by NTP where the
+ * platform has one, so its time base differs from that of #Clock_GetTimeMs.
+ * Only differences between two values are meaningful.
+ *
+ * @return Time in nanoseconds.
+ */
+uint64_t Clock_GetTimeNs( void );
+
+/**
+ * @brief The high resolution timer query function, in microseconds.
+ *
+ * Same time base as #Clock_GetTimeNs.
+ *
+ * @return Time in microseconds.
+ */
+uint64_t Clock_GetTimeUs( void );
+
+/**
+ * @brief The timer query function for timeouts that do not need precision.
+ *
+ * The time may be a few milliseconds behind #Clock_GetTimeMs, but is cheaper
+ * to read where the platform has a coarse clock.
+ *
+ * @return Time in milliseconds.
+ */
+uint32_t Clock_GetCoarseTimeMs( void );
+
 /**
  * @brief Millisecond sleep function.
  *
@@ -0,0 +1,279 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file metrics.h
+ * @brief Registry of the counters, gauges and histograms of the SDK, and
+ * their exporters.
+ *
+ * Each thread records into a shard of its own with relaxed atomic adds, so
+ * recording never takes a lock or shares a cache line with another thread.
+ * The shards are merged when the registry is read by #Metrics_Snapshot, by
+ * the Prometheus endpoint of #Metrics_StartPrometheusServer, or by
+ * #Metrics_SendStatsd.
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of metrics registered.
+ */
+#ifndef METRICS_MAX_COUNT
+    #define METRICS_MAX_COUNT    ( 64U )
+#endif
+
+/**
+ * @brief Maximum number of histograms among the metrics registered.
+ */
+#ifndef METRICS_MAX_HISTOGRAMS
+    #define METRICS_MAX_HISTOGRAMS    ( 8U )
+#endif
+
+/**
+ * @brief Number of buckets of a histogram.
+ *
+ * Bucket i counts the values from 2^i to 2^(i+1) - 1, bucket 0 also counts
+ * 0, and the last bucket counts every larger value.
+ */
+#define METRICS_HISTOGRAM_BUCKETS    ( 24U )
+
+/**
+ * @brief Maximum length of the name of a metric.
+ */
+#define METRICS_NAME_MAX_LENGTH      ( 64U )
+
+/**
+ * @brief Maximum length of the help text of a metric.
+ */
+#define METRICS_HELP_MAX_LENGTH      ( 128U )
+
+/**
+ * @brief Identifier of a metric that could not be registered.
+ *
+ * Recording into it does nothing, so that a program keeps running when the
+ * registry is full.
+ */
+#define METRICS_INVALID_ID           ( 0xFFFFFFFFU )
+
+/**
+ * @brief Return codes of the metrics functions.
+ */
+typedef enum MetricsStatus
+{
+    MetricsSuccess = 0,     /**< @brief Function successfully completed. */
+    MetricsBadParameter,    /**< @brief At least one parameter was invalid. */
+    MetricsRegistryFull,    /**< @brief #METRICS_MAX_COUNT or #METRICS_MAX_HISTOGRAMS is reached. */
+    MetricsTypeMismatch,    /**< @brief The name is registered with another type. */
+    MetricsNoMemory,        /**< @brief A buffer is too small or could not be allocated. */
+    MetricsNetworkError,    /**< @brief A socket could not be opened or used. */
+    MetricsAlreadyStarted   /**< @brief The Prometheus endpoint already runs. */
+} MetricsStatus_t;
+
+/**
+ * @brief Kinds of metrics.
+ */
+typedef enum MetricsType
+{
+    METRICS_TYPE_COUNTER = 0, /**< @brief Total that only increases, recorded with #Metrics_Add. */
+    METRICS_TYPE_GAUGE,       /**< @brief Value set with #Metrics_Set, or read from a callback. */
+    METRICS_TYPE_HISTOGRAM    /**< @brief Distribution of the values of #Metrics_Observe. */
+} MetricsType_t;
+
+/**
+ * @brief Identifier of a registered metric.
+ */
+typedef uint32_t MetricsId_t;
+
+/**
+ * @brief Function reading a gauge when the registry is read.
+ *
+ * It is called from the thread reading the registry, so it must be safe
+ * to call from any thread.
+ *
+ * @param[in] pContext The context given to #Metrics_RegisterGaugeCallback.
+ *
+ * @return The value of the gauge.
+ */
+typedef int64_t ( * MetricsGaugeCallback_t )( void * pContext );
+
+/**
+ * @brief Value of a metric, merged from the shards of all the threads.
+ */
+typedef struct MetricsSample
+{
+    const char * pName;                             /**< @brief Name of the metric, valid while the program runs. */
+    const char * pHelp;                             /**< @brief Help text of the metric, valid while the program runs. */
+    MetricsType_t type;                             /**< @brief Type of the metric. */
+    uint64_t counter;                               /**< @brief Total of a counter. */
+    int64_t gauge;                                  /**< @brief Value of a gauge. */
+    uint64_t count;                                 /**< @brief Number of values of a histogram. */
+    uint64_t sum;                                   /**< @brief Sum of the values of a histogram. */
+    uint64_t buckets[ METRICS_HISTOGRAM_BUCKETS ];  /**< @brief Values of a histogram in each bucket, not cumulative. */
+} MetricsSample_t;
+
+/**
+ * @brief Register a metric, or get the identifier of the metric already
+ * registered with the same name and type.
+ *
+ * Names follow the rules of Prometheus: letters, digits, '_' and ':', not
+ * starting with a digit.
+ *
+ * @param[in] pName Name of the metric, copied into the registry.
+ * @param[in] pHelp Help text of the metric, copied into the registry; may be NULL.
+ * @param[in] type Type of the metric.
+ * @param[out] pId Identifier of the metric; #METRICS_INVALID_ID when the
+ * metric could not be registered.
+ *
+ * @return #MetricsSuccess if the metric is registered;
+ * #MetricsBadParameter if the name is invalid;
+ * #MetricsTypeMismatch if the name is registered with another type;
+ * #MetricsRegistryFull if there is no room for the metric.
+ */
+MetricsStatus_t Metrics_Register( const char * pName,
+                                  const char * pHelp,
+                                  MetricsType_t type,
+                                  MetricsId_t * pId );
+
+/**
+ * @brief Register a gauge whose value is read from a callback when the
+ * registry is read.
+ *
+ * @param[in] pName Name of the gauge, as for #Metrics_Register.
+ * @param[in] pHelp Help text of the gauge; may be NULL.
+ * @param[in] callback Function returning the value of the gauge.
+ * @param[in] pContext Context passed to @p callback.
+ * @param[out] pId Identifier of the gauge.
+ *
+ * @return As #Metrics_Register; #MetricsTypeMismatch if the name is
+ * registered already.
+ */
+MetricsStatus_t Metrics_RegisterGaugeCallback( const char * pName,
+                                               const char * pHelp,
+                                               MetricsGaugeCallback_t callback,
+                                               void * pContext,
+                                               MetricsId_t * pId );
+
+/**
+ * @brief Add to a counter, in the shard of the calling thread.
+ *
+ * @param[in] id Identifier of the counter.
+ * @param[in] value Amount added.
+ */
+void Metrics_Add( MetricsId_t id,
+                  uint64_t value );
+
+/**
+ * @brief Set the value of a gauge.
+ *
+ * @param[in] id Identifier of the gauge.
+ * @param[in] value New value of the gauge.
+ */
+void Metrics_Set( MetricsId_t id,
+                  int64_t value );
+
+/**
+ * @brief Add a value to a histogram, in the shard of the calling thread.
+ *
+ * @param[in] id Identifier of the histogram.
+ * @param[in] value Value observed, such as a latency in microseconds.
+ */
+void Metrics_Observe( MetricsId_t id,
+                      uint64_t value );
+
+/**
+ * @brief Read the value of every metric registered, merged from the shards
+ * of all the threads.
+ *
+ * @param[out] pSamples Array receiving a sample per metric, in the order of
+ * registration.
+ * @param[in] length Length of @p pSamples.
+ * @param[out] pCount Number of samples written.
+ *
+ * @return #MetricsSuccess if every metric is read; #MetricsNoMemory if
+ * @p pSamples is too short for all of them, which then contains the first
+ * @p length; #MetricsBadParameter if a pointer is NULL.
+ */
+MetricsStatus_t Metrics_Snapshot( MetricsSample_t * pSamples,
+                                  size_t length,
+                                  size_t * pCount );
+
+/**
+ * @brief Write every metric in the text exposition format of Prometheus.
+ *
+ * @param[out] pBuffer Buffer receiving the text, NUL terminated.
+ * @param[in] bufferSize Size of @p pBuffer.
+ *
+ * @return Length of the text; 0 if it does not fit in @p pBuffer.
+ */
+size_t Metrics_FormatPrometheus( char * pBuffer,
+                                 size_t bufferSize );
+
+/**
+ * @brief Start a thread serving the metrics in the Prometheus format over
+ * HTTP, on a port of the loopback interface.
+ *
+ * @param[in] port TCP port of the endpoint.
+ *
+ * @return #MetricsSuccess if the endpoint runs; #MetricsNetworkError if the
+ * port could not be bound; #MetricsAlreadyStarted if it runs already;
+ * #MetricsNoMemory if the thread could not be started.
+ */
+MetricsStatus_t Metrics_StartPrometheusServer( uint16_t port );
+
+/**
+ * @brief Stop the thread of #Metrics_StartPrometheusServer and close its
+ * port.
+ */
+void Metrics_StopPrometheusServer( void );
+
+/**
+ * @brief Send the metrics to a StatsD server in a UDP datagram or more.
+ *
+ * Counters are sent as the increase since the previous call, gauges as
+ * their value, and histograms as the increases of their count and sum, as
+ * "<name>_count" and "<name>_sum" counters.
+ *
+ * @param[in] pHost Host name or address of the StatsD server.
+ * @param[in] port UDP port of the StatsD server, usually 8125.
+ * @param[in] pPrefix Prefix of the names, such as "device1."; may be NULL.
+ *
+ * @return #MetricsSuccess if every datagram is sent; #MetricsNetworkError
+ * otherwise; #MetricsBadParameter if @p pHost is NULL.
+ */
+MetricsStatus_t Metrics_SendStatsd( const char * pHost,
+                                    uint16_t port,
+                                    const char * pPrefix );
+
+/**
+ * @brief Forget the metrics registered and their values.
+ *
+ * For tests only: no other thread may use the registry meanwhile.
+ */
+void Metrics_Reset( void );
+
+#endif /* ifndef METRICS_H_ */
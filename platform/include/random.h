@@ -0,0 +1,69 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file random.h
+ * @brief Secure random numbers used by demos and tests in this SDK, such as
+ * the jitter of the retry backoffs.
+ */
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Fill a buffer with random bytes from the CSPRNG of the platform.
+ *
+ * Small requests are served from a buffer of the calling thread, which is
+ * refilled in a single request to the platform once it runs out, so that
+ * a random number for a backoff does not cost a system call.
+ *
+ * @param[out] pBuffer Buffer to fill.
+ * @param[in] length Length of pBuffer.
+ *
+ * @return true if pBuffer is filled; false if the platform failed to
+ * provide random bytes.
+ */
+bool Random_GetBytes( void * pBuffer,
+                      size_t length );
+
+/**
+ * @brief Get a random 32-bit number from #Random_GetBytes, in the signature
+ * of the random number function of the backoff algorithm.
+ *
+ * @return A random number; 0 if the platform failed to provide one.
+ */
+uint32_t Random_GetUint32( void );
+
+/**
+ * @brief Discard the random bytes buffered for the calling thread.
+ *
+ * A child process must call it after fork, so that it does not serve the
+ * same bytes as its parent.
+ */
+void Random_Reset( void );
+
+#endif /* ifndef RANDOM_H_ */
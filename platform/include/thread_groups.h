@@ -0,0 +1,200 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file thread_groups.h
+ * @brief Placement of the threads of the platform layer and the demo helpers
+ * on the CPUs and NUMA nodes of the host, by named groups.
+ *
+ * The code creating a thread only names its group, such as "dispatch" or
+ * "download"; the application defines the CPUs of each group once at start.
+ * A group keeps its threads on the caches of its CPUs, and its buffers
+ * allocated with #ThreadGroup_Allocate on the node of these CPUs, so that
+ * its threads do not reach across sockets for their memory. A group that is
+ * not defined places its threads on the CPUs not isolated for another group.
+ */
+
+#ifndef THREAD_GROUPS_H_
+#define THREAD_GROUPS_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/**
+ * @brief Maximum number of groups defined at once.
+ */
+#ifndef THREAD_GROUP_MAX_COUNT
+    #define THREAD_GROUP_MAX_COUNT    ( 8U )
+#endif
+
+/**
+ * @brief Maximum length of the name of a group.
+ *
+ * The threads of a group are named "<group>-<index>", which the kernel
+ * truncates after 15 characters.
+ */
+#define THREAD_GROUP_NAME_MAX_LENGTH    ( 10U )
+
+/**
+ * @brief Directory of the NUMA nodes in sysfs, holding the CPUs of each node
+ * in node<N>/cpulist.
+ */
+#ifndef THREAD_GROUP_NODE_PATH
+    #define THREAD_GROUP_NODE_PATH    "/sys/devices/system/node"
+#endif
+
+/**
+ * @brief Node of a group whose CPUs are not all on the same NUMA node, or of
+ * a host without NUMA nodes.
+ */
+#define THREAD_GROUP_NO_NODE    ( -1 )
+
+/**
+ * @brief Return codes of the thread group functions.
+ */
+typedef enum ThreadGroupStatus
+{
+    ThreadGroupSuccess = 0,  /**< @brief Function successfully completed. */
+    ThreadGroupBadParameter, /**< @brief At least one parameter was invalid, or no CPU of the list is available. */
+    ThreadGroupNoMemory,     /**< @brief Every group is defined, or there is no memory. */
+    ThreadGroupApiError      /**< @brief The system refused the placement or the thread. */
+} ThreadGroupStatus_t;
+
+/**
+ * @brief Define the CPUs of a group, or change those of a defined group.
+ *
+ * The threads already running in the group keep their CPUs; the next ones
+ * get the new CPUs. Defining an isolated group again ends its isolation,
+ * without giving its CPU back to the other groups.
+ *
+ * @param[in] pName Name of the group, at most #THREAD_GROUP_NAME_MAX_LENGTH
+ * characters.
+ * @param[in] pCpuList The CPUs, as in a sysfs cpulist: "0-3,8,10-11". The
+ * CPUs the process may not run on and those isolated for another group are
+ * left out.
+ *
+ * @return #ThreadGroupSuccess; #ThreadGroupBadParameter if the name or the
+ * list is invalid or leaves no CPU; #ThreadGroupNoMemory if
+ * #THREAD_GROUP_MAX_COUNT groups are defined.
+ */
+ThreadGroupStatus_t ThreadGroup_Define( const char * pName,
+                                        const char * pCpuList );
+
+/**
+ * @brief Dedicate a CPU to a group, such as the one running the MQTT event
+ * loop, so that no other thread of the groups delays it.
+ *
+ * The group is defined on @p cpu alone, and the CPU is taken out of the
+ * other groups and of the threads of the groups not defined. Threads
+ * created without this interface, and other processes, may still run on
+ * it, unless the CPU is also left out of the scheduler with isolcpus.
+ *
+ * @param[in] pName Name of the group.
+ * @param[in] cpu The CPU.
+ *
+ * @return #ThreadGroupSuccess; #ThreadGroupBadParameter if the CPU is not
+ * available, is the last one of another group, or is isolated for another
+ * group; #ThreadGroupNoMemory if #THREAD_GROUP_MAX_COUNT groups are
+ * defined.
+ */
+ThreadGroupStatus_t ThreadGroup_Isolate( const char * pName,
+                                         uint32_t cpu );
+
+/**
+ * @brief Create a thread on the CPUs of a group, named after the group.
+ *
+ * @param[in] pName Name of the group, which need not be defined.
+ * @param[out] pThread The thread, to join as any other.
+ * @param[in] threadFunction Function the thread runs.
+ * @param[in] pArgument Argument of @p threadFunction.
+ *
+ * @return #ThreadGroupSuccess; #ThreadGroupBadParameter if a parameter is
+ * NULL or the name is too long; #ThreadGroupApiError if the thread could
+ * not be created.
+ */
+ThreadGroupStatus_t ThreadGroup_CreateThread( const char * pName,
+                                              pthread_t * pThread,
+                                              void * ( *threadFunction )( void * ),
+                                              void * pArgument );
+
+/**
+ * @brief Move the calling thread onto the CPUs of a group, such as the main
+ * thread running the event loop.
+ *
+ * The threads it then creates with pthread_create inherit these CPUs.
+ *
+ * @param[in] pName Name of the group, which need not be defined.
+ *
+ * @return #ThreadGroupSuccess; #ThreadGroupBadParameter if the name is
+ * invalid; #ThreadGroupApiError if the system refused the CPUs.
+ */
+ThreadGroupStatus_t ThreadGroup_JoinCurrent( const char * pName );
+
+/**
+ * @brief Get the NUMA node of the CPUs of a group.
+ *
+ * @param[in] pName Name of the group.
+ *
+ * @return The node; #THREAD_GROUP_NO_NODE if the group is not defined, its
+ * CPUs span several nodes, or the host does not report its nodes.
+ */
+int32_t ThreadGroup_GetNode( const char * pName );
+
+/**
+ * @brief Allocate a buffer of the threads of a group, such as a network
+ * buffer or a pool, on the NUMA node of the group.
+ *
+ * The buffer is mapped apart, in whole pages, so it suits the few large
+ * buffers a thread sets up at start rather than short-lived blocks. Its
+ * pages are preferably taken from the node of the group when they are
+ * first written, and from another node if it has no free memory.
+ *
+ * @param[in] pName Name of the group, which need not be defined.
+ * @param[in] size Size of the buffer.
+ *
+ * @return The zeroed buffer, page aligned; NULL if there is no memory.
+ */
+void * ThreadGroup_Allocate( const char * pName,
+                             size_t size );
+
+/**
+ * @brief Free a buffer of #ThreadGroup_Allocate.
+ *
+ * @param[in] pBuffer The buffer; NULL does nothing.
+ * @param[in] size Size the buffer was allocated with.
+ */
+void ThreadGroup_Free( void * pBuffer,
+                       size_t size );
+
+/**
+ * @brief Forget the groups and the isolated CPUs.
+ *
+ * For tests only: the threads already placed keep their CPUs.
+ */
+void ThreadGroup_Reset( void );
+
+#endif /* ifndef THREAD_GROUPS_H_ */
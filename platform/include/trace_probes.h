@@ -0,0 +1,88 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file trace_probes.h
+ * @brief Static trace probes at the boundaries of the SDK hot paths.
+ *
+ * The probes mark where time goes when a connection or a transfer is slow:
+ * DNS resolution and TCP connection, the TLS handshake, TLS sends and
+ * receives, the dispatch of incoming PUBLISHes, the writes and signature
+ * check of OTA files, Device Defender reports and HTTP range requests. Most
+ * come in pairs, a start probe and a done probe, so that the time between
+ * them can be measured by the tracer.
+ *
+ * When #TRACE_PROBES is 1, each probe is a USDT probe of the provider csdk,
+ * defined by <sys/sdt.h> of SystemTap. A USDT probe is a single nop
+ * instruction until a tracer such as bpftrace, perf or SystemTap attaches to
+ * it, and its arguments are only read while it is attached. The scripts of
+ * tools/trace use them. Otherwise the probes compile to nothing and their
+ * arguments are not evaluated.
+ */
+
+#ifndef TRACE_PROBES_H_
+#define TRACE_PROBES_H_
+
+/**
+ * @brief Set to 1 to compile the probes as USDT probes. Needs <sys/sdt.h>,
+ * from the systemtap-sdt-dev or systemtap-sdt-devel package.
+ */
+#ifndef TRACE_PROBES
+    #define TRACE_PROBES    ( 0 )
+#endif
+
+#if ( TRACE_PROBES == 1 )
+
+    #include <sys/sdt.h>
+
+/**
+ * @brief A probe without arguments.
+ *
+ * @param[in] name Name of the probe, such as tls_handshake_start.
+ */
+    #define TRACE_PROBE( name )                        DTRACE_PROBE( csdk, name )
+
+/**
+ * @brief A probe with one argument, an integer or a pointer.
+ */
+    #define TRACE_PROBE1( name, arg1 )                 DTRACE_PROBE1( csdk, name, arg1 )
+
+/**
+ * @brief A probe with two arguments.
+ */
+    #define TRACE_PROBE2( name, arg1, arg2 )           DTRACE_PROBE2( csdk, name, arg1, arg2 )
+
+/**
+ * @brief A probe with three arguments.
+ */
+    #define TRACE_PROBE3( name, arg1, arg2, arg3 )     DTRACE_PROBE3( csdk, name, arg1, arg2, arg3 )
+
+#else /* if ( TRACE_PROBES == 1 ) */
+
+    #define TRACE_PROBE( name )
+    #define TRACE_PROBE1( name, arg1 )
+    #define TRACE_PROBE2( name, arg1, arg2 )
+    #define TRACE_PROBE3( name, arg1, arg2, arg3 )
+
+#endif /* if ( TRACE_PROBES == 1 ) */
+
+#endif /* ifndef TRACE_PROBES_H_ */
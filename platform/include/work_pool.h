@@ -0,0 +1,222 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file work_pool.h
+ * @brief Pool of worker threads running short tasks, such as subscription
+ * callbacks and the parsing of JSON payloads, off the event loops.
+ *
+ * Each worker owns a deque of tasks. A task submitted from a worker goes to
+ * the bottom of its deque, from where the worker takes it back, while its
+ * caches are still warm; a task submitted from another thread goes to a
+ * queue shared by the workers. A worker whose deque and the shared queue
+ * are empty steals from the top of the deque of another worker, so that the
+ * tasks of one busy connection spread over the idle workers instead of
+ * waiting behind one another.
+ *
+ * The deques are those of Chase and Lev, with the memory ordering of Le et
+ * al., "Correct and Efficient Work-Stealing for Weak Memory Models": their
+ * owner takes and pushes without locking, and a thief only contends on the
+ * top of the deque it steals from.
+ *
+ * The tasks of a pool run in no particular order. Tasks that must run in
+ * order, such as the callbacks of one subscription, are to be chained by
+ * the caller, each submitting the next one.
+ */
+
+#ifndef WORK_POOL_H_
+#define WORK_POOL_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/**
+ * @brief Maximum number of workers of a pool.
+ */
+#ifndef WORK_POOL_MAX_WORKERS
+    #define WORK_POOL_MAX_WORKERS    ( 16U )
+#endif
+
+/**
+ * @brief Number of tasks the deque of a worker holds, a power of two. The
+ * tasks a worker submits once its deque is full go to the shared queue.
+ */
+#ifndef WORK_POOL_DEQUE_LENGTH
+    #define WORK_POOL_DEQUE_LENGTH    ( 256U )
+#endif
+
+/**
+ * @brief Size of a cache line, which separates the ends of a deque so that
+ * a thief does not invalidate the line its owner writes.
+ */
+#ifndef WORK_POOL_CACHE_LINE_SIZE
+    #define WORK_POOL_CACHE_LINE_SIZE    ( 64U )
+#endif
+
+/**
+ * @brief Return codes of the work pool functions.
+ */
+typedef enum WorkPoolStatus
+{
+    WorkPoolSuccess = 0,  /**< @brief Function successfully completed. */
+    WorkPoolBadParameter, /**< @brief At least one parameter was invalid, or the pool is not running. */
+    WorkPoolApiError      /**< @brief A worker could not be created. */
+} WorkPoolStatus_t;
+
+struct WorkPoolTask;
+
+/**
+ * @brief Function of a task, called on a worker.
+ *
+ * The task may be submitted again, or freed, from the function.
+ *
+ * @param[in] pTask The task.
+ */
+typedef void ( * WorkPoolFunction_t )( struct WorkPoolTask * pTask );
+
+/**
+ * @brief A task, whose memory is owned by the caller.
+ *
+ * The application sets #WorkPoolTask_t.function and
+ * #WorkPoolTask_t.pUserContext before #WorkPool_Submit. The task must remain
+ * valid until its function is called, and must not be submitted again
+ * before.
+ */
+typedef struct WorkPoolTask
+{
+    WorkPoolFunction_t function; /**< @brief Function run by a worker. */
+    void * pUserContext;         /**< @brief Application data, such as a copy of a payload. */
+
+    struct WorkPoolTask * pNext; /**< @brief Next task of the shared queue. */
+} WorkPoolTask_t;
+
+/**
+ * @brief The deque of a worker.
+ *
+ * The owner pushes and takes at #WorkPoolDeque_t.bottom, the thieves take at
+ * #WorkPoolDeque_t.top, each on a cache line of its own.
+ */
+typedef struct WorkPoolDeque
+{
+    int64_t top __attribute__( ( aligned( WORK_POOL_CACHE_LINE_SIZE ) ) );    /**< @brief Index of the oldest task, advanced by the thieves and for the last task by the owner. */
+    int64_t bottom __attribute__( ( aligned( WORK_POOL_CACHE_LINE_SIZE ) ) ); /**< @brief Index after the newest task, only written by the owner. */
+    WorkPoolTask_t * slots[ WORK_POOL_DEQUE_LENGTH ];                        /**< @brief The tasks, at their index modulo the length. */
+} WorkPoolDeque_t;
+
+/**
+ * @brief A worker of a pool.
+ */
+typedef struct WorkPoolWorker
+{
+    WorkPoolDeque_t deque;   /**< @brief Tasks submitted by the worker. */
+    struct WorkPool * pPool; /**< @brief The pool of the worker. */
+    pthread_t thread;        /**< @brief Thread of the worker. */
+    uint32_t randomState;    /**< @brief State of the choice of the workers to steal from. */
+    uint64_t executedCount;  /**< @brief Tasks run by the worker. */
+    uint64_t stolenCount;    /**< @brief Tasks the worker stole from another. */
+} WorkPoolWorker_t;
+
+/**
+ * @brief A pool of workers.
+ *
+ * The members are managed by the work pool functions.
+ */
+typedef struct WorkPool
+{
+    WorkPoolWorker_t workers[ WORK_POOL_MAX_WORKERS ]; /**< @brief The workers. */
+    uint32_t workerCount;                              /**< @brief Number of #WorkPool_t.workers running. */
+    pthread_mutex_t mutex;                             /**< @brief Guards the shared queue and the sleep of the workers. */
+    pthread_cond_t condition;                          /**< @brief Wakes up the sleeping workers. */
+    WorkPoolTask_t * pQueueHead;                       /**< @brief Oldest task of the shared queue. */
+    WorkPoolTask_t * pQueueTail;                       /**< @brief Newest task of the shared queue. */
+    uint32_t pendingCount;                             /**< @brief Tasks submitted and not yet taken by a worker. */
+    uint32_t sleepingCount;                            /**< @brief Workers waiting on #WorkPool_t.condition. */
+    bool running;                                      /**< @brief Whether tasks may be submitted. */
+} WorkPool_t;
+
+/**
+ * @brief Counters of a pool.
+ */
+typedef struct WorkPoolStats
+{
+    uint64_t executedCount; /**< @brief Tasks run. */
+    uint64_t stolenCount;   /**< @brief Tasks a worker stole from another. */
+} WorkPoolStats_t;
+
+/**
+ * @brief Start the workers of a pool.
+ *
+ * @param[out] pPool The pool.
+ * @param[in] workerCount Number of workers, from 1 to #WORK_POOL_MAX_WORKERS.
+ * @param[in] pGroupName Thread group of the workers, as in thread_groups.h.
+ *
+ * @return #WorkPoolSuccess; #WorkPoolBadParameter if a parameter is invalid;
+ * #WorkPoolApiError if a worker could not be created, in which case none
+ * runs.
+ */
+WorkPoolStatus_t WorkPool_Start( WorkPool_t * pPool,
+                                 uint32_t workerCount,
+                                 const char * pGroupName );
+
+/**
+ * @brief Submit a task to the workers of a pool.
+ *
+ * This may be called from any thread, including from a task.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pTask The task, whose #WorkPoolTask_t.function is set.
+ *
+ * @return #WorkPoolSuccess; #WorkPoolBadParameter if a parameter is NULL or
+ * the pool is not running.
+ */
+WorkPoolStatus_t WorkPool_Submit( WorkPool_t * pPool,
+                                  WorkPoolTask_t * pTask );
+
+/**
+ * @brief Stop the workers of a pool, once they have run the tasks already
+ * submitted.
+ *
+ * Tasks may still be submitted by the tasks running, but not by other
+ * threads. Not to be called from a task.
+ *
+ * @param[in] pPool The pool.
+ */
+void WorkPool_Stop( WorkPool_t * pPool );
+
+/**
+ * @brief Get the counters of a pool, summed over its workers, also once it
+ * is stopped.
+ *
+ * @param[in] pPool The pool.
+ * @param[out] pStats The counters.
+ *
+ * @return #WorkPoolSuccess; #WorkPoolBadParameter if a parameter is NULL.
+ */
+WorkPoolStatus_t WorkPool_GetStats( const WorkPool_t * pPool,
+                                    WorkPoolStats_t * pStats );
+
+#endif /* ifndef WORK_POOL_H_ */
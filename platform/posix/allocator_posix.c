@@ -0,0 +1,627 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file allocator_posix.c
+ * @brief Implementation of the allocator of allocator.h for POSIX systems.
+ *
+ * The counters of the subsystems are updated with relaxed atomics, so that
+ * counting never takes a lock; only the pools serialize their allocations.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Allocator include. */
+#include "allocator.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Header at the start of each block of the allocator.
+ *
+ * It takes #ALLOCATOR_ALIGNMENT bytes, so that the memory handed out keeps
+ * the alignment of the block.
+ */
+typedef struct AllocatorHeader
+{
+    size_t size;        /**< @brief Size of the block, header included. */
+    uint32_t subsystem; /**< @brief Subsystem the block is counted for. */
+} AllocatorHeader_t;
+
+/**
+ * @brief Fails to compile if #AllocatorHeader_t does not fit in
+ * #ALLOCATOR_ALIGNMENT bytes.
+ */
+typedef char AllocatorHeaderFits_t[ ( sizeof( AllocatorHeader_t ) <= ALLOCATOR_ALIGNMENT ) ? 1 : -1 ];
+
+/*-----------------------------------------------------------*/
+
+#if ( ALLOCATOR_STATIC_POOL_SIZE == 0U )
+
+/**
+ * @brief Allocate a block with malloc, as #AllocatorBackend_t.allocate.
+ *
+ * @param[in] pContext Unused.
+ * @param[in] size Size of the block.
+ *
+ * @return The block; NULL if there is no memory.
+ */
+    static void * mallocAllocate( void * pContext,
+                                  size_t size );
+
+/**
+ * @brief Free a block of #mallocAllocate, as #AllocatorBackend_t.release.
+ *
+ * @param[in] pContext Unused.
+ * @param[in] pBlock The block.
+ * @param[in] size Unused.
+ */
+    static void mallocRelease( void * pContext,
+                               void * pBlock,
+                               size_t size );
+
+#endif /* if ( ALLOCATOR_STATIC_POOL_SIZE == 0U ) */
+
+/**
+ * @brief Count a block allocated for a subsystem.
+ *
+ * @param[in,out] pStats The counters of the subsystem, or the totals.
+ * @param[in] size Size of the block.
+ */
+static void countAllocation( AllocatorStats_t * pStats,
+                             size_t size );
+
+/**
+ * @brief Count a block freed by a subsystem.
+ *
+ * @param[in,out] pStats The counters of the subsystem, or the totals.
+ * @param[in] size Size of the block.
+ */
+static void countRelease( AllocatorStats_t * pStats,
+                          size_t size );
+
+/**
+ * @brief Read counters updated by other threads.
+ *
+ * @param[in] pStats The counters.
+ * @param[out] pCopy The values read.
+ */
+static void loadStats( const AllocatorStats_t * pStats,
+                       AllocatorStats_t * pCopy );
+
+/**
+ * @brief Get the class of the blocks of a pool fitting a size.
+ *
+ * @param[in] size Size of the block.
+ *
+ * @return The class; #ALLOCATOR_POOL_CLASS_COUNT if the size is larger than
+ * the largest block.
+ */
+static uint32_t getPoolClass( size_t size );
+
+/*-----------------------------------------------------------*/
+
+#if ( ALLOCATOR_STATIC_POOL_SIZE > 0U )
+
+/**
+ * @brief Buffer of the default pool.
+ */
+    static uint8_t staticPoolBuffer[ ALLOCATOR_STATIC_POOL_SIZE ] __attribute__( ( aligned( ALLOCATOR_ALIGNMENT ) ) );
+
+/**
+ * @brief The default pool.
+ */
+    static AllocatorPool_t staticPool =
+    {
+        staticPoolBuffer,
+        ALLOCATOR_STATIC_POOL_SIZE & ~( ( size_t ) ALLOCATOR_ALIGNMENT - 1U ),
+        0U,
+        { NULL },
+        PTHREAD_MUTEX_INITIALIZER
+    };
+
+/**
+ * @brief The default backend, taking the blocks from #staticPool.
+ */
+    static const AllocatorBackend_t defaultBackend =
+    {
+        AllocatorPool_Allocate,
+        AllocatorPool_Release,
+        &staticPool
+    };
+#else /* if ( ALLOCATOR_STATIC_POOL_SIZE > 0U ) */
+
+/**
+ * @brief The default backend, taking the blocks from malloc.
+ */
+    static const AllocatorBackend_t defaultBackend =
+    {
+        mallocAllocate,
+        mallocRelease,
+        NULL
+    };
+#endif /* if ( ALLOCATOR_STATIC_POOL_SIZE > 0U ) */
+
+/**
+ * @brief The backend the blocks are taken from.
+ */
+static AllocatorBackend_t currentBackend =
+{
+    #if ( ALLOCATOR_STATIC_POOL_SIZE > 0U )
+        AllocatorPool_Allocate,
+        AllocatorPool_Release,
+        &staticPool
+    #else
+        mallocAllocate,
+        mallocRelease,
+        NULL
+    #endif
+};
+
+/**
+ * @brief Serializes the changes of #currentBackend.
+ */
+static pthread_mutex_t backendMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Counters of each subsystem.
+ */
+static AllocatorStats_t subsystemStats[ ALLOCATOR_SUBSYSTEM_COUNT ];
+
+/**
+ * @brief Counters of all the subsystems.
+ */
+static AllocatorStats_t totalStats;
+
+/**
+ * @brief Names of the subsystems, by #AllocatorSubsystem_t.
+ */
+static const char * const subsystemNames[ ALLOCATOR_SUBSYSTEM_COUNT ] =
+{
+    "other",
+    "transport",
+    "openssl",
+    "mqtt",
+    "demo"
+};
+
+/*-----------------------------------------------------------*/
+
+#if ( ALLOCATOR_STATIC_POOL_SIZE == 0U )
+
+    static void * mallocAllocate( void * pContext,
+                                  size_t size )
+    {
+        ( void ) pContext;
+
+        /* malloc aligns its blocks for any type, which is 16 bytes on the
+         * 64-bit targets of the SDK. */
+        return malloc( size );
+    }
+/*-----------------------------------------------------------*/
+
+    static void mallocRelease( void * pContext,
+                               void * pBlock,
+                               size_t size )
+    {
+        ( void ) pContext;
+        ( void ) size;
+
+        free( pBlock );
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( ALLOCATOR_STATIC_POOL_SIZE == 0U ) */
+
+static void countAllocation( AllocatorStats_t * pStats,
+                             size_t size )
+{
+    uint64_t current = __atomic_add_fetch( &pStats->currentBytes, ( uint64_t ) size, __ATOMIC_RELAXED );
+    uint64_t peak = __atomic_load_n( &pStats->peakBytes, __ATOMIC_RELAXED );
+
+    ( void ) __atomic_add_fetch( &pStats->blocks, 1U, __ATOMIC_RELAXED );
+    ( void ) __atomic_add_fetch( &pStats->allocations, 1U, __ATOMIC_RELAXED );
+
+    /* A failed exchange reloads the peak another thread raised. */
+    while( ( current > peak ) &&
+           ( __atomic_compare_exchange_n( &pStats->peakBytes, &peak, current, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED ) == false ) )
+    {
+        /* Retry with the peak reloaded. */
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void countRelease( AllocatorStats_t * pStats,
+                          size_t size )
+{
+    ( void ) __atomic_sub_fetch( &pStats->currentBytes, ( uint64_t ) size, __ATOMIC_RELAXED );
+    ( void ) __atomic_sub_fetch( &pStats->blocks, 1U, __ATOMIC_RELAXED );
+}
+/*-----------------------------------------------------------*/
+
+static void loadStats( const AllocatorStats_t * pStats,
+                       AllocatorStats_t * pCopy )
+{
+    pCopy->currentBytes = __atomic_load_n( &pStats->currentBytes, __ATOMIC_RELAXED );
+    pCopy->peakBytes = __atomic_load_n( &pStats->peakBytes, __ATOMIC_RELAXED );
+    pCopy->blocks = __atomic_load_n( &pStats->blocks, __ATOMIC_RELAXED );
+    pCopy->allocations = __atomic_load_n( &pStats->allocations, __ATOMIC_RELAXED );
+    pCopy->failures = __atomic_load_n( &pStats->failures, __ATOMIC_RELAXED );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t getPoolClass( size_t size )
+{
+    uint32_t poolClass = 0U;
+    size_t classSize = ALLOCATOR_POOL_MIN_BLOCK_SIZE;
+
+    while( ( poolClass < ALLOCATOR_POOL_CLASS_COUNT ) && ( classSize < size ) )
+    {
+        poolClass++;
+        classSize <<= 1U;
+    }
+
+    return poolClass;
+}
+/*-----------------------------------------------------------*/
+
+void * Allocator_Malloc( AllocatorSubsystem_t subsystem,
+                         size_t size )
+{
+    AllocatorHeader_t * pHeader = NULL;
+    uint8_t * pBlock = NULL;
+    size_t blockSize = size + ALLOCATOR_ALIGNMENT;
+    uint32_t index = ( uint32_t ) subsystem;
+
+    if( index >= ( uint32_t ) ALLOCATOR_SUBSYSTEM_COUNT )
+    {
+        index = ( uint32_t ) ALLOCATOR_SUBSYSTEM_OTHER;
+    }
+
+    /* The header must not wrap the size around. */
+    if( blockSize > size )
+    {
+        pHeader = ( AllocatorHeader_t * ) currentBackend.allocate( currentBackend.pContext, blockSize );
+    }
+
+    if( pHeader == NULL )
+    {
+        ( void ) __atomic_add_fetch( &subsystemStats[ index ].failures, 1U, __ATOMIC_RELAXED );
+        ( void ) __atomic_add_fetch( &totalStats.failures, 1U, __ATOMIC_RELAXED );
+    }
+    else
+    {
+        pHeader->size = blockSize;
+        pHeader->subsystem = index;
+        countAllocation( &subsystemStats[ index ], blockSize );
+        countAllocation( &totalStats, blockSize );
+        pBlock = &( ( uint8_t * ) pHeader )[ ALLOCATOR_ALIGNMENT ];
+    }
+
+    return pBlock;
+}
+/*-----------------------------------------------------------*/
+
+void * Allocator_Calloc( AllocatorSubsystem_t subsystem,
+                         size_t count,
+                         size_t size )
+{
+    void * pBlock = NULL;
+    size_t arraySize = ( size_t ) -1;
+
+    /* An array whose size overflows gets the largest size, which fails
+     * and is counted as a failure. */
+    if( ( count == 0U ) || ( size <= ( ( ( size_t ) -1 ) / count ) ) )
+    {
+        arraySize = count * size;
+    }
+
+    pBlock = Allocator_Malloc( subsystem, arraySize );
+
+    if( pBlock != NULL )
+    {
+        ( void ) memset( pBlock, 0, arraySize );
+    }
+
+    return pBlock;
+}
+/*-----------------------------------------------------------*/
+
+void * Allocator_Realloc( AllocatorSubsystem_t subsystem,
+                          void * pBlock,
+                          size_t size )
+{
+    void * pNewBlock = NULL;
+    const AllocatorHeader_t * pHeader = NULL;
+    size_t oldSize = 0U;
+
+    if( pBlock == NULL )
+    {
+        pNewBlock = Allocator_Malloc( subsystem, size );
+    }
+    else if( size == 0U )
+    {
+        Allocator_Free( pBlock );
+    }
+    else
+    {
+        pHeader = ( const AllocatorHeader_t * ) &( ( uint8_t * ) pBlock )[ -( ( ptrdiff_t ) ALLOCATOR_ALIGNMENT ) ];
+        oldSize = pHeader->size - ALLOCATOR_ALIGNMENT;
+
+        if( size <= oldSize )
+        {
+            /* A block that shrinks keeps its memory, and its count. */
+            pNewBlock = pBlock;
+        }
+        else
+        {
+            pNewBlock = Allocator_Malloc( subsystem, size );
+
+            if( pNewBlock != NULL )
+            {
+                ( void ) memcpy( pNewBlock, pBlock, oldSize );
+                Allocator_Free( pBlock );
+            }
+        }
+    }
+
+    return pNewBlock;
+}
+/*-----------------------------------------------------------*/
+
+char * Allocator_Strndup( AllocatorSubsystem_t subsystem,
+                          const char * pString,
+                          size_t length )
+{
+    char * pCopy = NULL;
+    size_t copyLength = 0U;
+
+    if( pString != NULL )
+    {
+        while( ( copyLength < length ) && ( pString[ copyLength ] != '\0' ) )
+        {
+            copyLength++;
+        }
+
+        pCopy = ( char * ) Allocator_Malloc( subsystem, copyLength + 1U );
+    }
+
+    if( pCopy != NULL )
+    {
+        ( void ) memcpy( pCopy, pString, copyLength );
+        pCopy[ copyLength ] = '\0';
+    }
+
+    return pCopy;
+}
+/*-----------------------------------------------------------*/
+
+void Allocator_Free( void * pBlock )
+{
+    AllocatorHeader_t * pHeader = NULL;
+    size_t blockSize = 0U;
+
+    if( pBlock != NULL )
+    {
+        pHeader = ( AllocatorHeader_t * ) &( ( uint8_t * ) pBlock )[ -( ( ptrdiff_t ) ALLOCATOR_ALIGNMENT ) ];
+        blockSize = pHeader->size;
+        countRelease( &subsystemStats[ pHeader->subsystem ], blockSize );
+        countRelease( &totalStats, blockSize );
+        currentBackend.release( currentBackend.pContext, pHeader, blockSize );
+    }
+}
+/*-----------------------------------------------------------*/
+
+AllocatorStatus_t Allocator_SetBackend( const AllocatorBackend_t * pBackend )
+{
+    AllocatorStatus_t status = AllocatorSuccess;
+
+    if( ( pBackend != NULL ) && ( ( pBackend->allocate == NULL ) || ( pBackend->release == NULL ) ) )
+    {
+        status = AllocatorBadParameter;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &backendMutex );
+
+        /* The blocks in use must go back to the backend they came from. */
+        if( __atomic_load_n( &totalStats.blocks, __ATOMIC_RELAXED ) != 0U )
+        {
+            status = AllocatorBusy;
+        }
+        else if( pBackend == NULL )
+        {
+            currentBackend = defaultBackend;
+        }
+        else
+        {
+            currentBackend = *pBackend;
+        }
+
+        ( void ) pthread_mutex_unlock( &backendMutex );
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+void Allocator_GetStats( AllocatorSubsystem_t subsystem,
+                         AllocatorStats_t * pStats )
+{
+    if( pStats != NULL )
+    {
+        if( ( uint32_t ) subsystem < ( uint32_t ) ALLOCATOR_SUBSYSTEM_COUNT )
+        {
+            loadStats( &subsystemStats[ subsystem ], pStats );
+        }
+        else
+        {
+            ( void ) memset( pStats, 0, sizeof( AllocatorStats_t ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+void Allocator_GetTotalStats( AllocatorStats_t * pStats )
+{
+    if( pStats != NULL )
+    {
+        loadStats( &totalStats, pStats );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void Allocator_ResetPeaks( void )
+{
+    uint32_t index = 0U;
+
+    for( index = 0U; index < ( uint32_t ) ALLOCATOR_SUBSYSTEM_COUNT; index++ )
+    {
+        __atomic_store_n( &subsystemStats[ index ].peakBytes,
+                          __atomic_load_n( &subsystemStats[ index ].currentBytes, __ATOMIC_RELAXED ),
+                          __ATOMIC_RELAXED );
+    }
+
+    __atomic_store_n( &totalStats.peakBytes,
+                      __atomic_load_n( &totalStats.currentBytes, __ATOMIC_RELAXED ),
+                      __ATOMIC_RELAXED );
+}
+/*-----------------------------------------------------------*/
+
+const char * Allocator_SubsystemName( AllocatorSubsystem_t subsystem )
+{
+    const char * pName = "unknown";
+
+    if( ( uint32_t ) subsystem < ( uint32_t ) ALLOCATOR_SUBSYSTEM_COUNT )
+    {
+        pName = subsystemNames[ subsystem ];
+    }
+
+    return pName;
+}
+/*-----------------------------------------------------------*/
+
+AllocatorStatus_t AllocatorPool_Init( AllocatorPool_t * pPool,
+                                      void * pBuffer,
+                                      size_t bufferSize )
+{
+    AllocatorStatus_t status = AllocatorSuccess;
+    size_t padding = 0U;
+
+    if( ( pPool == NULL ) || ( pBuffer == NULL ) )
+    {
+        status = AllocatorBadParameter;
+    }
+    else
+    {
+        padding = ( ALLOCATOR_ALIGNMENT - ( ( uintptr_t ) pBuffer % ALLOCATOR_ALIGNMENT ) ) % ALLOCATOR_ALIGNMENT;
+
+        if( bufferSize < ( padding + ALLOCATOR_POOL_MIN_BLOCK_SIZE ) )
+        {
+            status = AllocatorBadParameter;
+        }
+    }
+
+    if( status == AllocatorSuccess )
+    {
+        ( void ) memset( pPool, 0, sizeof( AllocatorPool_t ) );
+        pPool->pBuffer = &( ( uint8_t * ) pBuffer )[ padding ];
+        pPool->size = ( bufferSize - padding ) & ~( ( size_t ) ALLOCATOR_ALIGNMENT - 1U );
+
+        if( pthread_mutex_init( &pPool->mutex, NULL ) != 0 )
+        {
+            status = AllocatorApiError;
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+void * AllocatorPool_Allocate( void * pPool,
+                               size_t size )
+{
+    AllocatorPool_t * pAllocatorPool = ( AllocatorPool_t * ) pPool;
+    uint32_t poolClass = getPoolClass( size );
+    size_t classSize = 0U;
+    void * pBlock = NULL;
+
+    if( poolClass < ALLOCATOR_POOL_CLASS_COUNT )
+    {
+        classSize = ( size_t ) ALLOCATOR_POOL_MIN_BLOCK_SIZE << poolClass;
+
+        ( void ) pthread_mutex_lock( &pAllocatorPool->mutex );
+
+        if( pAllocatorPool->pFreeLists[ poolClass ] != NULL )
+        {
+            pBlock = pAllocatorPool->pFreeLists[ poolClass ];
+            pAllocatorPool->pFreeLists[ poolClass ] = *( ( void ** ) pBlock );
+        }
+        else if( ( pAllocatorPool->size - pAllocatorPool->used ) >= classSize )
+        {
+            pBlock = &( pAllocatorPool->pBuffer[ pAllocatorPool->used ] );
+            pAllocatorPool->used += classSize;
+        }
+        else
+        {
+            /* The pool is exhausted for this size. */
+        }
+
+        ( void ) pthread_mutex_unlock( &pAllocatorPool->mutex );
+    }
+
+    return pBlock;
+}
+/*-----------------------------------------------------------*/
+
+void AllocatorPool_Release( void * pPool,
+                            void * pBlock,
+                            size_t size )
+{
+    AllocatorPool_t * pAllocatorPool = ( AllocatorPool_t * ) pPool;
+    uint32_t poolClass = getPoolClass( size );
+
+    if( ( pBlock != NULL ) && ( poolClass < ALLOCATOR_POOL_CLASS_COUNT ) )
+    {
+        ( void ) pthread_mutex_lock( &pAllocatorPool->mutex );
+        *( ( void ** ) pBlock ) = pAllocatorPool->pFreeLists[ poolClass ];
+        pAllocatorPool->pFreeLists[ poolClass ] = pBlock;
+        ( void ) pthread_mutex_unlock( &pAllocatorPool->mutex );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void Allocator_Reset( void )
+{
+    ( void ) memset( subsystemStats, 0, sizeof( subsystemStats ) );
+    ( void ) memset( &totalStats, 0, sizeof( totalStats ) );
+    currentBackend = defaultBackend;
+
+    #if ( ALLOCATOR_STATIC_POOL_SIZE > 0U )
+        staticPool.used = 0U;
+        ( void ) memset( staticPool.pFreeLists, 0, sizeof( staticPool.pFreeLists ) );
+    #endif
+}
+/*-----------------------------------------------------------*/
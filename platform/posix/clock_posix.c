@@ -40,6 +40,32 @@
  */
 #define NANOSECONDS_PER_MILLISECOND    ( 1000000L )    /**< @brief Nanoseconds per millisecond. */
 #define MILLISECONDS_PER_SECOND        ( 1000L )       /**< @brief Milliseconds per second. */
+#define NANOSECONDS_PER_SECOND         ( 1000000000L ) /**< @brief Nanoseconds per second. */
+#define NANOSECONDS_PER_MICROSECOND    ( 1000L )       /**< @brief Nanoseconds per microsecond. */
+
+/**
+ * @brief The clock of #Clock_GetTimeNs.
+ *
+ * On Linux, CLOCK_MONOTONIC_RAW is not slewed by NTP, and is read through the
+ * vDSO without a system call, as is CLOCK_MONOTONIC.
+ */
+#ifdef CLOCK_MONOTONIC_RAW
+    #define HIGH_RESOLUTION_CLOCK    CLOCK_MONOTONIC_RAW
+#else
+    #define HIGH_RESOLUTION_CLOCK    CLOCK_MONOTONIC
+#endif
+
+/**
+ * @brief The clock of #Clock_GetCoarseTimeMs.
+ *
+ * On Linux, CLOCK_MONOTONIC_COARSE is the time of the last timer tick, which
+ * is cheaper to read than CLOCK_MONOTONIC.
+ */
+#ifdef CLOCK_MONOTONIC_COARSE
+    #define COARSE_CLOCK    CLOCK_MONOTONIC_COARSE
+#else
+    #define COARSE_CLOCK    CLOCK_MONOTONIC
+#endif
 
 /*-----------------------------------------------------------*/
 
@@ -64,6 +90,41 @@ uint32_t Clock_GetTimeMs( void )
 
 /*-----------------------------------------------------------*/
 
+uint64_t Clock_GetTimeNs( void )
+{
+    struct timespec timeSpec;
+
+    ( void ) clock_gettime( HIGH_RESOLUTION_CLOCK, &timeSpec );
+
+    return ( ( uint64_t ) timeSpec.tv_sec * ( uint64_t ) NANOSECONDS_PER_SECOND )
+           + ( uint64_t ) timeSpec.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetTimeUs( void )
+{
+    return Clock_GetTimeNs() / ( uint64_t ) NANOSECONDS_PER_MICROSECOND;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t Clock_GetCoarseTimeMs( void )
+{
+    int64_t timeMs;
+    struct timespec timeSpec;
+
+    ( void ) clock_gettime( COARSE_CLOCK, &timeSpec );
+
+    timeMs = ( timeSpec.tv_sec * MILLISECONDS_PER_SECOND )
+             + ( timeSpec.tv_nsec / NANOSECONDS_PER_MILLISECOND );
+
+    /* Truncated as in #Clock_GetTimeMs. */
+    return ( uint32_t ) timeMs;
+}
+
+/*-----------------------------------------------------------*/
+
 void Clock_SleepMs( uint32_t sleepTimeMs )
 {
     /* Convert parameter to timespec. */
@@ -0,0 +1,708 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file metrics_export_posix.c
+ * @brief Exporters of the metrics of metrics.h for POSIX systems: the text
+ * format of Prometheus, served over HTTP on the loopback interface, and
+ * StatsD datagrams.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* Metrics include. */
+#include "metrics.h"
+
+/**
+ * @brief Size of the buffer of the Prometheus endpoint.
+ *
+ * It holds the text of all the metrics: a histogram takes a little more
+ * than a kilobyte.
+ */
+#ifndef METRICS_PROMETHEUS_BUFFER_SIZE
+    #define METRICS_PROMETHEUS_BUFFER_SIZE    ( 32768U )
+#endif
+
+/**
+ * @brief Interval at which the Prometheus endpoint checks whether it is
+ * stopped.
+ */
+#ifndef METRICS_SERVER_POLL_MS
+    #define METRICS_SERVER_POLL_MS    ( 250 )
+#endif
+
+/**
+ * @brief Time a client of the Prometheus endpoint has to send its request.
+ */
+#ifndef METRICS_SERVER_TIMEOUT_MS
+    #define METRICS_SERVER_TIMEOUT_MS    ( 1000 )
+#endif
+
+/**
+ * @brief Size of the buffer receiving the request of a client of the
+ * Prometheus endpoint. Longer requests are answered from their beginning.
+ */
+#define METRICS_REQUEST_BUFFER_SIZE    ( 1024U )
+
+/**
+ * @brief Maximum size of a StatsD datagram, to fit in the MTU of an
+ * Ethernet link.
+ */
+#ifndef METRICS_STATSD_PACKET_SIZE
+    #define METRICS_STATSD_PACKET_SIZE    ( 1432U )
+#endif
+
+/**
+ * @brief Maximum length of the prefix of the StatsD names.
+ */
+#define METRICS_STATSD_PREFIX_MAX_LENGTH    ( 64U )
+
+/**
+ * @brief Size of a StatsD line: the prefix, the name, its suffix, the value
+ * and the type.
+ */
+#define METRICS_STATSD_LINE_SIZE            ( METRICS_STATSD_PREFIX_MAX_LENGTH + METRICS_NAME_MAX_LENGTH + 40U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Socket of the Prometheus endpoint; -1 when it does not run.
+ */
+static int serverSocket = -1;
+
+/**
+ * @brief Thread of the Prometheus endpoint.
+ */
+static pthread_t serverThread;
+
+/**
+ * @brief Set to stop the thread of the Prometheus endpoint.
+ */
+static bool serverStopRequested = false;
+
+/**
+ * @brief Serializes the starts and stops of the Prometheus endpoint.
+ */
+static pthread_mutex_t serverMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Value of each counter, and the count of each histogram, at the
+ * previous #Metrics_SendStatsd.
+ */
+static uint64_t statsdLastValues[ METRICS_MAX_COUNT ];
+
+/**
+ * @brief Sum of each histogram at the previous #Metrics_SendStatsd.
+ */
+static uint64_t statsdLastSums[ METRICS_MAX_COUNT ];
+
+/**
+ * @brief Serializes the calls to #Metrics_SendStatsd.
+ */
+static pthread_mutex_t statsdMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append formatted text to a buffer.
+ *
+ * @param[in] pBuffer The buffer.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in,out] pOffset Length of the text in @p pBuffer.
+ * @param[in] pFormat Format of the text.
+ *
+ * @return true if the text fits; false otherwise.
+ */
+static bool appendText( char * pBuffer,
+                        size_t bufferSize,
+                        size_t * pOffset,
+                        const char * pFormat,
+                        ... );
+
+/**
+ * @brief Write a metric in the text format of Prometheus.
+ *
+ * @param[in] pSample The metric.
+ * @param[in] pBuffer The buffer.
+ * @param[in] bufferSize Size of @p pBuffer.
+ * @param[in,out] pOffset Length of the text in @p pBuffer.
+ *
+ * @return true if the text fits; false otherwise.
+ */
+static bool formatPrometheusSample( const MetricsSample_t * pSample,
+                                    char * pBuffer,
+                                    size_t bufferSize,
+                                    size_t * pOffset );
+
+/**
+ * @brief Send all of a buffer on a connected socket.
+ *
+ * @param[in] socketDescriptor The socket.
+ * @param[in] pBuffer The buffer.
+ * @param[in] length Length of @p pBuffer.
+ *
+ * @return true if everything is sent; false otherwise.
+ */
+static bool sendAll( int socketDescriptor,
+                     const char * pBuffer,
+                     size_t length );
+
+/**
+ * @brief Answer the request of a client of the Prometheus endpoint.
+ *
+ * @param[in] clientSocket Socket of the client.
+ * @param[in] pBuffer Buffer for the request and the response.
+ * @param[in] bufferSize Size of @p pBuffer.
+ */
+static void serveClient( int clientSocket,
+                         char * pBuffer,
+                         size_t bufferSize );
+
+/**
+ * @brief Thread function of the Prometheus endpoint.
+ *
+ * @param[in] pArgument Unused.
+ *
+ * @return NULL.
+ */
+static void * serverThreadFunction( void * pArgument );
+
+/**
+ * @brief Send a StatsD datagram.
+ *
+ * @param[in] statsdSocket The UDP socket.
+ * @param[in] pAddress Address of the StatsD server.
+ * @param[in] pPacket The datagram.
+ * @param[in] length Length of @p pPacket.
+ *
+ * @return true if the datagram is sent; false otherwise.
+ */
+static bool sendStatsdPacket( int statsdSocket,
+                              const struct addrinfo * pAddress,
+                              const char * pPacket,
+                              size_t length );
+
+/**
+ * @brief Get the increase of a total since its previous value.
+ *
+ * A total smaller than its previous value was reset, and all of it is the
+ * increase.
+ *
+ * @param[in] value The total.
+ * @param[in,out] pLastValue The previous value, updated to @p value.
+ *
+ * @return The increase.
+ */
+static uint64_t getDelta( uint64_t value,
+                          uint64_t * pLastValue );
+
+/*-----------------------------------------------------------*/
+
+static bool appendText( char * pBuffer,
+                        size_t bufferSize,
+                        size_t * pOffset,
+                        const char * pFormat,
+                        ... )
+{
+    bool fits = false;
+    va_list arguments;
+    int written = 0;
+
+    if( *pOffset < bufferSize )
+    {
+        va_start( arguments, pFormat );
+        written = vsnprintf( &pBuffer[ *pOffset ], bufferSize - *pOffset, pFormat, arguments );
+        va_end( arguments );
+
+        if( ( written >= 0 ) && ( ( size_t ) written < ( bufferSize - *pOffset ) ) )
+        {
+            *pOffset += ( size_t ) written;
+            fits = true;
+        }
+    }
+
+    return fits;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool formatPrometheusSample( const MetricsSample_t * pSample,
+                                    char * pBuffer,
+                                    size_t bufferSize,
+                                    size_t * pOffset )
+{
+    static const char * const typeNames[] = { "counter", "gauge", "histogram" };
+    bool fits = true;
+    uint64_t cumulative = 0U;
+    size_t bucket = 0U;
+
+    if( pSample->pHelp[ 0 ] != '\0' )
+    {
+        fits = appendText( pBuffer, bufferSize, pOffset, "# HELP %s %s\n",
+                           pSample->pName, pSample->pHelp );
+    }
+
+    fits = fits && appendText( pBuffer, bufferSize, pOffset, "# TYPE %s %s\n",
+                               pSample->pName, typeNames[ pSample->type ] );
+
+    if( pSample->type == METRICS_TYPE_COUNTER )
+    {
+        fits = fits && appendText( pBuffer, bufferSize, pOffset, "%s %llu\n",
+                                   pSample->pName, ( unsigned long long ) pSample->counter );
+    }
+    else if( pSample->type == METRICS_TYPE_GAUGE )
+    {
+        fits = fits && appendText( pBuffer, bufferSize, pOffset, "%s %lld\n",
+                                   pSample->pName, ( long long ) pSample->gauge );
+    }
+    else
+    {
+        /* The buckets of Prometheus are cumulative, and bounded by the
+         * largest value of each bucket of the registry. */
+        for( bucket = 0U; ( fits == true ) && ( bucket < ( METRICS_HISTOGRAM_BUCKETS - 1U ) ); bucket++ )
+        {
+            cumulative += pSample->buckets[ bucket ];
+            fits = appendText( pBuffer, bufferSize, pOffset, "%s_bucket{le=\"%llu\"} %llu\n",
+                               pSample->pName,
+                               ( unsigned long long ) ( ( ( uint64_t ) 2U << bucket ) - 1U ),
+                               ( unsigned long long ) cumulative );
+        }
+
+        fits = fits && appendText( pBuffer, bufferSize, pOffset,
+                                   "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %llu\n%s_count %llu\n",
+                                   pSample->pName, ( unsigned long long ) pSample->count,
+                                   pSample->pName, ( unsigned long long ) pSample->sum,
+                                   pSample->pName, ( unsigned long long ) pSample->count );
+    }
+
+    return fits;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendAll( int socketDescriptor,
+                     const char * pBuffer,
+                     size_t length )
+{
+    bool returnStatus = true;
+    size_t sent = 0U;
+    ssize_t bytesSent = 0;
+
+    while( ( returnStatus == true ) && ( sent < length ) )
+    {
+        bytesSent = send( socketDescriptor, &pBuffer[ sent ], length - sent, MSG_NOSIGNAL );
+
+        if( bytesSent > 0 )
+        {
+            sent += ( size_t ) bytesSent;
+        }
+        else if( ( bytesSent < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before any byte was sent. */
+        }
+        else
+        {
+            returnStatus = false;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void serveClient( int clientSocket,
+                         char * pBuffer,
+                         size_t bufferSize )
+{
+    char request[ METRICS_REQUEST_BUFFER_SIZE ];
+    char header[ 128 ];
+    struct timeval timeout;
+    size_t received = 0U;
+    ssize_t bytesReceived = 1;
+    size_t bodyLength = 0U;
+    int headerLength = 0;
+
+    timeout.tv_sec = METRICS_SERVER_TIMEOUT_MS / 1000;
+    timeout.tv_usec = ( METRICS_SERVER_TIMEOUT_MS % 1000 ) * 1000;
+    ( void ) setsockopt( clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+    ( void ) setsockopt( clientSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof( timeout ) );
+
+    /* Read the request up to the blank line ending its header. */
+    request[ 0 ] = '\0';
+
+    while( ( bytesReceived > 0 ) && ( received < ( sizeof( request ) - 1U ) ) &&
+           ( strstr( request, "\r\n\r\n" ) == NULL ) )
+    {
+        bytesReceived = recv( clientSocket, &request[ received ], sizeof( request ) - 1U - received, 0 );
+
+        if( bytesReceived > 0 )
+        {
+            received += ( size_t ) bytesReceived;
+            request[ received ] = '\0';
+        }
+    }
+
+    if( strncmp( request, "GET ", 4U ) != 0 )
+    {
+        headerLength = snprintf( header, sizeof( header ),
+                                 "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n" );
+    }
+    else
+    {
+        bodyLength = Metrics_FormatPrometheus( pBuffer, bufferSize );
+
+        if( bodyLength > 0U )
+        {
+            headerLength = snprintf( header, sizeof( header ),
+                                     "HTTP/1.0 200 OK\r\n"
+                                     "Content-Type: text/plain; version=0.0.4\r\n"
+                                     "Content-Length: %lu\r\n\r\n",
+                                     ( unsigned long ) bodyLength );
+        }
+        else
+        {
+            headerLength = snprintf( header, sizeof( header ),
+                                     "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n" );
+        }
+    }
+
+    if( sendAll( clientSocket, header, ( size_t ) headerLength ) == true )
+    {
+        ( void ) sendAll( clientSocket, pBuffer, bodyLength );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * serverThreadFunction( void * pArgument )
+{
+    char * pBuffer = ( char * ) malloc( METRICS_PROMETHEUS_BUFFER_SIZE );
+    struct pollfd pollDescriptor;
+    int clientSocket = -1;
+
+    ( void ) pArgument;
+
+    pollDescriptor.fd = serverSocket;
+    pollDescriptor.events = POLLIN;
+
+    while( __atomic_load_n( &serverStopRequested, __ATOMIC_ACQUIRE ) == false )
+    {
+        pollDescriptor.revents = 0;
+
+        if( ( poll( &pollDescriptor, 1U, METRICS_SERVER_POLL_MS ) > 0 ) &&
+            ( ( pollDescriptor.revents & POLLIN ) != 0 ) )
+        {
+            clientSocket = accept( serverSocket, NULL, NULL );
+
+            if( clientSocket >= 0 )
+            {
+                /* Without a buffer, every scrape is answered with an error. */
+                serveClient( clientSocket, pBuffer, ( pBuffer != NULL ) ? METRICS_PROMETHEUS_BUFFER_SIZE : 0U );
+                ( void ) close( clientSocket );
+            }
+        }
+    }
+
+    free( pBuffer );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool sendStatsdPacket( int statsdSocket,
+                              const struct addrinfo * pAddress,
+                              const char * pPacket,
+                              size_t length )
+{
+    ssize_t bytesSent = sendto( statsdSocket, pPacket, length, 0,
+                                pAddress->ai_addr, pAddress->ai_addrlen );
+
+    return( ( bytesSent >= 0 ) && ( ( size_t ) bytesSent == length ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t getDelta( uint64_t value,
+                          uint64_t * pLastValue )
+{
+    uint64_t delta = ( value >= *pLastValue ) ? ( value - *pLastValue ) : value;
+
+    *pLastValue = value;
+
+    return delta;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t Metrics_FormatPrometheus( char * pBuffer,
+                                 size_t bufferSize )
+{
+    MetricsSample_t * pSamples = NULL;
+    size_t count = 0U;
+    size_t offset = 0U;
+    size_t i = 0U;
+    bool fits = false;
+
+    if( ( pBuffer != NULL ) && ( bufferSize > 0U ) )
+    {
+        pSamples = ( MetricsSample_t * ) malloc( METRICS_MAX_COUNT * sizeof( MetricsSample_t ) );
+    }
+
+    if( pSamples != NULL )
+    {
+        ( void ) Metrics_Snapshot( pSamples, METRICS_MAX_COUNT, &count );
+        pBuffer[ 0 ] = '\0';
+        fits = true;
+
+        for( i = 0U; ( fits == true ) && ( i < count ); i++ )
+        {
+            fits = formatPrometheusSample( &pSamples[ i ], pBuffer, bufferSize, &offset );
+        }
+
+        free( pSamples );
+    }
+
+    if( fits == false )
+    {
+        offset = 0U;
+    }
+
+    return offset;
+}
+
+/*-----------------------------------------------------------*/
+
+MetricsStatus_t Metrics_StartPrometheusServer( uint16_t port )
+{
+    MetricsStatus_t returnStatus = MetricsSuccess;
+    struct sockaddr_in address;
+    int reuse = 1;
+    int listenSocket = -1;
+
+    ( void ) pthread_mutex_lock( &serverMutex );
+
+    if( serverSocket >= 0 )
+    {
+        returnStatus = MetricsAlreadyStarted;
+    }
+    else
+    {
+        ( void ) memset( &address, 0, sizeof( address ) );
+        address.sin_family = AF_INET;
+        address.sin_port = htons( port );
+        address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+        listenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+
+        if( ( listenSocket < 0 ) ||
+            ( setsockopt( listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof( reuse ) ) != 0 ) ||
+            ( bind( listenSocket, ( const struct sockaddr * ) &address, sizeof( address ) ) != 0 ) ||
+            ( listen( listenSocket, 8 ) != 0 ) )
+        {
+            returnStatus = MetricsNetworkError;
+        }
+    }
+
+    if( returnStatus == MetricsSuccess )
+    {
+        serverSocket = listenSocket;
+        __atomic_store_n( &serverStopRequested, false, __ATOMIC_RELEASE );
+
+        if( pthread_create( &serverThread, NULL, serverThreadFunction, NULL ) != 0 )
+        {
+            serverSocket = -1;
+            returnStatus = MetricsNoMemory;
+        }
+    }
+
+    if( ( returnStatus != MetricsSuccess ) && ( returnStatus != MetricsAlreadyStarted ) &&
+        ( listenSocket >= 0 ) )
+    {
+        ( void ) close( listenSocket );
+    }
+
+    ( void ) pthread_mutex_unlock( &serverMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void Metrics_StopPrometheusServer( void )
+{
+    ( void ) pthread_mutex_lock( &serverMutex );
+
+    if( serverSocket >= 0 )
+    {
+        __atomic_store_n( &serverStopRequested, true, __ATOMIC_RELEASE );
+        ( void ) pthread_join( serverThread, NULL );
+        ( void ) close( serverSocket );
+        serverSocket = -1;
+    }
+
+    ( void ) pthread_mutex_unlock( &serverMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+MetricsStatus_t Metrics_SendStatsd( const char * pHost,
+                                    uint16_t port,
+                                    const char * pPrefix )
+{
+    MetricsStatus_t returnStatus = MetricsSuccess;
+    MetricsSample_t * pSamples = NULL;
+    struct addrinfo hints;
+    struct addrinfo * pAddress = NULL;
+    char portString[ 6 ];
+    char packet[ METRICS_STATSD_PACKET_SIZE ];
+    char line[ METRICS_STATSD_LINE_SIZE ];
+    const char * pNamePrefix = ( pPrefix != NULL ) ? pPrefix : "";
+    size_t packetLength = 0U;
+    size_t lineLength = 0U;
+    size_t count = 0U;
+    size_t i = 0U;
+    int statsdSocket = -1;
+
+    if( ( pHost == NULL ) || ( strlen( pNamePrefix ) > METRICS_STATSD_PREFIX_MAX_LENGTH ) )
+    {
+        returnStatus = MetricsBadParameter;
+    }
+    else
+    {
+        ( void ) memset( &hints, 0, sizeof( hints ) );
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        ( void ) snprintf( portString, sizeof( portString ), "%u", ( unsigned int ) port );
+
+        if( getaddrinfo( pHost, portString, &hints, &pAddress ) != 0 )
+        {
+            pAddress = NULL;
+            returnStatus = MetricsNetworkError;
+        }
+        else
+        {
+            statsdSocket = socket( pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol );
+
+            if( statsdSocket < 0 )
+            {
+                returnStatus = MetricsNetworkError;
+            }
+        }
+    }
+
+    if( returnStatus == MetricsSuccess )
+    {
+        pSamples = ( MetricsSample_t * ) malloc( METRICS_MAX_COUNT * sizeof( MetricsSample_t ) );
+
+        if( pSamples == NULL )
+        {
+            returnStatus = MetricsNoMemory;
+        }
+    }
+
+    if( returnStatus == MetricsSuccess )
+    {
+        ( void ) pthread_mutex_lock( &statsdMutex );
+        ( void ) Metrics_Snapshot( pSamples, METRICS_MAX_COUNT, &count );
+
+        for( i = 0U; i < count; i++ )
+        {
+            line[ 0 ] = '\0';
+            lineLength = 0U;
+
+            if( pSamples[ i ].type == METRICS_TYPE_COUNTER )
+            {
+                ( void ) appendText( line, sizeof( line ), &lineLength, "%s%s:%llu|c\n",
+                                     pNamePrefix, pSamples[ i ].pName,
+                                     ( unsigned long long ) getDelta( pSamples[ i ].counter, &statsdLastValues[ i ] ) );
+            }
+            else if( pSamples[ i ].type == METRICS_TYPE_GAUGE )
+            {
+                /* A negative gauge would be read as a decrement. */
+                ( void ) appendText( line, sizeof( line ), &lineLength, "%s%s:%llu|g\n",
+                                     pNamePrefix, pSamples[ i ].pName,
+                                     ( unsigned long long ) ( ( pSamples[ i ].gauge > 0 ) ? pSamples[ i ].gauge : 0 ) );
+            }
+            else
+            {
+                ( void ) appendText( line, sizeof( line ), &lineLength, "%s%s_count:%llu|c\n%s%s_sum:%llu|c\n",
+                                     pNamePrefix, pSamples[ i ].pName,
+                                     ( unsigned long long ) getDelta( pSamples[ i ].count, &statsdLastValues[ i ] ),
+                                     pNamePrefix, pSamples[ i ].pName,
+                                     ( unsigned long long ) getDelta( pSamples[ i ].sum, &statsdLastSums[ i ] ) );
+            }
+
+            /* A datagram holds whole lines only. */
+            if( ( packetLength + lineLength ) > sizeof( packet ) )
+            {
+                if( sendStatsdPacket( statsdSocket, pAddress, packet, packetLength ) == false )
+                {
+                    returnStatus = MetricsNetworkError;
+                }
+
+                packetLength = 0U;
+            }
+
+            ( void ) memcpy( &packet[ packetLength ], line, lineLength );
+            packetLength += lineLength;
+        }
+
+        if( ( packetLength > 0U ) &&
+            ( sendStatsdPacket( statsdSocket, pAddress, packet, packetLength ) == false ) )
+        {
+            returnStatus = MetricsNetworkError;
+        }
+
+        ( void ) pthread_mutex_unlock( &statsdMutex );
+    }
+
+    free( pSamples );
+
+    if( statsdSocket >= 0 )
+    {
+        ( void ) close( statsdSocket );
+    }
+
+    if( pAddress != NULL )
+    {
+        freeaddrinfo( pAddress );
+    }
+
+    return returnStatus;
+}
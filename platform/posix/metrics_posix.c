@@ -0,0 +1,638 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file metrics_posix.c
+ * @brief Implementation of the registry of metrics.h for POSIX systems.
+ *
+ * Each thread claims a shard of counters and histograms on its first
+ * record, and releases it when it exits, for the next thread to reuse.
+ * Readers walk the list of shards, which only grows, and add up their
+ * values; the values of the threads that exited stay in their shards.
+ */
+
+/* Standard includes. */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Metrics include. */
+#include "metrics.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Values of a histogram recorded by a thread.
+ */
+typedef struct MetricsHistogramShard
+{
+    uint64_t count;                                /**< @brief Number of values. */
+    uint64_t sum;                                  /**< @brief Sum of the values. */
+    uint64_t buckets[ METRICS_HISTOGRAM_BUCKETS ]; /**< @brief Number of values in each bucket. */
+} MetricsHistogramShard_t;
+
+/**
+ * @brief Values recorded by a thread.
+ *
+ * Only the owner of a shard writes into it, and readers load its values
+ * with relaxed atomics.
+ */
+typedef struct MetricsShard
+{
+    uint64_t counters[ METRICS_MAX_COUNT ];                        /**< @brief Totals of the counters, by metric identifier. */
+    MetricsHistogramShard_t histograms[ METRICS_MAX_HISTOGRAMS ];  /**< @brief Histograms, by histogram index. */
+    uint32_t owned;                                                /**< @brief 1 while a thread records into the shard. */
+    struct MetricsShard * pNext;                                   /**< @brief Next shard of the list. */
+} MetricsShard_t;
+
+/**
+ * @brief A metric of the registry.
+ */
+typedef struct MetricsEntry
+{
+    char name[ METRICS_NAME_MAX_LENGTH + 1U ]; /**< @brief Name of the metric. */
+    char help[ METRICS_HELP_MAX_LENGTH + 1U ]; /**< @brief Help text of the metric. */
+    MetricsType_t type;                        /**< @brief Type of the metric. */
+    uint32_t histogramIndex;                   /**< @brief Index of the histogram in the shards; #METRICS_MAX_HISTOGRAMS if not a histogram. */
+    MetricsGaugeCallback_t callback;           /**< @brief Callback of a gauge; NULL if set with #Metrics_Set. */
+    void * pContext;                           /**< @brief Context of #MetricsEntry_t.callback. */
+    int64_t gauge;                             /**< @brief Value of a gauge set with #Metrics_Set. */
+} MetricsEntry_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The metrics registered.
+ */
+static MetricsEntry_t registry[ METRICS_MAX_COUNT ];
+
+/**
+ * @brief Number of metrics registered, published after their entry.
+ */
+static uint32_t registryCount = 0U;
+
+/**
+ * @brief Number of histograms registered.
+ */
+static uint32_t histogramCount = 0U;
+
+/**
+ * @brief Serializes the registrations.
+ */
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The shards of all the threads that ever recorded.
+ */
+static MetricsShard_t * pShardList = NULL;
+
+/**
+ * @brief Shard shared by the threads whose shard could not be allocated.
+ */
+static MetricsShard_t sharedShard;
+
+/**
+ * @brief Shard of the calling thread; NULL until its first record.
+ */
+static __thread MetricsShard_t * pThreadShard = NULL;
+
+/**
+ * @brief Creates #shardKey once.
+ */
+static pthread_once_t shardOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Key releasing the shard of a thread when it exits.
+ */
+static pthread_key_t shardKey;
+
+/**
+ * @brief Whether #shardKey was created.
+ */
+static bool shardKeyCreated = false;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Create #shardKey.
+ */
+static void createShardKey( void );
+
+/**
+ * @brief Release the shard of a thread that exits.
+ *
+ * @param[in] pShard The shard.
+ */
+static void releaseShard( void * pShard );
+
+/**
+ * @brief Claim a shard for the calling thread.
+ *
+ * @return The shard of the thread; #sharedShard if none could be claimed.
+ */
+static MetricsShard_t * claimShard( void );
+
+/**
+ * @brief Get the shard of the calling thread.
+ *
+ * @return The shard of the thread.
+ */
+static MetricsShard_t * getThreadShard( void );
+
+/**
+ * @brief Check the name of a metric against the rules of Prometheus.
+ *
+ * @param[in] pName The name.
+ *
+ * @return true if the name is valid; false otherwise.
+ */
+static bool isValidName( const char * pName );
+
+/**
+ * @brief Add a metric to the registry, or find it registered already.
+ *
+ * @param[in] pName Name of the metric.
+ * @param[in] pHelp Help text of the metric; may be NULL.
+ * @param[in] type Type of the metric.
+ * @param[in] callback Callback of a gauge; NULL otherwise.
+ * @param[in] pContext Context of @p callback.
+ * @param[out] pId Identifier of the metric.
+ *
+ * @return As #Metrics_Register.
+ */
+static MetricsStatus_t registerMetric( const char * pName,
+                                       const char * pHelp,
+                                       MetricsType_t type,
+                                       MetricsGaugeCallback_t callback,
+                                       void * pContext,
+                                       MetricsId_t * pId );
+
+/**
+ * @brief Add the values of a shard to the samples of a snapshot.
+ *
+ * @param[in] pShard The shard.
+ * @param[in,out] pSamples The samples, zeroed before the first shard.
+ * @param[in] count Number of samples.
+ */
+static void mergeShard( const MetricsShard_t * pShard,
+                        MetricsSample_t * pSamples,
+                        size_t count );
+
+/*-----------------------------------------------------------*/
+
+static void createShardKey( void )
+{
+    if( pthread_key_create( &shardKey, releaseShard ) == 0 )
+    {
+        shardKeyCreated = true;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void releaseShard( void * pShard )
+{
+    /* The next owner adds to the values of the thread that exited. */
+    __atomic_store_n( &( ( MetricsShard_t * ) pShard )->owned, 0U, __ATOMIC_RELEASE );
+}
+
+/*-----------------------------------------------------------*/
+
+static MetricsShard_t * claimShard( void )
+{
+    MetricsShard_t * pShard = NULL;
+    MetricsShard_t * pHead = NULL;
+    uint32_t unowned = 0U;
+    bool claimed = false;
+
+    ( void ) pthread_once( &shardOnce, createShardKey );
+
+    if( shardKeyCreated == true )
+    {
+        /* Reuse the shard of a thread that exited. */
+        pShard = __atomic_load_n( &pShardList, __ATOMIC_ACQUIRE );
+
+        while( ( pShard != NULL ) && ( claimed == false ) )
+        {
+            unowned = 0U;
+            claimed = __atomic_compare_exchange_n( &pShard->owned, &unowned, 1U, false,
+                                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED );
+
+            if( claimed == false )
+            {
+                pShard = pShard->pNext;
+            }
+        }
+
+        if( pShard == NULL )
+        {
+            pShard = ( MetricsShard_t * ) calloc( 1U, sizeof( MetricsShard_t ) );
+
+            if( pShard != NULL )
+            {
+                pShard->owned = 1U;
+                pHead = __atomic_load_n( &pShardList, __ATOMIC_RELAXED );
+
+                do
+                {
+                    pShard->pNext = pHead;
+                } while( __atomic_compare_exchange_n( &pShardList, &pHead, pShard, false,
+                                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED ) == false );
+            }
+        }
+
+        if( ( pShard != NULL ) && ( pthread_setspecific( shardKey, pShard ) != 0 ) )
+        {
+            releaseShard( pShard );
+            pShard = NULL;
+        }
+    }
+
+    /* The values of the shared shard are added atomically as well, so that
+     * they are not lost when several threads record into it. */
+    if( pShard == NULL )
+    {
+        pShard = &sharedShard;
+    }
+
+    return pShard;
+}
+
+/*-----------------------------------------------------------*/
+
+static MetricsShard_t * getThreadShard( void )
+{
+    MetricsShard_t * pShard = pThreadShard;
+
+    if( pShard == NULL )
+    {
+        pShard = claimShard();
+        pThreadShard = pShard;
+    }
+
+    return pShard;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isValidName( const char * pName )
+{
+    bool valid = true;
+    size_t i = 0U;
+    char c = '\0';
+
+    for( i = 0U; ( valid == true ) && ( pName[ i ] != '\0' ); i++ )
+    {
+        c = pName[ i ];
+
+        if( ( ( c >= 'a' ) && ( c <= 'z' ) ) || ( ( c >= 'A' ) && ( c <= 'Z' ) ) ||
+            ( c == '_' ) || ( c == ':' ) )
+        {
+            /* Valid anywhere in the name. */
+        }
+        else if( ( c >= '0' ) && ( c <= '9' ) && ( i > 0U ) )
+        {
+            /* Valid after the first character. */
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if( ( i == 0U ) || ( i > METRICS_NAME_MAX_LENGTH ) )
+    {
+        valid = false;
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static MetricsStatus_t registerMetric( const char * pName,
+                                       const char * pHelp,
+                                       MetricsType_t type,
+                                       MetricsGaugeCallback_t callback,
+                                       void * pContext,
+                                       MetricsId_t * pId )
+{
+    MetricsStatus_t returnStatus = MetricsSuccess;
+    MetricsEntry_t * pEntry = NULL;
+    uint32_t count = 0U;
+    uint32_t i = 0U;
+    size_t helpLength = 0U;
+
+    *pId = METRICS_INVALID_ID;
+
+    ( void ) pthread_mutex_lock( &registryMutex );
+
+    count = registryCount;
+
+    for( i = 0U; ( i < count ) && ( *pId == METRICS_INVALID_ID ); i++ )
+    {
+        if( strcmp( registry[ i ].name, pName ) == 0 )
+        {
+            *pId = i;
+        }
+    }
+
+    if( *pId != METRICS_INVALID_ID )
+    {
+        /* A name is registered once; a callback gauge cannot be shared. */
+        if( ( registry[ *pId ].type != type ) || ( callback != NULL ) ||
+            ( registry[ *pId ].callback != NULL ) )
+        {
+            *pId = METRICS_INVALID_ID;
+            returnStatus = MetricsTypeMismatch;
+        }
+    }
+    else if( ( count == METRICS_MAX_COUNT ) ||
+             ( ( type == METRICS_TYPE_HISTOGRAM ) && ( histogramCount == METRICS_MAX_HISTOGRAMS ) ) )
+    {
+        returnStatus = MetricsRegistryFull;
+    }
+    else
+    {
+        pEntry = &registry[ count ];
+        ( void ) memset( pEntry, 0, sizeof( MetricsEntry_t ) );
+        ( void ) strcpy( pEntry->name, pName );
+
+        if( pHelp != NULL )
+        {
+            /* The help text is written on a line of its own by the
+             * exporters, so control characters and the escape character of
+             * Prometheus are replaced. */
+            for( i = 0U; ( pHelp[ i ] != '\0' ) && ( helpLength < METRICS_HELP_MAX_LENGTH ); i++ )
+            {
+                pEntry->help[ helpLength ] = ( ( ( unsigned char ) pHelp[ i ] < 0x20U ) || ( pHelp[ i ] == '\\' ) ) ?
+                                             ' ' : pHelp[ i ];
+                helpLength++;
+            }
+        }
+
+        pEntry->type = type;
+        pEntry->callback = callback;
+        pEntry->pContext = pContext;
+        pEntry->histogramIndex = METRICS_MAX_HISTOGRAMS;
+
+        if( type == METRICS_TYPE_HISTOGRAM )
+        {
+            pEntry->histogramIndex = histogramCount;
+            histogramCount++;
+        }
+
+        *pId = count;
+        __atomic_store_n( &registryCount, count + 1U, __ATOMIC_RELEASE );
+    }
+
+    ( void ) pthread_mutex_unlock( &registryMutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static void mergeShard( const MetricsShard_t * pShard,
+                        MetricsSample_t * pSamples,
+                        size_t count )
+{
+    const MetricsHistogramShard_t * pHistogram = NULL;
+    MetricsSample_t * pSample = NULL;
+    size_t i = 0U;
+    size_t bucket = 0U;
+
+    for( i = 0U; i < count; i++ )
+    {
+        pSample = &pSamples[ i ];
+
+        if( pSample->type == METRICS_TYPE_COUNTER )
+        {
+            pSample->counter += __atomic_load_n( &pShard->counters[ i ], __ATOMIC_RELAXED );
+        }
+        else if( pSample->type == METRICS_TYPE_HISTOGRAM )
+        {
+            pHistogram = &pShard->histograms[ registry[ i ].histogramIndex ];
+            pSample->count += __atomic_load_n( &pHistogram->count, __ATOMIC_RELAXED );
+            pSample->sum += __atomic_load_n( &pHistogram->sum, __ATOMIC_RELAXED );
+
+            for( bucket = 0U; bucket < METRICS_HISTOGRAM_BUCKETS; bucket++ )
+            {
+                pSample->buckets[ bucket ] += __atomic_load_n( &pHistogram->buckets[ bucket ], __ATOMIC_RELAXED );
+            }
+        }
+        else
+        {
+            /* Gauges are not recorded in the shards. */
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+MetricsStatus_t Metrics_Register( const char * pName,
+                                  const char * pHelp,
+                                  MetricsType_t type,
+                                  MetricsId_t * pId )
+{
+    MetricsStatus_t returnStatus = MetricsSuccess;
+
+    if( pId == NULL )
+    {
+        returnStatus = MetricsBadParameter;
+    }
+    else if( ( pName == NULL ) || ( isValidName( pName ) == false ) ||
+             ( ( type != METRICS_TYPE_COUNTER ) && ( type != METRICS_TYPE_GAUGE ) &&
+               ( type != METRICS_TYPE_HISTOGRAM ) ) )
+    {
+        *pId = METRICS_INVALID_ID;
+        returnStatus = MetricsBadParameter;
+    }
+    else
+    {
+        returnStatus = registerMetric( pName, pHelp, type, NULL, NULL, pId );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MetricsStatus_t Metrics_RegisterGaugeCallback( const char * pName,
+                                               const char * pHelp,
+                                               MetricsGaugeCallback_t callback,
+                                               void * pContext,
+                                               MetricsId_t * pId )
+{
+    MetricsStatus_t returnStatus = MetricsSuccess;
+
+    if( pId == NULL )
+    {
+        returnStatus = MetricsBadParameter;
+    }
+    else if( ( pName == NULL ) || ( isValidName( pName ) == false ) || ( callback == NULL ) )
+    {
+        *pId = METRICS_INVALID_ID;
+        returnStatus = MetricsBadParameter;
+    }
+    else
+    {
+        returnStatus = registerMetric( pName, pHelp, METRICS_TYPE_GAUGE, callback, pContext, pId );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void Metrics_Add( MetricsId_t id,
+                  uint64_t value )
+{
+    MetricsShard_t * pShard = NULL;
+
+    if( id < METRICS_MAX_COUNT )
+    {
+        pShard = getThreadShard();
+        ( void ) __atomic_fetch_add( &pShard->counters[ id ], value, __ATOMIC_RELAXED );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Metrics_Set( MetricsId_t id,
+                  int64_t value )
+{
+    if( id < METRICS_MAX_COUNT )
+    {
+        __atomic_store_n( &registry[ id ].gauge, value, __ATOMIC_RELAXED );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void Metrics_Observe( MetricsId_t id,
+                      uint64_t value )
+{
+    MetricsHistogramShard_t * pHistogram = NULL;
+    uint32_t histogramIndex = METRICS_MAX_HISTOGRAMS;
+    size_t bucket = 0U;
+
+    if( id < __atomic_load_n( &registryCount, __ATOMIC_ACQUIRE ) )
+    {
+        histogramIndex = registry[ id ].histogramIndex;
+    }
+
+    if( histogramIndex < METRICS_MAX_HISTOGRAMS )
+    {
+        pHistogram = &( getThreadShard()->histograms[ histogramIndex ] );
+
+        /* The bucket is the index of the highest bit set in the value. */
+        while( ( ( value >> ( bucket + 1U ) ) != 0U ) &&
+               ( bucket < ( METRICS_HISTOGRAM_BUCKETS - 1U ) ) )
+        {
+            bucket++;
+        }
+
+        ( void ) __atomic_fetch_add( &pHistogram->buckets[ bucket ], 1U, __ATOMIC_RELAXED );
+        ( void ) __atomic_fetch_add( &pHistogram->sum, value, __ATOMIC_RELAXED );
+        ( void ) __atomic_fetch_add( &pHistogram->count, 1U, __ATOMIC_RELAXED );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+MetricsStatus_t Metrics_Snapshot( MetricsSample_t * pSamples,
+                                  size_t length,
+                                  size_t * pCount )
+{
+    MetricsStatus_t returnStatus = MetricsSuccess;
+    const MetricsShard_t * pShard = NULL;
+    const MetricsEntry_t * pEntry = NULL;
+    size_t count = 0U;
+    size_t i = 0U;
+
+    if( ( pSamples == NULL ) || ( pCount == NULL ) )
+    {
+        returnStatus = MetricsBadParameter;
+    }
+    else
+    {
+        count = ( size_t ) __atomic_load_n( &registryCount, __ATOMIC_ACQUIRE );
+
+        if( count > length )
+        {
+            count = length;
+            returnStatus = MetricsNoMemory;
+        }
+
+        ( void ) memset( pSamples, 0, count * sizeof( MetricsSample_t ) );
+
+        for( i = 0U; i < count; i++ )
+        {
+            pEntry = &registry[ i ];
+            pSamples[ i ].pName = pEntry->name;
+            pSamples[ i ].pHelp = pEntry->help;
+            pSamples[ i ].type = pEntry->type;
+
+            if( pEntry->callback != NULL )
+            {
+                pSamples[ i ].gauge = pEntry->callback( pEntry->pContext );
+            }
+            else
+            {
+                pSamples[ i ].gauge = __atomic_load_n( &pEntry->gauge, __ATOMIC_RELAXED );
+            }
+        }
+
+        for( pShard = __atomic_load_n( &pShardList, __ATOMIC_ACQUIRE ); pShard != NULL; pShard = pShard->pNext )
+        {
+            mergeShard( pShard, pSamples, count );
+        }
+
+        mergeShard( &sharedShard, pSamples, count );
+        *pCount = count;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void Metrics_Reset( void )
+{
+    MetricsShard_t * pShard = NULL;
+
+    ( void ) pthread_mutex_lock( &registryMutex );
+
+    for( pShard = __atomic_load_n( &pShardList, __ATOMIC_ACQUIRE ); pShard != NULL; pShard = pShard->pNext )
+    {
+        ( void ) memset( pShard->counters, 0, sizeof( pShard->counters ) );
+        ( void ) memset( pShard->histograms, 0, sizeof( pShard->histograms ) );
+    }
+
+    ( void ) memset( &sharedShard, 0, sizeof( sharedShard ) );
+    ( void ) memset( registry, 0, sizeof( registry ) );
+    histogramCount = 0U;
+    __atomic_store_n( &registryCount, 0U, __ATOMIC_RELEASE );
+
+    ( void ) pthread_mutex_unlock( &registryMutex );
+}
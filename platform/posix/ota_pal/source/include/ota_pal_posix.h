@@ -33,6 +33,281 @@
  */
 #define OTA_FILE_PATH_LENGTH_MAX    512
 
+/**
+ * @brief Set to 1 to preallocate the receive file in otaPal_CreateFileForRx()
+ * and write each block with a single pwrite at its offset.
+ *
+ * Blocks then bypass the stdio buffer and need no seek, so blocks that arrive
+ * out of order, or on several threads, are written without a shared file
+ * position. When 0, each block is written with fseek and fwrite.
+ *
+ * This can be set in ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_PWRITE_ENABLED
+    #define OTA_PAL_POSIX_PWRITE_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to compute the SHA-256 digest of the image while its blocks
+ * are written, so that otaPal_CloseFile() only verifies the signature of the
+ * digest instead of reading the whole image back.
+ *
+ * Blocks are hashed in file order. A block written ahead of the next offset
+ * to hash is recorded in a window of #OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS
+ * entries, and read back from the file once the blocks before it arrive. If
+ * the window overflows, the image is read back and hashed at close as when
+ * this is 0.
+ *
+ * Requires #OTA_PAL_POSIX_PWRITE_ENABLED to be 1. This can be set in
+ * ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED
+    #define OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief The number of out-of-order blocks that the streaming digest can
+ * wait for.
+ */
+#ifndef OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS
+    #define OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS    ( 256U )
+#endif
+
+/**
+ * @brief Set to 1 to keep the public key of the signer certificate between
+ * signature checks, so that the certificate is only read and parsed again
+ * when its path, or the modification time or size of the file, changes.
+ *
+ * Call otaPal_FreeSignerKeyCache() to free the key on shutdown. This can be
+ * set in ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED
+    #define OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to accept images compressed with gzip: a receive file that
+ * starts with the gzip magic bytes is decompressed in otaPal_CloseFile(), with
+ * buffers of a fixed size, and the decompressed image replaces it at the
+ * receive file path. The signature is of the decompressed image, which may
+ * itself be a delta image.
+ *
+ * Requires linking with zlib. This can be set in ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_GZIP_ENABLED
+    #define OTA_PAL_POSIX_GZIP_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to accept delta images: a receive file that starts with
+ * #OTA_PAL_POSIX_DELTA_MAGIC is applied to #OTA_PAL_POSIX_DELTA_BASE_IMAGE_PATH
+ * in otaPal_CloseFile(), and the signature is checked on the reconstructed
+ * image, which replaces the delta at the receive file path. Other receive
+ * files are handled as full images.
+ *
+ * A delta is a 16 byte header followed by records; all integers are 32 bit
+ * little endian:
+ * - Header: #OTA_PAL_POSIX_DELTA_MAGIC (8 bytes), the size of the base image,
+ *   and the size of the reconstructed image.
+ * - COPY record: the byte 1, a base image offset and a length. The bytes are
+ *   copied from the base image.
+ * - ADD record: the byte 2, a length, and as many bytes of data. The data is
+ *   copied from the delta.
+ * - END record: the byte 0. It must be the last byte of the delta.
+ *
+ * This can be set in ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_DELTA_ENABLED
+    #define OTA_PAL_POSIX_DELTA_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief The image that deltas are applied to; by default the running
+ * executable.
+ */
+#ifndef OTA_PAL_POSIX_DELTA_BASE_IMAGE_PATH
+    #define OTA_PAL_POSIX_DELTA_BASE_IMAGE_PATH    "/proc/self/exe"
+#endif
+
+/**
+ * @brief The first 8 bytes of a delta image.
+ */
+#define OTA_PAL_POSIX_DELTA_MAGIC    "OTADELTA"
+
+/**
+ * @brief Set to 1 to keep the image state, and the progress of the file being
+ * received, in a state store instead of PlatformImageState.txt.
+ *
+ * The store is a single record with a CRC-32 in PlatformState.bin. It is read
+ * once, and the image state is then served from memory. Each update is
+ * written to a temporary file that is synced and renamed over the store, so
+ * a crash leaves either the previous or the new record.
+ *
+ * Every #OTA_PAL_POSIX_STATE_CHECKPOINT_BLOCKS blocks, the receive file is
+ * synced and the blocks written to it are recorded. If otaPal_CreateFileForRx()
+ * is called again for a file with the same path, size and signature, e.g.
+ * after a restart, the receive file is kept and the recorded blocks are
+ * marked as received in the block bitmap of the OTA agent, so that only the
+ * missing blocks are requested. The last block of the file is always
+ * requested again.
+ *
+ * This can be set in ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_STATE_STORE_ENABLED
+    #define OTA_PAL_POSIX_STATE_STORE_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief The number of blocks written between two checkpoints of the
+ * progress of the receive file.
+ */
+#ifndef OTA_PAL_POSIX_STATE_CHECKPOINT_BLOCKS
+    #define OTA_PAL_POSIX_STATE_CHECKPOINT_BLOCKS    ( 32U )
+#endif
+
+/**
+ * @brief The largest number of blocks of a file whose progress is recorded.
+ * Blocks beyond it are always requested again.
+ */
+#ifndef OTA_PAL_POSIX_STATE_MAX_BLOCKS
+    #define OTA_PAL_POSIX_STATE_MAX_BLOCKS    ( 8192U )
+#endif
+
+/**
+ * @brief Set to 1 to write the blocks on a writer thread, so that the next
+ * block is received while the previous ones are written.
+ *
+ * otaPal_WriteBlock() copies each block into one of
+ * #OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT buffers and returns, waiting only
+ * when all of them are still being written. A block that could not be written
+ * fails the next otaPal_WriteBlock() and otaPal_CloseFile(), which waits for
+ * the buffered blocks to be written before checking the signature.
+ *
+ * Requires #OTA_PAL_POSIX_PWRITE_ENABLED to be 1. This can be set in
+ * ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_WRITE_BEHIND_ENABLED
+    #define OTA_PAL_POSIX_WRITE_BEHIND_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief The number of blocks that can wait for the writer thread.
+ */
+#ifndef OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT
+    #define OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT    ( 2U )
+#endif
+
+/**
+ * @brief The size of each buffer of the writer thread. Larger blocks are
+ * written by otaPal_WriteBlock() itself, once the buffered ones are written.
+ */
+#ifndef OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_SIZE
+    #define OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_SIZE    ( otaconfigFILE_BLOCK_SIZE )
+#endif
+
+/**
+ * @brief Set to 1 to write the receive file with O_DIRECT, so that the image
+ * does not evict other data from the page cache, and otaPal_CloseFile() has
+ * no dirty pages to flush.
+ *
+ * otaPal_WriteBlock() copies each block into one of
+ * #OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT aligned buffers, each staging an
+ * extent of #OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE bytes of the file. An extent
+ * is written once all of its bytes are received. When a block belongs to an
+ * extent that is not staged and all the buffers are in use, the extent with
+ * the lowest offset is written as it is. An extent staged again is first read
+ * back, so that a partially written extent keeps its bytes.
+ *
+ * The state store writes all staged extents at each checkpoint, so
+ * #OTA_PAL_POSIX_STATE_CHECKPOINT_BLOCKS blocks should cover at least one
+ * extent. If the file system does not support O_DIRECT, the blocks are
+ * written through the page cache as when this is 0.
+ *
+ * Requires #OTA_PAL_POSIX_PWRITE_ENABLED to be 1. This can be set in
+ * ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_DIRECT_IO_ENABLED
+    #define OTA_PAL_POSIX_DIRECT_IO_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief The alignment of the offsets, lengths and buffers of O_DIRECT
+ * writes, at least the logical block size of the storage device.
+ */
+#ifndef OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT
+    #define OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT    ( 4096U )
+#endif
+
+/**
+ * @brief The size of each extent written with O_DIRECT, a multiple of
+ * #OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT.
+ */
+#ifndef OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE
+    #define OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE    ( 64U * 1024U )
+#endif
+
+/**
+ * @brief The number of extents staged at the same time, which bounds how far
+ * out of order blocks can arrive before an extent is written partially.
+ */
+#ifndef OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT
+    #define OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT    ( 4U )
+#endif
+
+/**
+ * @brief Set to 1 to write the receive file back to disk while it is
+ * received, so that its dirty pages do not pile up until the kernel flushes
+ * them all at once.
+ *
+ * Each time #OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE bytes have been written
+ * through the page cache, sync_file_range() starts writing back the range of
+ * the file they were written to, and then waits for the previous window to
+ * be on disk. At most two windows of the image are dirty at a time, and the
+ * writes block while the disk is behind. Blocks written with
+ * #OTA_PAL_POSIX_DIRECT_IO_ENABLED do not use the page cache and are not
+ * counted.
+ *
+ * Requires #OTA_PAL_POSIX_PWRITE_ENABLED to be 1. This can be set in
+ * ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_WRITEBACK_ENABLED
+    #define OTA_PAL_POSIX_WRITEBACK_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief The number of bytes written between two write-backs of the receive
+ * file.
+ */
+#ifndef OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE
+    #define OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE    ( 8U * 1024U * 1024U )
+#endif
+
+/**
+ * @brief Set to 1 to provide otaPal_CloseFileAsync(), which verifies the
+ * signature of a file on a pool of worker threads, so that the files of a
+ * bundle are verified in parallel while the next one is received.
+ *
+ * This can be set in ota_config.h.
+ */
+#ifndef OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED
+    #define OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief The number of worker threads verifying files.
+ */
+#ifndef OTA_PAL_POSIX_VERIFY_THREADS
+    #define OTA_PAL_POSIX_VERIFY_THREADS    ( 2U )
+#endif
+
+/**
+ * @brief The number of files that can wait for a worker thread.
+ * otaPal_CloseFileAsync() waits while all of them are waiting.
+ */
+#ifndef OTA_PAL_POSIX_VERIFY_QUEUE_LENGTH
+    #define OTA_PAL_POSIX_VERIFY_QUEUE_LENGTH    ( 4U )
+#endif
+
 /**
  * @brief The OTA platform interface status for generating
  * absolute file path from the incoming relative file path.
@@ -79,6 +354,9 @@ OtaPalStatus_t otaPal_Abort( OtaFileContext_t * const C );
  * The device file path is a required field in the OTA job document, so C->pFilePath is
  * checked for NULL by the OTA agent before this function is called.
  *
+ * @note When #OTA_PAL_POSIX_PWRITE_ENABLED is 1, the space for the whole file is
+ * reserved here, so that no block write runs out of space.
+ *
  * @param[in] C OTA file context information.
  *
  * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
@@ -104,6 +382,11 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C );
  *
  * If the signature verification fails, file close should still be attempted.
  *
+ * @note When #OTA_PAL_POSIX_GZIP_ENABLED is 1 and the file is compressed, it
+ * is decompressed first. When #OTA_PAL_POSIX_DELTA_ENABLED is 1 and the file
+ * is a delta, the delta is applied next. The signature is checked on the
+ * resulting image.
+ *
  * @param[in] C OTA file context information.
  *
  * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
@@ -217,4 +500,61 @@ OtaPalStatus_t otaPal_SetPlatformImageState( OtaFileContext_t * const C,
  */
 OtaPalImageState_t otaPal_GetPlatformImageState( OtaFileContext_t * const C );
 
+#if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+
+/**
+ * @brief Called by a worker thread once the signature of a file passed to
+ * otaPal_CloseFileAsync() is verified and the file is closed.
+ *
+ * @param[in] C The OTA file context passed to otaPal_CloseFileAsync().
+ * @param[in] result The result otaPal_CloseFile() would have returned.
+ * @param[in] pUserContext The context passed to otaPal_CloseFileAsync().
+ */
+    typedef void ( * OtaPalVerifyCallback_t )( OtaFileContext_t * C,
+                                               OtaPalStatus_t result,
+                                               void * pUserContext );
+
+/**
+ * @brief Close a receive file and verify its signature on a worker thread.
+ *
+ * The blocks of the file are written before this returns, and the file is
+ * then owned by the worker threads: C->pFile is set to NULL, and the paths
+ * and signature of the context are copied, so that the context can be used
+ * for the next file. Once the file is verified and closed, as by
+ * otaPal_CloseFile(), @p callback is called on the worker thread. If the
+ * worker threads cannot be started, the file is verified before this
+ * returns.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] callback Called with the result of the verification.
+ * @param[in] pUserContext Passed to @p callback.
+ *
+ * @return OtaPalSuccess if @p callback is called, or OtaPalFileClose if a
+ * parameter is NULL.
+ */
+    OtaPalStatus_t otaPal_CloseFileAsync( OtaFileContext_t * const C,
+                                          OtaPalVerifyCallback_t callback,
+                                          void * pUserContext );
+
+/**
+ * @brief Wait for the files passed to otaPal_CloseFileAsync() to be
+ * verified, and stop the worker threads.
+ *
+ * Call this before activating the new image, or on shutdown. The worker
+ * threads are started again by the next otaPal_CloseFileAsync().
+ */
+    void otaPal_WaitForVerifications( void );
+#endif /* if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+
+/**
+ * @brief Free the cached public key of the signer certificate.
+ *
+ * Call this once no more files are verified, e.g. after the OTA agent has
+ * shut down. A later signature check loads and caches the key again.
+ */
+    void otaPal_FreeSignerKeyCache( void );
+#endif
+
 #endif /* ifndef _OTA_PAL_H_ */
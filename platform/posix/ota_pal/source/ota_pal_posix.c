@@ -24,6 +24,13 @@
 
 /* OTA PAL implementation for POSIX platform. */
 
+/* O_DIRECT, used when OTA_PAL_POSIX_DIRECT_IO_ENABLED is 1, is a GNU
+ * extension. */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,15 +38,25 @@
 #include <assert.h>
 #include <libgen.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include "ota.h"
 #include "ota_pal_posix.h"
 
+/* Trace probes of the file writes and of the signature check. */
+#include "trace_probes.h"
+
 #include <openssl/evp.h>
 #include <openssl/bio.h>
 #include <openssl/x509.h>
 #include <openssl/pem.h>
 
+#if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+    #include <zlib.h>
+#endif
+
 /**
  * @brief Code signing certificate
  *
@@ -86,8 +103,46 @@ static OtaPalMainStatus_t Openssl_DigestVerify( EVP_MD_CTX * pSigContext,
 
 /**
  * @brief Verify the signature of the specified file using OpenSSL.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] pDigest The digest of the file, or NULL to compute it.
+ * @param[in] digestLength The length of @p pDigest.
+ */
+static OtaPalStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C,
+                                                 const uint8_t * pDigest,
+                                                 uint32_t digestLength );
+
+/**
+ * @brief Write the blocks of the receive file that are still queued or
+ * staged, and stop the writers of the file.
+ *
+ * @return false if a block could not be written.
+ */
+static bool stopFileWriters( void );
+
+/**
+ * @brief Check the receive file once its blocks are written, and close it.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ * @param[in] blocksWritten false if a block could not be written.
+ * @param[in] pDigest The digest of the receive file, or NULL to compute it.
+ * @param[in] digestLength The length of @p pDigest.
+ *
+ * @return The result of the check.
+ */
+static OtaPalStatus_t verifyAndCloseFile( OtaFileContext_t * const C,
+                                          bool blocksWritten,
+                                          const uint8_t * pDigest,
+                                          uint32_t digestLength );
+
+/**
+ * @brief Set the image state from the result of the check of a file.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] result The result of verifyAndCloseFile().
  */
-static OtaPalStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C );
+static void setImageStateFromResult( OtaFileContext_t * const C,
+                                     OtaPalStatus_t result );
 
 /**
  * @brief Get the absolute file path from the environment.
@@ -98,271 +153,3143 @@ static OtaPalStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C );
 static OtaPalPathGenStatus_t getFilePathFromCWD( char * realFilePath,
                                                  const char * pFilePath );
 
-/*-----------------------------------------------------------*/
+/**
+ * @brief Write a block to the receive file, and pass it to the streaming
+ * digest and the state store once it is written.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] ulOffset Byte offset to write to from the beginning of the file.
+ * @param[in] pcData Pointer to the byte array of data to write.
+ * @param[in] ulBlockSize The number of bytes to write.
+ *
+ * @return The number of bytes written, or -1 on an error.
+ */
+static int32_t writeBlockToFile( OtaFileContext_t * const C,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pcData,
+                                 uint32_t ulBlockSize );
 
-static EVP_PKEY * Openssl_GetPkeyFromCertificate( uint8_t * pCertFilePath )
-{
-    BIO * pBio = NULL;
-    X509 * pCert = NULL;
-    EVP_PKEY * pPkey = NULL;
-    int32_t rc = 0;
+#if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
 
-    /* Read the cert file */
-    pBio = BIO_new( BIO_s_file() );
+/**
+ * @brief Reserve the space of the whole receive file, so that writing a block
+ * never runs out of space or has to extend the file.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ *
+ * @return OtaPalSuccess, OtaPalRxFileTooLarge if the file system does not have
+ * space for the file, or OtaPalRxFileCreateFailed on other errors; combined
+ * with the error number.
+ */
+    static OtaPalStatus_t preallocateFile( OtaFileContext_t * const C );
 
-    if( pBio != NULL )
+/**
+ * @brief Write a buffer to a file at an offset with pwrite, continuing after
+ * partial writes.
+ *
+ * @param[in] fileDescriptor The file to write to.
+ * @param[in] pData The data to write.
+ * @param[in] length The number of bytes to write.
+ * @param[in] offset Byte offset to write to from the beginning of the file.
+ *
+ * @return The number of bytes written, or -1 on an error.
+ */
+    static int32_t writeAtOffset( int fileDescriptor,
+                                  const uint8_t * pData,
+                                  size_t length,
+                                  off_t offset );
+#endif /* if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED != 1 )
+        #error "OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED requires OTA_PAL_POSIX_PWRITE_ENABLED to be 1."
+    #endif
+
+/**
+ * @brief A block written beyond the next offset to hash.
+ */
+    typedef struct PendingBlock
     {
-        /* coverity[misra_c_2012_rule_10_1_violation] */
-        rc = BIO_read_filename( pBio, pCertFilePath );
+        uint32_t offset; /**< @brief Byte offset of the block from the beginning of the file. */
+        uint32_t length; /**< @brief Length of the block; 0 if the entry is unused. */
+    } PendingBlock_t;
 
-        if( rc != 1 )
-        {
-            LogDebug( ( " No cert file, reading signer cert from header file\n" ) );
+/**
+ * @brief The digest of a receive file, computed while its blocks are written.
+ */
+    typedef struct StreamingDigest
+    {
+        const FILE * pFile;                                                 /**< @brief The receive file; NULL when no digest is in progress. */
+        EVP_MD_CTX * pDigestContext;                                        /**< @brief SHA-256 context of the bytes before nextOffset. */
+        uint32_t nextOffset;                                                /**< @brief Offset of the first byte that is not hashed yet. */
+        PendingBlock_t pendingBlocks[ OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS ]; /**< @brief Blocks written beyond nextOffset. */
+        uint8_t readBuffer[ OTA_PAL_POSIX_BUF_SIZE ];                       /**< @brief Buffer for reading pending blocks back from the file. */
+    } StreamingDigest_t;
 
-            /* Get the signer cert from a predefined PEM string */
-            BIO_free_all( pBio );
-            pBio = BIO_new( BIO_s_mem() );
+/**
+ * @brief The digest of the receive file currently being written.
+ */
+    static StreamingDigest_t streamingDigest;
 
-            if( pBio != NULL )
-            {
-                rc = BIO_puts( pBio, signingcredentialSIGNING_CERTIFICATE_PEM );
+/**
+ * @brief Mutex protecting #streamingDigest from blocks written on several
+ * threads.
+ */
+    static pthread_mutex_t streamingDigestMutex = PTHREAD_MUTEX_INITIALIZER;
 
-                if( rc <= 0 )
-                {
-                    LogError( ( "Failed to write a PEM string to BIO stream" ) );
-                }
-            }
-            else
-            {
-                LogError( ( "Failed to read certificate from a PEM string." ) );
-            }
-        }
-        else
-        {
-            LogDebug( ( "Opened certificate file." ) );
-        }
-    }
+/**
+ * @brief Start the digest of a receive file that was just created.
+ *
+ * If the digest cannot be started, the file is hashed at close instead.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ */
+    static void startStreamingDigest( const OtaFileContext_t * const C );
 
-    if( ( pBio != NULL ) && ( rc > 0 ) )
+/**
+ * @brief Stop the digest in progress, if any, and free its context.
+ *
+ * The caller must hold #streamingDigestMutex.
+ */
+    static void stopStreamingDigestLocked( void );
+
+/**
+ * @brief Stop the digest of a file, if it is in progress, and free its
+ * context. The digest of another file is left running.
+ *
+ * @param[in] pFile The file whose digest is stopped.
+ */
+    static void stopStreamingDigest( const FILE * pFile );
+
+/**
+ * @brief Add a block that was written to the receive file to the digest.
+ *
+ * A block at the next offset to hash is hashed from @p pData, followed by any
+ * pending blocks it makes contiguous. A block beyond it is recorded as
+ * pending. A block that was hashed already is ignored.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] offset Byte offset of the block from the beginning of the file.
+ * @param[in] pData The data of the block.
+ * @param[in] length The length of the block.
+ */
+    static void updateStreamingDigest( const OtaFileContext_t * const C,
+                                       uint32_t offset,
+                                       const uint8_t * pData,
+                                       uint32_t length );
+
+/**
+ * @brief Hash the pending blocks that start at or before the next offset to
+ * hash, reading them back from the receive file.
+ *
+ * The caller must hold #streamingDigestMutex.
+ *
+ * @param[in] fileDescriptor The receive file.
+ *
+ * @return true on success; false if a block could not be read or hashed.
+ */
+    static bool hashPendingBlocksLocked( int fileDescriptor );
+
+/**
+ * @brief Finish the digest of a receive file and stop it.
+ *
+ * @param[in] C OTA file context information.
+ * @param[out] pDigest Buffer of EVP_MAX_MD_SIZE bytes for the digest.
+ * @param[out] pDigestLength The length of the digest.
+ *
+ * @return true if every byte of the file was hashed; false if the file must be
+ * read back to compute its digest.
+ */
+    static bool finishStreamingDigest( const OtaFileContext_t * const C,
+                                       uint8_t * pDigest,
+                                       uint32_t * pDigestLength );
+
+/**
+ * @brief Verify the signature of a SHA-256 digest with OpenSSL.
+ *
+ * @param[in] pPkey The public key of the signer.
+ * @param[in] pDigest The digest of the file.
+ * @param[in] digestLength The length of the digest.
+ * @param[in] pSignature The signature of the file.
+ *
+ * @return OtaPalSuccess if the signature is valid; OtaPalSignatureCheckFailed
+ * otherwise.
+ */
+    static OtaPalMainStatus_t Openssl_VerifyDigest( EVP_PKEY * pPkey,
+                                                    const uint8_t * pDigest,
+                                                    uint32_t digestLength,
+                                                    const Sig256_t * pSignature );
+#endif /* if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+
+/**
+ * @brief The public key of the last signer certificate that was loaded, with
+ * the state of the certificate file it was loaded from.
+ */
+    typedef struct SignerKeyCache
     {
-        pCert = PEM_read_bio_X509( pBio, NULL, NULL, NULL );
+        EVP_PKEY * pPkey;                               /**< @brief The cached key; NULL when nothing is cached. */
+        char certFilePath[ OTA_FILE_PATH_LENGTH_MAX ];  /**< @brief Path of the certificate the key was loaded from. */
+        bool certFileFound;                             /**< @brief false if the key was loaded from the built-in PEM string. */
+        struct timespec modificationTime;               /**< @brief Modification time of the certificate file. */
+        off_t certFileSize;                             /**< @brief Size of the certificate file. */
+    } SignerKeyCache_t;
 
-        if( pCert != NULL )
-        {
-            LogDebug( ( "Getting the pkey from the X509 cert." ) );
+/**
+ * @brief The cached signer key.
+ */
+    static SignerKeyCache_t signerKeyCache;
 
-            /* Extract the public key */
-            pPkey = X509_get_pubkey( pCert );
+/**
+ * @brief Mutex protecting #signerKeyCache.
+ */
+    static pthread_mutex_t signerKeyCacheMutex = PTHREAD_MUTEX_INITIALIZER;
 
-            if( pPkey == NULL )
-            {
-                LogError( ( "Failed to get pkey from the signer cert." ) );
-            }
-        }
-        else
-        {
-            LogError( ( "Failed to load cert from either file or predefined string." ) );
-        }
-    }
-    else
+/**
+ * @brief Get the public key of a signer certificate, loading it only if the
+ * certificate path, or the modification time or size of the file, differs
+ * from those of the cached key.
+ *
+ * @param[in] pCertFilePath Path of the signer certificate.
+ *
+ * @return A reference to the key that the caller must free with
+ * EVP_PKEY_free, or NULL if the key could not be loaded.
+ */
+    static EVP_PKEY * getCachedSignerKey( uint8_t * pCertFilePath );
+#endif /* if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) || ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+
+/**
+ * @brief A file written next to the receive file, to replace it.
+ */
+    typedef struct ReplacementFile
     {
-        LogError( ( "Failed to read signer cert." ) );
-    }
+        FILE * pFile;                                     /**< @brief The open replacement file. */
+        char receiveFilePath[ OTA_FILE_PATH_LENGTH_MAX ]; /**< @brief Absolute path of the receive file. */
+        char filePath[ OTA_FILE_PATH_LENGTH_MAX ];        /**< @brief Path of the replacement file. */
+    } ReplacementFile_t;
 
-    BIO_free_all( pBio );
-    X509_free( pCert );
+/**
+ * @brief Create a file to replace the receive file with, at the receive file
+ * path followed by a suffix.
+ *
+ * The streaming digest, which is of the receive file, is stopped.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] pSuffix Suffix of the replacement file path.
+ * @param[out] pReplacement The replacement file.
+ *
+ * @return true if the file was created; false otherwise.
+ */
+    static bool openReplacementFile( const OtaFileContext_t * const C,
+                                     const char * pSuffix,
+                                     ReplacementFile_t * pReplacement );
 
-    /* pPkey should be freed by the caller */
-    return pPkey;
-}
+/**
+ * @brief Replace the receive file with a replacement file, which becomes
+ * C->pFile, or remove the replacement file.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] pReplacement The replacement file.
+ * @param[in] complete true if the replacement file was written entirely.
+ *
+ * @return true if the receive file was replaced; false if the replacement
+ * file was removed.
+ */
+    static bool commitReplacementFile( OtaFileContext_t * const C,
+                                       ReplacementFile_t * pReplacement,
+                                       bool complete );
+#endif /* if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) || ( OTA_PAL_POSIX_DELTA_ENABLED == 1 ) */
 
+#if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
 
-static OtaPalMainStatus_t Openssl_DigestVerifyStart( EVP_MD_CTX * pSigContext,
-                                                     EVP_PKEY * pPkey,
-                                                     FILE * pFile,
-                                                     uint8_t ** pBuf )
-{
-    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
+/**
+ * @brief If the receive file is compressed with gzip, replace it with the
+ * decompressed image.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ *
+ * @return OtaPalSuccess if the file is not compressed or was decompressed, or
+ * OtaPalSignatureCheckFailed if it could not be decompressed; combined with
+ * the error number.
+ */
+    static OtaPalStatus_t inflateGzipImage( OtaFileContext_t * const C );
 
-    assert( pBuf != NULL );
-    assert( ( pSigContext != NULL ) && ( pPkey != NULL ) );
+/**
+ * @brief Decompress a gzip stream from one file into another, through
+ * buffers of #OTA_PAL_POSIX_BUF_SIZE bytes.
+ *
+ * @param[in] pCompressed The compressed file, positioned at its start.
+ * @param[in] pOutput The file to write the decompressed data to.
+ *
+ * @return true if the whole stream was decompressed and nothing follows it;
+ * false otherwise.
+ */
+    static bool inflateFile( FILE * pCompressed,
+                             FILE * pOutput );
+#endif /* if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) */
 
-    /* Verify an ECDSA-SHA256 signature. */
-    if( ( pFile != NULL ) &&
-        ( 1 == EVP_DigestVerifyInit( pSigContext, NULL, EVP_sha256(), NULL, pPkey ) ) )
-    {
-        LogDebug( ( "Started signature verification." ) );
+#if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
 
-        *pBuf = OPENSSL_malloc( OTA_PAL_POSIX_BUF_SIZE );
+/**
+ * @brief Size of the header of a delta image.
+ */
+    #define OTA_PAL_POSIX_DELTA_HEADER_SIZE    ( 16U )
 
-        if( *pBuf == NULL )
-        {
-            LogError( ( "Failed to allocate buffer memory." ) );
-            mainErr = OtaPalOutOfMemory;
-        }
-        else
-        {
-            mainErr = OtaPalSuccess;
-        }
-    }
-    else
-    {
-        LogError( ( "File signature check failed at INIT." ) );
-    }
+/**
+ * @brief Record types of a delta image.
+ */
+    #define OTA_PAL_POSIX_DELTA_RECORD_END     ( 0U )
+    #define OTA_PAL_POSIX_DELTA_RECORD_COPY    ( 1U )
+    #define OTA_PAL_POSIX_DELTA_RECORD_ADD     ( 2U )
 
-    return mainErr;
-}
+/**
+ * @brief If the receive file is a delta image, apply it to the base image
+ * and replace the receive file with the reconstructed image.
+ *
+ * On success C->pFile is the reconstructed image, at the receive file path.
+ * On failure the receive file is left as it is.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ *
+ * @return OtaPalSuccess if the file is not a delta or was applied, or
+ * OtaPalSignatureCheckFailed if the delta could not be applied; combined with
+ * the error number.
+ */
+    static OtaPalStatus_t applyDeltaImage( OtaFileContext_t * const C );
 
-static bool Openssl_DigestVerifyUpdate( EVP_MD_CTX * pSigContext,
-                                        FILE * pFile,
-                                        uint8_t * pBuf )
-{
-    size_t bytesRead;
+/**
+ * @brief Apply the records of a delta image.
+ *
+ * @param[in] pDelta The delta, positioned after its header.
+ * @param[in] pBase The base image.
+ * @param[in] pOutput The file to write the reconstructed image to.
+ * @param[in] imageSize The size of the reconstructed image.
+ *
+ * @return true if every record was applied and the image has the expected
+ * size; false otherwise.
+ */
+    static bool applyDeltaRecords( FILE * pDelta,
+                                   FILE * pBase,
+                                   FILE * pOutput,
+                                   uint32_t imageSize );
 
-    do
+/**
+ * @brief Copy bytes from one file to another, from their current positions.
+ *
+ * @param[in] pFrom The file to copy from.
+ * @param[in] pTo The file to copy to.
+ * @param[in] length The number of bytes to copy.
+ *
+ * @return true if all bytes were copied; false otherwise.
+ */
+    static bool copyFileBytes( FILE * pFrom,
+                               FILE * pTo,
+                               uint32_t length );
+
+/**
+ * @brief Decode a 32 bit little endian integer.
+ */
+    static uint32_t readLittleEndian32( const uint8_t * pBytes );
+#endif /* if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+
+/**
+ * @brief Name of the file used for storing the state store record.
+ */
+    #define OTA_PLATFORM_STATE_STORE_FILE    "PlatformState.bin"
+
+/**
+ * @brief Suffix of the temporary file a new record is written to.
+ */
+    #define OTA_PLATFORM_STATE_STORE_TEMP_SUFFIX    ".tmp"
+
+/**
+ * @brief The first field of a record, identifying its layout.
+ */
+    #define OTA_PLATFORM_STATE_STORE_MAGIC    ( 0x4F544131UL )
+
+/**
+ * @brief The record of the state store, as it is stored in
+ * #OTA_PLATFORM_STATE_STORE_FILE.
+ */
+    typedef struct PlatformStateRecord
     {
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        bytesRead = fread( pBuf, 1U, OTA_PAL_POSIX_BUF_SIZE, pFile );
+        uint32_t magic;                                               /**< @brief #OTA_PLATFORM_STATE_STORE_MAGIC. */
+        uint32_t imageState;                                          /**< @brief The OtaImageState_t of the image; OtaImageStateUnknown if none was set. */
+        uint32_t fileSize;                                            /**< @brief Size of the file being received; 0 if none. */
+        uint32_t blockSize;                                           /**< @brief Size of its blocks; 0 until a block that is not the last one is written. */
+        Sig256_t signature;                                           /**< @brief Signature of the file being received. */
+        char filePath[ OTA_FILE_PATH_LENGTH_MAX ];                    /**< @brief Absolute path of the file being received. */
+        uint8_t blocksWritten[ OTA_PAL_POSIX_STATE_MAX_BLOCKS / 8U ]; /**< @brief Bitmap of the blocks written to the file. */
+        uint32_t crc;                                                 /**< @brief CRC-32 of the bytes of the record before this field. */
+    } PlatformStateRecord_t;
+
+/**
+ * @brief The state store, cached in memory.
+ */
+    typedef struct PlatformStateStore
+    {
+        PlatformStateRecord_t record;   /**< @brief The record, as last written or read. */
+        bool loaded;                    /**< @brief true once the record was read from the file. */
+        FILE * pReceiveFile;            /**< @brief The receive file whose blocks are recorded; NULL if none. */
+        uint32_t blocksSinceCheckpoint; /**< @brief Blocks recorded since the record was last written. */
+    } PlatformStateStore_t;
+
+/**
+ * @brief The state store.
+ */
+    static PlatformStateStore_t stateStore;
+
+/**
+ * @brief Mutex protecting #stateStore from blocks written on several threads.
+ */
+    static pthread_mutex_t stateStoreMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Compute the CRC-32 (IEEE 802.3) of a buffer.
+ */
+    static uint32_t computeCrc32( const uint8_t * pData,
+                                  size_t length );
+
+/**
+ * @brief Read the record from the state store file, the first time it is
+ * needed.
+ *
+ * A missing file gives an empty record. A record that cannot be read or has
+ * a bad CRC gives an empty record with the image state aborted.
+ *
+ * The caller must hold #stateStoreMutex.
+ */
+    static void loadStateStoreLocked( void );
+
+/**
+ * @brief Write the record to the state store file.
+ *
+ * The receive file is synced first, so that the record never lists blocks
+ * that are not on disk. The record is written to a temporary file that is
+ * synced and renamed over the store file, and then the directory is synced.
+ *
+ * The caller must hold #stateStoreMutex.
+ *
+ * @return 0 on success; the error number otherwise.
+ */
+    static int32_t saveStateStoreLocked( void );
+
+/**
+ * @brief Set the image state in the state store.
+ *
+ * @param[in] eState The state to set.
+ *
+ * @return 0 on success; the error number otherwise, with the state unchanged.
+ */
+    static int32_t setStoredImageState( OtaImageState_t eState );
+
+/**
+ * @brief Get the image state from the state store.
+ *
+ * @return The image state; OtaImageStateUnknown if none was set.
+ */
+    static OtaImageState_t getStoredImageState( void );
+
+/**
+ * @brief Open a receive file whose progress is recorded in the state store,
+ * and mark its recorded blocks as received for the OTA agent.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] pFilePath Absolute path of the receive file.
+ *
+ * @return true if the receive file was opened as C->pFile; false if it must
+ * be created.
+ */
+    static bool resumeReceiveFile( OtaFileContext_t * const C,
+                                   const char * pFilePath );
+
+/**
+ * @brief Start recording the blocks written to a receive file that was just
+ * created.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ * @param[in] pFilePath Absolute path of the receive file.
+ */
+    static void startFileProgress( const OtaFileContext_t * const C,
+                                   const char * pFilePath );
+
+/**
+ * @brief Record a block written to the receive file, and write the record
+ * every #OTA_PAL_POSIX_STATE_CHECKPOINT_BLOCKS blocks.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] offset Byte offset of the block from the beginning of the file.
+ * @param[in] length The length of the block.
+ */
+    static void recordBlockWritten( const OtaFileContext_t * const C,
+                                    uint32_t offset,
+                                    uint32_t length );
+
+/**
+ * @brief Stop recording the blocks of the receive file, and write the record
+ * without its progress.
+ */
+    static void stopFileProgress( void );
+#endif /* if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED != 1 )
+        #error "OTA_PAL_POSIX_WRITE_BEHIND_ENABLED requires OTA_PAL_POSIX_PWRITE_ENABLED."
+    #endif
+
+/**
+ * @brief A block copied for the writer thread.
+ */
+    typedef struct WriteBehindBlock
+    {
+        uint32_t offset;                                      /**< Byte offset of the block in the file. */
+        uint32_t length;                                      /**< The length of the block. */
+        uint8_t data[ OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_SIZE ]; /**< The bytes of the block. */
+    } WriteBehindBlock_t;
+
+/**
+ * @brief The writer thread of the receive file, and the ring of blocks it
+ * writes in the order they were received.
+ */
+    typedef struct WriteBehind
+    {
+        OtaFileContext_t * pContext;                                   /**< The file written by the thread, NULL when it is not running. */
+        pthread_t thread;                                              /**< The writer thread. */
+        bool stop;                                                     /**< Set to stop the thread once the queued blocks are written. */
+        bool failed;                                                   /**< Set when a queued block could not be written. */
+        size_t head;                                                   /**< Index of the oldest queued block. */
+        size_t count;                                                  /**< Number of queued blocks, including the one being written. */
+        WriteBehindBlock_t blocks[ OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT ]; /**< The block buffers. */
+    } WriteBehind_t;
+
+/**
+ * @brief The writer thread of the receive file.
+ *
+ * The ring is protected by #writeBehindMutex. The thread is started and
+ * stopped by the OTA agent task, which is the only one to call the PAL.
+ */
+    static WriteBehind_t writeBehind;
+
+/**
+ * @brief Mutex protecting the ring of #writeBehind.
+ */
+    static pthread_mutex_t writeBehindMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Signalled when a block is queued, a buffer is freed, or the thread
+ * is asked to stop.
+ */
+    static pthread_cond_t writeBehindCondition = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Start the writer thread of a receive file. The blocks are written by
+ * otaPal_WriteBlock() if the thread cannot be started.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ */
+    static void startWriteBehind( OtaFileContext_t * const C );
+
+/**
+ * @brief Wait for the queued blocks to be written, and stop the writer
+ * thread.
+ *
+ * @return false if a queued block could not be written.
+ */
+    static bool stopWriteBehind( void );
+
+/**
+ * @brief Copy a block into a free buffer of the writer thread, waiting for one
+ * if all are queued.
+ *
+ * A block larger than the buffers is not queued, but only once the writer
+ * thread is idle, so that the caller writes it without racing the thread.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] ulOffset Byte offset of the block from the beginning of the file.
+ * @param[in] pcData Pointer to the block.
+ * @param[in] ulBlockSize The length of the block.
+ * @param[out] pResult The result of otaPal_WriteBlock() if the block was
+ * queued or an earlier block could not be written.
+ *
+ * @return true if pResult is set; false if the caller writes the block.
+ */
+    static bool queueBlock( OtaFileContext_t * const C,
+                            uint32_t ulOffset,
+                            const uint8_t * pcData,
+                            uint32_t ulBlockSize,
+                            int32_t * pResult );
+
+/**
+ * @brief The writer thread, writing the queued blocks until it is stopped.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+    static void * writeBehindThread( void * pArgs );
+#endif /* if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED != 1 )
+        #error "OTA_PAL_POSIX_DIRECT_IO_ENABLED requires OTA_PAL_POSIX_PWRITE_ENABLED."
+    #endif
+
+    #if ( OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE == 0 ) || ( ( OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE % OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT ) != 0 )
+        #error "OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE must be a multiple of OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT."
+    #endif
+
+    #if ( OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT < 1 )
+        #error "OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT must be at least 1."
+    #endif
+
+/**
+ * @brief An extent of the receive file staged in an aligned buffer.
+ */
+    typedef struct StagedExtent
+    {
+        uint32_t offset;   /**< @brief Byte offset of the extent, a multiple of #OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE. */
+        uint32_t received; /**< @brief Bytes of blocks copied into the extent since it was staged. */
+        bool staged;       /**< @brief false if the buffer is free. */
+        uint8_t * pData;   /**< @brief The buffer of #OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE bytes. */
+    } StagedExtent_t;
+
+/**
+ * @brief The O_DIRECT descriptor of the receive file and its staged extents.
+ */
+    typedef struct DirectWriter
+    {
+        const FILE * pFile;                                           /**< @brief The receive file; NULL when it is not written with O_DIRECT. */
+        int fileDescriptor;                                           /**< @brief The receive file opened with O_DIRECT. */
+        uint32_t fileSize;                                            /**< @brief The size of the receive file. */
+        bool failed;                                                  /**< @brief Set when an extent could not be read or written. */
+        uint8_t * pBuffers;                                           /**< @brief The buffers of the extents, from posix_memalign. */
+        StagedExtent_t extents[ OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT ]; /**< @brief The staged extents. */
+    } DirectWriter_t;
+
+/**
+ * @brief The O_DIRECT writer of the receive file.
+ */
+    static DirectWriter_t directWriter;
+
+/**
+ * @brief Mutex protecting #directWriter from blocks written on several
+ * threads.
+ */
+    static pthread_mutex_t directWriterMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Open a receive file with O_DIRECT and allocate the buffers of its
+ * extents. The blocks are written through the page cache if this fails.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ * @param[in] pFilePath Absolute path of the receive file.
+ */
+    static void startDirectWriter( const OtaFileContext_t * const C,
+                                   const char * pFilePath );
+
+/**
+ * @brief Write the staged extents if requested, close the O_DIRECT
+ * descriptor and free the buffers.
+ *
+ * @param[in] flush true to write the staged extents; false to discard them.
+ *
+ * @return false if an extent could not be read or written.
+ */
+    static bool stopDirectWriter( bool flush );
+
+    #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+
+/**
+ * @brief Write all the staged extents, so that every block copied so far is
+ * in the file.
+ *
+ * @return false if an extent could not be read or written.
+ */
+        static bool flushDirectWriter( void );
+    #endif
+
+/**
+ * @brief Write a staged extent and free its buffer.
+ *
+ * The bytes past the end of the file in the last extent are written to keep
+ * the length aligned, and then truncated. The caller must hold
+ * #directWriterMutex.
+ *
+ * @param[in] pExtent The staged extent.
+ *
+ * @return true on success; false if the extent could not be written.
+ */
+    static bool flushExtentLocked( StagedExtent_t * pExtent );
+
+/**
+ * @brief Get the staged extent at an offset, staging it if needed.
+ *
+ * A free buffer is used if there is one; otherwise the extent with the lowest
+ * offset is written first. The extent is read from the file into the buffer,
+ * so that the bytes that no block is copied to keep their value in the file.
+ *
+ * The caller must hold #directWriterMutex.
+ *
+ * @param[in] offset Byte offset of the extent.
+ *
+ * @return The staged extent, or NULL if it could not be staged.
+ */
+    static StagedExtent_t * stageExtentLocked( uint32_t offset );
+
+/**
+ * @brief Copy a block into the staged extents it belongs to, and write the
+ * extents it completes.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] ulOffset Byte offset of the block from the beginning of the file.
+ * @param[in] pcData Pointer to the block.
+ * @param[in] ulBlockSize The length of the block.
+ * @param[out] pResult The number of bytes written, or -1 on an error.
+ *
+ * @return true if pResult is set; false if the receive file is not written
+ * with O_DIRECT and the caller writes the block.
+ */
+    static bool writeStagedBlock( const OtaFileContext_t * const C,
+                                  uint32_t ulOffset,
+                                  const uint8_t * pcData,
+                                  uint32_t ulBlockSize,
+                                  int32_t * pResult );
+
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+
+/**
+ * @brief Read bytes of the receive file, from the staged extents for the
+ * bytes that are not written yet.
+ *
+ * At most the bytes up to the end of the extent of @p offset are read.
+ *
+ * @param[in] fileDescriptor The receive file.
+ * @param[out] pBuffer The buffer to read to.
+ * @param[in] length The number of bytes to read.
+ * @param[in] offset Byte offset to read from.
+ *
+ * @return The number of bytes read, or -1 with errno set on an error.
+ */
+        static ssize_t readReceiveFile( int fileDescriptor,
+                                        uint8_t * pBuffer,
+                                        size_t length,
+                                        uint32_t offset );
+    #endif
+#endif /* if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED != 1 )
+        #error "OTA_PAL_POSIX_WRITEBACK_ENABLED requires OTA_PAL_POSIX_PWRITE_ENABLED."
+    #endif
+
+/**
+ * @brief The write-back of the receive file.
+ */
+    typedef struct WriteBack
+    {
+        const FILE * pFile;    /**< @brief The receive file; NULL when none is written back. */
+        bool failed;           /**< @brief Set when sync_file_range failed, which stops the write-back. */
+        uint32_t windowBytes;  /**< @brief Bytes written since the last write-back started. */
+        uint32_t windowStart;  /**< @brief Lowest offset written since the last write-back started. */
+        uint32_t windowEnd;    /**< @brief End of the highest block written since the last write-back started. */
+        uint32_t pendingStart; /**< @brief Start of the range being written back. */
+        uint32_t pendingEnd;   /**< @brief End of the range being written back; pendingStart if none. */
+    } WriteBack_t;
+
+/**
+ * @brief The write-back of the receive file.
+ */
+    static WriteBack_t writeBack;
+
+/**
+ * @brief Mutex protecting #writeBack from blocks written on several threads.
+ */
+    static pthread_mutex_t writeBackMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Start counting the bytes written to a receive file, or stop if
+ * @p C is NULL.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ */
+    static void startWriteBack( const OtaFileContext_t * const C );
+
+/**
+ * @brief Count a block written through the page cache, and start the
+ * write-back of its window once the window is full.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] offset Byte offset of the block from the beginning of the file.
+ * @param[in] length The length of the block.
+ */
+    static void writeBackBlock( const OtaFileContext_t * const C,
+                                uint32_t offset,
+                                uint32_t length );
+#endif /* if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 ) */
+
+#if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+
+/**
+ * @brief A receive file passed to otaPal_CloseFileAsync(), with copies of
+ * the parts of its context that are checked.
+ */
+    typedef struct VerifyJob
+    {
+        OtaFileContext_t context;                         /**< @brief The context of the file. */
+        bool detached;                                    /**< @brief true if the context is to point to the copies below. */
+        Sig256_t signature;                               /**< @brief Copy of the signature of the file. */
+        uint8_t filePath[ OTA_FILE_PATH_LENGTH_MAX ];     /**< @brief Copy of the path of the file. */
+        uint8_t certFilePath[ OTA_FILE_PATH_LENGTH_MAX ]; /**< @brief Copy of the path of the signer certificate. */
+        bool blocksWritten;                               /**< @brief false if a block could not be written. */
+        uint8_t digest[ EVP_MAX_MD_SIZE ];                /**< @brief The streaming digest of the file. */
+        uint32_t digestLength;                            /**< @brief The length of digest; 0 if the file is hashed when it is checked. */
+        OtaPalVerifyCallback_t callback;                  /**< @brief Called with the result of the check. */
+        void * pUserContext;                              /**< @brief Passed to callback. */
+    } VerifyJob_t;
+
+/**
+ * @brief The worker threads verifying files, and the ring of files waiting
+ * for them.
+ */
+    typedef struct VerifyPool
+    {
+        pthread_t threads[ OTA_PAL_POSIX_VERIFY_THREADS ];  /**< @brief The worker threads. */
+        size_t threadCount;                                 /**< @brief Number of threads started; 0 when they are stopped. */
+        bool stop;                                          /**< @brief Set to stop the threads once the queued files are checked. */
+        bool bundleFailed;                                  /**< @brief Set once a file fails its check, so that a later file does not mark the image for testing. */
+        size_t head;                                        /**< @brief Index of the oldest queued file. */
+        size_t count;                                       /**< @brief Number of queued files. */
+        VerifyJob_t jobs[ OTA_PAL_POSIX_VERIFY_QUEUE_LENGTH ]; /**< @brief The queued files. */
+    } VerifyPool_t;
+
+/**
+ * @brief The worker threads verifying files.
+ *
+ * The pool is protected by #verifyPoolMutex. The threads are started and
+ * stopped by the OTA agent task, which is the only one to call the PAL.
+ */
+    static VerifyPool_t verifyPool;
+
+/**
+ * @brief Mutex protecting #verifyPool and the image state set by the worker
+ * threads.
+ */
+    static pthread_mutex_t verifyPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Signalled when a file is queued or taken by a worker thread, or the
+ * threads are asked to stop.
+ */
+    static pthread_cond_t verifyPoolCondition = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Write the blocks of a receive file, and take the file and a copy of
+ * its context from @p C.
+ *
+ * @param[in] C OTA file context information, with the receive file open.
+ * @param[out] pJob The job verifying the file.
+ *
+ * @return true if the paths and signature of the file were copied; false if
+ * the job is to be run before @p C is changed.
+ */
+    static bool prepareVerifyJob( OtaFileContext_t * const C,
+                                  VerifyJob_t * pJob );
+
+/**
+ * @brief Verify and close the file of a job, set the image state and call
+ * the callback of the job.
+ *
+ * @param[in] pJob The job.
+ */
+    static void runVerifyJob( VerifyJob_t * pJob );
+
+/**
+ * @brief Start the worker threads if they are not running.
+ *
+ * The caller must hold #verifyPoolMutex.
+ *
+ * @return true if at least one worker thread is running.
+ */
+    static bool startVerifyWorkersLocked( void );
+
+/**
+ * @brief A worker thread, verifying the queued files until it is stopped.
+ *
+ * @param[in] pArgs Unused.
+ *
+ * @return NULL.
+ */
+    static void * verifyWorkerThread( void * pArgs );
+#endif /* if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+static EVP_PKEY * Openssl_GetPkeyFromCertificate( uint8_t * pCertFilePath )
+{
+    BIO * pBio = NULL;
+    X509 * pCert = NULL;
+    EVP_PKEY * pPkey = NULL;
+    int32_t rc = 0;
+
+    /* Read the cert file */
+    pBio = BIO_new( BIO_s_file() );
+
+    if( pBio != NULL )
+    {
+        /* coverity[misra_c_2012_rule_10_1_violation] */
+        rc = BIO_read_filename( pBio, pCertFilePath );
+
+        if( rc != 1 )
+        {
+            LogDebug( ( " No cert file, reading signer cert from header file\n" ) );
+
+            /* Get the signer cert from a predefined PEM string */
+            BIO_free_all( pBio );
+            pBio = BIO_new( BIO_s_mem() );
+
+            if( pBio != NULL )
+            {
+                rc = BIO_puts( pBio, signingcredentialSIGNING_CERTIFICATE_PEM );
+
+                if( rc <= 0 )
+                {
+                    LogError( ( "Failed to write a PEM string to BIO stream" ) );
+                }
+            }
+            else
+            {
+                LogError( ( "Failed to read certificate from a PEM string." ) );
+            }
+        }
+        else
+        {
+            LogDebug( ( "Opened certificate file." ) );
+        }
+    }
+
+    if( ( pBio != NULL ) && ( rc > 0 ) )
+    {
+        pCert = PEM_read_bio_X509( pBio, NULL, NULL, NULL );
+
+        if( pCert != NULL )
+        {
+            LogDebug( ( "Getting the pkey from the X509 cert." ) );
+
+            /* Extract the public key */
+            pPkey = X509_get_pubkey( pCert );
+
+            if( pPkey == NULL )
+            {
+                LogError( ( "Failed to get pkey from the signer cert." ) );
+            }
+        }
+        else
+        {
+            LogError( ( "Failed to load cert from either file or predefined string." ) );
+        }
+    }
+    else
+    {
+        LogError( ( "Failed to read signer cert." ) );
+    }
+
+    BIO_free_all( pBio );
+    X509_free( pCert );
+
+    /* pPkey should be freed by the caller */
+    return pPkey;
+}
+
+
+static OtaPalMainStatus_t Openssl_DigestVerifyStart( EVP_MD_CTX * pSigContext,
+                                                     EVP_PKEY * pPkey,
+                                                     FILE * pFile,
+                                                     uint8_t ** pBuf )
+{
+    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
+
+    assert( pBuf != NULL );
+    assert( ( pSigContext != NULL ) && ( pPkey != NULL ) );
+
+    /* Verify an ECDSA-SHA256 signature. */
+    if( ( pFile != NULL ) &&
+        ( 1 == EVP_DigestVerifyInit( pSigContext, NULL, EVP_sha256(), NULL, pPkey ) ) )
+    {
+        LogDebug( ( "Started signature verification." ) );
+
+        *pBuf = OPENSSL_malloc( OTA_PAL_POSIX_BUF_SIZE );
+
+        if( *pBuf == NULL )
+        {
+            LogError( ( "Failed to allocate buffer memory." ) );
+            mainErr = OtaPalOutOfMemory;
+        }
+        else
+        {
+            mainErr = OtaPalSuccess;
+        }
+    }
+    else
+    {
+        LogError( ( "File signature check failed at INIT." ) );
+    }
+
+    return mainErr;
+}
+
+static bool Openssl_DigestVerifyUpdate( EVP_MD_CTX * pSigContext,
+                                        FILE * pFile,
+                                        uint8_t * pBuf )
+{
+    size_t bytesRead;
+
+    do
+    {
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        bytesRead = fread( pBuf, 1U, OTA_PAL_POSIX_BUF_SIZE, pFile );
+
+        assert( bytesRead <= OTA_PAL_POSIX_BUF_SIZE );
+
+        /* feof returns non-zero if end of file is reached, otherwise it returns 0. When
+         * bytesRead is not equal to OTA_PAL_POSIX_BUF_SIZE, we should be reading last
+         * chunk and reach to end of file. */
+
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        if( ( bytesRead < OTA_PAL_POSIX_BUF_SIZE ) && ( 0 == feof( pFile ) ) )
+        {
+            break;
+        }
+
+        /* Include the file chunk in the signature validation. Zero size is OK. */
+        if( 1 != EVP_DigestVerifyUpdate( pSigContext, pBuf, bytesRead ) )
+        {
+            break;
+        }
+    } while( bytesRead > 0UL );
+
+    /* POSIX port using standard library */
+    /* coverity[misra_c_2012_rule_21_6_violation] */
+    return( 0 != feof( pFile ) ? true : false );
+}
+
+static OtaPalMainStatus_t Openssl_DigestVerify( EVP_MD_CTX * pSigContext,
+                                                EVP_PKEY * pPkey,
+                                                FILE * pFile,
+                                                Sig256_t * pSignature )
+{
+    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
+    OtaPalMainStatus_t startErr;
+    uint8_t * pBuf;
+
+    startErr = Openssl_DigestVerifyStart( pSigContext, pPkey, pFile, &pBuf );
+
+    if( OtaPalSuccess == startErr )
+    {
+        /* Rewind the received file to the beginning. */
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        if( fseek( pFile, 0L, SEEK_SET ) == 0 )
+        {
+            bool eof = Openssl_DigestVerifyUpdate( pSigContext, pFile, pBuf );
+
+            if( ( eof == true ) && ( 1 == EVP_DigestVerifyFinal( pSigContext,
+                                                                 pSignature->data,
+                                                                 pSignature->size ) ) )
+            {
+                mainErr = OtaPalSuccess;
+            }
+            else
+            {
+                LogError( ( "File signature check failed at FINAL" ) );
+            }
+        }
+
+        /* Free the temporary file page buffer. */
+        OPENSSL_free( pBuf );
+    }
+    else
+    {
+        mainErr = startErr;
+    }
+
+    return mainErr;
+}
+
+static OtaPalStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C,
+                                                 const uint8_t * pDigest,
+                                                 uint32_t digestLength )
+{
+    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
+    EVP_PKEY * pPkey = NULL;
+    EVP_MD_CTX * pSigContext = NULL;
+
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        uint8_t digest[ EVP_MAX_MD_SIZE ];
+        uint32_t streamedDigestLength = 0U;
+    #else
+        /* A digest is only passed when the streaming digest is enabled. */
+        ( void ) pDigest;
+        ( void ) digestLength;
+    #endif
+
+    assert( C != NULL );
+
+    TRACE_PROBE1( ota_signature_start, C );
+
+    /* Extract the signer cert from the file. */
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        pPkey = getCachedSignerKey( C->pCertFilepath );
+    #else
+        pPkey = Openssl_GetPkeyFromCertificate( C->pCertFilepath );
+    #endif
+
+    /* Create a new signature context for verification purpose. */
+    pSigContext = EVP_MD_CTX_new();
+
+    if( ( pPkey != NULL ) && ( pSigContext != NULL ) )
+    {
+        #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+            if( pDigest != NULL )
+            {
+                /* The digest was finished when the file was passed to a
+                 * worker thread. */
+                mainErr = Openssl_VerifyDigest( pPkey, pDigest, digestLength, C->pSignature );
+            }
+            else if( finishStreamingDigest( C, digest, &streamedDigestLength ) == true )
+            {
+                /* Every block was hashed when it was written, so the file
+                 * is not read again. */
+                mainErr = Openssl_VerifyDigest( pPkey, digest, streamedDigestLength, C->pSignature );
+            }
+            else
+            {
+                /* Verify the signature. */
+                mainErr = Openssl_DigestVerify( pSigContext, pPkey, C->pFile, C->pSignature );
+            }
+        #else
+            /* Verify the signature. */
+            mainErr = Openssl_DigestVerify( pSigContext, pPkey, C->pFile, C->pSignature );
+        #endif
+    }
+    else
+    {
+        if( pSigContext == NULL )
+        {
+            LogError( ( "File signature check failed at NEW sig context." ) );
+        }
+        else
+        {
+            LogError( ( "File signature check failed at EXTRACT pkey from signer certificate." ) );
+            mainErr = OtaPalBadSignerCert;
+        }
+    }
+
+    /* Free up objects */
+    EVP_MD_CTX_free( pSigContext );
+    EVP_PKEY_free( pPkey );
+
+    TRACE_PROBE2( ota_signature_done, C, mainErr );
+
+    return OTA_PAL_COMBINE_ERR( mainErr, 0 );
+}
+
+static OtaPalPathGenStatus_t getFilePathFromCWD( char * pCompleteFilePath,
+                                                 const char * pFileName )
+{
+    char * pCurrentDir = NULL;
+    OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
+
+    /* Get current directory. */
+    pCurrentDir = getcwd( pCompleteFilePath, OTA_FILE_PATH_LENGTH_MAX - 1 );
+
+    if( pCurrentDir == NULL )
+    {
+        LogError( ( "Failed to get current working directory: %s", strerror( errno ) ) );
+        status = OtaPalCWDFailed;
+    }
+    else
+    {
+        /* Add the filename . */
+        if( strlen( pCompleteFilePath ) + strlen( pFileName ) + 2U > OTA_FILE_PATH_LENGTH_MAX )
+        {
+            LogError( ( "Insufficient space to generate file path" ) );
+            status = OtaPalBufferInsufficient;
+        }
+        else
+        {
+            strcat( pCompleteFilePath, "/" );
+            strcat( pCompleteFilePath, pFileName );
+        }
+    }
+
+    return status;
+}
+
+static int32_t writeBlockToFile( OtaFileContext_t * const C,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pcData,
+                                 uint32_t ulBlockSize )
+{
+    int32_t filerc = 0;
+
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 0 )
+        size_t writeSize = 0;
+    #endif
+
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        bool staged = false;
+
+        #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+            /* The block is written with its extent, bypassing the page
+             * cache. */
+            staged = writeStagedBlock( C, ulOffset, pcData, ulBlockSize, &filerc );
+        #endif
+
+        if( staged == false )
+        {
+            /* The block is written to the file descriptor at its offset,
+             * without moving the shared file position. Nothing is buffered
+             * by stdio, so the signature check reads back what was
+             * written. */
+            filerc = writeAtOffset( fileno( C->pFile ),
+                                    pcData,
+                                    ( size_t ) ulBlockSize,
+                                    ( off_t ) ulOffset );
+
+            #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+                if( filerc == ( int32_t ) ulBlockSize )
+                {
+                    writeBackBlock( C, ulOffset, ulBlockSize );
+                }
+            #endif
+        }
+
+        #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+            if( filerc == ( int32_t ) ulBlockSize )
+            {
+                updateStreamingDigest( C, ulOffset, pcData, ulBlockSize );
+            }
+        #endif
+    #else
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        filerc = fseek( C->pFile, ( int64_t ) ulOffset, SEEK_SET );
+
+        if( 0 == filerc )
+        {
+            /* POSIX port using standard library */
+            /* coverity[misra_c_2012_rule_21_6_violation] */
+            writeSize = fwrite( pcData, 1, ulBlockSize, C->pFile );
+
+            if( writeSize != ulBlockSize )
+            {
+                LogError( ( "Failed to write block to file: "
+                            "fwrite returned error: "
+                            "errno=%d", errno ) );
+
+                filerc = -1;
+            }
+            else
+            {
+                filerc = ( int32_t ) writeSize;
+            }
+        }
+        else
+        {
+            LogError( ( "fseek failed. fseek returned errno = %d", errno ) );
+            filerc = -1;
+        }
+    #endif /* if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 ) */
+
+    #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+        if( filerc == ( int32_t ) ulBlockSize )
+        {
+            recordBlockWritten( C, ulOffset, ulBlockSize );
+        }
+    #endif
+
+    return filerc;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+
+    static OtaPalStatus_t preallocateFile( OtaFileContext_t * const C )
+    {
+        OtaPalStatus_t result = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+        int allocateResult = 0;
+
+        /* posix_fallocate rejects an empty range. */
+        if( C->fileSize > 0U )
+        {
+            /* posix_fallocate returns the error number instead of setting
+             * errno. */
+            allocateResult = posix_fallocate( fileno( C->pFile ), 0, ( off_t ) C->fileSize );
+        }
+
+        if( allocateResult == ENOSPC )
+        {
+            LogError( ( "Not enough space for a receive file of %u bytes.",
+                        ( unsigned int ) C->fileSize ) );
+            result = OTA_PAL_COMBINE_ERR( OtaPalRxFileTooLarge, allocateResult );
+        }
+        else if( allocateResult != 0 )
+        {
+            LogError( ( "Failed to allocate the receive file: "
+                        "posix_fallocate returned error: "
+                        "errno=%d", allocateResult ) );
+            result = OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, allocateResult );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        return result;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static int32_t writeAtOffset( int fileDescriptor,
+                                  const uint8_t * pData,
+                                  size_t length,
+                                  off_t offset )
+    {
+        int32_t returnValue = 0;
+        size_t bytesWritten = 0U;
+        ssize_t writeResult = 0;
+
+        while( ( returnValue == 0 ) && ( bytesWritten < length ) )
+        {
+            writeResult = pwrite( fileDescriptor,
+                                  &pData[ bytesWritten ],
+                                  length - bytesWritten,
+                                  offset + ( off_t ) bytesWritten );
+
+            if( writeResult > 0 )
+            {
+                bytesWritten += ( size_t ) writeResult;
+            }
+            else if( ( writeResult < 0 ) && ( errno == EINTR ) )
+            {
+                /* Interrupted before anything was written; write again. */
+            }
+            else
+            {
+                LogError( ( "Failed to write block to file: "
+                            "pwrite returned error: "
+                            "errno=%d", errno ) );
+                returnValue = -1;
+            }
+        }
+
+        if( returnValue == 0 )
+        {
+            returnValue = ( int32_t ) bytesWritten;
+        }
+
+        return returnValue;
+    }
+
+#endif /* if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+
+    static void startStreamingDigest( const OtaFileContext_t * const C )
+    {
+        if( pthread_mutex_lock( &streamingDigestMutex ) == 0 )
+        {
+            /* A digest left by a file that was neither closed nor aborted is
+             * discarded. */
+            stopStreamingDigestLocked();
+
+            streamingDigest.pDigestContext = EVP_MD_CTX_new();
+
+            if( ( streamingDigest.pDigestContext != NULL ) &&
+                ( 1 == EVP_DigestInit_ex( streamingDigest.pDigestContext, EVP_sha256(), NULL ) ) )
+            {
+                streamingDigest.pFile = C->pFile;
+                streamingDigest.nextOffset = 0U;
+                ( void ) memset( streamingDigest.pendingBlocks, 0, sizeof( streamingDigest.pendingBlocks ) );
+            }
+            else
+            {
+                LogWarn( ( "Failed to start the digest of the receive file. "
+                           "The file is hashed when it is closed." ) );
+                stopStreamingDigestLocked();
+            }
+
+            ( void ) pthread_mutex_unlock( &streamingDigestMutex );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void stopStreamingDigestLocked( void )
+    {
+        EVP_MD_CTX_free( streamingDigest.pDigestContext );
+        streamingDigest.pDigestContext = NULL;
+        streamingDigest.pFile = NULL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void stopStreamingDigest( const FILE * pFile )
+    {
+        if( pthread_mutex_lock( &streamingDigestMutex ) == 0 )
+        {
+            if( streamingDigest.pFile == pFile )
+            {
+                stopStreamingDigestLocked();
+            }
+
+            ( void ) pthread_mutex_unlock( &streamingDigestMutex );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void updateStreamingDigest( const OtaFileContext_t * const C,
+                                       uint32_t offset,
+                                       const uint8_t * pData,
+                                       uint32_t length )
+    {
+        bool success = true;
+        uint32_t end = offset + length;
+        uint32_t skipped = 0U;
+        size_t i = 0U;
+        size_t freeEntry = OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS;
+
+        if( pthread_mutex_lock( &streamingDigestMutex ) == 0 )
+        {
+            if( ( streamingDigest.pFile == NULL ) || ( streamingDigest.pFile != C->pFile ) )
+            {
+                /* No digest is in progress for this file. */
+            }
+            else if( offset <= streamingDigest.nextOffset )
+            {
+                if( end > streamingDigest.nextOffset )
+                {
+                    /* Skip the part of the block that was hashed already. */
+                    skipped = streamingDigest.nextOffset - offset;
+                    success = ( 1 == EVP_DigestUpdate( streamingDigest.pDigestContext,
+                                                       &pData[ skipped ],
+                                                       ( size_t ) ( length - skipped ) ) );
+
+                    if( success == true )
+                    {
+                        streamingDigest.nextOffset = end;
+                        success = hashPendingBlocksLocked( fileno( C->pFile ) );
+                    }
+                }
+            }
+            else
+            {
+                /* Record the block until the blocks before it are hashed. A
+                 * retransmitted block is recorded once. */
+                for( i = 0U; i < OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS; i++ )
+                {
+                    if( streamingDigest.pendingBlocks[ i ].length == 0U )
+                    {
+                        freeEntry = ( freeEntry == OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS ) ? i : freeEntry;
+                    }
+                    else if( ( streamingDigest.pendingBlocks[ i ].offset == offset ) &&
+                             ( streamingDigest.pendingBlocks[ i ].length >= length ) )
+                    {
+                        freeEntry = i;
+                        break;
+                    }
+                    else
+                    {
+                        /* Empty else MISRA 15.7 */
+                    }
+                }
+
+                if( freeEntry < OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS )
+                {
+                    if( streamingDigest.pendingBlocks[ freeEntry ].length == 0U )
+                    {
+                        streamingDigest.pendingBlocks[ freeEntry ].offset = offset;
+                        streamingDigest.pendingBlocks[ freeEntry ].length = length;
+                    }
+                }
+                else
+                {
+                    LogWarn( ( "More than %u blocks arrived out of order. "
+                               "The file is hashed when it is closed.",
+                               ( unsigned int ) OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS ) );
+                    stopStreamingDigestLocked();
+                }
+            }
+
+            if( success == false )
+            {
+                LogWarn( ( "Failed to hash a block of the receive file. "
+                           "The file is hashed when it is closed." ) );
+                stopStreamingDigestLocked();
+            }
+
+            ( void ) pthread_mutex_unlock( &streamingDigestMutex );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool hashPendingBlocksLocked( int fileDescriptor )
+    {
+        bool success = true;
+        bool progress = true;
+        PendingBlock_t * pBlock = NULL;
+        uint32_t end = 0U;
+        size_t readLength = 0U;
+        ssize_t readResult = 0;
+        size_t i = 0U;
+
+        /* Each pass hashes the pending blocks that the previous passes made
+         * contiguous, until no pending block starts at or before the next
+         * offset. */
+        while( ( success == true ) && ( progress == true ) )
+        {
+            progress = false;
+
+            for( i = 0U; ( success == true ) && ( i < OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS ); i++ )
+            {
+                pBlock = &streamingDigest.pendingBlocks[ i ];
+
+                if( ( pBlock->length > 0U ) && ( pBlock->offset <= streamingDigest.nextOffset ) )
+                {
+                    end = pBlock->offset + pBlock->length;
+
+                    while( ( success == true ) && ( streamingDigest.nextOffset < end ) )
+                    {
+                        readLength = ( size_t ) ( end - streamingDigest.nextOffset );
+                        readLength = ( readLength < OTA_PAL_POSIX_BUF_SIZE ) ? readLength : OTA_PAL_POSIX_BUF_SIZE;
+
+                        #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+                            /* The block may still be in a staged extent. */
+                            readResult = readReceiveFile( fileDescriptor,
+                                                          streamingDigest.readBuffer,
+                                                          readLength,
+                                                          streamingDigest.nextOffset );
+                        #else
+                            readResult = pread( fileDescriptor,
+                                                streamingDigest.readBuffer,
+                                                readLength,
+                                                ( off_t ) streamingDigest.nextOffset );
+                        #endif
+
+                        if( readResult > 0 )
+                        {
+                            success = ( 1 == EVP_DigestUpdate( streamingDigest.pDigestContext,
+                                                               streamingDigest.readBuffer,
+                                                               ( size_t ) readResult ) );
+                            streamingDigest.nextOffset += ( uint32_t ) readResult;
+                        }
+                        else if( ( readResult < 0 ) && ( errno == EINTR ) )
+                        {
+                            /* Interrupted before anything was read; read again. */
+                        }
+                        else
+                        {
+                            LogError( ( "Failed to read a block back from the receive file: "
+                                        "pread returned error: "
+                                        "errno=%d", errno ) );
+                            success = false;
+                        }
+                    }
+
+                    pBlock->length = 0U;
+                    progress = true;
+                }
+            }
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool finishStreamingDigest( const OtaFileContext_t * const C,
+                                       uint8_t * pDigest,
+                                       uint32_t * pDigestLength )
+    {
+        bool complete = false;
+        unsigned int digestLength = 0U;
+
+        if( pthread_mutex_lock( &streamingDigestMutex ) == 0 )
+        {
+            if( ( streamingDigest.pFile != NULL ) &&
+                ( streamingDigest.pFile == C->pFile ) &&
+                ( streamingDigest.nextOffset == C->fileSize ) &&
+                ( 1 == EVP_DigestFinal_ex( streamingDigest.pDigestContext, pDigest, &digestLength ) ) )
+            {
+                *pDigestLength = ( uint32_t ) digestLength;
+                complete = true;
+            }
+            else
+            {
+                LogDebug( ( "The digest of the receive file is incomplete. "
+                            "Reading the file back to hash it." ) );
+            }
+
+            /* The digest of another file, which is being received while this
+             * one is verified on a worker thread, is left running. */
+            if( streamingDigest.pFile == C->pFile )
+            {
+                stopStreamingDigestLocked();
+            }
+
+            ( void ) pthread_mutex_unlock( &streamingDigestMutex );
+        }
+
+        return complete;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaPalMainStatus_t Openssl_VerifyDigest( EVP_PKEY * pPkey,
+                                                    const uint8_t * pDigest,
+                                                    uint32_t digestLength,
+                                                    const Sig256_t * pSignature )
+    {
+        OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
+        EVP_PKEY_CTX * pKeyContext = NULL;
+
+        /* Verify the ECDSA signature of the SHA-256 digest, as
+         * EVP_DigestVerifyFinal does once it has hashed the file. */
+        pKeyContext = EVP_PKEY_CTX_new( pPkey, NULL );
+
+        if( ( pKeyContext != NULL ) &&
+            ( 1 == EVP_PKEY_verify_init( pKeyContext ) ) &&
+            ( 0 < EVP_PKEY_CTX_set_signature_md( pKeyContext, EVP_sha256() ) ) &&
+            ( 1 == EVP_PKEY_verify( pKeyContext,
+                                    pSignature->data,
+                                    pSignature->size,
+                                    pDigest,
+                                    digestLength ) ) )
+        {
+            LogDebug( ( "Verified the signature of the digest computed during the download." ) );
+            mainErr = OtaPalSuccess;
+        }
+        else
+        {
+            LogError( ( "File signature check failed at VERIFY digest." ) );
+        }
+
+        EVP_PKEY_CTX_free( pKeyContext );
+
+        return mainErr;
+    }
+
+#endif /* if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+
+    static EVP_PKEY * getCachedSignerKey( uint8_t * pCertFilePath )
+    {
+        EVP_PKEY * pPkey = NULL;
+        struct stat certFileStat;
+        bool certFileFound = false;
+        size_t pathLength = strlen( ( const char * ) pCertFilePath );
+
+        ( void ) memset( &certFileStat, 0, sizeof( certFileStat ) );
+        certFileFound = ( stat( ( const char * ) pCertFilePath, &certFileStat ) == 0 );
+
+        if( pthread_mutex_lock( &signerKeyCacheMutex ) == 0 )
+        {
+            if( ( signerKeyCache.pPkey != NULL ) &&
+                ( strcmp( signerKeyCache.certFilePath, ( const char * ) pCertFilePath ) == 0 ) &&
+                ( signerKeyCache.certFileFound == certFileFound ) &&
+                ( ( certFileFound == false ) ||
+                  ( ( signerKeyCache.modificationTime.tv_sec == certFileStat.st_mtim.tv_sec ) &&
+                    ( signerKeyCache.modificationTime.tv_nsec == certFileStat.st_mtim.tv_nsec ) &&
+                    ( signerKeyCache.certFileSize == certFileStat.st_size ) ) ) )
+            {
+                LogDebug( ( "Using the cached key of the signer cert." ) );
+                pPkey = signerKeyCache.pPkey;
+            }
+            else
+            {
+                pPkey = Openssl_GetPkeyFromCertificate( pCertFilePath );
+
+                if( ( pPkey != NULL ) && ( pathLength < sizeof( signerKeyCache.certFilePath ) ) )
+                {
+                    /* Replace the key of a previous or modified certificate. */
+                    EVP_PKEY_free( signerKeyCache.pPkey );
+                    signerKeyCache.pPkey = pPkey;
+                    ( void ) memcpy( signerKeyCache.certFilePath, pCertFilePath, pathLength + 1U );
+                    signerKeyCache.certFileFound = certFileFound;
+                    signerKeyCache.modificationTime = certFileStat.st_mtim;
+                    signerKeyCache.certFileSize = certFileStat.st_size;
+                }
+                else
+                {
+                    /* The key is not cached, so the reference is the caller's. */
+                }
+            }
+
+            /* The caller frees its own reference, and the cache keeps one. */
+            if( ( pPkey != NULL ) && ( pPkey == signerKeyCache.pPkey ) &&
+                ( EVP_PKEY_up_ref( pPkey ) != 1 ) )
+            {
+                LogError( ( "Failed to reference the cached key of the signer cert." ) );
+                pPkey = NULL;
+            }
+
+            ( void ) pthread_mutex_unlock( &signerKeyCacheMutex );
+        }
+        else
+        {
+            /* The cache cannot be used, so load the key for this check only. */
+            pPkey = Openssl_GetPkeyFromCertificate( pCertFilePath );
+        }
+
+        return pPkey;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void otaPal_FreeSignerKeyCache( void )
+    {
+        if( pthread_mutex_lock( &signerKeyCacheMutex ) == 0 )
+        {
+            EVP_PKEY_free( signerKeyCache.pPkey );
+            ( void ) memset( &signerKeyCache, 0, sizeof( signerKeyCache ) );
+            ( void ) pthread_mutex_unlock( &signerKeyCacheMutex );
+        }
+    }
+
+#endif /* if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) || ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+
+    static bool openReplacementFile( const OtaFileContext_t * const C,
+                                     const char * pSuffix,
+                                     ReplacementFile_t * pReplacement )
+    {
+        OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
+        int pathLength = 0;
+
+        #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+            /* The streaming digest is of the file being replaced. */
+            stopStreamingDigest( C->pFile );
+        #endif
+
+        pReplacement->pFile = NULL;
+
+        if( C->pFilePath[ 0 ] != ( uint8_t ) '/' )
+        {
+            status = getFilePathFromCWD( pReplacement->receiveFilePath, ( const char * ) C->pFilePath );
+        }
+        else if( strlen( ( const char * ) C->pFilePath ) < sizeof( pReplacement->receiveFilePath ) )
+        {
+            ( void ) strncpy( pReplacement->receiveFilePath, ( const char * ) C->pFilePath, sizeof( pReplacement->receiveFilePath ) );
+        }
+        else
+        {
+            status = OtaPalBufferInsufficient;
+        }
+
+        if( status == OtaPalFileGenSuccess )
+        {
+            pathLength = snprintf( pReplacement->filePath, sizeof( pReplacement->filePath ),
+                                   "%s%s", pReplacement->receiveFilePath, pSuffix );
+        }
+
+        if( ( status != OtaPalFileGenSuccess ) || ( pathLength < 0 ) ||
+            ( ( size_t ) pathLength >= sizeof( pReplacement->filePath ) ) )
+        {
+            LogError( ( "Could not generate the path of the file replacing the receive file." ) );
+        }
+        else
+        {
+            /* POSIX port using standard library */
+            /* coverity[misra_c_2012_rule_21_6_violation] */
+            pReplacement->pFile = fopen( pReplacement->filePath, "w+b" );
+
+            if( pReplacement->pFile == NULL )
+            {
+                LogError( ( "Failed to create %s: %s", pReplacement->filePath, strerror( errno ) ) );
+            }
+        }
+
+        return( pReplacement->pFile != NULL );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool commitReplacementFile( OtaFileContext_t * const C,
+                                       ReplacementFile_t * pReplacement,
+                                       bool complete )
+    {
+        bool replaced = false;
+
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        if( ( complete == true ) &&
+            ( fflush( pReplacement->pFile ) == 0 ) &&
+            ( rename( pReplacement->filePath, pReplacement->receiveFilePath ) == 0 ) )
+        {
+            /* The replacement is now at the receive file path, so it becomes
+             * the receive file. */
+            ( void ) fclose( C->pFile );
+            C->pFile = pReplacement->pFile;
+            replaced = true;
+        }
+        else
+        {
+            ( void ) fclose( pReplacement->pFile );
+            ( void ) remove( pReplacement->filePath );
+        }
+
+        pReplacement->pFile = NULL;
+
+        return replaced;
+    }
+
+#endif /* if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) || ( OTA_PAL_POSIX_DELTA_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+
+    static bool inflateFile( FILE * pCompressed,
+                             FILE * pOutput )
+    {
+        z_stream stream;
+        uint8_t input[ OTA_PAL_POSIX_BUF_SIZE ];
+        uint8_t output[ OTA_PAL_POSIX_BUF_SIZE ];
+        size_t outputLength = 0U;
+        int rc = Z_OK;
+        bool success = true;
+
+        ( void ) memset( &stream, 0, sizeof( stream ) );
+
+        /* 16 added to the window bits accepts only a gzip header. */
+        if( inflateInit2( &stream, MAX_WBITS + 16 ) != Z_OK )
+        {
+            LogError( ( "Failed to initialize zlib." ) );
+            success = false;
+        }
+        else
+        {
+            while( ( success == true ) && ( rc != Z_STREAM_END ) )
+            {
+                /* POSIX port using standard library */
+                /* coverity[misra_c_2012_rule_21_6_violation] */
+                stream.avail_in = ( uInt ) fread( input, 1U, sizeof( input ), pCompressed );
+                stream.next_in = input;
+
+                if( stream.avail_in == 0U )
+                {
+                    LogError( ( "The compressed image is truncated." ) );
+                    success = false;
+                }
+
+                /* Decompress the input, one output buffer at a time. */
+                while( ( success == true ) && ( rc != Z_STREAM_END ) &&
+                       ( ( stream.avail_in > 0U ) || ( stream.avail_out == 0U ) ) )
+                {
+                    stream.next_out = output;
+                    stream.avail_out = ( uInt ) sizeof( output );
+                    rc = inflate( &stream, Z_NO_FLUSH );
+                    outputLength = sizeof( output ) - ( size_t ) stream.avail_out;
+
+                    /* Z_BUF_ERROR only means that more input is needed. */
+                    if( ( rc != Z_OK ) && ( rc != Z_STREAM_END ) && ( rc != Z_BUF_ERROR ) )
+                    {
+                        LogError( ( "Failed to decompress the image: %s",
+                                    ( stream.msg != NULL ) ? stream.msg : "zlib error" ) );
+                        success = false;
+                    }
+                    else if( fwrite( output, 1U, outputLength, pOutput ) != outputLength )
+                    {
+                        LogError( ( "Failed to write the decompressed image: %s", strerror( errno ) ) );
+                        success = false;
+                    }
+                    else
+                    {
+                        /* Empty else MISRA 15.7 */
+                    }
+                }
+            }
+
+            /* Nothing may follow the compressed stream. */
+            if( ( success == true ) && ( ( stream.avail_in > 0U ) || ( fgetc( pCompressed ) != EOF ) ) )
+            {
+                LogError( ( "Unexpected data after the compressed image." ) );
+                success = false;
+            }
+
+            ( void ) inflateEnd( &stream );
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaPalStatus_t inflateGzipImage( OtaFileContext_t * const C )
+    {
+        OtaPalMainStatus_t mainErr = OtaPalSuccess;
+        OtaPalSubStatus_t subErr = 0;
+        uint8_t magic[ 2 ];
+        ReplacementFile_t image;
+        bool isCompressed = false;
+
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        isCompressed = ( fseek( C->pFile, 0L, SEEK_SET ) == 0 ) &&
+                       ( fread( magic, 1U, sizeof( magic ), C->pFile ) == sizeof( magic ) ) &&
+                       ( magic[ 0 ] == 0x1FU ) && ( magic[ 1 ] == 0x8BU );
+
+        if( isCompressed == true )
+        {
+            LogInfo( ( "Decompressing the gzip image." ) );
+
+            if( openReplacementFile( C, ".inflated", &image ) == false )
+            {
+                mainErr = OtaPalSignatureCheckFailed;
+                subErr = ( uint32_t ) errno;
+            }
+            else if( commitReplacementFile( C, &image,
+                                            ( fseek( C->pFile, 0L, SEEK_SET ) == 0 ) &&
+                                            ( inflateFile( C->pFile, image.pFile ) == true ) ) == false )
+            {
+                LogError( ( "Failed to decompress the gzip image." ) );
+                mainErr = OtaPalSignatureCheckFailed;
+            }
+            else
+            {
+                LogInfo( ( "Decompressed the gzip image: Image size=%ld", ftell( C->pFile ) ) );
+            }
+        }
+
+        return OTA_PAL_COMBINE_ERR( mainErr, subErr );
+    }
+
+#endif /* if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+
+    static uint32_t readLittleEndian32( const uint8_t * pBytes )
+    {
+        return ( ( uint32_t ) pBytes[ 0 ] ) |
+               ( ( uint32_t ) pBytes[ 1 ] << 8U ) |
+               ( ( uint32_t ) pBytes[ 2 ] << 16U ) |
+               ( ( uint32_t ) pBytes[ 3 ] << 24U );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool copyFileBytes( FILE * pFrom,
+                               FILE * pTo,
+                               uint32_t length )
+    {
+        uint8_t buffer[ OTA_PAL_POSIX_BUF_SIZE ];
+        uint32_t remaining = length;
+        size_t chunkSize = 0U;
+        bool success = true;
+
+        while( ( success == true ) && ( remaining > 0U ) )
+        {
+            chunkSize = ( remaining < OTA_PAL_POSIX_BUF_SIZE ) ? ( size_t ) remaining : OTA_PAL_POSIX_BUF_SIZE;
+
+            /* POSIX port using standard library */
+            /* coverity[misra_c_2012_rule_21_6_violation] */
+            if( ( fread( buffer, 1U, chunkSize, pFrom ) == chunkSize ) &&
+                ( fwrite( buffer, 1U, chunkSize, pTo ) == chunkSize ) )
+            {
+                remaining -= ( uint32_t ) chunkSize;
+            }
+            else
+            {
+                success = false;
+            }
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool applyDeltaRecords( FILE * pDelta,
+                                   FILE * pBase,
+                                   FILE * pOutput,
+                                   uint32_t imageSize )
+    {
+        uint8_t record[ 9 ];
+        uint32_t written = 0U;
+        uint32_t offset = 0U;
+        uint32_t length = 0U;
+        bool success = true;
+        bool done = false;
+
+        while( ( success == true ) && ( done == false ) )
+        {
+            /* POSIX port using standard library */
+            /* coverity[misra_c_2012_rule_21_6_violation] */
+            if( fread( record, 1U, 1U, pDelta ) != 1U )
+            {
+                LogError( ( "Delta image ends without an END record." ) );
+                success = false;
+            }
+            else if( record[ 0 ] == OTA_PAL_POSIX_DELTA_RECORD_END )
+            {
+                /* The END record must be the last byte of the delta. */
+                success = ( fgetc( pDelta ) == EOF ) && ( written == imageSize );
+                done = true;
+            }
+            else if( record[ 0 ] == OTA_PAL_POSIX_DELTA_RECORD_COPY )
+            {
+                success = ( fread( &record[ 1 ], 1U, 8U, pDelta ) == 8U );
+
+                if( success == true )
+                {
+                    offset = readLittleEndian32( &record[ 1 ] );
+                    length = readLittleEndian32( &record[ 5 ] );
+                    success = ( length <= ( imageSize - written ) ) &&
+                              ( fseek( pBase, ( long ) offset, SEEK_SET ) == 0 ) &&
+                              ( copyFileBytes( pBase, pOutput, length ) == true );
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+            else if( record[ 0 ] == OTA_PAL_POSIX_DELTA_RECORD_ADD )
+            {
+                success = ( fread( &record[ 1 ], 1U, 4U, pDelta ) == 4U );
+
+                if( success == true )
+                {
+                    length = readLittleEndian32( &record[ 1 ] );
+                    success = ( length <= ( imageSize - written ) ) &&
+                              ( copyFileBytes( pDelta, pOutput, length ) == true );
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+            }
+            else
+            {
+                LogError( ( "Unknown delta image record: type=%u", ( unsigned int ) record[ 0 ] ) );
+                success = false;
+            }
+
+            if( ( success == true ) && ( done == false ) )
+            {
+                written += length;
+            }
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaPalStatus_t applyDeltaImage( OtaFileContext_t * const C )
+    {
+        OtaPalMainStatus_t mainErr = OtaPalSuccess;
+        OtaPalSubStatus_t subErr = 0;
+        uint8_t header[ OTA_PAL_POSIX_DELTA_HEADER_SIZE ];
+        ReplacementFile_t image;
+        FILE * pBase = NULL;
+        struct stat baseStat;
+        bool isDelta = false;
+
+        /* POSIX port using standard library */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        isDelta = ( fseek( C->pFile, 0L, SEEK_SET ) == 0 ) &&
+                  ( fread( header, 1U, sizeof( header ), C->pFile ) == sizeof( header ) ) &&
+                  ( memcmp( header, OTA_PAL_POSIX_DELTA_MAGIC, 8U ) == 0 );
+
+        if( isDelta == true )
+        {
+            LogInfo( ( "Applying delta image to %s.", OTA_PAL_POSIX_DELTA_BASE_IMAGE_PATH ) );
+
+            /* POSIX port using standard library */
+            /* coverity[misra_c_2012_rule_21_6_violation] */
+            pBase = fopen( OTA_PAL_POSIX_DELTA_BASE_IMAGE_PATH, "rb" );
+
+            if( ( pBase == NULL ) || ( fstat( fileno( pBase ), &baseStat ) != 0 ) )
+            {
+                LogError( ( "Failed to open the base image of the delta: %s", strerror( errno ) ) );
+                mainErr = OtaPalSignatureCheckFailed;
+                subErr = ( uint32_t ) errno;
+            }
+            else if( ( uint64_t ) baseStat.st_size != ( uint64_t ) readLittleEndian32( &header[ 8 ] ) )
+            {
+                LogError( ( "The delta does not apply to the base image: "
+                            "Base image size=%ld, expected=%u",
+                            ( long ) baseStat.st_size, ( unsigned int ) readLittleEndian32( &header[ 8 ] ) ) );
+                mainErr = OtaPalSignatureCheckFailed;
+            }
+            else if( openReplacementFile( C, ".patched", &image ) == false )
+            {
+                mainErr = OtaPalSignatureCheckFailed;
+                subErr = ( uint32_t ) errno;
+            }
+            else if( commitReplacementFile( C, &image,
+                                            applyDeltaRecords( C->pFile, pBase, image.pFile,
+                                                               readLittleEndian32( &header[ 12 ] ) ) ) == false )
+            {
+                LogError( ( "Failed to apply the delta image." ) );
+                mainErr = OtaPalSignatureCheckFailed;
+            }
+            else
+            {
+                LogInfo( ( "Delta image applied: Image size=%u",
+                           ( unsigned int ) readLittleEndian32( &header[ 12 ] ) ) );
+            }
+        }
+
+        if( pBase != NULL )
+        {
+            ( void ) fclose( pBase );
+        }
+
+        return OTA_PAL_COMBINE_ERR( mainErr, subErr );
+    }
+
+#endif /* if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+
+    static uint32_t computeCrc32( const uint8_t * pData,
+                                  size_t length )
+    {
+        uint32_t crc = 0xFFFFFFFFUL;
+        size_t i;
+        uint32_t bit;
+
+        for( i = 0U; i < length; i++ )
+        {
+            crc ^= ( uint32_t ) pData[ i ];
+
+            for( bit = 0U; bit < 8U; bit++ )
+            {
+                if( ( crc & 1UL ) != 0UL )
+                {
+                    crc = ( crc >> 1U ) ^ 0xEDB88320UL;
+                }
+                else
+                {
+                    crc >>= 1U;
+                }
+            }
+        }
+
+        return crc ^ 0xFFFFFFFFUL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void loadStateStoreLocked( void )
+    {
+        char storeFile[ OTA_FILE_PATH_LENGTH_MAX ] = { 0 };
+        int fileDescriptor = -1;
+        ssize_t readSize = 0;
+        PlatformStateRecord_t * pRecord = &stateStore.record;
+
+        if( stateStore.loaded == false )
+        {
+            if( getFilePathFromCWD( storeFile, OTA_PLATFORM_STATE_STORE_FILE ) == OtaPalFileGenSuccess )
+            {
+                fileDescriptor = open( storeFile, O_RDONLY );
+            }
+
+            if( fileDescriptor >= 0 )
+            {
+                readSize = read( fileDescriptor, pRecord, sizeof( PlatformStateRecord_t ) );
+                ( void ) close( fileDescriptor );
+
+                if( ( readSize != ( ssize_t ) sizeof( PlatformStateRecord_t ) ) ||
+                    ( pRecord->magic != OTA_PLATFORM_STATE_STORE_MAGIC ) ||
+                    ( pRecord->crc != computeCrc32( ( const uint8_t * ) pRecord,
+                                                    offsetof( PlatformStateRecord_t, crc ) ) ) )
+                {
+                    LogError( ( "The state store is corrupt: Path=%s", storeFile ) );
+                    ( void ) memset( pRecord, 0, sizeof( PlatformStateRecord_t ) );
+                    pRecord->imageState = ( uint32_t ) OtaImageStateAborted;
+                }
+            }
+            else
+            {
+                /* No state was stored yet: this is a factory image. */
+                ( void ) memset( pRecord, 0, sizeof( PlatformStateRecord_t ) );
+                pRecord->imageState = ( uint32_t ) OtaImageStateUnknown;
+            }
+
+            pRecord->magic = OTA_PLATFORM_STATE_STORE_MAGIC;
+            stateStore.loaded = true;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static int32_t saveStateStoreLocked( void )
+    {
+        int32_t error = 0;
+        char storeFile[ OTA_FILE_PATH_LENGTH_MAX ] = { 0 };
+        char tempFile[ OTA_FILE_PATH_LENGTH_MAX ] = { 0 };
+        int fileDescriptor = -1;
+        PlatformStateRecord_t * pRecord = &stateStore.record;
+
+        if( stateStore.pReceiveFile != NULL )
+        {
+            #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+                /* The blocks still in staged extents are written first. */
+                if( flushDirectWriter() == false )
+                {
+                    error = EIO;
+                }
+            #endif
+
+            /* The blocks in the record must be on disk before the record. */
+            /* POSIX port using standard library */
+            /* coverity[misra_c_2012_rule_21_6_violation] */
+            if( ( error == 0 ) &&
+                ( ( fflush( stateStore.pReceiveFile ) != 0 ) ||
+                  ( fsync( fileno( stateStore.pReceiveFile ) ) != 0 ) ) )
+            {
+                error = errno;
+            }
+        }
+
+        if( ( error == 0 ) &&
+            ( ( getFilePathFromCWD( storeFile, OTA_PLATFORM_STATE_STORE_FILE ) != OtaPalFileGenSuccess ) ||
+              ( ( strlen( storeFile ) + sizeof( OTA_PLATFORM_STATE_STORE_TEMP_SUFFIX ) ) > sizeof( tempFile ) ) ) )
+        {
+            LogError( ( "Could not generate the absolute path for the file" ) );
+            error = ENAMETOOLONG;
+        }
+
+        if( error == 0 )
+        {
+            ( void ) strcpy( tempFile, storeFile );
+            ( void ) strcat( tempFile, OTA_PLATFORM_STATE_STORE_TEMP_SUFFIX );
+
+            pRecord->crc = computeCrc32( ( const uint8_t * ) pRecord,
+                                         offsetof( PlatformStateRecord_t, crc ) );
+
+            fileDescriptor = open( tempFile, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+            if( fileDescriptor < 0 )
+            {
+                error = errno;
+            }
+            else if( ( write( fileDescriptor, pRecord, sizeof( PlatformStateRecord_t ) ) != ( ssize_t ) sizeof( PlatformStateRecord_t ) ) ||
+                     ( fsync( fileDescriptor ) != 0 ) )
+            {
+                error = ( errno != 0 ) ? errno : EIO;
+                ( void ) close( fileDescriptor );
+                ( void ) unlink( tempFile );
+            }
+            else if( ( close( fileDescriptor ) != 0 ) ||
+                     ( rename( tempFile, storeFile ) != 0 ) )
+            {
+                error = errno;
+                ( void ) unlink( tempFile );
+            }
+            else
+            {
+                /* Sync the directory, so that the rename survives a crash. */
+                fileDescriptor = open( dirname( tempFile ), O_RDONLY );
+
+                if( fileDescriptor >= 0 )
+                {
+                    ( void ) fsync( fileDescriptor );
+                    ( void ) close( fileDescriptor );
+                }
+            }
+        }
+
+        if( error != 0 )
+        {
+            LogError( ( "Failed to write the state store: Path=%s, error: %s",
+                        storeFile, strerror( error ) ) );
+        }
+
+        return error;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static int32_t setStoredImageState( OtaImageState_t eState )
+    {
+        int32_t error = EBUSY;
+        uint32_t previousState;
+
+        if( pthread_mutex_lock( &stateStoreMutex ) == 0 )
+        {
+            loadStateStoreLocked();
+
+            previousState = stateStore.record.imageState;
+            stateStore.record.imageState = ( uint32_t ) eState;
+            error = saveStateStoreLocked();
+
+            if( error != 0 )
+            {
+                stateStore.record.imageState = previousState;
+            }
+
+            ( void ) pthread_mutex_unlock( &stateStoreMutex );
+        }
+
+        return error;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaImageState_t getStoredImageState( void )
+    {
+        OtaImageState_t eState = OtaImageStateAborted;
+
+        if( pthread_mutex_lock( &stateStoreMutex ) == 0 )
+        {
+            loadStateStoreLocked();
+
+            eState = ( OtaImageState_t ) stateStore.record.imageState;
+
+            ( void ) pthread_mutex_unlock( &stateStoreMutex );
+        }
+
+        return eState;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool resumeReceiveFile( OtaFileContext_t * const C,
+                                   const char * pFilePath )
+    {
+        bool resumed = false;
+        const PlatformStateRecord_t * pRecord = &stateStore.record;
+        uint32_t blockCount = 0U;
+        uint32_t block = 0U;
+        uint32_t resumedBlocks = 0U;
+        uint8_t bitMask = 0U;
+
+        if( pthread_mutex_lock( &stateStoreMutex ) == 0 )
+        {
+            loadStateStoreLocked();
+
+            if( ( pRecord->fileSize == C->fileSize ) &&
+                ( pRecord->fileSize != 0U ) &&
+                ( pRecord->blockSize != 0U ) &&
+                ( C->pSignature != NULL ) &&
+                ( C->pRxBlockBitmap != NULL ) &&
+                ( strncmp( pRecord->filePath, pFilePath, sizeof( pRecord->filePath ) ) == 0 ) &&
+                ( pRecord->signature.size == C->pSignature->size ) &&
+                ( pRecord->signature.size <= sizeof( pRecord->signature.data ) ) &&
+                ( memcmp( pRecord->signature.data, C->pSignature->data, pRecord->signature.size ) == 0 ) )
+            {
+                /* POSIX port using standard library */
+                /* coverity[misra_c_2012_rule_21_6_violation] */
+                C->pFile = fopen( pFilePath, "r+b" );
+            }
+
+            if( C->pFile != NULL )
+            {
+                blockCount = ( pRecord->fileSize + pRecord->blockSize - 1U ) / pRecord->blockSize;
+
+                /* The last block is requested again, so that the OTA agent
+                 * receives a block and closes the file even if all of them
+                 * were written. */
+                for( block = 0U;
+                     ( block < ( blockCount - 1U ) ) &&
+                     ( block < OTA_PAL_POSIX_STATE_MAX_BLOCKS ) &&
+                     ( ( block / 8U ) < C->blockBitmapMaxSize );
+                     block++ )
+                {
+                    bitMask = ( uint8_t ) ( 1U << ( block % 8U ) );
+
+                    if( ( ( pRecord->blocksWritten[ block / 8U ] & bitMask ) != 0U ) &&
+                        ( ( C->pRxBlockBitmap[ block / 8U ] & bitMask ) != 0U ) &&
+                        ( C->blocksRemaining > 1U ) )
+                    {
+                        C->pRxBlockBitmap[ block / 8U ] &= ( uint8_t ) ~bitMask;
+                        C->blocksRemaining--;
+                        resumedBlocks++;
+                    }
+                }
+
+                stateStore.pReceiveFile = C->pFile;
+                stateStore.blocksSinceCheckpoint = 0U;
+                resumed = true;
+
+                LogInfo( ( "Resumed receive file: Blocks received=%u, Blocks remaining=%u",
+                           ( unsigned int ) resumedBlocks,
+                           ( unsigned int ) C->blocksRemaining ) );
+            }
+
+            ( void ) pthread_mutex_unlock( &stateStoreMutex );
+        }
+
+        return resumed;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void startFileProgress( const OtaFileContext_t * const C,
+                                   const char * pFilePath )
+    {
+        PlatformStateRecord_t * pRecord = &stateStore.record;
+
+        if( pthread_mutex_lock( &stateStoreMutex ) == 0 )
+        {
+            loadStateStoreLocked();
+
+            pRecord->fileSize = C->fileSize;
+            pRecord->blockSize = 0U;
+            ( void ) memset( &pRecord->signature, 0, sizeof( pRecord->signature ) );
+            ( void ) memset( pRecord->filePath, 0, sizeof( pRecord->filePath ) );
+            ( void ) memset( pRecord->blocksWritten, 0, sizeof( pRecord->blocksWritten ) );
+
+            if( ( C->pSignature != NULL ) &&
+                ( strlen( pFilePath ) < sizeof( pRecord->filePath ) ) )
+            {
+                pRecord->signature = *C->pSignature;
+                ( void ) strcpy( pRecord->filePath, pFilePath );
+
+                stateStore.pReceiveFile = C->pFile;
+                stateStore.blocksSinceCheckpoint = 0U;
+            }
+            else
+            {
+                /* The file cannot be identified, its progress is not recorded. */
+                pRecord->fileSize = 0U;
+            }
+
+            ( void ) saveStateStoreLocked();
+            ( void ) pthread_mutex_unlock( &stateStoreMutex );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void recordBlockWritten( const OtaFileContext_t * const C,
+                                    uint32_t offset,
+                                    uint32_t length )
+    {
+        PlatformStateRecord_t * pRecord = &stateStore.record;
+        uint32_t block = 0U;
+
+        if( pthread_mutex_lock( &stateStoreMutex ) == 0 )
+        {
+            if( ( stateStore.pReceiveFile != NULL ) &&
+                ( stateStore.pReceiveFile == C->pFile ) &&
+                ( length != 0U ) )
+            {
+                /* All blocks but the last one have the size of a block. */
+                if( ( pRecord->blockSize == 0U ) &&
+                    ( ( offset % length ) == 0U ) &&
+                    ( ( offset + length ) < pRecord->fileSize ) )
+                {
+                    pRecord->blockSize = length;
+                }
+
+                if( ( pRecord->blockSize != 0U ) &&
+                    ( ( offset % pRecord->blockSize ) == 0U ) &&
+                    ( ( length == pRecord->blockSize ) || ( ( offset + length ) == pRecord->fileSize ) ) )
+                {
+                    block = offset / pRecord->blockSize;
+
+                    if( block < OTA_PAL_POSIX_STATE_MAX_BLOCKS )
+                    {
+                        pRecord->blocksWritten[ block / 8U ] |= ( uint8_t ) ( 1U << ( block % 8U ) );
+                        stateStore.blocksSinceCheckpoint++;
+                    }
+                }
+
+                if( stateStore.blocksSinceCheckpoint >= OTA_PAL_POSIX_STATE_CHECKPOINT_BLOCKS )
+                {
+                    ( void ) saveStateStoreLocked();
+                    stateStore.blocksSinceCheckpoint = 0U;
+                }
+            }
+
+            ( void ) pthread_mutex_unlock( &stateStoreMutex );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void stopFileProgress( void )
+    {
+        PlatformStateRecord_t * pRecord = &stateStore.record;
+
+        if( pthread_mutex_lock( &stateStoreMutex ) == 0 )
+        {
+            if( stateStore.pReceiveFile != NULL )
+            {
+                stateStore.pReceiveFile = NULL;
+
+                pRecord->fileSize = 0U;
+                pRecord->blockSize = 0U;
+                ( void ) memset( &pRecord->signature, 0, sizeof( pRecord->signature ) );
+                ( void ) memset( pRecord->filePath, 0, sizeof( pRecord->filePath ) );
+                ( void ) memset( pRecord->blocksWritten, 0, sizeof( pRecord->blocksWritten ) );
+
+                ( void ) saveStateStoreLocked();
+            }
+
+            ( void ) pthread_mutex_unlock( &stateStoreMutex );
+        }
+    }
+
+#endif /* if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+
+    static void startWriteBehind( OtaFileContext_t * const C )
+    {
+        /* Stop the thread of a file that was neither closed nor aborted. */
+        ( void ) stopWriteBehind();
+
+        writeBehind.stop = false;
+        writeBehind.failed = false;
+        writeBehind.head = 0U;
+        writeBehind.count = 0U;
+        writeBehind.pContext = C;
+
+        if( pthread_create( &writeBehind.thread, NULL, writeBehindThread, NULL ) != 0 )
+        {
+            LogWarn( ( "Failed to start the writer thread: "
+                       "Blocks are written as they are received." ) );
+            writeBehind.pContext = NULL;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool stopWriteBehind( void )
+    {
+        bool blocksWritten = true;
+
+        if( writeBehind.pContext != NULL )
+        {
+            ( void ) pthread_mutex_lock( &writeBehindMutex );
+            writeBehind.stop = true;
+            ( void ) pthread_cond_broadcast( &writeBehindCondition );
+            ( void ) pthread_mutex_unlock( &writeBehindMutex );
+
+            ( void ) pthread_join( writeBehind.thread, NULL );
+
+            blocksWritten = ( writeBehind.failed == false );
+            writeBehind.pContext = NULL;
+        }
+
+        return blocksWritten;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool queueBlock( OtaFileContext_t * const C,
+                            uint32_t ulOffset,
+                            const uint8_t * pcData,
+                            uint32_t ulBlockSize,
+                            int32_t * pResult )
+    {
+        bool resultSet = false;
+        WriteBehindBlock_t * pBlock = NULL;
+
+        if( writeBehind.pContext == C )
+        {
+            ( void ) pthread_mutex_lock( &writeBehindMutex );
+
+            if( ulBlockSize > OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_SIZE )
+            {
+                while( writeBehind.count > 0U )
+                {
+                    ( void ) pthread_cond_wait( &writeBehindCondition, &writeBehindMutex );
+                }
+            }
+            else
+            {
+                while( ( writeBehind.count == OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT ) &&
+                       ( writeBehind.failed == false ) )
+                {
+                    ( void ) pthread_cond_wait( &writeBehindCondition, &writeBehindMutex );
+                }
+
+                if( writeBehind.failed == true )
+                {
+                    LogError( ( "Failed to write an earlier block to file." ) );
+                    *pResult = -1;
+                }
+                else
+                {
+                    pBlock = &writeBehind.blocks[ ( writeBehind.head + writeBehind.count ) %
+                                                  OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT ];
+                    pBlock->offset = ulOffset;
+                    pBlock->length = ulBlockSize;
+                    ( void ) memcpy( pBlock->data, pcData, ulBlockSize );
+
+                    writeBehind.count++;
+                    ( void ) pthread_cond_broadcast( &writeBehindCondition );
+
+                    *pResult = ( int32_t ) ulBlockSize;
+                }
+
+                resultSet = true;
+            }
+
+            ( void ) pthread_mutex_unlock( &writeBehindMutex );
+        }
+
+        return resultSet;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * writeBehindThread( void * pArgs )
+    {
+        WriteBehindBlock_t * pBlock = NULL;
+        int32_t filerc = 0;
+        bool stopped = false;
+
+        ( void ) pArgs;
+
+        ( void ) pthread_mutex_lock( &writeBehindMutex );
+
+        while( stopped == false )
+        {
+            if( writeBehind.count > 0U )
+            {
+                /* The block stays queued while it is written, so that its
+                 * buffer is not reused. */
+                pBlock = &writeBehind.blocks[ writeBehind.head ];
+                ( void ) pthread_mutex_unlock( &writeBehindMutex );
+
+                filerc = writeBlockToFile( writeBehind.pContext,
+                                           pBlock->offset,
+                                           pBlock->data,
+                                           pBlock->length );
+
+                ( void ) pthread_mutex_lock( &writeBehindMutex );
+
+                if( filerc != ( int32_t ) pBlock->length )
+                {
+                    writeBehind.failed = true;
+                }
+
+                writeBehind.head = ( writeBehind.head + 1U ) % OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT;
+                writeBehind.count--;
+                ( void ) pthread_cond_broadcast( &writeBehindCondition );
+            }
+            else if( writeBehind.stop == true )
+            {
+                stopped = true;
+            }
+            else
+            {
+                ( void ) pthread_cond_wait( &writeBehindCondition, &writeBehindMutex );
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &writeBehindMutex );
+
+        return NULL;
+    }
+
+#endif /* if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+
+    static void startDirectWriter( const OtaFileContext_t * const C,
+                                   const char * pFilePath )
+    {
+        void * pBuffers = NULL;
+        int fileDescriptor = -1;
+        size_t i = 0U;
+
+        /* A writer left by a file that was neither closed nor aborted is
+         * discarded. */
+        ( void ) stopDirectWriter( false );
+
+        fileDescriptor = open( pFilePath, O_RDWR | O_DIRECT );
+
+        if( fileDescriptor < 0 )
+        {
+            LogWarn( ( "Failed to open the receive file with O_DIRECT: "
+                       "errno=%d. The blocks are written through the page cache.", errno ) );
+        }
+        else if( posix_memalign( &pBuffers,
+                                 OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT,
+                                 ( size_t ) OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE * OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT ) != 0 )
+        {
+            LogWarn( ( "Failed to allocate the extents of the receive file. "
+                       "The blocks are written through the page cache." ) );
+            ( void ) close( fileDescriptor );
+        }
+        else if( pthread_mutex_lock( &directWriterMutex ) == 0 )
+        {
+            directWriter.pFile = C->pFile;
+            directWriter.fileDescriptor = fileDescriptor;
+            directWriter.fileSize = C->fileSize;
+            directWriter.failed = false;
+            directWriter.pBuffers = ( uint8_t * ) pBuffers;
+
+            for( i = 0U; i < OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT; i++ )
+            {
+                directWriter.extents[ i ].offset = 0U;
+                directWriter.extents[ i ].received = 0U;
+                directWriter.extents[ i ].staged = false;
+                directWriter.extents[ i ].pData = &directWriter.pBuffers[ i * OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE ];
+            }
+
+            ( void ) pthread_mutex_unlock( &directWriterMutex );
+        }
+        else
+        {
+            free( pBuffers );
+            ( void ) close( fileDescriptor );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool stopDirectWriter( bool flush )
+    {
+        bool success = true;
+        size_t i = 0U;
+
+        if( pthread_mutex_lock( &directWriterMutex ) == 0 )
+        {
+            if( directWriter.pFile != NULL )
+            {
+                for( i = 0U; i < OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT; i++ )
+                {
+                    if( ( flush == true ) && ( directWriter.extents[ i ].staged == true ) )
+                    {
+                        ( void ) flushExtentLocked( &directWriter.extents[ i ] );
+                    }
+
+                    directWriter.extents[ i ].staged = false;
+                }
+
+                if( close( directWriter.fileDescriptor ) != 0 )
+                {
+                    LogError( ( "Failed to close the O_DIRECT descriptor of the receive file: "
+                                "errno=%d", errno ) );
+                    directWriter.failed = true;
+                }
+
+                success = ( directWriter.failed == false );
+
+                free( directWriter.pBuffers );
+                ( void ) memset( &directWriter, 0, sizeof( directWriter ) );
+                directWriter.fileDescriptor = -1;
+            }
+
+            ( void ) pthread_mutex_unlock( &directWriterMutex );
+        }
+
+        return success;
+    }
+
+/*-----------------------------------------------------------*/
+
+    #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+
+        static bool flushDirectWriter( void )
+        {
+            bool success = true;
+            size_t i = 0U;
+
+            if( pthread_mutex_lock( &directWriterMutex ) == 0 )
+            {
+                if( directWriter.pFile != NULL )
+                {
+                    for( i = 0U; i < OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT; i++ )
+                    {
+                        if( directWriter.extents[ i ].staged == true )
+                        {
+                            ( void ) flushExtentLocked( &directWriter.extents[ i ] );
+                        }
+                    }
+
+                    success = ( directWriter.failed == false );
+                }
+
+                ( void ) pthread_mutex_unlock( &directWriterMutex );
+            }
+
+            return success;
+        }
+    #endif /* if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 ) */
+
+/*-----------------------------------------------------------*/
 
-        assert( bytesRead <= OTA_PAL_POSIX_BUF_SIZE );
+    static bool flushExtentLocked( StagedExtent_t * pExtent )
+    {
+        bool success = true;
+        size_t writeLength = OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE;
+        uint32_t bytesLeft = directWriter.fileSize - pExtent->offset;
 
-        /* feof returns non-zero if end of file is reached, otherwise it returns 0. When
-         * bytesRead is not equal to OTA_PAL_POSIX_BUF_SIZE, we should be reading last
-         * chunk and reach to end of file. */
+        if( bytesLeft < OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE )
+        {
+            /* O_DIRECT writes whole aligned blocks, so the last extent is
+             * padded up to the alignment. */
+            writeLength = ( ( ( size_t ) bytesLeft + OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT - 1U ) /
+                            OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT ) * OTA_PAL_POSIX_DIRECT_IO_ALIGNMENT;
+        }
 
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        if( ( bytesRead < OTA_PAL_POSIX_BUF_SIZE ) && ( 0 == feof( pFile ) ) )
+        if( writeAtOffset( directWriter.fileDescriptor,
+                           pExtent->pData,
+                           writeLength,
+                           ( off_t ) pExtent->offset ) != ( int32_t ) writeLength )
         {
-            break;
+            success = false;
+        }
+        else if( ( writeLength > ( size_t ) bytesLeft ) &&
+                 ( ftruncate( directWriter.fileDescriptor, ( off_t ) directWriter.fileSize ) != 0 ) )
+        {
+            LogError( ( "Failed to truncate the padding of the receive file: "
+                        "errno=%d", errno ) );
+            success = false;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
         }
 
-        /* Include the file chunk in the signature validation. Zero size is OK. */
-        if( 1 != EVP_DigestVerifyUpdate( pSigContext, pBuf, bytesRead ) )
+        if( success == false )
         {
-            break;
+            directWriter.failed = true;
         }
-    } while( bytesRead > 0UL );
 
-    /* POSIX port using standard library */
-    /* coverity[misra_c_2012_rule_21_6_violation] */
-    return( 0 != feof( pFile ) ? true : false );
-}
+        pExtent->staged = false;
 
-static OtaPalMainStatus_t Openssl_DigestVerify( EVP_MD_CTX * pSigContext,
-                                                EVP_PKEY * pPkey,
-                                                FILE * pFile,
-                                                Sig256_t * pSignature )
-{
-    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
-    OtaPalMainStatus_t startErr;
-    uint8_t * pBuf;
+        return success;
+    }
 
-    startErr = Openssl_DigestVerifyStart( pSigContext, pPkey, pFile, &pBuf );
+/*-----------------------------------------------------------*/
 
-    if( OtaPalSuccess == startErr )
+    static StagedExtent_t * stageExtentLocked( uint32_t offset )
     {
-        /* Rewind the received file to the beginning. */
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        if( fseek( pFile, 0L, SEEK_SET ) == 0 )
+        StagedExtent_t * pExtent = NULL;
+        StagedExtent_t * pFree = NULL;
+        StagedExtent_t * pOldest = NULL;
+        ssize_t readResult = 0;
+        size_t i = 0U;
+
+        for( i = 0U; ( pExtent == NULL ) && ( i < OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT ); i++ )
         {
-            bool eof = Openssl_DigestVerifyUpdate( pSigContext, pFile, pBuf );
+            if( directWriter.extents[ i ].staged == false )
+            {
+                pFree = ( pFree == NULL ) ? &directWriter.extents[ i ] : pFree;
+            }
+            else if( directWriter.extents[ i ].offset == offset )
+            {
+                pExtent = &directWriter.extents[ i ];
+            }
+            else if( ( pOldest == NULL ) || ( directWriter.extents[ i ].offset < pOldest->offset ) )
+            {
+                pOldest = &directWriter.extents[ i ];
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
 
-            if( ( eof == true ) && ( 1 == EVP_DigestVerifyFinal( pSigContext,
-                                                                 pSignature->data,
-                                                                 pSignature->size ) ) )
+        if( pExtent == NULL )
+        {
+            if( pFree != NULL )
             {
-                mainErr = OtaPalSuccess;
+                pExtent = pFree;
+            }
+            else if( flushExtentLocked( pOldest ) == true )
+            {
+                /* The blocks of the extent that are still missing are
+                 * written with the extent when they arrive. */
+                LogDebug( ( "Wrote the extent at offset %u partially.",
+                            ( unsigned int ) pOldest->offset ) );
+                pExtent = pOldest;
             }
             else
             {
-                LogError( ( "File signature check failed at FINAL" ) );
+                /* Empty else MISRA 15.7 */
+            }
+
+            if( pExtent != NULL )
+            {
+                /* The bytes past the end of the file read as zeros. In a
+                 * preallocated extent that was never written, the read
+                 * returns zeros without reading the device. */
+                ( void ) memset( pExtent->pData, 0, OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE );
+
+                do
+                {
+                    readResult = pread( directWriter.fileDescriptor,
+                                        pExtent->pData,
+                                        OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE,
+                                        ( off_t ) offset );
+                } while( ( readResult < 0 ) && ( errno == EINTR ) );
+
+                if( readResult < 0 )
+                {
+                    LogError( ( "Failed to read an extent of the receive file: "
+                                "pread returned error: "
+                                "errno=%d", errno ) );
+                    directWriter.failed = true;
+                    pExtent = NULL;
+                }
+                else
+                {
+                    pExtent->offset = offset;
+                    pExtent->received = 0U;
+                    pExtent->staged = true;
+                }
             }
         }
 
-        /* Free the temporary file page buffer. */
-        OPENSSL_free( pBuf );
+        return pExtent;
     }
-    else
+
+/*-----------------------------------------------------------*/
+
+    static bool writeStagedBlock( const OtaFileContext_t * const C,
+                                  uint32_t ulOffset,
+                                  const uint8_t * pcData,
+                                  uint32_t ulBlockSize,
+                                  int32_t * pResult )
     {
-        mainErr = startErr;
-    }
+        bool resultSet = false;
+        StagedExtent_t * pExtent = NULL;
+        uint32_t copied = 0U, position = 0U, extentOffset = 0U;
+        uint32_t chunkLength = 0U, extentLength = 0U;
+        int32_t result = 0;
 
-    return mainErr;
-}
+        if( pthread_mutex_lock( &directWriterMutex ) == 0 )
+        {
+            if( ( directWriter.pFile != NULL ) && ( directWriter.pFile == C->pFile ) )
+            {
+                if( directWriter.failed == true )
+                {
+                    LogError( ( "Failed to write an earlier extent to file." ) );
+                    result = -1;
+                }
+                else if( ( ulBlockSize > directWriter.fileSize ) ||
+                         ( ulOffset > ( directWriter.fileSize - ulBlockSize ) ) )
+                {
+                    LogError( ( "Failed to write block to file: "
+                                "the block ends past the end of the file." ) );
+                    result = -1;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
 
-static OtaPalStatus_t otaPal_CheckFileSignature( OtaFileContext_t * const C )
-{
-    OtaPalMainStatus_t mainErr = OtaPalSignatureCheckFailed;
-    EVP_PKEY * pPkey = NULL;
-    EVP_MD_CTX * pSigContext = NULL;
+                while( ( result == 0 ) && ( copied < ulBlockSize ) )
+                {
+                    position = ulOffset + copied;
+                    extentOffset = position - ( position % OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE );
+                    pExtent = stageExtentLocked( extentOffset );
 
-    assert( C != NULL );
+                    if( pExtent == NULL )
+                    {
+                        result = -1;
+                    }
+                    else
+                    {
+                        /* A block can span the end of an extent. */
+                        chunkLength = OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE - ( position - extentOffset );
+                        chunkLength = ( chunkLength < ( ulBlockSize - copied ) ) ? chunkLength : ( ulBlockSize - copied );
 
-    /* Extract the signer cert from the file. */
-    pPkey = Openssl_GetPkeyFromCertificate( C->pCertFilepath );
+                        ( void ) memcpy( &pExtent->pData[ position - extentOffset ],
+                                         &pcData[ copied ],
+                                         chunkLength );
+                        pExtent->received += chunkLength;
+                        copied += chunkLength;
 
-    /* Create a new signature context for verification purpose. */
-    pSigContext = EVP_MD_CTX_new();
+                        /* A retransmitted block can make an extent look
+                         * complete early. Writing it then is harmless, as
+                         * the bytes not received were read from the file. */
+                        extentLength = directWriter.fileSize - extentOffset;
+                        extentLength = ( extentLength < OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE ) ?
+                                       extentLength : OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE;
 
-    if( ( pPkey != NULL ) && ( pSigContext != NULL ) )
-    {
-        /* Verify the signature. */
-        mainErr = Openssl_DigestVerify( pSigContext, pPkey, C->pFile, C->pSignature );
-    }
-    else
-    {
-        if( pSigContext == NULL )
-        {
-            LogError( ( "File signature check failed at NEW sig context." ) );
+                        if( ( pExtent->received >= extentLength ) &&
+                            ( flushExtentLocked( pExtent ) == false ) )
+                        {
+                            result = -1;
+                        }
+                    }
+                }
+
+                *pResult = ( result == 0 ) ? ( int32_t ) ulBlockSize : result;
+                resultSet = true;
+            }
+
+            ( void ) pthread_mutex_unlock( &directWriterMutex );
         }
-        else
+
+        return resultSet;
+    }
+
+/*-----------------------------------------------------------*/
+
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+
+        static ssize_t readReceiveFile( int fileDescriptor,
+                                        uint8_t * pBuffer,
+                                        size_t length,
+                                        uint32_t offset )
         {
-            LogError( ( "File signature check failed at EXTRACT pkey from signer certificate." ) );
-            mainErr = OtaPalBadSignerCert;
+            ssize_t readResult = -1;
+            uint32_t extentOffset = offset - ( offset % OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE );
+            size_t readLength = OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE - ( size_t ) ( offset - extentOffset );
+            const StagedExtent_t * pExtent = NULL;
+            size_t i = 0U;
+
+            readLength = ( readLength < length ) ? readLength : length;
+
+            if( pthread_mutex_lock( &directWriterMutex ) == 0 )
+            {
+                for( i = 0U; ( pExtent == NULL ) && ( i < OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT ); i++ )
+                {
+                    if( ( directWriter.extents[ i ].staged == true ) &&
+                        ( directWriter.extents[ i ].offset == extentOffset ) )
+                    {
+                        pExtent = &directWriter.extents[ i ];
+                    }
+                }
+
+                if( pExtent != NULL )
+                {
+                    ( void ) memcpy( pBuffer, &pExtent->pData[ offset - extentOffset ], readLength );
+                    readResult = ( ssize_t ) readLength;
+                }
+                else
+                {
+                    readResult = pread( fileDescriptor, pBuffer, readLength, ( off_t ) offset );
+                }
+
+                ( void ) pthread_mutex_unlock( &directWriterMutex );
+            }
+
+            return readResult;
         }
-    }
 
-    /* Free up objects */
-    EVP_MD_CTX_free( pSigContext );
-    EVP_PKEY_free( pPkey );
+    #endif /* if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 ) */
 
-    return OTA_PAL_COMBINE_ERR( mainErr, 0 );
-}
+#endif /* if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 ) */
 
-static OtaPalPathGenStatus_t getFilePathFromCWD( char * pCompleteFilePath,
-                                                 const char * pFileName )
-{
-    char * pCurrentDir = NULL;
-    OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
+/*-----------------------------------------------------------*/
 
-    /* Get current directory. */
-    pCurrentDir = getcwd( pCompleteFilePath, OTA_FILE_PATH_LENGTH_MAX - 1 );
+#if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
 
-    if( pCurrentDir == NULL )
-    {
-        LogError( ( "Failed to get current working directory: %s", strerror( errno ) ) );
-        status = OtaPalCWDFailed;
-    }
-    else
+    static void startWriteBack( const OtaFileContext_t * const C )
     {
-        /* Add the filename . */
-        if( strlen( pCompleteFilePath ) + strlen( pFileName ) + 2U > OTA_FILE_PATH_LENGTH_MAX )
+        if( pthread_mutex_lock( &writeBackMutex ) == 0 )
         {
-            LogError( ( "Insufficient space to generate file path" ) );
-            status = OtaPalBufferInsufficient;
+            ( void ) memset( &writeBack, 0, sizeof( writeBack ) );
+            writeBack.pFile = ( C != NULL ) ? C->pFile : NULL;
+
+            ( void ) pthread_mutex_unlock( &writeBackMutex );
         }
-        else
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void writeBackBlock( const OtaFileContext_t * const C,
+                                uint32_t offset,
+                                uint32_t length )
+    {
+        int fileDescriptor = -1;
+
+        if( pthread_mutex_lock( &writeBackMutex ) == 0 )
         {
-            strcat( pCompleteFilePath, "/" );
-            strcat( pCompleteFilePath, pFileName );
+            if( ( writeBack.pFile != NULL ) && ( writeBack.pFile == C->pFile ) && ( writeBack.failed == false ) )
+            {
+                /* Blocks arrive roughly in order, so the window is the range
+                 * between the blocks written since the last write-back. */
+                if( ( writeBack.windowBytes == 0U ) || ( offset < writeBack.windowStart ) )
+                {
+                    writeBack.windowStart = offset;
+                }
+
+                if( ( writeBack.windowBytes == 0U ) || ( ( offset + length ) > writeBack.windowEnd ) )
+                {
+                    writeBack.windowEnd = offset + length;
+                }
+
+                writeBack.windowBytes += length;
+
+                if( writeBack.windowBytes >= OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE )
+                {
+                    fileDescriptor = fileno( C->pFile );
+
+                    /* Start writing the window back, and then wait for the
+                     * previous one, so that the disk always has a window to
+                     * write while the blocks of the next one arrive. */
+                    if( sync_file_range( fileDescriptor,
+                                         ( off_t ) writeBack.windowStart,
+                                         ( off_t ) ( writeBack.windowEnd - writeBack.windowStart ),
+                                         SYNC_FILE_RANGE_WRITE ) != 0 )
+                    {
+                        writeBack.failed = true;
+                    }
+                    else if( ( writeBack.pendingEnd > writeBack.pendingStart ) &&
+                             ( sync_file_range( fileDescriptor,
+                                                ( off_t ) writeBack.pendingStart,
+                                                ( off_t ) ( writeBack.pendingEnd - writeBack.pendingStart ),
+                                                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER ) != 0 ) )
+                    {
+                        writeBack.failed = true;
+                    }
+                    else
+                    {
+                        writeBack.pendingStart = writeBack.windowStart;
+                        writeBack.pendingEnd = writeBack.windowEnd;
+                        writeBack.windowBytes = 0U;
+                    }
+
+                    if( writeBack.failed == true )
+                    {
+                        LogWarn( ( "Failed to write the receive file back: "
+                                   "sync_file_range returned error: "
+                                   "errno=%d. The file is written back by the kernel.", errno ) );
+                    }
+                }
+            }
+
+            ( void ) pthread_mutex_unlock( &writeBackMutex );
         }
     }
 
-    return status;
-}
+#endif /* if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 ) */
 
 /*-----------------------------------------------------------*/
 
@@ -375,6 +3302,29 @@ OtaPalStatus_t otaPal_Abort( OtaFileContext_t * const C )
 
     if( NULL != C )
     {
+        #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+            /* The queued blocks are written before the file is closed. */
+            ( void ) stopWriteBehind();
+        #endif
+
+        #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+            /* The staged extents of an aborted file are discarded. */
+            ( void ) stopDirectWriter( false );
+        #endif
+
+        #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+            startWriteBack( NULL );
+        #endif
+
+        #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+            stopStreamingDigest( C->pFile );
+        #endif
+
+        #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+            /* An aborted transfer is not resumed. */
+            stopFileProgress();
+        #endif
+
         /* Close the OTA update file if it's open. */
         if( NULL != C->pFile )
         {
@@ -415,6 +3365,7 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C )
     OtaPalStatus_t result = OTA_PAL_COMBINE_ERR( OtaPalUninitialized, 0 );
     char realFilePath[ OTA_FILE_PATH_LENGTH_MAX ];
     OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
+    bool resumed = false;
 
     if( C != NULL )
     {
@@ -431,14 +3382,67 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C )
 
             if( status == OtaPalFileGenSuccess )
             {
-                /* POSIX port using standard library */
-                /* coverity[misra_c_2012_rule_21_6_violation] */
-                C->pFile = fopen( ( const char * ) realFilePath, "w+b" );
+                #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+                    /* Continue the transfer of the file if it was interrupted
+                     * after its progress was recorded. */
+                    resumed = resumeReceiveFile( C, realFilePath );
+                #endif
+
+                if( resumed == false )
+                {
+                    /* POSIX port using standard library */
+                    /* coverity[misra_c_2012_rule_21_6_violation] */
+                    C->pFile = fopen( ( const char * ) realFilePath, "w+b" );
+                }
 
                 if( C->pFile != NULL )
                 {
-                    result = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
-                    LogInfo( ( "Receive file created." ) );
+                    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+                        result = preallocateFile( C );
+                    #else
+                        result = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+                    #endif
+
+                    if( OTA_PAL_MAIN_ERR( result ) == OtaPalSuccess )
+                    {
+                        #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+                            startDirectWriter( C, realFilePath );
+                        #endif
+
+                        #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+                            startWriteBack( C );
+                        #endif
+
+                        if( resumed == false )
+                        {
+                            #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+                                /* The blocks of a resumed file that were
+                                 * written before are hashed at close. */
+                                startStreamingDigest( C );
+                            #endif
+
+                            #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+                                startFileProgress( C, realFilePath );
+                            #endif
+
+                            LogInfo( ( "Receive file created." ) );
+                        }
+
+                        #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+                            startWriteBehind( C );
+                        #endif
+                    }
+                    else
+                    {
+                        #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+                            stopFileProgress();
+                        #endif
+
+                        /* POSIX port using standard library */
+                        /* coverity[misra_c_2012_rule_21_6_violation] */
+                        ( void ) fclose( C->pFile );
+                        C->pFile = NULL;
+                    }
                 }
                 else
                 {
@@ -468,65 +3472,184 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const C )
     return result;
 }
 
-OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const C )
+static bool stopFileWriters( void )
+{
+    bool blocksWritten = true;
+
+    #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+        /* The file is checked once the queued blocks are written. */
+        blocksWritten = stopWriteBehind();
+    #endif
+
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        /* The file is checked once the staged extents are written. */
+        if( stopDirectWriter( true ) == false )
+        {
+            blocksWritten = false;
+        }
+    #endif
+
+    #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+        startWriteBack( NULL );
+    #endif
+
+    #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+        /* The receive file is complete, or replaced by the image it
+         * contains, so its transfer is not resumed. */
+        stopFileProgress();
+    #endif
+
+    return blocksWritten;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaPalStatus_t verifyAndCloseFile( OtaFileContext_t * const C,
+                                          bool blocksWritten,
+                                          const uint8_t * pDigest,
+                                          uint32_t digestLength )
 {
     int32_t filerc = 0;
     OtaPalMainStatus_t mainErr = OtaPalSuccess;
     OtaPalSubStatus_t subErr = 0;
     OtaPalStatus_t result;
+    const uint8_t * pFileDigest = pDigest;
 
-    if( C != NULL )
+    #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) || ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+        struct stat receiveFileStatus;
+        struct stat checkedFileStatus;
+    #endif
+
+    assert( C != NULL );
+
+    if( blocksWritten == false )
+    {
+        LogError( ( "Failed to write a block to file." ) );
+        mainErr = OtaPalFileClose;
+    }
+    else if( C->pSignature != NULL )
     {
-        if( C->pSignature != NULL )
+        result = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+
+        #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) || ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+            if( ( pFileDigest != NULL ) &&
+                ( fstat( fileno( C->pFile ), &receiveFileStatus ) != 0 ) )
+            {
+                pFileDigest = NULL;
+            }
+        #endif
+
+        #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+            /* Decompress the image if the file is compressed. */
+            result = inflateGzipImage( C );
+        #endif
+
+        #if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+            if( OTA_PAL_MAIN_ERR( result ) == OtaPalSuccess )
+            {
+                /* Reconstruct the image if the file is a delta. */
+                result = applyDeltaImage( C );
+            }
+        #endif
+
+        #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) || ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+            /* The digest passed is of the file the image was decompressed or
+             * reconstructed from, if it was replaced. */
+            if( ( pFileDigest != NULL ) &&
+                ( ( fstat( fileno( C->pFile ), &checkedFileStatus ) != 0 ) ||
+                  ( checkedFileStatus.st_dev != receiveFileStatus.st_dev ) ||
+                  ( checkedFileStatus.st_ino != receiveFileStatus.st_ino ) ) )
+            {
+                pFileDigest = NULL;
+            }
+        #endif
+
+        if( OTA_PAL_MAIN_ERR( result ) == OtaPalSuccess )
         {
             /* Verify the file signature, close the file and return the signature verification result. */
-            result = otaPal_CheckFileSignature( C );
-            mainErr = OTA_PAL_MAIN_ERR( result );
-            subErr = OTA_PAL_SUB_ERR( result );
+            result = otaPal_CheckFileSignature( C, pFileDigest, digestLength );
         }
-        else
+
+        mainErr = OTA_PAL_MAIN_ERR( result );
+        subErr = OTA_PAL_SUB_ERR( result );
+    }
+    else
+    {
+        LogError( ( "Parameter check failed: OTA signature structure is NULL." ) );
+        mainErr = OtaPalSignatureCheckFailed;
+    }
+
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        /* Stop the digest if the signature was not checked. */
+        stopStreamingDigest( C->pFile );
+    #endif
+
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        /* Drop the pages the signature check read the image into, so
+         * that the image does not stay in the page cache either. */
+        if( C->pFile != NULL )
         {
-            LogError( ( "Parameter check failed: OTA signature structure is NULL." ) );
-            mainErr = OtaPalSignatureCheckFailed;
+            ( void ) posix_fadvise( fileno( C->pFile ), 0, 0, POSIX_FADV_DONTNEED );
         }
+    #endif
 
-        /* Close the file. */
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        filerc = fclose( C->pFile );
-        C->pFile = NULL;
+    /* Close the file. */
+    /* POSIX port using standard library */
+    /* coverity[misra_c_2012_rule_21_6_violation] */
+    filerc = fclose( C->pFile );
+    C->pFile = NULL;
+
+    if( filerc != 0 )
+    {
+        LogError( ( "Failed to close OTA update file." ) );
+        mainErr = OtaPalFileClose;
+        subErr = ( uint32_t ) errno;
+    }
+
+    return OTA_PAL_COMBINE_ERR( mainErr, subErr );
+}
+
+/*-----------------------------------------------------------*/
+
+static void setImageStateFromResult( OtaFileContext_t * const C,
+                                     OtaPalStatus_t result )
+{
+    if( OTA_PAL_MAIN_ERR( result ) == OtaPalSuccess )
+    {
+        LogInfo( ( "%s signature verification passed.", OTA_JsonFileSignatureKey ) );
 
-        if( filerc != 0 )
-        {
-            LogError( ( "Failed to close OTA update file." ) );
-            mainErr = OtaPalFileClose;
-            subErr = ( uint32_t ) errno;
-        }
+        ( void ) otaPal_SetPlatformImageState( C, OtaImageStateTesting );
+    }
+    else
+    {
+        LogError( ( "Failed to pass %s signature verification: %d.",
+                    OTA_JsonFileSignatureKey, result ) );
 
-        if( mainErr == OtaPalSuccess )
-        {
-            LogInfo( ( "%s signature verification passed.", OTA_JsonFileSignatureKey ) );
+        /* If we fail to verify the file signature that means the image is not valid. We need to set the image state to aborted. */
+        ( void ) otaPal_SetPlatformImageState( C, OtaImageStateAborted );
+    }
+}
 
-            ( void ) otaPal_SetPlatformImageState( C, OtaImageStateTesting );
-        }
-        else
-        {
-            LogError( ( "Failed to pass %s signature verification: %d.",
-                        OTA_JsonFileSignatureKey, OTA_PAL_COMBINE_ERR( mainErr, subErr ) ) );
+/*-----------------------------------------------------------*/
 
-            /* If we fail to verify the file signature that means the image is not valid. We need to set the image state to aborted. */
-            ( void ) otaPal_SetPlatformImageState( C, OtaImageStateAborted );
-        }
+OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const C )
+{
+    OtaPalStatus_t result;
+
+    if( C != NULL )
+    {
+        result = verifyAndCloseFile( C, stopFileWriters(), NULL, 0U );
+        setImageStateFromResult( C, result );
     }
     else /* Invalid OTA Context. */
     {
         LogError( ( "Failed to close file: "
                     "Parameter check failed: "
                     "Invalid context." ) );
-        mainErr = OtaPalFileClose;
+        result = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
     }
 
-    return OTA_PAL_COMBINE_ERR( mainErr, subErr );
+    return result;
 }
 
 int16_t otaPal_WriteBlock( OtaFileContext_t * const C,
@@ -535,37 +3658,21 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const C,
                            uint32_t ulBlockSize )
 {
     int32_t filerc = 0;
-    size_t writeSize = 0;
+    bool queued = false;
+
+    TRACE_PROBE3( ota_write_block_start, C, ulOffset, ulBlockSize );
 
     if( C != NULL )
     {
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        filerc = fseek( C->pFile, ( int64_t ) ulOffset, SEEK_SET );
-
-        if( 0 == filerc )
-        {
-            /* POSIX port using standard library */
-            /* coverity[misra_c_2012_rule_21_6_violation] */
-            writeSize = fwrite( pcData, 1, ulBlockSize, C->pFile );
-
-            if( writeSize != ulBlockSize )
-            {
-                LogError( ( "Failed to write block to file: "
-                            "fwrite returned error: "
-                            "errno=%d", errno ) );
+        #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+            /* The block is written by the writer thread while the next one
+             * is received. */
+            queued = queueBlock( C, ulOffset, pcData, ulBlockSize, &filerc );
+        #endif
 
-                filerc = -1;
-            }
-            else
-            {
-                filerc = ( int32_t ) writeSize;
-            }
-        }
-        else
+        if( queued == false )
         {
-            LogError( ( "fseek failed. fseek returned errno = %d", errno ) );
-            filerc = -1;
+            filerc = writeBlockToFile( C, ulOffset, pcData, ulBlockSize );
         }
     }
     else /* Invalid context or file pointer provided. */
@@ -574,6 +3681,8 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const C,
         filerc = -1;
     }
 
+    TRACE_PROBE2( ota_write_block_done, C, filerc );
+
     return ( int16_t ) filerc;
 }
 
@@ -591,65 +3700,77 @@ OtaPalStatus_t otaPal_SetPlatformImageState( OtaFileContext_t * const C,
                                              OtaImageState_t eState )
 {
     OtaPalMainStatus_t mainErr = OtaPalBadImageState;
-    OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
     int32_t subErr = 0;
-    FILE * pPlatformImageState = NULL;
-    char imageStateFile[ OTA_FILE_PATH_LENGTH_MAX ] = { 0 };
+
+    #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 0 )
+        OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
+        FILE * pPlatformImageState = NULL;
+        char imageStateFile[ OTA_FILE_PATH_LENGTH_MAX ] = { 0 };
+    #endif
 
     ( void ) C;
 
     if( ( eState != OtaImageStateUnknown ) && ( eState <= OtaLastImageState ) )
     {
-        /* Get file path for the image state file. */
-        status = getFilePathFromCWD( imageStateFile, OTA_PLATFORM_IMAGE_STATE_FILE );
+        #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+            subErr = setStoredImageState( eState );
 
-        if( status == OtaPalFileGenSuccess )
-        {
-            /* POSIX port using standard library */
-            /* coverity[misra_c_2012_rule_21_6_violation] */
-            pPlatformImageState = fopen( imageStateFile, "w+b" );
-        }
-        else
-        {
-            LogError( ( "Could not generate the absolute path for the file" ) );
-        }
+            if( subErr == 0 )
+            {
+                mainErr = OtaPalSuccess;
+            }
+        #else
+            /* Get file path for the image state file. */
+            status = getFilePathFromCWD( imageStateFile, OTA_PLATFORM_IMAGE_STATE_FILE );
 
-        if( pPlatformImageState != NULL )
-        {
-            /* Write the image state to PlatformImageState.txt. */
-            /* POSIX port using standard library */
-            /* coverity[misra_c_2012_rule_21_6_violation] */
-            if( 1UL == fwrite( &eState, sizeof( OtaImageState_t ), 1, pPlatformImageState ) )
+            if( status == OtaPalFileGenSuccess )
+            {
+                /* POSIX port using standard library */
+                /* coverity[misra_c_2012_rule_21_6_violation] */
+                pPlatformImageState = fopen( imageStateFile, "w+b" );
+            }
+            else
+            {
+                LogError( ( "Could not generate the absolute path for the file" ) );
+            }
+
+            if( pPlatformImageState != NULL )
             {
-                /* Close PlatformImageState.txt. */
+                /* Write the image state to PlatformImageState.txt. */
                 /* POSIX port using standard library */
                 /* coverity[misra_c_2012_rule_21_6_violation] */
-                if( 0 == fclose( pPlatformImageState ) )
+                if( 1UL == fwrite( &eState, sizeof( OtaImageState_t ), 1, pPlatformImageState ) )
                 {
-                    mainErr = OtaPalSuccess;
+                    /* Close PlatformImageState.txt. */
+                    /* POSIX port using standard library */
+                    /* coverity[misra_c_2012_rule_21_6_violation] */
+                    if( 0 == fclose( pPlatformImageState ) )
+                    {
+                        mainErr = OtaPalSuccess;
+                    }
+                    else
+                    {
+                        LogError( ( "Unable to close image state file." ) );
+                        subErr = errno;
+                    }
                 }
                 else
                 {
-                    LogError( ( "Unable to close image state file." ) );
+                    LogError( ( "Unable to write to image state file. error-- %d", errno ) );
                     subErr = errno;
+
+                    /* The file should be closed, but errno passed out is fwrite error */
+                    /* POSIX port using standard library */
+                    /* coverity[misra_c_2012_rule_21_6_violation] */
+                    ( void ) fclose( pPlatformImageState );
                 }
             }
             else
             {
-                LogError( ( "Unable to write to image state file. error-- %d", errno ) );
+                LogError( ( "Unable to open image state file. Path: %s error: %s", imageStateFile, strerror( errno ) ) );
                 subErr = errno;
-
-                /* The file should be closed, but errno passed out is fwrite error */
-                /* POSIX port using standard library */
-                /* coverity[misra_c_2012_rule_21_6_violation] */
-                ( void ) fclose( pPlatformImageState );
             }
-        }
-        else
-        {
-            LogError( ( "Unable to open image state file. Path: %s error: %s", imageStateFile, strerror( errno ) ) );
-            subErr = errno;
-        }
+        #endif /* if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 ) */
     }
     else /* Image state invalid. */
     {
@@ -682,70 +3803,359 @@ OtaPalStatus_t otaPal_ResetDevice( OtaFileContext_t * const C )
  */
 OtaPalImageState_t otaPal_GetPlatformImageState( OtaFileContext_t * const C )
 {
-    FILE * pPlatformImageState = NULL;
     OtaImageState_t eSavedAgentState = OtaImageStateUnknown;
     OtaPalImageState_t ePalState = OtaPalImageStateUnknown;
-    OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
-    char imageStateFile[ OTA_FILE_PATH_LENGTH_MAX ] = { 0 };
+
+    #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 0 )
+        FILE * pPlatformImageState = NULL;
+        OtaPalPathGenStatus_t status = OtaPalFileGenSuccess;
+        char imageStateFile[ OTA_FILE_PATH_LENGTH_MAX ] = { 0 };
+    #endif
 
     ( void ) C;
 
-    /* Get file path for the image state file. */
-    status = getFilePathFromCWD( imageStateFile, OTA_PLATFORM_IMAGE_STATE_FILE );
+    #if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 )
+        eSavedAgentState = getStoredImageState();
 
-    if( status != OtaPalFileGenSuccess )
-    {
-        LogError( ( "Could not generate the absolute path for the file" ) );
-        ePalState = OtaPalImageStateInvalid;
-    }
-    else
-    {
-        /* POSIX port using standard library */
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        pPlatformImageState = fopen( imageStateFile, "r+b" );
+        if( eSavedAgentState == OtaImageStateUnknown )
+        {
+            /* If no image state was stored, assume a factory image. */
+            ePalState = OtaPalImageStateValid;
+        }
+        else if( eSavedAgentState == OtaImageStateTesting )
+        {
+            ePalState = OtaPalImageStatePendingCommit;
+        }
+        else if( eSavedAgentState == OtaImageStateAccepted )
+        {
+            ePalState = OtaPalImageStateValid;
+        }
+        else
+        {
+            ePalState = OtaPalImageStateInvalid;
+        }
+    #else
+        /* Get file path for the image state file. */
+        status = getFilePathFromCWD( imageStateFile, OTA_PLATFORM_IMAGE_STATE_FILE );
 
-        if( pPlatformImageState != NULL )
+        if( status != OtaPalFileGenSuccess )
+        {
+            LogError( ( "Could not generate the absolute path for the file" ) );
+            ePalState = OtaPalImageStateInvalid;
+        }
+        else
         {
             /* POSIX port using standard library */
             /* coverity[misra_c_2012_rule_21_6_violation] */
-            if( 1U != fread( &eSavedAgentState, sizeof( OtaImageState_t ), 1, pPlatformImageState ) )
+            pPlatformImageState = fopen( imageStateFile, "r+b" );
+
+            if( pPlatformImageState != NULL )
             {
-                /* If an error occurred reading the file, mark the state as aborted. */
-                LogError( ( "Failed to read image state file." ) );
-                ePalState = OtaPalImageStateInvalid;
+                /* POSIX port using standard library */
+                /* coverity[misra_c_2012_rule_21_6_violation] */
+                if( 1U != fread( &eSavedAgentState, sizeof( OtaImageState_t ), 1, pPlatformImageState ) )
+                {
+                    /* If an error occurred reading the file, mark the state as aborted. */
+                    LogError( ( "Failed to read image state file." ) );
+                    ePalState = OtaPalImageStateInvalid;
+                }
+                else
+                {
+                    if( eSavedAgentState == OtaImageStateTesting )
+                    {
+                        ePalState = OtaPalImageStatePendingCommit;
+                    }
+                    else if( eSavedAgentState == OtaImageStateAccepted )
+                    {
+                        ePalState = OtaPalImageStateValid;
+                    }
+                    else
+                    {
+                        ePalState = OtaPalImageStateInvalid;
+                    }
+                }
+
+                /* POSIX port using standard library */
+                /* coverity[misra_c_2012_rule_21_6_violation] */
+                if( 0 != fclose( pPlatformImageState ) )
+                {
+                    LogError( ( "Failed to close image state file." ) );
+                    ePalState = OtaPalImageStateInvalid;
+                }
             }
             else
             {
-                if( eSavedAgentState == OtaImageStateTesting )
+                /* If no image state file exists, assume a factory image. */
+                ePalState = OtaPalImageStateValid; /*lint !e64 Allow assignment. */
+            }
+        }
+    #endif /* if ( OTA_PAL_POSIX_STATE_STORE_ENABLED == 1 ) */
+
+    return ePalState;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+
+    static bool prepareVerifyJob( OtaFileContext_t * const C,
+                                  VerifyJob_t * pJob )
+    {
+        pJob->blocksWritten = stopFileWriters();
+        pJob->digestLength = 0U;
+
+        #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+            /* The digest is finished now, as the next file restarts it. */
+            if( ( pJob->blocksWritten == true ) &&
+                ( finishStreamingDigest( C, pJob->digest, &pJob->digestLength ) == false ) )
+            {
+                pJob->digestLength = 0U;
+            }
+        #endif
+
+        ( void ) memcpy( &pJob->context, C, sizeof( pJob->context ) );
+        pJob->detached = ( ( ( C->pFilePath == NULL ) ||
+                             ( strlen( ( const char * ) C->pFilePath ) < sizeof( pJob->filePath ) ) ) &&
+                           ( ( C->pCertFilepath == NULL ) ||
+                             ( strlen( ( const char * ) C->pCertFilepath ) < sizeof( pJob->certFilePath ) ) ) );
+
+        if( pJob->detached == true )
+        {
+            if( C->pFilePath != NULL )
+            {
+                ( void ) strcpy( ( char * ) pJob->filePath, ( const char * ) C->pFilePath );
+            }
+
+            if( C->pCertFilepath != NULL )
+            {
+                ( void ) strcpy( ( char * ) pJob->certFilePath, ( const char * ) C->pCertFilepath );
+            }
+
+            if( C->pSignature != NULL )
+            {
+                ( void ) memcpy( &pJob->signature, C->pSignature, sizeof( pJob->signature ) );
+            }
+        }
+        else
+        {
+            LogWarn( ( "The path of the file is too long to be copied: "
+                       "The file is verified before it is closed." ) );
+        }
+
+        /* The file is closed by the job. */
+        C->pFile = NULL;
+
+        return pJob->detached;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void runVerifyJob( VerifyJob_t * pJob )
+    {
+        OtaPalStatus_t result;
+        const uint8_t * pDigest = NULL;
+
+        if( pJob->detached == true )
+        {
+            /* The copies are pointed to once the job is in its final place. */
+            if( pJob->context.pFilePath != NULL )
+            {
+                pJob->context.pFilePath = pJob->filePath;
+            }
+
+            if( pJob->context.pCertFilepath != NULL )
+            {
+                pJob->context.pCertFilepath = pJob->certFilePath;
+            }
+
+            if( pJob->context.pSignature != NULL )
+            {
+                pJob->context.pSignature = &pJob->signature;
+            }
+        }
+
+        if( pJob->digestLength > 0U )
+        {
+            pDigest = pJob->digest;
+        }
+
+        result = verifyAndCloseFile( &pJob->context, pJob->blocksWritten, pDigest, pJob->digestLength );
+
+        ( void ) pthread_mutex_lock( &verifyPoolMutex );
+
+        if( ( OTA_PAL_MAIN_ERR( result ) == OtaPalSuccess ) &&
+            ( verifyPool.bundleFailed == true ) )
+        {
+            LogWarn( ( "%s signature verification passed, "
+                       "but another file of the update failed it.", OTA_JsonFileSignatureKey ) );
+        }
+        else
+        {
+            if( OTA_PAL_MAIN_ERR( result ) != OtaPalSuccess )
+            {
+                verifyPool.bundleFailed = true;
+            }
+
+            setImageStateFromResult( &pJob->context, result );
+        }
+
+        ( void ) pthread_mutex_unlock( &verifyPoolMutex );
+
+        pJob->callback( &pJob->context, result, pJob->pUserContext );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool startVerifyWorkersLocked( void )
+    {
+        bool started = true;
+
+        if( verifyPool.threadCount == 0U )
+        {
+            verifyPool.stop = false;
+            verifyPool.head = 0U;
+            verifyPool.count = 0U;
+
+            while( ( started == true ) &&
+                   ( verifyPool.threadCount < OTA_PAL_POSIX_VERIFY_THREADS ) )
+            {
+                if( pthread_create( &verifyPool.threads[ verifyPool.threadCount ], NULL, verifyWorkerThread, NULL ) == 0 )
                 {
-                    ePalState = OtaPalImageStatePendingCommit;
+                    verifyPool.threadCount++;
                 }
-                else if( eSavedAgentState == OtaImageStateAccepted )
+                else
                 {
-                    ePalState = OtaPalImageStateValid;
+                    started = false;
                 }
-                else
+            }
+
+            if( verifyPool.threadCount == 0U )
+            {
+                LogWarn( ( "Failed to start the verify threads: "
+                           "Files are verified as they are closed." ) );
+            }
+        }
+
+        return( verifyPool.threadCount > 0U );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void * verifyWorkerThread( void * pArgs )
+    {
+        VerifyJob_t job;
+        bool stopped = false;
+
+        ( void ) pArgs;
+
+        ( void ) pthread_mutex_lock( &verifyPoolMutex );
+
+        while( stopped == false )
+        {
+            if( verifyPool.count > 0U )
+            {
+                ( void ) memcpy( &job, &verifyPool.jobs[ verifyPool.head ], sizeof( job ) );
+                verifyPool.head = ( verifyPool.head + 1U ) % OTA_PAL_POSIX_VERIFY_QUEUE_LENGTH;
+                verifyPool.count--;
+                ( void ) pthread_cond_broadcast( &verifyPoolCondition );
+                ( void ) pthread_mutex_unlock( &verifyPoolMutex );
+
+                runVerifyJob( &job );
+
+                ( void ) pthread_mutex_lock( &verifyPoolMutex );
+            }
+            else if( verifyPool.stop == true )
+            {
+                stopped = true;
+            }
+            else
+            {
+                ( void ) pthread_cond_wait( &verifyPoolCondition, &verifyPoolMutex );
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &verifyPoolMutex );
+
+        return NULL;
+    }
+
+/*-----------------------------------------------------------*/
+
+    OtaPalStatus_t otaPal_CloseFileAsync( OtaFileContext_t * const C,
+                                          OtaPalVerifyCallback_t callback,
+                                          void * pUserContext )
+    {
+        OtaPalMainStatus_t mainErr = OtaPalSuccess;
+        VerifyJob_t job;
+        bool queued = false;
+
+        if( ( C != NULL ) && ( callback != NULL ) )
+        {
+            job.callback = callback;
+            job.pUserContext = pUserContext;
+
+            if( prepareVerifyJob( C, &job ) == true )
+            {
+                ( void ) pthread_mutex_lock( &verifyPoolMutex );
+
+                if( startVerifyWorkersLocked() == true )
                 {
-                    ePalState = OtaPalImageStateInvalid;
+                    while( verifyPool.count == OTA_PAL_POSIX_VERIFY_QUEUE_LENGTH )
+                    {
+                        ( void ) pthread_cond_wait( &verifyPoolCondition, &verifyPoolMutex );
+                    }
+
+                    ( void ) memcpy( &verifyPool.jobs[ ( verifyPool.head + verifyPool.count ) %
+                                                       OTA_PAL_POSIX_VERIFY_QUEUE_LENGTH ],
+                                     &job,
+                                     sizeof( job ) );
+                    verifyPool.count++;
+                    ( void ) pthread_cond_broadcast( &verifyPoolCondition );
+                    queued = true;
                 }
+
+                ( void ) pthread_mutex_unlock( &verifyPoolMutex );
             }
 
-            /* POSIX port using standard library */
-            /* coverity[misra_c_2012_rule_21_6_violation] */
-            if( 0 != fclose( pPlatformImageState ) )
+            if( queued == false )
             {
-                LogError( ( "Failed to close image state file." ) );
-                ePalState = OtaPalImageStateInvalid;
+                runVerifyJob( &job );
             }
         }
         else
         {
-            /* If no image state file exists, assume a factory image. */
-            ePalState = OtaPalImageStateValid; /*lint !e64 Allow assignment. */
+            LogError( ( "Failed to close file: "
+                        "Parameter check failed: "
+                        "Invalid context or callback." ) );
+            mainErr = OtaPalFileClose;
         }
-    }
 
-    return ePalState;
-}
+        return OTA_PAL_COMBINE_ERR( mainErr, 0 );
+    }
 
 /*-----------------------------------------------------------*/
+
+    void otaPal_WaitForVerifications( void )
+    {
+        size_t threadCount = 0U;
+        size_t i = 0U;
+
+        ( void ) pthread_mutex_lock( &verifyPoolMutex );
+        verifyPool.stop = true;
+        threadCount = verifyPool.threadCount;
+        ( void ) pthread_cond_broadcast( &verifyPoolCondition );
+        ( void ) pthread_mutex_unlock( &verifyPoolMutex );
+
+        for( i = 0U; i < threadCount; i++ )
+        {
+            ( void ) pthread_join( verifyPool.threads[ i ], NULL );
+        }
+
+        ( void ) pthread_mutex_lock( &verifyPoolMutex );
+        verifyPool.threadCount = 0U;
+        /* The next files are of another update. */
+        verifyPool.bundleFailed = false;
+        ( void ) pthread_mutex_unlock( &verifyPoolMutex );
+    }
+
+#endif /* if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 ) */
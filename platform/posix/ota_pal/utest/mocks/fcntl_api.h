@@ -0,0 +1,48 @@
+/*
+ * OTA PAL V2.0.0 (Release Candidate) for POSIX
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file fcntl_api.h
+ * @brief This file is used to generate mocks for functions used from <fcntl.h>.
+ * Mocking fcntl.h itself causes several errors from parsing its macros.
+ */
+
+#ifndef FCNTL_API_H
+#define FCNTL_API_H
+
+#include <sys/types.h>
+
+extern int posix_fallocate( int fd,
+                            off_t offset,
+                            off_t len );
+
+extern int posix_fadvise( int fd,
+                          off_t offset,
+                          off_t len,
+                          int advice );
+
+extern int sync_file_range( int fd,
+                            off_t offset,
+                            off_t nbytes,
+                            unsigned int flags );
+
+#endif /* ifndef FCNTL_API_H */
@@ -123,8 +123,39 @@ extern void EVP_MD_CTX_free( EVP_MD_CTX * ctx );
 
 extern void EVP_PKEY_free( EVP_PKEY * pkey );
 
+extern int EVP_PKEY_up_ref( EVP_PKEY * pkey );
+
 extern const EVP_MD * EVP_sha256( void );
 
+extern int EVP_DigestInit_ex( EVP_MD_CTX * ctx,
+                              const EVP_MD * type,
+                              ENGINE * impl );
+
+extern int EVP_DigestFinal_ex( EVP_MD_CTX * ctx,
+                               unsigned char * md,
+                               unsigned int * s );
+
+extern EVP_PKEY_CTX * EVP_PKEY_CTX_new( EVP_PKEY * pkey,
+                                        ENGINE * e );
+
+extern int EVP_PKEY_verify_init( EVP_PKEY_CTX * ctx );
+
+/* EVP_PKEY_CTX_set_signature_md is a macro define for EVP_PKEY_CTX_ctrl. */
+extern int EVP_PKEY_CTX_ctrl( EVP_PKEY_CTX * ctx,
+                              int keytype,
+                              int optype,
+                              int cmd,
+                              int p1,
+                              void * p2 );
+
+extern int EVP_PKEY_verify( EVP_PKEY_CTX * ctx,
+                            const unsigned char * sig,
+                            size_t siglen,
+                            const unsigned char * tbs,
+                            size_t tbslen );
+
+extern void EVP_PKEY_CTX_free( EVP_PKEY_CTX * ctx );
+
 /* Function declarations for functions in the OpenSSL crypto.h header file. */
 extern void CRYPTO_free( void * ptr,
                          const char * file,
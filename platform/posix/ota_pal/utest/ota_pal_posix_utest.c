@@ -31,8 +31,11 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <malloc.h>
 
 #include <sys/stat.h>
+#include <pthread.h>
 #include "unity.h"
 
 /* For accessing OTA private functions. */
@@ -41,19 +44,236 @@
 #include "mock_stdio_api.h"
 #include "mock_openssl_api.h"
 #include "mock_unistd_api.h"
+#include "mock_fcntl_api.h"
+#include "mock_stdlib_api.h"
 
-/* errno error macro. errno.h can't be included in this file due to mocking. */
+/* errno error macros. errno.h can't be included in this file due to mocking. */
 #define ENOENT    0x02
+#define EIO       0x05
+#define ENOMEM    0x0C
+#define ENOSPC    0x1C
+
+/* Flags of sync_file_range from fcntl.h. */
+#define SYNC_FILE_RANGE_WAIT_BEFORE    0x01
+#define SYNC_FILE_RANGE_WRITE          0x02
+#define SYNC_FILE_RANGE_WAIT_AFTER     0x04
+
+/**
+ * @brief The receive file of the tests writing a real file. The path is
+ * relative, so the file is created in the working directory of the OTA PAL.
+ */
+#define OTA_PAL_TEST_FILE_PATH            "ota_pal_posix_utest_image.bin"
+
+/**
+ * @brief The image state file written by the OTA PAL.
+ */
+#define OTA_PAL_TEST_IMAGE_STATE_FILE     "PlatformImageState.txt"
+
+/**
+ * @brief A signer certificate file of #testDirectory.
+ */
+#define OTA_PAL_TEST_CERT_FILE            "ota_pal_posix_utest_cert.pem"
+
+/**
+ * @brief A second receive file of #testDirectory, closed while the first one
+ * is verified.
+ */
+#define OTA_PAL_TEST_SECOND_FILE_PATH     "ota_pal_posix_utest_image_2.bin"
+
+/**
+ * @brief The working directory of the OTA PAL in the tests writing a real
+ * file. Each test gets its own, as the variants of this test may run at the
+ * same time.
+ */
+static char testDirectory[] = "ota_pal_posix_utest_XXXXXX";
+
+/**
+ * @brief The files the tests may leave in #testDirectory.
+ */
+static const char * const testFileNames[] =
+{
+    OTA_PAL_TEST_FILE_PATH,
+    OTA_PAL_TEST_IMAGE_STATE_FILE,
+    OTA_PAL_TEST_CERT_FILE,
+    OTA_PAL_TEST_SECOND_FILE_PATH,
+    OTA_PAL_TEST_FILE_PATH ".patched",
+    OTA_PAL_TEST_FILE_PATH ".inflated"
+};
+
+/**
+ * @brief The bytes passed to the digest by the signature check.
+ */
+static uint8_t digestedBytes[ 512 ];
+
+/**
+ * @brief The number of bytes passed to the digest by the signature check.
+ */
+static size_t digestedLength = 0U;
+
+/**
+ * @brief The digest returned by the mocked EVP_DigestFinal_ex.
+ */
+static const uint8_t streamedDigest[ 32 ] = { 0xDE, 0xAD, 0xBE, 0xEF };
+
+/**
+ * @brief The end of the paths failOpenBySuffix() fails to open.
+ */
+static const char * failedOpenSuffix = "";
+
+/**
+ * @brief The number of buffers allocated by allocateAlignedBuffer().
+ */
+static size_t alignedAllocations;
+
+/**
+ * @brief A range of a file passed to sync_file_range().
+ */
+typedef struct FileRange
+{
+    off_t offset;
+    off_t nbytes;
+    unsigned int flags;
+} FileRange_t;
+
+/**
+ * @brief The ranges passed to recordFileRange().
+ */
+static FileRange_t fileRanges[ 4 ];
+
+/**
+ * @brief The number of calls to recordFileRange().
+ */
+static int fileRangeCount;
+
+/**
+ * @brief The call to recordFileRange() that fails; -1 if none does.
+ */
+static int failedFileRangeCall;
+
+/**
+ * @brief The thread running the test.
+ */
+static pthread_t testThread;
+
+/**
+ * @brief The results passed to recordVerification().
+ */
+static OtaPalStatus_t verifiedResults[ 4 ];
+
+/**
+ * @brief The number of calls to recordVerification().
+ */
+static size_t verifiedCount;
+
+/**
+ * @brief The path of the file of the last call to recordVerification().
+ */
+static char verifiedFilePath[ OTA_FILE_PATH_LENGTH_MAX ];
+
+/**
+ * @brief Set by recordVerification() if the file it was called with was
+ * still open.
+ */
+static bool verifiedFileOpen;
+
+/**
+ * @brief Set by recordVerification() if it was called on #testThread.
+ */
+static bool verifiedOnTestThread;
+
+#if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+
+/**
+ * @brief The image compressed in #gzipImage.
+ */
+    static const uint8_t gzipImageData[] = { 'O', 'T', 'A', ' ', 'P', 'A', 'L', ' ', 'g', 'z', 'i', 'p', ' ', 'i', 'm', 'a', 'g', 'e' };
+
+/**
+ * @brief #gzipImageData compressed with gzip.
+ */
+    static const uint8_t gzipImage[] =
+    {
+        0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xF3, 0x0F, 0x71, 0x54, 0x08, 0x70,
+        0xF4, 0x51, 0x48, 0xAF, 0xCA, 0x2C, 0x50, 0xC8, 0xCC, 0x4D, 0x4C, 0x4F, 0x05, 0x00, 0x6E, 0xA4,
+        0x09, 0x9F, 0x12, 0x00, 0x00, 0x00
+    };
+#endif /* if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 ) */
 
 /* ============================   UNITY FIXTURES ============================ */
 
+static void OTA_PAL_TestFilePath( const char * pFileName,
+                                  char * pFilePath );
+static int allocateAlignedBuffer( void ** ppBuffer,
+                                  size_t alignment,
+                                  size_t size,
+                                  int numCalls );
+static int recordFileRange( int fd,
+                            off_t offset,
+                            off_t nbytes,
+                            unsigned int flags,
+                            int numCalls );
+
 void setUp( void )
 {
     /* Always reset the OTA file context before each test. */
+    digestedLength = 0U;
+    ( void ) strcpy( testDirectory, "ota_pal_posix_utest_XXXXXX" );
+    TEST_ASSERT_NOT_NULL( mkdtemp( testDirectory ) );
+
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        /* The O_DIRECT writer allocates its buffers in every test creating a
+         * receive file. */
+        alignedAllocations = 0U;
+        posix_memalign_Stub( allocateAlignedBuffer );
+    #endif
+
+    #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+        /* The receive file is written back in every test writing a window
+         * of blocks. */
+        fileRangeCount = 0;
+        failedFileRangeCall = -1;
+        sync_file_range_Stub( recordFileRange );
+    #endif
+
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        /* Free the key cached by the previous test. */
+        otaPal_FreeSignerKeyCache();
+    #endif
+
+    #if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+        testThread = pthread_self();
+        verifiedCount = 0U;
+        verifiedFileOpen = false;
+        verifiedOnTestThread = false;
+    #endif
 }
 
 void tearDown( void )
 {
+    char filePath[ OTA_FILE_PATH_LENGTH_MAX ];
+    size_t i;
+
+    #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+        OtaFileContext_t closedFileContext;
+
+        /* Stop the writer thread of a receive file left open by the test. */
+        ( void ) memset( &closedFileContext, 0, sizeof( closedFileContext ) );
+        ( void ) otaPal_Abort( &closedFileContext );
+    #endif
+
+    #if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+        /* Stop the worker threads started by the test. */
+        otaPal_WaitForVerifications();
+    #endif
+
+    /* Remove the files written by the tests using real files. */
+    for( i = 0U; i < ( sizeof( testFileNames ) / sizeof( testFileNames[ 0 ] ) ); i++ )
+    {
+        OTA_PAL_TestFilePath( testFileNames[ i ], filePath );
+        ( void ) remove( filePath );
+    }
+
+    ( void ) remove( testDirectory );
 }
 
 /* ==========================   HELPER FUNCTIONS   ========================== */
@@ -75,6 +295,7 @@ typedef enum
     EVP_DigestVerifyFinal_fn,
     EVP_MD_CTX_free_fn,
     EVP_PKEY_free_fn,
+    EVP_PKEY_up_ref_fn,
     EVP_sha256_fn,
     OPENSSL_malloc_fn,
     CRYPTO_free_fn,
@@ -203,6 +424,11 @@ static void OTA_PAL_FailSingleMock_openssl_X509( MockFunctionNames_t funcToFail
     X509_get_pubkey_IgnoreAndReturn( X509_get_pubkey_return );
 
     X509_free_Ignore();
+
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        /* Load the key from the mocked certificate at the next check. */
+        otaPal_FreeSignerKeyCache();
+    #endif
 }
 
 static void OTA_PAL_FailSingleMock_openssl_EVP( MockFunctionNames_t funcToFail )
@@ -225,6 +451,10 @@ static void OTA_PAL_FailSingleMock_openssl_EVP( MockFunctionNames_t funcToFail )
     int EVP_DigestVerifyFinal_success = 1;
     int EVP_DigestVerifyFinal_failure = -1;
     int EVP_DigestVerifyFinal_return;
+    /* EVP_PKEY_up_ref_fn: Return 1 for success and 0 for failure. */
+    int EVP_PKEY_up_ref_success = 1;
+    int EVP_PKEY_up_ref_failure = 0;
+    int EVP_PKEY_up_ref_return;
 
     /* EVP_MD_CTX_free_fn: No return. */
     /* EVP_PKEY_free_fn: No return. */
@@ -246,6 +476,9 @@ static void OTA_PAL_FailSingleMock_openssl_EVP( MockFunctionNames_t funcToFail )
 
     EVP_PKEY_free_Ignore();
 
+    EVP_PKEY_up_ref_return = ( funcToFail == EVP_PKEY_up_ref_fn ) ? EVP_PKEY_up_ref_failure : EVP_PKEY_up_ref_success;
+    EVP_PKEY_up_ref_IgnoreAndReturn( EVP_PKEY_up_ref_return );
+
     EVP_sha256_IgnoreAndReturn( &dummyEVP_MD );
 }
 
@@ -351,219 +584,792 @@ static void OTA_PAL_FailSingleMock( MockFunctionNames_t funcToFail,
     OTA_PAL_FailSingleMock_unistd( funcToFail );
 }
 
-/* ======================   OTA PAL ABORT UNIT TESTS   ====================== */
+/* fopen, fclose, fread, feof, fseek, fwrite and getcwd are mocked, so the
+ * stubs below back them with the functions of the C library that are not.
+ * This lets the tests of the modes writing the receive file through its file
+ * descriptor check what the OTA PAL reads back from it. */
 
-/**
- * @brief Test that otaPal_Abort will return correct result code.
- */
-void test_OTAPAL_Abort_NullFileContext( void )
+static FILE * openStream( const char * pFileName,
+                          const char * pMode,
+                          int numCalls )
 {
-    OtaPalMainStatus_t result;
+    /* The stream is reopened to the path, as it can't be closed: fclose is
+     * mocked, so the streams of a test are left open until it exits. */
+    FILE * pStream = tmpfile();
 
-    result = OTA_PAL_MAIN_ERR( otaPal_Abort( NULL ) );
+    ( void ) numCalls;
 
-    TEST_ASSERT_EQUAL( OtaPalFileAbort, result );
+    if( pStream != NULL )
+    {
+        pStream = freopen( pFileName, pMode, pStream );
+    }
+
+    return pStream;
 }
 
+static FILE * openWriteOnlyStream( const char * pFileName,
+                                   const char * pMode,
+                                   int numCalls )
+{
+    /* The file descriptor of the stream can't be read from. */
+    ( void ) pMode;
 
-/**
- * @brief Test that otaPal_Abort will return correct result code.
- */
-void test_OTAPAL_Abort_NullFileHandle( void )
+    return openStream( pFileName, "wb", numCalls );
+}
+
+static FILE * failOpenBySuffix( const char * pFileName,
+                                const char * pMode,
+                                int numCalls )
 {
-    OtaPalMainStatus_t result;
-    OtaFileContext_t testFileContext;
+    FILE * pStream = NULL;
+    size_t nameLength = strlen( pFileName );
+    size_t suffixLength = strlen( failedOpenSuffix );
 
-    testFileContext.pFile = NULL;
-    result = OTA_PAL_MAIN_ERR( otaPal_Abort( &testFileContext ) );
+    if( ( nameLength < suffixLength ) ||
+        ( strcmp( &pFileName[ nameLength - suffixLength ], failedOpenSuffix ) != 0 ) )
+    {
+        pStream = openStream( pFileName, pMode, numCalls );
+    }
 
-    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+    return pStream;
 }
 
-/**
- * @brief Test that otaPal_Abort will return correct result code.
- */
-void test_OTAPAL_Abort_ValidFileHandle( void )
+static int closeStream( FILE * pStream,
+                        int numCalls )
 {
-    OtaPalMainStatus_t result;
-    FILE placeholder_file;
-    OtaFileContext_t testFileContext;
+    ( void ) numCalls;
 
-    testFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
-    testFileContext.pFile = &placeholder_file;
+    return fflush( pStream );
+}
 
-    fclose_ExpectAnyArgsAndReturn( 0 );
+static size_t readStream( void * pBuffer,
+                          size_t size,
+                          size_t count,
+                          FILE * pStream,
+                          int numCalls )
+{
+    ( void ) numCalls;
 
-    result = OTA_PAL_MAIN_ERR( otaPal_Abort( &testFileContext ) );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+    return fread_unlocked( pBuffer, size, count, pStream );
 }
 
-/**
- * @brief Test that otaPal_Abort will return correct result code.
- */
-void test_OTAPAL_Abort_FileCloseFail( void )
+static int streamAtEnd( FILE * pStream,
+                        int numCalls )
 {
-    OtaPalMainStatus_t result;
-    OtaFileContext_t testFileContext;
-    FILE dummyFile;
+    ( void ) numCalls;
 
-    testFileContext.pFilePath = ( uint8_t * ) "placeholder";
-    testFileContext.pFile = &dummyFile;
+    return feof_unlocked( pStream );
+}
 
-    fclose_ExpectAnyArgsAndReturn( EOF );
+static int seekStream( FILE * pStream,
+                       long int offset,
+                       int whence,
+                       int numCalls )
+{
+    ( void ) numCalls;
 
-    result = otaPal_Abort( &testFileContext );
-    TEST_ASSERT_EQUAL( OtaPalFileAbort, OTA_PAL_MAIN_ERR( result ) );
+    return fseeko( pStream, offset, whence );
 }
 
-/* ===================   OTA PAL CREATE FILE UNIT TESTS   =================== */
-
-/**
- * @brief Test that otaPal_CreateFileForRx will return correct result code.
- */
-void test_OTAPAL_CreateFileForRx_NullFileContext( void )
+static size_t writeStream( const void * pBuffer,
+                           size_t size,
+                           size_t count,
+                           FILE * pStream,
+                           int numCalls )
 {
-    OtaPalMainStatus_t result;
+    ( void ) numCalls;
 
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( NULL ) );
-    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+    return fwrite_unlocked( pBuffer, size, count, pStream );
 }
 
-
-/**
- * @brief Test that otaPal_CreateFileForRx will return correct result code.
- */
-void test_OTAPAL_CreateFileForRx_NullFilePath( void )
+static char * getWorkingDirectory( char * pBuffer,
+                                   size_t size,
+                                   int numCalls )
 {
-    OtaPalMainStatus_t result;
-    OtaFileContext_t testFile;
+    char * pResult = NULL;
+    char * pPath = realpath( testDirectory, NULL );
 
-    testFile.pFilePath = NULL;
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &testFile ) );
+    ( void ) numCalls;
 
-    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+    if( ( pPath != NULL ) && ( strlen( pPath ) < size ) )
+    {
+        ( void ) strcpy( pBuffer, pPath );
+        pResult = pBuffer;
+    }
+
+    free( pPath );
+
+    return pResult;
 }
 
-/**
- * @brief Test that otaPal_CreateFileForRx will return correct result code.
- */
-void test_OTAPAL_CreateFileForRx_FailedToCreateFile( void )
+static void * allocateBuffer( size_t size,
+                              const char * pFile,
+                              int line,
+                              int numCalls )
 {
-    OtaPalMainStatus_t result;
-    FILE placeholder_file;
-    OtaFileContext_t testFile;
+    ( void ) pFile;
+    ( void ) line;
+    ( void ) numCalls;
 
-    testFile.pFilePath = ( uint8_t * ) "placeholder_path";
-    testFile.pFile = &placeholder_file;
-
-    fopen_ExpectAnyArgsAndReturn( NULL );
-    OTA_PAL_FailSingleMock_unistd( none_fn );
-    /* Create a file that exists with w+b mode */
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &testFile ) );
-    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+    return malloc( size );
 }
 
-/**
- * @brief Test that otaPal_CreateFileForRx will return correct result code.
- */
-void test_OTAPAL_CreateFileForRx_ValidFileHandle( void )
+static int allocateAlignedBuffer( void ** ppBuffer,
+                                  size_t alignment,
+                                  size_t size,
+                                  int numCalls )
 {
-    OtaPalMainStatus_t result;
-    FILE placeholder_file;
-    OtaFileContext_t otaFileContext;
+    ( void ) numCalls;
 
-    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
+    *ppBuffer = memalign( alignment, size );
+    alignedAllocations++;
 
-    OTA_PAL_FailSingleMock_unistd( none_fn );
-    fopen_ExpectAnyArgsAndReturn( &placeholder_file );
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+    return ( *ppBuffer != NULL ) ? 0 : ENOMEM;
 }
 
-/**
- * @brief Test that otaPal_CreateFileForRx will handle the two types of
- * potential paths.
- */
-void test_OTAPAL_CreateFileForRx_PathTypes( void )
+static int recordFileRange( int fd,
+                            off_t offset,
+                            off_t nbytes,
+                            unsigned int flags,
+                            int numCalls )
 {
-    OtaPalMainStatus_t result;
-    FILE placeholder_file;
-    OtaFileContext_t otaFileContext;
+    ( void ) fd;
 
-    /* Test for a leading forward slash in the path. */
-    otaFileContext.pFilePath = ( uint8_t * ) "/placeholder_path";
-    OTA_PAL_FailSingleMock_unistd( none_fn );
-    fopen_ExpectAnyArgsAndReturn( &placeholder_file );
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+    if( numCalls < ( int ) ( sizeof( fileRanges ) / sizeof( fileRanges[ 0 ] ) ) )
+    {
+        fileRanges[ numCalls ].offset = offset;
+        fileRanges[ numCalls ].nbytes = nbytes;
+        fileRanges[ numCalls ].flags = flags;
+    }
 
-    /* Test for no leading forward slash in the path. */
-    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
-    OTA_PAL_FailSingleMock_unistd( none_fn );
-    fopen_ExpectAnyArgsAndReturn( &placeholder_file );
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+    fileRangeCount++;
+
+    return ( numCalls == failedFileRangeCall ) ? -1 : 0;
 }
 
-/**
- * @brief Test that otaPal_CreateFileForRx will correctly handle a file path
- * that is too long.
- */
-void test_OTAPAL_CreateFileForRx_InvalidPathLength( void )
+static void recordVerification( OtaFileContext_t * C,
+                                OtaPalStatus_t result,
+                                void * pUserContext )
 {
-    OtaPalMainStatus_t result;
-    OtaFileContext_t otaFileContext;
-    const size_t invalidLength = OTA_FILE_PATH_LENGTH_MAX + 1U;
-    char invalidLengthPath[ invalidLength ];
-    size_t i;
+    ( void ) pUserContext;
 
-    /* Test calling getcwd and having it return a path that is too long. */
-    for( i = 0U; i < ( invalidLength - 1U ); ++i )
+    if( verifiedCount < ( sizeof( verifiedResults ) / sizeof( verifiedResults[ 0 ] ) ) )
     {
-        invalidLengthPath[ i ] = 'x';
+        verifiedResults[ verifiedCount ] = result;
     }
 
-    invalidLengthPath[ invalidLength - 1U ] = '\0';
-    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
-    getcwd_ExpectAnyArgsAndReturn( "placeholder_return" );
-    getcwd_ReturnArrayThruPtr_buf( invalidLengthPath, invalidLength );
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
-    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+    verifiedCount++;
+    ( void ) strncpy( verifiedFilePath, ( const char * ) C->pFilePath, sizeof( verifiedFilePath ) - 1U );
+    verifiedFileOpen = ( C->pFile != NULL );
+    verifiedOnTestThread = ( pthread_equal( pthread_self(), testThread ) != 0 );
 }
 
-/**
- * @brief Test that otaPal_CreateFileForRx will handle the getcwd command
- * failing.
- */
-void test_OTAPAL_CreateFileForRx_getcwd_fail( void )
+static int failAlignedAllocation( void ** ppBuffer,
+                                  size_t alignment,
+                                  size_t size,
+                                  int numCalls )
 {
-    OtaPalMainStatus_t result;
-    OtaFileContext_t otaFileContext;
-    OtaImageState_t validState = OtaImageStateTesting;
+    ( void ) ppBuffer;
+    ( void ) alignment;
+    ( void ) size;
+    ( void ) numCalls;
 
+    return ENOMEM;
+}
 
-    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
+static void freeBuffer( void * pBuffer,
+                        const char * pFile,
+                        int line,
+                        int numCalls )
+{
+    ( void ) pFile;
+    ( void ) line;
+    ( void ) numCalls;
 
-    OTA_PAL_FailSingleMock( getcwd_fn, &validState );
-    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
-    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+    free( pBuffer );
 }
 
-/* ===================   OTA PAL CLOSE FILE UNIT TESTS   ==================== */
-
-void test_OTAPAL_CloseFile_NullInput( void )
+static int updateDigest( EVP_MD_CTX * pContext,
+                         const void * pData,
+                         size_t length,
+                         int numCalls )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
+    size_t recordedLength = length;
 
-    OTA_PAL_FailSingleMock_Except_fread( fread_fn, &expectedImageState );
+    ( void ) pContext;
+    ( void ) numCalls;
 
-    /* NULL file context. */
-    result = otaPal_CloseFile( NULL );
-    TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( result ) );
+    /* Record the bytes signed, up to the size of the record. */
+    if( recordedLength > ( sizeof( digestedBytes ) - digestedLength ) )
+    {
+        recordedLength = sizeof( digestedBytes ) - digestedLength;
+    }
+
+    ( void ) memcpy( &digestedBytes[ digestedLength ], pData, recordedLength );
+    digestedLength += recordedLength;
+
+    return 1;
+}
+
+static int failFirstDigestUpdate( EVP_MD_CTX * pContext,
+                                  const void * pData,
+                                  size_t length,
+                                  int numCalls )
+{
+    int result = 0;
+
+    if( numCalls > 0 )
+    {
+        result = updateDigest( pContext, pData, length, numCalls );
+    }
+
+    return result;
+}
+
+static int finishDigest( EVP_MD_CTX * pContext,
+                         unsigned char * pDigest,
+                         unsigned int * pDigestLength,
+                         int numCalls )
+{
+    ( void ) pContext;
+    ( void ) numCalls;
+
+    ( void ) memcpy( pDigest, streamedDigest, sizeof( streamedDigest ) );
+    *pDigestLength = sizeof( streamedDigest );
+
+    return 1;
+}
+
+static int verifyDigest( EVP_PKEY_CTX * pContext,
+                         const unsigned char * pSignature,
+                         size_t signatureLength,
+                         const unsigned char * pDigest,
+                         size_t digestLength,
+                         int numCalls )
+{
+    ( void ) pContext;
+    ( void ) pSignature;
+    ( void ) signatureLength;
+    ( void ) numCalls;
+
+    /* The signature is checked against the digest computed while the
+     * blocks were written. */
+    TEST_ASSERT_EQUAL( sizeof( streamedDigest ), digestLength );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( streamedDigest, pDigest, sizeof( streamedDigest ) );
+
+    return 1;
+}
+
+/**
+ * @brief Back the mocked stdio and unistd functions with real files.
+ */
+static void OTA_PAL_StubFileApis( void )
+{
+    fopen_Stub( openStream );
+    fclose_Stub( closeStream );
+    fread_Stub( readStream );
+    feof_Stub( streamAtEnd );
+    fseek_alias_Stub( seekStream );
+    fwrite_alias_Stub( writeStream );
+    getcwd_Stub( getWorkingDirectory );
+}
+
+/**
+ * @brief Pass the bytes read back by the signature check to updateDigest(),
+ * and make the final check of the signature return @p verifyFinalReturn.
+ */
+static void OTA_PAL_StubDigestVerify( int verifyFinalReturn )
+{
+    static EVP_MD_CTX dummyEVP_MD_CTX;
+    static EVP_MD dummyEVP_MD;
+
+    EVP_MD_CTX_new_IgnoreAndReturn( &dummyEVP_MD_CTX );
+    EVP_DigestVerifyInit_IgnoreAndReturn( 1 );
+    EVP_DigestUpdate_Stub( updateDigest );
+    EVP_DigestVerifyFinal_IgnoreAndReturn( verifyFinalReturn );
+    EVP_MD_CTX_free_Ignore();
+    EVP_sha256_IgnoreAndReturn( &dummyEVP_MD );
+    CRYPTO_malloc_Stub( allocateBuffer );
+    CRYPTO_free_Stub( freeBuffer );
+}
+
+/**
+ * @brief Load the signer key from the mocked certificate, and check the
+ * signature as OTA_PAL_StubDigestVerify() does.
+ */
+static void OTA_PAL_StubSignatureCheck( int verifyFinalReturn )
+{
+    OTA_PAL_FailSingleMock_openssl_BIO( none_fn );
+    OTA_PAL_FailSingleMock_openssl_X509( none_fn );
+
+    EVP_PKEY_free_Ignore();
+    EVP_PKEY_up_ref_IgnoreAndReturn( 1 );
+    OTA_PAL_StubDigestVerify( verifyFinalReturn );
+}
+
+/**
+ * @brief Start a streaming digest passing the bytes it hashes to
+ * updateDigest(), and make the check of its signature return
+ * @p verifyReturn. The check of a file read back passes.
+ */
+static void OTA_PAL_StubStreamingDigest( int verifyReturn )
+{
+    static EVP_PKEY_CTX dummyEVP_PKEY_CTX;
+
+    OTA_PAL_StubSignatureCheck( 1 );
+
+    EVP_DigestInit_ex_IgnoreAndReturn( 1 );
+    EVP_DigestFinal_ex_Stub( finishDigest );
+    EVP_PKEY_CTX_new_IgnoreAndReturn( &dummyEVP_PKEY_CTX );
+    EVP_PKEY_verify_init_IgnoreAndReturn( 1 );
+    /* EVP_PKEY_CTX_set_signature_md is a macro define for EVP_PKEY_CTX_ctrl. */
+    EVP_PKEY_CTX_ctrl_IgnoreAndReturn( 1 );
+    EVP_PKEY_CTX_free_Ignore();
+
+    if( verifyReturn == 1 )
+    {
+        EVP_PKEY_verify_Stub( verifyDigest );
+    }
+    else
+    {
+        EVP_PKEY_verify_IgnoreAndReturn( verifyReturn );
+    }
+}
+
+/**
+ * @brief Read a signer certificate, and check the signature as
+ * OTA_PAL_StubDigestVerify() does. The key read from the certificate is set
+ * by the test.
+ */
+static void OTA_PAL_StubCertificateRead( void )
+{
+    static X509 dummyX509;
+
+    OTA_PAL_FailSingleMock_openssl_BIO( none_fn );
+    PEM_read_bio_X509_IgnoreAndReturn( &dummyX509 );
+    X509_free_Ignore();
+    OTA_PAL_StubDigestVerify( 1 );
+}
+
+/**
+ * @brief Write the path of the file @p pFileName of #testDirectory to
+ * @p pFilePath, a buffer of #OTA_FILE_PATH_LENGTH_MAX bytes.
+ */
+static void OTA_PAL_TestFilePath( const char * pFileName,
+                                  char * pFilePath )
+{
+    ( void ) snprintf( pFilePath, OTA_FILE_PATH_LENGTH_MAX, "%s/%s", testDirectory, pFileName );
+}
+
+/**
+ * @brief Read the file @p pFileName of #testDirectory into @p pBuffer.
+ *
+ * @return The number of bytes read.
+ */
+static size_t OTA_PAL_ReadFile( const char * pFileName,
+                                void * pBuffer,
+                                size_t bufferSize )
+{
+    size_t bytesRead = 0U;
+    char filePath[ OTA_FILE_PATH_LENGTH_MAX ];
+    FILE * pStream = NULL;
+
+    OTA_PAL_TestFilePath( pFileName, filePath );
+    pStream = openStream( filePath, "rb", 0 );
+
+    if( pStream != NULL )
+    {
+        bytesRead = fread_unlocked( pBuffer, 1U, bufferSize, pStream );
+    }
+
+    return bytesRead;
+}
+
+/**
+ * @brief Write @p size bytes of @p pData to the file @p pFileName of
+ * #testDirectory.
+ */
+static void OTA_PAL_WriteFile( const char * pFileName,
+                               const void * pData,
+                               size_t size )
+{
+    char filePath[ OTA_FILE_PATH_LENGTH_MAX ];
+    FILE * pStream = NULL;
+
+    OTA_PAL_TestFilePath( pFileName, filePath );
+    pStream = openStream( filePath, "wb", 0 );
+    TEST_ASSERT_NOT_NULL( pStream );
+    TEST_ASSERT_EQUAL( size, fwrite_unlocked( pData, 1U, size, pStream ) );
+    TEST_ASSERT_EQUAL_INT( 0, closeStream( pStream, 0 ) );
+}
+
+/**
+ * @brief Set up @p pFileContext for a receive file of @p fileSize bytes at
+ * #OTA_PAL_TEST_FILE_PATH, signed with @p pSignature.
+ */
+static void OTA_PAL_InitFileContext( OtaFileContext_t * pFileContext,
+                                     uint32_t fileSize,
+                                     Sig256_t * pSignature )
+{
+    ( void ) memset( pFileContext, 0, sizeof( OtaFileContext_t ) );
+    pFileContext->pFilePath = ( uint8_t * ) OTA_PAL_TEST_FILE_PATH;
+    pFileContext->pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    pFileContext->fileSize = fileSize;
+    pFileContext->pSignature = pSignature;
+}
+
+/**
+ * @brief Check that the image state saved by the OTA PAL is @p expectedState.
+ */
+static void OTA_PAL_CheckSavedImageState( OtaImageState_t expectedState )
+{
+    OtaImageState_t savedState = OtaImageStateUnknown;
+
+    TEST_ASSERT_EQUAL( sizeof( savedState ),
+                       OTA_PAL_ReadFile( OTA_PAL_TEST_IMAGE_STATE_FILE,
+                                         &savedState,
+                                         sizeof( savedState ) ) );
+    TEST_ASSERT_EQUAL( expectedState, savedState );
+}
+
+/**
+ * @brief Write a delta image to @p pDelta, a buffer of 64 bytes, from the
+ * sizes of its header and @p recordsSize bytes of @p pRecords.
+ *
+ * @return The size of the delta.
+ */
+static uint32_t OTA_PAL_BuildDelta( uint8_t * pDelta,
+                                    uint32_t baseSize,
+                                    uint32_t imageSize,
+                                    const uint8_t * pRecords,
+                                    uint32_t recordsSize )
+{
+    const uint32_t sizes[ 2 ] = { baseSize, imageSize };
+    uint32_t i;
+
+    TEST_ASSERT_LESS_OR_EQUAL( 64U - 16U, recordsSize );
+    ( void ) memcpy( pDelta, OTA_PAL_POSIX_DELTA_MAGIC, 8U );
+
+    for( i = 0U; i < 8U; i++ )
+    {
+        pDelta[ 8U + i ] = ( uint8_t ) ( sizes[ i / 4U ] >> ( 8U * ( i % 4U ) ) );
+    }
+
+    ( void ) memcpy( &pDelta[ 16 ], pRecords, recordsSize );
+
+    return 16U + recordsSize;
+}
+
+/**
+ * @brief Read the first @p size bytes of the base image of the deltas to
+ * @p pBuffer.
+ *
+ * @return The size of the base image.
+ */
+static uint32_t OTA_PAL_ReadBaseImage( uint8_t * pBuffer,
+                                       size_t size )
+{
+    FILE * pStream = openStream( OTA_PAL_POSIX_DELTA_BASE_IMAGE_PATH, "rb", 0 );
+    off_t baseSize = 0;
+
+    TEST_ASSERT_NOT_NULL( pStream );
+    TEST_ASSERT_EQUAL( size, fread_unlocked( pBuffer, 1U, size, pStream ) );
+    TEST_ASSERT_EQUAL_INT( 0, fseeko( pStream, 0, SEEK_END ) );
+    baseSize = ftello( pStream );
+    TEST_ASSERT_GREATER_THAN( 0, baseSize );
+
+    return ( uint32_t ) baseSize;
+}
+
+/**
+ * @brief Receive a file of @p fileSize bytes of @p pFile in one block and
+ * close it.
+ *
+ * @return The result of otaPal_CloseFile().
+ */
+static OtaPalStatus_t OTA_PAL_CloseReceivedFile( const uint8_t * pFile,
+                                                 uint32_t fileSize )
+{
+    OtaFileContext_t otaFileContext;
+    Sig256_t signature = { 0 };
+
+    OTA_PAL_InitFileContext( &otaFileContext, fileSize, &signature );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+    TEST_ASSERT_EQUAL_INT( fileSize,
+                           otaPal_WriteBlock( &otaFileContext, 0U, ( uint8_t * ) pFile, fileSize ) );
+
+    return otaPal_CloseFile( &otaFileContext );
+}
+
+/**
+ * @brief Check that the receive file of @p fileSize bytes of @p pFile was not
+ * replaced by a decompressed or reconstructed image: its signature was not
+ * checked, the receive file is left as it is, no replacement file is left,
+ * and the image is aborted.
+ */
+static void OTA_PAL_CheckImageNotReplaced( OtaPalStatus_t result,
+                                           const uint8_t * pFile,
+                                           uint32_t fileSize )
+{
+    uint8_t receiveFile[ 64 ];
+
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+    TEST_ASSERT_EQUAL( 0U, digestedLength );
+    TEST_ASSERT_EQUAL( fileSize, OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( pFile, receiveFile, fileSize );
+    TEST_ASSERT_EQUAL( 0U, OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH ".patched", receiveFile, sizeof( receiveFile ) ) );
+    TEST_ASSERT_EQUAL( 0U, OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH ".inflated", receiveFile, sizeof( receiveFile ) ) );
+    OTA_PAL_CheckSavedImageState( OtaImageStateAborted );
+}
+
+/**
+ * @brief Create the receive file of @p pFileContext, and skip the test if the
+ * file system of the tests does not support O_DIRECT.
+ */
+static void OTA_PAL_CreateDirectFile( OtaFileContext_t * pFileContext )
+{
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( pFileContext ) ) );
+
+    if( alignedAllocations == 0U )
+    {
+        TEST_IGNORE_MESSAGE( "The file system of the tests does not support O_DIRECT." );
+    }
+}
+
+/**
+ * @brief Receive a file of one block and close it, checking its signature
+ * with the signer certificate at @p pCertFilePath.
+ *
+ * @return The result of otaPal_CloseFile().
+ */
+static OtaPalStatus_t OTA_PAL_CloseSignedFile( const char * pCertFilePath )
+{
+    OtaFileContext_t otaFileContext;
+    Sig256_t signature = { 0 };
+    uint8_t block[] = { 0x11, 0x22 };
+
+    OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+    otaFileContext.pCertFilepath = ( uint8_t * ) pCertFilePath;
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+    TEST_ASSERT_EQUAL_INT( sizeof( block ),
+                           otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+    return otaPal_CloseFile( &otaFileContext );
+}
+
+/* ======================   OTA PAL ABORT UNIT TESTS   ====================== */
+
+/**
+ * @brief Test that otaPal_Abort will return correct result code.
+ */
+void test_OTAPAL_Abort_NullFileContext( void )
+{
+    OtaPalMainStatus_t result;
+
+    result = OTA_PAL_MAIN_ERR( otaPal_Abort( NULL ) );
+
+    TEST_ASSERT_EQUAL( OtaPalFileAbort, result );
+}
+
+
+/**
+ * @brief Test that otaPal_Abort will return correct result code.
+ */
+void test_OTAPAL_Abort_NullFileHandle( void )
+{
+    OtaPalMainStatus_t result;
+    OtaFileContext_t testFileContext;
+
+    testFileContext.pFile = NULL;
+    result = OTA_PAL_MAIN_ERR( otaPal_Abort( &testFileContext ) );
+
+    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+}
+
+/**
+ * @brief Test that otaPal_Abort will return correct result code.
+ */
+void test_OTAPAL_Abort_ValidFileHandle( void )
+{
+    OtaPalMainStatus_t result;
+    FILE placeholder_file;
+    OtaFileContext_t testFileContext;
+
+    testFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
+    testFileContext.pFile = &placeholder_file;
+
+    fclose_ExpectAnyArgsAndReturn( 0 );
+
+    result = OTA_PAL_MAIN_ERR( otaPal_Abort( &testFileContext ) );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+}
+
+/**
+ * @brief Test that otaPal_Abort will return correct result code.
+ */
+void test_OTAPAL_Abort_FileCloseFail( void )
+{
+    OtaPalMainStatus_t result;
+    OtaFileContext_t testFileContext;
+    FILE dummyFile;
+
+    testFileContext.pFilePath = ( uint8_t * ) "placeholder";
+    testFileContext.pFile = &dummyFile;
+
+    fclose_ExpectAnyArgsAndReturn( EOF );
+
+    result = otaPal_Abort( &testFileContext );
+    TEST_ASSERT_EQUAL( OtaPalFileAbort, OTA_PAL_MAIN_ERR( result ) );
+}
+
+/* ===================   OTA PAL CREATE FILE UNIT TESTS   =================== */
+
+/**
+ * @brief Test that otaPal_CreateFileForRx will return correct result code.
+ */
+void test_OTAPAL_CreateFileForRx_NullFileContext( void )
+{
+    OtaPalMainStatus_t result;
+
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( NULL ) );
+    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+}
+
+
+/**
+ * @brief Test that otaPal_CreateFileForRx will return correct result code.
+ */
+void test_OTAPAL_CreateFileForRx_NullFilePath( void )
+{
+    OtaPalMainStatus_t result;
+    OtaFileContext_t testFile;
+
+    testFile.pFilePath = NULL;
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &testFile ) );
+
+    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx will return correct result code.
+ */
+void test_OTAPAL_CreateFileForRx_FailedToCreateFile( void )
+{
+    OtaPalMainStatus_t result;
+    FILE placeholder_file;
+    OtaFileContext_t testFile;
+
+    testFile.pFilePath = ( uint8_t * ) "placeholder_path";
+    testFile.pFile = &placeholder_file;
+
+    fopen_ExpectAnyArgsAndReturn( NULL );
+    OTA_PAL_FailSingleMock_unistd( none_fn );
+    /* Create a file that exists with w+b mode */
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &testFile ) );
+    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx will return correct result code.
+ */
+void test_OTAPAL_CreateFileForRx_ValidFileHandle( void )
+{
+    OtaPalMainStatus_t result;
+    FILE placeholder_file;
+    OtaFileContext_t otaFileContext;
+
+    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
+
+    OTA_PAL_FailSingleMock_unistd( none_fn );
+    fopen_ExpectAnyArgsAndReturn( &placeholder_file );
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx will handle the two types of
+ * potential paths.
+ */
+void test_OTAPAL_CreateFileForRx_PathTypes( void )
+{
+    OtaPalMainStatus_t result;
+    FILE placeholder_file;
+    OtaFileContext_t otaFileContext;
+
+    /* Test for a leading forward slash in the path. */
+    otaFileContext.pFilePath = ( uint8_t * ) "/placeholder_path";
+    OTA_PAL_FailSingleMock_unistd( none_fn );
+    fopen_ExpectAnyArgsAndReturn( &placeholder_file );
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+
+    /* Test for no leading forward slash in the path. */
+    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
+    OTA_PAL_FailSingleMock_unistd( none_fn );
+    fopen_ExpectAnyArgsAndReturn( &placeholder_file );
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, result );
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx will correctly handle a file path
+ * that is too long.
+ */
+void test_OTAPAL_CreateFileForRx_InvalidPathLength( void )
+{
+    OtaPalMainStatus_t result;
+    OtaFileContext_t otaFileContext;
+    const size_t invalidLength = OTA_FILE_PATH_LENGTH_MAX + 1U;
+    char invalidLengthPath[ invalidLength ];
+    size_t i;
+
+    /* Test calling getcwd and having it return a path that is too long. */
+    for( i = 0U; i < ( invalidLength - 1U ); ++i )
+    {
+        invalidLengthPath[ i ] = 'x';
+    }
+
+    invalidLengthPath[ invalidLength - 1U ] = '\0';
+    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
+    getcwd_ExpectAnyArgsAndReturn( "placeholder_return" );
+    getcwd_ReturnArrayThruPtr_buf( invalidLengthPath, invalidLength );
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
+    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx will handle the getcwd command
+ * failing.
+ */
+void test_OTAPAL_CreateFileForRx_getcwd_fail( void )
+{
+    OtaPalMainStatus_t result;
+    OtaFileContext_t otaFileContext;
+    OtaImageState_t validState = OtaImageStateTesting;
+
+
+    otaFileContext.pFilePath = ( uint8_t * ) "placeholder_path";
+
+    OTA_PAL_FailSingleMock( getcwd_fn, &validState );
+    result = OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) );
+    TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, result );
+}
+
+/* ===================   OTA PAL CLOSE FILE UNIT TESTS   ==================== */
+
+void test_OTAPAL_CloseFile_NullInput( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    OTA_PAL_FailSingleMock_Except_fread( fread_fn, &expectedImageState );
+
+    /* NULL file context. */
+    result = otaPal_CloseFile( NULL );
+    TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( result ) );
 
     /* NULL signature input. */
     otaFileContext.pSignature = NULL;
@@ -571,16 +1377,233 @@ void test_OTAPAL_CloseFile_NullInput( void )
     result = otaPal_CloseFile( &otaFileContext );
     TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
 
-    /* NULL file input */
+    /* NULL file input */
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = NULL;
+    /* NULL signature input. */
+    OTA_PAL_FailSingleMock_Except_fread( fread_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_HappyPath( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    /* When fread is being called in this case, it is looping until there is
+     * no more data. Setting fread to fail prevents us from getting stuck in
+     * the loops. */
+    OTA_PAL_FailSingleMock( fread_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_OpenSSL_failures( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    OTA_PAL_FailSingleMock_Except_fread( BIO_puts_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+
+    /* Test OpenSSL/X509.h functions failing. */
+    otaFileContext.pFile = &dummyFile;
+    OTA_PAL_FailSingleMock_Except_fread( PEM_read_bio_X509_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
+
+    otaFileContext.pFile = &dummyFile;
+    OTA_PAL_FailSingleMock_Except_fread( X509_get_pubkey_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+
+    /* Test fclose failing. */
+    otaFileContext.pFile = &dummyFile;
+    OTA_PAL_FailSingleMock_Except_fread( fclose_fn, &expectedImageState );
+    /* Just want the first fclose to fail. */
+    fclose_StopIgnore();
+    fclose_ExpectAnyArgsAndReturn( EOF );
+    fclose_IgnoreAndReturn( 0 );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( result ) );
+
+    /* Test OPENSSL_malloc failing. */
+    otaFileContext.pFile = &dummyFile;
+    OTA_PAL_FailSingleMock_Except_fread( OPENSSL_malloc_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalOutOfMemory, OTA_PAL_MAIN_ERR( result ) );
+
+    /* Test EVP_MD_CTX_new failing. */
+    otaFileContext.pFile = &dummyFile;
+    OTA_PAL_FailSingleMock_Except_fread( EVP_MD_CTX_new_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_BIO_puts( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    /* Test fseek failing. */
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    /* BIO_ctrl has to fail first to call BIO_puts. */
+    BIO_ctrl_IgnoreAndReturn( 0 );
+    OTA_PAL_FailSingleMock_Except_fread( BIO_puts_fn, &expectedImageState );
+
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_feof_fail( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    /* Test feof failing both times it is called.*/
+    OTA_PAL_FailSingleMock_Except_fread( feof_fn, &expectedImageState );
+    feof_IgnoreAndReturn( 0 );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_EVP_DigestVerifyFinal_fail( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    /* Test fseek failing. */
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    OTA_PAL_FailSingleMock_Except_fread( EVP_DigestVerifyFinal_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_EVP_DigestVerifyUpdate_fail( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    /* Test fseek failing. */
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    OTA_PAL_FailSingleMock_Except_fread( EVP_DigestVerifyUpdate_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_fseek_fail( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    /* Test fseek failing. */
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    OTA_PAL_FailSingleMock_Except_fread( fseek_alias_fn, &expectedImageState );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_fread_fail( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    /* Test fread pass then fail. */
+    OTA_PAL_FailSingleMock( none_fn, &expectedImageState );
+    fread_StopIgnore();
+    fread_ExpectAnyArgsAndReturn( 1 );
+    fread_ExpectAnyArgsAndReturn( 0 );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+}
+
+void test_OTAPAL_CloseFile_BIO_new( void )
+{
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
+    BIO dummyBIO;
+
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
+    otaFileContext.pFile = &dummyFile;
+
+    /* Test OpenSSL/bio.h functions failing. */
+    OTA_PAL_FailSingleMock_Except_fread( none_fn, &expectedImageState );
+    BIO_new_StopIgnore();
+    BIO_ctrl_StopIgnore();
+    BIO_new_ExpectAnyArgsAndReturn( &dummyBIO );
+    BIO_ctrl_ExpectAnyArgsAndReturn( 0 );
+    BIO_new_ExpectAnyArgsAndReturn( NULL );
+    result = otaPal_CloseFile( &otaFileContext );
+    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
+
+
     otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = NULL;
-    /* NULL signature input. */
-    OTA_PAL_FailSingleMock_Except_fread( fread_fn, &expectedImageState );
+    otaFileContext.pFile = &dummyFile;
+    OTA_PAL_FailSingleMock_Except_fread( BIO_new_fn, &expectedImageState );
     result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
 }
 
-void test_OTAPAL_CloseFile_HappyPath( void )
+void test_OTAPAL_CloseFile_BIO_read_filename_fail( void )
 {
     OtaPalStatus_t result;
     OtaFileContext_t otaFileContext;
@@ -589,17 +1612,15 @@ void test_OTAPAL_CloseFile_HappyPath( void )
     FILE dummyFile;
 
     otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
     otaFileContext.pFile = &dummyFile;
 
-    /* When fread is being called in this case, it is looping until there is
-     * no more data. Setting fread to fail prevents us from getting stuck in
-     * the loops. */
-    OTA_PAL_FailSingleMock( fread_fn, &expectedImageState );
+    OTA_PAL_FailSingleMock_Except_fread( BIO_read_filename_fn, &expectedImageState );
     result = otaPal_CloseFile( &otaFileContext );
     TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
 }
 
-void test_OTAPAL_CloseFile_OpenSSL_failures( void )
+void test_OTAPAL_CloseFile_EVP_DigestVerifyInit_fail( void )
 {
     OtaPalStatus_t result;
     OtaFileContext_t otaFileContext;
@@ -608,334 +1629,1938 @@ void test_OTAPAL_CloseFile_OpenSSL_failures( void )
     FILE dummyFile;
 
     otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
     otaFileContext.pFile = &dummyFile;
 
-    OTA_PAL_FailSingleMock_Except_fread( BIO_puts_fn, &expectedImageState );
+    OTA_PAL_FailSingleMock_Except_fread( EVP_DigestVerifyInit_fn, &expectedImageState );
     result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+}
 
-    /* Test OpenSSL/X509.h functions failing. */
-    otaFileContext.pFile = &dummyFile;
-    OTA_PAL_FailSingleMock_Except_fread( PEM_read_bio_X509_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_CloseFile properly handles receiving fread returning
+ * data that is the maximum size. The maximum size is based on the OTA PAL
+ * implementation. It is defined by the "OTA_PAL_POSIX_BUF_SIZE" macro in the
+ * OTA posix PAL implementation .c file.
+ */
+void test_OTAPAL_CloseFile_MaxBlockSize( void )
+{
+    const size_t OTA_PAL_POSIX_BUF_SIZE = 4096U;
+    OtaPalStatus_t result;
+    OtaFileContext_t otaFileContext;
+    Sig256_t dummySig;
+    OtaImageState_t expectedImageState = OtaImageStateTesting;
+    FILE dummyFile;
 
+    otaFileContext.pSignature = &dummySig;
+    otaFileContext.pCertFilepath = ( uint8_t * ) "placeholder_cert";
     otaFileContext.pFile = &dummyFile;
-    OTA_PAL_FailSingleMock_Except_fread( X509_get_pubkey_fn, &expectedImageState );
+
+    /* Simulate the scenario where fread returns a max size block and then it
+     * returns a value less than the max size. */
+    fread_IgnoreAndReturn( OTA_PAL_POSIX_BUF_SIZE );
+    fread_IgnoreAndReturn( 0 );
+    OTA_PAL_FailSingleMock( none_fn, &expectedImageState );
     result = otaPal_CloseFile( &otaFileContext );
     TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+}
 
-    /* Test fclose failing. */
-    otaFileContext.pFile = &dummyFile;
-    OTA_PAL_FailSingleMock_Except_fread( fclose_fn, &expectedImageState );
-    /* Just want the first fclose to fail. */
-    fclose_StopIgnore();
-    fclose_ExpectAnyArgsAndReturn( EOF );
-    fclose_IgnoreAndReturn( 0 );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( result ) );
+/* ===================   OTA PAL WRITE BLOCK UNIT TESTS   =================== */
 
-    /* Test OPENSSL_malloc failing. */
-    otaFileContext.pFile = &dummyFile;
-    OTA_PAL_FailSingleMock_Except_fread( OPENSSL_malloc_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalOutOfMemory, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_WriteBlock will return correct result code.
+ */
+void test_OTAPAL_WriteBlock_NullFileContext( void )
+{
+    int16_t result = 0;
+    uint8_t data = 0xAA;
+    uint32_t blockSize = 1;
 
-    /* Test EVP_MD_CTX_new failing. */
-    otaFileContext.pFile = &dummyFile;
-    OTA_PAL_FailSingleMock_Except_fread( EVP_MD_CTX_new_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+    result = otaPal_WriteBlock( NULL, 0, &data, blockSize );
+    TEST_ASSERT_EQUAL( -1, result );
+}
+
+/**
+ * @brief Test that otaPal_WriteBlock will return correct result code.
+ */
+void test_OTAPAL_WriteBlock_WriteSingleByte( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 0 )
+        int16_t numBytesWritten;
+        uint8_t data = 0xAA;
+        uint32_t blockSize = 1;
+        OtaFileContext_t otaFileContext;
+
+        /* TEST: Write a byte of data. */
+        otaFileContext.pFilePath = ( uint8_t * ) "placeholder";
+        fseek_alias_ExpectAnyArgsAndReturn( 0 );
+        fwrite_alias_ExpectAnyArgsAndReturn( blockSize );
+        numBytesWritten = otaPal_WriteBlock( &otaFileContext, 0, &data, blockSize );
+        TEST_ASSERT_EQUAL_INT( blockSize, numBytesWritten );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run without the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_WriteBlock will return correct result code.
+ */
+void test_OTAPAL_WriteBlock_WriteMultipleBytes( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 0 )
+        int16_t numBytesWritten;
+        size_t index = 0;
+        uint8_t pData[] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE };
+        uint32_t blockSize = sizeof( pData[ 0 ] );
+        OtaFileContext_t otaFileContext;
+
+        /* TEST: Write multiple bytes of data. */
+        for( index = 0; index < ( sizeof( pData ) / sizeof( pData[ 0 ] ) ); index++ )
+        {
+            fseek_alias_ExpectAnyArgsAndReturn( 0 );
+            fwrite_alias_ExpectAnyArgsAndReturn( blockSize );
+            numBytesWritten = otaPal_WriteBlock( &otaFileContext, index * blockSize, pData, blockSize );
+            TEST_ASSERT_EQUAL_INT( blockSize, numBytesWritten );
+        }
+    #else
+        TEST_IGNORE_MESSAGE( "Only run without the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_WriteBlock will return correct result code.
+ */
+void test_OTAPAL_WriteBlock_FseekError( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 0 )
+        int16_t numBytesWritten;
+        uint8_t data = 0xAA;
+        uint32_t blockSize = 1;
+        const int16_t fseek_error_num = 1; /* fseek returns a non-zero number on error. */
+        OtaFileContext_t validFileContext;
+
+        /* TEST: Write a byte of data. */
+        fseek_alias_ExpectAnyArgsAndReturn( fseek_error_num );
+        numBytesWritten = otaPal_WriteBlock( &validFileContext, 0, &data, blockSize );
+        TEST_ASSERT_EQUAL_INT( -1, numBytesWritten );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run without the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_WriteBlock will return correct result code.
+ */
+void test_OTAPAL_WriteBlock_FwriteError( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 0 )
+        int16_t numBytesWritten;
+        uint8_t data = 0xAA;
+        uint32_t blockSize = 1;
+        OtaFileContext_t validFileContext;
+        const int32_t fseekSuccessReturn = 0; /* fseek returns a zero on success. */
+        const size_t fwriteErrorReturn = 0;   /* fwrite returns a number less than the requested number of bytes to write on error. */
+        const int16_t writeblockErrorReturn = -1;
+
+        fseek_alias_ExpectAnyArgsAndReturn( fseekSuccessReturn );
+        fwrite_alias_ExpectAnyArgsAndReturn( fwriteErrorReturn );
+
+        /* fwrite returns a number less than the amount requested to write on error. */
+        numBytesWritten = otaPal_WriteBlock( &validFileContext, 0, &data, blockSize );
+        TEST_ASSERT_EQUAL_INT( writeblockErrorReturn, numBytesWritten );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run without the pwrite block writer." );
+    #endif
+}
+
+/* ======================   OTA PAL PWRITE UNIT TESTS   ===================== */
+
+/**
+ * @brief Test that otaPal_CreateFileForRx preallocates the receive file.
+ */
+void test_OTAPAL_CreateFileForRx_Preallocate( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        const uint32_t fileSize = 4U;
+
+        OTA_PAL_InitFileContext( &otaFileContext, fileSize, NULL );
+        OTA_PAL_StubFileApis();
+        posix_fallocate_ExpectAndReturn( 0, 0, ( off_t ) fileSize, 0 );
+        posix_fallocate_IgnoreArg_fd();
+
+        result = otaPal_CreateFileForRx( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NOT_NULL( otaFileContext.pFile );
+
+        result = otaPal_Abort( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx does not preallocate an empty
+ * receive file.
+ */
+void test_OTAPAL_CreateFileForRx_EmptyFileNotPreallocated( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+
+        OTA_PAL_InitFileContext( &otaFileContext, 0U, NULL );
+        OTA_PAL_StubFileApis();
+        /* The file would not be created if it was preallocated. */
+        posix_fallocate_IgnoreAndReturn( EIO );
+
+        result = otaPal_CreateFileForRx( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NOT_NULL( otaFileContext.pFile );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx closes the receive file when there
+ * is no space for it.
+ */
+void test_OTAPAL_CreateFileForRx_PreallocateNoSpace( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+
+        OTA_PAL_InitFileContext( &otaFileContext, 4U, NULL );
+        fopen_Stub( openStream );
+        getcwd_Stub( getWorkingDirectory );
+        posix_fallocate_ExpectAnyArgsAndReturn( ENOSPC );
+        fclose_ExpectAnyArgsAndReturn( 0 );
+
+        result = otaPal_CreateFileForRx( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalRxFileTooLarge, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( ENOSPC, OTA_PAL_SUB_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CreateFileForRx closes the receive file when it
+ * can't be preallocated.
+ */
+void test_OTAPAL_CreateFileForRx_PreallocateFail( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+
+        OTA_PAL_InitFileContext( &otaFileContext, 4U, NULL );
+        fopen_Stub( openStream );
+        getcwd_Stub( getWorkingDirectory );
+        posix_fallocate_ExpectAnyArgsAndReturn( EIO );
+        fclose_ExpectAnyArgsAndReturn( 0 );
+
+        result = otaPal_CreateFileForRx( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalRxFileCreateFailed, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( EIO, OTA_PAL_SUB_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_WriteBlock writes blocks received out of order at
+ * their offsets.
+ */
+void test_OTAPAL_WriteBlock_PwriteOutOfOrder( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        uint8_t firstBlock[] = { 0xAA, 0xBB };
+        uint8_t secondBlock[] = { 0xCC, 0xDD };
+        const uint8_t expectedFile[] = { 0xAA, 0xBB, 0xCC, 0xDD };
+        uint8_t file[ sizeof( expectedFile ) + 1U ];
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, sizeof( firstBlock ), secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+
+        /* The blocks are all written once the file is closed. */
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, file, sizeof( file ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, file, sizeof( expectedFile ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_WriteBlock fails when the receive file has no file
+ * descriptor to write to.
+ */
+void test_OTAPAL_WriteBlock_PwriteError( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        uint8_t data = 0xAA;
+        char memoryFile[ 1 ];
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( data ), NULL );
+        /* A memory stream has no file descriptor. */
+        otaFileContext.pFile = fmemopen( memoryFile, sizeof( memoryFile ), "w+b" );
+        TEST_ASSERT_NOT_NULL( otaFileContext.pFile );
+
+        TEST_ASSERT_EQUAL_INT( -1, otaPal_WriteBlock( &otaFileContext, 0U, &data, sizeof( data ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CloseFile checks the signature of the blocks written
+ * at their offsets.
+ */
+void test_OTAPAL_CloseFile_PwriteBlocksVerified( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t firstBlock[] = { 0x11, 0x22, 0x33 };
+        uint8_t secondBlock[] = { 0x44, 0x55 };
+        const uint8_t expectedFile[] = { 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, sizeof( firstBlock ), secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, digestedBytes, sizeof( expectedFile ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CloseFile aborts the image when the signature of the
+ * blocks written at their offsets is not valid.
+ */
+void test_OTAPAL_CloseFile_PwriteSignatureFail( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t block[] = { 0x11, 0x22 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 0 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        OTA_PAL_CheckSavedImageState( OtaImageStateAborted );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_Abort closes a receive file written at the offsets
+ * of its blocks.
+ */
+void test_OTAPAL_Abort_PwriteFile( void )
+{
+    #if ( OTA_PAL_POSIX_PWRITE_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        uint8_t block[] = { 0x11, 0x22 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        result = otaPal_Abort( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the pwrite block writer." );
+    #endif
+}
+
+/* =================   OTA PAL STREAMING DIGEST UNIT TESTS   ================ */
+
+/**
+ * @brief Test that the blocks are hashed in file order as they are written,
+ * so that otaPal_CloseFile checks the signature without reading the file
+ * back.
+ */
+void test_OTAPAL_CloseFile_StreamingDigestVerified( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t firstBlock[] = { 0x11, 0x22 };
+        uint8_t secondBlock[] = { 0x33, 0x44 };
+        uint8_t thirdBlock[] = { 0x55, 0x66 };
+        const uint8_t expectedFile[] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubStreamingDigest( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        /* The blocks after the next offset to hash wait for the first one. */
+        TEST_ASSERT_EQUAL_INT( sizeof( thirdBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 4U, thirdBlock, sizeof( thirdBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 2U, secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL( 0U, digestedLength );
+
+        /* They are read back and hashed once it is written. */
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, digestedBytes, sizeof( expectedFile ) );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        /* The file was not hashed again. */
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), digestedLength );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CloseFile aborts the image when the signature of the
+ * streamed digest is not valid.
+ */
+void test_OTAPAL_CloseFile_StreamingDigestSignatureFail( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t block[] = { 0x11, 0x22 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubStreamingDigest( 0 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( sizeof( block ), digestedLength );
+        OTA_PAL_CheckSavedImageState( OtaImageStateAborted );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CloseFile reads the file back to hash it when the
+ * streamed digest does not cover the whole file.
+ */
+void test_OTAPAL_CloseFile_StreamingDigestIncomplete( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t block[] = { 0x11, 0x22 };
+
+        /* Only the first half of the file is written. */
+        OTA_PAL_InitFileContext( &otaFileContext, 2U * sizeof( block ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubStreamingDigest( 0 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        /* The block was hashed when it was written, and again at close. */
+        TEST_ASSERT_EQUAL( 2U * sizeof( block ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( block, &digestedBytes[ sizeof( block ) ], sizeof( block ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that the file is hashed at close when the streaming digest can't
+ * be started.
+ */
+void test_OTAPAL_CreateFileForRx_StreamingDigestStartFail( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t block[] = { 0x11, 0x22 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        EVP_DigestInit_ex_IgnoreAndReturn( 0 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        TEST_ASSERT_EQUAL_INT( sizeof( block ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL( 0U, digestedLength );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( sizeof( block ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( block, digestedBytes, sizeof( block ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that a block written again is hashed once.
+ */
+void test_OTAPAL_WriteBlock_StreamingDigestRetransmit( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t firstBlock[] = { 0x11, 0x22 };
+        uint8_t secondBlock[] = { 0x33, 0x44 };
+        const uint8_t expectedFile[] = { 0x11, 0x22, 0x33, 0x44 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubStreamingDigest( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        /* A pending block written again is recorded once. */
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 2U, secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 2U, secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+
+        /* A block that was hashed already is ignored. */
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, digestedBytes, sizeof( expectedFile ) );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that the file is hashed at close when more blocks arrive out of
+ * order than the streaming digest can wait for.
+ */
+void test_OTAPAL_WriteBlock_StreamingDigestWindowFull( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t data = 0xAA;
+        const uint32_t fileSize = OTA_PAL_POSIX_DIGEST_WINDOW_BLOCKS + 2U;
+        uint32_t offset;
+
+        TEST_ASSERT_TRUE( fileSize <= sizeof( digestedBytes ) );
+        OTA_PAL_InitFileContext( &otaFileContext, fileSize, &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubStreamingDigest( 0 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        /* Every block but the first is written ahead of the next offset to
+         * hash, one more than the window holds. */
+        for( offset = 1U; offset < fileSize; offset++ )
+        {
+            TEST_ASSERT_EQUAL_INT( sizeof( data ),
+                                   otaPal_WriteBlock( &otaFileContext, offset, &data, sizeof( data ) ) );
+        }
+
+        TEST_ASSERT_EQUAL_INT( sizeof( data ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, &data, sizeof( data ) ) );
+        TEST_ASSERT_EQUAL( 0U, digestedLength );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( fileSize, digestedLength );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that the file is hashed at close when a block can't be hashed
+ * as it is written.
+ */
+void test_OTAPAL_WriteBlock_StreamingDigestUpdateFail( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t firstBlock[] = { 0x11, 0x22 };
+        uint8_t secondBlock[] = { 0x33, 0x44 };
+        const uint8_t expectedFile[] = { 0x11, 0x22, 0x33, 0x44 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubStreamingDigest( 0 );
+        EVP_DigestUpdate_Stub( failFirstDigestUpdate );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        /* The digest is stopped once the first block can't be hashed. */
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 2U, secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL( 0U, digestedLength );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, digestedBytes, sizeof( expectedFile ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that the streaming digest stops when a pending block can't be
+ * read back from the receive file.
+ */
+void test_OTAPAL_WriteBlock_StreamingDigestReadBackFail( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t firstBlock[] = { 0x11, 0x22 };
+        uint8_t secondBlock[] = { 0x33, 0x44 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( firstBlock ) + sizeof( secondBlock ), &signature );
+        OTA_PAL_StubFileApis();
+        fopen_Stub( openWriteOnlyStream );
+        OTA_PAL_StubStreamingDigest( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 2U, secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+        TEST_ASSERT_EQUAL( sizeof( firstBlock ), digestedLength );
+
+        /* The second block is not hashed when it is written again. */
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 2U, secondBlock, sizeof( secondBlock ) ) );
+        TEST_ASSERT_EQUAL( sizeof( firstBlock ), digestedLength );
+
+        /* Nor can the file be read back at close. */
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_Abort stops the streaming digest of the file.
+ */
+void test_OTAPAL_Abort_StreamingDigest( void )
+{
+    #if ( OTA_PAL_POSIX_STREAMING_DIGEST_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        static EVP_MD_CTX digestContext;
+        static EVP_MD dummyEVP_MD;
+        uint8_t block[] = { 0x11, 0x22 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), NULL );
+        OTA_PAL_StubFileApis();
+        EVP_MD_CTX_new_IgnoreAndReturn( &digestContext );
+        EVP_sha256_IgnoreAndReturn( &dummyEVP_MD );
+        EVP_DigestInit_ex_IgnoreAndReturn( 1 );
+        EVP_DigestUpdate_Stub( updateDigest );
+        /* A digest left by a previous test is freed. */
+        EVP_MD_CTX_free_Ignore();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL( sizeof( block ), digestedLength );
+
+        EVP_MD_CTX_free_StopIgnore();
+        EVP_MD_CTX_free_Expect( &digestContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the streaming digest." );
+    #endif
+}
+
+/* ================   OTA PAL SIGNER KEY CACHE UNIT TESTS   ================= */
+
+/**
+ * @brief Test that the key of the signer certificate is loaded once and then
+ * used from the cache, until otaPal_FreeSignerKeyCache frees it.
+ */
+void test_OTAPAL_CloseFile_SignerKeyCached( void )
+{
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        static EVP_PKEY signerKey;
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubCertificateRead();
+
+        /* The key is loaded and replaces the empty cache. */
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &signerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+
+        /* The cached key is used. */
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+
+        EVP_PKEY_free_ExpectAnyArgs();
+        otaPal_FreeSignerKeyCache();
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the signer key cache." );
+    #endif
+}
+
+/**
+ * @brief Test that the key of the signer certificate is loaded again when the
+ * certificate file is modified.
+ */
+void test_OTAPAL_CloseFile_SignerKeyReloadedWhenCertModified( void )
+{
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        static EVP_PKEY firstSignerKey;
+        static EVP_PKEY secondSignerKey;
+        const char firstCert[] = "first";
+        const char secondCert[] = "second";
+        char certFilePath[ OTA_FILE_PATH_LENGTH_MAX ];
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubCertificateRead();
+        OTA_PAL_TestFilePath( OTA_PAL_TEST_CERT_FILE, certFilePath );
+        OTA_PAL_WriteFile( OTA_PAL_TEST_CERT_FILE, firstCert, sizeof( firstCert ) );
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &firstSignerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( certFilePath ) ) );
+
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( certFilePath ) ) );
+
+        /* The size of the certificate file changes, so the key is loaded
+         * again and replaces the first one. */
+        OTA_PAL_WriteFile( OTA_PAL_TEST_CERT_FILE, secondCert, sizeof( secondCert ) );
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &secondSignerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( certFilePath ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the signer key cache." );
+    #endif
+}
+
+/**
+ * @brief Test that the key of the signer certificate is loaded again when
+ * another certificate is used.
+ */
+void test_OTAPAL_CloseFile_SignerKeyReloadedForAnotherCert( void )
+{
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        static EVP_PKEY firstSignerKey;
+        static EVP_PKEY secondSignerKey;
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubCertificateRead();
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &firstSignerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &secondSignerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "another_placeholder_cert" ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the signer key cache." );
+    #endif
+}
+
+/**
+ * @brief Test that a key that failed to load is not cached, so the next check
+ * loads it again.
+ */
+void test_OTAPAL_CloseFile_SignerKeyLoadFailNotCached( void )
+{
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        static EVP_PKEY signerKey;
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubCertificateRead();
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( NULL );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &signerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the signer key cache." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CloseFile fails with a bad signer certificate when
+ * the cached key can't be referenced, and the key stays in the cache.
+ */
+void test_OTAPAL_CloseFile_SignerKeyReferenceFail( void )
+{
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        static EVP_PKEY signerKey;
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubCertificateRead();
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &signerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 0 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the signer key cache." );
+    #endif
+}
+
+/**
+ * @brief Test that the key of a certificate whose path does not fit in the
+ * cache is loaded for each check and freed after it.
+ */
+void test_OTAPAL_CloseFile_SignerKeyLongCertPathNotCached( void )
+{
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        static EVP_PKEY signerKey;
+        char certFilePath[ OTA_FILE_PATH_LENGTH_MAX + 1 ];
+
+        ( void ) memset( certFilePath, 'a', OTA_FILE_PATH_LENGTH_MAX );
+        certFilePath[ OTA_FILE_PATH_LENGTH_MAX ] = '\0';
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubCertificateRead();
+
+        /* The caller frees the only reference to the key. */
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &signerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( certFilePath ) ) );
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &signerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( certFilePath ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the signer key cache." );
+    #endif
+}
+
+/**
+ * @brief Test that the key is loaded again after otaPal_FreeSignerKeyCache
+ * frees the cache.
+ */
+void test_OTAPAL_FreeSignerKeyCache_KeyReloaded( void )
+{
+    #if ( OTA_PAL_POSIX_SIGNER_KEY_CACHE_ENABLED == 1 )
+        static EVP_PKEY firstSignerKey;
+        static EVP_PKEY secondSignerKey;
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubCertificateRead();
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &firstSignerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+
+        EVP_PKEY_free_ExpectAnyArgs();
+        otaPal_FreeSignerKeyCache();
+
+        X509_get_pubkey_ExpectAnyArgsAndReturn( &secondSignerKey );
+        EVP_PKEY_free_ExpectAnyArgs();
+        EVP_PKEY_up_ref_ExpectAnyArgsAndReturn( 1 );
+        EVP_PKEY_free_ExpectAnyArgs();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseSignedFile( "placeholder_cert" ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the signer key cache." );
+    #endif
+}
+
+/* ===================   OTA PAL DELTA IMAGE UNIT TESTS   =================== */
+
+/**
+ * @brief Test that otaPal_CloseFile applies a delta image to the base image,
+ * checks the signature of the reconstructed image and replaces the delta with
+ * it.
+ */
+void test_OTAPAL_CloseFile_DeltaApplied( void )
+{
+    #if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+        uint8_t delta[ 64 ];
+        uint8_t expectedImage[ 7 ];
+        uint8_t receiveFile[ 64 ];
+        uint32_t deltaSize;
+        /* COPY 4 bytes at offset 0, ADD 3 bytes and END. */
+        const uint8_t records[] =
+        {
+            0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+            0x02, 0x03, 0x00, 0x00, 0x00, 0xAA, 0xBB, 0xCC,
+            0x00
+        };
+
+        expectedImage[ 4 ] = 0xAA;
+        expectedImage[ 5 ] = 0xBB;
+        expectedImage[ 6 ] = 0xCC;
+        deltaSize = OTA_PAL_BuildDelta( delta, OTA_PAL_ReadBaseImage( expectedImage, 4U ),
+                                        sizeof( expectedImage ), records, sizeof( records ) );
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseReceivedFile( delta, deltaSize ) ) );
+
+        TEST_ASSERT_EQUAL( sizeof( expectedImage ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedImage, digestedBytes, sizeof( expectedImage ) );
+        TEST_ASSERT_EQUAL( sizeof( expectedImage ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedImage, receiveFile, sizeof( expectedImage ) );
+        TEST_ASSERT_EQUAL( 0U, OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH ".patched", receiveFile, sizeof( receiveFile ) ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with delta images." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CloseFile checks the signature of a receive file
+ * that does not start with the delta magic as a full image.
+ */
+void test_OTAPAL_CloseFile_DeltaFullImage( void )
+{
+    #if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+        const uint8_t image[] = "OTAFULL, not a delta image";
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseReceivedFile( image, sizeof( image ) ) ) );
+
+        TEST_ASSERT_EQUAL( sizeof( image ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( image, digestedBytes, sizeof( image ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with delta images." );
+    #endif
+}
+
+/**
+ * @brief Test that otaPal_CloseFile rejects a delta image made for a base
+ * image of another size.
+ */
+void test_OTAPAL_CloseFile_DeltaBaseSizeMismatch( void )
+{
+    #if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+        uint8_t delta[ 64 ];
+        uint8_t baseImage[ 1 ];
+        uint32_t deltaSize;
+        const uint8_t records[] = { 0x02, 0x01, 0x00, 0x00, 0x00, 0xAA, 0x00 };
+
+        deltaSize = OTA_PAL_BuildDelta( delta, OTA_PAL_ReadBaseImage( baseImage, 0U ) + 1U,
+                                        1U, records, sizeof( records ) );
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        OTA_PAL_CheckImageNotReplaced( OTA_PAL_CloseReceivedFile( delta, deltaSize ), delta, deltaSize );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with delta images." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_BIO_puts( void )
+/**
+ * @brief Test that otaPal_CloseFile rejects a delta image when the base image
+ * can't be opened.
+ */
+void test_OTAPAL_CloseFile_DeltaBaseOpenFail( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
-
-    /* Test fseek failing. */
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
-
-    /* BIO_ctrl has to fail first to call BIO_puts. */
-    BIO_ctrl_IgnoreAndReturn( 0 );
-    OTA_PAL_FailSingleMock_Except_fread( BIO_puts_fn, &expectedImageState );
+    #if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+        uint8_t delta[ 64 ];
+        uint8_t baseImage[ 1 ];
+        uint32_t deltaSize;
+        const uint8_t records[] = { 0x02, 0x01, 0x00, 0x00, 0x00, 0xAA, 0x00 };
+
+        deltaSize = OTA_PAL_BuildDelta( delta, OTA_PAL_ReadBaseImage( baseImage, 0U ),
+                                        1U, records, sizeof( records ) );
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        failedOpenSuffix = OTA_PAL_POSIX_DELTA_BASE_IMAGE_PATH;
+        fopen_Stub( failOpenBySuffix );
+        OTA_PAL_CheckImageNotReplaced( OTA_PAL_CloseReceivedFile( delta, deltaSize ), delta, deltaSize );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with delta images." );
+    #endif
+}
 
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_CloseFile rejects a delta image when the file of
+ * the reconstructed image can't be created.
+ */
+void test_OTAPAL_CloseFile_DeltaPatchedFileCreateFail( void )
+{
+    #if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+        uint8_t delta[ 64 ];
+        uint8_t baseImage[ 1 ];
+        uint32_t deltaSize;
+        const uint8_t records[] = { 0x02, 0x01, 0x00, 0x00, 0x00, 0xAA, 0x00 };
+
+        deltaSize = OTA_PAL_BuildDelta( delta, OTA_PAL_ReadBaseImage( baseImage, 0U ),
+                                        1U, records, sizeof( records ) );
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        failedOpenSuffix = ".patched";
+        fopen_Stub( failOpenBySuffix );
+        OTA_PAL_CheckImageNotReplaced( OTA_PAL_CloseReceivedFile( delta, deltaSize ), delta, deltaSize );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with delta images." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_feof_fail( void )
+/**
+ * @brief Test that otaPal_CloseFile rejects the delta images whose records
+ * can't be applied, and removes their partly reconstructed image.
+ */
+void test_OTAPAL_CloseFile_DeltaRecordsInvalid( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
+    #if ( OTA_PAL_POSIX_DELTA_ENABLED == 1 )
+        uint8_t delta[ 64 ];
+        uint8_t baseImage[ 1 ];
+        uint32_t baseSize = OTA_PAL_ReadBaseImage( baseImage, 0U );
+        uint32_t deltaSize;
+        /* An unknown record type. */
+        const uint8_t unknownRecord[] = { 0x07, 0x00 };
+        /* No END record. */
+        const uint8_t noEnd[] = { 0x02, 0x01, 0x00, 0x00, 0x00, 0xAA };
+        /* A byte after the END record. */
+        const uint8_t trailingByte[] = { 0x02, 0x01, 0x00, 0x00, 0x00, 0xAA, 0x00, 0x00 };
+        /* An ADD record longer than the image. */
+        const uint8_t addTooLong[] = { 0x02, 0x02, 0x00, 0x00, 0x00, 0xAA, 0xBB, 0x00 };
+        /* A COPY record past the end of the base image. */
+        uint8_t copyPastBase[] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 };
+        /* A COPY record cut short. */
+        const uint8_t copyCutShort[] = { 0x01, 0x00, 0x00, 0x00, 0x00 };
+        /* An image shorter than its size. */
+        const uint8_t imageTooShort[] = { 0x02, 0x01, 0x00, 0x00, 0x00, 0xAA, 0x00 };
+        const uint8_t * const pRecords[] =
+        {
+            unknownRecord, noEnd, trailingByte, addTooLong, copyPastBase, copyCutShort, imageTooShort
+        };
+        const uint32_t recordsSizes[] =
+        {
+            sizeof( unknownRecord ), sizeof( noEnd ), sizeof( trailingByte ), sizeof( addTooLong ),
+            sizeof( copyPastBase ), sizeof( copyCutShort ), sizeof( imageTooShort )
+        };
+        uint32_t i;
+
+        copyPastBase[ 1 ] = ( uint8_t ) baseSize;
+        copyPastBase[ 2 ] = ( uint8_t ) ( baseSize >> 8U );
+        copyPastBase[ 3 ] = ( uint8_t ) ( baseSize >> 16U );
+        copyPastBase[ 4 ] = ( uint8_t ) ( baseSize >> 24U );
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+
+        for( i = 0U; i < ( sizeof( pRecords ) / sizeof( pRecords[ 0 ] ) ); i++ )
+        {
+            deltaSize = OTA_PAL_BuildDelta( delta, baseSize, ( pRecords[ i ] == imageTooShort ) ? 2U : 1U,
+                                            pRecords[ i ], recordsSizes[ i ] );
+            OTA_PAL_CheckImageNotReplaced( OTA_PAL_CloseReceivedFile( delta, deltaSize ), delta, deltaSize );
+        }
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with delta images." );
+    #endif
+}
 
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
+/* ====================   OTA PAL GZIP IMAGE UNIT TESTS   =================== */
 
-    /* Test feof failing both times it is called.*/
-    OTA_PAL_FailSingleMock_Except_fread( feof_fn, &expectedImageState );
-    feof_IgnoreAndReturn( 0 );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_CloseFile decompresses a gzip image, checks the
+ * signature of the decompressed image and replaces the receive file with it.
+ */
+void test_OTAPAL_CloseFile_GzipInflated( void )
+{
+    #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+        uint8_t receiveFile[ 64 ];
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseReceivedFile( gzipImage, sizeof( gzipImage ) ) ) );
+
+        TEST_ASSERT_EQUAL( sizeof( gzipImageData ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( gzipImageData, digestedBytes, sizeof( gzipImageData ) );
+        TEST_ASSERT_EQUAL( sizeof( gzipImageData ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( gzipImageData, receiveFile, sizeof( gzipImageData ) );
+        TEST_ASSERT_EQUAL( 0U, OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH ".inflated", receiveFile, sizeof( receiveFile ) ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with gzip images." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_EVP_DigestVerifyFinal_fail( void )
+/**
+ * @brief Test that otaPal_CloseFile decompresses a gzip image larger than
+ * its buffers.
+ */
+void test_OTAPAL_CloseFile_GzipLargeImageInflated( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
+    #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+        static uint8_t receiveFile[ ( 4U * 4096U ) ];
+        static const uint8_t zeros[ sizeof( receiveFile ) ] = { 0 };
+        /* ( 3 * 4096 ) + 5 zero bytes compressed with gzip. */
+        const uint8_t largeImage[] =
+        {
+            0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xED, 0xC1, 0x01, 0x0D, 0x00, 0x00,
+            0x00, 0xC2, 0xA0, 0xF7, 0x4F, 0x6D, 0x0E, 0x37, 0xA0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x80, 0x0B, 0x03, 0x56, 0x7F, 0x08, 0x56, 0x05, 0x30, 0x00, 0x00
+        };
+        const size_t imageSize = ( 3U * 4096U ) + 5U;
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseReceivedFile( largeImage, sizeof( largeImage ) ) ) );
+
+        TEST_ASSERT_EQUAL( imageSize, OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( zeros, receiveFile, imageSize );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with gzip images." );
+    #endif
+}
 
-    /* Test fseek failing. */
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
+/**
+ * @brief Test that otaPal_CloseFile checks the signature of a receive file
+ * that does not start with the gzip magic bytes as it is.
+ */
+void test_OTAPAL_CloseFile_GzipNotCompressed( void )
+{
+    #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+        const uint8_t image[] = { 0x1F, 0x00, 0x11, 0x22 };
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( OTA_PAL_CloseReceivedFile( image, sizeof( image ) ) ) );
+
+        TEST_ASSERT_EQUAL( sizeof( image ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( image, digestedBytes, sizeof( image ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with gzip images." );
+    #endif
+}
 
-    OTA_PAL_FailSingleMock_Except_fread( EVP_DigestVerifyFinal_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_CloseFile rejects a gzip image when the file of the
+ * decompressed image can't be created.
+ */
+void test_OTAPAL_CloseFile_GzipInflatedFileCreateFail( void )
+{
+    #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        failedOpenSuffix = ".inflated";
+        fopen_Stub( failOpenBySuffix );
+        OTA_PAL_CheckImageNotReplaced( OTA_PAL_CloseReceivedFile( gzipImage, sizeof( gzipImage ) ),
+                                       gzipImage, sizeof( gzipImage ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with gzip images." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_EVP_DigestVerifyUpdate_fail( void )
+/**
+ * @brief Test that otaPal_CloseFile rejects the gzip images that can't be
+ * decompressed, and removes their partly decompressed image.
+ */
+void test_OTAPAL_CloseFile_GzipInvalid( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
+    #if ( OTA_PAL_POSIX_GZIP_ENABLED == 1 )
+        uint8_t truncated[ sizeof( gzipImage ) - 1U ];
+        uint8_t trailingByte[ sizeof( gzipImage ) + 1U ];
+        uint8_t corrupted[ sizeof( gzipImage ) ];
+        uint8_t * const pImages[] = { truncated, trailingByte, corrupted };
+        const uint32_t imageSizes[] = { sizeof( truncated ), sizeof( trailingByte ), sizeof( corrupted ) };
+        uint32_t i;
+
+        ( void ) memcpy( truncated, gzipImage, sizeof( truncated ) );
+        ( void ) memcpy( trailingByte, gzipImage, sizeof( gzipImage ) );
+        trailingByte[ sizeof( gzipImage ) ] = 0x00;
+        /* The first block of the stream has the reserved block type. */
+        ( void ) memcpy( corrupted, gzipImage, sizeof( gzipImage ) );
+        corrupted[ 10 ] = 0x07;
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+
+        for( i = 0U; i < ( sizeof( pImages ) / sizeof( pImages[ 0 ] ) ); i++ )
+        {
+            OTA_PAL_CheckImageNotReplaced( OTA_PAL_CloseReceivedFile( pImages[ i ], imageSizes[ i ] ),
+                                           pImages[ i ], imageSizes[ i ] );
+        }
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with gzip images." );
+    #endif
+}
 
-    /* Test fseek failing. */
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
+/* ==================   OTA PAL WRITE BEHIND UNIT TESTS   =================== */
 
-    OTA_PAL_FailSingleMock_Except_fread( EVP_DigestVerifyUpdate_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_CloseFile checks the signature of the blocks queued
+ * for the writer thread once they are written, with more blocks received than
+ * the thread has buffers.
+ */
+void test_OTAPAL_CloseFile_WriteBehindBlocksVerified( void )
+{
+    #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        const uint8_t expectedFile[] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA };
+        const uint32_t blockOffsets[] = { 6U, 0U, 3U, 9U };
+        const uint32_t blockSizes[] = { 3U, 3U, 3U, 1U };
+        uint32_t i;
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        for( i = 0U; i < ( sizeof( blockOffsets ) / sizeof( blockOffsets[ 0 ] ) ); i++ )
+        {
+            TEST_ASSERT_EQUAL_INT( blockSizes[ i ],
+                                   otaPal_WriteBlock( &otaFileContext, blockOffsets[ i ],
+                                                      ( uint8_t * ) &expectedFile[ blockOffsets[ i ] ], blockSizes[ i ] ) );
+        }
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, digestedBytes, sizeof( expectedFile ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write behind thread." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_fseek_fail( void )
+/**
+ * @brief Test that otaPal_WriteBlock writes a block larger than the buffers of
+ * the writer thread itself, after the queued blocks are written.
+ */
+void test_OTAPAL_WriteBlock_WriteBehindLargeBlock( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
+    #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+        static uint8_t largeBlock[ OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_SIZE + 1U ];
+        static uint8_t receiveFile[ sizeof( largeBlock ) + 1U ];
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t lastBlock[] = { 0x11 };
+
+        ( void ) memset( largeBlock, 0x5A, sizeof( largeBlock ) );
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( largeBlock ) + sizeof( lastBlock ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( lastBlock ),
+                               otaPal_WriteBlock( &otaFileContext, sizeof( largeBlock ), lastBlock, sizeof( lastBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( largeBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, largeBlock, sizeof( largeBlock ) ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFile( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL( sizeof( receiveFile ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( largeBlock, receiveFile, sizeof( largeBlock ) );
+        TEST_ASSERT_EQUAL_HEX8( lastBlock[ 0 ], receiveFile[ sizeof( largeBlock ) ] );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write behind thread." );
+    #endif
+}
 
-    /* Test fseek failing. */
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
+/**
+ * @brief Test that otaPal_WriteBlock fails once the writer thread failed to
+ * write an earlier block.
+ */
+void test_OTAPAL_WriteBlock_WriteBehindErrorReported( void )
+{
+    #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        uint8_t data = 0xAA;
+        char memoryFile[ 1 ];
+        int32_t result = 0;
+        uint32_t i;
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( data ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        /* A memory stream has no file descriptor, so the thread fails to
+         * write the blocks. */
+        otaFileContext.pFile = fmemopen( memoryFile, sizeof( memoryFile ), "w+b" );
+        TEST_ASSERT_NOT_NULL( otaFileContext.pFile );
+
+        /* The failure is reported at the latest when a block waits for the
+         * buffer of the block that failed. */
+        for( i = 0U; ( i <= OTA_PAL_POSIX_WRITE_BEHIND_BUFFER_COUNT ) && ( result != -1 ); i++ )
+        {
+            result = otaPal_WriteBlock( &otaFileContext, 0U, &data, sizeof( data ) );
+        }
+
+        TEST_ASSERT_EQUAL_INT( -1, result );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write behind thread." );
+    #endif
+}
 
-    OTA_PAL_FailSingleMock_Except_fread( fseek_alias_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_CloseFile fails without checking the signature when
+ * the writer thread failed to write a queued block.
+ */
+void test_OTAPAL_CloseFile_WriteBehindWriteFail( void )
+{
+    #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t data = 0xAA;
+        char memoryFile[ 1 ];
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( data ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        /* A memory stream has no file descriptor. */
+        otaFileContext.pFile = fmemopen( memoryFile, sizeof( memoryFile ), "w+b" );
+        TEST_ASSERT_NOT_NULL( otaFileContext.pFile );
+        TEST_ASSERT_EQUAL_INT( sizeof( data ), otaPal_WriteBlock( &otaFileContext, 0U, &data, sizeof( data ) ) );
+
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        TEST_ASSERT_EQUAL( 0U, digestedLength );
+        OTA_PAL_CheckSavedImageState( OtaImageStateAborted );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write behind thread." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_fread_fail( void )
+/**
+ * @brief Test that otaPal_Abort writes the queued blocks before closing the
+ * receive file.
+ */
+void test_OTAPAL_Abort_WriteBehindBlocksWritten( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
+    #if ( OTA_PAL_POSIX_WRITE_BEHIND_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        uint8_t firstBlock[] = { 0x11, 0x22 };
+        uint8_t secondBlock[] = { 0x33 };
+        const uint8_t expectedFile[] = { 0x11, 0x22, 0x33 };
+        uint8_t receiveFile[ sizeof( expectedFile ) + 1U ];
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( firstBlock ),
+                               otaPal_WriteBlock( &otaFileContext, 0U, firstBlock, sizeof( firstBlock ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( secondBlock ),
+                               otaPal_WriteBlock( &otaFileContext, sizeof( firstBlock ), secondBlock, sizeof( secondBlock ) ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, receiveFile, sizeof( expectedFile ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write behind thread." );
+    #endif
+}
 
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
+/* ===================   OTA PAL DIRECT I/O UNIT TESTS   ==================== */
 
-    /* Test fread pass then fail. */
-    OTA_PAL_FailSingleMock( none_fn, &expectedImageState );
-    fread_StopIgnore();
-    fread_ExpectAnyArgsAndReturn( 1 );
-    fread_ExpectAnyArgsAndReturn( 0 );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+/**
+ * @brief Test that otaPal_WriteBlock stages the blocks of an extent until all
+ * of its bytes are received, and then writes the extent.
+ */
+void test_OTAPAL_WriteBlock_DirectIoExtentStaged( void )
+{
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        static uint8_t expectedFile[ OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE + 1U ];
+        static uint8_t receiveFile[ sizeof( expectedFile ) + 1U ];
+        static const uint8_t zeros[ OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE ] = { 0 };
+        OtaFileContext_t otaFileContext;
+        const uint32_t extentSize = OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE;
+
+        ( void ) memset( expectedFile, 0x5A, sizeof( expectedFile ) );
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), NULL );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_CreateDirectFile( &otaFileContext );
+
+        /* The last extent is complete with its only byte. It is padded up to
+         * the alignment, and the padding is truncated. */
+        TEST_ASSERT_EQUAL_INT( 1, otaPal_WriteBlock( &otaFileContext, extentSize, &expectedFile[ extentSize ], 1U ) );
+        TEST_ASSERT_EQUAL_INT( extentSize - 1U,
+                               otaPal_WriteBlock( &otaFileContext, 0U, expectedFile, extentSize - 1U ) );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( zeros, receiveFile, extentSize );
+        TEST_ASSERT_EQUAL_HEX8( expectedFile[ extentSize ], receiveFile[ extentSize ] );
+
+        /* The first extent is written with its last byte. */
+        TEST_ASSERT_EQUAL_INT( 1, otaPal_WriteBlock( &otaFileContext, extentSize - 1U, &expectedFile[ extentSize - 1U ], 1U ) );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, receiveFile, sizeof( expectedFile ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with direct I/O." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_BIO_new( void )
+/**
+ * @brief Test that otaPal_WriteBlock writes the extent with the lowest offset
+ * partially when all the buffers are in use, and reads it back when one of
+ * its blocks arrives later.
+ */
+void test_OTAPAL_WriteBlock_DirectIoExtentEvicted( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
-    BIO dummyBIO;
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        static uint8_t expectedFile[ ( OTA_PAL_POSIX_DIRECT_IO_EXTENT_COUNT + 1U ) * OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE ];
+        static uint8_t receiveFile[ sizeof( expectedFile ) + 1U ];
+        static const uint8_t zeros[ OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE ] = { 0 };
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        const uint32_t extentSize = OTA_PAL_POSIX_DIRECT_IO_EXTENT_SIZE;
+        uint32_t offset;
+        uint32_t i;
+
+        for( i = 0U; i < sizeof( expectedFile ); i++ )
+        {
+            expectedFile[ i ] = ( uint8_t ) ( ( i * 7U ) + 1U );
+        }
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        OTA_PAL_CreateDirectFile( &otaFileContext );
+
+        /* The first byte of each extent is received first. There is one more
+         * extent than buffers, so the first extent is written with its only
+         * byte. */
+        for( offset = 0U; offset < sizeof( expectedFile ); offset += extentSize )
+        {
+            TEST_ASSERT_EQUAL_INT( 1, otaPal_WriteBlock( &otaFileContext, offset, &expectedFile[ offset ], 1U ) );
+        }
+
+        TEST_ASSERT_EQUAL( extentSize,
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8( expectedFile[ 0 ], receiveFile[ 0 ] );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( zeros, &receiveFile[ 1 ], extentSize - 1U );
+
+        /* Each extent staged again keeps the byte written before. */
+        for( offset = 0U; offset < sizeof( expectedFile ); offset += extentSize )
+        {
+            TEST_ASSERT_EQUAL_INT( extentSize - 1U,
+                                   otaPal_WriteBlock( &otaFileContext, offset + 1U, &expectedFile[ offset + 1U ], extentSize - 1U ) );
+        }
+
+        posix_fadvise_ExpectAnyArgsAndReturn( 0 );
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, receiveFile, sizeof( expectedFile ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with direct I/O." );
+    #endif
+}
 
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
+/**
+ * @brief Test that otaPal_WriteBlock fails for a block ending past the end of
+ * the receive file.
+ */
+void test_OTAPAL_WriteBlock_DirectIoBlockPastEnd( void )
+{
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        uint8_t block[] = { 0x11, 0x22, 0x33 };
 
-    /* Test OpenSSL/bio.h functions failing. */
-    OTA_PAL_FailSingleMock_Except_fread( none_fn, &expectedImageState );
-    BIO_new_StopIgnore();
-    BIO_ctrl_StopIgnore();
-    BIO_new_ExpectAnyArgsAndReturn( &dummyBIO );
-    BIO_ctrl_ExpectAnyArgsAndReturn( 0 );
-    BIO_new_ExpectAnyArgsAndReturn( NULL );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ) - 1U, NULL );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_CreateDirectFile( &otaFileContext );
 
+        TEST_ASSERT_EQUAL_INT( -1, otaPal_WriteBlock( &otaFileContext, 1U, block, sizeof( block ) - 1U ) );
+        TEST_ASSERT_EQUAL_INT( -1, otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
 
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
-    OTA_PAL_FailSingleMock_Except_fread( BIO_new_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalBadSignerCert, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with direct I/O." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_BIO_read_filename_fail( void )
+/**
+ * @brief Test that otaPal_CloseFile writes the staged extents before checking
+ * the signature, and drops the pages of the image from the page cache.
+ */
+void test_OTAPAL_CloseFile_DirectIoStagedExtentsWritten( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
-
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
-
-    OTA_PAL_FailSingleMock_Except_fread( BIO_read_filename_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        OtaPalStatus_t result;
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t block[] = { 0x11, 0x22 };
+        /* The bytes not received are read as zeros. */
+        const uint8_t expectedFile[] = { 0x11, 0x22, 0x00, 0x00 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        OTA_PAL_CreateDirectFile( &otaFileContext );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        posix_fadvise_ExpectAnyArgsAndReturn( 0 );
+        result = otaPal_CloseFile( &otaFileContext );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, digestedBytes, sizeof( expectedFile ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with direct I/O." );
+    #endif
 }
 
-void test_OTAPAL_CloseFile_EVP_DigestVerifyInit_fail( void )
+/**
+ * @brief Test that otaPal_Abort discards the staged extents.
+ */
+void test_OTAPAL_Abort_DirectIoExtentsDiscarded( void )
 {
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
-
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
-
-    OTA_PAL_FailSingleMock_Except_fread( EVP_DigestVerifyInit_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( result ) );
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        uint8_t block[] = { 0x11, 0x22 };
+        uint8_t receiveFile[ sizeof( block ) ];
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ) + 1U, NULL );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_CreateDirectFile( &otaFileContext );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        TEST_ASSERT_EQUAL( 0U, OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with direct I/O." );
+    #endif
 }
 
 /**
- * @brief Test that otaPal_CloseFile properly handles receiving fread returning
- * data that is the maximum size. The maximum size is based on the OTA PAL
- * implementation. It is defined by the "OTA_PAL_POSIX_BUF_SIZE" macro in the
- * OTA posix PAL implementation .c file.
+ * @brief Test that the blocks are written through the page cache when the
+ * buffers of the extents can't be allocated.
  */
-void test_OTAPAL_CloseFile_MaxBlockSize( void )
+void test_OTAPAL_CreateFileForRx_DirectIoAllocFail( void )
 {
-    const size_t OTA_PAL_POSIX_BUF_SIZE = 4096U;
-    OtaPalStatus_t result;
-    OtaFileContext_t otaFileContext;
-    Sig256_t dummySig;
-    OtaImageState_t expectedImageState = OtaImageStateTesting;
-    FILE dummyFile;
-
-    otaFileContext.pSignature = &dummySig;
-    otaFileContext.pFile = &dummyFile;
-
-    /* Simulate the scenario where fread returns a max size block and then it
-     * returns a value less than the max size. */
-    fread_IgnoreAndReturn( OTA_PAL_POSIX_BUF_SIZE );
-    fread_IgnoreAndReturn( 0 );
-    OTA_PAL_FailSingleMock( none_fn, &expectedImageState );
-    result = otaPal_CloseFile( &otaFileContext );
-    TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( result ) );
+    #if ( OTA_PAL_POSIX_DIRECT_IO_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        uint8_t block[] = { 0x11, 0x22 };
+        uint8_t receiveFile[ sizeof( block ) + 1U ];
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ) + 1U, NULL );
+        OTA_PAL_StubFileApis();
+        posix_memalign_Stub( failAlignedAllocation );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        /* The block is written at once, although its extent is not
+         * complete. */
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL( sizeof( block ), OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( block, receiveFile, sizeof( block ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with direct I/O." );
+    #endif
 }
 
-/* ===================   OTA PAL WRITE BLOCK UNIT TESTS   =================== */
+/* ===================   OTA PAL WRITE-BACK UNIT TESTS   ==================== */
 
 /**
- * @brief Test that otaPal_WriteBlock will return correct result code.
+ * @brief Check a range passed to sync_file_range().
  */
-void test_OTAPAL_WriteBlock_NullFileContext( void )
+static void OTA_PAL_CheckFileRange( int call,
+                                    off_t offset,
+                                    off_t nbytes,
+                                    unsigned int flags )
 {
-    int16_t result = 0;
-    uint8_t data = 0xAA;
-    uint32_t blockSize = 1;
-
-    result = otaPal_WriteBlock( NULL, 0, &data, blockSize );
-    TEST_ASSERT_EQUAL( -1, result );
+    TEST_ASSERT_EQUAL_INT( offset, fileRanges[ call ].offset );
+    TEST_ASSERT_EQUAL_INT( nbytes, fileRanges[ call ].nbytes );
+    TEST_ASSERT_EQUAL_HEX( flags, fileRanges[ call ].flags );
 }
 
 /**
- * @brief Test that otaPal_WriteBlock will return correct result code.
+ * @brief Test that otaPal_WriteBlock starts the write-back of each full
+ * window, and then waits for the previous one.
  */
-void test_OTAPAL_WriteBlock_WriteSingleByte( void )
+void test_OTAPAL_WriteBlock_WriteBackWindowFull( void )
 {
-    int16_t numBytesWritten;
-    uint8_t data = 0xAA;
-    uint32_t blockSize = 1;
-    OtaFileContext_t otaFileContext;
+    #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+        static uint8_t expectedFile[ 2U * OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE ];
+        static uint8_t receiveFile[ sizeof( expectedFile ) + 1U ];
+        OtaFileContext_t otaFileContext;
+        const uint32_t windowSize = OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE;
+        const uint32_t halfWindow = OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE / 2U;
+        uint32_t i;
+
+        for( i = 0U; i < sizeof( expectedFile ); i++ )
+        {
+            expectedFile[ i ] = ( uint8_t ) ( i + 1U );
+        }
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( expectedFile ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+
+        /* The window spans the blocks written since the last write-back,
+         * whatever their order. */
+        TEST_ASSERT_EQUAL_INT( halfWindow, otaPal_WriteBlock( &otaFileContext, halfWindow, &expectedFile[ halfWindow ], halfWindow ) );
+        TEST_ASSERT_EQUAL_INT( 0, fileRangeCount );
+        TEST_ASSERT_EQUAL_INT( halfWindow, otaPal_WriteBlock( &otaFileContext, 0U, expectedFile, halfWindow ) );
+        TEST_ASSERT_EQUAL_INT( 1, fileRangeCount );
+        OTA_PAL_CheckFileRange( 0, 0, windowSize, SYNC_FILE_RANGE_WRITE );
+
+        TEST_ASSERT_EQUAL_INT( windowSize, otaPal_WriteBlock( &otaFileContext, windowSize, &expectedFile[ windowSize ], windowSize ) );
+        TEST_ASSERT_EQUAL_INT( 3, fileRangeCount );
+        OTA_PAL_CheckFileRange( 1, windowSize, windowSize, SYNC_FILE_RANGE_WRITE );
+        OTA_PAL_CheckFileRange( 2, 0, windowSize,
+                                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER );
+
+        TEST_ASSERT_EQUAL( sizeof( expectedFile ),
+                           OTA_PAL_ReadFile( OTA_PAL_TEST_FILE_PATH, receiveFile, sizeof( receiveFile ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( expectedFile, receiveFile, sizeof( expectedFile ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write-back." );
+    #endif
+}
 
-    /* TEST: Write a byte of data. */
-    otaFileContext.pFilePath = ( uint8_t * ) "placeholder";
-    fseek_alias_ExpectAnyArgsAndReturn( 0 );
-    fwrite_alias_ExpectAnyArgsAndReturn( blockSize );
-    numBytesWritten = otaPal_WriteBlock( &otaFileContext, 0, &data, blockSize );
-    TEST_ASSERT_EQUAL_INT( blockSize, numBytesWritten );
+/**
+ * @brief Test that otaPal_WriteBlock stops the write-back when its start
+ * fails, and still writes the blocks.
+ */
+void test_OTAPAL_WriteBlock_WriteBackStartFailed( void )
+{
+    #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+        static uint8_t block[ OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE ];
+        OtaFileContext_t otaFileContext;
+
+        OTA_PAL_InitFileContext( &otaFileContext, 2U * sizeof( block ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        failedFileRangeCall = 0;
+
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, sizeof( block ), block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL_INT( 1, fileRangeCount );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write-back." );
+    #endif
 }
 
 /**
- * @brief Test that otaPal_WriteBlock will return correct result code.
+ * @brief Test that otaPal_WriteBlock stops the write-back when waiting for the
+ * previous window fails, and still writes the blocks.
  */
-void test_OTAPAL_WriteBlock_WriteMultipleBytes( void )
+void test_OTAPAL_WriteBlock_WriteBackWaitFailed( void )
 {
-    int16_t numBytesWritten;
-    size_t index = 0;
-    uint8_t pData[] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE };
-    uint32_t blockSize = sizeof( pData[ 0 ] );
-    OtaFileContext_t otaFileContext;
+    #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+        static uint8_t block[ OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE ];
+        OtaFileContext_t otaFileContext;
+
+        OTA_PAL_InitFileContext( &otaFileContext, 3U * sizeof( block ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        failedFileRangeCall = 2;
+
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, sizeof( block ), block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 2U * sizeof( block ), block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL_INT( 3, fileRangeCount );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write-back." );
+    #endif
+}
 
-    /* TEST: Write multiple bytes of data. */
-    for( index = 0; index < ( sizeof( pData ) / sizeof( pData[ 0 ] ) ); index++ )
-    {
-        fseek_alias_ExpectAnyArgsAndReturn( 0 );
-        fwrite_alias_ExpectAnyArgsAndReturn( blockSize );
-        numBytesWritten = otaPal_WriteBlock( &otaFileContext, index * blockSize, pData, blockSize );
-        TEST_ASSERT_EQUAL_INT( blockSize, numBytesWritten );
-    }
+/**
+ * @brief Test that otaPal_Abort stops the write-back, and that the next
+ * receive file starts with an empty window.
+ */
+void test_OTAPAL_Abort_WriteBackStopped( void )
+{
+    #if ( OTA_PAL_POSIX_WRITEBACK_ENABLED == 1 )
+        static uint8_t block[ OTA_PAL_POSIX_WRITEBACK_WINDOW_SIZE / 2U ];
+        OtaFileContext_t otaFileContext;
+
+        OTA_PAL_InitFileContext( &otaFileContext, 2U * sizeof( block ), NULL );
+        OTA_PAL_StubFileApis();
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL_INT( 0, fileRangeCount );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, sizeof( block ), block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL_INT( 1, fileRangeCount );
+        OTA_PAL_CheckFileRange( 0, 0, 2U * sizeof( block ), SYNC_FILE_RANGE_WRITE );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_Abort( &otaFileContext ) ) );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the write-back." );
+    #endif
 }
 
+/* =================   OTA PAL ASYNC VERIFY UNIT TESTS   ==================== */
+
 /**
- * @brief Test that otaPal_WriteBlock will return correct result code.
+ * @brief Test that otaPal_CloseFileAsync fails for a NULL context or callback.
  */
-void test_OTAPAL_WriteBlock_FseekError( void )
+void test_OTAPAL_CloseFileAsync_NullInput( void )
 {
-    int16_t numBytesWritten;
-    uint8_t data = 0xAA;
-    uint32_t blockSize = 1;
-    const int16_t fseek_error_num = 1; /* fseek returns a non-zero number on error. */
-    OtaFileContext_t validFileContext;
+    #if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+
+        OTA_PAL_InitFileContext( &otaFileContext, 1U, NULL );
+
+        TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( NULL, recordVerification, NULL ) ) );
+        TEST_ASSERT_EQUAL( OtaPalFileClose, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( &otaFileContext, NULL, NULL ) ) );
+        otaPal_WaitForVerifications();
+        TEST_ASSERT_EQUAL( 0U, verifiedCount );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the async verification." );
+    #endif
+}
 
-    /* TEST: Write a byte of data. */
-    fseek_alias_ExpectAnyArgsAndReturn( fseek_error_num );
-    numBytesWritten = otaPal_WriteBlock( &validFileContext, 0, &data, blockSize );
-    TEST_ASSERT_EQUAL_INT( -1, numBytesWritten );
+/**
+ * @brief Test that otaPal_CloseFileAsync verifies the file on a worker thread
+ * with copies of its context, so that the context can be changed once it
+ * returns.
+ */
+void test_OTAPAL_CloseFileAsync_VerifiedOnWorkerThread( void )
+{
+    #if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        char filePath[] = OTA_PAL_TEST_FILE_PATH;
+        uint8_t block[] = { 0x11, 0x22, 0x33 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        otaFileContext.pFilePath = ( uint8_t * ) filePath;
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( &otaFileContext, recordVerification, NULL ) ) );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        ( void ) memset( filePath, 'x', sizeof( filePath ) - 1U );
+
+        otaPal_WaitForVerifications();
+        TEST_ASSERT_EQUAL( 1U, verifiedCount );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( verifiedResults[ 0 ] ) );
+        TEST_ASSERT_EQUAL_STRING( OTA_PAL_TEST_FILE_PATH, verifiedFilePath );
+        TEST_ASSERT_FALSE( verifiedFileOpen );
+        TEST_ASSERT_FALSE( verifiedOnTestThread );
+        TEST_ASSERT_EQUAL( sizeof( block ), digestedLength );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( block, digestedBytes, sizeof( block ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the async verification." );
+    #endif
 }
 
 /**
- * @brief Test that otaPal_WriteBlock will return correct result code.
+ * @brief Test that a file of an update passing its verification after another
+ * one failed it does not mark the image for testing, until
+ * otaPal_WaitForVerifications ends the update.
  */
-void test_OTAPAL_WriteBlock_FwriteError( void )
+void test_OTAPAL_CloseFileAsync_BundleFailed( void )
 {
-    int16_t numBytesWritten;
-    uint8_t data = 0xAA;
-    uint32_t blockSize = 1;
-    OtaFileContext_t validFileContext;
-    const int32_t fseekSuccessReturn = 0; /* fseek returns a zero on success. */
-    const size_t fwriteErrorReturn = 0;   /* fwrite returns a number less than the requested number of bytes to write on error. */
-    const int16_t writeblockErrorReturn = -1;
+    #if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t block[] = { 0x11, 0x22, 0x33 };
+
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+
+        /* The first file fails its check, as it has no signature. */
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), NULL );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( &otaFileContext, recordVerification, NULL ) ) );
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        otaFileContext.pFilePath = ( uint8_t * ) OTA_PAL_TEST_SECOND_FILE_PATH;
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( &otaFileContext, recordVerification, NULL ) ) );
+
+        otaPal_WaitForVerifications();
+        TEST_ASSERT_EQUAL( 2U, verifiedCount );
+        TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( verifiedResults[ 0 ] ) );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( verifiedResults[ 1 ] ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateAborted );
+
+        /* The file of the next update marks the image for testing. */
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( &otaFileContext, recordVerification, NULL ) ) );
+
+        otaPal_WaitForVerifications();
+        TEST_ASSERT_EQUAL( 3U, verifiedCount );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( verifiedResults[ 2 ] ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the async verification." );
+    #endif
+}
 
-    fseek_alias_ExpectAnyArgsAndReturn( fseekSuccessReturn );
-    fwrite_alias_ExpectAnyArgsAndReturn( fwriteErrorReturn );
+/**
+ * @brief Test that otaPal_CloseFileAsync verifies the file before it returns
+ * when the path of its signer certificate is too long to be copied.
+ */
+void test_OTAPAL_CloseFileAsync_PathTooLong( void )
+{
+    #if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        char certFilePath[ OTA_FILE_PATH_LENGTH_MAX + 1U ];
+        uint8_t block[] = { 0x11, 0x22, 0x33 };
+
+        ( void ) memset( certFilePath, 'c', sizeof( certFilePath ) - 1U );
+        certFilePath[ sizeof( certFilePath ) - 1U ] = '\0';
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        otaFileContext.pCertFilepath = ( uint8_t * ) certFilePath;
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 1 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( &otaFileContext, recordVerification, NULL ) ) );
+        TEST_ASSERT_EQUAL( 1U, verifiedCount );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( verifiedResults[ 0 ] ) );
+        TEST_ASSERT_TRUE( verifiedOnTestThread );
+        TEST_ASSERT_NULL( otaFileContext.pFile );
+        OTA_PAL_CheckSavedImageState( OtaImageStateTesting );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the async verification." );
+    #endif
+}
 
-    /* fwrite returns a number less than the amount requested to write on error. */
-    numBytesWritten = otaPal_WriteBlock( &validFileContext, 0, &data, blockSize );
-    TEST_ASSERT_EQUAL_INT( writeblockErrorReturn, numBytesWritten );
+/**
+ * @brief Test that otaPal_CloseFileAsync passes the result of a failed
+ * signature check to the callback, and marks the image aborted.
+ */
+void test_OTAPAL_CloseFileAsync_SignatureCheckFailed( void )
+{
+    #if ( OTA_PAL_POSIX_ASYNC_VERIFY_ENABLED == 1 )
+        OtaFileContext_t otaFileContext;
+        Sig256_t signature = { 0 };
+        uint8_t block[] = { 0x11, 0x22, 0x33 };
+
+        OTA_PAL_InitFileContext( &otaFileContext, sizeof( block ), &signature );
+        OTA_PAL_StubFileApis();
+        OTA_PAL_StubSignatureCheck( 0 );
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CreateFileForRx( &otaFileContext ) ) );
+        TEST_ASSERT_EQUAL_INT( sizeof( block ), otaPal_WriteBlock( &otaFileContext, 0U, block, sizeof( block ) ) );
+
+        TEST_ASSERT_EQUAL( OtaPalSuccess, OTA_PAL_MAIN_ERR( otaPal_CloseFileAsync( &otaFileContext, recordVerification, NULL ) ) );
+
+        otaPal_WaitForVerifications();
+        TEST_ASSERT_EQUAL( 1U, verifiedCount );
+        TEST_ASSERT_EQUAL( OtaPalSignatureCheckFailed, OTA_PAL_MAIN_ERR( verifiedResults[ 0 ] ) );
+        OTA_PAL_CheckSavedImageState( OtaImageStateAborted );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with the async verification." );
+    #endif
 }
 
 /* ===============   OTA PAL ACTIVATE NEW IMAGE UNIT TESTS   ================ */
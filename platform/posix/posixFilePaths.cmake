@@ -5,6 +5,23 @@
 # Files specific to the repository such as test runner, platform tests
 # are not added to the variables.
 
+# Metrics registry and exporters source files.
+set( METRICS_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/metrics_posix.c
+     ${CMAKE_CURRENT_LIST_DIR}/metrics_export_posix.c )
+
+# Allocator source files.
+set( ALLOCATOR_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/allocator_posix.c )
+
+# Thread groups source files.
+set( THREAD_GROUPS_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/thread_groups_posix.c )
+
+# Work pool source files.
+set( WORK_POOL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/work_pool_posix.c )
+
 # Sockets utility source files.
 set( SOCKETS_SOURCES
      ${CMAKE_CURRENT_LIST_DIR}/transport/src/sockets_posix.c )
@@ -17,6 +34,44 @@ set( PLAINTEXT_TRANSPORT_SOURCES
 set( OPENSSL_TRANSPORT_SOURCES
      ${CMAKE_CURRENT_LIST_DIR}/transport/src/openssl_posix.c )
 
+# mbedTLS transport source files.
+set( MBEDTLS_TRANSPORT_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/mbedtls_posix.c )
+
+# In-memory transport source files.
+set( MEMORY_TRANSPORT_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/memory_transport_posix.c )
+
+# Capture and replay transport source files.
+set( CAPTURE_TRANSPORT_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/capture_transport_posix.c
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/replay_transport_posix.c )
+
+# io_uring transport source files.
+set( URING_TRANSPORT_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/uring_posix.c )
+
+# Wrappers of the io_uring system calls used by the io_uring transport.
+set( URING_SYSCALLS_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/uring_syscalls_posix.c )
+
+# Timer wheel source files.
+set( TIMER_WHEEL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/timer_wheel_posix.c )
+
+# Event loop source files.
+set( EVENT_LOOP_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/event_loop_posix.c
+     ${TIMER_WHEEL_SOURCES} )
+
+# Reconnect scheduler source files.
+set( RECONNECT_SCHEDULER_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/reconnect_scheduler_posix.c )
+
+# Reactor pool source files.
+set( REACTOR_POOL_SOURCES
+     ${CMAKE_CURRENT_LIST_DIR}/transport/src/reactor_pool_posix.c )
+
 # Transport Public Include directories.
 set( COMMON_TRANSPORT_INCLUDE_PUBLIC_DIRS
      ${CMAKE_CURRENT_LIST_DIR}/transport/include
@@ -0,0 +1,177 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file random_posix.c
+ * @brief Implementation of the functions in random.h for POSIX systems, on
+ * the getrandom system call of Linux.
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <string.h>
+
+/* POSIX include. Allow the default POSIX header to be overridden. */
+#ifdef POSIX_RANDOM_HEADER
+    #include POSIX_RANDOM_HEADER
+#else
+    #include <sys/random.h>
+#endif
+
+/* Platform random include. */
+#include "random.h"
+
+/**
+ * @brief Length of the buffer of random bytes of each thread.
+ *
+ * A request of this length to getrandom does not block once the CSPRNG of
+ * the kernel is initialized, and is never interrupted by a signal.
+ */
+#ifndef RANDOM_BUFFER_LENGTH
+    #define RANDOM_BUFFER_LENGTH    ( 256U )
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Random bytes of the calling thread not served yet, at the end of
+ * the buffer.
+ */
+static __thread uint8_t randomBuffer[ RANDOM_BUFFER_LENGTH ];
+
+/**
+ * @brief Offset of the first byte of #randomBuffer not served yet;
+ * #RANDOM_BUFFER_LENGTH if the buffer is empty.
+ */
+static __thread size_t randomOffset = RANDOM_BUFFER_LENGTH;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Fill a buffer with random bytes from the kernel.
+ *
+ * @param[out] pBuffer Buffer to fill.
+ * @param[in] length Length of pBuffer.
+ *
+ * @return true if pBuffer is filled; false otherwise.
+ */
+static bool readRandom( uint8_t * pBuffer,
+                        size_t length );
+
+/*-----------------------------------------------------------*/
+
+static bool readRandom( uint8_t * pBuffer,
+                        size_t length )
+{
+    bool returnStatus = true;
+    size_t filled = 0U;
+    ssize_t bytesRead = 0;
+
+    /* Requests longer than 256 bytes may be cut short by a signal. */
+    while( ( returnStatus == true ) && ( filled < length ) )
+    {
+        bytesRead = getrandom( &pBuffer[ filled ], length - filled, 0U );
+
+        if( bytesRead > 0 )
+        {
+            filled += ( size_t ) bytesRead;
+        }
+        else if( ( bytesRead < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted before any byte was read. */
+        }
+        else
+        {
+            returnStatus = false;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Random_GetBytes( void * pBuffer,
+                      size_t length )
+{
+    bool returnStatus = true;
+    uint8_t * pOutput = ( uint8_t * ) pBuffer;
+    size_t served = 0U;
+    size_t chunk = 0U;
+
+    /* Requests as long as the buffer would empty it anyway. */
+    if( length >= RANDOM_BUFFER_LENGTH )
+    {
+        returnStatus = readRandom( pOutput, length );
+    }
+
+    while( ( returnStatus == true ) && ( length < RANDOM_BUFFER_LENGTH ) && ( served < length ) )
+    {
+        if( randomOffset == RANDOM_BUFFER_LENGTH )
+        {
+            returnStatus = readRandom( randomBuffer, RANDOM_BUFFER_LENGTH );
+            randomOffset = ( returnStatus == true ) ? 0U : RANDOM_BUFFER_LENGTH;
+        }
+
+        if( returnStatus == true )
+        {
+            chunk = RANDOM_BUFFER_LENGTH - randomOffset;
+
+            if( chunk > ( length - served ) )
+            {
+                chunk = length - served;
+            }
+
+            ( void ) memcpy( &pOutput[ served ], &randomBuffer[ randomOffset ], chunk );
+
+            /* The bytes served are erased, so that they cannot be served
+             * again or read back from the buffer. */
+            ( void ) memset( &randomBuffer[ randomOffset ], 0, chunk );
+            randomOffset += chunk;
+            served += chunk;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t Random_GetUint32( void )
+{
+    uint32_t value = 0U;
+
+    if( Random_GetBytes( &value, sizeof( value ) ) == false )
+    {
+        value = 0U;
+    }
+
+    return value;
+}
+
+/*-----------------------------------------------------------*/
+
+void Random_Reset( void )
+{
+    ( void ) memset( randomBuffer, 0, sizeof( randomBuffer ) );
+    randomOffset = RANDOM_BUFFER_LENGTH;
+}
@@ -0,0 +1,751 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file thread_groups_posix.c
+ * @brief Implementation of the thread groups of thread_groups.h for Linux.
+ *
+ * The groups are only read and written under a mutex, when threads are
+ * created or buffers allocated, never on the paths of the threads once they
+ * run.
+ */
+
+/* cpu_set_t, pthread_attr_setaffinity_np and pthread_setname_np are GNU
+ * extensions. */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+/* Standard includes. */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Linux includes. */
+#include <linux/mempolicy.h>
+
+/* Thread groups include. */
+#include "thread_groups.h"
+
+/**
+ * @brief Highest number of NUMA nodes looked up, the bits of the node mask
+ * given to mbind.
+ */
+#define MAX_NODE_COUNT          ( sizeof( unsigned long ) * ( size_t ) CHAR_BIT )
+
+/**
+ * @brief Size of the buffer reading the cpulist of a node.
+ */
+#define CPU_LIST_BUFFER_SIZE    ( 1024U )
+
+/**
+ * @brief Size of the name of a thread, terminator included, as limited by
+ * the kernel.
+ */
+#define THREAD_NAME_SIZE        ( 16U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A group of threads sharing CPUs.
+ */
+typedef struct ThreadGroup
+{
+    char name[ THREAD_GROUP_NAME_MAX_LENGTH + 1U ]; /**< @brief Name of the group, NUL terminated. */
+    cpu_set_t cpus;                                 /**< @brief CPUs of the threads of the group. */
+    int32_t node;                                   /**< @brief NUMA node of #ThreadGroup_t.cpus, or #THREAD_GROUP_NO_NODE. */
+    uint32_t threadCount;                           /**< @brief Number of threads created in the group, the index of the next one. */
+    bool isolated;                                  /**< @brief Whether #ThreadGroup_t.cpus is dedicated to the group. */
+    bool defined;                                   /**< @brief Whether the entry is in use. */
+} ThreadGroup_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The groups defined.
+ */
+static ThreadGroup_t groups[ THREAD_GROUP_MAX_COUNT ];
+
+/**
+ * @brief The CPUs the process may run on, read on first use.
+ */
+static cpu_set_t availableCpus;
+
+/**
+ * @brief Whether #availableCpus was read.
+ */
+static bool availableCpusRead = false;
+
+/**
+ * @brief The CPUs dedicated to an isolated group.
+ */
+static cpu_set_t isolatedCpus;
+
+/**
+ * @brief Number of threads created in the groups that are not defined, the
+ * index of the next one.
+ */
+static uint32_t undefinedThreadCount = 0U;
+
+/**
+ * @brief Serializes the access to the groups.
+ */
+static pthread_mutex_t groupMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Check the name of a group.
+ *
+ * @param[in] pName The name.
+ *
+ * @return true if the name has 1 to #THREAD_GROUP_NAME_MAX_LENGTH
+ * characters; false otherwise.
+ */
+static bool isValidName( const char * pName );
+
+/**
+ * @brief Find a defined group. The mutex must be held.
+ *
+ * @param[in] pName Name of the group.
+ *
+ * @return The group; NULL if it is not defined.
+ */
+static ThreadGroup_t * findGroup( const char * pName );
+
+/**
+ * @brief Find a group, or define it without CPUs. The mutex must be held.
+ *
+ * @param[in] pName Name of the group.
+ *
+ * @return The group; NULL if #THREAD_GROUP_MAX_COUNT groups are defined.
+ */
+static ThreadGroup_t * addGroup( const char * pName );
+
+/**
+ * @brief Parse a cpulist, such as "0-3,8".
+ *
+ * @param[in] pCpuList The cpulist, which may end with a newline.
+ * @param[out] pCpus The CPUs of the list.
+ *
+ * @return true if the list is valid; false otherwise.
+ */
+static bool parseCpuList( const char * pCpuList,
+                          cpu_set_t * pCpus );
+
+/**
+ * @brief Read #availableCpus, if not read yet. The mutex must be held.
+ */
+static void readAvailableCpus( void );
+
+/**
+ * @brief Recompute #isolatedCpus from the isolated groups. The mutex must be
+ * held.
+ */
+static void updateIsolatedCpus( void );
+
+/**
+ * @brief Find the NUMA node holding all the CPUs of a set.
+ *
+ * @param[in] pCpus The CPUs.
+ *
+ * @return The node; #THREAD_GROUP_NO_NODE if there is none.
+ */
+static int32_t findNode( const cpu_set_t * pCpus );
+
+/**
+ * @brief Get the CPUs of the next thread of a group.
+ *
+ * @param[in] pName Name of the group, which need not be defined.
+ * @param[out] pCpus The CPUs.
+ * @param[out] pIndex Index of the thread in the group; NULL if no thread is
+ * created.
+ */
+static void getPlacement( const char * pName,
+                          cpu_set_t * pCpus,
+                          uint32_t * pIndex );
+
+/**
+ * @brief Round a size up to whole pages.
+ *
+ * @param[in] size The size.
+ *
+ * @return The size of the pages; 0 if it overflows.
+ */
+static size_t roundToPages( size_t size );
+
+/*-----------------------------------------------------------*/
+
+static bool isValidName( const char * pName )
+{
+    return ( pName != NULL ) &&
+           ( pName[ 0 ] != '\0' ) &&
+           ( strnlen( pName, THREAD_GROUP_NAME_MAX_LENGTH + 1U ) <= THREAD_GROUP_NAME_MAX_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+static ThreadGroup_t * findGroup( const char * pName )
+{
+    ThreadGroup_t * pGroup = NULL;
+    uint32_t i = 0U;
+
+    for( i = 0U; ( i < THREAD_GROUP_MAX_COUNT ) && ( pGroup == NULL ); i++ )
+    {
+        if( ( groups[ i ].defined == true ) && ( strcmp( groups[ i ].name, pName ) == 0 ) )
+        {
+            pGroup = &( groups[ i ] );
+        }
+    }
+
+    return pGroup;
+}
+
+/*-----------------------------------------------------------*/
+
+static ThreadGroup_t * addGroup( const char * pName )
+{
+    ThreadGroup_t * pGroup = findGroup( pName );
+    uint32_t i = 0U;
+
+    for( i = 0U; ( i < THREAD_GROUP_MAX_COUNT ) && ( pGroup == NULL ); i++ )
+    {
+        if( groups[ i ].defined == false )
+        {
+            pGroup = &( groups[ i ] );
+            ( void ) memset( pGroup, 0, sizeof( ThreadGroup_t ) );
+            ( void ) strncpy( pGroup->name, pName, THREAD_GROUP_NAME_MAX_LENGTH );
+            CPU_ZERO( &( pGroup->cpus ) );
+            pGroup->node = THREAD_GROUP_NO_NODE;
+            pGroup->defined = true;
+        }
+    }
+
+    return pGroup;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool parseCpuList( const char * pCpuList,
+                          cpu_set_t * pCpus )
+{
+    bool valid = true;
+    const char * pCursor = pCpuList;
+    char * pEnd = NULL;
+    unsigned long first = 0UL;
+    unsigned long last = 0UL;
+    unsigned long cpu = 0UL;
+
+    CPU_ZERO( pCpus );
+
+    /* An empty list, as a node without CPUs has, is valid. */
+    while( ( valid == true ) && ( *pCursor != '\0' ) && ( *pCursor != '\n' ) )
+    {
+        first = strtoul( pCursor, &pEnd, 10 );
+        valid = ( pEnd != pCursor ) && ( *pCursor >= '0' ) && ( *pCursor <= '9' );
+        last = first;
+
+        if( ( valid == true ) && ( *pEnd == '-' ) )
+        {
+            pCursor = &( pEnd[ 1 ] );
+            last = strtoul( pCursor, &pEnd, 10 );
+            valid = ( pEnd != pCursor ) && ( *pCursor >= '0' ) && ( *pCursor <= '9' ) && ( last >= first );
+        }
+
+        if( valid == true )
+        {
+            valid = ( last < ( unsigned long ) CPU_SETSIZE ) &&
+                    ( ( *pEnd == ',' ) || ( *pEnd == '\0' ) || ( *pEnd == '\n' ) );
+        }
+
+        if( valid == true )
+        {
+            for( cpu = first; cpu <= last; cpu++ )
+            {
+                CPU_SET( ( size_t ) cpu, pCpus );
+            }
+
+            /* A list does not end with a separator. */
+            if( *pEnd == ',' )
+            {
+                pCursor = &( pEnd[ 1 ] );
+                valid = ( *pCursor != '\0' ) && ( *pCursor != '\n' );
+            }
+            else
+            {
+                pCursor = pEnd;
+            }
+        }
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static void readAvailableCpus( void )
+{
+    long cpuCount = 0L;
+    long cpu = 0L;
+
+    if( availableCpusRead == false )
+    {
+        CPU_ZERO( &availableCpus );
+
+        if( sched_getaffinity( 0, sizeof( availableCpus ), &availableCpus ) != 0 )
+        {
+            /* Without its affinity, the process is taken to run on every
+             * CPU of the host. */
+            CPU_ZERO( &availableCpus );
+            cpuCount = sysconf( _SC_NPROCESSORS_CONF );
+
+            for( cpu = 0L; ( cpu < cpuCount ) && ( cpu < ( long ) CPU_SETSIZE ); cpu++ )
+            {
+                CPU_SET( ( size_t ) cpu, &availableCpus );
+            }
+        }
+
+        CPU_ZERO( &isolatedCpus );
+        availableCpusRead = true;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void updateIsolatedCpus( void )
+{
+    uint32_t i = 0U;
+
+    CPU_ZERO( &isolatedCpus );
+
+    for( i = 0U; i < THREAD_GROUP_MAX_COUNT; i++ )
+    {
+        if( ( groups[ i ].defined == true ) && ( groups[ i ].isolated == true ) )
+        {
+            CPU_OR( &isolatedCpus, &isolatedCpus, &( groups[ i ].cpus ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t findNode( const cpu_set_t * pCpus )
+{
+    int32_t node = THREAD_GROUP_NO_NODE;
+    uint32_t i = 0U;
+    char path[ sizeof( THREAD_GROUP_NODE_PATH ) + sizeof( "/node/cpulist" ) + 10U ];
+    char cpuList[ CPU_LIST_BUFFER_SIZE ];
+    cpu_set_t nodeCpus;
+    cpu_set_t commonCpus;
+    FILE * pFile = NULL;
+
+    /* The nodes may be numbered with gaps, so all of them are looked up. */
+    for( i = 0U; ( i < MAX_NODE_COUNT ) && ( node == THREAD_GROUP_NO_NODE ); i++ )
+    {
+        ( void ) snprintf( path, sizeof( path ), "%s/node%u/cpulist", THREAD_GROUP_NODE_PATH, ( unsigned int ) i );
+        pFile = fopen( path, "r" );
+
+        if( pFile != NULL )
+        {
+            if( ( fgets( cpuList, ( int ) sizeof( cpuList ), pFile ) != NULL ) &&
+                ( parseCpuList( cpuList, &nodeCpus ) == true ) )
+            {
+                CPU_AND( &commonCpus, &nodeCpus, pCpus );
+
+                if( ( CPU_COUNT( pCpus ) > 0 ) && CPU_EQUAL( &commonCpus, pCpus ) )
+                {
+                    node = ( int32_t ) i;
+                }
+            }
+
+            ( void ) fclose( pFile );
+        }
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void getPlacement( const char * pName,
+                          cpu_set_t * pCpus,
+                          uint32_t * pIndex )
+{
+    ThreadGroup_t * pGroup = NULL;
+    uint32_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &groupMutex );
+
+    readAvailableCpus();
+    pGroup = findGroup( pName );
+
+    if( pGroup != NULL )
+    {
+        *pCpus = pGroup->cpus;
+
+        if( pIndex != NULL )
+        {
+            index = pGroup->threadCount;
+            pGroup->threadCount++;
+        }
+    }
+    else
+    {
+        /* The threads of no group share the CPUs not dedicated to a group,
+         * rather than inheriting those of the thread creating them, which
+         * may be isolated. A host without other CPUs shares them all. */
+        CPU_XOR( pCpus, &availableCpus, &isolatedCpus );
+
+        if( CPU_COUNT( pCpus ) == 0 )
+        {
+            *pCpus = availableCpus;
+        }
+
+        if( pIndex != NULL )
+        {
+            index = undefinedThreadCount;
+            undefinedThreadCount++;
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &groupMutex );
+
+    if( pIndex != NULL )
+    {
+        *pIndex = index;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t roundToPages( size_t size )
+{
+    size_t pageSize = ( size_t ) sysconf( _SC_PAGESIZE );
+    size_t rounded = 0U;
+
+    if( size <= ( SIZE_MAX - pageSize ) )
+    {
+        rounded = ( size + pageSize - 1U ) & ~( pageSize - 1U );
+    }
+
+    return rounded;
+}
+
+/*-----------------------------------------------------------*/
+
+ThreadGroupStatus_t ThreadGroup_Define( const char * pName,
+                                        const char * pCpuList )
+{
+    ThreadGroupStatus_t returnStatus = ThreadGroupSuccess;
+    ThreadGroup_t * pGroup = NULL;
+    cpu_set_t cpus;
+    cpu_set_t sharedCpus;
+
+    if( ( isValidName( pName ) == false ) || ( pCpuList == NULL ) ||
+        ( parseCpuList( pCpuList, &cpus ) == false ) )
+    {
+        returnStatus = ThreadGroupBadParameter;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &groupMutex );
+
+        readAvailableCpus();
+        pGroup = findGroup( pName );
+
+        /* An isolated group defined again gives up its isolation. */
+        if( ( pGroup != NULL ) && ( pGroup->isolated == true ) )
+        {
+            pGroup->isolated = false;
+            updateIsolatedCpus();
+        }
+
+        /* The isolated CPUs are available ones, so the exclusive or leaves
+         * the CPUs shared by the groups. */
+        CPU_XOR( &sharedCpus, &availableCpus, &isolatedCpus );
+        CPU_AND( &cpus, &cpus, &sharedCpus );
+
+        if( CPU_COUNT( &cpus ) == 0 )
+        {
+            returnStatus = ThreadGroupBadParameter;
+        }
+        else
+        {
+            pGroup = addGroup( pName );
+
+            if( pGroup == NULL )
+            {
+                returnStatus = ThreadGroupNoMemory;
+            }
+            else
+            {
+                pGroup->cpus = cpus;
+                pGroup->node = findNode( &cpus );
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &groupMutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ThreadGroupStatus_t ThreadGroup_Isolate( const char * pName,
+                                         uint32_t cpu )
+{
+    ThreadGroupStatus_t returnStatus = ThreadGroupSuccess;
+    ThreadGroup_t * pGroup = NULL;
+    uint32_t i = 0U;
+
+    if( ( isValidName( pName ) == false ) || ( cpu >= ( uint32_t ) CPU_SETSIZE ) )
+    {
+        returnStatus = ThreadGroupBadParameter;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &groupMutex );
+
+        readAvailableCpus();
+
+        if( CPU_ISSET( cpu, &availableCpus ) == 0 )
+        {
+            returnStatus = ThreadGroupBadParameter;
+        }
+
+        /* The CPU is only taken from the other groups once it is known that
+         * each of them keeps a CPU. */
+        for( i = 0U; ( i < THREAD_GROUP_MAX_COUNT ) && ( returnStatus == ThreadGroupSuccess ); i++ )
+        {
+            if( ( groups[ i ].defined == true ) &&
+                ( strcmp( groups[ i ].name, pName ) != 0 ) &&
+                ( CPU_ISSET( cpu, &( groups[ i ].cpus ) ) != 0 ) &&
+                ( ( groups[ i ].isolated == true ) || ( CPU_COUNT( &( groups[ i ].cpus ) ) == 1 ) ) )
+            {
+                returnStatus = ThreadGroupBadParameter;
+            }
+        }
+
+        if( returnStatus == ThreadGroupSuccess )
+        {
+            pGroup = addGroup( pName );
+
+            if( pGroup == NULL )
+            {
+                returnStatus = ThreadGroupNoMemory;
+            }
+        }
+
+        if( returnStatus == ThreadGroupSuccess )
+        {
+            for( i = 0U; i < THREAD_GROUP_MAX_COUNT; i++ )
+            {
+                if( groups[ i ].defined == true )
+                {
+                    CPU_CLR( cpu, &( groups[ i ].cpus ) );
+                }
+            }
+
+            /* A group isolated again moves to its new CPU. */
+            CPU_ZERO( &( pGroup->cpus ) );
+            CPU_SET( cpu, &( pGroup->cpus ) );
+            pGroup->node = findNode( &( pGroup->cpus ) );
+            pGroup->isolated = true;
+            updateIsolatedCpus();
+        }
+
+        ( void ) pthread_mutex_unlock( &groupMutex );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ThreadGroupStatus_t ThreadGroup_CreateThread( const char * pName,
+                                              pthread_t * pThread,
+                                              void * ( *threadFunction )( void * ),
+                                              void * pArgument )
+{
+    ThreadGroupStatus_t returnStatus = ThreadGroupSuccess;
+    pthread_attr_t attributes;
+    cpu_set_t cpus;
+    uint32_t index = 0U;
+    char threadName[ THREAD_NAME_SIZE ];
+
+    if( ( isValidName( pName ) == false ) || ( pThread == NULL ) || ( threadFunction == NULL ) )
+    {
+        returnStatus = ThreadGroupBadParameter;
+    }
+    else
+    {
+        getPlacement( pName, &cpus, &index );
+
+        if( pthread_attr_init( &attributes ) != 0 )
+        {
+            returnStatus = ThreadGroupApiError;
+        }
+        else
+        {
+            /* The thread starts on its CPUs, so that its first pages are
+             * taken from their node. */
+            if( ( pthread_attr_setaffinity_np( &attributes, sizeof( cpus ), &cpus ) != 0 ) ||
+                ( pthread_create( pThread, &attributes, threadFunction, pArgument ) != 0 ) )
+            {
+                returnStatus = ThreadGroupApiError;
+            }
+            else
+            {
+                /* The name only helps to find the thread in top and in the
+                 * debugger, so it may be truncated. */
+                ( void ) snprintf( threadName, sizeof( threadName ), "%s-%u", pName, ( unsigned int ) index );
+                ( void ) pthread_setname_np( *pThread, threadName );
+            }
+
+            ( void ) pthread_attr_destroy( &attributes );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+ThreadGroupStatus_t ThreadGroup_JoinCurrent( const char * pName )
+{
+    ThreadGroupStatus_t returnStatus = ThreadGroupSuccess;
+    cpu_set_t cpus;
+
+    if( isValidName( pName ) == false )
+    {
+        returnStatus = ThreadGroupBadParameter;
+    }
+    else
+    {
+        getPlacement( pName, &cpus, NULL );
+
+        if( pthread_setaffinity_np( pthread_self(), sizeof( cpus ), &cpus ) != 0 )
+        {
+            returnStatus = ThreadGroupApiError;
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t ThreadGroup_GetNode( const char * pName )
+{
+    int32_t node = THREAD_GROUP_NO_NODE;
+    const ThreadGroup_t * pGroup = NULL;
+
+    if( isValidName( pName ) == true )
+    {
+        ( void ) pthread_mutex_lock( &groupMutex );
+
+        pGroup = findGroup( pName );
+
+        if( pGroup != NULL )
+        {
+            node = pGroup->node;
+        }
+
+        ( void ) pthread_mutex_unlock( &groupMutex );
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+void * ThreadGroup_Allocate( const char * pName,
+                             size_t size )
+{
+    void * pBuffer = NULL;
+    size_t length = roundToPages( size );
+    int32_t node = ThreadGroup_GetNode( pName );
+    unsigned long nodeMask = 0UL;
+
+    if( length > 0U )
+    {
+        pBuffer = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+        if( pBuffer == MAP_FAILED )
+        {
+            pBuffer = NULL;
+        }
+    }
+
+    if( ( pBuffer != NULL ) && ( node != THREAD_GROUP_NO_NODE ) )
+    {
+        nodeMask = 1UL << ( uint32_t ) node;
+
+        /* The pages are not taken before they are first written, so the
+         * policy applies to all of them. A host without NUMA support refuses
+         * it, and its pages come from its only node anyway. The kernel drops
+         * the last bit of the node mask, hence the extra one. */
+        ( void ) syscall( __NR_mbind,
+                          pBuffer,
+                          length,
+                          MPOL_PREFERRED,
+                          &nodeMask,
+                          MAX_NODE_COUNT + 1U,
+                          0U );
+    }
+
+    return pBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+void ThreadGroup_Free( void * pBuffer,
+                       size_t size )
+{
+    if( pBuffer != NULL )
+    {
+        ( void ) munmap( pBuffer, roundToPages( size ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void ThreadGroup_Reset( void )
+{
+    ( void ) pthread_mutex_lock( &groupMutex );
+
+    ( void ) memset( groups, 0, sizeof( groups ) );
+    availableCpusRead = false;
+    undefinedThreadCount = 0U;
+
+    ( void ) pthread_mutex_unlock( &groupMutex );
+}
+
+/*-----------------------------------------------------------*/
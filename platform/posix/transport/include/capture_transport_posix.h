@@ -0,0 +1,327 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CAPTURE_TRANSPORT_POSIX_H_
+#define CAPTURE_TRANSPORT_POSIX_H_
+
+/**
+ * @file capture_transport_posix.h
+ * @brief Capture of the traffic of a transport, and its replay.
+ *
+ * The capture transport wraps any #TransportInterface_t, and writes the
+ * bytes each of its sends and receives moved to a file, with the time they
+ * moved. The replay transport then feeds the bytes received back to coreMQTT
+ * or coreHTTP, at the speed they were recorded or as fast as they are read,
+ * so that a benchmark runs on the message mix of a real connection.
+ *
+ * A capture is #CAPTURE_TRANSPORT_MAGIC and #CAPTURE_TRANSPORT_VERSION,
+ * followed by one record per send or receive that moved bytes:
+ * - the microseconds since the previous record, or since the start of the
+ *   capture for the first one, as an unsigned LEB128 number;
+ * - the number of bytes moved, shifted left by one, with
+ *   #CAPTURE_TRANSPORT_RECV in the lowest bit for a receive, as an unsigned
+ *   LEB128 number;
+ * - the bytes moved.
+ *
+ * A record of a few bytes has a header of two or three bytes. The sends and
+ * receives that failed or moved nothing are not recorded.
+ */
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the capture and replay transports. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_Capture"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Transport includes. */
+#include "transport_interface.h"
+
+/**
+ * @brief First bytes of a capture.
+ */
+#define CAPTURE_TRANSPORT_MAGIC            "TCAP"
+
+/**
+ * @brief Length of #CAPTURE_TRANSPORT_MAGIC.
+ */
+#define CAPTURE_TRANSPORT_MAGIC_LENGTH     ( sizeof( CAPTURE_TRANSPORT_MAGIC ) - 1U )
+
+/**
+ * @brief Version of the format of the records, the byte following
+ * #CAPTURE_TRANSPORT_MAGIC.
+ */
+#define CAPTURE_TRANSPORT_VERSION          ( 1U )
+
+/**
+ * @brief Length of the header of a capture.
+ */
+#define CAPTURE_TRANSPORT_HEADER_LENGTH    ( CAPTURE_TRANSPORT_MAGIC_LENGTH + 1U )
+
+/**
+ * @brief Lowest bit of the length of a record, for a send.
+ */
+#define CAPTURE_TRANSPORT_SEND             ( 0U )
+
+/**
+ * @brief Lowest bit of the length of a record, for a receive.
+ */
+#define CAPTURE_TRANSPORT_RECV             ( 1U )
+
+/**
+ * @brief Status codes of the capture and replay transports.
+ */
+typedef enum CaptureTransportStatus
+{
+    CAPTURE_TRANSPORT_SUCCESS = 0,       /**< Function successfully completed. */
+    CAPTURE_TRANSPORT_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    CAPTURE_TRANSPORT_WRITE_FAILURE,     /**< The capture could not be written. */
+    CAPTURE_TRANSPORT_MALFORMED_CAPTURE  /**< The capture to replay is not one written by the capture transport. */
+} CaptureTransportStatus_t;
+
+/**
+ * @brief Speed at which the replay transport feeds the bytes received.
+ */
+typedef enum ReplayTransportSpeed
+{
+    REPLAY_TRANSPORT_MAX_SPEED = 0,  /**< Each receive returns the bytes of the next record at once. */
+    REPLAY_TRANSPORT_RECORDED_SPEED  /**< A record is received no earlier after the start of the replay than it was after the start of the capture. */
+} ReplayTransportSpeed_t;
+
+/**
+ * @brief Parameters for the transport-interface implementation that captures
+ * the traffic of another, set by #CaptureTransport_Start.
+ */
+typedef struct CaptureTransportParams
+{
+    TransportInterface_t transport; /**< @brief The transport wrapped. */
+    FILE * pFile;                   /**< @brief Stream the capture is written to; NULL once stopped. */
+    uint64_t lastTimeUs;            /**< @brief Time of the previous record, or of the start of the capture. */
+    bool failed;                    /**< @brief Set once a write failed, after which nothing is written. */
+} CaptureTransportParams_t;
+
+/**
+ * @brief Parameters for the transport-interface implementation that replays
+ * a capture, set by #ReplayTransport_Init.
+ *
+ * Only the receiving thread may use the replay, as its position is shared by
+ * the sends and the receives.
+ */
+typedef struct ReplayTransportParams
+{
+    const uint8_t * pCapture;     /**< @brief The capture, which must remain valid. */
+    size_t captureLength;         /**< @brief Length of #ReplayTransportParams_t.pCapture. */
+    ReplayTransportSpeed_t speed; /**< @brief Speed of the replay. */
+    size_t recvLength;            /**< @brief Number of bytes of the receive records of the capture. */
+    size_t sendLength;            /**< @brief Number of bytes of the send records of the capture. */
+    size_t recvEnd;               /**< @brief Position in the capture of the end of the last receive record. */
+    size_t position;              /**< @brief Position in the capture of the next record. */
+    size_t dataPosition;          /**< @brief Position in the capture of the next byte to receive. */
+    size_t dataRemaining;         /**< @brief Number of bytes of the current receive record left. */
+    uint64_t recordTimeUs;        /**< @brief Time of the current record since the start of the capture. */
+    uint64_t startTimeUs;         /**< @brief Time of the start of the replay, at #REPLAY_TRANSPORT_RECORDED_SPEED. */
+    size_t bytesSent;             /**< @brief Number of bytes sent since the start of the replay. */
+} ReplayTransportParams_t;
+
+/**
+ * @brief Start capturing the traffic of a transport.
+ *
+ * The capture starts with its header, written at once. Each send or receive
+ * of the network context then calls that of @p pTransport, and writes the
+ * bytes it moved to @p pFile. The sends and receives of several threads are
+ * written whole, one after the other, as the stream is locked while each is.
+ *
+ * @param[out] pNetworkContext The network context, whose parameters are a
+ * #CaptureTransportParams_t.
+ * @param[in] pTransport The transport to capture, which is copied.
+ * @param[in] pFile Stream to write the capture to, opened for writing in
+ * binary mode. It is not closed by the capture transport.
+ *
+ * @return #CAPTURE_TRANSPORT_SUCCESS if successful;
+ * #CAPTURE_TRANSPORT_INVALID_PARAMETER or #CAPTURE_TRANSPORT_WRITE_FAILURE on
+ * error.
+ */
+CaptureTransportStatus_t CaptureTransport_Start( NetworkContext_t * pNetworkContext,
+                                                 const TransportInterface_t * pTransport,
+                                                 FILE * pFile );
+
+/**
+ * @brief Stop capturing, and flush the capture written.
+ *
+ * The sends and receives still call those of the transport captured, but
+ * are no longer written. The stream may be closed once the sends and
+ * receives in progress during the stop returned.
+ *
+ * @param[in] pNetworkContext The network context started with
+ * #CaptureTransport_Start.
+ *
+ * @return #CAPTURE_TRANSPORT_SUCCESS if the whole capture was written;
+ * #CAPTURE_TRANSPORT_INVALID_PARAMETER or #CAPTURE_TRANSPORT_WRITE_FAILURE on
+ * error.
+ */
+CaptureTransportStatus_t CaptureTransport_Stop( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Receives data from the transport captured, and writes it to the
+ * capture.
+ *
+ * This can be used as #TransportInterface.recv function.
+ *
+ * @param[in] pNetworkContext The network context started with
+ * #CaptureTransport_Start.
+ * @param[out] pBuffer Buffer to receive the data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return What the receive of the transport captured returns.
+ */
+int32_t CaptureTransport_Recv( NetworkContext_t * pNetworkContext,
+                               void * pBuffer,
+                               size_t bytesToRecv );
+
+/**
+ * @brief Sends data with the transport captured, and writes what it sent to
+ * the capture.
+ *
+ * This can be used as the #TransportInterface.send function.
+ *
+ * @param[in] pNetworkContext The network context started with
+ * #CaptureTransport_Start.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return What the send of the transport captured returns.
+ */
+int32_t CaptureTransport_Send( NetworkContext_t * pNetworkContext,
+                               const void * pBuffer,
+                               size_t bytesToSend );
+
+/**
+ * @brief Set up the replay of a capture, after checking all of its records.
+ *
+ * @param[out] pNetworkContext The network context, whose parameters are a
+ * #ReplayTransportParams_t.
+ * @param[in] pCapture The capture, such as the content of a file written by
+ * the capture transport. It must remain valid while the replay is used.
+ * @param[in] captureLength Length of @p pCapture.
+ * @param[in] speed Speed of the replay.
+ *
+ * @return #CAPTURE_TRANSPORT_SUCCESS if successful;
+ * #CAPTURE_TRANSPORT_INVALID_PARAMETER or
+ * #CAPTURE_TRANSPORT_MALFORMED_CAPTURE on error.
+ */
+CaptureTransportStatus_t ReplayTransport_Init( NetworkContext_t * pNetworkContext,
+                                               const uint8_t * pCapture,
+                                               size_t captureLength,
+                                               ReplayTransportSpeed_t speed );
+
+/**
+ * @brief Start the replay again from the first record.
+ *
+ * @param[in] pNetworkContext The network context set up with
+ * #ReplayTransport_Init.
+ *
+ * @return #CAPTURE_TRANSPORT_SUCCESS if successful;
+ * #CAPTURE_TRANSPORT_INVALID_PARAMETER on error.
+ */
+CaptureTransportStatus_t ReplayTransport_Rewind( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Whether the bytes of all the receive records of the capture were
+ * received.
+ *
+ * @param[in] pNetworkContext The network context set up with
+ * #ReplayTransport_Init.
+ *
+ * @return true if the replay reached the end of the capture; false otherwise.
+ */
+bool ReplayTransport_IsFinished( const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Receives the bytes of the next receive record of the capture.
+ *
+ * This can be used as #TransportInterface.recv function.
+ *
+ * A receive returns the bytes of at most one record, so that the client
+ * reads them in the pieces the transport captured returned them in. The send
+ * records are skipped.
+ *
+ * @param[in] pNetworkContext The network context set up with
+ * #ReplayTransport_Init.
+ * @param[out] pBuffer Buffer to receive the data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @note The receive never blocks. At #REPLAY_TRANSPORT_RECORDED_SPEED, it
+ * returns 0, like the other transports when their receive timeout expires,
+ * until the time of the next record comes.
+ *
+ * @return Number of bytes received, which may be fewer than requested;
+ * 0 if the next record is not due yet; negative value once all the records
+ * were received.
+ */
+int32_t ReplayTransport_Recv( NetworkContext_t * pNetworkContext,
+                              void * pBuffer,
+                              size_t bytesToRecv );
+
+/**
+ * @brief Accepts the bytes sent by the client, which are not compared with
+ * those of the capture, as they differ in the client identifiers, tokens and
+ * times of each run.
+ *
+ * This can be used as the #TransportInterface.send function.
+ *
+ * @param[in] pNetworkContext The network context set up with
+ * #ReplayTransport_Init.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return Number of bytes sent; negative value if the parameters are
+ * invalid.
+ */
+int32_t ReplayTransport_Send( NetworkContext_t * pNetworkContext,
+                              const void * pBuffer,
+                              size_t bytesToSend );
+
+#endif /* ifndef CAPTURE_TRANSPORT_POSIX_H_ */
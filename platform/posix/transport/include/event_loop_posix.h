@@ -0,0 +1,283 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EVENT_LOOP_POSIX_H_
+#define EVENT_LOOP_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the event loop. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "EventLoop"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX include for struct epoll_event. */
+#include <sys/epoll.h>
+
+/* Timer wheel include. */
+#include "timer_wheel_posix.h"
+
+/**
+ * @brief Maximum number of ready connections reported by one call to
+ * epoll_wait in #EventLoop_Dispatch. More ready connections are reported by
+ * the next call.
+ */
+#ifndef EVENT_LOOP_MAX_EVENTS
+    #define EVENT_LOOP_MAX_EVENTS    ( 64U )
+#endif
+
+/**
+ * @brief Resolution in milliseconds of the deadlines set with
+ * #EventLoop_SetDeadline and of the timers started with #EventLoop_StartTimer.
+ */
+#ifndef EVENT_LOOP_TIMER_TICK_MS
+    #define EVENT_LOOP_TIMER_TICK_MS    ( 100U )
+#endif
+
+/**
+ * @brief Events reported to an #EventLoopCallback_t.
+ */
+#define EVENT_LOOP_EVENT_READABLE    ( 1U << 0 ) /**< @brief Data can be received on the connection. */
+#define EVENT_LOOP_EVENT_HANGUP      ( 1U << 1 ) /**< @brief The connection was closed by the peer or failed. */
+#define EVENT_LOOP_EVENT_DEADLINE    ( 1U << 2 ) /**< @brief The deadline set with #EventLoop_SetDeadline is due. */
+
+/**
+ * @brief Event loop return status.
+ */
+typedef enum EventLoopStatus
+{
+    EVENT_LOOP_SUCCESS = 0,       /**< Function successfully completed. */
+    EVENT_LOOP_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    EVENT_LOOP_API_ERROR          /**< A call to a system API resulted in an internal error. */
+} EventLoopStatus_t;
+
+struct EventLoopConnection;
+
+/**
+ * @brief Function called by #EventLoop_Dispatch when a connection is ready.
+ *
+ * @param[in] pConnection The connection that is ready.
+ * @param[in] events Bitwise OR of the EVENT_LOOP_EVENT_* values that occurred.
+ */
+typedef void ( * EventLoopCallback_t )( struct EventLoopConnection * pConnection,
+                                        uint32_t events );
+
+/**
+ * @brief A connection registered with an #EventLoop_t.
+ *
+ * The application sets #EventLoopConnection_t.fileDescriptor,
+ * #EventLoopConnection_t.callback and #EventLoopConnection_t.pUserContext
+ * before calling #EventLoop_Add. The other members are managed by the event
+ * loop. The structure must remain valid until it is removed with
+ * #EventLoop_Remove.
+ */
+typedef struct EventLoopConnection
+{
+    int32_t fileDescriptor;       /**< @brief Socket of the connection, for example #PlaintextParams_t.socketDescriptor. */
+    EventLoopCallback_t callback; /**< @brief Function called when the connection is ready. */
+    void * pUserContext;          /**< @brief Application data, such as the MQTT context of the connection. */
+
+    TimerWheelTimer_t deadline; /**< @brief Timer of the deadline set with #EventLoop_SetDeadline. */
+} EventLoopConnection_t;
+
+/**
+ * @brief An event loop driving many connections from one thread.
+ *
+ * The members are managed by the event loop functions.
+ */
+typedef struct EventLoop
+{
+    int32_t epollDescriptor;                            /**< @brief The epoll instance. */
+    TimerWheel_t timerWheel;                            /**< @brief Deadlines and timers, in ticks of #EVENT_LOOP_TIMER_TICK_MS. */
+    uint32_t currentTickTimeMs;                         /**< @brief Time at which the current tick of #EventLoop_t.timerWheel started. */
+    struct epoll_event events[ EVENT_LOOP_MAX_EVENTS ]; /**< @brief Events being dispatched. */
+    size_t eventCount;                                  /**< @brief Number of entries of #EventLoop_t.events being dispatched. */
+} EventLoop_t;
+
+/**
+ * @brief Initialize an event loop.
+ *
+ * @param[out] pEventLoop The event loop to initialize.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER,
+ * #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Init( EventLoop_t * pEventLoop );
+
+/**
+ * @brief Release the resources of an event loop.
+ *
+ * The connections still registered are not closed.
+ *
+ * @param[in] pEventLoop The event loop to release.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER on error.
+ */
+EventLoopStatus_t EventLoop_Deinit( EventLoop_t * pEventLoop );
+
+/**
+ * @brief Register a connection, so that its callback is called when data can
+ * be received on it.
+ *
+ * @note Only data buffered by the kernel makes a connection readable. A
+ * callback receiving over TLS must process every record that is already
+ * decrypted and buffered by the TLS library, for example by calling
+ * MQTT_ProcessLoop until it receives nothing, before returning.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] pConnection The connection to register.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER,
+ * #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Add( EventLoop_t * pEventLoop,
+                                 EventLoopConnection_t * pConnection );
+
+/**
+ * @brief Unregister a connection and cancel its deadline.
+ *
+ * This may be called from a callback, including for another connection. A
+ * removed connection is not reported again, even if it was ready.
+ *
+ * @note Remove a connection before closing its socket.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] pConnection The connection to unregister.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER,
+ * #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Remove( EventLoop_t * pEventLoop,
+                                    EventLoopConnection_t * pConnection );
+
+/**
+ * @brief Set the deadline of a connection, replacing any deadline already set.
+ *
+ * When the deadline is due, the callback of the connection is called with
+ * #EVENT_LOOP_EVENT_DEADLINE, and the deadline is cleared. For MQTT, set the
+ * deadline to the time at which the keep-alive PINGREQ is due, and call
+ * MQTT_ProcessLoop from the callback when the deadline is reported.
+ *
+ * Setting and cancelling a deadline take constant time, and
+ * #EventLoop_Dispatch only wakes up when a deadline is due, so the cost of
+ * the deadlines does not grow with the number of connections whose deadlines
+ * are not due.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] pConnection A connection registered with @p pEventLoop.
+ * @param[in] timeoutMs Time from now in milliseconds at which the deadline is
+ * due, rounded up to #EVENT_LOOP_TIMER_TICK_MS.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER on error.
+ */
+EventLoopStatus_t EventLoop_SetDeadline( EventLoop_t * pEventLoop,
+                                         EventLoopConnection_t * pConnection,
+                                         uint32_t timeoutMs );
+
+/**
+ * @brief Cancel the deadline of a connection, if any.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] pConnection A connection registered with @p pEventLoop.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER on error.
+ */
+EventLoopStatus_t EventLoop_CancelDeadline( EventLoop_t * pEventLoop,
+                                            EventLoopConnection_t * pConnection );
+
+/**
+ * @brief Start a timer not tied to a connection, replacing its expiry if it
+ * is already running.
+ *
+ * When the timer is due, #TimerWheelTimer_t.callback is called from
+ * #EventLoop_Dispatch. Use it for the work a demo would otherwise poll for,
+ * such as retries after a backoff delay, the report period of the Device
+ * Defender demo or the timeout of an OTA request, so that the thread only
+ * wakes up when the work is due.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] pTimer The timer, whose #TimerWheelTimer_t.callback is set.
+ * @param[in] timeoutMs Time from now in milliseconds at which the timer is
+ * due, rounded up to #EVENT_LOOP_TIMER_TICK_MS.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER on error.
+ */
+EventLoopStatus_t EventLoop_StartTimer( EventLoop_t * pEventLoop,
+                                        TimerWheelTimer_t * pTimer,
+                                        uint32_t timeoutMs );
+
+/**
+ * @brief Cancel a timer started with #EventLoop_StartTimer, if it is running.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] pTimer The timer.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful; #EVENT_LOOP_INVALID_PARAMETER on error.
+ */
+EventLoopStatus_t EventLoop_CancelTimer( EventLoop_t * pEventLoop,
+                                         TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Wait until connections are ready or deadlines or timers are due,
+ * and call their callbacks.
+ *
+ * Only the connections that are ready and the deadlines that are due are
+ * visited, so a call costs time proportional to the active connections rather
+ * than to all the registered connections. The wait ends when the next
+ * deadline or timer is due, so the thread does not wake up while nothing is
+ * due. Call this function in a loop.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] maxWaitMs Longest time in milliseconds to wait for an event.
+ * @param[out] pDispatchedCount Number of callbacks called. May be NULL.
+ *
+ * @return #EVENT_LOOP_SUCCESS if successful, even if nothing was dispatched;
+ * #EVENT_LOOP_INVALID_PARAMETER, #EVENT_LOOP_API_ERROR on error.
+ */
+EventLoopStatus_t EventLoop_Dispatch( EventLoop_t * pEventLoop,
+                                      uint32_t maxWaitMs,
+                                      size_t * pDispatchedCount );
+
+#endif /* ifndef EVENT_LOOP_POSIX_H_ */
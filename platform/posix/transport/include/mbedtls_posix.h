@@ -0,0 +1,272 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MBEDTLS_POSIX_H_
+#define MBEDTLS_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the transport interface implementation which uses
+ * mbedTLS and Sockets. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_MbedTLS_Sockets"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+
+/* mbedTLS includes. */
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+
+/* Transport includes. */
+#include "transport_interface.h"
+
+/* Socket include. */
+#include "sockets_posix.h"
+
+/**
+ * @brief Maximum number of server hosts for which a TLS session is kept by
+ * the session cache.
+ *
+ * See #MbedtlsCredentials_t.cacheSession.
+ */
+#ifndef MBEDTLS_POSIX_SESSION_CACHE_SIZE
+    #define MBEDTLS_POSIX_SESSION_CACHE_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Longest SNI host name, in bytes, for which the session cache keeps
+ * a TLS session.
+ */
+#ifndef MBEDTLS_POSIX_MAX_HOST_NAME_LENGTH
+    #define MBEDTLS_POSIX_MAX_HOST_NAME_LENGTH    ( 253U )
+#endif
+
+/**
+ * @brief Maximum fragment length negotiated when
+ * #MbedtlsCredentials_t.maxFragmentLength is 0. Set to 0 to not negotiate
+ * one by default.
+ *
+ * The server then sends records of at most this length, so that
+ * MBEDTLS_SSL_IN_CONTENT_LEN only has to hold the largest handshake
+ * message, such as the certificate chain of the server.
+ */
+#ifndef MBEDTLS_POSIX_DEFAULT_MAX_FRAGMENT_LENGTH
+    #define MBEDTLS_POSIX_DEFAULT_MAX_FRAGMENT_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Parameters for the transport-interface implementation that uses
+ * mbedTLS and POSIX sockets.
+ *
+ * @note The mbedTLS contexts are held here rather than allocated, so that
+ * the only memory a connection allocates are the record buffers of
+ * #MbedtlsParams_t.sslContext and the parsed credentials.
+ */
+typedef struct MbedtlsParams
+{
+    int32_t socketDescriptor;
+    mbedtls_ssl_context sslContext; /**< @brief The TLS session of the connection. */
+    mbedtls_ssl_config sslConfig;   /**< @brief The TLS configuration of the connection. */
+    mbedtls_x509_crt rootCa;        /**< @brief The trusted server root CA. */
+    mbedtls_x509_crt clientCert;    /**< @brief The client certificate. */
+    mbedtls_pk_context privateKey;  /**< @brief The client certificate's private key. */
+} MbedtlsParams_t;
+
+/**
+ * @brief mbedTLS Connect / Disconnect return status.
+ */
+typedef enum MbedtlsStatus
+{
+    MBEDTLS_POSIX_SUCCESS = 0,         /**< Function successfully completed. */
+    MBEDTLS_POSIX_INVALID_PARAMETER,   /**< At least one parameter was invalid. */
+    MBEDTLS_POSIX_INSUFFICIENT_MEMORY, /**< Insufficient memory required to establish connection. */
+    MBEDTLS_POSIX_INVALID_CREDENTIALS, /**< Provided credentials were invalid. */
+    MBEDTLS_POSIX_HANDSHAKE_FAILED,    /**< Performing TLS handshake with server failed. */
+    MBEDTLS_POSIX_API_ERROR,           /**< A call to a system or mbedTLS API resulted in an internal error. */
+    MBEDTLS_POSIX_DNS_FAILURE,         /**< Resolving hostname of the server failed. */
+    MBEDTLS_POSIX_CONNECT_FAILURE      /**< Initial connection to the server failed. */
+} MbedtlsStatus_t;
+
+/**
+ * @brief Contains the credentials to establish a TLS connection.
+ */
+typedef struct MbedtlsCredentials
+{
+    /**
+     * @brief A NULL-terminated array of ALPN protocol names. Set to NULL to
+     * disable ALPN.
+     *
+     * @note The array and its strings must remain valid until the connection
+     * is disconnected, as mbedTLS does not copy them.
+     */
+    const char ** pAlpnProtos;
+
+    /**
+     * @brief Set a host name to enable SNI. Set to NULL to disable SNI.
+     *
+     * The host name is also checked against the server certificate.
+     *
+     * @note This string must be NULL-terminated.
+     */
+    const char * sniHostName;
+
+    /**
+     * @brief Set the value for the TLS max fragment length (TLS MFLN)
+     *
+     * mbedTLS allows this value to be one of 512, 1024, 2048 or 4096. Set
+     * to 0 to use #MBEDTLS_POSIX_DEFAULT_MAX_FRAGMENT_LENGTH.
+     *
+     * @note The records the client sends are limited by
+     * MBEDTLS_SSL_OUT_CONTENT_LEN whether or not the server accepts the
+     * extension.
+     */
+    uint16_t maxFragmentLength;
+
+    /**
+     * @brief Filepaths to certificates and private key that are used when
+     * performing the TLS handshake.
+     *
+     * @note These strings must be NULL-terminated because the mbedTLS API requires them to be.
+     */
+    const char * pRootCaPath;     /**< @brief Filepath string to the trusted server root CA. */
+    const char * pClientCertPath; /**< @brief Filepath string to the client certificate. */
+    const char * pPrivateKeyPath; /**< @brief Filepath string to the client certificate's private key. */
+
+    /**
+     * @brief Set to true to resume TLS sessions with the server named by
+     * #MbedtlsCredentials_t.sniHostName.
+     *
+     * The session ticket (RFC 5077) the server issues during a handshake is
+     * kept in memory and offered again by the next #Mbedtls_Connect to the
+     * same SNI host, which lets the server skip the certificate exchange and
+     * key agreement of a full handshake. The server falls back to a full
+     * handshake if it does not accept the ticket. Sessions are only cached
+     * when SNI is enabled.
+     */
+    bool cacheSession;
+} MbedtlsCredentials_t;
+
+/**
+ * @brief Sets up a TLS session on top of a TCP connection using the mbedTLS API.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pMbedtlsCredentials Credentials for the TLS connection.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ *
+ * @note A timeout of 0 means infinite timeout.
+ *
+ * @return #MBEDTLS_POSIX_SUCCESS on success;
+ * #MBEDTLS_POSIX_INVALID_PARAMETER, #MBEDTLS_POSIX_INVALID_CREDENTIALS,
+ * #MBEDTLS_POSIX_HANDSHAKE_FAILED, #MBEDTLS_POSIX_API_ERROR,
+ * #MBEDTLS_POSIX_DNS_FAILURE, #MBEDTLS_POSIX_CONNECT_FAILURE on failure.
+ */
+MbedtlsStatus_t Mbedtls_Connect( NetworkContext_t * pNetworkContext,
+                                 const ServerInfo_t * pServerInfo,
+                                 const MbedtlsCredentials_t * pMbedtlsCredentials,
+                                 uint32_t sendTimeoutMs,
+                                 uint32_t recvTimeoutMs );
+
+/**
+ * @brief Closes a TLS session on top of a TCP connection using the mbedTLS API.
+ *
+ * @param[out] pNetworkContext The output parameter to end the TLS session and
+ * clean the created network context.
+ *
+ * @return #MBEDTLS_POSIX_SUCCESS on success; #MBEDTLS_POSIX_INVALID_PARAMETER on failure.
+ */
+MbedtlsStatus_t Mbedtls_Disconnect( const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Releases the TLS session cached for the SNI host name of the given
+ * credentials.
+ *
+ * The next #Mbedtls_Connect to the host performs a full handshake.
+ *
+ * @param[in] pMbedtlsCredentials Credentials the session was cached with.
+ * Only the SNI host name is used.
+ *
+ * @return #MBEDTLS_POSIX_SUCCESS on success, including when nothing was cached;
+ * #MBEDTLS_POSIX_INVALID_PARAMETER if @p pMbedtlsCredentials is NULL.
+ */
+MbedtlsStatus_t Mbedtls_ReleaseSession( const MbedtlsCredentials_t * pMbedtlsCredentials );
+
+/**
+ * @brief Receives data over an established TLS session using the mbedTLS API.
+ *
+ * This can be used as #TransportInterface.recv function for receiving data
+ * from the network.
+ *
+ * @param[in] pNetworkContext The network context created using Mbedtls_Connect API.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested from the network.
+ *
+ * @return Number of bytes received if successful; negative value to indicate failure.
+ * A return value of zero represents that the receive operation can be retried.
+ */
+int32_t Mbedtls_Recv( NetworkContext_t * pNetworkContext,
+                      void * pBuffer,
+                      size_t bytesToRecv );
+
+/**
+ * @brief Sends data over an established TLS session using the mbedTLS API.
+ *
+ * This can be used as the #TransportInterface.send function to send data
+ * over the network.
+ *
+ * @param[in] pNetworkContext The network context created using Mbedtls_Connect API.
+ * @param[in] pBuffer Buffer containing the bytes to send over the network stack.
+ * @param[in] bytesToSend Number of bytes to send over the network.
+ *
+ * @note At most MBEDTLS_SSL_OUT_CONTENT_LEN bytes are sent in one call.
+ *
+ * @return Number of bytes sent if successful; negative value on error.
+ * A return value of zero represents that the send timed out and must be
+ * retried with the same data.
+ */
+int32_t Mbedtls_Send( NetworkContext_t * pNetworkContext,
+                      const void * pBuffer,
+                      size_t bytesToSend );
+
+#endif /* ifndef MBEDTLS_POSIX_H_ */
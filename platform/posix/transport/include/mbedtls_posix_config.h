@@ -0,0 +1,60 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mbedtls_posix_config.h
+ * @brief Changes to the mbedTLS configuration of corePKCS11 for the mbedTLS
+ * transport, included by it as MBEDTLS_USER_CONFIG_FILE.
+ *
+ * The configuration is trimmed to the TLS 1.2 client features the transport
+ * uses, so that the transport links only the code and record buffers a
+ * small device needs.
+ */
+
+#ifndef MBEDTLS_POSIX_CONFIG_H_
+#define MBEDTLS_POSIX_CONFIG_H_
+
+/* Read the credentials with mbedtls_x509_crt_parse_file and
+ * mbedtls_pk_parse_keyfile. */
+#define MBEDTLS_FS_IO
+
+/* Resume sessions with session tickets (RFC 5077), which the client keeps
+ * instead of a session cache on the server. */
+#define MBEDTLS_SSL_SESSION_TICKETS
+
+/* Offer only the suites of the key exchanges and ciphers enabled in the
+ * configuration of corePKCS11, in order of preference, which also keeps the
+ * ClientHello short. */
+#ifndef MBEDTLS_SSL_CIPHERSUITES
+    #define MBEDTLS_SSL_CIPHERSUITES                       \
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, \
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256
+#endif
+
+/* The records the client sends are small MQTT and HTTP requests, so the
+ * output buffer does not need the size of the input buffer, which must hold
+ * the certificate chain of the server. */
+#ifndef MBEDTLS_SSL_OUT_CONTENT_LEN
+    #define MBEDTLS_SSL_OUT_CONTENT_LEN    4096
+#endif
+
+#endif /* ifndef MBEDTLS_POSIX_CONFIG_H_ */
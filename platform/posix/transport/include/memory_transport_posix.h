@@ -0,0 +1,306 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MEMORY_TRANSPORT_POSIX_H_
+#define MEMORY_TRANSPORT_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the transport interface implementation which uses
+ * memory. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_Memory"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_DEBUG
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transport includes. */
+#include "transport_interface.h"
+
+/**
+ * @brief Number of sends of each direction held back by the latency or the
+ * bandwidth limit of its link at a time.
+ *
+ * A send returns 0 while this many are held back. It must be a power of two.
+ */
+#ifndef MEMORY_TRANSPORT_MAX_PENDING_SENDS
+    #define MEMORY_TRANSPORT_MAX_PENDING_SENDS    ( 64U )
+#endif
+
+/**
+ * @brief Status codes of the memory transport.
+ */
+typedef enum MemoryTransportStatus
+{
+    MEMORY_TRANSPORT_SUCCESS = 0,      /**< Function successfully completed. */
+    MEMORY_TRANSPORT_INVALID_PARAMETER /**< At least one parameter was invalid. */
+} MemoryTransportStatus_t;
+
+/**
+ * @brief The two endpoints of a #MemoryTransportPair_t.
+ *
+ * The names only tell the two apart: either endpoint may be the client of
+ * the benchmark or the test.
+ */
+typedef enum MemoryTransportEndpoint
+{
+    MEMORY_TRANSPORT_CLIENT = 0, /**< Sends to and receives from #MEMORY_TRANSPORT_SERVER. */
+    MEMORY_TRANSPORT_SERVER      /**< Sends to and receives from #MEMORY_TRANSPORT_CLIENT. */
+} MemoryTransportEndpoint_t;
+
+/**
+ * @brief Function returning a monotonic time in microseconds.
+ */
+typedef uint64_t ( * MemoryTransportGetTimeUs_t )( void );
+
+/**
+ * @brief Conditions simulated on the data sent by one endpoint to the other.
+ *
+ * A zero-initialized link delivers the data as soon as it is sent, in reads
+ * as large as the receiver asks for.
+ */
+typedef struct MemoryTransportLink
+{
+    /**
+     * @brief Time in microseconds from a send to when its data can be
+     * received.
+     */
+    uint32_t latencyUs;
+
+    /**
+     * @brief Rate in bytes per second at which the link carries the data;
+     * 0 for no limit.
+     *
+     * The data of a send is received once the link carried all of it, after
+     * the data of the previous sends.
+     */
+    uint64_t bytesPerSecond;
+
+    /**
+     * @brief Largest number of bytes returned by a receive; 0 for no limit.
+     *
+     * This exercises the handling of partial reads of a packet.
+     */
+    size_t maxFragmentLength;
+} MemoryTransportLink_t;
+
+/**
+ * @brief A send held back by the latency or the bandwidth limit of a link.
+ */
+typedef struct MemoryTransportPendingSend
+{
+    size_t end;             /**< @brief Position in the ring of the end of the data of the send. */
+    uint64_t releaseTimeUs; /**< @brief Time from which the data of the send can be received. */
+} MemoryTransportPendingSend_t;
+
+/**
+ * @brief Single-producer, single-consumer ring buffer carrying the data sent
+ * by one endpoint to the other.
+ *
+ * The positions are free-running: they are reduced modulo the size of the
+ * buffer to index it. Only the sending endpoint writes
+ * #MemoryTransportRing_t.tail, #MemoryTransportRing_t.pendingTail and
+ * #MemoryTransportRing_t.linkFreeTimeUs, and only the receiving endpoint
+ * writes the other positions, so each endpoint may run in its own thread.
+ */
+typedef struct MemoryTransportRing
+{
+    uint8_t * pBuffer;          /**< @brief Storage of the ring, set by #MemoryTransport_Init. */
+    size_t size;                /**< @brief Size of #MemoryTransportRing_t.pBuffer, a power of two. */
+    size_t head;                /**< @brief Position of the next byte to receive. */
+    size_t tail;                /**< @brief Position of the next byte to send. */
+    size_t releasedEnd;         /**< @brief End of the data released by the link. */
+    MemoryTransportLink_t link; /**< @brief Conditions of the link, set by #MemoryTransport_SetLink. */
+
+    /**
+     * @brief Sends held back by the link, oldest first.
+     */
+    MemoryTransportPendingSend_t pendingSends[ MEMORY_TRANSPORT_MAX_PENDING_SENDS ];
+
+    size_t pendingHead;      /**< @brief Position of the oldest entry of #MemoryTransportRing_t.pendingSends. */
+    size_t pendingTail;      /**< @brief Position of the next entry of #MemoryTransportRing_t.pendingSends. */
+    uint64_t linkFreeTimeUs; /**< @brief Time at which the link has carried the data sent so far. */
+    bool closed;             /**< @brief Set when either endpoint disconnects. */
+} MemoryTransportRing_t;
+
+/**
+ * @brief Two endpoints connected by a ring in each direction.
+ *
+ * Set it up with #MemoryTransport_Init, then connect one network context to
+ * each endpoint with #MemoryTransport_Connect.
+ */
+typedef struct MemoryTransportPair
+{
+    /**
+     * @brief Rings indexed by the #MemoryTransportEndpoint_t that sends on
+     * them.
+     */
+    MemoryTransportRing_t rings[ 2 ];
+
+    /**
+     * @brief Clock of the latency and bandwidth simulation, set to
+     * #Clock_GetTimeUs by #MemoryTransport_Init.
+     *
+     * Replace it before connecting the endpoints to simulate with a clock the
+     * test controls, such as one that advances only when the test says so.
+     */
+    MemoryTransportGetTimeUs_t getTimeUs;
+} MemoryTransportPair_t;
+
+/**
+ * @brief Parameters for the transport-interface implementation that uses
+ * memory, set by #MemoryTransport_Connect.
+ */
+typedef struct MemoryTransportParams
+{
+    MemoryTransportPair_t * pPair;     /**< @brief Pair of the endpoint. */
+    MemoryTransportRing_t * pSendRing; /**< @brief Ring of the data sent by the endpoint. */
+    MemoryTransportRing_t * pRecvRing; /**< @brief Ring of the data received by the endpoint. */
+} MemoryTransportParams_t;
+
+/**
+ * @brief Set up a pair of endpoints with no latency, bandwidth limit or
+ * fragmentation.
+ *
+ * @param[out] pPair The pair to set up.
+ * @param[in] pClientBuffer Storage of the data sent by #MEMORY_TRANSPORT_CLIENT.
+ * @param[in] pServerBuffer Storage of the data sent by #MEMORY_TRANSPORT_SERVER.
+ * @param[in] bufferSize Size of each buffer, a power of two. It bounds the
+ * data sent but not yet received in each direction.
+ *
+ * @return #MEMORY_TRANSPORT_SUCCESS if successful;
+ * #MEMORY_TRANSPORT_INVALID_PARAMETER on error.
+ */
+MemoryTransportStatus_t MemoryTransport_Init( MemoryTransportPair_t * pPair,
+                                              uint8_t * pClientBuffer,
+                                              uint8_t * pServerBuffer,
+                                              size_t bufferSize );
+
+/**
+ * @brief Set the conditions of the data sent by an endpoint.
+ *
+ * @param[in] pPair The pair set up with #MemoryTransport_Init.
+ * @param[in] sender The endpoint sending the data.
+ * @param[in] pLink The conditions to simulate.
+ *
+ * @note Call this before connecting the endpoints, or while no data is
+ * in flight from @p sender.
+ *
+ * @return #MEMORY_TRANSPORT_SUCCESS if successful;
+ * #MEMORY_TRANSPORT_INVALID_PARAMETER on error.
+ */
+MemoryTransportStatus_t MemoryTransport_SetLink( MemoryTransportPair_t * pPair,
+                                                 MemoryTransportEndpoint_t sender,
+                                                 const MemoryTransportLink_t * pLink );
+
+/**
+ * @brief Connect a network context to an endpoint of a pair.
+ *
+ * @param[out] pNetworkContext The network context, whose parameters are a
+ * #MemoryTransportParams_t.
+ * @param[in] pPair The pair set up with #MemoryTransport_Init.
+ * @param[in] endpoint The endpoint to connect to.
+ *
+ * @return #MEMORY_TRANSPORT_SUCCESS if successful;
+ * #MEMORY_TRANSPORT_INVALID_PARAMETER on error.
+ */
+MemoryTransportStatus_t MemoryTransport_Connect( NetworkContext_t * pNetworkContext,
+                                                 MemoryTransportPair_t * pPair,
+                                                 MemoryTransportEndpoint_t endpoint );
+
+/**
+ * @brief Close the connection of both endpoints.
+ *
+ * The other endpoint still receives the data sent before, after which its
+ * receives fail. Sends of both endpoints fail.
+ *
+ * @param[in] pNetworkContext The network context to close the connection.
+ *
+ * @return #MEMORY_TRANSPORT_SUCCESS if successful;
+ * #MEMORY_TRANSPORT_INVALID_PARAMETER on error.
+ */
+MemoryTransportStatus_t MemoryTransport_Disconnect( const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Receives data sent by the other endpoint.
+ *
+ * This can be used as #TransportInterface.recv function.
+ *
+ * @param[in] pNetworkContext The network context connected with
+ * #MemoryTransport_Connect.
+ * @param[out] pBuffer Buffer to receive the data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @note The receive never blocks. It returns 0, like the other transports
+ * when their receive timeout expires, if no data was released by the link.
+ *
+ * @return Number of bytes received, which may be fewer than requested;
+ * 0 if no data is available; negative value once the connection is closed
+ * and all of its data was received.
+ */
+int32_t MemoryTransport_Recv( NetworkContext_t * pNetworkContext,
+                              void * pBuffer,
+                              size_t bytesToRecv );
+
+/**
+ * @brief Sends data to the other endpoint.
+ *
+ * This can be used as the #TransportInterface.send function.
+ *
+ * @param[in] pNetworkContext The network context connected with
+ * #MemoryTransport_Connect.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @note The send never blocks. It copies as many bytes as the ring has room
+ * for, and returns 0 if the ring is full or
+ * #MEMORY_TRANSPORT_MAX_PENDING_SENDS sends are held back by the link.
+ *
+ * @return Number of bytes sent, which may be fewer than requested; 0 if
+ * nothing could be sent; negative value if the connection is closed.
+ */
+int32_t MemoryTransport_Send( NetworkContext_t * pNetworkContext,
+                              const void * pBuffer,
+                              size_t bytesToSend );
+
+#endif /* ifndef MEMORY_TRANSPORT_POSIX_H_ */
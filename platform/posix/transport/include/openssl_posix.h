@@ -49,6 +49,13 @@
 
 /************ End of logging configuration ****************/
 
+/* Standard includes. */
+#include <stdbool.h>
+
+/* POSIX includes for struct iovec and off_t. */
+#include <sys/types.h>
+#include <sys/uio.h>
+
 /* OpenSSL include. */
 #include <openssl/ssl.h>
 
@@ -58,6 +65,125 @@
 /* Socket include. */
 #include "sockets_posix.h"
 
+/**
+ * @brief Maximum number of SSL contexts kept by the SSL context cache.
+ *
+ * See #OpensslCredentials_t.cacheSslContext.
+ */
+#ifndef OPENSSL_SSL_CONTEXT_CACHE_SIZE
+    #define OPENSSL_SSL_CONTEXT_CACHE_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Maximum number of servers, by host and port, for which a TLS
+ * session is kept by the session cache.
+ *
+ * See #OpensslCredentials_t.cacheSession.
+ */
+#ifndef OPENSSL_SESSION_CACHE_SIZE
+    #define OPENSSL_SESSION_CACHE_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Number of slots of the shared session cache, each holding the TLS
+ * session of one server host.
+ *
+ * See #Openssl_OpenSharedSessionCache.
+ */
+#ifndef OPENSSL_SHARED_SESSION_SLOTS
+    #define OPENSSL_SHARED_SESSION_SLOTS    ( 16U )
+#endif
+
+/**
+ * @brief Largest DER encoding of a TLS session kept by the shared session
+ * cache. The encoding includes the certificate of the server.
+ *
+ * The processes sharing a cache file must be built with the same
+ * #OPENSSL_SHARED_SESSION_SLOTS and #OPENSSL_SHARED_SESSION_MAX_LENGTH.
+ */
+#ifndef OPENSSL_SHARED_SESSION_MAX_LENGTH
+    #define OPENSSL_SHARED_SESSION_MAX_LENGTH    ( 4096U )
+#endif
+
+/**
+ * @brief Maximum number of server certificates whose verification result is
+ * kept by the verification cache.
+ *
+ * See #OpensslCredentials_t.cacheVerifiedChains and
+ * #OpensslCredentials_t.ocspMode.
+ */
+#ifndef OPENSSL_VERIFY_CACHE_SIZE
+    #define OPENSSL_VERIFY_CACHE_SIZE    ( 8U )
+#endif
+
+/**
+ * @brief Number of seconds a verified server certificate chain is trusted
+ * without being built and verified again.
+ */
+#ifndef OPENSSL_VERIFY_CACHE_TTL_SECONDS
+    #define OPENSSL_VERIFY_CACHE_TTL_SECONDS    ( 3600 )
+#endif
+
+/**
+ * @brief Size of the stack buffer #Openssl_SendFile reads the file into when
+ * kernel TLS offload is not in use.
+ */
+#ifndef OPENSSL_SENDFILE_BUFFER_SIZE
+    #define OPENSSL_SENDFILE_BUFFER_SIZE    ( 4096U )
+#endif
+
+/**
+ * @brief Set to 1 to have the first connection initialize OpenSSL without
+ * reading the OpenSSL configuration file, and without loading the error
+ * strings of OpenSSL unless the transport logs.
+ *
+ * This shortens the start of short-lived processes. The settings of the
+ * configuration file, such as a system-wide security level, are then not
+ * applied.
+ */
+#ifndef OPENSSL_MINIMAL_INIT
+    #define OPENSSL_MINIMAL_INIT    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to map a DER bundle of root CAs into memory instead of
+ * reading it. See #OpensslCredentials_t.pRootCaPath.
+ */
+#ifndef OPENSSL_DER_BUNDLE_MMAP
+    #define OPENSSL_DER_BUNDLE_MMAP    ( 1 )
+#endif
+
+/**
+ * @brief Set to 1 to accept a PKCS #11 URI as
+ * #OpensslCredentials_t.pPrivateKeyPath, #OpensslCredentials_t.pClientCertPath
+ * or #OpensslCredentials_t.pRootCaPath, for credentials held by a corePKCS11
+ * token.
+ *
+ * Requires the corePKCS11 include directories and sources in the build.
+ * Only elliptic curve keys are supported.
+ */
+#ifndef OPENSSL_PKCS11_ENABLED
+    #define OPENSSL_PKCS11_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Longest label, in bytes, of a key or certificate referenced by a
+ * PKCS #11 URI.
+ */
+#ifndef OPENSSL_PKCS11_MAX_LABEL_LENGTH
+    #define OPENSSL_PKCS11_MAX_LABEL_LENGTH    ( 32U )
+#endif
+
+/**
+ * @brief Progress of a connection started with #Openssl_ConnectStart.
+ */
+typedef enum OpensslConnectState
+{
+    OPENSSL_CONNECT_STATE_IDLE = 0, /**< No connection is in progress. */
+    OPENSSL_CONNECT_STATE_TCP,      /**< The TCP connection is in progress. */
+    OPENSSL_CONNECT_STATE_TLS       /**< The TLS handshake is in progress. */
+} OpensslConnectState_t;
+
 /**
  * @brief Parameters for the transport-interface
  * implementation that uses OpenSSL and POSIX sockets.
@@ -69,6 +195,101 @@ typedef struct OpensslParams
 {
     int32_t socketDescriptor;
     SSL * pSsl;
+
+    /**
+     * @brief Optional read-ahead buffer, set by the application before
+     * calling #Openssl_Connect. Set to NULL to disable read-ahead.
+     *
+     * When set, #Openssl_Recv fills this buffer with a single SSL_read and
+     * serves small reads, such as the single-byte reads coreMQTT makes for
+     * the packet header, from memory.
+     */
+    uint8_t * pRecvBuffer;
+
+    /**
+     * @brief Size of #OpensslParams_t.pRecvBuffer in bytes.
+     */
+    size_t recvBufferSize;
+
+    size_t recvBufferHead;   /**< @brief Offset of the first unread byte in #OpensslParams_t.pRecvBuffer. */
+    size_t recvBufferLength; /**< @brief Number of unread bytes in #OpensslParams_t.pRecvBuffer. */
+
+    /**
+     * @brief Optional buffer used by #Openssl_Writev to gather multiple
+     * buffers into a single TLS record. Set to NULL to disable gathering.
+     */
+    uint8_t * pSendBuffer;
+
+    /**
+     * @brief Size of #OpensslParams_t.pSendBuffer in bytes.
+     */
+    size_t sendBufferSize;
+
+    /**
+     * @brief File that new TLS sessions of this connection are saved to.
+     * Set by #Openssl_Connect from #OpensslCredentials_t.pSessionFilePath.
+     */
+    const char * pSessionFilePath;
+
+    /**
+     * @brief Port of the server, which keys the TLS sessions of this
+     * connection in the session cache. Set by #Openssl_Connect.
+     */
+    uint16_t serverPort;
+
+    /**
+     * @brief State of a connection started with #Openssl_ConnectStart.
+     * Managed by the transport.
+     */
+    OpensslConnectState_t connectState;
+    SocketConnectContext_t socketConnectContext;           /**< @brief State of the TCP connection in progress. */
+    const ServerInfo_t * pConnectServerInfo;               /**< @brief Server of the connection in progress. */
+    const struct OpensslCredentials * pConnectCredentials; /**< @brief Credentials of the connection in progress. */
+
+    /**
+     * @brief Whether the kernel encrypts the data sent on this connection.
+     * Set by the transport once the TLS handshake completes. See
+     * #OpensslCredentials_t.enableKtls.
+     */
+    bool ktlsSendEnabled;
+
+    /**
+     * @brief Whether the kernel decrypts the data received on this
+     * connection. Set by the transport once the TLS handshake completes.
+     */
+    bool ktlsRecvEnabled;
+
+    /**
+     * @brief Whether the server accepted #OpensslCredentials_t.pEarlyData
+     * as TLS 1.3 early data. Set by #Openssl_Connect.
+     */
+    bool earlyDataAccepted;
+
+    /**
+     * @brief Largest plaintext of the records sent, or 0 for the TLS
+     * maximum. Set by the transport from
+     * #OpensslCredentials_t.maxFragmentLength.
+     */
+    uint16_t maxSendFragment;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+
+        /**
+         * @brief Statistics of the connection, reset by #Openssl_Connect.
+         * Read them with #Openssl_GetStats.
+         */
+        TransportStats_t stats;
+    #endif
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+
+        /**
+         * @brief Class of the traffic of the connection, which decides
+         * whether it waits for #TransportThrottle_Wait. Zero initialization
+         * makes a connection interactive.
+         */
+        TransportTrafficClass_t trafficClass;
+    #endif
 } OpensslParams_t;
 
 /**
@@ -83,9 +304,47 @@ typedef enum OpensslStatus
     OPENSSL_HANDSHAKE_FAILED,    /**< Performing TLS handshake with server failed. */
     OPENSSL_API_ERROR,           /**< A call to a system API resulted in an internal error. */
     OPENSSL_DNS_FAILURE,         /**< Resolving hostname of the server failed. */
-    OPENSSL_CONNECT_FAILURE      /**< Initial connection to the server failed. */
+    OPENSSL_CONNECT_FAILURE,     /**< Initial connection to the server failed. */
+    OPENSSL_WANT_READ,           /**< The connection is in progress. Wait until the socket is readable. */
+    OPENSSL_WANT_WRITE           /**< The connection is in progress. Wait until the socket is writable. */
 } OpensslStatus_t;
 
+/**
+ * @brief Memory held by the buffers of a connection, as reported by
+ * #Openssl_GetBufferUsage.
+ */
+typedef struct OpensslBufferUsage
+{
+    size_t readBufferBytes;      /**< @brief Size of the record read buffer OpenSSL holds now. */
+    size_t writeBufferBytes;     /**< @brief Size of the record write buffer OpenSSL holds now. */
+    size_t transportBufferBytes; /**< @brief Size of #OpensslParams_t.pRecvBuffer and #OpensslParams_t.pSendBuffer. */
+    size_t pendingBytes;         /**< @brief Bytes received and not yet returned by #Openssl_Recv. */
+    bool buffersReleased;        /**< @brief Whether OpenSSL releases its buffers when the connection is idle. */
+} OpensslBufferUsage_t;
+
+/**
+ * @brief Order in which the client offers the AEAD cipher suites, as set by
+ * #OpensslCredentials_t.cipherPolicy.
+ */
+typedef enum OpensslCipherPolicy
+{
+    OPENSSL_CIPHERS_DEFAULT = 0,     /**< Keep the default order of OpenSSL. */
+    OPENSSL_CIPHERS_AUTO,            /**< Offer first the AEAD that is fastest on the CPU. */
+    OPENSSL_CIPHERS_PREFER_AES_GCM,  /**< Offer AES-GCM before ChaCha20-Poly1305. */
+    OPENSSL_CIPHERS_PREFER_CHACHA20  /**< Offer ChaCha20-Poly1305 before AES-GCM. */
+} OpensslCipherPolicy_t;
+
+/**
+ * @brief Whether the revocation status of the server certificate is checked
+ * through OCSP stapling, as set by #OpensslCredentials_t.ocspMode.
+ */
+typedef enum OpensslOcspMode
+{
+    OPENSSL_OCSP_DISABLED = 0, /**< Do not request a stapled OCSP response. */
+    OPENSSL_OCSP_REQUEST,      /**< Check the stapled response if the server sends one. */
+    OPENSSL_OCSP_REQUIRE       /**< Fail the handshake unless the certificate is known to be good. */
+} OpensslOcspMode_t;
+
 /**
  * @brief Contains the credentials to establish a TLS connection.
  */
@@ -127,11 +386,198 @@ typedef struct OpensslCredentials
      * @brief Filepaths to certificates and private key that are used when
      * performing the TLS handshake.
      *
+     * When #OPENSSL_PKCS11_ENABLED is 1, the root CA and the client
+     * certificate may instead be PKCS #11 URIs naming certificates on the
+     * corePKCS11 token, for example "pkcs11:object=Device%20Cert". Their DER
+     * value is then read from the token, with no file I/O or PEM decoding.
+     *
+     * A root CA path ending in ".der" is a bundle of root CAs: DER
+     * certificates back to back, such as written by
+     * `for f in *.pem; do openssl x509 -in "$f" -outform der; done > ~/roots.der`
+     * run in /etc/ssl/certs.
+     * All its certificates are trusted, and they are parsed with no PEM
+     * decoding, from a mapping of the file if #OPENSSL_DER_BUNDLE_MMAP is 1.
+     * Set #OpensslCredentials_t.cacheSslContext to parse it only once.
+     *
      * @note These strings must be NULL-terminated because the OpenSSL API requires them to be.
      */
     const char * pRootCaPath;     /**< @brief Filepath string to the trusted server root CA. */
     const char * pClientCertPath; /**< @brief Filepath string to the client certificate. */
-    const char * pPrivateKeyPath; /**< @brief Filepath string to the client certificate's private key. */
+
+    /**
+     * @brief Filepath string to the client certificate's private key.
+     *
+     * When #OPENSSL_PKCS11_ENABLED is 1, this may instead be a PKCS #11 URI
+     * (RFC 7512) naming the label of a private key on the corePKCS11 token,
+     * for example "pkcs11:object=Device%20Priv%20TLS%20Key". The handshake
+     * is then signed by the token, and the public key is taken from
+     * #OpensslCredentials_t.pClientCertPath, which must be set. The PKCS #11
+     * session is opened and logged in once, then shared by every connection.
+     */
+    const char * pPrivateKeyPath;
+
+    /**
+     * @brief Set to true to reuse the SSL context, with its parsed root CA,
+     * client certificate and private key, across calls to #Openssl_Connect
+     * with the same file paths.
+     *
+     * The first connection loads the credentials and caches the SSL context.
+     * Later connections with the same paths, including connection retries,
+     * skip reading and parsing the credential files, or reading them from
+     * the PKCS #11 token. Call #Openssl_ReleaseCredentials to remove the
+     * cached context, or #Openssl_ReleasePkcs11Credentials once the token
+     * credentials change. The cache keeps its own copies of the paths, so
+     * the strings only need to remain valid during #Openssl_Connect.
+     */
+    bool cacheSslContext;
+
+    /**
+     * @brief Set to true to resume TLS sessions with the server named by
+     * #OpensslCredentials_t.sniHostName.
+     *
+     * The session the server issues after a successful handshake is kept in
+     * memory and offered again by the next #Openssl_Connect to the same SNI
+     * host, which lets the server skip the certificate exchange and key
+     * agreement of a full handshake. The server falls back to a full
+     * handshake if it does not accept the session. Sessions are only cached
+     * when SNI is enabled.
+     *
+     * A session kept in memory is only offered to connections to the same
+     * port, made from the SSL context the session was issued on, so that it
+     * is never resumed with other credentials. Set
+     * #OpensslCredentials_t.cacheSslContext as well for connections to share
+     * their context; otherwise only the sessions of
+     * #OpensslCredentials_t.pSessionFilePath and of the shared session cache
+     * are offered.
+     */
+    bool cacheSession;
+
+    /**
+     * @brief Optional file to persist the TLS session to, so that it can be
+     * resumed after the process restarts. Set to NULL to keep sessions in
+     * memory only. Ignored unless #OpensslCredentials_t.cacheSession is set.
+     *
+     * The session is read from this file when none is cached in memory or in
+     * the shared session cache, and the file is rewritten whenever the
+     * server issues a new session.
+     *
+     * @note The session file contains the TLS session master secret and must
+     * be protected like the client private key. This string must remain
+     * valid until the connection is disconnected.
+     */
+    const char * pSessionFilePath;
+
+    /**
+     * @brief Set to true to hand the TLS record layer over to the kernel
+     * (kTLS) once the handshake completes.
+     *
+     * With kernel TLS offload, #Openssl_Send writes application data to the
+     * socket with a plain send() and the kernel encrypts it, and
+     * #Openssl_SendFile transfers files to the socket without copying them
+     * through user space. #Openssl_Recv keeps using SSL_read, which reads
+     * the records decrypted by the kernel and still handles the TLS control
+     * messages that a plain recv() cannot.
+     *
+     * @note Requires OpenSSL 3.0 or later built with kTLS support, and the
+     * Linux tls kernel module. The transport falls back to user space
+     * encryption when the kernel does not support the negotiated cipher.
+     */
+    bool enableKtls;
+
+    /**
+     * @brief Order in which the TLS 1.3 cipher suites and the TLS 1.2
+     * ciphers are offered.
+     *
+     * AES-GCM is several times faster than ChaCha20-Poly1305 on CPUs with
+     * AES and carry-less multiply instructions (AES-NI and PCLMULQDQ on x86,
+     * the Armv8 crypto extensions on Arm), and several times slower on CPUs
+     * without them. #OPENSSL_CIPHERS_AUTO detects these instructions once
+     * and offers the faster AEAD first; the other policies fix the order.
+     * Except with #OPENSSL_CIPHERS_DEFAULT, TLS 1.2 is limited to the AEAD
+     * ciphers with ECDHE or DHE key exchange.
+     *
+     * @note The server picks the cipher, and only follows the order of the
+     * client if it does not enforce its own preference.
+     */
+    OpensslCipherPolicy_t cipherPolicy;
+
+    /**
+     * @brief Set to true to free the record buffers of OpenSSL while the
+     * connection is idle (SSL_MODE_RELEASE_BUFFERS).
+     *
+     * A connection otherwise keeps a read buffer of about 17 KB and a write
+     * buffer sized by #OpensslCredentials_t.maxFragmentLength for its whole
+     * life. Released buffers are allocated again by the next send or by the
+     * next record received, which suits connections that are idle most of
+     * the time, such as MQTT sessions between keep alives.
+     *
+     * When #OpensslCredentials_t.maxFragmentLength is also set to 512,
+     * 1024, 2048 or 4096, it is negotiated with the server through the max
+     * fragment length extension (RFC 6066), so that the read buffer only
+     * has to hold records of that size if the server supports it. OpenSSL
+     * does not implement the record size limit extension (RFC 8449).
+     */
+    bool releaseIdleBuffers;
+
+    /**
+     * @brief Whether to request a stapled OCSP response (RFC 6066) with the
+     * server certificate and check its revocation status.
+     *
+     * The stapled response must be signed by the issuer of the certificate
+     * or by a responder it delegated, and be current. A certificate reported
+     * revoked, or an invalid response, fails the handshake in both modes.
+     * A good status is cached until the next update of the response, and
+     * stands in for the staple of later handshakes with the same
+     * certificate. Resumed sessions are not checked again.
+     *
+     * @note Fetching the response from the OCSP responder when the server
+     * does not staple one is not supported: with #OPENSSL_OCSP_REQUIRE such
+     * servers can only be connected to while a cached status is current.
+     */
+    OpensslOcspMode_t ocspMode;
+
+    /**
+     * @brief Set to true to cache the result of the server certificate
+     * chain verification, keyed by the SHA-256 fingerprint of the server
+     * certificate.
+     *
+     * Later handshakes that present the same server certificate within
+     * #OPENSSL_VERIFY_CACHE_TTL_SECONDS skip building and verifying the
+     * chain up to the root CA, and only check the host name and expiry of
+     * the certificate. The handshake itself still proves that the server
+     * holds the private key of the certificate.
+     *
+     * @note A certificate revoked while its chain is cached is only
+     * detected through #OpensslCredentials_t.ocspMode, or once the entry
+     * expires.
+     */
+    bool cacheVerifiedChains;
+
+    /**
+     * @brief Optional data, such as an MQTT CONNECT packet, that
+     * #Openssl_Connect sends as the first application data of the
+     * connection. Set to NULL to send none.
+     *
+     * When #OpensslCredentials_t.earlyDataReplaySafe is set and a TLS 1.3
+     * session that allows enough early data is resumed, the data is sent as
+     * early data (0-RTT) in the first flight of the handshake, which saves a
+     * round trip. Otherwise, or if the server rejects the early data, it is
+     * sent once the handshake completes. Either way it has been sent once
+     * #Openssl_Connect returns #OPENSSL_SUCCESS, and must not be sent again.
+     *
+     * @note Not supported by #Openssl_ConnectStart.
+     */
+    const uint8_t * pEarlyData;
+    size_t earlyDataLength; /**< @brief Length of #OpensslCredentials_t.pEarlyData. */
+
+    /**
+     * @brief Set to true only if #OpensslCredentials_t.pEarlyData may be
+     * processed twice by the server. Early data is not protected against
+     * replay: an attacker who captured the first flight can have the server
+     * process it again. When false, the data is only sent after the
+     * handshake.
+     */
+    bool earlyDataReplaySafe;
 } OpensslCredentials_t;
 
 /**
@@ -155,6 +601,163 @@ OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
                                  uint32_t sendTimeoutMs,
                                  uint32_t recvTimeoutMs );
 
+/**
+ * @brief Starts a non-blocking TLS connection to a server.
+ *
+ * This performs the same steps as #Openssl_Connect, but never waits for the
+ * server, so a single thread can drive many connections at once. While
+ * #OPENSSL_WANT_READ or #OPENSSL_WANT_WRITE is returned, wait until
+ * #OpensslParams_t.socketDescriptor is readable or writable respectively,
+ * for example with poll(), then call #Openssl_ConnectPoll. The application is
+ * responsible for giving up on a connection that takes too long, by calling
+ * #Openssl_ConnectAbort.
+ *
+ * @note The host name is resolved with a blocking call to getaddrinfo.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pOpensslCredentials Credentials for the TLS connection.
+ * @param[in] sendTimeoutMs Timeout for transport send once connected.
+ * @param[in] recvTimeoutMs Timeout for transport recv once connected.
+ *
+ * @note @p pServerInfo and @p pOpensslCredentials must remain valid until the
+ * connection is established, has failed, or is aborted.
+ *
+ * @note #OpensslCredentials_t.pEarlyData must be NULL.
+ *
+ * @return #OPENSSL_WANT_READ or #OPENSSL_WANT_WRITE while the connection is in
+ * progress; #OPENSSL_SUCCESS if it was established immediately;
+ * the errors returned by #Openssl_Connect on failure.
+ */
+OpensslStatus_t Openssl_ConnectStart( NetworkContext_t * pNetworkContext,
+                                      const ServerInfo_t * pServerInfo,
+                                      const OpensslCredentials_t * pOpensslCredentials,
+                                      uint32_t sendTimeoutMs,
+                                      uint32_t recvTimeoutMs );
+
+/**
+ * @brief Continues a connection started with #Openssl_ConnectStart.
+ *
+ * @note #OpensslParams_t.socketDescriptor may change between calls while the
+ * TCP connection is in progress, as each resolved address is tried in turn.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return #OPENSSL_SUCCESS once the TLS session is established;
+ * #OPENSSL_WANT_READ or #OPENSSL_WANT_WRITE while it is in progress;
+ * #OPENSSL_INVALID_PARAMETER if no connection is in progress;
+ * the errors returned by #Openssl_Connect on failure.
+ */
+OpensslStatus_t Openssl_ConnectPoll( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Abandons a connection started with #Openssl_ConnectStart and
+ * releases its resources.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER on failure.
+ */
+OpensslStatus_t Openssl_ConnectAbort( NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Releases the SSL context and TLS session cached for the given
+ * credentials.
+ *
+ * Connections that are still using the context keep it alive until they are
+ * disconnected. The next #Openssl_Connect with these credentials reloads them
+ * from the files and performs a full handshake, unless a session is still
+ * saved in #OpensslCredentials_t.pSessionFilePath or in the shared session
+ * cache.
+ *
+ * @param[in] pOpensslCredentials Credentials the context and session were
+ * cached with. Only the file paths and the SNI host name are used.
+ *
+ * @return #OPENSSL_SUCCESS on success, including when nothing was cached;
+ * #OPENSSL_INVALID_PARAMETER if @p pOpensslCredentials is NULL.
+ */
+OpensslStatus_t Openssl_ReleaseCredentials( const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Makes OpenSSL allocate its memory from the allocator of
+ * allocator.h, where it is counted for #ALLOCATOR_SUBSYSTEM_OPENSSL and
+ * taken from the backend of the allocator, such as its static pool.
+ *
+ * Call this at the start of the program, before any other OpenSSL or
+ * transport function: OpenSSL only accepts it before its first allocation.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_API_ERROR if OpenSSL has
+ * allocated memory already.
+ */
+OpensslStatus_t Openssl_UseAllocator( void );
+
+/**
+ * @brief Shares the TLS sessions of #OpensslCredentials_t.cacheSession
+ * with the other processes that open the same file.
+ *
+ * The file is mapped in memory as a table of #OPENSSL_SHARED_SESSION_SLOTS
+ * slots, which the processes read and write without locks: a slot being
+ * written by a process is skipped by the others. Each new session issued by
+ * a server is written to the slot of its host, and #Openssl_Connect offers
+ * the session of the slot when none is cached in memory. The children
+ * forked by the process inherit the mapping, so that connections made by
+ * short-lived processes resume the sessions of one another instead of
+ * performing full handshakes.
+ *
+ * Call this before the first connection, and not while connections are
+ * being made.
+ *
+ * @note The file contains the TLS session master secrets. It is created
+ * readable only by its owner and must be protected like the client private
+ * key. A process killed while writing a slot leaves the slot unused until the
+ * file is removed.
+ *
+ * @param[in] pFilePath The file, created if it does not exist.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER if
+ * @p pFilePath is NULL or a cache is already open; #OPENSSL_API_ERROR if the
+ * file could not be mapped or was laid out with other dimensions.
+ */
+OpensslStatus_t Openssl_OpenSharedSessionCache( const char * pFilePath );
+
+/**
+ * @brief Unmaps the file of #Openssl_OpenSharedSessionCache. The sessions
+ * it holds are kept for the other processes.
+ *
+ * Not to be called while connections are being made.
+ */
+void Openssl_CloseSharedSessionCache( void );
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+
+/**
+ * @brief Closes the PKCS #11 session shared by the connections whose private
+ * key is on the token.
+ *
+ * Call this once no connection or cached SSL context uses a token key, for
+ * example before the application exits. The next connection with a token key
+ * opens a new session and logs in again.
+ *
+ * @return #OPENSSL_SUCCESS on success, including when no session was open;
+ * #OPENSSL_API_ERROR if the session could not be closed.
+ */
+    OpensslStatus_t Openssl_ClosePkcs11Session( void );
+
+/**
+ * @brief Removes from the SSL context cache every context whose root CA,
+ * client certificate or private key is a PKCS #11 URI.
+ *
+ * corePKCS11 does not report token events, so call this after provisioning
+ * new credentials on the token. The next #Openssl_Connect with token
+ * credentials reads them from the token again. As with
+ * #Openssl_ReleaseCredentials, open connections keep using the credentials
+ * they were established with, and cached TLS sessions are kept.
+ *
+ * @return #OPENSSL_SUCCESS.
+ */
+    OpensslStatus_t Openssl_ReleasePkcs11Credentials( void );
+#endif
+
 /**
  * @brief Closes a TLS session on top of a TCP connection using the OpenSSL API.
  *
@@ -175,6 +778,10 @@ OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext );
  * @param[out] pBuffer Buffer to receive network data into.
  * @param[in] bytesToRecv Number of bytes requested from the network.
  *
+ * @note If a read-ahead buffer is configured in #OpensslParams_t, fewer
+ * bytes than requested may be returned when only part of the request is
+ * buffered.
+ *
  * @return Number of bytes received if successful; negative value to indicate failure.
  * A return value of zero represents that the receive operation can be retried.
  */
@@ -201,4 +808,94 @@ int32_t Openssl_Send( NetworkContext_t * pNetworkContext,
                       const void * pBuffer,
                       size_t bytesToSend );
 
+/**
+ * @brief Sends data from multiple buffers over an established TLS session
+ * using the OpenSSL API.
+ *
+ * If #OpensslParams_t.pSendBuffer is large enough to hold all buffers, they
+ * are gathered into it and sent with a single SSL_write, so that a packet
+ * split across several buffers, such as an MQTT PUBLISH header and its
+ * application payload, is sent as one TLS record. Otherwise, the buffers are
+ * sent in order with one SSL_write each.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ * @param[in] pIoVec Array of buffers to send, in order.
+ * @param[in] ioVecCount Number of entries in @p pIoVec.
+ *
+ * @return Total number of bytes sent if successful, which may be fewer than
+ * the total length of all buffers; negative value on error.
+ */
+int32_t Openssl_Writev( NetworkContext_t * pNetworkContext,
+                        const struct iovec * pIoVec,
+                        size_t ioVecCount );
+
+/**
+ * @brief Sends part of a file over an established TLS session.
+ *
+ * When kernel TLS offload is in use for the connection, the file is sent
+ * with SSL_sendfile, which lets the kernel encrypt it from the page cache
+ * without copying it to user space. Otherwise, up to
+ * #OPENSSL_SENDFILE_BUFFER_SIZE bytes are read from the file and sent with
+ * SSL_write.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ * @param[in] fileDescriptor File to send, opened for reading.
+ * @param[in] offset Offset in the file of the first byte to send.
+ * @param[in] bytesToSend Number of bytes of the file to send.
+ *
+ * @return Number of bytes sent if successful, which may be fewer than
+ * @p bytesToSend; negative value on error.
+ */
+int32_t Openssl_SendFile( NetworkContext_t * pNetworkContext,
+                          int32_t fileDescriptor,
+                          off_t offset,
+                          size_t bytesToSend );
+
+/**
+ * @brief Reports the memory held by the buffers of a connection.
+ *
+ * The record buffers are sized from the fragment length in effect, and are
+ * only counted while OpenSSL holds them: with
+ * #OpensslCredentials_t.releaseIdleBuffers, an idle connection holds none.
+ * The counts leave out the handshake state and the allocator overhead; see
+ * Allocator_GetStats for the memory of OpenSSL as a whole.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ * @param[out] pUsage The buffer usage of the connection.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER on failure.
+ */
+OpensslStatus_t Openssl_GetBufferUsage( const NetworkContext_t * pNetworkContext,
+                                        OpensslBufferUsage_t * pUsage );
+
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+
+/**
+ * @brief Takes a snapshot of the statistics of a connection.
+ *
+ * Calls to #Openssl_Writev and #Openssl_SendFile are counted as the calls to
+ * #Openssl_Send they make. The connection phases are only timed for
+ * connections established with #Openssl_Connect.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ * @param[out] pStats Buffer to copy the statistics to.
+ *
+ * @note The snapshot is not synchronized with sends and receives made by
+ * other threads on the same connection.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER on failure.
+ */
+    OpensslStatus_t Openssl_GetStats( const NetworkContext_t * pNetworkContext,
+                                      TransportStats_t * pStats );
+
+/**
+ * @brief Resets the statistics of a connection.
+ *
+ * @param[in] pNetworkContext The network context created using Openssl_Connect API.
+ *
+ * @return #OPENSSL_SUCCESS on success; #OPENSSL_INVALID_PARAMETER on failure.
+ */
+    OpensslStatus_t Openssl_ResetStats( NetworkContext_t * pNetworkContext );
+#endif /* if ( TRANSPORT_STATS_ENABLED == 1 ) */
+
 #endif /* ifndef OPENSSL_POSIX_H_ */
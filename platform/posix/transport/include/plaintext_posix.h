@@ -49,6 +49,9 @@
 
 /************ End of logging configuration ****************/
 
+/* POSIX include for struct iovec. */
+#include <sys/uio.h>
+
 /* Transport includes. */
 #include "transport_interface.h"
 #include "sockets_posix.h"
@@ -60,6 +63,61 @@
 typedef struct PlaintextParams
 {
     int32_t socketDescriptor;
+
+    /**
+     * @brief Timeout in milliseconds used when waiting for the socket to
+     * become readable.
+     *
+     * This is cached by #Plaintext_Connect so that #Plaintext_Recv does not
+     * have to query the socket for its receive timeout on every call.
+     */
+    uint32_t recvTimeoutMs;
+
+    /**
+     * @brief Timeout in milliseconds used when waiting for the socket to
+     * become writable.
+     *
+     * This is cached by #Plaintext_Connect so that #Plaintext_Send does not
+     * have to query the socket for its send timeout on every call.
+     */
+    uint32_t sendTimeoutMs;
+
+    /**
+     * @brief Optional read-ahead buffer, set by the application before
+     * calling #Plaintext_Connect. Set to NULL to disable read-ahead.
+     *
+     * When set, #Plaintext_Recv fills this buffer with as much data as the
+     * socket has available and serves small reads, such as the single-byte
+     * reads coreMQTT makes for the packet header, from memory.
+     */
+    uint8_t * pRecvBuffer;
+
+    /**
+     * @brief Size of #PlaintextParams_t.pRecvBuffer in bytes.
+     */
+    size_t recvBufferSize;
+
+    size_t recvBufferHead;   /**< @brief Offset of the first unread byte in #PlaintextParams_t.pRecvBuffer. */
+    size_t recvBufferLength; /**< @brief Number of unread bytes in #PlaintextParams_t.pRecvBuffer. */
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+
+        /**
+         * @brief Statistics of the connection, reset by #Plaintext_Connect.
+         * Read them with #Plaintext_GetStats.
+         */
+        TransportStats_t stats;
+    #endif
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+
+        /**
+         * @brief Class of the traffic of the connection, which decides
+         * whether it waits for #TransportThrottle_Wait. Zero initialization
+         * makes a connection interactive.
+         */
+        TransportTrafficClass_t trafficClass;
+    #endif
 } PlaintextParams_t;
 
 /**
@@ -72,6 +130,10 @@ typedef struct PlaintextParams
  *
  * @note A timeout of 0 means infinite timeout.
  *
+ * @note The timeouts are also stored in the #PlaintextParams_t of
+ * @p pNetworkContext and used by #Plaintext_Recv and #Plaintext_Send when
+ * waiting for the socket to become ready.
+ *
  * @return #SOCKETS_SUCCESS if successful;
  * #SOCKETS_INVALID_PARAMETER, #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE on error.
  */
@@ -99,7 +161,15 @@ SocketStatus_t Plaintext_Disconnect( const NetworkContext_t * pNetworkContext );
  * @param[out] pBuffer Buffer to receive network data into.
  * @param[in] bytesToRecv Number of bytes requested from the network.
  *
- * @return Number of bytes received if successful; negative value on error.
+ * @note A non-blocking read is attempted first. The socket is only polled for
+ * readability, up to the cached receive timeout, when no data is pending.
+ *
+ * @note If a read-ahead buffer is configured in #PlaintextParams_t, fewer
+ * bytes than requested may be returned when only part of the request is
+ * buffered.
+ *
+ * @return Number of bytes received if successful; 0 if no data was available
+ * before the receive timeout expired; negative value on error.
  */
 int32_t Plaintext_Recv( NetworkContext_t * pNetworkContext,
                         void * pBuffer,
@@ -115,10 +185,63 @@ int32_t Plaintext_Recv( NetworkContext_t * pNetworkContext,
  * @param[in] pBuffer Buffer containing the bytes to send over the network.
  * @param[in] bytesToSend Number of bytes to send over the network.
  *
- * @return Number of bytes sent if successful; negative value on error.
+ * @note A non-blocking send is attempted first. The socket is only polled for
+ * writability, up to the cached send timeout, when the send buffer is full.
+ *
+ * @return Number of bytes sent if successful; 0 if the socket did not become
+ * writable before the send timeout expired; negative value on error.
  */
 int32_t Plaintext_Send( NetworkContext_t * pNetworkContext,
                         const void * pBuffer,
                         size_t bytesToSend );
 
+/**
+ * @brief Sends data from multiple buffers over an established TCP connection
+ * with a single system call.
+ *
+ * This allows a packet that is split across several buffers, such as an MQTT
+ * PUBLISH header and its application payload, to be sent without copying the
+ * pieces into one contiguous buffer.
+ *
+ * @param[in] pNetworkContext The network context created using Plaintext_Connect API.
+ * @param[in] pIoVec Array of buffers to send, in order.
+ * @param[in] ioVecCount Number of entries in @p pIoVec.
+ *
+ * @note Like #Plaintext_Send, the socket is only polled for writability when
+ * a non-blocking send would block.
+ *
+ * @return Total number of bytes sent if successful, which may be fewer than
+ * the total length of all buffers; 0 if the socket did not become writable
+ * before the send timeout expired; negative value on error.
+ */
+int32_t Plaintext_Writev( NetworkContext_t * pNetworkContext,
+                          const struct iovec * pIoVec,
+                          size_t ioVecCount );
+
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+
+/**
+ * @brief Takes a snapshot of the statistics of a connection.
+ *
+ * @param[in] pNetworkContext The network context created using Plaintext_Connect API.
+ * @param[out] pStats Buffer to copy the statistics to.
+ *
+ * @note The snapshot is not synchronized with sends and receives made by
+ * other threads on the same connection.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER on error.
+ */
+    SocketStatus_t Plaintext_GetStats( const NetworkContext_t * pNetworkContext,
+                                       TransportStats_t * pStats );
+
+/**
+ * @brief Resets the statistics of a connection.
+ *
+ * @param[in] pNetworkContext The network context created using Plaintext_Connect API.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER on error.
+ */
+    SocketStatus_t Plaintext_ResetStats( NetworkContext_t * pNetworkContext );
+#endif /* if ( TRANSPORT_STATS_ENABLED == 1 ) */
+
 #endif /* ifndef PLAINTEXT_POSIX_H_ */
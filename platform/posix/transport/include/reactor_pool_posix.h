@@ -0,0 +1,250 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef REACTOR_POOL_POSIX_H_
+#define REACTOR_POOL_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the reactor pool. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "ReactorPool"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_ERROR
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* POSIX includes. */
+#include <pthread.h>
+
+/* Event loop include. */
+#include "event_loop_posix.h"
+
+/**
+ * @brief Maximum number of reactors of a pool.
+ */
+#ifndef REACTOR_POOL_MAX_REACTORS
+    #define REACTOR_POOL_MAX_REACTORS    ( 16U )
+#endif
+
+/**
+ * @brief Longest time in milliseconds a reactor waits in
+ * #EventLoop_Dispatch when none of its timers is due sooner.
+ */
+#ifndef REACTOR_POOL_MAX_WAIT_MS
+    #define REACTOR_POOL_MAX_WAIT_MS    ( 1000U )
+#endif
+
+/**
+ * @brief Reactor pool return status.
+ */
+typedef enum ReactorPoolStatus
+{
+    REACTOR_POOL_SUCCESS = 0,       /**< Function successfully completed. */
+    REACTOR_POOL_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    REACTOR_POOL_API_ERROR          /**< A call to a system API resulted in an internal error. */
+} ReactorPoolStatus_t;
+
+struct ReactorPoolTask;
+
+/**
+ * @brief Function of a task posted to a reactor, called on its thread.
+ *
+ * @param[in] pTask The task.
+ */
+typedef void ( * ReactorPoolFunction_t )( struct ReactorPoolTask * pTask );
+
+/**
+ * @brief A task posted to a reactor, whose memory is owned by the caller.
+ *
+ * The application sets #ReactorPoolTask_t.function and
+ * #ReactorPoolTask_t.pUserContext before #ReactorPool_Post. The task must
+ * remain valid until its function is called, and must not be posted again
+ * before.
+ */
+typedef struct ReactorPoolTask
+{
+    ReactorPoolFunction_t function; /**< @brief Function called on the thread of the reactor. */
+    void * pUserContext;            /**< @brief Application data, such as the connection to add. */
+
+    struct ReactorPoolTask * pNext; /**< @brief Next task posted to the reactor. */
+} ReactorPoolTask_t;
+
+/**
+ * @brief A reactor: a thread running an event loop.
+ *
+ * The members are managed by the reactor pool functions.
+ */
+typedef struct Reactor
+{
+    EventLoop_t eventLoop;                /**< @brief Event loop of the connections of the shard. */
+    EventLoopConnection_t wakeConnection; /**< @brief The eventfd waking up the reactor for the posted tasks. */
+    pthread_mutex_t mutex;                /**< @brief Guards the posted tasks and #Reactor_t.stopping. */
+    ReactorPoolTask_t * pPostedHead;      /**< @brief Oldest task posted. */
+    ReactorPoolTask_t * pPostedTail;      /**< @brief Newest task posted. */
+    pthread_t thread;                     /**< @brief Thread of the reactor. */
+    bool stopping;                        /**< @brief Whether the thread is to return. */
+} Reactor_t;
+
+/**
+ * @brief Reactors, each owning the connections of a shard.
+ *
+ * A connection is assigned to a shard by the consistent hash of a key of
+ * its own, such as the client identifier of an MQTT connection, so that it
+ * stays on the same reactor from one run to the next, and only a fraction
+ * of the connections move when the number of reactors changes. The
+ * connections of a shard are only touched from the thread of its reactor,
+ * so they need no locking: the event loop of a reactor is used as that of
+ * a single-threaded application, from its callbacks and its posted tasks.
+ *
+ * The members are managed by the reactor pool functions.
+ */
+typedef struct ReactorPool
+{
+    Reactor_t reactors[ REACTOR_POOL_MAX_REACTORS ]; /**< @brief The reactors, one per shard. */
+    uint32_t reactorCount;                           /**< @brief Number of #ReactorPool_t.reactors. */
+    bool running;                                    /**< @brief Whether the threads of the reactors run. */
+} ReactorPool_t;
+
+/**
+ * @brief Initialize the event loops of a pool, without starting their
+ * threads.
+ *
+ * Until #ReactorPool_Start, the event loops may be set up from the calling
+ * thread, for example to add the connections of each shard.
+ *
+ * @param[out] pPool The pool.
+ * @param[in] reactorCount Number of reactors, from 1 to
+ * #REACTOR_POOL_MAX_REACTORS.
+ *
+ * @return #REACTOR_POOL_SUCCESS if successful; #REACTOR_POOL_INVALID_PARAMETER,
+ * #REACTOR_POOL_API_ERROR on error.
+ */
+ReactorPoolStatus_t ReactorPool_Init( ReactorPool_t * pPool,
+                                      uint32_t reactorCount );
+
+/**
+ * @brief Get the shard of a key, such as a client identifier.
+ *
+ * The shard is the jump consistent hash of Lamping and Veach of the 64-bit
+ * FNV-1a hash of the key: the keys are spread evenly over the shards, and
+ * going from N to N + 1 shards only moves 1 / ( N + 1 ) of them, all to
+ * the new shard.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pKey The key.
+ * @param[in] keyLength Length of @p pKey.
+ *
+ * @return The shard, lower than #ReactorPool_t.reactorCount; 0 if a
+ * parameter is invalid.
+ */
+uint32_t ReactorPool_GetShard( const ReactorPool_t * pPool,
+                               const char * pKey,
+                               size_t keyLength );
+
+/**
+ * @brief Get the event loop of a shard.
+ *
+ * Once the pool is started, the event loop is only to be used from the
+ * callbacks and the posted tasks of its reactor.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] shard The shard.
+ *
+ * @return The event loop; NULL if a parameter is invalid.
+ */
+EventLoop_t * ReactorPool_GetEventLoop( ReactorPool_t * pPool,
+                                        uint32_t shard );
+
+/**
+ * @brief Post a task to the reactor of a shard, such as adding a connection
+ * to its event loop or publishing from another thread.
+ *
+ * This may be called from any thread. The tasks posted to a reactor run in
+ * the order they were posted, on its thread, between the callbacks of its
+ * event loop.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] shard The shard.
+ * @param[in] pTask The task, whose #ReactorPoolTask_t.function is set.
+ *
+ * @return #REACTOR_POOL_SUCCESS if successful; #REACTOR_POOL_INVALID_PARAMETER,
+ * #REACTOR_POOL_API_ERROR on error.
+ */
+ReactorPoolStatus_t ReactorPool_Post( ReactorPool_t * pPool,
+                                      uint32_t shard,
+                                      ReactorPoolTask_t * pTask );
+
+/**
+ * @brief Start the threads of the reactors.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pGroupName Thread group of the reactors, as in thread_groups.h,
+ * such as a group with a CPU per reactor.
+ *
+ * @return #REACTOR_POOL_SUCCESS if successful; #REACTOR_POOL_INVALID_PARAMETER,
+ * #REACTOR_POOL_API_ERROR on error, in which case no thread runs.
+ */
+ReactorPoolStatus_t ReactorPool_Start( ReactorPool_t * pPool,
+                                       const char * pGroupName );
+
+/**
+ * @brief Stop the threads of the reactors, once they have run the tasks
+ * already posted.
+ *
+ * The event loops, and their connections, are then used from the calling
+ * thread again, for example to remove the connections.
+ *
+ * @param[in] pPool The pool.
+ */
+void ReactorPool_Stop( ReactorPool_t * pPool );
+
+/**
+ * @brief Release the event loops of a stopped pool.
+ *
+ * The connections still registered are not closed.
+ *
+ * @param[in] pPool The pool.
+ */
+void ReactorPool_Deinit( ReactorPool_t * pPool );
+
+#endif /* ifndef REACTOR_POOL_POSIX_H_ */
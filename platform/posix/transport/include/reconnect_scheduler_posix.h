@@ -0,0 +1,286 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RECONNECT_SCHEDULER_POSIX_H_
+#define RECONNECT_SCHEDULER_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the reconnect scheduler. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Reconnect"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_INFO
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Include header for the backoff algorithm library. */
+#include "backoff_algorithm.h"
+
+/* Event loop include. */
+#include "event_loop_posix.h"
+
+/**
+ * @brief The shortest delay in milliseconds before retrying a failed
+ * connection, and the longest delay before the first attempt after a
+ * connection is lost.
+ *
+ * The backoff settings are given in milliseconds to the backoff algorithm
+ * library, so they are at most 65535.
+ */
+#ifndef RECONNECT_BACKOFF_BASE_MS
+    #define RECONNECT_BACKOFF_BASE_MS    ( 500U )
+#endif
+
+/**
+ * @brief The longest delay in milliseconds before retrying a failed
+ * connection.
+ */
+#ifndef RECONNECT_MAX_BACKOFF_DELAY_MS
+    #define RECONNECT_MAX_BACKOFF_DELAY_MS    ( 30000U )
+#endif
+
+/**
+ * @brief Number of retries after a failed attempt, each after a backoff
+ * delay, before the circuit breaker of the endpoint opens.
+ *
+ * This is the attempt budget given to the backoff algorithm library. It must
+ * not be 0, which the library takes as retrying forever.
+ */
+#ifndef RECONNECT_CIRCUIT_RETRY_ATTEMPTS
+    #define RECONNECT_CIRCUIT_RETRY_ATTEMPTS    ( 5U )
+#endif
+
+/**
+ * @brief Time in milliseconds during which an endpoint whose circuit breaker
+ * is open gets no attempt. A random delay of up to a quarter of this is added,
+ * so that the endpoints opened by the same outage do not close together.
+ */
+#ifndef RECONNECT_CIRCUIT_OPEN_MS
+    #define RECONNECT_CIRCUIT_OPEN_MS    ( 60000U )
+#endif
+
+/**
+ * @brief Time in milliseconds after which a handshake that has not been
+ * reported with #ReconnectScheduler_ReportResult is abandoned and counted as
+ * failed.
+ */
+#ifndef RECONNECT_HANDSHAKE_TIMEOUT_MS
+    #define RECONNECT_HANDSHAKE_TIMEOUT_MS    ( 10000U )
+#endif
+
+/**
+ * @brief Reconnect scheduler return status.
+ */
+typedef enum ReconnectStatus
+{
+    RECONNECT_SUCCESS = 0,       /**< Function successfully completed. */
+    RECONNECT_INVALID_PARAMETER, /**< At least one parameter was invalid. */
+    RECONNECT_BAD_STATE          /**< The endpoint is not in a state allowing the call. */
+} ReconnectStatus_t;
+
+/**
+ * @brief State of an endpoint managed by a #ReconnectScheduler_t.
+ */
+typedef enum ReconnectState
+{
+    RECONNECT_STATE_IDLE = 0,    /**< The endpoint is not managed by the scheduler. */
+    RECONNECT_STATE_WAITING,     /**< The backoff delay before the next attempt is running. */
+    RECONNECT_STATE_QUEUED,      /**< The next attempt is due and waits for a free handshake. */
+    RECONNECT_STATE_CONNECTING,  /**< A handshake is in flight. */
+    RECONNECT_STATE_CONNECTED,   /**< The last handshake succeeded. */
+    RECONNECT_STATE_CIRCUIT_OPEN /**< Too many attempts failed; no attempt is made until the circuit breaker lets one through. */
+} ReconnectState_t;
+
+/**
+ * @brief Events reported to a #ReconnectCallback_t.
+ */
+typedef enum ReconnectEvent
+{
+    RECONNECT_EVENT_CONNECT = 0,      /**< Start a handshake now, and report its result with #ReconnectScheduler_ReportResult. */
+    RECONNECT_EVENT_HANDSHAKE_TIMEOUT /**< The handshake took longer than #RECONNECT_HANDSHAKE_TIMEOUT_MS; abandon it. */
+} ReconnectEvent_t;
+
+struct ReconnectEndpoint;
+
+/**
+ * @brief Function called by the scheduler when an endpoint should start or
+ * abandon a handshake.
+ *
+ * The function must not block. It may call the functions of the scheduler,
+ * including #ReconnectScheduler_ReportResult for a handshake that completes
+ * or fails at once.
+ *
+ * @param[in] pEndpoint The endpoint.
+ * @param[in] event What the endpoint should do.
+ */
+typedef void ( * ReconnectCallback_t )( struct ReconnectEndpoint * pEndpoint,
+                                        ReconnectEvent_t event );
+
+/**
+ * @brief A server endpoint whose connection attempts are scheduled.
+ *
+ * The backoff delays and the circuit breaker are kept for each endpoint, so
+ * the failures of one server do not delay the connections to another. The
+ * application sets #ReconnectEndpoint_t.pHostName, #ReconnectEndpoint_t.port,
+ * #ReconnectEndpoint_t.callback and #ReconnectEndpoint_t.pUserContext, and
+ * clears the other members, before calling #ReconnectScheduler_Connect. The
+ * other members are managed by the scheduler. The structure must remain
+ * valid until the endpoint is stopped with #ReconnectScheduler_Stop.
+ */
+typedef struct ReconnectEndpoint
+{
+    const char * pHostName;       /**< @brief Server host name, used in the logs. */
+    uint16_t port;                /**< @brief Server port, used in the logs. */
+    ReconnectCallback_t callback; /**< @brief Function called to start or abandon a handshake. */
+    void * pUserContext;          /**< @brief Application data, such as the network context of the connection. */
+
+    ReconnectState_t state;                           /**< @brief Current state. */
+    bool circuitTrial;                                /**< @brief Whether the attempt queued or in flight is the trial of an open circuit breaker. */
+    uint32_t lastDelayMs;                             /**< @brief Last backoff delay, from which the next one is drawn. */
+    BackoffAlgorithmContext_t backoffContext;         /**< @brief Attempts left before the circuit breaker opens. */
+    TimerWheelTimer_t timer;                          /**< @brief Timer of the backoff delay, of the open circuit breaker or of the handshake. */
+    struct ReconnectScheduler * pScheduler;           /**< @brief Scheduler managing the endpoint. */
+    struct ReconnectEndpoint * pNextQueued;           /**< @brief Next endpoint waiting for a free handshake. */
+    struct ReconnectEndpoint ** ppPreviousQueuedNext; /**< @brief Link pointing to this endpoint; NULL if it is not queued. */
+} ReconnectEndpoint_t;
+
+/**
+ * @brief A scheduler of the connection attempts of many endpoints.
+ *
+ * The delays are run on the timers of an #EventLoop_t, so nothing blocks and
+ * the thread only wakes up when an attempt is due. The members are managed by
+ * the scheduler functions.
+ */
+typedef struct ReconnectScheduler
+{
+    EventLoop_t * pEventLoop;           /**< @brief Event loop running the timers. */
+    uint32_t maxHandshakes;             /**< @brief Largest number of handshakes in flight at once. */
+    uint32_t handshakeCount;            /**< @brief Number of handshakes in flight. */
+    ReconnectEndpoint_t * pQueueHead;   /**< @brief Endpoints waiting for a free handshake, oldest first. */
+    ReconnectEndpoint_t ** ppQueueTail; /**< @brief Link at which the next endpoint is queued. */
+    uint32_t randomState;               /**< @brief State of the generator of the jitter. */
+    bool startingHandshakes;            /**< @brief Whether queued handshakes are being started. */
+} ReconnectScheduler_t;
+
+/**
+ * @brief Initialize a reconnect scheduler.
+ *
+ * The generator of the jitter is seeded from the real-time clock and the
+ * process ID, so that processes started together draw different delays.
+ *
+ * @param[out] pScheduler The scheduler to initialize.
+ * @param[in] pEventLoop The event loop whose #EventLoop_Dispatch runs the
+ * timers of the scheduler.
+ * @param[in] maxHandshakes Largest number of handshakes in flight at once,
+ * which bounds the CPU spent on TLS handshakes after an outage.
+ *
+ * @return #RECONNECT_SUCCESS if successful; #RECONNECT_INVALID_PARAMETER on error.
+ */
+ReconnectStatus_t ReconnectScheduler_Init( ReconnectScheduler_t * pScheduler,
+                                           EventLoop_t * pEventLoop,
+                                           uint32_t maxHandshakes );
+
+/**
+ * @brief Start managing an endpoint, and attempt to connect to it as soon as
+ * a handshake is free.
+ *
+ * @param[in] pScheduler The scheduler.
+ * @param[in] pEndpoint The endpoint, which is not managed yet.
+ *
+ * @return #RECONNECT_SUCCESS if successful; #RECONNECT_INVALID_PARAMETER,
+ * #RECONNECT_BAD_STATE on error.
+ */
+ReconnectStatus_t ReconnectScheduler_Connect( ReconnectScheduler_t * pScheduler,
+                                              ReconnectEndpoint_t * pEndpoint );
+
+/**
+ * @brief Report that the connection to an endpoint was lost.
+ *
+ * The next attempt is made after a random delay of up to
+ * #RECONNECT_BACKOFF_BASE_MS, so that the clients disconnected by the same
+ * failure do not reconnect in lockstep.
+ *
+ * @param[in] pScheduler The scheduler.
+ * @param[in] pEndpoint An endpoint in #RECONNECT_STATE_CONNECTED.
+ *
+ * @return #RECONNECT_SUCCESS if successful; #RECONNECT_INVALID_PARAMETER,
+ * #RECONNECT_BAD_STATE on error.
+ */
+ReconnectStatus_t ReconnectScheduler_Disconnected( ReconnectScheduler_t * pScheduler,
+                                                   ReconnectEndpoint_t * pEndpoint );
+
+/**
+ * @brief Report the result of the handshake started for
+ * #RECONNECT_EVENT_CONNECT.
+ *
+ * A success resets the backoff delays and closes the circuit breaker. After
+ * a failure, the next attempt is made after a delay with decorrelated jitter,
+ * drawn between #RECONNECT_BACKOFF_BASE_MS and three times the last delay,
+ * up to #RECONNECT_MAX_BACKOFF_DELAY_MS. When
+ * #RECONNECT_CIRCUIT_RETRY_ATTEMPTS retries have failed, or when the trial
+ * of an open circuit breaker fails, the circuit breaker opens for
+ * #RECONNECT_CIRCUIT_OPEN_MS, after which a single trial attempt is made.
+ *
+ * @param[in] pScheduler The scheduler.
+ * @param[in] pEndpoint An endpoint in #RECONNECT_STATE_CONNECTING.
+ * @param[in] connected Whether the handshake succeeded.
+ *
+ * @return #RECONNECT_SUCCESS if successful; #RECONNECT_INVALID_PARAMETER,
+ * #RECONNECT_BAD_STATE on error.
+ */
+ReconnectStatus_t ReconnectScheduler_ReportResult( ReconnectScheduler_t * pScheduler,
+                                                   ReconnectEndpoint_t * pEndpoint,
+                                                   bool connected );
+
+/**
+ * @brief Stop managing an endpoint, cancelling its timer and any handshake
+ * slot it holds.
+ *
+ * @param[in] pScheduler The scheduler.
+ * @param[in] pEndpoint The endpoint.
+ *
+ * @return #RECONNECT_SUCCESS if successful; #RECONNECT_INVALID_PARAMETER on error.
+ */
+ReconnectStatus_t ReconnectScheduler_Stop( ReconnectScheduler_t * pScheduler,
+                                           ReconnectEndpoint_t * pEndpoint );
+
+#endif /* ifndef RECONNECT_SCHEDULER_POSIX_H_ */
@@ -48,9 +48,118 @@
 
 /************ End of logging configuration ****************/
 
+/* Standard includes. */
+#include <stdbool.h>
+
+/* POSIX include for struct addrinfo. */
+#include <netdb.h>
+
+/* POSIX include for struct sockaddr and socklen_t. */
+#include <sys/socket.h>
+
 /* Transport interface include. */
 #include "transport_interface.h"
 
+/**
+ * @brief Delay in milliseconds between starting connection attempts to the
+ * resolved addresses of a server in #Sockets_Connect.
+ *
+ * When non-zero, #Sockets_Connect races the addresses as described by
+ * Happy Eyeballs (RFC 8305): addresses are reordered to alternate between
+ * IPv6 and IPv4, a new non-blocking attempt is started whenever the previous
+ * one has not completed within this delay or has failed, and the first socket
+ * to connect is kept. RFC 8305 recommends 250 milliseconds. When zero, the
+ * addresses are tried one after another, each with a blocking connect.
+ */
+#ifndef SOCKETS_CONNECTION_ATTEMPT_DELAY_MS
+    #define SOCKETS_CONNECTION_ATTEMPT_DELAY_MS    ( 0U )
+#endif
+
+/**
+ * @brief Maximum number of resolved addresses attempted by #Sockets_Connect
+ * when #SOCKETS_CONNECTION_ATTEMPT_DELAY_MS is non-zero.
+ */
+#ifndef SOCKETS_MAX_CONNECTION_ATTEMPTS
+    #define SOCKETS_MAX_CONNECTION_ATTEMPTS    ( 8U )
+#endif
+
+/**
+ * @brief Time in milliseconds for which the DNS records of a host name are
+ * reused by #Sockets_Connect and #Sockets_ConnectStart instead of calling
+ * getaddrinfo again.
+ *
+ * getaddrinfo does not report the TTL of the records, so the lifetime of a
+ * cached lookup is set here. When zero, the cache is disabled and every
+ * connection resolves the host name.
+ */
+#ifndef SOCKETS_DNS_CACHE_TTL_MS
+    #define SOCKETS_DNS_CACHE_TTL_MS    ( 0U )
+#endif
+
+/**
+ * @brief Time in milliseconds for which a host name that does not exist is
+ * remembered by the DNS cache. Zero disables negative caching.
+ *
+ * Only used when #SOCKETS_DNS_CACHE_TTL_MS is non-zero. Transient lookup
+ * failures are never cached.
+ */
+#ifndef SOCKETS_DNS_NEGATIVE_CACHE_TTL_MS
+    #define SOCKETS_DNS_NEGATIVE_CACHE_TTL_MS    ( 5000U )
+#endif
+
+/**
+ * @brief Number of host names held by the DNS cache.
+ */
+#ifndef SOCKETS_DNS_CACHE_SIZE
+    #define SOCKETS_DNS_CACHE_SIZE    ( 4U )
+#endif
+
+/**
+ * @brief Longest host name, in bytes, stored in the DNS cache. Longer host
+ * names are resolved on every connection.
+ */
+#ifndef SOCKETS_DNS_CACHE_MAX_HOSTNAME_LENGTH
+    #define SOCKETS_DNS_CACHE_MAX_HOSTNAME_LENGTH    ( 253U )
+#endif
+
+/**
+ * @brief Set to 1 to collect per-connection statistics in the plaintext and
+ * OpenSSL transports. See #TransportStats_t.
+ */
+#ifndef TRANSPORT_STATS_ENABLED
+    #define TRANSPORT_STATS_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Set to 1 to rate limit the background traffic of the plaintext and
+ * OpenSSL transports, with a limit shared by all the connections of the
+ * process. See #TransportThrottle_Configure.
+ */
+#ifndef TRANSPORT_THROTTLE_ENABLED
+    #define TRANSPORT_THROTTLE_ENABLED    ( 0 )
+#endif
+
+/**
+ * @brief Longest time in milliseconds background traffic sleeps before
+ * checking the limit again, so that a new limit applies to the connections
+ * already waiting.
+ */
+#ifndef TRANSPORT_THROTTLE_MAX_SLEEP_MS
+    #define TRANSPORT_THROTTLE_MAX_SLEEP_MS    ( 100U )
+#endif
+
+/**
+ * @brief Number of buckets of a #TransportLatencyHistogram_t.
+ *
+ * Bucket 0 counts latencies below 2 microseconds, and bucket i counts
+ * latencies in [2^i, 2^(i+1)) microseconds. The last bucket also counts every
+ * longer latency. The default of 24 buckets resolves latencies up to about
+ * 8 seconds.
+ */
+#ifndef TRANSPORT_STATS_HISTOGRAM_BUCKETS
+    #define TRANSPORT_STATS_HISTOGRAM_BUCKETS    ( 24U )
+#endif
+
 /**
  * @brief TCP Connect / Disconnect return status.
  */
@@ -61,9 +170,100 @@ typedef enum SocketStatus
     SOCKETS_INSUFFICIENT_MEMORY, /**< Insufficient memory required to establish connection. */
     SOCKETS_API_ERROR,           /**< A call to a system API resulted in an internal error. */
     SOCKETS_DNS_FAILURE,         /**< Resolving hostname of server failed. */
-    SOCKETS_CONNECT_FAILURE      /**< Initial connection to the server failed. */
+    SOCKETS_CONNECT_FAILURE,     /**< Initial connection to the server failed. */
+    SOCKETS_WANT_WRITE           /**< A non-blocking connect is in progress. Wait until the socket is writable. */
 } SocketStatus_t;
 
+/**
+ * @brief Priority classes of the traffic of a connection.
+ */
+typedef enum TransportTrafficClass
+{
+    TRANSPORT_TRAFFIC_INTERACTIVE = 0, /**< Latency sensitive traffic, such as MQTT, which is never delayed. */
+    TRANSPORT_TRAFFIC_BACKGROUND       /**< Bulk transfers, such as HTTP downloads and OTA, which yield to interactive traffic. */
+} TransportTrafficClass_t;
+
+/**
+ * @brief Local end of a connection: the network interface and source address
+ * a socket is bound to before it connects.
+ *
+ * A NULL member leaves the choice to the kernel routing table, so a
+ * zero-initialized structure changes nothing. Unlike #SocketOptions_t, a
+ * binding that cannot be applied fails the attempt to that address, so that
+ * traffic is never silently sent over another interface.
+ */
+typedef struct SocketBinding
+{
+    /**
+     * @brief NULL-terminated name of the network interface, such as "eth0",
+     * that the connection must use (SO_BINDTODEVICE), or NULL.
+     *
+     * @note Linux before 5.7 requires CAP_NET_RAW to bind to an interface.
+     */
+    const char * pInterfaceName;
+
+    /**
+     * @brief Source address of the connection, or NULL. Resolved addresses
+     * of another family are skipped. With a port of 0, the kernel picks the
+     * source port when the socket connects (IP_BIND_ADDRESS_NO_PORT).
+     */
+    const struct sockaddr * pLocalAddress;
+    socklen_t localAddressLength; /**< @brief Length of #SocketBinding_t.pLocalAddress. */
+} SocketBinding_t;
+
+/**
+ * @brief Optional TCP options applied to a socket before it connects.
+ *
+ * A zero member leaves the system default in place, so a zero-initialized
+ * structure changes nothing. The options are applied on a best-effort basis:
+ * an option the system rejects is logged and does not fail the connection.
+ */
+typedef struct SocketOptions
+{
+    /**
+     * @brief Disable Nagle's algorithm (TCP_NODELAY), so that small packets
+     * such as MQTT PINGREQ and PUBACK are sent without waiting for the
+     * acknowledgement of earlier data.
+     */
+    bool noDelay;
+
+    int32_t sendBufferSize; /**< @brief Size of the kernel send buffer in bytes (SO_SNDBUF). */
+    int32_t recvBufferSize; /**< @brief Size of the kernel receive buffer in bytes (SO_RCVBUF). */
+
+    /**
+     * @brief Enable TCP keepalive probes (SO_KEEPALIVE). The members below
+     * tune the probes when keepalive is enabled.
+     */
+    bool keepAlive;
+    uint32_t keepAliveIdleSec;     /**< @brief Idle time before the first probe (TCP_KEEPIDLE). */
+    uint32_t keepAliveIntervalSec; /**< @brief Time between probes (TCP_KEEPINTVL). */
+    uint32_t keepAliveCount;       /**< @brief Unanswered probes before the connection is dropped (TCP_KEEPCNT). */
+
+    /**
+     * @brief Time in milliseconds that sent data may remain unacknowledged
+     * before the connection is dropped (TCP_USER_TIMEOUT).
+     */
+    uint32_t userTimeoutMs;
+
+    /**
+     * @brief Send the first flight of data, such as the TLS ClientHello, in
+     * the SYN with TCP Fast Open (TCP_FASTOPEN_CONNECT).
+     *
+     * @note With Fast Open, connect returns before the handshake completes,
+     * so the first address to accept the socket is used and
+     * #SOCKETS_CONNECTION_ATTEMPT_DELAY_MS no longer races the addresses.
+     * The kernel falls back to a regular handshake when the server has not
+     * issued a Fast Open cookie.
+     */
+    bool fastOpen;
+
+    /**
+     * @brief Interface and source address to bind the socket to. See
+     * #SocketBinding_t.
+     */
+    SocketBinding_t binding;
+} SocketOptions_t;
+
 /**
  * @brief Information on the remote server for connection setup.
  */
@@ -72,8 +272,158 @@ typedef struct ServerInfo
     const char * pHostName; /**< @brief Server host name. */
     size_t hostNameLength;  /**< @brief Length of the server host name. */
     uint16_t port;          /**< @brief Server port in host-order. */
+
+    /**
+     * @brief TCP options to apply to the connection, or NULL to keep the
+     * system defaults. When used with #Sockets_ConnectStart, the options
+     * must remain valid until the connection is established or has failed.
+     */
+    const SocketOptions_t * pSocketOptions;
+
+    /**
+     * @brief Class of the traffic the connection will carry, passed to the
+     * #SocketsBindingPolicy_t so that it can place bulk transfers and
+     * latency sensitive traffic on different interfaces. Zero initialization
+     * makes a connection interactive.
+     */
+    TransportTrafficClass_t trafficClass;
 } ServerInfo_t;
 
+/**
+ * @brief Policy choosing the local end of each connection made by
+ * #Sockets_Connect and #Sockets_ConnectStart. See #Sockets_SetBindingPolicy.
+ *
+ * @param[in] pPolicyContext The context given to #Sockets_SetBindingPolicy.
+ * @param[in] pServerInfo The server being connected to, including its
+ * #ServerInfo_t.trafficClass.
+ * @param[in,out] pBinding The binding of #ServerInfo_t.pSocketOptions, or a
+ * zeroed one without options, which the policy may change. The memory it
+ * points to must remain valid until the connection is established or has
+ * failed.
+ */
+typedef void ( * SocketsBindingPolicy_t )( void * pPolicyContext,
+                                           const ServerInfo_t * pServerInfo,
+                                           SocketBinding_t * pBinding );
+
+/**
+ * @brief State of a non-blocking connection started with
+ * #Sockets_ConnectStart.
+ *
+ * @note The members are managed by #Sockets_ConnectStart and
+ * #Sockets_ConnectPoll. Only #SocketConnectContext_t.tcpSocket is meant to
+ * be read by the application.
+ */
+typedef struct SocketConnectContext
+{
+    /**
+     * @brief Socket of the connection attempt in progress, which becomes
+     * writable when the attempt completes; the connected socket once
+     * #SOCKETS_SUCCESS is returned; -1 otherwise.
+     */
+    int32_t tcpSocket;
+
+    struct addrinfo * pListHead;            /**< @brief DNS records of the server. */
+    struct addrinfo * pNextAddress;         /**< @brief Next DNS record to attempt if the current one fails. */
+    const SocketOptions_t * pSocketOptions; /**< @brief TCP options to apply to each attempt. May be NULL. */
+    SocketBinding_t binding;                /**< @brief Local end of each attempt, chosen by the binding policy. */
+    uint16_t port;                          /**< @brief Server port in host-order. */
+    uint32_t sendTimeoutMs;                 /**< @brief Timeout for transport send, set once connected. */
+    uint32_t recvTimeoutMs;                 /**< @brief Timeout for transport recv, set once connected. */
+} SocketConnectContext_t;
+
+/**
+ * @brief Operations whose latency is recorded in #TransportStats_t.
+ */
+typedef enum TransportStatsPhase
+{
+    TRANSPORT_STATS_DNS = 0,       /**< Resolving the host name of the server. */
+    TRANSPORT_STATS_TCP_CONNECT,   /**< Establishing the TCP connection. */
+    TRANSPORT_STATS_TLS_HANDSHAKE, /**< Performing the TLS handshake. */
+    TRANSPORT_STATS_SEND,          /**< A single call to a transport send function. */
+    TRANSPORT_STATS_RECV,          /**< A single call to the transport receive function. */
+    TRANSPORT_STATS_PHASE_COUNT    /**< Number of phases. */
+} TransportStatsPhase_t;
+
+/**
+ * @brief Latency histogram with logarithmic buckets.
+ */
+typedef struct TransportLatencyHistogram
+{
+    uint32_t buckets[ TRANSPORT_STATS_HISTOGRAM_BUCKETS ]; /**< @brief Number of samples in each bucket. See #TRANSPORT_STATS_HISTOGRAM_BUCKETS. */
+    uint32_t count;                                        /**< @brief Total number of samples. */
+    uint64_t totalUs;                                      /**< @brief Sum of all samples in microseconds. */
+    uint64_t maxUs;                                        /**< @brief Largest sample in microseconds. */
+} TransportLatencyHistogram_t;
+
+/**
+ * @brief Statistics of a connection, collected by the plaintext and OpenSSL
+ * transports when #TRANSPORT_STATS_ENABLED is set to 1.
+ */
+typedef struct TransportStats
+{
+    uint64_t bytesSent;     /**< @brief Bytes sent by the application. */
+    uint64_t bytesReceived; /**< @brief Bytes received by the application. */
+    uint32_t sendCalls;     /**< @brief Calls to the transport send functions. */
+    uint32_t recvCalls;     /**< @brief Calls to the transport receive function. */
+    uint32_t partialSends;  /**< @brief Send calls that sent fewer bytes than requested. */
+    uint32_t sendTimeouts;  /**< @brief Send calls that returned 0. */
+    uint32_t recvTimeouts;  /**< @brief Receive calls that returned 0. */
+    uint32_t sendErrors;    /**< @brief Send calls that returned an error. */
+    uint32_t recvErrors;    /**< @brief Receive calls that returned an error. */
+
+    /**
+     * @brief Send, receive and poll system calls or, for the OpenSSL
+     * transport, calls to SSL_write and SSL_read, made to serve the send and
+     * receive calls. Reads served from a read-ahead buffer make none.
+     */
+    uint32_t ioCalls;
+
+    /**
+     * @brief Latency of each #TransportStatsPhase_t.
+     */
+    TransportLatencyHistogram_t latency[ TRANSPORT_STATS_PHASE_COUNT ];
+} TransportStats_t;
+
+/**
+ * @brief Limit of the background traffic of the process.
+ *
+ * Background traffic takes its bytes from a token bucket refilled at the
+ * limit, and waits while the bucket is empty. Interactive traffic is never
+ * delayed, but takes its bytes from the same bucket, so that background
+ * traffic yields the share of the link interactive traffic uses.
+ */
+typedef struct TransportThrottleConfig
+{
+    uint32_t rateBytesPerSec; /**< @brief Bytes per second of all traffic, beyond which background traffic waits; 0 for no limit. */
+    uint32_t burstBytes;      /**< @brief Bytes background traffic may transfer at once after being idle, at least 1. */
+
+    /**
+     * @brief Round trip time in milliseconds of interactive traffic, reported
+     * with #TransportThrottle_ReportRtt, above which the limit is halved. The
+     * limit then grows back by a sixteenth of #rateBytesPerSec after each
+     * round trip time within the target. Set to 0 to keep the limit fixed.
+     */
+    uint32_t rttTargetMs;
+
+    /**
+     * @brief Lowest limit the round trip time can lower the limit to, at
+     * least 1 and at most #rateBytesPerSec.
+     */
+    uint32_t minRateBytesPerSec;
+} TransportThrottleConfig_t;
+
+/**
+ * @brief Round trip time of a connection as measured by the kernel
+ * (TCP_INFO).
+ */
+typedef struct SocketRttInfo
+{
+    uint32_t srttUs;           /**< @brief Smoothed round trip time in microseconds. */
+    uint32_t rttVarUs;         /**< @brief Variation of the round trip time in microseconds. */
+    uint32_t rtoUs;            /**< @brief Retransmission timeout in microseconds, backed off while segments are lost. */
+    uint32_t totalRetransmits; /**< @brief Segments retransmitted since the connection was established. */
+} SocketRttInfo_t;
+
 /**
  * @brief Establish a connection to server.
  *
@@ -84,6 +434,10 @@ typedef struct ServerInfo
  *
  * @note A timeout of 0 means infinite timeout.
  *
+ * @note The TCP options of #ServerInfo_t.pSocketOptions, if any, are applied
+ * to each socket before it connects, and the socket is then bound as chosen
+ * by the #SocketsBindingPolicy_t, if any.
+ *
  * @return #SOCKETS_SUCCESS if successful;
  * #SOCKETS_INVALID_PARAMETER, #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE on error.
  */
@@ -92,6 +446,135 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
                                 uint32_t sendTimeoutMs,
                                 uint32_t recvTimeoutMs );
 
+/**
+ * @brief Establish a connection to server like #Sockets_Connect, and record
+ * how long resolving the host name and establishing the TCP connection took.
+ *
+ * @param[out] pTcpSocket The output parameter to return the created socket descriptor.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ * @param[out] pStats Statistics to record the latencies in. May be NULL.
+ *
+ * @return The values returned by #Sockets_Connect.
+ */
+SocketStatus_t Sockets_ConnectWithStats( int32_t * pTcpSocket,
+                                         const ServerInfo_t * pServerInfo,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs,
+                                         TransportStats_t * pStats );
+
+/**
+ * @brief Start a non-blocking connection to a server.
+ *
+ * The host name is resolved, then a non-blocking connect is started to the
+ * first address that accepts one. Unlike #Sockets_Connect, this does not wait
+ * for the server, so an event loop can drive many connections at once: when
+ * #SOCKETS_WANT_WRITE is returned, wait until
+ * #SocketConnectContext_t.tcpSocket is writable, for example with poll(),
+ * then call #Sockets_ConnectPoll.
+ *
+ * @note The host name is resolved with a blocking call to getaddrinfo.
+ *
+ * @param[out] pContext Connection state, initialized by this function.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ *
+ * @return #SOCKETS_WANT_WRITE if the connection is in progress;
+ * #SOCKETS_SUCCESS if it was established immediately;
+ * #SOCKETS_INVALID_PARAMETER, #SOCKETS_DNS_FAILURE, #SOCKETS_CONNECT_FAILURE on error.
+ */
+SocketStatus_t Sockets_ConnectStart( SocketConnectContext_t * pContext,
+                                     const ServerInfo_t * pServerInfo,
+                                     uint32_t sendTimeoutMs,
+                                     uint32_t recvTimeoutMs );
+
+/**
+ * @brief Continue a connection started with #Sockets_ConnectStart.
+ *
+ * If the attempt in progress failed, the next resolved address is tried, so
+ * #SocketConnectContext_t.tcpSocket may change between calls. Once
+ * connected, the socket is switched back to blocking mode and its timeouts
+ * are set, as with #Sockets_Connect.
+ *
+ * @note When any status other than #SOCKETS_WANT_WRITE is returned, the
+ * context no longer holds any resources other than the connected socket.
+ *
+ * @param[in, out] pContext Connection state.
+ *
+ * @return #SOCKETS_SUCCESS if connected; #SOCKETS_WANT_WRITE if the connection
+ * is still in progress; #SOCKETS_INVALID_PARAMETER, #SOCKETS_CONNECT_FAILURE,
+ * #SOCKETS_API_ERROR, #SOCKETS_INSUFFICIENT_MEMORY on error.
+ */
+SocketStatus_t Sockets_ConnectPoll( SocketConnectContext_t * pContext );
+
+/**
+ * @brief Abandon a connection started with #Sockets_ConnectStart, for
+ * example when the application gives up waiting for it.
+ *
+ * @param[in, out] pContext Connection state.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER on error.
+ */
+SocketStatus_t Sockets_ConnectAbort( SocketConnectContext_t * pContext );
+
+/**
+ * @brief Switch a socket between blocking and non-blocking mode.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] nonBlocking true to make the socket non-blocking.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_API_ERROR on error.
+ */
+SocketStatus_t Sockets_SetNonBlocking( int32_t tcpSocket,
+                                       bool nonBlocking );
+
+/**
+ * @brief Read the round trip time the kernel measured on a connected socket.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[out] pRttInfo The round trip time.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_API_ERROR on error.
+ */
+SocketStatus_t Sockets_GetRttInfo( int32_t tcpSocket,
+                                   SocketRttInfo_t * pRttInfo );
+
+/**
+ * @brief Change the send and receive timeouts of a connected socket, set
+ * when it connected.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ *
+ * @note A timeout of 0 means infinite timeout.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER,
+ * #SOCKETS_INSUFFICIENT_MEMORY, #SOCKETS_API_ERROR on error.
+ */
+SocketStatus_t Sockets_SetTimeouts( int32_t tcpSocket,
+                                    uint32_t sendTimeoutMs,
+                                    uint32_t recvTimeoutMs );
+
+/**
+ * @brief Set the policy choosing the interface and source address of the
+ * connections of the process, for example to keep MQTT on a stable link and
+ * move bulk transfers of #TRANSPORT_TRAFFIC_BACKGROUND to a faster one.
+ *
+ * The policy is called once per connection, before its first attempt, from
+ * the thread making the connection.
+ *
+ * @param[in] policy The policy, or NULL to use the binding of
+ * #ServerInfo_t.pSocketOptions as is.
+ * @param[in] pPolicyContext Context passed to @p policy.
+ */
+void Sockets_SetBindingPolicy( SocketsBindingPolicy_t policy,
+                               void * pPolicyContext );
+
 /**
  * @brief End connection to server.
  *
@@ -101,4 +584,100 @@ SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
  */
 SocketStatus_t Sockets_Disconnect( int32_t tcpSocket );
 
+/**
+ * @brief Get the current monotonic time, to pass to the functions that
+ * record latencies in #TransportStats_t.
+ *
+ * @return Microseconds elapsed since an arbitrary point in the past.
+ */
+uint64_t TransportStats_GetTimeUs( void );
+
+/**
+ * @brief Record the latency of an operation in statistics.
+ *
+ * @param[in,out] pStats Statistics to update.
+ * @param[in] phase Operation that completed.
+ * @param[in] startTimeUs Time the operation started at, from
+ * #TransportStats_GetTimeUs.
+ */
+void TransportStats_RecordLatency( TransportStats_t * pStats,
+                                   TransportStatsPhase_t phase,
+                                   uint64_t startTimeUs );
+
+/**
+ * @brief Record the result and latency of a call to a transport send
+ * function in statistics.
+ *
+ * @param[in,out] pStats Statistics to update.
+ * @param[in] bytesToSend Number of bytes the caller asked to send.
+ * @param[in] bytesSent Value returned by the send function.
+ * @param[in] startTimeUs Time the call started at, from
+ * #TransportStats_GetTimeUs.
+ */
+void TransportStats_RecordSend( TransportStats_t * pStats,
+                                size_t bytesToSend,
+                                int32_t bytesSent,
+                                uint64_t startTimeUs );
+
+/**
+ * @brief Record the result and latency of a call to a transport receive
+ * function in statistics.
+ *
+ * @param[in,out] pStats Statistics to update.
+ * @param[in] bytesReceived Value returned by the receive function.
+ * @param[in] startTimeUs Time the call started at, from
+ * #TransportStats_GetTimeUs.
+ */
+void TransportStats_RecordRecv( TransportStats_t * pStats,
+                                int32_t bytesReceived,
+                                uint64_t startTimeUs );
+
+/**
+ * @brief Set the limit of the background traffic of the process.
+ *
+ * @param[in] pConfig The limit, or NULL to remove it.
+ */
+void TransportThrottle_Configure( const TransportThrottleConfig_t * pConfig );
+
+/**
+ * @brief Wait until traffic of a class may transfer bytes.
+ *
+ * Interactive traffic, and any traffic without a limit, returns immediately.
+ * Background traffic sleeps until the token bucket holds @p bytes, or a
+ * #TransportThrottleConfig_t.burstBytes of them.
+ *
+ * @param[in] trafficClass The class of the traffic of the connection.
+ * @param[in] bytes The bytes the caller asked to transfer.
+ *
+ * @return The bytes that may be transferred, at most @p bytes.
+ */
+size_t TransportThrottle_Wait( TransportTrafficClass_t trafficClass,
+                               size_t bytes );
+
+/**
+ * @brief Take the bytes transferred by a connection of any class from the
+ * token bucket.
+ *
+ * @param[in] bytes The bytes sent or received.
+ */
+void TransportThrottle_Consume( size_t bytes );
+
+/**
+ * @brief Adapt the limit to a round trip time measured by interactive
+ * traffic, such as the time from an MQTT PINGREQ to its PINGRESP.
+ *
+ * Ignored unless #TransportThrottleConfig_t.rttTargetMs is set.
+ *
+ * @param[in] rttMs The round trip time in milliseconds.
+ */
+void TransportThrottle_ReportRtt( uint32_t rttMs );
+
+/**
+ * @brief Get the current limit, lowered from the configured one after round
+ * trip times beyond the target.
+ *
+ * @return The limit in bytes per second, 0 without a limit.
+ */
+uint32_t TransportThrottle_GetRate( void );
+
 #endif /* ifndef SOCKETS_POSIX_H_ */
@@ -0,0 +1,184 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TIMER_WHEEL_POSIX_H_
+#define TIMER_WHEEL_POSIX_H_
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of levels of the timer wheel.
+ *
+ * Level 0 holds the timers due within #TIMER_WHEEL_SLOTS ticks, one slot per
+ * tick, and each further level spans #TIMER_WHEEL_SLOTS times the level below.
+ * The timers of a slot of a higher level are moved down a level when the
+ * wheel reaches the slot. The default of 4 levels spans 2^24 ticks, which is
+ * 19 days with ticks of 100 milliseconds. A timer due further away waits in
+ * the last slot of the top level until it is in reach. At most 5 levels are
+ * supported.
+ */
+#ifndef TIMER_WHEEL_LEVELS
+    #define TIMER_WHEEL_LEVELS    ( 4U )
+#endif
+
+/**
+ * @brief log2 of the number of slots of each level of the timer wheel.
+ *
+ * Each level has a 64-bit map of the slots holding timers, so this is at
+ * most 6.
+ */
+#define TIMER_WHEEL_SLOT_BITS    ( 6U )
+
+/**
+ * @brief Number of slots of each level of the timer wheel.
+ */
+#define TIMER_WHEEL_SLOTS        ( 1U << TIMER_WHEEL_SLOT_BITS )
+
+/**
+ * @brief Returned by #TimerWheel_GetNextTimeout when no timer is running.
+ */
+#define TIMER_WHEEL_NO_TIMEOUT    ( UINT32_MAX )
+
+struct TimerWheelTimer;
+
+/**
+ * @brief Function called by #TimerWheel_Advance when a timer is due.
+ *
+ * The timer is no longer running when this is called, so the function may
+ * start it again, and may start or cancel any other timer.
+ *
+ * @param[in] pTimer The timer that is due.
+ */
+typedef void ( * TimerWheelCallback_t )( struct TimerWheelTimer * pTimer );
+
+/**
+ * @brief A timer of a #TimerWheel_t.
+ *
+ * The application sets #TimerWheelTimer_t.callback and
+ * #TimerWheelTimer_t.pUserContext, and clears the other members, before
+ * starting the timer the first time. The other members are managed by the
+ * timer wheel. A running timer must remain valid until it is due or
+ * cancelled.
+ */
+typedef struct TimerWheelTimer
+{
+    TimerWheelCallback_t callback; /**< @brief Function called when the timer is due. */
+    void * pUserContext;           /**< @brief Application data, such as the connection the timer belongs to. */
+
+    uint32_t expiryTick;                      /**< @brief Tick at which the timer is due. */
+    uint32_t slot;                            /**< @brief Index of the slot holding the timer, counting the slots of all the levels. */
+    struct TimerWheelTimer * pNext;           /**< @brief Next timer in the same slot. */
+    struct TimerWheelTimer ** ppPreviousNext; /**< @brief Link pointing to this timer; NULL if the timer is not running. */
+} TimerWheelTimer_t;
+
+/**
+ * @brief A hierarchical timer wheel.
+ *
+ * Starting and cancelling a timer take constant time, whatever the number of
+ * timers running, and #TimerWheel_Advance only visits the slots that hold
+ * timers. The members are managed by the timer wheel functions.
+ */
+typedef struct TimerWheel
+{
+    uint32_t currentTick;                                                  /**< @brief Last tick whose timers were processed. */
+    size_t timerCount;                                                     /**< @brief Number of timers running. */
+    uint64_t occupiedSlots[ TIMER_WHEEL_LEVELS ];                          /**< @brief Bit map of the slots holding timers, by level. */
+    TimerWheelTimer_t * pSlots[ TIMER_WHEEL_LEVELS ][ TIMER_WHEEL_SLOTS ]; /**< @brief Timers running, by slot. */
+} TimerWheel_t;
+
+/**
+ * @brief Initialize a timer wheel with no timer running.
+ *
+ * @param[out] pWheel The timer wheel to initialize.
+ * @param[in] currentTick The current tick, in any unit the application
+ * chooses, such as #Clock_GetTimeMs divided by a tick length.
+ */
+void TimerWheel_Init( TimerWheel_t * pWheel,
+                      uint32_t currentTick );
+
+/**
+ * @brief Start a timer, replacing its expiry if it is already running.
+ *
+ * @param[in] pWheel The timer wheel.
+ * @param[in] pTimer The timer to start.
+ * @param[in] ticks Number of ticks after the current tick at which the timer
+ * is due. 0 is taken as 1, since the current tick is already processed.
+ */
+void TimerWheel_Start( TimerWheel_t * pWheel,
+                       TimerWheelTimer_t * pTimer,
+                       uint32_t ticks );
+
+/**
+ * @brief Cancel a timer, if it is running.
+ *
+ * @param[in] pWheel The timer wheel.
+ * @param[in] pTimer The timer to cancel.
+ */
+void TimerWheel_Cancel( TimerWheel_t * pWheel,
+                        TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Check whether a timer is running.
+ *
+ * @param[in] pTimer The timer.
+ *
+ * @return true if the timer is started and neither due nor cancelled.
+ */
+bool TimerWheel_IsRunning( const TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Advance a timer wheel to a tick and call the callbacks of the timers
+ * that are due.
+ *
+ * The callbacks are called once all the due timers are collected, and after
+ * the current tick of the wheel is set to @p newTick, so a callback starting
+ * a timer counts from @p newTick. The timers due at the same tick are
+ * reported in no particular order.
+ *
+ * @param[in] pWheel The timer wheel.
+ * @param[in] newTick The current tick. It must not be before the current
+ * tick of the wheel.
+ *
+ * @return Number of callbacks called.
+ */
+size_t TimerWheel_Advance( TimerWheel_t * pWheel,
+                           uint32_t newTick );
+
+/**
+ * @brief Get the number of ticks after which #TimerWheel_Advance has work
+ * to do.
+ *
+ * This is never later than the next timer that is due. It may be earlier,
+ * for a timer far away that is moved down a level, so call this again after
+ * each #TimerWheel_Advance rather than sleeping until the next timer.
+ *
+ * @param[in] pWheel The timer wheel.
+ *
+ * @return Number of ticks after the current tick of the wheel, at least 1;
+ * #TIMER_WHEEL_NO_TIMEOUT if no timer is running.
+ */
+uint32_t TimerWheel_GetNextTimeout( const TimerWheel_t * pWheel );
+
+#endif /* ifndef TIMER_WHEEL_POSIX_H_ */
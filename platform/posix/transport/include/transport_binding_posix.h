@@ -0,0 +1,180 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TRANSPORT_BINDING_POSIX_H_
+#define TRANSPORT_BINDING_POSIX_H_
+
+/**
+ * @file transport_binding_posix.h
+ * @brief Compile-time binding of the OpenSSL or plaintext transport.
+ *
+ * The functions of this file call the transport chosen by #TRANSPORT_BINDING
+ * directly instead of through the function pointers of a
+ * #TransportInterface_t. Being static and inline, a read that the read-ahead
+ * buffer of the connection holds, such as one of the single-byte reads of an
+ * MQTT fixed header and remaining length, compiles to memory loads and
+ * stores at the call site. Only the other reads call #Openssl_Recv or
+ * #Plaintext_Recv.
+ *
+ * The file that includes this header defines TRANSPORT_BINDING, as
+ * #TRANSPORT_BINDING_OPENSSL or #TRANSPORT_BINDING_PLAINTEXT, and the
+ * struct NetworkContext of the transport, with its pParams, before
+ * including it:
+ *
+ * @code{c}
+ * struct NetworkContext
+ * {
+ *     OpensslParams_t * pParams;
+ * };
+ *
+ * #define TRANSPORT_BINDING    TRANSPORT_BINDING_OPENSSL
+ * #include "transport_binding_posix.h"
+ * @endcode
+ *
+ * #TransportBinding_Recv and #TransportBinding_Send may also be given to a
+ * #TransportInterface_t, to which they are ordinary functions.
+ *
+ * @note The reads served from memory are not counted by the transport
+ * statistics, so they are always made by the transport when
+ * TRANSPORT_STATS_ENABLED is 1. They do not fire the tls_recv trace probes
+ * either.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Value of #TRANSPORT_BINDING to bind the OpenSSL transport.
+ */
+#define TRANSPORT_BINDING_OPENSSL      ( 1 )
+
+/**
+ * @brief Value of #TRANSPORT_BINDING to bind the plaintext transport.
+ */
+#define TRANSPORT_BINDING_PLAINTEXT    ( 2 )
+
+#if ( TRANSPORT_BINDING == TRANSPORT_BINDING_OPENSSL )
+    #include "openssl_posix.h"
+
+/**
+ * @brief Parameters of the transport bound.
+ */
+    typedef OpensslParams_t TransportBindingParams_t;
+
+/**
+ * @brief Whether the parameters of the transport bound have a connection,
+ * without which its receive function fails.
+ */
+    #define TRANSPORT_BINDING_CONNECTED( pParams )    ( ( pParams )->pSsl != NULL )
+    #define TRANSPORT_BINDING_RECV                    Openssl_Recv /**< @brief Receive function of the transport bound. */
+    #define TRANSPORT_BINDING_SEND                    Openssl_Send /**< @brief Send function of the transport bound. */
+#elif ( TRANSPORT_BINDING == TRANSPORT_BINDING_PLAINTEXT )
+    #include "plaintext_posix.h"
+    typedef PlaintextParams_t TransportBindingParams_t;
+    #define TRANSPORT_BINDING_CONNECTED( pParams )    ( true )
+    #define TRANSPORT_BINDING_RECV                    Plaintext_Recv
+    #define TRANSPORT_BINDING_SEND                    Plaintext_Send
+#else
+    #error "Please define TRANSPORT_BINDING as either TRANSPORT_BINDING_OPENSSL or TRANSPORT_BINDING_PLAINTEXT."
+#endif
+
+/**
+ * @brief Qualifiers of the functions bound.
+ *
+ * inline is not a keyword of C90, but GCC and Clang take __inline__ in all
+ * modes.
+ */
+#if defined( __GNUC__ )
+    #define TRANSPORT_BINDING_INLINE    static __inline__
+#else
+    #define TRANSPORT_BINDING_INLINE    static
+#endif
+
+/**
+ * @brief Receive data from the transport bound, serving it from its
+ * read-ahead buffer when the buffer holds some.
+ *
+ * Returns what the receive function of the transport does, including the
+ * short reads of the data that is buffered.
+ *
+ * @param[in] pNetworkContext The network context of the connection. Must not
+ * be NULL.
+ * @param[out] pBuffer Buffer to receive the data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes received if successful; negative value on failure;
+ * zero if the receive can be retried.
+ */
+TRANSPORT_BINDING_INLINE int32_t TransportBinding_Recv( NetworkContext_t * pNetworkContext,
+                                                        void * pBuffer,
+                                                        size_t bytesToRecv )
+{
+    TransportBindingParams_t * pParams = pNetworkContext->pParams;
+    int32_t bytesReceived = 0;
+    size_t bytesToCopy = 0U;
+
+    #if ( TRANSPORT_STATS_ENABLED == 0 )
+        bool buffered = ( pParams->recvBufferLength > 0U ) && TRANSPORT_BINDING_CONNECTED( pParams );
+    #else
+        bool buffered = false;
+    #endif
+
+    if( buffered == true )
+    {
+        bytesToCopy = ( bytesToRecv < pParams->recvBufferLength ) ?
+                      bytesToRecv : pParams->recvBufferLength;
+
+        ( void ) memcpy( pBuffer,
+                         &( pParams->pRecvBuffer[ pParams->recvBufferHead ] ),
+                         bytesToCopy );
+
+        pParams->recvBufferHead += bytesToCopy;
+        pParams->recvBufferLength -= bytesToCopy;
+        bytesReceived = ( int32_t ) bytesToCopy;
+    }
+    else
+    {
+        bytesReceived = TRANSPORT_BINDING_RECV( pNetworkContext, pBuffer, bytesToRecv );
+    }
+
+    return bytesReceived;
+}
+
+/**
+ * @brief Send data with the transport bound.
+ *
+ * @param[in] pNetworkContext The network context of the connection.
+ * @param[in] pBuffer Buffer of the data to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return Number of bytes sent if successful; negative value on failure.
+ */
+TRANSPORT_BINDING_INLINE int32_t TransportBinding_Send( NetworkContext_t * pNetworkContext,
+                                                        const void * pBuffer,
+                                                        size_t bytesToSend )
+{
+    return TRANSPORT_BINDING_SEND( pNetworkContext, pBuffer, bytesToSend );
+}
+
+#endif /* ifndef TRANSPORT_BINDING_POSIX_H_ */
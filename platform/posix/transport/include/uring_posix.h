@@ -0,0 +1,299 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef URING_POSIX_H_
+#define URING_POSIX_H_
+
+/**************************************************/
+/******* DO NOT CHANGE the following order ********/
+/**************************************************/
+
+/* Logging related header files are required to be included in the following order:
+ * 1. Include the header file "logging_levels.h".
+ * 2. Define LIBRARY_LOG_NAME and  LIBRARY_LOG_LEVEL.
+ * 3. Include the header file "logging_stack.h".
+ */
+
+/* Include header that defines log levels. */
+#include "logging_levels.h"
+
+/* Logging configuration for the transport interface implementation which uses
+ * io_uring. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME     "Transport_Uring_Sockets"
+#endif
+#ifndef LIBRARY_LOG_LEVEL
+    #define LIBRARY_LOG_LEVEL    LOG_DEBUG
+#endif
+
+#include "logging_stack.h"
+
+/************ End of logging configuration ****************/
+
+/* POSIX include for struct iovec. */
+#include <sys/uio.h>
+
+/* Linux include for the io_uring structures. */
+#include <linux/io_uring.h>
+
+/* Transport includes. */
+#include "transport_interface.h"
+#include "sockets_posix.h"
+
+/**
+ * @brief Number of entries of the submission queue of each connection.
+ *
+ * A send or receive queues at most two entries: the operation itself and the
+ * timeout linked to it.
+ */
+#ifndef URING_QUEUE_DEPTH
+    #define URING_QUEUE_DEPTH    ( 4U )
+#endif
+
+/**
+ * @brief Time in milliseconds after which the kernel thread polling the
+ * submission queue goes to sleep when #UringParams_t.pollCompletions is set.
+ *
+ * The next send or receive after that wakes it up with a system call.
+ */
+#ifndef URING_SQ_THREAD_IDLE_MS
+    #define URING_SQ_THREAD_IDLE_MS    ( 1000U )
+#endif
+
+/**
+ * @brief Number of times the completion queue is checked before waiting for
+ * a completion with a system call when #UringParams_t.pollCompletions is set.
+ */
+#ifndef URING_POLL_SPIN_COUNT
+    #define URING_POLL_SPIN_COUNT    ( 10000U )
+#endif
+
+/**
+ * @brief State of the io_uring instance of a connection, set up by
+ * #Uring_Connect. The application must not modify it.
+ */
+typedef struct UringRing
+{
+    int32_t ringDescriptor;                   /**< @brief File descriptor of the io_uring instance. */
+
+    void * pSubmissionRing;                   /**< @brief Mapping of the submission queue ring. */
+    size_t submissionRingSize;                /**< @brief Size of #UringRing_t.pSubmissionRing. */
+    void * pCompletionRing;                   /**< @brief Mapping of the completion queue ring. */
+    size_t completionRingSize;                /**< @brief Size of #UringRing_t.pCompletionRing. */
+    struct io_uring_sqe * pSubmissionEntries; /**< @brief Mapping of the submission queue entries. */
+    size_t submissionEntriesSize;             /**< @brief Size of #UringRing_t.pSubmissionEntries. */
+
+    uint32_t * pSubmissionTail;               /**< @brief Tail of the submission queue, shared with the kernel. */
+    uint32_t * pSubmissionFlags;              /**< @brief Flags of the submission queue set by the kernel. */
+    uint32_t * pSubmissionArray;              /**< @brief Indices of the queued submission entries. */
+    uint32_t submissionMask;                  /**< @brief Mask to get an index from a position in the submission queue. */
+    uint32_t submissionTail;                  /**< @brief Tail of the entries queued but not yet published to the kernel. */
+
+    uint32_t * pCompletionHead;               /**< @brief Head of the completion queue, shared with the kernel. */
+    uint32_t * pCompletionTail;               /**< @brief Tail of the completion queue, shared with the kernel. */
+    struct io_uring_cqe * pCompletionEntries; /**< @brief Entries of the completion queue. */
+    uint32_t completionMask;                  /**< @brief Mask to get an index from a position in the completion queue. */
+
+    uint16_t recvBufferIndex;                 /**< @brief Index of the registered #UringParams_t.pRecvBuffer. */
+    uint16_t sendBufferIndex;                 /**< @brief Index of the registered #UringParams_t.pSendBuffer. */
+} UringRing_t;
+
+/**
+ * @brief Parameters for the transport-interface
+ * implementation that uses io_uring on Linux.
+ *
+ * The fields up to #UringParams_t.sendBufferSize are set by the application
+ * before calling #Uring_Connect. The others are set by the transport.
+ */
+typedef struct UringParams
+{
+    /**
+     * @brief Set to 1 to have a kernel thread poll the submission queue, so
+     * that sends and receives are submitted without a system call, and to
+     * check the completion queue #URING_POLL_SPIN_COUNT times before waiting
+     * for a completion with a system call.
+     *
+     * This trades a kernel thread spinning for up to #URING_SQ_THREAD_IDLE_MS
+     * after each operation for lower latency.
+     */
+    uint8_t pollCompletions;
+
+    /**
+     * @brief Optional read-ahead buffer, registered with the kernel by
+     * #Uring_Connect. Set to NULL to disable read-ahead.
+     *
+     * When set, #Uring_Recv fills this buffer with as much data as the socket
+     * has available and serves small reads, such as the single-byte reads
+     * coreMQTT makes for the packet header, from memory.
+     */
+    uint8_t * pRecvBuffer;
+
+    /**
+     * @brief Size of #UringParams_t.pRecvBuffer in bytes.
+     */
+    size_t recvBufferSize;
+
+    /**
+     * @brief Optional send buffer, registered with the kernel by
+     * #Uring_Connect. Set to NULL to send directly from the buffers of the
+     * application.
+     *
+     * When set, #Uring_Send copies sends that fit in it to this buffer, which
+     * the kernel does not have to map for each send.
+     */
+    uint8_t * pSendBuffer;
+
+    /**
+     * @brief Size of #UringParams_t.pSendBuffer in bytes.
+     */
+    size_t sendBufferSize;
+
+    int32_t socketDescriptor; /**< @brief Socket of the connection. */
+    uint32_t recvTimeoutMs;   /**< @brief Receive timeout cached by #Uring_Connect. */
+    uint32_t sendTimeoutMs;   /**< @brief Send timeout cached by #Uring_Connect. */
+    size_t recvBufferHead;    /**< @brief Offset of the first unread byte in #UringParams_t.pRecvBuffer. */
+    size_t recvBufferLength;  /**< @brief Number of unread bytes in #UringParams_t.pRecvBuffer. */
+    UringRing_t ring;         /**< @brief io_uring instance of the connection. */
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+
+        /**
+         * @brief Statistics of the connection, reset by #Uring_Connect.
+         * Read them with #Uring_GetStats.
+         */
+        TransportStats_t stats;
+    #endif
+} UringParams_t;
+
+/**
+ * @brief Establish TCP connection to server, and set up the io_uring instance
+ * used to send and receive over it.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] sendTimeoutMs Timeout for socket send.
+ * @param[in] recvTimeoutMs Timeout for socket recv.
+ *
+ * @note A timeout of 0 means infinite timeout.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_API_ERROR if the io_uring
+ * instance could not be set up, for example because the kernel does not
+ * support it; #SOCKETS_INVALID_PARAMETER, #SOCKETS_DNS_FAILURE,
+ * #SOCKETS_CONNECT_FAILURE on error.
+ */
+SocketStatus_t Uring_Connect( NetworkContext_t * pNetworkContext,
+                              const ServerInfo_t * pServerInfo,
+                              uint32_t sendTimeoutMs,
+                              uint32_t recvTimeoutMs );
+
+/**
+ * @brief Close TCP connection to server, and tear down its io_uring instance.
+ *
+ * @param[in] pNetworkContext The network context to close the connection.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER on error.
+ */
+SocketStatus_t Uring_Disconnect( const NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Receives data over an established TCP connection.
+ *
+ * This can be used as #TransportInterface.recv function to receive data over
+ * the network, in place of #Plaintext_Recv.
+ *
+ * @param[in] pNetworkContext The network context created using Uring_Connect API.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested from the network.
+ *
+ * @note The receive and a timeout linked to it are submitted together, so
+ * waiting for data takes a single system call, or none when
+ * #UringParams_t.pollCompletions is set.
+ *
+ * @note If a read-ahead buffer is configured in #UringParams_t, fewer bytes
+ * than requested may be returned when only part of the request is buffered.
+ *
+ * @return Number of bytes received if successful; 0 if no data was available
+ * before the receive timeout expired; negative value on error.
+ */
+int32_t Uring_Recv( NetworkContext_t * pNetworkContext,
+                    void * pBuffer,
+                    size_t bytesToRecv );
+
+/**
+ * @brief Sends data over an established TCP connection.
+ *
+ * This can be used as the #TransportInterface.send function to send data
+ * over the network, in place of #Plaintext_Send.
+ *
+ * @param[in] pNetworkContext The network context created using Uring_Connect API.
+ * @param[in] pBuffer Buffer containing the bytes to send over the network.
+ * @param[in] bytesToSend Number of bytes to send over the network.
+ *
+ * @return Number of bytes sent if successful; 0 if the socket did not become
+ * writable before the send timeout expired; negative value on error.
+ */
+int32_t Uring_Send( NetworkContext_t * pNetworkContext,
+                    const void * pBuffer,
+                    size_t bytesToSend );
+
+/**
+ * @brief Sends data from multiple buffers over an established TCP connection
+ * with a single operation, like #Plaintext_Writev.
+ *
+ * @param[in] pNetworkContext The network context created using Uring_Connect API.
+ * @param[in] pIoVec Array of buffers to send, in order.
+ * @param[in] ioVecCount Number of entries in @p pIoVec.
+ *
+ * @return Total number of bytes sent if successful, which may be fewer than
+ * the total length of all buffers; 0 if the socket did not become writable
+ * before the send timeout expired; negative value on error.
+ */
+int32_t Uring_Writev( NetworkContext_t * pNetworkContext,
+                      const struct iovec * pIoVec,
+                      size_t ioVecCount );
+
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+
+/**
+ * @brief Takes a snapshot of the statistics of a connection.
+ *
+ * @param[in] pNetworkContext The network context created using Uring_Connect API.
+ * @param[out] pStats Buffer to copy the statistics to.
+ *
+ * @note #TransportStats_t.ioCalls counts the io_uring_enter system calls.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER on error.
+ */
+    SocketStatus_t Uring_GetStats( const NetworkContext_t * pNetworkContext,
+                                   TransportStats_t * pStats );
+
+/**
+ * @brief Resets the statistics of a connection.
+ *
+ * @param[in] pNetworkContext The network context created using Uring_Connect API.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_INVALID_PARAMETER on error.
+ */
+    SocketStatus_t Uring_ResetStats( NetworkContext_t * pNetworkContext );
+#endif /* if ( TRANSPORT_STATS_ENABLED == 1 ) */
+
+#endif /* ifndef URING_POSIX_H_ */
@@ -0,0 +1,83 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file uring_syscalls_posix.h
+ * @brief Wrappers of the io_uring system calls, for which the C library has
+ * no functions.
+ */
+
+#ifndef URING_SYSCALLS_POSIX_H_
+#define URING_SYSCALLS_POSIX_H_
+
+/* Standard includes. */
+#include <stdint.h>
+
+/* Linux include for the io_uring structures. */
+#include <linux/io_uring.h>
+
+/**
+ * @brief Create an io_uring instance with the io_uring_setup system call.
+ *
+ * @param[in] entries Requested number of submission queue entries.
+ * @param[in,out] pParams Setup flags on input; offsets of the rings on output.
+ *
+ * @return File descriptor of the instance if successful; -1 with errno set on
+ * error.
+ */
+int32_t UringSyscall_Setup( uint32_t entries,
+                            struct io_uring_params * pParams );
+
+/**
+ * @brief Submit queued entries and wait for completions with the
+ * io_uring_enter system call.
+ *
+ * @param[in] ringDescriptor File descriptor of the io_uring instance.
+ * @param[in] toSubmit Number of queued entries to submit.
+ * @param[in] minComplete Number of completions to wait for.
+ * @param[in] flags IORING_ENTER_* flags.
+ *
+ * @return Number of entries submitted if successful; -1 with errno set on
+ * error.
+ */
+int32_t UringSyscall_Enter( int32_t ringDescriptor,
+                            uint32_t toSubmit,
+                            uint32_t minComplete,
+                            uint32_t flags );
+
+/**
+ * @brief Register resources with an io_uring instance with the
+ * io_uring_register system call.
+ *
+ * @param[in] ringDescriptor File descriptor of the io_uring instance.
+ * @param[in] opcode IORING_REGISTER_* operation.
+ * @param[in] pArg Argument of the operation.
+ * @param[in] argCount Number of elements in @p pArg.
+ *
+ * @return 0 or a positive value if successful; -1 with errno set on error.
+ */
+int32_t UringSyscall_Register( int32_t ringDescriptor,
+                               uint32_t opcode,
+                               const void * pArg,
+                               uint32_t argCount );
+
+#endif /* ifndef URING_SYSCALLS_POSIX_H_ */
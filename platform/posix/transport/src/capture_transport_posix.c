@@ -0,0 +1,293 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "capture_transport_posix.h"
+
+/* Clock of the times of the records. */
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Largest length of the header of a record: two LEB128 numbers of up
+ * to 64 bits.
+ */
+#define RECORD_HEADER_MAX_LENGTH    ( 20U )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    CaptureTransportParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Encode a number as unsigned LEB128.
+ *
+ * @param[in] value The number.
+ * @param[out] pBuffer Buffer receiving the encoding, of at least 10 bytes.
+ *
+ * @return Length of the encoding.
+ */
+static size_t encodeNumber( uint64_t value,
+                            uint8_t * pBuffer );
+
+/**
+ * @brief Write a record of the bytes moved by a send or a receive.
+ *
+ * @param[in] pCaptureParams The capture.
+ * @param[in] direction #CAPTURE_TRANSPORT_SEND or #CAPTURE_TRANSPORT_RECV.
+ * @param[in] pData The bytes moved.
+ * @param[in] length Number of bytes moved.
+ */
+static void writeRecord( CaptureTransportParams_t * pCaptureParams,
+                         uint32_t direction,
+                         const void * pData,
+                         size_t length );
+
+/**
+ * @brief Check the network context of a send or receive.
+ *
+ * @param[in] pNetworkContext The network context.
+ *
+ * @return true if it wraps a transport; false otherwise.
+ */
+static bool isStarted( const NetworkContext_t * pNetworkContext );
+
+/*-----------------------------------------------------------*/
+
+static size_t encodeNumber( uint64_t value,
+                            uint8_t * pBuffer )
+{
+    uint64_t remaining = value;
+    size_t length = 0U;
+
+    while( remaining >= 0x80U )
+    {
+        pBuffer[ length ] = ( uint8_t ) ( ( remaining & 0x7FU ) | 0x80U );
+        remaining >>= 7;
+        length++;
+    }
+
+    pBuffer[ length ] = ( uint8_t ) remaining;
+    length++;
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+static void writeRecord( CaptureTransportParams_t * pCaptureParams,
+                         uint32_t direction,
+                         const void * pData,
+                         size_t length )
+{
+    uint8_t header[ RECORD_HEADER_MAX_LENGTH ];
+    size_t headerLength = 0U;
+    uint64_t nowUs = 0U;
+    FILE * pFile = __atomic_load_n( &pCaptureParams->pFile, __ATOMIC_ACQUIRE );
+
+    if( pFile != NULL )
+    {
+        /* The time is read with the stream locked, so that the records of the
+         * sending and the receiving threads are written in the order of their
+         * times. */
+        flockfile( pFile );
+
+        /* The capture may have been stopped while the stream was locked by
+         * #CaptureTransport_Stop. */
+        if( ( pCaptureParams->failed == false ) &&
+            ( __atomic_load_n( &pCaptureParams->pFile, __ATOMIC_RELAXED ) == pFile ) )
+        {
+            nowUs = Clock_GetTimeUs();
+            headerLength = encodeNumber( nowUs - pCaptureParams->lastTimeUs, header );
+            headerLength += encodeNumber( ( ( uint64_t ) length << 1 ) | direction, &header[ headerLength ] );
+            pCaptureParams->lastTimeUs = nowUs;
+
+            if( ( fwrite( header, 1U, headerLength, pFile ) != headerLength ) ||
+                ( fwrite( pData, 1U, length, pFile ) != length ) )
+            {
+                /* The capture stops rather than the connection, as a record
+                 * partly written leaves the rest of the file unreadable. */
+                LogError( ( "Failed to write a record of %lu bytes to the capture. "
+                            "The rest of the connection is not captured.",
+                            ( unsigned long ) length ) );
+                pCaptureParams->failed = true;
+            }
+        }
+
+        funlockfile( pFile );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isStarted( const NetworkContext_t * pNetworkContext )
+{
+    return ( pNetworkContext != NULL ) &&
+           ( pNetworkContext->pParams != NULL ) &&
+           ( pNetworkContext->pParams->transport.recv != NULL ) &&
+           ( pNetworkContext->pParams->transport.send != NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+CaptureTransportStatus_t CaptureTransport_Start( NetworkContext_t * pNetworkContext,
+                                                 const TransportInterface_t * pTransport,
+                                                 FILE * pFile )
+{
+    CaptureTransportStatus_t returnStatus = CAPTURE_TRANSPORT_SUCCESS;
+    CaptureTransportParams_t * pCaptureParams = NULL;
+    uint8_t header[ CAPTURE_TRANSPORT_HEADER_LENGTH ];
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) ||
+        ( pTransport == NULL ) || ( pTransport->recv == NULL ) || ( pTransport->send == NULL ) ||
+        ( pFile == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext, its parameters, pTransport, its functions "
+                    "and pFile must not be NULL." ) );
+        returnStatus = CAPTURE_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memcpy( header, CAPTURE_TRANSPORT_MAGIC, CAPTURE_TRANSPORT_MAGIC_LENGTH );
+        header[ CAPTURE_TRANSPORT_MAGIC_LENGTH ] = ( uint8_t ) CAPTURE_TRANSPORT_VERSION;
+
+        if( fwrite( header, 1U, sizeof( header ), pFile ) != sizeof( header ) )
+        {
+            LogError( ( "Failed to write the header of the capture." ) );
+            returnStatus = CAPTURE_TRANSPORT_WRITE_FAILURE;
+        }
+    }
+
+    if( returnStatus == CAPTURE_TRANSPORT_SUCCESS )
+    {
+        pCaptureParams = pNetworkContext->pParams;
+        pCaptureParams->transport = *pTransport;
+        pCaptureParams->lastTimeUs = Clock_GetTimeUs();
+        pCaptureParams->failed = false;
+        __atomic_store_n( &pCaptureParams->pFile, pFile, __ATOMIC_RELEASE );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+CaptureTransportStatus_t CaptureTransport_Stop( NetworkContext_t * pNetworkContext )
+{
+    CaptureTransportStatus_t returnStatus = CAPTURE_TRANSPORT_SUCCESS;
+    CaptureTransportParams_t * pCaptureParams = NULL;
+    FILE * pFile = NULL;
+
+    if( ( isStarted( pNetworkContext ) == false ) || ( pNetworkContext->pParams->pFile == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is not capturing." ) );
+        returnStatus = CAPTURE_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        pCaptureParams = pNetworkContext->pParams;
+        pFile = pCaptureParams->pFile;
+
+        /* A record being written by another thread is completed before the
+         * stream is released. */
+        flockfile( pFile );
+        __atomic_store_n( &pCaptureParams->pFile, NULL, __ATOMIC_RELEASE );
+
+        if( ( fflush( pFile ) != 0 ) || ( pCaptureParams->failed == true ) )
+        {
+            LogError( ( "The capture was not written whole." ) );
+            returnStatus = CAPTURE_TRANSPORT_WRITE_FAILURE;
+        }
+
+        funlockfile( pFile );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t CaptureTransport_Recv( NetworkContext_t * pNetworkContext,
+                               void * pBuffer,
+                               size_t bytesToRecv )
+{
+    int32_t bytesReceived = -1;
+    CaptureTransportParams_t * pCaptureParams = NULL;
+
+    if( isStarted( pNetworkContext ) == false )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext does not wrap a transport." ) );
+    }
+    else
+    {
+        pCaptureParams = pNetworkContext->pParams;
+        bytesReceived = pCaptureParams->transport.recv( pCaptureParams->transport.pNetworkContext,
+                                                        pBuffer,
+                                                        bytesToRecv );
+
+        if( bytesReceived > 0 )
+        {
+            writeRecord( pCaptureParams, CAPTURE_TRANSPORT_RECV, pBuffer, ( size_t ) bytesReceived );
+        }
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t CaptureTransport_Send( NetworkContext_t * pNetworkContext,
+                               const void * pBuffer,
+                               size_t bytesToSend )
+{
+    int32_t bytesSent = -1;
+    CaptureTransportParams_t * pCaptureParams = NULL;
+
+    if( isStarted( pNetworkContext ) == false )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext does not wrap a transport." ) );
+    }
+    else
+    {
+        pCaptureParams = pNetworkContext->pParams;
+        bytesSent = pCaptureParams->transport.send( pCaptureParams->transport.pNetworkContext,
+                                                    pBuffer,
+                                                    bytesToSend );
+
+        if( bytesSent > 0 )
+        {
+            writeRecord( pCaptureParams, CAPTURE_TRANSPORT_SEND, pBuffer, ( size_t ) bytesSent );
+        }
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
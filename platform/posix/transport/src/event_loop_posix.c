@@ -0,0 +1,438 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/* Platform clock include. */
+#include "clock.h"
+
+#include "event_loop_posix.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Called by the timer wheel when the deadline of a connection is due.
+ *
+ * @param[in] pTimer #EventLoopConnection_t.deadline of the connection.
+ */
+static void deadlineCallback( TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Get the number of ticks of the timer wheel elapsed since the current
+ * tick of the wheel started.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[out] pRemainderMs Time elapsed since the start of the last tick
+ * elapsed. May be NULL.
+ *
+ * @return Number of ticks elapsed.
+ */
+static uint32_t getElapsedTicks( const EventLoop_t * pEventLoop,
+                                 uint32_t * pRemainderMs );
+
+/**
+ * @brief Get the time to wait in #EventLoop_Dispatch, which ends when the
+ * next deadline or timer is due.
+ *
+ * @param[in] pEventLoop The event loop.
+ * @param[in] maxWaitMs Longest time to wait.
+ *
+ * @return Time to wait in milliseconds.
+ */
+static uint32_t getWaitTimeMs( const EventLoop_t * pEventLoop,
+                               uint32_t maxWaitMs );
+
+/*-----------------------------------------------------------*/
+
+static void deadlineCallback( TimerWheelTimer_t * pTimer )
+{
+    EventLoopConnection_t * pConnection = NULL;
+
+    assert( pTimer != NULL );
+
+    pConnection = ( EventLoopConnection_t * ) pTimer->pUserContext;
+    pConnection->callback( pConnection, EVENT_LOOP_EVENT_DEADLINE );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t getElapsedTicks( const EventLoop_t * pEventLoop,
+                                 uint32_t * pRemainderMs )
+{
+    uint32_t elapsedMs = 0U;
+
+    assert( pEventLoop != NULL );
+
+    elapsedMs = Clock_GetTimeMs() - pEventLoop->currentTickTimeMs;
+
+    if( pRemainderMs != NULL )
+    {
+        *pRemainderMs = elapsedMs % EVENT_LOOP_TIMER_TICK_MS;
+    }
+
+    return elapsedMs / EVENT_LOOP_TIMER_TICK_MS;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t getWaitTimeMs( const EventLoop_t * pEventLoop,
+                               uint32_t maxWaitMs )
+{
+    uint32_t waitMs = maxWaitMs, nextTicks = 0U, elapsedTicks = 0U, remainderMs = 0U;
+    uint64_t dueMs = 0U;
+
+    assert( pEventLoop != NULL );
+
+    nextTicks = TimerWheel_GetNextTimeout( &pEventLoop->timerWheel );
+
+    if( nextTicks != TIMER_WHEEL_NO_TIMEOUT )
+    {
+        elapsedTicks = getElapsedTicks( pEventLoop, &remainderMs );
+
+        if( elapsedTicks >= nextTicks )
+        {
+            waitMs = 0U;
+        }
+        else
+        {
+            dueMs = ( ( uint64_t ) ( nextTicks - elapsedTicks ) * EVENT_LOOP_TIMER_TICK_MS ) - remainderMs;
+
+            if( dueMs < ( uint64_t ) waitMs )
+            {
+                waitMs = ( uint32_t ) dueMs;
+            }
+        }
+    }
+
+    return waitMs;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Init( EventLoop_t * pEventLoop )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+
+    if( pEventLoop == NULL )
+    {
+        LogError( ( "Parameter check failed: pEventLoop is NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pEventLoop, 0, sizeof( EventLoop_t ) );
+        TimerWheel_Init( &pEventLoop->timerWheel, 0U );
+        pEventLoop->currentTickTimeMs = Clock_GetTimeMs();
+        pEventLoop->epollDescriptor = epoll_create1( EPOLL_CLOEXEC );
+
+        if( pEventLoop->epollDescriptor < 0 )
+        {
+            LogError( ( "Creating the epoll instance failed: %s.", strerror( errno ) ) );
+            returnStatus = EVENT_LOOP_API_ERROR;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Deinit( EventLoop_t * pEventLoop )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+
+    if( pEventLoop == NULL )
+    {
+        LogError( ( "Parameter check failed: pEventLoop is NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        if( pEventLoop->epollDescriptor >= 0 )
+        {
+            ( void ) close( pEventLoop->epollDescriptor );
+        }
+
+        pEventLoop->epollDescriptor = -1;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Add( EventLoop_t * pEventLoop,
+                                 EventLoopConnection_t * pConnection )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    struct epoll_event event;
+
+    if( ( pEventLoop == NULL ) || ( pConnection == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop and pConnection must not be NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else if( ( pConnection->fileDescriptor < 0 ) || ( pConnection->callback == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pConnection must have a socket and a callback." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( &pConnection->deadline, 0, sizeof( pConnection->deadline ) );
+        pConnection->deadline.callback = deadlineCallback;
+        pConnection->deadline.pUserContext = pConnection;
+
+        ( void ) memset( &event, 0, sizeof( event ) );
+        event.events = ( uint32_t ) EPOLLIN | ( uint32_t ) EPOLLRDHUP;
+        event.data.ptr = pConnection;
+
+        if( epoll_ctl( pEventLoop->epollDescriptor,
+                       EPOLL_CTL_ADD,
+                       pConnection->fileDescriptor,
+                       &event ) != 0 )
+        {
+            LogError( ( "Registering socket %d failed: %s.",
+                        ( int ) pConnection->fileDescriptor,
+                        strerror( errno ) ) );
+            returnStatus = EVENT_LOOP_API_ERROR;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Remove( EventLoop_t * pEventLoop,
+                                    EventLoopConnection_t * pConnection )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    size_t i = 0U;
+
+    if( ( pEventLoop == NULL ) || ( pConnection == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop and pConnection must not be NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) EventLoop_CancelDeadline( pEventLoop, pConnection );
+
+        /* Drop the events of the connection that are still to be
+         * dispatched. */
+        for( i = 0U; i < pEventLoop->eventCount; i++ )
+        {
+            if( pEventLoop->events[ i ].data.ptr == pConnection )
+            {
+                pEventLoop->events[ i ].data.ptr = NULL;
+            }
+        }
+
+        if( epoll_ctl( pEventLoop->epollDescriptor,
+                       EPOLL_CTL_DEL,
+                       pConnection->fileDescriptor,
+                       NULL ) != 0 )
+        {
+            LogError( ( "Unregistering socket %d failed: %s.",
+                        ( int ) pConnection->fileDescriptor,
+                        strerror( errno ) ) );
+            returnStatus = EVENT_LOOP_API_ERROR;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_SetDeadline( EventLoop_t * pEventLoop,
+                                         EventLoopConnection_t * pConnection,
+                                         uint32_t timeoutMs )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+
+    if( ( pEventLoop == NULL ) || ( pConnection == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop and pConnection must not be NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        returnStatus = EventLoop_StartTimer( pEventLoop, &pConnection->deadline, timeoutMs );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_CancelDeadline( EventLoop_t * pEventLoop,
+                                            EventLoopConnection_t * pConnection )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+
+    if( ( pEventLoop == NULL ) || ( pConnection == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop and pConnection must not be NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        returnStatus = EventLoop_CancelTimer( pEventLoop, &pConnection->deadline );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_StartTimer( EventLoop_t * pEventLoop,
+                                        TimerWheelTimer_t * pTimer,
+                                        uint32_t timeoutMs )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    uint32_t offsetMs = 0U;
+
+    if( ( pEventLoop == NULL ) || ( pTimer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop and pTimer must not be NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else if( pTimer->callback == NULL )
+    {
+        LogError( ( "Parameter check failed: pTimer must have a callback." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Count from the start of the current tick, rounding up so that the
+         * timer is never reported early. */
+        offsetMs = ( Clock_GetTimeMs() - pEventLoop->currentTickTimeMs ) + timeoutMs;
+        TimerWheel_Start( &pEventLoop->timerWheel,
+                          pTimer,
+                          ( offsetMs / EVENT_LOOP_TIMER_TICK_MS ) +
+                          ( ( ( offsetMs % EVENT_LOOP_TIMER_TICK_MS ) != 0U ) ? 1U : 0U ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_CancelTimer( EventLoop_t * pEventLoop,
+                                         TimerWheelTimer_t * pTimer )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+
+    if( ( pEventLoop == NULL ) || ( pTimer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEventLoop and pTimer must not be NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        TimerWheel_Cancel( &pEventLoop->timerWheel, pTimer );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+EventLoopStatus_t EventLoop_Dispatch( EventLoop_t * pEventLoop,
+                                      uint32_t maxWaitMs,
+                                      size_t * pDispatchedCount )
+{
+    EventLoopStatus_t returnStatus = EVENT_LOOP_SUCCESS;
+    EventLoopConnection_t * pConnection = NULL;
+    uint32_t waitMs = 0U, elapsedTicks = 0U, events = 0U;
+    int32_t readyCount = 0;
+    size_t dispatchedCount = 0U, i = 0U;
+
+    if( pEventLoop == NULL )
+    {
+        LogError( ( "Parameter check failed: pEventLoop is NULL." ) );
+        returnStatus = EVENT_LOOP_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Wake up only when the next deadline or timer is due. */
+        waitMs = getWaitTimeMs( pEventLoop, maxWaitMs );
+
+        readyCount = epoll_wait( pEventLoop->epollDescriptor,
+                                 pEventLoop->events,
+                                 ( int ) EVENT_LOOP_MAX_EVENTS,
+                                 ( waitMs > ( uint32_t ) INT_MAX ) ? INT_MAX : ( int ) waitMs );
+
+        if( ( readyCount < 0 ) && ( errno != EINTR ) )
+        {
+            LogError( ( "Waiting for events failed: %s.", strerror( errno ) ) );
+            returnStatus = EVENT_LOOP_API_ERROR;
+        }
+        else if( readyCount > 0 )
+        {
+            pEventLoop->eventCount = ( size_t ) readyCount;
+        }
+        else
+        {
+            /* Interrupted by a signal or timed out. */
+        }
+
+        for( i = 0U; i < pEventLoop->eventCount; i++ )
+        {
+            /* Cleared if the connection was removed by a callback. */
+            pConnection = ( EventLoopConnection_t * ) pEventLoop->events[ i ].data.ptr;
+
+            if( pConnection != NULL )
+            {
+                events = ( ( pEventLoop->events[ i ].events & ( uint32_t ) EPOLLIN ) != 0U ) ?
+                         EVENT_LOOP_EVENT_READABLE : 0U;
+
+                if( ( pEventLoop->events[ i ].events &
+                      ( ( uint32_t ) EPOLLHUP | ( uint32_t ) EPOLLERR | ( uint32_t ) EPOLLRDHUP ) ) != 0U )
+                {
+                    events |= EVENT_LOOP_EVENT_HANGUP;
+                }
+
+                pConnection->callback( pConnection, events );
+                dispatchedCount++;
+            }
+        }
+
+        pEventLoop->eventCount = 0U;
+    }
+
+    /* Without timers, this only keeps the wheel at the current time. */
+    if( returnStatus == EVENT_LOOP_SUCCESS )
+    {
+        elapsedTicks = getElapsedTicks( pEventLoop, NULL );
+        pEventLoop->currentTickTimeMs += elapsedTicks * EVENT_LOOP_TIMER_TICK_MS;
+        dispatchedCount += TimerWheel_Advance( &pEventLoop->timerWheel,
+                                               pEventLoop->timerWheel.currentTick + elapsedTicks );
+    }
+
+    if( pDispatchedCount != NULL )
+    {
+        *pDispatchedCount = dispatchedCount;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,1086 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* POSIX socket includes. */
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+/* Transport interface include. */
+#include "transport_interface.h"
+
+#include "mbedtls_posix.h"
+
+/* mbedTLS includes. */
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+
+/* Trace probes of the handshake. */
+#include "trace_probes.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Personalization string of the random number generator shared by
+ * all connections.
+ */
+#define RNG_PERSONALIZATION    "mbedtls_posix"
+
+/* The server must be able to send a record of the default maximum fragment
+ * length in one piece. */
+#if ( MBEDTLS_POSIX_DEFAULT_MAX_FRAGMENT_LENGTH > MBEDTLS_SSL_IN_CONTENT_LEN )
+    #error "MBEDTLS_POSIX_DEFAULT_MAX_FRAGMENT_LENGTH must not exceed MBEDTLS_SSL_IN_CONTENT_LEN."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    MbedtlsParams_t * pParams;
+};
+
+/**
+ * @brief A TLS session kept by the session cache, along with the SNI host
+ * name it was established with.
+ */
+typedef struct SessionCacheEntry
+{
+    char hostName[ MBEDTLS_POSIX_MAX_HOST_NAME_LENGTH + 1U ]; /**< @brief SNI host name of the session. */
+    mbedtls_ssl_session session;                              /**< @brief The cached session, with its ticket. */
+    bool inUse;                                               /**< @brief Whether the entry holds a session. */
+} SessionCacheEntry_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief TLS sessions that are offered by #Mbedtls_Connect when
+ * #MbedtlsCredentials_t.cacheSession is set.
+ */
+static SessionCacheEntry_t sessionCache[ MBEDTLS_POSIX_SESSION_CACHE_SIZE ];
+
+/**
+ * @brief Mutex protecting #sessionCache.
+ */
+static pthread_mutex_t sessionCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Entropy source and random number generator shared by all
+ * connections, so that each connection does not keep and seed its own.
+ *
+ * The generator locks its own mutex when MBEDTLS_THREADING_C is enabled.
+ */
+static mbedtls_entropy_context entropyContext;
+static mbedtls_ctr_drbg_context ctrDrbgContext; /**< @brief See #entropyContext. */
+
+/**
+ * @brief Seeds #ctrDrbgContext on the first connection.
+ */
+static pthread_once_t rngOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Status of seeding #ctrDrbgContext; 0 once it is seeded.
+ */
+static int rngStatus = -1;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Seed the random number generator shared by all connections.
+ */
+static void seedRng( void );
+
+/**
+ * @brief Send data to the socket of a connection, as the send callback of
+ * mbedTLS.
+ *
+ * @param[in] pContext Pointer to #MbedtlsParams_t.socketDescriptor.
+ * @param[in] pBuffer Data to send.
+ * @param[in] length Length of pBuffer.
+ *
+ * @return Number of bytes sent; MBEDTLS_ERR_SSL_TIMEOUT if the send timeout
+ * expired; MBEDTLS_ERR_SSL_WANT_WRITE if a signal interrupted it;
+ * MBEDTLS_ERR_NET_SEND_FAILED on failure.
+ */
+static int sendToSocket( void * pContext,
+                         const unsigned char * pBuffer,
+                         size_t length );
+
+/**
+ * @brief Receive data from the socket of a connection, as the receive
+ * callback of mbedTLS.
+ *
+ * @param[in] pContext Pointer to #MbedtlsParams_t.socketDescriptor.
+ * @param[out] pBuffer Buffer to receive data into.
+ * @param[in] length Length of pBuffer.
+ *
+ * @return Number of bytes received; 0 if the server closed the connection;
+ * MBEDTLS_ERR_SSL_TIMEOUT if the receive timeout expired;
+ * MBEDTLS_ERR_SSL_WANT_READ if a signal interrupted it;
+ * MBEDTLS_ERR_NET_RECV_FAILED on failure.
+ */
+static int recvFromSocket( void * pContext,
+                           unsigned char * pBuffer,
+                           size_t length );
+
+/**
+ * @brief Converts the sockets wrapper status to mbedTLS transport status.
+ *
+ * @param[in] socketStatus Sockets wrapper status.
+ *
+ * @return #MBEDTLS_POSIX_SUCCESS, #MBEDTLS_POSIX_INVALID_PARAMETER,
+ * #MBEDTLS_POSIX_DNS_FAILURE, #MBEDTLS_POSIX_CONNECT_FAILURE,
+ * #MBEDTLS_POSIX_INSUFFICIENT_MEMORY or #MBEDTLS_POSIX_API_ERROR.
+ */
+static MbedtlsStatus_t convertToMbedtlsStatus( SocketStatus_t socketStatus );
+
+/**
+ * @brief Initialize the mbedTLS contexts of a connection.
+ *
+ * @param[out] pMbedtlsParams Parameters of the connection.
+ */
+static void initContexts( MbedtlsParams_t * pMbedtlsParams );
+
+/**
+ * @brief Free the mbedTLS contexts of a connection.
+ *
+ * @param[in] pMbedtlsParams Parameters of the connection.
+ */
+static void freeContexts( MbedtlsParams_t * pMbedtlsParams );
+
+/**
+ * @brief Parse the credentials and add them to the TLS configuration.
+ *
+ * @param[in] pMbedtlsParams Parameters of the connection.
+ * @param[in] pMbedtlsCredentials Credentials for the TLS connection.
+ *
+ * @return #MBEDTLS_POSIX_SUCCESS on success;
+ * #MBEDTLS_POSIX_INVALID_CREDENTIALS on failure.
+ */
+static MbedtlsStatus_t setCredentials( MbedtlsParams_t * pMbedtlsParams,
+                                       const MbedtlsCredentials_t * pMbedtlsCredentials );
+
+/**
+ * @brief Set up the TLS configuration of a connection.
+ *
+ * @param[in] pMbedtlsParams Parameters of the connection.
+ * @param[in] pMbedtlsCredentials Credentials for the TLS connection.
+ *
+ * @return #MBEDTLS_POSIX_SUCCESS on success;
+ * #MBEDTLS_POSIX_INVALID_CREDENTIALS or #MBEDTLS_POSIX_API_ERROR on failure.
+ */
+static MbedtlsStatus_t setupSslConfig( MbedtlsParams_t * pMbedtlsParams,
+                                       const MbedtlsCredentials_t * pMbedtlsCredentials );
+
+/**
+ * @brief Get the code of mbedTLS for a maximum fragment length.
+ *
+ * @param[in] maxFragmentLength The maximum fragment length in bytes.
+ *
+ * @return The MBEDTLS_SSL_MAX_FRAG_LEN_* code of the length;
+ * MBEDTLS_SSL_MAX_FRAG_LEN_INVALID if mbedTLS does not support it.
+ */
+static unsigned char getMaxFragmentLengthCode( uint16_t maxFragmentLength );
+
+/**
+ * @brief Set the ALPN protocols, maximum fragment length and SNI host name
+ * of a connection. A failure is logged but does not fail the connection.
+ *
+ * @param[in] pMbedtlsParams Parameters of the connection.
+ * @param[in] pMbedtlsCredentials Credentials for the TLS connection.
+ */
+static void setOptionalConfigurations( MbedtlsParams_t * pMbedtlsParams,
+                                       const MbedtlsCredentials_t * pMbedtlsCredentials );
+
+/**
+ * @brief Find the entry of the session cache of a host.
+ *
+ * @note #sessionCacheMutex must be held.
+ *
+ * @param[in] pHostName SNI host name of the session.
+ *
+ * @return The entry; NULL if no session is cached for the host.
+ */
+static SessionCacheEntry_t * findCachedSession( const char * pHostName );
+
+/**
+ * @brief Offer the session cached for a host in the handshake of a
+ * connection.
+ *
+ * @param[in] pMbedtlsParams Parameters of the connection.
+ * @param[in] pHostName SNI host name of the connection.
+ */
+static void offerCachedSession( MbedtlsParams_t * pMbedtlsParams,
+                                const char * pHostName );
+
+/**
+ * @brief Cache the session of a connection once its handshake completes.
+ *
+ * @param[in] pMbedtlsParams Parameters of the connection.
+ * @param[in] pHostName SNI host name of the connection.
+ */
+static void saveSession( const MbedtlsParams_t * pMbedtlsParams,
+                         const char * pHostName );
+
+/**
+ * @brief Perform the TLS handshake of a connection.
+ *
+ * @param[in] pMbedtlsParams Parameters of the connection.
+ *
+ * @return #MBEDTLS_POSIX_SUCCESS on success;
+ * #MBEDTLS_POSIX_HANDSHAKE_FAILED on failure.
+ */
+static MbedtlsStatus_t tlsHandshake( MbedtlsParams_t * pMbedtlsParams );
+
+/*-----------------------------------------------------------*/
+
+static void seedRng( void )
+{
+    mbedtls_entropy_init( &entropyContext );
+    mbedtls_ctr_drbg_init( &ctrDrbgContext );
+
+    rngStatus = mbedtls_ctr_drbg_seed( &ctrDrbgContext,
+                                       mbedtls_entropy_func,
+                                       &entropyContext,
+                                       ( const unsigned char * ) RNG_PERSONALIZATION,
+                                       sizeof( RNG_PERSONALIZATION ) - 1U );
+
+    if( rngStatus != 0 )
+    {
+        LogError( ( "Failed to seed the random number generator: "
+                    "mbedtls_ctr_drbg_seed returned -0x%04x.",
+                    ( unsigned int ) -rngStatus ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static int sendToSocket( void * pContext,
+                         const unsigned char * pBuffer,
+                         size_t length )
+{
+    const int32_t * pSocketDescriptor = ( const int32_t * ) pContext;
+    ssize_t bytesSent = 0;
+    int returnValue = 0;
+
+    assert( pSocketDescriptor != NULL );
+
+    /* MSG_NOSIGNAL keeps a connection closed by the server from raising
+     * SIGPIPE. */
+    bytesSent = send( *pSocketDescriptor, pBuffer, length, MSG_NOSIGNAL );
+
+    if( bytesSent >= 0 )
+    {
+        returnValue = ( int ) bytesSent;
+    }
+    /* EAGAIN and EWOULDBLOCK may have the same value, so they cannot be
+     * checked in a switch statement. */
+    else if( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+    {
+        returnValue = MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    else if( errno == EINTR )
+    {
+        returnValue = MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    else
+    {
+        LogError( ( "Failed to send data over the socket: errno=%d.", errno ) );
+        returnValue = MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+
+    return returnValue;
+}
+/*-----------------------------------------------------------*/
+
+static int recvFromSocket( void * pContext,
+                           unsigned char * pBuffer,
+                           size_t length )
+{
+    const int32_t * pSocketDescriptor = ( const int32_t * ) pContext;
+    ssize_t bytesReceived = 0;
+    int returnValue = 0;
+
+    assert( pSocketDescriptor != NULL );
+
+    bytesReceived = recv( *pSocketDescriptor, pBuffer, length, 0 );
+
+    if( bytesReceived >= 0 )
+    {
+        /* 0 tells mbedTLS that the server closed the connection. */
+        returnValue = ( int ) bytesReceived;
+    }
+    else if( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+    {
+        returnValue = MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    else if( errno == EINTR )
+    {
+        returnValue = MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    else
+    {
+        LogError( ( "Failed to receive data over the socket: errno=%d.", errno ) );
+        returnValue = MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+
+    return returnValue;
+}
+/*-----------------------------------------------------------*/
+
+static MbedtlsStatus_t convertToMbedtlsStatus( SocketStatus_t socketStatus )
+{
+    MbedtlsStatus_t mbedtlsStatus = MBEDTLS_POSIX_INVALID_PARAMETER;
+
+    switch( socketStatus )
+    {
+        case SOCKETS_SUCCESS:
+            mbedtlsStatus = MBEDTLS_POSIX_SUCCESS;
+            break;
+
+        case SOCKETS_INVALID_PARAMETER:
+            mbedtlsStatus = MBEDTLS_POSIX_INVALID_PARAMETER;
+            break;
+
+        case SOCKETS_DNS_FAILURE:
+            mbedtlsStatus = MBEDTLS_POSIX_DNS_FAILURE;
+            break;
+
+        case SOCKETS_CONNECT_FAILURE:
+            mbedtlsStatus = MBEDTLS_POSIX_CONNECT_FAILURE;
+            break;
+
+        case SOCKETS_INSUFFICIENT_MEMORY:
+            mbedtlsStatus = MBEDTLS_POSIX_INSUFFICIENT_MEMORY;
+            break;
+
+        case SOCKETS_API_ERROR:
+            mbedtlsStatus = MBEDTLS_POSIX_API_ERROR;
+            break;
+
+        default:
+            LogError( ( "Unexpected status received from socket wrapper: Socket status = %u",
+                        socketStatus ) );
+            break;
+    }
+
+    return mbedtlsStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void initContexts( MbedtlsParams_t * pMbedtlsParams )
+{
+    assert( pMbedtlsParams != NULL );
+
+    mbedtls_ssl_init( &pMbedtlsParams->sslContext );
+    mbedtls_ssl_config_init( &pMbedtlsParams->sslConfig );
+    mbedtls_x509_crt_init( &pMbedtlsParams->rootCa );
+    mbedtls_x509_crt_init( &pMbedtlsParams->clientCert );
+    mbedtls_pk_init( &pMbedtlsParams->privateKey );
+}
+/*-----------------------------------------------------------*/
+
+static void freeContexts( MbedtlsParams_t * pMbedtlsParams )
+{
+    assert( pMbedtlsParams != NULL );
+
+    mbedtls_ssl_free( &pMbedtlsParams->sslContext );
+    mbedtls_ssl_config_free( &pMbedtlsParams->sslConfig );
+    mbedtls_x509_crt_free( &pMbedtlsParams->rootCa );
+    mbedtls_x509_crt_free( &pMbedtlsParams->clientCert );
+    mbedtls_pk_free( &pMbedtlsParams->privateKey );
+}
+/*-----------------------------------------------------------*/
+
+static MbedtlsStatus_t setCredentials( MbedtlsParams_t * pMbedtlsParams,
+                                       const MbedtlsCredentials_t * pMbedtlsCredentials )
+{
+    MbedtlsStatus_t returnStatus = MBEDTLS_POSIX_SUCCESS;
+    int mbedtlsError = 0;
+
+    assert( pMbedtlsParams != NULL );
+    assert( pMbedtlsCredentials != NULL );
+
+    /* A bundle of root CAs is accepted if some of its certificates could
+     * not be parsed, which mbedTLS reports with a positive count. */
+    mbedtlsError = mbedtls_x509_crt_parse_file( &pMbedtlsParams->rootCa,
+                                                pMbedtlsCredentials->pRootCaPath );
+
+    if( mbedtlsError < 0 )
+    {
+        LogError( ( "Failed to parse the root CA certificate %s: "
+                    "mbedtls_x509_crt_parse_file returned -0x%04x.",
+                    pMbedtlsCredentials->pRootCaPath,
+                    ( unsigned int ) -mbedtlsError ) );
+        returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+    }
+    else
+    {
+        mbedtls_ssl_conf_ca_chain( &pMbedtlsParams->sslConfig,
+                                   &pMbedtlsParams->rootCa,
+                                   NULL );
+    }
+
+    /* The client certificate and key are optional, for servers that do not
+     * authenticate the client with TLS. */
+    if( ( returnStatus == MBEDTLS_POSIX_SUCCESS ) &&
+        ( pMbedtlsCredentials->pClientCertPath != NULL ) &&
+        ( pMbedtlsCredentials->pPrivateKeyPath != NULL ) )
+    {
+        mbedtlsError = mbedtls_x509_crt_parse_file( &pMbedtlsParams->clientCert,
+                                                    pMbedtlsCredentials->pClientCertPath );
+
+        if( mbedtlsError != 0 )
+        {
+            LogError( ( "Failed to parse the client certificate %s: "
+                        "mbedtls_x509_crt_parse_file returned -0x%04x.",
+                        pMbedtlsCredentials->pClientCertPath,
+                        ( unsigned int ) -mbedtlsError ) );
+            returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+        }
+        else
+        {
+            mbedtlsError = mbedtls_pk_parse_keyfile( &pMbedtlsParams->privateKey,
+                                                     pMbedtlsCredentials->pPrivateKeyPath,
+                                                     NULL );
+
+            if( mbedtlsError != 0 )
+            {
+                LogError( ( "Failed to parse the client key %s: "
+                            "mbedtls_pk_parse_keyfile returned -0x%04x.",
+                            pMbedtlsCredentials->pPrivateKeyPath,
+                            ( unsigned int ) -mbedtlsError ) );
+                returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+            }
+        }
+
+        if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+        {
+            mbedtlsError = mbedtls_ssl_conf_own_cert( &pMbedtlsParams->sslConfig,
+                                                      &pMbedtlsParams->clientCert,
+                                                      &pMbedtlsParams->privateKey );
+
+            if( mbedtlsError != 0 )
+            {
+                LogError( ( "Failed to set the client certificate and key: "
+                            "mbedtls_ssl_conf_own_cert returned -0x%04x.",
+                            ( unsigned int ) -mbedtlsError ) );
+                returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static MbedtlsStatus_t setupSslConfig( MbedtlsParams_t * pMbedtlsParams,
+                                       const MbedtlsCredentials_t * pMbedtlsCredentials )
+{
+    MbedtlsStatus_t returnStatus = MBEDTLS_POSIX_SUCCESS;
+    int mbedtlsError = 0;
+
+    assert( pMbedtlsParams != NULL );
+    assert( pMbedtlsCredentials != NULL );
+
+    ( void ) pthread_once( &rngOnce, seedRng );
+
+    if( rngStatus != 0 )
+    {
+        returnStatus = MBEDTLS_POSIX_API_ERROR;
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        mbedtlsError = mbedtls_ssl_config_defaults( &pMbedtlsParams->sslConfig,
+                                                    MBEDTLS_SSL_IS_CLIENT,
+                                                    MBEDTLS_SSL_TRANSPORT_STREAM,
+                                                    MBEDTLS_SSL_PRESET_DEFAULT );
+
+        if( mbedtlsError != 0 )
+        {
+            LogError( ( "Failed to set the default TLS configuration: "
+                        "mbedtls_ssl_config_defaults returned -0x%04x.",
+                        ( unsigned int ) -mbedtlsError ) );
+            returnStatus = MBEDTLS_POSIX_API_ERROR;
+        }
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        mbedtls_ssl_conf_authmode( &pMbedtlsParams->sslConfig,
+                                   MBEDTLS_SSL_VERIFY_REQUIRED );
+        mbedtls_ssl_conf_rng( &pMbedtlsParams->sslConfig,
+                              mbedtls_ctr_drbg_random,
+                              &ctrDrbgContext );
+
+        returnStatus = setCredentials( pMbedtlsParams, pMbedtlsCredentials );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static unsigned char getMaxFragmentLengthCode( uint16_t maxFragmentLength )
+{
+    unsigned char code = MBEDTLS_SSL_MAX_FRAG_LEN_INVALID;
+
+    switch( maxFragmentLength )
+    {
+        case 512U:
+            code = MBEDTLS_SSL_MAX_FRAG_LEN_512;
+            break;
+
+        case 1024U:
+            code = MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+            break;
+
+        case 2048U:
+            code = MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+            break;
+
+        case 4096U:
+            code = MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+            break;
+
+        default:
+            /* Not a length mbedTLS can negotiate. */
+            break;
+    }
+
+    return code;
+}
+/*-----------------------------------------------------------*/
+
+static void setOptionalConfigurations( MbedtlsParams_t * pMbedtlsParams,
+                                       const MbedtlsCredentials_t * pMbedtlsCredentials )
+{
+    int mbedtlsError = 0;
+    uint16_t maxFragmentLength = 0U;
+    unsigned char maxFragmentLengthCode = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+
+    assert( pMbedtlsParams != NULL );
+    assert( pMbedtlsCredentials != NULL );
+
+    /* Set up the ALPN protocols. */
+    if( pMbedtlsCredentials->pAlpnProtos != NULL )
+    {
+        LogDebug( ( "Setting ALPN protos." ) );
+        mbedtlsError = mbedtls_ssl_conf_alpn_protocols( &pMbedtlsParams->sslConfig,
+                                                        pMbedtlsCredentials->pAlpnProtos );
+
+        if( mbedtlsError != 0 )
+        {
+            LogError( ( "Failed to set ALPN protos: "
+                        "mbedtls_ssl_conf_alpn_protocols returned -0x%04x.",
+                        ( unsigned int ) -mbedtlsError ) );
+        }
+    }
+
+    /* Set the maximum fragment length, so that the server sends records that
+     * fit the input buffer. */
+    maxFragmentLength = ( pMbedtlsCredentials->maxFragmentLength == 0U ) ?
+                        ( uint16_t ) MBEDTLS_POSIX_DEFAULT_MAX_FRAGMENT_LENGTH :
+                        pMbedtlsCredentials->maxFragmentLength;
+
+    if( maxFragmentLength > 0U )
+    {
+        maxFragmentLengthCode = getMaxFragmentLengthCode( maxFragmentLength );
+        mbedtlsError = mbedtls_ssl_conf_max_frag_len( &pMbedtlsParams->sslConfig,
+                                                      maxFragmentLengthCode );
+
+        if( mbedtlsError != 0 )
+        {
+            LogError( ( "Failed to set the maximum fragment length %u: "
+                        "mbedtls_ssl_conf_max_frag_len returned -0x%04x.",
+                        ( unsigned int ) maxFragmentLength,
+                        ( unsigned int ) -mbedtlsError ) );
+        }
+    }
+
+    /* Set server name indication, which is also the name the server
+     * certificate is verified against. */
+    if( pMbedtlsCredentials->sniHostName != NULL )
+    {
+        mbedtlsError = mbedtls_ssl_set_hostname( &pMbedtlsParams->sslContext,
+                                                 pMbedtlsCredentials->sniHostName );
+
+        if( mbedtlsError != 0 )
+        {
+            LogError( ( "Failed to set server name indication: "
+                        "mbedtls_ssl_set_hostname returned -0x%04x.",
+                        ( unsigned int ) -mbedtlsError ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static SessionCacheEntry_t * findCachedSession( const char * pHostName )
+{
+    SessionCacheEntry_t * pEntry = NULL;
+    size_t i = 0U;
+
+    assert( pHostName != NULL );
+
+    for( i = 0U; i < MBEDTLS_POSIX_SESSION_CACHE_SIZE; i++ )
+    {
+        if( ( sessionCache[ i ].inUse == true ) &&
+            ( strcmp( sessionCache[ i ].hostName, pHostName ) == 0 ) )
+        {
+            pEntry = &sessionCache[ i ];
+            break;
+        }
+    }
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static void offerCachedSession( MbedtlsParams_t * pMbedtlsParams,
+                                const char * pHostName )
+{
+    const SessionCacheEntry_t * pEntry = NULL;
+    int mbedtlsError = 0;
+
+    assert( pMbedtlsParams != NULL );
+    assert( pHostName != NULL );
+
+    /* mbedtls_ssl_set_session copies the session, so the entry stays valid
+     * for other connections. */
+    ( void ) pthread_mutex_lock( &sessionCacheMutex );
+
+    pEntry = findCachedSession( pHostName );
+
+    if( pEntry != NULL )
+    {
+        mbedtlsError = mbedtls_ssl_set_session( &pMbedtlsParams->sslContext,
+                                                &pEntry->session );
+    }
+
+    ( void ) pthread_mutex_unlock( &sessionCacheMutex );
+
+    if( pEntry == NULL )
+    {
+        LogDebug( ( "No TLS session to resume for %s.", pHostName ) );
+    }
+    else if( mbedtlsError != 0 )
+    {
+        LogWarn( ( "mbedtls_ssl_set_session returned -0x%04x: "
+                   "Performing a full TLS handshake.",
+                   ( unsigned int ) -mbedtlsError ) );
+    }
+    else
+    {
+        LogDebug( ( "Offering TLS session for %s.", pHostName ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void saveSession( const MbedtlsParams_t * pMbedtlsParams,
+                         const char * pHostName )
+{
+    SessionCacheEntry_t * pEntry = NULL;
+    size_t hostNameLength = 0U;
+    size_t i = 0U;
+    int mbedtlsError = 0;
+
+    assert( pMbedtlsParams != NULL );
+    assert( pHostName != NULL );
+
+    hostNameLength = strlen( pHostName );
+
+    if( hostNameLength > MBEDTLS_POSIX_MAX_HOST_NAME_LENGTH )
+    {
+        LogWarn( ( "SNI host name is longer than MBEDTLS_POSIX_MAX_HOST_NAME_LENGTH: "
+                   "The session will not be resumed." ) );
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &sessionCacheMutex );
+
+        /* Replace the session cached for the host, or use a free entry. */
+        pEntry = findCachedSession( pHostName );
+
+        for( i = 0U; ( pEntry == NULL ) && ( i < MBEDTLS_POSIX_SESSION_CACHE_SIZE ); i++ )
+        {
+            if( sessionCache[ i ].inUse == false )
+            {
+                pEntry = &sessionCache[ i ];
+            }
+        }
+
+        if( pEntry != NULL )
+        {
+            /* Freeing a session also initializes it again. */
+            mbedtls_ssl_session_free( &pEntry->session );
+            mbedtlsError = mbedtls_ssl_get_session( &pMbedtlsParams->sslContext,
+                                                    &pEntry->session );
+
+            if( mbedtlsError == 0 )
+            {
+                ( void ) memcpy( pEntry->hostName, pHostName, hostNameLength + 1U );
+                pEntry->inUse = true;
+                LogDebug( ( "Cached TLS session for %s.", pHostName ) );
+            }
+            else
+            {
+                mbedtls_ssl_session_free( &pEntry->session );
+                pEntry->inUse = false;
+                LogWarn( ( "mbedtls_ssl_get_session returned -0x%04x: "
+                           "The session will not be resumed.",
+                           ( unsigned int ) -mbedtlsError ) );
+            }
+        }
+        else
+        {
+            LogWarn( ( "TLS session cache is full: The session will not be resumed. "
+                       "Consider increasing MBEDTLS_POSIX_SESSION_CACHE_SIZE." ) );
+        }
+
+        ( void ) pthread_mutex_unlock( &sessionCacheMutex );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static MbedtlsStatus_t tlsHandshake( MbedtlsParams_t * pMbedtlsParams )
+{
+    MbedtlsStatus_t returnStatus = MBEDTLS_POSIX_SUCCESS;
+    int mbedtlsError = 0;
+
+    assert( pMbedtlsParams != NULL );
+
+    TRACE_PROBE1( tls_handshake_start, pMbedtlsParams );
+
+    /* The send and receive callbacks only ask to be called again when a
+     * signal interrupted them. A timeout of the socket fails the handshake. */
+    do
+    {
+        mbedtlsError = mbedtls_ssl_handshake( &pMbedtlsParams->sslContext );
+    } while( ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+             ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+
+    if( mbedtlsError != 0 )
+    {
+        LogError( ( "Failed to perform TLS handshake: "
+                    "mbedtls_ssl_handshake returned -0x%04x.",
+                    ( unsigned int ) -mbedtlsError ) );
+
+        if( mbedtlsError == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED )
+        {
+            LogError( ( "Failed to verify the server certificate: Flags=0x%08x.",
+                        ( unsigned int ) mbedtls_ssl_get_verify_result( &pMbedtlsParams->sslContext ) ) );
+        }
+
+        returnStatus = MBEDTLS_POSIX_HANDSHAKE_FAILED;
+    }
+
+    TRACE_PROBE2( tls_handshake_done, pMbedtlsParams, returnStatus );
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+MbedtlsStatus_t Mbedtls_Connect( NetworkContext_t * pNetworkContext,
+                                 const ServerInfo_t * pServerInfo,
+                                 const MbedtlsCredentials_t * pMbedtlsCredentials,
+                                 uint32_t sendTimeoutMs,
+                                 uint32_t recvTimeoutMs )
+{
+    MbedtlsParams_t * pMbedtlsParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    MbedtlsStatus_t returnStatus = MBEDTLS_POSIX_SUCCESS;
+    int mbedtlsError = 0;
+    bool socketConnected = false;
+
+    /* Validate parameters. */
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = MBEDTLS_POSIX_INVALID_PARAMETER;
+    }
+    else if( pMbedtlsCredentials == NULL )
+    {
+        LogError( ( "Parameter check failed: pMbedtlsCredentials is NULL." ) );
+        returnStatus = MBEDTLS_POSIX_INVALID_PARAMETER;
+    }
+    else if( pMbedtlsCredentials->pRootCaPath == NULL )
+    {
+        LogError( ( "Parameter check failed: pMbedtlsCredentials->pRootCaPath is NULL." ) );
+        returnStatus = MBEDTLS_POSIX_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    /* Establish the TCP connection. */
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        pMbedtlsParams = pNetworkContext->pParams;
+        initContexts( pMbedtlsParams );
+
+        socketStatus = Sockets_Connect( &pMbedtlsParams->socketDescriptor,
+                                        pServerInfo,
+                                        sendTimeoutMs,
+                                        recvTimeoutMs );
+
+        /* Convert socket wrapper status to mbedTLS transport status. */
+        returnStatus = convertToMbedtlsStatus( socketStatus );
+        socketConnected = ( returnStatus == MBEDTLS_POSIX_SUCCESS );
+    }
+
+    /* Set up the TLS configuration and session. */
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        returnStatus = setupSslConfig( pMbedtlsParams, pMbedtlsCredentials );
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        mbedtlsError = mbedtls_ssl_setup( &pMbedtlsParams->sslContext,
+                                          &pMbedtlsParams->sslConfig );
+
+        if( mbedtlsError != 0 )
+        {
+            LogError( ( "Failed to set up the TLS session: "
+                        "mbedtls_ssl_setup returned -0x%04x.",
+                        ( unsigned int ) -mbedtlsError ) );
+            returnStatus = ( mbedtlsError == MBEDTLS_ERR_SSL_ALLOC_FAILED ) ?
+                           MBEDTLS_POSIX_INSUFFICIENT_MEMORY : MBEDTLS_POSIX_API_ERROR;
+        }
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        setOptionalConfigurations( pMbedtlsParams, pMbedtlsCredentials );
+
+        mbedtls_ssl_set_bio( &pMbedtlsParams->sslContext,
+                             &pMbedtlsParams->socketDescriptor,
+                             sendToSocket,
+                             recvFromSocket,
+                             NULL );
+
+        if( ( pMbedtlsCredentials->cacheSession == true ) &&
+            ( pMbedtlsCredentials->sniHostName != NULL ) )
+        {
+            offerCachedSession( pMbedtlsParams, pMbedtlsCredentials->sniHostName );
+        }
+
+        returnStatus = tlsHandshake( pMbedtlsParams );
+    }
+
+    /* The server sends its session ticket during the handshake, so the
+     * session can be cached as soon as the handshake completes. */
+    if( ( returnStatus == MBEDTLS_POSIX_SUCCESS ) &&
+        ( pMbedtlsCredentials->cacheSession == true ) &&
+        ( pMbedtlsCredentials->sniHostName != NULL ) )
+    {
+        saveSession( pMbedtlsParams, pMbedtlsCredentials->sniHostName );
+    }
+
+    /* Clean up on error. */
+    if( ( returnStatus != MBEDTLS_POSIX_SUCCESS ) && ( pMbedtlsParams != NULL ) )
+    {
+        freeContexts( pMbedtlsParams );
+
+        if( socketConnected == true )
+        {
+            ( void ) Sockets_Disconnect( pMbedtlsParams->socketDescriptor );
+            pMbedtlsParams->socketDescriptor = -1;
+        }
+    }
+
+    /* Log failure or success depending on status. */
+    if( returnStatus != MBEDTLS_POSIX_SUCCESS )
+    {
+        LogError( ( "Failed to establish a TLS connection." ) );
+    }
+    else
+    {
+        LogDebug( ( "Established a TLS connection." ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+MbedtlsStatus_t Mbedtls_Disconnect( const NetworkContext_t * pNetworkContext )
+{
+    MbedtlsParams_t * pMbedtlsParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_INVALID_PARAMETER;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        /* No need to update the status here. The socket status
+         * SOCKETS_INVALID_PARAMETER will be converted to mbedTLS transport
+         * status MBEDTLS_POSIX_INVALID_PARAMETER before returning from this
+         * function. */
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else
+    {
+        pMbedtlsParams = pNetworkContext->pParams;
+
+        /* Send "close notify" to the server. Its reply is not waited for. */
+        ( void ) mbedtls_ssl_close_notify( &pMbedtlsParams->sslContext );
+        freeContexts( pMbedtlsParams );
+
+        /* Tear down the socket connection, pNetworkContext != NULL here. */
+        socketStatus = Sockets_Disconnect( pMbedtlsParams->socketDescriptor );
+    }
+
+    return convertToMbedtlsStatus( socketStatus );
+}
+/*-----------------------------------------------------------*/
+
+MbedtlsStatus_t Mbedtls_ReleaseSession( const MbedtlsCredentials_t * pMbedtlsCredentials )
+{
+    MbedtlsStatus_t returnStatus = MBEDTLS_POSIX_SUCCESS;
+    SessionCacheEntry_t * pEntry = NULL;
+
+    if( pMbedtlsCredentials == NULL )
+    {
+        LogError( ( "Parameter check failed: pMbedtlsCredentials is NULL." ) );
+        returnStatus = MBEDTLS_POSIX_INVALID_PARAMETER;
+    }
+    else if( pMbedtlsCredentials->sniHostName != NULL )
+    {
+        ( void ) pthread_mutex_lock( &sessionCacheMutex );
+
+        pEntry = findCachedSession( pMbedtlsCredentials->sniHostName );
+
+        if( pEntry != NULL )
+        {
+            mbedtls_ssl_session_free( &pEntry->session );
+            pEntry->inUse = false;
+        }
+
+        ( void ) pthread_mutex_unlock( &sessionCacheMutex );
+    }
+    else
+    {
+        /* No session is cached without SNI. */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Mbedtls_Recv( NetworkContext_t * pNetworkContext,
+                      void * pBuffer,
+                      size_t bytesToRecv )
+{
+    MbedtlsParams_t * pMbedtlsParams = NULL;
+    int32_t bytesReceived = 0;
+    int mbedtlsError = 0;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else
+    {
+        pMbedtlsParams = pNetworkContext->pParams;
+
+        mbedtlsError = mbedtls_ssl_read( &pMbedtlsParams->sslContext,
+                                         ( unsigned char * ) pBuffer,
+                                         bytesToRecv );
+
+        if( mbedtlsError > 0 )
+        {
+            bytesReceived = ( int32_t ) mbedtlsError;
+        }
+        else if( ( mbedtlsError == MBEDTLS_ERR_SSL_TIMEOUT ) ||
+                 ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            /* No data was received before the timeout. mbedTLS keeps the
+             * part of a record read so far for the next call. */
+            bytesReceived = 0;
+        }
+        else
+        {
+            LogError( ( "Failed to receive data over network: "
+                        "mbedtls_ssl_read returned -0x%04x.",
+                        ( unsigned int ) -mbedtlsError ) );
+
+            /* The transport interface requires zero return code only when the
+             * receive operation can be retried to achieve success. A closed
+             * connection cannot be retried. */
+            bytesReceived = -1;
+        }
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Mbedtls_Send( NetworkContext_t * pNetworkContext,
+                      const void * pBuffer,
+                      size_t bytesToSend )
+{
+    MbedtlsParams_t * pMbedtlsParams = NULL;
+    int32_t bytesSent = 0;
+    int mbedtlsError = 0;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else
+    {
+        pMbedtlsParams = pNetworkContext->pParams;
+
+        /* mbedTLS sends at most one record of MBEDTLS_SSL_OUT_CONTENT_LEN
+         * bytes, or of the negotiated maximum fragment length, per call. */
+        mbedtlsError = mbedtls_ssl_write( &pMbedtlsParams->sslContext,
+                                          ( const unsigned char * ) pBuffer,
+                                          bytesToSend );
+
+        if( mbedtlsError >= 0 )
+        {
+            bytesSent = ( int32_t ) mbedtlsError;
+        }
+        else if( ( mbedtlsError == MBEDTLS_ERR_SSL_TIMEOUT ) ||
+                 ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( mbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            /* The record is kept by mbedTLS, and is sent by the next call
+             * with the same data. */
+            bytesSent = 0;
+        }
+        else
+        {
+            LogError( ( "Failed to send data over network: "
+                        "mbedtls_ssl_write returned -0x%04x.",
+                        ( unsigned int ) -mbedtlsError ) );
+            bytesSent = -1;
+        }
+    }
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
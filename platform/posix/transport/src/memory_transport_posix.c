@@ -0,0 +1,466 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+#include "memory_transport_posix.h"
+
+/* Clock of the latency and bandwidth simulation. */
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of microseconds in a second.
+ */
+#define MICROSECONDS_PER_SECOND    ( ( uint64_t ) 1000000U )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    MemoryTransportParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether a link holds back the data of the sends.
+ *
+ * @param[in] pLink The link.
+ *
+ * @return true if the link has a latency or a bandwidth limit.
+ */
+static bool isLinkShaped( const MemoryTransportLink_t * pLink );
+
+/**
+ * @brief Release the data of the pending sends whose time has come.
+ *
+ * Called by the receiving endpoint only.
+ *
+ * @param[in] pRing The ring of the pending sends.
+ * @param[in] nowUs Current time.
+ */
+static void releasePendingSends( MemoryTransportRing_t * pRing,
+                                 uint64_t nowUs );
+
+/**
+ * @brief Hold back the data of a send until the link delivered it.
+ *
+ * Called by the sending endpoint only, once the data is in the ring.
+ *
+ * @param[in] pRing The ring of the send.
+ * @param[in] end Position of the end of the data of the send.
+ * @param[in] length Length of the data of the send.
+ * @param[in] nowUs Current time.
+ */
+static void holdBackSend( MemoryTransportRing_t * pRing,
+                          size_t end,
+                          size_t length,
+                          uint64_t nowUs );
+
+/**
+ * @brief Copy data into a ring, wrapping at its end.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] position Position of the first byte to write.
+ * @param[in] pData The data.
+ * @param[in] length Length of @p pData.
+ */
+static void copyToRing( MemoryTransportRing_t * pRing,
+                        size_t position,
+                        const uint8_t * pData,
+                        size_t length );
+
+/**
+ * @brief Copy data out of a ring, wrapping at its end.
+ *
+ * @param[in] pRing The ring.
+ * @param[in] position Position of the first byte to read.
+ * @param[out] pData Buffer receiving the data.
+ * @param[in] length Number of bytes to copy.
+ */
+static void copyFromRing( const MemoryTransportRing_t * pRing,
+                          size_t position,
+                          uint8_t * pData,
+                          size_t length );
+
+/**
+ * @brief Check the network context of a send or receive.
+ *
+ * @param[in] pNetworkContext The network context.
+ *
+ * @return true if it is connected to a pair; false otherwise.
+ */
+static bool isConnected( const NetworkContext_t * pNetworkContext );
+
+/*-----------------------------------------------------------*/
+
+static bool isLinkShaped( const MemoryTransportLink_t * pLink )
+{
+    return ( pLink->latencyUs != 0U ) || ( pLink->bytesPerSecond != 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void releasePendingSends( MemoryTransportRing_t * pRing,
+                                 uint64_t nowUs )
+{
+    size_t pendingTail = __atomic_load_n( &pRing->pendingTail, __ATOMIC_ACQUIRE );
+    const MemoryTransportPendingSend_t * pPending = NULL;
+    bool released = true;
+
+    /* The release times increase from one send to the next, so the first
+     * send still held back holds back all the later ones. */
+    while( ( pRing->pendingHead != pendingTail ) && ( released == true ) )
+    {
+        pPending = &pRing->pendingSends[ pRing->pendingHead & ( MEMORY_TRANSPORT_MAX_PENDING_SENDS - 1U ) ];
+
+        if( pPending->releaseTimeUs <= nowUs )
+        {
+            pRing->releasedEnd = pPending->end;
+            __atomic_store_n( &pRing->pendingHead, pRing->pendingHead + 1U, __ATOMIC_RELEASE );
+        }
+        else
+        {
+            released = false;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void holdBackSend( MemoryTransportRing_t * pRing,
+                          size_t end,
+                          size_t length,
+                          uint64_t nowUs )
+{
+    MemoryTransportPendingSend_t * pPending = NULL;
+
+    /* The link carries the data of a send once it carried that of the
+     * previous sends. */
+    if( pRing->linkFreeTimeUs < nowUs )
+    {
+        pRing->linkFreeTimeUs = nowUs;
+    }
+
+    if( pRing->link.bytesPerSecond != 0U )
+    {
+        pRing->linkFreeTimeUs += ( ( uint64_t ) length * MICROSECONDS_PER_SECOND ) /
+                                 pRing->link.bytesPerSecond;
+    }
+
+    pPending = &pRing->pendingSends[ pRing->pendingTail & ( MEMORY_TRANSPORT_MAX_PENDING_SENDS - 1U ) ];
+    pPending->end = end;
+    pPending->releaseTimeUs = pRing->linkFreeTimeUs + pRing->link.latencyUs;
+
+    __atomic_store_n( &pRing->pendingTail, pRing->pendingTail + 1U, __ATOMIC_RELEASE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void copyToRing( MemoryTransportRing_t * pRing,
+                        size_t position,
+                        const uint8_t * pData,
+                        size_t length )
+{
+    size_t offset = position & ( pRing->size - 1U );
+    size_t firstLength = pRing->size - offset;
+
+    if( firstLength > length )
+    {
+        firstLength = length;
+    }
+
+    ( void ) memcpy( &pRing->pBuffer[ offset ], pData, firstLength );
+    ( void ) memcpy( pRing->pBuffer, &pData[ firstLength ], length - firstLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static void copyFromRing( const MemoryTransportRing_t * pRing,
+                          size_t position,
+                          uint8_t * pData,
+                          size_t length )
+{
+    size_t offset = position & ( pRing->size - 1U );
+    size_t firstLength = pRing->size - offset;
+
+    if( firstLength > length )
+    {
+        firstLength = length;
+    }
+
+    ( void ) memcpy( pData, &pRing->pBuffer[ offset ], firstLength );
+    ( void ) memcpy( &pData[ firstLength ], pRing->pBuffer, length - firstLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isConnected( const NetworkContext_t * pNetworkContext )
+{
+    return ( pNetworkContext != NULL ) &&
+           ( pNetworkContext->pParams != NULL ) &&
+           ( pNetworkContext->pParams->pPair != NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+MemoryTransportStatus_t MemoryTransport_Init( MemoryTransportPair_t * pPair,
+                                              uint8_t * pClientBuffer,
+                                              uint8_t * pServerBuffer,
+                                              size_t bufferSize )
+{
+    MemoryTransportStatus_t returnStatus = MEMORY_TRANSPORT_SUCCESS;
+
+    if( ( pPair == NULL ) || ( pClientBuffer == NULL ) || ( pServerBuffer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pPair, pClientBuffer and pServerBuffer must not be NULL." ) );
+        returnStatus = MEMORY_TRANSPORT_INVALID_PARAMETER;
+    }
+    else if( ( bufferSize == 0U ) || ( ( bufferSize & ( bufferSize - 1U ) ) != 0U ) )
+    {
+        LogError( ( "Parameter check failed: bufferSize must be a power of two. bufferSize=%lu",
+                    ( unsigned long ) bufferSize ) );
+        returnStatus = MEMORY_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pPair, 0, sizeof( MemoryTransportPair_t ) );
+        pPair->rings[ MEMORY_TRANSPORT_CLIENT ].pBuffer = pClientBuffer;
+        pPair->rings[ MEMORY_TRANSPORT_CLIENT ].size = bufferSize;
+        pPair->rings[ MEMORY_TRANSPORT_SERVER ].pBuffer = pServerBuffer;
+        pPair->rings[ MEMORY_TRANSPORT_SERVER ].size = bufferSize;
+        pPair->getTimeUs = Clock_GetTimeUs;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MemoryTransportStatus_t MemoryTransport_SetLink( MemoryTransportPair_t * pPair,
+                                                 MemoryTransportEndpoint_t sender,
+                                                 const MemoryTransportLink_t * pLink )
+{
+    MemoryTransportStatus_t returnStatus = MEMORY_TRANSPORT_SUCCESS;
+
+    if( ( pPair == NULL ) || ( pLink == NULL ) ||
+        ( ( sender != MEMORY_TRANSPORT_CLIENT ) && ( sender != MEMORY_TRANSPORT_SERVER ) ) )
+    {
+        LogError( ( "Parameter check failed: pPair and pLink must not be NULL, and sender must be an endpoint." ) );
+        returnStatus = MEMORY_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        pPair->rings[ sender ].link = *pLink;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MemoryTransportStatus_t MemoryTransport_Connect( NetworkContext_t * pNetworkContext,
+                                                 MemoryTransportPair_t * pPair,
+                                                 MemoryTransportEndpoint_t endpoint )
+{
+    MemoryTransportStatus_t returnStatus = MEMORY_TRANSPORT_SUCCESS;
+    MemoryTransportParams_t * pMemoryParams = NULL;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) || ( pPair == NULL ) ||
+        ( ( endpoint != MEMORY_TRANSPORT_CLIENT ) && ( endpoint != MEMORY_TRANSPORT_SERVER ) ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext, its parameters and pPair must not be NULL, "
+                    "and endpoint must be an endpoint." ) );
+        returnStatus = MEMORY_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        pMemoryParams = pNetworkContext->pParams;
+        pMemoryParams->pPair = pPair;
+        pMemoryParams->pSendRing = &pPair->rings[ endpoint ];
+        pMemoryParams->pRecvRing = &pPair->rings[ ( endpoint == MEMORY_TRANSPORT_CLIENT ) ?
+                                                  MEMORY_TRANSPORT_SERVER : MEMORY_TRANSPORT_CLIENT ];
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+MemoryTransportStatus_t MemoryTransport_Disconnect( const NetworkContext_t * pNetworkContext )
+{
+    MemoryTransportStatus_t returnStatus = MEMORY_TRANSPORT_SUCCESS;
+
+    if( isConnected( pNetworkContext ) == false )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is not connected." ) );
+        returnStatus = MEMORY_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        __atomic_store_n( &pNetworkContext->pParams->pSendRing->closed, true, __ATOMIC_RELEASE );
+        __atomic_store_n( &pNetworkContext->pParams->pRecvRing->closed, true, __ATOMIC_RELEASE );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t MemoryTransport_Recv( NetworkContext_t * pNetworkContext,
+                              void * pBuffer,
+                              size_t bytesToRecv )
+{
+    int32_t bytesReceived = -1;
+    MemoryTransportRing_t * pRing = NULL;
+    bool closed = false;
+    size_t tail = 0U;
+    size_t end = 0U;
+    size_t length = 0U;
+
+    if( ( isConnected( pNetworkContext ) == false ) || ( pBuffer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext must be connected and pBuffer must not be NULL." ) );
+    }
+    else
+    {
+        pRing = pNetworkContext->pParams->pRecvRing;
+
+        /* Read the flag before the tail, so that the tail covers all the data
+         * sent before the connection was closed. */
+        closed = __atomic_load_n( &pRing->closed, __ATOMIC_ACQUIRE );
+        tail = __atomic_load_n( &pRing->tail, __ATOMIC_ACQUIRE );
+
+        if( isLinkShaped( &pRing->link ) == true )
+        {
+            releasePendingSends( pRing, pNetworkContext->pParams->pPair->getTimeUs() );
+            end = pRing->releasedEnd;
+        }
+        else
+        {
+            end = tail;
+        }
+
+        length = end - pRing->head;
+
+        if( length > bytesToRecv )
+        {
+            length = bytesToRecv;
+        }
+
+        if( ( pRing->link.maxFragmentLength != 0U ) && ( length > pRing->link.maxFragmentLength ) )
+        {
+            length = pRing->link.maxFragmentLength;
+        }
+
+        if( length > ( size_t ) INT32_MAX )
+        {
+            length = ( size_t ) INT32_MAX;
+        }
+
+        if( length > 0U )
+        {
+            copyFromRing( pRing, pRing->head, pBuffer, length );
+            __atomic_store_n( &pRing->head, pRing->head + length, __ATOMIC_RELEASE );
+            bytesReceived = ( int32_t ) length;
+        }
+        else if( ( closed == true ) && ( pRing->head == tail ) )
+        {
+            LogDebug( ( "Memory connection closed." ) );
+        }
+        else
+        {
+            /* No data was released yet. */
+            bytesReceived = 0;
+        }
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t MemoryTransport_Send( NetworkContext_t * pNetworkContext,
+                              const void * pBuffer,
+                              size_t bytesToSend )
+{
+    int32_t bytesSent = -1;
+    MemoryTransportRing_t * pRing = NULL;
+    bool shaped = false;
+    size_t length = 0U;
+
+    if( ( isConnected( pNetworkContext ) == false ) || ( pBuffer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext must be connected and pBuffer must not be NULL." ) );
+    }
+    else if( __atomic_load_n( &pNetworkContext->pParams->pSendRing->closed, __ATOMIC_ACQUIRE ) == true )
+    {
+        LogDebug( ( "Memory connection closed." ) );
+    }
+    else
+    {
+        pRing = pNetworkContext->pParams->pSendRing;
+        shaped = isLinkShaped( &pRing->link );
+
+        /* Room left in the ring. */
+        length = pRing->size - ( pRing->tail - __atomic_load_n( &pRing->head, __ATOMIC_ACQUIRE ) );
+
+        if( length > bytesToSend )
+        {
+            length = bytesToSend;
+        }
+
+        if( length > ( size_t ) INT32_MAX )
+        {
+            length = ( size_t ) INT32_MAX;
+        }
+
+        if( ( shaped == true ) &&
+            ( ( pRing->pendingTail - __atomic_load_n( &pRing->pendingHead, __ATOMIC_ACQUIRE ) ) ==
+              MEMORY_TRANSPORT_MAX_PENDING_SENDS ) )
+        {
+            length = 0U;
+        }
+
+        if( length > 0U )
+        {
+            copyToRing( pRing, pRing->tail, pBuffer, length );
+            __atomic_store_n( &pRing->tail, pRing->tail + length, __ATOMIC_RELEASE );
+
+            if( shaped == true )
+            {
+                holdBackSend( pRing, pRing->tail, length, pNetworkContext->pParams->pPair->getTimeUs() );
+            }
+        }
+
+        bytesSent = ( int32_t ) length;
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
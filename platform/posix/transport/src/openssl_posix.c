@@ -20,18 +20,57 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+/* The PKCS #11 key bridge implements an EC_KEY_METHOD, which OpenSSL 3.0
+ * deprecates in favor of providers. */
+#if defined( OPENSSL_PKCS11_ENABLED ) && ( OPENSSL_PKCS11_ENABLED == 1 )
+    #define OPENSSL_SUPPRESS_DEPRECATED
+#endif
+
 /* Standard includes. */
 #include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-/* POSIX socket include. */
+/* POSIX includes. */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+/* CPU feature detection includes. */
+#if defined( __x86_64__ ) || defined( __i386__ )
+    #include <cpuid.h>
+#elif defined( __aarch64__ ) || defined( __arm__ )
+    #include <sys/auxv.h>
+#endif
 
 /* Transport interface include. */
 #include "transport_interface.h"
 
 #include "openssl_posix.h"
 #include <openssl/err.h>
+#include <openssl/ocsp.h>
+#include <openssl/sha.h>
+#include <openssl/x509v3.h>
+
+/* Allocator include. */
+#include "allocator.h"
+
+/* Trace probes of the handshake, sends and receives. */
+#include "trace_probes.h"
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+    #include <openssl/ec.h>
+
+    /* corePKCS11 include. */
+    #include "core_pkcs11.h"
+#endif
 
 /*-----------------------------------------------------------*/
 
@@ -50,6 +89,107 @@
  */
 #define CLIENT_KEY_LABEL     "client's key"
 
+/**
+ * @brief Scheme of a PKCS #11 URI, and the attribute holding the label of
+ * the object.
+ */
+#define PKCS11_URI_SCHEME              "pkcs11:"
+#define PKCS11_URI_OBJECT_ATTRIBUTE    "object="
+
+/**
+ * @brief Whether a credential path is a PKCS #11 URI.
+ */
+#define IS_PKCS11_URI( pPath )                                 \
+    ( ( ( pPath ) != NULL ) &&                                 \
+      ( strncmp( ( pPath ),                                    \
+                 PKCS11_URI_SCHEME,                            \
+                 sizeof( PKCS11_URI_SCHEME ) - 1U ) == 0 ) )
+
+/**
+ * @brief Suffix of the path of a DER bundle of root CAs.
+ */
+#define DER_BUNDLE_SUFFIX    ".der"
+
+/**
+ * @brief Whether a root CA path is a DER bundle.
+ */
+#define IS_DER_BUNDLE( pPath )                                                         \
+    ( ( strlen( pPath ) >= ( sizeof( DER_BUNDLE_SUFFIX ) - 1U ) ) &&                   \
+      ( strcmp( &( ( pPath )[ strlen( pPath ) - ( sizeof( DER_BUNDLE_SUFFIX ) - 1U ) ] ), \
+                DER_BUNDLE_SUFFIX ) == 0 ) )
+
+/**
+ * @brief Size of the largest ECDSA signature returned by the token, which
+ * is for the P-521 curve.
+ */
+#define PKCS11_MAX_ECDSA_SIGNATURE_LENGTH    ( 132U )
+
+/**
+ * @brief Whether OpenSSL supports kernel TLS offload, which requires
+ * OpenSSL 3.0 or later built without OPENSSL_NO_KTLS.
+ */
+#if defined( SSL_OP_ENABLE_KTLS ) && !defined( OPENSSL_NO_KTLS )
+    #define KTLS_SUPPORTED    1
+#else
+    #define KTLS_SUPPORTED    0
+#endif
+
+/**
+ * @brief TLS 1.3 cipher suites and TLS 1.2 ciphers of each AEAD, offered in
+ * the order set by #OpensslCredentials_t.cipherPolicy.
+ */
+#define TLS13_AES_GCM_SUITES     "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384"
+#define TLS13_CHACHA20_SUITES    "TLS_CHACHA20_POLY1305_SHA256"
+#define TLS12_AES_GCM_CIPHERS                                         \
+    "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"      \
+    "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:"      \
+    "DHE-RSA-AES128-GCM-SHA256:DHE-RSA-AES256-GCM-SHA384"
+#define TLS12_CHACHA20_CIPHERS                                        \
+    "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:"      \
+    "DHE-RSA-CHACHA20-POLY1305"
+
+/**
+ * @brief Bytes a record buffer of OpenSSL holds besides the plaintext of a
+ * record: its header and the largest encryption overhead.
+ */
+#define RECORD_BUFFER_OVERHEAD    ( SSL3_RT_HEADER_LENGTH + SSL3_RT_MAX_ENCRYPTED_OVERHEAD )
+
+/**
+ * @brief Number of seconds the clocks of the client and of the OCSP
+ * responder may differ by when checking the validity period of a stapled
+ * OCSP response.
+ */
+#define OCSP_MAX_CLOCK_SKEW_SECONDS    ( 300L )
+
+/**
+ * @brief First word of a file of #Openssl_OpenSharedSessionCache, which
+ * also tells the version of its layout.
+ */
+#define SHARED_SESSION_CACHE_MAGIC     ( 0x53534331U )
+
+/**
+ * @brief Size of the host name of a slot of the shared session cache, the
+ * terminating NUL included.
+ */
+#define SHARED_SESSION_HOST_SIZE       ( 256U )
+
+/**
+ * @brief Time until which an entry of the verification cache holds anything.
+ */
+#define VERIFY_CACHE_EXPIRY( pEntry )                               \
+    ( ( ( pEntry )->chainVerifiedUntil > ( pEntry )->ocspGoodUntil ) ? \
+      ( pEntry )->chainVerifiedUntil : ( pEntry )->ocspGoodUntil )
+
+/**
+ * @brief Count a call to SSL_read, SSL_write, SSL_sendfile or send made on a
+ * connection in its statistics.
+ */
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+    #define COUNT_IO_CALL( pOpensslParams )    ( ( pOpensslParams )->stats.ioCalls++ )
+#else
+    #define COUNT_IO_CALL( pOpensslParams )    ( ( void ) ( pOpensslParams ) )
+#endif
+
 /*-----------------------------------------------------------*/
 
 /* Each compilation unit must define the NetworkContext struct. */
@@ -58,6 +198,174 @@ struct NetworkContext
     OpensslParams_t * pParams;
 };
 
+/**
+ * @brief An SSL context kept by the SSL context cache, along with copies of
+ * the credential file paths it was built from.
+ */
+typedef struct SslContextCacheEntry
+{
+    char * pRootCaPath;           /**< @brief Copy of the filepath string to the trusted server root CA; NULL if none. */
+    char * pClientCertPath;       /**< @brief Copy of the filepath string to the client certificate; NULL if none. */
+    char * pPrivateKeyPath;       /**< @brief Copy of the filepath string to the client certificate's private key; NULL if none. */
+    bool cacheVerifiedChains;     /**< @brief Whether the context caches verified server chains. */
+    bool cacheSession;            /**< @brief Whether the context hands its new sessions to the session cache. */
+    SSL_CTX * pSslContext;        /**< @brief The cached SSL context. NULL if the entry is unused. */
+} SslContextCacheEntry_t;
+
+/**
+ * @brief A TLS session kept by the session cache, along with the server and
+ * the SSL context it was issued for.
+ */
+typedef struct SessionCacheEntry
+{
+    SSL_SESSION * pSession; /**< @brief The cached session. NULL if the entry is unused. */
+    SSL_CTX * pSslContext;  /**< @brief SSL context of the connection the session was issued on. The entry holds a reference to it. */
+    uint16_t port;          /**< @brief Port of the server that issued the session. */
+} SessionCacheEntry_t;
+
+/**
+ * @brief A server certificate kept by the verification cache, with how long
+ * its chain and its OCSP status are trusted.
+ */
+typedef struct VerifyCacheEntry
+{
+    uint8_t fingerprint[ SHA256_DIGEST_LENGTH ]; /**< @brief SHA-256 fingerprint of the server certificate. */
+    time_t chainVerifiedUntil;                   /**< @brief Time until which the chain is trusted without being verified. */
+    time_t ocspGoodUntil;                        /**< @brief Time until which the certificate is known not to be revoked. */
+    bool used;                                   /**< @brief Whether the entry holds a certificate. */
+} VerifyCacheEntry_t;
+
+/**
+ * @brief A slot of the shared session cache, holding the TLS session of a
+ * server host.
+ *
+ * The slot is a sequence lock: a writer makes #SharedSessionSlot_t.sequence
+ * odd while it writes the slot, and a reader only keeps what it copied if
+ * the sequence was even and did not change meanwhile.
+ */
+typedef struct SharedSessionSlot
+{
+    uint32_t sequence;                                    /**< @brief Odd while a process writes the slot, incremented by 2 by each write. */
+    uint32_t sessionLength;                               /**< @brief Length of #SharedSessionSlot_t.session; 0 if the slot is free. */
+    char hostName[ SHARED_SESSION_HOST_SIZE ];            /**< @brief SNI host of the session, NUL-terminated. */
+    uint8_t session[ OPENSSL_SHARED_SESSION_MAX_LENGTH ]; /**< @brief DER encoding of the session. */
+} SharedSessionSlot_t;
+
+/**
+ * @brief Layout of the file of #Openssl_OpenSharedSessionCache.
+ */
+typedef struct SharedSessionCache
+{
+    uint32_t magic;                                            /**< @brief #SHARED_SESSION_CACHE_MAGIC once the file is laid out; 0 in a new file. */
+    uint32_t slotCount;                                        /**< @brief #OPENSSL_SHARED_SESSION_SLOTS of the process that laid out the file. */
+    uint32_t sessionSize;                                      /**< @brief #OPENSSL_SHARED_SESSION_MAX_LENGTH of the process that laid out the file. */
+    uint32_t nextVictim;                                       /**< @brief Counter choosing the slot replaced when none is free. */
+    SharedSessionSlot_t slots[ OPENSSL_SHARED_SESSION_SLOTS ]; /**< @brief The slots. */
+} SharedSessionCache_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief SSL contexts that are reused by #Openssl_Connect when
+ * #OpensslCredentials_t.cacheSslContext is set.
+ *
+ * Each entry holds one reference to its SSL context. Every SSL object created
+ * from the context holds another, so a context stays alive until both the
+ * entry is released and all connections using it have been disconnected.
+ */
+static SslContextCacheEntry_t sslContextCache[ OPENSSL_SSL_CONTEXT_CACHE_SIZE ];
+
+/**
+ * @brief Mutex protecting #sslContextCache.
+ */
+static pthread_mutex_t sslContextCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief TLS sessions offered by #Openssl_Connect when
+ * #OpensslCredentials_t.cacheSession is set, at most one per SNI host and
+ * port.
+ *
+ * Each entry holds one reference to its session and one to the SSL context
+ * the session was issued on. Entries are keyed by the host name recorded in
+ * the session itself, the port of the server and the SSL context, so that a
+ * session is only resumed with the credentials it was established with.
+ */
+static SessionCacheEntry_t tlsSessionCache[ OPENSSL_SESSION_CACHE_SIZE ];
+
+/**
+ * @brief Mutex protecting #tlsSessionCache.
+ */
+static pthread_mutex_t tlsSessionCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief File of #Openssl_OpenSharedSessionCache mapped in memory; NULL if no
+ * shared session cache is open.
+ */
+static SharedSessionCache_t * pSharedSessionCache = NULL;
+
+/**
+ * @brief Server certificates whose chain was verified with
+ * #OpensslCredentials_t.cacheVerifiedChains, or whose OCSP status was found
+ * good with #OpensslCredentials_t.ocspMode.
+ */
+static VerifyCacheEntry_t verifyCache[ OPENSSL_VERIFY_CACHE_SIZE ];
+
+/**
+ * @brief Mutex protecting #verifyCache.
+ */
+static pthread_mutex_t verifyCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Whether the CPU has AES and carry-less multiply instructions, which
+ * make AES-GCM faster than ChaCha20-Poly1305. Detected once, by the first
+ * connection with #OPENSSL_CIPHERS_AUTO.
+ */
+static bool aesGcmAccelerated = true;
+
+/**
+ * @brief Whether #aesGcmAccelerated is detected.
+ */
+static pthread_once_t cpuFeaturesOnce = PTHREAD_ONCE_INIT;
+
+#if ( OPENSSL_MINIMAL_INIT == 1 )
+
+/**
+ * @brief Whether OpenSSL is initialized, by the first SSL context created.
+ */
+    static pthread_once_t opensslInitOnce = PTHREAD_ONCE_INIT;
+#endif
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+
+/**
+ * @brief PKCS #11 session shared by every connection whose private key is on
+ * the token, so that the session is opened and logged in to only once.
+ */
+    static CK_SESSION_HANDLE pkcs11Session = CK_INVALID_HANDLE;
+
+/**
+ * @brief Function list of the PKCS #11 module.
+ */
+    static CK_FUNCTION_LIST_PTR pPkcs11FunctionList = NULL;
+
+/**
+ * @brief Key method that signs with the token, shared by every token key.
+ */
+    static EC_KEY_METHOD * pPkcs11EcKeyMethod = NULL;
+
+/**
+ * @brief Index of the EC_KEY ex_data holding the PKCS #11 object handle of
+ * the private key.
+ */
+    static int pkcs11KeyHandleIndex = -1;
+
+/**
+ * @brief Mutex protecting the PKCS #11 state above and serializing the
+ * operations on #pkcs11Session.
+ */
+    static pthread_mutex_t pkcs11Mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif /* if ( OPENSSL_PKCS11_ENABLED == 1 ) */
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -71,6 +379,26 @@ struct NetworkContext
                          const char * fileType );
 #endif /* #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG ) */
 
+#if ( OPENSSL_MINIMAL_INIT == 1 )
+
+/**
+ * @brief Initialize OpenSSL without its configuration file, and without its
+ * error strings when the transport does not log.
+ */
+    static void initOpenssl( void );
+#endif
+
+/**
+ * @brief Add the certificates of a DER bundle to a certificate store.
+ *
+ * @param[out] pStore The certificate store.
+ * @param[in] pBundlePath Filepath string to the DER bundle.
+ *
+ * @return 1 on success; -1 on failure.
+ */
+static int32_t addDerBundle( X509_STORE * pStore,
+                             const char * pBundlePath );
+
 /**
  * @brief Add X509 certificate to the trusted list of root certificates.
  *
@@ -79,10 +407,53 @@ struct NetworkContext
  * root certificate.
  *
  * @param[out] pSslContext SSL context to which the trusted server root CA is to be added.
- * @param[in] pRootCaPath Filepath string to the trusted server root CA.
+ * @param[in] pRootCaPath Filepath string to the trusted server root CA, to a
+ * DER bundle of root CAs, or its PKCS #11 URI.
  *
  * @return 1 on success; -1, 0 on failure;
  */
+/**
+ * @brief Allocate a block for OpenSSL from the allocator, as the malloc
+ * function of CRYPTO_set_mem_functions.
+ *
+ * @param[in] size Size of the block.
+ * @param[in] pFile Unused.
+ * @param[in] line Unused.
+ *
+ * @return The block; NULL if there is no memory.
+ */
+static void * opensslMalloc( size_t size,
+                             const char * pFile,
+                             int line );
+
+/**
+ * @brief Resize a block of OpenSSL, as the realloc function of
+ * CRYPTO_set_mem_functions.
+ *
+ * @param[in] pBlock The block.
+ * @param[in] size New size of the block.
+ * @param[in] pFile Unused.
+ * @param[in] line Unused.
+ *
+ * @return The new block; NULL if there is no memory.
+ */
+static void * opensslRealloc( void * pBlock,
+                              size_t size,
+                              const char * pFile,
+                              int line );
+
+/**
+ * @brief Free a block of OpenSSL, as the free function of
+ * CRYPTO_set_mem_functions.
+ *
+ * @param[in] pBlock The block.
+ * @param[in] pFile Unused.
+ * @param[in] line Unused.
+ */
+static void opensslFree( void * pBlock,
+                         const char * pFile,
+                         int line );
+
 static int32_t setRootCa( const SSL_CTX * pSslContext,
                           const char * pRootCaPath );
 
@@ -90,7 +461,8 @@ static int32_t setRootCa( const SSL_CTX * pSslContext,
  * @brief Set X509 certificate as client certificate for the server to authenticate.
  *
  * @param[out] pSslContext SSL context to which the client certificate is to be set.
- * @param[in] pClientCertPath Filepath string to the client certificate.
+ * @param[in] pClientCertPath Filepath string to the client certificate, or
+ * its PKCS #11 URI.
  *
  * @return 1 on success; 0 failure;
  */
@@ -108,6 +480,72 @@ static int32_t setClientCertificate( SSL_CTX * pSslContext,
 static int32_t setPrivateKey( SSL_CTX * pSslContext,
                               const char * pPrivateKeyPath );
 
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+
+/**
+ * @brief Extract the label of the object named by a PKCS #11 URI.
+ *
+ * @param[in] pUri PKCS #11 URI, starting with #PKCS11_URI_SCHEME.
+ * @param[out] pLabel Buffer of #OPENSSL_PKCS11_MAX_LABEL_LENGTH bytes
+ * receiving the percent-decoded label, which is not NULL-terminated.
+ *
+ * @return Length of the label; 0 if the URI has no valid object attribute.
+ */
+    static size_t parsePkcs11Label( const char * pUri,
+                                    char * pLabel );
+
+/**
+ * @brief Open and log in to #pkcs11Session if it is not open yet.
+ *
+ * @note #pkcs11Mutex must be held.
+ *
+ * @return CKR_OK on success; the PKCS #11 error otherwise.
+ */
+    static CK_RV openPkcs11Session( void );
+
+/**
+ * @brief Sign a digest with the private key on the token. Used as the
+ * sign_sig function of #pPkcs11EcKeyMethod.
+ *
+ * @param[in] pDigest Digest to sign.
+ * @param[in] digestLength Length of @p pDigest.
+ * @param[in] pInvK Unused precomputed value.
+ * @param[in] pR Unused precomputed value.
+ * @param[in] pEcKey Key whose private key is on the token.
+ *
+ * @return The signature; NULL on failure.
+ */
+    static ECDSA_SIG * pkcs11EcdsaSign( const unsigned char * pDigest,
+                                        int digestLength,
+                                        const BIGNUM * pInvK,
+                                        const BIGNUM * pR,
+                                        EC_KEY * pEcKey );
+
+/**
+ * @brief Set a private key held by the token as the key of the client's
+ * certificate.
+ *
+ * The public key is taken from the client certificate of @p pSslContext, and
+ * signing is forwarded to the token through #pPkcs11EcKeyMethod.
+ *
+ * @param[out] pSslContext SSL context with the client certificate set.
+ * @param[in] pPrivateKeyUri PKCS #11 URI of the private key.
+ *
+ * @return 1 on success; 0 on failure;
+ */
+    static int32_t setPkcs11PrivateKey( SSL_CTX * pSslContext,
+                                        const char * pPrivateKeyUri );
+
+/**
+ * @brief Read a certificate from the token and parse its DER value.
+ *
+ * @param[in] pCertificateUri PKCS #11 URI of the certificate.
+ *
+ * @return The certificate, to be freed by the caller; NULL on failure.
+ */
+    static X509 * readPkcs11Certificate( const char * pCertificateUri );
+#endif /* if ( OPENSSL_PKCS11_ENABLED == 1 ) */
+
 /**
  * @brief Passes TLS credentials to the OpenSSL library.
  *
@@ -123,10 +561,190 @@ static int32_t setPrivateKey( SSL_CTX * pSslContext,
 static int32_t setCredentials( SSL_CTX * pSslContext,
                                const OpensslCredentials_t * pOpensslCredentials );
 
+/**
+ * @brief Create a new SSL context and import the TLS credentials into it.
+ *
+ * @param[in] pOpensslCredentials TLS credentials to be imported.
+ * @param[out] ppSslContext The created SSL context.
+ *
+ * @return #OPENSSL_SUCCESS, #OPENSSL_API_ERROR, and #OPENSSL_INVALID_CREDENTIALS.
+ */
+static OpensslStatus_t createSslContext( const OpensslCredentials_t * pOpensslCredentials,
+                                         SSL_CTX ** ppSslContext );
+
+/**
+ * @brief Check whether two optional paths are equal.
+ *
+ * @param[in] pPath1 First path, may be NULL.
+ * @param[in] pPath2 Second path, may be NULL.
+ *
+ * @return 1 if both paths are NULL or the strings match; 0 otherwise.
+ */
+static uint8_t isSamePath( const char * pPath1,
+                           const char * pPath2 );
+
+/**
+ * @brief Find the SSL context cache entry built from the given credentials.
+ *
+ * @note #sslContextCacheMutex must be held by the caller.
+ *
+ * @param[in] pOpensslCredentials Credentials whose paths are used as the key.
+ *
+ * @return The matching entry, or NULL if none was found.
+ */
+static SslContextCacheEntry_t * findCachedSslContext( const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Copy an optional credential path into an SSL context cache entry.
+ *
+ * @param[in] pPath The path, may be NULL.
+ * @param[out] ppCopy The copy, which must be released with Allocator_Free;
+ * NULL if @p pPath is NULL or there is no memory.
+ *
+ * @return 1 if @p pPath is NULL or was copied; 0 if there is no memory.
+ */
+static uint8_t copyCachedPath( const char * pPath,
+                               char ** ppCopy );
+
+/**
+ * @brief Release an SSL context cache entry: drop its reference to the SSL
+ * context and free the copies of the paths.
+ *
+ * @note #sslContextCacheMutex must be held by the caller.
+ *
+ * @param[in] pEntry The entry, which is unused afterwards.
+ */
+static void releaseCachedSslContext( SslContextCacheEntry_t * pEntry );
+
+/**
+ * @brief Get an SSL context for the given credentials, reusing a cached one
+ * if #OpensslCredentials_t.cacheSslContext is set.
+ *
+ * The caller owns one reference to the returned context and must release it
+ * with SSL_CTX_free.
+ *
+ * @param[in] pOpensslCredentials TLS credentials for the context.
+ * @param[out] ppSslContext The SSL context.
+ *
+ * @return #OPENSSL_SUCCESS, #OPENSSL_API_ERROR, and #OPENSSL_INVALID_CREDENTIALS.
+ */
+static OpensslStatus_t acquireSslContext( const OpensslCredentials_t * pOpensslCredentials,
+                                          SSL_CTX ** ppSslContext );
+
+/**
+ * @brief Hand the new client sessions of an SSL context to
+ * #newSessionCallback rather than to the internal session cache of the
+ * context.
+ *
+ * @note The context must not be in use by another thread: this is called
+ * once, when the context is created.
+ *
+ * @param[in] pSslContext The new SSL context.
+ */
+static void setupSessionCache( SSL_CTX * pSslContext );
+
+/**
+ * @brief Find the cached TLS session for a server.
+ *
+ * @note #tlsSessionCacheMutex must be held by the caller.
+ *
+ * @param[in] pHostName NULL-terminated host name of the server.
+ * @param[in] port Port of the server.
+ * @param[in] pSslContext SSL context the session must have been issued on,
+ * or NULL for a session issued on any context.
+ *
+ * @return The cache entry holding the session, or NULL if no session is
+ * cached for the server and @p pSslContext.
+ */
+static SessionCacheEntry_t * findCachedSession( const char * pHostName,
+                                                uint16_t port,
+                                                const SSL_CTX * pSslContext );
+
+/**
+ * @brief Release a session cache entry: drop its references to the session
+ * and to the SSL context.
+ *
+ * @note #tlsSessionCacheMutex must be held by the caller.
+ *
+ * @param[in] pEntry The entry, which is unused afterwards.
+ */
+static void releaseCachedSession( SessionCacheEntry_t * pEntry );
+
+/**
+ * @brief Read a TLS session saved by #writeSessionFile.
+ *
+ * @param[in] pSessionFilePath Filepath string to the session file.
+ *
+ * @return The session, which the caller must free; NULL if the file does not
+ * exist or could not be parsed.
+ */
+static SSL_SESSION * readSessionFile( const char * pSessionFilePath );
+
+/**
+ * @brief Persist a TLS session to a file in PEM format.
+ *
+ * @param[in] pSession The session to save.
+ * @param[in] pSessionFilePath Filepath string to the session file.
+ */
+static void writeSessionFile( const SSL_SESSION * pSession,
+                              const char * pSessionFilePath );
+
+/**
+ * @brief Read the TLS session of a server host from the shared session
+ * cache.
+ *
+ * @note #pSharedSessionCache must not be NULL.
+ *
+ * @param[in] pHostName NULL-terminated host name of the server.
+ *
+ * @return The session, which the caller must free; NULL if no session of
+ * @p pHostName could be read.
+ */
+static SSL_SESSION * readSharedSession( const char * pHostName );
+
+/**
+ * @brief Write a TLS session to the slot of its host in the shared session
+ * cache, unless another process is writing the slot.
+ *
+ * @note #pSharedSessionCache must not be NULL.
+ *
+ * @param[in] pSession The session.
+ * @param[in] pHostName NULL-terminated host name of the session.
+ */
+static void writeSharedSession( SSL_SESSION * pSession,
+                                const char * pHostName );
+
+/**
+ * @brief Callback invoked by OpenSSL when the server issues a new TLS
+ * session, either during the handshake or, for TLS 1.3, in a post-handshake
+ * message processed by SSL_read.
+ *
+ * @param[in] pSsl The SSL object the session was issued on.
+ * @param[in] pSession The new session.
+ *
+ * @return 1 if the session was kept by the cache; 0 otherwise, in which case
+ * OpenSSL releases it.
+ */
+static int newSessionCallback( SSL * pSsl,
+                               SSL_SESSION * pSession );
+
+/**
+ * @brief Enable TLS session caching on a new SSL object and offer the
+ * session cached for the SNI host and port, if any, to the server.
+ *
+ * @param[in] pSslContext SSL context the SSL object was created from, which
+ * a session cached in memory must have been issued on.
+ * @param[in] pOpensslParams Parameters of the TLS connection.
+ * @param[in] pOpensslCredentials TLS credentials containing configurations.
+ */
+static void setupSessionResumption( SSL_CTX * pSslContext,
+                                    OpensslParams_t * pOpensslParams,
+                                    const OpensslCredentials_t * pOpensslCredentials );
+
 /**
  * @brief Set optional configurations for the TLS connection.
  *
- * This function is used to set SNI, MFLN, and ALPN protocols.
+ * This function is used to set SNI, MFLN, ALPN protocols and the cipher order.
  *
  * @param[in] pSsl SSL context to which the optional configurations are to be set.
  * @param[in] pOpensslCredentials TLS credentials containing configurations.
@@ -134,6 +752,21 @@ static int32_t setCredentials( SSL_CTX * pSslContext,
 static void setOptionalConfigurations( SSL * pSsl,
                                        const OpensslCredentials_t * pOpensslCredentials );
 
+/**
+ * @brief Detect whether the CPU accelerates AES-GCM, setting
+ * #aesGcmAccelerated.
+ */
+static void detectCpuFeatures( void );
+
+/**
+ * @brief Offer the AEAD cipher suites in the order of a cipher policy.
+ *
+ * @param[in] pSsl SSL object of the connection.
+ * @param[in] cipherPolicy The order to offer the cipher suites in.
+ */
+static void setCipherOrder( SSL * pSsl,
+                            OpensslCipherPolicy_t cipherPolicy );
+
 /**
  * @brief Converts the sockets wrapper status to openssl status.
  *
@@ -157,8 +790,245 @@ static OpensslStatus_t tlsHandshake( const ServerInfo_t * pServerInfo,
                                      OpensslParams_t * pOpensslParams,
                                      const OpensslCredentials_t * pOpensslCredentials );
 
-/*-----------------------------------------------------------*/
-
+/**
+ * @brief Create the SSL object of a new connection from an SSL context that
+ * is created, or reused from the cache, for the credentials.
+ *
+ * @param[in] pServerInfo Server connection info.
+ * @param[out] pOpensslParams Parameters of the TLS connection.
+ * @param[in] pOpensslCredentials TLS credentials containing configurations.
+ *
+ * @return #OPENSSL_SUCCESS, #OPENSSL_API_ERROR, and #OPENSSL_INVALID_CREDENTIALS.
+ */
+static OpensslStatus_t createSslObject( const ServerInfo_t * pServerInfo,
+                                        OpensslParams_t * pOpensslParams,
+                                        const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Configure the SSL object for the handshake with the server.
+ *
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pOpensslParams Parameters of the TLS connection.
+ * @param[in] pOpensslCredentials TLS credentials containing configurations.
+ *
+ * @return #OPENSSL_SUCCESS and #OPENSSL_API_ERROR.
+ */
+static OpensslStatus_t setupSslObject( const ServerInfo_t * pServerInfo,
+                                       const OpensslParams_t * pOpensslParams,
+                                       const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Check the result of the verification of the server's certificate.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS connection.
+ *
+ * @return #OPENSSL_SUCCESS and #OPENSSL_HANDSHAKE_FAILED.
+ */
+static OpensslStatus_t verifyPeerCertificate( const OpensslParams_t * pOpensslParams );
+
+/**
+ * @brief Compute the SHA-256 fingerprint that keys a certificate in
+ * #verifyCache.
+ *
+ * @param[in] pCertificate The certificate.
+ * @param[out] pFingerprint Buffer of SHA256_DIGEST_LENGTH bytes.
+ *
+ * @return true on success; false otherwise.
+ */
+static bool getFingerprint( const X509 * pCertificate,
+                            uint8_t * pFingerprint );
+
+/**
+ * @brief Find the entry of a certificate in #verifyCache.
+ *
+ * @note #verifyCacheMutex must be held by the caller.
+ *
+ * @param[in] pFingerprint Fingerprint of the certificate.
+ * @param[in] allocate Whether to take over a free or the stalest entry for
+ * the certificate when it has none.
+ *
+ * @return The entry; NULL if there is none and @p allocate is false.
+ */
+static VerifyCacheEntry_t * findVerifyCacheEntry( const uint8_t * pFingerprint,
+                                                  bool allocate );
+
+/**
+ * @brief Certificate verification callback of SSL contexts with
+ * #OpensslCredentials_t.cacheVerifiedChains set. Builds and verifies the
+ * server chain unless the server certificate was verified recently.
+ *
+ * @param[in] pStoreContext The verification context of the handshake.
+ * @param[in] pArg Unused.
+ *
+ * @return 1 if the chain is trusted; 0 otherwise.
+ */
+static int verifyCertificateChain( X509_STORE_CTX * pStoreContext,
+                                   void * pArg );
+
+/**
+ * @brief Find the issuer of the server certificate, in the chain sent by the
+ * server or else among the trusted root CAs.
+ *
+ * @param[in] pSsl The SSL object of the connection.
+ * @param[in] pLeaf The server certificate.
+ * @param[in] pChain The chain sent by the server.
+ *
+ * @return A new reference to the issuer; NULL if it is not found.
+ */
+static X509 * findIssuer( const SSL * pSsl,
+                          X509 * pLeaf,
+                          STACK_OF( X509 ) * pChain );
+
+/**
+ * @brief Check the stapled OCSP response for the server certificate.
+ *
+ * @param[in] pSsl The SSL object of the connection.
+ * @param[in] pLeaf The server certificate.
+ * @param[in] pChain The chain sent by the server.
+ * @param[in] pResponse The DER encoded OCSP response.
+ * @param[in] responseLength Length of @p pResponse.
+ * @param[out] pGoodUntil Time until which the good status holds.
+ *
+ * @return #OPENSSL_SUCCESS if the certificate is good;
+ * #OPENSSL_HANDSHAKE_FAILED if it is revoked or the response is invalid.
+ */
+static OpensslStatus_t checkStapledResponse( const SSL * pSsl,
+                                             X509 * pLeaf,
+                                             STACK_OF( X509 ) * pChain,
+                                             const uint8_t * pResponse,
+                                             long responseLength,
+                                             time_t * pGoodUntil );
+
+/**
+ * @brief Check the revocation status of the server certificate after a full
+ * handshake, as set by #OpensslCredentials_t.ocspMode.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS connection.
+ * @param[in] ocspMode Whether a good status is requested or required.
+ *
+ * @return #OPENSSL_SUCCESS and #OPENSSL_HANDSHAKE_FAILED.
+ */
+static OpensslStatus_t checkRevocation( const OpensslParams_t * pOpensslParams,
+                                        OpensslOcspMode_t ocspMode );
+
+/**
+ * @brief Find out whether the kernel took over the TLS record layer of a
+ * connection after its handshake.
+ *
+ * @param[in] pOpensslParams Parameters of the established connection.
+ * @param[in] pOpensslCredentials Credentials of the connection.
+ */
+static void detectKtlsOffload( OpensslParams_t * pOpensslParams,
+                               const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Advance a non-blocking TLS handshake.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS connection.
+ *
+ * @return #OPENSSL_SUCCESS once the handshake completed; #OPENSSL_WANT_READ,
+ * #OPENSSL_WANT_WRITE while it is in progress; #OPENSSL_HANDSHAKE_FAILED and
+ * #OPENSSL_API_ERROR on failure.
+ */
+static OpensslStatus_t continueTlsHandshake( OpensslParams_t * pOpensslParams );
+
+/**
+ * @brief Send #OpensslCredentials_t.pEarlyData as TLS 1.3 early data if it
+ * is replay-safe and the resumed session allows it. Must be called before
+ * SSL_connect.
+ *
+ * @param[in] pOpensslParams Parameters of the connection.
+ * @param[in] pOpensslCredentials Credentials holding the early data.
+ *
+ * @return The number of bytes sent as early data, 0 if none.
+ */
+static size_t writeEarlyData( const OpensslParams_t * pOpensslParams,
+                              const OpensslCredentials_t * pOpensslCredentials );
+
+/**
+ * @brief Once the handshake completes, send the part of
+ * #OpensslCredentials_t.pEarlyData the server did not accept as early data.
+ *
+ * @param[in] pOpensslParams Parameters of the connection.
+ * @param[in] pOpensslCredentials Credentials holding the early data.
+ * @param[in] earlyDataWritten Value returned by #writeEarlyData.
+ *
+ * @return #OPENSSL_SUCCESS if all the data was sent; #OPENSSL_API_ERROR
+ * otherwise.
+ */
+static OpensslStatus_t completeEarlyData( OpensslParams_t * pOpensslParams,
+                                          const OpensslCredentials_t * pOpensslCredentials,
+                                          size_t earlyDataWritten );
+
+/**
+ * @brief Advance a connection started with #Openssl_ConnectStart after a step
+ * of its TCP connection, starting the TLS handshake once it is established.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS connection.
+ * @param[in] socketStatus Status of the TCP connection step.
+ *
+ * @return The status of the connection.
+ */
+static OpensslStatus_t advanceConnection( OpensslParams_t * pOpensslParams,
+                                          SocketStatus_t socketStatus );
+
+/**
+ * @brief Log the outcome of a step of a connection started with
+ * #Openssl_ConnectStart, and release its resources if it failed.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS connection.
+ * @param[in] connectStatus Status of the connection step.
+ *
+ * @return @p connectStatus.
+ */
+static OpensslStatus_t finishConnectStep( OpensslParams_t * pOpensslParams,
+                                          OpensslStatus_t connectStatus );
+
+/**
+ * @brief Read decrypted data from the TLS session.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS session.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Size of @p pBuffer.
+ *
+ * @return Number of bytes received if successful; 0 if the read can be
+ * retried; negative value on error.
+ */
+static int32_t recvFromSsl( OpensslParams_t * pOpensslParams,
+                            void * pBuffer,
+                            size_t bytesToRecv );
+
+/**
+ * @brief Serve a receive request through the read-ahead buffer of the
+ * TLS session, refilling it with a single SSL_read when it is empty.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS session.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes copied into @p pBuffer if successful; 0 if the read
+ * can be retried; negative value on error.
+ */
+static int32_t recvBuffered( OpensslParams_t * pOpensslParams,
+                             uint8_t * pBuffer,
+                             size_t bytesToRecv );
+
+/**
+ * @brief Send data on a connection whose TLS record layer is handled by the
+ * kernel, with a plain send on the socket.
+ *
+ * @param[in] pOpensslParams Parameters of the TLS session.
+ * @param[in] pBuffer Buffer containing the bytes to send.
+ * @param[in] bytesToSend Number of bytes to send.
+ *
+ * @return Number of bytes sent if successful; negative value on error.
+ */
+static int32_t sendWithKtls( OpensslParams_t * pOpensslParams,
+                             const void * pBuffer,
+                             size_t bytesToSend );
+
+/*-----------------------------------------------------------*/
+
 #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
     static void logPath( const char * path,
                          const char * fileType )
@@ -215,6 +1085,18 @@ static OpensslStatus_t convertToOpensslStatus( SocketStatus_t socketStatus )
             opensslStatus = OPENSSL_CONNECT_FAILURE;
             break;
 
+        case SOCKETS_INSUFFICIENT_MEMORY:
+            opensslStatus = OPENSSL_INSUFFICIENT_MEMORY;
+            break;
+
+        case SOCKETS_API_ERROR:
+            opensslStatus = OPENSSL_API_ERROR;
+            break;
+
+        case SOCKETS_WANT_WRITE:
+            opensslStatus = OPENSSL_WANT_WRITE;
+            break;
+
         default:
             LogError( ( "Unexpected status received from socket wrapper: Socket status = %u",
                         socketStatus ) );
@@ -225,12 +1107,60 @@ static OpensslStatus_t convertToOpensslStatus( SocketStatus_t socketStatus )
 }
 /*-----------------------------------------------------------*/
 
-static OpensslStatus_t tlsHandshake( const ServerInfo_t * pServerInfo,
-                                     OpensslParams_t * pOpensslParams,
-                                     const OpensslCredentials_t * pOpensslCredentials )
+static OpensslStatus_t createSslObject( const ServerInfo_t * pServerInfo,
+                                        OpensslParams_t * pOpensslParams,
+                                        const OpensslCredentials_t * pOpensslCredentials )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    SSL_CTX * pSslContext = NULL;
+
+    pOpensslParams->pSsl = NULL;
+    pOpensslParams->serverPort = pServerInfo->port;
+    pOpensslParams->ktlsSendEnabled = false;
+    pOpensslParams->ktlsRecvEnabled = false;
+    pOpensslParams->earlyDataAccepted = false;
+    pOpensslParams->maxSendFragment = pOpensslCredentials->maxFragmentLength;
+
+    /* Create SSL context, or reuse a cached one. */
+    returnStatus = acquireSslContext( pOpensslCredentials, &pSslContext );
+
+    /* Create a new SSL session. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        pOpensslParams->pSsl = SSL_new( pSslContext );
+
+        if( pOpensslParams->pSsl == NULL )
+        {
+            LogError( ( "SSL_new failed to create a new SSL context." ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+    }
+
+    /* Offer a cached TLS session to skip the full handshake. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) &&
+        ( pOpensslCredentials->cacheSession == true ) &&
+        ( pOpensslCredentials->sniHostName != NULL ) )
+    {
+        setupSessionResumption( pSslContext, pOpensslParams, pOpensslCredentials );
+    }
+
+    /* Release the reference to the SSL context. The SSL object holds its
+     * own reference while the connection is open. */
+    if( pSslContext != NULL )
+    {
+        SSL_CTX_free( pSslContext );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t setupSslObject( const ServerInfo_t * pServerInfo,
+                                       const OpensslParams_t * pOpensslParams,
+                                       const OpensslCredentials_t * pOpensslCredentials )
 {
     OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
-    int32_t sslStatus = -1, verifyPeerCertStatus = X509_V_OK;
+    int32_t sslStatus = -1;
 
     /* Validate the hostname against the server's certificate. */
     sslStatus = SSL_set1_host( pOpensslParams->pSsl,
@@ -257,586 +1187,3654 @@ static OpensslStatus_t tlsHandshake( const ServerInfo_t * pServerInfo,
         }
     }
 
-    /* Perform the TLS handshake. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
         setOptionalConfigurations( pOpensslParams->pSsl, pOpensslCredentials );
+    }
 
-        sslStatus = SSL_connect( pOpensslParams->pSsl );
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
 
-        if( sslStatus != 1 )
-        {
-            LogError( ( "SSL_connect failed to perform TLS handshake." ) );
-            returnStatus = OPENSSL_HANDSHAKE_FAILED;
-        }
-    }
+static OpensslStatus_t verifyPeerCertificate( const OpensslParams_t * pOpensslParams )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    int32_t verifyPeerCertStatus = X509_V_OK;
 
-    /* Verify X509 certificate from peer. */
-    if( returnStatus == OPENSSL_SUCCESS )
-    {
-        verifyPeerCertStatus = ( int32_t ) SSL_get_verify_result( pOpensslParams->pSsl );
+    verifyPeerCertStatus = ( int32_t ) SSL_get_verify_result( pOpensslParams->pSsl );
 
-        if( verifyPeerCertStatus != X509_V_OK )
-        {
-            LogError( ( "SSL_get_verify_result failed to verify X509 "
-                        "certificate from peer." ) );
-            returnStatus = OPENSSL_HANDSHAKE_FAILED;
-        }
+    if( verifyPeerCertStatus != X509_V_OK )
+    {
+        LogError( ( "SSL_get_verify_result failed to verify X509 "
+                    "certificate from peer." ) );
+        returnStatus = OPENSSL_HANDSHAKE_FAILED;
     }
 
     return returnStatus;
 }
+/*-----------------------------------------------------------*/
 
-static int32_t setRootCa( const SSL_CTX * pSslContext,
-                          const char * pRootCaPath )
+static bool getFingerprint( const X509 * pCertificate,
+                            uint8_t * pFingerprint )
 {
-    int32_t sslStatus = 1;
-    FILE * pRootCaFile = NULL;
-    X509 * pRootCa = NULL;
+    uint32_t fingerprintLength = 0U;
 
-    assert( pSslContext != NULL );
-    assert( pRootCaPath != NULL );
+    assert( pCertificate != NULL );
+    assert( pFingerprint != NULL );
 
-    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
-        logPath( pRootCaPath, ROOT_CA_LABEL );
-    #endif
+    return ( ( X509_digest( pCertificate, EVP_sha256(), pFingerprint, &fingerprintLength ) == 1 ) &&
+             ( fingerprintLength == SHA256_DIGEST_LENGTH ) ) ? true : false;
+}
+/*-----------------------------------------------------------*/
 
-    /* MISRA Rule 21.6 flags the following line for using the standard
-     * library input/output function `fopen()`. This rule is suppressed because
-     * openssl function #PEM_read_X509 takes an argument of type `FILE *` for
-     * reading the root ca PEM file and `fopen()` needs to be used to get the
-     * file pointer.  */
-    /* coverity[misra_c_2012_rule_21_6_violation] */
-    pRootCaFile = fopen( pRootCaPath, "r" );
+static VerifyCacheEntry_t * findVerifyCacheEntry( const uint8_t * pFingerprint,
+                                                  bool allocate )
+{
+    VerifyCacheEntry_t * pEntry = NULL;
+    VerifyCacheEntry_t * pStalest = NULL;
+    size_t i = 0U;
 
-    if( pRootCaFile == NULL )
-    {
-        LogError( ( "fopen failed to find the root CA certificate file: "
-                    "ROOT_CA_PATH=%s.",
-                    pRootCaPath ) );
-        sslStatus = -1;
-    }
+    assert( pFingerprint != NULL );
 
-    if( sslStatus == 1 )
+    for( i = 0U; i < OPENSSL_VERIFY_CACHE_SIZE; i++ )
     {
-        /* Read the root CA into an X509 object. */
-        pRootCa = PEM_read_X509( pRootCaFile, NULL, NULL, NULL );
+        if( ( verifyCache[ i ].used == true ) &&
+            ( memcmp( verifyCache[ i ].fingerprint, pFingerprint, SHA256_DIGEST_LENGTH ) == 0 ) )
+        {
+            pEntry = &verifyCache[ i ];
+            break;
+        }
 
-        if( pRootCa == NULL )
+        /* Take over a free entry, or else the one that expires first. */
+        if( ( pStalest == NULL ) ||
+            ( ( pStalest->used == true ) &&
+              ( ( verifyCache[ i ].used == false ) ||
+                ( VERIFY_CACHE_EXPIRY( &verifyCache[ i ] ) < VERIFY_CACHE_EXPIRY( pStalest ) ) ) ) )
         {
-            LogError( ( "PEM_read_X509 failed to parse root CA." ) );
-            sslStatus = -1;
+            pStalest = &verifyCache[ i ];
         }
     }
 
-    if( sslStatus == 1 )
+    if( ( pEntry == NULL ) && ( allocate == true ) )
     {
-        /* Add the certificate to the context. */
-        sslStatus = X509_STORE_add_cert( SSL_CTX_get_cert_store( pSslContext ),
-                                         pRootCa );
+        pEntry = pStalest;
+        ( void ) memcpy( pEntry->fingerprint, pFingerprint, SHA256_DIGEST_LENGTH );
+        pEntry->chainVerifiedUntil = 0;
+        pEntry->ocspGoodUntil = 0;
+        pEntry->used = true;
+    }
 
-        if( sslStatus != 1 )
-        {
-            LogError( ( "X509_STORE_add_cert failed to add root CA to certificate store." ) );
-            sslStatus = -1;
-        }
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static int verifyCertificateChain( X509_STORE_CTX * pStoreContext,
+                                   void * pArg )
+{
+    int verified = 0;
+    X509 * pLeaf = X509_STORE_CTX_get0_cert( pStoreContext );
+    X509_VERIFY_PARAM * pVerifyParam = X509_STORE_CTX_get0_param( pStoreContext );
+    const char * pHostName = NULL;
+    char * pIpAddress = NULL;
+    uint8_t fingerprint[ SHA256_DIGEST_LENGTH ] = { 0 };
+    bool fingerprinted = false, cached = false;
+    VerifyCacheEntry_t * pEntry = NULL;
+    time_t now = time( NULL );
+
+    ( void ) pArg;
+
+    if( pLeaf != NULL )
+    {
+        fingerprinted = getFingerprint( pLeaf, fingerprint );
     }
 
-    /* Free the X509 object used to set the root CA. */
-    if( pRootCa != NULL )
+    if( fingerprinted == true )
     {
-        X509_free( pRootCa );
+        ( void ) pthread_mutex_lock( &verifyCacheMutex );
+
+        pEntry = findVerifyCacheEntry( fingerprint, false );
+        cached = ( ( pEntry != NULL ) && ( now < pEntry->chainVerifiedUntil ) ) ? true : false;
+
+        ( void ) pthread_mutex_unlock( &verifyCacheMutex );
     }
 
-    /* Close the file if it was successfully opened. */
-    if( pRootCaFile != NULL )
+    /* The chain of a cached certificate was verified already, but the host
+     * name and the expiry of the certificate still have to be checked. Since
+     * OpenSSL 3.0, SSL_set1_host sets an IP address instead of a host name
+     * when given one. */
+    if( cached == true )
     {
-        /* MISRA Rule 21.6 flags the following line for using the standard
-         * library input/output function `fclose()`. This rule is suppressed
-         * because openssl function #PEM_read_X509 takes an argument of type
-         * `FILE *` for reading the root ca PEM file and `fopen()` is used to
-         * get the file pointer. The file opened with `fopen()` needs to be
-         * closed by calling `fclose()`.*/
-        /* coverity[misra_c_2012_rule_21_6_violation] */
-        if( fclose( pRootCaFile ) != 0 )
+        pHostName = X509_VERIFY_PARAM_get0_host( pVerifyParam, 0 );
+
+        #if ( OPENSSL_VERSION_NUMBER >= 0x30000000L )
+            pIpAddress = X509_VERIFY_PARAM_get1_ip_asc( pVerifyParam );
+        #endif
+
+        if( ( ( pHostName == NULL ) || ( X509_check_host( pLeaf, pHostName, 0U, 0U, NULL ) == 1 ) ) &&
+            ( ( pIpAddress == NULL ) || ( X509_check_ip_asc( pLeaf, pIpAddress, 0U ) == 1 ) ) &&
+            ( X509_cmp_current_time( X509_get0_notAfter( pLeaf ) ) > 0 ) )
         {
-            LogWarn( ( "fclose failed to close file %s",
-                       pRootCaPath ) );
+            LogDebug( ( "Skipping the verification of a cached server certificate chain." ) );
+            verified = 1;
         }
+        else
+        {
+            cached = false;
+        }
+
+        OPENSSL_free( pIpAddress );
     }
 
-    /* Log the success message if we successfully imported the root CA. */
-    if( sslStatus == 1 )
+    if( cached == false )
     {
-        LogDebug( ( "Successfully imported root CA." ) );
+        verified = X509_verify_cert( pStoreContext );
     }
 
-    return sslStatus;
+    if( ( cached == false ) && ( verified == 1 ) && ( fingerprinted == true ) )
+    {
+        ( void ) pthread_mutex_lock( &verifyCacheMutex );
+
+        pEntry = findVerifyCacheEntry( fingerprint, true );
+        pEntry->chainVerifiedUntil = now + OPENSSL_VERIFY_CACHE_TTL_SECONDS;
+
+        ( void ) pthread_mutex_unlock( &verifyCacheMutex );
+    }
+
+    return verified;
 }
 /*-----------------------------------------------------------*/
 
-static int32_t setClientCertificate( SSL_CTX * pSslContext,
-                                     const char * pClientCertPath )
+static X509 * findIssuer( const SSL * pSsl,
+                          X509 * pLeaf,
+                          STACK_OF( X509 ) * pChain )
 {
-    int32_t sslStatus = -1;
-
-    assert( pSslContext != NULL );
-    assert( pClientCertPath != NULL );
-
-    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
-        logPath( pClientCertPath, CLIENT_CERT_LABEL );
-    #endif
+    X509 * pIssuer = NULL;
+    X509_STORE_CTX * pStoreContext = NULL;
+    int i = 0;
 
-    /* Import the client certificate. */
-    sslStatus = SSL_CTX_use_certificate_chain_file( pSslContext,
-                                                    pClientCertPath );
+    assert( pSsl != NULL );
+    assert( pLeaf != NULL );
 
-    if( sslStatus != 1 )
+    for( i = 1; i < sk_X509_num( pChain ); i++ )
     {
-        LogError( ( "SSL_CTX_use_certificate_chain_file failed to import "
-                    "client certificate at %s.",
-                    pClientCertPath ) );
+        if( X509_check_issued( sk_X509_value( pChain, i ), pLeaf ) == X509_V_OK )
+        {
+            pIssuer = sk_X509_value( pChain, i );
+            ( void ) X509_up_ref( pIssuer );
+            break;
+        }
     }
-    else
+
+    /* The server may leave out a root CA that issued its certificate. */
+    if( pIssuer == NULL )
     {
-        LogDebug( ( "Successfully imported client certificate." ) );
+        pStoreContext = X509_STORE_CTX_new();
+
+        if( ( pStoreContext != NULL ) &&
+            ( X509_STORE_CTX_init( pStoreContext,
+                                   SSL_CTX_get_cert_store( SSL_get_SSL_CTX( pSsl ) ),
+                                   pLeaf,
+                                   pChain ) == 1 ) &&
+            ( X509_STORE_CTX_get1_issuer( &pIssuer, pStoreContext, pLeaf ) != 1 ) )
+        {
+            pIssuer = NULL;
+        }
+
+        X509_STORE_CTX_free( pStoreContext );
     }
 
-    return sslStatus;
+    return pIssuer;
 }
 /*-----------------------------------------------------------*/
 
-static int32_t setPrivateKey( SSL_CTX * pSslContext,
-                              const char * pPrivateKeyPath )
+static OpensslStatus_t checkStapledResponse( const SSL * pSsl,
+                                             X509 * pLeaf,
+                                             STACK_OF( X509 ) * pChain,
+                                             const uint8_t * pResponse,
+                                             long responseLength,
+                                             time_t * pGoodUntil )
 {
-    int32_t sslStatus = -1;
+    OpensslStatus_t returnStatus = OPENSSL_HANDSHAKE_FAILED;
+    OCSP_RESPONSE * pOcspResponse = NULL;
+    OCSP_BASICRESP * pBasicResponse = NULL;
+    OCSP_CERTID * pCertificateId = NULL;
+    X509 * pIssuer = NULL;
+    ASN1_GENERALIZEDTIME * pThisUpdate = NULL;
+    ASN1_GENERALIZEDTIME * pNextUpdate = NULL;
+    int certificateStatus = V_OCSP_CERTSTATUS_UNKNOWN, reason = 0;
+    int days = 0, seconds = 0;
 
-    assert( pSslContext != NULL );
-    assert( pPrivateKeyPath != NULL );
+    assert( pSsl != NULL );
+    assert( pGoodUntil != NULL );
 
-    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
-        logPath( pPrivateKeyPath, CLIENT_KEY_LABEL );
-    #endif
+    pOcspResponse = d2i_OCSP_RESPONSE( NULL, &pResponse, responseLength );
 
-    /* Import the client certificate private key. */
-    sslStatus = SSL_CTX_use_PrivateKey_file( pSslContext,
-                                             pPrivateKeyPath,
-                                             SSL_FILETYPE_PEM );
+    if( ( pOcspResponse == NULL ) ||
+        ( OCSP_response_status( pOcspResponse ) != OCSP_RESPONSE_STATUS_SUCCESSFUL ) )
+    {
+        LogError( ( "The stapled OCSP response is not a successful response." ) );
+    }
+    else
+    {
+        pBasicResponse = OCSP_response_get1_basic( pOcspResponse );
+        pIssuer = findIssuer( pSsl, pLeaf, pChain );
+    }
 
-    if( sslStatus != 1 )
+    /* The response must be signed by the issuer, or by a responder whose
+     * certificate the issuer delegated OCSP signing to. */
+    if( ( pBasicResponse == NULL ) || ( pIssuer == NULL ) )
     {
-        LogError( ( "SSL_CTX_use_PrivateKey_file failed to import client "
-                    "certificate private key at %s.",
-                    pPrivateKeyPath ) );
+        LogError( ( "Failed to find the basic response or the certificate issuer of the stapled OCSP response." ) );
+    }
+    else if( OCSP_basic_verify( pBasicResponse,
+                                pChain,
+                                SSL_CTX_get_cert_store( SSL_get_SSL_CTX( pSsl ) ),
+                                0UL ) != 1 )
+    {
+        LogError( ( "Failed to verify the signature of the stapled OCSP response." ) );
     }
     else
     {
-        LogDebug( ( "Successfully imported client certificate private key." ) );
+        pCertificateId = OCSP_cert_to_id( NULL, pLeaf, pIssuer );
+
+        if( ( pCertificateId == NULL ) ||
+            ( OCSP_resp_find_status( pBasicResponse, pCertificateId, &certificateStatus, &reason,
+                                     NULL, &pThisUpdate, &pNextUpdate ) != 1 ) )
+        {
+            LogError( ( "The stapled OCSP response has no status for the server certificate." ) );
+        }
+        else if( OCSP_check_validity( pThisUpdate, pNextUpdate, OCSP_MAX_CLOCK_SKEW_SECONDS, -1L ) != 1 )
+        {
+            LogError( ( "The stapled OCSP response is not current." ) );
+        }
+        else if( certificateStatus == V_OCSP_CERTSTATUS_REVOKED )
+        {
+            LogError( ( "The server certificate is revoked: OCSP revocation reason=%d.", reason ) );
+        }
+        else if( certificateStatus != V_OCSP_CERTSTATUS_GOOD )
+        {
+            LogError( ( "The stapled OCSP response reports an unknown status for the server certificate." ) );
+        }
+        else
+        {
+            /* A response without a next update only holds for as long as a
+             * verified chain does. */
+            *pGoodUntil = time( NULL ) + OPENSSL_VERIFY_CACHE_TTL_SECONDS;
+
+            if( ( pNextUpdate != NULL ) &&
+                ( ASN1_TIME_diff( &days, &seconds, NULL, pNextUpdate ) == 1 ) )
+            {
+                *pGoodUntil = time( NULL ) + ( ( time_t ) days * 86400 ) + ( time_t ) seconds;
+            }
+
+            returnStatus = OPENSSL_SUCCESS;
+        }
     }
 
-    return sslStatus;
+    OCSP_CERTID_free( pCertificateId );
+    X509_free( pIssuer );
+    OCSP_BASICRESP_free( pBasicResponse );
+    OCSP_RESPONSE_free( pOcspResponse );
+
+    return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-static int32_t setCredentials( SSL_CTX * pSslContext,
-                               const OpensslCredentials_t * pOpensslCredentials )
+static OpensslStatus_t checkRevocation( const OpensslParams_t * pOpensslParams,
+                                        OpensslOcspMode_t ocspMode )
 {
-    int32_t sslStatus = 0;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    STACK_OF( X509 ) * pChain = NULL;
+    X509 * pLeaf = NULL;
+    uint8_t fingerprint[ SHA256_DIGEST_LENGTH ] = { 0 };
+    const uint8_t * pResponse = NULL;
+    long responseLength = -1;
+    bool resumed = false, fingerprinted = false, cachedGood = false;
+    VerifyCacheEntry_t * pEntry = NULL;
+    time_t goodUntil = 0;
 
-    assert( pSslContext != NULL );
-    assert( pOpensslCredentials != NULL );
+    assert( pOpensslParams != NULL );
 
-    if( pOpensslCredentials->pRootCaPath != NULL )
+    /* The certificate of a resumed session was checked when the session was
+     * established. */
+    resumed = ( SSL_session_reused( pOpensslParams->pSsl ) == 1 ) ? true : false;
+
+    if( resumed == true )
     {
-        sslStatus = setRootCa( pSslContext,
-                               pOpensslCredentials->pRootCaPath );
+        LogDebug( ( "Skipping the OCSP check of a resumed session." ) );
     }
+    else
+    {
+        pChain = SSL_get_peer_cert_chain( pOpensslParams->pSsl );
+        pLeaf = sk_X509_value( pChain, 0 );
 
-    if( ( sslStatus == 1 ) &&
-        ( pOpensslCredentials->pClientCertPath != NULL ) )
+        if( pLeaf != NULL )
+        {
+            fingerprinted = getFingerprint( pLeaf, fingerprint );
+        }
+
+        if( fingerprinted == true )
+        {
+            ( void ) pthread_mutex_lock( &verifyCacheMutex );
+
+            pEntry = findVerifyCacheEntry( fingerprint, false );
+            cachedGood = ( ( pEntry != NULL ) && ( time( NULL ) < pEntry->ocspGoodUntil ) ) ? true : false;
+
+            ( void ) pthread_mutex_unlock( &verifyCacheMutex );
+        }
+
+        if( cachedGood == false )
+        {
+            /* MISRA Directive 4.6 flags the following line for using basic
+             * numerical type long. This directive is suppressed because openssl
+             * function #SSL_get_tlsext_status_ocsp_resp returns a long. */
+            /* coverity[misra_c_2012_directive_4_6_violation] */
+            responseLength = SSL_get_tlsext_status_ocsp_resp( pOpensslParams->pSsl, &pResponse );
+        }
+    }
+
+    if( resumed == true )
     {
-        sslStatus = setClientCertificate( pSslContext,
-                                          pOpensslCredentials->pClientCertPath );
+        /* Nothing to check. */
+    }
+    else if( cachedGood == true )
+    {
+        LogDebug( ( "Using the cached OCSP status of the server certificate." ) );
+    }
+    else if( ( pLeaf != NULL ) && ( responseLength > 0 ) && ( pResponse != NULL ) )
+    {
+        returnStatus = checkStapledResponse( pOpensslParams->pSsl,
+                                             pLeaf,
+                                             pChain,
+                                             pResponse,
+                                             responseLength,
+                                             &goodUntil );
+    }
+    else if( ocspMode == OPENSSL_OCSP_REQUIRE )
+    {
+        LogError( ( "The server did not staple an OCSP response for its certificate." ) );
+        returnStatus = OPENSSL_HANDSHAKE_FAILED;
+    }
+    else
+    {
+        LogDebug( ( "The server did not staple an OCSP response for its certificate." ) );
     }
 
-    if( ( sslStatus == 1 ) &&
-        ( pOpensslCredentials->pPrivateKeyPath != NULL ) )
+    /* Later handshakes with the same certificate need no staple while the
+     * good status holds. */
+    if( ( goodUntil != 0 ) && ( fingerprinted == true ) )
     {
-        sslStatus = setPrivateKey( pSslContext,
-                                   pOpensslCredentials->pPrivateKeyPath );
+        ( void ) pthread_mutex_lock( &verifyCacheMutex );
+
+        pEntry = findVerifyCacheEntry( fingerprint, true );
+        pEntry->ocspGoodUntil = goodUntil;
+
+        ( void ) pthread_mutex_unlock( &verifyCacheMutex );
     }
 
-    return sslStatus;
+    return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-static void setOptionalConfigurations( SSL * pSsl,
-                                       const OpensslCredentials_t * pOpensslCredentials )
+static void detectKtlsOffload( OpensslParams_t * pOpensslParams,
+                               const OpensslCredentials_t * pOpensslCredentials )
 {
-    int32_t sslStatus = -1;
-    int16_t readBufferLength = 0;
-
-    assert( pSsl != NULL );
+    assert( pOpensslParams != NULL );
     assert( pOpensslCredentials != NULL );
 
-    /* Set TLS ALPN if requested. */
-    if( ( pOpensslCredentials->pAlpnProtos != NULL ) &&
-        ( pOpensslCredentials->alpnProtosLen > 0U ) )
+    #if ( KTLS_SUPPORTED == 1 )
+        if( pOpensslCredentials->enableKtls == true )
+        {
+            pOpensslParams->ktlsSendEnabled = ( BIO_get_ktls_send( SSL_get_wbio( pOpensslParams->pSsl ) ) != 0 ) ?
+                                              true : false;
+            pOpensslParams->ktlsRecvEnabled = ( BIO_get_ktls_recv( SSL_get_rbio( pOpensslParams->pSsl ) ) != 0 ) ?
+                                              true : false;
+
+            LogInfo( ( "Kernel TLS offload: send=%s, recv=%s.",
+                       ( pOpensslParams->ktlsSendEnabled == true ) ? "enabled" : "disabled",
+                       ( pOpensslParams->ktlsRecvEnabled == true ) ? "enabled" : "disabled" ) );
+        }
+    #else
+        ( void ) pOpensslParams;
+        ( void ) pOpensslCredentials;
+    #endif /* if ( KTLS_SUPPORTED == 1 ) */
+}
+/*-----------------------------------------------------------*/
+
+static size_t writeEarlyData( const OpensslParams_t * pOpensslParams,
+                              const OpensslCredentials_t * pOpensslCredentials )
+{
+    size_t earlyDataWritten = 0U;
+    const SSL_SESSION * pSession = NULL;
+
+    assert( pOpensslCredentials->pEarlyData != NULL );
+
+    if( pOpensslCredentials->earlyDataReplaySafe == true )
     {
-        LogDebug( ( "Setting ALPN protos." ) );
-        sslStatus = SSL_set_alpn_protos( pSsl,
-                                         ( const uint8_t * ) pOpensslCredentials->pAlpnProtos,
-                                         ( uint32_t ) pOpensslCredentials->alpnProtosLen );
+        pSession = SSL_get_session( pOpensslParams->pSsl );
 
-        if( sslStatus != 0 )
+        /* Only a session issued with a ticket allowing early data can
+         * carry it, which implies TLS 1.3. */
+        if( ( pSession != NULL ) &&
+            ( ( size_t ) SSL_SESSION_get_max_early_data( pSession ) >= pOpensslCredentials->earlyDataLength ) )
         {
-            LogError( ( "SSL_set_alpn_protos failed to set ALPN protos. %s",
-                        pOpensslCredentials->pAlpnProtos ) );
+            if( SSL_write_early_data( pOpensslParams->pSsl,
+                                      pOpensslCredentials->pEarlyData,
+                                      pOpensslCredentials->earlyDataLength,
+                                      &earlyDataWritten ) != 1 )
+            {
+                LogWarn( ( "SSL_write_early_data failed: Sending the data after the handshake." ) );
+                earlyDataWritten = 0U;
+            }
+            else
+            {
+                LogDebug( ( "Sent %lu bytes of early data.",
+                            ( unsigned long ) earlyDataWritten ) );
+            }
         }
     }
 
-    /* Set TLS MFLN if requested. */
-    if( pOpensslCredentials->maxFragmentLength > 0U )
-    {
-        LogDebug( ( "Setting max send fragment length %u.",
-                    pOpensslCredentials->maxFragmentLength ) );
-
-        /* Set the maximum send fragment length. */
+    return earlyDataWritten;
+}
+/*-----------------------------------------------------------*/
 
-        /* MISRA Directive 4.6 flags the following line for using basic
-         * numerical type long. This directive is suppressed because openssl
-         * function #SSL_set_max_send_fragment expects a length argument
-         * type of long. */
-        /* coverity[misra_c_2012_directive_4_6_violation] */
-        sslStatus = ( int32_t ) SSL_set_max_send_fragment( pSsl,
-                                                           ( long ) pOpensslCredentials->maxFragmentLength );
+static OpensslStatus_t completeEarlyData( OpensslParams_t * pOpensslParams,
+                                          const OpensslCredentials_t * pOpensslCredentials,
+                                          size_t earlyDataWritten )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    size_t offset = 0U;
+    int32_t bytesWritten = 0;
 
-        if( sslStatus != 1 )
+    /* The server discards rejected early data, so it is sent again in
+     * full. */
+    if( earlyDataWritten > 0U )
+    {
+        if( SSL_get_early_data_status( pOpensslParams->pSsl ) == SSL_EARLY_DATA_ACCEPTED )
         {
-            LogError( ( "Failed to set max send fragment length %u.",
-                        pOpensslCredentials->maxFragmentLength ) );
+            pOpensslParams->earlyDataAccepted = true;
+            offset = earlyDataWritten;
         }
         else
         {
-            readBufferLength = ( int16_t ) pOpensslCredentials->maxFragmentLength +
-                               SSL3_RT_MAX_ENCRYPTED_OVERHEAD;
-
-            /* Change the size of the read buffer to match the
-             * maximum fragment length + some extra bytes for overhead. */
-            SSL_set_default_read_buffer_len( pSsl,
-                                             ( size_t ) readBufferLength );
+            LogInfo( ( "The server rejected the early data: Sending it after the handshake." ) );
         }
     }
 
-    /* Enable SNI if requested. */
-    if( pOpensslCredentials->sniHostName != NULL )
+    while( ( returnStatus == OPENSSL_SUCCESS ) && ( offset < pOpensslCredentials->earlyDataLength ) )
     {
-        LogDebug( ( "Setting server name %s for SNI.",
-                    pOpensslCredentials->sniHostName ) );
-
-        /* MISRA Rule 11.8 flags the following line for removing the const
-         * qualifier from the pointed to type. This rule is suppressed because
-         * openssl implementation of #SSL_set_tlsext_host_name internally casts
-         * the pointer to a string literal to a `void *` pointer. */
-        /* coverity[misra_c_2012_rule_11_8_violation] */
-        sslStatus = ( int32_t ) SSL_set_tlsext_host_name( pSsl,
-                                                          pOpensslCredentials->sniHostName );
+        bytesWritten = ( int32_t ) SSL_write( pOpensslParams->pSsl,
+                                              &( pOpensslCredentials->pEarlyData[ offset ] ),
+                                              ( int32_t ) ( pOpensslCredentials->earlyDataLength - offset ) );
+        COUNT_IO_CALL( pOpensslParams );
 
-        if( sslStatus != 1 )
+        if( bytesWritten <= 0 )
         {
-            LogError( ( "Failed to set server name %s for SNI.",
-                        pOpensslCredentials->sniHostName ) );
+            LogError( ( "SSL_write failed to send the early data after the handshake." ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+        else
+        {
+            offset += ( size_t ) bytesWritten;
         }
     }
+
+    return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
-                                 const ServerInfo_t * pServerInfo,
-                                 const OpensslCredentials_t * pOpensslCredentials,
-                                 uint32_t sendTimeoutMs,
-                                 uint32_t recvTimeoutMs )
+static OpensslStatus_t tlsHandshake( const ServerInfo_t * pServerInfo,
+                                     OpensslParams_t * pOpensslParams,
+                                     const OpensslCredentials_t * pOpensslCredentials )
 {
-    OpensslParams_t * pOpensslParams = NULL;
-    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
     OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
-    int32_t sslStatus = 0;
-    uint8_t sslObjectCreated = 0;
-    SSL_CTX * pSslContext = NULL;
+    int32_t sslStatus = -1;
+    size_t earlyDataWritten = 0U;
 
-    /* Validate parameters. */
-    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
-    {
-        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
-        returnStatus = OPENSSL_INVALID_PARAMETER;
-    }
-    else if( pOpensslCredentials == NULL )
-    {
-        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
-        returnStatus = OPENSSL_INVALID_PARAMETER;
-    }
-    else
+    TRACE_PROBE1( tls_handshake_start, pOpensslParams );
+
+    returnStatus = setupSslObject( pServerInfo,
+                                   pOpensslParams,
+                                   pOpensslCredentials );
+
+    /* Early data goes in the first flight, before the handshake completes. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( pOpensslCredentials->pEarlyData != NULL ) )
     {
-        /* Empty else. */
+        earlyDataWritten = writeEarlyData( pOpensslParams, pOpensslCredentials );
     }
 
-    /* Establish the TCP connection. */
+    /* Perform the TLS handshake. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        pOpensslParams = pNetworkContext->pParams;
-        socketStatus = Sockets_Connect( &pOpensslParams->socketDescriptor,
-                                        pServerInfo,
-                                        sendTimeoutMs,
-                                        recvTimeoutMs );
+        sslStatus = SSL_connect( pOpensslParams->pSsl );
 
-        /* Convert socket wrapper status to openssl status. */
-        returnStatus = convertToOpensslStatus( socketStatus );
+        if( sslStatus != 1 )
+        {
+            LogError( ( "SSL_connect failed to perform TLS handshake." ) );
+            returnStatus = OPENSSL_HANDSHAKE_FAILED;
+        }
     }
 
-    /* Create SSL context. */
+    /* Verify X509 certificate from peer. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        pSslContext = SSL_CTX_new( TLS_client_method() );
+        returnStatus = verifyPeerCertificate( pOpensslParams );
+    }
 
-        if( pSslContext == NULL )
-        {
-            LogError( ( "Creation of a new SSL_CTX object failed." ) );
-            returnStatus = OPENSSL_API_ERROR;
-        }
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( pOpensslCredentials->ocspMode != OPENSSL_OCSP_DISABLED ) )
+    {
+        returnStatus = checkRevocation( pOpensslParams, pOpensslCredentials->ocspMode );
+    }
+
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( pOpensslCredentials->pEarlyData != NULL ) )
+    {
+        returnStatus = completeEarlyData( pOpensslParams, pOpensslCredentials, earlyDataWritten );
     }
 
-    /* Setup credentials. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        /* Enable partial writes for blocking calls to SSL_write to allow a
-         * payload larger than the maximum fragment length.
-         * The mask returned by SSL_CTX_set_mode does not need to be checked. */
+        detectKtlsOffload( pOpensslParams, pOpensslCredentials );
+    }
 
-        /* MISRA Directive 4.6 flags the following line for using basic
-        * numerical type long. This directive is suppressed because openssl
-        * function #SSL_CTX_set_mode takes an argument of type long. */
-        /* coverity[misra_c_2012_directive_4_6_violation] */
-        ( void ) SSL_CTX_set_mode( pSslContext,
-                                   ( long ) SSL_MODE_ENABLE_PARTIAL_WRITE );
+    TRACE_PROBE2( tls_handshake_done, pOpensslParams, returnStatus );
 
-        sslStatus = setCredentials( pSslContext,
-                                    pOpensslCredentials );
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
 
-        if( sslStatus != 1 )
-        {
-            LogError( ( "Setting up credentials failed." ) );
-            returnStatus = OPENSSL_INVALID_CREDENTIALS;
-        }
-    }
+static OpensslStatus_t continueTlsHandshake( OpensslParams_t * pOpensslParams )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    int32_t sslStatus = -1, sslError = SSL_ERROR_NONE;
 
-    /* Create a new SSL session. */
-    if( returnStatus == OPENSSL_SUCCESS )
+    sslStatus = SSL_connect( pOpensslParams->pSsl );
+
+    if( sslStatus != 1 )
     {
-        pOpensslParams->pSsl = SSL_new( pSslContext );
+        sslError = SSL_get_error( pOpensslParams->pSsl, sslStatus );
 
-        if( pOpensslParams->pSsl == NULL )
+        if( sslError == SSL_ERROR_WANT_READ )
         {
-            LogError( ( "SSL_new failed to create a new SSL context." ) );
-            returnStatus = OPENSSL_API_ERROR;
+            returnStatus = OPENSSL_WANT_READ;
+        }
+        else if( sslError == SSL_ERROR_WANT_WRITE )
+        {
+            returnStatus = OPENSSL_WANT_WRITE;
         }
         else
         {
-            sslObjectCreated = 1u;
+            LogError( ( "SSL_connect failed to perform TLS handshake: SSL_get_error=%d.",
+                        sslError ) );
+            returnStatus = OPENSSL_HANDSHAKE_FAILED;
         }
     }
 
-    /* Setup the socket to use for communication. */
+    /* Verify X509 certificate from peer. */
     if( returnStatus == OPENSSL_SUCCESS )
     {
-        returnStatus = tlsHandshake( pServerInfo,
-                                     pOpensslParams,
-                                     pOpensslCredentials );
+        returnStatus = verifyPeerCertificate( pOpensslParams );
     }
 
-    /* Free the SSL context. */
-    if( pSslContext != NULL )
+    if( ( returnStatus == OPENSSL_SUCCESS ) &&
+        ( pOpensslParams->pConnectCredentials->ocspMode != OPENSSL_OCSP_DISABLED ) )
     {
-        SSL_CTX_free( pSslContext );
+        returnStatus = checkRevocation( pOpensslParams,
+                                        pOpensslParams->pConnectCredentials->ocspMode );
     }
 
-    /* Clean up on error. */
-    if( ( returnStatus != OPENSSL_SUCCESS ) && ( sslObjectCreated == 1u ) )
+    /* Restore the blocking socket that #Openssl_Recv and #Openssl_Send
+     * expect. */
+    if( returnStatus == OPENSSL_SUCCESS )
     {
-        SSL_free( pOpensslParams->pSsl );
-        pOpensslParams->pSsl = NULL;
+        returnStatus = convertToOpensslStatus( Sockets_SetNonBlocking( pOpensslParams->socketDescriptor,
+                                                                       false ) );
     }
 
-    /* Log failure or success depending on status. */
-    if( returnStatus != OPENSSL_SUCCESS )
+    if( returnStatus == OPENSSL_SUCCESS )
     {
-        LogError( ( "Failed to establish a TLS connection." ) );
+        detectKtlsOffload( pOpensslParams, pOpensslParams->pConnectCredentials );
     }
-    else
+
+    /* The handshake of a non-blocking connection takes several steps. */
+    if( ( returnStatus != OPENSSL_WANT_READ ) && ( returnStatus != OPENSSL_WANT_WRITE ) )
     {
-        LogDebug( ( "Established a TLS connection." ) );
+        TRACE_PROBE2( tls_handshake_done, pOpensslParams, returnStatus );
     }
 
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext )
+static OpensslStatus_t advanceConnection( OpensslParams_t * pOpensslParams,
+                                          SocketStatus_t socketStatus )
 {
-    OpensslParams_t * pOpensslParams = NULL;
-    SocketStatus_t socketStatus = SOCKETS_INVALID_PARAMETER;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
 
-    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    /* The socket changes as each resolved address is tried. */
+    pOpensslParams->socketDescriptor = pOpensslParams->socketConnectContext.tcpSocket;
+    returnStatus = convertToOpensslStatus( socketStatus );
+
+    if( returnStatus == OPENSSL_WANT_WRITE )
     {
-        /* No need to update the status here. The socket status
-         * SOCKETS_INVALID_PARAMETER will be converted to openssl
-         * status OPENSSL_INVALID_PARAMETER before returning from this
-         * function. */
-        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        pOpensslParams->connectState = OPENSSL_CONNECT_STATE_TCP;
+    }
+    else if( returnStatus == OPENSSL_SUCCESS )
+    {
+        /* The TCP connection is established. Start the TLS handshake on the
+         * socket in non-blocking mode. */
+        pOpensslParams->connectState = OPENSSL_CONNECT_STATE_TLS;
+
+        returnStatus = createSslObject( pOpensslParams->pConnectServerInfo,
+                                        pOpensslParams,
+                                        pOpensslParams->pConnectCredentials );
+
+        if( returnStatus == OPENSSL_SUCCESS )
+        {
+            returnStatus = setupSslObject( pOpensslParams->pConnectServerInfo,
+                                           pOpensslParams,
+                                           pOpensslParams->pConnectCredentials );
+        }
+
+        if( returnStatus == OPENSSL_SUCCESS )
+        {
+            returnStatus = convertToOpensslStatus( Sockets_SetNonBlocking( pOpensslParams->socketDescriptor,
+                                                                           true ) );
+        }
+
+        if( returnStatus == OPENSSL_SUCCESS )
+        {
+            TRACE_PROBE1( tls_handshake_start, pOpensslParams );
+            returnStatus = continueTlsHandshake( pOpensslParams );
+        }
     }
     else
     {
-        pOpensslParams = pNetworkContext->pParams;
+        /* Empty else MISRA 15.7 */
+    }
 
-        if( pOpensslParams->pSsl != NULL )
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t finishConnectStep( OpensslParams_t * pOpensslParams,
+                                          OpensslStatus_t connectStatus )
+{
+    if( connectStatus == OPENSSL_SUCCESS )
+    {
+        LogDebug( ( "Established a TLS connection." ) );
+        pOpensslParams->connectState = OPENSSL_CONNECT_STATE_IDLE;
+    }
+    else if( ( connectStatus == OPENSSL_WANT_READ ) || ( connectStatus == OPENSSL_WANT_WRITE ) )
+    {
+        /* The connection is still in progress. */
+    }
+    else
+    {
+        LogError( ( "Failed to establish a TLS connection." ) );
+
+        /* The sockets wrapper has already released a failed TCP connection. */
+        if( pOpensslParams->connectState == OPENSSL_CONNECT_STATE_TLS )
         {
-            /* SSL shutdown should be called twice: once to send "close notify" and
-             * once more to receive the peer's "close notify". */
-            if( SSL_shutdown( pOpensslParams->pSsl ) == 0 )
+            if( pOpensslParams->pSsl != NULL )
             {
-                ( void ) SSL_shutdown( pOpensslParams->pSsl );
+                SSL_free( pOpensslParams->pSsl );
+                pOpensslParams->pSsl = NULL;
             }
 
-            SSL_free( pOpensslParams->pSsl );
+            ( void ) Sockets_Disconnect( pOpensslParams->socketDescriptor );
         }
 
-        /* Tear down the socket connection, pNetworkContext != NULL here. */
-        socketStatus = Sockets_Disconnect( pOpensslParams->socketDescriptor );
+        pOpensslParams->connectState = OPENSSL_CONNECT_STATE_IDLE;
     }
 
-    return convertToOpensslStatus( socketStatus );
+    return connectStatus;
 }
 /*-----------------------------------------------------------*/
 
-/* MISRA Rule 8.13 flags the following line for not using the const qualifier
- * on `pNetworkContext`. Indeed, the object pointed by it is not modified
- * by OpenSSL, but other implementations of `TransportRecv_t` may do so. */
-int32_t Openssl_Recv( NetworkContext_t * pNetworkContext,
-                      void * pBuffer,
-                      size_t bytesToRecv )
+#if ( OPENSSL_MINIMAL_INIT == 1 )
+
+    static void initOpenssl( void )
+    {
+        uint64_t options = OPENSSL_INIT_NO_LOAD_CONFIG;
+
+        /* The error strings are only read by the logs. */
+        #if ( LIBRARY_LOG_LEVEL == LOG_NONE )
+            options |= OPENSSL_INIT_NO_LOAD_SSL_STRINGS | OPENSSL_INIT_NO_LOAD_CRYPTO_STRINGS;
+        #endif
+
+        /* A failure makes SSL_CTX_new fail too, which is reported. */
+        if( OPENSSL_init_ssl( options, NULL ) != 1 )
+        {
+            LogError( ( "OPENSSL_init_ssl failed to initialize OpenSSL." ) );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( OPENSSL_MINIMAL_INIT == 1 ) */
+
+static int32_t addDerBundle( X509_STORE * pStore,
+                             const char * pBundlePath )
 {
-    OpensslParams_t * pOpensslParams = NULL;
-    int32_t bytesReceived = 0;
-    int32_t sslError = 0;
+    int32_t sslStatus = 1;
+    int fileDescriptor = -1;
+    struct stat fileStat;
+    uint8_t * pBundle = NULL;
+    size_t bundleLength = 0U;
+    const unsigned char * pDer = NULL;
+    X509 * pCertificate = NULL;
+    size_t certificateCount = 0U;
 
-    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    #if ( OPENSSL_DER_BUNDLE_MMAP == 0 )
+        ssize_t bytesRead = 0;
+        size_t offset = 0U;
+    #endif
+
+    assert( pStore != NULL );
+    assert( pBundlePath != NULL );
+
+    fileDescriptor = open( pBundlePath, O_RDONLY | O_CLOEXEC );
+
+    if( fileDescriptor < 0 )
     {
-        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        LogError( ( "open failed to find the root CA bundle: "
+                    "ROOT_CA_PATH=%s: %s.",
+                    pBundlePath,
+                    strerror( errno ) ) );
+        sslStatus = -1;
     }
-    else if( pNetworkContext->pParams->pSsl != NULL )
+    else if( ( fstat( fileDescriptor, &fileStat ) != 0 ) || ( fileStat.st_size <= 0 ) )
     {
-        pOpensslParams = pNetworkContext->pParams;
-        /* SSL read of data. */
-        bytesReceived = ( int32_t ) SSL_read( pOpensslParams->pSsl,
-                                              pBuffer,
-                                              ( int32_t ) bytesToRecv );
+        LogError( ( "The root CA bundle %s is empty or could not be read.",
+                    pBundlePath ) );
+        sslStatus = -1;
+    }
+    else
+    {
+        bundleLength = ( size_t ) fileStat.st_size;
+    }
 
-        /* Handle error return status if transport read did not succeed. */
-        if( bytesReceived <= 0 )
+    #if ( OPENSSL_DER_BUNDLE_MMAP == 1 )
+        if( sslStatus == 1 )
         {
-            sslError = SSL_get_error( pOpensslParams->pSsl, bytesReceived );
+            pBundle = mmap( NULL, bundleLength, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
 
-            if( sslError == SSL_ERROR_WANT_READ )
+            if( pBundle == MAP_FAILED )
             {
-                /* The OpenSSL documentation mentions that SSL_Read can provide a return code of
-                 * SSL_ERROR_WANT_READ in blocking mode, if the SSL context is not configured with
-                 * with the SSL_MODE_AUTO_RETRY. This error code means that the SSL_read()
-                 * operation needs to be retried to complete the read operation.
-                 * Thus, setting the return value of this function as zero to represent that no
-                 * data was received from the network. */
-                bytesReceived = 0;
+                LogError( ( "mmap failed to map the root CA bundle %s: %s.",
+                            pBundlePath,
+                            strerror( errno ) ) );
+                pBundle = NULL;
+                sslStatus = -1;
             }
-            else
+        }
+    #else /* if ( OPENSSL_DER_BUNDLE_MMAP == 1 ) */
+        if( sslStatus == 1 )
+        {
+            pBundle = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_TRANSPORT, bundleLength );
+
+            if( pBundle == NULL )
             {
-                LogError( ( "Failed to receive data over network: SSL_read failed: "
-                            "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
+                LogError( ( "Failed to allocate %lu bytes for the root CA bundle.",
+                            ( unsigned long ) bundleLength ) );
+                sslStatus = -1;
+            }
+        }
 
-                /* The transport interface requires zero return code only when the receive operation can
-                 * be retried to achieve success. Thus, convert a zero error code to a negative return
-                 * value as this cannot be retried. */
-                if( bytesReceived == 0 )
-                {
-                    bytesReceived = -1;
-                }
+        while( ( sslStatus == 1 ) && ( offset < bundleLength ) )
+        {
+            bytesRead = read( fileDescriptor, &( pBundle[ offset ] ), bundleLength - offset );
+
+            if( bytesRead > 0 )
+            {
+                offset += ( size_t ) bytesRead;
+            }
+            else if( ( bytesRead < 0 ) && ( errno == EINTR ) )
+            {
+                /* Retry the interrupted read. */
             }
+            else
+            {
+                LogError( ( "read failed to read the root CA bundle %s.",
+                            pBundlePath ) );
+                sslStatus = -1;
+            }
+        }
+    #endif /* if ( OPENSSL_DER_BUNDLE_MMAP == 1 ) */
+
+    /* Each certificate is an ASN.1 SEQUENCE giving its own length, so that
+     * the bundle needs no other framing. */
+    pDer = pBundle;
+
+    while( ( sslStatus == 1 ) && ( pDer < &( pBundle[ bundleLength ] ) ) )
+    {
+        pCertificate = d2i_X509( NULL, &pDer, ( long ) ( &( pBundle[ bundleLength ] ) - pDer ) );
+
+        if( pCertificate == NULL )
+        {
+            LogError( ( "d2i_X509 failed to parse certificate %lu of the root CA bundle %s.",
+                        ( unsigned long ) certificateCount,
+                        pBundlePath ) );
+            sslStatus = -1;
+        }
+        else if( X509_STORE_add_cert( pStore, pCertificate ) != 1 )
+        {
+            LogError( ( "X509_STORE_add_cert failed to add certificate %lu of the root CA bundle %s.",
+                        ( unsigned long ) certificateCount,
+                        pBundlePath ) );
+            sslStatus = -1;
+        }
+        else
+        {
+            certificateCount++;
+        }
+
+        if( pCertificate != NULL )
+        {
+            X509_free( pCertificate );
         }
     }
-    else
+
+    if( pBundle != NULL )
     {
-        LogError( ( "Failed to receive data over network: "
-                    "SSL object in network context is NULL." ) );
+        #if ( OPENSSL_DER_BUNDLE_MMAP == 1 )
+            ( void ) munmap( pBundle, bundleLength );
+        #else
+            Allocator_Free( pBundle );
+        #endif
     }
 
-    return bytesReceived;
+    if( fileDescriptor >= 0 )
+    {
+        ( void ) close( fileDescriptor );
+    }
+
+    if( sslStatus == 1 )
+    {
+        LogDebug( ( "Imported %lu root CAs from %s.",
+                    ( unsigned long ) certificateCount,
+                    pBundlePath ) );
+    }
+
+    return sslStatus;
 }
 /*-----------------------------------------------------------*/
 
-/* MISRA Rule 8.13 flags the following line for not using the const qualifier
- * on `pNetworkContext`. Indeed, the object pointed by it is not modified
- * by OpenSSL, but other implementations of `TransportSend_t` may do so. */
-int32_t Openssl_Send( NetworkContext_t * pNetworkContext,
-                      const void * pBuffer,
-                      size_t bytesToSend )
+static void * opensslMalloc( size_t size,
+                             const char * pFile,
+                             int line )
 {
-    OpensslParams_t * pOpensslParams = NULL;
-    int32_t bytesSent = 0;
-    int32_t sslError = 0;
+    ( void ) pFile;
+    ( void ) line;
 
-    /* Unused parameter when logs are disabled. */
-    ( void ) sslError;
+    return Allocator_Malloc( ALLOCATOR_SUBSYSTEM_OPENSSL, size );
+}
+/*-----------------------------------------------------------*/
 
-    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+static void * opensslRealloc( void * pBlock,
+                              size_t size,
+                              const char * pFile,
+                              int line )
+{
+    ( void ) pFile;
+    ( void ) line;
+
+    return Allocator_Realloc( ALLOCATOR_SUBSYSTEM_OPENSSL, pBlock, size );
+}
+/*-----------------------------------------------------------*/
+
+static void opensslFree( void * pBlock,
+                         const char * pFile,
+                         int line )
+{
+    ( void ) pFile;
+    ( void ) line;
+
+    Allocator_Free( pBlock );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t setRootCa( const SSL_CTX * pSslContext,
+                          const char * pRootCaPath )
+{
+    int32_t sslStatus = 1;
+    FILE * pRootCaFile = NULL;
+    X509 * pRootCa = NULL;
+
+    assert( pSslContext != NULL );
+    assert( pRootCaPath != NULL );
+
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        if( IS_PKCS11_URI( pRootCaPath ) )
+        {
+            /* The root CA is on the token. */
+            pRootCa = readPkcs11Certificate( pRootCaPath );
+
+            if( pRootCa == NULL )
+            {
+                sslStatus = -1;
+            }
+        }
+        else
+    #endif
+    if( IS_DER_BUNDLE( pRootCaPath ) )
     {
-        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+            logPath( pRootCaPath, ROOT_CA_LABEL );
+        #endif
+
+        /* Every certificate of the bundle is added to the store. */
+        sslStatus = addDerBundle( SSL_CTX_get_cert_store( pSslContext ), pRootCaPath );
     }
-    else if( pNetworkContext->pParams->pSsl != NULL )
+    else
     {
-        pOpensslParams = pNetworkContext->pParams;
-        /* SSL write of data. */
-        bytesSent = ( int32_t ) SSL_write( pOpensslParams->pSsl,
-                                           pBuffer,
-                                           ( int32_t ) bytesToSend );
+        #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+            logPath( pRootCaPath, ROOT_CA_LABEL );
+        #endif
 
-        if( bytesSent <= 0 )
-        {
-            sslError = SSL_get_error( pOpensslParams->pSsl, bytesSent );
+        /* MISRA Rule 21.6 flags the following line for using the standard
+         * library input/output function `fopen()`. This rule is suppressed because
+         * openssl function #PEM_read_X509 takes an argument of type `FILE *` for
+         * reading the root ca PEM file and `fopen()` needs to be used to get the
+         * file pointer.  */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        pRootCaFile = fopen( pRootCaPath, "r" );
 
-            LogError( ( "Failed to send data over network: SSL_write of OpenSSL failed: "
-                        "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
+        if( pRootCaFile == NULL )
+        {
+            LogError( ( "fopen failed to find the root CA certificate file: "
+                        "ROOT_CA_PATH=%s.",
+                        pRootCaPath ) );
+            sslStatus = -1;
+        }
 
-            /* As the SSL context is configured for blocking mode, the SSL_write() function
-             * does not return an SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE error code.
-             * The SSL_ERROR_WANT_READ and SSL_ERROR_WANT_WRITE error codes signify that
-             * the write operation can be retried.
-             * However, in the blocking mode, as the SSL_write() function does not return
-             * either of the error codes, we cannot retry the operation on failure, and thus,
-             * this function will never return a zero error code.
-             */
+        if( sslStatus == 1 )
+        {
+            /* Read the root CA into an X509 object. */
+            pRootCa = PEM_read_X509( pRootCaFile, NULL, NULL, NULL );
 
-            /* The transport interface requires zero return code only when the send operation can
-             * be retried to achieve success. Thus, convert a zero error code to a negative return
-             * value as this cannot be retried. */
-            if( bytesSent == 0 )
+            if( pRootCa == NULL )
             {
-                bytesSent = -1;
+                LogError( ( "PEM_read_X509 failed to parse root CA." ) );
+                sslStatus = -1;
             }
         }
     }
-    else
+
+    if( ( sslStatus == 1 ) && ( pRootCa != NULL ) )
     {
-        LogError( ( "Failed to send data over network: "
-                    "SSL object in network context is NULL." ) );
+        /* Add the certificate to the context. */
+        sslStatus = X509_STORE_add_cert( SSL_CTX_get_cert_store( pSslContext ),
+                                         pRootCa );
+
+        if( sslStatus != 1 )
+        {
+            LogError( ( "X509_STORE_add_cert failed to add root CA to certificate store." ) );
+            sslStatus = -1;
+        }
     }
 
-    return bytesSent;
-}
-/*-----------------------------------------------------------*/
+    /* Free the X509 object used to set the root CA. */
+    if( pRootCa != NULL )
+    {
+        X509_free( pRootCa );
+    }
+
+    /* Close the file if it was successfully opened. */
+    if( pRootCaFile != NULL )
+    {
+        /* MISRA Rule 21.6 flags the following line for using the standard
+         * library input/output function `fclose()`. This rule is suppressed
+         * because openssl function #PEM_read_X509 takes an argument of type
+         * `FILE *` for reading the root ca PEM file and `fopen()` is used to
+         * get the file pointer. The file opened with `fopen()` needs to be
+         * closed by calling `fclose()`.*/
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        if( fclose( pRootCaFile ) != 0 )
+        {
+            LogWarn( ( "fclose failed to close file %s",
+                       pRootCaPath ) );
+        }
+    }
+
+    /* Log the success message if we successfully imported the root CA. */
+    if( sslStatus == 1 )
+    {
+        LogDebug( ( "Successfully imported root CA." ) );
+    }
+
+    return sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t setClientCertificate( SSL_CTX * pSslContext,
+                                     const char * pClientCertPath )
+{
+    int32_t sslStatus = -1;
+
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        X509 * pCertificate = NULL;
+    #endif
+
+    assert( pSslContext != NULL );
+    assert( pClientCertPath != NULL );
+
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        if( IS_PKCS11_URI( pClientCertPath ) )
+        {
+            /* The client certificate is on the token. The SSL context keeps
+             * its own reference to the certificate. */
+            pCertificate = readPkcs11Certificate( pClientCertPath );
+
+            if( pCertificate != NULL )
+            {
+                sslStatus = SSL_CTX_use_certificate( pSslContext, pCertificate );
+                X509_free( pCertificate );
+            }
+        }
+        else
+    #endif
+    {
+        #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+            logPath( pClientCertPath, CLIENT_CERT_LABEL );
+        #endif
+
+        /* Import the client certificate. */
+        sslStatus = SSL_CTX_use_certificate_chain_file( pSslContext,
+                                                        pClientCertPath );
+    }
+
+    if( sslStatus != 1 )
+    {
+        LogError( ( "Failed to import client certificate at %s.",
+                    pClientCertPath ) );
+    }
+    else
+    {
+        LogDebug( ( "Successfully imported client certificate." ) );
+    }
+
+    return sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t setPrivateKey( SSL_CTX * pSslContext,
+                              const char * pPrivateKeyPath )
+{
+    int32_t sslStatus = -1;
+
+    assert( pSslContext != NULL );
+    assert( pPrivateKeyPath != NULL );
+
+    #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+        logPath( pPrivateKeyPath, CLIENT_KEY_LABEL );
+    #endif
+
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        if( IS_PKCS11_URI( pPrivateKeyPath ) )
+        {
+            /* The key is on the token. */
+            sslStatus = setPkcs11PrivateKey( pSslContext, pPrivateKeyPath );
+        }
+        else
+    #endif
+    {
+        /* Import the client certificate private key. */
+        sslStatus = SSL_CTX_use_PrivateKey_file( pSslContext,
+                                                 pPrivateKeyPath,
+                                                 SSL_FILETYPE_PEM );
+    }
+
+    if( sslStatus != 1 )
+    {
+        LogError( ( "Failed to import client certificate private key at %s.",
+                    pPrivateKeyPath ) );
+    }
+    else
+    {
+        LogDebug( ( "Successfully imported client certificate private key." ) );
+    }
+
+    return sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+
+    static size_t parsePkcs11Label( const char * pUri,
+                                    char * pLabel )
+    {
+        const char * pAttribute = NULL;
+        size_t labelLength = 0U;
+        uint8_t valid = 1U;
+        char hex[ 3 ] = { '\0', '\0', '\0' };
+
+        assert( pUri != NULL );
+        assert( pLabel != NULL );
+
+        /* Find the object attribute among the attributes separated by ';',
+         * which end at the optional query starting with '?'. */
+        pAttribute = &pUri[ sizeof( PKCS11_URI_SCHEME ) - 1U ];
+
+        while( ( *pAttribute != '\0' ) && ( *pAttribute != '?' ) &&
+               ( strncmp( pAttribute,
+                          PKCS11_URI_OBJECT_ATTRIBUTE,
+                          sizeof( PKCS11_URI_OBJECT_ATTRIBUTE ) - 1U ) != 0 ) )
+        {
+            pAttribute = strpbrk( pAttribute, ";?" );
+
+            if( pAttribute == NULL )
+            {
+                pAttribute = "";
+            }
+            else if( *pAttribute == ';' )
+            {
+                pAttribute++;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+
+        if( ( *pAttribute != '\0' ) && ( *pAttribute != '?' ) )
+        {
+            pAttribute = &pAttribute[ sizeof( PKCS11_URI_OBJECT_ATTRIBUTE ) - 1U ];
+        }
+        else
+        {
+            LogError( ( "PKCS #11 URI has no object attribute: %s.", pUri ) );
+            valid = 0U;
+        }
+
+        /* Copy the label, decoding the percent-encoded bytes. */
+        while( ( valid == 1U ) && ( *pAttribute != '\0' ) &&
+               ( *pAttribute != ';' ) && ( *pAttribute != '?' ) )
+        {
+            if( labelLength == OPENSSL_PKCS11_MAX_LABEL_LENGTH )
+            {
+                LogError( ( "PKCS #11 object label is longer than %u bytes.",
+                            ( unsigned int ) OPENSSL_PKCS11_MAX_LABEL_LENGTH ) );
+                valid = 0U;
+            }
+            else if( *pAttribute == '%' )
+            {
+                hex[ 0 ] = pAttribute[ 1 ];
+                hex[ 1 ] = ( hex[ 0 ] != '\0' ) ? pAttribute[ 2 ] : '\0';
+
+                if( ( isxdigit( ( unsigned char ) hex[ 0 ] ) != 0 ) &&
+                    ( isxdigit( ( unsigned char ) hex[ 1 ] ) != 0 ) )
+                {
+                    pLabel[ labelLength ] = ( char ) strtoul( hex, NULL, 16 );
+                    labelLength++;
+                    pAttribute = &pAttribute[ 3 ];
+                }
+                else
+                {
+                    LogError( ( "Invalid percent-encoding in PKCS #11 URI: %s.", pUri ) );
+                    valid = 0U;
+                }
+            }
+            else
+            {
+                pLabel[ labelLength ] = *pAttribute;
+                labelLength++;
+                pAttribute++;
+            }
+        }
+
+        return ( valid == 1U ) ? labelLength : 0U;
+    }
+/*-----------------------------------------------------------*/
+
+    static CK_RV openPkcs11Session( void )
+    {
+        CK_RV result = CKR_OK;
+
+        if( pkcs11Session == CK_INVALID_HANDLE )
+        {
+            result = C_GetFunctionList( &pPkcs11FunctionList );
+
+            /* Initializes the module if needed, then opens a session and
+             * logs in with the PIN configured for corePKCS11. */
+            if( result == CKR_OK )
+            {
+                result = xInitializePkcs11Session( &pkcs11Session );
+            }
+
+            if( result != CKR_OK )
+            {
+                LogError( ( "Opening a PKCS #11 session failed: CK_RV=0x%lx.",
+                            ( unsigned long ) result ) );
+                pkcs11Session = CK_INVALID_HANDLE;
+            }
+            else
+            {
+                LogDebug( ( "Opened the PKCS #11 session shared by the connections." ) );
+            }
+        }
+
+        return result;
+    }
+/*-----------------------------------------------------------*/
+
+    static ECDSA_SIG * pkcs11EcdsaSign( const unsigned char * pDigest,
+                                        int digestLength,
+                                        const BIGNUM * pInvK,
+                                        const BIGNUM * pR,
+                                        EC_KEY * pEcKey )
+    {
+        ECDSA_SIG * pSignature = NULL;
+        BIGNUM * pSigR = NULL, * pSigS = NULL;
+        CK_MECHANISM mechanism = { CKM_ECDSA, NULL, 0 };
+        CK_BYTE signature[ PKCS11_MAX_ECDSA_SIGNATURE_LENGTH ];
+        CK_ULONG signatureLength = sizeof( signature );
+        CK_OBJECT_HANDLE keyHandle = CK_INVALID_HANDLE;
+        CK_RV result = CKR_OK;
+
+        /* Precomputed values are only meaningful to a software signer. */
+        ( void ) pInvK;
+        ( void ) pR;
+
+        /* MISRA Rule 11.6 flags the following line for casting a pointer to
+         * an integer. This rule is suppressed because the ex_data of an
+         * EC_KEY can only store a pointer, so the object handle is stored as
+         * one by #setPkcs11PrivateKey. */
+        /* coverity[misra_c_2012_rule_11_6_violation] */
+        keyHandle = ( CK_OBJECT_HANDLE ) ( uintptr_t ) EC_KEY_get_ex_data( pEcKey, pkcs11KeyHandleIndex );
+
+        ( void ) pthread_mutex_lock( &pkcs11Mutex );
+
+        /* Reopen the session if the token closed it since the last
+         * signature. */
+        result = openPkcs11Session();
+
+        if( result == CKR_OK )
+        {
+            result = pPkcs11FunctionList->C_SignInit( pkcs11Session,
+                                                      &mechanism,
+                                                      keyHandle );
+        }
+
+        if( result == CKR_OK )
+        {
+            /* MISRA Rule 11.8 flags the following line for removing the const
+             * qualifier. This rule is suppressed because C_Sign does not
+             * modify the data to sign. */
+            /* coverity[misra_c_2012_rule_11_8_violation] */
+            result = pPkcs11FunctionList->C_Sign( pkcs11Session,
+                                                  ( CK_BYTE_PTR ) pDigest,
+                                                  ( CK_ULONG ) digestLength,
+                                                  signature,
+                                                  &signatureLength );
+        }
+
+        if( ( result == CKR_SESSION_HANDLE_INVALID ) ||
+            ( result == CKR_SESSION_CLOSED ) ||
+            ( result == CKR_USER_NOT_LOGGED_IN ) )
+        {
+            /* Open a new session for the next signature. */
+            pkcs11Session = CK_INVALID_HANDLE;
+        }
+
+        ( void ) pthread_mutex_unlock( &pkcs11Mutex );
+
+        if( result != CKR_OK )
+        {
+            LogError( ( "Signing with the PKCS #11 token failed: CK_RV=0x%lx.",
+                        ( unsigned long ) result ) );
+        }
+        else
+        {
+            /* The token returns r and s concatenated, each half as long as
+             * the signature. */
+            pSignature = ECDSA_SIG_new();
+            pSigR = BN_bin2bn( signature, ( int ) ( signatureLength / 2U ), NULL );
+            pSigS = BN_bin2bn( &signature[ signatureLength / 2U ],
+                               ( int ) ( signatureLength / 2U ),
+                               NULL );
+
+            if( ( pSignature == NULL ) || ( pSigR == NULL ) || ( pSigS == NULL ) ||
+                ( ECDSA_SIG_set0( pSignature, pSigR, pSigS ) != 1 ) )
+            {
+                LogError( ( "Converting the PKCS #11 signature failed." ) );
+                ECDSA_SIG_free( pSignature );
+                BN_free( pSigR );
+                BN_free( pSigS );
+                pSignature = NULL;
+            }
+        }
+
+        return pSignature;
+    }
+/*-----------------------------------------------------------*/
+
+    static int32_t setPkcs11PrivateKey( SSL_CTX * pSslContext,
+                                        const char * pPrivateKeyUri )
+    {
+        int32_t sslStatus = 0;
+        char label[ OPENSSL_PKCS11_MAX_LABEL_LENGTH ];
+        size_t labelLength = 0U;
+        X509 * pCertificate = NULL;
+        EC_KEY * pEcKey = NULL;
+        EVP_PKEY * pKey = NULL;
+        CK_OBJECT_HANDLE keyHandle = CK_INVALID_HANDLE;
+        CK_RV result = CKR_OK;
+        int ( * pSign )( int type,
+                         const unsigned char * pDigest,
+                         int digestLength,
+                         unsigned char * pSignature,
+                         unsigned int * pSignatureLength,
+                         const BIGNUM * pInvK,
+                         const BIGNUM * pR,
+                         EC_KEY * pEcKey ) = NULL;
+
+        assert( pSslContext != NULL );
+        assert( pPrivateKeyUri != NULL );
+
+        labelLength = parsePkcs11Label( pPrivateKeyUri, label );
+        pCertificate = SSL_CTX_get0_certificate( pSslContext );
+
+        if( pCertificate == NULL )
+        {
+            LogError( ( "A private key on a PKCS #11 token requires the client "
+                        "certificate, which provides the public key." ) );
+        }
+        else if( EVP_PKEY_get0_EC_KEY( X509_get0_pubkey( pCertificate ) ) == NULL )
+        {
+            LogError( ( "Only elliptic curve keys are supported on a PKCS #11 token." ) );
+        }
+        else if( labelLength > 0U )
+        {
+            /* Copy the public key, to which signing with the token is
+             * attached. */
+            pEcKey = EC_KEY_dup( EVP_PKEY_get0_EC_KEY( X509_get0_pubkey( pCertificate ) ) );
+            pKey = EVP_PKEY_new();
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        if( ( pEcKey != NULL ) && ( pKey != NULL ) )
+        {
+            ( void ) pthread_mutex_lock( &pkcs11Mutex );
+
+            if( pPkcs11EcKeyMethod == NULL )
+            {
+                /* Sign with the default method, which calls sign_sig to
+                 * compute the signature. */
+                pPkcs11EcKeyMethod = EC_KEY_METHOD_new( EC_KEY_get_default_method() );
+                pkcs11KeyHandleIndex = EC_KEY_get_ex_new_index( 0, NULL, NULL, NULL, NULL );
+
+                if( pPkcs11EcKeyMethod != NULL )
+                {
+                    EC_KEY_METHOD_get_sign( pPkcs11EcKeyMethod, &pSign, NULL, NULL );
+                    EC_KEY_METHOD_set_sign( pPkcs11EcKeyMethod, pSign, NULL, pkcs11EcdsaSign );
+                }
+            }
+
+            result = openPkcs11Session();
+
+            if( result == CKR_OK )
+            {
+                result = xFindObjectWithLabelAndClass( pkcs11Session,
+                                                       label,
+                                                       ( CK_ULONG ) labelLength,
+                                                       CKO_PRIVATE_KEY,
+                                                       &keyHandle );
+            }
+
+            ( void ) pthread_mutex_unlock( &pkcs11Mutex );
+
+            if( ( result != CKR_OK ) || ( keyHandle == CK_INVALID_HANDLE ) )
+            {
+                LogError( ( "Finding the private key %.*s on the PKCS #11 token "
+                            "failed: CK_RV=0x%lx.",
+                            ( int ) labelLength,
+                            label,
+                            ( unsigned long ) result ) );
+            }
+            /* MISRA Rule 11.6 flags the following line for casting an integer
+             * to a pointer. This rule is suppressed because the ex_data of an
+             * EC_KEY can only store a pointer. */
+            /* coverity[misra_c_2012_rule_11_6_violation] */
+            else if( ( pPkcs11EcKeyMethod != NULL ) && ( pkcs11KeyHandleIndex >= 0 ) &&
+                     ( EC_KEY_set_method( pEcKey, pPkcs11EcKeyMethod ) == 1 ) &&
+                     ( EC_KEY_set_ex_data( pEcKey,
+                                           pkcs11KeyHandleIndex,
+                                           ( void * ) ( uintptr_t ) keyHandle ) == 1 ) &&
+                     ( EVP_PKEY_assign_EC_KEY( pKey, pEcKey ) == 1 ) )
+            {
+                /* The key now owns the EC_KEY. */
+                pEcKey = NULL;
+                sslStatus = SSL_CTX_use_PrivateKey( pSslContext, pKey );
+            }
+            else
+            {
+                LogError( ( "Attaching the PKCS #11 token to the private key failed." ) );
+            }
+        }
+
+        /* The SSL context holds its own reference to the key. */
+        EC_KEY_free( pEcKey );
+        EVP_PKEY_free( pKey );
+
+        return sslStatus;
+    }
+/*-----------------------------------------------------------*/
+
+    static X509 * readPkcs11Certificate( const char * pCertificateUri )
+    {
+        X509 * pCertificate = NULL;
+        char label[ OPENSSL_PKCS11_MAX_LABEL_LENGTH ];
+        size_t labelLength = 0U;
+        CK_OBJECT_HANDLE certificateHandle = CK_INVALID_HANDLE;
+        CK_ATTRIBUTE certificateValue = { CKA_VALUE, NULL, 0U };
+        const unsigned char * pDer = NULL;
+        CK_RV result = CKR_OK;
+
+        assert( pCertificateUri != NULL );
+
+        labelLength = parsePkcs11Label( pCertificateUri, label );
+
+        if( labelLength > 0U )
+        {
+            ( void ) pthread_mutex_lock( &pkcs11Mutex );
+
+            result = openPkcs11Session();
+
+            if( result == CKR_OK )
+            {
+                result = xFindObjectWithLabelAndClass( pkcs11Session,
+                                                       label,
+                                                       ( CK_ULONG ) labelLength,
+                                                       CKO_CERTIFICATE,
+                                                       &certificateHandle );
+            }
+
+            if( ( result == CKR_OK ) && ( certificateHandle == CK_INVALID_HANDLE ) )
+            {
+                result = CKR_OBJECT_HANDLE_INVALID;
+            }
+
+            /* Query the length of the DER value, then read it. */
+            if( result == CKR_OK )
+            {
+                result = pPkcs11FunctionList->C_GetAttributeValue( pkcs11Session,
+                                                                   certificateHandle,
+                                                                   &certificateValue,
+                                                                   1U );
+            }
+
+            if( result == CKR_OK )
+            {
+                certificateValue.pValue = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_TRANSPORT, certificateValue.ulValueLen );
+                result = ( certificateValue.pValue == NULL ) ? CKR_HOST_MEMORY : CKR_OK;
+            }
+
+            if( result == CKR_OK )
+            {
+                result = pPkcs11FunctionList->C_GetAttributeValue( pkcs11Session,
+                                                                   certificateHandle,
+                                                                   &certificateValue,
+                                                                   1U );
+            }
+
+            ( void ) pthread_mutex_unlock( &pkcs11Mutex );
+
+            if( result != CKR_OK )
+            {
+                LogError( ( "Reading the certificate %.*s from the PKCS #11 "
+                            "token failed: CK_RV=0x%lx.",
+                            ( int ) labelLength,
+                            label,
+                            ( unsigned long ) result ) );
+            }
+            else
+            {
+                pDer = ( const unsigned char * ) certificateValue.pValue;
+                pCertificate = d2i_X509( NULL, &pDer, ( long ) certificateValue.ulValueLen );
+
+                if( pCertificate == NULL )
+                {
+                    LogError( ( "d2i_X509 failed to parse the certificate %.*s.",
+                                ( int ) labelLength,
+                                label ) );
+                }
+                else
+                {
+                    LogDebug( ( "Read the certificate %.*s from the PKCS #11 token.",
+                                ( int ) labelLength,
+                                label ) );
+                }
+            }
+
+            Allocator_Free( certificateValue.pValue );
+        }
+
+        return pCertificate;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( OPENSSL_PKCS11_ENABLED == 1 ) */
+
+static int32_t setCredentials( SSL_CTX * pSslContext,
+                               const OpensslCredentials_t * pOpensslCredentials )
+{
+    int32_t sslStatus = 0;
+
+    assert( pSslContext != NULL );
+    assert( pOpensslCredentials != NULL );
+
+    if( pOpensslCredentials->pRootCaPath != NULL )
+    {
+        sslStatus = setRootCa( pSslContext,
+                               pOpensslCredentials->pRootCaPath );
+    }
+
+    if( ( sslStatus == 1 ) &&
+        ( pOpensslCredentials->pClientCertPath != NULL ) )
+    {
+        sslStatus = setClientCertificate( pSslContext,
+                                          pOpensslCredentials->pClientCertPath );
+    }
+
+    if( ( sslStatus == 1 ) &&
+        ( pOpensslCredentials->pPrivateKeyPath != NULL ) )
+    {
+        sslStatus = setPrivateKey( pSslContext,
+                                   pOpensslCredentials->pPrivateKeyPath );
+    }
+
+    return sslStatus;
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t createSslContext( const OpensslCredentials_t * pOpensslCredentials,
+                                         SSL_CTX ** ppSslContext )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    int32_t sslStatus = 0;
+    SSL_CTX * pSslContext = NULL;
+
+    assert( pOpensslCredentials != NULL );
+    assert( ppSslContext != NULL );
+
+    #if ( OPENSSL_MINIMAL_INIT == 1 )
+        ( void ) pthread_once( &opensslInitOnce, initOpenssl );
+    #endif
+
+    pSslContext = SSL_CTX_new( TLS_client_method() );
+
+    if( pSslContext == NULL )
+    {
+        LogError( ( "Creation of a new SSL_CTX object failed." ) );
+        returnStatus = OPENSSL_API_ERROR;
+    }
+
+    /* Setup credentials. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        /* Enable partial writes for blocking calls to SSL_write to allow a
+         * payload larger than the maximum fragment length.
+         * The mask returned by SSL_CTX_set_mode does not need to be checked. */
+
+        /* MISRA Directive 4.6 flags the following line for using basic
+        * numerical type long. This directive is suppressed because openssl
+        * function #SSL_CTX_set_mode takes an argument of type long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        ( void ) SSL_CTX_set_mode( pSslContext,
+                                   ( long ) SSL_MODE_ENABLE_PARTIAL_WRITE );
+
+        sslStatus = setCredentials( pSslContext,
+                                    pOpensslCredentials );
+
+        if( sslStatus != 1 )
+        {
+            LogError( ( "Setting up credentials failed." ) );
+            returnStatus = OPENSSL_INVALID_CREDENTIALS;
+        }
+    }
+
+    /* Skip building the chain of recently verified server certificates if
+     * requested. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( pOpensslCredentials->cacheVerifiedChains == true ) )
+    {
+        SSL_CTX_set_cert_verify_callback( pSslContext, verifyCertificateChain, NULL );
+    }
+
+    /* Return the SSL context to the caller, or free it on error. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        *ppSslContext = pSslContext;
+    }
+    else if( pSslContext != NULL )
+    {
+        SSL_CTX_free( pSslContext );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t isSamePath( const char * pPath1,
+                           const char * pPath2 )
+{
+    uint8_t isSame = 0U;
+
+    if( ( pPath1 == NULL ) || ( pPath2 == NULL ) )
+    {
+        isSame = ( pPath1 == pPath2 ) ? 1U : 0U;
+    }
+    else if( strcmp( pPath1, pPath2 ) == 0 )
+    {
+        isSame = 1U;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return isSame;
+}
+/*-----------------------------------------------------------*/
+
+static SslContextCacheEntry_t * findCachedSslContext( const OpensslCredentials_t * pOpensslCredentials )
+{
+    SslContextCacheEntry_t * pEntry = NULL;
+    size_t i = 0U;
+
+    assert( pOpensslCredentials != NULL );
+
+    for( i = 0U; i < OPENSSL_SSL_CONTEXT_CACHE_SIZE; i++ )
+    {
+        if( ( sslContextCache[ i ].pSslContext != NULL ) &&
+            ( isSamePath( sslContextCache[ i ].pRootCaPath, pOpensslCredentials->pRootCaPath ) == 1U ) &&
+            ( isSamePath( sslContextCache[ i ].pClientCertPath, pOpensslCredentials->pClientCertPath ) == 1U ) &&
+            ( isSamePath( sslContextCache[ i ].pPrivateKeyPath, pOpensslCredentials->pPrivateKeyPath ) == 1U ) &&
+            ( sslContextCache[ i ].cacheVerifiedChains == pOpensslCredentials->cacheVerifiedChains ) &&
+            ( sslContextCache[ i ].cacheSession == pOpensslCredentials->cacheSession ) )
+        {
+            pEntry = &sslContextCache[ i ];
+            break;
+        }
+    }
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t copyCachedPath( const char * pPath,
+                               char ** ppCopy )
+{
+    uint8_t copied = 1U;
+
+    assert( ppCopy != NULL );
+
+    *ppCopy = NULL;
+
+    if( pPath != NULL )
+    {
+        *ppCopy = Allocator_Strndup( ALLOCATOR_SUBSYSTEM_TRANSPORT, pPath, strlen( pPath ) );
+
+        if( *ppCopy == NULL )
+        {
+            copied = 0U;
+        }
+    }
+
+    return copied;
+}
+/*-----------------------------------------------------------*/
+
+static void releaseCachedSslContext( SslContextCacheEntry_t * pEntry )
+{
+    assert( pEntry != NULL );
+
+    if( pEntry->pSslContext != NULL )
+    {
+        SSL_CTX_free( pEntry->pSslContext );
+    }
+
+    Allocator_Free( pEntry->pRootCaPath );
+    Allocator_Free( pEntry->pClientCertPath );
+    Allocator_Free( pEntry->pPrivateKeyPath );
+    ( void ) memset( pEntry, 0, sizeof( SslContextCacheEntry_t ) );
+}
+/*-----------------------------------------------------------*/
+
+static OpensslStatus_t acquireSslContext( const OpensslCredentials_t * pOpensslCredentials,
+                                          SSL_CTX ** ppSslContext )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    SslContextCacheEntry_t * pEntry = NULL;
+    size_t i = 0U;
+
+    assert( pOpensslCredentials != NULL );
+    assert( ppSslContext != NULL );
+
+    if( pOpensslCredentials->cacheSslContext == false )
+    {
+        returnStatus = createSslContext( pOpensslCredentials, ppSslContext );
+
+        if( ( returnStatus == OPENSSL_SUCCESS ) && ( pOpensslCredentials->cacheSession == true ) )
+        {
+            setupSessionCache( *ppSslContext );
+        }
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &sslContextCacheMutex );
+
+        pEntry = findCachedSslContext( pOpensslCredentials );
+
+        if( pEntry != NULL )
+        {
+            /* Hand a new reference to the cached context to the caller. */
+            ( void ) SSL_CTX_up_ref( pEntry->pSslContext );
+            *ppSslContext = pEntry->pSslContext;
+            LogDebug( ( "Reusing cached SSL context." ) );
+        }
+        else
+        {
+            returnStatus = createSslContext( pOpensslCredentials, ppSslContext );
+
+            /* The context is not shared yet, and the mutex keeps other
+             * connections from finding it until it is set up. */
+            if( ( returnStatus == OPENSSL_SUCCESS ) && ( pOpensslCredentials->cacheSession == true ) )
+            {
+                setupSessionCache( *ppSslContext );
+            }
+
+            /* Find a free entry for the new context. */
+            for( i = 0U; ( returnStatus == OPENSSL_SUCCESS ) && ( i < OPENSSL_SSL_CONTEXT_CACHE_SIZE ); i++ )
+            {
+                if( sslContextCache[ i ].pSslContext == NULL )
+                {
+                    pEntry = &sslContextCache[ i ];
+                    break;
+                }
+            }
+
+            /* The entry keys the context by copies of the paths, as the
+             * strings of the caller may not outlive the context. */
+            if( ( pEntry != NULL ) &&
+                ( ( copyCachedPath( pOpensslCredentials->pRootCaPath, &pEntry->pRootCaPath ) == 0U ) ||
+                  ( copyCachedPath( pOpensslCredentials->pClientCertPath, &pEntry->pClientCertPath ) == 0U ) ||
+                  ( copyCachedPath( pOpensslCredentials->pPrivateKeyPath, &pEntry->pPrivateKeyPath ) == 0U ) ) )
+            {
+                LogWarn( ( "Not enough memory to cache the SSL context: The SSL context will not be reused." ) );
+                releaseCachedSslContext( pEntry );
+            }
+            else if( pEntry != NULL )
+            {
+                /* The cache keeps its own reference to the context. */
+                ( void ) SSL_CTX_up_ref( *ppSslContext );
+                pEntry->cacheVerifiedChains = pOpensslCredentials->cacheVerifiedChains;
+                pEntry->cacheSession = pOpensslCredentials->cacheSession;
+                pEntry->pSslContext = *ppSslContext;
+            }
+            else if( returnStatus == OPENSSL_SUCCESS )
+            {
+                LogWarn( ( "SSL context cache is full: The SSL context will not be reused. "
+                           "Consider increasing OPENSSL_SSL_CONTEXT_CACHE_SIZE." ) );
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &sslContextCacheMutex );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void setupSessionCache( SSL_CTX * pSslContext )
+{
+    assert( pSslContext != NULL );
+
+    /* The mask returned by SSL_CTX_set_session_cache_mode does not need to be
+     * checked. */
+
+    /* MISRA Directive 4.6 flags the following line for using basic
+     * numerical type long. This directive is suppressed because openssl
+     * function #SSL_CTX_set_session_cache_mode takes an argument of type long. */
+    /* coverity[misra_c_2012_directive_4_6_violation] */
+    ( void ) SSL_CTX_set_session_cache_mode( pSslContext,
+                                             ( long ) ( SSL_SESS_CACHE_CLIENT |
+                                                        SSL_SESS_CACHE_NO_INTERNAL_STORE ) );
+    SSL_CTX_sess_set_new_cb( pSslContext, newSessionCallback );
+}
+/*-----------------------------------------------------------*/
+
+static SessionCacheEntry_t * findCachedSession( const char * pHostName,
+                                                uint16_t port,
+                                                const SSL_CTX * pSslContext )
+{
+    SessionCacheEntry_t * pEntry = NULL;
+    const char * pSessionHostName = NULL;
+    size_t i = 0U;
+
+    assert( pHostName != NULL );
+
+    for( i = 0U; i < OPENSSL_SESSION_CACHE_SIZE; i++ )
+    {
+        if( ( tlsSessionCache[ i ].pSession != NULL ) &&
+            ( tlsSessionCache[ i ].port == port ) &&
+            ( ( pSslContext == NULL ) || ( tlsSessionCache[ i ].pSslContext == pSslContext ) ) )
+        {
+            pSessionHostName = SSL_SESSION_get0_hostname( tlsSessionCache[ i ].pSession );
+
+            if( ( pSessionHostName != NULL ) &&
+                ( strcmp( pSessionHostName, pHostName ) == 0 ) )
+            {
+                pEntry = &tlsSessionCache[ i ];
+                break;
+            }
+        }
+    }
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static void releaseCachedSession( SessionCacheEntry_t * pEntry )
+{
+    assert( pEntry != NULL );
+    assert( pEntry->pSession != NULL );
+
+    SSL_SESSION_free( pEntry->pSession );
+    SSL_CTX_free( pEntry->pSslContext );
+    ( void ) memset( pEntry, 0, sizeof( SessionCacheEntry_t ) );
+}
+/*-----------------------------------------------------------*/
+
+static SSL_SESSION * readSessionFile( const char * pSessionFilePath )
+{
+    FILE * pSessionFile = NULL;
+    SSL_SESSION * pSession = NULL;
+
+    assert( pSessionFilePath != NULL );
+
+    /* MISRA Rule 21.6 flags the following line for using the standard
+     * library input/output function `fopen()`. This rule is suppressed because
+     * openssl function #PEM_read_SSL_SESSION takes an argument of type
+     * `FILE *` for reading the session file. */
+    /* coverity[misra_c_2012_rule_21_6_violation] */
+    pSessionFile = fopen( pSessionFilePath, "r" );
+
+    if( pSessionFile == NULL )
+    {
+        LogDebug( ( "No saved TLS session found: SESSION_FILE_PATH=%s.",
+                    pSessionFilePath ) );
+    }
+    else
+    {
+        pSession = PEM_read_SSL_SESSION( pSessionFile, NULL, NULL, NULL );
+
+        if( pSession == NULL )
+        {
+            LogWarn( ( "PEM_read_SSL_SESSION failed to parse saved TLS session." ) );
+        }
+
+        /* MISRA Rule 21.6 flags the following line for using the standard
+         * library input/output function `fclose()`. This rule is suppressed
+         * because the file opened with `fopen()` needs to be closed by
+         * calling `fclose()`. */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        if( fclose( pSessionFile ) != 0 )
+        {
+            LogWarn( ( "fclose failed to close file %s",
+                       pSessionFilePath ) );
+        }
+    }
+
+    return pSession;
+}
+/*-----------------------------------------------------------*/
+
+static void writeSessionFile( const SSL_SESSION * pSession,
+                              const char * pSessionFilePath )
+{
+    FILE * pSessionFile = NULL;
+
+    assert( pSession != NULL );
+    assert( pSessionFilePath != NULL );
+
+    /* MISRA Rule 21.6 flags the following line for using the standard
+     * library input/output function `fopen()`. This rule is suppressed because
+     * openssl function #PEM_write_SSL_SESSION takes an argument of type
+     * `FILE *` for writing the session file. */
+    /* coverity[misra_c_2012_rule_21_6_violation] */
+    pSessionFile = fopen( pSessionFilePath, "w" );
+
+    if( pSessionFile == NULL )
+    {
+        LogWarn( ( "fopen failed to open the TLS session file: "
+                   "SESSION_FILE_PATH=%s.",
+                   pSessionFilePath ) );
+    }
+    else
+    {
+        if( PEM_write_SSL_SESSION( pSessionFile, pSession ) != 1 )
+        {
+            LogWarn( ( "PEM_write_SSL_SESSION failed to save the TLS session." ) );
+        }
+
+        /* MISRA Rule 21.6 flags the following line for using the standard
+         * library input/output function `fclose()`. This rule is suppressed
+         * because the file opened with `fopen()` needs to be closed by
+         * calling `fclose()`. */
+        /* coverity[misra_c_2012_rule_21_6_violation] */
+        if( fclose( pSessionFile ) != 0 )
+        {
+            LogWarn( ( "fclose failed to close file %s",
+                       pSessionFilePath ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static SSL_SESSION * readSharedSession( const char * pHostName )
+{
+    SSL_SESSION * pSession = NULL;
+    SharedSessionSlot_t * pSlot = NULL;
+    uint8_t encoding[ OPENSSL_SHARED_SESSION_MAX_LENGTH ];
+    const uint8_t * pEncoding = NULL;
+    uint32_t sequence = 0U;
+    uint32_t length = 0U;
+    bool copied = false;
+    size_t i = 0U;
+
+    assert( pSharedSessionCache != NULL );
+    assert( pHostName != NULL );
+
+    for( i = 0U; ( pSession == NULL ) && ( i < OPENSSL_SHARED_SESSION_SLOTS ); i++ )
+    {
+        pSlot = &( pSharedSessionCache->slots[ i ] );
+        sequence = __atomic_load_n( &( pSlot->sequence ), __ATOMIC_ACQUIRE );
+        length = __atomic_load_n( &( pSlot->sessionLength ), __ATOMIC_RELAXED );
+        copied = false;
+
+        /* What is read of a slot is only trusted once the sequence shows that
+         * no process wrote the slot meanwhile. */
+        if( ( ( sequence & 1U ) == 0U ) &&
+            ( length > 0U ) &&
+            ( length <= OPENSSL_SHARED_SESSION_MAX_LENGTH ) &&
+            ( strncmp( pSlot->hostName, pHostName, SHARED_SESSION_HOST_SIZE ) == 0 ) )
+        {
+            ( void ) memcpy( encoding, pSlot->session, length );
+            __atomic_thread_fence( __ATOMIC_ACQUIRE );
+            copied = ( __atomic_load_n( &( pSlot->sequence ), __ATOMIC_RELAXED ) == sequence ) ? true : false;
+        }
+
+        if( copied == true )
+        {
+            pEncoding = encoding;
+
+            /* MISRA Directive 4.6 flags the following line for using basic
+             * numerical type long. This directive is suppressed because
+             * openssl function #d2i_SSL_SESSION takes an argument of type
+             * long. */
+            /* coverity[misra_c_2012_directive_4_6_violation] */
+            pSession = d2i_SSL_SESSION( NULL, &pEncoding, ( long ) length );
+
+            if( pSession == NULL )
+            {
+                LogWarn( ( "d2i_SSL_SESSION failed to parse the shared TLS session for %s.",
+                           pHostName ) );
+            }
+        }
+    }
+
+    return pSession;
+}
+/*-----------------------------------------------------------*/
+
+static void writeSharedSession( SSL_SESSION * pSession,
+                                const char * pHostName )
+{
+    SharedSessionSlot_t * pSlot = NULL;
+    uint8_t * pEncoding = NULL;
+    size_t hostNameLength = 0U;
+    uint32_t sequence = 0U;
+    int32_t encodingLength = 0;
+    size_t i = 0U;
+
+    assert( pSharedSessionCache != NULL );
+    assert( pSession != NULL );
+    assert( pHostName != NULL );
+
+    hostNameLength = strlen( pHostName );
+    encodingLength = ( int32_t ) i2d_SSL_SESSION( pSession, NULL );
+
+    if( ( encodingLength <= 0 ) ||
+        ( ( uint32_t ) encodingLength > OPENSSL_SHARED_SESSION_MAX_LENGTH ) ||
+        ( hostNameLength >= SHARED_SESSION_HOST_SIZE ) )
+    {
+        LogWarn( ( "The TLS session for %s does not fit in the shared session cache. "
+                   "Consider increasing OPENSSL_SHARED_SESSION_MAX_LENGTH.",
+                   pHostName ) );
+    }
+    else
+    {
+        /* The slot of the host, else a free slot, else the next one in turn.
+         * A slot being written may be chosen wrongly, which only costs a
+         * handshake. */
+        for( i = 0U; ( pSlot == NULL ) && ( i < OPENSSL_SHARED_SESSION_SLOTS ); i++ )
+        {
+            if( strncmp( pSharedSessionCache->slots[ i ].hostName, pHostName, SHARED_SESSION_HOST_SIZE ) == 0 )
+            {
+                pSlot = &( pSharedSessionCache->slots[ i ] );
+            }
+        }
+
+        for( i = 0U; ( pSlot == NULL ) && ( i < OPENSSL_SHARED_SESSION_SLOTS ); i++ )
+        {
+            if( __atomic_load_n( &( pSharedSessionCache->slots[ i ].sessionLength ), __ATOMIC_RELAXED ) == 0U )
+            {
+                pSlot = &( pSharedSessionCache->slots[ i ] );
+            }
+        }
+
+        if( pSlot == NULL )
+        {
+            i = __atomic_fetch_add( &( pSharedSessionCache->nextVictim ), 1U, __ATOMIC_RELAXED ) %
+                OPENSSL_SHARED_SESSION_SLOTS;
+            pSlot = &( pSharedSessionCache->slots[ i ] );
+        }
+
+        sequence = __atomic_load_n( &( pSlot->sequence ), __ATOMIC_RELAXED );
+
+        /* A process already writing the slot keeps it, and this session is
+         * only cached in memory. */
+        if( ( ( sequence & 1U ) == 0U ) &&
+            ( __atomic_compare_exchange_n( &( pSlot->sequence ), &sequence, sequence + 1U,
+                                           false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) == true ) )
+        {
+            /* The slot is seen as being written before any of it changes. */
+            __atomic_thread_fence( __ATOMIC_RELEASE );
+
+            ( void ) memcpy( pSlot->hostName, pHostName, hostNameLength + 1U );
+            pEncoding = pSlot->session;
+            ( void ) i2d_SSL_SESSION( pSession, &pEncoding );
+            __atomic_store_n( &( pSlot->sessionLength ), ( uint32_t ) encodingLength, __ATOMIC_RELAXED );
+            __atomic_store_n( &( pSlot->sequence ), sequence + 2U, __ATOMIC_RELEASE );
+
+            LogDebug( ( "Shared TLS session for %s.", pHostName ) );
+        }
+        else
+        {
+            LogDebug( ( "The shared session slot for %s is being written by another process.",
+                        pHostName ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* MISRA Directive 4.6 flags the following line for using basic numerical type
+ * int. This directive is suppressed because the callback type expected by
+ * openssl function #SSL_CTX_sess_set_new_cb returns an int. */
+/* coverity[misra_c_2012_directive_4_6_violation] */
+static int newSessionCallback( SSL * pSsl,
+                               SSL_SESSION * pSession )
+{
+    int sessionKept = 0;
+    const OpensslParams_t * pOpensslParams = NULL;
+    const char * pHostName = NULL;
+    SSL_CTX * pSslContext = NULL;
+    SessionCacheEntry_t * pEntry = NULL;
+    size_t i = 0U;
+
+    /* Only connections that enabled session caching have their parameters
+     * attached to the SSL object. */
+    pOpensslParams = SSL_get_app_data( pSsl );
+    pHostName = SSL_SESSION_get0_hostname( pSession );
+
+    if( ( pOpensslParams != NULL ) && ( pHostName != NULL ) )
+    {
+        if( pOpensslParams->pSessionFilePath != NULL )
+        {
+            writeSessionFile( pSession, pOpensslParams->pSessionFilePath );
+        }
+
+        if( pSharedSessionCache != NULL )
+        {
+            writeSharedSession( pSession, pHostName );
+        }
+
+        /* The SSL object holds a reference to its context while the callback
+         * runs. */
+        pSslContext = SSL_get_SSL_CTX( pSsl );
+
+        ( void ) pthread_mutex_lock( &tlsSessionCacheMutex );
+
+        /* Replace the session cached for the server, whichever context it was
+         * issued on, or use a free entry. */
+        pEntry = findCachedSession( pHostName, pOpensslParams->serverPort, NULL );
+
+        for( i = 0U; ( pEntry == NULL ) && ( i < OPENSSL_SESSION_CACHE_SIZE ); i++ )
+        {
+            if( tlsSessionCache[ i ].pSession == NULL )
+            {
+                pEntry = &tlsSessionCache[ i ];
+            }
+        }
+
+        if( pEntry != NULL )
+        {
+            if( pEntry->pSession != NULL )
+            {
+                releaseCachedSession( pEntry );
+            }
+
+            /* The cache takes over the reference passed to the callback, and
+             * keeps the context alive so that no other context created at
+             * the same address can match the entry. */
+            ( void ) SSL_CTX_up_ref( pSslContext );
+            pEntry->pSession = pSession;
+            pEntry->pSslContext = pSslContext;
+            pEntry->port = pOpensslParams->serverPort;
+            sessionKept = 1;
+            LogDebug( ( "Cached TLS session for %s.", pHostName ) );
+        }
+        else
+        {
+            LogWarn( ( "TLS session cache is full: The session will not be resumed. "
+                       "Consider increasing OPENSSL_SESSION_CACHE_SIZE." ) );
+        }
+
+        ( void ) pthread_mutex_unlock( &tlsSessionCacheMutex );
+    }
+
+    return sessionKept;
+}
+/*-----------------------------------------------------------*/
+
+static void setupSessionResumption( SSL_CTX * pSslContext,
+                                    OpensslParams_t * pOpensslParams,
+                                    const OpensslCredentials_t * pOpensslCredentials )
+{
+    int32_t sslStatus = 0;
+    const SessionCacheEntry_t * pEntry = NULL;
+    SSL_SESSION * pSavedSession = NULL;
+    const char * pSavedHostName = NULL;
+    uint8_t sessionFound = 0U;
+
+    assert( pSslContext != NULL );
+    assert( pOpensslParams != NULL );
+    assert( pOpensslCredentials != NULL );
+    assert( pOpensslCredentials->sniHostName != NULL );
+
+    /* The context hands new client sessions to #newSessionCallback since
+     * #acquireSslContext created it. Attach the connection parameters for the callback to find. */
+    sslStatus = SSL_set_app_data( pOpensslParams->pSsl, pOpensslParams );
+
+    if( sslStatus != 1 )
+    {
+        LogWarn( ( "SSL_set_app_data failed: New TLS sessions will not be cached." ) );
+    }
+
+    /* Offer the session cached in memory, if it was issued on the context
+     * of this connection. SSL_set_session takes its own reference, so the
+     * entry stays valid for other connections. */
+    ( void ) pthread_mutex_lock( &tlsSessionCacheMutex );
+
+    pEntry = findCachedSession( pOpensslCredentials->sniHostName,
+                                pOpensslParams->serverPort,
+                                pSslContext );
+
+    if( pEntry != NULL )
+    {
+        sslStatus = SSL_set_session( pOpensslParams->pSsl, pEntry->pSession );
+        sessionFound = 1U;
+    }
+
+    ( void ) pthread_mutex_unlock( &tlsSessionCacheMutex );
+
+    /* Then to the session written by a process sharing the cache. */
+    if( ( sessionFound == 0U ) && ( pSharedSessionCache != NULL ) )
+    {
+        pSavedSession = readSharedSession( pOpensslCredentials->sniHostName );
+
+        if( pSavedSession != NULL )
+        {
+            sslStatus = SSL_set_session( pOpensslParams->pSsl, pSavedSession );
+            sessionFound = 1U;
+            SSL_SESSION_free( pSavedSession );
+            pSavedSession = NULL;
+        }
+    }
+
+    /* Fall back to the session saved by a previous process. */
+    if( ( sessionFound == 0U ) && ( pOpensslParams->pSessionFilePath != NULL ) )
+    {
+        pSavedSession = readSessionFile( pOpensslParams->pSessionFilePath );
+
+        if( pSavedSession != NULL )
+        {
+            pSavedHostName = SSL_SESSION_get0_hostname( pSavedSession );
+
+            if( ( pSavedHostName != NULL ) &&
+                ( strcmp( pSavedHostName, pOpensslCredentials->sniHostName ) == 0 ) )
+            {
+                sslStatus = SSL_set_session( pOpensslParams->pSsl, pSavedSession );
+                sessionFound = 1U;
+            }
+            else
+            {
+                LogDebug( ( "Saved TLS session is for a different host." ) );
+            }
+
+            SSL_SESSION_free( pSavedSession );
+        }
+    }
+
+    if( sessionFound == 0U )
+    {
+        LogDebug( ( "No TLS session to resume for %s.",
+                    pOpensslCredentials->sniHostName ) );
+    }
+    else if( sslStatus != 1 )
+    {
+        LogWarn( ( "SSL_set_session failed: Performing a full TLS handshake." ) );
+    }
+    else
+    {
+        LogDebug( ( "Offering TLS session for %s.",
+                    pOpensslCredentials->sniHostName ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void detectCpuFeatures( void )
+{
+    #if defined( __x86_64__ ) || defined( __i386__ )
+        unsigned int eax = 0U, ebx = 0U, ecx = 0U, edx = 0U;
+
+        /* AES-NI and PCLMULQDQ, which GHASH uses. */
+        if( __get_cpuid( 1U, &eax, &ebx, &ecx, &edx ) != 0 )
+        {
+            aesGcmAccelerated = ( ( ecx & bit_AES ) != 0U ) && ( ( ecx & bit_PCLMUL ) != 0U );
+        }
+    #elif defined( __aarch64__ ) && defined( HWCAP_AES ) && defined( HWCAP_PMULL )
+        unsigned long hwcap = getauxval( AT_HWCAP );
+
+        aesGcmAccelerated = ( ( hwcap & HWCAP_AES ) != 0UL ) && ( ( hwcap & HWCAP_PMULL ) != 0UL );
+    #elif defined( __arm__ ) && defined( HWCAP2_AES ) && defined( HWCAP2_PMULL )
+        unsigned long hwcap2 = getauxval( AT_HWCAP2 );
+
+        aesGcmAccelerated = ( ( hwcap2 & HWCAP2_AES ) != 0UL ) && ( ( hwcap2 & HWCAP2_PMULL ) != 0UL );
+    #endif
+
+    /* Other CPUs keep the AES-GCM first order of OpenSSL. */
+    LogInfo( ( "AES-GCM is %saccelerated by the CPU: Preferring %s.",
+               aesGcmAccelerated ? "" : "not ",
+               aesGcmAccelerated ? "AES-GCM" : "ChaCha20-Poly1305" ) );
+}
+/*-----------------------------------------------------------*/
+
+static void setCipherOrder( SSL * pSsl,
+                            OpensslCipherPolicy_t cipherPolicy )
+{
+    bool preferAesGcm = true;
+
+    if( cipherPolicy == OPENSSL_CIPHERS_AUTO )
+    {
+        ( void ) pthread_once( &cpuFeaturesOnce, detectCpuFeatures );
+        preferAesGcm = aesGcmAccelerated;
+    }
+    else
+    {
+        preferAesGcm = ( cipherPolicy != OPENSSL_CIPHERS_PREFER_CHACHA20 );
+    }
+
+    /* A failure leaves the default order of OpenSSL, which does not fail the
+     * connection. */
+    if( SSL_set_ciphersuites( pSsl,
+                              preferAesGcm ?
+                              TLS13_AES_GCM_SUITES ":" TLS13_CHACHA20_SUITES :
+                              TLS13_CHACHA20_SUITES ":" TLS13_AES_GCM_SUITES ) != 1 )
+    {
+        LogError( ( "SSL_set_ciphersuites failed to set the TLS 1.3 cipher suites." ) );
+    }
+
+    if( SSL_set_cipher_list( pSsl,
+                             preferAesGcm ?
+                             TLS12_AES_GCM_CIPHERS ":" TLS12_CHACHA20_CIPHERS :
+                             TLS12_CHACHA20_CIPHERS ":" TLS12_AES_GCM_CIPHERS ) != 1 )
+    {
+        LogError( ( "SSL_set_cipher_list failed to set the TLS 1.2 ciphers." ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void setOptionalConfigurations( SSL * pSsl,
+                                       const OpensslCredentials_t * pOpensslCredentials )
+{
+    int32_t sslStatus = -1;
+    int16_t readBufferLength = 0;
+    uint8_t maxFragmentMode = TLSEXT_max_fragment_length_DISABLED;
+
+    assert( pSsl != NULL );
+    assert( pOpensslCredentials != NULL );
+
+    /* Set TLS ALPN if requested. */
+    if( ( pOpensslCredentials->pAlpnProtos != NULL ) &&
+        ( pOpensslCredentials->alpnProtosLen > 0U ) )
+    {
+        LogDebug( ( "Setting ALPN protos." ) );
+        sslStatus = SSL_set_alpn_protos( pSsl,
+                                         ( const uint8_t * ) pOpensslCredentials->pAlpnProtos,
+                                         ( uint32_t ) pOpensslCredentials->alpnProtosLen );
+
+        if( sslStatus != 0 )
+        {
+            LogError( ( "SSL_set_alpn_protos failed to set ALPN protos. %s",
+                        pOpensslCredentials->pAlpnProtos ) );
+        }
+    }
+
+    /* Set the order of the cipher suites if requested. */
+    if( pOpensslCredentials->cipherPolicy != OPENSSL_CIPHERS_DEFAULT )
+    {
+        setCipherOrder( pSsl, pOpensslCredentials->cipherPolicy );
+    }
+
+    /* Set TLS MFLN if requested. */
+    if( pOpensslCredentials->maxFragmentLength > 0U )
+    {
+        LogDebug( ( "Setting max send fragment length %u.",
+                    pOpensslCredentials->maxFragmentLength ) );
+
+        /* Set the maximum send fragment length. */
+
+        /* MISRA Directive 4.6 flags the following line for using basic
+         * numerical type long. This directive is suppressed because openssl
+         * function #SSL_set_max_send_fragment expects a length argument
+         * type of long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        sslStatus = ( int32_t ) SSL_set_max_send_fragment( pSsl,
+                                                           ( long ) pOpensslCredentials->maxFragmentLength );
+
+        if( sslStatus != 1 )
+        {
+            LogError( ( "Failed to set max send fragment length %u.",
+                        pOpensslCredentials->maxFragmentLength ) );
+        }
+        else
+        {
+            readBufferLength = ( int16_t ) pOpensslCredentials->maxFragmentLength +
+                               SSL3_RT_MAX_ENCRYPTED_OVERHEAD;
+
+            /* Change the size of the read buffer to match the
+             * maximum fragment length + some extra bytes for overhead. */
+            SSL_set_default_read_buffer_len( pSsl,
+                                             ( size_t ) readBufferLength );
+        }
+    }
+
+    /* Enable SNI if requested. */
+    if( pOpensslCredentials->sniHostName != NULL )
+    {
+        LogDebug( ( "Setting server name %s for SNI.",
+                    pOpensslCredentials->sniHostName ) );
+
+        /* MISRA Rule 11.8 flags the following line for removing the const
+         * qualifier from the pointed to type. This rule is suppressed because
+         * openssl implementation of #SSL_set_tlsext_host_name internally casts
+         * the pointer to a string literal to a `void *` pointer. */
+        /* coverity[misra_c_2012_rule_11_8_violation] */
+        sslStatus = ( int32_t ) SSL_set_tlsext_host_name( pSsl,
+                                                          pOpensslCredentials->sniHostName );
+
+        if( sslStatus != 1 )
+        {
+            LogError( ( "Failed to set server name %s for SNI.",
+                        pOpensslCredentials->sniHostName ) );
+        }
+    }
+
+    /* Free the record buffers while the connection is idle if requested. */
+    if( pOpensslCredentials->releaseIdleBuffers == true )
+    {
+        LogDebug( ( "Releasing the record buffers of idle connections." ) );
+
+        /* The mask returned by SSL_set_mode does not need to be checked. */
+
+        /* MISRA Directive 4.6 flags the following line for using basic
+         * numerical type long. This directive is suppressed because openssl
+         * function #SSL_set_mode takes an argument of type long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        ( void ) SSL_set_mode( pSsl, ( long ) SSL_MODE_RELEASE_BUFFERS );
+
+        /* Ask the server to send records no larger than those sent, so that
+         * the read buffer allocated for each record is as small. */
+        switch( pOpensslCredentials->maxFragmentLength )
+        {
+            case 512U:
+                maxFragmentMode = TLSEXT_max_fragment_length_512;
+                break;
+
+            case 1024U:
+                maxFragmentMode = TLSEXT_max_fragment_length_1024;
+                break;
+
+            case 2048U:
+                maxFragmentMode = TLSEXT_max_fragment_length_2048;
+                break;
+
+            case 4096U:
+                maxFragmentMode = TLSEXT_max_fragment_length_4096;
+                break;
+
+            default:
+                /* Other lengths cannot be negotiated. */
+                break;
+        }
+
+        if( ( maxFragmentMode != TLSEXT_max_fragment_length_DISABLED ) &&
+            ( SSL_set_tlsext_max_fragment_length( pSsl, maxFragmentMode ) != 1 ) )
+        {
+            LogError( ( "Failed to negotiate max fragment length %u.",
+                        pOpensslCredentials->maxFragmentLength ) );
+        }
+    }
+
+    /* Ask the server to staple the OCSP response for its certificate if
+     * requested. */
+    if( pOpensslCredentials->ocspMode != OPENSSL_OCSP_DISABLED )
+    {
+        LogDebug( ( "Requesting a stapled OCSP response." ) );
+
+        /* MISRA Directive 4.6 flags the following line for using basic
+         * numerical type long. This directive is suppressed because openssl
+         * function #SSL_set_tlsext_status_type returns a long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        if( SSL_set_tlsext_status_type( pSsl, TLSEXT_STATUSTYPE_ocsp ) != 1L )
+        {
+            LogError( ( "Failed to request a stapled OCSP response." ) );
+        }
+    }
+
+    /* Let the kernel take over the TLS record layer after the handshake if
+     * requested. This has to be set before the handshake starts. */
+    if( pOpensslCredentials->enableKtls == true )
+    {
+        #if ( KTLS_SUPPORTED == 1 )
+            LogDebug( ( "Enabling kernel TLS offload." ) );
+            ( void ) SSL_set_options( pSsl, SSL_OP_ENABLE_KTLS );
+        #else
+            LogWarn( ( "Kernel TLS offload is not supported by this OpenSSL build." ) );
+        #endif
+    }
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_Connect( NetworkContext_t * pNetworkContext,
+                                 const ServerInfo_t * pServerInfo,
+                                 const OpensslCredentials_t * pOpensslCredentials,
+                                 uint32_t sendTimeoutMs,
+                                 uint32_t recvTimeoutMs )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    uint8_t sslObjectCreated = 0;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = 0U;
+    #endif
+
+    /* Validate parameters. */
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pOpensslCredentials == NULL )
+    {
+        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    /* Establish the TCP connection. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        /* Discard any data buffered from a previous connection. */
+        pOpensslParams->recvBufferHead = 0U;
+        pOpensslParams->recvBufferLength = 0U;
+
+        pOpensslParams->pSessionFilePath = ( pOpensslCredentials->cacheSession == true ) ?
+                                           pOpensslCredentials->pSessionFilePath : NULL;
+
+        #if ( TRANSPORT_STATS_ENABLED == 1 )
+            ( void ) memset( &pOpensslParams->stats, 0, sizeof( TransportStats_t ) );
+            socketStatus = Sockets_ConnectWithStats( &pOpensslParams->socketDescriptor,
+                                                     pServerInfo,
+                                                     sendTimeoutMs,
+                                                     recvTimeoutMs,
+                                                     &pOpensslParams->stats );
+        #else
+            socketStatus = Sockets_Connect( &pOpensslParams->socketDescriptor,
+                                            pServerInfo,
+                                            sendTimeoutMs,
+                                            recvTimeoutMs );
+        #endif
+
+        /* Convert socket wrapper status to openssl status. */
+        returnStatus = convertToOpensslStatus( socketStatus );
+    }
+
+    /* Create a new SSL session. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        returnStatus = createSslObject( pServerInfo, pOpensslParams, pOpensslCredentials );
+
+        if( returnStatus == OPENSSL_SUCCESS )
+        {
+            sslObjectCreated = 1u;
+        }
+    }
+
+    /* Setup the socket to use for communication. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        #if ( TRANSPORT_STATS_ENABLED == 1 )
+            startTimeUs = TransportStats_GetTimeUs();
+        #endif
+
+        returnStatus = tlsHandshake( pServerInfo,
+                                     pOpensslParams,
+                                     pOpensslCredentials );
+
+        #if ( TRANSPORT_STATS_ENABLED == 1 )
+            TransportStats_RecordLatency( &pOpensslParams->stats,
+                                          TRANSPORT_STATS_TLS_HANDSHAKE,
+                                          startTimeUs );
+        #endif
+    }
+
+    /* Clean up on error. */
+    if( ( returnStatus != OPENSSL_SUCCESS ) && ( sslObjectCreated == 1u ) )
+    {
+        SSL_free( pOpensslParams->pSsl );
+        pOpensslParams->pSsl = NULL;
+    }
+
+    /* Log failure or success depending on status. */
+    if( returnStatus != OPENSSL_SUCCESS )
+    {
+        LogError( ( "Failed to establish a TLS connection." ) );
+    }
+    else
+    {
+        LogDebug( ( "Established a TLS connection." ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_ConnectStart( NetworkContext_t * pNetworkContext,
+                                      const ServerInfo_t * pServerInfo,
+                                      const OpensslCredentials_t * pOpensslCredentials,
+                                      uint32_t sendTimeoutMs,
+                                      uint32_t recvTimeoutMs )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+    /* Validate parameters. */
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pOpensslCredentials == NULL )
+    {
+        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pOpensslCredentials->pEarlyData != NULL )
+    {
+        LogError( ( "Parameter check failed: Early data is only sent by Openssl_Connect." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    /* Start the TCP connection. */
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        /* Discard any data buffered from a previous connection. */
+        pOpensslParams->recvBufferHead = 0U;
+        pOpensslParams->recvBufferLength = 0U;
+
+        pOpensslParams->pSessionFilePath = ( pOpensslCredentials->cacheSession == true ) ?
+                                           pOpensslCredentials->pSessionFilePath : NULL;
+        pOpensslParams->pSsl = NULL;
+        pOpensslParams->pConnectServerInfo = pServerInfo;
+        pOpensslParams->pConnectCredentials = pOpensslCredentials;
+        pOpensslParams->connectState = OPENSSL_CONNECT_STATE_TCP;
+
+        socketStatus = Sockets_ConnectStart( &pOpensslParams->socketConnectContext,
+                                             pServerInfo,
+                                             sendTimeoutMs,
+                                             recvTimeoutMs );
+
+        returnStatus = finishConnectStep( pOpensslParams,
+                                          advanceConnection( pOpensslParams, socketStatus ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_ConnectPoll( NetworkContext_t * pNetworkContext )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_SUCCESS;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        switch( pOpensslParams->connectState )
+        {
+            case OPENSSL_CONNECT_STATE_TCP:
+                socketStatus = Sockets_ConnectPoll( &pOpensslParams->socketConnectContext );
+                returnStatus = finishConnectStep( pOpensslParams,
+                                                  advanceConnection( pOpensslParams, socketStatus ) );
+                break;
+
+            case OPENSSL_CONNECT_STATE_TLS:
+                returnStatus = finishConnectStep( pOpensslParams,
+                                                  continueTlsHandshake( pOpensslParams ) );
+                break;
+
+            default:
+                LogError( ( "Parameter check failed: No connection is in progress." ) );
+                returnStatus = OPENSSL_INVALID_PARAMETER;
+                break;
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_ConnectAbort( NetworkContext_t * pNetworkContext )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        if( pOpensslParams->connectState == OPENSSL_CONNECT_STATE_TCP )
+        {
+            ( void ) Sockets_ConnectAbort( &pOpensslParams->socketConnectContext );
+        }
+        else if( pOpensslParams->connectState == OPENSSL_CONNECT_STATE_TLS )
+        {
+            if( pOpensslParams->pSsl != NULL )
+            {
+                SSL_free( pOpensslParams->pSsl );
+                pOpensslParams->pSsl = NULL;
+            }
+
+            ( void ) Sockets_Disconnect( pOpensslParams->socketDescriptor );
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+
+        pOpensslParams->connectState = OPENSSL_CONNECT_STATE_IDLE;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_Disconnect( const NetworkContext_t * pNetworkContext )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    SocketStatus_t socketStatus = SOCKETS_INVALID_PARAMETER;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        /* No need to update the status here. The socket status
+         * SOCKETS_INVALID_PARAMETER will be converted to openssl
+         * status OPENSSL_INVALID_PARAMETER before returning from this
+         * function. */
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        if( pOpensslParams->pSsl != NULL )
+        {
+            /* SSL shutdown should be called twice: once to send "close notify" and
+             * once more to receive the peer's "close notify". */
+            if( SSL_shutdown( pOpensslParams->pSsl ) == 0 )
+            {
+                ( void ) SSL_shutdown( pOpensslParams->pSsl );
+            }
+
+            SSL_free( pOpensslParams->pSsl );
+        }
+
+        /* Tear down the socket connection, pNetworkContext != NULL here. */
+        socketStatus = Sockets_Disconnect( pOpensslParams->socketDescriptor );
+    }
+
+    return convertToOpensslStatus( socketStatus );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t recvFromSsl( OpensslParams_t * pOpensslParams,
+                            void * pBuffer,
+                            size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0;
+    int32_t sslError = 0;
+
+    assert( pOpensslParams != NULL );
+    assert( pOpensslParams->pSsl != NULL );
+
+    /* SSL read of data. */
+    bytesReceived = ( int32_t ) SSL_read( pOpensslParams->pSsl,
+                                          pBuffer,
+                                          ( int32_t ) bytesToRecv );
+    COUNT_IO_CALL( pOpensslParams );
+
+    /* Handle error return status if transport read did not succeed. */
+    if( bytesReceived <= 0 )
+    {
+        sslError = SSL_get_error( pOpensslParams->pSsl, bytesReceived );
+
+        if( sslError == SSL_ERROR_WANT_READ )
+        {
+            /* The OpenSSL documentation mentions that SSL_Read can provide a return code of
+             * SSL_ERROR_WANT_READ in blocking mode, if the SSL context is not configured with
+             * with the SSL_MODE_AUTO_RETRY. This error code means that the SSL_read()
+             * operation needs to be retried to complete the read operation.
+             * Thus, setting the return value of this function as zero to represent that no
+             * data was received from the network. */
+            bytesReceived = 0;
+        }
+        else
+        {
+            LogError( ( "Failed to receive data over network: SSL_read failed: "
+                        "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
+
+            /* The transport interface requires zero return code only when the receive operation can
+             * be retried to achieve success. Thus, convert a zero error code to a negative return
+             * value as this cannot be retried. */
+            if( bytesReceived == 0 )
+            {
+                bytesReceived = -1;
+            }
+        }
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t recvBuffered( OpensslParams_t * pOpensslParams,
+                             uint8_t * pBuffer,
+                             size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0;
+    size_t bytesToCopy = 0U;
+
+    assert( pOpensslParams != NULL );
+    assert( pOpensslParams->pRecvBuffer != NULL );
+    assert( pBuffer != NULL );
+
+    if( pOpensslParams->recvBufferLength == 0U )
+    {
+        if( bytesToRecv >= pOpensslParams->recvBufferSize )
+        {
+            /* The request cannot be served from the buffer anyway, so read
+             * directly into the caller's buffer to avoid an extra copy. */
+            bytesReceived = recvFromSsl( pOpensslParams,
+                                         pBuffer,
+                                         bytesToRecv );
+        }
+        else
+        {
+            /* Read as much decrypted data as is available to serve the
+             * following reads from memory. */
+            bytesReceived = recvFromSsl( pOpensslParams,
+                                         pOpensslParams->pRecvBuffer,
+                                         pOpensslParams->recvBufferSize );
+
+            if( bytesReceived > 0 )
+            {
+                pOpensslParams->recvBufferHead = 0U;
+                pOpensslParams->recvBufferLength = ( size_t ) bytesReceived;
+                bytesReceived = 0;
+            }
+        }
+    }
+
+    /* Serve the request from the buffered data. A short read is returned if
+     * fewer bytes are buffered than requested. */
+    if( pOpensslParams->recvBufferLength > 0U )
+    {
+        bytesToCopy = ( bytesToRecv < pOpensslParams->recvBufferLength ) ?
+                      bytesToRecv : pOpensslParams->recvBufferLength;
+
+        ( void ) memcpy( pBuffer,
+                         &pOpensslParams->pRecvBuffer[ pOpensslParams->recvBufferHead ],
+                         bytesToCopy );
+
+        pOpensslParams->recvBufferHead += bytesToCopy;
+        pOpensslParams->recvBufferLength -= bytesToCopy;
+        bytesReceived = ( int32_t ) bytesToCopy;
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+/* MISRA Rule 8.13 flags the following line for not using the const qualifier
+ * on `pNetworkContext`. Indeed, the object pointed by it is not modified
+ * by OpenSSL, but other implementations of `TransportRecv_t` may do so. */
+int32_t Openssl_Recv( NetworkContext_t * pNetworkContext,
+                      void * pBuffer,
+                      size_t bytesToRecv )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    int32_t bytesReceived = 0;
+    size_t bytesAllowed = bytesToRecv;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+    #endif
+
+    TRACE_PROBE2( tls_recv_start, pNetworkContext, bytesToRecv );
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else if( pNetworkContext->pParams->pSsl != NULL )
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+            bytesAllowed = TransportThrottle_Wait( pOpensslParams->trafficClass, bytesToRecv );
+        #endif
+
+        if( ( pOpensslParams->pRecvBuffer != NULL ) &&
+            ( pOpensslParams->recvBufferSize > 0U ) )
+        {
+            bytesReceived = recvBuffered( pOpensslParams,
+                                          pBuffer,
+                                          bytesAllowed );
+        }
+        else
+        {
+            bytesReceived = recvFromSsl( pOpensslParams,
+                                         pBuffer,
+                                         bytesAllowed );
+        }
+
+        #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+            if( bytesReceived > 0 )
+            {
+                TransportThrottle_Consume( ( size_t ) bytesReceived );
+            }
+        #endif
+
+        #if ( TRANSPORT_STATS_ENABLED == 1 )
+            TransportStats_RecordRecv( &pOpensslParams->stats, bytesReceived, startTimeUs );
+        #endif
+    }
+    else
+    {
+        LogError( ( "Failed to receive data over network: "
+                    "SSL object in network context is NULL." ) );
+    }
+
+    TRACE_PROBE2( tls_recv_done, pNetworkContext, bytesReceived );
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t sendWithKtls( OpensslParams_t * pOpensslParams,
+                             const void * pBuffer,
+                             size_t bytesToSend )
+{
+    int32_t bytesSent = 0;
+
+    assert( pOpensslParams != NULL );
+
+    /* MSG_NOSIGNAL keeps a connection closed by the server from raising
+     * SIGPIPE, which SSL_write does not raise either. */
+    bytesSent = ( int32_t ) send( pOpensslParams->socketDescriptor,
+                                  pBuffer,
+                                  bytesToSend,
+                                  MSG_NOSIGNAL );
+    COUNT_IO_CALL( pOpensslParams );
+
+    if( bytesSent < 0 )
+    {
+        LogError( ( "Failed to send data over network: send failed: %s.",
+                    strerror( errno ) ) );
+        bytesSent = -1;
+    }
+    else if( bytesSent == 0 )
+    {
+        /* As with SSL_write, a send that made no progress cannot be retried. */
+        LogError( ( "Failed to send data over network: connection closed." ) );
+        bytesSent = -1;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+/* MISRA Rule 8.13 flags the following line for not using the const qualifier
+ * on `pNetworkContext`. Indeed, the object pointed by it is not modified
+ * by OpenSSL, but other implementations of `TransportSend_t` may do so. */
+int32_t Openssl_Send( NetworkContext_t * pNetworkContext,
+                      const void * pBuffer,
+                      size_t bytesToSend )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    int32_t bytesSent = 0;
+    int32_t sslError = 0;
+    size_t bytesAllowed = bytesToSend;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+    #endif
+
+    /* Unused parameter when logs are disabled. */
+    ( void ) sslError;
+
+    TRACE_PROBE2( tls_send_start, pNetworkContext, bytesToSend );
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else if( ( pNetworkContext->pParams->pSsl != NULL ) &&
+             ( pNetworkContext->pParams->ktlsSendEnabled == true ) )
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+            bytesAllowed = TransportThrottle_Wait( pOpensslParams->trafficClass, bytesToSend );
+        #endif
+
+        /* The kernel encrypts the data written to the socket. */
+        bytesSent = sendWithKtls( pOpensslParams, pBuffer, bytesAllowed );
+    }
+    else if( pNetworkContext->pParams->pSsl != NULL )
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+            bytesAllowed = TransportThrottle_Wait( pOpensslParams->trafficClass, bytesToSend );
+        #endif
+
+        /* SSL write of data. */
+        bytesSent = ( int32_t ) SSL_write( pOpensslParams->pSsl,
+                                           pBuffer,
+                                           ( int32_t ) bytesAllowed );
+        COUNT_IO_CALL( pOpensslParams );
+
+        if( bytesSent <= 0 )
+        {
+            sslError = SSL_get_error( pOpensslParams->pSsl, bytesSent );
+
+            LogError( ( "Failed to send data over network: SSL_write of OpenSSL failed: "
+                        "ErrorStatus=%s.", ERR_reason_error_string( sslError ) ) );
+
+            /* As the SSL context is configured for blocking mode, the SSL_write() function
+             * does not return an SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE error code.
+             * The SSL_ERROR_WANT_READ and SSL_ERROR_WANT_WRITE error codes signify that
+             * the write operation can be retried.
+             * However, in the blocking mode, as the SSL_write() function does not return
+             * either of the error codes, we cannot retry the operation on failure, and thus,
+             * this function will never return a zero error code.
+             */
+
+            /* The transport interface requires zero return code only when the send operation can
+             * be retried to achieve success. Thus, convert a zero error code to a negative return
+             * value as this cannot be retried. */
+            if( bytesSent == 0 )
+            {
+                bytesSent = -1;
+            }
+        }
+    }
+    else
+    {
+        LogError( ( "Failed to send data over network: "
+                    "SSL object in network context is NULL." ) );
+    }
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        if( bytesSent > 0 )
+        {
+            TransportThrottle_Consume( ( size_t ) bytesSent );
+        }
+    #endif
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        if( pOpensslParams != NULL )
+        {
+            TransportStats_RecordSend( &pOpensslParams->stats, bytesToSend, bytesSent, startTimeUs );
+        }
+    #endif
+
+    TRACE_PROBE2( tls_send_done, pNetworkContext, bytesSent );
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Openssl_Writev( NetworkContext_t * pNetworkContext,
+                        const struct iovec * pIoVec,
+                        size_t ioVecCount )
+{
+    OpensslParams_t * pOpensslParams = NULL;
+    int32_t bytesSent = 0, vectorBytesSent = 0;
+    size_t totalLength = 0U, offset = 0U, i = 0U;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+    }
+    else if( ( pIoVec == NULL ) || ( ioVecCount == 0U ) )
+    {
+        LogError( ( "Parameter check failed: pIoVec is NULL or ioVecCount is 0." ) );
+    }
+    else
+    {
+        pOpensslParams = pNetworkContext->pParams;
+
+        for( i = 0U; i < ioVecCount; i++ )
+        {
+            totalLength += pIoVec[ i ].iov_len;
+        }
+
+        if( ( pOpensslParams->pSendBuffer != NULL ) &&
+            ( totalLength <= pOpensslParams->sendBufferSize ) )
+        {
+            /* Gather the buffers so that they are encrypted into one record. */
+            for( i = 0U; i < ioVecCount; i++ )
+            {
+                ( void ) memcpy( &pOpensslParams->pSendBuffer[ offset ],
+                                 pIoVec[ i ].iov_base,
+                                 pIoVec[ i ].iov_len );
+                offset += pIoVec[ i ].iov_len;
+            }
+
+            bytesSent = Openssl_Send( pNetworkContext,
+                                      pOpensslParams->pSendBuffer,
+                                      totalLength );
+        }
+        else
+        {
+            /* Send the buffers one at a time, stopping at the first short
+             * write or error. */
+            for( i = 0U; i < ioVecCount; i++ )
+            {
+                if( pIoVec[ i ].iov_len == 0U )
+                {
+                    continue;
+                }
+
+                vectorBytesSent = Openssl_Send( pNetworkContext,
+                                                pIoVec[ i ].iov_base,
+                                                pIoVec[ i ].iov_len );
+
+                if( vectorBytesSent < 0 )
+                {
+                    /* Report the error only if nothing has been sent yet.
+                     * Otherwise, report the bytes that were sent. */
+                    if( bytesSent == 0 )
+                    {
+                        bytesSent = vectorBytesSent;
+                    }
+
+                    break;
+                }
+
+                bytesSent += vectorBytesSent;
+
+                if( ( size_t ) vectorBytesSent < pIoVec[ i ].iov_len )
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Openssl_SendFile( NetworkContext_t * pNetworkContext,
+                          int32_t fileDescriptor,
+                          off_t offset,
+                          size_t bytesToSend )
+{
+    int32_t bytesSent = 0;
+    ssize_t bytesRead = 0;
+    size_t chunkLength = 0U;
+    uint8_t fileBuffer[ OPENSSL_SENDFILE_BUFFER_SIZE ];
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        bytesSent = -1;
+    }
+    else if( pNetworkContext->pParams->pSsl == NULL )
+    {
+        LogError( ( "Failed to send file over network: "
+                    "SSL object in network context is NULL." ) );
+        bytesSent = -1;
+    }
+    else if( fileDescriptor < 0 )
+    {
+        LogError( ( "Parameter check failed: fileDescriptor is invalid." ) );
+        bytesSent = -1;
+    }
+    else if( bytesToSend > ( size_t ) INT32_MAX )
+    {
+        /* The transport returns the number of bytes sent as an int32_t. */
+        LogError( ( "Parameter check failed: bytesToSend is greater than INT32_MAX." ) );
+        bytesSent = -1;
+    }
+
+    #if ( KTLS_SUPPORTED == 1 )
+        else if( pNetworkContext->pParams->ktlsSendEnabled == true )
+        {
+            /* The kernel reads the file and encrypts it without a copy to
+             * user space. */
+            size_t bytesAllowed = bytesToSend;
+
+            #if ( TRANSPORT_STATS_ENABLED == 1 )
+                uint64_t startTimeUs = TransportStats_GetTimeUs();
+            #endif
+
+            #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+                bytesAllowed = TransportThrottle_Wait( pNetworkContext->pParams->trafficClass, bytesToSend );
+            #endif
+
+            bytesSent = ( int32_t ) SSL_sendfile( pNetworkContext->pParams->pSsl,
+                                                  fileDescriptor,
+                                                  offset,
+                                                  bytesAllowed,
+                                                  0 );
+            COUNT_IO_CALL( pNetworkContext->pParams );
+
+            if( bytesSent <= 0 )
+            {
+                LogError( ( "Failed to send file over network: SSL_sendfile failed: "
+                            "SSL_get_error=%d.",
+                            SSL_get_error( pNetworkContext->pParams->pSsl, bytesSent ) ) );
+                bytesSent = -1;
+            }
+
+            #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+                if( bytesSent > 0 )
+                {
+                    TransportThrottle_Consume( ( size_t ) bytesSent );
+                }
+            #endif
+
+            #if ( TRANSPORT_STATS_ENABLED == 1 )
+                TransportStats_RecordSend( &pNetworkContext->pParams->stats, bytesToSend, bytesSent, startTimeUs );
+            #endif
+        }
+    #endif /* if ( KTLS_SUPPORTED == 1 ) */
+    else
+    {
+        chunkLength = ( bytesToSend < sizeof( fileBuffer ) ) ? bytesToSend : sizeof( fileBuffer );
+        bytesRead = pread( fileDescriptor, fileBuffer, chunkLength, offset );
+
+        if( bytesRead > 0 )
+        {
+            bytesSent = Openssl_Send( pNetworkContext, fileBuffer, ( size_t ) bytesRead );
+        }
+        else
+        {
+            LogError( ( "Failed to read the file to send: %s.",
+                        ( bytesRead == 0 ) ? "end of file" : strerror( errno ) ) );
+            bytesSent = -1;
+        }
+    }
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_GetBufferUsage( const NetworkContext_t * pNetworkContext,
+                                        OpensslBufferUsage_t * pUsage )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    const OpensslParams_t * pOpensslParams = NULL;
+    const SSL_SESSION * pSession = NULL;
+    uint8_t maxFragmentMode = TLSEXT_max_fragment_length_DISABLED;
+    size_t fragmentLength = SSL3_RT_MAX_PLAIN_LENGTH;
+    size_t sendFragmentLength = 0U;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pUsage == NULL )
+    {
+        LogError( ( "Parameter check failed: pUsage is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pNetworkContext->pParams->pSsl == NULL )
+    {
+        LogError( ( "Parameter check failed: The connection is not established." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        pOpensslParams = pNetworkContext->pParams;
+        ( void ) memset( pUsage, 0, sizeof( OpensslBufferUsage_t ) );
+
+        /* A fragment length negotiated with the server bounds the records
+         * of both directions. */
+        pSession = SSL_get_session( pOpensslParams->pSsl );
+
+        if( pSession != NULL )
+        {
+            maxFragmentMode = SSL_SESSION_get_max_fragment_length( pSession );
+        }
+
+        if( ( maxFragmentMode >= TLSEXT_max_fragment_length_512 ) &&
+            ( maxFragmentMode <= TLSEXT_max_fragment_length_4096 ) )
+        {
+            fragmentLength = ( size_t ) 512U << ( maxFragmentMode - TLSEXT_max_fragment_length_512 );
+        }
+
+        sendFragmentLength = fragmentLength;
+
+        if( ( pOpensslParams->maxSendFragment > 0U ) &&
+            ( pOpensslParams->maxSendFragment < sendFragmentLength ) )
+        {
+            sendFragmentLength = pOpensslParams->maxSendFragment;
+        }
+
+        /* MISRA Directive 4.6 flags the following line for using basic
+         * numerical type long. This directive is suppressed because openssl
+         * function #SSL_get_mode returns a long. */
+        /* coverity[misra_c_2012_directive_4_6_violation] */
+        pUsage->buffersReleased = ( ( ( unsigned long ) SSL_get_mode( pOpensslParams->pSsl ) &
+                                      ( unsigned long ) SSL_MODE_RELEASE_BUFFERS ) != 0UL );
+
+        /* Released buffers are only held while a record is partly read or
+         * partly written. */
+        if( ( pUsage->buffersReleased == false ) ||
+            ( SSL_has_pending( pOpensslParams->pSsl ) == 1 ) )
+        {
+            pUsage->readBufferBytes = fragmentLength + RECORD_BUFFER_OVERHEAD;
+        }
+
+        if( ( pUsage->buffersReleased == false ) ||
+            ( SSL_want( pOpensslParams->pSsl ) == SSL_WRITING ) )
+        {
+            pUsage->writeBufferBytes = sendFragmentLength + RECORD_BUFFER_OVERHEAD;
+        }
+
+        if( pOpensslParams->pRecvBuffer != NULL )
+        {
+            pUsage->transportBufferBytes += pOpensslParams->recvBufferSize;
+        }
+
+        if( pOpensslParams->pSendBuffer != NULL )
+        {
+            pUsage->transportBufferBytes += pOpensslParams->sendBufferSize;
+        }
+
+        pUsage->pendingBytes = pOpensslParams->recvBufferLength +
+                               ( size_t ) SSL_pending( pOpensslParams->pSsl );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+
+    OpensslStatus_t Openssl_GetStats( const NetworkContext_t * pNetworkContext,
+                                      TransportStats_t * pStats )
+    {
+        OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+        if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+        {
+            LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+            returnStatus = OPENSSL_INVALID_PARAMETER;
+        }
+        else if( pStats == NULL )
+        {
+            LogError( ( "Parameter check failed: pStats is NULL." ) );
+            returnStatus = OPENSSL_INVALID_PARAMETER;
+        }
+        else
+        {
+            ( void ) memcpy( pStats, &pNetworkContext->pParams->stats, sizeof( TransportStats_t ) );
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+    OpensslStatus_t Openssl_ResetStats( NetworkContext_t * pNetworkContext )
+    {
+        OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+        if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+        {
+            LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+            returnStatus = OPENSSL_INVALID_PARAMETER;
+        }
+        else
+        {
+            ( void ) memset( &pNetworkContext->pParams->stats, 0, sizeof( TransportStats_t ) );
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TRANSPORT_STATS_ENABLED == 1 ) */
+
+OpensslStatus_t Openssl_ReleaseCredentials( const OpensslCredentials_t * pOpensslCredentials )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    SslContextCacheEntry_t * pEntry = NULL;
+    const char * pSessionHostName = NULL;
+    size_t i = 0U;
+
+    if( pOpensslCredentials == NULL )
+    {
+        LogError( ( "Parameter check failed: pOpensslCredentials is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) pthread_mutex_lock( &sslContextCacheMutex );
+
+        pEntry = findCachedSslContext( pOpensslCredentials );
+
+        if( pEntry != NULL )
+        {
+            /* Drop the reference held by the cache. Open connections using
+             * the context keep it alive until they are disconnected. */
+            releaseCachedSslContext( pEntry );
+        }
+        else
+        {
+            LogDebug( ( "No cached SSL context found for the credentials." ) );
+        }
+
+        ( void ) pthread_mutex_unlock( &sslContextCacheMutex );
+    }
+
+    /* Drop the TLS sessions cached for the SNI host, on any port. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) &&
+        ( pOpensslCredentials->sniHostName != NULL ) )
+    {
+        ( void ) pthread_mutex_lock( &tlsSessionCacheMutex );
+
+        for( i = 0U; i < OPENSSL_SESSION_CACHE_SIZE; i++ )
+        {
+            if( tlsSessionCache[ i ].pSession != NULL )
+            {
+                pSessionHostName = SSL_SESSION_get0_hostname( tlsSessionCache[ i ].pSession );
+
+                if( ( pSessionHostName != NULL ) &&
+                    ( strcmp( pSessionHostName, pOpensslCredentials->sniHostName ) == 0 ) )
+                {
+                    releaseCachedSession( &tlsSessionCache[ i ] );
+                }
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &tlsSessionCacheMutex );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_UseAllocator( void )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+
+    /* OpenSSL refuses the functions once it has allocated memory. */
+    if( CRYPTO_set_mem_functions( opensslMalloc, opensslRealloc, opensslFree ) != 1 )
+    {
+        LogError( ( "CRYPTO_set_mem_functions failed: OpenSSL allocated memory already." ) );
+        returnStatus = OPENSSL_API_ERROR;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+OpensslStatus_t Openssl_OpenSharedSessionCache( const char * pFilePath )
+{
+    OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+    SharedSessionCache_t * pCache = NULL;
+    struct stat fileStat;
+    int fileDescriptor = -1;
+    uint32_t magic = 0U;
+
+    if( pFilePath == NULL )
+    {
+        LogError( ( "Parameter check failed: pFilePath is NULL." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else if( pSharedSessionCache != NULL )
+    {
+        LogError( ( "A shared TLS session cache is already open." ) );
+        returnStatus = OPENSSL_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Only the owner may read the master secrets of the sessions. */
+        fileDescriptor = open( pFilePath, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR );
+
+        if( fileDescriptor < 0 )
+        {
+            LogError( ( "open failed to open the shared TLS session cache %s: %s.",
+                        pFilePath,
+                        strerror( errno ) ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+    }
+
+    /* The processes creating the file at the same time extend it to the
+     * same size. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) &&
+        ( ( fstat( fileDescriptor, &fileStat ) != 0 ) ||
+          ( ( fileStat.st_size < ( off_t ) sizeof( SharedSessionCache_t ) ) &&
+            ( ftruncate( fileDescriptor, ( off_t ) sizeof( SharedSessionCache_t ) ) != 0 ) ) ) )
+    {
+        LogError( ( "Failed to size the shared TLS session cache %s: %s.",
+                    pFilePath,
+                    strerror( errno ) ) );
+        returnStatus = OPENSSL_API_ERROR;
+    }
+
+    if( returnStatus == OPENSSL_SUCCESS )
+    {
+        pCache = mmap( NULL, sizeof( SharedSessionCache_t ), PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0 );
+
+        if( pCache == MAP_FAILED )
+        {
+            LogError( ( "mmap failed to map the shared TLS session cache %s: %s.",
+                        pFilePath,
+                        strerror( errno ) ) );
+            pCache = NULL;
+            returnStatus = OPENSSL_API_ERROR;
+        }
+    }
+
+    /* The mapping outlives the descriptor, and is inherited by the children
+     * the process forks. */
+    if( fileDescriptor >= 0 )
+    {
+        ( void ) close( fileDescriptor );
+    }
+
+    if( pCache != NULL )
+    {
+        magic = __atomic_load_n( &( pCache->magic ), __ATOMIC_ACQUIRE );
+
+        /* A new file is zeroed. Every process finding it so lays it out the
+         * same way. */
+        if( magic == 0U )
+        {
+            __atomic_store_n( &( pCache->slotCount ), OPENSSL_SHARED_SESSION_SLOTS, __ATOMIC_RELAXED );
+            __atomic_store_n( &( pCache->sessionSize ), OPENSSL_SHARED_SESSION_MAX_LENGTH, __ATOMIC_RELAXED );
+            __atomic_store_n( &( pCache->magic ), SHARED_SESSION_CACHE_MAGIC, __ATOMIC_RELEASE );
+        }
+        else if( ( magic != SHARED_SESSION_CACHE_MAGIC ) ||
+                 ( __atomic_load_n( &( pCache->slotCount ), __ATOMIC_RELAXED ) != OPENSSL_SHARED_SESSION_SLOTS ) ||
+                 ( __atomic_load_n( &( pCache->sessionSize ), __ATOMIC_RELAXED ) != OPENSSL_SHARED_SESSION_MAX_LENGTH ) )
+        {
+            LogError( ( "The shared TLS session cache %s is laid out for other dimensions.",
+                        pFilePath ) );
+            ( void ) munmap( pCache, sizeof( SharedSessionCache_t ) );
+            pCache = NULL;
+            returnStatus = OPENSSL_API_ERROR;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( pCache != NULL )
+    {
+        pSharedSessionCache = pCache;
+        LogDebug( ( "Opened the shared TLS session cache %s.", pFilePath ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+void Openssl_CloseSharedSessionCache( void )
+{
+    if( pSharedSessionCache != NULL )
+    {
+        ( void ) munmap( pSharedSessionCache, sizeof( SharedSessionCache_t ) );
+        pSharedSessionCache = NULL;
+    }
+}
+/*-----------------------------------------------------------*/
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+
+    OpensslStatus_t Openssl_ReleasePkcs11Credentials( void )
+    {
+        size_t i = 0U;
+
+        ( void ) pthread_mutex_lock( &sslContextCacheMutex );
+
+        for( i = 0U; i < OPENSSL_SSL_CONTEXT_CACHE_SIZE; i++ )
+        {
+            if( ( sslContextCache[ i ].pSslContext != NULL ) &&
+                ( IS_PKCS11_URI( sslContextCache[ i ].pRootCaPath ) ||
+                  IS_PKCS11_URI( sslContextCache[ i ].pClientCertPath ) ||
+                  IS_PKCS11_URI( sslContextCache[ i ].pPrivateKeyPath ) ) )
+            {
+                /* Open connections keep the context alive until they are
+                 * disconnected, as in #Openssl_ReleaseCredentials. */
+                releaseCachedSslContext( &sslContextCache[ i ] );
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &sslContextCacheMutex );
+
+        LogDebug( ( "Released the SSL contexts built from the PKCS #11 token." ) );
+
+        return OPENSSL_SUCCESS;
+    }
+/*-----------------------------------------------------------*/
+
+    OpensslStatus_t Openssl_ClosePkcs11Session( void )
+    {
+        OpensslStatus_t returnStatus = OPENSSL_SUCCESS;
+        CK_RV result = CKR_OK;
+
+        ( void ) pthread_mutex_lock( &pkcs11Mutex );
+
+        if( pkcs11Session != CK_INVALID_HANDLE )
+        {
+            result = pPkcs11FunctionList->C_CloseSession( pkcs11Session );
+            pkcs11Session = CK_INVALID_HANDLE;
+        }
+
+        ( void ) pthread_mutex_unlock( &pkcs11Mutex );
+
+        if( result != CKR_OK )
+        {
+            LogError( ( "Closing the PKCS #11 session failed: CK_RV=0x%lx.",
+                        ( unsigned long ) result ) );
+            returnStatus = OPENSSL_API_ERROR;
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( OPENSSL_PKCS11_ENABLED == 1 ) */
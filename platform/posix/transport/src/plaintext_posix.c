@@ -26,13 +26,26 @@
 
 /* POSIX socket includes. */
 #include <errno.h>
+#include <limits.h>
+#include <poll.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 
 #include "plaintext_posix.h"
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Count a system call made on the socket of a connection in its
+ * statistics.
+ */
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+    #define COUNT_IO_CALL( pPlaintextParams )    ( ( pPlaintextParams )->stats.ioCalls++ )
+#else
+    #define COUNT_IO_CALL( pPlaintextParams )    ( ( void ) ( pPlaintextParams ) )
+#endif
+
+/*-----------------------------------------------------------*/
+
 /* Each compilation unit must define the NetworkContext struct. */
 struct NetworkContext
 {
@@ -48,6 +61,63 @@ struct NetworkContext
  */
 static void logTransportError( int32_t errorNumber );
 
+/**
+ * @brief Check whether an error number indicates that a non-blocking socket
+ * operation would have blocked.
+ *
+ * @param[in] errorNumber Error number set by send/recv.
+ *
+ * @return 1 if the operation should be retried once the socket is ready;
+ * 0 otherwise.
+ */
+static uint8_t isWouldBlock( int32_t errorNumber );
+
+/**
+ * @brief Wait until the socket is ready for the requested operation.
+ *
+ * Unlike select(), poll() is not limited to descriptors below FD_SETSIZE.
+ *
+ * @param[in] socketDescriptor The socket to wait on.
+ * @param[in] events The poll events to wait for, POLLIN or POLLOUT.
+ * @param[in] timeoutMs Maximum time to wait. 0 makes the poll return immediately.
+ *
+ * @return Positive value if the socket is ready; 0 on timeout; negative value
+ * on error.
+ */
+static int32_t waitForSocket( int32_t socketDescriptor,
+                              int16_t events,
+                              uint32_t timeoutMs );
+
+/**
+ * @brief Receive data from the socket, waiting up to the cached receive
+ * timeout if no data is pending.
+ *
+ * @param[in] pPlaintextParams Parameters of the connection.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Size of @p pBuffer.
+ *
+ * @return Number of bytes received if successful; 0 on timeout; negative
+ * value on error.
+ */
+static int32_t recvFromSocket( PlaintextParams_t * pPlaintextParams,
+                               void * pBuffer,
+                               size_t bytesToRecv );
+
+/**
+ * @brief Serve a receive request through the read-ahead buffer of the
+ * connection, refilling it from the socket when it is empty.
+ *
+ * @param[in] pPlaintextParams Parameters of the connection.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes copied into @p pBuffer if successful; 0 if no data
+ * is available before the receive timeout; negative value on error.
+ */
+static int32_t recvBuffered( PlaintextParams_t * pPlaintextParams,
+                             uint8_t * pBuffer,
+                             size_t bytesToRecv );
+
 /*-----------------------------------------------------------*/
 
 static void logTransportError( int32_t errorNumber )
@@ -59,6 +129,42 @@ static void logTransportError( int32_t errorNumber )
 }
 /*-----------------------------------------------------------*/
 
+static uint8_t isWouldBlock( int32_t errorNumber )
+{
+    uint8_t wouldBlock = 0U;
+
+    /* EAGAIN and EWOULDBLOCK may have the same value, so they cannot be
+     * used as labels of the same switch statement. */
+    if( ( errorNumber == EAGAIN ) || ( errorNumber == EWOULDBLOCK ) )
+    {
+        wouldBlock = 1U;
+    }
+
+    return wouldBlock;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t waitForSocket( int32_t socketDescriptor,
+                              int16_t events,
+                              uint32_t timeoutMs )
+{
+    struct pollfd fileDescriptor;
+    int32_t pollTimeoutMs = INT_MAX;
+
+    fileDescriptor.fd = socketDescriptor;
+    fileDescriptor.events = events;
+    fileDescriptor.revents = 0;
+
+    /* The timeout argument of poll() is a signed int. */
+    if( timeoutMs < ( uint32_t ) INT_MAX )
+    {
+        pollTimeoutMs = ( int32_t ) timeoutMs;
+    }
+
+    return ( int32_t ) poll( &fileDescriptor, 1U, pollTimeoutMs );
+}
+/*-----------------------------------------------------------*/
+
 SocketStatus_t Plaintext_Connect( NetworkContext_t * pNetworkContext,
                                   const ServerInfo_t * pServerInfo,
                                   uint32_t sendTimeoutMs,
@@ -76,10 +182,29 @@ SocketStatus_t Plaintext_Connect( NetworkContext_t * pNetworkContext,
     else
     {
         pPlaintextParams = pNetworkContext->pParams;
-        returnStatus = Sockets_Connect( &pPlaintextParams->socketDescriptor,
-                                        pServerInfo,
-                                        sendTimeoutMs,
-                                        recvTimeoutMs );
+
+        #if ( TRANSPORT_STATS_ENABLED == 1 )
+            ( void ) memset( &pPlaintextParams->stats, 0, sizeof( TransportStats_t ) );
+            returnStatus = Sockets_ConnectWithStats( &pPlaintextParams->socketDescriptor,
+                                                     pServerInfo,
+                                                     sendTimeoutMs,
+                                                     recvTimeoutMs,
+                                                     &pPlaintextParams->stats );
+        #else
+            returnStatus = Sockets_Connect( &pPlaintextParams->socketDescriptor,
+                                            pServerInfo,
+                                            sendTimeoutMs,
+                                            recvTimeoutMs );
+        #endif
+
+        /* Cache the timeouts to avoid querying the socket on every send and
+         * receive. */
+        pPlaintextParams->sendTimeoutMs = sendTimeoutMs;
+        pPlaintextParams->recvTimeoutMs = recvTimeoutMs;
+
+        /* Discard any data buffered from a previous connection. */
+        pPlaintextParams->recvBufferHead = 0U;
+        pPlaintextParams->recvBufferLength = 0U;
     }
 
     return returnStatus;
@@ -107,111 +232,191 @@ SocketStatus_t Plaintext_Disconnect( const NetworkContext_t * pNetworkContext )
 }
 /*-----------------------------------------------------------*/
 
-/* MISRA Rule 8.13 flags the following line for not using the const qualifier
- * on `pNetworkContext`. Indeed, the object pointed by it is not modified
- * by POSIX sockets, but other implementations of `TransportRecv_t` may do so. */
-int32_t Plaintext_Recv( NetworkContext_t * pNetworkContext,
-                        void * pBuffer,
-                        size_t bytesToRecv )
+static int32_t recvFromSocket( PlaintextParams_t * pPlaintextParams,
+                               void * pBuffer,
+                               size_t bytesToRecv )
 {
-    PlaintextParams_t * pPlaintextParams = NULL;
-    int32_t bytesReceived = -1, selectStatus = -1, getTimeoutStatus = -1;
-    struct timeval recvTimeout;
-    socklen_t recvTimeoutLen;
-    fd_set readfds;
+    int32_t bytesReceived = -1, pollStatus = 1;
 
-    assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
+    assert( pPlaintextParams != NULL );
     assert( pBuffer != NULL );
     assert( bytesToRecv > 0 );
 
-    /* Get receive timeout from the socket to use as the timeout for #select. */
-    pPlaintextParams = pNetworkContext->pParams;
-    recvTimeoutLen = ( socklen_t ) sizeof( recvTimeout );
-    getTimeoutStatus = getsockopt( pPlaintextParams->socketDescriptor,
-                                   SOL_SOCKET,
-                                   SO_RCVTIMEO,
-                                   &recvTimeout,
-                                   &recvTimeoutLen );
-
-    /* Make #select return immediately if getting the timeout failed. */
-    if( getTimeoutStatus < 0 )
+    /* Try to read without waiting first. coreMQTT issues several small reads
+     * per packet, and most of them are served by data already queued on the
+     * socket. */
+    bytesReceived = ( int32_t ) recv( pPlaintextParams->socketDescriptor,
+                                      pBuffer,
+                                      bytesToRecv,
+                                      MSG_DONTWAIT );
+    COUNT_IO_CALL( pPlaintextParams );
+
+    if( ( bytesReceived < 0 ) && ( isWouldBlock( errno ) == 1U ) )
     {
-        recvTimeout.tv_sec = 0;
-        recvTimeout.tv_usec = 0;
+        /* No data is pending. Wait for the socket to become readable. */
+        pollStatus = waitForSocket( pPlaintextParams->socketDescriptor,
+                                    POLLIN,
+                                    pPlaintextParams->recvTimeoutMs );
+        COUNT_IO_CALL( pPlaintextParams );
+
+        if( pollStatus > 0 )
+        {
+            /* The socket is available for receiving data. */
+            bytesReceived = ( int32_t ) recv( pPlaintextParams->socketDescriptor,
+                                              pBuffer,
+                                              bytesToRecv,
+                                              MSG_DONTWAIT );
+            COUNT_IO_CALL( pPlaintextParams );
+
+            if( ( bytesReceived < 0 ) && ( isWouldBlock( errno ) == 1U ) )
+            {
+                /* Spurious wakeup. The read can be retried. */
+                pollStatus = 0;
+            }
+        }
+
+        if( pollStatus == 0 )
+        {
+            /* Timed out waiting for data to be received. */
+            bytesReceived = 0;
+        }
+        else if( pollStatus < 0 )
+        {
+            /* An error occurred while polling. */
+            bytesReceived = -1;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
     }
 
-    /* MISRA Directive 4.6 flags the following line for a violation of using a
-     * basic type "int" rather than a type that includes size and signedness information.
-     * We suppress the violation as the flagged type, "fd_set", is a POSIX
-     * system-specific type, and is used for the call to "select()". */
-
-    /* MISRA Rule 14.4 flags the following line for using condition expression "0"
-     * as a boolean type. We suppress the violation as the "FD_ZERO" is a POSIX
-     * specific macro utility whose implementation is supplied by the system.
-     * The "FD_ZERO" macro is called as specified by the POSIX manual here:
-     * https://pubs.opengroup.org/onlinepubs/009695399/basedefs/sys/select.h.html */
-    /* coverity[misra_c_2012_directive_4_6_violation] */
-    /* coverity[misra_c_2012_rule_14_4_violation] */
-    FD_ZERO( &readfds );
-
-    /* MISRA Directive 4.6 flags the following line for a violation of using a
-     * basic type "int" rather than a type that includes size and signedness information.
-     * We suppress the violation as the flagged type, "fd_set", is a POSIX
-     * system-specific type, and is used for the call to "select()". */
-    /* coverity[misra_c_2012_directive_4_6_violation] */
-
-    /* MISRA Rule 10.1, Rule 10.8 and Rule 13.4 flag the following line for
-     * implementation of the "FD_SET()" POSIX macro. We suppress these violations
-     * "FD_SET" is a POSIX specific macro utility whose implementation
-     * is supplied by the system.
-     * The "FD_SET" macro is used as specified by the POSIX manual here:
-     * https://pubs.opengroup.org/onlinepubs/009695399/basedefs/sys/select.h.html */
-    /* coverity[misra_c_2012_directive_4_6_violation] */
-    /* coverity[misra_c_2012_rule_10_1_violation] */
-    /* coverity[misra_c_2012_rule_13_4_violation] */
-    /* coverity[misra_c_2012_rule_10_8_violation] */
-    FD_SET( pPlaintextParams->socketDescriptor, &readfds );
-
-    /* Check if there is data to read from the socket. */
-    selectStatus = select( pPlaintextParams->socketDescriptor + 1,
-                           &readfds,
-                           NULL,
-                           NULL,
-                           &recvTimeout );
-
-    if( selectStatus > 0 )
+    if( ( pollStatus > 0 ) && ( bytesReceived == 0 ) )
     {
-        /* The socket is available for receiving data. */
-        bytesReceived = ( int32_t ) recv( pPlaintextParams->socketDescriptor,
-                                          pBuffer,
-                                          bytesToRecv,
-                                          0 );
+        /* Peer has closed the connection. Treat as an error. */
+        bytesReceived = -1;
     }
-    else if( selectStatus < 0 )
+    else if( bytesReceived < 0 )
     {
-        /* An error occurred while polling. */
-        bytesReceived = -1;
+        logTransportError( errno );
     }
     else
     {
-        /* Timed out waiting for data to be received. */
-        bytesReceived = 0;
+        /* Empty else MISRA 15.7 */
     }
 
-    if( ( selectStatus > 0 ) && ( bytesReceived == 0 ) )
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t recvBuffered( PlaintextParams_t * pPlaintextParams,
+                             uint8_t * pBuffer,
+                             size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0;
+    size_t bytesToCopy = 0U;
+
+    assert( pPlaintextParams != NULL );
+    assert( pPlaintextParams->pRecvBuffer != NULL );
+    assert( pBuffer != NULL );
+
+    if( pPlaintextParams->recvBufferLength == 0U )
     {
-        /* Peer has closed the connection. Treat as an error. */
-        bytesReceived = -1;
+        if( bytesToRecv >= pPlaintextParams->recvBufferSize )
+        {
+            /* The request cannot be served from the buffer anyway, so read
+             * directly into the caller's buffer to avoid an extra copy. */
+            bytesReceived = recvFromSocket( pPlaintextParams,
+                                            pBuffer,
+                                            bytesToRecv );
+        }
+        else
+        {
+            /* Read as much as is available to serve the following reads
+             * from memory. */
+            bytesReceived = recvFromSocket( pPlaintextParams,
+                                            pPlaintextParams->pRecvBuffer,
+                                            pPlaintextParams->recvBufferSize );
+
+            if( bytesReceived > 0 )
+            {
+                pPlaintextParams->recvBufferHead = 0U;
+                pPlaintextParams->recvBufferLength = ( size_t ) bytesReceived;
+                bytesReceived = 0;
+            }
+        }
     }
-    else if( bytesReceived < 0 )
+
+    /* Serve the request from the buffered data. A short read is returned if
+     * fewer bytes are buffered than requested. */
+    if( pPlaintextParams->recvBufferLength > 0U )
     {
-        logTransportError( errno );
+        bytesToCopy = ( bytesToRecv < pPlaintextParams->recvBufferLength ) ?
+                      bytesToRecv : pPlaintextParams->recvBufferLength;
+
+        ( void ) memcpy( pBuffer,
+                         &pPlaintextParams->pRecvBuffer[ pPlaintextParams->recvBufferHead ],
+                         bytesToCopy );
+
+        pPlaintextParams->recvBufferHead += bytesToCopy;
+        pPlaintextParams->recvBufferLength -= bytesToCopy;
+        bytesReceived = ( int32_t ) bytesToCopy;
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+/* MISRA Rule 8.13 flags the following line for not using the const qualifier
+ * on `pNetworkContext`. Indeed, the object pointed by it is not modified
+ * by POSIX sockets, but other implementations of `TransportRecv_t` may do so. */
+int32_t Plaintext_Recv( NetworkContext_t * pNetworkContext,
+                        void * pBuffer,
+                        size_t bytesToRecv )
+{
+    PlaintextParams_t * pPlaintextParams = NULL;
+    int32_t bytesReceived = -1;
+    size_t bytesAllowed = bytesToRecv;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+    #endif
+
+    assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToRecv > 0 );
+
+    pPlaintextParams = pNetworkContext->pParams;
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        bytesAllowed = TransportThrottle_Wait( pPlaintextParams->trafficClass, bytesToRecv );
+    #endif
+
+    if( ( pPlaintextParams->pRecvBuffer != NULL ) &&
+        ( pPlaintextParams->recvBufferSize > 0U ) )
+    {
+        bytesReceived = recvBuffered( pPlaintextParams,
+                                      pBuffer,
+                                      bytesAllowed );
     }
     else
     {
-        /* Empty else MISRA 15.7 */
+        bytesReceived = recvFromSocket( pPlaintextParams,
+                                        pBuffer,
+                                        bytesAllowed );
     }
 
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        if( bytesReceived > 0 )
+        {
+            TransportThrottle_Consume( ( size_t ) bytesReceived );
+        }
+    #endif
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        TransportStats_RecordRecv( &pPlaintextParams->stats, bytesReceived, startTimeUs );
+    #endif
+
     return bytesReceived;
 }
 /*-----------------------------------------------------------*/
@@ -224,88 +429,176 @@ int32_t Plaintext_Send( NetworkContext_t * pNetworkContext,
                         size_t bytesToSend )
 {
     PlaintextParams_t * pPlaintextParams = NULL;
-    int32_t bytesSent = -1, selectStatus = -1, getTimeoutStatus = -1;
-    struct timeval sendTimeout;
-    socklen_t sendTimeoutLen;
-    fd_set writefds;
+    int32_t bytesSent = -1, pollStatus = 1;
+    size_t bytesAllowed = bytesToSend;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+    #endif
 
     assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
     assert( pBuffer != NULL );
     assert( bytesToSend > 0 );
 
-    /* Get send timeout from the socket to use as the timeout for #select. */
     pPlaintextParams = pNetworkContext->pParams;
-    sendTimeoutLen = ( socklen_t ) sizeof( sendTimeout );
-    getTimeoutStatus = getsockopt( pPlaintextParams->socketDescriptor,
-                                   SOL_SOCKET,
-                                   SO_SNDTIMEO,
-                                   &sendTimeout,
-                                   &sendTimeoutLen );
-
-    /* Make #select return immediately if getting the timeout failed. */
-    if( getTimeoutStatus < 0 )
+
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        bytesAllowed = TransportThrottle_Wait( pPlaintextParams->trafficClass, bytesToSend );
+    #endif
+
+    /* Try to send without waiting first, as the socket send buffer usually
+     * has room for the data. */
+    bytesSent = ( int32_t ) send( pPlaintextParams->socketDescriptor,
+                                  pBuffer,
+                                  bytesAllowed,
+                                  MSG_DONTWAIT );
+    COUNT_IO_CALL( pPlaintextParams );
+
+    if( ( bytesSent < 0 ) && ( isWouldBlock( errno ) == 1U ) )
     {
-        sendTimeout.tv_sec = 0;
-        sendTimeout.tv_usec = 0;
+        /* The send buffer is full. Wait for the socket to become writable. */
+        pollStatus = waitForSocket( pPlaintextParams->socketDescriptor,
+                                    POLLOUT,
+                                    pPlaintextParams->sendTimeoutMs );
+        COUNT_IO_CALL( pPlaintextParams );
+
+        if( pollStatus > 0 )
+        {
+            /* The socket is available for sending data. */
+            bytesSent = ( int32_t ) send( pPlaintextParams->socketDescriptor,
+                                          pBuffer,
+                                          bytesAllowed,
+                                          MSG_DONTWAIT );
+            COUNT_IO_CALL( pPlaintextParams );
+
+            if( ( bytesSent < 0 ) && ( isWouldBlock( errno ) == 1U ) )
+            {
+                /* Spurious wakeup. The send can be retried. */
+                pollStatus = 0;
+            }
+        }
+
+        if( pollStatus == 0 )
+        {
+            /* Timed out waiting for data to be sent. */
+            bytesSent = 0;
+        }
+        else if( pollStatus < 0 )
+        {
+            /* An error occurred while polling. */
+            bytesSent = -1;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
     }
 
-    /* MISRA Directive 4.6 flags the following line for a violation of using a
-     * basic type "int" rather than a type that includes size and signedness information.
-     * We suppress the violation as the flagged type, "fd_set", is a POSIX
-     * system-specific type, and is used for the call to "select()". */
-
-    /* MISRA Rule 14.4 flags the following line for using condition expression "0"
-     * as a boolean type. We suppress the violation as the "FD_ZERO" is a POSIX
-     * specific macro utility whose implementation is supplied by the system.
-     * The "FD_ZERO" macro is called as specified by the POSIX manual here:
-     * https://pubs.opengroup.org/onlinepubs/009695399/basedefs/sys/select.h.html */
-    /* coverity[misra_c_2012_directive_4_6_violation] */
-    /* coverity[misra_c_2012_rule_14_4_violation] */
-    FD_ZERO( &writefds );
-
-    /* MISRA Directive 4.6 flags the following line for a violation of using a
-     * basic type "int" rather than a type that includes size and signedness information.
-     * We suppress the violation as the flagged type, "fd_set", is a POSIX
-     * system-specific type, and is used for the call to "select()". */
-
-    /* MISRA Rule 10.1, Rule 10.8 and Rule 13.4 flag the following line for
-     * implementation of the "FD_SET()" POSIX macro. We suppress these violations
-     * as "FD_SET" is a POSIX specific macro utility whose implementation
-     * is supplied by the system.
-     * The "FD_ZERO" macro is used as specified by the POSIX manual here:
-     * https://pubs.opengroup.org/onlinepubs/009695399/basedefs/sys/select.h.html */
-    /* coverity[misra_c_2012_directive_4_6_violation] */
-    /* coverity[misra_c_2012_rule_10_1_violation] */
-    /* coverity[misra_c_2012_rule_13_4_violation] */
-    /* coverity[misra_c_2012_rule_10_8_violation] */
-    FD_SET( pPlaintextParams->socketDescriptor, &writefds );
-    /* Check if data can be written to the socket. */
-    selectStatus = select( pPlaintextParams->socketDescriptor + 1,
-                           NULL,
-                           &writefds,
-                           NULL,
-                           &sendTimeout );
-
-    if( selectStatus > 0 )
+    if( ( pollStatus > 0 ) && ( bytesSent == 0 ) )
     {
-        /* The socket is available for sending data. */
-        bytesSent = ( int32_t ) send( pPlaintextParams->socketDescriptor,
-                                      pBuffer,
-                                      bytesToSend,
-                                      0 );
+        /* Peer has closed the connection. Treat as an error. */
+        bytesSent = -1;
     }
-    else if( selectStatus < 0 )
+    else if( bytesSent < 0 )
     {
-        /* An error occurred while polling. */
-        bytesSent = -1;
+        logTransportError( errno );
     }
     else
     {
-        /* Timed out waiting for data to be sent. */
-        bytesSent = 0;
+        /* Empty else MISRA 15.7 */
     }
 
-    if( ( selectStatus > 0 ) && ( bytesSent == 0 ) )
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        if( bytesSent > 0 )
+        {
+            TransportThrottle_Consume( ( size_t ) bytesSent );
+        }
+    #endif
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        TransportStats_RecordSend( &pPlaintextParams->stats, bytesToSend, bytesSent, startTimeUs );
+    #endif
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Plaintext_Writev( NetworkContext_t * pNetworkContext,
+                          const struct iovec * pIoVec,
+                          size_t ioVecCount )
+{
+    PlaintextParams_t * pPlaintextParams = NULL;
+    int32_t bytesSent = -1, pollStatus = 1;
+    struct msghdr message;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+        size_t bytesToSend = 0U, i = 0U;
+    #endif
+
+    assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
+    assert( pIoVec != NULL );
+    assert( ioVecCount > 0 );
+
+    pPlaintextParams = pNetworkContext->pParams;
+
+    ( void ) memset( &message, 0, sizeof( message ) );
+
+    /* MISRA Rule 11.8 flags the following line for removing the const
+     * qualifier from the pointed to type. This rule is suppressed because
+     * struct msghdr declares msg_iov as non-const, but sendmsg() does not
+     * modify the buffers it points to. */
+    /* coverity[misra_c_2012_rule_11_8_violation] */
+    message.msg_iov = ( struct iovec * ) pIoVec;
+    message.msg_iovlen = ioVecCount;
+
+    /* Try to send without waiting first, as the socket send buffer usually
+     * has room for the data. */
+    bytesSent = ( int32_t ) sendmsg( pPlaintextParams->socketDescriptor,
+                                     &message,
+                                     MSG_DONTWAIT );
+    COUNT_IO_CALL( pPlaintextParams );
+
+    if( ( bytesSent < 0 ) && ( isWouldBlock( errno ) == 1U ) )
+    {
+        /* The send buffer is full. Wait for the socket to become writable. */
+        pollStatus = waitForSocket( pPlaintextParams->socketDescriptor,
+                                    POLLOUT,
+                                    pPlaintextParams->sendTimeoutMs );
+        COUNT_IO_CALL( pPlaintextParams );
+
+        if( pollStatus > 0 )
+        {
+            /* The socket is available for sending data. */
+            bytesSent = ( int32_t ) sendmsg( pPlaintextParams->socketDescriptor,
+                                             &message,
+                                             MSG_DONTWAIT );
+            COUNT_IO_CALL( pPlaintextParams );
+
+            if( ( bytesSent < 0 ) && ( isWouldBlock( errno ) == 1U ) )
+            {
+                /* Spurious wakeup. The send can be retried. */
+                pollStatus = 0;
+            }
+        }
+
+        if( pollStatus == 0 )
+        {
+            /* Timed out waiting for data to be sent. */
+            bytesSent = 0;
+        }
+        else if( pollStatus < 0 )
+        {
+            /* An error occurred while polling. */
+            bytesSent = -1;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    if( ( pollStatus > 0 ) && ( bytesSent == 0 ) )
     {
         /* Peer has closed the connection. Treat as an error. */
         bytesSent = -1;
@@ -319,6 +612,69 @@ int32_t Plaintext_Send( NetworkContext_t * pNetworkContext,
         /* Empty else MISRA 15.7 */
     }
 
+    #if ( TRANSPORT_THROTTLE_ENABLED == 1 )
+        /* The vectored send of MQTT packets is counted but never delayed. */
+        if( bytesSent > 0 )
+        {
+            TransportThrottle_Consume( ( size_t ) bytesSent );
+        }
+    #endif
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        for( i = 0U; i < ioVecCount; i++ )
+        {
+            bytesToSend += pIoVec[ i ].iov_len;
+        }
+
+        TransportStats_RecordSend( &pPlaintextParams->stats, bytesToSend, bytesSent, startTimeUs );
+    #endif
+
     return bytesSent;
 }
 /*-----------------------------------------------------------*/
+
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+
+    SocketStatus_t Plaintext_GetStats( const NetworkContext_t * pNetworkContext,
+                                       TransportStats_t * pStats )
+    {
+        SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+        if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+        {
+            LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+            returnStatus = SOCKETS_INVALID_PARAMETER;
+        }
+        else if( pStats == NULL )
+        {
+            LogError( ( "Parameter check failed: pStats is NULL." ) );
+            returnStatus = SOCKETS_INVALID_PARAMETER;
+        }
+        else
+        {
+            ( void ) memcpy( pStats, &pNetworkContext->pParams->stats, sizeof( TransportStats_t ) );
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+    SocketStatus_t Plaintext_ResetStats( NetworkContext_t * pNetworkContext )
+    {
+        SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+        if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+        {
+            LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+            returnStatus = SOCKETS_INVALID_PARAMETER;
+        }
+        else
+        {
+            ( void ) memset( &pNetworkContext->pParams->stats, 0, sizeof( TransportStats_t ) );
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TRANSPORT_STATS_ENABLED == 1 ) */
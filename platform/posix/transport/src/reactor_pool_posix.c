@@ -0,0 +1,442 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/* Thread groups include. */
+#include "thread_groups.h"
+
+#include "reactor_pool_posix.h"
+
+/**
+ * @brief Offset basis of the 64-bit FNV-1a hash.
+ */
+#define FNV_OFFSET_BASIS    ( 14695981039346656037ULL )
+
+/**
+ * @brief Prime of the 64-bit FNV-1a hash.
+ */
+#define FNV_PRIME           ( 1099511628211ULL )
+
+/**
+ * @brief Multiplier of the linear congruential generator of the jump
+ * consistent hash.
+ */
+#define JUMP_MULTIPLIER     ( 2862933555777941757ULL )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Run the tasks posted to a reactor, in the order they were posted.
+ *
+ * @param[in] pReactor The reactor.
+ */
+static void runPostedTasks( Reactor_t * pReactor );
+
+/**
+ * @brief Called by the event loop of a reactor when its eventfd is
+ * readable, after a task was posted or the reactor was stopped.
+ *
+ * @param[in] pConnection #Reactor_t.wakeConnection of the reactor.
+ * @param[in] events The events, unused.
+ */
+static void wakeCallback( EventLoopConnection_t * pConnection,
+                          uint32_t events );
+
+/**
+ * @brief Wake up a reactor waiting for its events.
+ *
+ * @param[in] pReactor The reactor.
+ *
+ * @return #REACTOR_POOL_SUCCESS if successful; #REACTOR_POOL_API_ERROR on
+ * error.
+ */
+static ReactorPoolStatus_t wakeReactor( Reactor_t * pReactor );
+
+/**
+ * @brief Thread of a reactor.
+ *
+ * @param[in] pArgument The #Reactor_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * reactorThread( void * pArgument );
+
+/**
+ * @brief Stop and join the threads of the first reactors of a pool.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] reactorCount Number of threads started.
+ */
+static void stopReactors( ReactorPool_t * pPool,
+                          uint32_t reactorCount );
+
+/*-----------------------------------------------------------*/
+
+static void runPostedTasks( Reactor_t * pReactor )
+{
+    ReactorPoolTask_t * pTask = NULL;
+    ReactorPoolTask_t * pNext = NULL;
+
+    assert( pReactor != NULL );
+
+    /* The tasks are detached at once, so that a task may post another one
+     * without deadlocking, to run after the next wait. */
+    ( void ) pthread_mutex_lock( &pReactor->mutex );
+    pTask = pReactor->pPostedHead;
+    pReactor->pPostedHead = NULL;
+    pReactor->pPostedTail = NULL;
+    ( void ) pthread_mutex_unlock( &pReactor->mutex );
+
+    while( pTask != NULL )
+    {
+        /* The task may be posted again from its function. */
+        pNext = pTask->pNext;
+        pTask->function( pTask );
+        pTask = pNext;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void wakeCallback( EventLoopConnection_t * pConnection,
+                          uint32_t events )
+{
+    uint64_t count = 0U;
+
+    ( void ) events;
+
+    assert( pConnection != NULL );
+
+    /* Reading resets the counter of the eventfd, so that it is only
+     * readable again once a task is posted. */
+    ( void ) read( pConnection->fileDescriptor, &count, sizeof( count ) );
+
+    runPostedTasks( ( Reactor_t * ) pConnection->pUserContext );
+}
+/*-----------------------------------------------------------*/
+
+static ReactorPoolStatus_t wakeReactor( Reactor_t * pReactor )
+{
+    ReactorPoolStatus_t returnStatus = REACTOR_POOL_SUCCESS;
+    uint64_t one = 1U;
+
+    assert( pReactor != NULL );
+
+    /* The write only fails if the counter would overflow, when the reactor
+     * is awake anyway. */
+    if( ( write( pReactor->wakeConnection.fileDescriptor, &one, sizeof( one ) ) < 0 ) && ( errno != EAGAIN ) )
+    {
+        LogError( ( "Waking up a reactor failed: %s.", strerror( errno ) ) );
+        returnStatus = REACTOR_POOL_API_ERROR;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void * reactorThread( void * pArgument )
+{
+    Reactor_t * pReactor = ( Reactor_t * ) pArgument;
+    bool failed = false;
+
+    assert( pReactor != NULL );
+
+    while( ( __atomic_load_n( &pReactor->stopping, __ATOMIC_ACQUIRE ) == false ) && ( failed == false ) )
+    {
+        if( EventLoop_Dispatch( &pReactor->eventLoop, REACTOR_POOL_MAX_WAIT_MS, NULL ) != EVENT_LOOP_SUCCESS )
+        {
+            LogError( ( "The event loop of a reactor failed." ) );
+            failed = true;
+        }
+    }
+
+    /* The tasks posted before the reactor was stopped are run, even if it
+     * stopped before it saw its eventfd readable. */
+    runPostedTasks( pReactor );
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void stopReactors( ReactorPool_t * pPool,
+                          uint32_t reactorCount )
+{
+    uint32_t index = 0U;
+
+    assert( pPool != NULL );
+
+    for( index = 0U; index < reactorCount; index++ )
+    {
+        ( void ) pthread_mutex_lock( &pPool->reactors[ index ].mutex );
+        __atomic_store_n( &pPool->reactors[ index ].stopping, true, __ATOMIC_RELEASE );
+        ( void ) pthread_mutex_unlock( &pPool->reactors[ index ].mutex );
+        ( void ) wakeReactor( &pPool->reactors[ index ] );
+    }
+
+    for( index = 0U; index < reactorCount; index++ )
+    {
+        ( void ) pthread_join( pPool->reactors[ index ].thread, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+ReactorPoolStatus_t ReactorPool_Init( ReactorPool_t * pPool,
+                                      uint32_t reactorCount )
+{
+    ReactorPoolStatus_t returnStatus = REACTOR_POOL_SUCCESS;
+    Reactor_t * pReactor = NULL;
+
+    if( ( pPool == NULL ) || ( reactorCount == 0U ) || ( reactorCount > REACTOR_POOL_MAX_REACTORS ) )
+    {
+        LogError( ( "Parameter check failed: pPool must not be NULL, and reactorCount from 1 to %u.",
+                    ( unsigned int ) REACTOR_POOL_MAX_REACTORS ) );
+        returnStatus = REACTOR_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pPool, 0, sizeof( ReactorPool_t ) );
+    }
+
+    while( ( returnStatus == REACTOR_POOL_SUCCESS ) && ( pPool->reactorCount < reactorCount ) )
+    {
+        pReactor = &pPool->reactors[ pPool->reactorCount ];
+        pReactor->wakeConnection.fileDescriptor = eventfd( 0U, EFD_CLOEXEC | EFD_NONBLOCK );
+        pReactor->wakeConnection.callback = wakeCallback;
+        pReactor->wakeConnection.pUserContext = pReactor;
+
+        if( pReactor->wakeConnection.fileDescriptor < 0 )
+        {
+            LogError( ( "Creating the eventfd of a reactor failed: %s.", strerror( errno ) ) );
+            returnStatus = REACTOR_POOL_API_ERROR;
+        }
+        else if( EventLoop_Init( &pReactor->eventLoop ) != EVENT_LOOP_SUCCESS )
+        {
+            ( void ) close( pReactor->wakeConnection.fileDescriptor );
+            returnStatus = REACTOR_POOL_API_ERROR;
+        }
+        else if( ( EventLoop_Add( &pReactor->eventLoop, &pReactor->wakeConnection ) != EVENT_LOOP_SUCCESS ) ||
+                 ( pthread_mutex_init( &pReactor->mutex, NULL ) != 0 ) )
+        {
+            ( void ) EventLoop_Deinit( &pReactor->eventLoop );
+            ( void ) close( pReactor->wakeConnection.fileDescriptor );
+            returnStatus = REACTOR_POOL_API_ERROR;
+        }
+        else
+        {
+            pPool->reactorCount++;
+        }
+    }
+
+    /* The reactors set up are released, as the pool is not usable. */
+    if( returnStatus == REACTOR_POOL_API_ERROR )
+    {
+        ReactorPool_Deinit( pPool );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ReactorPool_GetShard( const ReactorPool_t * pPool,
+                               const char * pKey,
+                               size_t keyLength )
+{
+    uint64_t key = FNV_OFFSET_BASIS;
+    int64_t bucket = -1, next = 0;
+    size_t i = 0U;
+
+    if( ( pPool == NULL ) || ( pKey == NULL ) || ( pPool->reactorCount == 0U ) )
+    {
+        LogError( ( "Parameter check failed: pPool and pKey must not be NULL." ) );
+        bucket = 0;
+    }
+    else
+    {
+        for( i = 0U; i < keyLength; i++ )
+        {
+            key ^= ( uint64_t ) ( uint8_t ) pKey[ i ];
+            key *= FNV_PRIME;
+        }
+
+        /* Each jump lands on the next bucket the key moves to as buckets
+         * are added, until it passes the last bucket. */
+        while( next < ( int64_t ) pPool->reactorCount )
+        {
+            bucket = next;
+            key = ( key * JUMP_MULTIPLIER ) + 1U;
+            next = ( int64_t ) ( ( double ) ( bucket + 1 ) *
+                                 ( ( double ) ( 1ULL << 31 ) / ( double ) ( ( key >> 33 ) + 1U ) ) );
+        }
+    }
+
+    return ( uint32_t ) bucket;
+}
+/*-----------------------------------------------------------*/
+
+EventLoop_t * ReactorPool_GetEventLoop( ReactorPool_t * pPool,
+                                        uint32_t shard )
+{
+    EventLoop_t * pEventLoop = NULL;
+
+    if( ( pPool == NULL ) || ( shard >= pPool->reactorCount ) )
+    {
+        LogError( ( "Parameter check failed: pPool must not be NULL, and shard lower than its reactors." ) );
+    }
+    else
+    {
+        pEventLoop = &pPool->reactors[ shard ].eventLoop;
+    }
+
+    return pEventLoop;
+}
+/*-----------------------------------------------------------*/
+
+ReactorPoolStatus_t ReactorPool_Post( ReactorPool_t * pPool,
+                                      uint32_t shard,
+                                      ReactorPoolTask_t * pTask )
+{
+    ReactorPoolStatus_t returnStatus = REACTOR_POOL_SUCCESS;
+    Reactor_t * pReactor = NULL;
+    bool wasEmpty = false;
+
+    if( ( pPool == NULL ) || ( shard >= pPool->reactorCount ) ||
+        ( pTask == NULL ) || ( pTask->function == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pPool and pTask must not be NULL, pTask must have a function, and shard be lower than the reactors." ) );
+        returnStatus = REACTOR_POOL_INVALID_PARAMETER;
+    }
+    else
+    {
+        pReactor = &pPool->reactors[ shard ];
+        pTask->pNext = NULL;
+
+        ( void ) pthread_mutex_lock( &pReactor->mutex );
+
+        if( pReactor->stopping == true )
+        {
+            LogError( ( "Posting failed: the reactor is stopped." ) );
+            returnStatus = REACTOR_POOL_INVALID_PARAMETER;
+        }
+        else
+        {
+            wasEmpty = ( pReactor->pPostedHead == NULL );
+
+            if( wasEmpty == true )
+            {
+                pReactor->pPostedHead = pTask;
+            }
+            else
+            {
+                pReactor->pPostedTail->pNext = pTask;
+            }
+
+            pReactor->pPostedTail = pTask;
+        }
+
+        ( void ) pthread_mutex_unlock( &pReactor->mutex );
+
+        /* A reactor with tasks already posted is already woken up. */
+        if( ( returnStatus == REACTOR_POOL_SUCCESS ) && ( wasEmpty == true ) )
+        {
+            returnStatus = wakeReactor( pReactor );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+ReactorPoolStatus_t ReactorPool_Start( ReactorPool_t * pPool,
+                                       const char * pGroupName )
+{
+    ReactorPoolStatus_t returnStatus = REACTOR_POOL_SUCCESS;
+    uint32_t startedCount = 0U;
+
+    if( ( pPool == NULL ) || ( pGroupName == NULL ) || ( pPool->reactorCount == 0U ) || ( pPool->running == true ) )
+    {
+        LogError( ( "Parameter check failed: pPool and pGroupName must not be NULL, and the pool initialized and not running." ) );
+        returnStatus = REACTOR_POOL_INVALID_PARAMETER;
+    }
+
+    while( ( returnStatus == REACTOR_POOL_SUCCESS ) && ( startedCount < pPool->reactorCount ) )
+    {
+        if( ThreadGroup_CreateThread( pGroupName,
+                                      &pPool->reactors[ startedCount ].thread,
+                                      reactorThread,
+                                      &pPool->reactors[ startedCount ] ) == ThreadGroupSuccess )
+        {
+            startedCount++;
+        }
+        else
+        {
+            LogError( ( "Creating the thread of reactor %u failed.", ( unsigned int ) startedCount ) );
+            returnStatus = REACTOR_POOL_API_ERROR;
+            stopReactors( pPool, startedCount );
+        }
+    }
+
+    if( returnStatus == REACTOR_POOL_SUCCESS )
+    {
+        pPool->running = true;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+void ReactorPool_Stop( ReactorPool_t * pPool )
+{
+    if( ( pPool != NULL ) && ( pPool->running == true ) )
+    {
+        stopReactors( pPool, pPool->reactorCount );
+        pPool->running = false;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void ReactorPool_Deinit( ReactorPool_t * pPool )
+{
+    uint32_t index = 0U;
+    Reactor_t * pReactor = NULL;
+
+    if( ( pPool != NULL ) && ( pPool->running == false ) )
+    {
+        for( index = 0U; index < pPool->reactorCount; index++ )
+        {
+            pReactor = &pPool->reactors[ index ];
+            ( void ) EventLoop_Remove( &pReactor->eventLoop, &pReactor->wakeConnection );
+            ( void ) EventLoop_Deinit( &pReactor->eventLoop );
+            ( void ) close( pReactor->wakeConnection.fileDescriptor );
+            ( void ) pthread_mutex_destroy( &pReactor->mutex );
+        }
+
+        pPool->reactorCount = 0U;
+    }
+}
+/*-----------------------------------------------------------*/
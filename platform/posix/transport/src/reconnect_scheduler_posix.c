@@ -0,0 +1,500 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX includes. */
+#include <unistd.h>
+
+#include "reconnect_scheduler_posix.h"
+
+#if ( RECONNECT_MAX_BACKOFF_DELAY_MS > 65535U ) || ( RECONNECT_BACKOFF_BASE_MS > RECONNECT_MAX_BACKOFF_DELAY_MS )
+    #error "The backoff delays must satisfy RECONNECT_BACKOFF_BASE_MS <= RECONNECT_MAX_BACKOFF_DELAY_MS <= 65535."
+#endif
+
+#if ( RECONNECT_CIRCUIT_RETRY_ATTEMPTS == 0U )
+    #error "RECONNECT_CIRCUIT_RETRY_ATTEMPTS must not be 0."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Draw the next random number of the jitter, with xorshift32.
+ *
+ * @param[in] pScheduler The scheduler.
+ *
+ * @return A random number.
+ */
+static uint32_t nextRandom( ReconnectScheduler_t * pScheduler );
+
+/**
+ * @brief Start the timer of an endpoint.
+ *
+ * @param[in] pEndpoint The endpoint.
+ * @param[in] state State of the endpoint while the timer runs.
+ * @param[in] delayMs Time from now at which the timer is due.
+ */
+static void startTimer( ReconnectEndpoint_t * pEndpoint,
+                        ReconnectState_t state,
+                        uint32_t delayMs );
+
+/**
+ * @brief Queue an endpoint whose attempt is due, and start the handshakes
+ * for which there is room.
+ *
+ * @param[in] pEndpoint The endpoint, which is not queued.
+ */
+static void queueAttempt( ReconnectEndpoint_t * pEndpoint );
+
+/**
+ * @brief Remove an endpoint from the queue of attempts due.
+ *
+ * @param[in] pEndpoint The endpoint, which is queued.
+ */
+static void unqueueAttempt( ReconnectEndpoint_t * pEndpoint );
+
+/**
+ * @brief Start the handshakes of the queued endpoints, oldest first, while
+ * fewer than #ReconnectScheduler_t.maxHandshakes are in flight.
+ *
+ * A callback reporting a result at once does not start the next handshake
+ * itself, so this does not recurse.
+ *
+ * @param[in] pScheduler The scheduler.
+ */
+static void startHandshakes( ReconnectScheduler_t * pScheduler );
+
+/**
+ * @brief Schedule the next attempt after a failed handshake, or open the
+ * circuit breaker.
+ *
+ * @param[in] pEndpoint The endpoint, whose handshake is no longer in flight.
+ */
+static void handleFailure( ReconnectEndpoint_t * pEndpoint );
+
+/**
+ * @brief Called by the event loop when the timer of an endpoint is due.
+ *
+ * @param[in] pTimer #ReconnectEndpoint_t.timer of the endpoint.
+ */
+static void timerCallback( TimerWheelTimer_t * pTimer );
+
+/*-----------------------------------------------------------*/
+
+static uint32_t nextRandom( ReconnectScheduler_t * pScheduler )
+{
+    uint32_t x = 0U;
+
+    assert( pScheduler != NULL );
+
+    x = pScheduler->randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pScheduler->randomState = x;
+
+    return x;
+}
+/*-----------------------------------------------------------*/
+
+static void startTimer( ReconnectEndpoint_t * pEndpoint,
+                        ReconnectState_t state,
+                        uint32_t delayMs )
+{
+    assert( pEndpoint != NULL );
+
+    pEndpoint->state = state;
+    ( void ) EventLoop_StartTimer( pEndpoint->pScheduler->pEventLoop, &pEndpoint->timer, delayMs );
+}
+/*-----------------------------------------------------------*/
+
+static void queueAttempt( ReconnectEndpoint_t * pEndpoint )
+{
+    ReconnectScheduler_t * pScheduler = NULL;
+
+    assert( pEndpoint != NULL );
+    assert( pEndpoint->ppPreviousQueuedNext == NULL );
+
+    pScheduler = pEndpoint->pScheduler;
+    pEndpoint->state = RECONNECT_STATE_QUEUED;
+    pEndpoint->pNextQueued = NULL;
+    pEndpoint->ppPreviousQueuedNext = pScheduler->ppQueueTail;
+    *pScheduler->ppQueueTail = pEndpoint;
+    pScheduler->ppQueueTail = &pEndpoint->pNextQueued;
+
+    startHandshakes( pScheduler );
+}
+/*-----------------------------------------------------------*/
+
+static void unqueueAttempt( ReconnectEndpoint_t * pEndpoint )
+{
+    ReconnectScheduler_t * pScheduler = NULL;
+
+    assert( pEndpoint != NULL );
+    assert( pEndpoint->ppPreviousQueuedNext != NULL );
+
+    pScheduler = pEndpoint->pScheduler;
+    *pEndpoint->ppPreviousQueuedNext = pEndpoint->pNextQueued;
+
+    if( pEndpoint->pNextQueued != NULL )
+    {
+        pEndpoint->pNextQueued->ppPreviousQueuedNext = pEndpoint->ppPreviousQueuedNext;
+    }
+    else
+    {
+        /* The endpoint was the last one queued. */
+        pScheduler->ppQueueTail = pEndpoint->ppPreviousQueuedNext;
+    }
+
+    pEndpoint->pNextQueued = NULL;
+    pEndpoint->ppPreviousQueuedNext = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void startHandshakes( ReconnectScheduler_t * pScheduler )
+{
+    ReconnectEndpoint_t * pEndpoint = NULL;
+
+    assert( pScheduler != NULL );
+
+    if( pScheduler->startingHandshakes == false )
+    {
+        pScheduler->startingHandshakes = true;
+
+        while( ( pScheduler->pQueueHead != NULL ) &&
+               ( pScheduler->handshakeCount < pScheduler->maxHandshakes ) )
+        {
+            pEndpoint = pScheduler->pQueueHead;
+            unqueueAttempt( pEndpoint );
+            pScheduler->handshakeCount++;
+            startTimer( pEndpoint, RECONNECT_STATE_CONNECTING, RECONNECT_HANDSHAKE_TIMEOUT_MS );
+
+            LogDebug( ( "Connecting to %s:%u (%u handshakes in flight).",
+                        pEndpoint->pHostName,
+                        ( unsigned int ) pEndpoint->port,
+                        ( unsigned int ) pScheduler->handshakeCount ) );
+            pEndpoint->callback( pEndpoint, RECONNECT_EVENT_CONNECT );
+        }
+
+        pScheduler->startingHandshakes = false;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void handleFailure( ReconnectEndpoint_t * pEndpoint )
+{
+    ReconnectScheduler_t * pScheduler = NULL;
+    BackoffAlgorithmStatus_t backoffAlgStatus = BackoffAlgorithmSuccess;
+    uint16_t fullJitterDelayMs = 0U;
+    uint64_t highestDelayMs = 0U;
+    uint32_t delayMs = 0U;
+
+    assert( pEndpoint != NULL );
+
+    pScheduler = pEndpoint->pScheduler;
+
+    /* Only the attempt budget of the backoff algorithm is used. Its delays
+     * grow with full jitter from a shared base, so the clients failing at the
+     * same time keep drawing from the same ranges, whereas decorrelated
+     * jitter draws each delay from the last one. */
+    if( pEndpoint->circuitTrial == false )
+    {
+        backoffAlgStatus = BackoffAlgorithm_GetNextBackoff( &pEndpoint->backoffContext,
+                                                            nextRandom( pScheduler ),
+                                                            &fullJitterDelayMs );
+    }
+
+    if( ( pEndpoint->circuitTrial == true ) || ( backoffAlgStatus != BackoffAlgorithmSuccess ) )
+    {
+        pEndpoint->circuitTrial = false;
+        pEndpoint->lastDelayMs = RECONNECT_BACKOFF_BASE_MS;
+        BackoffAlgorithm_InitializeParams( &pEndpoint->backoffContext,
+                                           RECONNECT_BACKOFF_BASE_MS,
+                                           RECONNECT_MAX_BACKOFF_DELAY_MS,
+                                           RECONNECT_CIRCUIT_RETRY_ATTEMPTS );
+
+        delayMs = RECONNECT_CIRCUIT_OPEN_MS + ( nextRandom( pScheduler ) % ( ( RECONNECT_CIRCUIT_OPEN_MS / 4U ) + 1U ) );
+        LogWarn( ( "Connecting to %s:%u keeps failing. Opening the circuit breaker for %u ms.",
+                   pEndpoint->pHostName,
+                   ( unsigned int ) pEndpoint->port,
+                   ( unsigned int ) delayMs ) );
+        startTimer( pEndpoint, RECONNECT_STATE_CIRCUIT_OPEN, delayMs );
+    }
+    else
+    {
+        highestDelayMs = ( uint64_t ) pEndpoint->lastDelayMs * 3U;
+
+        if( highestDelayMs > RECONNECT_MAX_BACKOFF_DELAY_MS )
+        {
+            highestDelayMs = RECONNECT_MAX_BACKOFF_DELAY_MS;
+        }
+
+        delayMs = RECONNECT_BACKOFF_BASE_MS +
+                  ( nextRandom( pScheduler ) % ( ( uint32_t ) highestDelayMs - RECONNECT_BACKOFF_BASE_MS + 1U ) );
+        pEndpoint->lastDelayMs = delayMs;
+
+        LogWarn( ( "Connecting to %s:%u failed. Retrying after %u ms backoff.",
+                   pEndpoint->pHostName,
+                   ( unsigned int ) pEndpoint->port,
+                   ( unsigned int ) delayMs ) );
+        startTimer( pEndpoint, RECONNECT_STATE_WAITING, delayMs );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void timerCallback( TimerWheelTimer_t * pTimer )
+{
+    ReconnectEndpoint_t * pEndpoint = NULL;
+    ReconnectScheduler_t * pScheduler = NULL;
+
+    assert( pTimer != NULL );
+
+    pEndpoint = ( ReconnectEndpoint_t * ) pTimer->pUserContext;
+    pScheduler = pEndpoint->pScheduler;
+
+    switch( pEndpoint->state )
+    {
+        case RECONNECT_STATE_WAITING:
+            queueAttempt( pEndpoint );
+            break;
+
+        case RECONNECT_STATE_CIRCUIT_OPEN:
+            LogInfo( ( "Trying %s:%u again through the open circuit breaker.",
+                       pEndpoint->pHostName,
+                       ( unsigned int ) pEndpoint->port ) );
+            pEndpoint->circuitTrial = true;
+            queueAttempt( pEndpoint );
+            break;
+
+        case RECONNECT_STATE_CONNECTING:
+            LogWarn( ( "Handshake with %s:%u timed out.",
+                       pEndpoint->pHostName,
+                       ( unsigned int ) pEndpoint->port ) );
+            pScheduler->handshakeCount--;
+            handleFailure( pEndpoint );
+            pEndpoint->callback( pEndpoint, RECONNECT_EVENT_HANDSHAKE_TIMEOUT );
+            startHandshakes( pScheduler );
+            break;
+
+        default:
+            /* No timer runs in the other states. */
+            break;
+    }
+}
+/*-----------------------------------------------------------*/
+
+ReconnectStatus_t ReconnectScheduler_Init( ReconnectScheduler_t * pScheduler,
+                                           EventLoop_t * pEventLoop,
+                                           uint32_t maxHandshakes )
+{
+    ReconnectStatus_t returnStatus = RECONNECT_SUCCESS;
+    struct timespec tp;
+
+    if( ( pScheduler == NULL ) || ( pEventLoop == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pScheduler and pEventLoop must not be NULL." ) );
+        returnStatus = RECONNECT_INVALID_PARAMETER;
+    }
+    else if( maxHandshakes == 0U )
+    {
+        LogError( ( "Parameter check failed: maxHandshakes must not be 0." ) );
+        returnStatus = RECONNECT_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pScheduler, 0, sizeof( ReconnectScheduler_t ) );
+        pScheduler->pEventLoop = pEventLoop;
+        pScheduler->maxHandshakes = maxHandshakes;
+        pScheduler->ppQueueTail = &pScheduler->pQueueHead;
+
+        /* Seed with the nanoseconds and the process ID, which differ between
+         * the processes of a fleet restarted together. xorshift32 must not be
+         * seeded with 0. */
+        ( void ) clock_gettime( CLOCK_REALTIME, &tp );
+        pScheduler->randomState = ( ( uint32_t ) tp.tv_nsec ^ ( ( uint32_t ) getpid() << 16 ) ) | 1U;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+ReconnectStatus_t ReconnectScheduler_Connect( ReconnectScheduler_t * pScheduler,
+                                              ReconnectEndpoint_t * pEndpoint )
+{
+    ReconnectStatus_t returnStatus = RECONNECT_SUCCESS;
+
+    if( ( pScheduler == NULL ) || ( pEndpoint == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pScheduler and pEndpoint must not be NULL." ) );
+        returnStatus = RECONNECT_INVALID_PARAMETER;
+    }
+    else if( ( pEndpoint->pHostName == NULL ) || ( pEndpoint->callback == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pEndpoint must have a host name and a callback." ) );
+        returnStatus = RECONNECT_INVALID_PARAMETER;
+    }
+    else if( pEndpoint->state != RECONNECT_STATE_IDLE )
+    {
+        LogError( ( "%s:%u is already managed by a scheduler.",
+                    pEndpoint->pHostName,
+                    ( unsigned int ) pEndpoint->port ) );
+        returnStatus = RECONNECT_BAD_STATE;
+    }
+    else
+    {
+        pEndpoint->pScheduler = pScheduler;
+        pEndpoint->circuitTrial = false;
+        pEndpoint->lastDelayMs = RECONNECT_BACKOFF_BASE_MS;
+        pEndpoint->pNextQueued = NULL;
+        pEndpoint->ppPreviousQueuedNext = NULL;
+        ( void ) memset( &pEndpoint->timer, 0, sizeof( pEndpoint->timer ) );
+        pEndpoint->timer.callback = timerCallback;
+        pEndpoint->timer.pUserContext = pEndpoint;
+        BackoffAlgorithm_InitializeParams( &pEndpoint->backoffContext,
+                                           RECONNECT_BACKOFF_BASE_MS,
+                                           RECONNECT_MAX_BACKOFF_DELAY_MS,
+                                           RECONNECT_CIRCUIT_RETRY_ATTEMPTS );
+
+        queueAttempt( pEndpoint );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+ReconnectStatus_t ReconnectScheduler_Disconnected( ReconnectScheduler_t * pScheduler,
+                                                   ReconnectEndpoint_t * pEndpoint )
+{
+    ReconnectStatus_t returnStatus = RECONNECT_SUCCESS;
+
+    if( ( pScheduler == NULL ) || ( pEndpoint == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pScheduler and pEndpoint must not be NULL." ) );
+        returnStatus = RECONNECT_INVALID_PARAMETER;
+    }
+    else if( ( pEndpoint->pScheduler != pScheduler ) ||
+             ( pEndpoint->state != RECONNECT_STATE_CONNECTED ) )
+    {
+        LogError( ( "%s:%u is not connected.",
+                    pEndpoint->pHostName,
+                    ( unsigned int ) pEndpoint->port ) );
+        returnStatus = RECONNECT_BAD_STATE;
+    }
+    else
+    {
+        startTimer( pEndpoint,
+                    RECONNECT_STATE_WAITING,
+                    nextRandom( pScheduler ) % ( RECONNECT_BACKOFF_BASE_MS + 1U ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+ReconnectStatus_t ReconnectScheduler_ReportResult( ReconnectScheduler_t * pScheduler,
+                                                   ReconnectEndpoint_t * pEndpoint,
+                                                   bool connected )
+{
+    ReconnectStatus_t returnStatus = RECONNECT_SUCCESS;
+
+    if( ( pScheduler == NULL ) || ( pEndpoint == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pScheduler and pEndpoint must not be NULL." ) );
+        returnStatus = RECONNECT_INVALID_PARAMETER;
+    }
+    else if( ( pEndpoint->pScheduler != pScheduler ) ||
+             ( pEndpoint->state != RECONNECT_STATE_CONNECTING ) )
+    {
+        LogError( ( "No handshake with %s:%u is in flight.",
+                    pEndpoint->pHostName,
+                    ( unsigned int ) pEndpoint->port ) );
+        returnStatus = RECONNECT_BAD_STATE;
+    }
+    else
+    {
+        ( void ) EventLoop_CancelTimer( pScheduler->pEventLoop, &pEndpoint->timer );
+        pScheduler->handshakeCount--;
+
+        if( connected == true )
+        {
+            LogInfo( ( "Connected to %s:%u.",
+                       pEndpoint->pHostName,
+                       ( unsigned int ) pEndpoint->port ) );
+            pEndpoint->state = RECONNECT_STATE_CONNECTED;
+            pEndpoint->circuitTrial = false;
+            pEndpoint->lastDelayMs = RECONNECT_BACKOFF_BASE_MS;
+            BackoffAlgorithm_InitializeParams( &pEndpoint->backoffContext,
+                                               RECONNECT_BACKOFF_BASE_MS,
+                                               RECONNECT_MAX_BACKOFF_DELAY_MS,
+                                               RECONNECT_CIRCUIT_RETRY_ATTEMPTS );
+        }
+        else
+        {
+            handleFailure( pEndpoint );
+        }
+
+        startHandshakes( pScheduler );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+ReconnectStatus_t ReconnectScheduler_Stop( ReconnectScheduler_t * pScheduler,
+                                           ReconnectEndpoint_t * pEndpoint )
+{
+    ReconnectStatus_t returnStatus = RECONNECT_SUCCESS;
+
+    if( ( pScheduler == NULL ) || ( pEndpoint == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pScheduler and pEndpoint must not be NULL." ) );
+        returnStatus = RECONNECT_INVALID_PARAMETER;
+    }
+    else if( ( pEndpoint->state != RECONNECT_STATE_IDLE ) &&
+             ( pEndpoint->pScheduler == pScheduler ) )
+    {
+        ( void ) EventLoop_CancelTimer( pScheduler->pEventLoop, &pEndpoint->timer );
+
+        if( pEndpoint->state == RECONNECT_STATE_QUEUED )
+        {
+            unqueueAttempt( pEndpoint );
+        }
+
+        if( pEndpoint->state == RECONNECT_STATE_CONNECTING )
+        {
+            pScheduler->handshakeCount--;
+        }
+
+        pEndpoint->state = RECONNECT_STATE_IDLE;
+        startHandshakes( pScheduler );
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,410 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "capture_transport_posix.h"
+
+/* Clock of the replay at the recorded speed. */
+#include "clock.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Largest length of an unsigned LEB128 number of 64 bits.
+ */
+#define NUMBER_MAX_LENGTH    ( 10U )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    ReplayTransportParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Decode an unsigned LEB128 number of a capture.
+ *
+ * @param[in] pCapture The capture.
+ * @param[in] captureLength Length of @p pCapture.
+ * @param[in,out] pPosition Position of the number, moved past it.
+ * @param[out] pValue The number.
+ *
+ * @return true if the number is whole and fits in 64 bits; false otherwise.
+ */
+static bool decodeNumber( const uint8_t * pCapture,
+                          size_t captureLength,
+                          size_t * pPosition,
+                          uint64_t * pValue );
+
+/**
+ * @brief Decode the header of a record of a capture.
+ *
+ * @param[in] pCapture The capture.
+ * @param[in] captureLength Length of @p pCapture.
+ * @param[in,out] pPosition Position of the record, moved to its bytes.
+ * @param[out] pDelayUs Microseconds since the previous record.
+ * @param[out] pLength Number of bytes of the record.
+ * @param[out] pDirection #CAPTURE_TRANSPORT_SEND or #CAPTURE_TRANSPORT_RECV.
+ *
+ * @return true if the header is whole and its bytes are in the capture;
+ * false otherwise.
+ */
+static bool decodeRecord( const uint8_t * pCapture,
+                          size_t captureLength,
+                          size_t * pPosition,
+                          uint64_t * pDelayUs,
+                          size_t * pLength,
+                          uint32_t * pDirection );
+
+/**
+ * @brief Move to the next receive record, skipping the send records.
+ *
+ * The records were checked by #ReplayTransport_Init.
+ *
+ * @param[in] pReplayParams The replay, whose current receive record was
+ * received whole.
+ */
+static void nextRecvRecord( ReplayTransportParams_t * pReplayParams );
+
+/**
+ * @brief Check the network context of a send or receive.
+ *
+ * @param[in] pNetworkContext The network context.
+ *
+ * @return true if it has a capture to replay; false otherwise.
+ */
+static bool isInitialized( const NetworkContext_t * pNetworkContext );
+
+/*-----------------------------------------------------------*/
+
+static bool decodeNumber( const uint8_t * pCapture,
+                          size_t captureLength,
+                          size_t * pPosition,
+                          uint64_t * pValue )
+{
+    bool whole = false;
+    bool done = false;
+    size_t position = *pPosition;
+    size_t index = 0U;
+    uint64_t value = 0U;
+
+    for( index = 0U; ( index < NUMBER_MAX_LENGTH ) && ( position < captureLength ) && ( done == false ); index++ )
+    {
+        /* The tenth byte only holds the highest bit of the number. */
+        if( ( index == ( NUMBER_MAX_LENGTH - 1U ) ) && ( pCapture[ position ] > 1U ) )
+        {
+            done = true;
+        }
+        else
+        {
+            value |= ( uint64_t ) ( pCapture[ position ] & 0x7FU ) << ( 7U * index );
+            done = ( ( pCapture[ position ] & 0x80U ) == 0U );
+            whole = done;
+            position++;
+        }
+    }
+
+    if( whole == true )
+    {
+        *pPosition = position;
+        *pValue = value;
+    }
+
+    return whole;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool decodeRecord( const uint8_t * pCapture,
+                          size_t captureLength,
+                          size_t * pPosition,
+                          uint64_t * pDelayUs,
+                          size_t * pLength,
+                          uint32_t * pDirection )
+{
+    bool whole = false;
+    size_t position = *pPosition;
+    uint64_t lengthAndDirection = 0U;
+    uint64_t length = 0U;
+
+    if( ( decodeNumber( pCapture, captureLength, &position, pDelayUs ) == true ) &&
+        ( decodeNumber( pCapture, captureLength, &position, &lengthAndDirection ) == true ) )
+    {
+        length = lengthAndDirection >> 1;
+
+        /* Each record is the return value of a send or a receive. */
+        whole = ( length > 0U ) && ( length <= ( uint64_t ) INT32_MAX ) &&
+                ( length <= ( uint64_t ) ( captureLength - position ) );
+    }
+
+    if( whole == true )
+    {
+        *pPosition = position;
+        *pLength = ( size_t ) length;
+        *pDirection = ( uint32_t ) ( lengthAndDirection & 1U );
+    }
+
+    return whole;
+}
+
+/*-----------------------------------------------------------*/
+
+static void nextRecvRecord( ReplayTransportParams_t * pReplayParams )
+{
+    uint64_t delayUs = 0U;
+    size_t length = 0U;
+    uint32_t direction = CAPTURE_TRANSPORT_SEND;
+
+    while( ( pReplayParams->dataRemaining == 0U ) &&
+           ( pReplayParams->position < pReplayParams->captureLength ) )
+    {
+        ( void ) decodeRecord( pReplayParams->pCapture,
+                               pReplayParams->captureLength,
+                               &pReplayParams->position,
+                               &delayUs,
+                               &length,
+                               &direction );
+
+        pReplayParams->recordTimeUs += delayUs;
+
+        if( direction == CAPTURE_TRANSPORT_RECV )
+        {
+            pReplayParams->dataPosition = pReplayParams->position;
+            pReplayParams->dataRemaining = length;
+        }
+
+        pReplayParams->position += length;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool isInitialized( const NetworkContext_t * pNetworkContext )
+{
+    return ( pNetworkContext != NULL ) &&
+           ( pNetworkContext->pParams != NULL ) &&
+           ( pNetworkContext->pParams->pCapture != NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+CaptureTransportStatus_t ReplayTransport_Init( NetworkContext_t * pNetworkContext,
+                                               const uint8_t * pCapture,
+                                               size_t captureLength,
+                                               ReplayTransportSpeed_t speed )
+{
+    CaptureTransportStatus_t returnStatus = CAPTURE_TRANSPORT_SUCCESS;
+    ReplayTransportParams_t * pReplayParams = NULL;
+    size_t position = CAPTURE_TRANSPORT_HEADER_LENGTH;
+    size_t recvLength = 0U;
+    size_t sendLength = 0U;
+    size_t recvEnd = CAPTURE_TRANSPORT_HEADER_LENGTH;
+    uint64_t timeUs = 0U;
+    uint64_t delayUs = 0U;
+    size_t length = 0U;
+    uint32_t direction = CAPTURE_TRANSPORT_SEND;
+
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) || ( pCapture == NULL ) ||
+        ( ( speed != REPLAY_TRANSPORT_MAX_SPEED ) && ( speed != REPLAY_TRANSPORT_RECORDED_SPEED ) ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext, its parameters and pCapture must not be NULL, "
+                    "and speed must be a speed." ) );
+        returnStatus = CAPTURE_TRANSPORT_INVALID_PARAMETER;
+    }
+    else if( ( captureLength < CAPTURE_TRANSPORT_HEADER_LENGTH ) ||
+             ( memcmp( pCapture, CAPTURE_TRANSPORT_MAGIC, CAPTURE_TRANSPORT_MAGIC_LENGTH ) != 0 ) ||
+             ( pCapture[ CAPTURE_TRANSPORT_MAGIC_LENGTH ] != ( uint8_t ) CAPTURE_TRANSPORT_VERSION ) )
+    {
+        LogError( ( "The capture does not start with the header of version %u.",
+                    ( unsigned int ) CAPTURE_TRANSPORT_VERSION ) );
+        returnStatus = CAPTURE_TRANSPORT_MALFORMED_CAPTURE;
+    }
+    else
+    {
+        /* The records are checked once, so that the replay only reads
+         * records it knows to be whole. */
+        while( ( returnStatus == CAPTURE_TRANSPORT_SUCCESS ) && ( position < captureLength ) )
+        {
+            if( ( decodeRecord( pCapture, captureLength, &position, &delayUs, &length, &direction ) == false ) ||
+                ( delayUs > ( UINT64_MAX - timeUs ) ) )
+            {
+                LogError( ( "Malformed record at offset %lu of the capture.", ( unsigned long ) position ) );
+                returnStatus = CAPTURE_TRANSPORT_MALFORMED_CAPTURE;
+            }
+            else
+            {
+                timeUs += delayUs;
+
+                if( direction == CAPTURE_TRANSPORT_RECV )
+                {
+                    recvLength += length;
+                }
+                else
+                {
+                    sendLength += length;
+                }
+
+                position += length;
+
+                if( direction == CAPTURE_TRANSPORT_RECV )
+                {
+                    recvEnd = position;
+                }
+            }
+        }
+    }
+
+    if( returnStatus == CAPTURE_TRANSPORT_SUCCESS )
+    {
+        pReplayParams = pNetworkContext->pParams;
+        ( void ) memset( pReplayParams, 0, sizeof( ReplayTransportParams_t ) );
+        pReplayParams->pCapture = pCapture;
+        pReplayParams->captureLength = captureLength;
+        pReplayParams->speed = speed;
+        pReplayParams->recvLength = recvLength;
+        pReplayParams->sendLength = sendLength;
+        pReplayParams->recvEnd = recvEnd;
+        returnStatus = ReplayTransport_Rewind( pNetworkContext );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+CaptureTransportStatus_t ReplayTransport_Rewind( NetworkContext_t * pNetworkContext )
+{
+    CaptureTransportStatus_t returnStatus = CAPTURE_TRANSPORT_SUCCESS;
+    ReplayTransportParams_t * pReplayParams = NULL;
+
+    if( isInitialized( pNetworkContext ) == false )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext has no capture to replay." ) );
+        returnStatus = CAPTURE_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        pReplayParams = pNetworkContext->pParams;
+        pReplayParams->position = CAPTURE_TRANSPORT_HEADER_LENGTH;
+        pReplayParams->dataPosition = CAPTURE_TRANSPORT_HEADER_LENGTH;
+        pReplayParams->dataRemaining = 0U;
+        pReplayParams->recordTimeUs = 0U;
+        pReplayParams->bytesSent = 0U;
+
+        /* The clock is only read at the recorded speed, so that the replay
+         * at the maximum speed costs no more than the client. */
+        if( pReplayParams->speed == REPLAY_TRANSPORT_RECORDED_SPEED )
+        {
+            pReplayParams->startTimeUs = Clock_GetTimeUs();
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+bool ReplayTransport_IsFinished( const NetworkContext_t * pNetworkContext )
+{
+    return ( isInitialized( pNetworkContext ) == true ) &&
+           ( pNetworkContext->pParams->dataRemaining == 0U ) &&
+           ( pNetworkContext->pParams->position >= pNetworkContext->pParams->recvEnd );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t ReplayTransport_Recv( NetworkContext_t * pNetworkContext,
+                              void * pBuffer,
+                              size_t bytesToRecv )
+{
+    int32_t bytesReceived = -1;
+    ReplayTransportParams_t * pReplayParams = NULL;
+    size_t length = 0U;
+
+    if( ( isInitialized( pNetworkContext ) == false ) || ( pBuffer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext must have a capture and pBuffer must not be NULL." ) );
+    }
+    else
+    {
+        pReplayParams = pNetworkContext->pParams;
+        nextRecvRecord( pReplayParams );
+
+        if( pReplayParams->dataRemaining == 0U )
+        {
+            LogDebug( ( "Replay finished." ) );
+        }
+        else if( ( pReplayParams->speed == REPLAY_TRANSPORT_RECORDED_SPEED ) &&
+                 ( ( Clock_GetTimeUs() - pReplayParams->startTimeUs ) < pReplayParams->recordTimeUs ) )
+        {
+            /* The record is not due yet. */
+            bytesReceived = 0;
+        }
+        else
+        {
+            length = ( bytesToRecv < pReplayParams->dataRemaining ) ?
+                     bytesToRecv : pReplayParams->dataRemaining;
+
+            ( void ) memcpy( pBuffer, &pReplayParams->pCapture[ pReplayParams->dataPosition ], length );
+
+            pReplayParams->dataPosition += length;
+            pReplayParams->dataRemaining -= length;
+            bytesReceived = ( int32_t ) length;
+        }
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t ReplayTransport_Send( NetworkContext_t * pNetworkContext,
+                              const void * pBuffer,
+                              size_t bytesToSend )
+{
+    int32_t bytesSent = -1;
+    size_t length = bytesToSend;
+
+    if( ( isInitialized( pNetworkContext ) == false ) || ( pBuffer == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext must have a capture and pBuffer must not be NULL." ) );
+    }
+    else
+    {
+        if( length > ( size_t ) INT32_MAX )
+        {
+            length = ( size_t ) INT32_MAX;
+        }
+
+        pNetworkContext->pParams->bytesSent += length;
+        bytesSent = ( int32_t ) length;
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
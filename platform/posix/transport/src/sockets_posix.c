@@ -22,19 +22,32 @@
 
 /* Standard includes. */
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* POSIX sockets includes. */
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 
 #include "sockets_posix.h"
 
+/* Allocator include. */
+#include "allocator.h"
+
+/* Trace probes of the connection phases. */
+#include "trace_probes.h"
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -49,6 +62,162 @@
 
 /*-----------------------------------------------------------*/
 
+#if ( SOCKETS_DNS_CACHE_TTL_MS > 0U )
+
+/**
+ * @brief DNS records of a host name kept by the DNS cache.
+ */
+    typedef struct DnsCacheEntry
+    {
+        char hostName[ SOCKETS_DNS_CACHE_MAX_HOSTNAME_LENGTH ]; /**< @brief Host name, not NULL-terminated. */
+        size_t hostNameLength;                                  /**< @brief Length of the host name; 0 if the entry is unused. */
+        struct addrinfo * pListHead;                            /**< @brief Records from getaddrinfo; NULL for a host that does not exist. */
+        uint64_t expiryTimeMs;                                  /**< @brief Monotonic time after which the entry is stale. */
+    } DnsCacheEntry_t;
+
+/**
+ * @brief Host names resolved recently.
+ */
+    static DnsCacheEntry_t dnsCache[ SOCKETS_DNS_CACHE_SIZE ];
+
+/**
+ * @brief Mutex protecting #dnsCache.
+ */
+    static pthread_mutex_t dnsCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Get the current monotonic time in milliseconds.
+ *
+ * @return Milliseconds elapsed since an arbitrary point in the past.
+ */
+    static uint64_t getMonotonicTimeMs( void );
+
+/**
+ * @brief Find the cache entry of a host name.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ *
+ * @return The matching entry whether or not it is stale, or NULL.
+ */
+    static DnsCacheEntry_t * findCachedHost( const char * pHostName,
+                                             size_t hostNameLength );
+
+/**
+ * @brief Copy a list of DNS records so that the caller owns the copy and
+ * may release it with #releaseAddressList.
+ *
+ * @param[in] pListHead List to copy.
+ *
+ * @return The copy, or NULL if memory could not be allocated.
+ */
+    static struct addrinfo * copyAddressList( const struct addrinfo * pListHead );
+
+/**
+ * @brief Look up a host name in the DNS cache.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ * @param[out] pListHead Copy of the cached records on a positive hit.
+ * @param[out] pStatus Result of the lookup on a hit.
+ *
+ * @return 1 if the host name was found in the cache and is not stale;
+ * 0 otherwise.
+ */
+    static uint8_t lookupCachedHost( const char * pHostName,
+                                     size_t hostNameLength,
+                                     struct addrinfo ** pListHead,
+                                     SocketStatus_t * pStatus );
+
+/**
+ * @brief Store the result of getaddrinfo in the DNS cache.
+ *
+ * The cache takes ownership of @p pListHead if it returns 1.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ * @param[in] pListHead Records from getaddrinfo, or NULL for a host name
+ * that does not exist.
+ *
+ * @return 1 if the result was stored; 0 otherwise.
+ */
+    static uint8_t storeCachedHost( const char * pHostName,
+                                    size_t hostNameLength,
+                                    struct addrinfo * pListHead );
+
+/**
+ * @brief Drop a host name from the DNS cache, so that the next connection
+ * to it resolves the host name again.
+ *
+ * @param[in] pHostName Server host name.
+ * @param[in] hostNameLength Length associated with host name.
+ */
+    static void invalidateCachedHost( const char * pHostName,
+                                      size_t hostNameLength );
+#endif /* if ( SOCKETS_DNS_CACHE_TTL_MS > 0U ) */
+
+/**
+ * @brief Tokens of the throttle per byte, so that the bucket refills by
+ * whole tokens every microsecond.
+ */
+#define THROTTLE_TOKENS_PER_BYTE    ( ( int64_t ) ONE_SEC_TO_MS * ONE_MS_TO_US )
+
+/**
+ * @brief Longest time in microseconds the throttle refills the bucket for at
+ * once, which keeps the refill from overflowing after a long idle time.
+ */
+#define THROTTLE_MAX_REFILL_US      ( ( uint64_t ) 10U * ONE_SEC_TO_MS * ONE_MS_TO_US )
+
+/**
+ * @brief Token bucket shared by the connections of the process.
+ */
+typedef struct ThrottleState
+{
+    TransportThrottleConfig_t config; /**< @brief Configured limit; #TransportThrottleConfig_t.rateBytesPerSec is 0 without a limit. */
+    uint32_t rate;                    /**< @brief Current limit in bytes per second, lowered by the round trip time. */
+    int64_t tokens;                   /**< @brief Tokens in the bucket, #THROTTLE_TOKENS_PER_BYTE per byte; negative after interactive bursts. */
+    uint64_t lastRefillUs;            /**< @brief Time of the last refill of the bucket. */
+} ThrottleState_t;
+
+/**
+ * @brief State of the throttle.
+ */
+static ThrottleState_t throttle;
+
+/**
+ * @brief Mutex protecting #throttle.
+ */
+static pthread_mutex_t throttleMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Policy set with #Sockets_SetBindingPolicy, or NULL.
+ */
+static SocketsBindingPolicy_t bindingPolicy = NULL;
+
+/**
+ * @brief Context passed to #bindingPolicy.
+ */
+static void * pBindingPolicyContext = NULL;
+
+/**
+ * @brief Mutex protecting #bindingPolicy and #pBindingPolicyContext.
+ */
+static pthread_mutex_t bindingPolicyMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Add the tokens accrued since the last refill to the bucket.
+ *
+ * The caller holds #throttleMutex and has checked that there is a limit.
+ */
+static void refillThrottle( void );
+
+/**
+ * @brief Release a list of DNS records returned by #resolveHostName.
+ *
+ * @param[in] pListHead List to release.
+ */
+static void releaseAddressList( struct addrinfo * pListHead );
+
 /**
  * @brief Resolve a host name.
  *
@@ -70,6 +239,8 @@ static SocketStatus_t resolveHostName( const char * pHostName,
  * @param[in] pHostName Server host name.
  * @param[in] hostNameLength Length associated with host name.
  * @param[in] port Server port in host-order.
+ * @param[in] pSocketOptions TCP options to apply to each socket. May be NULL.
+ * @param[in] pBinding Local end to bind each socket to.
  * @param[out] pTcpSocket The output parameter to return the created socket.
  *
  * @return #SOCKETS_SUCCESS if successful; #SOCKETS_CONNECT_FAILURE on error.
@@ -78,8 +249,96 @@ static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
                                          const char * pHostName,
                                          size_t hostNameLength,
                                          uint16_t port,
+                                         const SocketOptions_t * pSocketOptions,
+                                         const SocketBinding_t * pBinding,
                                          int32_t * pTcpSocket );
 
+#if ( SOCKETS_CONNECTION_ATTEMPT_DELAY_MS > 0U )
+
+/**
+ * @brief Order DNS records for connection attempts, alternating between
+ * address families starting with the family of the first record, as
+ * described by RFC 8305 section 4.
+ *
+ * @param[in] pListHead List containing resolved DNS records.
+ * @param[out] pCandidates Array receiving the ordered records.
+ *
+ * @return Number of records written to @p pCandidates.
+ */
+    static size_t interleaveAddressFamilies( const struct addrinfo * pListHead,
+                                             const struct addrinfo ** pCandidates );
+
+/**
+ * @brief Race non-blocking connection attempts to DNS records, starting
+ * one every #SOCKETS_CONNECTION_ATTEMPT_DELAY_MS, and keep the first socket
+ * that connects.
+ *
+ * @param[in] pListHead List containing resolved DNS records.
+ * @param[in] port Server port in host-order.
+ * @param[in] pSocketOptions TCP options to apply to each socket. May be NULL.
+ * @param[in] pBinding Local end to bind each socket to.
+ * @param[out] pTcpSocket The output parameter to return the connected socket.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_CONNECT_FAILURE on error.
+ */
+    static SocketStatus_t raceConnections( const struct addrinfo * pListHead,
+                                           uint16_t port,
+                                           const SocketOptions_t * pSocketOptions,
+                                           const SocketBinding_t * pBinding,
+                                           int32_t * pTcpSocket );
+#endif /* if ( SOCKETS_CONNECTION_ATTEMPT_DELAY_MS > 0U ) */
+
+/**
+ * @brief Set an integer socket option, logging a warning if the system
+ * rejects it.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] level Protocol level of the option.
+ * @param[in] optionName Name of the option.
+ * @param[in] value Value of the option.
+ * @param[in] pOptionString Name of the option to log.
+ */
+static void setIntegerOption( int32_t tcpSocket,
+                              int32_t level,
+                              int32_t optionName,
+                              int32_t value,
+                              const char * pOptionString );
+
+/**
+ * @brief Apply the TCP options requested in #ServerInfo_t.pSocketOptions to
+ * a socket that is not yet connected.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] pSocketOptions TCP options to apply. May be NULL.
+ */
+static void applySocketOptions( int32_t tcpSocket,
+                                const SocketOptions_t * pSocketOptions );
+
+/**
+ * @brief Choose the local end of a connection: the binding of
+ * #ServerInfo_t.pSocketOptions, as changed by the #SocketsBindingPolicy_t.
+ *
+ * @param[in] pServerInfo Server connection info.
+ * @param[out] pBinding The binding to use for each attempt.
+ */
+static void resolveBinding( const ServerInfo_t * pServerInfo,
+                            SocketBinding_t * pBinding );
+
+/**
+ * @brief Bind a socket that is not yet connected to the interface and source
+ * address of a #SocketBinding_t.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] family Address family of the server address.
+ * @param[in] pBinding The binding to apply.
+ *
+ * @return #SOCKETS_SUCCESS if successful or there is nothing to bind;
+ * #SOCKETS_CONNECT_FAILURE if the socket cannot be bound as requested.
+ */
+static SocketStatus_t bindSocket( int32_t tcpSocket,
+                                  int32_t family,
+                                  const SocketBinding_t * pBinding );
+
 /**
  * @brief Connect to server using the provided address record.
  *
@@ -93,6 +352,45 @@ static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
                                         uint16_t port,
                                         int32_t tcpSocket );
 
+/**
+ * @brief Start a non-blocking connect to the next DNS record of a
+ * connection started with #Sockets_ConnectStart that accepts one.
+ *
+ * @param[in, out] pContext Connection state.
+ *
+ * @return #SOCKETS_WANT_WRITE if a connection is in progress;
+ * #SOCKETS_SUCCESS if connected immediately; #SOCKETS_CONNECT_FAILURE if no
+ * DNS record is left to attempt.
+ */
+static SocketStatus_t startNextConnection( SocketConnectContext_t * pContext );
+
+/**
+ * @brief Complete a step of a non-blocking connection, releasing the DNS
+ * records once the connection is established or has failed.
+ *
+ * @param[in, out] pContext Connection state.
+ * @param[in] connectStatus Status of the connection step.
+ *
+ * @return #SOCKETS_SUCCESS if connected and configured; #SOCKETS_WANT_WRITE
+ * if the connection is in progress; other statuses on error.
+ */
+static SocketStatus_t finishConnectStep( SocketConnectContext_t * pContext,
+                                         SocketStatus_t connectStatus );
+
+/**
+ * @brief Set the send and receive timeouts of a connected socket.
+ *
+ * @param[in] tcpSocket The socket descriptor.
+ * @param[in] sendTimeoutMs Timeout for transport send.
+ * @param[in] recvTimeoutMs Timeout for transport recv.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_API_ERROR,
+ * #SOCKETS_INSUFFICIENT_MEMORY, #SOCKETS_INVALID_PARAMETER on error.
+ */
+static SocketStatus_t setSocketTimeouts( int32_t tcpSocket,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs );
+
 /**
  * @brief Log possible error using errno and return appropriate status.
  *
@@ -111,6 +409,11 @@ static SocketStatus_t resolveHostName( const char * pHostName,
     SocketStatus_t returnStatus = SOCKETS_SUCCESS;
     int32_t dnsStatus = -1;
     struct addrinfo hints;
+    uint8_t cacheHit = 0U;
+
+    #if ( SOCKETS_DNS_CACHE_TTL_MS > 0U )
+        struct addrinfo * pResolvedList = NULL;
+    #endif
 
     assert( pHostName != NULL );
     assert( hostNameLength > 0 );
@@ -118,6 +421,8 @@ static SocketStatus_t resolveHostName( const char * pHostName,
     /* Unused parameter. These parameters are used only for logging. */
     ( void ) hostNameLength;
 
+    TRACE_PROBE1( dns_start, pHostName );
+
     /* Add hints to retrieve only TCP sockets in getaddrinfo. */
     ( void ) memset( &hints, 0, sizeof( hints ) );
 
@@ -127,289 +432,1708 @@ static SocketStatus_t resolveHostName( const char * pHostName,
     hints.ai_socktype = ( int32_t ) SOCK_STREAM;
     hints.ai_protocol = IPPROTO_TCP;
 
-    /* Perform a DNS lookup on the given host name. */
-    dnsStatus = getaddrinfo( pHostName, NULL, &hints, pListHead );
+    #if ( SOCKETS_DNS_CACHE_TTL_MS > 0U )
+        cacheHit = lookupCachedHost( pHostName, hostNameLength, pListHead, &returnStatus );
 
-    if( dnsStatus != 0 )
+        if( cacheHit == 1U )
+        {
+            LogDebug( ( "Using cached DNS lookup: Hostname=%.*s.",
+                        ( int32_t ) hostNameLength,
+                        pHostName ) );
+        }
+    #endif
+
+    if( cacheHit == 0U )
     {
-        LogError( ( "Failed to resolve DNS: Hostname=%.*s, ErrorCode=%d.\n",
-                    ( int32_t ) hostNameLength,
-                    pHostName,
-                    dnsStatus ) );
-        returnStatus = SOCKETS_DNS_FAILURE;
+        /* Perform a DNS lookup on the given host name. */
+        dnsStatus = getaddrinfo( pHostName, NULL, &hints, pListHead );
+
+        if( dnsStatus != 0 )
+        {
+            LogError( ( "Failed to resolve DNS: Hostname=%.*s, ErrorCode=%d.\n",
+                        ( int32_t ) hostNameLength,
+                        pHostName,
+                        dnsStatus ) );
+            returnStatus = SOCKETS_DNS_FAILURE;
+
+            /* Only remember that the host does not exist, as other errors
+             * may be transient. */
+            #if ( SOCKETS_DNS_CACHE_TTL_MS > 0U ) && ( SOCKETS_DNS_NEGATIVE_CACHE_TTL_MS > 0U )
+                if( dnsStatus == EAI_NONAME )
+                {
+                    ( void ) storeCachedHost( pHostName, hostNameLength, NULL );
+                }
+            #endif
+        }
+
+        #if ( SOCKETS_DNS_CACHE_TTL_MS > 0U )
+            else
+            {
+                /* The caller always receives a copy so that the records are
+                 * released the same way whether or not they were cached. */
+                pResolvedList = *pListHead;
+                *pListHead = copyAddressList( pResolvedList );
+
+                if( storeCachedHost( pHostName, hostNameLength, pResolvedList ) == 0U )
+                {
+                    freeaddrinfo( pResolvedList );
+                }
+
+                if( *pListHead == NULL )
+                {
+                    LogError( ( "Failed to allocate memory for the DNS records." ) );
+                    returnStatus = SOCKETS_INSUFFICIENT_MEMORY;
+                }
+            }
+        #endif /* if ( SOCKETS_DNS_CACHE_TTL_MS > 0U ) */
     }
 
+    TRACE_PROBE2( dns_done, returnStatus, cacheHit );
+
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
-                                        uint16_t port,
-                                        int32_t tcpSocket )
-{
-    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
-    int32_t connectStatus = 0;
-    char resolvedIpAddr[ INET6_ADDRSTRLEN ];
-    socklen_t addrInfoLength;
-    uint16_t netPort = 0;
-    struct sockaddr_in * pIpv4Address;
-    struct sockaddr_in6 * pIpv6Address;
-
-    assert( pAddrInfo != NULL );
-    assert( pAddrInfo->sa_family == AF_INET || pAddrInfo->sa_family == AF_INET6 );
-    assert( tcpSocket >= 0 );
-
-    /* Convert port from host byte order to network byte order. */
-    netPort = htons( port );
+#if ( SOCKETS_DNS_CACHE_TTL_MS > 0U )
 
-    if( pAddrInfo->sa_family == ( sa_family_t ) AF_INET )
+    static uint64_t getMonotonicTimeMs( void )
     {
-        /* MISRA Rule 11.3 flags the following line for casting a pointer of
-         * a object type to a pointer of a different object type. This rule
-         * is suppressed because casting from a struct sockaddr pointer to
-         * a struct sockaddr_in pointer is supported in POSIX and is used
-         * to obtain the IP address from the address record. */
-        /* coverity[misra_c_2012_rule_11_3_violation] */
-        pIpv4Address = ( struct sockaddr_in * ) pAddrInfo;
-        /* Store IPv4 in string to log. */
-        pIpv4Address->sin_port = netPort;
-        addrInfoLength = ( socklen_t ) sizeof( struct sockaddr_in );
-        ( void ) inet_ntop( ( int32_t ) pAddrInfo->sa_family,
-                            &pIpv4Address->sin_addr,
-                            resolvedIpAddr,
-                            ( socklen_t ) sizeof( resolvedIpAddr ) );
+        return TransportStats_GetTimeUs() / ONE_MS_TO_US;
     }
-    else
+/*-----------------------------------------------------------*/
+
+    static DnsCacheEntry_t * findCachedHost( const char * pHostName,
+                                             size_t hostNameLength )
     {
-        /* MISRA Rule 11.3 flags the following line for casting a pointer of
-         * a object type to a pointer of a different object type. This rule
-         * is suppressed because casting from a struct sockaddr pointer to
-         * a struct sockaddr_in6 pointer is supported in POSIX and is used
-         * to obtain the IPv6 address from the address record. */
-        /* coverity[misra_c_2012_rule_11_3_violation] */
-        pIpv6Address = ( struct sockaddr_in6 * ) pAddrInfo;
-        /* Store IPv6 in string to log. */
-        pIpv6Address->sin6_port = netPort;
-        addrInfoLength = ( socklen_t ) sizeof( struct sockaddr_in6 );
-        ( void ) inet_ntop( ( int32_t ) pAddrInfo->sa_family,
-                            &pIpv6Address->sin6_addr,
-                            resolvedIpAddr,
-                            ( socklen_t ) sizeof( resolvedIpAddr ) );
-    }
+        DnsCacheEntry_t * pEntry = NULL;
+        size_t i = 0U;
 
-    LogDebug( ( "Attempting to connect to server using the resolved IP address:"
-                " IP address=%s.",
-                resolvedIpAddr ) );
+        for( i = 0U; i < SOCKETS_DNS_CACHE_SIZE; i++ )
+        {
+            if( ( dnsCache[ i ].hostNameLength == hostNameLength ) &&
+                ( memcmp( dnsCache[ i ].hostName, pHostName, hostNameLength ) == 0 ) )
+            {
+                pEntry = &dnsCache[ i ];
+                break;
+            }
+        }
 
-    /* Attempt to connect. */
-    connectStatus = connect( tcpSocket, pAddrInfo, addrInfoLength );
+        return pEntry;
+    }
+/*-----------------------------------------------------------*/
 
-    if( connectStatus == -1 )
+    static struct addrinfo * copyAddressList( const struct addrinfo * pListHead )
     {
-        LogWarn( ( "Failed to connect to server using the resolved IP address: IP address=%s.",
-                   resolvedIpAddr ) );
-        ( void ) close( tcpSocket );
-        returnStatus = SOCKETS_CONNECT_FAILURE;
-    }
+        struct addrinfo * pCopyHead = NULL, * pCopy = NULL;
+        struct addrinfo ** ppNext = &pCopyHead;
+        const struct addrinfo * pIndex = NULL;
 
-    return returnStatus;
-}
-/*-----------------------------------------------------------*/
+        for( pIndex = pListHead; pIndex != NULL; pIndex = pIndex->ai_next )
+        {
+            /* Each record and its address share a single allocation. */
+            pCopy = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_TRANSPORT, sizeof( struct addrinfo ) + pIndex->ai_addrlen );
 
-static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
-                                         const char * pHostName,
-                                         size_t hostNameLength,
-                                         uint16_t port,
-                                         int32_t * pTcpSocket )
-{
-    SocketStatus_t returnStatus = SOCKETS_CONNECT_FAILURE;
-    const struct addrinfo * pIndex = NULL;
+            if( pCopy == NULL )
+            {
+                releaseAddressList( pCopyHead );
+                pCopyHead = NULL;
+                break;
+            }
 
-    assert( pListHead != NULL );
-    assert( pHostName != NULL );
-    assert( hostNameLength > 0 );
-    assert( pTcpSocket != NULL );
+            ( void ) memcpy( pCopy, pIndex, sizeof( struct addrinfo ) );
+            /* MISRA Rule 11.3 flags the following line for casting a pointer
+             * of a object type to a pointer of a different object type. This
+             * rule is suppressed because the address is stored right after
+             * the record in the same allocation, which the allocator aligns
+             * for any type. */
+            /* coverity[misra_c_2012_rule_11_3_violation] */
+            pCopy->ai_addr = ( struct sockaddr * ) &pCopy[ 1 ];
+            ( void ) memcpy( pCopy->ai_addr, pIndex->ai_addr, pIndex->ai_addrlen );
+            pCopy->ai_canonname = NULL;
+            pCopy->ai_next = NULL;
 
-    /* Unused parameters when logging is disabled. */
-    ( void ) pHostName;
-    ( void ) hostNameLength;
+            *ppNext = pCopy;
+            ppNext = &pCopy->ai_next;
+        }
 
-    LogDebug( ( "Attempting to connect to: Host=%.*s.",
-                ( int32_t ) hostNameLength,
-                pHostName ) );
+        return pCopyHead;
+    }
+/*-----------------------------------------------------------*/
 
-    /* Attempt to connect to one of the retrieved DNS records. */
-    for( pIndex = pListHead; pIndex != NULL; pIndex = pIndex->ai_next )
+    static uint8_t lookupCachedHost( const char * pHostName,
+                                     size_t hostNameLength,
+                                     struct addrinfo ** pListHead,
+                                     SocketStatus_t * pStatus )
     {
-        *pTcpSocket = socket( pIndex->ai_family,
-                              pIndex->ai_socktype,
-                              pIndex->ai_protocol );
+        DnsCacheEntry_t * pEntry = NULL;
+        uint8_t cacheHit = 0U;
 
-        if( *pTcpSocket == -1 )
-        {
-            continue;
-        }
+        ( void ) pthread_mutex_lock( &dnsCacheMutex );
 
-        /* Attempt to connect to a resolved DNS address of the host. */
-        returnStatus = connectToAddress( pIndex->ai_addr, port, *pTcpSocket );
+        pEntry = findCachedHost( pHostName, hostNameLength );
 
-        /* If connected to an IP address successfully, exit from the loop. */
-        if( returnStatus == SOCKETS_SUCCESS )
+        if( ( pEntry != NULL ) && ( pEntry->expiryTimeMs > getMonotonicTimeMs() ) )
         {
-            break;
+            cacheHit = 1U;
+
+            if( pEntry->pListHead == NULL )
+            {
+                LogError( ( "Failed to resolve DNS: Hostname=%.*s does not exist (cached).",
+                            ( int32_t ) hostNameLength,
+                            pHostName ) );
+                *pStatus = SOCKETS_DNS_FAILURE;
+            }
+            else
+            {
+                *pListHead = copyAddressList( pEntry->pListHead );
+                *pStatus = ( *pListHead != NULL ) ? SOCKETS_SUCCESS : SOCKETS_INSUFFICIENT_MEMORY;
+            }
         }
+
+        ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+
+        return cacheHit;
     }
+/*-----------------------------------------------------------*/
 
-    if( returnStatus == SOCKETS_SUCCESS )
+    static uint8_t storeCachedHost( const char * pHostName,
+                                    size_t hostNameLength,
+                                    struct addrinfo * pListHead )
     {
-        LogDebug( ( "Established TCP connection: Server=%.*s.\n",
-                    ( int32_t ) hostNameLength,
-                    pHostName ) );
+        DnsCacheEntry_t * pEntry = NULL;
+        uint8_t stored = 0U;
+        size_t i = 0U;
+
+        if( hostNameLength <= SOCKETS_DNS_CACHE_MAX_HOSTNAME_LENGTH )
+        {
+            ( void ) pthread_mutex_lock( &dnsCacheMutex );
+
+            pEntry = findCachedHost( pHostName, hostNameLength );
+
+            /* Otherwise, use a free entry or replace the one that expires
+             * first. */
+            for( i = 0U; ( pEntry == NULL ) && ( i < SOCKETS_DNS_CACHE_SIZE ); i++ )
+            {
+                if( dnsCache[ i ].hostNameLength == 0U )
+                {
+                    pEntry = &dnsCache[ i ];
+                }
+            }
+
+            if( pEntry == NULL )
+            {
+                pEntry = &dnsCache[ 0 ];
+
+                for( i = 1U; i < SOCKETS_DNS_CACHE_SIZE; i++ )
+                {
+                    if( dnsCache[ i ].expiryTimeMs < pEntry->expiryTimeMs )
+                    {
+                        pEntry = &dnsCache[ i ];
+                    }
+                }
+            }
+
+            if( pEntry->pListHead != NULL )
+            {
+                freeaddrinfo( pEntry->pListHead );
+            }
+
+            ( void ) memcpy( pEntry->hostName, pHostName, hostNameLength );
+            pEntry->hostNameLength = hostNameLength;
+            pEntry->pListHead = pListHead;
+            pEntry->expiryTimeMs = getMonotonicTimeMs() +
+                                   ( ( pListHead != NULL ) ? SOCKETS_DNS_CACHE_TTL_MS :
+                                     SOCKETS_DNS_NEGATIVE_CACHE_TTL_MS );
+            stored = 1U;
+
+            ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+        }
+
+        return stored;
+    }
+/*-----------------------------------------------------------*/
+
+    static void invalidateCachedHost( const char * pHostName,
+                                      size_t hostNameLength )
+    {
+        DnsCacheEntry_t * pEntry = NULL;
+
+        ( void ) pthread_mutex_lock( &dnsCacheMutex );
+
+        pEntry = findCachedHost( pHostName, hostNameLength );
+
+        if( pEntry != NULL )
+        {
+            if( pEntry->pListHead != NULL )
+            {
+                freeaddrinfo( pEntry->pListHead );
+            }
+
+            ( void ) memset( pEntry, 0, sizeof( DnsCacheEntry_t ) );
+        }
+
+        ( void ) pthread_mutex_unlock( &dnsCacheMutex );
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( SOCKETS_DNS_CACHE_TTL_MS > 0U ) */
+
+static void releaseAddressList( struct addrinfo * pListHead )
+{
+    #if ( SOCKETS_DNS_CACHE_TTL_MS > 0U )
+        struct addrinfo * pNext = NULL;
+
+        /* Lists returned by #resolveHostName are copies made by
+         * #copyAddressList when the DNS cache is enabled. */
+        while( pListHead != NULL )
+        {
+            pNext = pListHead->ai_next;
+            Allocator_Free( pListHead );
+            pListHead = pNext;
+        }
+    #else
+        freeaddrinfo( pListHead );
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+static void setIntegerOption( int32_t tcpSocket,
+                              int32_t level,
+                              int32_t optionName,
+                              int32_t value,
+                              const char * pOptionString )
+{
+    /* Unused parameter when logging is disabled. */
+    ( void ) pOptionString;
+
+    if( setsockopt( tcpSocket,
+                    level,
+                    optionName,
+                    &value,
+                    ( socklen_t ) sizeof( value ) ) < 0 )
+    {
+        LogWarn( ( "Setting socket option %s to %d failed: %s.",
+                   pOptionString,
+                   ( int ) value,
+                   strerror( errno ) ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void applySocketOptions( int32_t tcpSocket,
+                                const SocketOptions_t * pSocketOptions )
+{
+    assert( tcpSocket >= 0 );
+
+    if( pSocketOptions != NULL )
+    {
+        if( pSocketOptions->noDelay == true )
+        {
+            setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY" );
+        }
+
+        /* The buffer sizes must be set before connecting for the receive
+         * window scale to account for them. */
+        if( pSocketOptions->sendBufferSize > 0 )
+        {
+            setIntegerOption( tcpSocket, SOL_SOCKET, SO_SNDBUF,
+                              pSocketOptions->sendBufferSize, "SO_SNDBUF" );
+        }
+
+        if( pSocketOptions->recvBufferSize > 0 )
+        {
+            setIntegerOption( tcpSocket, SOL_SOCKET, SO_RCVBUF,
+                              pSocketOptions->recvBufferSize, "SO_RCVBUF" );
+        }
+
+        if( pSocketOptions->keepAlive == true )
+        {
+            setIntegerOption( tcpSocket, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE" );
+
+            if( pSocketOptions->keepAliveIdleSec > 0U )
+            {
+                setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_KEEPIDLE,
+                                  ( int32_t ) pSocketOptions->keepAliveIdleSec, "TCP_KEEPIDLE" );
+            }
+
+            if( pSocketOptions->keepAliveIntervalSec > 0U )
+            {
+                setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_KEEPINTVL,
+                                  ( int32_t ) pSocketOptions->keepAliveIntervalSec, "TCP_KEEPINTVL" );
+            }
+
+            if( pSocketOptions->keepAliveCount > 0U )
+            {
+                setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_KEEPCNT,
+                                  ( int32_t ) pSocketOptions->keepAliveCount, "TCP_KEEPCNT" );
+            }
+        }
+
+        if( pSocketOptions->userTimeoutMs > 0U )
+        {
+            setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                              ( int32_t ) pSocketOptions->userTimeoutMs, "TCP_USER_TIMEOUT" );
+        }
+
+        if( pSocketOptions->fastOpen == true )
+        {
+            setIntegerOption( tcpSocket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, "TCP_FASTOPEN_CONNECT" );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void resolveBinding( const ServerInfo_t * pServerInfo,
+                            SocketBinding_t * pBinding )
+{
+    SocketsBindingPolicy_t policy = NULL;
+    void * pPolicyContext = NULL;
+
+    assert( pServerInfo != NULL );
+    assert( pBinding != NULL );
+
+    if( pServerInfo->pSocketOptions != NULL )
+    {
+        *pBinding = pServerInfo->pSocketOptions->binding;
+    }
+    else
+    {
+        ( void ) memset( pBinding, 0, sizeof( SocketBinding_t ) );
+    }
+
+    ( void ) pthread_mutex_lock( &bindingPolicyMutex );
+    policy = bindingPolicy;
+    pPolicyContext = pBindingPolicyContext;
+    ( void ) pthread_mutex_unlock( &bindingPolicyMutex );
+
+    /* The policy is called without the mutex, so that it may block or set
+     * another policy. */
+    if( policy != NULL )
+    {
+        policy( pPolicyContext, pServerInfo, pBinding );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t bindSocket( int32_t tcpSocket,
+                                  int32_t family,
+                                  const SocketBinding_t * pBinding )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    const struct sockaddr_in * pIpv4Address = NULL;
+    const struct sockaddr_in6 * pIpv6Address = NULL;
+    uint16_t localPort = 0U;
+
+    assert( tcpSocket >= 0 );
+    assert( pBinding != NULL );
+
+    if( pBinding->pInterfaceName != NULL )
+    {
+        if( setsockopt( tcpSocket,
+                        SOL_SOCKET,
+                        SO_BINDTODEVICE,
+                        pBinding->pInterfaceName,
+                        ( socklen_t ) strnlen( pBinding->pInterfaceName, IFNAMSIZ ) ) < 0 )
+        {
+            LogError( ( "Binding the socket to interface %.*s failed: %s.",
+                        ( int ) IFNAMSIZ,
+                        pBinding->pInterfaceName,
+                        strerror( errno ) ) );
+            returnStatus = SOCKETS_CONNECT_FAILURE;
+        }
+    }
+
+    if( ( returnStatus == SOCKETS_SUCCESS ) && ( pBinding->pLocalAddress != NULL ) )
+    {
+        if( ( int32_t ) pBinding->pLocalAddress->sa_family != family )
+        {
+            /* A source address cannot reach a server of another family. */
+            LogDebug( ( "Skipping a server address of another family than the source address." ) );
+            returnStatus = SOCKETS_CONNECT_FAILURE;
+        }
+        else
+        {
+            /* MISRA Rule 11.3 flags the following lines for casting a
+             * pointer to a different object type. This is supported in POSIX
+             * for reading the port of an address of a known family. */
+            if( family == AF_INET )
+            {
+                /* coverity[misra_c_2012_rule_11_3_violation] */
+                pIpv4Address = ( const struct sockaddr_in * ) pBinding->pLocalAddress;
+                localPort = pIpv4Address->sin_port;
+            }
+            else if( family == AF_INET6 )
+            {
+                /* coverity[misra_c_2012_rule_11_3_violation] */
+                pIpv6Address = ( const struct sockaddr_in6 * ) pBinding->pLocalAddress;
+                localPort = pIpv6Address->sin6_port;
+            }
+            else
+            {
+                /* Empty else MISRA 15.7 */
+            }
+
+            /* Without a port, leave it to connect to pick one, so that a
+             * source port is not reserved for every possible destination. */
+            if( localPort == 0U )
+            {
+                setIntegerOption( tcpSocket, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, 1, "IP_BIND_ADDRESS_NO_PORT" );
+            }
+
+            if( bind( tcpSocket,
+                      pBinding->pLocalAddress,
+                      pBinding->localAddressLength ) < 0 )
+            {
+                LogError( ( "Binding the socket to its source address failed: %s.",
+                            strerror( errno ) ) );
+                returnStatus = SOCKETS_CONNECT_FAILURE;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t connectToAddress( struct sockaddr * pAddrInfo,
+                                        uint16_t port,
+                                        int32_t tcpSocket )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    int32_t connectStatus = 0;
+    char resolvedIpAddr[ INET6_ADDRSTRLEN ];
+    socklen_t addrInfoLength;
+    uint16_t netPort = 0;
+    struct sockaddr_in * pIpv4Address;
+    struct sockaddr_in6 * pIpv6Address;
+
+    assert( pAddrInfo != NULL );
+    assert( pAddrInfo->sa_family == AF_INET || pAddrInfo->sa_family == AF_INET6 );
+    assert( tcpSocket >= 0 );
+
+    /* Convert port from host byte order to network byte order. */
+    netPort = htons( port );
+
+    if( pAddrInfo->sa_family == ( sa_family_t ) AF_INET )
+    {
+        /* MISRA Rule 11.3 flags the following line for casting a pointer of
+         * a object type to a pointer of a different object type. This rule
+         * is suppressed because casting from a struct sockaddr pointer to
+         * a struct sockaddr_in pointer is supported in POSIX and is used
+         * to obtain the IP address from the address record. */
+        /* coverity[misra_c_2012_rule_11_3_violation] */
+        pIpv4Address = ( struct sockaddr_in * ) pAddrInfo;
+        /* Store IPv4 in string to log. */
+        pIpv4Address->sin_port = netPort;
+        addrInfoLength = ( socklen_t ) sizeof( struct sockaddr_in );
+        ( void ) inet_ntop( ( int32_t ) pAddrInfo->sa_family,
+                            &pIpv4Address->sin_addr,
+                            resolvedIpAddr,
+                            ( socklen_t ) sizeof( resolvedIpAddr ) );
+    }
+    else
+    {
+        /* MISRA Rule 11.3 flags the following line for casting a pointer of
+         * a object type to a pointer of a different object type. This rule
+         * is suppressed because casting from a struct sockaddr pointer to
+         * a struct sockaddr_in6 pointer is supported in POSIX and is used
+         * to obtain the IPv6 address from the address record. */
+        /* coverity[misra_c_2012_rule_11_3_violation] */
+        pIpv6Address = ( struct sockaddr_in6 * ) pAddrInfo;
+        /* Store IPv6 in string to log. */
+        pIpv6Address->sin6_port = netPort;
+        addrInfoLength = ( socklen_t ) sizeof( struct sockaddr_in6 );
+        ( void ) inet_ntop( ( int32_t ) pAddrInfo->sa_family,
+                            &pIpv6Address->sin6_addr,
+                            resolvedIpAddr,
+                            ( socklen_t ) sizeof( resolvedIpAddr ) );
+    }
+
+    LogDebug( ( "Attempting to connect to server using the resolved IP address:"
+                " IP address=%s.",
+                resolvedIpAddr ) );
+
+    /* Attempt to connect. */
+    connectStatus = connect( tcpSocket, pAddrInfo, addrInfoLength );
+
+    if( ( connectStatus == -1 ) && ( errno == EINPROGRESS ) )
+    {
+        /* The socket is non-blocking and the connection is under way. */
+        LogDebug( ( "Connection in progress: IP address=%s.",
+                    resolvedIpAddr ) );
+        returnStatus = SOCKETS_WANT_WRITE;
+    }
+    else if( connectStatus == -1 )
+    {
+        LogWarn( ( "Failed to connect to server using the resolved IP address: IP address=%s.",
+                   resolvedIpAddr ) );
+        ( void ) close( tcpSocket );
+        returnStatus = SOCKETS_CONNECT_FAILURE;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t attemptConnection( struct addrinfo * pListHead,
+                                         const char * pHostName,
+                                         size_t hostNameLength,
+                                         uint16_t port,
+                                         const SocketOptions_t * pSocketOptions,
+                                         const SocketBinding_t * pBinding,
+                                         int32_t * pTcpSocket )
+{
+    SocketStatus_t returnStatus = SOCKETS_CONNECT_FAILURE;
+    const struct addrinfo * pIndex = NULL;
+
+    assert( pListHead != NULL );
+    assert( pHostName != NULL );
+    assert( hostNameLength > 0 );
+    assert( pTcpSocket != NULL );
+
+    /* Unused parameters when logging is disabled. */
+    ( void ) pHostName;
+    ( void ) hostNameLength;
+
+    LogDebug( ( "Attempting to connect to: Host=%.*s.",
+                ( int32_t ) hostNameLength,
+                pHostName ) );
+
+    #if ( SOCKETS_CONNECTION_ATTEMPT_DELAY_MS > 0U )
+        /* Race the retrieved DNS records. */
+        ( void ) pIndex;
+        returnStatus = raceConnections( pListHead, port, pSocketOptions, pBinding, pTcpSocket );
+    #else
+    /* Attempt to connect to one of the retrieved DNS records. */
+    for( pIndex = pListHead; pIndex != NULL; pIndex = pIndex->ai_next )
+    {
+        *pTcpSocket = socket( pIndex->ai_family,
+                              pIndex->ai_socktype,
+                              pIndex->ai_protocol );
+
+        if( *pTcpSocket == -1 )
+        {
+            continue;
+        }
+
+        applySocketOptions( *pTcpSocket, pSocketOptions );
+
+        if( bindSocket( *pTcpSocket, ( int32_t ) pIndex->ai_addr->sa_family, pBinding ) != SOCKETS_SUCCESS )
+        {
+            ( void ) close( *pTcpSocket );
+            returnStatus = SOCKETS_CONNECT_FAILURE;
+            continue;
+        }
+
+        /* Attempt to connect to a resolved DNS address of the host. */
+        returnStatus = connectToAddress( pIndex->ai_addr, port, *pTcpSocket );
+
+        /* If connected to an IP address successfully, exit from the loop. */
+        if( returnStatus == SOCKETS_SUCCESS )
+        {
+            break;
+        }
+    }
+    #endif /* if ( SOCKETS_CONNECTION_ATTEMPT_DELAY_MS > 0U ) */
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        LogDebug( ( "Established TCP connection: Server=%.*s.\n",
+                    ( int32_t ) hostNameLength,
+                    pHostName ) );
+    }
+    else
+    {
+        LogError( ( "Could not connect to any resolved IP address from %.*s.",
+                    ( int32_t ) hostNameLength,
+                    pHostName ) );
+
+        /* The cached records may be stale, so resolve the host name again on
+         * the next attempt. */
+        #if ( SOCKETS_DNS_CACHE_TTL_MS > 0U )
+            invalidateCachedHost( pHostName, hostNameLength );
+        #endif
+    }
+
+    releaseAddressList( pListHead );
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+#if ( SOCKETS_CONNECTION_ATTEMPT_DELAY_MS > 0U )
+
+    static size_t interleaveAddressFamilies( const struct addrinfo * pListHead,
+                                             const struct addrinfo ** pCandidates )
+    {
+        /* Next record to consider for the first and the other family. */
+        const struct addrinfo * pNext[ 2 ] = { pListHead, pListHead };
+        const struct addrinfo * pIndex = NULL;
+        size_t count = 0U, turn = 0U;
+        uint8_t exhausted[ 2 ] = { 0U, 0U };
+
+        assert( pListHead != NULL );
+        assert( pCandidates != NULL );
+
+        while( ( count < SOCKETS_MAX_CONNECTION_ATTEMPTS ) &&
+               ( ( exhausted[ 0 ] == 0U ) || ( exhausted[ 1 ] == 0U ) ) )
+        {
+            /* Find the next record of the family whose turn it is. */
+            for( pIndex = pNext[ turn ]; pIndex != NULL; pIndex = pIndex->ai_next )
+            {
+                if( ( pIndex->ai_family == pListHead->ai_family ) == ( turn == 0U ) )
+                {
+                    break;
+                }
+            }
+
+            if( pIndex != NULL )
+            {
+                pCandidates[ count ] = pIndex;
+                count++;
+                pNext[ turn ] = pIndex->ai_next;
+            }
+            else
+            {
+                exhausted[ turn ] = 1U;
+            }
+
+            turn ^= 1U;
+        }
+
+        return count;
+    }
+/*-----------------------------------------------------------*/
+
+    static SocketStatus_t raceConnections( const struct addrinfo * pListHead,
+                                           uint16_t port,
+                                           const SocketOptions_t * pSocketOptions,
+                                           const SocketBinding_t * pBinding,
+                                           int32_t * pTcpSocket )
+    {
+        SocketStatus_t returnStatus = SOCKETS_CONNECT_FAILURE;
+        const struct addrinfo * pCandidates[ SOCKETS_MAX_CONNECTION_ATTEMPTS ];
+        struct pollfd attempts[ SOCKETS_MAX_CONNECTION_ATTEMPTS ];
+        size_t candidateCount = 0U, nextCandidate = 0U, attemptCount = 0U, i = 0U;
+        int32_t tcpSocket = -1, pollStatus = 0, pollTimeoutMs = 0;
+        int32_t socketError = 0;
+        socklen_t socketErrorLength = 0;
+        uint8_t startNext = 1U;
+
+        assert( pListHead != NULL );
+        assert( pTcpSocket != NULL );
+
+        candidateCount = interleaveAddressFamilies( pListHead, pCandidates );
+        *pTcpSocket = -1;
+
+        while( ( *pTcpSocket == -1 ) &&
+               ( ( attemptCount > 0U ) || ( nextCandidate < candidateCount ) ) )
+        {
+            /* Start the next attempt when the previous one has failed or has
+             * not completed within the delay. */
+            while( ( startNext == 1U ) && ( nextCandidate < candidateCount ) )
+            {
+                tcpSocket = socket( pCandidates[ nextCandidate ]->ai_family,
+                                    pCandidates[ nextCandidate ]->ai_socktype,
+                                    pCandidates[ nextCandidate ]->ai_protocol );
+
+                if( ( tcpSocket != -1 ) &&
+                    ( Sockets_SetNonBlocking( tcpSocket, true ) == SOCKETS_SUCCESS ) )
+                {
+                    applySocketOptions( tcpSocket, pSocketOptions );
+                    returnStatus = bindSocket( tcpSocket,
+                                               ( int32_t ) pCandidates[ nextCandidate ]->ai_addr->sa_family,
+                                               pBinding );
+
+                    if( returnStatus == SOCKETS_SUCCESS )
+                    {
+                        returnStatus = connectToAddress( pCandidates[ nextCandidate ]->ai_addr,
+                                                         port,
+                                                         tcpSocket );
+                    }
+                    else
+                    {
+                        ( void ) close( tcpSocket );
+                    }
+                }
+                else if( tcpSocket != -1 )
+                {
+                    ( void ) close( tcpSocket );
+                    returnStatus = SOCKETS_CONNECT_FAILURE;
+                }
+                else
+                {
+                    returnStatus = SOCKETS_CONNECT_FAILURE;
+                }
+
+                nextCandidate++;
+
+                if( returnStatus == SOCKETS_SUCCESS )
+                {
+                    *pTcpSocket = tcpSocket;
+                    startNext = 0U;
+                }
+                else if( returnStatus == SOCKETS_WANT_WRITE )
+                {
+                    attempts[ attemptCount ].fd = tcpSocket;
+                    attempts[ attemptCount ].events = POLLOUT;
+                    attempts[ attemptCount ].revents = 0;
+                    attemptCount++;
+                    startNext = 0U;
+                }
+                else
+                {
+                    /* Failed immediately, so try the next record right away. */
+                }
+            }
+
+            if( ( *pTcpSocket == -1 ) && ( attemptCount > 0U ) )
+            {
+                /* Wait for an attempt to complete, or until the next one is
+                 * due. Without a record left, wait for the kernel to complete
+                 * or time out the remaining attempts. */
+                pollTimeoutMs = ( nextCandidate < candidateCount ) ?
+                                ( int32_t ) SOCKETS_CONNECTION_ATTEMPT_DELAY_MS : -1;
+                pollStatus = poll( attempts, ( nfds_t ) attemptCount, pollTimeoutMs );
+
+                if( pollStatus == 0 )
+                {
+                    startNext = 1U;
+                }
+                else if( ( pollStatus < 0 ) && ( errno != EINTR ) )
+                {
+                    LogError( ( "Polling the connecting sockets failed: %s.",
+                                strerror( errno ) ) );
+                    break;
+                }
+                else
+                {
+                    /* Check the attempts that completed. Iterate backwards so
+                     * that removing an entry does not skip another. */
+                    for( i = attemptCount; ( i > 0U ) && ( *pTcpSocket == -1 ); i-- )
+                    {
+                        if( attempts[ i - 1U ].revents != 0 )
+                        {
+                            socketError = 0;
+                            socketErrorLength = ( socklen_t ) sizeof( socketError );
+
+                            if( ( getsockopt( attempts[ i - 1U ].fd,
+                                              SOL_SOCKET,
+                                              SO_ERROR,
+                                              &socketError,
+                                              &socketErrorLength ) == 0 ) &&
+                                ( socketError == 0 ) )
+                            {
+                                *pTcpSocket = attempts[ i - 1U ].fd;
+                            }
+                            else
+                            {
+                                LogWarn( ( "Connection attempt failed: %s.",
+                                           strerror( socketError ) ) );
+                                ( void ) close( attempts[ i - 1U ].fd );
+                                attemptCount--;
+                                attempts[ i - 1U ] = attempts[ attemptCount ];
+                                startNext = 1U;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /* Close the attempts that lost the race. */
+        for( i = 0U; i < attemptCount; i++ )
+        {
+            if( attempts[ i ].fd != *pTcpSocket )
+            {
+                ( void ) close( attempts[ i ].fd );
+            }
+        }
+
+        if( *pTcpSocket != -1 )
+        {
+            returnStatus = Sockets_SetNonBlocking( *pTcpSocket, false );
+
+            if( returnStatus != SOCKETS_SUCCESS )
+            {
+                ( void ) close( *pTcpSocket );
+                *pTcpSocket = -1;
+                returnStatus = SOCKETS_CONNECT_FAILURE;
+            }
+        }
+        else
+        {
+            returnStatus = SOCKETS_CONNECT_FAILURE;
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( SOCKETS_CONNECTION_ATTEMPT_DELAY_MS > 0U ) */
+
+static SocketStatus_t startNextConnection( SocketConnectContext_t * pContext )
+{
+    SocketStatus_t returnStatus = SOCKETS_CONNECT_FAILURE;
+    const struct addrinfo * pIndex = NULL;
+
+    assert( pContext != NULL );
+
+    for( pIndex = pContext->pNextAddress; pIndex != NULL; pIndex = pIndex->ai_next )
+    {
+        pContext->tcpSocket = socket( pIndex->ai_family,
+                                      pIndex->ai_socktype,
+                                      pIndex->ai_protocol );
+
+        if( pContext->tcpSocket == -1 )
+        {
+            continue;
+        }
+
+        if( Sockets_SetNonBlocking( pContext->tcpSocket, true ) != SOCKETS_SUCCESS )
+        {
+            ( void ) close( pContext->tcpSocket );
+            continue;
+        }
+
+        applySocketOptions( pContext->tcpSocket, pContext->pSocketOptions );
+
+        if( bindSocket( pContext->tcpSocket, ( int32_t ) pIndex->ai_addr->sa_family, &pContext->binding ) != SOCKETS_SUCCESS )
+        {
+            ( void ) close( pContext->tcpSocket );
+            continue;
+        }
+
+        /* Start connecting to a resolved DNS address of the host. */
+        returnStatus = connectToAddress( pIndex->ai_addr,
+                                         pContext->port,
+                                         pContext->tcpSocket );
+
+        if( ( returnStatus == SOCKETS_WANT_WRITE ) || ( returnStatus == SOCKETS_SUCCESS ) )
+        {
+            break;
+        }
+    }
+
+    if( pIndex != NULL )
+    {
+        pContext->pNextAddress = pIndex->ai_next;
+    }
+    else
+    {
+        LogError( ( "Could not connect to any resolved IP address." ) );
+        pContext->pNextAddress = NULL;
+        pContext->tcpSocket = -1;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t finishConnectStep( SocketConnectContext_t * pContext,
+                                         SocketStatus_t connectStatus )
+{
+    SocketStatus_t returnStatus = connectStatus;
+
+    assert( pContext != NULL );
+
+    /* Restore the blocking behavior the transports expect from a socket
+     * returned by #Sockets_Connect. */
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = Sockets_SetNonBlocking( pContext->tcpSocket, false );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = setSocketTimeouts( pContext->tcpSocket,
+                                          pContext->sendTimeoutMs,
+                                          pContext->recvTimeoutMs );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        LogDebug( ( "Established TCP connection." ) );
+    }
+    else if( ( returnStatus != SOCKETS_WANT_WRITE ) && ( pContext->tcpSocket >= 0 ) )
+    {
+        ( void ) close( pContext->tcpSocket );
+        pContext->tcpSocket = -1;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    if( returnStatus != SOCKETS_WANT_WRITE )
+    {
+        TRACE_PROBE1( tcp_connect_done, returnStatus );
+    }
+
+    /* The DNS records are no longer needed once the connection is
+     * established or has failed. */
+    if( ( returnStatus != SOCKETS_WANT_WRITE ) && ( pContext->pListHead != NULL ) )
+    {
+        releaseAddressList( pContext->pListHead );
+        pContext->pListHead = NULL;
+        pContext->pNextAddress = NULL;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t setSocketTimeouts( int32_t tcpSocket,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct timeval transportTimeout;
+    int32_t setTimeoutStatus = -1;
+
+    /* Set the send timeout. */
+    transportTimeout.tv_sec = ( ( ( int64_t ) sendTimeoutMs ) / ONE_SEC_TO_MS );
+    transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) sendTimeoutMs ) % ONE_SEC_TO_MS ) );
+
+    setTimeoutStatus = setsockopt( tcpSocket,
+                                   SOL_SOCKET,
+                                   SO_SNDTIMEO,
+                                   &transportTimeout,
+                                   ( socklen_t ) sizeof( transportTimeout ) );
+
+    if( setTimeoutStatus < 0 )
+    {
+        LogError( ( "Setting socket send timeout failed." ) );
+        returnStatus = retrieveError( errno );
+    }
+
+    /* Set the receive timeout. */
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        transportTimeout.tv_sec = ( ( ( int64_t ) recvTimeoutMs ) / ONE_SEC_TO_MS );
+        transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) recvTimeoutMs ) % ONE_SEC_TO_MS ) );
+
+        setTimeoutStatus = setsockopt( tcpSocket,
+                                       SOL_SOCKET,
+                                       SO_RCVTIMEO,
+                                       &transportTimeout,
+                                       ( socklen_t ) sizeof( transportTimeout ) );
+
+        if( setTimeoutStatus < 0 )
+        {
+            LogError( ( "Setting socket receive timeout failed." ) );
+            returnStatus = retrieveError( errno );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t retrieveError( int32_t errorNumber )
+{
+    SocketStatus_t returnStatus = SOCKETS_API_ERROR;
+
+    LogError( ( "A transport error occured: %s.", strerror( errorNumber ) ) );
+
+    if( ( errorNumber == ENOMEM ) || ( errorNumber == ENOBUFS ) )
+    {
+        returnStatus = SOCKETS_INSUFFICIENT_MEMORY;
+    }
+    else if( ( errorNumber == ENOTSOCK ) || ( errorNumber == EDOM ) || ( errorNumber == EBADF ) )
+    {
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
+                                const ServerInfo_t * pServerInfo,
+                                uint32_t sendTimeoutMs,
+                                uint32_t recvTimeoutMs )
+{
+    return Sockets_ConnectWithStats( pTcpSocket,
+                                     pServerInfo,
+                                     sendTimeoutMs,
+                                     recvTimeoutMs,
+                                     NULL );
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_ConnectWithStats( int32_t * pTcpSocket,
+                                         const ServerInfo_t * pServerInfo,
+                                         uint32_t sendTimeoutMs,
+                                         uint32_t recvTimeoutMs,
+                                         TransportStats_t * pStats )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct addrinfo * pListHead = NULL;
+    SocketBinding_t binding;
+    uint64_t startTimeUs = 0U;
+
+    if( pServerInfo == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->pHostName == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo->pHostName is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pTcpSocket == NULL )
+    {
+        LogError( ( "Parameter check failed: pTcpSocket is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->hostNameLength == 0UL )
+    {
+        LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        /* Empty else. */
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        if( pStats != NULL )
+        {
+            startTimeUs = TransportStats_GetTimeUs();
+        }
+
+        returnStatus = resolveHostName( pServerInfo->pHostName,
+                                        pServerInfo->hostNameLength,
+                                        &pListHead );
+
+        if( pStats != NULL )
+        {
+            TransportStats_RecordLatency( pStats, TRANSPORT_STATS_DNS, startTimeUs );
+        }
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        if( pStats != NULL )
+        {
+            startTimeUs = TransportStats_GetTimeUs();
+        }
+
+        TRACE_PROBE1( tcp_connect_start, pServerInfo->port );
+
+        resolveBinding( pServerInfo, &binding );
+        returnStatus = attemptConnection( pListHead,
+                                          pServerInfo->pHostName,
+                                          pServerInfo->hostNameLength,
+                                          pServerInfo->port,
+                                          pServerInfo->pSocketOptions,
+                                          &binding,
+                                          pTcpSocket );
+
+        TRACE_PROBE1( tcp_connect_done, returnStatus );
+
+        if( pStats != NULL )
+        {
+            TransportStats_RecordLatency( pStats, TRANSPORT_STATS_TCP_CONNECT, startTimeUs );
+        }
+    }
+
+    /* Set the send and receive timeouts. */
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = setSocketTimeouts( *pTcpSocket,
+                                          sendTimeoutMs,
+                                          recvTimeoutMs );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_ConnectStart( SocketConnectContext_t * pContext,
+                                     const ServerInfo_t * pServerInfo,
+                                     uint32_t sendTimeoutMs,
+                                     uint32_t recvTimeoutMs )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    if( pContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->pHostName == NULL )
+    {
+        LogError( ( "Parameter check failed: pServerInfo->pHostName is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else if( pServerInfo->hostNameLength == 0UL )
+    {
+        LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        ( void ) memset( pContext, 0, sizeof( SocketConnectContext_t ) );
+        pContext->tcpSocket = -1;
+        pContext->port = pServerInfo->port;
+        pContext->pSocketOptions = pServerInfo->pSocketOptions;
+        resolveBinding( pServerInfo, &pContext->binding );
+        pContext->sendTimeoutMs = sendTimeoutMs;
+        pContext->recvTimeoutMs = recvTimeoutMs;
+
+        returnStatus = resolveHostName( pServerInfo->pHostName,
+                                        pServerInfo->hostNameLength,
+                                        &pContext->pListHead );
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        LogDebug( ( "Starting connection to: Host=%.*s.",
+                    ( int32_t ) pServerInfo->hostNameLength,
+                    pServerInfo->pHostName ) );
+
+        TRACE_PROBE1( tcp_connect_start, pContext->port );
+
+        pContext->pNextAddress = pContext->pListHead;
+        returnStatus = finishConnectStep( pContext,
+                                          startNextConnection( pContext ) );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_ConnectPoll( SocketConnectContext_t * pContext )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct pollfd pollFd;
+    int32_t pollStatus = 0, getOptStatus = 0;
+    int32_t socketError = 0;
+    socklen_t socketErrorLength = ( socklen_t ) sizeof( socketError );
+
+    if( ( pContext == NULL ) || ( pContext->tcpSocket < 0 ) )
+    {
+        LogError( ( "Parameter check failed: No connection is in progress." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
     }
     else
     {
-        LogError( ( "Could not connect to any resolved IP address from %.*s.",
-                    ( int32_t ) hostNameLength,
-                    pHostName ) );
+        /* Check without waiting whether the connection attempt completed. */
+        pollFd.fd = pContext->tcpSocket;
+        pollFd.events = POLLOUT;
+        pollFd.revents = 0;
+
+        pollStatus = poll( &pollFd, 1U, 0 );
+
+        if( pollStatus == 0 )
+        {
+            returnStatus = SOCKETS_WANT_WRITE;
+        }
+        else if( pollStatus < 0 )
+        {
+            LogError( ( "Polling the connecting socket failed." ) );
+            returnStatus = retrieveError( errno );
+        }
+        else
+        {
+            /* The attempt completed. Its outcome is reported in SO_ERROR. */
+            getOptStatus = getsockopt( pContext->tcpSocket,
+                                       SOL_SOCKET,
+                                       SO_ERROR,
+                                       &socketError,
+                                       &socketErrorLength );
+
+            if( ( getOptStatus == 0 ) && ( socketError == 0 ) )
+            {
+                returnStatus = SOCKETS_SUCCESS;
+            }
+            else
+            {
+                LogWarn( ( "Failed to connect to server using a resolved IP address: %s.",
+                           strerror( socketError ) ) );
+                ( void ) close( pContext->tcpSocket );
+                returnStatus = startNextConnection( pContext );
+            }
+        }
+
+        returnStatus = finishConnectStep( pContext, returnStatus );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_ConnectAbort( SocketConnectContext_t * pContext )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    if( pContext == NULL )
+    {
+        LogError( ( "Parameter check failed: pContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
     }
+    else
+    {
+        if( pContext->tcpSocket >= 0 )
+        {
+            ( void ) close( pContext->tcpSocket );
+            pContext->tcpSocket = -1;
+        }
 
-    freeaddrinfo( pListHead );
+        if( pContext->pListHead != NULL )
+        {
+            releaseAddressList( pContext->pListHead );
+            pContext->pListHead = NULL;
+            pContext->pNextAddress = NULL;
+        }
+    }
 
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-static SocketStatus_t retrieveError( int32_t errorNumber )
+SocketStatus_t Sockets_SetNonBlocking( int32_t tcpSocket,
+                                       bool nonBlocking )
 {
-    SocketStatus_t returnStatus = SOCKETS_API_ERROR;
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    int32_t fileStatusFlags = 0;
 
-    LogError( ( "A transport error occured: %s.", strerror( errorNumber ) ) );
+    fileStatusFlags = fcntl( tcpSocket, F_GETFL );
 
-    if( ( errorNumber == ENOMEM ) || ( errorNumber == ENOBUFS ) )
+    if( fileStatusFlags == -1 )
     {
-        returnStatus = SOCKETS_INSUFFICIENT_MEMORY;
+        LogError( ( "Reading the socket file status flags failed." ) );
+        returnStatus = retrieveError( errno );
     }
-    else if( ( errorNumber == ENOTSOCK ) || ( errorNumber == EDOM ) || ( errorNumber == EBADF ) )
+    else
+    {
+        if( nonBlocking == true )
+        {
+            fileStatusFlags = ( int32_t ) ( ( uint32_t ) fileStatusFlags | ( uint32_t ) O_NONBLOCK );
+        }
+        else
+        {
+            fileStatusFlags = ( int32_t ) ( ( uint32_t ) fileStatusFlags & ~( ( uint32_t ) O_NONBLOCK ) );
+        }
+
+        if( fcntl( tcpSocket, F_SETFL, fileStatusFlags ) == -1 )
+        {
+            LogError( ( "Setting the socket file status flags failed." ) );
+            returnStatus = retrieveError( errno );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_GetRttInfo( int32_t tcpSocket,
+                                   SocketRttInfo_t * pRttInfo )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    struct tcp_info tcpInfo;
+    socklen_t tcpInfoLength = ( socklen_t ) sizeof( tcpInfo );
+
+    if( ( tcpSocket < 0 ) || ( pRttInfo == NULL ) )
     {
+        LogError( ( "Parameter check failed: tcpSocket was negative or pRttInfo was NULL." ) );
         returnStatus = SOCKETS_INVALID_PARAMETER;
     }
     else
     {
-        /* Empty else. */
+        ( void ) memset( &tcpInfo, 0, sizeof( tcpInfo ) );
+
+        if( getsockopt( tcpSocket, IPPROTO_TCP, TCP_INFO, &tcpInfo, &tcpInfoLength ) < 0 )
+        {
+            LogError( ( "Reading the TCP information of the socket failed." ) );
+            returnStatus = retrieveError( errno );
+        }
+        else
+        {
+            /* Older kernels fill a shorter structure, leaving the members
+             * they do not know zeroed. */
+            pRttInfo->srttUs = tcpInfo.tcpi_rtt;
+            pRttInfo->rttVarUs = tcpInfo.tcpi_rttvar;
+            pRttInfo->rtoUs = tcpInfo.tcpi_rto;
+            pRttInfo->totalRetransmits = tcpInfo.tcpi_total_retrans;
+        }
     }
 
     return returnStatus;
 }
 /*-----------------------------------------------------------*/
 
-SocketStatus_t Sockets_Connect( int32_t * pTcpSocket,
-                                const ServerInfo_t * pServerInfo,
-                                uint32_t sendTimeoutMs,
-                                uint32_t recvTimeoutMs )
+SocketStatus_t Sockets_SetTimeouts( int32_t tcpSocket,
+                                    uint32_t sendTimeoutMs,
+                                    uint32_t recvTimeoutMs )
 {
     SocketStatus_t returnStatus = SOCKETS_SUCCESS;
-    struct addrinfo * pListHead = NULL;
-    struct timeval transportTimeout;
-    int32_t setTimeoutStatus = -1;
 
-    if( pServerInfo == NULL )
+    if( tcpSocket < 0 )
     {
-        LogError( ( "Parameter check failed: pServerInfo is NULL." ) );
+        LogError( ( "Parameter check failed: tcpSocket was negative." ) );
         returnStatus = SOCKETS_INVALID_PARAMETER;
     }
-    else if( pServerInfo->pHostName == NULL )
+    else
     {
-        LogError( ( "Parameter check failed: pServerInfo->pHostName is NULL." ) );
-        returnStatus = SOCKETS_INVALID_PARAMETER;
+        returnStatus = setSocketTimeouts( tcpSocket, sendTimeoutMs, recvTimeoutMs );
     }
-    else if( pTcpSocket == NULL )
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+void Sockets_SetBindingPolicy( SocketsBindingPolicy_t policy,
+                               void * pPolicyContext )
+{
+    ( void ) pthread_mutex_lock( &bindingPolicyMutex );
+    bindingPolicy = policy;
+    pBindingPolicyContext = pPolicyContext;
+    ( void ) pthread_mutex_unlock( &bindingPolicyMutex );
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Sockets_Disconnect( int32_t tcpSocket )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+    if( tcpSocket > 0 )
     {
-        LogError( ( "Parameter check failed: pTcpSocket is NULL." ) );
-        returnStatus = SOCKETS_INVALID_PARAMETER;
+        ( void ) shutdown( tcpSocket, SHUT_RDWR );
+        ( void ) close( tcpSocket );
     }
-    else if( pServerInfo->hostNameLength == 0UL )
+    else
     {
-        LogError( ( "Parameter check failed: hostNameLength must be greater than 0." ) );
+        LogError( ( "Parameter check failed: tcpSocket was negative." ) );
         returnStatus = SOCKETS_INVALID_PARAMETER;
     }
-    else
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t TransportStats_GetTimeUs( void )
+{
+    struct timespec now = { 0 };
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * ONE_SEC_TO_MS * ONE_MS_TO_US ) +
+           ( ( uint64_t ) now.tv_nsec / ONE_MS_TO_US );
+}
+/*-----------------------------------------------------------*/
+
+void TransportStats_RecordLatency( TransportStats_t * pStats,
+                                   TransportStatsPhase_t phase,
+                                   uint64_t startTimeUs )
+{
+    TransportLatencyHistogram_t * pHistogram = NULL;
+    uint64_t latencyUs = 0U, now = 0U;
+    size_t bucket = 0U;
+
+    if( ( pStats != NULL ) && ( phase < TRANSPORT_STATS_PHASE_COUNT ) )
     {
-        /* Empty else. */
+        pHistogram = &pStats->latency[ phase ];
+        now = TransportStats_GetTimeUs();
+        latencyUs = ( now > startTimeUs ) ? ( now - startTimeUs ) : 0U;
+
+        /* The bucket is the index of the highest bit set in the latency. */
+        while( ( ( latencyUs >> ( bucket + 1U ) ) != 0U ) &&
+               ( bucket < ( TRANSPORT_STATS_HISTOGRAM_BUCKETS - 1U ) ) )
+        {
+            bucket++;
+        }
+
+        pHistogram->buckets[ bucket ]++;
+        pHistogram->count++;
+        pHistogram->totalUs += latencyUs;
+
+        if( latencyUs > pHistogram->maxUs )
+        {
+            pHistogram->maxUs = latencyUs;
+        }
     }
+}
+/*-----------------------------------------------------------*/
 
-    if( returnStatus == SOCKETS_SUCCESS )
+void TransportStats_RecordSend( TransportStats_t * pStats,
+                                size_t bytesToSend,
+                                int32_t bytesSent,
+                                uint64_t startTimeUs )
+{
+    if( pStats != NULL )
     {
-        returnStatus = resolveHostName( pServerInfo->pHostName,
-                                        pServerInfo->hostNameLength,
-                                        &pListHead );
+        pStats->sendCalls++;
+
+        if( bytesSent > 0 )
+        {
+            pStats->bytesSent += ( uint64_t ) bytesSent;
+
+            if( ( size_t ) bytesSent < bytesToSend )
+            {
+                pStats->partialSends++;
+            }
+        }
+        else if( bytesSent == 0 )
+        {
+            pStats->sendTimeouts++;
+        }
+        else
+        {
+            pStats->sendErrors++;
+        }
+
+        TransportStats_RecordLatency( pStats, TRANSPORT_STATS_SEND, startTimeUs );
     }
+}
+/*-----------------------------------------------------------*/
 
-    if( returnStatus == SOCKETS_SUCCESS )
+void TransportStats_RecordRecv( TransportStats_t * pStats,
+                                int32_t bytesReceived,
+                                uint64_t startTimeUs )
+{
+    if( pStats != NULL )
     {
-        returnStatus = attemptConnection( pListHead,
-                                          pServerInfo->pHostName,
-                                          pServerInfo->hostNameLength,
-                                          pServerInfo->port,
-                                          pTcpSocket );
+        pStats->recvCalls++;
+
+        if( bytesReceived > 0 )
+        {
+            pStats->bytesReceived += ( uint64_t ) bytesReceived;
+        }
+        else if( bytesReceived == 0 )
+        {
+            pStats->recvTimeouts++;
+        }
+        else
+        {
+            pStats->recvErrors++;
+        }
+
+        TransportStats_RecordLatency( pStats, TRANSPORT_STATS_RECV, startTimeUs );
     }
+}
+/*-----------------------------------------------------------*/
 
-    /* Set the send timeout. */
-    if( returnStatus == SOCKETS_SUCCESS )
+static void refillThrottle( void )
+{
+    uint64_t now = TransportStats_GetTimeUs();
+    uint64_t elapsedUs = ( now > throttle.lastRefillUs ) ? ( now - throttle.lastRefillUs ) : 0U;
+    int64_t burst = ( int64_t ) throttle.config.burstBytes * THROTTLE_TOKENS_PER_BYTE;
+
+    if( elapsedUs > THROTTLE_MAX_REFILL_US )
     {
-        transportTimeout.tv_sec = ( ( ( int64_t ) sendTimeoutMs ) / ONE_SEC_TO_MS );
-        transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) sendTimeoutMs ) % ONE_SEC_TO_MS ) );
+        elapsedUs = THROTTLE_MAX_REFILL_US;
+    }
 
-        setTimeoutStatus = setsockopt( *pTcpSocket,
-                                       SOL_SOCKET,
-                                       SO_SNDTIMEO,
-                                       &transportTimeout,
-                                       ( socklen_t ) sizeof( transportTimeout ) );
+    throttle.tokens += ( int64_t ) ( elapsedUs * throttle.rate );
+    throttle.lastRefillUs = now;
 
-        if( setTimeoutStatus < 0 )
+    if( throttle.tokens > burst )
+    {
+        throttle.tokens = burst;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void TransportThrottle_Configure( const TransportThrottleConfig_t * pConfig )
+{
+    ( void ) pthread_mutex_lock( &throttleMutex );
+
+    if( ( pConfig == NULL ) || ( pConfig->rateBytesPerSec == 0U ) )
+    {
+        ( void ) memset( &throttle, 0, sizeof( throttle ) );
+    }
+    else
+    {
+        throttle.config = *pConfig;
+
+        if( throttle.config.burstBytes == 0U )
         {
-            LogError( ( "Setting socket send timeout failed." ) );
-            returnStatus = retrieveError( errno );
+            throttle.config.burstBytes = 1U;
+        }
+
+        if( throttle.config.minRateBytesPerSec == 0U )
+        {
+            throttle.config.minRateBytesPerSec = 1U;
+        }
+        else if( throttle.config.minRateBytesPerSec > throttle.config.rateBytesPerSec )
+        {
+            throttle.config.minRateBytesPerSec = throttle.config.rateBytesPerSec;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
         }
+
+        throttle.rate = throttle.config.rateBytesPerSec;
+        throttle.tokens = ( int64_t ) throttle.config.burstBytes * THROTTLE_TOKENS_PER_BYTE;
+        throttle.lastRefillUs = TransportStats_GetTimeUs();
     }
 
-    /* Set the receive timeout. */
-    if( returnStatus == SOCKETS_SUCCESS )
+    ( void ) pthread_mutex_unlock( &throttleMutex );
+}
+/*-----------------------------------------------------------*/
+
+size_t TransportThrottle_Wait( TransportTrafficClass_t trafficClass,
+                               size_t bytes )
+{
+    size_t bytesAllowed = bytes;
+    int64_t tokensNeeded = 0;
+    uint64_t sleepUs = 0U;
+    uint8_t waiting = ( trafficClass == TRANSPORT_TRAFFIC_BACKGROUND ) ? 1U : 0U;
+    struct timespec delay = { 0 };
+
+    while( waiting == 1U )
     {
-        transportTimeout.tv_sec = ( ( ( int64_t ) recvTimeoutMs ) / ONE_SEC_TO_MS );
-        transportTimeout.tv_usec = ( ONE_MS_TO_US * ( ( ( int64_t ) recvTimeoutMs ) % ONE_SEC_TO_MS ) );
+        ( void ) pthread_mutex_lock( &throttleMutex );
 
-        setTimeoutStatus = setsockopt( *pTcpSocket,
-                                       SOL_SOCKET,
-                                       SO_RCVTIMEO,
-                                       &transportTimeout,
-                                       ( socklen_t ) sizeof( transportTimeout ) );
+        if( throttle.rate == 0U )
+        {
+            waiting = 0U;
+        }
+        else
+        {
+            refillThrottle();
 
-        if( setTimeoutStatus < 0 )
+            /* Waiting for a whole burst when fewer bytes are asked for keeps
+             * the transfers from shrinking to the few bytes accrued since the
+             * last one. The bucket never holds more than a burst. */
+            tokensNeeded = ( int64_t ) throttle.config.burstBytes;
+
+            if( ( uint64_t ) bytes < ( uint64_t ) throttle.config.burstBytes )
+            {
+                tokensNeeded = ( int64_t ) bytes;
+            }
+
+            tokensNeeded *= THROTTLE_TOKENS_PER_BYTE;
+
+            if( throttle.tokens >= tokensNeeded )
+            {
+                if( ( uint64_t ) bytesAllowed > ( uint64_t ) ( throttle.tokens / THROTTLE_TOKENS_PER_BYTE ) )
+                {
+                    bytesAllowed = ( size_t ) ( throttle.tokens / THROTTLE_TOKENS_PER_BYTE );
+                }
+
+                waiting = 0U;
+            }
+            else
+            {
+                /* The bucket gains rate tokens every microsecond. */
+                sleepUs = ( ( uint64_t ) ( tokensNeeded - throttle.tokens ) +
+                            throttle.rate - 1U ) / throttle.rate;
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &throttleMutex );
+
+        if( waiting == 1U )
         {
-            LogError( ( "Setting socket receive timeout failed." ) );
-            returnStatus = retrieveError( errno );
+            if( sleepUs > ( ( uint64_t ) TRANSPORT_THROTTLE_MAX_SLEEP_MS * ONE_MS_TO_US ) )
+            {
+                sleepUs = ( uint64_t ) TRANSPORT_THROTTLE_MAX_SLEEP_MS * ONE_MS_TO_US;
+            }
+
+            delay.tv_sec = ( time_t ) ( sleepUs / ( ( uint64_t ) ONE_SEC_TO_MS * ONE_MS_TO_US ) );
+            delay.tv_nsec = ( long ) ( ( sleepUs % ( ( uint64_t ) ONE_SEC_TO_MS * ONE_MS_TO_US ) ) * ONE_MS_TO_US );
+            ( void ) nanosleep( &delay, NULL );
         }
     }
 
-    return returnStatus;
+    return bytesAllowed;
 }
 /*-----------------------------------------------------------*/
 
-SocketStatus_t Sockets_Disconnect( int32_t tcpSocket )
+void TransportThrottle_Consume( size_t bytes )
 {
-    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    int64_t minTokens = 0;
 
-    if( tcpSocket > 0 )
+    ( void ) pthread_mutex_lock( &throttleMutex );
+
+    if( throttle.rate != 0U )
     {
-        ( void ) shutdown( tcpSocket, SHUT_RDWR );
-        ( void ) close( tcpSocket );
+        refillThrottle();
+
+        /* Interactive traffic may overdraw the bucket by one burst, which
+         * background traffic then pays back before it transfers again. */
+        minTokens = -( ( int64_t ) throttle.config.burstBytes * THROTTLE_TOKENS_PER_BYTE );
+        throttle.tokens -= ( int64_t ) bytes * THROTTLE_TOKENS_PER_BYTE;
+
+        if( throttle.tokens < minTokens )
+        {
+            throttle.tokens = minTokens;
+        }
     }
-    else
+
+    ( void ) pthread_mutex_unlock( &throttleMutex );
+}
+/*-----------------------------------------------------------*/
+
+void TransportThrottle_ReportRtt( uint32_t rttMs )
+{
+    uint32_t step = 0U;
+
+    ( void ) pthread_mutex_lock( &throttleMutex );
+
+    if( ( throttle.rate != 0U ) && ( throttle.config.rttTargetMs != 0U ) )
     {
-        LogError( ( "Parameter check failed: tcpSocket was negative." ) );
-        returnStatus = SOCKETS_INVALID_PARAMETER;
+        if( rttMs > throttle.config.rttTargetMs )
+        {
+            throttle.rate /= 2U;
+
+            if( throttle.rate < throttle.config.minRateBytesPerSec )
+            {
+                throttle.rate = throttle.config.minRateBytesPerSec;
+            }
+        }
+        else
+        {
+            step = throttle.config.rateBytesPerSec / 16U;
+
+            if( step == 0U )
+            {
+                step = 1U;
+            }
+
+            if( ( throttle.config.rateBytesPerSec - throttle.rate ) > step )
+            {
+                throttle.rate += step;
+            }
+            else
+            {
+                throttle.rate = throttle.config.rateBytesPerSec;
+            }
+        }
     }
 
-    return returnStatus;
+    ( void ) pthread_mutex_unlock( &throttleMutex );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t TransportThrottle_GetRate( void )
+{
+    uint32_t rate = 0U;
+
+    ( void ) pthread_mutex_lock( &throttleMutex );
+    rate = throttle.rate;
+    ( void ) pthread_mutex_unlock( &throttleMutex );
+
+    return rate;
 }
 /*-----------------------------------------------------------*/
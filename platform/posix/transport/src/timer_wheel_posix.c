@@ -0,0 +1,374 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+#include "timer_wheel_posix.h"
+
+#if ( TIMER_WHEEL_LEVELS < 1U ) || ( TIMER_WHEEL_LEVELS > 5U )
+    #error "TIMER_WHEEL_LEVELS must be between 1 and 5."
+#endif
+
+/**
+ * @brief Number of ticks spanned by all the levels of the wheel.
+ */
+#define TIMER_WHEEL_SPAN_TICKS    ( ( uint64_t ) 1U << ( TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS ) )
+
+/**
+ * @brief Value of #TimerWheelTimer_t.slot for a timer that is due and waits
+ * for its callback to be called.
+ */
+#define TIMER_WHEEL_EXPIRED_SLOT    ( TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Add a timer to the head of a list.
+ *
+ * @param[in] ppHead Head of the list.
+ * @param[in] pTimer Timer to add, which is in no list.
+ */
+static void linkTimer( TimerWheelTimer_t ** ppHead,
+                       TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Remove a timer from the list it is in, and clear the bit of its
+ * slot if the slot becomes empty.
+ *
+ * @param[in] pWheel The timer wheel.
+ * @param[in] pTimer Timer to remove.
+ */
+static void unlinkTimer( TimerWheel_t * pWheel,
+                         TimerWheelTimer_t * pTimer );
+
+/**
+ * @brief Add a timer to the slot for its expiry, relative to the current
+ * tick of the wheel.
+ *
+ * The level is the lowest one spanning the time until the expiry, and the
+ * slot of that level is given by the bits of the expiry tick, so the wheel
+ * reaches the slot at the latest when the timer is due.
+ *
+ * @param[in] pWheel The timer wheel.
+ * @param[in] pTimer Timer to add, which is in no list.
+ * @param[in] ppExpired List receiving the timer if it is due now.
+ */
+static void placeTimer( TimerWheel_t * pWheel,
+                        TimerWheelTimer_t * pTimer,
+                        TimerWheelTimer_t ** ppExpired );
+
+/**
+ * @brief Process the current tick of the wheel: move the timers of the slots
+ * of the higher levels reached down, and collect the timers due.
+ *
+ * @param[in] pWheel The timer wheel.
+ * @param[in] ppExpired List receiving the timers due.
+ */
+static void processTick( TimerWheel_t * pWheel,
+                         TimerWheelTimer_t ** ppExpired );
+
+/*-----------------------------------------------------------*/
+
+static void linkTimer( TimerWheelTimer_t ** ppHead,
+                       TimerWheelTimer_t * pTimer )
+{
+    assert( ppHead != NULL );
+    assert( pTimer != NULL );
+    assert( pTimer->ppPreviousNext == NULL );
+
+    pTimer->pNext = *ppHead;
+
+    if( *ppHead != NULL )
+    {
+        ( *ppHead )->ppPreviousNext = &pTimer->pNext;
+    }
+
+    *ppHead = pTimer;
+    pTimer->ppPreviousNext = ppHead;
+}
+/*-----------------------------------------------------------*/
+
+static void unlinkTimer( TimerWheel_t * pWheel,
+                         TimerWheelTimer_t * pTimer )
+{
+    uint32_t level = 0U, index = 0U;
+
+    assert( pWheel != NULL );
+    assert( pTimer != NULL );
+    assert( pTimer->ppPreviousNext != NULL );
+
+    *pTimer->ppPreviousNext = pTimer->pNext;
+
+    if( pTimer->pNext != NULL )
+    {
+        pTimer->pNext->ppPreviousNext = pTimer->ppPreviousNext;
+    }
+
+    if( pTimer->slot < TIMER_WHEEL_EXPIRED_SLOT )
+    {
+        level = pTimer->slot / TIMER_WHEEL_SLOTS;
+        index = pTimer->slot % TIMER_WHEEL_SLOTS;
+
+        if( pWheel->pSlots[ level ][ index ] == NULL )
+        {
+            pWheel->occupiedSlots[ level ] &= ~( ( uint64_t ) 1U << index );
+        }
+    }
+
+    pTimer->pNext = NULL;
+    pTimer->ppPreviousNext = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void placeTimer( TimerWheel_t * pWheel,
+                        TimerWheelTimer_t * pTimer,
+                        TimerWheelTimer_t ** ppExpired )
+{
+    uint32_t distance = 0U, slotTick = 0U, level = 0U, index = 0U;
+
+    assert( pWheel != NULL );
+    assert( pTimer != NULL );
+    assert( ppExpired != NULL );
+
+    distance = pTimer->expiryTick - pWheel->currentTick;
+    slotTick = pTimer->expiryTick;
+
+    if( distance == 0U )
+    {
+        pTimer->slot = TIMER_WHEEL_EXPIRED_SLOT;
+        linkTimer( ppExpired, pTimer );
+    }
+    else
+    {
+        if( ( uint64_t ) distance >= TIMER_WHEEL_SPAN_TICKS )
+        {
+            /* Wait in the slot of the top level the furthest away, and be
+             * placed again from there. */
+            slotTick = pWheel->currentTick + ( uint32_t ) ( TIMER_WHEEL_SPAN_TICKS - 1U );
+            level = TIMER_WHEEL_LEVELS - 1U;
+        }
+        else
+        {
+            while( ( ( uint64_t ) distance >> ( TIMER_WHEEL_SLOT_BITS * ( level + 1U ) ) ) != 0U )
+            {
+                level++;
+            }
+        }
+
+        index = ( slotTick >> ( TIMER_WHEEL_SLOT_BITS * level ) ) % TIMER_WHEEL_SLOTS;
+        pTimer->slot = ( level * TIMER_WHEEL_SLOTS ) + index;
+        linkTimer( &pWheel->pSlots[ level ][ index ], pTimer );
+        pWheel->occupiedSlots[ level ] |= ( uint64_t ) 1U << index;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void processTick( TimerWheel_t * pWheel,
+                         TimerWheelTimer_t ** ppExpired )
+{
+    TimerWheelTimer_t * pTimer = NULL, * pCascaded = NULL;
+    uint32_t level = TIMER_WHEEL_LEVELS, index = 0U;
+
+    assert( pWheel != NULL );
+    assert( ppExpired != NULL );
+
+    /* From the top, move down the timers of the slots that the lower levels
+     * wrapping around have reached. A timer moved down never lands in a slot
+     * processed afterwards for this tick, except when it is due now. */
+    while( level > 1U )
+    {
+        level--;
+
+        if( ( pWheel->currentTick & ( ( 1U << ( TIMER_WHEEL_SLOT_BITS * level ) ) - 1U ) ) == 0U )
+        {
+            index = ( pWheel->currentTick >> ( TIMER_WHEEL_SLOT_BITS * level ) ) % TIMER_WHEEL_SLOTS;
+
+            /* Take the whole list first, so that placing a timer does not
+             * change the list being visited. */
+            pCascaded = pWheel->pSlots[ level ][ index ];
+            pWheel->pSlots[ level ][ index ] = NULL;
+            pWheel->occupiedSlots[ level ] &= ~( ( uint64_t ) 1U << index );
+
+            if( pCascaded != NULL )
+            {
+                pCascaded->ppPreviousNext = &pCascaded;
+            }
+
+            while( pCascaded != NULL )
+            {
+                pTimer = pCascaded;
+                pTimer->slot = TIMER_WHEEL_EXPIRED_SLOT;
+                unlinkTimer( pWheel, pTimer );
+                placeTimer( pWheel, pTimer, ppExpired );
+            }
+        }
+    }
+
+    /* Every timer of the slot of the current tick at level 0 is due. */
+    index = pWheel->currentTick % TIMER_WHEEL_SLOTS;
+
+    while( pWheel->pSlots[ 0 ][ index ] != NULL )
+    {
+        pTimer = pWheel->pSlots[ 0 ][ index ];
+        assert( pTimer->expiryTick == pWheel->currentTick );
+        unlinkTimer( pWheel, pTimer );
+        pTimer->slot = TIMER_WHEEL_EXPIRED_SLOT;
+        linkTimer( ppExpired, pTimer );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void TimerWheel_Init( TimerWheel_t * pWheel,
+                      uint32_t currentTick )
+{
+    assert( pWheel != NULL );
+
+    ( void ) memset( pWheel, 0, sizeof( TimerWheel_t ) );
+    pWheel->currentTick = currentTick;
+}
+/*-----------------------------------------------------------*/
+
+void TimerWheel_Start( TimerWheel_t * pWheel,
+                       TimerWheelTimer_t * pTimer,
+                       uint32_t ticks )
+{
+    TimerWheelTimer_t * pNotExpired = NULL;
+
+    assert( pWheel != NULL );
+    assert( pTimer != NULL );
+    assert( pTimer->callback != NULL );
+
+    TimerWheel_Cancel( pWheel, pTimer );
+
+    pTimer->expiryTick = pWheel->currentTick + ( ( ticks == 0U ) ? 1U : ticks );
+
+    /* The expiry is after the current tick, so the timer is not due now. */
+    placeTimer( pWheel, pTimer, &pNotExpired );
+    assert( pNotExpired == NULL );
+    pWheel->timerCount++;
+}
+/*-----------------------------------------------------------*/
+
+void TimerWheel_Cancel( TimerWheel_t * pWheel,
+                        TimerWheelTimer_t * pTimer )
+{
+    assert( pWheel != NULL );
+    assert( pTimer != NULL );
+
+    if( pTimer->ppPreviousNext != NULL )
+    {
+        unlinkTimer( pWheel, pTimer );
+        pWheel->timerCount--;
+    }
+}
+/*-----------------------------------------------------------*/
+
+bool TimerWheel_IsRunning( const TimerWheelTimer_t * pTimer )
+{
+    assert( pTimer != NULL );
+
+    return ( pTimer->ppPreviousNext != NULL ) ? true : false;
+}
+/*-----------------------------------------------------------*/
+
+size_t TimerWheel_Advance( TimerWheel_t * pWheel,
+                           uint32_t newTick )
+{
+    TimerWheelTimer_t * pExpired = NULL, * pTimer = NULL;
+    uint32_t remainingTicks = 0U, step = 0U;
+    size_t dispatchedCount = 0U;
+
+    assert( pWheel != NULL );
+
+    remainingTicks = newTick - pWheel->currentTick;
+
+    /* Jump from one tick with work to do to the next, so the cost does not
+     * grow with the number of ticks elapsed. */
+    while( remainingTicks > 0U )
+    {
+        step = TimerWheel_GetNextTimeout( pWheel );
+
+        if( step > remainingTicks )
+        {
+            pWheel->currentTick += remainingTicks;
+            remainingTicks = 0U;
+        }
+        else
+        {
+            pWheel->currentTick += step;
+            remainingTicks -= step;
+            processTick( pWheel, &pExpired );
+        }
+    }
+
+    /* A callback may cancel another timer that is due, which removes it from
+     * this list. */
+    while( pExpired != NULL )
+    {
+        pTimer = pExpired;
+        unlinkTimer( pWheel, pTimer );
+        pWheel->timerCount--;
+        pTimer->callback( pTimer );
+        dispatchedCount++;
+    }
+
+    return dispatchedCount;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t TimerWheel_GetNextTimeout( const TimerWheel_t * pWheel )
+{
+    uint64_t nextTimeout = TIMER_WHEEL_NO_TIMEOUT, timeout = 0U, levelTicks = 0U, occupied = 0U;
+    uint32_t level = 0U, digit = 0U, shift = 0U;
+
+    assert( pWheel != NULL );
+
+    for( level = 0U; level < TIMER_WHEEL_LEVELS; level++ )
+    {
+        if( pWheel->occupiedSlots[ level ] != 0U )
+        {
+            levelTicks = ( uint64_t ) 1U << ( TIMER_WHEEL_SLOT_BITS * level );
+            digit = ( pWheel->currentTick >> ( TIMER_WHEEL_SLOT_BITS * level ) ) % TIMER_WHEEL_SLOTS;
+
+            /* Rotate the map so that bit 0 is the next slot the wheel reaches
+             * at this level. */
+            shift = ( digit + 1U ) % TIMER_WHEEL_SLOTS;
+            occupied = pWheel->occupiedSlots[ level ];
+            occupied = ( occupied >> shift ) | ( occupied << ( ( TIMER_WHEEL_SLOTS - shift ) % TIMER_WHEEL_SLOTS ) );
+
+            /* Ticks until the lower levels wrap around, plus a turn of the
+             * lower levels for each empty slot before the first timer. */
+            timeout = ( levelTicks - ( ( uint64_t ) pWheel->currentTick & ( levelTicks - 1U ) ) ) +
+                      ( ( uint64_t ) __builtin_ctzll( occupied ) * levelTicks );
+
+            if( timeout < nextTimeout )
+            {
+                nextTimeout = timeout;
+            }
+        }
+    }
+
+    return ( uint32_t ) nextTimeout;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,883 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standard includes. */
+#include <assert.h>
+#include <string.h>
+
+/* POSIX includes. */
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "uring_posix.h"
+#include "uring_syscalls_posix.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Count a system call made on the io_uring instance of a connection in
+ * its statistics.
+ */
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+    #define COUNT_IO_CALL( pUringParams )    ( ( pUringParams )->stats.ioCalls++ )
+#else
+    #define COUNT_IO_CALL( pUringParams )    ( ( void ) ( pUringParams ) )
+#endif
+
+/**
+ * @brief User data of the completion of a send or receive.
+ */
+#define URING_TRANSFER_USER_DATA    ( 1U )
+
+/**
+ * @brief User data of the completion of the timeout linked to a send or
+ * receive.
+ */
+#define URING_TIMEOUT_USER_DATA     ( 2U )
+
+/**
+ * @brief Index registered buffers are given when they are not configured.
+ */
+#define URING_NO_BUFFER_INDEX       ( UINT16_MAX )
+
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    UringParams_t * pParams;
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Log possible error from a send or receive.
+ *
+ * @param[in] errorNumber Error number to be logged.
+ */
+static void logTransportError( int32_t errorNumber );
+
+/**
+ * @brief Create the io_uring instance of a connection and map its rings.
+ *
+ * @param[in] pUringParams Parameters of the connection.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_API_ERROR otherwise.
+ */
+static SocketStatus_t setupRing( UringParams_t * pUringParams );
+
+/**
+ * @brief Register the read-ahead and send buffers of a connection, if any,
+ * with its io_uring instance.
+ *
+ * @param[in] pUringParams Parameters of the connection.
+ *
+ * @return #SOCKETS_SUCCESS if successful; #SOCKETS_API_ERROR otherwise.
+ */
+static SocketStatus_t registerBuffers( UringParams_t * pUringParams );
+
+/**
+ * @brief Unmap the rings of a connection and close its io_uring instance.
+ *
+ * @param[in] pRing The io_uring instance to tear down.
+ */
+static void teardownRing( UringRing_t * pRing );
+
+/**
+ * @brief Get a cleared submission queue entry to queue an operation in.
+ *
+ * @param[in] pRing The io_uring instance.
+ *
+ * @return The submission queue entry.
+ */
+static struct io_uring_sqe * getSubmissionEntry( UringRing_t * pRing );
+
+/**
+ * @brief Get the number of completions the kernel has posted and that have
+ * not been reaped.
+ *
+ * @param[in] pRing The io_uring instance.
+ *
+ * @return Number of completions ready.
+ */
+static uint32_t readyCompletions( const UringRing_t * pRing );
+
+/**
+ * @brief Submit the queued entries and wait until the requested number of
+ * completions is ready.
+ *
+ * @param[in] pUringParams Parameters of the connection.
+ * @param[in] submitCount Number of queued entries.
+ * @param[in] completionCount Number of completions to wait for.
+ *
+ * @return 0 if successful; -1 on error.
+ */
+static int32_t waitForCompletions( UringParams_t * pUringParams,
+                                   uint32_t submitCount,
+                                   uint32_t completionCount );
+
+/**
+ * @brief Submit a send or receive operation, with a timeout linked to it,
+ * and wait for it to complete.
+ *
+ * @param[in] pUringParams Parameters of the connection.
+ * @param[in] pEntry The operation, whose opcode, address, length and buffer
+ * index are set by the caller.
+ * @param[in] timeoutMs Timeout of the operation. 0 means infinite timeout.
+ *
+ * @return Number of bytes transferred if successful; 0 on timeout; negative
+ * value on error.
+ */
+static int32_t transferData( UringParams_t * pUringParams,
+                             const struct io_uring_sqe * pEntry,
+                             uint32_t timeoutMs );
+
+/**
+ * @brief Receive data from the socket into a buffer of the application.
+ *
+ * @param[in] pUringParams Parameters of the connection.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Size of @p pBuffer.
+ *
+ * @return Number of bytes received if successful; 0 on timeout; negative
+ * value on error.
+ */
+static int32_t recvFromSocket( UringParams_t * pUringParams,
+                               void * pBuffer,
+                               size_t bytesToRecv );
+
+/**
+ * @brief Serve a receive request through the registered read-ahead buffer of
+ * the connection, refilling it from the socket when it is empty.
+ *
+ * @param[in] pUringParams Parameters of the connection.
+ * @param[out] pBuffer Buffer to receive network data into.
+ * @param[in] bytesToRecv Number of bytes requested.
+ *
+ * @return Number of bytes copied into @p pBuffer if successful; 0 if no data
+ * is available before the receive timeout; negative value on error.
+ */
+static int32_t recvBuffered( UringParams_t * pUringParams,
+                             uint8_t * pBuffer,
+                             size_t bytesToRecv );
+
+/*-----------------------------------------------------------*/
+
+static void logTransportError( int32_t errorNumber )
+{
+    /* Remove unused parameter warning. */
+    ( void ) errorNumber;
+
+    LogError( ( "A transport error occurred: %s.", strerror( errorNumber ) ) );
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t setupRing( UringParams_t * pUringParams )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    UringRing_t * pRing = &pUringParams->ring;
+    struct io_uring_params ringParams;
+    uint8_t * pSubmissionRing = NULL, * pCompletionRing = NULL;
+
+    ( void ) memset( pRing, 0, sizeof( UringRing_t ) );
+    ( void ) memset( &ringParams, 0, sizeof( ringParams ) );
+
+    if( pUringParams->pollCompletions == 1U )
+    {
+        ringParams.flags = IORING_SETUP_SQPOLL;
+        ringParams.sq_thread_idle = URING_SQ_THREAD_IDLE_MS;
+    }
+
+    pRing->ringDescriptor = UringSyscall_Setup( URING_QUEUE_DEPTH, &ringParams );
+
+    if( pRing->ringDescriptor < 0 )
+    {
+        LogError( ( "Failed to set up io_uring instance: %s.",
+                    strerror( errno ) ) );
+        returnStatus = SOCKETS_API_ERROR;
+    }
+    else
+    {
+        /* Both rings are mapped separately, which kernels that could map
+         * them at once still support. */
+        pRing->submissionRingSize = ringParams.sq_off.array +
+                                    ( ringParams.sq_entries * sizeof( uint32_t ) );
+        pRing->completionRingSize = ringParams.cq_off.cqes +
+                                    ( ringParams.cq_entries * sizeof( struct io_uring_cqe ) );
+        pRing->submissionEntriesSize = ringParams.sq_entries * sizeof( struct io_uring_sqe );
+
+        pRing->pSubmissionRing = mmap( NULL,
+                                       pRing->submissionRingSize,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_POPULATE,
+                                       pRing->ringDescriptor,
+                                       ( off_t ) IORING_OFF_SQ_RING );
+        pRing->pCompletionRing = mmap( NULL,
+                                       pRing->completionRingSize,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_POPULATE,
+                                       pRing->ringDescriptor,
+                                       ( off_t ) IORING_OFF_CQ_RING );
+        pRing->pSubmissionEntries = mmap( NULL,
+                                          pRing->submissionEntriesSize,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE,
+                                          pRing->ringDescriptor,
+                                          ( off_t ) IORING_OFF_SQES );
+
+        if( ( pRing->pSubmissionRing == MAP_FAILED ) ||
+            ( pRing->pCompletionRing == MAP_FAILED ) ||
+            ( pRing->pSubmissionEntries == MAP_FAILED ) )
+        {
+            LogError( ( "Failed to map io_uring rings: %s.",
+                        strerror( errno ) ) );
+            returnStatus = SOCKETS_API_ERROR;
+        }
+        else
+        {
+            pSubmissionRing = pRing->pSubmissionRing;
+            pCompletionRing = pRing->pCompletionRing;
+
+            /* The kernel gives the position of each field in the rings. */
+            pRing->pSubmissionTail = ( uint32_t * ) &pSubmissionRing[ ringParams.sq_off.tail ];
+            pRing->pSubmissionFlags = ( uint32_t * ) &pSubmissionRing[ ringParams.sq_off.flags ];
+            pRing->pSubmissionArray = ( uint32_t * ) &pSubmissionRing[ ringParams.sq_off.array ];
+            pRing->submissionMask = *( ( uint32_t * ) &pSubmissionRing[ ringParams.sq_off.ring_mask ] );
+            pRing->submissionTail = *pRing->pSubmissionTail;
+
+            pRing->pCompletionHead = ( uint32_t * ) &pCompletionRing[ ringParams.cq_off.head ];
+            pRing->pCompletionTail = ( uint32_t * ) &pCompletionRing[ ringParams.cq_off.tail ];
+            pRing->pCompletionEntries = ( struct io_uring_cqe * ) &pCompletionRing[ ringParams.cq_off.cqes ];
+            pRing->completionMask = *( ( uint32_t * ) &pCompletionRing[ ringParams.cq_off.ring_mask ] );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static SocketStatus_t registerBuffers( UringParams_t * pUringParams )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    UringRing_t * pRing = &pUringParams->ring;
+    struct iovec buffers[ 2 ];
+    uint16_t bufferCount = 0U;
+
+    pRing->recvBufferIndex = URING_NO_BUFFER_INDEX;
+    pRing->sendBufferIndex = URING_NO_BUFFER_INDEX;
+
+    if( ( pUringParams->pRecvBuffer != NULL ) && ( pUringParams->recvBufferSize > 0U ) )
+    {
+        buffers[ bufferCount ].iov_base = pUringParams->pRecvBuffer;
+        buffers[ bufferCount ].iov_len = pUringParams->recvBufferSize;
+        pRing->recvBufferIndex = bufferCount;
+        bufferCount++;
+    }
+
+    if( ( pUringParams->pSendBuffer != NULL ) && ( pUringParams->sendBufferSize > 0U ) )
+    {
+        buffers[ bufferCount ].iov_base = pUringParams->pSendBuffer;
+        buffers[ bufferCount ].iov_len = pUringParams->sendBufferSize;
+        pRing->sendBufferIndex = bufferCount;
+        bufferCount++;
+    }
+
+    /* Registering maps the pages of the buffers once, instead of on each
+     * operation using them. */
+    if( ( bufferCount > 0U ) &&
+        ( UringSyscall_Register( pRing->ringDescriptor,
+                                 IORING_REGISTER_BUFFERS,
+                                 buffers,
+                                 bufferCount ) < 0 ) )
+    {
+        LogError( ( "Failed to register io_uring buffers: %s.",
+                    strerror( errno ) ) );
+        returnStatus = SOCKETS_API_ERROR;
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void teardownRing( UringRing_t * pRing )
+{
+    if( ( pRing->pSubmissionRing != NULL ) && ( pRing->pSubmissionRing != MAP_FAILED ) )
+    {
+        ( void ) munmap( pRing->pSubmissionRing, pRing->submissionRingSize );
+    }
+
+    if( ( pRing->pCompletionRing != NULL ) && ( pRing->pCompletionRing != MAP_FAILED ) )
+    {
+        ( void ) munmap( pRing->pCompletionRing, pRing->completionRingSize );
+    }
+
+    if( ( pRing->pSubmissionEntries != NULL ) && ( pRing->pSubmissionEntries != MAP_FAILED ) )
+    {
+        ( void ) munmap( pRing->pSubmissionEntries, pRing->submissionEntriesSize );
+    }
+
+    if( pRing->ringDescriptor >= 0 )
+    {
+        /* Closing the instance also releases the registered buffers. */
+        ( void ) close( pRing->ringDescriptor );
+    }
+
+    ( void ) memset( pRing, 0, sizeof( UringRing_t ) );
+    pRing->ringDescriptor = -1;
+}
+/*-----------------------------------------------------------*/
+
+static struct io_uring_sqe * getSubmissionEntry( UringRing_t * pRing )
+{
+    uint32_t index = pRing->submissionTail & pRing->submissionMask;
+    struct io_uring_sqe * pEntry = &pRing->pSubmissionEntries[ index ];
+
+    ( void ) memset( pEntry, 0, sizeof( struct io_uring_sqe ) );
+    pRing->pSubmissionArray[ index ] = index;
+    pRing->submissionTail++;
+
+    return pEntry;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t readyCompletions( const UringRing_t * pRing )
+{
+    /* The tail is written by the kernel, and the acquire ordering makes the
+     * entries before it visible. */
+    return __atomic_load_n( pRing->pCompletionTail, __ATOMIC_ACQUIRE ) - *pRing->pCompletionHead;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t waitForCompletions( UringParams_t * pUringParams,
+                                   uint32_t submitCount,
+                                   uint32_t completionCount )
+{
+    int32_t status = 0, enterStatus = 0;
+    uint32_t toSubmit = submitCount, spinCount = 0U;
+    UringRing_t * pRing = &pUringParams->ring;
+
+    /* Publish the queued entries. The release ordering makes their contents
+     * visible to the kernel before the new tail. */
+    __atomic_store_n( pRing->pSubmissionTail, pRing->submissionTail, __ATOMIC_RELEASE );
+
+    if( pUringParams->pollCompletions == 1U )
+    {
+        /* The kernel thread submits the entries itself. It only has to be
+         * woken up once it has gone idle. The full barrier orders reading the
+         * flags after publishing the tail. */
+        toSubmit = 0U;
+        __atomic_thread_fence( __ATOMIC_SEQ_CST );
+
+        if( ( __atomic_load_n( pRing->pSubmissionFlags, __ATOMIC_RELAXED ) & IORING_SQ_NEED_WAKEUP ) != 0U )
+        {
+            enterStatus = UringSyscall_Enter( pRing->ringDescriptor,
+                                              0U,
+                                              0U,
+                                              IORING_ENTER_SQ_WAKEUP );
+            COUNT_IO_CALL( pUringParams );
+        }
+
+        while( ( enterStatus >= 0 ) &&
+               ( readyCompletions( pRing ) < completionCount ) &&
+               ( spinCount < URING_POLL_SPIN_COUNT ) )
+        {
+            spinCount++;
+        }
+    }
+
+    if( enterStatus < 0 )
+    {
+        LogError( ( "Failed to wake up io_uring submission thread: %s.",
+                    strerror( errno ) ) );
+        status = -1;
+    }
+
+    /* Submit the entries and wait for the completions with one system call.
+     * Interrupted waits are resumed. */
+    while( ( status == 0 ) && ( readyCompletions( pRing ) < completionCount ) )
+    {
+        enterStatus = UringSyscall_Enter( pRing->ringDescriptor,
+                                          toSubmit,
+                                          completionCount - readyCompletions( pRing ),
+                                          IORING_ENTER_GETEVENTS );
+        COUNT_IO_CALL( pUringParams );
+
+        if( enterStatus >= 0 )
+        {
+            toSubmit -= ( ( uint32_t ) enterStatus < toSubmit ) ? ( uint32_t ) enterStatus : toSubmit;
+        }
+        else if( errno != EINTR )
+        {
+            LogError( ( "Failed to wait for io_uring completions: %s.",
+                        strerror( errno ) ) );
+            status = -1;
+        }
+        else
+        {
+            /* Empty else MISRA 15.7 */
+        }
+    }
+
+    return status;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t transferData( UringParams_t * pUringParams,
+                             const struct io_uring_sqe * pEntry,
+                             uint32_t timeoutMs )
+{
+    int32_t bytesTransferred = -1, result = -ECANCELED;
+    uint32_t entryCount = 1U, head = 0U;
+    UringRing_t * pRing = &pUringParams->ring;
+    struct io_uring_sqe * pTransferEntry = NULL, * pTimeoutEntry = NULL;
+    const struct io_uring_cqe * pCompletion = NULL;
+    struct __kernel_timespec timeout;
+
+    pTransferEntry = getSubmissionEntry( pRing );
+    ( void ) memcpy( pTransferEntry, pEntry, sizeof( struct io_uring_sqe ) );
+    pTransferEntry->fd = pUringParams->socketDescriptor;
+    pTransferEntry->user_data = URING_TRANSFER_USER_DATA;
+
+    if( timeoutMs != 0U )
+    {
+        /* Link a timeout to the operation, so that both are submitted and
+         * waited for together. The timeout cancels the operation if it
+         * expires first. */
+        timeout.tv_sec = ( int64_t ) ( timeoutMs / 1000U );
+        timeout.tv_nsec = ( int64_t ) ( timeoutMs % 1000U ) * 1000000;
+
+        pTransferEntry->flags |= IOSQE_IO_LINK;
+        pTimeoutEntry = getSubmissionEntry( pRing );
+        pTimeoutEntry->opcode = IORING_OP_LINK_TIMEOUT;
+        pTimeoutEntry->fd = -1;
+        pTimeoutEntry->addr = ( uint64_t ) ( uintptr_t ) &timeout;
+        pTimeoutEntry->len = 1U;
+        pTimeoutEntry->user_data = URING_TIMEOUT_USER_DATA;
+        entryCount++;
+    }
+
+    /* Both completions are waited for, since the kernel still uses the
+     * timeout, which is on the stack, until it completes. */
+    if( waitForCompletions( pUringParams, entryCount, entryCount ) == 0 )
+    {
+        head = *pRing->pCompletionHead;
+
+        while( head != __atomic_load_n( pRing->pCompletionTail, __ATOMIC_ACQUIRE ) )
+        {
+            pCompletion = &pRing->pCompletionEntries[ head & pRing->completionMask ];
+
+            if( pCompletion->user_data == URING_TRANSFER_USER_DATA )
+            {
+                result = pCompletion->res;
+            }
+
+            head++;
+        }
+
+        /* Hand the reaped entries back to the kernel. */
+        __atomic_store_n( pRing->pCompletionHead, head, __ATOMIC_RELEASE );
+
+        if( result > 0 )
+        {
+            bytesTransferred = result;
+        }
+        else if( result == -ECANCELED )
+        {
+            /* The linked timeout expired before the operation completed. */
+            bytesTransferred = 0;
+        }
+        else if( result == 0 )
+        {
+            /* Peer has closed the connection. Treat as an error. */
+            bytesTransferred = -1;
+        }
+        else
+        {
+            logTransportError( -result );
+        }
+    }
+
+    return bytesTransferred;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Uring_Connect( NetworkContext_t * pNetworkContext,
+                              const ServerInfo_t * pServerInfo,
+                              uint32_t sendTimeoutMs,
+                              uint32_t recvTimeoutMs )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    UringParams_t * pUringParams = NULL;
+
+    /* Validate parameters. */
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        pUringParams = pNetworkContext->pParams;
+
+        #if ( TRANSPORT_STATS_ENABLED == 1 )
+            ( void ) memset( &pUringParams->stats, 0, sizeof( TransportStats_t ) );
+            returnStatus = Sockets_ConnectWithStats( &pUringParams->socketDescriptor,
+                                                     pServerInfo,
+                                                     sendTimeoutMs,
+                                                     recvTimeoutMs,
+                                                     &pUringParams->stats );
+        #else
+            returnStatus = Sockets_Connect( &pUringParams->socketDescriptor,
+                                            pServerInfo,
+                                            sendTimeoutMs,
+                                            recvTimeoutMs );
+        #endif
+
+        /* Cache the timeouts, which are enforced by the timeouts linked to
+         * each operation rather than by the socket. */
+        pUringParams->sendTimeoutMs = sendTimeoutMs;
+        pUringParams->recvTimeoutMs = recvTimeoutMs;
+
+        /* Discard any data buffered from a previous connection. */
+        pUringParams->recvBufferHead = 0U;
+        pUringParams->recvBufferLength = 0U;
+    }
+
+    if( returnStatus == SOCKETS_SUCCESS )
+    {
+        returnStatus = setupRing( pUringParams );
+
+        if( returnStatus == SOCKETS_SUCCESS )
+        {
+            returnStatus = registerBuffers( pUringParams );
+        }
+
+        if( returnStatus != SOCKETS_SUCCESS )
+        {
+            teardownRing( &pUringParams->ring );
+            ( void ) Sockets_Disconnect( pUringParams->socketDescriptor );
+        }
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+SocketStatus_t Uring_Disconnect( const NetworkContext_t * pNetworkContext )
+{
+    SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+    UringParams_t * pUringParams = NULL;
+
+    /* Validate parameters. */
+    if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+        returnStatus = SOCKETS_INVALID_PARAMETER;
+    }
+    else
+    {
+        pUringParams = pNetworkContext->pParams;
+
+        /* The ring is only mapped while connected. */
+        if( pUringParams->ring.pSubmissionRing != NULL )
+        {
+            teardownRing( &pUringParams->ring );
+        }
+
+        returnStatus = Sockets_Disconnect( pUringParams->socketDescriptor );
+    }
+
+    return returnStatus;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t recvFromSocket( UringParams_t * pUringParams,
+                               void * pBuffer,
+                               size_t bytesToRecv )
+{
+    struct io_uring_sqe entry;
+
+    assert( pUringParams != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToRecv > 0 );
+
+    ( void ) memset( &entry, 0, sizeof( entry ) );
+    entry.opcode = IORING_OP_RECV;
+    entry.addr = ( uint64_t ) ( uintptr_t ) pBuffer;
+    entry.len = ( uint32_t ) bytesToRecv;
+
+    return transferData( pUringParams, &entry, pUringParams->recvTimeoutMs );
+}
+/*-----------------------------------------------------------*/
+
+static int32_t recvBuffered( UringParams_t * pUringParams,
+                             uint8_t * pBuffer,
+                             size_t bytesToRecv )
+{
+    int32_t bytesReceived = 0;
+    size_t bytesToCopy = 0U;
+    struct io_uring_sqe entry;
+
+    assert( pUringParams != NULL );
+    assert( pUringParams->pRecvBuffer != NULL );
+    assert( pBuffer != NULL );
+
+    if( pUringParams->recvBufferLength == 0U )
+    {
+        if( bytesToRecv >= pUringParams->recvBufferSize )
+        {
+            /* The request cannot be served from the buffer anyway, so read
+             * directly into the caller's buffer to avoid an extra copy. */
+            bytesReceived = recvFromSocket( pUringParams,
+                                            pBuffer,
+                                            bytesToRecv );
+        }
+        else
+        {
+            /* Read as much as is available into the registered buffer to
+             * serve the following reads from memory. */
+            ( void ) memset( &entry, 0, sizeof( entry ) );
+            entry.opcode = IORING_OP_READ_FIXED;
+            entry.addr = ( uint64_t ) ( uintptr_t ) pUringParams->pRecvBuffer;
+            entry.len = ( uint32_t ) pUringParams->recvBufferSize;
+            entry.buf_index = pUringParams->ring.recvBufferIndex;
+
+            bytesReceived = transferData( pUringParams, &entry, pUringParams->recvTimeoutMs );
+
+            if( bytesReceived > 0 )
+            {
+                pUringParams->recvBufferHead = 0U;
+                pUringParams->recvBufferLength = ( size_t ) bytesReceived;
+                bytesReceived = 0;
+            }
+        }
+    }
+
+    /* Serve the request from the buffered data. A short read is returned if
+     * fewer bytes are buffered than requested. */
+    if( pUringParams->recvBufferLength > 0U )
+    {
+        bytesToCopy = ( bytesToRecv < pUringParams->recvBufferLength ) ?
+                      bytesToRecv : pUringParams->recvBufferLength;
+
+        ( void ) memcpy( pBuffer,
+                         &pUringParams->pRecvBuffer[ pUringParams->recvBufferHead ],
+                         bytesToCopy );
+
+        pUringParams->recvBufferHead += bytesToCopy;
+        pUringParams->recvBufferLength -= bytesToCopy;
+        bytesReceived = ( int32_t ) bytesToCopy;
+    }
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+/* MISRA Rule 8.13 flags the following line for not using the const qualifier
+ * on `pNetworkContext`. Indeed, the object pointed by it is not modified
+ * by this transport, but other implementations of `TransportRecv_t` may do so. */
+int32_t Uring_Recv( NetworkContext_t * pNetworkContext,
+                    void * pBuffer,
+                    size_t bytesToRecv )
+{
+    UringParams_t * pUringParams = NULL;
+    int32_t bytesReceived = -1;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+    #endif
+
+    assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToRecv > 0 );
+
+    pUringParams = pNetworkContext->pParams;
+
+    if( pUringParams->ring.recvBufferIndex != URING_NO_BUFFER_INDEX )
+    {
+        bytesReceived = recvBuffered( pUringParams,
+                                      pBuffer,
+                                      bytesToRecv );
+    }
+    else
+    {
+        bytesReceived = recvFromSocket( pUringParams,
+                                        pBuffer,
+                                        bytesToRecv );
+    }
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        TransportStats_RecordRecv( &pUringParams->stats, bytesReceived, startTimeUs );
+    #endif
+
+    return bytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+/* MISRA Rule 8.13 flags the following line for not using the const qualifier
+ * on `pNetworkContext`. Indeed, the object pointed by it is not modified
+ * by this transport, but other implementations of `TransportSend_t` may do so. */
+int32_t Uring_Send( NetworkContext_t * pNetworkContext,
+                    const void * pBuffer,
+                    size_t bytesToSend )
+{
+    UringParams_t * pUringParams = NULL;
+    int32_t bytesSent = -1;
+    struct io_uring_sqe entry;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+    #endif
+
+    assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
+    assert( pBuffer != NULL );
+    assert( bytesToSend > 0 );
+
+    pUringParams = pNetworkContext->pParams;
+
+    ( void ) memset( &entry, 0, sizeof( entry ) );
+
+    if( ( pUringParams->ring.sendBufferIndex != URING_NO_BUFFER_INDEX ) &&
+        ( bytesToSend <= pUringParams->sendBufferSize ) )
+    {
+        /* Send from the registered buffer. Copying a small send is cheaper
+         * than having the kernel map the caller's buffer. */
+        ( void ) memcpy( pUringParams->pSendBuffer, pBuffer, bytesToSend );
+
+        entry.opcode = IORING_OP_WRITE_FIXED;
+        entry.addr = ( uint64_t ) ( uintptr_t ) pUringParams->pSendBuffer;
+        entry.buf_index = pUringParams->ring.sendBufferIndex;
+    }
+    else
+    {
+        entry.opcode = IORING_OP_SEND;
+        entry.addr = ( uint64_t ) ( uintptr_t ) pBuffer;
+    }
+
+    entry.len = ( uint32_t ) bytesToSend;
+    bytesSent = transferData( pUringParams, &entry, pUringParams->sendTimeoutMs );
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        TransportStats_RecordSend( &pUringParams->stats, bytesToSend, bytesSent, startTimeUs );
+    #endif
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Uring_Writev( NetworkContext_t * pNetworkContext,
+                      const struct iovec * pIoVec,
+                      size_t ioVecCount )
+{
+    UringParams_t * pUringParams = NULL;
+    int32_t bytesSent = -1;
+    struct msghdr message;
+    struct io_uring_sqe entry;
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        uint64_t startTimeUs = TransportStats_GetTimeUs();
+        size_t bytesToSend = 0U, i = 0U;
+    #endif
+
+    assert( pNetworkContext != NULL && pNetworkContext->pParams != NULL );
+    assert( pIoVec != NULL );
+    assert( ioVecCount > 0 );
+
+    pUringParams = pNetworkContext->pParams;
+
+    ( void ) memset( &message, 0, sizeof( message ) );
+
+    /* MISRA Rule 11.8 flags the following line for removing the const
+     * qualifier from the pointed to type. This rule is suppressed because
+     * struct msghdr declares msg_iov as non-const, but sendmsg does not
+     * modify the buffers it points to. */
+    /* coverity[misra_c_2012_rule_11_8_violation] */
+    message.msg_iov = ( struct iovec * ) pIoVec;
+    message.msg_iovlen = ioVecCount;
+
+    ( void ) memset( &entry, 0, sizeof( entry ) );
+    entry.opcode = IORING_OP_SENDMSG;
+    entry.addr = ( uint64_t ) ( uintptr_t ) &message;
+    entry.len = 1U;
+
+    bytesSent = transferData( pUringParams, &entry, pUringParams->sendTimeoutMs );
+
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        for( i = 0U; i < ioVecCount; i++ )
+        {
+            bytesToSend += pIoVec[ i ].iov_len;
+        }
+
+        TransportStats_RecordSend( &pUringParams->stats, bytesToSend, bytesSent, startTimeUs );
+    #endif
+
+    return bytesSent;
+}
+/*-----------------------------------------------------------*/
+
+#if ( TRANSPORT_STATS_ENABLED == 1 )
+
+    SocketStatus_t Uring_GetStats( const NetworkContext_t * pNetworkContext,
+                                       TransportStats_t * pStats )
+    {
+        SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+        if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+        {
+            LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+            returnStatus = SOCKETS_INVALID_PARAMETER;
+        }
+        else if( pStats == NULL )
+        {
+            LogError( ( "Parameter check failed: pStats is NULL." ) );
+            returnStatus = SOCKETS_INVALID_PARAMETER;
+        }
+        else
+        {
+            ( void ) memcpy( pStats, &pNetworkContext->pParams->stats, sizeof( TransportStats_t ) );
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+    SocketStatus_t Uring_ResetStats( NetworkContext_t * pNetworkContext )
+    {
+        SocketStatus_t returnStatus = SOCKETS_SUCCESS;
+
+        if( ( pNetworkContext == NULL ) || ( pNetworkContext->pParams == NULL ) )
+        {
+            LogError( ( "Parameter check failed: pNetworkContext is NULL." ) );
+            returnStatus = SOCKETS_INVALID_PARAMETER;
+        }
+        else
+        {
+            ( void ) memset( &pNetworkContext->pParams->stats, 0, sizeof( TransportStats_t ) );
+        }
+
+        return returnStatus;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* if ( TRANSPORT_STATS_ENABLED == 1 ) */
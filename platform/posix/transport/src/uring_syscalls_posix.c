@@ -0,0 +1,56 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* POSIX includes. */
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "uring_syscalls_posix.h"
+
+/*-----------------------------------------------------------*/
+
+int32_t UringSyscall_Setup( uint32_t entries,
+                            struct io_uring_params * pParams )
+{
+    return ( int32_t ) syscall( __NR_io_uring_setup, entries, pParams );
+}
+/*-----------------------------------------------------------*/
+
+int32_t UringSyscall_Enter( int32_t ringDescriptor,
+                            uint32_t toSubmit,
+                            uint32_t minComplete,
+                            uint32_t flags )
+{
+    /* The last two arguments are the signal mask to set while waiting and its
+     * size, which are not used. */
+    return ( int32_t ) syscall( __NR_io_uring_enter, ringDescriptor, toSubmit, minComplete, flags, NULL, 0 );
+}
+/*-----------------------------------------------------------*/
+
+int32_t UringSyscall_Register( int32_t ringDescriptor,
+                               uint32_t opcode,
+                               const void * pArg,
+                               uint32_t argCount )
+{
+    return ( int32_t ) syscall( __NR_io_uring_register, ringDescriptor, opcode, pArg, argCount );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,353 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "capture_transport_posix.h"
+
+#include "mock_clock.h"
+
+/* Size of the buffer of the stream the captures are written to. */
+#define CAPTURE_BUFFER_SIZE    ( 256U )
+
+/* Each compilation unit must define the NetworkContext struct. The tests use
+ * the network contexts of both transports. */
+struct NetworkContext
+{
+    void * pParams;
+};
+
+static CaptureTransportParams_t captureParams;
+static ReplayTransportParams_t replayParams;
+static NetworkContext_t captureContext;
+static NetworkContext_t replayContext;
+static TransportInterface_t capturedTransport;
+
+/* Stream the captures are written to, and its buffer. fclose is mocked by the
+ * suite, so the memory streams of the tests are left open. */
+static FILE * pCaptureFile;
+static uint8_t captureBuffer[ CAPTURE_BUFFER_SIZE ];
+
+/* Time returned by the mocked #Clock_GetTimeUs. */
+static uint64_t fakeTimeUs;
+
+/* Return values of the receives of the transport captured, in order, and
+ * the bytes they return. */
+static const int32_t * pRecvResults;
+static size_t recvResultIndex;
+static const uint8_t recvBytes[] = "abcdefg";
+static size_t recvBytesOffset;
+
+/* Data sent and received by the tests. */
+static const uint8_t testData[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static uint8_t receivedData[ sizeof( testData ) ];
+
+/* A capture of a send of 3 bytes 250 us after the start, then a receive of
+ * 5 bytes 50 us later and a receive of 2 bytes 200 us later. */
+static const uint8_t testCapture[] =
+{
+    'T',  'C',  'A',  'P', CAPTURE_TRANSPORT_VERSION,
+    0xFA, 0x01, 0x06, '0', '1', '2',
+    0x32, 0x0B, 'a',  'b', 'c', 'd', 'e',
+    0xC8, 0x01, 0x05, 'f', 'g'
+};
+
+/**
+ * @brief Return the simulated time from #Clock_GetTimeUs.
+ */
+static uint64_t getTimeUs( int numCalls )
+{
+    ( void ) numCalls;
+
+    return fakeTimeUs;
+}
+
+/**
+ * @brief Receive of the transport captured, returning the bytes of
+ * #recvBytes in the pieces of #pRecvResults.
+ */
+static int32_t capturedRecv( NetworkContext_t * pNetworkContext,
+                             void * pBuffer,
+                             size_t bytesToRecv )
+{
+    int32_t result = pRecvResults[ recvResultIndex ];
+
+    ( void ) pNetworkContext;
+    TEST_ASSERT_TRUE( ( result <= 0 ) || ( ( size_t ) result <= bytesToRecv ) );
+    recvResultIndex++;
+
+    if( result > 0 )
+    {
+        memcpy( pBuffer, &recvBytes[ recvBytesOffset ], ( size_t ) result );
+        recvBytesOffset += ( size_t ) result;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Send of the transport captured, sending at most 3 bytes at a time.
+ */
+static int32_t capturedSend( NetworkContext_t * pNetworkContext,
+                             const void * pBuffer,
+                             size_t bytesToSend )
+{
+    ( void ) pNetworkContext;
+    ( void ) pBuffer;
+
+    return ( bytesToSend < 3U ) ? ( int32_t ) bytesToSend : 3;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    fakeTimeUs = 1000U;
+    Clock_GetTimeUs_Stub( getTimeUs );
+    recvResultIndex = 0U;
+    recvBytesOffset = 0U;
+    memset( receivedData, 0, sizeof( receivedData ) );
+    memset( captureBuffer, 0, sizeof( captureBuffer ) );
+    memset( &captureParams, 0, sizeof( captureParams ) );
+    memset( &replayParams, 0, sizeof( replayParams ) );
+    captureContext.pParams = &captureParams;
+    replayContext.pParams = &replayParams;
+
+    capturedTransport.recv = capturedRecv;
+    capturedTransport.send = capturedSend;
+    capturedTransport.pNetworkContext = NULL;
+
+    pCaptureFile = fmemopen( captureBuffer, sizeof( captureBuffer ), "wb" );
+    TEST_ASSERT_NOT_NULL( pCaptureFile );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that invalid parameters are rejected.
+ */
+void test_CaptureTransport_Invalid_Params( void )
+{
+    NetworkContext_t emptyContext = { 0 };
+    TransportInterface_t noRecv = capturedTransport;
+
+    noRecv.recv = NULL;
+
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       CaptureTransport_Start( NULL, &capturedTransport, pCaptureFile ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       CaptureTransport_Start( &emptyContext, &capturedTransport, pCaptureFile ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       CaptureTransport_Start( &captureContext, NULL, pCaptureFile ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       CaptureTransport_Start( &captureContext, &noRecv, pCaptureFile ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       CaptureTransport_Start( &captureContext, &capturedTransport, NULL ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER, CaptureTransport_Stop( &captureContext ) );
+    TEST_ASSERT_EQUAL( -1, CaptureTransport_Send( &captureContext, testData, 1U ) );
+    TEST_ASSERT_EQUAL( -1, CaptureTransport_Recv( NULL, receivedData, 1U ) );
+
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       ReplayTransport_Init( NULL, testCapture, sizeof( testCapture ), REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       ReplayTransport_Init( &replayContext, NULL, sizeof( testCapture ), REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER,
+                       ReplayTransport_Init( &replayContext, testCapture, sizeof( testCapture ),
+                                             ( ReplayTransportSpeed_t ) 2 ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER, ReplayTransport_Rewind( &replayContext ) );
+    TEST_ASSERT_FALSE( ReplayTransport_IsFinished( &replayContext ) );
+    TEST_ASSERT_EQUAL( -1, ReplayTransport_Recv( &replayContext, receivedData, 1U ) );
+    TEST_ASSERT_EQUAL( -1, ReplayTransport_Send( &replayContext, testData, 1U ) );
+}
+
+/**
+ * @brief Test that the bytes moved by the sends and receives are written
+ * with their times, and that those which moved nothing are not.
+ */
+void test_CaptureTransport_Writes_Records( void )
+{
+    static const int32_t recvResults[] = { 0, 5, -1, 2 };
+
+    pRecvResults = recvResults;
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_SUCCESS,
+                       CaptureTransport_Start( &captureContext, &capturedTransport, pCaptureFile ) );
+
+    fakeTimeUs += 250U;
+    TEST_ASSERT_EQUAL( 3, CaptureTransport_Send( &captureContext, testData, sizeof( testData ) ) );
+
+    fakeTimeUs += 50U;
+    TEST_ASSERT_EQUAL( 0, CaptureTransport_Recv( &captureContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL( 5, CaptureTransport_Recv( &captureContext, receivedData, sizeof( receivedData ) ) );
+
+    fakeTimeUs += 200U;
+    TEST_ASSERT_EQUAL( -1, CaptureTransport_Recv( &captureContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL( 2, CaptureTransport_Recv( &captureContext, receivedData, sizeof( receivedData ) ) );
+
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_SUCCESS, CaptureTransport_Stop( &captureContext ) );
+    TEST_ASSERT_EQUAL( sizeof( testCapture ), ftell( pCaptureFile ) );
+    TEST_ASSERT_EQUAL_MEMORY( testCapture, captureBuffer, sizeof( testCapture ) );
+
+    /* The transport is still used once the capture stopped. */
+    TEST_ASSERT_EQUAL( 3, CaptureTransport_Send( &captureContext, testData, sizeof( testData ) ) );
+    TEST_ASSERT_EQUAL( sizeof( testCapture ), ftell( pCaptureFile ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_INVALID_PARAMETER, CaptureTransport_Stop( &captureContext ) );
+}
+
+/**
+ * @brief Test that a write failure stops the capture but not the transport.
+ */
+void test_CaptureTransport_Write_Failure( void )
+{
+    FILE * pSmallFile = fmemopen( captureBuffer, CAPTURE_TRANSPORT_HEADER_LENGTH + 3U, "wb" );
+
+    TEST_ASSERT_NOT_NULL( pSmallFile );
+    TEST_ASSERT_EQUAL( 0, setvbuf( pSmallFile, NULL, _IONBF, 0U ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_SUCCESS,
+                       CaptureTransport_Start( &captureContext, &capturedTransport, pSmallFile ) );
+
+    /* The header of the record fits, but not its bytes. */
+    TEST_ASSERT_EQUAL( 3, CaptureTransport_Send( &captureContext, testData, sizeof( testData ) ) );
+    TEST_ASSERT_TRUE( captureParams.failed );
+    TEST_ASSERT_EQUAL( 3, CaptureTransport_Send( &captureContext, testData, sizeof( testData ) ) );
+
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_WRITE_FAILURE, CaptureTransport_Stop( &captureContext ) );
+}
+
+/**
+ * @brief Test that the replay at the maximum speed returns the bytes of each
+ * receive record, and skips the send records.
+ */
+void test_ReplayTransport_Max_Speed( void )
+{
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_SUCCESS,
+                       ReplayTransport_Init( &replayContext, testCapture, sizeof( testCapture ),
+                                             REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( 7U, replayParams.recvLength );
+    TEST_ASSERT_EQUAL( 3U, replayParams.sendLength );
+    TEST_ASSERT_FALSE( ReplayTransport_IsFinished( &replayContext ) );
+
+    /* A receive stops at the end of a record, and may take a part of it. */
+    TEST_ASSERT_EQUAL( 10, ReplayTransport_Send( &replayContext, testData, 10U ) );
+    TEST_ASSERT_EQUAL( 3, ReplayTransport_Recv( &replayContext, receivedData, 3U ) );
+    TEST_ASSERT_EQUAL( 2, ReplayTransport_Recv( &replayContext, &receivedData[ 3 ], sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL( 2, ReplayTransport_Recv( &replayContext, &receivedData[ 5 ], sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( "abcdefg", receivedData, 7U );
+    TEST_ASSERT_EQUAL( 10U, replayParams.bytesSent );
+    TEST_ASSERT_TRUE( ReplayTransport_IsFinished( &replayContext ) );
+    TEST_ASSERT_EQUAL( -1, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_SUCCESS, ReplayTransport_Rewind( &replayContext ) );
+    TEST_ASSERT_FALSE( ReplayTransport_IsFinished( &replayContext ) );
+    TEST_ASSERT_EQUAL( 0U, replayParams.bytesSent );
+    TEST_ASSERT_EQUAL( 5, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( "abcde", receivedData, 5U );
+}
+
+/**
+ * @brief Test that the replay at the recorded speed returns a receive record
+ * once its time came.
+ */
+void test_ReplayTransport_Recorded_Speed( void )
+{
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_SUCCESS,
+                       ReplayTransport_Init( &replayContext, testCapture, sizeof( testCapture ),
+                                             REPLAY_TRANSPORT_RECORDED_SPEED ) );
+
+    /* The first receive record is 300 us after the start. */
+    fakeTimeUs += 299U;
+    TEST_ASSERT_EQUAL( 0, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+    fakeTimeUs += 1U;
+    TEST_ASSERT_EQUAL( 5, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+
+    /* The second, 200 us after the first. */
+    fakeTimeUs += 199U;
+    TEST_ASSERT_EQUAL( 0, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+    fakeTimeUs += 1U;
+    TEST_ASSERT_EQUAL( 2, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL( -1, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+}
+
+/**
+ * @brief Test that the captures not written by the capture transport are
+ * rejected.
+ */
+void test_ReplayTransport_Malformed_Capture( void )
+{
+    static const uint8_t badVersion[] = { 'T', 'C', 'A', 'P', 2U };
+    static const uint8_t truncatedRecord[] = { 'T', 'C', 'A', 'P', 1U, 0x00, 0x08, 'a' };
+    static const uint8_t emptyRecord[] = { 'T', 'C', 'A', 'P', 1U, 0x00, 0x01 };
+    static const uint8_t unfinishedNumber[] = { 'T', 'C', 'A', 'P', 1U, 0x80 };
+    static const uint8_t overlongNumber[] =
+    {
+        'T',  'C',  'A',  'P',  1U,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02,
+        0x03, 'a'
+    };
+    static const uint8_t emptyCapture[] = { 'T', 'C', 'A', 'P', 1U };
+
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_MALFORMED_CAPTURE,
+                       ReplayTransport_Init( &replayContext, badVersion, 4U, REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_MALFORMED_CAPTURE,
+                       ReplayTransport_Init( &replayContext, badVersion, sizeof( badVersion ),
+                                             REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_MALFORMED_CAPTURE,
+                       ReplayTransport_Init( &replayContext, truncatedRecord, sizeof( truncatedRecord ),
+                                             REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_MALFORMED_CAPTURE,
+                       ReplayTransport_Init( &replayContext, emptyRecord, sizeof( emptyRecord ),
+                                             REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_MALFORMED_CAPTURE,
+                       ReplayTransport_Init( &replayContext, unfinishedNumber, sizeof( unfinishedNumber ),
+                                             REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_MALFORMED_CAPTURE,
+                       ReplayTransport_Init( &replayContext, overlongNumber, sizeof( overlongNumber ),
+                                             REPLAY_TRANSPORT_MAX_SPEED ) );
+
+    /* A capture of a connection that moved nothing is finished at once. */
+    TEST_ASSERT_EQUAL( CAPTURE_TRANSPORT_SUCCESS,
+                       ReplayTransport_Init( &replayContext, emptyCapture, sizeof( emptyCapture ),
+                                             REPLAY_TRANSPORT_MAX_SPEED ) );
+    TEST_ASSERT_TRUE( ReplayTransport_IsFinished( &replayContext ) );
+    TEST_ASSERT_EQUAL( -1, ReplayTransport_Recv( &replayContext, receivedData, sizeof( receivedData ) ) );
+}
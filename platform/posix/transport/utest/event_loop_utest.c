@@ -0,0 +1,410 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "/usr/include/errno.h"
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "event_loop_posix.h"
+
+#include "mock_epoll_api.h"
+#include "mock_clock.h"
+#include "mock_unistd_api.h"
+
+/* The epoll instance returned by the mocked epoll_create1. */
+#define EPOLL_DESCRIPTOR    5
+
+/* The number of connections used by the tests. */
+#define NUM_CONNECTIONS     4
+
+static EventLoop_t eventLoop;
+static EventLoopConnection_t connections[ NUM_CONNECTIONS ];
+
+/* Time returned by the mocked #Clock_GetTimeMs. */
+static uint32_t currentTimeMs;
+
+/* Events reported to #connectionCallback for each connection. */
+static uint32_t reportedEvents[ NUM_CONNECTIONS ];
+static uint32_t callbackCount[ NUM_CONNECTIONS ];
+
+/* Connection removed by #connectionCallback, if any. */
+static EventLoopConnection_t * pConnectionToRemove;
+
+/* Deadline set again by #connectionCallback, if non-zero. */
+static uint32_t rearmTimeoutMs;
+
+/* Number of calls to #timerCallback. */
+static uint32_t timerCallbackCount;
+
+/**
+ * @brief Return the simulated time from #Clock_GetTimeMs.
+ */
+static uint32_t getTimeMs( int numCalls )
+{
+    ( void ) numCalls;
+
+    return currentTimeMs;
+}
+
+/**
+ * @brief Record the events reported for a connection.
+ */
+static void connectionCallback( EventLoopConnection_t * pConnection,
+                                uint32_t events )
+{
+    size_t index = ( size_t ) ( pConnection - connections );
+
+    TEST_ASSERT_TRUE( index < NUM_CONNECTIONS );
+    reportedEvents[ index ] |= events;
+    callbackCount[ index ]++;
+
+    if( pConnectionToRemove != NULL )
+    {
+        epoll_ctl_ExpectAnyArgsAndReturn( 0 );
+        TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                           EventLoop_Remove( &eventLoop, pConnectionToRemove ) );
+        pConnectionToRemove = NULL;
+    }
+
+    if( rearmTimeoutMs != 0U )
+    {
+        TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                           EventLoop_SetDeadline( &eventLoop, pConnection, rearmTimeoutMs ) );
+    }
+}
+
+/**
+ * @brief Count the timers reported.
+ */
+static void timerCallback( TimerWheelTimer_t * pTimer )
+{
+    TEST_ASSERT_NOT_NULL( pTimer );
+    timerCallbackCount++;
+}
+
+/**
+ * @brief Advance the simulated time and dispatch once with no socket ready.
+ *
+ * @return Number of callbacks called.
+ */
+static size_t dispatchAfter( uint32_t elapsedMs )
+{
+    size_t dispatchedCount = 0U;
+
+    currentTimeMs += elapsedMs;
+    epoll_wait_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Dispatch( &eventLoop, 0U, &dispatchedCount ) );
+
+    return dispatchedCount;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    int32_t i;
+
+    currentTimeMs = 1000U;
+    pConnectionToRemove = NULL;
+    rearmTimeoutMs = 0U;
+    memset( reportedEvents, 0, sizeof( reportedEvents ) );
+    memset( callbackCount, 0, sizeof( callbackCount ) );
+    Clock_GetTimeMs_Stub( getTimeMs );
+
+    epoll_create1_ExpectAnyArgsAndReturn( EPOLL_DESCRIPTOR );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Init( &eventLoop ) );
+
+    for( i = 0; i < NUM_CONNECTIONS; i++ )
+    {
+        memset( &connections[ i ], 0, sizeof( EventLoopConnection_t ) );
+        connections[ i ].fileDescriptor = 10 + i;
+        connections[ i ].callback = connectionCallback;
+        epoll_ctl_ExpectAnyArgsAndReturn( 0 );
+        TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                           EventLoop_Add( &eventLoop, &connections[ i ] ) );
+    }
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that the event loop functions fail when invalid parameters are
+ * passed.
+ */
+void test_EventLoop_Invalid_Params( void )
+{
+    EventLoopConnection_t connection = { 0 };
+
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Init( NULL ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Deinit( NULL ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Add( NULL, &connection ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Add( &eventLoop, NULL ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Remove( NULL, &connection ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Remove( &eventLoop, NULL ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_SetDeadline( NULL, &connection, 0U ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_SetDeadline( &eventLoop, NULL, 0U ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_CancelDeadline( NULL, &connection ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_CancelDeadline( &eventLoop, NULL ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Dispatch( NULL, 0U, NULL ) );
+
+    /* A connection needs a socket and a callback. */
+    connection.fileDescriptor = -1;
+    connection.callback = connectionCallback;
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Add( &eventLoop, &connection ) );
+    connection.fileDescriptor = 1;
+    connection.callback = NULL;
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_Add( &eventLoop, &connection ) );
+}
+
+/**
+ * @brief Test that the event loop functions fail when the system calls fail.
+ */
+void test_EventLoop_System_Call_Failures( void )
+{
+    EventLoop_t failedEventLoop;
+
+    epoll_create1_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR, EventLoop_Init( &failedEventLoop ) );
+
+    epoll_ctl_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR, EventLoop_Add( &eventLoop, &connections[ 0 ] ) );
+
+    epoll_ctl_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR, EventLoop_Remove( &eventLoop, &connections[ 0 ] ) );
+
+    errno = EBADF;
+    epoll_wait_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_API_ERROR, EventLoop_Dispatch( &eventLoop, 0U, NULL ) );
+
+    /* An interrupted wait is not an error. */
+    errno = EINTR;
+    epoll_wait_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Dispatch( &eventLoop, 0U, NULL ) );
+
+    close_ExpectAndReturn( EPOLL_DESCRIPTOR, 0 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Deinit( &eventLoop ) );
+}
+
+/**
+ * @brief Test that #EventLoop_Dispatch calls the callbacks of the ready
+ * connections only, and skips a connection removed by an earlier callback.
+ */
+void test_EventLoop_Dispatch_Ready_Connections( void )
+{
+    struct epoll_event events[ 3 ];
+    size_t dispatchedCount = 0U;
+
+    events[ 0 ].events = EPOLLIN;
+    events[ 0 ].data.ptr = &connections[ 0 ];
+    events[ 1 ].events = EPOLLIN | EPOLLRDHUP;
+    events[ 1 ].data.ptr = &connections[ 2 ];
+    events[ 2 ].events = EPOLLIN;
+    events[ 2 ].data.ptr = &connections[ 3 ];
+
+    /* The callback of the first connection removes the last one. */
+    pConnectionToRemove = &connections[ 3 ];
+
+    epoll_wait_ExpectAnyArgsAndReturn( 3 );
+    epoll_wait_ReturnArrayThruPtr_events( events, 3 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Dispatch( &eventLoop, 1000U, &dispatchedCount ) );
+
+    TEST_ASSERT_EQUAL( 2, dispatchedCount );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_EVENT_READABLE, reportedEvents[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, reportedEvents[ 1 ] );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_EVENT_READABLE | EVENT_LOOP_EVENT_HANGUP, reportedEvents[ 2 ] );
+    TEST_ASSERT_EQUAL( 0, reportedEvents[ 3 ] );
+}
+
+/**
+ * @brief Test that deadlines are reported once they are due, rounded up to
+ * the timer tick, and not before.
+ */
+void test_EventLoop_Deadlines_Are_Reported_When_Due( void )
+{
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 0 ], EVENT_LOOP_TIMER_TICK_MS / 2U ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 1 ], 3U * EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 2 ], 3U * EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 3, eventLoop.timerWheel.timerCount );
+
+    /* Cancelling removes the deadline. */
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_CancelDeadline( &eventLoop, &connections[ 2 ] ) );
+    TEST_ASSERT_EQUAL( 2, eventLoop.timerWheel.timerCount );
+
+    TEST_ASSERT_EQUAL( 0, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS - 1U ) );
+    TEST_ASSERT_EQUAL( 1, dispatchAfter( 1U ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_EVENT_DEADLINE, reportedEvents[ 0 ] );
+
+    TEST_ASSERT_EQUAL( 0, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 1, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_EVENT_DEADLINE, reportedEvents[ 1 ] );
+    TEST_ASSERT_EQUAL( 0, reportedEvents[ 2 ] );
+    TEST_ASSERT_EQUAL( 0, eventLoop.timerWheel.timerCount );
+
+    /* A reported deadline is cleared. */
+    TEST_ASSERT_EQUAL( 0, dispatchAfter( 10U * EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 1, callbackCount[ 0 ] );
+    TEST_ASSERT_EQUAL( 1, callbackCount[ 1 ] );
+}
+
+/**
+ * @brief Test that deadlines held by the higher levels of the timer wheel are
+ * reported only once they are due, including when a dispatch is late.
+ */
+void test_EventLoop_Deadlines_On_Higher_Levels( void )
+{
+    uint32_t levelSpanMs = TIMER_WHEEL_SLOTS * EVENT_LOOP_TIMER_TICK_MS;
+
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 0 ], levelSpanMs + EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 1 ], 5U * TIMER_WHEEL_SLOTS * levelSpanMs ) );
+
+    TEST_ASSERT_EQUAL( 0, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 0, dispatchAfter( levelSpanMs - EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 1, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_EVENT_DEADLINE, reportedEvents[ 0 ] );
+
+    /* A dispatch much later than the deadline still reports it. */
+    TEST_ASSERT_EQUAL( 1, dispatchAfter( 50U * TIMER_WHEEL_SLOTS * levelSpanMs ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_EVENT_DEADLINE, reportedEvents[ 1 ] );
+    TEST_ASSERT_EQUAL( 0, eventLoop.timerWheel.timerCount );
+}
+
+/**
+ * @brief Test that #EventLoop_Dispatch waits until the next deadline is due
+ * rather than waking up at every tick.
+ */
+void test_EventLoop_Dispatch_Waits_Until_Next_Deadline( void )
+{
+    /* Without deadlines, the wait is the longest allowed. */
+    epoll_wait_ExpectAndReturn( EPOLL_DESCRIPTOR, NULL, EVENT_LOOP_MAX_EVENTS, 5000, 0 );
+    epoll_wait_IgnoreArg_events();
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Dispatch( &eventLoop, 5000U, NULL ) );
+
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 0 ], 30U * EVENT_LOOP_TIMER_TICK_MS ) );
+
+    currentTimeMs += EVENT_LOOP_TIMER_TICK_MS / 2U;
+    epoll_wait_ExpectAndReturn( EPOLL_DESCRIPTOR, NULL, EVENT_LOOP_MAX_EVENTS,
+                                ( int ) ( 30U * EVENT_LOOP_TIMER_TICK_MS - EVENT_LOOP_TIMER_TICK_MS / 2U ), 0 );
+    epoll_wait_IgnoreArg_events();
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Dispatch( &eventLoop, 5000U, NULL ) );
+
+    /* A shorter wait allowed by the caller wins. */
+    epoll_wait_ExpectAndReturn( EPOLL_DESCRIPTOR, NULL, EVENT_LOOP_MAX_EVENTS, 10, 0 );
+    epoll_wait_IgnoreArg_events();
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Dispatch( &eventLoop, 10U, NULL ) );
+
+    /* A late dispatch does not wait. */
+    currentTimeMs += 40U * EVENT_LOOP_TIMER_TICK_MS;
+    epoll_wait_ExpectAndReturn( EPOLL_DESCRIPTOR, NULL, EVENT_LOOP_MAX_EVENTS, 0, 0 );
+    epoll_wait_IgnoreArg_events();
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Dispatch( &eventLoop, 5000U, NULL ) );
+    TEST_ASSERT_EQUAL( 1, callbackCount[ 0 ] );
+}
+
+/**
+ * @brief Test that timers not tied to a connection are reported by
+ * #EventLoop_Dispatch once they are due, and can be cancelled.
+ */
+void test_EventLoop_Application_Timers( void )
+{
+    TimerWheelTimer_t timers[ 2 ];
+
+    memset( timers, 0, sizeof( timers ) );
+    timerCallbackCount = 0U;
+
+    /* A timer needs a callback. */
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_StartTimer( &eventLoop, &timers[ 0 ], 0U ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_StartTimer( NULL, &timers[ 0 ], 0U ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_StartTimer( &eventLoop, NULL, 0U ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_CancelTimer( NULL, &timers[ 0 ] ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_INVALID_PARAMETER, EventLoop_CancelTimer( &eventLoop, NULL ) );
+
+    timers[ 0 ].callback = timerCallback;
+    timers[ 1 ].callback = timerCallback;
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_StartTimer( &eventLoop, &timers[ 0 ], 2U * EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_StartTimer( &eventLoop, &timers[ 1 ], 2U * EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_CancelTimer( &eventLoop, &timers[ 1 ] ) );
+    TEST_ASSERT_FALSE( TimerWheel_IsRunning( &timers[ 1 ] ) );
+
+    TEST_ASSERT_EQUAL( 0, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 1, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 1, timerCallbackCount );
+    TEST_ASSERT_FALSE( TimerWheel_IsRunning( &timers[ 0 ] ) );
+    TEST_ASSERT_EQUAL( 0, callbackCount[ 0 ] );
+}
+
+/**
+ * @brief Test that a callback can set the deadline of its connection again,
+ * as is done for the MQTT keep-alive, and remove another connection whose
+ * deadline is due at the same time.
+ */
+void test_EventLoop_Deadline_Callback_Rearms_And_Removes( void )
+{
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 0 ], EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_SetDeadline( &eventLoop, &connections[ 1 ], EVENT_LOOP_TIMER_TICK_MS ) );
+
+    /* The deadline of connection 0 was set first, so it is reported first. */
+    pConnectionToRemove = &connections[ 1 ];
+    rearmTimeoutMs = 2U * EVENT_LOOP_TIMER_TICK_MS;
+
+    TEST_ASSERT_EQUAL( 1, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 1, callbackCount[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, callbackCount[ 1 ] );
+    TEST_ASSERT_EQUAL( 1, eventLoop.timerWheel.timerCount );
+
+    rearmTimeoutMs = 0U;
+    TEST_ASSERT_EQUAL( 0, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 1, dispatchAfter( EVENT_LOOP_TIMER_TICK_MS ) );
+    TEST_ASSERT_EQUAL( 2, callbackCount[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, eventLoop.timerWheel.timerCount );
+}
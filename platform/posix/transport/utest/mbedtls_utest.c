@@ -0,0 +1,827 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "/usr/include/errno.h"
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "mbedtls_posix.h"
+
+/* Include for the errors of the callbacks given to mbedTLS. */
+#include "mbedtls/net_sockets.h"
+
+#include "mock_mbedtls_api.h"
+#include "mock_sockets_posix.h"
+#include "mock_socket.h"
+
+/* The send and receive timeout to set for the socket. */
+#define SEND_RECV_TIMEOUT      0
+
+/* The host and port from which to establish the connection. */
+#define HOSTNAME               "amazon.com"
+#define PORT                   443
+
+/* The socket descriptor returned by the sockets wrapper. */
+#define SOCKET_DESCRIPTOR      3
+
+/* Credentials for the TLS connection. */
+#define ROOT_CA_CERT_PATH      "fake/path.crt"
+#define CLIENT_CERT_PATH       "\\fake\\path.crt"
+#define PRIVATE_KEY_PATH       "/fake/path.key"
+
+/* Configuration parameters for the TLS connection. */
+#define MFLN                   1024
+#define INVALID_MFLN           42
+
+/* Parameters to pass to #Mbedtls_Send and #Mbedtls_Recv. */
+#define BYTES_TO_SEND          4
+#define BYTES_TO_RECV          4
+
+/* The size of the buffer passed to #Mbedtls_Send and #Mbedtls_Recv. */
+#define BUFFER_LEN             4
+
+/* An mbedTLS error that is not retried. */
+#define MBEDTLS_FATAL_ERROR    MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    MbedtlsParams_t * pParams;
+};
+
+/* Objects used by the mbedTLS transport implementation. */
+static ServerInfo_t serverInfo = { 0 };
+static MbedtlsCredentials_t mbedtlsCredentials = { 0 };
+static MbedtlsParams_t mbedtlsParams;
+static NetworkContext_t networkContext = { 0 };
+static uint8_t mbedtlsBuffer[ BUFFER_LEN ] = { 0 };
+static const char * alpnProtos[] = { "x-amzn-mqtt-ca", NULL };
+static int32_t socketDescriptor = SOCKET_DESCRIPTOR;
+
+/* The callbacks the transport gives mbedTLS to send and receive. */
+static mbedtls_ssl_send_t * pSendCallback = NULL;
+static mbedtls_ssl_recv_t * pRecvCallback = NULL;
+static void * pBioContext = NULL;
+
+/* Whether #Mbedtls_Connect is expected to offer and save a TLS session. */
+static bool sessionCached = false;
+
+/**
+ * @brief Functions called by #Mbedtls_Connect that can be made to fail.
+ */
+typedef enum FunctionNames
+{
+    Sockets_Connect_fn = 0,
+    mbedtls_ssl_config_defaults_fn,
+    parse_root_ca_fn,
+    parse_client_cert_fn,
+    mbedtls_pk_parse_keyfile_fn,
+    mbedtls_ssl_conf_own_cert_fn,
+    mbedtls_ssl_setup_fn,
+    mbedtls_ssl_handshake_fn,
+    mbedtls_ssl_get_session_fn,
+    no_function_fn
+} FunctionNames_t;
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/**
+ * @brief Capture the callbacks that the transport gives mbedTLS.
+ */
+static void captureBio( mbedtls_ssl_context * ssl,
+                        void * p_bio,
+                        mbedtls_ssl_send_t * f_send,
+                        mbedtls_ssl_recv_t * f_recv,
+                        mbedtls_ssl_recv_timeout_t * f_recv_timeout,
+                        int cmock_num_calls )
+{
+    ( void ) ssl;
+    ( void ) cmock_num_calls;
+
+    TEST_ASSERT_NULL( f_recv_timeout );
+
+    pBioContext = p_bio;
+    pSendCallback = f_send;
+    pRecvCallback = f_recv;
+}
+
+/* Called before each test method. */
+void setUp()
+{
+    serverInfo.pHostName = HOSTNAME;
+    serverInfo.hostNameLength = strlen( HOSTNAME );
+    serverInfo.port = PORT;
+
+    networkContext.pParams = &mbedtlsParams;
+
+    memset( &mbedtlsCredentials, 0, sizeof( MbedtlsCredentials_t ) );
+    mbedtlsCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+    mbedtlsCredentials.pClientCertPath = CLIENT_CERT_PATH;
+    mbedtlsCredentials.pPrivateKeyPath = PRIVATE_KEY_PATH;
+    mbedtlsCredentials.pAlpnProtos = alpnProtos;
+    mbedtlsCredentials.maxFragmentLength = MFLN;
+    mbedtlsCredentials.sniHostName = HOSTNAME;
+
+    sessionCached = false;
+    pSendCallback = NULL;
+    pRecvCallback = NULL;
+    pBioContext = NULL;
+
+    /* The random number generator is only seeded by the first connection. */
+    mbedtls_entropy_init_Ignore();
+    mbedtls_ctr_drbg_init_Ignore();
+    mbedtls_ctr_drbg_seed_IgnoreAndReturn( 0 );
+
+    /* These calls cannot fail. */
+    mbedtls_ssl_init_Ignore();
+    mbedtls_ssl_free_Ignore();
+    mbedtls_ssl_config_init_Ignore();
+    mbedtls_ssl_config_free_Ignore();
+    mbedtls_x509_crt_init_Ignore();
+    mbedtls_x509_crt_free_Ignore();
+    mbedtls_pk_init_Ignore();
+    mbedtls_pk_free_Ignore();
+    mbedtls_ssl_conf_authmode_Ignore();
+    mbedtls_ssl_conf_rng_Ignore();
+    mbedtls_ssl_conf_ca_chain_Ignore();
+    mbedtls_ssl_session_free_Ignore();
+    mbedtls_ssl_get_verify_result_IgnoreAndReturn( 0 );
+    mbedtls_ssl_set_bio_Stub( captureBio );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    /* Do not leave a session cached for the next test. */
+    ( void ) Mbedtls_ReleaseSession( &mbedtlsCredentials );
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Expect the calls of #Mbedtls_Connect up to a function to fail.
+ *
+ * @param[in] functionToFail The function called from #Mbedtls_Connect to
+ * fail. #no_function_fn to expect every call to succeed.
+ *
+ * @note If #sessionCached is set, a session is expected to be offered.
+ * Sessions are expected to be saved when
+ * #MbedtlsCredentials_t.cacheSession and
+ * #MbedtlsCredentials_t.sniHostName are set.
+ *
+ * @return The status #Mbedtls_Connect is expected to return.
+ */
+static MbedtlsStatus_t expectConnect( FunctionNames_t functionToFail )
+{
+    MbedtlsStatus_t returnStatus = MBEDTLS_POSIX_SUCCESS;
+    bool clientCredentials = ( mbedtlsCredentials.pClientCertPath != NULL ) &&
+                             ( mbedtlsCredentials.pPrivateKeyPath != NULL );
+
+    if( functionToFail == Sockets_Connect_fn )
+    {
+        Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_DNS_FAILURE );
+        returnStatus = MBEDTLS_POSIX_DNS_FAILURE;
+    }
+    else
+    {
+        Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+        Sockets_Connect_ReturnThruPtr_pTcpSocket( &socketDescriptor );
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        if( functionToFail == mbedtls_ssl_config_defaults_fn )
+        {
+            mbedtls_ssl_config_defaults_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+            returnStatus = MBEDTLS_POSIX_API_ERROR;
+        }
+        else
+        {
+            mbedtls_ssl_config_defaults_ExpectAndReturn( &mbedtlsParams.sslConfig,
+                                                         MBEDTLS_SSL_IS_CLIENT,
+                                                         MBEDTLS_SSL_TRANSPORT_STREAM,
+                                                         MBEDTLS_SSL_PRESET_DEFAULT,
+                                                         0 );
+        }
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        /* A positive count of certificates that failed to parse is accepted. */
+        mbedtls_x509_crt_parse_file_ExpectAndReturn( &mbedtlsParams.rootCa,
+                                                     ROOT_CA_CERT_PATH,
+                                                     ( functionToFail == parse_root_ca_fn ) ?
+                                                     MBEDTLS_ERR_X509_INVALID_FORMAT : 1 );
+
+        if( functionToFail == parse_root_ca_fn )
+        {
+            returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+        }
+    }
+
+    if( ( returnStatus == MBEDTLS_POSIX_SUCCESS ) && clientCredentials )
+    {
+        mbedtls_x509_crt_parse_file_ExpectAndReturn( &mbedtlsParams.clientCert,
+                                                     CLIENT_CERT_PATH,
+                                                     ( functionToFail == parse_client_cert_fn ) ?
+                                                     MBEDTLS_ERR_X509_INVALID_FORMAT : 0 );
+
+        if( functionToFail == parse_client_cert_fn )
+        {
+            returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+        }
+    }
+
+    if( ( returnStatus == MBEDTLS_POSIX_SUCCESS ) && clientCredentials )
+    {
+        mbedtls_pk_parse_keyfile_ExpectAndReturn( &mbedtlsParams.privateKey,
+                                                  PRIVATE_KEY_PATH,
+                                                  NULL,
+                                                  ( functionToFail == mbedtls_pk_parse_keyfile_fn ) ?
+                                                  MBEDTLS_ERR_PK_KEY_INVALID_FORMAT : 0 );
+
+        if( functionToFail == mbedtls_pk_parse_keyfile_fn )
+        {
+            returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+        }
+    }
+
+    if( ( returnStatus == MBEDTLS_POSIX_SUCCESS ) && clientCredentials )
+    {
+        mbedtls_ssl_conf_own_cert_ExpectAnyArgsAndReturn( ( functionToFail == mbedtls_ssl_conf_own_cert_fn ) ?
+                                                          MBEDTLS_ERR_SSL_ALLOC_FAILED : 0 );
+
+        if( functionToFail == mbedtls_ssl_conf_own_cert_fn )
+        {
+            returnStatus = MBEDTLS_POSIX_INVALID_CREDENTIALS;
+        }
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        mbedtls_ssl_setup_ExpectAnyArgsAndReturn( ( functionToFail == mbedtls_ssl_setup_fn ) ?
+                                                  MBEDTLS_ERR_SSL_ALLOC_FAILED : 0 );
+
+        if( functionToFail == mbedtls_ssl_setup_fn )
+        {
+            returnStatus = MBEDTLS_POSIX_INSUFFICIENT_MEMORY;
+        }
+    }
+
+    if( returnStatus == MBEDTLS_POSIX_SUCCESS )
+    {
+        if( mbedtlsCredentials.pAlpnProtos != NULL )
+        {
+            mbedtls_ssl_conf_alpn_protocols_ExpectAnyArgsAndReturn( 0 );
+        }
+
+        mbedtls_ssl_conf_max_frag_len_ExpectAnyArgsAndReturn( 0 );
+
+        if( mbedtlsCredentials.sniHostName != NULL )
+        {
+            mbedtls_ssl_set_hostname_ExpectAnyArgsAndReturn( 0 );
+        }
+
+        if( sessionCached )
+        {
+            mbedtls_ssl_set_session_ExpectAnyArgsAndReturn( 0 );
+        }
+
+        mbedtls_ssl_handshake_ExpectAnyArgsAndReturn( ( functionToFail == mbedtls_ssl_handshake_fn ) ?
+                                                      MBEDTLS_FATAL_ERROR : 0 );
+
+        if( functionToFail == mbedtls_ssl_handshake_fn )
+        {
+            returnStatus = MBEDTLS_POSIX_HANDSHAKE_FAILED;
+        }
+    }
+
+    if( ( returnStatus == MBEDTLS_POSIX_SUCCESS ) &&
+        mbedtlsCredentials.cacheSession &&
+        ( mbedtlsCredentials.sniHostName != NULL ) )
+    {
+        mbedtls_ssl_get_session_ExpectAnyArgsAndReturn( ( functionToFail == mbedtls_ssl_get_session_fn ) ?
+                                                        MBEDTLS_ERR_SSL_ALLOC_FAILED : 0 );
+    }
+
+    /* The TCP connection is closed if the TLS session could not be set up. */
+    if( ( returnStatus != MBEDTLS_POSIX_SUCCESS ) && ( functionToFail != Sockets_Connect_fn ) )
+    {
+        Sockets_Disconnect_ExpectAndReturn( SOCKET_DESCRIPTOR, SOCKETS_SUCCESS );
+    }
+
+    return returnStatus;
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect fails on NULL parameters and forwards the
+ * status of Sockets_Connect.
+ */
+void test_Mbedtls_Connect_Invalid_Params( void )
+{
+    MbedtlsStatus_t returnStatus, expectedStatus;
+
+    returnStatus = Mbedtls_Connect( NULL,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_INVALID_PARAMETER, returnStatus );
+
+    networkContext.pParams = NULL;
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_INVALID_PARAMETER, returnStatus );
+    networkContext.pParams = &mbedtlsParams;
+
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    NULL,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_INVALID_PARAMETER, returnStatus );
+
+    /* The root CA is required to verify the server. */
+    mbedtlsCredentials.pRootCaPath = NULL;
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_INVALID_PARAMETER, returnStatus );
+    mbedtlsCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+
+    /* Mock a DNS failure from the call to the sockets connect wrapper. */
+    expectedStatus = expectConnect( Sockets_Connect_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect returns an error and closes the TCP
+ * connection when setting up the TLS session or the handshake fails.
+ */
+void test_Mbedtls_Connect_Fails( void )
+{
+    MbedtlsStatus_t returnStatus, expectedStatus;
+    FunctionNames_t functionsToFail[] =
+    {
+        mbedtls_ssl_config_defaults_fn, parse_root_ca_fn,
+        parse_client_cert_fn,           mbedtls_pk_parse_keyfile_fn,
+        mbedtls_ssl_conf_own_cert_fn,   mbedtls_ssl_setup_fn,
+        mbedtls_ssl_handshake_fn
+    };
+    uint16_t i;
+
+    for( i = 0; i < sizeof( functionsToFail ) / sizeof( FunctionNames_t ); i++ )
+    {
+        expectedStatus = expectConnect( functionsToFail[ i ] );
+        returnStatus = Mbedtls_Connect( &networkContext,
+                                        &serverInfo,
+                                        &mbedtlsCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+        TEST_ASSERT_NOT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+        TEST_ASSERT_EQUAL( -1, mbedtlsParams.socketDescriptor );
+    }
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect establishes a TLS session and gives
+ * mbedTLS the socket of the connection.
+ */
+void test_Mbedtls_Connect_Succeeds( void )
+{
+    MbedtlsStatus_t returnStatus;
+
+    ( void ) expectConnect( no_function_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+    TEST_ASSERT_EQUAL( SOCKET_DESCRIPTOR, mbedtlsParams.socketDescriptor );
+    TEST_ASSERT_EQUAL_PTR( &mbedtlsParams.socketDescriptor, pBioContext );
+    TEST_ASSERT_NOT_NULL( pSendCallback );
+    TEST_ASSERT_NOT_NULL( pRecvCallback );
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect skips the optional configurations and the
+ * client credentials that are not set.
+ */
+void test_Mbedtls_Connect_NULL_Members_In_Creds( void )
+{
+    MbedtlsStatus_t returnStatus;
+
+    mbedtlsCredentials.pClientCertPath = NULL;
+    mbedtlsCredentials.pPrivateKeyPath = NULL;
+    mbedtlsCredentials.pAlpnProtos = NULL;
+    mbedtlsCredentials.sniHostName = NULL;
+
+    ( void ) expectConnect( no_function_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect negotiates the maximum fragment length
+ * of the credentials, or the default one, and connects when mbedTLS does not
+ * support the length.
+ */
+void test_Mbedtls_Connect_Max_Fragment_Length( void )
+{
+    MbedtlsStatus_t returnStatus;
+    uint16_t lengths[] = { MFLN, 0U, INVALID_MFLN };
+    unsigned char codes[] =
+    {
+        MBEDTLS_SSL_MAX_FRAG_LEN_1024,
+        MBEDTLS_SSL_MAX_FRAG_LEN_4096,
+        MBEDTLS_SSL_MAX_FRAG_LEN_INVALID
+    };
+    uint16_t i;
+
+    mbedtlsCredentials.pClientCertPath = NULL;
+    mbedtlsCredentials.pAlpnProtos = NULL;
+    mbedtlsCredentials.sniHostName = NULL;
+
+    for( i = 0; i < sizeof( lengths ) / sizeof( uint16_t ); i++ )
+    {
+        mbedtlsCredentials.maxFragmentLength = lengths[ i ];
+
+        Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+        mbedtls_ssl_config_defaults_ExpectAnyArgsAndReturn( 0 );
+        mbedtls_x509_crt_parse_file_ExpectAnyArgsAndReturn( 0 );
+        mbedtls_ssl_setup_ExpectAnyArgsAndReturn( 0 );
+        mbedtls_ssl_conf_max_frag_len_ExpectAndReturn( &mbedtlsParams.sslConfig,
+                                                       codes[ i ],
+                                                       ( codes[ i ] == MBEDTLS_SSL_MAX_FRAG_LEN_INVALID ) ?
+                                                       MBEDTLS_ERR_SSL_BAD_INPUT_DATA : 0 );
+        mbedtls_ssl_handshake_ExpectAnyArgsAndReturn( 0 );
+
+        returnStatus = Mbedtls_Connect( &networkContext,
+                                        &serverInfo,
+                                        &mbedtlsCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+    }
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect performs the handshake again when it was
+ * interrupted by a signal.
+ */
+void test_Mbedtls_Connect_Retries_Interrupted_Handshake( void )
+{
+    MbedtlsStatus_t returnStatus;
+
+    mbedtlsCredentials.pClientCertPath = NULL;
+    mbedtlsCredentials.pAlpnProtos = NULL;
+    mbedtlsCredentials.sniHostName = NULL;
+
+    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    mbedtls_ssl_config_defaults_ExpectAnyArgsAndReturn( 0 );
+    mbedtls_x509_crt_parse_file_ExpectAnyArgsAndReturn( 0 );
+    mbedtls_ssl_setup_ExpectAnyArgsAndReturn( 0 );
+    mbedtls_ssl_conf_max_frag_len_ExpectAnyArgsAndReturn( 0 );
+    mbedtls_ssl_handshake_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_WANT_READ );
+    mbedtls_ssl_handshake_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_WANT_WRITE );
+    mbedtls_ssl_handshake_ExpectAnyArgsAndReturn( 0 );
+
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect offers the session saved by the previous
+ * connection to the host, until it is released.
+ */
+void test_Mbedtls_Connect_Resumes_Cached_Session( void )
+{
+    MbedtlsStatus_t returnStatus;
+
+    mbedtlsCredentials.cacheSession = true;
+
+    /* The first connection has no session to offer, and saves its own. */
+    ( void ) expectConnect( no_function_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+
+    /* The next connection offers it. */
+    sessionCached = true;
+    ( void ) expectConnect( no_function_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+
+    /* A released session is not offered. */
+    returnStatus = Mbedtls_ReleaseSession( &mbedtlsCredentials );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+
+    sessionCached = false;
+    ( void ) expectConnect( no_function_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Mbedtls_Connect does not offer a session that mbedTLS
+ * failed to copy, and that sessions are only cached with SNI.
+ */
+void test_Mbedtls_Connect_Does_Not_Cache_Failed_Session( void )
+{
+    MbedtlsStatus_t returnStatus;
+
+    mbedtlsCredentials.cacheSession = true;
+
+    ( void ) expectConnect( mbedtls_ssl_get_session_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+
+    /* Without SNI, no session is offered or saved. */
+    mbedtlsCredentials.sniHostName = NULL;
+    ( void ) expectConnect( no_function_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+
+    /* The failed session is not offered to the host. */
+    mbedtlsCredentials.sniHostName = HOSTNAME;
+    ( void ) expectConnect( no_function_fn );
+    returnStatus = Mbedtls_Connect( &networkContext,
+                                    &serverInfo,
+                                    &mbedtlsCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Mbedtls_ReleaseSession fails on NULL credentials.
+ */
+void test_Mbedtls_ReleaseSession_Invalid_Params( void )
+{
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_INVALID_PARAMETER, Mbedtls_ReleaseSession( NULL ) );
+
+    /* Nothing is cached without SNI. */
+    mbedtlsCredentials.sniHostName = NULL;
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, Mbedtls_ReleaseSession( &mbedtlsCredentials ) );
+}
+
+/**
+ * @brief Test that the send callback given to mbedTLS maps the errors of
+ * send to the errors mbedTLS retries.
+ */
+void test_Mbedtls_Send_Callback( void )
+{
+    ( void ) expectConnect( no_function_fn );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS,
+                       Mbedtls_Connect( &networkContext,
+                                        &serverInfo,
+                                        &mbedtlsCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT ) );
+    TEST_ASSERT_NOT_NULL( pSendCallback );
+
+    send_ExpectAndReturn( SOCKET_DESCRIPTOR, mbedtlsBuffer, BYTES_TO_SEND, MSG_NOSIGNAL, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, pSendCallback( pBioContext, mbedtlsBuffer, BYTES_TO_SEND ) );
+
+    errno = EAGAIN;
+    send_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( MBEDTLS_ERR_SSL_TIMEOUT, pSendCallback( pBioContext, mbedtlsBuffer, BYTES_TO_SEND ) );
+
+    errno = EINTR;
+    send_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( MBEDTLS_ERR_SSL_WANT_WRITE, pSendCallback( pBioContext, mbedtlsBuffer, BYTES_TO_SEND ) );
+
+    errno = EPIPE;
+    send_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( MBEDTLS_ERR_NET_SEND_FAILED, pSendCallback( pBioContext, mbedtlsBuffer, BYTES_TO_SEND ) );
+}
+
+/**
+ * @brief Test that the receive callback given to mbedTLS maps the errors of
+ * recv to the errors mbedTLS retries, and reports a closed connection.
+ */
+void test_Mbedtls_Recv_Callback( void )
+{
+    ( void ) expectConnect( no_function_fn );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS,
+                       Mbedtls_Connect( &networkContext,
+                                        &serverInfo,
+                                        &mbedtlsCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT ) );
+    TEST_ASSERT_NOT_NULL( pRecvCallback );
+
+    recv_ExpectAndReturn( SOCKET_DESCRIPTOR, mbedtlsBuffer, BYTES_TO_RECV, 0, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, pRecvCallback( pBioContext, mbedtlsBuffer, BYTES_TO_RECV ) );
+
+    recv_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( 0, pRecvCallback( pBioContext, mbedtlsBuffer, BYTES_TO_RECV ) );
+
+    errno = EWOULDBLOCK;
+    recv_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( MBEDTLS_ERR_SSL_TIMEOUT, pRecvCallback( pBioContext, mbedtlsBuffer, BYTES_TO_RECV ) );
+
+    errno = EINTR;
+    recv_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( MBEDTLS_ERR_SSL_WANT_READ, pRecvCallback( pBioContext, mbedtlsBuffer, BYTES_TO_RECV ) );
+
+    errno = ECONNRESET;
+    recv_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_EQUAL( MBEDTLS_ERR_NET_RECV_FAILED, pRecvCallback( pBioContext, mbedtlsBuffer, BYTES_TO_RECV ) );
+}
+
+/**
+ * @brief Test that #Mbedtls_Disconnect fails on a NULL network context.
+ */
+void test_Mbedtls_Disconnect_NULL_Network_Context( void )
+{
+    MbedtlsStatus_t returnStatus;
+
+    returnStatus = Mbedtls_Disconnect( NULL );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_INVALID_PARAMETER, returnStatus );
+
+    networkContext.pParams = NULL;
+    returnStatus = Mbedtls_Disconnect( &networkContext );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_INVALID_PARAMETER, returnStatus );
+}
+
+/**
+ * @brief Test that #Mbedtls_Disconnect notifies the server and closes the
+ * socket, even if the notification fails.
+ */
+void test_Mbedtls_Disconnect_Succeeds( void )
+{
+    MbedtlsStatus_t returnStatus;
+
+    mbedtlsParams.socketDescriptor = SOCKET_DESCRIPTOR;
+
+    mbedtls_ssl_close_notify_ExpectAndReturn( &mbedtlsParams.sslContext, 0 );
+    Sockets_Disconnect_ExpectAndReturn( SOCKET_DESCRIPTOR, SOCKETS_SUCCESS );
+    returnStatus = Mbedtls_Disconnect( &networkContext );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+
+    mbedtls_ssl_close_notify_ExpectAnyArgsAndReturn( MBEDTLS_ERR_NET_SEND_FAILED );
+    Sockets_Disconnect_ExpectAndReturn( SOCKET_DESCRIPTOR, SOCKETS_SUCCESS );
+    returnStatus = Mbedtls_Disconnect( &networkContext );
+    TEST_ASSERT_EQUAL( MBEDTLS_POSIX_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Mbedtls_Send fails on a NULL network context.
+ */
+void test_Mbedtls_Send_Invalid_Params( void )
+{
+    int32_t bytesSent;
+
+    bytesSent = Mbedtls_Send( NULL, mbedtlsBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    networkContext.pParams = NULL;
+    bytesSent = Mbedtls_Send( &networkContext, mbedtlsBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+}
+
+/**
+ * @brief Test that #Mbedtls_Send returns the bytes written by
+ * #mbedtls_ssl_write, zero when the write can be retried, and a negative
+ * value otherwise.
+ */
+void test_Mbedtls_Send( void )
+{
+    int32_t bytesSent;
+
+    mbedtls_ssl_write_ExpectAndReturn( &mbedtlsParams.sslContext, mbedtlsBuffer, BYTES_TO_SEND, BYTES_TO_SEND );
+    bytesSent = Mbedtls_Send( &networkContext, mbedtlsBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    mbedtls_ssl_write_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_TIMEOUT );
+    bytesSent = Mbedtls_Send( &networkContext, mbedtlsBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    mbedtls_ssl_write_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_WANT_WRITE );
+    bytesSent = Mbedtls_Send( &networkContext, mbedtlsBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    mbedtls_ssl_write_ExpectAnyArgsAndReturn( MBEDTLS_ERR_NET_SEND_FAILED );
+    bytesSent = Mbedtls_Send( &networkContext, mbedtlsBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+}
+
+/**
+ * @brief Test that #Mbedtls_Recv fails on a NULL network context.
+ */
+void test_Mbedtls_Recv_Invalid_Params( void )
+{
+    int32_t bytesReceived;
+
+    bytesReceived = Mbedtls_Recv( NULL, mbedtlsBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+    networkContext.pParams = NULL;
+    bytesReceived = Mbedtls_Recv( &networkContext, mbedtlsBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+}
+
+/**
+ * @brief Test that #Mbedtls_Recv returns the bytes read by #mbedtls_ssl_read,
+ * zero when no data arrived before the timeout, and a negative value when
+ * the connection is closed or fails.
+ */
+void test_Mbedtls_Recv( void )
+{
+    int32_t bytesReceived;
+
+    mbedtls_ssl_read_ExpectAndReturn( &mbedtlsParams.sslContext, mbedtlsBuffer, BYTES_TO_RECV, BYTES_TO_RECV );
+    bytesReceived = Mbedtls_Recv( &networkContext, mbedtlsBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+
+    mbedtls_ssl_read_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_TIMEOUT );
+    bytesReceived = Mbedtls_Recv( &networkContext, mbedtlsBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+    mbedtls_ssl_read_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_WANT_READ );
+    bytesReceived = Mbedtls_Recv( &networkContext, mbedtlsBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+    mbedtls_ssl_read_ExpectAnyArgsAndReturn( MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY );
+    bytesReceived = Mbedtls_Recv( &networkContext, mbedtlsBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( -1, bytesReceived );
+
+    /* mbedtls_ssl_read returns zero when the server closed the socket. */
+    mbedtls_ssl_read_ExpectAnyArgsAndReturn( 0 );
+    bytesReceived = Mbedtls_Recv( &networkContext, mbedtlsBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( -1, bytesReceived );
+}
@@ -0,0 +1,317 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "memory_transport_posix.h"
+
+/* Size of the ring of each direction. */
+#define RING_SIZE    ( 16U )
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    MemoryTransportParams_t * pParams;
+};
+
+static MemoryTransportPair_t pair;
+static uint8_t clientBuffer[ RING_SIZE ];
+static uint8_t serverBuffer[ RING_SIZE ];
+static MemoryTransportParams_t clientParams;
+static MemoryTransportParams_t serverParams;
+static NetworkContext_t clientContext;
+static NetworkContext_t serverContext;
+
+/* Time returned by #getFakeTimeUs. */
+static uint64_t fakeTimeUs;
+
+/* Data sent and received by the tests. */
+static const uint8_t sentData[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static uint8_t receivedData[ sizeof( sentData ) ];
+
+/**
+ * @brief Clock of the simulation controlled by the tests.
+ */
+static uint64_t getFakeTimeUs( void )
+{
+    return fakeTimeUs;
+}
+
+/**
+ * @brief Set the conditions of the data sent by the client.
+ */
+static void setClientLink( uint32_t latencyUs,
+                           uint64_t bytesPerSecond,
+                           size_t maxFragmentLength )
+{
+    MemoryTransportLink_t link;
+
+    link.latencyUs = latencyUs;
+    link.bytesPerSecond = bytesPerSecond;
+    link.maxFragmentLength = maxFragmentLength;
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_SUCCESS,
+                       MemoryTransport_SetLink( &pair, MEMORY_TRANSPORT_CLIENT, &link ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    fakeTimeUs = 1000U;
+    memset( receivedData, 0, sizeof( receivedData ) );
+    memset( &clientParams, 0, sizeof( clientParams ) );
+    memset( &serverParams, 0, sizeof( serverParams ) );
+    clientContext.pParams = &clientParams;
+    serverContext.pParams = &serverParams;
+
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_SUCCESS,
+                       MemoryTransport_Init( &pair, clientBuffer, serverBuffer, RING_SIZE ) );
+    pair.getTimeUs = getFakeTimeUs;
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_SUCCESS,
+                       MemoryTransport_Connect( &clientContext, &pair, MEMORY_TRANSPORT_CLIENT ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_SUCCESS,
+                       MemoryTransport_Connect( &serverContext, &pair, MEMORY_TRANSPORT_SERVER ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that invalid parameters are rejected.
+ */
+void test_MemoryTransport_Invalid_Params( void )
+{
+    MemoryTransportLink_t link = { 0 };
+    NetworkContext_t unconnectedContext = { 0 };
+
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Init( NULL, clientBuffer, serverBuffer, RING_SIZE ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Init( &pair, NULL, serverBuffer, RING_SIZE ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Init( &pair, clientBuffer, NULL, RING_SIZE ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Init( &pair, clientBuffer, serverBuffer, 0U ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Init( &pair, clientBuffer, serverBuffer, RING_SIZE - 1U ) );
+
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_SetLink( NULL, MEMORY_TRANSPORT_CLIENT, &link ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_SetLink( &pair, MEMORY_TRANSPORT_CLIENT, NULL ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_SetLink( &pair, ( MemoryTransportEndpoint_t ) 2, &link ) );
+
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Connect( NULL, &pair, MEMORY_TRANSPORT_CLIENT ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Connect( &unconnectedContext, &pair, MEMORY_TRANSPORT_CLIENT ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Connect( &clientContext, NULL, MEMORY_TRANSPORT_CLIENT ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER,
+                       MemoryTransport_Connect( &clientContext, &pair, ( MemoryTransportEndpoint_t ) 2 ) );
+
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER, MemoryTransport_Disconnect( NULL ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_INVALID_PARAMETER, MemoryTransport_Disconnect( &unconnectedContext ) );
+
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Send( NULL, sentData, 1U ) );
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Send( &clientContext, NULL, 1U ) );
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Recv( NULL, receivedData, 1U ) );
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Recv( &serverContext, NULL, 1U ) );
+}
+
+/**
+ * @brief Test that data sent by each endpoint is received by the other in
+ * order, across the end of the ring.
+ */
+void test_MemoryTransport_Send_Recv_Both_Directions( void )
+{
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+
+    TEST_ASSERT_EQUAL( 10, MemoryTransport_Send( &clientContext, sentData, 10U ) );
+    TEST_ASSERT_EQUAL( 10, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, 10U );
+
+    /* The next send wraps at the end of the ring. */
+    TEST_ASSERT_EQUAL( 12, MemoryTransport_Send( &clientContext, &sentData[ 10 ], 12U ) );
+    TEST_ASSERT_EQUAL( 5, MemoryTransport_Recv( &serverContext, receivedData, 5U ) );
+    TEST_ASSERT_EQUAL( 7, MemoryTransport_Recv( &serverContext, &receivedData[ 5 ], sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( &sentData[ 10 ], receivedData, 12U );
+
+    /* The client does not receive its own data. */
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Recv( &clientContext, receivedData, sizeof( receivedData ) ) );
+
+    TEST_ASSERT_EQUAL( 3, MemoryTransport_Send( &serverContext, sentData, 3U ) );
+    TEST_ASSERT_EQUAL( 3, MemoryTransport_Recv( &clientContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, 3U );
+}
+
+/**
+ * @brief Test that a send only copies what the ring has room for.
+ */
+void test_MemoryTransport_Send_Full_Ring( void )
+{
+    TEST_ASSERT_EQUAL( RING_SIZE, MemoryTransport_Send( &clientContext, sentData, sizeof( sentData ) ) );
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Send( &clientContext, sentData, 1U ) );
+
+    TEST_ASSERT_EQUAL( 4, MemoryTransport_Recv( &serverContext, receivedData, 4U ) );
+    TEST_ASSERT_EQUAL( 4, MemoryTransport_Send( &clientContext, &sentData[ RING_SIZE ], 8U ) );
+
+    TEST_ASSERT_EQUAL( RING_SIZE, MemoryTransport_Recv( &serverContext, &receivedData[ 4 ], sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, RING_SIZE + 4U );
+}
+
+/**
+ * @brief Test that receives return at most the fragment length of the link.
+ */
+void test_MemoryTransport_Recv_Fragments( void )
+{
+    setClientLink( 0U, 0U, 3U );
+
+    TEST_ASSERT_EQUAL( 8, MemoryTransport_Send( &clientContext, sentData, 8U ) );
+    TEST_ASSERT_EQUAL( 3, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL( 2, MemoryTransport_Recv( &serverContext, &receivedData[ 3 ], 2U ) );
+    TEST_ASSERT_EQUAL( 3, MemoryTransport_Recv( &serverContext, &receivedData[ 5 ], sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, 8U );
+}
+
+/**
+ * @brief Test that the data of a send is received once the latency of the
+ * link elapsed.
+ */
+void test_MemoryTransport_Latency( void )
+{
+    setClientLink( 500U, 0U, 0U );
+
+    TEST_ASSERT_EQUAL( 4, MemoryTransport_Send( &clientContext, sentData, 4U ) );
+    fakeTimeUs += 200U;
+    TEST_ASSERT_EQUAL( 3, MemoryTransport_Send( &clientContext, &sentData[ 4 ], 3U ) );
+
+    fakeTimeUs += 299U;
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+
+    /* Only the first send is due. */
+    fakeTimeUs += 1U;
+    TEST_ASSERT_EQUAL( 4, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Recv( &serverContext, &receivedData[ 4 ], sizeof( receivedData ) ) );
+
+    fakeTimeUs += 200U;
+    TEST_ASSERT_EQUAL( 3, MemoryTransport_Recv( &serverContext, &receivedData[ 4 ], sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, 7U );
+
+    /* The other direction has no latency. */
+    TEST_ASSERT_EQUAL( 2, MemoryTransport_Send( &serverContext, sentData, 2U ) );
+    TEST_ASSERT_EQUAL( 2, MemoryTransport_Recv( &clientContext, receivedData, sizeof( receivedData ) ) );
+}
+
+/**
+ * @brief Test that sends queue behind each other on a link with a bandwidth
+ * limit.
+ */
+void test_MemoryTransport_Bandwidth( void )
+{
+    /* 1 byte every 10 microseconds, and 5 microseconds of latency. */
+    setClientLink( 5U, 100000U, 0U );
+
+    TEST_ASSERT_EQUAL( 4, MemoryTransport_Send( &clientContext, sentData, 4U ) );
+    TEST_ASSERT_EQUAL( 2, MemoryTransport_Send( &clientContext, &sentData[ 4 ], 2U ) );
+
+    /* The first send is carried by 40 microseconds, the second by 60. */
+    fakeTimeUs += 44U;
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    fakeTimeUs += 1U;
+    TEST_ASSERT_EQUAL( 4, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    fakeTimeUs += 19U;
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Recv( &serverContext, &receivedData[ 4 ], sizeof( receivedData ) ) );
+    fakeTimeUs += 1U;
+    TEST_ASSERT_EQUAL( 2, MemoryTransport_Recv( &serverContext, &receivedData[ 4 ], sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, 6U );
+
+    /* An idle link carries a new send right away. */
+    fakeTimeUs += 1000U;
+    TEST_ASSERT_EQUAL( 1, MemoryTransport_Send( &clientContext, sentData, 1U ) );
+    fakeTimeUs += 15U;
+    TEST_ASSERT_EQUAL( 1, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+}
+
+/**
+ * @brief Test that a send returns 0 while the link holds back the largest
+ * number of sends.
+ */
+void test_MemoryTransport_Max_Pending_Sends( void )
+{
+    uint32_t i;
+
+    setClientLink( 100U, 0U, 0U );
+
+    /* A ring of 16 bytes holds at most 16 sends of a byte. */
+    for( i = 0U; ( i < MEMORY_TRANSPORT_MAX_PENDING_SENDS ) && ( i < RING_SIZE ); i++ )
+    {
+        TEST_ASSERT_EQUAL( 1, MemoryTransport_Send( &clientContext, &sentData[ i ], 1U ) );
+    }
+
+    TEST_ASSERT_EQUAL( 0, MemoryTransport_Send( &clientContext, sentData, 1U ) );
+
+    fakeTimeUs += 100U;
+    TEST_ASSERT_EQUAL( i, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, i );
+    TEST_ASSERT_EQUAL( 1, MemoryTransport_Send( &clientContext, sentData, 1U ) );
+}
+
+/**
+ * @brief Test that the data sent before a disconnect is still received, after
+ * which both endpoints fail.
+ */
+void test_MemoryTransport_Disconnect( void )
+{
+    TEST_ASSERT_EQUAL( 5, MemoryTransport_Send( &clientContext, sentData, 5U ) );
+    TEST_ASSERT_EQUAL( MEMORY_TRANSPORT_SUCCESS, MemoryTransport_Disconnect( &clientContext ) );
+
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Send( &clientContext, sentData, 1U ) );
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Send( &serverContext, sentData, 1U ) );
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Recv( &clientContext, receivedData, sizeof( receivedData ) ) );
+
+    TEST_ASSERT_EQUAL( 5, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( sentData, receivedData, 5U );
+    TEST_ASSERT_EQUAL( -1, MemoryTransport_Recv( &serverContext, receivedData, sizeof( receivedData ) ) );
+}
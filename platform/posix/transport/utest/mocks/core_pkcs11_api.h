@@ -0,0 +1,46 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file core_pkcs11_api.h
+ * @brief This file is used to generate mocks for the corePKCS11 functions
+ * used by the OpenSSL transport to reach a PKCS #11 token. Mocking
+ * core_pkcs11.h itself causes errors from parsing the macros of pkcs11.h.
+ */
+
+#ifndef CORE_PKCS11_API_H_
+#define CORE_PKCS11_API_H_
+
+#include "core_pkcs11.h"
+
+extern CK_RV C_GetFunctionList( CK_FUNCTION_LIST_PTR * ppFunctionList );
+
+extern CK_RV xInitializePkcs11Session( CK_SESSION_HANDLE * pxSession );
+
+extern CK_RV xFindObjectWithLabelAndClass( CK_SESSION_HANDLE xSession,
+                                           char * pcLabelName,
+                                           CK_ULONG ulLabelNameLen,
+                                           CK_OBJECT_CLASS xClass,
+                                           CK_OBJECT_HANDLE * pxHandle );
+
+#endif /* ifndef CORE_PKCS11_API_H_ */
@@ -21,20 +21,18 @@
  */
 
 /**
- * @file select_api.h
- * @brief This file is used to generate mocks for functions used from <sys/select.h>.
- * Mocking select.h itself causes several errors from parsing its macros.
+ * @file fcntl_api.h
+ * @brief This file is used to generate mocks for functions used from <fcntl.h>.
+ * Mocking fcntl.h itself causes several errors from parsing its macros.
  */
 
-#ifndef SELECT_API_H_
-#define SELECT_API_H_
+#ifndef FCNTL_API_H_
+#define FCNTL_API_H_
 
-#include <sys/select.h>
+#include <fcntl.h>
 
-extern int select( int nfds,
-                   fd_set * readfds,
-                   fd_set * writefds,
-                   fd_set * exceptfds,
-                   struct timeval * timeout );
+extern int fcntl( int __fd,
+                  int __cmd,
+                  ... );
 
-#endif /* ifndef SELECT_API_H_ */
+#endif /* ifndef FCNTL_API_H_ */
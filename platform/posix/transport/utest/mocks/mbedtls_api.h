@@ -0,0 +1,140 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MBEDTLS_API_H_
+#define MBEDTLS_API_H_
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+
+/**
+ * @file mbedtls_api.h
+ * @brief This file is used to generate mocks for the mbedTLS API's used in
+ * the abstraction layer. Mocking the mbedTLS headers themselves causes
+ * errors from parsing their macros.
+ */
+
+extern void mbedtls_entropy_init( mbedtls_entropy_context * ctx );
+
+extern int mbedtls_entropy_func( void * data,
+                                 unsigned char * output,
+                                 size_t len );
+
+extern void mbedtls_ctr_drbg_init( mbedtls_ctr_drbg_context * ctx );
+
+extern int mbedtls_ctr_drbg_seed( mbedtls_ctr_drbg_context * ctx,
+                                  int ( * f_entropy )( void *, unsigned char *, size_t ),
+                                  void * p_entropy,
+                                  const unsigned char * custom,
+                                  size_t len );
+
+extern int mbedtls_ctr_drbg_random( void * p_rng,
+                                    unsigned char * output,
+                                    size_t output_len );
+
+extern void mbedtls_ssl_init( mbedtls_ssl_context * ssl );
+
+extern void mbedtls_ssl_free( mbedtls_ssl_context * ssl );
+
+extern void mbedtls_ssl_config_init( mbedtls_ssl_config * conf );
+
+extern void mbedtls_ssl_config_free( mbedtls_ssl_config * conf );
+
+extern void mbedtls_x509_crt_init( mbedtls_x509_crt * crt );
+
+extern void mbedtls_x509_crt_free( mbedtls_x509_crt * crt );
+
+extern void mbedtls_pk_init( mbedtls_pk_context * ctx );
+
+extern void mbedtls_pk_free( mbedtls_pk_context * ctx );
+
+extern int mbedtls_ssl_config_defaults( mbedtls_ssl_config * conf,
+                                        int endpoint,
+                                        int transport,
+                                        int preset );
+
+extern void mbedtls_ssl_conf_authmode( mbedtls_ssl_config * conf,
+                                       int authmode );
+
+extern void mbedtls_ssl_conf_rng( mbedtls_ssl_config * conf,
+                                  int ( * f_rng )( void *, unsigned char *, size_t ),
+                                  void * p_rng );
+
+extern int mbedtls_x509_crt_parse_file( mbedtls_x509_crt * chain,
+                                        const char * path );
+
+extern int mbedtls_pk_parse_keyfile( mbedtls_pk_context * ctx,
+                                     const char * path,
+                                     const char * password );
+
+extern void mbedtls_ssl_conf_ca_chain( mbedtls_ssl_config * conf,
+                                       mbedtls_x509_crt * ca_chain,
+                                       mbedtls_x509_crl * ca_crl );
+
+extern int mbedtls_ssl_conf_own_cert( mbedtls_ssl_config * conf,
+                                      mbedtls_x509_crt * own_cert,
+                                      mbedtls_pk_context * pk_key );
+
+extern int mbedtls_ssl_conf_alpn_protocols( mbedtls_ssl_config * conf,
+                                            const char ** protos );
+
+extern int mbedtls_ssl_conf_max_frag_len( mbedtls_ssl_config * conf,
+                                          unsigned char mfl_code );
+
+extern int mbedtls_ssl_setup( mbedtls_ssl_context * ssl,
+                              const mbedtls_ssl_config * conf );
+
+extern int mbedtls_ssl_set_hostname( mbedtls_ssl_context * ssl,
+                                     const char * hostname );
+
+extern void mbedtls_ssl_set_bio( mbedtls_ssl_context * ssl,
+                                 void * p_bio,
+                                 mbedtls_ssl_send_t * f_send,
+                                 mbedtls_ssl_recv_t * f_recv,
+                                 mbedtls_ssl_recv_timeout_t * f_recv_timeout );
+
+extern int mbedtls_ssl_set_session( mbedtls_ssl_context * ssl,
+                                    const mbedtls_ssl_session * session );
+
+extern int mbedtls_ssl_get_session( const mbedtls_ssl_context * ssl,
+                                    mbedtls_ssl_session * session );
+
+extern void mbedtls_ssl_session_free( mbedtls_ssl_session * session );
+
+extern int mbedtls_ssl_handshake( mbedtls_ssl_context * ssl );
+
+extern uint32_t mbedtls_ssl_get_verify_result( const mbedtls_ssl_context * ssl );
+
+extern int mbedtls_ssl_read( mbedtls_ssl_context * ssl,
+                             unsigned char * buf,
+                             size_t len );
+
+extern int mbedtls_ssl_write( mbedtls_ssl_context * ssl,
+                              const unsigned char * buf,
+                              size_t len );
+
+extern int mbedtls_ssl_close_notify( mbedtls_ssl_context * ssl );
+
+#endif /* ifndef MBEDTLS_API_H_ */
@@ -24,6 +24,8 @@
 #define OPENSSL_API_H_
 
 #include <openssl/ssl.h>
+#include <openssl/ocsp.h>
+#include <openssl/ec.h>
 
 /**
  * @file openssl_api.h
@@ -59,6 +61,105 @@ struct ssl_method_st
     int filler;
 };
 
+struct ssl_session_st
+{
+    int filler;
+};
+
+struct bio_st
+{
+    int filler;
+};
+
+struct stack_st_X509
+{
+    int filler;
+};
+
+struct stack_st
+{
+    int filler;
+};
+
+struct evp_md_st
+{
+    int filler;
+};
+
+struct x509_store_ctx_st
+{
+    int filler;
+};
+
+struct X509_VERIFY_PARAM_st
+{
+    int filler;
+};
+
+struct ocsp_response_st
+{
+    int filler;
+};
+
+struct ocsp_basic_response_st
+{
+    int filler;
+};
+
+struct ocsp_cert_id_st
+{
+    int filler;
+};
+
+struct evp_pkey_st
+{
+    int filler;
+};
+
+struct ec_key_st
+{
+    int filler;
+};
+
+struct ec_key_method_st
+{
+    int filler;
+};
+
+struct ECDSA_SIG_st
+{
+    int filler;
+};
+
+struct bignum_st
+{
+    int filler;
+};
+
+typedef int ( * NewSessionCallback_t )( SSL * ssl,
+                                        SSL_SESSION * session );
+
+/* Sign functions of an EC_KEY_METHOD. */
+typedef int ( * EcKeySign_t )( int type,
+                               const unsigned char * dgst,
+                               int dlen,
+                               unsigned char * sig,
+                               unsigned int * siglen,
+                               const BIGNUM * kinv,
+                               const BIGNUM * r,
+                               EC_KEY * eckey );
+
+typedef int ( * EcKeySignSetup_t )( EC_KEY * eckey,
+                                    BN_CTX * ctx_in,
+                                    BIGNUM ** kinvp,
+                                    BIGNUM ** rp );
+
+typedef ECDSA_SIG * ( * EcKeySignSig_t )( const unsigned char * dgst,
+                                          int dgst_len,
+                                          const BIGNUM * in_kinv,
+                                          const BIGNUM * in_r,
+                                          EC_KEY * eckey );
+
 /* The functions prototypes below are used by CMock to generate mocks
  * for any OpenSSL API calls used by the OpenSSL transport wrapper.
  *
@@ -73,6 +174,10 @@ X509 * PEM_read_X509( FILE * fp,
                       pem_password_cb * cb,
                       void * u );
 
+extern X509 * d2i_X509( X509 ** a,
+                        const unsigned char ** in,
+                        long len );
+
 extern X509_STORE * SSL_CTX_get_cert_store( const SSL_CTX * ctx );
 
 extern int SSL_CTX_use_certificate_chain_file( SSL_CTX * ctx,
@@ -116,8 +221,197 @@ extern long SSL_get_verify_result( const SSL * ssl );
 
 extern void SSL_CTX_free( SSL_CTX * );
 
+extern int SSL_CTX_up_ref( SSL_CTX * ctx );
+
 extern void SSL_free( SSL * ssl );
 
+extern void SSL_CTX_sess_set_new_cb( SSL_CTX * ctx,
+                                     NewSessionCallback_t new_session_cb );
+
+extern int SSL_set_ex_data( SSL * ssl,
+                            int idx,
+                            void * data );
+
+extern void * SSL_get_ex_data( const SSL * ssl,
+                               int idx );
+
+extern int SSL_set_session( SSL * to,
+                            SSL_SESSION * session );
+
+extern const char * SSL_SESSION_get0_hostname( const SSL_SESSION * s );
+
+extern void SSL_SESSION_free( SSL_SESSION * ses );
+
+extern SSL_SESSION * SSL_get_session( const SSL * ssl );
+
+extern uint32_t SSL_SESSION_get_max_early_data( const SSL_SESSION * s );
+
+extern int SSL_write_early_data( SSL * s,
+                                 const void * buf,
+                                 size_t num,
+                                 size_t * written );
+
+extern int SSL_get_early_data_status( const SSL * s );
+
+extern uint8_t SSL_SESSION_get_max_fragment_length( const SSL_SESSION * sess );
+
+extern int SSL_set_tlsext_max_fragment_length( SSL * ssl,
+                                               uint8_t mode );
+
+extern int SSL_has_pending( const SSL * s );
+
+extern int SSL_pending( const SSL * s );
+
+extern int SSL_want( const SSL * s );
+
+extern void SSL_CTX_set_cert_verify_callback( SSL_CTX * ctx,
+                                              int ( * cb )( X509_STORE_CTX *, void * ),
+                                              void * arg );
+
+extern int SSL_session_reused( const SSL * s );
+
+extern STACK_OF( X509 ) * SSL_get_peer_cert_chain( const SSL * s );
+
+extern void * OPENSSL_sk_value( const OPENSSL_STACK * st,
+                                int i );
+
+extern const EVP_MD * EVP_sha256( void );
+
+extern int X509_digest( const X509 * data,
+                        const EVP_MD * type,
+                        unsigned char * md,
+                        unsigned int * len );
+
+/* Macro wrappers:
+ * sk_X509_num */
+extern int OPENSSL_sk_num( const OPENSSL_STACK * st );
+
+/* Macro wrappers:
+ * OPENSSL_free */
+extern void CRYPTO_free( void * ptr,
+                         const char * file,
+                         int line );
+
+extern X509 * X509_STORE_CTX_get0_cert( const X509_STORE_CTX * ctx );
+
+extern X509_VERIFY_PARAM * X509_STORE_CTX_get0_param( const X509_STORE_CTX * ctx );
+
+extern char * X509_VERIFY_PARAM_get0_host( X509_VERIFY_PARAM * param,
+                                           int idx );
+
+extern char * X509_VERIFY_PARAM_get1_ip_asc( X509_VERIFY_PARAM * param );
+
+extern int X509_check_host( X509 * x,
+                            const char * chk,
+                            size_t chklen,
+                            unsigned int flags,
+                            char ** peername );
+
+extern int X509_check_ip_asc( X509 * x,
+                              const char * ipasc,
+                              unsigned int flags );
+
+extern const ASN1_TIME * X509_get0_notAfter( const X509 * x );
+
+extern int X509_cmp_current_time( const ASN1_TIME * s );
+
+extern int X509_verify_cert( X509_STORE_CTX * ctx );
+
+extern int X509_check_issued( X509 * issuer,
+                              X509 * subject );
+
+extern int X509_up_ref( X509 * x );
+
+extern X509_STORE_CTX * X509_STORE_CTX_new( void );
+
+extern int X509_STORE_CTX_init( X509_STORE_CTX * ctx,
+                                X509_STORE * trust_store,
+                                X509 * target,
+                                STACK_OF( X509 ) * untrusted );
+
+extern int X509_STORE_CTX_get1_issuer( X509 ** issuer,
+                                       X509_STORE_CTX * ctx,
+                                       X509 * x );
+
+extern void X509_STORE_CTX_free( X509_STORE_CTX * ctx );
+
+extern SSL_CTX * SSL_get_SSL_CTX( const SSL * ssl );
+
+extern OCSP_RESPONSE * d2i_OCSP_RESPONSE( OCSP_RESPONSE ** a,
+                                          const unsigned char ** in,
+                                          long len );
+
+extern int OCSP_response_status( OCSP_RESPONSE * resp );
+
+extern OCSP_BASICRESP * OCSP_response_get1_basic( OCSP_RESPONSE * resp );
+
+extern int OCSP_basic_verify( OCSP_BASICRESP * bs,
+                              STACK_OF( X509 ) * certs,
+                              X509_STORE * st,
+                              unsigned long flags );
+
+extern OCSP_CERTID * OCSP_cert_to_id( const EVP_MD * dgst,
+                                      const X509 * subject,
+                                      const X509 * issuer );
+
+extern int OCSP_resp_find_status( OCSP_BASICRESP * bs,
+                                  OCSP_CERTID * id,
+                                  int * status,
+                                  int * reason,
+                                  ASN1_GENERALIZEDTIME ** revtime,
+                                  ASN1_GENERALIZEDTIME ** thisupd,
+                                  ASN1_GENERALIZEDTIME ** nextupd );
+
+extern int OCSP_check_validity( ASN1_GENERALIZEDTIME * thisupd,
+                                ASN1_GENERALIZEDTIME * nextupd,
+                                long sec,
+                                long maxsec );
+
+extern int ASN1_TIME_diff( int * pday,
+                           int * psec,
+                           const ASN1_TIME * from,
+                           const ASN1_TIME * to );
+
+extern void OCSP_CERTID_free( OCSP_CERTID * a );
+
+extern void OCSP_BASICRESP_free( OCSP_BASICRESP * a );
+
+extern void OCSP_RESPONSE_free( OCSP_RESPONSE * a );
+
+extern uint64_t SSL_set_options( SSL * s,
+                                 uint64_t op );
+
+extern int SSL_set_ciphersuites( SSL * s,
+                                 const char * str );
+
+extern int SSL_set_cipher_list( SSL * s,
+                                const char * str );
+
+extern BIO * SSL_get_rbio( const SSL * s );
+
+extern BIO * SSL_get_wbio( const SSL * s );
+
+extern ossl_ssize_t SSL_sendfile( SSL * s,
+                                  int fd,
+                                  off_t offset,
+                                  size_t size,
+                                  int flags );
+
+SSL_SESSION * PEM_read_SSL_SESSION( FILE * fp,
+                                    SSL_SESSION ** x,
+                                    pem_password_cb * cb,
+                                    void * u );
+
+int PEM_write_SSL_SESSION( FILE * fp,
+                           const SSL_SESSION * x );
+
+extern int i2d_SSL_SESSION( const SSL_SESSION * in,
+                            unsigned char ** pp );
+
+extern SSL_SESSION * d2i_SSL_SESSION( SSL_SESSION ** a,
+                                      const unsigned char ** pp,
+                                      long length );
+
 /* Macro wrappers:
  * SSL_CTX_set_mode */
 extern long SSL_CTX_ctrl( SSL_CTX * ctx,
@@ -125,9 +419,19 @@ extern long SSL_CTX_ctrl( SSL_CTX * ctx,
                           long larg,
                           void * parg );
 
+/* Macro wrappers:
+ * BIO_get_ktls_send
+ * BIO_get_ktls_recv */
+extern long BIO_ctrl( BIO * bp,
+                      int cmd,
+                      long larg,
+                      void * parg );
+
 /* Macro wrappers:
  * SSL_set_tlsext_host_name
- * SSL_set_max_send_fragment */
+ * SSL_set_max_send_fragment
+ * SSL_set_mode
+ * SSL_get_mode */
 extern long SSL_ctrl( SSL * ssl,
                       int cmd,
                       long larg,
@@ -150,4 +454,82 @@ const char * ERR_reason_error_string( unsigned long e );
 
 void X509_free( X509 * a );
 
+extern int CRYPTO_set_mem_functions( CRYPTO_malloc_fn malloc_fn,
+                                     CRYPTO_realloc_fn realloc_fn,
+                                     CRYPTO_free_fn free_fn );
+
+/* The functions below take the private key from a PKCS #11 token. */
+extern X509 * SSL_CTX_get0_certificate( const SSL_CTX * ctx );
+
+extern EVP_PKEY * X509_get0_pubkey( const X509 * x );
+
+extern const EC_KEY * EVP_PKEY_get0_EC_KEY( const EVP_PKEY * pkey );
+
+extern EC_KEY * EC_KEY_dup( const EC_KEY * src );
+
+extern EVP_PKEY * EVP_PKEY_new( void );
+
+extern const EC_KEY_METHOD * EC_KEY_get_default_method( void );
+
+extern EC_KEY_METHOD * EC_KEY_METHOD_new( const EC_KEY_METHOD * meth );
+
+/* Macro wrappers:
+ * EC_KEY_get_ex_new_index */
+extern int CRYPTO_get_ex_new_index( int class_index,
+                                    long argl,
+                                    void * argp,
+                                    CRYPTO_EX_new * new_func,
+                                    CRYPTO_EX_dup * dup_func,
+                                    CRYPTO_EX_free * free_func );
+
+extern void EC_KEY_METHOD_get_sign( const EC_KEY_METHOD * meth,
+                                    EcKeySign_t * psign,
+                                    EcKeySignSetup_t * psign_setup,
+                                    EcKeySignSig_t * psign_sig );
+
+extern void EC_KEY_METHOD_set_sign( EC_KEY_METHOD * meth,
+                                    EcKeySign_t sign,
+                                    EcKeySignSetup_t sign_setup,
+                                    EcKeySignSig_t sign_sig );
+
+extern int EC_KEY_set_method( EC_KEY * key,
+                              const EC_KEY_METHOD * meth );
+
+extern int EC_KEY_set_ex_data( EC_KEY * key,
+                               int idx,
+                               void * arg );
+
+extern void * EC_KEY_get_ex_data( const EC_KEY * key,
+                                  int idx );
+
+/* Macro wrappers:
+ * EVP_PKEY_assign_EC_KEY */
+extern int EVP_PKEY_assign( EVP_PKEY * pkey,
+                            int type,
+                            void * key );
+
+extern int SSL_CTX_use_PrivateKey( SSL_CTX * ctx,
+                                   EVP_PKEY * pkey );
+
+extern int SSL_CTX_use_certificate( SSL_CTX * ctx,
+                                    X509 * x );
+
+extern void EC_KEY_free( EC_KEY * key );
+
+extern void EVP_PKEY_free( EVP_PKEY * pkey );
+
+extern ECDSA_SIG * ECDSA_SIG_new( void );
+
+extern int ECDSA_SIG_set0( ECDSA_SIG * sig,
+                           BIGNUM * r,
+                           BIGNUM * s );
+
+extern void ECDSA_SIG_free( ECDSA_SIG * sig );
+
+extern BIGNUM * BN_bin2bn( const unsigned char * s,
+                           int len,
+                           BIGNUM * ret );
+
+extern void BN_free( BIGNUM * a );
+
 #endif /* ifndef OPENSSL_API_H_ */
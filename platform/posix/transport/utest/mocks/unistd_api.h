@@ -23,6 +23,8 @@
 #ifndef UNISTD_API_H_
 #define UNISTD_API_H_
 
+#include <sys/types.h>
+
 /**
  * @file unistd_api.h
  * @brief This file is used to generate a mock for any functions from
@@ -46,4 +48,12 @@ extern int close( int __fd );
 extern char * getcwd( char * __buf,
                       size_t __size );
 
+/* Read NBYTES into BUF from FD at the given position OFFSET without
+ * changing the file pointer.  Return the number read, -1 for errors
+ * or 0 for EOF.  */
+extern ssize_t pread( int __fd,
+                      void * __buf,
+                      size_t __nbytes,
+                      off_t __offset );
+
 #endif /* ifndef UNISTD_API_H_ */
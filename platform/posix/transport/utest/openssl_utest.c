@@ -23,6 +23,8 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "/usr/include/errno.h"
 
 #include "unity.h"
@@ -30,10 +32,19 @@
 /* Include paths for public enums, structures, and macros. */
 #include "openssl_posix.h"
 
+/* Allocator include, whose statistics track the copies of the transport. */
+#include "allocator.h"
+
 #include "mock_unistd_api.h"
+#include "mock_mman_api.h"
 #include "mock_openssl_api.h"
 #include "mock_sockets_posix.h"
 #include "mock_stdio_api.h"
+#include "mock_socket.h"
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+    #include "mock_core_pkcs11_api.h"
+#endif
 
 /* The send and receive timeout to set for the socket. */
 #define SEND_RECV_TIMEOUT       0
@@ -46,6 +57,28 @@
 #define ROOT_CA_CERT_PATH       "fake/path.crt"
 #define CLIENT_CERT_PATH        "\\fake\\path.crt"
 #define PRIVATE_KEY_PATH        "/fake/path.crt"
+#define SESSION_FILE_PATH       "/fake/session.pem"
+
+/* Private key on the PKCS #11 token, and the label its URI decodes to. */
+#define PKCS11_PRIVATE_KEY_URI      "pkcs11:object=Device%20Priv%20TLS%20Key"
+#define PKCS11_PRIVATE_KEY_LABEL    "Device Priv TLS Key"
+
+/* File of the shared TLS session cache, created in the working directory.
+ * Its mapping is simulated by #sharedSessionCache. */
+#define SHARED_CACHE_FILE_PATH    "openssl_utest_sessions.bin"
+
+/* DER bundle of root CAs, created in the working directory. Its mapping is
+ * simulated by #derBundle. */
+#define DER_BUNDLE_PATH              "openssl_utest_roots.der"
+
+/* Number of certificates in #derBundle, the length of each, and the tag
+ * starting a valid record. */
+#define DER_BUNDLE_CERTIFICATES      2U
+#define DER_CERTIFICATE_LEN          16U
+#define DER_SEQUENCE_TAG             0x30U
+
+/* Length of the DER encoding of #sslSession. */
+#define SESSION_ENCODING_LEN      100
 
 /* Configuration parameters for the TLS connection. */
 #define MFLN                    42
@@ -59,6 +92,9 @@
 /* The size of the buffer passed to #Openssl_Send and #Openssl_Recv. */
 #define BUFFER_LEN              4
 
+/* The size of the read-ahead buffer configured in the transport parameters. */
+#define READ_AHEAD_LEN          ( BUFFER_LEN * 2 )
+
 /* Each compilation unit must define the NetworkContext struct. */
 struct NetworkContext
 {
@@ -71,6 +107,18 @@ static OpensslCredentials_t opensslCredentials = { 0 };
 static OpensslParams_t opensslParams = { 0 };
 static NetworkContext_t networkContext = { 0 };
 static uint8_t opensslBuffer[ BUFFER_LEN ] = { 0 };
+static uint8_t readAheadBuffer[ READ_AHEAD_LEN ] = { 0 };
+static uint8_t gatherBuffer[ BUFFER_LEN * 2 ] = { 0 };
+
+/* Memory of the shared TLS session cache, returned by the mocked mmap. It is
+ * larger than the layout of the cache: a header and the slots, each with its
+ * sequence, length and host name. */
+static uint32_t sharedSessionCache[ ( 16U + ( OPENSSL_SHARED_SESSION_SLOTS *
+                                              ( 264U + OPENSSL_SHARED_SESSION_MAX_LENGTH ) ) ) / 4U ];
+
+/* Contents of #DER_BUNDLE_PATH, and the descriptor it is written with. */
+static uint8_t derBundle[ DER_BUNDLE_CERTIFICATES * DER_CERTIFICATE_LEN ];
+static int derBundleFile = -1;
 
 /* Objects from the OpenSSL API. */
 static SSL ssl;
@@ -79,6 +127,100 @@ static SSL_CTX sslCtx;
 static FILE rootCaFile;
 static X509 rootCa;
 static X509_STORE CaStore;
+static SSL_SESSION sslSession;
+static FILE sessionFile;
+static BIO sslBio;
+static STACK_OF( X509 ) peerChain;
+
+/* Whether the kernel takes over the sending and receiving record layer when
+ * #OpensslCredentials_t.enableKtls is set. */
+static bool ktlsSend = false;
+static bool ktlsRecv = false;
+
+/* Callback registered by the transport for new TLS sessions. */
+static NewSessionCallback_t newSessionCallback = NULL;
+
+/* Memory functions installed in OpenSSL by #Openssl_UseAllocator. */
+static CRYPTO_malloc_fn opensslMallocFunction = NULL;
+static CRYPTO_realloc_fn opensslReallocFunction = NULL;
+static CRYPTO_free_fn opensslFreeFunction = NULL;
+
+/* Where #Openssl_Connect is expected to find a TLS session to resume. */
+static bool sessionCached = false;
+static bool sessionShared = false;
+static bool sessionSaved = false;
+
+/* Early data allowed by the resumed session, and whether the server
+ * accepts it. */
+static uint32_t maxEarlyData = 0U;
+static int earlyDataStatus = SSL_EARLY_DATA_ACCEPTED;
+static size_t earlyDataWritten = 0U;
+
+/* Cipher suites #Openssl_Connect is expected to offer, in order, when
+ * #OpensslCredentials_t.cipherPolicy is set. */
+static const char * pExpectedCipherSuites = NULL;
+static const char * pExpectedCipherList = NULL;
+
+/* Whether the helper expects the calls made once the TCP connection of
+ * #Openssl_ConnectStart is established, rather than those of #Openssl_Connect. */
+static bool asyncConnect = false;
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+
+/* Objects read from the client certificate and created for the private key
+ * on the token. */
+    static X509 clientCert;
+    static EVP_PKEY certificateKey;
+    static EC_KEY publicEcKey;
+    static EC_KEY tokenEcKey;
+    static EVP_PKEY tokenKey;
+
+/* Key method of OpenSSL, and the one the transport derives from it to sign
+ * with the token. */
+    static EC_KEY_METHOD defaultKeyMethod;
+    static EC_KEY_METHOD tokenKeyMethod;
+
+/* Function list of the PKCS #11 module, the session opened on the token and
+ * the object handle of the private key. */
+    static CK_FUNCTION_LIST functionList;
+    static CK_FUNCTION_LIST_PTR pFunctionList = &functionList;
+    static CK_SESSION_HANDLE tokenSession = 1U;
+    static CK_OBJECT_HANDLE tokenKeyHandle = 2U;
+
+/* Value returned by the C_CloseSession of #functionList. */
+    static CK_RV closeSessionResult = CKR_OK;
+
+/* Whether the transport created its key method, which it keeps for the rest
+ * of the suite, and whether the session on the token is open. */
+    static bool pkcs11KeyMethodCreated = false;
+    static bool pkcs11SessionOpen = false;
+
+/**
+ * @brief Step of loading the private key from the token to fail.
+ */
+    typedef enum Pkcs11Failure
+    {
+        PKCS11_NO_FAILURE = 0,
+        PKCS11_NO_CERTIFICATE,
+        PKCS11_NOT_EC_KEY,
+        PKCS11_NO_LABEL,
+        PKCS11_NO_KEY_METHOD,
+        PKCS11_NO_MODULE,
+        PKCS11_NO_SESSION,
+        PKCS11_FIND_ERROR,
+        PKCS11_KEY_NOT_FOUND,
+        PKCS11_KEY_REJECTED
+    } Pkcs11Failure_t;
+
+/* Step of loading the private key from the token that
+ * #failFunctionFrom_Openssl_Connect expects to fail. */
+    static Pkcs11Failure_t pkcs11Failure = PKCS11_NO_FAILURE;
+
+/**
+ * @brief C_CloseSession of #functionList.
+ */
+    static CK_RV closeSession( CK_SESSION_HANDLE session );
+#endif /* if ( OPENSSL_PKCS11_ENABLED == 1 ) */
 
 /**
  * @brief OpenSSL Connect / Disconnect return status.
@@ -89,6 +231,7 @@ typedef enum FunctionNames
     SSL_CTX_new_fn,
     fopen_fn,
     PEM_read_X509_fn,
+    d2i_X509_fn,
     X509_STORE_add_cert_fn,
     SSL_CTX_use_certificate_chain_file_fn,
     SSL_CTX_use_PrivateKey_file_fn,
@@ -121,26 +264,112 @@ void setUp()
     opensslCredentials.alpnProtosLen = strlen( ALPN_PROTOS );
     opensslCredentials.maxFragmentLength = MFLN;
     opensslCredentials.sniHostName = HOSTNAME;
+
+    newSessionCallback = NULL;
+    sessionCached = false;
+    sessionShared = false;
+    sessionSaved = false;
+    maxEarlyData = 0U;
+    earlyDataStatus = SSL_EARLY_DATA_ACCEPTED;
+    earlyDataWritten = 0U;
+    pExpectedCipherSuites = NULL;
+    pExpectedCipherList = NULL;
+    asyncConnect = false;
+    ktlsSend = false;
+    ktlsRecv = false;
+    opensslParams.ktlsSendEnabled = false;
+    opensslParams.ktlsRecvEnabled = false;
+
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        functionList.C_CloseSession = closeSession;
+        closeSessionResult = CKR_OK;
+        pkcs11Failure = PKCS11_NO_FAILURE;
+    #endif
 }
 
 /* Called after each test method. */
 void tearDown()
 {
+    /* Each test opens its own session on the token. */
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        ( void ) Openssl_ClosePkcs11Session();
+        pkcs11SessionOpen = false;
+    #endif
 }
 
 /* Called at the beginning of the whole suite. */
 void suiteSetUp()
 {
+    /* The descriptor is left open for the whole suite, since close is
+     * mocked. */
+    derBundleFile = open( DER_BUNDLE_PATH, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR );
 }
 
 /* Called at the end of the whole suite. */
 int suiteTearDown( int numFailures )
 {
+    ( void ) unlink( DER_BUNDLE_PATH );
+
     return numFailures;
 }
 
 /* ========================================================================== */
 
+/**
+ * @brief Capture the callback that the transport registers for new TLS sessions.
+ */
+static void captureNewSessionCallback( SSL_CTX * ctx,
+                                       NewSessionCallback_t new_session_cb,
+                                       int cmock_num_calls )
+{
+    ( void ) ctx;
+    ( void ) cmock_num_calls;
+
+    newSessionCallback = new_session_cb;
+}
+
+/**
+ * @brief Capture the memory functions that the transport installs in OpenSSL.
+ */
+static int captureMemFunctions( CRYPTO_malloc_fn malloc_fn,
+                                CRYPTO_realloc_fn realloc_fn,
+                                CRYPTO_free_fn free_fn,
+                                int cmock_num_calls )
+{
+    ( void ) cmock_num_calls;
+
+    opensslMallocFunction = malloc_fn;
+    opensslReallocFunction = realloc_fn;
+    opensslFreeFunction = free_fn;
+
+    return 1;
+}
+
+/**
+ * @brief d2i_X509 parsing the records of #derBundle, each of which is
+ * #DER_CERTIFICATE_LEN bytes long.
+ */
+static X509 * parseDerCertificate( X509 ** a,
+                                   const unsigned char ** in,
+                                   long len,
+                                   int cmock_num_calls )
+{
+    X509 * pCertificate = NULL;
+
+    ( void ) a;
+    ( void ) cmock_num_calls;
+
+    TEST_ASSERT_GREATER_OR_EQUAL( DER_CERTIFICATE_LEN, len );
+
+    if( **in == DER_SEQUENCE_TAG )
+    {
+        *in = &( ( *in )[ DER_CERTIFICATE_LEN ] );
+        pCertificate = &rootCa;
+    }
+
+    return pCertificate;
+}
+
 /**
  * @brief Converts the sockets wrapper status to openssl status.
  *
@@ -171,6 +400,18 @@ static OpensslStatus_t convertToOpensslStatus( SocketStatus_t socketStatus )
             opensslStatus = OPENSSL_CONNECT_FAILURE;
             break;
 
+        case SOCKETS_INSUFFICIENT_MEMORY:
+            opensslStatus = OPENSSL_INSUFFICIENT_MEMORY;
+            break;
+
+        case SOCKETS_API_ERROR:
+            opensslStatus = OPENSSL_API_ERROR;
+            break;
+
+        case SOCKETS_WANT_WRITE:
+            opensslStatus = OPENSSL_WANT_WRITE;
+            break;
+
         default:
             LogError( ( "Unexpected status received from socket wrapper: Socket status = %u",
                         socketStatus ) );
@@ -179,6 +420,228 @@ static OpensslStatus_t convertToOpensslStatus( SocketStatus_t socketStatus )
     return opensslStatus;
 }
 
+/**
+ * @brief Expect the sockets function #Openssl_Connect connects with, which
+ * records the latencies of the connection when the statistics are collected.
+ *
+ * @param[in] socketStatus The status to return.
+ */
+static void expectSocketsConnect( SocketStatus_t socketStatus )
+{
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        Sockets_ConnectWithStats_ExpectAnyArgsAndReturn( socketStatus );
+    #else
+        Sockets_Connect_ExpectAnyArgsAndReturn( socketStatus );
+    #endif
+}
+
+#if ( OPENSSL_PKCS11_ENABLED == 1 )
+
+    static CK_RV closeSession( CK_SESSION_HANDLE session )
+    {
+        TEST_ASSERT_EQUAL( tokenSession, session );
+
+        return closeSessionResult;
+    }
+
+/**
+ * @brief Expect the calls loading the private key from the token, failing
+ * at #pkcs11Failure.
+ *
+ * @note The key method is only created by the first connection that gets
+ * this far, and the session on the token is only opened by the first
+ * connection of a test.
+ *
+ * @return #OPENSSL_SUCCESS, or #OPENSSL_INVALID_CREDENTIALS when a step
+ * fails.
+ */
+    static OpensslStatus_t expectPkcs11PrivateKey( void )
+    {
+        OpensslStatus_t returnStatus = OPENSSL_INVALID_CREDENTIALS;
+        bool keyCreated = false, keyFound = false;
+
+        /* The public key is that of the client certificate. */
+        if( pkcs11Failure == PKCS11_NO_CERTIFICATE )
+        {
+            SSL_CTX_get0_certificate_ExpectAndReturn( &sslCtx, NULL );
+        }
+        else
+        {
+            SSL_CTX_get0_certificate_ExpectAndReturn( &sslCtx, &clientCert );
+            X509_get0_pubkey_ExpectAndReturn( &clientCert, &certificateKey );
+            EVP_PKEY_get0_EC_KEY_ExpectAndReturn( &certificateKey,
+                                                  ( pkcs11Failure == PKCS11_NOT_EC_KEY ) ? NULL : &publicEcKey );
+        }
+
+        if( ( pkcs11Failure != PKCS11_NO_CERTIFICATE ) &&
+            ( pkcs11Failure != PKCS11_NOT_EC_KEY ) &&
+            ( pkcs11Failure != PKCS11_NO_LABEL ) )
+        {
+            X509_get0_pubkey_ExpectAndReturn( &clientCert, &certificateKey );
+            EVP_PKEY_get0_EC_KEY_ExpectAndReturn( &certificateKey, &publicEcKey );
+            EC_KEY_dup_ExpectAndReturn( &publicEcKey, &tokenEcKey );
+            EVP_PKEY_new_ExpectAndReturn( &tokenKey );
+            keyCreated = true;
+        }
+
+        if( keyCreated && !pkcs11KeyMethodCreated )
+        {
+            EC_KEY_get_default_method_ExpectAndReturn( &defaultKeyMethod );
+
+            if( pkcs11Failure == PKCS11_NO_KEY_METHOD )
+            {
+                EC_KEY_METHOD_new_ExpectAndReturn( &defaultKeyMethod, NULL );
+                CRYPTO_get_ex_new_index_ExpectAnyArgsAndReturn( 0 );
+            }
+            else
+            {
+                EC_KEY_METHOD_new_ExpectAndReturn( &defaultKeyMethod, &tokenKeyMethod );
+                CRYPTO_get_ex_new_index_ExpectAnyArgsAndReturn( 0 );
+                EC_KEY_METHOD_get_sign_ExpectAnyArgs();
+                EC_KEY_METHOD_set_sign_ExpectAnyArgs();
+                pkcs11KeyMethodCreated = true;
+            }
+        }
+
+        if( keyCreated && !pkcs11SessionOpen )
+        {
+            if( pkcs11Failure == PKCS11_NO_MODULE )
+            {
+                C_GetFunctionList_ExpectAnyArgsAndReturn( CKR_GENERAL_ERROR );
+            }
+            else
+            {
+                C_GetFunctionList_ExpectAnyArgsAndReturn( CKR_OK );
+                C_GetFunctionList_ReturnThruPtr_ppFunctionList( &pFunctionList );
+            }
+
+            if( pkcs11Failure == PKCS11_NO_SESSION )
+            {
+                xInitializePkcs11Session_ExpectAnyArgsAndReturn( CKR_PIN_INCORRECT );
+            }
+            else if( pkcs11Failure != PKCS11_NO_MODULE )
+            {
+                xInitializePkcs11Session_ExpectAnyArgsAndReturn( CKR_OK );
+                xInitializePkcs11Session_ReturnThruPtr_pxSession( &tokenSession );
+                pkcs11SessionOpen = true;
+            }
+        }
+
+        /* The label is not terminated, so only its length is compared. */
+        if( keyCreated && pkcs11SessionOpen )
+        {
+            xFindObjectWithLabelAndClass_ExpectAndReturn( tokenSession,
+                                                          NULL,
+                                                          strlen( PKCS11_PRIVATE_KEY_LABEL ),
+                                                          CKO_PRIVATE_KEY,
+                                                          NULL,
+                                                          ( pkcs11Failure == PKCS11_FIND_ERROR ) ?
+                                                          CKR_FUNCTION_FAILED : CKR_OK );
+            xFindObjectWithLabelAndClass_IgnoreArg_pcLabelName();
+            xFindObjectWithLabelAndClass_IgnoreArg_pxHandle();
+
+            if( ( pkcs11Failure != PKCS11_FIND_ERROR ) && ( pkcs11Failure != PKCS11_KEY_NOT_FOUND ) )
+            {
+                xFindObjectWithLabelAndClass_ReturnThruPtr_pxHandle( &tokenKeyHandle );
+                keyFound = true;
+            }
+        }
+
+        /* Signing is attached to the copy of the public key, which the key
+         * takes over. */
+        if( keyFound && pkcs11KeyMethodCreated )
+        {
+            EC_KEY_set_method_ExpectAndReturn( &tokenEcKey, &tokenKeyMethod, 1 );
+            EC_KEY_set_ex_data_ExpectAndReturn( &tokenEcKey, 0, NULL, 1 );
+            EC_KEY_set_ex_data_IgnoreArg_arg();
+            EVP_PKEY_assign_ExpectAndReturn( &tokenKey, EVP_PKEY_EC, &tokenEcKey, 1 );
+            SSL_CTX_use_PrivateKey_ExpectAndReturn( &sslCtx, &tokenKey,
+                                                    ( pkcs11Failure == PKCS11_KEY_REJECTED ) ? 0 : 1 );
+            EC_KEY_free_Expect( NULL );
+
+            if( pkcs11Failure != PKCS11_KEY_REJECTED )
+            {
+                returnStatus = OPENSSL_SUCCESS;
+            }
+        }
+        else
+        {
+            EC_KEY_free_Expect( keyCreated ? &tokenEcKey : NULL );
+        }
+
+        EVP_PKEY_free_Expect( keyCreated ? &tokenKey : NULL );
+
+        return returnStatus;
+    }
+#endif /* if ( OPENSSL_PKCS11_ENABLED == 1 ) */
+
+/**
+ * @brief Expect #Openssl_Connect to load the root CAs from #DER_BUNDLE_PATH.
+ *
+ * The second record of the bundle is corrupted when #d2i_X509_fn is to fail.
+ *
+ * @param[in] functionToFail The function called from #Openssl_Connect to fail.
+ * @param[in] returnStatus The status expected so far.
+ *
+ * @return #OPENSSL_SUCCESS or #OPENSSL_INVALID_CREDENTIALS after #returnStatus.
+ */
+static OpensslStatus_t expectDerBundle( FunctionNames_t functionToFail,
+                                        OpensslStatus_t returnStatus )
+{
+    OpensslStatus_t status = returnStatus;
+    uint32_t i;
+
+    ( void ) memset( derBundle, 0, sizeof( derBundle ) );
+    derBundle[ 0 ] = DER_SEQUENCE_TAG;
+    derBundle[ DER_CERTIFICATE_LEN ] = ( functionToFail == d2i_X509_fn ) ? 0U : DER_SEQUENCE_TAG;
+    TEST_ASSERT_EQUAL( sizeof( derBundle ),
+                       pwrite( derBundleFile, derBundle, sizeof( derBundle ), 0 ) );
+
+    if( status == OPENSSL_SUCCESS )
+    {
+        /* These calls are only expected when #LIBRARY_LOG_LEVEL
+         * is set to #LOG_DEBUG. */
+        #if ( LIBRARY_LOG_LEVEL == LOG_DEBUG )
+            getcwd_ExpectAnyArgsAndReturn( NULL );
+        #endif
+
+        SSL_CTX_get_cert_store_ExpectAnyArgsAndReturn( &CaStore );
+
+        #if ( OPENSSL_DER_BUNDLE_MMAP == 1 )
+            mmap_ExpectAnyArgsAndReturn( derBundle );
+        #endif
+
+        d2i_X509_Stub( parseDerCertificate );
+
+        for( i = 0U; ( i < DER_BUNDLE_CERTIFICATES ) && ( status == OPENSSL_SUCCESS ); i++ )
+        {
+            if( ( functionToFail == d2i_X509_fn ) && ( i == 1U ) )
+            {
+                status = OPENSSL_INVALID_CREDENTIALS;
+            }
+            else if( functionToFail == X509_STORE_add_cert_fn )
+            {
+                X509_STORE_add_cert_ExpectAnyArgsAndReturn( -1 );
+                X509_free_ExpectAnyArgs();
+                status = OPENSSL_INVALID_CREDENTIALS;
+            }
+            else
+            {
+                X509_STORE_add_cert_ExpectAnyArgsAndReturn( 1 );
+                X509_free_ExpectAnyArgs();
+            }
+        }
+
+        #if ( OPENSSL_DER_BUNDLE_MMAP == 1 )
+            munmap_ExpectAnyArgsAndReturn( 0 );
+        #endif
+
+        close_ExpectAnyArgsAndReturn( 0 );
+    }
+
+    return status;
+}
+
 /**
  * @brief Expect function calls based on the specified function to fail.
  *
@@ -189,6 +652,11 @@ static OpensslStatus_t convertToOpensslStatus( SocketStatus_t socketStatus )
  * every method will be expected to succeed. This implies a return value of
  * #OPENSSL_SUCCESS.
  *
+ * @note If #asyncConnect is set, the calls made once the TCP connection of
+ * #Openssl_ConnectStart is established are expected instead, and failing
+ * #SSL_connect makes the handshake wait for the socket to be readable. The
+ * caller expects the sockets wrapper call that establishes the connection.
+ *
  * @return #OPENSSL_SUCCESS, #OPENSSL_INVALID_PARAMETER, #OPENSSL_DNS_FAILURE,
  * #OPENSSL_INSUFFICIENT_MEMORY, #OPENSSL_API_ERROR, #OPENSSL_INVALID_CREDENTIALS,
  * #OPENSSL_HANDSHAKE_FAILED, and #OPENSSL_CONNECT_FAILURE.
@@ -200,19 +668,24 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
     SocketStatus_t socketStatus = SOCKETS_SUCCESS;
     bool fileOpened = false,
          sslCtxCreated = false, sslCreated = false;
+    unsigned int fingerprintLength = SHA256_DIGEST_LENGTH;
 
     /* Depending on the function to fail,
      * this function must return the correct status to expect. */
-    if( functionToFail == Sockets_Connect_fn )
+    if( asyncConnect )
+    {
+        /* Expected by the caller. */
+    }
+    else if( functionToFail == Sockets_Connect_fn )
     {
         TEST_ASSERT_NOT_NULL( retValue );
         socketStatus = *( ( SocketStatus_t * ) retValue );
-        Sockets_Connect_ExpectAnyArgsAndReturn( socketStatus );
+        expectSocketsConnect( socketStatus );
         returnStatus = convertToOpensslStatus( socketStatus );
     }
     else if( returnStatus == OPENSSL_SUCCESS )
     {
-        Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+        expectSocketsConnect( SOCKETS_SUCCESS );
     }
 
     /* Calls like this can't fail no matter what you return. */
@@ -244,6 +717,10 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
     {
         returnStatus = OPENSSL_INVALID_CREDENTIALS;
     }
+    else if( strcmp( opensslCredentials.pRootCaPath, DER_BUNDLE_PATH ) == 0 )
+    {
+        returnStatus = expectDerBundle( functionToFail, returnStatus );
+    }
     else
     {
         /* These calls are only expected when #LIBRARY_LOG_LEVEL
@@ -321,6 +798,16 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
 
     if( opensslCredentials.pPrivateKeyPath != NULL )
     {
+        #if ( OPENSSL_PKCS11_ENABLED == 1 )
+            if( strncmp( opensslCredentials.pPrivateKeyPath, "pkcs11:", 7U ) == 0 )
+            {
+                if( returnStatus == OPENSSL_SUCCESS )
+                {
+                    returnStatus = expectPkcs11PrivateKey();
+                }
+            }
+            else
+        #endif
         if( functionToFail == SSL_CTX_use_PrivateKey_file_fn )
         {
             SSL_CTX_use_PrivateKey_file_ExpectAnyArgsAndReturn( -1 );
@@ -332,6 +819,25 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
         }
     }
 
+    if( ( returnStatus == OPENSSL_SUCCESS ) && opensslCredentials.cacheVerifiedChains )
+    {
+        SSL_CTX_set_cert_verify_callback_ExpectAnyArgs();
+    }
+
+    /* A new SSL context hands its sessions to the session cache once. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) && opensslCredentials.cacheSession )
+    {
+        SSL_CTX_ctrl_ExpectAnyArgsAndReturn( 0 );
+        SSL_CTX_sess_set_new_cb_ExpectAnyArgs();
+    }
+
+    /* A newly created SSL context is referenced by the cache when caching
+     * is enabled. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) && opensslCredentials.cacheSslContext )
+    {
+        SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    }
+
     if( functionToFail == SSL_new_fn )
     {
         SSL_new_ExpectAnyArgsAndReturn( NULL );
@@ -343,6 +849,48 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
         sslCreated = true;
     }
 
+    /* A session is offered when session caching is enabled. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) && opensslCredentials.cacheSession &&
+        ( opensslCredentials.sniHostName != NULL ) )
+    {
+        SSL_set_ex_data_ExpectAndReturn( &ssl, 0, &opensslParams, 1 );
+
+        if( sessionCached )
+        {
+            SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+            SSL_set_session_ExpectAndReturn( &ssl, &sslSession, 1 );
+        }
+        else if( sessionShared )
+        {
+            d2i_SSL_SESSION_ExpectAnyArgsAndReturn( &sslSession );
+            SSL_set_session_ExpectAndReturn( &ssl, &sslSession, 1 );
+            SSL_SESSION_free_Expect( &sslSession );
+        }
+        else if( opensslCredentials.pSessionFilePath == NULL )
+        {
+            /* Nothing to resume. */
+        }
+        else if( sessionSaved )
+        {
+            fopen_ExpectAnyArgsAndReturn( &sessionFile );
+            PEM_read_SSL_SESSION_ExpectAnyArgsAndReturn( &sslSession );
+            fclose_ExpectAnyArgsAndReturn( 0 );
+            SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+            SSL_set_session_ExpectAndReturn( &ssl, &sslSession, 1 );
+            SSL_SESSION_free_Expect( &sslSession );
+        }
+        else
+        {
+            fopen_ExpectAnyArgsAndReturn( NULL );
+        }
+    }
+
+    /* The SSL object holds its own reference to the SSL context. */
+    if( sslCtxCreated )
+    {
+        SSL_CTX_free_ExpectAnyArgs();
+    }
+
     if( functionToFail == SSL_set1_host_fn )
     {
         SSL_set1_host_ExpectAnyArgsAndReturn( 0 );
@@ -383,6 +931,13 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
         }
     }
 
+    if( ( opensslCredentials.cipherPolicy != OPENSSL_CIPHERS_DEFAULT ) &&
+        ( returnStatus == OPENSSL_SUCCESS ) )
+    {
+        SSL_set_ciphersuites_ExpectAndReturn( &ssl, pExpectedCipherSuites, 1 );
+        SSL_set_cipher_list_ExpectAndReturn( &ssl, pExpectedCipherList, 1 );
+    }
+
     if( opensslCredentials.maxFragmentLength > 0 )
     {
         if( functionToFail == SSL_set_max_send_fragment_fn )
@@ -408,7 +963,55 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
         }
     }
 
-    if( functionToFail == SSL_connect_fn )
+    if( opensslCredentials.releaseIdleBuffers && ( returnStatus == OPENSSL_SUCCESS ) )
+    {
+        SSL_ctrl_ExpectAndReturn( &ssl, SSL_CTRL_MODE, SSL_MODE_RELEASE_BUFFERS, NULL, SSL_MODE_RELEASE_BUFFERS );
+
+        if( opensslCredentials.maxFragmentLength == 1024U )
+        {
+            SSL_set_tlsext_max_fragment_length_ExpectAndReturn( &ssl, TLSEXT_max_fragment_length_1024, 1 );
+        }
+    }
+
+    if( ( opensslCredentials.ocspMode != OPENSSL_OCSP_DISABLED ) && ( returnStatus == OPENSSL_SUCCESS ) )
+    {
+        SSL_ctrl_ExpectAndReturn( &ssl, SSL_CTRL_SET_TLSEXT_STATUS_REQ_TYPE, TLSEXT_STATUSTYPE_ocsp, NULL, 1 );
+    }
+
+    if( opensslCredentials.enableKtls && ( returnStatus == OPENSSL_SUCCESS ) )
+    {
+        SSL_set_options_ExpectAndReturn( &ssl, SSL_OP_ENABLE_KTLS, SSL_OP_ENABLE_KTLS );
+    }
+
+    if( asyncConnect && ( returnStatus == OPENSSL_SUCCESS ) )
+    {
+        Sockets_SetNonBlocking_ExpectAndReturn( opensslParams.socketConnectContext.tcpSocket, true, SOCKETS_SUCCESS );
+    }
+
+    /* Early data is only written when the resumed session allows it. */
+    earlyDataWritten = 0U;
+
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( opensslCredentials.pEarlyData != NULL ) &&
+        opensslCredentials.earlyDataReplaySafe )
+    {
+        SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+        SSL_SESSION_get_max_early_data_ExpectAndReturn( &sslSession, maxEarlyData );
+
+        if( maxEarlyData >= opensslCredentials.earlyDataLength )
+        {
+            earlyDataWritten = opensslCredentials.earlyDataLength;
+            SSL_write_early_data_ExpectAnyArgsAndReturn( 1 );
+            SSL_write_early_data_ReturnThruPtr_written( &earlyDataWritten );
+        }
+    }
+
+    if( asyncConnect && ( functionToFail == SSL_connect_fn ) )
+    {
+        SSL_connect_ExpectAnyArgsAndReturn( -1 );
+        SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_WANT_READ );
+        returnStatus = OPENSSL_WANT_READ;
+    }
+    else if( functionToFail == SSL_connect_fn )
     {
         SSL_connect_ExpectAnyArgsAndReturn( -1 );
         returnStatus = OPENSSL_HANDSHAKE_FAILED;
@@ -428,17 +1031,67 @@ static OpensslStatus_t failFunctionFrom_Openssl_Connect( FunctionNames_t functio
         SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
     }
 
-    /* Expect objects to be freed depending upon whether they were created. */
-    if( sslCtxCreated )
+    /* The server never staples an OCSP response, and the status of its
+     * certificate is never cached. */
+    if( ( opensslCredentials.ocspMode != OPENSSL_OCSP_DISABLED ) && ( returnStatus == OPENSSL_SUCCESS ) )
     {
-        SSL_CTX_free_ExpectAnyArgs();
+        SSL_session_reused_ExpectAndReturn( &ssl, 0 );
+        SSL_get_peer_cert_chain_ExpectAndReturn( &ssl, &peerChain );
+        OPENSSL_sk_value_ExpectAnyArgsAndReturn( &rootCa );
+        EVP_sha256_ExpectAndReturn( NULL );
+        X509_digest_ExpectAnyArgsAndReturn( 1 );
+        X509_digest_ReturnThruPtr_len( &fingerprintLength );
+        SSL_ctrl_ExpectAnyArgsAndReturn( -1 );
+
+        if( opensslCredentials.ocspMode == OPENSSL_OCSP_REQUIRE )
+        {
+            returnStatus = OPENSSL_HANDSHAKE_FAILED;
+        }
+    }
+
+    /* Early data the server did not accept is sent after the handshake. */
+    if( ( returnStatus == OPENSSL_SUCCESS ) && ( opensslCredentials.pEarlyData != NULL ) )
+    {
+        if( earlyDataWritten > 0U )
+        {
+            SSL_get_early_data_status_ExpectAndReturn( &ssl, earlyDataStatus );
+        }
+
+        if( ( earlyDataWritten == 0U ) || ( earlyDataStatus != SSL_EARLY_DATA_ACCEPTED ) )
+        {
+            SSL_write_ExpectAndReturn( &ssl,
+                                       opensslCredentials.pEarlyData,
+                                       ( int ) opensslCredentials.earlyDataLength,
+                                       ( int ) opensslCredentials.earlyDataLength );
+        }
+    }
+
+    if( asyncConnect && ( returnStatus == OPENSSL_SUCCESS ) )
+    {
+        Sockets_SetNonBlocking_ExpectAndReturn( opensslParams.socketConnectContext.tcpSocket, false, SOCKETS_SUCCESS );
     }
 
-    if( ( returnStatus != OPENSSL_SUCCESS ) && sslCreated )
+    /* Whether the kernel took over the record layer is checked once the
+     * handshake completes. */
+    if( opensslCredentials.enableKtls && ( returnStatus == OPENSSL_SUCCESS ) )
+    {
+        SSL_get_wbio_ExpectAndReturn( &ssl, &sslBio );
+        BIO_ctrl_ExpectAndReturn( &sslBio, BIO_CTRL_GET_KTLS_SEND, 0, NULL, ktlsSend ? 1 : 0 );
+        SSL_get_rbio_ExpectAndReturn( &ssl, &sslBio );
+        BIO_ctrl_ExpectAndReturn( &sslBio, BIO_CTRL_GET_KTLS_RECV, 0, NULL, ktlsRecv ? 1 : 0 );
+    }
+
+    /* Expect objects to be freed depending upon whether they were created. */
+    if( ( returnStatus != OPENSSL_SUCCESS ) && ( returnStatus != OPENSSL_WANT_READ ) && sslCreated )
     {
         SSL_free_ExpectAnyArgs();
     }
 
+    if( asyncConnect && ( returnStatus != OPENSSL_SUCCESS ) && ( returnStatus != OPENSSL_WANT_READ ) )
+    {
+        Sockets_Disconnect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    }
+
     return returnStatus;
 }
 
@@ -569,22 +1222,25 @@ void test_Openssl_Connect_Setting_TLS_Credentials_Fails( void )
 }
 
 /**
- * @brief Test that #Openssl_Connect is able to return an error when setting
- * extra configuration parameters for the TLS connection.
+ * @brief Test that #Openssl_Connect adds every certificate of a DER bundle
+ * of root CAs to the store, and fails on a record that is not a certificate
+ * or is rejected by the store.
  */
-void test_Openssl_Connect_Setting_TLS_Configurations_Fails( void )
+void test_Openssl_Connect_Loads_Der_Bundle( void )
 {
     OpensslStatus_t returnStatus, expectedStatus;
-    FunctionNames_t configFunctions[] =
+    FunctionNames_t bundleFunctions[] =
     {
-        SSL_set_alpn_protos_fn, SSL_set_max_send_fragment_fn,
-        SSL_set_tlsext_host_name_fn
+        SSL_get_verify_result_fn + 1, d2i_X509_fn, X509_STORE_add_cert_fn
     };
     uint16_t i;
 
-    for( i = 0; i < sizeof( configFunctions ) / sizeof( FunctionNames_t ); i++ )
+    TEST_ASSERT_GREATER_OR_EQUAL( 0, derBundleFile );
+    opensslCredentials.pRootCaPath = DER_BUNDLE_PATH;
+
+    for( i = 0; i < sizeof( bundleFunctions ) / sizeof( FunctionNames_t ); i++ )
     {
-        expectedStatus = failFunctionFrom_Openssl_Connect( configFunctions[ i ], NULL );
+        expectedStatus = failFunctionFrom_Openssl_Connect( bundleFunctions[ i ], NULL );
         returnStatus = Openssl_Connect( &networkContext,
                                         &serverInfo,
                                         &opensslCredentials,
@@ -595,91 +1251,1112 @@ void test_Openssl_Connect_Setting_TLS_Configurations_Fails( void )
 }
 
 /**
- * @brief Test that #Openssl_Connect is able to return #OPENSSL_HANDSHAKE_FAILED
- * when failing to perform the TLS handshake.
+ * @brief Test that #Openssl_Connect is able to return an error when setting
+ * extra configuration parameters for the TLS connection.
  */
-void test_Openssl_Connect_Handshake_Fails( void )
+void test_Openssl_Connect_Setting_TLS_Configurations_Fails( void )
 {
     OpensslStatus_t returnStatus, expectedStatus;
-    FunctionNames_t connectFunctions[] =
+    FunctionNames_t configFunctions[] =
+    {
+        SSL_set_alpn_protos_fn, SSL_set_max_send_fragment_fn,
+        SSL_set_tlsext_host_name_fn
+    };
+    uint16_t i;
+
+    for( i = 0; i < sizeof( configFunctions ) / sizeof( FunctionNames_t ); i++ )
+    {
+        expectedStatus = failFunctionFrom_Openssl_Connect( configFunctions[ i ], NULL );
+        returnStatus = Openssl_Connect( &networkContext,
+                                        &serverInfo,
+                                        &opensslCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+    }
+}
+
+/**
+ * @brief Test that #Openssl_Connect is able to return #OPENSSL_HANDSHAKE_FAILED
+ * when failing to perform the TLS handshake.
+ */
+void test_Openssl_Connect_Handshake_Fails( void )
+{
+    OpensslStatus_t returnStatus, expectedStatus;
+    FunctionNames_t connectFunctions[] =
     {
         SSL_set1_host_fn, SSL_connect_fn, SSL_get_verify_result_fn
     };
     uint16_t i;
 
-    for( i = 0; i < sizeof( connectFunctions ) / sizeof( FunctionNames_t ); i++ )
-    {
-        expectedStatus = failFunctionFrom_Openssl_Connect( connectFunctions[ i ],
-                                                           NULL );
+    for( i = 0; i < sizeof( connectFunctions ) / sizeof( FunctionNames_t ); i++ )
+    {
+        expectedStatus = failFunctionFrom_Openssl_Connect( connectFunctions[ i ],
+                                                           NULL );
+        returnStatus = Openssl_Connect( &networkContext,
+                                        &serverInfo,
+                                        &opensslCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+    }
+}
+
+/**
+ * @brief Cover cases in which TLS credentials and configuration parameters are
+ * set to NULL.
+ */
+void test_Openssl_Connect_NULL_Members_In_Creds_And_Configs( void )
+{
+    OpensslStatus_t returnStatus, expectedStatus = OPENSSL_INVALID_CREDENTIALS;
+
+    /* Coverage for NULL pRootCaPath. */
+    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
+    expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                       NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+
+    /* Coverage for NULL pClientCertPath, pPrivateKeyPath, pAlpnProtos, sniHostName,
+     * and maxFragmentLength == 0. */
+    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+    expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                       NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+
+    /* Coverage for alpnProtosLen == 0. */
+    opensslCredentials.pAlpnProtos = ALPN_PROTOS;
+    expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                       NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+}
+
+/**
+ * @brief Test the happy path case in which the TLS connection is established.
+ */
+void test_Openssl_Connect_Succeeds( void )
+{
+    OpensslStatus_t returnStatus;
+
+    /* Set the parameter to one more that the max enum value of the function names
+     * so that no functions fail for this happy path case. */
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Openssl_Connect enables kernel TLS offload when requested
+ * and records which directions the kernel took over.
+ */
+void test_Openssl_Connect_Enables_Ktls( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.enableKtls = true;
+    ktlsSend = true;
+    ktlsRecv = false;
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_TRUE( opensslParams.ktlsSendEnabled );
+    TEST_ASSERT_FALSE( opensslParams.ktlsRecvEnabled );
+}
+
+/**
+ * @brief Test that #Openssl_Connect offers the cipher suites in the order of
+ * a fixed cipher policy.
+ */
+void test_Openssl_Connect_Sets_Cipher_Order( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.cipherPolicy = OPENSSL_CIPHERS_PREFER_CHACHA20;
+    pExpectedCipherSuites = "TLS_CHACHA20_POLY1305_SHA256:"
+                            "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384";
+    pExpectedCipherList = "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:"
+                          "DHE-RSA-CHACHA20-POLY1305:"
+                          "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+                          "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:"
+                          "DHE-RSA-AES128-GCM-SHA256:DHE-RSA-AES256-GCM-SHA384";
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    opensslCredentials.cipherPolicy = OPENSSL_CIPHERS_PREFER_AES_GCM;
+    pExpectedCipherSuites = "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:"
+                            "TLS_CHACHA20_POLY1305_SHA256";
+    pExpectedCipherList = "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+                          "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:"
+                          "DHE-RSA-AES128-GCM-SHA256:DHE-RSA-AES256-GCM-SHA384:"
+                          "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:"
+                          "DHE-RSA-CHACHA20-POLY1305";
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Openssl_Connect sends the early data in the first flight
+ * when the resumed session allows it, and after the handshake otherwise.
+ */
+void test_Openssl_Connect_Sends_Early_Data( void )
+{
+    OpensslStatus_t returnStatus;
+    static const uint8_t earlyData[] = { 0x10, 0x02, 0x00, 0x00 };
+
+    opensslCredentials.pEarlyData = earlyData;
+    opensslCredentials.earlyDataLength = sizeof( earlyData );
+    opensslCredentials.earlyDataReplaySafe = true;
+
+    /* The session allows early data and the server accepts it. */
+    maxEarlyData = sizeof( earlyData );
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_TRUE( opensslParams.earlyDataAccepted );
+
+    /* The server rejects the early data, which is sent again. */
+    earlyDataStatus = SSL_EARLY_DATA_REJECTED;
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_FALSE( opensslParams.earlyDataAccepted );
+
+    /* Data which is not safe to replay is never sent as early data. */
+    opensslCredentials.earlyDataReplaySafe = false;
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_FALSE( opensslParams.earlyDataAccepted );
+
+    /* Early data is not supported by the non-blocking handshake. */
+    returnStatus = Openssl_ConnectStart( &networkContext,
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+}
+
+/**
+ * @brief Test that #Openssl_Connect releases the idle buffers of the
+ * connection and negotiates its fragment length when requested.
+ */
+void test_Openssl_Connect_Releases_Idle_Buffers( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.releaseIdleBuffers = true;
+    opensslCredentials.maxFragmentLength = 1024U;
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_EQUAL( 1024U, opensslParams.maxSendFragment );
+}
+
+/**
+ * @brief Test that #Openssl_Connect requests a stapled OCSP response, and
+ * only fails without one when a good status is required.
+ */
+void test_Openssl_Connect_Checks_Ocsp_Staple( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.ocspMode = OPENSSL_OCSP_REQUEST;
+    opensslCredentials.cacheVerifiedChains = true;
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    opensslCredentials.ocspMode = OPENSSL_OCSP_REQUIRE;
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_HANDSHAKE_FAILED, returnStatus );
+}
+
+/**
+ * @brief Test that #Openssl_Connect reuses the cached SSL context for the same
+ * credentials without loading them again, and that #Openssl_ReleaseCredentials
+ * releases it.
+ */
+void test_Openssl_Connect_Reuses_Cached_SslContext( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.cacheSslContext = true;
+
+    /* The first connection loads the credentials and caches the context. */
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* The second connection skips creating the context and reading the
+     * credential files. */
+    expectSocketsConnect( SOCKETS_SUCCESS );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_CTX_free_Expect( &sslCtx );
+    SSL_set1_host_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_alpn_protos_ExpectAnyArgsAndReturn( 0 );
+    SSL_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_default_read_buffer_len_ExpectAnyArgs();
+    SSL_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* Releasing drops the reference held by the cache. */
+    SSL_CTX_free_Expect( &sslCtx );
+    returnStatus = Openssl_ReleaseCredentials( &opensslCredentials );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* Releasing credentials that are not cached is not an error. */
+    returnStatus = Openssl_ReleaseCredentials( &opensslCredentials );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    returnStatus = Openssl_ReleaseCredentials( NULL );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+}
+
+/**
+ * @brief Test that the SSL context cache keys the cached context by copies of
+ * the credential paths, which #Openssl_ReleaseCredentials frees.
+ */
+void test_Openssl_Connect_Copies_Cached_Credential_Paths( void )
+{
+    OpensslStatus_t returnStatus;
+    char rootCaPath[] = ROOT_CA_CERT_PATH;
+    char clientCertPath[] = CLIENT_CERT_PATH;
+    char privateKeyPath[] = PRIVATE_KEY_PATH;
+    AllocatorStats_t before, after;
+
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_TRANSPORT, &before );
+
+    opensslCredentials.cacheSslContext = true;
+    opensslCredentials.pRootCaPath = rootCaPath;
+    opensslCredentials.pClientCertPath = clientCertPath;
+    opensslCredentials.pPrivateKeyPath = privateKeyPath;
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* The cache holds a copy of each path. */
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_TRANSPORT, &after );
+    TEST_ASSERT_EQUAL_UINT64( before.blocks + 3U, after.blocks );
+
+    /* The strings of the caller are overwritten, and the context is still
+     * found by other strings with the same paths. */
+    ( void ) memset( rootCaPath, 'x', sizeof( rootCaPath ) - 1U );
+    ( void ) memset( clientCertPath, 'x', sizeof( clientCertPath ) - 1U );
+    ( void ) memset( privateKeyPath, 'x', sizeof( privateKeyPath ) - 1U );
+    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
+    opensslCredentials.pClientCertPath = CLIENT_CERT_PATH;
+    opensslCredentials.pPrivateKeyPath = PRIVATE_KEY_PATH;
+
+    SSL_CTX_free_Expect( &sslCtx );
+    returnStatus = Openssl_ReleaseCredentials( &opensslCredentials );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* Releasing the context frees the copies. */
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_TRANSPORT, &after );
+    TEST_ASSERT_EQUAL_UINT64( before.blocks, after.blocks );
+}
+
+/**
+ * @brief Test that #Openssl_UseAllocator installs memory functions counting
+ * the blocks of OpenSSL under #ALLOCATOR_SUBSYSTEM_OPENSSL, and reports that
+ * OpenSSL refused them.
+ */
+void test_Openssl_UseAllocator( void )
+{
+    OpensslStatus_t returnStatus;
+    AllocatorStats_t before, after;
+    void * pBlock = NULL;
+
+    CRYPTO_set_mem_functions_Stub( captureMemFunctions );
+    returnStatus = Openssl_UseAllocator();
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_NOT_NULL( opensslMallocFunction );
+    TEST_ASSERT_NOT_NULL( opensslReallocFunction );
+    TEST_ASSERT_NOT_NULL( opensslFreeFunction );
+
+    /* The blocks OpenSSL allocates are counted until it frees them. */
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_OPENSSL, &before );
+
+    pBlock = opensslMallocFunction( BUFFER_LEN, __FILE__, __LINE__ );
+    TEST_ASSERT_NOT_NULL( pBlock );
+    pBlock = opensslReallocFunction( pBlock, BUFFER_LEN * 2, __FILE__, __LINE__ );
+    TEST_ASSERT_NOT_NULL( pBlock );
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_OPENSSL, &after );
+    TEST_ASSERT_EQUAL_UINT64( before.blocks + 1U, after.blocks );
+
+    opensslFreeFunction( pBlock, __FILE__, __LINE__ );
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_OPENSSL, &after );
+    TEST_ASSERT_EQUAL_UINT64( before.blocks, after.blocks );
+
+    /* OpenSSL refuses the functions once it has allocated memory. */
+    CRYPTO_set_mem_functions_Stub( NULL );
+    CRYPTO_set_mem_functions_ExpectAnyArgsAndReturn( 0 );
+    returnStatus = Openssl_UseAllocator();
+    TEST_ASSERT_EQUAL( OPENSSL_API_ERROR, returnStatus );
+}
+
+/**
+ * @brief Test that the TLS session issued by the server is saved, offered by
+ * the next #Openssl_Connect to the same host, and dropped by
+ * #Openssl_ReleaseCredentials.
+ */
+void test_Openssl_Connect_Resumes_Cached_Session( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.cacheSession = true;
+    opensslCredentials.pSessionFilePath = SESSION_FILE_PATH;
+
+    /* The first connection has no session to resume. */
+    SSL_CTX_sess_set_new_cb_AddCallback( captureNewSessionCallback );
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_NOT_NULL( newSessionCallback );
+
+    /* The session issued by the server is persisted and kept in memory. */
+    SSL_get_ex_data_ExpectAndReturn( &ssl, 0, &opensslParams );
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+    fopen_ExpectAnyArgsAndReturn( &sessionFile );
+    PEM_write_SSL_SESSION_ExpectAndReturn( &sessionFile, &sslSession, 1 );
+    fclose_ExpectAnyArgsAndReturn( 0 );
+    SSL_get_SSL_CTX_ExpectAndReturn( &ssl, &sslCtx );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    TEST_ASSERT_EQUAL( 1, newSessionCallback( &ssl, &sslSession ) );
+
+    /* Sessions of connections without session caching are not kept. */
+    SSL_get_ex_data_ExpectAndReturn( &ssl, 0, NULL );
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+    TEST_ASSERT_EQUAL( 0, newSessionCallback( &ssl, &sslSession ) );
+
+    /* The next connection offers the cached session. */
+    sessionCached = true;
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* Releasing the credentials drops the cached session, and its reference
+     * to the SSL context. */
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+    SSL_SESSION_free_Expect( &sslSession );
+    SSL_CTX_free_Expect( &sslCtx );
+    returnStatus = Openssl_ReleaseCredentials( &opensslCredentials );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that a TLS session kept in memory is only offered to
+ * connections to the same port, made from the SSL context the session was
+ * issued on.
+ */
+void test_Openssl_Connect_Offers_Session_Of_Same_Context_And_Port( void )
+{
+    OpensslStatus_t returnStatus;
+    SSL_CTX otherSslCtx = { 0 };
+    SSL_SESSION otherSession = { 0 };
+
+    opensslCredentials.cacheSession = true;
+
+    SSL_CTX_sess_set_new_cb_AddCallback( captureNewSessionCallback );
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_NOT_NULL( newSessionCallback );
+
+    /* A session issued on another context is kept, but not offered. */
+    SSL_get_ex_data_ExpectAndReturn( &ssl, 0, &opensslParams );
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &otherSession, HOSTNAME );
+    SSL_get_SSL_CTX_ExpectAndReturn( &ssl, &otherSslCtx );
+    SSL_CTX_up_ref_ExpectAndReturn( &otherSslCtx, 1 );
+    TEST_ASSERT_EQUAL( 1, newSessionCallback( &ssl, &otherSession ) );
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* A session of the same server replaces it, whichever context it was
+     * issued on. */
+    SSL_get_ex_data_ExpectAndReturn( &ssl, 0, &opensslParams );
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+    SSL_get_SSL_CTX_ExpectAndReturn( &ssl, &sslCtx );
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &otherSession, HOSTNAME );
+    SSL_SESSION_free_Expect( &otherSession );
+    SSL_CTX_free_Expect( &otherSslCtx );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    TEST_ASSERT_EQUAL( 1, newSessionCallback( &ssl, &sslSession ) );
+
+    /* The session is not offered to another port of the host. */
+    serverInfo.port = PORT + 1;
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* But to the port and context it was issued for. */
+    serverInfo.port = PORT;
+    sessionCached = true;
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+    SSL_SESSION_free_Expect( &sslSession );
+    SSL_CTX_free_Expect( &sslCtx );
+    returnStatus = Openssl_ReleaseCredentials( &opensslCredentials );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that a cached SSL context is set up for the session cache when
+ * it is created, and not again by the connections reusing it.
+ */
+void test_Openssl_Connect_Sets_Up_Session_Cache_Once( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.cacheSslContext = true;
+    opensslCredentials.cacheSession = true;
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* The second connection neither sets the session cache mode nor the
+     * callback of the shared context. */
+    expectSocketsConnect( SOCKETS_SUCCESS );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    SSL_new_ExpectAndReturn( &sslCtx, &ssl );
+    SSL_set_ex_data_ExpectAndReturn( &ssl, 0, &opensslParams, 1 );
+    SSL_CTX_free_Expect( &sslCtx );
+    SSL_set1_host_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_verify_ExpectAnyArgs();
+    SSL_set_fd_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_alpn_protos_ExpectAnyArgsAndReturn( 0 );
+    SSL_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_set_default_read_buffer_len_ExpectAnyArgs();
+    SSL_ctrl_ExpectAnyArgsAndReturn( 1 );
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    SSL_CTX_free_Expect( &sslCtx );
+    returnStatus = Openssl_ReleaseCredentials( &opensslCredentials );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that #Openssl_Connect offers the TLS session saved in the
+ * session file when none is cached in memory.
+ */
+void test_Openssl_Connect_Resumes_Saved_Session( void )
+{
+    OpensslStatus_t returnStatus;
+
+    opensslCredentials.cacheSession = true;
+    opensslCredentials.pSessionFilePath = SESSION_FILE_PATH;
+    sessionSaved = true;
+
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+}
+
+/**
+ * @brief Test that the TLS session issued by the server is written to the
+ * shared session cache, and offered from there once it is no longer cached
+ * in memory.
+ */
+void test_Openssl_Connect_Resumes_Shared_Session( void )
+{
+    OpensslStatus_t returnStatus;
+
+    ( void ) memset( sharedSessionCache, 0, sizeof( sharedSessionCache ) );
+
+    returnStatus = Openssl_OpenSharedSessionCache( NULL );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+
+    mmap_ExpectAnyArgsAndReturn( sharedSessionCache );
+    close_ExpectAnyArgsAndReturn( 0 );
+    returnStatus = Openssl_OpenSharedSessionCache( SHARED_CACHE_FILE_PATH );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    /* A process opens a single cache. */
+    returnStatus = Openssl_OpenSharedSessionCache( SHARED_CACHE_FILE_PATH );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+
+    /* The first connection finds no session in the empty cache. */
+    opensslCredentials.cacheSession = true;
+    SSL_CTX_sess_set_new_cb_AddCallback( captureNewSessionCallback );
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_NOT_NULL( newSessionCallback );
+
+    /* The session issued by the server is shared and kept in memory. */
+    SSL_get_ex_data_ExpectAndReturn( &ssl, 0, &opensslParams );
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+    i2d_SSL_SESSION_ExpectAnyArgsAndReturn( SESSION_ENCODING_LEN );
+    i2d_SSL_SESSION_ExpectAnyArgsAndReturn( SESSION_ENCODING_LEN );
+    SSL_get_SSL_CTX_ExpectAndReturn( &ssl, &sslCtx );
+    SSL_CTX_up_ref_ExpectAndReturn( &sslCtx, 1 );
+    TEST_ASSERT_EQUAL( 1, newSessionCallback( &ssl, &sslSession ) );
+
+    /* Once dropped from memory, the session is read from the shared cache,
+     * as another process would. */
+    SSL_SESSION_get0_hostname_ExpectAndReturn( &sslSession, HOSTNAME );
+    SSL_SESSION_free_Expect( &sslSession );
+    SSL_CTX_free_Expect( &sslCtx );
+    returnStatus = Openssl_ReleaseCredentials( &opensslCredentials );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    sessionShared = true;
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                               NULL );
+    returnStatus = Openssl_Connect( &networkContext,
+                                    &serverInfo,
+                                    &opensslCredentials,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+    munmap_ExpectAnyArgsAndReturn( 0 );
+    Openssl_CloseSharedSessionCache();
+}
+
+/**
+ * @brief Test that a shared session cache file laid out for other dimensions
+ * is not used.
+ */
+void test_Openssl_OpenSharedSessionCache_Rejects_Other_Layout( void )
+{
+    OpensslStatus_t returnStatus;
+
+    ( void ) memset( sharedSessionCache, 0, sizeof( sharedSessionCache ) );
+    sharedSessionCache[ 0 ] = 0x53534331U;
+    sharedSessionCache[ 1 ] = OPENSSL_SHARED_SESSION_SLOTS + 1U;
+
+    mmap_ExpectAnyArgsAndReturn( sharedSessionCache );
+    close_ExpectAnyArgsAndReturn( 0 );
+    munmap_ExpectAnyArgsAndReturn( 0 );
+    returnStatus = Openssl_OpenSharedSessionCache( SHARED_CACHE_FILE_PATH );
+    TEST_ASSERT_EQUAL( OPENSSL_API_ERROR, returnStatus );
+
+    /* Closing without an open cache does nothing. */
+    Openssl_CloseSharedSessionCache();
+}
+
+/**
+ * @brief Test that #Openssl_Connect fails to load a private key on the token
+ * when the key method signing with the token cannot be created, and creates it
+ * on the next connection.
+ *
+ * @note This test must run before the other PKCS #11 tests, since the key
+ * method is kept once created.
+ */
+void test_Openssl_Connect_Pkcs11_Key_Method_Unavailable( void )
+{
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        OpensslStatus_t returnStatus, expectedStatus;
+
+        opensslCredentials.pPrivateKeyPath = PKCS11_PRIVATE_KEY_URI;
+
+        pkcs11Failure = PKCS11_NO_KEY_METHOD;
+        expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                           NULL );
+        returnStatus = Openssl_Connect( &networkContext,
+                                        &serverInfo,
+                                        &opensslCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( OPENSSL_INVALID_CREDENTIALS, expectedStatus );
+        TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+        TEST_ASSERT_FALSE( pkcs11KeyMethodCreated );
+
+        pkcs11Failure = PKCS11_NO_FAILURE;
+        ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                   NULL );
+        returnStatus = Openssl_Connect( &networkContext,
+                                        &serverInfo,
+                                        &opensslCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+        TEST_ASSERT_TRUE( pkcs11KeyMethodCreated );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with PKCS #11 credentials." );
+    #endif
+}
+
+/**
+ * @brief Test that #Openssl_Connect signs with the private key on the token
+ * named by a PKCS #11 URI, and that the connections share one session on the
+ * token.
+ */
+void test_Openssl_Connect_Loads_Pkcs11_Private_Key( void )
+{
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        OpensslStatus_t returnStatus;
+
+        opensslCredentials.pPrivateKeyPath = PKCS11_PRIVATE_KEY_URI;
+
+        /* The first connection opens the session. */
+        ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                   NULL );
         returnStatus = Openssl_Connect( &networkContext,
                                         &serverInfo,
                                         &opensslCredentials,
                                         SEND_RECV_TIMEOUT,
                                         SEND_RECV_TIMEOUT );
-        TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
-    }
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+        TEST_ASSERT_TRUE( pkcs11SessionOpen );
+
+        /* The second connection finds its key in the same session. */
+        ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                   NULL );
+        returnStatus = Openssl_Connect( &networkContext,
+                                        &serverInfo,
+                                        &opensslCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+        returnStatus = Openssl_ClosePkcs11Session();
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+        pkcs11SessionOpen = false;
+
+        /* Closing without an open session does nothing. */
+        functionList.C_CloseSession = NULL;
+        returnStatus = Openssl_ClosePkcs11Session();
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with PKCS #11 credentials." );
+    #endif
 }
 
 /**
- * @brief Cover cases in which TLS credentials and configuration parameters are
- * set to NULL.
+ * @brief Test that #Openssl_Connect returns #OPENSSL_INVALID_CREDENTIALS for
+ * a private key on the token without an elliptic curve client certificate
+ * providing its public key, or without a label in its URI.
  */
-void test_Openssl_Connect_NULL_Members_In_Creds_And_Configs( void )
+void test_Openssl_Connect_Pkcs11_Private_Key_Needs_Ec_Certificate( void )
 {
-    OpensslStatus_t returnStatus, expectedStatus = OPENSSL_INVALID_CREDENTIALS;
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        OpensslStatus_t returnStatus, expectedStatus;
+        Pkcs11Failure_t failures[] =
+        {
+            PKCS11_NO_CERTIFICATE, PKCS11_NOT_EC_KEY, PKCS11_NO_LABEL
+        };
+        uint16_t i;
 
-    /* Coverage for NULL pRootCaPath. */
-    memset( &opensslCredentials, 0, sizeof( OpensslCredentials_t ) );
-    expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
-                                                       NULL );
-    returnStatus = Openssl_Connect( &networkContext,
-                                    &serverInfo,
-                                    &opensslCredentials,
-                                    SEND_RECV_TIMEOUT,
-                                    SEND_RECV_TIMEOUT );
-    TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+        for( i = 0; i < sizeof( failures ) / sizeof( Pkcs11Failure_t ); i++ )
+        {
+            pkcs11Failure = failures[ i ];
+            opensslCredentials.pPrivateKeyPath = ( pkcs11Failure == PKCS11_NO_LABEL ) ?
+                                                 "pkcs11:id=%01;type=private" :
+                                                 PKCS11_PRIVATE_KEY_URI;
+            expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                               NULL );
+            returnStatus = Openssl_Connect( &networkContext,
+                                            &serverInfo,
+                                            &opensslCredentials,
+                                            SEND_RECV_TIMEOUT,
+                                            SEND_RECV_TIMEOUT );
+            TEST_ASSERT_EQUAL( OPENSSL_INVALID_CREDENTIALS, expectedStatus );
+            TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+        }
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with PKCS #11 credentials." );
+    #endif
+}
 
-    /* Coverage for NULL pClientCertPath, pPrivateKeyPath, pAlpnProtos, sniHostName,
-     * and maxFragmentLength == 0. */
-    opensslCredentials.pRootCaPath = ROOT_CA_CERT_PATH;
-    expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
-                                                       NULL );
-    returnStatus = Openssl_Connect( &networkContext,
-                                    &serverInfo,
-                                    &opensslCredentials,
-                                    SEND_RECV_TIMEOUT,
-                                    SEND_RECV_TIMEOUT );
-    TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+/**
+ * @brief Test that #Openssl_Connect returns #OPENSSL_INVALID_CREDENTIALS when
+ * the PKCS #11 module or a session on the token is not available, and opens
+ * the session on the next connection.
+ */
+void test_Openssl_Connect_Pkcs11_Token_Unavailable( void )
+{
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        OpensslStatus_t returnStatus, expectedStatus;
+        Pkcs11Failure_t failures[] =
+        {
+            PKCS11_NO_SESSION, PKCS11_NO_MODULE, PKCS11_NO_FAILURE
+        };
+        uint16_t i;
 
-    /* Coverage for alpnProtosLen == 0. */
-    opensslCredentials.pAlpnProtos = ALPN_PROTOS;
-    expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
-                                                       NULL );
-    returnStatus = Openssl_Connect( &networkContext,
-                                    &serverInfo,
-                                    &opensslCredentials,
-                                    SEND_RECV_TIMEOUT,
-                                    SEND_RECV_TIMEOUT );
-    TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+        opensslCredentials.pPrivateKeyPath = PKCS11_PRIVATE_KEY_URI;
+
+        for( i = 0; i < sizeof( failures ) / sizeof( Pkcs11Failure_t ); i++ )
+        {
+            pkcs11Failure = failures[ i ];
+            expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                               NULL );
+            returnStatus = Openssl_Connect( &networkContext,
+                                            &serverInfo,
+                                            &opensslCredentials,
+                                            SEND_RECV_TIMEOUT,
+                                            SEND_RECV_TIMEOUT );
+            TEST_ASSERT_EQUAL( ( pkcs11Failure == PKCS11_NO_FAILURE ) ?
+                               OPENSSL_SUCCESS : OPENSSL_INVALID_CREDENTIALS,
+                               expectedStatus );
+            TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+        }
+
+        TEST_ASSERT_TRUE( pkcs11SessionOpen );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with PKCS #11 credentials." );
+    #endif
 }
 
 /**
- * @brief Test the happy path case in which the TLS connection is established.
+ * @brief Test that #Openssl_Connect returns #OPENSSL_INVALID_CREDENTIALS when
+ * the private key is not found on the token, or is rejected by the SSL
+ * context.
  */
-void test_Openssl_Connect_Succeeds( void )
+void test_Openssl_Connect_Pkcs11_Private_Key_Not_Found( void )
+{
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        OpensslStatus_t returnStatus, expectedStatus;
+        Pkcs11Failure_t failures[] =
+        {
+            PKCS11_KEY_REJECTED, PKCS11_FIND_ERROR, PKCS11_KEY_NOT_FOUND
+        };
+        uint16_t i;
+
+        opensslCredentials.pPrivateKeyPath = PKCS11_PRIVATE_KEY_URI;
+
+        for( i = 0; i < sizeof( failures ) / sizeof( Pkcs11Failure_t ); i++ )
+        {
+            pkcs11Failure = failures[ i ];
+            expectedStatus = failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                               NULL );
+            returnStatus = Openssl_Connect( &networkContext,
+                                            &serverInfo,
+                                            &opensslCredentials,
+                                            SEND_RECV_TIMEOUT,
+                                            SEND_RECV_TIMEOUT );
+            TEST_ASSERT_EQUAL( OPENSSL_INVALID_CREDENTIALS, expectedStatus );
+            TEST_ASSERT_EQUAL( expectedStatus, returnStatus );
+        }
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with PKCS #11 credentials." );
+    #endif
+}
+
+/**
+ * @brief Test that #Openssl_ClosePkcs11Session returns #OPENSSL_API_ERROR
+ * when the token fails to close the session, which is not used again.
+ */
+void test_Openssl_ClosePkcs11Session_Fails( void )
+{
+    #if ( OPENSSL_PKCS11_ENABLED == 1 )
+        OpensslStatus_t returnStatus;
+
+        opensslCredentials.pPrivateKeyPath = PKCS11_PRIVATE_KEY_URI;
+
+        ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                   NULL );
+        returnStatus = Openssl_Connect( &networkContext,
+                                        &serverInfo,
+                                        &opensslCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+
+        closeSessionResult = CKR_SESSION_HANDLE_INVALID;
+        returnStatus = Openssl_ClosePkcs11Session();
+        TEST_ASSERT_EQUAL( OPENSSL_API_ERROR, returnStatus );
+        pkcs11SessionOpen = false;
+
+        /* The next connection opens a new session. */
+        ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
+                                                   NULL );
+        returnStatus = Openssl_Connect( &networkContext,
+                                        &serverInfo,
+                                        &opensslCredentials,
+                                        SEND_RECV_TIMEOUT,
+                                        SEND_RECV_TIMEOUT );
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+        TEST_ASSERT_TRUE( pkcs11SessionOpen );
+
+        /* The new session is closed by #tearDown. */
+        closeSessionResult = CKR_OK;
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with PKCS #11 credentials." );
+    #endif
+}
+
+/**
+ * @brief Test that a connection started with #Openssl_ConnectStart reports
+ * the socket event to wait for until the TCP connection and the TLS handshake
+ * complete.
+ */
+void test_Openssl_ConnectPoll_Completes_Handshake( void )
 {
     OpensslStatus_t returnStatus;
 
-    /* Set the parameter to one more that the max enum value of the function names
-     * so that no functions fail for this happy path case. */
-    ( void ) failFunctionFrom_Openssl_Connect( SSL_get_verify_result_fn + 1,
-                                               NULL );
-    returnStatus = Openssl_Connect( &networkContext,
-                                    &serverInfo,
-                                    &opensslCredentials,
-                                    SEND_RECV_TIMEOUT,
-                                    SEND_RECV_TIMEOUT );
+    /* The TCP connection is in progress. */
+    Sockets_ConnectStart_ExpectAnyArgsAndReturn( SOCKETS_WANT_WRITE );
+    returnStatus = Openssl_ConnectStart( &networkContext,
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_WANT_WRITE, returnStatus );
+    TEST_ASSERT_EQUAL( OPENSSL_CONNECT_STATE_TCP, opensslParams.connectState );
+
+    Sockets_ConnectPoll_ExpectAnyArgsAndReturn( SOCKETS_WANT_WRITE );
+    returnStatus = Openssl_ConnectPoll( &networkContext );
+    TEST_ASSERT_EQUAL( OPENSSL_WANT_WRITE, returnStatus );
+
+    /* The TCP connection completes and the handshake waits for the server. */
+    asyncConnect = true;
+    Sockets_ConnectPoll_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_connect_fn, NULL );
+    returnStatus = Openssl_ConnectPoll( &networkContext );
+    TEST_ASSERT_EQUAL( OPENSSL_WANT_READ, returnStatus );
+    TEST_ASSERT_EQUAL( OPENSSL_CONNECT_STATE_TLS, opensslParams.connectState );
+
+    SSL_connect_ExpectAnyArgsAndReturn( -1 );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_WANT_WRITE );
+    returnStatus = Openssl_ConnectPoll( &networkContext );
+    TEST_ASSERT_EQUAL( OPENSSL_WANT_WRITE, returnStatus );
+
+    /* The handshake completes and the socket is made blocking again. */
+    SSL_connect_ExpectAnyArgsAndReturn( 1 );
+    SSL_get_verify_result_ExpectAnyArgsAndReturn( X509_V_OK );
+    Sockets_SetNonBlocking_ExpectAndReturn( opensslParams.socketConnectContext.tcpSocket, false, SOCKETS_SUCCESS );
+    returnStatus = Openssl_ConnectPoll( &networkContext );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_EQUAL( OPENSSL_CONNECT_STATE_IDLE, opensslParams.connectState );
+
+    /* No connection is in progress anymore. */
+    returnStatus = Openssl_ConnectPoll( &networkContext );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+}
+
+/**
+ * @brief Test that a connection started with #Openssl_ConnectStart can
+ * complete without waiting, and that a failed handshake releases the
+ * connection.
+ */
+void test_Openssl_ConnectPoll_Handshake_Fails( void )
+{
+    OpensslStatus_t returnStatus;
+
+    /* The TCP connection completes immediately. */
+    asyncConnect = true;
+    Sockets_ConnectStart_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    ( void ) failFunctionFrom_Openssl_Connect( SSL_connect_fn, NULL );
+    returnStatus = Openssl_ConnectStart( &networkContext,
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_WANT_READ, returnStatus );
+
+    SSL_connect_ExpectAnyArgsAndReturn( -1 );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SSL );
+    SSL_free_ExpectAnyArgs();
+    Sockets_Disconnect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    returnStatus = Openssl_ConnectPoll( &networkContext );
+    TEST_ASSERT_EQUAL( OPENSSL_HANDSHAKE_FAILED, returnStatus );
+    TEST_ASSERT_EQUAL( OPENSSL_CONNECT_STATE_IDLE, opensslParams.connectState );
+}
+
+/**
+ * @brief Test that #Openssl_ConnectAbort releases a connection that is in
+ * progress.
+ */
+void test_Openssl_ConnectAbort_Releases_Connection( void )
+{
+    OpensslStatus_t returnStatus;
+
+    returnStatus = Openssl_ConnectStart( NULL,
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+
+    returnStatus = Openssl_ConnectStart( &networkContext,
+                                         &serverInfo,
+                                         NULL,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+
+    returnStatus = Openssl_ConnectPoll( NULL );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+
+    returnStatus = Openssl_ConnectAbort( NULL );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+
+    /* Abort during the TCP connection. */
+    Sockets_ConnectStart_ExpectAnyArgsAndReturn( SOCKETS_WANT_WRITE );
+    returnStatus = Openssl_ConnectStart( &networkContext,
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_WANT_WRITE, returnStatus );
+
+    Sockets_ConnectAbort_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    returnStatus = Openssl_ConnectAbort( &networkContext );
     TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_EQUAL( OPENSSL_CONNECT_STATE_IDLE, opensslParams.connectState );
+
+    /* A failed TCP connection has nothing left to release. */
+    Sockets_ConnectStart_ExpectAnyArgsAndReturn( SOCKETS_CONNECT_FAILURE );
+    returnStatus = Openssl_ConnectStart( &networkContext,
+                                         &serverInfo,
+                                         &opensslCredentials,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( OPENSSL_CONNECT_FAILURE, returnStatus );
+    TEST_ASSERT_EQUAL( OPENSSL_CONNECT_STATE_IDLE, opensslParams.connectState );
 }
 
 /**
@@ -791,6 +2468,80 @@ void test_Openssl_Send_Network_Error( void )
     TEST_ASSERT_EQUAL( -1, bytesSent );
 }
 
+/**
+ * @brief Test that #Openssl_Send writes directly to the socket once the kernel
+ * encrypts sent data, and that a failed send is reported as an error.
+ */
+void test_Openssl_Send_With_Ktls( void )
+{
+    int32_t bytesSent;
+
+    opensslParams.pSsl = &ssl;
+    opensslParams.ktlsSendEnabled = true;
+
+    send_ExpectAndReturn( opensslParams.socketDescriptor,
+                          opensslBuffer,
+                          BYTES_TO_SEND,
+                          MSG_NOSIGNAL,
+                          BYTES_TO_SEND );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    send_ExpectAnyArgsAndReturn( -1 );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+
+    send_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+}
+
+/**
+ * @brief Test that #Openssl_SendFile reads the file and sends it with
+ * #SSL_write, or hands it to #SSL_sendfile once the kernel encrypts sent data.
+ */
+void test_Openssl_SendFile( void )
+{
+    int32_t bytesSent;
+    const int32_t fileDescriptor = 3;
+
+    opensslParams.pSsl = &ssl;
+
+    pread_ExpectAndReturn( fileDescriptor, NULL, BYTES_TO_SEND, 0, BYTES_TO_SEND );
+    pread_IgnoreArg___buf();
+    SSL_write_ExpectAndReturn( &ssl, NULL, BYTES_TO_SEND, BYTES_TO_SEND );
+    SSL_write_IgnoreArg_buf();
+    bytesSent = Openssl_SendFile( &networkContext, fileDescriptor, 0, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    /* Reaching the end of the file is an error. */
+    pread_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Openssl_SendFile( &networkContext, fileDescriptor, 0, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+
+    opensslParams.ktlsSendEnabled = true;
+
+    SSL_sendfile_ExpectAndReturn( &ssl, fileDescriptor, 0, BYTES_TO_SEND, 0, BYTES_TO_SEND );
+    bytesSent = Openssl_SendFile( &networkContext, fileDescriptor, 0, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    SSL_sendfile_ExpectAnyArgsAndReturn( -1 );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SYSCALL );
+    bytesSent = Openssl_SendFile( &networkContext, fileDescriptor, 0, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+
+    /* Invalid parameters. */
+    bytesSent = Openssl_SendFile( NULL, fileDescriptor, 0, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+
+    bytesSent = Openssl_SendFile( &networkContext, -1, 0, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+
+    opensslParams.pSsl = NULL;
+    bytesSent = Openssl_SendFile( &networkContext, fileDescriptor, 0, BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( -1, bytesSent );
+}
+
 /**
  * @brief Test that #Openssl_Recv is able to return that 0 bytes are received
  * from the network stack when passing any invalid parameters.
@@ -870,3 +2621,250 @@ void test_Openssl_Recv_Zero_Return_Value( void )
     bytesReceived = Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV );
     TEST_ASSERT_EQUAL( 0, bytesReceived );
 }
+
+/**
+ * @brief Test that #Openssl_Recv serves small reads from the read-ahead buffer
+ * and only calls #SSL_read again once the buffered data is consumed.
+ */
+void test_Openssl_Recv_Read_Ahead_Buffer( void )
+{
+    int32_t bytesReceived;
+    uint8_t largeBuffer[ READ_AHEAD_LEN + BUFFER_LEN ] = { 0 };
+
+    opensslParams.pSsl = &ssl;
+    opensslParams.pRecvBuffer = readAheadBuffer;
+    opensslParams.recvBufferSize = READ_AHEAD_LEN;
+    opensslParams.recvBufferHead = 0U;
+    opensslParams.recvBufferLength = 0U;
+
+    /* One read fills the buffer and serves two requests. */
+    SSL_read_ExpectAnyArgsAndReturn( READ_AHEAD_LEN );
+    bytesReceived = Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+    bytesReceived = Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+    TEST_ASSERT_EQUAL( 0U, opensslParams.recvBufferLength );
+
+    /* A partially filled buffer returns fewer bytes than requested. */
+    SSL_read_ExpectAnyArgsAndReturn( 1 );
+    bytesReceived = Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 1, bytesReceived );
+
+    /* A request at least as large as the buffer bypasses it. */
+    SSL_read_ExpectAndReturn( &ssl, largeBuffer, sizeof( largeBuffer ), sizeof( largeBuffer ) );
+    bytesReceived = Openssl_Recv( &networkContext, largeBuffer, sizeof( largeBuffer ) );
+    TEST_ASSERT_EQUAL( sizeof( largeBuffer ), bytesReceived );
+    TEST_ASSERT_EQUAL( 0U, opensslParams.recvBufferLength );
+
+    opensslParams.pRecvBuffer = NULL;
+    opensslParams.recvBufferSize = 0U;
+}
+
+/**
+ * @brief Test that #Openssl_Writev gathers all buffers into the send buffer
+ * and sends them with a single #SSL_write.
+ */
+void test_Openssl_Writev_Gathers_Into_One_Write( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVec[ 2 ];
+
+    ioVec[ 0 ].iov_base = opensslBuffer;
+    ioVec[ 0 ].iov_len = BYTES_TO_SEND;
+    ioVec[ 1 ].iov_base = opensslBuffer;
+    ioVec[ 1 ].iov_len = BYTES_TO_SEND;
+
+    opensslParams.pSsl = &ssl;
+    opensslParams.pSendBuffer = gatherBuffer;
+    opensslParams.sendBufferSize = sizeof( gatherBuffer );
+
+    SSL_write_ExpectAndReturn( &ssl, gatherBuffer, BYTES_TO_SEND * 2, BYTES_TO_SEND * 2 );
+    bytesSent = Openssl_Writev( &networkContext, ioVec, 2 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND * 2, bytesSent );
+
+    opensslParams.pSendBuffer = NULL;
+    opensslParams.sendBufferSize = 0U;
+}
+
+/**
+ * @brief Test that #Openssl_Writev sends each buffer separately when no send
+ * buffer is configured, and stops at the first short write.
+ */
+void test_Openssl_Writev_Without_Send_Buffer( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVec[ 3 ];
+
+    ioVec[ 0 ].iov_base = opensslBuffer;
+    ioVec[ 0 ].iov_len = BYTES_TO_SEND;
+    ioVec[ 1 ].iov_base = opensslBuffer;
+    ioVec[ 1 ].iov_len = 0U;
+    ioVec[ 2 ].iov_base = opensslBuffer;
+    ioVec[ 2 ].iov_len = BYTES_TO_SEND;
+
+    opensslParams.pSsl = &ssl;
+    opensslParams.pSendBuffer = NULL;
+
+    /* Empty buffers are skipped. */
+    SSL_write_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    SSL_write_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    bytesSent = Openssl_Writev( &networkContext, ioVec, 3 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND * 2, bytesSent );
+
+    /* A short write stops sending the remaining buffers. */
+    SSL_write_ExpectAnyArgsAndReturn( BYTES_TO_SEND - 1 );
+    bytesSent = Openssl_Writev( &networkContext, ioVec, 3 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND - 1, bytesSent );
+
+    /* An error after some bytes were sent returns the bytes sent. */
+    SSL_write_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    SSL_write_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SSL );
+    bytesSent = Openssl_Writev( &networkContext, ioVec, 3 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    /* An error on the first buffer is returned. */
+    SSL_write_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+    SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_SSL );
+    bytesSent = Openssl_Writev( &networkContext, ioVec, 3 );
+    TEST_ASSERT_EQUAL( SSL_READ_WRITE_ERROR, bytesSent );
+}
+
+/**
+ * @brief Test that #Openssl_GetBufferUsage only counts the record buffers
+ * OpenSSL holds, sized by the negotiated fragment length.
+ */
+void test_Openssl_GetBufferUsage( void )
+{
+    OpensslStatus_t returnStatus;
+    OpensslBufferUsage_t usage;
+    const size_t recordOverhead = SSL3_RT_HEADER_LENGTH + SSL3_RT_MAX_ENCRYPTED_OVERHEAD;
+
+    opensslParams.pSsl = &ssl;
+    opensslParams.maxSendFragment = 512U;
+    opensslParams.pRecvBuffer = opensslBuffer;
+    opensslParams.recvBufferSize = 64U;
+    opensslParams.recvBufferLength = 3U;
+    opensslParams.pSendBuffer = NULL;
+
+    /* Buffers that are not released are always held. */
+    SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+    SSL_SESSION_get_max_fragment_length_ExpectAndReturn( &sslSession, TLSEXT_max_fragment_length_DISABLED );
+    SSL_ctrl_ExpectAndReturn( &ssl, SSL_CTRL_MODE, 0, NULL, SSL_MODE_ENABLE_PARTIAL_WRITE );
+    SSL_pending_ExpectAndReturn( &ssl, 2 );
+    returnStatus = Openssl_GetBufferUsage( &networkContext, &usage );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_FALSE( usage.buffersReleased );
+    TEST_ASSERT_EQUAL( SSL3_RT_MAX_PLAIN_LENGTH + recordOverhead, usage.readBufferBytes );
+    TEST_ASSERT_EQUAL( 512U + recordOverhead, usage.writeBufferBytes );
+    TEST_ASSERT_EQUAL( 64U, usage.transportBufferBytes );
+    TEST_ASSERT_EQUAL( 5U, usage.pendingBytes );
+
+    /* Released buffers are only held while a record is partly read. */
+    SSL_get_session_ExpectAndReturn( &ssl, &sslSession );
+    SSL_SESSION_get_max_fragment_length_ExpectAndReturn( &sslSession, TLSEXT_max_fragment_length_1024 );
+    SSL_ctrl_ExpectAndReturn( &ssl, SSL_CTRL_MODE, 0, NULL, SSL_MODE_RELEASE_BUFFERS );
+    SSL_has_pending_ExpectAndReturn( &ssl, 1 );
+    SSL_want_ExpectAndReturn( &ssl, SSL_NOTHING );
+    SSL_pending_ExpectAndReturn( &ssl, 0 );
+    returnStatus = Openssl_GetBufferUsage( &networkContext, &usage );
+    TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, returnStatus );
+    TEST_ASSERT_TRUE( usage.buffersReleased );
+    TEST_ASSERT_EQUAL( 1024U + recordOverhead, usage.readBufferBytes );
+    TEST_ASSERT_EQUAL( 0U, usage.writeBufferBytes );
+
+    /* A connection that is not established has no buffers to report. */
+    opensslParams.pSsl = NULL;
+    returnStatus = Openssl_GetBufferUsage( &networkContext, &usage );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+    returnStatus = Openssl_GetBufferUsage( &networkContext, NULL );
+    TEST_ASSERT_EQUAL( OPENSSL_INVALID_PARAMETER, returnStatus );
+
+    opensslParams.pRecvBuffer = NULL;
+    opensslParams.recvBufferLength = 0U;
+}
+
+/**
+ * @brief Test that #Openssl_Writev returns 0 for invalid parameters.
+ */
+void test_Openssl_Writev_Invalid_Params( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVec = { opensslBuffer, BYTES_TO_SEND };
+
+    bytesSent = Openssl_Writev( NULL, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    bytesSent = Openssl_Writev( &networkContext, NULL, 1 );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    bytesSent = Openssl_Writev( &networkContext, &ioVec, 0 );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+}
+
+/**
+ * @brief Test that #Openssl_Send counts its call to #SSL_write, and records a
+ * partial send with the number of bytes requested.
+ */
+void test_Openssl_Stats_Count_Partial_Send( void )
+{
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        int32_t bytesSent;
+        TransportStats_t stats;
+
+        opensslParams.pSsl = &ssl;
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_ResetStats( &networkContext ) );
+
+        SSL_write_ExpectAnyArgsAndReturn( BYTES_TO_SEND - 1 );
+        TransportStats_RecordSend_Expect( &opensslParams.stats, BYTES_TO_SEND, BYTES_TO_SEND - 1, 0U );
+        TransportStats_RecordSend_IgnoreArg_startTimeUs();
+        bytesSent = Openssl_Send( &networkContext, opensslBuffer, BYTES_TO_SEND );
+        TEST_ASSERT_EQUAL( BYTES_TO_SEND - 1, bytesSent );
+
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_GetStats( &networkContext, &stats ) );
+        TEST_ASSERT_EQUAL_UINT32( 1U, stats.ioCalls );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with transport statistics." );
+    #endif
+}
+
+/**
+ * @brief Test that #Openssl_Recv counts each call to #SSL_read, the one
+ * returning #SSL_ERROR_WANT_READ and its retry included, and records the
+ * bytes received.
+ */
+void test_Openssl_Stats_Count_Bytes_Received_After_Retry( void )
+{
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        int32_t bytesReceived;
+        TransportStats_t stats;
+
+        opensslParams.pSsl = &ssl;
+        opensslParams.pRecvBuffer = NULL;
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_ResetStats( &networkContext ) );
+
+        /* No data is pending, so the receive is retried. */
+        SSL_read_ExpectAnyArgsAndReturn( SSL_READ_WRITE_ERROR );
+        SSL_get_error_ExpectAnyArgsAndReturn( SSL_ERROR_WANT_READ );
+        TransportStats_RecordRecv_Expect( &opensslParams.stats, 0, 0U );
+        TransportStats_RecordRecv_IgnoreArg_startTimeUs();
+        bytesReceived = Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV );
+        TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+        SSL_read_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+        TransportStats_RecordRecv_Expect( &opensslParams.stats, BYTES_TO_RECV, 0U );
+        TransportStats_RecordRecv_IgnoreArg_startTimeUs();
+        bytesReceived = Openssl_Recv( &networkContext, opensslBuffer, BYTES_TO_RECV );
+        TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_GetStats( &networkContext, &stats ) );
+        TEST_ASSERT_EQUAL_UINT32( 2U, stats.ioCalls );
+
+        /* Resetting the statistics clears the counters. */
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_ResetStats( &networkContext ) );
+        TEST_ASSERT_EQUAL( OPENSSL_SUCCESS, Openssl_GetStats( &networkContext, &stats ) );
+        TEST_ASSERT_EQUAL_UINT32( 0U, stats.ioCalls );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with transport statistics." );
+    #endif
+}
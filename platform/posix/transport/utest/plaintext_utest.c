@@ -32,12 +32,17 @@
 
 #include "mock_sockets_posix.h"
 #include "mock_stdio_api.h"
-#include "mock_select_api.h"
+#include "mock_poll_api.h"
+#include "mock_sendmsg_api.h"
 #include "mock_socket.h"
 
 /* The send and receive timeout to set for the socket. */
 #define SEND_RECV_TIMEOUT    0
 
+/* Timeouts to verify that #Plaintext_Connect caches them. */
+#define SEND_TIMEOUT_MS      100
+#define RECV_TIMEOUT_MS      200
+
 /* The host and port from which to establish the connection. */
 #define HOSTNAME             "amazon.com"
 #define PORT                 80
@@ -49,6 +54,9 @@
 /* The size of the buffer passed to #Plaintext_Send and #Plaintext_Recv. */
 #define BUFFER_LEN           4
 
+/* The size of the read-ahead buffer configured in the transport parameters. */
+#define READ_AHEAD_LEN       ( BUFFER_LEN * 2 )
+
 /* An unknown transport status for the default case. */
 #define UNKNOWN_ERRNO        42
 
@@ -65,15 +73,16 @@ static ServerInfo_t serverInfo = { 0 };
 static NetworkContext_t networkContext = { 0 };
 static PlaintextParams_t plaintextParams = { 0 };
 static uint8_t plaintextBuffer[ BUFFER_LEN ] = { 0 };
+static uint8_t readAheadBuffer[ READ_AHEAD_LEN ] = { 0 };
 
 /* Possible transport status codes referencing the ones from #errno.h. The last
- * one is used for the default case. */
+ * one is used for the default case. EAGAIN and EWOULDBLOCK are not listed as
+ * they cause the socket to be polled instead of returning an error. */
 static uint8_t errorNumbers[] =
 {
-    EBADF,     ECONNRESET,  EDESTADDRREQ, EINTR,
-    EINVAL,    ENOTCONN,    ENOTSOCK,     EOPNOTSUPP,
-    ETIMEDOUT, EMSGSIZE,    EPIPE,
-    EAGAIN,    EWOULDBLOCK, UNKNOWN_ERRNO
+    EBADF,     ECONNRESET, EDESTADDRREQ, EINTR,
+    EINVAL,    ENOTCONN,   ENOTSOCK,     EOPNOTSUPP,
+    ETIMEDOUT, EMSGSIZE,   EPIPE,        UNKNOWN_ERRNO
 };
 
 /* ============================   UNITY FIXTURES ============================ */
@@ -86,6 +95,7 @@ void setUp()
     serverInfo.port = PORT;
 
     networkContext.pParams = &plaintextParams;
+    errno = 0;
 }
 
 /* Called after each test method. */
@@ -106,6 +116,21 @@ int suiteTearDown( int numFailures )
 
 /* ========================================================================== */
 
+/**
+ * @brief Expect the sockets function #Plaintext_Connect connects with, which
+ * records the latencies of the connection when the statistics are collected.
+ *
+ * @param[in] socketStatus The status to return.
+ */
+static void expectSocketsConnect( SocketStatus_t socketStatus )
+{
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        Sockets_ConnectWithStats_ExpectAnyArgsAndReturn( socketStatus );
+    #else
+        Sockets_Connect_ExpectAnyArgsAndReturn( socketStatus );
+    #endif
+}
+
 /**
  * @brief Test that #Plaintext_Connect forwards the status from #Sockets_Connect.
  *
@@ -115,7 +140,7 @@ void test_Plaintext_Connect_Forwards_From_Sockets_Connect( void )
 {
     SocketStatus_t socketStatus;
 
-    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    expectSocketsConnect( SOCKETS_SUCCESS );
     socketStatus = Plaintext_Connect( &networkContext,
                                       &serverInfo,
                                       SEND_RECV_TIMEOUT,
@@ -123,6 +148,24 @@ void test_Plaintext_Connect_Forwards_From_Sockets_Connect( void )
     TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
 }
 
+/**
+ * @brief Test that #Plaintext_Connect caches the send and receive timeouts
+ * in the plaintext parameters.
+ */
+void test_Plaintext_Connect_Caches_Timeouts( void )
+{
+    SocketStatus_t socketStatus;
+
+    expectSocketsConnect( SOCKETS_SUCCESS );
+    socketStatus = Plaintext_Connect( &networkContext,
+                                      &serverInfo,
+                                      SEND_TIMEOUT_MS,
+                                      RECV_TIMEOUT_MS );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( SEND_TIMEOUT_MS, plaintextParams.sendTimeoutMs );
+    TEST_ASSERT_EQUAL( RECV_TIMEOUT_MS, plaintextParams.recvTimeoutMs );
+}
+
 /**
  * @brief Test that a NULL network context returns an error.
  */
@@ -176,15 +219,13 @@ void test_Plaintext_Disconnect_Invalid_Params( void )
 }
 
 /**
- * @brief Test that #Plaintext_Recv returns an error when #recv fails to
- * receive data over the network stack.
+ * @brief Test that #Plaintext_Recv returns immediately without polling when
+ * the first non-blocking #recv succeeds.
  */
 void test_Plaintext_Recv_All_Bytes_Received_Successfully( void )
 {
     int32_t bytesReceived;
 
-    getsockopt_ExpectAnyArgsAndReturn( 0 );
-    select_ExpectAnyArgsAndReturn( 1 );
     recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
     bytesReceived = Plaintext_Recv( &networkContext,
                                     plaintextBuffer,
@@ -193,15 +234,31 @@ void test_Plaintext_Recv_All_Bytes_Received_Successfully( void )
 }
 
 /**
- * @brief Test that #Plaintext_Recv returns an error when #recv receives
- * zero bytes from #recv implying that the peer has closed the connection.
+ * @brief Test that #Plaintext_Recv polls the socket and retries #recv when
+ * the first non-blocking #recv would block.
+ */
+void test_Plaintext_Recv_After_Socket_Ready( void )
+{
+    int32_t bytesReceived;
+
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+}
+
+/**
+ * @brief Test that #Plaintext_Recv returns an error when #recv returns
+ * zero bytes implying that the peer has closed the connection.
  */
 void test_Plaintext_Recv_Zero_Bytes_Received( void )
 {
     int32_t bytesReceived;
 
-    getsockopt_ExpectAnyArgsAndReturn( -1 );
-    select_ExpectAnyArgsAndReturn( 1 );
     recv_ExpectAnyArgsAndReturn( 0 );
     bytesReceived = Plaintext_Recv( &networkContext,
                                     plaintextBuffer,
@@ -210,14 +267,34 @@ void test_Plaintext_Recv_Zero_Bytes_Received( void )
 }
 
 /**
- * @brief Test that #Plaintext_Recv returns 0 bytes when the socket has no activity.
+ * @brief Test that #Plaintext_Recv returns 0 bytes when the socket does not
+ * become readable before the timeout.
  */
 void test_Plaintext_Recv_Socket_Timeout( void )
 {
     int32_t bytesReceived;
 
-    getsockopt_ExpectAnyArgsAndReturn( 0 );
-    select_ExpectAnyArgsAndReturn( 0 );
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EWOULDBLOCK;
+    poll_ExpectAnyArgsAndReturn( 0 );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 0, bytesReceived );
+}
+
+/**
+ * @brief Test that #Plaintext_Recv returns 0 bytes when #recv still would
+ * block after #poll reported the socket as readable.
+ */
+void test_Plaintext_Recv_Spurious_Wakeup( void )
+{
+    int32_t bytesReceived;
+
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( 1 );
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
     bytesReceived = Plaintext_Recv( &networkContext,
                                     plaintextBuffer,
                                     BYTES_TO_RECV );
@@ -225,15 +302,16 @@ void test_Plaintext_Recv_Socket_Timeout( void )
 }
 
 /**
- * @brief Test that #Plaintext_Recv returns an error when calling #select on the
+ * @brief Test that #Plaintext_Recv returns an error when calling #poll on the
  * socket fails.
  */
 void test_Plaintext_Recv_Poll_Error( void )
 {
     int32_t bytesReceived;
 
-    getsockopt_ExpectAnyArgsAndReturn( 0 );
-    select_ExpectAnyArgsAndReturn( -1 );
+    recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( -1 );
     bytesReceived = Plaintext_Recv( &networkContext,
                                     plaintextBuffer,
                                     BYTES_TO_RECV );
@@ -251,8 +329,6 @@ void test_Plaintext_Recv_Network_Error( void )
 
     for( i = 0; i < sizeof( errorNumbers ); i++ )
     {
-        getsockopt_ExpectAnyArgsAndReturn( 0 );
-        select_ExpectAnyArgsAndReturn( 1 );
         recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
         errno = errorNumbers[ i ];
         bytesReceived = Plaintext_Recv( &networkContext,
@@ -264,15 +340,13 @@ void test_Plaintext_Recv_Network_Error( void )
 }
 
 /**
- * @brief Test the happy path case when #Plaintext_Send is able to send all bytes
- * over the network stack successfully.
+ * @brief Test that #Plaintext_Send returns immediately without polling when
+ * the first non-blocking #send succeeds.
  */
 void test_Plaintext_Send_All_Bytes_Sent_Successfully( void )
 {
     int32_t bytesSent;
 
-    getsockopt_ExpectAnyArgsAndReturn( 0 );
-    select_ExpectAnyArgsAndReturn( 1 );
     send_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
     bytesSent = Plaintext_Send( &networkContext,
                                 plaintextBuffer,
@@ -281,38 +355,31 @@ void test_Plaintext_Send_All_Bytes_Sent_Successfully( void )
 }
 
 /**
- * @brief Test that #Plaintext_Send returns an error when #send fails to send
- * data over the network stack.
+ * @brief Test that #Plaintext_Send polls the socket and retries #send when
+ * the first non-blocking #send would block.
  */
-void test_Plaintext_Send_Network_Error( void )
+void test_Plaintext_Send_After_Socket_Ready( void )
 {
     int32_t bytesSent;
-    uint8_t i;
 
-    for( i = 0; i < sizeof( errorNumbers ); i++ )
-    {
-        getsockopt_ExpectAnyArgsAndReturn( 0 );
-        select_ExpectAnyArgsAndReturn( 1 );
-        send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
-        errno = errorNumbers[ i ];
-        bytesSent = Plaintext_Send( &networkContext,
-                                    plaintextBuffer,
-                                    BYTES_TO_SEND );
-
-        TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
-    }
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( 1 );
+    send_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
 }
 
 /**
- * @brief Test that #Plaintext_Send returns an error when #send receives
- * zero bytes from #send implying that the peer has closed the connection.
+ * @brief Test that #Plaintext_Send returns an error when #send returns
+ * zero bytes implying that the peer has closed the connection.
  */
-void test_Plaintext_Send_Zero_Bytes_Received( void )
+void test_Plaintext_Send_Zero_Bytes_Sent( void )
 {
     int32_t bytesSent;
 
-    getsockopt_ExpectAnyArgsAndReturn( -1 );
-    select_ExpectAnyArgsAndReturn( 1 );
     send_ExpectAnyArgsAndReturn( 0 );
     bytesSent = Plaintext_Send( &networkContext,
                                 plaintextBuffer,
@@ -321,14 +388,34 @@ void test_Plaintext_Send_Zero_Bytes_Received( void )
 }
 
 /**
- * @brief Test that #Plaintext_Send returns 0 bytes when the socket has no activity.
+ * @brief Test that #Plaintext_Send returns 0 bytes when the socket does not
+ * become writable before the timeout.
  */
 void test_Plaintext_Send_Socket_Timeout( void )
 {
     int32_t bytesSent;
 
-    getsockopt_ExpectAnyArgsAndReturn( 0 );
-    select_ExpectAnyArgsAndReturn( 0 );
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EWOULDBLOCK;
+    poll_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_Send( &networkContext,
+                                plaintextBuffer,
+                                BYTES_TO_SEND );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+}
+
+/**
+ * @brief Test that #Plaintext_Send returns 0 bytes when #send still would
+ * block after #poll reported the socket as writable.
+ */
+void test_Plaintext_Send_Spurious_Wakeup( void )
+{
+    int32_t bytesSent;
+
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( 1 );
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
     bytesSent = Plaintext_Send( &networkContext,
                                 plaintextBuffer,
                                 BYTES_TO_SEND );
@@ -336,17 +423,238 @@ void test_Plaintext_Send_Socket_Timeout( void )
 }
 
 /**
- * @brief Test that #Plaintext_Send returns an error when calling #select on the
+ * @brief Test that #Plaintext_Send returns an error when calling #poll on the
  * socket fails.
  */
 void test_Plaintext_Send_Poll_Error( void )
 {
     int32_t bytesSent;
 
-    getsockopt_ExpectAnyArgsAndReturn( 0 );
-    select_ExpectAnyArgsAndReturn( -1 );
+    send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( -1 );
     bytesSent = Plaintext_Send( &networkContext,
                                 plaintextBuffer,
                                 BYTES_TO_SEND );
     TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
 }
+
+/**
+ * @brief Test that #Plaintext_Send returns an error when #send fails to
+ * send data over the network stack.
+ */
+void test_Plaintext_Send_Network_Error( void )
+{
+    int32_t bytesSent;
+    uint8_t i;
+
+    for( i = 0; i < sizeof( errorNumbers ); i++ )
+    {
+        send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+        errno = errorNumbers[ i ];
+        bytesSent = Plaintext_Send( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_SEND );
+
+        TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+    }
+}
+
+/**
+ * @brief Test that #Plaintext_Recv serves small reads from the read-ahead buffer
+ * and only calls #recv again once the buffered data is consumed.
+ */
+void test_Plaintext_Recv_Read_Ahead_Buffer( void )
+{
+    int32_t bytesReceived;
+    uint8_t largeBuffer[ READ_AHEAD_LEN + BUFFER_LEN ] = { 0 };
+
+    plaintextParams.pRecvBuffer = readAheadBuffer;
+    plaintextParams.recvBufferSize = READ_AHEAD_LEN;
+    plaintextParams.recvBufferHead = 0U;
+    plaintextParams.recvBufferLength = 0U;
+
+    /* One read fills the buffer and serves two requests. */
+    recv_ExpectAnyArgsAndReturn( READ_AHEAD_LEN );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+    TEST_ASSERT_EQUAL( 0U, plaintextParams.recvBufferLength );
+
+    /* A partially filled buffer returns fewer bytes than requested. */
+    recv_ExpectAnyArgsAndReturn( 1 );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_RECV );
+    TEST_ASSERT_EQUAL( 1, bytesReceived );
+
+    /* A request at least as large as the buffer bypasses it. */
+    recv_ExpectAndReturn( plaintextParams.socketDescriptor,
+                          largeBuffer,
+                          sizeof( largeBuffer ),
+                          MSG_DONTWAIT,
+                          sizeof( largeBuffer ) );
+    bytesReceived = Plaintext_Recv( &networkContext,
+                                    largeBuffer,
+                                    sizeof( largeBuffer ) );
+    TEST_ASSERT_EQUAL( sizeof( largeBuffer ), bytesReceived );
+    TEST_ASSERT_EQUAL( 0U, plaintextParams.recvBufferLength );
+
+    plaintextParams.pRecvBuffer = NULL;
+    plaintextParams.recvBufferSize = 0U;
+}
+
+/**
+ * @brief Test that #Plaintext_Writev sends all buffers with a single #sendmsg.
+ */
+void test_Plaintext_Writev_All_Bytes_Sent_Successfully( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVec[ 2 ];
+
+    ioVec[ 0 ].iov_base = plaintextBuffer;
+    ioVec[ 0 ].iov_len = BYTES_TO_SEND;
+    ioVec[ 1 ].iov_base = plaintextBuffer;
+    ioVec[ 1 ].iov_len = BYTES_TO_SEND;
+
+    sendmsg_ExpectAnyArgsAndReturn( BYTES_TO_SEND * 2 );
+    bytesSent = Plaintext_Writev( &networkContext, ioVec, 2 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND * 2, bytesSent );
+}
+
+/**
+ * @brief Test that #Plaintext_Writev polls the socket when the first
+ * non-blocking #sendmsg would block.
+ */
+void test_Plaintext_Writev_After_Socket_Ready( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVec = { plaintextBuffer, BYTES_TO_SEND };
+
+    sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( 1 );
+    sendmsg_ExpectAnyArgsAndReturn( BYTES_TO_SEND );
+    bytesSent = Plaintext_Writev( &networkContext, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( BYTES_TO_SEND, bytesSent );
+
+    /* Timed out waiting for the socket. */
+    sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_Writev( &networkContext, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( 0, bytesSent );
+
+    /* Polling failed. */
+    sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+    errno = EAGAIN;
+    poll_ExpectAnyArgsAndReturn( -1 );
+    bytesSent = Plaintext_Writev( &networkContext, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+}
+
+/**
+ * @brief Test that #Plaintext_Writev returns an error when #sendmsg fails or
+ * the peer has closed the connection.
+ */
+void test_Plaintext_Writev_Network_Error( void )
+{
+    int32_t bytesSent;
+    struct iovec ioVec = { plaintextBuffer, BYTES_TO_SEND };
+    uint8_t i;
+
+    for( i = 0; i < sizeof( errorNumbers ); i++ )
+    {
+        sendmsg_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+        errno = errorNumbers[ i ];
+        bytesSent = Plaintext_Writev( &networkContext, &ioVec, 1 );
+        TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+    }
+
+    sendmsg_ExpectAnyArgsAndReturn( 0 );
+    bytesSent = Plaintext_Writev( &networkContext, &ioVec, 1 );
+    TEST_ASSERT_EQUAL( SEND_RECV_ERROR, bytesSent );
+}
+
+/**
+ * @brief Test that #Plaintext_Send counts each system call it makes, the
+ * poll and the retry of a #send that would block included, and records a
+ * partial send with the number of bytes requested.
+ */
+void test_Plaintext_Stats_Count_Partial_Send_After_Retry( void )
+{
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        int32_t bytesSent;
+        TransportStats_t stats;
+
+        TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_ResetStats( &networkContext ) );
+
+        send_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+        errno = EAGAIN;
+        poll_ExpectAnyArgsAndReturn( 1 );
+        send_ExpectAnyArgsAndReturn( BYTES_TO_SEND - 1 );
+        TransportStats_RecordSend_Expect( &plaintextParams.stats, BYTES_TO_SEND, BYTES_TO_SEND - 1, 0U );
+        TransportStats_RecordSend_IgnoreArg_startTimeUs();
+        bytesSent = Plaintext_Send( &networkContext,
+                                    plaintextBuffer,
+                                    BYTES_TO_SEND );
+        TEST_ASSERT_EQUAL( BYTES_TO_SEND - 1, bytesSent );
+
+        TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_GetStats( &networkContext, &stats ) );
+        TEST_ASSERT_EQUAL_UINT32( 3U, stats.ioCalls );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with transport statistics." );
+    #endif
+}
+
+/**
+ * @brief Test that #Plaintext_Recv counts each system call it makes, the
+ * poll and the retry of a #recv that would block included, and records the
+ * bytes received.
+ */
+void test_Plaintext_Stats_Count_Bytes_Received_After_Retry( void )
+{
+    #if ( TRANSPORT_STATS_ENABLED == 1 )
+        int32_t bytesReceived;
+        TransportStats_t stats;
+
+        TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_ResetStats( &networkContext ) );
+
+        recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+        errno = EAGAIN;
+        poll_ExpectAnyArgsAndReturn( 1 );
+        recv_ExpectAnyArgsAndReturn( BYTES_TO_RECV );
+        TransportStats_RecordRecv_Expect( &plaintextParams.stats, BYTES_TO_RECV, 0U );
+        TransportStats_RecordRecv_IgnoreArg_startTimeUs();
+        bytesReceived = Plaintext_Recv( &networkContext,
+                                        plaintextBuffer,
+                                        BYTES_TO_RECV );
+        TEST_ASSERT_EQUAL( BYTES_TO_RECV, bytesReceived );
+
+        /* A receive that times out makes the first call and the poll. */
+        recv_ExpectAnyArgsAndReturn( SEND_RECV_ERROR );
+        errno = EAGAIN;
+        poll_ExpectAnyArgsAndReturn( 0 );
+        TransportStats_RecordRecv_Expect( &plaintextParams.stats, 0, 0U );
+        TransportStats_RecordRecv_IgnoreArg_startTimeUs();
+        bytesReceived = Plaintext_Recv( &networkContext,
+                                        plaintextBuffer,
+                                        BYTES_TO_RECV );
+        TEST_ASSERT_EQUAL( 0, bytesReceived );
+
+        TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_GetStats( &networkContext, &stats ) );
+        TEST_ASSERT_EQUAL_UINT32( 5U, stats.ioCalls );
+
+        /* Resetting the statistics clears the counters. */
+        TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_ResetStats( &networkContext ) );
+        TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Plaintext_GetStats( &networkContext, &stats ) );
+        TEST_ASSERT_EQUAL_UINT32( 0U, stats.ioCalls );
+    #else
+        TEST_IGNORE_MESSAGE( "Only run with transport statistics." );
+    #endif
+}
@@ -0,0 +1,299 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "reactor_pool_posix.h"
+
+/* The thread group of the reactors. */
+#define GROUP_NAME         "reactors"
+
+/* The number of reactors used by the tests. */
+#define REACTOR_COUNT      ( 4U )
+
+/* The number of keys hashed by the tests of the shards. */
+#define KEY_COUNT          ( 10000U )
+
+/* The number of tasks posted by the tests. */
+#define TASK_COUNT         ( 100U )
+
+/* The number of yields after which a test stops waiting for a reactor. */
+#define MAX_WAIT_YIELDS    ( 10000000U )
+
+static ReactorPool_t pool;
+
+static ReactorPoolTask_t tasks[ TASK_COUNT ];
+
+/* The order in which the tasks ran, and the threads they ran on. */
+static uint32_t runOrder[ TASK_COUNT ];
+static pthread_t runThreads[ TASK_COUNT ];
+static uint32_t runCount;
+
+/* The thread on which the callback of the pipe ran. */
+static pthread_t readerThread;
+static uint32_t readCount;
+
+/**
+ * @brief Used as the function of the tasks, recording the order in which
+ * they run and their thread.
+ */
+static void recordTask( ReactorPoolTask_t * pTask )
+{
+    TEST_ASSERT_TRUE( runCount < TASK_COUNT );
+
+    runOrder[ runCount ] = ( uint32_t ) ( pTask - tasks );
+    runThreads[ runCount ] = pthread_self();
+    __atomic_store_n( &runCount, runCount + 1U, __ATOMIC_RELEASE );
+}
+
+/**
+ * @brief Used as the function of a task posting the next task to the same
+ * reactor, from the reactor.
+ */
+static void postNextTask( ReactorPoolTask_t * pTask )
+{
+    uint32_t index = ( uint32_t ) ( pTask - tasks );
+
+    recordTask( pTask );
+
+    if( ( index + 1U ) < TASK_COUNT )
+    {
+        tasks[ index + 1U ].function = postNextTask;
+        TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Post( &pool, 1U, &tasks[ index + 1U ] ) );
+    }
+}
+
+/**
+ * @brief Used as the callback of the read end of a pipe.
+ */
+static void pipeCallback( EventLoopConnection_t * pConnection,
+                          uint32_t events )
+{
+    char byte = 0;
+
+    if( ( events & EVENT_LOOP_EVENT_READABLE ) != 0U )
+    {
+        TEST_ASSERT_EQUAL( 1, read( pConnection->fileDescriptor, &byte, 1U ) );
+        readerThread = pthread_self();
+        __atomic_store_n( &readCount, readCount + 1U, __ATOMIC_RELEASE );
+    }
+}
+
+/**
+ * @brief Write a key of the tests of the shards.
+ */
+static size_t makeKey( char * pBuffer,
+                       size_t bufferSize,
+                       uint32_t index )
+{
+    return ( size_t ) snprintf( pBuffer, bufferSize, "fleet-device-%u", ( unsigned int ) index );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( tasks, 0, sizeof( tasks ) );
+    ( void ) memset( runOrder, 0, sizeof( runOrder ) );
+    runCount = 0U;
+    readCount = 0U;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    ReactorPool_Stop( &pool );
+    ReactorPool_Deinit( &pool );
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that the functions of the reactor pool reject the invalid
+ * parameters.
+ */
+void test_ReactorPool_Invalid_Parameters( void )
+{
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Init( NULL, REACTOR_COUNT ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Init( &pool, 0U ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Init( &pool, REACTOR_POOL_MAX_REACTORS + 1U ) );
+
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Init( &pool, REACTOR_COUNT ) );
+    TEST_ASSERT_NULL( ReactorPool_GetEventLoop( NULL, 0U ) );
+    TEST_ASSERT_NULL( ReactorPool_GetEventLoop( &pool, REACTOR_COUNT ) );
+    TEST_ASSERT_EQUAL( 0U, ReactorPool_GetShard( NULL, "key", 3U ) );
+    TEST_ASSERT_EQUAL( 0U, ReactorPool_GetShard( &pool, NULL, 3U ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Post( NULL, 0U, &tasks[ 0 ] ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Post( &pool, 0U, NULL ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Post( &pool, 0U, &tasks[ 0 ] ) );
+    tasks[ 0 ].function = recordTask;
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Post( &pool, REACTOR_COUNT, &tasks[ 0 ] ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Start( NULL, GROUP_NAME ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Start( &pool, NULL ) );
+
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Start( &pool, GROUP_NAME ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Start( &pool, GROUP_NAME ) );
+    ReactorPool_Stop( &pool );
+
+    /* The tasks posted once the reactors are stopped would never run. */
+    TEST_ASSERT_EQUAL( REACTOR_POOL_INVALID_PARAMETER, ReactorPool_Post( &pool, 0U, &tasks[ 0 ] ) );
+    TEST_ASSERT_EQUAL( 0U, runCount );
+}
+
+/**
+ * @brief Test that the keys are spread evenly over the shards, and that a
+ * reactor more only moves keys to the new shard.
+ */
+void test_ReactorPool_GetShard_Is_Consistent( void )
+{
+    ReactorPool_t larger;
+    char key[ 32 ];
+    size_t keyLength = 0U;
+    uint32_t counts[ REACTOR_COUNT ] = { 0U };
+    uint32_t shard = 0U, movedCount = 0U, i = 0U;
+
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Init( &pool, REACTOR_COUNT ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Init( &larger, REACTOR_COUNT + 1U ) );
+
+    for( i = 0U; i < KEY_COUNT; i++ )
+    {
+        keyLength = makeKey( key, sizeof( key ), i );
+        shard = ReactorPool_GetShard( &pool, key, keyLength );
+
+        TEST_ASSERT_TRUE( shard < REACTOR_COUNT );
+        TEST_ASSERT_EQUAL( shard, ReactorPool_GetShard( &pool, key, keyLength ) );
+        counts[ shard ]++;
+
+        if( ReactorPool_GetShard( &larger, key, keyLength ) != shard )
+        {
+            TEST_ASSERT_EQUAL( REACTOR_COUNT, ReactorPool_GetShard( &larger, key, keyLength ) );
+            movedCount++;
+        }
+    }
+
+    ReactorPool_Deinit( &larger );
+
+    /* Each shard has a quarter of the keys, give or take a tenth. */
+    for( shard = 0U; shard < REACTOR_COUNT; shard++ )
+    {
+        TEST_ASSERT_UINT32_WITHIN( KEY_COUNT / ( REACTOR_COUNT * 10U ), KEY_COUNT / REACTOR_COUNT, counts[ shard ] );
+    }
+
+    /* A fifth of the keys move to the fifth reactor. */
+    TEST_ASSERT_UINT32_WITHIN( KEY_COUNT / 50U, KEY_COUNT / ( REACTOR_COUNT + 1U ), movedCount );
+}
+
+/**
+ * @brief Test that the tasks posted to a reactor run on its thread, in the
+ * order they were posted, including those posted from its tasks, and that
+ * #ReactorPool_Stop runs the ones still posted.
+ */
+void test_ReactorPool_Post_Runs_Tasks_In_Order( void )
+{
+    uint32_t i = 0U;
+
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Init( &pool, REACTOR_COUNT ) );
+
+    /* The tasks posted before the start run once the reactor starts. */
+    for( i = 0U; i < ( TASK_COUNT / 2U ); i++ )
+    {
+        tasks[ i ].function = recordTask;
+        TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Post( &pool, 1U, &tasks[ i ] ) );
+    }
+
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Start( &pool, GROUP_NAME ) );
+
+    tasks[ TASK_COUNT / 2U ].function = postNextTask;
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Post( &pool, 1U, &tasks[ TASK_COUNT / 2U ] ) );
+
+    for( i = 0U; ( __atomic_load_n( &runCount, __ATOMIC_ACQUIRE ) < TASK_COUNT ) && ( i < MAX_WAIT_YIELDS ); i++ )
+    {
+        ( void ) sched_yield();
+    }
+
+    ReactorPool_Stop( &pool );
+
+    TEST_ASSERT_EQUAL( TASK_COUNT, runCount );
+
+    for( i = 0U; i < TASK_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( i, runOrder[ i ] );
+        TEST_ASSERT_TRUE( pthread_equal( runThreads[ i ], pool.reactors[ 1 ].thread ) != 0 );
+    }
+}
+
+/**
+ * @brief Test that a connection added to the event loop of a shard is
+ * served by the thread of its reactor.
+ */
+void test_ReactorPool_Serves_Connections_Of_Shard( void )
+{
+    EventLoopConnection_t connection;
+    int descriptors[ 2 ] = { -1, -1 };
+    uint32_t i = 0U;
+
+    TEST_ASSERT_EQUAL( 0, pipe( descriptors ) );
+    ( void ) memset( &connection, 0, sizeof( connection ) );
+    connection.fileDescriptor = descriptors[ 0 ];
+    connection.callback = pipeCallback;
+
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Init( &pool, REACTOR_COUNT ) );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Add( ReactorPool_GetEventLoop( &pool, 2U ), &connection ) );
+    TEST_ASSERT_EQUAL( REACTOR_POOL_SUCCESS, ReactorPool_Start( &pool, GROUP_NAME ) );
+
+    TEST_ASSERT_EQUAL( 1, write( descriptors[ 1 ], "x", 1U ) );
+
+    for( i = 0U; ( __atomic_load_n( &readCount, __ATOMIC_ACQUIRE ) == 0U ) && ( i < MAX_WAIT_YIELDS ); i++ )
+    {
+        ( void ) sched_yield();
+    }
+
+    ReactorPool_Stop( &pool );
+
+    TEST_ASSERT_EQUAL( 1U, readCount );
+    TEST_ASSERT_TRUE( pthread_equal( readerThread, pool.reactors[ 2 ].thread ) != 0 );
+
+    /* The connections are removed from the calling thread, once stopped. */
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Remove( ReactorPool_GetEventLoop( &pool, 2U ), &connection ) );
+    ( void ) close( descriptors[ 0 ] );
+    ( void ) close( descriptors[ 1 ] );
+}
@@ -0,0 +1,347 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "reconnect_scheduler_posix.h"
+
+#include "mock_epoll_api.h"
+#include "mock_clock.h"
+#include "mock_unistd_api.h"
+
+/* The epoll instance returned by the mocked epoll_create1. */
+#define EPOLL_DESCRIPTOR      5
+
+/* The number of endpoints used by the tests. */
+#define NUM_ENDPOINTS         4
+
+/* The number of handshakes allowed in flight by the tests. */
+#define MAX_HANDSHAKES        2U
+
+static EventLoop_t eventLoop;
+static ReconnectScheduler_t scheduler;
+static ReconnectEndpoint_t endpoints[ NUM_ENDPOINTS ];
+
+/* Time returned by the mocked #Clock_GetTimeMs. */
+static uint32_t currentTimeMs;
+
+/* Events reported to #reconnectCallback for each endpoint. */
+static uint32_t connectCount[ NUM_ENDPOINTS ];
+static uint32_t timeoutCount[ NUM_ENDPOINTS ];
+
+/* Whether #reconnectCallback reports a failed handshake at once. */
+static bool failAtOnce;
+
+/**
+ * @brief Return the simulated time from #Clock_GetTimeMs.
+ */
+static uint32_t getTimeMs( int numCalls )
+{
+    ( void ) numCalls;
+
+    return currentTimeMs;
+}
+
+/**
+ * @brief Record the events reported for an endpoint.
+ */
+static void reconnectCallback( ReconnectEndpoint_t * pEndpoint,
+                               ReconnectEvent_t event )
+{
+    size_t index = ( size_t ) ( pEndpoint - endpoints );
+
+    TEST_ASSERT_TRUE( index < NUM_ENDPOINTS );
+
+    if( event == RECONNECT_EVENT_CONNECT )
+    {
+        TEST_ASSERT_EQUAL( RECONNECT_STATE_CONNECTING, pEndpoint->state );
+        TEST_ASSERT_TRUE( scheduler.handshakeCount <= MAX_HANDSHAKES );
+        connectCount[ index ]++;
+
+        if( failAtOnce == true )
+        {
+            TEST_ASSERT_EQUAL( RECONNECT_SUCCESS,
+                               ReconnectScheduler_ReportResult( &scheduler, pEndpoint, false ) );
+        }
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL( RECONNECT_EVENT_HANDSHAKE_TIMEOUT, event );
+        timeoutCount[ index ]++;
+    }
+}
+
+/**
+ * @brief Advance the simulated time and dispatch once with no socket ready.
+ */
+static void dispatchAfter( uint32_t elapsedMs )
+{
+    currentTimeMs += elapsedMs;
+    epoll_wait_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS,
+                       EventLoop_Dispatch( &eventLoop, 0U, NULL ) );
+}
+
+/**
+ * @brief Fail the handshake in flight with an endpoint, and return the delay
+ * drawn for its next attempt.
+ */
+static uint32_t failHandshake( ReconnectEndpoint_t * pEndpoint )
+{
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS,
+                       ReconnectScheduler_ReportResult( &scheduler, pEndpoint, false ) );
+
+    return pEndpoint->lastDelayMs;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    int32_t i;
+
+    currentTimeMs = 1000U;
+    failAtOnce = false;
+    memset( connectCount, 0, sizeof( connectCount ) );
+    memset( timeoutCount, 0, sizeof( timeoutCount ) );
+    Clock_GetTimeMs_Stub( getTimeMs );
+
+    epoll_create1_ExpectAnyArgsAndReturn( EPOLL_DESCRIPTOR );
+    TEST_ASSERT_EQUAL( EVENT_LOOP_SUCCESS, EventLoop_Init( &eventLoop ) );
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS,
+                       ReconnectScheduler_Init( &scheduler, &eventLoop, MAX_HANDSHAKES ) );
+
+    for( i = 0; i < NUM_ENDPOINTS; i++ )
+    {
+        memset( &endpoints[ i ], 0, sizeof( ReconnectEndpoint_t ) );
+        endpoints[ i ].pHostName = "example.com";
+        endpoints[ i ].port = ( uint16_t ) ( 8000 + i );
+        endpoints[ i ].callback = reconnectCallback;
+    }
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that the scheduler functions fail when invalid parameters are
+ * passed or the endpoint is in the wrong state.
+ */
+void test_ReconnectScheduler_Invalid_Params( void )
+{
+    ReconnectEndpoint_t endpoint = { 0 };
+
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Init( NULL, &eventLoop, 1U ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Init( &scheduler, NULL, 1U ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Init( &scheduler, &eventLoop, 0U ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Connect( NULL, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Connect( &scheduler, NULL ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Disconnected( NULL, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Disconnected( &scheduler, NULL ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_ReportResult( NULL, &endpoints[ 0 ], true ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_ReportResult( &scheduler, NULL, true ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Stop( NULL, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Stop( &scheduler, NULL ) );
+
+    /* An endpoint needs a host name and a callback. */
+    endpoint.callback = reconnectCallback;
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Connect( &scheduler, &endpoint ) );
+    endpoint.pHostName = "example.com";
+    endpoint.callback = NULL;
+    TEST_ASSERT_EQUAL( RECONNECT_INVALID_PARAMETER, ReconnectScheduler_Connect( &scheduler, &endpoint ) );
+
+    /* Results and disconnections are only accepted in the matching states. */
+    TEST_ASSERT_EQUAL( RECONNECT_BAD_STATE, ReconnectScheduler_ReportResult( &scheduler, &endpoints[ 0 ], true ) );
+    TEST_ASSERT_EQUAL( RECONNECT_BAD_STATE, ReconnectScheduler_Disconnected( &scheduler, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_BAD_STATE, ReconnectScheduler_Connect( &scheduler, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_BAD_STATE, ReconnectScheduler_Disconnected( &scheduler, &endpoints[ 0 ] ) );
+}
+
+/**
+ * @brief Test that no more than the allowed number of handshakes are in
+ * flight, and that the queued endpoints are started oldest first as
+ * handshakes complete.
+ */
+void test_ReconnectScheduler_Limits_Handshakes_In_Flight( void )
+{
+    int32_t i;
+
+    for( i = 0; i < NUM_ENDPOINTS; i++ )
+    {
+        TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ i ] ) );
+    }
+
+    TEST_ASSERT_EQUAL( MAX_HANDSHAKES, scheduler.handshakeCount );
+    TEST_ASSERT_EQUAL( 1, connectCount[ 0 ] );
+    TEST_ASSERT_EQUAL( 1, connectCount[ 1 ] );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_QUEUED, endpoints[ 2 ].state );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_QUEUED, endpoints[ 3 ].state );
+
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_ReportResult( &scheduler, &endpoints[ 1 ], true ) );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_CONNECTED, endpoints[ 1 ].state );
+    TEST_ASSERT_EQUAL( 1, connectCount[ 2 ] );
+    TEST_ASSERT_EQUAL( 0, connectCount[ 3 ] );
+
+    /* Stopping an endpoint releases its handshake. */
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Stop( &scheduler, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_IDLE, endpoints[ 0 ].state );
+    TEST_ASSERT_EQUAL( 1, connectCount[ 3 ] );
+    TEST_ASSERT_EQUAL( MAX_HANDSHAKES, scheduler.handshakeCount );
+    TEST_ASSERT_NULL( scheduler.pQueueHead );
+}
+
+/**
+ * @brief Test that a failed handshake is retried after a delay with
+ * decorrelated jitter, and not before.
+ */
+void test_ReconnectScheduler_Retries_After_Jittered_Delay( void )
+{
+    uint32_t delayMs = 0U, i = 0U;
+
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ 0 ] ) );
+
+    for( i = 1U; i <= RECONNECT_CIRCUIT_RETRY_ATTEMPTS; i++ )
+    {
+        delayMs = failHandshake( &endpoints[ 0 ] );
+        TEST_ASSERT_EQUAL( RECONNECT_STATE_WAITING, endpoints[ 0 ].state );
+        TEST_ASSERT_EQUAL( 0, scheduler.handshakeCount );
+        TEST_ASSERT_TRUE( delayMs >= RECONNECT_BACKOFF_BASE_MS );
+        TEST_ASSERT_TRUE( delayMs <= RECONNECT_MAX_BACKOFF_DELAY_MS );
+
+        dispatchAfter( delayMs - 1U );
+        TEST_ASSERT_EQUAL( i, connectCount[ 0 ] );
+        dispatchAfter( EVENT_LOOP_TIMER_TICK_MS );
+        TEST_ASSERT_EQUAL( i + 1U, connectCount[ 0 ] );
+    }
+
+    /* A success resets the delays. */
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_ReportResult( &scheduler, &endpoints[ 0 ], true ) );
+    TEST_ASSERT_EQUAL( RECONNECT_BACKOFF_BASE_MS, endpoints[ 0 ].lastDelayMs );
+
+    /* After a lost connection, the first attempt is within the base delay. */
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Disconnected( &scheduler, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_WAITING, endpoints[ 0 ].state );
+    dispatchAfter( RECONNECT_BACKOFF_BASE_MS + EVENT_LOOP_TIMER_TICK_MS );
+    TEST_ASSERT_EQUAL( RECONNECT_CIRCUIT_RETRY_ATTEMPTS + 2U, connectCount[ 0 ] );
+}
+
+/**
+ * @brief Test that the circuit breaker opens once the retries are exhausted,
+ * lets a single trial through after the open time, and closes when the trial
+ * succeeds.
+ */
+void test_ReconnectScheduler_Circuit_Breaker( void )
+{
+    uint32_t i = 0U;
+
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ 0 ] ) );
+
+    for( i = 0U; i < RECONNECT_CIRCUIT_RETRY_ATTEMPTS; i++ )
+    {
+        ( void ) failHandshake( &endpoints[ 0 ] );
+        dispatchAfter( RECONNECT_MAX_BACKOFF_DELAY_MS + EVENT_LOOP_TIMER_TICK_MS );
+    }
+
+    ( void ) failHandshake( &endpoints[ 0 ] );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_CIRCUIT_OPEN, endpoints[ 0 ].state );
+
+    /* No attempt while the circuit breaker is open. */
+    dispatchAfter( RECONNECT_CIRCUIT_OPEN_MS - 1U );
+    TEST_ASSERT_EQUAL( RECONNECT_CIRCUIT_RETRY_ATTEMPTS + 1U, connectCount[ 0 ] );
+
+    /* A failed trial opens it again at once. */
+    dispatchAfter( ( RECONNECT_CIRCUIT_OPEN_MS / 4U ) + EVENT_LOOP_TIMER_TICK_MS );
+    TEST_ASSERT_EQUAL( RECONNECT_CIRCUIT_RETRY_ATTEMPTS + 2U, connectCount[ 0 ] );
+    TEST_ASSERT_TRUE( endpoints[ 0 ].circuitTrial );
+    ( void ) failHandshake( &endpoints[ 0 ] );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_CIRCUIT_OPEN, endpoints[ 0 ].state );
+
+    /* A successful trial closes it. */
+    dispatchAfter( RECONNECT_CIRCUIT_OPEN_MS + ( RECONNECT_CIRCUIT_OPEN_MS / 4U ) + EVENT_LOOP_TIMER_TICK_MS );
+    TEST_ASSERT_EQUAL( RECONNECT_CIRCUIT_RETRY_ATTEMPTS + 3U, connectCount[ 0 ] );
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_ReportResult( &scheduler, &endpoints[ 0 ], true ) );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_CONNECTED, endpoints[ 0 ].state );
+    TEST_ASSERT_FALSE( endpoints[ 0 ].circuitTrial );
+}
+
+/**
+ * @brief Test that a handshake not reported in time is abandoned, counted as
+ * failed, and releases its handshake for a queued endpoint.
+ */
+void test_ReconnectScheduler_Handshake_Timeout( void )
+{
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ 0 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ 1 ] ) );
+    TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ 2 ] ) );
+
+    dispatchAfter( RECONNECT_HANDSHAKE_TIMEOUT_MS - EVENT_LOOP_TIMER_TICK_MS );
+    TEST_ASSERT_EQUAL( 0, timeoutCount[ 0 ] );
+
+    dispatchAfter( EVENT_LOOP_TIMER_TICK_MS );
+    TEST_ASSERT_EQUAL( 1, timeoutCount[ 0 ] );
+    TEST_ASSERT_EQUAL( 1, timeoutCount[ 1 ] );
+    TEST_ASSERT_EQUAL( RECONNECT_STATE_WAITING, endpoints[ 0 ].state );
+    TEST_ASSERT_EQUAL( 1, connectCount[ 2 ] );
+    TEST_ASSERT_EQUAL( 1, scheduler.handshakeCount );
+}
+
+/**
+ * @brief Test that handshakes failing inside the callback do not recurse and
+ * leave no handshake in flight.
+ */
+void test_ReconnectScheduler_Result_Reported_From_Callback( void )
+{
+    int32_t i;
+
+    failAtOnce = true;
+
+    for( i = 0; i < NUM_ENDPOINTS; i++ )
+    {
+        TEST_ASSERT_EQUAL( RECONNECT_SUCCESS, ReconnectScheduler_Connect( &scheduler, &endpoints[ i ] ) );
+        TEST_ASSERT_EQUAL( 1, connectCount[ i ] );
+        TEST_ASSERT_EQUAL( RECONNECT_STATE_WAITING, endpoints[ i ].state );
+    }
+
+    TEST_ASSERT_EQUAL( 0, scheduler.handshakeCount );
+}
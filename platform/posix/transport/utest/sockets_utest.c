@@ -23,6 +23,8 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
+#include <netinet/tcp.h>
 #include "/usr/include/errno.h"
 
 #include "unity.h"
@@ -30,11 +32,16 @@
 /* Include paths for public enums, structures, and macros. */
 #include "sockets_posix.h"
 
+/* The DNS cache copies its records with the allocator. */
+#include "allocator.h"
+
 #include "mock_netdb.h"
 #include "mock_socket.h"
 #include "mock_inet.h"
 #include "mock_unistd_api.h"
 #include "mock_stdio_api.h"
+#include "mock_poll_api.h"
+#include "mock_fcntl_api.h"
 
 /* The number of #addrinfo objects to create in the linked list. */
 #define NUM_ADDR_INFO        3
@@ -42,12 +49,45 @@
 /* The send and receive timeout to set for the socket. */
 #define SEND_RECV_TIMEOUT    0
 
+/* Limit of the throttle tests, in bytes per second, and the bytes
+ * background traffic may transfer at once. */
+#define THROTTLE_RATE        10000U
+#define THROTTLE_BURST       100U
+
 /* The host and port from which to establish the connection. */
 #define HOSTNAME             "amazon.com"
 #define PORT                 80
 
+/* Whether the sockets under test race the addresses of a server and cache
+ * the DNS lookups, as the sockets_features_utest target builds them. The
+ * tests of these features only run in that build, and the tests of the
+ * blocking attempts made one after another only in the default one. */
+#define FEATURES_ENABLED     ( ( SOCKETS_CONNECTION_ATTEMPT_DELAY_MS > 0U ) && ( SOCKETS_DNS_CACHE_TTL_MS > 0U ) )
+
+/* The largest number of DNS records of the tests of the features. */
+#define MAX_DNS_RECORDS      4
+
+/**
+ * @brief DNS records as returned by #getaddrinfo, each with an address of
+ * the size of its family.
+ */
+typedef struct DnsRecords
+{
+    struct addrinfo records[ MAX_DNS_RECORDS ];
+    struct sockaddr_in6 addresses[ MAX_DNS_RECORDS ];
+} DnsRecords_t;
+
 static struct addrinfo * addrInfo;
+
+/* The records of the tests of the features. They are never released, as the
+ * DNS cache keeps pointing to them; each of these tests uses its own host
+ * name, so that it does not find the records of another one. */
+static DnsRecords_t dnsRecords[ 2 ];
 static ServerInfo_t serverInfo;
+static SocketConnectContext_t connectContext;
+
+/* Traffic class the binding policy was last called with, or -1. */
+static int32_t policyTrafficClass;
 
 /**
  * @brief Allocate a linked list that mocks a set of DNS records returned from
@@ -119,6 +159,111 @@ static void freeAddrInfoLinkedList( struct addrinfo * head )
     }
 }
 
+/**
+ * @brief Fill DNS records of the given address families, linked in order.
+ *
+ * @param[out] pDnsRecords The records.
+ * @param[in] pFamilies The family of each record.
+ * @param[in] count The number of records.
+ *
+ * @return The first record.
+ */
+static struct addrinfo * createDnsRecords( DnsRecords_t * pDnsRecords,
+                                           const int * pFamilies,
+                                           size_t count )
+{
+    size_t i;
+
+    TEST_ASSERT_TRUE( count <= MAX_DNS_RECORDS );
+    memset( pDnsRecords, 0, sizeof( DnsRecords_t ) );
+
+    for( i = 0; i < count; i++ )
+    {
+        pDnsRecords->records[ i ].ai_family = pFamilies[ i ];
+        pDnsRecords->records[ i ].ai_socktype = SOCK_STREAM;
+        pDnsRecords->records[ i ].ai_protocol = IPPROTO_TCP;
+        pDnsRecords->records[ i ].ai_addr = ( struct sockaddr * ) &pDnsRecords->addresses[ i ];
+        pDnsRecords->records[ i ].ai_addr->sa_family = pFamilies[ i ];
+        pDnsRecords->records[ i ].ai_addrlen = ( pFamilies[ i ] == AF_INET6 ) ?
+                                               sizeof( struct sockaddr_in6 ) :
+                                               sizeof( struct sockaddr_in );
+
+        if( i > 0 )
+        {
+            pDnsRecords->records[ i - 1 ].ai_next = &pDnsRecords->records[ i ];
+        }
+    }
+
+    return &pDnsRecords->records[ 0 ];
+}
+
+/**
+ * @brief Skip a test of the blocking attempts made one after another, in the
+ * build of the sockets racing the addresses and caching the DNS lookups.
+ */
+static void requireDefaultSockets( void )
+{
+    if( FEATURES_ENABLED )
+    {
+        TEST_IGNORE_MESSAGE( "Only run without connection racing and DNS cache." );
+    }
+}
+
+/**
+ * @brief Skip a test of the connection racing or of the DNS cache, in the
+ * build of the sockets without them.
+ */
+static void requireSocketsFeatures( void )
+{
+    if( !FEATURES_ENABLED )
+    {
+        TEST_IGNORE_MESSAGE( "Only run with connection racing and DNS cache." );
+    }
+}
+
+/**
+ * @brief Set the host name of the connections of a test.
+ *
+ * @param[in] pHostName The host name.
+ */
+static void setHostName( const char * pHostName )
+{
+    serverInfo.pHostName = pHostName;
+    serverInfo.hostNameLength = strlen( pHostName );
+}
+
+/**
+ * @brief Read the number of blocks of the transport in use.
+ *
+ * @return The number of blocks.
+ */
+static uint64_t getTransportBlocks( void )
+{
+    AllocatorStats_t stats;
+
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_TRANSPORT, &stats );
+
+    return stats.blocks;
+}
+
+/**
+ * @brief Binding policy that places background traffic on "wwan0".
+ */
+static void bindBackgroundToWwan( void * pPolicyContext,
+                                  const ServerInfo_t * pServerInfo,
+                                  SocketBinding_t * pBinding )
+{
+    TEST_ASSERT_EQUAL_PTR( &serverInfo, pPolicyContext );
+    TEST_ASSERT_EQUAL_PTR( &serverInfo, pServerInfo );
+
+    policyTrafficClass = ( int32_t ) pServerInfo->trafficClass;
+
+    if( pServerInfo->trafficClass == TRANSPORT_TRAFFIC_BACKGROUND )
+    {
+        pBinding->pInterfaceName = "wwan0";
+    }
+}
+
 /* ============================   UNITY FIXTURES ============================ */
 
 /* Called before each test method. */
@@ -127,11 +272,16 @@ void setUp()
     serverInfo.pHostName = HOSTNAME;
     serverInfo.hostNameLength = strlen( HOSTNAME );
     serverInfo.port = PORT;
+    serverInfo.pSocketOptions = NULL;
+    serverInfo.trafficClass = TRANSPORT_TRAFFIC_INTERACTIVE;
+    policyTrafficClass = -1;
 }
 
 /* Called after each test method. */
 void tearDown()
 {
+    Sockets_SetBindingPolicy( NULL, NULL );
+    TransportThrottle_Configure( NULL );
 }
 
 /* Called at the beginning of the whole suite. */
@@ -149,6 +299,20 @@ int suiteTearDown( int numFailures )
 
 /* ========================================================================== */
 
+/**
+ * @brief Expect a non-blocking connect to be started on a new socket.
+ *
+ * @param[in] connectReturn The value to return from #connect.
+ */
+static void expectNonBlockingConnectStart( int connectReturn )
+{
+    socket_ExpectAnyArgsAndReturn( 1 );
+    fcntl_ExpectAndReturn( 1, F_GETFL, 0 );
+    fcntl_ExpectAndReturn( 1, F_SETFL, 0 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( connectReturn );
+}
+
 /**
  * @brief Expect any methods called from #Sockets_Connect.
  *
@@ -289,6 +453,8 @@ void test_Sockets_Connect_Every_IP_Address_Fails( void )
     SocketStatus_t socketStatus;
     int tcpSocket = 1;
 
+    requireDefaultSockets();
+
     /* -1 implies that every call to #connect will fail. */
     expectSocketsConnectCalls( -1 );
 
@@ -314,6 +480,8 @@ void test_Sockets_Connect_Fail_setsockopt( void )
         ENOPROTOOPT, ENOTSOCK, ENOMEM, ENOBUFS
     };
 
+    requireDefaultSockets();
+
     for( i = 0; i < ( sizeof( allErrorCases ) / sizeof( int32_t ) ); i++ )
     {
         expectSocketsConnectCalls( NUM_ADDR_INFO );
@@ -360,6 +528,215 @@ void test_Sockets_Connect_Succeed_On_Nth_IP_Address( void )
     SocketStatus_t socketStatus;
     int tcpSocket = 1;
 
+    requireDefaultSockets();
+
+    expectSocketsConnectCalls( NUM_ADDR_INFO );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+}
+
+/**
+ * @brief Test that #Sockets_Connect applies the requested TCP options before
+ * connecting, and that an option rejected by the system does not fail the
+ * connection.
+ */
+void test_Sockets_Connect_Applies_Socket_Options( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = 1;
+    SocketOptions_t socketOptions;
+    uint16_t i;
+
+    requireDefaultSockets();
+
+    memset( &socketOptions, 0, sizeof( SocketOptions_t ) );
+    socketOptions.noDelay = true;
+    socketOptions.sendBufferSize = 65536;
+    socketOptions.recvBufferSize = 65536;
+    socketOptions.keepAlive = true;
+    socketOptions.keepAliveIdleSec = 60;
+    socketOptions.keepAliveIntervalSec = 10;
+    socketOptions.keepAliveCount = 3;
+    socketOptions.userTimeoutMs = 30000;
+    socketOptions.fastOpen = true;
+    serverInfo.pSocketOptions = &socketOptions;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( 1 );
+
+    /* TCP_NODELAY, SO_SNDBUF, SO_RCVBUF, SO_KEEPALIVE, TCP_KEEPIDLE,
+     * TCP_KEEPINTVL, TCP_KEEPCNT, TCP_USER_TIMEOUT and TCP_FASTOPEN_CONNECT.
+     * Reject the last one as a kernel without Fast Open would. */
+    for( i = 0; i < 8; i++ )
+    {
+        setsockopt_ExpectAnyArgsAndReturn( 0 );
+    }
+
+    setsockopt_ExpectAnyArgsAndReturn( -1 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+
+    /* The send and receive timeouts. */
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+}
+
+/**
+ * @brief Test that #Sockets_Connect binds the socket to the requested
+ * interface and source address before connecting.
+ */
+void test_Sockets_Connect_Binds_Interface_And_Source_Address( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = 1;
+    SocketOptions_t socketOptions;
+    struct sockaddr_in localAddress;
+
+    requireDefaultSockets();
+
+    memset( &localAddress, 0, sizeof( localAddress ) );
+    localAddress.sin_family = AF_INET;
+    memset( &socketOptions, 0, sizeof( SocketOptions_t ) );
+    socketOptions.binding.pInterfaceName = "eth0";
+    socketOptions.binding.pLocalAddress = ( const struct sockaddr * ) &localAddress;
+    socketOptions.binding.localAddressLength = sizeof( localAddress );
+    serverInfo.pSocketOptions = &socketOptions;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( 1 );
+
+    /* SO_BINDTODEVICE, then IP_BIND_ADDRESS_NO_PORT as the source port is 0. */
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    bind_ExpectAndReturn( 1,
+                          ( const struct sockaddr * ) &localAddress,
+                          sizeof( localAddress ),
+                          0 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+
+    /* The send and receive timeouts. */
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+}
+
+/**
+ * @brief Test that #Sockets_Connect skips the server addresses of another
+ * family than the source address.
+ */
+void test_Sockets_Connect_Skips_Address_Of_Other_Family( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = 1;
+    SocketOptions_t socketOptions;
+    struct sockaddr_in6 localAddress;
+
+    requireDefaultSockets();
+
+    memset( &localAddress, 0, sizeof( localAddress ) );
+    localAddress.sin6_family = AF_INET6;
+    localAddress.sin6_port = htons( 5000 );
+    memset( &socketOptions, 0, sizeof( SocketOptions_t ) );
+    socketOptions.binding.pLocalAddress = ( const struct sockaddr * ) &localAddress;
+    socketOptions.binding.localAddressLength = sizeof( localAddress );
+    serverInfo.pSocketOptions = &socketOptions;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+
+    /* The first address is IPv4. */
+    socket_ExpectAnyArgsAndReturn( 1 );
+    close_ExpectAnyArgsAndReturn( 0 );
+
+    /* The second one is IPv6. The source port is set, so the socket is
+     * bound right away. */
+    socket_ExpectAnyArgsAndReturn( 1 );
+    bind_ExpectAnyArgsAndReturn( 0 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+}
+
+/**
+ * @brief Test that #Sockets_Connect fails rather than using another
+ * interface when the requested one cannot be bound.
+ */
+void test_Sockets_Connect_Binding_Failure_Fails_Connection( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = 1;
+    SocketOptions_t socketOptions;
+    uint16_t i;
+
+    requireDefaultSockets();
+
+    memset( &socketOptions, 0, sizeof( SocketOptions_t ) );
+    socketOptions.binding.pInterfaceName = "eth9";
+    serverInfo.pSocketOptions = &socketOptions;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+
+    for( i = 0; i < NUM_ADDR_INFO; i++ )
+    {
+        socket_ExpectAnyArgsAndReturn( 1 );
+        setsockopt_ExpectAnyArgsAndReturn( -1 );
+        close_ExpectAnyArgsAndReturn( 0 );
+    }
+
+    freeaddrinfo_ExpectAnyArgs();
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+}
+
+/**
+ * @brief Test that the binding policy chooses the interface of a connection
+ * by its traffic class.
+ */
+void test_Sockets_Connect_Binding_Policy_Uses_Traffic_Class( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = 1;
+
+    requireDefaultSockets();
+
+    Sockets_SetBindingPolicy( bindBackgroundToWwan, &serverInfo );
+
+    /* Interactive traffic keeps the route of the kernel. */
     expectSocketsConnectCalls( NUM_ADDR_INFO );
     setsockopt_ExpectAnyArgsAndReturn( 0 );
     setsockopt_ExpectAnyArgsAndReturn( 0 );
@@ -369,4 +746,776 @@ void test_Sockets_Connect_Succeed_On_Nth_IP_Address( void )
                                     SEND_RECV_TIMEOUT,
                                     SEND_RECV_TIMEOUT );
     TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( TRANSPORT_TRAFFIC_INTERACTIVE, policyTrafficClass );
+
+    /* Background traffic is bound to the interface of the policy. */
+    serverInfo.trafficClass = TRANSPORT_TRAFFIC_BACKGROUND;
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    socket_ExpectAnyArgsAndReturn( 1 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( TRANSPORT_TRAFFIC_BACKGROUND, policyTrafficClass );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectStart, #Sockets_ConnectPoll and
+ * #Sockets_ConnectAbort fail when invalid parameters are passed.
+ */
+void test_Sockets_ConnectStart_Invalid_Params( void )
+{
+    SocketStatus_t socketStatus;
+
+    socketStatus = Sockets_ConnectStart( NULL,
+                                         &serverInfo,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Sockets_ConnectStart( &connectContext,
+                                         NULL,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    serverInfo.hostNameLength = 0;
+    socketStatus = Sockets_ConnectStart( &connectContext,
+                                         &serverInfo,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    serverInfo.pHostName = NULL;
+    socketStatus = Sockets_ConnectStart( &connectContext,
+                                         &serverInfo,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Sockets_ConnectPoll( NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    /* Polling without a connection in progress should fail. */
+    connectContext.tcpSocket = -1;
+    socketStatus = Sockets_ConnectPoll( &connectContext );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Sockets_ConnectAbort( NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+}
+
+/**
+ * @brief Test that a non-blocking connection reports #SOCKETS_WANT_WRITE
+ * until the socket is writable, and is then configured like a connection
+ * made with #Sockets_Connect.
+ */
+void test_Sockets_ConnectPoll_Succeeds_After_Socket_Writable( void )
+{
+    SocketStatus_t socketStatus;
+
+    requireDefaultSockets();
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    expectNonBlockingConnectStart( -1 );
+    errno = EINPROGRESS;
+
+    socketStatus = Sockets_ConnectStart( &connectContext,
+                                         &serverInfo,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_WANT_WRITE, socketStatus );
+    TEST_ASSERT_EQUAL( 1, connectContext.tcpSocket );
+
+    /* The connection is still in progress. */
+    poll_ExpectAnyArgsAndReturn( 0 );
+    socketStatus = Sockets_ConnectPoll( &connectContext );
+    TEST_ASSERT_EQUAL( SOCKETS_WANT_WRITE, socketStatus );
+
+    /* The connection completed, so the socket is made blocking again. */
+    poll_ExpectAnyArgsAndReturn( 1 );
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    fcntl_ExpectAndReturn( 1, F_GETFL, O_NONBLOCK );
+    fcntl_ExpectAndReturn( 1, F_SETFL, 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    socketStatus = Sockets_ConnectPoll( &connectContext );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 1, connectContext.tcpSocket );
+    TEST_ASSERT_NULL( connectContext.pListHead );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectPoll moves on to the next address when the
+ * connection attempt in progress fails, and that #Sockets_ConnectAbort
+ * releases the connection state.
+ */
+void test_Sockets_ConnectPoll_Tries_Next_Address( void )
+{
+    SocketStatus_t socketStatus;
+
+    requireDefaultSockets();
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+    expectNonBlockingConnectStart( -1 );
+    errno = EINPROGRESS;
+
+    socketStatus = Sockets_ConnectStart( &connectContext,
+                                         &serverInfo,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_WANT_WRITE, socketStatus );
+
+    /* The first attempt failed, so the second address is tried. */
+    poll_ExpectAnyArgsAndReturn( 1 );
+    getsockopt_ExpectAnyArgsAndReturn( -1 );
+    close_ExpectAndReturn( 1, 0 );
+    expectNonBlockingConnectStart( -1 );
+    socketStatus = Sockets_ConnectPoll( &connectContext );
+    TEST_ASSERT_EQUAL( SOCKETS_WANT_WRITE, socketStatus );
+    TEST_ASSERT_EQUAL_PTR( addrInfo->ai_next->ai_next, connectContext.pNextAddress );
+
+    close_ExpectAndReturn( 1, 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    socketStatus = Sockets_ConnectAbort( &connectContext );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( -1, connectContext.tcpSocket );
+    TEST_ASSERT_NULL( connectContext.pListHead );
+}
+
+/**
+ * @brief Test that #Sockets_ConnectStart returns #SOCKETS_CONNECT_FAILURE when
+ * no address accepts a connection.
+ */
+void test_Sockets_ConnectStart_Every_IP_Address_Fails( void )
+{
+    SocketStatus_t socketStatus;
+
+    requireDefaultSockets();
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &addrInfo );
+
+    /* Fail socket(), then fcntl(), then connect() for coverage. */
+    socket_ExpectAnyArgsAndReturn( -1 );
+    socket_ExpectAnyArgsAndReturn( 1 );
+    fcntl_ExpectAndReturn( 1, F_GETFL, -1 );
+    close_ExpectAndReturn( 1, 0 );
+    expectNonBlockingConnectStart( -1 );
+    close_ExpectAndReturn( 1, 0 );
+    freeaddrinfo_ExpectAnyArgs();
+    errno = ECONNREFUSED;
+
+    socketStatus = Sockets_ConnectStart( &connectContext,
+                                         &serverInfo,
+                                         SEND_RECV_TIMEOUT,
+                                         SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+    TEST_ASSERT_EQUAL( -1, connectContext.tcpSocket );
+}
+
+/**
+ * @brief Test that #Sockets_GetRttInfo reports the round trip time of
+ * TCP_INFO, and its errors.
+ */
+void test_Sockets_GetRttInfo( void )
+{
+    SocketStatus_t socketStatus;
+    SocketRttInfo_t rttInfo = { 0 };
+    struct tcp_info tcpInfo;
+
+    ( void ) memset( &tcpInfo, 0, sizeof( tcpInfo ) );
+    tcpInfo.tcpi_rtt = 40000U;
+    tcpInfo.tcpi_rttvar = 5000U;
+    tcpInfo.tcpi_rto = 240000U;
+    tcpInfo.tcpi_total_retrans = 3U;
+
+    socketStatus = Sockets_GetRttInfo( -1, &rttInfo );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    socketStatus = Sockets_GetRttInfo( 1, NULL );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    getsockopt_ReturnMemThruPtr___optval( &tcpInfo, sizeof( tcpInfo ) );
+    socketStatus = Sockets_GetRttInfo( 1, &rttInfo );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL_UINT32( 40000U, rttInfo.srttUs );
+    TEST_ASSERT_EQUAL_UINT32( 5000U, rttInfo.rttVarUs );
+    TEST_ASSERT_EQUAL_UINT32( 240000U, rttInfo.rtoUs );
+    TEST_ASSERT_EQUAL_UINT32( 3U, rttInfo.totalRetransmits );
+
+    getsockopt_ExpectAnyArgsAndReturn( -1 );
+    errno = EBADF;
+    socketStatus = Sockets_GetRttInfo( 1, &rttInfo );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+}
+
+/**
+ * @brief Test that #Sockets_SetTimeouts sets both timeouts of the socket.
+ */
+void test_Sockets_SetTimeouts( void )
+{
+    SocketStatus_t socketStatus;
+
+    socketStatus = Sockets_SetTimeouts( -1, SEND_RECV_TIMEOUT, SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, socketStatus );
+
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    socketStatus = Sockets_SetTimeouts( 1, SEND_RECV_TIMEOUT, SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+
+    setsockopt_ExpectAnyArgsAndReturn( -1 );
+    errno = ENOMEM;
+    socketStatus = Sockets_SetTimeouts( 1, SEND_RECV_TIMEOUT, SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_INSUFFICIENT_MEMORY, socketStatus );
+}
+
+/**
+ * @brief Expect a non-blocking connection attempt to the next address.
+ *
+ * @param[in] family The family of the address.
+ * @param[in] tcpSocket The socket of the attempt.
+ * @param[in] connectReturn The value to return from #connect.
+ */
+static void expectConnectionAttempt( int family,
+                                     int tcpSocket,
+                                     int connectReturn )
+{
+    socket_ExpectAndReturn( family, SOCK_STREAM, IPPROTO_TCP, tcpSocket );
+    fcntl_ExpectAndReturn( tcpSocket, F_GETFL, 0 );
+    fcntl_ExpectAndReturn( tcpSocket, F_SETFL, 0 );
+    inet_ntop_ExpectAnyArgsAndReturn( NULL );
+    connect_ExpectAnyArgsAndReturn( connectReturn );
+}
+
+/**
+ * @brief Expect a wait for the connection attempts in progress.
+ *
+ * @param[in] attemptCount The number of attempts in progress.
+ * @param[in] timeoutMs The time to wait for.
+ * @param[in] pResults The attempts as #poll returns them, or NULL if none
+ * completed.
+ */
+static void expectPoll( nfds_t attemptCount,
+                        int timeoutMs,
+                        struct pollfd * pResults )
+{
+    poll_ExpectAndReturn( NULL, attemptCount, timeoutMs, ( pResults != NULL ) ? 1 : 0 );
+    poll_IgnoreArg_fds();
+
+    if( pResults != NULL )
+    {
+        poll_ReturnArrayThruPtr_fds( pResults, attemptCount );
+    }
+}
+
+/**
+ * @brief Expect the result of a connection attempt read from its socket.
+ *
+ * @param[in] pSocketError The error of the attempt, 0 if it connected.
+ */
+static void expectAttemptResult( int * pSocketError )
+{
+    getsockopt_ExpectAnyArgsAndReturn( 0 );
+    getsockopt_ReturnMemThruPtr___optval( pSocketError, sizeof( int ) );
+}
+
+/**
+ * @brief Expect the socket that connected to be made blocking again, then
+ * its timeouts to be set.
+ *
+ * @param[in] tcpSocket The socket that connected.
+ */
+static void expectConnectionKept( int tcpSocket )
+{
+    fcntl_ExpectAndReturn( tcpSocket, F_GETFL, O_NONBLOCK );
+    fcntl_ExpectAndReturn( tcpSocket, F_SETFL, 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+    setsockopt_ExpectAnyArgsAndReturn( 0 );
+}
+
+/**
+ * @brief Test that #Sockets_Connect tries the addresses alternating between
+ * IPv6 and IPv4, starting with the family of the first record, and moves on
+ * to the next address right away when a connection fails immediately.
+ */
+void test_Sockets_Connect_Races_Address_Families_In_Turn( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = -1;
+    const int families[] = { AF_INET6, AF_INET6, AF_INET, AF_INET };
+    struct addrinfo * pRecords = NULL;
+    uint64_t blocks = 0U;
+
+    requireSocketsFeatures();
+
+    setHostName( "interleave.example.com" );
+    pRecords = createDnsRecords( &dnsRecords[ 0 ], families, 4 );
+    blocks = getTransportBlocks();
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pRecords );
+
+    /* Every connection is refused right away. */
+    expectConnectionAttempt( AF_INET6, 10, -1 );
+    close_ExpectAndReturn( 10, 0 );
+    expectConnectionAttempt( AF_INET, 11, -1 );
+    close_ExpectAndReturn( 11, 0 );
+    expectConnectionAttempt( AF_INET6, 12, -1 );
+    close_ExpectAndReturn( 12, 0 );
+    expectConnectionAttempt( AF_INET, 13, -1 );
+    close_ExpectAndReturn( 13, 0 );
+
+    /* The records of the host may be stale, so they are dropped from the
+     * cache. */
+    freeaddrinfo_ExpectAnyArgs();
+    errno = ECONNREFUSED;
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE, socketStatus );
+    TEST_ASSERT_EQUAL( -1, tcpSocket );
+
+    /* The copy of the records was released. */
+    TEST_ASSERT_EQUAL_UINT64( blocks, getTransportBlocks() );
+}
+
+/**
+ * @brief Test that #Sockets_Connect starts the next attempt when the ones in
+ * progress have not completed within the delay, or as soon as one fails,
+ * and keeps the first socket to connect.
+ */
+void test_Sockets_Connect_Races_Next_Address_After_Delay( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = -1;
+    const int families[] = { AF_INET6, AF_INET, AF_INET6 };
+    struct addrinfo * pRecords = NULL;
+    int refused = ECONNREFUSED, connected = 0;
+    struct pollfd firstResults[ 2 ] = { { 10, POLLOUT, POLLERR }, { 11, POLLOUT, 0 } };
+    struct pollfd lastResults[ 2 ] = { { 11, POLLOUT, 0 }, { 12, POLLOUT, POLLOUT } };
+
+    requireSocketsFeatures();
+
+    setHostName( "stagger.example.com" );
+    pRecords = createDnsRecords( &dnsRecords[ 0 ], families, 3 );
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pRecords );
+
+    /* The first attempt does not complete within the delay. */
+    expectConnectionAttempt( AF_INET6, 10, -1 );
+    expectPoll( 1, SOCKETS_CONNECTION_ATTEMPT_DELAY_MS, NULL );
+
+    /* So the second one starts, and the first one then fails. */
+    expectConnectionAttempt( AF_INET, 11, -1 );
+    expectPoll( 2, SOCKETS_CONNECTION_ATTEMPT_DELAY_MS, firstResults );
+    expectAttemptResult( &refused );
+    close_ExpectAndReturn( 10, 0 );
+
+    /* The last address is tried at once, and waited for without a delay as
+     * no other address remains. It connects first. */
+    expectConnectionAttempt( AF_INET6, 12, -1 );
+    expectPoll( 2, -1, lastResults );
+    expectAttemptResult( &connected );
+
+    /* The attempt that lost the race is closed. */
+    close_ExpectAndReturn( 11, 0 );
+    expectConnectionKept( 12 );
+    errno = EINPROGRESS;
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 12, tcpSocket );
+}
+
+/**
+ * @brief Test that #Sockets_Connect tries the next address at once when a
+ * connection fails immediately, and keeps a socket that connects
+ * immediately.
+ */
+void test_Sockets_Connect_Races_Next_Address_On_Immediate_Failure( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = -1;
+    const int families[] = { AF_INET, AF_INET6 };
+    struct addrinfo * pRecords = NULL;
+
+    requireSocketsFeatures();
+
+    setHostName( "immediate.example.com" );
+    pRecords = createDnsRecords( &dnsRecords[ 0 ], families, 2 );
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pRecords );
+
+    expectConnectionAttempt( AF_INET, 10, -1 );
+    close_ExpectAndReturn( 10, 0 );
+    expectConnectionAttempt( AF_INET6, 11, 0 );
+    expectConnectionKept( 11 );
+    errno = ENETUNREACH;
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 11, tcpSocket );
+}
+
+/**
+ * @brief Test that #Sockets_Connect resolves a host name once within the
+ * time to live of its records, and releases the copy of the records given
+ * to each connection.
+ */
+void test_Sockets_Connect_Uses_Cached_Lookup( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = -1;
+    const int families[] = { AF_INET, AF_INET6 };
+    struct addrinfo * pRecords = NULL;
+    AllocatorStats_t before, after;
+
+    requireSocketsFeatures();
+
+    setHostName( "cached.example.com" );
+    pRecords = createDnsRecords( &dnsRecords[ 0 ], families, 2 );
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_TRANSPORT, &before );
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pRecords );
+    expectConnectionAttempt( AF_INET, 10, 0 );
+    expectConnectionKept( 10 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+
+    /* The second connection takes the records from the cache, so calling
+     * getaddrinfo again would fail the test. */
+    expectConnectionAttempt( AF_INET, 11, 0 );
+    expectConnectionKept( 11 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 11, tcpSocket );
+
+    /* Each connection copied both records, and released the copies. */
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_TRANSPORT, &after );
+    TEST_ASSERT_EQUAL_UINT64( before.allocations + 4U, after.allocations );
+    TEST_ASSERT_EQUAL_UINT64( before.blocks, after.blocks );
+}
+
+/**
+ * @brief Test that #Sockets_Connect resolves a host name again once its
+ * records have expired, and replaces the records of the cache.
+ */
+void test_Sockets_Connect_Refreshes_Expired_Lookup( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = -1;
+    const int families[] = { AF_INET };
+    struct addrinfo * pRecords = NULL, * pRefreshedRecords = NULL;
+    struct timespec expiry;
+
+    requireSocketsFeatures();
+
+    setHostName( "expired.example.com" );
+    pRecords = createDnsRecords( &dnsRecords[ 0 ], families, 1 );
+    pRefreshedRecords = createDnsRecords( &dnsRecords[ 1 ], families, 1 );
+
+    /* Sleep a little longer than the time to live of the records. */
+    expiry.tv_sec = ( SOCKETS_DNS_CACHE_TTL_MS + 100U ) / 1000U;
+    expiry.tv_nsec = ( long ) ( ( SOCKETS_DNS_CACHE_TTL_MS + 100U ) % 1000U ) * 1000000L;
+
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pRecords );
+    expectConnectionAttempt( AF_INET, 10, 0 );
+    expectConnectionKept( 10 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+
+    ( void ) nanosleep( &expiry, NULL );
+
+    /* The expired records are released once the new ones are stored. */
+    getaddrinfo_ExpectAnyArgsAndReturn( 0 );
+    getaddrinfo_ReturnThruPtr___pai( &pRefreshedRecords );
+    freeaddrinfo_Expect( pRecords );
+    expectConnectionAttempt( AF_INET, 11, 0 );
+    expectConnectionKept( 11 );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, socketStatus );
+    TEST_ASSERT_EQUAL( 11, tcpSocket );
+}
+
+/**
+ * @brief Test that #Sockets_Connect remembers that a host name does not
+ * exist, but not a lookup that failed for another reason.
+ */
+void test_Sockets_Connect_Caches_Missing_Host( void )
+{
+    SocketStatus_t socketStatus;
+    int tcpSocket = -1;
+
+    requireSocketsFeatures();
+
+    /* The second connection fails without calling getaddrinfo. */
+    setHostName( "missing.example.com" );
+    getaddrinfo_ExpectAnyArgsAndReturn( EAI_NONAME );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, socketStatus );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, socketStatus );
+
+    /* A transient failure is looked up again. */
+    setHostName( "unreachable.example.com" );
+    getaddrinfo_ExpectAnyArgsAndReturn( EAI_AGAIN );
+    getaddrinfo_ExpectAnyArgsAndReturn( EAI_AGAIN );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, socketStatus );
+
+    socketStatus = Sockets_Connect( &tcpSocket,
+                                    &serverInfo,
+                                    SEND_RECV_TIMEOUT,
+                                    SEND_RECV_TIMEOUT );
+    TEST_ASSERT_EQUAL( SOCKETS_DNS_FAILURE, socketStatus );
+}
+
+/**
+ * @brief Test that #TransportStats_RecordSend counts the bytes sent, the
+ * sends of fewer bytes than requested, and the sends that timed out or
+ * failed.
+ */
+void test_TransportStats_RecordSend_Counts_Partial_Sends( void )
+{
+    TransportStats_t stats;
+    uint64_t startTimeUs = TransportStats_GetTimeUs();
+
+    ( void ) memset( &stats, 0, sizeof( TransportStats_t ) );
+
+    TransportStats_RecordSend( &stats, 10U, 10, startTimeUs );
+    TransportStats_RecordSend( &stats, 10U, 4, startTimeUs );
+    TransportStats_RecordSend( &stats, 6U, 0, startTimeUs );
+    TransportStats_RecordSend( &stats, 6U, -1, startTimeUs );
+
+    TEST_ASSERT_EQUAL_UINT32( 4U, stats.sendCalls );
+    TEST_ASSERT_EQUAL_UINT64( 14U, stats.bytesSent );
+    TEST_ASSERT_EQUAL_UINT32( 1U, stats.partialSends );
+    TEST_ASSERT_EQUAL_UINT32( 1U, stats.sendTimeouts );
+    TEST_ASSERT_EQUAL_UINT32( 1U, stats.sendErrors );
+    TEST_ASSERT_EQUAL_UINT32( 4U, stats.latency[ TRANSPORT_STATS_SEND ].count );
+    TEST_ASSERT_EQUAL_UINT32( 0U, stats.recvCalls );
+
+    /* Statistics of a transport without them are not recorded. */
+    TransportStats_RecordSend( NULL, 10U, 4, startTimeUs );
+}
+
+/**
+ * @brief Test that #TransportStats_RecordRecv counts the bytes received,
+ * and the receives that timed out or failed.
+ */
+void test_TransportStats_RecordRecv_Counts_Bytes_Received( void )
+{
+    TransportStats_t stats;
+    uint64_t startTimeUs = TransportStats_GetTimeUs();
+
+    ( void ) memset( &stats, 0, sizeof( TransportStats_t ) );
+
+    TransportStats_RecordRecv( &stats, 4, startTimeUs );
+    TransportStats_RecordRecv( &stats, 0, startTimeUs );
+    TransportStats_RecordRecv( &stats, 6, startTimeUs );
+    TransportStats_RecordRecv( &stats, -1, startTimeUs );
+
+    TEST_ASSERT_EQUAL_UINT32( 4U, stats.recvCalls );
+    TEST_ASSERT_EQUAL_UINT64( 10U, stats.bytesReceived );
+    TEST_ASSERT_EQUAL_UINT32( 1U, stats.recvTimeouts );
+    TEST_ASSERT_EQUAL_UINT32( 1U, stats.recvErrors );
+    TEST_ASSERT_EQUAL_UINT32( 4U, stats.latency[ TRANSPORT_STATS_RECV ].count );
+    TEST_ASSERT_EQUAL_UINT32( 0U, stats.sendCalls );
+
+    TransportStats_RecordRecv( NULL, 4, startTimeUs );
+}
+
+/**
+ * @brief Test that #TransportThrottle_Wait lets all traffic through without a
+ * limit, and that the other throttle functions then do nothing.
+ */
+void test_TransportThrottle_Wait_Without_Limit( void )
+{
+    TransportThrottleConfig_t config = { 0 };
+
+    TransportThrottle_Configure( NULL );
+    TEST_ASSERT_EQUAL( 1000U, TransportThrottle_Wait( TRANSPORT_TRAFFIC_BACKGROUND, 1000U ) );
+
+    /* A rate of 0 removes the limit as well. */
+    config.burstBytes = THROTTLE_BURST;
+    config.rttTargetMs = 100U;
+    TransportThrottle_Configure( &config );
+    TransportThrottle_Consume( 1000U );
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 0U, TransportThrottle_GetRate() );
+    TEST_ASSERT_EQUAL( 1000U, TransportThrottle_Wait( TRANSPORT_TRAFFIC_BACKGROUND, 1000U ) );
+}
+
+/**
+ * @brief Test that #TransportThrottle_Wait never delays interactive traffic,
+ * and hands background traffic at most the bytes in the bucket.
+ */
+void test_TransportThrottle_Wait_Limits_Background_To_Bucket( void )
+{
+    TransportThrottleConfig_t config = { 0 };
+
+    config.rateBytesPerSec = THROTTLE_RATE;
+    config.burstBytes = THROTTLE_BURST;
+    TransportThrottle_Configure( &config );
+    TEST_ASSERT_EQUAL_UINT32( THROTTLE_RATE, TransportThrottle_GetRate() );
+
+    TEST_ASSERT_EQUAL( 1000U, TransportThrottle_Wait( TRANSPORT_TRAFFIC_INTERACTIVE, 1000U ) );
+
+    /* The bucket starts with a burst. */
+    TEST_ASSERT_EQUAL( THROTTLE_BURST, TransportThrottle_Wait( TRANSPORT_TRAFFIC_BACKGROUND, 1000U ) );
+    TEST_ASSERT_EQUAL( 10U, TransportThrottle_Wait( TRANSPORT_TRAFFIC_BACKGROUND, 10U ) );
+}
+
+/**
+ * @brief Test that interactive traffic overdraws the bucket by at most a
+ * burst, which background traffic pays back before it transfers again.
+ */
+void test_TransportThrottle_Consume_Is_Paid_Back_By_Background( void )
+{
+    TransportThrottleConfig_t config = { 0 };
+    uint64_t startTimeUs = 0U;
+    uint64_t waitedUs = 0U;
+    size_t bytesAllowed = 0U;
+
+    config.rateBytesPerSec = THROTTLE_RATE;
+    config.burstBytes = THROTTLE_BURST;
+    TransportThrottle_Configure( &config );
+
+    /* A full bucket overdrawn by far more than a burst is left a burst in
+     * debt, so that a burst refills after the time of two. */
+    TransportThrottle_Consume( THROTTLE_RATE * 10U );
+
+    startTimeUs = TransportStats_GetTimeUs();
+    bytesAllowed = TransportThrottle_Wait( TRANSPORT_TRAFFIC_BACKGROUND, THROTTLE_BURST );
+    waitedUs = TransportStats_GetTimeUs() - startTimeUs;
+
+    TEST_ASSERT_EQUAL( THROTTLE_BURST, bytesAllowed );
+    TEST_ASSERT_GREATER_OR_EQUAL( 15000U, waitedUs );
+    TEST_ASSERT_LESS_THAN( 1000000U, waitedUs );
+}
+
+/**
+ * @brief Test that #TransportThrottle_ReportRtt halves the limit after a
+ * round trip time beyond the target, down to the lowest limit, and grows it
+ * back by a sixteenth of the configured limit up to that limit.
+ */
+void test_TransportThrottle_ReportRtt_Halves_And_Recovers_Rate( void )
+{
+    TransportThrottleConfig_t config = { 0 };
+    uint32_t i;
+
+    config.rateBytesPerSec = 16000U;
+    config.burstBytes = THROTTLE_BURST;
+    config.rttTargetMs = 100U;
+    config.minRateBytesPerSec = 3000U;
+    TransportThrottle_Configure( &config );
+
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 8000U, TransportThrottle_GetRate() );
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 4000U, TransportThrottle_GetRate() );
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 3000U, TransportThrottle_GetRate() );
+
+    /* A round trip time at the target is within it. */
+    TransportThrottle_ReportRtt( 100U );
+    TEST_ASSERT_EQUAL_UINT32( 4000U, TransportThrottle_GetRate() );
+
+    for( i = 0U; i < 20U; i++ )
+    {
+        TransportThrottle_ReportRtt( 50U );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 16000U, TransportThrottle_GetRate() );
+
+    /* Without a target, the limit is fixed. */
+    config.rttTargetMs = 0U;
+    TransportThrottle_Configure( &config );
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 16000U, TransportThrottle_GetRate() );
+}
+
+/**
+ * @brief Test that #TransportThrottle_Configure raises a burst and a lowest
+ * limit of 0 to 1, and lowers a lowest limit above the limit to it.
+ */
+void test_TransportThrottle_Configure_Clamps_Config( void )
+{
+    TransportThrottleConfig_t config = { 0 };
+
+    config.rateBytesPerSec = 2U;
+    config.rttTargetMs = 100U;
+    TransportThrottle_Configure( &config );
+
+    TEST_ASSERT_EQUAL( 1U, TransportThrottle_Wait( TRANSPORT_TRAFFIC_BACKGROUND, 10U ) );
+
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 1U, TransportThrottle_GetRate() );
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 1U, TransportThrottle_GetRate() );
+
+    /* The recovery step of so low a limit is a byte per second. */
+    TransportThrottle_ReportRtt( 50U );
+    TEST_ASSERT_EQUAL_UINT32( 2U, TransportThrottle_GetRate() );
+
+    config.rateBytesPerSec = 1000U;
+    config.minRateBytesPerSec = 5000U;
+    TransportThrottle_Configure( &config );
+    TransportThrottle_ReportRtt( 200U );
+    TEST_ASSERT_EQUAL_UINT32( 1000U, TransportThrottle_GetRate() );
 }
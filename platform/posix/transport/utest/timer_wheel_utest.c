@@ -0,0 +1,225 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "timer_wheel_posix.h"
+
+/* The number of timers used by the tests. */
+#define NUM_TIMERS    4
+
+static TimerWheel_t wheel;
+static TimerWheelTimer_t timers[ NUM_TIMERS ];
+
+/* Tick at which #timerCallback was last called for each timer. */
+static uint32_t firedTick[ NUM_TIMERS ];
+static uint32_t callbackCount[ NUM_TIMERS ];
+
+/* Timer cancelled by #timerCallback, if any. */
+static TimerWheelTimer_t * pTimerToCancel;
+
+/* Timer started again by #timerCallback, if non-zero. */
+static uint32_t restartTicks;
+
+/**
+ * @brief Record the tick at which a timer is reported.
+ */
+static void timerCallback( TimerWheelTimer_t * pTimer )
+{
+    size_t index = ( size_t ) ( pTimer - timers );
+
+    TEST_ASSERT_TRUE( index < NUM_TIMERS );
+    TEST_ASSERT_FALSE( TimerWheel_IsRunning( pTimer ) );
+    firedTick[ index ] = wheel.currentTick;
+    callbackCount[ index ]++;
+
+    if( pTimerToCancel != NULL )
+    {
+        TimerWheel_Cancel( &wheel, pTimerToCancel );
+        pTimerToCancel = NULL;
+    }
+
+    if( restartTicks != 0U )
+    {
+        TimerWheel_Start( &wheel, pTimer, restartTicks );
+    }
+}
+
+/**
+ * @brief Advance the wheel one tick at a time up to a tick.
+ */
+static void advanceOneByOne( uint32_t lastTick )
+{
+    while( wheel.currentTick != lastTick )
+    {
+        ( void ) TimerWheel_Advance( &wheel, wheel.currentTick + 1U );
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    int32_t i;
+
+    pTimerToCancel = NULL;
+    restartTicks = 0U;
+    memset( firedTick, 0, sizeof( firedTick ) );
+    memset( callbackCount, 0, sizeof( callbackCount ) );
+
+    TimerWheel_Init( &wheel, 1000U );
+
+    for( i = 0; i < NUM_TIMERS; i++ )
+    {
+        memset( &timers[ i ], 0, sizeof( TimerWheelTimer_t ) );
+        timers[ i ].callback = timerCallback;
+    }
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that timers on every level are reported at their tick only,
+ * whether the wheel advances one tick at a time or jumps.
+ */
+void test_TimerWheel_Timers_Are_Reported_When_Due( void )
+{
+    uint32_t startTick = wheel.currentTick;
+
+    TimerWheel_Start( &wheel, &timers[ 0 ], 0U );
+    TimerWheel_Start( &wheel, &timers[ 1 ], TIMER_WHEEL_SLOTS - 1U );
+    TimerWheel_Start( &wheel, &timers[ 2 ], TIMER_WHEEL_SLOTS + 3U );
+    TimerWheel_Start( &wheel, &timers[ 3 ], 3U * TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS + 5U );
+    TEST_ASSERT_EQUAL( 4, wheel.timerCount );
+
+    advanceOneByOne( startTick + TIMER_WHEEL_SLOTS + 3U );
+    TEST_ASSERT_EQUAL( startTick + 1U, firedTick[ 0 ] );
+    TEST_ASSERT_EQUAL( startTick + TIMER_WHEEL_SLOTS - 1U, firedTick[ 1 ] );
+    TEST_ASSERT_EQUAL( startTick + TIMER_WHEEL_SLOTS + 3U, firedTick[ 2 ] );
+    TEST_ASSERT_EQUAL( 0, callbackCount[ 3 ] );
+
+    /* Jumping to the tick before the last timer does not report it. */
+    TEST_ASSERT_EQUAL( 0, TimerWheel_Advance( &wheel, startTick + 3U * TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS + 4U ) );
+    TEST_ASSERT_EQUAL( 1, TimerWheel_Advance( &wheel, startTick + 3U * TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS + 5U ) );
+    TEST_ASSERT_EQUAL( 0, wheel.timerCount );
+}
+
+/**
+ * @brief Test that #TimerWheel_GetNextTimeout is never later than the next
+ * timer, and that the wheel does not have to be visited at every tick.
+ */
+void test_TimerWheel_Next_Timeout( void )
+{
+    uint32_t timeout = 0U, startTick = wheel.currentTick;
+
+    TEST_ASSERT_EQUAL( TIMER_WHEEL_NO_TIMEOUT, TimerWheel_GetNextTimeout( &wheel ) );
+
+    TimerWheel_Start( &wheel, &timers[ 0 ], 10U );
+    TEST_ASSERT_EQUAL( 10, TimerWheel_GetNextTimeout( &wheel ) );
+
+    /* A timer on a higher level wakes the wheel up when it is moved down,
+     * then when it is due. */
+    TimerWheel_Cancel( &wheel, &timers[ 0 ] );
+    TimerWheel_Start( &wheel, &timers[ 1 ], 20U * TIMER_WHEEL_SLOTS );
+
+    while( callbackCount[ 1 ] == 0U )
+    {
+        timeout = TimerWheel_GetNextTimeout( &wheel );
+        TEST_ASSERT_TRUE( timeout <= ( startTick + 20U * TIMER_WHEEL_SLOTS ) - wheel.currentTick );
+        ( void ) TimerWheel_Advance( &wheel, wheel.currentTick + timeout );
+    }
+
+    TEST_ASSERT_EQUAL( startTick + 20U * TIMER_WHEEL_SLOTS, firedTick[ 1 ] );
+    TEST_ASSERT_EQUAL( TIMER_WHEEL_NO_TIMEOUT, TimerWheel_GetNextTimeout( &wheel ) );
+}
+
+/**
+ * @brief Test that a timer further away than the wheel spans, and timers
+ * whose expiry wraps around the tick counter, are reported when due.
+ */
+void test_TimerWheel_Beyond_Span_And_Wrap_Around( void )
+{
+    uint32_t farTicks = UINT32_MAX - 10U;
+
+    TimerWheel_Init( &wheel, UINT32_MAX - 5U );
+    TimerWheel_Start( &wheel, &timers[ 0 ], 10U );
+    TimerWheel_Start( &wheel, &timers[ 1 ], farTicks );
+
+    TEST_ASSERT_EQUAL( 1, TimerWheel_Advance( &wheel, 4U ) );
+    TEST_ASSERT_EQUAL( 4U, firedTick[ 0 ] );
+
+    TEST_ASSERT_EQUAL( 0, TimerWheel_Advance( &wheel, UINT32_MAX - 5U + farTicks - 1U ) );
+    TEST_ASSERT_EQUAL( 1, TimerWheel_Advance( &wheel, UINT32_MAX - 5U + farTicks ) );
+    TEST_ASSERT_EQUAL( 1, callbackCount[ 1 ] );
+}
+
+/**
+ * @brief Test that a callback can start its timer again and cancel another
+ * timer due at the same tick, and that starting a running timer replaces its
+ * expiry.
+ */
+void test_TimerWheel_Callback_Restarts_And_Cancels( void )
+{
+    uint32_t startTick = wheel.currentTick;
+
+    TimerWheel_Start( &wheel, &timers[ 0 ], 5U );
+    TimerWheel_Start( &wheel, &timers[ 0 ], 2U );
+    TimerWheel_Start( &wheel, &timers[ 1 ], 2U );
+    TEST_ASSERT_EQUAL( 2, wheel.timerCount );
+
+    /* Whichever is reported first cancels the other. */
+    pTimerToCancel = &timers[ 1 ];
+    restartTicks = 3U;
+    TEST_ASSERT_EQUAL( 1, TimerWheel_Advance( &wheel, startTick + 2U ) );
+    TEST_ASSERT_EQUAL( 1, callbackCount[ 0 ] + callbackCount[ 1 ] );
+    TEST_ASSERT_EQUAL( 1, wheel.timerCount );
+
+    restartTicks = 0U;
+    TEST_ASSERT_EQUAL( 1, TimerWheel_Advance( &wheel, startTick + 5U ) );
+    TEST_ASSERT_EQUAL( 2, callbackCount[ 0 ] + callbackCount[ 1 ] );
+    TEST_ASSERT_EQUAL( 0, wheel.timerCount );
+
+    /* Cancelling a timer that is not running has no effect. */
+    TimerWheel_Cancel( &wheel, &timers[ 2 ] );
+    TEST_ASSERT_EQUAL( 0, wheel.timerCount );
+}
@@ -0,0 +1,545 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "/usr/include/errno.h"
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "uring_posix.h"
+
+#include "mock_sockets_posix.h"
+#include "mock_uring_syscalls_posix.h"
+#include "mock_mman_api.h"
+#include "mock_unistd_api.h"
+
+/* The io_uring instance returned by the mocked #UringSyscall_Setup. */
+#define RING_DESCRIPTOR       7
+
+/* The number of entries of the simulated rings. */
+#define RING_ENTRIES          4U
+
+/* Offsets of the fields of the simulated rings. */
+#define RING_HEAD_OFFSET      0U
+#define RING_TAIL_OFFSET      4U
+#define RING_MASK_OFFSET      8U
+#define RING_ENTRIES_OFFSET   12U
+#define RING_FLAGS_OFFSET     16U
+#define RING_ARRAY_OFFSET     64U
+
+/* Timeouts passed to #Uring_Connect. */
+#define SEND_TIMEOUT_MS       100
+#define RECV_TIMEOUT_MS       200
+
+/* The host and port from which to establish the connection. */
+#define HOSTNAME              "amazon.com"
+#define PORT                  80
+
+/* The size of the buffers passed to #Uring_Send and #Uring_Recv. */
+#define BUFFER_LEN            4
+
+/* The size of the read-ahead and send buffers registered with the ring. */
+#define REGISTERED_LEN        ( BUFFER_LEN * 2 )
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    UringParams_t * pParams;
+};
+
+static ServerInfo_t serverInfo = { 0 };
+static NetworkContext_t networkContext = { 0 };
+static UringParams_t uringParams = { 0 };
+static uint8_t uringBuffer[ BUFFER_LEN ] = { 0 };
+static uint8_t readAheadBuffer[ REGISTERED_LEN ] = { 0 };
+static uint8_t sendBuffer[ REGISTERED_LEN ] = { 0 };
+
+/* Memory of the simulated rings, mapped by the mocked mmap. */
+static uint32_t submissionRing[ 32 ];
+static uint32_t completionRing[ 32 ];
+static struct io_uring_cqe * pCompletionEntries = ( struct io_uring_cqe * ) &completionRing[ RING_ARRAY_OFFSET / sizeof( uint32_t ) ];
+static struct io_uring_sqe submissionEntries[ RING_ENTRIES ];
+
+/* Result the simulated kernel posts for each send or receive. */
+static int32_t transferResult;
+
+/* Result the simulated kernel posts for each linked timeout. */
+static int32_t timeoutResult;
+
+/* Data the simulated kernel copies into the buffer of each receive. */
+static const char * pReceivedData;
+
+/* Operations submitted to the simulated kernel. */
+static struct io_uring_sqe submittedEntries[ 16 ];
+static size_t submittedCount;
+
+/* Flags passed to each call to the mocked #UringSyscall_Enter. */
+static uint32_t enterFlags[ 8 ];
+static size_t enterCount;
+
+/* Number of calls to the mocked #UringSyscall_Enter that fail with EINTR
+ * before the simulated kernel handles the entries. */
+static size_t interruptedCount;
+
+/**
+ * @brief Simulate io_uring_setup by describing the simulated rings.
+ */
+static int32_t setupStub( uint32_t entries,
+                          struct io_uring_params * pParams,
+                          int numCalls )
+{
+    ( void ) entries;
+    ( void ) numCalls;
+
+    pParams->sq_entries = RING_ENTRIES;
+    pParams->cq_entries = RING_ENTRIES * 2U;
+    pParams->sq_off.head = RING_HEAD_OFFSET;
+    pParams->sq_off.tail = RING_TAIL_OFFSET;
+    pParams->sq_off.ring_mask = RING_MASK_OFFSET;
+    pParams->sq_off.ring_entries = RING_ENTRIES_OFFSET;
+    pParams->sq_off.flags = RING_FLAGS_OFFSET;
+    pParams->sq_off.array = RING_ARRAY_OFFSET;
+    pParams->cq_off.head = RING_HEAD_OFFSET;
+    pParams->cq_off.tail = RING_TAIL_OFFSET;
+    pParams->cq_off.ring_mask = RING_MASK_OFFSET;
+    pParams->cq_off.ring_entries = RING_ENTRIES_OFFSET;
+    pParams->cq_off.cqes = RING_ARRAY_OFFSET;
+
+    return RING_DESCRIPTOR;
+}
+
+/**
+ * @brief Simulate mapping the rings given by #setupStub.
+ */
+static void * mmapStub( void * pAddress,
+                        size_t length,
+                        int protection,
+                        int flags,
+                        int fileDescriptor,
+                        off_t offset,
+                        int numCalls )
+{
+    void * pMapping = MAP_FAILED;
+
+    ( void ) pAddress;
+    ( void ) length;
+    ( void ) protection;
+    ( void ) flags;
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL( RING_DESCRIPTOR, fileDescriptor );
+
+    if( offset == ( off_t ) IORING_OFF_SQ_RING )
+    {
+        pMapping = submissionRing;
+    }
+    else if( offset == ( off_t ) IORING_OFF_CQ_RING )
+    {
+        pMapping = completionRing;
+    }
+    else if( offset == ( off_t ) IORING_OFF_SQES )
+    {
+        pMapping = submissionEntries;
+    }
+
+    return pMapping;
+}
+
+/**
+ * @brief Simulate io_uring_enter by completing the submitted entries.
+ */
+static int32_t enterStub( int32_t ringDescriptor,
+                          uint32_t toSubmit,
+                          uint32_t minComplete,
+                          uint32_t flags,
+                          int numCalls )
+{
+    int32_t submitted = 0;
+    uint32_t * pHead = &submissionRing[ RING_HEAD_OFFSET / sizeof( uint32_t ) ];
+    uint32_t tail = submissionRing[ RING_TAIL_OFFSET / sizeof( uint32_t ) ];
+    uint32_t * pCompletionTail = &completionRing[ RING_TAIL_OFFSET / sizeof( uint32_t ) ];
+    struct io_uring_sqe * pEntry = NULL;
+    struct io_uring_cqe * pCompletion = NULL;
+
+    ( void ) minComplete;
+    ( void ) numCalls;
+    ( void ) toSubmit;
+
+    TEST_ASSERT_EQUAL( RING_DESCRIPTOR, ringDescriptor );
+    enterFlags[ enterCount++ ] = flags;
+
+    if( interruptedCount > 0U )
+    {
+        interruptedCount--;
+        errno = EINTR;
+        submitted = -1;
+    }
+    else
+    {
+        while( *pHead != tail )
+        {
+            pEntry = &submissionEntries[ submissionRing[ ( RING_ARRAY_OFFSET / sizeof( uint32_t ) ) + ( *pHead & ( RING_ENTRIES - 1U ) ) ] ];
+            submittedEntries[ submittedCount++ ] = *pEntry;
+            pCompletion = &pCompletionEntries[ *pCompletionTail & ( ( RING_ENTRIES * 2U ) - 1U ) ];
+            pCompletion->user_data = pEntry->user_data;
+
+            if( pEntry->opcode == IORING_OP_LINK_TIMEOUT )
+            {
+                pCompletion->res = timeoutResult;
+            }
+            else
+            {
+                pCompletion->res = transferResult;
+
+                if( ( pReceivedData != NULL ) && ( transferResult > 0 ) )
+                {
+                    memcpy( ( void * ) ( uintptr_t ) pEntry->addr, pReceivedData, ( size_t ) transferResult );
+                }
+            }
+
+            ( *pCompletionTail )++;
+            ( *pHead )++;
+            submitted++;
+        }
+    }
+
+    return submitted;
+}
+
+/**
+ * @brief Connect with the simulated rings.
+ */
+static void connectRing( void )
+{
+    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS,
+                       Uring_Connect( &networkContext,
+                                      &serverInfo,
+                                      SEND_TIMEOUT_MS,
+                                      RECV_TIMEOUT_MS ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    serverInfo.pHostName = HOSTNAME;
+    serverInfo.hostNameLength = strlen( HOSTNAME );
+    serverInfo.port = PORT;
+
+    memset( &uringParams, 0, sizeof( uringParams ) );
+    networkContext.pParams = &uringParams;
+
+    memset( submissionRing, 0, sizeof( submissionRing ) );
+    memset( completionRing, 0, sizeof( completionRing ) );
+    submissionRing[ RING_MASK_OFFSET / sizeof( uint32_t ) ] = RING_ENTRIES - 1U;
+    completionRing[ RING_MASK_OFFSET / sizeof( uint32_t ) ] = ( RING_ENTRIES * 2U ) - 1U;
+
+    transferResult = BUFFER_LEN;
+    timeoutResult = -ECANCELED;
+    pReceivedData = NULL;
+    submittedCount = 0U;
+    enterCount = 0U;
+    interruptedCount = 0U;
+    errno = 0;
+
+    UringSyscall_Setup_Stub( setupStub );
+    UringSyscall_Enter_Stub( enterStub );
+    mmap_Stub( mmapStub );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #Uring_Connect sets up the ring and registers the buffers
+ * configured by the application.
+ */
+void test_Uring_Connect_Sets_Up_Ring( void )
+{
+    uringParams.pRecvBuffer = readAheadBuffer;
+    uringParams.recvBufferSize = REGISTERED_LEN;
+    uringParams.pSendBuffer = sendBuffer;
+    uringParams.sendBufferSize = REGISTERED_LEN;
+
+    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    UringSyscall_Register_ExpectAndReturn( RING_DESCRIPTOR, IORING_REGISTER_BUFFERS, NULL, 2U, 0 );
+    UringSyscall_Register_IgnoreArg_pArg();
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS,
+                       Uring_Connect( &networkContext,
+                                      &serverInfo,
+                                      SEND_TIMEOUT_MS,
+                                      RECV_TIMEOUT_MS ) );
+
+    TEST_ASSERT_EQUAL( RING_DESCRIPTOR, uringParams.ring.ringDescriptor );
+    TEST_ASSERT_EQUAL( 0, uringParams.ring.recvBufferIndex );
+    TEST_ASSERT_EQUAL( 1, uringParams.ring.sendBufferIndex );
+    TEST_ASSERT_EQUAL( SEND_TIMEOUT_MS, uringParams.sendTimeoutMs );
+    TEST_ASSERT_EQUAL( RECV_TIMEOUT_MS, uringParams.recvTimeoutMs );
+}
+
+/**
+ * @brief Test that #Uring_Connect closes the connection when the ring cannot
+ * be set up, and that invalid parameters return an error.
+ */
+void test_Uring_Connect_Failures( void )
+{
+    NetworkContext_t invalidContext = { 0 };
+
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER,
+                       Uring_Connect( NULL, &serverInfo, SEND_TIMEOUT_MS, RECV_TIMEOUT_MS ) );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER,
+                       Uring_Connect( &invalidContext, &serverInfo, SEND_TIMEOUT_MS, RECV_TIMEOUT_MS ) );
+
+    /* Sockets_Connect fails. */
+    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_CONNECT_FAILURE );
+    TEST_ASSERT_EQUAL( SOCKETS_CONNECT_FAILURE,
+                       Uring_Connect( &networkContext, &serverInfo, SEND_TIMEOUT_MS, RECV_TIMEOUT_MS ) );
+
+    /* The kernel does not support io_uring. */
+    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    UringSyscall_Setup_StubWithCallback( NULL );
+    UringSyscall_Setup_ExpectAnyArgsAndReturn( -1 );
+    Sockets_Disconnect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    TEST_ASSERT_EQUAL( SOCKETS_API_ERROR,
+                       Uring_Connect( &networkContext, &serverInfo, SEND_TIMEOUT_MS, RECV_TIMEOUT_MS ) );
+
+    /* A ring cannot be mapped. */
+    UringSyscall_Setup_Stub( setupStub );
+    mmap_StubWithCallback( NULL );
+    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    mmap_ExpectAnyArgsAndReturn( submissionRing );
+    mmap_ExpectAnyArgsAndReturn( MAP_FAILED );
+    mmap_ExpectAnyArgsAndReturn( submissionEntries );
+    munmap_ExpectAndReturn( submissionRing, RING_ARRAY_OFFSET + ( RING_ENTRIES * sizeof( uint32_t ) ), 0 );
+    munmap_ExpectAnyArgsAndReturn( 0 );
+    close_ExpectAndReturn( RING_DESCRIPTOR, 0 );
+    Sockets_Disconnect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    TEST_ASSERT_EQUAL( SOCKETS_API_ERROR,
+                       Uring_Connect( &networkContext, &serverInfo, SEND_TIMEOUT_MS, RECV_TIMEOUT_MS ) );
+
+    /* The buffers cannot be registered. */
+    mmap_Stub( mmapStub );
+    uringParams.pRecvBuffer = readAheadBuffer;
+    uringParams.recvBufferSize = REGISTERED_LEN;
+    Sockets_Connect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    UringSyscall_Register_ExpectAnyArgsAndReturn( -1 );
+    close_ExpectAndReturn( RING_DESCRIPTOR, 0 );
+    Sockets_Disconnect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    TEST_ASSERT_EQUAL( SOCKETS_API_ERROR,
+                       Uring_Connect( &networkContext, &serverInfo, SEND_TIMEOUT_MS, RECV_TIMEOUT_MS ) );
+    TEST_ASSERT_NULL( uringParams.ring.pSubmissionRing );
+}
+
+/**
+ * @brief Test that #Uring_Disconnect tears down the ring and closes the
+ * connection.
+ */
+void test_Uring_Disconnect( void )
+{
+    NetworkContext_t invalidContext = { 0 };
+
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, Uring_Disconnect( NULL ) );
+    TEST_ASSERT_EQUAL( SOCKETS_INVALID_PARAMETER, Uring_Disconnect( &invalidContext ) );
+
+    connectRing();
+
+    munmap_ExpectAnyArgsAndReturn( 0 );
+    munmap_ExpectAnyArgsAndReturn( 0 );
+    munmap_ExpectAnyArgsAndReturn( 0 );
+    close_ExpectAndReturn( RING_DESCRIPTOR, 0 );
+    Sockets_Disconnect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Uring_Disconnect( &networkContext ) );
+
+    /* The ring is not torn down twice. */
+    Sockets_Disconnect_ExpectAnyArgsAndReturn( SOCKETS_SUCCESS );
+    TEST_ASSERT_EQUAL( SOCKETS_SUCCESS, Uring_Disconnect( &networkContext ) );
+}
+
+/**
+ * @brief Test that #Uring_Recv submits a receive with a linked timeout in a
+ * single system call, and maps its completion like #Plaintext_Recv.
+ */
+void test_Uring_Recv_Completions( void )
+{
+    connectRing();
+
+    pReceivedData = "data";
+    TEST_ASSERT_EQUAL( BUFFER_LEN, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( 0, memcmp( uringBuffer, "data", BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( 1, enterCount );
+    TEST_ASSERT_EQUAL( IORING_ENTER_GETEVENTS, enterFlags[ 0 ] );
+    TEST_ASSERT_EQUAL( 2, submittedCount );
+    TEST_ASSERT_EQUAL( IORING_OP_RECV, submittedEntries[ 0 ].opcode );
+    TEST_ASSERT_EQUAL( BUFFER_LEN, submittedEntries[ 0 ].len );
+    TEST_ASSERT_TRUE( ( submittedEntries[ 0 ].flags & IOSQE_IO_LINK ) != 0U );
+    TEST_ASSERT_EQUAL( IORING_OP_LINK_TIMEOUT, submittedEntries[ 1 ].opcode );
+
+    /* The linked timeout expired. */
+    transferResult = -ECANCELED;
+    timeoutResult = -ETIME;
+    TEST_ASSERT_EQUAL( 0, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+
+    /* The peer closed the connection. */
+    transferResult = 0;
+    TEST_ASSERT_EQUAL( -1, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+
+    /* The receive failed. */
+    transferResult = -ECONNRESET;
+    TEST_ASSERT_EQUAL( -1, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+
+    /* No timeout is linked when waiting forever. */
+    submittedCount = 0U;
+    uringParams.recvTimeoutMs = 0U;
+    transferResult = BUFFER_LEN;
+    TEST_ASSERT_EQUAL( BUFFER_LEN, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( 1, submittedCount );
+    TEST_ASSERT_EQUAL( 0, submittedEntries[ 0 ].flags & IOSQE_IO_LINK );
+}
+
+/**
+ * @brief Test that an interrupted wait is resumed, and that failing to wait
+ * returns an error.
+ */
+void test_Uring_Recv_Enter_Failures( void )
+{
+    connectRing();
+
+    interruptedCount = 1U;
+    TEST_ASSERT_EQUAL( BUFFER_LEN, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( 2, enterCount );
+
+    UringSyscall_Enter_StubWithCallback( NULL );
+    UringSyscall_Enter_ExpectAnyArgsAndReturn( -1 );
+    errno = EBADF;
+    TEST_ASSERT_EQUAL( -1, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+}
+
+/**
+ * @brief Test that small reads are served from the registered read-ahead
+ * buffer, which is filled with a single fixed-buffer read.
+ */
+void test_Uring_Recv_Read_Ahead( void )
+{
+    uringParams.pRecvBuffer = readAheadBuffer;
+    uringParams.recvBufferSize = REGISTERED_LEN;
+    UringSyscall_Register_ExpectAnyArgsAndReturn( 0 );
+    connectRing();
+
+    pReceivedData = "abcdef";
+    transferResult = 6;
+    TEST_ASSERT_EQUAL( 1, Uring_Recv( &networkContext, uringBuffer, 1U ) );
+    TEST_ASSERT_EQUAL( 'a', uringBuffer[ 0 ] );
+    TEST_ASSERT_EQUAL( IORING_OP_READ_FIXED, submittedEntries[ 0 ].opcode );
+    TEST_ASSERT_EQUAL( REGISTERED_LEN, submittedEntries[ 0 ].len );
+    TEST_ASSERT_EQUAL( 0, submittedEntries[ 0 ].buf_index );
+
+    /* The rest is served from memory, with a short read at the end. */
+    TEST_ASSERT_EQUAL( BUFFER_LEN, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( 0, memcmp( uringBuffer, "bcde", BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( 1, Uring_Recv( &networkContext, uringBuffer, BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( 'f', uringBuffer[ 0 ] );
+    TEST_ASSERT_EQUAL( 1, enterCount );
+
+    /* Reads as large as the buffer bypass it. */
+    transferResult = REGISTERED_LEN;
+    pReceivedData = "12345678";
+    TEST_ASSERT_EQUAL( REGISTERED_LEN, Uring_Recv( &networkContext, sendBuffer, REGISTERED_LEN ) );
+    TEST_ASSERT_EQUAL( IORING_OP_RECV, submittedEntries[ 2 ].opcode );
+    TEST_ASSERT_EQUAL( 0, uringParams.recvBufferLength );
+}
+
+/**
+ * @brief Test that #Uring_Send sends through the registered send buffer when
+ * it fits, and that #Uring_Writev sends all buffers with one operation.
+ */
+void test_Uring_Send_And_Writev( void )
+{
+    struct iovec ioVec[ 2 ];
+
+    uringParams.pSendBuffer = sendBuffer;
+    uringParams.sendBufferSize = REGISTERED_LEN;
+    UringSyscall_Register_ExpectAnyArgsAndReturn( 0 );
+    connectRing();
+
+    TEST_ASSERT_EQUAL( BUFFER_LEN, Uring_Send( &networkContext, "data", BUFFER_LEN ) );
+    TEST_ASSERT_EQUAL( IORING_OP_WRITE_FIXED, submittedEntries[ 0 ].opcode );
+    TEST_ASSERT_EQUAL( ( uintptr_t ) sendBuffer, submittedEntries[ 0 ].addr );
+    TEST_ASSERT_EQUAL( 0, submittedEntries[ 0 ].buf_index );
+    TEST_ASSERT_EQUAL( 0, memcmp( sendBuffer, "data", BUFFER_LEN ) );
+
+    /* Sends larger than the registered buffer are not copied. */
+    transferResult = REGISTERED_LEN + 1;
+    TEST_ASSERT_EQUAL( REGISTERED_LEN + 1,
+                       Uring_Send( &networkContext, "123456789", REGISTERED_LEN + 1 ) );
+    TEST_ASSERT_EQUAL( IORING_OP_SEND, submittedEntries[ 2 ].opcode );
+
+    /* The linked timeout expired. */
+    transferResult = -ECANCELED;
+    TEST_ASSERT_EQUAL( 0, Uring_Send( &networkContext, "data", BUFFER_LEN ) );
+
+    transferResult = 3;
+    ioVec[ 0 ].iov_base = "ab";
+    ioVec[ 0 ].iov_len = 2U;
+    ioVec[ 1 ].iov_base = "c";
+    ioVec[ 1 ].iov_len = 1U;
+    TEST_ASSERT_EQUAL( 3, Uring_Writev( &networkContext, ioVec, 2U ) );
+    TEST_ASSERT_EQUAL( IORING_OP_SENDMSG, submittedEntries[ 6 ].opcode );
+    TEST_ASSERT_EQUAL( 1, submittedEntries[ 6 ].len );
+}
+
+/**
+ * @brief Test that in polling mode the submission thread is only woken up
+ * with a system call when it has gone idle.
+ */
+void test_Uring_Poll_Completions_Wakes_Idle_Thread( void )
+{
+    uringParams.pollCompletions = 1U;
+    connectRing();
+
+    submissionRing[ RING_FLAGS_OFFSET / sizeof( uint32_t ) ] = IORING_SQ_NEED_WAKEUP;
+    TEST_ASSERT_EQUAL( BUFFER_LEN, Uring_Send( &networkContext, "data", BUFFER_LEN ) );
+
+    /* The simulated kernel completes the entries when woken up, so no system
+     * call is needed to wait for them. */
+    TEST_ASSERT_EQUAL( 1, enterCount );
+    TEST_ASSERT_EQUAL( IORING_ENTER_SQ_WAKEUP, enterFlags[ 0 ] );
+}
@@ -0,0 +1,263 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "allocator.h"
+
+/* The number of threads allocating concurrently. */
+#define THREAD_COUNT            ( 4U )
+
+/* The number of allocations of each thread. */
+#define ALLOCS_PER_THREAD       ( 10000U )
+
+/* The size of the buffer of the pools of the tests. */
+#define POOL_BUFFER_SIZE        ( 4096U )
+
+/* The buffer of the pools of the tests, misaligned on purpose by the tests. */
+static uint8_t poolBuffer[ POOL_BUFFER_SIZE + ALLOCATOR_ALIGNMENT ];
+
+/* The pool of the tests. */
+static AllocatorPool_t pool;
+
+/**
+ * @brief Used as the thread function that allocates and frees blocks.
+ *
+ * @param[in] pArgument Unused.
+ *
+ * @return NULL.
+ */
+static void * allocateThread( void * pArgument )
+{
+    uint32_t i = 0U;
+
+    ( void ) pArgument;
+
+    for( i = 0U; i < ALLOCS_PER_THREAD; i++ )
+    {
+        Allocator_Free( Allocator_Malloc( ALLOCATOR_SUBSYSTEM_MQTT, 1U + ( i % 200U ) ) );
+    }
+
+    return NULL;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    Allocator_Reset();
+    ( void ) memset( &pool, 0, sizeof( pool ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that the blocks are counted for their subsystem and in the
+ * totals, headers included, and that the peak stays after they are freed.
+ */
+void test_Allocator_Counts_Subsystems( void )
+{
+    AllocatorStats_t stats;
+    void * pFirst = NULL, * pSecond = NULL;
+
+    pFirst = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_TRANSPORT, 100U );
+    pSecond = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_DEMO, 50U );
+    TEST_ASSERT_NOT_NULL( pFirst );
+    TEST_ASSERT_NOT_NULL( pSecond );
+    TEST_ASSERT_EQUAL( 0U, ( uintptr_t ) pFirst % ALLOCATOR_ALIGNMENT );
+
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_TRANSPORT, &stats );
+    TEST_ASSERT_EQUAL( 100U + ALLOCATOR_ALIGNMENT, stats.currentBytes );
+    TEST_ASSERT_EQUAL( 1U, stats.blocks );
+
+    Allocator_GetTotalStats( &stats );
+    TEST_ASSERT_EQUAL( 150U + ( 2U * ALLOCATOR_ALIGNMENT ), stats.currentBytes );
+    TEST_ASSERT_EQUAL( 2U, stats.allocations );
+
+    Allocator_Free( pFirst );
+    Allocator_Free( pSecond );
+    Allocator_Free( NULL );
+
+    Allocator_GetTotalStats( &stats );
+    TEST_ASSERT_EQUAL( 0U, stats.currentBytes );
+    TEST_ASSERT_EQUAL( 0U, stats.blocks );
+    TEST_ASSERT_EQUAL( 150U + ( 2U * ALLOCATOR_ALIGNMENT ), stats.peakBytes );
+
+    Allocator_ResetPeaks();
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_DEMO, &stats );
+    TEST_ASSERT_EQUAL( 0U, stats.peakBytes );
+}
+
+/**
+ * @brief Test #Allocator_Calloc, #Allocator_Realloc and #Allocator_Strndup.
+ */
+void test_Allocator_Calloc_Realloc_Strndup( void )
+{
+    uint8_t * pBlock = NULL;
+    char * pCopy = NULL;
+    AllocatorStats_t stats;
+
+    TEST_ASSERT_NULL( Allocator_Calloc( ALLOCATOR_SUBSYSTEM_OTHER, ( ( size_t ) -1 ) / 2U, 3U ) );
+
+    pBlock = Allocator_Calloc( ALLOCATOR_SUBSYSTEM_OTHER, 4U, 8U );
+    TEST_ASSERT_NOT_NULL( pBlock );
+    TEST_ASSERT_EACH_EQUAL_UINT8( 0U, pBlock, 32U );
+    pBlock[ 31 ] = 0xA5U;
+
+    /* Shrinking keeps the block; growing copies it. */
+    TEST_ASSERT_EQUAL_PTR( pBlock, Allocator_Realloc( ALLOCATOR_SUBSYSTEM_OTHER, pBlock, 16U ) );
+    pBlock = Allocator_Realloc( ALLOCATOR_SUBSYSTEM_OTHER, pBlock, 1000U );
+    TEST_ASSERT_NOT_NULL( pBlock );
+    TEST_ASSERT_EQUAL_UINT8( 0xA5U, pBlock[ 31 ] );
+    TEST_ASSERT_NULL( Allocator_Realloc( ALLOCATOR_SUBSYSTEM_OTHER, pBlock, 0U ) );
+
+    pCopy = Allocator_Strndup( ALLOCATOR_SUBSYSTEM_DEMO, "https://example.com/file", 19U );
+    TEST_ASSERT_EQUAL_STRING( "https://example.com", pCopy );
+    Allocator_Free( pCopy );
+    pCopy = Allocator_Strndup( ALLOCATOR_SUBSYSTEM_DEMO, "short", 100U );
+    TEST_ASSERT_EQUAL_STRING( "short", pCopy );
+    Allocator_Free( pCopy );
+    TEST_ASSERT_NULL( Allocator_Strndup( ALLOCATOR_SUBSYSTEM_DEMO, NULL, 1U ) );
+
+    Allocator_GetTotalStats( &stats );
+    TEST_ASSERT_EQUAL( 0U, stats.blocks );
+    TEST_ASSERT_EQUAL( 1U, stats.failures );
+}
+
+/**
+ * @brief Test that a pool reuses the blocks released, fails when exhausted,
+ * and aligns a misaligned buffer.
+ */
+void test_AllocatorPool_Reuse_And_Exhaustion( void )
+{
+    void * pFirst = NULL, * pSecond = NULL;
+
+    TEST_ASSERT_EQUAL( AllocatorBadParameter, AllocatorPool_Init( NULL, poolBuffer, POOL_BUFFER_SIZE ) );
+    TEST_ASSERT_EQUAL( AllocatorBadParameter, AllocatorPool_Init( &pool, poolBuffer, 8U ) );
+    TEST_ASSERT_EQUAL( AllocatorSuccess, AllocatorPool_Init( &pool, &poolBuffer[ 1 ], POOL_BUFFER_SIZE ) );
+    TEST_ASSERT_EQUAL( 0U, ( uintptr_t ) pool.pBuffer % ALLOCATOR_ALIGNMENT );
+
+    pFirst = AllocatorPool_Allocate( &pool, 100U );
+    TEST_ASSERT_NOT_NULL( pFirst );
+    TEST_ASSERT_EQUAL( 128U, pool.used );
+
+    /* A block of the same class comes back from the free list. */
+    AllocatorPool_Release( &pool, pFirst, 100U );
+    pSecond = AllocatorPool_Allocate( &pool, 120U );
+    TEST_ASSERT_EQUAL_PTR( pFirst, pSecond );
+    TEST_ASSERT_EQUAL( 128U, pool.used );
+
+    TEST_ASSERT_NULL( AllocatorPool_Allocate( &pool, POOL_BUFFER_SIZE ) );
+    TEST_ASSERT_NOT_NULL( AllocatorPool_Allocate( &pool, 2048U ) );
+    TEST_ASSERT_NULL( AllocatorPool_Allocate( &pool, 2048U ) );
+    TEST_ASSERT_NULL( AllocatorPool_Allocate( &pool,
+                                              ( ( size_t ) ALLOCATOR_POOL_MIN_BLOCK_SIZE << ALLOCATOR_POOL_CLASS_COUNT ) ) );
+}
+
+/**
+ * @brief Test that the allocator takes its blocks from a pool backend, and
+ * that the backend cannot change while blocks are in use.
+ */
+void test_Allocator_SetBackend_Pool( void )
+{
+    AllocatorBackend_t backend;
+    AllocatorStats_t stats;
+    uint8_t * pBlock = NULL;
+
+    TEST_ASSERT_EQUAL( AllocatorSuccess, AllocatorPool_Init( &pool, poolBuffer, POOL_BUFFER_SIZE ) );
+    backend.allocate = AllocatorPool_Allocate;
+    backend.release = NULL;
+    backend.pContext = &pool;
+    TEST_ASSERT_EQUAL( AllocatorBadParameter, Allocator_SetBackend( &backend ) );
+    backend.release = AllocatorPool_Release;
+    TEST_ASSERT_EQUAL( AllocatorSuccess, Allocator_SetBackend( &backend ) );
+
+    pBlock = Allocator_Malloc( ALLOCATOR_SUBSYSTEM_OPENSSL, 200U );
+    TEST_ASSERT_TRUE( ( pBlock > pool.pBuffer ) && ( pBlock < &pool.pBuffer[ pool.size ] ) );
+    TEST_ASSERT_EQUAL( AllocatorBusy, Allocator_SetBackend( NULL ) );
+
+    /* A block larger than the pool fails, and is counted. */
+    TEST_ASSERT_NULL( Allocator_Malloc( ALLOCATOR_SUBSYSTEM_OPENSSL, POOL_BUFFER_SIZE ) );
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_OPENSSL, &stats );
+    TEST_ASSERT_EQUAL( 1U, stats.failures );
+
+    Allocator_Free( pBlock );
+    TEST_ASSERT_EQUAL( AllocatorSuccess, Allocator_SetBackend( NULL ) );
+}
+
+/**
+ * @brief Test that the counts of concurrent threads add up.
+ */
+void test_Allocator_Concurrent_Threads( void )
+{
+    pthread_t threads[ THREAD_COUNT ];
+    AllocatorStats_t stats;
+    uint32_t i = 0U;
+
+    for( i = 0U; i < THREAD_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[ i ], NULL, allocateThread, NULL ) );
+    }
+
+    for( i = 0U; i < THREAD_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_join( threads[ i ], NULL ) );
+    }
+
+    Allocator_GetStats( ALLOCATOR_SUBSYSTEM_MQTT, &stats );
+    TEST_ASSERT_EQUAL( THREAD_COUNT * ALLOCS_PER_THREAD, stats.allocations );
+    TEST_ASSERT_EQUAL( 0U, stats.currentBytes );
+    TEST_ASSERT_EQUAL( 0U, stats.blocks );
+    TEST_ASSERT_TRUE( stats.peakBytes <= ( THREAD_COUNT * ( 200U + ALLOCATOR_ALIGNMENT ) ) );
+}
+
+/**
+ * @brief Test the names of the subsystems.
+ */
+void test_Allocator_SubsystemName( void )
+{
+    TEST_ASSERT_EQUAL_STRING( "openssl", Allocator_SubsystemName( ALLOCATOR_SUBSYSTEM_OPENSSL ) );
+    TEST_ASSERT_EQUAL_STRING( "unknown", Allocator_SubsystemName( ALLOCATOR_SUBSYSTEM_COUNT ) );
+}
@@ -153,3 +153,70 @@ void test_Clock_SleepMs_Passes_Expected_Values_To_nanosleep()
     nanosleep_Stub( nanosleep_validate_args );
     Clock_SleepMs( sleepTimeMs );
 }
+
+/**
+ * @brief Test that #Clock_GetTimeNs reads the raw monotonic clock and returns
+ * the full 64-bit time in nanoseconds.
+ */
+void test_Clock_GetTimeNs_Returns_Expected_Time( void )
+{
+    uint64_t actualTimeNs, expectedTimeNs;
+    struct timespec timeSpec;
+
+    /* A time that does not fit in 32 bits of milliseconds. */
+    timeSpec.tv_sec = ( time_t ) 5000000;
+    timeSpec.tv_nsec = GET_TIME_NS;
+
+    clock_gettime_ExpectAndReturn( CLOCK_MONOTONIC_RAW, NULL, 0 );
+    clock_gettime_IgnoreArg_time_point();
+    clock_gettime_ReturnThruPtr_time_point( &timeSpec );
+    actualTimeNs = Clock_GetTimeNs();
+
+    expectedTimeNs = ( ( uint64_t ) timeSpec.tv_sec * 1000000000ULL ) + ( uint64_t ) timeSpec.tv_nsec;
+
+    TEST_ASSERT_TRUE( expectedTimeNs == actualTimeNs );
+}
+
+/**
+ * @brief Test that #Clock_GetTimeUs returns the time of #Clock_GetTimeNs in
+ * microseconds.
+ */
+void test_Clock_GetTimeUs_Returns_Expected_Time( void )
+{
+    uint64_t actualTimeUs, expectedTimeUs;
+    struct timespec timeSpec;
+
+    timeSpec.tv_sec = ( time_t ) 5000000;
+    timeSpec.tv_nsec = GET_TIME_NS;
+
+    clock_gettime_ExpectAndReturn( CLOCK_MONOTONIC_RAW, NULL, 0 );
+    clock_gettime_IgnoreArg_time_point();
+    clock_gettime_ReturnThruPtr_time_point( &timeSpec );
+    actualTimeUs = Clock_GetTimeUs();
+
+    expectedTimeUs = ( ( uint64_t ) timeSpec.tv_sec * 1000000ULL ) + ( ( uint64_t ) timeSpec.tv_nsec / 1000ULL );
+
+    TEST_ASSERT_TRUE( expectedTimeUs == actualTimeUs );
+}
+
+/**
+ * @brief Test that #Clock_GetCoarseTimeMs reads the coarse monotonic clock.
+ */
+void test_Clock_GetCoarseTimeMs_Returns_Expected_Time( void )
+{
+    uint32_t actualTimeMs, expectedTimeMs;
+    struct timespec timeSpec;
+
+    timeSpec.tv_sec = GET_TIME_S;
+    timeSpec.tv_nsec = GET_TIME_NS;
+
+    clock_gettime_ExpectAndReturn( CLOCK_MONOTONIC_COARSE, NULL, 0 );
+    clock_gettime_IgnoreArg_time_point();
+    clock_gettime_ReturnThruPtr_time_point( &timeSpec );
+    actualTimeMs = Clock_GetCoarseTimeMs();
+
+    expectedTimeMs = ( timeSpec.tv_sec * MILLISECONDS_PER_SECOND )
+                     + ( timeSpec.tv_nsec / NANOSECONDS_PER_MILLISECOND );
+
+    TEST_ASSERT_EQUAL( expectedTimeMs, actualTimeMs );
+}
@@ -0,0 +1,317 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "metrics.h"
+
+/* The number of threads adding to a counter concurrently. */
+#define THREAD_COUNT         ( 4U )
+
+/* The number of additions of each thread. */
+#define ADDS_PER_THREAD      ( 10000U )
+
+/* The identifier of the counter the threads add to. */
+static MetricsId_t threadCounterId = METRICS_INVALID_ID;
+
+/* The samples of the snapshots of the tests. */
+static MetricsSample_t samples[ METRICS_MAX_COUNT ];
+
+/* The text written by #Metrics_FormatPrometheus. */
+static char promBuffer[ 4096 ];
+
+/**
+ * @brief Used as the thread function that adds to #threadCounterId.
+ *
+ * @param[in] pArgument Unused.
+ *
+ * @return NULL.
+ */
+static void * addThread( void * pArgument )
+{
+    uint32_t i = 0U;
+
+    ( void ) pArgument;
+
+    for( i = 0U; i < ADDS_PER_THREAD; i++ )
+    {
+        Metrics_Add( threadCounterId, 1U );
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Used as the callback of a gauge.
+ *
+ * @param[in] pContext The value returned.
+ *
+ * @return The value pointed to by pContext.
+ */
+static int64_t readGauge( void * pContext )
+{
+    return *( ( const int64_t * ) pContext );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    Metrics_Reset();
+    ( void ) memset( samples, 0, sizeof( samples ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #Metrics_Register returns the identifier of a metric
+ * registered already, and rejects the name with another type.
+ */
+void test_Metrics_Register_Same_Name( void )
+{
+    MetricsId_t first = METRICS_INVALID_ID, second = METRICS_INVALID_ID;
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_publishes_total", "Publishes.", METRICS_TYPE_COUNTER, &first ) );
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_publishes_total", NULL, METRICS_TYPE_COUNTER, &second ) );
+    TEST_ASSERT_EQUAL( first, second );
+
+    TEST_ASSERT_EQUAL( MetricsTypeMismatch, Metrics_Register( "sdk_publishes_total", NULL, METRICS_TYPE_GAUGE, &second ) );
+    TEST_ASSERT_EQUAL( METRICS_INVALID_ID, second );
+}
+
+/**
+ * @brief Test that #Metrics_Register rejects invalid names and parameters.
+ */
+void test_Metrics_Register_Invalid_Parameters( void )
+{
+    MetricsId_t id = 0U;
+    char longName[ METRICS_NAME_MAX_LENGTH + 2U ];
+
+    ( void ) memset( longName, 'a', sizeof( longName ) - 1U );
+    longName[ sizeof( longName ) - 1U ] = '\0';
+
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Register( "sdk_count", NULL, METRICS_TYPE_COUNTER, NULL ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Register( NULL, NULL, METRICS_TYPE_COUNTER, &id ) );
+    TEST_ASSERT_EQUAL( METRICS_INVALID_ID, id );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Register( "", NULL, METRICS_TYPE_COUNTER, &id ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Register( "1st_count", NULL, METRICS_TYPE_COUNTER, &id ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Register( "sdk-count", NULL, METRICS_TYPE_COUNTER, &id ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Register( longName, NULL, METRICS_TYPE_COUNTER, &id ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Register( "sdk_count", NULL, ( MetricsType_t ) 3, &id ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_RegisterGaugeCallback( "sdk_gauge", NULL, NULL, NULL, &id ) );
+
+    /* The longest name is valid. */
+    longName[ METRICS_NAME_MAX_LENGTH ] = '\0';
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( longName, NULL, METRICS_TYPE_COUNTER, &id ) );
+}
+
+/**
+ * @brief Test that #Metrics_Register fails once the registry or its
+ * histograms are full.
+ */
+void test_Metrics_Register_Registry_Full( void )
+{
+    MetricsId_t id = METRICS_INVALID_ID;
+    char name[ 16 ];
+    uint32_t i = 0U;
+
+    for( i = 0U; i < METRICS_MAX_HISTOGRAMS; i++ )
+    {
+        ( void ) snprintf( name, sizeof( name ), "histogram_%u", ( unsigned int ) i );
+        TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( name, NULL, METRICS_TYPE_HISTOGRAM, &id ) );
+    }
+
+    TEST_ASSERT_EQUAL( MetricsRegistryFull, Metrics_Register( "histogram_extra", NULL, METRICS_TYPE_HISTOGRAM, &id ) );
+    TEST_ASSERT_EQUAL( METRICS_INVALID_ID, id );
+
+    for( i = METRICS_MAX_HISTOGRAMS; i < METRICS_MAX_COUNT; i++ )
+    {
+        ( void ) snprintf( name, sizeof( name ), "counter_%u", ( unsigned int ) i );
+        TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( name, NULL, METRICS_TYPE_COUNTER, &id ) );
+    }
+
+    TEST_ASSERT_EQUAL( MetricsRegistryFull, Metrics_Register( "counter_extra", NULL, METRICS_TYPE_COUNTER, &id ) );
+
+    /* Recording into the invalid identifier does nothing. */
+    Metrics_Add( METRICS_INVALID_ID, 1U );
+    Metrics_Observe( METRICS_INVALID_ID, 1U );
+    Metrics_Set( METRICS_INVALID_ID, 1 );
+}
+
+/**
+ * @brief Test that #Metrics_Snapshot merges the additions of several
+ * threads, including the ones that exited.
+ */
+void test_Metrics_Snapshot_Merges_Threads( void )
+{
+    pthread_t threads[ THREAD_COUNT ];
+    size_t count = 0U;
+    uint32_t i = 0U;
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_adds_total", NULL, METRICS_TYPE_COUNTER, &threadCounterId ) );
+
+    for( i = 0U; i < THREAD_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_create( &threads[ i ], NULL, addThread, NULL ) );
+    }
+
+    for( i = 0U; i < THREAD_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_join( threads[ i ], NULL ) );
+    }
+
+    /* The shards released by the threads are reused by the next ones. */
+    TEST_ASSERT_EQUAL( 0, pthread_create( &threads[ 0 ], NULL, addThread, NULL ) );
+    TEST_ASSERT_EQUAL( 0, pthread_join( threads[ 0 ], NULL ) );
+    Metrics_Add( threadCounterId, 5U );
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Snapshot( samples, METRICS_MAX_COUNT, &count ) );
+    TEST_ASSERT_EQUAL( 1U, count );
+    TEST_ASSERT_EQUAL_STRING( "sdk_adds_total", samples[ 0 ].pName );
+    TEST_ASSERT_EQUAL( METRICS_TYPE_COUNTER, samples[ 0 ].type );
+    TEST_ASSERT_EQUAL_UINT64( ( ( THREAD_COUNT + 1U ) * ADDS_PER_THREAD ) + 5U, samples[ 0 ].counter );
+}
+
+/**
+ * @brief Test that #Metrics_Observe counts values in the log2 buckets.
+ */
+void test_Metrics_Observe_Buckets( void )
+{
+    MetricsId_t id = METRICS_INVALID_ID;
+    size_t count = 0U;
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_latency_us", NULL, METRICS_TYPE_HISTOGRAM, &id ) );
+
+    Metrics_Observe( id, 0U );
+    Metrics_Observe( id, 1U );
+    Metrics_Observe( id, 2U );
+    Metrics_Observe( id, 3U );
+    Metrics_Observe( id, 1000U );
+    Metrics_Observe( id, 0xFFFFFFFFU );
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Snapshot( samples, METRICS_MAX_COUNT, &count ) );
+    TEST_ASSERT_EQUAL_UINT64( 6U, samples[ 0 ].count );
+    TEST_ASSERT_EQUAL_UINT64( ( uint64_t ) 0xFFFFFFFFU + 1006U, samples[ 0 ].sum );
+    TEST_ASSERT_EQUAL_UINT64( 2U, samples[ 0 ].buckets[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT64( 2U, samples[ 0 ].buckets[ 1 ] );
+    TEST_ASSERT_EQUAL_UINT64( 1U, samples[ 0 ].buckets[ 9 ] );
+    TEST_ASSERT_EQUAL_UINT64( 1U, samples[ 0 ].buckets[ METRICS_HISTOGRAM_BUCKETS - 1U ] );
+}
+
+/**
+ * @brief Test that #Metrics_Snapshot reads the gauges, set or read from
+ * their callback, and reports a short array.
+ */
+void test_Metrics_Snapshot_Gauges_And_Short_Array( void )
+{
+    MetricsId_t id = METRICS_INVALID_ID;
+    int64_t callbackValue = 42;
+    size_t count = 0U;
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_connections", NULL, METRICS_TYPE_GAUGE, &id ) );
+    Metrics_Set( id, -3 );
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_RegisterGaugeCallback( "sdk_queue_depth", NULL, readGauge, &callbackValue, &id ) );
+    TEST_ASSERT_EQUAL( MetricsTypeMismatch, Metrics_Register( "sdk_queue_depth", NULL, METRICS_TYPE_GAUGE, &id ) );
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Snapshot( samples, METRICS_MAX_COUNT, &count ) );
+    TEST_ASSERT_EQUAL( 2U, count );
+    TEST_ASSERT_EQUAL_INT64( -3, samples[ 0 ].gauge );
+    TEST_ASSERT_EQUAL_INT64( 42, samples[ 1 ].gauge );
+
+    TEST_ASSERT_EQUAL( MetricsNoMemory, Metrics_Snapshot( samples, 1U, &count ) );
+    TEST_ASSERT_EQUAL( 1U, count );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Snapshot( NULL, 1U, &count ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_Snapshot( samples, 1U, NULL ) );
+}
+
+/**
+ * @brief Test the text of #Metrics_FormatPrometheus, and that it fails
+ * when the buffer is too small.
+ */
+void test_Metrics_FormatPrometheus( void )
+{
+    MetricsId_t id = METRICS_INVALID_ID;
+    size_t length = 0U;
+
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_sends_total", "Sends\nof the\\SDK.", METRICS_TYPE_COUNTER, &id ) );
+    Metrics_Add( id, 7U );
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_connections", NULL, METRICS_TYPE_GAUGE, &id ) );
+    Metrics_Set( id, 2 );
+    TEST_ASSERT_EQUAL( MetricsSuccess, Metrics_Register( "sdk_latency_us", NULL, METRICS_TYPE_HISTOGRAM, &id ) );
+    Metrics_Observe( id, 3U );
+
+    length = Metrics_FormatPrometheus( promBuffer, sizeof( promBuffer ) );
+    TEST_ASSERT_EQUAL( strlen( promBuffer ), length );
+    TEST_ASSERT_NOT_NULL( strstr( promBuffer, "# HELP sdk_sends_total Sends of the SDK.\n"
+                                              "# TYPE sdk_sends_total counter\n"
+                                              "sdk_sends_total 7\n"
+                                              "# TYPE sdk_connections gauge\n"
+                                              "sdk_connections 2\n"
+                                              "# TYPE sdk_latency_us histogram\n"
+                                              "sdk_latency_us_bucket{le=\"1\"} 0\n"
+                                              "sdk_latency_us_bucket{le=\"3\"} 1\n"
+                                              "sdk_latency_us_bucket{le=\"7\"} 1\n" ) );
+    TEST_ASSERT_NOT_NULL( strstr( promBuffer, "sdk_latency_us_bucket{le=\"+Inf\"} 1\n"
+                                              "sdk_latency_us_sum 3\n"
+                                              "sdk_latency_us_count 1\n" ) );
+
+    TEST_ASSERT_EQUAL( 0U, Metrics_FormatPrometheus( promBuffer, 64U ) );
+    TEST_ASSERT_EQUAL( 0U, Metrics_FormatPrometheus( NULL, sizeof( promBuffer ) ) );
+}
+
+/**
+ * @brief Test that #Metrics_SendStatsd rejects invalid parameters.
+ */
+void test_Metrics_SendStatsd_Invalid_Parameters( void )
+{
+    char longPrefix[ 80 ];
+
+    ( void ) memset( longPrefix, 'a', sizeof( longPrefix ) - 1U );
+    longPrefix[ sizeof( longPrefix ) - 1U ] = '\0';
+
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_SendStatsd( NULL, 8125U, NULL ) );
+    TEST_ASSERT_EQUAL( MetricsBadParameter, Metrics_SendStatsd( "127.0.0.1", 8125U, longPrefix ) );
+}
@@ -0,0 +1,249 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "random.h"
+
+#include "mock_random_api.h"
+
+/* The length of the buffer of random bytes in random_posix.c. */
+#define RANDOM_BUFFER_LENGTH    ( 256U )
+
+/* A request longer than the buffer, which is not buffered. */
+#define LARGE_REQUEST_LENGTH    ( 300U )
+
+/* The value of the first byte written by #getrandom_fill. */
+static uint8_t nextByte = 0U;
+
+/* The number of calls to #getrandom_fill, and the length of the last. */
+static size_t fillCalls = 0U;
+static size_t lastFillLength = 0U;
+
+/**
+ * @brief Used as the callback of #getrandom to write a counting sequence
+ * of bytes, so that the bytes served can be told apart.
+ *
+ * @param[in] buffer The buffer to fill.
+ * @param[in] length The length of the buffer.
+ * @param[in] flags The flags of the request.
+ *
+ * @return length.
+ */
+static ssize_t getrandom_fill( void * buffer,
+                               size_t length,
+                               unsigned int flags,
+                               int numCalls )
+{
+    uint8_t * pBytes = ( uint8_t * ) buffer;
+    size_t i = 0U;
+
+    /* Suppress unused parameter warning. */
+    ( void ) numCalls;
+
+    TEST_ASSERT_EQUAL( 0U, flags );
+
+    fillCalls++;
+    lastFillLength = length;
+
+    for( i = 0U; i < length; i++ )
+    {
+        pBytes[ i ] = nextByte;
+        nextByte++;
+    }
+
+    return ( ssize_t ) length;
+}
+
+/**
+ * @brief Used as the callback of #getrandom to be interrupted by a signal
+ * on the first call, and to write half of the request on the second.
+ *
+ * @return -1, the half of length written, then length.
+ */
+static ssize_t getrandom_interrupted( void * buffer,
+                                      size_t length,
+                                      unsigned int flags,
+                                      int numCalls )
+{
+    ssize_t bytesRead = -1;
+
+    if( numCalls == 0 )
+    {
+        errno = EINTR;
+    }
+    else if( numCalls == 1 )
+    {
+        bytesRead = getrandom_fill( buffer, length / 2U, flags, numCalls );
+    }
+    else
+    {
+        bytesRead = getrandom_fill( buffer, length, flags, numCalls );
+    }
+
+    return bytesRead;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    nextByte = 0U;
+    fillCalls = 0U;
+    lastFillLength = 0U;
+    Random_Reset();
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #Random_GetUint32 serves a buffer of random bytes from a
+ * single call to #getrandom before it calls it again.
+ */
+void test_Random_GetUint32_Serves_Buffer_From_One_Call( void )
+{
+    uint32_t value = 0U, expected = 0U;
+    uint8_t expectedBytes[ sizeof( uint32_t ) ];
+    size_t i = 0U, j = 0U;
+
+    getrandom_Stub( getrandom_fill );
+
+    for( i = 0U; i < ( RANDOM_BUFFER_LENGTH / sizeof( uint32_t ) ); i++ )
+    {
+        for( j = 0U; j < sizeof( uint32_t ); j++ )
+        {
+            expectedBytes[ j ] = ( uint8_t ) ( ( i * sizeof( uint32_t ) ) + j );
+        }
+
+        ( void ) memcpy( &expected, expectedBytes, sizeof( expected ) );
+        value = Random_GetUint32();
+        TEST_ASSERT_EQUAL( expected, value );
+    }
+
+    TEST_ASSERT_EQUAL( 1U, fillCalls );
+    TEST_ASSERT_EQUAL( RANDOM_BUFFER_LENGTH, lastFillLength );
+
+    /* The buffer is empty, so the next number refills it. */
+    ( void ) Random_GetUint32();
+    TEST_ASSERT_EQUAL( 2U, fillCalls );
+}
+
+/**
+ * @brief Test that #Random_GetBytes passes a request longer than the buffer
+ * straight to #getrandom, and keeps the bytes buffered for later requests.
+ */
+void test_Random_GetBytes_Large_Request_Is_Not_Buffered( void )
+{
+    uint8_t large[ LARGE_REQUEST_LENGTH ];
+    uint8_t small = 0U;
+
+    /* Buffer a single byte first. */
+    getrandom_Stub( getrandom_fill );
+    TEST_ASSERT_TRUE( Random_GetBytes( &small, sizeof( small ) ) );
+    TEST_ASSERT_EQUAL_UINT8( 0U, small );
+
+    TEST_ASSERT_TRUE( Random_GetBytes( large, sizeof( large ) ) );
+    TEST_ASSERT_EQUAL( 2U, fillCalls );
+    TEST_ASSERT_EQUAL( LARGE_REQUEST_LENGTH, lastFillLength );
+
+    /* The buffer still serves the bytes after the first one. */
+    TEST_ASSERT_TRUE( Random_GetBytes( &small, sizeof( small ) ) );
+    TEST_ASSERT_EQUAL_UINT8( 1U, small );
+    TEST_ASSERT_EQUAL( 2U, fillCalls );
+}
+
+/**
+ * @brief Test that #Random_GetBytes calls #getrandom again when it is
+ * interrupted by a signal or writes fewer bytes than requested.
+ */
+void test_Random_GetBytes_Retries_Interrupted_And_Short_Reads( void )
+{
+    uint8_t large[ LARGE_REQUEST_LENGTH ];
+
+    getrandom_Stub( getrandom_interrupted );
+    TEST_ASSERT_TRUE( Random_GetBytes( large, sizeof( large ) ) );
+
+    /* The second half continues the counting sequence of the first. */
+    TEST_ASSERT_EQUAL( 2U, fillCalls );
+    TEST_ASSERT_EQUAL( LARGE_REQUEST_LENGTH / 2U, lastFillLength );
+    TEST_ASSERT_EQUAL_UINT8( 0U, large[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT8( ( uint8_t ) ( LARGE_REQUEST_LENGTH - 1U ), large[ LARGE_REQUEST_LENGTH - 1U ] );
+}
+
+/**
+ * @brief Test that #Random_GetBytes and #Random_GetUint32 report a failure
+ * of #getrandom, and that they do not serve bytes of a failed request later.
+ */
+void test_Random_Fails_When_getrandom_Fails( void )
+{
+    uint8_t large[ LARGE_REQUEST_LENGTH ];
+
+    /* A failure other than an interruption by a signal. */
+    errno = EIO;
+    getrandom_ExpectAnyArgsAndReturn( -1 );
+    TEST_ASSERT_FALSE( Random_GetBytes( large, sizeof( large ) ) );
+
+    getrandom_ExpectAnyArgsAndReturn( 0 );
+    TEST_ASSERT_EQUAL( 0U, Random_GetUint32() );
+
+    /* The buffer is refilled on the next request. */
+    getrandom_ExpectAnyArgsAndReturn( ( ssize_t ) RANDOM_BUFFER_LENGTH );
+    ( void ) Random_GetUint32();
+}
+
+/**
+ * @brief Test that #Random_Reset discards the bytes buffered, so that the
+ * next request refills the buffer.
+ */
+void test_Random_Reset_Discards_Buffer( void )
+{
+    getrandom_Stub( getrandom_fill );
+    TEST_ASSERT_EQUAL( 0x03020100U, Random_GetUint32() );
+
+    Random_Reset();
+
+    ( void ) Random_GetUint32();
+    TEST_ASSERT_EQUAL( 2U, fillCalls );
+}
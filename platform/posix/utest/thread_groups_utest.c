@@ -0,0 +1,281 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "thread_groups.h"
+
+/* The size of the buffers of the allocation tests. */
+#define BUFFER_SIZE    ( 10000U )
+
+/* A CPU the tests may run on. */
+static uint32_t testCpu;
+
+/* The testCpu as a cpulist. */
+static char testCpuList[ 16 ];
+
+/* The CPUs of the thread of the tests, restored after each test. */
+static cpu_set_t testCpus;
+
+/* The CPUs of the last thread run by placedThread. */
+static cpu_set_t placedCpus;
+
+/* The name of the last thread run by placedThread. */
+static char placedName[ 16 ];
+
+/**
+ * @brief Used as the thread function that records its CPUs and its name.
+ *
+ * @param[in] pArgument Unused.
+ *
+ * @return NULL.
+ */
+static void * placedThread( void * pArgument )
+{
+    ( void ) pArgument;
+
+    ( void ) sched_getaffinity( 0, sizeof( placedCpus ), &placedCpus );
+    ( void ) pthread_getname_np( pthread_self(), placedName, sizeof( placedName ) );
+
+    return NULL;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ThreadGroup_Reset();
+    CPU_ZERO( &placedCpus );
+    ( void ) memset( placedName, 0, sizeof( placedName ) );
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+    ( void ) sched_setaffinity( 0, sizeof( testCpus ), &testCpus );
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+    uint32_t cpu = 0U;
+    bool found = false;
+
+    ( void ) sched_getaffinity( 0, sizeof( testCpus ), &testCpus );
+
+    for( cpu = 0U; ( cpu < ( uint32_t ) CPU_SETSIZE ) && ( found == false ); cpu++ )
+    {
+        if( CPU_ISSET( cpu, &testCpus ) != 0 )
+        {
+            testCpu = cpu;
+            found = true;
+        }
+    }
+
+    ( void ) snprintf( testCpuList, sizeof( testCpuList ), "%u", ( unsigned int ) testCpu );
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #ThreadGroup_Define rejects the invalid names and
+ * cpulists, and the lists of CPUs the process may not run on.
+ */
+void test_ThreadGroup_Define_Invalid_Parameters( void )
+{
+    char name[ THREAD_GROUP_NAME_MAX_LENGTH + 2U ];
+
+    ( void ) memset( name, 'a', sizeof( name ) - 1U );
+    name[ sizeof( name ) - 1U ] = '\0';
+
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( NULL, testCpuList ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "", testCpuList ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( name, testCpuList ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", NULL ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "a" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "-1" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "3-1" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "0," ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "0,,1" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "0 1" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "100000" ) );
+
+    /* The process does not run on the last CPU of cpu_set_t. */
+    if( CPU_ISSET( CPU_SETSIZE - 1, &testCpus ) == 0 )
+    {
+        TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "io", "1023" ) );
+    }
+
+    name[ THREAD_GROUP_NAME_MAX_LENGTH ] = '\0';
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( name, testCpuList ) );
+    TEST_ASSERT_EQUAL( THREAD_GROUP_NO_NODE, ThreadGroup_GetNode( "io" ) );
+}
+
+/**
+ * @brief Test that #ThreadGroup_Define fails once #THREAD_GROUP_MAX_COUNT
+ * groups are defined, and still changes the CPUs of a defined group.
+ */
+void test_ThreadGroup_Define_Table_Full( void )
+{
+    char name[ 8 ];
+    uint32_t i = 0U;
+
+    for( i = 0U; i < THREAD_GROUP_MAX_COUNT; i++ )
+    {
+        ( void ) snprintf( name, sizeof( name ), "g%u", ( unsigned int ) i );
+        TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( name, testCpuList ) );
+    }
+
+    TEST_ASSERT_EQUAL( ThreadGroupNoMemory, ThreadGroup_Define( "other", testCpuList ) );
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "g0", "0-1023" ) );
+}
+
+/**
+ * @brief Test that #ThreadGroup_CreateThread starts the threads of a group
+ * on its CPUs, named after the group, and those of no group on the CPUs
+ * available.
+ */
+void test_ThreadGroup_CreateThread_Places_Threads( void )
+{
+    pthread_t thread;
+    cpu_set_t expected;
+
+    CPU_ZERO( &expected );
+    CPU_SET( testCpu, &expected );
+
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_CreateThread( "io", NULL, placedThread, NULL ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_CreateThread( "io", &thread, NULL, NULL ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_CreateThread( NULL, &thread, placedThread, NULL ) );
+
+    /* The list is limited to the CPUs available. */
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "workers", "0-1023" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_CreateThread( "workers", &thread, placedThread, NULL ) );
+    TEST_ASSERT_EQUAL( 0, pthread_join( thread, NULL ) );
+    TEST_ASSERT_TRUE( CPU_EQUAL( &testCpus, &placedCpus ) );
+    TEST_ASSERT_EQUAL_STRING( "workers-0", placedName );
+
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "workers", testCpuList ) );
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_CreateThread( "workers", &thread, placedThread, NULL ) );
+    TEST_ASSERT_EQUAL( 0, pthread_join( thread, NULL ) );
+    TEST_ASSERT_TRUE( CPU_EQUAL( &expected, &placedCpus ) );
+    TEST_ASSERT_EQUAL_STRING( "workers-1", placedName );
+
+    /* A thread of no group does not inherit the CPUs of its creator. */
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_JoinCurrent( "workers" ) );
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_CreateThread( "download", &thread, placedThread, NULL ) );
+    TEST_ASSERT_EQUAL( 0, pthread_join( thread, NULL ) );
+    TEST_ASSERT_TRUE( CPU_EQUAL( &testCpus, &placedCpus ) );
+    TEST_ASSERT_EQUAL_STRING( "download-0", placedName );
+}
+
+/**
+ * @brief Test that #ThreadGroup_Isolate dedicates a CPU to a group, unless
+ * another group would be left without CPUs.
+ */
+void test_ThreadGroup_Isolate( void )
+{
+    cpu_set_t cpus;
+
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Isolate( NULL, testCpu ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Isolate( "io", ( uint32_t ) CPU_SETSIZE ) );
+
+    /* The CPU is the last one of another group. */
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "workers", testCpuList ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Isolate( "io", testCpu ) );
+
+    ThreadGroup_Reset();
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Isolate( "io", testCpu ) );
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Isolate( "io", testCpu ) );
+    TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Isolate( "mqtt", testCpu ) );
+
+    /* Another group only gets the CPUs not isolated. */
+    if( CPU_COUNT( &testCpus ) == 1 )
+    {
+        TEST_ASSERT_EQUAL( ThreadGroupBadParameter, ThreadGroup_Define( "workers", testCpuList ) );
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "workers", "0-1023" ) );
+    }
+
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_JoinCurrent( "io" ) );
+    TEST_ASSERT_EQUAL( 0, sched_getaffinity( 0, sizeof( cpus ), &cpus ) );
+    TEST_ASSERT_EQUAL( 1, CPU_COUNT( &cpus ) );
+    TEST_ASSERT_TRUE( CPU_ISSET( testCpu, &cpus ) != 0 );
+
+    /* Defined again, the group is no longer isolated. */
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "io", testCpuList ) );
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "mqtt", testCpuList ) );
+}
+
+/**
+ * @brief Test that #ThreadGroup_Allocate returns zeroed page aligned
+ * buffers, for the groups defined or not.
+ */
+void test_ThreadGroup_Allocate( void )
+{
+    uint8_t * pBuffer = NULL;
+    uint8_t * pOther = NULL;
+    size_t i = 0U;
+
+    TEST_ASSERT_NULL( ThreadGroup_Allocate( "io", 0U ) );
+    TEST_ASSERT_NULL( ThreadGroup_Allocate( "io", SIZE_MAX ) );
+
+    TEST_ASSERT_EQUAL( ThreadGroupSuccess, ThreadGroup_Define( "io", testCpuList ) );
+    pBuffer = ThreadGroup_Allocate( "io", BUFFER_SIZE );
+    pOther = ThreadGroup_Allocate( "download", BUFFER_SIZE );
+    TEST_ASSERT_NOT_NULL( pBuffer );
+    TEST_ASSERT_NOT_NULL( pOther );
+    TEST_ASSERT_EQUAL( 0U, ( uintptr_t ) pBuffer % ( uintptr_t ) sysconf( _SC_PAGESIZE ) );
+
+    for( i = 0U; i < BUFFER_SIZE; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0U, pBuffer[ i ] );
+    }
+
+    ( void ) memset( pBuffer, 0xA5, BUFFER_SIZE );
+    ( void ) memset( pOther, 0x5A, BUFFER_SIZE );
+    ThreadGroup_Free( pBuffer, BUFFER_SIZE );
+    ThreadGroup_Free( pOther, BUFFER_SIZE );
+    ThreadGroup_Free( NULL, BUFFER_SIZE );
+}
@@ -0,0 +1,217 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "unity.h"
+
+/* Include paths for public enums, structures, and macros. */
+#include "work_pool.h"
+
+/* The thread group of the workers. */
+#define GROUP_NAME        "workers"
+
+/* The number of workers of the tests. */
+#define WORKER_COUNT      ( 4U )
+
+/* The number of tasks of the tests. */
+#define TASK_COUNT        ( 1000U )
+
+/* The number of tasks submitted by the task blocking its worker. */
+#define CHILD_COUNT       ( 64U )
+
+/* The number of times the chained task submits itself again. */
+#define CHAIN_LENGTH      ( 100U )
+
+/* The number of yields after which a blocked task gives up. */
+#define MAX_WAIT_YIELDS   ( 10000000U )
+
+static WorkPool_t pool;
+
+static WorkPoolTask_t tasks[ TASK_COUNT ];
+
+/* The number of tasks run. */
+static uint32_t runCount;
+
+/**
+ * @brief Used as the function of a task that counts its runs.
+ */
+static void countTask( WorkPoolTask_t * pTask )
+{
+    ( void ) pTask;
+
+    ( void ) __atomic_add_fetch( &runCount, 1U, __ATOMIC_SEQ_CST );
+}
+
+/**
+ * @brief Used as the function of a task that submits #CHILD_COUNT tasks to
+ * the deque of its worker, and blocks the worker until the other workers
+ * have stolen and run them all.
+ */
+static void blockingTask( WorkPoolTask_t * pTask )
+{
+    uint32_t i = 0U;
+    uint32_t yields = 0U;
+
+    ( void ) pTask;
+
+    for( i = 0U; i < CHILD_COUNT; i++ )
+    {
+        tasks[ i ].function = countTask;
+        TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Submit( &pool, &tasks[ i ] ) );
+    }
+
+    while( ( __atomic_load_n( &runCount, __ATOMIC_SEQ_CST ) < CHILD_COUNT ) && ( yields < MAX_WAIT_YIELDS ) )
+    {
+        ( void ) sched_yield();
+        yields++;
+    }
+}
+
+/**
+ * @brief Used as the function of a task that submits itself again until it
+ * has run #CHAIN_LENGTH times.
+ */
+static void chainedTask( WorkPoolTask_t * pTask )
+{
+    if( __atomic_add_fetch( &runCount, 1U, __ATOMIC_SEQ_CST ) < CHAIN_LENGTH )
+    {
+        TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Submit( &pool, pTask ) );
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* Called before each test method. */
+void setUp()
+{
+    ( void ) memset( tasks, 0, sizeof( tasks ) );
+    runCount = 0U;
+}
+
+/* Called after each test method. */
+void tearDown()
+{
+}
+
+/* Called at the beginning of the whole suite. */
+void suiteSetUp()
+{
+}
+
+/* Called at the end of the whole suite. */
+int suiteTearDown( int numFailures )
+{
+    return numFailures;
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that #WorkPool_Start and #WorkPool_Submit reject the invalid
+ * parameters.
+ */
+void test_WorkPool_Invalid_Parameters( void )
+{
+    WorkPoolStats_t stats;
+
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_Start( NULL, WORKER_COUNT, GROUP_NAME ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_Start( &pool, 0U, GROUP_NAME ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_Start( &pool, WORK_POOL_MAX_WORKERS + 1U, GROUP_NAME ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_Start( &pool, WORKER_COUNT, NULL ) );
+
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Start( &pool, WORKER_COUNT, GROUP_NAME ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_Submit( NULL, &tasks[ 0 ] ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_Submit( &pool, NULL ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_Submit( &pool, &tasks[ 0 ] ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_GetStats( NULL, &stats ) );
+    TEST_ASSERT_EQUAL( WorkPoolBadParameter, WorkPool_GetStats( &pool, NULL ) );
+    WorkPool_Stop( &pool );
+
+    /* Stopping again, or a NULL pool, does nothing. */
+    WorkPool_Stop( &pool );
+    WorkPool_Stop( NULL );
+}
+
+/**
+ * @brief Test that the tasks submitted from another thread are all run
+ * once, and counted.
+ */
+void test_WorkPool_Runs_Submitted_Tasks( void )
+{
+    WorkPoolStats_t stats;
+    uint32_t i = 0U;
+
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Start( &pool, WORKER_COUNT, GROUP_NAME ) );
+
+    for( i = 0U; i < TASK_COUNT; i++ )
+    {
+        tasks[ i ].function = countTask;
+        TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Submit( &pool, &tasks[ i ] ) );
+    }
+
+    WorkPool_Stop( &pool );
+
+    TEST_ASSERT_EQUAL( TASK_COUNT, runCount );
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_GetStats( &pool, &stats ) );
+    TEST_ASSERT_EQUAL( TASK_COUNT, stats.executedCount );
+}
+
+/**
+ * @brief Test that the tasks a worker submits to its own deque are stolen
+ * by the other workers while it is busy.
+ */
+void test_WorkPool_Steals_From_Busy_Worker( void )
+{
+    WorkPoolStats_t stats;
+    WorkPoolTask_t parent;
+
+    ( void ) memset( &parent, 0, sizeof( parent ) );
+    parent.function = blockingTask;
+
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Start( &pool, WORKER_COUNT, GROUP_NAME ) );
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Submit( &pool, &parent ) );
+    WorkPool_Stop( &pool );
+
+    TEST_ASSERT_EQUAL( CHILD_COUNT, runCount );
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_GetStats( &pool, &stats ) );
+    TEST_ASSERT_EQUAL( CHILD_COUNT + 1U, stats.executedCount );
+    TEST_ASSERT_EQUAL( CHILD_COUNT, stats.stolenCount );
+}
+
+/**
+ * @brief Test that #WorkPool_Stop returns once the tasks submitted by the
+ * running tasks are run too.
+ */
+void test_WorkPool_Stop_Runs_Pending_Tasks( void )
+{
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Start( &pool, WORKER_COUNT, GROUP_NAME ) );
+
+    tasks[ 0 ].function = chainedTask;
+    TEST_ASSERT_EQUAL( WorkPoolSuccess, WorkPool_Submit( &pool, &tasks[ 0 ] ) );
+    WorkPool_Stop( &pool );
+
+    TEST_ASSERT_EQUAL( CHAIN_LENGTH, runCount );
+}
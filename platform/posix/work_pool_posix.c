@@ -0,0 +1,585 @@
+/*
+ * AWS IoT Device SDK for Embedded C 202012.01
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file work_pool_posix.c
+ * @brief Implementation of the work pool of work_pool.h with POSIX threads.
+ *
+ * The mutex of the pool is only taken for the shared queue and for the
+ * workers to sleep, never by a worker running the tasks of its own deque or
+ * stealing them.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Work pool include. */
+#include "work_pool.h"
+
+/* Thread groups include. */
+#include "thread_groups.h"
+
+/**
+ * @brief Mask of the index of a task in the slots of a deque.
+ */
+#define DEQUE_INDEX_MASK    ( ( uint64_t ) WORK_POOL_DEQUE_LENGTH - 1U )
+
+#if ( ( WORK_POOL_DEQUE_LENGTH & ( WORK_POOL_DEQUE_LENGTH - 1U ) ) != 0U )
+    #error "WORK_POOL_DEQUE_LENGTH must be a power of two."
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The worker running on the calling thread, if any.
+ */
+static __thread WorkPoolWorker_t * pCurrentWorker = NULL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Push a task at the bottom of a deque. Only for the owner.
+ *
+ * @param[in] pDeque The deque.
+ * @param[in] pTask The task.
+ *
+ * @return true if the task was pushed; false if the deque is full.
+ */
+static bool pushTask( WorkPoolDeque_t * pDeque,
+                      WorkPoolTask_t * pTask );
+
+/**
+ * @brief Take the newest task from the bottom of a deque. Only for the
+ * owner.
+ *
+ * @param[in] pDeque The deque.
+ *
+ * @return The task; NULL if the deque is empty, or its last task was stolen.
+ */
+static WorkPoolTask_t * takeTask( WorkPoolDeque_t * pDeque );
+
+/**
+ * @brief Steal the oldest task from the top of the deque of another worker.
+ *
+ * @param[in] pDeque The deque.
+ *
+ * @return The task; NULL if the deque is empty, or another thread took the
+ * task first.
+ */
+static WorkPoolTask_t * stealTask( WorkPoolDeque_t * pDeque );
+
+/**
+ * @brief Append a task to the shared queue and wake up a worker.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] pTask The task.
+ * @param[in] fromWorker Whether a worker of the pool submits the task, which
+ * may then be submitted after #WorkPool_Stop.
+ *
+ * @return true if the task was queued; false if the pool is stopped.
+ */
+static bool queueTask( WorkPool_t * pPool,
+                       WorkPoolTask_t * pTask,
+                       bool fromWorker );
+
+/**
+ * @brief Remove the oldest task of the shared queue.
+ *
+ * @param[in] pPool The pool.
+ *
+ * @return The task; NULL if the queue is empty.
+ */
+static WorkPoolTask_t * dequeueTask( WorkPool_t * pPool );
+
+/**
+ * @brief Find the next task of a worker: from its deque, then from the
+ * shared queue, then from the deques of the other workers.
+ *
+ * @param[in] pWorker The worker.
+ *
+ * @return The task; NULL if none was found.
+ */
+static WorkPoolTask_t * findTask( WorkPoolWorker_t * pWorker );
+
+/**
+ * @brief Wait until a task is submitted or the pool is stopped.
+ *
+ * @param[in] pPool The pool.
+ *
+ * @return true if the worker is to exit: the pool is stopped and no task is
+ * pending.
+ */
+static bool waitForTask( WorkPool_t * pPool );
+
+/**
+ * @brief Thread of a worker.
+ *
+ * @param[in] pArgument The #WorkPoolWorker_t of the thread.
+ *
+ * @return NULL.
+ */
+static void * workerThread( void * pArgument );
+
+/**
+ * @brief Stop and join the first workers of a pool.
+ *
+ * @param[in] pPool The pool.
+ * @param[in] workerCount Number of workers created.
+ */
+static void stopWorkers( WorkPool_t * pPool,
+                         uint32_t workerCount );
+
+/*-----------------------------------------------------------*/
+
+static bool pushTask( WorkPoolDeque_t * pDeque,
+                      WorkPoolTask_t * pTask )
+{
+    bool returnStatus = false;
+    int64_t bottom = __atomic_load_n( &pDeque->bottom, __ATOMIC_RELAXED );
+    int64_t top = __atomic_load_n( &pDeque->top, __ATOMIC_ACQUIRE );
+
+    /* A stale top only makes the deque look fuller, so the slot of a task a
+     * thief is still reading is never written. */
+    if( ( bottom - top ) < ( int64_t ) WORK_POOL_DEQUE_LENGTH )
+    {
+        __atomic_store_n( &pDeque->slots[ ( uint64_t ) bottom & DEQUE_INDEX_MASK ], pTask, __ATOMIC_RELAXED );
+
+        /* The thieves that see the new bottom see the task. */
+        __atomic_thread_fence( __ATOMIC_RELEASE );
+        __atomic_store_n( &pDeque->bottom, bottom + 1, __ATOMIC_RELAXED );
+        returnStatus = true;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static WorkPoolTask_t * takeTask( WorkPoolDeque_t * pDeque )
+{
+    WorkPoolTask_t * pTask = NULL;
+    int64_t bottom = __atomic_load_n( &pDeque->bottom, __ATOMIC_RELAXED ) - 1;
+    int64_t top = 0;
+
+    /* The bottom is lowered before the top is read, so that a thief either
+     * sees the task gone, or is seen taking it. */
+    __atomic_store_n( &pDeque->bottom, bottom, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+    top = __atomic_load_n( &pDeque->top, __ATOMIC_RELAXED );
+
+    if( top <= bottom )
+    {
+        pTask = __atomic_load_n( &pDeque->slots[ ( uint64_t ) bottom & DEQUE_INDEX_MASK ], __ATOMIC_RELAXED );
+
+        if( top == bottom )
+        {
+            /* The last task, which the owner takes as a thief would, from
+             * the top. */
+            if( __atomic_compare_exchange_n( &pDeque->top, &top, top + 1, false,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) == false )
+            {
+                pTask = NULL;
+            }
+
+            __atomic_store_n( &pDeque->bottom, bottom + 1, __ATOMIC_RELAXED );
+        }
+    }
+    else
+    {
+        __atomic_store_n( &pDeque->bottom, bottom + 1, __ATOMIC_RELAXED );
+    }
+
+    return pTask;
+}
+
+/*-----------------------------------------------------------*/
+
+static WorkPoolTask_t * stealTask( WorkPoolDeque_t * pDeque )
+{
+    WorkPoolTask_t * pTask = NULL;
+    int64_t top = __atomic_load_n( &pDeque->top, __ATOMIC_ACQUIRE );
+    int64_t bottom = 0;
+
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+    bottom = __atomic_load_n( &pDeque->bottom, __ATOMIC_ACQUIRE );
+
+    if( top < bottom )
+    {
+        pTask = __atomic_load_n( &pDeque->slots[ ( uint64_t ) top & DEQUE_INDEX_MASK ], __ATOMIC_RELAXED );
+
+        if( __atomic_compare_exchange_n( &pDeque->top, &top, top + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) == false )
+        {
+            pTask = NULL;
+        }
+    }
+
+    return pTask;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool queueTask( WorkPool_t * pPool,
+                       WorkPoolTask_t * pTask,
+                       bool fromWorker )
+{
+    bool returnStatus = false;
+
+    ( void ) pthread_mutex_lock( &pPool->mutex );
+
+    if( ( pPool->running == true ) || ( fromWorker == true ) )
+    {
+        pTask->pNext = NULL;
+
+        if( pPool->pQueueTail == NULL )
+        {
+            __atomic_store_n( &pPool->pQueueHead, pTask, __ATOMIC_RELEASE );
+        }
+        else
+        {
+            pPool->pQueueTail->pNext = pTask;
+        }
+
+        pPool->pQueueTail = pTask;
+        ( void ) __atomic_add_fetch( &pPool->pendingCount, 1U, __ATOMIC_SEQ_CST );
+
+        if( pPool->sleepingCount > 0U )
+        {
+            ( void ) pthread_cond_signal( &pPool->condition );
+        }
+
+        returnStatus = true;
+    }
+
+    ( void ) pthread_mutex_unlock( &pPool->mutex );
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static WorkPoolTask_t * dequeueTask( WorkPool_t * pPool )
+{
+    WorkPoolTask_t * pTask = NULL;
+
+    /* The queue is empty most of the time, when the tasks are submitted by
+     * the workers, so it is checked before taking the mutex. */
+    if( __atomic_load_n( &pPool->pQueueHead, __ATOMIC_ACQUIRE ) != NULL )
+    {
+        ( void ) pthread_mutex_lock( &pPool->mutex );
+
+        pTask = pPool->pQueueHead;
+
+        if( pTask != NULL )
+        {
+            __atomic_store_n( &pPool->pQueueHead, pTask->pNext, __ATOMIC_RELAXED );
+
+            if( pTask->pNext == NULL )
+            {
+                pPool->pQueueTail = NULL;
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &pPool->mutex );
+    }
+
+    return pTask;
+}
+
+/*-----------------------------------------------------------*/
+
+static WorkPoolTask_t * findTask( WorkPoolWorker_t * pWorker )
+{
+    WorkPool_t * pPool = pWorker->pPool;
+    WorkPoolTask_t * pTask = NULL;
+    uint32_t victim = 0U;
+    uint32_t attempt = 0U;
+
+    pTask = takeTask( &pWorker->deque );
+
+    if( pTask == NULL )
+    {
+        pTask = dequeueTask( pPool );
+    }
+
+    if( ( pTask == NULL ) && ( pPool->workerCount > 1U ) )
+    {
+        /* The victims are visited from a random one, so that the thieves do
+         * not all contend on the top of the same deque. */
+        pWorker->randomState ^= pWorker->randomState << 13;
+        pWorker->randomState ^= pWorker->randomState >> 17;
+        pWorker->randomState ^= pWorker->randomState << 5;
+        victim = pWorker->randomState % pPool->workerCount;
+
+        for( attempt = 0U; ( attempt < pPool->workerCount ) && ( pTask == NULL ); attempt++ )
+        {
+            if( &( pPool->workers[ victim ] ) != pWorker )
+            {
+                pTask = stealTask( &( pPool->workers[ victim ].deque ) );
+            }
+
+            victim = ( victim + 1U ) % pPool->workerCount;
+        }
+
+        if( pTask != NULL )
+        {
+            __atomic_store_n( &pWorker->stolenCount, pWorker->stolenCount + 1U, __ATOMIC_RELAXED );
+        }
+    }
+
+    return pTask;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool waitForTask( WorkPool_t * pPool )
+{
+    bool exitWorker = false;
+
+    ( void ) pthread_mutex_lock( &pPool->mutex );
+
+    /* The count of the sleeping workers is raised before the pending tasks
+     * are checked, and a submitter raises the pending tasks before checking
+     * the sleeping workers, so that either the worker sees the task or the
+     * submitter wakes it up. */
+    ( void ) __atomic_add_fetch( &pPool->sleepingCount, 1U, __ATOMIC_SEQ_CST );
+
+    while( ( __atomic_load_n( &pPool->pendingCount, __ATOMIC_SEQ_CST ) == 0U ) && ( pPool->running == true ) )
+    {
+        ( void ) pthread_cond_wait( &pPool->condition, &pPool->mutex );
+    }
+
+    ( void ) __atomic_sub_fetch( &pPool->sleepingCount, 1U, __ATOMIC_SEQ_CST );
+
+    exitWorker = ( __atomic_load_n( &pPool->pendingCount, __ATOMIC_SEQ_CST ) == 0U ) && ( pPool->running == false );
+
+    ( void ) pthread_mutex_unlock( &pPool->mutex );
+
+    return exitWorker;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * workerThread( void * pArgument )
+{
+    WorkPoolWorker_t * pWorker = ( WorkPoolWorker_t * ) pArgument;
+    WorkPoolTask_t * pTask = NULL;
+    bool exitWorker = false;
+
+    pCurrentWorker = pWorker;
+
+    while( exitWorker == false )
+    {
+        pTask = findTask( pWorker );
+
+        if( pTask != NULL )
+        {
+            ( void ) __atomic_sub_fetch( &pWorker->pPool->pendingCount, 1U, __ATOMIC_SEQ_CST );
+            pTask->function( pTask );
+            __atomic_store_n( &pWorker->executedCount, pWorker->executedCount + 1U, __ATOMIC_RELAXED );
+        }
+        else if( __atomic_load_n( &pWorker->pPool->pendingCount, __ATOMIC_SEQ_CST ) == 0U )
+        {
+            exitWorker = waitForTask( pWorker->pPool );
+        }
+        else
+        {
+            /* A task is being pushed, or was stolen by another thief: it is
+             * looked for again. */
+        }
+    }
+
+    pCurrentWorker = NULL;
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static void stopWorkers( WorkPool_t * pPool,
+                         uint32_t workerCount )
+{
+    uint32_t index = 0U;
+
+    ( void ) pthread_mutex_lock( &pPool->mutex );
+    pPool->running = false;
+    ( void ) pthread_cond_broadcast( &pPool->condition );
+    ( void ) pthread_mutex_unlock( &pPool->mutex );
+
+    for( index = 0U; index < workerCount; index++ )
+    {
+        ( void ) pthread_join( pPool->workers[ index ].thread, NULL );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+WorkPoolStatus_t WorkPool_Start( WorkPool_t * pPool,
+                                 uint32_t workerCount,
+                                 const char * pGroupName )
+{
+    WorkPoolStatus_t returnStatus = WorkPoolSuccess;
+    uint32_t index = 0U;
+    uint32_t createdCount = 0U;
+
+    if( ( pPool == NULL ) || ( pGroupName == NULL ) ||
+        ( workerCount == 0U ) || ( workerCount > WORK_POOL_MAX_WORKERS ) )
+    {
+        returnStatus = WorkPoolBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pPool, 0x00, sizeof( WorkPool_t ) );
+
+        if( pthread_mutex_init( &pPool->mutex, NULL ) != 0 )
+        {
+            returnStatus = WorkPoolApiError;
+        }
+        else if( pthread_cond_init( &pPool->condition, NULL ) != 0 )
+        {
+            ( void ) pthread_mutex_destroy( &pPool->mutex );
+            returnStatus = WorkPoolApiError;
+        }
+        else
+        {
+            /* The workers steal from one another from their start, so they
+             * are all set up before the first one runs. */
+            for( index = 0U; index < workerCount; index++ )
+            {
+                pPool->workers[ index ].pPool = pPool;
+                pPool->workers[ index ].randomState = index + 1U;
+            }
+
+            pPool->workerCount = workerCount;
+            pPool->running = true;
+        }
+    }
+
+    while( ( returnStatus == WorkPoolSuccess ) && ( createdCount < workerCount ) )
+    {
+        if( ThreadGroup_CreateThread( pGroupName,
+                                      &( pPool->workers[ createdCount ].thread ),
+                                      workerThread,
+                                      &( pPool->workers[ createdCount ] ) ) == ThreadGroupSuccess )
+        {
+            createdCount++;
+        }
+        else
+        {
+            returnStatus = WorkPoolApiError;
+            stopWorkers( pPool, createdCount );
+            ( void ) pthread_cond_destroy( &pPool->condition );
+            ( void ) pthread_mutex_destroy( &pPool->mutex );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+WorkPoolStatus_t WorkPool_Submit( WorkPool_t * pPool,
+                                  WorkPoolTask_t * pTask )
+{
+    WorkPoolStatus_t returnStatus = WorkPoolSuccess;
+    WorkPoolWorker_t * pWorker = pCurrentWorker;
+
+    if( ( pPool == NULL ) || ( pTask == NULL ) || ( pTask->function == NULL ) )
+    {
+        returnStatus = WorkPoolBadParameter;
+    }
+    else if( ( pWorker != NULL ) && ( pWorker->pPool == pPool ) )
+    {
+        /* The task is counted before it can be taken, so that the count of
+         * the pending tasks never goes below zero. */
+        ( void ) __atomic_add_fetch( &pPool->pendingCount, 1U, __ATOMIC_SEQ_CST );
+
+        if( pushTask( &pWorker->deque, pTask ) == true )
+        {
+            /* An idle worker is woken up to steal the task, in case this one
+             * is busy for long. */
+            if( __atomic_load_n( &pPool->sleepingCount, __ATOMIC_SEQ_CST ) > 0U )
+            {
+                ( void ) pthread_mutex_lock( &pPool->mutex );
+                ( void ) pthread_cond_signal( &pPool->condition );
+                ( void ) pthread_mutex_unlock( &pPool->mutex );
+            }
+        }
+        else
+        {
+            ( void ) __atomic_sub_fetch( &pPool->pendingCount, 1U, __ATOMIC_SEQ_CST );
+            ( void ) queueTask( pPool, pTask, true );
+        }
+    }
+    else if( queueTask( pPool, pTask, false ) == false )
+    {
+        returnStatus = WorkPoolBadParameter;
+    }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void WorkPool_Stop( WorkPool_t * pPool )
+{
+    /* Only the thread that started the pool stops it, so the flag is not
+     * read under the mutex. */
+    if( ( pPool != NULL ) && ( pPool->running == true ) )
+    {
+        stopWorkers( pPool, pPool->workerCount );
+        ( void ) pthread_cond_destroy( &pPool->condition );
+        ( void ) pthread_mutex_destroy( &pPool->mutex );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+WorkPoolStatus_t WorkPool_GetStats( const WorkPool_t * pPool,
+                                    WorkPoolStats_t * pStats )
+{
+    WorkPoolStatus_t returnStatus = WorkPoolSuccess;
+    uint32_t index = 0U;
+
+    if( ( pPool == NULL ) || ( pStats == NULL ) )
+    {
+        returnStatus = WorkPoolBadParameter;
+    }
+    else
+    {
+        ( void ) memset( pStats, 0x00, sizeof( WorkPoolStats_t ) );
+
+        for( index = 0U; index < pPool->workerCount; index++ )
+        {
+            pStats->executedCount += __atomic_load_n( &pPool->workers[ index ].executedCount, __ATOMIC_RELAXED );
+            pStats->stolenCount += __atomic_load_n( &pPool->workers[ index ].stolenCount, __ATOMIC_RELAXED );
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
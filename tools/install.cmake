@@ -1,4 +1,5 @@
-# Creates an install target to allow users to include CSDK as a set of shared libraries
+# Creates an install target to allow users to include CSDK as a set of shared libraries,
+# or of static libraries when built with SDK_PERF_PROFILE
 
 set(FILEPATH_LOCATIONS
         ${MODULES_DIR}/aws/device-defender-for-aws-iot-embedded-sdk/defenderFilePaths.cmake
@@ -127,7 +128,8 @@ foreach(library_prefix ${LIBRARY_PREFIXES})
     endif()
 
     # Install the library target.
-    install(TARGETS "${library_name}" LIBRARY DESTINATION "${CSDK_LIB_INSTALL_PATH}")
+    install(TARGETS "${library_name}" LIBRARY DESTINATION "${CSDK_LIB_INSTALL_PATH}"
+                                      ARCHIVE DESTINATION "${CSDK_LIB_INSTALL_PATH}")
 endforeach()
 
 # Install platform abstractions as shared libraries if enabled.
@@ -144,7 +146,8 @@ if(INSTALL_PLATFORM_ABSTRACTIONS)
                                         ${OTA_INCLUDE_PUBLIC_DIRS}
                                         ${OTA_INCLUDE_OS_POSIX_DIRS})
         target_compile_definitions(ota_posix PRIVATE -DOTA_DO_NOT_USE_CUSTOM_CONFIG)
-        install(TARGETS ota_posix LIBRARY DESTINATION "${CSDK_LIB_INSTALL_PATH}")
+        install(TARGETS ota_posix LIBRARY DESTINATION "${CSDK_LIB_INSTALL_PATH}"
+                                  ARCHIVE DESTINATION "${CSDK_LIB_INSTALL_PATH}")
         list(APPEND PLATFORM_DIRECTORIES ${OTA_INCLUDE_OS_POSIX_DIRS})
     endif()
     foreach(platform_dir ${PLATFORM_DIRECTORIES})
@@ -153,3 +156,13 @@ if(INSTALL_PLATFORM_ABSTRACTIONS)
                 PATTERN "*private*" EXCLUDE)
     endforeach()
 endif()
+
+# Export the build configuration of SDK_PERF_PROFILE, for the builds that link
+# the static libraries with LTO.
+if(SDK_PERF_PROFILE)
+    configure_file(${ROOT_DIR}/tools/perf-profile/csdkPerfProfile.cmake.in
+                   ${CMAKE_BINARY_DIR}/csdkPerfProfile.cmake
+                   @ONLY)
+    install(FILES ${CMAKE_BINARY_DIR}/csdkPerfProfile.cmake
+            DESTINATION "${CSDK_LIB_INSTALL_PATH}/cmake")
+endif()
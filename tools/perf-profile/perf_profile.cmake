@@ -0,0 +1,115 @@
+# Build configuration of the SDK_PERF_PROFILE option, which compiles the
+# libraries, the platform abstractions and the demos for speed. The top level
+# CMakeLists.txt builds static libraries whenever it is set.
+#
+# - LTO: link-time optimization, so that the calls between coreMQTT, the
+#   transports and the demo helpers can be inlined.
+# - GENERATE: LTO, and the instrumentation of profile-guided optimization. The
+#   programs built write their profiles to SDK_PERF_PROFILE_DIR when they exit.
+# - USE: LTO, and the optimization from the profiles of SDK_PERF_PROFILE_DIR.
+#
+# pgo_build.cmake of this directory runs the GENERATE build, its training
+# workload and the USE build one after the other.
+
+set( SDK_PERF_PROFILE_VALUES OFF LTO GENERATE USE )
+set_property( CACHE SDK_PERF_PROFILE PROPERTY STRINGS ${SDK_PERF_PROFILE_VALUES} )
+
+list( FIND SDK_PERF_PROFILE_VALUES "${SDK_PERF_PROFILE}" _profile_index )
+if( _profile_index EQUAL -1 )
+    message( FATAL_ERROR "SDK_PERF_PROFILE must be one of ${SDK_PERF_PROFILE_VALUES}, not ${SDK_PERF_PROFILE}." )
+endif()
+
+# Flags of the compilation, and of the links of the programs, which
+# tools/install.cmake exports to the builds that link the SDK.
+set( SDK_PERF_PROFILE_LTO_FLAGS "" )
+set( SDK_PERF_PROFILE_PGO_FLAGS "" )
+set( SDK_PERF_PROFILE_LINK_FLAGS "" )
+
+if( NOT SDK_PERF_PROFILE )
+    return()
+endif()
+
+if( NOT ( ( CMAKE_C_COMPILER_ID STREQUAL "GNU" ) OR ( CMAKE_C_COMPILER_ID MATCHES "Clang" ) ) )
+    message( FATAL_ERROR "SDK_PERF_PROFILE needs GCC or Clang, not ${CMAKE_C_COMPILER_ID}." )
+endif()
+
+# Optimize for speed unless another build type is chosen.
+if( NOT CMAKE_BUILD_TYPE )
+    set( CMAKE_BUILD_TYPE "Release" CACHE STRING "Choose the type of build." FORCE )
+endif()
+
+include( CheckCCompilerFlag )
+string( REGEX MATCH "^[0-9]+" _compiler_major "${CMAKE_C_COMPILER_VERSION}" )
+get_filename_component( _compiler_dir "${CMAKE_C_COMPILER}" DIRECTORY )
+
+if( CMAKE_C_COMPILER_ID STREQUAL "GNU" )
+    # Fat objects keep the machine code next to the LTO bytecode, so that the
+    # static libraries can also be linked by builds without LTO.
+    set( SDK_PERF_PROFILE_LTO_FLAGS "-flto -ffat-lto-objects" )
+    set( _ar_names "gcc-ar-${_compiler_major}" "gcc-ar" )
+    set( _ranlib_names "gcc-ranlib-${_compiler_major}" "gcc-ranlib" )
+    set( _profdata_names "" )
+else()
+    set( SDK_PERF_PROFILE_LTO_FLAGS "-flto" )
+    set( _ar_names "llvm-ar-${_compiler_major}" "llvm-ar" )
+    set( _ranlib_names "llvm-ranlib-${_compiler_major}" "llvm-ranlib" )
+    set( _profdata_names "llvm-profdata-${_compiler_major}" "llvm-profdata" )
+endif()
+
+# The archives of LTO objects must be indexed by the archiver of the compiler,
+# which loads its linker plugin.
+find_program( SDK_PERF_PROFILE_AR NAMES ${_ar_names} HINTS "${_compiler_dir}" )
+find_program( SDK_PERF_PROFILE_RANLIB NAMES ${_ranlib_names} HINTS "${_compiler_dir}" )
+if( ( NOT SDK_PERF_PROFILE_AR ) OR ( NOT SDK_PERF_PROFILE_RANLIB ) )
+    message( FATAL_ERROR "SDK_PERF_PROFILE needs one of ${_ar_names} and one of ${_ranlib_names} to archive LTO objects." )
+endif()
+set( CMAKE_AR "${SDK_PERF_PROFILE_AR}" )
+set( CMAKE_RANLIB "${SDK_PERF_PROFILE_RANLIB}" )
+
+if( SDK_PERF_PROFILE STREQUAL "GENERATE" )
+    file( MAKE_DIRECTORY "${SDK_PERF_PROFILE_DIR}" )
+
+    if( CMAKE_C_COMPILER_ID STREQUAL "GNU" )
+        set( SDK_PERF_PROFILE_PGO_FLAGS "-fprofile-generate=${SDK_PERF_PROFILE_DIR}" )
+    else()
+        # Each program writes a raw profile, merged by pgo_build.cmake.
+        find_program( SDK_PERF_PROFILE_PROFDATA NAMES ${_profdata_names} HINTS "${_compiler_dir}" )
+        set( SDK_PERF_PROFILE_PGO_FLAGS "-fprofile-instr-generate=${SDK_PERF_PROFILE_DIR}/%m.profraw" )
+    endif()
+
+    # The counters of the multithreaded demos are only exact when atomic.
+    check_c_compiler_flag( "-fprofile-update=atomic" HAVE_FPROFILE_UPDATE_ATOMIC )
+    if( HAVE_FPROFILE_UPDATE_ATOMIC )
+        set( SDK_PERF_PROFILE_PGO_FLAGS "${SDK_PERF_PROFILE_PGO_FLAGS} -fprofile-update=atomic" )
+    endif()
+
+    # The instrumentation is also needed by the links of the programs.
+    set( SDK_PERF_PROFILE_LINK_FLAGS "${SDK_PERF_PROFILE_PGO_FLAGS}" )
+elseif( SDK_PERF_PROFILE STREQUAL "USE" )
+    if( CMAKE_C_COMPILER_ID STREQUAL "GNU" )
+        file( GLOB_RECURSE _profiles "${SDK_PERF_PROFILE_DIR}/*.gcda" )
+        set( SDK_PERF_PROFILE_PGO_FLAGS "-fprofile-use=${SDK_PERF_PROFILE_DIR} -Wno-missing-profile" )
+
+        # The code the training workload did not run is still optimized for
+        # speed, rather than for size.
+        check_c_compiler_flag( "-fprofile-partial-training" HAVE_FPROFILE_PARTIAL_TRAINING )
+        if( HAVE_FPROFILE_PARTIAL_TRAINING )
+            set( SDK_PERF_PROFILE_PGO_FLAGS "${SDK_PERF_PROFILE_PGO_FLAGS} -fprofile-partial-training" )
+        endif()
+    else()
+        set( _profiles "${SDK_PERF_PROFILE_DIR}/sdk.profdata" )
+        if( NOT EXISTS "${_profiles}" )
+            set( _profiles "" )
+        endif()
+        set( SDK_PERF_PROFILE_PGO_FLAGS "-fprofile-instr-use=${SDK_PERF_PROFILE_DIR}/sdk.profdata -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date" )
+    endif()
+
+    if( NOT _profiles )
+        message( FATAL_ERROR "SDK_PERF_PROFILE_DIR ${SDK_PERF_PROFILE_DIR} has no profiles. Run a GENERATE build and its training workload first, such as with tools/perf-profile/pgo_build.cmake." )
+    endif()
+endif()
+
+# The flags of the C compiler are also those of the links of the programs.
+set( CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${SDK_PERF_PROFILE_LTO_FLAGS} ${SDK_PERF_PROFILE_PGO_FLAGS}" )
+string( STRIP "${SDK_PERF_PROFILE_LTO_FLAGS} ${SDK_PERF_PROFILE_LINK_FLAGS}" SDK_PERF_PROFILE_LINK_FLAGS )
+message( STATUS "SDK_PERF_PROFILE ${SDK_PERF_PROFILE}: ${SDK_PERF_PROFILE_LTO_FLAGS} ${SDK_PERF_PROFILE_PGO_FLAGS}" )
@@ -0,0 +1,109 @@
+# Profile-guided build of the SDK with the SDK_PERF_PROFILE option, run as a
+# script:
+#
+#   cmake -P tools/perf-profile/pgo_build.cmake
+#
+# 1. Configures and builds BUILD_DIR with SDK_PERF_PROFILE=GENERATE and the
+#    benchmarks.
+# 2. Runs the training workload: sdk_microbench with TRAINING_ARGS, then each
+#    command line of TRAINING_COMMANDS from BUILD_DIR/bin.
+# 3. Rebuilds BUILD_DIR with SDK_PERF_PROFILE=USE from the profiles.
+# 4. Installs the libraries, headers and csdkPerfProfile.cmake, if INSTALL is
+#    ON.
+#
+# Variables, passed with -D before -P:
+# - BUILD_DIR: the build directory, build-pgo of the source root by default.
+#   Both builds use it, as GCC finds the profile of an object by its path.
+# - CONFIGURE_ARGS: more arguments of both configurations, as a list.
+# - TRAINING_ARGS: the arguments of sdk_microbench, as a list.
+# - TRAINING_COMMANDS: more programs of the training workload, as a list of
+#   command lines, such as
+#   "fleet_simulator --host localhost --devices 100 --duration 30".
+# - INSTALL: ON to install the optimized build, the default.
+cmake_minimum_required( VERSION 3.2.0 )
+
+get_filename_component( SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/../.." ABSOLUTE )
+if( NOT DEFINED BUILD_DIR )
+    set( BUILD_DIR "${SOURCE_DIR}/build-pgo" )
+endif()
+get_filename_component( BUILD_DIR "${BUILD_DIR}" ABSOLUTE )
+if( NOT DEFINED TRAINING_ARGS )
+    set( TRAINING_ARGS "--duration" "2" )
+endif()
+if( NOT DEFINED INSTALL )
+    set( INSTALL ON )
+endif()
+set( PROFILE_DIR "${BUILD_DIR}/perf-profile" )
+
+# Run a command, and stop the build if it fails.
+function( run_step description )
+    message( STATUS "pgo_build: ${description}" )
+    execute_process( COMMAND ${ARGN}
+                     WORKING_DIRECTORY "${BUILD_DIR}"
+                     RESULT_VARIABLE result )
+    if( NOT result EQUAL 0 )
+        message( FATAL_ERROR "pgo_build: ${description} failed: ${result}" )
+    endif()
+endfunction()
+
+# Configure and build the instrumented programs.
+file( REMOVE_RECURSE "${PROFILE_DIR}" )
+file( MAKE_DIRECTORY "${BUILD_DIR}" )
+run_step( "configure the instrumented build"
+          "${CMAKE_COMMAND}" "${SOURCE_DIR}"
+          -DSDK_PERF_PROFILE=GENERATE
+          "-DSDK_PERF_PROFILE_DIR=${PROFILE_DIR}"
+          -DBUILD_DEMOS=ON
+          -DBUILD_BENCHMARKS=ON
+          ${CONFIGURE_ARGS} )
+run_step( "build the instrumented build"
+          "${CMAKE_COMMAND}" --build "${BUILD_DIR}" )
+
+# Train, from the bin directory of the programs.
+set( BIN_DIR "${BUILD_DIR}/bin" )
+execute_process( COMMAND "${BIN_DIR}/sdk_microbench" ${TRAINING_ARGS}
+                 WORKING_DIRECTORY "${BIN_DIR}"
+                 RESULT_VARIABLE result )
+if( NOT result EQUAL 0 )
+    message( FATAL_ERROR "pgo_build: the training run of sdk_microbench failed: ${result}" )
+endif()
+
+foreach( training_command ${TRAINING_COMMANDS} )
+    separate_arguments( training_args UNIX_COMMAND "${training_command}" )
+    list( GET training_args 0 training_program )
+    list( REMOVE_AT training_args 0 )
+    message( STATUS "pgo_build: train with ${training_command}" )
+    execute_process( COMMAND "${BIN_DIR}/${training_program}" ${training_args}
+                     WORKING_DIRECTORY "${BIN_DIR}"
+                     RESULT_VARIABLE result )
+    if( NOT result EQUAL 0 )
+        message( FATAL_ERROR "pgo_build: the training run of ${training_command} failed: ${result}" )
+    endif()
+endforeach()
+
+# Clang writes raw profiles, which are merged into the one the USE build reads.
+# SDK_PERF_PROFILE_PROFDATA is only set in the cache of a Clang build.
+file( STRINGS "${BUILD_DIR}/CMakeCache.txt" profdata REGEX "^SDK_PERF_PROFILE_PROFDATA:" )
+if( profdata )
+    string( REGEX REPLACE "^[^=]*=" "" profdata "${profdata}" )
+    file( GLOB raw_profiles "${PROFILE_DIR}/*.profraw" )
+    if( ( NOT profdata ) OR ( NOT raw_profiles ) )
+        message( FATAL_ERROR "pgo_build: the raw profiles of ${PROFILE_DIR} could not be merged with llvm-profdata." )
+    endif()
+    run_step( "merge the profiles"
+              "${profdata}" merge "-output=${PROFILE_DIR}/sdk.profdata" ${raw_profiles} )
+endif()
+
+# Rebuild with the profiles, in the same directory.
+run_step( "configure the optimized build"
+          "${CMAKE_COMMAND}" "${SOURCE_DIR}"
+          -DSDK_PERF_PROFILE=USE
+          "-DSDK_PERF_PROFILE_DIR=${PROFILE_DIR}"
+          ${CONFIGURE_ARGS} )
+run_step( "build the optimized build"
+          "${CMAKE_COMMAND}" --build "${BUILD_DIR}" )
+
+if( INSTALL )
+    run_step( "install the optimized build"
+              "${CMAKE_COMMAND}" --build "${BUILD_DIR}" --target install )
+endif()